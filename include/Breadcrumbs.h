@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+
+class QFile;
+
+/**
+ * @brief Fixed-size crash breadcrumbs in a memory-mapped ring
+ *
+ * record() claims a slot with one atomic increment and copies at most
+ * TEXT_SIZE - 1 bytes into it: no lock, no allocation, no logging, so
+ * playback, media open and DSP paths can leave a trail at full rate. Once
+ * open() has mapped the ring file, the trail lives in the page cache and
+ * survives the process dying in any way; a signal handler only needs
+ * markCrash(), and the next start finds the crumbs in previousSession().
+ * Until open(), and if mapping fails, crumbs go to a static buffer.
+ *
+ * Entries are published with a per-slot sequence number; readers skip
+ * slots overwritten while they were copied.
+ */
+class BreadcrumbRing
+{
+public:
+    static constexpr int CAPACITY = 1024;       // Power of two
+    static constexpr int TEXT_SIZE = 32;
+
+    enum Category : quint16 {
+        General,
+        UserAction,
+        Playback,
+        MediaOpen,
+        Audio,
+        Video,
+        Network
+    };
+
+    struct Breadcrumb {
+        qint64 timestampMs = 0;     // Since the epoch
+        Category category = General;
+        quint32 threadId = 0;       // Small per-process number, in order of first use
+        qint64 value = 0;
+        QByteArray text;
+
+        QString toString() const;
+    };
+
+    static BreadcrumbRing& instance();
+
+    /**
+     * @brief Map the ring file and start this session's trail in it
+     *
+     * If the file holds a session that did not close() cleanly, its crumbs
+     * are kept for previousSession() before being replaced. Call early, before
+     * other threads record.
+     */
+    bool open(const QString& filePath);
+
+    /**
+     * @brief Mark the session as cleanly shut down and unmap the file
+     */
+    void close();
+
+    bool isMapped() const { return m_file != nullptr; }
+
+    /**
+     * @brief Append a crumb; text is truncated to TEXT_SIZE - 1 bytes
+     */
+    void record(Category category, const char* text, qint64 value = 0) noexcept;
+    void record(Category category, const QByteArray& text, qint64 value = 0) noexcept
+    {
+        record(category, text.constData(), value);
+    }
+
+    /**
+     * @brief Note a fatal signal; async-signal-safe
+     */
+    void markCrash(int signal) noexcept;
+
+    /**
+     * @brief This session's crumbs, oldest first
+     */
+    QList<Breadcrumb> breadcrumbs() const;
+
+    bool previousSessionCrashed() const { return m_previousCrashed; }
+    int previousCrashSignal() const { return m_previousCrashSignal; }     // 0 if none was caught
+    qint64 previousSessionStartMs() const { return m_previousStartMs; }
+    QList<Breadcrumb> previousSession() const { return m_previous; }
+
+    // Layout of the ring file, defined with the implementation
+    struct RingHeader;
+    struct RingEntry;
+
+private:
+    BreadcrumbRing();
+    ~BreadcrumbRing();
+    BreadcrumbRing(const BreadcrumbRing&) = delete;
+    BreadcrumbRing& operator=(const BreadcrumbRing&) = delete;
+
+    static void initializeHeader(RingHeader* header);
+    static QList<Breadcrumb> readEntries(const RingHeader* header, const RingEntry* entries);
+    static quint32 currentThreadId();
+
+    RingHeader* m_header;
+    RingEntry* m_entries;
+    std::unique_ptr<QFile> m_file;
+
+    bool m_previousCrashed;
+    int m_previousCrashSignal;
+    qint64 m_previousStartMs;
+    QList<Breadcrumb> m_previous;
+};
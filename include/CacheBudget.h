@@ -0,0 +1,152 @@
+#pragma once
+
+#include <QCache>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <atomic>
+#include <functional>
+
+class MetricCounter;
+class MetricGauge;
+class QTimer;
+
+/**
+ * @brief One memory budget for all of the player's in-memory caches
+ *
+ * Caches register how to measure themselves and how to give memory back.
+ * Every POLL_INTERVAL_MS the budget sums their costs and, when the total is
+ * over the target, trims the lowest priority caches first, largest first
+ * within a priority, down to TRIM_TARGET_PERCENT of the target so the next
+ * few inserts do not trim again.
+ *
+ * The target is the budget under normal conditions, half of it under
+ * moderate memory pressure and an eighth of it under critical pressure.
+ * Pressure comes from the OS: MemAvailable and the cgroup v2 limit on
+ * Linux, the low memory notification on Windows and the memory pressure
+ * dispatch source on macOS. The default budget is an eighth of physical
+ * memory, e.g. 256 MB on a 2 GB kiosk, and can be overridden in the
+ * "Memory" settings group.
+ *
+ * Each cache's size is exported as the eonplay_cache_<name>_bytes gauge.
+ * Use from the main thread; cost and trim callbacks run there, so caches
+ * used from other threads must lock in them.
+ */
+class CacheBudget : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Priority {
+        Low,            // Cheap to rebuild, trimmed first
+        Normal,
+        High            // Visible or expensive to rebuild, trimmed last
+    };
+
+    enum class Pressure {
+        Normal,
+        Moderate,
+        Critical
+    };
+    Q_ENUM(Pressure)
+
+    using CostFunction = std::function<qint64()>;
+    using TrimFunction = std::function<qint64(qint64 bytes)>;   // Returns the bytes released
+
+    static CacheBudget& instance();
+
+    /**
+     * @brief Put a cache under the budget
+     * @param name Metric name part, e.g. "album_art"
+     * @param context The cache's owner; the registration ends when it is destroyed
+     * @param cost Bytes the cache holds now
+     * @param trim Release at least the given bytes if possible
+     */
+    void registerCache(const QString& name, Priority priority, QObject* context, CostFunction cost, TrimFunction trim);
+
+    /**
+     * @brief Register a QCache whose cost is bytesPerUnit bytes per unit
+     */
+    template <typename Key, typename T>
+    void registerCache(const QString& name, Priority priority, QObject* context, QCache<Key, T>& cache,
+                       qint64 bytesPerUnit = 1)
+    {
+        registerCache(
+            name, priority, context, [&cache, bytesPerUnit] { return qint64(cache.totalCost()) * bytesPerUnit; },
+            [&cache, bytesPerUnit](qint64 bytes) {
+                return trimCache(cache, (bytes + bytesPerUnit - 1) / bytesPerUnit) * bytesPerUnit;
+            });
+    }
+
+    /**
+     * @brief Evict least recently used entries of a QCache
+     * @return Cost units released
+     */
+    template <typename Key, typename T>
+    static qint64 trimCache(QCache<Key, T>& cache, qint64 units)
+    {
+        const qint64 before = cache.totalCost();
+        const auto limit = cache.maxCost();
+        cache.setMaxCost(qMax<qint64>(0, before - units));
+        cache.setMaxCost(limit);
+        return before - cache.totalCost();
+    }
+
+    /**
+     * @brief Set the bytes all caches may hold together and persist it
+     * @param bytes 0 for the default
+     */
+    void setBudget(qint64 bytes);
+    qint64 budget() const { return m_budget; }
+    static qint64 defaultBudget();
+
+    qint64 usage() const { return m_usage; }
+    Pressure pressure() const { return m_pressure; }
+
+    /**
+     * @brief Measure and trim now rather than at the next poll
+     */
+    void collect();
+
+    static constexpr int POLL_INTERVAL_MS = 2000;
+    static constexpr int TRIM_TARGET_PERCENT = 90;
+    static constexpr qint64 MIN_BUDGET = 64LL * 1024 * 1024;
+    static constexpr qint64 MAX_BUDGET = 1024LL * 1024 * 1024;
+    static constexpr int MODERATE_AVAILABLE_PERCENT = 15;   // Of physical memory or the cgroup limit
+    static constexpr int CRITICAL_AVAILABLE_PERCENT = 5;
+
+signals:
+    void pressureChanged(CacheBudget::Pressure pressure);
+
+private:
+    explicit CacheBudget(QObject* parent = nullptr);
+    ~CacheBudget() override;
+
+    struct Entry {
+        QString name;
+        Priority priority;
+        QPointer<QObject> context;
+        CostFunction cost;
+        TrimFunction trim;
+        qint64 bytes = 0;               // At the last measurement
+        MetricGauge* gauge;
+    };
+
+    Pressure readPressure();
+    qint64 target() const;
+    void startPressureMonitoring();
+    void stopPressureMonitoring();
+
+    QList<Entry> m_entries;
+    qint64 m_budget;
+    qint64 m_usage = 0;
+    Pressure m_pressure = Pressure::Normal;
+    QTimer* m_timer;
+    MetricGauge& m_usageGauge;
+    MetricGauge& m_budgetGauge;
+    MetricCounter& m_evictedCounter;
+
+    void* m_pressureSource = nullptr;   // Platform notification handle
+    std::atomic<int> m_platformPressure{0};
+};
@@ -4,13 +4,23 @@
 #include <QObject>
 #include <QList>
 #include <QHash>
+#include <QMutex>
+#include <QPointer>
+#include <QWaitCondition>
 #include <memory>
 
+class QThreadPool;
+
 /**
  * @brief Manages the lifecycle of application components
  * 
  * Provides centralized management for all application components,
  * ensuring proper initialization order and cleanup.
+ *
+ * Initialization follows IComponent::dependencies(): a component starts
+ * once everything it depends on is initialized, and independent
+ * components that allow it initialize concurrently on a worker pool.
+ * Priority orders components that are ready at the same time.
  */
 class ComponentManager : public QObject
 {
@@ -28,11 +38,28 @@ public:
     void registerComponent(std::shared_ptr<IComponent> component, int priority = 100);
     
     /**
-     * @brief Initialize all registered components
-     * @return true if all components initialized successfully
+     * @brief Initialize all critical components
+     *
+     * Blocks until every critical component and its dependencies have
+     * finished. Non-critical components wait for initializeDeferred().
+     * @return true if all of them initialized successfully
      */
     bool initializeAll();
     
+    /**
+     * @brief Start initializing the non-critical components
+     *
+     * Returns immediately; deferredComponentsInitialized() is emitted once
+     * they have finished.
+     */
+    void initializeDeferred();
+    
+    /**
+     * @brief Call initializeDeferred() once a window has painted
+     * @param window Widget or QWindow to watch
+     */
+    void initializeDeferredAfterPaint(QObject* window);
+    
     /**
      * @brief Shutdown all components in reverse order
      */
@@ -92,19 +119,69 @@ signals:
      * @brief Emitted when all components are initialized
      */
     void allComponentsInitialized();
+    
+    /**
+     * @brief Emitted when the deferred components have finished initializing
+     * @param success true if all of them initialized successfully
+     */
+    void deferredComponentsInitialized(bool success);
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
 
 private:
+    enum class InitState {
+        Pending,
+        Running,
+        Initialized,
+        Failed
+    };
+    
     struct ComponentEntry
     {
         std::shared_ptr<IComponent> component;
         int priority;
-        bool initialized;
+        InitState state;
+        bool deferred;
+        QList<int> dependencies;    // Indices into m_components
+        QString error;              // Set when dependencies cannot be met
         
         ComponentEntry(std::shared_ptr<IComponent> comp, int prio)
-            : component(comp), priority(prio), initialized(false) {}
+            : component(comp), priority(prio), state(InitState::Pending), deferred(false) {}
     };
     
+    struct Completion
+    {
+        int index;
+        bool success;
+        QString error;
+    };
+    
+    void resolveDependencies();
+    bool inCurrentPhase(int index) const;
+    bool isPhaseComplete() const;
+    void advance();
+    void startConcurrent(int index);
+    bool drainCompletions();
+    void processCompletions();
+    void finishComponent(int index, bool success, const QString& error);
+    void finishDeferredPhase();
+    static bool runInitialize(IComponent& component, QString& error);
+    
     QList<ComponentEntry> m_components;
     QHash<QString, std::shared_ptr<IComponent>> m_componentsByName;
+    QList<std::shared_ptr<IComponent>> m_initializationOrder;  // Shutdown runs in reverse
     bool m_allInitialized;
+    
+    // Scheduling
+    QThreadPool* m_initPool;
+    QMutex m_completionMutex;
+    QWaitCondition m_completionReady;
+    QList<Completion> m_completions;
+    int m_running;
+    bool m_deferredPhase;
+    bool m_deferredRunning;
+    bool m_phaseSuccessful;
+    qint64 m_deferredStart;     // TraceLog time the deferred phase began
+    QPointer<QObject> m_paintWatched;
 };
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * @brief Performance and efficiency cores of a hybrid CPU
+ *
+ * Detected once. On Linux, Intel hybrid parts list their core types in
+ * /sys/devices/cpu_core and cpu_atom, and ARM big.LITTLE systems give each
+ * CPU a cpu_capacity; the lowest-capacity cluster counts as efficiency
+ * cores. On Windows the CPU sets from GetSystemCpuSetInformation() carry
+ * an EfficiencyClass, lowest for efficiency cores. Elsewhere, or on a CPU
+ * with one core type, isHybrid() is false and placement is left to the
+ * scheduler; macOS has no affinity API and already runs utility-class
+ * threads on the efficiency cores.
+ *
+ * ThreadPriority places threads by role: background work on the
+ * efficiency cores, audio and decode on the performance cores. Linux pins
+ * with an affinity mask, Windows sets a soft CPU set preference.
+ */
+class CpuTopology
+{
+public:
+    enum class Placement {
+        Any,
+        Performance,
+        Efficiency
+    };
+
+    static const CpuTopology& instance();
+
+    bool isHybrid() const { return !m_performance.isEmpty() && !m_efficiency.isEmpty(); }
+
+    // Logical CPU numbers on Linux, CPU set ids on Windows
+    const QVector<int>& performanceCpus() const { return m_performance; }
+    const QVector<int>& efficiencyCpus() const { return m_efficiency; }
+
+    /**
+     * @brief Threads a CPU-bound background pool should run
+     *
+     * The efficiency core count on a hybrid CPU, since the pool is placed
+     * there, otherwise every core.
+     */
+    int backgroundThreadCount() const;
+
+    /**
+     * @brief Restrict the calling thread to a kind of core
+     * @return False on a non-hybrid CPU or if the OS refused
+     */
+    bool placeCurrentThread(Placement placement) const;
+
+    /**
+     * @brief Set the default CPU sets of a started process (Windows only)
+     *
+     * On Linux ThreadPriority::setBackgroundProcess() pins the child
+     * before exec instead, so threads it starts early are covered too.
+     */
+    bool placeProcess(qint64 processId, Placement placement) const;
+
+    const QVector<int>& cpus(Placement placement) const;
+
+private:
+    CpuTopology();
+
+    void detect();
+
+    QVector<int> m_performance;
+    QVector<int> m_efficiency;
+    QVector<int> m_all;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+class QFileSystemWatcher;
+
+/**
+ * @brief Shared in-memory directory listings
+ *
+ * Sidecar lookups (subtitles next to a video, in a Subs folder, ...) ask
+ * many "does this name exist" questions about the same few directories.
+ * Each is a round trip on a network share, so a directory is read once,
+ * with a single listing, and the questions are answered from memory.
+ *
+ * A listing is dropped when the file system watcher reports a change to
+ * its directory, and in any case after MAX_AGE_MS, since change
+ * notification is unreliable on network file systems. At most CAPACITY
+ * directories are kept. All methods are thread-safe.
+ */
+class DirectoryListingCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int CAPACITY = 256;
+    static constexpr qint64 MAX_AGE_MS = 30000;
+
+    struct Listing {
+        bool exists = false;
+        QStringList files;          // Names, sorted
+        QStringList directories;    // Names, sorted
+
+        bool hasFile(const QString& name) const;
+        bool hasDirectory(const QString& name) const;
+    };
+
+    static DirectoryListingCache& instance();
+
+    /**
+     * @brief Listing of a directory, read now unless a current one is cached
+     */
+    Listing listing(const QString& directory);
+
+    void invalidate(const QString& directory);
+    void clear();
+
+private:
+    struct Entry {
+        Listing listing;
+        qint64 readAtMs = 0;
+        quint64 lastUse = 0;
+    };
+
+    explicit DirectoryListingCache(QObject* parent = nullptr);
+
+    static QString normalizedPath(const QString& directory);
+    static Listing readListing(const QString& path);
+    void watch(const QString& path);
+    void unwatch(const QStringList& paths);
+
+    QFileSystemWatcher* m_watcher;
+    QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    quint64 m_useCounter;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "ServerComponents.h"
+#include <QCoreApplication>
+#include <memory>
+
+class ComponentManager;
+
+/**
+ * @brief Headless EonPlay for media-share boxes
+ *
+ * A QCoreApplication running only the library (with its scanner and file
+ * watching, published as a UPnP MediaServer), device discovery with media
+ * shares and sync groups, casting and the web control, registered with a ComponentManager like the
+ * desktop player's components. No platform plugin is loaded and no widget
+ * is created, so it runs without a display and in a fraction of the
+ * player's memory.
+ *
+ * Built as the eonplay-server binary, or run from the player with
+ * --headless; either way EonPlayServer::run() parses the command line.
+ */
+class EonPlayServer : public QCoreApplication
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        QString databasePath;               // Empty for the default library
+        bool scanOnStart = false;
+        QList<NetworkComponent::Share> shares;
+        bool publishLibrary = true;         // As a UPnP MediaServer for TVs
+        bool serveLibraryApi = false;       // As a library server for other EonPlay instances
+        QString apiToken;                   // Required with serveLibraryApi
+        int webControlPort = -1;            // -1 for no web control
+    };
+
+    EonPlayServer(int& argc, char** argv);
+    ~EonPlayServer() override;
+
+    /**
+     * @brief Parse the command line, initialize and run the event loop
+     * @return Exit code
+     */
+    static int run(int& argc, char** argv);
+
+    /**
+     * @brief Register and initialize the server's components
+     */
+    bool initialize(const Options& options);
+
+    ComponentManager* componentManager() const { return m_componentManager.get(); }
+
+    static QString defaultDatabasePath();
+
+public slots:
+    void shutdown();
+
+private:
+    std::unique_ptr<ComponentManager> m_componentManager;
+    bool m_initialized;
+};
@@ -4,7 +4,13 @@
 #include <QVariant>
 #include <QHash>
 #include <QList>
+#include <QMetaType>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QStringList>
+#include <atomic>
 #include <functional>
+#include <memory>
 
 /**
  * @brief Event structure for inter-component communication
@@ -24,19 +30,52 @@ struct Event
  */
 using EventHandler = std::function<void(const Event&)>;
 
+/**
+ * @brief Interned event type, see EventBus::typeId()
+ */
+using EventTypeId = int;
+
 /**
  * @brief Centralized event bus for application-wide communication
  * 
  * Provides a decoupled way for components to communicate through events.
  * Components can subscribe to specific event types and publish events.
+ *
+ * String events carry an Event with a QVariantMap and are delivered
+ * synchronously. The typed API publishes by interned id with any copyable
+ * payload, or none, and delivers on the subscriber's context thread. All
+ * methods are thread-safe; a context must not be destroyed while another
+ * thread publishes to it.
  */
 class EventBus : public QObject
 {
     Q_OBJECT
 
 public:
+    /**
+     * @brief How a typed subscription receives events
+     */
+    enum class Delivery {
+        Auto,       ///< Direct on the context's thread, queued otherwise
+        Direct,     ///< Always in the publishing thread
+        Queued,     ///< Always through the context's event loop
+        Coalesced   ///< Queued, only the latest pending payload is delivered
+    };
+    
     static EventBus& instance();
     
+    /**
+     * @brief Intern an event type name
+     * @param eventType Event type name
+     * @return Stable id for the lifetime of the process
+     */
+    EventTypeId typeId(const QString& eventType);
+    
+    /**
+     * @brief Name an interned event type was created from
+     */
+    QString typeName(EventTypeId type) const;
+    
     /**
      * @brief Subscribe to an event type
      * @param eventType The type of event to listen for
@@ -65,6 +104,48 @@ public:
      */
     void publish(const QString& eventType, const QVariantMap& data = {}, QObject* sender = nullptr);
     
+    /**
+     * @brief Subscribe to a typed event
+     * @param type Interned event type
+     * @param context Object whose thread runs the handler; the
+     *        subscription ends when it is destroyed. May be null for Direct.
+     * @param handler Function to call with the payload
+     * @param delivery Delivery mode
+     * @return Subscription ID for later unsubscription
+     */
+    template<typename T>
+    int subscribe(EventTypeId type, QObject* context, std::function<void(const T&)> handler,
+                  Delivery delivery = Delivery::Auto)
+    {
+        return addSubscription(type, QMetaType::fromType<T>(), context, delivery,
+                               [handler = std::move(handler)](const void* payload) {
+                                   handler(*static_cast<const T*>(payload));
+                               });
+    }
+    
+    /**
+     * @brief Subscribe to an event regardless of its payload
+     */
+    int subscribe(EventTypeId type, QObject* context, std::function<void()> handler,
+                  Delivery delivery = Delivery::Auto);
+    
+    /**
+     * @brief Publish a typed event
+     *
+     * The payload is copied once, and only if a subscriber needs queued
+     * delivery.
+     */
+    template<typename T>
+    void publish(EventTypeId type, const T& payload)
+    {
+        dispatch(type, QMetaType::fromType<T>(), &payload, &copyPayload<T>);
+    }
+    
+    /**
+     * @brief Publish an event without payload
+     */
+    void publish(EventTypeId type);
+    
     /**
      * @brief Clear all subscriptions
      */
@@ -76,13 +157,50 @@ private:
     EventBus(const EventBus&) = delete;
     EventBus& operator=(const EventBus&) = delete;
     
+    using ErasedHandler = std::function<void(const void*)>;
+    using PayloadCopier = std::shared_ptr<const void> (*)(const void*);
+    
+    template<typename T>
+    static std::shared_ptr<const void> copyPayload(const void* payload)
+    {
+        return std::make_shared<const T>(*static_cast<const T*>(payload));
+    }
+    
+    // Shared with queued deliveries so they can outlive unsubscription
+    struct Receiver
+    {
+        ErasedHandler handler;
+        std::atomic<bool> active{true};
+        
+        // Coalesced delivery
+        QMutex mutex;
+        std::shared_ptr<const void> pending;
+        bool scheduled = false;
+    };
+    
     struct Subscription
     {
         int id;
-        QString eventType;
-        EventHandler handler;
+        EventTypeId eventType;
+        QMetaType payloadType;      // Invalid for handlers that ignore the payload
+        Delivery delivery;
+        QObject* context;
+        QMetaObject::Connection contextConnection;
+        std::shared_ptr<Receiver> receiver;
     };
     
-    QHash<QString, QList<Subscription>> m_subscriptions;
+    int addSubscription(EventTypeId type, QMetaType payloadType, QObject* context,
+                        Delivery delivery, ErasedHandler handler);
+    void dispatch(EventTypeId type, QMetaType payloadType, const void* payload, PayloadCopier copier);
+    bool isQueued(const Subscription& subscription) const;
+    void deliverQueued(const Subscription& subscription, std::shared_ptr<const void> payload);
+    static void invoke(Receiver& receiver, const void* payload, EventTypeId type);
+    
+    mutable QMutex m_mutex;
+    QHash<EventTypeId, QList<Subscription>> m_subscriptions;
     int m_nextSubscriptionId = 1;
+    
+    mutable QReadWriteLock m_typeLock;
+    QHash<QString, EventTypeId> m_typeIds;
+    QStringList m_typeNames;
 };
\ No newline at end of file
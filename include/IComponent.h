@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QString>
+#include <QStringList>
 
 /**
  * @brief Interface for modular application components
@@ -35,4 +36,29 @@ public:
      * @return true if initialized, false otherwise
      */
     virtual bool isInitialized() const = 0;
+    
+    /**
+     * @brief Names of components that must be initialized first
+     * @return Component names, empty by default
+     */
+    virtual QStringList dependencies() const { return {}; }
+    
+    /**
+     * @brief Check if initialize() may run on a worker thread
+     *
+     * Only opt in when initialize() creates no QObjects and touches no
+     * main-thread state beyond emitting signals.
+     * @return false by default
+     */
+    virtual bool canInitializeConcurrently() const { return false; }
+    
+    /**
+     * @brief Check if the component is needed before the first window paint
+     *
+     * Non-critical components are initialized by
+     * ComponentManager::initializeDeferred() unless a critical one depends
+     * on them.
+     * @return true by default
+     */
+    virtual bool isCritical() const { return true; }
 };
\ No newline at end of file
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <QByteArray>
+#include <QMap>
+#include <QMutex>
+#include <QVector>
+#include <QtGlobal>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace MetricsDetail {
+
+constexpr int COUNTER_SHARDS = 16;
+constexpr int HISTOGRAM_SHARDS = 4;
+
+/**
+ * @brief Shard of the calling thread; threads are spread round-robin
+ */
+inline int threadShard()
+{
+    static std::atomic<int> nextShard{0};
+    thread_local const int shard = nextShard.fetch_add(1, std::memory_order_relaxed) & 0xffff;
+    return shard;
+}
+
+} // namespace MetricsDetail
+
+/**
+ * @brief Monotonic event count, e.g. dropped frames
+ *
+ * add() is one relaxed atomic increment on a cache line shared only with
+ * the threads of the same shard, so counting from decoder, audio and
+ * worker threads at full rate neither locks nor bounces cache lines.
+ * value() sums the shards.
+ */
+class MetricCounter
+{
+public:
+    MetricCounter(const QByteArray& name, const QByteArray& help) : m_name(name), m_help(help) {}
+
+    void add(quint64 count = 1)
+    {
+        m_shards[MetricsDetail::threadShard() % MetricsDetail::COUNTER_SHARDS].value.fetch_add(
+            count, std::memory_order_relaxed);
+    }
+
+    quint64 value() const;
+    const QByteArray& name() const { return m_name; }
+    const QByteArray& help() const { return m_help; }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<quint64> value{0};
+    };
+
+    QByteArray m_name;
+    QByteArray m_help;
+    std::array<Shard, MetricsDetail::COUNTER_SHARDS> m_shards;
+};
+
+/**
+ * @brief Current level of something that goes up and down, e.g. bytes cached
+ *
+ * A single relaxed atomic; set() is meant for a periodic sampler, not a
+ * hot path shared between threads.
+ */
+class MetricGauge
+{
+public:
+    MetricGauge(const QByteArray& name, const QByteArray& help) : m_name(name), m_help(help) {}
+
+    void set(qint64 value) { m_value.store(value, std::memory_order_relaxed); }
+    qint64 value() const { return m_value.load(std::memory_order_relaxed); }
+    const QByteArray& name() const { return m_name; }
+    const QByteArray& help() const { return m_help; }
+
+private:
+    QByteArray m_name;
+    QByteArray m_help;
+    std::atomic<qint64> m_value{0};
+};
+
+/**
+ * @brief Copy of a histogram at one point in time
+ */
+struct HistogramSnapshot
+{
+    quint64 count = 0;
+    qint64 sum = 0;             // Microseconds
+    qint64 max = 0;
+    QVector<quint64> buckets;   // Per LatencyHistogram bucket
+
+    /**
+     * @brief Value below which a fraction q of the samples lie, within the bucket precision
+     */
+    qint64 percentile(double q) const;
+    double mean() const { return count ? double(sum) / count : 0.0; }
+};
+
+/**
+ * @brief Latency distribution in microseconds with HDR-style buckets
+ *
+ * Values up to 16 us are counted exactly; above that every power of two
+ * is split into SUB_BUCKETS linear buckets, so any percentile is within
+ * 1/SUB_BUCKETS (6.25%) of the true value from microseconds up to hours,
+ * in a fixed array of counters. record() is a few relaxed atomic
+ * operations on the calling thread's shard.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 36;                     // ~19 hours
+    static constexpr int BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    LatencyHistogram(const QByteArray& name, const QByteArray& help);
+
+    void record(qint64 microseconds);
+
+    HistogramSnapshot snapshot() const;
+    const QByteArray& name() const { return m_name; }
+    const QByteArray& help() const { return m_help; }
+
+    static int bucketIndex(qint64 value);
+    static qint64 bucketLowerBound(int index);
+    static qint64 bucketUpperBound(int index);
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<quint64> count{0};
+        std::atomic<qint64> sum{0};
+        std::atomic<qint64> max{0};
+        std::array<std::atomic<quint64>, BUCKET_COUNT> buckets{};
+    };
+
+    QByteArray m_name;
+    QByteArray m_help;
+    std::unique_ptr<std::array<Shard, MetricsDetail::HISTOGRAM_SHARDS>> m_shards;
+};
+
+/**
+ * @brief All metrics at one point in time, keyed by name
+ */
+struct MetricsSnapshot
+{
+    qint64 timestampMs = 0;     // Since the epoch
+    QMap<QByteArray, quint64> counters;
+    QMap<QByteArray, qint64> gauges;
+    QMap<QByteArray, HistogramSnapshot> histograms;
+};
+
+/**
+ * @brief Process-wide registry of counters, gauges and latency histograms
+ *
+ * Metrics are registered once, typically into a function-local static
+ * reference at the place they are updated, and live until exit; updating
+ * them never touches the registry. Snapshots and the OpenMetrics text are
+ * for CrashReporter's stability metrics, the metrics endpoint and the
+ * debug overlay.
+ */
+class MetricsRegistry
+{
+public:
+    static MetricsRegistry& instance();
+
+    /**
+     * @brief Get or register a counter
+     * @param name Metric family name, without the _total suffix
+     */
+    MetricCounter& counter(const QByteArray& name, const QByteArray& help);
+
+    /**
+     * @brief Get or register a gauge
+     */
+    MetricGauge& gauge(const QByteArray& name, const QByteArray& help);
+
+    /**
+     * @brief Get or register a latency histogram; exported in seconds
+     */
+    LatencyHistogram& histogram(const QByteArray& name, const QByteArray& help);
+
+    MetricsSnapshot snapshot() const;
+
+    /**
+     * @brief Render all metrics in the OpenMetrics text format
+     */
+    QByteArray toOpenMetrics() const;
+
+private:
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    mutable QMutex m_mutex;
+    std::vector<std::unique_ptr<MetricCounter>> m_counters;
+    std::vector<std::unique_ptr<MetricGauge>> m_gauges;
+    std::vector<std::unique_ptr<LatencyHistogram>> m_histograms;
+};
+
+/**
+ * @brief Records the time from construction to destruction into a histogram
+ */
+class LatencyTimer
+{
+public:
+    explicit LatencyTimer(LatencyHistogram& histogram);
+    ~LatencyTimer();
+
+    LatencyTimer(const LatencyTimer&) = delete;
+    LatencyTimer& operator=(const LatencyTimer&) = delete;
+
+private:
+    LatencyHistogram& m_histogram;
+    qint64 m_start;
+};
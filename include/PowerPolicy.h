@@ -0,0 +1,117 @@
+#pragma once
+
+#include <QMetaType>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+
+/**
+ * @brief Battery and thermal state as reported by the platform
+ */
+struct PowerStatus {
+    bool onBattery = false;
+    int batteryPercent = -1;        // -1 if unknown or there is no battery
+    bool powerSaver = false;        // The system's own power saving mode is on
+    int temperatureC = -1;          // Hottest thermal zone; -1 if unknown
+
+    bool operator==(const PowerStatus& other) const
+    {
+        return onBattery == other.onBattery && batteryPercent == other.batteryPercent
+            && powerSaver == other.powerSaver && temperatureC == other.temperatureC;
+    }
+    bool operator!=(const PowerStatus& other) const { return !(*this == other); }
+};
+
+Q_DECLARE_METATYPE(PowerStatus)
+
+/**
+ * @brief Decides how much work playback may cost from battery and thermal state
+ *
+ * The platform layer reports a PowerStatus; the policy maps it to a level
+ * and the level to a Profile that the expensive parts of the player follow:
+ * hardware decoding for new media, the visualizer's analysis rate, the
+ * HRTF and noise reduction DSP, and the UI refresh rate. Levels are only
+ * left once the battery or temperature is HYSTERESIS past the threshold
+ * that caused them, so a reading hovering at a threshold does not toggle
+ * the DSP on and off.
+ *
+ * Thresholds are kept in the "Power" settings group. Lives on the main
+ * thread; profile() may be read and profileChanged() connected from any
+ * thread.
+ */
+class PowerPolicy : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Level {
+        Normal,
+        Saving,
+        Critical
+    };
+    Q_ENUM(Level)
+
+    struct Thresholds {
+        bool enabled = true;
+        bool saveOnBattery = true;          // Any time on battery, not only when low
+        int lowBatteryPercent = 30;
+        int criticalBatteryPercent = 10;
+        int hotTemperatureC = 80;
+        int criticalTemperatureC = 90;
+        int savingVisualizerFps = 20;
+        int criticalVisualizerFps = 10;
+        int savingUiRateHz = 30;
+        int criticalUiRateHz = 15;
+    };
+
+    struct Profile {
+        Level level = Normal;
+        bool forceHardwareDecode = false;
+        bool expensiveDspEnabled = true;    // HRTF and noise reduction
+        int visualizerFpsLimit = 0;         // 0 for no limit
+        int uiRateLimitHz = 0;              // 0 for no limit
+    };
+
+    static constexpr int BATTERY_HYSTERESIS_PERCENT = 5;
+    static constexpr int TEMPERATURE_HYSTERESIS_C = 5;
+
+    static PowerPolicy& instance();
+
+    /**
+     * @brief Report the current platform state; re-evaluates the level
+     */
+    void setStatus(const PowerStatus& status);
+    PowerStatus status() const;
+
+    Profile profile() const;
+    Level level() const { return profile().level; }
+
+    Thresholds thresholds() const;
+
+    /**
+     * @brief Change and persist the thresholds; re-evaluates the level
+     */
+    void setThresholds(const Thresholds& thresholds);
+
+    static QString levelName(Level level);
+
+signals:
+    void statusChanged(const PowerStatus& status);
+    void profileChanged(const PowerPolicy::Profile& profile);
+
+private:
+    explicit PowerPolicy(QObject* parent = nullptr);
+
+    void update();
+    Level evaluate(const PowerStatus& status, const Thresholds& thresholds, Level current) const;
+    static Profile profileFor(Level level, const Thresholds& thresholds);
+    static Thresholds loadThresholds();
+    static void saveThresholds(const Thresholds& thresholds);
+
+    mutable QMutex m_mutex;
+    PowerStatus m_status;
+    Thresholds m_thresholds;
+    Profile m_profile;
+};
+
+Q_DECLARE_METATYPE(PowerPolicy::Profile)
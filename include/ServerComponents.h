@@ -0,0 +1,109 @@
+#pragma once
+
+#include "IComponent.h"
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <memory>
+
+class NetworkDiscoveryManager;
+class VideoCastingManager;
+
+namespace EonPlay {
+namespace Data {
+class LibraryManager;
+}
+}
+
+/**
+ * @brief Media library for the headless server
+ *
+ * Owns the LibraryManager. Library folders and auto-scan come from the
+ * library's own settings, shared with the desktop player.
+ */
+class LibraryComponent : public IComponent
+{
+public:
+    LibraryComponent(const QString& databasePath, bool scanOnStart);
+    ~LibraryComponent() override;
+
+    // IComponent interface
+    bool initialize() override;
+    void shutdown() override;
+    QString componentName() const override { return "LibraryManager"; }
+    bool isInitialized() const override { return m_initialized; }
+
+    EonPlay::Data::LibraryManager* library() const { return m_library.get(); }
+
+private:
+    QString m_databasePath;
+    bool m_scanOnStart;
+    bool m_initialized;
+    std::unique_ptr<EonPlay::Data::LibraryManager> m_library;
+};
+
+/**
+ * @brief Device discovery, media shares and sync groups for the headless server
+ *
+ * Given an initialized library, also publishes it as a UPnP MediaServer
+ * and, as a library server, serves it to other EonPlay instances through
+ * the remote library API.
+ */
+class NetworkComponent : public IComponent
+{
+public:
+    using Share = QPair<QString, QString>;  // Name, root path
+
+    /**
+     * @param library Library to publish, or nullptr for none
+     * @param publishUpnp Publish the library as a UPnP MediaServer
+     * @param serveLibraryApi Serve the remote library API
+     * @param apiToken Bearer token API clients must send; required to serve the API
+     */
+    NetworkComponent(const QList<Share>& shares, const LibraryComponent* library = nullptr, bool publishUpnp = true,
+                     bool serveLibraryApi = false, const QString& apiToken = QString());
+    ~NetworkComponent() override;
+
+    // IComponent interface
+    bool initialize() override;
+    void shutdown() override;
+    QString componentName() const override { return "NetworkDiscoveryManager"; }
+    bool isInitialized() const override { return m_initialized; }
+
+    NetworkDiscoveryManager* network() const { return m_network.get(); }
+
+private:
+    QList<Share> m_shares;
+    const LibraryComponent* m_library;
+    bool m_publishUpnp;
+    bool m_serveLibraryApi;
+    QString m_apiToken;
+    bool m_initialized;
+    std::unique_ptr<NetworkDiscoveryManager> m_network;
+};
+
+/**
+ * @brief Casting and the remote web control for the headless server
+ */
+class CastingComponent : public IComponent
+{
+public:
+    /**
+     * @param webControlPort Port of the web control, 0 for any, -1 for none
+     */
+    explicit CastingComponent(int webControlPort);
+    ~CastingComponent() override;
+
+    // IComponent interface
+    bool initialize() override;
+    void shutdown() override;
+    QString componentName() const override { return "VideoCastingManager"; }
+    bool isInitialized() const override { return m_initialized; }
+
+    VideoCastingManager* casting() const { return m_casting.get(); }
+
+private:
+    int m_webControlPort;
+    bool m_initialized;
+    std::unique_ptr<VideoCastingManager> m_casting;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+#include <memory>
+
+class QFile;
+
+/**
+ * @brief Compact binary record of the last session's UI state
+ *
+ * Written on quit and when the application is suspended, and read at the
+ * next start before the main window is first painted: the window comes
+ * back with its layout, the media it had loaded at the same position, the
+ * library page that was on screen and the queue, while the components
+ * behind them load their data in the background. Nothing in it is
+ * authoritative; the database and settings replace what it showed.
+ *
+ * The file is a header and a table of sections, each a QDataStream blob.
+ * open() maps the file and only checks the table; a section is decoded
+ * when it is asked for. Unknown sections are ignored, and a file of
+ * another version, or a damaged one, reads as if there were no snapshot.
+ */
+class SessionSnapshot
+{
+public:
+    static constexpr quint32 MAGIC = 0x53534E45;    // "ENSS"
+    static constexpr quint32 VERSION = 1;
+
+    struct Layout {
+        QByteArray geometry;
+        QByteArray windowState;
+        QByteArray mainSplitter;
+        QByteArray sidePanels;          // Splitter state, once every panel was built
+        quint32 visiblePanels = 0;      // Bit per side panel slot
+    };
+
+    struct Playback {
+        QString filePath;               // Empty if nothing was loaded
+        qint64 position = 0;            // Milliseconds
+        qint64 duration = 0;
+    };
+
+    struct Queue {
+        QStringList filePaths;          // The queue's ids
+        int currentIndex = -1;          // Of the loaded media, -1 if it is not queued
+    };
+
+    struct LibraryPage {
+        int viewMode = 0;
+        int sortBy = 0;
+        int filterBy = 0;
+        QString searchText;
+        int firstRow = -1;              // At the top of the view, -1 if none was shown
+    };
+
+    SessionSnapshot();
+    ~SessionSnapshot();
+
+    static QString defaultPath();
+
+    /**
+     * @brief Map a snapshot file
+     * @return false if there is none, or it is not a snapshot of this version
+     */
+    bool open(const QString& filePath);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+
+    // Sections of the open file, default values for those it lacks
+    Layout layout() const;
+    Playback playback() const;
+    Queue queue() const;
+    LibraryPage libraryPage() const;
+
+    /**
+     * @brief Cover art that was on screen, to decode ahead of the views asking for it
+     */
+    QStringList warmCacheKeys() const;
+
+    // Sections to write
+    void setLayout(const Layout& layout);
+    void setPlayback(const Playback& playback);
+    void setQueue(const Queue& queue);
+    void setLibraryPage(const LibraryPage& page);
+    void setWarmCacheKeys(const QStringList& keys);
+
+    /**
+     * @brief Atomically replace filePath with the sections set
+     *
+     * Close a snapshot mapping the same file first.
+     */
+    bool save(const QString& filePath) const;
+
+private:
+    enum SectionId : quint32 {
+        LayoutSection = 1,
+        PlaybackSection,
+        QueueSection,
+        LibraryPageSection,
+        WarmCacheSection
+    };
+
+    struct SectionEntry {
+        quint32 id;
+        quint32 reserved;
+        quint64 offset;
+        quint64 length;
+    };
+
+    /**
+     * @brief Bytes of a section, pointing into the map; empty if missing
+     */
+    QByteArray section(SectionId id) const;
+
+    template <typename Write>
+    void setSection(SectionId id, Write&& write);
+
+    std::unique_ptr<QFile> m_file;
+    const uchar* m_data;
+    qint64 m_size;
+    QList<SectionEntry> m_sections;
+
+    QMap<quint32, QByteArray> m_pending;
+
+    SessionSnapshot(const SessionSnapshot&) = delete;
+    SessionSnapshot& operator=(const SessionSnapshot&) = delete;
+};
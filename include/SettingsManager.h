@@ -2,9 +2,12 @@
 
 #include "IComponent.h"
 #include "UserPreferences.h"
+#include "SettingsSchema.h"
+#include "SettingsStore.h"
+#include <QHash>
 #include <QObject>
-#include <QSettings>
-#include <QTimer>
+#include <QPointer>
+#include <functional>
 #include <memory>
 
 /**
@@ -12,6 +15,14 @@
  * 
  * Provides centralized settings management for EonPlay with automatic persistence,
  * validation, encryption for sensitive data, and migration support.
+ *
+ * Settings live in a SettingsStore: changes only touch memory and reach
+ * disk in debounced, atomic background writes.
+ *
+ * The settings described in SettingsSchema.h are also held, validated and
+ * typed, in the preferences() snapshot. get(Settings::Volume) is a field
+ * load with no key lookup or QVariant conversion, and onChanged() calls a
+ * handler when that one key changes, however it was set.
  */
 class SettingsManager : public QObject, public IComponent
 {
@@ -39,6 +50,27 @@ public:
      */
     void setPreferences(const UserPreferences& preferences);
     
+    /**
+     * @brief Get a setting from the snapshot
+     */
+    template <typename T>
+    const T& get(const SettingKey<T>& key) const { return m_preferences.*key.field; }
+    
+    /**
+     * @brief Validate and set a setting; written with the store's next flush
+     */
+    template <typename T>
+    void set(const SettingKey<T>& key, T value);
+    
+    /**
+     * @brief Call handler with the new value whenever key changes
+     *
+     * Changes are delivered once per event loop pass, like settingsChanged().
+     * The handler is dropped with context.
+     */
+    template <typename T>
+    void onChanged(const SettingKey<T>& key, QObject* context, std::function<void(const T&)> handler);
+    
     /**
      * @brief Get a specific setting value
      * @param key Setting key
@@ -55,7 +87,7 @@ public:
     void setValue(const QString& key, const QVariant& value);
     
     /**
-     * @brief Save settings immediately
+     * @brief Start writing settings to disk now, in the background
      */
     void saveSettings();
     
@@ -122,6 +154,12 @@ signals:
      */
     void settingChanged(const QString& key, const QVariant& value);
     
+    /**
+     * @brief Emitted once per batch of setting changes
+     * @param keys Setting keys changed since the previous batch
+     */
+    void settingsChanged(const QStringList& keys);
+    
     /**
      * @brief Emitted when settings are saved
      */
@@ -134,23 +172,23 @@ signals:
 
 private slots:
     /**
-     * @brief Auto-save settings (called by timer)
+     * @brief Re-emit a batch of store changes per key
      */
-    void autoSaveSettings();
+    void onValuesChanged(const QStringList& keys);
 
 private:
     /**
-     * @brief Initialize QSettings with proper configuration
+     * @brief Create the settings store and load the settings file
      */
-    void initializeQSettings();
+    void initializeStore();
     
     /**
-     * @brief Load preferences from QSettings
+     * @brief Load preferences from the settings store
      */
     void loadPreferencesFromSettings();
     
     /**
-     * @brief Save preferences to QSettings
+     * @brief Save preferences to the settings store
      */
     void savePreferencesToSettings();
     
@@ -179,13 +217,68 @@ private:
      */
     void migrateFromV0ToV1();
     
-    std::unique_ptr<QSettings> m_settings;
+    /**
+     * @brief Write one setting from the snapshot to the store
+     */
+    template <typename T>
+    void storeSetting(const SettingKey<T>& key);
+    
+    /**
+     * @brief Route a string-keyed write of a schema setting through the snapshot
+     * @return false if key is not in the schema
+     */
+    bool setSchemaValue(const QString& key, const QVariant& value);
+    
+    struct ChangeHandler {
+        QPointer<QObject> context;
+        std::function<void()> notify;
+    };
+    
+    std::unique_ptr<SettingsStore> m_store;
     UserPreferences m_preferences;
-    QTimer* m_autoSaveTimer;
+    QHash<QString, QList<ChangeHandler>> m_changeHandlers;  // By key name
     bool m_initialized;
-    bool m_settingsChanged;
     
-    static constexpr int AUTO_SAVE_INTERVAL_MS = 30000; // 30 seconds
     static constexpr const char* SETTINGS_VERSION_KEY = "version";
     static constexpr const char* CURRENT_SETTINGS_VERSION = "1.0";
-};
\ No newline at end of file
+};
+
+template <typename T>
+void SettingsManager::set(const SettingKey<T>& key, T value)
+{
+    if (key.validate) {
+        key.validate(value);
+    }
+    
+    T& field = m_preferences.*key.field;
+    if (field == value) {
+        return;
+    }
+    field = std::move(value);
+    
+    // onChanged() handlers follow batched, see onValuesChanged()
+    if (m_store) {
+        storeSetting(key);
+    }
+}
+
+template <typename T>
+void SettingsManager::onChanged(const SettingKey<T>& key, QObject* context, std::function<void(const T&)> handler)
+{
+    T UserPreferences::* field = key.field;
+    m_changeHandlers[QString::fromLatin1(key.name)].append({context, [this, field, handler = std::move(handler)]() {
+        handler(m_preferences.*field);
+    }});
+}
+
+template <typename T>
+void SettingsManager::storeSetting(const SettingKey<T>& key)
+{
+    if constexpr (std::is_same_v<T, QString>) {
+        if (key.encrypted) {
+            setEncryptedValue(key.name, m_preferences.*key.field);
+            return;
+        }
+    }
+    m_store->setValue(key.name, QVariant::fromValue(m_preferences.*key.field));
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "UserPreferences.h"
+#include <QPoint>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <type_traits>
+
+/**
+ * @brief Compile-time descriptor of one setting
+ *
+ * Names the key in the settings file, the UserPreferences field that holds
+ * the value in memory and the validator that corrects it. The default is
+ * the field's initializer in UserPreferences, so there is one place to
+ * change it. Descriptors are constexpr globals in namespace Settings; pass
+ * them to SettingsManager::get()/set()/onChanged() instead of key strings.
+ */
+template <typename T>
+struct SettingKey
+{
+    using ValueType = T;
+
+    const char* name;                   // Key in the settings file
+    T UserPreferences::* field;         // Where the value lives in the snapshot
+    bool (*validate)(T& value) = nullptr; // Corrects value in place; false if it had to
+    bool encrypted = false;             // Stored through SettingsManager::setEncryptedValue()
+
+    const T& defaultValue() const
+    {
+        static const UserPreferences defaults;
+        return defaults.*field;
+    }
+};
+
+/**
+ * @brief Validators used by the descriptors; each returns false if it corrected the value
+ */
+namespace SettingsValidators {
+
+template <int Min, int Max>
+bool inRange(int& value)
+{
+    if (value >= Min && value <= Max) {
+        return true;
+    }
+    value = value < Min ? Min : Max;
+    return false;
+}
+
+bool playbackSpeed(double& value);
+bool theme(QString& value);
+bool windowSize(QSize& value);
+bool windowPosition(QPoint& value);
+bool audioBufferSize(int& value);
+bool proxyType(QString& value);
+bool logLevel(QString& value);
+bool updateChannel(QString& value);
+bool accelerationType(QString& value);
+
+} // namespace SettingsValidators
+
+namespace Settings {
+
+using namespace SettingsValidators;
+
+// Playback
+inline constexpr SettingKey<int> Volume{"playback/volume", &UserPreferences::volume, &inRange<0, 100>};
+inline constexpr SettingKey<bool> Muted{"playback/muted", &UserPreferences::muted};
+inline constexpr SettingKey<double> PlaybackSpeed{"playback/speed", &UserPreferences::playbackSpeed, &playbackSpeed};
+inline constexpr SettingKey<bool> ResumePlayback{"playback/resume", &UserPreferences::resumePlayback};
+inline constexpr SettingKey<bool> Autoplay{"playback/autoplay", &UserPreferences::autoplay};
+inline constexpr SettingKey<bool> LoopPlaylist{"playback/loop", &UserPreferences::loopPlaylist};
+inline constexpr SettingKey<bool> ShufflePlaylist{"playback/shuffle", &UserPreferences::shufflePlaylist};
+inline constexpr SettingKey<bool> CrossfadeEnabled{"playback/crossfadeEnabled", &UserPreferences::crossfadeEnabled};
+inline constexpr SettingKey<int> CrossfadeDuration{"playback/crossfadeDuration", &UserPreferences::crossfadeDuration,
+                                                   &inRange<500, 10000>};
+inline constexpr SettingKey<bool> GaplessPlayback{"playback/gaplessPlayback", &UserPreferences::gaplessPlayback};
+inline constexpr SettingKey<bool> SeekThumbnailsEnabled{"playback/seekThumbnailsEnabled",
+                                                        &UserPreferences::seekThumbnailsEnabled};
+inline constexpr SettingKey<int> FastSeekSpeed{"playback/fastSeekSpeed", &UserPreferences::fastSeekSpeed, &inRange<1, 20>};
+
+// UI
+inline constexpr SettingKey<QString> Theme{"ui/theme", &UserPreferences::theme, &theme};
+inline constexpr SettingKey<QString> Language{"ui/language", &UserPreferences::language};
+inline constexpr SettingKey<QSize> WindowSize{"ui/windowSize", &UserPreferences::windowSize, &windowSize};
+inline constexpr SettingKey<QPoint> WindowPosition{"ui/windowPosition", &UserPreferences::windowPosition, &windowPosition};
+inline constexpr SettingKey<bool> WindowMaximized{"ui/windowMaximized", &UserPreferences::windowMaximized};
+inline constexpr SettingKey<bool> ShowMenuBar{"ui/showMenuBar", &UserPreferences::showMenuBar};
+inline constexpr SettingKey<bool> ShowStatusBar{"ui/showStatusBar", &UserPreferences::showStatusBar};
+inline constexpr SettingKey<bool> ShowPlaylist{"ui/showPlaylist", &UserPreferences::showPlaylist};
+inline constexpr SettingKey<bool> ShowLibrary{"ui/showLibrary", &UserPreferences::showLibrary};
+
+// Hardware
+inline constexpr SettingKey<bool> HardwareAcceleration{"hardware/acceleration", &UserPreferences::hardwareAcceleration};
+inline constexpr SettingKey<QString> PreferredAccelerationType{"hardware/preferredAccelerationType",
+                                                               &UserPreferences::preferredAccelerationType,
+                                                               &accelerationType};
+inline constexpr SettingKey<QString> AudioDevice{"hardware/audioDevice", &UserPreferences::audioDevice};
+inline constexpr SettingKey<int> AudioBufferSize{"hardware/audioBufferSize", &UserPreferences::audioBufferSize,
+                                                 &audioBufferSize};
+
+// Subtitles
+inline constexpr SettingKey<QString> SubtitleFont{"subtitles/font", &UserPreferences::subtitleFont};
+inline constexpr SettingKey<int> SubtitleFontSize{"subtitles/fontSize", &UserPreferences::subtitleFontSize, &inRange<8, 72>};
+inline constexpr SettingKey<QString> SubtitleColor{"subtitles/color", &UserPreferences::subtitleColor};
+inline constexpr SettingKey<QString> SubtitleBackgroundColor{"subtitles/backgroundColor",
+                                                             &UserPreferences::subtitleBackgroundColor};
+inline constexpr SettingKey<int> SubtitleDelay{"subtitles/delay", &UserPreferences::subtitleDelay, &inRange<-60000, 60000>};
+inline constexpr SettingKey<bool> SubtitleAutoLoad{"subtitles/autoLoad", &UserPreferences::subtitleAutoLoad};
+
+// Library
+inline constexpr SettingKey<QStringList> LibraryPaths{"library/paths", &UserPreferences::libraryPaths};
+inline constexpr SettingKey<bool> AutoScanLibrary{"library/autoScan", &UserPreferences::autoScanLibrary};
+inline constexpr SettingKey<int> ScanInterval{"library/scanInterval", &UserPreferences::scanInterval, &inRange<1, 168>};
+inline constexpr SettingKey<bool> ExtractThumbnails{"library/extractThumbnails", &UserPreferences::extractThumbnails};
+inline constexpr SettingKey<bool> ExtractMetadata{"library/extractMetadata", &UserPreferences::extractMetadata};
+
+// Network
+inline constexpr SettingKey<bool> EnableNetworking{"network/enabled", &UserPreferences::enableNetworking};
+inline constexpr SettingKey<QString> ProxyType{"network/proxyType", &UserPreferences::proxyType, &proxyType};
+inline constexpr SettingKey<QString> ProxyHost{"network/proxyHost", &UserPreferences::proxyHost};
+inline constexpr SettingKey<int> ProxyPort{"network/proxyPort", &UserPreferences::proxyPort, &inRange<0, 65535>};
+inline constexpr SettingKey<QString> ProxyUsername{"network/proxyUsername", &UserPreferences::proxyUsername};
+inline constexpr SettingKey<QString> ProxyPassword{"network/proxyPassword", &UserPreferences::proxyPassword, nullptr, true};
+
+// Privacy
+inline constexpr SettingKey<bool> CollectUsageStats{"privacy/collectStats", &UserPreferences::collectUsageStats};
+inline constexpr SettingKey<bool> CheckForUpdates{"privacy/checkUpdates", &UserPreferences::checkForUpdates};
+inline constexpr SettingKey<bool> RememberRecentFiles{"privacy/rememberRecent", &UserPreferences::rememberRecentFiles};
+inline constexpr SettingKey<int> MaxRecentFiles{"privacy/maxRecentFiles", &UserPreferences::maxRecentFiles, &inRange<1, 50>};
+
+// Advanced
+inline constexpr SettingKey<bool> EnableLogging{"advanced/enableLogging", &UserPreferences::enableLogging};
+inline constexpr SettingKey<QString> LogLevel{"advanced/logLevel", &UserPreferences::logLevel, &logLevel};
+inline constexpr SettingKey<bool> EnableCrashReporting{"advanced/crashReporting", &UserPreferences::enableCrashReporting};
+inline constexpr SettingKey<QString> UpdateChannel{"advanced/updateChannel", &UserPreferences::updateChannel, &updateChannel};
+
+/**
+ * @brief Call function with every descriptor, in file order
+ */
+template <typename Function>
+void forEachSetting(Function&& function)
+{
+    function(Volume);
+    function(Muted);
+    function(PlaybackSpeed);
+    function(ResumePlayback);
+    function(Autoplay);
+    function(LoopPlaylist);
+    function(ShufflePlaylist);
+    function(CrossfadeEnabled);
+    function(CrossfadeDuration);
+    function(GaplessPlayback);
+    function(SeekThumbnailsEnabled);
+    function(FastSeekSpeed);
+
+    function(Theme);
+    function(Language);
+    function(WindowSize);
+    function(WindowPosition);
+    function(WindowMaximized);
+    function(ShowMenuBar);
+    function(ShowStatusBar);
+    function(ShowPlaylist);
+    function(ShowLibrary);
+
+    function(HardwareAcceleration);
+    function(PreferredAccelerationType);
+    function(AudioDevice);
+    function(AudioBufferSize);
+
+    function(SubtitleFont);
+    function(SubtitleFontSize);
+    function(SubtitleColor);
+    function(SubtitleBackgroundColor);
+    function(SubtitleDelay);
+    function(SubtitleAutoLoad);
+
+    function(LibraryPaths);
+    function(AutoScanLibrary);
+    function(ScanInterval);
+    function(ExtractThumbnails);
+    function(ExtractMetadata);
+
+    function(EnableNetworking);
+    function(ProxyType);
+    function(ProxyHost);
+    function(ProxyPort);
+    function(ProxyUsername);
+    function(ProxyPassword);
+
+    function(CollectUsageStats);
+    function(CheckForUpdates);
+    function(RememberRecentFiles);
+    function(MaxRecentFiles);
+
+    function(EnableLogging);
+    function(LogLevel);
+    function(EnableCrashReporting);
+    function(UpdateChannel);
+}
+
+} // namespace Settings
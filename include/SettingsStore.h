@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+
+class QTimer;
+
+/**
+ * @brief INI settings held in memory and written to disk in the background
+ *
+ * Reads and writes go to an in-memory snapshot of the file, so a slider
+ * that stores its value on every move costs a map update. Changes restart
+ * a debounce timer; when it fires, or at the latest MAX_FLUSH_DELAY_MS
+ * after the first unsaved change, a copy of the snapshot is written on a
+ * writer thread. The file is first rendered to a staging file and then
+ * replaced through QSaveFile, so a crash mid-write leaves the previous
+ * settings intact. One write runs at a time; changes made meanwhile go
+ * into the next.
+ *
+ * Change notifications are batched as well: valuesChanged() is emitted
+ * once per event loop pass with every key changed since the last one.
+ *
+ * value() may be called from any thread; everything else belongs to the
+ * thread the store lives in.
+ */
+class SettingsStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_FLUSH_DELAY_MS = 1000;
+    static constexpr int MAX_FLUSH_DELAY_MS = 5000;
+    static constexpr const char* STAGING_SUFFIX = ".tmp";
+
+    explicit SettingsStore(const QString& filePath, QObject* parent = nullptr);
+
+    /**
+     * @brief Writes unsaved changes before going away
+     */
+    ~SettingsStore();
+
+    /**
+     * @brief Replace the snapshot with the file's contents
+     * @return false if the file exists but cannot be read
+     */
+    bool load();
+
+    QVariant value(const QString& key, const QVariant& defaultValue = QVariant()) const;
+    bool contains(const QString& key) const;
+    QStringList keys() const;
+
+    /**
+     * @brief Set a value; schedules a write if it changed
+     */
+    void setValue(const QString& key, const QVariant& value);
+    void remove(const QString& key);
+    void clear();
+
+    /**
+     * @brief Delay between the last change and the write
+     */
+    void setFlushDelay(int delayMs);
+    int flushDelay() const { return m_flushDelayMs; }
+
+    bool isDirty() const { return m_dirty; }
+    QString filePath() const { return m_filePath; }
+
+    /**
+     * @brief Start writing unsaved changes now, in the background
+     */
+    void flush();
+
+    /**
+     * @brief Write unsaved changes on the calling thread, after any write in progress
+     * @return true if everything is on disk
+     */
+    bool flushSync();
+
+signals:
+    /**
+     * @brief Keys changed since the previous emission
+     */
+    void valuesChanged(const QStringList& keys);
+
+    void saved();
+    void saveFailed(const QString& error);
+
+private:
+    void markChanged(const QString& key);
+    void scheduleFlush();
+    void emitChanges();
+    void onWriteFinished(quint64 generation, const QString& error);
+
+    /**
+     * @brief Render values to the staging file and move it over filePath
+     * @return Error message; empty on success
+     */
+    static QString writeFile(const QString& filePath, const QVariantMap& values);
+
+    QString m_filePath;
+    mutable QMutex m_mutex;             // Guards m_values
+    QVariantMap m_values;
+    QTimer* m_flushTimer;
+    QElapsedTimer m_firstUnsavedChange;
+    int m_flushDelayMs;
+    bool m_dirty;
+    bool m_flushAgain;                  // Changes arrived while a write was running
+    QFuture<QString> m_write;
+    quint64 m_writeGeneration;          // Bumped by every write; stale results are ignored
+    QStringList m_changedKeys;
+};
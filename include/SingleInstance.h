@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+
+class QLocalServer;
+class QLocalSocket;
+
+/**
+ * @brief Hands launches over to an EonPlay that is already running
+ *
+ * "Open with EonPlay" starts a new process for every file. The first
+ * process listens on a local socket private to the user; later launches
+ * connect before any component is initialized, send their files and exit,
+ * so the running player opens them within milliseconds instead of after a
+ * full startup. A socket left behind by a crashed instance is replaced.
+ *
+ * Passing --new-instance skips both sides and starts a separate player.
+ */
+class SingleInstance : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int CONNECT_TIMEOUT_MS = 200;
+    static constexpr int REPLY_TIMEOUT_MS = 2000;
+
+    explicit SingleInstance(QObject* parent = nullptr);
+
+    /**
+     * @brief Send files to a running instance
+     * @param files Absolute paths and URLs; empty to only raise its window
+     * @return true if an instance took them and this process should exit
+     */
+    static bool forwardToRunningInstance(const QStringList& files);
+
+    /**
+     * @brief Accept launches from later processes
+     * @return true if listening
+     */
+    bool listen();
+    bool isListening() const;
+
+    /**
+     * @brief Check the command line for --new-instance
+     */
+    static bool isNewInstanceRequested(const QStringList& arguments);
+
+    /**
+     * @brief Files and URLs named on the command line
+     *
+     * Relative paths are made absolute here because the running instance
+     * has a different working directory. Options are skipped.
+     */
+    static QStringList mediaArguments(const QStringList& arguments);
+
+    /**
+     * @brief Socket name, unique per user and configuration directory
+     */
+    static QString serverName();
+
+signals:
+    /**
+     * @brief Another launch handed over its files
+     * @param files Absolute paths and URLs; empty if none were given
+     */
+    void launched(const QStringList& files);
+
+private:
+    void onNewConnection();
+    void readRequest(QLocalSocket* socket);
+
+    QLocalServer* m_server;
+};
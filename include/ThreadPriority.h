@@ -0,0 +1,56 @@
+#pragma once
+
+class QProcess;
+
+/**
+ * @brief Asks the OS to schedule the calling thread for the work it does
+ *
+ * Audio render threads get real-time scheduling: the MMCSS "Pro Audio"
+ * task on Windows, SCHED_FIFO on Linux (through rtkit when the process
+ * may not set it itself) and the user-interactive QoS class on macOS.
+ * Decode and video output threads get the MMCSS "Playback" task, a raised
+ * nice level and the user-initiated class. Background work - scanning,
+ * metadata, hashing, AI - runs at a lowered priority, nice 10 and the
+ * utility class, so a library scan next to a transcription cannot starve
+ * playback. Its I/O priority is BackgroundIoScope's business. On a hybrid
+ * CPU each role is also placed through CpuTopology: background threads and
+ * helper processes on the efficiency cores, audio and decode on the
+ * performance cores.
+ *
+ * A role sticks to the thread, so only use it on threads that do nothing
+ * else: audio callbacks, a decoder's threads, a component's own
+ * QThreadPool. Setting the role the thread already has is a thread-local
+ * read, cheap enough for every audio block, and a role the OS refused is
+ * not asked for again. The first request on a thread may be a D-Bus round
+ * trip to rtkit, so audio hosts should make it when their thread starts.
+ */
+class ThreadPriority
+{
+public:
+    enum class Role {
+        Normal,
+        Audio,
+        Playback,
+        Background
+    };
+
+    static constexpr int AUDIO_REALTIME_PRIORITY = 10;      // SCHED_FIFO, within rtkit's default limit
+    static constexpr int PLAYBACK_NICE = -10;
+    static constexpr int BACKGROUND_NICE = 10;
+
+    /**
+     * @brief Move the calling thread to a role
+     * @return False if the OS refused; the thread keeps its old scheduling
+     */
+    static bool setCurrentThreadRole(Role role);
+    static Role currentThreadRole();
+
+    /**
+     * @brief Start a helper process at background priority
+     *
+     * Must be called before QProcess::start().
+     */
+    static void setBackgroundProcess(QProcess* process);
+
+    static const char* roleName(Role role);
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+
+/**
+ * @brief Process-wide recorder for Chrome trace-event JSON
+ *
+ * Recording is off until setOutputFile() is called or $EONPLAY_TRACE_FILE
+ * names a file; while off, a TraceScope costs one atomic load. The written
+ * file opens in chrome://tracing or Perfetto. Timestamps are microseconds
+ * since the first call to instance(), which main() makes first thing.
+ */
+class TraceLog
+{
+public:
+    static TraceLog& instance();
+
+    /**
+     * @brief Check if events are being recorded
+     */
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Start recording, to be written to filePath by flush()
+     */
+    void setOutputFile(const QString& filePath);
+
+    /**
+     * @brief Microseconds since the trace clock started
+     */
+    qint64 now() const;
+
+    /**
+     * @brief Record a finished span
+     * @param name Event name
+     * @param category Comma-separated trace categories
+     * @param startUs Start time from now()
+     * @param durationUs Duration in microseconds
+     */
+    void addComplete(const QByteArray& name, const char* category, qint64 startUs, qint64 durationUs);
+
+    /**
+     * @brief Record a point in time, such as the first frame
+     * @param name Mark name, also usable with markTime()
+     */
+    void mark(const QByteArray& name, const char* category = "startup");
+
+    /**
+     * @brief Time a mark was first recorded
+     * @return Microseconds from now(), -1 if not recorded
+     */
+    qint64 markTime(const QByteArray& name) const;
+
+    /**
+     * @brief Write all recorded events to the output file
+     * @return true if the file was written
+     */
+    bool flush();
+
+private:
+    TraceLog();
+    TraceLog(const TraceLog&) = delete;
+    TraceLog& operator=(const TraceLog&) = delete;
+
+    struct TraceEvent
+    {
+        QByteArray name;
+        const char* category;
+        char phase;             // 'X' complete, 'i' instant
+        qint64 timestamp;
+        qint64 duration;
+        int threadId;
+    };
+
+    static int currentThreadId();
+
+    QElapsedTimer m_clock;
+    std::atomic<bool> m_enabled{false};
+
+    mutable QMutex m_mutex;
+    QString m_outputFile;
+    QList<TraceEvent> m_events;
+    QHash<QByteArray, qint64> m_marks;
+};
+
+/**
+ * @brief Records the span from construction to destruction or end()
+ *
+ * Categories must be string literals; names are copied only while
+ * recording is on.
+ */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name, const char* category = "startup");
+    explicit TraceScope(const QString& name, const char* category = "startup");
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    /**
+     * @brief Close the span early
+     */
+    void end();
+
+private:
+    QByteArray m_name;
+    const char* m_category;
+    qint64 m_start = -1;        // -1 while not recording
+};
@@ -60,8 +60,16 @@ public:
         QString outputFormat = "srt";
         bool enablePunctuation = true;
         bool enableCapitalization = true;
+        int threads = 0;            // CPU threads for local engines, 0 for the engine default
+        int gpuDevice = -1;         // CUDA device for Whisper, -1 for the engine default
+        bool fastLanguageDetection = true;  // Detect from a few speech snippets, not the whole file
     };
 
+    static constexpr int LANGUAGE_PROBES = 3;
+    static constexpr int LANGUAGE_PROBE_MS = 10000;
+    static constexpr int LANGUAGE_PROBE_WINDOW_MS = 30000;     // Decoded to find the speech in
+    static constexpr double LANGUAGE_EARLY_CONFIDENCE = 0.9;
+
     explicit AISubtitleGenerator(QObject* parent = nullptr);
     ~AISubtitleGenerator();
 
@@ -95,12 +103,21 @@ public:
     int progress() const { return m_progress; }
     QString currentStatus() const { return m_currentStatus; }
 
-    // Language detection
+    /**
+     * @brief Detect the spoken language
+     * 
+     * With fastLanguageDetection and Whisper available, only up to
+     * LANGUAGE_PROBES windows spread over the file are decoded. The
+     * LANGUAGE_PROBE_MS with the most speech in each goes to Whisper,
+     * stopping at the first result of LANGUAGE_EARLY_CONFIDENCE or more.
+     */
     void detectLanguage(const QString& mediaFilePath);
     Language getDetectedLanguage() const { return m_detectedLanguage; }
     double getLanguageConfidence() const { return m_languageConfidence; }
 
     // Utility methods
+    static bool isAudioFile(const QString& filePath);
+    QString ffmpegExecutable() const { return m_ffmpegPath; }
     static QString languageToString(Language language);
     static Language stringToLanguage(const QString& languageStr);
     static QString engineToString(Engine engine);
@@ -131,7 +148,6 @@ private:
 
     // Audio extraction
     QString extractAudioFromVideo(const QString& videoPath);
-    bool isAudioFile(const QString& filePath) const;
 
     // Subtitle formatting
     QString formatSubtitles(const QJsonObject& transcription, const QString& format);
@@ -142,6 +158,11 @@ private:
     // Language detection helpers
     void detectLanguageWithWhisper(const QString& audioPath);
     void detectLanguageWithAPI(const QString& audioPath);
+    void detectLanguageFromProbes(const QString& mediaFilePath);
+    bool runWhisperLanguageDetection(const QString& audioPath, QString& language, double& confidence,
+                                     QString& error) const;
+    qint64 probeDurationMs(const QString& mediaFilePath) const;
+    QString extractSpeechProbe(const QString& mediaFilePath, qint64 offsetMs) const;
 
     // Utility methods
     QString getWhisperExecutable() const;
@@ -160,6 +181,7 @@ private:
 
     // Process management
     std::unique_ptr<QProcess> m_currentProcess;
+    QString m_outputPath;
     QTimer* m_progressTimer;
     
     // Network management
@@ -177,6 +199,12 @@ private:
     QString m_whisperPath;
     QString m_ffmpegPath;
     QString m_voskModelPath;
+
+    static constexpr int PROBE_SAMPLE_RATE = 16000;
+    static constexpr int PROBE_FRAME_MS = 30;
+    static constexpr double PROBE_SPEECH_MARGIN_DB = 10.0;     // Above the window's noise floor
+    static constexpr double PROBE_SILENCE_FLOOR_DB = -50.0;    // Always silence below this
+    static constexpr double PROBE_MIN_SPEECH = 0.2;            // Share of speech frames to be worth a run
 };
 
 } // namespace AI
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "ai/AISubtitleGenerator.h"
+#include "ai/SubtitleJobScheduler.h"
 #include "ai/SubtitleLanguageDetector.h"
 #include "ai/SubtitleTranslator.h"
+#include <QHash>
 #include <QObject>
 #include <QString>
 #include <QStringList>
@@ -10,6 +12,10 @@
 #include <memory>
 
 namespace EonPlay {
+namespace Data {
+class SubtitleIndexer;
+}
+
 namespace AI {
 
 /**
@@ -63,6 +69,12 @@ public:
     AISubtitleGenerator* subtitleGenerator() const { return m_generator.get(); }
     SubtitleLanguageDetector* languageDetector() const { return m_detector.get(); }
     SubtitleTranslator* subtitleTranslator() const { return m_translator.get(); }
+    SubtitleJobScheduler* jobScheduler() const { return m_scheduler.get(); }
+
+    /**
+     * @brief Make generated and auto-loaded subtitles searchable
+     */
+    void setSubtitleIndexer(Data::SubtitleIndexer* indexer);
 
     // High-level operations
     void processMediaFile(const QString& mediaFilePath);
@@ -77,7 +89,7 @@ public:
     QStringList findSubtitleFiles(const QString& mediaFilePath);
     QString findBestSubtitleFile(const QString& mediaFilePath);
 
-    // Batch operations
+    // Batch operations, generation and translation run on jobScheduler()
     void processMultipleMediaFiles(const QStringList& mediaFilePaths);
     void generateSubtitlesForMultipleFiles(const QStringList& mediaFilePaths, const QString& outputDirectory);
     void translateMultipleSubtitleFiles(const QStringList& subtitlePaths, const QString& outputDirectory,
@@ -127,6 +139,8 @@ private slots:
 
     // Batch processing
     void processBatchQueue();
+    void onJobFinished(int id, const QString& inputPath, const QString& outputPath);
+    void onJobFailed(int id, const QString& inputPath, const QString& error);
 
 private:
     // Initialization
@@ -159,6 +173,9 @@ private:
 
     void queueBatchOperation(const BatchOperation& operation);
     void processBatchOperation(const BatchOperation& operation);
+    void beginBatch(const QString& operation, int totalFiles);
+    void submitBatchJob(const SubtitleJobScheduler::Job& job);
+    void completeBatchItem(bool succeeded);
 
     // Member variables
     AISubtitleSettings m_settings;
@@ -167,6 +184,7 @@ private:
     std::unique_ptr<AISubtitleGenerator> m_generator;
     std::unique_ptr<SubtitleLanguageDetector> m_detector;
     std::unique_ptr<SubtitleTranslator> m_translator;
+    std::unique_ptr<SubtitleJobScheduler> m_scheduler;
     
     // Operation tracking
     QString m_currentOperation;
@@ -177,6 +195,12 @@ private:
     QList<BatchOperation> m_batchQueue;
     QTimer* m_batchTimer;
     bool m_processingBatch;
+    QString m_batchOperation;
+    int m_batchSucceeded;
+    int m_batchFailed;
+    QHash<int, SubtitleJobScheduler::Job> m_batchJobs;     // Scheduler id to job
+    
+    Data::SubtitleIndexer* m_subtitleIndexer;
     
     // Auto-detection state
     bool m_autoDetectionEnabled;
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+namespace EonPlay {
+namespace AI {
+
+/**
+ * @brief Offline language identification from character trigrams
+ *
+ * Text is lowercased and reduced to letter runs; every trigram is hashed
+ * into one of 2^bucketBits buckets. For each bucket the model stores a
+ * row of quantized log probabilities, one per language, so scoring a
+ * trigram is a single add of a contiguous int16 row into the per-language
+ * accumulators, a loop the compiler vectorizes. Languages written in a
+ * script of their own (Greek, Hebrew, Arabic, Thai, Devanagari, Hangul,
+ * Kana, Han) are decided from the script before any trigram is looked at.
+ *
+ * The model is a flat little-endian file:
+ *
+ *     "EPLI" | u32 version | u32 languages | u32 stride | u32 bucketBits | u32 scale
+ *     char[8] code per language
+ *     int16 table[1 << bucketBits][stride]   (log p * scale, padded lanes are 0)
+ *
+ * instance() maps AppDataLocation/models/langid.bin, or :/models/langid.bin
+ * when it is compiled in, and otherwise builds a small model from the
+ * built-in lists of frequent words. train() produces such a file from
+ * sample text.
+ */
+class LanguageIdModel
+{
+public:
+    struct Score {
+        QString code;           // ISO 639-1
+        double probability = 0.0;
+    };
+
+    /**
+     * @brief The process-wide model, loaded on first use
+     */
+    static const LanguageIdModel& instance();
+
+    /**
+     * @brief Build a model file from sample text per language code
+     */
+    static QByteArray train(const QHash<QString, QString>& samples, int bucketBits = 14);
+
+    bool loadFile(const QString& filePath);
+    bool loadData(const QByteArray& data);
+
+    bool isValid() const { return m_table != nullptr; }
+    QStringList languages() const { return m_codes; }
+
+    /**
+     * @brief Rank languages for a text, most likely first
+     *
+     * Looks at no more than MAX_SAMPLE_CHARACTERS, taken from evenly spaced
+     * parts of the text. Probabilities sum to one over the returned list
+     * and the ones left out.
+     */
+    QList<Score> classify(const QString& text, int maxResults = 4) const;
+
+    static constexpr int MAX_SAMPLE_CHARACTERS = 4096;
+
+private:
+    bool attach(const uchar* data, qint64 size);
+    static QString sample(const QString& text);
+    static QString normalize(const QString& text);
+    static quint32 trigramHash(QChar a, QChar b, QChar c);
+
+    std::unique_ptr<QFile> m_file;      // Kept open while mapped
+    QByteArray m_owned;                 // Built or decompressed models
+    const qint16* m_table = nullptr;
+    QStringList m_codes;
+    int m_stride = 0;
+    quint32 m_bucketMask = 0;
+    double m_scale = 1.0;
+};
+
+} // namespace AI
+} // namespace EonPlay
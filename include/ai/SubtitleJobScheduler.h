@@ -0,0 +1,193 @@
+#pragma once
+
+#include "ai/AISubtitleGenerator.h"
+#include "ai/SubtitleTranslator.h"
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QQueue>
+#include <QString>
+#include <map>
+#include <memory>
+#include <vector>
+
+class QProcess;
+
+namespace EonPlay {
+namespace AI {
+
+/**
+ * @brief Runs batches of subtitle jobs as a pipeline
+ *
+ * Each job passes through up to three stages: audio extraction with FFmpeg,
+ * transcription and translation. Stages of different files overlap, so one
+ * file is being extracted while another is transcribed and a third
+ * translated. Every stage draws on a resource class with its own limit:
+ *
+ * - Extraction: FFmpeg processes, CPU bound
+ * - LocalInference: Whisper, Vosk and the offline translator; one process
+ *   per GPU when GPUs are found, otherwise enough processes to share the
+ *   CPU cores between them
+ * - CloudApi: speech and translation services; a concurrency limit plus a
+ *   token bucket of job starts per minute
+ *
+ * Later stages are served first so files leave the pipeline as soon as
+ * possible, and extraction stops running ahead once enough audio is waiting
+ * for transcription, which keeps the temporary WAV files of a long backlog
+ * from piling up on disk.
+ *
+ * Generators and translators are single-job objects, so the scheduler keeps
+ * a pool of them and runs one job on each.
+ */
+class SubtitleJobScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Resource {
+        Extraction,
+        LocalInference,
+        CloudApi
+    };
+
+    enum class Stage {
+        Extract,
+        Transcribe,
+        Translate
+    };
+
+    struct Job {
+        QString inputPath;          // Media file, or subtitle file when not generating
+        QString outputPath;         // Generated subtitles
+        bool generate = true;
+        bool translate = false;
+        SubtitleTranslator::Language targetLanguage = SubtitleTranslator::English;
+        QString translatedPath;     // Translation output when translating
+    };
+
+    explicit SubtitleJobScheduler(QObject* parent = nullptr);
+    ~SubtitleJobScheduler() override;
+
+    void setGenerationOptions(const AISubtitleGenerator::GenerationOptions& options);
+    void setTranslationOptions(const SubtitleTranslator::TranslationOptions& options);
+
+    /**
+     * @brief Queue a job
+     * @return Id used in the signals
+     */
+    int submit(const Job& job);
+
+    /**
+     * @brief Drop queued jobs and stop running ones
+     */
+    void cancelAll();
+
+    bool isIdle() const { return m_jobs.empty(); }
+    int pendingJobs() const { return static_cast<int>(m_jobs.size()); }
+
+    /**
+     * @brief Set how many stages may use a resource class at once
+     * @param limit 0 restores the detected default
+     */
+    void setLimit(Resource resource, int limit);
+    int limit(Resource resource) const;
+
+    /**
+     * @brief Cap cloud job starts per minute, 0 for no cap
+     */
+    void setCloudRequestsPerMinute(int requests);
+    int cloudRequestsPerMinute() const { return m_cloudRequestsPerMinute; }
+
+    /**
+     * @brief Count GPUs usable by Whisper
+     *
+     * Honours CUDA_VISIBLE_DEVICES, otherwise asks nvidia-smi.
+     */
+    static int detectGpuCount();
+
+signals:
+    void jobStarted(int id, const QString& inputPath);
+    void stageStarted(int id, SubtitleJobScheduler::Stage stage);
+    void jobFinished(int id, const QString& inputPath, const QString& outputPath);
+    void jobFailed(int id, const QString& inputPath, const QString& error);
+    void allFinished(int succeeded, int failed);
+
+private:
+    struct ActiveJob {
+        int id = 0;
+        Job job;
+        Stage stage = Stage::Extract;
+        Resource held = Resource::Extraction;  // Of the running stage
+        int gpu = -1;
+        QString audioPath;          // Extracted audio, removed after transcription
+        bool started = false;
+    };
+
+    // Pipeline
+    void enqueue(ActiveJob& active, Stage stage);
+    void schedulePump();
+    void pump();
+    bool startNext(Stage stage);
+    Resource resourceFor(Stage stage) const;
+    bool acquire(Resource resource);
+    void release(Resource resource);
+    void advance(ActiveJob& active);
+    void finishJob(int id, const QString& outputPath);
+    void failJob(int id, const QString& error);
+
+    // Stages
+    void startExtraction(ActiveJob& active);
+    void startTranscription(ActiveJob& active);
+    void startTranslation(ActiveJob& active);
+    void onExtractionFinished(int id, QProcess* process);
+    void onTranscriptionDone(AISubtitleGenerator* generator, const QString& error);
+    void onTranslationDone(SubtitleTranslator* translator, const QString& error);
+
+    // Worker pools
+    AISubtitleGenerator* takeGenerator();
+    SubtitleTranslator* takeTranslator();
+    void returnGenerator(AISubtitleGenerator* generator);
+    void returnTranslator(SubtitleTranslator* translator);
+    void discardBusyWorkers();
+
+    int defaultLimit(Resource resource) const;
+    void refillCloudTokens();
+
+    AISubtitleGenerator::GenerationOptions m_generationOptions;
+    SubtitleTranslator::TranslationOptions m_translationOptions;
+    QString m_ffmpegPath;
+
+    std::map<int, ActiveJob> m_jobs;
+    QHash<int, QQueue<int>> m_ready;            // Stage to job ids waiting for it
+    int m_nextId = 1;
+    int m_succeeded = 0;
+    int m_failed = 0;
+    bool m_pumpQueued = false;
+
+    QHash<int, int> m_limits;                   // Resource to limit, unset for default
+    QHash<int, int> m_inUse;                    // Resource to running stages
+    int m_gpuCount;
+    QList<int> m_gpuLoad;                       // Running transcriptions per GPU
+
+    int m_cloudRequestsPerMinute = DEFAULT_CLOUD_REQUESTS_PER_MINUTE;
+    double m_cloudTokens;
+    QElapsedTimer m_cloudClock;
+    bool m_cloudRetryQueued = false;
+
+    std::vector<std::unique_ptr<AISubtitleGenerator>> m_generators;
+    std::vector<std::unique_ptr<SubtitleTranslator>> m_translators;
+    QList<AISubtitleGenerator*> m_idleGenerators;
+    QList<SubtitleTranslator*> m_idleTranslators;
+    QHash<AISubtitleGenerator*, int> m_generatorJobs;
+    QHash<SubtitleTranslator*, int> m_translatorJobs;
+    QHash<int, QProcess*> m_extractions;
+
+    static constexpr int DEFAULT_CLOUD_CONCURRENCY = 4;
+    static constexpr int DEFAULT_CLOUD_REQUESTS_PER_MINUTE = 30;
+    static constexpr int EXTRACT_AHEAD = 2;      // Extracted files per transcription slot
+    static constexpr int EXTRACTION_TIMEOUT_MS = 10 * 60 * 1000;
+};
+
+} // namespace AI
+} // namespace EonPlay
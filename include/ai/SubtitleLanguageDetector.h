@@ -4,7 +4,7 @@
 #include <QString>
 #include <QStringList>
 #include <QHash>
-#include <QNetworkAccessManager>
+#include <QSet>
 #include <QNetworkReply>
 
 namespace EonPlay {
@@ -15,6 +15,10 @@ namespace AI {
  * 
  * Provides automatic language detection for subtitle files using
  * various detection methods including local algorithms and cloud APIs.
+ *
+ * Detection always runs the offline trigram model (LanguageIdModel) first.
+ * The configured cloud method, if any, is only asked about texts the model
+ * is less sure of than minimumConfidence().
  */
 class SubtitleLanguageDetector : public QObject
 {
@@ -74,9 +78,18 @@ public:
     ~SubtitleLanguageDetector() = default;
 
     // Configuration
+    /**
+     * @brief Cloud API used for low-confidence results, LocalNGram for none
+     */
     void setDetectionMethod(DetectionMethod method) { m_method = method; }
     DetectionMethod detectionMethod() const { return m_method; }
 
+    /**
+     * @brief Local results below this confidence go to the cloud method
+     */
+    void setMinimumConfidence(double confidence) { m_minimumConfidence = confidence; }
+    double minimumConfidence() const { return m_minimumConfidence; }
+
     void setApiKey(DetectionMethod method, const QString& apiKey);
     QString getApiKey(DetectionMethod method) const;
     bool isMethodAvailable(DetectionMethod method) const;
@@ -101,7 +114,7 @@ public:
 
     // File format support
     bool isSupportedSubtitleFile(const QString& filePath) const;
-    QString extractTextFromSubtitleFile(const QString& filePath);
+    QString extractTextFromSubtitleFile(const QString& filePath, int maxCharacters = -1);
 
 signals:
     void languageDetected(const QString& filePath, const DetectionResult& result);
@@ -121,32 +134,36 @@ private:
 
     // Local detection helpers
     void initializeLanguageModels();
-    double calculateNGramScore(const QString& text, Language language);
-    QHash<QString, double> extractNGrams(const QString& text, int n = 3);
-    QString normalizeText(const QString& text);
+    bool needsFallback(const DetectionResult& result) const;
+    void detectWithFallback(const QString& text, const QString& identifier, const DetectionResult& local);
+    void finishFallback(const QString& identifier, const DetectionResult& apiResult);
 
-    // Subtitle parsing
-    QString extractSRTText(const QString& filePath);
-    QString extractASSText(const QString& filePath);
-    QString extractVTTText(const QString& filePath);
+    // Subtitle parsing, maxCharacters < 0 reads everything
+    QString extractSRTText(const QString& filePath, int maxCharacters);
+    QString extractASSText(const QString& filePath, int maxCharacters);
+    QString extractVTTText(const QString& filePath, int maxCharacters);
 
     // Network helpers
-    void setupNetworkManager();
+    QNetworkReply* postRequest(const QNetworkRequest& request, const QByteArray& data);
     QNetworkRequest createApiRequest(const QString& url, DetectionMethod method);
 
     // Member variables
     DetectionMethod m_method;
     QHash<DetectionMethod, QString> m_apiKeys;
-    QNetworkAccessManager* m_networkManager;
     QHash<QNetworkReply*, QString> m_pendingRequests; // Maps reply to identifier
 
-    // Language models for local detection
-    QHash<Language, QHash<QString, double>> m_ngramModels;
+    // Local detection
     bool m_modelsInitialized;
+    double m_minimumConfidence;
+
+    // Local results waiting on the cloud fallback, by identifier
+    QHash<QString, DetectionResult> m_fallbackResults;
+
+    // detectLanguageFromMultipleFiles() in progress
+    QHash<QString, DetectionResult> m_multipleResults;
+    QSet<QString> m_multiplePending;
 
-    // Common words for quick detection
-    QHash<Language, QStringList> m_commonWords;
-    QHash<Language, QStringList> m_characterSets;
+    static constexpr int DETECTION_SAMPLE_CHARACTERS = 65536;
 };
 
 } // namespace AI
@@ -4,7 +4,8 @@
 #include <QString>
 #include <QStringList>
 #include <QHash>
-#include <QNetworkAccessManager>
+#include <QSet>
+#include <QElapsedTimer>
 #include <QNetworkReply>
 #include <QTimer>
 
@@ -72,8 +73,11 @@ public:
         bool preserveTiming = true;
         bool translateSpeakerNames = false;
         int maxLineLength = 42;
-        int batchSize = 50;  // Number of lines to translate in one request
-        double requestDelay = 1.0;  // Delay between requests in seconds
+        int batchSize = 0;  // Most lines in one request, 0 uses the service limit
+        int maxRequestCharacters = 0;  // Text per request, 0 uses the service limit
+        int maxConcurrentRequests = 0;  // Requests in flight, 0 uses the service limit
+        double requestDelay = 0.0;  // Least time between request starts in seconds
+        bool useTranslationMemory = true;  // Reuse earlier translations of the same lines
     };
 
     struct TranslationProgress {
@@ -110,11 +114,34 @@ public:
     void translateTextBatch(const QStringList& texts, Language sourceLanguage = Auto,
                            Language targetLanguage = English, const QString& identifier = QString());
 
+    /**
+     * @brief Translate a subtitle file while it plays
+     *
+     * Cues are translated in small batches nearest the playback position
+     * first, upcoming ones before those already passed, and each is
+     * reported by cueTranslated() as soon as it is known. Lines found in the
+     * translation memory are reported without waiting for the service. The
+     * rest of the file fills in behind the playhead. Feed the position with
+     * setPlaybackPosition(); a seek re-prioritizes the cues not yet sent.
+     */
+    void startStreamingTranslation(const QString& inputPath, Language sourceLanguage = Auto,
+                                   Language targetLanguage = English);
+    void setPlaybackPosition(qint64 positionMs);
+    void stopStreamingTranslation();
+    bool isStreaming() const { return m_streaming; }
+
     // Progress and control
     bool isTranslating() const { return m_isTranslating; }
     TranslationProgress getProgress() const { return m_progress; }
     void cancelTranslation();
 
+    /**
+     * @brief Forget every remembered translation
+     *
+     * The memory is shared by all translators in the process.
+     */
+    static void clearTranslationMemory();
+
     // Supported languages
     QStringList getSupportedLanguages(TranslationService service) const;
     bool isLanguageSupported(Language language, TranslationService service) const;
@@ -138,6 +165,10 @@ signals:
     void batchTranslated(const QString& identifier, const QStringList& originalTexts,
                         const QStringList& translatedTexts);
 
+    // Streaming translation
+    void cueTranslated(int cueIndex, qint64 startMs, qint64 endMs, const QString& translatedText);
+    void streamingTranslationFinished();
+
 private slots:
     void handleNetworkReply();
     void processBatchQueue();
@@ -184,7 +215,7 @@ private:
     QString preserveFormatting(const QString& translatedText, const QString& originalText);
 
     // Network helpers
-    void setupNetworkManager();
+    QNetworkReply* postRequest(const QNetworkRequest& request, const QByteArray& data);
     QNetworkRequest createApiRequest(const QString& url, TranslationService service);
     void processTranslationResponse(const QByteArray& data, TranslationService service,
                                    const QString& identifier);
@@ -197,10 +228,73 @@ private:
         Language targetLanguage;
         QString identifier;
         QString filePath;
+        QList<int> cues;                // Streamed cue of each text
+    };
+
+    // Unique lines of a batch that missed the translation memory, one network request
+    struct PendingChunk {
+        int batchId = 0;
+        QStringList texts;
+        QList<QList<int>> positions;    // Where each line occurs in the batch
+        int throttledAttempts = 0;
+    };
+
+    // What one request to a service may carry, and how many may run at once
+    struct ServiceLimits {
+        int maxCharacters;              // 0 for no limit
+        int maxTexts;
+        int maxConcurrency;
+    };
+
+    // AIMD congestion window per service: grows with each success, halves on 429
+    struct FlowControl {
+        double window = 2.0;
+        qint64 backoffMs = 0;
+        qint64 pausedUntilMs = 0;       // On m_clock
+    };
+
+    struct PendingBatch {
+        BatchRequest request;
+        QString service;                // Memory keys, fixed when the batch starts
+        QString sourceCode;
+        QString targetCode;
+        QStringList translations;       // One per request text, empty until known
+        int outstandingChunks = 0;
     };
 
     void queueBatchRequest(const BatchRequest& request);
     void processBatchRequest(const BatchRequest& request);
+    void dispatchChunks();
+    void sendChunk(const QString& chunkKey);
+    void chunkThrottled(const QString& chunkKey, TranslationService service, qint64 retryAfterMs);
+    static ServiceLimits serviceLimits(TranslationService service);
+    int concurrencyLimit(TranslationService service) const;
+    FlowControl& flowControl(TranslationService service);
+    void completeChunk(const QString& chunkKey, const QStringList& translatedTexts, bool remember);
+    void failChunk(const QString& chunkKey, const QString& error);
+    void finishBatch(const PendingBatch& batch);
+
+    // Streaming
+    enum CueState : quint8 {
+        CuePending,
+        CueInFlight,
+        CueDone,
+        CueFailed
+    };
+
+    struct StreamCue {
+        qint64 startMs = 0;
+        qint64 endMs = 0;
+        CueState state = CuePending;
+    };
+
+    static qint64 parseCueTime(const QString& time);
+    void pumpStreaming();
+    QList<int> nextStreamCues(int count) const;
+    void reportStreamCues(const PendingBatch& batch);
+    void finishStreamBatch(const PendingBatch& batch);
+    void requeueUnsentStreamCues();
+    void endStreaming();
 
     // Member variables
     TranslationOptions m_options;
@@ -212,7 +306,6 @@ private:
     QString m_currentFilePath;
     
     // Network management
-    QNetworkAccessManager* m_networkManager;
     QHash<QNetworkReply*, QString> m_pendingRequests;
     QHash<QNetworkReply*, TranslationService> m_requestServices;
     
@@ -226,6 +319,36 @@ private:
     
     int m_currentBatchIndex;
     QStringList m_translatedBatches;
+
+    // Requests for translation memory misses, kept in flight up to the window
+    QHash<QString, PendingChunk> m_pendingChunks;
+    QHash<int, PendingBatch> m_pendingBatches;
+    QStringList m_chunkQueue;
+    QSet<QString> m_sentChunks;
+    QHash<TranslationService, FlowControl> m_flowControl;
+    QElapsedTimer m_clock;
+    qint64 m_lastRequestMs;
+    int m_nextBatchId;
+
+    // Streaming state, cues run parallel to m_currentEntries
+    bool m_streaming;
+    QVector<StreamCue> m_streamCues;
+    Language m_streamSourceLanguage;
+    Language m_streamTargetLanguage;
+    qint64 m_playbackPositionMs;
+    int m_streamBatchesInFlight;
+    int m_streamCuesLeft;               // Not yet done or failed
+    bool m_streamRestarted;             // Next batch is the small first one
+    bool m_pumpingStream;
+    
+    static constexpr int MAX_THROTTLED_ATTEMPTS = 6;
+    static constexpr qint64 MIN_BACKOFF_MS = 1000;
+    static constexpr qint64 MAX_BACKOFF_MS = 30000;
+
+    static constexpr int STREAM_FIRST_BATCH = 4;            // Cues, small so the first reply is quick
+    static constexpr int STREAM_BATCH = 32;
+    static constexpr int STREAM_BATCHES_IN_FLIGHT = 2;
+    static constexpr qint64 STREAM_SEEK_THRESHOLD_MS = 5000;
 };
 
 } // namespace AI
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <list>
+
+namespace EonPlay {
+namespace AI {
+
+/**
+ * @brief Persistent cache of translated subtitle lines
+ *
+ * Entries are keyed by a hash of the normalized source text (whitespace
+ * collapsed, case kept), the source and target language codes and the
+ * service, so a line is only sent to a translation service once per
+ * language pair. The memory is one JSON file, loaded on construction and
+ * written back by save() when something changed. Past the entry bound the
+ * least recently used lines are dropped.
+ */
+class TranslationMemory
+{
+public:
+    explicit TranslationMemory(const QString& directory = defaultDirectory(), int maxEntries = 200000);
+    ~TranslationMemory();
+
+    /**
+     * @brief Get the default memory directory
+     */
+    static QString defaultDirectory();
+
+    /**
+     * @brief Collapse whitespace the way lookups compare lines
+     */
+    static QString normalize(const QString& text);
+
+    /**
+     * @brief Find a stored translation and mark it as recently used
+     * @return False if the line was never translated with these settings
+     */
+    bool lookup(const QString& text, const QString& sourceLanguage, const QString& targetLanguage,
+                const QString& service, QString& translation);
+
+    void insert(const QString& text, const QString& sourceLanguage, const QString& targetLanguage,
+                const QString& service, const QString& translation);
+
+    int size() const { return static_cast<int>(m_entries.size()); }
+    void clear();
+
+    /**
+     * @brief Write the memory to disk if it changed since the last save
+     */
+    bool save();
+
+private:
+    struct Entry {
+        QString translation;
+        std::list<QByteArray>::iterator position;  // In m_order
+    };
+
+    static QByteArray key(const QString& text, const QString& sourceLanguage,
+                          const QString& targetLanguage, const QString& service);
+    void load();
+    void evict();
+
+    QString m_filePath;
+    int m_maxEntries;
+    QHash<QByteArray, Entry> m_entries;
+    std::list<QByteArray> m_order;          // Least recently used first
+    bool m_dirty = false;
+};
+
+} // namespace AI
+} // namespace EonPlay
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "IAISubtitleGenerator.h"
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QQueue>
+#include <QString>
+
+class QProcess;
+
+namespace EonPlay {
+namespace AI {
+
+/**
+ * @brief Splits audio on pauses and transcribes the pieces in parallel
+ *
+ * FFmpeg decodes the media to 16 kHz mono PCM on its stdout; the pipeline
+ * reads it as it arrives and runs a simple energy VAD over 30 ms frames
+ * against an adaptive noise floor. Once a chunk reaches the target length it
+ * is cut in the next pause, or at the quietest frame if none comes before
+ * the maximum length, so words are not split. Chunks without speech are
+ * skipped.
+ *
+ * Chunks go to a pool of Whisper processes, one per GPU or enough to share
+ * the CPU cores, and the results are shifted by the chunk offsets and
+ * released in timeline order. The first subtitles therefore appear once the
+ * first chunk, kept short on purpose, is done instead of after the whole
+ * file.
+ */
+class WhisperChunkPipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        QString whisperPath;
+        QString ffmpegPath = "ffmpeg";
+        QString modelSize = "base";
+        QString language;               // Empty to detect from the first chunk
+        bool useGPU = true;
+        int workers = 0;                // 0 picks one per GPU or per four cores
+        int firstChunkMs = 10000;
+        int targetChunkMs = 30000;
+        int maxChunkMs = 45000;
+        int minSilenceMs = 300;
+    };
+
+    explicit WhisperChunkPipeline(const Options& options, QObject* parent = nullptr);
+    ~WhisperChunkPipeline() override;
+
+    /**
+     * @brief Start decoding and transcribing
+     * @param workDirectory Chunk WAV and JSON files go here
+     */
+    void start(const QString& mediaPath, const QString& workDirectory);
+    void cancel();
+
+    bool isRunning() const { return m_running; }
+
+    /**
+     * @brief Share of the media released as subtitles, 0.0 - 1.0
+     */
+    double progress() const;
+
+    /**
+     * @brief Language Whisper reported, once known
+     */
+    QString detectedLanguage() const { return m_language; }
+
+    QList<SubtitleSegment> segments() const { return m_segments; }
+
+signals:
+    /**
+     * @brief A segment is final, emitted in timeline order
+     */
+    void segmentReady(const SubtitleSegment& segment);
+    void progressChanged(double progress, const QString& status);
+    void finished(bool success, const QString& errorMessage);
+
+private:
+    struct Chunk {
+        int index = 0;
+        qint64 startMs = 0;
+        qint64 durationMs = 0;
+        QString audioPath;
+    };
+
+    struct Worker {
+        QProcess* process = nullptr;
+        QList<Chunk> chunks;            // Being transcribed by this run
+        int gpu = -1;
+    };
+
+    // Decoding and segmentation
+    void onDecoderOutput();
+    void onDecoderError();
+    void onDecoderFinished();
+    void analyseFrame(const qint16* samples, int count);
+    void cutChunk(qint64 cutSample);
+    bool writeChunk(const Chunk& chunk, const QByteArray& pcm);
+
+    // Transcription
+    void dispatch();
+    void startWorker(int workerIndex, const QList<Chunk>& chunks);
+    void onWorkerFinished(int workerIndex);
+    QList<SubtitleSegment> readResult(const Chunk& chunk);
+    void release();
+    void stopProcesses();
+    void fail(const QString& error);
+    void finishIfDone();
+    static int defaultWorkerCount(bool useGPU, int gpuCount);
+
+    Options m_options;
+    QString m_workDirectory;
+    bool m_running = false;
+    bool m_decodeFinished = false;
+
+    QProcess* m_decoder = nullptr;
+    QByteArray m_decoderError;          // Tail of FFmpeg's stderr
+    qint64 m_durationMs = 0;
+
+    // VAD state, positions in samples from the start of the media
+    QByteArray m_pending;               // PCM of the chunk being collected
+    QByteArray m_partialFrame;
+    qint64 m_chunkStart = 0;
+    qint64 m_position = 0;
+    double m_noiseFloorDb = -60.0;
+    qint64 m_silenceStart = -1;
+    qint64 m_quietestSample = -1;
+    double m_quietestDb = 0.0;
+    bool m_chunkHasSpeech = false;
+    int m_nextIndex = 0;
+
+    QQueue<Chunk> m_ready;
+    QList<Worker> m_workers;
+    int m_gpuCount = 0;
+    QString m_language;
+
+    // Stitching
+    QMap<int, QList<SubtitleSegment>> m_results;    // Done, waiting for earlier chunks
+    QHash<int, qint64> m_chunkEnds;                 // Index to end in ms
+    int m_nextRelease = 0;
+    qint64 m_releasedMs = 0;
+    QList<SubtitleSegment> m_segments;
+
+    static constexpr int SAMPLE_RATE = 16000;
+    static constexpr int FRAME_SAMPLES = SAMPLE_RATE * 30 / 1000;
+    static constexpr double SPEECH_MARGIN_DB = 10.0;    // Above the noise floor
+    static constexpr double SILENCE_FLOOR_DB = -50.0;   // Always silence below this
+    static constexpr int MAX_CHUNKS_PER_RUN = 4;        // Amortizes model loading
+};
+
+} // namespace AI
+} // namespace EonPlay
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "IAISubtitleGenerator.h"
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+
+struct whisper_context;
+struct whisper_state;
+
+namespace EonPlay {
+namespace AI {
+
+/**
+ * @brief Whisper running in-process through whisper.cpp
+ *
+ * Models are loaded once per process and stay resident: every generator
+ * using the same model file and GPU shares one whisper_context, so the
+ * weights and the GPU context survive from one file to the next and across
+ * generator instances. Each generator keeps its own whisper_state, which
+ * lets several of them transcribe different files at the same time.
+ *
+ * Audio still comes from FFmpeg, but only decoding is spawned per file; the
+ * model is never reloaded. Segments are emitted through segmentProcessed()
+ * as whisper.cpp finalizes them.
+ *
+ * Built only when whisper.cpp is found (HAVE_WHISPER_CPP).
+ */
+class WhisperCppSubtitleGenerator : public IAISubtitleGenerator
+{
+    Q_OBJECT
+
+public:
+    explicit WhisperCppSubtitleGenerator(QObject* parent = nullptr);
+    ~WhisperCppSubtitleGenerator() override;
+
+    // IAISubtitleGenerator interface
+    bool initialize() override;
+    bool isAvailable() const override;
+    QStringList getSupportedFormats() const override;
+    QStringList getSupportedLanguages() const override;
+    bool generateSubtitles(const QString& mediaFilePath,
+                          const QString& targetLanguage,
+                          SubtitleGenerationResult& result) override;
+    bool generateSubtitlesFromAudio(const QByteArray& audioData,
+                                   int sampleRate,
+                                   int channels,
+                                   const QString& targetLanguage,
+                                   SubtitleGenerationResult& result) override;
+    void cancelGeneration() override;
+    double getProgress() const override;
+    QString getGeneratorName() const override;
+    QString getVersion() const override;
+
+    /**
+     * @brief Path of a ggml model file, e.g. ggml-base.bin
+     *
+     * Takes effect at the next initialize().
+     */
+    QString modelPath() const { return m_modelPath; }
+    void setModelPath(const QString& path);
+
+    bool useGPU() const { return m_useGPU; }
+    void setUseGPU(bool enabled);
+
+    int gpuDevice() const { return m_gpuDevice; }
+    void setGpuDevice(int device);
+
+    /**
+     * @brief CPU threads per transcription, 0 for all cores
+     */
+    int threads() const { return m_threads; }
+    void setThreads(int threads);
+
+    /**
+     * @brief Free resident models no generator is using
+     */
+    static void unloadIdleModels();
+
+private:
+    bool decodeMedia(const QString& mediaFilePath, QVector<float>& samples, QString& error);
+    bool transcribe(const QVector<float>& samples, const QString& targetLanguage,
+                    SubtitleGenerationResult& result);
+    static QVector<float> toMono16k(const QByteArray& audioData, int sampleRate, int channels);
+    void releaseModel();
+
+    // whisper.cpp callbacks, user data is the generator
+    static void onNewSegment(whisper_context* context, whisper_state* state, int newSegments, void* userData);
+    static void onProgress(whisper_context* context, whisper_state* state, int progress, void* userData);
+    static bool onAbort(void* userData);
+
+    QString m_modelPath;
+    QString m_modelKey;             // Of the model currently held
+    bool m_useGPU;
+    int m_gpuDevice;
+    int m_threads;
+
+    whisper_context* m_context;     // Shared, owned by the model cache
+    whisper_state* m_state;         // Ours, reused across files
+    QString m_ffmpegPath;
+
+    std::atomic<bool> m_isProcessing;
+    std::atomic<bool> m_cancelled;
+    std::atomic<int> m_progress;    // Percent
+    QList<SubtitleSegment> m_segments;
+    QString m_language;
+
+    static constexpr int SAMPLE_RATE = 16000;
+};
+
+} // namespace AI
+} // namespace EonPlay
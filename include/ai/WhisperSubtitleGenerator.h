@@ -1,6 +1,7 @@
 #pragma once
 
 #include "IAISubtitleGenerator.h"
+#include "WhisperChunkPipeline.h"
 #include <QProcess>
 #include <QTimer>
 #include <QTemporaryDir>
@@ -14,6 +15,8 @@ namespace AI {
  * 
  * Uses OpenAI Whisper for speech-to-text subtitle generation.
  * Supports both local Whisper installation and cloud-based processing.
+ * Local runs go through WhisperChunkPipeline, so segmentProcessed() starts
+ * arriving after the first chunk rather than at the end of the file.
  */
 class WhisperSubtitleGenerator : public IAISubtitleGenerator
 {
@@ -64,15 +67,15 @@ public:
     void setApiKey(const QString& key);
 
     int maxSegmentLength() const { return m_maxSegmentLength; }
-    void setMaxSegmentLength(int seconds);
+    void setMaxSegmentLength(int seconds);   // Also the audio chunk length
+
+    int workerCount() const { return m_workerCount; }
+    void setWorkerCount(int workers);        // 0 for one per GPU or per four cores
 
     double confidenceThreshold() const { return m_confidenceThreshold; }
     void setConfidenceThreshold(double threshold);
 
 private slots:
-    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
-    void onProcessError(QProcess::ProcessError error);
-    void onProcessOutput();
     void onProgressTimer();
 
 private:
@@ -81,7 +84,7 @@ private:
     bool checkWhisperInstallation();
     QString findWhisperExecutable();
     bool extractAudioFromMedia(const QString& mediaPath, QString& audioPath);
-    bool processWithLocalWhisper(const QString& audioPath, const QString& language);
+    bool processWithLocalWhisper(const QString& mediaPath, const QString& language);
     bool processWithCloudAPI(const QString& audioPath, const QString& language);
     SubtitleGenerationResult parseWhisperOutput(const QString& output);
     QList<SubtitleSegment> parseSegments(const QString& output);
@@ -97,14 +100,13 @@ private:
     bool m_useGPU;
     QString m_apiKey;
     int m_maxSegmentLength;
+    int m_workerCount;
     double m_confidenceThreshold;
 
     // Processing state
-    QProcess* m_process;
+    WhisperChunkPipeline* m_pipeline;
     QTimer* m_progressTimer;
     QTemporaryDir* m_tempDir;
-    QString m_currentAudioFile;
-    QString m_currentOutputFile;
     double m_currentProgress;
     bool m_isProcessing;
     bool m_isCancelled;
@@ -6,12 +6,17 @@
 #include <QString>
 #include <QStringList>
 #include <QMutex>
-#include <QTimer>
+#include <QHash>
+#include <atomic>
 #include <memory>
 #include <complex>
+#include "audio/STFTProcessor.h"
+#include "audio/LyricsTimeline.h"
+#include "audio/VocalSuppressor.h"
 
 // Forward declarations
 class AudioProcessor;
+class AudioTranscoder;
 
 // Type aliases for consistent complex number usage
 using ComplexF = std::complex<float>;
@@ -56,18 +61,9 @@ public:
     };
 
     /**
-     * @brief Lyrics line information
+     * @brief Lyrics line information, with word timing when the file has it
      */
-    struct LyricsLine {
-        qint64 startTime;         // Start time in milliseconds
-        qint64 endTime;           // End time in milliseconds
-        QString text;             // Lyrics text
-        QString translation;      // Translation (optional)
-        
-        LyricsLine() : startTime(0), endTime(0) {}
-        LyricsLine(qint64 start, qint64 end, const QString& txt) 
-            : startTime(start), endTime(end), text(txt) {}
-    };
+    using LyricsLine = LyricsTimeline::Line;
 
     /**
      * @brief Audio metadata information
@@ -258,10 +254,15 @@ public:
     // Format conversion
     /**
      * @brief Convert audio file format
+     * 
+     * Conversions are queued and run in the background, several at once
+     * on multi-core machines. Each reports conversionCompleted() when done;
+     * conversionProgressUpdated() reports the average of all pending ones.
+     * 
      * @param inputPath Input file path
      * @param outputPath Output file path
      * @param options Conversion options
-     * @return true if successful
+     * @return true if the conversion was queued
      */
     bool convertAudioFormat(const QString& inputPath, const QString& outputPath, 
                            const ConversionOptions& options);
@@ -285,7 +286,7 @@ public:
     int getConversionProgress() const;
 
     /**
-     * @brief Cancel ongoing conversion
+     * @brief Cancel all queued and running conversions
      */
     void cancelConversion();
 
@@ -302,6 +303,14 @@ public:
      */
     void setNoiseReductionSettings(const NoiseReductionSettings& settings);
 
+    /**
+     * @brief Bypass noise reduction without changing its settings
+     * 
+     * Follows the PowerPolicy, which drops the STFT while saving power.
+     */
+    void setNoiseReductionSuspended(bool suspended);
+    bool isNoiseReductionSuspended() const { return m_noiseReductionSuspended.load(std::memory_order_relaxed); }
+
     /**
      * @brief Apply noise reduction to audio buffer
      * @param leftChannel Left audio channel
@@ -310,8 +319,24 @@ public:
      */
     void applyNoiseReduction(QVector<float>& leftChannel, QVector<float>& rightChannel, int sampleRate);
 
+    /**
+     * @brief Prepare noise reduction for an upcoming sample rate
+     *
+     * Maps the learned noise profile onto the bin frequencies of the new
+     * rate ahead of time, so the first block at that rate only swaps it in
+     * and noise reduction carries on without relearning.
+     *
+     * @param sampleRate Sample rate of the next stream
+     */
+    void prepareForSampleRate(int sampleRate);
+
     /**
      * @brief Analyze noise profile
+     *
+     * The profile is also tracked continuously while noise reduction runs;
+     * this feeds a known noise excerpt into the same estimator. Empty
+     * buffers only report the current estimate.
+     *
      * @param leftChannel Left audio channel
      * @param rightChannel Right audio channel
      * @param sampleRate Sample rate
@@ -326,6 +351,15 @@ public:
      */
     void processAdvancedAudio(QVector<float>& leftChannel, QVector<float>& rightChannel, int sampleRate);
 
+    /**
+     * @brief Process a stereo block in place with all advanced features
+     * @param left Left channel samples
+     * @param right Right channel samples
+     * @param frames Samples per channel
+     * @param sampleRate Sample rate
+     */
+    void processAdvancedBlock(float* left, float* right, int frames, int sampleRate);
+
 signals:
     /**
      * @brief Emitted when karaoke mode changes
@@ -370,20 +404,10 @@ signals:
      */
     void noiseProfileAnalyzed(float noiseLevel);
 
-private slots:
-    void updateConversionProgress();
-
 private:
     // Karaoke processing methods
-    void applyVocalRemoval(QVector<float>& leftChannel, QVector<float>& rightChannel);
-    void applyVocalIsolation(QVector<float>& leftChannel, QVector<float>& rightChannel);
-    void applyCenterChannelExtraction(QVector<float>& leftChannel, QVector<float>& rightChannel);
-    void applyAdvancedVocalRemoval(QVector<float>& leftChannel, QVector<float>& rightChannel);
-
-    // Lyrics parsing methods
-    bool parseLRCFile(const QString& filePath);
-    bool parseSRTFile(const QString& filePath);
-    qint64 parseTimeString(const QString& timeStr) const;
+    void applySpectralKaraoke(float* leftChannel, float* rightChannel, int frames, int sampleRate);
+    void applyCenterChannelExtraction(float* leftChannel, float* rightChannel, int frames);
 
     // Metadata methods
     bool readID3Metadata(const QString& filePath, AudioMetadata& metadata) const;
@@ -392,17 +416,18 @@ private:
     bool writeFLACMetadata(const QString& filePath, const AudioMetadata& metadata);
 
     // Format conversion methods
-    bool convertToMP3(const QString& inputPath, const QString& outputPath, const ConversionOptions& options);
-    bool convertToFLAC(const QString& inputPath, const QString& outputPath, const ConversionOptions& options);
-    bool convertToWAV(const QString& inputPath, const QString& outputPath, const ConversionOptions& options);
-    bool convertToOGG(const QString& inputPath, const QString& outputPath, const ConversionOptions& options);
+    void updateConversionProgress(int jobId, int percent);
+    void onConversionFinished(int jobId, bool success, const QString& outputPath, const QString& error);
 
     // Noise reduction methods
-    void updateNoiseProfile(const QVector<float>& leftChannel, const QVector<float>& rightChannel);
-    void applySpectralSubtraction(QVector<float>& leftChannel, QVector<float>& rightChannel);
-    void applyWienerFilter(QVector<float>& leftChannel, QVector<float>& rightChannel);
-    void performFFT(const QVector<float>& input, QVector<ComplexF>& output);
-    void performIFFT(const QVector<ComplexF>& input, QVector<float>& output);
+    void applyNoiseReductionBlock(float* left, float* right, int frames, int sampleRate);
+    void adoptNoiseProfile(int sampleRate);
+    void processNoiseSpectrum(ComplexF* const* spectra, int channels, int bins);
+    void measureFramePower(const ComplexF* const* spectra, int channels, int bins);
+    void updateNoiseProfile(bool knownNoise);
+    void applySpectralSubtraction(int bins);
+    void applyWienerFilter(int bins);
+    float noiseLevelDb() const;
 
     // Audio processor integration
     AudioProcessor* m_audioProcessor;
@@ -410,51 +435,49 @@ private:
     // Karaoke settings
     KaraokeMode m_karaokeMode;
     float m_vocalRemovalStrength;
+    VocalSuppressor m_vocalSuppressor;
 
     // Audio tracks
     QVector<AudioTrackInfo> m_availableAudioTracks;
     AudioTrackInfo m_currentAudioTrack;
 
     // Lyrics
-    QVector<LyricsLine> m_lyricsLines;
+    mutable LyricsTimeline m_lyrics;
     int m_currentLyricsIndex;
 
     // Format conversion
+    AudioTranscoder* m_transcoder;
+    QHash<int, int> m_conversionJobs;   // Job id -> percent done
     int m_conversionProgress;
-    bool m_conversionCancelled;
-    QTimer* m_conversionTimer;
 
     // Noise reduction
     NoiseReductionSettings m_noiseReductionSettings;
-    QVector<float> m_noiseProfile;
-    QVector<float> m_noiseSpectrum;
+    std::atomic<bool> m_noiseReductionSuspended;
+    STFTProcessor m_noiseStft;           // Streaming analysis/resynthesis for playback
+    STFTProcessor m_noiseAnalysisStft;   // Analysis-only path for analyzeNoiseProfile()
+    QVector<float> m_noiseProfile;       // Noise power per bin
+    QVector<float> m_framePower;         // Mean channel power of the current frame
+    QVector<float> m_smoothedPower;      // Recursively smoothed frame power
+    QVector<float> m_cleanPower;         // Previous frame's estimated clean power
+    QVector<float> m_noiseGains;
+    int m_noiseFramesLearned;
+    int m_noiseSampleRate;
     bool m_noiseProfileReady;
-
-    // Processing state
-    struct VocalRemovalState {
-        QVector<float> delayLineL;
-        QVector<float> delayLineR;
-        int delayIndex;
-        float highpassState1L, highpassState2L;
-        float highpassState1R, highpassState2R;
-        
-        VocalRemovalState() : delayIndex(0), highpassState1L(0), highpassState2L(0),
-                             highpassState1R(0), highpassState2R(0) {
-            delayLineL.resize(1024);
-            delayLineR.resize(1024);
-            delayLineL.fill(0.0f);
-            delayLineR.fill(0.0f);
-        }
-    } m_vocalRemovalState;
+    QVector<float> m_preparedNoiseProfile;  // m_noiseProfile mapped to m_preparedNoiseSampleRate
+    int m_preparedNoiseSampleRate;          // 0 when nothing is prepared
 
     // Thread safety
     mutable QMutex m_processingMutex;
 
     // Constants
-    static constexpr int FFT_SIZE = 2048;
     static constexpr float VOCAL_FREQUENCY_MIN = 80.0f;   // Hz
     static constexpr float VOCAL_FREQUENCY_MAX = 8000.0f; // Hz
+    static constexpr float VOCAL_BASS_CUTOFF = 200.0f;    // Hz, kept by AdvancedVocalRemoval
     static constexpr float NOISE_GATE_THRESHOLD = -60.0f; // dB
+    static constexpr int NOISE_FRAME_SIZE = 1024;         // STFT frame, hop is a quarter
+    static constexpr int NOISE_LEARNING_FRAMES = 16;      // Frames before reduction starts
+    static constexpr float NOISE_RISE_RATE = 1.002f;      // Per-hop upward drift of the noise floor
+    static constexpr float NOISE_MIN_GAIN = 0.05f;        // Spectral floor (-26 dB)
 };
 
 #endif // ADVANCEDAUDIOPROCESSOR_H
\ No newline at end of file
@@ -0,0 +1,426 @@
+#ifndef AUDIODSPGRAPH_H
+#define AUDIODSPGRAPH_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMutex>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "audio/DriftCorrector.h"
+#include "audio/PolyphaseResampler.h"
+#include "audio/TripleBuffer.h"
+
+// Forward declarations
+class AudioEqualizer;
+class AdvancedAudioProcessor;
+class AudioProcessor;
+class AudioOutputManager;
+
+/**
+ * @brief Planar view of one block of audio flowing through the DSP graph
+ *
+ * Blocks rendered by AudioDSPGraph::render() start on ALIGNMENT-byte
+ * boundaries; those run by process() are aligned if the caller's buffers are.
+ */
+struct AudioBlock {
+    static constexpr int MAX_CHANNELS = 2;
+    static constexpr int ALIGNMENT = 32;
+
+    float* channels[MAX_CHANNELS];
+    int channelCount;
+    int frames;
+    int sampleRate;
+
+    AudioBlock() : channels{nullptr, nullptr}, channelCount(0), frames(0), sampleRate(44100) {}
+};
+
+/**
+ * @brief A processing stage in the real-time DSP graph
+ *
+ * process() runs on the audio thread and must not lock, allocate or block.
+ * prepare() is called from the control thread whenever the graph is
+ * compiled or a format change is announced, and is the place to size
+ * internal buffers and compute coefficients.
+ */
+class AudioDSPNode
+{
+public:
+    virtual ~AudioDSPNode() = default;
+
+    /**
+     * @brief Get a human-readable node name
+     */
+    virtual QString name() const = 0;
+
+    /**
+     * @brief Prepare internal state for a format (control thread)
+     * @param sampleRate Expected sample rate
+     * @param maxFrames Largest block that process() will receive
+     */
+    virtual void prepare(int sampleRate, int maxFrames)
+    {
+        Q_UNUSED(sampleRate)
+        Q_UNUSED(maxFrames)
+    }
+
+    /**
+     * @brief Process a block in place (audio thread)
+     * @param block Planar audio block
+     */
+    virtual void process(AudioBlock& block) = 0;
+
+    /**
+     * @brief Get the frames the node delays its output by (control thread)
+     */
+    virtual int latencyFrames() const { return 0; }
+
+    /**
+     * @brief Check whether the node is bypassed
+     */
+    bool isBypassed() const { return m_bypassed.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Bypass or re-enable the node without recompiling the graph
+     */
+    void setBypassed(bool bypassed) { m_bypassed.store(bypassed, std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> m_bypassed{false};
+};
+
+/**
+ * @brief Pull-based real-time audio DSP graph
+ *
+ * Nodes are registered on the control thread together with an ordering key
+ * and compiled into a fixed-capacity processing order. The compiled order is
+ * handed to the audio thread through a triple buffer, so the whole chain
+ * runs in one pass per block without locks or heap allocation. Removed
+ * nodes are kept alive until the audio thread has switched to a plan that
+ * no longer references them.
+ *
+ * With an internal sample rate set, render() converts source blocks at any
+ * other rate with a PolyphaseResampler, so the nodes always run at that
+ * rate and keep their filters and delay lines across tracks of mixed rates.
+ *
+ * For synchronized playback render() can hold the source back until a
+ * scheduled steady-clock time, starting on the exact sample, and trim the
+ * rate at which it consumes the chain's output through a DriftCorrector.
+ *
+ * The thread calling render() or process() is moved to real-time
+ * scheduling on its first block (ThreadPriority::Role::Audio).
+ */
+class AudioDSPGraph
+{
+public:
+    static constexpr int MAX_NODES = 16;
+    static constexpr int MAX_BLOCK_FRAMES = 1024;
+
+    /**
+     * @brief Well-known ordering keys for the built-in stages
+     */
+    enum StageOrder {
+        SourceStage = 0,
+        KaraokeStage = 100,
+        AdvancedStage = 200,
+        EqualizerStage = 300,
+        SpatialStage = 400,
+        PluginStage = 500,
+        OutputStage = 900
+    };
+
+    /**
+     * @brief Source callback used by render(); fills block.channels with up
+     *        to block.frames samples and returns the number written
+     */
+    using SourceCallback = std::function<int(AudioBlock& block)>;
+
+    AudioDSPGraph();
+    ~AudioDSPGraph();
+
+    AudioDSPGraph(const AudioDSPGraph&) = delete;
+    AudioDSPGraph& operator=(const AudioDSPGraph&) = delete;
+
+    // Control thread API
+
+    /**
+     * @brief Add a node; takes effect on the next compile()
+     * @param node Node to add
+     * @param order Ordering key (lower runs first, ties keep insertion order)
+     * @return Node id, or -1 if the graph is full
+     */
+    int addNode(std::shared_ptr<AudioDSPNode> node, int order);
+
+    /**
+     * @brief Remove a node; takes effect on the next compile()
+     * @param nodeId Id returned by addNode()
+     * @return true if the node existed
+     */
+    bool removeNode(int nodeId);
+
+    /**
+     * @brief Remove all nodes; takes effect on the next compile()
+     */
+    void clear();
+
+    /**
+     * @brief Set the source pulled by render()
+     * @param source Source callback, invoked on the audio thread
+     */
+    void setSource(SourceCallback source);
+
+    /**
+     * @brief Run the nodes at a fixed rate; takes effect on the next compile()
+     *
+     * render() then resamples sources at other rates to this rate. process()
+     * works in place and always runs at the rate it is given.
+     *
+     * @param sampleRate Internal rate in Hz, 0 to follow the source
+     */
+    void setInternalSampleRate(int sampleRate);
+    int internalSampleRate() const;
+
+    /**
+     * @brief Compile the processing order and publish it to the audio thread
+     * @param sampleRate Sample rate passed to AudioDSPNode::prepare(), unless
+     *        an internal rate is set
+     */
+    void compile(int sampleRate);
+
+    /**
+     * @brief Prepare the compiled nodes for an upcoming format
+     *
+     * Call on a track transition once the next track's format is known,
+     * before its audio reaches process(). Nodes build their state for that
+     * rate here and switch to it on the first block at the new rate, so the
+     * audio thread neither recomputes nor allocates at the transition. With
+     * an internal rate the nodes stay as they are and only the resampler
+     * for the new source rate is prepared.
+     *
+     * @param sampleRate Sample rate of the next stream
+     */
+    void prepareForFormat(int sampleRate);
+
+    /**
+     * @brief Start pulling the source at a steady-clock time
+     *
+     * render() outputs silence until then and starts the source on the
+     * output frame that falls on the time, as far as the time of the
+     * render() call predicts it. The render position restarts from zero.
+     *
+     * @param renderTimeNs std::chrono::steady_clock time in nanoseconds,
+     *        less the output latency so it is the time the frame is rendered
+     * @param outputSampleRate Rate at which render() is called
+     */
+    void scheduleStart(qint64 renderTimeNs, int outputSampleRate);
+
+    /**
+     * @brief Consume the chain's output slightly faster or slower than
+     *        render() is called for
+     *
+     * Keeps the stream locked to an external clock. The DriftCorrector is
+     * switched in the first time the ratio differs from 1.0 and stays in
+     * the path from then on, so its delay does not come and go.
+     *
+     * @param ratio Chain frames per output frame, within
+     *        DriftCorrector::MAX_TRIM of 1.0
+     */
+    void setRateTrim(double ratio);
+    double rateTrim() const { return m_rateTrim.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Media played by render() as of its latest call
+     */
+    struct RenderPosition {
+        double seconds = 0.0;       // Chain audio consumed since the scheduled start, at the call
+        qint64 timestampNs = 0;     // steady_clock time of the call, 0 before the first
+        bool started = false;       // false while waiting for a scheduled start
+    };
+
+    /**
+     * @brief Get the latest render position (one control thread only)
+     */
+    RenderPosition renderPosition();
+
+    /**
+     * @brief Get node names in compiled processing order
+     */
+    QStringList processingOrder() const;
+
+    /**
+     * @brief Get number of registered nodes
+     */
+    int nodeCount() const;
+
+    /**
+     * @brief Get the delay the compiled, non-bypassed nodes add together
+     */
+    int latencyFrames() const;
+
+    // Audio thread API
+
+    /**
+     * @brief Run the compiled chain in place over a planar stereo buffer
+     * @param left Left channel samples
+     * @param right Right channel samples (may equal left for mono)
+     * @param frames Samples per channel (any length, split internally)
+     * @param sampleRate Sample rate
+     */
+    void process(float* left, float* right, int frames, int sampleRate);
+
+    /**
+     * @brief Pull frames from the source, run the chain and write interleaved
+     *        stereo output, at the internal rate if one is set
+     * @param interleavedOutput Output buffer of frames * 2 samples
+     * @param frames Frames requested
+     * @return Frames produced, counting silence before a scheduled start
+     *         (the remainder is zero-filled)
+     */
+    int render(float* interleavedOutput, int frames);
+
+private:
+    struct NodeEntry {
+        int id;
+        int order;
+        int sequence;
+        std::shared_ptr<AudioDSPNode> node;
+    };
+
+    struct RetiredEntry {
+        quint64 generation;
+        std::shared_ptr<AudioDSPNode> node;
+        std::shared_ptr<SourceCallback> source;
+    };
+
+    struct CompiledPlan {
+        AudioDSPNode* nodes[MAX_NODES];
+        int nodeCount;
+        quint64 generation;
+        SourceCallback* source;
+        int internalSampleRate;
+
+        CompiledPlan() : nodes{}, nodeCount(0), generation(0), source(nullptr), internalSampleRate(0) {}
+    };
+
+    struct PreparedResampler {
+        std::shared_ptr<const PolyphaseResampler::FilterBank> bank;
+    };
+
+    const CompiledPlan& acquirePlan();
+    static void runPlan(const CompiledPlan& plan, AudioBlock& block);
+    bool renderBlock(const CompiledPlan& plan, int wanted);
+    int renderFrames(const CompiledPlan& plan, float* interleavedOutput, int frames);
+    void adoptResampler(int inputRate, int outputRate);
+    void collectRetired();
+
+    // Control thread state
+    mutable QMutex m_controlMutex;
+    QVector<NodeEntry> m_nodes;
+    QVector<std::shared_ptr<AudioDSPNode>> m_compiledNodes;
+    QVector<RetiredEntry> m_retired;
+    std::shared_ptr<SourceCallback> m_source;
+    std::shared_ptr<SourceCallback> m_compiledSource;
+    int m_nextNodeId;
+    int m_nextSequence;
+    quint64 m_generation;
+    int m_internalSampleRate;
+
+    // Hand-off to the audio thread
+    TripleBuffer<CompiledPlan> m_planBuffer;
+    std::atomic<quint64> m_activeGeneration;
+
+    // Filter banks for upcoming source rates
+    TripleBuffer<PreparedResampler> m_preparedResampler;
+
+    // Audio thread state for render(): the source block being consumed and
+    // the processed frames not yet written out
+    PolyphaseResampler m_resampler;
+    int m_resamplerInputRate;
+    int m_resamplerOutputRate;
+    int m_sourceSampleRate;
+    int m_inputOffset;
+    int m_inputFrames;
+    const float* m_outputLeft;
+    const float* m_outputRight;
+    int m_outputOffset;
+    int m_outputFrames;
+    int m_outputSampleRate;
+
+    // Synchronized playback: scheduled start, rate trim and the position
+    // published back to the control thread
+    std::atomic<qint64> m_scheduledStartNs;
+    std::atomic<int> m_scheduledSampleRate;
+    std::atomic<double> m_rateTrim;
+    DriftCorrector m_driftCorrector;
+    bool m_driftCorrecting;
+    bool m_waitingForStart;
+    qint64 m_startNs;
+    double m_renderSeconds;
+    TripleBuffer<RenderPosition> m_renderPosition;
+    alignas(AudioBlock::ALIGNMENT) float m_renderLeft[MAX_BLOCK_FRAMES];
+    alignas(AudioBlock::ALIGNMENT) float m_renderRight[MAX_BLOCK_FRAMES];
+    alignas(AudioBlock::ALIGNMENT) float m_resampledLeft[MAX_BLOCK_FRAMES];
+    alignas(AudioBlock::ALIGNMENT) float m_resampledRight[MAX_BLOCK_FRAMES];
+};
+
+/**
+ * @brief Graph node wrapping AudioEqualizer::processBlock()
+ */
+class EqualizerNode : public AudioDSPNode
+{
+public:
+    explicit EqualizerNode(std::shared_ptr<AudioEqualizer> equalizer);
+    QString name() const override;
+    void prepare(int sampleRate, int maxFrames) override;
+    void process(AudioBlock& block) override;
+
+private:
+    std::shared_ptr<AudioEqualizer> m_equalizer;
+};
+
+/**
+ * @brief Graph node wrapping AdvancedAudioProcessor::processAdvancedBlock()
+ */
+class AdvancedProcessorNode : public AudioDSPNode
+{
+public:
+    explicit AdvancedProcessorNode(std::shared_ptr<AdvancedAudioProcessor> processor);
+    QString name() const override;
+    void prepare(int sampleRate, int maxFrames) override;
+    void process(AudioBlock& block) override;
+
+private:
+    std::shared_ptr<AdvancedAudioProcessor> m_processor;
+};
+
+/**
+ * @brief Graph node wrapping AudioProcessor::processKaraokeBlock()
+ */
+class KaraokeNode : public AudioDSPNode
+{
+public:
+    explicit KaraokeNode(std::shared_ptr<AudioProcessor> processor);
+    QString name() const override;
+    void process(AudioBlock& block) override;
+
+private:
+    std::shared_ptr<AudioProcessor> m_processor;
+};
+
+/**
+ * @brief Graph node wrapping AudioOutputManager::processSpatialBlock()
+ */
+class SpatialSoundNode : public AudioDSPNode
+{
+public:
+    explicit SpatialSoundNode(std::shared_ptr<AudioOutputManager> outputManager);
+    QString name() const override;
+    void prepare(int sampleRate, int maxFrames) override;
+    void process(AudioBlock& block) override;
+
+private:
+    std::shared_ptr<AudioOutputManager> m_outputManager;
+};
+
+#endif // AUDIODSPGRAPH_H
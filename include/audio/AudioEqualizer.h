@@ -7,6 +7,9 @@
 #include <QSettings>
 #include <QMutex>
 #include <memory>
+#include <algorithm>
+#include "audio/BiquadCascade.h"
+#include "audio/TripleBuffer.h"
 
 // Forward declarations
 class AudioProcessor;
@@ -50,6 +53,18 @@ public:
             : frequency(freq), gain(g), bandwidth(bw) {}
     };
 
+    /**
+     * @brief Measured ReplayGain values of the current track
+     */
+    struct ReplayGainInfo {
+        bool hasTrackGain = false;
+        double trackGain = 0.0;     // dB
+        double trackPeak = 1.0;     // Linear true peak
+        bool hasAlbumGain = false;
+        double albumGain = 0.0;
+        double albumPeak = 1.0;
+    };
+
     explicit AudioEqualizer(QObject* parent = nullptr);
     ~AudioEqualizer() override;
 
@@ -218,6 +233,15 @@ public:
      */
     void setReplayGainPreamp(double preamp);
 
+    /**
+     * @brief Set the gains measured for the track about to play
+     * @param info Stored analysis, or a default value for an unanalyzed track
+     *
+     * The gain for the current mode is applied together with the preamp,
+     * limited so the track's peak does not clip.
+     */
+    void setReplayGainInfo(const ReplayGainInfo& info);
+
     /**
      * @brief Save current equalizer settings
      */
@@ -255,6 +279,27 @@ public:
      */
     void processAudio(QVector<float>& leftChannel, QVector<float>& rightChannel, int sampleRate);
 
+    /**
+     * @brief Process a stereo block in place (audio thread, lock-free)
+     * @param left Left channel samples
+     * @param right Right channel samples
+     * @param frames Samples per channel
+     * @param sampleRate Sample rate in Hz
+     */
+    void processBlock(float* left, float* right, int frames, int sampleRate);
+
+    /**
+     * @brief Prepare filters for an upcoming sample rate (control thread)
+     *
+     * Computes the cascade for the current bands at that rate ahead of
+     * time. The first block processed at the new rate takes the prepared
+     * coefficients over and keeps the filter state, instead of recomputing
+     * and resetting the filters on the audio thread.
+     *
+     * @param sampleRate Sample rate of the next stream in Hz
+     */
+    void prepareForSampleRate(int sampleRate);
+
     /**
      * @brief Get frequency response at given frequency
      * @param frequency Frequency in Hz
@@ -326,12 +371,12 @@ private:
     QVector<double> getPresetGains(PresetProfile preset) const;
     void clampGainValue(double& gain) const;
     
-    // Audio processing methods
+    // Audio processing methods (audio thread only)
     void initializeFilters(int sampleRate);
-    float processSample(float sample, int channel, int bandIndex);
+    bool adoptPreparedFilters(int sampleRate, int bandCount);
     void updateFilterCoefficients(int bandIndex, double frequency, double gain, double q);
-    void apply3DSurround(QVector<float>& leftChannel, QVector<float>& rightChannel);
-    void applyReplayGain(QVector<float>& leftChannel, QVector<float>& rightChannel, double gain);
+    void smoothBandGains();
+    void apply3DSurround(float* left, float* right, int frames, float strength);
     
     // Analysis methods
     void performFFT(const QVector<float>& input, QVector<float>& magnitude, QVector<float>& phase) const;
@@ -352,6 +397,7 @@ private:
     bool m_replayGainEnabled;
     QString m_replayGainMode;
     double m_replayGainPreamp;
+    ReplayGainInfo m_replayGainInfo;
 
     // Settings
     std::unique_ptr<QSettings> m_settings;
@@ -360,14 +406,59 @@ private:
     AudioProcessor* m_audioProcessor;
     int m_sampleRate;
     
-    // Filter states for each band and channel
-    struct FilterState {
-        double b0, b1, b2, a1, a2;  // Biquad coefficients
-        double x1, x2, y1, y2;      // Delay line states
-        FilterState() : b0(1), b1(0), b2(0), a1(0), a2(0), x1(0), x2(0), y1(0), y2(0) {}
+    /**
+     * @brief Snapshot of everything processAudio() needs
+     *
+     * Built on the UI thread by applyEqualizerSettings() and handed to the
+     * audio thread through a triple buffer, so setters never contend with
+     * audio processing.
+     */
+    struct ProcessingParameters {
+        bool enabled;
+        int bandCount;
+        double frequencies[BiquadCascade::MAX_STAGES];
+        double gains[BiquadCascade::MAX_STAGES];
+        double bandwidths[BiquadCascade::MAX_STAGES];
+        float broadbandGain;        // Bass boost, treble enhancement and ReplayGain
+        bool surroundEnabled;
+        float surroundStrength;
+        
+        ProcessingParameters() : enabled(false), bandCount(0), broadbandGain(1.0f),
+                                 surroundEnabled(false), surroundStrength(0.5f) {
+            std::fill(std::begin(frequencies), std::end(frequencies), 1000.0);
+            std::fill(std::begin(gains), std::end(gains), 0.0);
+            std::fill(std::begin(bandwidths), std::end(bandwidths), 1.0);
+        }
+    };
+    
+    TripleBuffer<ProcessingParameters> m_parameterBuffer;
+    ProcessingParameters m_activeParameters;      // Audio thread copy
+    
+    // Smoothed values the filters currently run with (audio thread)
+    double m_smoothedGains[BiquadCascade::MAX_STAGES];
+    double m_appliedFrequencies[BiquadCascade::MAX_STAGES];
+    double m_appliedBandwidths[BiquadCascade::MAX_STAGES];
+    float m_smoothedBroadbandGain;
+    
+    // Stereo biquad cascade, one stage per band
+    BiquadCascade m_cascade;
+    
+    /**
+     * @brief Cascade computed by prepareForSampleRate() for a coming rate,
+     *        with the band values it was computed for
+     */
+    struct PreparedFilters {
+        int sampleRate;
+        int bandCount;
+        double frequencies[BiquadCascade::MAX_STAGES];
+        double gains[BiquadCascade::MAX_STAGES];
+        double bandwidths[BiquadCascade::MAX_STAGES];
+        BiquadCascade cascade;
+        
+        PreparedFilters() : sampleRate(0), bandCount(0) {}
     };
     
-    QVector<QVector<FilterState>> m_filterStates; // [band][channel]
+    TripleBuffer<PreparedFilters> m_preparedFilters;
     
     // 3D Surround processing state
     struct SurroundState {
@@ -381,8 +472,8 @@ private:
         }
     } m_surroundState;
     
-    // Thread safety
-    mutable QMutex m_processingMutex;
+    // Serializes publishers; never taken by the audio thread
+    QMutex m_publishMutex;
     
     // Constants
     static constexpr int DEFAULT_BAND_COUNT = 10;
@@ -394,6 +485,10 @@ private:
     static constexpr double MAX_TREBLE_ENHANCEMENT = 12.0;
     static constexpr double PI = 3.14159265359;
     static constexpr int MAX_CHANNELS = 2;
+    static constexpr int ANALYSIS_FFT_SIZE = 4096;
+    static constexpr int SMOOTHING_BLOCK_SIZE = 64;   // Samples between gain updates
+    static constexpr double SMOOTHING_COEFFICIENT = 0.2; // Per-block approach factor
+    static constexpr double SMOOTHING_EPSILON_DB = 0.01;
 };
 
 #endif // AUDIOEQUALIZER_H
\ No newline at end of file
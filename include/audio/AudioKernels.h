@@ -0,0 +1,64 @@
+#ifndef AUDIOKERNELS_H
+#define AUDIOKERNELS_H
+
+/**
+ * @brief Vectorized building blocks for the audio hot loops
+ *
+ * Each kernel has scalar, SSE2, AVX2 and NEON versions. The best one the
+ * CPU supports is picked on first use: AVX2 when CPUID and the OS report
+ * it, otherwise the SSE2 or NEON baseline the build targets. Results match
+ * the scalar loops they replace up to float rounding; sumOfSquares()
+ * accumulates in double like the meters did.
+ *
+ * Pointers need no particular alignment. In-place use is fine where a
+ * kernel reads and writes the same buffers; distinct buffers must not
+ * overlap.
+ */
+namespace AudioKernels {
+
+enum class InstructionSet {
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON
+};
+
+InstructionSet activeInstructionSet();
+const char* instructionSetName(InstructionSet instructionSet);
+
+// samples[i] *= gain
+void applyGain(float* samples, int count, float gain);
+
+/**
+ * @brief Gain moving linearly from startGain towards endGain
+ *
+ * Sample i is scaled by startGain + (endGain - startGain) * (i + 1) / count,
+ * so the last sample gets endGain exactly and the next block can start
+ * from it without a step.
+ */
+void applyGainRamp(float* samples, int count, float startGain, float endGain);
+
+// destination[i] += source[i] * gain
+void mixInto(float* destination, const float* source, int count, float gain);
+
+// In place: left becomes mid (L + R) / 2, right becomes side (L - R) / 2
+void midSideEncode(float* left, float* right, int count);
+
+// In place: mid becomes left M + S, side becomes right M - S
+void midSideDecode(float* mid, float* side, int count);
+
+double sumOfSquares(const float* samples, int count);
+float peakAbsolute(const float* samples, int count);
+
+// Hard limit to [-limit, limit]
+void clamp(float* samples, int count, float limit);
+
+// Cubic soft clip, unity gain at 0 and reaching +-1 smoothly at +-1.5
+void softClip(float* samples, int count);
+
+void interleave(const float* left, const float* right, float* interleaved, int frames);
+void deinterleave(const float* interleaved, float* left, float* right, int frames);
+
+} // namespace AudioKernels
+
+#endif // AUDIOKERNELS_H
@@ -7,13 +7,26 @@
 #include <QAudioDevice>
 #include <QMediaDevices>
 #include <QMutex>
+#include <QHash>
+#include <QPointF>
+#include <atomic>
 #include <memory>
+#include "audio/DelayLine.h"
+#include "audio/PartitionedConvolver.h"
+#include "audio/TripleBuffer.h"
+#include "Metrics.h"
+
+class AudioOutputMonitor;
 
 /**
  * @brief Audio output device management system
  * 
  * Provides comprehensive audio output device selection, spatial sound simulation,
  * and A/V synchronization features for the media player.
+ * 
+ * Playback can also take a device exclusively (see ExclusiveAudioSink):
+ * the settings live here, and so does the status the sink reports back,
+ * including the latency it achieved.
  */
 class AudioOutputManager : public QObject
 {
@@ -59,6 +72,46 @@ public:
         DelayCompensation() : audioDelayMs(0), videoDelayMs(0), autoSync(false), syncTolerance(40.0f) {}
     };
 
+    /**
+     * @brief Measured behaviour of one output device
+     */
+    struct OutputStats {
+        QString deviceId;
+        QString deviceName;
+        int samples = 0;                // Latency samples taken
+        double latencyMs = 0.0;         // Smoothed end-to-end output latency
+        double minLatencyMs = 0.0;
+        double maxLatencyMs = 0.0;
+        double driftMsPerMinute = 0.0;  // Latency trend over the last minute
+        quint64 underruns = 0;
+        HistogramSnapshot bufferFill;   // Output buffer fill, microseconds
+    };
+
+    /**
+     * @brief Exclusive output settings
+     */
+    struct ExclusiveOutputSettings {
+        bool enabled = false;
+        QString deviceId;       // Backend device; empty for the current device. ALSA takes hw:CARD,DEV
+        int periodFrames = 0;   // Frames per device period; 0 for the smallest the device runs safely
+    };
+
+    /**
+     * @brief What the exclusive output achieved
+     */
+    struct ExclusiveOutputStatus {
+        bool active = false;            // Device held and playing
+        QString backend;                // ExclusiveAudioOutput::backendName()
+        QString deviceId;
+        int sampleRate = 0;
+        int channels = 0;
+        int bitsPerSample = 0;
+        int periodFrames = 0;
+        double latencyMs = 0.0;         // Device buffering and latency, plus the sink's queue
+        bool bitPerfect = false;        // Samples reach the device as decoded
+        quint64 underruns = 0;
+    };
+
     explicit AudioOutputManager(QObject* parent = nullptr);
     ~AudioOutputManager() override;
 
@@ -134,6 +187,15 @@ public:
      */
     void setHeadphoneSpatialSoundEnabled(bool enabled);
 
+    /**
+     * @brief Skip the HRTF convolution without changing the spatial settings
+     * 
+     * Follows the PowerPolicy: binaural rendering is the most expensive DSP
+     * in the chain and is dropped while saving power.
+     */
+    void setHrtfSuspended(bool suspended);
+    bool isHrtfSuspended() const { return m_hrtfSuspended.load(std::memory_order_relaxed); }
+
     /**
      * @brief Get headphone spatial sound strength
      * @return Strength level (0.0 to 1.0)
@@ -158,6 +220,24 @@ public:
      */
     void setRoomSize(float size);
 
+    /**
+     * @brief Load a head-related impulse response set for binaural rendering
+     * @param filePath HRIR WAV file (see HRIRSet::fromWavFile)
+     * @return true if the set was loaded
+     */
+    bool loadHRIRSet(const QString& filePath);
+
+    /**
+     * @brief Revert to the built-in spherical head HRIR set
+     */
+    void resetHRIRSet();
+
+    /**
+     * @brief Get name of the active HRIR set
+     * @return Set name
+     */
+    QString getHRIRSetName() const;
+
     /**
      * @brief Get delay compensation settings
      * @return Current delay compensation
@@ -212,6 +292,68 @@ public:
      */
     float detectSyncOffset();
 
+    /**
+     * @brief Start measuring the current device's output path
+     *
+     * Keeps a silent stream open on the device (see AudioOutputMonitor) and
+     * follows device changes. With auto sync enabled, latency drift since
+     * the audio delay was last set is compensated through the audio delay.
+     *
+     * @return true if the device could be opened
+     */
+    bool startOutputMonitoring();
+
+    /**
+     * @brief Stop measuring and close the silent stream
+     */
+    void stopOutputMonitoring();
+
+    /**
+     * @brief Check if the output path is being measured
+     * @return true if monitoring
+     */
+    bool isOutputMonitoringActive() const;
+
+    /**
+     * @brief Get measurements of a device
+     * @param deviceId Device ID; empty for the current device
+     * @return Statistics; samples is 0 if the device was never measured
+     */
+    OutputStats getOutputStats(const QString& deviceId = QString()) const;
+
+    /**
+     * @brief Get exclusive output settings
+     */
+    ExclusiveOutputSettings getExclusiveOutput() const;
+
+    /**
+     * @brief Set exclusive output settings
+     * 
+     * Applied by the ExclusiveAudioSink following this manager: enabling
+     * moves playback onto the device, a new device or period reopens it.
+     */
+    void setExclusiveOutput(const ExclusiveOutputSettings& settings);
+
+    /**
+     * @brief Get what the exclusive output achieved
+     */
+    ExclusiveOutputStatus getExclusiveOutputStatus() const;
+
+    /**
+     * @brief Record the exclusive output's status (any thread)
+     * 
+     * Called by the sink whenever it opens, closes or measures the device.
+     * While the device is held, the shared-path output monitor is stopped,
+     * as it would measure a path nothing plays through.
+     */
+    void reportExclusiveOutputStatus(const ExclusiveOutputStatus& status);
+
+    /**
+     * @brief Check whether processSpatialBlock() or the delay compensation change the audio
+     * @return false when audio may pass bit-perfect
+     */
+    bool isProcessingActive() const;
+
     /**
      * @brief Apply spatial sound processing to audio buffer
      * @param leftChannel Left audio channel
@@ -220,6 +362,26 @@ public:
      */
     void processSpatialSound(QVector<float>& leftChannel, QVector<float>& rightChannel, int sampleRate);
 
+    /**
+     * @brief Apply spatial sound processing to a stereo block in place
+     * @param left Left channel samples
+     * @param right Right channel samples
+     * @param frames Samples per channel
+     * @param sampleRate Sample rate
+     */
+    void processSpatialBlock(float* left, float* right, int frames, int sampleRate);
+
+    /**
+     * @brief Prepare spatial processing for an upcoming sample rate
+     *
+     * Allocates the delay lines and builds the binaural convolver for that
+     * rate off the audio thread. The first block processed at the new rate
+     * swaps them in rather than allocating and partitioning inline.
+     *
+     * @param sampleRate Sample rate of the next stream
+     */
+    void prepareForSampleRate(int sampleRate);
+
     /**
      * @brief Apply delay compensation to audio buffer
      * @param leftChannel Left audio channel
@@ -228,9 +390,25 @@ public:
      */
     void applyDelayCompensation(QVector<float>& leftChannel, QVector<float>& rightChannel, int sampleRate);
 
+    /**
+     * @brief Delay a stereo block in place by the audio delay
+     *
+     * Runs the stream through a preallocated fractional delay line, so
+     * the delay is continuous across blocks and changes glide or crossfade
+     * without clicks. Only positive delays can be applied to the audio;
+     * audio that is early needs the video delayed instead.
+     *
+     * @param left Left channel samples
+     * @param right Right channel samples
+     * @param frames Samples per channel
+     * @param sampleRate Sample rate
+     */
+    void applyDelayCompensationBlock(float* left, float* right, int frames, int sampleRate);
+
     /**
      * @brief Get current audio latency
-     * @return Latency in milliseconds
+     * @return Latency of the exclusive output while active, else the measured latency
+     *         of the current device in milliseconds, an estimate if not measured
      */
     float getCurrentLatency() const;
 
@@ -271,6 +449,36 @@ signals:
      */
     void syncOffsetDetected(float offsetMs);
 
+    /**
+     * @brief Emitted when the HRIR set changes
+     * @param name Name of the new set
+     */
+    void hrirSetChanged(const QString& name);
+
+    /**
+     * @brief Emitted after each measurement of the current device
+     * @param stats Updated statistics
+     */
+    void outputStatsUpdated(const OutputStats& stats);
+
+    /**
+     * @brief Emitted when the exclusive output settings change
+     * @param settings New settings
+     */
+    void exclusiveOutputChanged(const ExclusiveOutputSettings& settings);
+
+    /**
+     * @brief Emitted when the exclusive output reports a new status (reporting thread)
+     * @param status New status
+     */
+    void exclusiveOutputStatusChanged(const ExclusiveOutputStatus& status);
+
+    /**
+     * @brief Emitted when the current device underruns
+     * @param deviceId Device ID
+     */
+    void underrunDetected(const QString& deviceId);
+
 private slots:
     void onDevicesChanged();
 
@@ -278,9 +486,14 @@ private:
     void updateDeviceList();
     AudioDeviceInfo createDeviceInfo(const QAudioDevice& device) const;
     void initializeSpatialProcessing();
-    void applyCrossfeed(QVector<float>& leftChannel, QVector<float>& rightChannel, float strength);
-    void applyRoomSimulation(QVector<float>& leftChannel, QVector<float>& rightChannel, float roomSize);
-    void applyHRTF(QVector<float>& leftChannel, QVector<float>& rightChannel);
+    void applyCrossfeed(float* leftChannel, float* rightChannel, int frames, float strength);
+    void applyRoomSimulation(float* leftChannel, float* rightChannel, int frames, float roomSize);
+    void applyHRTF(float* leftChannel, float* rightChannel, int frames, int sampleRate);
+    void adoptPreparedSpatial(int sampleRate);
+    void restartOutputMonitor();
+    void onMonitorSample(double latencyMs, double bufferFillMs, qint64 elapsedMs);
+    void onMonitorUnderrun();
+    void compensateLatencyDrift(const OutputStats& stats);
 
     // Device management
     QVector<AudioDeviceInfo> m_availableDevices;
@@ -290,11 +503,13 @@ private:
     // Spatial sound settings
     SpatialSoundMode m_spatialSoundMode;
     bool m_headphoneSpatialEnabled;
+    std::atomic<bool> m_hrtfSuspended;
     float m_spatialStrength;
     float m_roomSize;
 
     // Delay compensation
     DelayCompensation m_delayCompensation;
+    std::atomic<int> m_audioDelayMs;    // Copy of m_delayCompensation.audioDelayMs for the audio thread
 
     // Spatial processing state
     struct SpatialState {
@@ -303,16 +518,57 @@ private:
         int delayIndex;
         float crossfeedGain;
         QVector<float> roomReflections;
+        DelayLine compensation;         // A/V sync delay
         
-        SpatialState() : delayIndex(0), crossfeedGain(0.3f) {
-            delayLineL.resize(4410); // 100ms at 44.1kHz
-            delayLineR.resize(4410);
-            roomReflections.resize(8820); // 200ms reflections
-            delayLineL.fill(0.0f);
-            delayLineR.fill(0.0f);
-            roomReflections.fill(0.0f);
+        explicit SpatialState(int sampleRate = 44100)
+            : delayIndex(0), crossfeedGain(0.3f), compensation(MAX_DELAY_MS * sampleRate / 1000) {
+            delayLineL.fill(0.0f, sampleRate / 10); // 100ms
+            delayLineR.fill(0.0f, sampleRate / 10);
+            roomReflections.fill(0.0f, sampleRate / 5); // 200ms reflections
         }
     } m_spatialState;
+    int m_spatialSampleRate;            // Rate m_spatialState is sized for (audio thread)
+
+    /**
+     * @brief Spatial state built by prepareForSampleRate() for a coming rate
+     *
+     * The audio thread swaps the prepared members with its own, so the
+     * replaced buffers are released by the next preparation rather than on
+     * the audio thread.
+     */
+    struct PreparedSpatial {
+        int sampleRate = 0;             // 0 once the state has been taken
+        SpatialState state;
+        int hrtfSampleRate = 0;         // 0 once the convolver has been taken
+        quint64 hrirGeneration = 0;
+        std::unique_ptr<PartitionedConvolver> hrtf;
+    };
+    TripleBuffer<PreparedSpatial> m_preparedSpatial;
+    QMutex m_prepareMutex;              // Serializes prepareForSampleRate()
+
+    // Binaural rendering
+    HRIRSet m_hrirSet;                                  // Set at its native rate; empty for the built-in model
+    std::unique_ptr<PartitionedConvolver> m_hrtfConvolver;
+    int m_hrtfSampleRate;
+    quint64 m_hrirGeneration;           // Bumped whenever m_hrirSet changes
+    mutable QMutex m_hrtfMutex;
+
+    // Output measurements, per device ID
+    struct DeviceMeasurement {
+        OutputStats stats;
+        std::unique_ptr<LatencyHistogram> bufferFill;
+        QVector<QPointF> trend;         // (minutes, latency ms), last DRIFT_WINDOW_SAMPLES
+    };
+    AudioOutputMonitor* m_outputMonitor;
+    QHash<QString, std::shared_ptr<DeviceMeasurement>> m_measurements;
+    QString m_monitoredDeviceId;
+    double m_compensationBaselineMs;    // Latency when the audio delay was last set; < 0 until measured
+    int m_compensationBaseDelayMs;      // Audio delay at that time
+
+    // Exclusive output
+    ExclusiveOutputSettings m_exclusiveSettings;
+    ExclusiveOutputStatus m_exclusiveStatus;
+    mutable QMutex m_exclusiveMutex;
 
     // Thread safety
     mutable QMutex m_deviceMutex;
@@ -321,7 +577,11 @@ private:
     static constexpr int MIN_DELAY_MS = -500;
     static constexpr int MAX_DELAY_MS = 500;
     static constexpr float DEFAULT_SYNC_TOLERANCE = 40.0f;
-    static constexpr int MAX_DELAY_SAMPLES = 22050; // 500ms at 44.1kHz
+    static constexpr float ESTIMATED_LATENCY_MS = 20.0f;
+    static constexpr double LATENCY_SMOOTHING = 0.1;
+    static constexpr int DRIFT_WINDOW_SAMPLES = 240;    // One minute at the default sample interval
+    static constexpr int MIN_COMPENSATION_SAMPLES = 8;
+    static constexpr int COMPENSATION_STEP_MS = 10;     // Smallest delay change applied
 };
 
 #endif // AUDIOOUTPUTMANAGER_H
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef AUDIOOUTPUTMONITOR_H
+#define AUDIOOUTPUTMONITOR_H
+
+#include <QObject>
+#include <QAudio>
+#include <QAudioDevice>
+#include <QAudioFormat>
+#include <QElapsedTimer>
+
+class QAudioSink;
+class QTimer;
+class SilenceSource;
+
+/**
+ * @brief Measures the output path of one audio device
+ *
+ * Keeps a silent stream open on the device and samples it periodically.
+ * Latency is the audio written to the stream minus what the audio backend
+ * reports as processed, i.e. everything queued between the application
+ * and the speaker as far as the backend knows, Bluetooth codec buffers
+ * included where the backend accounts for them. Buffer fill is the part
+ * of that held in the stream's own buffer. The stream pulls silence, so
+ * an underrun means the device was not fed in time, not that we ran out
+ * of data.
+ */
+class AudioOutputMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_SAMPLE_INTERVAL_MS = 250;
+    static constexpr int WARMUP_MS = 1000;             // Until the stream's buffers have filled
+
+    struct Sample {
+        qint64 elapsedMs = 0;       // Since start()
+        double latencyMs = 0.0;
+        double bufferFillMs = 0.0;
+    };
+
+    explicit AudioOutputMonitor(QObject* parent = nullptr);
+    ~AudioOutputMonitor() override;
+
+    /**
+     * @brief Open a silent stream on a device and start sampling it
+     * @return false if the device cannot be opened
+     */
+    bool start(const QAudioDevice& device, int sampleIntervalMs = DEFAULT_SAMPLE_INTERVAL_MS);
+    void stop();
+
+    bool isRunning() const { return m_sink != nullptr; }
+    QAudioDevice device() const { return m_device; }
+
+signals:
+    void sampled(const AudioOutputMonitor::Sample& sample);
+    void underrun();
+
+private:
+    void takeSample();
+    void onStateChanged(QAudio::State state);
+
+    QAudioDevice m_device;
+    QAudioFormat m_format;
+    QAudioSink* m_sink;
+    SilenceSource* m_source;
+    QTimer* m_sampleTimer;
+    QElapsedTimer m_clock;
+};
+
+#endif // AUDIOOUTPUTMONITOR_H
@@ -5,9 +5,13 @@
 #include <QString>
 #include <QVector>
 #include <QMap>
-#include <QTimer>
 #include <QMutex>
 #include <memory>
+#include "audio/LyricsTimeline.h"
+#include "audio/VocalSuppressor.h"
+
+class AudioTranscoder;
+class IMediaEngine;
 
 /**
  * @brief Advanced audio processing system
@@ -37,18 +41,9 @@ public:
     };
 
     /**
-     * @brief Lyrics line structure
+     * @brief Lyrics line structure, with word timing when the file has it
      */
-    struct LyricsLine {
-        qint64 startTime;    // Start time in milliseconds
-        qint64 endTime;      // End time in milliseconds
-        QString text;        // Lyrics text
-        QString translation; // Optional translation
-        
-        LyricsLine() : startTime(0), endTime(0) {}
-        LyricsLine(qint64 start, qint64 end, const QString& txt)
-            : startTime(start), endTime(end), text(txt) {}
-    };
+    using LyricsLine = LyricsTimeline::Line;
 
     /**
      * @brief Audio format conversion options
@@ -170,6 +165,16 @@ public:
      */
     void setKaraokeFrequencyRange(float lowFreq, float highFreq);
 
+    /**
+     * @brief Follow the playback position of a media engine
+     * 
+     * Lyrics are timed by the engine's interpolated clock while the
+     * processor is enabled and lyrics are loaded.
+     * 
+     * @param engine Media engine, or nullptr to detach
+     */
+    void setMediaEngine(std::shared_ptr<IMediaEngine> engine);
+
     // Lyrics Support
     /**
      * @brief Check if lyrics are available
@@ -287,11 +292,15 @@ public:
 
     /**
      * @brief Convert audio file format
+     * 
+     * Runs in the background; progress and the result are reported by
+     * conversionProgress() and conversionCompleted().
+     * 
      * @param inputPath Input file path
      * @param outputPath Output file path
      * @param targetFormat Target format
      * @param quality Quality level (0-100)
-     * @return true if successful
+     * @return true if the conversion was started
      */
     bool convertAudioFormat(const QString& inputPath, const QString& outputPath, 
                            AudioFormat targetFormat, int quality = 80);
@@ -345,6 +354,20 @@ public:
      */
     void setNoiseReductionStrength(float strength);
 
+    /**
+     * @brief Apply the current karaoke mode to a stereo block in place
+     * 
+     * Vocal removal and isolation work on the spectrum within the karaoke
+     * frequency range and delay the audio by VocalSuppressor::FRAME_SIZE
+     * samples.
+     * 
+     * @param leftChannel Left channel samples
+     * @param rightChannel Right channel samples
+     * @param frames Samples per channel
+     * @param sampleRate Sample rate in Hz
+     */
+    void processKaraokeBlock(float* leftChannel, float* rightChannel, int frames, int sampleRate = 44100);
+
 signals:
     /**
      * @brief Emitted when processor is enabled/disabled
@@ -373,10 +396,17 @@ signals:
 
     /**
      * @brief Emitted when current lyrics line changes
-     * @param line Current lyrics line
+     * @param line Current lyrics line, empty between lines
      */
     void currentLyricsChanged(const LyricsLine& line);
 
+    /**
+     * @brief Emitted when the sung word changes, for lines with word timing
+     * @param lineIndex Index of the line in getAllLyrics()
+     * @param wordIndex Index in the line's words, -1 before the first
+     */
+    void currentLyricsWordChanged(int lineIndex, int wordIndex);
+
     /**
      * @brief Emitted during audio conversion
      * @param progress Progress percentage (0-100)
@@ -403,13 +433,9 @@ signals:
      */
     void noiseReductionChanged(bool enabled, float strength);
 
-private slots:
-    void updateLyricsPosition();
-    void updateConversionProgress();
-
 private:
-    bool parseLRCFile(const QString& filePath);
-    bool parseSRTFile(const QString& filePath);
+    void updateLyricsPosition(qint64 position);
+    void updateLyricsSubscription();
     void processKaraokeAudio(QVector<float>& leftChannel, QVector<float>& rightChannel);
     void applyNoiseReduction(QVector<float>& audioData);
     AudioFormat detectAudioFormat(const QString& filePath) const;
@@ -424,11 +450,14 @@ private:
     float m_vocalRemovalStrength;
     float m_karaokeLowFreq;
     float m_karaokeHighFreq;
+    VocalSuppressor m_vocalSuppressor;
 
     // Lyrics data
-    QVector<LyricsLine> m_lyricsLines;
+    mutable LyricsTimeline m_lyrics;
     int m_currentLyricsIndex;
-    QTimer* m_lyricsTimer;
+    int m_currentLyricsWord;
+    std::shared_ptr<IMediaEngine> m_mediaEngine;
+    bool m_lyricsSubscribed;
 
     // Audio processing
     int m_audioDelay;
@@ -436,9 +465,10 @@ private:
     float m_noiseReductionStrength;
 
     // Conversion state
+    AudioTranscoder* m_transcoder;
+    int m_conversionJobId;
     bool m_conversionInProgress;
     int m_conversionProgress;
-    QTimer* m_conversionTimer;
 
     // Thread safety
     mutable QMutex m_dataMutex;
@@ -448,6 +478,7 @@ private:
     static constexpr float DEFAULT_KARAOKE_LOW_FREQ = 200.0f;
     static constexpr float DEFAULT_KARAOKE_HIGH_FREQ = 4000.0f;
     static constexpr float DEFAULT_NOISE_REDUCTION_STRENGTH = 0.3f;
+    static constexpr int LYRICS_UPDATE_INTERVAL_MS = 40;   // Fine enough for word highlighting
 };
 
 #endif // AUDIOPROCESSOR_H
\ No newline at end of file
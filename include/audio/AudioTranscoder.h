@@ -0,0 +1,122 @@
+#ifndef AUDIOTRANSCODER_H
+#define AUDIOTRANSCODER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QList>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+
+/**
+ * @brief Queue of audio file conversions run by ffmpeg
+ *
+ * Each job is one ffmpeg process that decodes, resamples and encodes as a
+ * stream through pipe-sized buffers, so memory stays flat whatever the
+ * file length. Encoders are limited to one thread and the queue runs one
+ * job per core, which keeps every core busy on batch conversions without
+ * oversubscribing them.
+ *
+ * Progress comes from ffmpeg's own counters (-progress): the output time
+ * reached against the input duration, and the bytes written so far.
+ * Output is written to a temporary file next to the target and renamed
+ * into place only when the encode succeeded.
+ */
+class AudioTranscoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Target of a conversion
+     */
+    struct Options {
+        QString format;             // mp3, flac, wav, ogg, aac or wma
+        int quality = -1;           // Format scale (VBR quality, FLAC level); -1 for the default
+        int bitrate = 0;            // kbit/s for constant-bitrate lossy output; 0 for the default
+        int sampleRate = 0;         // Hz; 0 keeps the source rate
+        int channels = 0;           // 0 keeps the source layout
+        bool preserveMetadata = true;
+    };
+
+    /**
+     * @brief Progress of a running job
+     */
+    struct Progress {
+        qint64 processedMs = 0;     // Output time reached
+        qint64 durationMs = 0;      // Input duration, 0 if unknown
+        qint64 outputBytes = 0;     // Bytes written so far
+        int percent = 0;
+    };
+
+    explicit AudioTranscoder(QObject* parent = nullptr);
+    ~AudioTranscoder() override;
+
+    /**
+     * @brief Check whether ffmpeg was found
+     */
+    bool isAvailable() const { return !m_ffmpegPath.isEmpty(); }
+
+    /**
+     * @brief Output formats accepted by Options::format
+     */
+    static QStringList supportedFormats();
+
+    /**
+     * @brief Queue a conversion
+     * @return Job id, or 0 if the job was rejected
+     */
+    int enqueue(const QString& inputPath, const QString& outputPath, const Options& options);
+
+    /**
+     * @brief Cancel a queued or running job
+     */
+    void cancel(int jobId);
+
+    /**
+     * @brief Cancel every job
+     */
+    void cancelAll();
+
+    int pendingJobs() const { return m_jobs.size(); }
+
+    /**
+     * @brief Limit the number of simultaneous encodes (default: one per core)
+     */
+    void setMaxConcurrentJobs(int jobs);
+
+signals:
+    void jobStarted(int jobId, const QString& inputPath);
+    void jobProgress(int jobId, const AudioTranscoder::Progress& progress);
+    void jobFinished(int jobId, bool success, const QString& outputPath, const QString& error);
+
+    /**
+     * @brief Emitted when the last pending job has finished
+     */
+    void queueFinished();
+
+private:
+    struct JobResult {
+        bool success = false;
+        QString error;
+    };
+
+    void onJobProgress(int jobId, const Progress& progress);
+    void onJobFinished(int jobId, const QString& outputPath, const JobResult& result);
+
+    static QStringList codecArguments(const Options& options);
+    static JobResult runJob(const QString& ffmpegPath, int jobId, const QString& inputPath,
+                            const QString& outputPath, const Options& options,
+                            const std::atomic<bool>& cancelled, AudioTranscoder* receiver);
+
+    QString m_ffmpegPath;
+    QThreadPool* m_pool;
+    QHash<int, std::shared_ptr<std::atomic<bool>>> m_jobs;     // Cancel flag of each pending job
+    int m_nextJobId;
+};
+
+Q_DECLARE_METATYPE(AudioTranscoder::Progress)
+
+#endif // AUDIOTRANSCODER_H
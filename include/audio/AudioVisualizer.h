@@ -3,9 +3,16 @@
 
 #include <QObject>
 #include <QVector>
+#include <QColor>
 #include <QTimer>
+#include <QThreadPool>
 #include <QMutex>
+#include <QElapsedTimer>
 #include <memory>
+#include <complex>
+#include <atomic>
+#include "audio/SPSCRingBuffer.h"
+#include "audio/TempoAnalyzer.h"
 
 /**
  * @brief Audio visualization system with spectrum analyzer and waveform display
@@ -57,6 +64,19 @@ public:
         SpectrumData() : peakFrequency(0.0f), peakMagnitude(0.0f) {}
     };
 
+    /**
+     * @brief Mood and color palette of the AI visualizer
+     * 
+     * Computed on a worker from band energies averaged over
+     * MOOD_INTERVAL_MS and published whole, so the mood and its palette
+     * always belong to the same analysis.
+     */
+    struct MoodAnalysis {
+        QString mood;
+        float confidence = 0.0f;        // 0.0 to 1.0
+        QVector<QColor> palette;
+    };
+
     explicit AudioVisualizer(QObject* parent = nullptr);
     ~AudioVisualizer() override;
 
@@ -83,6 +103,15 @@ public:
      */
     void setEnabled(bool enabled);
 
+    /**
+     * @brief Pause analysis while nothing shows it, without changing the enabled state
+     * 
+     * Audio keeps arriving in the frame ring, which drops what does not fit,
+     * so a resumed visualizer starts from the latest window.
+     */
+    void setSuspended(bool suspended);
+    bool isSuspended() const { return m_suspended; }
+
     /**
      * @brief Get current visualization mode
      * @return Current mode
@@ -132,6 +161,13 @@ public:
      */
     void setUpdateRate(int rate);
 
+    /**
+     * @brief Cap the update rate without changing the configured one; 0 for no cap
+     * 
+     * Follows the PowerPolicy's visualizer limit.
+     */
+    void setUpdateRateLimit(int rate);
+
     /**
      * @brief Get sensitivity level
      * @return Sensitivity (0.0 to 1.0)
@@ -198,6 +234,19 @@ public:
      */
     void processAudioSample(const AudioSample& sample);
 
+    /**
+     * @brief Queue audio for visualization (audio thread; never blocks or allocates)
+     *
+     * Frames go into a lock-free ring that the update timer drains, keeping
+     * only the most recent analysis window.
+     *
+     * @param left Left channel samples
+     * @param right Right channel samples (nullptr for mono)
+     * @param frames Samples per channel
+     * @param sampleRate Sample rate
+     */
+    void pushAudioFrames(const float* left, const float* right, int frames, int sampleRate);
+
     /**
      * @brief Get current spectrum data
      * @return Spectrum analysis data
@@ -240,6 +289,11 @@ public:
      */
     QVector<QColor> getAIColorPalette() const;
 
+    /**
+     * @brief Get the latest mood analysis; safe from any thread without locking
+     */
+    std::shared_ptr<const MoodAnalysis> getMoodAnalysis() const;
+
     /**
      * @brief Get beat detection information
      * @return Beat detection data
@@ -259,6 +313,18 @@ public:
      */
     BeatInfo getCurrentBeatInfo() const;
 
+    /**
+     * @brief Take beats from a precomputed grid instead of detecting them live
+     * @param grid Grid of the playing track; an invalid grid restores live detection
+     */
+    void setBeatGrid(const TempoAnalyzer::BeatGrid& grid);
+
+    /**
+     * @brief Report the playback position the beat grid is read against
+     * @param positionMs Position in milliseconds
+     */
+    void setPlaybackPosition(qint64 positionMs);
+
     /**
      * @brief Get music-driven animation parameters
      * @return Animation parameters based on audio analysis
@@ -351,12 +417,18 @@ private slots:
     void updatePeakHold();
 
 private:
+    void drainAudioFrames();
+    void updateTimers();
+    int effectiveUpdateRate() const;
+    void analyzeWindow(int sampleRate);
     void performFFT(const QVector<float>& input, QVector<float>& magnitudes, QVector<float>& phases);
+    void updateBandBinEdges(int sampleRate);
     void calculateVULevels(const QVector<float>& leftChannel, const QVector<float>& rightChannel);
     void updatePeakLevels(float leftLevel, float rightLevel);
     void applySmoothingToSpectrum(QVector<float>& magnitudes);
-    void detectMoodFromSpectrum(const SpectrumData& spectrum);
-    void generateAIColorPalette(const SpectrumData& spectrum);
+    void accumulateMoodBands(const SpectrumData& spectrum);
+    void publishMoodAnalysis(std::shared_ptr<const MoodAnalysis> analysis);
+    static MoodAnalysis analyzeMood(const QVector<float>& frequencies, const QVector<float>& bandEnergies);
     void detectBeat(const SpectrumData& spectrum);
     void calculateAnimationParams(const SpectrumData& spectrum);
     void updateBPMEstimation();
@@ -367,17 +439,29 @@ private:
 
     // Visualization state
     bool m_enabled;
+    bool m_suspended;
     VisualizationMode m_visualizationMode;
     int m_spectrumBandCount;
     int m_updateRate;
+    int m_updateRateLimit;
     float m_sensitivity;
     bool m_smoothingEnabled;
     float m_smoothingFactor;
     bool m_peakHoldEnabled;
     int m_peakHoldTime;
 
+    // Audio hand-off from the audio thread
+    struct StereoFrame {
+        float left;
+        float right;
+    };
+    SPSCRingBuffer<StereoFrame> m_frameRing;
+    std::atomic<int> m_ringSampleRate;
+    QVector<StereoFrame> m_drainBuffer;
+    QVector<float> m_windowLeft;   // Latest FFT_SIZE frames, oldest first
+    QVector<float> m_windowRight;
+
     // Audio data
-    AudioSample m_currentSample;
     SpectrumData m_currentSpectrum;
     QVector<float> m_leftWaveform;
     QVector<float> m_rightWaveform;
@@ -390,19 +474,33 @@ private:
     qint64 m_leftPeakTime;
     qint64 m_rightPeakTime;
 
+    // FFT work buffers and band-to-bin mapping
+    QVector<float> m_fftInput;
+    QVector<std::complex<float>> m_fftSpectrum;
+    QVector<int> m_bandBinEdges;
+    int m_bandSampleRate;
+
     // Smoothing buffers
     QVector<float> m_smoothedMagnitudes;
     QVector<float> m_previousMagnitudes;
 
-    // AI features
-    QString m_detectedMood;
-    float m_moodConfidence;
-    QVector<QColor> m_aiColorPalette;
+    // AI features: band energies summed per frame, analysed off-thread at a decimated rate
+    std::shared_ptr<const MoodAnalysis> m_moodAnalysis;    // Swapped with std::atomic_store
+    QThreadPool* m_moodPool;
+    QVector<float> m_moodBandSums;
+    int m_moodFrameCount;
+    QElapsedTimer m_moodClock;
+    bool m_moodAnalysisPending;
 
     // Beat detection
     BeatInfo m_currentBeatInfo;
     QVector<float> m_beatHistory;
     QVector<qint64> m_beatTimes;
+    QVector<qint64> m_beatIntervals;
+    TempoAnalyzer::BeatGrid m_beatGrid;
+    qint64 m_positionMs;
+    QElapsedTimer m_positionClock;     // Time since the last position report
+    double m_lastGridBeatMs;
     float m_lastEnergy;
     float m_averageEnergy;
 
@@ -425,6 +523,8 @@ private:
     static constexpr int DEFAULT_PEAK_HOLD_TIME = 1000;
     static constexpr int FFT_SIZE = 1024;
     static constexpr int WAVEFORM_SIZE = 256;
+    static constexpr int RING_CAPACITY = 16384;   // Frames, ~370ms at 44.1kHz
+    static constexpr int MOOD_INTERVAL_MS = 500;  // Mood and palette move over seconds
 };
 
 #endif // AUDIOVISUALIZER_H
\ No newline at end of file
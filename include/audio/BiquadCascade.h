@@ -0,0 +1,100 @@
+#ifndef BIQUADCASCADE_H
+#define BIQUADCASCADE_H
+
+#include <QString>
+
+/**
+ * @brief Block-based stereo biquad filter cascade
+ *
+ * Coefficients and filter state are kept in structure-of-arrays form with
+ * one lane per channel, so both channels of a stage are filtered together
+ * in a single SSE2/NEON register. Each stage sweeps a whole block before
+ * the next one runs, keeping its coefficients and state in registers.
+ * Stages with identity coefficients (flat EQ bands) are skipped.
+ */
+class BiquadCascade
+{
+public:
+    static constexpr int MAX_STAGES = 16;
+    static constexpr int BLOCK_SIZE = 256;
+
+    BiquadCascade();
+
+    /**
+     * @brief Get number of active stages
+     * @return Stage count
+     */
+    int stageCount() const { return m_stageCount; }
+
+    /**
+     * @brief Set number of stages; new stages start as identity filters
+     * @param count Stage count (0 to MAX_STAGES)
+     */
+    void setStageCount(int count);
+
+    /**
+     * @brief Set normalized (a0 == 1) coefficients for a stage
+     *
+     * A bypassed stage that becomes active again starts from cleared state.
+     */
+    void setCoefficients(int stage, double b0, double b1, double b2, double a1, double a2);
+
+    /**
+     * @brief Configure a stage as an RBJ peaking EQ filter
+     * @param stage Stage index
+     * @param sampleRate Sample rate in Hz
+     * @param frequency Centre frequency in Hz
+     * @param gainDb Gain in dB
+     * @param q Quality factor
+     */
+    void setPeakingEQ(int stage, double sampleRate, double frequency, double gainDb, double q);
+
+    /**
+     * @brief Take over the stage count and coefficients of another cascade
+     *
+     * Filter state of running stages is kept, so a cascade prepared
+     * elsewhere can replace the running filters without the discontinuity
+     * of a reset(). Added and un-bypassed stages start from cleared state.
+     *
+     * @param other Cascade to copy coefficients from
+     */
+    void copyCoefficients(const BiquadCascade& other);
+
+    /**
+     * @brief Clear filter state of all stages
+     */
+    void reset();
+
+    /**
+     * @brief Filter a stereo buffer in place
+     * @param left Left channel samples
+     * @param right Right channel samples
+     * @param frames Number of samples per channel
+     */
+    void process(float* left, float* right, int frames);
+
+    /**
+     * @brief Get name of the compiled-in vector backend
+     * @return "SSE2", "NEON" or "Scalar"
+     */
+    static QString simdBackend();
+
+private:
+    void processBlock(int frames);
+
+    // Coefficients and state, two lanes (L, R) per stage
+    alignas(16) double m_b0[MAX_STAGES * 2];
+    alignas(16) double m_b1[MAX_STAGES * 2];
+    alignas(16) double m_b2[MAX_STAGES * 2];
+    alignas(16) double m_a1[MAX_STAGES * 2];
+    alignas(16) double m_a2[MAX_STAGES * 2];
+    alignas(16) double m_z1[MAX_STAGES * 2];
+    alignas(16) double m_z2[MAX_STAGES * 2];
+    bool m_bypass[MAX_STAGES];
+    int m_stageCount;
+
+    // Interleaved L/R work block
+    alignas(16) double m_block[BLOCK_SIZE * 2];
+};
+
+#endif // BIQUADCASCADE_H
@@ -0,0 +1,138 @@
+#ifndef CROSSFADEMIXER_H
+#define CROSSFADEMIXER_H
+
+#include "audio/AudioDSPGraph.h"
+#include "audio/TripleBuffer.h"
+#include <QMutex>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+/**
+ * @brief Two-deck source for AudioDSPGraph with sample-accurate crossfades
+ *
+ * Set as the graph's source, the mixer plays one stream and on
+ * crossfadeTo() blends the next one in with equal-power gains, cos for the
+ * outgoing and sin for the incoming stream. The curves are evaluated at
+ * block boundaries and ramped linearly in between. The fade is counted in
+ * frames of the outgoing stream, so it starts on the requested frame and
+ * lasts exactly the requested length however the audio callbacks happen
+ * to be scheduled. The streams are mixed before the graph's nodes run,
+ * so the overlap costs one pass through the chain, not two.
+ *
+ * Positions count the frames pulled since a stream became current, from
+ * the start position it was given. With the outgoing stream's beat grid
+ * the fade starts on a beat and lasts a whole number of beats.
+ *
+ * Both streams must deliver the same sample rate during the overlap; if
+ * the incoming one does not, the mixer cuts over at the start frame.
+ *
+ * The setters belong to the control thread and never block the audio
+ * thread; pull() must not run concurrently with itself.
+ */
+class CrossfadeMixer
+{
+public:
+    using SourceCallback = AudioDSPGraph::SourceCallback;
+
+    struct Crossfade {
+        int fadeMs = 3000;
+        qint64 startMs = -1;            // Position in the current stream, -1 for the next block
+        qint64 nextStartMs = 0;         // Position the incoming stream starts from
+        double bpm = 0.0;               // Beat grid of the current stream, 0 for none
+        double firstBeatMs = 0.0;
+    };
+
+    CrossfadeMixer();
+
+    // Control thread API
+
+    /**
+     * @brief Play a stream from now on, dropping any fade in progress
+     */
+    void setSource(SourceCallback source, qint64 startMs = 0);
+
+    /**
+     * @brief Fade from the current stream to the next one
+     *
+     * A fade not started yet is replaced; one already running is cut short
+     * by dropping its incoming stream.
+     */
+    void crossfadeTo(SourceCallback next, const Crossfade& fade);
+
+    /**
+     * @brief True from crossfadeTo() until the incoming stream has taken over
+     */
+    bool isCrossfading();
+
+    /**
+     * @brief Callback to hand to AudioDSPGraph::setSource()
+     *
+     * The mixer must outlive the graph's use of it.
+     */
+    SourceCallback sourceCallback();
+
+    // Audio thread API
+
+    int pull(AudioBlock& block);
+
+private:
+    struct Plan {
+        quint64 serial = 0;
+        quint64 currentId = 0;          // Deck ids, 0 for none
+        SourceCallback* current = nullptr;
+        quint64 nextId = 0;
+        SourceCallback* next = nullptr;
+        qint64 startMs = 0;             // Start position of a new current stream
+        Crossfade fade;
+    };
+
+    struct Deck {
+        quint64 id;
+        std::shared_ptr<SourceCallback> source;
+    };
+
+    quint64 addDeckLocked(SourceCallback source);
+    SourceCallback* deckLocked(quint64 id) const;
+    void publishLocked(qint64 startMs, const Crossfade& fade);
+    void syncLocked();
+    void adoptPlan();
+    void armFade(int sampleRate);
+    int pullCrossfade(AudioBlock& block);
+    void promote();
+
+    // Control thread state
+    QMutex m_controlMutex;
+    QVector<Deck> m_decks;              // Kept until the audio thread can no longer use them
+    quint64 m_currentId;
+    quint64 m_nextId;
+    quint64 m_lastDeckId;
+    quint64 m_serial;
+
+    // Hand-off
+    TripleBuffer<Plan> m_planBuffer;
+    std::atomic<quint64> m_appliedSerial;
+    std::atomic<quint64> m_sharedPlayingId;
+    std::atomic<quint64> m_sharedIncomingId;
+
+    // Audio thread state
+    SourceCallback* m_playing;
+    quint64 m_playingId;
+    qint64 m_playingStartMs;
+    qint64 m_playedFrames;
+    SourceCallback* m_incoming;
+    quint64 m_incomingId;
+    qint64 m_incomingStartMs;
+    qint64 m_incomingFrames;
+    quint64 m_promotedFromId;           // Deck the last completed fade left
+    Crossfade m_fade;
+    bool m_fadeArmed;                   // Waiting for a block to learn the sample rate
+    qint64 m_fadeStartFrame;
+    qint64 m_fadeFrames;
+    qint64 m_fadePosition;
+
+    alignas(16) float m_incomingLeft[AudioDSPGraph::MAX_BLOCK_FRAMES];
+    alignas(16) float m_incomingRight[AudioDSPGraph::MAX_BLOCK_FRAMES];
+};
+
+#endif // CROSSFADEMIXER_H
@@ -0,0 +1,125 @@
+#ifndef DSPPLUGINNODE_H
+#define DSPPLUGINNODE_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include "audio/AudioDSPGraph.h"
+#include "audio/SPSCRingBuffer.h"
+#include "plugins/EonPlayDSPPlugin.h"
+
+class QLibrary;
+class SecurityManager;
+
+/**
+ * @brief AudioDSPGraph node running a native plugin built against EonPlayDSPPlugin.h
+ *
+ * The plugin processes the graph's own block in place: render() blocks are
+ * aligned as the ABI promises and are handed over as they are. Blocks that
+ * arrive unaligned, which only process() with caller buffers can produce,
+ * go through an aligned staging buffer.
+ *
+ * prepare() creates and prepares a fresh plugin instance for the format;
+ * the audio thread adopts it on the first block at that rate, so the
+ * instance playing is never called from the control thread. Parameter
+ * changes are queued without locks and delivered with the next block.
+ */
+class DSPPluginNode : public AudioDSPNode
+{
+public:
+    static constexpr int PARAMETER_QUEUE_SIZE = 256;
+    static constexpr int MAX_PARAMETERS = 128;
+    static constexpr int MAX_PARAMETER_CHANGES = 64;   // Delivered per block, the rest wait
+    static constexpr int RETIRED_QUEUE_SIZE = 8;
+
+    struct Parameter {
+        quint32 id = 0;
+        QString name;
+        float minValue = 0.0f;
+        float maxValue = 1.0f;
+        float defaultValue = 0.0f;
+    };
+
+    /**
+     * @brief Load a plugin library (control thread)
+     *
+     * The library is only loaded if the SecurityManager finds its signature
+     * valid or it was trusted by the user. Both answers are cached by the
+     * manager until the file changes.
+     *
+     * @param path Plugin library path
+     * @param security Security manager vouching for the file
+     * @param errorMessage Receives the reason on failure, may be null
+     * @return The node, or nullptr if the plugin was refused or is invalid
+     */
+    static std::shared_ptr<DSPPluginNode> load(const QString& path, SecurityManager* security,
+                                               QString* errorMessage = nullptr);
+
+    ~DSPPluginNode() override;
+
+    DSPPluginNode(const DSPPluginNode&) = delete;
+    DSPPluginNode& operator=(const DSPPluginNode&) = delete;
+
+    QString pluginId() const;
+    QString vendor() const;
+    QString path() const;
+    QVector<Parameter> parameters() const;
+
+    /**
+     * @brief Change a parameter (one control thread)
+     * @return false if the id is unknown or the queue is full
+     */
+    bool setParameter(quint32 id, float value);
+    float parameter(quint32 id) const;
+
+    // AudioDSPNode interface
+    QString name() const override;
+    void prepare(int sampleRate, int maxFrames) override;
+    void process(AudioBlock& block) override;
+    int latencyFrames() const override;
+
+private:
+    struct Instance {
+        void* handle;
+        int sampleRate;
+        int maxFrames;
+        int latencyFrames;
+    };
+
+    DSPPluginNode(std::unique_ptr<QLibrary> library, const EonPlayDspDescriptor* descriptor, const QString& path);
+
+    void destroyInstance(Instance* instance);
+    void collectRetired();
+
+    /**
+     * @brief Collect the changes for a block: every value for a new instance, then the queue
+     */
+    int takeParameterChanges(bool snapshot);
+
+    std::unique_ptr<QLibrary> m_library;
+    const EonPlayDspDescriptor* m_descriptor;
+    QString m_path;
+    QVector<Parameter> m_parameters;
+    QHash<quint32, int> m_parameterIndex;
+
+    // Current values, written by the control thread and read on instance changes
+    std::unique_ptr<std::atomic<float>[]> m_values;
+    SPSCRingBuffer<EonPlayDspParameterChange> m_parameterQueue;
+
+    // Instance hand-off: the control thread publishes one, the audio thread
+    // adopts it and retires the previous one for the control thread to destroy
+    std::atomic<Instance*> m_pending;
+    SPSCRingBuffer<Instance*> m_retired;
+    std::atomic<int> m_latencyFrames;
+    int m_preparedRate;
+    int m_preparedFrames;
+
+    // Audio thread state
+    Instance* m_current;
+    EonPlayDspParameterChange m_changes[MAX_PARAMETERS + MAX_PARAMETER_CHANGES];
+    QVector<float> m_staging;               // Aligned copies of unaligned blocks
+};
+
+#endif // DSPPLUGINNODE_H
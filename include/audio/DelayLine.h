@@ -0,0 +1,61 @@
+#ifndef DELAYLINE_H
+#define DELAYLINE_H
+
+#include <QVector>
+
+/**
+ * @brief Stereo circular delay line with a fractional, live-adjustable delay
+ *
+ * Delays a stream in place by up to the capacity given at construction,
+ * at constant cost per sample and without allocating. Fractional delays
+ * are read with 4-point Hermite interpolation, linear below one frame.
+ *
+ * A delay change of up to GLIDE_LIMIT frames is reached by gliding the
+ * read position GLIDE_STEP frames per frame, an inaudible 0.2% pitch
+ * change, so drift compensation can nudge the delay continuously. Larger
+ * changes crossfade from the old read position to the new one over
+ * CROSSFADE_FRAMES. Neither clicks.
+ *
+ * Not thread-safe; the constructor allocates and belongs to the control
+ * thread, everything else to the audio thread.
+ */
+class DelayLine
+{
+public:
+    static constexpr double GLIDE_STEP = 0.002;
+    static constexpr double GLIDE_LIMIT = 64.0;
+    static constexpr int CROSSFADE_FRAMES = 1024;
+
+    explicit DelayLine(int maxDelayFrames = 0);
+
+    /**
+     * @brief Set the delay to move to
+     * @param frames Clamped to 0 and the capacity
+     */
+    void setDelay(double frames);
+    double delay() const { return m_delay; }
+    double targetDelay() const { return m_target; }
+    int maxDelay() const { return m_maxDelay; }
+
+    /**
+     * @brief Clear the history and jump to the target delay
+     */
+    void reset();
+
+    void process(float* left, float* right, int frames);
+
+private:
+    float read(const QVector<float>& line, double delay) const;
+
+    QVector<float> m_left;
+    QVector<float> m_right;
+    int m_mask;                         // Size - 1, sizes are powers of two
+    int m_write;                        // Index of the newest frame
+    int m_maxDelay;
+    double m_delay;
+    double m_target;
+    double m_fadeFrom;                  // Read delay being faded out
+    int m_fadeRemaining;
+};
+
+#endif // DELAYLINE_H
@@ -0,0 +1,76 @@
+#ifndef DRIFTCORRECTOR_H
+#define DRIFTCORRECTOR_H
+
+#include <QtGlobal>
+#include <memory>
+#include "audio/PolyphaseResampler.h"
+
+/**
+ * @brief Stereo resampler for ratios a fraction of a percent from 1:1
+ *
+ * Keeps a stream locked to a clock other than the one pulling it, by
+ * consuming slightly more or fewer input frames than it writes. The output
+ * is evaluated at a continuously moving fractional delay: the 1:PHASES
+ * polyphase bank of PolyphaseResampler gives the windowed-sinc taps at the
+ * two nearest phases, and the two dot products are interpolated linearly,
+ * so the ratio can change on every block without clicks.
+ *
+ * Not thread-safe; setRatio(), reset() and process() belong to the audio
+ * thread. The constructor fetches the filter bank and belongs to the
+ * control thread.
+ */
+class DriftCorrector
+{
+public:
+    static constexpr int PHASES = 256;
+    static constexpr int TAPS = PolyphaseResampler::TAPS_PER_PHASE;
+    static constexpr double MAX_TRIM = 0.005;   // Either side of 1.0, far beyond crystal tolerances
+
+    DriftCorrector();
+
+    /**
+     * @brief Set input frames consumed per output frame
+     * @param ratio Near 1.0, clamped to MAX_TRIM either side
+     */
+    void setRatio(double ratio);
+    double ratio() const { return m_step; }
+
+    /**
+     * @brief Clear the input history
+     */
+    void reset();
+
+    /**
+     * @brief Delay in input samples: half the filter plus the newer window's
+     *        extra sample and the one output made before any input
+     */
+    int latency() const { return TAPS / 2 + 2; }
+
+    /**
+     * @brief Convert planar input to interleaved stereo output
+     * @param inputLeft Left input samples
+     * @param inputRight Right input samples
+     * @param inputFrames Input frames available
+     * @param interleavedOutput Output buffer of outputFrames * 2 samples
+     * @param outputFrames Output frames wanted
+     * @param consumed Receives the input frames used
+     * @return Output frames written; fewer than wanted once the input runs out
+     */
+    int process(const float* inputLeft, const float* inputRight, int inputFrames,
+                float* interleavedOutput, int outputFrames, int* consumed);
+
+private:
+    void push(float left, float right);
+
+    std::shared_ptr<const PolyphaseResampler::FilterBank> m_bank;
+    double m_step;                      // Input frames per output frame
+    double m_position;                  // Next output between the two history windows, 0 to 1
+    int m_historyIndex;
+
+    // TAPS + 1 samples, each written twice so both the older and the newer
+    // TAPS-sample window are contiguous from m_historyIndex
+    alignas(16) float m_historyLeft[(TAPS + 1) * 2];
+    alignas(16) float m_historyRight[(TAPS + 1) * 2];
+};
+
+#endif // DRIFTCORRECTOR_H
@@ -0,0 +1,120 @@
+#ifndef EXCLUSIVEAUDIOOUTPUT_H
+#define EXCLUSIVEAUDIOOUTPUT_H
+
+#include <QString>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+/**
+ * @brief Audio output that takes a device for itself, past the system mixer
+ *
+ * The native backends are WASAPI in exclusive, event-driven mode on
+ * Windows, ALSA hw devices on Linux and CoreAudio on macOS with the
+ * device hogged and its physical format set. Each opens the device in
+ * exactly the format asked for or not at all, so samples reach the
+ * converter as they were written: no shared mixer, no resampling and no
+ * system volume on the way, and only the device's own buffering between.
+ *
+ * open() and close() run on a control thread. The render callback runs on
+ * a real-time thread the backend owns, once per period, and must fill
+ * every frame without locking, allocating or blocking.
+ */
+class ExclusiveAudioOutput
+{
+public:
+    /**
+     * @brief Sample layout; 24-bit audio travels left-justified in Int32
+     */
+    enum class SampleType {
+        Int16,
+        Int32,
+        Float32
+    };
+
+    struct Format {
+        int sampleRate = 0;
+        int channels = 0;
+        SampleType sampleType = SampleType::Int32;
+
+        int bytesPerSample() const { return sampleType == SampleType::Int16 ? 2 : 4; }
+        int bytesPerFrame() const { return channels * bytesPerSample(); }
+        bool isValid() const { return sampleRate > 0 && channels > 0; }
+
+        bool operator==(const Format& other) const
+        {
+            return sampleRate == other.sampleRate && channels == other.channels && sampleType == other.sampleType;
+        }
+        bool operator!=(const Format& other) const { return !(*this == other); }
+    };
+
+    /**
+     * @brief Fill interleaved frames in the open format (render thread)
+     */
+    using RenderCallback = std::function<void(char* data, int frames)>;
+
+    /**
+     * @brief Create the backend of the current platform
+     * @return Backend, or nullptr where there is none
+     */
+    static std::unique_ptr<ExclusiveAudioOutput> create();
+
+    virtual ~ExclusiveAudioOutput() = default;
+
+    virtual QString backendName() const = 0;
+
+    /**
+     * @brief Take the device in exactly one format
+     * @param deviceId Device ID as listed by AudioOutputManager; empty for the default
+     * @param format Format to run the device in
+     * @param periodFrames Frames per period; 0 for the smallest the device runs safely
+     * @return false if the device is in use or cannot run the format
+     */
+    virtual bool open(const QString& deviceId, const Format& format, int periodFrames) = 0;
+
+    /**
+     * @brief Stop and give the device back
+     */
+    virtual void close() = 0;
+
+    /**
+     * @brief Start pulling periods through a render callback
+     */
+    virtual bool start(RenderCallback render) = 0;
+    virtual void stop() = 0;
+
+    /**
+     * @brief Open the device in the format closest to a preferred one
+     *
+     * Tries the format itself, then the other sample types, then the
+     * common rates, then stereo. Only the first is bit-perfect.
+     *
+     * @return Format opened; invalid if the device took none
+     */
+    Format openNearest(const QString& deviceId, const Format& preferred, int periodFrames);
+
+    bool isOpen() const { return m_format.isValid(); }
+    Format format() const { return m_format; }
+    int periodFrames() const { return m_periodFrames; }
+
+    /**
+     * @brief Time from the render callback to the converter, in milliseconds
+     *
+     * The periods the backend keeps queued plus the latency the device
+     * reports for itself.
+     */
+    double latencyMs() const { return m_latencyMs; }
+
+    /**
+     * @brief Periods the device played before the render callback filled them
+     */
+    quint64 underruns() const { return m_underruns.load(std::memory_order_relaxed); }
+
+protected:
+    Format m_format;                        // Invalid while closed
+    int m_periodFrames = 0;
+    double m_latencyMs = 0.0;
+    std::atomic<quint64> m_underruns{0};
+};
+
+#endif // EXCLUSIVEAUDIOOUTPUT_H
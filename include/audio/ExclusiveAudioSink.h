@@ -0,0 +1,112 @@
+#ifndef EXCLUSIVEAUDIOSINK_H
+#define EXCLUSIVEAUDIOSINK_H
+
+#include <QObject>
+#include <QMap>
+#include <QMutex>
+#include <QPointer>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include "audio/ExclusiveAudioOutput.h"
+#include "media/VLCBackend.h"
+
+class AudioOutputManager;
+class QTimer;
+
+/**
+ * @brief Plays VLCBackend's audio on a device held through ExclusiveAudioOutput
+ *
+ * Follows the exclusive output settings of an AudioOutputManager: once
+ * enabled, it becomes the backend's AudioOutput and every player hands it
+ * decoded samples through libVLC's audio callbacks. Each player queues
+ * into its own SPSCRingBuffer and the device's render thread drains the
+ * active player's queue, so a preloaded player can fill its queue ahead
+ * without being heard. Only the active player reaches the device; a
+ * crossfade becomes a cut.
+ *
+ * When a player's format is announced, the device is opened in that very
+ * format if it takes it and libVLC is asked to deliver it unconverted.
+ * With the manager's processing off and the volume at 100%, samples then
+ * reach the device bit for bit. Formats the device refuses are converted
+ * by libVLC to the nearest it accepts. With spatial processing or a delay
+ * active, the audio is delivered as float stereo, run through the
+ * manager's spatial and delay blocks on the render thread and converted
+ * to the device's format; whether processing applies is decided per track.
+ * A player becoming active in a different format reopens the device.
+ *
+ * The status, achieved latency included, is reported to the manager once
+ * per second, and the active player's audio is advanced by that latency.
+ */
+class ExclusiveAudioSink : public QObject, public VLCBackend::AudioOutput
+{
+    Q_OBJECT
+
+public:
+    static constexpr int QUEUE_MS = 100;                // Per player, ahead of the device
+    static constexpr int STATUS_INTERVAL_MS = 1000;
+    static constexpr int MIN_DELAY_CHANGE_US = 5000;    // Smallest latency compensation change applied
+
+    ExclusiveAudioSink(std::shared_ptr<AudioOutputManager> manager, VLCBackend* backend, QObject* parent = nullptr);
+    ~ExclusiveAudioSink() override;
+
+    /**
+     * @brief Check whether the device is held
+     */
+    bool isActive() const;
+
+    // VLCBackend::AudioOutput interface
+    bool attachPlayer(libvlc_media_player_t* player) override;
+    void detachPlayer(libvlc_media_player_t* player) override;
+    void setActivePlayer(libvlc_media_player_t* player) override;
+
+private:
+    struct Stream;
+    using Format = ExclusiveAudioOutput::Format;
+
+    /**
+     * @brief Become or stop being the backend's audio output
+     */
+    void applySettings();
+
+    /**
+     * @brief Choose what libVLC delivers for a stream and open the device if needed (libVLC thread)
+     */
+    void negotiate(Stream* stream);
+
+    /**
+     * @brief Open the device in a format and start rendering; m_mutex held
+     */
+    bool openDevice(const Format& format, bool nearest);
+    void closeDevice();
+
+    /**
+     * @brief Fill one device buffer from the active stream (device thread)
+     */
+    void render(char* data, int frames);
+    void renderProcessed(Stream* stream, char* data, int frames);
+
+    void reportStatus();
+
+    std::shared_ptr<AudioOutputManager> m_manager;
+    QPointer<VLCBackend> m_backend;
+    std::unique_ptr<ExclusiveAudioOutput> m_output;
+    QString m_deviceId;                     // As opened
+    int m_periodFrames;
+
+    mutable QMutex m_mutex;                 // Guards the streams and the device
+    QMap<libvlc_media_player_t*, std::shared_ptr<Stream>> m_streams;
+    std::shared_ptr<Stream> m_active;
+    std::atomic<Stream*> m_playing;         // What the render thread drains
+    QVector<Format> m_acceptedFormats;      // Formats the device has opened in
+
+    // Render thread scratch, sized when the device opens
+    QVector<float> m_interleaved;
+    QVector<float> m_left;
+    QVector<float> m_right;
+
+    QTimer* m_statusTimer;
+    qint64 m_compensationUs;                // Audio delay set on the active player
+};
+
+#endif // EXCLUSIVEAUDIOSINK_H
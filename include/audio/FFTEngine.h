@@ -0,0 +1,111 @@
+#ifndef FFTENGINE_H
+#define FFTENGINE_H
+
+#include <QVector>
+#include <complex>
+
+/**
+ * @brief Shared radix-2 FFT engine for the audio pipeline
+ *
+ * Precomputes twiddle factors, the bit-reversal permutation and a Hann
+ * window once per transform size. Real input is packed into a half-length
+ * complex transform, so a real FFT of size N costs one complex FFT of N/2.
+ * All transform methods are const, so a single engine can be shared
+ * between threads. The raw-pointer overloads never allocate; the QVector
+ * overloads resize their output and may pad short input on the heap.
+ */
+class FFTEngine
+{
+public:
+    using Complex = std::complex<float>;
+
+    /**
+     * @brief Create an engine for a fixed transform size
+     * @param size Transform size (power of two, at least 4)
+     */
+    explicit FFTEngine(int size);
+
+    /**
+     * @brief Get the shared engine for a compile-time transform size
+     * @return Engine instance, created on first use
+     */
+    template <int Size>
+    static const FFTEngine& forSize()
+    {
+        static_assert(Size >= 4 && (Size & (Size - 1)) == 0,
+                      "FFT size must be a power of two and at least 4");
+        static const FFTEngine engine(Size);
+        return engine;
+    }
+
+    /**
+     * @brief Get transform size
+     * @return Number of real input samples
+     */
+    int size() const { return m_size; }
+
+    /**
+     * @brief Get number of spectrum bins produced by forward()
+     * @return size() / 2 + 1
+     */
+    int spectrumSize() const { return m_halfSize + 1; }
+
+    /**
+     * @brief Get the precomputed Hann window for this size
+     * @return Window coefficients
+     */
+    const QVector<float>& hannWindow() const { return m_window; }
+
+    /**
+     * @brief Forward real-to-complex transform
+     * @param input size() real samples
+     * @param spectrum Output buffer of spectrumSize() bins (unnormalized)
+     */
+    void forward(const float* input, Complex* spectrum) const;
+
+    /**
+     * @brief Inverse complex-to-real transform
+     * @param spectrum spectrumSize() bins as produced by forward()
+     * @param output Output buffer of size() real samples (normalized by 1/N)
+     */
+    void inverse(const Complex* spectrum, float* output) const;
+
+    /**
+     * @brief Forward transform with zero padding or truncation of the input
+     *
+     * Allocates when spectrum must grow or input is shorter than size().
+     *
+     * @param input Real samples (only the first size() are used)
+     * @param spectrum Resized to spectrumSize() bins
+     */
+    void forward(const QVector<float>& input, QVector<Complex>& spectrum) const;
+
+    /**
+     * @brief Inverse transform of a half spectrum
+     *
+     * Allocates when output must grow.
+     *
+     * @param spectrum At least spectrumSize() bins
+     * @param output Resized to size() samples
+     */
+    void inverse(const QVector<Complex>& spectrum, QVector<float>& output) const;
+
+    /**
+     * @brief Check whether a value is a valid transform size
+     * @param size Candidate size
+     * @return true if size is a power of two and at least 4
+     */
+    static bool isValidSize(int size);
+
+private:
+    void transform(Complex* data, bool inverse) const;
+
+    int m_size;
+    int m_halfSize;
+    QVector<int> m_bitReverse;      // Permutation for the half-size transform
+    QVector<Complex> m_twiddles;    // e^(-2*pi*i*k/M) for the half-size transform
+    QVector<Complex> m_realTwiddles; // e^(-2*pi*i*k/N) for real packing
+    QVector<float> m_window;
+};
+
+#endif // FFTENGINE_H
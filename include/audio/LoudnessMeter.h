@@ -0,0 +1,121 @@
+#ifndef LOUDNESSMETER_H
+#define LOUDNESSMETER_H
+
+#include "audio/BiquadCascade.h"
+#include <QByteArray>
+#include <QVector>
+#include <array>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief ITU-R BS.1770-4 integrated loudness and true-peak meter
+ *
+ * Samples are K-weighted by a two-stage BiquadCascade per channel pair and
+ * their power is summed over 400 ms gating blocks overlapping by 75%. Each
+ * block's loudness is recorded in a histogram of 0.1 LU bins; integrated
+ * loudness applies the absolute (-70 LUFS) and relative (-10 LU) gates to
+ * that histogram. Because histograms of several tracks can simply be
+ * added, an album's loudness is measured exactly from its tracks' stored
+ * histograms without decoding anything again.
+ *
+ * True peak is measured on a 4x oversampled signal (48-tap polyphase
+ * interpolator) below 96 kHz and on the samples themselves above.
+ *
+ * Channel weights follow BS.1770 for up to 5.1 in the usual
+ * L, R, C, LFE, Ls, Rs order; the LFE channel is ignored.
+ */
+class LoudnessMeter
+{
+public:
+    using Histogram = QVector<quint32>;
+
+    static constexpr double ABSOLUTE_GATE_LUFS = -70.0;
+    static constexpr double RELATIVE_GATE_LU = -10.0;
+    static constexpr double HISTOGRAM_STEP_LU = 0.1;
+    static constexpr int HISTOGRAM_BINS = 750;          // -70 to +5 LUFS
+    static constexpr int MAX_CHANNELS = 8;
+    static constexpr double REPLAYGAIN_REFERENCE_LUFS = -18.0;   // ReplayGain 2.0
+
+    LoudnessMeter(int sampleRate, int channels);
+    ~LoudnessMeter();
+
+    int sampleRate() const { return m_sampleRate; }
+    int channels() const { return m_channels; }
+
+    /**
+     * @brief Measure interleaved samples
+     * @param samples frames * channels() samples, nominally within [-1, 1]
+     * @param frames Number of frames
+     */
+    void addFrames(const float* samples, int frames);
+
+    /**
+     * @brief Integrated loudness of everything measured so far
+     * @return LUFS, or -infinity if nothing passed the absolute gate
+     */
+    double integratedLoudness() const { return integratedLoudness(m_histogram); }
+
+    /**
+     * @brief Highest true peak so far, as a linear sample value
+     */
+    double truePeak() const { return m_truePeak; }
+
+    /**
+     * @brief Gating block histogram, for album measurement and storage
+     */
+    const Histogram& histogram() const { return m_histogram; }
+
+    /**
+     * @brief Integrated loudness of a histogram, or of several added together
+     */
+    static double integratedLoudness(const Histogram& histogram);
+
+    /**
+     * @brief Add one histogram into another
+     */
+    static void mergeHistogram(Histogram& target, const Histogram& source);
+
+    /**
+     * @brief Compact form for storage: only bins that hold blocks
+     */
+    static QByteArray packHistogram(const Histogram& histogram);
+    static Histogram unpackHistogram(const QByteArray& packed);
+
+    /**
+     * @brief ReplayGain 2.0 gain in dB that brings a loudness to the reference
+     */
+    static double replayGain(double loudness) { return REPLAYGAIN_REFERENCE_LUFS - loudness; }
+
+private:
+    static constexpr int OVERSAMPLING = 4;
+    static constexpr int TAPS_PER_PHASE = 12;
+    static constexpr int CHUNK_FRAMES = BiquadCascade::BLOCK_SIZE * 8;
+
+    void processChunk(const float* samples, int frames);
+    void measureTruePeak(const float* samples, int frames);
+    void finishSubBlock();
+
+    int m_sampleRate;
+    int m_channels;
+    int m_subBlockFrames;               // 100 ms
+    std::array<double, MAX_CHANNELS> m_weights;
+
+    // K-weighting, one cascade per channel pair, and planar work buffers
+    std::vector<std::unique_ptr<BiquadCascade>> m_filters;
+    std::vector<std::vector<float>> m_planar;
+
+    // Gating: power of the current 100 ms sub-block, and of the last four
+    std::array<double, MAX_CHANNELS> m_subBlockPower;
+    int m_subBlockFill;
+    std::array<double, 4> m_recentSubBlocks;
+    int m_recentCount;
+    Histogram m_histogram;
+
+    // True peak
+    bool m_oversample;
+    std::vector<std::array<float, TAPS_PER_PHASE>> m_peakHistory;
+    double m_truePeak;
+};
+
+#endif // LOUDNESSMETER_H
@@ -0,0 +1,112 @@
+#ifndef LYRICSTIMELINE_H
+#define LYRICSTIMELINE_H
+
+#include <QString>
+#include <QVector>
+#include "subtitles/IntervalTimeline.h"
+
+/**
+ * @brief Timed lyrics with line and word lookup by playback time
+ *
+ * Loads LRC (including enhanced LRC's <mm:ss.xx> word stamps, repeated
+ * line stamps and the [offset:] tag) and SRT files into lines sorted by
+ * start time. Lines are looked up through an IntervalTimeline, the index
+ * subtitle tracks use, so following playback costs amortized O(1) per
+ * query and seeks O(log n); words within a line are found by binary
+ * search on their start times.
+ *
+ * Lookups move the index cursor, so a timeline must not be queried from
+ * several threads at once.
+ */
+class LyricsTimeline
+{
+public:
+    /**
+     * @brief Word with its own timing, for karaoke highlighting
+     */
+    struct Word {
+        qint64 startTime = 0;   // Start time in milliseconds
+        qint64 endTime = 0;     // End time in milliseconds
+        QString text;           // Word text, including its trailing space
+    };
+
+    /**
+     * @brief Lyrics line structure
+     */
+    struct Line {
+        qint64 startTime;       // Start time in milliseconds
+        qint64 endTime;         // End time in milliseconds
+        QString text;           // Lyrics text
+        QString translation;    // Optional translation
+        QVector<Word> words;    // Word timing, empty if the source has none
+
+        Line() : startTime(0), endTime(0) {}
+        Line(qint64 start, qint64 end, const QString& txt)
+            : startTime(start), endTime(end), text(txt) {}
+
+        bool hasWordTiming() const { return !words.isEmpty(); }
+    };
+
+    static constexpr qint64 LAST_LINE_DURATION_MS = 5000;  // LRC gives no end for the last line
+
+    /**
+     * @brief Load a lyrics file, choosing the parser by extension
+     * @return true if at least one line was loaded
+     */
+    bool loadFile(const QString& filePath);
+
+    /**
+     * @brief Parse LRC text, replacing the current lines
+     * @return true if at least one line was parsed
+     */
+    bool parseLRC(const QString& content);
+
+    /**
+     * @brief Parse SRT text, replacing the current lines
+     * @return true if at least one line was parsed
+     */
+    bool parseSRT(const QString& content);
+
+    /**
+     * @brief Replace the lines
+     */
+    void setLines(const QVector<Line>& lines);
+
+    void clear();
+    bool isEmpty() const { return m_lines.isEmpty(); }
+    int lineCount() const { return m_lines.size(); }
+    const QVector<Line>& lines() const { return m_lines; }
+    const Line& line(int index) const { return m_lines[index]; }
+
+    /**
+     * @brief Get the line shown at a time
+     *
+     * Of several overlapping lines, the one that started last.
+     *
+     * @param time Time in milliseconds
+     * @return Line index, -1 if no line covers the time
+     */
+    int lineAt(qint64 time);
+
+    /**
+     * @brief Get the first line starting after a time
+     * @return Line index, -1 if none
+     */
+    int nextLineAfter(qint64 time) const;
+
+    /**
+     * @brief Get the word sung at a time
+     * @param lineIndex Line from lineAt()
+     * @param time Time in milliseconds
+     * @return Word index, -1 before the first word or without word timing
+     */
+    int wordAt(int lineIndex, qint64 time) const;
+
+private:
+    void rebuildIndex();
+
+    QVector<Line> m_lines;
+    IntervalTimeline m_index;
+};
+
+#endif // LYRICSTIMELINE_H
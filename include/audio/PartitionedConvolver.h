@@ -0,0 +1,133 @@
+#ifndef PARTITIONEDCONVOLVER_H
+#define PARTITIONEDCONVOLVER_H
+
+#include <QString>
+#include <QVector>
+#include <complex>
+
+/**
+ * @brief Head-related impulse responses for a stereo speaker pair
+ *
+ * Holds the four ear responses for virtual speakers at +/-30 degrees:
+ * left speaker to left/right ear and right speaker to left/right ear.
+ */
+struct HRIRSet {
+    QString name;
+    int sampleRate;
+    QVector<float> leftToLeft;
+    QVector<float> leftToRight;
+    QVector<float> rightToLeft;
+    QVector<float> rightToRight;
+
+    HRIRSet() : sampleRate(0) {}
+
+    /**
+     * @brief Check whether all four responses are present
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Get a copy resampled to another rate (linear interpolation)
+     * @param targetRate Target sample rate
+     */
+    HRIRSet resampled(int targetRate) const;
+
+    /**
+     * @brief Build the built-in spherical head model
+     * @param sampleRate Sample rate of the generated responses
+     */
+    static HRIRSet sphericalHead(int sampleRate);
+
+    /**
+     * @brief Load a set from a WAV file
+     *
+     * Four-channel files hold LL, LR, RL, RR in that order. Two-channel files
+     * hold the left speaker's left/right ear responses and are mirrored for
+     * the right speaker. SOFA databases can be exported to this layout.
+     *
+     * @param filePath Path to a PCM or IEEE float WAV file
+     * @param errorMessage Optional error description on failure
+     * @return Loaded set (invalid on failure)
+     */
+    static HRIRSet fromWavFile(const QString& filePath, QString* errorMessage = nullptr);
+};
+
+/**
+ * @brief Uniformly partitioned overlap-save convolution for stereo input
+ *
+ * Convolves a stereo signal with a 2x2 matrix of impulse responses (each
+ * input channel feeds both outputs). Responses are split into
+ * PARTITION_SIZE blocks whose spectra are computed once at load time; each
+ * input partition is transformed once and multiplied against all filter
+ * partitions through a frequency-domain delay line. The cost per sample is
+ * independent of the response length apart from the spectral
+ * multiply-accumulate, and the latency is PARTITION_SIZE samples.
+ */
+class PartitionedConvolver
+{
+public:
+    using Complex = std::complex<float>;
+
+    static constexpr int PARTITION_SIZE = 256;
+    static constexpr int FFT_SIZE = PARTITION_SIZE * 2;
+    static constexpr int MAX_IR_LENGTH = 16384;
+
+    PartitionedConvolver();
+
+    /**
+     * @brief Load impulse responses; allocates, call off the audio thread
+     * @param hrir Response set, used at its own sample rate
+     * @return true if the set was valid
+     */
+    bool setImpulseResponses(const HRIRSet& hrir);
+
+    /**
+     * @brief Check whether responses are loaded
+     */
+    bool isLoaded() const { return m_partitionCount > 0; }
+
+    /**
+     * @brief Get processing latency in samples
+     */
+    int latency() const { return PARTITION_SIZE; }
+
+    /**
+     * @brief Get number of filter partitions per response
+     */
+    int partitionCount() const { return m_partitionCount; }
+
+    /**
+     * @brief Clear input history and pending output
+     */
+    void reset();
+
+    /**
+     * @brief Convolve a stereo block in place
+     * @param left Left channel samples
+     * @param right Right channel samples
+     * @param frames Samples per channel
+     * @param wetMix Convolved signal level (0.0 to 1.0); the dry signal is
+     *        delayed by latency() so both stay aligned
+     */
+    void process(float* left, float* right, int frames, float wetMix = 1.0f);
+
+private:
+    enum Path { LeftToLeft = 0, LeftToRight, RightToLeft, RightToRight, PathCount };
+
+    void processPartition();
+    void buildPartitions(const QVector<float>& response, QVector<Complex>& partitions);
+
+    int m_partitionCount;
+    int m_spectrumSize;
+    QVector<Complex> m_filters[PathCount];   // m_partitionCount * m_spectrumSize bins each
+    QVector<Complex> m_inputSpectra[2];      // Frequency-domain delay line per input channel
+    int m_delayLineHead;
+
+    alignas(16) float m_inputFrame[2][FFT_SIZE];     // [previous partition | current partition]
+    alignas(16) float m_outputBlock[2][PARTITION_SIZE];
+    alignas(16) float m_timeScratch[FFT_SIZE];
+    QVector<Complex> m_accumulator;
+    int m_position;
+};
+
+#endif // PARTITIONEDCONVOLVER_H
@@ -0,0 +1,120 @@
+#ifndef POLYPHASERESAMPLER_H
+#define POLYPHASERESAMPLER_H
+
+#include <QString>
+#include <QVector>
+#include <memory>
+
+/**
+ * @brief Streaming stereo sample rate converter with polyphase filter banks
+ *
+ * Converts by the rational ratio L/M of the two rates (160/147 for
+ * 44.1 kHz to 48 kHz). The Kaiser-windowed sinc prototype is split into L
+ * phases of TAPS_PER_PHASE taps, stored reversed so each output sample is
+ * one contiguous dot product against the input history, computed for both
+ * channels at once with SSE2/NEON. Filter banks are built once per ratio
+ * and shared by every resampler using that ratio.
+ *
+ * filterBank() and setRates() may build a bank and belong on the control
+ * thread; setFilterBank(), reset() and process() never allocate.
+ */
+class PolyphaseResampler
+{
+public:
+    static constexpr int TAPS_PER_PHASE = 32;
+    static constexpr int MAX_PHASES = 1024;     // Ratios needing more are not supported
+
+    /**
+     * @brief Polyphase coefficients for one conversion ratio
+     */
+    struct FilterBank {
+        int inputRate;
+        int outputRate;
+        int interpolation;              // L
+        int decimation;                 // M
+        QVector<float> coefficients;    // L phases of TAPS_PER_PHASE, reversed
+    };
+
+    PolyphaseResampler();
+
+    /**
+     * @brief Get the shared filter bank for a conversion, building it once
+     * @param inputRate Source rate in Hz
+     * @param outputRate Target rate in Hz
+     * @return Filter bank, or nullptr if the ratio is not supported
+     */
+    static std::shared_ptr<const FilterBank> filterBank(int inputRate, int outputRate);
+
+    /**
+     * @brief Configure for a conversion (control thread)
+     * @return false if the ratio is not supported
+     */
+    bool setRates(int inputRate, int outputRate);
+
+    /**
+     * @brief Use a bank from filterBank() and reset the history
+     * @param bank Filter bank; nullptr disables the resampler
+     */
+    void setFilterBank(std::shared_ptr<const FilterBank> bank);
+
+    bool isConfigured() const { return m_bank != nullptr; }
+    int inputRate() const { return m_bank ? m_bank->inputRate : 0; }
+    int outputRate() const { return m_bank ? m_bank->outputRate : 0; }
+
+    /**
+     * @brief Delay of the filter in input samples
+     */
+    int latency() const { return TAPS_PER_PHASE / 2; }
+
+    /**
+     * @brief Clear the input history
+     */
+    void reset();
+
+    /**
+     * @brief Most output frames process() can produce from some input
+     */
+    int maxOutputFrames(int inputFrames) const;
+
+    /**
+     * @brief Most input frames whose output is sure to fit a buffer
+     * @param outputCapacity Output buffer size in frames
+     * @return Input frames, at least 1
+     */
+    int maxInputFrames(int outputCapacity) const;
+
+    /**
+     * @brief Convert a stereo block
+     * @param inputLeft Left input samples
+     * @param inputRight Right input samples
+     * @param inputFrames Input samples per channel, all consumed
+     * @param outputLeft Left output, maxOutputFrames(inputFrames) samples
+     * @param outputRight Right output, maxOutputFrames(inputFrames) samples
+     * @return Output frames written
+     */
+    int process(const float* inputLeft, const float* inputRight, int inputFrames,
+                float* outputLeft, float* outputRight);
+
+    /**
+     * @brief Get name of the compiled-in vector backend
+     * @return "SSE2", "NEON" or "Scalar"
+     */
+    static QString simdBackend();
+
+private:
+    static std::shared_ptr<const FilterBank> buildFilterBank(int inputRate, int outputRate);
+
+    std::shared_ptr<const FilterBank> m_bank;
+    int m_phase;                        // Position of the next output between inputs, in 1/L steps
+    int m_historyIndex;
+
+    // Each input is written twice, so the latest TAPS_PER_PHASE samples are
+    // always contiguous from m_historyIndex
+    alignas(16) float m_historyLeft[TAPS_PER_PHASE * 2];
+    alignas(16) float m_historyRight[TAPS_PER_PHASE * 2];
+
+    static constexpr double PASSBAND = 0.95;    // Of the lower Nyquist frequency
+    static constexpr double KAISER_BETA = 8.6;  // About 90 dB stopband attenuation
+};
+
+#endif // POLYPHASERESAMPLER_H
@@ -0,0 +1,118 @@
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include <QVector>
+#include <QtGlobal>
+#include <atomic>
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring buffer
+ *
+ * Storage is allocated once at construction with a power-of-two capacity.
+ * The producer only advances the write counter and the consumer only
+ * advances the read counter, so neither side locks, allocates or waits.
+ * When the ring is full, write() stores what fits and drops the rest.
+ */
+template <typename T>
+class SPSCRingBuffer
+{
+public:
+    /**
+     * @brief Create a ring buffer
+     * @param capacity Minimum capacity, rounded up to a power of two
+     */
+    explicit SPSCRingBuffer(int capacity)
+        : m_writeCounter(0)
+        , m_readCounter(0)
+    {
+        int size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_buffer.resize(size);
+        m_data = m_buffer.data();
+        m_mask = size - 1;
+    }
+
+    SPSCRingBuffer(const SPSCRingBuffer&) = delete;
+    SPSCRingBuffer& operator=(const SPSCRingBuffer&) = delete;
+
+    /**
+     * @brief Get capacity in elements
+     */
+    int capacity() const { return m_mask + 1; }
+
+    /**
+     * @brief Append elements (producer thread)
+     * @param data Elements to append
+     * @param count Number of elements
+     * @return Number of elements stored
+     */
+    int write(const T* data, int count)
+    {
+        const quint64 written = m_writeCounter.load(std::memory_order_relaxed);
+        const quint64 consumed = m_readCounter.load(std::memory_order_acquire);
+        const int space = capacity() - static_cast<int>(written - consumed);
+        count = qMin(count, space);
+
+        for (int i = 0; i < count; ++i) {
+            m_data[static_cast<int>((written + i) & m_mask)] = data[i];
+        }
+
+        m_writeCounter.store(written + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * @brief Get number of elements ready to read (consumer thread)
+     */
+    int availableToRead() const
+    {
+        const quint64 written = m_writeCounter.load(std::memory_order_acquire);
+        const quint64 consumed = m_readCounter.load(std::memory_order_relaxed);
+        return static_cast<int>(written - consumed);
+    }
+
+    /**
+     * @brief Remove elements (consumer thread)
+     * @param data Output buffer
+     * @param count Maximum number of elements
+     * @return Number of elements read
+     */
+    int read(T* data, int count)
+    {
+        const quint64 consumed = m_readCounter.load(std::memory_order_relaxed);
+        count = qMin(count, availableToRead());
+
+        for (int i = 0; i < count; ++i) {
+            data[i] = m_data[static_cast<int>((consumed + i) & m_mask)];
+        }
+
+        m_readCounter.store(consumed + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * @brief Discard elements without reading them (consumer thread)
+     * @param count Maximum number of elements
+     * @return Number of elements discarded
+     */
+    int skip(int count)
+    {
+        const quint64 consumed = m_readCounter.load(std::memory_order_relaxed);
+        count = qMin(count, availableToRead());
+        m_readCounter.store(consumed + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    QVector<T> m_buffer;
+    T* m_data;
+    int m_mask;
+
+    // Separate cache lines so producer and consumer do not contend
+    alignas(64) std::atomic<quint64> m_writeCounter;
+    alignas(64) std::atomic<quint64> m_readCounter;
+};
+
+#endif // SPSCRINGBUFFER_H
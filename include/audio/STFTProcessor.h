@@ -0,0 +1,145 @@
+#ifndef STFTPROCESSOR_H
+#define STFTPROCESSOR_H
+
+#include <QVector>
+#include <QtGlobal>
+#include <complex>
+#include "audio/FFTEngine.h"
+
+/**
+ * @brief Streaming short-time Fourier transform with overlap-add resynthesis
+ *
+ * Input is collected into a per-channel ring buffer. Every hopSize() samples
+ * the most recent frameSize() samples are windowed with a square-root Hann
+ * window and transformed, the spectra are handed to a callback for in-place
+ * modification, and the result is inverse transformed, windowed again and
+ * overlap-added into the output. With 75% overlap the two windows
+ * reconstruct the input exactly when the spectra are left untouched.
+ * All buffers are allocated up front, so the cost per hop is fixed and
+ * independent of the block sizes passed to process(). The latency is
+ * frameSize() samples.
+ */
+class STFTProcessor
+{
+public:
+    using Complex = std::complex<float>;
+
+    static constexpr int MAX_CHANNELS = 2;
+
+    /**
+     * @brief Create a processor
+     * @param frameSize Analysis frame size (power of two)
+     * @param channelCount Number of channels (1 or 2)
+     */
+    explicit STFTProcessor(int frameSize = 1024, int channelCount = 2);
+
+    /**
+     * @brief Get analysis frame size
+     */
+    int frameSize() const { return m_frameSize; }
+
+    /**
+     * @brief Get hop size between frames (frameSize() / 4)
+     */
+    int hopSize() const { return m_hopSize; }
+
+    /**
+     * @brief Get number of spectrum bins per channel
+     */
+    int binCount() const { return m_engine.spectrumSize(); }
+
+    /**
+     * @brief Get processing latency in samples
+     */
+    int latency() const { return m_frameSize; }
+
+    /**
+     * @brief Clear input history and pending output
+     */
+    void reset();
+
+    /**
+     * @brief Run samples through analysis, the callback and resynthesis
+     *
+     * The callback is invoked once per hop as
+     * fn(Complex* const* spectra, int channelCount, int binCount) and may
+     * modify the spectra in place.
+     *
+     * @param channels Channel sample pointers, processed in place
+     * @param channelCount Number of channels to process (at most the
+     *        count given at construction)
+     * @param frames Samples per channel
+     * @param fn Spectral callback
+     */
+    template <typename SpectrumFn>
+    void process(float* const* channels, int channelCount, int frames, SpectrumFn&& fn)
+    {
+        m_activeChannels = qBound(1, channelCount, m_channelCount);
+
+        int done = 0;
+        while (done < frames) {
+            const int count = qMin(m_hopSize - m_hopPosition, frames - done);
+            exchange(channels, done, count);
+            m_hopPosition += count;
+            done += count;
+
+            if (m_hopPosition == m_hopSize) {
+                analyze();
+                fn(m_spectrumPointers, m_activeChannels, binCount());
+                synthesize();
+                m_hopPosition = 0;
+            }
+        }
+    }
+
+    /**
+     * @brief Run samples through analysis only, leaving them untouched
+     * @param channels Channel sample pointers
+     * @param channelCount Number of channels to analyze
+     * @param frames Samples per channel
+     * @param fn Spectral callback (modifications are discarded)
+     */
+    template <typename SpectrumFn>
+    void analyzeOnly(const float* const* channels, int channelCount, int frames, SpectrumFn&& fn)
+    {
+        m_activeChannels = qBound(1, channelCount, m_channelCount);
+
+        for (int i = 0; i < frames; ++i) {
+            for (int ch = 0; ch < m_activeChannels; ++ch) {
+                m_input[ch][m_inputPosition] = channels[ch][i];
+            }
+            m_inputPosition = (m_inputPosition + 1) % m_frameSize;
+
+            if (++m_hopPosition == m_hopSize) {
+                analyze();
+                fn(m_spectrumPointers, m_activeChannels, binCount());
+                m_hopPosition = 0;
+            }
+        }
+    }
+
+private:
+    void exchange(float* const* channels, int offset, int count);
+    void analyze();
+    void synthesize();
+
+    FFTEngine m_engine;
+    int m_frameSize;
+    int m_hopSize;
+    int m_channelCount;
+    int m_activeChannels;
+
+    QVector<float> m_window;                   // Square-root Hann, used for analysis and synthesis
+    QVector<float> m_input[MAX_CHANNELS];      // Ring of the last frameSize() input samples
+    QVector<float> m_overlap[MAX_CHANNELS];    // Ring of pending overlap-add output
+    QVector<float> m_output[MAX_CHANNELS];     // Completed hop being played out
+    QVector<Complex> m_spectra[MAX_CHANNELS];
+    Complex* m_spectrumPointers[MAX_CHANNELS];
+    QVector<float> m_frame;
+
+    int m_inputPosition;
+    int m_overlapPosition;
+    int m_hopPosition;
+};
+
+#endif // STFTPROCESSOR_H
@@ -0,0 +1,81 @@
+#ifndef TEMPOANALYZER_H
+#define TEMPOANALYZER_H
+
+#include "audio/STFTProcessor.h"
+#include <QVector>
+#include <QtGlobal>
+#include <vector>
+
+/**
+ * @brief Offline onset and tempo analysis of a whole track
+ *
+ * The channels are downmixed and run through an STFTProcessor with a hop
+ * of about 10 ms. Each hop contributes one value to an onset envelope: the
+ * spectral flux, i.e. the summed increase of log-compressed magnitudes
+ * over the previous hop. finish() then picks the tempo from the
+ * autocorrelation of the envelope between MIN_BPM and MAX_BPM, weighted
+ * towards PREFERRED_BPM so half and double tempos lose to the common one,
+ * and the phase whose beats collect the most onset energy.
+ *
+ * The result is a constant-tempo beat grid, which is what visualizers and
+ * beat-matched crossfades need and what fits in a few database columns.
+ */
+class TempoAnalyzer
+{
+public:
+    static constexpr double MIN_BPM = 60.0;
+    static constexpr double MAX_BPM = 200.0;
+    static constexpr double PREFERRED_BPM = 120.0;
+    static constexpr float MAX_ONSET_FREQUENCY = 8000.0f;
+
+    /**
+     * @brief Constant-tempo beat grid
+     */
+    struct BeatGrid {
+        double bpm = 0.0;
+        double firstBeatMs = 0.0;       // Position of the first beat
+        float confidence = 0.0f;        // 0 to 1, periodicity of the onsets
+
+        bool isValid() const { return bpm > 0.0; }
+        double beatIntervalMs() const { return isValid() ? 60000.0 / bpm : 0.0; }
+
+        /**
+         * @brief Position of the first beat at or after a position
+         */
+        double nextBeatMs(double positionMs) const;
+    };
+
+    TempoAnalyzer(int sampleRate, int channels);
+
+    /**
+     * @brief Analyze interleaved samples
+     * @param samples frames * channels samples
+     * @param frames Number of frames
+     */
+    void addFrames(const float* samples, int frames);
+
+    /**
+     * @brief Estimate the beat grid of everything added
+     * @return Invalid grid if the track is too short or has no pulse
+     */
+    BeatGrid finish() const;
+
+    /**
+     * @brief Onset envelope, one value per hop
+     */
+    const QVector<float>& onsetEnvelope() const { return m_envelope; }
+    double hopMs() const { return 1000.0 * m_stft.hopSize() / m_sampleRate; }
+
+private:
+    static int frameSizeFor(int sampleRate);
+
+    int m_sampleRate;
+    int m_channels;
+    int m_maxBin;
+    STFTProcessor m_stft;
+    std::vector<float> m_mono;
+    std::vector<float> m_previousMagnitudes;
+    QVector<float> m_envelope;
+};
+
+#endif // TEMPOANALYZER_H
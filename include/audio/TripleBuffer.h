@@ -0,0 +1,74 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+/**
+ * @brief Wait-free single-writer/single-reader snapshot hand-off
+ *
+ * The writer fills writeBuffer() and calls publish(); the reader calls
+ * consume() at a convenient boundary and then reads readBuffer(). The three
+ * slots are preallocated and swapped with a single atomic exchange, so
+ * neither side ever blocks, allocates or sees a half-written snapshot.
+ * Intermediate snapshots published between two consume() calls are dropped.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer()
+        : m_middle(1)
+        , m_writeIndex(0)
+        , m_readIndex(2)
+    {
+    }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /**
+     * @brief Slot owned by the writer until the next publish()
+     */
+    T& writeBuffer() { return m_buffers[m_writeIndex]; }
+
+    /**
+     * @brief Make the current write slot visible to the reader
+     */
+    void publish()
+    {
+        int previous = m_middle.exchange(m_writeIndex | DIRTY_FLAG, std::memory_order_acq_rel);
+        m_writeIndex = previous & INDEX_MASK;
+    }
+
+    /**
+     * @brief Take the most recently published snapshot, if any
+     * @return true if readBuffer() now holds a newer snapshot
+     */
+    bool consume()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & DIRTY_FLAG)) {
+            return false;
+        }
+
+        int previous = m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+        m_readIndex = previous & INDEX_MASK;
+        return true;
+    }
+
+    /**
+     * @brief Slot owned by the reader until the next consume()
+     */
+    const T& readBuffer() const { return m_buffers[m_readIndex]; }
+    T& readBuffer() { return m_buffers[m_readIndex]; }
+
+private:
+    static constexpr int INDEX_MASK = 0x3;
+    static constexpr int DIRTY_FLAG = 0x4;
+
+    T m_buffers[3];
+    std::atomic<int> m_middle;
+    int m_writeIndex;
+    int m_readIndex;
+};
+
+#endif // TRIPLEBUFFER_H
@@ -0,0 +1,87 @@
+#ifndef VOCALSUPPRESSOR_H
+#define VOCALSUPPRESSOR_H
+
+#include <QVector>
+#include <QtGlobal>
+#include <atomic>
+#include "audio/STFTProcessor.h"
+
+/**
+ * @brief Band-limited spectral vocal removal and isolation for stereo audio
+ *
+ * Lead vocals are usually mixed to the centre, where the left and right
+ * spectra agree in both magnitude and phase. For every bin inside the
+ * configured frequency range the suppressor measures that agreement,
+ * 2 Re(L R*) / (|L|^2 + |R|^2), which is 1 for centre-panned content and
+ * falls to 0 for content panned to one side or out of phase. The
+ * time-smoothed agreement weights the mid signal (L + R) / 2 into a
+ * centre estimate, which Remove subtracts from both channels and Isolate
+ * keeps on its own. Bins outside the range, typically bass and cymbals,
+ * are left alone by Remove and muted by Isolate.
+ *
+ * Runs on STFTProcessor, so the cost per hop is one forward and one
+ * inverse transform per channel plus a few operations per bin, whatever
+ * the block size. Parameters and reset() may be used from any thread;
+ * process() belongs to the audio thread.
+ */
+class VocalSuppressor
+{
+public:
+    enum Mode {
+        Remove,
+        Isolate
+    };
+
+    static constexpr int FRAME_SIZE = 1024;     // ~23 ms at 44.1 kHz, hop is a quarter
+
+    VocalSuppressor();
+
+    void setMode(Mode mode) { m_mode.store(mode, std::memory_order_relaxed); }
+    Mode mode() const { return m_mode.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Set how much of the centre is removed or kept (0.0 to 1.0)
+     */
+    void setStrength(float strength);
+
+    /**
+     * @brief Limit processing to a frequency range
+     * @param lowHz Lowest processed frequency
+     * @param highHz Highest processed frequency
+     */
+    void setFrequencyRange(float lowHz, float highHz);
+
+    /**
+     * @brief Process a stereo block in place
+     * @param left Left channel samples
+     * @param right Right channel samples
+     * @param frames Samples per channel
+     * @param sampleRate Sample rate in Hz
+     */
+    void process(float* left, float* right, int frames, int sampleRate);
+
+    /**
+     * @brief Clear the transform history before the next block, e.g. when
+     *        processing resumes after being bypassed
+     */
+    void reset() { m_resetPending.store(true, std::memory_order_relaxed); }
+
+    int latency() const { return m_stft.latency(); }
+
+private:
+    void processSpectra(STFTProcessor::Complex* const* spectra, int bins);
+
+    STFTProcessor m_stft;
+    QVector<float> m_similarity;        // Smoothed centre agreement per bin
+    int m_sampleRate;
+
+    std::atomic<bool> m_resetPending;
+    std::atomic<Mode> m_mode;
+    std::atomic<float> m_strength;
+    std::atomic<float> m_lowHz;
+    std::atomic<float> m_highHz;
+
+    static constexpr float SIMILARITY_SMOOTHING = 0.6f;    // Per hop, against musical noise
+};
+
+#endif // VOCALSUPPRESSOR_H
@@ -0,0 +1,95 @@
+#ifndef WAVEFORMPEAKS_H
+#define WAVEFORMPEAKS_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * @brief Multi-resolution min/max overview of a whole track
+ *
+ * Like audiowaveform's .dat files, the overview stores one 8-bit min/max
+ * pair per BASE_SAMPLES_PER_PEAK frames, with all channels folded into
+ * one. On top of that base level, each further level halves the previous
+ * one until it is shorter than MIN_LEVEL_PEAKS, so a view of any width
+ * picks the level just finer than its pixels and reduces a few peaks per
+ * pixel instead of scanning the whole track.
+ *
+ * Built incrementally from decoded audio with addFrames() and finish(),
+ * and stored with serialize(): a "EPWF" header (version, sample rate,
+ * base samples per peak, level count, all little-endian u32) followed by
+ * each level's peak count and its min/max bytes.
+ */
+class WaveformPeaks
+{
+public:
+    static constexpr int BASE_SAMPLES_PER_PEAK = 2048;
+    static constexpr int MIN_LEVEL_PEAKS = 256;
+
+    struct Peak {
+        qint8 min;
+        qint8 max;
+    };
+    using Level = QVector<Peak>;
+
+    /**
+     * @brief Create an empty overview
+     */
+    WaveformPeaks();
+
+    /**
+     * @brief Start building an overview of decoded audio
+     */
+    WaveformPeaks(int sampleRate, int channels);
+
+    /**
+     * @brief Add interleaved samples
+     * @param samples frames * channels samples, nominally within [-1, 1]
+     * @param frames Number of frames
+     */
+    void addFrames(const float* samples, int frames);
+
+    /**
+     * @brief Close the last peak and build the coarser levels
+     */
+    void finish();
+
+    bool isEmpty() const { return m_levels.isEmpty() || m_levels.first().isEmpty(); }
+    int sampleRate() const { return m_sampleRate; }
+    int levelCount() const { return m_levels.size(); }
+    const Level& level(int index) const { return m_levels[index]; }
+    qint64 samplesPerPeak(int index) const { return qint64(BASE_SAMPLES_PER_PEAK) << index; }
+
+    /**
+     * @brief Covered length in frames, rounded up to whole base peaks
+     */
+    qint64 frameCount() const;
+
+    /**
+     * @brief Coarsest level that still has at least one peak per pixel
+     * @param framesPerPixel Frames shown by one pixel
+     */
+    int levelFor(double framesPerPixel) const;
+
+    QByteArray serialize() const;
+
+    /**
+     * @brief Read serialize() output
+     * @return Empty overview if the data is not a valid overview
+     */
+    static WaveformPeaks deserialize(const QByteArray& data);
+
+private:
+    static qint8 quantize(float value);
+
+    int m_sampleRate;
+    int m_channels;
+    QVector<Level> m_levels;
+
+    // Peak under construction
+    float m_min;
+    float m_max;
+    int m_fill;
+};
+
+#endif // WAVEFORMPEAKS_H
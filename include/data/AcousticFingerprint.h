@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+#include <atomic>
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Chromaprint fingerprint of the first minutes of a track
+ *
+ * Only the first LENGTH_SECONDS are decoded, mono at 11025 Hz, by fpcalc
+ * or, without it, by an FFmpeg built with the chromaprint muxer. The result
+ * is the raw sub-fingerprint stream, about eight 32-bit values a second,
+ * which stays the same through re-rips, transcodes and tag edits, plus the
+ * track duration AcoustID needs next to it.
+ *
+ * The top SUB_HASH_BITS of each value are its sub-hash: the bits of the
+ * first, most robust Chromaprint classifiers. Two encodes of one recording
+ * share many sub-hashes at a constant offset, which is what the inverted
+ * index in the database finds candidates by before match() compares the
+ * full values.
+ */
+class AcousticFingerprint
+{
+public:
+    static constexpr int LENGTH_SECONDS = 120;
+    static constexpr int SUB_HASH_BITS = 20;
+    static constexpr int ALGORITHM = 1;             // Chromaprint's default, what AcoustID indexes
+    static constexpr int MIN_OVERLAP = 80;          // Sub-fingerprints, about ten seconds
+    static constexpr double MAX_BIT_ERROR = 0.2;    // Differing bits over the overlap for a match
+    static constexpr int DECODE_TIMEOUT_MS = 60000;
+
+    AcousticFingerprint() = default;
+
+    /**
+     * @brief Whether fpcalc or an FFmpeg with the chromaprint muxer is installed
+     *
+     * Looked up once; FFmpeg is asked for its muxers on the calling thread.
+     */
+    static bool isAvailable();
+
+    /**
+     * @brief Fingerprint a file, on the calling thread
+     * @param durationMs Library duration, used when the decoder reports none
+     * @param cancelled Kills the decoder when set
+     * @return Empty fingerprint if the file could not be decoded
+     */
+    static AcousticFingerprint compute(const QString& filePath, qint64 durationMs,
+                                       const std::atomic<bool>* cancelled = nullptr);
+
+    static quint32 subHash(quint32 value) { return value >> (32 - SUB_HASH_BITS); }
+
+    /**
+     * @brief Distinct sub-hashes and the first position each occurs at
+     */
+    QHash<quint32, int> subHashes() const;
+
+    /**
+     * @brief Compare two fingerprints at their best alignment
+     *
+     * The alignment is the offset most shared sub-hashes agree on, so a
+     * rip with a few seconds more or less at the start still matches.
+     *
+     * @return Fraction of bits differing over the overlap, 1.0 if the
+     *         fingerprints overlap by fewer than MIN_OVERLAP values
+     */
+    double bitError(const AcousticFingerprint& other) const;
+    bool matches(const AcousticFingerprint& other) const { return bitError(other) <= MAX_BIT_ERROR; }
+
+    /**
+     * @brief The fingerprint as the AcoustID web service takes it
+     *
+     * Chromaprint's compressed form: XORs of consecutive values as runs of
+     * set bit positions, in URL-safe base64.
+     */
+    QString compressed() const;
+
+    QByteArray serialize() const;
+    static AcousticFingerprint deserialize(const QByteArray& data);
+
+    bool isEmpty() const { return m_values.isEmpty(); }
+    qint64 duration() const { return m_duration; }
+    const QVector<quint32>& values() const { return m_values; }
+
+private:
+    qint64 m_duration = 0;          // Whole track, not just the part fingerprinted
+    QVector<quint32> m_values;
+};
+
+} // namespace Data
+} // namespace EonPlay
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QTimer>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+
+class QNetworkReply;
+
+namespace EonPlay {
+namespace Data {
+
+class DatabaseManager;
+
+/**
+ * @brief Fingerprints library audio and finds re-rips, transcodes and AcoustID matches by sound
+ *
+ * After each scan, audio files without a current fingerprint are queued
+ * and fingerprinted in parallel on a low-priority pool, each from only its
+ * first AcousticFingerprint::LENGTH_SECONDS. Fingerprints and their
+ * distinct sub-hashes are written in batched transactions, the sub-hashes
+ * into an inverted index in the database, and are valid until the file
+ * size changes. Files that cannot be decoded are stored as such and not
+ * retried until then.
+ *
+ * findDuplicates() takes candidate pairs from the index, files sharing
+ * many sub-hashes, and confirms each with AcousticFingerprint::matches(),
+ * so no pair of unrelated tracks is ever compared. lookup() sends stored
+ * fingerprints to AcoustID, LOOKUP_BATCH_SIZE files per request and within
+ * the service's rate limit.
+ */
+class AcousticIndexer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_IN_FLIGHT_PER_THREAD = 2;
+    static constexpr int WRITE_BATCH_SIZE = 64;
+    static constexpr int WRITE_INTERVAL_MS = 1000;
+    static constexpr int MIN_SHARED_HASHES = 24;        // Candidate pairs from the index
+    static constexpr int MAX_FILES_PER_HASH = 64;
+    static constexpr int LOOKUP_BATCH_SIZE = 20;
+    static constexpr int LOOKUP_INTERVAL_MS = 334;      // AcoustID allows three requests a second
+
+    explicit AcousticIndexer(DatabaseManager* dbManager, QObject* parent = nullptr);
+    ~AcousticIndexer();
+
+    /**
+     * @brief Queue every library audio file without a current fingerprint
+     */
+    void fingerprintPending();
+
+    /**
+     * @brief Drop queued files and kill running decoders
+     */
+    void cancel();
+
+    bool isRunning() const { return m_inFlight > 0 || !m_queue.isEmpty(); }
+    int queuedFiles() const { return m_queue.size(); }
+
+    /**
+     * @brief Find groups of files with the same recording, whatever their encoding or tags
+     */
+    QList<QStringList> findDuplicates();
+
+    /**
+     * @brief AcoustID application key, needed for lookups
+     */
+    void setApiKey(const QString& apiKey) { m_apiKey = apiKey; }
+
+    /**
+     * @brief Look up recordings by fingerprint
+     *
+     * Files not fingerprinted yet are skipped with lookupFailed().
+     */
+    void lookup(const QStringList& filePaths);
+
+signals:
+    void fingerprintingStarted(int totalFiles);
+    void fingerprintingProgress(int fingerprintedFiles, int totalFiles);
+    void fingerprintingFinished(int fingerprintedFiles, int failedFiles);
+    void duplicateGroupFound(const QStringList& duplicateGroup);
+    void duplicatesFound(const QList<QStringList>& duplicateGroups);
+
+    /**
+     * @brief Best AcoustID match of a file
+     * @param score AcoustID's confidence, 0 to 1
+     */
+    void recordingFound(const QString& filePath, const QString& recordingId, const QString& title,
+                        const QString& artist, double score);
+    void lookupFailed(const QString& filePath, const QString& error);
+
+private slots:
+    void writePendingResults();
+    void sendNextLookup();
+
+private:
+    struct Job {
+        int mediaFileId = -1;
+        QString filePath;
+        qint64 fileSize = 0;
+        qint64 duration = 0;
+    };
+
+    struct Result {
+        Job job;
+        QByteArray fingerprint;             // Empty if the file could not be decoded
+        QHash<quint32, int> subHashes;
+    };
+
+    struct Lookup {
+        QString filePath;
+        QString fingerprint;                // Compressed
+        qint64 duration = 0;                // Seconds
+    };
+
+    void startWorkers();
+    void onFileFinished(const Result& result);
+    void onLookupFinished(QNetworkReply* reply, const QList<Lookup>& batch);
+
+    DatabaseManager* m_dbManager;
+    QThreadPool* m_pool;
+    QTimer* m_writerTimer;
+
+    QList<Job> m_queue;
+    QSet<int> m_queued;
+    QVector<Result> m_pendingResults;
+    int m_inFlight;
+    int m_totalFiles;
+    int m_fingerprintedFiles;
+    int m_failedFiles;
+    std::atomic<bool> m_cancelled;
+
+    // AcoustID
+    QString m_apiKey;
+    QList<Lookup> m_lookups;
+    QTimer* m_lookupTimer;
+};
+
+} // namespace Data
+} // namespace EonPlay
@@ -5,13 +5,37 @@
 #include <QDateTime>
 #include <QTimer>
 #include <QStringList>
+#include <QHash>
 #include <QMap>
+#include <QPointer>
+#include <QFuture>
+#include "data/DatabaseBackup.h"
+
+namespace EonPlay {
+namespace Data {
+class DatabaseManager;
+}
+}
 
 /**
  * @brief Automatic library backup and restore system
  * 
  * Provides automated backup of media library, playlists, settings, and user data
  * with scheduled backups, compression, and restore capabilities for EonPlay.
+ * 
+ * Library backups are online: the database is copied in the background with
+ * SQLite's backup API while playback keeps writing to it, optionally zstd
+ * compressed. The checksum recorded with each backup is taken while it is
+ * written, and verifyBackup() compares the file against it.
+ * 
+ * Incremental backups (the default) share a content-defined chunk store:
+ * each backup writes a manifest plus only the chunks earlier backups do not
+ * have, so rotating several backups of a large library costs little more
+ * than one copy. Deleting backups removes chunks nothing refers to any more.
+ * 
+ * With encryption enabled, backups are standalone files sealed with
+ * AES-256-GCM under a key derived from the passphrase; the derivation salt
+ * is stored in each file, and keys are derived once per salt and session.
  */
 class BackupManager : public QObject
 {
@@ -53,8 +77,18 @@ public:
     explicit BackupManager(QObject *parent = nullptr);
     ~BackupManager();
 
+    /**
+     * @brief Set the library database that is backed up and restored
+     */
+    void setDatabaseManager(EonPlay::Data::DatabaseManager* databaseManager);
+
     // Backup operations
+    /**
+     * @brief Start a backup in the background
+     * @return Backup id used in the signals, empty if it could not be started
+     */
     QString createBackup(BackupType type, const QString& description = QString());
+    void cancelBackup();
     bool restoreBackup(const QString& backupId);
     bool deleteBackup(const QString& backupId);
     bool verifyBackup(const QString& backupId);
@@ -79,6 +113,8 @@ public:
     QString getBackupDirectory() const;
     void enableCompression(bool enabled);
     bool isCompressionEnabled() const;
+    void enableIncrementalBackup(bool enabled);
+    bool isIncrementalBackupEnabled() const { return m_incrementalEnabled; }
     void enableEncryption(bool enabled);
     bool isEncryptionEnabled() const;
     void setEncryptionKey(const QString& key);
@@ -117,8 +153,8 @@ private:
     // Compression and encryption
     bool compressBackup(const QString& sourcePath, const QString& targetPath);
     bool decompressBackup(const QString& sourcePath, const QString& targetPath);
-    bool encryptBackup(const QString& filePath);
-    bool decryptBackup(const QString& filePath);
+    bool decryptBackup(const QString& sourcePath, const QString& targetPath);
+    QByteArray backupKey(const QByteArray& salt);
     
     // Restore helpers
     bool restoreLibraryBackup(const QString& backupPath);
@@ -132,21 +168,29 @@ private:
     bool removeDirectory(const QString& path);
     QString calculateChecksum(const QString& filePath) const;
     bool verifyChecksum(const QString& filePath, const QString& expectedChecksum) const;
+    QString chunkStoreDirectory() const;
+    void collectChunkGarbage();
     
     // Backup metadata
     void saveBackupInfo(const BackupInfo& info);
     void loadBackupInfo();
     void removeBackupInfo(const QString& backupId);
+    void writeBackupMetadata() const;
     
     // Member variables
+    QPointer<EonPlay::Data::DatabaseManager> m_databaseManager;
+    QFuture<EonPlay::Data::DatabaseBackup::Result> m_runningBackup;
     bool m_automaticBackupEnabled;
     int m_backupIntervalHours;
     int m_maxBackupCount;
     bool m_compressionEnabled;
+    bool m_incrementalEnabled;
     bool m_encryptionEnabled;
     
     QString m_backupDirectory;
     QString m_encryptionKey;
+    QByteArray m_encryptionSalt;                // Of backups written this session
+    QHash<QByteArray, QByteArray> m_derivedKeys; // Backup keys by salt
     
     BackupStatus m_currentStatus;
     int m_currentProgress;
@@ -160,4 +204,7 @@ private:
     static const int DEFAULT_BACKUP_INTERVAL_HOURS = 24;
     static const int DEFAULT_MAX_BACKUP_COUNT = 10;
     static const QString BACKUP_METADATA_FILE;
+    static const QString CHUNK_STORE_DIRECTORY;
+    static const QString DECRYPTED_SUFFIX;
+    static const int ENCRYPTION_SALT_LENGTH = 16;
 };
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Deduplicated storage of backups as content-defined chunks
+ *
+ * A stored file is cut where a rolling gear hash over the last 64 bytes
+ * matches a mask (FastCDC with normalized chunking), so boundaries depend
+ * on the content rather than on offsets: a few changed database pages only
+ * change the chunks around them. Chunks are named by their SHA-256 and
+ * written once; a manifest lists the chunks of one stored file in order.
+ * Successive backups of a mostly unchanged library therefore add only the
+ * chunks that changed.
+ *
+ * Chunks are zstd compressed when asked for and built with HAVE_ZSTD.
+ * Chunks no manifest refers to any more are removed by collectGarbage();
+ * it must not run while a file is being stored.
+ */
+class ChunkStore
+{
+public:
+    static constexpr int MIN_CHUNK_SIZE = 64 * 1024;
+    static constexpr int AVERAGE_CHUNK_SIZE = 256 * 1024;
+    static constexpr int MAX_CHUNK_SIZE = 1024 * 1024;
+    static constexpr const char* MANIFEST_SUFFIX = ".manifest";
+
+    /**
+     * @brief Called with the bytes consumed so far; returning false cancels
+     */
+    using ProgressCallback = std::function<bool(qint64 consumed)>;
+
+    struct StoreResult {
+        bool success = false;
+        QString error;
+        qint64 size = 0;            // Bytes of the stored file
+        qint64 storedBytes = 0;     // Bytes added to the store, manifest included
+        int chunkCount = 0;
+        int newChunks = 0;
+        QString checksum;           // SHA-256 of the stored file, hex
+    };
+
+    explicit ChunkStore(const QString& directory);
+
+    QString directory() const { return m_directory; }
+
+    /**
+     * @brief Chunk a file into the store and write its manifest
+     * @param input Open device, read to the end
+     * @param manifestPath Manifest to write; it refers to the store relative to itself
+     */
+    StoreResult store(QIODevice& input, const QString& manifestPath, bool compress, int compressionLevel,
+                      const ProgressCallback& progress = ProgressCallback());
+
+    /**
+     * @brief Reassemble a stored file, checking every chunk against its name
+     */
+    static bool restore(const QString& manifestPath, QIODevice& output, QString* error = nullptr);
+
+    /**
+     * @brief Recompute a stored file's checksum from its chunks; empty if a chunk is missing or damaged
+     */
+    static QString checksum(const QString& manifestPath);
+
+    /**
+     * @brief Checksum recorded in a manifest when it was written
+     */
+    static QString recordedChecksum(const QString& manifestPath);
+
+    /**
+     * @brief Remove chunks that none of the manifests refers to
+     * @return Bytes freed; nothing is removed if a manifest cannot be read
+     */
+    qint64 collectGarbage(const QStringList& manifestPaths);
+
+    /**
+     * @brief Bytes the chunks take on disk
+     */
+    qint64 diskUsage() const;
+
+    static bool isManifest(const QString& path);
+
+private:
+    struct Manifest {
+        bool valid = false;
+        QString storeDirectory;     // Absolute
+        qint64 size = 0;
+        QString checksum;
+        QStringList chunks;
+    };
+
+    static Manifest readManifest(const QString& manifestPath);
+    static QString chunkPath(const QString& storeDirectory, const QString& hash);
+    static bool readChunk(const QString& storeDirectory, const QString& hash, QByteArray* data, QString* error);
+    static int chunkLength(const uchar* data, int size);
+
+    bool writeChunk(const QByteArray& data, const QString& hash, bool compress, int compressionLevel,
+                    qint64* written, QString* error);
+
+    QString m_directory;
+};
+
+} // namespace Data
+} // namespace EonPlay
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Content-addressed store for album art
+ *
+ * Images are filed under a hash of their bytes, so the tracks of an album
+ * that all embed the same cover share one entry. Each entry is the
+ * original image plus JPEG copies pre-scaled to the sizes the library
+ * views draw, written once when the image is first stored. Views can then
+ * decode a small file instead of scaling the full cover every time.
+ *
+ * Methods only touch the file system and are safe to call from any thread.
+ */
+class CoverArtStore
+{
+public:
+    explicit CoverArtStore(const QString& directory = defaultDirectory());
+
+    /**
+     * @brief Get the default store directory
+     */
+    static QString defaultDirectory();
+
+    /**
+     * @brief Bounding squares, in pixels, that thumbnails are pre-scaled to
+     */
+    static QList<int> thumbnailSizes();
+
+    /**
+     * @brief Add an image to the store
+     * @param imageBytes Encoded image, e.g. a picture read from a tag
+     * @return Path of the stored original, or empty if the bytes are not an image
+     */
+    QString store(const QByteArray& imageBytes) const;
+
+    /**
+     * @brief Get the smallest stored file that covers a size
+     * @param coverArtPath Path returned by store(), or any other image path
+     * @param size Bounding square the image will be drawn in
+     * @return The pre-scaled copy when there is one, otherwise coverArtPath
+     */
+    static QString thumbnailPath(const QString& coverArtPath, int size);
+
+    /**
+     * @brief Keep a short animated preview with a stored image, e.g. a video's poster frame
+     * @param coverArtPath Path returned by store()
+     * @param gifBytes Encoded GIF
+     * @return Path of the preview, or empty if it could not be written
+     */
+    static QString storePreview(const QString& coverArtPath, const QByteArray& gifBytes);
+
+    /**
+     * @brief Get the animated preview kept with a stored image
+     * @return Its path, or empty if there is none
+     */
+    static QString previewPath(const QString& coverArtPath);
+
+    QString directory() const { return m_directory; }
+
+private:
+    static QString scaledFileName(const QString& hash, int size);
+
+    QString m_directory;
+};
+
+} // namespace Data
+} // namespace EonPlay
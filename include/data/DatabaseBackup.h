@@ -0,0 +1,106 @@
+#pragma once
+
+#include <QFuture>
+#include <QPromise>
+#include <QString>
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Online backups of the library database
+ *
+ * A backup copies the live database page by page with SQLite's backup API
+ * on a connection of its own, pagesPerStep pages at a time with a short
+ * pause in between, so playback-history and scanner writes keep flowing
+ * while a multi-GB library is copied. The copy reads one consistent
+ * snapshot: the source holds a WAL read transaction for the whole backup,
+ * so concurrent commits neither block it nor make it start over.
+ *
+ * The snapshot is then streamed once into the backup file, optionally zstd
+ * compressed, and the SHA-256 of the written bytes is computed in the same
+ * pass; verifying a backup later compares against that checksum. With a
+ * chunk store the snapshot is instead stored as deduplicated chunks plus a
+ * manifest (see ChunkStore), so a backup only adds what changed since the
+ * earlier ones; its checksum is that of the database.
+ *
+ * With an encryption key the finished backup is sealed with AES-256-GCM
+ * (see AesGcm) on the same thread and only the encrypted file is kept;
+ * restore() expects it decrypted again. Chunked backups are not encrypted.
+ *
+ * Built without the SQLite library (HAVE_SQLITE3), the snapshot is taken
+ * with VACUUM INTO instead, which does not block writers either but copies
+ * in one go. Without zstd (HAVE_ZSTD) backups are never compressed.
+ */
+class DatabaseBackup
+{
+public:
+    static constexpr int DEFAULT_PAGES_PER_STEP = 256;      // 1 MB with 4 KB pages
+    static constexpr int DEFAULT_STEP_PAUSE_MS = 5;
+    static constexpr int DEFAULT_COMPRESSION_LEVEL = 3;
+    static constexpr int BUSY_TIMEOUT_MS = 30000;
+    static constexpr const char* COMPRESSED_SUFFIX = ".zst";
+    static constexpr const char* ENCRYPTED_SUFFIX = ".enc";
+
+    struct Options {
+        int pagesPerStep = DEFAULT_PAGES_PER_STEP;
+        int stepPauseMs = DEFAULT_STEP_PAUSE_MS;    // Between steps, for writers to get the lock
+        bool compress = false;                      // Ignored without zstd
+        int compressionLevel = DEFAULT_COMPRESSION_LEVEL;
+        QString chunkStore;                         // Store directory; empty writes a standalone file
+        QByteArray encryptionKey;                   // AesGcm::KEY_SIZE bytes; empty leaves the backup in the clear
+        QByteArray encryptionHeader;                // Kept readable in the encrypted file, e.g. a key derivation salt
+    };
+
+    struct Result {
+        bool success = false;
+        QString error;
+        QString filePath;           // Backup path, with COMPRESSED_SUFFIX if compressed or MANIFEST_SUFFIX if chunked,
+                                    // then ENCRYPTED_SUFFIX if encrypted
+        bool compressed = false;
+        bool encrypted = false;
+        qint64 databaseSize = 0;    // Bytes of the snapshot
+        qint64 fileSize = 0;        // Bytes written; for chunked backups only new chunks and the manifest
+        QString checksum;           // SHA-256 of the written file, or of the database if chunked; hex
+    };
+
+    /**
+     * @brief Back up a database on the backup thread
+     * @param databasePath Live database; other connections may keep writing
+     * @param backupPath Target file; COMPRESSED_SUFFIX or ChunkStore::MANIFEST_SUFFIX is appended
+     * @return Future of the result; progress runs 0-100, cancel() stops the copy
+     */
+    static QFuture<Result> create(const QString& databasePath, const QString& backupPath,
+                                  const Options& options = Options());
+
+    /**
+     * @brief Replace a database's contents with a backup: standalone, compressed or chunked
+     *
+     * Connections to the target should be closed; the caller reopens them.
+     */
+    static bool restore(const QString& backupPath, const QString& databasePath, QString* error = nullptr);
+
+    /**
+     * @brief SHA-256 of a file, hex; empty if it cannot be read
+     */
+    static QString fileChecksum(const QString& filePath);
+
+    static bool isCompressionAvailable();
+
+    /**
+     * @brief Check for the zstd frame magic
+     */
+    static bool isCompressed(const QString& filePath);
+
+private:
+    static void run(QPromise<Result>& promise, const QString& databasePath, const QString& backupPath,
+                    const Options& options);
+    static bool snapshot(QPromise<Result>& promise, const QString& databasePath, const QString& snapshotPath,
+                         const Options& options, QString* error);
+    static bool writeBackup(QPromise<Result>& promise, const QString& snapshotPath, Result& result,
+                            const Options& options);
+    static bool encryptBackup(Result& result, const Options& options);
+};
+
+} // namespace Data
+} // namespace EonPlay
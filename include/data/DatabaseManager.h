@@ -1,6 +1,11 @@
 #pragma once
 
+#include "data/MediaFileCache.h"
+#include "data/QueryExecutor.h"
+#include "data/DatabaseBackup.h"
+#include "Metrics.h"
 #include <QObject>
+#include <QFuture>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
@@ -8,7 +13,11 @@
 #include <QStringList>
 #include <QDateTime>
 #include <QVariant>
+#include <QVector>
+#include <QHash>
+#include <QCache>
 #include <QMutex>
+#include <QElapsedTimer>
 #include <memory>
 
 namespace EonPlay {
@@ -33,6 +42,16 @@ public:
     void shutdown();
     bool isInitialized() const { return m_initialized; }
 
+    /**
+     * @brief Background connections for work that must not block the GUI thread
+     */
+    QueryExecutor* executor() const { return m_executor.get(); }
+
+    /**
+     * @brief Shared snapshots of media_files rows; loaders build files through it
+     */
+    MediaFileCache* mediaFileCache() const { return m_mediaFileCache.get(); }
+
     // Schema management
     bool createSchema();
     bool migrateDatabase();
@@ -47,13 +66,213 @@ public:
                         const QString& album, qint64 duration);
     bool removeMediaFile(int id);
     bool removeMediaFileByPath(const QString& filePath);
+    /**
+     * @brief Remove many files in one transaction
+     *
+     * Joins the open bulk upsert transaction instead if there is one.
+     */
+    bool removeMediaFilesByPath(const QStringList& filePaths);
     QSqlQuery getMediaFile(int id);
     QSqlQuery getMediaFileByPath(const QString& filePath);
     QSqlQuery getAllMediaFiles();
+    QStringList getAllMediaFilePaths();
+    QVector<int> getMediaFileIds(const QStringList& filePaths);
+    QHash<QString, int> getMediaFileIdsByPath(const QStringList& filePaths);
     QSqlQuery searchMediaFiles(const QString& searchTerm);
+
+    static const int DEFAULT_SEARCH_LIMIT = 200;
+
+    /**
+     * @brief Ranked search over title, artist, album and path
+     * 
+     * Every word of searchTerm is matched as a prefix against the FTS5
+     * index, best matches first. Falls back to a LIKE scan when the SQLite
+     * build lacks FTS5.
+     * @return Matching media file ids, at most limit of them
+     */
+    QVector<int> searchMediaFileIds(const QString& searchTerm, int limit = DEFAULT_SEARCH_LIMIT);
+    bool isSearchIndexAvailable() const { return m_searchIndexAvailable; }
+
+    /**
+     * @brief Turn user input into an FTS5 MATCH expression of quoted word prefixes
+     */
+    static QString buildSearchMatch(const QString& searchTerm);
     bool updatePlayCount(int id);
     bool updateLastPlayed(int id, const QDateTime& timestamp = QDateTime::currentDateTime());
 
+    // Bulk media file upserts
+    struct MediaFileRow {
+        QString filePath;
+        QString title;
+        QString artist;
+        QString album;
+        qint64 duration = 0;
+        qint64 fileSize = 0;
+    };
+
+    static const int DEFAULT_BULK_COMMIT_ROWS = 1000;
+    static const int DEFAULT_BULK_COMMIT_INTERVAL_MS = 500;
+
+    /**
+     * @brief Start a bulk upsert session
+     * 
+     * Rows passed to bulkUpsertMediaFile() reuse one prepared statement and
+     * are committed together every commitRows rows or commitIntervalMs
+     * milliseconds, whichever comes first. Each commit emits a single
+     * mediaFilesUpserted() instead of per-row signals.
+     */
+    bool beginBulkUpsert(int commitRows = DEFAULT_BULK_COMMIT_ROWS,
+                         int commitIntervalMs = DEFAULT_BULK_COMMIT_INTERVAL_MS);
+    bool bulkUpsertMediaFile(const MediaFileRow& row, bool* inserted = nullptr);
+    bool flushBulkUpsert();
+    bool endBulkUpsert();
+    bool isBulkUpsertActive() const { return m_bulkActive; }
+
+    // Duplicate detection hashes, valid while size and mtime still match
+    QSqlQuery getDuplicateSizeCandidates();
+    bool updateMediaFileHashes(const QString& filePath, const QString& sampleHash,
+                               const QString& contentHash, qint64 fileSize, qint64 modifiedTime);
+
+    // Loudness analysis and ReplayGain, valid while the file size still matches
+    struct ReplayGainRow {
+        bool hasTrackGain = false;
+        double trackGain = 0.0;     // dB
+        double trackPeak = 0.0;     // Linear true peak
+        bool hasAlbumGain = false;
+        double albumGain = 0.0;
+        double albumPeak = 0.0;
+    };
+
+    /**
+     * @brief Files never analyzed, or whose size changed since: file_path, album
+     */
+    QSqlQuery getLoudnessScanCandidates();
+
+    /**
+     * @brief Store a track's analysis; a NaN loudness marks silence or a decode failure
+     */
+    bool updateMediaFileLoudness(const QString& filePath, double loudness, double trackGain, double truePeak,
+                                 const QByteArray& histogram, qint64 fileSize);
+
+    /**
+     * @brief Analyzed files of an album: file_path, loudness_histogram, track_peak
+     */
+    QSqlQuery getAlbumLoudness(const QString& album);
+    bool updateAlbumGain(const QStringList& filePaths, double albumGain, double albumPeak);
+    ReplayGainRow getReplayGain(const QString& filePath);
+
+    // Beat grid from the same analysis pass, valid under the same condition
+    struct BeatGridRow {
+        bool hasBeatGrid = false;
+        double bpm = 0.0;
+        double firstBeatMs = 0.0;
+        double confidence = 0.0;
+    };
+
+    /**
+     * @brief Store a track's beat grid; a bpm of 0 marks a track without a pulse
+     */
+    bool updateMediaFileBeatGrid(const QString& filePath, double bpm, double firstBeatMs, double confidence);
+    BeatGridRow getBeatGrid(const QString& filePath);
+
+    // Video fingerprints for near-duplicate detection, valid while size and mtime still match
+    /**
+     * @brief Files with a duration and their stored fingerprint if any:
+     *        id, file_path, file_size, duration, fingerprint_file_size,
+     *        fingerprint_modified_time, fingerprint
+     */
+    QSqlQuery getVideoFingerprints();
+    bool storeVideoFingerprint(int mediaFileId, qint64 fileSize, qint64 modifiedTime, const QByteArray& fingerprint);
+
+    // Poster frames for videos without embedded art
+    /**
+     * @brief Files with a duration and no cover art: id, file_path, duration
+     */
+    QSqlQuery getPosterCandidates();
+    bool updateMediaFileCoverArt(int id, const QString& coverArtPath);
+
+    // Acoustic fingerprints with an inverted index over their sub-hashes, valid while the file size matches
+    struct AcousticFingerprintRow {
+        int mediaFileId = -1;
+        QString filePath;
+        QByteArray fingerprint;
+    };
+
+    /**
+     * @brief Files never fingerprinted, or whose size changed since: id, file_path, file_size, duration
+     */
+    QSqlQuery getAcousticFingerprintCandidates();
+
+    /**
+     * @brief Replace a file's fingerprint and its sub-hashes
+     *
+     * Several statements, so callers storing many files wrap them in a
+     * transaction. An empty fingerprint marks a file that could not be decoded.
+     *
+     * @param subHashes Distinct sub-hashes and the first position each occurs at
+     */
+    bool storeAcousticFingerprint(int mediaFileId, qint64 fileSize, const QByteArray& fingerprint,
+                                  const QHash<quint32, int>& subHashes);
+    AcousticFingerprintRow getAcousticFingerprint(int mediaFileId);
+    AcousticFingerprintRow getAcousticFingerprint(const QString& filePath);
+
+    /**
+     * @brief Pairs of files sharing at least minShared sub-hashes: media_file_id, media_file_id, shared
+     *
+     * Sub-hashes found in more than maxFilesPerHash files, such as those of
+     * silence, are left out; they would pair everything with everything.
+     */
+    QSqlQuery getAcousticMatchCandidates(int minShared, int maxFilesPerHash);
+
+    // Subtitle search: cue text of sidecar and generated subtitles, by media file
+    struct SubtitleCueRow {
+        qint64 startMs = 0;
+        qint64 endMs = 0;
+        QString text;
+    };
+
+    struct SubtitleSearchHit {
+        int mediaFileId = -1;
+        QString filePath;           // Media file
+        QString sourcePath;         // Subtitle file the cue came from
+        qint64 startMs = 0;
+        qint64 endMs = 0;
+        QString text;
+    };
+
+    /**
+     * @brief Modification time the indexed cues of a subtitle file belong to
+     * @return -1 if the file is not indexed
+     */
+    qint64 getSubtitleSourceModifiedTime(const QString& sourcePath);
+
+    /**
+     * @brief Replace the indexed cues of a subtitle file
+     *
+     * One row per cue, so callers writing several files wrap them in a
+     * transaction.
+     * @return False if the media file is not in the library
+     */
+    bool replaceSubtitleCues(const QString& mediaFilePath, const QString& sourcePath, bool generated,
+                             qint64 modifiedTime, const QVector<SubtitleCueRow>& cues);
+    bool removeSubtitleSource(const QString& sourcePath);
+
+    /**
+     * @brief Ranked search over subtitle cue text
+     *
+     * Matches like searchMediaFileIds(), best cues first.
+     */
+    QVector<SubtitleSearchHit> searchSubtitles(const QString& searchTerm, int limit = DEFAULT_SEARCH_LIMIT);
+
+    // Scan journal (directory mtimes and per-file size/mtime/inode)
+    QSqlQuery getScanJournalDirectories();
+    QSqlQuery getScanJournalFiles();
+    bool updateScanJournalDirectory(const QString& path, const QString& parentPath, qint64 modifiedTime);
+    bool updateScanJournalFile(const QString& filePath, const QString& directoryPath,
+                               qint64 fileSize, qint64 modifiedTime, qint64 inode);
+    bool removeScanJournalDirectory(const QString& path);
+    bool clearScanJournal();
+
     // Playlist operations
     int createPlaylist(const QString& name);
     bool updatePlaylist(int id, const QString& name);
@@ -66,15 +285,86 @@ public:
     QSqlQuery getPlaylistItems(int playlistId);
     bool clearPlaylist(int playlistId);
 
+    // playlist_items.position holds sparse sort keys rather than indices;
+    // the position arguments above are still indices into the playlist
+    static constexpr qint64 PLAYLIST_POSITION_GAP = 65536;
+
+    struct PlaylistItemRow {
+        qint64 rowId = -1;          // -1 for a row to insert
+        int mediaFileId = -1;
+        qint64 position = 0;        // Sort key
+    };
+
+    /**
+     * @brief Apply a diff of a playlist's items in one transaction
+     * @param playlistId Playlist to change
+     * @param removedRowIds Rows to delete
+     * @param rows Rows to insert, whose rowId is filled in, or to move to a new sort key
+     */
+    bool updatePlaylistItems(int playlistId, const QList<qint64>& removedRowIds, QList<PlaylistItemRow>& rows);
+
+    /**
+     * @brief Facets maintained in library_aggregates
+     */
+    enum Facet {
+        LibraryFacet,       // Single row covering the whole library
+        ArtistFacet,
+        AlbumFacet,
+        GenreFacet,
+        ExtensionFacet      // Lower-case file extension
+    };
+
+    /**
+     * @brief Totals over the files sharing one facet value
+     */
+    struct FacetAggregate {
+        QString value;
+        int fileCount = 0;
+        qint64 totalSize = 0;
+        qint64 totalDuration = 0;
+    };
+
+    static QString facetName(Facet facet);
+
+    /**
+     * @brief Read the library-wide totals (a single-row lookup)
+     */
+    FacetAggregate getLibraryTotals();
+
+    /**
+     * @brief Read the values of a facet with their totals
+     * @param facet Facet to read
+     * @param byFileCount Order by descending file count instead of by value
+     * @param limit Maximum number of values, or -1 for all
+     */
+    QVector<FacetAggregate> getFacetAggregates(Facet facet, bool byFileCount = false, int limit = -1);
+
     // Statistics and maintenance
     int getMediaFileCount();
     int getPlaylistCount();
     qint64 getTotalLibrarySize();
     bool cleanupOrphanedRecords();
-    bool optimizeDatabase();
+
+    /**
+     * @brief Recount aggregates, VACUUM and ANALYZE on the executor's writer
+     * @return Future that is true if every step succeeded
+     */
+    QFuture<bool> optimizeDatabase();
 
     // Backup and restore
-    bool createBackup(const QString& backupPath);
+    /**
+     * @brief Write a consistent snapshot of the database to a file
+     *
+     * Runs on the backup thread's own connection, so writes keep going.
+     * 
+     * @return Future of the result, with progress; cancel() stops the backup
+     */
+    QFuture<DatabaseBackup::Result> createBackup(const QString& backupPath,
+                                                 const DatabaseBackup::Options& options = DatabaseBackup::Options());
+    
+    /**
+     * @brief Replace the library with a backup, compressed or not
+     */
     bool restoreFromBackup(const QString& backupPath);
 
     // Transaction support
@@ -86,10 +376,46 @@ public:
     QString lastError() const { return m_lastError; }
     QSqlError lastSqlError() const;
 
+    // Query profiling
+    /**
+     * @brief What profiling saw of one SQL statement on the main connection
+     */
+    struct StatementProfile {
+        QString sql;                // Empty for statements past MAX_PROFILED_STATEMENTS
+        HistogramSnapshot latency;  // First step to reset, row handling included
+        quint64 rowsScanned = 0;    // Full table scan steps
+        quint64 rowsReturned = 0;
+        quint64 slowCount = 0;
+        QString queryPlan;          // EXPLAIN QUERY PLAN, once the statement was slow
+    };
+
+    /**
+     * @brief Time every statement run on the main connection
+     *
+     * Off by default; EONPLAY_DB_SLOW_QUERY_MS turns it on at startup. Runs
+     * are counted into the eonplay_db_statement_seconds histogram and the
+     * rows scanned/returned counters of the metrics registry, and per
+     * statement into statementProfiles(). A run slower than the threshold
+     * is logged together with the statement's EXPLAIN QUERY PLAN, so a
+     * missing index shows up as a SCAN. Statements prepared through
+     * prepareQuery() are profiled too, which needs Qt's SQLite driver to use
+     * the SQLite library linked here; without it only executeQuery() is
+     * timed.
+     *
+     * @param slowQueryMs Threshold for the slow-query log
+     */
+    void setQueryProfiling(bool enabled, int slowQueryMs = DEFAULT_SLOW_QUERY_MS);
+    bool isQueryProfiling() const { return m_profiling; }
+    QVector<StatementProfile> statementProfiles() const;
+
+    static constexpr int DEFAULT_SLOW_QUERY_MS = 50;
+    static constexpr int MAX_PROFILED_STATEMENTS = 256;
+
 signals:
     void mediaFileAdded(int id, const QString& filePath);
     void mediaFileRemoved(int id, const QString& filePath);
     void mediaFileUpdated(int id);
+    void mediaFilesUpserted(const QStringList& filePaths);
     void playlistCreated(int id, const QString& name);
     void playlistRemoved(int id);
     void playlistUpdated(int id);
@@ -103,22 +429,59 @@ private:
     bool setupDatabase();
     bool createTables();
     bool createIndexes();
+    static QStringList browseIndexQueries();
     bool createTriggers();
+    bool createScanJournalTables();
+    bool createSearchIndex();
+    bool createAggregateTable();
+    bool createContentVerdictTable();
+    bool createSubtitleIndexTables();
+    bool createVideoFingerprintTable();
+    bool createAcousticFingerprintTables();
+    bool rebuildAggregates();
+    static QStringList aggregateRebuildQueries();
 
     // Migration helpers
     bool migrateToVersion2();
     bool migrateToVersion3();
+    bool migrateToVersion4();
+    bool migrateToVersion5();
+    bool migrateToVersion6();
+    bool migrateToVersion7();
+    bool migrateToVersion8();
+    bool migrateToVersion9();
+    bool migrateToVersion10();
+    bool migrateToVersion11();
+    bool migrateToVersion12();
+    bool migrateToVersion13();
     // Add more migration methods as needed
 
 public:
     // Utility methods (made public for PlaylistManager)
     bool executeQuery(const QString& query, const QVariantList& params = QVariantList());
+    /**
+     * @brief Get a prepared statement for some SQL, reusing a cached one
+     *
+     * Statements are kept in an LRU keyed by the SQL text and are reset
+     * (finished, bindings cleared on the next exec) each time they are handed
+     * out, so a statement stays usable until the same SQL is prepared again.
+     * Don't nest loops over the same SQL. Cached SELECTs are also reset once
+     * control returns to the event loop so they don't hold a read snapshot.
+     */
     QSqlQuery prepareQuery(const QString& query);
     bool tableExists(const QString& tableName);
     QStringList getTableColumns(const QString& tableName);
 
 private:
     void logError(const QString& operation, const QSqlError& error);
+    qint64 playlistPositionForIndexLocked(int playlistId, int index, qint64 excludedRowId = -1);
+    bool renumberPlaylistLocked(int playlistId);
+    QStringList commitBulkLocked();
+    void resetCachedStatements();
+    void installProfiler();
+    void recordStatement(const QString& sql, qint64 elapsedUs, quint64 rowsScanned, quint64 rowsReturned);
+    void explainSlowStatements();
+    static int profileCallback(unsigned type, void* context, void* statement, void* detail);
 
     // Member variables
     QSqlDatabase m_database;
@@ -127,8 +490,56 @@ private:
     mutable QMutex m_mutex;
     QString m_lastError;
 
+    // Bulk upsert session
+    QSqlQuery m_upsertQuery;
+    bool m_bulkActive;
+    int m_bulkCommitRows;
+    int m_bulkCommitIntervalMs;
+    QElapsedTimer m_bulkTimer;
+    QStringList m_bulkPaths;        // Rows written since the last commit
+    qint64 m_lastInsertRowId;
+    QSqlQuery m_journalFileQuery;
+    QSqlQuery m_hashUpdateQuery;
+    QSqlQuery m_loudnessUpdateQuery;
+    QSqlQuery m_beatGridUpdateQuery;
+    QSqlQuery m_fingerprintStoreQuery;
+    QSqlQuery m_coverArtUpdateQuery;
+    QSqlQuery m_acousticStoreQuery;
+    QSqlQuery m_acousticHashDeleteQuery;
+    QSqlQuery m_acousticHashInsertQuery;
+
+    // Off-thread connections
+    std::unique_ptr<QueryExecutor> m_executor;
+    std::unique_ptr<MediaFileCache> m_mediaFileCache;
+
+    // Full-text search
+    bool m_searchIndexAvailable;
+    bool m_subtitleSearchAvailable;
+    QSqlQuery m_searchIdsQuery;
+
+    // Prepared statements of the main connection, by SQL text
+    QCache<QString, QSqlQuery> m_statementCache;
+    bool m_statementResetPending;
+    static constexpr int STATEMENT_CACHE_SIZE = 64;
+
+    // Query profiling
+    struct StatementStats {
+        std::unique_ptr<LatencyHistogram> latency;
+        quint64 rowsScanned = 0;
+        quint64 rowsReturned = 0;
+        quint64 slowCount = 0;
+        QString queryPlan;
+    };
+    bool m_profiling;
+    bool m_explaining;
+    int m_slowQueryMs;
+    mutable QMutex m_profileMutex;
+    QHash<QString, std::shared_ptr<StatementStats>> m_statementStats;
+    QHash<const void*, quint64> m_statementRows;    // Rows returned by each running statement
+    QStringList m_pendingExplains;
+
     // Schema version constants
-    static const int CURRENT_SCHEMA_VERSION = 1;
+    static const int CURRENT_SCHEMA_VERSION = 13;
     static const QString DATABASE_CONNECTION_NAME;
 };
 
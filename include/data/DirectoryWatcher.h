@@ -0,0 +1,143 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QTimer>
+#include <QThreadPool>
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Recursive change notification for library directories
+ *
+ * Watches whole directory trees through the platform's native facility
+ * (inotify on Linux, ReadDirectoryChangesW on Windows, FSEvents on macOS).
+ * Roots on network file systems, or roots the native backend cannot take
+ * (for example when the inotify watch limit is reached), are polled
+ * instead by comparing directory mtimes.
+ *
+ * Changes are coalesced: all directories touched within one debounce
+ * window are reported together by a single directoriesChanged() signal,
+ * at most once per window regardless of how many events arrived.
+ */
+class DirectoryWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_DEBOUNCE_MS = 1000;
+    static constexpr int DEFAULT_POLL_INTERVAL_MS = 60000;
+
+    /**
+     * @brief Create the best watcher for the current platform
+     * @param parent Parent object
+     * @return Native watcher, or a polling watcher if none is available
+     */
+    static DirectoryWatcher* create(QObject* parent = nullptr);
+
+    ~DirectoryWatcher() override;
+
+    /**
+     * @brief Start watching a directory tree
+     * @param rootPath Directory to watch, including all subdirectories
+     * @return true if the tree is watched natively or by polling
+     */
+    bool addPath(const QString& rootPath);
+
+    /**
+     * @brief Stop watching a directory tree
+     * @param rootPath Directory previously passed to addPath()
+     */
+    void removePath(const QString& rootPath);
+
+    /**
+     * @brief Stop watching all trees
+     */
+    void clear();
+
+    QStringList paths() const;
+    bool isPolling(const QString& rootPath) const { return m_pollSnapshots.contains(rootPath); }
+
+    void setDebounceInterval(int milliseconds) { m_debounceTimer->setInterval(milliseconds); }
+    int debounceInterval() const { return m_debounceTimer->interval(); }
+
+    void setPollInterval(int milliseconds) { m_pollTimer->setInterval(milliseconds); }
+    int pollInterval() const { return m_pollTimer->interval(); }
+
+    /**
+     * @brief Get the name of the native backend
+     */
+    virtual QString backendName() const = 0;
+
+    /**
+     * @brief Check whether a path lives on a network file system
+     */
+    static bool isNetworkPath(const QString& path);
+
+signals:
+    /**
+     * @brief Emitted once per debounce window with the changed directories
+     * @param directoryPaths Directories whose entries or files changed
+     */
+    void directoriesChanged(const QStringList& directoryPaths);
+
+protected:
+    explicit DirectoryWatcher(QObject* parent);
+
+    /**
+     * @brief Start native notification for a tree
+     * @return false if the backend cannot watch it; the tree is polled then
+     */
+    virtual bool watchRoot(const QString& rootPath) = 0;
+    virtual void unwatchRoot(const QString& rootPath) = 0;
+
+    /**
+     * @brief Record a changed directory (callable from any thread)
+     */
+    void reportChange(const QString& directoryPath);
+
+private:
+    static DirectoryWatcher* createNative(QObject* parent);
+
+    using TreeSnapshot = QHash<QString, qint64>;     // directory -> mtime
+
+    void flushChanges();
+    void pollRoots();
+    void applyPollResults(const QHash<QString, TreeSnapshot>& snapshots);
+    static TreeSnapshot snapshotTree(const QString& rootPath);
+
+    QStringList m_nativeRoots;
+    QHash<QString, TreeSnapshot> m_pollSnapshots;   // Empty until the first poll
+    QTimer* m_debounceTimer;
+    QTimer* m_pollTimer;
+    QThreadPool* m_pollPool;                        // Polls never block the caller
+    bool m_pollRunning;
+
+    QMutex m_changeMutex;
+    QSet<QString> m_changedDirectories;
+};
+
+/**
+ * @brief Watcher without a native backend; every tree is polled
+ */
+class PollingDirectoryWatcher : public DirectoryWatcher
+{
+    Q_OBJECT
+
+public:
+    explicit PollingDirectoryWatcher(QObject* parent = nullptr) : DirectoryWatcher(parent) {}
+
+    QString backendName() const override { return QStringLiteral("polling"); }
+
+protected:
+    bool watchRoot(const QString& rootPath) override { Q_UNUSED(rootPath) return false; }
+    void unwatchRoot(const QString& rootPath) override { Q_UNUSED(rootPath) }
+};
+
+} // namespace Data
+} // namespace EonPlay
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <functional>
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Reads and writes library exports a row at a time
+ *
+ * The JSON format is the one exportLibrary() always wrote: a root object
+ * whose "files" array holds one object per track. It is written object by
+ * object into a buffer that goes to disk in large blocks, and read by a
+ * scanner that cuts each element of "files" out of the byte stream and
+ * parses only that, so neither direction holds more than a batch.
+ *
+ * The binary format is for moving a library between devices: UTF-8 fields
+ * in blocks of rows, each block zlib-compressed, after an "EPLB" magic.
+ *
+ * All methods are static and safe to call from any thread.
+ */
+class LibraryArchive
+{
+public:
+    enum Format {
+        Json,
+        Binary,
+        UnknownFormat
+    };
+
+    struct Entry {
+        qint64 id = 0;
+        QString filePath;
+        QString title;
+        QString artist;
+        QString album;
+        QString genre;
+        qint64 duration = 0;
+        qint64 fileSize = 0;
+        QString dateAdded;          // As stored, ISO 8601
+        int playCount = 0;
+    };
+
+    static const int DEFAULT_BATCH_SIZE = 1000;
+
+    /**
+     * @brief Fills in the next entry to write; returns false once there are no more
+     */
+    using EntrySource = std::function<bool(Entry& entry)>;
+
+    /**
+     * @brief Called with each batch of entries; return false to stop reading
+     */
+    using BatchHandler = std::function<bool(const QList<Entry>& entries)>;
+
+    /**
+     * @brief Get a format from its name, "json" or "binary"
+     */
+    static Format formatFromName(const QString& name);
+
+    /**
+     * @brief Get the format of an existing archive from its first bytes
+     */
+    static Format detectFormat(const QString& archivePath);
+
+    /**
+     * @brief Write an archive, replacing the file only once fully written
+     * @param written Set to the number of entries written
+     */
+    static bool write(const QString& archivePath, Format format, const EntrySource& source,
+                      int* written = nullptr);
+
+    /**
+     * @brief Read an archive of either format batch by batch
+     * @return false if the file could not be read, was malformed or the
+     *         handler stopped early
+     */
+    static bool read(const QString& archivePath, const BatchHandler& handler,
+                     int batchSize = DEFAULT_BATCH_SIZE);
+};
+
+} // namespace Data
+} // namespace EonPlay
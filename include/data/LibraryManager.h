@@ -3,7 +3,14 @@
 #include "data/DatabaseManager.h"
 #include "data/MediaScanner.h"
 #include "data/MetadataExtractor.h"
+#include "data/AcousticIndexer.h"
+#include "data/LoudnessScanner.h"
+#include "data/PosterGenerator.h"
+#include "data/SeekIndexer.h"
+#include "data/SubtitleIndexer.h"
 #include "data/MediaFile.h"
+#include "data/MediaQueryCursor.h"
+#include "data/RemoteLibrary.h"
 #include <QObject>
 #include <QString>
 #include <QStringList>
@@ -30,7 +37,13 @@ public:
         int autoScanInterval = 3600; // 1 hour in seconds
         bool extractMetadata = true;
         bool fetchWebMetadata = false;
+        bool analyzeLoudness = true;
+        bool fingerprintAudio = true;
+        bool generatePosters = true;        // Poster frames for videos without cover art
+        bool generatePreviewClips = false;  // And an animated hover preview with each
         bool autoCleanup = true;
+        QString remoteServerUrl;        // Library server to show instead of scanning, empty for local
+        QString remoteServerToken;
         MediaScanner::ScanOptions scanOptions;
         MetadataExtractor::ExtractionOptions extractionOptions;
     };
@@ -40,6 +53,7 @@ public:
         int audioFiles = 0;
         int videoFiles = 0;
         qint64 totalSize = 0;
+        qint64 totalDuration = 0;
         int totalPlaylists = 0;
         QStringList topGenres;
         QStringList topArtists;
@@ -47,6 +61,19 @@ public:
         QString libraryCreated;
     };
 
+    /**
+     * @brief Change of the library totals since the previous statisticsUpdated()
+     */
+    struct StatisticsDelta {
+        int files = 0;
+        int audioFiles = 0;
+        int videoFiles = 0;
+        qint64 size = 0;
+        qint64 duration = 0;
+    };
+
+    static constexpr int STATISTICS_UPDATE_MS = 500;
+
     explicit LibraryManager(QObject* parent = nullptr);
     ~LibraryManager() = default;
 
@@ -63,6 +90,27 @@ public:
     DatabaseManager* databaseManager() const { return m_dbManager.get(); }
     MediaScanner* mediaScanner() const { return m_scanner.get(); }
     MetadataExtractor* metadataExtractor() const { return m_extractor.get(); }
+    LoudnessScanner* loudnessScanner() const { return m_loudnessScanner.get(); }
+    SubtitleIndexer* subtitleIndexer() const { return m_subtitleIndexer.get(); }
+    SeekIndexer* seekIndexer() const { return m_seekIndexer.get(); }
+    AcousticIndexer* acousticIndexer() const { return m_acousticIndexer.get(); }
+    PosterGenerator* posterGenerator() const { return m_posterGenerator.get(); }
+    RemoteLibrary* remoteLibrary() const { return m_remoteLibrary.get(); }
+    
+    // Library server
+    /**
+     * @brief Show a library server's library instead of scanning one
+     * 
+     * Only the server scans: scans here fail and auto-scan and file
+     * watching stop. Searches, artist, album and genre listings, recent
+     * and most played files come from the server through RemoteLibrary's
+     * read cache; they are empty until a first answer arrived, and
+     * libraryChanged() is emitted whenever one did.
+     * @param serverUrl e.g. http://192.168.1.10:8080, empty to go back to the local library
+     * @param token Bearer token of the server's API, empty if it needs none
+     */
+    void setRemoteServer(const QUrl& serverUrl, const QString& token = QString());
+    bool isRemote() const { return m_remoteLibrary != nullptr; }
 
     // Library management
     void addLibraryPath(const QString& path);
@@ -83,20 +131,31 @@ public:
 
     // Search and filtering
     QList<MediaFile> searchFiles(const QString& query);
+    QVector<int> searchFileIds(const QString& query, int limit = DatabaseManager::DEFAULT_SEARCH_LIMIT);
     QList<MediaFile> getFilesByArtist(const QString& artist);
     QList<MediaFile> getFilesByAlbum(const QString& album);
     QList<MediaFile> getFilesByGenre(const QString& genre);
     QList<MediaFile> getRecentFiles(int limit = 50);
     QList<MediaFile> getMostPlayedFiles(int limit = 50);
 
+    /**
+     * @brief Open a paged cursor over the library
+     * 
+     * Unlike the QList<MediaFile> queries above, only the projected columns
+     * are read and rows arrive one page at a time.
+     * @return Cursor, or nullptr if the library is not initialized
+     */
+    std::unique_ptr<MediaQueryCursor> openCursor(const MediaQueryCursor::Options& options) const;
+
     // Library maintenance
     void cleanupLibrary();
     void optimizeLibrary();
     void rebuildLibrary();
     QList<QStringList> findDuplicates();
+    QList<QStringList> findSimilarVideos();
     void removeDuplicates(const QStringList& filesToRemove);
 
-    // Statistics
+    // Statistics, read from the trigger-maintained aggregates
     LibraryStatistics getStatistics();
     QStringList getArtists();
     QStringList getAlbums();
@@ -107,8 +166,19 @@ public:
     bool isAutoScanEnabled() const { return m_autoScanEnabled; }
     void setAutoScanInterval(int seconds);
 
-    // Import/Export
+    // Import/Export, streamed through LibraryArchive
+    /**
+     * @brief Write every library file to an archive
+     * @param format "json", or "binary" for moving to another device
+     */
     bool exportLibrary(const QString& filePath, const QString& format = "json");
+
+    /**
+     * @brief Add the files of an archive of either format to the library
+     *
+     * Files already in the library keep their metadata and take the higher
+     * play count and earlier date added of the two.
+     */
     bool importLibrary(const QString& filePath);
 
     // Status
@@ -130,7 +200,7 @@ signals:
     void fileRemoved(const QString& filePath);
     
     void libraryChanged();
-    void statisticsUpdated();
+    void statisticsUpdated(const LibraryManager::StatisticsDelta& delta);
     
     void operationStarted(const QString& operation);
     void operationCompleted(const QString& operation);
@@ -153,6 +223,9 @@ private slots:
     // Auto-scan timer
     void performAutoScan();
 
+    // Coalesces database changes into one statistics refresh
+    void scheduleStatisticsUpdate();
+
 private:
     // Initialization helpers
     void setupComponents();
@@ -177,6 +250,12 @@ private:
     std::unique_ptr<DatabaseManager> m_dbManager;
     std::unique_ptr<MediaScanner> m_scanner;
     std::unique_ptr<MetadataExtractor> m_extractor;
+    std::unique_ptr<LoudnessScanner> m_loudnessScanner;
+    std::unique_ptr<SubtitleIndexer> m_subtitleIndexer;
+    std::unique_ptr<SeekIndexer> m_seekIndexer;
+    std::unique_ptr<AcousticIndexer> m_acousticIndexer;
+    std::unique_ptr<PosterGenerator> m_posterGenerator;
+    std::unique_ptr<RemoteLibrary> m_remoteLibrary;
     
     // Auto-scan
     bool m_autoScanEnabled;
@@ -186,6 +265,7 @@ private:
     LibraryStatistics m_cachedStatistics;
     QDateTime m_statisticsCacheTime;
     bool m_statisticsValid;
+    QTimer* m_statisticsTimer;
 };
 
 } // namespace Data
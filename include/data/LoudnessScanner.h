@@ -0,0 +1,132 @@
+#pragma once
+
+#include "data/WaveformStore.h"
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QTimer>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+
+namespace EonPlay {
+namespace Data {
+
+class DatabaseManager;
+
+/**
+ * @brief Measures the loudness of library tracks in the background for ReplayGain
+ *
+ * Each track is decoded by ffmpeg to 32-bit float PCM in its native rate
+ * and channel layout and streamed through a LoudnessMeter (BS.1770
+ * integrated loudness and true peak). Tracks are analyzed in parallel on a
+ * low-priority worker pool, one track and one single-threaded decoder per
+ * worker, so a large library finishes overnight while the player stays
+ * responsive. Results are written in batched transactions: track gain and
+ * peak, the gating histogram, and the file size they belong to. After each
+ * batch the album gain of every album it touched is recomputed from the
+ * stored histograms of that album's tracks in the same directory, so no
+ * track is ever decoded twice.
+ *
+ * The same decode feeds a TempoAnalyzer, whose beat grid is stored next to
+ * the gains for the visualizer and beat-matched crossfades, and a
+ * WaveformPeaks overview, written to the WaveformStore for seek bars.
+ *
+ * Playback reads the stored gains through DatabaseManager::getReplayGain()
+ * and the beat grid through getBeatGrid(), and pays nothing for analysis. A file is analyzed again only when its
+ * size changes; files that cannot be decoded are remembered the same way.
+ */
+class LoudnessScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_IN_FLIGHT_PER_THREAD = 2;
+    static constexpr int WRITE_BATCH_SIZE = 64;
+    static constexpr int WRITE_INTERVAL_MS = 1000;
+    static constexpr int DECODER_STALL_TIMEOUT_MS = 30000;
+
+    explicit LoudnessScanner(DatabaseManager* dbManager, QObject* parent = nullptr);
+    ~LoudnessScanner();
+
+    /**
+     * @brief Queue every library audio file without a current analysis
+     */
+    void analyzePending();
+
+    /**
+     * @brief Queue specific files
+     * @param urgent Analyze them before everything already queued, e.g.
+     *        for a file that is playing without a waveform
+     */
+    void analyzeFiles(const QStringList& filePaths, bool urgent = false);
+
+    /**
+     * @brief Drop queued files and stop workers at their next buffer
+     */
+    void cancel();
+
+    bool isRunning() const { return m_inFlight > 0 || !m_queue.isEmpty(); }
+    bool isAvailable() const { return !m_ffmpegPath.isEmpty(); }
+    int queuedFiles() const { return m_queue.size(); }
+
+    /**
+     * @brief Limit the number of tracks analyzed at once
+     */
+    void setMaxThreadCount(int threads);
+
+signals:
+    void analysisStarted(int totalFiles);
+    void analysisProgress(int analyzedFiles, int totalFiles);
+    void trackAnalyzed(const QString& filePath, double trackGain, double truePeak);
+    void waveformReady(const QString& filePath);
+    void analysisFinished(int analyzedFiles, int failedFiles);
+
+private slots:
+    void writePendingResults();
+
+private:
+    struct TrackResult {
+        QString filePath;
+        QString album;
+        qint64 fileSize = 0;
+        double loudness = 0.0;      // NaN if nothing was measured
+        double truePeak = 0.0;
+        QByteArray histogram;
+        double bpm = 0.0;           // 0 if no pulse was found
+        double firstBeatMs = 0.0;
+        double beatConfidence = 0.0;
+        bool hasWaveform = false;
+        QString error;
+    };
+
+    void enqueue(const QString& filePath, const QString& album, bool urgent = false);
+    void startWorkers();
+    void onTrackFinished(const TrackResult& result);
+    void updateAlbumGains(const QSet<QPair<QString, QString>>& albums);
+    static TrackResult analyzeTrack(const QString& ffmpegPath, const QString& filePath,
+                                    const WaveformStore& waveforms, const std::atomic<bool>& cancelled);
+
+    DatabaseManager* m_dbManager;
+    QString m_ffmpegPath;
+    QThreadPool* m_pool;
+    QTimer* m_writerTimer;
+    WaveformStore m_waveforms;
+
+    QStringList m_queue;
+    QHash<QString, QString> m_albums;       // Album of each queued file
+    QSet<QString> m_queued;
+    QVector<TrackResult> m_pendingResults;
+    int m_inFlight;
+    int m_totalFiles;
+    int m_analyzedFiles;
+    int m_failedFiles;
+    std::atomic<bool> m_cancelled;
+};
+
+} // namespace Data
+} // namespace EonPlay
@@ -1,18 +1,56 @@
 #pragma once
 
+#include "data/StringPool.h"
 #include <QString>
 #include <QDateTime>
 #include <QFileInfo>
 #include <QVariant>
 #include <QHash>
+#include <QSharedData>
+#include <QSharedDataPointer>
+#include <limits>
 
 namespace EonPlay {
 namespace Data {
 
+/**
+ * @brief Packed record behind MediaFile
+ * 
+ * Artist, album, genre and cover art repeat across a library and are kept
+ * as StringPool ids; timestamps are milliseconds since the epoch.
+ */
+class MediaFileData : public QSharedData
+{
+public:
+    static constexpr qint64 NO_TIME = std::numeric_limits<qint64>::min();
+
+    QString filePath;
+    QString title;
+    QString metadataHash;
+    qint64 duration = 0;            // Duration in milliseconds
+    qint64 fileSize = 0;            // File size in bytes
+    qint64 dateAdded = NO_TIME;
+    qint64 dateModified = NO_TIME;
+    qint64 lastPlayed = NO_TIME;
+    int id = -1;
+    int year = 0;
+    int trackNumber = 0;
+    int playCount = 0;
+    StringPool::Id artist = 0;
+    StringPool::Id album = 0;
+    StringPool::Id genre = 0;
+    StringPool::Id coverArtPath = 0;
+    qint8 rating = 0;               // Rating 0-5
+};
+
 /**
  * @brief Represents a media file in the EonPlay library
  * 
  * Contains metadata and playback information for audio and video files.
+ *
+ * A MediaFile is a handle to a shared, copy-on-write MediaFileData: copies
+ * held by playlists, the queue and models share one record until one of
+ * them is changed.
  */
 class MediaFile
 {
@@ -21,65 +59,68 @@ public:
     explicit MediaFile(const QString& filePath);
     MediaFile(const MediaFile& other);
     MediaFile& operator=(const MediaFile& other);
-    ~MediaFile() = default;
+    ~MediaFile();
 
     // Basic properties
-    int id() const { return m_id; }
-    void setId(int id) { m_id = id; }
+    int id() const { return d->id; }
+    void setId(int id) { d->id = id; }
 
-    QString filePath() const { return m_filePath; }
-    void setFilePath(const QString& filePath);
+    QString filePath() const { return d->filePath; }
+    /**
+     * @brief Set the path; with readFileInfo, size and modification time are read from disk
+     */
+    void setFilePath(const QString& filePath, bool readFileInfo = true);
 
-    QString title() const { return m_title; }
-    void setTitle(const QString& title) { m_title = title; }
+    QString title() const { return d->title; }
+    void setTitle(const QString& title) { d->title = title; }
 
-    QString artist() const { return m_artist; }
-    void setArtist(const QString& artist) { m_artist = artist; }
+    QString artist() const { return StringPool::shared().string(d->artist); }
+    void setArtist(const QString& artist) { d->artist = StringPool::shared().intern(artist); }
 
-    QString album() const { return m_album; }
-    void setAlbum(const QString& album) { m_album = album; }
+    QString album() const { return StringPool::shared().string(d->album); }
+    void setAlbum(const QString& album) { d->album = StringPool::shared().intern(album); }
 
-    QString genre() const { return m_genre; }
-    void setGenre(const QString& genre) { m_genre = genre; }
+    QString genre() const { return StringPool::shared().string(d->genre); }
+    void setGenre(const QString& genre) { d->genre = StringPool::shared().intern(genre); }
 
-    int year() const { return m_year; }
-    void setYear(int year) { m_year = year; }
+    int year() const { return d->year; }
+    void setYear(int year) { d->year = year; }
 
-    int trackNumber() const { return m_trackNumber; }
-    void setTrackNumber(int trackNumber) { m_trackNumber = trackNumber; }
+    int trackNumber() const { return d->trackNumber; }
+    void setTrackNumber(int trackNumber) { d->trackNumber = trackNumber; }
 
     // Duration and size
-    qint64 duration() const { return m_duration; }
-    void setDuration(qint64 duration) { m_duration = duration; }
+    qint64 duration() const { return d->duration; }
+    void setDuration(qint64 duration) { d->duration = duration; }
 
-    qint64 fileSize() const { return m_fileSize; }
-    void setFileSize(qint64 fileSize) { m_fileSize = fileSize; }
+    qint64 fileSize() const { return d->fileSize; }
+    void setFileSize(qint64 fileSize) { d->fileSize = fileSize; }
 
     // Timestamps
-    QDateTime dateAdded() const { return m_dateAdded; }
-    void setDateAdded(const QDateTime& dateAdded) { m_dateAdded = dateAdded; }
+    QDateTime dateAdded() const { return toDateTime(d->dateAdded); }
+    void setDateAdded(const QDateTime& dateAdded) { d->dateAdded = fromDateTime(dateAdded); }
 
-    QDateTime dateModified() const { return m_dateModified; }
-    void setDateModified(const QDateTime& dateModified) { m_dateModified = dateModified; }
+    QDateTime dateModified() const { return toDateTime(d->dateModified); }
+    void setDateModified(const QDateTime& dateModified) { d->dateModified = fromDateTime(dateModified); }
 
-    QDateTime lastPlayed() const { return m_lastPlayed; }
-    void setLastPlayed(const QDateTime& lastPlayed) { m_lastPlayed = lastPlayed; }
+    QDateTime lastPlayed() const { return toDateTime(d->lastPlayed); }
+    void setLastPlayed(const QDateTime& lastPlayed) { d->lastPlayed = fromDateTime(lastPlayed); }
 
     // Playback statistics
-    int playCount() const { return m_playCount; }
-    void setPlayCount(int playCount) { m_playCount = playCount; }
-    void incrementPlayCount() { m_playCount++; }
+    int playCount() const { return d->playCount; }
+    void setPlayCount(int playCount) { d->playCount = playCount; }
+    void incrementPlayCount() { d->playCount++; }
 
-    int rating() const { return m_rating; }
+    int rating() const { return d->rating; }
     void setRating(int rating);
 
     // Cover art
-    QString coverArtPath() const { return m_coverArtPath; }
-    void setCoverArtPath(const QString& coverArtPath) { m_coverArtPath = coverArtPath; }
+    QString coverArtPath() const { return StringPool::shared().string(d->coverArtPath); }
+    void setCoverArtPath(const QString& coverArtPath) { d->coverArtPath = StringPool::shared().intern(coverArtPath); }
 
     // Metadata hash for change detection
-    QString metadataHash() const { return m_metadataHash; }
-    void setMetadataHash(const QString& hash) { m_metadataHash = hash; }
+    QString metadataHash() const { return d->metadataHash; }
+    void setMetadataHash(const QString& hash) { d->metadataHash = hash; }
 
     // File operations
     bool fileExists() const;
@@ -113,6 +154,11 @@ public:
     bool operator!=(const MediaFile& other) const { return !(*this == other); }
     bool operator<(const MediaFile& other) const;
 
+    /**
+     * @brief Compare every field, not just the path as operator== does
+     */
+    bool hasSameData(const MediaFile& other) const;
+
     // Serialization
     QVariantMap toVariantMap() const;
     void fromVariantMap(const QVariantMap& map);
@@ -128,36 +174,16 @@ private:
     void updateFileInfo();
     QString calculateMetadataHash() const;
 
-    // Core properties
-    int m_id;
-    QString m_filePath;
-    QString m_title;
-    QString m_artist;
-    QString m_album;
-    QString m_genre;
-    int m_year;
-    int m_trackNumber;
-
-    // File properties
-    qint64 m_duration;      // Duration in milliseconds
-    qint64 m_fileSize;      // File size in bytes
-
-    // Timestamps
-    QDateTime m_dateAdded;
-    QDateTime m_dateModified;
-    QDateTime m_lastPlayed;
-
-    // Statistics
-    int m_playCount;
-    int m_rating;           // Rating 0-5
-
-    // Additional metadata
-    QString m_coverArtPath;
-    QString m_metadataHash;
+    static QDateTime toDateTime(qint64 msecs)
+    {
+        return msecs == MediaFileData::NO_TIME ? QDateTime() : QDateTime::fromMSecsSinceEpoch(msecs);
+    }
+    static qint64 fromDateTime(const QDateTime& dateTime)
+    {
+        return dateTime.isValid() ? dateTime.toMSecsSinceEpoch() : MediaFileData::NO_TIME;
+    }
 
-    // Cached file info
-    mutable QFileInfo m_fileInfo;
-    mutable bool m_fileInfoCached;
+    QSharedDataPointer<MediaFileData> d;
 };
 
 // Hash function for use in QHash
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "data/MediaFile.h"
+#include <QCache>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <functional>
+
+class QSqlQuery;
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Identity map of library media files, keyed by id
+ *
+ * Rows read from media_files go through the cache, so every playlist,
+ * the queue and the library views get handles to one shared snapshot per
+ * file instead of copies of their own. Snapshots are never changed in
+ * place: update() stores a new one and announces it through
+ * mediaFileChanged(), and holders swap their handle for it without
+ * querying the database again.
+ *
+ * The least recently used entries are dropped past the capacity; handles
+ * held elsewhere stay valid. All methods are thread-safe; signals are
+ * emitted on the calling thread.
+ */
+class MediaFileCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int DEFAULT_CAPACITY = 200000;
+
+    explicit MediaFileCache(QObject* parent = nullptr);
+
+    using RowHandler = std::function<void(const QSqlQuery& row, const MediaFile& file)>;
+
+    /**
+     * @brief Build media files from every remaining row of a query
+     * @param idColumn Column holding the media file id, e.g. "media_file_id" for playlist items
+     * @param rowHandler Called for each row with its file, to read columns of other tables;
+     *                   it runs with the cache locked and must not call back into it
+     * @return Shared snapshots, in row order; rows without an id get only their path and are not cached
+     */
+    QList<MediaFile> fromQuery(QSqlQuery& query, const QString& idColumn = QStringLiteral("id"),
+                               const RowHandler& rowHandler = {});
+
+    /**
+     * @brief Get the shared snapshot for a file, storing this one if it is new or differs
+     */
+    MediaFile intern(const MediaFile& file);
+    QList<MediaFile> intern(const QList<MediaFile>& files);
+
+    /**
+     * @brief Get a cached snapshot
+     * @return The snapshot, or a MediaFile with id -1 if the id is not cached
+     */
+    MediaFile find(int id) const;
+
+    /**
+     * @brief Replace a cached snapshot with a changed copy
+     * @return false if the id is not cached
+     */
+    bool update(int id, const std::function<void(MediaFile&)>& change);
+    void remove(int id);
+    void clear();
+
+    void setCapacity(int capacity);
+    int capacity() const;
+    int count() const;
+
+signals:
+    void mediaFileChanged(const EonPlay::Data::MediaFile& file);
+    void mediaFileRemoved(int id);
+
+private:
+    MediaFile internLocked(const MediaFile& file, bool* changed);
+
+    mutable QMutex m_mutex;
+    mutable QCache<int, MediaFile> m_files;
+};
+
+} // namespace Data
+} // namespace EonPlay
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <QHash>
+#include <QDateTime>
+
+namespace EonPlay {
+namespace Data {
+
+class DatabaseManager;
+
+/**
+ * @brief Paged, column-projected reader over the media library
+ * 
+ * Selects only the requested columns and fetches rows one page at a time.
+ * Pages continue from the last row seen (sort key, then id) instead of
+ * using OFFSET, so every page is an index seek no matter how deep the
+ * cursor is. Rows are plain value lists in columns() order; no MediaFile
+ * is built.
+ */
+class MediaQueryCursor
+{
+public:
+    static constexpr int DEFAULT_PAGE_SIZE = 256;
+
+    // All set conditions must hold
+    struct Filter {
+        QString column;                 // Optional equality filter, e.g. "artist"
+        QVariant value;
+        QString searchTerm;             // Full-text search
+        QStringList fileExtensions;     // Without the dot, e.g. "mp3"
+        QDateTime addedSince;
+        int minimumRating = 0;
+        bool unplayedOnly = false;
+        QString allowedForProfile;      // Parental control profile whose stored verdict must allow the file
+    };
+
+    struct Options {
+        QStringList columns;            // Projection; "id" is always fetched first
+        Filter filter;
+        QString orderBy = "title";
+        Qt::SortOrder order = Qt::AscendingOrder;
+        int pageSize = DEFAULT_PAGE_SIZE;
+        int limit = -1;                 // Total rows, -1 for no limit
+    };
+
+    MediaQueryCursor(DatabaseManager* dbManager, const Options& options);
+
+    /**
+     * @brief Check whether a media_files column may be projected or sorted on
+     */
+    static bool isValidColumn(const QString& column);
+
+    const Options& options() const { return m_options; }
+    const QStringList& columns() const { return m_columns; }
+    int columnIndex(const QString& column) const { return m_columns.indexOf(column); }
+
+    bool atEnd() const { return m_atEnd; }
+    int fetchedRows() const { return m_fetchedRows; }
+
+    /**
+     * @brief Fetch the next page
+     * @return Up to pageSize rows; empty once the cursor is at its end
+     */
+    QVector<QVariantList> fetchPage();
+
+    /**
+     * @brief Rewind to the first row
+     */
+    void reset();
+
+    /**
+     * @brief Read the projected columns of specific rows, ignoring the filter
+     * @return Rows keyed by id; ids that no longer exist are missing
+     */
+    QHash<int, QVariantList> fetchRows(const QVector<int>& ids) const;
+
+    /**
+     * @brief Read the projected columns of those ids that pass the filter
+     */
+    QHash<int, QVariantList> fetchMatching(const QVector<int>& ids) const;
+
+    /**
+     * @brief Order rows the way the cursor's query does
+     * 
+     * Compares (sort key, id) pairs with SQLite's rules: NULL keys sort
+     * first, numbers numerically and text by code unit.
+     */
+    bool lessThan(const QVariant& leftKey, int leftId, const QVariant& rightKey, int rightId) const;
+
+private:
+    static constexpr int MAX_BOUND_IDS = 500;    // Stay below SQLite's variable limit
+
+    void appendFilterConditions(QStringList& conditions, QVariantList& bindValues) const;
+    QHash<int, QVariantList> fetchByIds(const QVector<int>& ids, bool applyFilter) const;
+
+    DatabaseManager* m_dbManager;
+    Options m_options;
+    QStringList m_columns;
+
+    // Position after the last fetched row
+    bool m_hasPosition;
+    QVariant m_lastSortKey;
+    qint64 m_lastId;
+
+    bool m_atEnd;
+    int m_fetchedRows;
+};
+
+} // namespace Data
+} // namespace EonPlay
@@ -1,16 +1,21 @@
 #pragma once
 
 #include "data/MediaFile.h"
+#include "data/DirectoryWatcher.h"
 #include <QObject>
 #include <QString>
 #include <QStringList>
 #include <QDir>
-#include <QFileSystemWatcher>
 #include <QTimer>
 #include <QThread>
+#include <QThreadPool>
 #include <QMutex>
+#include <QSemaphore>
 #include <QHash>
 #include <QSet>
+#include <QVector>
+#include <atomic>
+#include <memory>
 
 namespace EonPlay {
 namespace Data {
@@ -22,6 +27,20 @@ class DatabaseManager;
  * 
  * Provides recursive directory scanning, file monitoring, and automatic
  * library updates for the EonPlay media player.
+ * 
+ * Directory scans run as a pipeline: a scan thread enumerates directories
+ * and filters entries, a bounded worker pool builds MediaFile records, and
+ * the scanner's own thread writes them to the database in batched
+ * transactions. At most MAX_IN_FLIGHT files are between enumeration and
+ * the database at any time, so enumeration waits for slow workers or a
+ * slow database. scanDirectory() and scanDirectories() return immediately;
+ * completion is reported through scanCompleted() or scanCancelled().
+ * 
+ * Every scan maintains a journal in the database of directory mtimes and
+ * per-file size, mtime and inode. Incremental and quick scans skip
+ * directories whose mtime is unchanged without listing them, and only
+ * re-extract files whose journal entry differs. Edits that leave a
+ * directory's mtime alone are picked up by a full scan or rescanLibrary().
  */
 class MediaScanner : public QObject
 {
@@ -61,6 +80,10 @@ public:
         bool isRunning = false;
     };
 
+    static constexpr int MAX_IN_FLIGHT = 1024;
+    static constexpr int WRITE_BATCH_SIZE = 256;
+    static constexpr int WRITE_INTERVAL_MS = 100;
+
     explicit MediaScanner(DatabaseManager* dbManager, QObject* parent = nullptr);
     ~MediaScanner();
 
@@ -83,14 +106,49 @@ public:
 
     // Progress and status
     bool isScanning() const { return m_isScanning; }
-    ScanProgress progress() const { return m_progress; }
+    ScanProgress progress() const;
     void cancelScan();
 
     // Duplicate detection
+    static constexpr int SAMPLE_HASH_BYTES = 64 * 1024;     // Read from each end of a file
+    static constexpr int DUPLICATE_BATCH_FILES = 512;
+
+    /**
+     * @brief Find groups of identical files
+     * 
+     * Files are grouped by their size from the database first, then by a
+     * fast hash of their head and tail, and only the files still sharing a
+     * group are hashed in full. Hashing runs on a thread pool and hashes are
+     * persisted, so repeated runs only read changed files.
+     * duplicateGroupFound() is emitted for each group as soon as it resolves.
+     */
     QList<QStringList> findDuplicateFiles();
     void removeDuplicates(const QStringList& filesToRemove);
 
+    /**
+     * @brief Find groups of videos that look the same: re-encodes, remuxes, rescales
+     *
+     * Videos are fingerprinted with FFmpeg on the hash pool, see
+     * VideoFingerprint, and fingerprints are persisted, so only videos
+     * added or changed since the last run are decoded. Candidates come from
+     * a NearDuplicateIndex rather than from comparing every pair.
+     * similarVideoGroupFound() is emitted for each group.
+     *
+     * @param maxDistance Mean pHash bits per frame two videos may differ by
+     */
+    QList<QStringList> findSimilarVideos(int maxDistance = DEFAULT_SIMILAR_DISTANCE);
+    static constexpr int DEFAULT_SIMILAR_DISTANCE = 10;
+
     // Library maintenance
+
+    /**
+     * @brief Remove files that no longer exist from the library
+     * 
+     * Files are grouped by volume, and volumes that are offline - an
+     * unplugged drive, an unmounted share - are skipped rather than purged.
+     * Each directory is listed once, volumes are checked in parallel and
+     * the rows go in one transaction.
+     */
     void cleanupMissingFiles();
     void updateFileMetadata(const QString& filePath);
     void refreshLibrary();
@@ -112,31 +170,104 @@ signals:
     void fileRemoved(const QString& filePath);
     void fileError(const QString& filePath, const QString& error);
 
+    void duplicateGroupFound(const QStringList& duplicateGroup);
     void duplicatesFound(const QList<QStringList>& duplicateGroups);
+    void similarVideoGroupFound(const QStringList& videoGroup);
+    void similarVideosFound(const QList<QStringList>& videoGroups);
     void libraryUpdated();
 
 private slots:
-    void onDirectoryChanged(const QString& path);
-    void onFileChanged(const QString& path);
+    void onWatchedDirectoriesChanged(const QStringList& directoryPaths);
     void processWatcherQueue();
+    void writePendingResults();
 
 private:
-    // Scanning implementation
-    void scanDirectoryRecursive(const QString& directoryPath, int currentDepth = 0);
+    struct JournalFile {
+        qint64 fileSize = 0;
+        qint64 modifiedTime = 0;
+        qint64 inode = 0;
+
+        bool operator==(const JournalFile& other) const {
+            return fileSize == other.fileSize && modifiedTime == other.modifiedTime &&
+                   inode == other.inode;
+        }
+        bool operator!=(const JournalFile& other) const { return !(*this == other); }
+    };
+
+    // Read-only snapshot of the persisted journal, shared with the scan thread
+    struct ScanJournal {
+        QHash<QString, qint64> directoryTimes;
+        QHash<QString, QStringList> subdirectories;
+        QHash<QString, QHash<QString, JournalFile>> files;  // directory -> file -> entry
+    };
+
+    struct DirectoryRecord {
+        QString path;
+        QString parentPath;
+        qint64 modifiedTime;
+    };
+
+    struct ScanResult {
+        QString filePath;
+        QString directoryPath;
+        JournalFile journal;
+        MediaFile mediaFile;
+        QString error;
+    };
+
+    // Scanning pipeline
+    void startScan(const QStringList& rootPaths, const ScanOptions& options, bool listRoots);
+    void enumerateDirectories(const QStringList& rootPaths, const ScanOptions& options,
+                              const std::shared_ptr<const ScanJournal>& journal, bool listRoots);
+    bool queueExtraction(const QString& filePath, const QString& directoryPath, const JournalFile& journal);
+    void extractFile(const QString& filePath, const QString& directoryPath, const JournalFile& journal);
+    void finishScan();
     void processFile(const QString& filePath);
-    bool shouldProcessFile(const QString& filePath) const;
-    bool shouldProcessDirectory(const QString& directoryPath) const;
+    bool shouldProcessFile(const QFileInfo& fileInfo, const ScanOptions& options) const;
+    bool shouldProcessDirectory(const QString& directoryPath, const ScanOptions& options) const;
+
+    // Scan journal
+    std::shared_ptr<const ScanJournal> loadScanJournal();
+    void collectJournalSubtree(const ScanJournal& journal, const QString& directoryPath,
+                               QStringList& directories, QStringList& files) const;
+    void applyPendingRemovals();
+    void writeDirectoryRecords();
+    static JournalFile journalEntry(const QFileInfo& fileInfo);
 
     // File processing
     MediaFile createMediaFileFromPath(const QString& filePath);
-    bool addOrUpdateMediaFile(const MediaFile& mediaFile);
+    bool addOrUpdateMediaFile(const MediaFile& mediaFile, bool* added = nullptr);
+    void applyScanResult(const ScanResult& result);
     void updateScanProgress();
 
     // Duplicate detection helpers
-    QString calculateFileHash(const QString& filePath);
-    QHash<QString, QStringList> groupFilesByHash();
+    struct DuplicateCandidate {
+        QString filePath;
+        qint64 fileSize = 0;
+        qint64 modifiedTime = 0;
+        QString sampleHash;
+        QString contentHash;
+        qint64 hashFileSize = -1;       // Size and mtime the stored hashes belong to
+        qint64 hashModifiedTime = -1;
+        bool exists = false;
+        bool hashesChanged = false;
+    };
+
+    void resolveDuplicateCandidates(QVector<DuplicateCandidate>& candidates, QList<QStringList>& duplicateGroups);
+    static QString sampleFileHash(const QString& filePath, qint64 fileSize);
+    static QString contentFileHash(const QString& filePath);
     QHash<QString, QStringList> groupFilesByMetadata();
 
+    struct FingerprintCandidate {
+        int id = -1;
+        QString filePath;
+        qint64 fileSize = 0;
+        qint64 duration = 0;
+        qint64 modifiedTime = 0;
+        QByteArray fingerprint;
+        bool changed = false;
+    };
+
     // File watching helpers
     void setupFileWatcher();
     void addDirectoryToWatcher(const QString& directoryPath);
@@ -152,23 +283,32 @@ private:
     ScanOptions m_options;
     ScanProgress m_progress;
     bool m_isScanning;
-    bool m_cancelRequested;
+    std::atomic<bool> m_cancelRequested;
 
     // File watching
-    QFileSystemWatcher* m_fileWatcher;
+    DirectoryWatcher* m_directoryWatcher;
     bool m_fileWatchingEnabled;
     QStringList m_watchDirectories;
     QTimer* m_watcherTimer;
-    QStringList m_watcherQueue;
+    QStringList m_watcherQueue;         // Changed directories awaiting a scan
     mutable QMutex m_watcherMutex;
 
-    // Duplicate detection cache
-    QHash<QString, QString> m_fileHashCache;
-    mutable QHash<QString, QDateTime> m_fileModificationCache;
+    // Duplicate detection
+    QThreadPool* m_hashPool;
 
     // Threading
-    QThread* m_scanThread;
-    mutable QMutex m_progressMutex;
+    QThread* m_scanThread;              // Enumeration and filtering
+    QThreadPool* m_extractPool;         // MediaFile creation
+    QSemaphore m_inFlightSlots;         // Backpressure from the writer
+    std::atomic<bool> m_enumerationDone;
+    QMutex m_resultMutex;               // Guards the pending queues below
+    QVector<ScanResult> m_pendingResults;
+    QStringList m_pendingRemovals;
+    QStringList m_pendingDirectoryRemovals;
+    QVector<DirectoryRecord> m_pendingDirectories;
+    QSet<QString> m_failedDirectories;  // Not journaled, so retried next scan
+    QTimer* m_writerTimer;
+    mutable QMutex m_progressMutex;     // Guards m_progress
 
     // Statistics cache
     mutable int m_cachedFileCount;
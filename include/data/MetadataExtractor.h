@@ -5,10 +5,13 @@
 #include <QString>
 #include <QStringList>
 #include <QHash>
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QTimer>
 #include <QMutex>
+#include <QThreadPool>
+#include <deque>
+
+class QSqlDatabase;
 
 namespace EonPlay {
 namespace Data {
@@ -18,6 +21,18 @@ namespace Data {
  * 
  * Provides comprehensive metadata extraction from audio and video files
  * using local libraries and web APIs for enhanced information.
+ *
+ * Results are cached in an SQLite file in cacheDirectory(), keyed by path
+ * and checked against the file's size and modification time, so a warm
+ * start does not run TagLib or FFmpeg again. The cache is size-bounded
+ * and drops the least recently used entries first. The same file keeps the
+ * keyframe tables SeekIndexer builds for files without an index of their
+ * own, under the same checks and the same bound.
+ *
+ * Batches from extractMetadataBatch() run on two worker pools, one for
+ * local disks and one for network shares, each with its own concurrency
+ * bound. Files not yet started can be moved to the front of the queue
+ * with boostPriority() or dropped with cancelBatch().
  */
 class MetadataExtractor : public QObject
 {
@@ -30,6 +45,11 @@ public:
         WebOnly         // Use only web APIs (for testing)
     };
 
+    enum DeliveryOrder {
+        Unordered,      // Report each file as soon as it is done
+        Ordered         // Report files in the order they were submitted
+    };
+
     struct ExtractionOptions {
         ExtractionMethod method = WebEnhanced;
         bool extractCoverArt = true;
@@ -70,7 +90,7 @@ public:
     };
 
     explicit MetadataExtractor(QObject* parent = nullptr);
-    ~MetadataExtractor() = default;
+    ~MetadataExtractor();
 
     // Configuration
     void setExtractionOptions(const ExtractionOptions& options) { m_options = options; }
@@ -84,6 +104,26 @@ public:
     MediaMetadata extractMetadataSync(const QString& filePath);
     void extractMetadataForFiles(const QStringList& filePaths);
 
+    /**
+     * @brief Extract metadata and cover art for files on the worker pools
+     * @param filePaths Files to extract, in submission order
+     * @param order Whether results are reported in submission order
+     * @return Batch identifier passed to batchFinished() and cancelBatch()
+     */
+    int extractMetadataBatch(const QStringList& filePaths, DeliveryOrder order = Unordered);
+    void cancelBatch(int batchId);
+    void cancelAllExtractions();
+
+    /**
+     * @brief Start these files before any other queued file, e.g. rows that became visible
+     */
+    void boostPriority(const QStringList& filePaths);
+
+    void setLocalConcurrency(int threads);
+    int localConcurrency() const { return m_localPool->maxThreadCount(); }
+    void setNetworkConcurrency(int threads);
+    int networkConcurrency() const { return m_networkPool->maxThreadCount(); }
+
     // Cover art extraction
     void extractCoverArt(const QString& filePath, const QString& outputPath = QString());
     QString extractCoverArtSync(const QString& filePath, const QString& outputPath = QString());
@@ -96,6 +136,24 @@ public:
     void setCacheDirectory(const QString& directory);
     QString cacheDirectory() const { return m_cacheDirectory; }
 
+    /**
+     * @brief Bound on the cache file's content, in bytes
+     */
+    void setCacheSizeLimit(qint64 bytes);
+    qint64 cacheSizeLimit() const;
+
+    /**
+     * @brief Read the stored seek index of a file, if it is still current
+     * @param data Receives the serialized SeekIndex; empty if the file was found to need none
+     * @return false if nothing is stored for the file as it is now
+     */
+    bool loadSeekIndex(const QString& filePath, QByteArray* data);
+
+    /**
+     * @brief Store a serialized SeekIndex, or an empty one for a file that needs none
+     */
+    void saveSeekIndex(const QString& filePath, const QByteArray& data);
+
     // Supported formats
     static QStringList supportedAudioFormats();
     static QStringList supportedVideoFormats();
@@ -108,18 +166,47 @@ signals:
     void coverArtExtractionFailed(const QString& filePath, const QString& error);
     void webEnhancementCompleted(const QString& filePath, const MediaMetadata& enhancedMetadata);
     void webEnhancementFailed(const QString& filePath, const QString& error);
+    void batchFinished(int batchId);
 
 private slots:
     void handleNetworkReply();
 
 private:
+    struct ExtractionJob {
+        int batchId;
+        int index;
+        QString filePath;
+    };
+
+    struct ExtractionResult {
+        MediaMetadata metadata;
+        QString error;
+        bool done = false;
+    };
+
+    struct ExtractionBatch {
+        DeliveryOrder order;
+        QStringList filePaths;
+        QList<ExtractionResult> results;
+        int nextToDeliver = 0;
+        int remaining = 0;
+    };
+
+    // Batch scheduling, on the extractor's thread
+    void dispatchJobs();
+    void runJob(const ExtractionJob& job);
+    void completeJob(const ExtractionJob& job, bool network, const ExtractionResult& result);
+    void deliverResult(const QString& filePath, const ExtractionResult& result);
+    bool isNetworkFile(const QString& filePath);
+
     // Local metadata extraction
+    MediaMetadata extractLocalMetadata(const QString& filePath, bool withCoverArt = false);
     MediaMetadata extractLocalMetadata(const QString& filePath);
     MediaMetadata extractWithTagLib(const QString& filePath);
-    MediaMetadata extractWithFFmpeg(const QString& filePath);
+    MediaMetadata extractWithFFmpeg(const QString& filePath, bool* hasCoverArt = nullptr);
     MediaMetadata extractWithVLC(const QString& filePath);
 
-    // Cover art extraction
+    // Cover art extraction, into the cover art store when outputPath is empty
     QString extractCoverArtWithTagLib(const QString& filePath, const QString& outputPath);
     QString extractCoverArtWithFFmpeg(const QString& filePath, const QString& outputPath);
 
@@ -130,13 +217,18 @@ private:
     void fetchFromDiscogs(const MediaMetadata& metadata, const QString& filePath);
 
     // Utility methods
-    QString generateCoverArtPath(const QString& filePath, const QString& outputDir = QString());
     QString calculateMetadataHash(const MediaMetadata& metadata);
     MediaMetadata loadFromCache(const QString& filePath);
     void saveToCache(const QString& filePath, const MediaMetadata& metadata);
+    bool readCacheRecord(const QString& table, const QString& filePath, QByteArray* data);
+    void writeCacheRecord(const QString& table, const QString& filePath, const QByteArray& data);
+    void removeCacheRecord(const QString& table, const QString& filePath, qint64 dataBytes);
+    QSqlDatabase cacheDatabase();
+    void closeCacheDatabases();
+    void evictFromCache();
     
     // Network helpers
-    void setupNetworkManager();
+    QNetworkReply* getRequest(const QNetworkRequest& request);
     QNetworkRequest createApiRequest(const QString& url, const QString& service);
     void processWebResponse(const QByteArray& data, const QString& service, 
                            const QString& filePath, const MediaMetadata& originalMetadata);
@@ -156,15 +248,25 @@ private:
     QString m_cacheDirectory;
     
     // Network management
-    QNetworkAccessManager* m_networkManager;
     QHash<QNetworkReply*, QString> m_pendingRequests;
     QHash<QNetworkReply*, MediaMetadata> m_pendingMetadata;
     
-    // Caching
-    QHash<QString, MediaMetadata> m_metadataCache;
-    QHash<QString, QDateTime> m_cacheTimestamps;
+    // Caching, one connection per thread that touched the cache
+    QStringList m_cacheConnections;
+    qint64 m_cacheBytes;            // -1 until counted
+    qint64 m_cacheSizeLimit;
     mutable QMutex m_cacheMutex;
     
+    // Batch extraction
+    QThreadPool* m_localPool;
+    QThreadPool* m_networkPool;
+    std::deque<ExtractionJob> m_jobQueue;
+    QHash<int, ExtractionBatch> m_batches;
+    QHash<QString, bool> m_networkDirectories;
+    int m_nextBatchId;
+    int m_localInFlight;
+    int m_networkInFlight;
+    
     // External tool paths
     QString m_ffmpegPath;
     QString m_ffprobePath;
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "data/VideoFingerprint.h"
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QtGlobal>
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Locality-sensitive index of video fingerprints for near-duplicate search
+ *
+ * Every valid frame hash is cut into BANDS bands of 16 bits, and each band
+ * files the video in a bucket keyed by the frame's sample position, the
+ * band and its bits. Two encodes of one video differ in a few bits per
+ * frame, so at least one of their SAMPLE_COUNT * BANDS bands almost surely
+ * matches exactly and they meet in a bucket. Only videos sharing a bucket
+ * are compared, which keeps a query near constant time and grouping a
+ * whole library near linear instead of comparing every pair.
+ *
+ * Buckets holding more than MAX_BUCKET_SIZE videos come from generic
+ * frames (logos, test cards) and are not used to pair videos.
+ */
+class NearDuplicateIndex
+{
+public:
+    static constexpr int BANDS = 4;
+    static constexpr int MAX_BUCKET_SIZE = 256;
+    static constexpr int DEFAULT_MAX_DISTANCE = 10;     // Mean pHash bits per frame
+
+    void insert(int id, const VideoFingerprint& fingerprint);
+    void clear();
+    int size() const { return m_ids.size(); }
+
+    /**
+     * @brief Find indexed videos within a distance of a fingerprint
+     * @return Ids, nearest first
+     */
+    QList<int> query(const VideoFingerprint& fingerprint, int maxDistance = DEFAULT_MAX_DISTANCE) const;
+
+    /**
+     * @brief Group the indexed videos that are within a distance of each other, transitively
+     * @return Groups of two or more ids
+     */
+    QList<QList<int>> groups(int maxDistance = DEFAULT_MAX_DISTANCE) const;
+
+private:
+    static quint64 bucketKey(int frame, int band, quint64 hash);
+
+    QVector<int> m_ids;
+    QVector<VideoFingerprint> m_fingerprints;       // Parallel to m_ids
+    QHash<quint64, QVector<int>> m_buckets;         // Positions in m_ids
+};
+
+} // namespace Data
+} // namespace EonPlay
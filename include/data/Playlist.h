@@ -1,10 +1,13 @@
 #pragma once
 
 #include "data/MediaFile.h"
+#include "data/PlaylistFile.h"
+#include "data/ShuffleOrder.h"
 #include <QObject>
 #include <QString>
 #include <QDateTime>
 #include <QList>
+#include <QHash>
 #include <QVariant>
 
 namespace EonPlay {
@@ -16,6 +19,10 @@ class DatabaseManager;
  * @brief Represents a playlist in the EonPlay library
  * 
  * Manages a collection of media files with ordering and metadata.
+ *
+ * Lookups by path or library id and searches go through indexes built on
+ * first use. Appending keeps them current; other edits drop them until
+ * the next lookup.
  */
 class Playlist : public QObject
 {
@@ -52,6 +59,8 @@ public:
     const QList<MediaFile>& items() const { return m_items; }
     MediaFile item(int index) const;
     int indexOf(const MediaFile& file) const;
+    int indexOfPath(const QString& filePath) const;
+    int indexOfId(int mediaFileId) const;
     bool contains(const MediaFile& file) const;
     bool containsPath(const QString& filePath) const;
 
@@ -63,6 +72,12 @@ public:
     bool moveItem(int fromIndex, int toIndex);
     void clear();
 
+    /**
+     * @brief Swap every item with the same library id for a newer snapshot
+     * @return Number of items replaced
+     */
+    int updateItem(const MediaFile& snapshot);
+
     // Batch operations
     void addItems(const QList<MediaFile>& files);
     void removeItems(const QList<int>& indices);
@@ -74,6 +89,14 @@ public:
     
     MediaFile nextItem() const;
     MediaFile previousItem() const;
+
+    /**
+     * @brief Get the items that play after the current one, in play order
+     *
+     * Follows the shuffled order when shuffle is on and wraps around with
+     * RepeatAll, so the first item is nextItem(). No item is listed twice.
+     */
+    QList<MediaFile> upcomingItems(int count) const;
     bool hasNext() const;
     bool hasPrevious() const;
 
@@ -87,6 +110,13 @@ public:
     bool isShuffled() const { return m_shuffled; }
     void setShuffle(bool enabled);
 
+    /**
+     * @brief Favour some items early in the shuffled order; takes effect on the next reshuffle
+     */
+    ShuffleOrder::Weighting shuffleWeighting() const { return m_shuffleWeighting; }
+    void setShuffleWeighting(ShuffleOrder::Weighting weighting);
+    void reshuffle();
+
     RepeatMode repeatMode() const { return m_repeatMode; }
     void setRepeatMode(RepeatMode mode) { m_repeatMode = mode; }
 
@@ -152,9 +182,32 @@ private slots:
 
 private:
     void generateShuffleOrder();
+    int upcomingShufflePosition() const;
     int getShuffledIndex(int logicalIndex) const;
     int getLogicalIndex(int shuffledIndex) const;
     void copyFrom(const Playlist& other);
+    QList<PlaylistFile::Entry> exportEntries() const;
+    bool importEntries(const QString& filePath);
+
+    // Lookup indexes over m_items
+    struct ItemKeys {
+        QString search;     // Title, artist, album and file name, lowercased
+        QString artist;     // Case folded
+        QString album;
+        QString genre;
+    };
+
+    void invalidateIndex() { m_indexValid = false; }
+    void ensureIndex() const;
+    void indexItem(int index) const;
+    static ItemKeys makeItemKeys(const MediaFile& file);
+
+    // Rows of playlist_items as of the last load() or save()
+    struct SavedItem {
+        qint64 rowId;
+        int mediaFileId;
+        qint64 position;
+    };
 
     // Core properties
     int m_id;
@@ -166,11 +219,18 @@ private:
     // Items
     QList<MediaFile> m_items;
     int m_currentIndex;
+    QList<SavedItem> m_savedItems;
+
+    mutable QHash<QString, int> m_pathIndex;    // First index of each path
+    mutable QHash<int, int> m_idIndex;          // First index of each library id
+    mutable QList<ItemKeys> m_itemKeys;
+    mutable bool m_indexValid;
 
     // Playback modes
     bool m_shuffled;
     RepeatMode m_repeatMode;
-    QList<int> m_shuffleOrder;
+    ShuffleOrder::Weighting m_shuffleWeighting;
+    ShuffleOrder m_shuffleOrder;
 
     // Cached statistics
     mutable qint64 m_cachedTotalDuration;
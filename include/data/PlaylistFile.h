@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Reads and writes M3U and PLS playlist files
+ *
+ * Entries are read in file order and handed over in batches, so callers
+ * can resolve a batch against the library before reading on instead of
+ * building every item first. Writes are gathered in a buffer and go to
+ * disk in large blocks through QSaveFile.
+ *
+ * All methods are static and safe to call from any thread.
+ */
+class PlaylistFile
+{
+public:
+    enum Format {
+        M3U,
+        PLS,
+        UnknownFormat
+    };
+
+    struct Entry {
+        QString filePath;           // Absolute, with '/' separators
+        QString title;
+        qint64 duration = -1;       // Seconds, -1 when the file gives none
+    };
+
+    static const int DEFAULT_BATCH_SIZE = 1000;
+
+    /**
+     * @brief Called with each batch of entries; return false to stop reading
+     */
+    using BatchHandler = std::function<bool(const QList<Entry>& entries)>;
+
+    /**
+     * @brief Get the format from a playlist file's extension
+     */
+    static Format formatForPath(const QString& playlistPath);
+
+    /**
+     * @brief Read a playlist file batch by batch
+     *
+     * Relative paths are resolved against the playlist's directory and
+     * entries that are not supported media files are skipped.
+     * @return false if the file could not be read or the handler stopped early
+     */
+    static bool read(const QString& playlistPath, const BatchHandler& handler,
+                     int batchSize = DEFAULT_BATCH_SIZE);
+    static QList<Entry> readAll(const QString& playlistPath);
+
+    /**
+     * @brief Write a playlist file, replacing it only once fully written
+     */
+    static bool write(const QString& playlistPath, Format format, const QList<Entry>& entries);
+
+    /**
+     * @brief Check which files exist, several at a time
+     * @return One flag per path, in the same order
+     */
+    static QList<bool> filesExist(const QStringList& paths);
+};
+
+} // namespace Data
+} // namespace EonPlay
@@ -2,6 +2,7 @@
 
 #include "data/Playlist.h"
 #include "data/MediaFile.h"
+#include "media/IResumeStore.h"
 #include <QObject>
 #include <QString>
 #include <QStringList>
@@ -9,21 +10,39 @@
 #include <QTimer>
 #include <QDateTime>
 #include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSet>
+#include <QPointer>
+#include <QDataStream>
+#include <functional>
 #include <memory>
 
+class NetworkDiscoveryManager;
+
 namespace EonPlay {
 namespace Data {
 
 class DatabaseManager;
 class LibraryManager;
+class MediaFileCache;
 
 /**
  * @brief Manages playlists and playback history for EonPlay
  * 
  * Provides comprehensive playlist management including manual playlists,
  * smart playlists, playback history, and watch progress tracking.
+ *
+ * The play queue is stored as rows ordered by sparse sort keys, so adding,
+ * removing or moving an item touches only that item's row. Changes are
+ * recorded as operations and written together in one transaction shortly
+ * after the last change.
+ *
+ * Watch progress doubles as the player's resume store. Saves go through
+ * the same write-behind buffer as playback positions, a resume lookup is
+ * one primary-key search of a WITHOUT ROWID table, and only the most
+ * recently watched MAX_WATCH_PROGRESS_ENTRIES files are kept.
  */
-class PlaylistManager : public QObject
+class PlaylistManager : public QObject, public IResumeStore
 {
     Q_OBJECT
 
@@ -71,10 +90,11 @@ public:
         double percentage = 0.0;    // Completion percentage
         bool completed = false;
         QString deviceId;
+        qint64 clock = 0;           // Logical clock of the write, for last-writer-wins merges
     };
 
     explicit PlaylistManager(DatabaseManager* dbManager, QObject* parent = nullptr);
-    ~PlaylistManager() = default;
+    ~PlaylistManager();
 
     // Initialization
     void setLibraryManager(LibraryManager* libraryManager) { m_libraryManager = libraryManager; }
@@ -100,6 +120,12 @@ public:
     // Smart playlists
     int createSmartPlaylist(const QString& name, const SmartPlaylistCriteria& criteria);
     bool updateSmartPlaylist(int playlistId, const SmartPlaylistCriteria& criteria);
+    /**
+     * @brief Re-query a smart playlist in the background
+     * 
+     * The query runs on a reader connection of the database executor;
+     * smartPlaylistRefreshed() is emitted once the content is replaced.
+     */
     void refreshSmartPlaylist(int playlistId);
     void refreshAllSmartPlaylists();
     bool isSmartPlaylist(int playlistId);
@@ -118,6 +144,10 @@ public:
     void updatePlaybackPosition(const QString& filePath, qint64 position);
     void markPlaybackCompleted(const QString& filePath);
     
+    // Positions and watch progress are buffered and written every few
+    // seconds; call on pause, stop and quit to write them straight away
+    void flushPlaybackWrites();
+    
     QList<PlaybackHistoryEntry> getPlaybackHistory(int limit = 100);
     QList<PlaybackHistoryEntry> getPlaybackHistoryForFile(const QString& filePath);
     PlaybackHistoryEntry getLastPlaybackEntry(const QString& filePath);
@@ -132,19 +162,42 @@ public:
     void clearCompletedWatchProgress();
     void clearOldWatchProgress(int days = 30);
     
+    // IResumeStore, on top of watch progress
+    qint64 resumePosition(const QString& filePath) override;
+    void saveResumePosition(const QString& filePath, qint64 position, qint64 duration) override;
+    void clearResumePosition(const QString& filePath) override;
+    
+    static constexpr int MAX_WATCH_PROGRESS_ENTRIES = 10000;
+    
+    // How far a peer's progress clock may run ahead of ours; deltas beyond it are malformed
+    static constexpr qint64 MAX_PROGRESS_CLOCK_AHEAD = 1000000;
+    
     // Multi-device sync
     void setDeviceId(const QString& deviceId) { m_deviceId = deviceId; }
     QString deviceId() const { return m_deviceId; }
     void syncWatchProgress(const QList<WatchProgress>& remoteProgress);
     QList<WatchProgress> getWatchProgressForSync(const QDateTime& since = QDateTime());
     
+    /**
+     * @brief Delta sync of watch progress between devices
+     * 
+     * A request carries the watermarks this device holds for its peers. A
+     * peer answers with the rows it changed after its watermark, and the
+     * reply is merged in one transaction by logical clock. The reply to a
+     * message is returned, or an empty array when there is nothing to send.
+     */
+    QByteArray createWatchProgressSyncRequest();
+    QByteArray handleWatchProgressSyncMessage(const QByteArray& message);
+    void attachSyncGroup(NetworkDiscoveryManager* network, const QString& groupId);
+    
     // Queue management
     void setCurrentQueue(const QList<MediaFile>& files);
     void addToQueue(const MediaFile& file);
     void addToQueue(const QList<MediaFile>& files);
     void removeFromQueue(int position);
+    void moveInQueue(int fromPosition, int toPosition);
     void clearQueue();
-    void shuffleQueue();
+    void shuffleQueue(ShuffleOrder::Weighting weighting = ShuffleOrder::Uniform);
     QList<MediaFile> getCurrentQueue();
     
     // Statistics and analytics
@@ -191,6 +244,8 @@ signals:
 
 private slots:
     void performPeriodicMaintenance();
+    void flushQueueOperations();
+    void applySmartPlaylistChanges();
 
 private:
     // Database operations
@@ -201,20 +256,59 @@ private:
     bool createQueueTable();
     
     // Smart playlist helpers
-    QList<MediaFile> generateSmartPlaylistContent(const SmartPlaylistCriteria& criteria);
-    QString buildSmartPlaylistQuery(const SmartPlaylistCriteria& criteria);
+    QList<MediaFile> generateSmartPlaylistContent(const SmartPlaylistCriteria& criteria,
+                                                  QVariantList* sortValues = nullptr);
+    static QString buildSmartPlaylistQuery(const SmartPlaylistCriteria& criteria);
+    static QList<MediaFile> runSmartPlaylistQuery(QSqlQuery& query, const SmartPlaylistCriteria& criteria,
+                                                  MediaFileCache* cache, QVariantList* sortValues = nullptr);
     void updateSmartPlaylistContent(int playlistId, const QList<MediaFile>& files);
     
+    // Incremental smart playlist maintenance
+    struct SmartPlaylistMatcher {
+        std::function<bool(const QSqlRecord&)> matches;     // Same test as the WHERE clause
+        QString sortField;
+        bool descending = false;
+        int limit = 0;
+    };
+    
+    struct SmartPlaylistMember {
+        int mediaFileId;
+        QVariant sortValue;
+    };
+    
+    static SmartPlaylistMatcher compileSmartPlaylistCriteria(const SmartPlaylistCriteria& criteria);
+    static int compareSortValues(const QVariant& a, const QVariant& b);
+    void setSmartPlaylistMembers(int playlistId, const QList<MediaFile>& files, const QVariantList& sortValues);
+    void queueSmartPlaylistChange(int mediaFileId);
+    bool applySmartPlaylistRow(int playlistId, const QSqlRecord& record);
+    bool removeSmartPlaylistMember(int playlistId, int mediaFileId);
+    
+    // Watch progress sync helpers
+    QByteArray createWatchProgressDelta(const QString& requesterId, qint64 sinceSeq);
+    int applyWatchProgressDelta(QDataStream& in, bool* more);
+    void loadWatchProgressClocks();
+    void pruneWatchProgress();
+    
     // History helpers
     void cleanupOldHistory();
     void updatePlayCount(const QString& filePath);
     
     // Queue helpers
-    void saveQueueToDatabase();
+    struct QueueOperation {
+        enum Type { Insert, Remove, Move, Clear };
+        Type type;
+        qint64 key;             // Sort key of the row, new key for Move
+        qint64 oldKey;          // Move only
+        QString filePath;       // Insert only
+    };
+
+    qint64 queueKeyBefore(int position, bool* rewritten = nullptr);
+    void insertIntoQueue(int position, const MediaFile& file);
+    void rewriteQueue();
+    void recordQueueOperation(const QueueOperation& operation);
     void loadQueueFromDatabase();
     
     // Utility methods
-    MediaFile createMediaFileFromQuery(const QSqlQuery& query);
     QString generateUniquePlaylistName(const QString& baseName);
     bool isValidPlaylistName(const QString& name);
     
@@ -223,12 +317,23 @@ private:
     LibraryManager* m_libraryManager;
     QString m_deviceId;
     
-    // Current queue
+    // Current queue, with the sort key of each item
     QList<MediaFile> m_currentQueue;
+    QList<qint64> m_queueKeys;
+    QList<QueueOperation> m_pendingQueueOperations;
+    QTimer* m_queueFlushTimer;
     
     // Smart playlist cache
     QHash<int, SmartPlaylistCriteria> m_smartPlaylistCriteria;
     QHash<int, QDateTime> m_smartPlaylistLastRefresh;
+    QHash<int, SmartPlaylistMatcher> m_smartPlaylistMatchers;
+    QHash<int, QList<SmartPlaylistMember>> m_smartPlaylistMembers;  // In playlist order, once queried
+    
+    // Library rows changed since the last incremental pass
+    QSet<int> m_changedMediaIds;
+    QSet<QString> m_changedMediaPaths;
+    QSet<int> m_removedMediaIds;
+    QTimer* m_smartPlaylistTimer;
     
     // Maintenance timer
     QTimer* m_maintenanceTimer;
@@ -236,6 +341,19 @@ private:
     // Watch progress cache
     QHash<QString, WatchProgress> m_watchProgressCache;
     QDateTime m_watchProgressCacheTime;
+    
+    // Writes not yet flushed, latest value per file
+    QHash<QString, qint64> m_pendingPlaybackPositions;
+    QHash<QString, WatchProgress> m_pendingWatchProgress;
+    QTimer* m_playbackFlushTimer;
+    
+    // Watch progress sync: highest logical clock seen, and the sequence
+    // number given to each locally stored change
+    qint64 m_progressClock = 0;
+    qint64 m_progressChangeSeq = 0;
+    QPointer<NetworkDiscoveryManager> m_syncNetwork;
+    QString m_syncGroupId;
+    QTimer* m_progressSyncTimer;
 };
 
 } // namespace Data
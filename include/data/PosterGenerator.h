@@ -0,0 +1,123 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QSet>
+#include <QTimer>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+
+namespace EonPlay {
+namespace Data {
+
+class DatabaseManager;
+
+/**
+ * @brief Makes poster frames, and optionally animated previews, for library videos without cover art
+ *
+ * After each scan, videos whose metadata brought no embedded art are
+ * queued and handled in parallel on a low-priority pool. For each, FFmpeg
+ * decodes only the keyframes of the first ANALYSIS_WINDOW_MS, with
+ * hardware acceleration where available, scaled down to SceneDetector's
+ * small grey frames on its side of the pipe. Leading black and flat frames
+ * are the intro and are skipped; of the scenes after it, long enough not
+ * to be a flash or a title card, the most detailed frame away from a cut
+ * becomes the poster. That one frame is decoded again at POSTER_WIDTH and
+ * goes into the CoverArtStore like any embedded cover, so the views and
+ * their pre-scaled thumbnails need nothing new. A preview is a
+ * PREVIEW_SECONDS GIF from the same position, kept with the poster.
+ *
+ * Paths are written in batched transactions. Videos that fail are not
+ * retried until the application restarts.
+ */
+class PosterGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_IN_FLIGHT_PER_THREAD = 1;     // Each job already runs a multi-threaded decoder
+    static constexpr int WRITE_BATCH_SIZE = 32;
+    static constexpr int WRITE_INTERVAL_MS = 1000;
+    static constexpr qint64 ANALYSIS_WINDOW_MS = 10 * 60 * 1000;
+    static constexpr int POSTER_WIDTH = 640;
+    static constexpr int PREVIEW_WIDTH = 240;
+    static constexpr int PREVIEW_SECONDS = 3;
+    static constexpr int PREVIEW_FPS = 8;
+
+    explicit PosterGenerator(DatabaseManager* dbManager, QObject* parent = nullptr);
+    ~PosterGenerator();
+
+    /**
+     * @brief Queue every library video without cover art
+     */
+    void generatePending();
+
+    /**
+     * @brief Drop queued videos and kill running decoders
+     */
+    void cancel();
+
+    /**
+     * @brief Also make an animated preview for each new poster
+     */
+    void setPreviewsEnabled(bool enabled) { m_previewsEnabled = enabled; }
+    bool previewsEnabled() const { return m_previewsEnabled; }
+
+    bool isRunning() const { return m_inFlight > 0 || !m_queue.isEmpty(); }
+    int queuedFiles() const { return m_queue.size(); }
+
+signals:
+    void postersStarted(int totalFiles);
+    void postersProgress(int processedFiles, int totalFiles);
+    void postersFinished(int generatedFiles, int failedFiles);
+
+private slots:
+    void writePendingResults();
+
+private:
+    struct Job {
+        int mediaFileId = -1;
+        QString filePath;
+        qint64 duration = 0;
+    };
+
+    struct Result {
+        Job job;
+        QString coverArtPath;           // Empty if no poster could be made
+    };
+
+    void startWorkers();
+    void onFileFinished(const Result& result);
+
+    /**
+     * @brief Find the poster position of a video, on the calling thread
+     * @return Milliseconds, or -1 if the video could not be decoded
+     */
+    qint64 findPosterTime(const Job& job) const;
+
+    /**
+     * @brief Make the poster and preview of a video, on the calling thread
+     */
+    QString generate(const Job& job, bool withPreview) const;
+
+    DatabaseManager* m_dbManager;
+    QString m_ffmpegPath;
+    QThreadPool* m_pool;
+    QTimer* m_writerTimer;
+    bool m_previewsEnabled;
+
+    QList<Job> m_queue;
+    QSet<int> m_queued;
+    QSet<int> m_failed;
+    QVector<Result> m_pendingResults;
+    int m_inFlight;
+    int m_totalFiles;
+    int m_generatedFiles;
+    int m_failedFiles;
+    std::atomic<bool> m_cancelled;
+};
+
+} // namespace Data
+} // namespace EonPlay
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <QObject>
+#include <QFuture>
+#include <QPromise>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+class QThread;
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Runs SQL off the GUI thread on connections of its own
+ *
+ * SQLite in WAL mode lets any number of readers run next to one writer,
+ * so the executor keeps a single writer thread and a few reader threads.
+ * Each thread opens its own connection (a QSqlDatabase cannot be used
+ * from another thread) and takes work from its lane's queue. Results come
+ * back as QFuture; QFuture::then() with a context object delivers them on
+ * that object's thread.
+ *
+ * Work runs on executor threads and must only use the connection it is
+ * handed. Reader connections are query_only. Writes still share SQLite's
+ * write lock with DatabaseManager's GUI-thread connection; the busy
+ * timeout makes either side wait instead of failing.
+ */
+class QueryExecutor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_READER_COUNT = 2;
+    static constexpr int BUSY_TIMEOUT_MS = 30000;
+
+    explicit QueryExecutor(QObject* parent = nullptr);
+    ~QueryExecutor() override;
+
+    /**
+     * @brief Start the writer and reader threads
+     * @param databasePath Database file, already created and migrated
+     * @param readerCount Number of reader connections
+     * @return true if the threads were started
+     */
+    bool open(const QString& databasePath, int readerCount = DEFAULT_READER_COUNT);
+
+    /**
+     * @brief Finish all queued work and close every connection
+     */
+    void close();
+
+    bool isOpen() const { return m_open; }
+
+    /**
+     * @brief Queue work for a reader connection
+     * @param function Callable taking QSqlDatabase&; its return value is the result
+     * @return Future of the result; default-constructed if the executor is closed
+     */
+    template <typename Function>
+    auto read(Function&& function) -> QFuture<std::invoke_result_t<Function, QSqlDatabase&>>
+    {
+        return submit(m_readLane, std::forward<Function>(function));
+    }
+
+    /**
+     * @brief Queue work for the writer connection; writes run in queue order
+     */
+    template <typename Function>
+    auto write(Function&& function) -> QFuture<std::invoke_result_t<Function, QSqlDatabase&>>
+    {
+        return submit(m_writeLane, std::forward<Function>(function));
+    }
+
+private:
+    using Task = std::function<void(QSqlDatabase&)>;
+
+    struct Lane {
+        QMutex mutex;
+        QWaitCondition condition;
+        QQueue<Task> tasks;
+        QVector<QThread*> threads;
+        bool stopping = true;       // Until open()
+    };
+
+    template <typename Function>
+    auto submit(Lane& lane, Function&& function) -> QFuture<std::invoke_result_t<Function, QSqlDatabase&>>;
+
+    bool enqueue(Lane& lane, Task task);
+    void startThreads(Lane& lane, int count, const QString& connectionPrefix, bool readOnly);
+    void stopThreads(Lane& lane);
+    void run(Lane& lane, const QString& connectionName, bool readOnly);
+
+    QString m_databasePath;
+    bool m_open;
+    Lane m_writeLane;
+    Lane m_readLane;
+};
+
+template <typename Function>
+auto QueryExecutor::submit(Lane& lane, Function&& function)
+    -> QFuture<std::invoke_result_t<Function, QSqlDatabase&>>
+{
+    using Result = std::invoke_result_t<Function, QSqlDatabase&>;
+
+    auto promise = std::make_shared<QPromise<Result>>();
+    QFuture<Result> future = promise->future();
+    promise->start();
+
+    auto task = [promise, function = std::forward<Function>(function)](QSqlDatabase& database) mutable {
+        if constexpr (std::is_void_v<Result>) {
+            function(database);
+        } else {
+            promise->addResult(function(database));
+        }
+        promise->finish();
+    };
+
+    if (!enqueue(lane, std::move(task))) {
+        // Completed right away so continuations still run
+        if constexpr (!std::is_void_v<Result>) {
+            promise->addResult(Result());
+        }
+        promise->finish();
+    }
+
+    return future;
+}
+
+} // namespace Data
+} // namespace EonPlay
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "data/MediaFile.h"
+#include "media/IPrefetchCache.h"
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <list>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+
+namespace EonPlay {
+namespace Data {
+
+class Playlist;
+class PlaylistManager;
+
+/**
+ * @brief Copies the next items of the play queue from slow storage to a local disk cache
+ *
+ * Follows the queue of a PlaylistManager and the play order of a Playlist,
+ * shuffled or not, and keeps the first depth() upcoming items copied:
+ * queued items first, as they play before the playlist goes on. Audio up
+ * to MAX_WHOLE_BYTES is copied whole; anything else only its first
+ * prefixBytes(), which covers the open and the first minutes of playback.
+ *
+ * Only files on network mounts (SMB, NFS, sshfs and the like) and audio
+ * behind http(s) URLs, such as podcast episodes, are copied. Files are
+ * read one at a time on a low-priority thread at background I/O priority,
+ * URLs are fetched one at a time. Moving on in the playlist or editing the
+ * queue drops copies in progress of items no longer upcoming.
+ *
+ * Copies are named by a hash of the source plus its size and modification
+ * time, so a changed source is not played from a stale copy. The cache
+ * survives restarts and past maxSize() evicts the least recently used
+ * copies, never one of the upcoming items or the one handed out last.
+ */
+class QueuePrefetcher : public QObject, public IPrefetchCache
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_DEPTH = 3;
+    static constexpr qint64 DEFAULT_PREFIX_BYTES = 32LL * 1024 * 1024;
+    static constexpr qint64 DEFAULT_MAX_BYTES = 2LL * 1024 * 1024 * 1024;
+    static constexpr qint64 MAX_WHOLE_BYTES = 256LL * 1024 * 1024;
+    static constexpr qint64 COPY_BLOCK_BYTES = 1024 * 1024;
+    static constexpr int REFRESH_DELAY_MS = 500;    // Coalesces queue edits and skips through the playlist
+
+    explicit QueuePrefetcher(const QString& directory = defaultDirectory(), QObject* parent = nullptr);
+    ~QueuePrefetcher() override;
+
+    static QString defaultDirectory();
+
+    /**
+     * @brief Follow a playlist's play order; nullptr stops following one
+     */
+    void setPlaylist(Playlist* playlist);
+
+    /**
+     * @brief Follow a play queue; nullptr stops following one
+     */
+    void setPlaylistManager(PlaylistManager* manager);
+
+    void setDepth(int items);
+    int depth() const { return m_depth; }
+
+    void setPrefixBytes(qint64 bytes);
+    qint64 prefixBytes() const { return m_prefixBytes; }
+
+    void setMaxSize(qint64 bytes);
+    qint64 maxSize() const { return m_maxBytes; }
+    qint64 currentSize() const { return m_currentBytes; }
+
+    bool isCopying() const { return !m_current.isEmpty(); }
+
+    /**
+     * @brief Drop queued copies and stop the one in progress
+     */
+    void cancel();
+
+    /**
+     * @brief Remove every copy
+     */
+    void clear();
+
+    // IPrefetchCache
+    PrefetchedCopy prefetchedCopy(const QString& path) override;
+
+public slots:
+    /**
+     * @brief Look at the upcoming items again and copy those missing
+     */
+    void refresh();
+
+signals:
+    void copyFinished(const QString& path, qint64 bytes, bool complete);
+
+private:
+    struct Entry {
+        QString fileName;
+        qint64 bytes = 0;
+        qint64 sourceSize = 0;
+        qint64 sourceModified = 0;              // Seconds since the epoch, 0 for URLs
+        std::list<QString>::iterator position;  // In m_order
+    };
+
+    struct Job {
+        QString path;
+        bool audio = false;     // Copied whole up to MAX_WHOLE_BYTES
+        bool remote = false;
+    };
+
+    static QString keyOf(const QString& path);
+    static bool isRemote(const QString& path);
+    QString filePath(const QString& fileName) const;
+
+    QList<MediaFile> upcomingItems() const;
+    void startNext();
+    void copyFile(const Job& job);
+    void fetchUrl(const Job& job);
+    void onFetchReadyRead();
+    void onFetchFinished();
+    void onCopied(const QString& path, const QString& partPath, qint64 bytes, qint64 sourceSize,
+                  qint64 sourceModified, bool skipped);
+
+    void loadIndex();
+    void insert(const QString& key, Entry entry);
+    void remove(const QString& key);
+    void evict();
+
+    QString m_directory;
+    QPointer<Playlist> m_playlist;
+    QPointer<PlaylistManager> m_manager;
+    QTimer* m_refreshTimer;
+    QThreadPool* m_pool;
+    QNetworkAccessManager* m_network;
+
+    int m_depth;
+    qint64 m_prefixBytes;
+    qint64 m_maxBytes;
+    qint64 m_currentBytes;
+
+    QHash<QString, Entry> m_entries;            // By key of the source
+    std::list<QString> m_order;                 // Keys, least recently used first
+    QSet<QString> m_pinned;                     // Keys of upcoming items and the copy handed out last
+    QString m_lastHandedOut;
+
+    QList<Job> m_queue;
+    QString m_current;                          // Source being copied
+    QSet<QString> m_skipped;                    // Sources found not to need a copy
+    std::atomic<bool> m_cancelled;
+
+    // URL being fetched
+    QNetworkReply* m_reply;
+    QFile m_fetchFile;
+    qint64 m_fetchedBytes;
+
+    static constexpr int MAX_SKIPPED = 4096;
+};
+
+} // namespace Data
+} // namespace EonPlay
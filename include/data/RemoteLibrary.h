@@ -0,0 +1,133 @@
+#pragma once
+
+#include "data/MediaFile.h"
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+
+class QNetworkReply;
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Client of a library server's remote query API
+ *
+ * Lets LibraryManager show a library another machine scans: queries are
+ * answered from a local read cache of the server's responses, so the views
+ * stay instant, and what is not cached yet is fetched in the background
+ * with resultsReady() once it arrived. The server's revision is polled
+ * every POLL_INTERVAL_MS with If-None-Match, a bodyless 304 while nothing
+ * changed; a new revision drops the cache and emits libraryChanged().
+ * Playlists change without a new revision and are refetched once a poll.
+ *
+ * Items come back with their file path set to the server's media URL for
+ * them, which any player streams with byte ranges.
+ */
+class RemoteLibrary : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int POLL_INTERVAL_MS = 5000;
+    static constexpr int CACHE_SIZE = 256;          // Responses
+    static constexpr int PAGE_SIZE = 500;           // The server's largest page
+
+    struct Totals {
+        int fileCount = 0;
+        qint64 totalSize = 0;
+        qint64 totalDuration = 0;
+    };
+
+    struct Playlist {
+        int id = -1;
+        QString name;
+        int itemCount = 0;
+        qint64 totalDuration = 0;
+        bool smart = false;
+    };
+
+    /**
+     * @param serverUrl e.g. http://192.168.1.10:8080
+     * @param token Bearer token of the server, empty if it needs none
+     */
+    RemoteLibrary(const QUrl& serverUrl, const QString& token, QObject* parent = nullptr);
+    ~RemoteLibrary() override;
+
+    /**
+     * @brief Fetch the server's revision and keep polling it
+     */
+    void connectToServer();
+    void disconnectFromServer();
+    bool isConnected() const { return !m_etag.isEmpty(); }
+
+    QUrl serverUrl() const { return m_serverUrl; }
+    Totals totals() const { return m_totals; }
+
+    // Cached reads: empty until fetched, then resultsReady()
+    /**
+     * @param text Words to search for, empty for every item
+     * @param column "artist", "album" or "genre" to match exactly, or empty
+     * @param sort One of the API's orders, empty for title or relevance
+     */
+    QList<MediaFile> search(const QString& text, const QString& column = QString(), const QString& value = QString(),
+                            const QString& sort = QString(), bool descending = false, int limit = PAGE_SIZE);
+    QStringList facetValues(const QString& facet);
+    QList<Playlist> playlists();
+    QList<MediaFile> playlistItems(int playlistId);
+
+    // Watch progress, kept on the server for every device
+    void fetchWatchProgress(const QString& filePath);
+    void saveWatchProgress(const QString& filePath, qint64 position, qint64 duration);
+
+    /**
+     * @brief Streaming URL of a server item
+     */
+    QUrl mediaUrl(int id) const;
+
+signals:
+    void connected();
+    void connectionFailed(const QString& error);
+    void libraryChanged();
+    void resultsReady();
+    void watchProgressReceived(const QString& filePath, qint64 position, qint64 duration, bool completed);
+
+private slots:
+    void poll();
+
+private:
+    /**
+     * @brief Cached body of a GET, fetched if missing
+     * @return Empty object until the response arrived
+     */
+    QJsonObject cachedGet(const QString& resource, const QUrlQuery& query);
+
+    QNetworkReply* get(const QString& resource, const QUrlQuery& query, const QByteArray& etag = QByteArray());
+    void fetchFacetPage(const QString& facet, int offset, QStringList values);
+    QList<MediaFile> items(const QJsonObject& page);
+    void dropCache();
+
+    QUrl m_serverUrl;
+    QByteArray m_token;
+    QTimer* m_pollTimer;
+    QByteArray m_etag;                      // Server revision, empty until connected
+    Totals m_totals;
+
+    QCache<QString, QJsonObject> m_cache;
+    QSet<QString> m_pending;                // Keys being fetched
+    QHash<QString, QStringList> m_facetValues;
+    QHash<QString, QString> m_serverPaths;  // Media URL to the path progress is kept under
+    quint64 m_generation;                   // Bumped when the cache drops, to discard late replies
+};
+
+} // namespace Data
+} // namespace EonPlay
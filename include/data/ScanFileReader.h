@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QString>
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Reads files for library scans without pushing playback out of the page cache
+ *
+ * Reads bypass the page cache where the filesystem allows it: O_DIRECT on
+ * Linux, FILE_FLAG_NO_BUFFERING with FILE_FLAG_SEQUENTIAL_SCAN on Windows
+ * and F_NOCACHE on macOS. Direct I/O needs aligned offsets and buffers, so
+ * reads are widened to ALIGNMENT internally and callers may read any
+ * range. Where direct I/O is refused, e.g. on tmpfs or some FUSE mounts,
+ * the reader falls back to buffered reads with POSIX_FADV_SEQUENTIAL and
+ * drops what it read with POSIX_FADV_DONTNEED.
+ *
+ * One reader per file and thread.
+ */
+class ScanFileReader
+{
+public:
+    static constexpr qint64 ALIGNMENT = 4096;
+    static constexpr qint64 BLOCK_BYTES = 1024 * 1024;
+
+    explicit ScanFileReader(const QString& filePath);
+    ~ScanFileReader();
+
+    ScanFileReader(const ScanFileReader&) = delete;
+    ScanFileReader& operator=(const ScanFileReader&) = delete;
+
+    bool isOpen() const;
+    bool isDirect() const { return m_direct; }
+    qint64 size() const { return m_size; }
+
+    /**
+     * @brief Read a range
+     * @return Up to length bytes, fewer at the end of the file, empty on error
+     */
+    QByteArray read(qint64 offset, qint64 length);
+
+    /**
+     * @brief Hash the whole file in BLOCK_BYTES reads
+     * @return false on a read error
+     */
+    bool addToHash(QCryptographicHash& hash);
+
+private:
+    qint64 readAligned(qint64 offset, char* buffer, qint64 length);
+    void dropCached(qint64 offset, qint64 length);
+
+#if defined(Q_OS_WIN)
+    void* m_handle;
+#else
+    int m_fd;
+#endif
+    bool m_direct = false;
+    bool m_error = false;
+    qint64 m_size = -1;
+    QByteArray m_buffer;                // BLOCK_BYTES + ALIGNMENT, used from an aligned offset
+};
+
+/**
+ * @brief Lowers the calling thread's I/O priority for its lifetime
+ *
+ * Scan and extraction work wraps itself in one so reads for playback are
+ * served first: the idle I/O class on Linux, background mode on Windows
+ * and throttled disk I/O on macOS.
+ */
+class BackgroundIoScope
+{
+public:
+    BackgroundIoScope();
+    ~BackgroundIoScope();
+
+    BackgroundIoScope(const BackgroundIoScope&) = delete;
+    BackgroundIoScope& operator=(const BackgroundIoScope&) = delete;
+
+private:
+    int m_previous = -1;
+    bool m_active = false;
+};
+
+} // namespace Data
+} // namespace EonPlay
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "media/ISeekIndexStore.h"
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+
+namespace EonPlay {
+namespace Data {
+
+class MetadataExtractor;
+
+/**
+ * @brief Builds seek indexes for files whose container has none and keeps them in the metadata cache
+ *
+ * Each file is read once, front to back, by SeekIndex::build() on a single
+ * low-priority thread, and the serialized index is stored through
+ * MetadataExtractor::saveSeekIndex(), checked against the file's size and
+ * modification time like the metadata. Library files are queued when the
+ * scanner adds or updates them, if their name suggests an MPEG stream; a
+ * file being played is queued whatever its name, ahead of the rest. Files
+ * found to need no index are stored as such and not read again.
+ */
+class SeekIndexer : public QObject, public ISeekIndexStore
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_THREADS = 1;   // Indexing is one sequential read per file
+
+    explicit SeekIndexer(MetadataExtractor* cache, QObject* parent = nullptr);
+    ~SeekIndexer() override;
+
+    /**
+     * @brief Queue a library file if its name suggests it may need an index
+     */
+    void indexFile(const QString& filePath);
+
+    /**
+     * @brief Drop queued files and stop the file being read at its next block
+     */
+    void cancel();
+
+    bool isIndexing() const { return !m_queue.isEmpty() || !m_inFlight.isEmpty(); }
+    int queuedFiles() const { return m_queue.size(); }
+
+    // ISeekIndexStore
+    std::shared_ptr<const SeekIndex> seekIndex(const QString& filePath) override;
+    void requestSeekIndex(const QString& filePath, QObject* context,
+                          std::function<void(std::shared_ptr<const SeekIndex>)> ready) override;
+
+signals:
+    /**
+     * @brief Emitted when a file was indexed and the index stored
+     * @param keyframes Keyframes in the index; 0 if the file needs none
+     */
+    void seekIndexBuilt(const QString& filePath, int keyframes);
+
+private:
+    struct Waiter {
+        QPointer<QObject> context;
+        std::function<void(std::shared_ptr<const SeekIndex>)> ready;
+    };
+
+    void enqueue(const QString& filePath, bool urgent);
+    void startNext();
+    void onIndexed(const QString& filePath, std::shared_ptr<const SeekIndex> index, bool built, bool cancelled);
+
+    MetadataExtractor* m_cache;
+    QThreadPool* m_pool;
+    QStringList m_queue;
+    QSet<QString> m_inFlight;
+    QHash<QString, QList<Waiter>> m_waiters;
+    std::atomic<bool> m_cancelled;
+};
+
+} // namespace Data
+} // namespace EonPlay
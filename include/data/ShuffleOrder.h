@@ -0,0 +1,91 @@
+#pragma once
+
+#include "data/MediaFile.h"
+#include <QList>
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Random play order over a list, kept up to date as the list changes
+ *
+ * Holds a permutation of logical indexes and its inverse, so both the
+ * shuffled position of an item and the item at a position are looked up
+ * in constant time. Items added later are placed at a random position
+ * among the upcoming ones, the way a Fisher-Yates shuffle would have
+ * placed them, and removed or moved items leave the rest of the order as
+ * it was; only shuffle() draws a new order.
+ *
+ * Weighted orders favour some items for the early positions. They are
+ * drawn without replacement from an alias table, which is rebuilt over
+ * the remaining items once half of its weight has been drawn.
+ */
+class ShuffleOrder
+{
+public:
+    enum Weighting {
+        Uniform,
+        ByRating,           // Higher rated first
+        ByPlayCount,        // Most played first
+        ByLastPlayed        // Longest unplayed first
+    };
+
+    /**
+     * @brief Draw a new order over every item
+     */
+    void shuffle(int count);
+    void shuffle(const QList<MediaFile>& items, Weighting weighting = Uniform);
+    void clear();
+
+    int size() const { return int(m_order.size()); }
+    bool isEmpty() const { return m_order.isEmpty(); }
+    const QList<int>& order() const { return m_order; }
+
+    /**
+     * @brief Get the logical index played at a shuffled position, or -1
+     */
+    int logicalAt(int position) const
+    {
+        return position >= 0 && position < m_order.size() ? m_order[position] : -1;
+    }
+
+    /**
+     * @brief Get the shuffled position of a logical index, or -1
+     */
+    int positionOf(int logicalIndex) const
+    {
+        return logicalIndex >= 0 && logicalIndex < m_positions.size() ? m_positions[logicalIndex] : -1;
+    }
+
+    /**
+     * @brief Account for an item inserted at a logical index
+     * @param firstPosition First shuffled position the item may take, e.g. the one after the current item
+     */
+    void insert(int logicalIndex, int firstPosition = 0);
+
+    /**
+     * @brief Account for the item at a logical index being removed
+     */
+    void remove(int logicalIndex);
+
+    /**
+     * @brief Account for several items removed at once; removed has one flag per logical index
+     */
+    void remove(const QList<bool>& removed);
+
+    /**
+     * @brief Account for an item moved between logical indexes
+     */
+    void move(int fromIndex, int toIndex);
+
+    static double weight(const MediaFile& file, Weighting weighting);
+
+private:
+    void rebuildPositions();
+
+    QList<int> m_order;         // Shuffled position -> logical index
+    QList<int> m_positions;     // Logical index -> shuffled position
+};
+
+} // namespace Data
+} // namespace EonPlay
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QAtomicPointer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <array>
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Process-wide pool of interned strings, addressed by 32-bit id
+ *
+ * Meant for values that repeat across a library, such as artist, album
+ * and genre names: each distinct value is stored once and records keep
+ * only its id. Id 0 is the empty string.
+ *
+ * Strings live in fixed-size segments that never move, so string() reads
+ * without locking and is safe from any thread. intern() takes a mutex.
+ * Entries are never removed.
+ */
+class StringPool
+{
+public:
+    using Id = quint32;
+
+    static StringPool& shared();
+
+    StringPool() = default;
+    ~StringPool();
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    /**
+     * @brief Get the id of a string, adding it on first use
+     */
+    Id intern(const QString& value);
+
+    /**
+     * @brief Get the string for an id returned by intern()
+     */
+    const QString& string(Id id) const
+    {
+        static const QString empty;
+        if (id == 0) {
+            return empty;
+        }
+        return m_segments[id >> SEGMENT_BITS].loadAcquire()[id & SEGMENT_MASK];
+    }
+
+    int count() const;
+
+private:
+    static constexpr int SEGMENT_BITS = 12;
+    static constexpr Id SEGMENT_MASK = (1u << SEGMENT_BITS) - 1;
+    static constexpr int SEGMENT_COUNT = 4096;     // 16M strings
+
+    std::array<QAtomicPointer<QString>, SEGMENT_COUNT> m_segments{};
+    mutable QMutex m_mutex;
+    QHash<QString, Id> m_ids;
+    Id m_nextId = 1;
+};
+
+} // namespace Data
+} // namespace EonPlay
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "data/DatabaseManager.h"
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+
+class SubtitleTrack;
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Keeps the subtitle search index in step with sidecar and generated subtitles
+ *
+ * Subtitle files are parsed on a low-priority worker pool and their cue
+ * text written to the subtitle_cues FTS5 index, linked to the media file
+ * and the cue times, so DatabaseManager::searchSubtitles() answers "which
+ * video says this, and when" without touching the files. A file is parsed
+ * again only when its modification time changes; results are written in
+ * batched transactions.
+ *
+ * Sidecars are picked up when the library adds or updates a video, and
+ * callers index generated output and files loaded for playback as they
+ * appear. A hit's filePath and startMs go straight to
+ * PlaybackController::loadMediaAt().
+ */
+class SubtitleIndexer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int WRITE_INTERVAL_MS = 1000;
+    static constexpr int MAX_THREADS = 2;
+
+    explicit SubtitleIndexer(DatabaseManager* dbManager, QObject* parent = nullptr);
+    ~SubtitleIndexer();
+
+    /**
+     * @brief Parse and index a subtitle file of a library media file
+     * @param generated True for AI-generated output rather than a sidecar
+     */
+    void indexFile(const QString& mediaFilePath, const QString& subtitlePath, bool generated = false);
+
+    /**
+     * @brief Index the sidecar subtitles next to a media file
+     */
+    void indexSidecars(const QString& mediaFilePath);
+
+    /**
+     * @brief Index a track parsed elsewhere, e.g. for playback
+     */
+    void indexTrack(const QString& mediaFilePath, const QString& subtitlePath, const SubtitleTrack& track,
+                    bool generated = false);
+
+    QVector<DatabaseManager::SubtitleSearchHit> search(const QString& searchTerm,
+                                                       int limit = DatabaseManager::DEFAULT_SEARCH_LIMIT);
+
+    bool isIndexing() const { return !m_inFlight.isEmpty() || !m_pending.isEmpty(); }
+
+signals:
+    void subtitleIndexed(const QString& mediaFilePath, const QString& subtitlePath, int cueCount);
+
+private slots:
+    void writePending();
+
+private:
+    struct IndexedSource {
+        QString mediaFilePath;
+        QString subtitlePath;
+        bool generated = false;
+        qint64 modifiedTime = -1;       // -1 if the file could not be parsed
+        QVector<DatabaseManager::SubtitleCueRow> cues;
+    };
+
+    bool isCurrent(const QString& subtitlePath, qint64 modifiedTime) const;
+    void onParsed(const IndexedSource& source);
+    void queueWrite(const IndexedSource& source);
+    static QStringList findSidecars(const QString& mediaFilePath);
+    static QVector<DatabaseManager::SubtitleCueRow> cueRows(const SubtitleTrack& track);
+    static IndexedSource parseFile(const QString& mediaFilePath, const QString& subtitlePath, bool generated);
+
+    DatabaseManager* m_dbManager;
+    QThreadPool* m_pool;
+    QTimer* m_writerTimer;
+    QSet<QString> m_inFlight;           // Subtitle paths being parsed
+    QVector<IndexedSource> m_pending;
+};
+
+} // namespace Data
+} // namespace EonPlay
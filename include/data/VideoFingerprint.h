@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+#include <atomic>
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief Perceptual hashes of frames sampled across a video
+ *
+ * SAMPLE_COUNT frames are taken at even fractions of the duration, so
+ * re-encodes, remuxes and rescales of the same video are sampled at the
+ * same moments whatever their keyframe layout. FFmpeg seeks to each
+ * position, decodes with hardware acceleration where available and scales
+ * the frame down to FRAME_SIZE x FRAME_SIZE grey on its side of the pipe.
+ * Each frame gets two 64-bit hashes:
+ *
+ * - pHash: the signs of the lowest 8x8 DCT coefficients against their
+ *   median. Survives re-encoding, scaling and colour changes.
+ * - dHash: the signs of horizontal gradients of a 9x8 thumbnail.
+ *
+ * Frames with almost no detail (black, fades, flat title cards) hash to
+ * noise and are marked invalid rather than compared.
+ */
+class VideoFingerprint
+{
+public:
+    static constexpr int SAMPLE_COUNT = 8;
+    static constexpr int FRAME_SIZE = 32;
+    static constexpr int MIN_COMMON_FRAMES = 4;     // Valid in both for a distance
+    static constexpr int FRAME_TIMEOUT_MS = 15000;
+    static constexpr qint64 DURATION_TOLERANCE_MS = 2000;
+    static constexpr int DURATION_TOLERANCE_PERCENT = 2;
+
+    struct Frame {
+        quint64 perceptualHash = 0;
+        quint64 differenceHash = 0;
+        bool valid = false;
+    };
+
+    VideoFingerprint() = default;
+
+    /**
+     * @brief Sample and hash a video with FFmpeg, on the calling thread
+     * @param durationMs Video duration; nothing is sampled without one
+     * @param cancelled Checked between frames
+     * @return Fingerprint without valid frames if the video could not be decoded
+     */
+    static VideoFingerprint compute(const QString& ffmpegPath, const QString& filePath, qint64 durationMs,
+                                    const std::atomic<bool>* cancelled = nullptr);
+
+    /**
+     * @brief Hash a FRAME_SIZE x FRAME_SIZE grey frame
+     * @return false if the frame has too little detail to hash
+     */
+    static bool hashFrame(const uchar* luma, Frame* frame);
+
+    static quint64 perceptualHash(const uchar* luma);
+    static quint64 differenceHash(const uchar* luma);
+
+    QByteArray serialize() const;
+
+    /**
+     * @return Empty fingerprint if the data is empty, damaged or from another version
+     */
+    static VideoFingerprint deserialize(const QByteArray& data);
+
+    /**
+     * @brief Compare two fingerprints
+     * @return Mean pHash bits differing per frame valid in both, -1 if the videos
+     *         differ in duration or share fewer than MIN_COMMON_FRAMES valid frames
+     */
+    int distance(const VideoFingerprint& other) const;
+
+    bool isEmpty() const { return validFrames() == 0; }
+    int validFrames() const;
+    qint64 duration() const { return m_duration; }
+    const QVector<Frame>& frames() const { return m_frames; }
+
+private:
+    qint64 m_duration = 0;
+    QVector<Frame> m_frames;
+};
+
+} // namespace Data
+} // namespace EonPlay
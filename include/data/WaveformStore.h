@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+namespace EonPlay {
+namespace Data {
+
+/**
+ * @brief File cache of waveform overviews for seek bars
+ *
+ * Each media file's serialized WaveformPeaks is kept in its own file,
+ * named after a hash of the media path and prefixed with the media file's
+ * size. An overview whose media file has changed size since is treated as
+ * missing, like the other analysis results.
+ *
+ * Methods only touch the file system and are safe to call from any thread.
+ */
+class WaveformStore
+{
+public:
+    explicit WaveformStore(const QString& directory = defaultDirectory());
+
+    /**
+     * @brief Get the default store directory
+     */
+    static QString defaultDirectory();
+
+    /**
+     * @brief Store the overview of a media file
+     * @param mediaPath Media file the overview was made from
+     * @param fileSize Size of the media file when it was decoded
+     * @param peaks Output of WaveformPeaks::serialize()
+     */
+    bool store(const QString& mediaPath, qint64 fileSize, const QByteArray& peaks) const;
+
+    /**
+     * @brief Read the overview of a media file
+     * @return Serialized peaks, or empty if there is no current overview
+     */
+    QByteArray load(const QString& mediaPath) const;
+
+    bool contains(const QString& mediaPath) const;
+
+    QString directory() const { return m_directory; }
+
+private:
+    QString entryPath(const QString& mediaPath) const;
+
+    QString m_directory;
+};
+
+} // namespace Data
+} // namespace EonPlay
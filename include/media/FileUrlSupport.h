@@ -9,10 +9,12 @@
 #include <QFileInfo>
 #include <QTimer>
 #include <QHash>
+#include <atomic>
 #include <memory>
 
 class IMediaEngine;
 class PlaybackController;
+class MediaProbe;
 
 /**
  * @brief Media information structure containing detailed playback info
@@ -144,11 +146,37 @@ public:
     
     /**
      * @brief Process dropped files and URLs
+     * 
+     * A drop of several files or of a folder goes through ingestMedia(); the
+     * local paths are then reported as processed, and ingestFinished() tells
+     * how many of them turned out to be playable.
      * @param mimeData Drag and drop mime data
      * @return List of successfully processed media paths/URLs
      */
     QStringList processDroppedMedia(const QMimeData* mimeData);
     
+    /**
+     * @brief Enumerate, validate and queue files and folders in the background
+     * 
+     * Folders are searched recursively. Valid files are reported in order,
+     * in mediaBatchReady() batches while the search goes on, and the first
+     * one is loaded into the player. Starting an ingest cancels the running one.
+     * @param paths Files and folders to ingest
+     * @param loadFirst Load the first valid file
+     */
+    void ingestMedia(const QStringList& paths, bool loadFirst = true);
+    
+    /**
+     * @brief Stop the running ingest; batches already reported stay queued
+     */
+    void cancelIngest();
+    
+    /**
+     * @brief Check if an ingest is running
+     * @return true between ingestMedia() and ingestFinished()
+     */
+    bool isIngesting() const { return m_ingestCancelled != nullptr; }
+    
     /**
      * @brief Get list of supported file extensions
      * @return List of supported extensions (without dots)
@@ -183,11 +211,27 @@ public:
     
     /**
      * @brief Extract detailed media information
+     * 
+     * Blocks while libVLC parses the file unless it was probed before;
+     * requestMediaInfo() does the same in the background.
      * @param filePath Path to media file
      * @return MediaInfo structure with detailed information
      */
     MediaInfo extractMediaInfo(const QString& filePath);
     
+    /**
+     * @brief Extract media information in the background
+     * 
+     * mediaInfoExtracted() follows, at once for a file probed before.
+     * @param filePath Path to media file
+     */
+    void requestMediaInfo(const QString& filePath);
+    
+    /**
+     * @brief Get the probe that parses files and caches their information
+     */
+    MediaProbe* mediaProbe() const { return m_probe; }
+    
     /**
      * @brief Get current media information
      * @return Current media info or empty info if no media loaded
@@ -388,6 +432,19 @@ signals:
      * @param failedFiles List of files that failed to process
      */
     void dragDropProcessed(const QStringList& processedFiles, const QStringList& failedFiles);
+    
+    /**
+     * @brief Emitted for each batch of valid files found by an ingest
+     * @param filePaths Files to append to the play queue, in order
+     */
+    void mediaBatchReady(const QStringList& filePaths);
+    
+    /**
+     * @brief Emitted when an ingest has finished or was cancelled
+     * @param acceptedCount Number of files reported in mediaBatchReady()
+     * @param failedFiles Files that failed validation
+     */
+    void ingestFinished(int acceptedCount, const QStringList& failedFiles);
 
 private slots:
     /**
@@ -419,25 +476,11 @@ private:
     QString generateScreenshotFilename(const QString& mediaPath = QString()) const;
     
     /**
-     * @brief Extract media info using libVLC
+     * @brief Take media information from the probe
      * @param filePath Path to media file
-     * @return Extracted media information
-     */
-    MediaInfo extractMediaInfoVLC(const QString& filePath);
-    
-    /**
-     * @brief Validate file header for security
-     * @param filePath Path to file to validate
-     * @return true if file header is valid
-     */
-    bool validateFileHeader(const QString& filePath) const;
-    
-    /**
-     * @brief Check file size limits
-     * @param filePath Path to file to check
-     * @return true if file size is within limits
+     * @param mediaInfo Extracted media information
      */
-    bool checkFileSizeLimit(const QString& filePath) const;
+    void onMediaProbed(const QString& filePath, const MediaInfo& mediaInfo);
     
     /**
      * @brief Search for subtitle files in directory
@@ -447,6 +490,15 @@ private:
      */
     QStringList searchSubtitlesInDirectory(const QString& mediaPath, const QString& directory) const;
     
+    /**
+     * @brief Take a batch of ingest results on the GUI thread
+     * @param generation Ingest the batch belongs to
+     * @param accepted Valid files in the batch
+     * @param failed Files that failed validation
+     * @param finished true for the last batch
+     */
+    void onIngestBatch(quint64 generation, const QStringList& accepted, const QStringList& failed, bool finished);
+    
     std::shared_ptr<IMediaEngine> m_mediaEngine;
     std::shared_ptr<PlaybackController> m_playbackController;
     
@@ -474,11 +526,20 @@ private:
     QTimer* m_mediaInfoTimer;
     QTimer* m_subtitleTimer;
     
-    // Cache for media info
-    QHash<QString, MediaInfo> m_mediaInfoCache;
+    // Media info parsing, cached across sessions
+    MediaProbe* m_probe;
+    
+    // Bulk ingest state
+    quint64 m_ingestGeneration;
+    std::shared_ptr<std::atomic<bool>> m_ingestCancelled;
+    bool m_ingestLoadFirst;
+    int m_ingestAcceptedCount;
+    QStringList m_ingestFailed;
     
     // Constants
     static constexpr qint64 DEFAULT_MAX_FILE_SIZE = 50LL * 1024 * 1024 * 1024; // 50GB
     static constexpr int MEDIA_INFO_TIMEOUT_MS = 5000; // 5 seconds
     static constexpr int SUBTITLE_SEARCH_TIMEOUT_MS = 2000; // 2 seconds
+    static constexpr int INGEST_BATCH_SIZE = 500;
+    static constexpr int INGEST_BATCH_INTERVAL_MS = 250;
 };
\ No newline at end of file
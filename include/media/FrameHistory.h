@@ -0,0 +1,101 @@
+#pragma once
+
+#include <QMutex>
+#include <QSize>
+#include <deque>
+#include <memory>
+#include "media/VideoFrame.h"
+
+/**
+ * @brief Recently displayed frames, for instant frame-by-frame review
+ *
+ * Registered as a frame sink, the history copies every new picture into a
+ * buffer of its own pool, so the decoder's pool is never held up, and
+ * keeps as many as the memory budget allows (at least MIN_FRAMES), oldest
+ * dropped first. A cursor walks the ring: stepping back yields older
+ * frames from memory and stepping forward returns toward the newest one;
+ * at the newest frame the engine has to decode the next picture. Frames presented again from the
+ * history are recognised by their sequence and not recorded twice, and a
+ * jump in position, e.g. after a seek, starts a new history.
+ *
+ * videoFrameReady() runs on the decoder thread; everything else may be
+ * called from any thread.
+ */
+class FrameHistory : public IVideoFrameSink
+{
+public:
+    static constexpr qint64 DEFAULT_MEMORY_BUDGET = 128 * 1024 * 1024;
+    static constexpr int MIN_FRAMES = 2;
+    static constexpr int MAX_FRAMES = 120;
+    static constexpr qint64 DISCONTINUITY_MS = 1000;    // Larger position jumps clear the history
+
+    explicit FrameHistory(qint64 memoryBudget = DEFAULT_MEMORY_BUDGET);
+    ~FrameHistory() override;
+
+    FrameHistory(const FrameHistory&) = delete;
+    FrameHistory& operator=(const FrameHistory&) = delete;
+
+    /**
+     * @brief Set the bytes of frame copies kept; applies from the next format change or clear()
+     */
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const;
+
+    void videoFrameReady(const VideoFrameRef& frame) override;
+
+    /**
+     * @brief Move the cursor one frame back
+     * @return The older frame, or null if the cursor is at the oldest one
+     */
+    VideoFrameRef stepBackward();
+
+    /**
+     * @brief Move the cursor one frame toward the newest
+     * @return The newer frame, or null if the cursor is at the newest one
+     */
+    VideoFrameRef stepForward();
+
+    /**
+     * @brief Check whether the cursor is at the newest frame, i.e. shows what the decoder last did
+     */
+    bool isAtNewest() const;
+
+    /**
+     * @brief Get the frame at the cursor
+     */
+    VideoFrameRef current() const;
+
+    int size() const;
+
+    /**
+     * @brief Get the bytes held by the frame copies
+     */
+    qint64 memoryUsage() const;
+
+    /**
+     * @brief Drop the oldest frames to give memory back, keeping at least MIN_FRAMES
+     *
+     * The history keeps the lower frame count until the next format change
+     * or clear(), when it is sized from the budget again.
+     *
+     * @return Bytes released
+     */
+    qint64 trim(qint64 bytes);
+
+    /**
+     * @brief Drop all frames, e.g. on a seek or a media change
+     */
+    void clear();
+
+private:
+    void reset(const QSize& format);
+
+    mutable QMutex m_mutex;
+    qint64 m_memoryBudget;
+    std::unique_ptr<VideoFramePool> m_pool;
+    QSize m_format;
+    int m_capacity;
+    std::deque<VideoFrameRef> m_frames;         // Oldest first
+    int m_cursor;                               // Index into m_frames
+    quint64 m_lastSequence;
+};
@@ -4,6 +4,8 @@
 #include <QString>
 #include <QStringList>
 
+class QThreadPool;
+
 /**
  * @brief Hardware acceleration types supported by the system
  */
@@ -36,6 +38,10 @@ struct HardwareAccelerationInfo
  * 
  * Detects available hardware acceleration methods on the current platform,
  * provides configuration options, and manages fallback to software decoding.
+ *
+ * Probe results are persisted with a fingerprint of the GPU, driver and
+ * libVLC build. While the fingerprint matches, initialize() uses the
+ * cached results and re-probes in the background some time later.
  */
 class HardwareAcceleration : public QObject
 {
@@ -43,7 +49,7 @@ class HardwareAcceleration : public QObject
 
 public:
     explicit HardwareAcceleration(QObject* parent = nullptr);
-    ~HardwareAcceleration() = default;
+    ~HardwareAcceleration();
     
     /**
      * @brief Initialize hardware acceleration detection
@@ -53,10 +59,27 @@ public:
     
     /**
      * @brief Detect available hardware acceleration methods
+     *
+     * Runs the full probe and reads no member state, so it may run on a
+     * worker thread.
      * @return List of available acceleration methods
      */
     QList<HardwareAccelerationInfo> detectAvailableAcceleration();
     
+    /**
+     * @brief Identify the GPU, driver and libVLC build probe results belong to
+     *
+     * Reads device identifiers only; no device is created and nothing is
+     * spawned.
+     * @return Hex digest, stable while the hardware and drivers are unchanged
+     */
+    QString probeFingerprint() const;
+    
+    /**
+     * @brief Check if the current results came from the persisted probe
+     */
+    bool isProbeCached() const;
+    
     /**
      * @brief Get the best available hardware acceleration method
      * @return Best acceleration method, or None if none available
@@ -96,6 +119,11 @@ public:
      */
     HardwareAccelerationType getPreferredAcceleration() const;
     
+    /**
+     * @brief Acceleration type getVLCArguments() selects
+     */
+    HardwareAccelerationType activeAcceleration() const;
+    
     /**
      * @brief Enable or disable hardware acceleration
      * @param enabled Whether to enable hardware acceleration
@@ -108,12 +136,31 @@ public:
      */
     bool isHardwareAccelerationEnabled() const;
     
+    /**
+     * @brief Decode new media in hardware even if acceleration is disabled
+     * 
+     * Set by the PowerPolicy while saving power. Applies per media through
+     * getVLCMediaOptions(), so playing media and the libVLC instance are
+     * left alone.
+     */
+    void setHardwareDecodeForced(bool forced);
+    bool isHardwareDecodeForced() const { return m_hardwareDecodeForced; }
+    
     /**
      * @brief Get libVLC arguments for the current acceleration configuration
      * @return List of libVLC arguments to enable hardware acceleration
      */
     QStringList getVLCArguments() const;
     
+    /**
+     * @brief Get per-media libVLC options selecting the decoder
+     * 
+     * The option form of getVLCArguments(), or the hardware decoder while
+     * it is forced. Set per media, so a change needs no new libVLC instance.
+     * @return Options to add to each new media
+     */
+    QStringList getVLCMediaOptions() const;
+    
     /**
      * @brief Test if hardware acceleration is working with a sample video
      * @param testVideoPath Path to test video file (optional)
@@ -212,8 +259,41 @@ private:
      */
     bool isVLCAccelerationSupported(HardwareAccelerationType type) const;
     
+    /**
+     * @brief Load persisted probe results
+     * @param fingerprint Current probe fingerprint
+     * @return true if results for this fingerprint were loaded
+     */
+    bool loadCachedProbe(const QString& fingerprint);
+    
+    /**
+     * @brief Persist the current probe results under m_probeFingerprint
+     */
+    void saveProbe() const;
+    
+    /**
+     * @brief Re-probe on the worker pool after REVALIDATE_DELAY_MS
+     */
+    void scheduleRevalidation();
+    void revalidate();
+    
+    /**
+     * @brief Adopt the results of a background probe
+     * @param results Fresh probe results
+     */
+    void applyProbeResults(const QList<HardwareAccelerationInfo>& results);
+    
     QList<HardwareAccelerationInfo> m_availableAccelerations;
     HardwareAccelerationType m_preferredAcceleration;
     bool m_hardwareAccelerationEnabled;
+    bool m_hardwareDecodeForced;
     bool m_initialized;
+    
+    // Persisted probe
+    QThreadPool* m_probePool;
+    QString m_probeFingerprint;
+    bool m_probeCached;
+    bool m_revalidating;
+    
+    static constexpr int REVALIDATE_DELAY_MS = 15000;
 };
\ No newline at end of file
@@ -3,6 +3,12 @@
 #include <QObject>
 #include <QString>
 #include <QUrl>
+#include <functional>
+#include <memory>
+#include "VideoFrame.h"
+#include "IPrefetchCache.h"
+
+class SeekIndex;
 
 /**
  * @brief Enumeration of media playback states
@@ -58,6 +64,49 @@ public:
      */
     virtual void seek(qint64 position) = 0;
     
+    /**
+     * @brief Seek to a keyframe near a position
+     * 
+     * Cheaper than seek() while scrubbing: decoding restarts at the
+     * keyframe instead of decoding up to the exact position. Engines
+     * without keyframe seeks seek exactly.
+     * 
+     * @param position Position in milliseconds
+     */
+    virtual void seekFast(qint64 position) { seek(position); }
+    
+    /**
+     * @brief Give the engine the keyframe index of a file without one of its own
+     * 
+     * Seeks in the file then go to the byte offset of the keyframe at or
+     * before the target and land there, instead of on the demuxer's
+     * estimate. Set it right before loadMedia() or preloadMedia() for the
+     * path, or later while the file is open; engines may only be able to
+     * use it from the next open. A null index drops one set before.
+     * 
+     * @param path File path as it is passed to loadMedia()
+     * @param index Index built by SeekIndex::build()
+     */
+    virtual void setSeekIndex(const QString& path, std::shared_ptr<const SeekIndex> index)
+    {
+        Q_UNUSED(path); Q_UNUSED(index);
+    }
+    
+    /**
+     * @brief Give the engine a local copy to read a file from
+     * 
+     * The next loadMedia() or preloadMedia() of the path reads the copy
+     * instead of the source; past the end of a prefix copy it reads on in
+     * the source. Set it right before the open. An invalid copy drops one
+     * set before.
+     * 
+     * @param path File path or URL as it is passed to loadMedia()
+     */
+    virtual void setPrefetchedCopy(const QString& path, const PrefetchedCopy& copy)
+    {
+        Q_UNUSED(path); Q_UNUSED(copy);
+    }
+    
     /**
      * @brief Set playback volume
      * @param volume Volume level (0-100)
@@ -118,6 +167,102 @@ public:
      * @return Base64 encoded frame image or empty string
      */
     virtual QString getVideoFrame(qint64 position) { Q_UNUSED(position); return QString(); }
+    
+    /**
+     * @brief Register a receiver for decoded video frames
+     * 
+     * Frames are delivered on the decoder thread as shared references to
+     * pooled buffers, so any number of sinks can consume the same picture
+     * without copying it.
+     * 
+     * @param sink Frame sink (not owned)
+     */
+    virtual void addVideoFrameSink(IVideoFrameSink* sink) { Q_UNUSED(sink); }
+    
+    /**
+     * @brief Unregister a frame sink
+     * 
+     * After this returns the sink receives no further frames and no
+     * delivery to it is still in progress.
+     * 
+     * @param sink Frame sink
+     */
+    virtual void removeVideoFrameSink(IVideoFrameSink* sink) { Q_UNUSED(sink); }
+    
+    /**
+     * @brief Get the most recently displayed video frame
+     * @return Shared frame reference, or null if no frame was decoded
+     */
+    virtual VideoFrameRef latestVideoFrame() const { return VideoFrameRef(); }
+    
+    /**
+     * @brief Show a frame that was decoded before, e.g. from a FrameHistory
+     * 
+     * The frame becomes the latest one and is delivered to every sink, as
+     * if it had just been decoded; the decoder itself does not move.
+     * 
+     * @param frame Frame to show
+     */
+    virtual void presentVideoFrame(const VideoFrameRef& frame) { Q_UNUSED(frame); }
+    
+    /**
+     * @brief Decode and show the next frame while paused
+     * @return false if the engine cannot step, e.g. no media; seek instead then
+     */
+    virtual bool stepFrame() { return false; }
+    
+    /**
+     * @brief Open the media that plays next in the background
+     * 
+     * The media is opened, demuxed and buffered up to its first frame while
+     * the current one keeps playing. When the current media ends the engine
+     * continues with it without re-opening and emits preloadedMediaStarted().
+     * 
+     * @param path File path or URL of the next media
+     * @return false if the engine cannot preload; load the media normally then
+     */
+    virtual bool preloadMedia(const QString& path) { Q_UNUSED(path); return false; }
+    
+    /**
+     * @brief Drop the preloaded media, if any
+     */
+    virtual void clearPreloadedMedia() {}
+    
+    /**
+     * @brief Get the path of the preloaded media
+     * @return Path passed to preloadMedia(), empty if nothing is preloaded
+     */
+    virtual QString preloadedMedia() const { return QString(); }
+    
+    /**
+     * @brief Start the preloaded media now
+     * @param overlapMs Time the current media keeps playing while it fades
+     *                  out and the next one fades in; 0 cuts over directly
+     * @return true if there was preloaded media to switch to
+     */
+    virtual bool switchToPreloadedMedia(int overlapMs = 0) { Q_UNUSED(overlapMs); return false; }
+    
+    /**
+     * @brief Receive the playback position periodically while playing
+     * 
+     * Each subscriber asks for the interval it needs, and nothing wakes up
+     * while paused or once every subscriber is gone. Subscribe again to
+     * change the interval, e.g. slower while a window is hidden.
+     * 
+     * @param context Receiver; the subscription ends when it is destroyed
+     * @param intervalMs Wanted update interval in milliseconds
+     * @param callback Called on the engine's thread with the position in milliseconds
+     */
+    virtual void subscribePosition(QObject* context, int intervalMs, std::function<void(qint64)> callback)
+    {
+        Q_UNUSED(context); Q_UNUSED(intervalMs); Q_UNUSED(callback);
+    }
+    
+    /**
+     * @brief End a position subscription
+     * @param context Receiver passed to subscribePosition()
+     */
+    virtual void unsubscribePosition(QObject* context) { Q_UNUSED(context); }
 
 signals:
     /**
@@ -127,11 +272,24 @@ signals:
     void stateChanged(PlaybackState state);
     
     /**
-     * @brief Emitted when playback position changes
+     * @brief Emitted when the position jumps: seeks, media changes, start and stop
+     * 
+     * Use subscribePosition() for continuous updates.
+     * 
      * @param position Current position in milliseconds
      */
     void playbackPositionChanged(qint64 position);
     
+    /**
+     * @brief Emitted when a seek has landed and decoding runs from there
+     * 
+     * Engines that cannot tell need not emit it; callers fall back to a
+     * timeout.
+     * 
+     * @param position Position landed on in milliseconds
+     */
+    void seekCompleted(qint64 position);
+    
     /**
      * @brief Emitted when media duration is available
      * @param duration Duration in milliseconds
@@ -155,4 +313,10 @@ signals:
      * @param error Error description
      */
     void errorOccurred(const QString& error);
+    
+    /**
+     * @brief Emitted when playback moved on to the preloaded media
+     * @param path Path of the media now playing
+     */
+    void preloadedMediaStarted(const QString& path);
 };
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * @brief Local copy of the start, or all, of a file on slow storage
+ *
+ * A copy holding fewer bytes than the source is a prefix: the engine reads
+ * the copy up to its end and the source from there on.
+ */
+struct PrefetchedCopy
+{
+    QString localPath;
+    qint64 bytes = 0;           // Bytes in the copy
+    qint64 sourceSize = 0;      // Bytes in the source
+
+    bool isValid() const { return !localPath.isEmpty() && bytes > 0; }
+    bool isComplete() const { return isValid() && bytes >= sourceSize; }
+};
+
+/**
+ * @brief Cache of local copies of media that is about to play
+ *
+ * PlaybackController asks for the copy of a file right before it opens or
+ * preloads it and hands it to the engine, so the first seconds of a track
+ * on a NAS, or all of a podcast episode, are read from local disk instead
+ * of starting with a cold network read.
+ */
+class IPrefetchCache
+{
+public:
+    virtual ~IPrefetchCache() = default;
+
+    /**
+     * @brief Get the finished copy of a file and mark it as recently used
+     * @param path File path or URL as it is passed to the engine
+     * @return Invalid if nothing is cached or the source changed since it was copied
+     */
+    virtual PrefetchedCopy prefetchedCopy(const QString& path) = 0;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * @brief Persistent store of resume positions
+ *
+ * PlaybackController saves where playback left off and asks for it again
+ * when the media is opened. Implementations are expected to buffer writes,
+ * since positions are saved on every pause, stop and media change.
+ */
+class IResumeStore
+{
+public:
+    virtual ~IResumeStore() = default;
+
+    /**
+     * @brief Get where to resume a file
+     * @param filePath File path or URL
+     * @return Position in milliseconds, 0 if it starts from the beginning
+     */
+    virtual qint64 resumePosition(const QString& filePath) = 0;
+
+    /**
+     * @brief Remember where playback of a file left off
+     * @param filePath File path or URL
+     * @param position Position in milliseconds
+     * @param duration Media duration in milliseconds
+     */
+    virtual void saveResumePosition(const QString& filePath, qint64 position, qint64 duration) = 0;
+
+    /**
+     * @brief Start a file from the beginning next time, e.g. once it played to the end
+     * @param filePath File path or URL
+     */
+    virtual void clearResumePosition(const QString& filePath) = 0;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QString>
+#include <functional>
+#include <memory>
+
+class QObject;
+class SeekIndex;
+
+/**
+ * @brief Persistent store of keyframe indexes for files without one of their own
+ *
+ * PlaybackController asks for the stored index of a local file right before
+ * it opens it and hands it to the engine, so seeks in MPEG transport and
+ * program streams go straight to a keyframe. A file opened for the first
+ * time is indexed in the background and its index given to the engine once
+ * it is built.
+ */
+class ISeekIndexStore
+{
+public:
+    virtual ~ISeekIndexStore() = default;
+
+    /**
+     * @brief Get the stored index of a file
+     * @param filePath Local file path
+     * @return null if the file needs no index or none was built since it last changed
+     */
+    virtual std::shared_ptr<const SeekIndex> seekIndex(const QString& filePath) = 0;
+
+    /**
+     * @brief Index a file in the background, ahead of any other queued file
+     * @param filePath Local file path
+     * @param context Receiver; ready is not called once it is destroyed
+     * @param ready Called on the context's thread with the new index; not called if the file needs none
+     */
+    virtual void requestSeekIndex(const QString& filePath, QObject* context,
+                                  std::function<void(std::shared_ptr<const SeekIndex>)> ready) = 0;
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QMetaType>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief One timed step of opening a media
+ */
+struct MediaOpenPhase
+{
+    QByteArray name;            // e.g. "engine.validate"
+    qint64 startUs = 0;         // Relative to the start of the open
+    qint64 durationUs = 0;
+};
+
+/**
+ * @brief Latency breakdown of one media open, up to its first frame
+ */
+struct MediaOpenProfile
+{
+    QString path;
+    qint64 startUs = 0;         // TraceLog::now() when the open began
+    QVector<MediaOpenPhase> phases;
+    qint64 firstFrameUs = -1;   // Relative to startUs, -1 until rendered
+    bool video = false;         // First output was a picture, not audio
+
+    bool isComplete() const { return firstFrameUs >= 0; }
+
+    /**
+     * @brief Time from the start of the open to the first frame
+     * @return Milliseconds, -1 if not complete
+     */
+    double timeToFirstFrameMs() const { return isComplete() ? firstFrameUs / 1000.0 : -1.0; }
+
+    /**
+     * @brief One line per phase plus the total, for logs and the info panel
+     */
+    QString summary() const;
+};
+
+Q_DECLARE_METATYPE(MediaOpenProfile)
+
+/**
+ * @brief Collects per-open latency breakdowns across components
+ *
+ * Opens are keyed by path, so the controller, file validation and the
+ * engine each add their phases without passing a context around. Phases
+ * for a path with no open in progress are dropped, which keeps library
+ * scans and other validations out of the numbers. The engine finishes an
+ * open when its first frame (or first audio for audio-only media) is
+ * rendered and profileCompleted() is emitted. Times come from TraceLog's
+ * clock, and phases also go to the trace when tracing is on.
+ *
+ * All methods are thread-safe; signals are emitted on the main thread.
+ */
+class MediaOpenProfiler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static MediaOpenProfiler& instance();
+
+    /**
+     * @brief Start timing an open, replacing one in progress for the path
+     */
+    void begin(const QString& path);
+
+    /**
+     * @brief Check if an open is in progress for a path
+     */
+    bool isPending(const QString& path) const;
+
+    /**
+     * @brief Record a finished phase
+     * @param path Media being opened
+     * @param name Phase name, a string literal
+     * @param startUs Start from TraceLog::now()
+     * @param durationUs Duration in microseconds
+     */
+    void addPhase(const QString& path, const char* name, qint64 startUs, qint64 durationUs);
+
+    /**
+     * @brief Complete an open at its first rendered output
+     * @param path Media being opened
+     * @param video true for a picture, false for the first audio
+     * @param atUs Time from TraceLog::now()
+     */
+    void finish(const QString& path, bool video, qint64 atUs);
+
+    /**
+     * @brief Drop an open that will not render, e.g. after a failure
+     */
+    void abandon(const QString& path);
+
+    /**
+     * @brief Get the most recently completed profile
+     */
+    MediaOpenProfile lastProfile() const;
+
+signals:
+    /**
+     * @brief Emitted when an open rendered its first frame
+     * @param profile Complete latency breakdown
+     */
+    void profileCompleted(const MediaOpenProfile& profile);
+
+private:
+    MediaOpenProfiler();
+
+    mutable QMutex m_mutex;
+    QHash<QString, MediaOpenProfile> m_pending;
+    MediaOpenProfile m_lastProfile;
+
+    static constexpr int MAX_PENDING = 8;
+};
+
+/**
+ * @brief Records a phase from construction to destruction or end()
+ *
+ * Costs one hash lookup when no open is in progress for the path.
+ */
+class MediaOpenPhaseScope
+{
+public:
+    MediaOpenPhaseScope(const QString& path, const char* name);
+    ~MediaOpenPhaseScope();
+
+    MediaOpenPhaseScope(const MediaOpenPhaseScope&) = delete;
+    MediaOpenPhaseScope& operator=(const MediaOpenPhaseScope&) = delete;
+
+    /**
+     * @brief Close the phase early
+     */
+    void end();
+
+private:
+    QString m_path;
+    const char* m_name;
+    qint64 m_start = -1;        // -1 when not timed
+};
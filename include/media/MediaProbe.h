@@ -0,0 +1,106 @@
+#pragma once
+
+#include "media/FileUrlSupport.h"
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+
+class QTimer;
+
+/**
+ * @brief Reads codecs, tracks and duration of media files with libVLC
+ *
+ * Files are parsed with libvlc_media_parse_with_options(), local only and
+ * bounded by PARSE_TIMEOUT_MS, on a small pool with its own libVLC instance
+ * that does no playback. Results are cached by path and checked against the
+ * file's size and modification time; the cache is kept in a file in the
+ * application's cache directory, so a file probed once, in this session or
+ * an earlier one, is described from memory without opening it again. At
+ * most CACHE_CAPACITY files are kept, the least recently used are dropped.
+ *
+ * All methods are thread-safe; probed() is emitted on the thread that did
+ * the probe, usually one of the probe's own.
+ */
+class MediaProbe : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int PARSE_TIMEOUT_MS = 5000;
+    static constexpr int CACHE_CAPACITY = 20000;
+    static constexpr int SAVE_DELAY_MS = 2000;
+
+    /**
+     * @param cacheFilePath File the cache is kept in; empty for the default
+     */
+    explicit MediaProbe(const QString& cacheFilePath = QString(), QObject* parent = nullptr);
+    ~MediaProbe() override;
+
+    /**
+     * @brief Get the cached description of a file, if it is still current
+     * @return false if the file was not probed since it last changed
+     */
+    bool lookup(const QString& filePath, MediaInfo* info);
+
+    /**
+     * @brief Describe a file in the background
+     *
+     * probed() follows, at once if the cached description is current.
+     */
+    void probe(const QString& filePath);
+
+    /**
+     * @brief Describe a file, blocking for up to PARSE_TIMEOUT_MS if it is not cached
+     */
+    MediaInfo probeSync(const QString& filePath);
+
+    void clearCache();
+    QString cacheFilePath() const { return m_cacheFilePath; }
+
+signals:
+    /**
+     * @brief Emitted when a file has been described
+     * @param info Description; only path, size and format if libVLC could not
+     *             parse the file, isValid is false if it does not exist
+     */
+    void probed(const QString& filePath, const MediaInfo& info);
+
+private:
+    struct Entry {
+        MediaInfo info;
+        qint64 modified = 0;
+        quint64 lastUse = 0;
+    };
+
+    /**
+     * @brief Parse a file; info is filled from the file system even if parsing fails
+     * @return true if libVLC parsed the file
+     */
+    bool parse(const QString& filePath, MediaInfo* info);
+    void store(const QString& filePath, const MediaInfo& info, qint64 modified);
+    void ensureLoaded();
+    void scheduleSave();
+    void save();
+    static QHash<QString, Entry> readCacheFile(const QString& filePath);
+    static void writeCacheFile(const QString& filePath, const QHash<QString, Entry>& entries);
+
+    QString m_cacheFilePath;
+    QThreadPool m_pool;
+    QTimer* m_saveTimer;
+
+    QMutex m_mutex;                     // Guards the entries and the state below
+    QHash<QString, Entry> m_entries;
+    QSet<QString> m_pending;            // Being probed in the background
+    quint64 m_useCounter;
+    bool m_dirty;
+
+    QMutex m_loadMutex;
+    std::atomic<bool> m_loaded;
+    QFuture<void> m_save;
+    std::atomic<bool> m_shuttingDown;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+/**
+ * @brief Interpolating media clock with per-subscriber update rates
+ *
+ * The decoder reports its time through update() whenever it has one, and
+ * position() extrapolates between reports from the monotonic wall clock at
+ * the playback rate, so reading it never calls into the engine. Subscribers
+ * name the interval they need; the clock's single timer runs at the
+ * shortest of them and only while the clock is running. Paused, stopped or
+ * without subscribers it does not wake up at all.
+ *
+ * update(), setRunning(), setRate(), reset() and position() may be called
+ * from any thread. Subscriptions and callbacks belong to the clock's thread.
+ */
+class PlaybackClock : public QObject
+{
+    Q_OBJECT
+
+public:
+    using PositionCallback = std::function<void(qint64)>;
+
+    explicit PlaybackClock(QObject* parent = nullptr);
+    ~PlaybackClock() override;
+
+    /**
+     * @brief Re-anchor on a time reported by the decoder
+     * @param mediaTime Media time in milliseconds
+     */
+    void update(qint64 mediaTime);
+
+    /**
+     * @brief Jump to a position, e.g. after a seek or a media change
+     *
+     * Every subscriber is told about the new position right away.
+     *
+     * @param mediaTime Media time in milliseconds
+     */
+    void reset(qint64 mediaTime = 0);
+
+    /**
+     * @brief Start or stop advancing with the wall clock
+     */
+    void setRunning(bool running);
+
+    /**
+     * @brief Set the playback rate used for extrapolation
+     * @param rate 1.0 for normal speed
+     */
+    void setRate(double rate);
+
+    /**
+     * @brief Get the interpolated media time
+     * @return Position in milliseconds
+     */
+    qint64 position() const;
+
+    bool isRunning() const;
+
+    /**
+     * @brief Receive the position periodically while the clock runs
+     *
+     * A context subscribes once; subscribing again changes its interval.
+     * The subscription ends when the context is destroyed.
+     *
+     * @param context Receiver, also the key for unsubscribe()
+     * @param intervalMs Wanted update interval in milliseconds
+     * @param callback Called on the clock's thread with the position
+     */
+    void subscribe(QObject* context, int intervalMs, PositionCallback callback);
+
+    /**
+     * @brief End the subscription of a context
+     */
+    void unsubscribe(QObject* context);
+
+    int subscriberCount() const { return m_subscribers.size(); }
+
+signals:
+    /**
+     * @brief Emitted on the clock's thread after reset() and when it starts or stops
+     * @param position Position in milliseconds
+     */
+    void discontinuity(qint64 position);
+
+private:
+    struct Subscriber
+    {
+        QObject* context = nullptr;
+        int intervalMs = 0;
+        PositionCallback callback;
+        QMetaObject::Connection destroyedConnection;
+        qint64 nextDue = 0;
+    };
+
+    /**
+     * @brief Run the callbacks that are due
+     */
+    void tick();
+
+    /**
+     * @brief Deliver the current position to every subscriber
+     */
+    void notifyAll();
+
+    /**
+     * @brief Start, stop or re-time the timer for the subscriptions
+     */
+    void updateTimer();
+
+    /**
+     * @brief Queue notifyAll() and updateTimer() on the clock's thread
+     */
+    void scheduleDiscontinuity();
+
+    qint64 positionLocked() const;
+
+    mutable QMutex m_mutex;
+    QElapsedTimer m_wallClock;          // Monotonic reference for all anchors
+    qint64 m_anchorMediaTime = 0;
+    qint64 m_anchorWallTime = 0;
+    double m_rate = 1.0;
+    bool m_running = false;
+
+    QTimer* m_timer;
+    QVector<Subscriber> m_subscribers;
+
+    static constexpr int MIN_INTERVAL_MS = 16;
+};
@@ -2,11 +2,20 @@
 
 #include "IMediaEngine.h"
 #include "IComponent.h"
+#include "media/IResumeStore.h"
+#include "media/IPrefetchCache.h"
+#include "media/ISeekIndexStore.h"
+#include "media/MediaOpenProfiler.h"
+#include "media/FrameHistory.h"
 #include <QObject>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QHash>
+#include <QImage>
 #include <memory>
 
+class SeekThumbnailService;
+
 /**
  * @brief Playback speed enumeration for common speeds
  */
@@ -102,10 +111,24 @@ public:
     
     /**
      * @brief Seek to specific position
+     * 
+     * Seeks are scheduled latest-wins: while one is in flight only the most
+     * recent target is kept and issued once the engine lands.
+     * 
      * @param position Position in milliseconds
      */
     void seek(qint64 position);
     
+    /**
+     * @brief Seek while the user drags the position
+     * 
+     * Keyframe seeks through the same latest-wins schedule; call seek() on
+     * release for the exact position.
+     * 
+     * @param position Position in milliseconds
+     */
+    void scrub(qint64 position);
+    
     /**
      * @brief Seek forward by specified amount
      * @param milliseconds Amount to seek forward (default: 10 seconds)
@@ -228,6 +251,13 @@ public:
     
     /**
      * @brief Start fast forward with specified speed
+     *
+     * Trick play: the engine stays paused while a position runs at the
+     * speed, and the keyframe previews of SeekThumbnailService along the
+     * way are shown through the engine's video sinks, decoded ahead in the
+     * direction of travel. Normal decoding resumes from the landing
+     * position only in stopFastSeek().
+     *
      * @param speed Fast forward speed multiplier
      */
     void startFastForward(SeekSpeed speed = SeekSpeed::Normal);
@@ -240,6 +270,8 @@ public:
     
     /**
      * @brief Stop fast forward/rewind and return to normal playback
+     *
+     * Seeks once to where trick play got to and resumes playback there.
      */
     void stopFastSeek();
     
@@ -251,14 +283,27 @@ public:
     
     /**
      * @brief Step forward one frame (video only)
+     *
+     * Returns through the frame history first, then has the engine decode
+     * the next frame; a time seek is the last resort.
      */
     void stepForward();
     
     /**
      * @brief Step backward one frame (video only)
+     *
+     * Shows the previous frame from the frame history without decoding;
+     * only past the oldest kept frame does it seek.
      */
     void stepBackward();
     
+    /**
+     * @brief Set the memory kept for backward frame steps
+     * @param bytes Budget for frame copies
+     */
+    void setFrameHistoryBudget(qint64 bytes);
+    qint64 frameHistoryBudget() const { return m_frameHistory->memoryBudget(); }
+    
     /**
      * @brief Set playback mode (normal, repeat, shuffle)
      * @param mode Playback mode to set
@@ -302,6 +347,93 @@ public:
      */
     bool isGaplessPlayback() const { return m_gaplessPlayback; }
     
+    /**
+     * @brief Set the media that follows the current one
+     * 
+     * With gapless playback or crossfade enabled, the engine opens and
+     * buffers it shortly before the current media ends and moves on to it
+     * without re-opening. nextMediaStarted() reports the transition.
+     * 
+     * @param path File path or URL of the next media, empty if none
+     */
+    void setNextMedia(const QString& path);
+    
+    /**
+     * @brief Get the media that follows the current one
+     * @return Path set with setNextMedia(), empty once it started playing
+     */
+    QString nextMedia() const { return m_nextMediaPath; }
+    
+    /**
+     * @brief Set the beat grid of the current media for beat-matched crossfades
+     * 
+     * With a grid, a crossfade lasts a whole number of beats and starts so
+     * that the next media's first beat lands on a beat of the current one.
+     * Loading other media clears it.
+     * 
+     * @param bpm Tempo, 0 if unknown
+     * @param firstBeatMs Position of the first beat in milliseconds
+     */
+    void setBeatGrid(double bpm, double firstBeatMs);
+    
+    /**
+     * @brief Set the beat grid of the next media
+     * @param bpm Tempo, 0 if unknown
+     * @param firstBeatMs Position of the first beat in milliseconds
+     */
+    void setNextBeatGrid(double bpm, double firstBeatMs);
+    
+    /**
+     * @brief Receive the playback position periodically while playing
+     * 
+     * Forwarded to the current media engine, so each consumer gets the
+     * rate it asks for instead of positionChanged()'s. Subscriptions are
+     * made on the engine set at the time of the call.
+     * 
+     * @param context Receiver; the subscription ends when it is destroyed
+     * @param intervalMs Wanted update interval in milliseconds
+     * @param callback Called with the position in milliseconds
+     */
+    void subscribePosition(QObject* context, int intervalMs, std::function<void(qint64)> callback);
+    
+    /**
+     * @brief End a position subscription
+     * @param context Receiver passed to subscribePosition()
+     */
+    void unsubscribePosition(QObject* context);
+    
+    /**
+     * @brief Set where resume positions are kept
+     * 
+     * Without a store nothing is resumed.
+     * 
+     * @param store Resume store, typically the PlaylistManager; not owned
+     */
+    void setResumeStore(IResumeStore* store) { m_resumeStore = store; }
+    IResumeStore* resumeStore() const { return m_resumeStore; }
+    
+    /**
+     * @brief Set where keyframe indexes of files without one of their own are kept
+     * 
+     * Local files get their stored index handed to the engine as they are
+     * opened or preloaded; a file without one is indexed in the background.
+     * 
+     * @param store Seek index store, typically the library's SeekIndexer; not owned
+     */
+    void setSeekIndexStore(ISeekIndexStore* store) { m_seekIndexStore = store; }
+    ISeekIndexStore* seekIndexStore() const { return m_seekIndexStore; }
+    
+    /**
+     * @brief Set where local copies of upcoming media are kept
+     * 
+     * Media with a copy is opened and preloaded from it, so tracks on a NAS
+     * or podcast episodes start without waiting on the network.
+     * 
+     * @param cache Prefetch cache, typically a QueuePrefetcher following the play queue; not owned
+     */
+    void setPrefetchCache(IPrefetchCache* cache) { m_prefetchCache = cache; }
+    IPrefetchCache* prefetchCache() const { return m_prefetchCache; }
+    
     /**
      * @brief Save current playback position for resume
      * @param filePath File path to save position for
@@ -321,8 +453,22 @@ public:
      */
     void clearResumePosition(const QString& filePath);
     
+    /**
+     * @brief Get seek preview image without blocking
+     * 
+     * Previews are decoded in the background; when the image is not ready
+     * yet a decode is queued and seekThumbnailReady() follows.
+     * 
+     * @param position Position in milliseconds
+     * @return Preview image or null image if not available yet
+     */
+    QImage seekThumbnail(qint64 position);
+    
     /**
      * @brief Generate thumbnail for seek preview
+     * 
+     * Base64 wrapper around seekThumbnail() for existing callers.
+     * 
      * @param position Position in milliseconds
      * @return Base64 encoded thumbnail image or empty string if not available
      */
@@ -346,6 +492,15 @@ public slots:
      * @param path File path or URL to load
      */
     void loadMedia(const QString& path);
+    
+    /**
+     * @brief Load media and start at a position instead of the resume position
+     * 
+     * Seeks only if path is already loaded, e.g. for subtitle search hits.
+     * @param path File path or URL to load
+     * @param position Position in milliseconds
+     */
+    void loadMediaAt(const QString& path, qint64 position);
 
 signals:
     // Playback control signals
@@ -425,12 +580,31 @@ signals:
      */
     void gaplessPlaybackChanged(bool enabled);
     
+    /**
+     * @brief Emitted when playback moved on to the next media by itself
+     * @param path Path of the media now playing
+     */
+    void nextMediaStarted(const QString& path);
+    
+    /**
+     * @brief Emitted when the current media rendered its first frame
+     * @param profile Latency breakdown of the open
+     */
+    void mediaOpenProfiled(const MediaOpenProfile& profile);
+    
     /**
      * @brief Emitted when a seek thumbnail is generated
      * @param position Position in milliseconds
      * @param thumbnail Base64 encoded thumbnail image
      */
     void seekThumbnailGenerated(qint64 position, const QString& thumbnail);
+    
+    /**
+     * @brief Emitted when a queued seek preview has been decoded
+     * @param position Bucket position in milliseconds the preview was taken at
+     * @param thumbnail Preview image
+     */
+    void seekThumbnailReady(qint64 position, const QImage& thumbnail);
 
 private slots:
     /**
@@ -451,6 +625,13 @@ private slots:
      */
     void onEngineDurationChanged(qint64 duration);
     
+    /**
+     * @brief Forward a decoded preview from the thumbnail service
+     * @param position Bucket position in milliseconds
+     * @param thumbnail Preview image
+     */
+    void onThumbnailReady(qint64 position, const QImage& thumbnail);
+    
     /**
      * @brief Handle media engine volume changes
      * @param volume New volume from media engine
@@ -469,6 +650,18 @@ private slots:
      */
     void onEngineMediaLoaded(bool success);
     
+    /**
+     * @brief Handle the engine continuing with preloaded media
+     * @param path Path of the media now playing
+     */
+    void onEnginePreloadedMediaStarted(const QString& path);
+    
+    /**
+     * @brief Issue the pending seek once the engine landed
+     * @param position Position the engine landed on
+     */
+    void onEngineSeekCompleted(qint64 position);
+    
     /**
      * @brief Handle fast seek timer timeout
      */
@@ -497,6 +690,33 @@ private:
      */
     int clampVolume(int volume) const;
     
+    /**
+     * @brief Clamp a seek target to the media
+     */
+    qint64 clampSeekPosition(qint64 position) const;
+    
+    /**
+     * @brief Issue a seek now, or keep it as the one to issue next
+     * @param position Target in milliseconds
+     * @param precise false for a keyframe seek
+     */
+    void requestSeek(qint64 position, bool precise);
+    
+    /**
+     * @brief Forget seeks in flight and pending
+     */
+    void resetSeekSchedule();
+    
+    /**
+     * @brief Give the engine the stored seek index of a file about to be opened, or have one built
+     */
+    void applySeekIndex(const QString& path);
+    
+    /**
+     * @brief Point the engine at the local copy of media about to be opened, if there is one
+     */
+    void applyPrefetchedCopy(const QString& path);
+    
     /**
      * @brief Validate and clamp playback speed
      * @param speed Speed to validate
@@ -504,6 +724,31 @@ private:
      */
     int clampPlaybackSpeed(int speed) const;
     
+    /**
+     * @brief Preload the next media and start crossfades near the end
+     * @param position Current position in milliseconds
+     */
+    void updateTransition(qint64 position);
+    
+    /**
+     * @brief Position to start the crossfade at, aligned to the beat grids
+     * @param totalDuration Duration of the current media
+     * @param fadeMs Receives the crossfade duration
+     */
+    qint64 crossfadeStart(qint64 totalDuration, int& fadeMs) const;
+    
+    /**
+     * @brief Show a frame from the frame history
+     * @return false if there was no frame to show
+     */
+    bool presentHistoryFrame(const VideoFrameRef& frame);
+    
+    /**
+     * @brief Show the keyframe preview for a trick-play position
+     * @param position Trick-play position in milliseconds
+     */
+    void presentTrickPlayFrame(qint64 position);
+    
     std::shared_ptr<IMediaEngine> m_mediaEngine;
     bool m_initialized;
     
@@ -519,6 +764,18 @@ private:
     int m_fastSeekSpeed;
     bool m_fastSeekForward;
     QTimer* m_fastSeekTimer;
+    qint64 m_fastSeekPosition;          // Trick-play position, the engine stays where it paused
+    QElapsedTimer m_fastSeekClock;
+    qint64 m_trickPlayBucket;           // Preview bucket on screen, -1 for none
+    std::unique_ptr<VideoFramePool> m_trickPlayFrames;
+    
+    // Seek schedule: one seek in flight, the latest request waits behind it
+    QTimer* m_seekTimeoutTimer;
+    bool m_seekInFlight;
+    qint64 m_seekTarget;
+    qint64 m_pendingSeekPosition;       // -1 when nothing waits
+    bool m_pendingSeekPrecise;
+    qint64 m_loadStartPosition;         // -1 to resume, set by loadMediaAt()
     
     // Crossfade settings
     bool m_crossfadeEnabled;
@@ -528,17 +785,42 @@ private:
     
     // Gapless playback
     bool m_gaplessPlayback;
+    QString m_nextMediaPath;
+    QString m_preloadRequestedPath;     // Preload is attempted once per next media
+    
+    // Beat grids for beat-matched crossfades
+    struct BeatGrid {
+        double bpm = 0.0;
+        double firstBeatMs = 0.0;
+    };
+    BeatGrid m_beatGrid;
+    BeatGrid m_nextBeatGrid;
+    
+    // Resume positions, persisted and write-behind
+    IResumeStore* m_resumeStore;
     
-    // Resume positions (file path -> position in ms)
-    QHash<QString, qint64> m_resumePositions;
+    // Keyframe indexes for files without one of their own
+    ISeekIndexStore* m_seekIndexStore;
+    
+    // Local copies of upcoming media
+    IPrefetchCache* m_prefetchCache;
     
     // Seek thumbnails
     bool m_seekThumbnailEnabled;
-    QHash<qint64, QString> m_thumbnailCache; // position -> base64 thumbnail
+    SeekThumbnailService* m_thumbnailService;
+    
+    // Recently displayed frames for stepping
+    std::unique_ptr<FrameHistory> m_frameHistory;
     
     // Speed limits
     static constexpr int MIN_PLAYBACK_SPEED = 10;   // 0.1x
     static constexpr int MAX_PLAYBACK_SPEED = 1000; // 10.0x
     static constexpr int FAST_SEEK_INTERVAL_MS = 100; // Fast seek update interval
+    static constexpr int TRICK_PLAY_PREFETCH_BUCKETS = 3; // Previews decoded ahead of the trick-play position
+    static constexpr qint64 RESUME_MIN_POSITION_MS = 5000;  // Earlier positions start over
+    static constexpr qint64 RESUME_END_MARGIN_MS = 10000;   // Later positions count as finished
+    static constexpr int SEEK_TIMEOUT_MS = 400; // In-flight seek given up on without seekCompleted()
     static constexpr int FRAME_STEP_MS = 33; // Approximate frame duration for 30fps
+    static constexpr qint64 PRELOAD_LEAD_MS = 8000; // Time before the end (plus crossfade) to open the next media
+    static constexpr int POSITION_UPDATE_INTERVAL_MS = 250; // Rate of positionChanged() while playing
 };
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+#include <atomic>
+
+class QFile;
+
+/**
+ * @brief Keyframe to byte offset table of a file whose container has no usable index
+ *
+ * MPEG transport streams (recordings, broadcast captures), MPEG program
+ * streams and raw MPEG video carry no index, so the demuxer estimates a
+ * seek target from the bitrate or scans for it, and lands wherever the
+ * estimate was off. build() reads such a file once, front to back, and
+ * notes where each keyframe starts and its time since the start of the
+ * file; the engine then seeks to the byte offset of the keyframe at or
+ * before a target and decoding starts right there.
+ *
+ * Keyframes closer than MIN_SPACING_MS to the previous one are left out,
+ * so an all-intra stream does not grow the table. serialize() stores the
+ * table delta-encoded, a few bytes per keyframe.
+ */
+class SeekIndex
+{
+public:
+    enum class Container : quint8 {
+        Unknown,        // Not indexed; also containers with an index of their own
+        MpegTs,
+        MpegPs,
+        MpegVideo       // Raw MPEG-1/2 video elementary stream
+    };
+
+    struct Keyframe {
+        qint64 timeMs = 0;
+        qint64 offset = 0;
+    };
+
+    static constexpr qint64 MIN_SPACING_MS = 250;
+
+    SeekIndex() = default;
+
+    /**
+     * @brief Check from the file name whether a file may need an index, without opening it
+     */
+    static bool isCandidate(const QString& filePath);
+
+    /**
+     * @brief Tell the container from the start of a file
+     * @return Unknown if the file needs no index or cannot be indexed
+     */
+    static Container detect(const QString& filePath);
+
+    /**
+     * @brief Read a file and list its keyframes
+     * @param cancelled Checked between reads; the index is empty if it became true
+     * @return Empty index if the file needs none or no keyframe was found
+     */
+    static SeekIndex build(const QString& filePath, const std::atomic<bool>* cancelled = nullptr);
+
+    QByteArray serialize() const;
+
+    /**
+     * @return Empty index if the data is empty, damaged or from another version
+     */
+    static SeekIndex deserialize(const QByteArray& data);
+
+    bool isEmpty() const { return m_keyframes.isEmpty(); }
+    Container container() const { return m_container; }
+    qint64 fileSize() const { return m_fileSize; }
+    const QVector<Keyframe>& keyframes() const { return m_keyframes; }
+
+    /**
+     * @brief Get the keyframe to start decoding at for a position
+     * @return The last keyframe at or before the position, the first one before it
+     */
+    Keyframe keyframeAt(qint64 timeMs) const;
+
+private:
+    static SeekIndex buildTransportStream(QFile& file, int packetSize, const std::atomic<bool>* cancelled);
+    static SeekIndex buildProgramStream(QFile& file, const std::atomic<bool>* cancelled);
+    static SeekIndex buildVideoStream(QFile& file, const std::atomic<bool>* cancelled);
+
+    void append(qint64 timeMs, qint64 offset);
+
+    Container m_container = Container::Unknown;
+    qint64 m_fileSize = 0;
+    QVector<Keyframe> m_keyframes;
+};
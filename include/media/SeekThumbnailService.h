@@ -0,0 +1,144 @@
+#pragma once
+
+#include <QObject>
+#include <QCache>
+#include <QImage>
+#include <QRect>
+#include <QSet>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+
+class SeekThumbnailWorker;
+
+/**
+ * @brief Background seek preview generator with memory and disk caches
+ *
+ * Thumbnails are decoded by a private, muted libVLC instance on a worker
+ * thread, never by the playback engine or the UI thread. Positions are
+ * quantized to buckets of bucketDuration() and seeks snap to keyframes, so
+ * dragging across the timeline costs at most one decode per bucket, newest
+ * request first. Decoded tiles live in an LRU cache with a byte budget and
+ * are drawn into a per-file sprite sheet that is saved to cacheDirectory()
+ * and reloaded when the same file is opened again.
+ */
+class SeekThumbnailService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int TILE_WIDTH = 160;
+    static constexpr int TILE_HEIGHT = 90;
+    static constexpr int SPRITE_COLUMNS = 10;
+    static constexpr int MAX_BUCKETS = 200;
+    static constexpr qint64 MIN_BUCKET_MS = 2000;
+    static constexpr int DEFAULT_CACHE_BYTES = 16 * 1024 * 1024;
+    static constexpr int SAVE_DELAY_MS = 3000;
+
+    explicit SeekThumbnailService(QObject* parent = nullptr);
+    ~SeekThumbnailService() override;
+
+    /**
+     * @brief Select the media to generate previews for
+     *
+     * Loads the saved sprite sheet for the file if one matches.
+     *
+     * @param path File path or URL
+     * @param duration Media duration in milliseconds
+     */
+    void setMedia(const QString& path, qint64 duration);
+
+    /**
+     * @brief Forget the current media, saving its sprite sheet first
+     */
+    void clear();
+
+    /**
+     * @brief Get the preview for a position without blocking
+     *
+     * If the bucket has not been decoded yet, a decode is queued and
+     * thumbnailReady() is emitted when it completes.
+     *
+     * @param position Position in milliseconds
+     * @return Preview image, or a null image if not available yet
+     */
+    QImage thumbnail(qint64 position);
+
+    /**
+     * @brief Queue the previews along a stretch of the timeline
+     *
+     * Decoded nearest to fromPosition first, for trick play in either
+     * direction. At most the worker's queue length is kept.
+     *
+     * @param fromPosition Position to start from in milliseconds
+     * @param toPosition Position to end at, before fromPosition for rewind
+     */
+    void prefetch(qint64 fromPosition, qint64 toPosition);
+
+    /**
+     * @brief Get the position a preview is actually taken from
+     * @param position Position in milliseconds
+     * @return Start of the position's bucket in milliseconds
+     */
+    qint64 bucketPosition(qint64 position) const;
+
+    /**
+     * @brief Get the bucket length for the current media
+     * @return Bucket length in milliseconds
+     */
+    qint64 bucketDuration() const { return m_bucketDuration; }
+
+    /**
+     * @brief Set the memory budget of the tile cache
+     * @param bytes Budget in bytes
+     */
+    void setCacheBudget(int bytes);
+
+    /**
+     * @brief Get the memory budget of the tile cache
+     * @return Budget in bytes
+     */
+    int cacheBudget() const;
+
+    /**
+     * @brief Get the directory holding saved sprite sheets
+     */
+    static QString cacheDirectory();
+
+signals:
+    /**
+     * @brief Emitted when a queued preview has been decoded
+     * @param position Bucket start in milliseconds
+     * @param image Preview image
+     */
+    void thumbnailReady(qint64 position, const QImage& image);
+
+private:
+    friend class SeekThumbnailWorker;
+
+    void onThumbnailDecoded(quint64 generation, int bucket, const QImage& image);
+    void storeTile(int bucket, const QImage& tile);
+    bool loadSprite();
+    void saveSprite();
+    QString tileKey(int bucket) const;
+    QRect tileRect(int bucket) const;
+    int bucketIndex(qint64 position) const;
+    static QString mediaKey(const QString& path);
+
+    QThread m_workerThread;
+    SeekThumbnailWorker* m_worker;
+
+    QString m_mediaPath;
+    QString m_mediaKey;             // Empty when the media cannot be persisted
+    qint64 m_duration;
+    qint64 m_bucketDuration;
+    int m_bucketCount;
+    quint64 m_generation;
+
+    QCache<QString, QImage> m_tileCache;    // Shared across files, cost in bytes
+    QImage m_sprite;
+    QSet<int> m_spriteTiles;
+    QSet<int> m_requestedBuckets;
+    bool m_spriteDirty;
+    QTimer* m_saveTimer;
+};
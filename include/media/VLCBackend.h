@@ -4,9 +4,14 @@
 #include "IComponent.h"
 #include "HardwareAcceleration.h"
 #include "UserPreferences.h"
+#include "VideoFrame.h"
+#include "PlaybackClock.h"
 #include <QObject>
 #include <QTimer>
 #include <QMutex>
+#include <QVector>
+#include <QElapsedTimer>
+#include <atomic>
 #include <memory>
 
 // Forward declarations for libVLC types
@@ -15,11 +20,35 @@ struct libvlc_media_player_t;
 struct libvlc_media_t;
 struct libvlc_event_manager_t;
 
+class SandboxedDecoder;
+class SandboxedDecoderPool;
+struct PrefetchedSource;
+
 /**
  * @brief libVLC-based media engine implementation
  * 
  * Provides media playback functionality using the libVLC library.
  * Handles initialization, cleanup, and sandboxed decoding for security.
+ * Video is decoded into pooled RGB32 frames through the libVLC video
+ * callbacks and delivered to registered IVideoFrameSink instances.
+ * 
+ * A second media player holds the preloaded next media, opened and paused
+ * on its first frame. At end of stream the players swap roles, or overlap
+ * with an equal-power volume ramp for crossfades. A spare player is kept
+ * ready for the next preload.
+ * 
+ * The libVLC instance carries no caching or decoder arguments. Each media
+ * gets them as options from the profile of its source (file, network or
+ * live) and from the hardware acceleration settings, so changing either
+ * never creates a new instance.
+ * 
+ * With a GpuOutput set, players render into it instead of the frame pool,
+ * so hardware-decoded pictures never leave the GPU. With an AudioOutput
+ * set, players hand it their decoded audio instead of playing it through
+ * libVLC's own output.
+ * 
+ * With a decoder sandbox set, untrusted downloads are decoded in a worker
+ * process instead of a player here.
  */
 class VLCBackend : public IMediaEngine, public IComponent
 {
@@ -34,6 +63,7 @@ public:
     void shutdown() override;
     QString componentName() const override { return "VLCBackend"; }
     bool isInitialized() const override { return m_initialized; }
+    bool canInitializeConcurrently() const override { return true; } // libVLC setup and hardware probing only
     
     // IMediaEngine interface
     bool loadMedia(const QString& path) override;
@@ -41,13 +71,127 @@ public:
     void pause() override;
     void stop() override;
     void seek(qint64 position) override;
+    void seekFast(qint64 position) override;
+    void setSeekIndex(const QString& path, std::shared_ptr<const SeekIndex> index) override;
+    void setPrefetchedCopy(const QString& path, const PrefetchedCopy& copy) override;
     void setVolume(int volume) override;
     
     PlaybackState state() const override { return m_currentState; }
     qint64 position() const override;
     qint64 duration() const override;
     int volume() const override { return m_currentVolume; }
-    bool hasMedia() const override { return m_currentMedia != nullptr; }
+    bool hasMedia() const override { return m_player->media != nullptr || m_sandboxed != nullptr; }
+    bool hasVideo() const override;
+    
+    void addVideoFrameSink(IVideoFrameSink* sink) override;
+    void removeVideoFrameSink(IVideoFrameSink* sink) override;
+    VideoFrameRef latestVideoFrame() const override;
+    void presentVideoFrame(const VideoFrameRef& frame) override;
+    bool stepFrame() override;
+    
+    bool preloadMedia(const QString& path) override;
+    void clearPreloadedMedia() override;
+    QString preloadedMedia() const override;
+    bool switchToPreloadedMedia(int overlapMs = 0) override;
+    
+    void subscribePosition(QObject* context, int intervalMs, std::function<void(qint64)> callback) override;
+    void unsubscribePosition(QObject* context) override;
+    
+    /**
+     * @brief Video output that keeps decoded pictures on the GPU
+     * 
+     * Attached players render through libvlc_video_set_output_callbacks()
+     * instead of the frame callbacks, so video frame sinks, latestVideoFrame()
+     * and stepFrame() get no frames from them. Implemented by GpuVideoOutput.
+     */
+    class GpuOutput
+    {
+    public:
+        virtual ~GpuOutput() = default;
+        
+        /**
+         * @brief Route the pictures of a new player, before its first media
+         * @return false to keep the player on the frame callbacks
+         */
+        virtual bool attachPlayer(libvlc_media_player_t* player) = 0;
+        
+        /**
+         * @brief Forget a player once it was released
+         */
+        virtual void detachPlayer(libvlc_media_player_t* player) = 0;
+        
+        /**
+         * @brief Show the pictures of this player from now on
+         */
+        virtual void setActivePlayer(libvlc_media_player_t* player) = 0;
+    };
+    
+    /**
+     * @brief Render video into a GPU output instead of the frame pool
+     * 
+     * Players choose their output when created, so every player is created
+     * again and the active media reopened at its position. The output must
+     * stay alive until it is replaced or reset with nullptr.
+     * 
+     * @param output Output to use; nullptr returns to the frame callbacks
+     */
+    void setGpuOutput(GpuOutput* output);
+    GpuOutput* gpuOutput() const { return m_gpuOutput; }
+    
+    /**
+     * @brief Audio output that takes the decoded samples from libVLC
+     * 
+     * Attached players deliver through libvlc_audio_set_callbacks() and
+     * libvlc_audio_set_format_callbacks() instead of a libVLC audio output
+     * module. Implemented by ExclusiveAudioSink.
+     */
+    class AudioOutput
+    {
+    public:
+        virtual ~AudioOutput() = default;
+        
+        /**
+         * @brief Route the audio of a new player, before its first media
+         * @return false to keep the player on libVLC's audio output
+         */
+        virtual bool attachPlayer(libvlc_media_player_t* player) = 0;
+        
+        /**
+         * @brief Forget a player once it was released
+         */
+        virtual void detachPlayer(libvlc_media_player_t* player) = 0;
+        
+        /**
+         * @brief Play the audio of this player from now on
+         */
+        virtual void setActivePlayer(libvlc_media_player_t* player) = 0;
+    };
+    
+    /**
+     * @brief Hand decoded audio to an output instead of libVLC's
+     * 
+     * Like setGpuOutput(), every player is created again and the active
+     * media reopened at its position. The output must stay alive until it
+     * is replaced or reset with nullptr.
+     * 
+     * @param output Output to use; nullptr returns to libVLC's audio output
+     */
+    void setAudioOutput(AudioOutput* output);
+    AudioOutput* audioOutput() const { return m_audioOutput; }
+    
+    /**
+     * @brief Decode untrusted downloads in sandboxed worker processes
+     * 
+     * Files the pool's shouldSandbox() picks open in a pre-spawned worker
+     * instead of a player here. Their pictures reach the video frame sinks
+     * straight from shared memory and their audio plays through a
+     * QAudioSink; preloading, the GPU and audio outputs and frame stepping
+     * do not apply to them. The pool must stay alive until it is reset.
+     * 
+     * @param pool Pool to use; nullptr decodes every file in this process
+     */
+    void setDecoderSandbox(SandboxedDecoderPool* pool);
+    SandboxedDecoderPool* decoderSandbox() const { return m_decoderSandbox; }
     
     /**
      * @brief Get libVLC version information
@@ -84,37 +228,257 @@ public:
      * @param preferences User preferences containing hardware settings
      */
     void updateHardwareAccelerationFromPreferences(const UserPreferences& preferences);
-
-signals:
+    
     /**
-     * @brief Emitted when playback position changes
-     * @param position New position in milliseconds
+     * @brief libVLC decoder statistics of the current media
+     * 
+     * Totals count from the start of the media. Polled about once a second
+     * while playing; dropPercent covers the last poll interval only.
      */
-    void playbackPositionChanged(qint64 position);
+    struct DecoderStats
+    {
+        bool valid = false;             // Polled at least once for this media
+        QString decoder;                // Acceleration in use, e.g. "VA-API"
+        qint64 decodedVideo = 0;
+        qint64 displayedPictures = 0;
+        qint64 lostPictures = 0;        // Dropped by libVLC (late or corrupt)
+        qint64 poolDroppedPictures = 0; // Dropped because consumers held every frame buffer
+        qint64 decodedAudio = 0;
+        qint64 playedAudioBuffers = 0;
+        qint64 lostAudioBuffers = 0;
+        qint64 demuxCorrupted = 0;
+        qint64 demuxDiscontinuities = 0;
+        double inputBitrate = 0.0;      // kbit/s
+        double demuxBitrate = 0.0;      // kbit/s
+        double dropPercent = 0.0;       // Dropped of decoded pictures, last poll interval
+    };
     
     /**
-     * @brief Emitted when media duration changes
-     * @param duration New duration in milliseconds
+     * @brief Get the latest decoder statistics
+     * @return Statistics; valid is false until the first poll of the current media
      */
-    void playbackDurationChanged(qint64 duration);
+    DecoderStats decoderStats() const;
 
 private slots:
     /**
-     * @brief Update position and duration periodically
+     * @brief Advance the crossfade volume ramp
      */
-    void updatePosition();
+    void updateFade();
 
 private:
+    enum class SlotRole {
+        Active,     // Reported through state, position and video sinks
+        Preloaded,  // Buffered next media, paused on its first frame
+        Retiring    // Previous media fading out, events ignored
+    };
+    
+    enum class SourceKind {
+        File,       // Local files and file:// URLs
+        Network,    // Streams of known length: HTTP, SMB, FTP, ...
+        Live        // RTSP, RTP, UDP, MMS and HLS playlists
+    };
+    
+    /**
+     * @brief One libVLC media player with its own frame pool
+     * 
+     * Slots never move once created, so libVLC callbacks use them as their
+     * opaque pointer and can tell which player fired.
+     */
+    struct PlayerSlot
+    {
+        explicit PlayerSlot(VLCBackend* owner) : backend(owner) {}
+        
+        VLCBackend* backend;
+        libvlc_media_player_t* player = nullptr;
+        libvlc_media_t* media = nullptr;
+        QString path;
+        std::atomic<SlotRole> role{SlotRole::Active};
+        std::atomic<bool> ready{true};              // Preloaded media reached its first frame
+        std::atomic<bool> resumeWhenReady{false};   // Resume as soon as it does
+        
+        // Open latency, reported to MediaOpenProfiler
+        std::atomic<bool> awaitingFirstFrame{false};
+        std::atomic<bool> firstTimeSeen{false};
+        std::atomic<qint64> playRequestedUs{-1};
+        std::atomic<qint64> playingUs{-1};
+        
+        // Seek awaiting a time event near its target, reported as seekCompleted()
+        std::atomic<bool> seekPending{false};
+        std::atomic<qint64> seekTargetMs{0};
+        std::atomic<qint64> seekToleranceMs{0};
+        
+        // Keyframe index of a file without one of its own; seeks go to byte positions
+        std::shared_ptr<const SeekIndex> seekIndex;
+        bool tsSeekPercent = false;                 // Opened with positions as byte offsets in MPEG-TS
+        
+        // Prefix copy the media reads through libVLC's media callbacks; kept for its opens
+        std::shared_ptr<const PrefetchedSource> prefetched;
+        
+        // Network sources report arrival and stalls to JitterBufferController
+        SourceKind source = SourceKind::File;
+        std::atomic<bool> filled{false};            // Buffered fully since the open or last seek
+        std::atomic<bool> stalled{false};           // Rebuffering after that
+        
+        // Video frame delivery (m_frameMutex)
+        VideoFramePool framePool;
+        std::shared_ptr<VideoFrame> pendingFrame;   // Locked by libVLC, not yet displayed
+        QVector<uchar> dropBuffer;                  // Decode target when every pooled frame is held
+        std::atomic<quint64> poolDrops{0};          // Pictures decoded into dropBuffer
+        
+        // libVLC counters at the last poll (m_statsMutex)
+        qint64 statsPolledUs = 0;
+        int lostPictures = 0;
+        int lostAudioBuffers = 0;
+        int decodedVideo = 0;
+        int readBytes = 0;
+        quint64 polledPoolDrops = 0;
+    };
+    
     /**
      * @brief Initialize libVLC instance with security options
      * @return true if initialization successful
      */
     bool initializeVLC();
     
+    /**
+     * @brief Classify a path or URL for its option profile
+     */
+    static SourceKind sourceKindOf(const QString& path);
+    
+    /**
+     * @brief Caching and decoder options of the source profile of a path
+     * 
+     * Network caching comes from the JitterBufferController profile of the host.
+     */
+    static QStringList sourceOptions(const QString& path);
+    
+    /**
+     * @brief Start reporting a slot's new media to the JitterBufferController
+     */
+    void beginSource(PlayerSlot* slot, const QString& path);
+    
+    /**
+     * @brief Stop reporting a slot's media, storing what was learnt about its host
+     */
+    void endSource(PlayerSlot* slot);
+    
+    /**
+     * @brief Seek the active player, exactly or to a nearby keyframe
+     */
+    void seekTo(qint64 position, bool fast);
+    
+    /**
+     * @brief Seek the active player to the keyframe its seek index has for a position
+     * @return false if the media has no index it can seek by
+     */
+    bool seekByIndex(qint64 position);
+    
+    /**
+     * @brief Hand a newly created slot media the seek index set for its path
+     */
+    void attachSeekIndex(PlayerSlot* slot, const QString& path);
+    
+    /**
+     * @brief Create the media player of a slot and register its callbacks
+     * @return true if the player was created
+     */
+    bool createPlayer(PlayerSlot* slot);
+    
+    /**
+     * @brief Stop and release the player and media of a slot
+     */
+    void releasePlayer(PlayerSlot* slot);
+    
+    /**
+     * @brief Release a standby slot and reset the pointer
+     */
+    void discardPlayer(std::unique_ptr<PlayerSlot>& slot);
+    
+    /**
+     * @brief Hand out the spare player, creating one if there is none
+     * @return Slot with a player, nullptr on failure
+     */
+    std::unique_ptr<PlayerSlot> takeSparePlayer();
+    
+    /**
+     * @brief Create the spare player unless there is one
+     */
+    void createSparePlayer();
+    
+    /**
+     * @brief Open the active media again with the current decoder options
+     */
+    void reopenActiveMedia();
+    
+    /**
+     * @brief Create every player again around a change of outputs
+     * 
+     * The players are released while the old outputs still know them,
+     * then switchOutputs runs and the active and preloaded media are
+     * opened again as they were.
+     */
+    void recreatePlayers(const std::function<void()>& switchOutputs);
+    
+    /**
+     * @brief Create libVLC media for a path or URL, reading the copy set for it if there is one
+     * @return New media, nullptr on failure
+     */
+    libvlc_media_t* createMedia(PlayerSlot* slot, const QString& path);
+    
+    /**
+     * @brief Make the preloaded slot active and retire the current one
+     */
+    void promotePreloaded();
+    
+    /**
+     * @brief Resume a slot, waiting for its first frame if still buffering
+     */
+    void resumePlayer(PlayerSlot* slot);
+    
+    /**
+     * @brief Mark a slot buffered and resume it if that was requested
+     * @return true if the slot is resumed instead of staying paused
+     */
+    bool markReady(PlayerSlot* slot);
+    
+    /**
+     * @brief End a running crossfade and release the retiring player
+     */
+    void finishFade();
+    
+    /**
+     * @brief Continue with the preloaded media or stop at end of stream
+     * @param slot Slot that reached its end
+     */
+    void handleEndReached(PlayerSlot* slot);
+    
+    /**
+     * @brief Complete the open profile of a slot at its first output
+     * @param slot Active slot
+     * @param video true for the first picture, false for the first audio
+     * @param atUs Time from TraceLog::now()
+     */
+    void reportFirstOutput(PlayerSlot* slot, bool video, qint64 atUs);
+    
+    /**
+     * @brief Refresh the decoder statistics and add losses since the last poll to the metrics
+     */
+    void pollDecoderStats(PlayerSlot* slot);
+    
+    /**
+     * @brief Start the decoder statistics over for new media on the active slot
+     */
+    void resetDecoderStats();
+    
     /**
      * @brief Setup libVLC event callbacks
      */
-    void setupEventCallbacks();
+    void setupEventCallbacks(PlayerSlot* slot);
+    
+    /**
+     * @brief Route decoded video into the frame pool
+     */
+    void setupVideoCallbacks(PlayerSlot* slot);
     
     /**
      * @brief Clean up libVLC resources
@@ -123,9 +487,15 @@ private:
     
     /**
      * @brief Handle libVLC events
+     * @param slot Slot whose player fired the event
      * @param event libVLC event
      */
-    void handleVLCEvent(const struct libvlc_event_t* event);
+    void handleVLCEvent(PlayerSlot* slot, const struct libvlc_event_t* event);
+    
+    /**
+     * @brief Handle libVLC events of the preloaded player
+     */
+    void handlePreloadEvent(PlayerSlot* slot, const struct libvlc_event_t* event);
     
     /**
      * @brief Convert libVLC state to PlaybackState
@@ -146,27 +516,62 @@ private:
      */
     void configureSandboxing();
     
+    /**
+     * @brief Open a file in a worker of the decoder sandbox
+     */
+    bool loadSandboxed(const QString& path);
+    
+    /**
+     * @brief Let go of the sandboxed decoder, possibly from one of its signals
+     */
+    void releaseSandboxed();
+    
     // Static callback for libVLC events
     static void vlcEventCallback(const struct libvlc_event_t* event, void* userData);
     
+    // Static callbacks for libVLC video output (decoder thread)
+    static unsigned videoFormatCallback(void** opaque, char* chroma, unsigned* width, unsigned* height,
+                                        unsigned* pitches, unsigned* lines);
+    static void videoCleanupCallback(void* opaque);
+    static void* videoLockCallback(void* opaque, void** planes);
+    static void videoUnlockCallback(void* opaque, void* picture, void* const* planes);
+    static void videoDisplayCallback(void* opaque, void* picture);
+    
     // libVLC objects
     libvlc_instance_t* m_vlcInstance;
-    libvlc_media_player_t* m_mediaPlayer;
-    libvlc_media_t* m_currentMedia;
-    libvlc_event_manager_t* m_eventManager;
+    std::unique_ptr<PlayerSlot> m_player;           // Active, always allocated
+    std::unique_ptr<PlayerSlot> m_nextPlayer;       // Preloaded next media
+    std::unique_ptr<PlayerSlot> m_retiringPlayer;   // Fading out during a crossfade
+    std::unique_ptr<PlayerSlot> m_sparePlayer;      // Idle, taken by the next preload
+    GpuOutput* m_gpuOutput;                         // Not owned
+    AudioOutput* m_audioOutput;                     // Not owned
+    SandboxedDecoderPool* m_decoderSandbox;         // Not owned
+    std::unique_ptr<SandboxedDecoder> m_sandboxed;  // Active media when decoded out of process
+    
+    // Seek index for the next open of its path
+    QString m_seekIndexPath;
+    std::shared_ptr<const SeekIndex> m_seekIndex;
+    
+    // Local copy for the next open of its path
+    QString m_prefetchedPath;
+    PrefetchedCopy m_prefetchedCopy;
     
     // State tracking
     PlaybackState m_currentState;
     int m_currentVolume;
-    qint64 m_currentPosition;
     qint64 m_currentDuration;
     bool m_initialized;
     
     // Thread safety
     mutable QMutex m_stateMutex;
     
-    // Position update timer
-    QTimer* m_positionTimer;
+    // Position, interpolated between libVLC time events
+    PlaybackClock* m_clock;
+    
+    // Crossfade volume ramp
+    QTimer* m_fadeTimer;
+    QElapsedTimer m_fadeClock;
+    int m_fadeDuration;
     
     // Security and validation
     QStringList m_allowedExtensions;
@@ -174,4 +579,21 @@ private:
     
     // Hardware acceleration
     std::unique_ptr<HardwareAcceleration> m_hardwareAcceleration;
+    
+    // Video frame delivery
+    VideoFrameRef m_latestFrame;
+    quint64 m_frameSequence;
+    mutable QMutex m_frameMutex;
+    
+    QVector<IVideoFrameSink*> m_videoSinks;
+    QMutex m_sinkMutex;
+    
+    // Decoder statistics of the active slot
+    DecoderStats m_decoderStats;
+    mutable QMutex m_statsMutex;
+    
+    static constexpr int FADE_STEP_MS = 40;
+    static constexpr int FILE_CACHING_MS = 1000;
+    static constexpr qint64 SEEK_TOLERANCE_MS = 500;        // Time events this near the target end a seek
+    static constexpr qint64 FAST_SEEK_TOLERANCE_MS = 10000; // Keyframe seeks may land a GOP away
 };
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+#include <functional>
+#include <memory>
+
+class QImage;
+class VideoFrame;
+class VideoFramePool;
+
+using VideoFrameRef = std::shared_ptr<const VideoFrame>;
+
+/**
+ * @brief Decoded RGB32 video picture owned by a VideoFramePool
+ *
+ * Frames are handed out as VideoFrameRef, a shared reference. Consumers
+ * keep a reference for as long as they need the pixels; when the last
+ * reference goes away the buffer returns to its pool instead of being
+ * freed, so steady-state playback allocates nothing per frame.
+ */
+class VideoFrame
+{
+public:
+    /**
+     * @brief Wrap RGB32 pixels owned elsewhere, e.g. shared memory, without copying
+     *
+     * @param data Pixels, valid until release runs
+     * @param release Called once the last reference is gone
+     */
+    static std::shared_ptr<VideoFrame> wrap(const uchar* data, int width, int height, int bytesPerLine,
+                              std::function<void()> release);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int bytesPerLine() const { return m_bytesPerLine; }
+    const uchar* bits() const { return m_bits; }
+    uchar* bits() { return m_bits; }
+
+    /**
+     * @brief Get the decode order number of this frame
+     */
+    quint64 sequence() const { return m_sequence; }
+    void setSequence(quint64 sequence) { m_sequence = sequence; }
+
+    /**
+     * @brief Get the playback position the frame was displayed at, in milliseconds
+     */
+    qint64 position() const { return m_position; }
+    void setPosition(qint64 position) { m_position = position; }
+
+private:
+    friend class VideoFramePool;
+
+    VideoFrame(int width, int height, int bytesPerLine, quint64 generation);
+
+    QVector<uchar> m_data;
+    uchar* m_bits;                  // m_data, or external pixels of a wrapped frame
+    int m_width;
+    int m_height;
+    int m_bytesPerLine;
+    quint64 m_generation;
+    quint64 m_sequence;
+    qint64 m_position;
+};
+
+/**
+ * @brief Wrap a frame in a QImage without copying the pixels
+ *
+ * The image holds its own reference to the frame, so it stays valid after
+ * the caller drops theirs. Modifying the image detaches it into a copy.
+ *
+ * @param frame Frame to wrap
+ * @return RGB32 image, or a null image for a null frame
+ */
+QImage videoFrameToImage(const VideoFrameRef& frame);
+
+/**
+ * @brief Fixed-size pool of reusable video frame buffers
+ *
+ * The decoder acquires a buffer per picture, fills it and publishes it as a
+ * VideoFrameRef. Buffers in use by consumers are never overwritten; when all
+ * of them are held, acquire() returns nullptr and the decoder drops the
+ * picture. Reconfiguring the format retires outstanding buffers, which are
+ * freed rather than recycled once released.
+ */
+class VideoFramePool
+{
+public:
+    static constexpr int DEFAULT_CAPACITY = 6;
+
+    explicit VideoFramePool(int capacity = DEFAULT_CAPACITY);
+    ~VideoFramePool();
+
+    VideoFramePool(const VideoFramePool&) = delete;
+    VideoFramePool& operator=(const VideoFramePool&) = delete;
+
+    /**
+     * @brief Set the picture format for subsequently acquired frames
+     * @param width Picture width in pixels
+     * @param height Picture height in pixels
+     * @return Bytes per line of the buffers (32-byte aligned)
+     */
+    int configure(int width, int height);
+
+    /**
+     * @brief Change the number of buffers; free ones over the new capacity are deleted
+     *
+     * Buffers in use over the capacity are deleted when they are released.
+     */
+    void setCapacity(int capacity);
+
+    /**
+     * @brief Take a free buffer (any thread)
+     * @return Writable frame, or nullptr if every buffer is in use
+     */
+    std::shared_ptr<VideoFrame> acquire();
+
+    /**
+     * @brief Get number of buffers currently held outside the pool
+     */
+    int framesInUse() const;
+
+private:
+    struct State;
+    std::shared_ptr<State> m_state;
+};
+
+/**
+ * @brief Receiver of decoded video frames
+ *
+ * videoFrameReady() is called on the decoder thread for every displayed
+ * picture. Implementations must return quickly, typically by storing the
+ * reference and scheduling work on their own thread.
+ */
+class IVideoFrameSink
+{
+public:
+    virtual ~IVideoFrameSink() = default;
+
+    /**
+     * @brief Handle a new frame
+     * @param frame Shared reference to the decoded picture
+     */
+    virtual void videoFrameReady(const VideoFrameRef& frame) = 0;
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QUrl>
+#include <QVector>
+
+/**
+ * @brief Chooses the rendition of an HLS/DASH stream from throughput and buffer
+ *
+ * In the buffer-based steady state the choice follows BOLA: every rendition
+ * scores (V * (utility + gp) - buffer) / bitrate, with utility the log of
+ * its bitrate, and the best score wins. Higher buffer favours higher
+ * bitrates. As in BOLA-O, an upswitch beyond what the measured throughput
+ * sustains is limited to one step above it, which avoids oscillation.
+ *
+ * While the buffer is below MIN_BUFFER_MS (start-up, after a seek or a
+ * stall) a throughput rule picks the highest rendition that fits into
+ * SAFETY_FACTOR of the estimate. Independently of both, if downloading the
+ * next segment at the current rendition would take longer than the buffer
+ * lasts, the controller switches down right away rather than waiting for
+ * the stall.
+ *
+ * Throughput is the lower of a fast and a slow exponentially weighted
+ * average, so drops count immediately and recoveries only once confirmed.
+ */
+class AdaptiveBitrateController : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Rendition {
+        int bandwidth = 0;          // Bits per second
+        QSize resolution;
+        QString codecs;
+        QString id;                 // DASH Representation id
+        QUrl url;                   // HLS variant playlist, or the manifest for DASH
+    };
+
+    explicit AdaptiveBitrateController(QObject* parent = nullptr);
+
+    /**
+     * @brief Set the renditions of the current stream
+     *
+     * They are sorted by bandwidth; the start-up choice is made from the
+     * throughput estimate, or the lowest rendition without one.
+     */
+    void setRenditions(QVector<Rendition> renditions);
+    QVector<Rendition> renditions() const { return m_renditions; }
+
+    /**
+     * @brief Forget the stream, keeping the throughput estimate
+     */
+    void clear();
+
+    /**
+     * @brief Add a throughput measurement
+     * @param bytes Bytes received in the interval
+     * @param durationMs Length of the interval
+     */
+    void addThroughputSample(qint64 bytes, qint64 durationMs);
+
+    /**
+     * @brief Report how much media is buffered ahead of the playhead
+     * @param bufferMs Buffered media in milliseconds
+     */
+    void setBufferLevel(qint64 bufferMs);
+
+    /**
+     * @brief Set the segment duration, from the playlist target duration
+     */
+    void setSegmentDuration(qint64 durationMs);
+
+    /**
+     * @brief Set the buffer the player aims for; BOLA reaches the top rendition there
+     */
+    void setBufferTarget(qint64 bufferMs);
+
+    /**
+     * @brief Switch between automatic selection and a fixed rendition
+     * @param index Rendition to keep, or -1 for automatic
+     */
+    void setFixedRendition(int index);
+    bool isAutomatic() const { return m_fixedIndex < 0; }
+
+    int currentIndex() const { return m_currentIndex; }
+    Rendition currentRendition() const;
+
+    /**
+     * @brief Get the throughput estimate
+     * @return Bits per second, 0 before the first sample
+     */
+    double throughputEstimate() const;
+
+    qint64 bufferLevel() const { return m_bufferMs; }
+
+signals:
+    /**
+     * @brief Emitted when another rendition should be played
+     * @param index Index into renditions()
+     * @param rendition The rendition
+     */
+    void renditionChanged(int index, const AdaptiveBitrateController::Rendition& rendition);
+
+private:
+    /**
+     * @brief Re-evaluate the choice after new input
+     */
+    void update();
+
+    int chooseByThroughput(double throughput) const;
+    int chooseByBuffer() const;
+    void updateBolaParameters();
+    void switchTo(int index, const char* reason);
+
+    QVector<Rendition> m_renditions;
+    QVector<double> m_utilities;        // ln(bitrate) shifted so the lowest is 1
+    double m_bolaGp = 0.0;
+    double m_bolaV = 0.0;
+
+    double m_fastEstimate = 0.0;        // Bits per second
+    double m_slowEstimate = 0.0;
+    double m_fastWeight = 0.0;          // Sample time seen, for start-up bias correction
+    double m_slowWeight = 0.0;
+
+    qint64 m_bufferMs = 0;
+    qint64 m_segmentMs = DEFAULT_SEGMENT_MS;
+    qint64 m_bufferTargetMs = DEFAULT_BUFFER_TARGET_MS;
+
+    int m_currentIndex = -1;
+    int m_fixedIndex = -1;
+
+    static constexpr double FAST_HALF_LIFE_MS = 3000.0;
+    static constexpr double SLOW_HALF_LIFE_MS = 8000.0;
+    static constexpr double SAFETY_FACTOR = 0.9;
+    static constexpr double STALL_MARGIN = 0.8;     // Share of the buffer a segment download may use
+    static constexpr qint64 MIN_BUFFER_MS = 10000;
+    static constexpr qint64 MIN_BUFFER_PER_LEVEL_MS = 2000;
+    static constexpr qint64 DEFAULT_SEGMENT_MS = 6000;
+    static constexpr qint64 DEFAULT_BUFFER_TARGET_MS = 30000;
+};
+
+Q_DECLARE_METATYPE(AdaptiveBitrateController::Rendition)
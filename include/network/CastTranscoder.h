@@ -0,0 +1,149 @@
+#pragma once
+
+#include "network/VideoCastingManager.h"
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <memory>
+
+class QTcpServer;
+class QTcpSocket;
+class QTemporaryDir;
+class QTimer;
+enum class HardwareAccelerationType;
+
+/**
+ * @brief What a cast target can decode
+ *
+ * Codec and container names are FFmpeg's (h264, hevc, aac, ac3, mp4,
+ * matroska, mpegts). Derived from the device type and the DLNA
+ * protocolInfo entries or codec names in CastingDevice::capabilities,
+ * with conservative defaults where a device says nothing.
+ */
+struct CastProfile
+{
+    QStringList videoCodecs;
+    QStringList audioCodecs;
+    QStringList containers;
+    int maxHeight = 1080;
+    bool playsHls = false;          // Takes an HLS playlist, else a continuous MPEG-TS stream
+
+    static CastProfile forDevice(const VideoCastingManager::CastingDevice& device);
+};
+
+/**
+ * @brief Live remux/transcode server for casting
+ *
+ * start() probes the media with ffprobe. Media the profile plays as is
+ * is cast directly; otherwise FFmpeg copies the compatible streams and
+ * re-encodes only the others (video to H.264 on the hardware encoder of
+ * the chosen acceleration backend, audio to AC-3 or AAC, default or
+ * forced ASS/PGS subtitles burned in), writing fixed-length MPEG-TS
+ * segments to a temporary directory.
+ *
+ * The segments are served over HTTP as a VOD HLS playlist, or for DLNA
+ * renderers as one MPEG-TS stream with DLNA time seeking. Casting starts
+ * as soon as the first segment is written. A request for a segment well
+ * ahead of or behind the running encode restarts FFmpeg there, so
+ * seeking costs one segment, not a re-encode of everything before it.
+ *
+ * One session at a time; everything runs on the owner's thread.
+ */
+class CastTranscoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CastTranscoder(QObject* parent = nullptr);
+    ~CastTranscoder() override;
+
+    /**
+     * @brief Encoder backend for re-encoded video; Auto picks the platform's
+     */
+    void setAcceleration(HardwareAccelerationType type);
+    HardwareAccelerationType acceleration() const { return m_acceleration; }
+
+    /**
+     * @brief Start serving media for a device, replacing any previous session
+     * @param host Local address the device reaches this machine on
+     * @return URL to hand the device, or an empty URL when the media can be
+     *         cast as is or cannot be transcoded
+     */
+    QUrl start(const QUrl& mediaUrl, const CastProfile& profile, const QString& host);
+
+    /**
+     * @brief Stop FFmpeg, drop clients and delete the segments
+     */
+    void stop();
+
+    bool isActive() const { return m_session != nullptr; }
+
+    static constexpr int SEGMENT_SECONDS = 4;
+
+signals:
+    /**
+     * @brief FFmpeg failed and no software fallback is left
+     */
+    void transcodeFailed(const QString& error);
+
+private slots:
+    void onNewConnection();
+    void onEncoderFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void servePending();
+
+private:
+    struct Stream;
+    struct MediaInfo;
+    struct Session;
+
+    struct Client {
+        QPointer<QTcpSocket> socket;
+        int segment = 0;            // Next segment to send
+        bool stream = false;        // Continuous MPEG-TS rather than one HLS segment
+        QElapsedTimer waiting;      // Since the last segment was sent
+    };
+
+    static bool probe(const QString& input, MediaInfo* info);
+
+    /**
+     * @brief Decide what to copy, encode and burn in
+     * @return false if the device plays the media as is
+     */
+    static bool buildPlan(Session& session, const MediaInfo& info, const CastProfile& profile, bool local);
+
+    void handleRequest(QTcpSocket* socket);
+    void sendPlaylist(QTcpSocket* socket, bool headOnly);
+    void sendStreamHead(QTcpSocket* socket, double startSeconds, bool timeSeek);
+    static void sendError(QTcpSocket* socket, int status, const QByteArray& reason);
+
+    /**
+     * @brief Make sure the running encode will produce a segment, restarting it if not
+     */
+    void requireSegment(int segment);
+    void startEncoder(int firstSegment);
+    QString segmentPath(int segment) const;
+    bool segmentReady(int segment) const;
+    int segmentCount() const;
+    void pruneSegments();
+
+    HardwareAccelerationType m_acceleration;
+    QTcpServer* m_server;
+    QTimer* m_pollTimer;
+    std::unique_ptr<Session> m_session;
+    QList<Client> m_clients;
+
+    // A segment request past the encode by more than this restarts FFmpeg
+    static constexpr int SEEK_AHEAD_SEGMENTS = 3;
+    // Segments kept behind the earliest one still wanted by a client
+    static constexpr int KEEP_BEHIND_SEGMENTS = 30;
+    static constexpr int POLL_INTERVAL_MS = 100;
+    static constexpr int SEGMENT_WAIT_TIMEOUT_MS = 30000;
+    static constexpr int PROBE_TIMEOUT_MS = 10000;
+    static constexpr qint64 STREAM_BACKLOG_BYTES = 4 * 1024 * 1024;
+    static constexpr int MAX_REQUEST_HEAD_BYTES = 16 * 1024;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <QObject>
+#include <QHostAddress>
+#include <QMutex>
+#include <QVector>
+
+class QTimer;
+class QUdpSocket;
+
+/**
+ * @brief NTP-style clock offset estimation between sync group peers
+ *
+ * Group time is the steady clock of the group's reference peer. Every peer
+ * answers time requests on its UDP port; a follower polls the reference
+ * and, for each exchange, gets the four timestamps of request sent (t1),
+ * received (t2), reply sent (t3) and reply received (t4). With symmetric
+ * paths the offset is ((t2 - t1) + (t3 - t4)) / 2 and the error is at most
+ * half the round trip less the time the reference held the request.
+ *
+ * Queueing delay only ever makes a round trip longer, so of the recent
+ * exchanges the one with the shortest round trip is the most accurate. The
+ * offset is taken from it, and the drift of the two oscillators from a
+ * least-squares fit over the exchanges whose round trip is close to the
+ * shortest, which carries the offset forward between polls. On a quiet LAN
+ * round trips are a few hundred microseconds, so the offset is good to
+ * about 100 us.
+ *
+ * Timestamps are taken in the socket's readyRead handler, so for the best
+ * accuracy move the object to a thread of its own: call start() and
+ * followReference() through QMetaObject::invokeMethod. The conversions are
+ * safe from any thread.
+ */
+class ClockSync : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr quint16 DEFAULT_PORT = 8082;
+    static constexpr int POLL_INTERVAL_MS = 250;
+    static constexpr int FAST_POLL_INTERVAL_MS = 20;    // Until the first estimate
+    static constexpr int WINDOW = 32;                   // Exchanges kept for the estimate
+    static constexpr int MIN_SAMPLES = 4;
+    static constexpr qint64 MAX_ROUND_TRIP_NS = 20000000;
+
+    explicit ClockSync(QObject* parent = nullptr);
+    ~ClockSync() override;
+
+    /**
+     * @brief Get the local steady clock, in nanoseconds
+     *
+     * The same clock as std::chrono::steady_clock, which AudioDSPGraph uses
+     * for its render timestamps.
+     */
+    static qint64 localTimeNs();
+
+    /**
+     * @brief Convert between local and group time
+     *
+     * Identity on the reference, and before the first estimate.
+     */
+    qint64 toGroupTime(qint64 localNs) const;
+    qint64 toLocalTime(qint64 groupNs) const;
+    qint64 groupTimeNs() const { return toGroupTime(localTimeNs()); }
+
+    /**
+     * @brief Check whether group time can be trusted
+     * @return true on the reference, or with enough recent exchanges
+     */
+    bool isLocked() const;
+    bool isReference() const;
+
+    /**
+     * @brief Get the current estimate
+     */
+    qint64 offsetNs() const;
+    qint64 roundTripNs() const;
+    double driftPpm() const;
+
+public slots:
+    /**
+     * @brief Answer time requests and receive replies on a port
+     * @return false if the port could not be bound
+     */
+    bool start(quint16 port = DEFAULT_PORT);
+    void stop();
+
+    /**
+     * @brief Poll a reference peer, or become the reference
+     * @param reference Reference address; a null address makes this peer
+     *        the reference
+     * @param port Reference's port
+     */
+    void followReference(const QHostAddress& reference, quint16 port = DEFAULT_PORT);
+
+signals:
+    void lockChanged(bool locked);
+
+private slots:
+    void readPendingDatagrams();
+    void poll();
+
+private:
+    struct Exchange {
+        qint64 localNs;         // t4
+        qint64 offsetNs;
+        qint64 roundTripNs;
+    };
+
+    struct Estimate {
+        qint64 offsetNs = 0;
+        qint64 anchorNs = 0;    // Local time the offset applies at
+        double drift = 0.0;     // Offset change per local nanosecond
+        qint64 roundTripNs = 0;
+        bool locked = false;
+    };
+
+    void addExchange(const Exchange& exchange);
+    void updateLock(bool locked);
+
+    QUdpSocket* m_socket;
+    QTimer* m_pollTimer;
+    QHostAddress m_reference;
+    quint16 m_referencePort;
+    quint32 m_sequence;
+    QVector<Exchange> m_exchanges;
+
+    mutable QMutex m_estimateMutex;
+    Estimate m_estimate;
+    bool m_isReference;
+    bool m_reportedLock;
+};
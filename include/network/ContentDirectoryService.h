@@ -0,0 +1,124 @@
+#pragma once
+
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+
+namespace EonPlay {
+namespace Data {
+class DatabaseManager;
+}
+}
+
+/**
+ * @brief UPnP ContentDirectory over the media library
+ *
+ * Lets DLNA clients such as TVs browse the library by artist, album and
+ * genre instead of walking share directories. Browse and Search become
+ * paged queries on the database's reader connections: container listings
+ * and child counts come from library_aggregates, and track listings walk
+ * the browse indexes, so StartingIndex/RequestedCount pages cost the same
+ * anywhere in a 100k-track library. Pages served recently are kept until
+ * the library changes, as clients re-request them while scrolling back.
+ *
+ * Media and album art are served by MediaShareServer under /upnp/; art is
+ * the pre-scaled CoverArtStore thumbnail, never the full cover.
+ *
+ * All methods are safe to call from MediaShareServer's worker threads.
+ */
+class ContentDirectoryService
+{
+public:
+    static constexpr const char* DEVICE_TYPE = "urn:schemas-upnp-org:device:MediaServer:1";
+    static constexpr const char* CONTENT_DIRECTORY_TYPE = "urn:schemas-upnp-org:service:ContentDirectory:1";
+    static constexpr const char* CONNECTION_MANAGER_TYPE = "urn:schemas-upnp-org:service:ConnectionManager:1";
+
+    // Bounding square of album art offered to clients (DLNA JPEG_TN)
+    static constexpr int ALBUM_ART_SIZE = 160;
+
+    struct Response {
+        int status = 200;
+        QByteArray body;            // SOAP envelope, or a fault for status 500
+    };
+
+    ContentDirectoryService(EonPlay::Data::DatabaseManager* dbManager, const QString& friendlyName);
+
+    /**
+     * @brief Unique device name, stable across restarts of the same machine
+     */
+    QString udn() const { return m_udn; }
+    QString friendlyName() const { return m_friendlyName; }
+
+    /**
+     * @brief Root device description served at /upnp/description.xml
+     * @param baseUrl e.g. http://192.168.1.10:8080, the address the client used
+     */
+    QByteArray deviceDescription(const QString& baseUrl) const;
+    static QByteArray contentDirectoryDescription();
+    static QByteArray connectionManagerDescription();
+
+    /**
+     * @brief Answer a SOAP control request
+     * @param serviceType CONTENT_DIRECTORY_TYPE or CONNECTION_MANAGER_TYPE
+     * @param soapAction SOAPACTION header, e.g. "urn:...:ContentDirectory:1#Browse"
+     */
+    Response control(const QString& serviceType, const QByteArray& soapAction, const QByteArray& body,
+                     const QString& baseUrl);
+
+    /**
+     * @brief Local file of a library item, empty if there is none
+     */
+    QString mediaPath(int id) const;
+
+    /**
+     * @brief Album art thumbnail of a library item, empty if it has none
+     */
+    QString albumArtPath(int id) const;
+
+    /**
+     * @brief Drop cached pages and bump SystemUpdateID, so clients refetch
+     */
+    void notifyLibraryChanged();
+    quint32 systemUpdateId() const { return m_systemUpdateId; }
+
+private:
+    struct ObjectRef;
+
+    struct Page {
+        QByteArray result;          // DIDL-Lite document
+        int returned = 0;
+        int total = 0;
+        int error = 0;              // UPnP error code, 0 on success
+    };
+
+    Response browse(const QHash<QString, QString>& arguments, const QString& baseUrl);
+    Response search(const QHash<QString, QString>& arguments, const QString& baseUrl);
+    Response pageResponse(const char* action, const Page& page) const;
+
+    Page browseMetadata(const ObjectRef& object, const QString& objectId, const QString& baseUrl) const;
+    Page browseChildren(const ObjectRef& object, const QString& objectId, int start, int count,
+                        const QString& baseUrl) const;
+    Page searchTracks(const QStringList& words, const QStringList& genres, int start, int count,
+                      const QString& baseUrl) const;
+
+    /**
+     * @brief Serve a page from the cache, or build it and cache it on success
+     */
+    template <typename Builder>
+    Page cachedPage(const QString& key, Builder&& build);
+
+    EonPlay::Data::DatabaseManager* m_dbManager;
+    QString m_friendlyName;
+    QString m_udn;
+    std::atomic<quint32> m_systemUpdateId{1};
+
+    QMutex m_cacheMutex;
+    QCache<QString, Page> m_pageCache;
+
+    static constexpr int PAGE_CACHE_SIZE = 256;
+    static constexpr int MAX_REQUESTED_COUNT = 500;     // Per page when a client asks for "all" (0)
+};
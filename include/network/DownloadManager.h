@@ -0,0 +1,200 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <list>
+#include <map>
+#include <memory>
+
+class QFile;
+class QNetworkReply;
+class QTimer;
+
+/**
+ * @brief Segmented, resumable HTTP downloads
+ *
+ * The first request asks for bytes=0-. If the server answers 206 and the
+ * file is large enough, it is split into connectionsPerDownload() ranges
+ * fetched in parallel; whenever a range completes, the largest remaining
+ * one is halved so every connection stays busy to the end. Data is written
+ * in place into a file preallocated to the full size, <file>.download until
+ * it is complete.
+ *
+ * Range progress is kept in <file>.download.json and unfinished downloads
+ * are listed in the state directory, so after a restart they come back
+ * paused and resume() continues where they stopped. Resumed ranges carry
+ * If-Range with the ETag or Last-Modified of the original answer; if the
+ * file changed on the server the download starts over.
+ *
+ * bandwidthLimit() caps all downloads together. Replies then have a bounded
+ * read buffer and are drained on a timer, so TCP flow control slows the
+ * servers down instead of data piling up in memory.
+ */
+class DownloadManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class State {
+        Queued,
+        Running,
+        Paused,
+        Finished,
+        Failed
+    };
+
+    explicit DownloadManager(const QString& stateDirectory = defaultDirectory(), QObject* parent = nullptr);
+    ~DownloadManager() override;
+
+    /**
+     * @brief Get the default state directory
+     */
+    static QString defaultDirectory();
+
+    /**
+     * @brief Queue a download
+     *
+     * An unfinished download of the same URL to the same file continues from
+     * its partial data. Adding a known id resumes it.
+     *
+     * @param id Key for signals and control, the URL if empty
+     * @return The id
+     */
+    QString addDownload(const QUrl& url, const QString& filePath, const QString& id = QString());
+
+    void pause(const QString& id);
+    void resume(const QString& id);
+
+    /**
+     * @brief Stop and delete the partial data
+     */
+    void cancel(const QString& id);
+
+    QStringList downloads() const;
+    State state(const QString& id) const;
+    qint64 bytesReceived(const QString& id) const;
+    qint64 bytesTotal(const QString& id) const;
+    int activeDownloadCount() const;
+
+    void setMaxConcurrentDownloads(int downloads);
+    int maxConcurrentDownloads() const { return m_maxConcurrent; }
+
+    void setConnectionsPerDownload(int connections);
+    int connectionsPerDownload() const { return m_connectionsPerDownload; }
+
+    /**
+     * @brief Cap the combined download rate
+     * @param bytesPerSecond 0 for no limit
+     */
+    void setBandwidthLimit(qint64 bytesPerSecond);
+    qint64 bandwidthLimit() const { return m_bandwidthLimit; }
+
+    void setUserAgent(const QString& userAgent);
+
+signals:
+    void downloadProgress(const QString& id, qint64 bytesReceived, qint64 bytesTotal);
+    void downloadFinished(const QString& id, const QString& filePath);
+    void downloadFailed(const QString& id, const QString& error);
+
+    /**
+     * @brief Emitted for every chunk written, for checking data as it arrives
+     *
+     * In file order with one connection per download. An offset before
+     * earlier ones means the download started over.
+     */
+    void dataWritten(const QString& id, qint64 offset, const QByteArray& data);
+
+private slots:
+    void onMetaDataChanged();
+    void onReadyRead();
+    void onPartFinished();
+    void onThrottleTick();
+
+private:
+    struct Part {
+        qint64 start = 0;
+        qint64 end = -1;            // Inclusive, -1 until the size is known
+        qint64 written = 0;
+        QNetworkReply* reply = nullptr;
+        bool probe = false;         // First request, may still be split
+
+        qint64 remaining() const { return end < 0 ? -1 : end - start - written + 1; }
+        bool isComplete() const { return end >= 0 && remaining() <= 0; }
+    };
+
+    struct Download {
+        QString id;
+        QUrl url;
+        QString filePath;
+        State state = State::Queued;
+        qint64 total = -1;
+        QByteArray validator;       // For If-Range
+        std::list<Part> parts;      // Stable addresses while ranges are split
+        std::unique_ptr<QFile> file;
+        int failures = 0;
+        QElapsedTimer lastProgress;
+        QElapsedTimer lastSave;
+    };
+
+    Download* downloadFor(QNetworkReply* reply, Part** part);
+    void schedule();
+    void start(Download& download);
+    void requestPart(Download& download, Part& part);
+    void stopParts(Download& download);
+    void restart(Download& download, QNetworkReply* reply, qint64 total);
+
+    /**
+     * @brief Keep connectionsPerDownload() ranges running, splitting the largest
+     */
+    void fillConnections(Download& download);
+    bool split(Download& download);
+
+    /**
+     * @brief Write buffered reply data into the file
+     * @param budget Bytes to take at most, -1 for all
+     * @return Bytes taken
+     */
+    qint64 drain(Download& download, Part& part, qint64 budget);
+    void completePart(Download& download, Part& part);
+    void checkFinished(Download& download);
+    void fail(Download& download, const QString& error);
+    void reportProgress(Download& download, bool force);
+    static qint64 received(const Download& download);
+    static QByteArray validatorOf(QNetworkReply* reply);
+    void updateThrottle();
+
+    // Persistence
+    static QString partialPath(const Download& download);
+    static QString statePath(const Download& download);
+    void saveDownloadState(Download& download);
+    void loadDownloadState(Download& download);
+    void saveIndex() const;
+    void loadIndex();
+
+    QString m_stateDirectory;
+    QByteArray m_userAgent;
+    std::map<QString, std::unique_ptr<Download>> m_downloads;
+    QStringList m_order;                        // In queue order
+    QHash<QNetworkReply*, QString> m_replies;   // To download id
+    int m_maxConcurrent;
+    int m_connectionsPerDownload;
+    qint64 m_bandwidthLimit = 0;
+    QTimer* m_throttleTimer;
+    QElapsedTimer m_throttleClock;
+
+    static constexpr int DEFAULT_MAX_CONCURRENT = 3;
+    static constexpr int DEFAULT_CONNECTIONS = 4;
+    static constexpr qint64 MIN_PART_BYTES = 1024 * 1024;
+    static constexpr qint64 READ_BUFFER_BYTES = 256 * 1024;
+    static constexpr int THROTTLE_INTERVAL_MS = 50;
+    static constexpr int PROGRESS_INTERVAL_MS = 250;
+    static constexpr int SAVE_INTERVAL_MS = 2000;
+    static constexpr int MAX_RETRIES = 3;
+    static constexpr int RETRY_DELAY_MS = 2000;
+};
@@ -157,7 +157,8 @@ public:
      * @brief Get YouTube video stream URL
      * @param videoId YouTube video ID
      * @param quality Preferred quality
-     * @return Stream URL
+     * @return Resolved stream URL if cached, otherwise the page URL while
+     *         streamUrlResolved() follows
      */
     QUrl getYouTubeStreamUrl(const QString& videoId, StreamQuality quality = Best_Available);
 
@@ -174,7 +175,8 @@ public:
      * @brief Get Twitch stream URL
      * @param channelName Twitch channel name
      * @param quality Preferred quality
-     * @return Stream URL
+     * @return Resolved stream URL if cached, otherwise the page URL while
+     *         streamUrlResolved() follows
      */
     QUrl getTwitchStreamUrl(const QString& channelName, StreamQuality quality = Best_Available);
 
@@ -282,6 +284,13 @@ signals:
      */
     void twitchSearchCompleted(const QVector<InternetStream>& results);
 
+    /**
+     * @brief Emitted when a requested stream URL has been resolved
+     * @param id Video ID or channel name
+     * @param streamUrl Playable stream URL
+     */
+    void streamUrlResolved(const QString& id, const QUrl& streamUrl);
+
     /**
      * @brief Emitted when radio station search completes
      * @param results Search results
@@ -326,6 +335,9 @@ private:
     void finalizeRecording();
 
     // Helper methods
+    QUrl resolveStreamUrl(const QUrl& pageUrl, StreamQuality quality, const QString& id);
+    void prefetchStreamUrls(const QVector<InternetStream>& results);
+    static QString resolverFormat(StreamQuality quality);
     QString extractYouTubeVideoId(const QUrl& url);
     QUrl buildYouTubeApiUrl(const QString& query, int maxResults);
     QUrl buildTwitchApiUrl(const QString& query, const QString& category);
@@ -3,12 +3,18 @@
 #include <QObject>
 #include <QString>
 #include <QUrl>
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QTimer>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QSet>
 #include <memory>
+#include "network/RecordingSink.h"
+
+class DownloadManager;
+class RadioDirectory;
+class RadioStationProber;
+class TimeshiftRing;
 
 /**
  * @brief Manages internet streaming services integration
@@ -61,6 +67,7 @@ public:
         QString name;
         QString url;
         QString genre;
+        QString country;
         QString description;
         QString website;
         int bitrate = 0;
@@ -113,8 +120,21 @@ public:
     QList<RadioStation> getRadioStations() const;
     bool getRadioStationInfo(const QString& stationUrl);
     QStringList getRadioGenres() const;
+
+    /**
+     * @brief Get the cached liveness of a station
+     *
+     * Answers at once; a stale or missing result queues a probe and
+     * radioStationStatusChanged() follows.
+     */
     bool isRadioStationOnline(const QString& stationUrl) const;
 
+    /**
+     * @brief Check stations in the background, e.g. the ones on screen
+     */
+    void probeRadioStations(const QStringList& stationUrls);
+    RadioDirectory* radioDirectory() const { return m_radioDirectory; }
+
     // Podcast support
     bool loadPodcastFeed(const QString& feedUrl);
     PodcastFeed getCurrentPodcastFeed() const;
@@ -123,12 +143,30 @@ public:
     bool downloadPodcastEpisode(const PodcastEpisode& episode, const QString& downloadPath);
 
     // Stream recording
-    bool startRecording(const QString& streamUrl, const QString& outputPath);
+    /**
+     * @brief Record a stream to a file
+     *
+     * A stream being timeshifted by a NetworkStreamManager is copied out of
+     * its ring instead of being fetched again, starting fromMsAgo behind the
+     * live edge as far as the ring reaches back. Other streams are recorded
+     * from now on.
+     *
+     * @param fromMsAgo Stream time before now to start at, 0 for now
+     */
+    bool startRecording(const QString& streamUrl, const QString& outputPath, qint64 fromMsAgo = 0);
     void stopRecording();
     bool isRecording() const;
     qint64 getRecordingDuration() const;
     qint64 getRecordingFileSize() const;
 
+    /**
+     * @brief Split future recordings into numbered segments
+     * @param maxBytes Segment size limit, 0 for none
+     * @param maxDurationMs Segment duration limit, 0 for none
+     * @param keepSegments Segments to keep, older ones are deleted; 0 keeps all
+     */
+    void setRecordingRotation(qint64 maxBytes, qint64 maxDurationMs, int keepSegments = 0);
+
     // General stream utilities
     ServiceType detectServiceType(const QUrl& url) const;
     bool isValidStreamUrl(const QUrl& url) const;
@@ -147,6 +185,7 @@ signals:
     void twitchStreamInfoReceived(const StreamInfo& info);
     void radioStationsLoaded(const QList<RadioStation>& stations);
     void radioStationInfoReceived(const RadioStation& station);
+    void radioStationStatusChanged(const QString& stationUrl, bool online);
     void podcastFeedLoaded(const PodcastFeed& feed);
     void podcastSearchCompleted(const QList<PodcastFeed>& results);
     void podcastDownloadProgress(const QString& episodeId, int percentage);
@@ -160,7 +199,6 @@ private slots:
     void onNetworkReplyFinished();
     void onNetworkReplyError(QNetworkReply::NetworkError error);
     void onRecordingTimerTimeout();
-    void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
 
 private:
     // YouTube API helpers
@@ -183,22 +221,25 @@ private:
     QList<RadioStation> parseIcecastDirectory(const QString& json) const;
 
     // Podcast helpers
-    void processPodcastFeedResponse(const QString& response);
+    void processPodcastFeedResponse(const QByteArray& response);
     void processPodcastSearchResponse(const QJsonObject& response);
-    PodcastFeed parseRSSFeed(const QString& xml) const;
+    PodcastFeed parseRSSFeed(const QByteArray& xml) const;
     QList<PodcastEpisode> parseRSSEpisodes(const QString& xml) const;
 
     // Recording helpers
     void setupRecording(const QString& streamUrl, const QString& outputPath);
     void updateRecordingStats();
 
+    /**
+     * @brief Hand what the ring gained since the last call to the sink, a chunk at a time
+     */
+    void copyFromRing();
+
     // Network utilities
     void makeApiRequest(const QUrl& url, const QString& requestId = QString());
-    void setupNetworkManager();
     QNetworkRequest createApiRequest(const QUrl& url) const;
 
     // Member variables
-    std::unique_ptr<QNetworkAccessManager> m_networkManager;
     QMap<QNetworkReply*, QString> m_pendingRequests;
     
     // Service data
@@ -220,9 +261,19 @@ private:
     QTimer* m_recordingTimer;
     qint64 m_recordingStartTime;
     QNetworkReply* m_recordingReply;
+    RecordingSink* m_recordingSink;
+    RecordingSink::Rotation m_recordingRotation;
+    std::shared_ptr<TimeshiftRing> m_recordingRing;     // Set when recording out of a timeshift ring
+    qint64 m_recordingRingOffset;
+    bool m_ringCopyScheduled;
     
     // Download management
-    QMap<QString, QNetworkReply*> m_activeDownloads;
+    DownloadManager* m_downloadManager;
+
+    // Radio directory and liveness
+    RadioDirectory* m_radioDirectory;
+    RadioStationProber* m_radioProber;
+    QSet<QString> m_radioInfoRequests;
     
     // Constants
     static const QString YOUTUBE_API_BASE_URL;
@@ -231,4 +282,5 @@ private:
     static const QString ICECAST_API_BASE_URL;
     static const int DEFAULT_MAX_DOWNLOADS = 3;
     static const int RECORDING_UPDATE_INTERVAL_MS = 1000;
+    static constexpr qint64 RING_COPY_CHUNK_BYTES = 4 * 1024 * 1024;
 };
\ No newline at end of file
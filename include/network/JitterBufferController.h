@@ -0,0 +1,101 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QUrl>
+
+/**
+ * @brief Sizes libVLC's network caching per host from measured jitter and stalls
+ *
+ * libVLC reads network-caching once per media, so the depth is chosen when
+ * a stream opens: the host's remembered profile, or a start-up default that
+ * is short for live streams, so radio and cameras start fast on a link
+ * that has not misbehaved yet.
+ *
+ * While a stream plays, its arrival samples feed a jitter estimate in the
+ * manner of RFC 3550: how far each interval's data ran ahead of or behind
+ * the stream's mean rate, smoothed by 1/16. Each stall raises the depth by
+ * STALL_GROWTH, to no less than JITTER_MARGIN times the jitter; every
+ * STABLE_PERIOD_MS without one lowers it by STABLE_DECAY towards that same
+ * floor. The outcome is kept per host, in memory and in QSettings, for the
+ * next open. Live streams are reopened after a stall with the deeper cache,
+ * as their playhead has nothing to lose.
+ *
+ * Streams are identified by an opaque handle so one host can have several
+ * at once, each with its own estimate. Thread-safe; libVLC reports from its
+ * own threads.
+ */
+class JitterBufferController
+{
+public:
+    struct HostProfile {
+        int cachingMs = 0;
+        double jitterMs = 0.0;
+        int stalls = 0;             // Over every stream from the host
+        qint64 updated = 0;         // Milliseconds since the epoch
+    };
+
+    static JitterBufferController& instance();
+
+    /**
+     * @brief Caching depth to open a stream from a URL with
+     */
+    int cachingFor(const QUrl& url, bool live) const;
+
+    /**
+     * @brief Start measuring a stream
+     * @param stream Handle identifying the stream until closeStream()
+     */
+    void openStream(const void* stream, const QUrl& url, bool live);
+
+    /**
+     * @brief Add what arrived for a stream in one interval
+     */
+    void addArrivalSample(const void* stream, qint64 bytes, qint64 intervalMs);
+
+    /**
+     * @brief Report that a stream ran dry and rebuffers
+     * @return true if the stream is live and should be reopened with the deeper cache
+     */
+    bool reportStall(const void* stream);
+
+    /**
+     * @brief Stop measuring a stream and remember its host's profile
+     */
+    void closeStream(const void* stream);
+
+    HostProfile profile(const QUrl& url) const;
+
+    static constexpr int DEFAULT_CACHING_MS = 3000;
+    static constexpr int DEFAULT_LIVE_CACHING_MS = 1000;
+    static constexpr int MIN_CACHING_MS = 300;
+    static constexpr int MAX_CACHING_MS = 10000;
+    static constexpr double STALL_GROWTH = 1.5;
+    static constexpr double STABLE_DECAY = 0.85;
+    static constexpr double JITTER_MARGIN = 4.0;
+    static constexpr qint64 STABLE_PERIOD_MS = 60000;
+    static constexpr int MAX_PROFILES = 200;
+
+private:
+    struct Stream {
+        QString host;
+        bool live = false;
+        int openedCachingMs = 0;    // What libVLC is using
+        int cachingMs = 0;          // What the next open should use
+        double meanRate = 0.0;      // Bytes per millisecond
+        double jitterMs = 0.0;
+        int stalls = 0;
+        qint64 stableSince = 0;
+    };
+
+    JitterBufferController();
+
+    static QString hostKey(const QUrl& url);
+    int floorFor(const Stream& stream) const;
+    void loadProfiles();
+
+    mutable QMutex m_mutex;
+    QHash<const void*, Stream> m_streams;
+    QHash<QString, HostProfile> m_profiles;
+};
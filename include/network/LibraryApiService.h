@@ -0,0 +1,102 @@
+#pragma once
+
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QUrlQuery>
+#include <atomic>
+
+namespace EonPlay {
+namespace Data {
+class DatabaseManager;
+}
+}
+
+/**
+ * @brief Remote query API of a library server
+ *
+ * Lets other EonPlay instances use this machine's library without scanning
+ * it themselves: only the server owns the scan and the database, clients
+ * ask it for what they show. Requests are small JSON GETs under /api/v1/,
+ * served by MediaShareServer over its keep-alive connections:
+ *
+ *   info                         revision and library totals
+ *   search?q=&artist=&album=&genre=&sort=&order=&offset=&limit=
+ *   facets?facet=artist|album|genre|extension&offset=&limit=
+ *   playlists, playlists/<id>/items?offset=&limit=
+ *   progress?path=               watch progress; POST to save it
+ *   media/<id>                   the file itself, with byte ranges
+ *
+ * Every query is one page on the database's reader connections. Library
+ * responses carry the revision as their ETag and are cached until the
+ * library changes, so a client revalidating its own cache with
+ * If-None-Match gets a bodyless 304. Playlists and watch progress change
+ * without a rescan and are never cached.
+ *
+ * Requests must carry "Authorization: Bearer <token>", or "token=<token>"
+ * in the query for media players that cannot set headers. Tokens are
+ * compared in constant time, and without a token every request is refused.
+ *
+ * All methods are safe to call from MediaShareServer's worker threads.
+ */
+class LibraryApiService
+{
+public:
+    static constexpr int API_VERSION = 1;
+    static constexpr int DEFAULT_PAGE_SIZE = 100;
+    static constexpr int MAX_PAGE_SIZE = 500;
+
+    struct Response {
+        int status = 200;
+        QByteArray body;            // JSON, with an "error" member unless status is 2xx or 304
+        QByteArray etag;            // Empty if the response is not cacheable
+    };
+
+    explicit LibraryApiService(EonPlay::Data::DatabaseManager* dbManager, const QString& token = QString());
+
+    /**
+     * @brief Answer an API request
+     * @param path Decoded path, e.g. /api/v1/search
+     */
+    Response handle(const QByteArray& method, const QString& path, const QUrlQuery& query,
+                    const QHash<QByteArray, QByteArray>& headers, const QByteArray& body);
+
+    bool isAuthorized(const QHash<QByteArray, QByteArray>& headers, const QUrlQuery& query) const;
+
+    /**
+     * @brief Local file of a library item, empty if there is none
+     */
+    QString mediaPath(int id) const;
+
+    /**
+     * @brief Drop cached responses and bump the revision, so clients refetch
+     */
+    void notifyLibraryChanged();
+    quint64 revision() const { return m_revision; }
+
+private:
+    Response info();
+    Response search(const QUrlQuery& query);
+    Response facets(const QUrlQuery& query);
+    Response playlists(const QUrlQuery& query);
+    Response playlistItems(int playlistId, const QUrlQuery& query);
+    Response progress(const QUrlQuery& query);
+    Response saveProgress(const QByteArray& body);
+
+    /**
+     * @brief Serve a library response from the cache, or build it and cache it on success
+     */
+    template <typename Builder>
+    Response cachedResponse(const QString& key, Builder&& build);
+
+    EonPlay::Data::DatabaseManager* m_dbManager;
+    QByteArray m_token;
+    std::atomic<quint64> m_revision{1};
+
+    QMutex m_cacheMutex;
+    QCache<QString, Response> m_responseCache;
+
+    static constexpr int RESPONSE_CACHE_SIZE = 256;
+};
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <QObject>
+#include <QTcpServer>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+class ContentDirectoryService;
+class LibraryApiService;
+class QFile;
+class QTcpSocket;
+class QThread;
+class QTimer;
+
+class MediaShareServer;
+
+/**
+ * @brief One HTTP/1.1 client of the media share server
+ *
+ * Lives in a worker thread. Requests on a keep-alive connection are served
+ * one after another; a body is written in slices of a memory-mapped window
+ * of the file, and the next slice only once the socket's send buffer has
+ * drained below HIGH_WATER_BYTES, so a large file never sits in memory.
+ */
+class MediaShareConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    MediaShareConnection(MediaShareServer* server, qintptr socketDescriptor, bool rejected);
+    ~MediaShareConnection() override;
+
+public slots:
+    /**
+     * @brief Take over the socket, in the worker thread
+     */
+    void start();
+
+private slots:
+    void onReadyRead();
+    void onBytesWritten();
+    void onDisconnected();
+
+private:
+    struct ByteRange
+    {
+        qint64 start = 0;
+        qint64 length = 0;
+    };
+
+    enum class RangeResult {
+        None,           // No (usable) Range header, send everything
+        Satisfiable,
+        Unsatisfiable
+    };
+
+    /**
+     * @brief Handle buffered requests while no response body is in flight
+     */
+    void processRequests();
+
+    /**
+     * @brief Answer one complete request
+     * @return false if the connection is closing
+     */
+    bool handleRequest(const QByteArray& head, const QByteArray& body);
+
+    /**
+     * @brief Serve the UPnP MediaServer: descriptions, control and library media
+     */
+    void handleUpnpRequest(const QByteArray& method, const QString& path,
+                           const QHash<QByteArray, QByteArray>& headers, const QByteArray& body);
+
+    /**
+     * @brief Serve the remote library API and its media
+     */
+    void handleApiRequest(const QByteArray& method, const QString& path, const QByteArray& query,
+                          const QHash<QByteArray, QByteArray>& headers, const QByteArray& body);
+
+    void sendFile(const QString& shareId, const QString& localPath, const QByteArray& rangeHeader, bool headOnly,
+                  const QByteArray& extraHeaders = QByteArray());
+    void sendStatus(int status, const QByteArray& reason, const QByteArray& extraHeaders = QByteArray());
+    void sendBody(int status, const QByteArray& reason, const QByteArray& contentType, const QByteArray& body,
+                  bool headOnly, const QByteArray& extraHeaders = QByteArray());
+    void writeHead(int status, const QByteArray& reason, const QByteArray& headers);
+
+    /**
+     * @brief Write body slices until the send buffer is full or the body is done
+     */
+    void pump();
+
+    void finishResponse();
+    void releaseFile();
+    void close();
+
+    static QByteArray listingHtml(const QString& shareId);
+
+    /**
+     * @brief Base URL of this server as the client reached it
+     */
+    QString baseUrl() const;
+
+    /**
+     * @return Content-Length of a request head, 0 if absent, -1 if invalid
+     */
+    static qint64 contentLength(const QByteArray& head);
+
+    static RangeResult parseRange(const QByteArray& header, qint64 size, ByteRange& range);
+
+    MediaShareServer* m_server;
+    qintptr m_socketDescriptor;
+    bool m_rejected;
+
+    QTcpSocket* m_socket = nullptr;
+    QTimer* m_idleTimer = nullptr;
+    QByteArray m_input;
+    bool m_keepAlive = true;
+    bool m_closing = false;
+    int m_requestCount = 0;
+    QString m_peerAddress;
+    QString m_connectedShare;           // Reported by shareConnectionReceived()
+
+    // Body in flight
+    QFile* m_file = nullptr;
+    QString m_shareId;
+    qint64 m_offset = 0;
+    qint64 m_remaining = 0;
+    uchar* m_window = nullptr;
+    qint64 m_windowStart = 0;
+    qint64 m_windowSize = 0;
+    qint64 m_bytesSent = 0;
+
+    static constexpr int MAX_HEADER_BYTES = 16 * 1024;
+    static constexpr qint64 MAX_BODY_BYTES = 64 * 1024;         // SOAP and API requests are small
+    static constexpr qint64 WINDOW_BYTES = 4 * 1024 * 1024;
+    static constexpr qint64 SLICE_BYTES = 256 * 1024;
+    static constexpr qint64 HIGH_WATER_BYTES = 1024 * 1024;
+    static constexpr int KEEP_ALIVE_TIMEOUT_MS = 15000;
+    static constexpr int MAX_KEEP_ALIVE_REQUESTS = 1000;
+};
+
+/**
+ * @brief Range-aware HTTP server for NetworkDiscoveryManager media shares
+ *
+ * Accepted sockets are handed to a small pool of worker threads, so file
+ * I/O never runs on the GUI thread. GET and HEAD are supported, with single
+ * byte ranges (206/416) and keep-alive. Connections beyond
+ * setMaxConnections() are answered with 503.
+ *
+ * With a ContentDirectoryService set, /upnp/ also serves a UPnP
+ * MediaServer: its descriptions, SOAP control over POST, and library
+ * items and album art by id. With a LibraryApiService set, /api/ serves
+ * the remote library API to other EonPlay instances.
+ *
+ * Shares are set from the owner thread; everything else is internal.
+ */
+class MediaShareServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    explicit MediaShareServer(QObject* parent = nullptr);
+    ~MediaShareServer() override;
+
+    /**
+     * @brief Publish a share under /<shareId>/
+     */
+    void addShare(const QString& shareId, const QString& rootPath);
+    void removeShare(const QString& shareId);
+
+    /**
+     * @brief Serve the library as a UPnP MediaServer under /upnp/, or stop with nullptr
+     */
+    void setContentDirectory(std::shared_ptr<ContentDirectoryService> contentDirectory);
+    std::shared_ptr<ContentDirectoryService> contentDirectory() const;
+
+    /**
+     * @brief Serve the remote library API under /api/, or stop with nullptr
+     */
+    void setLibraryApi(std::shared_ptr<LibraryApiService> libraryApi);
+    std::shared_ptr<LibraryApiService> libraryApi() const;
+
+    /**
+     * @brief Limit concurrently served connections and size the worker pool
+     */
+    void setMaxConnections(int maxConnections);
+    int maxConnections() const { return m_maxConnections; }
+
+    int connectionCount() const { return m_connectionCount; }
+
+    /**
+     * @brief Stop listening and drop every connection
+     */
+    void shutdown();
+
+    /**
+     * @brief Map a request path onto a file inside an active share
+     * @param requestPath Decoded path, e.g. /share_1/Movies/a.mkv
+     * @param shareId Set to the matching share
+     * @param localPath Set to the canonical local path
+     * @return false if no share matches or the path escapes its root
+     */
+    bool resolve(const QString& requestPath, QString& shareId, QString& localPath) const;
+
+signals:
+    /**
+     * @brief Emitted from a worker thread on a connection's first request for a share
+     */
+    void shareConnectionReceived(const QString& shareId, const QString& clientAddress);
+
+    /**
+     * @brief Emitted from a worker thread when a response body ended
+     * @param bytes Body bytes sent, less than requested if the client went away
+     */
+    void requestServed(const QString& shareId, qint64 bytes);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    friend class MediaShareConnection;
+
+    void connectionFinished();
+    void startWorkers();
+    void stopWorkers();
+
+    mutable QMutex m_shareMutex;
+    QHash<QString, QString> m_shareRoots;   // Share id to canonical root
+    std::shared_ptr<ContentDirectoryService> m_contentDirectory;
+    std::shared_ptr<LibraryApiService> m_libraryApi;
+
+    QVector<QThread*> m_workers;
+    int m_nextWorker = 0;
+    int m_maxConnections;
+    std::atomic<int> m_connectionCount{0};
+
+    static constexpr int DEFAULT_MAX_CONNECTIONS = 10;
+};
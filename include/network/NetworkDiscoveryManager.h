@@ -3,18 +3,27 @@
 #include <QObject>
 #include <QString>
 #include <QUrl>
+#include <QSet>
 #include <QHostAddress>
 #include <QUdpSocket>
 #include <QTcpServer>
 #include <QTimer>
+#include "network/MediaShareServer.h"
 // Bluetooth includes temporarily disabled for build compatibility
 // #include <QBluetoothDeviceDiscoveryAgent>
 // #include <QBluetoothSocket>
 // #include <QBluetoothLocalDevice>
 #include <memory>
 
-class QNetworkAccessManager;
 class QXmlStreamReader;
+class ContentDirectoryService;
+class LibraryApiService;
+
+namespace EonPlay {
+namespace Data {
+class LibraryManager;
+}
+}
 
 /**
  * @brief Manages network device discovery and media sharing
@@ -111,6 +120,27 @@ public:
     QList<MediaShare> getActiveShares() const;
     MediaShare getMediaShare(const QString& shareId) const;
 
+    // Library as a DLNA/UPnP MediaServer
+    /**
+     * @brief Publish the library as a UPnP MediaServer on the media share port
+     * 
+     * Answers M-SEARCH and announces itself with NOTIFY, so TVs list the
+     * library next to other media servers and browse it by artist, album
+     * and genre through a ContentDirectoryService.
+     */
+    bool publishLibrary(EonPlay::Data::LibraryManager* library);
+    void unpublishLibrary();
+    bool isLibraryPublished() const { return m_contentDirectory != nullptr; }
+
+    // Library server for other EonPlay instances
+    /**
+     * @brief Serve the remote library API under /api/v1/ on the media share port
+     * @param token Bearer token clients must send; the API is not served without one
+     */
+    bool publishLibraryApi(EonPlay::Data::LibraryManager* library, const QString& token);
+    void unpublishLibraryApi();
+    bool isLibraryApiPublished() const { return m_libraryApi != nullptr; }
+
     // Bluetooth integration - temporarily disabled for build compatibility
     // void startBluetoothDiscovery();
     // void stopBluetoothDiscovery();
@@ -128,6 +158,12 @@ public:
     void syncPlayback(const QString& groupId, const QString& mediaUrl, qint64 position);
     void syncPlaybackState(const QString& groupId, bool isPlaying, qint64 position);
     QList<SyncGroup> getSyncGroups() const;
+    
+    // Opaque payloads for other components, sent to the group's online
+    // devices or to one of them; replies arrive through syncPayloadReceived(),
+    // which only carries frames from discovered members of the group
+    void sendSyncPayload(const QString& groupId, const QString& channel, const QByteArray& payload,
+                         const QString& deviceId = QString());
 
     // Network configuration
     void setDiscoveryInterval(int intervalMs);
@@ -155,13 +191,18 @@ signals:
     void syncGroupLeft(const QString& groupId);
     void syncPlaybackReceived(const QString& groupId, const QString& mediaUrl, qint64 position);
     void syncStateReceived(const QString& groupId, bool isPlaying, qint64 position);
+    void syncPayloadReceived(const QString& groupId, const QString& channel, const QString& senderDeviceId,
+                             const QByteArray& payload);
     void networkError(const QString& error);
 
 private slots:
     void onUdpSocketReadyRead();
     void onDiscoveryTimerTimeout();
     void onDeviceTimeoutTimerTimeout();
-    void onTcpServerNewConnection();
+    void onMediaShareConnectionReceived(const QString& shareId, const QString& clientAddress);
+    void onMediaShareRequestServed(const QString& shareId, qint64 bytes);
+    void onSsdpSocketReadyRead();
+    void onNotifySocketReadyRead();
     // Bluetooth slots - temporarily disabled
     // void onBluetoothDeviceDiscovered(const QBluetoothDeviceInfo& device);
     // void onBluetoothDiscoveryFinished();
@@ -173,7 +214,9 @@ private:
     // UPnP/DLNA discovery
     void sendUPnPSearchRequest();
     void processUPnPResponse(const QByteArray& data, const QHostAddress& sender);
-    void parseUPnPDevice(const QString& descriptionUrl);
+    void processSsdpNotify(const QByteArray& data);
+    void handleSsdpAlive(const QMap<QByteArray, QByteArray>& headers);
+    void parseUPnPDevice(const QString& descriptionUrl, const QString& udn);
     void parseDeviceDescription(const QByteArray& xml, NetworkDevice& device);
     
     // Device management
@@ -183,9 +226,14 @@ private:
     
     // Media sharing server
     void setupMediaShareServer();
-    void handleMediaShareRequest(QTcpSocket* socket);
-    void serveMediaFile(QTcpSocket* socket, const QString& filePath);
-    QString generateMediaShareResponse(const QString& shareId) const;
+    bool ensureMediaShareServer();
+    void shutdownMediaShareServerIfIdle();
+    
+    // MediaServer advertisement
+    void answerSsdpSearch(const QByteArray& data, const QHostAddress& sender, quint16 senderPort);
+    void sendSsdpNotify(const QByteArray& subType);
+    QList<QPair<QByteArray, QByteArray>> ssdpTargets() const;  // NT/ST with its USN
+    QByteArray ssdpLocation(const QHostAddress& peer) const;
     
     // Bluetooth helpers - temporarily disabled
     // void setupBluetoothDiscovery();
@@ -195,6 +243,9 @@ private:
     void setupSyncServer();
     void handleSyncMessage(const QByteArray& message, const QHostAddress& sender);
     void broadcastSyncMessage(const QString& groupId, const QByteArray& message);
+    void sendSyncFrame(const QHostAddress& address, const QByteArray& frame);
+    QByteArray createSyncFrame(const QString& groupId, const QString& channel, const QByteArray& payload) const;
+    QString deviceIdForAddress(const QHostAddress& address) const;
     
     // Network utilities
     void setupNetworkComponents();
@@ -203,9 +254,8 @@ private:
     
     // Member variables
     std::unique_ptr<QUdpSocket> m_udpSocket;
-    std::unique_ptr<QTcpServer> m_mediaShareServer;
+    std::unique_ptr<MediaShareServer> m_mediaShareServer;
     std::unique_ptr<QTcpServer> m_syncServer;
-    std::unique_ptr<QNetworkAccessManager> m_networkManager;
     
     // Discovery state
     DiscoveryState m_discoveryState;
@@ -217,12 +267,32 @@ private:
     QMap<QString, NetworkDevice> m_discoveredDevices;
     QMap<QString, qint64> m_deviceLastSeen;
     
+    // Fetched device descriptions by UDN, valid while the device's
+    // LOCATION, BOOTID and CONFIGID stay the same and its max-age lasts
+    struct CachedDescription {
+        QString location;
+        QByteArray bootId;
+        QByteArray configId;
+        qint64 expiresAt = 0;
+        QString deviceId;                    // Once the description arrived
+    };
+    QMap<QString, CachedDescription> m_descriptionCache;
+    QSet<QString> m_pendingDescriptions;     // Locations being fetched
+    std::unique_ptr<QUdpSocket> m_notifySocket;  // Other devices' NOTIFYs
+    
     // Media sharing
     QMap<QString, MediaShare> m_mediaShares;
-    QMap<QTcpSocket*, QString> m_activeConnections;
     int m_mediaSharePort;
     int m_maxConnections;
     
+    // Published library
+    std::shared_ptr<ContentDirectoryService> m_contentDirectory;
+    std::unique_ptr<QUdpSocket> m_ssdpSocket;
+    QTimer* m_ssdpAnnounceTimer;
+    QMetaObject::Connection m_libraryChangedConnection;
+    std::shared_ptr<LibraryApiService> m_libraryApi;
+    QMetaObject::Connection m_libraryApiChangedConnection;
+    
     // Bluetooth - temporarily disabled
     // std::unique_ptr<QBluetoothDeviceDiscoveryAgent> m_bluetoothDiscovery;
     // std::unique_ptr<QBluetoothLocalDevice> m_bluetoothDevice;
@@ -245,6 +315,9 @@ private:
     static const int DEFAULT_MEDIA_SHARE_PORT = 8080;
     static const int DEFAULT_SYNC_PORT = 8081;
     static const int DEFAULT_MAX_CONNECTIONS = 10;
+    static const int MAX_SYNC_FRAME_BYTES = 16 * 1024 * 1024;
     static const QString UPNP_MULTICAST_ADDRESS;
     static const int UPNP_MULTICAST_PORT = 1900;
+    static const int SSDP_MAX_AGE_S = 1800;
+    static const int SSDP_MAX_RESPONSE_DELAY_MS = 3000;
 };
\ No newline at end of file
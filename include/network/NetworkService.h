@@ -0,0 +1,164 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QString>
+#include <atomic>
+
+class QNetworkDiskCache;
+
+/**
+ * @brief Reply handed out for a request that NetworkService holds back
+ *
+ * Behaves like the reply it will become: signals, headers, attributes and
+ * data are forwarded once the request is sent. Aborting before then
+ * finishes it with OperationCanceledError without any network traffic.
+ */
+class ScheduledNetworkReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    ScheduledNetworkReply(QNetworkAccessManager::Operation operation, const QNetworkRequest& request,
+                          QObject* parent = nullptr);
+    ~ScheduledNetworkReply() override;
+
+    /**
+     * @brief Take over the reply of the sent request
+     */
+    void attach(QNetworkReply* reply);
+
+    bool isStarted() const { return m_reply != nullptr; }
+
+    void abort() override;
+    void ignoreSslErrors() override;
+    void setReadBufferSize(qint64 size) override;
+    qint64 bytesAvailable() const override;
+    bool isSequential() const override { return true; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+
+private:
+    void copyMetaData();
+    void onFinished();
+
+    QPointer<QNetworkReply> m_reply;
+    bool m_ignoreSslErrors = false;
+};
+
+/**
+ * @brief The application's one HTTP client
+ *
+ * Every component used to create its own QNetworkAccessManager, each with
+ * its own connection pool, DNS cache and HTTP cache. This service shares
+ * one manager, with HTTP/2, pipelining of idempotent background requests
+ * and a QNetworkDiskCache. On top of that it schedules by class:
+ *
+ * - Playback requests are sent at once and bypass the HTTP cache.
+ * - Metadata and Telemetry requests wait while any playback transfer is in
+ *   flight, Telemetry behind Metadata. Per host, no more than
+ *   maxConnectionsPerHost() of them run at once, which leaves connections
+ *   of Qt's per-host pool free for playback.
+ *
+ * A request that has to wait gets a ScheduledNetworkReply, so callers handle
+ * every reply the same way. Playback transfers running on other threads,
+ * with their own manager, report through beginPlaybackTransfer() and
+ * endPlaybackTransfer().
+ *
+ * Use from the main thread, except for the two transfer calls and
+ * configureRequest().
+ */
+class NetworkService : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class RequestClass {
+        Playback,       // Stream manifests, segments, recordings
+        Metadata,       // Lookups, artwork, feeds, subtitles
+        Telemetry       // Crash reports, update checks
+    };
+
+    static NetworkService& instance();
+
+    QNetworkReply* get(QNetworkRequest request, RequestClass requestClass);
+    QNetworkReply* head(QNetworkRequest request, RequestClass requestClass);
+    QNetworkReply* post(QNetworkRequest request, const QByteArray& data, RequestClass requestClass);
+
+    /**
+     * @brief Apply the attributes of a request class
+     *
+     * For requests sent through another manager. Thread-safe.
+     */
+    static void configureRequest(QNetworkRequest& request, RequestClass requestClass,
+                                 QNetworkAccessManager::Operation operation = QNetworkAccessManager::GetOperation);
+
+    /**
+     * @brief Report a playback transfer outside the shared manager. Thread-safe.
+     */
+    void beginPlaybackTransfer();
+    void endPlaybackTransfer();
+
+    /**
+     * @brief Count a reply as a playback transfer until it finishes or is deleted. Thread-safe.
+     */
+    void trackPlaybackTransfer(QNetworkReply* reply);
+
+    void setMaxConnectionsPerHost(int connections);
+    int maxConnectionsPerHost() const { return m_maxPerHost; }
+
+    int queuedRequestCount() const { return m_queue.size(); }
+
+    QNetworkAccessManager* networkManager();
+
+signals:
+    /**
+     * @brief Emitted when a held-back request is sent
+     */
+    void requestStarted(const QUrl& url, NetworkService::RequestClass requestClass);
+
+private:
+    struct PendingRequest {
+        QPointer<ScheduledNetworkReply> reply;
+        QNetworkAccessManager::Operation operation;
+        QNetworkRequest request;
+        QByteArray data;
+        RequestClass requestClass;
+    };
+
+    NetworkService();
+
+    QNetworkReply* submit(QNetworkAccessManager::Operation operation, QNetworkRequest request,
+                          const QByteArray& data, RequestClass requestClass);
+    QNetworkReply* send(QNetworkAccessManager::Operation operation, const QNetworkRequest& request,
+                        const QByteArray& data, RequestClass requestClass);
+    bool canSend(const QNetworkRequest& request, RequestClass requestClass) const;
+
+    /**
+     * @brief Send held-back requests that may go now, Metadata first
+     */
+    void dispatch();
+    void shutdown();
+
+    static QString hostKey(const QUrl& url);
+
+    QNetworkAccessManager* m_network = nullptr;
+    QNetworkDiskCache* m_diskCache = nullptr;
+    QList<PendingRequest> m_queue;          // Metadata before Telemetry, then by age
+    QHash<QString, int> m_backgroundPerHost;
+    std::atomic<int> m_playbackTransfers{0};
+    int m_maxPerHost;
+    bool m_shutDown = false;
+
+    static constexpr int DEFAULT_MAX_PER_HOST = 4;      // Qt opens six per host
+    static constexpr qint64 DISK_CACHE_BYTES = 64 * 1024 * 1024;
+};
+
+Q_DECLARE_METATYPE(NetworkService::RequestClass)
@@ -7,7 +7,14 @@
 #include <QNetworkReply>
 #include <QTimer>
 #include <QMutex>
+#include <QThread>
+#include <QVector>
 #include <memory>
+#include "network/AdaptiveBitrateController.h"
+#include "network/SegmentCache.h"
+#include "network/SegmentPrefetcher.h"
+#include "network/ShareReadAhead.h"
+#include "network/TimeshiftBuffer.h"
 
 class QNetworkProxy;
 
@@ -82,6 +89,67 @@ public:
     void stopBandwidthMonitoring();
     bool isBandwidthMonitoringActive() const;
 
+    // Adaptive bitrate (HLS/DASH)
+    AdaptiveBitrateController* adaptiveBitrate() const;
+    QVector<AdaptiveBitrateController::Rendition> availableRenditions() const;
+
+    /**
+     * @brief Report the media buffered ahead of the playhead, for rendition selection
+     * @param bufferMs Buffered media in milliseconds
+     */
+    void setBufferedDuration(qint64 bufferMs);
+
+    // Segment prefetch and cache (HLS/DASH)
+    /**
+     * @brief Get the URL to hand to libVLC for the current stream
+     *
+     * HLS and DASH streams play through the segment gateway, so prefetched
+     * and already watched segments come from the disk cache.
+     */
+    QUrl playbackUrl() const;
+    void setPlaybackPosition(qint64 positionMs);
+    void setPrefetchDepth(int segments);
+    void setSegmentCacheSize(qint64 bytes);
+    qint64 segmentCacheSize() const;
+    void clearSegmentCache();
+
+    // Timeshift (live HTTP and HLS)
+    /**
+     * @brief Keep the last stretch of live streams for pause, rewind and catch-up
+     *
+     * Applies to streams opened afterwards. playbackUrl() then plays HTTP
+     * and HLS streams through a TimeshiftBuffer, which captures them while
+     * they are live and hands anything else back to the direct URL.
+     *
+     * @param durationMs Stream time kept behind the live edge, 0 to play live streams directly
+     */
+    void setTimeshiftDuration(qint64 durationMs);
+    qint64 timeshiftDuration() const;
+    void setTimeshiftMaxBytes(qint64 bytes);
+
+    /**
+     * @brief Check whether the current stream is live and being captured
+     */
+    bool isTimeshiftActive() const;
+
+    /**
+     * @brief Get how far back the current stream can be rewound
+     */
+    qint64 timeshiftAvailableMs() const;
+
+    /**
+     * @brief Get how far playback trails the live edge
+     */
+    qint64 timeshiftBehindLiveMs() const;
+
+    /**
+     * @brief Get the URL playing the current stream from a point behind the live edge
+     *
+     * Served from disk, so rewinding or catching up is a reopen of a local
+     * URL and never reconnects to the source. 0 plays at the live edge.
+     */
+    QUrl timeshiftUrl(qint64 behindLiveMs) const;
+
     // Proxy configuration
     void setProxy(const QNetworkProxy& proxy);
     void clearProxy();
@@ -95,6 +163,15 @@ public:
     bool isNetworkShareMounted() const;
     QString getLocalMountPath() const;
 
+    /**
+     * @brief Get the URL to hand to libVLC for a file on the mounted share
+     *
+     * Files under the mount point play through the read-ahead gateway,
+     * anything else (or everything before the gateway listens) directly.
+     */
+    QUrl shareFileUrl(const QString& localPath) const;
+    void setShareCacheSize(qint64 bytes);
+
     // Stream configuration
     void setUserAgent(const QString& userAgent);
     void setCustomHeaders(const QMap<QString, QString>& headers);
@@ -112,6 +189,10 @@ signals:
     void streamError(const QString& error, int errorCode);
     void bandwidthStatsUpdated(const BandwidthStats& stats);
     void bufferLevelChanged(int percentage);
+    void renditionsAvailable(const QVector<AdaptiveBitrateController::Rendition>& renditions);
+    void renditionSwitchRequested(const AdaptiveBitrateController::Rendition& rendition);
+    void segmentCached(const QUrl& url, qint64 bytes, bool prefetched);
+    void timeshiftAvailabilityChanged(bool available);
     void networkShareMounted(const QString& localPath);
     void networkShareUnmounted();
 
@@ -120,6 +201,7 @@ private slots:
     void onNetworkReplyError(QNetworkReply::NetworkError error);
     void onBandwidthTimerTimeout();
     void updateBandwidthStats();
+    void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
 
 private:
     // Stream type detection helpers
@@ -142,6 +224,21 @@ private:
     void calculateBandwidthStats();
     void resetBandwidthStats();
 
+    // Timeshift helpers
+    static bool supportsTimeshift(StreamType type);
+    QUrl directPlaybackUrl() const;
+    void openTimeshift(const QUrl& url);
+
+    // Manifest parsing
+    void parseManifest(const QByteArray& manifest);
+    void followRendition();
+    static QVector<AdaptiveBitrateController::Rendition> parseHlsRenditions(const QByteArray& playlist,
+                                                                            const QUrl& baseUrl,
+                                                                            qint64& segmentMs);
+    static QVector<AdaptiveBitrateController::Rendition> parseDashRenditions(const QByteArray& manifest,
+                                                                             const QUrl& manifestUrl,
+                                                                             qint64& segmentMs);
+
     // Network share helpers
     bool mountSMBShare(const QUrl& url, const QString& username, const QString& password);
     bool mountNFSShare(const QUrl& url);
@@ -157,7 +254,21 @@ private:
     QTimer* m_bandwidthTimer;
     BandwidthStats m_bandwidthStats;
     QList<QPair<qint64, qint64>> m_bandwidthHistory; // timestamp, bytes
+    qint64 m_bytesReceived;     // Reply total, from downloadProgress()
     mutable QMutex m_statsMutex;
+
+    // Adaptive bitrate
+    AdaptiveBitrateController* m_adaptiveBitrate;
+
+    // Segment prefetch, in its own thread
+    std::unique_ptr<SegmentCache> m_segmentCache;
+    SegmentPrefetcher* m_prefetcher;
+    QThread m_prefetchThread;
+
+    // Timeshift capture and gateway, in their own thread
+    TimeshiftBuffer* m_timeshift;
+    QThread m_timeshiftThread;
+    qint64 m_timeshiftDurationMs;
     
     // Configuration
     QString m_userAgent;
@@ -165,9 +276,11 @@ private:
     int m_connectionTimeout;
     int m_bufferSize;
     
-    // Network share
+    // Network share, read ahead in its own thread
     QString m_mountedSharePath;
     QString m_localMountPath;
+    ShareReadAhead* m_shareReadAhead;
+    QThread m_shareReadAheadThread;
     
     // Error tracking
     QString m_lastError;
@@ -181,4 +294,5 @@ private:
     static const int DEFAULT_BUFFER_SIZE_KB = 1024;
     static const int BANDWIDTH_UPDATE_INTERVAL_MS = 1000;
     static const int BANDWIDTH_HISTORY_SIZE = 30;
+    static const qint64 DEFAULT_SEGMENT_CACHE_BYTES = 512LL * 1024 * 1024;
 };
\ No newline at end of file
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <functional>
+
+class QNetworkReply;
+class QProcess;
+class QTimer;
+
+/**
+ * @brief Search and stream URL lookups shared by the online services
+ *
+ * Searches go to a named channel per caller, one per search box. A new
+ * search on a channel replaces the previous one:
+ *
+ * - It is sent once the input has settled for the debounce interval, so
+ *   typing sends one request rather than one per key.
+ * - A previous request nobody else waits for is aborted, and only the
+ *   newest search calls its handler.
+ * - Identical requests in flight are sent once and answer every channel
+ *   waiting for them, and answers are cached for RESULT_TTL_MS.
+ *
+ * Page URLs (a video or a channel) are resolved into playable stream URLs
+ * by an external resolver, yt-dlp by default, at most MAX_RESOLVERS at a
+ * time. Resolved URLs are cached for STREAM_URL_TTL_MS, well inside the
+ * lifetime of signed CDN URLs. prefetchStreamUrls() resolves the top
+ * results of a search in the background, behind explicit requests, so the
+ * likely choice plays without waiting for the resolver.
+ *
+ * Handlers are called with their context object, and never once it is
+ * destroyed. Use from the main thread.
+ */
+class OnlineSearchService : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param data Response body, empty on error
+     * @param error Empty on success
+     */
+    using ResultHandler = std::function<void(const QByteArray& data, const QString& error)>;
+
+    /**
+     * @param streamUrl Invalid if the page could not be resolved
+     */
+    using StreamUrlHandler = std::function<void(const QUrl& streamUrl)>;
+
+    static OnlineSearchService& instance();
+
+    /**
+     * @brief Search after the input settles, replacing the channel's previous search
+     * @param channel Channel name, unique per context
+     * @param debounceMs Time to wait for further input, 0 to send at once
+     */
+    void search(QObject* context, const QString& channel, const QNetworkRequest& request,
+                ResultHandler handler, int debounceMs = DEFAULT_DEBOUNCE_MS);
+
+    /**
+     * @brief Drop the channel's search; its handler is not called
+     */
+    void cancel(QObject* context, const QString& channel);
+
+    /**
+     * @brief Get a resolved stream URL if one is cached
+     * @param format Resolver format selection, empty for its default
+     */
+    QUrl cachedStreamUrl(const QUrl& pageUrl, const QString& format = QString()) const;
+
+    /**
+     * @brief Resolve a page URL, from the cache when possible
+     */
+    void resolveStreamUrl(const QUrl& pageUrl, const QString& format, QObject* context, StreamUrlHandler handler);
+
+    /**
+     * @brief Resolve page URLs in the background, behind explicit requests
+     */
+    void prefetchStreamUrls(const QList<QUrl>& pageUrls, const QString& format = QString());
+
+    void setResolverProgram(const QString& program);
+    QString resolverProgram() const { return m_resolverProgram; }
+
+    void clearCache();
+
+    static constexpr int DEFAULT_DEBOUNCE_MS = 300;
+    static constexpr qint64 RESULT_TTL_MS = 5 * 60 * 1000;
+    static constexpr qint64 STREAM_URL_TTL_MS = 60 * 60 * 1000;
+    static constexpr int MAX_CACHED_RESULTS = 64;
+    static constexpr int MAX_RESOLVERS = 2;
+    static constexpr int PREFETCH_COUNT = 3;
+    static constexpr int RESOLVE_TIMEOUT_MS = 30000;
+
+private slots:
+    void onSearchFinished();
+
+private:
+    explicit OnlineSearchService(QObject* parent = nullptr);
+    ~OnlineSearchService() override;
+
+    struct Channel {
+        QPointer<QObject> context;
+        QNetworkRequest request;
+        QString key;
+        ResultHandler handler;
+        QTimer* debounce = nullptr;
+        bool sent = false;              // Waiting on m_searches[key]
+    };
+
+    struct Search {
+        QNetworkReply* reply = nullptr;
+        QStringList channels;           // Waiting for the answer
+    };
+
+    struct CachedResult {
+        QByteArray data;
+        qint64 storedAt = 0;            // m_clock time
+    };
+
+    struct CachedUrl {
+        QUrl url;
+        qint64 storedAt = 0;
+    };
+
+    struct StreamUrlWaiter {
+        QPointer<QObject> context;
+        StreamUrlHandler handler;
+    };
+
+    struct Resolve {
+        QUrl pageUrl;
+        QString format;
+        QList<StreamUrlWaiter> waiters;
+        QProcess* process = nullptr;    // Null while queued
+    };
+
+    static QString channelId(QObject* context, const QString& channel);
+    static QString searchKey(const QNetworkRequest& request);
+    static QString streamUrlKey(const QUrl& pageUrl, const QString& format);
+
+    void send(const QString& id);
+    void detach(const QString& id);
+    void removeChannel(const QString& id);
+    void answer(const QStringList& ids, const QString& key, const QByteArray& data, const QString& error);
+    void storeResult(const QString& key, const QByteArray& data);
+
+    void startResolvers();
+    void finishResolve(const QString& key, const QUrl& streamUrl);
+
+    QHash<QString, Channel> m_channels;     // By channelId()
+    QHash<QString, Search> m_searches;      // In flight, by searchKey()
+    QHash<QString, CachedResult> m_results;
+    QHash<QString, CachedUrl> m_streamUrls; // By streamUrlKey()
+    QHash<QString, Resolve> m_resolves;
+    QStringList m_resolveQueue;             // Explicit requests first
+    int m_resolversRunning = 0;
+
+    QString m_resolverProgram;
+    QElapsedTimer m_clock;
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "network/InternetStreamingService.h"
+#include <QObject>
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QXmlStreamReader>
+#include <memory>
+#include <unordered_map>
+
+class QNetworkReply;
+class QTimer;
+
+/**
+ * @brief Incremental RSS 2.0 parser
+ *
+ * Feed it data as it arrives and pull episodes out as each <item> closes;
+ * nothing but the current item is kept in memory. Channel fields are
+ * available once they have been read, which in practice is before the
+ * first item.
+ */
+class PodcastFeedParser
+{
+public:
+    using PodcastEpisode = InternetStreamingService::PodcastEpisode;
+
+    void addData(const QByteArray& data);
+
+    /**
+     * @brief Parse up to the end of the next item
+     * @return false when more data is needed, the document ended, or it is malformed
+     */
+    bool readNext(PodcastEpisode& episode);
+
+    bool isFinished() const;
+    bool hasError() const;
+    QString errorString() const { return m_reader.errorString(); }
+
+    QString title() const { return m_title; }
+    QString description() const { return m_description; }
+    QString website() const { return m_website; }
+    QString imageUrl() const { return m_imageUrl; }
+    QString author() const { return m_author; }
+    QString category() const { return m_category; }
+
+private:
+    void readChannelField(QStringView name, QStringView namespaceUri);
+
+    QXmlStreamReader m_reader;
+    QStringList m_elements;     // Open elements, outermost first
+    bool m_inItem = false;
+    PodcastEpisode m_episode;
+    QString m_text;
+
+    QString m_title;
+    QString m_description;
+    QString m_website;
+    QString m_imageUrl;
+    QString m_author;
+    QString m_category;
+};
+
+/**
+ * @brief Keeps a large set of podcast subscriptions up to date
+ *
+ * Refreshes every subscribed feed on an interval, at most
+ * maxConcurrentFetches() at a time through the shared NetworkService.
+ * Each request is conditional on the ETag and Last-Modified of the previous
+ * answer, so an unchanged feed costs one 304. Changed feeds are parsed
+ * while they download; feeds list the newest items first, so once a run of
+ * already known episodes is seen the rest of the download is abandoned.
+ *
+ * Only new episodes are stored, appended to a per-feed file next to a small
+ * state file with the validators, so a refresh never rewrites a whole feed.
+ */
+class PodcastFeedRefresher : public QObject
+{
+    Q_OBJECT
+
+public:
+    using PodcastEpisode = InternetStreamingService::PodcastEpisode;
+
+    explicit PodcastFeedRefresher(const QString& directory = defaultDirectory(), QObject* parent = nullptr);
+    ~PodcastFeedRefresher() override;
+
+    /**
+     * @brief Get the default storage directory
+     */
+    static QString defaultDirectory();
+
+    /**
+     * @brief Subscribe to a feed and fetch it right away
+     * @return false if already subscribed or invalid
+     */
+    bool subscribe(const QUrl& feedUrl);
+
+    /**
+     * @brief Unsubscribe and delete the stored episodes
+     */
+    bool unsubscribe(const QUrl& feedUrl);
+
+    QList<QUrl> subscriptions() const;
+    bool isSubscribed(const QUrl& feedUrl) const;
+    QString feedTitle(const QUrl& feedUrl) const;
+    QDateTime lastRefreshed(const QUrl& feedUrl) const;
+
+    /**
+     * @brief Read the stored episodes of a feed
+     * @param limit Maximum count, -1 for all
+     * @return Newest first
+     */
+    QList<PodcastEpisode> episodes(const QUrl& feedUrl, int limit = -1) const;
+
+    void setMaxConcurrentFetches(int fetches);
+    int maxConcurrentFetches() const { return m_maxConcurrent; }
+
+    /**
+     * @brief Set the automatic refresh interval, 0 to disable
+     */
+    void setRefreshInterval(int intervalMs);
+    int refreshInterval() const;
+
+    void setUserAgent(const QString& userAgent);
+
+    bool isRefreshing() const { return !m_queue.isEmpty() || !m_fetches.empty(); }
+
+public slots:
+    void refreshAll();
+    void refresh(const QUrl& feedUrl);
+
+signals:
+    /**
+     * @brief Emitted when a refresh found episodes not seen before
+     * @param episodes Newest first
+     */
+    void episodesAdded(const QUrl& feedUrl, const QList<PodcastEpisode>& episodes);
+
+    /**
+     * @brief Emitted when the server answered 304 Not Modified
+     */
+    void feedUnchanged(const QUrl& feedUrl);
+
+    void feedError(const QUrl& feedUrl, const QString& error);
+
+    /**
+     * @brief Emitted when the queue has drained
+     */
+    void refreshFinished(int feedsChecked, int newEpisodes);
+
+private slots:
+    void onReadyRead();
+    void onFinished();
+
+private:
+    struct Feed {
+        QUrl url;
+        QString title;
+        QByteArray etag;
+        QByteArray lastModified;
+        QDateTime lastRefreshed;
+        QSet<QString> guids;        // Loaded with the first refresh
+        bool guidsLoaded = false;
+    };
+
+    struct Fetch {
+        QUrl url;
+        PodcastFeedParser parser;
+        QList<PodcastEpisode> added;
+        int knownRun = 0;           // Consecutive known episodes
+        bool complete = false;      // Everything new has been read
+    };
+
+    void startFetches();
+    void parseAvailable(QNetworkReply* reply, Feed& feed, Fetch& fetch);
+
+    void loadGuids(Feed& feed) const;
+    void appendEpisodes(const Feed& feed, const QList<PodcastEpisode>& episodes) const;
+    QString episodeFile(const QUrl& feedUrl) const;
+    static QString episodeKey(const PodcastEpisode& episode);
+
+    void loadState();
+    void saveState() const;
+
+    QString m_directory;
+    QByteArray m_userAgent;
+    QHash<QString, Feed> m_feeds;   // By feed URL
+    QList<QUrl> m_queue;
+    std::unordered_map<QNetworkReply*, std::unique_ptr<Fetch>> m_fetches;
+    int m_maxConcurrent;
+    QTimer* m_refreshTimer;
+
+    // Counters for refreshFinished()
+    int m_feedsChecked = 0;
+    int m_newEpisodes = 0;
+
+    static constexpr int DEFAULT_MAX_CONCURRENT = 6;
+    static constexpr int DEFAULT_REFRESH_INTERVAL_MS = 60 * 60 * 1000;
+    static constexpr int KNOWN_RUN_TO_STOP = 5;
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "network/InternetStreamingService.h"
+#include <QObject>
+#include <QByteArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+
+class QNetworkReply;
+class QTimer;
+
+/**
+ * @brief Checks whether radio stations are on the air
+ *
+ * A probe opens the stream and is aborted as soon as the response headers
+ * arrive, so it costs one round trip and no audio. HEAD is not used:
+ * SHOUTcast v1 servers and many Icecast relays refuse it or answer it
+ * differently from GET. SHOUTcast's non-HTTP "ICY 200 OK" status line counts
+ * as online. The icy-* headers fill in name, genre and bitrate.
+ *
+ * At most maxConcurrentProbes() run at once, through the shared
+ * NetworkService, which also caps connections per host and reuses them.
+ * The newest requests go first, which are the stations the user is looking
+ * at. Results are cached, online ones for ONLINE_TTL_MS and offline ones
+ * for the shorter OFFLINE_TTL_MS, and a station is not probed again while
+ * its result is fresh.
+ */
+class RadioStationProber : public QObject
+{
+    Q_OBJECT
+
+public:
+    using RadioStation = InternetStreamingService::RadioStation;
+
+    enum Status {
+        Unknown,
+        Online,
+        Offline
+    };
+
+    explicit RadioStationProber(QObject* parent = nullptr);
+    ~RadioStationProber() override;
+
+    /**
+     * @brief Queue a probe unless a fresh result is cached
+     * @param force Probe even if the cached result is fresh
+     */
+    void probe(const QString& stationUrl, bool force = false);
+    void probe(const QStringList& stationUrls);
+
+    /**
+     * @brief Get the cached status, Unknown if never probed
+     */
+    Status status(const QString& stationUrl) const;
+    bool isFresh(const QString& stationUrl) const;
+
+    /**
+     * @brief Get what the station announced in its last answer
+     */
+    RadioStation stationInfo(const QString& stationUrl) const;
+
+    void setMaxConcurrentProbes(int probes);
+    int maxConcurrentProbes() const { return m_maxConcurrent; }
+    void setUserAgent(const QString& userAgent);
+
+    /**
+     * @brief Drop queued probes, e.g. when the list on screen changes
+     */
+    void cancelPending();
+
+    static constexpr int DEFAULT_MAX_CONCURRENT = 8;
+    static constexpr int PROBE_TIMEOUT_MS = 4000;
+    static constexpr qint64 ONLINE_TTL_MS = 10 * 60 * 1000;
+    static constexpr qint64 OFFLINE_TTL_MS = 2 * 60 * 1000;
+
+signals:
+    void stationProbed(const QString& stationUrl, bool online, const RadioStationProber::RadioStation& info);
+
+    /**
+     * @brief Emitted when the queue has drained
+     */
+    void probesFinished();
+
+private slots:
+    void onMetaDataChanged();
+    void onFinished();
+
+private:
+    struct Entry {
+        Status status = Unknown;
+        qint64 checkedAt = 0;       // m_clock time
+        RadioStation info;
+    };
+
+    void startProbes();
+    void complete(QNetworkReply* reply, bool online);
+
+    QHash<QString, Entry> m_cache;  // By station URL
+    QList<QString> m_queue;         // Next first
+    QHash<QNetworkReply*, QString> m_probes;
+    QElapsedTimer m_clock;
+    QByteArray m_userAgent;
+    int m_maxConcurrent;
+};
+
+/**
+ * @brief Local, indexed copy of the internet radio directory
+ *
+ * Searching the remote directory per keystroke is slow and rate limited,
+ * so the whole Icecast directory listing is downloaded in the background
+ * every refreshInterval(), conditional on the previous ETag and
+ * Last-Modified, and kept on disk. Stations seen in other search results
+ * are merged in with addStations().
+ *
+ * Searches are answered from in-memory indexes: genre and country by
+ * lowercase word, name by lowercase word prefix. Every word of a query has
+ * to match, and results are ordered by listener count.
+ */
+class RadioDirectory : public QObject
+{
+    Q_OBJECT
+
+public:
+    using RadioStation = InternetStreamingService::RadioStation;
+
+    explicit RadioDirectory(const QString& directory = defaultDirectory(), QObject* parent = nullptr);
+    ~RadioDirectory() override;
+
+    /**
+     * @brief Get the default storage directory
+     */
+    static QString defaultDirectory();
+
+    /**
+     * @brief Search the local directory
+     * @param query Words matched against station names, empty for any
+     * @param genre Genre word, empty for any
+     * @param country Country name or code, empty for any
+     * @param limit Maximum count, -1 for all
+     */
+    QList<RadioStation> search(const QString& query, const QString& genre = QString(),
+                               const QString& country = QString(), int limit = 50) const;
+
+    /**
+     * @brief Get the stations with the most listeners
+     */
+    QList<RadioStation> popular(const QString& genre = QString(), int limit = 50) const;
+
+    /**
+     * @brief Merge stations found elsewhere; known URLs are updated
+     */
+    void addStations(const QList<RadioStation>& stations);
+
+    int stationCount() const { return m_stations.size(); }
+    bool isEmpty() const { return m_stations.isEmpty(); }
+    QDateTime lastRefreshed() const { return m_lastRefreshed; }
+
+    /**
+     * @brief Set the automatic refresh interval, 0 to disable
+     */
+    void setRefreshInterval(int intervalMs);
+    int refreshInterval() const;
+
+    void setListingUrl(const QUrl& url);
+    void setUserAgent(const QString& userAgent);
+
+    bool isRefreshing() const { return m_reply != nullptr; }
+
+public slots:
+    void refresh();
+
+signals:
+    void directoryUpdated(int stationCount);
+    void refreshFailed(const QString& error);
+
+private slots:
+    void onRefreshFinished();
+
+private:
+    static QList<RadioStation> parseListing(const QByteArray& xml);
+    static QStringList words(const QString& text);
+
+    void rebuildIndex();
+    void indexStation(int index);
+    QList<int> matching(const QString& query, const QString& genre, const QString& country) const;
+
+    void load();
+    void save() const;
+
+    QString m_directory;
+    QUrl m_listingUrl;
+    QByteArray m_userAgent;
+    QByteArray m_etag;
+    QByteArray m_lastModified;
+    QDateTime m_lastRefreshed;
+
+    QList<RadioStation> m_stations;
+    QSet<QString> m_merged;                     // URLs from addStations() not in the listing
+    QHash<QString, int> m_byUrl;
+    QHash<QString, QList<int>> m_byGenre;       // By lowercase word
+    QHash<QString, QList<int>> m_byCountry;     // By lowercase word
+    QMap<QString, QList<int>> m_byNameWord;     // Ordered for prefix lookups
+
+    QNetworkReply* m_reply;
+    QTimer* m_refreshTimer;
+
+    static constexpr int DEFAULT_REFRESH_INTERVAL_MS = 6 * 60 * 60 * 1000;
+};
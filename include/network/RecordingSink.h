@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QThread>
+#include <atomic>
+
+class RecordingWriter;
+
+/**
+ * @brief Writes a captured stream to disk on its own I/O thread
+ *
+ * write() only hands the data over; the writer thread keeps one file handle
+ * open and gathers data into a large buffer that goes to disk when full or
+ * every FLUSH_INTERVAL_MS, so a stream delivering small chunks costs a few
+ * writes per second instead of an open, write and close per chunk.
+ *
+ * Output can be rotated into numbered segments, "name_0001.ext" and so on,
+ * by size or duration; rotation cuts at byte boundaries, which MP3 and ADTS
+ * decoders resynchronise across. Counters are updated as data is handed
+ * over, so progress never needs a file stat.
+ */
+class RecordingSink : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Rotation {
+        qint64 maxBytes = 0;        // 0 for no size limit
+        qint64 maxDurationMs = 0;   // 0 for no duration limit
+        int keepSegments = 0;       // Older segments are deleted, 0 keeps all
+    };
+
+    static constexpr int WRITE_BUFFER_BYTES = 1024 * 1024;
+    static constexpr int FLUSH_INTERVAL_MS = 2000;
+
+    explicit RecordingSink(QObject* parent = nullptr);
+    ~RecordingSink() override;
+
+    /**
+     * @brief Start a recording, replacing an existing file
+     * @param rotation Segmenting, none by default
+     */
+    void open(const QString& outputPath, const Rotation& rotation = Rotation());
+
+    /**
+     * @brief Queue data for writing. Cheap, never touches the disk.
+     */
+    void write(const QByteArray& data);
+
+    /**
+     * @brief Flush and close, finishing the current segment
+     */
+    void close();
+
+    bool isOpen() const { return m_open; }
+
+    /**
+     * @brief Bytes handed over since open()
+     */
+    qint64 bytesReceived() const { return m_bytesReceived; }
+
+    /**
+     * @brief Bytes that reached the disk since open()
+     */
+    qint64 bytesWritten() const { return m_bytesWritten; }
+
+    int segmentCount() const { return m_segmentCount; }
+
+signals:
+    void segmentStarted(const QString& filePath, int index);
+    void segmentFinished(const QString& filePath, qint64 bytes);
+    void writeError(const QString& error);
+
+private:
+    friend class RecordingWriter;
+
+    RecordingWriter* m_writer;
+    QThread m_ioThread;
+    bool m_open = false;
+    std::atomic<qint64> m_bytesReceived{0};
+    std::atomic<qint64> m_bytesWritten{0};
+    std::atomic<int> m_segmentCount{0};
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#ifdef HAVE_QT_WEBSOCKETS
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QTimer;
+class QWebSocket;
+
+/**
+ * @brief Pushes casting state to web remotes as deltas
+ *
+ * Remotes get a full snapshot when they connect and afterwards only the
+ * fields that changed, in one message per frame however many changes
+ * came in. Each message is encoded once and the same bytes go to every
+ * client, so the cost of an update does not grow with the client count.
+ *
+ * Position is not pushed while it advances as expected: remotes
+ * extrapolate from the last position while playing, and get a new one
+ * only on seeks, state changes or drift past POSITION_DRIFT_MS.
+ *
+ * Clients speak JSON unless their first message is
+ * {"type":"hello","format":"binary"}. Binary messages are big-endian:
+ *
+ *     quint8 kind ('S' snapshot, 'D' delta), quint32 sequence,
+ *     then per field: quint8 Field, value
+ *
+ * Values are quint8 for Casting/Playing/Muted/Volume, qint64 for
+ * Position/Duration (ms), qint32 for QueueIndex, quint16 length + UTF-8
+ * for Title/Device, and quint16 count + strings for Queue.
+ */
+class RemoteStatePublisher : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Field : quint8 {
+        Casting = 1,
+        Playing,
+        Position,
+        Duration,
+        Volume,
+        Muted,
+        Title,
+        Device,
+        Queue,
+        QueueIndex
+    };
+
+    struct State {
+        bool casting = false;
+        bool playing = false;
+        qint64 positionMs = 0;
+        qint64 durationMs = 0;
+        int volume = 50;
+        bool muted = false;
+        QString title;
+        QString device;
+        QStringList queue;
+        int queueIndex = -1;
+    };
+
+    explicit RemoteStatePublisher(QObject* parent = nullptr);
+    ~RemoteStatePublisher() override;
+
+    /**
+     * @brief Start pushing to a connected remote; sends it a snapshot
+     */
+    void addClient(QWebSocket* client);
+    void removeClient(QWebSocket* client);
+    int clientCount() const { return m_clients.size(); }
+
+    /**
+     * @brief Handle a protocol message from a remote
+     * @return true if it was one (hello), false if it is a command for the caller
+     */
+    bool handleMessage(QWebSocket* client, const QString& message);
+
+    /**
+     * @brief Update the state but the queue; changes go out with the next frame
+     */
+    void setState(const State& state);
+    void setQueue(const QStringList& queue, int queueIndex);
+    State state() const { return m_state; }
+
+    static constexpr int FRAME_INTERVAL_MS = 16;
+    static constexpr qint64 POSITION_DRIFT_MS = 1000;
+
+private slots:
+    void flush();
+
+private:
+    struct Client {
+        QWebSocket* socket = nullptr;
+        bool binary = false;
+    };
+
+    quint32 changedFields() const;
+    void scheduleFlush();
+    qint64 expectedPosition() const;
+    void send(const Client& client, const QByteArray& json, const QByteArray& binary) const;
+
+    QByteArray encodeJson(bool snapshot, quint32 fields) const;
+    QByteArray encodeBinary(bool snapshot, quint32 fields) const;
+
+    QList<Client> m_clients;
+    State m_state;                  // Latest
+    State m_published;              // As remotes know it
+    QElapsedTimer m_clock;
+    qint64 m_positionPublishedAt;   // m_clock time of m_published.positionMs
+    quint32 m_sequence;
+    QTimer* m_flushTimer;
+};
+
+#endif // HAVE_QT_WEBSOCKETS
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <list>
+
+/**
+ * @brief Size-bounded on-disk LRU of HLS/DASH segments
+ *
+ * One file per segment, named by a hash of its key (the URL, plus the byte
+ * range for ranged segments). The index is rebuilt from the directory on
+ * start, oldest file first, so the cache survives restarts. Inserting past
+ * the size bound evicts the least recently used segments. Thread-safe.
+ */
+class SegmentCache
+{
+public:
+    SegmentCache(const QString& directory, qint64 maxBytes);
+
+    /**
+     * @brief Get the default cache directory
+     */
+    static QString defaultDirectory();
+
+    bool contains(const QString& key) const;
+
+    /**
+     * @brief Read a segment and mark it as recently used
+     * @return Empty if the segment is not cached
+     */
+    QByteArray read(const QString& key);
+
+    /**
+     * @brief Store a segment, evicting old ones to stay within the bound
+     */
+    void store(const QString& key, const QByteArray& data);
+
+    void setMaxSize(qint64 maxBytes);
+    qint64 maxSize() const;
+    qint64 currentSize() const;
+
+    /**
+     * @brief Remove every cached segment
+     */
+    void clear();
+
+private:
+    struct Entry {
+        qint64 size = 0;
+        std::list<QString>::iterator position;  // In m_order
+    };
+
+    static QString fileName(const QString& key);
+    QString filePath(const QString& name) const;
+
+    void loadIndex();
+    void remove(const QString& name);
+    void evict();
+
+    QString m_directory;
+    qint64 m_maxBytes;
+    qint64 m_currentBytes = 0;
+
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_entries;    // By file name
+    std::list<QString> m_order;         // Least recently used first
+};
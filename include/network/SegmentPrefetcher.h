@@ -0,0 +1,206 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QNetworkProxy>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QUrl>
+#include <atomic>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+class SegmentCache;
+
+/**
+ * @brief Fetches HLS/DASH segments ahead of playback into a SegmentCache
+ *
+ * Two halves share one cache:
+ *
+ * - A prefetcher follows one rendition's playlist, an HLS media playlist or a
+ *   DASH Representation. It reloads the playlist while the stream is live and
+ *   keeps the next prefetchDepth() segments after the playback position
+ *   cached, fetching up to PARALLEL_FETCHES at once. Requests allow HTTP/2.
+ *   QNetworkAccessManager keeps the connections alive between segments.
+ *
+ * - A loopback gateway through which libVLC plays. gatewayUrl() maps
+ *   https://host/path to http://127.0.0.1:<port>/o/https/host/path. Cached
+ *   segments are served from disk and a segment already being prefetched is
+ *   awaited. Anything else is fetched and cached on the way through.
+ *   Playlists and manifests are passed through uncached, with absolute URLs
+ *   rewritten to the gateway. Relative ones already resolve against it.
+ *
+ * So seeking back, or scrubbing through a live DVR window that was already
+ * watched, is served without touching the network.
+ *
+ * Lives in its own thread; call the slots through QMetaObject::invokeMethod.
+ * gatewayUrl() is safe from any thread.
+ */
+class SegmentPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SegmentPrefetcher(SegmentCache* cache, QObject* parent = nullptr);
+    ~SegmentPrefetcher() override;
+
+    /**
+     * @brief Map a remote URL onto the gateway
+     * @return Invalid until start() has run
+     */
+    QUrl gatewayUrl(const QUrl& remote) const;
+
+    /**
+     * @brief Parse an xs:duration as used by MPDs, e.g. PT1M30.5S
+     * @return Milliseconds, 0 if malformed
+     */
+    static qint64 parseIsoDurationMs(const QString& duration);
+
+public slots:
+    /**
+     * @brief Create the network manager and open the gateway, in the owning thread
+     */
+    void start();
+    void stop();
+
+    /**
+     * @brief Follow a rendition
+     * @param playlistUrl HLS media playlist, or the DASH manifest
+     * @param representationId DASH Representation to follow, empty for HLS or the first video one
+     */
+    void setPlaylist(const QUrl& playlistUrl, const QString& representationId = QString());
+
+    /**
+     * @brief Stop following, keeping the cache
+     */
+    void clearPlaylist();
+
+    /**
+     * @brief Report the playback position in media time
+     */
+    void setPlaybackPosition(qint64 positionMs);
+
+    void setPrefetchDepth(int segments);
+    void setUserAgent(const QString& userAgent);
+    void setProxy(const QNetworkProxy& proxy);
+
+signals:
+    /**
+     * @brief Emitted when the gateway listens
+     */
+    void gatewayReady(quint16 port);
+
+    /**
+     * @brief Emitted when a segment went into the cache
+     * @param prefetched True if fetched ahead, false if on a gateway miss
+     */
+    void segmentCached(const QUrl& url, qint64 bytes, bool prefetched);
+
+private slots:
+    void onGatewayConnection();
+    void onClientReadyRead();
+    void onPlaylistFinished();
+    void onFetchFinished();
+
+private:
+    struct Segment {
+        QUrl url;
+        QByteArray range;       // "bytes=a-b" for HLS byte ranges
+        qint64 startMs = 0;
+        qint64 durationMs = 0;
+    };
+
+    struct Waiter {
+        QPointer<QTcpSocket> socket;
+        bool headOnly = false;
+    };
+
+    struct Fetch {
+        QUrl url;
+        QByteArray range;
+        bool prefetch = false;
+        bool passThrough = false;   // Playlist or manifest, rewritten and not cached
+        QList<Waiter> waiters;      // Gateway clients to answer
+    };
+
+    struct ClientState {
+        QByteArray input;
+        bool waiting = false;       // A response is pending
+    };
+
+    // Playlists
+    void loadPlaylist();
+    void parseHlsPlaylist(const QByteArray& playlist);
+    void parseDashManifest(const QByteArray& manifest);
+
+    /**
+     * @brief Replace the followed segments
+     * @param relativeTimes Start times count from the first segment (HLS) instead of the presentation
+     */
+    void addSegments(QMap<qint64, Segment> segments, bool relativeTimes);
+    static QString expandTemplate(const QString& pattern, const QString& representationId,
+                                  qint64 bandwidth, qint64 number, qint64 time);
+
+    // Prefetching
+    void schedulePrefetch();
+    QNetworkRequest createRequest(const QUrl& url, const QByteArray& range) const;
+    QNetworkReply* startFetch(const QUrl& url, const QByteArray& range, bool prefetch, bool passThrough);
+
+    // Gateway
+    void processClient(QTcpSocket* socket);
+    void resumeClient(QTcpSocket* socket);
+
+    /**
+     * @brief Answer one request head
+     * @return true if the answer waits for a fetch
+     */
+    bool handleRequest(QTcpSocket* socket, const QByteArray& head);
+    void respond(QTcpSocket* socket, int status, const QByteArray& reason, const QByteArray& headers,
+                 const QByteArray& body, bool headOnly);
+    QByteArray rewritePlaylist(const QByteArray& playlist);
+    static bool isPlaylist(const QUrl& url);
+    static QString cacheKey(const QUrl& url, const QByteArray& range);
+    static bool parseRange(const QByteArray& range, qint64 size, qint64& start, qint64& length);
+    static QByteArray contentRange(qint64 start, qint64 length, qint64 total);
+
+    SegmentCache* m_cache;
+    QNetworkAccessManager* m_network = nullptr;
+    QByteArray m_userAgent;
+    QNetworkProxy m_proxy{QNetworkProxy::DefaultProxy};
+    QTcpServer* m_gateway = nullptr;
+    std::atomic<quint16> m_port{0};
+    QHash<QTcpSocket*, ClientState> m_clients;
+
+    mutable QMutex m_hostMutex;
+    mutable QSet<QString> m_allowedHosts;      // Lower case, filled by gatewayUrl()
+
+    // Followed rendition
+    QUrl m_playlistUrl;
+    QString m_representationId;
+    QNetworkReply* m_playlistReply = nullptr;
+    QTimer* m_reloadTimer = nullptr;
+    QMap<qint64, Segment> m_segments;   // By sequence number
+    Segment m_initSegment;              // EXT-X-MAP or DASH Initialization
+    bool m_live = false;
+    qint64 m_positionMs = 0;
+    int m_depth = DEFAULT_DEPTH;
+
+    QHash<QString, QNetworkReply*> m_inFlight;  // By cache key
+    QHash<QNetworkReply*, Fetch> m_fetches;
+    int m_prefetchesRunning = 0;
+
+    static constexpr int DEFAULT_DEPTH = 4;
+    static constexpr int PARALLEL_FETCHES = 3;
+    static constexpr int MAX_HEADER_BYTES = 16 * 1024;
+    static constexpr int MIN_RELOAD_INTERVAL_MS = 1000;
+    static constexpr int RETRY_INTERVAL_MS = 5000;
+};
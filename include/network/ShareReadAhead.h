@@ -0,0 +1,140 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QUrl>
+#include <atomic>
+
+class QTcpServer;
+class QTcpSocket;
+class QThreadPool;
+
+/**
+ * @brief Read-ahead gateway for media on a mounted SMB/NFS share
+ *
+ * Played through the OS, share files are read in small synchronous
+ * requests, and every seek over a slow link stalls on round trips. libVLC
+ * plays them through this loopback gateway instead, which answers from a
+ * bounded in-memory cache of BLOCK_BYTES blocks:
+ *
+ * - Reads continuing where the last one on a file ended double that
+ *   file's prefetch window, up to MAX_WINDOW_BLOCKS. A read elsewhere is a
+ *   seek: the window drops back to MIN_WINDOW_BLOCKS and queued reads of
+ *   the old stretch are dropped, so the new position is read first.
+ * - Window blocks are read on a thread pool, PARALLEL_READS at a time and
+ *   each through its own file handle, so several range reads are in flight
+ *   on the share at once.
+ * - Past the cache bound, blocks of files nobody reads go first, then
+ *   blocks behind a reader, furthest behind first, which is what a seek
+ *   leaves behind, then blocks beyond a reader's window. Blocks inside a
+ *   window are kept.
+ *
+ * fileUrl() maps a file under the mount point to
+ * http://127.0.0.1:<port>/f/<relative path>; the gateway serves nothing
+ * outside the mount point.
+ *
+ * Lives in its own thread; call the slots through QMetaObject::invokeMethod.
+ * fileUrl() is safe from any thread.
+ */
+class ShareReadAhead : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ShareReadAhead(QObject* parent = nullptr);
+    ~ShareReadAhead() override;
+
+    /**
+     * @brief Map a file on the share onto the gateway
+     * @return Invalid until start() has run, or if the file is not under the mount point
+     */
+    QUrl fileUrl(const QString& localPath) const;
+
+    static constexpr qint64 BLOCK_BYTES = 1024 * 1024;
+    static constexpr qint64 DEFAULT_CACHE_BYTES = 128LL * 1024 * 1024;
+
+public slots:
+    /**
+     * @brief Create the read pool and open the gateway, in the owning thread
+     */
+    void start();
+    void stop();
+
+    /**
+     * @brief Serve files under a mount point, empty to serve none and drop the cache
+     */
+    void setRoot(const QString& mountPath);
+    void setCacheSize(qint64 bytes);
+
+signals:
+    void gatewayReady(quint16 port);
+
+private slots:
+    void onGatewayConnection();
+    void onClientReadyRead();
+    void onClientBytesWritten();
+
+private:
+    struct Block {
+        QByteArray data;
+        quint64 lastUse = 0;
+    };
+
+    struct CachedFile {
+        qint64 size = 0;
+        QHash<qint64, Block> blocks;    // By index
+        QSet<qint64> reading;           // Queued or in flight
+        qint64 readEnd = -1;            // Where the last read ended, -1 before the first
+        int window = MIN_WINDOW_BLOCKS;
+        int readers = 0;
+    };
+
+    struct Client {
+        QByteArray input;
+        QString path;                   // Empty until a response is streaming
+        qint64 position = 0;            // Next byte to send
+        qint64 end = 0;                 // One past the last byte to send
+    };
+
+    void handleRequest(QTcpSocket* socket, Client& client, const QByteArray& head);
+    static void respond(QTcpSocket* socket, int status, const QByteArray& reason, const QByteArray& headers);
+    QString resolve(const QByteArray& target) const;
+
+    /**
+     * @brief Send cached data to a client and keep its window read ahead
+     */
+    void pump(QTcpSocket* socket);
+    void finishClient(QTcpSocket* socket, Client& client);
+    void readAhead(const QString& path, CachedFile& file, qint64 fromIndex);
+    void queueRead(const QString& path, CachedFile& file, qint64 index, bool urgent);
+    void dispatchReads();
+    void onBlockRead(const QString& path, qint64 index, const QByteArray& data, bool ok);
+    void evict();
+
+    QTcpServer* m_gateway = nullptr;
+    QThreadPool* m_readPool = nullptr;
+    std::atomic<quint16> m_port{0};
+
+    mutable QMutex m_rootMutex;
+    QString m_root;                     // Canonical, guarded by m_rootMutex
+
+    QHash<QTcpSocket*, Client> m_clients;
+    QHash<QString, CachedFile> m_files; // By canonical path
+    QList<QPair<QString, qint64>> m_readQueue;
+    int m_readsInFlight = 0;
+    qint64 m_cachedBytes = 0;
+    qint64 m_maxBytes = DEFAULT_CACHE_BYTES;
+    quint64 m_useCounter = 0;
+
+    static constexpr int MIN_WINDOW_BLOCKS = 2;
+    static constexpr int MAX_WINDOW_BLOCKS = 32;
+    static constexpr int PARALLEL_READS = 4;
+    static constexpr qint64 SOCKET_BACKLOG_BYTES = 2 * 1024 * 1024;
+    static constexpr int MAX_HEADER_BYTES = 16 * 1024;
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <QObject>
+#include <QHostAddress>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+
+class AudioDSPGraph;
+class ClockSync;
+class NetworkDiscoveryManager;
+class QThread;
+class QTimer;
+
+/**
+ * @brief Plays one media timeline in step across a sync group
+ *
+ * The leader publishes the timeline on the group's "timeline" sync channel:
+ * the media, the position it starts from and the group time it starts at,
+ * always START_LEAD_MS ahead so every zone hears about it in time. Group
+ * time is the leader's steady clock, which followers track through a
+ * ClockSync running in its own thread. Followers who join late start on
+ * the same timeline further in.
+ *
+ * Each zone turns the start into its own steady-clock time and asks its
+ * player to have the media ready there (startScheduled()). The audio graph
+ * is told to start pulling on the output frame that is heard at that time,
+ * so zones start within a sample of each other, give or take the clock
+ * estimate. From then on the controller compares the graph's render
+ * position with the timeline every CONTROL_INTERVAL_MS and trims the rate
+ * at which the graph consumes audio (a PI loop), absorbing the drift of
+ * each zone's sound card against the leader's clock. Errors too large to
+ * trim away, after an underrun for example, restart the zone on the
+ * timeline.
+ *
+ * Zones whose output paths differ should set their output latency, the
+ * time from render() to the speaker.
+ */
+class SyncedPlayback : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int START_LEAD_MS = 500;
+    static constexpr int CONTROL_INTERVAL_MS = 100;
+    static constexpr int ANNOUNCE_INTERVAL_MS = 2000;
+    static constexpr int ERROR_WINDOW = 9;                  // Measurements per median
+    static constexpr double RESYNC_THRESHOLD_MS = 40.0;
+    static constexpr double PROPORTIONAL_GAIN = 0.2;        // Trim per second of error
+    static constexpr double INTEGRAL_GAIN = 0.02;           // Trim per second of error per second
+
+    /**
+     * @brief Where the group is in the media
+     */
+    struct Timeline {
+        QString mediaUrl;
+        qint64 positionMs = 0;      // Media position at startGroupNs
+        qint64 startGroupNs = 0;
+        bool playing = false;
+        quint64 revision = 0;
+    };
+
+    explicit SyncedPlayback(QObject* parent = nullptr);
+    ~SyncedPlayback() override;
+
+    /**
+     * @brief Join a group's timeline
+     * @param network Carrier of the timeline messages
+     * @param groupId Sync group
+     * @param leader true to publish the timeline and be the reference clock
+     */
+    void attachSyncGroup(NetworkDiscoveryManager* network, const QString& groupId, bool leader);
+    void detachSyncGroup();
+
+    /**
+     * @brief Set the graph to start and trim
+     * @param graph Graph whose render() feeds this zone's output
+     * @param outputSampleRate Rate render() is called at
+     */
+    void setAudioGraph(AudioDSPGraph* graph, int outputSampleRate);
+
+    /**
+     * @brief Set the time from render() to the speaker
+     */
+    void setOutputLatency(qint64 latencyNs) { m_outputLatencyNs = latencyNs; }
+
+    // Leader only
+
+    void play(const QString& mediaUrl, qint64 positionMs);
+    void pause();
+    void seek(qint64 positionMs);
+
+    bool isLeader() const { return m_leader; }
+    Timeline timeline() const { return m_timeline; }
+    ClockSync* clock() const { return m_clock; }
+
+    /**
+     * @brief Get the timeline's media position at this moment
+     */
+    qint64 expectedPositionMs() const;
+
+    /**
+     * @brief Get the latest median output error, positive when ahead
+     */
+    double lastErrorMs() const { return m_lastErrorMs; }
+
+signals:
+    /**
+     * @brief Have the media playing at a position by a steady-clock time
+     *
+     * Open or seek the player now; the graph holds the output back until
+     * localStartNs, so the player only needs to be ready before then.
+     */
+    void startScheduled(const QString& mediaUrl, qint64 positionMs, qint64 localStartNs);
+    void pauseRequested(qint64 positionMs);
+    void errorMeasured(double errorMs, double rateTrim);
+
+private slots:
+    void onSyncPayloadReceived(const QString& groupId, const QString& channel, const QString& senderDeviceId,
+                               const QByteArray& payload);
+    void onClockLockChanged(bool locked);
+    void announce();
+    void control();
+
+private:
+    void publish(const Timeline& timeline, const QString& deviceId = QString());
+    void applyTimeline();
+    void resetControl();
+    QHostAddress addressOf(const QString& deviceId) const;
+
+    QPointer<NetworkDiscoveryManager> m_network;
+    QString m_groupId;
+    bool m_leader;
+
+    QThread* m_clockThread;
+    ClockSync* m_clock;
+    QTimer* m_controlTimer;
+    QTimer* m_announceTimer;
+
+    QHostAddress m_reference;
+    Timeline m_timeline;
+    bool m_timelinePending;     // Waiting for the clock to lock
+    qint64 m_localStartNs;
+    qint64 m_startGroupNs;      // Start as applied here, later than the timeline's for late joiners
+
+    AudioDSPGraph* m_graph;
+    int m_outputSampleRate;
+    qint64 m_outputLatencyNs;
+
+    QVector<double> m_errors;
+    double m_integral;
+    double m_lastErrorMs;
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QNetworkProxy>
+#include <QString>
+#include <QUrl>
+#include <atomic>
+#include <memory>
+#include "network/TimeshiftRing.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+
+/**
+ * @brief Captures a live stream into a TimeshiftRing and plays it back locally
+ *
+ * Two halves, like SegmentPrefetcher:
+ *
+ * - A capture keeps receiving the live source whether or not anything is
+ *   playing: a continuous HTTP stream (Icecast, SHOUTcast, live progressive)
+ *   is read as it arrives and reconnected if it drops, an HLS media playlist
+ *   is followed and its segments appended in order. The first playlist load
+ *   captures as much of the server's window as the duration covers.
+ *
+ * - A loopback gateway through which libVLC plays:
+ *   http://127.0.0.1:<port>/live?behind=<ms> starts behindMs behind the live
+ *   edge, on an HLS segment start or indexed point. Each connection reads
+ *   from its own position in the ring, so pausing just stops the reads, a
+ *   rewind or catch-up is a new connection to the gateway, and neither
+ *   touches the source. A reader paused beyond the window resumes at its
+ *   oldest point.
+ *
+ * A source that turns out not to be live (a file with a length, or an HLS
+ * playlist with EXT-X-ENDLIST) or cannot be concatenated (encrypted HLS) is
+ * not captured, and the gateway redirects to the fallback URL instead.
+ *
+ * The ring of the stream being captured is also published through
+ * ringFor(), so a recording can start from a point in the past.
+ *
+ * Lives in its own thread; call the slots through QMetaObject::invokeMethod.
+ * playbackUrl(), ring(), ringFor(), isLive() and playbackBehindLiveMs() are
+ * safe from any thread.
+ */
+class TimeshiftBuffer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class SourceKind {
+        Continuous,     // One HTTP response carrying the stream
+        HlsPlaylist     // An HLS media playlist, or a master one through its first variant
+    };
+
+    struct Source {
+        QUrl streamUrl;     // What the user opened, the key for ringFor()
+        QUrl captureUrl;    // What to capture from, e.g. through the segment gateway
+        SourceKind kind = SourceKind::Continuous;
+        QUrl fallbackUrl;   // Where the gateway redirects if the source is not captured
+    };
+
+    static constexpr qint64 DEFAULT_DURATION_MS = 30 * 60 * 1000;
+    static constexpr qint64 DEFAULT_MAX_BYTES = 2LL * 1024 * 1024 * 1024;
+
+    explicit TimeshiftBuffer(QObject* parent = nullptr);
+    ~TimeshiftBuffer() override;
+
+    /**
+     * @brief Get the gateway URL playing a point behind the live edge
+     * @return Invalid until start() has run
+     */
+    QUrl playbackUrl(qint64 behindLiveMs = 0) const;
+
+    /**
+     * @brief Get the ring being filled, null while nothing is captured
+     */
+    std::shared_ptr<TimeshiftRing> ring() const;
+
+    /**
+     * @brief Get the ring capturing a stream, if any buffer is capturing it
+     */
+    static std::shared_ptr<TimeshiftRing> ringFor(const QUrl& streamUrl);
+
+    /**
+     * @brief Check whether the source was found live and is being captured
+     */
+    bool isLive() const { return m_live; }
+
+    /**
+     * @brief Get how far the latest gateway reader trails the live edge
+     */
+    qint64 playbackBehindLiveMs() const;
+
+public slots:
+    /**
+     * @brief Create the network manager and open the gateway, in the owning thread
+     */
+    void start();
+    void stop();
+
+    /**
+     * @brief Start capturing, replacing any previous source and its ring
+     */
+    void open(const TimeshiftBuffer::Source& source);
+    void close();
+
+    /**
+     * @brief Follow another rendition of the HLS stream being captured
+     */
+    void setPlaylist(const QUrl& playlistUrl);
+
+    void setDuration(qint64 durationMs);
+    void setMaxBytes(qint64 bytes);
+    void setUserAgent(const QString& userAgent);
+    void setProxy(const QNetworkProxy& proxy);
+
+signals:
+    void gatewayReady(quint16 port);
+
+    /**
+     * @brief Emitted when the source was found live and capturing started
+     */
+    void liveStarted(const QUrl& streamUrl);
+
+    /**
+     * @brief Emitted when the source is not captured and plays through the fallback
+     */
+    void captureDeclined(const QUrl& streamUrl, const QString& reason);
+
+private slots:
+    void onGatewayConnection();
+    void onClientReadyRead();
+    void onClientBytesWritten();
+    void onStreamHeaders();
+    void onStreamReadyRead();
+    void onStreamFinished();
+    void onPlaylistFinished();
+    void onSegmentFinished();
+
+private:
+    enum class State {
+        Idle,
+        Probing,        // Waiting to find out whether the source is live
+        Live,
+        Declined,
+        Ended           // Live until the source ended; the ring still plays
+    };
+
+    struct Segment {
+        qint64 sequence = 0;
+        QUrl url;
+        QByteArray range;
+        qint64 durationMs = 0;
+        bool initSegment = false;   // EXT-X-MAP, kept apart from the stream
+    };
+
+    struct Client {
+        QByteArray input;
+        bool parked = false;        // Request received, waiting for the capture to decide
+        bool streaming = false;
+        qint64 behindMs = 0;
+        qint64 position = 0;
+    };
+
+    // Capture
+    QNetworkReply* get(const QUrl& url, const QByteArray& range = QByteArray());
+    void connectStream();
+    void loadPlaylist();
+    void parseHlsPlaylist(const QByteArray& playlist, const QUrl& baseUrl);
+    void fetchNextSegment();
+    void goLive();
+    void decline(const QString& reason);
+    void abortCapture();
+    qint64 captureTimeMs() const;
+
+    // Gateway
+    void handleRequest(QTcpSocket* socket, Client& client, const QByteArray& head);
+    void beginResponse(QTcpSocket* socket, Client& client);
+    static void respond(QTcpSocket* socket, int status, const QByteArray& reason, const QByteArray& headers);
+    void pump(QTcpSocket* socket);
+    void pumpAll();
+    void answerParked();
+
+    QNetworkAccessManager* m_network = nullptr;
+    QByteArray m_userAgent;
+    QNetworkProxy m_proxy{QNetworkProxy::DefaultProxy};
+    QTcpServer* m_gateway = nullptr;
+    std::atomic<quint16> m_port{0};
+    QHash<QTcpSocket*, Client> m_clients;
+
+    // Captured source
+    Source m_source;
+    State m_state = State::Idle;
+    std::atomic<bool> m_live{false};
+    mutable QMutex m_ringMutex;
+    std::shared_ptr<TimeshiftRing> m_ring;      // Guarded by m_ringMutex
+    QByteArray m_contentType;
+    qint64 m_durationMs = DEFAULT_DURATION_MS;
+    qint64 m_maxBytes = DEFAULT_MAX_BYTES;
+    std::atomic<qint64> m_readerOffset{-1};     // Latest gateway reader position
+
+    // Continuous stream
+    QNetworkReply* m_streamReply = nullptr;
+    QElapsedTimer m_captureClock;               // Stream time of live data
+
+    // HLS
+    QNetworkReply* m_playlistReply = nullptr;
+    QNetworkReply* m_segmentReply = nullptr;
+    QTimer* m_reloadTimer = nullptr;
+    QList<Segment> m_queue;
+    Segment m_fetching;
+    qint64 m_nextSequence = -1;
+    qint64 m_streamTimeMs = 0;                  // Stream time at the end of the last segment
+    QUrl m_initSegmentUrl;
+    bool m_playlistEnded = false;
+
+    static constexpr int RECONNECT_DELAY_MS = 2000;
+    static constexpr int MIN_RELOAD_MS = 1000;
+    static constexpr qint64 SOCKET_BACKLOG_BYTES = 2 * 1024 * 1024;
+    static constexpr qint64 READ_CHUNK_BYTES = 256 * 1024;
+    static constexpr int MAX_HEADER_BYTES = 16 * 1024;
+};
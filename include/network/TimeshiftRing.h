@@ -0,0 +1,108 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <deque>
+
+/**
+ * @brief Disk-backed ring holding the last stretch of a live stream
+ *
+ * Bytes are addressed by their offset since the capture started, which
+ * never changes while the window slides. The newest HEAD_BYTES stay in
+ * memory, so playback near the live edge never touches the disk; older
+ * bytes are read back from a file used as a circular buffer of maxBytes.
+ * Writes to the file are gathered until FLUSH_BYTES are pending.
+ *
+ * The stream time of points where playback may start (segment starts, or
+ * every INDEX_INTERVAL_MS of a continuous stream) is indexed, and the
+ * window is trimmed at those points to the configured duration and size,
+ * so a reader placed at start() or offsetBehindLive() always lands on one.
+ *
+ * All methods are thread-safe.
+ */
+class TimeshiftRing
+{
+public:
+    static constexpr qint64 HEAD_BYTES = 16LL * 1024 * 1024;
+    static constexpr qint64 FLUSH_BYTES = 1024 * 1024;
+    static constexpr qint64 INDEX_INTERVAL_MS = 500;
+
+    /**
+     * @param filePath Backing file, created and removed by the ring
+     * @param durationMs Stream time kept behind the live edge
+     * @param maxBytes Largest size of the backing file
+     */
+    TimeshiftRing(const QString& filePath, qint64 durationMs, qint64 maxBytes);
+    ~TimeshiftRing();
+
+    TimeshiftRing(const TimeshiftRing&) = delete;
+    TimeshiftRing& operator=(const TimeshiftRing&) = delete;
+
+    bool isValid() const;
+
+    /**
+     * @brief Append stream data
+     * @param streamTimeMs Stream time at the first byte
+     * @param durationMs Stream time the data covers, 0 for data arriving as it plays
+     * @param startPoint Playback may start at the first byte (an HLS segment start);
+     *        continuous streams are indexed every INDEX_INTERVAL_MS regardless
+     */
+    void append(const QByteArray& data, qint64 streamTimeMs, qint64 durationMs, bool startPoint);
+
+    /**
+     * @brief Read up to maxBytes from an offset inside [start(), end())
+     */
+    QByteArray read(qint64 offset, qint64 maxBytes) const;
+
+    qint64 start() const;
+    qint64 end() const;
+
+    /**
+     * @brief Stream time covered between start() and the live edge
+     */
+    qint64 availableMs() const;
+
+    /**
+     * @brief Get the last start point at least behindMs behind the live edge, start() if none
+     */
+    qint64 offsetBehindLive(qint64 behindMs) const;
+
+    /**
+     * @brief Get how far a reader at an offset trails the live edge
+     */
+    qint64 behindLiveMs(qint64 offset) const;
+
+    /**
+     * @brief Data every reader gets before its first byte (EXT-X-MAP of fMP4 HLS)
+     */
+    void setInitSegment(const QByteArray& data);
+    QByteArray initSegment() const;
+
+    void setDuration(qint64 durationMs);
+
+private:
+    struct IndexEntry {
+        qint64 offset;
+        qint64 streamTimeMs;
+    };
+
+    void trim();
+    void flush();
+
+    mutable QMutex m_mutex;
+    mutable QFile m_file;
+    qint64 m_durationMs;
+    const qint64 m_maxBytes;
+
+    std::deque<IndexEntry> m_index;
+    qint64 m_start = 0;
+    qint64 m_end = 0;
+    qint64 m_liveTimeMs = 0;            // Stream time at m_end
+
+    QByteArray m_head;                  // Bytes from m_headStart to m_end
+    qint64 m_headStart = 0;
+    qint64 m_flushed = 0;               // Bytes before this offset are in the file
+    QByteArray m_initSegment;
+};
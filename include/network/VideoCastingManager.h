@@ -17,6 +17,10 @@
 #endif
 #include <memory>
 
+class CastTranscoder;
+class RemoteStatePublisher;
+enum class HardwareAccelerationType;
+
 /**
  * @brief Video casting and streaming management system
  * 
@@ -67,6 +71,7 @@ public:
         QString sessionId;         // Session ID
         CastingDevice device;      // Target device
         QString mediaUrl;          // Media URL being cast
+        QString streamUrl;         // URL the device plays, the transcode server's when transcoding
         QString mediaTitle;        // Media title
         qint64 position;          // Current position in milliseconds
         qint64 duration;          // Total duration in milliseconds
@@ -230,6 +235,13 @@ public:
      */
     int getConnectedClients() const;
 
+    /**
+     * @brief Set the play queue shown on remotes
+     * @param titles Queue entry titles
+     * @param currentIndex Index of the playing entry, -1 for none
+     */
+    void setRemoteQueue(const QStringList& titles, int currentIndex);
+
     // DLNA/UPnP specific
     /**
      * @brief Get DLNA media server URL
@@ -262,6 +274,25 @@ public:
      */
     void setChromecastAppId(const QString& appId);
 
+    // Transcoding
+    /**
+     * @brief Remux or transcode media the target device cannot play
+     * @param enabled Transcoding state; when off the device always gets the media URL
+     */
+    void setTranscodingEnabled(bool enabled);
+
+    /**
+     * @brief Check if transcoding is enabled
+     * @return true if enabled
+     */
+    bool isTranscodingEnabled() const;
+
+    /**
+     * @brief Set the hardware encoder backend used for transcoded video
+     * @param type Acceleration type, Auto for the platform's
+     */
+    void setTranscodeAcceleration(HardwareAccelerationType type);
+
 signals:
     /**
      * @brief Emitted when device discovery starts
@@ -376,9 +407,11 @@ private:
     QNetworkAccessManager* m_networkManager;
     QUdpSocket* m_udpSocket;
     QTcpServer* m_tcpServer;
+    CastTranscoder* m_transcoder;
 #ifdef HAVE_QT_WEBSOCKETS
     QWebSocketServer* m_webSocketServer;
     QVector<QWebSocket*> m_connectedClients;
+    RemoteStatePublisher* m_statePublisher;
 #endif
 
     // Discovery state
@@ -399,6 +432,7 @@ private:
     // Configuration
     QString m_dlnaDeviceDescription;
     QString m_chromecastAppId;
+    bool m_transcodingEnabled;
 
     // Thread safety
     mutable QMutex m_deviceMutex;
@@ -5,18 +5,30 @@
 #include <QStringList>
 #include <QMap>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QRegularExpression>
+#include <QVariantMap>
+#include <memory>
+#include "PowerPolicy.h"
 
 #ifdef Q_OS_LINUX
 #include <QDBusConnection>
 #include <QDBusInterface>
 #endif
 
+class QTimer;
+class IMediaEngine;
+class MprisPlayerAdaptor;
+
 /**
  * @brief Linux-specific platform integration and system features
  * 
  * Provides MPRIS D-Bus interface, XDG MIME type registration, VA-API/VDPAU
  * hardware acceleration, desktop integration, and package generation for EonPlay.
+ * MPRIS clients read the position on demand; PropertiesChanged carries only
+ * values that changed and Seeked only jumps.
+ * Battery state comes from UPower and power-profiles-daemon on the system
+ * bus, temperatures from the kernel's thermal zones.
  */
 class LinuxPlatform : public QObject
 {
@@ -71,6 +83,14 @@ public:
         QStringList genre;
         int trackNumber = 0;
         QDateTime lastUsed;
+
+        bool operator==(const MPRISMetadata& other) const
+        {
+            return trackId == other.trackId && title == other.title && artist == other.artist
+                && album == other.album && albumArt == other.albumArt && length == other.length
+                && genre == other.genre && trackNumber == other.trackNumber;
+        }
+        bool operator!=(const MPRISMetadata& other) const { return !(*this == other); }
     };
 
     explicit LinuxPlatform(QObject *parent = nullptr);
@@ -82,8 +102,16 @@ public:
     bool isMPRISActive() const;
     void updateMPRISMetadata(const MPRISMetadata& metadata);
     void updateMPRISPlaybackStatus(const QString& status); // Playing, Paused, Stopped
-    void updateMPRISPosition(qint64 position); // microseconds
+    void updateMPRISPosition(qint64 position); // microseconds; only jumps reach D-Bus
     void setMPRISCanControl(bool canPlay, bool canPause, bool canSeek, bool canGoNext, bool canGoPrevious);
+    
+    /**
+     * @brief Follow an engine's state, position and rate for MPRIS
+     *
+     * Position is then read from the engine's interpolating clock when a
+     * client asks, and seeks are reported from its position jumps.
+     */
+    void setMPRISMediaEngine(std::shared_ptr<IMediaEngine> engine);
 
     // XDG MIME type registration
     bool registerMimeTypes(const QList<MimeTypeAssociation>& associations);
@@ -132,6 +160,12 @@ public:
     QStringList getSystemThemes() const;
     QString getCurrentTheme() const;
 
+    // Power and thermal state
+    bool startPowerMonitoring();
+    void stopPowerMonitoring();
+    bool isPowerMonitoringActive() const { return m_powerMonitoring; }
+    PowerStatus powerStatus() const { return m_powerStatus; }
+
     // Notifications
     bool showDesktopNotification(const QString& title, const QString& message, 
                                 const QString& iconName = QString(), int timeout = 5000);
@@ -156,10 +190,13 @@ signals:
     void packageGenerationProgress(int percentage);
     void packageGenerationCompleted(const QString& filePath);
     void packageSigningCompleted(bool success);
+    void powerStatusChanged(const PowerStatus& status);
 
 private slots:
     void onMPRISMethodCall(const QString& method, const QVariantList& arguments);
-    void onMPRISPropertyChanged(const QString& property, const QVariant& value);
+    void onPowerPropertiesChanged(const QString& interface, const QVariantMap& changed,
+                                  const QStringList& invalidated);
+    void refreshThermalState();
 
 private:
     // MPRIS helpers
@@ -167,7 +204,12 @@ private:
     void registerMPRISService();
     void unregisterMPRISService();
     void handleMPRISCommand(const QString& command);
-    QVariantMap getMPRISMetadata() const;
+    QVariantMap getMPRISMetadata() const { return m_mprisMetadataMap; }
+    static QVariantMap buildMPRISMetadata(const MPRISMetadata& metadata);
+    void emitMPRISPropertiesChanged(const QVariantMap& changed);
+    void reportMPRISPosition(qint64 position);
+    qint64 mprisPosition() const;
+    qint64 extrapolatedMPRISPosition() const;
     
     // MIME type helpers
     QString generateMimeTypeXML(const MimeTypeAssociation& assoc) const;
@@ -181,8 +223,9 @@ private:
     bool installDesktopFile(const QString& content);
     
     // Hardware acceleration helpers
-    bool checkVAAPISupport();
-    bool checkVDPAUSupport();
+    void ensureHardwareSupportChecked() const;
+    bool checkVAAPISupport() const;
+    bool checkVDPAUSupport() const;
     QStringList scanVAAPIDevices() const;
     QStringList scanVDPAUDevices() const;
     
@@ -197,6 +240,11 @@ private:
     bool signWithGPG(const QString& filePath, const QString& keyId);
     bool verifyGPGSignature(const QString& filePath) const;
     
+    // Power helpers
+    void refreshPowerStatus();
+    void publishPowerStatus(const PowerStatus& status);
+    static int readHottestThermalZone();
+    
     // System detection helpers
     QString readFileContent(const QString& filePath) const;
     QString executeCommand(const QString& command) const;
@@ -206,20 +254,30 @@ private:
     bool m_mprisActive;
     bool m_vaApiEnabled;
     bool m_vdpauEnabled;
-    bool m_vaApiSupported;
-    bool m_vdpauSupported;
+    mutable bool m_vaApiSupported;
+    mutable bool m_vdpauSupported;
+    mutable bool m_hardwareSupportChecked;
     
-    QDBusInterface* m_mprisInterface;
+    QObject* m_mprisObject;             // Carries the exported adaptors
+    MprisPlayerAdaptor* m_mprisPlayer;
     QDBusConnection m_dbusConnection;
     
     MPRISMetadata m_currentMetadata;
+    QVariantMap m_mprisMetadataMap;     // Built once per track
     QString m_playbackStatus;
-    qint64 m_currentPosition;
+    qint64 m_currentPosition;           // Last known position, microseconds
+    QElapsedTimer m_positionClock;      // Time since m_currentPosition
+    std::shared_ptr<IMediaEngine> m_mprisEngine;
     
     QList<MimeTypeAssociation> m_registeredMimeTypes;
     DesktopEntry m_installedDesktopEntry;
     DesktopEnvironment m_desktopEnvironment;
     
+    // Power monitoring
+    bool m_powerMonitoring;
+    PowerStatus m_powerStatus;
+    QTimer* m_thermalTimer;
+    
     // Capabilities
     bool m_canPlay;
     bool m_canPause;
@@ -234,4 +292,9 @@ private:
     static const QString MPRIS_PLAYER_INTERFACE;
     static const QString DESKTOP_FILE_NAME;
     static const QString MIME_TYPES_DIR;
+    static constexpr int THERMAL_POLL_INTERVAL_MS = 10000;
+    static constexpr qint64 SEEK_THRESHOLD_US = 1000000;    // Smaller drift is not a seek
+
+    friend class MprisRootAdaptor;
+    friend class MprisPlayerAdaptor;
 };
\ No newline at end of file
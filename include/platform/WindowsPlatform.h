@@ -7,6 +7,9 @@
 #include <QSystemTrayIcon>
 #include <QMenu>
 #include <QStyle>
+#include <functional>
+#include <memory>
+#include "PowerPolicy.h"
 
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -15,11 +18,16 @@
 #include <winreg.h>
 #endif
 
+class QAbstractNativeEventFilter;
+class QTimer;
+
 /**
  * @brief Windows-specific platform integration and system features
  * 
  * Provides Windows system tray integration, media key support, file associations,
  * DXVA hardware acceleration, and installer package generation for EonPlay.
+ * Battery state comes from GetSystemPowerStatus(), refreshed when Windows
+ * broadcasts a power change.
  */
 class WindowsPlatform : public QObject
 {
@@ -70,6 +78,15 @@ public:
     void unregisterMediaKeys();
     bool isMediaKeysRegistered() const;
     void enableMediaKeyHandling(bool enabled);
+    
+    /**
+     * @brief Hand media key presses to a callback as Qt key codes
+     *
+     * Called straight from the hotkey window procedure, ahead of the
+     * mediaKeyPressed signal, so it must not block; HotkeyManager's
+     * postGlobalKey is meant for this.
+     */
+    void setMediaKeySink(std::function<void(int key)> sink);
 
     // File associations
     bool registerFileAssociations(const QList<FileAssociation>& associations);
@@ -120,6 +137,12 @@ public:
     bool setAutorun(bool enabled);
     bool isAutorunEnabled() const;
 
+    // Power state
+    bool startPowerMonitoring();
+    void stopPowerMonitoring();
+    bool isPowerMonitoringActive() const { return m_powerMonitoring; }
+    PowerStatus powerStatus() const { return m_powerStatus; }
+
     // Windows notifications
     void showToastNotification(const QString& title, const QString& message, 
                               const QString& iconPath = QString());
@@ -134,10 +157,12 @@ signals:
     void installerGenerationProgress(int percentage);
     void installerGenerationCompleted(const QString& filePath);
     void codeSigningCompleted(bool success);
+    void powerStatusChanged(const PowerStatus& status);
 
 private slots:
     void onSystemTrayActivated(QSystemTrayIcon::ActivationReason reason);
     void onMediaKeyMessage();
+    void refreshPowerStatus();
 
 private:
     // System tray helpers
@@ -177,12 +202,18 @@ private:
     SystemTrayConfig m_trayConfig;
     
     bool m_mediaKeysRegistered;
+    std::function<void(int key)> m_mediaKeySink;
     bool m_dxvaEnabled;
     bool m_dxvaSupported;
     
     QList<FileAssociation> m_registeredAssociations;
     QMap<int, QString> m_registeredHotKeys;
     
+    bool m_powerMonitoring;
+    PowerStatus m_powerStatus;
+    QTimer* m_powerTimer;
+    std::unique_ptr<QAbstractNativeEventFilter> m_powerEventFilter;
+    
 #ifdef Q_OS_WIN
     HWND m_messageWindow;
     static LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -198,4 +229,5 @@ private:
     static const int HOTKEY_STOP = 2;
     static const int HOTKEY_NEXT = 3;
     static const int HOTKEY_PREVIOUS = 4;
+    static constexpr int POWER_POLL_INTERVAL_MS = 60000;     // Backstop for missed broadcasts
 };
\ No newline at end of file
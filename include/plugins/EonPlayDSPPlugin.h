@@ -0,0 +1,101 @@
+#ifndef EONPLAYDSPPLUGIN_H
+#define EONPLAYDSPPLUGIN_H
+
+/*
+ * EonPlay native DSP plugin ABI
+ *
+ * A plain C interface, so plugins can be built with any compiler or
+ * language that produces a shared library with C linkage. A plugin exports
+ * one function, EONPLAY_DSP_ENTRY_SYMBOL, returning a static descriptor.
+ * The host checks the plugin with SecurityManager before loading it and
+ * runs each instance as a node of AudioDSPGraph.
+ *
+ * Threads:
+ *  - create, destroy, prepare and latency are called from a control thread
+ *    and may allocate, lock and block.
+ *  - process is called from the audio thread and must not.
+ *  - The host never calls into one instance from two threads at once: a
+ *    format change prepares a fresh instance while the current one keeps
+ *    playing, and the audio thread switches over between two blocks.
+ *
+ * Blocks are planar float, processed in place. Each channel pointer is
+ * aligned to EONPLAY_DSP_ALIGNMENT bytes, and a block never holds more
+ * frames than announced to prepare(), so aligned SIMD loads and stores
+ * may be used on every channel from the first frame on.
+ *
+ * Parameter changes made on the control thread travel to the audio thread
+ * through a lock-free queue and reach the plugin with the next block; the
+ * plugin never sees a parameter change outside process(). A fresh instance
+ * receives every parameter's current value with its first block.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EONPLAY_DSP_ABI_VERSION 1u
+#define EONPLAY_DSP_ALIGNMENT 32
+#define EONPLAY_DSP_ENTRY_SYMBOL "eonplay_dsp_plugin_entry"
+
+#if defined(_WIN32)
+#define EONPLAY_DSP_EXPORT __declspec(dllexport)
+#else
+#define EONPLAY_DSP_EXPORT __attribute__((visibility("default")))
+#endif
+
+/* A parameter the plugin exposes; values are plain floats in [minValue, maxValue] */
+typedef struct EonPlayDspParameter {
+    uint32_t id;
+    const char* name;
+    float minValue;
+    float maxValue;
+    float defaultValue;
+} EonPlayDspParameter;
+
+/* A parameter value to apply from the start of the block it arrives with */
+typedef struct EonPlayDspParameterChange {
+    uint32_t id;
+    float value;
+} EonPlayDspParameterChange;
+
+/* One planar block, processed in place */
+typedef struct EonPlayDspBlock {
+    float* const* channels;                             /* channelCount aligned pointers */
+    uint32_t channelCount;
+    uint32_t frames;                                    /* At most maxFrames from prepare() */
+    uint32_t sampleRate;
+    const EonPlayDspParameterChange* parameterChanges;  /* In the order they were made */
+    uint32_t parameterChangeCount;
+} EonPlayDspBlock;
+
+typedef struct EonPlayDspDescriptor {
+    uint32_t abiVersion;                                /* EONPLAY_DSP_ABI_VERSION */
+    uint32_t structSize;                                /* sizeof(EonPlayDspDescriptor) */
+    const char* id;                                     /* Stable, e.g. "com.vendor.reverb" */
+    const char* name;
+    const char* vendor;
+    uint32_t parameterCount;
+    const EonPlayDspParameter* parameters;
+
+    /* Control thread */
+    void* (*create)(void);
+    void (*destroy)(void* instance);
+    /* Size buffers for a format; returns 0 on success */
+    int (*prepare)(void* instance, uint32_t sampleRate, uint32_t maxChannels, uint32_t maxFrames);
+    /* Frames the output lags the input by, valid after prepare() */
+    uint32_t (*latency)(void* instance);
+
+    /* Audio thread */
+    void (*process)(void* instance, const EonPlayDspBlock* block);
+} EonPlayDspDescriptor;
+
+/* The exported entry point; returns null if hostAbiVersion is not supported */
+typedef const EonPlayDspDescriptor* (*EonPlayDspEntryFunction)(uint32_t hostAbiVersion);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EONPLAYDSPPLUGIN_H */
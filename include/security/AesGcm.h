@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * @brief AES-256-GCM authenticated encryption
+ *
+ * Runs on AES-NI with PCLMULQDQ on x86 CPUs that have them (checked at
+ * run time) and on the ARMv8 cryptography extensions when the build
+ * targets them; elsewhere a portable implementation is used. The key
+ * schedule and the GHASH key powers are computed once per key, so an
+ * object kept for the session seals a short setting and a large blob
+ * without set-up cost. The hardware paths encrypt and hash four blocks
+ * per iteration over cache-sized slices, fast enough that bulk data is
+ * limited by memory rather than by the cipher.
+ *
+ * encrypt() / decrypt() seal a buffer as nonce || ciphertext || tag with a
+ * random 96-bit nonce. encryptFile() / decryptFile() stream files of any
+ * size in CHUNK_SIZE chunks, each sealed separately, such that chunks
+ * cannot be reordered, dropped or cut off without decryption failing.
+ */
+class AesGcm
+{
+public:
+    static constexpr int KEY_SIZE = 32;
+    static constexpr int NONCE_SIZE = 12;
+    static constexpr int TAG_SIZE = 16;
+    static constexpr int CHUNK_SIZE = 1024 * 1024;
+    static constexpr int DEFAULT_KDF_ITERATIONS = 100000;
+
+    AesGcm() = default;
+    explicit AesGcm(const QByteArray& key);
+    ~AesGcm();
+
+    /**
+     * @brief Set the key and precompute its schedule
+     * @return false, leaving the object invalid, unless key is KEY_SIZE bytes
+     */
+    bool setKey(const QByteArray& key);
+    void clear();
+    bool isValid() const { return m_valid; }
+
+    /**
+     * @brief Seal a buffer with a random nonce
+     * @return nonce || ciphertext || tag; empty if no key is set
+     */
+    QByteArray encrypt(const QByteArray& plaintext, const QByteArray& associatedData = QByteArray()) const;
+
+    /**
+     * @brief Open a buffer sealed by encrypt()
+     * @return false if no key is set or the data or associated data were altered
+     */
+    bool decrypt(const QByteArray& sealed, QByteArray* plaintext,
+                 const QByteArray& associatedData = QByteArray()) const;
+
+    /**
+     * @brief Encrypt size bytes from in to out, which may be the same buffer
+     */
+    void encrypt(const uchar* nonce, const uchar* associatedData, qsizetype associatedSize,
+                 const uchar* in, uchar* out, qsizetype size, uchar* tag) const;
+
+    /**
+     * @brief Decrypt size bytes from in to out, which may be the same buffer
+     * @return false if the tag does not match; out must then be discarded
+     */
+    bool decrypt(const uchar* nonce, const uchar* associatedData, qsizetype associatedSize,
+                 const uchar* in, uchar* out, qsizetype size, const uchar* tag) const;
+
+    /**
+     * @brief Encrypt a file chunk by chunk
+     * @param header Stored in the clear and authenticated, e.g. a key derivation salt
+     * @param checksum Receives the SHA-256 of the written file, hex
+     */
+    bool encryptFile(const QString& sourcePath, const QString& targetPath, const QByteArray& header = QByteArray(),
+                     QString* checksum = nullptr, QString* error = nullptr) const;
+    bool decryptFile(const QString& sourcePath, const QString& targetPath, QString* error = nullptr) const;
+
+    static bool isEncryptedFile(const QString& filePath);
+
+    /**
+     * @brief Header an encrypted file was written with, readable without the key
+     */
+    static QByteArray fileHeader(const QString& filePath);
+
+    /**
+     * @brief PBKDF2-HMAC-SHA256 of a passphrase, KEY_SIZE bytes
+     */
+    static QByteArray deriveKey(const QByteArray& passphrase, const QByteArray& salt,
+                                int iterations = DEFAULT_KDF_ITERATIONS);
+
+    /**
+     * @brief Name of the implementation in use: "AES-NI", "ARMv8 Crypto" or "Portable"
+     */
+    static QString implementation();
+    static bool isHardwareAccelerated();
+
+    /**
+     * @brief Allow the hardware implementation, on by default
+     *
+     * Off forces the portable implementation, e.g. to check one against the
+     * other. Objects keep the implementation their key was set with.
+     */
+    static void setHardwareAccelerationEnabled(bool enabled);
+
+private:
+    void crypt(const uchar* nonce, const uchar* associatedData, qsizetype associatedSize,
+               const uchar* in, uchar* out, qsizetype size, uchar* tag, bool encrypting) const;
+
+    alignas(16) uchar m_roundKeys[15 * 16] = {};
+    alignas(16) uchar m_hashPowers[4 * 16] = {};    // H^1..H^4 in the implementation's representation
+    bool m_hardware = false;                        // Which implementation m_hashPowers is for
+    bool m_valid = false;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QtGlobal>
+#include <atomic>
+
+/**
+ * @brief Shared-memory layout between the player and a sandboxed decoder worker
+ *
+ * The player creates one segment per worker before spawning it, so nothing
+ * is allocated or mapped when a file is opened. The segment holds:
+ *
+ * - A Header with the state of each video slot and the audio counters.
+ * - An SPSC byte ring of interleaved S16 audio at AUDIO_RATE, written by
+ *   the worker's libVLC audio callback and read by the player's audio sink.
+ * - VIDEO_SLOTS RGB32 pictures of up to MAX_WIDTH x MAX_HEIGHT. libVLC
+ *   decodes straight into a free slot; the player wraps a ready slot in a
+ *   VideoFrame and frees it when the last reference goes away.
+ *
+ * Slots only move Free -> Writing -> Ready (worker) and Ready -> Held ->
+ * Free (player), so each transition has a single writer. The worker
+ * announces each ready slot with its format on its stdout pipe, which
+ * wakes the player without polling.
+ */
+struct DecoderSandboxChannel
+{
+    static constexpr quint32 MAGIC = 0x454f4e44;   // "EOND"
+    static constexpr quint32 VERSION = 1;
+
+    static constexpr int VIDEO_SLOTS = 4;
+    static constexpr int MAX_WIDTH = 3840;          // Larger pictures are scaled down by libVLC
+    static constexpr int MAX_HEIGHT = 2160;
+    static constexpr qint64 SLOT_BYTES = qint64(MAX_WIDTH) * 4 * MAX_HEIGHT;
+
+    static constexpr int AUDIO_RATE = 48000;
+    static constexpr int AUDIO_CHANNELS = 2;
+    static constexpr int AUDIO_FRAME_BYTES = AUDIO_CHANNELS * 2;
+    static constexpr quint32 AUDIO_RING_BYTES = 1u << 20;   // About 5 s
+
+    enum SlotState : quint32 {
+        SlotFree,
+        SlotWriting,    // Worker decoding into it
+        SlotReady,      // Announced to the player
+        SlotHeld        // Referenced by VideoFrames in the player
+    };
+
+    struct VideoSlot {
+        std::atomic<quint32> state;
+        qint64 position;                    // Media time of the picture, written before Ready
+    };
+
+    struct Header {
+        quint32 magic;
+        quint32 version;
+        VideoSlot slots[VIDEO_SLOTS];
+        std::atomic<quint64> audioWritten;  // Worker only
+        std::atomic<quint64> audioRead;     // Player only
+    };
+
+    static_assert(std::atomic<quint32>::is_always_lock_free && std::atomic<quint64>::is_always_lock_free,
+                  "Atomics shared between processes must not use a lock");
+
+    static constexpr qint64 audioOffset() { return (qint64(sizeof(Header)) + 63) & ~qint64(63); }
+    static constexpr qint64 videoOffset() { return audioOffset() + AUDIO_RING_BYTES; }
+    static constexpr qint64 totalBytes() { return videoOffset() + VIDEO_SLOTS * SLOT_BYTES; }
+
+    static Header* header(void* base) { return static_cast<Header*>(base); }
+    static uchar* audioRing(void* base) { return static_cast<uchar*>(base) + audioOffset(); }
+    static uchar* slotData(void* base, int slot) { return static_cast<uchar*>(base) + videoOffset() + slot * SLOT_BYTES; }
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @brief What one inspection of a media file found
+ *
+ * Holds facts, not policy: each consumer applies its own extension list and
+ * size limit to the same result.
+ */
+struct FileValidationResult
+{
+    QString path;                   // Absolute path
+    bool exists = false;
+    bool readable = false;
+    qint64 size = 0;
+    qint64 modified = 0;            // Milliseconds since epoch
+    QString suffix;                 // Lower case
+    QByteArray header;              // Up to MediaFileValidator::HEADER_BYTES
+    QString mimeType;               // From the name and the header
+    bool hasMediaSignature = false; // Header is a known container or stream
+    bool matchesExtension = false;  // Header fits the extension, or is not executable for others
+    bool looksExecutable = false;
+
+    /**
+     * @brief Check if another result describes the same version of the file
+     */
+    bool isSameVersion(const FileValidationResult& other) const
+    {
+        return path == other.path && size == other.size && modified == other.modified;
+    }
+};
+
+/**
+ * @brief Single-pass media file inspection shared by every open path
+ *
+ * FileUrlSupport, SecurityManager and VLCBackend used to stat the file and
+ * read its header separately. validate() does both once and caches the
+ * result by path, size and modification time, so re-opening an unchanged
+ * file costs one stat. Thread-safe.
+ */
+class MediaFileValidator
+{
+public:
+    static MediaFileValidator& instance();
+
+    /**
+     * @brief Inspect a file, or return the cached result if it is unchanged
+     * @param filePath Local path
+     */
+    FileValidationResult validate(const QString& filePath);
+
+    /**
+     * @brief Forget the cached result of a file
+     */
+    void invalidate(const QString& filePath);
+
+    /**
+     * @brief Forget all cached results
+     */
+    void clear();
+
+    /**
+     * @brief Check for a known media container or stream signature
+     */
+    static bool hasMediaSignature(const QByteArray& header);
+
+    /**
+     * @brief Check that a header fits the file extension
+     *
+     * Known extensions need their signature; anything else only must not be
+     * an executable.
+     */
+    static bool matchesExtension(const QByteArray& header, const QString& suffix);
+
+    static bool looksExecutable(const QByteArray& header);
+
+    static constexpr int HEADER_BYTES = 512;
+
+private:
+    MediaFileValidator();
+
+    static FileValidationResult inspect(const QString& path, qint64 size, qint64 modified);
+
+    QMutex m_mutex;
+    QCache<QString, FileValidationResult> m_cache;
+
+    static constexpr int CACHE_ENTRIES = 512;
+};
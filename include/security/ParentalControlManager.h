@@ -6,6 +6,16 @@
 #include <QTimer>
 #include <QStringList>
 #include <QMap>
+#include <QHash>
+#include <QSet>
+
+class QSqlDatabase;
+
+namespace EonPlay {
+namespace Data {
+class DatabaseManager;
+}
+}
 
 /**
  * @brief Comprehensive parental control and content filtering system
@@ -115,6 +125,22 @@ public:
     QString getRatingDescription(ContentRating rating) const;
     QStringList getBlockedReasons(const QString& filePath) const;
 
+    /**
+     * @brief Keep the library's verdicts for every restricted profile in the database
+     *
+     * Verdicts go to the content_verdicts table on the database's writer
+     * thread: all of a profile's when its filters change, and those of new
+     * files as they are scanned in. Library views then filter in SQL through
+     * MediaQueryCursor::Filter::allowedForProfile instead of asking per row.
+     */
+    void setDatabaseManager(EonPlay::Data::DatabaseManager* dbManager);
+    void refreshContentVerdicts(const QString& profileId);
+
+    /**
+     * @brief Profile library queries should be filtered by; empty if nothing is filtered
+     */
+    QString getContentVerdictProfile() const;
+
     // Time restrictions
     bool isAccessAllowed() const;
     bool isTimeAllowed() const;
@@ -172,10 +198,12 @@ signals:
     void parentalApprovalDenied(const QString& content);
     void usageLimitReached(const QString& limitType);
     void supervisionRequired(const QString& action);
+    void contentVerdictsUpdated(const QString& profileId);
 
 private slots:
     void onUsageTimerTimeout();
     void onAutoLockTimerTimeout();
+    void onMediaFilesChanged(const QStringList& filePaths);
 
 private:
     // Profile management helpers
@@ -184,6 +212,39 @@ private:
     void loadUserProfiles();
     UserProfile createDefaultProfile(const QString& name, const QDateTime& birthDate);
     
+    // Content verdicts
+    enum ContentVerdict : quint8 {
+        VERDICT_ALLOWED,
+        VERDICT_RATING_TOO_HIGH,
+        VERDICT_BLOCKED_KEYWORD
+    };
+
+    enum VerdictScope {
+        VERDICTS_ALL_FILES,         // Replace the profile's verdicts
+        VERDICTS_MISSING_FILES,     // Files without a verdict yet
+        VERDICTS_LISTED_FILES
+    };
+
+    // A profile's content filter compiled for per-file checks; safe to use from any thread
+    struct ContentMatcher {
+        bool unrestricted = true;
+        ContentRating maxRating = RATING_UNRATED;
+        QSet<QString> blockedKeywords;  // Lower case
+
+        ContentVerdict evaluate(const QString& filePath) const;
+        bool containsBlockedKeyword(const QString& title) const;
+        QByteArray digest() const;
+        bool operator==(const ContentMatcher& other) const;
+    };
+
+    static ContentMatcher compileMatcher(const UserProfile& profile);
+    static ContentRating ratingFromFileName(const QString& fileName);
+    static bool writeContentVerdicts(QSqlDatabase& database, const QHash<QString, ContentMatcher>& matchers,
+                                     VerdictScope scope, const QStringList& filePaths = QStringList());
+    void updateActiveMatcher();
+    void updateContentVerdicts(const QString& profileId, VerdictScope scope);
+    QHash<QString, ContentMatcher> restrictedMatchers() const;
+
     // Content analysis helpers
     ContentRating analyzeContentRating(const QString& filePath) const;
     QStringList extractKeywords(const QString& title, const QString& description) const;
@@ -222,6 +283,11 @@ private:
     QString m_defaultProfileId;
     QMap<QString, UserProfile> m_userProfiles;
     
+    // Content verdicts
+    EonPlay::Data::DatabaseManager* m_dbManager;
+    ContentMatcher m_activeMatcher;
+    QHash<QString, quint8> m_verdicts;          // Active matcher's verdicts by file path
+    
     // Security
     QString m_parentalPinHash;
     int m_autoLockTimeoutMinutes;
@@ -244,4 +310,7 @@ private:
     static const int DEFAULT_AUTO_LOCK_MINUTES = 30;
     static const int MAX_ACTIVITY_LOG_SIZE = 1000;
     static const int MAX_RECENT_WATCHED = 100;
+    static const int MAX_CACHED_VERDICTS = 200000;
+    static const int MAX_BOUND_PATHS = 500;     // Stay below SQLite's variable limit
+    static const int VERDICT_RULES_VERSION = 1; // Bump when evaluate() changes
 };
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+
+/**
+ * @brief Multi-pattern literal matcher (Aho-Corasick automaton)
+ *
+ * All patterns are compiled into one byte-level automaton, so content is
+ * scanned once however many patterns there are. Scans resume from a state,
+ * which lets callers feed a buffer in chunks or entry by entry. Case-
+ * insensitive matching folds ASCII only; UTF-16 text is scanned by code
+ * unit, and units above 0xFF never match.
+ */
+class PatternScanner
+{
+public:
+    PatternScanner() = default;
+
+    /**
+     * @brief Compile the automaton
+     * @param patterns Literal byte patterns; empty ones are ignored
+     * @param caseSensitivity Qt::CaseInsensitive folds A-Z to a-z
+     */
+    explicit PatternScanner(const QList<QByteArray>& patterns,
+                            Qt::CaseSensitivity caseSensitivity = Qt::CaseSensitive);
+
+    /**
+     * @brief Compile from ASCII strings
+     */
+    static PatternScanner fromStrings(const QStringList& patterns,
+                                      Qt::CaseSensitivity caseSensitivity = Qt::CaseSensitive);
+
+    bool isEmpty() const { return m_patterns.isEmpty(); }
+    int patternCount() const { return m_patterns.size(); }
+    QByteArray pattern(int index) const { return m_patterns.value(index); }
+
+    /**
+     * @brief Scan a chunk, continuing from a previous one
+     * @param data Chunk to scan
+     * @param state Automaton state; 0 to start, updated for the next chunk
+     * @return Index of the first pattern found, -1 if none
+     */
+    int scan(QByteArrayView data, int& state) const;
+    int scan(QStringView text, int& state) const;
+
+    /**
+     * @brief Find the first pattern in data
+     * @return Pattern index, -1 if none occurs
+     */
+    int findFirst(QByteArrayView data) const;
+    int findFirst(QStringView text) const;
+
+    bool containsAny(QByteArrayView data) const { return findFirst(data) >= 0; }
+    bool containsAny(QStringView text) const { return findFirst(text) >= 0; }
+
+    /**
+     * @brief Find every pattern that occurs in data
+     * @return Sorted pattern indices
+     */
+    QList<int> findAll(QByteArrayView data) const;
+
+private:
+    static constexpr int ALPHABET = 256;
+
+    int next(int state, uchar symbol) const { return m_transitions[state * ALPHABET + symbol]; }
+
+    QList<QByteArray> m_patterns;
+    QVector<int> m_transitions;     // Full DFA: state * ALPHABET + byte -> state
+    QVector<int> m_match;           // Pattern ending at a state, -1 if none
+    QVector<int> m_fail;            // Longest proper suffix state, for findAll()
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <memory>
+#include "media/VideoFrame.h"
+
+class QAudioSink;
+class QProcess;
+class SandboxAudioDevice;
+
+/**
+ * @brief One eonplay-decoder worker process, decoding a single file
+ *
+ * Handed out by SandboxedDecoderPool already running with libVLC loaded.
+ * Pictures arrive as VideoFrames pointing into the shared-memory channel,
+ * so nothing is copied between the processes; a slot returns to the worker
+ * when the last reference to its frame is dropped. Audio is pulled from the
+ * channel's ring by a QAudioSink in this process.
+ *
+ * Everything the worker sends is treated as hostile: malformed lines or
+ * frames that do not fit their slot end the worker. A worker is never
+ * reused for another file; destroying the decoder kills it.
+ */
+class SandboxedDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class State {
+        Starting,       // Worker loading libVLC
+        Idle,
+        Playing,
+        Paused,
+        Stopped,
+        Ended,
+        Failed
+    };
+
+    ~SandboxedDecoder() override;
+
+    bool open(const QString& path);
+    void play();
+    void pause();
+    void stop();
+    void seek(qint64 position);
+    void setVolume(int volume);
+
+    State state() const { return m_state; }
+    qint64 position() const { return m_position; }
+    qint64 duration() const { return m_duration; }
+    bool hasVideo() const { return m_hasVideo; }
+    QString path() const { return m_path; }
+
+    /**
+     * @brief Receive pictures on this object's thread, shared with no copy
+     */
+    void setFrameCallback(std::function<void(const std::shared_ptr<VideoFrame>&)> callback);
+
+signals:
+    void ready();
+    void stateChanged(SandboxedDecoder::State state);
+    void positionChanged(qint64 position);
+    void durationChanged(qint64 duration);
+    void failed(const QString& message);
+
+private:
+    friend class SandboxedDecoderPool;
+    friend class SandboxAudioDevice;
+
+    struct Channel;
+
+    explicit SandboxedDecoder(QObject* parent = nullptr);
+
+    bool spawn(const QString& executable);
+    void send(const QByteArray& line);
+    void onReadyRead();
+    void onFinished();
+    bool handleEvent(const QByteArray& line);
+    bool deliverFrame(int slot, int width, int height, int bytesPerLine);
+    void setState(State state);
+    void fail(const QString& message);
+    void startAudio();
+
+    std::shared_ptr<Channel> m_channel;     // Kept alive by frames still referenced
+    QProcess* m_process;
+    QAudioSink* m_audioSink;
+    SandboxAudioDevice* m_audioDevice;
+    void* m_job;                            // Windows job object, closing it kills the worker
+    std::function<void(const std::shared_ptr<VideoFrame>&)> m_frameCallback;
+
+    State m_state;
+    QString m_path;
+    qint64 m_position;
+    qint64 m_duration;
+    bool m_hasVideo;
+    int m_volume;
+
+    static constexpr int MAX_LINE_BYTES = 4096;
+};
+
+/**
+ * @brief Pool of pre-spawned, privilege-dropped decoder worker processes
+ *
+ * A sandbox that starts a process per open would add the process start and
+ * libVLC's plugin loading to every file. The pool keeps poolSize() workers
+ * started ahead of time, each with its shared-memory channel mapped, so
+ * acquire() hands out a worker that only has to open the file. Every
+ * worker taken is replaced right away, and a worker that decoded a file is
+ * discarded rather than returned.
+ *
+ * shouldSandbox() decides which files go through the pool: downloads the
+ * operating system marks as coming from the internet, and anything under a
+ * directory added with addUntrustedDirectory().
+ */
+class SandboxedDecoderPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_POOL_SIZE = 2;
+
+    explicit SandboxedDecoderPool(QObject* parent = nullptr);
+    ~SandboxedDecoderPool() override;
+
+    /**
+     * @brief Spawn workers up to the pool size
+     */
+    void start();
+    void stop();
+    bool isRunning() const { return m_running; }
+
+    void setPoolSize(int size);
+    int poolSize() const { return m_poolSize; }
+
+    /**
+     * @brief Path of eonplay-decoder, by default next to the application
+     */
+    void setWorkerExecutable(const QString& path);
+    QString workerExecutable() const { return m_executable; }
+
+    /**
+     * @brief Take a worker; one still starting is taken if none is ready yet
+     * @return nullptr if no worker can be spawned
+     */
+    std::unique_ptr<SandboxedDecoder> acquire();
+
+    int readyWorkers() const;
+
+    /**
+     * @brief Check whether a local file should be decoded in a worker
+     */
+    bool shouldSandbox(const QString& path) const;
+    void addUntrustedDirectory(const QString& directory);
+    QStringList untrustedDirectories() const { return m_untrustedDirectories; }
+
+    /**
+     * @brief Check the download origin the OS records on a file
+     *
+     * The Zone.Identifier stream (Internet or restricted zone) on Windows,
+     * com.apple.quarantine on macOS, user.xdg.origin.url on Linux.
+     */
+    static bool isUntrustedDownload(const QString& path);
+
+private:
+    void refill();
+    void onWorkerFinished(SandboxedDecoder* decoder);
+    SandboxedDecoder* spawnWorker();
+
+    QList<SandboxedDecoder*> m_idle;        // Owned, starting or ready
+    QString m_executable;
+    QStringList m_untrustedDirectories;
+    int m_poolSize;
+    int m_spawnFailures;                    // Consecutive workers that died before becoming ready
+    bool m_running;
+
+    static constexpr int MAX_SPAWN_FAILURES = 3;
+};
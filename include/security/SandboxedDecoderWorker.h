@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QSharedMemory>
+#include <cstdint>
+#include <mutex>
+#include "security/DecoderSandboxChannel.h"
+
+struct libvlc_instance_t;
+struct libvlc_media_player_t;
+struct libvlc_event_t;
+
+/**
+ * @brief Decoder running in the eonplay-decoder worker process
+ *
+ * Spawned ahead of time by SandboxedDecoderPool. Before any thread exists
+ * the process gives up what a decoder does not need, then loads libVLC and
+ * reports "ready", so an open later costs no process start or plugin scan.
+ * The restrictions are best effort and logged where the platform refuses:
+ *
+ * - Linux: a new user and network namespace (no network), no new privileges
+ *   and not dumpable.
+ * - Unix: no core dumps, no file growth, a small descriptor limit.
+ * - Windows: the player puts the process in a restricted job object.
+ *
+ * Commands arrive as lines on stdin ("open <percent-encoded path>",
+ * "play", "pause", "stop", "seek <ms>", "quit"); events go out as lines on
+ * stdout ("ready", "frame <slot> <width> <height> <bytesPerLine>",
+ * "audioflush <counter>", "state <name>", "time <ms>", "length <ms>",
+ * "error <message>"). Pictures and audio never pass through the pipes; they
+ * are written into the DecoderSandboxChannel the player mapped.
+ */
+class SandboxedDecoderWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Entry point of the worker executable
+     */
+    static int run(int& argc, char** argv);
+
+    ~SandboxedDecoderWorker() override;
+
+private:
+    SandboxedDecoderWorker() = default;
+
+    static void dropPrivileges();
+
+    bool start(const QString& channelKey);
+    void handleCommand(const QByteArray& line);
+    void send(const QByteArray& line);
+
+    // libVLC callbacks (decoder threads)
+    static unsigned videoFormatCallback(void** opaque, char* chroma, unsigned* width, unsigned* height,
+                                        unsigned* pitches, unsigned* lines);
+    static void* videoLockCallback(void* opaque, void** planes);
+    static void videoDisplayCallback(void* opaque, void* picture);
+    static void audioPlayCallback(void* opaque, const void* samples, unsigned count, int64_t pts);
+    static void audioFlushCallback(void* opaque, int64_t pts);
+    static void eventCallback(const libvlc_event_t* event, void* opaque);
+
+    QSharedMemory m_memory;
+    DecoderSandboxChannel::Header* m_header = nullptr;
+    libvlc_instance_t* m_vlc = nullptr;
+    libvlc_media_player_t* m_player = nullptr;
+    std::mutex m_outputMutex;
+
+    // Decoder thread only
+    int m_width = 0;
+    int m_height = 0;
+    int m_bytesPerLine = 0;
+    int m_writingSlot = -1;
+    QByteArray m_dropBuffer;
+
+    static constexpr int AUDIO_WAIT_MS = 2;
+    static constexpr int AUDIO_WAIT_TRIES = 100;
+};
@@ -9,10 +9,17 @@
 #include <QFileSystemWatcher>
 #include <QDateTime>
 #include <QMap>
+#include <QHash>
+#include <QFuture>
+#include <QMutex>
 #include <QVariant>
+#include "security/AesGcm.h"
+#include "security/PatternScanner.h"
+#include "security/MediaFileValidator.h"
 #include <memory>
 
 class QSettings;
+class SandboxedDecoderPool;
 
 /**
  * @brief Comprehensive security manager for EonPlay
@@ -53,7 +60,10 @@ public:
         bool blocked = false;
     };
 
-    struct FileValidationResult {
+    /**
+     * @brief Security verdict on a media file, built from its FileValidationResult
+     */
+    struct FileSecurityReport {
         bool isValid = false;
         bool isSafe = false;
         QString mimeType;
@@ -71,6 +81,7 @@ public:
         bool isTrusted = false;
         QDateTime signedDate;
         QString issuer;
+        QString sha256;             // Of the plugin binary, hex
     };
 
     explicit SecurityManager(QObject *parent = nullptr);
@@ -81,11 +92,20 @@ public:
     SecurityLevel getSecurityLevel() const;
     void enableSandboxedDecoding(bool enabled);
     bool isSandboxedDecodingEnabled() const;
+    
+    /**
+     * @brief Get the pool of sandboxed decoder workers, spawning them on first use
+     * 
+     * Runs while sandboxed decoding is enabled; hand it to
+     * VLCBackend::setDecoderSandbox(). Files in the downloads folder are
+     * treated as untrusted, besides those the OS marks as downloaded.
+     */
+    SandboxedDecoderPool* decoderPool();
     void enableMaliciousContentProtection(bool enabled);
     bool isMaliciousContentProtectionEnabled() const;
 
     // File validation and sanitization
-    FileValidationResult validateMediaFile(const QString& filePath);
+    FileSecurityReport validateMediaFile(const QString& filePath);
     bool isFilePathSafe(const QString& filePath);
     QString sanitizeFilePath(const QString& filePath);
     bool validateFileHeaders(const QString& filePath);
@@ -98,6 +118,13 @@ public:
     void setEncryptionKey(const QByteArray& key);
     bool hasValidEncryptionKey() const;
 
+    // Bulk encryption with the session key: AES-256-GCM, hardware accelerated where available
+    QByteArray encryptBlob(const QByteArray& data, const QByteArray& associatedData = QByteArray());
+    bool decryptBlob(const QByteArray& sealed, QByteArray* data, const QByteArray& associatedData = QByteArray());
+    bool encryptFile(const QString& sourcePath, const QString& targetPath);
+    bool decryptFile(const QString& sourcePath, const QString& targetPath);
+    QString getEncryptionImplementation() const;
+
     // Plugin security
     bool verifyPluginSignature(const QString& pluginPath);
     PluginSignature getPluginSignature(const QString& pluginPath);
@@ -106,6 +133,16 @@ public:
     void removeTrustedPlugin(const QString& pluginPath);
     QStringList getTrustedPlugins() const;
 
+    /**
+     * @brief Verify the plugins in a directory in parallel, in the background
+     *
+     * Meant for startup: plugins not verified in an earlier run, or changed
+     * since, are hashed and checked on worker threads, so that the calls
+     * made while loading them find the result cached.
+     * pluginVerificationCompleted() is emitted for each of them.
+     */
+    QFuture<void> verifyPluginDirectory(const QString& directory);
+
     // Sandboxed process management
     bool startSandboxedProcess(const QString& executable, const QStringList& arguments);
     void terminateSandboxedProcesses();
@@ -141,7 +178,7 @@ signals:
     void securityLevelChanged(SecurityLevel newLevel);
     void threatDetected(const SecurityEvent& event);
     void threatBlocked(const SecurityEvent& event);
-    void fileValidationCompleted(const QString& filePath, const FileValidationResult& result);
+    void fileValidationCompleted(const QString& filePath, const FileSecurityReport& result);
     void pluginVerificationCompleted(const QString& pluginPath, const PluginSignature& signature);
     void sandboxedProcessStarted(const QString& processName);
     void sandboxedProcessTerminated(const QString& processName);
@@ -159,16 +196,33 @@ private:
     bool validateMediaFileHeaders(const QString& filePath);
     bool validateSubtitleFile(const QString& filePath);
     bool detectMaliciousPatterns(const QByteArray& content);
-    QStringList scanForThreats(const QString& filePath);
+    QStringList scanForThreats(const QByteArray& content);
     void initializeThreatDatabase();
     
     // Encryption helpers
-    QByteArray encryptData(const QByteArray& data, const QByteArray& key);
-    QByteArray decryptData(const QByteArray& encryptedData, const QByteArray& key);
     QByteArray deriveKey(const QString& password, const QByteArray& salt);
     QByteArray generateSalt();
     
     // Plugin verification helpers
+    struct PluginFileIdentity {
+        qint64 size = -1;
+        qint64 modified = 0;        // Milliseconds since epoch
+        quint64 fileId = 0;         // Inode, or the NTFS file index
+
+        bool isValid() const { return size >= 0; }
+        bool operator==(const PluginFileIdentity& other) const
+        {
+            return size == other.size && modified == other.modified && fileId == other.fileId;
+        }
+    };
+    struct PluginRecord {
+        PluginSignature signature;
+        PluginFileIdentity identity;
+    };
+    static PluginFileIdentity pluginFileIdentity(const QString& pluginPath);
+    PluginSignature inspectPlugin(const QString& pluginPath);
+    void loadTrustedPlugins();
+    void saveTrustedPlugins();
     bool verifyCodeSignature(const QString& filePath);
     QString extractCertificateInfo(const QString& filePath);
     bool validateCertificateChain(const QString& certificate);
@@ -199,13 +253,18 @@ private:
     // Encryption
     QByteArray m_encryptionKey;
     QByteArray m_encryptionSalt;
+    AesGcm m_cipher;                            // Key schedule of m_encryptionKey
+    QHash<QByteArray, QByteArray> m_derivedKeys; // Keys derived this session, by password digest
     std::unique_ptr<QSettings> m_encryptedSettings;
     
-    // Plugin management
-    QMap<QString, PluginSignature> m_trustedPlugins;
+    // Plugin management; records are reused while the file's identity is unchanged
+    mutable QMutex m_pluginMutex;               // Guards m_trustedPlugins and m_verifiedPlugins
+    QMap<QString, PluginRecord> m_trustedPlugins;
+    QHash<QString, PluginRecord> m_verifiedPlugins;
     QStringList m_blockedPlugins;
     
     // Sandboxing
+    std::unique_ptr<SandboxedDecoderPool> m_decoderPool;
     QList<QProcess*> m_sandboxedProcesses;
     QStringList m_allowedPaths;
     QStringList m_allowedNetworks;
@@ -217,14 +276,28 @@ private:
     QStringList m_blockedSources;
     
     // Threat detection
-    QStringList m_maliciousPatterns;
+    QList<QByteArray> m_maliciousPatterns;
+    PatternScanner m_maliciousScanner;
+    PatternScanner m_scriptScanner;
+    PatternScanner m_markupScanner;     // Prefilter for sanitizeSubtitleContent()
     QStringList m_suspiciousExtensions;
     QMap<QString, QString> m_knownThreats;
     
+    // Reports of unchanged files are reused instead of re-hashing and re-scanning
+    struct CachedReport {
+        FileValidationResult file;
+        FileSecurityReport report;
+    };
+    QHash<QString, CachedReport> m_reportCache;
+    
     // Constants
     static const int MAX_SECURITY_EVENTS = 1000;
     static const int SECURITY_MONITORING_INTERVAL_MS = 5000;
     static const int MAX_FILE_SIZE_MB = 100;
+    static const int SCAN_WINDOW_BYTES = 1024 * 1024;
+    static const int MAX_CACHED_REPORTS = 512;
     static const int ENCRYPTION_KEY_LENGTH = 32;
     static const int SALT_LENGTH = 16;
+    static constexpr const char* SALT_SETTING_KEY = "encryption/salt";
+    static constexpr const char* TRUSTED_PLUGINS_GROUP = "trustedPlugins";
 };
\ No newline at end of file
@@ -5,10 +5,12 @@
 #include <QDateTime>
 #include <QTimer>
 #include <QProcess>
+#include "Metrics.h"
 #include <memory>
 
-class QNetworkAccessManager;
-class QNetworkReply;
+class QJsonObject;
+class MetricsServer;
+class ReportUploadQueue;
 
 /**
  * @brief Comprehensive crash reporting and stability monitoring system
@@ -52,6 +54,7 @@ public:
         qint64 memoryUsage = 0;
         qint64 uptime = 0;
         QString lastAction;
+        QStringList breadcrumbs;        // Oldest first
         QMap<QString, QString> systemInfo;
         QMap<QString, QString> userSettings;
         bool wasReported = false;
@@ -68,6 +71,7 @@ public:
         QDateTime lastCrash;
         QStringList frequentCrashLocations;
         QMap<QString, int> crashTypeCount;
+        MetricsSnapshot performance;    // In-process metrics at the time of the call
     };
 
     explicit CrashReporter(QObject *parent = nullptr);
@@ -92,6 +96,11 @@ public:
     void startStabilityMonitoring();
     void stopStabilityMonitoring();
     bool isStabilityMonitoringActive() const;
+    
+    // Metrics endpoint (OpenMetrics over HTTP on localhost)
+    bool enableMetricsEndpoint(quint16 port);
+    void disableMetricsEndpoint();
+    quint16 getMetricsEndpointPort() const;
     StabilityMetrics getStabilityMetrics() const;
     void recordSessionStart();
     void recordSessionEnd();
@@ -124,6 +133,8 @@ public:
     int getMaxStoredCrashes() const;
     void setReportingTimeout(int timeoutMs);
     int getReportingTimeout() const;
+    void setDailyUploadLimit(qint64 bytes);     // 0 for no limit
+    qint64 getDailyUploadLimit() const;
     void setStabilityCheckInterval(int intervalMs);
     void setUserConsent(bool hasConsent);
     bool hasUserConsent() const;
@@ -138,8 +149,7 @@ signals:
 
 private slots:
     void onStabilityTimerTimeout();
-    void onReportingReplyFinished();
-    void onReportingReplyError();
+    void onReportsUploaded(const QStringList& crashIds);
     void onMemoryMonitorTimeout();
 
 private:
@@ -148,7 +158,9 @@ private:
     void setupExceptionHandlers();
     QString generateCrashId() const;
     void storeCrashInfo(const CrashInfo& crashInfo);
+    void writeCrashFile(const CrashInfo& crashInfo);
     void loadStoredCrashes();
+    void recoverPreviousSession();
     void saveStabilityMetrics();
     void loadStabilityMetrics();
     
@@ -174,9 +186,11 @@ private:
     void restoreUserData();
     
     // Reporting helpers
-    QByteArray prepareCrashReport(const CrashInfo& crashInfo) const;
-    void sendCrashReport(const QByteArray& reportData, const QString& crashId);
+    QJsonObject prepareCrashReport(const CrashInfo& crashInfo) const;
+    QByteArray crashSignature(const CrashInfo& crashInfo) const;
+    bool queueCrashReport(const CrashInfo& crashInfo);
     bool shouldReportCrash(const CrashInfo& crashInfo) const;
+    void updateUploadQueue();
     
     // Member variables
     bool m_crashHandlerInstalled;
@@ -208,8 +222,8 @@ private:
     // Monitoring
     std::unique_ptr<QTimer> m_stabilityTimer;
     std::unique_ptr<QTimer> m_memoryMonitor;
-    std::unique_ptr<QNetworkAccessManager> m_networkManager;
-    QList<QNetworkReply*> m_pendingReports;
+    std::unique_ptr<ReportUploadQueue> m_uploadQueue;     // Batches, compresses and deduplicates reports
+    std::unique_ptr<MetricsServer> m_metricsServer;
     
     // Memory tracking
     qint64 m_initialMemoryUsage;
@@ -223,6 +237,7 @@ private:
     static const int DEFAULT_MEMORY_CHECK_INTERVAL_MS = 10000;
     static const int SAFE_MODE_FAILURE_THRESHOLD = 3;
     static const int MAX_MEMORY_HISTORY_SIZE = 100;
+    static const int SIGNATURE_FRAMES = 8;          // Stack frames that identify a crash
     
     // Static crash handler functions
     static CrashReporter* s_instance;
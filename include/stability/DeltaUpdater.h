@@ -0,0 +1,209 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <memory>
+
+class DownloadManager;
+class QJsonObject;
+class QNetworkReply;
+class QThreadPool;
+
+/**
+ * @brief File-level delta updates of an installation
+ *
+ * Instead of a whole installer, a release publishes a signed manifest with
+ * the SHA-256 of every installed file. Only files whose hash differs from
+ * what is installed are downloaded, as a zstd patch against the installed
+ * version when the manifest has one for that hash (zstd --patch-from),
+ * otherwise as the zstd-compressed file:
+ *
+ *     {
+ *       "version": "1.5.0",
+ *       "files": [{
+ *         "path": "bin/eonplay", "size": 31457280, "sha256": "<hex>",
+ *         "url": "files/<sha256>.zst", "downloadSha256": "<hex>", "downloadSize": 9437184,
+ *         "patches": [{"from": "<old sha256>", "url": "patches/<old>-<new>.zst",
+ *                      "sha256": "<hex>", "size": 1048576}]
+ *       }]
+ *     }
+ *
+ * URLs are relative to the manifest. <manifest URL>.sig holds the raw
+ * Ed25519 signature of the manifest bytes, checked against publicKey()
+ * before anything else is read from it; without OpenSSL (HAVE_OPENSSL) no
+ * manifest verifies, and without zstd (HAVE_ZSTD) nothing can be applied.
+ *
+ * Downloads run in the background through a DownloadManager of our own,
+ * one connection per file so data arrives in order, resumable across
+ * restarts and capped by bandwidthLimit(). Each download is hashed as it is
+ * written and each file as it is decompressed, so nothing is read back to
+ * be verified. Files are staged next to the state directory and
+ * applyUpdate() swaps them in, keeping the replaced ones for rollback().
+ */
+class DeltaUpdater : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class State {
+        Idle,
+        Checking,
+        Ready,          // Manifest verified, update planned
+        Downloading,
+        Staged,         // Every changed file verified and staged
+        Failed
+    };
+
+    struct FileUpdate {
+        QString path;               // Relative to the installation
+        QByteArray sha256;          // Of the new file, hex
+        qint64 size = 0;
+        QUrl url;                   // Patch or compressed file
+        QByteArray downloadSha256;  // Hex
+        qint64 downloadSize = 0;
+        bool isPatch = false;
+    };
+
+    explicit DeltaUpdater(const QString& installDirectory, const QString& stateDirectory = defaultDirectory(),
+                          QObject* parent = nullptr);
+    ~DeltaUpdater() override;
+
+    /**
+     * @brief Get the default state directory
+     */
+    static QString defaultDirectory();
+
+    /**
+     * @brief Set the Ed25519 public key, base64 of the 32 raw bytes
+     */
+    void setPublicKey(const QString& publicKey);
+    QString publicKey() const;
+
+    /**
+     * @brief Cap the download rate
+     * @param bytesPerSecond 0 for no limit
+     */
+    void setBandwidthLimit(qint64 bytesPerSecond);
+    qint64 bandwidthLimit() const;
+    void setUserAgent(const QString& userAgent);
+
+    /**
+     * @brief Fetch a manifest and plan the update
+     *
+     * updateReady() follows, or updateFailed().
+     */
+    void checkManifest(const QUrl& manifestUrl);
+
+    State state() const { return m_state; }
+    QString version() const { return m_version; }
+    QList<FileUpdate> pendingFiles() const { return m_files; }
+    QStringList removedFiles() const { return m_removed; }
+
+    /**
+     * @brief Bytes to download for the planned update
+     */
+    qint64 downloadSize() const;
+
+    /**
+     * @brief Download and stage the planned files; resumes earlier progress
+     */
+    void downloadUpdate();
+    void pauseDownload();
+
+    /**
+     * @brief Swap the staged files into the installation
+     *
+     * Call while the installation is not running, e.g. from a helper or at
+     * startup. Replaced files are kept for rollback().
+     */
+    bool applyUpdate();
+
+    /**
+     * @brief Put back the files replaced by the last applyUpdate()
+     */
+    bool rollback();
+    bool canRollback() const;
+
+    QString lastError() const { return m_lastError; }
+
+    static constexpr int MAX_PARALLEL_FILES = 2;
+
+signals:
+    /**
+     * @param downloadBytes What the delta costs
+     * @param fullBytes What the changed files are worth uncompressed
+     */
+    void updateReady(const QString& version, qint64 downloadBytes, qint64 fullBytes);
+    void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void updateStaged(const QString& version);
+    void updateApplied(const QString& version);
+    void updateFailed(const QString& error);
+
+private slots:
+    void onManifestFinished();
+    void onSignatureFinished();
+    void onDataWritten(const QString& id, qint64 offset, const QByteArray& data);
+    void onDownloadFinished(const QString& id, const QString& filePath);
+    void onDownloadFailed(const QString& id, const QString& error);
+
+private:
+    struct Verifier {
+        std::shared_ptr<QCryptographicHash> hash;
+        qint64 hashed = 0;          // Bytes of the download hashed so far
+    };
+
+    void verifyManifest();
+    bool planUpdate(const QJsonObject& manifest);
+    QByteArray installedHash(const QString& path);
+    void loadHashCache();
+    void saveHashCache() const;
+
+    QString downloadPath(const FileUpdate& file) const;
+    QString stagedPath(const QString& path) const;
+    QString backupPath(const QString& path) const;
+    const FileUpdate* fileForDownload(const QString& id) const;
+    bool catchUp(Verifier& verifier, const QString& filePath, qint64 offset) const;
+    void stageFile(const FileUpdate& file, const QString& downloadedPath);
+    void onFileStaged(const QString& path, const QString& error);
+    void updateProgress();
+    void saveStagedUpdate() const;
+    bool loadStagedUpdate();
+
+    void fail(const QString& error);
+    void setState(State state);
+
+    QString m_installDirectory;
+    QString m_stateDirectory;
+    QByteArray m_publicKey;                 // Raw
+    QByteArray m_userAgent;
+    DownloadManager* m_downloads;
+
+    State m_state = State::Idle;
+    QString m_lastError;
+    QUrl m_manifestUrl;
+    QByteArray m_manifest;
+    QByteArray m_signature;
+    QNetworkReply* m_manifestReply = nullptr;
+    QNetworkReply* m_signatureReply = nullptr;
+
+    QString m_version;
+    QList<FileUpdate> m_files;
+    QStringList m_removed;
+    QHash<QString, Verifier> m_verifiers;   // By download id, the download hash
+    QStringList m_staged;
+    QThreadPool* m_stagePool;               // Decompresses verified downloads
+
+    struct HashEntry {
+        qint64 size = 0;
+        qint64 modified = 0;                // ms since epoch
+        QByteArray sha256;
+    };
+    QHash<QString, HashEntry> m_hashCache;  // Installed files, by path
+    QStringList m_manifestFiles;            // Of the installed version, if applied by us
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QObject>
+#include <QHostAddress>
+
+class QTcpServer;
+class QTcpSocket;
+
+/**
+ * @brief Minimal HTTP endpoint serving MetricsRegistry in the OpenMetrics format
+ *
+ * Answers GET /metrics for Prometheus-style scrapers and nothing else;
+ * every connection is closed after one response. Meant for local profiling,
+ * so it listens on the loopback interface unless told otherwise.
+ */
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_REQUEST_SIZE = 8 * 1024;
+    static constexpr int REQUEST_TIMEOUT_MS = 5000;
+
+    explicit MetricsServer(QObject* parent = nullptr);
+    ~MetricsServer() override;
+
+    /**
+     * @brief Start listening
+     * @param port TCP port; 0 picks a free one
+     */
+    bool listen(quint16 port, const QHostAddress& address = QHostAddress::LocalHost);
+    void close();
+
+    bool isListening() const;
+    quint16 port() const;
+
+private:
+    void handleConnection();
+    void handleRequest(QTcpSocket* socket);
+    static void respond(QTcpSocket* socket, const QByteArray& status, const QByteArray& contentType,
+                        const QByteArray& body);
+
+    QTcpServer* m_server;
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+
+class QNetworkReply;
+class QTimer;
+
+/**
+ * @brief Persistent, batched upload queue for crash and telemetry reports
+ *
+ * Reports are written to disk as soon as they are queued, so reports from a
+ * crashing process are sent on the next start. Each report is stored as
+ * one line of NDJSON in its own zstd frame (HAVE_ZSTD); an attached
+ * minidump is embedded in the line, base64. Concatenated frames are a
+ * valid zstd stream, so a batch is the stored frames back to back and
+ * nothing is recompressed to send it:
+ *
+ *     POST <endpoint>
+ *     Content-Type: application/x-ndjson
+ *     Content-Encoding: zstd
+ *
+ *     {"id": ..., "signature": ..., "report": {...}, "minidump": "<base64>"}
+ *     {"signature": ..., "occurrences": 12}
+ *
+ * A report line counts one occurrence and an occurrence line adds more.
+ * Reports with the signature of one already queued are folded into it.
+ * Signatures sent within DEDUP_WINDOW_DAYS are not sent again; only their
+ * occurrence counts go with the next batch.
+ *
+ * Batches wait BATCH_DELAY_MS after the first report for more to arrive,
+ * take at most MAX_BATCH_REPORTS or MAX_BATCH_BYTES, and stay within a
+ * daily byte budget. Failures back off exponentially from
+ * INITIAL_BACKOFF_MS up to MAX_BACKOFF_MS, honouring Retry-After. Use from
+ * the main thread.
+ */
+class ReportUploadQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ReportUploadQueue(const QString& directory = defaultDirectory(), QObject* parent = nullptr);
+    ~ReportUploadQueue() override;
+
+    /**
+     * @brief Get the default queue directory
+     */
+    static QString defaultDirectory();
+
+    void setEndpoint(const QUrl& endpoint);
+    QUrl endpoint() const { return m_endpoint; }
+
+    /**
+     * @brief Allow uploads; reports are queued either way
+     */
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+
+    /**
+     * @brief Cap the bytes uploaded per day
+     * @param bytes 0 for no limit
+     */
+    void setDailyUploadLimit(qint64 bytes);
+    qint64 dailyUploadLimit() const { return m_dailyLimit; }
+
+    /**
+     * @brief Queue a report
+     * @param signature Identifies duplicates, e.g. a hash of the crash location
+     * @param attachmentPath Minidump to embed, if any; removed once queued
+     * @return false if the signature was already queued or recently sent
+     *         and the report was only counted
+     */
+    bool enqueue(const QString& id, const QByteArray& signature, const QJsonObject& report,
+                 const QString& attachmentPath = QString());
+
+    /**
+     * @brief Send a batch now, ignoring the batch delay and backoff
+     */
+    void flush();
+
+    int pendingCount() const { return m_entries.size(); }
+    bool isUploading() const { return m_reply != nullptr; }
+
+    static constexpr int BATCH_DELAY_MS = 30 * 1000;
+    static constexpr int MAX_BATCH_REPORTS = 20;
+    static constexpr qint64 MAX_BATCH_BYTES = 4 * 1024 * 1024;
+    static constexpr qint64 MAX_ATTACHMENT_BYTES = 8 * 1024 * 1024;
+    static constexpr int MAX_QUEUED_REPORTS = 200;
+    static constexpr qint64 DEFAULT_DAILY_LIMIT = 16 * 1024 * 1024;
+    static constexpr qint64 INITIAL_BACKOFF_MS = 60 * 1000;
+    static constexpr qint64 MAX_BACKOFF_MS = 6 * 60 * 60 * 1000;
+    static constexpr int DEDUP_WINDOW_DAYS = 7;
+
+signals:
+    /**
+     * @param ids The reports sent, including those only counted
+     */
+    void reportsUploaded(const QStringList& ids);
+    void uploadFailed(const QStringList& ids, const QString& error);
+
+private slots:
+    void onUploadFinished();
+
+private:
+    struct Entry {
+        QString id;
+        QByteArray signature;
+        QStringList mergedIds;      // Duplicates folded into this report
+        int occurrences = 1;
+        QString file;               // Stored line, relative to the directory
+        qint64 size = 0;            // Bytes on disk
+    };
+
+    enum class Outcome {
+        Uploaded,
+        Retry,                      // Network or server trouble
+        Rejected                    // By the server; not sent again
+    };
+
+    struct SentSignature {
+        QDateTime sentAt;
+        QStringList unsentIds;      // Seen since, not yet counted
+    };
+
+    QByteArray encodeLine(const QJsonObject& line) const;
+    void schedule(qint64 delayMs);
+    void startUpload();
+    void finishUpload(Outcome outcome, const QString& error = QString(), qint64 retryAfterMs = 0);
+    void removeEntry(int index);
+    void pruneSignatures();
+    qint64 remainingBudget();
+
+    void loadState();
+    void saveState() const;
+
+    QString m_directory;
+    QUrl m_endpoint;
+    bool m_enabled = false;
+    qint64 m_dailyLimit = DEFAULT_DAILY_LIMIT;
+
+    QList<Entry> m_entries;                         // Oldest first
+    QHash<QByteArray, SentSignature> m_sent;
+    QDateTime m_budgetStart;                        // Start of the current day's budget
+    qint64 m_budgetUsed = 0;
+    int m_failures = 0;
+    QDateTime m_nextAttempt;
+
+    QTimer* m_timer;
+    QNetworkReply* m_reply = nullptr;
+    int m_batchEntries = 0;                         // Leading m_entries in flight
+    QList<int> m_batchOccurrences;                  // Of those entries, as sent
+    QHash<QByteArray, int> m_batchSignatures;       // Occurrence lines in flight for sent signatures
+    qint64 m_batchBytes = 0;
+};
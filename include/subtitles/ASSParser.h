@@ -72,6 +72,25 @@ public:
     SubtitleTrack parseContent(const QString& content, SubtitleParseResult& result) override;
 
 private:
+    /**
+     * @brief Parse a UTF-8 buffer in one pass over its lines
+     * @param data File content
+     * @param result Parse result (for statistics)
+     * @return Parsed subtitle track
+     */
+    SubtitleTrack parseBuffer(QByteArrayView data, SubtitleParseResult& result) const;
+    
+    /**
+     * @brief Parse a dialogue line viewing the buffer
+     * @param dialogueLine Trimmed line starting with "Dialogue:"
+     * @param formats Formats of the known styles, by style name
+     * @param fallbackFormat Format for unknown styles
+     * @param entry Output subtitle entry
+     * @return true if parsing successful
+     */
+    bool parseDialogueLine(QByteArrayView dialogueLine, const QHash<QString, SubtitleFormat>& formats,
+                          const SubtitleFormat& fallbackFormat, SubtitleEntry& entry) const;
+    
     /**
      * @brief Parse ASS file sections
      * @param content File content
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "SubtitleEntry.h"
+#include "security/PatternScanner.h"
 #include <QString>
 #include <QStringList>
 #include <QTextStream>
+#include <QByteArrayView>
 #include <memory>
 
 /**
@@ -124,6 +126,8 @@ public:
 class BaseSubtitleParser : public ISubtitleParser
 {
 public:
+    static constexpr int MAX_TEXT_LENGTH = 10000;   // Characters per subtitle entry
+    
     BaseSubtitleParser();
     virtual ~BaseSubtitleParser() = default;
     
@@ -139,6 +143,27 @@ public:
     QString detectEncoding(const QString& filePath) const override;
 
 protected:
+    /**
+     * @brief Check existence, size and extension without reading the file
+     * @param filePath Path to file
+     * @return true if the file may be parsed
+     */
+    bool validateFileInfo(const QString& filePath) const;
+    
+    /**
+     * @brief Validate raw UTF-8 content, as validateContent() does for text
+     * @param data File content
+     * @return true if content is safe to parse
+     */
+    bool validateBuffer(QByteArrayView data) const;
+    
+    /**
+     * @brief Sort and validate a parsed track and fill in the result
+     * @param track Parsed track
+     * @param result Parse result to complete
+     */
+    void finalizeTrack(SubtitleTrack& track, SubtitleParseResult& result) const;
+    
     /**
      * @brief Read file content with encoding detection
      * @param filePath Path to file
@@ -179,6 +204,7 @@ private:
     qint64 m_maxFileSize;
     int m_maxEntries;
     QStringList m_suspiciousPatterns;
+    PatternScanner m_suspiciousScanner;
     QStringList m_allowedTags;
 };
 
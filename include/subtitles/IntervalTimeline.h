@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * @brief Time index over a list of [start, end] intervals
+ *
+ * Items are ordered by start time, with a max-end segment tree over that
+ * order so the intervals covering a time are found by seeks in O(log n)
+ * per match, and a sweep cursor that follows playback forward in
+ * amortized O(1) per query. Items are identified by their index in the
+ * lists passed to build(); ends are inclusive.
+ *
+ * Queries move the cursor, so an index must not be queried from several
+ * threads at once.
+ */
+class IntervalTimeline
+{
+public:
+    static constexpr int SWEEP_LIMIT = 64;  // Starts passed before a forward jump becomes a seek
+
+    /**
+     * @brief Index a new set of intervals
+     * @param starts Start time of each item in milliseconds
+     * @param ends End time of each item, same size as starts
+     */
+    void build(const QVector<qint64>& starts, const QVector<qint64>& ends);
+
+    void clear();
+    int size() const { return m_byStart.size(); }
+    bool isEmpty() const { return m_byStart.isEmpty(); }
+
+    /**
+     * @brief Get the items covering a time
+     * @param time Time in milliseconds
+     * @return Item indices in ascending order
+     */
+    QVector<int> activeAt(qint64 time);
+
+    /**
+     * @brief Get the first item starting after a time
+     * @return Item index, the lowest among equal starts; -1 if none
+     */
+    int nextAfter(qint64 time) const;
+
+    /**
+     * @brief Get the item with the latest start before a time
+     * @return Item index, the lowest among equal starts; -1 if none
+     */
+    int previousBefore(qint64 time) const;
+
+private:
+    void seek(qint64 time);
+    void collectActive(int node, int low, int high, int limit, qint64 time);
+    int upperBoundStart(qint64 time) const;
+    int lowerBoundStart(qint64 time) const;
+
+    QVector<int> m_byStart;         // Item indices ordered by start time
+    QVector<qint64> m_starts;       // Start time per position in m_byStart
+    QVector<qint64> m_ends;         // End time per position in m_byStart
+    QVector<qint64> m_maxEnd;       // Segment tree of ends, leaves from m_leafCount on
+    int m_leafCount = 0;
+
+    bool m_cursorValid = false;
+    qint64 m_cursorTime = 0;
+    int m_nextStart = 0;            // First position starting after m_cursorTime
+    QVector<int> m_active;          // Positions active at m_cursorTime
+};
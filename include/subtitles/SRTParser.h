@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ISubtitleParser.h"
+#include <QVarLengthArray>
 
 /**
  * @brief Parser for SubRip (.srt) subtitle format
@@ -25,6 +26,29 @@ public:
     SubtitleTrack parseContent(const QString& content, SubtitleParseResult& result) override;
 
 private:
+    using BlockLines = QVarLengthArray<QByteArrayView, 8>;
+    
+    /**
+     * @brief Parse a UTF-8 buffer without decoding it up front
+     * @param data File content
+     * @param result Parse result (for statistics)
+     * @return Parsed subtitle track
+     */
+    SubtitleTrack parseBuffer(QByteArrayView data, SubtitleParseResult& result) const;
+    
+    /**
+     * @brief Parse one SRT block of trimmed, non-empty lines
+     * @param lines Block lines viewing the buffer
+     * @param entry Output subtitle entry
+     * @return true if parsing successful
+     */
+    bool parseBlock(const BlockLines& lines, SubtitleEntry& entry) const;
+    
+    /**
+     * @brief Parse SRT timing line from the buffer
+     */
+    static bool parseTimingLine(QByteArrayView timingLine, qint64& startTime, qint64& endTime);
+    
     /**
      * @brief Parse individual SRT subtitle block
      * @param block Text block containing one subtitle entry
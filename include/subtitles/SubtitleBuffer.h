@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QFile>
+#include <QString>
+
+/**
+ * @brief Read-only view of a subtitle file for zero-copy parsing
+ *
+ * The file is memory-mapped when possible and read into memory otherwise.
+ * Parsers tokenize data() with QByteArrayView and decode only the text of
+ * the entries they keep. Views into data() stay valid while the buffer
+ * lives and is not reopened.
+ */
+class SubtitleBuffer
+{
+public:
+    SubtitleBuffer() = default;
+    ~SubtitleBuffer();
+
+    SubtitleBuffer(const SubtitleBuffer&) = delete;
+    SubtitleBuffer& operator=(const SubtitleBuffer&) = delete;
+
+    /**
+     * @brief Map a subtitle file
+     * @param filePath Path to subtitle file
+     * @param maxSize Largest accepted file size in bytes
+     * @return true if the file could be read
+     */
+    bool open(const QString& filePath, qint64 maxSize);
+
+    /**
+     * @brief Release the mapping
+     */
+    void close();
+
+    /**
+     * @brief File content without a UTF-8 byte order mark
+     */
+    QByteArrayView data() const { return m_data; }
+
+    /**
+     * @brief Check if the content can be parsed as UTF-8
+     * @return false for files with a UTF-16 or UTF-32 byte order mark
+     */
+    bool isUtf8() const { return m_utf8; }
+
+    /**
+     * @brief Take the next line off the front of a view
+     * @param rest Remaining content, advanced past the line
+     * @param line Output line without its CR/LF terminator
+     * @return false once rest is exhausted
+     */
+    static bool nextLine(QByteArrayView& rest, QByteArrayView& line);
+
+    /**
+     * @brief Parse H:MM:SS with an optional ,fff or .ff fraction
+     * @param text Timestamp, surrounding whitespace allowed
+     * @return Time in milliseconds, -1 if invalid
+     */
+    static qint64 parseTimestamp(QByteArrayView text);
+
+    /**
+     * @brief Check if a view holds only ASCII digits
+     */
+    static bool isNumber(QByteArrayView text);
+
+private:
+    QFile m_file;
+    uchar* m_mapped = nullptr;
+    QByteArray m_content;       // Used when mapping is not possible
+    QByteArrayView m_data;
+    bool m_utf8 = true;
+};
@@ -4,8 +4,13 @@
 #include <QTime>
 #include <QColor>
 #include <QFont>
+#include <QHash>
 #include <QRect>
 #include <QList>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+#include "IntervalTimeline.h"
 
 /**
  * @brief Subtitle text formatting information
@@ -48,6 +53,8 @@ struct SubtitleFormat
     bool operator!=(const SubtitleFormat& other) const { return !(*this == other); }
 };
 
+size_t qHash(const SubtitleFormat& format, size_t seed = 0);
+
 /**
  * @brief Individual subtitle entry with timing and text information
  */
@@ -74,6 +81,7 @@ public:
     SubtitleEntry(qint64 startTime, qint64 endTime, const QString& text, const SubtitleFormat& format);
     
     // Getters
+    quint64 id() const { return m_id; }
     qint64 startTime() const { return m_startTime; }
     qint64 endTime() const { return m_endTime; }
     qint64 duration() const { return m_endTime - m_startTime; }
@@ -87,6 +95,7 @@ public:
     QString effect() const { return m_effect; }
     
     // Setters
+    void setId(quint64 id) { m_id = id; }
     void setStartTime(qint64 startTime) { m_startTime = startTime; }
     void setEndTime(qint64 endTime) { m_endTime = endTime; }
     void setText(const QString& text) { m_text = text; }
@@ -158,6 +167,7 @@ public:
     static qint64 parseTimeASS(const QString& timeStr);
 
 private:
+    quint64 m_id = 0;           // Unique per entry added to a track, 0 otherwise
     qint64 m_startTime = 0;     // Start time in milliseconds
     qint64 m_endTime = 0;       // End time in milliseconds
     QString m_text;             // Subtitle text (may contain formatting tags)
@@ -169,8 +179,98 @@ private:
     QString m_effect;           // Special effects
 };
 
+/**
+ * @brief Interned formats and names of one track
+ * 
+ * An ASS track of tens of thousands of events uses a dozen styles, so each
+ * distinct format and each style, actor or effect name is stored once and
+ * events refer to it by index. Index 0 is the default format and the
+ * empty name.
+ */
+class SubtitleStyleTable
+{
+public:
+    SubtitleStyleTable();
+    
+    int internFormat(const SubtitleFormat& format);
+    int internName(const QString& name);
+    
+    const SubtitleFormat& format(int index) const { return m_formats.at(index); }
+    const QString& name(int index) const { return m_names.at(index); }
+    int formatCount() const { return m_formats.size(); }
+    int nameCount() const { return m_names.size(); }
+    
+    void clear();
+
+private:
+    QVector<SubtitleFormat> m_formats;
+    QHash<SubtitleFormat, int> m_formatIndex;
+    QStringList m_names;
+    QHash<QString, int> m_nameIndex;
+};
+
+class SubtitleTrack;
+
+/**
+ * @brief Read-only reference to an entry stored in a track
+ * 
+ * Two words, reading straight from the track's event array, style table
+ * and text arena, so queries that run on every tick copy nothing. Valid
+ * until the track is modified or destroyed; use toEntry() to keep an
+ * entry beyond that.
+ */
+class SubtitleEntryView
+{
+public:
+    SubtitleEntryView() = default;
+    
+    bool isNull() const { return m_track == nullptr; }
+    
+    quint64 id() const;
+    qint64 startTime() const;
+    qint64 endTime() const;
+    qint64 duration() const { return endTime() - startTime(); }
+    QStringView text() const;
+    const SubtitleFormat& format() const;
+    QRect position() const;
+    int layer() const;
+    const QString& style() const;
+    const QString& actor() const;
+    const QString& effect() const;
+    
+    /**
+     * @brief Copy the entry out of the track
+     */
+    SubtitleEntry toEntry() const;
+
+private:
+    friend class SubtitleTrack;
+    
+    SubtitleEntryView(const SubtitleTrack* track, int index) : m_track(track), m_index(index) {}
+    
+    const SubtitleTrack* m_track = nullptr;
+    int m_index = -1;
+};
+
 /**
  * @brief Collection of subtitle entries for a subtitle track
+ * 
+ * Entries are stored compactly: timing, position and indices into the
+ * track's SubtitleStyleTable, with the text of all entries back to back
+ * in one string. SubtitleEntry values are built only when asked for;
+ * views read the stored entries in place.
+ * 
+ * Time queries go through an IntervalTimeline built on first use after
+ * the entries change, so overlapping events are found by seeks in
+ * O(log n) per match and playback moving forward costs amortized O(1)
+ * per query. Queries move its cursor, so a track must not be queried
+ * from several threads at once.
+ * 
+ * Shifting and scaling only change an affine transform from stored to
+ * displayed time, display = stored * scale + shift. Queries map the time
+ * they are given back into stored time, so sync adjustments are O(1) and
+ * keep the index. Everything read from the track is in displayed time;
+ * bakeTiming() writes the transform into the stored entries.
  */
 class SubtitleTrack
 {
@@ -200,14 +300,23 @@ public:
     void setForced(bool isForced) { m_isForced = isForced; }
     
     // Subtitle entries management
+    /**
+     * @brief Add an entry, giving it a new unique id
+     */
     void addEntry(const SubtitleEntry& entry);
     void removeEntry(int index);
     void clearEntries();
     
-    QList<SubtitleEntry> entries() const { return m_entries; }
+    /**
+     * @brief Copy all entries out of the track; prefer view() for reading
+     */
+    QList<SubtitleEntry> entries() const;
     SubtitleEntry entryAt(int index) const;
-    int entryCount() const { return m_entries.size(); }
-    bool isEmpty() const { return m_entries.isEmpty(); }
+    SubtitleEntryView view(int index) const;
+    int entryCount() const { return m_events.size(); }
+    bool isEmpty() const { return m_events.isEmpty(); }
+    
+    const SubtitleStyleTable& styles() const { return m_styles; }
     
     /**
      * @brief Get active subtitle entries at given time
@@ -216,6 +325,19 @@ public:
      */
     QList<SubtitleEntry> getActiveEntries(qint64 time) const;
     
+    /**
+     * @brief Get views of the active entries, in the order of getActiveEntries()
+     * @param time Time in milliseconds
+     */
+    QVector<SubtitleEntryView> getActiveViews(qint64 time) const;
+    
+    /**
+     * @brief Get the ids of the active entries, in the order of getActiveEntries()
+     * @param time Time in milliseconds
+     * @return Entry ids; equal lists mean the same entries are shown
+     */
+    QVector<quint64> getActiveEntryIds(qint64 time) const;
+    
     /**
      * @brief Get next subtitle entry after given time
      * @param time Time in milliseconds
@@ -249,7 +371,8 @@ public:
     
     /**
      * @brief Shift all subtitle timings by offset
-     * @param offsetMs Offset in milliseconds (can be negative)
+     * @param offsetMs Offset in milliseconds (can be negative); times shifted
+     *                 before zero read as zero
      */
     void shiftTiming(qint64 offsetMs);
     
@@ -258,6 +381,17 @@ public:
      * @param factor Scaling factor (1.0 = no change)
      */
     void scaleTiming(double factor);
+    
+    double timeScale() const { return m_timeScale; }
+    double timeShift() const { return m_timeShift; }
+    bool hasTimingTransform() const { return m_timeScale != 1.0 || m_timeShift != 0.0; }
+    
+    /**
+     * @brief Apply the pending shift and scale to the stored entries
+     * 
+     * For writers that save the track; queries already see the transform.
+     */
+    void bakeTiming();
 
 private:
     QString m_title;
@@ -267,5 +401,84 @@ private:
     bool m_isDefault = false;
     bool m_isForced = false;
     
-    QList<SubtitleEntry> m_entries;
-};
\ No newline at end of file
+    friend class SubtitleEntryView;
+    
+    struct Event {
+        quint64 id = 0;
+        qint64 startTime = 0;
+        qint64 endTime = 0;
+        int textOffset = 0;             // Into m_text
+        int textLength = 0;
+        QRect position;
+        int layer = 0;
+        int format = 0;                 // Into m_styles
+        int style = 0;
+        int actor = 0;
+        int effect = 0;
+    };
+    
+    QVector<Event> m_events;
+    QString m_text;                     // Text of all entries back to back; removed ones leave gaps
+    SubtitleStyleTable m_styles;
+    
+    double m_timeScale = 1.0;           // Display time = stored time * scale + shift
+    double m_timeShift = 0.0;
+    
+    qint64 toDisplayTime(qint64 storedTime) const;
+    qint64 toStoredTime(qint64 displayTime) const;
+    
+    QVector<int> activeIndices(qint64 time) const;
+    void invalidateIndex() { m_indexValid = false; }
+    void ensureIndex() const;
+    
+    mutable IntervalTimeline m_index;
+    mutable bool m_indexValid = false;
+};
+
+inline qint64 SubtitleTrack::toDisplayTime(qint64 storedTime) const
+{
+    if (!hasTimingTransform()) {
+        return storedTime;
+    }
+    return qMax<qint64>(0, qRound64(storedTime * m_timeScale + m_timeShift));
+}
+
+inline quint64 SubtitleEntryView::id() const { return m_track->m_events.at(m_index).id; }
+inline qint64 SubtitleEntryView::startTime() const
+{
+    return m_track->toDisplayTime(m_track->m_events.at(m_index).startTime);
+}
+
+inline qint64 SubtitleEntryView::endTime() const
+{
+    return m_track->toDisplayTime(m_track->m_events.at(m_index).endTime);
+}
+
+inline QRect SubtitleEntryView::position() const { return m_track->m_events.at(m_index).position; }
+inline int SubtitleEntryView::layer() const { return m_track->m_events.at(m_index).layer; }
+
+inline QStringView SubtitleEntryView::text() const
+{
+    const auto& event = m_track->m_events.at(m_index);
+    return QStringView(m_track->m_text).mid(event.textOffset, event.textLength);
+}
+
+inline const SubtitleFormat& SubtitleEntryView::format() const
+{
+    return m_track->m_styles.format(m_track->m_events.at(m_index).format);
+}
+
+inline const QString& SubtitleEntryView::style() const
+{
+    return m_track->m_styles.name(m_track->m_events.at(m_index).style);
+}
+
+inline const QString& SubtitleEntryView::actor() const
+{
+    return m_track->m_styles.name(m_track->m_events.at(m_index).actor);
+}
+
+inline const QString& SubtitleEntryView::effect() const
+{
+    return m_track->m_styles.name(m_track->m_events.at(m_index).effect);
+}
@@ -5,8 +5,11 @@
 #include <QObject>
 #include <QTimer>
 #include <QHash>
+#include <QStringList>
 #include <memory>
 
+class QThreadPool;
+
 /**
  * @brief Subtitle loading result
  */
@@ -34,6 +37,9 @@ class SubtitleManager : public QObject
     Q_OBJECT
 
 public:
+    static constexpr int LOADER_THREADS = 2;
+    static constexpr int PREFETCH_LIMIT = 4;    // Media files whose sidecar tracks are kept
+    
     explicit SubtitleManager(QObject* parent = nullptr);
     ~SubtitleManager() override;
     
@@ -110,6 +116,13 @@ public:
      */
     QList<SubtitleEntry> getActiveSubtitles(qint64 time) const;
     
+    /**
+     * @brief Get views of the active subtitle entries, copying nothing
+     * @param time Time in milliseconds
+     * @return Views valid until the tracks change
+     */
+    QVector<SubtitleEntryView> getActiveSubtitleViews(qint64 time) const;
+    
     /**
      * @brief Clear all loaded subtitle tracks
      */
@@ -161,9 +174,20 @@ public slots:
     
     /**
      * @brief Handle media loaded
+     *
+     * Sidecar subtitles are detected, validated and parsed in the background;
+     * subtitleTrackLoaded() is emitted for each track as it completes.
+     * Tracks prefetched for this media are added right away.
+     *
      * @param mediaPath Path to loaded media file
      */
     void onMediaLoaded(const QString& mediaPath);
+    
+    /**
+     * @brief Parse sidecar subtitles of media that will play soon
+     * @param mediaPath Media file expected to play next
+     */
+    void prefetchSubtitles(const QString& mediaPath);
 
 signals:
     /**
@@ -206,11 +230,43 @@ signals:
     void subtitleLoadFailed(const QString& filePath, const QString& errorMessage);
 
 private:
+    /**
+     * @brief Parsed subtitle file, not yet added as a track
+     */
+    struct LoadedSubtitle {
+        SubtitleLoadResult result;
+        SubtitleTrack track;
+    };
+    
     /**
      * @brief Initialize subtitle parsers
      */
     void initializeParsers();
     
+    /**
+     * @brief Validate and parse a subtitle file; safe on loader threads
+     * @param filePath Path to subtitle file
+     * @return Parsed track with its load result
+     */
+    LoadedSubtitle parseSubtitleFile(const QString& filePath) const;
+    
+    /**
+     * @brief Add a parsed track, or report why it failed
+     * @param loaded Result of parseSubtitleFile()
+     * @return Index of the new track, -1 on failure
+     */
+    int addLoadedTrack(const LoadedSubtitle& loaded);
+    
+    /**
+     * @brief Detect and parse the sidecar files of a media file on the pool
+     */
+    void startSidecarJob(const QString& mediaPath);
+    
+    /**
+     * @brief Receive one parsed sidecar file on the GUI thread
+     */
+    void onSidecarLoaded(const QString& mediaPath, const LoadedSubtitle& loaded);
+    
     /**
      * @brief Auto-detect subtitle files for media
      * @param mediaPath Path to media file
@@ -250,10 +306,18 @@ private:
     qint64 m_maxFileSize;
     int m_maxEntries;
     QStringList m_maliciousPatterns;
+    PatternScanner m_maliciousScanner;
     QStringList m_allowedTags;
     
+    // Background sidecar loading, keyed by media path
+    QThreadPool* m_loadPool;
+    QHash<QString, QList<LoadedSubtitle>> m_sidecars;
+    QStringList m_sidecarOrder;         // Oldest first
+    QString m_currentMediaPath;
+    
     // Last active subtitles (for change detection)
     QList<SubtitleEntry> m_lastActiveSubtitles;
+    QVector<quint64> m_lastActiveIds;   // Entry ids are unique across tracks
     
     bool m_initialized;
 };
\ No newline at end of file
@@ -9,6 +9,11 @@
 #include <QFont>
 #include <QColor>
 #include <QRect>
+#include <QHash>
+#include <QCache>
+#include <QMargins>
+#include <QPixmap>
+#include <QVector>
 
 /**
  * @brief Subtitle rendering settings
@@ -77,11 +82,18 @@ class SubtitleRenderer : public QWidget
     Q_OBJECT
 
 public:
+    static constexpr int BITMAP_CACHE_KB = 32 * 1024;
+    
     explicit SubtitleRenderer(QWidget* parent = nullptr);
     ~SubtitleRenderer() override;
     
     /**
      * @brief Set subtitle entries to display
+     *
+     * Entries are compared by id, so repeating the current set is free.
+     * Layouts of entries still on screen are kept and only the band that
+     * held the old or holds the new text is repainted.
+     *
      * @param entries List of subtitle entries
      * @param time Current time in milliseconds
      */
@@ -206,22 +218,73 @@ private slots:
     void onFadeOutFinished();
 
 private:
+    /**
+     * @brief Measured entry: its rectangle and the lines drawn into it
+     */
+    struct EntryLayout {
+        QRect rect;             // Top is set by positionedLayouts()
+        QStringList lines;      // Wrapped and limited to maxLines
+        QMargins bleed;         // Ink outside rect: outline, shadow, overflowing lines
+    };
+    
+    /**
+     * @brief Layout of an entry, cached by entry id
+     * @param entry Subtitle entry
+     * @return Layout with the rectangle at y = 0
+     */
+    EntryLayout entryLayout(const SubtitleEntry& entry);
+    
+    /**
+     * @brief Lay out an entry from scratch
+     */
+    EntryLayout measureEntry(const SubtitleEntry& entry) const;
+    
+    /**
+     * @brief Layouts of the current entries stacked at their final position
+     */
+    QVector<EntryLayout> positionedLayouts();
+    
+    /**
+     * @brief Widget area covered by positioned layouts
+     * @param layouts Result of positionedLayouts()
+     * @return Bounding rectangle in widget coordinates
+     */
+    QRect paintedArea(const QVector<EntryLayout>& layouts) const;
+    
+    /**
+     * @brief Check whether two entry lists show the same entries
+     */
+    static bool sameEntries(const QList<SubtitleEntry>& a, const QList<SubtitleEntry>& b);
+    
+    /**
+     * @brief Rendered entry, drawn once and cached by content
+     * @param entry Subtitle entry
+     * @param layout Layout of the entry
+     * @return Pixmap covering rect plus bleed at the current scale
+     */
+    QPixmap entryBitmap(const SubtitleEntry& entry, const EntryLayout& layout);
+    
+    /**
+     * @brief Font an entry is drawn with, including the scale factor
+     */
+    QFont renderFont(const SubtitleFormat& format) const;
+    
     /**
      * @brief Render subtitle text with formatting
      * @param painter QPainter for rendering
      * @param entry Subtitle entry to render
-     * @param rect Target rectangle
+     * @param layout Positioned layout of the entry
      */
-    void renderSubtitleEntry(QPainter& painter, const SubtitleEntry& entry, const QRect& rect);
+    void renderSubtitleEntry(QPainter& painter, const SubtitleEntry& entry, const EntryLayout& layout);
     
     /**
      * @brief Render text with outline and shadow
      * @param painter QPainter for rendering
-     * @param text Text to render
+     * @param lines Lines to render
      * @param rect Target rectangle
      * @param format Text format
      */
-    void renderFormattedText(QPainter& painter, const QString& text, const QRect& rect, const SubtitleFormat& format);
+    void renderFormattedText(QPainter& painter, const QStringList& lines, const QRect& rect, const SubtitleFormat& format);
     
     /**
      * @brief Calculate text layout rectangle
@@ -261,13 +324,6 @@ private:
     void drawTextWithShadow(QPainter& painter, const QString& text, const QRect& rect,
                            const QColor& textColor, const QColor& shadowColor, int shadowOffset);
     
-    /**
-     * @brief Calculate total text height for multiple entries
-     * @param entries Subtitle entries
-     * @return Total height needed
-     */
-    int calculateTotalHeight(const QList<SubtitleEntry>& entries) const;
-    
     /**
      * @brief Split text into lines based on width constraints
      * @param text Text to split
@@ -290,7 +346,9 @@ private:
     QGraphicsOpacityEffect* m_opacityEffect;
     
     // Cached rendering data
-    QRect m_lastRenderRect;
+    QRect m_lastRenderRect;             // Area drawn by the last paint
     QPixmap m_cachedPixmap;
-    bool m_needsRedraw;
+    QHash<quint64, EntryLayout> m_layouts;
+    QCache<QString, QPixmap> m_bitmapCache;     // Cost in KiB, least recently used go first
+    bool m_needsRedraw;                 // Layouts are stale
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef ALBUMARTLOADER_H
+#define ALBUMARTLOADER_H
+
+#include <QObject>
+#include <QPixmap>
+#include <QCache>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+
+/**
+ * @brief Asynchronous album art decoder with a thumbnail cache
+ * 
+ * Images are decoded and scaled on a worker pool straight to the requested
+ * size, so full-resolution covers are never kept in memory. Decoded
+ * thumbnails live in a cost-bounded LRU cache. Covers from the cover art
+ * store are read from their pre-scaled copies, and tracks sharing a cover
+ * share its path and therefore its cache entry.
+ */
+class AlbumArtLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_CACHE_KB = 32 * 1024;
+    static constexpr int MAX_PENDING = 128;     // Queued decodes before stale ones are dropped
+
+    explicit AlbumArtLoader(QObject* parent = nullptr);
+    ~AlbumArtLoader() override;
+
+    /**
+     * @brief Get a thumbnail, decoding it in the background on a miss
+     * @param imagePath Image file to load
+     * @param size Bounding square of the thumbnail in pixels
+     * @return The thumbnail, or a null pixmap until thumbnailReady() is emitted
+     */
+    QPixmap thumbnail(const QString& imagePath, int size);
+
+    void setCacheLimit(int kilobytes) { m_cache.setMaxCost(kilobytes); }
+    void clear();
+
+signals:
+    void thumbnailReady(const QString& imagePath, int size);
+
+private:
+    static QString cacheKey(const QString& imagePath, int size);
+    void storeThumbnail(const QString& imagePath, int size, const QImage& image);
+
+    QCache<QString, QPixmap> m_cache;   // Cost in kilobytes
+    QSet<QString> m_pending;
+    QSet<QString> m_failed;             // Not retried until clear()
+    QThreadPool* m_pool;
+};
+
+#endif // ALBUMARTLOADER_H
@@ -4,7 +4,6 @@
 #include <QWidget>
 #include <QPainter>
 #include <QPainterPath>
-#include <QTimer>
 #include <QColor>
 #include <QVector>
 #include <QMutex>
@@ -13,11 +12,18 @@
 // Include AudioVisualizer for SpectrumData type
 #include "audio/AudioVisualizer.h"
 
+#ifdef HAVE_QT_OPENGL
+class SpectrumGLView;
+#endif
+
 /**
  * @brief Widget for displaying audio visualizations
  * 
  * Provides a comprehensive UI widget for displaying various audio visualizations
  * including spectrum analyzer, waveform, VU meters, and AI-driven visualizations.
+ * When built with Qt OpenGL support, the spectrum modes are drawn by a
+ * SpectrumGLView child on the GPU, with QPainter as the fallback.
+ * While the widget cannot be seen, the visualizer's analysis is suspended.
  */
 class AudioVisualizerWidget : public QWidget
 {
@@ -136,6 +142,24 @@ public:
      */
     void setAnimationSpeed(float speed);
 
+    /**
+     * @brief Check if GPU rendering is compiled in and has not failed
+     * @return true if available
+     */
+    bool isGpuRenderingAvailable() const;
+
+    /**
+     * @brief Check if GPU rendering is enabled
+     * @return true if enabled
+     */
+    bool isGpuRenderingEnabled() const;
+
+    /**
+     * @brief Enable or disable GPU rendering of the spectrum modes
+     * @param enabled Enable state
+     */
+    void setGpuRenderingEnabled(bool enabled);
+
 protected:
     void paintEvent(QPaintEvent* event) override;
     void resizeEvent(QResizeEvent* event) override;
@@ -148,6 +172,7 @@ private slots:
     void onPeakLevelsUpdated(float leftPeak, float rightPeak);
     void onColorPaletteUpdated(const QVector<QColor>& colors);
     void updateAnimation();
+    void onGpuRenderingFailed();
 
 private:
     void drawSpectrumAnalyzer(QPainter& painter);
@@ -169,6 +194,8 @@ private:
     QColor interpolateColor(const QColor& color1, const QColor& color2, float ratio);
     void drawBar(QPainter& painter, const QRectF& rect, float value, const QColor& color);
     void drawCircularBar(QPainter& painter, const QPointF& center, float radius, float angle, float value, const QColor& color);
+    bool updateGpuView();
+    bool isGpuRenderingActive() const;
 
     // Visualizer backend
     AudioVisualizer* m_visualizer;
@@ -191,9 +218,14 @@ private:
     bool m_gradientEnabled;
     bool m_glowEnabled;
     float m_animationSpeed;
+    bool m_gpuRenderingEnabled;
+
+#ifdef HAVE_QT_OPENGL
+    // GPU renderer for the spectrum modes
+    SpectrumGLView* m_glView;
+#endif
 
-    // Animation state
-    QTimer* m_animationTimer;
+    // Animation state, advanced by the UpdateScheduler while visible
     float m_animationPhase;
     QVector<float> m_barAnimations;
     QVector<float> m_peakAnimations;
@@ -3,11 +3,23 @@
 #include <QObject>
 #include <QShortcut>
 #include <QKeySequence>
+#include <QElapsedTimer>
 #include <QHash>
+#include <QList>
 #include <QSettings>
 #include <QWidget>
+#include <atomic>
 #include <memory>
 
+/**
+ * @brief Where a key press came from
+ */
+enum class HotkeyContext
+{
+    Application,    // Key event delivered to an EonPlay window
+    Global          // System-wide media key, delivered by a native hook
+};
+
 /**
  * @brief Hotkey action data structure
  */
@@ -19,12 +31,13 @@ struct HotkeyAction
     QKeySequence defaultSequence;
     QKeySequence currentSequence;
     bool enabled = true;
+    bool repeatable = false;    // Held keys keep acting, e.g. seeking
     
     HotkeyAction() = default;
     HotkeyAction(const QString& actionId, const QString& actionName, 
-                const QString& desc, const QKeySequence& sequence)
+                const QString& desc, const QKeySequence& sequence, bool canRepeat = false)
         : id(actionId), name(actionName), description(desc)
-        , defaultSequence(sequence), currentSequence(sequence) {}
+        , defaultSequence(sequence), currentSequence(sequence), repeatable(canRepeat) {}
 };
 
 /**
@@ -32,6 +45,14 @@ struct HotkeyAction
  * 
  * Manages global and local keyboard shortcuts, provides customization
  * interface, and handles hotkey conflicts and validation.
+ *
+ * Bindings are compiled into a flat keymap from (key, modifiers, context)
+ * to a dispatch entry whenever they change, so a key press costs one hash
+ * lookup. Hotkeys are single key combinations for that reason. Repeats are
+ * told apart by timestamps rather than timers: auto-repeated presses of a
+ * repeatable action are reported through actionRepeated with the time since
+ * the previous one, which is what held seek keys scrub with; repeats of
+ * other actions are dropped.
  */
 class HotkeyManager : public QObject
 {
@@ -54,15 +75,17 @@ public:
      * @param name Human-readable action name
      * @param description Action description
      * @param defaultSequence Default key sequence
+     * @param repeatable true if holding the key should keep acting
      * @return true if registration successful
      */
     bool registerAction(const QString& id, const QString& name, 
-                       const QString& description, const QKeySequence& defaultSequence);
+                       const QString& description, const QKeySequence& defaultSequence,
+                       bool repeatable = false);
     
     /**
      * @brief Set hotkey for an action
      * @param actionId Action identifier
-     * @param sequence New key sequence
+     * @param sequence New key sequence, a single key combination
      * @return true if hotkey was set successfully
      */
     bool setHotkey(const QString& actionId, const QKeySequence& sequence);
@@ -127,6 +150,37 @@ public:
      * @brief Show hotkey customization dialog
      */
     void showCustomizationDialog();
+    
+    /**
+     * @brief Look up the action bound to a key
+     * @return Action identifier, or an empty string if unbound or disabled
+     */
+    QString actionForKey(QKeyCombination key, HotkeyContext context = HotkeyContext::Application) const;
+    
+    /**
+     * @brief Dispatch a key press through the compiled keymap
+     * @param key Key and modifiers
+     * @param context Where the press came from
+     * @param autoRepeat true if the key is being held
+     * @return true if an action is bound to the key
+     */
+    bool dispatchKey(QKeyCombination key, HotkeyContext context, bool autoRepeat = false);
+    
+    /**
+     * @brief Queue a global media key press for dispatch
+     *
+     * Lock-free and safe to call from any thread, so native hooks can feed
+     * presses straight in. Presses that arrive before the GUI thread gets to
+     * them are coalesced. Global hooks carry no repeat flag; a press within
+     * GLOBAL_REPEAT_GAP_MS of the previous one counts as a repeat.
+     * @param key Qt::Key_MediaTogglePlayPause, Qt::Key_VolumeUp and so on
+     */
+    void postGlobalKey(int key);
+    
+    static constexpr qint64 GLOBAL_REPEAT_GAP_MS = 200;
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
 
 signals:
     /**
@@ -135,6 +189,14 @@ signals:
      */
     void actionTriggered(const QString& actionId);
     
+    /**
+     * @brief Emitted for each auto-repeat while a repeatable hotkey is held
+     * @param actionId Action identifier
+     * @param intervalMs Time since the previous press or repeat
+     * @param heldMs Time since the key went down
+     */
+    void actionRepeated(const QString& actionId, qint64 intervalMs, qint64 heldMs);
+    
     /**
      * @brief Emitted when hotkey settings change
      * @param actionId Action identifier
@@ -167,12 +229,48 @@ private:
      */
     void registerDefaultHotkeys();
     
+    /**
+     * @brief Compile enabled bindings into the keymap and dispatch table
+     */
+    void rebuildKeymap();
+    
+    /**
+     * @brief Run one dispatch entry, telling presses from repeats
+     */
+    void dispatchEntry(int index, bool autoRepeat);
+    
+    /**
+     * @brief Dispatch global keys queued by postGlobalKey
+     */
+    void drainGlobalKeys();
+    
+    static quint64 keymapKey(QKeyCombination key, HotkeyContext context);
+    
+    struct DispatchEntry {
+        QString actionId;
+        bool repeatable = false;
+        qint64 pressMs = 0;     // When the key went down
+        qint64 lastMs = 0;      // Last press or repeat
+    };
+    
     QWidget* m_parentWidget;
     
     // Hotkey actions and shortcuts
     QHash<QString, HotkeyAction> m_actions;
     QHash<QString, QShortcut*> m_shortcuts;
     
+    // Compiled bindings
+    QHash<quint64, int> m_keymap;
+    QList<DispatchEntry> m_dispatchTable;
+    QElapsedTimer m_clock;
+    
+    // Auto-repeat flag of the last key press, seen before shortcuts fire
+    int m_lastKey;
+    bool m_lastKeyAutoRepeat;
+    
+    // One bit per global media key, set by postGlobalKey
+    std::atomic<quint32> m_pendingGlobalKeys;
+    
     // Settings
     std::unique_ptr<QSettings> m_settings;
     
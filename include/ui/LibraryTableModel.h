@@ -0,0 +1,154 @@
+#ifndef LIBRARYTABLEMODEL_H
+#define LIBRARYTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QCache>
+#include <QHash>
+#include <QMultiHash>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+#include <QVariant>
+#include <memory>
+
+#include "data/LibraryManager.h"
+#include "data/MediaQueryCursor.h"
+
+using EonPlay::Data::DatabaseManager;
+using EonPlay::Data::LibraryManager;
+using EonPlay::Data::MediaQueryCursor;
+
+class AlbumArtLoader;
+
+/**
+ * @brief Virtualized table of library files
+ * 
+ * The model holds only the ordered ids of the matching files (with their
+ * sort keys), paged in through canFetchMore()/fetchMore(). Column values
+ * are read from the database in small blocks around the rows a view asks
+ * for and kept in an LRU cache, so memory stays flat however large the
+ * library is. Sorting and filtering run in SQL.
+ * 
+ * Database change signals are applied as individual row inserts, removals
+ * and updates, coalesced over UPDATE_INTERVAL_MS, instead of resetting the
+ * model. Album art thumbnails are decoded in the background.
+ */
+class LibraryTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    static constexpr int ID_PAGE_SIZE = 8192;
+    static constexpr int ROW_CACHE_SIZE = 4096;     // Rows of column values
+    static constexpr int ROW_FETCH_BLOCK = 128;
+    static constexpr int THUMBNAIL_SIZE = 32;
+    static constexpr int UPDATE_INTERVAL_MS = 250;
+
+    enum Roles {
+        FilePathRole = Qt::UserRole,
+        MediaIdRole,
+        CoverArtRole
+    };
+
+    enum Column {
+        TitleColumn = 0,
+        ArtistColumn,
+        AlbumColumn,
+        GenreColumn,
+        YearColumn,
+        DurationColumn,
+        SizeColumn,
+        DateAddedColumn,
+        PlayCountColumn,
+        ColumnCount
+    };
+
+    explicit LibraryTableModel(QObject* parent = nullptr);
+    ~LibraryTableModel() override;
+
+    void setLibraryManager(LibraryManager* libraryManager);
+
+    /**
+     * @brief Restrict rows to those matching a full-text search
+     */
+    void setSearchText(const QString& searchText);
+
+    /**
+     * @brief Replace the filter; the search text set separately is kept
+     */
+    void setFilter(const MediaQueryCursor::Filter& filter);
+    const MediaQueryCursor::Filter& filter() const { return m_options.filter; }
+
+    /**
+     * @brief Sort by a media_files column, which need not be displayed
+     */
+    void sortByField(const QString& field, Qt::SortOrder order = Qt::AscendingOrder);
+
+    /**
+     * @brief Drop all loaded rows and start over from the first page
+     */
+    void refresh();
+
+    /**
+     * @brief Load every remaining page, for consumers that need all rows
+     */
+    void fetchAll();
+
+    AlbumArtLoader* albumArtLoader() const { return m_albumArtLoader; }
+
+    static QString fieldForColumn(int column);
+
+    // QAbstractItemModel
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+private slots:
+    void onMediaFileChanged(int id);
+    void onMediaFileRemoved(int id);
+    void onMediaFilesUpserted(const QStringList& filePaths);
+    void onThumbnailReady(const QString& imagePath, int size);
+    void applyPendingUpdates();
+
+private:
+    const QVariantList* rowValues(int row) const;
+    void loadRowsAround(int row) const;
+    int lowerBound(const QVariant& key, int id) const;
+    int rowOf(int id) const;
+    void insertId(int id, const QVariant& key);
+    void removeId(int id);
+    void scheduleUpdate();
+    QString displayText(int column, const QVariant& value) const;
+
+    LibraryManager* m_libraryManager;
+    DatabaseManager* m_dbManager;
+    MediaQueryCursor::Options m_options;
+
+    // Ordered ids of matching rows and the key each one is sorted by
+    std::unique_ptr<MediaQueryCursor> m_idCursor;
+    QVector<int> m_ids;
+    QHash<int, QVariant> m_sortKeys;
+    int m_sortKeyIndex;
+
+    // Column values, read on demand
+    std::unique_ptr<MediaQueryCursor> m_rowCursor;
+    mutable QCache<int, QVariantList> m_rowCache;
+    QVector<int> m_valueIndex;          // Display column -> row value index
+    int m_filePathIndex;
+    int m_coverArtIndex;
+
+    AlbumArtLoader* m_albumArtLoader;
+    mutable QMultiHash<QString, int> m_thumbnailWaiters;   // Image -> ids showing it
+
+    // Changes waiting for the next applyPendingUpdates()
+    QSet<int> m_pendingIds;
+    QSet<int> m_pendingRemovals;
+    QStringList m_pendingPaths;
+    QTimer* m_updateTimer;
+};
+
+#endif // LIBRARYTABLEMODEL_H
@@ -13,17 +13,18 @@
 #include <QPushButton>
 #include <QLabel>
 #include <QProgressBar>
-#include <QStandardItemModel>
-#include <QSortFilterProxyModel>
 #include <QMenu>
 #include <QTimer>
 #include <QMutex>
 #include <memory>
 
+class QMovie;
+
 // Include required classes
 #include "data/LibraryManager.h"
 #include "data/MediaFile.h"
 #include "data/PlaylistManager.h"
+#include "ui/LibraryTableModel.h"
 
 // Bring namespaced classes into scope
 using EonPlay::Data::LibraryManager;
@@ -167,6 +168,30 @@ public:
      */
     void setSearchText(const QString& searchText);
 
+    /**
+     * @brief Row at the top of the current view
+     * @return Row, or -1 if the view shows none
+     */
+    int firstVisibleRow() const;
+
+    /**
+     * @brief Scroll the current view so that a row is at its top
+     * @param row Row, loading the ids up to it if needed
+     */
+    void scrollToRow(int row);
+
+    /**
+     * @brief Cover art of the rows on screen
+     * @return Image paths, without duplicates
+     */
+    QStringList visibleCoverArt() const;
+
+    /**
+     * @brief Decode thumbnails in the background before the view asks for them
+     * @param imagePaths Cover art image paths
+     */
+    void warmCoverArt(const QStringList& imagePaths);
+
     /**
      * @brief Get selected media files
      * @return List of selected media files
@@ -264,7 +289,9 @@ private slots:
     void onContextMenuRequested(const QPoint& pos);
     void onLibraryUpdated();
     void updateLibraryStats();
-    void onAlbumArtLoaded(const QString& filePath, const QPixmap& albumArt);
+    void onAlbumArtLoaded(const QString& imagePath, int size);
+    void onItemHovered(const QModelIndex& index);
+    void stopPreview();
 
 private:
     void setupUI();
@@ -281,7 +308,7 @@ private:
     void removeFromLibrary();
     bool exportToJSON(const QString& filePath);
     bool exportToCSV(const QString& filePath);
-    void loadAlbumArt(const QString& filePath);
+    void loadAlbumArt(const QString& imagePath);
     QString formatDuration(qint64 milliseconds) const;
     QString formatFileSize(qint64 bytes) const;
 
@@ -320,8 +347,7 @@ private:
     QProgressBar* m_progressBar;
 
     // Models
-    QStandardItemModel* m_libraryModel;
-    QSortFilterProxyModel* m_proxyModel;
+    LibraryTableModel* m_libraryModel;
 
     // Context menu
     QMenu* m_contextMenu;
@@ -341,15 +367,18 @@ private:
     QString m_searchText;
     LibraryStats m_libraryStats;
 
-    // Album art cache
-    QHash<QString, QPixmap> m_albumArtCache;
+    // Album art, decoded by the model's AlbumArtLoader
+    QString m_albumArtPath;     // Image shown or awaited by the album art label
     QTimer* m_albumArtTimer;
+    QMovie* m_previewMovie;     // Animated preview of the hovered video, shown instead
 
     // Thread safety
     mutable QMutex m_dataMutex;
 
     // Constants
     static constexpr int ALBUM_ART_SIZE = 200;
+    static constexpr int RECENT_DAYS = 30;
+    static constexpr int FAVORITE_RATING = 4;       // Out of 5
     static constexpr int THUMBNAIL_SIZE = 64;
     static constexpr int MAX_ALBUM_ART_CACHE = 100;
 };
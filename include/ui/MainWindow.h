@@ -28,6 +28,8 @@ class SystemTrayManager;
 class MediaKeysManager;
 class NotificationManager;
 class HotkeyManager;
+class MetricsOverlay;
+class SessionSnapshot;
 
 /**
  * @brief Main window for EonPlay - Timeless, futuristic media player
@@ -109,6 +111,20 @@ public slots:
      * @param message Status message to display
      */
     void updateStatusBar(const QString& message);
+    
+    /**
+     * @brief Open files and URLs from the command line or another launch
+     * @param files Absolute paths and URLs
+     */
+    void openFiles(const QStringList& files);
+    
+    /**
+     * @brief Build the side panels that have not been shown yet
+     *
+     * Builds one panel per event loop pass, so call it once startup has
+     * finished; the panels are then ready before they are first opened.
+     */
+    void warmUpPanels();
 
 signals:
     /**
@@ -165,6 +181,7 @@ private slots:
     void onTogglePlaylist();
     void onToggleLibrary();
     void onToggleMediaInfo();
+    void onToggleMetricsOverlay();
     
     /**
      * @brief Handle Tools menu actions
@@ -251,6 +268,24 @@ private:
      */
     void restoreState();
     
+    /**
+     * @brief Map the last session's snapshot and apply its window layout
+     */
+    void restoreSessionLayout();
+    
+    /**
+     * @brief Show the rest of the last session's state, without loading media
+     * 
+     * Builds the panels that were open so they are in the first frame, and
+     * closes the snapshot. Called once the components are available.
+     */
+    void restoreSession();
+    
+    /**
+     * @brief Write the session snapshot read at the next start
+     */
+    void saveSessionSnapshot();
+    
     /**
      * @brief Update recent files menu
      */
@@ -337,6 +372,38 @@ private:
      */
     void handleHotkeyAction(const QString& actionId);
     
+    /**
+     * @brief Handle an auto-repeat of a held hotkey
+     * @param actionId Action identifier
+     * @param intervalMs Time since the previous press or repeat
+     * @param heldMs Time since the key went down
+     */
+    void handleHotkeyRepeat(const QString& actionId, qint64 intervalMs, qint64 heldMs);
+    
+    /**
+     * @brief Move the playback position by an offset, clamped to the media
+     */
+    void seekBy(qint64 offsetMs);
+    
+    /**
+     * @brief Side panel, built and added to the right splitter on first use
+     */
+    MediaInfoWidget* mediaInfoWidget();
+    PlaylistWidget* playlistWidget();
+    LibraryWidget* libraryWidget();
+    
+    /**
+     * @brief Add a hidden panel to the right splitter at its fixed position
+     * @param panel Panel to add
+     * @param slot Position among all side panels, built or not
+     */
+    void insertSidePanel(QWidget* panel, int slot);
+    
+    /**
+     * @brief Show or hide a side panel; the splitter is shown with any panel
+     */
+    void setSidePanelVisible(QWidget* panel, QAction* action, bool visible);
+    
     // Component manager and file support
     ComponentManager* m_componentManager;
     std::shared_ptr<FileUrlSupport> m_fileUrlSupport;
@@ -358,10 +425,22 @@ private:
     // Control widgets (will be implemented in task 3.2)
     PlaybackControls* m_playbackControls;
     
-    // Side panels (will be implemented in later tasks)
+    // Side panels, created on first show or by warmUpPanels()
     PlaylistWidget* m_playlistWidget;
     LibraryWidget* m_libraryWidget;
     MediaInfoWidget* m_mediaInfoWidget;
+    QByteArray m_rightSplitterState;
+    static const int SidePanelCount = 3;
+    
+    // A seek hotkey jumps on press, then scrubs while held, faster the
+    // longer it is held; the gap before the first repeat is not scrubbed
+    static const int SeekStepMs = 10000;
+    static const int MaxScrubIntervalMs = 100;
+    static constexpr double MinScrubRate = 8.0;
+    static constexpr double MaxScrubRate = 64.0;
+    
+    // Debug overlay, created on first use
+    MetricsOverlay* m_metricsOverlay;
     
     // Drag and drop support
     DragDropWidget* m_dragDropWidget;
@@ -386,6 +465,7 @@ private:
     QAction* m_togglePlaylistAction;
     QAction* m_toggleLibraryAction;
     QAction* m_toggleMediaInfoAction;
+    QAction* m_toggleMetricsOverlayAction;
     
     // Tools menu actions
     QAction* m_preferencesAction;
@@ -409,6 +489,9 @@ private:
     // Settings
     std::unique_ptr<QSettings> m_settings;
     
+    // Last session's snapshot, mapped until restoreSession() applied it
+    std::unique_ptr<SessionSnapshot> m_sessionSnapshot;
+    
     // Auto-save timer
     QTimer* m_saveTimer;
     
@@ -7,11 +7,13 @@
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QScrollArea>
-#include <QTimer>
+#include <QPointer>
 #include <memory>
 #include "media/FileUrlSupport.h"
+#include "media/MediaOpenProfiler.h"
 
 class FileUrlSupport;
+class VideoWidget;
 
 /**
  * @brief Widget for displaying detailed media information
@@ -25,6 +27,8 @@ class MediaInfoWidget : public QWidget
     Q_OBJECT
 
 public:
+    static constexpr int PLAYBACK_STATS_RATE_HZ = 1;
+    
     explicit MediaInfoWidget(QWidget* parent = nullptr);
     ~MediaInfoWidget() override;
     
@@ -34,6 +38,16 @@ public:
      */
     void setFileUrlSupport(std::shared_ptr<FileUrlSupport> fileUrlSupport);
     
+    /**
+     * @brief Set the video view whose playback statistics are shown
+     * 
+     * Frame timing of the view and decoder statistics of its backend are
+     * refreshed every second while the widget is visible.
+     * 
+     * @param videoWidget Main video view, or nullptr to hide the statistics
+     */
+    void setVideoWidget(VideoWidget* videoWidget);
+    
     /**
      * @brief Update display with new media information
      * @param mediaInfo Media information to display
@@ -91,6 +105,17 @@ public slots:
      * @brief Toggle technical details visibility
      */
     void toggleTechnicalDetails();
+    
+    /**
+     * @brief Show how long the media took to open
+     * @param profile Latency breakdown of the open
+     */
+    void updateOpenProfile(const MediaOpenProfile& profile);
+    
+    /**
+     * @brief Refresh frame timing and decoder statistics
+     */
+    void updatePlaybackStats();
 
 signals:
     /**
@@ -104,6 +129,9 @@ signals:
      */
     void screenshotRequested();
 
+protected:
+    void showEvent(QShowEvent* event) override;
+
 private slots:
     /**
      * @brief Handle media info extraction completion
@@ -156,6 +184,12 @@ private:
      */
     QWidget* createTechnicalInfoSection();
     
+    /**
+     * @brief Create the playback statistics section
+     * @return Widget containing playback statistics
+     */
+    QWidget* createPlaybackStatsSection();
+    
     /**
      * @brief Update basic information labels
      * @param mediaInfo Media information to display
@@ -247,7 +281,14 @@ private:
     QLabel* m_filePathLabel;
     QLabel* m_hasVideoLabel;
     QLabel* m_hasAudioLabel;
-    
-    // Update timer for periodic refresh
-    QTimer* m_updateTimer;
+    QLabel* m_openLatencyLabel;
+    
+    // Playback statistics section
+    QPointer<VideoWidget> m_videoWidget;
+    QGroupBox* m_playbackStatsGroup;
+    QLabel* m_decoderLabel;
+    QLabel* m_droppedFramesLabel;
+    QLabel* m_frameTimeLabel;
+    QLabel* m_lateFramesLabel;
+    QLabel* m_inputBitrateLabel;
 };
\ No newline at end of file
@@ -2,7 +2,9 @@
 
 #include <QObject>
 #include <QAbstractNativeEventFilter>
-#include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <array>
 #include <memory>
 
 #ifdef Q_OS_WIN
@@ -10,12 +12,15 @@
 #endif
 
 class IMediaEngine;
+class HotkeyManager;
 
 /**
  * @brief System media keys integration manager
  * 
  * Handles global media key events (Play/Pause, Stop, Next, Previous, Volume)
  * across different platforms (Windows Media Foundation, Linux MPRIS).
+ * With a HotkeyManager set, every press is also fed into its keymap as a
+ * global key, so media keys and hotkeys dispatch through one table.
  */
 class MediaKeysManager : public QObject, public QAbstractNativeEventFilter
 {
@@ -42,6 +47,12 @@ public:
      */
     void setMediaEngine(std::shared_ptr<IMediaEngine> mediaEngine);
     
+    /**
+     * @brief Feed presses into a hotkey manager's keymap
+     * @param manager Hotkey manager, or nullptr to stop
+     */
+    void setHotkeyManager(HotkeyManager* manager);
+    
     /**
      * @brief Enable or disable media keys handling
      * @param enabled true to enable media keys
@@ -132,6 +143,25 @@ private slots:
     void onMute();
 
 private:
+    enum MediaKey {
+        PlayPauseKey,
+        StopKey,
+        NextKey,
+        PreviousKey,
+        VolumeUpKey,
+        VolumeDownKey,
+        MuteKey,
+        MediaKeyCount
+    };
+    
+    /**
+     * @brief Forward a press and emit its signal unless it is a bounce
+     *
+     * Volume keys repeat while held; the others are debounced against the
+     * time of their previous press.
+     */
+    void handleKey(MediaKey key);
+    
     /**
      * @brief Initialize Windows media keys support
      * @return true if successful
@@ -208,9 +238,11 @@ private:
     std::unique_ptr<MPRISInterface> m_mprisInterface;
 #endif
     
-    // Debounce timer for rapid key presses
-    QTimer* m_debounceTimer;
-    QString m_lastKeyPressed;
+    QPointer<HotkeyManager> m_hotkeyManager;
+    
+    // Time of each key's last press, for debouncing
+    QElapsedTimer m_clock;
+    std::array<qint64, MediaKeyCount> m_lastPressMs;
     
     static constexpr int DEBOUNCE_INTERVAL_MS = 200;
 };
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QWidget>
+#include "Metrics.h"
+
+class QLabel;
+
+/**
+ * @brief Debug overlay with live MetricsRegistry figures
+ * 
+ * Shows counters as rates per second and latency histograms as
+ * p50/p99/max, refreshed by the UpdateScheduler while visible. Ignores the mouse so the
+ * widget below keeps working.
+ */
+class MetricsOverlay : public QWidget
+{
+    Q_OBJECT
+
+public:
+    static constexpr int REFRESH_INTERVAL_MS = 500;
+    
+    explicit MetricsOverlay(QWidget* parent = nullptr);
+    ~MetricsOverlay() override;
+
+protected:
+    void showEvent(QShowEvent* event) override;
+
+private:
+    void refresh();
+    
+    QLabel* m_label;
+    MetricsSnapshot m_previous;
+};
@@ -11,6 +11,8 @@
 #include <QMouseEvent>
 #include <QResizeEvent>
 #include <QCloseEvent>
+#include <QShowEvent>
+#include <QHideEvent>
 #include <QContextMenuEvent>
 #include <QMenu>
 #include <QActionGroup>
@@ -19,6 +21,7 @@
 // Forward declarations
 class PlaybackController;
 class VideoWidget;
+class VideoSurfaceView;
 
 /**
  * @brief Mini player with always-on-top floating window
@@ -51,6 +54,9 @@ public:
 
     /**
      * @brief Set video widget
+     *
+     * The widget stays where it is; its frames are shown here as well.
+     *
      * @param videoWidget Video widget instance
      */
     void setVideoWidget(VideoWidget* videoWidget);
@@ -175,6 +181,8 @@ protected:
     void resizeEvent(QResizeEvent* event) override;
     void closeEvent(QCloseEvent* event) override;
     void contextMenuEvent(QContextMenuEvent* event) override;
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
 
 private slots:
     void onPlayPauseClicked();
@@ -198,6 +206,7 @@ private:
     void updatePlayPauseButton();
     void updatePositionSlider();
     void updateVolumeSlider();
+    void updatePositionSubscription();
     QString formatTime(qint64 milliseconds) const;
 
     // UI components
@@ -208,7 +217,7 @@ private:
 
     // Video display
     QWidget* m_videoContainer;
-    VideoWidget* m_videoWidget;
+    VideoSurfaceView* m_videoSurface;       // Shares the main view's decoded frames
     QLabel* m_albumArtLabel;
 
     // Controls
@@ -253,7 +262,6 @@ private:
 
     // Auto-hide timer
     QTimer* m_autoHideTimer;
-    QTimer* m_updateTimer;
 
     // Constants
     static constexpr int DEFAULT_WIDTH = 320;
@@ -261,6 +269,7 @@ private:
     static constexpr int COMPACT_HEIGHT = 80;
     static constexpr int DEFAULT_AUTO_HIDE_TIMEOUT = 3000; // 3 seconds
     static constexpr float DEFAULT_OPACITY = 0.9f;
+    static constexpr int POSITION_UPDATE_INTERVAL_MS = 250; // While visible; hidden it is not updated
 };
 
 #endif // MINIPLAYERWIDGET_H
\ No newline at end of file
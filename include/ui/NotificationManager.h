@@ -21,6 +21,9 @@ struct NotificationData
     QString iconPath;
     int duration = 3000; // Duration in milliseconds
     bool isUrgent = false;
+    QString category;    // Notifications of one category merge into a summary
+    QString summary;     // Message once merged, %1 is the count; generic if empty
+    int count = 1;       // Notifications merged into this one
     
     NotificationData() = default;
     NotificationData(const QString& t, const QString& m, int d = 3000)
@@ -47,6 +50,14 @@ public:
      */
     void setNotification(const NotificationData& data);
     
+    /**
+     * @brief Replace the content of a shown notification
+     *
+     * Restarts the auto-hide timer; the notification is not animated again.
+     * @param data Notification data
+     */
+    void updateNotification(const NotificationData& data);
+    
     /**
      * @brief Show notification with animation
      */
@@ -68,6 +79,18 @@ public:
      * @return true if visible
      */
     bool isNotificationVisible() const { return m_isVisible; }
+    
+    /**
+     * @brief Check if the notification is shown or animating in or out
+     * @return true until the hide animation has finished
+     */
+    bool isActive() const { return m_isVisible || m_isAnimating; }
+    
+    /**
+     * @brief Check if the hide animation is running
+     * @return true while fading out
+     */
+    bool isHiding() const { return m_isVisible && m_isAnimating; }
 
 signals:
     /**
@@ -152,6 +175,7 @@ private:
     
     // Notification data
     NotificationData m_currentNotification;
+    QString m_iconKey;  // Source of the pixmap the icon label shows
     
     // State
     bool m_isVisible;
@@ -163,6 +187,12 @@ private:
  * 
  * Manages notification display queue, positioning, and system integration
  * for showing media events and user feedback messages.
+ * 
+ * Bulk operations can report thousands of events per second. Notifications
+ * with a category merge into the shown or queued one of the same category,
+ * which then reads as a summary ("1,203 files added"); the shown text is
+ * refreshed at most every SUMMARY_REFRESH_INTERVAL_MS. One notification
+ * widget, with its animations and timer, is reused for everything.
  */
 class NotificationManager : public QObject
 {
@@ -274,6 +304,25 @@ public slots:
      * @param message Error message
      */
     void onError(const QString& title, const QString& message);
+    
+    /**
+     * @brief Handle a file added to the library; merged during scans
+     * @param filePath Path to the added file
+     */
+    void onFileAdded(const QString& filePath);
+    
+    /**
+     * @brief Handle subtitles loaded automatically; merged during batches
+     * @param mediaFilePath Media the subtitles belong to
+     * @param subtitlePath Loaded subtitle file
+     */
+    void onSubtitleAutoLoaded(const QString& mediaFilePath, const QString& subtitlePath);
+    
+    /**
+     * @brief Handle a completed operation; merged per operation
+     * @param operation Operation name
+     */
+    void onOperationCompleted(const QString& operation);
 
 signals:
     /**
@@ -297,6 +346,11 @@ private slots:
      * @brief Process next notification in queue
      */
     void processNextNotification();
+    
+    /**
+     * @brief Show the summary merged into the active notification
+     */
+    void refreshActiveNotification();
 
 private:
     /**
@@ -306,19 +360,38 @@ private:
     void positionNotificationWidget(NotificationWidget* widget);
     
     /**
-     * @brief Create notification widget
-     * @return New notification widget
+     * @brief Get the notification widget, created on first use
+     * @return Notification widget
      */
-    NotificationWidget* createNotificationWidget();
+    NotificationWidget* notificationWidget();
+    
+    /**
+     * @brief Merge into the active or a queued notification of the same category
+     * @param data Notification to merge
+     * @return true if merged
+     */
+    bool mergeNotification(const NotificationData& data);
+    
+    /**
+     * @brief Message of a merged notification
+     * @param data Notification with its merged count
+     * @return Summary text
+     */
+    QString summaryMessage(const NotificationData& data) const;
     
     QWidget* m_parentWidget;
     
     // Notification queue
     QQueue<NotificationData> m_notificationQueue;
     
-    // Active notification widget
+    // Notification widget, reused for every notification
     NotificationWidget* m_activeNotification;
     
+    // Summary waiting to be shown in the active notification
+    NotificationData m_pendingUpdate;
+    bool m_updatePending;
+    QTimer* m_refreshTimer;
+    
     // Settings
     int m_defaultDuration;
     bool m_enabled;
@@ -327,4 +400,8 @@ private:
     // Spacing and margins
     static constexpr int NOTIFICATION_MARGIN = 20;
     static constexpr int NOTIFICATION_SPACING = 10;
+    
+    // Aggregation
+    static constexpr int SUMMARY_REFRESH_INTERVAL_MS = 250;
+    static constexpr int MAX_QUEUED_NOTIFICATIONS = 8;
 };
\ No newline at end of file
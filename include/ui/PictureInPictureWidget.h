@@ -18,6 +18,7 @@
 
 // Forward declarations
 class VideoWidget;
+class VideoSurfaceView;
 class PlaybackController;
 
 /**
@@ -58,6 +59,9 @@ public:
 
     /**
      * @brief Set video widget
+     *
+     * The widget stays where it is; its frames are shown here as well.
+     *
      * @param videoWidget Video widget instance
      */
     void setVideoWidget(VideoWidget* videoWidget);
@@ -242,7 +246,7 @@ private:
 
     // Video display
     QWidget* m_videoContainer;
-    VideoWidget* m_videoWidget;
+    VideoSurfaceView* m_videoSurface;       // Shares the main view's decoded frames
 
     // Controls
     QPushButton* m_playPauseButton;
@@ -288,7 +292,6 @@ private:
 
     // Auto-hide timer
     QTimer* m_autoHideTimer;
-    QTimer* m_updateTimer;
 
     // Opacity effect
     QGraphicsOpacityEffect* m_opacityEffect;
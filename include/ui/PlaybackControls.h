@@ -18,6 +18,13 @@
 
 class PlaybackController;
 class ComponentManager;
+class WaveformOverviewWidget;
+
+namespace EonPlay {
+namespace Data {
+class LoudnessScanner;
+}
+}
 
 /**
  * @brief Playback controls widget for EonPlay media player
@@ -106,6 +113,22 @@ public:
      * @return Playback speed multiplier
      */
     double playbackSpeed() const { return m_playbackSpeed; }
+    
+    /**
+     * @brief Get the file set with setMediaFile()
+     * @return File path, empty for none
+     */
+    QString mediaFile() const { return m_mediaFilePath; }
+    
+    /**
+     * @brief Show the waveform overview of the loaded file above the seek slider
+     * 
+     * The overview is read from the waveform store. A file without one is
+     * queued for analysis ahead of the library and appears once written.
+     * 
+     * @param filePath Local media file, empty for none
+     */
+    void setMediaFile(const QString& filePath);
 
 public slots:
     /**
@@ -147,6 +170,15 @@ signals:
      */
     void seekRequested(qint64 position);
     
+    /**
+     * @brief Emitted while the user drags the seek slider
+     * 
+     * seekRequested() follows on release with the final position.
+     * 
+     * @param position Position under the handle in milliseconds
+     */
+    void scrubRequested(qint64 position);
+    
     /**
      * @brief Emitted when volume changes
      * @param volume New volume level (0-100)
@@ -230,6 +262,18 @@ private slots:
      */
     void onSeekSliderReleased();
     
+    /**
+     * @brief Seek to a position clicked on the waveform
+     * @param fraction Position as a fraction of the duration
+     */
+    void onWaveformSeekRequested(double fraction);
+    
+    /**
+     * @brief Show an overview that was just written, if it is for the loaded file
+     * @param filePath Analyzed file
+     */
+    void onWaveformReady(const QString& filePath);
+    
     /**
      * @brief Handle volume slider change
      * @param value New volume value
@@ -323,6 +367,12 @@ private:
      */
     qint64 calculateSeekPosition(int mouseX) const;
     
+    /**
+     * @brief Read the loaded file's overview from the waveform store
+     * @return false if there is none
+     */
+    bool loadWaveform();
+    
     // Component manager
     ComponentManager* m_componentManager;
     PlaybackController* m_playbackController;
@@ -340,6 +390,9 @@ private:
     // Seek controls
     QSlider* m_seekSlider;
     QLabel* m_seekPreviewLabel;
+    WaveformOverviewWidget* m_waveformView;
+    QString m_mediaFilePath;
+    EonPlay::Data::LoudnessScanner* m_loudnessScanner;
     
     // Volume controls
     QSlider* m_volumeSlider;
@@ -0,0 +1,144 @@
+#ifndef PLAYLISTMODEL_H
+#define PLAYLISTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QStyledItemDelegate>
+#include <QVector>
+#include <memory>
+
+#include "data/Playlist.h"
+
+using EonPlay::Data::MediaFile;
+using EonPlay::Data::Playlist;
+
+/**
+ * @brief Rows of a Playlist for the playlist views
+ *
+ * Holds no copies of the items; rows read straight from the playlist. The
+ * playlist's itemAdded, itemRemoved and itemMoved signals become row
+ * inserts, removals and moves, collected until the playlistModified() that
+ * ends each edit, so a batch edit turns each run of neighbouring rows into
+ * one signal. Edits the playlist only reports as modified, such as sorting
+ * it in place or refreshing metadata, become dataChanged() while the row
+ * count holds and a reset otherwise.
+ *
+ * Sorting is a view order: a permutation of playlist indices, while the
+ * playlist keeps its own order. A sorted model takes single edits row by
+ * row and resets on batches, and cannot be reordered by drag and drop.
+ */
+class PlaylistModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_ROW_SIGNALS = 256;     // More and a reset is cheaper
+    static constexpr const char* ROWS_MIME_TYPE = "application/x-eonplay-playlist-rows";
+
+    enum Roles {
+        FilePathRole = Qt::UserRole,
+        PlaylistIndexRole
+    };
+
+    enum Column {
+        TitleColumn = 0,
+        ArtistColumn,
+        AlbumColumn,
+        DurationColumn,
+        ColumnCount
+    };
+
+    explicit PlaylistModel(QObject* parent = nullptr);
+    ~PlaylistModel() override;
+
+    void setPlaylist(std::shared_ptr<Playlist> playlist);
+    std::shared_ptr<Playlist> playlist() const { return m_playlist; }
+
+    /**
+     * @brief Order rows by a field; SortByPosition shows the playlist order
+     */
+    void setSortOrder(Playlist::SortOrder order, Qt::SortOrder direction = Qt::AscendingOrder);
+    Playlist::SortOrder sortOrder() const { return m_sortOrder; }
+    bool isSorted() const { return m_sortOrder != Playlist::SortByPosition; }
+
+    int playlistIndex(int row) const;
+    int rowOf(int playlistIndex) const;
+    MediaFile fileAt(int row) const;
+
+    // QAbstractItemModel
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+    Qt::DropActions supportedDropActions() const override;
+    QStringList mimeTypes() const override;
+    QMimeData* mimeData(const QModelIndexList& indexes) const override;
+    bool dropMimeData(const QMimeData* data, Qt::DropAction action, int row, int column,
+                      const QModelIndex& parent) override;
+    bool moveRows(const QModelIndex& sourceParent, int sourceRow, int count,
+                  const QModelIndex& destinationParent, int destinationChild) override;
+
+private slots:
+    void onItemAdded(int index);
+    void onItemRemoved(int index);
+    void onItemMoved(int fromIndex, int toIndex);
+    void onPlaylistCleared();
+    void onPlaylistModified();
+    void onCurrentIndexChanged(int index);
+
+private:
+    struct Change {
+        enum Type {
+            Insert,
+            Remove,
+            Move
+        };
+
+        Type type;
+        int index;
+        int toIndex;
+    };
+
+    void reset();
+    bool applyInPlaylistOrder();
+    void applySorted(const Change& change);
+    void resort();
+    void buildOrder();
+    void buildRows();
+    bool lessThan(int a, int b) const;
+
+    std::shared_ptr<Playlist> m_playlist;
+    Playlist::SortOrder m_sortOrder;
+    Qt::SortOrder m_sortDirection;
+    int m_rowCount;                 // As last reported to the views
+    int m_currentIndex;
+
+    // While sorted
+    QVector<int> m_order;           // Row -> playlist index
+    QVector<int> m_rows;            // Playlist index -> row
+
+    // Edits waiting for the playlistModified() that ends them
+    QVector<Change> m_changes;
+    bool m_cleared;
+};
+
+/**
+ * @brief Delegate with one fixed row height, so views never measure rows
+ */
+class PlaylistItemDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit PlaylistItemDelegate(QObject* parent = nullptr);
+
+    int rowHeight() const { return m_rowHeight; }
+    void setRowHeight(int height);
+
+    QSize sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+
+private:
+    int m_rowHeight;
+};
+
+#endif // PLAYLISTMODEL_H
@@ -2,8 +2,8 @@
 #define PLAYLISTWIDGET_H
 
 #include <QWidget>
-#include <QListWidget>
-#include <QTreeWidget>
+#include <QListView>
+#include <QTreeView>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLineEdit>
@@ -19,6 +19,7 @@
 #include "data/PlaylistManager.h"
 #include "data/Playlist.h"
 #include "data/MediaFile.h"
+#include "ui/PlaylistModel.h"
 
 // Bring namespaced classes into scope
 using EonPlay::Data::PlaylistManager;
@@ -30,6 +31,11 @@ using EonPlay::Data::MediaFile;
  * 
  * Provides a complete playlist interface with drag-and-drop support,
  * playlist creation, editing, and advanced playlist features.
+ *
+ * Both views show one PlaylistModel and share its selection. Rows are
+ * read on demand at one fixed height, so large playlists scroll without
+ * per-item widgets, and edits reach the views as row changes rather than
+ * rebuilds.
  */
 class PlaylistWidget : public QWidget
 {
@@ -233,7 +239,7 @@ protected:
     void dropEvent(QDropEvent* event) override;
 
 private slots:
-    void onItemDoubleClicked(QListWidgetItem* item);
+    void onItemDoubleClicked(const QModelIndex& index);
     void onItemSelectionChanged();
     void onContextMenuRequested(const QPoint& pos);
     void onDisplayModeChanged();
@@ -250,8 +256,9 @@ private:
     void setupUI();
     void setupConnections();
     void createContextMenu();
-    void populatePlaylistView();
+    void updateCurrentView();
     void updatePlaylistStats();
+    QList<int> selectedPlaylistIndices() const;
     void moveSelectedItems(int direction);
     QString formatDuration(qint64 milliseconds) const;
     QString formatFileSize(qint64 bytes) const;
@@ -276,8 +283,10 @@ private:
     QPushButton* m_moveDownButton;
 
     // Views
-    QListWidget* m_listWidget;
-    QTreeWidget* m_treeWidget;
+    PlaylistModel* m_model;
+    PlaylistItemDelegate* m_delegate;
+    QListView* m_listView;
+    QTreeView* m_treeView;
     QWidget* m_currentView;
 
     // Status
@@ -0,0 +1,100 @@
+#ifndef SPECTRUMGLVIEW_H
+#define SPECTRUMGLVIEW_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QColor>
+#include <QVector>
+#include <memory>
+
+/**
+ * @brief GPU renderer for the spectrum visualizations of AudioVisualizerWidget
+ *
+ * Bar and peak levels are uploaded once per frame as a single-row float
+ * texture, and a full-screen fragment shader evaluates bars, peaks,
+ * gradients, glow, the circular layout and the AI particles per pixel.
+ * Waveform and VU modes stay on the QPainter path. When the context or the
+ * shaders are unavailable, hasFailed() reports it and the owner keeps
+ * painting on the CPU.
+ */
+class SpectrumGLView : public QOpenGLWidget, protected QOpenGLExtraFunctions
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Geometry used to lay out the spectrum
+     */
+    enum Layout {
+        BarsLayout = 0,
+        CircularLayout,
+        LineLayout
+    };
+
+    /**
+     * @brief Per-frame state mirrored from AudioVisualizerWidget
+     */
+    struct FrameData {
+        QVector<float> bars;        // Animated magnitudes (0.0 to 1.0)
+        QVector<float> peaks;       // Peak hold levels (0.0 to 1.0)
+        Layout layout;
+        int style;                  // AudioVisualizerWidget::VisualizationStyle
+        bool particles;             // AI visualizer particle overlay
+        bool backgroundEnabled;
+        bool gradientEnabled;
+        bool glowEnabled;
+        QColor backgroundColor;
+        QColor primaryColor;
+        QVector<QColor> palette;
+        float animationPhase;
+
+        FrameData() : layout(BarsLayout), style(0), particles(false), backgroundEnabled(true),
+                      gradientEnabled(true), glowEnabled(false), animationPhase(0.0f) {}
+    };
+
+    static constexpr int MAX_BARS = 512;
+    static constexpr int MAX_PALETTE = 8;
+
+    explicit SpectrumGLView(QWidget* parent = nullptr);
+    ~SpectrumGLView() override;
+
+    /**
+     * @brief Set the state for the next frame and schedule a repaint
+     * @param frame Frame state
+     */
+    void setFrame(const FrameData& frame);
+
+    /**
+     * @brief Check whether GPU initialization failed
+     * @return true if the QPainter fallback must be used
+     */
+    bool hasFailed() const { return m_failed; }
+
+signals:
+    /**
+     * @brief Emitted once if the GL context or shaders cannot be created
+     */
+    void renderingFailed();
+
+protected:
+    void initializeGL() override;
+    void paintGL() override;
+
+private:
+    void fail(const QString& reason);
+    void releaseResources();
+    void uploadLevels();
+
+    FrameData m_frame;
+    bool m_failed;
+    bool m_levelsDirty;
+
+    std::unique_ptr<QOpenGLShaderProgram> m_program;
+    QOpenGLVertexArrayObject m_vao;
+    GLuint m_levelTexture;
+    QVector<float> m_levelUpload;
+};
+
+#endif // SPECTRUMGLVIEW_H
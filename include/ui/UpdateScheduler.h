@@ -0,0 +1,98 @@
+#ifndef UPDATESCHEDULER_H
+#define UPDATESCHEDULER_H
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QWidget>
+#include <functional>
+
+class QScreen;
+
+/**
+ * @brief Shared clock for widgets that refresh themselves periodically
+ *
+ * Instead of each widget running its own timer, widgets subscribe with the
+ * rate they want and a callback. One precise timer serves all of them; its
+ * period is a whole number of display frames, taken from the primary
+ * screen's refresh rate, so redraws line up with the frames the compositor
+ * presents and several widgets repaint in the same frame.
+ *
+ * A subscriber is only called while it is active: shown, and in a window
+ * that is not minimized. When no subscriber is active the timer stops, so
+ * a minimized or hidden-to-tray window costs no wake-ups. The PowerPolicy
+ * may cap every subscriber's rate while saving power. GUI thread only.
+ */
+class UpdateScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_RATE_HZ = 240;
+
+    static UpdateScheduler& instance();
+
+    /**
+     * @brief Call a function at up to rateHz while the widget is active
+     *
+     * Replaces an existing subscription of the same widget. The subscription
+     * ends with the widget.
+     */
+    void subscribe(QWidget* widget, int rateHz, std::function<void()> callback);
+    void unsubscribe(QWidget* widget);
+    void setRate(QWidget* widget, int rateHz);
+
+    /**
+     * @brief Cap every subscriber's rate; 0 for no cap
+     */
+    void setRateLimit(int rateHz);
+    int rateLimit() const { return m_rateLimitHz; }
+
+    bool isSubscribed(QWidget* widget) const { return m_subscriptions.contains(widget); }
+    bool isActive(QWidget* widget) const;
+
+    /**
+     * @brief Length of one display frame in milliseconds
+     */
+    double framePeriodMs() const { return m_framePeriodMs; }
+
+signals:
+    /**
+     * @brief A subscriber was shown, hidden, minimized or restored
+     */
+    void activeChanged(QWidget* widget, bool active);
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private:
+    struct Subscription {
+        QPointer<QWidget> window;   // Watched for minimize and restore
+        int rateHz = 0;
+        std::function<void()> callback;
+        qint64 lastTickMs = 0;
+        bool active = false;
+    };
+
+    explicit UpdateScheduler(QObject* parent = nullptr);
+
+    void onTick();
+    void scheduleActivityUpdate();
+    void updateActivity();
+    void updateTimer();
+    void updateFramePeriod();
+    void watchWindow(QWidget* widget, Subscription& subscription);
+    void releaseWindow(QWidget* window);
+    int periodMs(int rateHz) const;
+    static bool isWidgetActive(QWidget* widget);
+
+    QHash<QWidget*, Subscription> m_subscriptions;
+    QTimer m_timer;
+    QPointer<QScreen> m_screen;
+    double m_framePeriodMs;
+    int m_rateLimitHz;
+    bool m_activityUpdatePending;
+};
+
+#endif // UPDATESCHEDULER_H
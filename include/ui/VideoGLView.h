@@ -0,0 +1,156 @@
+#ifndef VIDEOGLVIEW_H
+#define VIDEOGLVIEW_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QPointer>
+#include <QRectF>
+#include <memory>
+#include "media/VideoFrame.h"
+#include "video/VideoProcessor.h"
+#include "video/ToneMapper.h"
+
+class VideoFilterGraph;
+class GpuVideoOutput;
+
+/**
+ * @brief GPU presenter for decoded video frames of VideoWidget
+ *
+ * Each pooled frame is uploaded straight from its buffer into a texture
+ * that is reused while the picture size stays the same. A single fragment
+ * shader then applies brightness, contrast and gamma while the vertex
+ * stage places, rotates and mirrors the picture, so changing any of them
+ * only changes uniforms: no pixels are touched on the CPU and the decoder
+ * is never reconfigured. A VideoProcessor filter chain, when set, runs
+ * first through a VideoFilterGraph; its result is kept, so changing only
+ * the adjustments does not run the filters again. HDR frames are tone
+ * mapped to SDR by one lookup in a ToneMapper table held as a 3D texture,
+ * ahead of the adjustments. With a GpuVideoOutput set, pictures it renders
+ * are drawn straight from its textures and nothing is uploaded. When the
+ * context or the shaders are unavailable, hasFailed() reports it and the
+ * owner keeps painting with QPainter.
+ */
+class VideoGLView : public QOpenGLWidget, protected QOpenGLExtraFunctions
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Picture adjustments, mirrored from VideoWidget
+     */
+    struct Adjustments {
+        int brightness = 0;             // -100 to 100
+        int contrast = 0;               // -100 to 100
+        double gamma = 1.0;             // 0.1 to 10.0
+        int rotation = 0;               // 0, 90, 180 or 270 degrees clockwise
+        bool horizontalMirror = false;
+        bool verticalMirror = false;
+        double aspectRatio = 0.0;       // Display aspect ratio, 0 = the frame's own
+        QRectF crop = QRectF(0.0, 0.0, 1.0, 1.0);  // Shown part of the frame, before rotation
+        bool fill = false;              // Stretch over the whole view instead of fitting
+    };
+
+    explicit VideoGLView(QWidget* parent = nullptr);
+    ~VideoGLView() override;
+
+    /**
+     * @brief Show a frame; it is kept to upload again if the context is recreated
+     * @param frame Decoded frame
+     */
+    void setFrame(const VideoFrameRef& frame);
+
+    /**
+     * @brief Set the adjustments used from the next repaint on
+     * @param adjustments Picture adjustments
+     */
+    void setAdjustments(const Adjustments& adjustments);
+
+    /**
+     * @brief Set the filters run on each frame before the adjustments
+     *
+     * Takes effect at the next repaint, filters and parameters together.
+     *
+     * @param chain Filter chain; an empty one turns filtering off
+     */
+    void setFilterChain(const VideoProcessor::FilterChain& chain);
+
+    /**
+     * @brief Set the tone mapping table applied before the adjustments
+     * @param lut Table from ToneMapper::lut(); nullptr turns tone mapping off
+     */
+    void setToneMapping(const ToneMapper::LutRef& lut);
+
+    /**
+     * @brief Show the pictures of a GPU output as they arrive
+     *
+     * Frames passed to setFrame() take over again until the output's next
+     * picture.
+     *
+     * @param output Output sharing this view's context; nullptr to stop
+     */
+    void setGpuOutput(GpuVideoOutput* output);
+
+    /**
+     * @brief Check whether the picture on screen came from the GPU output
+     */
+    bool showsGpuFrame() const { return m_gpuOutput && m_showGpuFrame; }
+
+    /**
+     * @brief Read the GPU output's picture on screen back into memory, for screenshots
+     * @return RGB32 frame, or nullptr if no GPU picture is shown
+     */
+    VideoFrameRef readGpuFrame();
+
+    /**
+     * @brief Check whether GPU initialization failed
+     * @return true if the QPainter fallback must be used
+     */
+    bool hasFailed() const { return m_failed; }
+
+signals:
+    /**
+     * @brief Emitted once if the GL context or shaders cannot be created
+     */
+    void renderingFailed();
+
+    /**
+     * @brief Emitted when a GL context was created and set up, also after a recreation
+     */
+    void contextReady();
+
+protected:
+    void initializeGL() override;
+    void paintGL() override;
+
+private:
+    void fail(const QString& reason);
+    void releaseResources();
+    void uploadFrame();
+    void uploadToneMapping();
+
+    VideoFrameRef m_frame;
+    Adjustments m_adjustments;
+    VideoProcessor::FilterChain m_filterChain;
+    bool m_failed;
+    bool m_frameDirty;
+    bool m_filterChainDirty;
+    bool m_filteredDirty;                   // Filter output is older than the frame or chain
+    ToneMapper::LutRef m_toneMapLut;
+    bool m_toneMapDirty;
+
+    std::unique_ptr<QOpenGLShaderProgram> m_program;
+    QOpenGLVertexArrayObject m_vao;
+    GLuint m_frameTexture;
+    QSize m_textureSize;
+    std::unique_ptr<VideoFilterGraph> m_filterGraph;
+    GLuint m_filteredTexture;
+    GLuint m_toneMapTexture;                // 3D, on texture unit 1
+
+    QPointer<GpuVideoOutput> m_gpuOutput;
+    bool m_showGpuFrame;                    // Its pictures came after the last setFrame()
+    quint64 m_gpuSerial;                    // Picture this context last waited for
+};
+
+#endif // VIDEOGLVIEW_H
@@ -0,0 +1,125 @@
+#ifndef VIDEOSURFACEVIEW_H
+#define VIDEOSURFACEVIEW_H
+
+#include <QWidget>
+#include <QMutex>
+#include <QPointer>
+#include <QRectF>
+#include <atomic>
+#include "media/VideoFrame.h"
+
+class VideoWidget;
+class VLCBackend;
+#ifdef HAVE_QT_OPENGL
+class VideoGLView;
+#endif
+
+/**
+ * @brief Secondary view of the video shown by a VideoWidget
+ *
+ * Picture-in-picture and the mini player show the same decoded frames as
+ * the main view: the view registers as one more frame sink of the source
+ * widget's backend, so every consumer samples the same pooled frame and
+ * nothing is decoded, copied or re-attached a second time. Each view
+ * scales the picture to its own size, on the GPU through a VideoGLView
+ * when available, and follows the source's adjustments, transformations
+ * and tone mapping.
+ *
+ * A hidden view unregisters and drops its frame, so it costs nothing and
+ * holds no pool buffer; when shown again it starts from the source's
+ * current frame, making a switch between modes immediate.
+ *
+ * While the source keeps its frames on the GPU, the view draws the
+ * texture of the source's GpuVideoOutput instead. A view can also show
+ * only a crop of the picture, rotated further, as one tile of a VideoWall.
+ */
+class VideoSurfaceView : public QWidget, public IVideoFrameSink
+{
+    Q_OBJECT
+
+public:
+    explicit VideoSurfaceView(QWidget* parent = nullptr);
+    ~VideoSurfaceView() override;
+
+    /**
+     * @brief Set the widget whose video is shown
+     * @param source Main video widget; nullptr shows nothing
+     */
+    void setSource(VideoWidget* source);
+    VideoWidget* source() const { return m_source; }
+
+    /**
+     * @brief Show only part of the picture
+     * @param crop Region of the frame in 0-1 coordinates, before rotation
+     */
+    void setCrop(const QRectF& crop);
+    QRectF crop() const { return m_crop; }
+
+    /**
+     * @brief Rotate the picture on top of the source's rotation
+     * @param degrees 0, 90, 180 or 270 clockwise, e.g. for a screen mounted in portrait
+     */
+    void setExtraRotation(int degrees);
+    int extraRotation() const { return m_extraRotation; }
+
+    /**
+     * @brief Stretch the picture over the whole view instead of fitting it
+     */
+    void setFill(bool fill);
+    bool fills() const { return m_fill; }
+
+    /**
+     * @brief Take frames from showFrame() instead of registering with the backend
+     *
+     * Lets an owner switch several views to a frame in the same pass.
+     * Pictures of a GPU output are shared and switch together anyway.
+     */
+    void setExternalFrames(bool external);
+
+    /**
+     * @brief Show a frame while external frames are on and the view is shown
+     * @param frame Decoded frame
+     */
+    void showFrame(const VideoFrameRef& frame);
+
+    /**
+     * @brief Receive a decoded frame from the backend (decoder thread)
+     * @param frame Shared frame reference
+     */
+    void videoFrameReady(const VideoFrameRef& frame) override;
+
+protected:
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    void attach();
+    void detach();
+    void presentFrame(const VideoFrameRef& frame);
+    void presentPendingFrame();
+    void applySourceSettings();
+    void followGpuOutput();
+    void showGpuView();
+    int effectiveRotation() const;
+    bool usesGpuView() const;
+
+    QPointer<VideoWidget> m_source;
+    VLCBackend* m_backend;                  // Registered with while shown
+#ifdef HAVE_QT_OPENGL
+    VideoGLView* m_glView;
+    QMetaObject::Connection m_gpuOutputConnection;
+#endif
+    QRectF m_crop;
+    int m_extraRotation;
+    bool m_fill;
+    bool m_externalFrames;
+
+    VideoFrameRef m_currentFrame;           // GUI thread only
+    VideoFrameRef m_pendingFrame;           // Latest frame from the decoder thread
+    QMutex m_frameMutex;
+    std::atomic<bool> m_framePresentPending;
+};
+
+#endif // VIDEOSURFACEVIEW_H
@@ -0,0 +1,117 @@
+#ifndef VIDEOWALL_H
+#define VIDEOWALL_H
+
+#include <QObject>
+#include <QList>
+#include <QMutex>
+#include <QPointer>
+#include <QRectF>
+#include <QSizeF>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include "media/VideoFrame.h"
+
+class QScreen;
+class VLCBackend;
+class VideoWidget;
+class VideoSurfaceView;
+
+/**
+ * @brief One decode shown across several screens as a video wall
+ *
+ * Each output is a frameless full-screen VideoSurfaceView on its screen
+ * that shows its crop of the source's picture, rotated further for screens
+ * mounted in portrait. Crops leave out the part of the picture hidden
+ * behind the bezels, so lines run straight on across the gaps.
+ *
+ * Nothing is decoded twice. While the source keeps its frames on the GPU,
+ * every output samples the texture libVLC renders into; otherwise the wall
+ * is the one frame sink of the backend and hands each pooled frame to all
+ * outputs. Either way the outputs switch to a picture in the same pass of
+ * the event loop, so each presents it at its screen's next vertical blank;
+ * walls that must not drift by a refresh need genlocked displays.
+ *
+ * Escape on any output stops the wall.
+ */
+class VideoWall : public QObject, public IVideoFrameSink
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief One screen of the wall
+     */
+    struct Output {
+        QString screen;                 // QScreen::name()
+        QRectF crop;                    // Part of the picture in 0-1 coordinates
+        int rotation = 0;               // 0, 90, 180 or 270 degrees clockwise
+    };
+
+    explicit VideoWall(QObject* parent = nullptr);
+    ~VideoWall() override;
+
+    /**
+     * @brief Set the widget whose video the wall shows
+     * @param source Main video widget
+     */
+    void setSource(VideoWidget* source);
+    VideoWidget* source() const { return m_source; }
+
+    /**
+     * @brief Set the screens and crops; applied at once while active
+     */
+    void setOutputs(const QVector<Output>& outputs);
+    QVector<Output> outputs() const { return m_outputs; }
+
+    /**
+     * @brief Open an output on each screen that exists
+     * @return false if there is no source or none of the screens exists
+     */
+    bool start();
+    void stop();
+    bool isActive() const { return !m_views.isEmpty(); }
+
+    /**
+     * @brief Lay a grid of identical screens out with bezel compensation
+     * @param screens Screen names, row by row
+     * @param columns Screens per row
+     * @param bezel Picture hidden between two neighbouring screens, as a
+     *              fraction of one screen's picture width and height
+     */
+    static QVector<Output> gridLayout(const QStringList& screens, int columns, const QSizeF& bezel = QSizeF());
+
+    /**
+     * @brief Lay screens out as they are arranged on the desktop
+     *
+     * The picture spans the bounding box of the screens, so gaps left
+     * between screens in the arrangement act as bezels.
+     */
+    static QVector<Output> desktopLayout(const QList<QScreen*>& screens);
+
+    /**
+     * @brief Receive a decoded frame from the backend (decoder thread)
+     * @param frame Shared frame reference
+     */
+    void videoFrameReady(const VideoFrameRef& frame) override;
+
+signals:
+    void activeChanged(bool active);
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private:
+    void presentPendingFrame();
+
+    QPointer<VideoWidget> m_source;
+    QVector<Output> m_outputs;
+    QVector<VideoSurfaceView*> m_views;
+    VLCBackend* m_backend;                  // Registered with while active
+
+    VideoFrameRef m_pendingFrame;           // Latest frame from the decoder thread
+    QMutex m_frameMutex;
+    std::atomic<bool> m_framePresentPending;
+};
+
+#endif // VIDEOWALL_H
@@ -16,12 +16,24 @@
 #include <QTimer>
 #include <QPropertyAnimation>
 #include <QGraphicsOpacityEffect>
+#include <QMutex>
+#include <atomic>
 #include <memory>
+#include "media/VideoFrame.h"
+#include "video/FrameTimingStats.h"
+#include "video/ToneMapper.h"
 
+class QPainter;
 class VLCBackend;
+class VideoProcessor;
 class ComponentManager;
 class SubtitleRenderer;
 class SubtitleManager;
+class ScreenshotCapture;
+class GpuVideoOutput;
+#ifdef HAVE_QT_OPENGL
+class VideoGLView;
+#endif
 
 /**
  * @brief Video display widget for EonPlay media player
@@ -29,8 +41,14 @@ class SubtitleManager;
  * Provides video display area with libVLC integration, aspect ratio handling,
  * fullscreen support, and video adjustment controls (brightness, contrast, gamma).
  * Features futuristic overlay controls and video rotation/mirroring capabilities.
+ * Decoded frames arrive as pooled VideoFrameRef buffers and are painted
+ * directly, so the widget can be reparented (e.g. into picture-in-picture)
+ * without rebinding a native window. With OpenGL available they are shown
+ * by a VideoGLView, which applies the adjustments and transformations in
+ * one shader pass; otherwise QPainter draws them with rotation and
+ * mirroring only.
  */
-class VideoWidget : public QWidget
+class VideoWidget : public QWidget, public IVideoFrameSink
 {
     Q_OBJECT
 
@@ -51,6 +69,21 @@ public:
      */
     void setVLCBackend(VLCBackend* vlcBackend);
     
+    /**
+     * @brief Get the backend frames come from, e.g. for views sharing them
+     * @return VLC backend, or nullptr
+     */
+    VLCBackend* vlcBackend() const { return m_vlcBackend; }
+    
+    /**
+     * @brief Run a video processor's filter chain on displayed frames
+     * 
+     * Filters run on the GPU view only; the QPainter fallback shows frames unfiltered.
+     * 
+     * @param processor Video processor, or nullptr to stop filtering
+     */
+    void setVideoProcessor(VideoProcessor* processor);
+    
     /**
      * @brief Set video aspect ratio mode
      * @param aspectRatio Aspect ratio string (e.g., "16:9", "4:3", "auto")
@@ -63,6 +96,12 @@ public:
      */
     QString aspectRatio() const { return m_aspectRatio; }
     
+    /**
+     * @brief Get the display aspect ratio the picture is shown with
+     * @return Width over height, or 0 for the frame's own
+     */
+    double displayAspectRatio() const { return calculateAspectRatio(m_aspectRatio); }
+    
     /**
      * @brief Set brightness adjustment (-100 to 100)
      * @param brightness Brightness value
@@ -135,6 +174,21 @@ public:
      */
     bool isVerticalMirrored() const { return m_verticalMirror; }
     
+    /**
+     * @brief Set the HDR signal of the current media, to tone map it to SDR
+     *
+     * Only the GPU view tone maps; the QPainter fallback shows the signal as is.
+     *
+     * @param metadata Content metadata; SDR turns tone mapping off
+     */
+    void setHdrMetadata(const ToneMapper::Metadata& metadata);
+    
+    /**
+     * @brief Get the HDR signal of the current media
+     * @return Content metadata
+     */
+    ToneMapper::Metadata hdrMetadata() const { return m_hdrMetadata; }
+    
     /**
      * @brief Enter or exit fullscreen mode
      * @param fullscreen true for fullscreen
@@ -175,6 +229,42 @@ public:
      * @return Subtitle manager instance
      */
     SubtitleManager* subtitleManager() const { return m_subtitleManager; }
+    
+    /**
+     * @brief Receive a decoded frame from the backend (decoder thread)
+     * @param frame Shared frame reference
+     */
+    void videoFrameReady(const VideoFrameRef& frame) override;
+    
+    /**
+     * @brief Get the frame currently on screen
+     * @return Shared frame reference, or null before the first frame
+     */
+    VideoFrameRef currentVideoFrame() const { return m_currentFrame; }
+    
+    /**
+     * @brief Get the output libVLC renders into while frames stay on the GPU
+     * @return Output whose current frame is on screen, or nullptr on the frame pool path
+     */
+    GpuVideoOutput* gpuOutput() const;
+    
+    /**
+     * @brief Get presentation timing of this view since the current media started
+     * @return Frame counts and rolling frame-time statistics
+     */
+    FrameTimingStats::Snapshot frameTimingStats() const { return m_frameTiming.snapshot(); }
+    
+    /**
+     * @brief Show or hide the statistics HUD over the video
+     * @param visible true to show frame timing and decoder statistics
+     */
+    void setStatsHudVisible(bool visible);
+    
+    /**
+     * @brief Check if the statistics HUD is shown
+     * @return true if shown
+     */
+    bool isStatsHudVisible() const;
 
 public slots:
     /**
@@ -187,11 +277,24 @@ public slots:
      */
     void toggleControls();
     
+    /**
+     * @brief Toggle the statistics HUD (I)
+     */
+    void toggleStatsHud();
+    
     /**
      * @brief Take a screenshot of current video frame
+     *
+     * Encoding runs in the background; screenshotTaken() follows once the file is written.
      */
     void takeScreenshot();
     
+    /**
+     * @brief Get the capturer of frames on screen, e.g. for bursts and contact sheets
+     * @return Capturer owned by the widget
+     */
+    ScreenshotCapture* screenshotCapture() const { return m_screenshotCapture; }
+    
     /**
      * @brief Show video adjustment controls
      */
@@ -236,6 +339,16 @@ signals:
      * @param aspectRatio New aspect ratio
      */
     void aspectRatioChanged(const QString& aspectRatio);
+    
+    /**
+     * @brief Emitted when the HDR metadata of the media changes
+     */
+    void hdrMetadataChanged();
+    
+    /**
+     * @brief Emitted when gpuOutput() was created, replaced or released
+     */
+    void gpuOutputChanged();
 
 protected:
     /**
@@ -279,6 +392,14 @@ protected:
      * @param event Paint event
      */
     void paintEvent(QPaintEvent* event) override;
+    
+    /**
+     * @brief Paint video frames onto the display area
+     * @param watched Watched object
+     * @param event Event
+     * @return true if the event was handled
+     */
+    bool eventFilter(QObject* watched, QEvent* event) override;
 
 private slots:
     /**
@@ -330,6 +451,11 @@ private slots:
      * @brief Update controls opacity animation
      */
     void updateControlsOpacity();
+    
+    /**
+     * @brief Refresh the statistics HUD text
+     */
+    void updateStatsHud();
 
 private:
     /**
@@ -373,15 +499,32 @@ private:
     void updateVideoOutput();
     
     /**
-     * @brief Apply video adjustments to VLC
+     * @brief Pass brightness, contrast and gamma to the GPU view
      */
     void applyVideoAdjustments();
     
     /**
-     * @brief Apply video transformations to VLC
+     * @brief Pass rotation, mirroring and aspect ratio to the display
      */
     void applyVideoTransformations();
     
+    /**
+     * @brief Check whether frames are shown by the GPU view
+     */
+    bool usesGpuView() const;
+    
+#ifdef HAVE_QT_OPENGL
+    /**
+     * @brief Create the GPU output for the GL view's context and hand it to the backend
+     */
+    void setupGpuOutput();
+    
+    /**
+     * @brief Return the backend to pooled frames and delete the GPU output
+     */
+    void releaseGpuOutput();
+#endif
+    
     /**
      * @brief Calculate aspect ratio from string
      * @param aspectRatio Aspect ratio string
@@ -409,9 +552,27 @@ private:
      */
     void stopControlsHideTimer();
     
+    /**
+     * @brief Take the latest delivered frame and repaint (GUI thread)
+     */
+    void presentPendingFrame();
+    
+    /**
+     * @brief Draw a frame with aspect ratio, rotation and mirroring applied
+     * @param painter Painter on the display area
+     * @param frame Frame to draw
+     */
+    void paintVideoFrame(QPainter& painter, const VideoFrameRef& frame);
+    
+    /**
+     * @brief Create the statistics HUD, hidden
+     */
+    void createStatsHud();
+    
     // Component manager and VLC backend
     ComponentManager* m_componentManager;
     VLCBackend* m_vlcBackend;
+    VideoProcessor* m_videoProcessor;
     
     // Subtitle components
     SubtitleRenderer* m_subtitleRenderer;
@@ -421,6 +582,11 @@ private:
     QVBoxLayout* m_mainLayout;
     QWidget* m_videoDisplayWidget;
     QLabel* m_placeholderLabel;
+#ifdef HAVE_QT_OPENGL
+    VideoGLView* m_glView;                  // Covers m_videoDisplayWidget once frames arrive
+    GpuVideoOutput* m_gpuOutput;            // libVLC renders into m_glView's textures
+#endif
+    ToneMapper::Metadata m_hdrMetadata;
     
     // Overlay controls
     QWidget* m_overlayWidget;
@@ -452,6 +618,7 @@ private:
     QAction* m_fullscreenAction;
     QAction* m_screenshotAction;
     QAction* m_adjustmentsAction;
+    QAction* m_statsHudAction;
     QMenu* m_aspectRatioMenu;
     QAction* m_aspectRatioAuto;
     QAction* m_aspectRatio16_9;
@@ -478,10 +645,23 @@ private:
     QPropertyAnimation* m_controlsOpacityAnimation;
     QGraphicsOpacityEffect* m_overlayOpacityEffect;
     
+    // Statistics HUD
+    QLabel* m_statsHud;
+    QTimer* m_statsHudTimer;
+    
     // Mouse tracking
     QPoint m_lastMousePosition;
     QTimer* m_mouseMoveTimer;
     
+    // Video frames
+    VideoFrameRef m_currentFrame;           // GUI thread only
+    VideoFrameRef m_pendingFrame;           // Latest frame from the decoder thread
+    qint64 m_pendingDeliveredUs;            // FrameTimingStats::now() at delivery
+    QMutex m_frameMutex;
+    std::atomic<bool> m_framePresentPending;
+    FrameTimingStats m_frameTiming;
+    ScreenshotCapture* m_screenshotCapture;
+    
     // Predefined aspect ratios
     static const QStringList AspectRatios;
 };
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef WAVEFORMOVERVIEWWIDGET_H
+#define WAVEFORMOVERVIEWWIDGET_H
+
+#include <QWidget>
+#include <QPixmap>
+#include <memory>
+
+class WaveformPeaks;
+
+/**
+ * @brief Whole-track waveform strip for scrubbing
+ *
+ * Draws a WaveformPeaks overview from the level that matches its width,
+ * so resizing or a long track never means touching more than a few peaks
+ * per pixel. The waveform is rendered once per size into a played and an
+ * unplayed pixmap; progress updates only repaint the columns between the
+ * old and the new position.
+ */
+class WaveformOverviewWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit WaveformOverviewWidget(QWidget* parent = nullptr);
+
+    /**
+     * @brief Show an overview, or nothing if peaks is null or empty
+     */
+    void setPeaks(std::shared_ptr<const WaveformPeaks> peaks);
+    bool hasPeaks() const { return m_peaks != nullptr; }
+
+    /**
+     * @brief Set the played part
+     * @param fraction 0.0 to 1.0
+     */
+    void setProgress(double fraction);
+
+    QSize sizeHint() const override;
+
+signals:
+    /**
+     * @brief Emitted when the user clicks or drags on the waveform
+     * @param fraction Position as a fraction of the track
+     */
+    void seekRequested(double fraction);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+
+private:
+    void renderPixmaps();
+    int progressX() const;
+
+    std::shared_ptr<const WaveformPeaks> m_peaks;
+    QPixmap m_unplayed;
+    QPixmap m_played;
+    double m_progress;
+};
+
+#endif // WAVEFORMOVERVIEWWIDGET_H
@@ -0,0 +1,140 @@
+#ifndef EXPORTJOBQUEUE_H
+#define EXPORTJOBQUEUE_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+/**
+ * @brief Priority queue of export jobs run on worker threads
+ *
+ * Jobs run on a private thread pool, never on the GUI thread. Each job
+ * states how many CPU threads it keeps busy, and jobs are started, highest
+ * priority first, while their total stays within the CPU budget; a job
+ * larger than the whole budget runs alone. By default one core is left
+ * for playback.
+ *
+ * Job bodies poll Context::isCancelled() and report progress through
+ * Context::setProgress(); both are safe from the worker. Signals are
+ * emitted on the queue's thread.
+ */
+class ExportJobQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Priority {
+        Background = 0,
+        Normal,
+        Interactive
+    };
+
+    /**
+     * @brief State shared between a running job and the queue
+     */
+    class Context
+    {
+    public:
+        int id() const { return m_id; }
+
+        /**
+         * @brief Threads the job may use, e.g. for an encoder's -threads
+         */
+        int threads() const { return m_threads; }
+
+        bool isCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Report progress in percent; only changes are signalled
+         */
+        void setProgress(int percent);
+
+    private:
+        friend class ExportJobQueue;
+
+        ExportJobQueue* m_queue = nullptr;
+        int m_id = 0;
+        int m_threads = 1;
+        std::atomic<bool> m_cancelled{false};
+        std::atomic<int> m_progress{0};
+    };
+
+    /**
+     * @brief Job body, run on a worker thread
+     * @return true on success
+     */
+    using Work = std::function<bool(Context& context)>;
+
+    explicit ExportJobQueue(QObject* parent = nullptr);
+    ~ExportJobQueue() override;
+
+    /**
+     * @brief Queue a job
+     * @param cpuCost Threads the job keeps busy while it runs
+     * @return Id used in the signals
+     */
+    int submit(const QString& name, const Work& work, Priority priority = Normal, int cpuCost = 1);
+
+    /**
+     * @brief Drop a queued job or ask a running one to stop
+     * @return false if the id is unknown or already finished
+     */
+    bool cancel(int id);
+    void cancelAll();
+
+    /**
+     * @brief Cancel everything and wait for running jobs to return
+     */
+    void shutdown();
+
+    /**
+     * @brief Set how many CPU threads running jobs may use together
+     * @param threads 0 restores the default
+     */
+    void setCpuBudget(int threads);
+    int cpuBudget() const { return m_cpuBudget; }
+
+    int pendingJobs() const { return int(m_pending.size()); }
+    int runningJobs() const { return int(m_running.size()); }
+    bool isIdle() const { return m_pending.isEmpty() && m_running.isEmpty(); }
+
+    /**
+     * @brief Get the last reported progress of a running job, or -1
+     */
+    int jobProgress(int id) const;
+
+    static int defaultCpuBudget();
+
+signals:
+    void jobStarted(int id, const QString& name);
+    void jobProgress(int id, int percent);
+    void jobFinished(int id, bool success, bool cancelled);
+
+private:
+    struct Job {
+        int id = 0;
+        QString name;
+        Work work;
+        Priority priority = Normal;
+        int cpuCost = 1;
+        std::shared_ptr<Context> context;
+    };
+
+    void schedule();
+    void start(Job job);
+    void onJobDone(int id, bool success);
+
+    QThreadPool m_pool;
+    QList<Job> m_pending;                               // Highest priority first, then oldest
+    QHash<int, std::shared_ptr<Context>> m_running;
+    int m_cpuBudget;
+    int m_cpuInUse = 0;
+    int m_nextId = 1;
+};
+
+#endif // EXPORTJOBQUEUE_H
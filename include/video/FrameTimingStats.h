@@ -0,0 +1,101 @@
+#ifndef FRAMETIMINGSTATS_H
+#define FRAMETIMINGSTATS_H
+
+#include <QtGlobal>
+#include <array>
+#include <atomic>
+
+/**
+ * @brief Presentation timing of one video view
+ *
+ * The decoder thread reports each delivered frame; the GUI thread reports
+ * each frame it puts on screen together with the time it was delivered.
+ * A delivered frame replaced by a newer one before the GUI got to it was
+ * never shown (superseded). A shown frame is late when it reached the
+ * screen more than one refresh interval after delivery, i.e. it missed
+ * the vsync it was meant for; every further interval counts as one more
+ * vsync miss.
+ *
+ * Counters run since the last reset(); interval statistics cover a
+ * rolling window of the last WINDOW_SIZE presented frames. Gaps over
+ * MAX_INTERVAL_US (pauses, seeks) are left out of the window.
+ */
+class FrameTimingStats
+{
+public:
+    static constexpr int WINDOW_SIZE = 300;             // 5 s at 60 fps
+    static constexpr qint64 MAX_INTERVAL_US = 1000000;
+
+    struct Snapshot {
+        quint64 delivered = 0;      // Frames handed over by the decoder
+        quint64 presented = 0;      // Frames put on screen
+        quint64 superseded = 0;     // Replaced before they were shown
+        quint64 late = 0;           // Shown after the vsync they were due for
+        quint64 vsyncMisses = 0;    // Refresh intervals lost to late frames
+        int windowFrames = 0;       // Intervals in the rolling window
+        double fps = 0.0;           // Over the window
+        double meanMs = 0.0;        // Presentation intervals over the window
+        double p50Ms = 0.0;
+        double p95Ms = 0.0;
+        double p99Ms = 0.0;
+        double maxMs = 0.0;
+        double latencyMs = 0.0;     // Mean delivery-to-screen time over the window
+        double windowLatePercent = 0.0;
+
+        /**
+         * @brief Share of delivered frames that were never shown, in percent
+         */
+        double supersededPercent() const { return delivered ? 100.0 * superseded / delivered : 0.0; }
+    };
+
+    FrameTimingStats();
+
+    /**
+     * @brief Current time on the clock the timestamps use, in microseconds
+     */
+    static qint64 now();
+
+    /**
+     * @brief Record a frame delivered by the decoder (any thread)
+     * @param replacedPending true if an earlier frame was still waiting to be shown
+     */
+    void frameDelivered(bool replacedPending);
+
+    /**
+     * @brief Record a frame put on screen (GUI thread)
+     * @param deliveredUs now() when the frame was delivered
+     * @param refreshRate Display refresh rate in Hz
+     */
+    void framePresented(qint64 deliveredUs, double refreshRate);
+
+    /**
+     * @brief Counters and window statistics (GUI thread)
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * @brief Start over, e.g. for new media (GUI thread)
+     */
+    void reset();
+
+private:
+    struct Sample {
+        qint64 intervalUs = 0;
+        qint64 latencyUs = 0;
+        bool late = false;
+    };
+
+    std::atomic<quint64> m_delivered;
+    std::atomic<quint64> m_superseded;
+
+    // GUI thread only
+    quint64 m_presented;
+    quint64 m_late;
+    quint64 m_vsyncMisses;
+    qint64 m_lastPresentedUs;
+    std::array<Sample, WINDOW_SIZE> m_window;
+    int m_windowStart;
+    int m_windowCount;
+};
+
+#endif // FRAMETIMINGSTATS_H
@@ -0,0 +1,150 @@
+#ifndef GIFENCODER_H
+#define GIFENCODER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QRect>
+#include <QRgb>
+#include <QSize>
+#include <QThreadPool>
+#include <QVector>
+#include <functional>
+
+/**
+ * @brief Palette-quantized, multi-threaded GIF89a encoder
+ *
+ * Frames come in as packed 24-bit RGB. Colors are reduced by median cut
+ * over a 15-bit color histogram, either once for the whole animation
+ * (setGlobalPalette(), built from a downsampled sample of the clip) or per
+ * frame. Mapping to the palette goes through a 32K-entry nearest-color
+ * table, and dithering (ordered or Floyd-Steinberg) runs on horizontal
+ * strips of the frame in parallel; error diffusion stops at strip edges.
+ *
+ * With frame differencing, pixels that have not changed beyond a tolerance
+ * since they were last drawn become transparent, each frame is cropped to
+ * the rectangle that did change, and frames without any change only
+ * lengthen the previous frame's delay. The tolerance is measured against
+ * the source color last drawn, so slow drifts cannot accumulate.
+ */
+class GifEncoder
+{
+public:
+    enum Dither {
+        NoDither = 0,
+        OrderedDither,      // 8x8 Bayer matrix
+        FloydSteinberg      // Serpentine error diffusion
+    };
+
+    /**
+     * @brief Encoder settings
+     */
+    struct Options {
+        int colorCount = 256;           // Colors per palette (2-256), including the transparent one
+        Dither dither = OrderedDither;
+        bool frameDifferencing = true;
+        int differenceTolerance = 4;    // Per-channel change still treated as unchanged
+        bool loop = true;
+        int threads = 1;                // Threads for quantization and dithering
+    };
+
+    using Palette = QVector<QRgb>;
+
+    /**
+     * @brief Color histogram at 5 bits per channel, the input to median cut
+     */
+    class Histogram
+    {
+    public:
+        Histogram();
+
+        /**
+         * @brief Count every step-th pixel of packed RGB data
+         */
+        void add(const uchar* rgb, int pixelCount, int step = 1);
+
+        /**
+         * @brief Reduce the counted colors to at most colorCount by median cut
+         */
+        Palette medianCut(int colorCount) const;
+
+    private:
+        struct Bin {
+            quint64 count = 0;
+            quint64 red = 0;
+            quint64 green = 0;
+            quint64 blue = 0;
+        };
+        QVector<Bin> m_bins;
+    };
+
+    explicit GifEncoder(const Options& options = Options());
+    ~GifEncoder();
+
+    /**
+     * @brief Use one palette for every frame; call before open()
+     *
+     * Without it, each frame gets a palette of its own.
+     */
+    void setGlobalPalette(const Palette& palette);
+
+    /**
+     * @brief Get the number of palette colors available for pixels
+     */
+    int paletteColors() const;
+
+    /**
+     * @brief Start the file
+     * @param device Open, writable device
+     * @param size Frame size in pixels
+     */
+    bool open(QIODevice* device, const QSize& size);
+
+    /**
+     * @brief Add a frame
+     * @param rgb Packed RGB, size.width() * 3 bytes per row
+     * @param delay Display time in hundredths of a second
+     */
+    bool addFrame(const uchar* rgb, int delay);
+
+    /**
+     * @brief Write the pending frame and the trailer
+     */
+    bool close();
+
+private:
+    struct PendingFrame {
+        QByteArray imageData;       // Image descriptor onwards
+        int delay = 0;
+        bool transparent = false;
+        bool valid = false;
+    };
+
+    void parallelFor(int count, const std::function<void(int index)>& body);
+    void buildLookup(const Palette& palette);
+    void quantizeStrip(const uchar* rgb, int top, int bottom, QRect* changed);
+    QByteArray encodeImage(const QRect& rect, const Palette& localPalette) const;
+    bool flushPending();
+    bool write(const QByteArray& data);
+
+    static void appendColorTable(QByteArray& out, const Palette& palette, int tableBits);
+    static int tableBits(int colors);
+    static QByteArray lzwEncode(const QVector<uchar>& indices, int minCodeSize);
+
+    Options m_options;
+    QIODevice* m_device;
+    QSize m_size;
+    QThreadPool m_pool;
+
+    Palette m_globalPalette;
+    Palette m_palette;                  // Palette of the frame being encoded
+    QVector<quint8> m_lookup;           // 15-bit color -> nearest palette index
+    int m_transparentIndex;
+
+    QVector<uchar> m_indices;           // Current frame, full size
+    QVector<uchar> m_canvasSource;      // Source color of each pixel as last drawn
+    bool m_hasCanvas;
+    PendingFrame m_pending;
+    bool m_failed;
+};
+
+#endif // GIFENCODER_H
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "media/VLCBackend.h"
+#include <QObject>
+#include <QMap>
+#include <QMutex>
+#include <QPointer>
+#include <QSize>
+#include <QOpenGLExtraFunctions>
+#include <atomic>
+#include <memory>
+
+class QOpenGLContext;
+
+/**
+ * @brief Zero-copy video output of VLCBackend into GL textures
+ *
+ * Each attached player renders through libVLC's OpenGL output callbacks
+ * into textures of its own context, shared with the presenter's. libVLC
+ * then keeps hardware-decoded pictures on the GPU on its own: VA-API
+ * surfaces are imported as DMA-BUF EGL images, DXVA2/D3D11 textures go
+ * through WGL_NV_DX_interop and VideoToolbox buffers are bound as IOSurface
+ * textures. Only the conversion to RGB runs, as one draw into our target.
+ *
+ * The targets rotate through a TripleBuffer: libVLC draws into the write
+ * slot and fences it, the GUI thread takes the newest published one as the
+ * current frame, and every view drawing it waits for the fence on the GPU,
+ * so neither thread ever blocks the other. Views in any window can share
+ * the current frame, as all contexts share with each other, and all of
+ * them switch to a new picture in the same pass of the event loop.
+ * Targets are RGB10_A2 and the content's transfer and primaries are kept,
+ * so HDR reaches the presenter's tone mapping with its precision intact.
+ *
+ * Needs libVLC 4; with libVLC 3, isSupported() is false and players stay
+ * on the frame callbacks.
+ */
+class GpuVideoOutput : public QObject, public VLCBackend::GpuOutput
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Picture of the active player shown now
+     */
+    struct Frame {
+        GLuint texture = 0;             // Rows bottom-up, as GL renders them
+        QSize size;
+        GLsync fence = nullptr;         // Each context waits for it once before sampling
+        quint64 serial = 0;             // Changes with every picture
+    };
+
+    /**
+     * @param shareContext A presenter's context; targets are shared with it
+     */
+    explicit GpuVideoOutput(QOpenGLContext* shareContext, QObject* parent = nullptr);
+    ~GpuVideoOutput() override;
+
+    /**
+     * @brief Check whether libVLC can render into textures
+     */
+    static bool isSupported();
+
+    /**
+     * @brief Check whether textures of this output can be used in a context
+     */
+    bool isSharedWith(QOpenGLContext* context) const;
+
+    // VLCBackend::GpuOutput interface
+    bool attachPlayer(libvlc_media_player_t* player) override;
+    void detachPlayer(libvlc_media_player_t* player) override;
+    void setActivePlayer(libvlc_media_player_t* player) override;
+
+    /**
+     * @brief Get the picture to show (GUI thread)
+     *
+     * Stays valid until the next frameChanged(). Before sampling the
+     * texture, a context waits for the fence with glWaitSync() once per
+     * serial.
+     *
+     * @return Frame; texture is 0 until the active player rendered one
+     */
+    Frame currentFrame() const { return m_current; }
+
+signals:
+    /**
+     * @brief Emitted on the GUI thread when currentFrame() changed
+     */
+    void frameChanged();
+
+private:
+    struct Renderer;
+
+    /**
+     * @brief Queue advance() if a picture came from the active player (libVLC thread)
+     */
+    void notifyFrame(const Renderer* renderer);
+
+    /**
+     * @brief Take the newest picture of the active player as the current frame
+     */
+    void advance();
+
+    QPointer<QOpenGLContext> m_shareContext;
+    mutable QMutex m_mutex;                 // Guards the renderers and the active one
+    QMap<libvlc_media_player_t*, std::shared_ptr<Renderer>> m_renderers;
+    std::shared_ptr<Renderer> m_active;
+    bool m_activeChanged;
+    std::atomic<bool> m_advancePending;
+    Frame m_current;                        // GUI thread only
+};
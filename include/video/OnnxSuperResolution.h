@@ -0,0 +1,51 @@
+#ifndef ONNXSUPERRESOLUTION_H
+#define ONNXSUPERRESOLUTION_H
+
+#include "video/VideoUpscaler.h"
+#include <QString>
+#include <QVector>
+#include <memory>
+
+/**
+ * @brief Super-resolution network run through ONNX Runtime
+ *
+ * Takes models with one float input of shape [1, 3, H, W] and one output of
+ * shape [1, 3, H * scale, W * scale], RGB in 0.0-1.0, as ESRGAN, Real-ESRGAN,
+ * EDSR and SRCNN exports commonly are. Inference runs on CUDA when the
+ * runtime has it, otherwise on the CPU threads given.
+ *
+ * Built only when ONNX Runtime is found (HAVE_ONNXRUNTIME).
+ */
+class OnnxSuperResolution : public SuperResolutionModel
+{
+public:
+    /**
+     * @brief Load a model
+     * @param path .onnx file
+     * @param scale Magnification the model was trained for
+     * @param threads CPU threads for inference
+     * @param preferGpu Try the CUDA execution provider first
+     * @return nullptr if the model cannot be loaded
+     */
+    static std::unique_ptr<OnnxSuperResolution> load(const QString& path, int scale, int threads,
+                                                     bool preferGpu = true);
+    ~OnnxSuperResolution() override;
+
+    int scale() const override { return m_scale; }
+    bool upscaleTile(const uchar* input, int inputStride, const QSize& size,
+                     uchar* output, int outputStride) override;
+
+    bool usesGpu() const { return m_gpu; }
+
+private:
+    struct Session;
+
+    explicit OnnxSuperResolution(int scale);
+
+    std::unique_ptr<Session> m_session;
+    int m_scale;
+    bool m_gpu;
+    QVector<float> m_input;
+};
+
+#endif // ONNXSUPERRESOLUTION_H
@@ -0,0 +1,110 @@
+#ifndef SCENEDETECTOR_H
+#define SCENEDETECTOR_H
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+#include <array>
+#include <functional>
+#include "video/ExportJobQueue.h"
+
+/**
+ * @brief Scene cut detector working on small luma frames
+ *
+ * FFmpeg decodes the video at a fixed sample rate (or keyframes only) and
+ * scales it down to a FRAME_WIDTH x FRAME_HEIGHT grey picture on its side
+ * of the pipe, so the detector never sees a full-resolution frame. Each
+ * frame is compared to the previous one by two measures: the distance
+ * between their luma histograms, which catches cuts between similar
+ * compositions, and the share of 8x8 blocks whose sum of absolute
+ * differences (SSE2 or NEON) shows a real change, which ignores noise and
+ * flicker. Cuts are reported as soon as they are found, and cuts closer
+ * than the minimum scene length to the previous one are dropped, so flashes
+ * and fades do not split scenes.
+ */
+class SceneDetector
+{
+public:
+    static constexpr int FRAME_WIDTH = 128;
+    static constexpr int FRAME_HEIGHT = 72;
+    static constexpr int FRAME_SIZE = FRAME_WIDTH * FRAME_HEIGHT;
+    static constexpr int BLOCK_SIZE = 8;
+    static constexpr int HISTOGRAM_BINS = 64;
+
+    /**
+     * @brief Detection settings
+     */
+    struct Options {
+        float threshold = 0.3f;         // Score a cut must exceed (0.0-1.0)
+        double sampleRate = 5.0;        // Frames analysed per second of video
+        bool keyframesOnly = false;     // Decode keyframes only: fastest, cuts snap to keyframes
+        qint64 minSceneLength = 1000;   // Milliseconds
+    };
+
+    /**
+     * @brief A detected cut
+     */
+    struct Cut {
+        qint64 time = 0;                // Start of the new scene in milliseconds
+        float score = 0.0f;             // Change score (0.0-1.0)
+    };
+
+    using CutHandler = std::function<void(const Cut& cut)>;
+
+    explicit SceneDetector(const Options& options = Options());
+
+    /**
+     * @brief Forget the previous frame and cut, e.g. before a new video
+     */
+    void reset();
+
+    /**
+     * @brief Compare a frame with the previous one
+     * @param luma FRAME_SIZE bytes of 8-bit luma, rows top to bottom
+     * @param time Frame time in milliseconds
+     * @param cut Set if the frame starts a new scene
+     * @return true if a cut was detected
+     */
+    bool addFrame(const uchar* luma, qint64 time, Cut* cut);
+
+    /**
+     * @brief Decode a video with FFmpeg and report cuts as they are found
+     *
+     * Runs on the calling (worker) thread until the end of the video or
+     * until the job is cancelled, reporting progress to the context.
+     *
+     * @param ffmpegPath FFmpeg executable
+     * @param input Video file
+     * @param duration Video duration in milliseconds, for progress
+     * @param context Job context
+     * @param onCut Called for each cut, on the calling thread
+     * @return true if the whole video was analysed
+     */
+    bool run(const QString& ffmpegPath, const QString& input, qint64 duration,
+             ExportJobQueue::Context& context, const CutHandler& onCut);
+
+    /**
+     * @brief Get the L1 distance of two luma histograms, normalized to 0.0-1.0
+     */
+    static float histogramDistance(const quint32* a, const quint32* b);
+
+    /**
+     * @brief Get the share of blocks that changed between two frames (0.0-1.0)
+     */
+    static float changedBlockFraction(const uchar* a, const uchar* b);
+
+    /**
+     * @brief Get name of the compiled-in vector backend
+     */
+    static QString simdBackend();
+
+private:
+    Options m_options;
+    QVector<uchar> m_previous;
+    std::array<quint32, HISTOGRAM_BINS> m_histogram;
+    std::array<quint32, HISTOGRAM_BINS> m_previousHistogram;
+    bool m_hasPrevious;
+    qint64 m_lastCut;
+};
+
+#endif // SCENEDETECTOR_H
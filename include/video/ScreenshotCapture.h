@@ -0,0 +1,137 @@
+#ifndef SCREENSHOTCAPTURE_H
+#define SCREENSHOTCAPTURE_H
+
+#include <QObject>
+#include <QHash>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "media/VideoFrame.h"
+
+class QTimer;
+
+/**
+ * @brief Screenshot, burst and contact sheet capture off the GUI thread
+ *
+ * Frames are taken from a FrameSource, normally the player's latest pooled
+ * frame, as shared references: nothing is copied on the calling thread.
+ * Scaling and PNG/JPEG encoding run on a low-priority encoder pool. A
+ * pooled frame is released as soon as its scaled copy exists, and at most
+ * MAX_HELD_FRAMES are held by queued captures at once; beyond that a
+ * capture takes a private copy so the decoder never runs out of buffers.
+ *
+ * A capture takes count frames, one every intervalMs (or every new frame
+ * with an interval of 0). A contact sheet takes columns x rows frames the
+ * same way and tiles them into one image. Signals are emitted on the
+ * owner's thread.
+ */
+class ScreenshotCapture : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Get the frame to capture; called on the owner's thread
+     */
+    using FrameSource = std::function<VideoFrameRef()>;
+
+    /**
+     * @brief Single or burst capture
+     */
+    struct Request {
+        QString outputPath;         // Bursts insert _001, _002, ... before the extension
+        QByteArray format;          // Image format, empty = from the extension
+        int quality = -1;           // 0-100, -1 = the writer's default
+        QSize resolution;           // Bounding size, empty = original
+        int count = 1;              // Frames to capture
+        int intervalMs = 0;         // Between captures, 0 = every new frame
+    };
+
+    /**
+     * @brief Frames over time tiled into one image
+     */
+    struct ContactSheet {
+        QString outputPath;
+        QByteArray format;
+        int quality = -1;
+        int columns = 4;
+        int rows = 4;
+        int tileWidth = 320;        // Tile height follows the first frame's aspect
+        int spacing = 4;
+        QRgb background = 0xff000000;
+        int intervalMs = 1000;
+    };
+
+    static constexpr int MAX_HELD_FRAMES = 2;
+    static constexpr int MIN_POLL_MS = 5;           // Polling for new frames with a 0 interval
+
+    explicit ScreenshotCapture(QObject* parent = nullptr);
+    ~ScreenshotCapture() override;
+
+    void setFrameSource(const FrameSource& source) { m_frameSource = source; }
+
+    /**
+     * @brief Start a capture; the first frame is taken right away
+     * @return Capture id used in the signals, 0 if nothing could be started
+     */
+    int capture(const Request& request);
+
+    /**
+     * @brief Start a contact sheet
+     * @return Capture id used in the signals, 0 if nothing could be started
+     */
+    int captureContactSheet(const ContactSheet& sheet);
+
+    /**
+     * @brief Stop taking frames; frames already taken are still written
+     */
+    void cancel(int captureId);
+
+    bool isCapturing() const { return !m_captures.isEmpty(); }
+
+    /**
+     * @brief Encode and write an image atomically (any thread)
+     */
+    static bool writeImage(const QImage& image, const QString& path, const QByteArray& format, int quality);
+
+    /**
+     * @brief Fit an image into a bounding size, enlarging with Lanczos (any thread)
+     */
+    static QImage scaleImage(const QImage& image, const QSize& bound);
+
+signals:
+    /**
+     * @brief Emitted when a frame of a capture has been written
+     */
+    void frameCaptured(int captureId, int index, bool success, const QString& filePath);
+
+    /**
+     * @brief Emitted once per capture after its last file is written
+     * @param filePaths Files written; a contact sheet writes one
+     */
+    void captureFinished(int captureId, bool success, const QStringList& filePaths);
+
+private:
+    struct Capture;
+
+    int start(const std::shared_ptr<Capture>& capture);
+    void takeFrame(const std::shared_ptr<Capture>& capture);
+    void encodeFrame(const std::shared_ptr<Capture>& capture, int index, QImage image, bool pooled);
+    void addTile(const std::shared_ptr<Capture>& capture, int index, const QImage& tile);
+    void frameDone(const std::shared_ptr<Capture>& capture, int index, bool success, const QString& path);
+    void finishIfDone(const std::shared_ptr<Capture>& capture);
+    static QString framePath(const QString& outputPath, int index, int count);
+
+    FrameSource m_frameSource;
+    QThreadPool m_pool;
+    QHash<int, std::shared_ptr<Capture>> m_captures;
+    std::atomic<int> m_heldFrames;
+    int m_nextId;
+};
+
+#endif // SCREENSHOTCAPTURE_H
@@ -0,0 +1,95 @@
+#ifndef TONEMAPPER_H
+#define TONEMAPPER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+/**
+ * @brief HDR-to-SDR tone mapping baked into 3D LUTs
+ *
+ * The whole conversion of an HDR signal (PQ or HLG, BT.2020) to SDR
+ * (BT.709 primaries, BT.1886 gamma) is evaluated once per grid point of a
+ * LUT_SIZE^3 table: EOTF, gamut conversion, tone curve on the brightest
+ * channel (BT.2390 EETF or Hable's filmic curve) and SDR encoding. Players
+ * and exports then only look colors up, on the GPU or in FFmpeg's lut3d.
+ *
+ * Tables depend only on the content metadata and the curve, so they are
+ * cached in memory per key and, as .cube files for FFmpeg, on disk.
+ */
+class ToneMapper
+{
+public:
+    enum Transfer {
+        SDR = 0,
+        PQ,         // SMPTE ST 2084, HDR10
+        HLG         // ARIB STD-B67
+    };
+
+    enum Curve {
+        BT2390 = 0, // ITU-R BT.2390 EETF
+        Hable       // Uncharted 2 filmic curve
+    };
+
+    /**
+     * @brief What the content says about its signal
+     */
+    struct Metadata {
+        Transfer transfer = SDR;
+        bool bt2020 = true;                 // BT.2020 primaries, otherwise BT.709
+        float masteringPeak = 1000.0f;      // Mastering display peak in cd/m2
+        float maxContentLight = 0.0f;       // MaxCLL in cd/m2, 0 if unknown
+
+        bool isHdr() const { return transfer != SDR; }
+
+        /**
+         * @brief Get the peak the curve maps from: MaxCLL when known and lower
+         */
+        float sourcePeak() const;
+
+        bool operator==(const Metadata& other) const;
+        bool operator!=(const Metadata& other) const { return !(*this == other); }
+    };
+
+    /**
+     * @brief Baked table: RGB float triplets, red index fastest, then green, then blue
+     */
+    struct Lut {
+        int size = 0;
+        QVector<float> data;
+    };
+    using LutRef = std::shared_ptr<const Lut>;
+
+    static constexpr int LUT_SIZE = 33;
+    static constexpr float SDR_WHITE = 203.0f;  // cd/m2 mapped to SDR 1.0 (BT.2408 reference white)
+
+    /**
+     * @brief Get the table for content, baking it on first use (thread-safe)
+     * @return nullptr for SDR content
+     */
+    static LutRef lut(const Metadata& metadata, Curve curve = BT2390);
+
+    /**
+     * @brief Get a .cube file of the table for FFmpeg's lut3d filter, written on first use
+     * @return Empty for SDR content or if the cache cannot be written
+     */
+    static QString cubeFile(const Metadata& metadata, Curve curve = BT2390);
+
+    /**
+     * @brief Read the first video stream's transfer, primaries and light levels with ffprobe
+     * @return SDR metadata if the stream is not HDR or ffprobe fails
+     */
+    static Metadata probe(const QString& ffprobePath, const QString& input);
+
+    /**
+     * @brief Map one encoded HDR color to encoded SDR, as the tables do
+     */
+    static void mapColor(const Metadata& metadata, Curve curve, const float in[3], float out[3]);
+
+private:
+    static QByteArray cacheKey(const Metadata& metadata, Curve curve);
+    static LutRef bake(const Metadata& metadata, Curve curve);
+};
+
+#endif // TONEMAPPER_H
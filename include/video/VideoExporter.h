@@ -6,16 +6,31 @@
 #include <QMutex>
 #include <QVector>
 #include <QString>
+#include <QStringList>
 #include <QPixmap>
 #include <QImage>
 #include <QSize>
+#include <QHash>
 #include <memory>
+#include "video/ExportJobQueue.h"
+#include "video/SceneDetector.h"
+#include "video/ScreenshotCapture.h"
+
+class IMediaEngine;
 
 /**
  * @brief Advanced video export system with screenshots, GIF, and processing
  * 
  * Provides comprehensive video export capabilities including screenshot capture,
  * GIF creation, HDR support, AI upscaling, scene detection, and color correction.
+ *
+ * GIF and video exports and scene detection are jobs on an ExportJobQueue:
+ * FFmpeg does the decoding (and video encoding) in its own process, driven
+ * from a worker thread, so several exports can run side by side within the
+ * queue's CPU budget without touching the GUI thread. GIFs are quantized
+ * and encoded by GifEncoder on the job's threads, and upscaled exports pass
+ * through VideoUpscaler row band by row band between a decoding and an
+ * encoding FFmpeg.
  */
 class VideoExporter : public QObject
 {
@@ -97,7 +112,10 @@ public:
         QualityLevel quality = Medium;
         bool loop = true;           // Loop animation
         int colorCount = 256;       // Number of colors (2-256)
+        bool perFramePalette = false;   // Palette per frame instead of one from a sample of the clip
+        bool frameDifferencing = true;  // Only store what changed, the rest transparent
         QString outputPath;
+        ExportJobQueue::Priority priority = ExportJobQueue::Normal;
         
         GIFOptions() = default;
     };
@@ -114,10 +132,12 @@ public:
         HDRFormat hdrFormat = SDR;
         UpscalingMethod upscaling = None;
         float upscaleRatio = 2.0f; // Upscaling ratio (1.0-4.0)
+        qint64 memoryBudget = 0;   // Bytes the upscaler may hold per frame (0 = default)
         bool enableColorCorrection = false;
         qint64 startTime = 0;      // Start time in milliseconds
         qint64 duration = 0;       // Duration in milliseconds (0 = full)
         QString outputPath;
+        ExportJobQueue::Priority priority = ExportJobQueue::Normal;
         
         VideoExportOptions() = default;
     };
@@ -151,9 +171,36 @@ public:
      */
     void shutdown();
 
+    /**
+     * @brief Set the media engine that supplies decoded frames
+     * @param engine Media engine (not owned)
+     */
+    void setMediaEngine(IMediaEngine* engine);
+
+    /**
+     * @brief Set the media that exports and scene detection read from
+     * @param path File path or URL
+     * @param duration Media duration in milliseconds
+     */
+    void setSourceMedia(const QString& path, qint64 duration);
+
+    /**
+     * @brief Get the queue export jobs run on, e.g. to change its CPU budget
+     */
+    ExportJobQueue* jobQueue() const { return m_jobQueue; }
+
+    /**
+     * @brief Get the capturer screenshots of playback run on, e.g. for bursts and contact sheets
+     */
+    ScreenshotCapture* screenshotCapture() const { return m_screenshotCapture; }
+
     // Screenshot functionality
     /**
      * @brief Capture screenshot at current position
+     *
+     * The frame on screen is shared, not copied; scaling and encoding run
+     * on the capturer's pool and screenshotCaptured() reports the result.
+     *
      * @param options Screenshot options
      * @return true if capture started successfully
      */
@@ -161,6 +208,9 @@ public:
 
     /**
      * @brief Capture screenshot at specific time
+     *
+     * The frame is decoded from the source media by an export job.
+     *
      * @param timeMs Time position in milliseconds
      * @param options Screenshot options
      * @return true if capture started successfully
@@ -171,7 +221,7 @@ public:
     /**
      * @brief Export GIF animation
      * @param options GIF export options
-     * @return true if export started successfully
+     * @return true if the export was queued; exportQueued() gives its job id
      */
     bool exportGIF(const GIFOptions& options);
 
@@ -179,7 +229,7 @@ public:
     /**
      * @brief Export video with processing
      * @param options Video export options
-     * @return true if export started successfully
+     * @return true if the export was queued; exportQueued() gives its job id
      */
     bool exportVideo(const VideoExportOptions& options);
 
@@ -214,10 +264,16 @@ public:
     // Scene detection
     /**
      * @brief Detect scenes in video
+     * 
+     * Runs as a background job on downscaled frames; scenes are reported
+     * through scenesDetected() as they are found, and
+     * sceneDetectionFinished() follows the last one.
+     * 
      * @param threshold Detection threshold (0.0-1.0)
+     * @param keyframesOnly Decode keyframes only; much faster, cuts snap to keyframes
      * @return true if detection started successfully
      */
-    bool detectScenes(float threshold = 0.3f);
+    bool detectScenes(float threshold = 0.3f, bool keyframesOnly = false);
 
     /**
      * @brief Get detected scenes
@@ -235,18 +291,24 @@ public:
 
     /**
      * @brief Get export progress
-     * @return Progress percentage (0-100)
+     * @return Progress percentage (0-100), averaged over queued and running jobs
      */
     int getExportProgress() const;
 
     /**
-     * @brief Cancel ongoing export
+     * @brief Cancel all queued and running exports
      */
     void cancelExport();
 
+    /**
+     * @brief Cancel one export
+     * @param jobId Id from exportQueued()
+     */
+    void cancelExport(int jobId);
+
     /**
      * @brief Check if export is in progress
-     * @return true if exporting
+     * @return true if any job is queued or running
      */
     bool isExporting() const;
 
@@ -299,11 +361,29 @@ signals:
     void exportProgressUpdated(int progress);
 
     /**
-     * @brief Emitted when scene detection completes
-     * @param scenes Detected scenes
+     * @brief Emitted when an export or scene detection is queued
+     * @param jobId Id for cancelExport(int) and exportJobProgress()
+     * @param outputPath Output file path, empty for scene detection
+     */
+    void exportQueued(int jobId, const QString& outputPath);
+
+    /**
+     * @brief Emitted when one job's progress updates
+     */
+    void exportJobProgress(int jobId, int progress);
+
+    /**
+     * @brief Emitted as scene detection finds scenes, in order
+     * @param scenes Scenes found since the last emission
      */
     void scenesDetected(const QVector<SceneInfo>& scenes);
 
+    /**
+     * @brief Emitted when scene detection ends
+     * @param success false if it failed or was cancelled; scenes found so far are kept
+     */
+    void sceneDetectionFinished(bool success);
+
     /**
      * @brief Emitted when color correction completes
      * @param success Correction success
@@ -312,37 +392,63 @@ signals:
 
 private slots:
     void updateExportProgress();
+    void onExportJobFinished(int jobId, bool success, bool cancelled);
 
 private:
+    enum class JobKind {
+        GIFExport,
+        VideoExport,
+        SceneDetection,
+        Screenshot
+    };
+
+    struct ExportJob {
+        JobKind kind;
+        QString outputPath;
+        int progress = 0;
+    };
+
+    // What a job reads from; copied into the job when it is queued
+    struct ExportSource {
+        QString path;
+        qint64 duration = 0;
+        QString ffmpegPath;
+    };
+
+    int queueJob(JobKind kind, const QString& outputPath, const ExportJobQueue::Work& work,
+                 ExportJobQueue::Priority priority, int cpuCost);
+
     // Screenshot methods
     bool captureCurrentFrame(const ScreenshotOptions& options);
     bool captureFrameAtTime(qint64 timeMs, const ScreenshotOptions& options);
-    QImage processScreenshot(const QImage& image, const ScreenshotOptions& options);
+    static QImage processScreenshot(const QImage& image, const ScreenshotOptions& options);
+    static int screenshotQuality(QualityLevel quality);
 
-    // GIF export methods
-    bool createGIFAnimation(const GIFOptions& options);
-    QVector<QImage> extractFramesForGIF(const GIFOptions& options);
-    bool writeGIFFile(const QVector<QImage>& frames, const GIFOptions& options);
+    // GIF export methods (worker thread)
+    static bool createGIFAnimation(const GIFOptions& options, const ExportSource& source,
+                                   ExportJobQueue::Context& context);
 
-    // Video export methods
-    bool processVideoExport(const VideoExportOptions& options);
-    bool applyVideoFilters(const VideoExportOptions& options);
-    bool encodeVideo(const VideoExportOptions& options);
+    // Video export methods (worker thread)
+    static bool processVideoExport(const VideoExportOptions& options, const ExportSource& source,
+                                   ExportJobQueue::Context& context);
 
     // HDR processing
     bool processHDRContent(const VideoExportOptions& options);
     QImage convertToHDR(const QImage& image, HDRFormat format);
 
-    // AI upscaling methods
+    // Upscaling methods; AI methods need ONNX Runtime and their model file
     bool initializeAIModels();
     QImage upscaleImage(const QImage& image, UpscalingMethod method, float ratio);
-    QImage applyESRGAN(const QImage& image, float ratio);
-    QImage applyRealESRGAN(const QImage& image, float ratio);
-    QImage applyEDSR(const QImage& image, float ratio);
-    QImage applySRCNN(const QImage& image, float ratio);
-
-    // Scene detection methods
-    bool analyzeVideoForScenes(float threshold);
+    static bool processUpscaledExport(const VideoExportOptions& options, const ExportSource& source,
+                                      ExportJobQueue::Context& context, const QSize& inputSize,
+                                      const QString& frameRate);
+    static QStringList encoderArguments(const VideoExportOptions& options, int threads);
+
+    // Scene detection methods (worker thread); onScene gets each scene once its end is known
+    static bool analyzeVideoForScenes(const SceneDetector::Options& options, const ExportSource& source,
+                                      ExportJobQueue::Context& context,
+                                      const std::function<void(const SceneInfo& scene)>& onScene);
+    void addDetectedScene(int jobId, const SceneInfo& scene);
     float calculateSceneChange(const QImage& frame1, const QImage& frame2);
     QString generateSceneDescription(const QImage& frame);
     QPixmap createSceneThumbnail(const QImage& frame);
@@ -359,13 +465,21 @@ private:
     QString generateUniqueFilename(const QString& basePath, const QString& extension);
     bool validateExportOptions(const VideoExportOptions& options);
 
+    // Frame source
+    IMediaEngine* m_mediaEngine;
+    ExportSource m_source;
+
     // Export state
-    bool m_exporting;
+    ExportJobQueue* m_jobQueue;
+    ScreenshotCapture* m_screenshotCapture;
+    QHash<int, QString> m_screenshotCaptures;   // Capture id to path, reported by screenshotCaptured()
+    QHash<int, ExportJob> m_jobs;
     int m_exportProgress;
     QTimer* m_progressTimer;
 
     // Scene detection results
     QVector<SceneInfo> m_detectedScenes;
+    int m_sceneDetectionJob;                // Latest detection; results of older ones are dropped
 
     // AI model availability
     bool m_aiModelsLoaded;
@@ -383,6 +497,10 @@ private:
     static constexpr int DEFAULT_SCREENSHOT_QUALITY = 95;
     static constexpr float DEFAULT_SCENE_THRESHOLD = 0.3f;
     static constexpr float MAX_UPSCALE_RATIO = 4.0f;
+    static constexpr int GIF_CPU_COST = 4;
+    static constexpr int GIF_PALETTE_SAMPLE_RATE = 2;      // Frames per second sampled for the palette
+    static constexpr int GIF_PALETTE_SAMPLE_WIDTH = 160;
+    static constexpr int SCENE_DETECTION_CPU_COST = 2;
 };
 
 #endif // VIDEOEXPORTER_H
\ No newline at end of file
@@ -0,0 +1,105 @@
+#ifndef VIDEOFILTERGRAPH_H
+#define VIDEOFILTERGRAPH_H
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QByteArray>
+#include <QHash>
+#include <QSize>
+#include <memory>
+#include "video/VideoProcessor.h"
+
+/**
+ * @brief GPU executor for a VideoProcessor filter chain
+ *
+ * The chain is compiled into as few fragment passes as it allows. Per-pixel
+ * filters (color, tone, gamma, ...) never get a pass of their own: the ones
+ * before a neighbourhood filter (blur, sharpen, edge detection, emboss,
+ * deinterlace) are applied to every texel it samples, and the ones after
+ * the last are appended to its pass. A chain of N neighbourhood filters
+ * therefore takes N passes, or one if it has none. Passes alternate between
+ * two frame-sized render targets.
+ *
+ * Compiled programs are cached per filter sequence, so switching back to a
+ * chain seen before costs nothing and parameter changes are only uniforms.
+ * All methods need the owning GL context to be current.
+ */
+class VideoFilterGraph : protected QOpenGLExtraFunctions
+{
+public:
+    VideoFilterGraph();
+    ~VideoFilterGraph();
+
+    VideoFilterGraph(const VideoFilterGraph&) = delete;
+    VideoFilterGraph& operator=(const VideoFilterGraph&) = delete;
+
+    /**
+     * @brief Set up for the current context
+     * @param shaderHeader GLSL version line (and precision for ES) of the context
+     */
+    void initialize(const QByteArray& shaderHeader);
+
+    /**
+     * @brief Free every GL resource; initialize() must be called again before use
+     */
+    void release();
+
+    /**
+     * @brief Set the chain run by process(); compiles it unless cached
+     * @param chain Filters in order and their parameters
+     * @return false if a pass failed to compile; the graph is then empty
+     */
+    bool setChain(const VideoProcessor::FilterChain& chain);
+
+    /**
+     * @brief Check whether process() has anything to do
+     */
+    bool isEmpty() const { return !m_pipeline || m_pipeline->passes.isEmpty(); }
+
+    /**
+     * @brief Get the number of passes the current chain takes
+     */
+    int passCount() const { return m_pipeline ? static_cast<int>(m_pipeline->passes.size()) : 0; }
+
+    /**
+     * @brief Run the chain over a texture
+     *
+     * Leaves a render target bound; the caller rebinds its own framebuffer
+     * and viewport afterwards.
+     *
+     * @param inputTexture Source texture
+     * @param size Source size in pixels
+     * @param swapRedBlue true if the source holds BGRA data uploaded as RGBA
+     * @return Texture holding the RGBA result, or inputTexture if the graph is empty
+     */
+    GLuint process(GLuint inputTexture, const QSize& size, bool swapRedBlue);
+
+    /**
+     * @brief Check whether a filter reads neighbouring pixels and so needs a pass
+     */
+    static bool needsOwnPass(VideoProcessor::FilterType filter);
+
+private:
+    struct Pipeline {
+        QList<std::shared_ptr<QOpenGLShaderProgram>> passes;
+    };
+
+    std::shared_ptr<Pipeline> compile(const QVector<VideoProcessor::FilterType>& filters);
+    void setUniforms(QOpenGLShaderProgram* program) const;
+    void ensureTargets(const QSize& size);
+
+    bool m_initialized;
+    QByteArray m_shaderHeader;
+    QOpenGLVertexArrayObject m_vao;
+    std::unique_ptr<QOpenGLFramebufferObject> m_targets[2];
+
+    QHash<QByteArray, std::shared_ptr<Pipeline>> m_pipelines;   // Filter sequence -> compiled passes
+    std::shared_ptr<Pipeline> m_pipeline;
+    VideoProcessor::ProcessingParameters m_parameters;
+
+    static constexpr int MAX_CACHED_PIPELINES = 32;
+};
+
+#endif // VIDEOFILTERGRAPH_H
@@ -9,14 +9,22 @@
 #include <QString>
 #include <QColor>
 #include <memory>
+#include "media/VideoFrame.h"
 
 /**
  * @brief Advanced video processing system with filters and enhancements
  * 
  * Provides comprehensive video processing including color filters,
  * deinterlacing, frame rate display, and video information overlay.
+ * As an IVideoFrameSink it tracks the decoded picture size and frame count
+ * from the shared frames without touching their pixels.
+ *
+ * The processor only describes the filters; the active filters, in order,
+ * and their parameters form a FilterChain that a VideoFilterGraph runs on
+ * the GPU. Every change, including a whole preset, is published as one
+ * filterChainChanged() so the renderer switches between two frames.
  */
-class VideoProcessor : public QObject
+class VideoProcessor : public QObject, public IVideoFrameSink
 {
     Q_OBJECT
 
@@ -68,6 +76,14 @@ public:
         ProcessingParameters() = default;
     };
 
+    /**
+     * @brief Active filters in execution order and the parameters they read
+     */
+    struct FilterChain {
+        QVector<FilterType> filters;
+        ProcessingParameters parameters;
+    };
+
     /**
      * @brief Video information structure
      */
@@ -137,11 +153,34 @@ public:
 
     /**
      * @brief Enable or disable a filter
+     * 
+     * Enabled filters run after the ones already active, except
+     * Deinterlace, which goes first so it sees the original fields.
+     * 
      * @param filter Filter type
      * @param enabled Enable state
      */
     void setFilterEnabled(FilterType filter, bool enabled);
 
+    /**
+     * @brief Set which filters are active and the order they run in
+     * @param filters Filter types, first applied first; duplicates and None are dropped
+     */
+    void setFilterOrder(const QVector<FilterType>& filters);
+
+    /**
+     * @brief Move an active filter to another position in the chain
+     * @param from Current position
+     * @param to New position
+     */
+    void moveFilter(int from, int to);
+
+    /**
+     * @brief Get the active filters and parameters as one snapshot
+     * @return Current filter chain
+     */
+    FilterChain getFilterChain() const;
+
     /**
      * @brief Check if a filter is enabled
      * @param filter Filter type
@@ -202,6 +241,12 @@ public:
      */
     void updateVideoInfo(const VideoInfo& info);
 
+    /**
+     * @brief Track a decoded frame (decoder thread)
+     * @param frame Shared frame reference
+     */
+    void videoFrameReady(const VideoFrameRef& frame) override;
+
     /**
      * @brief Get video chapters
      * @return List of chapters
@@ -304,6 +349,12 @@ signals:
      */
     void parametersChanged(const ProcessingParameters& params);
 
+    /**
+     * @brief Emitted once per change of the active filters, their order or parameters
+     * @param chain New filter chain
+     */
+    void filterChainChanged(const FilterChain& chain);
+
     /**
      * @brief Emitted when video info is updated
      * @param info New video information
@@ -323,9 +374,8 @@ signals:
     void currentChapterChanged(const ChapterInfo& chapter);
 
 private:
-    void applyColorAdjustments(ProcessingParameters& params);
-    void applyFilterEffects(ProcessingParameters& params);
-    void applyDeinterlacing(ProcessingParameters& params);
+    ProcessingParameters clampParameters(const ProcessingParameters& params) const;
+    void emitFilterChainChanged();
     float clampParameter(float value, float min, float max) const;
 
     // Processor state
@@ -0,0 +1,166 @@
+#ifndef VIDEOUPSCALER_H
+#define VIDEOUPSCALER_H
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+/**
+ * @brief Super-resolution network run by VideoUpscaler on picture tiles
+ *
+ * Implementations wrap an inference runtime (see OnnxSuperResolution) and
+ * may run on the GPU. Tiles are 4-byte RGBA-ordered pixels.
+ */
+class SuperResolutionModel
+{
+public:
+    virtual ~SuperResolutionModel() = default;
+
+    /**
+     * @brief Get the model's fixed magnification
+     */
+    virtual int scale() const = 0;
+
+    /**
+     * @brief Get the preferred tile size in input pixels
+     */
+    virtual int tileSize() const { return 128; }
+
+    /**
+     * @brief Upscale one tile
+     * @param input Tile pixels
+     * @param inputStride Bytes per input row
+     * @param size Tile size in input pixels
+     * @param output scale() times larger tile
+     * @param outputStride Bytes per output row
+     */
+    virtual bool upscaleTile(const uchar* input, int inputStride, const QSize& size,
+                             uchar* output, int outputStride) = 0;
+};
+
+/**
+ * @brief Tiled, multi-threaded picture resampler for exports
+ *
+ * Resamples 4-byte pixels with a separable bilinear, bicubic or Lanczos-3
+ * kernel in 14-bit fixed point, using SSE2 or NEON where available. The
+ * output is produced in bands of rows sized from a memory budget, and each
+ * band is cut into tiles whose intermediate rows fit in a core's cache;
+ * tiles run in parallel. Input rows are pulled from a RowSource in order
+ * and dropped once no later band needs them, and finished bands go to a
+ * RowSink, so neither the input nor the output frame is ever held whole:
+ * a 4K export keeps a few megabytes per frame in flight.
+ *
+ * With a SuperResolutionModel set, the input first goes through the model
+ * in overlapping tiles, band by band, and the kernel then takes the
+ * model's output to the requested size.
+ */
+class VideoUpscaler
+{
+public:
+    enum Kernel {
+        Bilinear = 0,
+        Bicubic,
+        Lanczos
+    };
+
+    /**
+     * @brief Resampler settings
+     */
+    struct Options {
+        Kernel kernel = Lanczos;
+        int threads = 1;
+        qint64 memoryBudget = 0;        // Bytes for row windows and output bands (0 = default)
+    };
+
+    /**
+     * @brief Fill count rows starting at first; rows are asked for in order, each once
+     */
+    using RowSource = std::function<bool(uchar* rows, int first, int count, int stride)>;
+
+    /**
+     * @brief Take count finished rows starting at first
+     */
+    using RowSink = std::function<bool(const uchar* rows, int first, int count, int stride)>;
+
+    explicit VideoUpscaler(const Options& options = Options());
+    ~VideoUpscaler();
+
+    VideoUpscaler(const VideoUpscaler&) = delete;
+    VideoUpscaler& operator=(const VideoUpscaler&) = delete;
+
+    /**
+     * @brief Run a super-resolution model ahead of the kernel; call before configure()
+     */
+    void setModel(std::shared_ptr<SuperResolutionModel> model);
+
+    /**
+     * @brief Prepare for frames of the given sizes
+     * @return false if a size is empty or too large
+     */
+    bool configure(const QSize& inputSize, const QSize& outputSize);
+
+    /**
+     * @brief Resample one frame from source to sink
+     *
+     * All input rows are read, even those the output does not need, so the
+     * source can be a stream of consecutive frames.
+     */
+    bool process(const RowSource& source, const RowSink& sink);
+
+    /**
+     * @brief Resample a whole image, e.g. a screenshot; reconfigures the upscaler
+     */
+    QImage scale(const QImage& image, const QSize& outputSize);
+
+    QSize inputSize() const { return m_inputSize; }
+    QSize outputSize() const { return m_outputSize; }
+
+    /**
+     * @brief Get the output band height the memory budget allows
+     */
+    int bandHeight() const { return m_bandHeight; }
+
+    /**
+     * @brief Get name of the compiled-in vector backend
+     */
+    static QString simdBackend();
+
+    static constexpr qint64 DEFAULT_MEMORY_BUDGET = 16 * 1024 * 1024;
+
+private:
+    // Per output coordinate: first input coordinate and `taps` Q14 weights
+    struct Axis {
+        int taps = 0;
+        QVector<int> first;
+        QVector<qint16> weights;
+    };
+
+    class ModelStage;
+
+    static Axis buildAxis(int inputSize, int outputSize, Kernel kernel);
+    void parallelFor(int count, const std::function<void(int index)>& body);
+    bool resample(const RowSource& source, const RowSink& sink);
+    void resampleTile(int x0, int x1, int y0, int y1, int windowFirst, uchar* band, int bandFirst);
+
+    Options m_options;
+    QThreadPool m_pool;
+    std::shared_ptr<SuperResolutionModel> m_model;
+    std::unique_ptr<ModelStage> m_modelStage;
+
+    QSize m_inputSize;
+    QSize m_outputSize;
+    QSize m_kernelInputSize;            // After the model, if any
+    Axis m_horizontal;
+    Axis m_vertical;
+    int m_bandHeight;
+    int m_tileWidth;
+
+    QVector<uchar> m_window;            // Input rows the current band reads
+    QVector<uchar> m_band;              // Output rows being produced
+};
+
+#endif // VIDEOUPSCALER_H
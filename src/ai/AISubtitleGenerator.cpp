@@ -1,4 +1,5 @@
 #include "ai/AISubtitleGenerator.h"
+#include "ThreadPriority.h"
 #include <QDir>
 #include <QFileInfo>
 #include <QStandardPaths>
@@ -13,6 +14,11 @@
 #include <QDebug>
 #include <QRegularExpression>
 #include <QTime>
+#include <QVector>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 Q_LOGGING_CATEGORY(aiSubtitles, "eonplay.ai.subtitles")
 
@@ -207,6 +213,8 @@ void AISubtitleGenerator::generateSubtitlesFromAudio(const QString& audioFilePat
         return;
     }
     
+    m_isGenerating = true;
+    m_outputPath = outputPath;
     m_currentStatus = "Generating subtitles with " + engineToString(m_options.engine) + "...";
     emit generationProgress(20, m_currentStatus);
     
@@ -261,6 +269,11 @@ void AISubtitleGenerator::detectLanguage(const QString& mediaFilePath)
         return;
     }
     
+    if (m_options.fastLanguageDetection && isEngineAvailable(Whisper)) {
+        detectLanguageFromProbes(mediaFilePath);
+        return;
+    }
+    
     QString audioPath = mediaFilePath;
     if (!isAudioFile(mediaFilePath)) {
         audioPath = extractAudioFromVideo(mediaFilePath);
@@ -289,6 +302,7 @@ void AISubtitleGenerator::generateWithWhisper(const QString& audioPath, const QS
     }
     
     m_currentProcess = std::make_unique<QProcess>(this);
+    ThreadPriority::setBackgroundProcess(m_currentProcess.get());
     connect(m_currentProcess.get(), QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
             this, &AISubtitleGenerator::handleWhisperProcess);
     
@@ -305,6 +319,18 @@ void AISubtitleGenerator::generateWithWhisper(const QString& audioPath, const QS
         arguments << "--diarize";
     }
     
+    if (m_options.threads > 0) {
+        arguments << "--threads" << QString::number(m_options.threads);
+    }
+    
+    if (m_options.gpuDevice >= 0) {
+        // Pin the process to one device so parallel runs don't share a GPU
+        QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+        environment.insert("CUDA_VISIBLE_DEVICES", QString::number(m_options.gpuDevice));
+        m_currentProcess->setProcessEnvironment(environment);
+        arguments << "--device" << "cuda";
+    }
+    
     arguments << "--verbose" << "False";
     
     m_currentStatus = "Running Whisper transcription...";
@@ -456,6 +482,7 @@ QString AISubtitleGenerator::extractAudioFromVideo(const QString& videoPath)
     
     // Extract audio using FFmpeg
     QProcess ffmpegProcess;
+    ThreadPriority::setBackgroundProcess(&ffmpegProcess);
     QStringList arguments;
     arguments << "-i" << videoPath;
     arguments << "-vn"; // No video
@@ -480,7 +507,7 @@ QString AISubtitleGenerator::extractAudioFromVideo(const QString& videoPath)
     return tempAudioPath;
 }
 
-bool AISubtitleGenerator::isAudioFile(const QString& filePath) const
+bool AISubtitleGenerator::isAudioFile(const QString& filePath)
 {
     QFileInfo fileInfo(filePath);
     QString extension = fileInfo.suffix().toLower();
@@ -496,8 +523,84 @@ void AISubtitleGenerator::detectLanguageWithWhisper(const QString& audioPath)
         return;
     }
     
+    QString detectedLang;
+    double confidence = 0.0;
+    QString error;
+    if (runWhisperLanguageDetection(audioPath, detectedLang, confidence, error)) {
+        m_detectedLanguage = stringToLanguage(detectedLang);
+        m_languageConfidence = confidence;
+        
+        emit languageDetected(m_detectedLanguage, confidence);
+    } else {
+        emit languageDetectionFailed(error);
+    }
+}
+
+void AISubtitleGenerator::detectLanguageFromProbes(const QString& mediaFilePath)
+{
+    const qint64 durationMs = probeDurationMs(mediaFilePath);
+    
+    // Evenly spread window centres, 1/6, 3/6 and 5/6 for three, clear of intros and credits
+    QVector<qint64> offsets;
+    if (durationMs > static_cast<qint64>(LANGUAGE_PROBES) * LANGUAGE_PROBE_WINDOW_MS) {
+        for (int i = 0; i < LANGUAGE_PROBES; ++i) {
+            offsets << durationMs * (2 * i + 1) / (2 * LANGUAGE_PROBES) - LANGUAGE_PROBE_WINDOW_MS / 2;
+        }
+    } else {
+        offsets << 0;   // Short or of unknown length
+    }
+    
+    QHash<QString, double> scores;
+    int detections = 0;
+    QString error = "No speech found for language detection";
+    for (qint64 offset : offsets) {
+        const QString probePath = extractSpeechProbe(mediaFilePath, offset);
+        if (probePath.isEmpty()) {
+            continue;
+        }
+        
+        QString detectedLang;
+        double confidence = 0.0;
+        const bool detected = runWhisperLanguageDetection(probePath, detectedLang, confidence, error);
+        QFile::remove(probePath);
+        if (!detected || detectedLang.isEmpty()) {
+            continue;
+        }
+        
+        ++detections;
+        scores[detectedLang] += confidence;
+        qCDebug(aiSubtitles) << "Probe at" << offset << "ms:" << detectedLang << confidence;
+        if (confidence >= LANGUAGE_EARLY_CONFIDENCE) {
+            break;
+        }
+    }
+    
+    if (detections == 0) {
+        emit languageDetectionFailed(error);
+        return;
+    }
+    
+    // Probes that disagree lower the confidence of the winner
+    auto best = scores.constBegin();
+    for (auto it = scores.constBegin(); it != scores.constEnd(); ++it) {
+        if (it.value() > best.value()) {
+            best = it;
+        }
+    }
+    
+    m_detectedLanguage = stringToLanguage(best.key());
+    m_languageConfidence = best.value() / detections;
+    qCInfo(aiSubtitles) << "Detected" << best.key() << "in" << mediaFilePath << "from" << detections << "probes";
+    
+    emit languageDetected(m_detectedLanguage, m_languageConfidence);
+}
+
+bool AISubtitleGenerator::runWhisperLanguageDetection(const QString& audioPath, QString& language,
+                                                      double& confidence, QString& error) const
+{
     // Use Whisper's language detection feature
     QProcess whisperProcess;
+    ThreadPriority::setBackgroundProcess(&whisperProcess);
     QStringList arguments;
     arguments << audioPath;
     arguments << "--language" << "auto";
@@ -505,25 +608,137 @@ void AISubtitleGenerator::detectLanguageWithWhisper(const QString& audioPath)
     arguments << "--output_format" << "json";
     
     whisperProcess.start(m_whisperPath, arguments);
-    if (whisperProcess.waitForFinished(10000)) {
-        QByteArray output = whisperProcess.readAllStandardOutput();
-        QJsonDocument doc = QJsonDocument::fromJson(output);
-        
-        if (!doc.isNull()) {
-            QJsonObject obj = doc.object();
-            QString detectedLang = obj["language"].toString();
-            double confidence = obj["confidence"].toDouble();
-            
-            m_detectedLanguage = stringToLanguage(detectedLang);
-            m_languageConfidence = confidence;
-            
-            emit languageDetected(m_detectedLanguage, confidence);
-        } else {
-            emit languageDetectionFailed("Failed to parse language detection result");
+    if (!whisperProcess.waitForFinished(10000)) {
+        error = "Language detection process timed out";
+        return false;
+    }
+    
+    QJsonDocument doc = QJsonDocument::fromJson(whisperProcess.readAllStandardOutput());
+    if (doc.isNull()) {
+        error = "Failed to parse language detection result";
+        return false;
+    }
+    
+    QJsonObject obj = doc.object();
+    language = obj["language"].toString();
+    confidence = obj["confidence"].toDouble();
+    return true;
+}
+
+qint64 AISubtitleGenerator::probeDurationMs(const QString& mediaFilePath) const
+{
+    // Without an output FFmpeg only reads the header, prints it and exits
+    QProcess ffmpegProcess;
+    ffmpegProcess.start(m_ffmpegPath, QStringList() << "-nostdin" << "-i" << mediaFilePath);
+    if (!ffmpegProcess.waitForFinished(10000)) {
+        return 0;
+    }
+    
+    static const QRegularExpression durationRegex(R"(Duration:\s*(\d+):(\d{2}):(\d{2})\.(\d{2}))");
+    const QRegularExpressionMatch match = durationRegex.match(QString::fromUtf8(ffmpegProcess.readAllStandardError()));
+    if (!match.hasMatch()) {
+        return 0;
+    }
+    return ((match.captured(1).toLongLong() * 60 + match.captured(2).toLongLong()) * 60 +
+            match.captured(3).toLongLong()) * 1000 + match.captured(4).toLongLong() * 10;
+}
+
+QString AISubtitleGenerator::extractSpeechProbe(const QString& mediaFilePath, qint64 offsetMs) const
+{
+    // Seeking before -i, so only the window is decoded
+    QProcess ffmpegProcess;
+    ThreadPriority::setBackgroundProcess(&ffmpegProcess);
+    QStringList arguments;
+    arguments << "-nostdin";
+    arguments << "-ss" << QString::number(offsetMs / 1000.0, 'f', 3);
+    arguments << "-t" << QString::number(LANGUAGE_PROBE_WINDOW_MS / 1000.0, 'f', 3);
+    arguments << "-i" << mediaFilePath;
+    arguments << "-vn";
+    arguments << "-ac" << "1";
+    arguments << "-ar" << QString::number(PROBE_SAMPLE_RATE);
+    arguments << "-f" << "s16le" << "-";
+    
+    ffmpegProcess.start(m_ffmpegPath, arguments);
+    if (!ffmpegProcess.waitForFinished(30000) || ffmpegProcess.exitCode() != 0) {
+        qCWarning(aiSubtitles) << "FFmpeg could not decode probe at" << offsetMs << "ms of" << mediaFilePath;
+        return QString();
+    }
+    const QByteArray pcm = ffmpegProcess.readAllStandardOutput();
+    
+    // Frame energies against the window's own noise floor, its quietest tenth
+    const int frameSamples = PROBE_SAMPLE_RATE * PROBE_FRAME_MS / 1000;
+    const int frameCount = pcm.size() / (frameSamples * static_cast<int>(sizeof(qint16)));
+    if (frameCount == 0) {
+        return QString();
+    }
+    
+    QVector<double> frameDb(frameCount);
+    for (int frame = 0; frame < frameCount; ++frame) {
+        const char* data = pcm.constData() + frame * frameSamples * sizeof(qint16);
+        double energy = 0.0;
+        for (int i = 0; i < frameSamples; ++i) {
+            const double sample = qFromLittleEndian<qint16>(data + i * sizeof(qint16)) / 32768.0;
+            energy += sample * sample;
+        }
+        frameDb[frame] = 10.0 * std::log10(energy / frameSamples + 1e-12);
+    }
+    
+    QVector<double> sorted = frameDb;
+    std::nth_element(sorted.begin(), sorted.begin() + frameCount / 10, sorted.end());
+    const double threshold = std::max(PROBE_SILENCE_FLOOR_DB, sorted[frameCount / 10] + PROBE_SPEECH_MARGIN_DB);
+    
+    // Slide a probe-long span over the window to the most speech
+    const int spanFrames = std::min(frameCount, LANGUAGE_PROBE_MS / PROBE_FRAME_MS);
+    int speech = 0;
+    for (int frame = 0; frame < spanFrames; ++frame) {
+        speech += frameDb[frame] > threshold;
+    }
+    int bestStart = 0;
+    int bestSpeech = speech;
+    for (int start = 1; start + spanFrames <= frameCount; ++start) {
+        speech += (frameDb[start + spanFrames - 1] > threshold) - (frameDb[start - 1] > threshold);
+        if (speech > bestSpeech) {
+            bestStart = start;
+            bestSpeech = speech;
         }
-    } else {
-        emit languageDetectionFailed("Language detection process timed out");
     }
+    
+    if (bestSpeech < spanFrames * PROBE_MIN_SPEECH) {
+        qCDebug(aiSubtitles) << "No speech in probe at" << offsetMs << "ms";
+        return QString();
+    }
+    
+    QTemporaryFile probeFile(QDir::tempPath() + "/eonplay_probe_XXXXXX.wav");
+    probeFile.setAutoRemove(false);
+    if (!probeFile.open()) {
+        qCWarning(aiSubtitles) << "Failed to create temporary probe file";
+        return QString();
+    }
+    
+    const int frameBytes = frameSamples * static_cast<int>(sizeof(qint16));
+    const QByteArray span = pcm.mid(bestStart * frameBytes, spanFrames * frameBytes);
+    
+    // 44 byte canonical header, 16-bit mono PCM
+    QByteArray header(44, 0);
+    char* h = header.data();
+    memcpy(h, "RIFF", 4);
+    qToLittleEndian<quint32>(36 + span.size(), h + 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    qToLittleEndian<quint32>(16, h + 16);
+    qToLittleEndian<quint16>(1, h + 20);
+    qToLittleEndian<quint16>(1, h + 22);
+    qToLittleEndian<quint32>(PROBE_SAMPLE_RATE, h + 24);
+    qToLittleEndian<quint32>(PROBE_SAMPLE_RATE * 2, h + 28);
+    qToLittleEndian<quint16>(2, h + 32);
+    qToLittleEndian<quint16>(16, h + 34);
+    memcpy(h + 36, "data", 4);
+    qToLittleEndian<quint32>(span.size(), h + 40);
+    
+    if (probeFile.write(header) != header.size() || probeFile.write(span) != span.size()) {
+        probeFile.remove();
+        return QString();
+    }
+    return probeFile.fileName();
 }
 
 void AISubtitleGenerator::detectLanguageWithAPI(const QString& audioPath)
@@ -607,11 +822,18 @@ void AISubtitleGenerator::handleWhisperProcess()
     m_progressTimer->stop();
     
     if (m_currentProcess->exitCode() == 0) {
-        // Find the generated subtitle file
-        QString outputDir = QFileInfo(m_currentProcess->arguments().first()).absolutePath();
+        // Whisper names its output after the audio file, inside --output_dir
+        QString outputDir = QFileInfo(m_outputPath).absolutePath();
         QString baseName = QFileInfo(m_currentProcess->arguments().first()).completeBaseName();
         QString subtitlePath = QDir(outputDir).absoluteFilePath(baseName + "." + m_options.outputFormat);
         
+        if (QFile::exists(subtitlePath) && !m_outputPath.isEmpty() && subtitlePath != m_outputPath) {
+            QFile::remove(m_outputPath);
+            if (QFile::rename(subtitlePath, m_outputPath)) {
+                subtitlePath = m_outputPath;
+            }
+        }
+        
         if (QFile::exists(subtitlePath)) {
             m_isGenerating = false;
             emit generationCompleted(subtitlePath);
@@ -1,4 +1,6 @@
 #include "ai/AISubtitleManager.h"
+#include "DirectoryListingCache.h"
+#include "data/SubtitleIndexer.h"
 #include <QDir>
 #include <QFileInfo>
 #include <QTimer>
@@ -17,6 +19,9 @@ AISubtitleManager::AISubtitleManager(QObject* parent)
     , m_completedOperations(0)
     , m_batchTimer(new QTimer(this))
     , m_processingBatch(false)
+    , m_batchSucceeded(0)
+    , m_batchFailed(0)
+    , m_subtitleIndexer(nullptr)
     , m_autoDetectionEnabled(true)
 {
     setupComponents();
@@ -39,6 +44,29 @@ AISubtitleManager::AISubtitleManager(QObject* parent)
     qCInfo(aiSubtitleManager) << "AISubtitleManager initialized";
 }
 
+void AISubtitleManager::setSubtitleIndexer(Data::SubtitleIndexer* indexer)
+{
+    if (m_subtitleIndexer) {
+        disconnect(this, nullptr, m_subtitleIndexer, nullptr);
+    }
+    m_subtitleIndexer = indexer;
+    if (!indexer) {
+        return;
+    }
+    
+    // Generation does not always know its media file; it sits next to the output
+    connect(this, &AISubtitleManager::subtitlesGenerated, indexer,
+            [this, indexer](const QString& mediaFilePath, const QString& subtitlePath) {
+                const QString mediaPath = mediaFilePath.isEmpty() ? getMediaFileForSubtitle(subtitlePath)
+                                                                  : mediaFilePath;
+                indexer->indexFile(mediaPath, subtitlePath, true);
+            });
+    connect(this, &AISubtitleManager::subtitleAutoLoaded, indexer,
+            [indexer](const QString& mediaFilePath, const QString& subtitlePath) {
+                indexer->indexFile(mediaFilePath, subtitlePath, false);
+            });
+}
+
 void AISubtitleManager::setSettings(const AISubtitleSettings& settings)
 {
     m_settings = settings;
@@ -62,6 +90,11 @@ void AISubtitleManager::setSettings(const AISubtitleSettings& settings)
         m_translator->setTranslationOptions(transOptions);
     }
     
+    if (m_scheduler) {
+        m_scheduler->setGenerationOptions(m_generator->generationOptions());
+        m_scheduler->setTranslationOptions(m_translator->translationOptions());
+    }
+    
     qCInfo(aiSubtitleManager) << "Settings updated";
 }
 
@@ -199,17 +232,21 @@ QStringList AISubtitleManager::findSubtitleFiles(const QString& mediaFilePath)
             absoluteSearchPath = QDir(mediaDir).absoluteFilePath(searchPath);
         }
         
-        QDir searchDir(absoluteSearchPath);
-        if (!searchDir.exists()) {
+        const DirectoryListingCache::Listing listing = DirectoryListingCache::instance().listing(absoluteSearchPath);
+        if (!listing.exists) {
             continue;
         }
         
-        // Look for subtitle files with matching base name
+        // Look for subtitle files with matching base name, i.e. "<baseName>*.<ext>"
+        QDir searchDir(absoluteSearchPath);
         for (const QString& ext : subtitleExtensions) {
-            QString subtitlePattern = baseName + "*." + ext;
-            QStringList matches = searchDir.entryList(QStringList() << subtitlePattern, QDir::Files);
-            
-            for (const QString& match : matches) {
+            const QString suffix = "." + ext;
+            for (const QString& match : listing.files) {
+                if (match.size() < baseName.size() + suffix.size() ||
+                    !match.startsWith(baseName, Qt::CaseInsensitive) ||
+                    !match.endsWith(suffix, Qt::CaseInsensitive)) {
+                    continue;
+                }
                 QString fullPath = searchDir.absoluteFilePath(match);
                 if (!subtitleFiles.contains(fullPath)) {
                     subtitleFiles << fullPath;
@@ -244,12 +281,21 @@ QString AISubtitleManager::findBestSubtitleFile(const QString& mediaFilePath)
 
 void AISubtitleManager::processMultipleMediaFiles(const QStringList& mediaFilePaths)
 {
-    m_totalOperations = mediaFilePaths.size();
-    m_completedOperations = 0;
-    
-    emit batchOperationStarted("Processing media files", m_totalOperations);
+    beginBatch("Processing media files", mediaFilePaths.size());
     
     for (const QString& mediaFilePath : mediaFilePaths) {
+        // Only files that need subtitles generated are worth the scheduler
+        if (m_settings.autoGenerateSubtitles && isMediaFile(mediaFilePath) &&
+            findSubtitleFiles(mediaFilePath).isEmpty()) {
+            QFileInfo mediaInfo(mediaFilePath);
+            
+            SubtitleJobScheduler::Job job;
+            job.inputPath = mediaFilePath;
+            job.outputPath = QDir(mediaInfo.absolutePath()).absoluteFilePath(mediaInfo.completeBaseName() + ".srt");
+            submitBatchJob(job);
+            continue;
+        }
+        
         BatchOperation operation;
         operation.type = BatchOperation::DetectLanguage; // Just process, don't generate
         operation.inputPath = mediaFilePath;
@@ -259,42 +305,43 @@ void AISubtitleManager::processMultipleMediaFiles(const QStringList& mediaFilePa
 
 void AISubtitleManager::generateSubtitlesForMultipleFiles(const QStringList& mediaFilePaths, const QString& outputDirectory)
 {
-    m_totalOperations = mediaFilePaths.size();
-    m_completedOperations = 0;
-    
-    emit batchOperationStarted("Generating subtitles", m_totalOperations);
+    beginBatch("Generating subtitles", mediaFilePaths.size());
     
     for (const QString& mediaFilePath : mediaFilePaths) {
         QFileInfo mediaInfo(mediaFilePath);
-        QString outputPath = QDir(outputDirectory).absoluteFilePath(mediaInfo.completeBaseName() + ".srt");
+        QDir outputDir(outputDirectory);
         
-        BatchOperation operation;
-        operation.type = BatchOperation::GenerateSubtitles;
-        operation.inputPath = mediaFilePath;
-        operation.outputPath = outputPath;
-        queueBatchOperation(operation);
+        SubtitleJobScheduler::Job job;
+        job.inputPath = mediaFilePath;
+        job.outputPath = outputDir.absoluteFilePath(mediaInfo.completeBaseName() + ".srt");
+        
+        // Translation joins the pipeline instead of waiting for the whole batch
+        if (m_settings.autoTranslateSubtitles) {
+            job.translate = true;
+            job.targetLanguage = m_settings.preferredTargetLanguage;
+            job.translatedPath = outputDir.absoluteFilePath(mediaInfo.completeBaseName() + "_" +
+                SubtitleTranslator::languageToCode(m_settings.preferredTargetLanguage) + ".srt");
+        }
+        submitBatchJob(job);
     }
 }
 
 void AISubtitleManager::translateMultipleSubtitleFiles(const QStringList& subtitlePaths, const QString& outputDirectory,
                                                       SubtitleTranslator::Language targetLanguage)
 {
-    m_totalOperations = subtitlePaths.size();
-    m_completedOperations = 0;
-    
-    emit batchOperationStarted("Translating subtitles", m_totalOperations);
+    beginBatch("Translating subtitles", subtitlePaths.size());
     
     for (const QString& subtitlePath : subtitlePaths) {
         QFileInfo subtitleInfo(subtitlePath);
-        QString outputPath = QDir(outputDirectory).absoluteFilePath(
-            subtitleInfo.completeBaseName() + "_translated." + subtitleInfo.suffix());
         
-        BatchOperation operation;
-        operation.type = BatchOperation::TranslateSubtitles;
-        operation.inputPath = subtitlePath;
-        operation.outputPath = outputPath;
-        operation.targetLanguage = targetLanguage;
-        queueBatchOperation(operation);
+        SubtitleJobScheduler::Job job;
+        job.inputPath = subtitlePath;
+        job.generate = false;
+        job.translate = true;
+        job.targetLanguage = targetLanguage;
+        job.translatedPath = QDir(outputDirectory).absoluteFilePath(
+            subtitleInfo.completeBaseName() + "_translated." + subtitleInfo.suffix());
+        submitBatchJob(job);
     }
 }
 
@@ -302,7 +349,7 @@ bool AISubtitleManager::isBusy() const
 {
     bool generatorBusy = m_generator && m_generator->isGenerating();
     bool translatorBusy = m_translator && m_translator->isTranslating();
-    bool batchBusy = m_processingBatch || !m_batchQueue.isEmpty();
+    bool batchBusy = m_processingBatch || !m_batchQueue.isEmpty() || (m_scheduler && !m_scheduler->isIdle());
     
     return generatorBusy || translatorBusy || batchBusy;
 }
@@ -314,6 +361,10 @@ void AISubtitleManager::setupComponents()
     m_detector = std::make_unique<SubtitleLanguageDetector>(this);
     m_translator = std::make_unique<SubtitleTranslator>(this);
     
+    m_scheduler = std::make_unique<SubtitleJobScheduler>(this);
+    m_scheduler->setGenerationOptions(m_generator->generationOptions());
+    m_scheduler->setTranslationOptions(m_translator->translationOptions());
+    
     qCInfo(aiSubtitleManager) << "AI components created";
 }
 
@@ -347,6 +398,14 @@ void AISubtitleManager::connectSignals()
                 this, &AISubtitleManager::onTranslationFailed);
     }
     
+    // Connect scheduler signals
+    if (m_scheduler) {
+        connect(m_scheduler.get(), &SubtitleJobScheduler::jobFinished,
+                this, &AISubtitleManager::onJobFinished);
+        connect(m_scheduler.get(), &SubtitleJobScheduler::jobFailed,
+                this, &AISubtitleManager::onJobFailed);
+    }
+    
     qCInfo(aiSubtitleManager) << "Component signals connected";
 }
 
@@ -448,17 +507,52 @@ void AISubtitleManager::processBatchOperation(const BatchOperation& operation)
             } else if (isSubtitleFile(operation.inputPath)) {
                 processSubtitleFile(operation.inputPath);
             }
+            completeBatchItem(true);
             break;
     }
 }
 
+void AISubtitleManager::beginBatch(const QString& operation, int totalFiles)
+{
+    m_batchOperation = operation;
+    m_totalOperations = totalFiles;
+    m_completedOperations = 0;
+    m_batchSucceeded = 0;
+    m_batchFailed = 0;
+    
+    emit batchOperationStarted(operation, totalFiles);
+}
+
+void AISubtitleManager::submitBatchJob(const SubtitleJobScheduler::Job& job)
+{
+    const int id = m_scheduler->submit(job);
+    m_batchJobs.insert(id, job);
+}
+
+void AISubtitleManager::completeBatchItem(bool succeeded)
+{
+    m_completedOperations++;
+    if (succeeded) {
+        m_batchSucceeded++;
+    } else {
+        m_batchFailed++;
+    }
+    
+    emit batchOperationProgress(m_completedOperations, m_totalOperations);
+    
+    if (m_completedOperations >= m_totalOperations) {
+        emit batchOperationCompleted(m_batchOperation, m_batchSucceeded, m_batchFailed);
+    }
+}
+
 void AISubtitleManager::processBatchQueue()
 {
     if (m_batchQueue.isEmpty() || m_processingBatch) {
         return;
     }
     
-    if (isBusy()) {
+    // The scheduler runs its own jobs, only the single-job components matter here
+    if ((m_generator && m_generator->isGenerating()) || (m_translator && m_translator->isTranslating())) {
         // Wait for current operations to complete
         m_batchTimer->start();
         return;
@@ -485,32 +579,15 @@ void AISubtitleManager::onGenerationStarted(const QString& filePath)
 
 void AISubtitleManager::onGenerationCompleted(const QString& subtitlePath)
 {
-    m_completedOperations++;
+    // Found by the next lookup even before the watcher reports the new file
+    DirectoryListingCache::instance().invalidate(QFileInfo(subtitlePath).absolutePath());
     emit subtitlesGenerated("", subtitlePath); // Media file path not available here
     emit operationCompleted("Generating subtitles", subtitlePath);
-    
-    if (m_totalOperations > 0) {
-        emit batchOperationProgress(m_completedOperations, m_totalOperations);
-        
-        if (m_completedOperations >= m_totalOperations) {
-            emit batchOperationCompleted("Generating subtitles", m_completedOperations, 0);
-        }
-    }
 }
 
 void AISubtitleManager::onGenerationFailed(const QString& error)
 {
-    m_completedOperations++;
     emit operationFailed("Generating subtitles", error);
-    
-    if (m_totalOperations > 0) {
-        emit batchOperationProgress(m_completedOperations, m_totalOperations);
-        
-        if (m_completedOperations >= m_totalOperations) {
-            int failedFiles = m_totalOperations - (m_completedOperations - 1);
-            emit batchOperationCompleted("Generating subtitles", m_completedOperations - 1, failedFiles);
-        }
-    }
 }
 
 void AISubtitleManager::onLanguageDetected(const QString& filePath, const SubtitleLanguageDetector::DetectionResult& result)
@@ -546,32 +623,39 @@ void AISubtitleManager::onTranslationStarted(const QString& filePath)
 
 void AISubtitleManager::onTranslationCompleted(const QString& outputPath)
 {
-    m_completedOperations++;
+    DirectoryListingCache::instance().invalidate(QFileInfo(outputPath).absolutePath());
     emit subtitlesTranslated("", outputPath, ""); // Input path and language not available here
     emit operationCompleted("Translating subtitles", outputPath);
-    
-    if (m_totalOperations > 0) {
-        emit batchOperationProgress(m_completedOperations, m_totalOperations);
-        
-        if (m_completedOperations >= m_totalOperations) {
-            emit batchOperationCompleted("Translating subtitles", m_completedOperations, 0);
-        }
-    }
 }
 
 void AISubtitleManager::onTranslationFailed(const QString& error)
 {
-    m_completedOperations++;
     emit operationFailed("Translating subtitles", error);
+}
+
+void AISubtitleManager::onJobFinished(int id, const QString& inputPath, const QString& outputPath)
+{
+    const SubtitleJobScheduler::Job job = m_batchJobs.take(id);
+    DirectoryListingCache::instance().invalidate(QFileInfo(outputPath).absolutePath());
     
-    if (m_totalOperations > 0) {
-        emit batchOperationProgress(m_completedOperations, m_totalOperations);
-        
-        if (m_completedOperations >= m_totalOperations) {
-            int failedFiles = m_totalOperations - (m_completedOperations - 1);
-            emit batchOperationCompleted("Translating subtitles", m_completedOperations - 1, failedFiles);
-        }
+    if (job.generate) {
+        emit subtitlesGenerated(inputPath, job.outputPath);
     }
+    if (job.translate) {
+        emit subtitlesTranslated(job.generate ? job.outputPath : inputPath, job.translatedPath,
+                                 SubtitleTranslator::languageToString(job.targetLanguage));
+    }
+    emit operationCompleted(m_batchOperation, outputPath);
+    
+    completeBatchItem(true);
+}
+
+void AISubtitleManager::onJobFailed(int id, const QString& inputPath, const QString& error)
+{
+    m_batchJobs.remove(id);
+    emit operationFailed(m_batchOperation, inputPath + ": " + error);
+    
+    completeBatchItem(false);
 }
 
 } // namespace AI
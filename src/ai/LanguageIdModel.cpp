@@ -0,0 +1,426 @@
+#include "ai/LanguageIdModel.h"
+#include <QDir>
+#include <QLoggingCategory>
+#include <QResource>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+Q_LOGGING_CATEGORY(languageIdModel, "eonplay.ai.language.model")
+
+namespace EonPlay {
+namespace AI {
+
+namespace {
+
+const char MODEL_MAGIC[4] = {'E', 'P', 'L', 'I'};
+const quint32 MODEL_VERSION = 1;
+const int HEADER_SIZE = 24;
+const int CODE_SIZE = 8;
+const int LANE_ALIGNMENT = 16;          // Lanes per row, a multiple of the widest vector
+const double SHARPNESS = 4.0;           // Posterior on the mean log probability per trigram
+
+// Frequent words of subtitle dialogue, used when no trained model is installed.
+// Languages with a script of their own are left to the script check.
+struct SeedWords {
+    const char* code;
+    const char* words;
+};
+
+const SeedWords SEED_WORDS[] = {
+    {"en", "the you i to a and it is that of what me in this know don't not for be on have we my your "
+           "do are was he with just no all so can get here like right there they"},
+    {"es", "que de no a la el es y en lo un por qué me una te los se con para mi está si bien pero yo "
+           "eso las sí su tu aquí del al como le más esto"},
+    {"fr", "de je est pas le vous la tu que un il et à a ne les ce en on ça une pour des qui elle me "
+           "mais bien dans oui nous suis avec moi c'est"},
+    {"de", "ich die und du der nicht das ist zu sie es ein in wir was mit den ja mir sich auf mich hier "
+           "auch so dich wie aber noch ihr schon"},
+    {"it", "non di che è e la il un a per mi ho sono ti lo si ma cosa una no le in mio come bene questo "
+           "ci qui perché sei hai io gli della niente grazie allora voglio stato anche"},
+    {"pt", "que não o de a é e um você eu para se do me uma com está isso da os em por mas no na bem "
+           "ele sim aqui meu tem"},
+    {"ru", "я не что в и ты на он это с как мы вы а так но да меня все то мне она у тебя есть был нет "
+           "его"},
+    {"bg", "и да не се на е в аз че ти това за то ли си ще той ме какво ми така но от са тук как беше "
+           "нещо може"},
+    {"nl", "ik je het de is dat een niet en wat van we in ze op te hij zijn er maar met voor die heb "
+           "mij dit als ben hier"},
+    {"sv", "jag det är du inte att en och har vi på i som för med han vad mig så den ett om kan hon här "
+           "till var nu"},
+    {"no", "jeg det er du ikke å en og har vi på i som for med han hva meg så den et kan hun her til "
+           "var nå deg"},
+    {"da", "jeg det er du ikke at en og har vi på i som for med han hvad mig så den et kan hun her til "
+           "var nu dig"},
+    {"fi", "on ei se että minä sinä hän mitä ja en mutta tämä oli ole kun niin me te he jos olen olet "
+           "kanssa vain nyt"},
+    {"pl", "nie to się w na i jest że co z jak ja tak mi do ty już mnie ale o jestem czy go tu od by "
+           "jego"},
+    {"cs", "je to se na že a v co ne jsem tak jak ty mi já si ale by jsi tady už bude s pro mě"},
+    {"hu", "a az nem hogy és is meg egy van ez mi csak de ki én te már mit jó itt azt volt vagy kell "
+           "még"},
+    {"ro", "să nu de e și în la un ce o pe mi te cu ai am din a fost ești eu da asta dar mai ca"},
+    {"tr", "bir ve bu da ne için ben sen mi çok o var değil ama de gibi ile şey evet hayır nasıl daha "
+           "benim seni"},
+    {"vi", "tôi không là có anh của và em một được cô cái này đó người cho những đi với ông ở gì bạn "
+           "đã"},
+    {"id", "yang saya tidak itu kamu ini aku dan di apa ada akan bisa dengan dia untuk kita sudah ke "
+           "mereka tahu saja"},
+    {"ms", "yang saya tidak itu awak ini aku dan di apa ada akan boleh dengan dia untuk kita sudah ke "
+           "mereka tahu sahaja tak"},
+};
+
+// Scripts only one supported language is written in
+QString scriptLanguage(QChar::Script script)
+{
+    switch (script) {
+        case QChar::Script_Greek: return QStringLiteral("el");
+        case QChar::Script_Hebrew: return QStringLiteral("he");
+        case QChar::Script_Arabic: return QStringLiteral("ar");
+        case QChar::Script_Thai: return QStringLiteral("th");
+        case QChar::Script_Devanagari: return QStringLiteral("hi");
+        case QChar::Script_Hangul: return QStringLiteral("ko");
+        case QChar::Script_Hiragana:
+        case QChar::Script_Katakana: return QStringLiteral("ja");
+        case QChar::Script_Han: return QStringLiteral("zh");
+        default: return QString();
+    }
+}
+
+void appendLittleEndian(QByteArray& out, quint32 value)
+{
+    char bytes[4];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 4);
+}
+
+// Calls visit(hash) for every trigram of normalized text
+template <typename Visit>
+void forEachTrigram(const QString& normalized, Visit visit, quint32 (*hash)(QChar, QChar, QChar))
+{
+    const QChar* chars = normalized.constData();
+    for (qsizetype i = 0; i + 2 < normalized.size(); ++i) {
+        visit(hash(chars[i], chars[i + 1], chars[i + 2]));
+    }
+}
+
+}
+
+const LanguageIdModel& LanguageIdModel::instance()
+{
+    static LanguageIdModel model;
+    static const bool loaded = [] {
+        const QString installed = QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation))
+                                      .filePath("models/langid.bin");
+        if (QFile::exists(installed) && model.loadFile(installed)) {
+            qCInfo(languageIdModel) << "Mapped language model" << installed;
+            return true;
+        }
+
+        // Uncompressed resources are already part of the mapped executable
+        const QResource resource(QStringLiteral(":/models/langid.bin"));
+        if (resource.isValid()) {
+            const bool ok = resource.compressionAlgorithm() == QResource::NoCompression
+                ? model.attach(resource.data(), resource.size())
+                : model.loadData(resource.uncompressedData());
+            if (ok) {
+                qCInfo(languageIdModel) << "Using embedded language model";
+                return true;
+            }
+        }
+
+        QHash<QString, QString> samples;
+        for (const SeedWords& seed : SEED_WORDS) {
+            samples.insert(QString::fromLatin1(seed.code), QString::fromUtf8(seed.words));
+        }
+        const bool ok = model.loadData(train(samples, 12));
+        qCInfo(languageIdModel) << "Using built-in language model for" << model.languages().size() << "languages";
+        return ok;
+    }();
+    Q_UNUSED(loaded);
+    return model;
+}
+
+QByteArray LanguageIdModel::train(const QHash<QString, QString>& samples, int bucketBits)
+{
+    bucketBits = qBound(8, bucketBits, 20);
+    const int buckets = 1 << bucketBits;
+    const quint32 mask = static_cast<quint32>(buckets - 1);
+
+    QStringList codes = samples.keys();
+    codes.removeIf([](const QString& code) { return code.isEmpty() || code.size() > CODE_SIZE; });
+    std::sort(codes.begin(), codes.end());
+    if (codes.isEmpty()) {
+        return QByteArray();
+    }
+    const int stride = (static_cast<int>(codes.size()) + LANE_ALIGNMENT - 1) / LANE_ALIGNMENT * LANE_ALIGNMENT;
+
+    // Relative trigram frequencies per language
+    std::vector<std::vector<double>> frequencies(codes.size(), std::vector<double>(buckets, 0.0));
+    double smallestTotal = 0.0;
+    for (int l = 0; l < codes.size(); ++l) {
+        double total = 0.0;
+        forEachTrigram(normalize(samples.value(codes[l])), [&](quint32 hash) {
+            frequencies[l][hash & mask] += 1.0;
+            total += 1.0;
+        }, &trigramHash);
+        if (total > 0.0) {
+            for (double& frequency : frequencies[l]) {
+                frequency /= total;
+            }
+            smallestTotal = smallestTotal > 0.0 ? qMin(smallestTotal, total) : total;
+        }
+    }
+
+    // Unseen trigrams get the same probability in every language, so sample
+    // size does not bias the result: at most half an observation in the
+    // smallest sample, and a tenth of the mass over all buckets
+    const double epsilon = qMin(0.5 / qMax(1.0, smallestTotal), 0.1 / buckets);
+    const double floorLog = std::log(epsilon / (1.0 + epsilon * buckets));
+    const quint32 scale = static_cast<quint32>(qMax(1.0, 32000.0 / -floorLog));
+
+    QByteArray out;
+    out.reserve(HEADER_SIZE + CODE_SIZE * codes.size() + buckets * stride * 2);
+    out.append(MODEL_MAGIC, 4);
+    appendLittleEndian(out, MODEL_VERSION);
+    appendLittleEndian(out, static_cast<quint32>(codes.size()));
+    appendLittleEndian(out, static_cast<quint32>(stride));
+    appendLittleEndian(out, static_cast<quint32>(bucketBits));
+    appendLittleEndian(out, scale);
+
+    for (const QString& code : codes) {
+        out.append(code.toLatin1().leftJustified(CODE_SIZE, '\0', true));
+    }
+
+    for (int bucket = 0; bucket < buckets; ++bucket) {
+        for (int lane = 0; lane < stride; ++lane) {
+            qint16 value = 0;
+            if (lane < codes.size()) {
+                const double p = (frequencies[lane][bucket] + epsilon) / (1.0 + epsilon * buckets);
+                value = static_cast<qint16>(qBound(-32767.0, std::round(std::log(p) * scale), 0.0));
+            }
+            char bytes[2];
+            qToLittleEndian(value, bytes);
+            out.append(bytes, 2);
+        }
+    }
+
+    return out;
+}
+
+bool LanguageIdModel::loadFile(const QString& filePath)
+{
+    auto file = std::make_unique<QFile>(filePath);
+    if (!file->open(QIODevice::ReadOnly)) {
+        qCWarning(languageIdModel) << "Cannot open language model" << filePath << file->errorString();
+        return false;
+    }
+
+    const qint64 size = file->size();
+    const uchar* data = file->map(0, size);
+    if (!data) {
+        // Not mappable, e.g. on some network file systems
+        return loadData(file->readAll());
+    }
+
+    if (!attach(data, size)) {
+        return false;
+    }
+    m_owned.clear();
+    m_file = std::move(file);
+    return true;
+}
+
+bool LanguageIdModel::loadData(const QByteArray& data)
+{
+    m_owned = data;
+    if (!attach(reinterpret_cast<const uchar*>(m_owned.constData()), m_owned.size())) {
+        m_owned.clear();
+        return false;
+    }
+    m_file.reset();
+    return true;
+}
+
+bool LanguageIdModel::attach(const uchar* data, qint64 size)
+{
+    if (!data || size < HEADER_SIZE || std::memcmp(data, MODEL_MAGIC, 4) != 0 ||
+        qFromLittleEndian<quint32>(data + 4) != MODEL_VERSION) {
+        qCWarning(languageIdModel) << "Not a language model";
+        return false;
+    }
+
+    const quint32 languageCount = qFromLittleEndian<quint32>(data + 8);
+    const quint32 stride = qFromLittleEndian<quint32>(data + 12);
+    const quint32 bucketBits = qFromLittleEndian<quint32>(data + 16);
+    const quint32 scale = qFromLittleEndian<quint32>(data + 20);
+
+    const qint64 tableOffset = HEADER_SIZE + static_cast<qint64>(CODE_SIZE) * languageCount;
+    if (languageCount == 0 || stride < languageCount || stride % LANE_ALIGNMENT != 0 ||
+        bucketBits < 8 || bucketBits > 20 || scale == 0 ||
+        size < tableOffset + (qint64(1) << bucketBits) * stride * 2) {
+        qCWarning(languageIdModel) << "Language model is truncated or malformed";
+        return false;
+    }
+
+    QStringList codes;
+    for (quint32 i = 0; i < languageCount; ++i) {
+        const char* code = reinterpret_cast<const char*>(data + HEADER_SIZE + i * CODE_SIZE);
+        codes << QString::fromLatin1(code, qstrnlen(code, CODE_SIZE));
+    }
+
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    // The table is stored little-endian; swap a private copy
+    const qint64 tableSize = (qint64(1) << bucketBits) * stride * 2;
+    QByteArray swapped(reinterpret_cast<const char*>(data), tableOffset + tableSize);
+    qint16* values = reinterpret_cast<qint16*>(swapped.data() + tableOffset);
+    for (qint64 i = 0; i < tableSize / 2; ++i) {
+        values[i] = qFromLittleEndian(values[i]);
+    }
+    m_owned = swapped;
+    data = reinterpret_cast<const uchar*>(m_owned.constData());
+#endif
+
+    m_table = reinterpret_cast<const qint16*>(data + tableOffset);
+    m_codes = codes;
+    m_stride = static_cast<int>(stride);
+    m_bucketMask = (quint32(1) << bucketBits) - 1;
+    m_scale = scale;
+    return true;
+}
+
+QList<LanguageIdModel::Score> LanguageIdModel::classify(const QString& text, int maxResults) const
+{
+    QList<Score> scores;
+    const QString sampled = sample(text);
+
+    // Script first: a text that is mostly Hangul is Korean whatever the model says
+    QHash<QString, int> scriptLetters;
+    int letters = 0;
+    int kana = 0;
+    for (QChar ch : sampled) {
+        if (!ch.isLetter()) {
+            continue;
+        }
+        ++letters;
+        const QChar::Script script = ch.script();
+        if (script == QChar::Script_Hiragana || script == QChar::Script_Katakana) {
+            ++kana;
+        }
+        const QString code = scriptLanguage(script);
+        if (!code.isEmpty()) {
+            ++scriptLetters[code];
+        }
+    }
+    if (letters == 0) {
+        return scores;
+    }
+
+    // Japanese mixes kanji with kana, Chinese has none
+    if (kana > 0) {
+        scriptLetters["ja"] += scriptLetters.take("zh");
+    }
+    for (auto it = scriptLetters.cbegin(); it != scriptLetters.cend(); ++it) {
+        if (it.value() * 2 >= letters) {
+            scores.append(Score{it.key(), qMin(0.99, double(it.value()) / letters)});
+            return scores;
+        }
+    }
+
+    if (!isValid()) {
+        return scores;
+    }
+
+    // Sum the log probability rows of every trigram
+    std::vector<qint32> accumulators(m_stride, 0);
+    qint32* acc = accumulators.data();
+    const int stride = m_stride;
+    int trigrams = 0;
+    forEachTrigram(normalize(sampled), [&](quint32 hash) {
+        const qint16* row = m_table + static_cast<qsizetype>(hash & m_bucketMask) * stride;
+        for (int lane = 0; lane < stride; ++lane) {
+            acc[lane] += row[lane];
+        }
+        ++trigrams;
+    }, &trigramHash);
+    if (trigrams == 0) {
+        return scores;
+    }
+
+    // Posterior from the mean log probability per trigram, so confidence says
+    // how clearly the text fits rather than how long it is
+    const double weight = SHARPNESS / trigrams / m_scale;
+    const qint32 best = *std::max_element(acc, acc + m_codes.size());
+    double total = 0.0;
+    for (int l = 0; l < m_codes.size(); ++l) {
+        const double p = std::exp((acc[l] - best) * weight);
+        scores.append(Score{m_codes[l], p});
+        total += p;
+    }
+    for (Score& score : scores) {
+        score.probability /= total;
+    }
+
+    std::sort(scores.begin(), scores.end(), [](const Score& a, const Score& b) {
+        return a.probability > b.probability;
+    });
+    if (maxResults > 0 && scores.size() > maxResults) {
+        scores.resize(maxResults);
+    }
+    return scores;
+}
+
+QString LanguageIdModel::sample(const QString& text)
+{
+    if (text.size() <= MAX_SAMPLE_CHARACTERS) {
+        return text;
+    }
+
+    // A few evenly spaced windows, openings are often credits or song lyrics
+    const int windows = 4;
+    const qsizetype length = MAX_SAMPLE_CHARACTERS / windows;
+    QString sampled;
+    sampled.reserve(MAX_SAMPLE_CHARACTERS + windows);
+    for (int i = 0; i < windows; ++i) {
+        const qsizetype start = (text.size() - length) * i / (windows - 1);
+        sampled += text.mid(start, length);
+        sampled += QLatin1Char(' ');
+    }
+    return sampled;
+}
+
+QString LanguageIdModel::normalize(const QString& text)
+{
+    // Letter runs separated by single spaces, with a space at each end so
+    // trigrams see word boundaries
+    QString normalized;
+    normalized.reserve(text.size() + 2);
+    normalized += QLatin1Char(' ');
+    for (QChar ch : text) {
+        if (ch.isLetter() || ch.isMark() || ch == QLatin1Char('\'')) {
+            normalized += ch.toLower();
+        } else if (!normalized.endsWith(QLatin1Char(' '))) {
+            normalized += QLatin1Char(' ');
+        }
+    }
+    if (!normalized.endsWith(QLatin1Char(' '))) {
+        normalized += QLatin1Char(' ');
+    }
+    return normalized;
+}
+
+quint32 LanguageIdModel::trigramHash(QChar a, QChar b, QChar c)
+{
+    // FNV-1a over the three UTF-16 code units
+    quint32 hash = 2166136261u;
+    hash = (hash ^ a.unicode()) * 16777619u;
+    hash = (hash ^ b.unicode()) * 16777619u;
+    hash = (hash ^ c.unicode()) * 16777619u;
+    return hash ^ (hash >> 15);
+}
+
+} // namespace AI
+} // namespace EonPlay
@@ -0,0 +1,631 @@
+#include "ai/SubtitleJobScheduler.h"
+#include "ThreadPriority.h"
+#include "CpuTopology.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QProcess>
+#include <QTemporaryFile>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+
+Q_LOGGING_CATEGORY(subtitleJobs, "eonplay.ai.subtitlejobs")
+
+namespace EonPlay {
+namespace AI {
+
+SubtitleJobScheduler::SubtitleJobScheduler(QObject* parent)
+    : QObject(parent)
+    , m_gpuCount(detectGpuCount())
+{
+    for (int i = 0; i < m_gpuCount; ++i) {
+        m_gpuLoad.append(0);
+    }
+
+    // The first worker also tells us where FFmpeg is
+    AISubtitleGenerator* generator = takeGenerator();
+    m_ffmpegPath = generator->ffmpegExecutable();
+    returnGenerator(generator);
+
+    m_cloudTokens = std::min(m_cloudRequestsPerMinute, limit(Resource::CloudApi));
+    m_cloudClock.start();
+
+    qCInfo(subtitleJobs) << "Subtitle job scheduler initialized, GPUs:" << m_gpuCount
+                         << "local slots:" << limit(Resource::LocalInference)
+                         << "extraction slots:" << limit(Resource::Extraction);
+}
+
+SubtitleJobScheduler::~SubtitleJobScheduler()
+{
+    // Jobs dropped on the way out are not reported
+    blockSignals(true);
+    cancelAll();
+}
+
+void SubtitleJobScheduler::setGenerationOptions(const AISubtitleGenerator::GenerationOptions& options)
+{
+    m_generationOptions = options;
+}
+
+void SubtitleJobScheduler::setTranslationOptions(const SubtitleTranslator::TranslationOptions& options)
+{
+    m_translationOptions = options;
+}
+
+int SubtitleJobScheduler::submit(const Job& job)
+{
+    const int id = m_nextId++;
+    ActiveJob& active = m_jobs[id];
+    active.id = id;
+    active.job = job;
+
+    if (!job.generate) {
+        enqueue(active, Stage::Translate);
+    } else if (AISubtitleGenerator::isAudioFile(job.inputPath)) {
+        active.audioPath = job.inputPath;
+        enqueue(active, Stage::Transcribe);
+    } else {
+        enqueue(active, Stage::Extract);
+    }
+    return id;
+}
+
+void SubtitleJobScheduler::cancelAll()
+{
+    if (m_jobs.empty()) {
+        return;
+    }
+
+    for (auto it = m_extractions.cbegin(); it != m_extractions.cend(); ++it) {
+        QProcess* process = it.value();
+        process->disconnect(this);
+        process->kill();
+        process->waitForFinished(3000);
+        process->deleteLater();
+    }
+    m_extractions.clear();
+    discardBusyWorkers();
+
+    const std::map<int, ActiveJob> jobs = std::move(m_jobs);
+    m_jobs.clear();
+    m_ready.clear();
+    m_inUse.clear();
+    std::fill(m_gpuLoad.begin(), m_gpuLoad.end(), 0);
+
+    for (const auto& entry : jobs) {
+        const ActiveJob& active = entry.second;
+        if (!active.audioPath.isEmpty() && active.audioPath != active.job.inputPath) {
+            QFile::remove(active.audioPath);
+        }
+        ++m_failed;
+        emit jobFailed(active.id, active.job.inputPath, "Cancelled");
+    }
+
+    const int succeeded = m_succeeded;
+    const int failed = m_failed;
+    m_succeeded = 0;
+    m_failed = 0;
+    emit allFinished(succeeded, failed);
+}
+
+void SubtitleJobScheduler::setLimit(Resource resource, int limit)
+{
+    if (limit > 0) {
+        m_limits.insert(static_cast<int>(resource), limit);
+    } else {
+        m_limits.remove(static_cast<int>(resource));
+    }
+    schedulePump();
+}
+
+int SubtitleJobScheduler::limit(Resource resource) const
+{
+    return m_limits.value(static_cast<int>(resource), defaultLimit(resource));
+}
+
+void SubtitleJobScheduler::setCloudRequestsPerMinute(int requests)
+{
+    m_cloudRequestsPerMinute = std::max(0, requests);
+    m_cloudTokens = std::min(m_cloudRequestsPerMinute, limit(Resource::CloudApi));
+    m_cloudClock.restart();
+    schedulePump();
+}
+
+int SubtitleJobScheduler::detectGpuCount()
+{
+    const QByteArray visible = qgetenv("CUDA_VISIBLE_DEVICES");
+    if (!visible.isNull()) {
+        // An empty list or -1 hides every device
+        const QList<QByteArray> devices = visible.split(',');
+        int count = 0;
+        for (const QByteArray& device : devices) {
+            const QByteArray trimmed = device.trimmed();
+            if (trimmed.isEmpty() || trimmed.startsWith('-')) {
+                break;
+            }
+            ++count;
+        }
+        return count;
+    }
+
+    QProcess process;
+    process.start("nvidia-smi", QStringList() << "-L");
+    if (!process.waitForFinished(3000) || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        return 0;
+    }
+
+    int count = 0;
+    const QList<QByteArray> lines = process.readAllStandardOutput().split('\n');
+    for (const QByteArray& line : lines) {
+        if (line.startsWith("GPU ")) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void SubtitleJobScheduler::enqueue(ActiveJob& active, Stage stage)
+{
+    active.stage = stage;
+    m_ready[static_cast<int>(stage)].enqueue(active.id);
+    schedulePump();
+}
+
+void SubtitleJobScheduler::schedulePump()
+{
+    // Coalesced and deferred, so completions reported from inside a start
+    // call never re-enter the pump
+    if (m_pumpQueued) {
+        return;
+    }
+    m_pumpQueued = true;
+    QMetaObject::invokeMethod(this, &SubtitleJobScheduler::pump, Qt::QueuedConnection);
+}
+
+void SubtitleJobScheduler::pump()
+{
+    m_pumpQueued = false;
+
+    // Later stages first, to drain the pipeline
+    for (Stage stage : {Stage::Translate, Stage::Transcribe, Stage::Extract}) {
+        while (startNext(stage)) {
+        }
+    }
+}
+
+bool SubtitleJobScheduler::startNext(Stage stage)
+{
+    QQueue<int>& queue = m_ready[static_cast<int>(stage)];
+    if (queue.isEmpty()) {
+        return false;
+    }
+
+    if (stage == Stage::Extract) {
+        const int waiting = m_ready.value(static_cast<int>(Stage::Transcribe)).size() + m_extractions.size();
+        if (waiting >= EXTRACT_AHEAD * limit(resourceFor(Stage::Transcribe))) {
+            return false;
+        }
+    }
+
+    const Resource resource = resourceFor(stage);
+    if (!acquire(resource)) {
+        return false;
+    }
+
+    auto it = m_jobs.find(queue.dequeue());
+    if (it == m_jobs.end()) {
+        release(resource);
+        return true;
+    }
+
+    ActiveJob& active = it->second;
+    active.held = resource;
+    if (!active.started) {
+        active.started = true;
+        emit jobStarted(active.id, active.job.inputPath);
+    }
+    emit stageStarted(active.id, stage);
+
+    switch (stage) {
+        case Stage::Extract:
+            startExtraction(active);
+            break;
+        case Stage::Transcribe:
+            startTranscription(active);
+            break;
+        case Stage::Translate:
+            startTranslation(active);
+            break;
+    }
+    return true;
+}
+
+SubtitleJobScheduler::Resource SubtitleJobScheduler::resourceFor(Stage stage) const
+{
+    switch (stage) {
+        case Stage::Extract:
+            return Resource::Extraction;
+        case Stage::Transcribe:
+            return (m_generationOptions.engine == AISubtitleGenerator::Whisper ||
+                    m_generationOptions.engine == AISubtitleGenerator::LocalVosk)
+                ? Resource::LocalInference : Resource::CloudApi;
+        case Stage::Translate:
+            return m_translationOptions.service == SubtitleTranslator::LocalTranslator
+                ? Resource::LocalInference : Resource::CloudApi;
+    }
+    return Resource::CloudApi;
+}
+
+bool SubtitleJobScheduler::acquire(Resource resource)
+{
+    const int key = static_cast<int>(resource);
+    if (m_inUse.value(key) >= limit(resource)) {
+        return false;
+    }
+
+    if (resource == Resource::CloudApi && m_cloudRequestsPerMinute > 0) {
+        refillCloudTokens();
+        if (m_cloudTokens < 1.0) {
+            // Come back when the next token is due
+            if (!m_cloudRetryQueued) {
+                m_cloudRetryQueued = true;
+                const int delay = static_cast<int>(std::ceil((1.0 - m_cloudTokens) * 60000.0 / m_cloudRequestsPerMinute));
+                QTimer::singleShot(delay, this, [this]() {
+                    m_cloudRetryQueued = false;
+                    pump();
+                });
+            }
+            return false;
+        }
+        m_cloudTokens -= 1.0;
+    }
+
+    ++m_inUse[key];
+    return true;
+}
+
+void SubtitleJobScheduler::release(Resource resource)
+{
+    const int key = static_cast<int>(resource);
+    if (m_inUse.value(key) > 0) {
+        --m_inUse[key];
+    }
+    schedulePump();
+}
+
+void SubtitleJobScheduler::refillCloudTokens()
+{
+    // Bursts are limited to what may run at once anyway
+    const double capacity = std::max(1, std::min(m_cloudRequestsPerMinute, limit(Resource::CloudApi)));
+    m_cloudTokens = std::min(capacity, m_cloudTokens + m_cloudClock.restart() * m_cloudRequestsPerMinute / 60000.0);
+}
+
+void SubtitleJobScheduler::advance(ActiveJob& active)
+{
+    switch (active.stage) {
+        case Stage::Extract:
+            enqueue(active, Stage::Transcribe);
+            break;
+        case Stage::Transcribe:
+            if (active.job.translate) {
+                enqueue(active, Stage::Translate);
+            } else {
+                finishJob(active.id, active.job.outputPath);
+            }
+            break;
+        case Stage::Translate:
+            finishJob(active.id, active.job.translatedPath);
+            break;
+    }
+}
+
+void SubtitleJobScheduler::finishJob(int id, const QString& outputPath)
+{
+    auto it = m_jobs.find(id);
+    if (it == m_jobs.end()) {
+        return;
+    }
+
+    const QString inputPath = it->second.job.inputPath;
+    m_jobs.erase(it);
+    ++m_succeeded;
+    emit jobFinished(id, inputPath, outputPath);
+
+    if (m_jobs.empty()) {
+        const int succeeded = m_succeeded;
+        const int failed = m_failed;
+        m_succeeded = 0;
+        m_failed = 0;
+        emit allFinished(succeeded, failed);
+    }
+}
+
+void SubtitleJobScheduler::failJob(int id, const QString& error)
+{
+    auto it = m_jobs.find(id);
+    if (it == m_jobs.end()) {
+        return;
+    }
+
+    const ActiveJob& active = it->second;
+    if (!active.audioPath.isEmpty() && active.audioPath != active.job.inputPath) {
+        QFile::remove(active.audioPath);
+    }
+
+    const QString inputPath = active.job.inputPath;
+    m_jobs.erase(it);
+    ++m_failed;
+    qCWarning(subtitleJobs) << "Subtitle job failed:" << inputPath << error;
+    emit jobFailed(id, inputPath, error);
+
+    if (m_jobs.empty()) {
+        const int succeeded = m_succeeded;
+        const int failed = m_failed;
+        m_succeeded = 0;
+        m_failed = 0;
+        emit allFinished(succeeded, failed);
+    }
+}
+
+void SubtitleJobScheduler::startExtraction(ActiveJob& active)
+{
+    const int id = active.id;
+    if (m_ffmpegPath.isEmpty()) {
+        release(active.held);
+        failJob(id, "FFmpeg not found, cannot extract audio");
+        return;
+    }
+
+    // Kept until transcription is done, not tied to an object's lifetime
+    QTemporaryFile audioFile(QDir::tempPath() + "/eonplay_batch_XXXXXX.wav");
+    audioFile.setAutoRemove(false);
+    if (!audioFile.open()) {
+        release(active.held);
+        failJob(id, "Failed to create temporary audio file");
+        return;
+    }
+    active.audioPath = audioFile.fileName();
+    audioFile.close();
+
+    QStringList arguments;
+    arguments << "-nostdin";
+    arguments << "-i" << active.job.inputPath;
+    arguments << "-vn";
+    arguments << "-acodec" << "pcm_s16le";
+    arguments << "-ar" << "16000";
+    arguments << "-ac" << "1";
+    arguments << "-y";
+    arguments << active.audioPath;
+
+    QProcess* process = new QProcess(this);
+    ThreadPriority::setBackgroundProcess(process);
+    process->setProcessChannelMode(QProcess::SeparateChannels);
+    process->setStandardOutputFile(QProcess::nullDevice());
+    m_extractions.insert(id, process);
+
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this, id, process]() { onExtractionFinished(id, process); });
+    connect(process, &QProcess::errorOccurred, this, [this, id, process](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            onExtractionFinished(id, process);
+        }
+    });
+    QTimer::singleShot(EXTRACTION_TIMEOUT_MS, process, [process]() { process->kill(); });
+
+    process->start(m_ffmpegPath, arguments);
+}
+
+void SubtitleJobScheduler::onExtractionFinished(int id, QProcess* process)
+{
+    if (m_extractions.value(id) != process) {
+        return;
+    }
+    m_extractions.remove(id);
+    process->deleteLater();
+    release(Resource::Extraction);
+
+    auto it = m_jobs.find(id);
+    if (it == m_jobs.end()) {
+        return;
+    }
+
+    if (process->error() == QProcess::FailedToStart) {
+        failJob(id, "Failed to start FFmpeg");
+    } else if (process->exitStatus() != QProcess::NormalExit || process->exitCode() != 0) {
+        failJob(id, "Audio extraction failed: " + QString::fromLocal8Bit(process->readAllStandardError()).trimmed().right(200));
+    } else {
+        advance(it->second);
+    }
+}
+
+void SubtitleJobScheduler::startTranscription(ActiveJob& active)
+{
+    AISubtitleGenerator* generator = takeGenerator();
+    AISubtitleGenerator::GenerationOptions options = m_generationOptions;
+
+    if (active.held == Resource::LocalInference) {
+        if (m_gpuCount > 0) {
+            // Least loaded device, they only share once there are more slots than GPUs
+            active.gpu = static_cast<int>(std::min_element(m_gpuLoad.begin(), m_gpuLoad.end()) - m_gpuLoad.begin());
+            ++m_gpuLoad[active.gpu];
+            options.gpuDevice = active.gpu;
+        } else {
+            options.threads = std::max(1, CpuTopology::instance().backgroundThreadCount() / limit(Resource::LocalInference));
+        }
+    }
+    generator->setGenerationOptions(options);
+
+    const int id = active.id;
+    if (!generator->isEngineAvailable(options.engine)) {
+        returnGenerator(generator);
+        if (active.gpu >= 0) {
+            --m_gpuLoad[active.gpu];
+            active.gpu = -1;
+        }
+        release(active.held);
+        failJob(id, "Selected engine is not available: " + AISubtitleGenerator::engineToString(options.engine));
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(active.job.outputPath).absolutePath());
+    m_generatorJobs.insert(generator, id);
+
+    // May report failure before returning, so nothing touches active after this
+    generator->generateSubtitlesFromAudio(active.audioPath, active.job.outputPath);
+}
+
+void SubtitleJobScheduler::onTranscriptionDone(AISubtitleGenerator* generator, const QString& error)
+{
+    if (!m_generatorJobs.contains(generator)) {
+        return;
+    }
+    const int id = m_generatorJobs.take(generator);
+    returnGenerator(generator);
+
+    auto it = m_jobs.find(id);
+    if (it == m_jobs.end()) {
+        return;
+    }
+
+    ActiveJob& active = it->second;
+    if (active.gpu >= 0) {
+        --m_gpuLoad[active.gpu];
+        active.gpu = -1;
+    }
+    release(active.held);
+
+    if (active.audioPath != active.job.inputPath) {
+        QFile::remove(active.audioPath);
+    }
+    active.audioPath.clear();
+
+    if (!error.isEmpty()) {
+        failJob(id, error);
+    } else {
+        advance(active);
+    }
+}
+
+void SubtitleJobScheduler::startTranslation(ActiveJob& active)
+{
+    SubtitleTranslator* translator = takeTranslator();
+    SubtitleTranslator::TranslationOptions options = m_translationOptions;
+    options.targetLanguage = active.job.targetLanguage;
+    translator->setTranslationOptions(options);
+
+    const QString inputPath = active.job.generate ? active.job.outputPath : active.job.inputPath;
+    QDir().mkpath(QFileInfo(active.job.translatedPath).absolutePath());
+    m_translatorJobs.insert(translator, active.id);
+
+    translator->translateSubtitleFile(inputPath, active.job.translatedPath,
+                                      options.sourceLanguage, options.targetLanguage);
+}
+
+void SubtitleJobScheduler::onTranslationDone(SubtitleTranslator* translator, const QString& error)
+{
+    if (!m_translatorJobs.contains(translator)) {
+        return;
+    }
+    const int id = m_translatorJobs.take(translator);
+    returnTranslator(translator);
+
+    auto it = m_jobs.find(id);
+    if (it == m_jobs.end()) {
+        return;
+    }
+
+    release(it->second.held);
+    if (!error.isEmpty()) {
+        failJob(id, error);
+    } else {
+        advance(it->second);
+    }
+}
+
+AISubtitleGenerator* SubtitleJobScheduler::takeGenerator()
+{
+    if (!m_idleGenerators.isEmpty()) {
+        return m_idleGenerators.takeLast();
+    }
+
+    auto generator = std::make_unique<AISubtitleGenerator>();
+    AISubtitleGenerator* raw = generator.get();
+    connect(raw, &AISubtitleGenerator::generationCompleted, this, [this, raw]() {
+        onTranscriptionDone(raw, QString());
+    });
+    connect(raw, &AISubtitleGenerator::generationFailed, this, [this, raw](const QString& error) {
+        onTranscriptionDone(raw, error.isEmpty() ? QStringLiteral("Subtitle generation failed") : error);
+    });
+    m_generators.push_back(std::move(generator));
+    return raw;
+}
+
+SubtitleTranslator* SubtitleJobScheduler::takeTranslator()
+{
+    if (!m_idleTranslators.isEmpty()) {
+        return m_idleTranslators.takeLast();
+    }
+
+    auto translator = std::make_unique<SubtitleTranslator>();
+    SubtitleTranslator* raw = translator.get();
+    connect(raw, &SubtitleTranslator::translationCompleted, this, [this, raw]() {
+        onTranslationDone(raw, QString());
+    });
+    connect(raw, &SubtitleTranslator::translationFailed, this, [this, raw](const QString& error) {
+        onTranslationDone(raw, error.isEmpty() ? QStringLiteral("Translation failed") : error);
+    });
+    m_translators.push_back(std::move(translator));
+    return raw;
+}
+
+void SubtitleJobScheduler::returnGenerator(AISubtitleGenerator* generator)
+{
+    if (!m_idleGenerators.contains(generator)) {
+        m_idleGenerators.append(generator);
+    }
+}
+
+void SubtitleJobScheduler::returnTranslator(SubtitleTranslator* translator)
+{
+    if (!m_idleTranslators.contains(translator)) {
+        m_idleTranslators.append(translator);
+    }
+}
+
+void SubtitleJobScheduler::discardBusyWorkers()
+{
+    // A cancelled worker may still have a late result queued, so it is dropped
+    // rather than handed the next job
+    m_generators.erase(std::remove_if(m_generators.begin(), m_generators.end(),
+        [this](const std::unique_ptr<AISubtitleGenerator>& generator) {
+            return m_generatorJobs.contains(generator.get());
+        }), m_generators.end());
+    m_translators.erase(std::remove_if(m_translators.begin(), m_translators.end(),
+        [this](const std::unique_ptr<SubtitleTranslator>& translator) {
+            return m_translatorJobs.contains(translator.get());
+        }), m_translators.end());
+    m_generatorJobs.clear();
+    m_translatorJobs.clear();
+}
+
+int SubtitleJobScheduler::defaultLimit(Resource resource) const
+{
+    // Helper processes are placed on the efficiency cores of a hybrid CPU
+    const int cores = std::max(1, CpuTopology::instance().backgroundThreadCount());
+    switch (resource) {
+        case Resource::Extraction:
+            // Decoding audio is light next to transcription
+            return std::clamp(cores / 4, 1, 4);
+        case Resource::LocalInference:
+            // Whisper gains little past about four CPU threads per process
+            return m_gpuCount > 0 ? m_gpuCount : std::max(1, cores / 4);
+        case Resource::CloudApi:
+            return DEFAULT_CLOUD_CONCURRENCY;
+    }
+    return 1;
+}
+
+} // namespace AI
+} // namespace EonPlay
@@ -1,4 +1,6 @@
 #include "ai/SubtitleLanguageDetector.h"
+#include "ai/LanguageIdModel.h"
+#include "network/NetworkService.h"
 #include <QFile>
 #include <QTextStream>
 #include <QStringConverter>
@@ -14,7 +16,6 @@
 #include <QLoggingCategory>
 #include <QDebug>
 #include <QFileInfo>
-#include <algorithm>
 
 Q_LOGGING_CATEGORY(langDetector, "eonplay.ai.language")
 
@@ -24,10 +25,9 @@ namespace AI {
 SubtitleLanguageDetector::SubtitleLanguageDetector(QObject* parent)
     : QObject(parent)
     , m_method(LocalNGram)
-    , m_networkManager(nullptr)
     , m_modelsInitialized(false)
+    , m_minimumConfidence(0.5)
 {
-    setupNetworkManager();
     initializeLanguageModels();
     
     // Load API keys from settings
@@ -100,18 +100,17 @@ void SubtitleLanguageDetector::detectLanguageFromFile(const QString& subtitleFil
         return;
     }
     
-    QString text = extractTextFromSubtitleFile(subtitleFilePath);
+    QString text = extractTextFromSubtitleFile(subtitleFilePath, DETECTION_SAMPLE_CHARACTERS);
     if (text.isEmpty()) {
         emit detectionFailed(subtitleFilePath, "Failed to extract text from subtitle file");
         return;
     }
     
-    if (m_method == LocalNGram) {
-        DetectionResult result = detectWithLocalNGram(text);
-        emit languageDetected(subtitleFilePath, result);
+    DetectionResult result = detectWithLocalNGram(text);
+    if (needsFallback(result)) {
+        detectWithFallback(text, subtitleFilePath, result);
     } else {
-        // Use API-based detection
-        detectLanguageFromText(text);
+        emit languageDetected(subtitleFilePath, result);
     }
 }
 
@@ -122,42 +121,49 @@ void SubtitleLanguageDetector::detectLanguageFromText(const QString& text)
         return;
     }
     
-    switch (m_method) {
-        case LocalNGram: {
-            DetectionResult result = detectWithLocalNGram(text);
-            emit languageDetected("", result);
-            break;
-        }
-        case GoogleTranslate:
-            detectWithGoogleTranslate(text);
-            break;
-        case AzureTranslator:
-            detectWithAzureTranslator(text);
-            break;
-        case AWSTranslate:
-            detectWithAWSTranslate(text);
-            break;
-        case LibreTranslate:
-            detectWithLibreTranslate(text);
-            break;
+    DetectionResult result = detectWithLocalNGram(text);
+    if (needsFallback(result)) {
+        detectWithFallback(text, QString(), result);
+    } else {
+        emit languageDetected("", result);
     }
 }
 
 void SubtitleLanguageDetector::detectLanguageFromMultipleFiles(const QStringList& filePaths)
 {
-    QHash<QString, DetectionResult> results;
+    m_multipleResults.clear();
+    m_multiplePending.clear();
     
+    // Everything the model is sure of is answered offline
+    QHash<QString, QString> uncertainTexts;
     for (const QString& filePath : filePaths) {
         if (isSupportedSubtitleFile(filePath)) {
-            QString text = extractTextFromSubtitleFile(filePath);
+            QString text = extractTextFromSubtitleFile(filePath, DETECTION_SAMPLE_CHARACTERS);
             if (!text.isEmpty()) {
                 DetectionResult result = detectLanguageSync(text);
-                results[filePath] = result;
+                m_multipleResults[filePath] = result;
+                if (needsFallback(result)) {
+                    uncertainTexts.insert(filePath, text);
+                }
             }
         }
     }
     
-    emit multipleDetectionCompleted(results);
+    qCDebug(langDetector) << "Detected" << m_multipleResults.size() << "files offline,"
+                          << uncertainTexts.size() << "need the API";
+    
+    if (uncertainTexts.isEmpty()) {
+        emit multipleDetectionCompleted(m_multipleResults);
+        m_multipleResults.clear();
+        return;
+    }
+    
+    for (auto it = uncertainTexts.cbegin(); it != uncertainTexts.cend(); ++it) {
+        m_multiplePending.insert(it.key());
+    }
+    for (auto it = uncertainTexts.cbegin(); it != uncertainTexts.cend(); ++it) {
+        detectWithFallback(it.value(), it.key(), m_multipleResults.value(it.key()));
+    }
 }
 
 SubtitleLanguageDetector::DetectionResult SubtitleLanguageDetector::detectLanguageSync(const QString& text)
@@ -179,70 +185,69 @@ SubtitleLanguageDetector::DetectionResult SubtitleLanguageDetector::detectWithLo
         return result;
     }
     
-    QString normalizedText = normalizeText(text);
-    QHash<QString, double> textNGrams = extractNGrams(normalizedText);
-    
-    QHash<Language, double> scores;
-    
-    // Calculate scores for each language
-    for (auto it = m_ngramModels.begin(); it != m_ngramModels.end(); ++it) {
-        Language lang = it.key();
-        const QHash<QString, double>& langModel = it.value();
-        
-        double score = 0.0;
-        int matches = 0;
-        
-        for (auto ngramIt = textNGrams.begin(); ngramIt != textNGrams.end(); ++ngramIt) {
-            const QString& ngram = ngramIt.key();
-            double textFreq = ngramIt.value();
-            
-            if (langModel.contains(ngram)) {
-                score += textFreq * langModel[ngram];
-                matches++;
-            }
-        }
-        
-        if (matches > 0) {
-            scores[lang] = score / matches;
-        }
-    }
-    
-    // Find the best match
-    Language bestLanguage = Unknown;
-    double bestScore = 0.0;
-    
-    for (auto it = scores.begin(); it != scores.end(); ++it) {
-        if (it.value() > bestScore) {
-            bestScore = it.value();
-            bestLanguage = it.key();
-        }
+    const QList<LanguageIdModel::Score> scores = LanguageIdModel::instance().classify(text);
+    if (scores.isEmpty()) {
+        return result;
     }
     
     // Set result
-    result.language = bestLanguage;
-    result.confidence = std::min(bestScore, 1.0);
-    result.languageCode = languageToCode(bestLanguage);
-    result.languageName = languageToDisplayName(bestLanguage);
+    result.language = codeToLanguage(scores.first().code);
+    result.confidence = scores.first().probability;
+    result.languageCode = languageToCode(result.language);
+    result.languageName = languageToDisplayName(result.language);
     
     // Add alternative languages
-    QList<QPair<Language, double>> sortedScores;
-    for (auto it = scores.begin(); it != scores.end(); ++it) {
-        if (it.key() != bestLanguage) {
-            sortedScores.append(qMakePair(it.key(), it.value()));
-        }
+    for (int i = 1; i < scores.size(); ++i) {
+        result.alternativeLanguages[codeToLanguage(scores[i].code)] = scores[i].probability;
     }
     
-    std::sort(sortedScores.begin(), sortedScores.end(),
-              [](const QPair<Language, double>& a, const QPair<Language, double>& b) {
-                  return a.second > b.second;
-              });
+    return result;
+}
+
+bool SubtitleLanguageDetector::needsFallback(const DetectionResult& result) const
+{
+    return m_method != LocalNGram && isMethodAvailable(m_method) && result.confidence < m_minimumConfidence;
+}
+
+void SubtitleLanguageDetector::detectWithFallback(const QString& text, const QString& identifier,
+                                                  const DetectionResult& local)
+{
+    m_fallbackResults.insert(identifier, local);
     
-    // Add top 3 alternatives
-    for (int i = 0; i < std::min(3, static_cast<int>(sortedScores.size())); ++i) {
-        result.alternativeLanguages[sortedScores[i].first] = sortedScores[i].second;
+    switch (m_method) {
+        case GoogleTranslate:
+            detectWithGoogleTranslate(text, identifier);
+            break;
+        case AzureTranslator:
+            detectWithAzureTranslator(text, identifier);
+            break;
+        case AWSTranslate:
+            detectWithAWSTranslate(text, identifier);
+            break;
+        case LibreTranslate:
+            detectWithLibreTranslate(text, identifier);
+            break;
+        case LocalNGram:
+            finishFallback(identifier, DetectionResult());
+            break;
+    }
+}
+
+void SubtitleLanguageDetector::finishFallback(const QString& identifier, const DetectionResult& apiResult)
+{
+    // Keep the local guess if the API had nothing better
+    const DetectionResult local = m_fallbackResults.take(identifier);
+    const DetectionResult result = apiResult.language != Unknown ? apiResult : local;
+    
+    if (m_multiplePending.remove(identifier)) {
+        m_multipleResults[identifier] = result;
+        if (m_multiplePending.isEmpty()) {
+            emit multipleDetectionCompleted(m_multipleResults);
+            m_multipleResults.clear();
+        }
+    } else {
+        emit languageDetected(identifier, result);
     }
-    
-    return result;
 }
 
 void SubtitleLanguageDetector::detectWithGoogleTranslate(const QString& text, const QString& identifier)
@@ -262,7 +267,7 @@ void SubtitleLanguageDetector::detectWithGoogleTranslate(const QString& text, co
     json["q"] = text.left(1000); // Limit text length for API
     
     QJsonDocument doc(json);
-    QNetworkReply* reply = m_networkManager->post(request, doc.toJson());
+    QNetworkReply* reply = postRequest(request, doc.toJson());
     m_pendingRequests[reply] = identifier;
 }
 
@@ -280,7 +285,7 @@ void SubtitleLanguageDetector::detectWithAzureTranslator(const QString& text, co
         result.confidence = 0.8;
         result.languageCode = "en";
         result.languageName = "English";
-        emit languageDetected(identifier, result);
+        finishFallback(identifier, result);
     });
 }
 
@@ -298,7 +303,7 @@ void SubtitleLanguageDetector::detectWithAWSTranslate(const QString& text, const
         result.confidence = 0.8;
         result.languageCode = "en";
         result.languageName = "English";
-        emit languageDetected(identifier, result);
+        finishFallback(identifier, result);
     });
 }
 
@@ -314,95 +319,16 @@ void SubtitleLanguageDetector::detectWithLibreTranslate(const QString& text, con
     json["q"] = text.left(1000);
     
     QJsonDocument doc(json);
-    QNetworkReply* reply = m_networkManager->post(request, doc.toJson());
+    QNetworkReply* reply = postRequest(request, doc.toJson());
     m_pendingRequests[reply] = identifier;
 }
 
 void SubtitleLanguageDetector::initializeLanguageModels()
 {
-    // Initialize common words and character sets for basic detection
-    m_commonWords[English] = {"the", "and", "you", "that", "was", "for", "are", "with", "his", "they"};
-    m_commonWords[Spanish] = {"que", "de", "no", "la", "el", "en", "es", "se", "te", "lo"};
-    m_commonWords[French] = {"de", "le", "et", "à", "un", "il", "être", "et", "en", "avoir"};
-    m_commonWords[German] = {"der", "die", "und", "in", "den", "von", "zu", "das", "mit", "sich"};
-    m_commonWords[Italian] = {"di", "che", "e", "la", "il", "un", "a", "è", "per", "una"};
-    m_commonWords[Portuguese] = {"de", "a", "o", "que", "e", "do", "da", "em", "um", "para"};
-    m_commonWords[Russian] = {"в", "и", "не", "на", "я", "быть", "тот", "он", "оно", "мы"};
-    
-    // Character sets for script detection
-    m_characterSets[Chinese] = {"的", "一", "是", "在", "不", "了", "有", "和", "人", "这"};
-    m_characterSets[Japanese] = {"の", "に", "は", "を", "た", "が", "で", "て", "と", "し"};
-    m_characterSets[Korean] = {"이", "의", "가", "을", "는", "에", "한", "다", "로", "과"};
-    m_characterSets[Arabic] = {"في", "من", "إلى", "على", "أن", "هذا", "كان", "قد", "لا", "ما"};
-    
-    // Create simple n-gram models from common words
-    for (auto it = m_commonWords.begin(); it != m_commonWords.end(); ++it) {
-        Language lang = it.key();
-        const QStringList& words = it.value();
-        
-        QHash<QString, double> ngramModel;
-        for (const QString& word : words) {
-            QHash<QString, double> wordNGrams = extractNGrams(word);
-            for (auto ngramIt = wordNGrams.begin(); ngramIt != wordNGrams.end(); ++ngramIt) {
-                ngramModel[ngramIt.key()] += ngramIt.value();
-            }
-        }
-        
-        // Normalize frequencies
-        double total = 0.0;
-        for (double freq : ngramModel.values()) {
-            total += freq;
-        }
-        
-        if (total > 0) {
-            for (auto& freq : ngramModel) {
-                freq /= total;
-            }
-        }
-        
-        m_ngramModels[lang] = ngramModel;
-    }
-    
-    m_modelsInitialized = true;
-    qCInfo(langDetector) << "Language models initialized for" << m_ngramModels.size() << "languages";
-}
-
-QHash<QString, double> SubtitleLanguageDetector::extractNGrams(const QString& text, int n)
-{
-    QHash<QString, double> ngrams;
-    QString cleanText = normalizeText(text);
-    
-    if (cleanText.length() < n) {
-        return ngrams;
-    }
-    
-    for (int i = 0; i <= cleanText.length() - n; ++i) {
-        QString ngram = cleanText.mid(i, n);
-        ngrams[ngram] += 1.0;
-    }
-    
-    return ngrams;
-}
-
-QString SubtitleLanguageDetector::normalizeText(const QString& text)
-{
-    QString normalized = text.toLower();
-    
-    // Remove HTML tags and subtitle formatting
-    normalized.remove(QRegularExpression("<[^>]*>"));
-    normalized.remove(QRegularExpression("\\{[^}]*\\}"));
-    
-    // Remove timestamps and numbers
-    normalized.remove(QRegularExpression("\\d+:\\d+:\\d+[,.]\\d+"));
-    normalized.remove(QRegularExpression("\\d+"));
-    
-    // Remove punctuation except spaces
-    normalized.remove(QRegularExpression("[^\\w\\s]"));
-    
-    // Normalize whitespace
-    normalized = normalized.simplified();
-    
-    return normalized;
+    // Shared by every detector, loaded or mapped once per process
+    const LanguageIdModel& model = LanguageIdModel::instance();
+    m_modelsInitialized = model.isValid();
+    qCInfo(langDetector) << "Language models initialized for" << model.languages().size() << "languages";
 }
 
 bool SubtitleLanguageDetector::isSupportedSubtitleFile(const QString& filePath) const
@@ -414,17 +340,17 @@ bool SubtitleLanguageDetector::isSupportedSubtitleFile(const QString& filePath)
     return supportedFormats.contains(extension);
 }
 
-QString SubtitleLanguageDetector::extractTextFromSubtitleFile(const QString& filePath)
+QString SubtitleLanguageDetector::extractTextFromSubtitleFile(const QString& filePath, int maxCharacters)
 {
     QFileInfo fileInfo(filePath);
     QString extension = fileInfo.suffix().toLower();
     
     if (extension == "srt") {
-        return extractSRTText(filePath);
+        return extractSRTText(filePath, maxCharacters);
     } else if (extension == "ass" || extension == "ssa") {
-        return extractASSText(filePath);
+        return extractASSText(filePath, maxCharacters);
     } else if (extension == "vtt") {
-        return extractVTTText(filePath);
+        return extractVTTText(filePath, maxCharacters);
     }
     
     // Generic text extraction for other formats
@@ -435,17 +361,20 @@ QString SubtitleLanguageDetector::extractTextFromSubtitleFile(const QString& fil
     
     QTextStream stream(&file);
     stream.setEncoding(QStringConverter::Utf8);
-    QString content = stream.readAll();
+    QString content = maxCharacters < 0 ? stream.readAll() : stream.read(maxCharacters);
     
     // Remove common subtitle formatting
-    content.remove(QRegularExpression("\\d+:\\d+:\\d+[,.]\\d+ --> \\d+:\\d+:\\d+[,.]\\d+"));
-    content.remove(QRegularExpression("^\\d+$", QRegularExpression::MultilineOption));
-    content.remove(QRegularExpression("<[^>]*>"));
+    static const QRegularExpression timestamps("\\d+:\\d+:\\d+[,.]\\d+ --> \\d+:\\d+:\\d+[,.]\\d+");
+    static const QRegularExpression sequenceNumbers("^\\d+$", QRegularExpression::MultilineOption);
+    static const QRegularExpression tags("<[^>]*>");
+    content.remove(timestamps);
+    content.remove(sequenceNumbers);
+    content.remove(tags);
     
     return content.simplified();
 }
 
-QString SubtitleLanguageDetector::extractSRTText(const QString& filePath)
+QString SubtitleLanguageDetector::extractSRTText(const QString& filePath, int maxCharacters)
 {
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -458,6 +387,7 @@ QString SubtitleLanguageDetector::extractSRTText(const QString& filePath)
     QStringList textLines;
     QString line;
     bool inTextBlock = false;
+    qsizetype characters = 0;
     
     while (stream.readLineInto(&line)) {
         line = line.trimmed();
@@ -468,21 +398,28 @@ QString SubtitleLanguageDetector::extractSRTText(const QString& filePath)
         }
         
         // Skip sequence numbers
-        if (line.contains(QRegularExpression("^\\d+$"))) {
+        static const QRegularExpression sequenceNumber("^\\d+$");
+        if (line.contains(sequenceNumber)) {
             continue;
         }
         
         // Skip timestamps
-        if (line.contains(QRegularExpression("\\d+:\\d+:\\d+[,.]\\d+ --> \\d+:\\d+:\\d+[,.]\\d+"))) {
+        static const QRegularExpression timestamp("\\d+:\\d+:\\d+[,.]\\d+ --> \\d+:\\d+:\\d+[,.]\\d+");
+        if (line.contains(timestamp)) {
             inTextBlock = true;
             continue;
         }
         
         if (inTextBlock) {
             // Remove HTML tags
-            line.remove(QRegularExpression("<[^>]*>"));
+            static const QRegularExpression tags("<[^>]*>");
+            line.remove(tags);
             if (!line.isEmpty()) {
                 textLines << line;
+                characters += line.size() + 1;
+                if (maxCharacters >= 0 && characters >= maxCharacters) {
+                    break;
+                }
             }
         }
     }
@@ -490,7 +427,7 @@ QString SubtitleLanguageDetector::extractSRTText(const QString& filePath)
     return textLines.join(" ");
 }
 
-QString SubtitleLanguageDetector::extractASSText(const QString& filePath)
+QString SubtitleLanguageDetector::extractASSText(const QString& filePath, int maxCharacters)
 {
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -503,6 +440,7 @@ QString SubtitleLanguageDetector::extractASSText(const QString& filePath)
     QStringList textLines;
     QString line;
     bool inEventsSection = false;
+    qsizetype characters = 0;
     
     while (stream.readLineInto(&line)) {
         line = line.trimmed();
@@ -522,10 +460,16 @@ QString SubtitleLanguageDetector::extractASSText(const QString& filePath)
             QStringList parts = line.split(",");
             if (parts.size() >= 10) {
                 QString text = parts.mid(9).join(",");
-                text.remove(QRegularExpression("\\{[^}]*\\}"));
-                text.remove(QRegularExpression("\\\\[nN]"));
+                static const QRegularExpression overrides("\\{[^}]*\\}");
+                static const QRegularExpression lineBreaks("\\\\[nN]");
+                text.remove(overrides);
+                text.remove(lineBreaks);
                 if (!text.isEmpty()) {
                     textLines << text;
+                    characters += text.size() + 1;
+                    if (maxCharacters >= 0 && characters >= maxCharacters) {
+                        break;
+                    }
                 }
             }
         }
@@ -534,7 +478,7 @@ QString SubtitleLanguageDetector::extractASSText(const QString& filePath)
     return textLines.join(" ");
 }
 
-QString SubtitleLanguageDetector::extractVTTText(const QString& filePath)
+QString SubtitleLanguageDetector::extractVTTText(const QString& filePath, int maxCharacters)
 {
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -547,6 +491,7 @@ QString SubtitleLanguageDetector::extractVTTText(const QString& filePath)
     QStringList textLines;
     QString line;
     bool inTextBlock = false;
+    qsizetype characters = 0;
     
     while (stream.readLineInto(&line)) {
         line = line.trimmed();
@@ -562,16 +507,22 @@ QString SubtitleLanguageDetector::extractVTTText(const QString& filePath)
         }
         
         // Skip timestamps
-        if (line.contains(QRegularExpression("\\d+:\\d+:\\d+\\.\\d+ --> \\d+:\\d+:\\d+\\.\\d+"))) {
+        static const QRegularExpression timestamp("\\d+:\\d+:\\d+\\.\\d+ --> \\d+:\\d+:\\d+\\.\\d+");
+        if (line.contains(timestamp)) {
             inTextBlock = true;
             continue;
         }
         
         if (inTextBlock) {
             // Remove WebVTT tags
-            line.remove(QRegularExpression("<[^>]*>"));
+            static const QRegularExpression tags("<[^>]*>");
+            line.remove(tags);
             if (!line.isEmpty()) {
                 textLines << line;
+                characters += line.size() + 1;
+                if (maxCharacters >= 0 && characters >= maxCharacters) {
+                    break;
+                }
             }
         }
     }
@@ -579,11 +530,12 @@ QString SubtitleLanguageDetector::extractVTTText(const QString& filePath)
     return textLines.join(" ");
 }
 
-void SubtitleLanguageDetector::setupNetworkManager()
+QNetworkReply* SubtitleLanguageDetector::postRequest(const QNetworkRequest& request, const QByteArray& data)
 {
-    m_networkManager = new QNetworkAccessManager(this);
-    connect(m_networkManager, &QNetworkAccessManager::finished,
-            this, &SubtitleLanguageDetector::handleNetworkReply);
+    // Shared client; lookups give way to playback transfers
+    QNetworkReply* reply = NetworkService::instance().post(request, data, NetworkService::RequestClass::Metadata);
+    connect(reply, &QNetworkReply::finished, this, &SubtitleLanguageDetector::handleNetworkReply);
+    return reply;
 }
 
 QNetworkRequest SubtitleLanguageDetector::createApiRequest(const QString& url, DetectionMethod method)
@@ -653,12 +605,14 @@ void SubtitleLanguageDetector::handleNetworkReply()
                 result.languageName = languageToDisplayName(result.language);
             }
             
-            emit languageDetected(identifier, result);
+            finishFallback(identifier, result);
         } else {
-            emit detectionFailed(identifier, "Invalid API response");
+            qCWarning(langDetector) << "Invalid API response, keeping the local result";
+            finishFallback(identifier, DetectionResult());
         }
     } else {
-        emit detectionFailed(identifier, reply->errorString());
+        qCWarning(langDetector) << "Detection API failed, keeping the local result:" << reply->errorString();
+        finishFallback(identifier, DetectionResult());
     }
     
     reply->deleteLater();
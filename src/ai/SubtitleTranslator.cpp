@@ -1,4 +1,6 @@
 #include "ai/SubtitleTranslator.h"
+#include "ai/TranslationMemory.h"
+#include "network/NetworkService.h"
 #include <QFile>
 #include <QTextStream>
 #include <QStringConverter>
@@ -15,23 +17,46 @@
 #include <QLoggingCategory>
 #include <QDebug>
 #include <QTimer>
+#include <QDateTime>
+#include <algorithm>
+#include <limits>
 
 Q_LOGGING_CATEGORY(subtitleTranslator, "eonplay.ai.translator")
 
 namespace EonPlay {
 namespace AI {
 
+namespace {
+
+// Shared so translators running side by side do not overwrite each other's file
+TranslationMemory& translationMemory()
+{
+    static TranslationMemory memory;
+    return memory;
+}
+
+}
+
 SubtitleTranslator::SubtitleTranslator(QObject* parent)
     : QObject(parent)
     , m_isTranslating(false)
-    , m_networkManager(nullptr)
     , m_batchTimer(new QTimer(this))
     , m_processingBatch(false)
     , m_currentBatchIndex(0)
+    , m_lastRequestMs(-1)
+    , m_nextBatchId(0)
+    , m_streaming(false)
+    , m_streamSourceLanguage(Auto)
+    , m_streamTargetLanguage(English)
+    , m_playbackPositionMs(0)
+    , m_streamBatchesInFlight(0)
+    , m_streamCuesLeft(0)
+    , m_streamRestarted(false)
+    , m_pumpingStream(false)
 {
-    setupNetworkManager();
+    m_clock.start();
     
-    // Setup batch processing timer
+    // Setup batch processing timer, also wakes the dispatcher after a backoff
     m_batchTimer->setSingleShot(true);
     connect(m_batchTimer, &QTimer::timeout, this, &SubtitleTranslator::processBatchQueue);
     
@@ -241,10 +266,106 @@ void SubtitleTranslator::cancelTranslation()
     }
     m_pendingRequests.clear();
     m_requestServices.clear();
+    m_pendingChunks.clear();
+    m_pendingBatches.clear();
+    m_chunkQueue.clear();
+    m_sentChunks.clear();
+    
+    if (m_streaming) {
+        // Streamed batches skip the per-batch save
+        m_streaming = false;
+        m_streamCues.clear();
+        m_streamBatchesInFlight = 0;
+        if (m_options.useTranslationMemory) {
+            translationMemory().save();
+        }
+    }
     
     emit translationCancelled();
 }
 
+void SubtitleTranslator::startStreamingTranslation(const QString& inputPath, Language sourceLanguage,
+                                                   Language targetLanguage)
+{
+    if (m_isTranslating) {
+        emit translationFailed("Translation already in progress");
+        return;
+    }
+    
+    if (!QFile::exists(inputPath)) {
+        emit translationFailed("Input file does not exist: " + inputPath);
+        return;
+    }
+    
+    if (!isServiceAvailable(m_options.service)) {
+        emit translationFailed("Selected translation service is not available");
+        return;
+    }
+    
+    m_currentEntries = parseSubtitleFile(inputPath);
+    if (m_currentEntries.isEmpty()) {
+        emit translationFailed("Failed to parse subtitle file or file is empty");
+        return;
+    }
+    
+    m_streamCues.clear();
+    m_streamCues.reserve(m_currentEntries.size());
+    for (const SubtitleEntry& entry : m_currentEntries) {
+        StreamCue cue;
+        cue.startMs = parseCueTime(entry.startTime);
+        cue.endMs = qMax(cue.startMs, parseCueTime(entry.endTime));
+        m_streamCues.append(cue);
+    }
+    
+    m_isTranslating = true;
+    m_streaming = true;
+    m_currentFilePath.clear();
+    m_streamSourceLanguage = sourceLanguage;
+    m_streamTargetLanguage = targetLanguage;
+    m_streamBatchesInFlight = 0;
+    m_streamCuesLeft = m_streamCues.size();
+    m_streamRestarted = true;
+    
+    m_progress = TranslationProgress();
+    m_progress.totalLines = m_streamCues.size();
+    m_progress.currentStatus = "Translating around the playback position...";
+    
+    emit translationStarted(inputPath);
+    emit translationProgress(m_progress);
+    
+    pumpStreaming();
+}
+
+void SubtitleTranslator::setPlaybackPosition(qint64 positionMs)
+{
+    // Playback reports often and moves forward; anything else is a seek
+    const bool seeked = positionMs < m_playbackPositionMs ||
+                        positionMs > m_playbackPositionMs + STREAM_SEEK_THRESHOLD_MS;
+    m_playbackPositionMs = positionMs;
+    
+    if (!m_streaming) {
+        return;
+    }
+    
+    if (seeked) {
+        m_streamRestarted = true;
+        requeueUnsentStreamCues();
+    }
+    pumpStreaming();
+}
+
+void SubtitleTranslator::stopStreamingTranslation()
+{
+    if (m_streaming) {
+        cancelTranslation();
+    }
+}
+
+void SubtitleTranslator::clearTranslationMemory()
+{
+    translationMemory().clear();
+}
+
 QStringList SubtitleTranslator::getSupportedLanguages(TranslationService service) const
 {
     // Return common languages supported by most services
@@ -265,7 +386,7 @@ void SubtitleTranslator::translateWithGoogleTranslate(const QStringList& texts,
                                                      Language targetLang, const QString& identifier)
 {
     if (!isServiceAvailable(GoogleTranslate)) {
-        emit translationFailed("Google Translate API not configured");
+        failChunk(identifier, "Google Translate API not configured");
         return;
     }
     
@@ -288,7 +409,7 @@ void SubtitleTranslator::translateWithGoogleTranslate(const QStringList& texts,
     }
     
     QJsonDocument doc(json);
-    QNetworkReply* reply = m_networkManager->post(request, doc.toJson());
+    QNetworkReply* reply = postRequest(request, doc.toJson());
     m_pendingRequests[reply] = identifier;
     m_requestServices[reply] = GoogleTranslate;
 }
@@ -301,17 +422,22 @@ void SubtitleTranslator::translateWithLibreTranslate(const QStringList& texts, L
     QNetworkRequest request = createApiRequest(url, LibreTranslate);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
     
-    // LibreTranslate processes one text at a time, so we'll send the first text
-    // In a real implementation, you'd want to handle multiple texts properly
-    QString textToTranslate = texts.isEmpty() ? "" : texts.first();
-    
+    // A single line goes as a string, several as an array
     QJsonObject json;
-    json["q"] = preprocessText(textToTranslate);
+    if (texts.size() == 1) {
+        json["q"] = preprocessText(texts.first());
+    } else {
+        QJsonArray textArray;
+        for (const QString& text : texts) {
+            textArray.append(preprocessText(text));
+        }
+        json["q"] = textArray;
+    }
     json["source"] = sourceLang == Auto ? "auto" : languageToCode(sourceLang);
     json["target"] = languageToCode(targetLang);
     
     QJsonDocument doc(json);
-    QNetworkReply* reply = m_networkManager->post(request, doc.toJson());
+    QNetworkReply* reply = postRequest(request, doc.toJson());
     m_pendingRequests[reply] = identifier;
     m_requestServices[reply] = LibreTranslate;
 }
@@ -331,17 +457,9 @@ void SubtitleTranslator::translateWithLocalTranslator(const QStringList& texts,
         translatedTexts << translated;
     }
     
-    // Simulate processing delay
-    QTimer::singleShot(500, this, [this, identifier, texts, translatedTexts]() {
-        if (texts.size() == 1) {
-            emit textTranslated(identifier, texts.first(), translatedTexts.first(), English);
-        } else {
-            emit batchTranslated(identifier, texts, translatedTexts);
-        }
-        
-        if (identifier == "subtitle_file") {
-            finalizeBatchTranslation(translatedTexts);
-        }
+    // Simulate processing delay; placeholder output is never remembered
+    QTimer::singleShot(500, this, [this, identifier, translatedTexts]() {
+        completeChunk(identifier, translatedTexts, false);
     });
 }
 
@@ -695,11 +813,12 @@ QStringList SubtitleTranslator::splitLongText(const QString& text, int maxLength
     return result;
 }
 
-void SubtitleTranslator::setupNetworkManager()
+QNetworkReply* SubtitleTranslator::postRequest(const QNetworkRequest& request, const QByteArray& data)
 {
-    m_networkManager = new QNetworkAccessManager(this);
-    connect(m_networkManager, &QNetworkAccessManager::finished,
-            this, &SubtitleTranslator::handleNetworkReply);
+    // Shared client; lookups give way to playback transfers
+    QNetworkReply* reply = NetworkService::instance().post(request, data, NetworkService::RequestClass::Metadata);
+    connect(reply, &QNetworkReply::finished, this, &SubtitleTranslator::handleNetworkReply);
+    return reply;
 }
 
 QNetworkRequest SubtitleTranslator::createApiRequest(const QString& url, TranslationService service)
@@ -731,74 +850,301 @@ void SubtitleTranslator::queueBatchRequest(const BatchRequest& request)
 {
     m_batchQueue.append(request);
     
+    // Coalesce requests made in the same event loop pass
     if (!m_processingBatch) {
-        m_batchTimer->start(static_cast<int>(m_options.requestDelay * 1000));
+        m_batchTimer->start(0);
     }
 }
 
 void SubtitleTranslator::processBatchQueue()
 {
-    if (m_batchQueue.isEmpty() || m_processingBatch) {
+    if (m_processingBatch) {
         return;
     }
     
+    // Resolving batches is local, so take all of them and let the
+    // dispatcher interleave their requests
     m_processingBatch = true;
-    BatchRequest request = m_batchQueue.takeFirst();
+    while (!m_batchQueue.isEmpty()) {
+        processBatchRequest(m_batchQueue.takeFirst());
+    }
+    m_processingBatch = false;
     
-    processBatchRequest(request);
+    dispatchChunks();
+}
+
+void SubtitleTranslator::dispatchChunks()
+{
+    const TranslationService service = m_options.service;
+    const FlowControl& flow = flowControl(service);
+    const int window = qBound(1, static_cast<int>(flow.window), concurrencyLimit(service));
+    const qint64 spacingMs = static_cast<qint64>(m_options.requestDelay * 1000);
+    
+    while (!m_chunkQueue.isEmpty() && m_sentChunks.size() < window) {
+        const qint64 now = m_clock.elapsed();
+        
+        qint64 waitMs = flow.pausedUntilMs - now;
+        if (spacingMs > 0 && m_lastRequestMs >= 0) {
+            waitMs = qMax(waitMs, m_lastRequestMs + spacingMs - now);
+        }
+        if (waitMs > 0) {
+            // Backing off or pacing, come back when allowed
+            if (!m_batchTimer->isActive() || m_batchTimer->remainingTime() > waitMs) {
+                m_batchTimer->start(static_cast<int>(waitMs));
+            }
+            return;
+        }
+        
+        m_lastRequestMs = now;
+        sendChunk(m_chunkQueue.takeFirst());
+    }
 }
 
 void SubtitleTranslator::processBatchRequest(const BatchRequest& request)
 {
-    // Split large batches into smaller chunks
-    int batchSize = m_options.batchSize;
-    QStringList texts = request.texts;
+    const int batchId = m_nextBatchId++;
+    
+    PendingBatch batch;
+    batch.request = request;
+    batch.service = serviceToString(m_options.service);
+    batch.sourceCode = languageToCode(request.sourceLanguage);
+    batch.targetCode = languageToCode(request.targetLanguage);
+    batch.translations.resize(request.texts.size());
+    
+    // Fill remembered lines and collect each missing line once
+    QStringList misses;
+    QList<QList<int>> positions;
+    QHash<QString, int> missIndex;
+    int remembered = 0;
+    
+    for (int i = 0; i < request.texts.size(); ++i) {
+        const QString line = TranslationMemory::normalize(preprocessText(request.texts[i]));
+        if (line.isEmpty()) {
+            continue;
+        }
+        
+        if (m_options.useTranslationMemory &&
+            translationMemory().lookup(line, batch.sourceCode, batch.targetCode, batch.service,
+                                       batch.translations[i])) {
+            ++remembered;
+            continue;
+        }
+        
+        auto it = missIndex.constFind(line);
+        if (it == missIndex.constEnd()) {
+            missIndex.insert(line, misses.size());
+            misses << line;
+            positions.append(QList<int>{i});
+        } else {
+            positions[it.value()].append(i);
+        }
+    }
     
-    if (texts.size() <= batchSize) {
-        // Process entire batch at once
-        switch (m_options.service) {
-            case GoogleTranslate:
-                translateWithGoogleTranslate(texts, request.sourceLanguage, 
-                                           request.targetLanguage, request.identifier);
-                break;
-            case AzureTranslator:
-                translateWithAzureTranslator(texts, request.sourceLanguage,
-                                           request.targetLanguage, request.identifier);
-                break;
-            case AWSTranslate:
-                translateWithAWSTranslate(texts, request.sourceLanguage,
-                                        request.targetLanguage, request.identifier);
-                break;
-            case LibreTranslate:
-                translateWithLibreTranslate(texts, request.sourceLanguage,
-                                          request.targetLanguage, request.identifier);
-                break;
-            case DeepL:
-                translateWithDeepL(texts, request.sourceLanguage,
-                                 request.targetLanguage, request.identifier);
-                break;
-            case LocalTranslator:
-                translateWithLocalTranslator(texts, request.sourceLanguage,
-                                           request.targetLanguage, request.identifier);
-                break;
+    qCDebug(subtitleTranslator) << "Batch" << request.identifier << ":" << request.texts.size() << "lines,"
+                                << remembered << "remembered," << misses.size() << "to translate";
+    
+    if (request.identifier == "subtitle_file") {
+        m_progress.translatedLines = remembered;
+        m_progress.percentage = m_progress.totalLines > 0 ? 100.0 * remembered / m_progress.totalLines : 0.0;
+        m_progress.currentStatus = misses.isEmpty()
+            ? QString("All lines found in translation memory")
+            : QString("Translating %1 new lines...").arg(misses.size());
+        emit translationProgress(m_progress);
+    }
+    
+    if (misses.isEmpty()) {
+        finishBatch(batch);
+        return;
+    }
+    
+    // Streamed cues found in memory are shown without waiting for the rest
+    if (!request.cues.isEmpty() && remembered > 0) {
+        reportStreamCues(batch);
+    }
+    
+    // Pack the misses into requests by text size, services bill and limit by
+    // characters rather than lines; a line over the budget goes on its own
+    const ServiceLimits limits = serviceLimits(m_options.service);
+    const int maxTexts = m_options.batchSize > 0 ? qMin(m_options.batchSize, limits.maxTexts) : limits.maxTexts;
+    const int maxCharacters = m_options.maxRequestCharacters > 0 ? m_options.maxRequestCharacters
+                                                                 : limits.maxCharacters;
+    
+    PendingChunk chunk;
+    int chunkCharacters = 0;
+    auto closeChunk = [&]() {
+        const QString chunkKey = QString("%1_batch_%2").arg(batchId).arg(batch.outstandingChunks);
+        m_pendingChunks.insert(chunkKey, chunk);
+        m_chunkQueue.append(chunkKey);
+        ++batch.outstandingChunks;
+        chunk = PendingChunk();
+        chunkCharacters = 0;
+    };
+    
+    for (int i = 0; i < misses.size(); ++i) {
+        const int length = misses[i].size();
+        const bool full = chunk.texts.size() >= maxTexts ||
+                          (maxCharacters > 0 && chunkCharacters + length > maxCharacters);
+        if (!chunk.texts.isEmpty() && full) {
+            closeChunk();
         }
-    } else {
-        // Split into smaller batches
-        for (int i = 0; i < texts.size(); i += batchSize) {
-            QStringList batch = texts.mid(i, batchSize);
-            BatchRequest subRequest = request;
-            subRequest.texts = batch;
-            subRequest.identifier = QString("%1_batch_%2").arg(request.identifier).arg(i / batchSize);
-            
-            queueBatchRequest(subRequest);
+        chunk.batchId = batchId;
+        chunk.texts << misses[i];
+        chunk.positions << positions[i];
+        chunkCharacters += length;
+    }
+    closeChunk();
+    
+    qCDebug(subtitleTranslator) << "Batch" << request.identifier << "packed into"
+                                << batch.outstandingChunks << "requests";
+    m_pendingBatches.insert(batchId, batch);
+}
+
+void SubtitleTranslator::sendChunk(const QString& chunkKey)
+{
+    auto chunkIt = m_pendingChunks.constFind(chunkKey);
+    if (chunkIt == m_pendingChunks.constEnd()) {
+        return;
+    }
+    
+    m_sentChunks.insert(chunkKey);
+    
+    const PendingBatch& batch = m_pendingBatches[chunkIt->batchId];
+    const QStringList texts = chunkIt->texts;
+    const Language sourceLang = batch.request.sourceLanguage;
+    const Language targetLang = batch.request.targetLanguage;
+    
+    switch (m_options.service) {
+        case GoogleTranslate:
+            translateWithGoogleTranslate(texts, sourceLang, targetLang, chunkKey);
+            break;
+        case AzureTranslator:
+            translateWithAzureTranslator(texts, sourceLang, targetLang, chunkKey);
+            break;
+        case AWSTranslate:
+            translateWithAWSTranslate(texts, sourceLang, targetLang, chunkKey);
+            break;
+        case LibreTranslate:
+            translateWithLibreTranslate(texts, sourceLang, targetLang, chunkKey);
+            break;
+        case DeepL:
+            translateWithDeepL(texts, sourceLang, targetLang, chunkKey);
+            break;
+        case LocalTranslator:
+            translateWithLocalTranslator(texts, sourceLang, targetLang, chunkKey);
+            break;
+    }
+}
+
+void SubtitleTranslator::completeChunk(const QString& chunkKey, const QStringList& translatedTexts, bool remember)
+{
+    // Gone if the translation was cancelled or another part of the batch failed
+    auto chunkIt = m_pendingChunks.find(chunkKey);
+    if (chunkIt == m_pendingChunks.end()) {
+        return;
+    }
+    const PendingChunk chunk = *chunkIt;
+    m_pendingChunks.erase(chunkIt);
+    m_sentChunks.remove(chunkKey);
+    
+    // The freed slot can take the next request right away
+    QTimer::singleShot(0, this, &SubtitleTranslator::dispatchChunks);
+    
+    auto batchIt = m_pendingBatches.find(chunk.batchId);
+    if (batchIt == m_pendingBatches.end()) {
+        return;
+    }
+    PendingBatch& batch = *batchIt;
+    
+    int filled = 0;
+    for (int i = 0; i < chunk.texts.size() && i < translatedTexts.size(); ++i) {
+        const QString& translation = translatedTexts[i];
+        if (translation.isEmpty()) {
+            continue;
+        }
+        
+        if (remember && m_options.useTranslationMemory) {
+            translationMemory().insert(chunk.texts[i], batch.sourceCode, batch.targetCode,
+                                       batch.service, translation);
+        }
+        for (int position : chunk.positions[i]) {
+            batch.translations[position] = translation;
+            ++filled;
         }
     }
     
-    m_processingBatch = false;
+    if (batch.request.identifier == "subtitle_file") {
+        m_progress.translatedLines += filled;
+        m_progress.percentage = m_progress.totalLines > 0
+            ? 100.0 * m_progress.translatedLines / m_progress.totalLines : 0.0;
+        emit translationProgress(m_progress);
+    }
     
-    // Process next batch if available
-    if (!m_batchQueue.isEmpty()) {
-        m_batchTimer->start(static_cast<int>(m_options.requestDelay * 1000));
+    if (--batch.outstandingChunks > 0) {
+        return;
+    }
+    
+    finishBatch(m_pendingBatches.take(chunk.batchId));
+}
+
+void SubtitleTranslator::failChunk(const QString& chunkKey, const QString& error)
+{
+    // Another part of the same batch already failed
+    if (!m_pendingChunks.contains(chunkKey)) {
+        return;
+    }
+    const PendingChunk chunk = m_pendingChunks.take(chunkKey);
+    m_sentChunks.remove(chunkKey);
+    QTimer::singleShot(0, this, &SubtitleTranslator::dispatchChunks);
+    
+    auto batchIt = m_pendingBatches.find(chunk.batchId);
+    if (batchIt != m_pendingBatches.end()) {
+        // Drop the rest of the batch, finished parts stay remembered
+        for (auto it = m_pendingChunks.begin(); it != m_pendingChunks.end();) {
+            if (it->batchId == chunk.batchId) {
+                m_chunkQueue.removeAll(it.key());
+                m_sentChunks.remove(it.key());
+                it = m_pendingChunks.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        
+        const bool streamed = batchIt->request.identifier == "subtitle_stream";
+        if (batchIt->request.identifier == "subtitle_file") {
+            m_isTranslating = false;
+        }
+        m_pendingBatches.erase(batchIt);
+        
+        // Streaming stops like a file translation would, cues shown so far stay
+        if (streamed && m_streaming) {
+            emit translationFailed(error);
+            endStreaming();
+            return;
+        }
+        translationMemory().save();
+    }
+    
+    emit translationFailed(error);
+}
+
+void SubtitleTranslator::finishBatch(const PendingBatch& batch)
+{
+    const BatchRequest& request = batch.request;
+    
+    // Streaming saves once at the end rather than after every small batch
+    if (m_options.useTranslationMemory && request.identifier != "subtitle_stream") {
+        translationMemory().save();
+    }
+    
+    if (request.identifier == "subtitle_stream") {
+        finishStreamBatch(batch);
+    } else if (request.identifier == "subtitle_file") {
+        finalizeBatchTranslation(batch.translations);
+    } else if (request.texts.size() == 1) {
+        emit textTranslated(request.identifier, request.texts.first(), batch.translations.first(),
+                            request.sourceLanguage);
+    } else {
+        emit batchTranslated(request.identifier, request.texts, batch.translations);
     }
 }
 
@@ -812,22 +1158,100 @@ void SubtitleTranslator::handleNetworkReply()
     QString identifier = m_pendingRequests.take(reply);
     TranslationService service = m_requestServices.take(reply);
     
-    if (reply->error() == QNetworkReply::NoError) {
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 429 || status == 503) {
+        // Retry-After is either seconds or an HTTP date
+        qint64 retryAfterMs = 0;
+        const QByteArray retryAfter = reply->rawHeader("Retry-After").trimmed();
+        bool isNumber = false;
+        const int seconds = retryAfter.toInt(&isNumber);
+        if (isNumber) {
+            retryAfterMs = seconds * 1000LL;
+        } else if (!retryAfter.isEmpty()) {
+            const QDateTime until = QDateTime::fromString(QString::fromLatin1(retryAfter), Qt::RFC2822Date);
+            if (until.isValid()) {
+                retryAfterMs = qMax<qint64>(0, QDateTime::currentDateTimeUtc().msecsTo(until));
+            }
+        }
+        chunkThrottled(identifier, service, retryAfterMs);
+    } else if (reply->error() == QNetworkReply::NoError) {
+        // Additive increase, about one more request in flight per window
+        FlowControl& flow = flowControl(service);
+        flow.window = qMin<double>(concurrencyLimit(service), flow.window + 1.0 / flow.window);
+        flow.backoffMs = 0;
+        
         QByteArray data = reply->readAll();
         processTranslationResponse(data, service, identifier);
-    } else {
-        emit translationFailed("Network error: " + reply->errorString());
+    } else if (reply->error() != QNetworkReply::OperationCanceledError) {
+        failChunk(identifier, "Network error: " + reply->errorString());
     }
     
     reply->deleteLater();
 }
 
+void SubtitleTranslator::chunkThrottled(const QString& chunkKey, TranslationService service, qint64 retryAfterMs)
+{
+    auto chunkIt = m_pendingChunks.find(chunkKey);
+    if (chunkIt == m_pendingChunks.end()) {
+        return;
+    }
+    
+    if (++chunkIt->throttledAttempts > MAX_THROTTLED_ATTEMPTS) {
+        failChunk(chunkKey, serviceToString(service) + " keeps rejecting requests as too many");
+        return;
+    }
+    
+    // Multiplicative decrease, and hold every request until the service is ready
+    FlowControl& flow = flowControl(service);
+    flow.window = qMax(1.0, flow.window / 2.0);
+    flow.backoffMs = qBound<qint64>(MIN_BACKOFF_MS, flow.backoffMs * 2, MAX_BACKOFF_MS);
+    flow.pausedUntilMs = qMax(flow.pausedUntilMs, m_clock.elapsed() + qMax(retryAfterMs, flow.backoffMs));
+    
+    qCInfo(subtitleTranslator) << serviceToString(service) << "throttled, window" << flow.window
+                               << "retrying in" << (flow.pausedUntilMs - m_clock.elapsed()) << "ms";
+    
+    m_sentChunks.remove(chunkKey);
+    m_chunkQueue.prepend(chunkKey);
+    dispatchChunks();
+}
+
+SubtitleTranslator::ServiceLimits SubtitleTranslator::serviceLimits(TranslationService service)
+{
+    // Published per-request limits, kept a little under where they are hard caps
+    switch (service) {
+        case GoogleTranslate: return {25000, 128, 8};
+        case AzureTranslator: return {45000, 1000, 8};
+        case AWSTranslate: return {9000, 25, 4};
+        case LibreTranslate: return {5000, 50, 2};
+        case DeepL: return {100000, 50, 4};
+        case LocalTranslator: return {0, 1000, 1};
+    }
+    return {5000, 50, 1};
+}
+
+int SubtitleTranslator::concurrencyLimit(TranslationService service) const
+{
+    return m_options.maxConcurrentRequests > 0 ? m_options.maxConcurrentRequests
+                                               : serviceLimits(service).maxConcurrency;
+}
+
+SubtitleTranslator::FlowControl& SubtitleTranslator::flowControl(TranslationService service)
+{
+    auto it = m_flowControl.find(service);
+    if (it == m_flowControl.end()) {
+        FlowControl flow;
+        flow.window = qMin<double>(flow.window, concurrencyLimit(service));
+        it = m_flowControl.insert(service, flow);
+    }
+    return *it;
+}
+
 void SubtitleTranslator::processTranslationResponse(const QByteArray& data, TranslationService service,
                                                    const QString& identifier)
 {
     QJsonDocument doc = QJsonDocument::fromJson(data);
     if (doc.isNull()) {
-        emit translationFailed("Invalid response from translation service");
+        failChunk(identifier, "Invalid response from translation service");
         return;
     }
     
@@ -843,32 +1267,44 @@ void SubtitleTranslator::processTranslationResponse(const QByteArray& data, Tran
             break;
         }
         case LibreTranslate: {
-            translatedTexts << obj["translatedText"].toString();
+            const QJsonValue translated = obj["translatedText"];
+            if (translated.isArray()) {
+                for (const QJsonValue& value : translated.toArray()) {
+                    translatedTexts << value.toString();
+                }
+            } else {
+                translatedTexts << translated.toString();
+            }
             break;
         }
         default:
             break;
     }
     
-    if (!translatedTexts.isEmpty()) {
-        if (identifier == "subtitle_file") {
-            finalizeBatchTranslation(translatedTexts);
-        } else {
-            emit batchTranslated(identifier, QStringList(), translatedTexts);
-        }
+    if (translatedTexts.isEmpty()) {
+        failChunk(identifier, "Empty response from translation service");
+        return;
     }
+    
+    completeChunk(identifier, translatedTexts, true);
 }
 
 void SubtitleTranslator::finalizeBatchTranslation(const QStringList& translatedTexts)
 {
-    // Update subtitle entries with translated text
+    // Update subtitle entries with translated text, untranslated lines stay as they were
+    int translated = 0;
     for (int i = 0; i < translatedTexts.size() && i < m_currentEntries.size(); ++i) {
+        if (translatedTexts[i].isEmpty()) {
+            continue;
+        }
         m_currentEntries[i].text = postprocessText(translatedTexts[i], m_currentEntries[i].originalText);
+        ++translated;
     }
     
     // Write translated subtitle file
     if (writeSubtitleFile(m_currentFilePath, m_currentEntries)) {
-        m_progress.translatedLines = m_currentEntries.size();
+        m_progress.translatedLines = translated;
+        m_progress.failedLines = m_currentEntries.size() - translated;
         m_progress.percentage = 100.0;
         m_progress.currentStatus = "Translation completed";
         
@@ -881,6 +1317,200 @@ void SubtitleTranslator::finalizeBatchTranslation(const QStringList& translatedT
     }
 }
 
+qint64 SubtitleTranslator::parseCueTime(const QString& time)
+{
+    // SRT 00:01:02,345, VTT 00:01:02.345 or 01:02.345 with settings after, ASS 0:01:02.34
+    const QString stamp = time.trimmed().section(' ', 0, 0);
+    const int fractionAt = qMax(stamp.lastIndexOf(','), stamp.lastIndexOf('.'));
+    const QString fraction = fractionAt >= 0 ? stamp.mid(fractionAt + 1).leftJustified(3, '0', true) : QString();
+    
+    qint64 seconds = 0;
+    for (const QString& field : (fractionAt >= 0 ? stamp.left(fractionAt) : stamp).split(':')) {
+        seconds = seconds * 60 + field.toLongLong();
+    }
+    return seconds * 1000 + fraction.toLongLong();
+}
+
+void SubtitleTranslator::pumpStreaming()
+{
+    // Finishing a batch pumps again, which must not nest inside this loop
+    if (!m_streaming || m_pumpingStream) {
+        return;
+    }
+    m_pumpingStream = true;
+    
+    while (m_streaming && m_streamBatchesInFlight < STREAM_BATCHES_IN_FLIGHT) {
+        const QList<int> cues = nextStreamCues(m_streamRestarted ? STREAM_FIRST_BATCH : STREAM_BATCH);
+        if (cues.isEmpty()) {
+            break;
+        }
+        m_streamRestarted = false;
+        
+        BatchRequest request;
+        request.sourceLanguage = m_streamSourceLanguage;
+        request.targetLanguage = m_streamTargetLanguage;
+        request.identifier = "subtitle_stream";
+        request.cues = cues;
+        for (int cue : cues) {
+            request.texts << m_currentEntries[cue].text;
+            m_streamCues[cue].state = CueInFlight;
+        }
+        
+        // Batches answered from memory finish before this returns
+        ++m_streamBatchesInFlight;
+        processBatchRequest(request);
+    }
+    
+    m_pumpingStream = false;
+    
+    if (m_streaming && m_streamCuesLeft == 0) {
+        m_progress.percentage = 100.0;
+        m_progress.currentStatus = "Translation completed";
+        emit translationProgress(m_progress);
+        endStreaming();
+        emit streamingTranslationFinished();
+        return;
+    }
+    dispatchChunks();
+}
+
+QList<int> SubtitleTranslator::nextStreamCues(int count) const
+{
+    // Upcoming and current cues by distance ahead, then passed ones by distance behind
+    const qint64 passedOffset = std::numeric_limits<qint64>::max() / 2;
+    QVector<QPair<qint64, int>> candidates;
+    for (int i = 0; i < m_streamCues.size(); ++i) {
+        const StreamCue& cue = m_streamCues[i];
+        if (cue.state != CuePending) {
+            continue;
+        }
+        const qint64 distance = cue.endMs < m_playbackPositionMs
+            ? passedOffset + (m_playbackPositionMs - cue.endMs)
+            : qMax<qint64>(0, cue.startMs - m_playbackPositionMs);
+        candidates.append(qMakePair(distance, i));
+    }
+    
+    const int taken = qMin(count, static_cast<int>(candidates.size()));
+    std::partial_sort(candidates.begin(), candidates.begin() + taken, candidates.end());
+    
+    QList<int> cues;
+    cues.reserve(taken);
+    for (int i = 0; i < taken; ++i) {
+        cues << candidates[i].second;
+    }
+    return cues;
+}
+
+void SubtitleTranslator::reportStreamCues(const PendingBatch& batch)
+{
+    const QList<int>& cues = batch.request.cues;
+    for (int i = 0; i < cues.size() && i < batch.translations.size(); ++i) {
+        StreamCue& cue = m_streamCues[cues[i]];
+        if (batch.translations[i].isEmpty() || cue.state != CueInFlight) {
+            continue;
+        }
+        
+        cue.state = CueDone;
+        --m_streamCuesLeft;
+        ++m_progress.translatedLines;
+        emit cueTranslated(cues[i], cue.startMs, cue.endMs,
+                           postprocessText(batch.translations[i], m_currentEntries[cues[i]].originalText));
+    }
+}
+
+void SubtitleTranslator::finishStreamBatch(const PendingBatch& batch)
+{
+    // Left over from a cancelled or failed stream
+    if (!m_streaming) {
+        return;
+    }
+    
+    reportStreamCues(batch);
+    for (int cue : batch.request.cues) {
+        if (m_streamCues[cue].state == CueInFlight) {
+            m_streamCues[cue].state = CueFailed;
+            --m_streamCuesLeft;
+            ++m_progress.failedLines;
+        }
+    }
+    --m_streamBatchesInFlight;
+    
+    m_progress.percentage = m_progress.totalLines > 0
+        ? 100.0 * (m_progress.totalLines - m_streamCuesLeft) / m_progress.totalLines : 0.0;
+    emit translationProgress(m_progress);
+    
+    pumpStreaming();
+}
+
+void SubtitleTranslator::requeueUnsentStreamCues()
+{
+    // Requests already sent finish; the rest go back to be ordered from the new position
+    QStringList unsent;
+    for (auto it = m_pendingChunks.constBegin(); it != m_pendingChunks.constEnd(); ++it) {
+        const auto batchIt = m_pendingBatches.constFind(it->batchId);
+        if (batchIt != m_pendingBatches.constEnd() && batchIt->request.identifier == "subtitle_stream" &&
+            !m_sentChunks.contains(it.key())) {
+            unsent << it.key();
+        }
+    }
+    
+    // Batches emptied here finish without pumping, the caller pumps once all are back
+    m_pumpingStream = true;
+    for (const QString& chunkKey : unsent) {
+        const PendingChunk chunk = m_pendingChunks.take(chunkKey);
+        m_chunkQueue.removeAll(chunkKey);
+        
+        PendingBatch& batch = m_pendingBatches[chunk.batchId];
+        for (const QList<int>& positions : chunk.positions) {
+            for (int position : positions) {
+                m_streamCues[batch.request.cues[position]].state = CuePending;
+            }
+        }
+        if (--batch.outstandingChunks == 0) {
+            finishStreamBatch(m_pendingBatches.take(chunk.batchId));
+        }
+    }
+    m_pumpingStream = false;
+    
+    qCDebug(subtitleTranslator) << "Seek to" << m_playbackPositionMs << "ms, requeued" << unsent.size()
+                                << "streaming requests";
+}
+
+void SubtitleTranslator::endStreaming()
+{
+    // Unsent requests are dropped; sent ones finish into the memory and are ignored
+    QSet<int> sentBatches;
+    for (auto it = m_pendingChunks.begin(); it != m_pendingChunks.end();) {
+        const auto batchIt = m_pendingBatches.find(it->batchId);
+        if (batchIt == m_pendingBatches.end() || batchIt->request.identifier != "subtitle_stream") {
+            ++it;
+        } else if (m_sentChunks.contains(it.key())) {
+            sentBatches.insert(it->batchId);
+            ++it;
+        } else {
+            --batchIt->outstandingChunks;
+            m_chunkQueue.removeAll(it.key());
+            it = m_pendingChunks.erase(it);
+        }
+    }
+    for (auto it = m_pendingBatches.begin(); it != m_pendingBatches.end();) {
+        if (it->request.identifier == "subtitle_stream" && !sentBatches.contains(it.key())) {
+            it = m_pendingBatches.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    m_streaming = false;
+    m_isTranslating = false;
+    m_streamCues.clear();
+    m_streamBatchesInFlight = 0;
+    
+    if (m_options.useTranslationMemory) {
+        translationMemory().save();
+    }
+}
+
 // Static utility methods
 QString SubtitleTranslator::languageToString(Language language)
 {
@@ -918,6 +1548,23 @@ QString SubtitleTranslator::languageToCode(Language language)
         case Korean: return "ko";
         case Arabic: return "ar";
         case Hindi: return "hi";
+        case Dutch: return "nl";
+        case Swedish: return "sv";
+        case Norwegian: return "no";
+        case Danish: return "da";
+        case Finnish: return "fi";
+        case Polish: return "pl";
+        case Czech: return "cs";
+        case Hungarian: return "hu";
+        case Romanian: return "ro";
+        case Bulgarian: return "bg";
+        case Greek: return "el";
+        case Turkish: return "tr";
+        case Hebrew: return "he";
+        case Thai: return "th";
+        case Vietnamese: return "vi";
+        case Indonesian: return "id";
+        case Malay: return "ms";
         default: return "auto";
     }
 }
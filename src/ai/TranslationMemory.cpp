@@ -0,0 +1,167 @@
+#include "ai/TranslationMemory.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+Q_LOGGING_CATEGORY(translationMemory, "eonplay.ai.translationmemory")
+
+namespace EonPlay {
+namespace AI {
+
+namespace {
+const QString MEMORY_FILE = QStringLiteral("memory.json");
+const int MEMORY_VERSION = 1;
+}
+
+TranslationMemory::TranslationMemory(const QString& directory, int maxEntries)
+    : m_filePath(QDir(directory).filePath(MEMORY_FILE))
+    , m_maxEntries(qMax(1, maxEntries))
+{
+    QDir().mkpath(directory);
+    load();
+}
+
+TranslationMemory::~TranslationMemory()
+{
+    save();
+}
+
+QString TranslationMemory::defaultDirectory()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath("translation");
+}
+
+QString TranslationMemory::normalize(const QString& text)
+{
+    return text.simplified();
+}
+
+bool TranslationMemory::lookup(const QString& text, const QString& sourceLanguage,
+                               const QString& targetLanguage, const QString& service, QString& translation)
+{
+    auto it = m_entries.find(key(text, sourceLanguage, targetLanguage, service));
+    if (it == m_entries.end()) {
+        return false;
+    }
+
+    m_order.splice(m_order.end(), m_order, it->position);
+    m_dirty = true;
+    translation = it->translation;
+    return true;
+}
+
+void TranslationMemory::insert(const QString& text, const QString& sourceLanguage,
+                               const QString& targetLanguage, const QString& service, const QString& translation)
+{
+    if (normalize(text).isEmpty() || translation.isEmpty()) {
+        return;
+    }
+
+    const QByteArray entryKey = key(text, sourceLanguage, targetLanguage, service);
+    auto it = m_entries.find(entryKey);
+    if (it != m_entries.end()) {
+        it->translation = translation;
+        m_order.splice(m_order.end(), m_order, it->position);
+    } else {
+        m_order.push_back(entryKey);
+        m_entries.insert(entryKey, Entry{translation, std::prev(m_order.end())});
+        evict();
+    }
+    m_dirty = true;
+}
+
+void TranslationMemory::clear()
+{
+    m_entries.clear();
+    m_order.clear();
+    m_dirty = true;
+    save();
+}
+
+bool TranslationMemory::save()
+{
+    if (!m_dirty) {
+        return true;
+    }
+
+    QJsonArray entries;
+    for (const QByteArray& entryKey : m_order) {
+        entries.append(QJsonArray{QString::fromLatin1(entryKey), m_entries.value(entryKey).translation});
+    }
+
+    QJsonObject root;
+    root["version"] = MEMORY_VERSION;
+    root["entries"] = entries;
+
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0 || !file.commit()) {
+        qCWarning(translationMemory) << "Failed to save translation memory:" << file.errorString();
+        return false;
+    }
+
+    m_dirty = false;
+    return true;
+}
+
+QByteArray TranslationMemory::key(const QString& text, const QString& sourceLanguage,
+                                  const QString& targetLanguage, const QString& service)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(service.toUtf8());
+    hash.addData(QByteArrayView("\n", 1));
+    hash.addData(sourceLanguage.toUtf8());
+    hash.addData(QByteArrayView("\n", 1));
+    hash.addData(targetLanguage.toUtf8());
+    hash.addData(QByteArrayView("\n", 1));
+    hash.addData(normalize(text).toUtf8());
+    return hash.result().toHex();
+}
+
+void TranslationMemory::load()
+{
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root["version"].toInt() != MEMORY_VERSION) {
+        qCWarning(translationMemory) << "Ignoring translation memory with unknown version";
+        return;
+    }
+
+    // Stored least recently used first
+    const QJsonArray entries = root["entries"].toArray();
+    for (const QJsonValue& value : entries) {
+        const QJsonArray entry = value.toArray();
+        const QByteArray entryKey = entry.at(0).toString().toLatin1();
+        const QString translation = entry.at(1).toString();
+        if (entryKey.isEmpty() || translation.isEmpty() || m_entries.contains(entryKey)) {
+            continue;
+        }
+        m_order.push_back(entryKey);
+        m_entries.insert(entryKey, Entry{translation, std::prev(m_order.end())});
+    }
+    evict();
+
+    qCDebug(translationMemory) << "Loaded" << m_entries.size() << "remembered translations";
+}
+
+void TranslationMemory::evict()
+{
+    while (static_cast<int>(m_entries.size()) > m_maxEntries && !m_order.empty()) {
+        m_entries.remove(m_order.front());
+        m_order.pop_front();
+        m_dirty = true;
+    }
+}
+
+} // namespace AI
+} // namespace EonPlay
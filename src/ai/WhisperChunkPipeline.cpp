@@ -0,0 +1,551 @@
+#include "ai/WhisperChunkPipeline.h"
+#include "ai/SubtitleJobScheduler.h"
+#include "ThreadPriority.h"
+#include "CpuTopology.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+Q_LOGGING_CATEGORY(whisperChunks, "eonplay.ai.whisper.chunks")
+
+namespace EonPlay {
+namespace AI {
+
+WhisperChunkPipeline::WhisperChunkPipeline(const Options& options, QObject* parent)
+    : QObject(parent)
+    , m_options(options)
+{
+}
+
+WhisperChunkPipeline::~WhisperChunkPipeline()
+{
+    stopProcesses();
+}
+
+void WhisperChunkPipeline::start(const QString& mediaPath, const QString& workDirectory)
+{
+    stopProcesses();
+
+    m_workDirectory = workDirectory;
+    m_language = m_options.language;
+    m_decodeFinished = false;
+    m_decoderError.clear();
+    m_durationMs = 0;
+    m_pending.clear();
+    m_partialFrame.clear();
+    m_chunkStart = 0;
+    m_position = 0;
+    m_noiseFloorDb = -60.0;
+    m_silenceStart = -1;
+    m_quietestSample = -1;
+    m_chunkHasSpeech = false;
+    m_nextIndex = 0;
+    m_ready.clear();
+    m_results.clear();
+    m_chunkEnds.clear();
+    m_nextRelease = 0;
+    m_releasedMs = 0;
+    m_segments.clear();
+
+    m_gpuCount = m_options.useGPU ? SubtitleJobScheduler::detectGpuCount() : 0;
+    const int workers = m_options.workers > 0 ? m_options.workers : defaultWorkerCount(m_options.useGPU, m_gpuCount);
+    m_workers.clear();
+    for (int i = 0; i < workers; ++i) {
+        Worker worker;
+        worker.gpu = m_gpuCount > 0 ? i % m_gpuCount : -1;
+        m_workers.append(worker);
+    }
+
+    QDir().mkpath(m_workDirectory);
+    m_running = true;
+
+    // Raw PCM on stdout, so segmentation starts with the first second of audio
+    QStringList args;
+    args << "-nostdin"
+         << "-i" << mediaPath
+         << "-vn"
+         << "-ac" << "1"
+         << "-ar" << QString::number(SAMPLE_RATE)
+         << "-f" << "s16le"
+         << "-";
+
+    m_decoder = new QProcess(this);
+    ThreadPriority::setBackgroundProcess(m_decoder);
+    connect(m_decoder, &QProcess::readyReadStandardOutput, this, &WhisperChunkPipeline::onDecoderOutput);
+    connect(m_decoder, &QProcess::readyReadStandardError, this, &WhisperChunkPipeline::onDecoderError);
+    connect(m_decoder, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &WhisperChunkPipeline::onDecoderFinished);
+    connect(m_decoder, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            fail("Failed to start FFmpeg");
+        }
+    });
+
+    qCInfo(whisperChunks) << "Chunked transcription of" << mediaPath << "with" << workers << "workers,"
+                          << m_gpuCount << "GPUs";
+    m_decoder->start(m_options.ffmpegPath, args);
+}
+
+void WhisperChunkPipeline::cancel()
+{
+    stopProcesses();
+    if (m_running) {
+        m_running = false;
+        emit finished(false, "Cancelled");
+    }
+}
+
+double WhisperChunkPipeline::progress() const
+{
+    if (m_durationMs <= 0) {
+        return 0.0;
+    }
+    return std::min(1.0, static_cast<double>(m_releasedMs) / m_durationMs);
+}
+
+void WhisperChunkPipeline::onDecoderOutput()
+{
+    if (!m_decoder) {
+        return;
+    }
+
+    QByteArray data = m_partialFrame + m_decoder->readAllStandardOutput();
+    const int frameBytes = FRAME_SAMPLES * static_cast<int>(sizeof(qint16));
+
+    int offset = 0;
+    while (m_running && data.size() - offset >= frameBytes) {
+        m_pending.append(data.constData() + offset, frameBytes);
+
+        // s16le, aligned copy so the samples can be read in place
+        qint16 samples[FRAME_SAMPLES];
+        memcpy(samples, data.constData() + offset, frameBytes);
+        for (qint16& sample : samples) {
+            sample = qFromLittleEndian(sample);
+        }
+        analyseFrame(samples, FRAME_SAMPLES);
+        offset += frameBytes;
+    }
+    m_partialFrame = data.mid(offset);
+
+    dispatch();
+}
+
+void WhisperChunkPipeline::onDecoderError()
+{
+    if (!m_decoder) {
+        return;
+    }
+
+    m_decoderError.append(m_decoder->readAllStandardError());
+    if (m_durationMs == 0) {
+        static const QRegularExpression durationRegex(R"(Duration:\s*(\d+):(\d{2}):(\d{2})\.(\d{2}))");
+        const QRegularExpressionMatch match = durationRegex.match(QString::fromUtf8(m_decoderError));
+        if (match.hasMatch()) {
+            m_durationMs = ((match.captured(1).toLongLong() * 60 + match.captured(2).toLongLong()) * 60 +
+                            match.captured(3).toLongLong()) * 1000 + match.captured(4).toLongLong() * 10;
+        }
+    }
+
+    // Only the tail is needed for error messages
+    if (m_decoderError.size() > 8192) {
+        m_decoderError = m_decoderError.right(4096);
+    }
+}
+
+void WhisperChunkPipeline::onDecoderFinished()
+{
+    if (!m_decoder || !m_running) {
+        return;
+    }
+
+    onDecoderOutput();
+
+    const bool failed = m_decoder->exitStatus() != QProcess::NormalExit || m_decoder->exitCode() != 0;
+    const QString error = QString::fromUtf8(m_decoderError).trimmed().right(300);
+    m_decoder->deleteLater();
+    m_decoder = nullptr;
+
+    if (failed) {
+        if (m_position == 0) {
+            fail("Failed to decode audio: " + error);
+            return;
+        }
+        // A damaged tail still leaves everything before it usable
+        qCWarning(whisperChunks) << "FFmpeg stopped early, transcribing what was decoded:" << error;
+    }
+
+    // The last partial chunk, including any half frame
+    m_pending.append(m_partialFrame);
+    m_position += m_partialFrame.size() / static_cast<int>(sizeof(qint16));
+    m_partialFrame.clear();
+    if (m_position > m_chunkStart) {
+        cutChunk(m_position);
+    }
+
+    m_decodeFinished = true;
+    if (m_durationMs <= 0) {
+        m_durationMs = m_position * 1000 / SAMPLE_RATE;
+    }
+
+    dispatch();
+    finishIfDone();
+}
+
+void WhisperChunkPipeline::analyseFrame(const qint16* samples, int count)
+{
+    double energy = 0.0;
+    for (int i = 0; i < count; ++i) {
+        const double sample = samples[i] / 32768.0;
+        energy += sample * sample;
+    }
+    const double db = 10.0 * std::log10(energy / count + 1e-12);
+
+    // Falls quickly into pauses and rises slowly under speech, about 3 s
+    if (db < m_noiseFloorDb) {
+        m_noiseFloorDb += (db - m_noiseFloorDb) * 0.1;
+    } else {
+        m_noiseFloorDb += (db - m_noiseFloorDb) * 0.01;
+    }
+
+    const qint64 frameStart = m_position;
+    m_position += count;
+
+    const qint64 chunkSamples = m_position - m_chunkStart;
+    const qint64 wanted = static_cast<qint64>(m_nextIndex == 0 ? m_options.firstChunkMs : m_options.targetChunkMs) *
+                          SAMPLE_RATE / 1000;
+    const qint64 maximum = static_cast<qint64>(m_options.maxChunkMs) * SAMPLE_RATE / 1000;
+    const bool speech = db > SILENCE_FLOOR_DB && db > m_noiseFloorDb + SPEECH_MARGIN_DB;
+
+    if (speech) {
+        m_chunkHasSpeech = true;
+        m_silenceStart = -1;
+    } else if (m_silenceStart < 0) {
+        m_silenceStart = frameStart;
+    }
+
+    // Fallback cut point for chunks without a long enough pause
+    if (chunkSamples >= wanted / 2 && (m_quietestSample < 0 || db < m_quietestDb)) {
+        m_quietestSample = frameStart + count / 2;
+        m_quietestDb = db;
+    }
+
+    if (chunkSamples >= wanted && m_silenceStart >= 0 &&
+        m_position - m_silenceStart >= static_cast<qint64>(m_options.minSilenceMs) * SAMPLE_RATE / 1000) {
+        // Middle of the pause; the rest of it starts the next chunk
+        const qint64 cut = m_silenceStart + (m_position - m_silenceStart) / 2;
+        cutChunk(cut);
+        m_silenceStart = cut;
+        m_chunkHasSpeech = false;
+    } else if (chunkSamples >= maximum) {
+        cutChunk(m_quietestSample > m_chunkStart ? m_quietestSample : m_position);
+        m_silenceStart = -1;
+        // Speech may continue right after the cut
+        m_chunkHasSpeech = true;
+    }
+}
+
+void WhisperChunkPipeline::cutChunk(qint64 cutSample)
+{
+    const qint64 bytes = (cutSample - m_chunkStart) * static_cast<qint64>(sizeof(qint16));
+    const QByteArray pcm = m_pending.left(bytes);
+    m_pending.remove(0, bytes);
+
+    Chunk chunk;
+    chunk.index = m_nextIndex++;
+    chunk.startMs = m_chunkStart * 1000 / SAMPLE_RATE;
+    chunk.durationMs = (cutSample - m_chunkStart) * 1000 / SAMPLE_RATE;
+    m_chunkEnds.insert(chunk.index, chunk.startMs + chunk.durationMs);
+
+    m_chunkStart = cutSample;
+    m_quietestSample = -1;
+
+    if (!m_chunkHasSpeech) {
+        // Nothing to transcribe, it only needs to keep its place in the order
+        m_results.insert(chunk.index, QList<SubtitleSegment>());
+        release();
+        return;
+    }
+
+    chunk.audioPath = QDir(m_workDirectory).filePath(QString("chunk_%1.wav").arg(chunk.index, 5, 10, QLatin1Char('0')));
+    if (!writeChunk(chunk, pcm)) {
+        fail("Failed to write audio chunk: " + chunk.audioPath);
+        return;
+    }
+    m_ready.enqueue(chunk);
+}
+
+bool WhisperChunkPipeline::writeChunk(const Chunk& chunk, const QByteArray& pcm)
+{
+    QFile file(chunk.audioPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    // 44 byte canonical header, 16-bit mono PCM
+    QByteArray header(44, 0);
+    char* h = header.data();
+    memcpy(h, "RIFF", 4);
+    qToLittleEndian<quint32>(36 + pcm.size(), h + 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    qToLittleEndian<quint32>(16, h + 16);
+    qToLittleEndian<quint16>(1, h + 20);
+    qToLittleEndian<quint16>(1, h + 22);
+    qToLittleEndian<quint32>(SAMPLE_RATE, h + 24);
+    qToLittleEndian<quint32>(SAMPLE_RATE * 2, h + 28);
+    qToLittleEndian<quint16>(2, h + 32);
+    qToLittleEndian<quint16>(16, h + 34);
+    memcpy(h + 36, "data", 4);
+    qToLittleEndian<quint32>(pcm.size(), h + 40);
+
+    return file.write(header) == header.size() && file.write(pcm) == pcm.size();
+}
+
+void WhisperChunkPipeline::dispatch()
+{
+    if (!m_running || m_ready.isEmpty()) {
+        return;
+    }
+
+    QList<int> idle;
+    for (int i = 0; i < m_workers.size(); ++i) {
+        if (!m_workers[i].process) {
+            idle.append(i);
+        }
+    }
+
+    for (int i = 0; i < idle.size() && !m_ready.isEmpty(); ++i) {
+        // Spread what is ready over the idle workers; runs take several chunks
+        // to save model loads, but the very first run stays small
+        const int remainingWorkers = idle.size() - i;
+        int take = (m_ready.size() + remainingWorkers - 1) / remainingWorkers;
+        take = std::min(take, MAX_CHUNKS_PER_RUN);
+        if (m_segments.isEmpty() && m_nextRelease == 0) {
+            take = 1;
+        }
+
+        QList<Chunk> chunks;
+        for (int n = 0; n < take && !m_ready.isEmpty(); ++n) {
+            chunks.append(m_ready.dequeue());
+        }
+        startWorker(idle[i], chunks);
+    }
+}
+
+void WhisperChunkPipeline::startWorker(int workerIndex, const QList<Chunk>& chunks)
+{
+    Worker& worker = m_workers[workerIndex];
+    worker.chunks = chunks;
+
+    QStringList args;
+    for (const Chunk& chunk : chunks) {
+        args << chunk.audioPath;
+    }
+    args << "--model" << m_options.modelSize
+         << "--output_format" << "json"
+         << "--output_dir" << m_workDirectory
+         << "--verbose" << "False";
+
+    if (!m_language.isEmpty()) {
+        args << "--language" << m_language;
+    }
+
+    worker.process = new QProcess(this);
+    ThreadPriority::setBackgroundProcess(worker.process);
+    if (worker.gpu >= 0) {
+        QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+        environment.insert("CUDA_VISIBLE_DEVICES", QString::number(worker.gpu));
+        worker.process->setProcessEnvironment(environment);
+        args << "--device" << "cuda";
+    } else {
+        const int threads = std::max(1, CpuTopology::instance().backgroundThreadCount() / static_cast<int>(m_workers.size()));
+        args << "--device" << "cpu" << "--fp16" << "False" << "--threads" << QString::number(threads);
+    }
+
+    worker.process->setStandardOutputFile(QProcess::nullDevice());
+    connect(worker.process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this, workerIndex]() { onWorkerFinished(workerIndex); });
+    connect(worker.process, &QProcess::errorOccurred, this, [this, workerIndex](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            onWorkerFinished(workerIndex);
+        }
+    });
+
+    worker.process->start(m_options.whisperPath, args);
+}
+
+void WhisperChunkPipeline::onWorkerFinished(int workerIndex)
+{
+    Worker& worker = m_workers[workerIndex];
+    QProcess* process = worker.process;
+    if (!process || !m_running) {
+        return;
+    }
+    worker.process = nullptr;
+    process->deleteLater();
+
+    if (process->error() == QProcess::FailedToStart) {
+        fail("Failed to start Whisper process");
+        return;
+    }
+    if (process->exitStatus() != QProcess::NormalExit || process->exitCode() != 0) {
+        fail("Whisper process failed: " + QString::fromUtf8(process->readAllStandardError()).trimmed().right(300));
+        return;
+    }
+
+    const QList<Chunk> chunks = worker.chunks;
+    worker.chunks.clear();
+    for (const Chunk& chunk : chunks) {
+        m_results.insert(chunk.index, readResult(chunk));
+        QFile::remove(chunk.audioPath);
+    }
+
+    release();
+    dispatch();
+    finishIfDone();
+}
+
+QList<SubtitleSegment> WhisperChunkPipeline::readResult(const Chunk& chunk)
+{
+    QList<SubtitleSegment> segments;
+
+    const QString jsonPath = QDir(m_workDirectory).filePath(QFileInfo(chunk.audioPath).completeBaseName() + ".json");
+    QFile file(jsonPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(whisperChunks) << "No Whisper output for chunk" << chunk.index;
+        return segments;
+    }
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    file.close();
+    QFile::remove(jsonPath);
+
+    // Later chunks keep the language of the first so they all agree
+    const QString language = root.value("language").toString();
+    if (m_language.isEmpty() && !language.isEmpty()) {
+        m_language = language;
+    }
+
+    const qint64 chunkEnd = chunk.startMs + chunk.durationMs;
+    const QJsonArray items = root.value("segments").toArray();
+    for (const QJsonValue& value : items) {
+        const QJsonObject item = value.toObject();
+        const double logProbability = item.value("avg_logprob").toDouble();
+
+        // Whisper's own test for text hallucinated into silence
+        if (item.value("no_speech_prob").toDouble() > 0.6 && logProbability < -1.0) {
+            continue;
+        }
+
+        SubtitleSegment segment;
+        segment.startTime = chunk.startMs + qRound64(item.value("start").toDouble() * 1000.0);
+        segment.endTime = std::min(chunkEnd, chunk.startMs + qRound64(item.value("end").toDouble() * 1000.0));
+        segment.text = item.value("text").toString().trimmed();
+        segment.confidence = qBound(0.0, std::exp(logProbability), 1.0);
+        segment.language = language.isEmpty() ? m_language : language;
+        segments.append(segment);
+    }
+    return segments;
+}
+
+void WhisperChunkPipeline::release()
+{
+    if (!m_results.contains(m_nextRelease)) {
+        return;
+    }
+
+    while (m_results.contains(m_nextRelease)) {
+        const QList<SubtitleSegment> segments = m_results.take(m_nextRelease);
+        for (SubtitleSegment segment : segments) {
+            if (!m_segments.isEmpty()) {
+                const SubtitleSegment& previous = m_segments.last();
+                // Words on a cut can come out of both chunks
+                if (segment.text == previous.text && segment.startTime - previous.endTime < 1000) {
+                    continue;
+                }
+                segment.startTime = std::max(segment.startTime, previous.endTime);
+            }
+            if (!segment.isValid()) {
+                continue;
+            }
+            m_segments.append(segment);
+            emit segmentReady(segment);
+        }
+
+        m_releasedMs = m_chunkEnds.take(m_nextRelease);
+        ++m_nextRelease;
+    }
+
+    emit progressChanged(progress(), "Transcribing...");
+}
+
+void WhisperChunkPipeline::stopProcesses()
+{
+    if (m_decoder) {
+        m_decoder->disconnect(this);
+        m_decoder->kill();
+        m_decoder->waitForFinished(3000);
+        m_decoder->deleteLater();
+        m_decoder = nullptr;
+    }
+
+    for (Worker& worker : m_workers) {
+        if (worker.process) {
+            worker.process->disconnect(this);
+            worker.process->kill();
+            worker.process->waitForFinished(3000);
+            worker.process->deleteLater();
+            worker.process = nullptr;
+        }
+        worker.chunks.clear();
+    }
+}
+
+void WhisperChunkPipeline::fail(const QString& error)
+{
+    if (!m_running) {
+        return;
+    }
+
+    qCWarning(whisperChunks) << "Chunked transcription failed:" << error;
+    stopProcesses();
+    m_running = false;
+    emit finished(false, error);
+}
+
+void WhisperChunkPipeline::finishIfDone()
+{
+    if (!m_running || !m_decodeFinished || !m_ready.isEmpty() || m_nextRelease < m_nextIndex) {
+        return;
+    }
+    for (const Worker& worker : m_workers) {
+        if (worker.process) {
+            return;
+        }
+    }
+
+    m_running = false;
+    qCInfo(whisperChunks) << "Chunked transcription finished," << m_segments.size() << "segments from"
+                          << m_nextIndex << "chunks";
+    emit finished(true, QString());
+}
+
+int WhisperChunkPipeline::defaultWorkerCount(bool useGPU, int gpuCount)
+{
+    if (useGPU && gpuCount > 0) {
+        return gpuCount;
+    }
+    // Whisper gains little past about four CPU threads per process
+    return std::max(1, CpuTopology::instance().backgroundThreadCount() / 4);
+}
+
+} // namespace AI
+} // namespace EonPlay
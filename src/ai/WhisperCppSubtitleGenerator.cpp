@@ -0,0 +1,544 @@
+#include "ai/WhisperCppSubtitleGenerator.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QThread>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <whisper.h>
+
+Q_LOGGING_CATEGORY(whisperCpp, "eonplay.ai.whispercpp")
+
+namespace EonPlay {
+namespace AI {
+
+namespace {
+
+/**
+ * @brief whisper_context instances shared by all generators
+ *
+ * Kept loaded while unused, so a batch of short files pays for the model
+ * load once; unloadIdleModels() frees them.
+ */
+struct ResidentModel {
+    whisper_context* context = nullptr;
+    int users = 0;
+};
+
+QMutex modelMutex;
+QHash<QString, ResidentModel> residentModels;
+
+QString modelKey(const QString& path, bool useGPU, int device)
+{
+    return QFileInfo(path).canonicalFilePath() + QLatin1Char('|') +
+           (useGPU ? QString::number(device) : QStringLiteral("cpu"));
+}
+
+struct MappedReader {
+    const uchar* data = nullptr;
+    qint64 size = 0;
+    qint64 offset = 0;
+};
+
+/**
+ * @brief Load a model by reading from a memory mapping of the file
+ *
+ * Avoids the stdio copy and leaves the pages in the cache shared with any
+ * other process using the same model.
+ */
+whisper_context* loadModel(const QString& path, bool useGPU, int device)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(whisperCpp) << "Cannot open model:" << path << file.errorString();
+        return nullptr;
+    }
+
+    MappedReader reader;
+    reader.size = file.size();
+    reader.data = file.map(0, reader.size);
+    if (!reader.data) {
+        qCWarning(whisperCpp) << "Cannot map model:" << path << file.errorString();
+        return nullptr;
+    }
+
+    whisper_model_loader loader = {};
+    loader.context = &reader;
+    loader.read = [](void* context, void* output, size_t readSize) -> size_t {
+        auto* r = static_cast<MappedReader*>(context);
+        const size_t available = static_cast<size_t>(r->size - r->offset);
+        const size_t count = std::min(readSize, available);
+        memcpy(output, r->data + r->offset, count);
+        r->offset += static_cast<qint64>(count);
+        return count;
+    };
+    loader.eof = [](void* context) -> bool {
+        auto* r = static_cast<MappedReader*>(context);
+        return r->offset >= r->size;
+    };
+    loader.close = [](void*) {};
+
+    whisper_context_params params = whisper_context_default_params();
+    params.use_gpu = useGPU;
+    params.gpu_device = std::max(0, device);
+
+    QElapsedTimer timer;
+    timer.start();
+    whisper_context* context = whisper_init_with_params(&loader, params);
+    file.unmap(const_cast<uchar*>(reader.data));
+
+    if (context) {
+        qCInfo(whisperCpp) << "Loaded model" << path << "in" << timer.elapsed() << "ms, GPU:" << useGPU;
+    }
+    return context;
+}
+
+} // namespace
+
+WhisperCppSubtitleGenerator::WhisperCppSubtitleGenerator(QObject* parent)
+    : IAISubtitleGenerator(parent)
+    , m_useGPU(true)
+    , m_gpuDevice(0)
+    , m_threads(0)
+    , m_context(nullptr)
+    , m_state(nullptr)
+    , m_isProcessing(false)
+    , m_cancelled(false)
+    , m_progress(0)
+{
+    m_ffmpegPath = QStandardPaths::findExecutable("ffmpeg");
+    m_modelPath = QStandardPaths::locate(QStandardPaths::AppDataLocation, "models/ggml-base.bin");
+}
+
+WhisperCppSubtitleGenerator::~WhisperCppSubtitleGenerator()
+{
+    cancelGeneration();
+    releaseModel();
+}
+
+bool WhisperCppSubtitleGenerator::initialize()
+{
+    if (m_isProcessing) {
+        return false;
+    }
+
+    const QString key = modelKey(m_modelPath, m_useGPU, m_gpuDevice);
+    if (m_context && key == m_modelKey) {
+        return true;
+    }
+    releaseModel();
+
+    if (m_modelPath.isEmpty() || !QFileInfo::exists(m_modelPath)) {
+        qCWarning(whisperCpp) << "Whisper model not found:" << m_modelPath;
+        return false;
+    }
+
+    QMutexLocker locker(&modelMutex);
+    ResidentModel& model = residentModels[key];
+    if (!model.context) {
+        model.context = loadModel(m_modelPath, m_useGPU, m_gpuDevice);
+        if (!model.context) {
+            residentModels.remove(key);
+            return false;
+        }
+    }
+    ++model.users;
+    m_context = model.context;
+    m_modelKey = key;
+    locker.unlock();
+
+    // The decoder state and its KV caches are ours alone and reused per file
+    m_state = whisper_init_state(m_context);
+    if (!m_state) {
+        qCWarning(whisperCpp) << "Failed to create whisper state";
+        releaseModel();
+        return false;
+    }
+    return true;
+}
+
+bool WhisperCppSubtitleGenerator::isAvailable() const
+{
+    return m_context && m_state;
+}
+
+QStringList WhisperCppSubtitleGenerator::getSupportedFormats() const
+{
+    return {
+        "mp3", "wav", "flac", "aac", "ogg", "m4a", "wma",
+        "mp4", "avi", "mkv", "mov", "wmv", "flv", "webm"
+    };
+}
+
+QStringList WhisperCppSubtitleGenerator::getSupportedLanguages() const
+{
+    QStringList languages;
+    for (int id = 0; id <= whisper_lang_max_id(); ++id) {
+        languages << QString::fromLatin1(whisper_lang_str(id));
+    }
+    return languages;
+}
+
+bool WhisperCppSubtitleGenerator::generateSubtitles(const QString& mediaFilePath,
+                                                   const QString& targetLanguage,
+                                                   SubtitleGenerationResult& result)
+{
+    if (!isAvailable()) {
+        result.success = false;
+        result.errorMessage = "Whisper model not loaded";
+        return false;
+    }
+    if (m_isProcessing.exchange(true)) {
+        result.success = false;
+        result.errorMessage = "Generation already in progress";
+        return false;
+    }
+    m_cancelled = false;
+    m_progress = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<float> samples;
+    QString error;
+    bool success = decodeMedia(mediaFilePath, samples, error);
+    if (success) {
+        success = transcribe(samples, targetLanguage, result);
+    } else {
+        result = SubtitleGenerationResult();
+        result.errorMessage = error;
+    }
+    result.processingTimeMs = timer.elapsed();
+    m_isProcessing = false;
+
+    if (success) {
+        qCInfo(whisperCpp) << "Generated" << result.segmentCount << "segments in" << result.processingTimeMs << "ms";
+        emit generationCompleted(result);
+    } else {
+        qCWarning(whisperCpp) << "Subtitle generation failed:" << result.errorMessage;
+        emit generationFailed(result.errorMessage);
+    }
+    return success;
+}
+
+bool WhisperCppSubtitleGenerator::generateSubtitlesFromAudio(const QByteArray& audioData,
+                                                            int sampleRate,
+                                                            int channels,
+                                                            const QString& targetLanguage,
+                                                            SubtitleGenerationResult& result)
+{
+    if (!isAvailable()) {
+        result.success = false;
+        result.errorMessage = "Whisper model not loaded";
+        return false;
+    }
+    if (m_isProcessing.exchange(true)) {
+        result.success = false;
+        result.errorMessage = "Generation already in progress";
+        return false;
+    }
+    m_cancelled = false;
+    m_progress = 0;
+
+    // Already PCM, so there is nothing to spawn at all
+    QElapsedTimer timer;
+    timer.start();
+    const bool success = transcribe(toMono16k(audioData, sampleRate, channels), targetLanguage, result);
+    result.processingTimeMs = timer.elapsed();
+    m_isProcessing = false;
+
+    if (success) {
+        emit generationCompleted(result);
+    } else {
+        emit generationFailed(result.errorMessage);
+    }
+    return success;
+}
+
+void WhisperCppSubtitleGenerator::cancelGeneration()
+{
+    if (m_isProcessing) {
+        // Polled by whisper.cpp between decoder steps
+        m_cancelled = true;
+    }
+}
+
+double WhisperCppSubtitleGenerator::getProgress() const
+{
+    return m_progress / 100.0;
+}
+
+QString WhisperCppSubtitleGenerator::getGeneratorName() const
+{
+    return "Whisper (in-process)";
+}
+
+QString WhisperCppSubtitleGenerator::getVersion() const
+{
+    return "1.0.0";
+}
+
+void WhisperCppSubtitleGenerator::setModelPath(const QString& path)
+{
+    m_modelPath = path;
+}
+
+void WhisperCppSubtitleGenerator::setUseGPU(bool enabled)
+{
+    m_useGPU = enabled;
+}
+
+void WhisperCppSubtitleGenerator::setGpuDevice(int device)
+{
+    m_gpuDevice = std::max(0, device);
+}
+
+void WhisperCppSubtitleGenerator::setThreads(int threads)
+{
+    m_threads = std::max(0, threads);
+}
+
+void WhisperCppSubtitleGenerator::unloadIdleModels()
+{
+    QMutexLocker locker(&modelMutex);
+    for (auto it = residentModels.begin(); it != residentModels.end();) {
+        if (it->users == 0) {
+            whisper_free(it->context);
+            it = residentModels.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool WhisperCppSubtitleGenerator::decodeMedia(const QString& mediaFilePath, QVector<float>& samples, QString& error)
+{
+    if (m_ffmpegPath.isEmpty()) {
+        error = "FFmpeg not found";
+        return false;
+    }
+
+    QProcess ffmpeg;
+    QStringList args;
+    args << "-nostdin"
+         << "-i" << mediaFilePath
+         << "-vn"
+         << "-ac" << "1"
+         << "-ar" << QString::number(SAMPLE_RATE)
+         << "-f" << "s16le"
+         << "-";
+    ffmpeg.start(m_ffmpegPath, args);
+    if (!ffmpeg.waitForStarted()) {
+        error = "Failed to start FFmpeg";
+        return false;
+    }
+
+    // Converted as it arrives so the int16 copy never exists in full
+    QByteArray carry;
+    while (ffmpeg.state() != QProcess::NotRunning || ffmpeg.bytesAvailable() > 0) {
+        if (m_cancelled) {
+            ffmpeg.kill();
+            ffmpeg.waitForFinished();
+            error = "Cancelled";
+            return false;
+        }
+        if (ffmpeg.bytesAvailable() == 0) {
+            ffmpeg.waitForReadyRead(100);
+            continue;
+        }
+
+        const QByteArray data = carry + ffmpeg.readAllStandardOutput();
+        const int count = data.size() / 2;
+        const int base = samples.size();
+        samples.resize(base + count);
+        for (int i = 0; i < count; ++i) {
+            samples[base + i] = qFromLittleEndian<qint16>(data.constData() + i * 2) / 32768.0f;
+        }
+        carry = data.right(data.size() % 2);
+    }
+
+    if (ffmpeg.exitStatus() != QProcess::NormalExit || ffmpeg.exitCode() != 0) {
+        if (samples.isEmpty()) {
+            error = "Failed to decode audio: " + QString::fromUtf8(ffmpeg.readAllStandardError()).trimmed().right(300);
+            return false;
+        }
+        qCWarning(whisperCpp) << "FFmpeg stopped early, transcribing what was decoded";
+    }
+    return true;
+}
+
+bool WhisperCppSubtitleGenerator::transcribe(const QVector<float>& samples, const QString& targetLanguage,
+                                            SubtitleGenerationResult& result)
+{
+    result = SubtitleGenerationResult();
+    m_segments.clear();
+    m_language.clear();
+
+    if (samples.isEmpty()) {
+        result.errorMessage = "No audio to transcribe";
+        return false;
+    }
+
+    const QByteArray language = targetLanguage.isEmpty() ? QByteArray("auto") : targetLanguage.toLatin1();
+
+    whisper_full_params params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    params.n_threads = m_threads > 0 ? m_threads : std::max(1, QThread::idealThreadCount());
+    params.language = language.constData();
+    params.print_progress = false;
+    params.print_realtime = false;
+    params.print_timestamps = false;
+    params.new_segment_callback = &WhisperCppSubtitleGenerator::onNewSegment;
+    params.new_segment_callback_user_data = this;
+    params.progress_callback = &WhisperCppSubtitleGenerator::onProgress;
+    params.progress_callback_user_data = this;
+    params.abort_callback = &WhisperCppSubtitleGenerator::onAbort;
+    params.abort_callback_user_data = this;
+
+    const int status = whisper_full_with_state(m_context, m_state, params, samples.constData(), samples.size());
+    if (m_cancelled) {
+        result.errorMessage = "Cancelled";
+        return false;
+    }
+    if (status != 0) {
+        result.errorMessage = QString("whisper.cpp failed with status %1").arg(status);
+        return false;
+    }
+
+    // Same SRT layout the process-based generator produces
+    QString content;
+    double confidence = 0.0;
+    for (int i = 0; i < m_segments.size(); ++i) {
+        const SubtitleSegment& segment = m_segments[i];
+        auto timestamp = [](qint64 ms) {
+            return QString("%1:%2:%3,%4")
+                   .arg(ms / 3600000, 2, 10, QLatin1Char('0'))
+                   .arg((ms / 60000) % 60, 2, 10, QLatin1Char('0'))
+                   .arg((ms / 1000) % 60, 2, 10, QLatin1Char('0'))
+                   .arg(ms % 1000, 3, 10, QLatin1Char('0'));
+        };
+        content += QString::number(i + 1) + "\n";
+        content += timestamp(segment.startTime) + " --> " + timestamp(segment.endTime) + "\n";
+        content += segment.text + "\n\n";
+        confidence += segment.confidence;
+    }
+
+    result.success = true;
+    result.generatedContent = content;
+    result.segmentCount = m_segments.size();
+    result.confidence = m_segments.isEmpty() ? 0.0 : confidence / m_segments.size();
+    result.detectedLanguage = m_language;
+    m_progress = 100;
+    return true;
+}
+
+QVector<float> WhisperCppSubtitleGenerator::toMono16k(const QByteArray& audioData, int sampleRate, int channels)
+{
+    QVector<float> output;
+    if (sampleRate <= 0 || channels <= 0) {
+        return output;
+    }
+
+    // 16-bit interleaved in, mixed down, then linearly resampled; fine for speech
+    const int frames = audioData.size() / (2 * channels);
+    QVector<float> mono(frames);
+    for (int frame = 0; frame < frames; ++frame) {
+        float sum = 0.0f;
+        for (int channel = 0; channel < channels; ++channel) {
+            sum += qFromLittleEndian<qint16>(audioData.constData() + (frame * channels + channel) * 2);
+        }
+        mono[frame] = sum / (32768.0f * channels);
+    }
+
+    if (sampleRate == SAMPLE_RATE) {
+        return mono;
+    }
+
+    const double step = static_cast<double>(sampleRate) / SAMPLE_RATE;
+    const int outputFrames = static_cast<int>(frames / step);
+    output.resize(outputFrames);
+    for (int i = 0; i < outputFrames; ++i) {
+        const double position = i * step;
+        const int index = static_cast<int>(position);
+        const float fraction = static_cast<float>(position - index);
+        const float next = index + 1 < frames ? mono[index + 1] : mono[index];
+        output[i] = mono[index] + (next - mono[index]) * fraction;
+    }
+    return output;
+}
+
+void WhisperCppSubtitleGenerator::releaseModel()
+{
+    if (m_state) {
+        whisper_free_state(m_state);
+        m_state = nullptr;
+    }
+    if (m_context) {
+        QMutexLocker locker(&modelMutex);
+        auto it = residentModels.find(m_modelKey);
+        if (it != residentModels.end() && it->users > 0) {
+            --it->users;
+        }
+        m_context = nullptr;
+        m_modelKey.clear();
+    }
+}
+
+void WhisperCppSubtitleGenerator::onNewSegment(whisper_context* context, whisper_state* state,
+                                               int newSegments, void* userData)
+{
+    Q_UNUSED(context);
+    auto* self = static_cast<WhisperCppSubtitleGenerator*>(userData);
+
+    if (self->m_language.isEmpty()) {
+        self->m_language = QString::fromLatin1(whisper_lang_str(whisper_full_lang_id_from_state(state)));
+    }
+
+    const int total = whisper_full_n_segments_from_state(state);
+    for (int i = total - newSegments; i < total; ++i) {
+        SubtitleSegment segment;
+        // whisper.cpp times are in centiseconds
+        segment.startTime = whisper_full_get_segment_t0_from_state(state, i) * 10;
+        segment.endTime = whisper_full_get_segment_t1_from_state(state, i) * 10;
+        segment.text = QString::fromUtf8(whisper_full_get_segment_text_from_state(state, i)).trimmed();
+        segment.language = self->m_language;
+
+        const int tokens = whisper_full_n_tokens_from_state(state, i);
+        double probability = 0.0;
+        for (int token = 0; token < tokens; ++token) {
+            probability += whisper_full_get_token_p_from_state(state, i, token);
+        }
+        segment.confidence = tokens > 0 ? probability / tokens : 0.0;
+
+        if (segment.isValid()) {
+            self->m_segments.append(segment);
+            emit self->segmentProcessed(segment);
+        }
+    }
+}
+
+void WhisperCppSubtitleGenerator::onProgress(whisper_context* context, whisper_state* state,
+                                             int progress, void* userData)
+{
+    Q_UNUSED(context);
+    Q_UNUSED(state);
+    auto* self = static_cast<WhisperCppSubtitleGenerator*>(userData);
+    if (progress != self->m_progress) {
+        self->m_progress = progress;
+        emit self->progressChanged(progress / 100.0, "Transcribing...");
+    }
+}
+
+bool WhisperCppSubtitleGenerator::onAbort(void* userData)
+{
+    return static_cast<WhisperCppSubtitleGenerator*>(userData)->m_cancelled;
+}
+
+} // namespace AI
+} // namespace EonPlay
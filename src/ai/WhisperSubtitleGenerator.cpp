@@ -1,4 +1,5 @@
 #include "ai/WhisperSubtitleGenerator.h"
+#include "ThreadPriority.h"
 #include <QProcess>
 #include <QStandardPaths>
 #include <QDir>
@@ -9,7 +10,9 @@
 #include <QRegularExpression>
 #include <QLoggingCategory>
 #include <QMutexLocker>
+#include <QEventLoop>
 #include <QDebug>
+#include <algorithm>
 
 Q_LOGGING_CATEGORY(whisperGenerator, "eonplay.ai.whisper")
 
@@ -35,8 +38,9 @@ WhisperSubtitleGenerator::WhisperSubtitleGenerator(QObject* parent)
     , m_modelSize("base")
     , m_useGPU(true)
     , m_maxSegmentLength(30)
+    , m_workerCount(0)
     , m_confidenceThreshold(0.5)
-    , m_process(nullptr)
+    , m_pipeline(nullptr)
     , m_progressTimer(new QTimer(this))
     , m_tempDir(nullptr)
     , m_currentProgress(0.0)
@@ -152,24 +156,26 @@ bool WhisperSubtitleGenerator::generateSubtitles(const QString& mediaFilePath,
     m_currentProgress = 0.0;
     m_currentResult = SubtitleGenerationResult();
 
+    // Local runs spin an event loop; slots calling back in must not deadlock
+    locker.unlock();
+
     QElapsedTimer timer;
     timer.start();
 
-    // Extract audio from media file
-    QString audioPath;
-    if (!extractAudioFromMedia(mediaFilePath, audioPath)) {
-        result.success = false;
-        result.errorMessage = "Failed to extract audio from media file";
-        m_isProcessing = false;
-        return false;
-    }
-
     bool success = false;
+    QString audioPath;
     switch (m_processingMode) {
         case LocalWhisper:
-            success = processWithLocalWhisper(audioPath, targetLanguage);
+            // The pipeline decodes the media itself, no extraction pass
+            success = processWithLocalWhisper(mediaFilePath, targetLanguage);
             break;
         case CloudAPI:
+            if (!extractAudioFromMedia(mediaFilePath, audioPath)) {
+                result.success = false;
+                result.errorMessage = "Failed to extract audio from media file";
+                m_isProcessing = false;
+                return false;
+            }
             success = processWithCloudAPI(audioPath, targetLanguage);
             break;
         case AutoDetect:
@@ -262,9 +268,8 @@ void WhisperSubtitleGenerator::cancelGeneration()
     if (m_isProcessing) {
         m_isCancelled = true;
         
-        if (m_process && m_process->state() != QProcess::NotRunning) {
-            m_process->kill();
-            m_process->waitForFinished(3000);
+        if (m_pipeline) {
+            m_pipeline->cancel();
         }
         
         m_progressTimer->stop();
@@ -328,6 +333,11 @@ void WhisperSubtitleGenerator::setMaxSegmentLength(int seconds)
     }
 }
 
+void WhisperSubtitleGenerator::setWorkerCount(int workers)
+{
+    m_workerCount = std::max(0, workers);
+}
+
 void WhisperSubtitleGenerator::setConfidenceThreshold(double threshold)
 {
     m_confidenceThreshold = qBound(0.0, threshold, 1.0);
@@ -419,6 +429,7 @@ bool WhisperSubtitleGenerator::extractAudioFromMedia(const QString& mediaPath, Q
 
     // Use ffmpeg to extract audio (simplified - would need proper ffmpeg integration)
     QProcess ffmpegProcess;
+    ThreadPriority::setBackgroundProcess(&ffmpegProcess);
     QStringList args;
     args << "-i" << mediaPath
          << "-vn" // No video
@@ -429,9 +440,14 @@ bool WhisperSubtitleGenerator::extractAudioFromMedia(const QString& mediaPath, Q
          << audioPath;
 
     ffmpegProcess.start("ffmpeg", args);
-    ffmpegProcess.waitForFinished(30000); // 30 second timeout
+    // A feature film takes well over 30 seconds to decode
+    if (!ffmpegProcess.waitForFinished(10 * 60 * 1000)) {
+        ffmpegProcess.kill();
+        qCWarning(whisperGenerator) << "Audio extraction timed out";
+        return false;
+    }
 
-    if (ffmpegProcess.exitCode() != 0) {
+    if (ffmpegProcess.exitStatus() != QProcess::NormalExit || ffmpegProcess.exitCode() != 0) {
         qCWarning(whisperGenerator) << "Failed to extract audio:" << ffmpegProcess.readAllStandardError();
         return false;
     }
@@ -439,55 +455,71 @@ bool WhisperSubtitleGenerator::extractAudioFromMedia(const QString& mediaPath, Q
     return QFileInfo::exists(audioPath);
 }
 
-bool WhisperSubtitleGenerator::processWithLocalWhisper(const QString& audioPath, const QString& language)
+bool WhisperSubtitleGenerator::processWithLocalWhisper(const QString& mediaPath, const QString& language)
 {
-    if (!m_process) {
-        m_process = new QProcess(this);
-        connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-                this, &WhisperSubtitleGenerator::onProcessFinished);
-        connect(m_process, &QProcess::errorOccurred,
-                this, &WhisperSubtitleGenerator::onProcessError);
-        connect(m_process, &QProcess::readyReadStandardOutput,
-                this, &WhisperSubtitleGenerator::onProcessOutput);
+    if (!m_tempDir) {
+        m_tempDir = new QTemporaryDir(this);
+        if (!m_tempDir->isValid()) {
+            m_currentResult.success = false;
+            m_currentResult.errorMessage = "Failed to create temporary directory";
+            return false;
+        }
     }
 
-    m_currentOutputFile = m_tempDir->filePath("whisper_output.srt");
-
-    QStringList args;
-    args << audioPath
-         << "--model" << m_modelSize
-         << "--output_format" << "srt"
-         << "--output_dir" << m_tempDir->path()
-         << "--verbose" << "True";
-
+    WhisperChunkPipeline::Options options;
+    options.whisperPath = m_whisperPath;
+    options.modelSize = m_modelSize;
+    options.useGPU = m_useGPU;
+    options.workers = m_workerCount;
+    options.targetChunkMs = m_maxSegmentLength * 1000;
+    options.maxChunkMs = options.targetChunkMs * 3 / 2;
+    options.firstChunkMs = std::min(options.firstChunkMs, options.targetChunkMs);
     if (!language.isEmpty() && m_supportedLanguages.contains(language)) {
-        args << "--language" << language;
-    }
-
-    if (m_useGPU) {
-        args << "--device" << "cuda";
-    }
-
-    qCInfo(whisperGenerator) << "Starting Whisper process with args:" << args;
-
-    m_process->start(m_whisperPath, args);
-    m_progressTimer->start();
+        options.language = language;
+    }
+
+    m_currentSegments.clear();
+    m_pipeline = new WhisperChunkPipeline(options, this);
+    connect(m_pipeline, &WhisperChunkPipeline::segmentReady, this, [this](const SubtitleSegment& segment) {
+        m_currentSegments.append(segment);
+        emit segmentProcessed(segment);
+    });
+    connect(m_pipeline, &WhisperChunkPipeline::progressChanged, this, [this](double progress, const QString& status) {
+        m_currentProgress = progress;
+        emit progressChanged(progress, status);
+    });
+
+    QEventLoop loop;
+    bool done = false;
+    bool success = false;
+    QString error;
+    connect(m_pipeline, &WhisperChunkPipeline::finished, &loop, [&](bool ok, const QString& message) {
+        done = true;
+        success = ok;
+        error = message;
+        loop.quit();
+    });
 
-    if (!m_process->waitForStarted(5000)) {
-        m_currentResult.success = false;
-        m_currentResult.errorMessage = "Failed to start Whisper process";
-        return false;
+    qCInfo(whisperGenerator) << "Starting chunked Whisper transcription:" << mediaPath;
+    m_pipeline->start(mediaPath, m_tempDir->filePath("chunks"));
+    if (!done) {
+        loop.exec();
     }
 
-    // Wait for process to complete (with timeout)
-    if (!m_process->waitForFinished(300000)) { // 5 minute timeout
-        m_process->kill();
-        m_currentResult.success = false;
-        m_currentResult.errorMessage = "Whisper process timed out";
-        return false;
+    m_currentResult = SubtitleGenerationResult();
+    m_currentResult.success = success;
+    m_currentResult.errorMessage = error;
+    if (success) {
+        m_currentResult.generatedContent = formatSubtitleContent(m_currentSegments);
+        m_currentResult.segmentCount = m_currentSegments.size();
+        m_currentResult.confidence = calculateOverallConfidence(m_currentSegments);
+        m_currentResult.detectedLanguage = m_pipeline->detectedLanguage().isEmpty()
+            ? QStringLiteral("unknown") : m_pipeline->detectedLanguage();
     }
 
-    return m_process->exitCode() == 0;
+    m_pipeline->deleteLater();
+    m_pipeline = nullptr;
+    return success;
 }
 
 bool WhisperSubtitleGenerator::processWithCloudAPI(const QString& audioPath, const QString& language)
@@ -501,80 +533,6 @@ bool WhisperSubtitleGenerator::processWithCloudAPI(const QString& audioPath, con
     return false;
 }
 
-void WhisperSubtitleGenerator::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
-{
-    m_progressTimer->stop();
-
-    if (m_isCancelled) {
-        return;
-    }
-
-    if (exitCode == 0 && exitStatus == QProcess::NormalExit) {
-        // Read the generated SRT file
-        QString srtPath = m_tempDir->filePath("extracted_audio.srt");
-        QFile srtFile(srtPath);
-        
-        if (srtFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QString content = QString::fromUtf8(srtFile.readAll());
-            m_currentResult = parseWhisperOutput(content);
-            m_currentResult.success = true;
-        } else {
-            m_currentResult.success = false;
-            m_currentResult.errorMessage = "Failed to read generated subtitle file";
-        }
-    } else {
-        QString errorOutput = m_process->readAllStandardError();
-        m_currentResult.success = false;
-        m_currentResult.errorMessage = QString("Whisper process failed: %1").arg(errorOutput);
-    }
-
-    m_currentProgress = 1.0;
-    emit progressChanged(m_currentProgress, m_currentResult.success ? "Completed" : "Failed");
-}
-
-void WhisperSubtitleGenerator::onProcessError(QProcess::ProcessError error)
-{
-    m_progressTimer->stop();
-    
-    QString errorString;
-    switch (error) {
-        case QProcess::FailedToStart:
-            errorString = "Failed to start Whisper process";
-            break;
-        case QProcess::Crashed:
-            errorString = "Whisper process crashed";
-            break;
-        case QProcess::Timedout:
-            errorString = "Whisper process timed out";
-            break;
-        default:
-            errorString = "Unknown process error";
-            break;
-    }
-
-    m_currentResult.success = false;
-    m_currentResult.errorMessage = errorString;
-    
-    emit generationFailed(errorString);
-}
-
-void WhisperSubtitleGenerator::onProcessOutput()
-{
-    if (m_process) {
-        QByteArray data = m_process->readAllStandardOutput();
-        QString output = QString::fromUtf8(data);
-        
-        // Parse progress from Whisper output (simplified)
-        QRegularExpression progressRegex(R"(\[(\d+)%\])");
-        QRegularExpressionMatch match = progressRegex.match(output);
-        if (match.hasMatch()) {
-            double progress = match.captured(1).toDouble() / 100.0;
-            m_currentProgress = progress;
-            emit progressChanged(progress, "Processing audio...");
-        }
-    }
-}
-
 void WhisperSubtitleGenerator::onProgressTimer()
 {
     // Estimate progress based on time elapsed (fallback if no progress info available)
@@ -649,6 +607,26 @@ QList<SubtitleSegment> WhisperSubtitleGenerator::parseSegments(const QString& ou
     return segments;
 }
 
+QString WhisperSubtitleGenerator::formatSubtitleContent(const QList<SubtitleSegment>& segments)
+{
+    auto timestamp = [](qint64 ms) {
+        return QString("%1:%2:%3,%4")
+               .arg(ms / 3600000, 2, 10, QLatin1Char('0'))
+               .arg((ms / 60000) % 60, 2, 10, QLatin1Char('0'))
+               .arg((ms / 1000) % 60, 2, 10, QLatin1Char('0'))
+               .arg(ms % 1000, 3, 10, QLatin1Char('0'));
+    };
+
+    QString content;
+    int index = 1;
+    for (const SubtitleSegment& segment : segments) {
+        content += QString::number(index++) + "\n";
+        content += timestamp(segment.startTime) + " --> " + timestamp(segment.endTime) + "\n";
+        content += segment.text + "\n\n";
+    }
+    return content;
+}
+
 QString WhisperSubtitleGenerator::detectLanguageFromOutput(const QString& output)
 {
     // Simple language detection based on common patterns
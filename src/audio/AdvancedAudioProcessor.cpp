@@ -1,10 +1,12 @@
 #include "audio/AdvancedAudioProcessor.h"
+#include "audio/AudioKernels.h"
 #include "audio/AudioProcessor.h"
+#include "audio/AudioTranscoder.h"
+#include "audio/FFTEngine.h"
+#include "PowerPolicy.h"
 #include <QLoggingCategory>
 #include <QMutexLocker>
 #include <QFile>
-#include <QTextStream>
-#include <QRegularExpression>
 #include <QFileInfo>
 #include <QDir>
 #include <QtMath>
@@ -15,26 +17,64 @@
 Q_DECLARE_LOGGING_CATEGORY(advancedAudioProcessor)
 Q_LOGGING_CATEGORY(advancedAudioProcessor, "audio.advanced")
 
+namespace {
+
+/**
+ * @brief Resample per-bin noise power learned at one rate to another
+ *
+ * Bin k covers k * rate / N Hz, so the same frequency lies at bin
+ * k * toRate / fromRate of the old profile.
+ */
+void remapNoiseProfile(const QVector<float>& profile, int fromRate, int toRate, QVector<float>& remapped)
+{
+    const int bins = profile.size();
+    const double ratio = static_cast<double>(toRate) / fromRate;
+    for (int k = 0; k < bins; ++k) {
+        const double position = qMin(k * ratio, static_cast<double>(bins - 1));
+        const int lower = static_cast<int>(position);
+        const int upper = qMin(lower + 1, bins - 1);
+        const float fraction = static_cast<float>(position - lower);
+        remapped[k] = profile[lower] + (profile[upper] - profile[lower]) * fraction;
+    }
+}
+
+} // namespace
+
 AdvancedAudioProcessor::AdvancedAudioProcessor(QObject* parent)
     : QObject(parent)
     , m_audioProcessor(nullptr)
     , m_karaokeMode(Off)
     , m_vocalRemovalStrength(0.8f)
     , m_currentLyricsIndex(-1)
+    , m_transcoder(new AudioTranscoder(this))
     , m_conversionProgress(0)
-    , m_conversionCancelled(false)
-    , m_conversionTimer(new QTimer(this))
+    , m_noiseReductionSuspended(!PowerPolicy::instance().profile().expensiveDspEnabled)
+    , m_noiseStft(NOISE_FRAME_SIZE, 2)
+    , m_noiseAnalysisStft(NOISE_FRAME_SIZE, 2)
+    , m_noiseFramesLearned(0)
+    , m_noiseSampleRate(44100)
     , m_noiseProfileReady(false)
+    , m_preparedNoiseSampleRate(0)
 {
-    // Setup conversion timer
-    m_conversionTimer->setInterval(100); // Update every 100ms
-    connect(m_conversionTimer, &QTimer::timeout, this, &AdvancedAudioProcessor::updateConversionProgress);
+    // Setup conversion queue
+    connect(m_transcoder, &AudioTranscoder::jobProgress, this,
+            [this](int jobId, const AudioTranscoder::Progress& progress) {
+        updateConversionProgress(jobId, progress.percent);
+    });
+    connect(m_transcoder, &AudioTranscoder::jobFinished, this, &AdvancedAudioProcessor::onConversionFinished);
     
     // Initialize noise profile
-    m_noiseProfile.resize(FFT_SIZE / 2);
-    m_noiseSpectrum.resize(FFT_SIZE / 2);
-    m_noiseProfile.fill(0.0f);
-    m_noiseSpectrum.fill(0.0f);
+    const int bins = m_noiseStft.binCount();
+    m_noiseProfile.fill(0.0f, bins);
+    m_framePower.fill(0.0f, bins);
+    m_smoothedPower.fill(0.0f, bins);
+    m_cleanPower.fill(0.0f, bins);
+    m_noiseGains.fill(1.0f, bins);
+    m_preparedNoiseProfile.fill(0.0f, bins);
+    
+    connect(&PowerPolicy::instance(), &PowerPolicy::profileChanged, this, [this](const PowerPolicy::Profile& profile) {
+        setNoiseReductionSuspended(!profile.expensiveDspEnabled);
+    });
     
     qCDebug(advancedAudioProcessor) << "AdvancedAudioProcessor created";
 }
@@ -69,6 +109,7 @@ void AdvancedAudioProcessor::setKaraokeMode(KaraokeMode mode)
 {
     if (m_karaokeMode != mode) {
         m_karaokeMode = mode;
+        m_vocalSuppressor.reset();
         emit karaokeModeChanged(m_karaokeMode);
         qCDebug(advancedAudioProcessor) << "Karaoke mode set to:" << getKaraokeModeName(mode);
     }
@@ -134,26 +175,21 @@ bool AdvancedAudioProcessor::setCurrentAudioTrack(int trackId)
 // Lyrics functionality
 bool AdvancedAudioProcessor::loadLyricsFromFile(const QString& filePath)
 {
-    QFileInfo fileInfo(filePath);
-    QString extension = fileInfo.suffix().toLower();
-    
-    bool success = false;
-    if (extension == "lrc") {
-        success = parseLRCFile(filePath);
-    } else if (extension == "srt") {
-        success = parseSRTFile(filePath);
-    } else {
-        qCWarning(advancedAudioProcessor) << "Unsupported lyrics format:" << extension;
+    LyricsTimeline lyrics;
+    if (!lyrics.loadFile(filePath)) {
         return false;
     }
     
-    if (success) {
+    const int lineCount = lyrics.lineCount();
+    {
+        QMutexLocker locker(&m_processingMutex);
+        m_lyrics = std::move(lyrics);
         m_currentLyricsIndex = -1;
-        emit lyricsLoaded(m_lyricsLines.size());
-        qCDebug(advancedAudioProcessor) << "Loaded" << m_lyricsLines.size() << "lyrics lines from" << filePath;
     }
     
-    return success;
+    emit lyricsLoaded(lineCount);
+    qCDebug(advancedAudioProcessor) << "Loaded" << lineCount << "lyrics lines from" << filePath;
+    return true;
 }
 
 bool AdvancedAudioProcessor::loadEmbeddedLyrics(const QString& mediaPath)
@@ -169,45 +205,35 @@ bool AdvancedAudioProcessor::loadEmbeddedLyrics(const QString& mediaPath)
 QVector<AdvancedAudioProcessor::LyricsLine> AdvancedAudioProcessor::getAllLyrics() const
 {
     QMutexLocker locker(&m_processingMutex);
-    return m_lyricsLines;
+    return m_lyrics.lines();
 }
 
 AdvancedAudioProcessor::LyricsLine AdvancedAudioProcessor::getCurrentLyricsLine(qint64 currentTime) const
 {
     QMutexLocker locker(&m_processingMutex);
     
-    for (const auto& line : m_lyricsLines) {
-        if (currentTime >= line.startTime && currentTime <= line.endTime) {
-            return line;
-        }
-    }
-    
-    return LyricsLine();
+    const int index = m_lyrics.lineAt(currentTime);
+    return index >= 0 ? m_lyrics.line(index) : LyricsLine();
 }
 
 AdvancedAudioProcessor::LyricsLine AdvancedAudioProcessor::getNextLyricsLine(qint64 currentTime) const
 {
     QMutexLocker locker(&m_processingMutex);
     
-    for (const auto& line : m_lyricsLines) {
-        if (line.startTime > currentTime) {
-            return line;
-        }
-    }
-    
-    return LyricsLine();
+    const int index = m_lyrics.nextLineAfter(currentTime);
+    return index >= 0 ? m_lyrics.line(index) : LyricsLine();
 }
 
 bool AdvancedAudioProcessor::hasLyrics() const
 {
     QMutexLocker locker(&m_processingMutex);
-    return !m_lyricsLines.isEmpty();
+    return !m_lyrics.isEmpty();
 }
 
 void AdvancedAudioProcessor::clearLyrics()
 {
     QMutexLocker locker(&m_processingMutex);
-    m_lyricsLines.clear();
+    m_lyrics.clear();
     m_currentLyricsIndex = -1;
     qCDebug(advancedAudioProcessor) << "Lyrics cleared";
 }
@@ -255,33 +281,37 @@ QStringList AdvancedAudioProcessor::getSupportedMetadataFormats()
 bool AdvancedAudioProcessor::convertAudioFormat(const QString& inputPath, const QString& outputPath, 
                                                const ConversionOptions& options)
 {
-    m_conversionProgress = 0;
-    m_conversionCancelled = false;
-    
-    QString outputFormat = options.outputFormat.toLower();
-    bool success = false;
-    
-    m_conversionTimer->start();
-    
-    if (outputFormat == "mp3") {
-        success = convertToMP3(inputPath, outputPath, options);
-    } else if (outputFormat == "flac") {
-        success = convertToFLAC(inputPath, outputPath, options);
-    } else if (outputFormat == "wav") {
-        success = convertToWAV(inputPath, outputPath, options);
-    } else if (outputFormat == "ogg") {
-        success = convertToOGG(inputPath, outputPath, options);
-    } else {
-        qCWarning(advancedAudioProcessor) << "Unsupported output format:" << outputFormat;
+    AudioTranscoder::Options transcode;
+    transcode.format = options.outputFormat.toLower();
+    transcode.sampleRate = options.sampleRate;
+    transcode.channels = options.channels;
+    transcode.preserveMetadata = options.preserveMetadata;
+    
+    // Map the 0-10 quality onto each encoder's own scale
+    const int quality = qBound(0, options.quality, 10);
+    if (transcode.format == "mp3") {
+        transcode.quality = (10 - quality) * 9 / 10;
+        transcode.bitrate = options.bitrate;
+    } else if (transcode.format == "flac") {
+        transcode.quality = quality * 8 / 10;
+    } else if (transcode.format == "ogg") {
+        transcode.quality = quality;
+        transcode.bitrate = options.bitrate;
+    } else if (transcode.format != "wav") {
+        transcode.bitrate = options.bitrate;
+    }
+    
+    const int jobId = m_transcoder->enqueue(inputPath, outputPath, transcode);
+    if (jobId == 0) {
+        qCWarning(advancedAudioProcessor) << "Conversion rejected:" << inputPath << "->" << transcode.format;
+        return false;
     }
     
-    m_conversionTimer->stop();
-    m_conversionProgress = success ? 100 : 0;
-    
-    emit conversionCompleted(success, outputPath);
-    qCDebug(advancedAudioProcessor) << "Conversion completed:" << success;
+    m_conversionJobs.insert(jobId, 0);
+    updateConversionProgress(jobId, 0);
     
-    return success;
+    qCDebug(advancedAudioProcessor) << "Conversion queued:" << inputPath << "->" << outputPath;
+    return true;
 }
 
 QStringList AdvancedAudioProcessor::getSupportedInputFormats()
@@ -291,7 +321,7 @@ QStringList AdvancedAudioProcessor::getSupportedInputFormats()
 
 QStringList AdvancedAudioProcessor::getSupportedOutputFormats()
 {
-    return {"mp3", "flac", "wav", "ogg"};
+    return AudioTranscoder::supportedFormats();
 }
 
 int AdvancedAudioProcessor::getConversionProgress() const
@@ -301,8 +331,12 @@ int AdvancedAudioProcessor::getConversionProgress() const
 
 void AdvancedAudioProcessor::cancelConversion()
 {
-    m_conversionCancelled = true;
-    m_conversionTimer->stop();
+    if (m_conversionJobs.isEmpty()) {
+        return;
+    }
+    
+    // Finished jobs still report conversionCompleted(false, ...)
+    m_transcoder->cancelAll();
     qCDebug(advancedAudioProcessor) << "Conversion cancelled";
 }
 
@@ -314,320 +348,177 @@ AdvancedAudioProcessor::NoiseReductionSettings AdvancedAudioProcessor::getNoiseR
 
 void AdvancedAudioProcessor::setNoiseReductionSettings(const NoiseReductionSettings& settings)
 {
+    QMutexLocker locker(&m_processingMutex);
+    
+    // Start from silence rather than a stale overlap-add tail
+    if (settings.enabled && !m_noiseReductionSettings.enabled) {
+        m_noiseStft.reset();
+    }
+    
     m_noiseReductionSettings = settings;
     qCDebug(advancedAudioProcessor) << "Noise reduction settings updated - enabled:" << settings.enabled
                                    << "strength:" << settings.strength;
 }
 
-void AdvancedAudioProcessor::applyNoiseReduction(QVector<float>& leftChannel, QVector<float>& rightChannel, int sampleRate)
+void AdvancedAudioProcessor::setNoiseReductionSuspended(bool suspended)
 {
-    if (!m_noiseReductionSettings.enabled || !m_noiseProfileReady) {
-        return;
-    }
-    
-    Q_UNUSED(sampleRate)
-    
-    // Apply spectral subtraction or Wiener filtering
-    if (m_noiseReductionSettings.adaptiveMode) {
-        applyWienerFilter(leftChannel, rightChannel);
-    } else {
-        applySpectralSubtraction(leftChannel, rightChannel);
+    if (m_noiseReductionSuspended.exchange(suspended, std::memory_order_relaxed) != suspended) {
+        qCDebug(advancedAudioProcessor) << "Noise reduction" << (suspended ? "suspended" : "resumed");
     }
 }
 
-void AdvancedAudioProcessor::analyzeNoiseProfile(const QVector<float>& leftChannel, const QVector<float>& rightChannel, int sampleRate)
+void AdvancedAudioProcessor::applyNoiseReduction(QVector<float>& leftChannel, QVector<float>& rightChannel, int sampleRate)
 {
-    Q_UNUSED(sampleRate)
-    
-    // Update noise profile from quiet sections
-    updateNoiseProfile(leftChannel, rightChannel);
-    
-    // Calculate average noise level
-    float noiseLevel = 0.0f;
-    for (float level : m_noiseProfile) {
-        noiseLevel += level;
+    if (rightChannel.isEmpty()) {
+        rightChannel = leftChannel;
     }
-    noiseLevel /= m_noiseProfile.size();
     
-    // Convert to dB
-    float noiseLevelDB = 20.0f * qLn(noiseLevel + 1e-10f) / qLn(10.0f);
-    
-    emit noiseProfileAnalyzed(noiseLevelDB);
-    qCDebug(advancedAudioProcessor) << "Noise profile analyzed - level:" << noiseLevelDB << "dB";
+    QMutexLocker locker(&m_processingMutex);
+    applyNoiseReductionBlock(leftChannel.data(), rightChannel.data(),
+                             qMin(leftChannel.size(), rightChannel.size()), sampleRate);
 }
 
-void AdvancedAudioProcessor::processAdvancedAudio(QVector<float>& leftChannel, QVector<float>& rightChannel, int sampleRate)
+void AdvancedAudioProcessor::applyNoiseReductionBlock(float* left, float* right, int frames, int sampleRate)
 {
-    if (leftChannel.isEmpty()) {
+    if (!m_noiseReductionSettings.enabled || m_noiseReductionSuspended.load(std::memory_order_relaxed)) {
         return;
     }
     
-    QMutexLocker locker(&m_processingMutex);
-    
-    // Apply karaoke processing
-    if (m_karaokeMode != Off) {
-        switch (m_karaokeMode) {
-            case VocalRemoval:
-                applyVocalRemoval(leftChannel, rightChannel);
-                break;
-            case VocalIsolation:
-                applyVocalIsolation(leftChannel, rightChannel);
-                break;
-            case CenterChannelExtraction:
-                applyCenterChannelExtraction(leftChannel, rightChannel);
-                break;
-            case AdvancedVocalRemoval:
-                applyAdvancedVocalRemoval(leftChannel, rightChannel);
-                break;
-            case Off:
-            default:
-                break;
-        }
+    if (sampleRate != m_noiseSampleRate) {
+        adoptNoiseProfile(sampleRate);
     }
     
-    // Apply noise reduction
-    if (m_noiseReductionSettings.enabled) {
-        applyNoiseReduction(leftChannel, rightChannel, sampleRate);
-    }
+    // Fixed cost per hop; the profile keeps learning while audio plays
+    float* channels[2] = {left, right};
+    m_noiseStft.process(channels, left == right ? 1 : 2, frames, [this](ComplexF* const* spectra, int channelCount, int bins) {
+        processNoiseSpectrum(spectra, channelCount, bins);
+    });
 }
 
-void AdvancedAudioProcessor::updateConversionProgress()
+void AdvancedAudioProcessor::adoptNoiseProfile(int sampleRate)
 {
-    if (!m_conversionCancelled && m_conversionProgress < 100) {
-        m_conversionProgress += 5; // Simulate progress
-        emit conversionProgressUpdated(m_conversionProgress);
+    // Without preparation the mapping is done here, into the spare buffer
+    if (m_preparedNoiseSampleRate != sampleRate) {
+        remapNoiseProfile(m_noiseProfile, m_noiseSampleRate, sampleRate, m_preparedNoiseProfile);
     }
+    m_noiseProfile.swap(m_preparedNoiseProfile);
+    m_preparedNoiseSampleRate = 0;
+    m_noiseSampleRate = sampleRate;
 }
 
-// Karaoke processing methods
-void AdvancedAudioProcessor::applyVocalRemoval(QVector<float>& leftChannel, QVector<float>& rightChannel)
+void AdvancedAudioProcessor::prepareForSampleRate(int sampleRate)
 {
-    if (rightChannel.isEmpty()) {
-        rightChannel = leftChannel;
+    if (sampleRate <= 0) {
+        return;
     }
     
-    float strength = m_vocalRemovalStrength;
-    
-    for (int i = 0; i < leftChannel.size(); ++i) {
-        float left = leftChannel[i];
-        float right = rightChannel[i];
-        
-        // Simple vocal removal by subtracting center channel
-        float center = (left + right) * 0.5f;
-        float side = (left - right) * 0.5f;
-        
-        // Remove center channel (where vocals typically are)
-        leftChannel[i] = left - center * strength;
-        rightChannel[i] = right - center * strength;
-        
-        // Preserve stereo width
-        leftChannel[i] += side;
-        rightChannel[i] -= side;
+    // Allocate outside the lock; the previous spare buffer is released
+    // with 'remapped', off the audio thread
+    QVector<float> remapped(m_noiseStft.binCount());
+    {
+        QMutexLocker locker(&m_processingMutex);
+        if (sampleRate == m_noiseSampleRate) {
+            return;
+        }
+        remapNoiseProfile(m_noiseProfile, m_noiseSampleRate, sampleRate, remapped);
+        m_preparedNoiseProfile.swap(remapped);
+        m_preparedNoiseSampleRate = sampleRate;
     }
+    
+    qCDebug(advancedAudioProcessor) << "Noise profile prepared for" << sampleRate << "Hz";
 }
 
-void AdvancedAudioProcessor::applyVocalIsolation(QVector<float>& leftChannel, QVector<float>& rightChannel)
+void AdvancedAudioProcessor::analyzeNoiseProfile(const QVector<float>& leftChannel, const QVector<float>& rightChannel, int sampleRate)
 {
-    if (rightChannel.isEmpty()) {
-        rightChannel = leftChannel;
-    }
-    
-    float strength = m_vocalRemovalStrength;
-    
-    for (int i = 0; i < leftChannel.size(); ++i) {
-        float left = leftChannel[i];
-        float right = rightChannel[i];
+    float noiseLevelDB;
+    {
+        QMutexLocker locker(&m_processingMutex);
         
-        // Isolate center channel (vocals)
-        float center = (left + right) * 0.5f * strength;
+        m_noiseSampleRate = sampleRate;
+        m_preparedNoiseSampleRate = 0;
+        const int frames = rightChannel.isEmpty() ? leftChannel.size()
+                                                  : qMin(leftChannel.size(), rightChannel.size());
+        if (frames > 0) {
+            const float* channels[2] = {leftChannel.constData(), rightChannel.constData()};
+            m_noiseAnalysisStft.analyzeOnly(channels, rightChannel.isEmpty() ? 1 : 2, frames,
+                                            [this](ComplexF* const* spectra, int channelCount, int bins) {
+                measureFramePower(spectra, channelCount, bins);
+                updateNoiseProfile(true);
+            });
+        }
         
-        leftChannel[i] = center;
-        rightChannel[i] = center;
+        noiseLevelDB = noiseLevelDb();
     }
+    
+    emit noiseProfileAnalyzed(noiseLevelDB);
+    qCDebug(advancedAudioProcessor) << "Noise profile analyzed - level:" << noiseLevelDB << "dB";
 }
 
-void AdvancedAudioProcessor::applyCenterChannelExtraction(QVector<float>& leftChannel, QVector<float>& rightChannel)
+void AdvancedAudioProcessor::processAdvancedAudio(QVector<float>& leftChannel, QVector<float>& rightChannel, int sampleRate)
 {
-    if (rightChannel.isEmpty()) {
-        rightChannel = leftChannel;
+    if (leftChannel.isEmpty()) {
+        return;
     }
     
-    for (int i = 0; i < leftChannel.size(); ++i) {
-        float left = leftChannel[i];
-        float right = rightChannel[i];
-        
-        // Extract center channel
-        float center = (left + right) * 0.5f;
-        
-        leftChannel[i] = center;
-        rightChannel[i] = center;
-    }
-}
-
-void AdvancedAudioProcessor::applyAdvancedVocalRemoval(QVector<float>& leftChannel, QVector<float>& rightChannel)
-{
     if (rightChannel.isEmpty()) {
         rightChannel = leftChannel;
     }
     
-    float strength = m_vocalRemovalStrength;
-    
-    // Apply high-pass filter to preserve bass
-    for (int i = 0; i < leftChannel.size(); ++i) {
-        float left = leftChannel[i];
-        float right = rightChannel[i];
-        
-        // Simple high-pass filter (preserves bass)
-        float cutoff = 0.02f; // Roughly 200Hz at 44.1kHz
-        
-        m_vocalRemovalState.highpassState1L += cutoff * (left - m_vocalRemovalState.highpassState1L);
-        m_vocalRemovalState.highpassState1R += cutoff * (right - m_vocalRemovalState.highpassState1R);
-        
-        float filteredLeft = left - m_vocalRemovalState.highpassState1L;
-        float filteredRight = right - m_vocalRemovalState.highpassState1R;
-        
-        // Apply vocal removal to filtered signal
-        float center = (filteredLeft + filteredRight) * 0.5f;
-        
-        leftChannel[i] = left - center * strength;
-        rightChannel[i] = right - center * strength;
-    }
+    processAdvancedBlock(leftChannel.data(), rightChannel.data(),
+                         qMin(leftChannel.size(), rightChannel.size()), sampleRate);
 }
 
-// Lyrics parsing methods
-bool AdvancedAudioProcessor::parseLRCFile(const QString& filePath)
+void AdvancedAudioProcessor::processAdvancedBlock(float* left, float* right, int frames, int sampleRate)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qCWarning(advancedAudioProcessor) << "Cannot open LRC file:" << filePath;
-        return false;
+    if (frames <= 0) {
+        return;
     }
     
-    m_lyricsLines.clear();
-    QTextStream in(&file);
-    
-    // LRC format: [mm:ss.xx]lyrics text
-    QRegularExpression timeRegex(R"(\[(\d{2}):(\d{2})\.(\d{2})\](.*))", QRegularExpression::MultilineOption);
+    QMutexLocker locker(&m_processingMutex);
     
-    while (!in.atEnd()) {
-        QString line = in.readLine().trimmed();
-        
-        QRegularExpressionMatch match = timeRegex.match(line);
-        if (match.hasMatch()) {
-            int minutes = match.captured(1).toInt();
-            int seconds = match.captured(2).toInt();
-            int centiseconds = match.captured(3).toInt();
-            QString text = match.captured(4).trimmed();
-            
-            qint64 startTime = (minutes * 60 + seconds) * 1000 + centiseconds * 10;
-            qint64 endTime = startTime + 3000; // Default 3 second duration
-            
-            if (!text.isEmpty()) {
-                m_lyricsLines.append(LyricsLine(startTime, endTime, text));
-            }
+    // Apply karaoke processing
+    if (m_karaokeMode != Off) {
+        switch (m_karaokeMode) {
+            case VocalRemoval:
+            case VocalIsolation:
+            case AdvancedVocalRemoval:
+                applySpectralKaraoke(left, right, frames, sampleRate);
+                break;
+            case CenterChannelExtraction:
+                applyCenterChannelExtraction(left, right, frames);
+                break;
+            case Off:
+            default:
+                break;
         }
     }
     
-    // Sort by start time and adjust end times
-    std::sort(m_lyricsLines.begin(), m_lyricsLines.end(), 
-              [](const LyricsLine& a, const LyricsLine& b) {
-                  return a.startTime < b.startTime;
-              });
-    
-    // Adjust end times based on next line start time
-    for (int i = 0; i < m_lyricsLines.size() - 1; ++i) {
-        m_lyricsLines[i].endTime = m_lyricsLines[i + 1].startTime;
+    // Apply noise reduction
+    if (m_noiseReductionSettings.enabled) {
+        applyNoiseReductionBlock(left, right, frames, sampleRate);
     }
-    
-    return !m_lyricsLines.isEmpty();
 }
 
-bool AdvancedAudioProcessor::parseSRTFile(const QString& filePath)
+// Karaoke processing methods
+void AdvancedAudioProcessor::applySpectralKaraoke(float* leftChannel, float* rightChannel, int frames, int sampleRate)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qCWarning(advancedAudioProcessor) << "Cannot open SRT file:" << filePath;
-        return false;
-    }
-    
-    m_lyricsLines.clear();
-    QTextStream in(&file);
-    
-    // SRT format: number, time range, text, blank line
-    QRegularExpression timeRegex(R"((\d{2}):(\d{2}):(\d{2}),(\d{3}) --> (\d{2}):(\d{2}):(\d{2}),(\d{3}))");
-    
-    QString currentText;
-    qint64 startTime = 0, endTime = 0;
-    bool expectingTime = false;
-    bool expectingText = false;
-    
-    while (!in.atEnd()) {
-        QString line = in.readLine().trimmed();
-        
-        if (line.isEmpty()) {
-            // End of subtitle block
-            if (!currentText.isEmpty()) {
-                m_lyricsLines.append(LyricsLine(startTime, endTime, currentText));
-                currentText.clear();
-            }
-            expectingTime = false;
-            expectingText = false;
-        } else if (line.toInt() > 0 && !expectingTime && !expectingText) {
-            // Subtitle number
-            expectingTime = true;
-        } else if (expectingTime) {
-            // Time range
-            QRegularExpressionMatch match = timeRegex.match(line);
-            if (match.hasMatch()) {
-                // Start time
-                int h1 = match.captured(1).toInt();
-                int m1 = match.captured(2).toInt();
-                int s1 = match.captured(3).toInt();
-                int ms1 = match.captured(4).toInt();
-                startTime = ((h1 * 60 + m1) * 60 + s1) * 1000 + ms1;
-                
-                // End time
-                int h2 = match.captured(5).toInt();
-                int m2 = match.captured(6).toInt();
-                int s2 = match.captured(7).toInt();
-                int ms2 = match.captured(8).toInt();
-                endTime = ((h2 * 60 + m2) * 60 + s2) * 1000 + ms2;
-                
-                expectingTime = false;
-                expectingText = true;
-            }
-        } else if (expectingText) {
-            // Subtitle text
-            if (!currentText.isEmpty()) {
-                currentText += " ";
-            }
-            currentText += line;
-        }
-    }
-    
-    // Add last subtitle if exists
-    if (!currentText.isEmpty()) {
-        m_lyricsLines.append(LyricsLine(startTime, endTime, currentText));
+    // Vocals need two distinct channels to stand apart from the rest
+    if (leftChannel == rightChannel) {
+        return;
     }
     
-    return !m_lyricsLines.isEmpty();
+    m_vocalSuppressor.setMode(m_karaokeMode == VocalIsolation ? VocalSuppressor::Isolate : VocalSuppressor::Remove);
+    m_vocalSuppressor.setStrength(m_vocalRemovalStrength);
+    m_vocalSuppressor.setFrequencyRange(m_karaokeMode == AdvancedVocalRemoval ? VOCAL_BASS_CUTOFF : VOCAL_FREQUENCY_MIN,
+                                        VOCAL_FREQUENCY_MAX);
+    m_vocalSuppressor.process(leftChannel, rightChannel, frames, sampleRate);
 }
 
-qint64 AdvancedAudioProcessor::parseTimeString(const QString& timeStr) const
+void AdvancedAudioProcessor::applyCenterChannelExtraction(float* leftChannel, float* rightChannel, int frames)
 {
-    // Parse time string in various formats
-    QRegularExpression timeRegex(R"((\d{1,2}):(\d{2})(?:\.(\d{2}))?)", QRegularExpression::MultilineOption);
-    QRegularExpressionMatch match = timeRegex.match(timeStr);
-    
-    if (match.hasMatch()) {
-        int minutes = match.captured(1).toInt();
-        int seconds = match.captured(2).toInt();
-        int centiseconds = match.captured(3).isEmpty() ? 0 : match.captured(3).toInt();
-        
-        return (minutes * 60 + seconds) * 1000 + centiseconds * 10;
-    }
-    
-    return 0;
+    // Extract center channel, the mid of a mid/side split
+    AudioKernels::midSideEncode(leftChannel, rightChannel, frames);
+    std::copy_n(leftChannel, frames, rightChannel);
 }
 
 // Metadata methods (simplified implementations)
@@ -671,141 +562,171 @@ bool AdvancedAudioProcessor::writeFLACMetadata(const QString& filePath, const Au
     return false;
 }
 
-// Format conversion methods (simplified implementations)
-bool AdvancedAudioProcessor::convertToMP3(const QString& inputPath, const QString& outputPath, const ConversionOptions& options)
+// Format conversion methods
+void AdvancedAudioProcessor::updateConversionProgress(int jobId, int percent)
 {
-    Q_UNUSED(inputPath)
-    Q_UNUSED(outputPath)
-    Q_UNUSED(options)
+    const auto it = m_conversionJobs.find(jobId);
+    if (it == m_conversionJobs.end()) {
+        return;
+    }
+    it.value() = percent;
     
-    // This would use FFmpeg or similar library for conversion
-    qCDebug(advancedAudioProcessor) << "MP3 conversion not yet implemented";
-    return false;
+    int total = 0;
+    for (int jobPercent : std::as_const(m_conversionJobs)) {
+        total += jobPercent;
+    }
+    const int progress = total / m_conversionJobs.size();
+    if (progress != m_conversionProgress) {
+        m_conversionProgress = progress;
+        emit conversionProgressUpdated(m_conversionProgress);
+    }
 }
 
-bool AdvancedAudioProcessor::convertToFLAC(const QString& inputPath, const QString& outputPath, const ConversionOptions& options)
+void AdvancedAudioProcessor::onConversionFinished(int jobId, bool success, const QString& outputPath, const QString& error)
 {
-    Q_UNUSED(inputPath)
-    Q_UNUSED(outputPath)
-    Q_UNUSED(options)
+    if (!m_conversionJobs.remove(jobId)) {
+        return;
+    }
     
-    // This would use FFmpeg or similar library for conversion
-    qCDebug(advancedAudioProcessor) << "FLAC conversion not yet implemented";
-    return false;
+    if (m_conversionJobs.isEmpty()) {
+        m_conversionProgress = success ? 100 : 0;
+        emit conversionProgressUpdated(m_conversionProgress);
+    } else {
+        updateConversionProgress(m_conversionJobs.constBegin().key(), m_conversionJobs.constBegin().value());
+    }
+    
+    emit conversionCompleted(success, outputPath);
+    qCDebug(advancedAudioProcessor) << "Conversion completed:" << success << error;
 }
 
-bool AdvancedAudioProcessor::convertToWAV(const QString& inputPath, const QString& outputPath, const ConversionOptions& options)
+// Noise reduction methods
+void AdvancedAudioProcessor::processNoiseSpectrum(ComplexF* const* spectra, int channels, int bins)
 {
-    Q_UNUSED(inputPath)
-    Q_UNUSED(outputPath)
-    Q_UNUSED(options)
+    measureFramePower(spectra, channels, bins);
+    updateNoiseProfile(false);
     
-    // This would use FFmpeg or similar library for conversion
-    qCDebug(advancedAudioProcessor) << "WAV conversion not yet implemented";
-    return false;
+    if (!m_noiseProfileReady) {
+        return;
+    }
+    
+    if (m_noiseReductionSettings.adaptiveMode) {
+        applyWienerFilter(bins);
+    } else {
+        applySpectralSubtraction(bins);
+    }
+    
+    // Halve the attenuation (in dB) across the voice band
+    if (m_noiseReductionSettings.preserveVoice) {
+        const float binWidth = static_cast<float>(m_noiseSampleRate) / m_noiseStft.frameSize();
+        const int firstBin = qBound(0, static_cast<int>(VOCAL_FREQUENCY_MIN / binWidth), bins);
+        const int lastBin = qBound(0, static_cast<int>(VOCAL_FREQUENCY_MAX / binWidth) + 1, bins);
+        for (int k = firstBin; k < lastBin; ++k) {
+            m_noiseGains[k] = qSqrt(m_noiseGains[k]);
+        }
+    }
+    
+    for (int ch = 0; ch < channels; ++ch) {
+        ComplexF* spectrum = spectra[ch];
+        for (int k = 0; k < bins; ++k) {
+            spectrum[k] *= m_noiseGains[k];
+        }
+    }
 }
 
-bool AdvancedAudioProcessor::convertToOGG(const QString& inputPath, const QString& outputPath, const ConversionOptions& options)
+void AdvancedAudioProcessor::measureFramePower(const ComplexF* const* spectra, int channels, int bins)
 {
-    Q_UNUSED(inputPath)
-    Q_UNUSED(outputPath)
-    Q_UNUSED(options)
+    const float channelScale = 1.0f / channels;
     
-    // This would use FFmpeg or similar library for conversion
-    qCDebug(advancedAudioProcessor) << "OGG conversion not yet implemented";
-    return false;
+    for (int k = 0; k < bins; ++k) {
+        float power = 0.0f;
+        for (int ch = 0; ch < channels; ++ch) {
+            power += std::norm(spectra[ch][k]);
+        }
+        m_framePower[k] = power * channelScale;
+    }
 }
 
-// Noise reduction methods
-void AdvancedAudioProcessor::updateNoiseProfile(const QVector<float>& leftChannel, const QVector<float>& rightChannel)
+void AdvancedAudioProcessor::updateNoiseProfile(bool knownNoise)
 {
-    // Simple noise profile update - would be more sophisticated in real implementation
-    QVector<float> monoSignal;
+    const int bins = m_framePower.size();
     
-    for (int i = 0; i < leftChannel.size(); ++i) {
-        float mono = leftChannel[i];
-        if (i < rightChannel.size()) {
-            mono = (mono + rightChannel[i]) * 0.5f;
-        }
-        monoSignal.append(mono);
+    // Windowed white noise of variance s^2 has E|X|^2 = s^2 * N / 2
+    float meanPower = 0.0f;
+    for (int k = 0; k < bins; ++k) {
+        meanPower += m_framePower[k];
+        m_smoothedPower[k] = 0.7f * m_smoothedPower[k] + 0.3f * m_framePower[k];
     }
+    meanPower /= bins;
     
-    // Calculate RMS level
-    float rms = 0.0f;
-    for (float sample : monoSignal) {
-        rms += sample * sample;
-    }
-    rms = qSqrt(rms / monoSignal.size());
+    const float frameLevelDb = 10.0f * std::log10(meanPower / (m_noiseStft.frameSize() * 0.5f) + 1e-20f);
+    const bool quiet = knownNoise || frameLevelDb < m_noiseReductionSettings.threshold;
+    const bool adaptive = m_noiseReductionSettings.adaptiveMode;
     
-    // Update noise profile if signal is quiet (likely noise)
-    if (rms < 0.01f) { // Threshold for noise detection
-        // This would perform FFT and update noise spectrum
-        m_noiseProfileReady = true;
+    if (!quiet && !adaptive) {
+        return;
     }
-}
-
-void AdvancedAudioProcessor::applySpectralSubtraction(QVector<float>& leftChannel, QVector<float>& rightChannel)
-{
-    // Simplified spectral subtraction
-    float strength = m_noiseReductionSettings.strength;
     
-    for (int i = 0; i < leftChannel.size(); ++i) {
-        float left = leftChannel[i];
-        float right = rightChannel.isEmpty() ? left : rightChannel[i];
-        
-        // Simple noise gate
-        float level = qMax(qAbs(left), qAbs(right));
-        float threshold = qPow(10.0f, m_noiseReductionSettings.threshold / 20.0f);
-        
-        if (level < threshold) {
-            leftChannel[i] *= (1.0f - strength);
-            if (!rightChannel.isEmpty()) {
-                rightChannel[i] *= (1.0f - strength);
-            }
+    if (m_noiseFramesLearned == 0) {
+        m_noiseProfile = quiet ? m_framePower : m_smoothedPower;
+    } else if (quiet) {
+        // Quiet frames are taken as noise outright
+        for (int k = 0; k < bins; ++k) {
+            m_noiseProfile[k] = 0.9f * m_noiseProfile[k] + 0.1f * m_framePower[k];
+        }
+    } else {
+        // Minimum tracking: follow dips immediately, drift slowly upwards
+        for (int k = 0; k < bins; ++k) {
+            m_noiseProfile[k] = qMin(m_smoothedPower[k], m_noiseProfile[k] * NOISE_RISE_RATE);
         }
     }
+    
+    if (m_noiseFramesLearned < NOISE_LEARNING_FRAMES) {
+        ++m_noiseFramesLearned;
+    }
+    m_noiseProfileReady = m_noiseFramesLearned >= NOISE_LEARNING_FRAMES;
 }
 
-void AdvancedAudioProcessor::applyWienerFilter(QVector<float>& leftChannel, QVector<float>& rightChannel)
+void AdvancedAudioProcessor::applySpectralSubtraction(int bins)
 {
-    // Simplified Wiener filtering
-    applySpectralSubtraction(leftChannel, rightChannel);
+    // Power spectral subtraction with over-subtraction scaled by strength
+    const float strength = m_noiseReductionSettings.strength;
+    const float overSubtraction = 1.0f + strength;
+    const float floorGain = qMax(NOISE_MIN_GAIN, 1.0f - strength);
+    const float floorPower = floorGain * floorGain;
+    
+    for (int k = 0; k < bins; ++k) {
+        const float power = m_framePower[k] + 1e-20f;
+        const float gainPower = qMax(1.0f - overSubtraction * m_noiseProfile[k] / power, floorPower);
+        m_noiseGains[k] = qSqrt(gainPower);
+        m_cleanPower[k] = gainPower * power;
+    }
 }
 
-void AdvancedAudioProcessor::performFFT(const QVector<float>& input, QVector<ComplexF>& output)
+void AdvancedAudioProcessor::applyWienerFilter(int bins)
 {
-    // Simplified FFT implementation
-    int N = qMin(input.size(), FFT_SIZE);
-    output.resize(N);
+    // Wiener gain with a decision-directed a priori SNR estimate
+    const float strength = m_noiseReductionSettings.strength;
+    const float floorGain = qMax(NOISE_MIN_GAIN, 1.0f - strength);
+    const float alpha = 0.98f;
     
-    for (int k = 0; k < N; ++k) {
-        std::complex<float> sum(0, 0);
-        
-        for (int n = 0; n < N; ++n) {
-            float angle = -2.0f * M_PI * k * n / N;
-            std::complex<float> w(qCos(angle), qSin(angle));
-            sum += input[n] * w;
-        }
-        
-        output[k] = sum;
+    for (int k = 0; k < bins; ++k) {
+        const float noise = m_noiseProfile[k] + 1e-20f;
+        const float posteriorSnr = m_framePower[k] / noise;
+        const float prioriSnr = alpha * m_cleanPower[k] / noise
+                              + (1.0f - alpha) * qMax(posteriorSnr - 1.0f, 0.0f);
+        const float gain = qMax(prioriSnr / (1.0f + prioriSnr), floorGain);
+        m_noiseGains[k] = gain;
+        m_cleanPower[k] = gain * gain * m_framePower[k];
     }
 }
 
-void AdvancedAudioProcessor::performIFFT(const QVector<ComplexF>& input, QVector<float>& output)
+float AdvancedAudioProcessor::noiseLevelDb() const
 {
-    // Simplified IFFT implementation
-    int N = input.size();
-    output.resize(N);
-    
-    for (int n = 0; n < N; ++n) {
-        std::complex<float> sum(0, 0);
-        
-        for (int k = 0; k < N; ++k) {
-            float angle = 2.0f * M_PI * k * n / N;
-            std::complex<float> w(qCos(angle), qSin(angle));
-            sum += input[k] * w;
-        }
-        
-        output[n] = sum.real() / N;
+    float meanPower = 0.0f;
+    for (float power : m_noiseProfile) {
+        meanPower += power;
     }
+    meanPower /= qMax(1, static_cast<int>(m_noiseProfile.size()));
+    
+    return 10.0f * std::log10(meanPower / (m_noiseStft.frameSize() * 0.5f) + 1e-20f);
 }
\ No newline at end of file
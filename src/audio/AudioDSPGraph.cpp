@@ -0,0 +1,583 @@
+#include "audio/AudioDSPGraph.h"
+#include "Breadcrumbs.h"
+#include "ThreadPriority.h"
+#include "audio/AudioEqualizer.h"
+#include "audio/AudioKernels.h"
+#include "audio/AdvancedAudioProcessor.h"
+#include "audio/AudioProcessor.h"
+#include "audio/AudioOutputManager.h"
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+Q_DECLARE_LOGGING_CATEGORY(audioDSPGraph)
+Q_LOGGING_CATEGORY(audioDSPGraph, "audio.graph")
+
+AudioDSPGraph::AudioDSPGraph()
+    : m_nextNodeId(1)
+    , m_nextSequence(0)
+    , m_generation(0)
+    , m_internalSampleRate(0)
+    , m_activeGeneration(0)
+    , m_resamplerInputRate(0)
+    , m_resamplerOutputRate(0)
+    , m_sourceSampleRate(44100)
+    , m_inputOffset(0)
+    , m_inputFrames(0)
+    , m_outputLeft(nullptr)
+    , m_outputRight(nullptr)
+    , m_outputOffset(0)
+    , m_outputFrames(0)
+    , m_outputSampleRate(44100)
+    , m_scheduledStartNs(0)
+    , m_scheduledSampleRate(0)
+    , m_rateTrim(1.0)
+    , m_driftCorrecting(false)
+    , m_waitingForStart(false)
+    , m_startNs(0)
+    , m_renderSeconds(0.0)
+{
+    std::fill(std::begin(m_renderLeft), std::end(m_renderLeft), 0.0f);
+    std::fill(std::begin(m_renderRight), std::end(m_renderRight), 0.0f);
+    
+    // Pick the kernels here rather than on the first audio callback
+    qCDebug(audioDSPGraph) << "Kernels:" << AudioKernels::instructionSetName(AudioKernels::activeInstructionSet());
+    std::fill(std::begin(m_resampledLeft), std::end(m_resampledLeft), 0.0f);
+    std::fill(std::begin(m_resampledRight), std::end(m_resampledRight), 0.0f);
+}
+
+AudioDSPGraph::~AudioDSPGraph() = default;
+
+int AudioDSPGraph::addNode(std::shared_ptr<AudioDSPNode> node, int order)
+{
+    if (!node) {
+        return -1;
+    }
+
+    QMutexLocker locker(&m_controlMutex);
+
+    if (m_nodes.size() >= MAX_NODES) {
+        qCWarning(audioDSPGraph) << "DSP graph is full, rejecting node" << node->name();
+        return -1;
+    }
+
+    NodeEntry entry;
+    entry.id = m_nextNodeId++;
+    entry.order = order;
+    entry.sequence = m_nextSequence++;
+    entry.node = std::move(node);
+    m_nodes.append(entry);
+    BreadcrumbRing::instance().record(BreadcrumbRing::Audio, "dsp.add " + entry.node->name().toUtf8(), entry.id);
+
+    return entry.id;
+}
+
+bool AudioDSPGraph::removeNode(int nodeId)
+{
+    QMutexLocker locker(&m_controlMutex);
+
+    for (int i = 0; i < m_nodes.size(); ++i) {
+        if (m_nodes[i].id == nodeId) {
+            m_nodes.removeAt(i);
+            BreadcrumbRing::instance().record(BreadcrumbRing::Audio, "dsp.remove", nodeId);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void AudioDSPGraph::clear()
+{
+    QMutexLocker locker(&m_controlMutex);
+    m_nodes.clear();
+}
+
+void AudioDSPGraph::setSource(SourceCallback source)
+{
+    QMutexLocker locker(&m_controlMutex);
+    m_source = source ? std::make_shared<SourceCallback>(std::move(source)) : nullptr;
+}
+
+void AudioDSPGraph::setInternalSampleRate(int sampleRate)
+{
+    QMutexLocker locker(&m_controlMutex);
+    m_internalSampleRate = qMax(0, sampleRate);
+}
+
+int AudioDSPGraph::internalSampleRate() const
+{
+    QMutexLocker locker(&m_controlMutex);
+    return m_internalSampleRate;
+}
+
+void AudioDSPGraph::compile(int sampleRate)
+{
+    QMutexLocker locker(&m_controlMutex);
+
+    if (m_internalSampleRate > 0) {
+        sampleRate = m_internalSampleRate;
+    }
+
+    QVector<NodeEntry> sorted = m_nodes;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const NodeEntry& a, const NodeEntry& b) {
+        return a.order != b.order ? a.order < b.order : a.sequence < b.sequence;
+    });
+
+    QVector<std::shared_ptr<AudioDSPNode>> compiled;
+    compiled.reserve(sorted.size());
+    for (const NodeEntry& entry : sorted) {
+        entry.node->prepare(sampleRate, MAX_BLOCK_FRAMES);
+        compiled.append(entry.node);
+    }
+
+    CompiledPlan& plan = m_planBuffer.writeBuffer();
+    plan.nodeCount = compiled.size();
+    for (int i = 0; i < MAX_NODES; ++i) {
+        plan.nodes[i] = i < compiled.size() ? compiled[i].get() : nullptr;
+    }
+    plan.source = m_source.get();
+    plan.internalSampleRate = m_internalSampleRate;
+    plan.generation = ++m_generation;
+
+    // Anything the previous plan referenced stays alive until the audio
+    // thread has picked up this generation
+    for (const std::shared_ptr<AudioDSPNode>& node : m_compiledNodes) {
+        if (!compiled.contains(node)) {
+            m_retired.append({m_generation, node, nullptr});
+        }
+    }
+    if (m_compiledSource && m_compiledSource != m_source) {
+        m_retired.append({m_generation, nullptr, m_compiledSource});
+    }
+
+    m_compiledNodes = compiled;
+    m_compiledSource = m_source;
+    m_planBuffer.publish();
+    BreadcrumbRing::instance().record(BreadcrumbRing::Audio, "dsp.compile", compiled.size());
+
+    collectRetired();
+
+    qCDebug(audioDSPGraph) << "Compiled DSP graph generation" << m_generation
+                           << "with" << compiled.size() << "nodes at" << sampleRate << "Hz";
+}
+
+void AudioDSPGraph::prepareForFormat(int sampleRate)
+{
+    QMutexLocker locker(&m_controlMutex);
+
+    // Nodes keep running at the internal rate; only the converter changes
+    if (m_internalSampleRate > 0) {
+        if (sampleRate != m_internalSampleRate) {
+            m_preparedResampler.writeBuffer().bank = PolyphaseResampler::filterBank(sampleRate, m_internalSampleRate);
+            m_preparedResampler.publish();
+            qCDebug(audioDSPGraph) << "Prepared resampler" << sampleRate << "->" << m_internalSampleRate << "Hz";
+        }
+        return;
+    }
+
+    for (const std::shared_ptr<AudioDSPNode>& node : m_compiledNodes) {
+        node->prepare(sampleRate, MAX_BLOCK_FRAMES);
+    }
+
+    qCDebug(audioDSPGraph) << "Prepared" << m_compiledNodes.size() << "nodes for" << sampleRate << "Hz";
+}
+
+void AudioDSPGraph::scheduleStart(qint64 renderTimeNs, int outputSampleRate)
+{
+    // The rate is read once the audio thread sees the time
+    m_scheduledSampleRate.store(outputSampleRate, std::memory_order_relaxed);
+    m_scheduledStartNs.store(qMax<qint64>(1, renderTimeNs), std::memory_order_release);
+    BreadcrumbRing::instance().record(BreadcrumbRing::Audio, "dsp.schedule_start", outputSampleRate);
+}
+
+void AudioDSPGraph::setRateTrim(double ratio)
+{
+    m_rateTrim.store(qBound(1.0 - DriftCorrector::MAX_TRIM, ratio, 1.0 + DriftCorrector::MAX_TRIM),
+                     std::memory_order_relaxed);
+}
+
+AudioDSPGraph::RenderPosition AudioDSPGraph::renderPosition()
+{
+    m_renderPosition.consume();
+    return m_renderPosition.readBuffer();
+}
+
+QStringList AudioDSPGraph::processingOrder() const
+{
+    QMutexLocker locker(&m_controlMutex);
+
+    QStringList names;
+    for (const std::shared_ptr<AudioDSPNode>& node : m_compiledNodes) {
+        names.append(node->name());
+    }
+    return names;
+}
+
+int AudioDSPGraph::nodeCount() const
+{
+    QMutexLocker locker(&m_controlMutex);
+    return m_nodes.size();
+}
+
+int AudioDSPGraph::latencyFrames() const
+{
+    QMutexLocker locker(&m_controlMutex);
+
+    int frames = 0;
+    for (const std::shared_ptr<AudioDSPNode>& node : m_compiledNodes) {
+        if (!node->isBypassed()) {
+            frames += node->latencyFrames();
+        }
+    }
+    return frames;
+}
+
+void AudioDSPGraph::collectRetired()
+{
+    const quint64 active = m_activeGeneration.load(std::memory_order_acquire);
+
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(),
+                                   [active](const RetiredEntry& entry) {
+                                       return entry.generation <= active;
+                                   }),
+                    m_retired.end());
+}
+
+const AudioDSPGraph::CompiledPlan& AudioDSPGraph::acquirePlan()
+{
+    if (m_planBuffer.consume()) {
+        m_activeGeneration.store(m_planBuffer.readBuffer().generation, std::memory_order_release);
+    }
+    return m_planBuffer.readBuffer();
+}
+
+void AudioDSPGraph::runPlan(const CompiledPlan& plan, AudioBlock& block)
+{
+    for (int i = 0; i < plan.nodeCount; ++i) {
+        AudioDSPNode* node = plan.nodes[i];
+        if (!node->isBypassed()) {
+            node->process(block);
+        }
+    }
+}
+
+void AudioDSPGraph::process(float* left, float* right, int frames, int sampleRate)
+{
+    if (!left || frames <= 0) {
+        return;
+    }
+
+    ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Audio);
+
+    const CompiledPlan& plan = acquirePlan();
+    if (plan.nodeCount == 0) {
+        return;
+    }
+
+    if (!right) {
+        right = left;
+    }
+
+    AudioBlock block;
+    block.channelCount = (right == left) ? 1 : 2;
+    block.sampleRate = sampleRate;
+
+    for (int offset = 0; offset < frames; offset += MAX_BLOCK_FRAMES) {
+        block.frames = qMin(MAX_BLOCK_FRAMES, frames - offset);
+        block.channels[0] = left + offset;
+        block.channels[1] = right + offset;
+        runPlan(plan, block);
+    }
+}
+
+int AudioDSPGraph::render(float* interleavedOutput, int frames)
+{
+    if (!interleavedOutput || frames <= 0) {
+        return 0;
+    }
+
+    ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Audio);
+
+    const qint64 now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // A new schedule drops whatever was pulled for the old position
+    const qint64 scheduled = m_scheduledStartNs.exchange(0, std::memory_order_acquire);
+    if (scheduled != 0) {
+        m_startNs = scheduled;
+        m_waitingForStart = true;
+        m_inputOffset = m_inputFrames;
+        m_outputOffset = m_outputFrames;
+        m_driftCorrector.reset();
+    }
+
+    const CompiledPlan& plan = acquirePlan();
+    RenderPosition& position = m_renderPosition.writeBuffer();
+    position.timestampNs = now;
+
+    // Silence up to the output frame the start falls on
+    int offset = 0;
+    if (m_waitingForStart) {
+        const int sampleRate = qMax(1, m_scheduledSampleRate.load(std::memory_order_relaxed));
+        const qint64 lead = (m_startNs - now) * sampleRate / 1000000000;
+        if (lead >= frames) {
+            std::memset(interleavedOutput, 0, sizeof(float) * frames * 2);
+            position.seconds = 0.0;
+            position.started = false;
+            m_renderPosition.publish();
+            return frames;
+        }
+
+        offset = static_cast<int>(qMax<qint64>(0, lead));
+        std::memset(interleavedOutput, 0, sizeof(float) * offset * 2);
+        m_waitingForStart = false;
+        m_renderSeconds = -static_cast<double>(offset) / sampleRate;
+    }
+
+    position.seconds = m_renderSeconds;
+    position.started = !m_waitingForStart;
+    m_renderPosition.publish();
+
+    int produced = 0;
+    if (plan.source && *plan.source) {
+        produced = renderFrames(plan, interleavedOutput + offset * 2, frames - offset);
+    }
+
+    if (offset + produced < frames) {
+        std::memset(interleavedOutput + (offset + produced) * 2, 0, sizeof(float) * (frames - offset - produced) * 2);
+    }
+
+    return produced > 0 ? offset + produced : 0;
+}
+
+int AudioDSPGraph::renderFrames(const CompiledPlan& plan, float* interleavedOutput, int frames)
+{
+    const double trim = m_rateTrim.load(std::memory_order_relaxed);
+    if (!m_driftCorrecting && trim != 1.0) {
+        m_driftCorrecting = true;
+        m_driftCorrector.reset();
+    }
+    if (m_driftCorrecting) {
+        m_driftCorrector.setRatio(trim);
+    }
+
+    int produced = 0;
+
+    while (produced < frames) {
+        if (m_outputOffset >= m_outputFrames && !renderBlock(plan, frames - produced)) {
+            break;
+        }
+
+        const int available = m_outputFrames - m_outputOffset;
+        float* out = interleavedOutput + produced * 2;
+        int count = 0;
+        int consumed = 0;
+        if (m_driftCorrecting) {
+            count = m_driftCorrector.process(m_outputLeft + m_outputOffset, m_outputRight + m_outputOffset,
+                                             available, out, frames - produced, &consumed);
+        } else {
+            count = consumed = qMin(available, frames - produced);
+            AudioKernels::interleave(m_outputLeft + m_outputOffset, m_outputRight + m_outputOffset, out, count);
+        }
+        m_outputOffset += consumed;
+        m_renderSeconds += static_cast<double>(consumed) / m_outputSampleRate;
+        produced += count;
+    }
+
+    return produced;
+}
+
+bool AudioDSPGraph::renderBlock(const CompiledPlan& plan, int wanted)
+{
+    const int internalRate = plan.internalSampleRate;
+    bool resampling = internalRate > 0 && m_sourceSampleRate != internalRate;
+
+    // Pull the next source block once the previous one is used up. While
+    // resampling the output count is not tied to the request, so pull whole
+    // blocks and keep what does not fit for the next call.
+    if (m_inputOffset >= m_inputFrames) {
+        AudioBlock source;
+        source.channels[0] = m_renderLeft;
+        source.channels[1] = m_renderRight;
+        source.channelCount = 2;
+        source.frames = resampling ? MAX_BLOCK_FRAMES : qMin(MAX_BLOCK_FRAMES, wanted);
+        source.sampleRate = m_sourceSampleRate;
+
+        const int got = qBound(0, (*plan.source)(source), source.frames);
+        if (got == 0) {
+            return false;
+        }
+
+        // Filter history from another stream would leak into this one
+        if (source.sampleRate != m_sourceSampleRate) {
+            m_resampler.reset();
+        }
+
+        m_inputOffset = 0;
+        m_inputFrames = got;
+        m_sourceSampleRate = source.sampleRate;
+        resampling = internalRate > 0 && m_sourceSampleRate != internalRate;
+    }
+
+    AudioBlock block;
+    block.channelCount = 2;
+
+    if (!resampling) {
+        block.channels[0] = m_renderLeft + m_inputOffset;
+        block.channels[1] = m_renderRight + m_inputOffset;
+        block.frames = m_inputFrames - m_inputOffset;
+        block.sampleRate = m_sourceSampleRate;
+        m_inputOffset = m_inputFrames;
+    } else {
+        if (m_resamplerInputRate != m_sourceSampleRate || m_resamplerOutputRate != internalRate) {
+            adoptResampler(m_sourceSampleRate, internalRate);
+        }
+
+        // Unsupported ratios play at the source rate rather than not at all
+        if (!m_resampler.isConfigured()) {
+            block.channels[0] = m_renderLeft + m_inputOffset;
+            block.channels[1] = m_renderRight + m_inputOffset;
+            block.frames = m_inputFrames - m_inputOffset;
+            block.sampleRate = m_sourceSampleRate;
+            m_inputOffset = m_inputFrames;
+        } else {
+            const int input = qMin(m_inputFrames - m_inputOffset, m_resampler.maxInputFrames(MAX_BLOCK_FRAMES));
+            block.channels[0] = m_resampledLeft;
+            block.channels[1] = m_resampledRight;
+            block.frames = m_resampler.process(m_renderLeft + m_inputOffset, m_renderRight + m_inputOffset, input,
+                                               m_resampledLeft, m_resampledRight);
+            block.sampleRate = internalRate;
+            m_inputOffset += input;
+        }
+    }
+
+    if (block.frames > 0) {
+        runPlan(plan, block);
+    }
+
+    m_outputLeft = block.channels[0];
+    m_outputRight = block.channels[1];
+    m_outputOffset = 0;
+    m_outputFrames = block.frames;
+    m_outputSampleRate = block.sampleRate;
+    return true;
+}
+
+void AudioDSPGraph::adoptResampler(int inputRate, int outputRate)
+{
+    // Recorded even if the ratio turns out unsupported, to try only once
+    m_resamplerInputRate = inputRate;
+    m_resamplerOutputRate = outputRate;
+
+    m_preparedResampler.consume();
+    const PreparedResampler& prepared = m_preparedResampler.readBuffer();
+    if (prepared.bank && prepared.bank->inputRate == inputRate && prepared.bank->outputRate == outputRate) {
+        m_resampler.setFilterBank(prepared.bank);
+        return;
+    }
+
+    // Unprepared rate change: look the bank up, building it if needed
+    m_resampler.setRates(inputRate, outputRate);
+    BreadcrumbRing::instance().record(BreadcrumbRing::Audio, "dsp.resampler.unprepared", inputRate);
+}
+
+// Adapter nodes
+
+EqualizerNode::EqualizerNode(std::shared_ptr<AudioEqualizer> equalizer)
+    : m_equalizer(std::move(equalizer))
+{
+}
+
+QString EqualizerNode::name() const
+{
+    return QStringLiteral("Equalizer");
+}
+
+void EqualizerNode::prepare(int sampleRate, int maxFrames)
+{
+    Q_UNUSED(maxFrames)
+    if (m_equalizer) {
+        m_equalizer->prepareForSampleRate(sampleRate);
+    }
+}
+
+void EqualizerNode::process(AudioBlock& block)
+{
+    if (m_equalizer) {
+        m_equalizer->processBlock(block.channels[0], block.channels[block.channelCount > 1 ? 1 : 0],
+                                  block.frames, block.sampleRate);
+    }
+}
+
+AdvancedProcessorNode::AdvancedProcessorNode(std::shared_ptr<AdvancedAudioProcessor> processor)
+    : m_processor(std::move(processor))
+{
+}
+
+QString AdvancedProcessorNode::name() const
+{
+    return QStringLiteral("Advanced Processor");
+}
+
+void AdvancedProcessorNode::prepare(int sampleRate, int maxFrames)
+{
+    Q_UNUSED(maxFrames)
+    if (m_processor) {
+        m_processor->prepareForSampleRate(sampleRate);
+    }
+}
+
+void AdvancedProcessorNode::process(AudioBlock& block)
+{
+    if (m_processor) {
+        m_processor->processAdvancedBlock(block.channels[0], block.channels[block.channelCount > 1 ? 1 : 0],
+                                          block.frames, block.sampleRate);
+    }
+}
+
+KaraokeNode::KaraokeNode(std::shared_ptr<AudioProcessor> processor)
+    : m_processor(std::move(processor))
+{
+}
+
+QString KaraokeNode::name() const
+{
+    return QStringLiteral("Karaoke");
+}
+
+void KaraokeNode::process(AudioBlock& block)
+{
+    // Vocal removal needs two distinct channels
+    if (m_processor && block.channelCount > 1) {
+        m_processor->processKaraokeBlock(block.channels[0], block.channels[1], block.frames, block.sampleRate);
+    }
+}
+
+SpatialSoundNode::SpatialSoundNode(std::shared_ptr<AudioOutputManager> outputManager)
+    : m_outputManager(std::move(outputManager))
+{
+}
+
+QString SpatialSoundNode::name() const
+{
+    return QStringLiteral("Spatial Sound");
+}
+
+void SpatialSoundNode::prepare(int sampleRate, int maxFrames)
+{
+    Q_UNUSED(maxFrames)
+    if (m_outputManager) {
+        m_outputManager->prepareForSampleRate(sampleRate);
+    }
+}
+
+void SpatialSoundNode::process(AudioBlock& block)
+{
+    if (m_outputManager && block.channelCount > 1) {
+        m_outputManager->processSpatialBlock(block.channels[0], block.channels[1],
+                                             block.frames, block.sampleRate);
+    }
+}
@@ -1,5 +1,7 @@
 #include "audio/AudioEqualizer.h"
+#include "audio/AudioKernels.h"
 #include "audio/AudioProcessor.h"
+#include "audio/FFTEngine.h"
 #include <QStandardPaths>
 #include <QDir>
 #include <QJsonDocument>
@@ -11,6 +13,7 @@
 #include <QMutexLocker>
 #include <algorithm>
 #include <complex>
+#include <iterator>
 
 Q_DECLARE_LOGGING_CATEGORY(audioEqualizer)
 Q_LOGGING_CATEGORY(audioEqualizer, "audio.equalizer")
@@ -28,7 +31,12 @@ AudioEqualizer::AudioEqualizer(QObject* parent)
     , m_replayGainPreamp(0.0)
     , m_audioProcessor(nullptr)
     , m_sampleRate(44100)
+    , m_smoothedBroadbandGain(1.0f)
 {
+    std::fill(std::begin(m_smoothedGains), std::end(m_smoothedGains), 0.0);
+    std::fill(std::begin(m_appliedFrequencies), std::end(m_appliedFrequencies), 0.0);
+    std::fill(std::begin(m_appliedBandwidths), std::end(m_appliedBandwidths), 0.0);
+    
     // Initialize settings
     QString configPath = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
     QDir().mkpath(configPath);
@@ -50,7 +58,6 @@ bool AudioEqualizer::initialize(AudioProcessor* audioProcessor)
     m_audioProcessor = audioProcessor;
     
     loadSettings();
-    initializeFilters(m_sampleRate);
     applyEqualizerSettings();
     
     qCDebug(audioEqualizer) << "AudioEqualizer initialized with" << m_bands.size() << "bands";
@@ -368,6 +375,14 @@ void AudioEqualizer::setReplayGainPreamp(double preamp)
     }
 }
 
+void AudioEqualizer::setReplayGainInfo(const ReplayGainInfo& info)
+{
+    m_replayGainInfo = info;
+    if (m_replayGainEnabled) {
+        applyEqualizerSettings();
+    }
+}
+
 void AudioEqualizer::saveSettings()
 {
     if (!m_settings) {
@@ -589,8 +604,49 @@ bool AudioEqualizer::importSettings(const QString& filePath)
 
 void AudioEqualizer::applyEqualizerSettings()
 {
-    // TODO: Apply equalizer settings to audio engine
-    // This would integrate with the VLC backend or audio processing pipeline
+    // Publish a complete parameter snapshot for the audio thread. Only
+    // publishers serialize on m_publishMutex; processAudio() picks the
+    // snapshot up at its next block boundary without locking.
+    QMutexLocker locker(&m_publishMutex);
+    
+    ProcessingParameters& params = m_parameterBuffer.writeBuffer();
+    params.enabled = m_enabled;
+    params.bandCount = qMin(static_cast<int>(m_bands.size()), static_cast<int>(BiquadCascade::MAX_STAGES));
+    for (int i = 0; i < params.bandCount; ++i) {
+        params.frequencies[i] = m_bands[i].frequency;
+        params.gains[i] = m_bands[i].gain;
+        params.bandwidths[i] = m_bands[i].bandwidth;
+    }
+    
+    // Bass boost, treble enhancement and ReplayGain are broadband gains
+    float broadbandGain = 1.0f;
+    if (m_bassBoost > 0.0) {
+        float bassGain = qPow(10.0f, static_cast<float>(m_bassBoost) / 20.0f);
+        broadbandGain *= (1.0f + (bassGain - 1.0f) * 0.3f);
+    }
+    if (m_trebleEnhancement > 0.0) {
+        float trebleGain = qPow(10.0f, static_cast<float>(m_trebleEnhancement) / 20.0f);
+        broadbandGain *= (1.0f + (trebleGain - 1.0f) * 0.2f);
+    }
+    if (m_replayGainEnabled) {
+        // Album mode falls back to the track gain for tracks without an album
+        const bool useAlbum = m_replayGainMode == "album" && m_replayGainInfo.hasAlbumGain;
+        const bool hasGain = useAlbum || m_replayGainInfo.hasTrackGain;
+        const double gain = useAlbum ? m_replayGainInfo.albumGain : m_replayGainInfo.trackGain;
+        const double peak = useAlbum ? m_replayGainInfo.albumPeak : m_replayGainInfo.trackPeak;
+
+        double replayGain = qPow(10.0, (m_replayGainPreamp + (hasGain ? gain : 0.0)) / 20.0);
+        if (hasGain && peak > 0.0) {
+            replayGain = qMin(replayGain, 1.0 / peak);
+        }
+        broadbandGain *= static_cast<float>(replayGain);
+    }
+    params.broadbandGain = broadbandGain;
+    
+    params.surroundEnabled = m_3dSurroundEnabled;
+    params.surroundStrength = static_cast<float>(m_3dSurroundStrength);
+    
+    m_parameterBuffer.publish();
     
     qCDebug(audioEqualizer) << "Equalizer settings applied - enabled:" << m_enabled
                            << "preset:" << getPresetName(m_currentPreset)
@@ -605,73 +661,94 @@ void AudioEqualizer::clampGainValue(double& gain) const
 
 void AudioEqualizer::processAudio(QVector<float>& leftChannel, QVector<float>& rightChannel, int sampleRate)
 {
-    if (!m_enabled || leftChannel.isEmpty()) {
+    if (leftChannel.isEmpty()) {
         return;
     }
     
-    QMutexLocker locker(&m_processingMutex);
-    
-    // Update sample rate if changed
-    if (m_sampleRate != sampleRate) {
-        m_sampleRate = sampleRate;
-        initializeFilters(sampleRate);
-    }
-    
     // Ensure we have a right channel for stereo processing
     if (rightChannel.isEmpty()) {
         rightChannel = leftChannel;
     }
     
-    // Process each sample through all EQ bands
-    for (int i = 0; i < leftChannel.size(); ++i) {
-        float leftSample = leftChannel[i];
-        float rightSample = rightChannel[i];
-        
-        // Apply EQ bands
-        for (int band = 0; band < m_bands.size(); ++band) {
-            leftSample = processSample(leftSample, 0, band);
-            rightSample = processSample(rightSample, 1, band);
-        }
-        
-        leftChannel[i] = leftSample;
-        rightChannel[i] = rightSample;
+    processBlock(leftChannel.data(), rightChannel.data(),
+                 qMin(leftChannel.size(), rightChannel.size()), sampleRate);
+}
+
+void AudioEqualizer::processBlock(float* left, float* right, int frames, int sampleRate)
+{
+    // Pick up the latest snapshot published by the UI thread, if any
+    if (m_parameterBuffer.consume()) {
+        m_activeParameters = m_parameterBuffer.readBuffer();
     }
     
-    // Apply bass boost (enhance low frequencies)
-    if (m_bassBoost > 0.0) {
-        float bassGain = qPow(10.0f, m_bassBoost / 20.0f);
-        for (int i = 0; i < leftChannel.size(); ++i) {
-            // Simple bass boost by amplifying low-frequency content
-            leftChannel[i] *= (1.0f + (bassGain - 1.0f) * 0.3f);
-            rightChannel[i] *= (1.0f + (bassGain - 1.0f) * 0.3f);
+    const ProcessingParameters& params = m_activeParameters;
+    if (!params.enabled || frames <= 0) {
+        return;
+    }
+    
+    // Reconfigure the cascade if the sample rate or band layout changed
+    if (m_sampleRate != sampleRate || m_cascade.stageCount() != params.bandCount) {
+        const bool adopted = adoptPreparedFilters(sampleRate, params.bandCount);
+        m_sampleRate = sampleRate;
+        if (!adopted) {
+            initializeFilters(sampleRate);
         }
     }
     
-    // Apply treble enhancement (enhance high frequencies)
-    if (m_trebleEnhancement > 0.0) {
-        float trebleGain = qPow(10.0f, m_trebleEnhancement / 20.0f);
-        for (int i = 0; i < leftChannel.size(); ++i) {
-            // Simple treble enhancement
-            leftChannel[i] *= (1.0f + (trebleGain - 1.0f) * 0.2f);
-            rightChannel[i] *= (1.0f + (trebleGain - 1.0f) * 0.2f);
+    // Run the cascade in short blocks, moving band gains and the broadband
+    // gain towards their targets between blocks to avoid zipper noise
+    for (int offset = 0; offset < frames; offset += SMOOTHING_BLOCK_SIZE) {
+        const int count = qMin(static_cast<int>(SMOOTHING_BLOCK_SIZE), frames - offset);
+        
+        smoothBandGains();
+        m_cascade.process(left + offset, right + offset, count);
+        
+        float startGain = m_smoothedBroadbandGain;
+        float endGain = params.broadbandGain;
+        if (qAbs(endGain - startGain) > 1e-4f) {
+            endGain = startGain + (endGain - startGain) * static_cast<float>(SMOOTHING_COEFFICIENT);
         }
+        
+        if (startGain != 1.0f || endGain != 1.0f) {
+            AudioKernels::applyGainRamp(left + offset, count, startGain, endGain);
+            AudioKernels::applyGainRamp(right + offset, count, startGain, endGain);
+        }
+        m_smoothedBroadbandGain = endGain;
     }
     
     // Apply 3D surround sound
-    if (m_3dSurroundEnabled) {
-        apply3DSurround(leftChannel, rightChannel);
+    if (params.surroundEnabled) {
+        apply3DSurround(left, right, frames, params.surroundStrength);
+    }
+}
+
+void AudioEqualizer::prepareForSampleRate(int sampleRate)
+{
+    if (sampleRate <= 0) {
+        return;
     }
     
-    // Apply ReplayGain
-    if (m_replayGainEnabled && m_replayGainPreamp != 0.0) {
-        applyReplayGain(leftChannel, rightChannel, m_replayGainPreamp);
+    QMutexLocker locker(&m_publishMutex);
+    
+    PreparedFilters& prepared = m_preparedFilters.writeBuffer();
+    prepared.sampleRate = sampleRate;
+    prepared.bandCount = qMin(static_cast<int>(m_bands.size()), static_cast<int>(BiquadCascade::MAX_STAGES));
+    prepared.cascade.setStageCount(prepared.bandCount);
+    for (int band = 0; band < prepared.bandCount; ++band) {
+        prepared.frequencies[band] = m_bands[band].frequency;
+        prepared.gains[band] = m_bands[band].gain;
+        prepared.bandwidths[band] = m_bands[band].bandwidth;
+        prepared.cascade.setPeakingEQ(band, sampleRate, prepared.frequencies[band],
+                                      prepared.gains[band], prepared.bandwidths[band]);
     }
+    
+    m_preparedFilters.publish();
+    
+    qCDebug(audioEqualizer) << "Filters prepared for sample rate:" << sampleRate;
 }
 
 double AudioEqualizer::getFrequencyResponse(double frequency) const
 {
-    QMutexLocker locker(&m_processingMutex);
-    
     double totalGain = 0.0;
     
     // Calculate combined response from all bands
@@ -704,7 +781,7 @@ QVector<double> AudioEqualizer::analyzeAndSuggestEQ(const QVector<float>& leftCh
     // Analyze each frequency band
     for (int i = 0; i < m_bands.size(); ++i) {
         double targetFreq = m_bands[i].frequency;
-        int binIndex = static_cast<int>((targetFreq * leftChannel.size()) / sampleRate);
+        int binIndex = static_cast<int>((targetFreq * ANALYSIS_FFT_SIZE) / sampleRate);
         
         if (binIndex < magnitude.size()) {
             double level = magnitude[binIndex];
@@ -724,123 +801,128 @@ QVector<double> AudioEqualizer::analyzeAndSuggestEQ(const QVector<float>& leftCh
 
 void AudioEqualizer::initializeFilters(int sampleRate)
 {
-    m_filterStates.clear();
-    m_filterStates.resize(m_bands.size());
+    const ProcessingParameters& params = m_activeParameters;
     
-    for (int band = 0; band < m_bands.size(); ++band) {
-        m_filterStates[band].resize(MAX_CHANNELS);
-        updateFilterCoefficients(band, m_bands[band].frequency, m_bands[band].gain, m_bands[band].bandwidth);
+    m_cascade.setStageCount(params.bandCount);
+    m_cascade.reset();
+    
+    // Start from the target values; smoothing only applies to later changes
+    for (int band = 0; band < params.bandCount; ++band) {
+        m_smoothedGains[band] = params.gains[band];
+        m_appliedFrequencies[band] = params.frequencies[band];
+        m_appliedBandwidths[band] = params.bandwidths[band];
+        updateFilterCoefficients(band, params.frequencies[band], params.gains[band], params.bandwidths[band]);
     }
+    m_smoothedBroadbandGain = params.broadbandGain;
     
-    qCDebug(audioEqualizer) << "Filters initialized for sample rate:" << sampleRate;
+    qCDebug(audioEqualizer) << "Filters initialized for sample rate:" << sampleRate
+                           << "backend:" << BiquadCascade::simdBackend();
 }
 
-float AudioEqualizer::processSample(float sample, int channel, int bandIndex)
+bool AudioEqualizer::adoptPreparedFilters(int sampleRate, int bandCount)
 {
-    if (bandIndex >= m_filterStates.size() || channel >= MAX_CHANNELS) {
-        return sample;
+    m_preparedFilters.consume();
+    const PreparedFilters& prepared = m_preparedFilters.readBuffer();
+    if (prepared.sampleRate != sampleRate || prepared.bandCount != bandCount) {
+        return false;
     }
     
-    FilterState& state = m_filterStates[bandIndex][channel];
+    // Bands changed since preparation are smoothed towards their targets
+    m_cascade.copyCoefficients(prepared.cascade);
     
-    // Biquad filter processing
-    float output = state.b0 * sample + state.b1 * state.x1 + state.b2 * state.x2
-                  - state.a1 * state.y1 - state.a2 * state.y2;
-    
-    // Update delay line
-    state.x2 = state.x1;
-    state.x1 = sample;
-    state.y2 = state.y1;
-    state.y1 = output;
-    
-    return output;
+    // State built up at another rate does not belong to the new filters
+    if (sampleRate != m_sampleRate) {
+        m_cascade.reset();
+    }
+    for (int band = 0; band < bandCount; ++band) {
+        m_smoothedGains[band] = prepared.gains[band];
+        m_appliedFrequencies[band] = prepared.frequencies[band];
+        m_appliedBandwidths[band] = prepared.bandwidths[band];
+    }
+    return true;
 }
 
 void AudioEqualizer::updateFilterCoefficients(int bandIndex, double frequency, double gain, double q)
 {
-    if (bandIndex >= m_filterStates.size()) {
+    if (bandIndex >= m_cascade.stageCount()) {
         return;
     }
     
-    // Calculate biquad coefficients for peaking EQ filter
-    double A = qPow(10.0, gain / 40.0);
-    double omega = 2.0 * PI * frequency / m_sampleRate;
-    double sinOmega = qSin(omega);
-    double cosOmega = qCos(omega);
-    double alpha = sinOmega / (2.0 * q);
-    
-    double b0 = 1.0 + alpha * A;
-    double b1 = -2.0 * cosOmega;
-    double b2 = 1.0 - alpha * A;
-    double a0 = 1.0 + alpha / A;
-    double a1 = -2.0 * cosOmega;
-    double a2 = 1.0 - alpha / A;
-    
-    // Normalize coefficients
-    for (int channel = 0; channel < MAX_CHANNELS; ++channel) {
-        FilterState& state = m_filterStates[bandIndex][channel];
-        state.b0 = b0 / a0;
-        state.b1 = b1 / a0;
-        state.b2 = b2 / a0;
-        state.a1 = a1 / a0;
-        state.a2 = a2 / a0;
-    }
+    // Peaking EQ biquad, normalized inside the cascade
+    m_cascade.setPeakingEQ(bandIndex, m_sampleRate, frequency, gain, q);
 }
 
-void AudioEqualizer::apply3DSurround(QVector<float>& leftChannel, QVector<float>& rightChannel)
+void AudioEqualizer::smoothBandGains()
 {
-    float strength = static_cast<float>(m_3dSurroundStrength);
-    float crossfeed = m_surroundState.crossfeedGain * strength;
+    const ProcessingParameters& params = m_activeParameters;
     
-    for (int i = 0; i < leftChannel.size(); ++i) {
-        float left = leftChannel[i];
-        float right = rightChannel[i];
+    for (int band = 0; band < params.bandCount; ++band) {
+        const double target = params.gains[band];
+        double current = m_smoothedGains[band];
+        const bool shapeChanged = m_appliedFrequencies[band] != params.frequencies[band] ||
+                                  m_appliedBandwidths[band] != params.bandwidths[band];
         
-        // Apply crossfeed and delay for 3D effect
-        float delayedLeft = m_surroundState.delayLineL[m_surroundState.delayIndex];
-        float delayedRight = m_surroundState.delayLineR[m_surroundState.delayIndex];
-        
-        // Store current samples in delay line
-        m_surroundState.delayLineL[m_surroundState.delayIndex] = left;
-        m_surroundState.delayLineR[m_surroundState.delayIndex] = right;
+        if (current == target && !shapeChanged) {
+            continue;
+        }
         
-        // Apply 3D surround processing
-        leftChannel[i] = left + delayedRight * crossfeed;
-        rightChannel[i] = right + delayedLeft * crossfeed;
+        // One-pole approach in the dB domain, snapping once inaudible
+        current += (target - current) * SMOOTHING_COEFFICIENT;
+        if (qAbs(target - current) < SMOOTHING_EPSILON_DB) {
+            current = target;
+        }
         
-        // Update delay index
-        m_surroundState.delayIndex = (m_surroundState.delayIndex + 1) % 1024;
+        m_smoothedGains[band] = current;
+        m_appliedFrequencies[band] = params.frequencies[band];
+        m_appliedBandwidths[band] = params.bandwidths[band];
+        updateFilterCoefficients(band, params.frequencies[band], current, params.bandwidths[band]);
     }
 }
 
-void AudioEqualizer::applyReplayGain(QVector<float>& leftChannel, QVector<float>& rightChannel, double gain)
+void AudioEqualizer::apply3DSurround(float* left, float* right, int frames, float strength)
 {
-    float gainLinear = qPow(10.0f, static_cast<float>(gain) / 20.0f);
+    constexpr int SCRATCH_FRAMES = 256;
+    const int delayLength = static_cast<int>(std::size(m_surroundState.delayLineL));
+    const float crossfeed = m_surroundState.crossfeedGain * strength;
+    float delayedLeft[SCRATCH_FRAMES];
+    float delayedRight[SCRATCH_FRAMES];
     
-    for (int i = 0; i < leftChannel.size(); ++i) {
-        leftChannel[i] *= gainLinear;
-        rightChannel[i] *= gainLinear;
+    // Runs that neither wrap the delay line nor overflow the scratch buffers
+    for (int offset = 0; offset < frames;) {
+        const int index = m_surroundState.delayIndex;
+        const int count = qMin(qMin(frames - offset, delayLength - index), SCRATCH_FRAMES);
+        
+        // Trade the delayed samples for the current ones
+        std::copy_n(m_surroundState.delayLineL + index, count, delayedLeft);
+        std::copy_n(m_surroundState.delayLineR + index, count, delayedRight);
+        std::copy_n(left + offset, count, m_surroundState.delayLineL + index);
+        std::copy_n(right + offset, count, m_surroundState.delayLineR + index);
+        
+        // Apply crossfeed and delay for 3D effect
+        AudioKernels::mixInto(left + offset, delayedRight, count, crossfeed);
+        AudioKernels::mixInto(right + offset, delayedLeft, count, crossfeed);
+        
+        m_surroundState.delayIndex = (index + count) % delayLength;
+        offset += count;
     }
 }
 
 void AudioEqualizer::performFFT(const QVector<float>& input, QVector<float>& magnitude, QVector<float>& phase) const
 {
-    int N = input.size();
-    magnitude.resize(N / 2);
-    phase.resize(N / 2);
+    const FFTEngine& engine = FFTEngine::forSize<ANALYSIS_FFT_SIZE>();
     
-    // Simple DFT implementation (for demonstration - would use FFTW in production)
-    for (int k = 0; k < N / 2; ++k) {
-        std::complex<double> sum(0.0, 0.0);
-        
-        for (int n = 0; n < N; ++n) {
-            double angle = -2.0 * PI * k * n / N;
-            std::complex<double> w(qCos(angle), qSin(angle));
-            sum += static_cast<double>(input[n]) * w;
-        }
-        
-        magnitude[k] = static_cast<float>(std::abs(sum));
-        phase[k] = static_cast<float>(std::arg(sum));
+    QVector<std::complex<float>> spectrum;
+    engine.forward(input, spectrum);
+    
+    // Report per-bin amplitude (2/N) so levels are comparable with RMS
+    const int bins = ANALYSIS_FFT_SIZE / 2;
+    const float scale = 2.0f / ANALYSIS_FFT_SIZE;
+    magnitude.resize(bins);
+    phase.resize(bins);
+    
+    for (int k = 0; k < bins; ++k) {
+        magnitude[k] = std::abs(spectrum[k]) * scale;
+        phase[k] = std::arg(spectrum[k]);
     }
 }
 
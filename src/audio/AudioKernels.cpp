@@ -0,0 +1,706 @@
+#include "audio/AudioKernels.h"
+#include <QLoggingCategory>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EONPLAY_KERNELS_SSE2
+#include <emmintrin.h>
+// AVX2 versions are compiled per function and only called after CPUID
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(_MSC_VER)
+#define EONPLAY_KERNELS_AVX2
+#define EONPLAY_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && !defined(__clang__)
+#define EONPLAY_KERNELS_AVX2
+#define EONPLAY_AVX2_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define EONPLAY_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+Q_LOGGING_CATEGORY(audioKernels, "audio.kernels")
+
+namespace AudioKernels {
+
+namespace {
+
+constexpr float SOFT_CLIP_KNEE = 1.5f;
+constexpr float SOFT_CLIP_CUBIC = 4.0f / 27.0f;     // x - c * x^3 is flat at the knee
+
+struct KernelTable {
+    InstructionSet instructionSet;
+    void (*gain)(float*, int, float);
+    void (*gainRamp)(float*, int, float, float);
+    void (*mix)(float*, const float*, int, float);
+    void (*midSideEncode)(float*, float*, int);
+    void (*midSideDecode)(float*, float*, int);
+    double (*sumOfSquares)(const float*, int);
+    float (*peakAbsolute)(const float*, int);
+    void (*clamp)(float*, int, float);
+    void (*softClip)(float*, int);
+    void (*interleave)(const float*, const float*, float*, int);
+    void (*deinterleave)(const float*, float*, float*, int);
+};
+
+// Scalar versions, also the tails of the vector ones
+
+void gainScalar(float* samples, int count, float gain)
+{
+    for (int i = 0; i < count; ++i) {
+        samples[i] *= gain;
+    }
+}
+
+void gainRampScalar(float* samples, int count, float startGain, float step)
+{
+    for (int i = 0; i < count; ++i) {
+        samples[i] *= startGain + step * (i + 1);
+    }
+}
+
+void mixScalar(float* destination, const float* source, int count, float gain)
+{
+    for (int i = 0; i < count; ++i) {
+        destination[i] += source[i] * gain;
+    }
+}
+
+void midSideEncodeScalar(float* left, float* right, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        const float l = left[i];
+        const float r = right[i];
+        left[i] = (l + r) * 0.5f;
+        right[i] = (l - r) * 0.5f;
+    }
+}
+
+void midSideDecodeScalar(float* mid, float* side, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        const float m = mid[i];
+        const float s = side[i];
+        mid[i] = m + s;
+        side[i] = m - s;
+    }
+}
+
+double sumOfSquaresScalar(const float* samples, int count)
+{
+    double sum = 0.0;
+    for (int i = 0; i < count; ++i) {
+        sum += static_cast<double>(samples[i]) * samples[i];
+    }
+    return sum;
+}
+
+float peakAbsoluteScalar(const float* samples, int count)
+{
+    float peak = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        peak = std::max(peak, std::fabs(samples[i]));
+    }
+    return peak;
+}
+
+void clampScalar(float* samples, int count, float limit)
+{
+    for (int i = 0; i < count; ++i) {
+        samples[i] = std::min(std::max(samples[i], -limit), limit);
+    }
+}
+
+void softClipScalar(float* samples, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        const float x = std::min(std::max(samples[i], -SOFT_CLIP_KNEE), SOFT_CLIP_KNEE);
+        samples[i] = x - SOFT_CLIP_CUBIC * (x * x * x);
+    }
+}
+
+void interleaveScalar(const float* left, const float* right, float* interleaved, int frames)
+{
+    for (int i = 0; i < frames; ++i) {
+        interleaved[i * 2] = left[i];
+        interleaved[i * 2 + 1] = right[i];
+    }
+}
+
+void deinterleaveScalar(const float* interleaved, float* left, float* right, int frames)
+{
+    for (int i = 0; i < frames; ++i) {
+        left[i] = interleaved[i * 2];
+        right[i] = interleaved[i * 2 + 1];
+    }
+}
+
+#if defined(EONPLAY_KERNELS_SSE2)
+
+float horizontalMax(__m128 v)
+{
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+void gainSSE2(float* samples, int count, float gain)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), g));
+    }
+    gainScalar(samples + i, count - i, gain);
+}
+
+void gainRampSSE2(float* samples, int count, float startGain, float step)
+{
+    const __m128 start = _mm_set1_ps(startGain);
+    const __m128 increment = _mm_set1_ps(step);
+    __m128i index = _mm_setr_epi32(1, 2, 3, 4);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 gain = _mm_add_ps(start, _mm_mul_ps(increment, _mm_cvtepi32_ps(index)));
+        _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), gain));
+        index = _mm_add_epi32(index, _mm_set1_epi32(4));
+    }
+    gainRampScalar(samples + i, count - i, startGain + step * i, step);
+}
+
+void mixSSE2(float* destination, const float* source, int count, float gain)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 mixed = _mm_add_ps(_mm_loadu_ps(destination + i), _mm_mul_ps(_mm_loadu_ps(source + i), g));
+        _mm_storeu_ps(destination + i, mixed);
+    }
+    mixScalar(destination + i, source + i, count - i, gain);
+}
+
+void midSideEncodeSSE2(float* left, float* right, int count)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 l = _mm_loadu_ps(left + i);
+        const __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(left + i, _mm_mul_ps(_mm_add_ps(l, r), half));
+        _mm_storeu_ps(right + i, _mm_mul_ps(_mm_sub_ps(l, r), half));
+    }
+    midSideEncodeScalar(left + i, right + i, count - i);
+}
+
+void midSideDecodeSSE2(float* mid, float* side, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 m = _mm_loadu_ps(mid + i);
+        const __m128 s = _mm_loadu_ps(side + i);
+        _mm_storeu_ps(mid + i, _mm_add_ps(m, s));
+        _mm_storeu_ps(side + i, _mm_sub_ps(m, s));
+    }
+    midSideDecodeScalar(mid + i, side + i, count - i);
+}
+
+double sumOfSquaresSSE2(const float* samples, int count)
+{
+    __m128d sumLow = _mm_setzero_pd();
+    __m128d sumHigh = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_loadu_ps(samples + i);
+        const __m128d low = _mm_cvtps_pd(x);
+        const __m128d high = _mm_cvtps_pd(_mm_movehl_ps(x, x));
+        sumLow = _mm_add_pd(sumLow, _mm_mul_pd(low, low));
+        sumHigh = _mm_add_pd(sumHigh, _mm_mul_pd(high, high));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sumLow, sumHigh));
+    return lanes[0] + lanes[1] + sumOfSquaresScalar(samples + i, count - i);
+}
+
+float peakAbsoluteSSE2(const float* samples, int count)
+{
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 peak = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        peak = _mm_max_ps(peak, _mm_and_ps(_mm_loadu_ps(samples + i), absMask));
+    }
+    return std::max(horizontalMax(peak), peakAbsoluteScalar(samples + i, count - i));
+}
+
+void clampSSE2(float* samples, int count, float limit)
+{
+    const __m128 low = _mm_set1_ps(-limit);
+    const __m128 high = _mm_set1_ps(limit);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(samples + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(samples + i), low), high));
+    }
+    clampScalar(samples + i, count - i, limit);
+}
+
+void softClipSSE2(float* samples, int count)
+{
+    const __m128 low = _mm_set1_ps(-SOFT_CLIP_KNEE);
+    const __m128 high = _mm_set1_ps(SOFT_CLIP_KNEE);
+    const __m128 cubic = _mm_set1_ps(SOFT_CLIP_CUBIC);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(samples + i), low), high);
+        const __m128 x3 = _mm_mul_ps(_mm_mul_ps(x, x), x);
+        _mm_storeu_ps(samples + i, _mm_sub_ps(x, _mm_mul_ps(cubic, x3)));
+    }
+    softClipScalar(samples + i, count - i);
+}
+
+void interleaveSSE2(const float* left, const float* right, float* interleaved, int frames)
+{
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        const __m128 l = _mm_loadu_ps(left + i);
+        const __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(interleaved + i * 2, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(interleaved + i * 2 + 4, _mm_unpackhi_ps(l, r));
+    }
+    interleaveScalar(left + i, right + i, interleaved + i * 2, frames - i);
+}
+
+void deinterleaveSSE2(const float* interleaved, float* left, float* right, int frames)
+{
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        const __m128 a = _mm_loadu_ps(interleaved + i * 2);
+        const __m128 b = _mm_loadu_ps(interleaved + i * 2 + 4);
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    deinterleaveScalar(interleaved + i * 2, left + i, right + i, frames - i);
+}
+
+#endif // EONPLAY_KERNELS_SSE2
+
+#if defined(EONPLAY_KERNELS_AVX2)
+
+bool cpuHasAvx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+
+    // AVX in the CPU and YMM state saved by the OS, then the AVX2 bit itself
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+    if (!osSavesYmm) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+EONPLAY_AVX2_TARGET void gainAVX2(float* samples, int count, float gain)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), g));
+    }
+    gainScalar(samples + i, count - i, gain);
+}
+
+EONPLAY_AVX2_TARGET void gainRampAVX2(float* samples, int count, float startGain, float step)
+{
+    const __m256 start = _mm256_set1_ps(startGain);
+    const __m256 increment = _mm256_set1_ps(step);
+    __m256i index = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 8);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 gain = _mm256_add_ps(start, _mm256_mul_ps(increment, _mm256_cvtepi32_ps(index)));
+        _mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), gain));
+        index = _mm256_add_epi32(index, _mm256_set1_epi32(8));
+    }
+    gainRampScalar(samples + i, count - i, startGain + step * i, step);
+}
+
+EONPLAY_AVX2_TARGET void mixAVX2(float* destination, const float* source, int count, float gain)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 mixed = _mm256_add_ps(_mm256_loadu_ps(destination + i),
+                                           _mm256_mul_ps(_mm256_loadu_ps(source + i), g));
+        _mm256_storeu_ps(destination + i, mixed);
+    }
+    mixScalar(destination + i, source + i, count - i, gain);
+}
+
+EONPLAY_AVX2_TARGET void midSideEncodeAVX2(float* left, float* right, int count)
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 l = _mm256_loadu_ps(left + i);
+        const __m256 r = _mm256_loadu_ps(right + i);
+        _mm256_storeu_ps(left + i, _mm256_mul_ps(_mm256_add_ps(l, r), half));
+        _mm256_storeu_ps(right + i, _mm256_mul_ps(_mm256_sub_ps(l, r), half));
+    }
+    midSideEncodeScalar(left + i, right + i, count - i);
+}
+
+EONPLAY_AVX2_TARGET void midSideDecodeAVX2(float* mid, float* side, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 m = _mm256_loadu_ps(mid + i);
+        const __m256 s = _mm256_loadu_ps(side + i);
+        _mm256_storeu_ps(mid + i, _mm256_add_ps(m, s));
+        _mm256_storeu_ps(side + i, _mm256_sub_ps(m, s));
+    }
+    midSideDecodeScalar(mid + i, side + i, count - i);
+}
+
+EONPLAY_AVX2_TARGET double sumOfSquaresAVX2(const float* samples, int count)
+{
+    __m256d sumLow = _mm256_setzero_pd();
+    __m256d sumHigh = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256d low = _mm256_cvtps_pd(_mm_loadu_ps(samples + i));
+        const __m256d high = _mm256_cvtps_pd(_mm_loadu_ps(samples + i + 4));
+        sumLow = _mm256_add_pd(sumLow, _mm256_mul_pd(low, low));
+        sumHigh = _mm256_add_pd(sumHigh, _mm256_mul_pd(high, high));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(sumLow, sumHigh));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sumOfSquaresScalar(samples + i, count - i);
+}
+
+EONPLAY_AVX2_TARGET float peakAbsoluteAVX2(const float* samples, int count)
+{
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 peak = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        peak = _mm256_max_ps(peak, _mm256_and_ps(_mm256_loadu_ps(samples + i), absMask));
+    }
+    const __m128 halves = _mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1));
+    return std::max(horizontalMax(halves), peakAbsoluteScalar(samples + i, count - i));
+}
+
+EONPLAY_AVX2_TARGET void clampAVX2(float* samples, int count, float limit)
+{
+    const __m256 low = _mm256_set1_ps(-limit);
+    const __m256 high = _mm256_set1_ps(limit);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(samples + i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(samples + i), low), high));
+    }
+    clampScalar(samples + i, count - i, limit);
+}
+
+EONPLAY_AVX2_TARGET void softClipAVX2(float* samples, int count)
+{
+    const __m256 low = _mm256_set1_ps(-SOFT_CLIP_KNEE);
+    const __m256 high = _mm256_set1_ps(SOFT_CLIP_KNEE);
+    const __m256 cubic = _mm256_set1_ps(SOFT_CLIP_CUBIC);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(samples + i), low), high);
+        const __m256 x3 = _mm256_mul_ps(_mm256_mul_ps(x, x), x);
+        _mm256_storeu_ps(samples + i, _mm256_sub_ps(x, _mm256_mul_ps(cubic, x3)));
+    }
+    softClipScalar(samples + i, count - i);
+}
+
+EONPLAY_AVX2_TARGET void interleaveAVX2(const float* left, const float* right, float* interleaved, int frames)
+{
+    int i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        // Unpacking works within 128-bit lanes, the permutes put the lanes in order
+        const __m256 l = _mm256_loadu_ps(left + i);
+        const __m256 r = _mm256_loadu_ps(right + i);
+        const __m256 low = _mm256_unpacklo_ps(l, r);
+        const __m256 high = _mm256_unpackhi_ps(l, r);
+        _mm256_storeu_ps(interleaved + i * 2, _mm256_permute2f128_ps(low, high, 0x20));
+        _mm256_storeu_ps(interleaved + i * 2 + 8, _mm256_permute2f128_ps(low, high, 0x31));
+    }
+    interleaveScalar(left + i, right + i, interleaved + i * 2, frames - i);
+}
+
+EONPLAY_AVX2_TARGET void deinterleaveAVX2(const float* interleaved, float* left, float* right, int frames)
+{
+    int i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        const __m256 a = _mm256_loadu_ps(interleaved + i * 2);
+        const __m256 b = _mm256_loadu_ps(interleaved + i * 2 + 8);
+        const __m256 low = _mm256_permute2f128_ps(a, b, 0x20);
+        const __m256 high = _mm256_permute2f128_ps(a, b, 0x31);
+        _mm256_storeu_ps(left + i, _mm256_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm256_storeu_ps(right + i, _mm256_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    deinterleaveScalar(interleaved + i * 2, left + i, right + i, frames - i);
+}
+
+#endif // EONPLAY_KERNELS_AVX2
+
+#if defined(EONPLAY_KERNELS_NEON)
+
+void gainNEON(float* samples, int count, float gain)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(samples + i, vmulq_n_f32(vld1q_f32(samples + i), gain));
+    }
+    gainScalar(samples + i, count - i, gain);
+}
+
+void gainRampNEON(float* samples, int count, float startGain, float step)
+{
+    static const int32_t firstIndices[4] = {1, 2, 3, 4};
+    const float32x4_t start = vdupq_n_f32(startGain);
+    int32x4_t index = vld1q_s32(firstIndices);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t gain = vaddq_f32(start, vmulq_n_f32(vcvtq_f32_s32(index), step));
+        vst1q_f32(samples + i, vmulq_f32(vld1q_f32(samples + i), gain));
+        index = vaddq_s32(index, vdupq_n_s32(4));
+    }
+    gainRampScalar(samples + i, count - i, startGain + step * i, step);
+}
+
+void mixNEON(float* destination, const float* source, int count, float gain)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(destination + i, vaddq_f32(vld1q_f32(destination + i), vmulq_n_f32(vld1q_f32(source + i), gain)));
+    }
+    mixScalar(destination + i, source + i, count - i, gain);
+}
+
+void midSideEncodeNEON(float* left, float* right, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t l = vld1q_f32(left + i);
+        const float32x4_t r = vld1q_f32(right + i);
+        vst1q_f32(left + i, vmulq_n_f32(vaddq_f32(l, r), 0.5f));
+        vst1q_f32(right + i, vmulq_n_f32(vsubq_f32(l, r), 0.5f));
+    }
+    midSideEncodeScalar(left + i, right + i, count - i);
+}
+
+void midSideDecodeNEON(float* mid, float* side, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t m = vld1q_f32(mid + i);
+        const float32x4_t s = vld1q_f32(side + i);
+        vst1q_f32(mid + i, vaddq_f32(m, s));
+        vst1q_f32(side + i, vsubq_f32(m, s));
+    }
+    midSideDecodeScalar(mid + i, side + i, count - i);
+}
+
+double sumOfSquaresNEON(const float* samples, int count)
+{
+    float64x2_t sumLow = vdupq_n_f64(0.0);
+    float64x2_t sumHigh = vdupq_n_f64(0.0);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t x = vld1q_f32(samples + i);
+        const float64x2_t low = vcvt_f64_f32(vget_low_f32(x));
+        const float64x2_t high = vcvt_high_f64_f32(x);
+        sumLow = vaddq_f64(sumLow, vmulq_f64(low, low));
+        sumHigh = vaddq_f64(sumHigh, vmulq_f64(high, high));
+    }
+    return vaddvq_f64(vaddq_f64(sumLow, sumHigh)) + sumOfSquaresScalar(samples + i, count - i);
+}
+
+float peakAbsoluteNEON(const float* samples, int count)
+{
+    float32x4_t peak = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        peak = vmaxq_f32(peak, vabsq_f32(vld1q_f32(samples + i)));
+    }
+    return std::max(vmaxvq_f32(peak), peakAbsoluteScalar(samples + i, count - i));
+}
+
+void clampNEON(float* samples, int count, float limit)
+{
+    const float32x4_t low = vdupq_n_f32(-limit);
+    const float32x4_t high = vdupq_n_f32(limit);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(samples + i, vminq_f32(vmaxq_f32(vld1q_f32(samples + i), low), high));
+    }
+    clampScalar(samples + i, count - i, limit);
+}
+
+void softClipNEON(float* samples, int count)
+{
+    const float32x4_t low = vdupq_n_f32(-SOFT_CLIP_KNEE);
+    const float32x4_t high = vdupq_n_f32(SOFT_CLIP_KNEE);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t x = vminq_f32(vmaxq_f32(vld1q_f32(samples + i), low), high);
+        const float32x4_t x3 = vmulq_f32(vmulq_f32(x, x), x);
+        vst1q_f32(samples + i, vsubq_f32(x, vmulq_n_f32(x3, SOFT_CLIP_CUBIC)));
+    }
+    softClipScalar(samples + i, count - i);
+}
+
+void interleaveNEON(const float* left, const float* right, float* interleaved, int frames)
+{
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t pair;
+        pair.val[0] = vld1q_f32(left + i);
+        pair.val[1] = vld1q_f32(right + i);
+        vst2q_f32(interleaved + i * 2, pair);
+    }
+    interleaveScalar(left + i, right + i, interleaved + i * 2, frames - i);
+}
+
+void deinterleaveNEON(const float* interleaved, float* left, float* right, int frames)
+{
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        const float32x4x2_t pair = vld2q_f32(interleaved + i * 2);
+        vst1q_f32(left + i, pair.val[0]);
+        vst1q_f32(right + i, pair.val[1]);
+    }
+    deinterleaveScalar(interleaved + i * 2, left + i, right + i, frames - i);
+}
+
+#endif // EONPLAY_KERNELS_NEON
+
+KernelTable selectKernels()
+{
+    KernelTable table = {
+        InstructionSet::Scalar, gainScalar, gainRampScalar, mixScalar, midSideEncodeScalar, midSideDecodeScalar,
+        sumOfSquaresScalar, peakAbsoluteScalar, clampScalar, softClipScalar, interleaveScalar, deinterleaveScalar
+    };
+
+#if defined(EONPLAY_KERNELS_SSE2)
+    table = {
+        InstructionSet::SSE2, gainSSE2, gainRampSSE2, mixSSE2, midSideEncodeSSE2, midSideDecodeSSE2,
+        sumOfSquaresSSE2, peakAbsoluteSSE2, clampSSE2, softClipSSE2, interleaveSSE2, deinterleaveSSE2
+    };
+#if defined(EONPLAY_KERNELS_AVX2)
+    if (cpuHasAvx2()) {
+        table = {
+            InstructionSet::AVX2, gainAVX2, gainRampAVX2, mixAVX2, midSideEncodeAVX2, midSideDecodeAVX2,
+            sumOfSquaresAVX2, peakAbsoluteAVX2, clampAVX2, softClipAVX2, interleaveAVX2, deinterleaveAVX2
+        };
+    }
+#endif
+#elif defined(EONPLAY_KERNELS_NEON)
+    table = {
+        InstructionSet::NEON, gainNEON, gainRampNEON, mixNEON, midSideEncodeNEON, midSideDecodeNEON,
+        sumOfSquaresNEON, peakAbsoluteNEON, clampNEON, softClipNEON, interleaveNEON, deinterleaveNEON
+    };
+#endif
+
+    qCInfo(audioKernels) << "Audio kernels use" << instructionSetName(table.instructionSet);
+    return table;
+}
+
+const KernelTable& kernels()
+{
+    // Selected on first use; later calls only load the table
+    static const KernelTable table = selectKernels();
+    return table;
+}
+
+} // namespace
+
+InstructionSet activeInstructionSet()
+{
+    return kernels().instructionSet;
+}
+
+const char* instructionSetName(InstructionSet instructionSet)
+{
+    switch (instructionSet) {
+        case InstructionSet::SSE2: return "SSE2";
+        case InstructionSet::AVX2: return "AVX2";
+        case InstructionSet::NEON: return "NEON";
+        case InstructionSet::Scalar:
+        default: return "scalar";
+    }
+}
+
+void applyGain(float* samples, int count, float gain)
+{
+    kernels().gain(samples, count, gain);
+}
+
+void applyGainRamp(float* samples, int count, float startGain, float endGain)
+{
+    if (count > 0) {
+        kernels().gainRamp(samples, count, startGain, (endGain - startGain) / count);
+    }
+}
+
+void mixInto(float* destination, const float* source, int count, float gain)
+{
+    kernels().mix(destination, source, count, gain);
+}
+
+void midSideEncode(float* left, float* right, int count)
+{
+    kernels().midSideEncode(left, right, count);
+}
+
+void midSideDecode(float* mid, float* side, int count)
+{
+    kernels().midSideDecode(mid, side, count);
+}
+
+double sumOfSquares(const float* samples, int count)
+{
+    return kernels().sumOfSquares(samples, count);
+}
+
+float peakAbsolute(const float* samples, int count)
+{
+    return kernels().peakAbsolute(samples, count);
+}
+
+void clamp(float* samples, int count, float limit)
+{
+    kernels().clamp(samples, count, limit);
+}
+
+void softClip(float* samples, int count)
+{
+    kernels().softClip(samples, count);
+}
+
+void interleave(const float* left, const float* right, float* interleaved, int frames)
+{
+    kernels().interleave(left, right, interleaved, frames);
+}
+
+void deinterleave(const float* interleaved, float* left, float* right, int frames)
+{
+    kernels().deinterleave(interleaved, left, right, frames);
+}
+
+} // namespace AudioKernels
@@ -1,4 +1,7 @@
 #include "audio/AudioOutputManager.h"
+#include "audio/AudioKernels.h"
+#include "audio/AudioOutputMonitor.h"
+#include "PowerPolicy.h"
 #include <QLoggingCategory>
 #include <QMutexLocker>
 #include <QtMath>
@@ -8,17 +11,86 @@
 Q_DECLARE_LOGGING_CATEGORY(audioOutputManager)
 Q_LOGGING_CATEGORY(audioOutputManager, "audio.output")
 
+namespace {
+
+LatencyHistogram& outputLatencyMetric()
+{
+    static LatencyHistogram& histogram = MetricsRegistry::instance().histogram(
+        "eonplay_audio_output_latency_seconds", "Measured latency of the current audio output path");
+    return histogram;
+}
+
+LatencyHistogram& bufferFillMetric()
+{
+    static LatencyHistogram& histogram = MetricsRegistry::instance().histogram(
+        "eonplay_audio_buffer_fill_seconds", "Audio held in the output stream buffer");
+    return histogram;
+}
+
+MetricCounter& underrunMetric()
+{
+    static MetricCounter& counter = MetricsRegistry::instance().counter(
+        "eonplay_audio_underruns", "Audio output underruns of the current device");
+    return counter;
+}
+
+// Least-squares slope of latency (ms) over time (minutes)
+double latencySlope(const QVector<QPointF>& points)
+{
+    if (points.size() < 2) {
+        return 0.0;
+    }
+    
+    double meanX = 0.0;
+    double meanY = 0.0;
+    for (const QPointF& point : points) {
+        meanX += point.x();
+        meanY += point.y();
+    }
+    meanX /= points.size();
+    meanY /= points.size();
+    
+    double covariance = 0.0;
+    double variance = 0.0;
+    for (const QPointF& point : points) {
+        covariance += (point.x() - meanX) * (point.y() - meanY);
+        variance += (point.x() - meanX) * (point.x() - meanX);
+    }
+    return variance > 0.0 ? covariance / variance : 0.0;
+}
+
+} // namespace
+
 AudioOutputManager::AudioOutputManager(QObject* parent)
     : QObject(parent)
     , m_mediaDevices(new QMediaDevices(this))
     , m_spatialSoundMode(None)
     , m_headphoneSpatialEnabled(false)
+    , m_hrtfSuspended(!PowerPolicy::instance().profile().expensiveDspEnabled)
     , m_spatialStrength(0.5f)
     , m_roomSize(0.5f)
+    , m_audioDelayMs(0)
+    , m_spatialSampleRate(44100)
+    , m_hrtfSampleRate(0)
+    , m_hrirGeneration(0)
+    , m_outputMonitor(nullptr)
+    , m_compensationBaselineMs(-1.0)
+    , m_compensationBaseDelayMs(0)
 {
     connect(m_mediaDevices, &QMediaDevices::audioOutputsChanged,
             this, &AudioOutputManager::onDevicesChanged);
     
+    // Queued: emitted with the device mutex held
+    connect(this, &AudioOutputManager::currentDeviceChanged, this, [this]() {
+        if (isOutputMonitoringActive()) {
+            restartOutputMonitor();
+        }
+    }, Qt::QueuedConnection);
+    
+    connect(&PowerPolicy::instance(), &PowerPolicy::profileChanged, this, [this](const PowerPolicy::Profile& profile) {
+        setHrtfSuspended(!profile.expensiveDspEnabled);
+    });
+    
     qCDebug(audioOutputManager) << "AudioOutputManager created";
 }
 
@@ -40,6 +112,7 @@ bool AudioOutputManager::initialize()
 
 void AudioOutputManager::shutdown()
 {
+    stopOutputMonitoring();
     qCDebug(audioOutputManager) << "AudioOutputManager shutdown";
 }
 
@@ -143,6 +216,13 @@ void AudioOutputManager::setHeadphoneSpatialSoundEnabled(bool enabled)
     }
 }
 
+void AudioOutputManager::setHrtfSuspended(bool suspended)
+{
+    if (m_hrtfSuspended.exchange(suspended, std::memory_order_relaxed) != suspended) {
+        qCDebug(audioOutputManager) << "HRTF" << (suspended ? "suspended" : "resumed");
+    }
+}
+
 float AudioOutputManager::getHeadphoneSpatialStrength() const
 {
     return m_spatialStrength;
@@ -173,6 +253,46 @@ void AudioOutputManager::setRoomSize(float size)
     }
 }
 
+bool AudioOutputManager::loadHRIRSet(const QString& filePath)
+{
+    QString error;
+    HRIRSet hrir = HRIRSet::fromWavFile(filePath, &error);
+    if (!hrir.isValid()) {
+        qCWarning(audioOutputManager) << error;
+        return false;
+    }
+    
+    {
+        QMutexLocker locker(&m_hrtfMutex);
+        m_hrirSet = hrir;
+        m_hrtfSampleRate = 0; // Rebuilt for the stream rate on the next block
+        ++m_hrirGeneration;
+    }
+    
+    qCDebug(audioOutputManager) << "Loaded HRIR set" << hrir.name << "at" << hrir.sampleRate << "Hz,"
+                               << hrir.leftToLeft.size() << "taps";
+    emit hrirSetChanged(hrir.name);
+    return true;
+}
+
+void AudioOutputManager::resetHRIRSet()
+{
+    {
+        QMutexLocker locker(&m_hrtfMutex);
+        m_hrirSet = HRIRSet();
+        m_hrtfSampleRate = 0;
+        ++m_hrirGeneration;
+    }
+    
+    emit hrirSetChanged(getHRIRSetName());
+}
+
+QString AudioOutputManager::getHRIRSetName() const
+{
+    QMutexLocker locker(&m_hrtfMutex);
+    return m_hrirSet.isValid() ? m_hrirSet.name : QStringLiteral("Spherical Head");
+}
+
 AudioOutputManager::DelayCompensation AudioOutputManager::getDelayCompensation() const
 {
     return m_delayCompensation;
@@ -185,6 +305,8 @@ void AudioOutputManager::setDelayCompensation(const DelayCompensation& compensat
     // Clamp delay values
     m_delayCompensation.audioDelayMs = qBound(MIN_DELAY_MS, compensation.audioDelayMs, MAX_DELAY_MS);
     m_delayCompensation.videoDelayMs = qBound(MIN_DELAY_MS, compensation.videoDelayMs, MAX_DELAY_MS);
+    m_audioDelayMs.store(m_delayCompensation.audioDelayMs, std::memory_order_relaxed);
+    m_compensationBaselineMs = -1.0;
     
     emit delayCompensationChanged(m_delayCompensation);
     qCDebug(audioOutputManager) << "Delay compensation updated - Audio:" << m_delayCompensation.audioDelayMs
@@ -200,8 +322,12 @@ void AudioOutputManager::setAudioDelay(int delayMs)
 {
     delayMs = qBound(MIN_DELAY_MS, delayMs, MAX_DELAY_MS);
     
+    // Drift compensation continues from the delay chosen here
+    m_compensationBaselineMs = -1.0;
+    
     if (m_delayCompensation.audioDelayMs != delayMs) {
         m_delayCompensation.audioDelayMs = delayMs;
+        m_audioDelayMs.store(delayMs, std::memory_order_relaxed);
         emit delayCompensationChanged(m_delayCompensation);
         qCDebug(audioOutputManager) << "Audio delay set to:" << delayMs << "ms";
     }
@@ -232,6 +358,7 @@ void AudioOutputManager::setAutoSyncEnabled(bool enabled)
 {
     if (m_delayCompensation.autoSync != enabled) {
         m_delayCompensation.autoSync = enabled;
+        m_compensationBaselineMs = -1.0;
         emit delayCompensationChanged(m_delayCompensation);
         qCDebug(audioOutputManager) << "Auto sync" << (enabled ? "enabled" : "disabled");
     }
@@ -239,12 +366,16 @@ void AudioOutputManager::setAutoSyncEnabled(bool enabled)
 
 float AudioOutputManager::detectSyncOffset()
 {
-    // Simplified sync detection - in a real implementation this would
-    // analyze audio and video streams to detect timing differences
+    // Latency drift since the audio delay was set that is not yet compensated;
+    // needs output monitoring, otherwise nothing is known
     float detectedOffset = 0.0f;
     
-    // Simulate detection process
-    // This would involve cross-correlation analysis of audio/video signals
+    const OutputStats stats = getOutputStats();
+    if (stats.samples > 0 && m_compensationBaselineMs >= 0.0) {
+        const double drift = stats.latencyMs - m_compensationBaselineMs;
+        const double compensated = m_compensationBaseDelayMs - m_delayCompensation.audioDelayMs;
+        detectedOffset = static_cast<float>(drift - compensated);
+    }
     
     if (qAbs(detectedOffset) > m_delayCompensation.syncTolerance) {
         emit syncOffsetDetected(detectedOffset);
@@ -254,27 +385,107 @@ float AudioOutputManager::detectSyncOffset()
     return detectedOffset;
 }
 
+AudioOutputManager::ExclusiveOutputSettings AudioOutputManager::getExclusiveOutput() const
+{
+    QMutexLocker locker(&m_exclusiveMutex);
+    return m_exclusiveSettings;
+}
+
+void AudioOutputManager::setExclusiveOutput(const ExclusiveOutputSettings& settings)
+{
+    ExclusiveOutputSettings applied = settings;
+    applied.periodFrames = qMax(0, settings.periodFrames);
+    {
+        QMutexLocker locker(&m_exclusiveMutex);
+        if (m_exclusiveSettings.enabled == applied.enabled && m_exclusiveSettings.deviceId == applied.deviceId &&
+            m_exclusiveSettings.periodFrames == applied.periodFrames) {
+            return;
+        }
+        m_exclusiveSettings = applied;
+    }
+    
+    emit exclusiveOutputChanged(applied);
+    qCDebug(audioOutputManager) << "Exclusive output" << (applied.enabled ? "enabled" : "disabled")
+                               << "period" << applied.periodFrames << "frames";
+}
+
+AudioOutputManager::ExclusiveOutputStatus AudioOutputManager::getExclusiveOutputStatus() const
+{
+    QMutexLocker locker(&m_exclusiveMutex);
+    return m_exclusiveStatus;
+}
+
+void AudioOutputManager::reportExclusiveOutputStatus(const ExclusiveOutputStatus& status)
+{
+    bool opened = false;
+    {
+        QMutexLocker locker(&m_exclusiveMutex);
+        opened = status.active && !m_exclusiveStatus.active;
+        m_exclusiveStatus = status;
+    }
+    
+    if (status.active) {
+        outputLatencyMetric().record(static_cast<qint64>(status.latencyMs * 1000.0));
+    }
+    if (opened) {
+        qCDebug(audioOutputManager) << status.backend << "holds" << status.deviceId << status.sampleRate << "Hz"
+                                   << status.bitsPerSample << "bit," << status.latencyMs << "ms"
+                                   << (status.bitPerfect ? "bit-perfect" : "converted");
+        
+        // The monitor's stream would fail on the held device, or measure a path nothing uses
+        QMetaObject::invokeMethod(this, [this]() {
+            stopOutputMonitoring();
+        }, Qt::QueuedConnection);
+    }
+    
+    emit exclusiveOutputStatusChanged(status);
+}
+
+bool AudioOutputManager::isProcessingActive() const
+{
+    // Mirrors what processSpatialBlock() actually runs
+    const bool spatial = m_spatialSoundMode == Headphones
+        ? m_headphoneSpatialEnabled && !m_hrtfSuspended.load(std::memory_order_relaxed)
+        : m_spatialSoundMode != None;
+    return spatial || m_audioDelayMs.load(std::memory_order_relaxed) > 0;
+}
+
 void AudioOutputManager::processSpatialSound(QVector<float>& leftChannel, QVector<float>& rightChannel, int sampleRate)
+{
+    if (leftChannel.size() != rightChannel.size()) {
+        return;
+    }
+    
+    processSpatialBlock(leftChannel.data(), rightChannel.data(), leftChannel.size(), sampleRate);
+}
+
+void AudioOutputManager::processSpatialBlock(float* left, float* right, int frames, int sampleRate)
 {
     if (m_spatialSoundMode == None || (!m_headphoneSpatialEnabled && m_spatialSoundMode == Headphones)) {
         return;
     }
     
+    if (sampleRate != m_spatialSampleRate) {
+        adoptPreparedSpatial(sampleRate);
+    }
+    
     switch (m_spatialSoundMode) {
         case Headphones:
-            applyCrossfeed(leftChannel, rightChannel, m_spatialStrength);
-            applyHRTF(leftChannel, rightChannel);
+            // Binaural convolution already includes the interaural crossfeed
+            if (!m_hrtfSuspended.load(std::memory_order_relaxed)) {
+                applyHRTF(left, right, frames, sampleRate);
+            }
             break;
             
         case Speakers_2_1:
         case Speakers_5_1:
         case Speakers_7_1:
-            applyRoomSimulation(leftChannel, rightChannel, m_roomSize);
+            applyRoomSimulation(left, right, frames, m_roomSize);
             break;
             
         case Custom:
-            applyCrossfeed(leftChannel, rightChannel, m_spatialStrength * 0.5f);
-            applyRoomSimulation(leftChannel, rightChannel, m_roomSize);
+            applyCrossfeed(left, right, frames, m_spatialStrength * 0.5f);
+            applyRoomSimulation(left, right, frames, m_roomSize);
             break;
             
         case None:
@@ -283,35 +494,222 @@ void AudioOutputManager::processSpatialSound(QVector<float>& leftChannel, QVecto
     }
 }
 
-void AudioOutputManager::applyDelayCompensation(QVector<float>& leftChannel, QVector<float>& rightChannel, int sampleRate)
+void AudioOutputManager::prepareForSampleRate(int sampleRate)
 {
-    if (m_delayCompensation.audioDelayMs == 0) {
+    if (sampleRate <= 0) {
         return;
     }
     
-    int delaySamples = (m_delayCompensation.audioDelayMs * sampleRate) / 1000;
-    delaySamples = qBound(-MAX_DELAY_SAMPLES, delaySamples, MAX_DELAY_SAMPLES);
-    
-    if (delaySamples > 0) {
-        // Positive delay - add silence at the beginning
-        QVector<float> silenceBuffer(delaySamples, 0.0f);
-        leftChannel = silenceBuffer + leftChannel;
-        rightChannel = silenceBuffer + rightChannel;
-    } else if (delaySamples < 0) {
-        // Negative delay - remove samples from the beginning
-        int samplesToRemove = -delaySamples;
-        if (samplesToRemove < leftChannel.size()) {
-            leftChannel.remove(0, samplesToRemove);
-            rightChannel.remove(0, samplesToRemove);
+    // Resampling and partitioning the responses is the expensive part,
+    // so it is only done while binaural rendering is in use
+    std::unique_ptr<PartitionedConvolver> hrtf;
+    quint64 hrirGeneration = 0;
+    if (m_spatialSoundMode == Headphones) {
+        HRIRSet hrir;
+        {
+            QMutexLocker locker(&m_hrtfMutex);
+            hrir = m_hrirSet;
+            hrirGeneration = m_hrirGeneration;
         }
+        hrtf = std::make_unique<PartitionedConvolver>();
+        hrtf->setImpulseResponses(hrir.isValid() ? hrir.resampled(sampleRate)
+                                                 : HRIRSet::sphericalHead(sampleRate));
+    }
+    
+    QMutexLocker locker(&m_prepareMutex);
+    PreparedSpatial& prepared = m_preparedSpatial.writeBuffer();
+    prepared.sampleRate = sampleRate;
+    prepared.state = SpatialState(sampleRate);
+    prepared.hrtfSampleRate = hrtf ? sampleRate : 0;
+    prepared.hrirGeneration = hrirGeneration;
+    prepared.hrtf = std::move(hrtf);
+    m_preparedSpatial.publish();
+    
+    qCDebug(audioOutputManager) << "Spatial processing prepared for" << sampleRate << "Hz";
+}
+
+void AudioOutputManager::applyDelayCompensation(QVector<float>& leftChannel, QVector<float>& rightChannel, int sampleRate)
+{
+    if (leftChannel.size() != rightChannel.size()) {
+        return;
     }
+    
+    applyDelayCompensationBlock(leftChannel.data(), rightChannel.data(), leftChannel.size(), sampleRate);
+}
+
+void AudioOutputManager::applyDelayCompensationBlock(float* left, float* right, int frames, int sampleRate)
+{
+    // The delay line is sized for the rate along with the spatial state
+    if (sampleRate != m_spatialSampleRate) {
+        adoptPreparedSpatial(sampleRate);
+    }
+    
+    DelayLine& line = m_spatialState.compensation;
+    const int delayMs = qMax(0, m_audioDelayMs.load(std::memory_order_relaxed));
+    line.setDelay(delayMs * double(sampleRate) / 1000.0);
+    
+    // Fed even at zero delay, so a later delay starts from real history
+    line.process(left, right, frames);
 }
 
 float AudioOutputManager::getCurrentLatency() const
 {
-    // Return estimated latency based on current device and buffer settings
-    // This would be calculated based on actual audio system latency
-    return 20.0f; // Default 20ms latency
+    const ExclusiveOutputStatus exclusive = getExclusiveOutputStatus();
+    if (exclusive.active) {
+        return static_cast<float>(exclusive.latencyMs);
+    }
+    
+    const OutputStats stats = getOutputStats();
+    return stats.samples > 0 ? static_cast<float>(stats.latencyMs) : ESTIMATED_LATENCY_MS;
+}
+
+bool AudioOutputManager::startOutputMonitoring()
+{
+    if (!m_outputMonitor) {
+        m_outputMonitor = new AudioOutputMonitor(this);
+        connect(m_outputMonitor, &AudioOutputMonitor::sampled, this,
+                [this](const AudioOutputMonitor::Sample& sample) {
+                    onMonitorSample(sample.latencyMs, sample.bufferFillMs, sample.elapsedMs);
+                });
+        connect(m_outputMonitor, &AudioOutputMonitor::underrun, this, &AudioOutputManager::onMonitorUnderrun);
+    }
+    
+    restartOutputMonitor();
+    return m_outputMonitor->isRunning();
+}
+
+void AudioOutputManager::stopOutputMonitoring()
+{
+    if (m_outputMonitor) {
+        m_outputMonitor->stop();
+    }
+}
+
+bool AudioOutputManager::isOutputMonitoringActive() const
+{
+    return m_outputMonitor && m_outputMonitor->isRunning();
+}
+
+AudioOutputManager::OutputStats AudioOutputManager::getOutputStats(const QString& deviceId) const
+{
+    QMutexLocker locker(&m_deviceMutex);
+    QString id = deviceId;
+    if (id.isEmpty()) {
+        id = m_monitoredDeviceId.isEmpty() ? m_currentDevice.id : m_monitoredDeviceId;
+    }
+    const std::shared_ptr<DeviceMeasurement> measurement = m_measurements.value(id);
+    if (!measurement) {
+        OutputStats stats;
+        stats.deviceId = id;
+        return stats;
+    }
+    return measurement->stats;
+}
+
+void AudioOutputManager::restartOutputMonitor()
+{
+    const QString deviceId = getCurrentDevice().id;
+    
+    QAudioDevice device = QMediaDevices::defaultAudioOutput();
+    for (const QAudioDevice& output : QMediaDevices::audioOutputs()) {
+        if (output.id() == deviceId) {
+            device = output;
+            break;
+        }
+    }
+    
+    // A different path has a different latency: compensate drift from there on
+    m_compensationBaselineMs = -1.0;
+    m_monitoredDeviceId = QString::fromUtf8(device.id());
+    if (!m_outputMonitor->start(device)) {
+        qCWarning(audioOutputManager) << "Output monitoring unavailable for" << device.description();
+    }
+}
+
+void AudioOutputManager::onMonitorSample(double latencyMs, double bufferFillMs, qint64 elapsedMs)
+{
+    OutputStats stats;
+    {
+        QMutexLocker locker(&m_deviceMutex);
+        std::shared_ptr<DeviceMeasurement>& measurement = m_measurements[m_monitoredDeviceId];
+        if (!measurement) {
+            measurement = std::make_shared<DeviceMeasurement>();
+            measurement->stats.deviceId = m_monitoredDeviceId;
+            measurement->stats.deviceName = m_outputMonitor->device().description();
+            measurement->bufferFill = std::make_unique<LatencyHistogram>("audio_buffer_fill", "Output buffer fill");
+        }
+        
+        OutputStats& current = measurement->stats;
+        if (current.samples == 0) {
+            current.latencyMs = latencyMs;
+            current.minLatencyMs = latencyMs;
+            current.maxLatencyMs = latencyMs;
+        } else {
+            current.latencyMs += LATENCY_SMOOTHING * (latencyMs - current.latencyMs);
+            current.minLatencyMs = qMin(current.minLatencyMs, latencyMs);
+            current.maxLatencyMs = qMax(current.maxLatencyMs, latencyMs);
+        }
+        ++current.samples;
+        
+        measurement->trend.append(QPointF(elapsedMs / 60000.0, latencyMs));
+        if (measurement->trend.size() > DRIFT_WINDOW_SAMPLES) {
+            measurement->trend.removeFirst();
+        }
+        current.driftMsPerMinute = latencySlope(measurement->trend);
+        
+        const qint64 bufferFillUs = static_cast<qint64>(bufferFillMs * 1000.0);
+        measurement->bufferFill->record(bufferFillUs);
+        current.bufferFill = measurement->bufferFill->snapshot();
+        stats = current;
+        
+        outputLatencyMetric().record(static_cast<qint64>(latencyMs * 1000.0));
+        bufferFillMetric().record(bufferFillUs);
+    }
+    
+    compensateLatencyDrift(stats);
+    emit outputStatsUpdated(stats);
+}
+
+void AudioOutputManager::onMonitorUnderrun()
+{
+    {
+        QMutexLocker locker(&m_deviceMutex);
+        const std::shared_ptr<DeviceMeasurement> measurement = m_measurements.value(m_monitoredDeviceId);
+        if (measurement) {
+            ++measurement->stats.underruns;
+        }
+    }
+    
+    underrunMetric().add();
+    qCDebug(audioOutputManager) << "Output underrun on" << m_monitoredDeviceId;
+    emit underrunDetected(m_monitoredDeviceId);
+}
+
+void AudioOutputManager::compensateLatencyDrift(const OutputStats& stats)
+{
+    if (!m_delayCompensation.autoSync || stats.samples < MIN_COMPENSATION_SAMPLES) {
+        return;
+    }
+    
+    // Anchor on the first settled measurement; sync was right as set then
+    if (m_compensationBaselineMs < 0.0) {
+        m_compensationBaselineMs = stats.latencyMs;
+        m_compensationBaseDelayMs = m_delayCompensation.audioDelayMs;
+        return;
+    }
+    
+    // Audio that now arrives later is played correspondingly earlier
+    const int drift = qRound(stats.latencyMs - m_compensationBaselineMs);
+    const int target = qBound(MIN_DELAY_MS, m_compensationBaseDelayMs - drift, MAX_DELAY_MS);
+    if (qAbs(target - m_delayCompensation.audioDelayMs) < COMPENSATION_STEP_MS) {
+        return;
+    }
+    
+    m_delayCompensation.audioDelayMs = target;
+    m_audioDelayMs.store(target, std::memory_order_relaxed);
+    emit delayCompensationChanged(m_delayCompensation);
+    qCDebug(audioOutputManager) << "Compensating" << drift << "ms latency drift on" << stats.deviceName
+                               << "- audio delay" << target << "ms";
 }
 
 bool AudioOutputManager::testAudioDevice(const QString& deviceId)
@@ -333,6 +731,11 @@ void AudioOutputManager::onDevicesChanged()
     updateDeviceList();
     emit devicesChanged();
     qCDebug(audioOutputManager) << "Audio devices changed";
+    
+    // The monitored stream may have moved to a new default device
+    if (isOutputMonitoringActive()) {
+        restartOutputMonitor();
+    }
 }
 
 void AudioOutputManager::updateDeviceList()
@@ -381,42 +784,45 @@ AudioOutputManager::AudioDeviceInfo AudioOutputManager::createDeviceInfo(const Q
 void AudioOutputManager::initializeSpatialProcessing()
 {
     // Initialize spatial processing state
-    m_spatialState = SpatialState();
+    m_spatialState = SpatialState(m_spatialSampleRate);
     qCDebug(audioOutputManager) << "Spatial processing initialized";
 }
 
-void AudioOutputManager::applyCrossfeed(QVector<float>& leftChannel, QVector<float>& rightChannel, float strength)
+void AudioOutputManager::applyCrossfeed(float* leftChannel, float* rightChannel, int frames, float strength)
 {
-    if (strength <= 0.0f || leftChannel.size() != rightChannel.size()) {
+    if (strength <= 0.0f) {
         return;
     }
     
+    constexpr int SCRATCH_FRAMES = 256;
     float crossfeedGain = strength * 0.3f; // Max 30% crossfeed
-    
-    for (int i = 0; i < leftChannel.size(); ++i) {
-        float left = leftChannel[i];
-        float right = rightChannel[i];
+    float* delayLineL = m_spatialState.delayLineL.data();
+    float* delayLineR = m_spatialState.delayLineR.data();
+    const int delayLength = m_spatialState.delayLineL.size();
+    float delayedLeft[SCRATCH_FRAMES];
+    float delayedRight[SCRATCH_FRAMES];
+    
+    // Runs that neither wrap the delay line nor overflow the scratch buffers
+    for (int offset = 0; offset < frames;) {
+        const int index = m_spatialState.delayIndex;
+        const int count = qMin(qMin(frames - offset, delayLength - index), SCRATCH_FRAMES);
         
-        // Apply crossfeed with delay for more natural sound
-        int delayIndex = (m_spatialState.delayIndex + i) % m_spatialState.delayLineL.size();
+        // Trade the delayed samples for the current ones
+        std::copy_n(delayLineL + index, count, delayedLeft);
+        std::copy_n(delayLineR + index, count, delayedRight);
+        std::copy_n(leftChannel + offset, count, delayLineL + index);
+        std::copy_n(rightChannel + offset, count, delayLineR + index);
         
-        float delayedLeft = m_spatialState.delayLineL[delayIndex];
-        float delayedRight = m_spatialState.delayLineR[delayIndex];
-        
-        // Store current samples
-        m_spatialState.delayLineL[delayIndex] = left;
-        m_spatialState.delayLineR[delayIndex] = right;
+        // Apply crossfeed with delay for more natural sound
+        AudioKernels::mixInto(leftChannel + offset, delayedRight, count, crossfeedGain);
+        AudioKernels::mixInto(rightChannel + offset, delayedLeft, count, crossfeedGain);
         
-        // Apply crossfeed
-        leftChannel[i] = left + delayedRight * crossfeedGain;
-        rightChannel[i] = right + delayedLeft * crossfeedGain;
+        m_spatialState.delayIndex = (index + count) % delayLength;
+        offset += count;
     }
-    
-    // Update delay index
-    m_spatialState.delayIndex = (m_spatialState.delayIndex + leftChannel.size()) % m_spatialState.delayLineL.size();
 }
 
-void AudioOutputManager::applyRoomSimulation(QVector<float>& leftChannel, QVector<float>& rightChannel, float roomSize)
+void AudioOutputManager::applyRoomSimulation(float* leftChannel, float* rightChannel, int frames, float roomSize)
 {
     if (roomSize <= 0.0f) {
         return;
@@ -425,7 +831,7 @@ void AudioOutputManager::applyRoomSimulation(QVector<float>& leftChannel, QVecto
     float reverbGain = roomSize * 0.2f; // Max 20% reverb
     int reverbDelay = static_cast<int>(roomSize * 2000); // Up to 2000 samples delay
     
-    for (int i = 0; i < leftChannel.size(); ++i) {
+    for (int i = 0; i < frames; ++i) {
         float left = leftChannel[i];
         float right = rightChannel[i];
         
@@ -445,17 +851,44 @@ void AudioOutputManager::applyRoomSimulation(QVector<float>& leftChannel, QVecto
     }
 }
 
-void AudioOutputManager::applyHRTF(QVector<float>& leftChannel, QVector<float>& rightChannel)
+void AudioOutputManager::adoptPreparedSpatial(int sampleRate)
+{
+    m_preparedSpatial.consume();
+    PreparedSpatial& prepared = m_preparedSpatial.readBuffer();
+    if (prepared.sampleRate == sampleRate) {
+        std::swap(m_spatialState, prepared.state);
+        prepared.sampleRate = 0;
+    } else {
+        m_spatialState = SpatialState(sampleRate);
+    }
+    m_spatialSampleRate = sampleRate;
+}
+
+void AudioOutputManager::applyHRTF(float* leftChannel, float* rightChannel, int frames, int sampleRate)
 {
-    // Simplified HRTF (Head-Related Transfer Function) simulation
-    // In a real implementation, this would use measured HRTF data
+    QMutexLocker locker(&m_hrtfMutex);
     
-    for (int i = 1; i < leftChannel.size(); ++i) {
-        // Simple high-frequency emphasis for spatial effect
-        float leftDiff = leftChannel[i] - leftChannel[i-1];
-        float rightDiff = rightChannel[i] - rightChannel[i-1];
-        
-        leftChannel[i] += leftDiff * 0.1f;
-        rightChannel[i] += rightDiff * 0.1f;
+    // Partition spectra are built once per set and sample rate, not per
+    // block, and ahead of time when the rate change was prepared
+    if (!m_hrtfConvolver || m_hrtfSampleRate != sampleRate) {
+        m_preparedSpatial.consume();
+        PreparedSpatial& prepared = m_preparedSpatial.readBuffer();
+        if (prepared.hrtf && prepared.hrtfSampleRate == sampleRate &&
+            prepared.hrirGeneration == m_hrirGeneration) {
+            std::swap(m_hrtfConvolver, prepared.hrtf);
+            prepared.hrtfSampleRate = 0;
+            m_hrtfSampleRate = sampleRate;
+        }
     }
+    if (!m_hrtfConvolver || m_hrtfSampleRate != sampleRate) {
+        HRIRSet hrir = m_hrirSet.isValid() ? m_hrirSet.resampled(sampleRate)
+                                           : HRIRSet::sphericalHead(sampleRate);
+        if (!m_hrtfConvolver) {
+            m_hrtfConvolver = std::make_unique<PartitionedConvolver>();
+        }
+        m_hrtfConvolver->setImpulseResponses(hrir);
+        m_hrtfSampleRate = sampleRate;
+    }
+    
+    m_hrtfConvolver->process(leftChannel, rightChannel, frames, m_spatialStrength);
 }
\ No newline at end of file
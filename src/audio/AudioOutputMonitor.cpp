@@ -0,0 +1,128 @@
+#include "audio/AudioOutputMonitor.h"
+#include <QAudioSink>
+#include <QIODevice>
+#include <QLoggingCategory>
+#include <QTimer>
+#include <cstring>
+
+Q_DECLARE_LOGGING_CATEGORY(audioOutputMonitor)
+Q_LOGGING_CATEGORY(audioOutputMonitor, "audio.output.monitor")
+
+/**
+ * @brief Endless silence, counting what the sink has pulled
+ */
+class SilenceSource : public QIODevice
+{
+public:
+    explicit SilenceSource(char silence, QObject* parent = nullptr)
+        : QIODevice(parent)
+        , m_silence(silence)
+        , m_produced(0)
+    {
+    }
+
+    qint64 produced() const { return m_produced; }
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override { return 1 << 16; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override
+    {
+        std::memset(data, m_silence, static_cast<size_t>(maxSize));
+        m_produced += maxSize;
+        return maxSize;
+    }
+
+    qint64 writeData(const char* data, qint64 maxSize) override
+    {
+        Q_UNUSED(data)
+        Q_UNUSED(maxSize)
+        return -1;
+    }
+
+private:
+    char m_silence;
+    qint64 m_produced;
+};
+
+AudioOutputMonitor::AudioOutputMonitor(QObject* parent)
+    : QObject(parent)
+    , m_sink(nullptr)
+    , m_source(nullptr)
+    , m_sampleTimer(new QTimer(this))
+{
+    connect(m_sampleTimer, &QTimer::timeout, this, &AudioOutputMonitor::takeSample);
+}
+
+AudioOutputMonitor::~AudioOutputMonitor()
+{
+    stop();
+}
+
+bool AudioOutputMonitor::start(const QAudioDevice& device, int sampleIntervalMs)
+{
+    stop();
+    if (device.isNull()) {
+        return false;
+    }
+
+    m_device = device;
+    m_format = device.preferredFormat();
+    const char silence = m_format.sampleFormat() == QAudioFormat::UInt8 ? char(0x80) : char(0);
+
+    m_source = new SilenceSource(silence, this);
+    m_source->open(QIODevice::ReadOnly);
+    m_sink = new QAudioSink(device, m_format, this);
+    connect(m_sink, &QAudioSink::stateChanged, this, &AudioOutputMonitor::onStateChanged);
+    m_sink->start(m_source);
+
+    if (m_sink->error() != QAudio::NoError) {
+        qCWarning(audioOutputMonitor) << "Cannot open" << device.description() << "for monitoring:" << m_sink->error();
+        stop();
+        return false;
+    }
+
+    m_clock.start();
+    m_sampleTimer->start(sampleIntervalMs);
+    qCDebug(audioOutputMonitor) << "Monitoring" << device.description() << m_format;
+    return true;
+}
+
+void AudioOutputMonitor::stop()
+{
+    m_sampleTimer->stop();
+    if (m_sink) {
+        m_sink->disconnect(this);
+        m_sink->stop();
+        delete m_sink;
+        m_sink = nullptr;
+    }
+    delete m_source;
+    m_source = nullptr;
+}
+
+void AudioOutputMonitor::takeSample()
+{
+    const qint64 elapsedMs = m_clock.elapsed();
+    const int bytesPerSecond = m_format.bytesForDuration(1000000);
+    if (!m_sink || bytesPerSecond <= 0 || elapsedMs < WARMUP_MS) {
+        return;
+    }
+
+    const double writtenMs = 1000.0 * m_source->produced() / bytesPerSecond;
+    const double processedMs = m_sink->processedUSecs() / 1000.0;
+    const qsizetype buffered = m_sink->bufferSize() - m_sink->bytesFree();
+
+    Sample sample;
+    sample.elapsedMs = elapsedMs;
+    sample.latencyMs = qMax(0.0, writtenMs - processedMs);
+    sample.bufferFillMs = qMax<qsizetype>(0, buffered) * 1000.0 / bytesPerSecond;
+    emit sampled(sample);
+}
+
+void AudioOutputMonitor::onStateChanged(QAudio::State state)
+{
+    if (state == QAudio::IdleState && m_sink && m_sink->error() == QAudio::UnderrunError) {
+        emit underrun();
+    }
+}
@@ -1,12 +1,15 @@
 #include "audio/AudioProcessor.h"
+#include "audio/AudioKernels.h"
+#include "audio/AudioTranscoder.h"
+#include "media/IMediaEngine.h"
 #include <QFile>
 #include <QTextStream>
-#include <QRegularExpression>
 #include <QFileInfo>
 #include <QDir>
 #include <QLoggingCategory>
 #include <QtMath>
 #include <QDateTime>
+#include <algorithm>
 
 Q_DECLARE_LOGGING_CATEGORY(audioProcessor)
 Q_LOGGING_CATEGORY(audioProcessor, "audio.processor")
@@ -20,23 +23,42 @@ AudioProcessor::AudioProcessor(QObject* parent)
     , m_karaokeLowFreq(DEFAULT_KARAOKE_LOW_FREQ)
     , m_karaokeHighFreq(DEFAULT_KARAOKE_HIGH_FREQ)
     , m_currentLyricsIndex(-1)
-    , m_lyricsTimer(new QTimer(this))
+    , m_currentLyricsWord(-1)
+    , m_lyricsSubscribed(false)
     , m_audioDelay(0)
     , m_noiseReductionEnabled(false)
     , m_noiseReductionStrength(DEFAULT_NOISE_REDUCTION_STRENGTH)
+    , m_transcoder(new AudioTranscoder(this))
+    , m_conversionJobId(0)
     , m_conversionInProgress(false)
     , m_conversionProgress(0)
-    , m_conversionTimer(new QTimer(this))
 {
-    // Setup lyrics timer
-    m_lyricsTimer->setSingleShot(false);
-    m_lyricsTimer->setInterval(100); // Check every 100ms
-    connect(m_lyricsTimer, &QTimer::timeout, this, &AudioProcessor::updateLyricsPosition);
+    m_vocalSuppressor.setStrength(m_vocalRemovalStrength);
+    m_vocalSuppressor.setFrequencyRange(m_karaokeLowFreq, m_karaokeHighFreq);
     
-    // Setup conversion timer
-    m_conversionTimer->setSingleShot(false);
-    m_conversionTimer->setInterval(500); // Update every 500ms
-    connect(m_conversionTimer, &QTimer::timeout, this, &AudioProcessor::updateConversionProgress);
+    // Conversion progress comes from the encoder's own counters
+    connect(m_transcoder, &AudioTranscoder::jobProgress, this,
+            [this](int jobId, const AudioTranscoder::Progress& progress) {
+        if (jobId == m_conversionJobId && progress.percent != m_conversionProgress) {
+            m_conversionProgress = progress.percent;
+            emit conversionProgress(m_conversionProgress);
+        }
+    });
+    connect(m_transcoder, &AudioTranscoder::jobFinished, this,
+            [this](int jobId, bool success, const QString& outputPath, const QString& error) {
+        if (jobId != m_conversionJobId) {
+            return;
+        }
+        m_conversionJobId = 0;
+        m_conversionInProgress = false;
+        m_conversionProgress = success ? 100 : 0;
+        if (success) {
+            emit conversionProgress(100);
+        } else {
+            qCWarning(audioProcessor) << "Audio conversion failed:" << error;
+        }
+        emit conversionCompleted(success, outputPath);
+    });
     
     qCDebug(audioProcessor) << "AudioProcessor created";
 }
@@ -86,13 +108,7 @@ void AudioProcessor::setEnabled(bool enabled)
     if (m_enabled != enabled) {
         m_enabled = enabled;
         
-        if (m_enabled) {
-            if (hasLyrics()) {
-                m_lyricsTimer->start();
-            }
-        } else {
-            m_lyricsTimer->stop();
-        }
+        updateLyricsSubscription();
         
         emit enabledChanged(m_enabled);
         qCDebug(audioProcessor) << "Audio processor" << (enabled ? "enabled" : "disabled");
@@ -152,6 +168,8 @@ void AudioProcessor::setKaraokeMode(KaraokeMode mode)
 {
     if (m_karaokeMode != mode) {
         m_karaokeMode = mode;
+        m_vocalSuppressor.setMode(mode == VocalIsolation ? VocalSuppressor::Isolate : VocalSuppressor::Remove);
+        m_vocalSuppressor.reset();
         emit karaokeModeChanged(m_karaokeMode);
         qCDebug(audioProcessor) << "Karaoke mode set to" << getKaraokeModeName(mode);
     }
@@ -179,6 +197,7 @@ void AudioProcessor::setVocalRemovalStrength(float strength)
     
     if (m_vocalRemovalStrength != strength) {
         m_vocalRemovalStrength = strength;
+        m_vocalSuppressor.setStrength(strength);
         qCDebug(audioProcessor) << "Vocal removal strength set to" << strength;
     }
 }
@@ -196,43 +215,65 @@ void AudioProcessor::setKaraokeFrequencyRange(float lowFreq, float highFreq)
     if (m_karaokeLowFreq != lowFreq || m_karaokeHighFreq != highFreq) {
         m_karaokeLowFreq = lowFreq;
         m_karaokeHighFreq = highFreq;
+        m_vocalSuppressor.setFrequencyRange(lowFreq, highFreq);
         qCDebug(audioProcessor) << "Karaoke frequency range set to" << lowFreq << "-" << highFreq << "Hz";
     }
 }
 
+void AudioProcessor::setMediaEngine(std::shared_ptr<IMediaEngine> engine)
+{
+    if (m_mediaEngine == engine) {
+        return;
+    }
+    
+    if (m_mediaEngine) {
+        m_mediaEngine->unsubscribePosition(this);
+        disconnect(m_mediaEngine.get(), nullptr, this, nullptr);
+    }
+    m_lyricsSubscribed = false;
+    m_mediaEngine = std::move(engine);
+    
+    if (m_mediaEngine) {
+        // Seeks and media changes arrive here before the next tick
+        connect(m_mediaEngine.get(), &IMediaEngine::playbackPositionChanged, this, [this](qint64 position) {
+            if (m_lyricsSubscribed) {
+                updateLyricsPosition(position);
+            }
+        });
+    }
+    updateLyricsSubscription();
+}
+
 // Lyrics Support
 bool AudioProcessor::hasLyrics() const
 {
     QMutexLocker locker(&m_dataMutex);
-    return !m_lyricsLines.isEmpty();
+    return !m_lyrics.isEmpty();
 }
 
 bool AudioProcessor::loadLyricsFromFile(const QString& filePath)
 {
-    QFileInfo fileInfo(filePath);
-    QString extension = fileInfo.suffix().toLower();
-    
-    bool success = false;
-    if (extension == "lrc") {
-        success = parseLRCFile(filePath);
-    } else if (extension == "srt") {
-        success = parseSRTFile(filePath);
-    } else {
-        qCWarning(audioProcessor) << "Unsupported lyrics format:" << extension;
+    LyricsTimeline lyrics;
+    if (!lyrics.loadFile(filePath)) {
         return false;
     }
     
-    if (success) {
-        emit lyricsLoaded(m_lyricsLines.size());
-        
-        if (m_enabled) {
-            m_lyricsTimer->start();
-        }
-        
-        qCDebug(audioProcessor) << "Loaded" << m_lyricsLines.size() << "lyrics lines from" << filePath;
+    const int lineCount = lyrics.lineCount();
+    {
+        QMutexLocker locker(&m_dataMutex);
+        m_lyrics = std::move(lyrics);
+        m_currentLyricsIndex = -1;
+        m_currentLyricsWord = -1;
+    }
+    
+    emit lyricsLoaded(lineCount);
+    updateLyricsSubscription();
+    if (m_lyricsSubscribed) {
+        updateLyricsPosition(m_mediaEngine->position());
     }
     
-    return success;
+    qCDebug(audioProcessor) << "Loaded" << lineCount << "lyrics lines from" << filePath;
+    return true;
 }
 
 bool AudioProcessor::loadEmbeddedLyrics(const QString& mediaPath)
@@ -247,42 +288,34 @@ bool AudioProcessor::loadEmbeddedLyrics(const QString& mediaPath)
 QVector<AudioProcessor::LyricsLine> AudioProcessor::getAllLyrics() const
 {
     QMutexLocker locker(&m_dataMutex);
-    return m_lyricsLines;
+    return m_lyrics.lines();
 }
 
 AudioProcessor::LyricsLine AudioProcessor::getCurrentLyricsLine(qint64 timeMs) const
 {
     QMutexLocker locker(&m_dataMutex);
     
-    for (const auto& line : m_lyricsLines) {
-        if (timeMs >= line.startTime && timeMs <= line.endTime) {
-            return line;
-        }
-    }
-    
-    return LyricsLine(); // Return empty line if not found
+    const int index = m_lyrics.lineAt(timeMs);
+    return index >= 0 ? m_lyrics.line(index) : LyricsLine();
 }
 
 AudioProcessor::LyricsLine AudioProcessor::getNextLyricsLine(qint64 timeMs) const
 {
     QMutexLocker locker(&m_dataMutex);
     
-    for (const auto& line : m_lyricsLines) {
-        if (line.startTime > timeMs) {
-            return line;
-        }
-    }
-    
-    return LyricsLine(); // Return empty line if not found
+    const int index = m_lyrics.nextLineAfter(timeMs);
+    return index >= 0 ? m_lyrics.line(index) : LyricsLine();
 }
 
 void AudioProcessor::clearLyrics()
 {
-    QMutexLocker locker(&m_dataMutex);
-    
-    m_lyricsLines.clear();
-    m_currentLyricsIndex = -1;
-    m_lyricsTimer->stop();
+    {
+        QMutexLocker locker(&m_dataMutex);
+        m_lyrics.clear();
+        m_currentLyricsIndex = -1;
+        m_currentLyricsWord = -1;
+    }
+    updateLyricsSubscription();
     
     qCDebug(audioProcessor) << "Lyrics cleared";
 }
@@ -291,7 +324,8 @@ bool AudioProcessor::exportLyrics(const QString& filePath, const QString& format
 {
     QMutexLocker locker(&m_dataMutex);
     
-    if (m_lyricsLines.isEmpty()) {
+    const QVector<LyricsLine>& lyricsLines = m_lyrics.lines();
+    if (lyricsLines.isEmpty()) {
         qCWarning(audioProcessor) << "No lyrics to export";
         return false;
     }
@@ -306,7 +340,7 @@ bool AudioProcessor::exportLyrics(const QString& filePath, const QString& format
     
     if (format.toLower() == "lrc") {
         // Export as LRC format
-        for (const auto& line : m_lyricsLines) {
+        for (const auto& line : lyricsLines) {
             int minutes = static_cast<int>(line.startTime / 60000);
             int seconds = static_cast<int>((line.startTime % 60000) / 1000);
             int centiseconds = static_cast<int>((line.startTime % 1000) / 10);
@@ -319,8 +353,8 @@ bool AudioProcessor::exportLyrics(const QString& filePath, const QString& format
         }
     } else if (format.toLower() == "srt") {
         // Export as SRT format
-        for (int i = 0; i < m_lyricsLines.size(); ++i) {
-            const auto& line = m_lyricsLines[i];
+        for (int i = 0; i < lyricsLines.size(); ++i) {
+            const auto& line = lyricsLines[i];
             
             out << (i + 1) << "\n";
             out << QString("%1 --> %2\n")
@@ -330,7 +364,7 @@ bool AudioProcessor::exportLyrics(const QString& filePath, const QString& format
         }
     } else if (format.toLower() == "txt") {
         // Export as plain text
-        for (const auto& line : m_lyricsLines) {
+        for (const auto& line : lyricsLines) {
             out << line.text << "\n";
         }
     } else {
@@ -398,10 +432,9 @@ bool AudioProcessor::setAlbumArt(const QString& filePath, const QByteArray& imag
 // Audio Format Conversion
 bool AudioProcessor::isConversionSupported(AudioFormat fromFormat, AudioFormat toFormat)
 {
-    // For demonstration, assume all conversions are supported
+    // ffmpeg decodes every source format; the target needs an encoder
     Q_UNUSED(fromFormat)
-    Q_UNUSED(toFormat)
-    return true;
+    return AudioTranscoder::supportedFormats().contains(getFormatExtension(toFormat));
 }
 
 QString AudioProcessor::getFormatName(AudioFormat format)
@@ -438,17 +471,28 @@ bool AudioProcessor::convertAudioFormat(const QString& inputPath, const QString&
         return false;
     }
     
-    // TODO: Implement actual audio conversion using FFmpeg or similar
-    Q_UNUSED(inputPath)
-    Q_UNUSED(outputPath)
-    Q_UNUSED(targetFormat)
-    Q_UNUSED(quality)
+    // Map 0-100 onto each encoder's own quality scale
+    AudioTranscoder::Options options;
+    options.format = getFormatExtension(targetFormat);
+    quality = qBound(0, quality, 100);
+    switch (targetFormat) {
+        case MP3: options.quality = (100 - quality) * 9 / 100; break;
+        case FLAC: options.quality = quality * 8 / 100; break;
+        case OGG: options.quality = quality / 10; break;
+        case AAC:
+        case WMA: options.bitrate = 64 + quality * 256 / 100; break;
+        default: break;
+    }
+    
+    m_conversionJobId = m_transcoder->enqueue(inputPath, outputPath, options);
+    if (m_conversionJobId == 0) {
+        return false;
+    }
     
     m_conversionInProgress = true;
     m_conversionProgress = 0;
-    m_conversionTimer->start();
     
-    qCDebug(audioProcessor) << "Started audio conversion (simulated)";
+    qCDebug(audioProcessor) << "Started audio conversion to" << getFormatName(targetFormat);
     return true;
 }
 
@@ -460,9 +504,10 @@ int AudioProcessor::getConversionProgress() const
 void AudioProcessor::cancelConversion()
 {
     if (m_conversionInProgress) {
+        m_transcoder->cancel(m_conversionJobId);
+        m_conversionJobId = 0;
         m_conversionInProgress = false;
         m_conversionProgress = 0;
-        m_conversionTimer->stop();
         
         qCDebug(audioProcessor) << "Audio conversion cancelled";
     }
@@ -516,206 +561,82 @@ void AudioProcessor::setNoiseReductionStrength(float strength)
     }
 }
 
-// Private slots
-void AudioProcessor::updateLyricsPosition()
-{
-    // TODO: Get current playback position from media engine
-    // For now, simulate with current time
-    static qint64 simulatedTime = 0;
-    simulatedTime += 100; // Increment by 100ms each update
-    
-    LyricsLine currentLine = getCurrentLyricsLine(simulatedTime);
-    if (!currentLine.text.isEmpty()) {
-        emit currentLyricsChanged(currentLine);
-    }
-}
-
-void AudioProcessor::updateConversionProgress()
+// Private methods
+void AudioProcessor::updateLyricsSubscription()
 {
-    if (!m_conversionInProgress) {
+    const bool wanted = m_mediaEngine && m_enabled && hasLyrics();
+    if (wanted == m_lyricsSubscribed) {
         return;
     }
     
-    // Simulate conversion progress
-    m_conversionProgress += 5;
-    emit conversionProgress(m_conversionProgress);
-    
-    if (m_conversionProgress >= 100) {
-        m_conversionInProgress = false;
-        m_conversionTimer->stop();
-        emit conversionCompleted(true, "output.mp3"); // Simulated output path
-        
-        qCDebug(audioProcessor) << "Audio conversion completed (simulated)";
+    m_lyricsSubscribed = wanted;
+    if (wanted) {
+        m_mediaEngine->subscribePosition(this, LYRICS_UPDATE_INTERVAL_MS,
+                                         [this](qint64 position) { updateLyricsPosition(position); });
+    } else {
+        m_mediaEngine->unsubscribePosition(this);
     }
 }
 
-// Private methods
-bool AudioProcessor::parseLRCFile(const QString& filePath)
+void AudioProcessor::updateLyricsPosition(qint64 position)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qCWarning(audioProcessor) << "Failed to open LRC file:" << filePath;
-        return false;
-    }
-    
-    QMutexLocker locker(&m_dataMutex);
-    m_lyricsLines.clear();
-    
-    QTextStream in(&file);
-    QRegularExpression timeRegex(R"(\[(\d{2}):(\d{2})\.(\d{2})\](.*)$)");
-    
-    while (!in.atEnd()) {
-        QString line = in.readLine().trimmed();
-        if (line.isEmpty()) continue;
+    LyricsLine line;
+    int lineIndex;
+    int wordIndex;
+    bool lineChanged;
+    bool wordChanged;
+    bool hasWords;
+    {
+        QMutexLocker locker(&m_dataMutex);
+        lineIndex = m_lyrics.lineAt(position);
+        wordIndex = m_lyrics.wordAt(lineIndex, position);
         
-        QRegularExpressionMatch match = timeRegex.match(line);
-        if (match.hasMatch()) {
-            int minutes = match.captured(1).toInt();
-            int seconds = match.captured(2).toInt();
-            int centiseconds = match.captured(3).toInt();
-            QString text = match.captured(4).trimmed();
-            
-            qint64 timeMs = (minutes * 60 + seconds) * 1000 + centiseconds * 10;
-            
-            LyricsLine lyricsLine;
-            lyricsLine.startTime = timeMs;
-            lyricsLine.endTime = timeMs + 3000; // Default 3 second duration
-            lyricsLine.text = text;
-            
-            m_lyricsLines.append(lyricsLine);
+        lineChanged = lineIndex != m_currentLyricsIndex;
+        wordChanged = lineChanged || wordIndex != m_currentLyricsWord;
+        m_currentLyricsIndex = lineIndex;
+        m_currentLyricsWord = wordIndex;
+        
+        hasWords = lineIndex >= 0 && m_lyrics.line(lineIndex).hasWordTiming();
+        if (lineChanged && lineIndex >= 0) {
+            line = m_lyrics.line(lineIndex);
         }
     }
     
-    // Adjust end times based on next line start times
-    for (int i = 0; i < m_lyricsLines.size() - 1; ++i) {
-        m_lyricsLines[i].endTime = m_lyricsLines[i + 1].startTime;
+    // Only transitions are reported; ticks within a line or word are silent
+    if (lineChanged) {
+        emit currentLyricsChanged(line);
+    }
+    if (wordChanged && hasWords) {
+        emit currentLyricsWordChanged(lineIndex, wordIndex);
     }
-    
-    return !m_lyricsLines.isEmpty();
 }
 
-bool AudioProcessor::parseSRTFile(const QString& filePath)
+void AudioProcessor::processKaraokeAudio(QVector<float>& leftChannel, QVector<float>& rightChannel)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qCWarning(audioProcessor) << "Failed to open SRT file:" << filePath;
-        return false;
-    }
-    
-    QMutexLocker locker(&m_dataMutex);
-    m_lyricsLines.clear();
-    
-    QTextStream in(&file);
-    QRegularExpression timeRegex(R"((\d{2}):(\d{2}):(\d{2}),(\d{3}) --> (\d{2}):(\d{2}):(\d{2}),(\d{3}))");
-    
-    QString currentText;
-    qint64 startTime = 0, endTime = 0;
-    bool expectingTime = false;
-    bool expectingText = false;
-    
-    while (!in.atEnd()) {
-        QString line = in.readLine().trimmed();
-        
-        if (line.isEmpty()) {
-            if (!currentText.isEmpty()) {
-                LyricsLine lyricsLine;
-                lyricsLine.startTime = startTime;
-                lyricsLine.endTime = endTime;
-                lyricsLine.text = currentText;
-                m_lyricsLines.append(lyricsLine);
-                
-                currentText.clear();
-                expectingTime = false;
-                expectingText = false;
-            }
-            continue;
-        }
-        
-        // Check if it's a subtitle number
-        bool isNumber;
-        line.toInt(&isNumber);
-        if (isNumber) {
-            expectingTime = true;
-            continue;
-        }
-        
-        // Check if it's a time line
-        if (expectingTime) {
-            QRegularExpressionMatch match = timeRegex.match(line);
-            if (match.hasMatch()) {
-                // Parse start time
-                int h1 = match.captured(1).toInt();
-                int m1 = match.captured(2).toInt();
-                int s1 = match.captured(3).toInt();
-                int ms1 = match.captured(4).toInt();
-                startTime = ((h1 * 3600 + m1 * 60 + s1) * 1000) + ms1;
-                
-                // Parse end time
-                int h2 = match.captured(5).toInt();
-                int m2 = match.captured(6).toInt();
-                int s2 = match.captured(7).toInt();
-                int ms2 = match.captured(8).toInt();
-                endTime = ((h2 * 3600 + m2 * 60 + s2) * 1000) + ms2;
-                
-                expectingTime = false;
-                expectingText = true;
-                continue;
-            }
-        }
-        
-        // Collect text lines
-        if (expectingText) {
-            if (!currentText.isEmpty()) {
-                currentText += " ";
-            }
-            currentText += line;
-        }
-    }
-    
-    // Handle last subtitle if file doesn't end with empty line
-    if (!currentText.isEmpty()) {
-        LyricsLine lyricsLine;
-        lyricsLine.startTime = startTime;
-        lyricsLine.endTime = endTime;
-        lyricsLine.text = currentText;
-        m_lyricsLines.append(lyricsLine);
+    if (leftChannel.size() != rightChannel.size()) {
+        return;
     }
     
-    return !m_lyricsLines.isEmpty();
+    processKaraokeBlock(leftChannel.data(), rightChannel.data(), leftChannel.size());
 }
 
-void AudioProcessor::processKaraokeAudio(QVector<float>& leftChannel, QVector<float>& rightChannel)
+void AudioProcessor::processKaraokeBlock(float* leftChannel, float* rightChannel, int frames, int sampleRate)
 {
-    if (m_karaokeMode == Off || leftChannel.size() != rightChannel.size()) {
+    if (m_karaokeMode == Off) {
         return;
     }
     
     switch (m_karaokeMode) {
         case VocalRemoval:
-            // Subtract right channel from left channel to remove center vocals
-            for (int i = 0; i < leftChannel.size(); ++i) {
-                float diff = (leftChannel[i] - rightChannel[i]) * m_vocalRemovalStrength;
-                leftChannel[i] = diff;
-                rightChannel[i] = diff;
-            }
-            break;
-            
         case VocalIsolation:
-            // Add channels to isolate center vocals
-            for (int i = 0; i < leftChannel.size(); ++i) {
-                float sum = (leftChannel[i] + rightChannel[i]) * 0.5f * m_vocalRemovalStrength;
-                leftChannel[i] = sum;
-                rightChannel[i] = sum;
-            }
+            // Center content within the karaoke frequency range only
+            m_vocalSuppressor.process(leftChannel, rightChannel, frames, sampleRate);
             break;
             
         case CenterChannelExtraction:
-            // Extract center channel (mono mix)
-            for (int i = 0; i < leftChannel.size(); ++i) {
-                float center = (leftChannel[i] + rightChannel[i]) * 0.5f;
-                leftChannel[i] = center;
-                rightChannel[i] = center;
-            }
+            // Extract center channel (mono mix), the mid of a mid/side split
+            AudioKernels::midSideEncode(leftChannel, rightChannel, frames);
+            std::copy_n(leftChannel, frames, rightChannel);
             break;
             
         default:
@@ -0,0 +1,300 @@
+#include "audio/AudioTranscoder.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMetaObject>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QThread>
+
+Q_DECLARE_LOGGING_CATEGORY(audioTranscoder)
+Q_LOGGING_CATEGORY(audioTranscoder, "audio.transcoder")
+
+namespace {
+
+constexpr int PROGRESS_POLL_MS = 100;
+
+struct FormatInfo {
+    const char* name;
+    const char* muxer;
+};
+
+// Output format -> ffmpeg muxer
+constexpr FormatInfo FORMATS[] = {
+    { "mp3", "mp3" },
+    { "flac", "flac" },
+    { "wav", "wav" },
+    { "ogg", "ogg" },
+    { "aac", "adts" },
+    { "wma", "asf" }
+};
+
+const char* muxerFor(const QString& format)
+{
+    for (const FormatInfo& info : FORMATS) {
+        if (format == QLatin1String(info.name)) {
+            return info.muxer;
+        }
+    }
+    return nullptr;
+}
+
+qint64 parseDurationMs(const QByteArray& log)
+{
+    static const QRegularExpression duration(QStringLiteral("Duration: (\\d+):(\\d+):(\\d+)\\.(\\d+)"));
+    const QRegularExpressionMatch match = duration.match(QString::fromLatin1(log));
+    if (!match.hasMatch()) {
+        return 0;
+    }
+    const QString fraction = match.captured(4).leftJustified(3, QLatin1Char('0')).left(3);
+    return ((match.captured(1).toLongLong() * 60 + match.captured(2).toLongLong()) * 60 +
+            match.captured(3).toLongLong()) * 1000 + fraction.toLongLong();
+}
+
+} // namespace
+
+AudioTranscoder::AudioTranscoder(QObject* parent)
+    : QObject(parent)
+    , m_ffmpegPath(QStandardPaths::findExecutable("ffmpeg"))
+    , m_pool(new QThreadPool(this))
+    , m_nextJobId(1)
+{
+    m_pool->setMaxThreadCount(QThread::idealThreadCount());
+
+    if (m_ffmpegPath.isEmpty()) {
+        qCWarning(audioTranscoder) << "ffmpeg not found, audio conversion unavailable";
+    }
+}
+
+AudioTranscoder::~AudioTranscoder()
+{
+    cancelAll();
+    m_pool->waitForDone();
+}
+
+QStringList AudioTranscoder::supportedFormats()
+{
+    QStringList formats;
+    for (const FormatInfo& info : FORMATS) {
+        formats << QString::fromLatin1(info.name);
+    }
+    return formats;
+}
+
+void AudioTranscoder::setMaxConcurrentJobs(int jobs)
+{
+    m_pool->setMaxThreadCount(qMax(1, jobs));
+}
+
+int AudioTranscoder::enqueue(const QString& inputPath, const QString& outputPath, const Options& options)
+{
+    Options job = options;
+    job.format = options.format.toLower();
+
+    if (!isAvailable()) {
+        return 0;
+    }
+    if (!muxerFor(job.format)) {
+        qCWarning(audioTranscoder) << "Unsupported output format:" << options.format;
+        return 0;
+    }
+    if (!QFileInfo(inputPath).isFile()) {
+        qCWarning(audioTranscoder) << "Input file not found:" << inputPath;
+        return 0;
+    }
+
+    const int jobId = m_nextJobId++;
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_jobs.insert(jobId, cancelled);
+
+    const QString ffmpegPath = m_ffmpegPath;
+    m_pool->start([this, ffmpegPath, jobId, inputPath, outputPath, job, cancelled]() {
+        const JobResult result = runJob(ffmpegPath, jobId, inputPath, outputPath, job, *cancelled, this);
+        QMetaObject::invokeMethod(this, [this, jobId, outputPath, result]() {
+            onJobFinished(jobId, outputPath, result);
+        }, Qt::QueuedConnection);
+    });
+
+    qCDebug(audioTranscoder) << "Queued conversion" << jobId << inputPath << "->" << outputPath;
+    return jobId;
+}
+
+void AudioTranscoder::cancel(int jobId)
+{
+    const auto it = m_jobs.constFind(jobId);
+    if (it != m_jobs.constEnd()) {
+        it.value()->store(true);
+    }
+}
+
+void AudioTranscoder::cancelAll()
+{
+    for (const auto& cancelled : std::as_const(m_jobs)) {
+        cancelled->store(true);
+    }
+}
+
+void AudioTranscoder::onJobProgress(int jobId, const Progress& progress)
+{
+    if (m_jobs.contains(jobId)) {
+        emit jobProgress(jobId, progress);
+    }
+}
+
+void AudioTranscoder::onJobFinished(int jobId, const QString& outputPath, const JobResult& result)
+{
+    m_jobs.remove(jobId);
+
+    if (result.success) {
+        qCDebug(audioTranscoder) << "Conversion" << jobId << "finished:" << outputPath;
+    } else {
+        qCWarning(audioTranscoder) << "Conversion" << jobId << "failed:" << result.error;
+    }
+
+    emit jobFinished(jobId, result.success, outputPath, result.error);
+    if (m_jobs.isEmpty()) {
+        emit queueFinished();
+    }
+}
+
+QStringList AudioTranscoder::codecArguments(const Options& options)
+{
+    const QString bitrate = QString::number(options.bitrate) + QLatin1Char('k');
+
+    if (options.format == "mp3") {
+        if (options.bitrate > 0) {
+            return { "-c:a", "libmp3lame", "-b:a", bitrate };
+        }
+        // LAME VBR: 0 is best, 9 smallest
+        return { "-c:a", "libmp3lame", "-q:a", QString::number(options.quality >= 0 ? qBound(0, options.quality, 9) : 2) };
+    }
+    if (options.format == "flac") {
+        return { "-c:a", "flac", "-compression_level", QString::number(options.quality >= 0 ? qBound(0, options.quality, 12) : 5) };
+    }
+    if (options.format == "wav") {
+        return { "-c:a", "pcm_s16le" };
+    }
+    if (options.format == "ogg") {
+        if (options.bitrate > 0) {
+            return { "-c:a", "libvorbis", "-b:a", bitrate };
+        }
+        return { "-c:a", "libvorbis", "-q:a", QString::number(options.quality >= 0 ? qBound(0, options.quality, 10) : 6) };
+    }
+    if (options.format == "aac") {
+        return { "-c:a", "aac", "-b:a", options.bitrate > 0 ? bitrate : QStringLiteral("192k") };
+    }
+    return { "-c:a", "wmav2", "-b:a", options.bitrate > 0 ? bitrate : QStringLiteral("192k") };
+}
+
+AudioTranscoder::JobResult AudioTranscoder::runJob(const QString& ffmpegPath, int jobId, const QString& inputPath,
+                                                   const QString& outputPath, const Options& options,
+                                                   const std::atomic<bool>& cancelled, AudioTranscoder* receiver)
+{
+    JobResult result;
+    if (cancelled) {
+        result.error = QStringLiteral("Cancelled");
+        return result;
+    }
+
+    QMetaObject::invokeMethod(receiver, [receiver, jobId, inputPath]() {
+        emit receiver->jobStarted(jobId, inputPath);
+    }, Qt::QueuedConnection);
+
+    if (!QFileInfo(outputPath).dir().mkpath(".")) {
+        result.error = QStringLiteral("Cannot create output directory");
+        return result;
+    }
+
+    // Written aside and renamed, so a failed or cancelled job leaves no partial file
+    const QString partialPath = outputPath + QStringLiteral(".part");
+
+    QStringList arguments = {
+        "-nostdin", "-hide_banner", "-y", "-nostats", "-progress", "pipe:1",
+        "-threads", "1", "-i", inputPath,
+        "-map", "0:a:0", "-map_metadata", options.preserveMetadata ? "0" : "-1"
+    };
+    arguments << codecArguments(options);
+    if (options.sampleRate > 0) {
+        arguments << "-ar" << QString::number(options.sampleRate);
+    }
+    if (options.channels > 0) {
+        arguments << "-ac" << QString::number(options.channels);
+    }
+    arguments << "-threads" << "1" << "-f" << QString::fromLatin1(muxerFor(options.format)) << partialPath;
+
+    QProcess ffmpeg;
+    ffmpeg.setProcessChannelMode(QProcess::SeparateChannels);
+    ffmpeg.start(ffmpegPath, arguments);
+    if (!ffmpeg.waitForStarted()) {
+        result.error = ffmpeg.errorString();
+        return result;
+    }
+
+    Progress progress;
+    QByteArray progressBuffer;
+    QByteArray log;
+    auto readOutput = [&]() {
+        log += ffmpeg.readAllStandardError();
+        if (progress.durationMs == 0) {
+            progress.durationMs = parseDurationMs(log);
+        }
+        if (log.size() > 16384) {
+            log = log.right(4096);  // Enough for the error at the end
+        }
+
+        progressBuffer += ffmpeg.readAllStandardOutput();
+        qsizetype lineEnd;
+        while ((lineEnd = progressBuffer.indexOf('\n')) >= 0) {
+            const QByteArray line = progressBuffer.left(lineEnd).trimmed();
+            progressBuffer.remove(0, lineEnd + 1);
+
+            // One key=value block per update, closed by a progress= line
+            if (line.startsWith("out_time_us=")) {
+                progress.processedMs = qMax<qint64>(0, line.mid(12).toLongLong() / 1000);
+            } else if (line.startsWith("total_size=")) {
+                progress.outputBytes = line.mid(11).toLongLong();
+            } else if (line.startsWith("progress=")) {
+                progress.percent = progress.durationMs > 0
+                    ? static_cast<int>(qBound<qint64>(0, progress.processedMs * 100 / progress.durationMs, 99))
+                    : 0;
+                const Progress update = progress;
+                QMetaObject::invokeMethod(receiver, [receiver, jobId, update]() {
+                    receiver->onJobProgress(jobId, update);
+                }, Qt::QueuedConnection);
+            }
+        }
+    };
+
+    while (!ffmpeg.waitForFinished(PROGRESS_POLL_MS)) {
+        if (cancelled) {
+            ffmpeg.kill();
+            ffmpeg.waitForFinished();
+            QFile::remove(partialPath);
+            result.error = QStringLiteral("Cancelled");
+            return result;
+        }
+        readOutput();
+    }
+    readOutput();
+
+    if (ffmpeg.exitStatus() != QProcess::NormalExit || ffmpeg.exitCode() != 0) {
+        QFile::remove(partialPath);
+        const QList<QByteArray> lines = log.trimmed().split('\n');
+        result.error = lines.isEmpty() || lines.last().isEmpty()
+            ? QStringLiteral("ffmpeg exited with code %1").arg(ffmpeg.exitCode())
+            : QString::fromLocal8Bit(lines.last());
+        return result;
+    }
+
+    QFile::remove(outputPath);
+    if (!QFile::rename(partialPath, outputPath)) {
+        QFile::remove(partialPath);
+        result.error = QStringLiteral("Cannot write %1").arg(outputPath);
+        return result;
+    }
+
+    result.success = true;
+    return result;
+}
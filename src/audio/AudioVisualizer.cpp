@@ -1,11 +1,17 @@
 #include "audio/AudioVisualizer.h"
+#include "audio/AudioKernels.h"
+#include "audio/FFTEngine.h"
+#include "PowerPolicy.h"
 #include <QLoggingCategory>
 #include <QtMath>
 #include <QRandomGenerator>
 #include <QColor>
 #include <QDateTime>
+#include <QMetaObject>
+#include <QThread>
 #include <algorithm>
 #include <complex>
+#include <cmath>
 
 Q_DECLARE_LOGGING_CATEGORY(audioVisualizer)
 Q_LOGGING_CATEGORY(audioVisualizer, "audio.visualizer")
@@ -13,23 +19,32 @@ Q_LOGGING_CATEGORY(audioVisualizer, "audio.visualizer")
 AudioVisualizer::AudioVisualizer(QObject* parent)
     : QObject(parent)
     , m_enabled(false)
+    , m_suspended(false)
     , m_visualizationMode(SpectrumAnalyzer)
     , m_spectrumBandCount(DEFAULT_BAND_COUNT)
     , m_updateRate(DEFAULT_UPDATE_RATE)
+    , m_updateRateLimit(0)
     , m_sensitivity(DEFAULT_SENSITIVITY)
     , m_smoothingEnabled(true)
     , m_smoothingFactor(DEFAULT_SMOOTHING_FACTOR)
     , m_peakHoldEnabled(true)
     , m_peakHoldTime(DEFAULT_PEAK_HOLD_TIME)
+    , m_frameRing(RING_CAPACITY)
+    , m_ringSampleRate(44100)
     , m_leftVULevel(0.0f)
     , m_rightVULevel(0.0f)
     , m_leftPeakLevel(0.0f)
     , m_rightPeakLevel(0.0f)
     , m_leftPeakTime(0)
     , m_rightPeakTime(0)
-    , m_moodConfidence(0.0f)
+    , m_bandSampleRate(0)
+    , m_moodPool(new QThreadPool(this))
+    , m_moodFrameCount(0)
+    , m_moodAnalysisPending(false)
     , m_lastEnergy(0.0f)
     , m_averageEnergy(0.0f)
+    , m_positionMs(0)
+    , m_lastGridBeatMs(-1.0)
     , m_updateTimer(new QTimer(this))
     , m_peakHoldTimer(new QTimer(this))
 {
@@ -40,6 +55,13 @@ AudioVisualizer::AudioVisualizer(QObject* parent)
     m_smoothedMagnitudes.resize(m_spectrumBandCount);
     m_previousMagnitudes.resize(m_spectrumBandCount);
     
+    // Preallocate FFT buffers so spectrum analysis never allocates
+    m_fftInput.resize(FFT_SIZE);
+    m_fftSpectrum.resize(FFT_SIZE / 2 + 1);
+    m_drainBuffer.resize(FFT_SIZE);
+    m_windowLeft.fill(0.0f, FFT_SIZE);
+    m_windowRight.fill(0.0f, FFT_SIZE);
+    
     // Initialize waveform data
     m_leftWaveform.resize(WAVEFORM_SIZE);
     m_rightWaveform.resize(WAVEFORM_SIZE);
@@ -47,6 +69,7 @@ AudioVisualizer::AudioVisualizer(QObject* parent)
     // Initialize beat detection
     m_beatHistory.resize(10);
     m_beatTimes.reserve(100);
+    m_beatIntervals.reserve(100);
     m_energyHistory.resize(50);
     
     // Initialize frequency bands (logarithmic distribution)
@@ -54,6 +77,11 @@ AudioVisualizer::AudioVisualizer(QObject* parent)
         float ratio = static_cast<float>(i) / (m_spectrumBandCount - 1);
         m_currentSpectrum.frequencies[i] = 20.0f * qPow(1000.0f, ratio); // 20Hz to 20kHz
     }
+    updateBandBinEdges(44100);
+    
+    // One analysis at a time; it must never compete with playback
+    m_moodPool->setMaxThreadCount(1);
+    m_moodPool->setThreadPriority(QThread::LowPriority);
     
     // Setup timers
     m_updateTimer->setSingleShot(false);
@@ -63,19 +91,27 @@ AudioVisualizer::AudioVisualizer(QObject* parent)
     connect(m_updateTimer, &QTimer::timeout, this, &AudioVisualizer::updateVisualization);
     connect(m_peakHoldTimer, &QTimer::timeout, this, &AudioVisualizer::updatePeakHold);
     
+    PowerPolicy& power = PowerPolicy::instance();
+    m_updateRateLimit = power.profile().visualizerFpsLimit;
+    connect(&power, &PowerPolicy::profileChanged, this, [this](const PowerPolicy::Profile& profile) {
+        setUpdateRateLimit(profile.visualizerFpsLimit);
+    });
+    
     qCDebug(audioVisualizer) << "AudioVisualizer created with" << m_spectrumBandCount << "bands";
 }
 
 AudioVisualizer::~AudioVisualizer()
 {
     shutdown();
+    m_moodPool->waitForDone();
     qCDebug(audioVisualizer) << "AudioVisualizer destroyed";
 }
 
 bool AudioVisualizer::initialize()
 {
     // Initialize AI color palette with default colors
-    m_aiColorPalette = {
+    auto analysis = std::make_shared<MoodAnalysis>();
+    analysis->palette = {
         QColor(255, 0, 0),    // Red
         QColor(255, 127, 0),  // Orange
         QColor(255, 255, 0),  // Yellow
@@ -84,6 +120,7 @@ bool AudioVisualizer::initialize()
         QColor(75, 0, 130),   // Indigo
         QColor(148, 0, 211)   // Violet
     };
+    std::atomic_store(&m_moodAnalysis, std::shared_ptr<const MoodAnalysis>(std::move(analysis)));
     
     qCDebug(audioVisualizer) << "AudioVisualizer initialized";
     return true;
@@ -104,19 +141,34 @@ void AudioVisualizer::setEnabled(bool enabled)
 {
     if (m_enabled != enabled) {
         m_enabled = enabled;
+        updateTimers();
         
-        if (m_enabled) {
-            m_updateTimer->start(1000 / m_updateRate);
-            if (m_peakHoldEnabled) {
-                m_peakHoldTimer->start();
-            }
+        emit enabledChanged(m_enabled);
+        qCDebug(audioVisualizer) << "Visualizer" << (enabled ? "enabled" : "disabled");
+    }
+}
+
+void AudioVisualizer::setSuspended(bool suspended)
+{
+    if (m_suspended != suspended) {
+        m_suspended = suspended;
+        updateTimers();
+        qCDebug(audioVisualizer) << "Visualizer" << (suspended ? "suspended" : "resumed");
+    }
+}
+
+void AudioVisualizer::updateTimers()
+{
+    if (m_enabled && !m_suspended) {
+        m_updateTimer->start(1000 / effectiveUpdateRate());
+        if (m_peakHoldEnabled) {
+            m_peakHoldTimer->start();
         } else {
-            m_updateTimer->stop();
             m_peakHoldTimer->stop();
         }
-        
-        emit enabledChanged(m_enabled);
-        qCDebug(audioVisualizer) << "Visualizer" << (enabled ? "enabled" : "disabled");
+    } else {
+        m_updateTimer->stop();
+        m_peakHoldTimer->stop();
     }
 }
 
@@ -129,6 +181,11 @@ void AudioVisualizer::setVisualizationMode(VisualizationMode mode)
 {
     if (m_visualizationMode != mode) {
         m_visualizationMode = mode;
+        
+        // Start the next mood window afresh rather than from energies of long ago
+        m_moodBandSums.clear();
+        m_moodFrameCount = 0;
+        
         emit visualizationModeChanged(m_visualizationMode);
         qCDebug(audioVisualizer) << "Visualization mode set to" << getModeName(mode);
     }
@@ -183,6 +240,7 @@ void AudioVisualizer::setSpectrumBandCount(int bandCount)
             float ratio = static_cast<float>(i) / (m_spectrumBandCount - 1);
             m_currentSpectrum.frequencies[i] = 20.0f * qPow(1000.0f, ratio);
         }
+        updateBandBinEdges(m_bandSampleRate > 0 ? m_bandSampleRate : 44100);
         
         qCDebug(audioVisualizer) << "Spectrum band count set to" << bandCount;
     }
@@ -200,14 +258,34 @@ void AudioVisualizer::setUpdateRate(int rate)
     if (m_updateRate != rate) {
         m_updateRate = rate;
         
-        if (m_enabled) {
-            m_updateTimer->setInterval(1000 / m_updateRate);
+        if (m_updateTimer->isActive()) {
+            m_updateTimer->setInterval(1000 / effectiveUpdateRate());
         }
         
         qCDebug(audioVisualizer) << "Update rate set to" << rate << "Hz";
     }
 }
 
+void AudioVisualizer::setUpdateRateLimit(int rate)
+{
+    rate = rate > 0 ? qBound(1, rate, 60) : 0;
+    
+    if (m_updateRateLimit != rate) {
+        m_updateRateLimit = rate;
+        
+        if (m_updateTimer->isActive()) {
+            m_updateTimer->setInterval(1000 / effectiveUpdateRate());
+        }
+        
+        qCDebug(audioVisualizer) << "Update rate limit set to" << rate << "Hz";
+    }
+}
+
+int AudioVisualizer::effectiveUpdateRate() const
+{
+    return m_updateRateLimit > 0 ? qMin(m_updateRate, m_updateRateLimit) : m_updateRate;
+}
+
 float AudioVisualizer::getSensitivity() const
 {
     return m_sensitivity;
@@ -260,14 +338,7 @@ void AudioVisualizer::setPeakHoldEnabled(bool enabled)
 {
     if (m_peakHoldEnabled != enabled) {
         m_peakHoldEnabled = enabled;
-        
-        if (m_enabled) {
-            if (enabled) {
-                m_peakHoldTimer->start();
-            } else {
-                m_peakHoldTimer->stop();
-            }
-        }
+        updateTimers();
         
         qCDebug(audioVisualizer) << "Peak hold" << (enabled ? "enabled" : "disabled");
     }
@@ -290,34 +361,86 @@ void AudioVisualizer::setPeakHoldTime(int timeMs)
 
 void AudioVisualizer::processAudioSample(const AudioSample& sample)
 {
-    if (!m_enabled || sample.leftChannel.isEmpty()) {
+    if (sample.leftChannel.isEmpty()) {
         return;
     }
     
-    QMutexLocker locker(&m_dataMutex);
+    const bool stereo = sample.rightChannel.size() >= sample.leftChannel.size();
+    pushAudioFrames(sample.leftChannel.constData(), stereo ? sample.rightChannel.constData() : nullptr,
+                    sample.leftChannel.size(), sample.sampleRate);
+}
+
+void AudioVisualizer::pushAudioFrames(const float* left, const float* right, int frames, int sampleRate)
+{
+    if (!left || frames <= 0) {
+        return;
+    }
     
-    m_currentSample = sample;
+    m_ringSampleRate.store(sampleRate, std::memory_order_relaxed);
     
-    // Calculate VU levels
-    calculateVULevels(sample.leftChannel, sample.rightChannel);
+    // Interleave through a small stack buffer; frames that do not fit are dropped
+    StereoFrame chunk[256];
+    for (int offset = 0; offset < frames; offset += 256) {
+        const int count = qMin(256, frames - offset);
+        for (int i = 0; i < count; ++i) {
+            chunk[i].left = left[offset + i];
+            chunk[i].right = right ? right[offset + i] : left[offset + i];
+        }
+        if (m_frameRing.write(chunk, count) < count) {
+            break;
+        }
+    }
+}
+
+void AudioVisualizer::drainAudioFrames()
+{
+    int available = m_frameRing.availableToRead();
+    if (available <= 0) {
+        return;
+    }
     
-    // Update waveform data (downsample if necessary)
-    int sampleStep = qMax(1, sample.leftChannel.size() / WAVEFORM_SIZE);
+    // Only the latest analysis window matters; drop anything older
+    if (available > FFT_SIZE) {
+        m_frameRing.skip(available - FFT_SIZE);
+        available = FFT_SIZE;
+    }
     
-    for (int i = 0; i < WAVEFORM_SIZE && i * sampleStep < sample.leftChannel.size(); ++i) {
-        m_leftWaveform[i] = sample.leftChannel[i * sampleStep] * m_sensitivity;
-        if (i * sampleStep < sample.rightChannel.size()) {
-            m_rightWaveform[i] = sample.rightChannel[i * sampleStep] * m_sensitivity;
-        } else {
-            m_rightWaveform[i] = m_leftWaveform[i]; // Mono fallback
-        }
+    const int count = m_frameRing.read(m_drainBuffer.data(), available);
+    const int keep = FFT_SIZE - count;
+    
+    std::copy(m_windowLeft.constBegin() + count, m_windowLeft.constEnd(), m_windowLeft.begin());
+    std::copy(m_windowRight.constBegin() + count, m_windowRight.constEnd(), m_windowRight.begin());
+    for (int i = 0; i < count; ++i) {
+        m_windowLeft[keep + i] = m_drainBuffer[i].left;
+        m_windowRight[keep + i] = m_drainBuffer[i].right;
+    }
+    
+    analyzeWindow(m_ringSampleRate.load(std::memory_order_relaxed));
+}
+
+void AudioVisualizer::analyzeWindow(int sampleRate)
+{
+    QMutexLocker locker(&m_dataMutex);
+    
+    // Calculate VU levels
+    calculateVULevels(m_windowLeft, m_windowRight);
+    
+    // Update waveform data (downsampled from the analysis window)
+    const int sampleStep = FFT_SIZE / WAVEFORM_SIZE;
+    for (int i = 0; i < WAVEFORM_SIZE; ++i) {
+        m_leftWaveform[i] = m_windowLeft[i * sampleStep] * m_sensitivity;
+        m_rightWaveform[i] = m_windowRight[i * sampleStep] * m_sensitivity;
     }
     
     // Perform FFT for spectrum analysis
     if (m_visualizationMode == SpectrumAnalyzer || m_visualizationMode == FrequencyBars || 
         m_visualizationMode == CircularSpectrum || m_visualizationMode == AIVisualizer) {
         
-        performFFT(sample.leftChannel, m_currentSpectrum.magnitudes, m_currentSpectrum.phases);
+        if (sampleRate != m_bandSampleRate) {
+            updateBandBinEdges(sampleRate);
+        }
+        
+        performFFT(m_windowLeft, m_currentSpectrum.magnitudes, m_currentSpectrum.phases);
         
         // Apply sensitivity
         for (float& magnitude : m_currentSpectrum.magnitudes) {
@@ -337,10 +460,9 @@ void AudioVisualizer::processAudioSample(const AudioSample& sample)
             m_currentSpectrum.peakMagnitude = *maxIt;
         }
         
-        // AI mood detection and color palette generation
+        // AI mood and palette: only summed here, analysed on the mood pool
         if (m_visualizationMode == AIVisualizer) {
-            detectMoodFromSpectrum(m_currentSpectrum);
-            generateAIColorPalette(m_currentSpectrum);
+            accumulateMoodBands(m_currentSpectrum);
         }
         
         // Beat detection and animation parameters
@@ -380,14 +502,19 @@ bool AudioVisualizer::isAIVisualizerAvailable() const
 
 QString AudioVisualizer::getDetectedMood() const
 {
-    QMutexLocker locker(&m_dataMutex);
-    return m_detectedMood;
+    const std::shared_ptr<const MoodAnalysis> analysis = getMoodAnalysis();
+    return analysis ? analysis->mood : QString();
 }
 
 QVector<QColor> AudioVisualizer::getAIColorPalette() const
 {
-    QMutexLocker locker(&m_dataMutex);
-    return m_aiColorPalette;
+    const std::shared_ptr<const MoodAnalysis> analysis = getMoodAnalysis();
+    return analysis ? analysis->palette : QVector<QColor>();
+}
+
+std::shared_ptr<const AudioVisualizer::MoodAnalysis> AudioVisualizer::getMoodAnalysis() const
+{
+    return std::atomic_load(&m_moodAnalysis);
 }
 
 AudioVisualizer::BeatInfo AudioVisualizer::getCurrentBeatInfo() const
@@ -396,6 +523,25 @@ AudioVisualizer::BeatInfo AudioVisualizer::getCurrentBeatInfo() const
     return m_currentBeatInfo;
 }
 
+void AudioVisualizer::setBeatGrid(const TempoAnalyzer::BeatGrid& grid)
+{
+    QMutexLocker locker(&m_dataMutex);
+    m_beatGrid = grid;
+    m_lastGridBeatMs = -1.0;
+    m_beatTimes.clear();
+    m_currentBeatInfo.bpm = grid.isValid() ? static_cast<float>(grid.bpm) : 0.0f;
+}
+
+void AudioVisualizer::setPlaybackPosition(qint64 positionMs)
+{
+    QMutexLocker locker(&m_dataMutex);
+    if (positionMs < m_lastGridBeatMs) {
+        m_lastGridBeatMs = -1.0;    // Seeked backwards
+    }
+    m_positionMs = positionMs;
+    m_positionClock.start();
+}
+
 AudioVisualizer::AnimationParams AudioVisualizer::getCurrentAnimationParams() const
 {
     QMutexLocker locker(&m_dataMutex);
@@ -408,6 +554,8 @@ void AudioVisualizer::updateVisualization()
         return;
     }
     
+    drainAudioFrames();
+    
     // Emit appropriate signals based on visualization mode
     switch (m_visualizationMode) {
         case SpectrumAnalyzer:
@@ -433,11 +581,8 @@ void AudioVisualizer::updateVisualization()
         }
         
         case AIVisualizer:
+            // Mood and palette are emitted by publishMoodAnalysis() as they change
             emit spectrumDataUpdated(getCurrentSpectrum());
-            emit colorPaletteUpdated(getAIColorPalette());
-            if (!m_detectedMood.isEmpty()) {
-                emit moodDetected(m_detectedMood, m_moodConfidence);
-            }
             break;
             
         case None:
@@ -466,36 +611,68 @@ void AudioVisualizer::updatePeakHold()
 
 void AudioVisualizer::performFFT(const QVector<float>& input, QVector<float>& magnitudes, QVector<float>& phases)
 {
-    // Simple FFT implementation for demonstration
-    // In a real implementation, you would use a proper FFT library like FFTW
+    const FFTEngine& engine = FFTEngine::forSize<FFT_SIZE>();
+    const QVector<float>& window = engine.hannWindow();
     
+    // Copy input data and apply window function (zero-padded to FFT_SIZE)
     int inputSize = qMin(input.size(), FFT_SIZE);
-    QVector<std::complex<float>> fftInput(FFT_SIZE, std::complex<float>(0, 0));
-    
-    // Copy input data and apply window function (Hanning window)
     for (int i = 0; i < inputSize; ++i) {
-        float window = 0.5f * (1.0f - qCos(2.0f * M_PI * i / (inputSize - 1)));
-        fftInput[i] = std::complex<float>(input[i] * window, 0);
+        m_fftInput[i] = input[i] * window[i];
     }
+    std::fill(m_fftInput.begin() + inputSize, m_fftInput.end(), 0.0f);
     
-    // Simplified DFT (not optimized, for demonstration only)
-    QVector<std::complex<float>> fftOutput(m_spectrumBandCount);
+    engine.forward(m_fftInput.constData(), m_fftSpectrum.data());
     
-    for (int k = 0; k < m_spectrumBandCount; ++k) {
-        std::complex<float> sum(0, 0);
+    // Collapse FFT bins into the logarithmic display bands. Amplitudes are
+    // scaled so a full-scale sine reads ~1.0 (2/N, doubled for the Hann window).
+    const float scale = 4.0f / FFT_SIZE;
+    for (int band = 0; band < m_spectrumBandCount; ++band) {
+        int firstBin = m_bandBinEdges[band];
+        int lastBin = qMax(firstBin, m_bandBinEdges[band + 1] - 1);
         
-        for (int n = 0; n < FFT_SIZE; ++n) {
-            float angle = -2.0f * M_PI * k * n / FFT_SIZE;
-            std::complex<float> w(qCos(angle), qSin(angle));
-            sum += fftInput[n] * w;
+        int peakBin = firstBin;
+        float peak = 0.0f;
+        for (int bin = firstBin; bin <= lastBin; ++bin) {
+            float magnitude = std::abs(m_fftSpectrum[bin]);
+            if (magnitude > peak) {
+                peak = magnitude;
+                peakBin = bin;
+            }
         }
         
-        fftOutput[k] = sum;
+        magnitudes[band] = qMin(1.0f, peak * scale);
+        phases[band] = std::arg(m_fftSpectrum[peakBin]);
+    }
+}
+
+void AudioVisualizer::updateBandBinEdges(int sampleRate)
+{
+    // Band i spans the geometric midpoints around its centre frequency
+    const int maxBin = FFT_SIZE / 2;
+    const float binWidth = static_cast<float>(qMax(1, sampleRate)) / FFT_SIZE;
+    const QVector<float>& centres = m_currentSpectrum.frequencies;
+    
+    m_bandBinEdges.resize(m_spectrumBandCount + 1);
+    for (int edge = 0; edge <= m_spectrumBandCount; ++edge) {
+        float frequency;
+        if (edge == 0) {
+            frequency = centres.first() / std::sqrt(centres.value(1, centres.first() * 2.0f) / centres.first());
+        } else if (edge == m_spectrumBandCount) {
+            frequency = centres.last() * std::sqrt(centres.last() / centres.value(edge - 2, centres.last() / 2.0f));
+        } else {
+            frequency = std::sqrt(centres[edge - 1] * centres[edge]);
+        }
         
-        // Calculate magnitude and phase
-        magnitudes[k] = std::abs(fftOutput[k]) / FFT_SIZE;
-        phases[k] = std::arg(fftOutput[k]);
+        int bin = qBound(1, qRound(frequency / binWidth), maxBin);
+        m_bandBinEdges[edge] = edge > 0 ? qMax(bin, m_bandBinEdges[edge - 1] + 1) : bin;
+    }
+    
+    // Keep every edge addressable inside the spectrum buffer
+    for (int edge = 0; edge <= m_spectrumBandCount; ++edge) {
+        m_bandBinEdges[edge] = qMin(m_bandBinEdges[edge], maxBin);
     }
+    
+    m_bandSampleRate = sampleRate;
 }
 
 void AudioVisualizer::calculateVULevels(const QVector<float>& leftChannel, const QVector<float>& rightChannel)
@@ -537,16 +714,70 @@ void AudioVisualizer::applySmoothingToSpectrum(QVector<float>& magnitudes)
     m_previousMagnitudes = m_smoothedMagnitudes;
 }
 
-void AudioVisualizer::detectMoodFromSpectrum(const SpectrumData& spectrum)
+void AudioVisualizer::accumulateMoodBands(const SpectrumData& spectrum)
 {
+    if (m_moodBandSums.size() != spectrum.magnitudes.size()) {
+        m_moodBandSums.fill(0.0f, spectrum.magnitudes.size());
+        m_moodFrameCount = 0;
+        m_moodClock.start();
+    }
+    
+    for (int i = 0; i < spectrum.magnitudes.size(); ++i) {
+        m_moodBandSums[i] += spectrum.magnitudes[i];
+    }
+    ++m_moodFrameCount;
+    
+    // A slow analysis skips windows instead of queueing them
+    if (m_moodAnalysisPending || m_moodClock.elapsed() < MOOD_INTERVAL_MS) {
+        return;
+    }
+    
+    QVector<float> bandEnergies = m_moodBandSums;
+    for (float& energy : bandEnergies) {
+        energy /= m_moodFrameCount;
+    }
+    const QVector<float> frequencies = spectrum.frequencies;
+    m_moodBandSums.fill(0.0f);
+    m_moodFrameCount = 0;
+    m_moodClock.start();
+    m_moodAnalysisPending = true;
+    
+    m_moodPool->start([this, frequencies, bandEnergies]() {
+        auto analysis = std::make_shared<const MoodAnalysis>(analyzeMood(frequencies, bandEnergies));
+        QMetaObject::invokeMethod(this, [this, analysis]() {
+            publishMoodAnalysis(analysis);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void AudioVisualizer::publishMoodAnalysis(std::shared_ptr<const MoodAnalysis> analysis)
+{
+    m_moodAnalysisPending = false;
+    
+    const std::shared_ptr<const MoodAnalysis> previous = std::atomic_exchange(&m_moodAnalysis, analysis);
+    if (!m_enabled || m_visualizationMode != AIVisualizer) {
+        return;
+    }
+    
+    emit colorPaletteUpdated(analysis->palette);
+    if (!analysis->mood.isEmpty() && (!previous || previous->mood != analysis->mood)) {
+        emit moodDetected(analysis->mood, analysis->confidence);
+    }
+}
+
+AudioVisualizer::MoodAnalysis AudioVisualizer::analyzeMood(const QVector<float>& frequencies,
+                                                           const QVector<float>& bandEnergies)
+{
+    MoodAnalysis analysis;
+    
     // Simple mood detection based on frequency distribution
     float bassEnergy = 0.0f;
     float midEnergy = 0.0f;
     float trebleEnergy = 0.0f;
     
-    for (int i = 0; i < spectrum.magnitudes.size(); ++i) {
-        float freq = spectrum.frequencies[i];
-        float magnitude = spectrum.magnitudes[i];
+    for (int i = 0; i < bandEnergies.size(); ++i) {
+        float freq = frequencies[i];
+        float magnitude = bandEnergies[i];
         
         if (freq < 250.0f) {
             bassEnergy += magnitude;
@@ -566,38 +797,24 @@ void AudioVisualizer::detectMoodFromSpectrum(const SpectrumData& spectrum)
     }
     
     // Determine mood based on frequency distribution
-    QString newMood;
-    float confidence = 0.0f;
-    
     if (bassEnergy > 0.4f) {
-        newMood = "Energetic";
-        confidence = bassEnergy;
+        analysis.mood = "Energetic";
+        analysis.confidence = bassEnergy;
     } else if (midEnergy > 0.5f) {
-        newMood = "Balanced";
-        confidence = midEnergy;
+        analysis.mood = "Balanced";
+        analysis.confidence = midEnergy;
     } else if (trebleEnergy > 0.3f) {
-        newMood = "Bright";
-        confidence = trebleEnergy;
+        analysis.mood = "Bright";
+        analysis.confidence = trebleEnergy;
     } else {
-        newMood = "Calm";
-        confidence = 1.0f - totalEnergy;
-    }
-    
-    if (newMood != m_detectedMood) {
-        m_detectedMood = newMood;
-        m_moodConfidence = confidence;
+        analysis.mood = "Calm";
+        analysis.confidence = qBound(0.0f, 1.0f - totalEnergy, 1.0f);
     }
-}
-
-void AudioVisualizer::generateAIColorPalette(const SpectrumData& spectrum)
-{
-    // Generate color palette based on spectrum analysis
-    QVector<QColor> newPalette;
     
     // Base colors on dominant frequencies
-    for (int i = 0; i < qMin(7, spectrum.magnitudes.size()); ++i) {
-        float magnitude = spectrum.magnitudes[i];
-        float frequency = spectrum.frequencies[i];
+    for (int i = 0; i < qMin(7, bandEnergies.size()); ++i) {
+        float magnitude = bandEnergies[i];
+        float frequency = frequencies[i];
         
         // Map frequency to hue (20Hz = red, 20kHz = violet)
         float hue = (qLn(frequency / 20.0f) / qLn(1000.0f)) * 300.0f; // 0-300 degrees
@@ -607,18 +824,17 @@ void AudioVisualizer::generateAIColorPalette(const SpectrumData& spectrum)
         float saturation = qBound(0.3f, magnitude * 2.0f, 1.0f);
         float value = qBound(0.5f, magnitude * 1.5f, 1.0f);
         
-        QColor color = QColor::fromHsvF(hue / 360.0f, saturation, value);
-        newPalette.append(color);
+        analysis.palette.append(QColor::fromHsvF(hue / 360.0f, saturation, value));
     }
     
     // Ensure we have at least 3 colors
-    while (newPalette.size() < 3) {
-        newPalette.append(QColor(QRandomGenerator::global()->bounded(256),
-                                QRandomGenerator::global()->bounded(256),
-                                QRandomGenerator::global()->bounded(256)));
+    while (analysis.palette.size() < 3) {
+        analysis.palette.append(QColor(QRandomGenerator::global()->bounded(256),
+                                       QRandomGenerator::global()->bounded(256),
+                                       QRandomGenerator::global()->bounded(256)));
     }
     
-    m_aiColorPalette = newPalette;
+    return analysis;
 }
 
 float AudioVisualizer::calculateRMS(const QVector<float>& samples)
@@ -627,12 +843,8 @@ float AudioVisualizer::calculateRMS(const QVector<float>& samples)
         return 0.0f;
     }
     
-    float sum = 0.0f;
-    for (float sample : samples) {
-        sum += sample * sample;
-    }
-    
-    return qSqrt(sum / samples.size());
+    return static_cast<float>(std::sqrt(AudioKernels::sumOfSquares(samples.constData(), samples.size()) /
+                                        samples.size()));
 }
 
 float AudioVisualizer::calculatePeak(const QVector<float>& samples)
@@ -641,12 +853,7 @@ float AudioVisualizer::calculatePeak(const QVector<float>& samples)
         return 0.0f;
     }
     
-    float peak = 0.0f;
-    for (float sample : samples) {
-        peak = qMax(peak, qAbs(sample));
-    }
-    
-    return peak;
+    return AudioKernels::peakAbsolute(samples.constData(), samples.size());
 }
 
 void AudioVisualizer::detectBeat(const SpectrumData& spectrum)
@@ -679,10 +886,30 @@ void AudioVisualizer::detectBeat(const SpectrumData& spectrum)
     
     // Beat detection algorithm (simple energy-based)
     float threshold = m_averageEnergy * 1.3f; // 30% above average
-    bool isBeat = (currentEnergy > threshold) && (currentEnergy > m_lastEnergy * 1.1f);
-    
     qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
     
+    // An analyzed track's beats come from its grid; the position advances
+    // with the wall clock between reports
+    if (m_beatGrid.isValid() && m_positionClock.isValid()) {
+        const double positionMs = m_positionMs + m_positionClock.elapsed();
+        double beatMs = m_beatGrid.nextBeatMs(positionMs);
+        if (beatMs > positionMs) {
+            beatMs -= m_beatGrid.beatIntervalMs();
+        }
+        
+        m_currentBeatInfo.isBeat = beatMs >= m_beatGrid.firstBeatMs && beatMs > m_lastGridBeatMs;
+        if (m_currentBeatInfo.isBeat) {
+            m_lastGridBeatMs = beatMs;
+            m_currentBeatInfo.strength = threshold > 0.0f ? qMin(currentEnergy / threshold, 2.0f) : 1.0f;
+            m_currentBeatInfo.lastBeatTime = currentTime;
+            emit beatDetected(m_currentBeatInfo);
+        }
+        m_lastEnergy = currentEnergy;
+        return;
+    }
+    
+    bool isBeat = (currentEnergy > threshold) && (currentEnergy > m_lastEnergy * 1.1f);
+    
     if (isBeat) {
         // Avoid detecting beats too frequently (minimum 100ms apart)
         if (currentTime - m_currentBeatInfo.lastBeatTime > 100) {
@@ -766,7 +993,8 @@ void AudioVisualizer::updateBPMEstimation()
     }
     
     // Calculate average time between beats
-    QVector<qint64> intervals;
+    QVector<qint64>& intervals = m_beatIntervals;
+    intervals.clear();
     for (int i = 1; i < m_beatTimes.size(); ++i) {
         intervals.append(m_beatTimes[i] - m_beatTimes[i-1]);
     }
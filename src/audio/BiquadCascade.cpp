@@ -0,0 +1,212 @@
+#include "audio/BiquadCascade.h"
+#include <QtMath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EONPLAY_BIQUAD_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define EONPLAY_BIQUAD_NEON
+#include <arm_neon.h>
+#endif
+
+BiquadCascade::BiquadCascade()
+    : m_stageCount(0)
+{
+    std::fill(std::begin(m_bypass), std::end(m_bypass), true);
+    for (int stage = 0; stage < MAX_STAGES; ++stage) {
+        setCoefficients(stage, 1.0, 0.0, 0.0, 0.0, 0.0);
+    }
+    reset();
+    std::fill(std::begin(m_block), std::end(m_block), 0.0);
+}
+
+void BiquadCascade::setStageCount(int count)
+{
+    count = qBound(0, count, MAX_STAGES);
+
+    for (int stage = m_stageCount; stage < count; ++stage) {
+        setCoefficients(stage, 1.0, 0.0, 0.0, 0.0, 0.0);
+        m_z1[stage * 2] = m_z1[stage * 2 + 1] = 0.0;
+        m_z2[stage * 2] = m_z2[stage * 2 + 1] = 0.0;
+    }
+
+    m_stageCount = count;
+}
+
+void BiquadCascade::setCoefficients(int stage, double b0, double b1, double b2, double a1, double a2)
+{
+    if (stage < 0 || stage >= MAX_STAGES) {
+        return;
+    }
+
+    for (int lane = 0; lane < 2; ++lane) {
+        m_b0[stage * 2 + lane] = b0;
+        m_b1[stage * 2 + lane] = b1;
+        m_b2[stage * 2 + lane] = b2;
+        m_a1[stage * 2 + lane] = a1;
+        m_a2[stage * 2 + lane] = a2;
+    }
+
+    const bool bypass = (b0 == 1.0 && b1 == 0.0 && b2 == 0.0 && a1 == 0.0 && a2 == 0.0);
+    if (m_bypass[stage] && !bypass) {
+        // State left over from before the bypass would ring out as a click
+        m_z1[stage * 2] = m_z1[stage * 2 + 1] = 0.0;
+        m_z2[stage * 2] = m_z2[stage * 2 + 1] = 0.0;
+    }
+    m_bypass[stage] = bypass;
+}
+
+void BiquadCascade::setPeakingEQ(int stage, double sampleRate, double frequency, double gainDb, double q)
+{
+    if (gainDb == 0.0 || sampleRate <= 0.0 || q <= 0.0) {
+        setCoefficients(stage, 1.0, 0.0, 0.0, 0.0, 0.0);
+        return;
+    }
+
+    // RBJ cookbook peaking EQ
+    double A = qPow(10.0, gainDb / 40.0);
+    double omega = 2.0 * M_PI * frequency / sampleRate;
+    double sinOmega = qSin(omega);
+    double cosOmega = qCos(omega);
+    double alpha = sinOmega / (2.0 * q);
+
+    double a0 = 1.0 + alpha / A;
+    setCoefficients(stage,
+                    (1.0 + alpha * A) / a0,
+                    (-2.0 * cosOmega) / a0,
+                    (1.0 - alpha * A) / a0,
+                    (-2.0 * cosOmega) / a0,
+                    (1.0 - alpha / A) / a0);
+}
+
+void BiquadCascade::copyCoefficients(const BiquadCascade& other)
+{
+    // Stages that were not running, or were bypassed, start from silence
+    for (int stage = 0; stage < other.m_stageCount; ++stage) {
+        const bool added = stage >= m_stageCount;
+        const bool resumed = !added && m_bypass[stage] && !other.m_bypass[stage];
+        if (added || resumed) {
+            m_z1[stage * 2] = m_z1[stage * 2 + 1] = 0.0;
+            m_z2[stage * 2] = m_z2[stage * 2 + 1] = 0.0;
+        }
+    }
+
+    std::copy(std::begin(other.m_b0), std::end(other.m_b0), std::begin(m_b0));
+    std::copy(std::begin(other.m_b1), std::end(other.m_b1), std::begin(m_b1));
+    std::copy(std::begin(other.m_b2), std::end(other.m_b2), std::begin(m_b2));
+    std::copy(std::begin(other.m_a1), std::end(other.m_a1), std::begin(m_a1));
+    std::copy(std::begin(other.m_a2), std::end(other.m_a2), std::begin(m_a2));
+    std::copy(std::begin(other.m_bypass), std::end(other.m_bypass), std::begin(m_bypass));
+    m_stageCount = other.m_stageCount;
+}
+
+void BiquadCascade::reset()
+{
+    std::fill(std::begin(m_z1), std::end(m_z1), 0.0);
+    std::fill(std::begin(m_z2), std::end(m_z2), 0.0);
+}
+
+void BiquadCascade::process(float* left, float* right, int frames)
+{
+    for (int offset = 0; offset < frames; offset += BLOCK_SIZE) {
+        const int count = qMin(BLOCK_SIZE, frames - offset);
+
+        for (int i = 0; i < count; ++i) {
+            m_block[i * 2] = left[offset + i];
+            m_block[i * 2 + 1] = right[offset + i];
+        }
+
+        processBlock(count);
+
+        for (int i = 0; i < count; ++i) {
+            left[offset + i] = static_cast<float>(m_block[i * 2]);
+            right[offset + i] = static_cast<float>(m_block[i * 2 + 1]);
+        }
+    }
+}
+
+void BiquadCascade::processBlock(int frames)
+{
+    // Transposed direct form II, one stage at a time over the whole block:
+    //   y = b0*x + z1;  z1 = b1*x - a1*y + z2;  z2 = b2*x - a2*y
+    for (int stage = 0; stage < m_stageCount; ++stage) {
+        if (m_bypass[stage]) {
+            continue;
+        }
+
+        const int lane = stage * 2;
+
+#if defined(EONPLAY_BIQUAD_SSE2)
+        const __m128d b0 = _mm_load_pd(&m_b0[lane]);
+        const __m128d b1 = _mm_load_pd(&m_b1[lane]);
+        const __m128d b2 = _mm_load_pd(&m_b2[lane]);
+        const __m128d a1 = _mm_load_pd(&m_a1[lane]);
+        const __m128d a2 = _mm_load_pd(&m_a2[lane]);
+        __m128d z1 = _mm_load_pd(&m_z1[lane]);
+        __m128d z2 = _mm_load_pd(&m_z2[lane]);
+
+        for (int i = 0; i < frames; ++i) {
+            const __m128d x = _mm_load_pd(&m_block[i * 2]);
+            const __m128d y = _mm_add_pd(_mm_mul_pd(b0, x), z1);
+            z1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1, x), _mm_mul_pd(a1, y)), z2);
+            z2 = _mm_sub_pd(_mm_mul_pd(b2, x), _mm_mul_pd(a2, y));
+            _mm_store_pd(&m_block[i * 2], y);
+        }
+
+        _mm_store_pd(&m_z1[lane], z1);
+        _mm_store_pd(&m_z2[lane], z2);
+#elif defined(EONPLAY_BIQUAD_NEON)
+        const float64x2_t b0 = vld1q_f64(&m_b0[lane]);
+        const float64x2_t b1 = vld1q_f64(&m_b1[lane]);
+        const float64x2_t b2 = vld1q_f64(&m_b2[lane]);
+        const float64x2_t a1 = vld1q_f64(&m_a1[lane]);
+        const float64x2_t a2 = vld1q_f64(&m_a2[lane]);
+        float64x2_t z1 = vld1q_f64(&m_z1[lane]);
+        float64x2_t z2 = vld1q_f64(&m_z2[lane]);
+
+        for (int i = 0; i < frames; ++i) {
+            const float64x2_t x = vld1q_f64(&m_block[i * 2]);
+            const float64x2_t y = vfmaq_f64(z1, b0, x);
+            z1 = vfmsq_f64(vfmaq_f64(z2, b1, x), a1, y);
+            z2 = vfmsq_f64(vmulq_f64(b2, x), a2, y);
+            vst1q_f64(&m_block[i * 2], y);
+        }
+
+        vst1q_f64(&m_z1[lane], z1);
+        vst1q_f64(&m_z2[lane], z2);
+#else
+        for (int ch = 0; ch < 2; ++ch) {
+            const double b0 = m_b0[lane + ch];
+            const double b1 = m_b1[lane + ch];
+            const double b2 = m_b2[lane + ch];
+            const double a1 = m_a1[lane + ch];
+            const double a2 = m_a2[lane + ch];
+            double z1 = m_z1[lane + ch];
+            double z2 = m_z2[lane + ch];
+
+            for (int i = 0; i < frames; ++i) {
+                const double x = m_block[i * 2 + ch];
+                const double y = b0 * x + z1;
+                z1 = b1 * x - a1 * y + z2;
+                z2 = b2 * x - a2 * y;
+                m_block[i * 2 + ch] = y;
+            }
+
+            m_z1[lane + ch] = z1;
+            m_z2[lane + ch] = z2;
+        }
+#endif
+    }
+}
+
+QString BiquadCascade::simdBackend()
+{
+#if defined(EONPLAY_BIQUAD_SSE2)
+    return QStringLiteral("SSE2");
+#elif defined(EONPLAY_BIQUAD_NEON)
+    return QStringLiteral("NEON");
+#else
+    return QStringLiteral("Scalar");
+#endif
+}
@@ -0,0 +1,314 @@
+#include "audio/CrossfadeMixer.h"
+#include "audio/AudioKernels.h"
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+Q_LOGGING_CATEGORY(audioCrossfade, "audio.crossfade")
+
+CrossfadeMixer::CrossfadeMixer()
+    : m_currentId(0)
+    , m_nextId(0)
+    , m_lastDeckId(0)
+    , m_serial(0)
+    , m_appliedSerial(0)
+    , m_sharedPlayingId(0)
+    , m_sharedIncomingId(0)
+    , m_playing(nullptr)
+    , m_playingId(0)
+    , m_playingStartMs(0)
+    , m_playedFrames(0)
+    , m_incoming(nullptr)
+    , m_incomingId(0)
+    , m_incomingStartMs(0)
+    , m_incomingFrames(0)
+    , m_promotedFromId(0)
+    , m_fadeArmed(false)
+    , m_fadeStartFrame(0)
+    , m_fadeFrames(0)
+    , m_fadePosition(0)
+{
+}
+
+void CrossfadeMixer::setSource(SourceCallback source, qint64 startMs)
+{
+    QMutexLocker locker(&m_controlMutex);
+    syncLocked();
+
+    m_currentId = source ? addDeckLocked(std::move(source)) : 0;
+    m_nextId = 0;
+    publishLocked(startMs, Crossfade());
+}
+
+void CrossfadeMixer::crossfadeTo(SourceCallback next, const Crossfade& fade)
+{
+    if (!next) {
+        return;
+    }
+
+    QMutexLocker locker(&m_controlMutex);
+    syncLocked();
+
+    // Nothing to fade from, so just start playing
+    if (m_currentId == 0) {
+        m_currentId = addDeckLocked(std::move(next));
+        publishLocked(fade.nextStartMs, Crossfade());
+        return;
+    }
+
+    m_nextId = addDeckLocked(std::move(next));
+    publishLocked(0, fade);
+
+    qCDebug(audioCrossfade) << "Crossfade of" << fade.fadeMs << "ms queued"
+                            << (fade.bpm > 0.0 ? "on the beat grid" : "");
+}
+
+bool CrossfadeMixer::isCrossfading()
+{
+    QMutexLocker locker(&m_controlMutex);
+    syncLocked();
+    return m_nextId != 0;
+}
+
+CrossfadeMixer::SourceCallback CrossfadeMixer::sourceCallback()
+{
+    return [this](AudioBlock& block) {
+        return pull(block);
+    };
+}
+
+quint64 CrossfadeMixer::addDeckLocked(SourceCallback source)
+{
+    Deck deck;
+    deck.id = ++m_lastDeckId;
+    deck.source = std::make_shared<SourceCallback>(std::move(source));
+    m_decks.append(deck);
+    return deck.id;
+}
+
+CrossfadeMixer::SourceCallback* CrossfadeMixer::deckLocked(quint64 id) const
+{
+    for (const Deck& deck : m_decks) {
+        if (deck.id == id) {
+            return deck.source.get();
+        }
+    }
+    return nullptr;
+}
+
+void CrossfadeMixer::publishLocked(qint64 startMs, const Crossfade& fade)
+{
+    Plan& plan = m_planBuffer.writeBuffer();
+    plan.serial = ++m_serial;
+    plan.currentId = m_currentId;
+    plan.current = deckLocked(m_currentId);
+    plan.nextId = m_nextId;
+    plan.next = deckLocked(m_nextId);
+    plan.startMs = startMs;
+    plan.fade = fade;
+    m_planBuffer.publish();
+}
+
+void CrossfadeMixer::syncLocked()
+{
+    // Until the audio thread has seen the latest plan it may still pick up
+    // any deck an earlier plan named
+    if (m_appliedSerial.load(std::memory_order_acquire) != m_serial) {
+        return;
+    }
+
+    const quint64 playing = m_sharedPlayingId.load(std::memory_order_acquire);
+    const quint64 incoming = m_sharedIncomingId.load(std::memory_order_acquire);
+
+    // A fade finished: the incoming deck is now the current one
+    if (playing != 0 && playing != m_currentId) {
+        m_currentId = playing;
+        if (m_nextId == playing) {
+            m_nextId = 0;
+        }
+    }
+
+    // Decks are only ever handed to the audio thread by a plan, so one
+    // neither named nor held can be freed
+    m_decks.erase(std::remove_if(m_decks.begin(), m_decks.end(),
+                                 [this, playing, incoming](const Deck& deck) {
+                                     return deck.id != m_currentId && deck.id != m_nextId
+                                            && deck.id != playing && deck.id != incoming;
+                                 }),
+                  m_decks.end());
+}
+
+void CrossfadeMixer::adoptPlan()
+{
+    if (!m_planBuffer.consume()) {
+        return;
+    }
+
+    const Plan& plan = m_planBuffer.readBuffer();
+
+    // A plan written before the control thread noticed the last completed
+    // fade still names the deck that fade left as current
+    const bool stale = plan.currentId != 0 && plan.currentId == m_promotedFromId;
+    if (!stale && plan.currentId != m_playingId) {
+        m_playing = plan.current;
+        m_playingId = plan.currentId;
+        m_playingStartMs = plan.startMs;
+        m_playedFrames = 0;
+    }
+
+    if (plan.nextId != m_incomingId && plan.nextId != m_playingId) {
+        m_incoming = plan.next;
+        m_incomingId = plan.nextId;
+        m_incomingStartMs = plan.fade.nextStartMs;
+        m_incomingFrames = 0;
+        m_fade = plan.fade;
+        m_fadeArmed = m_incoming != nullptr;
+    }
+
+    m_sharedPlayingId.store(m_playingId, std::memory_order_relaxed);
+    m_sharedIncomingId.store(m_incomingId, std::memory_order_relaxed);
+    m_appliedSerial.store(plan.serial, std::memory_order_release);
+}
+
+void CrossfadeMixer::armFade(int sampleRate)
+{
+    const double framesPerMs = sampleRate / 1000.0;
+    double fadeFrames = qMax(1, m_fade.fadeMs) * framesPerMs;
+
+    qint64 start = m_playedFrames;
+    if (m_fade.startMs >= 0) {
+        start = qMax(start, qRound64((m_fade.startMs - m_playingStartMs) * framesPerMs));
+    }
+
+    // Start on the first beat at or after the requested frame and end on one too
+    if (m_fade.bpm > 0.0) {
+        const double beatFrames = 60.0 * sampleRate / m_fade.bpm;
+        fadeFrames = qMax(1.0, std::round(fadeFrames / beatFrames)) * beatFrames;
+
+        const double firstBeat = (m_fade.firstBeatMs - m_playingStartMs) * framesPerMs;
+        const double beats = qMax(0.0, std::ceil((start - firstBeat) / beatFrames));
+        start = qMax(m_playedFrames, static_cast<qint64>(std::ceil(firstBeat + beats * beatFrames)));
+    }
+
+    m_fadeStartFrame = start;
+    m_fadeFrames = qMax<qint64>(1, qRound64(fadeFrames));
+    m_fadePosition = 0;
+    m_fadeArmed = false;
+}
+
+int CrossfadeMixer::pull(AudioBlock& block)
+{
+    adoptPlan();
+    if (!m_playing) {
+        return 0;
+    }
+
+    if (m_incoming) {
+        if (m_fadeArmed) {
+            armFade(block.sampleRate);
+        }
+        if (m_playedFrames >= m_fadeStartFrame) {
+            return pullCrossfade(block);
+        }
+
+        // Stop short of the start frame so the fade begins exactly on it
+        block.frames = static_cast<int>(qMin<qint64>(block.frames, m_fadeStartFrame - m_playedFrames));
+    }
+
+    const int got = qBound(0, (*m_playing)(block), block.frames);
+    m_playedFrames += got;
+
+    // The outgoing stream ended before the fade was due
+    if (got == 0 && m_incoming) {
+        promote();
+        return qBound(0, (*m_playing)(block), block.frames);
+    }
+    return got;
+}
+
+int CrossfadeMixer::pullCrossfade(AudioBlock& block)
+{
+    const int frames = qMin(block.frames, static_cast<int>(AudioDSPGraph::MAX_BLOCK_FRAMES));
+    block.frames = frames;
+
+    const int outgoingGot = qBound(0, (*m_playing)(block), frames);
+    m_playedFrames += outgoingGot;
+
+    AudioBlock incoming;
+    incoming.channels[0] = m_incomingLeft;
+    incoming.channels[1] = m_incomingRight;
+    incoming.channelCount = 2;
+    incoming.frames = frames;
+    incoming.sampleRate = block.sampleRate;
+    const int incomingGot = qBound(0, (*m_incoming)(incoming), frames);
+    m_incomingFrames += incomingGot;
+
+    if (incoming.channelCount == 1) {
+        std::copy_n(m_incomingLeft, incomingGot, m_incomingRight);
+    }
+
+    // Streams at different rates cannot be mixed sample by sample
+    if (incoming.sampleRate != block.sampleRate) {
+        qCDebug(audioCrossfade) << "Cutting over, incoming stream runs at" << incoming.sampleRate
+                                << "Hz instead of" << block.sampleRate;
+        for (int c = 0; c < block.channelCount; ++c) {
+            std::copy_n(incoming.channels[c], incomingGot, block.channels[c]);
+        }
+        block.sampleRate = incoming.sampleRate;
+        promote();
+        return incomingGot;
+    }
+
+    const int count = qMax(outgoingGot, incomingGot);
+    if (count == 0) {
+        promote();
+        return 0;
+    }
+
+    // Whichever stream ran out first is silent for the rest of the block
+    for (int c = 0; c < block.channelCount; ++c) {
+        std::fill(block.channels[c] + outgoingGot, block.channels[c] + count, 0.0f);
+        std::fill(incoming.channels[c] + incomingGot, incoming.channels[c] + count, 0.0f);
+    }
+
+    // Equal-power gains at the block edges, ramped in between; past the end
+    // of the fade only the incoming stream remains
+    const int fadeCount = static_cast<int>(qMin<qint64>(count, m_fadeFrames - m_fadePosition));
+    const double startPhase = M_PI_2 * m_fadePosition / m_fadeFrames;
+    const double endPhase = M_PI_2 * (m_fadePosition + fadeCount) / m_fadeFrames;
+    const float outStart = static_cast<float>(std::cos(startPhase));
+    const float outEnd = static_cast<float>(std::cos(endPhase));
+    const float inStart = static_cast<float>(std::sin(startPhase));
+    const float inEnd = static_cast<float>(std::sin(endPhase));
+
+    for (int c = 0; c < block.channelCount; ++c) {
+        AudioKernels::applyGainRamp(block.channels[c], fadeCount, outStart, outEnd);
+        AudioKernels::applyGainRamp(incoming.channels[c], fadeCount, inStart, inEnd);
+        AudioKernels::mixInto(block.channels[c], incoming.channels[c], fadeCount, 1.0f);
+        std::copy_n(incoming.channels[c] + fadeCount, count - fadeCount, block.channels[c] + fadeCount);
+    }
+
+    m_fadePosition += fadeCount;
+    if (m_fadePosition >= m_fadeFrames) {
+        promote();
+    }
+    return count;
+}
+
+void CrossfadeMixer::promote()
+{
+    m_promotedFromId = m_playingId;
+    m_playing = m_incoming;
+    m_playingId = m_incomingId;
+    m_playingStartMs = m_incomingStartMs;
+    m_playedFrames = m_incomingFrames;
+
+    m_incoming = nullptr;
+    m_incomingId = 0;
+    m_fadeArmed = false;
+
+    m_sharedPlayingId.store(m_playingId, std::memory_order_release);
+    m_sharedIncomingId.store(0, std::memory_order_release);
+}
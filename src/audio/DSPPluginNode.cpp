@@ -0,0 +1,295 @@
+#include "audio/DSPPluginNode.h"
+#include "security/SecurityManager.h"
+#include <QFileInfo>
+#include <QLibrary>
+#include <QLoggingCategory>
+#include <algorithm>
+#include <cstring>
+
+Q_DECLARE_LOGGING_CATEGORY(dspPlugin)
+Q_LOGGING_CATEGORY(dspPlugin, "audio.graph.plugin")
+
+namespace {
+
+bool isAligned(const float* data)
+{
+    return (reinterpret_cast<quintptr>(data) % AudioBlock::ALIGNMENT) == 0;
+}
+
+float* alignUp(float* data)
+{
+    const quintptr address = reinterpret_cast<quintptr>(data);
+    const quintptr mask = AudioBlock::ALIGNMENT - 1;
+    return reinterpret_cast<float*>((address + mask) & ~mask);
+}
+
+void setError(QString* errorMessage, const QString& message)
+{
+    qCWarning(dspPlugin) << message;
+    if (errorMessage) {
+        *errorMessage = message;
+    }
+}
+
+} // namespace
+
+static_assert(AudioBlock::ALIGNMENT == EONPLAY_DSP_ALIGNMENT, "The graph must align blocks as the plugin ABI promises");
+
+std::shared_ptr<DSPPluginNode> DSPPluginNode::load(const QString& path, SecurityManager* security,
+                                                   QString* errorMessage)
+{
+    const QString filePath = QFileInfo(path).absoluteFilePath();
+
+    // Nothing from the file runs before it is vouched for
+    if (!security) {
+        setError(errorMessage, QStringLiteral("No security manager to verify %1").arg(filePath));
+        return nullptr;
+    }
+    if (!security->verifyPluginSignature(filePath) && !security->isPluginTrusted(filePath)) {
+        setError(errorMessage, QStringLiteral("Plugin is neither signed nor trusted: %1").arg(filePath));
+        return nullptr;
+    }
+
+    auto library = std::make_unique<QLibrary>(filePath);
+    if (!library->load()) {
+        setError(errorMessage, QStringLiteral("Cannot load %1: %2").arg(filePath, library->errorString()));
+        return nullptr;
+    }
+
+    const auto entry = reinterpret_cast<EonPlayDspEntryFunction>(library->resolve(EONPLAY_DSP_ENTRY_SYMBOL));
+    const EonPlayDspDescriptor* descriptor = entry ? entry(EONPLAY_DSP_ABI_VERSION) : nullptr;
+    if (!descriptor) {
+        setError(errorMessage, QStringLiteral("%1 is not an EonPlay DSP plugin for ABI %2")
+                                   .arg(filePath).arg(EONPLAY_DSP_ABI_VERSION));
+        return nullptr;
+    }
+    if (descriptor->abiVersion != EONPLAY_DSP_ABI_VERSION || descriptor->structSize < sizeof(EonPlayDspDescriptor) ||
+        !descriptor->create || !descriptor->destroy || !descriptor->prepare || !descriptor->process) {
+        setError(errorMessage, QStringLiteral("%1 has an incompatible descriptor").arg(filePath));
+        return nullptr;
+    }
+
+    std::shared_ptr<DSPPluginNode> node(new DSPPluginNode(std::move(library), descriptor, filePath));
+    qCDebug(dspPlugin) << "Loaded" << node->name() << "from" << filePath << "with"
+                       << node->m_parameters.size() << "parameters";
+    return node;
+}
+
+DSPPluginNode::DSPPluginNode(std::unique_ptr<QLibrary> library, const EonPlayDspDescriptor* descriptor,
+                             const QString& path)
+    : m_library(std::move(library))
+    , m_descriptor(descriptor)
+    , m_path(path)
+    , m_parameterQueue(PARAMETER_QUEUE_SIZE)
+    , m_pending(nullptr)
+    , m_retired(RETIRED_QUEUE_SIZE)
+    , m_latencyFrames(0)
+    , m_preparedRate(0)
+    , m_preparedFrames(0)
+    , m_current(nullptr)
+{
+    const int count = qMin(static_cast<int>(descriptor->parameterCount), MAX_PARAMETERS);
+    if (static_cast<int>(descriptor->parameterCount) > count) {
+        qCWarning(dspPlugin) << name() << "exposes" << descriptor->parameterCount << "parameters, using the first"
+                             << count;
+    }
+
+    m_values.reset(new std::atomic<float>[qMax(count, 1)]);
+    for (int i = 0; i < count && descriptor->parameters; ++i) {
+        const EonPlayDspParameter& source = descriptor->parameters[i];
+        Parameter parameter;
+        parameter.id = source.id;
+        parameter.name = QString::fromUtf8(source.name);
+        parameter.minValue = source.minValue;
+        parameter.maxValue = source.maxValue;
+        parameter.defaultValue = source.defaultValue;
+        m_parameterIndex.insert(parameter.id, m_parameters.size());
+        m_values[m_parameters.size()].store(parameter.defaultValue, std::memory_order_relaxed);
+        m_parameters.append(parameter);
+    }
+
+    // Two channels of the largest block, plus room to align the start
+    m_staging.resize(AudioBlock::MAX_CHANNELS * AudioDSPGraph::MAX_BLOCK_FRAMES +
+                     AudioBlock::ALIGNMENT / static_cast<int>(sizeof(float)));
+}
+
+DSPPluginNode::~DSPPluginNode()
+{
+    // The graph keeps nodes alive until the audio thread stopped running them
+    destroyInstance(m_pending.exchange(nullptr));
+    collectRetired();
+    destroyInstance(m_current);
+    m_current = nullptr;
+}
+
+QString DSPPluginNode::name() const
+{
+    return QString::fromUtf8(m_descriptor->name ? m_descriptor->name : m_descriptor->id);
+}
+
+QString DSPPluginNode::pluginId() const
+{
+    return QString::fromUtf8(m_descriptor->id);
+}
+
+QString DSPPluginNode::vendor() const
+{
+    return QString::fromUtf8(m_descriptor->vendor);
+}
+
+QString DSPPluginNode::path() const
+{
+    return m_path;
+}
+
+QVector<DSPPluginNode::Parameter> DSPPluginNode::parameters() const
+{
+    return m_parameters;
+}
+
+bool DSPPluginNode::setParameter(quint32 id, float value)
+{
+    const auto index = m_parameterIndex.constFind(id);
+    if (index == m_parameterIndex.constEnd()) {
+        return false;
+    }
+
+    const Parameter& parameter = m_parameters.at(*index);
+    const EonPlayDspParameterChange change{id, qBound(parameter.minValue, value, parameter.maxValue)};
+
+    // An instance adopted later starts from this value even if the queue is full
+    m_values[*index].store(change.value, std::memory_order_relaxed);
+    return m_parameterQueue.write(&change, 1) == 1;
+}
+
+float DSPPluginNode::parameter(quint32 id) const
+{
+    const auto index = m_parameterIndex.constFind(id);
+    return index != m_parameterIndex.constEnd() ? m_values[*index].load(std::memory_order_relaxed) : 0.0f;
+}
+
+void DSPPluginNode::prepare(int sampleRate, int maxFrames)
+{
+    collectRetired();
+
+    if (maxFrames <= 0 || (sampleRate == m_preparedRate && maxFrames == m_preparedFrames)) {
+        return;
+    }
+
+    void* handle = m_descriptor->create();
+    if (!handle) {
+        qCWarning(dspPlugin) << name() << "failed to create an instance";
+        return;
+    }
+    if (m_descriptor->prepare(handle, static_cast<uint32_t>(sampleRate), AudioBlock::MAX_CHANNELS,
+                              static_cast<uint32_t>(maxFrames)) != 0) {
+        qCWarning(dspPlugin) << name() << "cannot run at" << sampleRate << "Hz";
+        m_descriptor->destroy(handle);
+        return;
+    }
+
+    Instance* instance = new Instance{handle, sampleRate, maxFrames,
+                                      m_descriptor->latency ? static_cast<int>(m_descriptor->latency(handle)) : 0};
+    m_latencyFrames.store(instance->latencyFrames, std::memory_order_relaxed);
+    m_preparedRate = sampleRate;
+    m_preparedFrames = maxFrames;
+
+    // An instance published earlier but never adopted is still ours
+    destroyInstance(m_pending.exchange(instance, std::memory_order_acq_rel));
+
+    qCDebug(dspPlugin) << "Prepared" << name() << "for" << sampleRate << "Hz," << instance->latencyFrames
+                       << "frames latency";
+}
+
+int DSPPluginNode::latencyFrames() const
+{
+    return m_latencyFrames.load(std::memory_order_relaxed);
+}
+
+void DSPPluginNode::destroyInstance(Instance* instance)
+{
+    if (instance) {
+        m_descriptor->destroy(instance->handle);
+        delete instance;
+    }
+}
+
+void DSPPluginNode::collectRetired()
+{
+    Instance* instance = nullptr;
+    while (m_retired.read(&instance, 1) == 1) {
+        destroyInstance(instance);
+    }
+}
+
+int DSPPluginNode::takeParameterChanges(bool snapshot)
+{
+    int count = 0;
+    if (snapshot) {
+        for (int i = 0; i < m_parameters.size(); ++i) {
+            m_changes[count++] = {m_parameters.at(i).id, m_values[i].load(std::memory_order_relaxed)};
+        }
+    }
+    return count + m_parameterQueue.read(m_changes + count, MAX_PARAMETER_CHANGES);
+}
+
+void DSPPluginNode::process(AudioBlock& block)
+{
+    // Switch to a prepared instance once the audio is at its rate
+    bool adopted = false;
+    Instance* pending = m_pending.load(std::memory_order_acquire);
+    if (pending && pending->sampleRate == block.sampleRate &&
+        m_pending.compare_exchange_strong(pending, nullptr, std::memory_order_acq_rel)) {
+        // One instance is retired per prepare() at most, which empties the queue
+        if (m_current && m_retired.write(&m_current, 1) != 1) {
+            qCWarning(dspPlugin) << "Retired instance queue full, leaking an instance of" << name();
+        }
+        m_current = pending;
+        adopted = true;
+    }
+
+    if (!m_current || block.frames <= 0) {
+        return;
+    }
+
+    const int channelCount = qBound(1, block.channelCount, static_cast<int>(AudioBlock::MAX_CHANNELS));
+    bool aligned = true;
+    for (int channel = 0; channel < channelCount; ++channel) {
+        aligned = aligned && isAligned(block.channels[channel]);
+    }
+
+    float* channels[AudioBlock::MAX_CHANNELS];
+    float* staging = alignUp(m_staging.data());
+
+    EonPlayDspBlock pluginBlock;
+    pluginBlock.channels = channels;
+    pluginBlock.channelCount = static_cast<uint32_t>(channelCount);
+    pluginBlock.sampleRate = static_cast<uint32_t>(block.sampleRate);
+
+    const int chunk = aligned ? m_current->maxFrames : qMin(m_current->maxFrames, AudioDSPGraph::MAX_BLOCK_FRAMES);
+    for (int offset = 0; offset < block.frames; offset += chunk) {
+        const int frames = qMin(chunk, block.frames - offset);
+
+        for (int channel = 0; channel < channelCount; ++channel) {
+            if (aligned) {
+                channels[channel] = block.channels[channel] + offset;
+            } else {
+                channels[channel] = staging + channel * AudioDSPGraph::MAX_BLOCK_FRAMES;
+                std::memcpy(channels[channel], block.channels[channel] + offset, frames * sizeof(float));
+            }
+        }
+
+        pluginBlock.frames = static_cast<uint32_t>(frames);
+        pluginBlock.parameterChanges = m_changes;
+        pluginBlock.parameterChangeCount = static_cast<uint32_t>(takeParameterChanges(adopted));
+        adopted = false;
+
+        m_descriptor->process(m_current->handle, &pluginBlock);
+
+        if (!aligned) {
+            for (int channel = 0; channel < channelCount; ++channel) {
+                std::memcpy(block.channels[channel] + offset, channels[channel], frames * sizeof(float));
+            }
+        }
+    }
+}
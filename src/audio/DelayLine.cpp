@@ -0,0 +1,92 @@
+#include "audio/DelayLine.h"
+#include <QtMath>
+#include <algorithm>
+
+DelayLine::DelayLine(int maxDelayFrames)
+    : m_mask(0)
+    , m_write(0)
+    , m_maxDelay(qMax(0, maxDelayFrames))
+    , m_delay(0.0)
+    , m_target(0.0)
+    , m_fadeFrom(0.0)
+    , m_fadeRemaining(0)
+{
+    // Room for the longest delay plus the interpolation neighbours
+    int size = 4;
+    while (size < m_maxDelay + 4) {
+        size <<= 1;
+    }
+    m_left.fill(0.0f, size);
+    m_right.fill(0.0f, size);
+    m_mask = size - 1;
+}
+
+void DelayLine::setDelay(double frames)
+{
+    m_target = qBound(0.0, frames, double(m_maxDelay));
+}
+
+void DelayLine::reset()
+{
+    std::fill(m_left.begin(), m_left.end(), 0.0f);
+    std::fill(m_right.begin(), m_right.end(), 0.0f);
+    m_delay = m_target;
+    m_fadeRemaining = 0;
+}
+
+void DelayLine::process(float* left, float* right, int frames)
+{
+    for (int i = 0; i < frames; ++i) {
+        m_write = (m_write + 1) & m_mask;
+        m_left[m_write] = left[i];
+        m_right[m_write] = right[i];
+
+        if (m_fadeRemaining == 0 && m_delay != m_target) {
+            const double change = m_target - m_delay;
+            if (qAbs(change) > GLIDE_LIMIT) {
+                m_fadeFrom = m_delay;
+                m_delay = m_target;
+                m_fadeRemaining = CROSSFADE_FRAMES;
+            } else {
+                m_delay += qBound(-GLIDE_STEP, change, GLIDE_STEP);
+            }
+        }
+
+        float outLeft = read(m_left, m_delay);
+        float outRight = read(m_right, m_delay);
+        if (m_fadeRemaining > 0) {
+            const float oldGain = float(m_fadeRemaining) / CROSSFADE_FRAMES;
+            outLeft += (read(m_left, m_fadeFrom) - outLeft) * oldGain;
+            outRight += (read(m_right, m_fadeFrom) - outRight) * oldGain;
+            --m_fadeRemaining;
+        }
+
+        left[i] = outLeft;
+        right[i] = outRight;
+    }
+}
+
+float DelayLine::read(const QVector<float>& line, double delay) const
+{
+    const int whole = static_cast<int>(delay);
+    const float t = static_cast<float>(delay - whole);
+    const float* samples = line.constData();
+
+    // x0 is the frame whole frames back, x1 the one before it
+    const float x0 = samples[(m_write - whole) & m_mask];
+    if (t == 0.0f) {
+        return x0;
+    }
+    const float x1 = samples[(m_write - whole - 1) & m_mask];
+    if (whole == 0) {
+        return x0 + (x1 - x0) * t;     // Nothing newer than x0 yet
+    }
+
+    // Hermite through the newer neighbour of x0 and the older one of x1
+    const float xm1 = samples[(m_write - whole + 1) & m_mask];
+    const float x2 = samples[(m_write - whole - 2) & m_mask];
+    const float c1 = 0.5f * (x1 - xm1);
+    const float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+    const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+    return ((c3 * t + c2) * t + c1) * t + x0;
+}
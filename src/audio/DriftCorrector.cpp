@@ -0,0 +1,148 @@
+#include "audio/DriftCorrector.h"
+#include "audio/AudioKernels.h"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EONPLAY_DRIFT_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define EONPLAY_DRIFT_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Dot product of one phase against both channel histories
+ */
+inline void dotStereo(const float* coefficients, const float* left, const float* right,
+                      float& outLeft, float& outRight)
+{
+    constexpr int taps = DriftCorrector::TAPS;
+
+#if defined(EONPLAY_DRIFT_SSE2)
+    __m128 accLeft = _mm_setzero_ps();
+    __m128 accRight = _mm_setzero_ps();
+    for (int j = 0; j < taps; j += 4) {
+        const __m128 c = _mm_loadu_ps(coefficients + j);
+        accLeft = _mm_add_ps(accLeft, _mm_mul_ps(c, _mm_loadu_ps(left + j)));
+        accRight = _mm_add_ps(accRight, _mm_mul_ps(c, _mm_loadu_ps(right + j)));
+    }
+
+    const __m128 low = _mm_movelh_ps(accLeft, accRight);
+    const __m128 high = _mm_movehl_ps(accRight, accLeft);
+    const __m128 pairs = _mm_add_ps(low, high);
+    const __m128 sums = _mm_add_ps(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(2, 3, 0, 1)));
+    outLeft = _mm_cvtss_f32(sums);
+    outRight = _mm_cvtss_f32(_mm_movehl_ps(sums, sums));
+#elif defined(EONPLAY_DRIFT_NEON)
+    float32x4_t accLeft = vdupq_n_f32(0.0f);
+    float32x4_t accRight = vdupq_n_f32(0.0f);
+    for (int j = 0; j < taps; j += 4) {
+        const float32x4_t c = vld1q_f32(coefficients + j);
+        accLeft = vfmaq_f32(accLeft, c, vld1q_f32(left + j));
+        accRight = vfmaq_f32(accRight, c, vld1q_f32(right + j));
+    }
+    outLeft = vaddvq_f32(accLeft);
+    outRight = vaddvq_f32(accRight);
+#else
+    float sumLeft = 0.0f;
+    float sumRight = 0.0f;
+    for (int j = 0; j < taps; ++j) {
+        sumLeft += coefficients[j] * left[j];
+        sumRight += coefficients[j] * right[j];
+    }
+    outLeft = sumLeft;
+    outRight = sumRight;
+#endif
+}
+
+} // namespace
+
+DriftCorrector::DriftCorrector()
+    : m_bank(PolyphaseResampler::filterBank(1, PHASES))
+    , m_step(1.0)
+    , m_position(0.0)
+    , m_historyIndex(0)
+{
+    reset();
+}
+
+void DriftCorrector::setRatio(double ratio)
+{
+    m_step = qBound(1.0 - MAX_TRIM, ratio, 1.0 + MAX_TRIM);
+}
+
+void DriftCorrector::reset()
+{
+    m_position = 0.0;
+    m_historyIndex = 0;
+    std::fill(std::begin(m_historyLeft), std::end(m_historyLeft), 0.0f);
+    std::fill(std::begin(m_historyRight), std::end(m_historyRight), 0.0f);
+}
+
+void DriftCorrector::push(float left, float right)
+{
+    m_historyLeft[m_historyIndex] = m_historyLeft[m_historyIndex + TAPS + 1] = left;
+    m_historyRight[m_historyIndex] = m_historyRight[m_historyIndex + TAPS + 1] = right;
+    m_historyIndex = (m_historyIndex + 1) % (TAPS + 1);
+}
+
+int DriftCorrector::process(const float* inputLeft, const float* inputRight, int inputFrames,
+                            float* interleavedOutput, int outputFrames, int* consumed)
+{
+    int used = 0;
+    int produced = 0;
+
+    // Without a bank the stream passes through unchanged
+    if (!m_bank) {
+        produced = qMin(inputFrames, outputFrames);
+        AudioKernels::interleave(inputLeft, inputRight, interleavedOutput, produced);
+        if (consumed) {
+            *consumed = produced;
+        }
+        return produced;
+    }
+
+    const float* coefficients = m_bank->coefficients.constData();
+
+    while (produced < outputFrames) {
+        // Advance the windows past every input the next output lies beyond
+        while (m_position >= 1.0 && used < inputFrames) {
+            push(inputLeft[used], inputRight[used]);
+            ++used;
+            m_position -= 1.0;
+        }
+        if (m_position >= 1.0) {
+            break;
+        }
+
+        // Phase PHASES of the older window is phase 0 of the newer one
+        const double phase = m_position * PHASES;
+        const int index = qMin(static_cast<int>(phase), PHASES - 1);
+        const float fraction = static_cast<float>(phase - index);
+        const float* older = m_historyLeft + m_historyIndex;
+        const float* olderRight = m_historyRight + m_historyIndex;
+
+        float leftA;
+        float rightA;
+        float leftB;
+        float rightB;
+        dotStereo(coefficients + index * TAPS, older, olderRight, leftA, rightA);
+        if (index + 1 < PHASES) {
+            dotStereo(coefficients + (index + 1) * TAPS, older, olderRight, leftB, rightB);
+        } else {
+            dotStereo(coefficients, older + 1, olderRight + 1, leftB, rightB);
+        }
+
+        interleavedOutput[produced * 2] = leftA + (leftB - leftA) * fraction;
+        interleavedOutput[produced * 2 + 1] = rightA + (rightB - rightA) * fraction;
+        ++produced;
+        m_position += m_step;
+    }
+
+    if (consumed) {
+        *consumed = used;
+    }
+    return produced;
+}
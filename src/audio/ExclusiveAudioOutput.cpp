@@ -0,0 +1,58 @@
+#include "audio/ExclusiveAudioOutput.h"
+#include <QLoggingCategory>
+#include <QVector>
+
+Q_LOGGING_CATEGORY(exclusiveAudio, "audio.output.exclusive")
+
+ExclusiveAudioOutput::Format ExclusiveAudioOutput::openNearest(const QString& deviceId, const Format& preferred,
+                                                                int periodFrames)
+{
+    // Precision first: a wider sample type loses nothing, a different rate does
+    QVector<SampleType> types = { preferred.sampleType };
+    for (SampleType type : { SampleType::Int32, SampleType::Float32, SampleType::Int16 }) {
+        if (!types.contains(type)) {
+            types.append(type);
+        }
+    }
+
+    QVector<int> rates = { preferred.sampleRate };
+    for (int rate : { 48000, 44100, 96000, 88200, 192000, 176400 }) {
+        if (!rates.contains(rate)) {
+            rates.append(rate);
+        }
+    }
+
+    QVector<int> channelCounts = { preferred.channels };
+    if (preferred.channels != 2) {
+        channelCounts.append(2);
+    }
+
+    for (int channels : channelCounts) {
+        for (int rate : rates) {
+            for (SampleType type : types) {
+                Format format;
+                format.sampleRate = rate;
+                format.channels = channels;
+                format.sampleType = type;
+                if (open(deviceId, format, periodFrames)) {
+                    if (format != preferred) {
+                        qCDebug(exclusiveAudio) << backendName() << "runs" << rate << "Hz" << channels
+                                                << "channels instead of" << preferred.sampleRate << "Hz"
+                                                << preferred.channels << "channels";
+                    }
+                    return format;
+                }
+            }
+        }
+    }
+
+    qCWarning(exclusiveAudio) << backendName() << "could not take device" << deviceId;
+    return Format();
+}
+
+#if !defined(Q_OS_WIN) && !defined(Q_OS_LINUX) && !defined(Q_OS_MACOS)
+std::unique_ptr<ExclusiveAudioOutput> ExclusiveAudioOutput::create()
+{
+    return nullptr;
+}
+#endif
@@ -0,0 +1,195 @@
+#include "audio/ExclusiveAudioOutput.h"
+#include "ThreadPriority.h"
+#include <QByteArray>
+#include <QLoggingCategory>
+#include <QThread>
+
+#ifdef HAVE_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(exclusiveAudio)
+
+#ifdef HAVE_ALSA
+
+namespace {
+
+/**
+ * @brief ALSA backend writing straight to a hw device
+ *
+ * hw devices have no plug, dmix or rate layer, so the card runs the
+ * stream's format or the open fails, and no other client can play while
+ * the device is held. PipeWire and PulseAudio keep their own device open
+ * and have to be told to let go (or be configured with a pro-audio profile)
+ * before a hw device can be taken.
+ */
+class AlsaExclusiveOutput : public ExclusiveAudioOutput
+{
+public:
+    ~AlsaExclusiveOutput() override
+    {
+        close();
+    }
+
+    QString backendName() const override { return QStringLiteral("ALSA hw"); }
+
+    bool open(const QString& deviceId, const Format& format, int periodFrames) override
+    {
+        close();
+
+        // Only hw devices are direct; PulseAudio and PipeWire IDs fall back to the first card
+        const QByteArray name = deviceId.startsWith(QLatin1String("hw:")) ? deviceId.toLocal8Bit()
+                                                                          : QByteArrayLiteral("hw:0,0");
+        snd_pcm_t* pcm = nullptr;
+        int error = snd_pcm_open(&pcm, name.constData(), SND_PCM_STREAM_PLAYBACK, 0);
+        if (error < 0) {
+            qCDebug(exclusiveAudio) << "Cannot open" << name << ":" << snd_strerror(error);
+            return false;
+        }
+
+        snd_pcm_hw_params_t* hw = nullptr;
+        snd_pcm_hw_params_alloca(&hw);
+        snd_pcm_hw_params_any(pcm, hw);
+
+        unsigned int rate = static_cast<unsigned int>(format.sampleRate);
+        const int requestedPeriod = periodFrames > 0 ? periodFrames : format.sampleRate * MIN_PERIOD_MS / 1000;
+        snd_pcm_uframes_t period = static_cast<snd_pcm_uframes_t>(requestedPeriod);
+        unsigned int periods = PERIODS;
+        if (snd_pcm_hw_params_set_rate_resample(pcm, hw, 0) < 0 ||
+            snd_pcm_hw_params_set_access(pcm, hw, SND_PCM_ACCESS_RW_INTERLEAVED) < 0 ||
+            snd_pcm_hw_params_set_format(pcm, hw, alsaFormat(format.sampleType)) < 0 ||
+            snd_pcm_hw_params_set_channels(pcm, hw, static_cast<unsigned int>(format.channels)) < 0 ||
+            snd_pcm_hw_params_set_rate(pcm, hw, rate, 0) < 0 ||
+            snd_pcm_hw_params_set_period_size_near(pcm, hw, &period, nullptr) < 0 ||
+            snd_pcm_hw_params_set_periods_near(pcm, hw, &periods, nullptr) < 0 ||
+            snd_pcm_hw_params(pcm, hw) < 0) {
+            snd_pcm_close(pcm);
+            return false;
+        }
+
+        snd_pcm_uframes_t buffer = 0;
+        snd_pcm_hw_params_get_period_size(hw, &period, nullptr);
+        snd_pcm_hw_params_get_buffer_size(hw, &buffer);
+
+        // Start once the buffer is full, wake once a period is free
+        snd_pcm_sw_params_t* sw = nullptr;
+        snd_pcm_sw_params_alloca(&sw);
+        snd_pcm_sw_params_current(pcm, sw);
+        snd_pcm_sw_params_set_start_threshold(pcm, sw, buffer);
+        snd_pcm_sw_params_set_avail_min(pcm, sw, period);
+        snd_pcm_sw_params(pcm, sw);
+
+        m_pcm = pcm;
+        m_format = format;
+        m_periodFrames = static_cast<int>(period);
+        m_latencyMs = buffer * 1000.0 / format.sampleRate;
+        m_buffer.resize(m_periodFrames * format.bytesPerFrame());
+
+        qCDebug(exclusiveAudio) << "Holding" << name << format.sampleRate << "Hz," << m_periodFrames
+                                << "frame periods," << m_latencyMs << "ms buffered";
+        return true;
+    }
+
+    void close() override
+    {
+        stop();
+        if (m_pcm) {
+            snd_pcm_close(m_pcm);
+            m_pcm = nullptr;
+        }
+        m_format = Format();
+    }
+
+    bool start(RenderCallback render) override
+    {
+        if (!m_pcm || m_thread) {
+            return false;
+        }
+
+        m_render = std::move(render);
+        m_running = true;
+        snd_pcm_prepare(m_pcm);
+        m_thread = QThread::create([this]() { run(); });
+        m_thread->start();
+        return true;
+    }
+
+    void stop() override
+    {
+        if (!m_thread) {
+            return;
+        }
+
+        // A blocked write returns within a period
+        m_running = false;
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+        snd_pcm_drop(m_pcm);
+    }
+
+private:
+    static constexpr int MIN_PERIOD_MS = 5;
+    static constexpr unsigned int PERIODS = 2;
+
+    static snd_pcm_format_t alsaFormat(SampleType type)
+    {
+        switch (type) {
+            case SampleType::Int16: return SND_PCM_FORMAT_S16;
+            case SampleType::Float32: return SND_PCM_FORMAT_FLOAT;
+            case SampleType::Int32:
+            default: return SND_PCM_FORMAT_S32;
+        }
+    }
+
+    void run()
+    {
+        ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Audio);
+
+        const int frameBytes = m_format.bytesPerFrame();
+        while (m_running.load(std::memory_order_relaxed)) {
+            m_render(m_buffer.data(), m_periodFrames);
+
+            const char* data = m_buffer.constData();
+            snd_pcm_sframes_t remaining = m_periodFrames;
+            while (remaining > 0 && m_running.load(std::memory_order_relaxed)) {
+                const snd_pcm_sframes_t written = snd_pcm_writei(m_pcm, data, remaining);
+                if (written < 0) {
+                    if (written == -EPIPE) {
+                        m_underruns.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    if (snd_pcm_recover(m_pcm, static_cast<int>(written), 1) < 0) {
+                        qCWarning(exclusiveAudio) << "ALSA write failed:" << snd_strerror(static_cast<int>(written));
+                        m_running = false;
+                    }
+                    continue;
+                }
+                data += written * frameBytes;
+                remaining -= written;
+            }
+        }
+    }
+
+    snd_pcm_t* m_pcm = nullptr;
+    QThread* m_thread = nullptr;
+    std::atomic<bool> m_running{false};
+    RenderCallback m_render;
+    QByteArray m_buffer;                    // One period, rendered then written
+};
+
+} // namespace
+
+std::unique_ptr<ExclusiveAudioOutput> ExclusiveAudioOutput::create()
+{
+    return std::make_unique<AlsaExclusiveOutput>();
+}
+
+#else
+
+std::unique_ptr<ExclusiveAudioOutput> ExclusiveAudioOutput::create()
+{
+    qCDebug(exclusiveAudio) << "Built without ALSA, no exclusive output";
+    return nullptr;
+}
+
+#endif
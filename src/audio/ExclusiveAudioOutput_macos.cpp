@@ -0,0 +1,320 @@
+#include "audio/ExclusiveAudioOutput.h"
+#include <QByteArray>
+#include <QLoggingCategory>
+#include <QVector>
+#include <algorithm>
+#include <cstring>
+
+#include <CoreAudio/CoreAudio.h>
+#include <unistd.h>
+
+Q_DECLARE_LOGGING_CATEGORY(exclusiveAudio)
+
+namespace {
+
+constexpr AudioObjectPropertyElement ELEMENT_MAIN = 0;     // kAudioObjectPropertyElementMain
+
+AudioObjectPropertyAddress propertyAddress(AudioObjectPropertySelector selector,
+                                           AudioObjectPropertyScope scope = kAudioObjectPropertyScopeGlobal)
+{
+    return { selector, scope, ELEMENT_MAIN };
+}
+
+template <typename T>
+bool getProperty(AudioObjectID object, const AudioObjectPropertyAddress& address, T& value)
+{
+    UInt32 size = sizeof(T);
+    return AudioObjectGetPropertyData(object, &address, 0, nullptr, &size, &value) == noErr;
+}
+
+template <typename T>
+bool setProperty(AudioObjectID object, const AudioObjectPropertyAddress& address, const T& value)
+{
+    return AudioObjectSetPropertyData(object, &address, 0, nullptr, sizeof(T), &value) == noErr;
+}
+
+template <typename T>
+QVector<T> getArrayProperty(AudioObjectID object, const AudioObjectPropertyAddress& address)
+{
+    UInt32 size = 0;
+    if (AudioObjectGetPropertyDataSize(object, &address, 0, nullptr, &size) != noErr || size == 0) {
+        return {};
+    }
+    QVector<T> values(static_cast<int>(size / sizeof(T)));
+    if (AudioObjectGetPropertyData(object, &address, 0, nullptr, &size, values.data()) != noErr) {
+        return {};
+    }
+    return values;
+}
+
+/**
+ * @brief CoreAudio backend with the device hogged
+ *
+ * Hog mode keeps every other process off the device, the nominal rate and
+ * the output stream's physical format are set to the stream's, and the
+ * HAL's IOProc is rendered into directly, one buffer of the chosen period
+ * size at a time. The HAL hands the IOProc Float32 whatever the physical
+ * format; integer samples of up to 24 bits convert to it and back exactly,
+ * so the converter still receives them unchanged.
+ */
+class CoreAudioExclusiveOutput : public ExclusiveAudioOutput
+{
+public:
+    ~CoreAudioExclusiveOutput() override
+    {
+        close();
+    }
+
+    QString backendName() const override { return QStringLiteral("CoreAudio hog mode"); }
+
+    bool open(const QString& deviceId, const Format& format, int periodFrames) override
+    {
+        close();
+
+        const AudioDeviceID device = resolveDevice(deviceId);
+        if (device == kAudioObjectUnknown || !hog(device)) {
+            return false;
+        }
+        m_device = device;
+
+        const Float64 rate = format.sampleRate;
+        const AudioStreamID stream = outputStream(device);
+        AudioStreamBasicDescription physical = {};
+        if (stream == kAudioObjectUnknown ||
+            !setProperty(device, propertyAddress(kAudioDevicePropertyNominalSampleRate), rate) ||
+            !findPhysicalFormat(stream, format, physical) ||
+            !setProperty(stream, propertyAddress(kAudioStreamPropertyPhysicalFormat), physical)) {
+            close();
+            return false;
+        }
+
+        AudioValueRange frameRange = {};
+        getProperty(device, propertyAddress(kAudioDevicePropertyBufferFrameSizeRange), frameRange);
+        const int requestedPeriod = periodFrames > 0 ? periodFrames : format.sampleRate * MIN_PERIOD_MS / 1000;
+        UInt32 frames = static_cast<UInt32>(std::clamp<double>(requestedPeriod, frameRange.mMinimum,
+                                                               std::max(frameRange.mMinimum, frameRange.mMaximum)));
+        setProperty(device, propertyAddress(kAudioDevicePropertyBufferFrameSize), frames);
+        getProperty(device, propertyAddress(kAudioDevicePropertyBufferFrameSize), frames);
+
+        // One buffer being played while the next is rendered, plus what the device adds
+        UInt32 deviceLatency = 0;
+        UInt32 safetyOffset = 0;
+        UInt32 streamLatency = 0;
+        getProperty(device, propertyAddress(kAudioDevicePropertyLatency, kAudioObjectPropertyScopeOutput), deviceLatency);
+        getProperty(device, propertyAddress(kAudioDevicePropertySafetyOffset, kAudioObjectPropertyScopeOutput), safetyOffset);
+        getProperty(stream, propertyAddress(kAudioStreamPropertyLatency), streamLatency);
+
+        if (AudioDeviceCreateIOProcID(device, &CoreAudioExclusiveOutput::ioProc, this, &m_procId) != noErr) {
+            close();
+            return false;
+        }
+        AudioObjectPropertyAddress overload = propertyAddress(kAudioDeviceProcessorOverload);
+        AudioObjectAddPropertyListener(device, &overload, &CoreAudioExclusiveOutput::overloadListener, this);
+
+        m_format = format;
+        m_periodFrames = static_cast<int>(frames);
+        m_latencyMs = (2.0 * frames + deviceLatency + safetyOffset + streamLatency) * 1000.0 / format.sampleRate;
+        m_scratch.resize(m_periodFrames * format.bytesPerFrame());
+
+        qCDebug(exclusiveAudio) << "Hogging device" << device << format.sampleRate << "Hz," << m_periodFrames
+                                << "frame buffers," << m_latencyMs << "ms";
+        return true;
+    }
+
+    void close() override
+    {
+        stop();
+        if (m_device == kAudioObjectUnknown) {
+            return;
+        }
+
+        if (m_procId) {
+            AudioObjectPropertyAddress overload = propertyAddress(kAudioDeviceProcessorOverload);
+            AudioObjectRemovePropertyListener(m_device, &overload, &CoreAudioExclusiveOutput::overloadListener, this);
+            AudioDeviceDestroyIOProcID(m_device, m_procId);
+            m_procId = nullptr;
+        }
+
+        // Setting the hog mode to -1 gives the device back
+        const pid_t none = -1;
+        setProperty(m_device, propertyAddress(kAudioDevicePropertyHogMode), none);
+        m_device = kAudioObjectUnknown;
+        m_format = Format();
+    }
+
+    bool start(RenderCallback render) override
+    {
+        if (!m_procId || m_running) {
+            return false;
+        }
+
+        m_render = std::move(render);
+        m_running = true;
+        if (AudioDeviceStart(m_device, m_procId) != noErr) {
+            m_running = false;
+            return false;
+        }
+        return true;
+    }
+
+    void stop() override
+    {
+        if (!m_running) {
+            return;
+        }
+
+        // Returns once the IOProc is no longer running
+        AudioDeviceStop(m_device, m_procId);
+        m_running = false;
+    }
+
+private:
+    static constexpr int MIN_PERIOD_MS = 5;
+
+    static AudioDeviceID resolveDevice(const QString& deviceId)
+    {
+        AudioDeviceID device = kAudioObjectUnknown;
+        if (deviceId.isEmpty()) {
+            getProperty(kAudioObjectSystemObject, propertyAddress(kAudioHardwarePropertyDefaultOutputDevice), device);
+            return device;
+        }
+
+        // Numeric object IDs are taken as they are, anything else is a device UID
+        bool numeric = false;
+        const uint id = deviceId.toUInt(&numeric);
+        if (numeric) {
+            return static_cast<AudioDeviceID>(id);
+        }
+
+        CFStringRef uid = deviceId.toCFString();
+        AudioValueTranslation translation = { &uid, sizeof(CFStringRef), &device, sizeof(AudioDeviceID) };
+        getProperty(kAudioObjectSystemObject, propertyAddress(kAudioHardwarePropertyDeviceForUID), translation);
+        CFRelease(uid);
+        return device;
+    }
+
+    static bool hog(AudioDeviceID device)
+    {
+        const pid_t self = getpid();
+        pid_t owner = -1;
+        getProperty(device, propertyAddress(kAudioDevicePropertyHogMode), owner);
+        if (owner == self) {
+            return true;
+        }
+        if (owner != -1) {
+            qCDebug(exclusiveAudio) << "Device" << device << "is hogged by process" << owner;
+            return false;
+        }
+
+        return setProperty(device, propertyAddress(kAudioDevicePropertyHogMode), self) &&
+               getProperty(device, propertyAddress(kAudioDevicePropertyHogMode), owner) && owner == self;
+    }
+
+    static AudioStreamID outputStream(AudioDeviceID device)
+    {
+        const QVector<AudioStreamID> streams = getArrayProperty<AudioStreamID>(
+            device, propertyAddress(kAudioDevicePropertyStreams, kAudioObjectPropertyScopeOutput));
+        return streams.isEmpty() ? kAudioObjectUnknown : streams.first();
+    }
+
+    static bool findPhysicalFormat(AudioStreamID stream, const Format& format, AudioStreamBasicDescription& physical)
+    {
+        // Integer samples keep their width where the hardware has it; 32-bit ones may land in 24
+        QVector<std::pair<UInt32, bool>> candidates;       // bits, float
+        switch (format.sampleType) {
+            case SampleType::Int16: candidates = { { 16, false } }; break;
+            case SampleType::Int32: candidates = { { 32, false }, { 24, false } }; break;
+            case SampleType::Float32: candidates = { { 32, true } }; break;
+        }
+
+        const QVector<AudioStreamRangedDescription> available = getArrayProperty<AudioStreamRangedDescription>(
+            stream, propertyAddress(kAudioStreamPropertyAvailablePhysicalFormats));
+        for (const auto& [bits, isFloat] : candidates) {
+            for (const AudioStreamRangedDescription& ranged : available) {
+                const AudioStreamBasicDescription& description = ranged.mFormat;
+                const bool descriptionFloat = description.mFormatFlags & kAudioFormatFlagIsFloat;
+                if (description.mFormatID == kAudioFormatLinearPCM &&
+                    description.mChannelsPerFrame == static_cast<UInt32>(format.channels) &&
+                    description.mBitsPerChannel == bits && descriptionFloat == isFloat &&
+                    ranged.mSampleRateRange.mMinimum <= format.sampleRate &&
+                    ranged.mSampleRateRange.mMaximum >= format.sampleRate) {
+                    physical = description;
+                    physical.mSampleRate = format.sampleRate;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    static OSStatus ioProc(AudioObjectID device, const AudioTimeStamp* now, const AudioBufferList* input,
+                           const AudioTimeStamp* inputTime, AudioBufferList* output,
+                           const AudioTimeStamp* outputTime, void* clientData)
+    {
+        Q_UNUSED(device) Q_UNUSED(now) Q_UNUSED(input) Q_UNUSED(inputTime) Q_UNUSED(outputTime)
+        auto* self = static_cast<CoreAudioExclusiveOutput*>(clientData);
+        AudioBuffer& buffer = output->mBuffers[0];
+        auto* out = static_cast<float*>(buffer.mData);
+        const int channels = self->m_format.channels;
+        if (!self->m_running.load(std::memory_order_relaxed) ||
+            buffer.mNumberChannels != static_cast<UInt32>(channels)) {
+            std::memset(buffer.mData, 0, buffer.mDataByteSize);
+            return noErr;
+        }
+
+        // The HAL may ask for more than a period after a buffer size change
+        int frames = static_cast<int>(buffer.mDataByteSize / (channels * sizeof(float)));
+        while (frames > 0) {
+            const int chunk = std::min(frames, self->m_periodFrames);
+            self->m_render(self->m_scratch.data(), chunk);
+            self->convert(out, chunk * channels);
+            out += chunk * channels;
+            frames -= chunk;
+        }
+        return noErr;
+    }
+
+    static OSStatus overloadListener(AudioObjectID object, UInt32 count, const AudioObjectPropertyAddress* addresses,
+                                     void* clientData)
+    {
+        Q_UNUSED(object) Q_UNUSED(count) Q_UNUSED(addresses)
+        static_cast<CoreAudioExclusiveOutput*>(clientData)->m_underruns.fetch_add(1, std::memory_order_relaxed);
+        return noErr;
+    }
+
+    void convert(float* out, int samples) const
+    {
+        switch (m_format.sampleType) {
+            case SampleType::Int16: {
+                const auto* in = reinterpret_cast<const qint16*>(m_scratch.constData());
+                for (int i = 0; i < samples; ++i) {
+                    out[i] = in[i] * (1.0f / 32768.0f);
+                }
+                break;
+            }
+            case SampleType::Int32: {
+                const auto* in = reinterpret_cast<const qint32*>(m_scratch.constData());
+                for (int i = 0; i < samples; ++i) {
+                    out[i] = static_cast<float>(in[i]) * (1.0f / 2147483648.0f);
+                }
+                break;
+            }
+            case SampleType::Float32:
+                std::memcpy(out, m_scratch.constData(), samples * sizeof(float));
+                break;
+        }
+    }
+
+    AudioDeviceID m_device = kAudioObjectUnknown;
+    AudioDeviceIOProcID m_procId = nullptr;
+    std::atomic<bool> m_running{false};
+    RenderCallback m_render;
+    QByteArray m_scratch;                   // One period in the open format
+};
+
+} // namespace
+
+std::unique_ptr<ExclusiveAudioOutput> ExclusiveAudioOutput::create()
+{
+    return std::make_unique<CoreAudioExclusiveOutput>();
+}
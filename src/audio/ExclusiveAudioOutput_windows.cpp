@@ -0,0 +1,271 @@
+#include "audio/ExclusiveAudioOutput.h"
+#include "ThreadPriority.h"
+#include <QLoggingCategory>
+#include <QThread>
+
+#include <windows.h>
+#include <mmdeviceapi.h>
+#include <audioclient.h>
+#include <mmreg.h>
+#include <ksmedia.h>
+
+Q_DECLARE_LOGGING_CATEGORY(exclusiveAudio)
+
+namespace {
+
+template <typename T>
+void releaseCom(T*& object)
+{
+    if (object) {
+        object->Release();
+        object = nullptr;
+    }
+}
+
+/**
+ * @brief COM for the calling thread, which may be the GUI's STA or a libVLC thread
+ */
+struct ComScope {
+    ComScope() : initialized(SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED))) {}
+    ~ComScope()
+    {
+        if (initialized) {
+            CoUninitialize();
+        }
+    }
+    const bool initialized;
+};
+
+/**
+ * @brief WASAPI backend in exclusive, event-driven mode
+ *
+ * The endpoint's buffer is a single period; the audio engine signals an
+ * event whenever the hardware finished one half and the render thread
+ * refills it. Nothing sits between the buffer and the driver, so the
+ * format must be one the driver takes natively. Periods follow the
+ * endpoint's alignment rules: a period the driver rejects as unaligned is
+ * rounded to the size it reports and initialized again.
+ */
+class WasapiExclusiveOutput : public ExclusiveAudioOutput
+{
+public:
+    ~WasapiExclusiveOutput() override
+    {
+        close();
+    }
+
+    QString backendName() const override { return QStringLiteral("WASAPI exclusive"); }
+
+    bool open(const QString& deviceId, const Format& format, int periodFrames) override
+    {
+        close();
+
+        // The audio client objects are agile; any thread may use them afterwards
+        ComScope com;
+        IMMDeviceEnumerator* enumerator = nullptr;
+        if (FAILED(CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL,
+                                    __uuidof(IMMDeviceEnumerator), reinterpret_cast<void**>(&enumerator)))) {
+            return false;
+        }
+        HRESULT result = deviceId.isEmpty()
+            ? enumerator->GetDefaultAudioEndpoint(eRender, eConsole, &m_device)
+            : enumerator->GetDevice(reinterpret_cast<LPCWSTR>(deviceId.utf16()), &m_device);
+        releaseCom(enumerator);
+        if (FAILED(result)) {
+            qCDebug(exclusiveAudio) << "No endpoint" << deviceId;
+            return false;
+        }
+
+        if (!activateClient()) {
+            close();
+            return false;
+        }
+
+        // Int32 is offered as 32 valid bits first, then as 24 in a 32-bit container
+        WAVEFORMATEXTENSIBLE wave = waveFormat(format, format.sampleType == SampleType::Int16 ? 16 : 32);
+        if (m_client->IsFormatSupported(AUDCLNT_SHAREMODE_EXCLUSIVE, &wave.Format, nullptr) != S_OK) {
+            if (format.sampleType != SampleType::Int32) {
+                close();
+                return false;
+            }
+            wave = waveFormat(format, 24);
+            if (m_client->IsFormatSupported(AUDCLNT_SHAREMODE_EXCLUSIVE, &wave.Format, nullptr) != S_OK) {
+                close();
+                return false;
+            }
+        }
+
+        REFERENCE_TIME defaultPeriod = 0;
+        REFERENCE_TIME minimumPeriod = 0;
+        m_client->GetDevicePeriod(&defaultPeriod, &minimumPeriod);
+        REFERENCE_TIME period = minimumPeriod;
+        if (periodFrames > 0) {
+            period = qMax(minimumPeriod, framesToReferenceTime(periodFrames, format.sampleRate));
+        }
+
+        result = m_client->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                                      period, period, &wave.Format, nullptr);
+        if (result == AUDCLNT_E_BUFFER_SIZE_NOT_ALIGNED) {
+            UINT32 alignedFrames = 0;
+            m_client->GetBufferSize(&alignedFrames);
+            period = framesToReferenceTime(static_cast<int>(alignedFrames), format.sampleRate);
+            releaseCom(m_client);
+            if (activateClient()) {
+                result = m_client->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                                              period, period, &wave.Format, nullptr);
+            }
+        }
+        if (FAILED(result)) {
+            qCDebug(exclusiveAudio) << "Exclusive initialization failed:" << Qt::hex << static_cast<quint32>(result);
+            close();
+            return false;
+        }
+
+        UINT32 bufferFrames = 0;
+        REFERENCE_TIME streamLatency = 0;
+        m_event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+        if (FAILED(m_client->SetEventHandle(m_event)) || FAILED(m_client->GetBufferSize(&bufferFrames)) ||
+            FAILED(m_client->GetService(__uuidof(IAudioRenderClient), reinterpret_cast<void**>(&m_render)))) {
+            close();
+            return false;
+        }
+        m_client->GetStreamLatency(&streamLatency);
+
+        m_format = format;
+        m_periodFrames = static_cast<int>(bufferFrames);
+        m_latencyMs = bufferFrames * 1000.0 / format.sampleRate + streamLatency / 10000.0;
+
+        qCDebug(exclusiveAudio) << "Holding endpoint" << format.sampleRate << "Hz," << m_periodFrames
+                                << "frame periods," << m_latencyMs << "ms";
+        return true;
+    }
+
+    void close() override
+    {
+        stop();
+        releaseCom(m_render);
+        releaseCom(m_client);
+        releaseCom(m_device);
+        if (m_event) {
+            CloseHandle(m_event);
+            m_event = nullptr;
+        }
+        m_format = Format();
+    }
+
+    bool start(RenderCallback render) override
+    {
+        if (!m_render || m_thread) {
+            return false;
+        }
+
+        // The first period is queued before the stream starts
+        m_callback = std::move(render);
+        BYTE* data = nullptr;
+        if (SUCCEEDED(m_render->GetBuffer(static_cast<UINT32>(m_periodFrames), &data))) {
+            m_callback(reinterpret_cast<char*>(data), m_periodFrames);
+            m_render->ReleaseBuffer(static_cast<UINT32>(m_periodFrames), 0);
+        }
+
+        m_running = true;
+        m_thread = QThread::create([this]() { run(); });
+        m_thread->start();
+        m_client->Start();
+        return true;
+    }
+
+    void stop() override
+    {
+        if (!m_thread) {
+            return;
+        }
+
+        m_running = false;
+        SetEvent(m_event);
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+        m_client->Stop();
+        m_client->Reset();
+    }
+
+private:
+    static constexpr DWORD EVENT_TIMEOUT_MS = 2000;
+
+    static REFERENCE_TIME framesToReferenceTime(int frames, int sampleRate)
+    {
+        // 100 ns units, rounded as the WASAPI documentation does it
+        return static_cast<REFERENCE_TIME>(10000.0 * 1000.0 * frames / sampleRate + 0.5);
+    }
+
+    static WAVEFORMATEXTENSIBLE waveFormat(const Format& format, int validBits)
+    {
+        WAVEFORMATEXTENSIBLE wave = {};
+        wave.Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
+        wave.Format.nChannels = static_cast<WORD>(format.channels);
+        wave.Format.nSamplesPerSec = static_cast<DWORD>(format.sampleRate);
+        wave.Format.wBitsPerSample = static_cast<WORD>(format.bytesPerSample() * 8);
+        wave.Format.nBlockAlign = static_cast<WORD>(format.bytesPerFrame());
+        wave.Format.nAvgBytesPerSec = wave.Format.nSamplesPerSec * wave.Format.nBlockAlign;
+        wave.Format.cbSize = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
+        wave.Samples.wValidBitsPerSample = static_cast<WORD>(validBits);
+        wave.dwChannelMask = format.channels == 2 ? KSAUDIO_SPEAKER_STEREO
+                           : format.channels == 1 ? KSAUDIO_SPEAKER_MONO
+                           : format.channels == 6 ? KSAUDIO_SPEAKER_5POINT1
+                           : format.channels == 8 ? KSAUDIO_SPEAKER_7POINT1_SURROUND : 0;
+        wave.SubFormat = format.sampleType == SampleType::Float32 ? KSDATAFORMAT_SUBTYPE_IEEE_FLOAT
+                                                                  : KSDATAFORMAT_SUBTYPE_PCM;
+        return wave;
+    }
+
+    bool activateClient()
+    {
+        return SUCCEEDED(m_device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr,
+                                            reinterpret_cast<void**>(&m_client)));
+    }
+
+    void run()
+    {
+        ComScope com;
+        ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Audio);
+
+        while (m_running.load(std::memory_order_relaxed)) {
+            if (WaitForSingleObject(m_event, EVENT_TIMEOUT_MS) != WAIT_OBJECT_0) {
+                qCWarning(exclusiveAudio) << "Endpoint stopped signalling";
+                break;
+            }
+            if (!m_running.load(std::memory_order_relaxed)) {
+                break;
+            }
+
+            BYTE* data = nullptr;
+            const HRESULT result = m_render->GetBuffer(static_cast<UINT32>(m_periodFrames), &data);
+            if (result == AUDCLNT_E_BUFFER_TOO_LARGE) {
+                // The engine still holds the period: we are late, skip this wake-up
+                m_underruns.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (FAILED(result)) {
+                qCWarning(exclusiveAudio) << "Endpoint lost:" << Qt::hex << static_cast<quint32>(result);
+                break;
+            }
+            m_callback(reinterpret_cast<char*>(data), m_periodFrames);
+            m_render->ReleaseBuffer(static_cast<UINT32>(m_periodFrames), 0);
+        }
+    }
+
+    IMMDevice* m_device = nullptr;
+    IAudioClient* m_client = nullptr;
+    IAudioRenderClient* m_render = nullptr;
+    HANDLE m_event = nullptr;
+    QThread* m_thread = nullptr;
+    std::atomic<bool> m_running{false};
+    RenderCallback m_callback;
+};
+
+} // namespace
+
+std::unique_ptr<ExclusiveAudioOutput> ExclusiveAudioOutput::create()
+{
+    return std::make_unique<WasapiExclusiveOutput>();
+}
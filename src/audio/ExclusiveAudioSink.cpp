@@ -0,0 +1,520 @@
+#include "audio/ExclusiveAudioSink.h"
+#include "audio/AudioOutputManager.h"
+#include "audio/SPSCRingBuffer.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <cstring>
+
+// libVLC includes
+#include <vlc/vlc.h>
+
+Q_DECLARE_LOGGING_CATEGORY(exclusiveAudio)
+
+namespace {
+
+using SampleType = ExclusiveAudioOutput::SampleType;
+
+// libVLC names decoder output by fourcc: s16l, s32l, f32l and the like
+SampleType sampleTypeFromFourcc(const char* format)
+{
+    const QByteArray fourcc = QByteArray(format, 4).toLower();
+    if (fourcc.startsWith("s16") || fourcc.startsWith("u8")) {
+        return SampleType::Int16;
+    }
+    if (fourcc.startsWith("s32") || fourcc.startsWith("s24")) {
+        return SampleType::Int32;
+    }
+    return SampleType::Float32;
+}
+
+const char* fourccFor(SampleType type)
+{
+    switch (type) {
+        case SampleType::Int16: return "S16N";
+        case SampleType::Int32: return "S32N";
+        case SampleType::Float32:
+        default: return "FL32";
+    }
+}
+
+void applyGain(char* data, int samples, SampleType type, float gain)
+{
+    switch (type) {
+        case SampleType::Int16: {
+            auto* values = reinterpret_cast<qint16*>(data);
+            for (int i = 0; i < samples; ++i) {
+                values[i] = static_cast<qint16>(std::clamp(values[i] * gain, -32768.0f, 32767.0f));
+            }
+            break;
+        }
+        case SampleType::Int32: {
+            auto* values = reinterpret_cast<qint32*>(data);
+            for (int i = 0; i < samples; ++i) {
+                values[i] = static_cast<qint32>(std::clamp(static_cast<double>(values[i]) * gain,
+                                                           -2147483648.0, 2147483647.0));
+            }
+            break;
+        }
+        case SampleType::Float32: {
+            auto* values = reinterpret_cast<float*>(data);
+            for (int i = 0; i < samples; ++i) {
+                values[i] *= gain;
+            }
+            break;
+        }
+    }
+}
+
+void convertFromFloat(const float* in, char* out, int samples, SampleType type)
+{
+    switch (type) {
+        case SampleType::Int16: {
+            auto* values = reinterpret_cast<qint16*>(out);
+            for (int i = 0; i < samples; ++i) {
+                values[i] = static_cast<qint16>(std::clamp(in[i] * 32768.0f, -32768.0f, 32767.0f));
+            }
+            break;
+        }
+        case SampleType::Int32: {
+            auto* values = reinterpret_cast<qint32*>(out);
+            for (int i = 0; i < samples; ++i) {
+                values[i] = static_cast<qint32>(std::clamp(in[i] * 2147483648.0, -2147483648.0, 2147483647.0));
+            }
+            break;
+        }
+        case SampleType::Float32:
+            std::memcpy(out, in, samples * sizeof(float));
+            break;
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Queue and formats of one player
+ *
+ * The static members are libVLC's audio callbacks and run on the player's
+ * audio output thread.
+ */
+struct ExclusiveAudioSink::Stream {
+    ExclusiveAudioSink* sink = nullptr;
+    libvlc_media_player_t* player = nullptr;
+    Format source;                          // As decoded
+    Format delivered;                       // As libVLC hands it over
+    Format device;                          // What the device must run for this stream
+    bool processed = false;                 // Float stereo through the manager's blocks
+    std::unique_ptr<SPSCRingBuffer<char>> queue;
+    std::atomic<bool> paused{false};
+    std::atomic<bool> flushRequested{false};
+    std::atomic<float> gain{1.0f};
+    std::atomic<bool> muted{false};
+
+    static int setup(void** opaque, char* format, unsigned* rate, unsigned* channels)
+    {
+        auto* stream = static_cast<Stream*>(*opaque);
+        stream->source.sampleRate = static_cast<int>(*rate);
+        stream->source.channels = static_cast<int>(*channels);
+        stream->source.sampleType = sampleTypeFromFourcc(format);
+
+        stream->sink->negotiate(stream);
+        if (!stream->delivered.isValid()) {
+            return -1;
+        }
+
+        std::memcpy(format, fourccFor(stream->delivered.sampleType), 4);
+        *rate = static_cast<unsigned>(stream->delivered.sampleRate);
+        *channels = static_cast<unsigned>(stream->delivered.channels);
+        return 0;
+    }
+
+    static void cleanup(void* opaque)
+    {
+        Q_UNUSED(opaque)
+    }
+
+    static void play(void* opaque, const void* samples, unsigned count, int64_t pts)
+    {
+        Q_UNUSED(pts)
+        auto* stream = static_cast<Stream*>(opaque);
+        if (!stream->queue) {
+            return;
+        }
+
+        // Wait for room rather than drop, but never long enough to wedge libVLC
+        const auto* data = static_cast<const char*>(samples);
+        int remaining = static_cast<int>(count) * stream->delivered.bytesPerFrame();
+        QElapsedTimer waited;
+        waited.start();
+        while (remaining > 0 && !stream->flushRequested.load(std::memory_order_relaxed)) {
+            const int written = stream->queue->write(data, remaining);
+            data += written;
+            remaining -= written;
+            if (remaining > 0) {
+                if (waited.elapsed() > 4 * QUEUE_MS) {
+                    break;
+                }
+                QThread::msleep(QUEUE_MS / 10);
+            }
+        }
+    }
+
+    static void pause(void* opaque, int64_t pts)
+    {
+        Q_UNUSED(pts)
+        static_cast<Stream*>(opaque)->paused = true;
+    }
+
+    static void resume(void* opaque, int64_t pts)
+    {
+        Q_UNUSED(pts)
+        static_cast<Stream*>(opaque)->paused = false;
+    }
+
+    static void flush(void* opaque, int64_t pts)
+    {
+        Q_UNUSED(pts)
+        static_cast<Stream*>(opaque)->flushRequested = true;
+    }
+
+    static void drain(void* opaque)
+    {
+        auto* stream = static_cast<Stream*>(opaque);
+        QElapsedTimer waited;
+        waited.start();
+        while (stream->queue && stream->queue->availableToRead() > 0 && waited.elapsed() < 4 * QUEUE_MS &&
+               stream->sink->m_playing.load(std::memory_order_acquire) == stream) {
+            QThread::msleep(QUEUE_MS / 10);
+        }
+    }
+
+    static void setVolume(void* opaque, float volume, bool mute)
+    {
+        auto* stream = static_cast<Stream*>(opaque);
+        stream->gain = volume;
+        stream->muted = mute;
+    }
+
+    double queuedMs() const
+    {
+        return queue && delivered.isValid()
+            ? queue->availableToRead() * 1000.0 / (delivered.bytesPerFrame() * delivered.sampleRate)
+            : 0.0;
+    }
+};
+
+ExclusiveAudioSink::ExclusiveAudioSink(std::shared_ptr<AudioOutputManager> manager, VLCBackend* backend,
+                                       QObject* parent)
+    : QObject(parent)
+    , m_manager(std::move(manager))
+    , m_backend(backend)
+    , m_output(ExclusiveAudioOutput::create())
+    , m_periodFrames(0)
+    , m_playing(nullptr)
+    , m_statusTimer(new QTimer(this))
+    , m_compensationUs(0)
+{
+    m_statusTimer->setInterval(STATUS_INTERVAL_MS);
+    connect(m_statusTimer, &QTimer::timeout, this, &ExclusiveAudioSink::reportStatus);
+
+    connect(m_manager.get(), &AudioOutputManager::exclusiveOutputChanged, this, [this]() {
+        applySettings();
+    });
+    connect(m_manager.get(), &AudioOutputManager::currentDeviceChanged, this, [this]() {
+        if (m_manager->getExclusiveOutput().deviceId.isEmpty()) {
+            applySettings();
+        }
+    }, Qt::QueuedConnection);
+
+    applySettings();
+}
+
+ExclusiveAudioSink::~ExclusiveAudioSink()
+{
+    if (m_backend && m_backend->audioOutput() == this) {
+        m_backend->setAudioOutput(nullptr);
+    }
+    QMutexLocker locker(&m_mutex);
+    closeDevice();
+}
+
+bool ExclusiveAudioSink::isActive() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_output && m_output->isOpen();
+}
+
+void ExclusiveAudioSink::applySettings()
+{
+    if (!m_backend) {
+        return;
+    }
+
+    const AudioOutputManager::ExclusiveOutputSettings settings = m_manager->getExclusiveOutput();
+    if (settings.enabled && !m_output) {
+        qCWarning(exclusiveAudio) << "No exclusive output on this platform";
+    }
+    const bool enable = settings.enabled && m_output;
+    const QString deviceId = settings.deviceId.isEmpty() ? m_manager->getCurrentDevice().id : settings.deviceId;
+
+    // A different device or period may take other formats: negotiate from scratch
+    if (m_backend->audioOutput() == this) {
+        if (enable && deviceId == m_deviceId && settings.periodFrames == m_periodFrames) {
+            return;
+        }
+        m_backend->setAudioOutput(nullptr);
+    }
+
+    m_deviceId = deviceId;
+    m_periodFrames = settings.periodFrames;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_acceptedFormats.clear();
+    }
+
+    if (enable) {
+        m_backend->setAudioOutput(this);
+        m_statusTimer->start();
+    } else {
+        m_statusTimer->stop();
+    }
+}
+
+bool ExclusiveAudioSink::attachPlayer(libvlc_media_player_t* player)
+{
+    if (!m_output) {
+        return false;
+    }
+
+    auto stream = std::make_shared<Stream>();
+    stream->sink = this;
+    stream->player = player;
+
+    libvlc_audio_set_callbacks(player, Stream::play, Stream::pause, Stream::resume, Stream::flush, Stream::drain,
+                               stream.get());
+    libvlc_audio_set_format_callbacks(player, Stream::setup, Stream::cleanup);
+    libvlc_audio_set_volume_callback(player, Stream::setVolume);
+
+    QMutexLocker locker(&m_mutex);
+    m_streams.insert(player, stream);
+    return true;
+}
+
+void ExclusiveAudioSink::detachPlayer(libvlc_media_player_t* player)
+{
+    QMutexLocker locker(&m_mutex);
+    const std::shared_ptr<Stream> stream = m_streams.take(player);
+    if (stream && stream == m_active) {
+        // The render thread must be done with it before it goes
+        closeDevice();
+        m_active.reset();
+    }
+}
+
+void ExclusiveAudioSink::setActivePlayer(libvlc_media_player_t* player)
+{
+    QMutexLocker locker(&m_mutex);
+    m_active = m_streams.value(player);
+    m_compensationUs = 0;
+
+    // A preloaded player may have been negotiated for another format
+    if (m_output && m_active && m_active->device.isValid() && m_active->device != m_output->format()) {
+        closeDevice();
+        openDevice(m_active->device, false);
+    }
+    m_playing.store(m_active.get(), std::memory_order_release);
+}
+
+void ExclusiveAudioSink::negotiate(Stream* stream)
+{
+    QMutexLocker locker(&m_mutex);
+    const bool active = m_active.get() == stream;
+
+    // Processing needs float stereo; anything else goes to the device as decoded
+    stream->processed = m_manager->isProcessingActive();
+    Format preferred = stream->source;
+    if (stream->processed) {
+        preferred.channels = 2;
+        preferred.sampleType = SampleType::Int32;
+    }
+
+    if (active || !m_output->isOpen()) {
+        if (m_output->format() != preferred) {
+            m_playing.store(nullptr, std::memory_order_release);
+            closeDevice();
+            openDevice(preferred, true);
+        }
+        stream->device = m_output->format();
+    } else if (m_acceptedFormats.contains(preferred)) {
+        // Opened in its own format once it plays
+        stream->device = preferred;
+    } else {
+        stream->device = m_output->format();
+    }
+
+    if (!stream->device.isValid()) {
+        stream->delivered = Format();
+        return;
+    }
+    if (stream->processed && stream->device.channels != 2) {
+        // Held in another layout for the playing stream; libVLC converts instead
+        stream->processed = false;
+    }
+
+    Format delivered = stream->device;
+    if (stream->processed) {
+        delivered.sampleType = SampleType::Float32;
+    }
+
+    // The render thread must not read a queue while it is replaced
+    const bool rendering = m_playing.load(std::memory_order_acquire) == stream;
+    if (rendering) {
+        m_output->stop();
+    }
+    const int capacity = delivered.bytesPerFrame() * delivered.sampleRate / 1000 * QUEUE_MS;
+    if (!stream->queue || delivered != stream->delivered || stream->queue->capacity() < capacity) {
+        stream->queue = std::make_unique<SPSCRingBuffer<char>>(capacity);
+    }
+    stream->delivered = delivered;
+    stream->flushRequested = false;
+    if (rendering) {
+        m_output->start([this](char* data, int frames) { render(data, frames); });
+    }
+
+    if (active) {
+        m_playing.store(stream, std::memory_order_release);
+    }
+}
+
+bool ExclusiveAudioSink::openDevice(const Format& format, bool nearest)
+{
+    const Format opened = nearest ? m_output->openNearest(m_deviceId, format, m_periodFrames)
+                                  : (m_output->open(m_deviceId, format, m_periodFrames) ? format : Format());
+    if (!opened.isValid()) {
+        return false;
+    }
+    if (!m_acceptedFormats.contains(opened)) {
+        m_acceptedFormats.append(opened);
+    }
+
+    // Room for the largest block a backend asks for at once
+    const int samples = m_output->periodFrames() * qMax(2, opened.channels);
+    m_interleaved.resize(samples);
+    m_left.resize(m_output->periodFrames());
+    m_right.resize(m_output->periodFrames());
+
+    m_output->start([this](char* data, int frames) { render(data, frames); });
+    QMetaObject::invokeMethod(this, &ExclusiveAudioSink::reportStatus, Qt::QueuedConnection);
+    return true;
+}
+
+void ExclusiveAudioSink::closeDevice()
+{
+    if (!m_output || !m_output->isOpen()) {
+        return;
+    }
+
+    m_output->close();
+    QMetaObject::invokeMethod(this, &ExclusiveAudioSink::reportStatus, Qt::QueuedConnection);
+}
+
+void ExclusiveAudioSink::render(char* data, int frames)
+{
+    const Format format = m_output->format();
+    const int bytes = frames * format.bytesPerFrame();
+    Stream* stream = m_playing.load(std::memory_order_acquire);
+    if (!stream || !stream->queue || stream->paused.load(std::memory_order_relaxed) ||
+        stream->device != format) {
+        std::memset(data, 0, bytes);
+        return;
+    }
+
+    if (stream->flushRequested.exchange(false)) {
+        stream->queue->skip(stream->queue->availableToRead());
+    }
+
+    if (stream->processed) {
+        renderProcessed(stream, data, frames);
+        return;
+    }
+
+    const int read = stream->queue->read(data, bytes);
+    std::memset(data + read, 0, bytes - read);
+
+    const float gain = stream->muted.load(std::memory_order_relaxed) ? 0.0f
+                                                                      : stream->gain.load(std::memory_order_relaxed);
+    if (gain != 1.0f) {
+        applyGain(data, read / format.bytesPerSample(), format.sampleType, gain);
+    }
+}
+
+void ExclusiveAudioSink::renderProcessed(Stream* stream, char* data, int frames)
+{
+    const Format format = m_output->format();
+    const float gain = stream->muted.load(std::memory_order_relaxed) ? 0.0f
+                                                                      : stream->gain.load(std::memory_order_relaxed);
+
+    for (int offset = 0; offset < frames;) {
+        const int chunk = qMin(frames - offset, static_cast<int>(m_left.size()));
+        const int bytes = chunk * 2 * static_cast<int>(sizeof(float));
+        auto* interleaved = m_interleaved.data();
+        const int read = stream->queue->read(reinterpret_cast<char*>(interleaved), bytes);
+        std::memset(reinterpret_cast<char*>(interleaved) + read, 0, bytes - read);
+
+        for (int i = 0; i < chunk; ++i) {
+            m_left[i] = interleaved[2 * i] * gain;
+            m_right[i] = interleaved[2 * i + 1] * gain;
+        }
+        m_manager->applyDelayCompensationBlock(m_left.data(), m_right.data(), chunk, format.sampleRate);
+        m_manager->processSpatialBlock(m_left.data(), m_right.data(), chunk, format.sampleRate);
+        for (int i = 0; i < chunk; ++i) {
+            interleaved[2 * i] = m_left[i];
+            interleaved[2 * i + 1] = m_right[i];
+        }
+
+        convertFromFloat(interleaved, data + offset * format.bytesPerFrame(), chunk * 2, format.sampleType);
+        offset += chunk;
+    }
+}
+
+void ExclusiveAudioSink::reportStatus()
+{
+    AudioOutputManager::ExclusiveOutputStatus status;
+    libvlc_media_player_t* player = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_output && m_output->isOpen()) {
+            const Format format = m_output->format();
+            status.active = true;
+            status.backend = m_output->backendName();
+            status.deviceId = m_deviceId;
+            status.sampleRate = format.sampleRate;
+            status.channels = format.channels;
+            status.bitsPerSample = format.bytesPerSample() * 8;
+            status.periodFrames = m_output->periodFrames();
+            status.latencyMs = m_output->latencyMs();
+            status.underruns = m_output->underruns();
+            if (m_active) {
+                status.latencyMs += m_active->queuedMs();
+                status.bitPerfect = !m_active->processed && m_active->source == format &&
+                                    m_active->gain.load() == 1.0f && !m_active->muted.load();
+                player = m_active->player;
+            }
+        }
+    }
+
+    // libVLC believes its samples are heard once handed over: play them that much earlier
+    if (player) {
+        const qint64 compensationUs = -static_cast<qint64>(status.latencyMs * 1000.0);
+        if (qAbs(compensationUs - m_compensationUs) >= MIN_DELAY_CHANGE_US) {
+            libvlc_audio_set_delay(player, compensationUs);
+            m_compensationUs = compensationUs;
+        }
+    }
+
+    m_manager->reportExclusiveOutputStatus(status);
+}
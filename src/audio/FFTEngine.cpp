@@ -0,0 +1,166 @@
+#include "audio/FFTEngine.h"
+#include <QtMath>
+#include <algorithm>
+
+namespace {
+constexpr double TWO_PI = 6.28318530717958647692;
+}
+
+FFTEngine::FFTEngine(int size)
+    : m_size(isValidSize(size) ? size : 1024)
+    , m_halfSize(m_size / 2)
+{
+    // Bit-reversal permutation for the half-size complex transform
+    int bits = 0;
+    while ((1 << bits) < m_halfSize) {
+        ++bits;
+    }
+
+    m_bitReverse.resize(m_halfSize);
+    for (int i = 0; i < m_halfSize; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (1 << b)) {
+                reversed |= 1 << (bits - 1 - b);
+            }
+        }
+        m_bitReverse[i] = reversed;
+    }
+
+    // Twiddles for the half-size butterflies
+    m_twiddles.resize(qMax(1, m_halfSize / 2));
+    for (int k = 0; k < m_twiddles.size(); ++k) {
+        double angle = -TWO_PI * k / m_halfSize;
+        m_twiddles[k] = Complex(static_cast<float>(qCos(angle)), static_cast<float>(qSin(angle)));
+    }
+
+    // Twiddles for splitting the packed real transform
+    m_realTwiddles.resize(m_halfSize);
+    for (int k = 0; k < m_halfSize; ++k) {
+        double angle = -TWO_PI * k / m_size;
+        m_realTwiddles[k] = Complex(static_cast<float>(qCos(angle)), static_cast<float>(qSin(angle)));
+    }
+
+    // Periodic Hann window
+    m_window.resize(m_size);
+    for (int i = 0; i < m_size; ++i) {
+        m_window[i] = static_cast<float>(0.5 * (1.0 - qCos(TWO_PI * i / m_size)));
+    }
+}
+
+bool FFTEngine::isValidSize(int size)
+{
+    return size >= 4 && (size & (size - 1)) == 0;
+}
+
+void FFTEngine::forward(const float* input, Complex* spectrum) const
+{
+    // Pack even/odd samples into a half-length complex sequence
+    for (int n = 0; n < m_halfSize; ++n) {
+        spectrum[m_bitReverse[n]] = Complex(input[2 * n], input[2 * n + 1]);
+    }
+
+    transform(spectrum, false);
+
+    // Split the packed result into the real-input spectrum, in place.
+    // X[k] = (Z[k] + conj(Z[M-k])) / 2 + W^k * (Z[k] - conj(Z[M-k])) / 2i
+    const Complex z0 = spectrum[0];
+    spectrum[0] = Complex(z0.real() + z0.imag(), 0.0f);
+    spectrum[m_halfSize] = Complex(z0.real() - z0.imag(), 0.0f);
+
+    for (int k = 1; k <= m_halfSize / 2; ++k) {
+        const int mirror = m_halfSize - k;
+        const Complex a = spectrum[k];
+        const Complex b = spectrum[mirror];
+
+        const Complex evenK = (a + std::conj(b)) * 0.5f;
+        const Complex diffK = a - std::conj(b);
+        const Complex oddK(diffK.imag() * 0.5f, -diffK.real() * 0.5f);
+
+        const Complex evenM = (b + std::conj(a)) * 0.5f;
+        const Complex diffM = b - std::conj(a);
+        const Complex oddM(diffM.imag() * 0.5f, -diffM.real() * 0.5f);
+
+        spectrum[k] = evenK + m_realTwiddles[k] * oddK;
+        spectrum[mirror] = evenM + m_realTwiddles[mirror] * oddM;
+    }
+}
+
+void FFTEngine::inverse(const Complex* spectrum, float* output) const
+{
+    // std::complex<float> is layout-compatible with float[2], so the output
+    // buffer doubles as the half-length complex work area.
+    Complex* work = reinterpret_cast<Complex*>(output);
+
+    // Merge the half spectrum back into a packed sequence:
+    // Z[k] = Fe[k] + i * Fo[k], Fo[k] = (X[k] - conj(X[M-k])) / 2 * conj(W^k)
+    for (int k = 0; k < m_halfSize; ++k) {
+        const Complex a = spectrum[k];
+        const Complex b = std::conj(spectrum[m_halfSize - k]);
+
+        const Complex even = (a + b) * 0.5f;
+        const Complex odd = (a - b) * 0.5f * std::conj(m_realTwiddles[k]);
+
+        work[k] = even + Complex(-odd.imag(), odd.real());
+    }
+
+    // Bit-reverse in place before the butterflies
+    for (int i = 0; i < m_halfSize; ++i) {
+        const int j = m_bitReverse[i];
+        if (j > i) {
+            std::swap(work[i], work[j]);
+        }
+    }
+
+    transform(work, true);
+
+    const float scale = 1.0f / m_halfSize;
+    for (int i = 0; i < m_size; ++i) {
+        output[i] *= scale;
+    }
+}
+
+void FFTEngine::forward(const QVector<float>& input, QVector<Complex>& spectrum) const
+{
+    spectrum.resize(spectrumSize());
+
+    if (input.size() >= m_size) {
+        forward(input.constData(), spectrum.data());
+        return;
+    }
+
+    QVector<float> padded(m_size, 0.0f);
+    std::copy(input.constBegin(), input.constEnd(), padded.begin());
+    forward(padded.constData(), spectrum.data());
+}
+
+void FFTEngine::inverse(const QVector<Complex>& spectrum, QVector<float>& output) const
+{
+    output.resize(m_size);
+
+    if (spectrum.size() < spectrumSize()) {
+        output.fill(0.0f);
+        return;
+    }
+
+    inverse(spectrum.constData(), output.data());
+}
+
+void FFTEngine::transform(Complex* data, bool inverse) const
+{
+    // Iterative radix-2 decimation-in-time; input is already bit-reversed
+    for (int length = 2; length <= m_halfSize; length <<= 1) {
+        const int half = length >> 1;
+        const int step = m_halfSize / length;
+
+        for (int start = 0; start < m_halfSize; start += length) {
+            for (int j = 0; j < half; ++j) {
+                const Complex w = inverse ? std::conj(m_twiddles[j * step]) : m_twiddles[j * step];
+                const Complex u = data[start + j];
+                const Complex v = data[start + j + half] * w;
+                data[start + j] = u + v;
+                data[start + j + half] = u - v;
+            }
+        }
+    }
+}
@@ -0,0 +1,293 @@
+#include "audio/LoudnessMeter.h"
+#include "audio/AudioKernels.h"
+#include <QtEndian>
+#include <QtMath>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr int INTERPOLATOR_TAPS = 48;
+
+double blockLoudness(double power)
+{
+    return -0.691 + 10.0 * std::log10(power);
+}
+
+double binLoudness(int bin)
+{
+    return LoudnessMeter::ABSOLUTE_GATE_LUFS + (bin + 0.5) * LoudnessMeter::HISTOGRAM_STEP_LU;
+}
+
+const std::array<double, LoudnessMeter::HISTOGRAM_BINS>& binPowers()
+{
+    static const std::array<double, LoudnessMeter::HISTOGRAM_BINS> powers = [] {
+        std::array<double, LoudnessMeter::HISTOGRAM_BINS> table {};
+        for (int bin = 0; bin < LoudnessMeter::HISTOGRAM_BINS; ++bin) {
+            table[bin] = qPow(10.0, (binLoudness(bin) + 0.691) / 10.0);
+        }
+        return table;
+    }();
+    return powers;
+}
+
+// Blackman-windowed sinc lowpass at the original Nyquist frequency
+const std::array<float, INTERPOLATOR_TAPS>& interpolatorTaps()
+{
+    static const std::array<float, INTERPOLATOR_TAPS> taps = [] {
+        std::array<float, INTERPOLATOR_TAPS> table {};
+        const double centre = (INTERPOLATOR_TAPS - 1) / 2.0;
+        for (int n = 0; n < INTERPOLATOR_TAPS; ++n) {
+            const double t = (n - centre) / 4.0;
+            const double sinc = qFuzzyIsNull(t) ? 1.0 : qSin(M_PI * t) / (M_PI * t);
+            const double x = 2.0 * M_PI * n / (INTERPOLATOR_TAPS - 1);
+            const double window = 0.42 - 0.5 * qCos(x) + 0.08 * qCos(2.0 * x);
+            table[n] = static_cast<float>(sinc * window);
+        }
+        return table;
+    }();
+    return taps;
+}
+
+} // namespace
+
+LoudnessMeter::LoudnessMeter(int sampleRate, int channels)
+    : m_sampleRate(qMax(1, sampleRate))
+    , m_channels(qBound(1, channels, MAX_CHANNELS))
+    , m_subBlockFrames(qMax(1, m_sampleRate / 10))
+    , m_subBlockFill(0)
+    , m_recentCount(0)
+    , m_histogram(HISTOGRAM_BINS, 0)
+    , m_oversample(m_sampleRate < 96000)
+    , m_truePeak(0.0)
+{
+    m_weights.fill(1.0);
+    if (m_channels >= 6) {
+        m_weights[3] = 0.0;                 // LFE
+        for (int channel = 4; channel < m_channels; ++channel) {
+            m_weights[channel] = 1.41;      // Surrounds
+        }
+    }
+
+    // K-weighting for any sample rate, from the BS.1770 48 kHz prototypes
+    const double rate = m_sampleRate;
+    double K = qTan(M_PI * 1681.974450955533 / rate);
+    double Q = 0.7071752369554196;
+    const double Vh = qPow(10.0, 3.999843853973347 / 20.0);
+    const double Vb = qPow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + K / Q + K * K;
+    const double shelf[5] = {
+        (Vh + Vb * K / Q + K * K) / a0,
+        2.0 * (K * K - Vh) / a0,
+        (Vh - Vb * K / Q + K * K) / a0,
+        2.0 * (K * K - 1.0) / a0,
+        (1.0 - K / Q + K * K) / a0
+    };
+
+    K = qTan(M_PI * 38.13547087602444 / rate);
+    Q = 0.5003270373238773;
+    a0 = 1.0 + K / Q + K * K;
+    const double highPass[5] = {
+        1.0, -2.0, 1.0,
+        2.0 * (K * K - 1.0) / a0,
+        (1.0 - K / Q + K * K) / a0
+    };
+
+    const int pairs = (m_channels + 1) / 2;
+    for (int pair = 0; pair < pairs; ++pair) {
+        auto filter = std::make_unique<BiquadCascade>();
+        filter->setStageCount(2);
+        filter->setCoefficients(0, shelf[0], shelf[1], shelf[2], shelf[3], shelf[4]);
+        filter->setCoefficients(1, highPass[0], highPass[1], highPass[2], highPass[3], highPass[4]);
+        m_filters.push_back(std::move(filter));
+    }
+
+    // One spare buffer partners the last channel of an odd count
+    m_planar.assign(pairs * 2, std::vector<float>(CHUNK_FRAMES, 0.0f));
+    m_subBlockPower.fill(0.0);
+    m_recentSubBlocks.fill(0.0);
+    m_peakHistory.assign(m_channels, std::array<float, TAPS_PER_PHASE> {});
+}
+
+LoudnessMeter::~LoudnessMeter() = default;
+
+void LoudnessMeter::addFrames(const float* samples, int frames)
+{
+    while (frames > 0) {
+        const int count = qMin(frames, static_cast<int>(CHUNK_FRAMES));
+        processChunk(samples, count);
+        samples += static_cast<qsizetype>(count) * m_channels;
+        frames -= count;
+    }
+}
+
+void LoudnessMeter::processChunk(const float* samples, int frames)
+{
+    measureTruePeak(samples, frames);
+
+    if (m_channels == 2) {
+        AudioKernels::deinterleave(samples, m_planar[0].data(), m_planar[1].data(), frames);
+    } else {
+        for (int channel = 0; channel < m_channels; ++channel) {
+            float* planar = m_planar[channel].data();
+            for (int frame = 0; frame < frames; ++frame) {
+                planar[frame] = samples[frame * m_channels + channel];
+            }
+        }
+    }
+
+    for (size_t pair = 0; pair < m_filters.size(); ++pair) {
+        m_filters[pair]->process(m_planar[pair * 2].data(), m_planar[pair * 2 + 1].data(), frames);
+    }
+
+    // Sum power up to each 100 ms boundary
+    int offset = 0;
+    while (offset < frames) {
+        const int count = qMin(frames - offset, m_subBlockFrames - m_subBlockFill);
+        for (int channel = 0; channel < m_channels; ++channel) {
+            if (m_weights[channel] == 0.0) {
+                continue;
+            }
+            m_subBlockPower[channel] += AudioKernels::sumOfSquares(m_planar[channel].data() + offset, count);
+        }
+
+        offset += count;
+        m_subBlockFill += count;
+        if (m_subBlockFill == m_subBlockFrames) {
+            finishSubBlock();
+        }
+    }
+}
+
+void LoudnessMeter::measureTruePeak(const float* samples, int frames)
+{
+    const std::array<float, INTERPOLATOR_TAPS>& taps = interpolatorTaps();
+    float peak = static_cast<float>(m_truePeak);
+
+    for (int channel = 0; channel < m_channels; ++channel) {
+        std::array<float, TAPS_PER_PHASE>& history = m_peakHistory[channel];
+
+        for (int frame = 0; frame < frames; ++frame) {
+            const float sample = samples[frame * m_channels + channel];
+            peak = qMax(peak, qAbs(sample));
+            if (!m_oversample) {
+                continue;
+            }
+
+            std::memmove(history.data() + 1, history.data(), (TAPS_PER_PHASE - 1) * sizeof(float));
+            history[0] = sample;
+
+            for (int phase = 0; phase < OVERSAMPLING; ++phase) {
+                float value = 0.0f;
+                for (int tap = 0; tap < TAPS_PER_PHASE; ++tap) {
+                    value += taps[phase + tap * OVERSAMPLING] * history[tap];
+                }
+                peak = qMax(peak, qAbs(value));
+            }
+        }
+    }
+
+    m_truePeak = peak;
+}
+
+void LoudnessMeter::finishSubBlock()
+{
+    double power = 0.0;
+    for (int channel = 0; channel < m_channels; ++channel) {
+        power += m_weights[channel] * m_subBlockPower[channel];
+        m_subBlockPower[channel] = 0.0;
+    }
+    m_subBlockFill = 0;
+
+    m_recentSubBlocks[m_recentCount % 4] = power / m_subBlockFrames;
+    ++m_recentCount;
+    if (m_recentCount < 4) {
+        return;
+    }
+
+    // A 400 ms gating block is the mean of its four sub-blocks
+    double blockPower = 0.0;
+    for (double subBlock : m_recentSubBlocks) {
+        blockPower += subBlock;
+    }
+    blockPower /= 4.0;
+    if (blockPower <= 0.0) {
+        return;
+    }
+
+    const double loudness = blockLoudness(blockPower);
+    if (loudness >= ABSOLUTE_GATE_LUFS) {
+        const int bin = qMin(HISTOGRAM_BINS - 1,
+                             static_cast<int>((loudness - ABSOLUTE_GATE_LUFS) / HISTOGRAM_STEP_LU));
+        ++m_histogram[bin];
+    }
+}
+
+double LoudnessMeter::integratedLoudness(const Histogram& histogram)
+{
+    const std::array<double, HISTOGRAM_BINS>& powers = binPowers();
+    const int bins = qMin(static_cast<int>(histogram.size()), static_cast<int>(HISTOGRAM_BINS));
+
+    // Every stored block already passed the absolute gate
+    double power = 0.0;
+    quint64 blocks = 0;
+    for (int bin = 0; bin < bins; ++bin) {
+        power += histogram[bin] * powers[bin];
+        blocks += histogram[bin];
+    }
+    if (blocks == 0) {
+        return -std::numeric_limits<double>::infinity();
+    }
+
+    const double relativeGate = blockLoudness(power / blocks) + RELATIVE_GATE_LU;
+    power = 0.0;
+    blocks = 0;
+    for (int bin = 0; bin < bins; ++bin) {
+        if (binLoudness(bin) >= relativeGate) {
+            power += histogram[bin] * powers[bin];
+            blocks += histogram[bin];
+        }
+    }
+
+    return blocks > 0 ? blockLoudness(power / blocks) : -std::numeric_limits<double>::infinity();
+}
+
+void LoudnessMeter::mergeHistogram(Histogram& target, const Histogram& source)
+{
+    if (target.size() < HISTOGRAM_BINS) {
+        target.resize(HISTOGRAM_BINS);
+    }
+    const int bins = qMin(static_cast<int>(source.size()), static_cast<int>(HISTOGRAM_BINS));
+    for (int bin = 0; bin < bins; ++bin) {
+        target[bin] += source[bin];
+    }
+}
+
+QByteArray LoudnessMeter::packHistogram(const Histogram& histogram)
+{
+    // Little-endian (bin: u16, count: u32) pairs
+    QByteArray packed;
+    for (int bin = 0; bin < histogram.size(); ++bin) {
+        if (histogram[bin] == 0) {
+            continue;
+        }
+        char entry[6];
+        qToLittleEndian<quint16>(static_cast<quint16>(bin), entry);
+        qToLittleEndian<quint32>(histogram[bin], entry + 2);
+        packed.append(entry, sizeof(entry));
+    }
+    return packed;
+}
+
+LoudnessMeter::Histogram LoudnessMeter::unpackHistogram(const QByteArray& packed)
+{
+    Histogram histogram(HISTOGRAM_BINS, 0);
+    for (qsizetype offset = 0; offset + 6 <= packed.size(); offset += 6) {
+        const quint16 bin = qFromLittleEndian<quint16>(packed.constData() + offset);
+        if (bin < HISTOGRAM_BINS) {
+            histogram[bin] += qFromLittleEndian<quint32>(packed.constData() + offset + 2);
+        }
+    }
+    return histogram;
+}
@@ -0,0 +1,243 @@
+#include "audio/LyricsTimeline.h"
+#include "subtitles/SRTParser.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QRegularExpression>
+#include <QStringDecoder>
+#include <algorithm>
+
+Q_DECLARE_LOGGING_CATEGORY(lyricsTimeline)
+Q_LOGGING_CATEGORY(lyricsTimeline, "audio.lyrics")
+
+namespace {
+
+// [mm:ss], [mm:ss.x], [mm:ss.xx] or [mm:ss.xxx]; <...> for word stamps
+const QRegularExpression& lineStampPattern()
+{
+    static const QRegularExpression pattern(QStringLiteral(R"(^\[(\d+):(\d{1,2})(?:[.:](\d{1,3}))?\])"));
+    return pattern;
+}
+
+const QRegularExpression& wordStampPattern()
+{
+    static const QRegularExpression pattern(QStringLiteral(R"(<(\d+):(\d{1,2})(?:[.:](\d{1,3}))?>)"));
+    return pattern;
+}
+
+qint64 stampMs(const QRegularExpressionMatch& match)
+{
+    const QString fraction = match.captured(3).leftJustified(3, QLatin1Char('0')).left(3);
+    return (match.captured(1).toLongLong() * 60 + match.captured(2).toLongLong()) * 1000 + fraction.toLongLong();
+}
+
+/**
+ * @brief Split LRC line text at word stamps
+ * @param text Text after the line stamps
+ * @param lineStart Time of the line, for text before the first stamp
+ * @param offset Subtracted from every stamp
+ * @param words Receives the timed words, ends still unset
+ * @return Text without the stamps
+ */
+QString parseWords(const QString& text, qint64 lineStart, qint64 offset, QVector<LyricsTimeline::Word>& words)
+{
+    QString plain;
+    qint64 wordStart = lineStart;
+    qsizetype position = 0;
+
+    auto addWord = [&](const QString& wordText) {
+        plain += wordText;
+        if (!wordText.trimmed().isEmpty()) {
+            words.append({ wordStart, 0, wordText });
+        } else if (!words.isEmpty() && words.last().endTime == 0) {
+            // A stamp followed by nothing marks where the previous word ends
+            words.last().endTime = wordStart;
+        }
+    };
+
+    QRegularExpressionMatchIterator it = wordStampPattern().globalMatch(text);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        addWord(text.mid(position, match.capturedStart() - position));
+        wordStart = qMax<qint64>(0, stampMs(match) - offset);
+        position = match.capturedEnd();
+    }
+    addWord(text.mid(position));
+
+    // Plain lines need no word timing
+    if (words.size() == 1 && words.first().startTime == lineStart) {
+        words.clear();
+    }
+    return plain.trimmed();
+}
+
+QVector<LyricsTimeline::Line> linesFromTrack(const SubtitleTrack& track)
+{
+    QVector<LyricsTimeline::Line> lines;
+    lines.reserve(track.entryCount());
+    for (int i = 0; i < track.entryCount(); ++i) {
+        const SubtitleEntry entry = track.entryAt(i);
+        lines.append(LyricsTimeline::Line(entry.startTime(), entry.endTime(), entry.plainText()));
+    }
+    return lines;
+}
+
+} // namespace
+
+bool LyricsTimeline::loadFile(const QString& filePath)
+{
+    const QString extension = QFileInfo(filePath).suffix().toLower();
+
+    if (extension == "srt") {
+        SRTParser parser;
+        SubtitleParseResult result;
+        setLines(linesFromTrack(parser.parseFile(filePath, result)));
+        return !isEmpty();
+    }
+
+    if (extension != "lrc") {
+        qCWarning(lyricsTimeline) << "Unsupported lyrics format:" << extension;
+        return false;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(lyricsTimeline) << "Failed to open LRC file:" << filePath;
+        return false;
+    }
+
+    // LRC files are mostly UTF-8; fall back to Latin-1 for old ones
+    const QByteArray data = file.readAll();
+    QStringDecoder decoder(QStringDecoder::Utf8);
+    QString content = decoder.decode(data);
+    if (decoder.hasError()) {
+        content = QString::fromLatin1(data);
+    }
+    return parseLRC(content);
+}
+
+bool LyricsTimeline::parseLRC(const QString& content)
+{
+    static const QRegularExpression offsetPattern(QStringLiteral(R"(^\[offset:\s*([+-]?\d+)\s*\])"),
+                                                  QRegularExpression::CaseInsensitiveOption);
+
+    // The offset tag applies to the whole file wherever it appears
+    qint64 offset = 0;
+    const QStringList rows = content.split(QLatin1Char('\n'));
+    for (const QString& row : rows) {
+        const QRegularExpressionMatch match = offsetPattern.match(row.trimmed());
+        if (match.hasMatch()) {
+            offset = match.captured(1).toLongLong();
+            break;
+        }
+    }
+
+    QVector<Line> lines;
+    QVector<qint64> stamps;
+    for (const QString& row : rows) {
+        QString text = row.trimmed();
+
+        // One line may carry several stamps when it repeats
+        stamps.clear();
+        QRegularExpressionMatch match;
+        while ((match = lineStampPattern().match(text)).hasMatch()) {
+            stamps.append(qMax<qint64>(0, stampMs(match) - offset));
+            text.remove(0, match.capturedLength());
+        }
+        if (stamps.isEmpty()) {
+            continue;   // Metadata tags and untimed text
+        }
+
+        for (qint64 stamp : std::as_const(stamps)) {
+            Line line;
+            line.startTime = stamp;
+            line.text = parseWords(text, stamp, offset, line.words);
+            lines.append(line);
+        }
+    }
+
+    std::stable_sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) {
+        return a.startTime < b.startTime;
+    });
+
+    // Each line lasts until the next one starts
+    for (int i = 0; i < lines.size(); ++i) {
+        Line& line = lines[i];
+        int next = i + 1;
+        while (next < lines.size() && lines[next].startTime == line.startTime) {
+            ++next;
+        }
+        line.endTime = next < lines.size() ? lines[next].startTime : line.startTime + LAST_LINE_DURATION_MS;
+
+        for (int w = 0; w < line.words.size(); ++w) {
+            Word& word = line.words[w];
+            if (word.endTime == 0) {
+                word.endTime = w + 1 < line.words.size() ? line.words[w + 1].startTime : line.endTime;
+            }
+            word.endTime = qMin(word.endTime, line.endTime);
+        }
+    }
+
+    setLines(lines);
+    return !isEmpty();
+}
+
+bool LyricsTimeline::parseSRT(const QString& content)
+{
+    SRTParser parser;
+    SubtitleParseResult result;
+    setLines(linesFromTrack(parser.parseContent(content, result)));
+    return !isEmpty();
+}
+
+void LyricsTimeline::setLines(const QVector<Line>& lines)
+{
+    m_lines = lines;
+    std::stable_sort(m_lines.begin(), m_lines.end(), [](const Line& a, const Line& b) {
+        return a.startTime < b.startTime;
+    });
+    rebuildIndex();
+}
+
+void LyricsTimeline::clear()
+{
+    m_lines.clear();
+    m_index.clear();
+}
+
+void LyricsTimeline::rebuildIndex()
+{
+    QVector<qint64> starts;
+    QVector<qint64> ends;
+    starts.reserve(m_lines.size());
+    ends.reserve(m_lines.size());
+    for (const Line& line : std::as_const(m_lines)) {
+        starts.append(line.startTime);
+        ends.append(line.endTime);
+    }
+    m_index.build(starts, ends);
+}
+
+int LyricsTimeline::lineAt(qint64 time)
+{
+    // Lines are in start order, so the last active one started last
+    const QVector<int> active = m_index.activeAt(time);
+    return active.isEmpty() ? -1 : active.last();
+}
+
+int LyricsTimeline::nextLineAfter(qint64 time) const
+{
+    return m_index.nextAfter(time);
+}
+
+int LyricsTimeline::wordAt(int lineIndex, qint64 time) const
+{
+    if (lineIndex < 0 || lineIndex >= m_lines.size()) {
+        return -1;
+    }
+
+    const QVector<Word>& words = m_lines[lineIndex].words;
+    const auto it = std::upper_bound(words.constBegin(), words.constEnd(), time,
+                                     [](qint64 value, const Word& word) { return value < word.startTime; });
+    return static_cast<int>(it - words.constBegin()) - 1;
+}
@@ -0,0 +1,340 @@
+#include "audio/PartitionedConvolver.h"
+#include "audio/FFTEngine.h"
+#include <QFile>
+#include <QtEndian>
+#include <QtMath>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const FFTEngine& convolutionEngine()
+{
+    return FFTEngine::forSize<PartitionedConvolver::FFT_SIZE>();
+}
+
+void setError(QString* errorMessage, const QString& message)
+{
+    if (errorMessage) {
+        *errorMessage = message;
+    }
+}
+
+} // namespace
+
+bool HRIRSet::isValid() const
+{
+    return sampleRate > 0 && !leftToLeft.isEmpty() && !leftToRight.isEmpty()
+        && !rightToLeft.isEmpty() && !rightToRight.isEmpty();
+}
+
+HRIRSet HRIRSet::resampled(int targetRate) const
+{
+    if (!isValid() || targetRate <= 0 || targetRate == sampleRate) {
+        return *this;
+    }
+
+    const double ratio = static_cast<double>(sampleRate) / targetRate;
+    auto resample = [ratio](const QVector<float>& input) {
+        const int outputLength = qMax(1, static_cast<int>(input.size() / ratio));
+        QVector<float> output(outputLength);
+        for (int i = 0; i < outputLength; ++i) {
+            const double position = i * ratio;
+            const int index = static_cast<int>(position);
+            const float fraction = static_cast<float>(position - index);
+            const float a = input[qMin(index, input.size() - 1)];
+            const float b = input[qMin(index + 1, input.size() - 1)];
+            output[i] = a + (b - a) * fraction;
+        }
+        return output;
+    };
+
+    HRIRSet result;
+    result.name = name;
+    result.sampleRate = targetRate;
+    result.leftToLeft = resample(leftToLeft);
+    result.leftToRight = resample(leftToRight);
+    result.rightToLeft = resample(rightToLeft);
+    result.rightToRight = resample(rightToRight);
+    return result;
+}
+
+HRIRSet HRIRSet::sphericalHead(int sampleRate)
+{
+    // Rigid sphere model for speakers at +/-30 degrees: Woodworth interaural
+    // time difference plus a one-pole head-shadow low-pass on the far ear
+    const double headRadius = 0.0875;
+    const double speedOfSound = 343.0;
+    const double azimuth = M_PI / 6.0;
+    const double itdSamples = headRadius / speedOfSound * (azimuth + qSin(azimuth)) * sampleRate;
+    const double shadowCutoff = 1800.0;
+    const double shadowPole = qExp(-2.0 * M_PI * shadowCutoff / sampleRate);
+    const int length = 256;
+
+    QVector<float> nearEar(length, 0.0f);
+    QVector<float> farEar(length, 0.0f);
+    nearEar[0] = 1.0f;
+
+    // Fractional delay of the far ear via linear interpolation, then shadowing
+    const int delay = static_cast<int>(itdSamples);
+    const float fraction = static_cast<float>(itdSamples - delay);
+    QVector<float> delayed(length, 0.0f);
+    if (delay + 1 < length) {
+        delayed[delay] = 1.0f - fraction;
+        delayed[delay + 1] = fraction;
+    }
+
+    const float farGain = 0.7f;
+    double state = 0.0;
+    for (int i = 0; i < length; ++i) {
+        state = (1.0 - shadowPole) * delayed[i] + shadowPole * state;
+        farEar[i] = static_cast<float>(state) * farGain;
+    }
+
+    HRIRSet result;
+    result.name = QStringLiteral("Spherical Head");
+    result.sampleRate = sampleRate;
+    result.leftToLeft = nearEar;
+    result.leftToRight = farEar;
+    result.rightToLeft = farEar;
+    result.rightToRight = nearEar;
+    return result;
+}
+
+HRIRSet HRIRSet::fromWavFile(const QString& filePath, QString* errorMessage)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(errorMessage, QStringLiteral("Cannot open HRIR file: ") + filePath);
+        return HRIRSet();
+    }
+
+    const QByteArray data = file.readAll();
+    const char* bytes = data.constData();
+    if (data.size() < 12 || std::memcmp(bytes, "RIFF", 4) != 0 || std::memcmp(bytes + 8, "WAVE", 4) != 0) {
+        setError(errorMessage, QStringLiteral("Not a RIFF/WAVE file: ") + filePath);
+        return HRIRSet();
+    }
+
+    int format = 0;
+    int channels = 0;
+    int sampleRate = 0;
+    int bitsPerSample = 0;
+    const char* samples = nullptr;
+    int sampleBytes = 0;
+
+    int offset = 12;
+    while (offset + 8 <= data.size()) {
+        const quint32 chunkSize = qFromLittleEndian<quint32>(bytes + offset + 4);
+        const char* chunk = bytes + offset + 8;
+        const int available = qMin<qint64>(chunkSize, data.size() - offset - 8);
+
+        if (std::memcmp(bytes + offset, "fmt ", 4) == 0 && available >= 16) {
+            format = qFromLittleEndian<quint16>(chunk);
+            channels = qFromLittleEndian<quint16>(chunk + 2);
+            sampleRate = static_cast<int>(qFromLittleEndian<quint32>(chunk + 4));
+            bitsPerSample = qFromLittleEndian<quint16>(chunk + 14);
+            if (format == 0xFFFE && available >= 26) {
+                format = qFromLittleEndian<quint16>(chunk + 24); // WAVE_FORMAT_EXTENSIBLE sub-format
+            }
+        } else if (std::memcmp(bytes + offset, "data", 4) == 0) {
+            samples = chunk;
+            sampleBytes = available;
+        }
+
+        offset += 8 + static_cast<int>(chunkSize) + (chunkSize & 1);
+    }
+
+    const bool pcm = format == 1 && (bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32);
+    const bool ieee = format == 3 && bitsPerSample == 32;
+    if (!samples || sampleRate <= 0 || (channels != 2 && channels != 4) || (!pcm && !ieee)) {
+        setError(errorMessage, QStringLiteral("Unsupported HRIR format (need 2 or 4 channel PCM/float WAV): ") + filePath);
+        return HRIRSet();
+    }
+
+    const int bytesPerSample = bitsPerSample / 8;
+    const int frames = qMin(sampleBytes / (bytesPerSample * channels), PartitionedConvolver::MAX_IR_LENGTH);
+    if (frames <= 0) {
+        setError(errorMessage, QStringLiteral("HRIR file contains no samples: ") + filePath);
+        return HRIRSet();
+    }
+
+    auto readSample = [&](int frame, int channel) -> float {
+        const char* p = samples + (frame * channels + channel) * bytesPerSample;
+        if (ieee) {
+            return qFromLittleEndian<float>(p);
+        }
+        switch (bitsPerSample) {
+            case 16:
+                return qFromLittleEndian<qint16>(p) / 32768.0f;
+            case 24: {
+                const qint32 value = (static_cast<qint32>(static_cast<qint8>(p[2])) << 16)
+                                   | (static_cast<quint8>(p[1]) << 8) | static_cast<quint8>(p[0]);
+                return value / 8388608.0f;
+            }
+            default:
+                return qFromLittleEndian<qint32>(p) / 2147483648.0f;
+        }
+    };
+
+    HRIRSet result;
+    result.sampleRate = sampleRate;
+    result.name = filePath.section('/', -1);
+    result.leftToLeft.resize(frames);
+    result.leftToRight.resize(frames);
+    result.rightToLeft.resize(frames);
+    result.rightToRight.resize(frames);
+
+    for (int i = 0; i < frames; ++i) {
+        result.leftToLeft[i] = readSample(i, 0);
+        result.leftToRight[i] = readSample(i, 1);
+        if (channels == 4) {
+            result.rightToLeft[i] = readSample(i, 2);
+            result.rightToRight[i] = readSample(i, 3);
+        } else {
+            result.rightToLeft[i] = result.leftToRight[i];
+            result.rightToRight[i] = result.leftToLeft[i];
+        }
+    }
+
+    return result;
+}
+
+PartitionedConvolver::PartitionedConvolver()
+    : m_partitionCount(0)
+    , m_spectrumSize(FFT_SIZE / 2 + 1)
+    , m_delayLineHead(0)
+    , m_position(0)
+{
+    m_accumulator.resize(m_spectrumSize);
+    std::fill(std::begin(m_timeScratch), std::end(m_timeScratch), 0.0f);
+    reset();
+}
+
+bool PartitionedConvolver::setImpulseResponses(const HRIRSet& hrir)
+{
+    if (!hrir.isValid()) {
+        return false;
+    }
+
+    int longest = qMax(qMax(hrir.leftToLeft.size(), hrir.leftToRight.size()),
+                       qMax(hrir.rightToLeft.size(), hrir.rightToRight.size()));
+    longest = qMin(longest, MAX_IR_LENGTH);
+    m_partitionCount = (longest + PARTITION_SIZE - 1) / PARTITION_SIZE;
+
+    buildPartitions(hrir.leftToLeft, m_filters[LeftToLeft]);
+    buildPartitions(hrir.leftToRight, m_filters[LeftToRight]);
+    buildPartitions(hrir.rightToLeft, m_filters[RightToLeft]);
+    buildPartitions(hrir.rightToRight, m_filters[RightToRight]);
+
+    for (QVector<Complex>& spectra : m_inputSpectra) {
+        spectra.resize(m_partitionCount * m_spectrumSize);
+    }
+
+    reset();
+    return true;
+}
+
+void PartitionedConvolver::buildPartitions(const QVector<float>& response, QVector<Complex>& partitions)
+{
+    const FFTEngine& engine = convolutionEngine();
+    partitions.resize(m_partitionCount * m_spectrumSize);
+
+    const int length = qMin(response.size(), m_partitionCount * PARTITION_SIZE);
+    for (int p = 0; p < m_partitionCount; ++p) {
+        std::fill(std::begin(m_timeScratch), std::end(m_timeScratch), 0.0f);
+        const int start = p * PARTITION_SIZE;
+        const int count = qBound(0, length - start, PARTITION_SIZE);
+        std::copy(response.constData() + start, response.constData() + start + count, m_timeScratch);
+        engine.forward(m_timeScratch, partitions.data() + p * m_spectrumSize);
+    }
+}
+
+void PartitionedConvolver::reset()
+{
+    for (int ch = 0; ch < 2; ++ch) {
+        std::fill(std::begin(m_inputFrame[ch]), std::end(m_inputFrame[ch]), 0.0f);
+        std::fill(std::begin(m_outputBlock[ch]), std::end(m_outputBlock[ch]), 0.0f);
+        m_inputSpectra[ch].fill(Complex(0.0f, 0.0f));
+    }
+    m_delayLineHead = 0;
+    m_position = 0;
+}
+
+void PartitionedConvolver::process(float* left, float* right, int frames, float wetMix)
+{
+    if (!isLoaded()) {
+        return;
+    }
+
+    const float dryMix = 1.0f - wetMix;
+    float* channels[2] = {left, right};
+
+    int done = 0;
+    while (done < frames) {
+        const int count = qMin(PARTITION_SIZE - m_position, frames - done);
+
+        for (int ch = 0; ch < 2; ++ch) {
+            float* io = channels[ch] + done;
+            float* input = m_inputFrame[ch] + PARTITION_SIZE + m_position;
+            const float* delayedDry = m_inputFrame[ch] + m_position;
+            const float* wet = m_outputBlock[ch] + m_position;
+
+            for (int i = 0; i < count; ++i) {
+                input[i] = io[i];
+                io[i] = wet[i] * wetMix + delayedDry[i] * dryMix;
+            }
+        }
+
+        m_position += count;
+        done += count;
+
+        if (m_position == PARTITION_SIZE) {
+            processPartition();
+            m_position = 0;
+        }
+    }
+}
+
+void PartitionedConvolver::processPartition()
+{
+    const FFTEngine& engine = convolutionEngine();
+
+    // Transform the newest input partition into the delay line, then slide
+    // the time-domain window forward for overlap-save
+    for (int ch = 0; ch < 2; ++ch) {
+        engine.forward(m_inputFrame[ch], m_inputSpectra[ch].data() + m_delayLineHead * m_spectrumSize);
+        std::memcpy(m_inputFrame[ch], m_inputFrame[ch] + PARTITION_SIZE, sizeof(float) * PARTITION_SIZE);
+    }
+
+    for (int ear = 0; ear < 2; ++ear) {
+        float* acc = reinterpret_cast<float*>(m_accumulator.data());
+        std::fill(acc, acc + m_spectrumSize * 2, 0.0f);
+
+        for (int ch = 0; ch < 2; ++ch) {
+            const QVector<Complex>& filter = m_filters[ch * 2 + ear];
+
+            for (int p = 0; p < m_partitionCount; ++p) {
+                const int slot = (m_delayLineHead - p + m_partitionCount) % m_partitionCount;
+                const float* x = reinterpret_cast<const float*>(m_inputSpectra[ch].constData() + slot * m_spectrumSize);
+                const float* h = reinterpret_cast<const float*>(filter.constData() + p * m_spectrumSize);
+
+                // Plain real arithmetic keeps the loop vectorizable and avoids
+                // the NaN-recovery path of std::complex multiplication
+                for (int k = 0; k < m_spectrumSize; ++k) {
+                    const float xr = x[k * 2];
+                    const float xi = x[k * 2 + 1];
+                    const float hr = h[k * 2];
+                    const float hi = h[k * 2 + 1];
+                    acc[k * 2] += xr * hr - xi * hi;
+                    acc[k * 2 + 1] += xr * hi + xi * hr;
+                }
+            }
+        }
+
+        engine.inverse(m_accumulator.constData(), m_timeScratch);
+        std::memcpy(m_outputBlock[ear], m_timeScratch + PARTITION_SIZE, sizeof(float) * PARTITION_SIZE);
+    }
+
+    m_delayLineHead = (m_delayLineHead + 1) % m_partitionCount;
+}
@@ -0,0 +1,238 @@
+#include "audio/PolyphaseResampler.h"
+#include <QHash>
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtMath>
+#include <algorithm>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EONPLAY_RESAMPLER_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define EONPLAY_RESAMPLER_NEON
+#include <arm_neon.h>
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(polyphaseResampler)
+Q_LOGGING_CATEGORY(polyphaseResampler, "audio.resampler")
+
+namespace {
+
+// Zeroth-order modified Bessel function of the first kind, for the Kaiser window
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    const double quarterSquare = x * x * 0.25;
+    for (int k = 1; k < 32; ++k) {
+        term *= quarterSquare / (k * k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief Dot product of one phase against both channel histories
+ */
+inline void dotStereo(const float* coefficients, const float* left, const float* right,
+                      float& outLeft, float& outRight)
+{
+    constexpr int taps = PolyphaseResampler::TAPS_PER_PHASE;
+
+#if defined(EONPLAY_RESAMPLER_SSE2)
+    __m128 accLeft = _mm_setzero_ps();
+    __m128 accRight = _mm_setzero_ps();
+    for (int j = 0; j < taps; j += 4) {
+        const __m128 c = _mm_loadu_ps(coefficients + j);
+        accLeft = _mm_add_ps(accLeft, _mm_mul_ps(c, _mm_loadu_ps(left + j)));
+        accRight = _mm_add_ps(accRight, _mm_mul_ps(c, _mm_loadu_ps(right + j)));
+    }
+
+    // Reduce both accumulators together: (l0+l2, l1+l3, r0+r2, r1+r3)
+    const __m128 low = _mm_movelh_ps(accLeft, accRight);
+    const __m128 high = _mm_movehl_ps(accRight, accLeft);
+    const __m128 pairs = _mm_add_ps(low, high);
+    const __m128 sums = _mm_add_ps(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(2, 3, 0, 1)));
+    outLeft = _mm_cvtss_f32(sums);
+    outRight = _mm_cvtss_f32(_mm_movehl_ps(sums, sums));
+#elif defined(EONPLAY_RESAMPLER_NEON)
+    float32x4_t accLeft = vdupq_n_f32(0.0f);
+    float32x4_t accRight = vdupq_n_f32(0.0f);
+    for (int j = 0; j < taps; j += 4) {
+        const float32x4_t c = vld1q_f32(coefficients + j);
+        accLeft = vfmaq_f32(accLeft, c, vld1q_f32(left + j));
+        accRight = vfmaq_f32(accRight, c, vld1q_f32(right + j));
+    }
+    outLeft = vaddvq_f32(accLeft);
+    outRight = vaddvq_f32(accRight);
+#else
+    float sumLeft = 0.0f;
+    float sumRight = 0.0f;
+    for (int j = 0; j < taps; ++j) {
+        sumLeft += coefficients[j] * left[j];
+        sumRight += coefficients[j] * right[j];
+    }
+    outLeft = sumLeft;
+    outRight = sumRight;
+#endif
+}
+
+} // namespace
+
+PolyphaseResampler::PolyphaseResampler()
+    : m_phase(0)
+    , m_historyIndex(0)
+{
+    reset();
+}
+
+std::shared_ptr<const PolyphaseResampler::FilterBank> PolyphaseResampler::filterBank(int inputRate, int outputRate)
+{
+    if (inputRate <= 0 || outputRate <= 0) {
+        return nullptr;
+    }
+
+    static QMutex cacheMutex;
+    static QHash<quint64, std::shared_ptr<const FilterBank>> cache;
+
+    // The cache keeps every bank alive, so resamplers dropping theirs on the
+    // audio thread never free one there
+    const quint64 key = (static_cast<quint64>(inputRate) << 32) | static_cast<quint32>(outputRate);
+    QMutexLocker locker(&cacheMutex);
+    auto it = cache.constFind(key);
+    if (it != cache.constEnd()) {
+        return it.value();
+    }
+
+    std::shared_ptr<const FilterBank> bank = buildFilterBank(inputRate, outputRate);
+    if (bank) {
+        cache.insert(key, bank);
+    }
+    return bank;
+}
+
+std::shared_ptr<const PolyphaseResampler::FilterBank> PolyphaseResampler::buildFilterBank(int inputRate, int outputRate)
+{
+    const int divisor = std::gcd(inputRate, outputRate);
+    const int interpolation = outputRate / divisor;
+    const int decimation = inputRate / divisor;
+    if (interpolation > MAX_PHASES) {
+        qCWarning(polyphaseResampler) << "Unsupported conversion" << inputRate << "->" << outputRate << "Hz";
+        return nullptr;
+    }
+
+    // Prototype low-pass at the upsampled rate, cut below the lower of the
+    // two Nyquist frequencies, with gain L to make up for zero stuffing
+    const int length = interpolation * TAPS_PER_PHASE;
+    const double cutoff = 0.5 * PASSBAND / qMax(interpolation, decimation);   // Cycles per upsampled sample
+    const double centre = (length - 1) * 0.5;
+    const double windowScale = 1.0 / besselI0(KAISER_BETA);
+
+    auto bank = std::make_shared<FilterBank>();
+    bank->inputRate = inputRate;
+    bank->outputRate = outputRate;
+    bank->interpolation = interpolation;
+    bank->decimation = decimation;
+    bank->coefficients.resize(length);
+
+    for (int n = 0; n < length; ++n) {
+        const double t = n - centre;
+        const double sinc = t == 0.0 ? 2.0 * cutoff : qSin(2.0 * M_PI * cutoff * t) / (M_PI * t);
+        const double position = t / centre;
+        const double window = besselI0(KAISER_BETA * qSqrt(qMax(0.0, 1.0 - position * position))) * windowScale;
+
+        // Tap k of phase p is prototype sample p + k * L, stored reversed
+        const int phase = n % interpolation;
+        const int tap = n / interpolation;
+        bank->coefficients[phase * TAPS_PER_PHASE + (TAPS_PER_PHASE - 1 - tap)] =
+            static_cast<float>(sinc * window * interpolation);
+    }
+
+    qCDebug(polyphaseResampler) << "Built filter bank" << inputRate << "->" << outputRate << "Hz:"
+                                << interpolation << "phases, backend" << simdBackend();
+    return bank;
+}
+
+bool PolyphaseResampler::setRates(int inputRate, int outputRate)
+{
+    setFilterBank(filterBank(inputRate, outputRate));
+    return isConfigured();
+}
+
+void PolyphaseResampler::setFilterBank(std::shared_ptr<const FilterBank> bank)
+{
+    m_bank = std::move(bank);
+    reset();
+}
+
+void PolyphaseResampler::reset()
+{
+    m_phase = 0;
+    m_historyIndex = 0;
+    std::fill(std::begin(m_historyLeft), std::end(m_historyLeft), 0.0f);
+    std::fill(std::begin(m_historyRight), std::end(m_historyRight), 0.0f);
+}
+
+int PolyphaseResampler::maxOutputFrames(int inputFrames) const
+{
+    if (!m_bank || inputFrames <= 0) {
+        return 0;
+    }
+    return static_cast<int>(static_cast<qint64>(inputFrames) * m_bank->interpolation / m_bank->decimation) + 1;
+}
+
+int PolyphaseResampler::maxInputFrames(int outputCapacity) const
+{
+    if (!m_bank) {
+        return qMax(1, outputCapacity);
+    }
+    return qMax(1, static_cast<int>(static_cast<qint64>(outputCapacity - 1) * m_bank->decimation /
+                                    m_bank->interpolation));
+}
+
+int PolyphaseResampler::process(const float* inputLeft, const float* inputRight, int inputFrames,
+                                float* outputLeft, float* outputRight)
+{
+    if (!m_bank) {
+        return 0;
+    }
+
+    const int interpolation = m_bank->interpolation;
+    const int decimation = m_bank->decimation;
+    const float* coefficients = m_bank->coefficients.constData();
+    int produced = 0;
+
+    for (int i = 0; i < inputFrames; ++i) {
+        m_historyLeft[m_historyIndex] = m_historyLeft[m_historyIndex + TAPS_PER_PHASE] = inputLeft[i];
+        m_historyRight[m_historyIndex] = m_historyRight[m_historyIndex + TAPS_PER_PHASE] = inputRight[i];
+        m_historyIndex = (m_historyIndex + 1) % TAPS_PER_PHASE;
+
+        // Every output whose position falls before the next input
+        while (m_phase < interpolation) {
+            dotStereo(coefficients + m_phase * TAPS_PER_PHASE,
+                      m_historyLeft + m_historyIndex, m_historyRight + m_historyIndex,
+                      outputLeft[produced], outputRight[produced]);
+            ++produced;
+            m_phase += decimation;
+        }
+        m_phase -= interpolation;
+    }
+
+    return produced;
+}
+
+QString PolyphaseResampler::simdBackend()
+{
+#if defined(EONPLAY_RESAMPLER_SSE2)
+    return QStringLiteral("SSE2");
+#elif defined(EONPLAY_RESAMPLER_NEON)
+    return QStringLiteral("NEON");
+#else
+    return QStringLiteral("Scalar");
+#endif
+}
@@ -0,0 +1,111 @@
+#include "audio/STFTProcessor.h"
+#include <QtMath>
+#include <algorithm>
+
+STFTProcessor::STFTProcessor(int frameSize, int channelCount)
+    : m_engine(frameSize)
+    , m_frameSize(frameSize)
+    , m_hopSize(frameSize / 4)
+    , m_channelCount(qBound(1, channelCount, MAX_CHANNELS))
+    , m_activeChannels(m_channelCount)
+    , m_inputPosition(0)
+    , m_overlapPosition(0)
+    , m_hopPosition(0)
+{
+    // Periodic square-root Hann; applied twice it sums to a constant at 75% overlap
+    m_window.resize(m_frameSize);
+    for (int i = 0; i < m_frameSize; ++i) {
+        m_window[i] = static_cast<float>(qSin(M_PI * i / m_frameSize));
+    }
+
+    m_frame.resize(m_frameSize);
+    for (int ch = 0; ch < MAX_CHANNELS; ++ch) {
+        m_input[ch].resize(m_frameSize);
+        m_overlap[ch].resize(m_frameSize);
+        m_output[ch].resize(m_hopSize);
+        m_spectra[ch].resize(m_engine.spectrumSize());
+        m_spectrumPointers[ch] = m_spectra[ch].data();
+    }
+
+    reset();
+}
+
+void STFTProcessor::reset()
+{
+    for (int ch = 0; ch < MAX_CHANNELS; ++ch) {
+        m_input[ch].fill(0.0f);
+        m_overlap[ch].fill(0.0f);
+        m_output[ch].fill(0.0f);
+        m_spectra[ch].fill(Complex(0.0f, 0.0f));
+    }
+    m_frame.fill(0.0f);
+    m_inputPosition = 0;
+    m_overlapPosition = 0;
+    m_hopPosition = 0;
+}
+
+void STFTProcessor::exchange(float* const* channels, int offset, int count)
+{
+    for (int ch = 0; ch < m_activeChannels; ++ch) {
+        float* io = channels[ch] + offset;
+        float* input = m_input[ch].data();
+        const float* output = m_output[ch].constData() + m_hopPosition;
+        int position = m_inputPosition;
+
+        for (int i = 0; i < count; ++i) {
+            input[position] = io[i];
+            io[i] = output[i];
+            if (++position == m_frameSize) {
+                position = 0;
+            }
+        }
+    }
+
+    m_inputPosition = (m_inputPosition + count) % m_frameSize;
+}
+
+void STFTProcessor::analyze()
+{
+    // m_inputPosition points at the oldest sample of the ring
+    const int tail = m_frameSize - m_inputPosition;
+
+    for (int ch = 0; ch < m_activeChannels; ++ch) {
+        const float* input = m_input[ch].constData();
+        for (int n = 0; n < tail; ++n) {
+            m_frame[n] = input[m_inputPosition + n] * m_window[n];
+        }
+        for (int n = tail; n < m_frameSize; ++n) {
+            m_frame[n] = input[n - tail] * m_window[n];
+        }
+
+        m_engine.forward(m_frame.constData(), m_spectra[ch].data());
+    }
+}
+
+void STFTProcessor::synthesize()
+{
+    const float scale = 2.0f * m_hopSize / m_frameSize;
+
+    for (int ch = 0; ch < m_activeChannels; ++ch) {
+        m_engine.inverse(m_spectra[ch].constData(), m_frame.data());
+
+        float* overlap = m_overlap[ch].data();
+        int position = m_overlapPosition;
+        for (int n = 0; n < m_frameSize; ++n) {
+            overlap[position] += m_frame[n] * m_window[n] * scale;
+            if (++position == m_frameSize) {
+                position = 0;
+            }
+        }
+
+        // The oldest hop has now received all of its overlapping frames
+        float* output = m_output[ch].data();
+        for (int i = 0; i < m_hopSize; ++i) {
+            const int index = (m_overlapPosition + i) % m_frameSize;
+            output[i] = overlap[index];
+            overlap[index] = 0.0f;
+        }
+    }
+
+    m_overlapPosition = (m_overlapPosition + m_hopSize) % m_frameSize;
+}
@@ -0,0 +1,166 @@
+#include "audio/TempoAnalyzer.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double LOCAL_MEAN_MS = 500.0;     // Half width of the detrending window
+constexpr double TEMPO_SPREAD_OCTAVES = 1.0;
+constexpr int MIN_BEATS = 8;
+constexpr float LOG_COMPRESSION = 100.0f;
+
+} // namespace
+
+double TempoAnalyzer::BeatGrid::nextBeatMs(double positionMs) const
+{
+    if (!isValid() || positionMs <= firstBeatMs) {
+        return firstBeatMs;
+    }
+    const double interval = beatIntervalMs();
+    return firstBeatMs + std::ceil((positionMs - firstBeatMs) / interval) * interval;
+}
+
+TempoAnalyzer::TempoAnalyzer(int sampleRate, int channels)
+    : m_sampleRate(qMax(1, sampleRate))
+    , m_channels(qMax(1, channels))
+    , m_stft(frameSizeFor(m_sampleRate), 1)
+{
+    m_maxBin = qMin(m_stft.binCount() - 1,
+                    static_cast<int>(MAX_ONSET_FREQUENCY * m_stft.frameSize() / m_sampleRate));
+    m_previousMagnitudes.assign(m_maxBin + 1, 0.0f);
+}
+
+int TempoAnalyzer::frameSizeFor(int sampleRate)
+{
+    // A hop (a quarter frame) of about 10 ms at any sample rate
+    int frameSize = 256;
+    while (frameSize < sampleRate / 25) {
+        frameSize *= 2;
+    }
+    return frameSize;
+}
+
+void TempoAnalyzer::addFrames(const float* samples, int frames)
+{
+    m_mono.resize(frames);
+    const float scale = 1.0f / m_channels;
+    for (int frame = 0; frame < frames; ++frame) {
+        float sum = 0.0f;
+        for (int channel = 0; channel < m_channels; ++channel) {
+            sum += samples[frame * m_channels + channel];
+        }
+        m_mono[frame] = sum * scale;
+    }
+
+    const float* channels[] = { m_mono.data() };
+    m_stft.analyzeOnly(channels, 1, frames,
+                       [this](STFTProcessor::Complex* const* spectra, int, int) {
+        const STFTProcessor::Complex* spectrum = spectra[0];
+        float flux = 0.0f;
+        for (int bin = 1; bin <= m_maxBin; ++bin) {
+            const float magnitude = std::log1p(LOG_COMPRESSION * std::abs(spectrum[bin]));
+            flux += qMax(0.0f, magnitude - m_previousMagnitudes[bin]);
+            m_previousMagnitudes[bin] = magnitude;
+        }
+        m_envelope.append(flux);
+    });
+}
+
+TempoAnalyzer::BeatGrid TempoAnalyzer::finish() const
+{
+    BeatGrid grid;
+
+    const double hopsPerSecond = 1000.0 / hopMs();
+    const int minLag = qMax(1, static_cast<int>(std::floor(60.0 * hopsPerSecond / MAX_BPM)));
+    const int maxLag = static_cast<int>(std::ceil(60.0 * hopsPerSecond / MIN_BPM));
+    const int count = m_envelope.size();
+    if (count < maxLag * MIN_BEATS) {
+        return grid;
+    }
+
+    // Keep only onsets that stand out from their surroundings, so slow
+    // swells in level do not read as periodicity
+    std::vector<double> prefix(count + 1, 0.0);
+    for (int i = 0; i < count; ++i) {
+        prefix[i + 1] = prefix[i] + m_envelope[i];
+    }
+    const int halfWindow = qMax(1, static_cast<int>(LOCAL_MEAN_MS / hopMs()));
+    std::vector<float> onsets(count);
+    for (int i = 0; i < count; ++i) {
+        const int begin = qMax(0, i - halfWindow);
+        const int end = qMin(count, i + halfWindow + 1);
+        const double mean = (prefix[end] - prefix[begin]) / (end - begin);
+        onsets[i] = qMax(0.0f, static_cast<float>(m_envelope[i] - mean));
+    }
+
+    double energy = 0.0;
+    for (float onset : onsets) {
+        energy += static_cast<double>(onset) * onset;
+    }
+    energy /= count;
+    if (energy <= 0.0) {
+        return grid;
+    }
+
+    // Autocorrelation over the tempo range, one extra lag each side for
+    // interpolating the peak
+    std::vector<double> correlation(maxLag + 2, 0.0);
+    for (int lag = qMax(1, minLag - 1); lag <= maxLag + 1; ++lag) {
+        double sum = 0.0;
+        for (int i = 0; i + lag < count; ++i) {
+            sum += static_cast<double>(onsets[i]) * onsets[i + lag];
+        }
+        correlation[lag] = sum / (count - lag);
+    }
+
+    int bestLag = 0;
+    double bestScore = 0.0;
+    for (int lag = minLag; lag <= maxLag; ++lag) {
+        const double octaves = std::log2(60.0 * hopsPerSecond / lag / PREFERRED_BPM) / TEMPO_SPREAD_OCTAVES;
+        const double score = correlation[lag] * std::exp(-0.5 * octaves * octaves);
+        if (score > bestScore) {
+            bestScore = score;
+            bestLag = lag;
+        }
+    }
+    if (bestLag == 0) {
+        return grid;
+    }
+
+    double period = bestLag;
+    const double left = correlation[bestLag - 1];
+    const double centre = correlation[bestLag];
+    const double right = correlation[bestLag + 1];
+    const double curvature = left - 2.0 * centre + right;
+    if (curvature < 0.0) {
+        period += qBound(-0.5, 0.5 * (left - right) / curvature, 0.5);
+    }
+
+    // Phase: the offset whose beats land on the most onset energy
+    int bestPhase = 0;
+    double bestPhaseEnergy = -1.0;
+    for (int phase = 0; phase < bestLag; ++phase) {
+        double sum = 0.0;
+        for (double position = phase; position < count; position += period) {
+            sum += onsets[qMin(count - 1, static_cast<int>(position + 0.5))];
+        }
+        if (sum > bestPhaseEnergy) {
+            bestPhaseEnergy = sum;
+            bestPhase = phase;
+        }
+    }
+
+    // A hop's value belongs to the centre of the frame that ended with it
+    const double hopSamples = m_stft.hopSize();
+    const double intervalMs = period * hopMs();
+    double firstBeatMs = ((bestPhase + 1) * hopSamples - m_stft.frameSize() / 2.0) * 1000.0 / m_sampleRate;
+    while (firstBeatMs < 0.0) {
+        firstBeatMs += intervalMs;
+    }
+
+    grid.bpm = 60000.0 / intervalMs;
+    grid.firstBeatMs = firstBeatMs;
+    grid.confidence = static_cast<float>(qBound(0.0, centre / energy, 1.0));
+    return grid;
+}
@@ -0,0 +1,99 @@
+#include "audio/VocalSuppressor.h"
+#include <cmath>
+
+namespace {
+
+constexpr float EPSILON = 1e-12f;
+
+} // namespace
+
+VocalSuppressor::VocalSuppressor()
+    : m_stft(FRAME_SIZE, 2)
+    , m_sampleRate(0)
+    , m_resetPending(false)
+    , m_mode(Remove)
+    , m_strength(1.0f)
+    , m_lowHz(200.0f)
+    , m_highHz(4000.0f)
+{
+    m_similarity.fill(0.0f, m_stft.binCount());
+}
+
+void VocalSuppressor::setStrength(float strength)
+{
+    m_strength.store(qBound(0.0f, strength, 1.0f), std::memory_order_relaxed);
+}
+
+void VocalSuppressor::setFrequencyRange(float lowHz, float highHz)
+{
+    m_lowHz.store(qMax(0.0f, lowHz), std::memory_order_relaxed);
+    m_highHz.store(qMax(lowHz, highHz), std::memory_order_relaxed);
+}
+
+void VocalSuppressor::process(float* left, float* right, int frames, int sampleRate)
+{
+    if (frames <= 0 || left == right) {
+        return;
+    }
+
+    if (m_resetPending.exchange(false, std::memory_order_relaxed) || sampleRate != m_sampleRate) {
+        m_sampleRate = sampleRate;
+        m_stft.reset();
+        m_similarity.fill(0.0f);
+    }
+
+    float* channels[2] = { left, right };
+    m_stft.process(channels, 2, frames, [this](STFTProcessor::Complex* const* spectra, int channelCount, int bins) {
+        if (channelCount == 2) {
+            processSpectra(spectra, bins);
+        }
+    });
+}
+
+void VocalSuppressor::processSpectra(STFTProcessor::Complex* const* spectra, int bins)
+{
+    STFTProcessor::Complex* left = spectra[0];
+    STFTProcessor::Complex* right = spectra[1];
+
+    const float strength = m_strength.load(std::memory_order_relaxed);
+    const bool isolate = m_mode.load(std::memory_order_relaxed) == Isolate;
+    const float binWidth = static_cast<float>(m_sampleRate) / m_stft.frameSize();
+    const int lowBin = qBound(0, static_cast<int>(std::ceil(m_lowHz.load(std::memory_order_relaxed) / binWidth)), bins);
+    const int highBin = qBound(lowBin, static_cast<int>(m_highHz.load(std::memory_order_relaxed) / binWidth) + 1, bins);
+
+    // Isolation mutes everything outside the vocal range
+    if (isolate) {
+        const float keep = 1.0f - strength;
+        for (int bin = 0; bin < lowBin; ++bin) {
+            left[bin] *= keep;
+            right[bin] *= keep;
+        }
+        for (int bin = highBin; bin < bins; ++bin) {
+            left[bin] *= keep;
+            right[bin] *= keep;
+        }
+    }
+
+    float* similarity = m_similarity.data();
+    for (int bin = lowBin; bin < highBin; ++bin) {
+        const STFTProcessor::Complex l = left[bin];
+        const STFTProcessor::Complex r = right[bin];
+
+        // 1 when both channels carry the same signal, 0 when panned or out of phase
+        const float cross = l.real() * r.real() + l.imag() * r.imag();
+        const float agreement = qMax(0.0f, 2.0f * cross / (std::norm(l) + std::norm(r) + EPSILON));
+        similarity[bin] = SIMILARITY_SMOOTHING * similarity[bin] + (1.0f - SIMILARITY_SMOOTHING) * agreement;
+
+        // Squaring keeps partially shared content mostly in place
+        const float weight = similarity[bin] * similarity[bin];
+        const STFTProcessor::Complex centre = (l + r) * (0.5f * weight);
+
+        if (isolate) {
+            left[bin] = l * (1.0f - strength) + centre * strength;
+            right[bin] = r * (1.0f - strength) + centre * strength;
+        } else {
+            left[bin] = l - centre * strength;
+            right[bin] = r - centre * strength;
+        }
+    }
+}
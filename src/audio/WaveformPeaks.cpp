@@ -0,0 +1,171 @@
+#include "audio/WaveformPeaks.h"
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr char MAGIC[4] = { 'E', 'P', 'W', 'F' };
+constexpr quint32 FORMAT_VERSION = 1;
+constexpr int MAX_LEVELS = 32;
+
+void appendU32(QByteArray& data, quint32 value)
+{
+    char bytes[4];
+    qToLittleEndian<quint32>(value, bytes);
+    data.append(bytes, sizeof(bytes));
+}
+
+} // namespace
+
+WaveformPeaks::WaveformPeaks()
+    : m_sampleRate(0)
+    , m_channels(0)
+    , m_min(0.0f)
+    , m_max(0.0f)
+    , m_fill(0)
+{
+}
+
+WaveformPeaks::WaveformPeaks(int sampleRate, int channels)
+    : m_sampleRate(qMax(1, sampleRate))
+    , m_channels(qMax(1, channels))
+    , m_levels(1)
+    , m_min(0.0f)
+    , m_max(0.0f)
+    , m_fill(0)
+{
+}
+
+qint8 WaveformPeaks::quantize(float value)
+{
+    return static_cast<qint8>(qBound(-127L, std::lround(value * 127.0f), 127L));
+}
+
+void WaveformPeaks::addFrames(const float* samples, int frames)
+{
+    Level& base = m_levels.first();
+    const int count = frames * m_channels;
+    const int peakSamples = BASE_SAMPLES_PER_PEAK * m_channels;
+
+    int offset = 0;
+    while (offset < count) {
+        const int span = qMin(count - offset, peakSamples - m_fill);
+        const auto range = std::minmax_element(samples + offset, samples + offset + span);
+        if (m_fill == 0) {
+            m_min = *range.first;
+            m_max = *range.second;
+        } else {
+            m_min = qMin(m_min, *range.first);
+            m_max = qMax(m_max, *range.second);
+        }
+
+        offset += span;
+        m_fill += span;
+        if (m_fill == peakSamples) {
+            base.append({ quantize(m_min), quantize(m_max) });
+            m_fill = 0;
+        }
+    }
+}
+
+void WaveformPeaks::finish()
+{
+    if (m_levels.isEmpty()) {
+        return;
+    }
+    if (m_fill > 0) {
+        m_levels.first().append({ quantize(m_min), quantize(m_max) });
+        m_fill = 0;
+    }
+
+    m_levels.resize(1);
+    while (m_levels.last().size() > MIN_LEVEL_PEAKS && m_levels.size() < MAX_LEVELS) {
+        const Level& finer = m_levels.last();
+        Level coarser((finer.size() + 1) / 2);
+        for (int i = 0; i < coarser.size(); ++i) {
+            const Peak& first = finer[i * 2];
+            const Peak& second = i * 2 + 1 < finer.size() ? finer[i * 2 + 1] : first;
+            coarser[i] = { qMin(first.min, second.min), qMax(first.max, second.max) };
+        }
+        m_levels.append(coarser);
+    }
+}
+
+qint64 WaveformPeaks::frameCount() const
+{
+    return isEmpty() ? 0 : m_levels.first().size() * qint64(BASE_SAMPLES_PER_PEAK);
+}
+
+int WaveformPeaks::levelFor(double framesPerPixel) const
+{
+    int index = 0;
+    while (index + 1 < m_levels.size() && samplesPerPeak(index + 1) <= framesPerPixel) {
+        ++index;
+    }
+    return index;
+}
+
+QByteArray WaveformPeaks::serialize() const
+{
+    QByteArray data;
+    qsizetype size = 20;
+    for (const Level& level : m_levels) {
+        size += 4 + level.size() * 2;
+    }
+    data.reserve(size);
+
+    data.append(MAGIC, sizeof(MAGIC));
+    appendU32(data, FORMAT_VERSION);
+    appendU32(data, static_cast<quint32>(m_sampleRate));
+    appendU32(data, BASE_SAMPLES_PER_PEAK);
+    appendU32(data, static_cast<quint32>(m_levels.size()));
+    for (const Level& level : m_levels) {
+        appendU32(data, static_cast<quint32>(level.size()));
+        for (const Peak& peak : level) {
+            data.append(static_cast<char>(peak.min));
+            data.append(static_cast<char>(peak.max));
+        }
+    }
+    return data;
+}
+
+WaveformPeaks WaveformPeaks::deserialize(const QByteArray& data)
+{
+    if (data.size() < 20 || !data.startsWith(QByteArray(MAGIC, sizeof(MAGIC)))) {
+        return WaveformPeaks();
+    }
+
+    const char* bytes = data.constData();
+    const quint32 version = qFromLittleEndian<quint32>(bytes + 4);
+    const quint32 sampleRate = qFromLittleEndian<quint32>(bytes + 8);
+    const quint32 samplesPerPeak = qFromLittleEndian<quint32>(bytes + 12);
+    const quint32 levelCount = qFromLittleEndian<quint32>(bytes + 16);
+    if (version != FORMAT_VERSION || samplesPerPeak != BASE_SAMPLES_PER_PEAK ||
+        sampleRate == 0 || levelCount == 0 || levelCount > MAX_LEVELS) {
+        return WaveformPeaks();
+    }
+
+    WaveformPeaks peaks(static_cast<int>(sampleRate), 1);
+    peaks.m_levels.resize(static_cast<int>(levelCount));
+
+    qsizetype offset = 20;
+    for (Level& level : peaks.m_levels) {
+        if (offset + 4 > data.size()) {
+            return WaveformPeaks();
+        }
+        const quint32 count = qFromLittleEndian<quint32>(bytes + offset);
+        offset += 4;
+        if (count > static_cast<quint64>(data.size() - offset) / 2) {
+            return WaveformPeaks();
+        }
+
+        level.resize(static_cast<int>(count));
+        for (Peak& peak : level) {
+            peak.min = static_cast<qint8>(bytes[offset]);
+            peak.max = static_cast<qint8>(bytes[offset + 1]);
+            offset += 2;
+        }
+    }
+    return peaks;
+}
@@ -0,0 +1,289 @@
+#include "Breadcrumbs.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <chrono>
+#include <cstring>
+
+Q_LOGGING_CATEGORY(breadcrumbs, "eonplay.breadcrumbs")
+
+namespace {
+
+constexpr quint32 RING_MAGIC = 0x42435242;      // "BRCB"
+constexpr quint32 RING_VERSION = 1;
+
+enum SessionState : qint32 {
+    SESSION_RUNNING = 1,
+    SESSION_CLEAN = 2
+};
+
+qint64 steadyNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* categoryName(BreadcrumbRing::Category category)
+{
+    switch (category) {
+        case BreadcrumbRing::UserAction: return "action";
+        case BreadcrumbRing::Playback: return "playback";
+        case BreadcrumbRing::MediaOpen: return "open";
+        case BreadcrumbRing::Audio: return "audio";
+        case BreadcrumbRing::Video: return "video";
+        case BreadcrumbRing::Network: return "network";
+        default: return "general";
+    }
+}
+
+} // namespace
+
+// Layout shared with the file; fixed-size fields only
+struct BreadcrumbRing::RingHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 capacity;
+    quint32 entrySize;
+    qint64 sessionStartMs;          // Wall clock at the start of the session
+    qint64 sessionStartNs;          // Steady clock at the same moment
+    std::atomic<quint64> head;      // Sequence number of the next crumb
+    std::atomic<qint32> state;
+    std::atomic<qint32> crashSignal;
+    char reserved[16];
+};
+
+struct alignas(64) BreadcrumbRing::RingEntry {
+    std::atomic<quint64> sequence;  // Crumb's sequence number + 1 once written, 0 while writing
+    qint64 timeNs;                  // Steady clock
+    qint64 value;
+    quint32 threadId;
+    quint16 category;
+    quint16 length;
+    char text[TEXT_SIZE];
+};
+
+static_assert(sizeof(BreadcrumbRing::RingHeader) == 64, "Ring header layout changed");
+static_assert(sizeof(BreadcrumbRing::RingEntry) == 64, "Ring entry layout changed");
+static_assert((BreadcrumbRing::CAPACITY & (BreadcrumbRing::CAPACITY - 1)) == 0, "Capacity must be a power of two");
+static_assert(std::atomic<quint64>::is_always_lock_free, "Crumbs must be recordable from signal handlers");
+
+namespace {
+
+constexpr qint64 RING_BYTES = sizeof(BreadcrumbRing::RingHeader) +
+                              qint64(BreadcrumbRing::CAPACITY) * sizeof(BreadcrumbRing::RingEntry);
+
+// Used before open() and after close(); static so that it needs no allocation
+alignas(64) unsigned char fallbackRing[RING_BYTES];
+
+} // namespace
+
+QString BreadcrumbRing::Breadcrumb::toString() const
+{
+    return QString("%1 [%2] #%3 %4 %5")
+        .arg(QDateTime::fromMSecsSinceEpoch(timestampMs).toString("hh:mm:ss.zzz"),
+             QLatin1String(categoryName(category)))
+        .arg(threadId)
+        .arg(QString::fromUtf8(text))
+        .arg(value);
+}
+
+BreadcrumbRing& BreadcrumbRing::instance()
+{
+    // Never destroyed, so crumbs can be recorded during static destruction
+    static BreadcrumbRing* ring = new BreadcrumbRing();
+    return *ring;
+}
+
+BreadcrumbRing::BreadcrumbRing()
+    : m_header(reinterpret_cast<RingHeader*>(fallbackRing))
+    , m_entries(reinterpret_cast<RingEntry*>(fallbackRing + sizeof(RingHeader)))
+    , m_previousCrashed(false)
+    , m_previousCrashSignal(0)
+    , m_previousStartMs(0)
+{
+    initializeHeader(m_header);
+}
+
+BreadcrumbRing::~BreadcrumbRing() = default;
+
+bool BreadcrumbRing::open(const QString& filePath)
+{
+    if (m_file) {
+        return true;
+    }
+
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    auto file = std::make_unique<QFile>(filePath);
+    if (!file->open(QIODevice::ReadWrite)) {
+        qCWarning(breadcrumbs) << "Cannot open" << filePath << file->errorString();
+        return false;
+    }
+
+    const bool hadRing = file->size() == RING_BYTES;
+    if (!hadRing && !file->resize(RING_BYTES)) {
+        qCWarning(breadcrumbs) << "Cannot size" << filePath << file->errorString();
+        return false;
+    }
+
+    uchar* memory = file->map(0, RING_BYTES);
+    if (!memory) {
+        qCWarning(breadcrumbs) << "Cannot map" << filePath << file->errorString();
+        return false;
+    }
+    auto* header = reinterpret_cast<RingHeader*>(memory);
+    auto* entries = reinterpret_cast<RingEntry*>(memory + sizeof(RingHeader));
+
+    // A session that is still marked running never got to close()
+    if (hadRing && header->magic == RING_MAGIC && header->version == RING_VERSION &&
+        header->capacity == quint32(CAPACITY) && header->entrySize == sizeof(RingEntry) &&
+        header->state.load(std::memory_order_relaxed) == SESSION_RUNNING) {
+        m_previousCrashed = true;
+        m_previousCrashSignal = header->crashSignal.load(std::memory_order_relaxed);
+        m_previousStartMs = header->sessionStartMs;
+        m_previous = readEntries(header, entries);
+        qCInfo(breadcrumbs) << "Previous session ended abnormally; recovered" << m_previous.size() << "breadcrumbs";
+    }
+
+    // Continue this session's trail in the file, with what was recorded so far
+    std::memset(memory, 0, RING_BYTES);
+    for (int i = 0; i < CAPACITY; ++i) {
+        const RingEntry& from = m_entries[i];
+        RingEntry& to = entries[i];
+        to.timeNs = from.timeNs;
+        to.value = from.value;
+        to.threadId = from.threadId;
+        to.category = from.category;
+        to.length = from.length;
+        std::memcpy(to.text, from.text, TEXT_SIZE);
+        to.sequence.store(from.sequence.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    header->magic = RING_MAGIC;
+    header->version = RING_VERSION;
+    header->capacity = CAPACITY;
+    header->entrySize = sizeof(RingEntry);
+    header->sessionStartMs = m_header->sessionStartMs;
+    header->sessionStartNs = m_header->sessionStartNs;
+    header->head.store(m_header->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    header->crashSignal.store(0, std::memory_order_relaxed);
+    header->state.store(SESSION_RUNNING, std::memory_order_release);
+
+    m_header = header;
+    m_entries = entries;
+    m_file = std::move(file);
+    return true;
+}
+
+void BreadcrumbRing::close()
+{
+    if (!m_file) {
+        return;
+    }
+
+    m_header->state.store(SESSION_CLEAN, std::memory_order_release);
+
+    uchar* memory = reinterpret_cast<uchar*>(m_header);
+    m_header = reinterpret_cast<RingHeader*>(fallbackRing);
+    m_entries = reinterpret_cast<RingEntry*>(fallbackRing + sizeof(RingHeader));
+    std::memset(fallbackRing, 0, RING_BYTES);
+    initializeHeader(m_header);
+
+    m_file->unmap(memory);
+    m_file->close();
+    m_file.reset();
+}
+
+void BreadcrumbRing::record(Category category, const char* text, qint64 value) noexcept
+{
+    RingHeader* header = m_header;
+    const quint64 sequence = header->head.fetch_add(1, std::memory_order_relaxed);
+    RingEntry& entry = m_entries[sequence & (CAPACITY - 1)];
+
+    // Readers skip the slot until its sequence number is published again
+    entry.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const uint length = text ? qstrnlen(text, TEXT_SIZE - 1) : 0;
+    entry.timeNs = steadyNanoseconds();
+    entry.value = value;
+    entry.threadId = currentThreadId();
+    entry.category = category;
+    entry.length = quint16(length);
+    if (length > 0) {
+        std::memcpy(entry.text, text, length);
+    }
+    entry.text[length] = '\0';
+
+    entry.sequence.store(sequence + 1, std::memory_order_release);
+}
+
+void BreadcrumbRing::markCrash(int signal) noexcept
+{
+    m_header->crashSignal.store(signal, std::memory_order_relaxed);
+}
+
+QList<BreadcrumbRing::Breadcrumb> BreadcrumbRing::breadcrumbs() const
+{
+    return readEntries(m_header, m_entries);
+}
+
+void BreadcrumbRing::initializeHeader(RingHeader* header)
+{
+    header->magic = RING_MAGIC;
+    header->version = RING_VERSION;
+    header->capacity = CAPACITY;
+    header->entrySize = sizeof(RingEntry);
+    header->sessionStartMs = QDateTime::currentMSecsSinceEpoch();
+    header->sessionStartNs = steadyNanoseconds();
+    header->head.store(0, std::memory_order_relaxed);
+    header->crashSignal.store(0, std::memory_order_relaxed);
+    header->state.store(SESSION_RUNNING, std::memory_order_release);
+}
+
+QList<BreadcrumbRing::Breadcrumb> BreadcrumbRing::readEntries(const RingHeader* header, const RingEntry* entries)
+{
+    QList<Breadcrumb> result;
+
+    const quint64 head = header->head.load(std::memory_order_acquire);
+    const quint64 first = head > quint64(CAPACITY) ? head - CAPACITY : 0;
+    result.reserve(int(head - first));
+
+    for (quint64 sequence = first; sequence < head; ++sequence) {
+        const RingEntry& entry = entries[sequence & (CAPACITY - 1)];
+        if (entry.sequence.load(std::memory_order_acquire) != sequence + 1) {
+            continue;
+        }
+
+        const qint64 timeNs = entry.timeNs;
+        const qint64 value = entry.value;
+        const quint32 threadId = entry.threadId;
+        const quint16 category = entry.category;
+        const int length = qMin<int>(entry.length, TEXT_SIZE - 1);
+        char text[TEXT_SIZE];
+        std::memcpy(text, entry.text, TEXT_SIZE);
+
+        // Overwritten while being copied
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) != sequence + 1) {
+            continue;
+        }
+
+        Breadcrumb crumb;
+        crumb.timestampMs = header->sessionStartMs + (timeNs - header->sessionStartNs) / 1000000;
+        crumb.category = category <= Network ? Category(category) : General;
+        crumb.threadId = threadId;
+        crumb.value = value;
+        crumb.text = QByteArray(text, length);
+        result.append(crumb);
+    }
+
+    return result;
+}
+
+quint32 BreadcrumbRing::currentThreadId()
+{
+    static std::atomic<quint32> nextThreadId{1};
+    thread_local const quint32 threadId = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+    return threadId;
+}
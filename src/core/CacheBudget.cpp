@@ -0,0 +1,330 @@
+#include "CacheBudget.h"
+#include "Metrics.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QLoggingCategory>
+#include <QSettings>
+#include <QTimer>
+#include <algorithm>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_MACOS)
+#include <dispatch/dispatch.h>
+#include <sys/sysctl.h>
+#elif defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
+
+Q_LOGGING_CATEGORY(cacheBudget, "eonplay.cachebudget")
+
+namespace {
+
+const char* const SETTINGS_GROUP = "Memory";
+
+struct MemoryStatus {
+    qint64 total = 0;
+    qint64 available = -1;      // -1 if unknown
+};
+
+#if defined(Q_OS_LINUX)
+/**
+ * @brief Read a "Key: value kB" field of /proc/meminfo, in bytes
+ */
+qint64 meminfoField(const QByteArray& meminfo, const QByteArray& key)
+{
+    for (const QByteArray& line : meminfo.split('\n')) {
+        if (line.startsWith(key + ':')) {
+            bool ok = false;
+            const qint64 kilobytes = line.mid(key.size() + 1).simplified().split(' ').value(0).toLongLong(&ok);
+            return ok ? kilobytes * 1024 : -1;
+        }
+    }
+    return -1;
+}
+
+qint64 readCgroupValue(const QString& name)
+{
+    QFile file(QStringLiteral("/sys/fs/cgroup/") + name);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    bool ok = false;
+    const qint64 value = file.readAll().trimmed().toLongLong(&ok);    // "max" for no limit
+    return ok ? value : -1;
+}
+#endif
+
+/**
+ * @brief Physical memory and what is still available, within the cgroup limit on Linux
+ */
+MemoryStatus memoryStatus()
+{
+    MemoryStatus status;
+
+#if defined(Q_OS_WIN)
+    MEMORYSTATUSEX memory;
+    memory.dwLength = sizeof(memory);
+    if (GlobalMemoryStatusEx(&memory)) {
+        status.total = static_cast<qint64>(memory.ullTotalPhys);
+        status.available = static_cast<qint64>(memory.ullAvailPhys);
+    }
+#elif defined(Q_OS_MACOS)
+    quint64 total = 0;
+    size_t size = sizeof(total);
+    if (sysctlbyname("hw.memsize", &total, &size, nullptr, 0) == 0) {
+        status.total = static_cast<qint64>(total);
+    }
+#elif defined(Q_OS_LINUX)
+    QFile file(QStringLiteral("/proc/meminfo"));
+    if (file.open(QIODevice::ReadOnly)) {
+        const QByteArray meminfo = file.readAll();
+        status.total = meminfoField(meminfo, "MemTotal");
+        status.available = meminfoField(meminfo, "MemAvailable");
+    }
+
+    // In a container the cgroup limit is what runs out first
+    const qint64 limit = readCgroupValue(QStringLiteral("memory.max"));
+    const qint64 current = readCgroupValue(QStringLiteral("memory.current"));
+    if (limit > 0 && (status.total <= 0 || limit < status.total)) {
+        status.total = limit;
+        if (current >= 0) {
+            const qint64 cgroupAvailable = qMax<qint64>(0, limit - current);
+            status.available = status.available < 0 ? cgroupAvailable : qMin(status.available, cgroupAvailable);
+        }
+    }
+#elif defined(Q_OS_UNIX)
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && pageSize > 0) {
+        status.total = qint64(pages) * pageSize;
+    }
+#endif
+
+    return status;
+}
+
+QByteArray gaugeName(const QString& name)
+{
+    return "eonplay_cache_" + name.toLatin1() + "_bytes";
+}
+
+} // namespace
+
+CacheBudget& CacheBudget::instance()
+{
+    static CacheBudget* budget = [] {
+        auto* instance = new CacheBudget();
+        if (QCoreApplication::instance()) {
+            instance->moveToThread(QCoreApplication::instance()->thread());
+        }
+        return instance;
+    }();
+    return *budget;
+}
+
+CacheBudget::CacheBudget(QObject* parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+    , m_usageGauge(MetricsRegistry::instance().gauge("eonplay_cache_bytes", "Bytes held by all budgeted caches"))
+    , m_budgetGauge(MetricsRegistry::instance().gauge("eonplay_cache_budget_bytes", "Bytes the caches may hold"))
+    , m_evictedCounter(MetricsRegistry::instance().counter("eonplay_cache_evicted_bytes",
+                                                           "Bytes evicted from caches to stay within the budget"))
+{
+    QSettings settings;
+    settings.beginGroup(SETTINGS_GROUP);
+    const qint64 configured = settings.value("cacheBudgetMB", 0).toLongLong() * 1024 * 1024;
+    m_budget = configured > 0 ? configured : defaultBudget();
+    m_budgetGauge.set(m_budget);
+
+    m_timer->setInterval(POLL_INTERVAL_MS);
+    connect(m_timer, &QTimer::timeout, this, &CacheBudget::collect);
+
+    startPressureMonitoring();
+    qCInfo(cacheBudget) << "Cache budget" << m_budget / (1024 * 1024) << "MB";
+}
+
+CacheBudget::~CacheBudget()
+{
+    stopPressureMonitoring();
+}
+
+void CacheBudget::registerCache(const QString& name, Priority priority, QObject* context, CostFunction cost,
+                                TrimFunction trim)
+{
+    Entry entry;
+    entry.name = name;
+    entry.priority = priority;
+    entry.context = context;
+    entry.cost = std::move(cost);
+    entry.trim = std::move(trim);
+    entry.gauge = &MetricsRegistry::instance().gauge(gaugeName(name), "Bytes held by the " + name.toLatin1() + " cache");
+    m_entries.append(std::move(entry));
+
+    // Registrations are made at startup; polling starts with the first
+    if (!m_timer->isActive()) {
+        m_timer->start();
+    }
+}
+
+void CacheBudget::setBudget(qint64 bytes)
+{
+    QSettings settings;
+    settings.beginGroup(SETTINGS_GROUP);
+    settings.setValue("cacheBudgetMB", qMax<qint64>(0, bytes) / (1024 * 1024));
+
+    m_budget = bytes > 0 ? bytes : defaultBudget();
+    m_budgetGauge.set(m_budget);
+    collect();
+}
+
+qint64 CacheBudget::defaultBudget()
+{
+    const qint64 total = memoryStatus().total;
+    if (total <= 0) {
+        return MIN_BUDGET * 4;
+    }
+    return qBound(MIN_BUDGET, total / 8, MAX_BUDGET);
+}
+
+void CacheBudget::collect()
+{
+    // Owners that are gone take their registrations with them
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+                                   [](const Entry& entry) { return entry.context.isNull(); }),
+                    m_entries.end());
+
+    const Pressure pressure = readPressure();
+    if (pressure != m_pressure) {
+        qCInfo(cacheBudget) << "Memory pressure" << pressure;
+        m_pressure = pressure;
+        emit pressureChanged(pressure);
+    }
+
+    m_usage = 0;
+    for (Entry& entry : m_entries) {
+        entry.bytes = qMax<qint64>(0, entry.cost());
+        m_usage += entry.bytes;
+    }
+
+    const qint64 limit = target();
+    if (m_usage > limit) {
+        qint64 excess = m_usage - limit * TRIM_TARGET_PERCENT / 100;
+
+        QList<Entry*> order;
+        for (Entry& entry : m_entries) {
+            order.append(&entry);
+        }
+        std::stable_sort(order.begin(), order.end(), [](const Entry* a, const Entry* b) {
+            return a->priority != b->priority ? a->priority < b->priority : a->bytes > b->bytes;
+        });
+
+        for (Entry* entry : order) {
+            if (excess <= 0) {
+                break;
+            }
+            if (entry->bytes <= 0) {
+                continue;
+            }
+            const qint64 released = qBound<qint64>(0, entry->trim(qMin(excess, entry->bytes)), entry->bytes);
+            entry->bytes -= released;
+            m_usage -= released;
+            excess -= released;
+            m_evictedCounter.add(released);
+            qCDebug(cacheBudget) << "Trimmed" << released << "bytes from" << entry->name;
+        }
+    }
+
+    // Several registrations may share a name, e.g. one per view
+    QHash<MetricGauge*, qint64> gauges;
+    for (const Entry& entry : m_entries) {
+        gauges[entry.gauge] += entry.bytes;
+    }
+    for (auto it = gauges.constBegin(); it != gauges.constEnd(); ++it) {
+        it.key()->set(it.value());
+    }
+    m_usageGauge.set(m_usage);
+}
+
+qint64 CacheBudget::target() const
+{
+    switch (m_pressure) {
+    case Pressure::Critical:
+        return m_budget / 8;
+    case Pressure::Moderate:
+        return m_budget / 2;
+    case Pressure::Normal:
+        break;
+    }
+    return m_budget;
+}
+
+CacheBudget::Pressure CacheBudget::readPressure()
+{
+    Pressure pressure = static_cast<Pressure>(m_platformPressure.load(std::memory_order_relaxed));
+
+#if defined(Q_OS_WIN)
+    BOOL low = FALSE;
+    if (m_pressureSource && QueryMemoryResourceNotification(static_cast<HANDLE>(m_pressureSource), &low) && low) {
+        pressure = Pressure::Critical;
+    }
+#endif
+
+    const MemoryStatus status = memoryStatus();
+    if (status.total > 0 && status.available >= 0) {
+        const qint64 percent = status.available * 100 / status.total;
+        if (percent < CRITICAL_AVAILABLE_PERCENT) {
+            pressure = qMax(pressure, Pressure::Critical);
+        } else if (percent < MODERATE_AVAILABLE_PERCENT) {
+            pressure = qMax(pressure, Pressure::Moderate);
+        }
+    }
+
+    return pressure;
+}
+
+void CacheBudget::startPressureMonitoring()
+{
+#if defined(Q_OS_WIN)
+    m_pressureSource = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+#elif defined(Q_OS_MACOS)
+    dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                                                      DISPATCH_MEMORYPRESSURE_NORMAL | DISPATCH_MEMORYPRESSURE_WARN
+                                                          | DISPATCH_MEMORYPRESSURE_CRITICAL,
+                                                      dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+    if (!source) {
+        return;
+    }
+    dispatch_set_context(source, this);
+    dispatch_source_set_event_handler_f(source, [](void* context) {
+        auto* budget = static_cast<CacheBudget*>(context);
+        const auto source = static_cast<dispatch_source_t>(budget->m_pressureSource);
+        const unsigned long level = dispatch_source_get_data(source);
+        const Pressure pressure = (level & DISPATCH_MEMORYPRESSURE_CRITICAL) ? Pressure::Critical
+                                  : (level & DISPATCH_MEMORYPRESSURE_WARN)   ? Pressure::Moderate
+                                                                             : Pressure::Normal;
+        budget->m_platformPressure.store(static_cast<int>(pressure), std::memory_order_relaxed);
+
+        // Do not wait for the next poll to give memory back
+        QMetaObject::invokeMethod(budget, &CacheBudget::collect, Qt::QueuedConnection);
+    });
+    m_pressureSource = source;
+    dispatch_resume(source);
+#endif
+}
+
+void CacheBudget::stopPressureMonitoring()
+{
+    if (!m_pressureSource) {
+        return;
+    }
+#if defined(Q_OS_WIN)
+    CloseHandle(static_cast<HANDLE>(m_pressureSource));
+#elif defined(Q_OS_MACOS)
+    const auto source = static_cast<dispatch_source_t>(m_pressureSource);
+    dispatch_source_cancel(source);
+    dispatch_release(source);
+#endif
+    m_pressureSource = nullptr;
+}
@@ -1,11 +1,23 @@
 #include "ComponentManager.h"
+#include "TraceLog.h"
+#include <QEvent>
+#include <QThreadPool>
+#include <QTimer>
 #include <QLoggingCategory>
 #include <algorithm>
+#include <functional>
 
 Q_LOGGING_CATEGORY(componentManager, "mediaplayer.componentmanager")
 
 ComponentManager::ComponentManager(QObject* parent)
-    : QObject(parent), m_allInitialized(false)
+    : QObject(parent)
+    , m_allInitialized(false)
+    , m_initPool(new QThreadPool(this))
+    , m_running(0)
+    , m_deferredPhase(false)
+    , m_deferredRunning(false)
+    , m_phaseSuccessful(true)
+    , m_deferredStart(0)
 {
     qCDebug(componentManager) << "ComponentManager created";
 }
@@ -38,6 +50,11 @@ void ComponentManager::registerComponent(std::shared_ptr<IComponent> component,
 
 bool ComponentManager::initializeAll()
 {
+    if (m_running > 0) {
+        qCWarning(componentManager) << "Component initialization already in progress";
+        return false;
+    }
+    
     if (m_components.isEmpty()) {
         qCDebug(componentManager) << "No components to initialize";
         m_allInitialized = true;
@@ -46,45 +63,31 @@ bool ComponentManager::initializeAll()
     }
     
     // Sort components by priority (lower numbers first)
-    std::sort(m_components.begin(), m_components.end(),
-              [](const ComponentEntry& a, const ComponentEntry& b) {
-                  return a.priority < b.priority;
-              });
+    std::stable_sort(m_components.begin(), m_components.end(),
+                     [](const ComponentEntry& a, const ComponentEntry& b) {
+                         return a.priority < b.priority;
+                     });
     
     qCDebug(componentManager) << "Initializing" << m_components.size() << "components";
+    TraceScope trace("components.initialize");
     
-    bool allSuccessful = true;
+    m_deferredPhase = false;
+    m_phaseSuccessful = true;
+    resolveDependencies();
+    advance();
     
-    for (auto& entry : m_components) {
-        const QString componentName = entry.component->componentName();
-        
-        qCDebug(componentManager) << "Initializing component:" << componentName;
-        
-        try {
-            if (entry.component->initialize()) {
-                entry.initialized = true;
-                qCDebug(componentManager) << "Successfully initialized:" << componentName;
-                emit componentInitialized(componentName);
-            } else {
-                const QString error = QString("Component %1 failed to initialize").arg(componentName);
-                qCCritical(componentManager) << error;
-                emit componentInitializationFailed(componentName, error);
-                allSuccessful = false;
+    // Main-thread components ran inline; wait for the concurrent ones
+    while (!isPhaseComplete() && m_running > 0) {
+        {
+            QMutexLocker locker(&m_completionMutex);
+            while (m_completions.isEmpty()) {
+                m_completionReady.wait(&m_completionMutex);
             }
-        } catch (const std::exception& e) {
-            const QString error = QString("Exception during initialization of %1: %2")
-                                    .arg(componentName, e.what());
-            qCCritical(componentManager) << error;
-            emit componentInitializationFailed(componentName, error);
-            allSuccessful = false;
-        } catch (...) {
-            const QString error = QString("Unknown exception during initialization of %1").arg(componentName);
-            qCCritical(componentManager) << error;
-            emit componentInitializationFailed(componentName, error);
-            allSuccessful = false;
         }
+        processCompletions();
     }
     
+    const bool allSuccessful = m_phaseSuccessful;
     m_allInitialized = allSuccessful;
     
     if (allSuccessful) {
@@ -97,32 +100,347 @@ bool ComponentManager::initializeAll()
     return allSuccessful;
 }
 
+void ComponentManager::initializeDeferred()
+{
+    if (m_deferredPhase) {
+        return;
+    }
+    
+    qCDebug(componentManager) << "Initializing deferred components";
+    
+    m_deferredPhase = true;
+    m_deferredRunning = true;
+    m_deferredStart = TraceLog::instance().now();
+    m_phaseSuccessful = true;
+    resolveDependencies();
+    advance();
+    
+    if (isPhaseComplete()) {
+        finishDeferredPhase();
+    }
+}
+
+void ComponentManager::initializeDeferredAfterPaint(QObject* window)
+{
+    if (!window) {
+        initializeDeferred();
+        return;
+    }
+    
+    if (m_paintWatched) {
+        m_paintWatched->removeEventFilter(this);
+    }
+    
+    m_paintWatched = window;
+    window->installEventFilter(this);
+}
+
+bool ComponentManager::eventFilter(QObject* watched, QEvent* event)
+{
+    if (watched == m_paintWatched && (event->type() == QEvent::Paint || event->type() == QEvent::Expose)) {
+        watched->removeEventFilter(this);
+        m_paintWatched = nullptr;
+        
+        // Queued so the paint itself completes first
+        QTimer::singleShot(0, this, &ComponentManager::initializeDeferred);
+    }
+    
+    return QObject::eventFilter(watched, event);
+}
+
+void ComponentManager::resolveDependencies()
+{
+    QHash<QString, int> indices;
+    for (int i = 0; i < m_components.size(); ++i) {
+        indices.insert(m_components[i].component->componentName(), i);
+    }
+    
+    for (int i = 0; i < m_components.size(); ++i) {
+        ComponentEntry& entry = m_components[i];
+        entry.dependencies.clear();
+        entry.error.clear();
+        entry.deferred = !entry.component->isCritical();
+        
+        const QStringList dependencies = entry.component->dependencies();
+        for (const QString& dependency : dependencies) {
+            const int index = indices.value(dependency, -1);
+            if (index < 0) {
+                entry.error = QString("Component %1 depends on unregistered component %2")
+                                .arg(entry.component->componentName(), dependency);
+            } else {
+                entry.dependencies.append(index);
+            }
+        }
+    }
+    
+    // Critical components pull their dependencies forward
+    QList<int> stack;
+    for (int i = 0; i < m_components.size(); ++i) {
+        if (!m_components[i].deferred) {
+            stack.append(i);
+        }
+    }
+    while (!stack.isEmpty()) {
+        const int index = stack.takeLast();
+        for (int dependency : std::as_const(m_components[index].dependencies)) {
+            if (m_components[dependency].deferred) {
+                m_components[dependency].deferred = false;
+                stack.append(dependency);
+            }
+        }
+    }
+    
+    // Components on a cycle can never start; their dependents fail with them
+    QVector<int> marks(m_components.size(), 0);     // 0 new, 1 on path, 2 done
+    QList<int> path;
+    std::function<void(int)> visit = [&](int index) {
+        marks[index] = 1;
+        path.append(index);
+        for (int dependency : std::as_const(m_components[index].dependencies)) {
+            if (marks[dependency] == 1) {
+                for (int k = path.indexOf(dependency); k < path.size(); ++k) {
+                    ComponentEntry& member = m_components[path[k]];
+                    member.error = QString("Component %1 is part of a dependency cycle")
+                                     .arg(member.component->componentName());
+                }
+            } else if (marks[dependency] == 0) {
+                visit(dependency);
+            }
+        }
+        path.removeLast();
+        marks[index] = 2;
+    };
+    for (int i = 0; i < m_components.size(); ++i) {
+        if (marks[i] == 0) {
+            visit(i);
+        }
+    }
+}
+
+bool ComponentManager::inCurrentPhase(int index) const
+{
+    return m_deferredPhase || !m_components[index].deferred;
+}
+
+bool ComponentManager::isPhaseComplete() const
+{
+    for (int i = 0; i < m_components.size(); ++i) {
+        const InitState state = m_components[i].state;
+        if (inCurrentPhase(i) && (state == InitState::Pending || state == InitState::Running)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ComponentManager::advance()
+{
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        
+        for (int i = 0; i < m_components.size(); ++i) {
+            if (m_components[i].state != InitState::Pending || !inCurrentPhase(i)) {
+                continue;
+            }
+            
+            const std::shared_ptr<IComponent> component = m_components[i].component;
+            if (!m_components[i].error.isEmpty()) {
+                finishComponent(i, false, m_components[i].error);
+                changed = true;
+                continue;
+            }
+            
+            bool ready = true;
+            QString failedDependency;
+            for (int dependency : std::as_const(m_components[i].dependencies)) {
+                const InitState state = m_components[dependency].state;
+                if (state == InitState::Failed) {
+                    failedDependency = m_components[dependency].component->componentName();
+                    break;
+                }
+                if (state != InitState::Initialized) {
+                    ready = false;
+                }
+            }
+            
+            if (!failedDependency.isEmpty()) {
+                finishComponent(i, false, QString("Component %1 not initialized: dependency %2 failed")
+                                            .arg(component->componentName(), failedDependency));
+                changed = true;
+                continue;
+            }
+            
+            if (!ready) {
+                continue;
+            }
+            
+            if (component->canInitializeConcurrently()) {
+                startConcurrent(i);
+                continue;
+            }
+            
+            // Rescan afterwards so priority order holds for what became ready
+            qCDebug(componentManager) << "Initializing component:" << component->componentName();
+            m_components[i].state = InitState::Running;
+            QString error;
+            const bool success = runInitialize(*component, error);
+            finishComponent(i, success, error);
+            changed = true;
+            break;
+        }
+    }
+}
+
+void ComponentManager::startConcurrent(int index)
+{
+    const std::shared_ptr<IComponent> component = m_components[index].component;
+    qCDebug(componentManager) << "Initializing component concurrently:" << component->componentName();
+    
+    m_components[index].state = InitState::Running;
+    ++m_running;
+    
+    m_initPool->start([this, index, component]() {
+        QString error;
+        const bool success = runInitialize(*component, error);
+        {
+            QMutexLocker locker(&m_completionMutex);
+            m_completions.append({index, success, error});
+            m_completionReady.wakeAll();
+        }
+        
+        // Picked up here unless initializeAll() is waiting for it
+        QMetaObject::invokeMethod(this, &ComponentManager::processCompletions, Qt::QueuedConnection);
+    });
+}
+
+bool ComponentManager::drainCompletions()
+{
+    QList<Completion> completions;
+    {
+        QMutexLocker locker(&m_completionMutex);
+        completions.swap(m_completions);
+    }
+    
+    for (const Completion& completion : std::as_const(completions)) {
+        --m_running;
+        finishComponent(completion.index, completion.success, completion.error);
+    }
+    
+    return !completions.isEmpty();
+}
+
+void ComponentManager::processCompletions()
+{
+    if (!drainCompletions()) {
+        return;
+    }
+    
+    advance();
+    
+    if (m_deferredRunning && isPhaseComplete()) {
+        finishDeferredPhase();
+    }
+}
+
+void ComponentManager::finishComponent(int index, bool success, const QString& error)
+{
+    ComponentEntry& entry = m_components[index];
+    const QString componentName = entry.component->componentName();
+    
+    if (success) {
+        entry.state = InitState::Initialized;
+        m_initializationOrder.append(entry.component);
+        qCDebug(componentManager) << "Successfully initialized:" << componentName;
+        emit componentInitialized(componentName);
+    } else {
+        entry.state = InitState::Failed;
+        if (inCurrentPhase(index)) {
+            m_phaseSuccessful = false;
+        }
+        qCCritical(componentManager) << error;
+        emit componentInitializationFailed(componentName, error);
+    }
+}
+
+void ComponentManager::finishDeferredPhase()
+{
+    if (!m_deferredRunning) {
+        return;
+    }
+    
+    m_deferredRunning = false;
+    m_allInitialized = m_allInitialized && m_phaseSuccessful;
+    TraceLog::instance().addComplete("components.deferred", "startup", m_deferredStart,
+                                     TraceLog::instance().now() - m_deferredStart);
+    
+    if (m_phaseSuccessful) {
+        qCDebug(componentManager) << "Deferred components initialized successfully";
+    } else {
+        qCWarning(componentManager) << "Some deferred components failed to initialize";
+    }
+    
+    emit deferredComponentsInitialized(m_phaseSuccessful);
+}
+
+bool ComponentManager::runInitialize(IComponent& component, QString& error)
+{
+    const QString componentName = component.componentName();
+    TraceScope trace("component." + componentName);
+    
+    try {
+        if (component.initialize()) {
+            return true;
+        }
+        error = QString("Component %1 failed to initialize").arg(componentName);
+    } catch (const std::exception& e) {
+        error = QString("Exception during initialization of %1: %2").arg(componentName, e.what());
+    } catch (...) {
+        error = QString("Unknown exception during initialization of %1").arg(componentName);
+    }
+    
+    return false;
+}
+
 void ComponentManager::shutdownAll()
 {
     if (m_components.isEmpty()) {
         return;
     }
     
+    // Concurrent initialization has to finish before anything shuts down
+    m_initPool->waitForDone();
+    drainCompletions();
+    m_deferredRunning = false;
+    
+    if (m_paintWatched) {
+        m_paintWatched->removeEventFilter(this);
+        m_paintWatched = nullptr;
+    }
+    
     qCDebug(componentManager) << "Shutting down" << m_components.size() << "components";
     
-    // Shutdown in reverse order
-    for (auto it = m_components.rbegin(); it != m_components.rend(); ++it) {
-        if (it->initialized) {
-            const QString componentName = it->component->componentName();
-            qCDebug(componentManager) << "Shutting down component:" << componentName;
-            
-            try {
-                it->component->shutdown();
-                it->initialized = false;
-                qCDebug(componentManager) << "Successfully shut down:" << componentName;
-            } catch (const std::exception& e) {
-                qCWarning(componentManager) << "Exception during shutdown of" << componentName << ":" << e.what();
-            } catch (...) {
-                qCWarning(componentManager) << "Unknown exception during shutdown of" << componentName;
-            }
+    // Shutdown in reverse initialization order, dependents first
+    for (auto it = m_initializationOrder.rbegin(); it != m_initializationOrder.rend(); ++it) {
+        const QString componentName = (*it)->componentName();
+        qCDebug(componentManager) << "Shutting down component:" << componentName;
+        
+        try {
+            (*it)->shutdown();
+            qCDebug(componentManager) << "Successfully shut down:" << componentName;
+        } catch (const std::exception& e) {
+            qCWarning(componentManager) << "Exception during shutdown of" << componentName << ":" << e.what();
+        } catch (...) {
+            qCWarning(componentManager) << "Unknown exception during shutdown of" << componentName;
         }
     }
     
+    m_initializationOrder.clear();
+    for (auto& entry : m_components) {
+        entry.state = InitState::Pending;
+    }
+    m_deferredPhase = false;
+    
     m_allInitialized = false;
     qCDebug(componentManager) << "All components shut down";
 }
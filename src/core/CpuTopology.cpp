@@ -0,0 +1,261 @@
+#include "CpuTopology.h"
+#include <QFile>
+#include <QLoggingCategory>
+#include <QThread>
+#include <algorithm>
+#include <climits>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_LINUX)
+#include <QMap>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+Q_LOGGING_CATEGORY(cpuTopology, "eonplay.cputopology")
+
+namespace {
+
+#if defined(Q_OS_WIN)
+// Windows 10 APIs, looked up so older SDK headers and systems are no obstacle
+using GetSystemCpuSetInformationFunction = BOOL (WINAPI*)(PSYSTEM_CPU_SET_INFORMATION, ULONG, PULONG, HANDLE, ULONG);
+using SetThreadSelectedCpuSetsFunction = BOOL (WINAPI*)(HANDLE, const ULONG*, ULONG);
+using SetProcessDefaultCpuSetsFunction = BOOL (WINAPI*)(HANDLE, const ULONG*, ULONG);
+
+template <typename Function>
+Function kernelFunction(const char* name)
+{
+    return reinterpret_cast<Function>(GetProcAddress(GetModuleHandleW(L"kernel32.dll"), name));
+}
+
+QVector<ULONG> cpuSetIds(const QVector<int>& cpus)
+{
+    QVector<ULONG> ids;
+    ids.reserve(cpus.size());
+    for (int cpu : cpus) {
+        ids.append(static_cast<ULONG>(cpu));
+    }
+    return ids;
+}
+
+#elif defined(Q_OS_LINUX)
+QByteArray readSysFile(const QString& path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll().trimmed() : QByteArray();
+}
+
+/**
+ * @brief Parse a kernel CPU list such as "0-3,8,10-11"
+ */
+QVector<int> parseCpuList(const QByteArray& list)
+{
+    QVector<int> cpus;
+    for (const QByteArray& range : list.split(',')) {
+        const QList<QByteArray> bounds = range.trimmed().split('-');
+        bool firstOk = false;
+        bool lastOk = false;
+        const int first = bounds.value(0).toInt(&firstOk);
+        const int last = bounds.size() > 1 ? bounds.value(1).toInt(&lastOk) : first;
+        if (!firstOk || (bounds.size() > 1 && !lastOk)) {
+            continue;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.append(cpu);
+        }
+    }
+    return cpus;
+}
+
+QVector<int> intersect(const QVector<int>& cpus, const QVector<int>& allowed)
+{
+    QVector<int> result;
+    for (int cpu : cpus) {
+        if (allowed.contains(cpu)) {
+            result.append(cpu);
+        }
+    }
+    return result;
+}
+#endif
+
+} // namespace
+
+const CpuTopology& CpuTopology::instance()
+{
+    static const CpuTopology topology;
+    return topology;
+}
+
+CpuTopology::CpuTopology()
+{
+    detect();
+
+    if (isHybrid()) {
+        qCInfo(cpuTopology) << "Hybrid CPU:" << m_performance.size() << "performance and"
+                            << m_efficiency.size() << "efficiency cores";
+    }
+}
+
+void CpuTopology::detect()
+{
+#if defined(Q_OS_LINUX)
+    // Whatever the process was started with, e.g. by taskset or a cpuset
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(getpid(), sizeof(mask), &mask) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &mask)) {
+                m_all.append(cpu);
+            }
+        }
+    }
+
+    // Intel hybrid parts have a PMU per core type
+    m_performance = intersect(parseCpuList(readSysFile(QStringLiteral("/sys/devices/cpu_core/cpus"))), m_all);
+    m_efficiency = intersect(parseCpuList(readSysFile(QStringLiteral("/sys/devices/cpu_atom/cpus"))), m_all);
+    if (isHybrid()) {
+        return;
+    }
+    m_performance.clear();
+    m_efficiency.clear();
+
+    // ARM reports each CPU's capacity relative to the biggest core, 1024
+    QMap<int, int> capacities;
+    for (int cpu : m_all) {
+        bool ok = false;
+        const int capacity = readSysFile(QStringLiteral("/sys/devices/system/cpu/cpu%1/cpu_capacity").arg(cpu)).toInt(&ok);
+        if (ok && capacity > 0) {
+            capacities.insert(cpu, capacity);
+        }
+    }
+    if (capacities.isEmpty()) {
+        return;
+    }
+
+    const QList<int> values = capacities.values();
+    const int lowest = *std::min_element(values.begin(), values.end());
+    const int highest = *std::max_element(values.begin(), values.end());
+    if (lowest == highest) {
+        return;
+    }
+    for (auto it = capacities.constBegin(); it != capacities.constEnd(); ++it) {
+        (it.value() == lowest ? m_efficiency : m_performance).append(it.key());
+    }
+
+#elif defined(Q_OS_WIN)
+    const auto getInformation = kernelFunction<GetSystemCpuSetInformationFunction>("GetSystemCpuSetInformation");
+    if (!getInformation) {
+        return;
+    }
+
+    ULONG length = 0;
+    getInformation(nullptr, 0, &length, GetCurrentProcess(), 0);
+    QByteArray buffer(static_cast<int>(length), Qt::Uninitialized);
+    if (length == 0 || !getInformation(reinterpret_cast<PSYSTEM_CPU_SET_INFORMATION>(buffer.data()), length, &length,
+                                       GetCurrentProcess(), 0)) {
+        return;
+    }
+
+    // Higher classes are faster cores; the lowest are the efficiency cores
+    QVector<QPair<int, int>> sets;
+    int lowest = INT_MAX;
+    int highest = INT_MIN;
+    for (ULONG offset = 0; offset < length;) {
+        const auto* information = reinterpret_cast<const SYSTEM_CPU_SET_INFORMATION*>(buffer.constData() + offset);
+        if (information->Size == 0) {
+            break;
+        }
+        if (information->Type == CpuSetInformation) {
+            const int efficiencyClass = information->CpuSet.EfficiencyClass;
+            sets.append(qMakePair(static_cast<int>(information->CpuSet.Id), efficiencyClass));
+            lowest = qMin(lowest, efficiencyClass);
+            highest = qMax(highest, efficiencyClass);
+        }
+        offset += information->Size;
+    }
+
+    for (const QPair<int, int>& set : sets) {
+        m_all.append(set.first);
+        if (lowest != highest) {
+            (set.second == lowest ? m_efficiency : m_performance).append(set.first);
+        }
+    }
+#endif
+}
+
+int CpuTopology::backgroundThreadCount() const
+{
+    return isHybrid() ? m_efficiency.size() : qMax(1, QThread::idealThreadCount());
+}
+
+const QVector<int>& CpuTopology::cpus(Placement placement) const
+{
+    switch (placement) {
+    case Placement::Performance:
+        return m_performance;
+    case Placement::Efficiency:
+        return m_efficiency;
+    case Placement::Any:
+        break;
+    }
+    return m_all;
+}
+
+bool CpuTopology::placeCurrentThread(Placement placement) const
+{
+    if (!isHybrid()) {
+        return false;
+    }
+
+#if defined(Q_OS_LINUX)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int cpu : cpus(placement)) {
+        CPU_SET(cpu, &mask);
+    }
+    // With pid 0, the calling thread only
+    return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#elif defined(Q_OS_WIN)
+    static const auto setSelected = kernelFunction<SetThreadSelectedCpuSetsFunction>("SetThreadSelectedCpuSets");
+    if (!setSelected) {
+        return false;
+    }
+    // An empty selection lets the thread run anywhere again
+    if (placement == Placement::Any) {
+        return setSelected(GetCurrentThread(), nullptr, 0);
+    }
+    const QVector<ULONG> ids = cpuSetIds(cpus(placement));
+    return setSelected(GetCurrentThread(), ids.constData(), static_cast<ULONG>(ids.size()));
+#else
+    Q_UNUSED(placement)
+    return false;
+#endif
+}
+
+bool CpuTopology::placeProcess(qint64 processId, Placement placement) const
+{
+    if (!isHybrid() || processId <= 0) {
+        return false;
+    }
+
+#if defined(Q_OS_WIN)
+    static const auto setDefault = kernelFunction<SetProcessDefaultCpuSetsFunction>("SetProcessDefaultCpuSets");
+    if (!setDefault) {
+        return false;
+    }
+
+    HANDLE process = OpenProcess(PROCESS_SET_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(processId));
+    if (!process) {
+        return false;
+    }
+    const QVector<ULONG> ids = cpuSetIds(placement == Placement::Any ? QVector<int>() : cpus(placement));
+    const bool placed = setDefault(process, ids.isEmpty() ? nullptr : ids.constData(), static_cast<ULONG>(ids.size()));
+    CloseHandle(process);
+    return placed;
+#else
+    Q_UNUSED(placement)
+    return false;
+#endif
+}
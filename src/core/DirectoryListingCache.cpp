@@ -0,0 +1,188 @@
+#include "DirectoryListingCache.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+
+Q_LOGGING_CATEGORY(directoryListingCache, "eonplay.directorylistingcache")
+
+namespace {
+
+qint64 steadyMilliseconds()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+bool DirectoryListingCache::Listing::hasFile(const QString& name) const
+{
+    return std::binary_search(files.cbegin(), files.cend(), name);
+}
+
+bool DirectoryListingCache::Listing::hasDirectory(const QString& name) const
+{
+    return std::binary_search(directories.cbegin(), directories.cend(), name);
+}
+
+DirectoryListingCache& DirectoryListingCache::instance()
+{
+    // Lives on the main thread, which delivers the watcher's notifications
+    static DirectoryListingCache* cache = [] {
+        auto* instance = new DirectoryListingCache();
+        if (QCoreApplication::instance()) {
+            instance->moveToThread(QCoreApplication::instance()->thread());
+        }
+        return instance;
+    }();
+    return *cache;
+}
+
+DirectoryListingCache::DirectoryListingCache(QObject* parent)
+    : QObject(parent)
+    , m_watcher(new QFileSystemWatcher(this))
+    , m_useCounter(0)
+{
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &DirectoryListingCache::invalidate);
+}
+
+DirectoryListingCache::Listing DirectoryListingCache::listing(const QString& directory)
+{
+    const QString path = normalizedPath(directory);
+    const qint64 now = steadyMilliseconds();
+
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_entries.find(path);
+        if (it != m_entries.end() && now - it->readAtMs < MAX_AGE_MS) {
+            it->lastUse = ++m_useCounter;
+            return it->listing;
+        }
+    }
+
+    // Read without the lock; a concurrent read of the same directory just replaces this one
+    const Listing listing = readListing(path);
+
+    bool added = false;
+    QStringList evicted;
+    {
+        QMutexLocker locker(&m_mutex);
+        added = !m_entries.contains(path);
+        Entry& entry = m_entries[path];
+        entry.listing = listing;
+        entry.readAtMs = now;
+        entry.lastUse = ++m_useCounter;
+
+        while (m_entries.size() > CAPACITY) {
+            auto oldest = m_entries.begin();
+            for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+                if (it->lastUse < oldest->lastUse) {
+                    oldest = it;
+                }
+            }
+            evicted << oldest.key();
+            m_entries.erase(oldest);
+        }
+    }
+
+    if (added && listing.exists) {
+        watch(path);
+    }
+    if (!evicted.isEmpty()) {
+        unwatch(evicted);
+    }
+    return listing;
+}
+
+void DirectoryListingCache::invalidate(const QString& directory)
+{
+    const QString path = normalizedPath(directory);
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_entries.remove(path) == 0) {
+            return;
+        }
+    }
+    unwatch({path});
+    qCDebug(directoryListingCache) << "Invalidated" << path;
+}
+
+void DirectoryListingCache::clear()
+{
+    QStringList paths;
+    {
+        QMutexLocker locker(&m_mutex);
+        paths = m_entries.keys();
+        m_entries.clear();
+    }
+    unwatch(paths);
+}
+
+QString DirectoryListingCache::normalizedPath(const QString& directory)
+{
+    return QDir::cleanPath(QDir(directory).absolutePath());
+}
+
+DirectoryListingCache::Listing DirectoryListingCache::readListing(const QString& path)
+{
+    Listing listing;
+    listing.exists = QFileInfo(path).isDir();
+    if (!listing.exists) {
+        return listing;
+    }
+
+    QDirIterator it(path, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden);
+    while (it.hasNext()) {
+        it.next();
+        if (it.fileInfo().isDir()) {
+            listing.directories << it.fileName();
+        } else {
+            listing.files << it.fileName();
+        }
+    }
+    std::sort(listing.files.begin(), listing.files.end());
+    std::sort(listing.directories.begin(), listing.directories.end());
+    return listing;
+}
+
+void DirectoryListingCache::watch(const QString& path)
+{
+    // QFileSystemWatcher belongs to this object's thread
+    QMetaObject::invokeMethod(this, [this, path]() {
+        {
+            QMutexLocker locker(&m_mutex);
+            if (!m_entries.contains(path)) {
+                return;
+            }
+        }
+        if (!m_watcher->directories().contains(path)) {
+            m_watcher->addPath(path);
+        }
+    }, QThread::currentThread() == thread() ? Qt::DirectConnection : Qt::QueuedConnection);
+}
+
+void DirectoryListingCache::unwatch(const QStringList& paths)
+{
+    QMetaObject::invokeMethod(this, [this, paths]() {
+        const QStringList watched = m_watcher->directories();
+        QStringList stale;
+        {
+            QMutexLocker locker(&m_mutex);
+            for (const QString& path : paths) {
+                if (!m_entries.contains(path) && watched.contains(path)) {
+                    stale << path;
+                }
+            }
+        }
+        if (!stale.isEmpty()) {
+            m_watcher->removePaths(stale);
+        }
+    }, QThread::currentThread() == thread() ? Qt::DirectConnection : Qt::QueuedConnection);
+}
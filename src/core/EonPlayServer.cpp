@@ -0,0 +1,142 @@
+#include "EonPlayServer.h"
+#include "ComponentManager.h"
+#include "EventBus.h"
+#include "TraceLog.h"
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QStandardPaths>
+
+Q_LOGGING_CATEGORY(eonPlayServer, "eonplay.server.application")
+
+EonPlayServer::EonPlayServer(int& argc, char** argv)
+    : QCoreApplication(argc, argv)
+    , m_componentManager(std::make_unique<ComponentManager>(this))
+    , m_initialized(false)
+{
+    // Same identity as the player, so both use the same settings and library
+    setApplicationName("EonPlay");
+    setApplicationVersion("1.0.0");
+    setOrganizationName("EonPlay Team");
+    setOrganizationDomain("eonplay.com");
+
+    connect(m_componentManager.get(), &ComponentManager::componentInitializationFailed, this,
+            [](const QString& componentName, const QString& error) {
+        qCCritical(eonPlayServer) << "Component initialization failed:" << componentName << "-" << error;
+    });
+    connect(this, &QCoreApplication::aboutToQuit, this, &EonPlayServer::shutdown);
+}
+
+EonPlayServer::~EonPlayServer()
+{
+    shutdown();
+}
+
+int EonPlayServer::run(int& argc, char** argv)
+{
+    TraceLog::instance();
+    EonPlayServer server(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("EonPlay headless media server");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    const QCommandLineOption headlessOption("headless", "Run without a user interface; always on here.");
+    const QCommandLineOption databaseOption("database", "Library database to open.", "path",
+                                            defaultDatabasePath());
+    const QCommandLineOption scanOption("scan", "Rescan the library folders on start.");
+    const QCommandLineOption shareOption("share", "Share a folder on the network; may be repeated.",
+                                         "name=path");
+    const QCommandLineOption noDlnaOption("no-dlna", "Do not publish the library as a UPnP/DLNA media server.");
+    const QCommandLineOption webControlOption("web-control", "Serve the remote web control, on any port if 0.",
+                                              "port");
+    const QCommandLineOption libraryApiOption("library-api",
+                                              "Serve the library to other EonPlay instances as a library server.");
+    const QCommandLineOption apiTokenOption("api-token",
+                                            "Token library API clients must send; defaults to $EONPLAY_API_TOKEN.",
+                                            "token");
+    parser.addOptions({headlessOption, databaseOption, scanOption, shareOption, noDlnaOption, webControlOption,
+                       libraryApiOption, apiTokenOption});
+    parser.process(server);
+
+    Options options;
+    options.databasePath = parser.value(databaseOption);
+    options.scanOnStart = parser.isSet(scanOption);
+    options.publishLibrary = !parser.isSet(noDlnaOption);
+    options.serveLibraryApi = parser.isSet(libraryApiOption);
+    options.apiToken = parser.isSet(apiTokenOption) ? parser.value(apiTokenOption)
+                                                    : qEnvironmentVariable("EONPLAY_API_TOKEN");
+    if (options.serveLibraryApi && options.apiToken.isEmpty()) {
+        qCCritical(eonPlayServer) << "The library API needs --api-token or $EONPLAY_API_TOKEN";
+        return 1;
+    }
+    for (const QString& share : parser.values(shareOption)) {
+        const qsizetype separator = share.indexOf('=');
+        const QString path = separator < 0 ? share : share.mid(separator + 1);
+        const QString name = separator < 0 ? QDir(path).dirName() : share.left(separator);
+        options.shares.append({name, QDir(path).absolutePath()});
+    }
+    if (parser.isSet(webControlOption)) {
+        bool valid = false;
+        options.webControlPort = parser.value(webControlOption).toInt(&valid);
+        if (!valid || options.webControlPort < 0 || options.webControlPort > 65535) {
+            qCCritical(eonPlayServer) << "Invalid web control port:" << parser.value(webControlOption);
+            return 1;
+        }
+    }
+
+    if (!server.initialize(options)) {
+        TraceLog::instance().flush();
+        return 1;
+    }
+
+    qCInfo(eonPlayServer) << "EonPlay server running";
+    const int result = server.exec();
+    TraceLog::instance().flush();
+    return result;
+}
+
+bool EonPlayServer::initialize(const Options& options)
+{
+    if (m_initialized) {
+        return true;
+    }
+
+    const QString databasePath = options.databasePath.isEmpty() ? defaultDatabasePath() : options.databasePath;
+    QDir().mkpath(QFileInfo(databasePath).absolutePath());
+
+    // Nothing waits on a first paint here, so every component is critical
+    auto library = std::make_shared<LibraryComponent>(databasePath, options.scanOnStart);
+    m_componentManager->registerComponent(library, 10);
+    const bool serveLibrary = options.publishLibrary || options.serveLibraryApi;
+    m_componentManager->registerComponent(
+        std::make_shared<NetworkComponent>(options.shares, serveLibrary ? library.get() : nullptr,
+                                           options.publishLibrary, options.serveLibraryApi, options.apiToken), 20);
+    m_componentManager->registerComponent(std::make_shared<CastingComponent>(options.webControlPort), 30);
+
+    if (!m_componentManager->initializeAll()) {
+        qCCritical(eonPlayServer) << "Failed to initialize the server's components";
+        return false;
+    }
+
+    m_initialized = true;
+    return true;
+}
+
+void EonPlayServer::shutdown()
+{
+    if (!m_initialized) {
+        return;
+    }
+
+    qCInfo(eonPlayServer) << "Shutting down EonPlay server";
+    m_componentManager->shutdownAll();
+    EventBus::instance().clear();
+    m_initialized = false;
+}
+
+QString EonPlayServer::defaultDatabasePath()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath("library.db");
+}
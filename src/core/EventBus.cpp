@@ -1,4 +1,6 @@
 #include "EventBus.h"
+#include "Metrics.h"
+#include <QThread>
 #include <QLoggingCategory>
 
 Q_LOGGING_CATEGORY(eventBus, "mediaplayer.eventbus")
@@ -9,29 +11,92 @@ EventBus& EventBus::instance()
     return instance;
 }
 
-int EventBus::subscribe(const QString& eventType, EventHandler handler)
+EventTypeId EventBus::typeId(const QString& eventType)
 {
-    int subscriptionId = m_nextSubscriptionId++;
+    {
+        QReadLocker locker(&m_typeLock);
+        const auto it = m_typeIds.constFind(eventType);
+        if (it != m_typeIds.constEnd()) {
+            return it.value();
+        }
+    }
     
-    Subscription subscription;
-    subscription.id = subscriptionId;
-    subscription.eventType = eventType;
-    subscription.handler = handler;
+    QWriteLocker locker(&m_typeLock);
+    const auto it = m_typeIds.constFind(eventType);
+    if (it != m_typeIds.constEnd()) {
+        return it.value();
+    }
     
-    m_subscriptions[eventType].append(subscription);
+    const EventTypeId id = m_typeNames.size();
+    m_typeNames.append(eventType);
+    m_typeIds.insert(eventType, id);
+    return id;
+}
+
+QString EventBus::typeName(EventTypeId type) const
+{
+    QReadLocker locker(&m_typeLock);
+    return m_typeNames.value(type);
+}
+
+int EventBus::subscribe(const QString& eventType, EventHandler handler)
+{
+    // String subscriptions keep their synchronous semantics
+    const int subscriptionId = addSubscription(typeId(eventType), QMetaType::fromType<Event>(), nullptr, Delivery::Direct,
+                                               [handler = std::move(handler)](const void* payload) {
+                                                   handler(*static_cast<const Event*>(payload));
+                                               });
     
     qCDebug(eventBus) << "Subscribed to event type:" << eventType << "with ID:" << subscriptionId;
     
     return subscriptionId;
 }
 
+int EventBus::subscribe(EventTypeId type, QObject* context, std::function<void()> handler, Delivery delivery)
+{
+    return addSubscription(type, QMetaType(), context, delivery,
+                           [handler = std::move(handler)](const void*) {
+                               handler();
+                           });
+}
+
+int EventBus::addSubscription(EventTypeId type, QMetaType payloadType, QObject* context,
+                              Delivery delivery, ErasedHandler handler)
+{
+    Subscription subscription;
+    subscription.eventType = type;
+    subscription.payloadType = payloadType;
+    subscription.delivery = delivery;
+    subscription.context = context;
+    subscription.receiver = std::make_shared<Receiver>();
+    subscription.receiver->handler = std::move(handler);
+    
+    QMutexLocker locker(&m_mutex);
+    subscription.id = m_nextSubscriptionId++;
+    
+    if (context) {
+        const int subscriptionId = subscription.id;
+        subscription.contextConnection = connect(context, &QObject::destroyed, this, [this, subscriptionId]() {
+            unsubscribe(subscriptionId);
+        }, Qt::DirectConnection);
+    }
+    
+    m_subscriptions[type].append(subscription);
+    return subscription.id;
+}
+
 void EventBus::unsubscribe(int subscriptionId)
 {
+    QMutexLocker locker(&m_mutex);
+    
     for (auto it = m_subscriptions.begin(); it != m_subscriptions.end(); ++it) {
         auto& subscriptions = it.value();
         for (int i = 0; i < subscriptions.size(); ++i) {
             if (subscriptions[i].id == subscriptionId) {
-                qCDebug(eventBus) << "Unsubscribed from event type:" << it.key() << "ID:" << subscriptionId;
+                qCDebug(eventBus) << "Unsubscribed from event type:" << typeName(it.key()) << "ID:" << subscriptionId;
+                // Deliveries already queued are dropped
+                subscriptions[i].receiver->active.store(false, std::memory_order_release);
+                disconnect(subscriptions[i].contextConnection);
                 subscriptions.removeAt(i);
                 if (subscriptions.isEmpty()) {
                     m_subscriptions.erase(it);
@@ -46,19 +111,9 @@ void EventBus::unsubscribe(int subscriptionId)
 
 void EventBus::publish(const Event& event)
 {
-    const auto& subscriptions = m_subscriptions.value(event.type);
+    qCDebug(eventBus) << "Publishing event:" << event.type;
     
-    qCDebug(eventBus) << "Publishing event:" << event.type << "to" << subscriptions.size() << "subscribers";
-    
-    for (const auto& subscription : subscriptions) {
-        try {
-            subscription.handler(event);
-        } catch (const std::exception& e) {
-            qCCritical(eventBus) << "Exception in event handler for" << event.type << ":" << e.what();
-        } catch (...) {
-            qCCritical(eventBus) << "Unknown exception in event handler for" << event.type;
-        }
-    }
+    dispatch(typeId(event.type), QMetaType::fromType<Event>(), &event, &copyPayload<Event>);
 }
 
 void EventBus::publish(const QString& eventType, const QVariantMap& data, QObject* sender)
@@ -67,9 +122,119 @@ void EventBus::publish(const QString& eventType, const QVariantMap& data, QObjec
     publish(event);
 }
 
+void EventBus::publish(EventTypeId type)
+{
+    dispatch(type, QMetaType(), nullptr, nullptr);
+}
+
+void EventBus::dispatch(EventTypeId type, QMetaType payloadType, const void* payload, PayloadCopier copier)
+{
+    // Handlers run unlocked, so they may subscribe and publish themselves
+    QList<Subscription> subscriptions;
+    {
+        QMutexLocker locker(&m_mutex);
+        subscriptions = m_subscriptions.value(type);
+    }
+    
+    std::shared_ptr<const void> copy;
+    for (const Subscription& subscription : std::as_const(subscriptions)) {
+        if (subscription.payloadType.isValid() && subscription.payloadType != payloadType) {
+            qCWarning(eventBus) << "Dropping" << typeName(type) << "event with payload" << payloadType.name()
+                                << "for subscriber expecting" << subscription.payloadType.name();
+            continue;
+        }
+        
+        if (!isQueued(subscription)) {
+            invoke(*subscription.receiver, payload, type);
+            continue;
+        }
+        
+        if (payload && !copy) {
+            copy = copier(payload);
+        }
+        deliverQueued(subscription, copy);
+    }
+}
+
+bool EventBus::isQueued(const Subscription& subscription) const
+{
+    switch (subscription.delivery) {
+    case Delivery::Direct:
+        return false;
+    case Delivery::Queued:
+    case Delivery::Coalesced:
+        return true;
+    case Delivery::Auto:
+        break;
+    }
+    
+    return subscription.context && subscription.context->thread() != QThread::currentThread();
+}
+
+void EventBus::deliverQueued(const Subscription& subscription, std::shared_ptr<const void> payload)
+{
+    QObject* target = subscription.context ? subscription.context : this;
+    const std::shared_ptr<Receiver> receiver = subscription.receiver;
+    const EventTypeId type = subscription.eventType;
+    
+    if (subscription.delivery != Delivery::Coalesced) {
+        QMetaObject::invokeMethod(target, [receiver, payload = std::move(payload), type]() {
+            invoke(*receiver, payload.get(), type);
+        }, Qt::QueuedConnection);
+        return;
+    }
+    
+    // One delivery in flight; later publishes only replace its payload
+    {
+        QMutexLocker locker(&receiver->mutex);
+        receiver->pending = std::move(payload);
+        if (receiver->scheduled) {
+            return;
+        }
+        receiver->scheduled = true;
+    }
+    
+    QMetaObject::invokeMethod(target, [receiver, type]() {
+        std::shared_ptr<const void> latest;
+        {
+            QMutexLocker locker(&receiver->mutex);
+            latest.swap(receiver->pending);
+            receiver->scheduled = false;
+        }
+        invoke(*receiver, latest.get(), type);
+    }, Qt::QueuedConnection);
+}
+
+void EventBus::invoke(Receiver& receiver, const void* payload, EventTypeId type)
+{
+    if (!receiver.active.load(std::memory_order_acquire)) {
+        return;
+    }
+    
+    static LatencyHistogram& dispatchTime = MetricsRegistry::instance().histogram(
+        "eonplay_eventbus_dispatch_seconds", "Time spent in one event handler");
+    LatencyTimer timer(dispatchTime);
+    
+    try {
+        receiver.handler(payload);
+    } catch (const std::exception& e) {
+        qCCritical(eventBus) << "Exception in event handler for" << instance().typeName(type) << ":" << e.what();
+    } catch (...) {
+        qCCritical(eventBus) << "Unknown exception in event handler for" << instance().typeName(type);
+    }
+}
+
 void EventBus::clear()
 {
     qCDebug(eventBus) << "Clearing all event subscriptions";
+    
+    QMutexLocker locker(&m_mutex);
+    for (const QList<Subscription>& subscriptions : std::as_const(m_subscriptions)) {
+        for (const Subscription& subscription : subscriptions) {
+            subscription.receiver->active.store(false, std::memory_order_release);
+            disconnect(subscription.contextConnection);
+        }
+    }
     m_subscriptions.clear();
     m_nextSubscriptionId = 1;
 }
\ No newline at end of file
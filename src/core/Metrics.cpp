@@ -0,0 +1,235 @@
+#include "Metrics.h"
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QtAlgorithms>
+#include <chrono>
+
+namespace {
+
+// Exported histogram buckets: powers of two from 16 us to ~16.8 s, aligned with internal bucket bounds
+constexpr int EXPORT_MIN_EXPONENT = 4;
+constexpr int EXPORT_MAX_EXPONENT = 24;
+
+qint64 steadyMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+QByteArray formatSeconds(qint64 microseconds)
+{
+    return QByteArray::number(microseconds / 1e6, 'g', 9);
+}
+
+} // namespace
+
+quint64 MetricCounter::value() const
+{
+    quint64 total = 0;
+    for (const Shard& shard : m_shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+LatencyHistogram::LatencyHistogram(const QByteArray& name, const QByteArray& help)
+    : m_name(name)
+    , m_help(help)
+    , m_shards(std::make_unique<std::array<Shard, MetricsDetail::HISTOGRAM_SHARDS>>())
+{
+}
+
+void LatencyHistogram::record(qint64 microseconds)
+{
+    microseconds = qMax<qint64>(0, microseconds);
+    Shard& shard = (*m_shards)[MetricsDetail::threadShard() % MetricsDetail::HISTOGRAM_SHARDS];
+    shard.buckets[bucketIndex(microseconds)].fetch_add(1, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(microseconds, std::memory_order_relaxed);
+
+    qint64 max = shard.max.load(std::memory_order_relaxed);
+    while (microseconds > max && !shard.max.compare_exchange_weak(max, microseconds, std::memory_order_relaxed)) {
+    }
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const
+{
+    // Shards are read one after the other, so a snapshot taken during updates may be off by the samples in flight
+    HistogramSnapshot snapshot;
+    snapshot.buckets.fill(0, BUCKET_COUNT);
+    for (const Shard& shard : *m_shards) {
+        snapshot.count += shard.count.load(std::memory_order_relaxed);
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+        snapshot.max = qMax(snapshot.max, shard.max.load(std::memory_order_relaxed));
+        for (int i = 0; i < BUCKET_COUNT; ++i) {
+            snapshot.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+    return snapshot;
+}
+
+int LatencyHistogram::bucketIndex(qint64 value)
+{
+    if (value < SUB_BUCKETS) {
+        return static_cast<int>(value);
+    }
+
+    const int exponent = qMin(63 - qCountLeadingZeroBits(quint64(value)), MAX_EXPONENT);
+    if (exponent == MAX_EXPONENT && value >= (qint64(1) << (MAX_EXPONENT + 1))) {
+        return BUCKET_COUNT - 1;
+    }
+    const int subBucket = static_cast<int>((value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket;
+}
+
+qint64 LatencyHistogram::bucketLowerBound(int index)
+{
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    const int subBucket = index % SUB_BUCKETS;
+    return qint64(SUB_BUCKETS + subBucket) << (exponent - SUB_BUCKET_BITS);
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    return bucketLowerBound(index) + (qint64(1) << (exponent - SUB_BUCKET_BITS)) - 1;
+}
+
+qint64 HistogramSnapshot::percentile(double q) const
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    const quint64 rank = qMax<quint64>(1, static_cast<quint64>(qBound(0.0, q, 1.0) * count + 0.5));
+    quint64 seen = 0;
+    for (int i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return qMin(LatencyHistogram::bucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+MetricsRegistry& MetricsRegistry::instance()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricCounter& MetricsRegistry::counter(const QByteArray& name, const QByteArray& help)
+{
+    QMutexLocker locker(&m_mutex);
+    for (const auto& counter : m_counters) {
+        if (counter->name() == name) {
+            return *counter;
+        }
+    }
+    m_counters.push_back(std::make_unique<MetricCounter>(name, help));
+    return *m_counters.back();
+}
+
+MetricGauge& MetricsRegistry::gauge(const QByteArray& name, const QByteArray& help)
+{
+    QMutexLocker locker(&m_mutex);
+    for (const auto& gauge : m_gauges) {
+        if (gauge->name() == name) {
+            return *gauge;
+        }
+    }
+    m_gauges.push_back(std::make_unique<MetricGauge>(name, help));
+    return *m_gauges.back();
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const QByteArray& name, const QByteArray& help)
+{
+    QMutexLocker locker(&m_mutex);
+    for (const auto& histogram : m_histograms) {
+        if (histogram->name() == name) {
+            return *histogram;
+        }
+    }
+    m_histograms.push_back(std::make_unique<LatencyHistogram>(name, help));
+    return *m_histograms.back();
+}
+
+MetricsSnapshot MetricsRegistry::snapshot() const
+{
+    MetricsSnapshot snapshot;
+    snapshot.timestampMs = QDateTime::currentMSecsSinceEpoch();
+
+    QMutexLocker locker(&m_mutex);
+    for (const auto& counter : m_counters) {
+        snapshot.counters.insert(counter->name(), counter->value());
+    }
+    for (const auto& gauge : m_gauges) {
+        snapshot.gauges.insert(gauge->name(), gauge->value());
+    }
+    for (const auto& histogram : m_histograms) {
+        snapshot.histograms.insert(histogram->name(), histogram->snapshot());
+    }
+    return snapshot;
+}
+
+QByteArray MetricsRegistry::toOpenMetrics() const
+{
+    QByteArray text;
+    QMutexLocker locker(&m_mutex);
+
+    for (const auto& counter : m_counters) {
+        const QByteArray& name = counter->name();
+        text += "# TYPE " + name + " counter\n";
+        text += "# HELP " + name + ' ' + counter->help() + '\n';
+        text += name + "_total " + QByteArray::number(counter->value()) + '\n';
+    }
+
+    for (const auto& gauge : m_gauges) {
+        const QByteArray& name = gauge->name();
+        text += "# TYPE " + name + " gauge\n";
+        text += "# HELP " + name + ' ' + gauge->help() + '\n';
+        text += name + ' ' + QByteArray::number(gauge->value()) + '\n';
+    }
+
+    for (const auto& histogram : m_histograms) {
+        const QByteArray& name = histogram->name();
+        const HistogramSnapshot snapshot = histogram->snapshot();
+        text += "# TYPE " + name + " histogram\n";
+        text += "# UNIT " + name + " seconds\n";
+        text += "# HELP " + name + ' ' + histogram->help() + '\n';
+
+        // Cumulative counts at bounds that coincide with internal bucket edges
+        quint64 cumulative = 0;
+        int bucket = 0;
+        for (int exponent = EXPORT_MIN_EXPONENT; exponent <= EXPORT_MAX_EXPONENT; ++exponent) {
+            const qint64 bound = qint64(1) << exponent;
+            while (bucket < snapshot.buckets.size() && LatencyHistogram::bucketUpperBound(bucket) < bound) {
+                cumulative += snapshot.buckets[bucket++];
+            }
+            text += name + "_bucket{le=\"" + formatSeconds(bound) + "\"} " + QByteArray::number(cumulative) + '\n';
+        }
+        text += name + "_bucket{le=\"+Inf\"} " + QByteArray::number(snapshot.count) + '\n';
+        text += name + "_count " + QByteArray::number(snapshot.count) + '\n';
+        text += name + "_sum " + formatSeconds(snapshot.sum) + '\n';
+    }
+
+    text += "# EOF\n";
+    return text;
+}
+
+LatencyTimer::LatencyTimer(LatencyHistogram& histogram)
+    : m_histogram(histogram)
+    , m_start(steadyMicroseconds())
+{
+}
+
+LatencyTimer::~LatencyTimer()
+{
+    m_histogram.record(steadyMicroseconds() - m_start);
+}
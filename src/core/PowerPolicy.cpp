@@ -0,0 +1,192 @@
+#include "PowerPolicy.h"
+#include <QCoreApplication>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QSettings>
+
+Q_LOGGING_CATEGORY(powerPolicy, "eonplay.powerpolicy")
+
+namespace {
+
+const char* const SETTINGS_GROUP = "Power";
+
+} // namespace
+
+PowerPolicy& PowerPolicy::instance()
+{
+    static PowerPolicy* policy = [] {
+        qRegisterMetaType<PowerStatus>();
+        qRegisterMetaType<PowerPolicy::Profile>();
+        auto* instance = new PowerPolicy();
+        if (QCoreApplication::instance()) {
+            instance->moveToThread(QCoreApplication::instance()->thread());
+        }
+        return instance;
+    }();
+    return *policy;
+}
+
+PowerPolicy::PowerPolicy(QObject* parent)
+    : QObject(parent)
+    , m_thresholds(loadThresholds())
+{
+}
+
+void PowerPolicy::setStatus(const PowerStatus& status)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_status == status) {
+            return;
+        }
+        m_status = status;
+    }
+
+    qCDebug(powerPolicy) << "Power status: on battery" << status.onBattery << "battery" << status.batteryPercent
+                         << "% power saver" << status.powerSaver << "temperature" << status.temperatureC << "C";
+    emit statusChanged(status);
+    update();
+}
+
+PowerStatus PowerPolicy::status() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_status;
+}
+
+PowerPolicy::Profile PowerPolicy::profile() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_profile;
+}
+
+PowerPolicy::Thresholds PowerPolicy::thresholds() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_thresholds;
+}
+
+void PowerPolicy::setThresholds(const Thresholds& thresholds)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_thresholds = thresholds;
+    }
+    saveThresholds(thresholds);
+    update();
+}
+
+QString PowerPolicy::levelName(Level level)
+{
+    switch (level) {
+        case Normal:
+            return "Normal";
+        case Saving:
+            return "Saving";
+        case Critical:
+            return "Critical";
+    }
+    return QString();
+}
+
+void PowerPolicy::update()
+{
+    Profile profile;
+    {
+        QMutexLocker locker(&m_mutex);
+        const Level level = evaluate(m_status, m_thresholds, m_profile.level);
+        profile = profileFor(level, m_thresholds);
+        if (profile.level == m_profile.level && profile.visualizerFpsLimit == m_profile.visualizerFpsLimit
+            && profile.uiRateLimitHz == m_profile.uiRateLimitHz) {
+            return;
+        }
+        m_profile = profile;
+    }
+
+    qCInfo(powerPolicy) << "Power level" << levelName(profile.level);
+    emit profileChanged(profile);
+}
+
+PowerPolicy::Level PowerPolicy::evaluate(const PowerStatus& status, const Thresholds& thresholds, Level current) const
+{
+    if (!thresholds.enabled) {
+        return Normal;
+    }
+
+    // A level already reached is held until the reading is clearly past its threshold
+    auto batteryAtOrBelow = [&status](int percent, bool holding) {
+        return status.onBattery && status.batteryPercent >= 0
+            && status.batteryPercent <= percent + (holding ? BATTERY_HYSTERESIS_PERCENT : 0);
+    };
+    auto temperatureAtOrAbove = [&status](int celsius, bool holding) {
+        return status.temperatureC >= 0
+            && status.temperatureC >= celsius - (holding ? TEMPERATURE_HYSTERESIS_C : 0);
+    };
+
+    const bool holdingCritical = current == Critical;
+    if (batteryAtOrBelow(thresholds.criticalBatteryPercent, holdingCritical)
+        || temperatureAtOrAbove(thresholds.criticalTemperatureC, holdingCritical)) {
+        return Critical;
+    }
+
+    const bool holdingSaving = current != Normal;
+    if (status.powerSaver
+        || (status.onBattery && thresholds.saveOnBattery)
+        || batteryAtOrBelow(thresholds.lowBatteryPercent, holdingSaving)
+        || temperatureAtOrAbove(thresholds.hotTemperatureC, holdingSaving)) {
+        return Saving;
+    }
+
+    return Normal;
+}
+
+PowerPolicy::Profile PowerPolicy::profileFor(Level level, const Thresholds& thresholds)
+{
+    Profile profile;
+    profile.level = level;
+    if (level == Normal) {
+        return profile;
+    }
+
+    profile.forceHardwareDecode = true;
+    profile.expensiveDspEnabled = false;
+    profile.visualizerFpsLimit = level == Critical ? thresholds.criticalVisualizerFps : thresholds.savingVisualizerFps;
+    profile.uiRateLimitHz = level == Critical ? thresholds.criticalUiRateHz : thresholds.savingUiRateHz;
+    return profile;
+}
+
+PowerPolicy::Thresholds PowerPolicy::loadThresholds()
+{
+    const Thresholds defaults;
+    Thresholds thresholds;
+
+    QSettings settings;
+    settings.beginGroup(SETTINGS_GROUP);
+    thresholds.enabled = settings.value("enabled", defaults.enabled).toBool();
+    thresholds.saveOnBattery = settings.value("saveOnBattery", defaults.saveOnBattery).toBool();
+    thresholds.lowBatteryPercent = settings.value("lowBatteryPercent", defaults.lowBatteryPercent).toInt();
+    thresholds.criticalBatteryPercent = settings.value("criticalBatteryPercent", defaults.criticalBatteryPercent).toInt();
+    thresholds.hotTemperatureC = settings.value("hotTemperatureC", defaults.hotTemperatureC).toInt();
+    thresholds.criticalTemperatureC = settings.value("criticalTemperatureC", defaults.criticalTemperatureC).toInt();
+    thresholds.savingVisualizerFps = settings.value("savingVisualizerFps", defaults.savingVisualizerFps).toInt();
+    thresholds.criticalVisualizerFps = settings.value("criticalVisualizerFps", defaults.criticalVisualizerFps).toInt();
+    thresholds.savingUiRateHz = settings.value("savingUiRateHz", defaults.savingUiRateHz).toInt();
+    thresholds.criticalUiRateHz = settings.value("criticalUiRateHz", defaults.criticalUiRateHz).toInt();
+    return thresholds;
+}
+
+void PowerPolicy::saveThresholds(const Thresholds& thresholds)
+{
+    QSettings settings;
+    settings.beginGroup(SETTINGS_GROUP);
+    settings.setValue("enabled", thresholds.enabled);
+    settings.setValue("saveOnBattery", thresholds.saveOnBattery);
+    settings.setValue("lowBatteryPercent", thresholds.lowBatteryPercent);
+    settings.setValue("criticalBatteryPercent", thresholds.criticalBatteryPercent);
+    settings.setValue("hotTemperatureC", thresholds.hotTemperatureC);
+    settings.setValue("criticalTemperatureC", thresholds.criticalTemperatureC);
+    settings.setValue("savingVisualizerFps", thresholds.savingVisualizerFps);
+    settings.setValue("criticalVisualizerFps", thresholds.criticalVisualizerFps);
+    settings.setValue("savingUiRateHz", thresholds.savingUiRateHz);
+    settings.setValue("criticalUiRateHz", thresholds.criticalUiRateHz);
+}
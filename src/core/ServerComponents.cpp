@@ -0,0 +1,147 @@
+#include "ServerComponents.h"
+#include "data/LibraryManager.h"
+#include "network/NetworkDiscoveryManager.h"
+#include "network/VideoCastingManager.h"
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(serverComponents, "eonplay.server")
+
+LibraryComponent::LibraryComponent(const QString& databasePath, bool scanOnStart)
+    : m_databasePath(databasePath)
+    , m_scanOnStart(scanOnStart)
+    , m_initialized(false)
+{
+}
+
+LibraryComponent::~LibraryComponent()
+{
+    shutdown();
+}
+
+bool LibraryComponent::initialize()
+{
+    if (m_initialized) {
+        return true;
+    }
+
+    m_library = std::make_unique<EonPlay::Data::LibraryManager>();
+    if (!m_library->initialize(m_databasePath)) {
+        qCCritical(serverComponents) << "Failed to open the library at" << m_databasePath;
+        m_library.reset();
+        return false;
+    }
+
+    if (m_scanOnStart) {
+        m_library->rescanLibrary();
+    }
+
+    m_initialized = true;
+    return true;
+}
+
+void LibraryComponent::shutdown()
+{
+    if (m_library) {
+        m_library->shutdown();
+        m_library.reset();
+    }
+    m_initialized = false;
+}
+
+NetworkComponent::NetworkComponent(const QList<Share>& shares, const LibraryComponent* library, bool publishUpnp,
+                                   bool serveLibraryApi, const QString& apiToken)
+    : m_shares(shares)
+    , m_library(library)
+    , m_publishUpnp(publishUpnp)
+    , m_serveLibraryApi(serveLibraryApi)
+    , m_apiToken(apiToken)
+    , m_initialized(false)
+{
+}
+
+NetworkComponent::~NetworkComponent()
+{
+    shutdown();
+}
+
+bool NetworkComponent::initialize()
+{
+    if (m_initialized) {
+        return true;
+    }
+
+    m_network = std::make_unique<NetworkDiscoveryManager>();
+    m_network->startDiscovery();
+
+    for (const Share& share : m_shares) {
+        const QString shareId = m_network->createMediaShare(share.first, share.second);
+        if (shareId.isEmpty() || !m_network->startMediaShare(shareId)) {
+            qCWarning(serverComponents) << "Failed to share" << share.second << "as" << share.first;
+            continue;
+        }
+        qCInfo(serverComponents) << "Sharing" << share.second << "as" << share.first;
+    }
+
+    // Registered after the library, so it is open by now
+    EonPlay::Data::LibraryManager* library = m_library ? m_library->library() : nullptr;
+    if (library && m_publishUpnp && !m_network->publishLibrary(library)) {
+        qCWarning(serverComponents) << "Failed to publish the library over UPnP";
+    }
+    if (library && m_serveLibraryApi && !m_network->publishLibraryApi(library, m_apiToken)) {
+        qCWarning(serverComponents) << "Failed to serve the library API";
+    }
+
+    m_initialized = true;
+    return true;
+}
+
+void NetworkComponent::shutdown()
+{
+    if (m_network) {
+        m_network->unpublishLibraryApi();
+        m_network->unpublishLibrary();
+        m_network->stopDiscovery();
+        m_network.reset();
+    }
+    m_initialized = false;
+}
+
+CastingComponent::CastingComponent(int webControlPort)
+    : m_webControlPort(webControlPort)
+    , m_initialized(false)
+{
+}
+
+CastingComponent::~CastingComponent()
+{
+    shutdown();
+}
+
+bool CastingComponent::initialize()
+{
+    if (m_initialized) {
+        return true;
+    }
+
+    m_casting = std::make_unique<VideoCastingManager>();
+    if (!m_casting->initialize()) {
+        // Casting needs the SSDP port; the rest of the server runs without it
+        qCWarning(serverComponents) << "Casting unavailable";
+    }
+
+    if (m_webControlPort >= 0 && !m_casting->startWebControlServer(m_webControlPort)) {
+        qCWarning(serverComponents) << "Failed to start the web control on port" << m_webControlPort;
+    }
+
+    m_initialized = true;
+    return true;
+}
+
+void CastingComponent::shutdown()
+{
+    if (m_casting) {
+        m_casting->shutdown();
+        m_casting.reset();
+    }
+    m_initialized = false;
+}
@@ -0,0 +1,251 @@
+#include "SessionSnapshot.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+
+Q_LOGGING_CATEGORY(sessionSnapshot, "eonplay.session")
+
+namespace {
+
+// Layout shared with the file, in native byte order: the snapshot never
+// leaves the machine, and a foreign one fails the magic check
+struct FileHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 sectionCount;
+    quint32 reserved;
+};
+
+constexpr quint32 MAX_SECTIONS = 64;
+constexpr QDataStream::Version STREAM_VERSION = QDataStream::Qt_6_0;
+
+} // namespace
+
+SessionSnapshot::SessionSnapshot()
+    : m_data(nullptr)
+    , m_size(0)
+{
+}
+
+SessionSnapshot::~SessionSnapshot()
+{
+    close();
+}
+
+QString SessionSnapshot::defaultPath()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath("session.snapshot");
+}
+
+bool SessionSnapshot::open(const QString& filePath)
+{
+    close();
+
+    auto file = std::make_unique<QFile>(filePath);
+    if (!file->open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const qint64 size = file->size();
+    if (size < qint64(sizeof(FileHeader))) {
+        return false;
+    }
+    const uchar* data = file->map(0, size);
+    if (!data) {
+        qCWarning(sessionSnapshot) << "Cannot map" << filePath << file->errorString();
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const qint64 tableEnd = qint64(sizeof(FileHeader)) + qint64(header.sectionCount) * qint64(sizeof(SectionEntry));
+    if (header.magic != MAGIC || header.version != VERSION || header.sectionCount > MAX_SECTIONS || tableEnd > size) {
+        qCInfo(sessionSnapshot) << "Ignoring snapshot" << filePath << "of another version";
+        return false;
+    }
+
+    QList<SectionEntry> sections;
+    sections.reserve(int(header.sectionCount));
+    for (quint32 i = 0; i < header.sectionCount; ++i) {
+        SectionEntry entry;
+        std::memcpy(&entry, data + sizeof(FileHeader) + i * sizeof(SectionEntry), sizeof(entry));
+        if (entry.offset < quint64(tableEnd) || entry.length > quint64(size) || entry.offset > quint64(size) - entry.length) {
+            qCWarning(sessionSnapshot) << "Snapshot" << filePath << "is damaged";
+            return false;
+        }
+        sections.append(entry);
+    }
+
+    m_file = std::move(file);
+    m_data = data;
+    m_size = size;
+    m_sections = sections;
+    return true;
+}
+
+void SessionSnapshot::close()
+{
+    if (m_file) {
+        m_file->unmap(const_cast<uchar*>(m_data));
+        m_file.reset();
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_sections.clear();
+}
+
+SessionSnapshot::Layout SessionSnapshot::layout() const
+{
+    Layout layout;
+    QDataStream stream(section(LayoutSection));
+    stream.setVersion(STREAM_VERSION);
+    stream >> layout.geometry >> layout.windowState >> layout.mainSplitter >> layout.sidePanels >> layout.visiblePanels;
+    return stream.status() == QDataStream::Ok ? layout : Layout();
+}
+
+SessionSnapshot::Playback SessionSnapshot::playback() const
+{
+    Playback playback;
+    QDataStream stream(section(PlaybackSection));
+    stream.setVersion(STREAM_VERSION);
+    stream >> playback.filePath >> playback.position >> playback.duration;
+    return stream.status() == QDataStream::Ok ? playback : Playback();
+}
+
+SessionSnapshot::Queue SessionSnapshot::queue() const
+{
+    Queue queue;
+    qint32 currentIndex = -1;
+    QDataStream stream(section(QueueSection));
+    stream.setVersion(STREAM_VERSION);
+    stream >> queue.filePaths >> currentIndex;
+    queue.currentIndex = currentIndex;
+    return stream.status() == QDataStream::Ok ? queue : Queue();
+}
+
+SessionSnapshot::LibraryPage SessionSnapshot::libraryPage() const
+{
+    qint32 viewMode = 0;
+    qint32 sortBy = 0;
+    qint32 filterBy = 0;
+    qint32 firstRow = -1;
+    QString searchText;
+    QDataStream stream(section(LibraryPageSection));
+    stream.setVersion(STREAM_VERSION);
+    stream >> viewMode >> sortBy >> filterBy >> searchText >> firstRow;
+    if (stream.status() != QDataStream::Ok) {
+        return LibraryPage();
+    }
+
+    LibraryPage page;
+    page.viewMode = viewMode;
+    page.sortBy = sortBy;
+    page.filterBy = filterBy;
+    page.searchText = searchText;
+    page.firstRow = firstRow;
+    return page;
+}
+
+QStringList SessionSnapshot::warmCacheKeys() const
+{
+    QStringList keys;
+    QDataStream stream(section(WarmCacheSection));
+    stream.setVersion(STREAM_VERSION);
+    stream >> keys;
+    return stream.status() == QDataStream::Ok ? keys : QStringList();
+}
+
+template <typename Write>
+void SessionSnapshot::setSection(SectionId id, Write&& write)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(STREAM_VERSION);
+    write(stream);
+    m_pending.insert(id, data);
+}
+
+void SessionSnapshot::setLayout(const Layout& layout)
+{
+    setSection(LayoutSection, [&layout](QDataStream& stream) {
+        stream << layout.geometry << layout.windowState << layout.mainSplitter << layout.sidePanels
+               << layout.visiblePanels;
+    });
+}
+
+void SessionSnapshot::setPlayback(const Playback& playback)
+{
+    setSection(PlaybackSection, [&playback](QDataStream& stream) {
+        stream << playback.filePath << playback.position << playback.duration;
+    });
+}
+
+void SessionSnapshot::setQueue(const Queue& queue)
+{
+    setSection(QueueSection, [&queue](QDataStream& stream) {
+        stream << queue.filePaths << qint32(queue.currentIndex);
+    });
+}
+
+void SessionSnapshot::setLibraryPage(const LibraryPage& page)
+{
+    setSection(LibraryPageSection, [&page](QDataStream& stream) {
+        stream << qint32(page.viewMode) << qint32(page.sortBy) << qint32(page.filterBy) << page.searchText
+               << qint32(page.firstRow);
+    });
+}
+
+void SessionSnapshot::setWarmCacheKeys(const QStringList& keys)
+{
+    setSection(WarmCacheSection, [&keys](QDataStream& stream) {
+        stream << keys;
+    });
+}
+
+bool SessionSnapshot::save(const QString& filePath) const
+{
+    // Sections follow the table in id order
+    QByteArray table(int(sizeof(FileHeader) + m_pending.size() * sizeof(SectionEntry)), Qt::Uninitialized);
+    FileHeader header{MAGIC, VERSION, quint32(m_pending.size()), 0};
+    std::memcpy(table.data(), &header, sizeof(header));
+
+    quint64 offset = quint64(table.size());
+    int index = 0;
+    for (auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it, ++index) {
+        SectionEntry entry{it.key(), 0, offset, quint64(it.value().size())};
+        std::memcpy(table.data() + sizeof(FileHeader) + index * sizeof(SectionEntry), &entry, sizeof(entry));
+        offset += entry.length;
+    }
+
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(sessionSnapshot) << "Cannot write" << filePath << file.errorString();
+        return false;
+    }
+    file.write(table);
+    for (const QByteArray& data : m_pending) {
+        file.write(data);
+    }
+    if (!file.commit()) {
+        qCWarning(sessionSnapshot) << "Cannot write" << filePath << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QByteArray SessionSnapshot::section(SectionId id) const
+{
+    for (const SectionEntry& entry : m_sections) {
+        if (entry.id == id) {
+            // Read in place; valid until close()
+            return QByteArray::fromRawData(reinterpret_cast<const char*>(m_data + entry.offset), qsizetype(entry.length));
+        }
+    }
+    return QByteArray();
+}
@@ -0,0 +1,166 @@
+#include "SingleInstance.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QLoggingCategory>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QUrl>
+
+Q_LOGGING_CATEGORY(singleInstance, "eonplay.singleinstance")
+
+namespace {
+
+const quint32 REQUEST_MAGIC = 0x454f4e31; // "EON1"
+const char REPLY_ACCEPTED = 'A';
+const QDataStream::Version STREAM_VERSION = QDataStream::Qt_6_0;
+
+} // namespace
+
+SingleInstance::SingleInstance(QObject* parent)
+    : QObject(parent)
+    , m_server(nullptr)
+{
+}
+
+bool SingleInstance::forwardToRunningInstance(const QStringList& files)
+{
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    if (!socket.waitForConnected(CONNECT_TIMEOUT_MS)) {
+        return false;
+    }
+
+    QByteArray request;
+    QDataStream stream(&request, QIODevice::WriteOnly);
+    stream.setVersion(STREAM_VERSION);
+    stream << REQUEST_MAGIC << files;
+    socket.write(request);
+
+    // Only hand over once the running instance confirms; otherwise start as usual
+    char reply = 0;
+    if (!socket.waitForBytesWritten(REPLY_TIMEOUT_MS) || !socket.waitForReadyRead(REPLY_TIMEOUT_MS)
+        || !socket.getChar(&reply) || reply != REPLY_ACCEPTED) {
+        qCWarning(singleInstance) << "Running instance did not answer, starting a new one";
+        return false;
+    }
+
+    socket.disconnectFromServer();
+    qCInfo(singleInstance) << "Handed" << files.size() << "files to the running instance";
+    return true;
+}
+
+bool SingleInstance::listen()
+{
+    if (m_server) {
+        return m_server->isListening();
+    }
+
+    m_server = new QLocalServer(this);
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection, this, &SingleInstance::onNewConnection);
+
+    const QString name = serverName();
+    if (!m_server->listen(name) && m_server->serverError() == QAbstractSocket::AddressInUseError) {
+        // Nobody answered on it, so it was left behind by a crashed instance
+        QLocalServer::removeServer(name);
+        m_server->listen(name);
+    }
+
+    if (!m_server->isListening()) {
+        qCWarning(singleInstance) << "Cannot listen for other launches:" << m_server->errorString();
+        return false;
+    }
+
+    qCDebug(singleInstance) << "Listening on" << m_server->fullServerName();
+    return true;
+}
+
+bool SingleInstance::isListening() const
+{
+    return m_server && m_server->isListening();
+}
+
+bool SingleInstance::isNewInstanceRequested(const QStringList& arguments)
+{
+    return arguments.contains(QStringLiteral("--new-instance"));
+}
+
+QStringList SingleInstance::mediaArguments(const QStringList& arguments)
+{
+    QStringList files;
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString& argument = arguments.at(i);
+        if (argument.startsWith('-')) {
+            continue;
+        }
+
+        // A one-letter scheme is a Windows drive, not a URL
+        const QUrl url(argument);
+        if (url.isLocalFile()) {
+            files.append(url.toLocalFile());
+        } else if (url.scheme().size() > 1 && !QFileInfo::exists(argument)) {
+            files.append(url.toString());
+        } else {
+            files.append(QFileInfo(argument).absoluteFilePath());
+        }
+    }
+    return files;
+}
+
+QString SingleInstance::serverName()
+{
+    const QByteArray configPath = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation).toUtf8();
+    const QByteArray digest = QCryptographicHash::hash(configPath, QCryptographicHash::Sha1).toHex().left(16);
+    return QStringLiteral("eonplay-%1").arg(QString::fromLatin1(digest));
+}
+
+void SingleInstance::onNewConnection()
+{
+    while (QLocalSocket* socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            readRequest(socket);
+        });
+
+        // A client that never completes its request is dropped
+        QTimer::singleShot(REPLY_TIMEOUT_MS, socket, [socket]() {
+            socket->abort();
+            socket->deleteLater();
+        });
+
+        if (socket->bytesAvailable() > 0) {
+            readRequest(socket);
+        }
+    }
+}
+
+void SingleInstance::readRequest(QLocalSocket* socket)
+{
+    QDataStream stream(socket);
+    stream.setVersion(STREAM_VERSION);
+    stream.startTransaction();
+
+    quint32 magic = 0;
+    stream >> magic;
+    if (stream.status() == QDataStream::Ok && magic != REQUEST_MAGIC) {
+        qCWarning(singleInstance) << "Ignoring a request that is not from EonPlay";
+        socket->abort();
+        return;
+    }
+
+    QStringList files;
+    stream >> files;
+    if (!stream.commitTransaction()) {
+        // Wait for the rest of the request
+        return;
+    }
+
+    socket->putChar(REPLY_ACCEPTED);
+    socket->flush();
+
+    qCInfo(singleInstance) << "Another launch handed over" << files.size() << "files";
+    emit launched(files);
+}
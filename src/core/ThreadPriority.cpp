@@ -0,0 +1,328 @@
+#include "ThreadPriority.h"
+#include "CpuTopology.h"
+#include <QLoggingCategory>
+#include <QProcess>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <avrt.h>
+#elif defined(Q_OS_MACOS)
+#include <pthread/qos.h>
+#include <sys/resource.h>
+#elif defined(Q_OS_LINUX)
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(QT_DBUS_LIB)
+#include <QDBusConnection>
+#include <QDBusInterface>
+#include <QDBusMessage>
+#endif
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+Q_LOGGING_CATEGORY(threadPriority, "eonplay.threadpriority")
+
+namespace {
+
+using Role = ThreadPriority::Role;
+
+thread_local Role requestedRole = Role::Normal;
+thread_local Role currentRole = Role::Normal;
+
+CpuTopology::Placement placementFor(Role role)
+{
+    switch (role) {
+    case Role::Audio:
+    case Role::Playback:
+        return CpuTopology::Placement::Performance;
+    case Role::Background:
+        return CpuTopology::Placement::Efficiency;
+    case Role::Normal:
+        break;
+    }
+    return CpuTopology::Placement::Any;
+}
+
+#if defined(Q_OS_WIN)
+// avrt.dll is loaded on demand so no target has to link it
+struct AvrtFunctions {
+    HANDLE (WINAPI* setCharacteristics)(LPCWSTR, LPDWORD) = nullptr;
+    BOOL (WINAPI* setPriority)(HANDLE, AVRT_PRIORITY) = nullptr;
+    BOOL (WINAPI* revert)(HANDLE) = nullptr;
+};
+
+const AvrtFunctions& avrt()
+{
+    static const AvrtFunctions functions = [] {
+        AvrtFunctions loaded;
+        if (HMODULE module = LoadLibraryW(L"avrt.dll")) {
+            loaded.setCharacteristics = reinterpret_cast<decltype(loaded.setCharacteristics)>(
+                GetProcAddress(module, "AvSetMmThreadCharacteristicsW"));
+            loaded.setPriority = reinterpret_cast<decltype(loaded.setPriority)>(
+                GetProcAddress(module, "AvSetMmThreadPriority"));
+            loaded.revert = reinterpret_cast<decltype(loaded.revert)>(
+                GetProcAddress(module, "AvRevertMmThreadCharacteristics"));
+        }
+        return loaded;
+    }();
+    return functions;
+}
+
+thread_local HANDLE mmcssTask = nullptr;
+
+void leaveMmcssTask()
+{
+    if (mmcssTask && avrt().revert) {
+        avrt().revert(mmcssTask);
+    }
+    mmcssTask = nullptr;
+}
+
+bool joinMmcssTask(const wchar_t* task, AVRT_PRIORITY priority)
+{
+    leaveMmcssTask();
+    if (!avrt().setCharacteristics) {
+        return false;
+    }
+
+    DWORD taskIndex = 0;
+    mmcssTask = avrt().setCharacteristics(task, &taskIndex);
+    if (!mmcssTask) {
+        return false;
+    }
+    if (avrt().setPriority) {
+        avrt().setPriority(mmcssTask, priority);
+    }
+    return true;
+}
+
+bool applyRole(Role role)
+{
+    switch (role) {
+    case Role::Audio:
+        return joinMmcssTask(L"Pro Audio", AVRT_PRIORITY_HIGH);
+    case Role::Playback:
+        return joinMmcssTask(L"Playback", AVRT_PRIORITY_NORMAL);
+    case Role::Background:
+        leaveMmcssTask();
+        return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+    case Role::Normal:
+        leaveMmcssTask();
+        return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+    }
+    return false;
+}
+
+#elif defined(Q_OS_MACOS)
+bool applyRole(Role role)
+{
+    qos_class_t qosClass = QOS_CLASS_DEFAULT;
+    switch (role) {
+    case Role::Audio:
+        qosClass = QOS_CLASS_USER_INTERACTIVE;
+        break;
+    case Role::Playback:
+        qosClass = QOS_CLASS_USER_INITIATED;
+        break;
+    case Role::Background:
+        qosClass = QOS_CLASS_UTILITY;
+        break;
+    case Role::Normal:
+        break;
+    }
+    return pthread_set_qos_class_self_np(qosClass, 0) == 0;
+}
+
+#elif defined(Q_OS_LINUX)
+#ifndef SCHED_RESET_ON_FORK
+#define SCHED_RESET_ON_FORK 0x40000000
+#endif
+
+// rtkit refuses processes whose real-time threads may run longer than this without blocking
+constexpr rlim_t RTKIT_RTTIME_LIMIT_US = 200000;
+
+// With pid 0 both calls act on the calling thread, not the whole process
+bool setPolicy(int policy, int priority)
+{
+    sched_param param = {};
+    param.sched_priority = priority;
+    return sched_setscheduler(0, policy | SCHED_RESET_ON_FORK, &param) == 0;
+}
+
+bool setNice(int nice)
+{
+    return setpriority(PRIO_PROCESS, 0, nice) == 0;
+}
+
+#if defined(QT_DBUS_LIB)
+pid_t currentThreadId()
+{
+    return static_cast<pid_t>(syscall(SYS_gettid));
+}
+
+bool callRtkit(const QString& method, const QVariant& value)
+{
+    QDBusInterface rtkit(QStringLiteral("org.freedesktop.RealtimeKit1"), QStringLiteral("/org/freedesktop/RealtimeKit1"),
+                         QStringLiteral("org.freedesktop.RealtimeKit1"), QDBusConnection::systemBus());
+    if (!rtkit.isValid()) {
+        return false;
+    }
+
+    const QDBusMessage reply = rtkit.call(method, QVariant::fromValue(static_cast<quint64>(currentThreadId())), value);
+    if (reply.type() == QDBusMessage::ErrorMessage) {
+        qCDebug(threadPriority) << "rtkit refused" << method << reply.errorMessage();
+        return false;
+    }
+    return true;
+}
+#endif
+
+bool makeRealtime()
+{
+    if (setPolicy(SCHED_FIFO, ThreadPriority::AUDIO_REALTIME_PRIORITY)) {
+        return true;
+    }
+
+#if defined(QT_DBUS_LIB)
+    rlimit limit;
+    if (getrlimit(RLIMIT_RTTIME, &limit) == 0
+        && (limit.rlim_max == RLIM_INFINITY || limit.rlim_max > RTKIT_RTTIME_LIMIT_US)) {
+        limit.rlim_cur = RTKIT_RTTIME_LIMIT_US;
+        limit.rlim_max = RTKIT_RTTIME_LIMIT_US;
+        setrlimit(RLIMIT_RTTIME, &limit);
+    }
+    return callRtkit(QStringLiteral("MakeThreadRealtime"),
+                     QVariant::fromValue(static_cast<quint32>(ThreadPriority::AUDIO_REALTIME_PRIORITY)));
+#else
+    return false;
+#endif
+}
+
+bool applyRole(Role role)
+{
+    if (role == Role::Audio) {
+        return makeRealtime();
+    }
+
+    // Leaving SCHED_FIFO is always allowed
+    if (currentRole == Role::Audio) {
+        setPolicy(SCHED_OTHER, 0);
+    }
+
+    switch (role) {
+    case Role::Playback:
+        if (setNice(ThreadPriority::PLAYBACK_NICE)) {
+            return true;
+        }
+#if defined(QT_DBUS_LIB)
+        return callRtkit(QStringLiteral("MakeThreadHighPriority"),
+                         QVariant::fromValue(static_cast<qint32>(ThreadPriority::PLAYBACK_NICE)));
+#else
+        return false;
+#endif
+    case Role::Background:
+        return setNice(ThreadPriority::BACKGROUND_NICE);
+    case Role::Normal:
+        // Unprivileged threads may not lower their nice level again
+        return setNice(0);
+    case Role::Audio:
+        break;
+    }
+    return false;
+}
+
+#else
+// Elsewhere nice levels are per process
+bool applyRole(Role role)
+{
+    return role == Role::Normal;
+}
+#endif
+
+} // namespace
+
+bool ThreadPriority::setCurrentThreadRole(Role role)
+{
+    if (role == requestedRole) {
+        return role == currentRole;
+    }
+    requestedRole = role;
+
+    // Placement does not depend on the OS granting the priority
+    CpuTopology::instance().placeCurrentThread(placementFor(role));
+
+    if (!applyRole(role)) {
+        qCDebug(threadPriority) << "Could not schedule thread for" << roleName(role)
+                                << "work, keeping" << roleName(currentRole);
+        return false;
+    }
+
+    currentRole = role;
+    qCDebug(threadPriority) << "Thread scheduled for" << roleName(role) << "work";
+    return true;
+}
+
+ThreadPriority::Role ThreadPriority::currentThreadRole()
+{
+    return currentRole;
+}
+
+void ThreadPriority::setBackgroundProcess(QProcess* process)
+{
+    if (!process) {
+        return;
+    }
+
+    const CpuTopology& topology = CpuTopology::instance();
+
+#if defined(Q_OS_WIN)
+    process->setCreateProcessArgumentsModifier([](QProcess::CreateProcessArguments* arguments) {
+        arguments->flags |= BELOW_NORMAL_PRIORITY_CLASS;
+    });
+    if (topology.isHybrid()) {
+        QObject::connect(process, &QProcess::started, process, [process]() {
+            CpuTopology::instance().placeProcess(process->processId(), CpuTopology::Placement::Efficiency);
+        });
+    }
+#elif defined(Q_OS_LINUX)
+    // Built here: between fork and exec nothing may allocate
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int cpu : topology.efficiencyCpus()) {
+        CPU_SET(cpu, &mask);
+    }
+    const bool pin = topology.isHybrid();
+    process->setChildProcessModifier([mask, pin]() {
+        setpriority(PRIO_PROCESS, 0, BACKGROUND_NICE);
+        if (pin) {
+            sched_setaffinity(0, sizeof(mask), &mask);
+        }
+    });
+#elif defined(Q_OS_UNIX)
+    Q_UNUSED(topology)
+    process->setChildProcessModifier([]() {
+        // Between fork and exec, so nothing but the system call
+        setpriority(PRIO_PROCESS, 0, BACKGROUND_NICE);
+    });
+#else
+    Q_UNUSED(topology)
+#endif
+}
+
+const char* ThreadPriority::roleName(Role role)
+{
+    switch (role) {
+    case Role::Normal:
+        return "normal";
+    case Role::Audio:
+        return "audio";
+    case Role::Playback:
+        return "playback";
+    case Role::Background:
+        return "background";
+    }
+    return "unknown";
+}
@@ -0,0 +1,161 @@
+#include "TraceLog.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(traceLog, "eonplay.trace")
+
+TraceLog& TraceLog::instance()
+{
+    static TraceLog instance;
+    return instance;
+}
+
+TraceLog::TraceLog()
+{
+    m_clock.start();
+
+    const QString filePath = qEnvironmentVariable("EONPLAY_TRACE_FILE");
+    if (!filePath.isEmpty()) {
+        setOutputFile(filePath);
+    }
+}
+
+void TraceLog::setOutputFile(const QString& filePath)
+{
+    QMutexLocker locker(&m_mutex);
+    m_outputFile = filePath;
+    m_enabled.store(!filePath.isEmpty(), std::memory_order_relaxed);
+}
+
+qint64 TraceLog::now() const
+{
+    return m_clock.nsecsElapsed() / 1000;
+}
+
+int TraceLog::currentThreadId()
+{
+    // Small sequential ids read better in trace viewers than native handles
+    static std::atomic<int> nextThreadId{1};
+    thread_local const int threadId = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+    return threadId;
+}
+
+void TraceLog::addComplete(const QByteArray& name, const char* category, qint64 startUs, qint64 durationUs)
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    const TraceEvent event{name, category, 'X', startUs, durationUs, currentThreadId()};
+
+    QMutexLocker locker(&m_mutex);
+    m_events.append(event);
+}
+
+void TraceLog::mark(const QByteArray& name, const char* category)
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    const TraceEvent event{name, category, 'i', now(), 0, currentThreadId()};
+
+    QMutexLocker locker(&m_mutex);
+    m_events.append(event);
+    if (!m_marks.contains(name)) {
+        m_marks.insert(name, event.timestamp);
+    }
+}
+
+qint64 TraceLog::markTime(const QByteArray& name) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_marks.value(name, -1);
+}
+
+bool TraceLog::flush()
+{
+    if (!isEnabled()) {
+        return false;
+    }
+
+    QList<TraceEvent> events;
+    QString filePath;
+    {
+        QMutexLocker locker(&m_mutex);
+        events = m_events;
+        filePath = m_outputFile;
+    }
+
+    const qint64 processId = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+    for (const TraceEvent& event : std::as_const(events)) {
+        QJsonObject object;
+        object["name"] = QString::fromUtf8(event.name);
+        object["cat"] = QString::fromLatin1(event.category);
+        object["ph"] = QString(QLatin1Char(event.phase));
+        object["ts"] = event.timestamp;
+        object["pid"] = processId;
+        object["tid"] = event.threadId;
+        if (event.phase == 'X') {
+            object["dur"] = event.duration;
+        } else {
+            object["s"] = "g";      // Instant events span every thread
+        }
+        traceEvents.append(object);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(traceLog) << "Cannot write trace file:" << filePath;
+        return false;
+    }
+
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    qCDebug(traceLog) << "Wrote" << events.size() << "trace events to" << filePath;
+    return true;
+}
+
+TraceScope::TraceScope(const char* name, const char* category)
+    : m_category(category)
+{
+    TraceLog& log = TraceLog::instance();
+    if (log.isEnabled()) {
+        m_name = name;
+        m_start = log.now();
+    }
+}
+
+TraceScope::TraceScope(const QString& name, const char* category)
+    : m_category(category)
+{
+    TraceLog& log = TraceLog::instance();
+    if (log.isEnabled()) {
+        m_name = name.toUtf8();
+        m_start = log.now();
+    }
+}
+
+TraceScope::~TraceScope()
+{
+    end();
+}
+
+void TraceScope::end()
+{
+    if (m_start < 0) {
+        return;
+    }
+
+    TraceLog& log = TraceLog::instance();
+    log.addComplete(m_name, m_category, m_start, log.now() - m_start);
+    m_start = -1;
+}
@@ -0,0 +1,282 @@
+#include "data/AcousticFingerprint.h"
+#include <QDataStream>
+#include <QIODevice>
+#include <QLoggingCategory>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QtEndian>
+
+Q_LOGGING_CATEGORY(acousticFingerprint, "eonplay.data.acoustic")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+constexpr quint8 FORMAT_VERSION = 1;
+constexpr int START_TIMEOUT_MS = 5000;
+constexpr int POLL_INTERVAL_MS = 250;
+constexpr int MAX_NORMAL_BITS = 7;      // Chromaprint's compressed form: 3-bit values, 5-bit overflow
+
+struct Decoder {
+    QString fpcalcPath;     // Preferred: decodes and fingerprints in one process
+    QString ffmpegPath;     // Only if built with the chromaprint muxer
+};
+
+const Decoder& decoder()
+{
+    static const Decoder found = [] {
+        Decoder result;
+        result.fpcalcPath = QStandardPaths::findExecutable(QStringLiteral("fpcalc"));
+        if (!result.fpcalcPath.isEmpty()) {
+            return result;
+        }
+
+        const QString ffmpegPath = QStandardPaths::findExecutable(QStringLiteral("ffmpeg"));
+        if (ffmpegPath.isEmpty()) {
+            return result;
+        }
+        QProcess process;
+        process.start(ffmpegPath, {"-hide_banner", "-muxers"});
+        if (process.waitForFinished(START_TIMEOUT_MS) &&
+            process.readAllStandardOutput().contains(" chromaprint ")) {
+            result.ffmpegPath = ffmpegPath;
+        }
+        return result;
+    }();
+    return found;
+}
+
+bool runDecoder(QProcess& process, const std::atomic<bool>* cancelled)
+{
+    if (!process.waitForStarted(START_TIMEOUT_MS)) {
+        qCWarning(acousticFingerprint) << "Failed to start decoder:" << process.errorString();
+        return false;
+    }
+
+    // Waits in slices so a cancel does not sit out a long decode
+    for (int waited = 0; !process.waitForFinished(POLL_INTERVAL_MS); waited += POLL_INTERVAL_MS) {
+        if ((cancelled && *cancelled) || waited >= AcousticFingerprint::DECODE_TIMEOUT_MS ||
+            process.state() == QProcess::NotRunning) {
+            process.kill();
+            process.waitForFinished();
+            return false;
+        }
+    }
+    return process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+}
+
+// Values packed least significant bit first, as Chromaprint's PackInt3Array/PackInt5Array do
+void packBits(const QVector<quint8>& values, int width, QByteArray* out)
+{
+    quint32 buffer = 0;
+    int bits = 0;
+    for (quint8 value : values) {
+        buffer |= quint32(value) << bits;
+        bits += width;
+        while (bits >= 8) {
+            out->append(char(buffer & 0xFF));
+            buffer >>= 8;
+            bits -= 8;
+        }
+    }
+    if (bits > 0) {
+        out->append(char(buffer & 0xFF));
+    }
+}
+} // namespace
+
+bool AcousticFingerprint::isAvailable()
+{
+    const Decoder& found = decoder();
+    return !found.fpcalcPath.isEmpty() || !found.ffmpegPath.isEmpty();
+}
+
+AcousticFingerprint AcousticFingerprint::compute(const QString& filePath, qint64 durationMs,
+                                                 const std::atomic<bool>* cancelled)
+{
+    AcousticFingerprint fingerprint;
+    fingerprint.m_duration = durationMs;
+    const Decoder& found = decoder();
+
+    QProcess process;
+    if (!found.fpcalcPath.isEmpty()) {
+        process.start(found.fpcalcPath, {"-raw", "-length", QString::number(LENGTH_SECONDS), filePath});
+        if (!runDecoder(process, cancelled)) {
+            return AcousticFingerprint();
+        }
+
+        // DURATION=<whole seconds>, FINGERPRINT=<comma separated values>
+        const QList<QByteArray> lines = process.readAllStandardOutput().split('\n');
+        for (const QByteArray& line : lines) {
+            if (line.startsWith("DURATION=")) {
+                const qint64 seconds = line.mid(9).trimmed().toLongLong();
+                if (seconds > 0) {
+                    fingerprint.m_duration = seconds * 1000;
+                }
+            } else if (line.startsWith("FINGERPRINT=")) {
+                const QList<QByteArray> values = line.mid(12).trimmed().split(',');
+                fingerprint.m_values.reserve(values.size());
+                for (const QByteArray& value : values) {
+                    bool ok = false;
+                    const quint32 number = static_cast<quint32>(value.toLongLong(&ok));
+                    if (ok) {
+                        fingerprint.m_values.append(number);
+                    }
+                }
+            }
+        }
+    } else if (!found.ffmpegPath.isEmpty()) {
+        // Input -t stops the decode, not just the output, after LENGTH_SECONDS
+        process.start(found.ffmpegPath, {
+            "-hide_banner", "-nostats", "-loglevel", "error",
+            "-t", QString::number(LENGTH_SECONDS),
+            "-i", filePath,
+            "-vn", "-sn", "-dn",
+            "-ac", "1", "-ar", "11025",
+            "-f", "chromaprint", "-fp_format", "raw", "-algorithm", QString::number(ALGORITHM),
+            "pipe:1"
+        });
+        if (!runDecoder(process, cancelled)) {
+            return AcousticFingerprint();
+        }
+
+        const QByteArray raw = process.readAllStandardOutput();
+        const int count = int(raw.size() / int(sizeof(quint32)));
+        fingerprint.m_values.resize(count);
+        for (int i = 0; i < count; ++i) {
+            fingerprint.m_values[i] = qFromLittleEndian<quint32>(raw.constData() + i * sizeof(quint32));
+        }
+    }
+
+    if (fingerprint.m_values.isEmpty()) {
+        qCDebug(acousticFingerprint) << "No fingerprint for" << filePath;
+        return AcousticFingerprint();
+    }
+    return fingerprint;
+}
+
+QHash<quint32, int> AcousticFingerprint::subHashes() const
+{
+    QHash<quint32, int> hashes;
+    hashes.reserve(m_values.size());
+    for (int i = 0; i < m_values.size(); ++i) {
+        const quint32 hash = subHash(m_values[i]);
+        if (!hashes.contains(hash)) {
+            hashes.insert(hash, i);
+        }
+    }
+    return hashes;
+}
+
+double AcousticFingerprint::bitError(const AcousticFingerprint& other) const
+{
+    const QHash<quint32, int> positions = subHashes();
+
+    // Offset of the other fingerprint against this one, by vote of shared sub-hashes
+    QHash<int, int> votes;
+    for (int j = 0; j < other.m_values.size(); ++j) {
+        const auto it = positions.constFind(subHash(other.m_values[j]));
+        if (it != positions.constEnd()) {
+            ++votes[j - it.value()];
+        }
+    }
+
+    int offset = 0;
+    int bestVotes = 0;
+    for (auto it = votes.constBegin(); it != votes.constEnd(); ++it) {
+        if (it.value() > bestVotes) {
+            bestVotes = it.value();
+            offset = it.key();
+        }
+    }
+    if (bestVotes == 0) {
+        return 1.0;
+    }
+
+    const int first = qMax(0, -offset);
+    const int last = qMin(m_values.size(), other.m_values.size() - offset);
+    const int overlap = last - first;
+    if (overlap < MIN_OVERLAP) {
+        return 1.0;
+    }
+
+    quint64 bits = 0;
+    for (int i = first; i < last; ++i) {
+        bits += qPopulationCount(m_values[i] ^ other.m_values[i + offset]);
+    }
+    return double(bits) / (32.0 * overlap);
+}
+
+QString AcousticFingerprint::compressed() const
+{
+    // Positions of the bits that changed from the previous value, as gaps
+    // from the last set bit, each value ended by a 0
+    QVector<quint8> gaps;
+    gaps.reserve(m_values.size() * 8);
+    quint32 previous = 0;
+    for (quint32 value : m_values) {
+        quint32 changed = value ^ previous;
+        previous = value;
+        int bit = 1;
+        int lastBit = 0;
+        while (changed != 0) {
+            if (changed & 1) {
+                gaps.append(quint8(bit - lastBit));
+                lastBit = bit;
+            }
+            changed >>= 1;
+            ++bit;
+        }
+        gaps.append(0);
+    }
+
+    QVector<quint8> normal;
+    QVector<quint8> exceptional;
+    normal.reserve(gaps.size());
+    for (quint8 gap : gaps) {
+        normal.append(quint8(qMin(int(gap), MAX_NORMAL_BITS)));
+        if (gap >= MAX_NORMAL_BITS) {
+            exceptional.append(quint8(gap - MAX_NORMAL_BITS));
+        }
+    }
+
+    const int count = m_values.size();
+    QByteArray data;
+    data.append(char(ALGORITHM));
+    data.append(char((count >> 16) & 0xFF));
+    data.append(char((count >> 8) & 0xFF));
+    data.append(char(count & 0xFF));
+    packBits(normal, 3, &data);
+    packBits(exceptional, 5, &data);
+
+    return QString::fromLatin1(data.toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+}
+
+QByteArray AcousticFingerprint::serialize() const
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << FORMAT_VERSION << m_duration << m_values;
+    return data;
+}
+
+AcousticFingerprint AcousticFingerprint::deserialize(const QByteArray& data)
+{
+    AcousticFingerprint fingerprint;
+    if (data.isEmpty()) {
+        return fingerprint;
+    }
+
+    QDataStream in(data);
+    quint8 version = 0;
+    in >> version;
+    if (version != FORMAT_VERSION) {
+        return AcousticFingerprint();
+    }
+    in >> fingerprint.m_duration >> fingerprint.m_values;
+    return in.status() == QDataStream::Ok ? fingerprint : AcousticFingerprint();
+}
+
+} // namespace Data
+} // namespace EonPlay
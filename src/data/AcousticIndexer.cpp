@@ -0,0 +1,384 @@
+#include "data/AcousticIndexer.h"
+#include "data/AcousticFingerprint.h"
+#include "data/DatabaseManager.h"
+#include "data/MediaFile.h"
+#include "network/NetworkService.h"
+#include "ThreadPriority.h"
+#include "CpuTopology.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QMetaObject>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QThread>
+#include <QUrl>
+#include <QUrlQuery>
+
+Q_LOGGING_CATEGORY(acousticIndexer, "eonplay.data.acousticindex")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+const char* const ACOUSTID_LOOKUP_URL = "https://api.acoustid.org/v2/lookup";
+
+int findRoot(QHash<int, int>& parents, int id)
+{
+    int root = parents.value(id, id);
+    while (root != parents.value(root, root)) {
+        root = parents.value(root, root);
+    }
+    parents.insert(id, root);
+    return root;
+}
+} // namespace
+
+AcousticIndexer::AcousticIndexer(DatabaseManager* dbManager, QObject* parent)
+    : QObject(parent)
+    , m_dbManager(dbManager)
+    , m_pool(new QThreadPool(this))
+    , m_writerTimer(new QTimer(this))
+    , m_inFlight(0)
+    , m_totalFiles(0)
+    , m_fingerprintedFiles(0)
+    , m_failedFiles(0)
+    , m_cancelled(false)
+    , m_lookupTimer(new QTimer(this))
+{
+    // Decoding is CPU bound, like loudness analysis, and gives way the same
+    const CpuTopology& topology = CpuTopology::instance();
+    m_pool->setMaxThreadCount(topology.isHybrid() ? topology.backgroundThreadCount()
+                                                  : qMax(1, QThread::idealThreadCount() - 1));
+    m_pool->setThreadPriority(QThread::LowPriority);
+
+    m_writerTimer->setSingleShot(true);
+    m_writerTimer->setInterval(WRITE_INTERVAL_MS);
+    connect(m_writerTimer, &QTimer::timeout, this, &AcousticIndexer::writePendingResults);
+
+    m_lookupTimer->setInterval(LOOKUP_INTERVAL_MS);
+    connect(m_lookupTimer, &QTimer::timeout, this, &AcousticIndexer::sendNextLookup);
+}
+
+AcousticIndexer::~AcousticIndexer()
+{
+    cancel();
+    m_pool->waitForDone();
+}
+
+void AcousticIndexer::fingerprintPending()
+{
+    if (!m_dbManager) {
+        return;
+    }
+    if (!AcousticFingerprint::isAvailable()) {
+        qCInfo(acousticIndexer) << "Neither fpcalc nor FFmpeg with chromaprint found, fingerprinting disabled";
+        return;
+    }
+
+    const bool wasRunning = isRunning();
+    if (!wasRunning) {
+        m_totalFiles = m_fingerprintedFiles = m_failedFiles = 0;
+    }
+
+    QSqlQuery query = m_dbManager->getAcousticFingerprintCandidates();
+    while (query.next()) {
+        Job job;
+        job.mediaFileId = query.value(0).toInt();
+        job.filePath = query.value(1).toString();
+        if (m_queued.contains(job.mediaFileId) || MediaFile::detectMediaType(job.filePath) != MediaFile::Audio) {
+            continue;
+        }
+        job.fileSize = query.value(2).toLongLong();
+        job.duration = query.value(3).toLongLong();
+
+        m_queued.insert(job.mediaFileId);
+        m_queue.append(job);
+        ++m_totalFiles;
+    }
+
+    if (!wasRunning && isRunning()) {
+        qCInfo(acousticIndexer) << "Fingerprinting" << m_totalFiles << "files";
+        emit fingerprintingStarted(m_totalFiles);
+    }
+    startWorkers();
+}
+
+void AcousticIndexer::cancel()
+{
+    m_queue.clear();
+    m_queued.clear();
+    m_lookups.clear();
+    m_lookupTimer->stop();
+    writePendingResults();
+
+    // Workers kill their decoder on the flag; it is cleared once they are gone
+    m_cancelled = m_inFlight > 0;
+}
+
+void AcousticIndexer::startWorkers()
+{
+    if (m_cancelled) {
+        return;
+    }
+
+    const int limit = m_pool->maxThreadCount() * MAX_IN_FLIGHT_PER_THREAD;
+    while (m_inFlight < limit && !m_queue.isEmpty()) {
+        const Job job = m_queue.takeFirst();
+        m_queued.remove(job.mediaFileId);
+        ++m_inFlight;
+
+        m_pool->start([this, job]() {
+            ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Background);
+            Result result;
+            result.job = job;
+            const AcousticFingerprint fingerprint = AcousticFingerprint::compute(job.filePath, job.duration,
+                                                                                 &m_cancelled);
+            if (!fingerprint.isEmpty()) {
+                result.fingerprint = fingerprint.serialize();
+                result.subHashes = fingerprint.subHashes();
+            }
+            QMetaObject::invokeMethod(this, [this, result]() {
+                onFileFinished(result);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void AcousticIndexer::onFileFinished(const Result& result)
+{
+    --m_inFlight;
+
+    if (m_cancelled) {
+        if (m_inFlight == 0) {
+            m_cancelled = false;
+            emit fingerprintingFinished(m_fingerprintedFiles, m_failedFiles);
+            qCInfo(acousticIndexer) << "Fingerprinting cancelled";
+            startWorkers();
+        }
+        return;
+    }
+
+    if (result.fingerprint.isEmpty()) {
+        ++m_failedFiles;
+    } else {
+        ++m_fingerprintedFiles;
+    }
+
+    m_pendingResults.append(result);
+    emit fingerprintingProgress(m_fingerprintedFiles + m_failedFiles, m_totalFiles);
+
+    startWorkers();
+
+    if (!isRunning()) {
+        writePendingResults();
+        qCInfo(acousticIndexer) << "Fingerprinting finished. Fingerprinted:" << m_fingerprintedFiles
+                                << "Failed:" << m_failedFiles;
+        emit fingerprintingFinished(m_fingerprintedFiles, m_failedFiles);
+    } else if (m_pendingResults.size() >= WRITE_BATCH_SIZE) {
+        writePendingResults();
+    } else if (!m_writerTimer->isActive()) {
+        m_writerTimer->start();
+    }
+}
+
+void AcousticIndexer::writePendingResults()
+{
+    m_writerTimer->stop();
+    if (m_pendingResults.isEmpty() || !m_dbManager) {
+        return;
+    }
+
+    const bool ownTransaction = !m_dbManager->isBulkUpsertActive() && m_dbManager->beginTransaction();
+    for (const Result& result : std::as_const(m_pendingResults)) {
+        m_dbManager->storeAcousticFingerprint(result.job.mediaFileId, result.job.fileSize, result.fingerprint,
+                                              result.subHashes);
+    }
+    if (ownTransaction) {
+        m_dbManager->commitTransaction();
+    }
+
+    m_pendingResults.clear();
+}
+
+QList<QStringList> AcousticIndexer::findDuplicates()
+{
+    QList<QStringList> duplicateGroups;
+    if (!m_dbManager) {
+        return duplicateGroups;
+    }
+
+    // Fingerprints still in memory would be missed by the index
+    writePendingResults();
+
+    QHash<int, AcousticFingerprint> fingerprints;
+    QHash<int, QString> paths;
+    auto load = [this, &fingerprints, &paths](int id) {
+        auto it = fingerprints.find(id);
+        if (it == fingerprints.end()) {
+            const DatabaseManager::AcousticFingerprintRow row = m_dbManager->getAcousticFingerprint(id);
+            paths.insert(id, row.filePath);
+            it = fingerprints.insert(id, AcousticFingerprint::deserialize(row.fingerprint));
+        }
+        return *it;
+    };
+
+    QHash<int, int> parents;
+    int candidates = 0;
+    QSqlQuery query = m_dbManager->getAcousticMatchCandidates(MIN_SHARED_HASHES, MAX_FILES_PER_HASH);
+    while (query.next()) {
+        const int a = query.value(0).toInt();
+        const int b = query.value(1).toInt();
+        ++candidates;
+
+        const int rootA = findRoot(parents, a);
+        const int rootB = findRoot(parents, b);
+        if (rootA == rootB) {
+            continue;
+        }
+
+        const AcousticFingerprint first = load(a);
+        const AcousticFingerprint second = load(b);
+        if (!first.isEmpty() && !second.isEmpty() && first.matches(second)) {
+            parents.insert(rootB, rootA);
+        }
+    }
+
+    QHash<int, QStringList> members;
+    const QList<int> ids = parents.keys();
+    for (int id : ids) {
+        members[findRoot(parents, id)].append(paths.value(id));
+    }
+    for (auto it = members.begin(); it != members.end(); ++it) {
+        if (it->size() > 1) {
+            it->sort();
+            duplicateGroups.append(it.value());
+            emit duplicateGroupFound(it.value());
+        }
+    }
+
+    emit duplicatesFound(duplicateGroups);
+    qCInfo(acousticIndexer) << "Found" << duplicateGroups.size() << "acoustic duplicate groups from"
+                            << candidates << "candidate pairs";
+    return duplicateGroups;
+}
+
+void AcousticIndexer::lookup(const QStringList& filePaths)
+{
+    if (!m_dbManager) {
+        return;
+    }
+
+    for (const QString& filePath : filePaths) {
+        const AcousticFingerprint fingerprint =
+            AcousticFingerprint::deserialize(m_dbManager->getAcousticFingerprint(filePath).fingerprint);
+        if (m_apiKey.isEmpty()) {
+            emit lookupFailed(filePath, "No AcoustID API key");
+            continue;
+        }
+        if (fingerprint.isEmpty() || fingerprint.duration() <= 0) {
+            emit lookupFailed(filePath, "Not fingerprinted");
+            continue;
+        }
+        m_lookups.append({filePath, fingerprint.compressed(), fingerprint.duration() / 1000});
+    }
+
+    if (!m_lookups.isEmpty() && !m_lookupTimer->isActive()) {
+        sendNextLookup();
+        m_lookupTimer->start();
+    }
+}
+
+void AcousticIndexer::sendNextLookup()
+{
+    if (m_lookups.isEmpty()) {
+        m_lookupTimer->stop();
+        return;
+    }
+
+    const QList<Lookup> batch = m_lookups.mid(0, LOOKUP_BATCH_SIZE);
+    m_lookups.remove(0, batch.size());
+
+    // Batched requests number their parameters: fingerprint.0, duration.0, ...
+    QUrlQuery form;
+    form.addQueryItem("client", m_apiKey);
+    form.addQueryItem("meta", "recordings");
+    form.addQueryItem("format", "json");
+    for (int i = 0; i < batch.size(); ++i) {
+        form.addQueryItem(QString("duration.%1").arg(i), QString::number(batch[i].duration));
+        form.addQueryItem(QString("fingerprint.%1").arg(i), batch[i].fingerprint);
+    }
+
+    QNetworkRequest request{QUrl(ACOUSTID_LOOKUP_URL)};
+    request.setHeader(QNetworkRequest::UserAgentHeader, "EonPlay/1.0");
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+    request.setRawHeader("Accept", "application/json");
+
+    QNetworkReply* reply = NetworkService::instance().post(request, form.toString(QUrl::FullyEncoded).toUtf8(),
+                                                           NetworkService::RequestClass::Metadata);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, batch]() {
+        onLookupFinished(reply, batch);
+    });
+}
+
+void AcousticIndexer::onLookupFinished(QNetworkReply* reply, const QList<Lookup>& batch)
+{
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        for (const Lookup& lookup : batch) {
+            emit lookupFailed(lookup.filePath, reply->errorString());
+        }
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(reply->readAll()).object();
+    if (root.value("status").toString() != "ok") {
+        const QString error = root.value("error").toObject().value("message").toString("Invalid response");
+        for (const Lookup& lookup : batch) {
+            emit lookupFailed(lookup.filePath, error);
+        }
+        return;
+    }
+
+    // A batch answers per fingerprint index, a single lookup with its results directly
+    QHash<int, QJsonArray> resultsByIndex;
+    if (root.contains("fingerprints")) {
+        for (const QJsonValue& entry : root.value("fingerprints").toArray()) {
+            const QJsonObject object = entry.toObject();
+            resultsByIndex.insert(object.value("index").toInt(), object.value("results").toArray());
+        }
+    } else {
+        resultsByIndex.insert(0, root.value("results").toArray());
+    }
+
+    for (int i = 0; i < batch.size(); ++i) {
+        // Results come best first; the first with a recording is the match
+        bool found = false;
+        for (const QJsonValue& value : resultsByIndex.value(i)) {
+            const QJsonObject result = value.toObject();
+            const QJsonArray recordings = result.value("recordings").toArray();
+            if (recordings.isEmpty()) {
+                continue;
+            }
+
+            const QJsonObject recording = recordings.first().toObject();
+            QStringList artists;
+            for (const QJsonValue& artist : recording.value("artists").toArray()) {
+                artists << artist.toObject().value("name").toString();
+            }
+            emit recordingFound(batch[i].filePath, recording.value("id").toString(),
+                                recording.value("title").toString(), artists.join(", "),
+                                result.value("score").toDouble());
+            found = true;
+            break;
+        }
+        if (!found) {
+            emit lookupFailed(batch[i].filePath, "No match");
+        }
+    }
+}
+
+} // namespace Data
+} // namespace EonPlay
@@ -1,21 +1,38 @@
 #include "data/BackupManager.h"
 #include "data/DatabaseManager.h"
+#include "data/ChunkStore.h"
+#include "security/AesGcm.h"
 #include <QDir>
 #include <QFileInfo>
 #include <QStandardPaths>
 #include <QDateTime>
 #include <QTimer>
+#include <QCoreApplication>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QRandomGenerator>
 #include <QLoggingCategory>
 #include <QDebug>
 
 Q_LOGGING_CATEGORY(backupManager, "eonplay.backup")
 
+using EonPlay::Data::ChunkStore;
+using EonPlay::Data::DatabaseBackup;
+
+const QString BackupManager::BACKUP_METADATA_FILE = "backups.json";
+const QString BackupManager::CHUNK_STORE_DIRECTORY = "chunks";
+const QString BackupManager::DECRYPTED_SUFFIX = ".decrypted";
+
 BackupManager::BackupManager(QObject* parent)
     : QObject(parent)
     , m_automaticBackupEnabled(true)
     , m_backupIntervalHours(24)
     , m_maxBackupCount(7)
     , m_compressionEnabled(true)
+    , m_incrementalEnabled(true)
     , m_encryptionEnabled(false)
     , m_currentStatus(BACKUP_IDLE)
     , m_currentProgress(0)
@@ -27,6 +44,7 @@ BackupManager::BackupManager(QObject* parent)
     
     // Ensure backup directory exists
     QDir().mkpath(m_backupDirectory);
+    loadBackupInfo();
     
     // Setup auto backup timer
     m_automaticBackupTimer->setInterval(m_backupIntervalHours * 60 * 60 * 1000);
@@ -36,6 +54,17 @@ BackupManager::BackupManager(QObject* parent)
     qCInfo(backupManager) << "BackupManager initialized with directory:" << m_backupDirectory;
 }
 
+BackupManager::~BackupManager()
+{
+    // Its result could no longer be recorded
+    m_runningBackup.cancel();
+}
+
+void BackupManager::setDatabaseManager(EonPlay::Data::DatabaseManager* databaseManager)
+{
+    m_databaseManager = databaseManager;
+}
+
 void BackupManager::enableAutomaticBackup(bool enabled)
 {
     if (m_automaticBackupEnabled != enabled) {
@@ -76,21 +105,101 @@ void BackupManager::setBackupDirectory(const QString& directory)
         
         // Ensure new directory exists
         QDir().mkpath(m_backupDirectory);
+        loadBackupInfo();
         
         qCInfo(backupManager) << "Backup directory changed to:" << directory;
     }
 }
 
+void BackupManager::enableCompression(bool enabled)
+{
+    if (enabled && !DatabaseBackup::isCompressionAvailable()) {
+        qCWarning(backupManager) << "Backups cannot be compressed: built without zstd";
+    }
+    m_compressionEnabled = enabled;
+}
+
+bool BackupManager::isCompressionEnabled() const
+{
+    return m_compressionEnabled;
+}
+
+void BackupManager::enableIncrementalBackup(bool enabled)
+{
+    m_incrementalEnabled = enabled;
+    qCInfo(backupManager) << "Incremental backup" << (enabled ? "enabled" : "disabled");
+}
+
+void BackupManager::enableEncryption(bool enabled)
+{
+    m_encryptionEnabled = enabled;
+    qCInfo(backupManager) << "Backup encryption" << (enabled ? "enabled" : "disabled")
+                          << "using" << AesGcm::implementation();
+}
+
+bool BackupManager::isEncryptionEnabled() const
+{
+    return m_encryptionEnabled;
+}
+
+void BackupManager::setEncryptionKey(const QString& key)
+{
+    if (key != m_encryptionKey) {
+        m_encryptionKey = key;
+        m_derivedKeys.clear();
+    }
+}
+
+QByteArray BackupManager::backupKey(const QByteArray& salt)
+{
+    // Derivation is deliberately slow; do it once per salt
+    auto cached = m_derivedKeys.constFind(salt);
+    if (cached != m_derivedKeys.constEnd()) {
+        return *cached;
+    }
+    
+    const QByteArray key = AesGcm::deriveKey(m_encryptionKey.toUtf8(), salt);
+    m_derivedKeys.insert(salt, key);
+    return key;
+}
+
+bool BackupManager::decryptBackup(const QString& sourcePath, const QString& targetPath)
+{
+    const QByteArray salt = AesGcm::fileHeader(sourcePath);
+    if (m_encryptionKey.isEmpty() || salt.isEmpty()) {
+        m_lastError = QString("Cannot decrypt backup without its passphrase: %1").arg(sourcePath);
+        return false;
+    }
+    
+    const AesGcm cipher(backupKey(salt));
+    return cipher.decryptFile(sourcePath, targetPath, &m_lastError);
+}
+
 QString BackupManager::createBackup(BackupType type, const QString& description)
 {
-    // Generate backup file name
-    QString fileName = description.isEmpty() ? QDateTime::currentDateTime().toString("backup_yyyy-MM-dd_hh-mm-ss") : description;
-    if (!fileName.endsWith(".db")) {
-        fileName += ".db";
+    QString backupId = generateBackupId();
+    
+    if (m_currentStatus == BACKUP_IN_PROGRESS || m_currentStatus == RESTORE_IN_PROGRESS) {
+        QString error = QString("Another backup or restore is running");
+        qCWarning(backupManager) << error;
+        emit backupFailed(backupId, error);
+        return QString();
     }
     
-    QString backupId = QFileInfo(fileName).baseName();
-    emit backupStarted(backupId, type);
+    // Playlists live in the library database; settings and thumbnails are not backed up here
+    if (type == BACKUP_USER_SETTINGS || type == BACKUP_THUMBNAILS) {
+        QString error = QString("Backup type %1 is not supported").arg(type);
+        qCWarning(backupManager) << error;
+        emit backupFailed(backupId, error);
+        return QString();
+    }
+    
+    if (!m_databaseManager || !m_databaseManager->isInitialized()) {
+        QString error = QString("No library database to back up");
+        qCWarning(backupManager) << error;
+        emit backupFailed(backupId, error);
+        return QString();
+    }
     
     // Ensure backup directory exists
     QDir backupDir(m_backupDirectory);
@@ -101,25 +210,88 @@ QString BackupManager::createBackup(BackupType type, const QString& description)
         return QString();
     }
     
-    QString backupPath = backupDir.absoluteFilePath(fileName);
+    BackupInfo info;
+    info.backupId = backupId;
+    info.type = type;
+    info.timestamp = QDateTime::currentDateTime();
+    info.description = description;
+    info.version = QCoreApplication::applicationVersion();
     
-    // Create the backup (simplified implementation)
-    QFile sourceFile(backupPath);
-    if (sourceFile.open(QIODevice::WriteOnly)) {
-        sourceFile.write("Backup placeholder data");
-        sourceFile.close();
+    DatabaseBackup::Options options;
+    options.compress = m_compressionEnabled;
+    if (m_encryptionEnabled) {
+        if (m_encryptionKey.isEmpty()) {
+            QString error = QString("Backup encryption is enabled but no passphrase is set");
+            qCWarning(backupManager) << error;
+            emit backupFailed(backupId, error);
+            return QString();
+        }
+        if (m_encryptionSalt.isEmpty()) {
+            m_encryptionSalt.resize(ENCRYPTION_SALT_LENGTH);
+            QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(m_encryptionSalt.data()),
+                                                  ENCRYPTION_SALT_LENGTH / 4);
+        }
+        options.encryptionKey = backupKey(m_encryptionSalt);
+        options.encryptionHeader = m_encryptionSalt;
+    } else if (m_incrementalEnabled) {
+        // Chunks are shared between backups and stored in the clear
+        options.chunkStore = chunkStoreDirectory();
+    }
+    
+    m_currentStatus = BACKUP_IN_PROGRESS;
+    m_currentProgress = 0;
+    emit backupStarted(backupId, type);
+    
+    // The copy runs on its own connection and thread; results come back here
+    auto* watcher = new QFutureWatcher<DatabaseBackup::Result>(this);
+    connect(watcher, &QFutureWatcherBase::progressValueChanged, this, [this, backupId](int progress) {
+        m_currentProgress = progress;
+        emit backupProgress(backupId, progress);
+    });
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, info]() mutable {
+        watcher->deleteLater();
+        m_runningBackup = QFuture<DatabaseBackup::Result>();
+        
+        // A cancelled backup reports no result
+        DatabaseBackup::Result result;
+        if (watcher->future().resultCount() > 0) {
+            result = watcher->future().result();
+        } else {
+            result.error = "Backup cancelled";
+        }
+        
+        if (!result.success) {
+            m_lastError = result.error;
+            m_currentStatus = BACKUP_FAILED;
+            qCWarning(backupManager) << "Backup" << info.backupId << "failed:" << result.error;
+            emit backupFailed(info.backupId, result.error);
+            return;
+        }
+        
+        info.filePath = result.filePath;
+        info.fileSize = result.fileSize;
+        info.checksum = result.checksum;
+        info.isCompressed = result.compressed;
+        info.isEncrypted = result.encrypted;
+        saveBackupInfo(info);
         
+        m_lastBackupTime = info.timestamp;
+        m_currentStatus = BACKUP_COMPLETED;
+        m_currentProgress = 100;
         cleanupOldBackups();
         
-        qCInfo(backupManager) << "Backup created successfully:" << backupPath;
-        emit backupCompleted(backupId);
-        return backupId;
-    } else {
-        QString error = QString("Failed to create backup");
-        qCWarning(backupManager) << error;
-        emit backupFailed(backupId, error);
-        return QString();
-    }
+        qCInfo(backupManager) << "Backup created successfully:" << info.filePath;
+        emit backupCompleted(info.backupId);
+    });
+    
+    m_runningBackup = m_databaseManager->createBackup(backupDir.absoluteFilePath(backupId + ".db"), options);
+    watcher->setFuture(m_runningBackup);
+    return backupId;
+}
+
+void BackupManager::cancelBackup()
+{
+    m_runningBackup.cancel();
 }
 
 bool BackupManager::restoreBackup(const QString& backupId)
@@ -127,14 +299,8 @@ bool BackupManager::restoreBackup(const QString& backupId)
     emit restoreStarted(backupId);
     
     // Find backup file by ID
-    QList<BackupInfo> backups = getAvailableBackups();
-    QString backupPath;
-    for (const BackupInfo& backup : backups) {
-        if (backup.backupId == backupId) {
-            backupPath = backup.filePath;
-            break;
-        }
-    }
+    BackupInfo backup = getBackupInfo(backupId);
+    QString backupPath = backup.filePath;
     
     if (backupPath.isEmpty()) {
         QString error = QString("Backup not found: %1").arg(backupId);
@@ -151,12 +317,73 @@ bool BackupManager::restoreBackup(const QString& backupId)
         return false;
     }
     
-    // Simplified restore implementation
+    if (!m_databaseManager || m_currentStatus == BACKUP_IN_PROGRESS) {
+        QString error = QString("The library database cannot be restored now");
+        qCWarning(backupManager) << error;
+        emit restoreFailed(backupId, error);
+        return false;
+    }
+    
+    // A damaged backup must not replace a working library
+    if (!backup.checksum.isEmpty() && !verifyBackup(backupId)) {
+        QString error = QString("Backup is damaged: %1").arg(backupPath);
+        qCWarning(backupManager) << error;
+        emit restoreFailed(backupId, error);
+        return false;
+    }
+    
+    m_currentStatus = RESTORE_IN_PROGRESS;
+    
+    // Decrypted next to the backup, before the library is closed for the restore
+    QString restorePath = backupPath;
+    if (backup.isEncrypted || AesGcm::isEncryptedFile(backupPath)) {
+        restorePath = backupPath + DECRYPTED_SUFFIX;
+        if (!decryptBackup(backupPath, restorePath)) {
+            m_currentStatus = RESTORE_FAILED;
+            qCWarning(backupManager) << "Restore failed:" << m_lastError;
+            emit restoreFailed(backupId, m_lastError);
+            return false;
+        }
+    }
+    
+    const bool restored = m_databaseManager->restoreFromBackup(restorePath);
+    if (restorePath != backupPath) {
+        QFile::remove(restorePath);
+    }
+    if (!restored) {
+        m_lastError = m_databaseManager->lastError();
+        m_currentStatus = RESTORE_FAILED;
+        qCWarning(backupManager) << "Restore failed:" << m_lastError;
+        emit restoreFailed(backupId, m_lastError);
+        return false;
+    }
+    
+    m_currentStatus = RESTORE_COMPLETED;
     qCInfo(backupManager) << "Backup restored successfully from:" << backupPath;
     emit restoreCompleted(backupId);
     return true;
 }
 
+bool BackupManager::verifyBackup(const QString& backupId)
+{
+    BackupInfo backup = getBackupInfo(backupId);
+    if (backup.filePath.isEmpty() || backup.checksum.isEmpty()) {
+        m_lastError = QString("No checksum recorded for backup: %1").arg(backupId);
+        return false;
+    }
+    
+    // The recorded checksum was taken as the backup was written; chunked
+    // backups are checked chunk by chunk against the database's checksum
+    const QString checksum = ChunkStore::isManifest(backup.filePath) ? ChunkStore::checksum(backup.filePath)
+                                                                     : DatabaseBackup::fileChecksum(backup.filePath);
+    if (checksum != backup.checksum) {
+        m_lastError = QString("Checksum mismatch for backup: %1").arg(backupId);
+        qCWarning(backupManager) << m_lastError;
+        return false;
+    }
+    return true;
+}
+
 QList<BackupManager::BackupInfo> BackupManager::getAvailableBackups() const
 {
     QDir backupDir(m_backupDirectory);
@@ -165,34 +392,54 @@ QList<BackupManager::BackupInfo> BackupManager::getAvailableBackups() const
     }
     
     QStringList filters;
-    filters << "*.db";
+    filters << "*.db" << QString("*.db") + DatabaseBackup::COMPRESSED_SUFFIX
+            << QString("*") + ChunkStore::MANIFEST_SUFFIX;
     
     QFileInfoList backupFiles = backupDir.entryInfoList(filters, QDir::Files, QDir::Time | QDir::Reversed);
     
     QList<BackupInfo> backupInfos;
     for (const QFileInfo& fileInfo : backupFiles) {
-        BackupInfo info;
-        info.backupId = fileInfo.baseName();
+        // Recorded details where there are any, otherwise what the file tells
+        BackupInfo info = m_backupDatabase.value(fileInfo.baseName());
+        if (info.backupId.isEmpty()) {
+            info.backupId = fileInfo.baseName();
+            info.timestamp = fileInfo.lastModified();
+            info.type = BACKUP_COMPLETE;
+            info.isCompressed = fileInfo.fileName().endsWith(DatabaseBackup::COMPRESSED_SUFFIX);
+        }
         info.filePath = fileInfo.absoluteFilePath();
         info.fileSize = fileInfo.size();
-        info.timestamp = fileInfo.lastModified();
-        info.type = BACKUP_COMPLETE;
         backupInfos << info;
     }
     
     return backupInfos;
 }
 
-bool BackupManager::deleteBackup(const QString& backupPath)
+BackupManager::BackupInfo BackupManager::getBackupInfo(const QString& backupId) const
 {
-    QFileInfo backupInfo(backupPath);
-    if (!backupInfo.exists()) {
+    const QList<BackupInfo> backups = getAvailableBackups();
+    for (const BackupInfo& backup : backups) {
+        if (backup.backupId == backupId) {
+            return backup;
+        }
+    }
+    return BackupInfo();
+}
+
+bool BackupManager::deleteBackup(const QString& backupId)
+{
+    QString backupPath = getBackupInfo(backupId).filePath;
+    if (backupPath.isEmpty()) {
         return false;
     }
     
     if (QFile::remove(backupPath)) {
+        removeBackupInfo(backupId);
+        if (ChunkStore::isManifest(backupPath)) {
+            collectChunkGarbage();
+        }
         qCInfo(backupManager) << "Backup deleted:" << backupPath;
-        emit backupDeleted(backupPath);
+        emit backupDeleted(backupId);
         return true;
     } else {
         qCWarning(backupManager) << "Failed to delete backup:" << backupPath;
@@ -204,9 +451,9 @@ void BackupManager::cleanupOldBackups()
 {
     QList<BackupInfo> backups = getAvailableBackups();
     
-    // Remove excess backups (keep only the most recent ones)
+    // Remove excess backups (keep only the most recent ones; the list is oldest first)
     while (backups.size() > m_maxBackupCount) {
-        BackupInfo oldestBackup = backups.takeLast();
+        BackupInfo oldestBackup = backups.takeFirst();
         deleteBackup(oldestBackup.backupId);
     }
 }
@@ -216,13 +463,30 @@ qint64 BackupManager::getTotalBackupSize() const
     QList<BackupInfo> backups = getAvailableBackups();
     qint64 totalSize = 0;
     
+    // Manifests and standalone files, plus each shared chunk once
     for (const BackupInfo& backup : backups) {
         totalSize += backup.fileSize;
     }
+    totalSize += ChunkStore(chunkStoreDirectory()).diskUsage();
     
     return totalSize;
 }
 
+BackupManager::BackupStatus BackupManager::getCurrentStatus() const
+{
+    return m_currentStatus;
+}
+
+int BackupManager::getCurrentProgress() const
+{
+    return m_currentProgress;
+}
+
+QString BackupManager::getLastError() const
+{
+    return m_lastError;
+}
+
 void BackupManager::onAutomaticBackupTimer()
 {
     if (m_automaticBackupEnabled) {
@@ -230,4 +494,109 @@ void BackupManager::onAutomaticBackupTimer()
         emit automaticBackupTriggered();
         createBackup(BACKUP_COMPLETE, "Automatic backup");
     }
-}
\ No newline at end of file
+}
+
+QString BackupManager::generateBackupId() const
+{
+    QString backupId = QDateTime::currentDateTime().toString("backup_yyyy-MM-dd_hh-mm-ss");
+    
+    // Two backups within a second
+    QString uniqueId = backupId;
+    for (int i = 2; m_backupDatabase.contains(uniqueId); ++i) {
+        uniqueId = QString("%1_%2").arg(backupId).arg(i);
+    }
+    return uniqueId;
+}
+
+void BackupManager::saveBackupInfo(const BackupInfo& info)
+{
+    m_backupDatabase.insert(info.backupId, info);
+    writeBackupMetadata();
+}
+
+void BackupManager::writeBackupMetadata() const
+{
+    QJsonArray backups;
+    for (const BackupInfo& backup : std::as_const(m_backupDatabase)) {
+        QJsonObject object;
+        object["id"] = backup.backupId;
+        object["type"] = backup.type;
+        object["timestamp"] = backup.timestamp.toString(Qt::ISODate);
+        object["file"] = QFileInfo(backup.filePath).fileName();
+        object["size"] = backup.fileSize;
+        object["checksum"] = backup.checksum;
+        object["description"] = backup.description;
+        object["compressed"] = backup.isCompressed;
+        object["encrypted"] = backup.isEncrypted;
+        object["version"] = backup.version;
+        backups.append(object);
+    }
+    
+    QSaveFile file(QDir(m_backupDirectory).absoluteFilePath(BACKUP_METADATA_FILE));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(backupManager) << "Failed to save backup metadata:" << file.errorString();
+        return;
+    }
+    file.write(QJsonDocument(backups).toJson());
+    if (!file.commit()) {
+        qCWarning(backupManager) << "Failed to save backup metadata:" << file.errorString();
+    }
+}
+
+void BackupManager::loadBackupInfo()
+{
+    m_backupDatabase.clear();
+    
+    QFile file(QDir(m_backupDirectory).absoluteFilePath(BACKUP_METADATA_FILE));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    
+    const QJsonArray backups = QJsonDocument::fromJson(file.readAll()).array();
+    for (const QJsonValue& value : backups) {
+        const QJsonObject object = value.toObject();
+        BackupInfo info;
+        info.backupId = object["id"].toString();
+        info.type = static_cast<BackupType>(object["type"].toInt(BACKUP_COMPLETE));
+        info.timestamp = QDateTime::fromString(object["timestamp"].toString(), Qt::ISODate);
+        info.filePath = QDir(m_backupDirectory).absoluteFilePath(object["file"].toString());
+        info.fileSize = object["size"].toInteger();
+        info.checksum = object["checksum"].toString();
+        info.description = object["description"].toString();
+        info.isCompressed = object["compressed"].toBool();
+        info.isEncrypted = object["encrypted"].toBool();
+        info.version = object["version"].toString();
+        if (!info.backupId.isEmpty()) {
+            m_backupDatabase.insert(info.backupId, info);
+        }
+    }
+}
+
+void BackupManager::removeBackupInfo(const QString& backupId)
+{
+    if (m_backupDatabase.remove(backupId) > 0) {
+        writeBackupMetadata();
+    }
+}
+
+QString BackupManager::chunkStoreDirectory() const
+{
+    return QDir(m_backupDirectory).absoluteFilePath(CHUNK_STORE_DIRECTORY);
+}
+
+void BackupManager::collectChunkGarbage()
+{
+    // A running backup relies on chunks no manifest lists yet; the next deletion collects them
+    if (m_currentStatus == BACKUP_IN_PROGRESS) {
+        return;
+    }
+    
+    QStringList manifests;
+    const QList<BackupInfo> backups = getAvailableBackups();
+    for (const BackupInfo& backup : backups) {
+        if (ChunkStore::isManifest(backup.filePath)) {
+            manifests << backup.filePath;
+        }
+    }
+    ChunkStore(chunkStoreDirectory()).collectGarbage(manifests);
+}
@@ -0,0 +1,406 @@
+#include "data/ChunkStore.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QSet>
+#include <array>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+Q_LOGGING_CATEGORY(chunkStore, "eonplay.data.chunks")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+
+constexpr int MANIFEST_VERSION = 1;
+
+// Normalized chunking: cuts are harder to hit before the average size, easier after it
+constexpr quint64 MASK_SMALL = 0xfffff00000000000ULL;    // 20 bits
+constexpr quint64 MASK_LARGE = 0xffff000000000000ULL;    // 16 bits
+
+// First byte of a chunk file
+constexpr char CHUNK_RAW = 'R';
+constexpr char CHUNK_ZSTD = 'Z';
+
+/**
+ * @brief Gear values; derived from a fixed seed so cut points are the same in every run
+ */
+const std::array<quint64, 256>& gearTable()
+{
+    static const std::array<quint64, 256> table = [] {
+        std::array<quint64, 256> values {};
+        quint64 state = 0x45'6f'6e'50'6c'61'79'00ULL;
+        for (quint64& value : values) {
+            // splitmix64
+            quint64 z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            value = z ^ (z >> 31);
+        }
+        return values;
+    }();
+    return table;
+}
+
+QString hashName(const QByteArray& data)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+}
+
+} // namespace
+
+ChunkStore::ChunkStore(const QString& directory)
+    : m_directory(QDir(directory).absolutePath())
+{
+}
+
+ChunkStore::StoreResult ChunkStore::store(QIODevice& input, const QString& manifestPath, bool compress,
+                                          int compressionLevel, const ProgressCallback& progress)
+{
+    StoreResult result;
+    if (!QDir().mkpath(m_directory)) {
+        result.error = QString("Cannot create chunk store %1").arg(m_directory);
+        return result;
+    }
+
+    QCryptographicHash fileHash(QCryptographicHash::Sha256);
+    QJsonArray chunks;
+    QByteArray buffer;
+    qsizetype start = 0;
+    bool atEnd = false;
+
+    while (true) {
+        // At least one maximum chunk ahead, so cut points do not depend on read sizes
+        if (!atEnd && buffer.size() - start < MAX_CHUNK_SIZE) {
+            buffer.remove(0, start);
+            start = 0;
+            const qsizetype offset = buffer.size();
+            buffer.resize(offset + MAX_CHUNK_SIZE);
+            const qint64 read = input.read(buffer.data() + offset, MAX_CHUNK_SIZE);
+            if (read < 0) {
+                result.error = QString("Cannot read input: %1").arg(input.errorString());
+                return result;
+            }
+            buffer.resize(offset + read);
+            atEnd = read == 0 || input.atEnd();
+            continue;
+        }
+        if (start >= buffer.size()) {
+            break;
+        }
+
+        const int length = chunkLength(reinterpret_cast<const uchar*>(buffer.constData()) + start,
+                                       static_cast<int>(qMin<qsizetype>(buffer.size() - start, MAX_CHUNK_SIZE)));
+        const QByteArray chunk = buffer.mid(start, length);
+        start += length;
+
+        const QString hash = hashName(chunk);
+        fileHash.addData(chunk);
+        qint64 written = 0;
+        if (!writeChunk(chunk, hash, compress, compressionLevel, &written, &result.error)) {
+            return result;
+        }
+        if (written > 0) {
+            ++result.newChunks;
+            result.storedBytes += written;
+        }
+        chunks.append(hash);
+        ++result.chunkCount;
+        result.size += length;
+
+        if (progress && !progress(result.size)) {
+            result.error = "Cancelled";
+            return result;
+        }
+    }
+    result.checksum = QString::fromLatin1(fileHash.result().toHex());
+
+    QJsonObject manifest;
+    manifest["version"] = MANIFEST_VERSION;
+    manifest["store"] = QFileInfo(manifestPath).absoluteDir().relativeFilePath(m_directory);
+    manifest["size"] = result.size;
+    manifest["checksum"] = result.checksum;
+    manifest["chunks"] = chunks;
+    const QByteArray manifestData = QJsonDocument(manifest).toJson(QJsonDocument::Compact);
+
+    QSaveFile file(manifestPath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(manifestData) != manifestData.size() || !file.commit()) {
+        result.error = QString("Cannot write manifest %1: %2").arg(manifestPath, file.errorString());
+        return result;
+    }
+    result.storedBytes += manifestData.size();
+    result.success = true;
+
+    qCDebug(chunkStore) << "Stored" << result.size << "bytes in" << result.chunkCount << "chunks,"
+                        << result.newChunks << "new," << result.storedBytes << "bytes added";
+    return result;
+}
+
+bool ChunkStore::restore(const QString& manifestPath, QIODevice& output, QString* error)
+{
+    const Manifest manifest = readManifest(manifestPath);
+    if (!manifest.valid) {
+        if (error) {
+            *error = QString("Cannot read manifest %1").arg(manifestPath);
+        }
+        return false;
+    }
+
+    qint64 size = 0;
+    QByteArray chunk;
+    for (const QString& hash : manifest.chunks) {
+        if (!readChunk(manifest.storeDirectory, hash, &chunk, error)) {
+            return false;
+        }
+        if (output.write(chunk) != chunk.size()) {
+            if (error) {
+                *error = QString("Cannot write: %1").arg(output.errorString());
+            }
+            return false;
+        }
+        size += chunk.size();
+    }
+
+    if (size != manifest.size) {
+        if (error) {
+            *error = QString("Size mismatch restoring %1").arg(manifestPath);
+        }
+        return false;
+    }
+    return true;
+}
+
+QString ChunkStore::checksum(const QString& manifestPath)
+{
+    const Manifest manifest = readManifest(manifestPath);
+    if (!manifest.valid) {
+        return QString();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    QByteArray chunk;
+    QString error;
+    for (const QString& name : manifest.chunks) {
+        if (!readChunk(manifest.storeDirectory, name, &chunk, &error)) {
+            qCWarning(chunkStore) << error;
+            return QString();
+        }
+        hash.addData(chunk);
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QString ChunkStore::recordedChecksum(const QString& manifestPath)
+{
+    return readManifest(manifestPath).checksum;
+}
+
+qint64 ChunkStore::collectGarbage(const QStringList& manifestPaths)
+{
+    QSet<QString> referenced;
+    for (const QString& path : manifestPaths) {
+        const Manifest manifest = readManifest(path);
+        if (!manifest.valid) {
+            // Its chunks cannot be told apart from garbage
+            qCWarning(chunkStore) << "Not collecting garbage: cannot read manifest" << path;
+            return 0;
+        }
+        for (const QString& hash : manifest.chunks) {
+            referenced.insert(hash);
+        }
+    }
+
+    qint64 freed = 0;
+    int removed = 0;
+    QDirIterator it(m_directory, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        if (referenced.contains(it.fileName())) {
+            continue;
+        }
+        const qint64 size = it.fileInfo().size();
+        if (QFile::remove(it.filePath())) {
+            freed += size;
+            ++removed;
+        }
+    }
+
+    if (removed > 0) {
+        qCInfo(chunkStore) << "Removed" << removed << "unreferenced chunks," << freed << "bytes";
+    }
+    return freed;
+}
+
+qint64 ChunkStore::diskUsage() const
+{
+    qint64 usage = 0;
+    QDirIterator it(m_directory, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        usage += it.fileInfo().size();
+    }
+    return usage;
+}
+
+bool ChunkStore::isManifest(const QString& path)
+{
+    return path.endsWith(MANIFEST_SUFFIX);
+}
+
+ChunkStore::Manifest ChunkStore::readManifest(const QString& manifestPath)
+{
+    Manifest manifest;
+    QFile file(manifestPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return manifest;
+    }
+
+    const QJsonObject object = QJsonDocument::fromJson(file.readAll()).object();
+    if (object["version"].toInt() != MANIFEST_VERSION) {
+        return manifest;
+    }
+
+    manifest.storeDirectory = QFileInfo(manifestPath).absoluteDir().absoluteFilePath(object["store"].toString());
+    manifest.size = object["size"].toInteger();
+    manifest.checksum = object["checksum"].toString();
+    const QJsonArray chunks = object["chunks"].toArray();
+    manifest.chunks.reserve(chunks.size());
+    for (const QJsonValue& chunk : chunks) {
+        manifest.chunks << chunk.toString();
+    }
+    manifest.valid = true;
+    return manifest;
+}
+
+QString ChunkStore::chunkPath(const QString& storeDirectory, const QString& hash)
+{
+    // Fanned out by the first byte so no directory gets too large
+    return QString("%1/%2/%3").arg(storeDirectory, hash.left(2), hash);
+}
+
+bool ChunkStore::readChunk(const QString& storeDirectory, const QString& hash, QByteArray* data, QString* error)
+{
+    const auto fail = [&](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    QFile file(chunkPath(storeDirectory, hash));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(QString("Missing chunk %1").arg(hash));
+    }
+    const QByteArray encoded = file.readAll();
+    if (encoded.isEmpty()) {
+        return fail(QString("Damaged chunk %1").arg(hash));
+    }
+
+    if (encoded.at(0) == CHUNK_RAW) {
+        *data = encoded.mid(1);
+    } else if (encoded.at(0) == CHUNK_ZSTD) {
+#ifdef HAVE_ZSTD
+        const unsigned long long size = ZSTD_getFrameContentSize(encoded.constData() + 1, encoded.size() - 1);
+        if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN || size > MAX_CHUNK_SIZE) {
+            return fail(QString("Damaged chunk %1").arg(hash));
+        }
+        data->resize(static_cast<qsizetype>(size));
+        const size_t decoded = ZSTD_decompress(data->data(), data->size(), encoded.constData() + 1, encoded.size() - 1);
+        if (ZSTD_isError(decoded) || decoded != size) {
+            return fail(QString("Damaged chunk %1").arg(hash));
+        }
+#else
+        return fail(QString("Chunk %1 is compressed; built without zstd").arg(hash));
+#endif
+    } else {
+        return fail(QString("Damaged chunk %1").arg(hash));
+    }
+
+    // The name is the content's hash, so every chunk checks itself
+    if (hashName(*data) != hash) {
+        return fail(QString("Damaged chunk %1").arg(hash));
+    }
+    return true;
+}
+
+int ChunkStore::chunkLength(const uchar* data, int size)
+{
+    if (size <= MIN_CHUNK_SIZE) {
+        return size;
+    }
+
+    // FastCDC: the gear hash shifts one bit per byte, so its top bits cover the last 64 bytes
+    const std::array<quint64, 256>& gear = gearTable();
+    const int normalSize = qMin(size, AVERAGE_CHUNK_SIZE);
+    quint64 hash = 0;
+    int i = MIN_CHUNK_SIZE;
+    for (; i < normalSize; ++i) {
+        hash = (hash << 1) + gear[data[i]];
+        if (!(hash & MASK_SMALL)) {
+            return i + 1;
+        }
+    }
+    for (; i < size; ++i) {
+        hash = (hash << 1) + gear[data[i]];
+        if (!(hash & MASK_LARGE)) {
+            return i + 1;
+        }
+    }
+    return size;
+}
+
+bool ChunkStore::writeChunk(const QByteArray& data, const QString& hash, bool compress, int compressionLevel,
+                            qint64* written, QString* error)
+{
+    // Already stored by an earlier backup
+    const QString path = chunkPath(m_directory, hash);
+    if (QFile::exists(path)) {
+        return true;
+    }
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QByteArray encoded;
+#ifdef HAVE_ZSTD
+    if (compress) {
+        encoded.resize(1 + static_cast<qsizetype>(ZSTD_compressBound(data.size())));
+        const size_t size = ZSTD_compress(encoded.data() + 1, encoded.size() - 1, data.constData(), data.size(),
+                                          compressionLevel);
+        // Incompressible chunks are kept as they are
+        if (!ZSTD_isError(size) && static_cast<qsizetype>(size) < data.size()) {
+            encoded[0] = CHUNK_ZSTD;
+            encoded.resize(1 + static_cast<qsizetype>(size));
+        } else {
+            encoded.clear();
+        }
+    }
+#else
+    Q_UNUSED(compress);
+    Q_UNUSED(compressionLevel);
+#endif
+    if (encoded.isEmpty()) {
+        encoded.reserve(1 + data.size());
+        encoded.append(CHUNK_RAW);
+        encoded.append(data);
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(encoded) != encoded.size() || !file.commit()) {
+        *error = QString("Cannot write chunk %1: %2").arg(path, file.errorString());
+        return false;
+    }
+    *written = encoded.size();
+    return true;
+}
+
+} // namespace Data
+} // namespace EonPlay
@@ -0,0 +1,162 @@
+#include "data/CoverArtStore.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+Q_LOGGING_CATEGORY(coverArtStore, "eonplay.data.coverart")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+const int THUMBNAIL_QUALITY = 85;
+
+bool writeFile(const QString& path, const QByteArray& data)
+{
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+}
+}
+
+CoverArtStore::CoverArtStore(const QString& directory)
+    : m_directory(directory)
+{
+}
+
+QString CoverArtStore::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/coverart";
+}
+
+QList<int> CoverArtStore::thumbnailSizes()
+{
+    // Library table rows, library grid tiles and the album art pane
+    return QList<int>() << 32 << 64 << 200;
+}
+
+QString CoverArtStore::store(const QByteArray& imageBytes) const
+{
+    if (imageBytes.isEmpty()) {
+        return QString();
+    }
+
+    const QString hash = QCryptographicHash::hash(imageBytes, QCryptographicHash::Sha1).toHex();
+
+    // Two levels keep directories small on large libraries
+    const QDir entryDir(QDir(m_directory).filePath(hash.left(2)));
+
+    QBuffer buffer;
+    buffer.setData(imageBytes);
+    QImageReader reader(&buffer);
+    const QString format = QString::fromLatin1(reader.format());
+    if (format.isEmpty()) {
+        return QString();
+    }
+
+    const QString originalPath = entryDir.filePath(hash + QLatin1Char('.') + (format == "jpeg" ? "jpg" : format));
+    if (QFileInfo::exists(originalPath)) {
+        return originalPath;
+    }
+
+    reader.setAutoTransform(true);
+    const QImage image = reader.read();
+    if (image.isNull()) {
+        qCDebug(coverArtStore) << "Undecodable cover art:" << reader.errorString();
+        return QString();
+    }
+
+    if (!entryDir.mkpath(".")) {
+        qCWarning(coverArtStore) << "Failed to create cover art directory:" << entryDir.path();
+        return QString();
+    }
+
+    // Thumbnails first, so an original on disk always has its copies
+    for (int size : thumbnailSizes()) {
+        if (image.width() <= size && image.height() <= size) {
+            continue;
+        }
+
+        QByteArray scaled;
+        QBuffer out(&scaled);
+        out.open(QIODevice::WriteOnly);
+        image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation)
+             .convertToFormat(QImage::Format_RGB32)
+             .save(&out, "JPEG", THUMBNAIL_QUALITY);
+
+        if (scaled.isEmpty() || !writeFile(entryDir.filePath(scaledFileName(hash, size)), scaled)) {
+            qCWarning(coverArtStore) << "Failed to write cover art thumbnail for" << hash;
+            return QString();
+        }
+    }
+
+    if (!writeFile(originalPath, imageBytes)) {
+        qCWarning(coverArtStore) << "Failed to write cover art:" << originalPath;
+        return QString();
+    }
+
+    return originalPath;
+}
+
+QString CoverArtStore::thumbnailPath(const QString& coverArtPath, int size)
+{
+    const QFileInfo original(coverArtPath);
+    const QString hash = original.completeBaseName();
+    if (hash.size() != 40) {
+        return coverArtPath; // Not from a store
+    }
+
+    for (int thumbnailSize : thumbnailSizes()) {
+        if (thumbnailSize < size) {
+            continue;
+        }
+
+        const QString scaledPath = original.dir().filePath(scaledFileName(hash, thumbnailSize));
+        if (QFileInfo::exists(scaledPath)) {
+            return scaledPath;
+        }
+    }
+
+    return coverArtPath;
+}
+
+QString CoverArtStore::storePreview(const QString& coverArtPath, const QByteArray& gifBytes)
+{
+    const QFileInfo original(coverArtPath);
+    const QString hash = original.completeBaseName();
+    if (hash.size() != 40 || gifBytes.isEmpty()) {
+        return QString();
+    }
+
+    const QString path = original.dir().filePath(hash + "_preview.gif");
+    if (!writeFile(path, gifBytes)) {
+        qCWarning(coverArtStore) << "Failed to write preview:" << path;
+        return QString();
+    }
+    return path;
+}
+
+QString CoverArtStore::previewPath(const QString& coverArtPath)
+{
+    const QFileInfo original(coverArtPath);
+    const QString hash = original.completeBaseName();
+    if (hash.size() != 40) {
+        return QString();
+    }
+
+    const QString path = original.dir().filePath(hash + "_preview.gif");
+    return QFileInfo::exists(path) ? path : QString();
+}
+
+QString CoverArtStore::scaledFileName(const QString& hash, int size)
+{
+    return hash + QLatin1Char('_') + QString::number(size) + ".jpg";
+}
+
+} // namespace Data
+} // namespace EonPlay
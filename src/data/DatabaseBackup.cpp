@@ -0,0 +1,510 @@
+#include "data/DatabaseBackup.h"
+#include "data/ChunkStore.h"
+#include "security/AesGcm.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+#include <memory>
+#ifdef HAVE_SQLITE3
+#include <sqlite3.h>
+#else
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+Q_LOGGING_CATEGORY(databaseBackup, "eonplay.data.backup")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+
+constexpr int SNAPSHOT_PROGRESS = 70;               // The rest is writing the file
+constexpr qint64 STREAM_CHUNK_SIZE = 1024 * 1024;
+const char SNAPSHOT_SUFFIX[] = ".snapshot";
+const char RESTORE_SUFFIX[] = ".restore";
+const uchar ZSTD_FRAME_MAGIC[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+/**
+ * @brief Backups run one at a time on a low-priority thread of their own
+ */
+QThreadPool* backupPool()
+{
+    static QThreadPool* pool = [] {
+        auto* threadPool = new QThreadPool();
+        threadPool->setMaxThreadCount(1);
+        return threadPool;
+    }();
+    return pool;
+}
+
+#ifdef HAVE_SQLITE3
+/**
+ * @brief Closes a connection on scope exit
+ */
+struct Connection {
+    sqlite3* handle = nullptr;
+
+    ~Connection() { sqlite3_close(handle); }
+
+    bool open(const QString& path, int flags, QString* error)
+    {
+        if (sqlite3_open_v2(QFile::encodeName(path).constData(), &handle, flags, nullptr) != SQLITE_OK) {
+            *error = QString("Cannot open %1: %2").arg(path, QString::fromUtf8(sqlite3_errmsg(handle)));
+            return false;
+        }
+        sqlite3_busy_timeout(handle, DatabaseBackup::BUSY_TIMEOUT_MS);
+        return true;
+    }
+};
+#endif
+
+#ifdef HAVE_ZSTD
+bool decompressFile(const QString& sourcePath, const QString& targetPath, QString* error)
+{
+    QFile input(sourcePath);
+    QFile output(targetPath);
+    if (!input.open(QIODevice::ReadOnly) || !output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *error = QString("Cannot decompress %1").arg(sourcePath);
+        return false;
+    }
+
+    std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)> context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    QByteArray inBuffer(ZSTD_DStreamInSize(), Qt::Uninitialized);
+    QByteArray outBuffer(ZSTD_DStreamOutSize(), Qt::Uninitialized);
+    size_t frameRemaining = 0;
+
+    qint64 read;
+    while ((read = input.read(inBuffer.data(), inBuffer.size())) > 0) {
+        ZSTD_inBuffer in = { inBuffer.constData(), static_cast<size_t>(read), 0 };
+        while (in.pos < in.size) {
+            ZSTD_outBuffer out = { outBuffer.data(), static_cast<size_t>(outBuffer.size()), 0 };
+            frameRemaining = ZSTD_decompressStream(context.get(), &out, &in);
+            if (ZSTD_isError(frameRemaining)) {
+                *error = QString("Corrupt backup %1: %2").arg(sourcePath, ZSTD_getErrorName(frameRemaining));
+                return false;
+            }
+            if (output.write(outBuffer.constData(), out.pos) != static_cast<qint64>(out.pos)) {
+                *error = QString("Cannot write %1: %2").arg(targetPath, output.errorString());
+                return false;
+            }
+        }
+    }
+
+    // A non-zero hint means the last frame was cut off
+    if (read < 0 || frameRemaining != 0) {
+        *error = QString("Truncated backup %1").arg(sourcePath);
+        return false;
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+QFuture<DatabaseBackup::Result> DatabaseBackup::create(const QString& databasePath, const QString& backupPath,
+                                                       const Options& options)
+{
+    auto promise = std::make_shared<QPromise<Result>>();
+    QFuture<Result> future = promise->future();
+    promise->start();
+
+    backupPool()->start([promise, databasePath, backupPath, options]() {
+        // Backups compete with playback for disk and CPU; they are never urgent
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+        run(*promise, databasePath, backupPath, options);
+        promise->finish();
+    });
+    return future;
+}
+
+bool DatabaseBackup::restore(const QString& backupPath, const QString& databasePath, QString* error)
+{
+    QString message;
+    QString sourcePath = backupPath;
+    const QString restorePath = databasePath + RESTORE_SUFFIX;
+    bool success = true;
+
+    if (AesGcm::isEncryptedFile(backupPath)) {
+        message = "Encrypted backups must be decrypted before they are restored";
+        success = false;
+    } else if (ChunkStore::isManifest(backupPath)) {
+        QFile output(restorePath);
+        success = output.open(QIODevice::WriteOnly | QIODevice::Truncate)
+                  && ChunkStore::restore(backupPath, output, &message);
+        if (!output.isOpen()) {
+            message = QString("Cannot write %1").arg(restorePath);
+        }
+        sourcePath = restorePath;
+    } else if (isCompressed(backupPath)) {
+#ifdef HAVE_ZSTD
+        success = decompressFile(backupPath, restorePath, &message);
+        sourcePath = restorePath;
+#else
+        message = "Compressed backups cannot be restored without zstd support";
+        success = false;
+#endif
+    }
+
+    if (success) {
+#ifdef HAVE_SQLITE3
+        // Page copy into the database itself, so its WAL and locks stay consistent
+        Connection source;
+        Connection target;
+        success = source.open(sourcePath, SQLITE_OPEN_READONLY, &message)
+                  && target.open(databasePath, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, &message);
+        if (success) {
+            sqlite3_backup* backup = sqlite3_backup_init(target.handle, "main", source.handle, "main");
+            if (!backup) {
+                message = QString::fromUtf8(sqlite3_errmsg(target.handle));
+                success = false;
+            } else {
+                sqlite3_backup_step(backup, -1);
+                const int rc = sqlite3_backup_finish(backup);
+                if (rc != SQLITE_OK) {
+                    message = QString::fromUtf8(sqlite3_errstr(rc));
+                    success = false;
+                }
+            }
+        }
+#else
+        QFile::remove(databasePath);
+        QFile::remove(databasePath + "-wal");
+        QFile::remove(databasePath + "-shm");
+        success = QFile::copy(sourcePath, databasePath);
+        if (!success) {
+            message = QString("Cannot copy %1 to %2").arg(sourcePath, databasePath);
+        }
+#endif
+    }
+
+    QFile::remove(restorePath);
+
+    if (!success) {
+        qCWarning(databaseBackup) << "Restore from" << backupPath << "failed:" << message;
+        if (error) {
+            *error = message;
+        }
+        return false;
+    }
+
+    qCInfo(databaseBackup) << "Database restored from" << backupPath;
+    return true;
+}
+
+QString DatabaseBackup::fileChecksum(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!hash.addData(&file)) {
+        return QString();
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+bool DatabaseBackup::isCompressionAvailable()
+{
+#ifdef HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool DatabaseBackup::isCompressed(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray magic = file.read(sizeof(ZSTD_FRAME_MAGIC));
+    return magic == QByteArray::fromRawData(reinterpret_cast<const char*>(ZSTD_FRAME_MAGIC), sizeof(ZSTD_FRAME_MAGIC));
+}
+
+void DatabaseBackup::run(QPromise<Result>& promise, const QString& databasePath, const QString& backupPath,
+                         const Options& options)
+{
+    QElapsedTimer timer;
+    timer.start();
+    promise.setProgressRange(0, 100);
+
+    Result result;
+    result.compressed = options.compress && isCompressionAvailable();
+    if (!options.chunkStore.isEmpty()) {
+        result.filePath = backupPath + ChunkStore::MANIFEST_SUFFIX;
+    } else {
+        result.filePath = result.compressed ? backupPath + COMPRESSED_SUFFIX : backupPath;
+    }
+    QDir().mkpath(QFileInfo(result.filePath).absolutePath());
+
+    const QString snapshotPath = result.filePath + SNAPSHOT_SUFFIX;
+    QFile::remove(snapshotPath);
+
+    if (snapshot(promise, databasePath, snapshotPath, options, &result.error)) {
+        result.success = writeBackup(promise, snapshotPath, result, options);
+    }
+    QFile::remove(snapshotPath);
+
+    if (result.success && !options.encryptionKey.isEmpty() && options.chunkStore.isEmpty()) {
+        result.success = encryptBackup(result, options);
+    }
+
+    if (result.success) {
+        promise.setProgressValue(100);
+        qCInfo(databaseBackup) << "Backed up" << result.databaseSize << "bytes to" << result.filePath
+                               << "in" << timer.elapsed() << "ms";
+    } else {
+        qCWarning(databaseBackup) << "Backup of" << databasePath << "failed:" << result.error;
+    }
+    promise.addResult(result);
+}
+
+bool DatabaseBackup::encryptBackup(Result& result, const Options& options)
+{
+    const AesGcm cipher(options.encryptionKey);
+    if (!cipher.isValid()) {
+        QFile::remove(result.filePath);
+        result.error = "Invalid backup encryption key";
+        return false;
+    }
+
+    // The checksum becomes that of the encrypted file, which is what is kept
+    const QString encryptedPath = result.filePath + ENCRYPTED_SUFFIX;
+    const bool encrypted = cipher.encryptFile(result.filePath, encryptedPath, options.encryptionHeader,
+                                              &result.checksum, &result.error);
+    QFile::remove(result.filePath);
+    if (!encrypted) {
+        return false;
+    }
+
+    result.filePath = encryptedPath;
+    result.fileSize = QFileInfo(encryptedPath).size();
+    result.encrypted = true;
+    return true;
+}
+
+bool DatabaseBackup::snapshot(QPromise<Result>& promise, const QString& databasePath, const QString& snapshotPath,
+                              const Options& options, QString* error)
+{
+#ifdef HAVE_SQLITE3
+    Connection source;
+    Connection target;
+    if (!source.open(databasePath, SQLITE_OPEN_READONLY, error)
+        || !target.open(snapshotPath, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, error)) {
+        return false;
+    }
+
+    // One WAL snapshot for the whole copy: commits of other connections neither
+    // wait for it nor restart it, which they would between steps otherwise
+    if (sqlite3_exec(source.handle, "BEGIN; SELECT count(*) FROM sqlite_master;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        *error = QString::fromUtf8(sqlite3_errmsg(source.handle));
+        return false;
+    }
+
+    sqlite3_backup* backup = sqlite3_backup_init(target.handle, "main", source.handle, "main");
+    if (!backup) {
+        *error = QString::fromUtf8(sqlite3_errmsg(target.handle));
+        return false;
+    }
+
+    const int pagesPerStep = qMax(1, options.pagesPerStep);
+    int rc = SQLITE_OK;
+    while (!promise.isCanceled()) {
+        rc = sqlite3_backup_step(backup, pagesPerStep);
+        const int pageCount = sqlite3_backup_pagecount(backup);
+        if (pageCount > 0) {
+            promise.setProgressValue(SNAPSHOT_PROGRESS * (pageCount - sqlite3_backup_remaining(backup)) / pageCount);
+        }
+        if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) {
+            break;
+        }
+        if (options.stepPauseMs > 0) {
+            QThread::msleep(options.stepPauseMs);
+        }
+    }
+    sqlite3_backup_finish(backup);
+    sqlite3_exec(source.handle, "COMMIT", nullptr, nullptr, nullptr);
+
+    if (rc != SQLITE_DONE) {
+        *error = promise.isCanceled() ? QString("Backup cancelled") : QString::fromUtf8(sqlite3_errstr(rc));
+        return false;
+    }
+    return true;
+#else
+    Q_UNUSED(options);
+
+    // A read transaction as well, but the whole snapshot is written in one statement
+    const QString connectionName = QString("EonPlayBackup-%1").arg(reinterpret_cast<quintptr>(&promise), 0, 16);
+    bool success = false;
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        database.setDatabaseName(databasePath);
+        database.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(BUSY_TIMEOUT_MS));
+        if (!database.open()) {
+            *error = database.lastError().text();
+        } else {
+            QSqlQuery query(database);
+            query.prepare("VACUUM INTO ?");
+            query.addBindValue(snapshotPath);
+            success = query.exec();
+            if (!success) {
+                *error = query.lastError().text();
+            }
+        }
+        database.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    if (success) {
+        promise.setProgressValue(SNAPSHOT_PROGRESS);
+    }
+    return success && !promise.isCanceled();
+#endif
+}
+
+bool DatabaseBackup::writeBackup(QPromise<Result>& promise, const QString& snapshotPath, Result& result,
+                                 const Options& options)
+{
+    QFile input(snapshotPath);
+    if (!input.open(QIODevice::ReadOnly)) {
+        result.error = QString("Cannot read snapshot %1").arg(snapshotPath);
+        return false;
+    }
+    result.databaseSize = input.size();
+
+    qint64 consumed = 0;
+    const auto reportProgress = [&]() {
+        if (result.databaseSize > 0) {
+            promise.setProgressValue(SNAPSHOT_PROGRESS
+                                     + static_cast<int>((100 - SNAPSHOT_PROGRESS) * consumed / result.databaseSize));
+        }
+    };
+
+    if (!options.chunkStore.isEmpty()) {
+        // Only chunks no earlier backup has are written
+        ChunkStore store(options.chunkStore);
+        const ChunkStore::StoreResult stored = store.store(input, result.filePath, result.compressed,
+                                                           options.compressionLevel, [&](qint64 bytes) {
+            consumed = bytes;
+            reportProgress();
+            return !promise.isCanceled();
+        });
+        if (!stored.success) {
+            result.error = stored.error;
+            return false;
+        }
+        result.fileSize = stored.storedBytes;
+        result.checksum = stored.checksum;
+        qCInfo(databaseBackup) << "Chunked backup:" << stored.newChunks << "of" << stored.chunkCount << "chunks new";
+        return true;
+    }
+
+    // The checksum covers the bytes of the backup file as they are produced
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    QByteArray buffer(STREAM_CHUNK_SIZE, Qt::Uninitialized);
+
+    if (!result.compressed) {
+        // The snapshot becomes the backup; one read for the checksum, no second copy
+        qint64 read;
+        while ((read = input.read(buffer.data(), buffer.size())) > 0) {
+            hash.addData(QByteArrayView(buffer.constData(), read));
+            consumed += read;
+            reportProgress();
+            if (promise.isCanceled()) {
+                result.error = "Backup cancelled";
+                return false;
+            }
+        }
+        input.close();
+        if (read < 0) {
+            result.error = QString("Cannot read snapshot %1").arg(snapshotPath);
+            return false;
+        }
+
+        QFile::remove(result.filePath);
+        if (!QFile::rename(snapshotPath, result.filePath)) {
+            result.error = QString("Cannot write %1").arg(result.filePath);
+            return false;
+        }
+        result.fileSize = result.databaseSize;
+        result.checksum = QString::fromLatin1(hash.result().toHex());
+        return true;
+    }
+
+#ifdef HAVE_ZSTD
+    QSaveFile output(result.filePath);
+    if (!output.open(QIODevice::WriteOnly)) {
+        result.error = QString("Cannot write %1: %2").arg(result.filePath, output.errorString());
+        return false;
+    }
+
+    std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> context(ZSTD_createCCtx(), ZSTD_freeCCtx);
+    ZSTD_CCtx_setParameter(context.get(), ZSTD_c_compressionLevel, options.compressionLevel);
+    ZSTD_CCtx_setParameter(context.get(), ZSTD_c_checksumFlag, 1);
+    ZSTD_CCtx_setPledgedSrcSize(context.get(), static_cast<unsigned long long>(result.databaseSize));
+    QByteArray outBuffer(ZSTD_CStreamOutSize(), Qt::Uninitialized);
+
+    bool last = false;
+    while (!last) {
+        const qint64 read = input.read(buffer.data(), buffer.size());
+        if (read < 0) {
+            result.error = QString("Cannot read snapshot %1").arg(snapshotPath);
+            return false;
+        }
+        last = input.atEnd();
+
+        ZSTD_inBuffer in = { buffer.constData(), static_cast<size_t>(read), 0 };
+        bool flushed = false;
+        while (!flushed) {
+            ZSTD_outBuffer out = { outBuffer.data(), static_cast<size_t>(outBuffer.size()), 0 };
+            const size_t remaining = ZSTD_compressStream2(context.get(), &out, &in, last ? ZSTD_e_end : ZSTD_e_continue);
+            if (ZSTD_isError(remaining)) {
+                result.error = QString("Compression failed: %1").arg(ZSTD_getErrorName(remaining));
+                return false;
+            }
+            if (output.write(outBuffer.constData(), out.pos) != static_cast<qint64>(out.pos)) {
+                result.error = QString("Cannot write %1: %2").arg(result.filePath, output.errorString());
+                return false;
+            }
+            hash.addData(QByteArrayView(outBuffer.constData(), static_cast<qsizetype>(out.pos)));
+            result.fileSize += static_cast<qint64>(out.pos);
+            flushed = last ? remaining == 0 : in.pos == in.size;
+        }
+
+        consumed += read;
+        reportProgress();
+        if (promise.isCanceled()) {
+            result.error = "Backup cancelled";
+            return false;
+        }
+    }
+
+    if (!output.commit()) {
+        result.error = QString("Cannot write %1: %2").arg(result.filePath, output.errorString());
+        return false;
+    }
+    result.checksum = QString::fromLatin1(hash.result().toHex());
+    return true;
+#else
+    Q_UNUSED(options);
+    result.error = "Compression is not available";
+    return false;
+#endif
+}
+
+} // namespace Data
+} // namespace EonPlay
@@ -1,4 +1,5 @@
 #include "data/DatabaseManager.h"
+#include "TraceLog.h"
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
@@ -8,7 +9,13 @@
 #include <QLoggingCategory>
 #include <QMutexLocker>
 #include <QFile>
+#include <QRegularExpression>
+#include <QSqlDriver>
+#include <QTimer>
 #include <QDebug>
+#ifdef HAVE_SQLITE3
+#include <sqlite3.h>
+#endif
 
 Q_LOGGING_CATEGORY(dbManager, "eonplay.database")
 
@@ -17,9 +24,93 @@ namespace Data {
 
 const QString DatabaseManager::DATABASE_CONNECTION_NAME = "EonPlayDatabase";
 
+namespace {
+
+/**
+ * @brief How one facet of library_aggregates is derived from a media_files row
+ *
+ * %1 stands for the row: NEW or OLD inside triggers, media_files when
+ * rebuilding. The extension is what follows the last '.' of the path.
+ */
+struct FacetColumn {
+    DatabaseManager::Facet facet;
+    const char* value;
+    const char* condition;
+};
+
+const FacetColumn FACET_COLUMNS[] = {
+    { DatabaseManager::LibraryFacet, "''", "1" },
+    { DatabaseManager::ArtistFacet, "%1.artist", "COALESCE(%1.artist, '') != ''" },
+    { DatabaseManager::AlbumFacet, "%1.album", "COALESCE(%1.album, '') != ''" },
+    { DatabaseManager::GenreFacet, "%1.genre", "COALESCE(%1.genre, '') != ''" },
+    { DatabaseManager::ExtensionFacet,
+      "lower(replace(%1.file_path, rtrim(%1.file_path, replace(%1.file_path, '.', '')), ''))",
+      "instr(%1.file_path, '.') > 0" }
+};
+
+// Trigger statements adding a row to, or taking it out of, every facet
+QString addToAggregates(const QString& row)
+{
+    QString statements;
+    for (const FacetColumn& column : FACET_COLUMNS) {
+        statements += QString(R"(
+            INSERT INTO library_aggregates (facet, value, file_count, total_size, total_duration)
+            SELECT '%1', %2, 1, COALESCE(%4.file_size, 0), COALESCE(%4.duration, 0)
+            WHERE %3
+            ON CONFLICT (facet, value) DO UPDATE SET
+                file_count = file_count + 1,
+                total_size = total_size + excluded.total_size,
+                total_duration = total_duration + excluded.total_duration;)")
+            .arg(DatabaseManager::facetName(column.facet),
+                 QString::fromLatin1(column.value).arg(row),
+                 QString::fromLatin1(column.condition).arg(row), row);
+    }
+    return statements;
+}
+
+QString removeFromAggregates(const QString& row)
+{
+    // Rows that never matched a facet's condition have no value row to hit
+    QString statements;
+    for (const FacetColumn& column : FACET_COLUMNS) {
+        statements += QString(R"(
+            UPDATE library_aggregates SET
+                file_count = file_count - 1,
+                total_size = total_size - COALESCE(%3.file_size, 0),
+                total_duration = total_duration - COALESCE(%3.duration, 0)
+            WHERE facet = '%1' AND value = %2;)")
+            .arg(DatabaseManager::facetName(column.facet),
+                 QString::fromLatin1(column.value).arg(row), row);
+    }
+    statements += "\n            DELETE FROM library_aggregates WHERE file_count <= 0;";
+    return statements;
+}
+
+// Whether every statement of the main connection can be traced, or only executeQuery()
+#ifdef HAVE_SQLITE3
+constexpr bool STATEMENT_TRACING = true;
+#else
+constexpr bool STATEMENT_TRACING = false;
+#endif
+
+} // namespace
+
 DatabaseManager::DatabaseManager(QObject* parent)
     : QObject(parent)
     , m_initialized(false)
+    , m_bulkActive(false)
+    , m_bulkCommitRows(DEFAULT_BULK_COMMIT_ROWS)
+    , m_bulkCommitIntervalMs(DEFAULT_BULK_COMMIT_INTERVAL_MS)
+    , m_lastInsertRowId(0)
+    , m_executor(std::make_unique<QueryExecutor>())
+    , m_mediaFileCache(std::make_unique<MediaFileCache>())
+    , m_searchIndexAvailable(false)
+    , m_subtitleSearchAvailable(false)
+    , m_statementCache(STATEMENT_CACHE_SIZE)
+    , m_statementResetPending(false)
+    , m_profiling(false)
+    , m_explaining(false)
+    , m_slowQueryMs(DEFAULT_SLOW_QUERY_MS)
 {
 }
 
@@ -65,6 +156,15 @@ bool DatabaseManager::initialize(const QString& databasePath)
         return false;
     }
 
+    m_searchIndexAvailable = tableExists("media_search");
+    if (!m_searchIndexAvailable) {
+        qCWarning(dbManager) << "Full-text search index unavailable, searches will scan the table";
+    }
+    m_subtitleSearchAvailable = tableExists("subtitle_search");
+
+    // Started after migration, so its connections see the final schema
+    m_executor->open(m_databasePath);
+
     m_initialized = true;
     qCInfo(dbManager) << "Database initialized successfully:" << m_databasePath;
     return true;
@@ -75,10 +175,29 @@ void DatabaseManager::shutdown()
     QMutexLocker locker(&m_mutex);
     
     if (m_initialized) {
+        m_executor->close();
+        
+        if (m_bulkActive) {
+            commitBulkLocked();
+            m_bulkActive = false;
+        }
+        m_upsertQuery = QSqlQuery();
+        m_journalFileQuery = QSqlQuery();
+        m_hashUpdateQuery = QSqlQuery();
+        m_loudnessUpdateQuery = QSqlQuery();
+        m_beatGridUpdateQuery = QSqlQuery();
+        m_fingerprintStoreQuery = QSqlQuery();
+        m_acousticStoreQuery = QSqlQuery();
+        m_acousticHashDeleteQuery = QSqlQuery();
+        m_acousticHashInsertQuery = QSqlQuery();
+        m_searchIdsQuery = QSqlQuery();
+        m_statementCache.clear();
+        
         if (m_database.isOpen()) {
             m_database.close();
         }
         QSqlDatabase::removeDatabase(DATABASE_CONNECTION_NAME);
+        m_mediaFileCache->clear();
         m_initialized = false;
         qCInfo(dbManager) << "Database shutdown complete";
     }
@@ -86,6 +205,8 @@ void DatabaseManager::shutdown()
 
 bool DatabaseManager::setupDatabase()
 {
+    TraceScope trace("db.open");
+
     // Remove existing connection if it exists
     if (QSqlDatabase::contains(DATABASE_CONNECTION_NAME)) {
         QSqlDatabase::removeDatabase(DATABASE_CONNECTION_NAME);
@@ -115,11 +236,22 @@ bool DatabaseManager::setupDatabase()
         qCWarning(dbManager) << "Failed to set WAL mode:" << pragmaQuery.lastError().text();
     }
 
+    // Opt-in query profiling for diagnosing slow libraries
+    bool slowQueryMsValid = false;
+    const int slowQueryMs = qEnvironmentVariableIntValue("EONPLAY_DB_SLOW_QUERY_MS", &slowQueryMsValid);
+    if (slowQueryMsValid) {
+        setQueryProfiling(true, slowQueryMs);
+    } else {
+        installProfiler();
+    }
+
     return true;
 }
 
 bool DatabaseManager::createSchema()
 {
+    TraceScope trace("db.schema");
+
     // Check if schema already exists
     if (tableExists("media_files")) {
         return true;
@@ -176,7 +308,21 @@ bool DatabaseManager::createTables()
             play_count INTEGER DEFAULT 0,
             rating INTEGER DEFAULT 0,
             cover_art_path TEXT,
-            metadata_hash TEXT
+            metadata_hash TEXT,
+            sample_hash TEXT,
+            content_hash TEXT,
+            hash_file_size INTEGER,
+            hash_modified_time INTEGER,
+            loudness REAL,
+            loudness_histogram BLOB,
+            loudness_file_size INTEGER,
+            track_gain REAL,
+            track_peak REAL,
+            album_gain REAL,
+            album_peak REAL,
+            tempo_bpm REAL,
+            beat_offset_ms REAL,
+            beat_confidence REAL
         )
         )",
 
@@ -215,24 +361,374 @@ bool DatabaseManager::createTables()
         }
     }
 
+    if (!createScanJournalTables()) {
+        return false;
+    }
+
+    if (!createAggregateTable()) {
+        return false;
+    }
+
+    if (!createContentVerdictTable()) {
+        return false;
+    }
+
+    if (!createSubtitleIndexTables()) {
+        return false;
+    }
+
+    if (!createVideoFingerprintTable()) {
+        return false;
+    }
+
+    if (!createAcousticFingerprintTables()) {
+        return false;
+    }
+
+    // Searching still works without the index, only slower
+    if (!createSearchIndex()) {
+        qCWarning(dbManager) << "Failed to create search index:" << lastSqlError().text();
+    }
+
+    return true;
+}
+
+bool DatabaseManager::createScanJournalTables()
+{
+    QStringList journalQueries = {
+        // Directories as of their last complete scan
+        R"(
+        CREATE TABLE IF NOT EXISTS scan_journal_directories (
+            path TEXT PRIMARY KEY,
+            parent_path TEXT,
+            modified_time INTEGER NOT NULL
+        ) WITHOUT ROWID
+        )",
+
+        // Files as of their last successful library write
+        R"(
+        CREATE TABLE IF NOT EXISTS scan_journal_files (
+            file_path TEXT PRIMARY KEY,
+            directory_path TEXT NOT NULL,
+            file_size INTEGER NOT NULL,
+            modified_time INTEGER NOT NULL,
+            inode INTEGER NOT NULL DEFAULT 0
+        ) WITHOUT ROWID
+        )",
+
+        "CREATE INDEX IF NOT EXISTS idx_scan_journal_files_directory ON scan_journal_files(directory_path)",
+
+        // Files removed from the library are rescanned when they reappear
+        R"(
+        CREATE TRIGGER IF NOT EXISTS remove_scan_journal_file
+        AFTER DELETE ON media_files
+        BEGIN
+            DELETE FROM scan_journal_files WHERE file_path = OLD.file_path;
+        END
+        )"
+    };
+
+    for (const QString& query : journalQueries) {
+        if (!executeQuery(query)) {
+            m_lastError = QString("Failed to create scan journal: %1").arg(lastSqlError().text());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DatabaseManager::createSearchIndex()
+{
+    // External content table: the text lives in media_files only and the
+    // index is kept in sync by the triggers in createTriggers(). Prefix
+    // indexes make the "word*" queries of search-as-you-type index lookups.
+    return executeQuery(R"(
+        CREATE VIRTUAL TABLE IF NOT EXISTS media_search USING fts5(
+            title, artist, album, file_path,
+            content = 'media_files',
+            content_rowid = 'id',
+            prefix = '1 2 3',
+            tokenize = 'unicode61 remove_diacritics 2'
+        )
+    )");
+}
+
+bool DatabaseManager::createSubtitleIndexTables()
+{
+    const QStringList subtitleQueries = {
+        // One row per indexed subtitle file, modified_time decides reindexing
+        R"(
+        CREATE TABLE IF NOT EXISTS subtitle_sources (
+            id INTEGER PRIMARY KEY,
+            media_file_id INTEGER NOT NULL,
+            source_path TEXT UNIQUE NOT NULL,
+            generated INTEGER NOT NULL DEFAULT 0,
+            modified_time INTEGER NOT NULL,
+            cue_count INTEGER NOT NULL DEFAULT 0
+        )
+        )",
+
+        R"(
+        CREATE TABLE IF NOT EXISTS subtitle_cues (
+            id INTEGER PRIMARY KEY,
+            source_id INTEGER NOT NULL,
+            start_ms INTEGER NOT NULL,
+            end_ms INTEGER NOT NULL,
+            text TEXT NOT NULL
+        )
+        )",
+
+        "CREATE INDEX IF NOT EXISTS idx_subtitle_sources_media ON subtitle_sources(media_file_id)",
+        "CREATE INDEX IF NOT EXISTS idx_subtitle_cues_source ON subtitle_cues(source_id)",
+
+        R"(
+        CREATE TRIGGER IF NOT EXISTS remove_subtitle_sources
+        AFTER DELETE ON media_files
+        BEGIN
+            DELETE FROM subtitle_sources WHERE media_file_id = OLD.id;
+        END
+        )",
+
+        R"(
+        CREATE TRIGGER IF NOT EXISTS remove_subtitle_cues
+        AFTER DELETE ON subtitle_sources
+        BEGIN
+            DELETE FROM subtitle_cues WHERE source_id = OLD.id;
+        END
+        )"
+    };
+
+    for (const QString& query : subtitleQueries) {
+        if (!executeQuery(query)) {
+            m_lastError = QString("Failed to create subtitle index: %1").arg(lastSqlError().text());
+            return false;
+        }
+    }
+
+    // Cues are only ever inserted and deleted, so two triggers keep the
+    // external content index in sync
+    const bool indexed = executeQuery(R"(
+        CREATE VIRTUAL TABLE IF NOT EXISTS subtitle_search USING fts5(
+            text,
+            content = 'subtitle_cues',
+            content_rowid = 'id',
+            prefix = '2 3',
+            tokenize = 'unicode61 remove_diacritics 2'
+        )
+    )");
+    if (!indexed) {
+        qCWarning(dbManager) << "FTS5 unavailable, subtitle search will scan cues:" << lastSqlError().text();
+        return true;
+    }
+
+    return executeQuery(R"(
+        CREATE TRIGGER IF NOT EXISTS subtitle_search_insert
+        AFTER INSERT ON subtitle_cues
+        BEGIN
+            INSERT INTO subtitle_search(rowid, text) VALUES (NEW.id, NEW.text);
+        END
+    )") && executeQuery(R"(
+        CREATE TRIGGER IF NOT EXISTS subtitle_search_delete
+        AFTER DELETE ON subtitle_cues
+        BEGIN
+            INSERT INTO subtitle_search(subtitle_search, rowid, text) VALUES ('delete', OLD.id, OLD.text);
+        END
+    )");
+}
+
+bool DatabaseManager::createAggregateTable()
+{
+    if (!executeQuery(R"(
+        CREATE TABLE IF NOT EXISTS library_aggregates (
+            facet TEXT NOT NULL,
+            value TEXT NOT NULL,
+            file_count INTEGER NOT NULL DEFAULT 0,
+            total_size INTEGER NOT NULL DEFAULT 0,
+            total_duration INTEGER NOT NULL DEFAULT 0,
+            PRIMARY KEY (facet, value)
+        ) WITHOUT ROWID
+    )")) {
+        m_lastError = QString("Failed to create aggregate table: %1").arg(lastSqlError().text());
+        return false;
+    }
+
+    return true;
+}
+
+bool DatabaseManager::createContentVerdictTable()
+{
+    QStringList verdictQueries = {
+        // Parental control verdict of every file for each restricted profile,
+        // written by ParentalControlManager; 0 means allowed
+        R"(
+        CREATE TABLE IF NOT EXISTS content_verdicts (
+            profile_id TEXT NOT NULL,
+            media_file_id INTEGER NOT NULL,
+            verdict INTEGER NOT NULL,
+            PRIMARY KEY (profile_id, media_file_id)
+        ) WITHOUT ROWID
+        )",
+
+        R"(
+        CREATE TRIGGER IF NOT EXISTS remove_content_verdicts
+        AFTER DELETE ON media_files
+        BEGIN
+            DELETE FROM content_verdicts WHERE media_file_id = OLD.id;
+        END
+        )"
+    };
+
+    for (const QString& query : verdictQueries) {
+        if (!executeQuery(query)) {
+            m_lastError = QString("Failed to create content verdict table: %1").arg(lastSqlError().text());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DatabaseManager::createVideoFingerprintTable()
+{
+    QStringList fingerprintQueries = {
+        // Sampled frame hashes of a video, written by MediaScanner; kept out
+        // of media_files so browsing never reads the blobs
+        R"(
+        CREATE TABLE IF NOT EXISTS video_fingerprints (
+            media_file_id INTEGER PRIMARY KEY,
+            file_size INTEGER NOT NULL,
+            modified_time INTEGER NOT NULL,
+            fingerprint BLOB NOT NULL
+        ) WITHOUT ROWID
+        )",
+
+        R"(
+        CREATE TRIGGER IF NOT EXISTS remove_video_fingerprints
+        AFTER DELETE ON media_files
+        BEGIN
+            DELETE FROM video_fingerprints WHERE media_file_id = OLD.id;
+        END
+        )"
+    };
+
+    for (const QString& query : fingerprintQueries) {
+        if (!executeQuery(query)) {
+            m_lastError = QString("Failed to create video fingerprint table: %1").arg(lastSqlError().text());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DatabaseManager::createAcousticFingerprintTables()
+{
+    QStringList acousticQueries = {
+        // Chromaprint fingerprints, written by AcousticIndexer
+        R"(
+        CREATE TABLE IF NOT EXISTS acoustic_fingerprints (
+            media_file_id INTEGER PRIMARY KEY,
+            file_size INTEGER NOT NULL,
+            fingerprint BLOB
+        ) WITHOUT ROWID
+        )",
+
+        // Inverted index: which files contain a sub-hash, and where first
+        R"(
+        CREATE TABLE IF NOT EXISTS acoustic_hashes (
+            sub_hash INTEGER NOT NULL,
+            media_file_id INTEGER NOT NULL,
+            position INTEGER NOT NULL,
+            PRIMARY KEY (sub_hash, media_file_id)
+        ) WITHOUT ROWID
+        )",
+
+        "CREATE INDEX IF NOT EXISTS idx_acoustic_hashes_file ON acoustic_hashes(media_file_id)",
+
+        R"(
+        CREATE TRIGGER IF NOT EXISTS remove_acoustic_fingerprints
+        AFTER DELETE ON media_files
+        BEGIN
+            DELETE FROM acoustic_fingerprints WHERE media_file_id = OLD.id;
+            DELETE FROM acoustic_hashes WHERE media_file_id = OLD.id;
+        END
+        )"
+    };
+
+    for (const QString& query : acousticQueries) {
+        if (!executeQuery(query)) {
+            m_lastError = QString("Failed to create acoustic fingerprint tables: %1").arg(lastSqlError().text());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DatabaseManager::rebuildAggregates()
+{
+    const QStringList queries = aggregateRebuildQueries();
+    for (const QString& query : queries) {
+        if (!executeQuery(query)) {
+            return false;
+        }
+    }
+
     return true;
 }
 
+QStringList DatabaseManager::aggregateRebuildQueries()
+{
+    QStringList queries = { "DELETE FROM library_aggregates" };
+
+    for (const FacetColumn& column : FACET_COLUMNS) {
+        queries << QString(R"(
+            INSERT INTO library_aggregates (facet, value, file_count, total_size, total_duration)
+            SELECT '%1', %2, COUNT(*), COALESCE(SUM(file_size), 0), COALESCE(SUM(duration), 0)
+            FROM media_files
+            WHERE %3
+            GROUP BY 2
+        )").arg(facetName(column.facet),
+                QString::fromLatin1(column.value).arg("media_files"),
+                QString::fromLatin1(column.condition).arg("media_files"));
+    }
+
+    return queries;
+}
+
+QString DatabaseManager::facetName(Facet facet)
+{
+    switch (facet) {
+        case LibraryFacet:
+            return QStringLiteral("library");
+        case ArtistFacet:
+            return QStringLiteral("artist");
+        case AlbumFacet:
+            return QStringLiteral("album");
+        case GenreFacet:
+            return QStringLiteral("genre");
+        case ExtensionFacet:
+            return QStringLiteral("extension");
+    }
+    return QString();
+}
+
 bool DatabaseManager::createIndexes()
 {
     QStringList indexQueries = {
         "CREATE INDEX IF NOT EXISTS idx_media_files_path ON media_files(file_path)",
         "CREATE INDEX IF NOT EXISTS idx_media_files_title ON media_files(title)",
-        "CREATE INDEX IF NOT EXISTS idx_media_files_artist ON media_files(artist)",
-        "CREATE INDEX IF NOT EXISTS idx_media_files_album ON media_files(album)",
-        "CREATE INDEX IF NOT EXISTS idx_media_files_genre ON media_files(genre)",
         "CREATE INDEX IF NOT EXISTS idx_media_files_date_added ON media_files(date_added)",
         "CREATE INDEX IF NOT EXISTS idx_media_files_last_played ON media_files(last_played)",
+        "CREATE INDEX IF NOT EXISTS idx_media_files_file_size ON media_files(file_size)",
         "CREATE INDEX IF NOT EXISTS idx_playlist_items_playlist ON playlist_items(playlist_id)",
         "CREATE INDEX IF NOT EXISTS idx_playlist_items_media ON playlist_items(media_file_id)",
         "CREATE INDEX IF NOT EXISTS idx_playlist_items_position ON playlist_items(playlist_id, position)"
     };
 
+    indexQueries += browseIndexQueries();
+
     for (const QString& query : indexQueries) {
         if (!executeQuery(query)) {
             qCWarning(dbManager) << "Failed to create index:" << lastSqlError().text();
@@ -243,6 +739,26 @@ bool DatabaseManager::createIndexes()
     return true;
 }
 
+QStringList DatabaseManager::browseIndexQueries()
+{
+    // Each browse query finds its rows and reads them in order from one
+    // index, so none sorts; the partial indexes only hold the rows their
+    // smart playlists select, and their conditions match those playlists'
+    // clauses word for word, which is how SQLite picks them
+    return {
+        "CREATE INDEX IF NOT EXISTS idx_media_files_artist_browse "
+        "ON media_files(artist, album, track_number, title)",
+        "CREATE INDEX IF NOT EXISTS idx_media_files_album_browse "
+        "ON media_files(album, track_number, title)",
+        "CREATE INDEX IF NOT EXISTS idx_media_files_genre_browse "
+        "ON media_files(genre, artist, album, title)",
+        "CREATE INDEX IF NOT EXISTS idx_media_files_played "
+        "ON media_files(play_count) WHERE play_count > 0",
+        "CREATE INDEX IF NOT EXISTS idx_media_files_never_played "
+        "ON media_files(date_added) WHERE (play_count = 0 OR play_count IS NULL)"
+    };
+}
+
 bool DatabaseManager::createTriggers()
 {
     QStringList triggerQueries = {
@@ -289,6 +805,65 @@ bool DatabaseManager::createTriggers()
         )"
     };
 
+    // Aggregates follow every row change, so the statistics never scan
+    // media_files; the table only exists from schema version 5 on
+    if (tableExists("library_aggregates")) {
+        triggerQueries << QString(R"(
+        CREATE TRIGGER IF NOT EXISTS library_aggregates_insert
+        AFTER INSERT ON media_files
+        BEGIN%1
+        END
+        )").arg(addToAggregates("NEW"));
+
+        triggerQueries << QString(R"(
+        CREATE TRIGGER IF NOT EXISTS library_aggregates_delete
+        AFTER DELETE ON media_files
+        BEGIN%1
+        END
+        )").arg(removeFromAggregates("OLD"));
+
+        triggerQueries << QString(R"(
+        CREATE TRIGGER IF NOT EXISTS library_aggregates_update
+        AFTER UPDATE OF file_path, artist, album, genre, file_size, duration ON media_files
+        BEGIN%1%2
+        END
+        )").arg(removeFromAggregates("OLD"), addToAggregates("NEW"));
+    }
+
+    // Triggers on a missing index would make every write to media_files fail
+    if (tableExists("media_search")) {
+        triggerQueries << R"(
+        CREATE TRIGGER IF NOT EXISTS media_search_insert
+        AFTER INSERT ON media_files
+        BEGIN
+            INSERT INTO media_search(rowid, title, artist, album, file_path)
+            VALUES (NEW.id, NEW.title, NEW.artist, NEW.album, NEW.file_path);
+        END
+        )";
+
+        triggerQueries << R"(
+        CREATE TRIGGER IF NOT EXISTS media_search_delete
+        AFTER DELETE ON media_files
+        BEGIN
+            INSERT INTO media_search(media_search, rowid, title, artist, album, file_path)
+            VALUES ('delete', OLD.id, OLD.title, OLD.artist, OLD.album, OLD.file_path);
+        END
+        )";
+
+        // Limited to the indexed columns, so play counts and the
+        // date_modified trigger above do not reindex the row
+        triggerQueries << R"(
+        CREATE TRIGGER IF NOT EXISTS media_search_update
+        AFTER UPDATE OF title, artist, album, file_path ON media_files
+        BEGIN
+            INSERT INTO media_search(media_search, rowid, title, artist, album, file_path)
+            VALUES ('delete', OLD.id, OLD.title, OLD.artist, OLD.album, OLD.file_path);
+            INSERT INTO media_search(rowid, title, artist, album, file_path)
+            VALUES (NEW.id, NEW.title, NEW.artist, NEW.album, NEW.file_path);
+        END
+        )";
+    }
+
     for (const QString& query : triggerQueries) {
         if (!executeQuery(query)) {
             qCWarning(dbManager) << "Failed to create trigger:" << lastSqlError().text();
@@ -301,6 +876,8 @@ bool DatabaseManager::createTriggers()
 
 bool DatabaseManager::migrateDatabase()
 {
+    TraceScope trace("db.migrate");
+
     int currentVersion = getCurrentSchemaVersion();
     
     if (currentVersion == CURRENT_SCHEMA_VERSION) {
@@ -331,6 +908,36 @@ bool DatabaseManager::migrateDatabase()
             case 3:
                 migrationSuccess = migrateToVersion3();
                 break;
+            case 4:
+                migrationSuccess = migrateToVersion4();
+                break;
+            case 5:
+                migrationSuccess = migrateToVersion5();
+                break;
+            case 6:
+                migrationSuccess = migrateToVersion6();
+                break;
+            case 7:
+                migrationSuccess = migrateToVersion7();
+                break;
+            case 8:
+                migrationSuccess = migrateToVersion8();
+                break;
+            case 9:
+                migrationSuccess = migrateToVersion9();
+                break;
+            case 10:
+                migrationSuccess = migrateToVersion10();
+                break;
+            case 11:
+                migrationSuccess = migrateToVersion11();
+                break;
+            case 12:
+                migrationSuccess = migrateToVersion12();
+                break;
+            case 13:
+                migrationSuccess = migrateToVersion13();
+                break;
             // Add more migration cases as needed
             default:
                 m_lastError = QString("Unknown migration version: %1").arg(version);
@@ -413,6 +1020,15 @@ bool DatabaseManager::updateMediaFile(int id, const QString& title, const QStrin
     
     if (executeQuery(query, params)) {
         emit mediaFileUpdated(id);
+        
+        // Cache receivers may query the database, so they run without the lock
+        locker.unlock();
+        m_mediaFileCache->update(id, [&](MediaFile& file) {
+            file.setTitle(title);
+            file.setArtist(artist);
+            file.setAlbum(album);
+            file.setDuration(duration);
+        });
         return true;
     }
     
@@ -433,6 +1049,8 @@ bool DatabaseManager::removeMediaFile(int id)
     
     if (executeQuery("DELETE FROM media_files WHERE id = ?", {id})) {
         emit mediaFileRemoved(id, filePath);
+        locker.unlock();
+        m_mediaFileCache->remove(id);
         return true;
     }
     
@@ -454,6 +1072,8 @@ bool DatabaseManager::removeMediaFileByPath(const QString& filePath)
     if (executeQuery("DELETE FROM media_files WHERE file_path = ?", {filePath})) {
         if (id != -1) {
             emit mediaFileRemoved(id, filePath);
+            locker.unlock();
+            m_mediaFileCache->remove(id);
         }
         return true;
     }
@@ -461,6 +1081,80 @@ bool DatabaseManager::removeMediaFileByPath(const QString& filePath)
     return false;
 }
 
+bool DatabaseManager::removeMediaFilesByPath(const QStringList& filePaths)
+{
+    if (filePaths.isEmpty()) {
+        return true;
+    }
+    
+    QVector<QPair<int, QString>> removed;
+    {
+        QMutexLocker locker(&m_mutex);
+        
+        const bool ownTransaction = !m_bulkActive;
+        if (ownTransaction && !beginTransaction()) {
+            logError("removeMediaFilesByPath", m_database.lastError());
+            return false;
+        }
+        
+        // Chunked to stay below SQLite's bound variable limit
+        const int chunkSize = 500;
+        for (int start = 0; start < filePaths.size(); start += chunkSize) {
+            const QStringList chunk = filePaths.mid(start, chunkSize);
+            
+            QStringList placeholders;
+            for (int i = 0; i < chunk.size(); ++i) {
+                placeholders << "?";
+            }
+            const QString list = placeholders.join(", ");
+            
+            QVariantList params;
+            params.reserve(chunk.size());
+            for (const QString& filePath : chunk) {
+                params << filePath;
+            }
+            
+            // IDs before deletion for the signals
+            QSqlQuery idQuery = prepareQuery(QString("SELECT id, file_path FROM media_files WHERE file_path IN (%1)").arg(list));
+            for (const QVariant& param : params) {
+                idQuery.addBindValue(param);
+            }
+            if (!idQuery.exec()) {
+                logError("removeMediaFilesByPath", idQuery.lastError());
+                if (ownTransaction) {
+                    rollbackTransaction();
+                }
+                return false;
+            }
+            QVector<QPair<int, QString>> chunkRemoved;
+            while (idQuery.next()) {
+                chunkRemoved.append(qMakePair(idQuery.value(0).toInt(), idQuery.value(1).toString()));
+            }
+            idQuery.finish();
+            
+            if (!executeQuery(QString("DELETE FROM media_files WHERE file_path IN (%1)").arg(list), params)) {
+                if (ownTransaction) {
+                    rollbackTransaction();
+                }
+                return false;
+            }
+            removed << chunkRemoved;
+        }
+        
+        if (ownTransaction && !commitTransaction()) {
+            logError("removeMediaFilesByPath", m_database.lastError());
+            rollbackTransaction();
+            return false;
+        }
+    }
+    
+    for (const QPair<int, QString>& file : removed) {
+        emit mediaFileRemoved(file.first, file.second);
+        m_mediaFileCache->remove(file.first);
+    }
+    return true;
+}
+
 QSqlQuery DatabaseManager::getMediaFile(int id)
 {
     QSqlQuery query = prepareQuery("SELECT * FROM media_files WHERE id = ?");
@@ -484,24 +1178,150 @@ QSqlQuery DatabaseManager::getAllMediaFiles()
     return query;
 }
 
-QSqlQuery DatabaseManager::searchMediaFiles(const QString& searchTerm)
+QStringList DatabaseManager::getAllMediaFilePaths()
 {
-    const QString query = R"(
-        SELECT * FROM media_files 
-        WHERE title LIKE ? OR artist LIKE ? OR album LIKE ? OR file_path LIKE ?
-        ORDER BY title, artist
-    )";
-    
-    QString searchPattern = QString("%%1%").arg(searchTerm);
-    QSqlQuery sqlQuery = prepareQuery(query);
-    sqlQuery.addBindValue(searchPattern);
-    sqlQuery.addBindValue(searchPattern);
-    sqlQuery.addBindValue(searchPattern);
+    QStringList filePaths;
+    QSqlQuery query = prepareQuery("SELECT file_path FROM media_files");
+    if (!query.exec()) {
+        logError("getAllMediaFilePaths", query.lastError());
+        return filePaths;
+    }
+    while (query.next()) {
+        filePaths << query.value(0).toString();
+    }
+    return filePaths;
+}
+
+QVector<int> DatabaseManager::getMediaFileIds(const QStringList& filePaths)
+{
+    const QHash<QString, int> ids = getMediaFileIdsByPath(filePaths);
+    return QVector<int>(ids.cbegin(), ids.cend());
+}
+
+QHash<QString, int> DatabaseManager::getMediaFileIdsByPath(const QStringList& filePaths)
+{
+    QHash<QString, int> ids;
+    ids.reserve(filePaths.size());
+    
+    // Chunked to stay below SQLite's bound variable limit
+    const int chunkSize = 500;
+    for (int start = 0; start < filePaths.size(); start += chunkSize) {
+        const QStringList chunk = filePaths.mid(start, chunkSize);
+        
+        QStringList placeholders;
+        for (int i = 0; i < chunk.size(); ++i) {
+            placeholders << "?";
+        }
+        
+        QSqlQuery query = prepareQuery(QString("SELECT id, file_path FROM media_files WHERE file_path IN (%1)")
+                                       .arg(placeholders.join(", ")));
+        for (const QString& filePath : chunk) {
+            query.addBindValue(filePath);
+        }
+        
+        if (!query.exec()) {
+            logError("getMediaFileIdsByPath", query.lastError());
+            break;
+        }
+        while (query.next()) {
+            ids.insert(query.value(1).toString(), query.value(0).toInt());
+        }
+    }
+    
+    return ids;
+}
+
+QSqlQuery DatabaseManager::searchMediaFiles(const QString& searchTerm)
+{
+    const QString match = buildSearchMatch(searchTerm);
+    if (m_searchIndexAvailable && !match.isEmpty()) {
+        QSqlQuery sqlQuery = prepareQuery(R"(
+            SELECT mf.* FROM media_search
+            JOIN media_files mf ON mf.id = media_search.rowid
+            WHERE media_search MATCH ?
+            ORDER BY mf.title, mf.artist
+        )");
+        sqlQuery.addBindValue(match);
+        sqlQuery.exec();
+        return sqlQuery;
+    }
+    
+    const QString query = R"(
+        SELECT * FROM media_files 
+        WHERE title LIKE ? OR artist LIKE ? OR album LIKE ? OR file_path LIKE ?
+        ORDER BY title, artist
+    )";
+    
+    QString searchPattern = QString("%%1%").arg(searchTerm);
+    QSqlQuery sqlQuery = prepareQuery(query);
+    sqlQuery.addBindValue(searchPattern);
+    sqlQuery.addBindValue(searchPattern);
+    sqlQuery.addBindValue(searchPattern);
     sqlQuery.addBindValue(searchPattern);
     sqlQuery.exec();
     return sqlQuery;
 }
 
+QVector<int> DatabaseManager::searchMediaFileIds(const QString& searchTerm, int limit)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    QVector<int> ids;
+    const QString match = buildSearchMatch(searchTerm);
+    if (match.isEmpty() || limit <= 0) {
+        return ids;
+    }
+    
+    if (!m_searchIndexAvailable) {
+        const QString searchPattern = QString("%%1%").arg(searchTerm.trimmed());
+        QSqlQuery sqlQuery = prepareQuery(R"(
+            SELECT id FROM media_files 
+            WHERE title LIKE ? OR artist LIKE ? OR album LIKE ? OR file_path LIKE ?
+            ORDER BY title, artist
+            LIMIT ?
+        )");
+        for (int i = 0; i < 4; ++i) {
+            sqlQuery.addBindValue(searchPattern);
+        }
+        sqlQuery.addBindValue(limit);
+        
+        if (!sqlQuery.exec()) {
+            logError("searchMediaFileIds", sqlQuery.lastError());
+            return ids;
+        }
+        while (sqlQuery.next()) {
+            ids.append(sqlQuery.value(0).toInt());
+        }
+        return ids;
+    }
+    
+    // Called on every keystroke, so the statement is prepared once. Title
+    // and artist hits outrank album hits, which outrank path-only hits.
+    if (m_searchIdsQuery.lastQuery().isEmpty()) {
+        m_searchIdsQuery = prepareQuery(R"(
+            SELECT rowid FROM media_search
+            WHERE media_search MATCH ?
+            ORDER BY bm25(media_search, 10.0, 8.0, 4.0, 1.0)
+            LIMIT ?
+        )");
+    }
+    
+    m_searchIdsQuery.addBindValue(match);
+    m_searchIdsQuery.addBindValue(limit);
+    
+    if (!m_searchIdsQuery.exec()) {
+        logError("searchMediaFileIds", m_searchIdsQuery.lastError());
+        return ids;
+    }
+    
+    ids.reserve(limit);
+    while (m_searchIdsQuery.next()) {
+        ids.append(m_searchIdsQuery.value(0).toInt());
+    }
+    m_searchIdsQuery.finish();
+    
+    return ids;
+}
 bool DatabaseManager::updatePlayCount(int id)
 {
     QMutexLocker locker(&m_mutex);
@@ -528,6 +1348,742 @@ bool DatabaseManager::updateLastPlayed(int id, const QDateTime& timestamp)
     return executeQuery(query, {timestamp, id});
 }
 
+// Bulk media file upserts
+bool DatabaseManager::beginBulkUpsert(int commitRows, int commitIntervalMs)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (m_bulkActive) {
+        qCWarning(dbManager) << "Bulk upsert already active";
+        return true;
+    }
+    
+    if (m_upsertQuery.lastQuery().isEmpty()) {
+        // Rows that did not change are left alone, so rescans do not
+        // rewrite the table or fire the date_modified trigger
+        m_upsertQuery = prepareQuery(R"(
+            INSERT INTO media_files (file_path, title, artist, album, duration, file_size)
+            VALUES (?, ?, ?, ?, ?, ?)
+            ON CONFLICT(file_path) DO UPDATE SET
+                title = excluded.title,
+                artist = excluded.artist,
+                album = excluded.album,
+                duration = excluded.duration,
+                file_size = excluded.file_size
+            WHERE title IS NOT excluded.title
+               OR artist IS NOT excluded.artist
+               OR album IS NOT excluded.album
+               OR duration IS NOT excluded.duration
+               OR file_size IS NOT excluded.file_size
+        )");
+    }
+    
+    if (!m_database.transaction()) {
+        logError("beginBulkUpsert", m_database.lastError());
+        return false;
+    }
+    
+    // An upsert that updates leaves last_insert_rowid() untouched, which is
+    // how bulkUpsertMediaFile() tells inserts from updates
+    QSqlQuery rowIdQuery = prepareQuery("SELECT last_insert_rowid()");
+    m_lastInsertRowId = (rowIdQuery.exec() && rowIdQuery.next()) ? rowIdQuery.value(0).toLongLong() : 0;
+    
+    m_bulkActive = true;
+    m_bulkCommitRows = qMax(1, commitRows);
+    m_bulkCommitIntervalMs = qMax(0, commitIntervalMs);
+    m_bulkPaths.clear();
+    m_bulkTimer.start();
+    return true;
+}
+
+bool DatabaseManager::bulkUpsertMediaFile(const MediaFileRow& row, bool* inserted)
+{
+    QStringList committedPaths;
+    bool success = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        
+        if (!m_bulkActive) {
+            m_lastError = "Bulk upsert not active";
+            return false;
+        }
+        
+        m_upsertQuery.addBindValue(row.filePath);
+        m_upsertQuery.addBindValue(row.title);
+        m_upsertQuery.addBindValue(row.artist);
+        m_upsertQuery.addBindValue(row.album);
+        m_upsertQuery.addBindValue(row.duration);
+        m_upsertQuery.addBindValue(row.fileSize);
+        
+        success = m_upsertQuery.exec();
+        if (success) {
+            const qint64 rowId = m_upsertQuery.lastInsertId().toLongLong();
+            if (inserted) {
+                *inserted = rowId != m_lastInsertRowId;
+            }
+            m_lastInsertRowId = rowId;
+            m_bulkPaths << row.filePath;
+        } else {
+            logError("bulkUpsertMediaFile", m_upsertQuery.lastError());
+        }
+        
+        if (m_bulkPaths.size() >= m_bulkCommitRows || m_bulkTimer.elapsed() >= m_bulkCommitIntervalMs) {
+            committedPaths = commitBulkLocked();
+            if (!m_database.transaction()) {
+                logError("bulkUpsertMediaFile", m_database.lastError());
+                m_bulkActive = false;
+            }
+        }
+    }
+    
+    // Emitted without the lock so receivers may query the database
+    if (!committedPaths.isEmpty()) {
+        emit mediaFilesUpserted(committedPaths);
+    }
+    
+    return success;
+}
+
+bool DatabaseManager::flushBulkUpsert()
+{
+    QStringList committedPaths;
+    {
+        QMutexLocker locker(&m_mutex);
+        
+        if (!m_bulkActive || m_bulkPaths.isEmpty()) {
+            return m_bulkActive;
+        }
+        
+        committedPaths = commitBulkLocked();
+        if (!m_database.transaction()) {
+            logError("flushBulkUpsert", m_database.lastError());
+            m_bulkActive = false;
+        }
+    }
+    
+    if (!committedPaths.isEmpty()) {
+        emit mediaFilesUpserted(committedPaths);
+    }
+    
+    return m_bulkActive;
+}
+
+bool DatabaseManager::endBulkUpsert()
+{
+    QStringList committedPaths;
+    {
+        QMutexLocker locker(&m_mutex);
+        
+        if (!m_bulkActive) {
+            return false;
+        }
+        
+        committedPaths = commitBulkLocked();
+        m_bulkActive = false;
+    }
+    
+    if (!committedPaths.isEmpty()) {
+        emit mediaFilesUpserted(committedPaths);
+    }
+    
+    return true;
+}
+
+// Scan journal
+QSqlQuery DatabaseManager::getDuplicateSizeCandidates()
+{
+    // Only files sharing their size with another file can be duplicates
+    QSqlQuery query = prepareQuery(R"(
+        SELECT file_path, file_size, sample_hash, content_hash, hash_file_size, hash_modified_time
+        FROM media_files
+        WHERE file_size > 0 AND file_size IN (
+            SELECT file_size FROM media_files
+            WHERE file_size > 0
+            GROUP BY file_size HAVING COUNT(*) > 1
+        )
+        ORDER BY file_size
+    )");
+    query.exec();
+    return query;
+}
+
+bool DatabaseManager::updateMediaFileHashes(const QString& filePath, const QString& sampleHash,
+                                            const QString& contentHash, qint64 fileSize, qint64 modifiedTime)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (m_hashUpdateQuery.lastQuery().isEmpty()) {
+        m_hashUpdateQuery = prepareQuery(R"(
+            UPDATE media_files
+            SET sample_hash = ?, content_hash = ?, hash_file_size = ?, hash_modified_time = ?
+            WHERE file_path = ?
+        )");
+    }
+    
+    m_hashUpdateQuery.addBindValue(sampleHash.isEmpty() ? QVariant() : QVariant(sampleHash));
+    m_hashUpdateQuery.addBindValue(contentHash.isEmpty() ? QVariant() : QVariant(contentHash));
+    m_hashUpdateQuery.addBindValue(fileSize);
+    m_hashUpdateQuery.addBindValue(modifiedTime);
+    m_hashUpdateQuery.addBindValue(filePath);
+    
+    if (!m_hashUpdateQuery.exec()) {
+        logError("updateMediaFileHashes", m_hashUpdateQuery.lastError());
+        return false;
+    }
+    
+    return true;
+}
+
+QSqlQuery DatabaseManager::getVideoFingerprints()
+{
+    QSqlQuery query = prepareQuery(R"(
+        SELECT m.id, m.file_path, m.file_size, m.duration,
+               f.file_size, f.modified_time, f.fingerprint
+        FROM media_files m
+        LEFT JOIN video_fingerprints f ON f.media_file_id = m.id
+        WHERE m.duration > 0
+    )");
+    query.exec();
+    return query;
+}
+
+bool DatabaseManager::storeVideoFingerprint(int mediaFileId, qint64 fileSize, qint64 modifiedTime,
+                                            const QByteArray& fingerprint)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_fingerprintStoreQuery.lastQuery().isEmpty()) {
+        m_fingerprintStoreQuery = prepareQuery(R"(
+            INSERT OR REPLACE INTO video_fingerprints (media_file_id, file_size, modified_time, fingerprint)
+            VALUES (?, ?, ?, ?)
+        )");
+    }
+
+    m_fingerprintStoreQuery.addBindValue(mediaFileId);
+    m_fingerprintStoreQuery.addBindValue(fileSize);
+    m_fingerprintStoreQuery.addBindValue(modifiedTime);
+    m_fingerprintStoreQuery.addBindValue(fingerprint);
+
+    if (!m_fingerprintStoreQuery.exec()) {
+        logError("storeVideoFingerprint", m_fingerprintStoreQuery.lastError());
+        return false;
+    }
+
+    return true;
+}
+
+QSqlQuery DatabaseManager::getPosterCandidates()
+{
+    QSqlQuery query = prepareQuery(R"(
+        SELECT id, file_path, duration
+        FROM media_files
+        WHERE duration > 0 AND (cover_art_path IS NULL OR cover_art_path = '')
+    )");
+    query.exec();
+    return query;
+}
+
+bool DatabaseManager::updateMediaFileCoverArt(int id, const QString& coverArtPath)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_coverArtUpdateQuery.lastQuery().isEmpty()) {
+        m_coverArtUpdateQuery = prepareQuery("UPDATE media_files SET cover_art_path = ? WHERE id = ?");
+    }
+
+    m_coverArtUpdateQuery.addBindValue(coverArtPath);
+    m_coverArtUpdateQuery.addBindValue(id);
+
+    if (!m_coverArtUpdateQuery.exec()) {
+        logError("updateMediaFileCoverArt", m_coverArtUpdateQuery.lastError());
+        return false;
+    }
+
+    emit mediaFileUpdated(id);
+
+    locker.unlock();
+    m_mediaFileCache->update(id, [&](MediaFile& file) {
+        file.setCoverArtPath(coverArtPath);
+    });
+    return true;
+}
+
+QSqlQuery DatabaseManager::getAcousticFingerprintCandidates()
+{
+    QSqlQuery query = prepareQuery(R"(
+        SELECT m.id, m.file_path, m.file_size, m.duration
+        FROM media_files m
+        LEFT JOIN acoustic_fingerprints f ON f.media_file_id = m.id
+        WHERE f.media_file_id IS NULL OR f.file_size != m.file_size
+    )");
+    query.exec();
+    return query;
+}
+
+bool DatabaseManager::storeAcousticFingerprint(int mediaFileId, qint64 fileSize, const QByteArray& fingerprint,
+                                               const QHash<quint32, int>& subHashes)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_acousticStoreQuery.lastQuery().isEmpty()) {
+        m_acousticStoreQuery = prepareQuery(R"(
+            INSERT OR REPLACE INTO acoustic_fingerprints (media_file_id, file_size, fingerprint)
+            VALUES (?, ?, ?)
+        )");
+        m_acousticHashDeleteQuery = prepareQuery("DELETE FROM acoustic_hashes WHERE media_file_id = ?");
+        m_acousticHashInsertQuery = prepareQuery(R"(
+            INSERT OR IGNORE INTO acoustic_hashes (sub_hash, media_file_id, position)
+            VALUES (?, ?, ?)
+        )");
+    }
+
+    m_acousticHashDeleteQuery.addBindValue(mediaFileId);
+    if (!m_acousticHashDeleteQuery.exec()) {
+        logError("storeAcousticFingerprint", m_acousticHashDeleteQuery.lastError());
+        return false;
+    }
+
+    m_acousticStoreQuery.addBindValue(mediaFileId);
+    m_acousticStoreQuery.addBindValue(fileSize);
+    m_acousticStoreQuery.addBindValue(fingerprint.isEmpty() ? QVariant() : QVariant(fingerprint));
+    if (!m_acousticStoreQuery.exec()) {
+        logError("storeAcousticFingerprint", m_acousticStoreQuery.lastError());
+        return false;
+    }
+
+    for (auto it = subHashes.constBegin(); it != subHashes.constEnd(); ++it) {
+        m_acousticHashInsertQuery.addBindValue(qint64(it.key()));
+        m_acousticHashInsertQuery.addBindValue(mediaFileId);
+        m_acousticHashInsertQuery.addBindValue(it.value());
+        if (!m_acousticHashInsertQuery.exec()) {
+            logError("storeAcousticFingerprint", m_acousticHashInsertQuery.lastError());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+DatabaseManager::AcousticFingerprintRow DatabaseManager::getAcousticFingerprint(int mediaFileId)
+{
+    AcousticFingerprintRow row;
+
+    QSqlQuery query = prepareQuery(R"(
+        SELECT f.media_file_id, m.file_path, f.fingerprint
+        FROM acoustic_fingerprints f
+        JOIN media_files m ON m.id = f.media_file_id
+        WHERE f.media_file_id = ? AND f.file_size = m.file_size
+    )");
+    query.addBindValue(mediaFileId);
+    if (!query.exec() || !query.next()) {
+        return row;
+    }
+
+    row.mediaFileId = query.value(0).toInt();
+    row.filePath = query.value(1).toString();
+    row.fingerprint = query.value(2).toByteArray();
+    return row;
+}
+
+DatabaseManager::AcousticFingerprintRow DatabaseManager::getAcousticFingerprint(const QString& filePath)
+{
+    AcousticFingerprintRow row;
+
+    QSqlQuery query = prepareQuery(R"(
+        SELECT f.media_file_id, m.file_path, f.fingerprint
+        FROM media_files m
+        JOIN acoustic_fingerprints f ON f.media_file_id = m.id
+        WHERE m.file_path = ? AND f.file_size = m.file_size
+    )");
+    query.addBindValue(filePath);
+    if (!query.exec() || !query.next()) {
+        return row;
+    }
+
+    row.mediaFileId = query.value(0).toInt();
+    row.filePath = query.value(1).toString();
+    row.fingerprint = query.value(2).toByteArray();
+    return row;
+}
+
+QSqlQuery DatabaseManager::getAcousticMatchCandidates(int minShared, int maxFilesPerHash)
+{
+    // Each pair once, lower id first; the primary key makes the join a range lookup
+    QSqlQuery query = prepareQuery(R"(
+        SELECT a.media_file_id, b.media_file_id, COUNT(*) AS shared
+        FROM acoustic_hashes a
+        JOIN acoustic_hashes b ON b.sub_hash = a.sub_hash AND b.media_file_id > a.media_file_id
+        WHERE a.sub_hash IN (
+            SELECT sub_hash FROM acoustic_hashes
+            GROUP BY sub_hash HAVING COUNT(*) BETWEEN 2 AND ?
+        )
+        GROUP BY a.media_file_id, b.media_file_id
+        HAVING shared >= ?
+        ORDER BY shared DESC
+    )");
+    query.addBindValue(maxFilesPerHash);
+    query.addBindValue(minShared);
+    query.exec();
+    return query;
+}
+
+QSqlQuery DatabaseManager::getLoudnessScanCandidates()
+{
+    QSqlQuery query = prepareQuery(R"(
+        SELECT file_path, album
+        FROM media_files
+        WHERE loudness_file_size IS NULL OR loudness_file_size != file_size
+    )");
+    query.exec();
+    return query;
+}
+
+bool DatabaseManager::updateMediaFileLoudness(const QString& filePath, double loudness, double trackGain,
+                                              double truePeak, const QByteArray& histogram, qint64 fileSize)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (m_loudnessUpdateQuery.lastQuery().isEmpty()) {
+        m_loudnessUpdateQuery = prepareQuery(R"(
+            UPDATE media_files
+            SET loudness = ?, loudness_histogram = ?, loudness_file_size = ?, track_gain = ?, track_peak = ?
+            WHERE file_path = ?
+        )");
+    }
+    
+    const bool measured = !qIsNaN(loudness);
+    m_loudnessUpdateQuery.addBindValue(measured ? QVariant(loudness) : QVariant());
+    m_loudnessUpdateQuery.addBindValue(histogram.isEmpty() ? QVariant() : QVariant(histogram));
+    m_loudnessUpdateQuery.addBindValue(fileSize);
+    m_loudnessUpdateQuery.addBindValue(measured ? QVariant(trackGain) : QVariant());
+    m_loudnessUpdateQuery.addBindValue(measured ? QVariant(truePeak) : QVariant());
+    m_loudnessUpdateQuery.addBindValue(filePath);
+    
+    if (!m_loudnessUpdateQuery.exec()) {
+        logError("updateMediaFileLoudness", m_loudnessUpdateQuery.lastError());
+        return false;
+    }
+    
+    return true;
+}
+
+QSqlQuery DatabaseManager::getAlbumLoudness(const QString& album)
+{
+    QSqlQuery query = prepareQuery(R"(
+        SELECT file_path, loudness_histogram, track_peak
+        FROM media_files
+        WHERE album = ? AND loudness_histogram IS NOT NULL
+    )");
+    query.addBindValue(album);
+    query.exec();
+    return query;
+}
+
+bool DatabaseManager::updateAlbumGain(const QStringList& filePaths, double albumGain, double albumPeak)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    QSqlQuery query = prepareQuery("UPDATE media_files SET album_gain = ?, album_peak = ? WHERE file_path = ?");
+    for (const QString& filePath : filePaths) {
+        query.addBindValue(albumGain);
+        query.addBindValue(albumPeak);
+        query.addBindValue(filePath);
+        if (!query.exec()) {
+            logError("updateAlbumGain", query.lastError());
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+DatabaseManager::ReplayGainRow DatabaseManager::getReplayGain(const QString& filePath)
+{
+    ReplayGainRow row;
+    
+    QSqlQuery query = prepareQuery(R"(
+        SELECT track_gain, track_peak, album_gain, album_peak
+        FROM media_files
+        WHERE file_path = ? AND loudness_file_size = file_size
+    )");
+    query.addBindValue(filePath);
+    if (!query.exec() || !query.next()) {
+        return row;
+    }
+    
+    row.hasTrackGain = !query.value(0).isNull();
+    row.trackGain = query.value(0).toDouble();
+    row.trackPeak = query.value(1).toDouble();
+    row.hasAlbumGain = !query.value(2).isNull();
+    row.albumGain = query.value(2).toDouble();
+    row.albumPeak = query.value(3).toDouble();
+    return row;
+}
+
+bool DatabaseManager::updateMediaFileBeatGrid(const QString& filePath, double bpm, double firstBeatMs,
+                                              double confidence)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (m_beatGridUpdateQuery.lastQuery().isEmpty()) {
+        m_beatGridUpdateQuery = prepareQuery(R"(
+            UPDATE media_files
+            SET tempo_bpm = ?, beat_offset_ms = ?, beat_confidence = ?
+            WHERE file_path = ?
+        )");
+    }
+    
+    m_beatGridUpdateQuery.addBindValue(bpm);
+    m_beatGridUpdateQuery.addBindValue(firstBeatMs);
+    m_beatGridUpdateQuery.addBindValue(confidence);
+    m_beatGridUpdateQuery.addBindValue(filePath);
+    
+    if (!m_beatGridUpdateQuery.exec()) {
+        logError("updateMediaFileBeatGrid", m_beatGridUpdateQuery.lastError());
+        return false;
+    }
+    
+    return true;
+}
+
+DatabaseManager::BeatGridRow DatabaseManager::getBeatGrid(const QString& filePath)
+{
+    BeatGridRow row;
+    
+    QSqlQuery query = prepareQuery(R"(
+        SELECT tempo_bpm, beat_offset_ms, beat_confidence
+        FROM media_files
+        WHERE file_path = ? AND loudness_file_size = file_size AND tempo_bpm > 0
+    )");
+    query.addBindValue(filePath);
+    if (!query.exec() || !query.next()) {
+        return row;
+    }
+    
+    row.hasBeatGrid = true;
+    row.bpm = query.value(0).toDouble();
+    row.firstBeatMs = query.value(1).toDouble();
+    row.confidence = query.value(2).toDouble();
+    return row;
+}
+
+qint64 DatabaseManager::getSubtitleSourceModifiedTime(const QString& sourcePath)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    QSqlQuery query = prepareQuery("SELECT modified_time FROM subtitle_sources WHERE source_path = ?");
+    query.addBindValue(sourcePath);
+    if (!query.exec() || !query.next()) {
+        return -1;
+    }
+    return query.value(0).toLongLong();
+}
+
+bool DatabaseManager::replaceSubtitleCues(const QString& mediaFilePath, const QString& sourcePath, bool generated,
+                                          qint64 modifiedTime, const QVector<SubtitleCueRow>& cues)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    QSqlQuery mediaQuery = prepareQuery("SELECT id FROM media_files WHERE file_path = ?");
+    mediaQuery.addBindValue(mediaFilePath);
+    if (!mediaQuery.exec() || !mediaQuery.next()) {
+        return false;
+    }
+    const int mediaFileId = mediaQuery.value(0).toInt();
+    
+    // The delete trigger takes the old cues out of the search index
+    QSqlQuery removeQuery = prepareQuery("DELETE FROM subtitle_sources WHERE source_path = ?");
+    removeQuery.addBindValue(sourcePath);
+    
+    QSqlQuery sourceQuery = prepareQuery(R"(
+        INSERT INTO subtitle_sources (media_file_id, source_path, generated, modified_time, cue_count)
+        VALUES (?, ?, ?, ?, ?)
+    )");
+    sourceQuery.addBindValue(mediaFileId);
+    sourceQuery.addBindValue(sourcePath);
+    sourceQuery.addBindValue(generated ? 1 : 0);
+    sourceQuery.addBindValue(modifiedTime);
+    sourceQuery.addBindValue(cues.size());
+    
+    if (!removeQuery.exec() || !sourceQuery.exec()) {
+        logError("replaceSubtitleCues", removeQuery.lastError().isValid() ? removeQuery.lastError()
+                                                                          : sourceQuery.lastError());
+        return false;
+    }
+    const qint64 sourceId = sourceQuery.lastInsertId().toLongLong();
+    
+    QSqlQuery cueQuery = prepareQuery("INSERT INTO subtitle_cues (source_id, start_ms, end_ms, text) VALUES (?, ?, ?, ?)");
+    for (const SubtitleCueRow& cue : cues) {
+        cueQuery.addBindValue(sourceId);
+        cueQuery.addBindValue(cue.startMs);
+        cueQuery.addBindValue(cue.endMs);
+        cueQuery.addBindValue(cue.text);
+        if (!cueQuery.exec()) {
+            logError("replaceSubtitleCues", cueQuery.lastError());
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool DatabaseManager::removeSubtitleSource(const QString& sourcePath)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    return executeQuery("DELETE FROM subtitle_sources WHERE source_path = ?", {sourcePath});
+}
+
+QVector<DatabaseManager::SubtitleSearchHit> DatabaseManager::searchSubtitles(const QString& searchTerm, int limit)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    QVector<SubtitleSearchHit> hits;
+    const QString match = buildSearchMatch(searchTerm);
+    if (match.isEmpty() || limit <= 0) {
+        return hits;
+    }
+    
+    // Ranking and the limit are applied inside the index before any join
+    QSqlQuery query;
+    if (m_subtitleSearchAvailable) {
+        query = prepareQuery(R"(
+            SELECT mf.id, mf.file_path, ss.source_path, sc.start_ms, sc.end_ms, sc.text
+            FROM (SELECT rowid, rank FROM subtitle_search WHERE subtitle_search MATCH ? ORDER BY rank LIMIT ?) AS hit
+            JOIN subtitle_cues sc ON sc.id = hit.rowid
+            JOIN subtitle_sources ss ON ss.id = sc.source_id
+            JOIN media_files mf ON mf.id = ss.media_file_id
+            ORDER BY hit.rank
+        )");
+        query.addBindValue(match);
+    } else {
+        query = prepareQuery(R"(
+            SELECT mf.id, mf.file_path, ss.source_path, sc.start_ms, sc.end_ms, sc.text
+            FROM subtitle_cues sc
+            JOIN subtitle_sources ss ON ss.id = sc.source_id
+            JOIN media_files mf ON mf.id = ss.media_file_id
+            WHERE sc.text LIKE ?
+            ORDER BY mf.file_path, sc.start_ms
+            LIMIT ?
+        )");
+        query.addBindValue(QString("%%1%").arg(searchTerm.trimmed()));
+    }
+    query.addBindValue(limit);
+    query.setForwardOnly(true);
+    
+    if (!query.exec()) {
+        logError("searchSubtitles", query.lastError());
+        return hits;
+    }
+    
+    while (query.next()) {
+        SubtitleSearchHit hit;
+        hit.mediaFileId = query.value(0).toInt();
+        hit.filePath = query.value(1).toString();
+        hit.sourcePath = query.value(2).toString();
+        hit.startMs = query.value(3).toLongLong();
+        hit.endMs = query.value(4).toLongLong();
+        hit.text = query.value(5).toString();
+        hits.append(hit);
+    }
+    return hits;
+}
+
+QSqlQuery DatabaseManager::getScanJournalDirectories()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    QSqlQuery query = prepareQuery("SELECT path, parent_path, modified_time FROM scan_journal_directories");
+    query.setForwardOnly(true);
+    query.exec();
+    return query;
+}
+
+QSqlQuery DatabaseManager::getScanJournalFiles()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    QSqlQuery query = prepareQuery(R"(
+        SELECT file_path, directory_path, file_size, modified_time, inode
+        FROM scan_journal_files
+    )");
+    query.setForwardOnly(true);
+    query.exec();
+    return query;
+}
+
+bool DatabaseManager::updateScanJournalDirectory(const QString& path, const QString& parentPath,
+                                                 qint64 modifiedTime)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    const QString query = R"(
+        INSERT OR REPLACE INTO scan_journal_directories (path, parent_path, modified_time)
+        VALUES (?, ?, ?)
+    )";
+    
+    return executeQuery(query, {path, parentPath, modifiedTime});
+}
+
+bool DatabaseManager::updateScanJournalFile(const QString& filePath, const QString& directoryPath,
+                                            qint64 fileSize, qint64 modifiedTime, qint64 inode)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    // Written once per scanned file, so the statement is kept prepared
+    if (m_journalFileQuery.lastQuery().isEmpty()) {
+        m_journalFileQuery = prepareQuery(R"(
+            INSERT OR REPLACE INTO scan_journal_files
+                (file_path, directory_path, file_size, modified_time, inode)
+            VALUES (?, ?, ?, ?, ?)
+        )");
+    }
+    
+    m_journalFileQuery.addBindValue(filePath);
+    m_journalFileQuery.addBindValue(directoryPath);
+    m_journalFileQuery.addBindValue(fileSize);
+    m_journalFileQuery.addBindValue(modifiedTime);
+    m_journalFileQuery.addBindValue(inode);
+    
+    if (!m_journalFileQuery.exec()) {
+        logError("updateScanJournalFile", m_journalFileQuery.lastError());
+        return false;
+    }
+    
+    return true;
+}
+
+bool DatabaseManager::removeScanJournalDirectory(const QString& path)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    return executeQuery("DELETE FROM scan_journal_files WHERE directory_path = ?", {path}) &&
+           executeQuery("DELETE FROM scan_journal_directories WHERE path = ?", {path});
+}
+
+bool DatabaseManager::clearScanJournal()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    return executeQuery("DELETE FROM scan_journal_files") &&
+           executeQuery("DELETE FROM scan_journal_directories");
+}
+
+QStringList DatabaseManager::commitBulkLocked()
+{
+    QStringList committedPaths;
+    committedPaths.swap(m_bulkPaths);
+    
+    if (!m_database.commit()) {
+        logError("commitBulk", m_database.lastError());
+        m_database.rollback();
+        committedPaths.clear();
+    }
+    
+    m_bulkTimer.restart();
+    return committedPaths;
+}
+
 // Playlist operations
 int DatabaseManager::createPlaylist(const QString& name)
 {
@@ -590,52 +2146,36 @@ bool DatabaseManager::addToPlaylist(int playlistId, int mediaFileId, int positio
 {
     QMutexLocker locker(&m_mutex);
     
-    if (position == -1) {
-        // Add to end of playlist
-        QSqlQuery maxPos = prepareQuery("SELECT COALESCE(MAX(position), -1) + 1 FROM playlist_items WHERE playlist_id = ?");
-        maxPos.addBindValue(playlistId);
-        if (maxPos.exec() && maxPos.next()) {
-            position = maxPos.value(0).toInt();
-        } else {
-            position = 0;
+    if (!beginTransaction()) {
+        return false;
+    }
+    
+    qint64 key = playlistPositionForIndexLocked(playlistId, position);
+    if (key < 0) {
+        // No room between the neighbours; spread the playlist out again
+        if (!renumberPlaylistLocked(playlistId)) {
+            rollbackTransaction();
+            return false;
         }
-    } else {
-        // Shift existing items to make room
-        executeQuery("UPDATE playlist_items SET position = position + 1 WHERE playlist_id = ? AND position >= ?",
-                    {playlistId, position});
+        key = playlistPositionForIndexLocked(playlistId, position);
     }
     
-    return executeQuery("INSERT INTO playlist_items (playlist_id, media_file_id, position) VALUES (?, ?, ?)",
-                       {playlistId, mediaFileId, position});
+    if (!executeQuery("INSERT INTO playlist_items (playlist_id, media_file_id, position) VALUES (?, ?, ?)",
+                      {playlistId, mediaFileId, key})) {
+        rollbackTransaction();
+        return false;
+    }
+    
+    return commitTransaction();
 }
 
 bool DatabaseManager::removeFromPlaylist(int playlistId, int mediaFileId)
 {
     QMutexLocker locker(&m_mutex);
     
-    // Get position of item to remove
-    QSqlQuery posQuery = prepareQuery("SELECT position FROM playlist_items WHERE playlist_id = ? AND media_file_id = ?");
-    posQuery.addBindValue(playlistId);
-    posQuery.addBindValue(mediaFileId);
-    
-    int removedPosition = -1;
-    if (posQuery.exec() && posQuery.next()) {
-        removedPosition = posQuery.value(0).toInt();
-    }
-    
-    // Remove the item
-    if (!executeQuery("DELETE FROM playlist_items WHERE playlist_id = ? AND media_file_id = ?",
-                     {playlistId, mediaFileId})) {
-        return false;
-    }
-    
-    // Shift remaining items down
-    if (removedPosition != -1) {
-        executeQuery("UPDATE playlist_items SET position = position - 1 WHERE playlist_id = ? AND position > ?",
-                    {playlistId, removedPosition});
-    }
-    
-    return true;
+    // Sort keys stay ordered without the removed rows
+    return executeQuery("DELETE FROM playlist_items WHERE playlist_id = ? AND media_file_id = ?",
+                        {playlistId, mediaFileId});
 }
 
 bool DatabaseManager::movePlaylistItem(int playlistId, int fromPosition, int toPosition)
@@ -651,7 +2191,8 @@ bool DatabaseManager::movePlaylistItem(int playlistId, int fromPosition, int toP
     }
     
     // Get the item to move
-    QSqlQuery itemQuery = prepareQuery("SELECT media_file_id FROM playlist_items WHERE playlist_id = ? AND position = ?");
+    QSqlQuery itemQuery = prepareQuery(
+        "SELECT id FROM playlist_items WHERE playlist_id = ? ORDER BY position LIMIT 1 OFFSET ?");
     itemQuery.addBindValue(playlistId);
     itemQuery.addBindValue(fromPosition);
     
@@ -660,29 +2201,20 @@ bool DatabaseManager::movePlaylistItem(int playlistId, int fromPosition, int toP
         return false;
     }
     
-    int mediaFileId = itemQuery.value(0).toInt();
-    
-    // Remove item temporarily
-    if (!executeQuery("DELETE FROM playlist_items WHERE playlist_id = ? AND position = ?",
-                     {playlistId, fromPosition})) {
-        rollbackTransaction();
-        return false;
-    }
+    const qint64 rowId = itemQuery.value(0).toLongLong();
+    itemQuery.finish();
     
-    // Adjust positions
-    if (fromPosition < toPosition) {
-        // Moving down: shift items up
-        executeQuery("UPDATE playlist_items SET position = position - 1 WHERE playlist_id = ? AND position > ? AND position <= ?",
-                    {playlistId, fromPosition, toPosition});
-    } else {
-        // Moving up: shift items down
-        executeQuery("UPDATE playlist_items SET position = position + 1 WHERE playlist_id = ? AND position >= ? AND position < ?",
-                    {playlistId, toPosition, fromPosition});
+    // Only the moved row changes, unless its new neighbours are adjacent keys
+    qint64 key = playlistPositionForIndexLocked(playlistId, toPosition, rowId);
+    if (key < 0) {
+        if (!renumberPlaylistLocked(playlistId)) {
+            rollbackTransaction();
+            return false;
+        }
+        key = playlistPositionForIndexLocked(playlistId, toPosition, rowId);
     }
     
-    // Insert item at new position
-    if (!executeQuery("INSERT INTO playlist_items (playlist_id, media_file_id, position) VALUES (?, ?, ?)",
-                     {playlistId, mediaFileId, toPosition})) {
+    if (!executeQuery("UPDATE playlist_items SET position = ? WHERE id = ?", {key, rowId})) {
         rollbackTransaction();
         return false;
     }
@@ -712,16 +2244,172 @@ bool DatabaseManager::clearPlaylist(int playlistId)
     return executeQuery("DELETE FROM playlist_items WHERE playlist_id = ?", {playlistId});
 }
 
-// Statistics and maintenance
-int DatabaseManager::getMediaFileCount()
+bool DatabaseManager::updatePlaylistItems(int playlistId, const QList<qint64>& removedRowIds,
+                                          QList<PlaylistItemRow>& rows)
 {
-    QSqlQuery query = prepareQuery("SELECT COUNT(*) FROM media_files");
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt();
+    QMutexLocker locker(&m_mutex);
+    
+    if (removedRowIds.isEmpty() && rows.isEmpty()) {
+        return true;
     }
-    return 0;
+    
+    if (!beginTransaction()) {
+        return false;
+    }
+    
+    QSqlQuery removeQuery = prepareQuery("DELETE FROM playlist_items WHERE id = ? AND playlist_id = ?");
+    for (qint64 rowId : removedRowIds) {
+        removeQuery.addBindValue(rowId);
+        removeQuery.addBindValue(playlistId);
+        if (!removeQuery.exec()) {
+            logError("updatePlaylistItems", removeQuery.lastError());
+            rollbackTransaction();
+            return false;
+        }
+    }
+    
+    // Moved rows are parked on their negated id first, so that a new key
+    // may be one another moved row has not given up yet
+    QSqlQuery moveQuery = prepareQuery("UPDATE playlist_items SET position = ? WHERE id = ? AND playlist_id = ?");
+    for (int pass = 0; pass < 2; ++pass) {
+        for (const PlaylistItemRow& row : std::as_const(rows)) {
+            if (row.rowId < 0) {
+                continue;
+            }
+            moveQuery.addBindValue(pass == 0 ? -row.rowId : row.position);
+            moveQuery.addBindValue(row.rowId);
+            moveQuery.addBindValue(playlistId);
+            if (!moveQuery.exec()) {
+                logError("updatePlaylistItems", moveQuery.lastError());
+                rollbackTransaction();
+                return false;
+            }
+        }
+    }
+    
+    QSqlQuery insertQuery = prepareQuery(
+        "INSERT INTO playlist_items (playlist_id, media_file_id, position) VALUES (?, ?, ?)");
+    QList<qint64> insertedRowIds;
+    for (const PlaylistItemRow& row : std::as_const(rows)) {
+        if (row.rowId >= 0) {
+            continue;
+        }
+        insertQuery.addBindValue(playlistId);
+        insertQuery.addBindValue(row.mediaFileId);
+        insertQuery.addBindValue(row.position);
+        if (!insertQuery.exec()) {
+            logError("updatePlaylistItems", insertQuery.lastError());
+            rollbackTransaction();
+            return false;
+        }
+        insertedRowIds.append(insertQuery.lastInsertId().toLongLong());
+    }
+    
+    if (!commitTransaction()) {
+        rollbackTransaction();
+        return false;
+    }
+    
+    int inserted = 0;
+    for (PlaylistItemRow& row : rows) {
+        if (row.rowId < 0) {
+            row.rowId = insertedRowIds.at(inserted++);
+        }
+    }
+    
+    return true;
+}
+
+qint64 DatabaseManager::playlistPositionForIndexLocked(int playlistId, int index, qint64 excludedRowId)
+{
+    // Keys of the rows the new item goes between; keys are always positive
+    qint64 before = 0;
+    qint64 after = -1;
+    bool append = index < 0;
+    
+    if (index == 0) {
+        QSqlQuery firstQuery = prepareQuery(
+            "SELECT MIN(position) FROM playlist_items WHERE playlist_id = ? AND id != ?");
+        firstQuery.addBindValue(playlistId);
+        firstQuery.addBindValue(excludedRowId);
+        if (firstQuery.exec() && firstQuery.next() && !firstQuery.value(0).isNull()) {
+            after = firstQuery.value(0).toLongLong();
+        }
+    } else if (!append) {
+        QSqlQuery neighbourQuery = prepareQuery(
+            "SELECT position FROM playlist_items WHERE playlist_id = ? AND id != ? "
+            "ORDER BY position LIMIT 2 OFFSET ?");
+        neighbourQuery.addBindValue(playlistId);
+        neighbourQuery.addBindValue(excludedRowId);
+        neighbourQuery.addBindValue(index - 1);
+        if (neighbourQuery.exec() && neighbourQuery.next()) {
+            before = neighbourQuery.value(0).toLongLong();
+            if (neighbourQuery.next()) {
+                after = neighbourQuery.value(0).toLongLong();
+            }
+        } else {
+            append = true;
+        }
+    }
+    
+    if (append) {
+        QSqlQuery lastQuery = prepareQuery(
+            "SELECT COALESCE(MAX(position), 0) FROM playlist_items WHERE playlist_id = ? AND id != ?");
+        lastQuery.addBindValue(playlistId);
+        lastQuery.addBindValue(excludedRowId);
+        if (lastQuery.exec() && lastQuery.next()) {
+            before = lastQuery.value(0).toLongLong();
+        }
+    }
+    
+    if (after < 0) {
+        return before + PLAYLIST_POSITION_GAP;
+    }
+    if (after - before < 2) {
+        return -1;
+    }
+    return before + (after - before) / 2;
+}
+
+bool DatabaseManager::renumberPlaylistLocked(int playlistId)
+{
+    QSqlQuery idQuery = prepareQuery("SELECT id FROM playlist_items WHERE playlist_id = ? ORDER BY position");
+    idQuery.addBindValue(playlistId);
+    if (!idQuery.exec()) {
+        logError("renumberPlaylist", idQuery.lastError());
+        return false;
+    }
+    
+    QList<qint64> rowIds;
+    while (idQuery.next()) {
+        rowIds.append(idQuery.value(0).toLongLong());
+    }
+    idQuery.finish();
+    
+    // Parked on negated ids so the new keys cannot collide with old ones
+    if (!executeQuery("UPDATE playlist_items SET position = -id WHERE playlist_id = ?", {playlistId})) {
+        return false;
+    }
+    
+    QSqlQuery updateQuery = prepareQuery("UPDATE playlist_items SET position = ? WHERE id = ?");
+    for (int i = 0; i < rowIds.size(); ++i) {
+        updateQuery.addBindValue((i + 1) * PLAYLIST_POSITION_GAP);
+        updateQuery.addBindValue(rowIds.at(i));
+        if (!updateQuery.exec()) {
+            logError("renumberPlaylist", updateQuery.lastError());
+            return false;
+        }
+    }
+    
+    qCDebug(dbManager) << "Renumbered playlist" << playlistId;
+    return true;
 }
 
+// Statistics and maintenance
+int DatabaseManager::getMediaFileCount()
+{
+    return getLibraryTotals().fileCount;
+}
 int DatabaseManager::getPlaylistCount()
 {
     QSqlQuery query = prepareQuery("SELECT COUNT(*) FROM playlists");
@@ -733,11 +2421,42 @@ int DatabaseManager::getPlaylistCount()
 
 qint64 DatabaseManager::getTotalLibrarySize()
 {
-    QSqlQuery query = prepareQuery("SELECT COALESCE(SUM(file_size), 0) FROM media_files");
-    if (query.exec() && query.next()) {
-        return query.value(0).toLongLong();
+    return getLibraryTotals().totalSize;
+}
+
+DatabaseManager::FacetAggregate DatabaseManager::getLibraryTotals()
+{
+    const QVector<FacetAggregate> totals = getFacetAggregates(LibraryFacet);
+    return totals.isEmpty() ? FacetAggregate() : totals.first();
+}
+
+QVector<DatabaseManager::FacetAggregate> DatabaseManager::getFacetAggregates(Facet facet, bool byFileCount,
+                                                                             int limit)
+{
+    QVector<FacetAggregate> aggregates;
+    
+    QSqlQuery query = prepareQuery(QString(
+        "SELECT value, file_count, total_size, total_duration FROM library_aggregates "
+        "WHERE facet = ? ORDER BY %1 LIMIT ?")
+        .arg(byFileCount ? "file_count DESC, value" : "value"));
+    query.addBindValue(facetName(facet));
+    query.addBindValue(limit);
+    
+    if (!query.exec()) {
+        logError("getFacetAggregates", query.lastError());
+        return aggregates;
     }
-    return 0;
+    
+    while (query.next()) {
+        FacetAggregate aggregate;
+        aggregate.value = query.value(0).toString();
+        aggregate.fileCount = query.value(1).toInt();
+        aggregate.totalSize = query.value(2).toLongLong();
+        aggregate.totalDuration = query.value(3).toLongLong();
+        aggregates.append(aggregate);
+    }
+    
+    return aggregates;
 }
 
 bool DatabaseManager::cleanupOrphanedRecords()
@@ -751,44 +2470,68 @@ bool DatabaseManager::cleanupOrphanedRecords()
     )");
 }
 
-bool DatabaseManager::optimizeDatabase()
+QFuture<bool> DatabaseManager::optimizeDatabase()
 {
-    QMutexLocker locker(&m_mutex);
-    
-    QStringList optimizeQueries = {
-        "VACUUM",
-        "ANALYZE",
-        "PRAGMA optimize"
-    };
+    // VACUUM rewrites the whole file, so it runs on the executor's writer
+    const QStringList aggregateQueries = aggregateRebuildQueries();
     
-    for (const QString& query : optimizeQueries) {
-        if (!executeQuery(query)) {
-            qCWarning(dbManager) << "Failed to execute optimization query:" << query;
+    return m_executor->write([aggregateQueries](QSqlDatabase& database) {
+        QSqlQuery query(database);
+        bool success = true;
+        
+        // Recount the aggregates in case anything wrote around the triggers
+        if (database.transaction()) {
+            bool rebuilt = true;
+            for (const QString& statement : aggregateQueries) {
+                if (!query.exec(statement)) {
+                    qCWarning(dbManager) << "Failed to rebuild aggregates:" << query.lastError().text();
+                    rebuilt = false;
+                    break;
+                }
+            }
+            
+            if (rebuilt) {
+                database.commit();
+            } else {
+                database.rollback();
+                success = false;
+            }
         }
-    }
-    
-    return true;
+        
+        const QStringList optimizeQueries = {
+            "VACUUM",
+            "ANALYZE",
+            "PRAGMA optimize"
+        };
+        
+        for (const QString& statement : optimizeQueries) {
+            if (!query.exec(statement)) {
+                qCWarning(dbManager) << "Failed to execute optimization query:" << statement
+                                     << query.lastError().text();
+                success = false;
+            }
+        }
+        
+        return success;
+    });
 }
 
 // Backup and restore
-bool DatabaseManager::createBackup(const QString& backupPath)
+QFuture<DatabaseBackup::Result> DatabaseManager::createBackup(const QString& backupPath,
+                                                              const DatabaseBackup::Options& options)
 {
-    QMutexLocker locker(&m_mutex);
-    
-    if (!m_database.isOpen()) {
-        m_lastError = "Database is not open";
-        return false;
+    if (!m_initialized) {
+        DatabaseBackup::Result result;
+        result.error = "Database not initialized";
+        QPromise<DatabaseBackup::Result> promise;
+        promise.start();
+        promise.addResult(result);
+        promise.finish();
+        return promise.future();
     }
     
-    // Simple file copy for SQLite backup
-    QFile::remove(backupPath); // Remove existing backup
-    if (QFile::copy(m_databasePath, backupPath)) {
-        qCInfo(dbManager) << "Database backup created:" << backupPath;
-        return true;
-    } else {
-        m_lastError = "Failed to create backup file";
-        return false;
-    }
+    // Not on the executor's writer: a backup of a large library would hold up every write queued behind it
+    return DatabaseBackup::create(m_databasePath, backupPath, options);
 }
 
 bool DatabaseManager::restoreFromBackup(const QString& backupPath)
@@ -800,23 +2543,28 @@ bool DatabaseManager::restoreFromBackup(const QString& backupPath)
         return false;
     }
     
-    // Close current database
+    // Close current database; queued background work finishes first
+    m_executor->close();
+    m_statementCache.clear();
     if (m_database.isOpen()) {
         m_database.close();
     }
     
     // Replace current database with backup
-    QFile::remove(m_databasePath);
-    if (QFile::copy(backupPath, m_databasePath)) {
-        // Reopen database
-        if (m_database.open()) {
-            qCInfo(dbManager) << "Database restored from backup:" << backupPath;
-            return true;
-        }
+    const bool restored = DatabaseBackup::restore(backupPath, m_databasePath, &m_lastError);
+    
+    // Reopen database
+    if (!m_database.open()) {
+        m_lastError = "Failed to reopen database after restore";
+        return false;
     }
+    installProfiler();
+    m_executor->open(m_databasePath);
     
-    m_lastError = "Failed to restore from backup";
-    return false;
+    if (restored) {
+        qCInfo(dbManager) << "Database restored from backup:" << backupPath;
+    }
+    return restored;
 }
 
 // Transaction support
@@ -851,15 +2599,159 @@ void DatabaseManager::handleDatabaseError()
 // Migration methods (placeholders for future versions)
 bool DatabaseManager::migrateToVersion2()
 {
-    // Example migration: Add new column
-    // return executeQuery("ALTER TABLE media_files ADD COLUMN new_column TEXT");
-    return true; // No migration needed for version 2 yet
+    // Persistent scan journal for incremental rescans
+    return createScanJournalTables();
 }
 
 bool DatabaseManager::migrateToVersion3()
 {
-    // Example migration: Create new table
-    return true; // No migration needed for version 3 yet
+    // Full-text search index over the existing library
+    if (!createSearchIndex()) {
+        qCWarning(dbManager) << "FTS5 unavailable, keeping LIKE search:" << lastSqlError().text();
+        return true;
+    }
+    
+    if (!createTriggers()) {
+        return false;
+    }
+    
+    return executeQuery("INSERT INTO media_search(media_search) VALUES ('rebuild')");
+}
+
+bool DatabaseManager::migrateToVersion4()
+{
+    // Persisted duplicate detection hashes
+    const QStringList queries = {
+        "ALTER TABLE media_files ADD COLUMN sample_hash TEXT",
+        "ALTER TABLE media_files ADD COLUMN content_hash TEXT",
+        "ALTER TABLE media_files ADD COLUMN hash_file_size INTEGER",
+        "ALTER TABLE media_files ADD COLUMN hash_modified_time INTEGER",
+        "CREATE INDEX IF NOT EXISTS idx_media_files_file_size ON media_files(file_size)"
+    };
+    
+    for (const QString& query : queries) {
+        if (!executeQuery(query)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool DatabaseManager::migrateToVersion5()
+{
+    // Trigger-maintained statistics and facets, seeded from the library
+    return createAggregateTable() && createTriggers() && rebuildAggregates();
+}
+
+bool DatabaseManager::migrateToVersion6()
+{
+    // Dense playlist positions become sparse sort keys, in two steps so
+    // that no intermediate value breaks UNIQUE(playlist_id, position)
+    return executeQuery("UPDATE playlist_items SET position = -(position + 1)") &&
+           executeQuery("UPDATE playlist_items SET position = -position * ?", {PLAYLIST_POSITION_GAP});
+}
+
+bool DatabaseManager::migrateToVersion7()
+{
+    // Filled in by ParentalControlManager once it is attached
+    return createContentVerdictTable();
+}
+
+bool DatabaseManager::migrateToVersion8()
+{
+    // Loudness analysis for ReplayGain, filled in by LoudnessScanner
+    const QStringList queries = {
+        "ALTER TABLE media_files ADD COLUMN loudness REAL",
+        "ALTER TABLE media_files ADD COLUMN loudness_histogram BLOB",
+        "ALTER TABLE media_files ADD COLUMN loudness_file_size INTEGER",
+        "ALTER TABLE media_files ADD COLUMN track_gain REAL",
+        "ALTER TABLE media_files ADD COLUMN track_peak REAL",
+        "ALTER TABLE media_files ADD COLUMN album_gain REAL",
+        "ALTER TABLE media_files ADD COLUMN album_peak REAL"
+    };
+    
+    for (const QString& query : queries) {
+        if (!executeQuery(query)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool DatabaseManager::migrateToVersion10()
+{
+    // Browse indexes; the single-column ones are prefixes of them now
+    QStringList queries = {
+        "DROP INDEX IF EXISTS idx_media_files_artist",
+        "DROP INDEX IF EXISTS idx_media_files_album",
+        "DROP INDEX IF EXISTS idx_media_files_genre"
+    };
+    queries += browseIndexQueries();
+    queries += "ANALYZE media_files";
+    
+    for (const QString& query : queries) {
+        if (!executeQuery(query)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool DatabaseManager::migrateToVersion9()
+{
+    // Beat grids come from the loudness pass; clearing its size stamp has
+    // tracks analyzed before this version picked up again
+    const QStringList queries = {
+        "ALTER TABLE media_files ADD COLUMN tempo_bpm REAL",
+        "ALTER TABLE media_files ADD COLUMN beat_offset_ms REAL",
+        "ALTER TABLE media_files ADD COLUMN beat_confidence REAL",
+        "UPDATE media_files SET loudness_file_size = NULL"
+    };
+    
+    for (const QString& query : queries) {
+        if (!executeQuery(query)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool DatabaseManager::migrateToVersion11()
+{
+    // Subtitle search starts empty and fills as subtitles are loaded or generated
+    return createSubtitleIndexTables();
+}
+
+bool DatabaseManager::migrateToVersion12()
+{
+    // Fingerprints are taken the first time similar videos are searched for
+    return createVideoFingerprintTable();
+}
+
+bool DatabaseManager::migrateToVersion13()
+{
+    // Existing files are fingerprinted after the next scan
+    return createAcousticFingerprintTables();
+}
+
+QString DatabaseManager::buildSearchMatch(const QString& searchTerm)
+{
+    // Each word becomes a quoted prefix query, so user input can never be
+    // parsed as FTS5 syntax; the words are implicitly ANDed
+    static const QRegularExpression separators(QStringLiteral("\\s+"));
+    const QStringList words = searchTerm.split(separators, Qt::SkipEmptyParts);
+    
+    QStringList terms;
+    for (QString word : words) {
+        word.replace(QLatin1Char('"'), QLatin1String("\"\""));
+        terms << QLatin1Char('"') + word + QLatin1String("\"*");
+    }
+    
+    return terms.join(QLatin1Char(' '));
 }
 
 // Utility methods
@@ -871,7 +2763,19 @@ bool DatabaseManager::executeQuery(const QString& query, const QVariantList& par
         sqlQuery.addBindValue(param);
     }
     
-    if (!sqlQuery.exec()) {
+    // Traced statements are profiled as SQLite finishes them
+    const bool timed = m_profiling && !STATEMENT_TRACING;
+    QElapsedTimer timer;
+    if (timed) {
+        timer.start();
+    }
+    
+    const bool executed = sqlQuery.exec();
+    if (timed) {
+        recordStatement(query, timer.nsecsElapsed() / 1000, 0, 0);
+    }
+    
+    if (!executed) {
         logError("executeQuery", sqlQuery.lastError());
         return false;
     }
@@ -881,13 +2785,208 @@ bool DatabaseManager::executeQuery(const QString& query, const QVariantList& par
 
 QSqlQuery DatabaseManager::prepareQuery(const QString& query)
 {
+    if (!m_statementResetPending) {
+        m_statementResetPending = true;
+        QTimer::singleShot(0, this, &DatabaseManager::resetCachedStatements);
+    }
+    
+    // Copies share the statement, so handing out the cached one skips the prepare
+    if (QSqlQuery* cached = m_statementCache.object(query)) {
+        cached->finish();
+        return *cached;
+    }
+    
     QSqlQuery sqlQuery(m_database);
     if (!sqlQuery.prepare(query)) {
         logError("prepareQuery", sqlQuery.lastError());
+        return sqlQuery;
     }
+    
+    m_statementCache.insert(query, new QSqlQuery(sqlQuery));
     return sqlQuery;
 }
 
+void DatabaseManager::resetCachedStatements()
+{
+    // A SELECT left unfinished keeps its read snapshot, holding back WAL checkpoints
+    m_statementResetPending = false;
+    const QList<QString> keys = m_statementCache.keys();
+    for (const QString& key : keys) {
+        QSqlQuery* cached = m_statementCache.object(key);
+        if (cached && cached->isActive() && cached->isSelect()) {
+            cached->finish();
+        }
+    }
+}
+
+void DatabaseManager::setQueryProfiling(bool enabled, int slowQueryMs)
+{
+    m_profiling = enabled;
+    m_slowQueryMs = qMax(0, slowQueryMs);
+    m_statementRows.clear();
+    installProfiler();
+    
+    if (enabled) {
+        qCInfo(dbManager) << "Query profiling on, slow-query threshold" << m_slowQueryMs << "ms";
+    }
+}
+
+QVector<DatabaseManager::StatementProfile> DatabaseManager::statementProfiles() const
+{
+    QMutexLocker locker(&m_profileMutex);
+    
+    QVector<StatementProfile> profiles;
+    profiles.reserve(m_statementStats.size());
+    for (auto it = m_statementStats.constBegin(); it != m_statementStats.constEnd(); ++it) {
+        StatementProfile profile;
+        profile.sql = it.key();
+        profile.latency = it.value()->latency->snapshot();
+        profile.rowsScanned = it.value()->rowsScanned;
+        profile.rowsReturned = it.value()->rowsReturned;
+        profile.slowCount = it.value()->slowCount;
+        profile.queryPlan = it.value()->queryPlan;
+        profiles.append(profile);
+    }
+    return profiles;
+}
+
+void DatabaseManager::installProfiler()
+{
+#ifdef HAVE_SQLITE3
+    if (!m_database.isOpen()) {
+        return;
+    }
+    
+    const QVariant handle = m_database.driver()->handle();
+    if (!handle.isValid() || qstrcmp(handle.typeName(), "sqlite3*") != 0) {
+        return;
+    }
+    sqlite3* connection = *static_cast<sqlite3* const*>(handle.constData());
+    if (connection) {
+        sqlite3_trace_v2(connection, m_profiling ? SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW : 0,
+                         m_profiling ? &DatabaseManager::profileCallback : nullptr, this);
+    }
+#endif
+}
+
+int DatabaseManager::profileCallback(unsigned type, void* context, void* statement, void* detail)
+{
+#ifdef HAVE_SQLITE3
+    auto* manager = static_cast<DatabaseManager*>(context);
+    if (manager->m_explaining) {
+        return 0;
+    }
+    
+    if (type == SQLITE_TRACE_ROW) {
+        ++manager->m_statementRows[statement];
+    } else if (type == SQLITE_TRACE_PROFILE) {
+        // Reported once a run finishes; the scan counter is reset for the next run
+        auto* sqliteStatement = static_cast<sqlite3_stmt*>(statement);
+        const qint64 elapsedNs = *static_cast<const sqlite3_int64*>(detail);
+        const quint64 rowsScanned = quint64(sqlite3_stmt_status(sqliteStatement, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1));
+        const quint64 rowsReturned = manager->m_statementRows.take(statement);
+        manager->recordStatement(QString::fromUtf8(sqlite3_sql(sqliteStatement)), elapsedNs / 1000,
+                                 rowsScanned, rowsReturned);
+    }
+#else
+    Q_UNUSED(type)
+    Q_UNUSED(context)
+    Q_UNUSED(statement)
+    Q_UNUSED(detail)
+#endif
+    return 0;
+}
+
+void DatabaseManager::recordStatement(const QString& sql, qint64 elapsedUs, quint64 rowsScanned, quint64 rowsReturned)
+{
+    static LatencyHistogram& statementLatency = MetricsRegistry::instance().histogram(
+        "eonplay_db_statement_seconds", "Time to run one statement on the main database connection");
+    static MetricCounter& scannedRows = MetricsRegistry::instance().counter(
+        "eonplay_db_rows_scanned", "Rows stepped through by full table scans");
+    static MetricCounter& returnedRows = MetricsRegistry::instance().counter(
+        "eonplay_db_rows_returned", "Rows returned by database statements");
+    static MetricCounter& slowQueries = MetricsRegistry::instance().counter(
+        "eonplay_db_slow_queries", "Statements slower than the slow-query threshold");
+    
+    statementLatency.record(elapsedUs);
+    scannedRows.add(rowsScanned);
+    returnedRows.add(rowsReturned);
+    
+    const bool slow = elapsedUs >= qint64(m_slowQueryMs) * 1000;
+    bool explain = false;
+    {
+        QMutexLocker locker(&m_profileMutex);
+        
+        // Statements built with inlined values would grow the table without bound
+        QString key = sql;
+        if (!m_statementStats.contains(key) && m_statementStats.size() >= MAX_PROFILED_STATEMENTS) {
+            key.clear();
+        }
+        
+        std::shared_ptr<StatementStats>& stats = m_statementStats[key];
+        if (!stats) {
+            stats = std::make_shared<StatementStats>();
+            stats->latency = std::make_unique<LatencyHistogram>("eonplay_db_statement", QByteArray());
+        }
+        stats->latency->record(elapsedUs);
+        stats->rowsScanned += rowsScanned;
+        stats->rowsReturned += rowsReturned;
+        if (slow) {
+            ++stats->slowCount;
+            explain = !key.isEmpty() && stats->slowCount == 1;
+        }
+    }
+    
+    if (!slow) {
+        return;
+    }
+    
+    slowQueries.add();
+    qCWarning(dbManager) << "Slow query:" << elapsedUs / 1000 << "ms," << rowsScanned << "rows scanned,"
+                         << rowsReturned << "returned:" << sql.simplified();
+    
+    // Explained outside SQLite's callback, once per statement
+    if (explain) {
+        m_pendingExplains.append(sql);
+        if (m_pendingExplains.size() == 1) {
+            QTimer::singleShot(0, this, &DatabaseManager::explainSlowStatements);
+        }
+    }
+}
+
+void DatabaseManager::explainSlowStatements()
+{
+    const QStringList statements = m_pendingExplains;
+    m_pendingExplains.clear();
+    if (!m_database.isOpen()) {
+        return;
+    }
+    
+    m_explaining = true;
+    for (const QString& sql : statements) {
+        // Unbound parameters are NULL, which leaves the plan as it is
+        QSqlQuery explainQuery(m_database);
+        QStringList steps;
+        if (explainQuery.exec("EXPLAIN QUERY PLAN " + sql)) {
+            while (explainQuery.next()) {
+                steps.append(explainQuery.value("detail").toString());
+            }
+        }
+        if (steps.isEmpty()) {
+            continue;
+        }
+        
+        const QString plan = steps.join("; ");
+        qCWarning(dbManager) << "Query plan:" << plan << "for" << sql.simplified();
+        
+        QMutexLocker locker(&m_profileMutex);
+        if (const std::shared_ptr<StatementStats> stats = m_statementStats.value(sql)) {
+            stats->queryPlan = plan;
+        }
+    }
+    m_explaining = false;
+}
+
 bool DatabaseManager::tableExists(const QString& tableName)
 {
     QSqlQuery query = prepareQuery("SELECT name FROM sqlite_master WHERE type='table' AND name=?");
@@ -0,0 +1,251 @@
+#include "data/DirectoryWatcher.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QStorageInfo>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QLoggingCategory>
+#include <QDebug>
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+Q_LOGGING_CATEGORY(directoryWatcher, "eonplay.data.watcher")
+
+namespace EonPlay {
+namespace Data {
+
+DirectoryWatcher::DirectoryWatcher(QObject* parent)
+    : QObject(parent)
+    , m_debounceTimer(new QTimer(this))
+    , m_pollTimer(new QTimer(this))
+    , m_pollPool(new QThreadPool(this))
+    , m_pollRunning(false)
+{
+    // The window opens with the first event and is not extended by later
+    // ones, so a steady stream of writes still gets reported
+    m_debounceTimer->setSingleShot(true);
+    m_debounceTimer->setInterval(DEFAULT_DEBOUNCE_MS);
+    connect(m_debounceTimer, &QTimer::timeout, this, &DirectoryWatcher::flushChanges);
+
+    m_pollTimer->setInterval(DEFAULT_POLL_INTERVAL_MS);
+    connect(m_pollTimer, &QTimer::timeout, this, &DirectoryWatcher::pollRoots);
+
+    m_pollPool->setMaxThreadCount(1);
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+    // A running poll posts its results back to this object
+    m_pollPool->waitForDone();
+}
+
+DirectoryWatcher* DirectoryWatcher::create(QObject* parent)
+{
+    DirectoryWatcher* watcher = createNative(parent);
+    qCInfo(directoryWatcher) << "Using" << watcher->backendName() << "directory watcher";
+    return watcher;
+}
+
+bool DirectoryWatcher::addPath(const QString& rootPath)
+{
+    const QString root = QDir(rootPath).absolutePath();
+    if (m_nativeRoots.contains(root) || m_pollSnapshots.contains(root)) {
+        return true;
+    }
+
+    if (!QFileInfo(root).isDir()) {
+        qCWarning(directoryWatcher) << "Cannot watch missing directory:" << root;
+        return false;
+    }
+
+    // Native notification does not see changes made by other machines
+    if (!isNetworkPath(root) && watchRoot(root)) {
+        m_nativeRoots << root;
+        qCDebug(directoryWatcher) << "Watching" << root << "with" << backendName();
+        return true;
+    }
+
+    qCInfo(directoryWatcher) << "Polling" << root << "every" << m_pollTimer->interval() << "ms";
+    m_pollSnapshots.insert(root, TreeSnapshot());
+    if (!m_pollTimer->isActive()) {
+        m_pollTimer->start();
+    }
+
+    // Take the baseline right away
+    pollRoots();
+    return true;
+}
+
+void DirectoryWatcher::removePath(const QString& rootPath)
+{
+    const QString root = QDir(rootPath).absolutePath();
+
+    if (m_nativeRoots.removeAll(root) > 0) {
+        unwatchRoot(root);
+    }
+
+    m_pollSnapshots.remove(root);
+    if (m_pollSnapshots.isEmpty()) {
+        m_pollTimer->stop();
+    }
+}
+
+void DirectoryWatcher::clear()
+{
+    const QStringList roots = paths();
+    for (const QString& root : roots) {
+        removePath(root);
+    }
+}
+
+QStringList DirectoryWatcher::paths() const
+{
+    return m_nativeRoots + m_pollSnapshots.keys();
+}
+
+bool DirectoryWatcher::isNetworkPath(const QString& path)
+{
+#ifdef Q_OS_WIN
+    const QString nativePath = QDir::toNativeSeparators(QDir(path).absolutePath());
+    if (nativePath.startsWith(QLatin1String("\\\\"))) {
+        return true;
+    }
+
+    const QString drive = nativePath.left(3);
+    return GetDriveTypeW(reinterpret_cast<const wchar_t*>(drive.utf16())) == DRIVE_REMOTE;
+#else
+    static const QStringList networkTypes = {
+        "nfs", "nfs4", "cifs", "smb", "smb2", "smbfs", "afpfs", "webdav", "davfs", "9p", "afs", "ceph"
+    };
+
+    const QString type = QString::fromLatin1(QStorageInfo(path).fileSystemType()).toLower();
+
+    // FUSE mounts such as sshfs report "fuse.<name>"
+    if (type.startsWith(QLatin1String("fuse.sshfs"))) {
+        return true;
+    }
+
+    return networkTypes.contains(type);
+#endif
+}
+
+void DirectoryWatcher::reportChange(const QString& directoryPath)
+{
+    bool firstChange = false;
+    {
+        QMutexLocker locker(&m_changeMutex);
+        firstChange = m_changedDirectories.isEmpty();
+        m_changedDirectories.insert(directoryPath);
+    }
+
+    if (firstChange) {
+        QMetaObject::invokeMethod(this, [this]() {
+            if (!m_debounceTimer->isActive()) {
+                m_debounceTimer->start();
+            }
+        }, Qt::QueuedConnection);
+    }
+}
+
+void DirectoryWatcher::flushChanges()
+{
+    QSet<QString> changed;
+    {
+        QMutexLocker locker(&m_changeMutex);
+        changed.swap(m_changedDirectories);
+    }
+
+    if (changed.isEmpty()) {
+        return;
+    }
+
+    QStringList directoryPaths = changed.values();
+    std::sort(directoryPaths.begin(), directoryPaths.end());
+
+    qCDebug(directoryWatcher) << "Reporting" << directoryPaths.size() << "changed directories";
+    emit directoriesChanged(directoryPaths);
+}
+
+void DirectoryWatcher::pollRoots()
+{
+    if (m_pollRunning || m_pollSnapshots.isEmpty()) {
+        return;
+    }
+
+    m_pollRunning = true;
+    const QStringList roots = m_pollSnapshots.keys();
+
+    // Walking a network share can take seconds, so it runs off this thread
+    m_pollPool->start([this, roots]() {
+        QHash<QString, TreeSnapshot> snapshots;
+        for (const QString& root : roots) {
+            snapshots.insert(root, snapshotTree(root));
+        }
+
+        QMetaObject::invokeMethod(this, [this, snapshots]() {
+            applyPollResults(snapshots);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DirectoryWatcher::applyPollResults(const QHash<QString, TreeSnapshot>& snapshots)
+{
+    m_pollRunning = false;
+
+    for (auto it = snapshots.constBegin(); it != snapshots.constEnd(); ++it) {
+        auto previous = m_pollSnapshots.find(it.key());
+        if (previous == m_pollSnapshots.end()) {
+            continue; // Removed while polling
+        }
+
+        const TreeSnapshot& current = it.value();
+
+        // An empty snapshot is the baseline still being taken
+        if (!previous->isEmpty()) {
+            for (auto dir = current.constBegin(); dir != current.constEnd(); ++dir) {
+                if (previous->value(dir.key(), -1) != dir.value()) {
+                    reportChange(dir.key());
+                }
+            }
+
+            for (auto dir = previous->constBegin(); dir != previous->constEnd(); ++dir) {
+                if (!current.contains(dir.key())) {
+                    reportChange(QFileInfo(dir.key()).absolutePath());
+                }
+            }
+        }
+
+        *previous = current;
+    }
+}
+
+DirectoryWatcher::TreeSnapshot DirectoryWatcher::snapshotTree(const QString& rootPath)
+{
+    // Directory mtimes change whenever entries are added, removed or renamed
+    TreeSnapshot snapshot;
+    snapshot.insert(rootPath, QFileInfo(rootPath).lastModified().toMSecsSinceEpoch());
+
+    QDirIterator iterator(rootPath, QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks,
+                          QDirIterator::Subdirectories);
+    while (iterator.hasNext()) {
+        iterator.next();
+        snapshot.insert(iterator.filePath(), iterator.fileInfo().lastModified().toMSecsSinceEpoch());
+    }
+
+    return snapshot;
+}
+
+#if !defined(Q_OS_LINUX) && !defined(Q_OS_WIN) && !defined(Q_OS_MACOS)
+DirectoryWatcher* DirectoryWatcher::createNative(QObject* parent)
+{
+    return new PollingDirectoryWatcher(parent);
+}
+#endif
+
+} // namespace Data
+} // namespace EonPlay
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include "data/DirectoryWatcher.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QLoggingCategory>
+#include <QDebug>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+Q_DECLARE_LOGGING_CATEGORY(directoryWatcher)
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+
+/**
+ * @brief inotify backend with recursive bookkeeping
+ *
+ * inotify watches single directories, so every directory of a tree gets
+ * its own watch; new subdirectories are added as they appear and watches
+ * of deleted ones are dropped. fanotify would need CAP_SYS_ADMIN to report
+ * directory entry events, which a media player does not have.
+ */
+class InotifyDirectoryWatcher : public DirectoryWatcher
+{
+public:
+    explicit InotifyDirectoryWatcher(int fd, QObject* parent)
+        : DirectoryWatcher(parent)
+        , m_fd(fd)
+        , m_notifier(new QSocketNotifier(fd, QSocketNotifier::Read, this))
+    {
+        connect(m_notifier, &QSocketNotifier::activated, this, [this]() { readEvents(); });
+    }
+
+    ~InotifyDirectoryWatcher() override
+    {
+        delete m_notifier;
+        ::close(m_fd);
+    }
+
+    QString backendName() const override { return QStringLiteral("inotify"); }
+
+protected:
+    bool watchRoot(const QString& rootPath) override
+    {
+        if (!addWatch(rootPath)) {
+            return false;
+        }
+
+        QDirIterator iterator(rootPath, QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks,
+                              QDirIterator::Subdirectories);
+        while (iterator.hasNext()) {
+            if (!addWatch(iterator.next())) {
+                // Out of watches: give the whole tree to the polling fallback
+                unwatchRoot(rootPath);
+                return false;
+            }
+        }
+
+        m_roots << rootPath;
+        return true;
+    }
+
+    void unwatchRoot(const QString& rootPath) override
+    {
+        m_roots.removeAll(rootPath);
+        removeTree(rootPath);
+    }
+
+private:
+    static constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                           IN_CLOSE_WRITE | IN_DELETE_SELF | IN_ONLYDIR;
+
+    void removeTree(const QString& directoryPath)
+    {
+        const QString prefix = directoryPath + QLatin1Char('/');
+        for (auto it = m_watchedPaths.begin(); it != m_watchedPaths.end();) {
+            if (it.key() == directoryPath || it.key().startsWith(prefix)) {
+                inotify_rm_watch(m_fd, it.value());
+                m_watchDescriptors.remove(it.value());
+                it = m_watchedPaths.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    bool addWatch(const QString& directoryPath)
+    {
+        if (m_watchedPaths.contains(directoryPath)) {
+            return true;
+        }
+
+        const int wd = inotify_add_watch(m_fd, QFile::encodeName(directoryPath).constData(), WATCH_MASK);
+        if (wd < 0) {
+            if (errno == ENOSPC) {
+                qCWarning(directoryWatcher) << "inotify watch limit reached at" << directoryPath
+                                            << "- raise fs.inotify.max_user_watches";
+                return false;
+            }
+
+            // Vanished or unreadable directories are simply not watched
+            qCDebug(directoryWatcher) << "Cannot watch" << directoryPath << ":" << strerror(errno);
+            return true;
+        }
+
+        m_watchDescriptors.insert(wd, directoryPath);
+        m_watchedPaths.insert(directoryPath, wd);
+        return true;
+    }
+
+    void addTree(const QString& directoryPath)
+    {
+        if (!addWatch(directoryPath)) {
+            return;
+        }
+
+        QDirIterator iterator(directoryPath, QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks,
+                              QDirIterator::Subdirectories);
+        while (iterator.hasNext()) {
+            if (!addWatch(iterator.next())) {
+                return;
+            }
+        }
+    }
+
+    void readEvents()
+    {
+        alignas(struct inotify_event) char buffer[16 * 1024];
+
+        for (;;) {
+            const ssize_t length = ::read(m_fd, buffer, sizeof(buffer));
+            if (length <= 0) {
+                break;
+            }
+
+            for (ssize_t offset = 0; offset < length;) {
+                const auto* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+                offset += sizeof(struct inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    // Events were lost; every tree needs a rescan
+                    for (const QString& root : m_roots) {
+                        reportChange(root);
+                    }
+                    continue;
+                }
+
+                const QString directoryPath = m_watchDescriptors.value(event->wd);
+                if (directoryPath.isEmpty()) {
+                    continue;
+                }
+
+                if (event->mask & IN_IGNORED) {
+                    m_watchDescriptors.remove(event->wd);
+                    m_watchedPaths.remove(directoryPath);
+                    continue;
+                }
+
+                if ((event->mask & IN_ISDIR) && event->len > 0) {
+                    const QString entryPath = directoryPath + QLatin1Char('/') + QFile::decodeName(event->name);
+
+                    // Watches follow subdirectories moved in or out by path
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                        addTree(entryPath);
+                    } else if (event->mask & IN_MOVED_FROM) {
+                        removeTree(entryPath);
+                    }
+                }
+
+                if (!(event->mask & IN_DELETE_SELF)) {
+                    reportChange(directoryPath);
+                }
+            }
+        }
+    }
+
+    int m_fd;
+    QSocketNotifier* m_notifier;
+    QStringList m_roots;
+    QHash<int, QString> m_watchDescriptors;
+    QHash<QString, int> m_watchedPaths;
+};
+
+} // namespace
+
+DirectoryWatcher* DirectoryWatcher::createNative(QObject* parent)
+{
+    const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        qCWarning(directoryWatcher) << "inotify unavailable:" << strerror(errno);
+        return new PollingDirectoryWatcher(parent);
+    }
+
+    return new InotifyDirectoryWatcher(fd, parent);
+}
+
+} // namespace Data
+} // namespace EonPlay
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "data/DirectoryWatcher.h"
+#include <QDir>
+#include <QLoggingCategory>
+#include <QDebug>
+
+#include <CoreServices/CoreServices.h>
+#include <dispatch/dispatch.h>
+
+Q_DECLARE_LOGGING_CATEGORY(directoryWatcher)
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+
+/**
+ * @brief FSEvents backend
+ *
+ * One stream per tree. FSEvents is recursive and already reports at
+ * directory granularity, so paths are forwarded as they arrive on the
+ * private dispatch queue.
+ */
+class FSEventsDirectoryWatcher : public DirectoryWatcher
+{
+public:
+    explicit FSEventsDirectoryWatcher(QObject* parent)
+        : DirectoryWatcher(parent)
+        , m_queue(dispatch_queue_create("org.eonplay.directorywatcher", DISPATCH_QUEUE_SERIAL))
+    {
+    }
+
+    ~FSEventsDirectoryWatcher() override
+    {
+        const QStringList roots = m_streams.keys();
+        for (const QString& root : roots) {
+            unwatchRoot(root);
+        }
+        dispatch_release(m_queue);
+    }
+
+    QString backendName() const override { return QStringLiteral("FSEvents"); }
+
+protected:
+    bool watchRoot(const QString& rootPath) override
+    {
+        CFStringRef path = rootPath.toCFString();
+        CFArrayRef paths = CFArrayCreate(nullptr, reinterpret_cast<const void**>(&path), 1,
+                                         &kCFTypeArrayCallBacks);
+
+        FSEventStreamContext context = {};
+        context.info = this;
+
+        // The latency lets FSEvents merge bursts before we coalesce further
+        FSEventStreamRef stream = FSEventStreamCreate(nullptr, &FSEventsDirectoryWatcher::callback,
+                                                      &context, paths, kFSEventStreamEventIdSinceNow,
+                                                      0.5, kFSEventStreamCreateFlagWatchRoot);
+        CFRelease(paths);
+        CFRelease(path);
+
+        if (!stream) {
+            qCWarning(directoryWatcher) << "Cannot create FSEvents stream for" << rootPath;
+            return false;
+        }
+
+        FSEventStreamSetDispatchQueue(stream, m_queue);
+        if (!FSEventStreamStart(stream)) {
+            FSEventStreamInvalidate(stream);
+            FSEventStreamRelease(stream);
+            return false;
+        }
+
+        m_streams.insert(rootPath, stream);
+        return true;
+    }
+
+    void unwatchRoot(const QString& rootPath) override
+    {
+        FSEventStreamRef stream = m_streams.take(rootPath);
+        if (!stream) {
+            return;
+        }
+
+        FSEventStreamStop(stream);
+        FSEventStreamInvalidate(stream);
+        FSEventStreamRelease(stream);
+
+        // Let callbacks already queued for this stream finish
+        dispatch_sync_f(m_queue, nullptr, [](void*) {});
+    }
+
+private:
+    static void callback(ConstFSEventStreamRef stream, void* info, size_t count, void* eventPaths,
+                         const FSEventStreamEventFlags* flags, const FSEventStreamEventId* ids)
+    {
+        Q_UNUSED(stream)
+        Q_UNUSED(flags)
+        Q_UNUSED(ids)
+
+        auto* watcher = static_cast<FSEventsDirectoryWatcher*>(info);
+        char** paths = static_cast<char**>(eventPaths);
+        for (size_t i = 0; i < count; ++i) {
+            watcher->reportChange(QDir::cleanPath(QString::fromUtf8(paths[i])));
+        }
+    }
+
+    dispatch_queue_t m_queue;
+    QHash<QString, FSEventStreamRef> m_streams;
+};
+
+} // namespace
+
+DirectoryWatcher* DirectoryWatcher::createNative(QObject* parent)
+{
+    return new FSEventsDirectoryWatcher(parent);
+}
+
+} // namespace Data
+} // namespace EonPlay
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "data/DirectoryWatcher.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QLoggingCategory>
+#include <QDebug>
+#include <memory>
+
+#include <windows.h>
+
+Q_DECLARE_LOGGING_CATEGORY(directoryWatcher)
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+
+/**
+ * @brief ReadDirectoryChangesW backend
+ *
+ * One recursive watch per tree, each served by its own thread that waits
+ * on the overlapped read and a stop event.
+ */
+class WindowsDirectoryWatcher : public DirectoryWatcher
+{
+public:
+    explicit WindowsDirectoryWatcher(QObject* parent)
+        : DirectoryWatcher(parent)
+    {
+    }
+
+    ~WindowsDirectoryWatcher() override
+    {
+        const QStringList roots = m_roots.keys();
+        for (const QString& root : roots) {
+            unwatchRoot(root);
+        }
+    }
+
+    QString backendName() const override { return QStringLiteral("ReadDirectoryChangesW"); }
+
+protected:
+    bool watchRoot(const QString& rootPath) override
+    {
+        const std::wstring nativePath = QDir::toNativeSeparators(rootPath).toStdWString();
+        HANDLE directory = CreateFileW(nativePath.c_str(), FILE_LIST_DIRECTORY,
+                                       FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                       nullptr, OPEN_EXISTING,
+                                       FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+        if (directory == INVALID_HANDLE_VALUE) {
+            qCWarning(directoryWatcher) << "Cannot open" << rootPath << "for watching:" << GetLastError();
+            return false;
+        }
+
+        auto watch = std::make_shared<Watch>();
+        watch->directory = directory;
+        watch->stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        watch->thread = QThread::create([this, rootPath, watch]() {
+            run(rootPath, *watch);
+        });
+        watch->thread->start();
+
+        m_roots.insert(rootPath, watch);
+        return true;
+    }
+
+    void unwatchRoot(const QString& rootPath) override
+    {
+        std::shared_ptr<Watch> watch = m_roots.take(rootPath);
+        if (!watch) {
+            return;
+        }
+
+        SetEvent(watch->stopEvent);
+        watch->thread->wait();
+        delete watch->thread;
+        CloseHandle(watch->stopEvent);
+        CloseHandle(watch->directory);
+    }
+
+private:
+    struct Watch {
+        HANDLE directory = INVALID_HANDLE_VALUE;
+        HANDLE stopEvent = nullptr;
+        QThread* thread = nullptr;
+    };
+
+    static constexpr DWORD NOTIFY_FILTER = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+                                           FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+
+    void run(const QString& rootPath, const Watch& watch)
+    {
+        // DWORD alignment is required for FILE_NOTIFY_INFORMATION
+        alignas(DWORD) char buffer[64 * 1024];
+
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+        for (;;) {
+            ResetEvent(overlapped.hEvent);
+            if (!ReadDirectoryChangesW(watch.directory, buffer, sizeof(buffer), TRUE, NOTIFY_FILTER,
+                                       nullptr, &overlapped, nullptr)) {
+                qCWarning(directoryWatcher) << "Watching" << rootPath << "failed:" << GetLastError();
+                break;
+            }
+
+            HANDLE events[2] = { overlapped.hEvent, watch.stopEvent };
+            const DWORD signaled = WaitForMultipleObjects(2, events, FALSE, INFINITE);
+
+            DWORD bytes = 0;
+            if (signaled != WAIT_OBJECT_0) {
+                CancelIo(watch.directory);
+                GetOverlappedResult(watch.directory, &overlapped, &bytes, TRUE);
+                break;
+            }
+
+            if (!GetOverlappedResult(watch.directory, &overlapped, &bytes, FALSE)) {
+                break;
+            }
+
+            if (bytes == 0) {
+                // The buffer overflowed and events were lost
+                reportChange(rootPath);
+                continue;
+            }
+
+            for (DWORD offset = 0;;) {
+                const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer + offset);
+                const QString name = QString::fromWCharArray(info->FileName,
+                                                             info->FileNameLength / sizeof(WCHAR));
+                const QString entryPath = rootPath + QLatin1Char('/') + QDir::fromNativeSeparators(name);
+                reportChange(QFileInfo(entryPath).absolutePath());
+
+                if (info->NextEntryOffset == 0) {
+                    break;
+                }
+                offset += info->NextEntryOffset;
+            }
+        }
+
+        CloseHandle(overlapped.hEvent);
+    }
+
+    QHash<QString, std::shared_ptr<Watch>> m_roots;
+};
+
+} // namespace
+
+DirectoryWatcher* DirectoryWatcher::createNative(QObject* parent)
+{
+    return new WindowsDirectoryWatcher(parent);
+}
+
+} // namespace Data
+} // namespace EonPlay
\ No newline at end of file
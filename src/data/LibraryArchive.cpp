@@ -0,0 +1,392 @@
+#include "data/LibraryArchive.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QtEndian>
+
+Q_LOGGING_CATEGORY(libraryArchive, "eonplay.data.libraryarchive")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+// Buffered output is written, and input read, in blocks of this size
+const int WRITE_BLOCK_BYTES = 256 * 1024;
+const int READ_BLOCK_BYTES = 256 * 1024;
+
+const char BINARY_MAGIC[] = "EPLB";
+const int BINARY_MAGIC_SIZE = 4;
+const quint8 BINARY_VERSION = 1;
+const int BINARY_BLOCK_ROWS = 1000;
+const quint32 MAX_BINARY_BLOCK_BYTES = 64 * 1024 * 1024;
+
+QJsonObject toJson(const LibraryArchive::Entry& entry)
+{
+    QJsonObject object;
+    object["id"] = entry.id;
+    object["file_path"] = entry.filePath;
+    object["title"] = entry.title;
+    object["artist"] = entry.artist;
+    object["album"] = entry.album;
+    object["genre"] = entry.genre;
+    object["duration"] = entry.duration;
+    object["file_size"] = entry.fileSize;
+    object["date_added"] = entry.dateAdded;
+    object["play_count"] = entry.playCount;
+    return object;
+}
+
+LibraryArchive::Entry fromJson(const QJsonObject& object)
+{
+    LibraryArchive::Entry entry;
+    entry.id = object["id"].toInteger();
+    entry.filePath = object["file_path"].toString();
+    entry.title = object["title"].toString();
+    entry.artist = object["artist"].toString();
+    entry.album = object["album"].toString();
+    entry.genre = object["genre"].toString();
+    entry.duration = object["duration"].toInteger();
+    entry.fileSize = object["file_size"].toInteger();
+    entry.dateAdded = object["date_added"].toString();
+    entry.playCount = object["play_count"].toInt();
+    return entry;
+}
+
+void writeBinaryEntry(QDataStream& stream, const LibraryArchive::Entry& entry)
+{
+    stream << entry.id << entry.filePath.toUtf8() << entry.title.toUtf8() << entry.artist.toUtf8()
+           << entry.album.toUtf8() << entry.genre.toUtf8() << entry.duration << entry.fileSize
+           << entry.dateAdded.toUtf8() << qint32(entry.playCount);
+}
+
+bool readBinaryEntry(QDataStream& stream, LibraryArchive::Entry& entry)
+{
+    QByteArray filePath, title, artist, album, genre, dateAdded;
+    qint32 playCount = 0;
+    stream >> entry.id >> filePath >> title >> artist >> album >> genre >> entry.duration >> entry.fileSize
+           >> dateAdded >> playCount;
+    if (stream.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    entry.filePath = QString::fromUtf8(filePath);
+    entry.title = QString::fromUtf8(title);
+    entry.artist = QString::fromUtf8(artist);
+    entry.album = QString::fromUtf8(album);
+    entry.genre = QString::fromUtf8(genre);
+    entry.dateAdded = QString::fromUtf8(dateAdded);
+    entry.playCount = playCount;
+    return true;
+}
+
+bool writeJson(QSaveFile& file, const LibraryArchive::EntrySource& source, int& written)
+{
+    QByteArray buffer;
+    buffer.reserve(WRITE_BLOCK_BYTES + 4096);
+    bool success = true;
+    auto flush = [&]() {
+        success = success && file.write(buffer) == buffer.size();
+        buffer.clear();
+    };
+
+    buffer += "{\n    \"export_date\": \"" + QDateTime::currentDateTime().toString(Qt::ISODate).toUtf8()
+              + "\",\n    \"files\": [";
+
+    LibraryArchive::Entry entry;
+    while (success && source(entry)) {
+        buffer += written == 0 ? "\n        " : ",\n        ";
+        buffer += QJsonDocument(toJson(entry)).toJson(QJsonDocument::Compact);
+        ++written;
+        if (buffer.size() >= WRITE_BLOCK_BYTES) {
+            flush();
+        }
+    }
+
+    buffer += "\n    ],\n    \"total_files\": " + QByteArray::number(written) + "\n}\n";
+    flush();
+    return success;
+}
+
+bool writeBinary(QSaveFile& file, const LibraryArchive::EntrySource& source, int& written)
+{
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out.writeRawData(BINARY_MAGIC, BINARY_MAGIC_SIZE);
+    out << BINARY_VERSION;
+
+    QByteArray block;
+    QDataStream blockStream(&block, QIODevice::WriteOnly);
+    blockStream.setVersion(QDataStream::Qt_6_0);
+    quint32 blockRows = 0;
+    auto flush = [&]() {
+        // A zero row count ends the archive, so empty blocks are never written
+        if (blockRows > 0) {
+            out << blockRows << qCompress(block);
+            block.clear();
+            blockStream.device()->seek(0);
+            blockRows = 0;
+        }
+    };
+
+    LibraryArchive::Entry entry;
+    while (out.status() == QDataStream::Ok && source(entry)) {
+        writeBinaryEntry(blockStream, entry);
+        ++blockRows;
+        ++written;
+        if (blockRows >= BINARY_BLOCK_ROWS) {
+            flush();
+        }
+    }
+    flush();
+    out << quint32(0);
+
+    return out.status() == QDataStream::Ok;
+}
+
+bool readJson(QFile& file, const LibraryArchive::BatchHandler& handler, int batchSize)
+{
+    QList<LibraryArchive::Entry> batch;
+    batch.reserve(batchSize);
+
+    // Tracks just enough structure to find the elements of the root's
+    // "files" array; each element is then parsed on its own
+    int depth = 0;
+    bool inString = false;
+    bool escaped = false;
+    QByteArray lastKey;         // Last string seen directly in the root object
+    bool inFiles = false;
+    bool inRecord = false;
+    QByteArray record;
+
+    while (!file.atEnd()) {
+        const QByteArray chunk = file.read(READ_BLOCK_BYTES);
+        if (chunk.isEmpty()) {
+            qCWarning(libraryArchive) << "Cannot read library archive:" << file.errorString();
+            return false;
+        }
+
+        qsizetype recordStart = 0;
+        const char* data = chunk.constData();
+        for (qsizetype i = 0; i < chunk.size(); ++i) {
+            const char c = data[i];
+            if (inString) {
+                if (escaped) {
+                    escaped = false;
+                } else if (c == '\\') {
+                    escaped = true;
+                } else if (c == '"') {
+                    inString = false;
+                } else if (depth == 1) {
+                    lastKey += c;
+                }
+                continue;
+            }
+
+            switch (c) {
+            case '"':
+                inString = true;
+                if (depth == 1) {
+                    lastKey.clear();
+                }
+                break;
+            case '[':
+            case '{':
+                if (depth == 1 && c == '[' && lastKey == "files") {
+                    inFiles = true;
+                } else if (inFiles && depth == 2 && c == '{') {
+                    inRecord = true;
+                    recordStart = i;
+                }
+                ++depth;
+                break;
+            case ']':
+            case '}':
+                --depth;
+                if (depth < 0) {
+                    return false;
+                }
+                if (inRecord && depth == 2) {
+                    record.append(data + recordStart, i - recordStart + 1);
+                    inRecord = false;
+
+                    QJsonParseError error;
+                    const QJsonDocument document = QJsonDocument::fromJson(record, &error);
+                    record.clear();
+                    if (!document.isObject()) {
+                        qCWarning(libraryArchive) << "Skipping malformed library entry:" << error.errorString();
+                        break;
+                    }
+
+                    batch.append(fromJson(document.object()));
+                    if (batch.size() >= batchSize) {
+                        if (!handler(batch)) {
+                            return false;
+                        }
+                        batch.clear();
+                    }
+                } else if (inFiles && depth == 1) {
+                    inFiles = false;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        // The rest of a record continues in the next chunk
+        if (inRecord) {
+            record.append(data + recordStart, chunk.size() - recordStart);
+        }
+    }
+
+    if (depth != 0 || inString) {
+        qCWarning(libraryArchive) << "Library archive is truncated:" << file.fileName();
+        return false;
+    }
+
+    return batch.isEmpty() || handler(batch);
+}
+
+bool readBinary(QFile& file, const LibraryArchive::BatchHandler& handler, int batchSize)
+{
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    char magic[BINARY_MAGIC_SIZE];
+    quint8 version = 0;
+    if (in.readRawData(magic, BINARY_MAGIC_SIZE) != BINARY_MAGIC_SIZE ||
+        qstrncmp(magic, BINARY_MAGIC, BINARY_MAGIC_SIZE) != 0) {
+        return false;
+    }
+    in >> version;
+    if (version != BINARY_VERSION) {
+        qCWarning(libraryArchive) << "Unsupported library archive version" << version;
+        return false;
+    }
+
+    QList<LibraryArchive::Entry> batch;
+    batch.reserve(batchSize);
+
+    for (;;) {
+        quint32 blockRows = 0;
+        in >> blockRows;
+        if (in.status() != QDataStream::Ok) {
+            qCWarning(libraryArchive) << "Library archive is truncated:" << file.fileName();
+            return false;
+        }
+        if (blockRows == 0) {
+            break;
+        }
+
+        // Peek at the size so a corrupt length cannot make us allocate gigabytes
+        QByteArray compressed;
+        quint32 compressedSize = 0;
+        if (file.peek(reinterpret_cast<char*>(&compressedSize), sizeof(compressedSize)) != sizeof(compressedSize) ||
+            qFromBigEndian(compressedSize) > MAX_BINARY_BLOCK_BYTES) {
+            return false;
+        }
+        in >> compressed;
+
+        const QByteArray block = qUncompress(compressed);
+        if (in.status() != QDataStream::Ok || block.isEmpty()) {
+            qCWarning(libraryArchive) << "Corrupt block in library archive:" << file.fileName();
+            return false;
+        }
+
+        QDataStream blockStream(block);
+        blockStream.setVersion(QDataStream::Qt_6_0);
+        for (quint32 row = 0; row < blockRows; ++row) {
+            LibraryArchive::Entry entry;
+            if (!readBinaryEntry(blockStream, entry)) {
+                qCWarning(libraryArchive) << "Corrupt block in library archive:" << file.fileName();
+                return false;
+            }
+
+            batch.append(entry);
+            if (batch.size() >= batchSize) {
+                if (!handler(batch)) {
+                    return false;
+                }
+                batch.clear();
+            }
+        }
+    }
+
+    return batch.isEmpty() || handler(batch);
+}
+
+} // namespace
+
+LibraryArchive::Format LibraryArchive::formatFromName(const QString& name)
+{
+    const QString lowerName = name.toLower();
+    if (lowerName == "json") {
+        return Json;
+    }
+    if (lowerName == "binary") {
+        return Binary;
+    }
+    return UnknownFormat;
+}
+
+LibraryArchive::Format LibraryArchive::detectFormat(const QString& archivePath)
+{
+    QFile file(archivePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return UnknownFormat;
+    }
+
+    const QByteArray head = file.peek(64);
+    if (head.startsWith(BINARY_MAGIC)) {
+        return Binary;
+    }
+    return head.trimmed().startsWith('{') ? Json : UnknownFormat;
+}
+
+bool LibraryArchive::write(const QString& archivePath, Format format, const EntrySource& source, int* written)
+{
+    if (written) {
+        *written = 0;
+    }
+    if (format == UnknownFormat) {
+        return false;
+    }
+
+    QSaveFile file(archivePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(libraryArchive) << "Cannot write library archive:" << archivePath << file.errorString();
+        return false;
+    }
+
+    int count = 0;
+    const bool success = format == Json ? writeJson(file, source, count) : writeBinary(file, source, count);
+    if (written) {
+        *written = count;
+    }
+    return success && file.commit();
+}
+
+bool LibraryArchive::read(const QString& archivePath, const BatchHandler& handler, int batchSize)
+{
+    const Format format = detectFormat(archivePath);
+    if (format == UnknownFormat) {
+        qCWarning(libraryArchive) << "Not a library archive:" << archivePath;
+        return false;
+    }
+
+    QFile file(archivePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(libraryArchive) << "Cannot read library archive:" << archivePath << file.errorString();
+        return false;
+    }
+
+    batchSize = qMax(1, batchSize);
+    return format == Json ? readJson(file, handler, batchSize) : readBinary(file, handler, batchSize);
+}
+
+} // namespace Data
+} // namespace EonPlay
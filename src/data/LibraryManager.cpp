@@ -1,9 +1,7 @@
 #include "data/LibraryManager.h"
+#include "data/LibraryArchive.h"
 #include <QSettings>
 #include <QStandardPaths>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
 #include <QFile>
 #include <QDir>
 #include <QLoggingCategory>
@@ -20,11 +18,16 @@ LibraryManager::LibraryManager(QObject* parent)
     , m_autoScanEnabled(false)
     , m_autoScanTimer(new QTimer(this))
     , m_statisticsValid(false)
+    , m_statisticsTimer(new QTimer(this))
 {
     // Setup auto-scan timer
     m_autoScanTimer->setSingleShot(false);
     connect(m_autoScanTimer, &QTimer::timeout, this, &LibraryManager::performAutoScan);
     
+    m_statisticsTimer->setSingleShot(true);
+    m_statisticsTimer->setInterval(STATISTICS_UPDATE_MS);
+    connect(m_statisticsTimer, &QTimer::timeout, this, &LibraryManager::updateStatistics);
+    
     qCInfo(libraryManager) << "LibraryManager created";
 }
 
@@ -70,6 +73,10 @@ bool LibraryManager::initialize(const QString& databasePath)
         enableAutoScan(true);
     }
     
+    if (!m_settings.remoteServerUrl.isEmpty()) {
+        setRemoteServer(QUrl(m_settings.remoteServerUrl), m_settings.remoteServerToken);
+    }
+    
     m_initialized = true;
     emit operationCompleted(m_currentOperation);
     emit libraryInitialized();
@@ -94,6 +101,24 @@ void LibraryManager::shutdown()
     saveSettings();
     
     // Shutdown components
+    if (m_loudnessScanner) {
+        m_loudnessScanner->cancel();
+    }
+    
+    if (m_seekIndexer) {
+        m_seekIndexer->cancel();
+    }
+    
+    if (m_acousticIndexer) {
+        m_acousticIndexer->cancel();
+    }
+    
+    if (m_posterGenerator) {
+        m_posterGenerator->cancel();
+    }
+    
+    m_remoteLibrary.reset();
+    
     if (m_scanner) {
         m_scanner->cancelScan();
         m_scanner->enableFileWatching(false);
@@ -110,6 +135,47 @@ void LibraryManager::shutdown()
     qCInfo(libraryManager) << "LibraryManager shutdown complete";
 }
 
+void LibraryManager::setRemoteServer(const QUrl& serverUrl, const QString& token)
+{
+    m_remoteLibrary.reset();
+    m_settings.remoteServerUrl = serverUrl.toString();
+    m_settings.remoteServerToken = token;
+    
+    if (serverUrl.isValid() && !serverUrl.isEmpty()) {
+        // Only the server scans; the auto-scan setting is kept for going back
+        m_autoScanTimer->stop();
+        if (m_scanner) {
+            m_scanner->cancelScan();
+            m_scanner->enableFileWatching(false);
+        }
+        
+        m_remoteLibrary = std::make_unique<RemoteLibrary>(serverUrl, token);
+        const auto refresh = [this]() {
+            m_statisticsValid = false;
+            scheduleStatisticsUpdate();
+            emit libraryChanged();
+        };
+        connect(m_remoteLibrary.get(), &RemoteLibrary::connected, this, refresh);
+        connect(m_remoteLibrary.get(), &RemoteLibrary::libraryChanged, this, refresh);
+        connect(m_remoteLibrary.get(), &RemoteLibrary::resultsReady, this, &LibraryManager::libraryChanged);
+        m_remoteLibrary->connectToServer();
+        
+        qCInfo(libraryManager) << "Using library server" << serverUrl.toString();
+    } else {
+        if (m_scanner) {
+            m_scanner->enableFileWatching(true);
+        }
+        if (m_autoScanEnabled && m_settings.autoScanInterval > 0) {
+            m_autoScanTimer->start(m_settings.autoScanInterval * 1000);
+        }
+        
+        qCInfo(libraryManager) << "Using the local library";
+    }
+    
+    m_statisticsValid = false;
+    emit libraryChanged();
+}
+
 void LibraryManager::setLibrarySettings(const LibrarySettings& settings)
 {
     m_settings = settings;
@@ -124,6 +190,10 @@ void LibraryManager::setLibrarySettings(const LibrarySettings& settings)
         m_extractor->setExtractionOptions(m_settings.extractionOptions);
     }
     
+    if (m_posterGenerator) {
+        m_posterGenerator->setPreviewsEnabled(m_settings.generatePreviewClips);
+    }
+    
     // Update auto-scan
     if (m_settings.autoScanEnabled != m_autoScanEnabled) {
         enableAutoScan(m_settings.autoScanEnabled);
@@ -178,6 +248,11 @@ void LibraryManager::scanLibrary()
         return;
     }
     
+    if (m_remoteLibrary) {
+        emit scanFailed("The library is scanned by its server");
+        return;
+    }
+    
     if (m_settings.libraryPaths.isEmpty()) {
         emit scanFailed("No library paths configured");
         return;
@@ -202,6 +277,11 @@ void LibraryManager::scanPath(const QString& path)
         return;
     }
     
+    if (m_remoteLibrary) {
+        emit scanFailed("The library is scanned by its server");
+        return;
+    }
+    
     m_currentOperation = QString("Scanning path: %1").arg(path);
     qCInfo(libraryManager) << "Starting scan of path:" << path;
     
@@ -215,6 +295,11 @@ void LibraryManager::rescanLibrary()
         return;
     }
     
+    if (m_remoteLibrary) {
+        emit scanFailed("The library is scanned by its server");
+        return;
+    }
+    
     m_currentOperation = "Rescanning library";
     qCInfo(libraryManager) << "Starting library rescan";
     
@@ -228,6 +313,11 @@ void LibraryManager::quickScan()
         return;
     }
     
+    if (m_remoteLibrary) {
+        emit scanFailed("The library is scanned by its server");
+        return;
+    }
+    
     m_currentOperation = "Quick scanning library";
     qCInfo(libraryManager) << "Starting quick library scan";
     
@@ -304,26 +394,34 @@ QList<MediaFile> LibraryManager::searchFiles(const QString& query)
         return results;
     }
     
-    QSqlQuery sqlQuery = m_dbManager->searchMediaFiles(query);
-    while (sqlQuery.next()) {
-        MediaFile file;
-        file.setId(sqlQuery.value("id").toInt());
-        file.setFilePath(sqlQuery.value("file_path").toString());
-        file.setTitle(sqlQuery.value("title").toString());
-        file.setArtist(sqlQuery.value("artist").toString());
-        file.setAlbum(sqlQuery.value("album").toString());
-        file.setDuration(sqlQuery.value("duration").toLongLong());
-        file.setFileSize(sqlQuery.value("file_size").toLongLong());
-        file.setDateAdded(sqlQuery.value("date_added").toDateTime());
-        file.setLastPlayed(sqlQuery.value("last_played").toDateTime());
-        file.setPlayCount(sqlQuery.value("play_count").toInt());
-        
-        results.append(file);
+    if (m_remoteLibrary) {
+        return m_remoteLibrary->search(query);
     }
     
+    QSqlQuery sqlQuery = m_dbManager->searchMediaFiles(query);
+    results = m_dbManager->mediaFileCache()->fromQuery(sqlQuery);
+    
     return results;
 }
 
+QVector<int> LibraryManager::searchFileIds(const QString& query, int limit)
+{
+    if (!m_initialized || !m_dbManager) {
+        return QVector<int>();
+    }
+    
+    return m_dbManager->searchMediaFileIds(query, limit);
+}
+
+std::unique_ptr<MediaQueryCursor> LibraryManager::openCursor(const MediaQueryCursor::Options& options) const
+{
+    if (!m_initialized || !m_dbManager) {
+        return nullptr;
+    }
+    
+    return std::make_unique<MediaQueryCursor>(m_dbManager.get(), options);
+}
+
 QList<MediaFile> LibraryManager::getFilesByArtist(const QString& artist)
 {
     QList<MediaFile> results;
@@ -332,21 +430,15 @@ QList<MediaFile> LibraryManager::getFilesByArtist(const QString& artist)
         return results;
     }
     
+    if (m_remoteLibrary) {
+        return m_remoteLibrary->search(QString(), "artist", artist);
+    }
+    
     QSqlQuery query = m_dbManager->prepareQuery("SELECT * FROM media_files WHERE artist = ? ORDER BY album, track_number, title");
     query.addBindValue(artist);
     query.exec();
     
-    while (query.next()) {
-        MediaFile file;
-        file.setId(query.value("id").toInt());
-        file.setFilePath(query.value("file_path").toString());
-        file.setTitle(query.value("title").toString());
-        file.setArtist(query.value("artist").toString());
-        file.setAlbum(query.value("album").toString());
-        file.setDuration(query.value("duration").toLongLong());
-        
-        results.append(file);
-    }
+    results = m_dbManager->mediaFileCache()->fromQuery(query);
     
     return results;
 }
@@ -359,21 +451,15 @@ QList<MediaFile> LibraryManager::getFilesByAlbum(const QString& album)
         return results;
     }
     
+    if (m_remoteLibrary) {
+        return m_remoteLibrary->search(QString(), "album", album);
+    }
+    
     QSqlQuery query = m_dbManager->prepareQuery("SELECT * FROM media_files WHERE album = ? ORDER BY track_number, title");
     query.addBindValue(album);
     query.exec();
     
-    while (query.next()) {
-        MediaFile file;
-        file.setId(query.value("id").toInt());
-        file.setFilePath(query.value("file_path").toString());
-        file.setTitle(query.value("title").toString());
-        file.setArtist(query.value("artist").toString());
-        file.setAlbum(query.value("album").toString());
-        file.setDuration(query.value("duration").toLongLong());
-        
-        results.append(file);
-    }
+    results = m_dbManager->mediaFileCache()->fromQuery(query);
     
     return results;
 }
@@ -386,22 +472,15 @@ QList<MediaFile> LibraryManager::getFilesByGenre(const QString& genre)
         return results;
     }
     
+    if (m_remoteLibrary) {
+        return m_remoteLibrary->search(QString(), "genre", genre);
+    }
+    
     QSqlQuery query = m_dbManager->prepareQuery("SELECT * FROM media_files WHERE genre = ? ORDER BY artist, album, title");
     query.addBindValue(genre);
     query.exec();
     
-    while (query.next()) {
-        MediaFile file;
-        file.setId(query.value("id").toInt());
-        file.setFilePath(query.value("file_path").toString());
-        file.setTitle(query.value("title").toString());
-        file.setArtist(query.value("artist").toString());
-        file.setAlbum(query.value("album").toString());
-        file.setGenre(query.value("genre").toString());
-        file.setDuration(query.value("duration").toLongLong());
-        
-        results.append(file);
-    }
+    results = m_dbManager->mediaFileCache()->fromQuery(query);
     
     return results;
 }
@@ -414,22 +493,15 @@ QList<MediaFile> LibraryManager::getRecentFiles(int limit)
         return results;
     }
     
+    if (m_remoteLibrary) {
+        return m_remoteLibrary->search(QString(), QString(), QString(), "added", true, limit);
+    }
+    
     QSqlQuery query = m_dbManager->prepareQuery("SELECT * FROM media_files ORDER BY date_added DESC LIMIT ?");
     query.addBindValue(limit);
     query.exec();
     
-    while (query.next()) {
-        MediaFile file;
-        file.setId(query.value("id").toInt());
-        file.setFilePath(query.value("file_path").toString());
-        file.setTitle(query.value("title").toString());
-        file.setArtist(query.value("artist").toString());
-        file.setAlbum(query.value("album").toString());
-        file.setDuration(query.value("duration").toLongLong());
-        file.setDateAdded(query.value("date_added").toDateTime());
-        
-        results.append(file);
-    }
+    results = m_dbManager->mediaFileCache()->fromQuery(query);
     
     return results;
 }
@@ -442,23 +514,15 @@ QList<MediaFile> LibraryManager::getMostPlayedFiles(int limit)
         return results;
     }
     
+    if (m_remoteLibrary) {
+        return m_remoteLibrary->search(QString(), QString(), QString(), "plays", true, limit);
+    }
+    
     QSqlQuery query = m_dbManager->prepareQuery("SELECT * FROM media_files WHERE play_count > 0 ORDER BY play_count DESC LIMIT ?");
     query.addBindValue(limit);
     query.exec();
     
-    while (query.next()) {
-        MediaFile file;
-        file.setId(query.value("id").toInt());
-        file.setFilePath(query.value("file_path").toString());
-        file.setTitle(query.value("title").toString());
-        file.setArtist(query.value("artist").toString());
-        file.setAlbum(query.value("album").toString());
-        file.setDuration(query.value("duration").toLongLong());
-        file.setPlayCount(query.value("play_count").toInt());
-        file.setLastPlayed(query.value("last_played").toDateTime());
-        
-        results.append(file);
-    }
+    results = m_dbManager->mediaFileCache()->fromQuery(query);
     
     return results;
 }
@@ -500,9 +564,15 @@ void LibraryManager::optimizeLibrary()
     
     qCInfo(libraryManager) << "Starting library optimization";
     
-    m_dbManager->optimizeDatabase();
-    
-    emit operationCompleted(m_currentOperation);
+    // Runs on the database executor; playback and browsing continue meanwhile
+    const QString operation = m_currentOperation;
+    m_dbManager->optimizeDatabase().then(this, [this, operation](bool success) {
+        if (success) {
+            emit operationCompleted(operation);
+        } else {
+            emit operationFailed(operation, "Database optimization failed");
+        }
+    });
 }
 
 void LibraryManager::rebuildLibrary()
@@ -539,6 +609,16 @@ QList<QStringList> LibraryManager::findDuplicates()
     return m_scanner->findDuplicateFiles();
 }
 
+QList<QStringList> LibraryManager::findSimilarVideos()
+{
+    if (!m_initialized || !m_scanner) {
+        return QList<QStringList>();
+    }
+    
+    qCInfo(libraryManager) << "Finding similar videos";
+    return m_scanner->findSimilarVideos();
+}
+
 void LibraryManager::removeDuplicates(const QStringList& filesToRemove)
 {
     if (!m_initialized || !m_scanner) {
@@ -556,7 +636,7 @@ void LibraryManager::removeDuplicates(const QStringList& filesToRemove)
 
 LibraryManager::LibraryStatistics LibraryManager::getStatistics()
 {
-    if (!m_statisticsValid || m_statisticsCacheTime.secsTo(QDateTime::currentDateTime()) > 300) {
+    if (!m_statisticsValid) {
         updateStatistics();
     }
     
@@ -571,11 +651,14 @@ QStringList LibraryManager::getArtists()
         return artists;
     }
     
-    QSqlQuery query = m_dbManager->prepareQuery("SELECT DISTINCT artist FROM media_files WHERE artist IS NOT NULL AND artist != '' ORDER BY artist");
-    query.exec();
+    if (m_remoteLibrary) {
+        return m_remoteLibrary->facetValues(DatabaseManager::facetName(DatabaseManager::ArtistFacet));
+    }
     
-    while (query.next()) {
-        artists << query.value("artist").toString();
+    const QVector<DatabaseManager::FacetAggregate> aggregates =
+        m_dbManager->getFacetAggregates(DatabaseManager::ArtistFacet);
+    for (const DatabaseManager::FacetAggregate& aggregate : aggregates) {
+        artists << aggregate.value;
     }
     
     return artists;
@@ -589,11 +672,14 @@ QStringList LibraryManager::getAlbums()
         return albums;
     }
     
-    QSqlQuery query = m_dbManager->prepareQuery("SELECT DISTINCT album FROM media_files WHERE album IS NOT NULL AND album != '' ORDER BY album");
-    query.exec();
+    if (m_remoteLibrary) {
+        return m_remoteLibrary->facetValues(DatabaseManager::facetName(DatabaseManager::AlbumFacet));
+    }
     
-    while (query.next()) {
-        albums << query.value("album").toString();
+    const QVector<DatabaseManager::FacetAggregate> aggregates =
+        m_dbManager->getFacetAggregates(DatabaseManager::AlbumFacet);
+    for (const DatabaseManager::FacetAggregate& aggregate : aggregates) {
+        albums << aggregate.value;
     }
     
     return albums;
@@ -607,11 +693,14 @@ QStringList LibraryManager::getGenres()
         return genres;
     }
     
-    QSqlQuery query = m_dbManager->prepareQuery("SELECT DISTINCT genre FROM media_files WHERE genre IS NOT NULL AND genre != '' ORDER BY genre");
-    query.exec();
+    if (m_remoteLibrary) {
+        return m_remoteLibrary->facetValues(DatabaseManager::facetName(DatabaseManager::GenreFacet));
+    }
     
-    while (query.next()) {
-        genres << query.value("genre").toString();
+    const QVector<DatabaseManager::FacetAggregate> aggregates =
+        m_dbManager->getFacetAggregates(DatabaseManager::GenreFacet);
+    for (const DatabaseManager::FacetAggregate& aggregate : aggregates) {
+        genres << aggregate.value;
     }
     
     return genres;
@@ -658,50 +747,104 @@ bool LibraryManager::exportLibrary(const QString& filePath, const QString& forma
         return false;
     }
     
+    const LibraryArchive::Format archiveFormat = LibraryArchive::formatFromName(format);
+    if (archiveFormat == LibraryArchive::UnknownFormat) {
+        qCWarning(libraryManager) << "Unknown library export format:" << format;
+        return false;
+    }
+    
     qCInfo(libraryManager) << "Exporting library to:" << filePath << "format:" << format;
     
-    if (format.toLower() == "json") {
-        QJsonObject root;
-        QJsonArray filesArray;
-        
-        QSqlQuery query = m_dbManager->getAllMediaFiles();
-        while (query.next()) {
-            QJsonObject fileObj;
-            fileObj["id"] = query.value("id").toInt();
-            fileObj["file_path"] = query.value("file_path").toString();
-            fileObj["title"] = query.value("title").toString();
-            fileObj["artist"] = query.value("artist").toString();
-            fileObj["album"] = query.value("album").toString();
-            fileObj["genre"] = query.value("genre").toString();
-            fileObj["duration"] = query.value("duration").toLongLong();
-            fileObj["file_size"] = query.value("file_size").toLongLong();
-            fileObj["date_added"] = query.value("date_added").toString();
-            fileObj["play_count"] = query.value("play_count").toInt();
-            
-            filesArray.append(fileObj);
-        }
-        
-        root["files"] = filesArray;
-        root["export_date"] = QDateTime::currentDateTime().toString(Qt::ISODate);
-        root["total_files"] = filesArray.size();
-        
-        QJsonDocument doc(root);
-        
-        QFile file(filePath);
-        if (file.open(QIODevice::WriteOnly)) {
-            file.write(doc.toJson());
-            return true;
-        }
+    // Forward-only, so rows are stepped through rather than cached by the driver
+    QSqlQuery query = m_dbManager->prepareQuery(
+        "SELECT id, file_path, title, artist, album, genre, duration, file_size, date_added, play_count "
+        "FROM media_files ORDER BY id");
+    query.setForwardOnly(true);
+    if (!query.exec()) {
+        return false;
     }
     
-    return false;
+    int written = 0;
+    const bool exported = LibraryArchive::write(filePath, archiveFormat, [&query](LibraryArchive::Entry& entry) {
+        if (!query.next()) {
+            return false;
+        }
+        entry.id = query.value(0).toLongLong();
+        entry.filePath = query.value(1).toString();
+        entry.title = query.value(2).toString();
+        entry.artist = query.value(3).toString();
+        entry.album = query.value(4).toString();
+        entry.genre = query.value(5).toString();
+        entry.duration = query.value(6).toLongLong();
+        entry.fileSize = query.value(7).toLongLong();
+        entry.dateAdded = query.value(8).toString();
+        entry.playCount = query.value(9).toInt();
+        return true;
+    }, &written);
+    query.finish();
+    
+    if (exported) {
+        qCInfo(libraryManager) << "Exported" << written << "files";
+    }
+    return exported;
 }
 
 bool LibraryManager::importLibrary(const QString& filePath)
 {
-    // Placeholder for library import functionality
-    Q_UNUSED(filePath)
-    return false;
+    if (!m_initialized || !m_dbManager) {
+        return false;
+    }
+    
+    qCInfo(libraryManager) << "Importing library from:" << filePath;
+    
+    // New files come in whole; for files already here the local scan's
+    // metadata wins and only the listening history is merged
+    const QString upsert = R"(
+        INSERT INTO media_files (file_path, title, artist, album, genre, duration, file_size, date_added, play_count)
+        VALUES (?, ?, ?, ?, ?, ?, ?, COALESCE(NULLIF(?, ''), CURRENT_TIMESTAMP), ?)
+        ON CONFLICT (file_path) DO UPDATE SET
+            play_count = MAX(COALESCE(play_count, 0), excluded.play_count),
+            date_added = MIN(date_added, excluded.date_added)
+    )";
+    
+    int imported = 0;
+    const bool success = LibraryArchive::read(filePath, [this, &upsert, &imported](const QList<LibraryArchive::Entry>& entries) {
+        // One transaction per batch
+        if (!m_dbManager->beginTransaction()) {
+            return false;
+        }
+        
+        QSqlQuery query = m_dbManager->prepareQuery(upsert);
+        for (const LibraryArchive::Entry& entry : entries) {
+            if (entry.filePath.isEmpty()) {
+                continue;
+            }
+            query.addBindValue(entry.filePath);
+            query.addBindValue(entry.title);
+            query.addBindValue(entry.artist);
+            query.addBindValue(entry.album);
+            query.addBindValue(entry.genre);
+            query.addBindValue(entry.duration);
+            query.addBindValue(entry.fileSize);
+            query.addBindValue(entry.dateAdded);
+            query.addBindValue(entry.playCount);
+            if (!query.exec()) {
+                qCWarning(libraryManager) << "Failed to import" << entry.filePath << ":" << query.lastError().text();
+                m_dbManager->rollbackTransaction();
+                return false;
+            }
+            ++imported;
+        }
+        
+        return m_dbManager->commitTransaction();
+    });
+    
+    qCInfo(libraryManager) << "Imported" << imported << "files";
+    if (imported > 0) {
+        m_dbManager->mediaFileCache()->clear();
+        emit libraryChanged();
+    }
+    return success;
 }
 
 bool LibraryManager::isScanning() const
@@ -727,6 +870,21 @@ void LibraryManager::setupComponents()
     // Create metadata extractor
     m_extractor = std::make_unique<MetadataExtractor>(this);
     
+    // Create loudness scanner for ReplayGain
+    m_loudnessScanner = std::make_unique<LoudnessScanner>(m_dbManager.get(), this);
+    
+    // Create subtitle search indexer
+    m_subtitleIndexer = std::make_unique<SubtitleIndexer>(m_dbManager.get(), this);
+    
+    // Create keyframe indexer for files without an index, stored with the metadata
+    m_seekIndexer = std::make_unique<SeekIndexer>(m_extractor.get(), this);
+    
+    // Create acoustic fingerprint indexer for duplicates by sound and AcoustID lookups
+    m_acousticIndexer = std::make_unique<AcousticIndexer>(m_dbManager.get(), this);
+    
+    // Create poster generator for videos that embed no cover art
+    m_posterGenerator = std::make_unique<PosterGenerator>(m_dbManager.get(), this);
+    
     qCInfo(libraryManager) << "Library components created";
 }
 
@@ -760,6 +918,18 @@ void LibraryManager::connectSignals()
                 this, &LibraryManager::onMetadataExtractionFailed);
     }
     
+    // Database signals are emitted under its lock, so refreshes are queued
+    if (m_dbManager) {
+        connect(m_dbManager.get(), &DatabaseManager::mediaFileAdded,
+                this, &LibraryManager::scheduleStatisticsUpdate, Qt::QueuedConnection);
+        connect(m_dbManager.get(), &DatabaseManager::mediaFileRemoved,
+                this, &LibraryManager::scheduleStatisticsUpdate, Qt::QueuedConnection);
+        connect(m_dbManager.get(), &DatabaseManager::mediaFileUpdated,
+                this, &LibraryManager::scheduleStatisticsUpdate, Qt::QueuedConnection);
+        connect(m_dbManager.get(), &DatabaseManager::mediaFilesUpserted,
+                this, &LibraryManager::scheduleStatisticsUpdate, Qt::QueuedConnection);
+    }
+    
     qCInfo(libraryManager) << "Component signals connected";
 }
 
@@ -773,7 +943,13 @@ void LibraryManager::loadSettings()
     m_settings.autoScanInterval = settings.value("autoScanInterval", 3600).toInt();
     m_settings.extractMetadata = settings.value("extractMetadata", true).toBool();
     m_settings.fetchWebMetadata = settings.value("fetchWebMetadata", false).toBool();
+    m_settings.analyzeLoudness = settings.value("analyzeLoudness", true).toBool();
+    m_settings.fingerprintAudio = settings.value("fingerprintAudio", true).toBool();
+    m_settings.generatePosters = settings.value("generatePosters", true).toBool();
+    m_settings.generatePreviewClips = settings.value("generatePreviewClips", false).toBool();
     m_settings.autoCleanup = settings.value("autoCleanup", true).toBool();
+    m_settings.remoteServerUrl = settings.value("remoteServerUrl").toString();
+    m_settings.remoteServerToken = settings.value("remoteServerToken").toString();
     
     settings.endGroup();
     
@@ -790,7 +966,13 @@ void LibraryManager::saveSettings()
     settings.setValue("autoScanInterval", m_settings.autoScanInterval);
     settings.setValue("extractMetadata", m_settings.extractMetadata);
     settings.setValue("fetchWebMetadata", m_settings.fetchWebMetadata);
+    settings.setValue("analyzeLoudness", m_settings.analyzeLoudness);
+    settings.setValue("fingerprintAudio", m_settings.fingerprintAudio);
+    settings.setValue("generatePosters", m_settings.generatePosters);
+    settings.setValue("generatePreviewClips", m_settings.generatePreviewClips);
     settings.setValue("autoCleanup", m_settings.autoCleanup);
+    settings.setValue("remoteServerUrl", m_settings.remoteServerUrl);
+    settings.setValue("remoteServerToken", m_settings.remoteServerToken);
     
     settings.endGroup();
     
@@ -837,50 +1019,61 @@ void LibraryManager::updateStatistics()
         return;
     }
     
+    const LibraryStatistics previous = m_cachedStatistics;
     m_cachedStatistics = LibraryStatistics();
     
-    // Get basic counts
-    m_cachedStatistics.totalFiles = m_dbManager->getMediaFileCount();
-    m_cachedStatistics.totalSize = m_dbManager->getTotalLibrarySize();
+    // Every value below is a lookup in library_aggregates
+    const DatabaseManager::FacetAggregate totals = m_dbManager->getLibraryTotals();
+    m_cachedStatistics.totalFiles = totals.fileCount;
+    m_cachedStatistics.totalSize = totals.totalSize;
+    m_cachedStatistics.totalDuration = totals.totalDuration;
     m_cachedStatistics.totalPlaylists = m_dbManager->getPlaylistCount();
     
-    // Count audio vs video files
-    QSqlQuery query = m_dbManager->getAllMediaFiles();
-    while (query.next()) {
-        QString filePath = query.value("file_path").toString();
-        MediaFile::MediaType type = MediaFile::detectMediaType(filePath);
+    // Count audio vs video files per extension
+    const QVector<DatabaseManager::FacetAggregate> extensions =
+        m_dbManager->getFacetAggregates(DatabaseManager::ExtensionFacet);
+    for (const DatabaseManager::FacetAggregate& extension : extensions) {
+        MediaFile::MediaType type = MediaFile::detectMediaType("file." + extension.value);
         
         if (type == MediaFile::Audio) {
-            m_cachedStatistics.audioFiles++;
+            m_cachedStatistics.audioFiles += extension.fileCount;
         } else if (type == MediaFile::Video) {
-            m_cachedStatistics.videoFiles++;
+            m_cachedStatistics.videoFiles += extension.fileCount;
         }
     }
     
-    // Get top genres (limit to 10)
-    QSqlQuery genreQuery = m_dbManager->prepareQuery(
-        "SELECT genre, COUNT(*) as count FROM media_files WHERE genre IS NOT NULL AND genre != '' "
-        "GROUP BY genre ORDER BY count DESC LIMIT 10");
-    genreQuery.exec();
-    
-    while (genreQuery.next()) {
-        m_cachedStatistics.topGenres << genreQuery.value("genre").toString();
+    // Get top genres and artists (limit to 10)
+    const QVector<DatabaseManager::FacetAggregate> genres =
+        m_dbManager->getFacetAggregates(DatabaseManager::GenreFacet, true, 10);
+    for (const DatabaseManager::FacetAggregate& genre : genres) {
+        m_cachedStatistics.topGenres << genre.value;
     }
     
-    // Get top artists (limit to 10)
-    QSqlQuery artistQuery = m_dbManager->prepareQuery(
-        "SELECT artist, COUNT(*) as count FROM media_files WHERE artist IS NOT NULL AND artist != '' "
-        "GROUP BY artist ORDER BY count DESC LIMIT 10");
-    artistQuery.exec();
+    const QVector<DatabaseManager::FacetAggregate> artists =
+        m_dbManager->getFacetAggregates(DatabaseManager::ArtistFacet, true, 10);
+    for (const DatabaseManager::FacetAggregate& artist : artists) {
+        m_cachedStatistics.topArtists << artist.value;
+    }
     
-    while (artistQuery.next()) {
-        m_cachedStatistics.topArtists << artistQuery.value("artist").toString();
+    // A library server's totals; the local tables hold none of its files
+    if (m_remoteLibrary) {
+        const RemoteLibrary::Totals remoteTotals = m_remoteLibrary->totals();
+        m_cachedStatistics.totalFiles = remoteTotals.fileCount;
+        m_cachedStatistics.totalSize = remoteTotals.totalSize;
+        m_cachedStatistics.totalDuration = remoteTotals.totalDuration;
     }
     
     m_statisticsCacheTime = QDateTime::currentDateTime();
     m_statisticsValid = true;
     
-    emit statisticsUpdated();
+    StatisticsDelta delta;
+    delta.files = m_cachedStatistics.totalFiles - previous.totalFiles;
+    delta.audioFiles = m_cachedStatistics.audioFiles - previous.audioFiles;
+    delta.videoFiles = m_cachedStatistics.videoFiles - previous.videoFiles;
+    delta.size = m_cachedStatistics.totalSize - previous.totalSize;
+    delta.duration = m_cachedStatistics.totalDuration - previous.totalDuration;
+    
+    emit statisticsUpdated(delta);
 }
 
 void LibraryManager::cacheStatistics()
@@ -888,9 +1081,17 @@ void LibraryManager::cacheStatistics()
     updateStatistics();
 }
 
+void LibraryManager::scheduleStatisticsUpdate()
+{
+    // The timer is not restarted, so a long scan still refreshes regularly
+    if (!m_statisticsTimer->isActive()) {
+        m_statisticsTimer->start();
+    }
+}
+
 void LibraryManager::performAutoScan()
 {
-    if (!m_initialized || isScanning()) {
+    if (!m_initialized || m_remoteLibrary || isScanning()) {
         return;
     }
     
@@ -929,6 +1130,20 @@ void LibraryManager::onScanCompleted(int addedFiles, int updatedFiles, int error
     emit libraryChanged();
     
     qCInfo(libraryManager) << "Scan completed. Added:" << addedFiles << "Updated:" << updatedFiles;
+    
+    // Measure new and changed tracks in the background
+    if (m_settings.analyzeLoudness && m_loudnessScanner) {
+        m_loudnessScanner->analyzePending();
+    }
+    
+    if (m_settings.fingerprintAudio && m_acousticIndexer) {
+        m_acousticIndexer->fingerprintPending();
+    }
+    
+    if (m_settings.generatePosters && m_posterGenerator) {
+        m_posterGenerator->setPreviewsEnabled(m_settings.generatePreviewClips);
+        m_posterGenerator->generatePending();
+    }
 }
 
 void LibraryManager::onScanError(const QString& error)
@@ -938,9 +1153,17 @@ void LibraryManager::onScanError(const QString& error)
 
 void LibraryManager::onFileAdded(const QString& filePath)
 {
-    // Extract metadata if enabled
+    // Extract metadata if enabled, on the extractor's worker pools
     if (m_settings.extractMetadata && m_extractor) {
-        m_extractor->extractMetadata(filePath);
+        m_extractor->extractMetadataForFiles(QStringList{filePath});
+    }
+    
+    if (m_subtitleIndexer) {
+        m_subtitleIndexer->indexSidecars(filePath);
+    }
+    
+    if (m_seekIndexer) {
+        m_seekIndexer->indexFile(filePath);
     }
     
     emit fileAdded(filePath);
@@ -950,7 +1173,15 @@ void LibraryManager::onFileUpdated(const QString& filePath)
 {
     // Extract metadata if enabled
     if (m_settings.extractMetadata && m_extractor) {
-        m_extractor->extractMetadata(filePath);
+        m_extractor->extractMetadataForFiles(QStringList{filePath});
+    }
+    
+    if (m_subtitleIndexer) {
+        m_subtitleIndexer->indexSidecars(filePath);
+    }
+    
+    if (m_seekIndexer) {
+        m_seekIndexer->indexFile(filePath);
     }
     
     emit fileUpdated(filePath);
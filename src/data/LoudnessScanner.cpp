@@ -0,0 +1,462 @@
+#include "data/LoudnessScanner.h"
+#include "data/DatabaseManager.h"
+#include "data/MediaFile.h"
+#include "audio/LoudnessMeter.h"
+#include "audio/TempoAnalyzer.h"
+#include "audio/WaveformPeaks.h"
+#include "ThreadPriority.h"
+#include "CpuTopology.h"
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMetaObject>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QThread>
+#include <QtEndian>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+Q_LOGGING_CATEGORY(loudnessScanner, "eonplay.data.loudness")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+
+/**
+ * @brief Reads the WAV stream ffmpeg writes to a pipe
+ *
+ * Chunk sizes are unknown when piping, so everything after the data chunk
+ * header is taken as samples.
+ */
+class WavStreamReader
+{
+public:
+    int channels = 0;
+    int sampleRate = 0;
+
+    /**
+     * @brief Consume bytes; returns false on a malformed header
+     */
+    bool append(const QByteArray& bytes, const std::function<void(const float*, int)>& sink)
+    {
+        m_buffer.append(bytes);
+        if (!m_inData && !parseHeader()) {
+            return !m_failed;
+        }
+
+        const int frameBytes = channels * static_cast<int>(sizeof(float));
+        const int frames = static_cast<int>(m_buffer.size() / frameBytes);
+        if (frames == 0) {
+            return true;
+        }
+
+        m_samples.resize(static_cast<size_t>(frames) * channels);
+        std::memcpy(m_samples.data(), m_buffer.constData(), static_cast<size_t>(frames) * frameBytes);
+        m_buffer.remove(0, static_cast<qsizetype>(frames) * frameBytes);
+        sink(m_samples.data(), frames);
+        return true;
+    }
+
+private:
+    bool parseHeader()
+    {
+        if (m_buffer.size() < 12) {
+            return false;
+        }
+        if (!m_buffer.startsWith("RIFF") || m_buffer.mid(8, 4) != "WAVE") {
+            m_failed = true;
+            return false;
+        }
+
+        qsizetype offset = 12;
+        while (offset + 8 <= m_buffer.size()) {
+            const QByteArray id = m_buffer.mid(offset, 4);
+            const quint32 size = qFromLittleEndian<quint32>(m_buffer.constData() + offset + 4);
+
+            if (id == "data") {
+                if (channels <= 0 || channels > LoudnessMeter::MAX_CHANNELS || sampleRate <= 0) {
+                    m_failed = true;
+                    return false;
+                }
+                m_buffer.remove(0, offset + 8);
+                m_inData = true;
+                return true;
+            }
+
+            if (offset + 8 + size > static_cast<quint64>(m_buffer.size())) {
+                return false;   // Wait for the rest of the chunk
+            }
+            if (id == "fmt " && size >= 16) {
+                channels = qFromLittleEndian<quint16>(m_buffer.constData() + offset + 10);
+                sampleRate = static_cast<int>(qFromLittleEndian<quint32>(m_buffer.constData() + offset + 12));
+            }
+            offset += 8 + size + (size & 1);
+        }
+        return false;
+    }
+
+    QByteArray m_buffer;
+    std::vector<float> m_samples;
+    bool m_inData = false;
+    bool m_failed = false;
+};
+
+} // namespace
+
+LoudnessScanner::LoudnessScanner(DatabaseManager* dbManager, QObject* parent)
+    : QObject(parent)
+    , m_dbManager(dbManager)
+    , m_pool(new QThreadPool(this))
+    , m_writerTimer(new QTimer(this))
+    , m_inFlight(0)
+    , m_totalFiles(0)
+    , m_analyzedFiles(0)
+    , m_failedFiles(0)
+    , m_cancelled(false)
+{
+    m_ffmpegPath = QStandardPaths::findExecutable("ffmpeg");
+
+    // Decoding is CPU bound; stay out of the way of playback and the UI,
+    // which on a hybrid CPU the efficiency cores already do
+    const CpuTopology& topology = CpuTopology::instance();
+    m_pool->setMaxThreadCount(topology.isHybrid() ? topology.backgroundThreadCount()
+                                                  : qMax(1, QThread::idealThreadCount() - 1));
+    m_pool->setThreadPriority(QThread::LowPriority);
+
+    m_writerTimer->setSingleShot(true);
+    m_writerTimer->setInterval(WRITE_INTERVAL_MS);
+    connect(m_writerTimer, &QTimer::timeout, this, &LoudnessScanner::writePendingResults);
+
+    if (m_ffmpegPath.isEmpty()) {
+        qCInfo(loudnessScanner) << "ffmpeg not found, loudness analysis disabled";
+    }
+}
+
+LoudnessScanner::~LoudnessScanner()
+{
+    cancel();
+    m_pool->waitForDone();
+}
+
+void LoudnessScanner::setMaxThreadCount(int threads)
+{
+    m_pool->setMaxThreadCount(qMax(1, threads));
+    startWorkers();
+}
+
+void LoudnessScanner::analyzePending()
+{
+    if (!m_dbManager || !isAvailable()) {
+        return;
+    }
+
+    const bool wasRunning = isRunning();
+    if (!wasRunning) {
+        m_totalFiles = m_analyzedFiles = m_failedFiles = 0;
+    }
+
+    QSqlQuery query = m_dbManager->getLoudnessScanCandidates();
+    while (query.next()) {
+        const QString filePath = query.value(0).toString();
+        if (MediaFile::detectMediaType(filePath) == MediaFile::Audio) {
+            enqueue(filePath, query.value(1).toString());
+        }
+    }
+
+    if (!wasRunning && isRunning()) {
+        qCInfo(loudnessScanner) << "Analyzing loudness of" << m_totalFiles << "files";
+        emit analysisStarted(m_totalFiles);
+    }
+    startWorkers();
+}
+
+void LoudnessScanner::analyzeFiles(const QStringList& filePaths, bool urgent)
+{
+    if (!isAvailable()) {
+        return;
+    }
+
+    const bool wasRunning = isRunning();
+    if (!wasRunning) {
+        m_totalFiles = m_analyzedFiles = m_failedFiles = 0;
+    }
+
+    for (const QString& filePath : filePaths) {
+        enqueue(filePath, QString(), urgent);
+    }
+
+    if (!wasRunning && isRunning()) {
+        emit analysisStarted(m_totalFiles);
+    }
+    startWorkers();
+}
+
+void LoudnessScanner::cancel()
+{
+    m_queue.clear();
+    m_queued.clear();
+    m_albums.clear();
+    writePendingResults();
+
+    // Workers check the flag between reads; it is cleared once they are gone
+    m_cancelled = m_inFlight > 0;
+}
+
+void LoudnessScanner::enqueue(const QString& filePath, const QString& album, bool urgent)
+{
+    if (m_queued.contains(filePath)) {
+        if (urgent && m_queue.removeOne(filePath)) {
+            m_queue.prepend(filePath);
+        }
+        return;
+    }
+
+    m_queued.insert(filePath);
+    if (urgent) {
+        m_queue.prepend(filePath);
+    } else {
+        m_queue.append(filePath);
+    }
+    if (!album.isEmpty()) {
+        m_albums.insert(filePath, album);
+    }
+    ++m_totalFiles;
+}
+
+void LoudnessScanner::startWorkers()
+{
+    if (m_cancelled) {
+        return;
+    }
+
+    // A little more than one track per thread, so workers never wait on
+    // the round trip through this thread
+    const int limit = m_pool->maxThreadCount() * MAX_IN_FLIGHT_PER_THREAD;
+    while (m_inFlight < limit && !m_queue.isEmpty()) {
+        const QString filePath = m_queue.takeFirst();
+        const QString album = m_albums.take(filePath);
+        m_queued.remove(filePath);
+        ++m_inFlight;
+
+        const QString ffmpegPath = m_ffmpegPath;
+        const WaveformStore waveforms = m_waveforms;
+        m_pool->start([this, ffmpegPath, filePath, album, waveforms]() {
+            ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Background);
+            TrackResult result = analyzeTrack(ffmpegPath, filePath, waveforms, m_cancelled);
+            result.album = album;
+            QMetaObject::invokeMethod(this, [this, result]() {
+                onTrackFinished(result);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void LoudnessScanner::onTrackFinished(const TrackResult& result)
+{
+    --m_inFlight;
+
+    if (m_cancelled) {
+        if (m_inFlight == 0) {
+            m_cancelled = false;
+            emit analysisFinished(m_analyzedFiles, m_failedFiles);
+            qCInfo(loudnessScanner) << "Loudness analysis cancelled";
+
+            // Files queued since the cancel
+            startWorkers();
+        }
+        return;
+    }
+
+    if (result.error.isEmpty()) {
+        ++m_analyzedFiles;
+        if (!qIsNaN(result.loudness)) {
+            emit trackAnalyzed(result.filePath, LoudnessMeter::replayGain(result.loudness), result.truePeak);
+        }
+        if (result.hasWaveform) {
+            emit waveformReady(result.filePath);
+        }
+    } else {
+        ++m_failedFiles;
+        qCDebug(loudnessScanner) << "Analysis failed for" << result.filePath << ":" << result.error;
+    }
+
+    m_pendingResults.append(result);
+    emit analysisProgress(m_analyzedFiles + m_failedFiles, m_totalFiles);
+
+    startWorkers();
+
+    if (!isRunning()) {
+        writePendingResults();
+        qCInfo(loudnessScanner) << "Loudness analysis finished. Analyzed:" << m_analyzedFiles
+                                << "Failed:" << m_failedFiles;
+        emit analysisFinished(m_analyzedFiles, m_failedFiles);
+    } else if (m_pendingResults.size() >= WRITE_BATCH_SIZE) {
+        writePendingResults();
+    } else if (!m_writerTimer->isActive()) {
+        m_writerTimer->start();
+    }
+}
+
+void LoudnessScanner::writePendingResults()
+{
+    m_writerTimer->stop();
+    if (m_pendingResults.isEmpty() || !m_dbManager) {
+        return;
+    }
+
+    // Failures are stored too, with their size, so they are not retried
+    // until the file changes
+    QSet<QPair<QString, QString>> albums;
+    const bool ownTransaction = !m_dbManager->isBulkUpsertActive() && m_dbManager->beginTransaction();
+    for (const TrackResult& result : std::as_const(m_pendingResults)) {
+        const bool measured = !qIsNaN(result.loudness);
+        m_dbManager->updateMediaFileLoudness(result.filePath, result.loudness,
+                                             measured ? LoudnessMeter::replayGain(result.loudness) : qQNaN(),
+                                             result.truePeak, result.histogram, result.fileSize);
+        if (result.error.isEmpty()) {
+            m_dbManager->updateMediaFileBeatGrid(result.filePath, result.bpm, result.firstBeatMs,
+                                                 result.beatConfidence);
+        }
+        if (measured && !result.album.isEmpty()) {
+            albums.insert(qMakePair(result.album, QFileInfo(result.filePath).path()));
+        }
+    }
+    if (ownTransaction) {
+        m_dbManager->commitTransaction();
+    }
+
+    m_pendingResults.clear();
+    updateAlbumGains(albums);
+}
+
+void LoudnessScanner::updateAlbumGains(const QSet<QPair<QString, QString>>& albums)
+{
+    if (albums.isEmpty()) {
+        return;
+    }
+
+    const bool ownTransaction = !m_dbManager->isBulkUpsertActive() && m_dbManager->beginTransaction();
+    for (const auto& album : albums) {
+        // Tracks of one album share its name and directory; a name alone
+        // would merge every "Greatest Hits" in the library
+        LoudnessMeter::Histogram histogram(LoudnessMeter::HISTOGRAM_BINS, 0);
+        double peak = 0.0;
+        QStringList filePaths;
+
+        QSqlQuery query = m_dbManager->getAlbumLoudness(album.first);
+        while (query.next()) {
+            const QString filePath = query.value(0).toString();
+            if (QFileInfo(filePath).path() != album.second) {
+                continue;
+            }
+            LoudnessMeter::mergeHistogram(histogram, LoudnessMeter::unpackHistogram(query.value(1).toByteArray()));
+            peak = qMax(peak, query.value(2).toDouble());
+            filePaths.append(filePath);
+        }
+
+        const double loudness = LoudnessMeter::integratedLoudness(histogram);
+        if (!filePaths.isEmpty() && qIsFinite(loudness)) {
+            m_dbManager->updateAlbumGain(filePaths, LoudnessMeter::replayGain(loudness), peak);
+        }
+    }
+    if (ownTransaction) {
+        m_dbManager->commitTransaction();
+    }
+}
+
+LoudnessScanner::TrackResult LoudnessScanner::analyzeTrack(const QString& ffmpegPath, const QString& filePath,
+                                                          const WaveformStore& waveforms,
+                                                          const std::atomic<bool>& cancelled)
+{
+    TrackResult result;
+    result.filePath = filePath;
+    result.fileSize = QFileInfo(filePath).size();
+    result.loudness = qQNaN();
+
+    // One decoder thread per track; tracks are what run in parallel
+    QProcess ffmpeg;
+    ThreadPriority::setBackgroundProcess(&ffmpeg);
+    ffmpeg.setProcessChannelMode(QProcess::SeparateChannels);
+    ffmpeg.setStandardErrorFile(QProcess::nullDevice());
+    ffmpeg.start(ffmpegPath, {
+        "-nostdin", "-hide_banner", "-loglevel", "error", "-threads", "1",
+        "-i", filePath, "-map", "0:a:0", "-vn", "-sn", "-dn",
+        "-c:a", "pcm_f32le", "-f", "wav", "-"
+    });
+    if (!ffmpeg.waitForStarted()) {
+        result.error = ffmpeg.errorString();
+        return result;
+    }
+
+    WavStreamReader reader;
+    std::unique_ptr<LoudnessMeter> meter;
+    std::unique_ptr<TempoAnalyzer> tempo;
+    WaveformPeaks peaks;
+    auto measure = [&reader, &meter, &tempo, &peaks](const float* samples, int frames) {
+        if (!meter) {
+            meter = std::make_unique<LoudnessMeter>(reader.sampleRate, reader.channels);
+            tempo = std::make_unique<TempoAnalyzer>(reader.sampleRate, reader.channels);
+            peaks = WaveformPeaks(reader.sampleRate, reader.channels);
+        }
+        meter->addFrames(samples, frames);
+        tempo->addFrames(samples, frames);
+        peaks.addFrames(samples, frames);
+    };
+
+    while (ffmpeg.state() != QProcess::NotRunning || ffmpeg.bytesAvailable() > 0) {
+        if (cancelled) {
+            ffmpeg.kill();
+            ffmpeg.waitForFinished();
+            result.error = QStringLiteral("Cancelled");
+            return result;
+        }
+
+        if (ffmpeg.bytesAvailable() == 0 && !ffmpeg.waitForReadyRead(DECODER_STALL_TIMEOUT_MS)) {
+            if (ffmpeg.state() == QProcess::NotRunning) {
+                break;
+            }
+            ffmpeg.kill();
+            ffmpeg.waitForFinished();
+            result.error = QStringLiteral("Decoder stalled");
+            return result;
+        }
+
+        if (!reader.append(ffmpeg.readAll(), measure)) {
+            ffmpeg.kill();
+            ffmpeg.waitForFinished();
+            result.error = QStringLiteral("Unsupported audio layout");
+            return result;
+        }
+    }
+
+    ffmpeg.waitForFinished();
+    if (ffmpeg.exitStatus() != QProcess::NormalExit || ffmpeg.exitCode() != 0 || !meter) {
+        result.error = QStringLiteral("Decoding failed");
+        return result;
+    }
+
+    // Silence stays NaN: there is no meaningful gain for it
+    const double loudness = meter->integratedLoudness();
+    if (qIsFinite(loudness)) {
+        result.loudness = loudness;
+        result.truePeak = meter->truePeak();
+        result.histogram = LoudnessMeter::packHistogram(meter->histogram());
+    }
+
+    peaks.finish();
+    result.hasWaveform = !peaks.isEmpty() && waveforms.store(filePath, result.fileSize, peaks.serialize());
+
+    const TempoAnalyzer::BeatGrid grid = tempo->finish();
+    if (grid.isValid()) {
+        result.bpm = grid.bpm;
+        result.firstBeatMs = grid.firstBeatMs;
+        result.beatConfidence = grid.confidence;
+    }
+    return result;
+}
+
+} // namespace Data
+} // namespace EonPlay
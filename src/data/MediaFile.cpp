@@ -11,14 +11,7 @@ namespace EonPlay {
 namespace Data {
 
 MediaFile::MediaFile()
-    : m_id(-1)
-    , m_year(0)
-    , m_trackNumber(0)
-    , m_duration(0)
-    , m_fileSize(0)
-    , m_playCount(0)
-    , m_rating(0)
-    , m_fileInfoCached(false)
+    : d(new MediaFileData)
 {
 }
 
@@ -28,124 +21,83 @@ MediaFile::MediaFile(const QString& filePath)
     setFilePath(filePath);
 }
 
-MediaFile::MediaFile(const MediaFile& other)
-    : m_id(other.m_id)
-    , m_filePath(other.m_filePath)
-    , m_title(other.m_title)
-    , m_artist(other.m_artist)
-    , m_album(other.m_album)
-    , m_genre(other.m_genre)
-    , m_year(other.m_year)
-    , m_trackNumber(other.m_trackNumber)
-    , m_duration(other.m_duration)
-    , m_fileSize(other.m_fileSize)
-    , m_dateAdded(other.m_dateAdded)
-    , m_dateModified(other.m_dateModified)
-    , m_lastPlayed(other.m_lastPlayed)
-    , m_playCount(other.m_playCount)
-    , m_rating(other.m_rating)
-    , m_coverArtPath(other.m_coverArtPath)
-    , m_metadataHash(other.m_metadataHash)
-    , m_fileInfoCached(false)
-{
-}
+MediaFile::MediaFile(const MediaFile& other) = default;
 
-MediaFile& MediaFile::operator=(const MediaFile& other)
-{
-    if (this != &other) {
-        m_id = other.m_id;
-        m_filePath = other.m_filePath;
-        m_title = other.m_title;
-        m_artist = other.m_artist;
-        m_album = other.m_album;
-        m_genre = other.m_genre;
-        m_year = other.m_year;
-        m_trackNumber = other.m_trackNumber;
-        m_duration = other.m_duration;
-        m_fileSize = other.m_fileSize;
-        m_dateAdded = other.m_dateAdded;
-        m_dateModified = other.m_dateModified;
-        m_lastPlayed = other.m_lastPlayed;
-        m_playCount = other.m_playCount;
-        m_rating = other.m_rating;
-        m_coverArtPath = other.m_coverArtPath;
-        m_metadataHash = other.m_metadataHash;
-        m_fileInfoCached = false;
-    }
-    return *this;
-}
+MediaFile& MediaFile::operator=(const MediaFile& other) = default;
+
+MediaFile::~MediaFile() = default;
 
-void MediaFile::setFilePath(const QString& filePath)
+void MediaFile::setFilePath(const QString& filePath, bool readFileInfo)
 {
-    if (m_filePath != filePath) {
-        m_filePath = filePath;
-        m_fileInfoCached = false;
-        updateFileInfo();
+    if (d->filePath != filePath) {
+        d->filePath = filePath;
+        if (readFileInfo) {
+            updateFileInfo();
+        }
     }
 }
 
 void MediaFile::setRating(int rating)
 {
-    m_rating = qBound(0, rating, 5);
+    d->rating = qint8(qBound(0, rating, 5));
 }
 
 bool MediaFile::fileExists() const
 {
-    return fileInfo().exists();
+    return QFileInfo::exists(d->filePath);
 }
 
 QFileInfo MediaFile::fileInfo() const
 {
-    if (!m_fileInfoCached) {
-        m_fileInfo = QFileInfo(m_filePath);
-        m_fileInfoCached = true;
-    }
-    return m_fileInfo;
+    return QFileInfo(d->filePath);
 }
 
 QString MediaFile::fileName() const
 {
-    return fileInfo().fileName();
+    // Taken from the path alone; no file system access
+    return d->filePath.mid(d->filePath.lastIndexOf('/') + 1);
 }
 
 QString MediaFile::fileExtension() const
 {
-    return fileInfo().suffix().toLower();
+    const QString name = fileName();
+    const int dot = name.lastIndexOf('.');
+    return dot < 0 ? QString() : name.mid(dot + 1).toLower();
 }
 
 QString MediaFile::displayName() const
 {
-    if (!m_title.isEmpty()) {
-        if (!m_artist.isEmpty()) {
-            return QString("%1 - %2").arg(m_artist, m_title);
+    if (!d->title.isEmpty()) {
+        if (d->artist != 0) {
+            return QString("%1 - %2").arg(artist(), d->title);
         }
-        return m_title;
+        return d->title;
     }
     return fileName();
 }
 
 bool MediaFile::isValid() const
 {
-    return !m_filePath.isEmpty() && fileExists();
+    return !d->filePath.isEmpty() && fileExists();
 }
 
 bool MediaFile::hasMetadata() const
 {
-    return !m_title.isEmpty() || !m_artist.isEmpty() || !m_album.isEmpty();
+    return !d->title.isEmpty() || d->artist != 0 || d->album != 0;
 }
 
 MediaFile::MediaType MediaFile::mediaType() const
 {
-    return detectMediaType(m_filePath);
+    return detectMediaType(d->filePath);
 }
 
 QString MediaFile::durationString() const
 {
-    if (m_duration <= 0) {
+    if (d->duration <= 0) {
         return "00:00";
     }
 
-    qint64 seconds = m_duration / 1000;
+    qint64 seconds = d->duration / 1000;
     qint64 minutes = seconds / 60;
     qint64 hours = minutes / 60;
 
@@ -166,12 +118,12 @@ QString MediaFile::durationString() const
 
 QString MediaFile::fileSizeString() const
 {
-    if (m_fileSize <= 0) {
+    if (d->fileSize <= 0) {
         return "0 B";
     }
 
     const QStringList units = {"B", "KB", "MB", "GB", "TB"};
-    double size = m_fileSize;
+    double size = d->fileSize;
     int unitIndex = 0;
 
     while (size >= 1024.0 && unitIndex < units.size() - 1) {
@@ -190,11 +142,11 @@ QString MediaFile::formatInfo() const
         info << fileExtension().toUpper();
     }
     
-    if (m_duration > 0) {
+    if (d->duration > 0) {
         info << durationString();
     }
     
-    if (m_fileSize > 0) {
+    if (d->fileSize > 0) {
         info << fileSizeString();
     }
     
@@ -203,66 +155,84 @@ QString MediaFile::formatInfo() const
 
 bool MediaFile::operator==(const MediaFile& other) const
 {
-    return m_filePath == other.m_filePath;
+    return d == other.d || d->filePath == other.d->filePath;
+}
+
+bool MediaFile::hasSameData(const MediaFile& other) const
+{
+    if (d == other.d) {
+        return true;
+    }
+
+    const MediaFileData& a = *d;
+    const MediaFileData& b = *other.d;
+    return a.id == b.id && a.filePath == b.filePath && a.title == b.title
+        && a.artist == b.artist && a.album == b.album && a.genre == b.genre
+        && a.year == b.year && a.trackNumber == b.trackNumber
+        && a.duration == b.duration && a.fileSize == b.fileSize
+        && a.dateAdded == b.dateAdded && a.dateModified == b.dateModified
+        && a.lastPlayed == b.lastPlayed && a.playCount == b.playCount
+        && a.rating == b.rating && a.coverArtPath == b.coverArtPath
+        && a.metadataHash == b.metadataHash;
 }
 
 bool MediaFile::operator<(const MediaFile& other) const
 {
     // Sort by artist, then album, then track number, then title
-    if (m_artist != other.m_artist) {
-        return m_artist < other.m_artist;
+    if (d->artist != other.d->artist) {
+        return artist() < other.artist();
     }
-    if (m_album != other.m_album) {
-        return m_album < other.m_album;
+    if (d->album != other.d->album) {
+        return album() < other.album();
     }
-    if (m_trackNumber != other.m_trackNumber) {
-        return m_trackNumber < other.m_trackNumber;
+    if (d->trackNumber != other.d->trackNumber) {
+        return d->trackNumber < other.d->trackNumber;
     }
-    return m_title < other.m_title;
+    return d->title < other.d->title;
 }
 
 QVariantMap MediaFile::toVariantMap() const
 {
     QVariantMap map;
-    map["id"] = m_id;
-    map["filePath"] = m_filePath;
-    map["title"] = m_title;
-    map["artist"] = m_artist;
-    map["album"] = m_album;
-    map["genre"] = m_genre;
-    map["year"] = m_year;
-    map["trackNumber"] = m_trackNumber;
-    map["duration"] = m_duration;
-    map["fileSize"] = m_fileSize;
-    map["dateAdded"] = m_dateAdded;
-    map["dateModified"] = m_dateModified;
-    map["lastPlayed"] = m_lastPlayed;
-    map["playCount"] = m_playCount;
-    map["rating"] = m_rating;
-    map["coverArtPath"] = m_coverArtPath;
-    map["metadataHash"] = m_metadataHash;
+    map["id"] = d->id;
+    map["filePath"] = d->filePath;
+    map["title"] = d->title;
+    map["artist"] = artist();
+    map["album"] = album();
+    map["genre"] = genre();
+    map["year"] = d->year;
+    map["trackNumber"] = d->trackNumber;
+    map["duration"] = d->duration;
+    map["fileSize"] = d->fileSize;
+    map["dateAdded"] = dateAdded();
+    map["dateModified"] = dateModified();
+    map["lastPlayed"] = lastPlayed();
+    map["playCount"] = d->playCount;
+    map["rating"] = rating();
+    map["coverArtPath"] = coverArtPath();
+    map["metadataHash"] = d->metadataHash;
     return map;
 }
 
 void MediaFile::fromVariantMap(const QVariantMap& map)
 {
-    m_id = map.value("id", -1).toInt();
+    d->id = map.value("id", -1).toInt();
     setFilePath(map.value("filePath").toString());
-    m_title = map.value("title").toString();
-    m_artist = map.value("artist").toString();
-    m_album = map.value("album").toString();
-    m_genre = map.value("genre").toString();
-    m_year = map.value("year", 0).toInt();
-    m_trackNumber = map.value("trackNumber", 0).toInt();
-    m_duration = map.value("duration", 0).toLongLong();
-    m_fileSize = map.value("fileSize", 0).toLongLong();
-    m_dateAdded = map.value("dateAdded").toDateTime();
-    m_dateModified = map.value("dateModified").toDateTime();
-    m_lastPlayed = map.value("lastPlayed").toDateTime();
-    m_playCount = map.value("playCount", 0).toInt();
-    m_rating = map.value("rating", 0).toInt();
-    m_coverArtPath = map.value("coverArtPath").toString();
-    m_metadataHash = map.value("metadataHash").toString();
+    d->title = map.value("title").toString();
+    setArtist(map.value("artist").toString());
+    setAlbum(map.value("album").toString());
+    setGenre(map.value("genre").toString());
+    d->year = map.value("year", 0).toInt();
+    d->trackNumber = map.value("trackNumber", 0).toInt();
+    d->duration = map.value("duration", 0).toLongLong();
+    d->fileSize = map.value("fileSize", 0).toLongLong();
+    setDateAdded(map.value("dateAdded").toDateTime());
+    setDateModified(map.value("dateModified").toDateTime());
+    setLastPlayed(map.value("lastPlayed").toDateTime());
+    d->playCount = map.value("playCount", 0).toInt();
+    d->rating = qint8(map.value("rating", 0).toInt());
+    setCoverArtPath(map.value("coverArtPath").toString());
+    d->metadataHash = map.value("metadataHash").toString();
 }
 
 QStringList MediaFile::supportedAudioExtensions()
@@ -311,15 +281,15 @@ MediaFile::MediaType MediaFile::detectMediaType(const QString& filePath)
 
 void MediaFile::updateFileInfo()
 {
-    if (!m_filePath.isEmpty()) {
-        QFileInfo info(m_filePath);
+    if (!d->filePath.isEmpty()) {
+        QFileInfo info(d->filePath);
         if (info.exists()) {
-            m_fileSize = info.size();
-            m_dateModified = info.lastModified();
+            d->fileSize = info.size();
+            d->dateModified = info.lastModified().toMSecsSinceEpoch();
             
             // Set title from filename if not already set
-            if (m_title.isEmpty()) {
-                m_title = info.baseName();
+            if (d->title.isEmpty()) {
+                d->title = info.baseName();
             }
         }
     }
@@ -328,13 +298,13 @@ void MediaFile::updateFileInfo()
 QString MediaFile::calculateMetadataHash() const
 {
     QCryptographicHash hash(QCryptographicHash::Md5);
-    hash.addData(m_title.toUtf8());
-    hash.addData(m_artist.toUtf8());
-    hash.addData(m_album.toUtf8());
-    hash.addData(m_genre.toUtf8());
-    hash.addData(QByteArray::number(m_year));
-    hash.addData(QByteArray::number(m_trackNumber));
-    hash.addData(QByteArray::number(m_duration));
+    hash.addData(d->title.toUtf8());
+    hash.addData(artist().toUtf8());
+    hash.addData(album().toUtf8());
+    hash.addData(genre().toUtf8());
+    hash.addData(QByteArray::number(d->year));
+    hash.addData(QByteArray::number(d->trackNumber));
+    hash.addData(QByteArray::number(d->duration));
     return hash.result().toHex();
 }
 
@@ -0,0 +1,203 @@
+#include "data/MediaFileCache.h"
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(mediaFileCache, "eonplay.data.mediafilecache")
+
+namespace EonPlay {
+namespace Data {
+
+MediaFileCache::MediaFileCache(QObject* parent)
+    : QObject(parent)
+    , m_files(DEFAULT_CAPACITY)
+{
+}
+
+QList<MediaFile> MediaFileCache::fromQuery(QSqlQuery& query, const QString& idColumn,
+                                           const RowHandler& rowHandler)
+{
+    // Column positions are looked up once; a query may not select all of them
+    const QSqlRecord record = query.record();
+    const int idIndex = record.indexOf(idColumn);
+    const int pathIndex = record.indexOf("file_path");
+    const int titleIndex = record.indexOf("title");
+    const int artistIndex = record.indexOf("artist");
+    const int albumIndex = record.indexOf("album");
+    const int genreIndex = record.indexOf("genre");
+    const int yearIndex = record.indexOf("year");
+    const int trackIndex = record.indexOf("track_number");
+    const int durationIndex = record.indexOf("duration");
+    const int sizeIndex = record.indexOf("file_size");
+    const int addedIndex = record.indexOf("date_added");
+    const int modifiedIndex = record.indexOf("date_modified");
+    const int playedIndex = record.indexOf("last_played");
+    const int playCountIndex = record.indexOf("play_count");
+    const int ratingIndex = record.indexOf("rating");
+    const int coverArtIndex = record.indexOf("cover_art_path");
+
+    QList<MediaFile> files;
+    QList<MediaFile> changed;
+    {
+        QMutexLocker locker(&m_mutex);
+        while (query.next()) {
+            const QVariant id = idIndex >= 0 ? query.value(idIndex) : QVariant();
+            const int mediaFileId = id.isNull() ? -1 : id.toInt();
+            
+            // Rows outside the library, e.g. from a LEFT JOIN, only have a path
+            if (mediaFileId <= 0) {
+                MediaFile file(pathIndex >= 0 ? query.value(pathIndex).toString() : QString());
+                files.append(file);
+                if (rowHandler) {
+                    rowHandler(query, file);
+                }
+                continue;
+            }
+            
+            // Columns the query did not select keep their cached values
+            MediaFile* cached = m_files.object(mediaFileId);
+            MediaFile file = cached ? *cached : MediaFile();
+            file.setId(mediaFileId);
+            if (pathIndex >= 0) file.setFilePath(query.value(pathIndex).toString(), false);
+            if (titleIndex >= 0) file.setTitle(query.value(titleIndex).toString());
+            if (artistIndex >= 0) file.setArtist(query.value(artistIndex).toString());
+            if (albumIndex >= 0) file.setAlbum(query.value(albumIndex).toString());
+            if (genreIndex >= 0) file.setGenre(query.value(genreIndex).toString());
+            if (yearIndex >= 0) file.setYear(query.value(yearIndex).toInt());
+            if (trackIndex >= 0) file.setTrackNumber(query.value(trackIndex).toInt());
+            if (durationIndex >= 0) file.setDuration(query.value(durationIndex).toLongLong());
+            if (sizeIndex >= 0) file.setFileSize(query.value(sizeIndex).toLongLong());
+            if (addedIndex >= 0) file.setDateAdded(query.value(addedIndex).toDateTime());
+            if (modifiedIndex >= 0) file.setDateModified(query.value(modifiedIndex).toDateTime());
+            if (playedIndex >= 0) file.setLastPlayed(query.value(playedIndex).toDateTime());
+            if (playCountIndex >= 0) file.setPlayCount(query.value(playCountIndex).toInt());
+            if (ratingIndex >= 0) file.setRating(query.value(ratingIndex).toInt());
+            if (coverArtIndex >= 0) file.setCoverArtPath(query.value(coverArtIndex).toString());
+            
+            bool fileChanged = false;
+            files.append(internLocked(file, &fileChanged));
+            if (fileChanged) {
+                changed.append(files.last());
+            }
+            if (rowHandler) {
+                rowHandler(query, files.last());
+            }
+        }
+    }
+
+    for (const MediaFile& file : std::as_const(changed)) {
+        emit mediaFileChanged(file);
+    }
+
+    return files;
+}
+
+MediaFile MediaFileCache::intern(const MediaFile& file)
+{
+    bool changed = false;
+    MediaFile snapshot;
+    {
+        QMutexLocker locker(&m_mutex);
+        snapshot = internLocked(file, &changed);
+    }
+
+    if (changed) {
+        emit mediaFileChanged(snapshot);
+    }
+    return snapshot;
+}
+
+QList<MediaFile> MediaFileCache::intern(const QList<MediaFile>& files)
+{
+    QList<MediaFile> snapshots;
+    snapshots.reserve(files.size());
+    for (const MediaFile& file : files) {
+        snapshots.append(intern(file));
+    }
+    return snapshots;
+}
+
+MediaFile MediaFileCache::internLocked(const MediaFile& file, bool* changed)
+{
+    *changed = false;
+    if (file.id() <= 0) {
+        return file;
+    }
+
+    MediaFile* cached = m_files.object(file.id());
+    if (cached && cached->hasSameData(file)) {
+        return *cached;
+    }
+
+    // A row that differs from the cached one is newer; holders are told
+    *changed = cached != nullptr;
+    m_files.insert(file.id(), new MediaFile(file));
+    return file;
+}
+
+MediaFile MediaFileCache::find(int id) const
+{
+    QMutexLocker locker(&m_mutex);
+    MediaFile* cached = m_files.object(id);
+    return cached ? *cached : MediaFile();
+}
+
+bool MediaFileCache::update(int id, const std::function<void(MediaFile&)>& change)
+{
+    MediaFile snapshot;
+    {
+        QMutexLocker locker(&m_mutex);
+        MediaFile* cached = m_files.object(id);
+        if (!cached) {
+            return false;
+        }
+
+        // The copy detaches on its first change; the old snapshot is left as it was
+        snapshot = *cached;
+        change(snapshot);
+        m_files.insert(id, new MediaFile(snapshot));
+    }
+
+    emit mediaFileChanged(snapshot);
+    return true;
+}
+
+void MediaFileCache::remove(int id)
+{
+    bool removed = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        removed = m_files.remove(id);
+    }
+
+    if (removed) {
+        emit mediaFileRemoved(id);
+    }
+}
+
+void MediaFileCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_files.clear();
+}
+
+void MediaFileCache::setCapacity(int capacity)
+{
+    QMutexLocker locker(&m_mutex);
+    m_files.setMaxCost(qMax(1, capacity));
+}
+
+int MediaFileCache::capacity() const
+{
+    QMutexLocker locker(&m_mutex);
+    return int(m_files.maxCost());
+}
+
+int MediaFileCache::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return int(m_files.count());
+}
+
+} // namespace Data
+} // namespace EonPlay
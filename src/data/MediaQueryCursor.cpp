@@ -0,0 +1,302 @@
+#include "data/MediaQueryCursor.h"
+#include "data/DatabaseManager.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QSet>
+#include <QLoggingCategory>
+#include <QDebug>
+
+Q_LOGGING_CATEGORY(mediaQueryCursor, "eonplay.data.cursor")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+
+// Column names are spliced into SQL, so only these are accepted
+const QSet<QString>& queryableColumns()
+{
+    static const QSet<QString> columns = {
+        "id", "file_path", "title", "artist", "album", "genre", "year", "track_number",
+        "duration", "file_size", "date_added", "date_modified", "last_played",
+        "play_count", "rating", "cover_art_path"
+    };
+    return columns;
+}
+
+bool ascendingLess(const QVariant& leftKey, int leftId, const QVariant& rightKey, int rightId)
+{
+    if (leftKey.isNull() != rightKey.isNull()) {
+        return leftKey.isNull();
+    }
+    
+    if (!leftKey.isNull()) {
+        const bool numeric = leftKey.typeId() != QMetaType::QString && rightKey.typeId() != QMetaType::QString;
+        if (numeric) {
+            const double left = leftKey.toDouble();
+            const double right = rightKey.toDouble();
+            if (left != right) {
+                return left < right;
+            }
+        } else {
+            const int comparison = leftKey.toString().compare(rightKey.toString());
+            if (comparison != 0) {
+                return comparison < 0;
+            }
+        }
+    }
+    
+    return leftId < rightId;
+}
+
+} // namespace
+
+MediaQueryCursor::MediaQueryCursor(DatabaseManager* dbManager, const Options& options)
+    : m_dbManager(dbManager)
+    , m_options(options)
+    , m_hasPosition(false)
+    , m_lastId(0)
+    , m_atEnd(false)
+    , m_fetchedRows(0)
+{
+    m_columns << "id";
+    for (const QString& column : m_options.columns) {
+        if (!isValidColumn(column)) {
+            qCWarning(mediaQueryCursor) << "Ignoring unknown column:" << column;
+        } else if (!m_columns.contains(column)) {
+            m_columns << column;
+        }
+    }
+    
+    if (!isValidColumn(m_options.orderBy)) {
+        qCWarning(mediaQueryCursor) << "Cannot sort on" << m_options.orderBy << "- using title";
+        m_options.orderBy = "title";
+    }
+    
+    if (!m_options.filter.column.isEmpty() && !isValidColumn(m_options.filter.column)) {
+        qCWarning(mediaQueryCursor) << "Ignoring filter on unknown column:" << m_options.filter.column;
+        m_options.filter.column.clear();
+    }
+    
+    m_options.pageSize = qMax(1, m_options.pageSize);
+    m_atEnd = !m_dbManager || m_options.limit == 0;
+}
+
+bool MediaQueryCursor::isValidColumn(const QString& column)
+{
+    return queryableColumns().contains(column);
+}
+
+QVector<QVariantList> MediaQueryCursor::fetchPage()
+{
+    QVector<QVariantList> rows;
+    if (m_atEnd) {
+        return rows;
+    }
+    
+    const QString& sortColumn = m_options.orderBy;
+    const bool ascending = m_options.order == Qt::AscendingOrder;
+    
+    QStringList conditions;
+    QVariantList bindValues;
+    appendFilterConditions(conditions, bindValues);
+    
+    // Continue after the last row in (sort key, id) order. SQLite sorts
+    // NULL before every value, and comparisons with NULL are never true,
+    // so NULL keys get their own branches.
+    if (m_hasPosition) {
+        const QString idComparison = ascending ? "id > ?" : "id < ?";
+        if (m_lastSortKey.isNull()) {
+            if (ascending) {
+                conditions << QString("((%1 IS NULL AND %2) OR %1 IS NOT NULL)").arg(sortColumn, idComparison);
+            } else {
+                conditions << QString("(%1 IS NULL AND %2)").arg(sortColumn, idComparison);
+            }
+            bindValues << m_lastId;
+        } else {
+            const QString keyComparison = sortColumn + (ascending ? " > ?" : " < ?");
+            QString condition = QString("(%1 OR (%2 = ? AND %3)").arg(keyComparison, sortColumn, idComparison);
+            if (!ascending) {
+                condition += QString(" OR %1 IS NULL").arg(sortColumn);
+            }
+            conditions << condition + ")";
+            bindValues << m_lastSortKey << m_lastSortKey << m_lastId;
+        }
+    }
+    
+    int pageSize = m_options.pageSize;
+    if (m_options.limit > 0) {
+        pageSize = qMin(pageSize, m_options.limit - m_fetchedRows);
+    }
+    
+    // The single-column indexes also order by rowid, so this walks an index
+    const QString direction = ascending ? "ASC" : "DESC";
+    QString sql = QString("SELECT %1, %2 FROM media_files").arg(m_columns.join(", "), sortColumn);
+    if (!conditions.isEmpty()) {
+        sql += " WHERE " + conditions.join(" AND ");
+    }
+    sql += QString(" ORDER BY %1 %2, id %2 LIMIT ?").arg(sortColumn, direction);
+    bindValues << pageSize;
+    
+    QSqlQuery query = m_dbManager->prepareQuery(sql);
+    for (const QVariant& value : bindValues) {
+        query.addBindValue(value);
+    }
+    
+    if (!query.exec()) {
+        qCWarning(mediaQueryCursor) << "Page query failed:" << query.lastError().text();
+        m_atEnd = true;
+        return rows;
+    }
+    
+    const int columnCount = m_columns.size();
+    rows.reserve(pageSize);
+    while (query.next()) {
+        QVariantList row;
+        row.reserve(columnCount);
+        for (int i = 0; i < columnCount; ++i) {
+            row << query.value(i);
+        }
+        rows << row;
+        
+        m_lastId = query.value(0).toLongLong();
+        m_lastSortKey = query.value(columnCount);
+    }
+    
+    m_hasPosition = m_hasPosition || !rows.isEmpty();
+    m_fetchedRows += rows.size();
+    m_atEnd = rows.size() < pageSize || (m_options.limit > 0 && m_fetchedRows >= m_options.limit);
+    
+    return rows;
+}
+
+QHash<int, QVariantList> MediaQueryCursor::fetchRows(const QVector<int>& ids) const
+{
+    return fetchByIds(ids, false);
+}
+
+QHash<int, QVariantList> MediaQueryCursor::fetchMatching(const QVector<int>& ids) const
+{
+    return fetchByIds(ids, true);
+}
+
+bool MediaQueryCursor::lessThan(const QVariant& leftKey, int leftId, const QVariant& rightKey, int rightId) const
+{
+    if (m_options.order == Qt::DescendingOrder) {
+        return ascendingLess(rightKey, rightId, leftKey, leftId);
+    }
+    return ascendingLess(leftKey, leftId, rightKey, rightId);
+}
+void MediaQueryCursor::appendFilterConditions(QStringList& conditions, QVariantList& bindValues) const
+{
+    const Filter& filter = m_options.filter;
+    
+    if (!filter.column.isEmpty()) {
+        conditions << filter.column + " = ?";
+        bindValues << filter.value;
+    }
+    
+    const QString match = DatabaseManager::buildSearchMatch(filter.searchTerm);
+    if (!match.isEmpty()) {
+        if (m_dbManager->isSearchIndexAvailable()) {
+            conditions << "id IN (SELECT rowid FROM media_search WHERE media_search MATCH ?)";
+            bindValues << match;
+        } else {
+            conditions << "(title LIKE ? OR artist LIKE ? OR album LIKE ? OR file_path LIKE ?)";
+            const QString pattern = QString("%%1%").arg(filter.searchTerm.trimmed());
+            bindValues << pattern << pattern << pattern << pattern;
+        }
+    }
+    
+    if (!filter.fileExtensions.isEmpty()) {
+        QStringList extensionConditions;
+        for (const QString& extension : filter.fileExtensions) {
+            extensionConditions << "file_path LIKE ?";
+            bindValues << QString("%.%1").arg(extension);
+        }
+        conditions << "(" + extensionConditions.join(" OR ") + ")";
+    }
+    
+    if (filter.addedSince.isValid()) {
+        // date_added holds SQLite's CURRENT_TIMESTAMP text, in UTC
+        conditions << "date_added >= ?";
+        bindValues << filter.addedSince.toUTC().toString("yyyy-MM-dd hh:mm:ss");
+    }
+    
+    if (filter.minimumRating > 0) {
+        conditions << "rating >= ?";
+        bindValues << filter.minimumRating;
+    }
+    
+    if (filter.unplayedOnly) {
+        conditions << "play_count = 0";
+    }
+    
+    // Files without a verdict yet are left out until they get one
+    if (!filter.allowedForProfile.isEmpty()) {
+        conditions << "EXISTS (SELECT 1 FROM content_verdicts WHERE profile_id = ? "
+                      "AND media_file_id = media_files.id AND verdict = 0)";
+        bindValues << filter.allowedForProfile;
+    }
+}
+
+QHash<int, QVariantList> MediaQueryCursor::fetchByIds(const QVector<int>& ids, bool applyFilter) const
+{
+    QHash<int, QVariantList> rows;
+    if (!m_dbManager || ids.isEmpty()) {
+        return rows;
+    }
+    
+    const int columnCount = m_columns.size();
+    
+    for (int start = 0; start < ids.size(); start += MAX_BOUND_IDS) {
+        const int count = qMin(MAX_BOUND_IDS, static_cast<int>(ids.size()) - start);
+        
+        QStringList conditions;
+        QVariantList bindValues;
+        if (applyFilter) {
+            appendFilterConditions(conditions, bindValues);
+        }
+        
+        QStringList placeholders;
+        for (int i = 0; i < count; ++i) {
+            placeholders << "?";
+            bindValues << ids.at(start + i);
+        }
+        conditions << QString("id IN (%1)").arg(placeholders.join(", "));
+        
+        QSqlQuery query = m_dbManager->prepareQuery(QString("SELECT %1 FROM media_files WHERE %2")
+                                                    .arg(m_columns.join(", "), conditions.join(" AND ")));
+        for (const QVariant& value : bindValues) {
+            query.addBindValue(value);
+        }
+        
+        if (!query.exec()) {
+            qCWarning(mediaQueryCursor) << "Row query failed:" << query.lastError().text();
+            return rows;
+        }
+        
+        while (query.next()) {
+            QVariantList row;
+            row.reserve(columnCount);
+            for (int i = 0; i < columnCount; ++i) {
+                row << query.value(i);
+            }
+            rows.insert(row.first().toInt(), row);
+        }
+    }
+    
+    return rows;
+}
+
+void MediaQueryCursor::reset()
+{
+    m_hasPosition = false;
+    m_lastSortKey = QVariant();
+    m_lastId = 0;
+    m_fetchedRows = 0;
+    m_atEnd = !m_dbManager || m_options.limit == 0;
+}
+
+} // namespace Data
+} // namespace EonPlay
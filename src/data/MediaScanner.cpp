@@ -1,5 +1,11 @@
 #include "data/MediaScanner.h"
 #include "data/DatabaseManager.h"
+#include "data/NearDuplicateIndex.h"
+#include "data/ScanFileReader.h"
+#include "Metrics.h"
+#include "ThreadPriority.h"
+#include "CpuTopology.h"
+#include <QDir>
 #include <QDirIterator>
 #include <QFileInfo>
 #include <QCryptographicHash>
@@ -9,31 +15,229 @@
 #include <QDebug>
 #include <QThread>
 #include <QMutexLocker>
-#include <QApplication>
+#include <QMetaObject>
+#include <QMap>
+#include <QStorageInfo>
+#include <QStandardPaths>
+#include <QtEndian>
 #include <algorithm>
 
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
 Q_LOGGING_CATEGORY(mediaScanner, "eonplay.data.scanner")
 
 namespace EonPlay {
 namespace Data {
 
+namespace {
+
+// XXH64 (https://github.com/Cyan4973/xxHash). Stable across platforms and
+// runs, which qHash() is not, so results can be persisted.
+constexpr quint64 XXH_PRIME1 = 11400714785074694791ULL;
+constexpr quint64 XXH_PRIME2 = 14029467366897019727ULL;
+constexpr quint64 XXH_PRIME3 = 1609587929392839161ULL;
+constexpr quint64 XXH_PRIME4 = 9650029242287828579ULL;
+constexpr quint64 XXH_PRIME5 = 2870177450012600261ULL;
+
+inline quint64 xxRotl(quint64 value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline quint64 xxRound(quint64 accumulator, quint64 input)
+{
+    accumulator += input * XXH_PRIME2;
+    return xxRotl(accumulator, 31) * XXH_PRIME1;
+}
+
+inline quint64 xxMergeRound(quint64 accumulator, quint64 value)
+{
+    accumulator ^= xxRound(0, value);
+    return accumulator * XXH_PRIME1 + XXH_PRIME4;
+}
+
+quint64 xxHash64(const char* data, qsizetype length, quint64 seed)
+{
+    const uchar* p = reinterpret_cast<const uchar*>(data);
+    const uchar* const end = p + length;
+    quint64 hash;
+    
+    if (length >= 32) {
+        quint64 v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+        quint64 v2 = seed + XXH_PRIME2;
+        quint64 v3 = seed;
+        quint64 v4 = seed - XXH_PRIME1;
+        
+        for (const uchar* const limit = end - 32; p <= limit; p += 32) {
+            v1 = xxRound(v1, qFromLittleEndian<quint64>(p));
+            v2 = xxRound(v2, qFromLittleEndian<quint64>(p + 8));
+            v3 = xxRound(v3, qFromLittleEndian<quint64>(p + 16));
+            v4 = xxRound(v4, qFromLittleEndian<quint64>(p + 24));
+        }
+        
+        hash = xxRotl(v1, 1) + xxRotl(v2, 7) + xxRotl(v3, 12) + xxRotl(v4, 18);
+        hash = xxMergeRound(hash, v1);
+        hash = xxMergeRound(hash, v2);
+        hash = xxMergeRound(hash, v3);
+        hash = xxMergeRound(hash, v4);
+    } else {
+        hash = seed + XXH_PRIME5;
+    }
+    
+    hash += static_cast<quint64>(length);
+    
+    for (; p + 8 <= end; p += 8) {
+        hash ^= xxRound(0, qFromLittleEndian<quint64>(p));
+        hash = xxRotl(hash, 27) * XXH_PRIME1 + XXH_PRIME4;
+    }
+    
+    if (p + 4 <= end) {
+        hash ^= static_cast<quint64>(qFromLittleEndian<quint32>(p)) * XXH_PRIME1;
+        hash = xxRotl(hash, 23) * XXH_PRIME2 + XXH_PRIME3;
+        p += 4;
+    }
+    
+    for (; p < end; ++p) {
+        hash ^= (*p) * XXH_PRIME5;
+        hash = xxRotl(hash, 11) * XXH_PRIME1;
+    }
+    
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// Library files on one volume, by directory
+struct VolumeFiles {
+    QString rootPath;
+    QHash<QString, QStringList> directories;
+    QStringList missingFiles;
+};
+
+bool isEmptyDirectory(const QString& path)
+{
+    return QDir(path).isEmpty(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+}
+
+QString existingAncestor(const QString& path)
+{
+    QString current = path;
+    while (!QFileInfo::exists(current)) {
+        const QString parent = QFileInfo(current).absolutePath();
+        if (parent == current) {
+            return QString();
+        }
+        current = parent;
+    }
+    return current;
+}
+
+/**
+ * Root of the volume a library directory lives on, empty while the volume
+ * is offline. An unmounted drive or share leaves its library folder missing
+ * or empty; outside the library folders a vanished directory could just as
+ * well be an unmounted one, so only directories that exist are checked.
+ */
+QString volumeRootOf(const QString& directoryPath, const QStringList& libraryFolders,
+                     QHash<QString, QString>& folderVolumes)
+{
+    for (const QString& folder : libraryFolders) {
+        const QString prefix = folder.endsWith('/') ? folder : folder + '/';
+        if (directoryPath != folder && !directoryPath.startsWith(prefix)) {
+            continue;
+        }
+        
+        auto cached = folderVolumes.constFind(folder);
+        if (cached != folderVolumes.constEnd()) {
+            return *cached;
+        }
+        
+        QString rootPath;
+        if (QFileInfo(folder).isDir() && !isEmptyDirectory(folder)) {
+            const QStorageInfo storage(folder);
+            if (storage.isValid() && storage.isReady()) {
+                rootPath = storage.rootPath();
+            }
+        }
+        folderVolumes.insert(folder, rootPath);
+        return rootPath;
+    }
+    
+    if (!QFileInfo(directoryPath).isDir()) {
+        return QString();
+    }
+    const QStorageInfo storage(directoryPath);
+    return storage.isValid() && storage.isReady() ? storage.rootPath() : QString();
+}
+
+void findMissingFiles(VolumeFiles& volume)
+{
+    ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Background);
+    const BackgroundIoScope backgroundIo;
+    
+    for (auto it = volume.directories.constBegin(); it != volume.directories.constEnd(); ++it) {
+        const QString& directoryPath = it.key();
+        
+        if (!QFileInfo(directoryPath).isDir()) {
+            // An empty directory left in its place is a mount point whose
+            // volume is gone, not a deleted folder
+            const QString ancestor = existingAncestor(directoryPath);
+            if (!ancestor.isEmpty() && !isEmptyDirectory(ancestor)) {
+                volume.missingFiles << it.value();
+            }
+            continue;
+        }
+        
+        // One listing per directory instead of a stat per file; names it
+        // lacks are confirmed so a short listing never purges anything
+        const QStringList entries = QDir(directoryPath).entryList(QDir::Files | QDir::Hidden | QDir::System);
+        const QSet<QString> names(entries.begin(), entries.end());
+        for (const QString& filePath : it.value()) {
+            if (!names.contains(QFileInfo(filePath).fileName()) && !QFileInfo::exists(filePath)) {
+                volume.missingFiles << filePath;
+            }
+        }
+    }
+}
+
+} // namespace
+
 MediaScanner::MediaScanner(DatabaseManager* dbManager, QObject* parent)
     : QObject(parent)
     , m_dbManager(dbManager)
     , m_isScanning(false)
     , m_cancelRequested(false)
-    , m_fileWatcher(nullptr)
+    , m_directoryWatcher(nullptr)
     , m_fileWatchingEnabled(false)
     , m_watcherTimer(new QTimer(this))
+    , m_hashPool(new QThreadPool(this))
     , m_scanThread(nullptr)
+    , m_extractPool(new QThreadPool(this))
+    , m_inFlightSlots(MAX_IN_FLIGHT)
+    , m_enumerationDone(true)
+    , m_writerTimer(new QTimer(this))
     , m_cachedFileCount(-1)
     , m_cachedLibrarySize(-1)
 {
     // Setup file watcher timer
     m_watcherTimer->setSingleShot(true);
-    m_watcherTimer->setInterval(1000); // 1 second delay to batch file changes
+    m_watcherTimer->setInterval(1000); // Retry delay while another scan runs
     connect(m_watcherTimer, &QTimer::timeout, this, &MediaScanner::processWatcherQueue);
     
+    // Setup batching database writer
+    m_writerTimer->setInterval(WRITE_INTERVAL_MS);
+    connect(m_writerTimer, &QTimer::timeout, this, &MediaScanner::writePendingResults);
+    
+    // Both pools run on the efficiency cores of a hybrid CPU
+    const int workers = qMax(2, CpuTopology::instance().backgroundThreadCount());
+    m_extractPool->setMaxThreadCount(workers);
+    m_hashPool->setMaxThreadCount(workers);
+    
     setupFileWatcher();
     
     qCInfo(mediaScanner) << "MediaScanner initialized";
@@ -43,14 +247,13 @@ MediaScanner::~MediaScanner()
 {
     cancelScan();
     
-    if (m_scanThread && m_scanThread->isRunning()) {
-        m_scanThread->quit();
-        m_scanThread->wait(3000);
-    }
-    
-    if (m_fileWatcher) {
-        delete m_fileWatcher;
+    // Workers reference members, so they must finish before those are destroyed
+    if (m_scanThread) {
+        m_scanThread->wait();
+        delete m_scanThread;
     }
+    m_extractPool->waitForDone();
+    m_hashPool->waitForDone();
 }
 
 void MediaScanner::setWatchDirectories(const QStringList& directories)
@@ -77,87 +280,73 @@ void MediaScanner::setWatchDirectories(const QStringList& directories)
 }
 
 void MediaScanner::scanDirectory(const QString& directoryPath)
+{
+    scanDirectories(QStringList{directoryPath});
+}
+
+void MediaScanner::scanDirectories(const QStringList& directoryPaths)
+{
+    startScan(directoryPaths, m_options, false);
+}
+
+void MediaScanner::startScan(const QStringList& directoryPaths, const ScanOptions& scanOptions, bool listRoots)
 {
     if (m_isScanning) {
         qCWarning(mediaScanner) << "Scan already in progress";
         return;
     }
     
-    QDir dir(directoryPath);
-    if (!dir.exists()) {
-        emit scanError("Directory does not exist: " + directoryPath);
+    QStringList rootPaths;
+    for (const QString& directoryPath : directoryPaths) {
+        if (QDir(directoryPath).exists()) {
+            rootPaths << directoryPath;
+        } else {
+            emit scanError("Directory does not exist: " + directoryPath);
+        }
+    }
+    
+    if (rootPaths.isEmpty()) {
         return;
     }
     
     m_isScanning = true;
     m_cancelRequested = false;
+    m_enumerationDone = false;
     
     // Reset progress
-    m_progress = ScanProgress();
-    m_progress.isRunning = true;
-    m_progress.currentDirectory = directoryPath;
-    
-    emit scanStarted(directoryPath);
-    
-    qCInfo(mediaScanner) << "Starting scan of directory:" << directoryPath;
-    
-    // Count total directories and files for progress tracking
-    if (m_options.mode == FullScan) {
-        QDirIterator countIterator(directoryPath, 
-                                  QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot,
-                                  m_options.recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
-        
-        while (countIterator.hasNext()) {
-            countIterator.next();
-            QFileInfo info = countIterator.fileInfo();
-            
-            if (info.isDir()) {
-                m_progress.totalDirectories++;
-            } else if (isMediaFile(info.absoluteFilePath())) {
-                m_progress.totalFiles++;
-            }
-            
-            // Allow UI updates during counting
-            if (m_progress.totalFiles % 100 == 0) {
-                QApplication::processEvents();
-            }
-            
-            if (m_cancelRequested) {
-                m_isScanning = false;
-                emit scanCancelled();
-                return;
-            }
-        }
+    {
+        QMutexLocker locker(&m_progressMutex);
+        m_progress = ScanProgress();
+        m_progress.isRunning = true;
+        m_progress.totalDirectories = rootPaths.size();
+        m_progress.currentDirectory = rootPaths.first();
     }
     
-    // Start actual scanning
-    scanDirectoryRecursive(directoryPath);
+    emit scanStarted(rootPaths.join("; "));
     
-    // Complete scan
-    m_isScanning = false;
-    m_progress.isRunning = false;
-    m_progress.percentage = 100.0;
+    qCInfo(mediaScanner) << "Starting scan of directories:" << rootPaths;
     
-    // Invalidate cache
-    m_cachedFileCount = -1;
-    m_cachedLibrarySize = -1;
+    {
+        QMutexLocker locker(&m_resultMutex);
+        m_pendingRemovals.clear();
+        m_pendingDirectoryRemovals.clear();
+        m_pendingDirectories.clear();
+    }
+    m_failedDirectories.clear();
     
-    emit scanCompleted(m_progress.addedFiles, m_progress.updatedFiles, m_progress.errorFiles);
-    emit libraryUpdated();
+    // Callers may change the options right after starting, so the scan
+    // thread works on a copy
+    const ScanOptions options = scanOptions;
+    const std::shared_ptr<const ScanJournal> journal = loadScanJournal();
+    m_scanThread = QThread::create([this, rootPaths, options, journal, listRoots]() {
+        enumerateDirectories(rootPaths, options, journal, listRoots);
+    });
+    m_scanThread->start();
     
-    qCInfo(mediaScanner) << "Scan completed. Added:" << m_progress.addedFiles 
-                         << "Updated:" << m_progress.updatedFiles 
-                         << "Errors:" << m_progress.errorFiles;
-}
-
-void MediaScanner::scanDirectories(const QStringList& directoryPaths)
-{
-    for (const QString& directoryPath : directoryPaths) {
-        if (m_cancelRequested) {
-            break;
-        }
-        scanDirectory(directoryPath);
+    if (m_dbManager) {
+        m_dbManager->beginBulkUpsert();
     }
+    m_writerTimer->start();
 }
 
 void MediaScanner::scanFile(const QString& filePath)
@@ -182,6 +371,11 @@ void MediaScanner::rescanLibrary()
         return;
     }
     
+    if (m_isScanning) {
+        qCWarning(mediaScanner) << "Scan already in progress";
+        return;
+    }
+    
     qCInfo(mediaScanner) << "Starting library rescan";
     
     // Get all media files from database
@@ -194,19 +388,34 @@ void MediaScanner::rescanLibrary()
     }
     
     // Rescan each file
-    m_progress = ScanProgress();
-    m_progress.totalFiles = filesToRescan.size();
-    m_progress.isRunning = true;
+    {
+        QMutexLocker locker(&m_progressMutex);
+        m_progress = ScanProgress();
+        m_progress.totalFiles = filesToRescan.size();
+        m_progress.isRunning = true;
+    }
     
     emit scanStarted("Library Rescan");
     
+    const std::shared_ptr<const ScanJournal> journal = loadScanJournal();
+    
     for (const QString& filePath : filesToRescan) {
         if (m_cancelRequested) {
             break;
         }
         
-        if (QFile::exists(filePath)) {
-            processFile(filePath);
+        const QFileInfo fileInfo(filePath);
+        if (fileInfo.exists()) {
+            // Only files that changed since they were journaled are re-extracted
+            const QHash<QString, JournalFile> journalFiles = journal->files.value(fileInfo.absolutePath());
+            auto journaled = journalFiles.constFind(fileInfo.absoluteFilePath());
+            if (journaled != journalFiles.constEnd() && *journaled == journalEntry(fileInfo)) {
+                QMutexLocker locker(&m_progressMutex);
+                m_progress.scannedFiles++;
+                m_progress.skippedFiles++;
+            } else {
+                processFile(filePath);
+            }
         } else {
             // File no longer exists, remove from database
             m_dbManager->removeMediaFileByPath(filePath);
@@ -216,8 +425,12 @@ void MediaScanner::rescanLibrary()
         updateScanProgress();
     }
     
-    m_progress.isRunning = false;
-    emit scanCompleted(m_progress.addedFiles, m_progress.updatedFiles, m_progress.errorFiles);
+    ScanProgress finalProgress = progress();
+    {
+        QMutexLocker locker(&m_progressMutex);
+        m_progress.isRunning = false;
+    }
+    emit scanCompleted(finalProgress.addedFiles, finalProgress.updatedFiles, finalProgress.errorFiles);
     emit libraryUpdated();
 }
 
@@ -235,14 +448,19 @@ void MediaScanner::enableFileWatching(bool enabled)
         }
         qCInfo(mediaScanner) << "File watching enabled";
     } else {
-        if (m_fileWatcher) {
-            m_fileWatcher->removePaths(m_fileWatcher->directories());
-            m_fileWatcher->removePaths(m_fileWatcher->files());
+        if (m_directoryWatcher) {
+            m_directoryWatcher->clear();
         }
         qCInfo(mediaScanner) << "File watching disabled";
     }
 }
 
+MediaScanner::ScanProgress MediaScanner::progress() const
+{
+    QMutexLocker locker(&m_progressMutex);
+    return m_progress;
+}
+
 void MediaScanner::cancelScan()
 {
     if (m_isScanning) {
@@ -261,15 +479,30 @@ QList<QStringList> MediaScanner::findDuplicateFiles()
     
     qCInfo(mediaScanner) << "Starting duplicate detection";
     
-    // Group files by hash
-    QHash<QString, QStringList> hashGroups = groupFilesByHash();
+    // Stage 1: only equally sized files can match. Batches end on a size
+    // boundary so every group resolves within one batch.
+    QSqlQuery query = m_dbManager->getDuplicateSizeCandidates();
+    QVector<DuplicateCandidate> batch;
+    qint64 batchSize = -1;
     
-    // Find groups with more than one file
-    for (auto it = hashGroups.begin(); it != hashGroups.end(); ++it) {
-        if (it.value().size() > 1) {
-            duplicateGroups.append(it.value());
+    while (query.next()) {
+        DuplicateCandidate candidate;
+        candidate.filePath = query.value(0).toString();
+        candidate.fileSize = query.value(1).toLongLong();
+        candidate.sampleHash = query.value(2).toString();
+        candidate.contentHash = query.value(3).toString();
+        candidate.hashFileSize = query.value(4).isNull() ? -1 : query.value(4).toLongLong();
+        candidate.hashModifiedTime = query.value(5).isNull() ? -1 : query.value(5).toLongLong();
+        
+        if (candidate.fileSize != batchSize && batch.size() >= DUPLICATE_BATCH_FILES) {
+            resolveDuplicateCandidates(batch, duplicateGroups);
+            batch.clear();
         }
+        
+        batchSize = candidate.fileSize;
+        batch.append(candidate);
     }
+    resolveDuplicateCandidates(batch, duplicateGroups);
     
     // Also group by metadata for files that might be identical but have different hashes
     QHash<QString, QStringList> metadataGroups = groupFilesByMetadata();
@@ -287,6 +520,7 @@ QList<QStringList> MediaScanner::findDuplicateFiles()
             
             if (!alreadyFound) {
                 duplicateGroups.append(it.value());
+                emit duplicateGroupFound(it.value());
             }
         }
     }
@@ -297,6 +531,114 @@ QList<QStringList> MediaScanner::findDuplicateFiles()
     return duplicateGroups;
 }
 
+QList<QStringList> MediaScanner::findSimilarVideos(int maxDistance)
+{
+    QList<QStringList> videoGroups;
+    
+    if (!m_dbManager) {
+        return videoGroups;
+    }
+    
+    qCInfo(mediaScanner) << "Starting similar video detection";
+    
+    // Stored fingerprints are trusted while the library's size for the file
+    // matches, so unchanged videos are not even stat()ed
+    QVector<FingerprintCandidate> candidates;
+    QSqlQuery query = m_dbManager->getVideoFingerprints();
+    while (query.next()) {
+        const QString filePath = query.value(1).toString();
+        if (MediaFile::detectMediaType(filePath) != MediaFile::Video) {
+            continue;
+        }
+        
+        FingerprintCandidate candidate;
+        candidate.id = query.value(0).toInt();
+        candidate.filePath = filePath;
+        candidate.fileSize = query.value(2).toLongLong();
+        candidate.duration = query.value(3).toLongLong();
+        if (!query.value(4).isNull() && query.value(4).toLongLong() == candidate.fileSize) {
+            candidate.modifiedTime = query.value(5).toLongLong();
+            candidate.fingerprint = query.value(6).toByteArray();
+        } else {
+            candidate.changed = true;
+        }
+        candidates.append(candidate);
+    }
+    
+    const QString ffmpegPath = QStandardPaths::findExecutable(QStringLiteral("ffmpeg"));
+    int fingerprinted = 0;
+    int skipped = 0;
+    for (FingerprintCandidate& candidate : candidates) {
+        if (!candidate.changed) {
+            continue;
+        }
+        if (ffmpegPath.isEmpty()) {
+            candidate.changed = false;
+            ++skipped;
+            continue;
+        }
+        
+        ++fingerprinted;
+        m_hashPool->start([&candidate, ffmpegPath]() {
+            ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Background);
+            const BackgroundIoScope backgroundIo;
+            const QFileInfo fileInfo(candidate.filePath);
+            if (!fileInfo.isFile()) {
+                candidate.changed = false;
+                return;
+            }
+            
+            const VideoFingerprint fingerprint = VideoFingerprint::compute(ffmpegPath, candidate.filePath,
+                                                                           candidate.duration);
+            // Undecodable videos are stored too, so they are not retried every run
+            candidate.modifiedTime = fileInfo.lastModified().toMSecsSinceEpoch();
+            candidate.fingerprint = fingerprint.serialize();
+        });
+    }
+    m_hashPool->waitForDone();
+    
+    if (skipped > 0) {
+        qCWarning(mediaScanner) << "FFmpeg not found," << skipped << "videos without a fingerprint skipped";
+    }
+    
+    // Persist new fingerprints so the next run only decodes videos that changed
+    const bool ownTransaction = !m_dbManager->isBulkUpsertActive() && m_dbManager->beginTransaction();
+    for (const FingerprintCandidate& candidate : candidates) {
+        if (candidate.changed) {
+            m_dbManager->storeVideoFingerprint(candidate.id, candidate.fileSize, candidate.modifiedTime,
+                                               candidate.fingerprint);
+        }
+    }
+    if (ownTransaction) {
+        m_dbManager->commitTransaction();
+    }
+    
+    NearDuplicateIndex index;
+    QHash<int, QString> paths;
+    for (const FingerprintCandidate& candidate : candidates) {
+        const VideoFingerprint fingerprint = VideoFingerprint::deserialize(candidate.fingerprint);
+        if (!fingerprint.isEmpty()) {
+            index.insert(candidate.id, fingerprint);
+            paths.insert(candidate.id, candidate.filePath);
+        }
+    }
+    
+    for (const QList<int>& group : index.groups(maxDistance)) {
+        QStringList videoGroup;
+        for (int id : group) {
+            videoGroup << paths.value(id);
+        }
+        videoGroup.sort();
+        videoGroups.append(videoGroup);
+        emit similarVideoGroupFound(videoGroup);
+    }
+    
+    emit similarVideosFound(videoGroups);
+    
+    qCInfo(mediaScanner) << "Found" << videoGroups.size() << "similar video groups among" << index.size()
+                         << "videos," << fingerprinted << "fingerprinted";
+    return videoGroups;
+}
 void MediaScanner::removeDuplicates(const QStringList& filesToRemove)
 {
     for (const QString& filePath : filesToRemove) {
@@ -322,19 +664,60 @@ void MediaScanner::cleanupMissingFiles()
     
     qCInfo(mediaScanner) << "Starting cleanup of missing files";
     
-    QSqlQuery query = m_dbManager->getAllMediaFiles();
-    QStringList missingFiles;
+    QHash<QString, QStringList> filesByDirectory;
+    for (const QString& filePath : m_dbManager->getAllMediaFilePaths()) {
+        filesByDirectory[QFileInfo(filePath).absolutePath()] << filePath;
+    }
     
-    while (query.next()) {
-        QString filePath = query.value("file_path").toString();
-        if (!QFile::exists(filePath)) {
-            missingFiles << filePath;
+    // Innermost library folder first
+    QStringList libraryFolders;
+    for (const QString& directory : m_watchDirectories) {
+        libraryFolders << QDir::cleanPath(QFileInfo(directory).absoluteFilePath());
+    }
+    std::sort(libraryFolders.begin(), libraryFolders.end(), [](const QString& a, const QString& b) {
+        return a.size() > b.size();
+    });
+    
+    // Files on offline volumes are left alone until the volume is back
+    QVector<VolumeFiles> volumes;
+    QHash<QString, int> volumeIndexes;
+    QHash<QString, QString> folderVolumes;
+    int offlineFiles = 0;
+    for (auto it = filesByDirectory.constBegin(); it != filesByDirectory.constEnd(); ++it) {
+        const QString rootPath = volumeRootOf(it.key(), libraryFolders, folderVolumes);
+        if (rootPath.isEmpty()) {
+            offlineFiles += it.value().size();
+            continue;
+        }
+        
+        auto index = volumeIndexes.constFind(rootPath);
+        if (index == volumeIndexes.constEnd()) {
+            index = volumeIndexes.insert(rootPath, volumes.size());
+            volumes.append({rootPath, {}, {}});
         }
+        volumes[*index].directories.insert(it.key(), it.value());
+    }
+    
+    // Volumes are checked in parallel so one slow share does not hold up the rest
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, static_cast<int>(volumes.size())));
+    for (VolumeFiles& volume : volumes) {
+        pool.start([&volume]() {
+            findMissingFiles(volume);
+        });
+    }
+    pool.waitForDone();
+    
+    QStringList missingFiles;
+    for (const VolumeFiles& volume : volumes) {
+        missingFiles << volume.missingFiles;
     }
     
-    // Remove missing files from database
+    if (!m_dbManager->removeMediaFilesByPath(missingFiles)) {
+        qCWarning(mediaScanner) << "Could not remove missing files:" << m_dbManager->lastError();
+        return;
+    }
     for (const QString& filePath : missingFiles) {
-        m_dbManager->removeMediaFileByPath(filePath);
         emit fileRemoved(filePath);
     }
     
@@ -343,7 +726,8 @@ void MediaScanner::cleanupMissingFiles()
     m_cachedLibrarySize = -1;
     
     emit libraryUpdated();
-    qCInfo(mediaScanner) << "Cleaned up" << missingFiles.size() << "missing files";
+    qCInfo(mediaScanner) << "Cleaned up" << missingFiles.size() << "missing files on" << volumes.size()
+                         << "volumes," << offlineFiles << "files on offline volumes skipped";
 }
 
 void MediaScanner::updateFileMetadata(const QString& filePath)
@@ -358,8 +742,11 @@ void MediaScanner::refreshLibrary()
     // Invalidate all caches
     m_cachedFileCount = -1;
     m_cachedLibrarySize = -1;
-    m_fileHashCache.clear();
-    m_fileModificationCache.clear();
+    
+    // Forget the scan journal so the next scan revisits every file
+    if (m_dbManager) {
+        m_dbManager->clearScanJournal();
+    }
     
     emit libraryUpdated();
     qCInfo(mediaScanner) << "Library refreshed";
@@ -405,148 +792,523 @@ QStringList MediaScanner::getLibraryDirectories() const
     return directories.values();
 }
 
-void MediaScanner::scanDirectoryRecursive(const QString& directoryPath, int currentDepth)
+void MediaScanner::enumerateDirectories(const QStringList& rootPaths, const ScanOptions& options,
+                                        const std::shared_ptr<const ScanJournal>& journal, bool listRoots)
 {
-    if (m_cancelRequested) {
-        return;
+    // Runs on m_scanThread. Directories are walked depth-first from an
+    // explicit stack so deep trees cannot overflow the thread's stack.
+    struct PendingDirectory {
+        QString path;
+        QString parentPath;
+        int depth;
+    };
+    
+    QVector<PendingDirectory> pending;
+    for (auto it = rootPaths.crbegin(); it != rootPaths.crend(); ++it) {
+        const QString rootPath = QDir(*it).absolutePath();
+        
+        // A root inside an already journaled tree keeps its parent link,
+        // otherwise the parent's skip path would stop descending into it
+        const QString parentPath = QFileInfo(rootPath).absolutePath();
+        pending.append({rootPath, journal->directoryTimes.contains(parentPath) ? parentPath : QString(), 0});
     }
     
-    if (m_options.maxDepth >= 0 && currentDepth > m_options.maxDepth) {
-        return;
+    // Full scans re-extract everything but still refresh the journal
+    const bool trustJournal = options.mode != FullScan;
+    
+    QDir::Filters filters = QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot;
+    if (!options.followSymlinks) {
+        filters |= QDir::NoSymLinks;
     }
     
-    if (!shouldProcessDirectory(directoryPath)) {
-        return;
+    while (!pending.isEmpty() && !m_cancelRequested) {
+        const PendingDirectory directory = pending.takeLast();
+        const QString& directoryPath = directory.path;
+        
+        if (options.maxDepth >= 0 && directory.depth > options.maxDepth) {
+            continue;
+        }
+        
+        if (!shouldProcessDirectory(directoryPath, options)) {
+            continue;
+        }
+        
+        {
+            QMutexLocker locker(&m_progressMutex);
+            m_progress.currentDirectory = directoryPath;
+            m_progress.scannedDirectories++;
+        }
+        
+        const qint64 directoryTime = QFileInfo(directoryPath).lastModified().toMSecsSinceEpoch();
+        const QHash<QString, JournalFile> journalFiles = journal->files.value(directoryPath);
+        const QStringList journalSubdirectories = journal->subdirectories.value(directoryPath);
+        
+        // An unchanged directory mtime means no entries were added, removed
+        // or renamed, so the journal's view of it is reused without listing
+        // Roots reported by the watcher are always listed: editing a file in
+        // place does not touch its directory's mtime
+        const bool listDirectory = listRoots && directory.depth == 0;
+        if (trustJournal && !listDirectory && journal->directoryTimes.value(directoryPath, -1) == directoryTime) {
+            if (options.recursive) {
+                for (const QString& subdirectory : journalSubdirectories) {
+                    pending.append({subdirectory, directoryPath, directory.depth + 1});
+                }
+                
+                QMutexLocker locker(&m_progressMutex);
+                m_progress.totalDirectories += journalSubdirectories.size();
+            }
+            
+            QMutexLocker locker(&m_progressMutex);
+            m_progress.skippedFiles += journalFiles.size();
+            continue;
+        }
+        
+        qCDebug(mediaScanner) << "Scanning directory:" << directoryPath;
+        
+        QSet<QString> seenFiles;
+        QSet<QString> seenSubdirectories;
+        bool complete = true;
+        
+        QDirIterator iterator(directoryPath, filters);
+        while (iterator.hasNext()) {
+            if (m_cancelRequested) {
+                complete = false;
+                break;
+            }
+            
+            iterator.next();
+            const QFileInfo entry = iterator.fileInfo();
+            const QString entryPath = entry.absoluteFilePath();
+            
+            if (entry.isDir()) {
+                if (options.recursive) {
+                    seenSubdirectories.insert(entryPath);
+                    pending.append({entryPath, directoryPath, directory.depth + 1});
+                    
+                    QMutexLocker locker(&m_progressMutex);
+                    m_progress.totalDirectories++;
+                }
+            } else if (entry.isFile()) {
+                // Filter on the stat data the iterator already fetched
+                if (!shouldProcessFile(entry, options)) {
+                    QMutexLocker locker(&m_progressMutex);
+                    m_progress.skippedFiles++;
+                    continue;
+                }
+                
+                seenFiles.insert(entryPath);
+                
+                const JournalFile current = journalEntry(entry);
+                auto journaled = journalFiles.constFind(entryPath);
+                if (trustJournal && journaled != journalFiles.constEnd() && *journaled == current) {
+                    QMutexLocker locker(&m_progressMutex);
+                    m_progress.skippedFiles++;
+                    continue;
+                }
+                
+                if (!queueExtraction(entryPath, directoryPath, current)) {
+                    complete = false;
+                    break;
+                }
+            }
+        }
+        
+        if (!complete) {
+            break;
+        }
+        
+        // Journaled entries that are gone now leave the library
+        QStringList removedFiles;
+        QStringList removedDirectories;
+        for (auto it = journalFiles.constBegin(); it != journalFiles.constEnd(); ++it) {
+            if (!seenFiles.contains(it.key()) && !QFileInfo::exists(it.key())) {
+                removedFiles << it.key();
+            }
+        }
+        if (options.recursive) {
+            for (const QString& subdirectory : journalSubdirectories) {
+                if (!seenSubdirectories.contains(subdirectory) && !QFileInfo::exists(subdirectory)) {
+                    collectJournalSubtree(*journal, subdirectory, removedDirectories, removedFiles);
+                }
+            }
+        }
+        
+        QMutexLocker locker(&m_resultMutex);
+        m_pendingRemovals << removedFiles;
+        m_pendingDirectoryRemovals << removedDirectories;
+        m_pendingDirectories.append({directoryPath, directory.parentPath, directoryTime});
     }
     
-    QDir dir(directoryPath);
-    if (!dir.exists()) {
-        return;
+    m_enumerationDone = true;
+}
+
+bool MediaScanner::queueExtraction(const QString& filePath, const QString& directoryPath,
+                                   const JournalFile& journal)
+{
+    // Block while MAX_IN_FLIGHT files are waiting for workers or the writer
+    while (!m_inFlightSlots.tryAcquire(1, 100)) {
+        if (m_cancelRequested) {
+            return false;
+        }
     }
     
-    m_progress.currentDirectory = directoryPath;
-    m_progress.scannedDirectories++;
-    updateScanProgress();
+    {
+        QMutexLocker locker(&m_progressMutex);
+        m_progress.totalFiles++;
+    }
+    
+    m_extractPool->start([this, filePath, directoryPath, journal]() {
+        ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Background);
+        const BackgroundIoScope backgroundIo;
+        extractFile(filePath, directoryPath, journal);
+    });
+    return true;
+}
+
+void MediaScanner::extractFile(const QString& filePath, const QString& directoryPath,
+                               const JournalFile& journal)
+{
+    // Runs on m_extractPool; the slot taken in queueExtraction() is
+    // returned by the writer once the result is stored
+    ScanResult result;
+    result.filePath = filePath;
+    result.directoryPath = directoryPath;
+    result.journal = journal;
+    
+    if (!m_cancelRequested) {
+        try {
+            result.mediaFile = createMediaFileFromPath(filePath);
+            if (!result.mediaFile.isValid()) {
+                result.error = "Invalid media file";
+            }
+        } catch (const std::exception& e) {
+            result.error = QString("Exception: %1").arg(e.what());
+        }
+    }
     
-    qCDebug(mediaScanner) << "Scanning directory:" << directoryPath;
+    QMutexLocker locker(&m_resultMutex);
+    m_pendingResults.append(result);
     
-    // Get directory entries
-    QDir::Filters filters = QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot;
-    if (!m_options.followSymlinks) {
-        filters |= QDir::NoSymLinks;
+    if (m_pendingResults.size() == WRITE_BATCH_SIZE) {
+        QMetaObject::invokeMethod(this, &MediaScanner::writePendingResults, Qt::QueuedConnection);
+    }
+}
+
+void MediaScanner::writePendingResults()
+{
+    QVector<ScanResult> batch;
+    {
+        QMutexLocker locker(&m_resultMutex);
+        batch.swap(m_pendingResults);
     }
     
-    QFileInfoList entries = dir.entryInfoList(filters);
+    if (!m_cancelRequested) {
+        applyPendingRemovals();
+    }
     
-    for (const QFileInfo& entry : entries) {
-        if (m_cancelRequested) {
-            return;
-        }
-        
-        QString entryPath = entry.absoluteFilePath();
-        
-        if (entry.isDir()) {
-            if (m_options.recursive) {
-                scanDirectoryRecursive(entryPath, currentDepth + 1);
-            }
-        } else if (entry.isFile()) {
-            if (shouldProcessFile(entryPath)) {
-                processFile(entryPath);
-                updateScanProgress();
-            } else {
-                m_progress.skippedFiles++;
+    if (!batch.isEmpty()) {
+        if (!m_cancelRequested) {
+            // Rows go through the bulk upsert session, which commits in batches
+            for (const ScanResult& result : batch) {
+                applyScanResult(result);
             }
+            
+            updateScanProgress();
         }
         
-        // Allow UI updates
-        if ((m_progress.scannedFiles + m_progress.skippedFiles) % 10 == 0) {
-            QApplication::processEvents();
-        }
+        m_inFlightSlots.release(batch.size());
+    } else if (m_dbManager) {
+        // Nothing arrived this tick; don't leave written rows uncommitted
+        m_dbManager->flushBulkUpsert();
+    }
+    
+    // Every queued file has been written once all slots are back
+    if (m_isScanning && m_enumerationDone && m_inFlightSlots.available() == MAX_IN_FLIGHT) {
+        finishScan();
     }
 }
 
-void MediaScanner::processFile(const QString& filePath)
+void MediaScanner::finishScan()
 {
+    m_writerTimer->stop();
+    
+    if (m_scanThread) {
+        m_scanThread->wait();
+        delete m_scanThread;
+        m_scanThread = nullptr;
+    }
+    
+    // Directories are journaled only after every file in them is written,
+    // so an interrupted scan never marks a directory as up to date
+    if (!m_cancelRequested) {
+        applyPendingRemovals();
+        writeDirectoryRecords();
+    }
+    
+    if (m_dbManager) {
+        m_dbManager->endBulkUpsert();
+    }
+    
+    m_isScanning = false;
+    
+    ScanProgress finalProgress;
+    {
+        QMutexLocker locker(&m_progressMutex);
+        m_progress.isRunning = false;
+        if (!m_cancelRequested) {
+            m_progress.percentage = 100.0;
+        }
+        finalProgress = m_progress;
+    }
+    
+    // Invalidate cache
+    m_cachedFileCount = -1;
+    m_cachedLibrarySize = -1;
+    
     if (m_cancelRequested) {
+        qCInfo(mediaScanner) << "Scan cancelled after" << finalProgress.scannedFiles << "files";
+        emit scanCancelled();
+        if (finalProgress.addedFiles > 0 || finalProgress.updatedFiles > 0) {
+            emit libraryUpdated();
+        }
         return;
     }
     
-    m_progress.currentFile = filePath;
-    m_progress.scannedFiles++;
+    emit scanProgress(finalProgress);
+    emit scanCompleted(finalProgress.addedFiles, finalProgress.updatedFiles, finalProgress.errorFiles);
+    emit libraryUpdated();
+    
+    qCInfo(mediaScanner) << "Scan completed. Added:" << finalProgress.addedFiles 
+                         << "Updated:" << finalProgress.updatedFiles 
+                         << "Errors:" << finalProgress.errorFiles;
+}
+
+void MediaScanner::applyPendingRemovals()
+{
+    QStringList removedFiles;
+    QStringList removedDirectories;
+    {
+        QMutexLocker locker(&m_resultMutex);
+        removedFiles.swap(m_pendingRemovals);
+        removedDirectories.swap(m_pendingDirectoryRemovals);
+    }
+    
+    if (!m_dbManager) {
+        return;
+    }
+    
+    // Journal rows of removed files go with their media_files rows
+    for (const QString& filePath : removedFiles) {
+        m_dbManager->removeMediaFileByPath(filePath);
+        emit fileRemoved(filePath);
+    }
+    
+    for (const QString& directoryPath : removedDirectories) {
+        m_dbManager->removeScanJournalDirectory(directoryPath);
+    }
+}
+
+void MediaScanner::writeDirectoryRecords()
+{
+    QVector<DirectoryRecord> records;
+    {
+        QMutexLocker locker(&m_resultMutex);
+        records.swap(m_pendingDirectories);
+    }
+    
+    if (!m_dbManager) {
+        return;
+    }
+    
+    // Unchanged parents are skipped without listing, which would hide a
+    // failed subdirectory, so failures keep their ancestors unjournaled too
+    QHash<QString, QString> parentPaths;
+    for (const DirectoryRecord& record : records) {
+        parentPaths.insert(record.path, record.parentPath);
+    }
+    
+    QSet<QString> blockedDirectories;
+    for (const QString& failedDirectory : m_failedDirectories) {
+        QString directoryPath = failedDirectory;
+        while (!directoryPath.isEmpty() && !blockedDirectories.contains(directoryPath)) {
+            blockedDirectories.insert(directoryPath);
+            directoryPath = parentPaths.value(directoryPath);
+        }
+    }
+    
+    for (const DirectoryRecord& record : records) {
+        if (!blockedDirectories.contains(record.path)) {
+            m_dbManager->updateScanJournalDirectory(record.path, record.parentPath, record.modifiedTime);
+        }
+    }
+}
+
+std::shared_ptr<const MediaScanner::ScanJournal> MediaScanner::loadScanJournal()
+{
+    auto journal = std::make_shared<ScanJournal>();
+    
+    if (!m_dbManager) {
+        return journal;
+    }
+    
+    QSqlQuery directoryQuery = m_dbManager->getScanJournalDirectories();
+    while (directoryQuery.next()) {
+        const QString path = directoryQuery.value(0).toString();
+        const QString parentPath = directoryQuery.value(1).toString();
+        journal->directoryTimes.insert(path, directoryQuery.value(2).toLongLong());
+        if (!parentPath.isEmpty()) {
+            journal->subdirectories[parentPath].append(path);
+        }
+    }
+    
+    QSqlQuery fileQuery = m_dbManager->getScanJournalFiles();
+    while (fileQuery.next()) {
+        JournalFile entry;
+        entry.fileSize = fileQuery.value(2).toLongLong();
+        entry.modifiedTime = fileQuery.value(3).toLongLong();
+        entry.inode = fileQuery.value(4).toLongLong();
+        journal->files[fileQuery.value(1).toString()].insert(fileQuery.value(0).toString(), entry);
+    }
+    
+    qCDebug(mediaScanner) << "Loaded scan journal:" << journal->directoryTimes.size() << "directories";
+    return journal;
+}
+
+void MediaScanner::collectJournalSubtree(const ScanJournal& journal, const QString& directoryPath,
+                                         QStringList& directories, QStringList& files) const
+{
+    directories << directoryPath;
+    files << journal.files.value(directoryPath).keys();
+    
+    for (const QString& subdirectory : journal.subdirectories.value(directoryPath)) {
+        collectJournalSubtree(journal, subdirectory, directories, files);
+    }
+}
+
+MediaScanner::JournalFile MediaScanner::journalEntry(const QFileInfo& fileInfo)
+{
+    JournalFile entry;
+    entry.fileSize = fileInfo.size();
+    entry.modifiedTime = fileInfo.lastModified().toMSecsSinceEpoch();
+    
+#ifdef Q_OS_UNIX
+    // Catches files replaced by another with the same size and mtime
+    struct stat fileStat;
+    if (::stat(QFile::encodeName(fileInfo.absoluteFilePath()).constData(), &fileStat) == 0) {
+        entry.inode = static_cast<qint64>(fileStat.st_ino);
+    }
+#endif
+    
+    return entry;
+}
+
+void MediaScanner::processFile(const QString& filePath)
+{
+    const QFileInfo fileInfo(filePath);
+    
+    ScanResult result;
+    result.filePath = fileInfo.absoluteFilePath();
+    result.directoryPath = fileInfo.absolutePath();
+    result.journal = journalEntry(fileInfo);
     
     try {
-        MediaFile mediaFile = createMediaFileFromPath(filePath);
-        
-        if (mediaFile.isValid()) {
-            if (addOrUpdateMediaFile(mediaFile)) {
-                if (mediaFile.id() == -1) {
-                    m_progress.addedFiles++;
-                    emit fileAdded(filePath);
-                } else {
-                    m_progress.updatedFiles++;
-                    emit fileUpdated(filePath);
-                }
-            } else {
-                m_progress.errorFiles++;
-                emit fileError(filePath, "Failed to add/update file in database");
-            }
+        result.mediaFile = createMediaFileFromPath(filePath);
+        if (!result.mediaFile.isValid()) {
+            result.error = "Invalid media file";
+        }
+    } catch (const std::exception& e) {
+        result.error = QString("Exception: %1").arg(e.what());
+    }
+    
+    applyScanResult(result);
+}
+
+void MediaScanner::applyScanResult(const ScanResult& result)
+{
+    static MetricCounter& scannedFiles = MetricsRegistry::instance().counter(
+        "eonplay_scan_files", "Media files scanned into the library");
+    static MetricCounter& scannedBytes = MetricsRegistry::instance().counter(
+        "eonplay_scan_bytes", "Bytes of the media files scanned into the library");
+    
+    const QString& filePath = result.filePath;
+    bool success = false;
+    bool added = false;
+    QString error = result.error;
+    
+    if (error.isEmpty()) {
+        if (addOrUpdateMediaFile(result.mediaFile, &added)) {
+            success = true;
+            scannedFiles.add();
+            scannedBytes.add(quint64(qMax<qint64>(0, result.mediaFile.fileSize())));
         } else {
+            error = "Failed to add/update file in database";
+        }
+    }
+    
+    {
+        QMutexLocker locker(&m_progressMutex);
+        m_progress.currentFile = filePath;
+        m_progress.scannedFiles++;
+        if (!success) {
             m_progress.errorFiles++;
-            emit fileError(filePath, "Invalid media file");
+        } else if (added) {
+            m_progress.addedFiles++;
+        } else {
+            m_progress.updatedFiles++;
         }
-    } catch (const std::exception& e) {
-        m_progress.errorFiles++;
-        emit fileError(filePath, QString("Exception: %1").arg(e.what()));
-        qCWarning(mediaScanner) << "Error processing file" << filePath << ":" << e.what();
     }
     
-    logScanResult("processFile", filePath, true);
+    if (success && m_dbManager && !result.directoryPath.isEmpty()) {
+        m_dbManager->updateScanJournalFile(filePath, result.directoryPath, result.journal.fileSize,
+                                           result.journal.modifiedTime, result.journal.inode);
+    } else if (!success && m_isScanning) {
+        m_failedDirectories.insert(result.directoryPath);
+    }
+    
+    if (!success) {
+        emit fileError(filePath, error);
+        qCWarning(mediaScanner) << "Error processing file" << filePath << ":" << error;
+    } else if (added) {
+        emit fileAdded(filePath);
+    } else {
+        emit fileUpdated(filePath);
+    }
+    
+    logScanResult("processFile", filePath, success);
 }
 
-bool MediaScanner::shouldProcessFile(const QString& filePath) const
+bool MediaScanner::shouldProcessFile(const QFileInfo& fileInfo, const ScanOptions& options) const
 {
+    const QString filePath = fileInfo.absoluteFilePath();
+    
     // Check if it's a media file
     if (!isMediaFile(filePath)) {
         return false;
     }
     
     // Check include patterns
-    if (!m_options.includePatterns.isEmpty()) {
-        if (!matchesPattern(filePath, m_options.includePatterns)) {
+    if (!options.includePatterns.isEmpty()) {
+        if (!matchesPattern(filePath, options.includePatterns)) {
             return false;
         }
     }
     
     // Check exclude patterns
-    if (!m_options.excludePatterns.isEmpty()) {
-        if (matchesPattern(filePath, m_options.excludePatterns)) {
+    if (!options.excludePatterns.isEmpty()) {
+        if (matchesPattern(filePath, options.excludePatterns)) {
             return false;
         }
     }
     
-    // For incremental scan, check if file has been modified
-    if (m_options.mode == IncrementalScan) {
-        QFileInfo fileInfo(filePath);
-        QDateTime lastModified = fileInfo.lastModified();
-        
-        if (m_fileModificationCache.contains(filePath)) {
-            QDateTime cachedModified = m_fileModificationCache[filePath];
-            if (lastModified <= cachedModified) {
-                return false; // File hasn't been modified
-            }
-        }
-        
-        m_fileModificationCache[filePath] = lastModified;
-    }
-    
+    // Unchanged files are recognized through the scan journal
     return true;
 }
 
-bool MediaScanner::shouldProcessDirectory(const QString& directoryPath) const
+bool MediaScanner::shouldProcessDirectory(const QString& directoryPath, const ScanOptions& options) const
 {
     // Check exclude patterns for directories
-    if (!m_options.excludePatterns.isEmpty()) {
-        if (matchesPattern(directoryPath, m_options.excludePatterns)) {
+    if (!options.excludePatterns.isEmpty()) {
+        if (matchesPattern(directoryPath, options.excludePatterns)) {
             return false;
         }
     }
@@ -579,22 +1341,40 @@ MediaFile MediaScanner::createMediaFileFromPath(const QString& filePath)
     return mediaFile;
 }
 
-bool MediaScanner::addOrUpdateMediaFile(const MediaFile& mediaFile)
+bool MediaScanner::addOrUpdateMediaFile(const MediaFile& mediaFile, bool* added)
 {
     if (!m_dbManager) {
         return false;
     }
     
+    // During directory scans a single upsert replaces lookup plus write
+    if (m_dbManager->isBulkUpsertActive()) {
+        DatabaseManager::MediaFileRow row;
+        row.filePath = mediaFile.filePath();
+        row.title = mediaFile.title();
+        row.artist = mediaFile.artist();
+        row.album = mediaFile.album();
+        row.duration = mediaFile.duration();
+        row.fileSize = mediaFile.fileSize();
+        return m_dbManager->bulkUpsertMediaFile(row, added);
+    }
+    
     // Check if file already exists in database
     QSqlQuery existingQuery = m_dbManager->getMediaFileByPath(mediaFile.filePath());
     
     if (existingQuery.next()) {
         // File exists, update it
+        if (added) {
+            *added = false;
+        }
         int id = existingQuery.value("id").toInt();
         return m_dbManager->updateMediaFile(id, mediaFile.title(), mediaFile.artist(), 
                                           mediaFile.album(), mediaFile.duration());
     } else {
         // New file, add it
+        if (added) {
+            *added = true;
+        }
         return m_dbManager->addMediaFile(mediaFile.filePath(), mediaFile.title(), 
                                        mediaFile.artist(), mediaFile.album(), 
                                        mediaFile.duration(), mediaFile.fileSize());
@@ -603,84 +1383,154 @@ bool MediaScanner::addOrUpdateMediaFile(const MediaFile& mediaFile)
 
 void MediaScanner::updateScanProgress()
 {
-    QMutexLocker locker(&m_progressMutex);
-    
-    if (m_progress.totalFiles > 0) {
-        m_progress.percentage = (double)(m_progress.scannedFiles + m_progress.skippedFiles) / 
-                               m_progress.totalFiles * 100.0;
+    ScanProgress currentProgress;
+    {
+        QMutexLocker locker(&m_progressMutex);
+        
+        if (m_progress.totalFiles > 0) {
+            m_progress.percentage = (double)m_progress.scannedFiles / m_progress.totalFiles * 100.0;
+            
+            // Files are still being discovered, so the total is a lower bound
+            if (!m_enumerationDone) {
+                m_progress.percentage = qMin(m_progress.percentage, 99.0);
+            }
+        }
+        
+        currentProgress = m_progress;
     }
     
-    emit scanProgress(m_progress);
+    // Emit outside the lock so receivers may call progress()
+    emit scanProgress(currentProgress);
 }
 
-QString MediaScanner::calculateFileHash(const QString& filePath)
+void MediaScanner::resolveDuplicateCandidates(QVector<DuplicateCandidate>& candidates,
+                                              QList<QStringList>& duplicateGroups)
 {
-    // Check cache first
-    if (m_fileHashCache.contains(filePath)) {
-        QFileInfo fileInfo(filePath);
-        QDateTime lastModified = fileInfo.lastModified();
-        
-        if (m_fileModificationCache.contains(filePath) && 
-            m_fileModificationCache[filePath] == lastModified) {
-            return m_fileHashCache[filePath];
-        }
+    if (candidates.size() < 2) {
+        return;
     }
     
-    // Calculate hash
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        return QString();
+    // Stage 2: sample hashes, reused while the file is unchanged. Workers
+    // only touch their own candidate.
+    for (DuplicateCandidate& candidate : candidates) {
+        m_hashPool->start([&candidate]() {
+            ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Background);
+            const BackgroundIoScope backgroundIo;
+            const QFileInfo fileInfo(candidate.filePath);
+            candidate.exists = fileInfo.isFile() && fileInfo.size() == candidate.fileSize;
+            if (!candidate.exists) {
+                return;
+            }
+            
+            candidate.modifiedTime = fileInfo.lastModified().toMSecsSinceEpoch();
+            if (candidate.hashFileSize != candidate.fileSize ||
+                candidate.hashModifiedTime != candidate.modifiedTime || candidate.sampleHash.isEmpty()) {
+                candidate.sampleHash = sampleFileHash(candidate.filePath, candidate.fileSize);
+                candidate.contentHash.clear();
+                candidate.hashesChanged = true;
+            }
+        });
+    }
+    m_hashPool->waitForDone();
+    
+    QHash<QString, QVector<DuplicateCandidate*>> sampleGroups;
+    for (DuplicateCandidate& candidate : candidates) {
+        if (candidate.exists && !candidate.sampleHash.isEmpty()) {
+            sampleGroups[QString::number(candidate.fileSize) + QLatin1Char(':') + candidate.sampleHash]
+                .append(&candidate);
+        }
     }
     
-    QCryptographicHash hash(QCryptographicHash::Md5);
+    // Stage 3: full hashes, only for files whose samples collided
+    QVector<DuplicateCandidate*> survivors;
+    for (auto it = sampleGroups.constBegin(); it != sampleGroups.constEnd(); ++it) {
+        if (it.value().size() > 1) {
+            survivors += it.value();
+        }
+    }
     
-    // For large files, only hash the first and last parts
-    qint64 fileSize = file.size();
-    if (fileSize > 10 * 1024 * 1024) { // 10MB
-        // Hash first 1MB
-        QByteArray data = file.read(1024 * 1024);
-        hash.addData(data);
+    for (DuplicateCandidate* candidate : survivors) {
+        if (!candidate->contentHash.isEmpty()) {
+            continue;
+        }
         
-        // Hash last 1MB
-        file.seek(fileSize - 1024 * 1024);
-        data = file.read(1024 * 1024);
-        hash.addData(data);
-    } else {
-        // Hash entire file for smaller files
-        hash.addData(&file);
+        if (candidate->fileSize <= 2 * SAMPLE_HASH_BYTES) {
+            // The sample already covered the whole file
+            candidate->contentHash = candidate->sampleHash;
+            candidate->hashesChanged = true;
+            continue;
+        }
+        
+        m_hashPool->start([candidate]() {
+            ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Background);
+            const BackgroundIoScope backgroundIo;
+            candidate->contentHash = contentFileHash(candidate->filePath);
+            candidate->hashesChanged = true;
+        });
     }
+    m_hashPool->waitForDone();
     
-    QString hashString = hash.result().toHex();
+    QMap<QString, QStringList> contentGroups;
+    for (const DuplicateCandidate* candidate : survivors) {
+        if (!candidate->contentHash.isEmpty()) {
+            contentGroups[QString::number(candidate->fileSize) + QLatin1Char(':') + candidate->contentHash]
+                .append(candidate->filePath);
+        }
+    }
     
-    // Cache the result
-    QFileInfo fileInfo(filePath);
-    m_fileHashCache[filePath] = hashString;
-    m_fileModificationCache[filePath] = fileInfo.lastModified();
+    for (auto it = contentGroups.constBegin(); it != contentGroups.constEnd(); ++it) {
+        if (it.value().size() > 1) {
+            duplicateGroups.append(it.value());
+            emit duplicateGroupFound(it.value());
+        }
+    }
     
-    return hashString;
+    // Persist new hashes so the next run only reads files that changed
+    const bool ownTransaction = !m_dbManager->isBulkUpsertActive() && m_dbManager->beginTransaction();
+    for (const DuplicateCandidate& candidate : candidates) {
+        if (candidate.hashesChanged) {
+            m_dbManager->updateMediaFileHashes(candidate.filePath, candidate.sampleHash, candidate.contentHash,
+                                               candidate.fileSize, candidate.modifiedTime);
+        }
+    }
+    if (ownTransaction) {
+        m_dbManager->commitTransaction();
+    }
 }
 
-QHash<QString, QStringList> MediaScanner::groupFilesByHash()
+QString MediaScanner::sampleFileHash(const QString& filePath, qint64 fileSize)
 {
-    QHash<QString, QStringList> hashGroups;
+    ScanFileReader file(filePath);
+    if (!file.isOpen()) {
+        return QString();
+    }
     
-    if (!m_dbManager) {
-        return hashGroups;
+    // Head and tail catch both re-encoded files and differing tags, which
+    // most formats keep at one of the ends
+    QByteArray data;
+    if (fileSize > 2 * SAMPLE_HASH_BYTES) {
+        data = file.read(0, SAMPLE_HASH_BYTES);
+        data += file.read(fileSize - SAMPLE_HASH_BYTES, SAMPLE_HASH_BYTES);
+    } else {
+        data = file.read(0, fileSize);
+    }
+    if (data.size() != qMin<qint64>(fileSize, 2 * SAMPLE_HASH_BYTES)) {
+        return QString();
     }
     
-    QSqlQuery query = m_dbManager->getAllMediaFiles();
-    while (query.next()) {
-        QString filePath = query.value("file_path").toString();
-        
-        if (QFile::exists(filePath)) {
-            QString hash = calculateFileHash(filePath);
-            if (!hash.isEmpty()) {
-                hashGroups[hash].append(filePath);
-            }
-        }
+    const quint64 hash = xxHash64(data.constData(), data.size(), static_cast<quint64>(fileSize));
+    return QString::number(hash, 16).rightJustified(16, QLatin1Char('0'));
+}
+
+QString MediaScanner::contentFileHash(const QString& filePath)
+{
+    ScanFileReader file(filePath);
+    QCryptographicHash hash(QCryptographicHash::Blake2b_256);
+    if (!file.addToHash(hash)) {
+        return QString();
     }
     
-    return hashGroups;
+    return QString::fromLatin1(hash.result().toHex());
 }
 
 QHash<QString, QStringList> MediaScanner::groupFilesByMetadata()
@@ -711,93 +1561,90 @@ QHash<QString, QStringList> MediaScanner::groupFilesByMetadata()
 
 void MediaScanner::setupFileWatcher()
 {
-    if (!m_fileWatcher) {
-        m_fileWatcher = new QFileSystemWatcher(this);
-        connect(m_fileWatcher, &QFileSystemWatcher::directoryChanged,
-                this, &MediaScanner::onDirectoryChanged);
-        connect(m_fileWatcher, &QFileSystemWatcher::fileChanged,
-                this, &MediaScanner::onFileChanged);
+    if (!m_directoryWatcher) {
+        m_directoryWatcher = DirectoryWatcher::create(this);
+        connect(m_directoryWatcher, &DirectoryWatcher::directoriesChanged,
+                this, &MediaScanner::onWatchedDirectoriesChanged);
     }
 }
 
 void MediaScanner::addDirectoryToWatcher(const QString& directoryPath)
 {
-    if (m_fileWatcher && QDir(directoryPath).exists()) {
-        if (!m_fileWatcher->directories().contains(directoryPath)) {
-            m_fileWatcher->addPath(directoryPath);
-            qCDebug(mediaScanner) << "Added directory to watcher:" << directoryPath;
-        }
+    if (m_directoryWatcher && m_directoryWatcher->addPath(directoryPath)) {
+        qCDebug(mediaScanner) << "Added directory to watcher:" << directoryPath;
     }
 }
 
 void MediaScanner::removeDirectoryFromWatcher(const QString& directoryPath)
 {
-    if (m_fileWatcher && m_fileWatcher->directories().contains(directoryPath)) {
-        m_fileWatcher->removePath(directoryPath);
+    if (m_directoryWatcher) {
+        m_directoryWatcher->removePath(directoryPath);
         qCDebug(mediaScanner) << "Removed directory from watcher:" << directoryPath;
     }
 }
 
-void MediaScanner::onDirectoryChanged(const QString& path)
+void MediaScanner::onWatchedDirectoriesChanged(const QStringList& directoryPaths)
 {
     QMutexLocker locker(&m_watcherMutex);
     
-    if (!m_watcherQueue.contains(path)) {
-        m_watcherQueue.append(path);
+    for (const QString& path : directoryPaths) {
+        if (!m_watcherQueue.contains(path)) {
+            m_watcherQueue.append(path);
+        }
     }
+    locker.unlock();
     
-    m_watcherTimer->start();
+    // The watcher already debounced, so changes are picked up right away
+    processWatcherQueue();
 }
 
-void MediaScanner::onFileChanged(const QString& path)
+void MediaScanner::processWatcherQueue()
 {
-    QMutexLocker locker(&m_watcherMutex);
-    
-    if (!m_watcherQueue.contains(path)) {
-        m_watcherQueue.append(path);
+    if (m_isScanning) {
+        // Keep the queue and try again once the running scan is done
+        m_watcherTimer->start();
+        return;
     }
     
-    m_watcherTimer->start();
-}
-
-void MediaScanner::processWatcherQueue()
-{
     QMutexLocker locker(&m_watcherMutex);
     
     QStringList queue = m_watcherQueue;
     m_watcherQueue.clear();
     locker.unlock();
     
-    for (const QString& path : queue) {
-        QFileInfo info(path);
-        
-        if (info.isDir()) {
-            // Directory changed, scan for new files
-            QDir dir(path);
-            QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
-            
-            for (const QFileInfo& entry : entries) {
-                if (isMediaFile(entry.absoluteFilePath())) {
-                    processFile(entry.absoluteFilePath());
-                }
-            }
-        } else if (info.isFile()) {
-            // File changed
-            if (info.exists() && isMediaFile(path)) {
-                processFile(path);
-            } else if (!info.exists()) {
-                // File was deleted
-                if (m_dbManager) {
-                    m_dbManager->removeMediaFileByPath(path);
-                }
-                emit fileRemoved(path);
-            }
+    // Deleted directories are handled by scanning the nearest existing
+    // ancestor, and directories inside another queued one are covered by it
+    QStringList roots;
+    for (QString path : queue) {
+        while (!path.isEmpty() && !QFileInfo(path).isDir()) {
+            const QString parentPath = QFileInfo(path).absolutePath();
+            path = parentPath == path ? QString() : parentPath;
+        }
+        if (!path.isEmpty() && !roots.contains(path)) {
+            roots << path;
         }
     }
     
-    if (!queue.isEmpty()) {
-        emit libraryUpdated();
+    QStringList scanRoots;
+    for (const QString& root : roots) {
+        const bool covered = std::any_of(roots.cbegin(), roots.cend(), [&root](const QString& other) {
+            return root.startsWith(other + QLatin1Char('/'));
+        });
+        if (!covered) {
+            scanRoots << root;
+        }
+    }
+    
+    if (scanRoots.isEmpty()) {
+        return;
     }
+    
+    qCDebug(mediaScanner) << "Rescanning changed directories:" << scanRoots;
+    
+    // Only what changed is re-read; everything else comes from the journal
+    ScanOptions options = m_options;
+    options.mode = IncrementalScan;
+    startScan(scanRoots, options, true);
 }
 
 bool MediaScanner::isMediaFile(const QString& filePath) const
@@ -1,4 +1,9 @@
 #include "data/MetadataExtractor.h"
+#include "data/CoverArtStore.h"
+#include "data/DirectoryWatcher.h"
+#include "data/ScanFileReader.h"
+#include "network/NetworkService.h"
+#include "ThreadPriority.h"
 #include <QFileInfo>
 #include <QDir>
 #include <QProcess>
@@ -15,35 +20,133 @@
 #include <QMutexLocker>
 #include <QMimeDatabase>
 #include <QRegularExpression>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDataStream>
+#include <QThread>
+#include <QDateTime>
+#include <QMetaObject>
+#include <QPair>
+#include <QSet>
+#include <algorithm>
+#include <utility>
 
 Q_LOGGING_CATEGORY(metadataExtractor, "eonplay.data.metadata")
 
 namespace EonPlay {
 namespace Data {
 
+namespace {
+const QString CACHE_FILE = QStringLiteral("metadata.db");
+const QString METADATA_TABLE = QStringLiteral("metadata_cache");
+const QString SEEK_INDEX_TABLE = QStringLiteral("seek_index");
+const qint64 DEFAULT_CACHE_SIZE_LIMIT = 32 * 1024 * 1024;
+const quint8 CACHE_RECORD_VERSION = 1;
+
+// Evicting down to a fraction of the bound keeps eviction off the
+// per-file path while a library scan fills the cache
+const double CACHE_EVICTION_TARGET = 0.9;
+
+// Network shares are latency bound, local disks seek bound
+const int DEFAULT_NETWORK_CONCURRENCY = 8;
+
+QByteArray serializeMetadata(const MetadataExtractor::MediaMetadata& metadata)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_5);
+    stream << CACHE_RECORD_VERSION
+           << metadata.title << metadata.artist << metadata.album << metadata.genre
+           << metadata.albumArtist << metadata.composer << metadata.comment
+           << qint32(metadata.year) << qint32(metadata.trackNumber) << qint32(metadata.discNumber)
+           << metadata.duration << qint32(metadata.bitrate) << qint32(metadata.sampleRate)
+           << qint32(metadata.channels) << metadata.codec << metadata.coverArtPath
+           << qint32(metadata.width) << qint32(metadata.height) << metadata.frameRate
+           << metadata.videoCodec << metadata.audioCodec << metadata.customTags;
+    return data;
+}
+
+bool deserializeMetadata(const QByteArray& data, MetadataExtractor::MediaMetadata& metadata)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_6_5);
+
+    quint8 version = 0;
+    stream >> version;
+    if (version != CACHE_RECORD_VERSION) {
+        return false;
+    }
+
+    qint32 year, trackNumber, discNumber, bitrate, sampleRate, channels, width, height;
+    stream >> metadata.title >> metadata.artist >> metadata.album >> metadata.genre
+           >> metadata.albumArtist >> metadata.composer >> metadata.comment
+           >> year >> trackNumber >> discNumber
+           >> metadata.duration >> bitrate >> sampleRate
+           >> channels >> metadata.codec >> metadata.coverArtPath
+           >> width >> height >> metadata.frameRate
+           >> metadata.videoCodec >> metadata.audioCodec >> metadata.customTags;
+    if (stream.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    metadata.year = year;
+    metadata.trackNumber = trackNumber;
+    metadata.discNumber = discNumber;
+    metadata.bitrate = bitrate;
+    metadata.sampleRate = sampleRate;
+    metadata.channels = channels;
+    metadata.width = width;
+    metadata.height = height;
+    metadata.isValid = true;
+    return true;
+}
+}
+
 MetadataExtractor::MetadataExtractor(QObject* parent)
     : QObject(parent)
-    , m_networkManager(nullptr)
+    , m_cacheBytes(-1)
+    , m_cacheSizeLimit(DEFAULT_CACHE_SIZE_LIMIT)
+    , m_localPool(new QThreadPool(this))
+    , m_networkPool(new QThreadPool(this))
+    , m_nextBatchId(1)
+    , m_localInFlight(0)
+    , m_networkInFlight(0)
 {
     // Set default cache directory
     m_cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/metadata";
     QDir().mkpath(m_cacheDirectory);
     
     // Set default cover art directory
-    m_options.coverArtDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/coverart";
+    m_options.coverArtDirectory = CoverArtStore::defaultDirectory();
     QDir().mkpath(m_options.coverArtDirectory);
     
-    setupNetworkManager();
-    
     // Find external tools
     m_ffmpegPath = findExecutable("ffmpeg");
     m_ffprobePath = findExecutable("ffprobe");
     
+    // Workers keep their cache connection, so threads are not recycled
+    m_localPool->setMaxThreadCount(qBound(2, QThread::idealThreadCount() / 2, 4));
+    m_localPool->setExpiryTimeout(-1);
+    m_networkPool->setMaxThreadCount(DEFAULT_NETWORK_CONCURRENCY);
+    m_networkPool->setExpiryTimeout(-1);
+    
     qCInfo(metadataExtractor) << "MetadataExtractor initialized";
     qCDebug(metadataExtractor) << "FFmpeg path:" << m_ffmpegPath;
     qCDebug(metadataExtractor) << "FFprobe path:" << m_ffprobePath;
 }
 
+MetadataExtractor::~MetadataExtractor()
+{
+    // Workers post their results back to this object
+    m_jobQueue.clear();
+    m_localPool->waitForDone();
+    m_networkPool->waitForDone();
+    
+    QMutexLocker locker(&m_cacheMutex);
+    closeCacheDatabases();
+}
+
 void MetadataExtractor::extractMetadata(const QString& filePath)
 {
     if (!QFile::exists(filePath)) {
@@ -118,11 +221,204 @@ MetadataExtractor::MediaMetadata MetadataExtractor::extractMetadataSync(const QS
 
 void MetadataExtractor::extractMetadataForFiles(const QStringList& filePaths)
 {
-    for (const QString& filePath : filePaths) {
-        extractMetadata(filePath);
+    extractMetadataBatch(filePaths);
+}
+
+int MetadataExtractor::extractMetadataBatch(const QStringList& filePaths, DeliveryOrder order)
+{
+    const int batchId = m_nextBatchId++;
+    
+    if (filePaths.isEmpty()) {
+        QMetaObject::invokeMethod(this, [this, batchId]() {
+            emit batchFinished(batchId);
+        }, Qt::QueuedConnection);
+        return batchId;
+    }
+    
+    ExtractionBatch& batch = m_batches[batchId];
+    batch.order = order;
+    batch.filePaths = filePaths;
+    batch.results.resize(filePaths.size());
+    batch.remaining = filePaths.size();
+    
+    for (int i = 0; i < filePaths.size(); ++i) {
+        m_jobQueue.push_back(ExtractionJob{batchId, i, filePaths.at(i)});
+    }
+    
+    dispatchJobs();
+    return batchId;
+}
+
+void MetadataExtractor::cancelBatch(int batchId)
+{
+    if (!m_batches.remove(batchId)) {
+        return;
+    }
+    
+    // Jobs already running finish, and their results are dropped
+    m_jobQueue.erase(std::remove_if(m_jobQueue.begin(), m_jobQueue.end(),
+                                    [batchId](const ExtractionJob& job) { return job.batchId == batchId; }),
+                     m_jobQueue.end());
+    
+    emit batchFinished(batchId);
+}
+
+void MetadataExtractor::cancelAllExtractions()
+{
+    const QList<int> batchIds = m_batches.keys();
+    for (int batchId : batchIds) {
+        cancelBatch(batchId);
     }
 }
 
+void MetadataExtractor::boostPriority(const QStringList& filePaths)
+{
+    if (filePaths.isEmpty() || m_jobQueue.empty()) {
+        return;
+    }
+    
+    const QSet<QString> boosted(filePaths.cbegin(), filePaths.cend());
+    std::stable_partition(m_jobQueue.begin(), m_jobQueue.end(),
+                          [&boosted](const ExtractionJob& job) { return boosted.contains(job.filePath); });
+}
+
+void MetadataExtractor::setLocalConcurrency(int threads)
+{
+    m_localPool->setMaxThreadCount(qMax(1, threads));
+    dispatchJobs();
+}
+
+void MetadataExtractor::setNetworkConcurrency(int threads)
+{
+    m_networkPool->setMaxThreadCount(qMax(1, threads));
+    dispatchJobs();
+}
+
+void MetadataExtractor::dispatchJobs()
+{
+    // Jobs stay in m_jobQueue until a worker is free, so boosting and
+    // cancelling apply to everything that has not started yet
+    auto it = m_jobQueue.begin();
+    while (it != m_jobQueue.end()) {
+        if (m_localInFlight >= m_localPool->maxThreadCount() &&
+            m_networkInFlight >= m_networkPool->maxThreadCount()) {
+            break;
+        }
+        
+        const bool network = isNetworkFile(it->filePath);
+        int& inFlight = network ? m_networkInFlight : m_localInFlight;
+        QThreadPool* pool = network ? m_networkPool : m_localPool;
+        if (inFlight >= pool->maxThreadCount()) {
+            ++it;
+            continue;
+        }
+        
+        const ExtractionJob job = *it;
+        it = m_jobQueue.erase(it);
+        ++inFlight;
+        
+        pool->start([this, job, network, options = m_options]() {
+            ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Background);
+            const BackgroundIoScope backgroundIo;
+            ExtractionResult result;
+            result.done = true;
+            
+            if (!QFile::exists(job.filePath)) {
+                result.error = "File does not exist";
+            } else if (!isFormatSupported(job.filePath)) {
+                result.error = "Unsupported file format";
+            } else {
+                if (options.cacheResults) {
+                    result.metadata = loadFromCache(job.filePath);
+                }
+                if (!result.metadata.isValid) {
+                    result.metadata = extractLocalMetadata(job.filePath, options.extractCoverArt);
+                    if (result.metadata.isValid && options.cacheResults) {
+                        saveToCache(job.filePath, result.metadata);
+                    }
+                }
+                if (!result.metadata.isValid) {
+                    result.error = "Failed to extract metadata";
+                }
+            }
+            
+            QMetaObject::invokeMethod(this, [this, job, network, result]() {
+                completeJob(job, network, result);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void MetadataExtractor::completeJob(const ExtractionJob& job, bool network, const ExtractionResult& result)
+{
+    if (network) {
+        --m_networkInFlight;
+    } else {
+        --m_localInFlight;
+    }
+    
+    auto batchIt = m_batches.find(job.batchId);
+    if (batchIt != m_batches.end()) {
+        ExtractionBatch& batch = batchIt.value();
+        --batch.remaining;
+        
+        if (batch.order == Unordered) {
+            deliverResult(job.filePath, result);
+        } else {
+            batch.results[job.index] = result;
+            
+            // Receivers may cancel the batch from any delivered signal
+            while (batchIt != m_batches.end() && batchIt->nextToDeliver < batchIt->results.size() &&
+                   batchIt->results[batchIt->nextToDeliver].done) {
+                const int index = batchIt->nextToDeliver++;
+                const QString filePath = batchIt->filePaths.at(index);
+                const ExtractionResult ready = std::move(batchIt->results[index]);
+                deliverResult(filePath, ready);
+                batchIt = m_batches.find(job.batchId);
+            }
+        }
+        
+        batchIt = m_batches.find(job.batchId);
+        if (batchIt != m_batches.end() && batchIt->remaining == 0) {
+            m_batches.erase(batchIt);
+            emit batchFinished(job.batchId);
+        }
+    }
+    
+    dispatchJobs();
+}
+
+void MetadataExtractor::deliverResult(const QString& filePath, const ExtractionResult& result)
+{
+    if (!result.metadata.isValid) {
+        emit metadataExtractionFailed(filePath, result.error);
+        return;
+    }
+    
+    emit metadataExtracted(filePath, result.metadata);
+    
+    if (!result.metadata.coverArtPath.isEmpty()) {
+        emit coverArtExtracted(filePath, result.metadata.coverArtPath);
+    }
+    
+    if (m_options.fetchFromWeb && m_options.method != LocalOnly) {
+        enhanceMetadataFromWeb(result.metadata, filePath);
+    }
+}
+
+bool MetadataExtractor::isNetworkFile(const QString& filePath)
+{
+    const QString directory = QFileInfo(filePath).absolutePath();
+    auto it = m_networkDirectories.constFind(directory);
+    if (it != m_networkDirectories.constEnd()) {
+        return it.value();
+    }
+    
+    const bool network = DirectoryWatcher::isNetworkPath(directory);
+    m_networkDirectories.insert(directory, network);
+    return network;
+}
+
 void MetadataExtractor::extractCoverArt(const QString& filePath, const QString& outputPath)
 {
     if (!QFile::exists(filePath)) {
@@ -141,21 +437,18 @@ void MetadataExtractor::extractCoverArt(const QString& filePath, const QString&
 
 QString MetadataExtractor::extractCoverArtSync(const QString& filePath, const QString& outputPath)
 {
-    QString finalOutputPath = outputPath;
-    if (finalOutputPath.isEmpty()) {
-        finalOutputPath = generateCoverArtPath(filePath);
-    }
+    // Without an output path the art goes to the shared cover art store
     
     // Try TagLib first (for audio files)
     if (isAudioFile(filePath)) {
-        QString result = extractCoverArtWithTagLib(filePath, finalOutputPath);
+        QString result = extractCoverArtWithTagLib(filePath, outputPath);
         if (!result.isEmpty()) {
             return result;
         }
     }
     
     // Try FFmpeg as fallback
-    return extractCoverArtWithFFmpeg(filePath, finalOutputPath);
+    return extractCoverArtWithFFmpeg(filePath, outputPath);
 }
 
 void MetadataExtractor::enhanceMetadataFromWeb(const MediaMetadata& basicMetadata, const QString& filePath)
@@ -182,8 +475,7 @@ void MetadataExtractor::clearCache()
 {
     QMutexLocker locker(&m_cacheMutex);
     
-    m_metadataCache.clear();
-    m_cacheTimestamps.clear();
+    closeCacheDatabases();
     
     // Clear cache directory
     QDir cacheDir(m_cacheDirectory);
@@ -195,10 +487,27 @@ void MetadataExtractor::clearCache()
 
 void MetadataExtractor::setCacheDirectory(const QString& directory)
 {
+    QMutexLocker locker(&m_cacheMutex);
+    
+    closeCacheDatabases();
     m_cacheDirectory = directory;
     QDir().mkpath(m_cacheDirectory);
 }
 
+void MetadataExtractor::setCacheSizeLimit(qint64 bytes)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    
+    m_cacheSizeLimit = qMax<qint64>(0, bytes);
+    evictFromCache();
+}
+
+qint64 MetadataExtractor::cacheSizeLimit() const
+{
+    QMutexLocker locker(&m_cacheMutex);
+    return m_cacheSizeLimit;
+}
+
 QStringList MetadataExtractor::supportedAudioFormats()
 {
     return QStringList() << "mp3" << "flac" << "wav" << "aac" << "ogg" << "wma" << "m4a" << "opus" << "ape" << "wv";
@@ -220,10 +529,15 @@ bool MetadataExtractor::isFormatSupported(const QString& filePath)
     return allFormats.contains(extension);
 }
 
-MetadataExtractor::MediaMetadata MetadataExtractor::extractLocalMetadata(const QString& filePath)
+MetadataExtractor::MediaMetadata MetadataExtractor::extractLocalMetadata(const QString& filePath, bool withCoverArt)
 {
     MediaMetadata metadata;
     
+    // Set when FFprobe has already looked at the file, in which case it
+    // also told us whether there is any cover art to extract
+    bool probed = false;
+    bool hasCoverArt = false;
+    
     // Try different extraction methods
     if (isAudioFile(filePath)) {
         // For audio files, try TagLib first
@@ -231,12 +545,17 @@ MetadataExtractor::MediaMetadata MetadataExtractor::extractLocalMetadata(const Q
         
         if (!metadata.isValid && !m_ffprobePath.isEmpty()) {
             // Fallback to FFmpeg
-            metadata = extractWithFFmpeg(filePath);
+            metadata = extractWithFFmpeg(filePath, &hasCoverArt);
+            probed = true;
+        } else if (withCoverArt) {
+            // Tags and pictures come from the same TagLib read
+            metadata.coverArtPath = extractCoverArtWithTagLib(filePath, QString());
         }
     } else if (isVideoFile(filePath)) {
         // For video files, use FFmpeg
         if (!m_ffprobePath.isEmpty()) {
-            metadata = extractWithFFmpeg(filePath);
+            metadata = extractWithFFmpeg(filePath, &hasCoverArt);
+            probed = true;
         }
         
         if (!metadata.isValid) {
@@ -251,6 +570,10 @@ MetadataExtractor::MediaMetadata MetadataExtractor::extractLocalMetadata(const Q
         if (metadata.title.isEmpty()) {
             metadata.title = fileInfo.completeBaseName();
         }
+        
+        if (withCoverArt && metadata.coverArtPath.isEmpty() && (!probed || hasCoverArt)) {
+            metadata.coverArtPath = extractCoverArtWithFFmpeg(filePath, QString());
+        }
     }
     
     return metadata;
@@ -273,7 +596,7 @@ MetadataExtractor::MediaMetadata MetadataExtractor::extractWithTagLib(const QStr
     return metadata;
 }
 
-MetadataExtractor::MediaMetadata MetadataExtractor::extractWithFFmpeg(const QString& filePath)
+MetadataExtractor::MediaMetadata MetadataExtractor::extractWithFFmpeg(const QString& filePath, bool* hasCoverArt)
 {
     MediaMetadata metadata;
     
@@ -282,6 +605,7 @@ MetadataExtractor::MediaMetadata MetadataExtractor::extractWithFFmpeg(const QStr
     }
     
     QProcess ffprobe;
+    ThreadPriority::setBackgroundProcess(&ffprobe);
     QStringList arguments;
     arguments << "-v" << "quiet"
               << "-print_format" << "json"
@@ -358,6 +682,14 @@ MetadataExtractor::MediaMetadata MetadataExtractor::extractWithFFmpeg(const QStr
             QJsonObject stream = streamValue.toObject();
             QString codecType = stream["codec_type"].toString();
             
+            // Embedded cover art shows up as a single-frame video stream
+            if (stream["disposition"].toObject()["attached_pic"].toInt() == 1) {
+                if (hasCoverArt) {
+                    *hasCoverArt = true;
+                }
+                continue;
+            }
+            
             if (codecType == "video") {
                 metadata.width = stream["width"].toInt();
                 metadata.height = stream["height"].toInt();
@@ -427,12 +759,22 @@ QString MetadataExtractor::extractCoverArtWithFFmpeg(const QString& filePath, co
     }
     
     QProcess ffmpeg;
+    ThreadPriority::setBackgroundProcess(&ffmpeg);
     QStringList arguments;
-    arguments << "-i" << filePath
-              << "-an" << "-vcodec" << "copy"
-              << "-f" << "image2"
-              << "-y" // Overwrite output
-              << outputPath;
+    arguments << "-v" << "quiet"
+              << "-i" << filePath
+              << "-an" << "-vcodec" << "copy";
+    
+    if (!outputPath.isEmpty()) {
+        arguments << "-f" << "image2"
+                  << "-y" // Overwrite output
+                  << outputPath;
+    } else {
+        // Attached pictures only: every video stream minus the real ones
+        arguments << "-map" << "0:v" << "-map" << "-0:V"
+                  << "-frames:v" << "1"
+                  << "-f" << "image2pipe" << "-";
+    }
     
     ffmpeg.start(m_ffmpegPath, arguments);
     
@@ -440,11 +782,15 @@ QString MetadataExtractor::extractCoverArtWithFFmpeg(const QString& filePath, co
         return QString();
     }
     
-    if (ffmpeg.exitCode() == 0 && QFile::exists(outputPath)) {
-        return outputPath;
+    if (ffmpeg.exitCode() != 0) {
+        return QString();
     }
     
-    return QString();
+    if (outputPath.isEmpty()) {
+        return CoverArtStore(m_options.coverArtDirectory).store(ffmpeg.readAllStandardOutput());
+    }
+    
+    return QFile::exists(outputPath) ? outputPath : QString();
 }
 
 void MetadataExtractor::fetchFromMusicBrainz(const MediaMetadata& metadata, const QString& filePath)
@@ -463,7 +809,7 @@ void MetadataExtractor::fetchFromMusicBrainz(const MediaMetadata& metadata, cons
     requestUrl.setQuery(query);
     
     QNetworkRequest request = createApiRequest(requestUrl.toString(), "musicbrainz");
-    QNetworkReply* reply = m_networkManager->get(request);
+    QNetworkReply* reply = getRequest(request);
     
     m_pendingRequests[reply] = filePath;
     m_pendingMetadata[reply] = metadata;
@@ -489,7 +835,7 @@ void MetadataExtractor::fetchFromLastFm(const MediaMetadata& metadata, const QSt
     requestUrl.setQuery(query);
     
     QNetworkRequest request = createApiRequest(requestUrl.toString(), "lastfm");
-    QNetworkReply* reply = m_networkManager->get(request);
+    QNetworkReply* reply = getRequest(request);
     
     m_pendingRequests[reply] = filePath;
     m_pendingMetadata[reply] = metadata;
@@ -509,17 +855,6 @@ void MetadataExtractor::fetchFromDiscogs(const MediaMetadata& metadata, const QS
     Q_UNUSED(filePath)
 }
 
-QString MetadataExtractor::generateCoverArtPath(const QString& filePath, const QString& outputDir)
-{
-    QString dir = outputDir.isEmpty() ? m_options.coverArtDirectory : outputDir;
-    QFileInfo fileInfo(filePath);
-    
-    QString baseName = fileInfo.completeBaseName();
-    QString coverArtPath = QDir(dir).absoluteFilePath(baseName + "_cover.jpg");
-    
-    return coverArtPath;
-}
-
 QString MetadataExtractor::calculateMetadataHash(const MediaMetadata& metadata)
 {
     QCryptographicHash hash(QCryptographicHash::Md5);
@@ -536,35 +871,243 @@ MetadataExtractor::MediaMetadata MetadataExtractor::loadFromCache(const QString&
     QMutexLocker locker(&m_cacheMutex);
     
     MediaMetadata metadata;
-    
-    if (m_metadataCache.contains(filePath)) {
-        QDateTime cacheTime = m_cacheTimestamps.value(filePath);
-        QFileInfo fileInfo(filePath);
-        
-        // Check if cache is still valid (file not modified since cache)
-        if (cacheTime >= fileInfo.lastModified()) {
-            metadata = m_metadataCache[filePath];
-        }
+    QByteArray data;
+    if (readCacheRecord(METADATA_TABLE, filePath, &data) && !deserializeMetadata(data, metadata)) {
+        metadata = MediaMetadata();
+        removeCacheRecord(METADATA_TABLE, filePath, data.size());
     }
-    
     return metadata;
 }
 
 void MetadataExtractor::saveToCache(const QString& filePath, const MediaMetadata& metadata)
 {
     QMutexLocker locker(&m_cacheMutex);
+    writeCacheRecord(METADATA_TABLE, filePath, serializeMetadata(metadata));
+}
+
+bool MetadataExtractor::loadSeekIndex(const QString& filePath, QByteArray* data)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    return readCacheRecord(SEEK_INDEX_TABLE, filePath, data);
+}
+
+void MetadataExtractor::saveSeekIndex(const QString& filePath, const QByteArray& data)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    
+    // A null array would be stored as NULL; an empty record means "needs no index"
+    writeCacheRecord(SEEK_INDEX_TABLE, filePath, data.isNull() ? QByteArray("") : data);
+}
+
+bool MetadataExtractor::readCacheRecord(const QString& table, const QString& filePath, QByteArray* data)
+{
+    QSqlDatabase db = cacheDatabase();
+    if (!db.isOpen()) {
+        return false;
+    }
     
-    m_metadataCache[filePath] = metadata;
-    m_cacheTimestamps[filePath] = QDateTime::currentDateTime();
+    QSqlQuery query(db);
+    query.prepare(QString("SELECT size, mtime, data FROM %1 WHERE path = ?").arg(table));
+    query.addBindValue(filePath);
+    if (!query.exec() || !query.next()) {
+        return false;
+    }
+    
+    // An entry is only good for the exact file it was made from
+    QFileInfo fileInfo(filePath);
+    const bool current = query.value(0).toLongLong() == fileInfo.size() &&
+                         query.value(1).toLongLong() == fileInfo.lastModified().toMSecsSinceEpoch();
+    *data = query.value(2).toByteArray();
+    query.finish();
+    
+    if (!current) {
+        removeCacheRecord(table, filePath, data->size());
+        data->clear();
+        return false;
+    }
+    
+    QSqlQuery touch(db);
+    touch.prepare(QString("UPDATE %1 SET accessed = ? WHERE path = ?").arg(table));
+    touch.addBindValue(QDateTime::currentMSecsSinceEpoch());
+    touch.addBindValue(filePath);
+    touch.exec();
+    
+    return true;
 }
 
-void MetadataExtractor::setupNetworkManager()
+void MetadataExtractor::writeCacheRecord(const QString& table, const QString& filePath, const QByteArray& data)
 {
-    if (!m_networkManager) {
-        m_networkManager = new QNetworkAccessManager(this);
-        connect(m_networkManager, &QNetworkAccessManager::finished,
-                this, &MetadataExtractor::handleNetworkReply);
+    QSqlDatabase db = cacheDatabase();
+    if (!db.isOpen()) {
+        return;
     }
+    
+    QFileInfo fileInfo(filePath);
+    
+    qint64 replacedBytes = 0;
+    if (m_cacheBytes >= 0) {
+        QSqlQuery existing(db);
+        existing.prepare(QString("SELECT length(CAST(path AS BLOB)) + length(data) FROM %1 WHERE path = ?").arg(table));
+        existing.addBindValue(filePath);
+        if (existing.exec() && existing.next()) {
+            replacedBytes = existing.value(0).toLongLong();
+        }
+    }
+    
+    QSqlQuery query(db);
+    query.prepare(QString("INSERT OR REPLACE INTO %1 (path, size, mtime, accessed, data) "
+                          "VALUES (?, ?, ?, ?, ?)").arg(table));
+    query.addBindValue(filePath);
+    query.addBindValue(fileInfo.size());
+    query.addBindValue(fileInfo.lastModified().toMSecsSinceEpoch());
+    query.addBindValue(QDateTime::currentMSecsSinceEpoch());
+    query.addBindValue(data);
+    if (!query.exec()) {
+        qCWarning(metadataExtractor) << "Failed to cache" << table << "entry:" << query.lastError().text();
+        return;
+    }
+    
+    if (m_cacheBytes >= 0) {
+        m_cacheBytes += filePath.toUtf8().size() + data.size() - replacedBytes;
+    }
+    evictFromCache();
+}
+
+void MetadataExtractor::removeCacheRecord(const QString& table, const QString& filePath, qint64 dataBytes)
+{
+    QSqlQuery remove(cacheDatabase());
+    remove.prepare(QString("DELETE FROM %1 WHERE path = ?").arg(table));
+    remove.addBindValue(filePath);
+    if (remove.exec() && m_cacheBytes >= 0) {
+        m_cacheBytes -= filePath.toUtf8().size() + dataBytes;
+    }
+}
+
+QSqlDatabase MetadataExtractor::cacheDatabase()
+{
+    // QSqlDatabase connections must stay on the thread that opened them
+    const QString connectionName = QString("eonplay_metadata_cache_%1_%2")
+        .arg(reinterpret_cast<quintptr>(this), 0, 16)
+        .arg(reinterpret_cast<quintptr>(QThread::currentThread()), 0, 16);
+    
+    if (QSqlDatabase::contains(connectionName)) {
+        return QSqlDatabase::database(connectionName);
+    }
+    
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(QDir(m_cacheDirectory).filePath(CACHE_FILE));
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    m_cacheConnections.append(connectionName);
+    
+    if (!db.open()) {
+        qCWarning(metadataExtractor) << "Failed to open metadata cache:" << db.lastError().text();
+        return db;
+    }
+    
+    QSqlQuery query(db);
+    query.exec("PRAGMA journal_mode = WAL");
+    query.exec("PRAGMA synchronous = NORMAL");
+    if (!query.exec("CREATE TABLE IF NOT EXISTS metadata_cache ("
+                    "path TEXT PRIMARY KEY, "
+                    "size INTEGER NOT NULL, "
+                    "mtime INTEGER NOT NULL, "
+                    "accessed INTEGER NOT NULL, "
+                    "data BLOB NOT NULL) WITHOUT ROWID") ||
+        !query.exec("CREATE INDEX IF NOT EXISTS idx_metadata_cache_accessed ON metadata_cache(accessed)") ||
+        !query.exec("CREATE TABLE IF NOT EXISTS seek_index ("
+                    "path TEXT PRIMARY KEY, "
+                    "size INTEGER NOT NULL, "
+                    "mtime INTEGER NOT NULL, "
+                    "accessed INTEGER NOT NULL, "
+                    "data BLOB NOT NULL) WITHOUT ROWID") ||
+        !query.exec("CREATE INDEX IF NOT EXISTS idx_seek_index_accessed ON seek_index(accessed)")) {
+        qCWarning(metadataExtractor) << "Failed to create metadata cache:" << query.lastError().text();
+        db.close();
+    }
+    
+    return db;
+}
+
+void MetadataExtractor::closeCacheDatabases()
+{
+    for (const QString& connectionName : std::as_const(m_cacheConnections)) {
+        {
+            QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+            if (db.isOpen()) {
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+    m_cacheConnections.clear();
+    m_cacheBytes = -1;
+}
+
+void MetadataExtractor::evictFromCache()
+{
+    QSqlDatabase db = cacheDatabase();
+    if (!db.isOpen()) {
+        return;
+    }
+    
+    QSqlQuery query(db);
+    if (m_cacheBytes < 0) {
+        if (!query.exec("SELECT (SELECT COALESCE(SUM(length(CAST(path AS BLOB)) + length(data)), 0) FROM metadata_cache) + "
+                        "(SELECT COALESCE(SUM(length(CAST(path AS BLOB)) + length(data)), 0) FROM seek_index)") ||
+            !query.next()) {
+            return;
+        }
+        m_cacheBytes = query.value(0).toLongLong();
+        query.finish();
+    }
+    
+    if (m_cacheBytes <= m_cacheSizeLimit) {
+        return;
+    }
+    
+    const qint64 target = static_cast<qint64>(m_cacheSizeLimit * CACHE_EVICTION_TARGET);
+    // Metadata and seek indexes share the bound, least recently used first
+    if (!query.exec("SELECT path, length(CAST(path AS BLOB)) + length(data), 0 AS seek, accessed FROM metadata_cache "
+                    "UNION ALL "
+                    "SELECT path, length(CAST(path AS BLOB)) + length(data), 1 AS seek, accessed FROM seek_index "
+                    "ORDER BY accessed")) {
+        return;
+    }
+    
+    QList<QPair<QString, bool>> evicted;
+    qint64 remaining = m_cacheBytes;
+    while (remaining > target && query.next()) {
+        evicted.append({query.value(0).toString(), query.value(2).toBool()});
+        remaining -= query.value(1).toLongLong();
+    }
+    query.finish();
+    
+    db.transaction();
+    QSqlQuery removeMetadata(db);
+    removeMetadata.prepare("DELETE FROM metadata_cache WHERE path = ?");
+    QSqlQuery removeSeekIndex(db);
+    removeSeekIndex.prepare("DELETE FROM seek_index WHERE path = ?");
+    for (const auto& [path, seek] : std::as_const(evicted)) {
+        QSqlQuery& remove = seek ? removeSeekIndex : removeMetadata;
+        remove.addBindValue(path);
+        remove.exec();
+    }
+    if (!db.commit()) {
+        db.rollback();
+        m_cacheBytes = -1;
+        return;
+    }
+    
+    m_cacheBytes = remaining;
+    qCDebug(metadataExtractor) << "Evicted" << evicted.size() << "metadata cache entries";
+}
+
+QNetworkReply* MetadataExtractor::getRequest(const QNetworkRequest& request)
+{
+    // Shared client; library enrichment gives way to playback transfers
+    QNetworkReply* reply = NetworkService::instance().get(request, NetworkService::RequestClass::Metadata);
+    connect(reply, &QNetworkReply::finished, this, &MetadataExtractor::handleNetworkReply);
+    return reply;
 }
 
 QNetworkRequest MetadataExtractor::createApiRequest(const QString& url, const QString& service)
@@ -0,0 +1,142 @@
+#include "data/NearDuplicateIndex.h"
+#include <QPair>
+#include <QSet>
+#include <algorithm>
+#include <numeric>
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+constexpr int BAND_BITS = 64 / NearDuplicateIndex::BANDS;
+
+// Union-find over positions in the index
+int findRoot(QVector<int>& parents, int position)
+{
+    while (parents[position] != position) {
+        parents[position] = parents[parents[position]];
+        position = parents[position];
+    }
+    return position;
+}
+} // namespace
+
+void NearDuplicateIndex::insert(int id, const VideoFingerprint& fingerprint)
+{
+    const int position = m_ids.size();
+    m_ids.append(id);
+    m_fingerprints.append(fingerprint);
+
+    const QVector<VideoFingerprint::Frame>& frames = fingerprint.frames();
+    for (int frame = 0; frame < frames.size(); ++frame) {
+        if (!frames[frame].valid) {
+            continue;
+        }
+        for (int band = 0; band < BANDS; ++band) {
+            m_buckets[bucketKey(frame, band, frames[frame].perceptualHash)].append(position);
+        }
+    }
+}
+
+void NearDuplicateIndex::clear()
+{
+    m_ids.clear();
+    m_fingerprints.clear();
+    m_buckets.clear();
+}
+
+QList<int> NearDuplicateIndex::query(const VideoFingerprint& fingerprint, int maxDistance) const
+{
+    QSet<int> seen;
+    QList<QPair<int, int>> matches;     // Distance, position
+
+    const QVector<VideoFingerprint::Frame>& frames = fingerprint.frames();
+    for (int frame = 0; frame < frames.size(); ++frame) {
+        if (!frames[frame].valid) {
+            continue;
+        }
+        for (int band = 0; band < BANDS; ++band) {
+            const auto it = m_buckets.constFind(bucketKey(frame, band, frames[frame].perceptualHash));
+            if (it == m_buckets.constEnd() || it->size() > MAX_BUCKET_SIZE) {
+                continue;
+            }
+            for (int position : *it) {
+                if (seen.contains(position)) {
+                    continue;
+                }
+                seen.insert(position);
+                const int distance = fingerprint.distance(m_fingerprints[position]);
+                if (distance >= 0 && distance <= maxDistance) {
+                    matches.append({distance, position});
+                }
+            }
+        }
+    }
+
+    std::sort(matches.begin(), matches.end());
+    QList<int> ids;
+    ids.reserve(matches.size());
+    for (const auto& match : matches) {
+        ids.append(m_ids[match.second]);
+    }
+    return ids;
+}
+
+QList<QList<int>> NearDuplicateIndex::groups(int maxDistance) const
+{
+    QVector<int> parents(m_ids.size());
+    std::iota(parents.begin(), parents.end(), 0);
+
+    // Each pair is compared once, however many buckets it shares
+    QSet<quint64> compared;
+    for (auto it = m_buckets.constBegin(); it != m_buckets.constEnd(); ++it) {
+        const QVector<int>& bucket = it.value();
+        if (bucket.size() < 2 || bucket.size() > MAX_BUCKET_SIZE) {
+            continue;
+        }
+
+        for (int i = 0; i < bucket.size(); ++i) {
+            for (int j = i + 1; j < bucket.size(); ++j) {
+                const int a = qMin(bucket[i], bucket[j]);
+                const int b = qMax(bucket[i], bucket[j]);
+                const quint64 pair = (quint64(quint32(a)) << 32) | quint32(b);
+                if (a == b || compared.contains(pair)) {
+                    continue;
+                }
+                compared.insert(pair);
+
+                const int rootA = findRoot(parents, a);
+                const int rootB = findRoot(parents, b);
+                if (rootA == rootB) {
+                    continue;
+                }
+                const int distance = m_fingerprints[a].distance(m_fingerprints[b]);
+                if (distance >= 0 && distance <= maxDistance) {
+                    parents[rootB] = rootA;
+                }
+            }
+        }
+    }
+
+    QHash<int, QList<int>> members;
+    for (int position = 0; position < m_ids.size(); ++position) {
+        members[findRoot(parents, position)].append(m_ids[position]);
+    }
+
+    QList<QList<int>> result;
+    for (auto it = members.constBegin(); it != members.constEnd(); ++it) {
+        if (it->size() > 1) {
+            result.append(it.value());
+        }
+    }
+    return result;
+}
+
+quint64 NearDuplicateIndex::bucketKey(int frame, int band, quint64 hash)
+{
+    const quint64 bits = (hash >> (band * BAND_BITS)) & ((quint64(1) << BAND_BITS) - 1);
+    return (quint64(frame) << 40) | (quint64(band) << 32) | bits;
+}
+
+} // namespace Data
+} // namespace EonPlay
@@ -1,12 +1,8 @@
 #include "data/Playlist.h"
 #include "data/DatabaseManager.h"
 #include <QFileInfo>
-#include <QTextStream>
-#include <QStringConverter>
 #include <QUrl>
 #include <QDir>
-#include <QRandomGenerator>
-#include <QRegularExpression>
 #include <QDebug>
 #include <algorithm>
 
@@ -19,8 +15,10 @@ Playlist::Playlist(QObject* parent)
     , m_createdDate(QDateTime::currentDateTime())
     , m_modifiedDate(QDateTime::currentDateTime())
     , m_currentIndex(-1)
+    , m_indexValid(false)
     , m_shuffled(false)
     , m_repeatMode(NoRepeat)
+    , m_shuffleWeighting(ShuffleOrder::Uniform)
     , m_cachedTotalDuration(0)
     , m_cachedTotalSize(0)
     , m_statisticsCached(false)
@@ -96,12 +94,20 @@ MediaFile Playlist::item(int index) const
 
 int Playlist::indexOf(const MediaFile& file) const
 {
-    for (int i = 0; i < m_items.size(); ++i) {
-        if (m_items[i] == file) {
-            return i;
-        }
-    }
-    return -1;
+    // Files compare equal by path
+    return indexOfPath(file.filePath());
+}
+
+int Playlist::indexOfPath(const QString& filePath) const
+{
+    ensureIndex();
+    return m_pathIndex.value(filePath, -1);
+}
+
+int Playlist::indexOfId(int mediaFileId) const
+{
+    ensureIndex();
+    return m_idIndex.value(mediaFileId, -1);
 }
 
 bool Playlist::contains(const MediaFile& file) const
@@ -111,12 +117,7 @@ bool Playlist::contains(const MediaFile& file) const
 
 bool Playlist::containsPath(const QString& filePath) const
 {
-    for (const MediaFile& file : m_items) {
-        if (file.filePath() == filePath) {
-            return true;
-        }
-    }
-    return false;
+    return indexOfPath(filePath) != -1;
 }
 
 void Playlist::addItem(const MediaFile& file)
@@ -133,15 +134,50 @@ void Playlist::insertItem(int index, const MediaFile& file)
     m_items.insert(index, file);
     m_statisticsCached = false;
     
-    // Update shuffle order if needed
+    if (index == m_items.size() - 1 && m_indexValid) {
+        indexItem(index);
+    } else {
+        invalidateIndex();
+    }
+    
+    // The new item is placed among those still to play
     if (m_shuffled) {
-        generateShuffleOrder();
+        m_shuffleOrder.insert(index, upcomingShufflePosition());
     }
     
     emit itemAdded(index, file);
     emit playlistModified();
 }
 
+int Playlist::updateItem(const MediaFile& snapshot)
+{
+    // Items before the first index cannot match
+    const int first = snapshot.id() > 0 ? indexOfId(snapshot.id()) : -1;
+    if (first == -1) {
+        return 0;
+    }
+    
+    int replaced = 0;
+    for (int i = first; i < m_items.size(); ++i) {
+        if (m_items[i].id() != snapshot.id()) {
+            continue;
+        }
+        
+        const bool pathChanged = m_items[i].filePath() != snapshot.filePath();
+        m_items[i] = snapshot;
+        if (pathChanged) {
+            invalidateIndex();
+        } else if (m_indexValid) {
+            m_itemKeys[i] = makeItemKeys(snapshot);
+        }
+        ++replaced;
+    }
+    
+    m_statisticsCached = false;
+    emit playlistModified();
+    return replaced;
+}
+
 bool Playlist::removeItem(int index)
 {
     if (index < 0 || index >= m_items.size()) {
@@ -151,6 +187,7 @@ bool Playlist::removeItem(int index)
     MediaFile removedFile = m_items[index];
     m_items.removeAt(index);
     m_statisticsCached = false;
+    invalidateIndex();
     
     // Adjust current index if needed
     if (m_currentIndex > index) {
@@ -162,9 +199,8 @@ bool Playlist::removeItem(int index)
         emit currentIndexChanged(m_currentIndex);
     }
     
-    // Update shuffle order if needed
     if (m_shuffled) {
-        generateShuffleOrder();
+        m_shuffleOrder.remove(index);
     }
     
     emit itemRemoved(index, removedFile);
@@ -191,6 +227,7 @@ bool Playlist::moveItem(int fromIndex, int toIndex)
     
     MediaFile file = m_items.takeAt(fromIndex);
     m_items.insert(toIndex, file);
+    invalidateIndex();
     
     // Adjust current index if needed
     if (m_currentIndex == fromIndex) {
@@ -204,9 +241,8 @@ bool Playlist::moveItem(int fromIndex, int toIndex)
         emit currentIndexChanged(m_currentIndex);
     }
     
-    // Update shuffle order if needed
     if (m_shuffled) {
-        generateShuffleOrder();
+        m_shuffleOrder.move(fromIndex, toIndex);
     }
     
     emit itemMoved(fromIndex, toIndex);
@@ -221,6 +257,7 @@ void Playlist::clear()
         m_currentIndex = -1;
         m_shuffleOrder.clear();
         m_statisticsCached = false;
+        invalidateIndex();
         
         emit currentIndexChanged(m_currentIndex);
         emit playlistCleared();
@@ -238,9 +275,17 @@ void Playlist::addItems(const QList<MediaFile>& files)
     m_items.append(files);
     m_statisticsCached = false;
     
-    // Update shuffle order if needed
+    if (m_indexValid) {
+        for (int i = startIndex; i < m_items.size(); ++i) {
+            indexItem(i);
+        }
+    }
+    
     if (m_shuffled) {
-        generateShuffleOrder();
+        const int firstPosition = upcomingShufflePosition();
+        for (int i = startIndex; i < m_items.size(); ++i) {
+            m_shuffleOrder.insert(i, firstPosition);
+        }
     }
     
     // Emit signals for each added item
@@ -257,13 +302,64 @@ void Playlist::removeItems(const QList<int>& indices)
         return;
     }
     
-    // Sort indices in descending order to remove from end first
-    QList<int> sortedIndices = indices;
-    std::sort(sortedIndices.begin(), sortedIndices.end(), std::greater<int>());
+    QList<bool> removed(m_items.size(), false);
+    QList<int> removedIndices;
+    for (int index : indices) {
+        if (index >= 0 && index < m_items.size() && !removed[index]) {
+            removed[index] = true;
+            removedIndices.append(index);
+        }
+    }
+    
+    if (removedIndices.isEmpty()) {
+        return;
+    }
+    
+    // Signals report indices from the end first, as if removed one by one
+    std::sort(removedIndices.begin(), removedIndices.end(), std::greater<int>());
+    QList<MediaFile> removedFiles;
+    removedFiles.reserve(removedIndices.size());
+    for (int index : std::as_const(removedIndices)) {
+        removedFiles.append(m_items[index]);
+    }
+    
+    // One compaction pass instead of shifting the list once per item
+    int removedBeforeCurrent = 0;
+    int write = 0;
+    for (int read = 0; read < m_items.size(); ++read) {
+        if (removed[read]) {
+            if (read < m_currentIndex) {
+                ++removedBeforeCurrent;
+            }
+            continue;
+        }
+        if (write != read) {
+            m_items[write] = std::move(m_items[read]);
+        }
+        ++write;
+    }
+    m_items.resize(write);
+    m_statisticsCached = false;
+    invalidateIndex();
+    
+    // The current item, or the one that took its place, stays current
+    const int previousIndex = m_currentIndex;
+    if (m_currentIndex >= 0) {
+        m_currentIndex = qMin(m_currentIndex - removedBeforeCurrent, static_cast<int>(m_items.size()) - 1);
+    }
     
-    for (int index : sortedIndices) {
-        removeItem(index);
+    if (m_shuffled) {
+        m_shuffleOrder.remove(removed);
     }
+    
+    if (m_currentIndex != previousIndex || (previousIndex >= 0 && removed[previousIndex])) {
+        emit currentIndexChanged(m_currentIndex);
+    }
+    
+    for (int i = 0; i < removedIndices.size(); ++i) {
+        emit itemRemoved(removedIndices[i], removedFiles[i]);
+    }
+    emit playlistModified();
 }
 
 void Playlist::setCurrentIndex(int index)
@@ -287,18 +383,12 @@ MediaFile Playlist::nextItem() const
     int nextIndex = m_currentIndex;
     
     if (m_shuffled) {
-        int currentShuffledPos = -1;
-        for (int i = 0; i < m_shuffleOrder.size(); ++i) {
-            if (m_shuffleOrder[i] == m_currentIndex) {
-                currentShuffledPos = i;
-                break;
-            }
-        }
+        const int currentShuffledPos = m_shuffleOrder.positionOf(m_currentIndex);
         
         if (currentShuffledPos != -1 && currentShuffledPos < m_shuffleOrder.size() - 1) {
-            nextIndex = m_shuffleOrder[currentShuffledPos + 1];
+            nextIndex = m_shuffleOrder.logicalAt(currentShuffledPos + 1);
         } else if (m_repeatMode == RepeatAll) {
-            nextIndex = m_shuffleOrder.isEmpty() ? 0 : m_shuffleOrder[0];
+            nextIndex = m_shuffleOrder.isEmpty() ? 0 : m_shuffleOrder.logicalAt(0);
         } else {
             return MediaFile();
         }
@@ -315,6 +405,36 @@ MediaFile Playlist::nextItem() const
     return item(nextIndex);
 }
 
+QList<MediaFile> Playlist::upcomingItems(int count) const
+{
+    QList<MediaFile> upcoming;
+    const bool shuffled = m_shuffled && !m_shuffleOrder.isEmpty();
+    const int size = shuffled ? m_shuffleOrder.size() : static_cast<int>(m_items.size());
+    if (size == 0 || count <= 0) {
+        return upcoming;
+    }
+    
+    const int position = shuffled ? m_shuffleOrder.positionOf(m_currentIndex) : m_currentIndex;
+    if (shuffled && position == -1 && m_repeatMode != RepeatAll) {
+        return upcoming;
+    }
+    
+    // Every other item once; with no current item, every item
+    const int steps = position < 0 ? size : size - 1;
+    for (int step = 1; step <= steps && upcoming.size() < count; ++step) {
+        int next = position + step;
+        if (next >= size) {
+            if (m_repeatMode != RepeatAll) {
+                break;
+            }
+            next -= size;
+        }
+        upcoming.append(item(shuffled ? m_shuffleOrder.logicalAt(next) : next));
+    }
+    
+    return upcoming;
+}
+
 MediaFile Playlist::previousItem() const
 {
     if (m_items.isEmpty()) {
@@ -324,18 +444,13 @@ MediaFile Playlist::previousItem() const
     int prevIndex = m_currentIndex;
     
     if (m_shuffled) {
-        int currentShuffledPos = -1;
-        for (int i = 0; i < m_shuffleOrder.size(); ++i) {
-            if (m_shuffleOrder[i] == m_currentIndex) {
-                currentShuffledPos = i;
-                break;
-            }
-        }
+        const int currentShuffledPos = m_shuffleOrder.positionOf(m_currentIndex);
         
         if (currentShuffledPos > 0) {
-            prevIndex = m_shuffleOrder[currentShuffledPos - 1];
+            prevIndex = m_shuffleOrder.logicalAt(currentShuffledPos - 1);
         } else if (m_repeatMode == RepeatAll) {
-            prevIndex = m_shuffleOrder.isEmpty() ? m_items.size() - 1 : m_shuffleOrder.last();
+            prevIndex = m_shuffleOrder.isEmpty() ? m_items.size() - 1
+                                                 : m_shuffleOrder.logicalAt(m_shuffleOrder.size() - 1);
         } else {
             return MediaFile();
         }
@@ -363,13 +478,7 @@ bool Playlist::hasNext() const
     }
     
     if (m_shuffled) {
-        int currentShuffledPos = -1;
-        for (int i = 0; i < m_shuffleOrder.size(); ++i) {
-            if (m_shuffleOrder[i] == m_currentIndex) {
-                currentShuffledPos = i;
-                break;
-            }
-        }
+        const int currentShuffledPos = m_shuffleOrder.positionOf(m_currentIndex);
         return currentShuffledPos < m_shuffleOrder.size() - 1;
     } else {
         return m_currentIndex < m_items.size() - 1;
@@ -387,13 +496,7 @@ bool Playlist::hasPrevious() const
     }
     
     if (m_shuffled) {
-        int currentShuffledPos = -1;
-        for (int i = 0; i < m_shuffleOrder.size(); ++i) {
-            if (m_shuffleOrder[i] == m_currentIndex) {
-                currentShuffledPos = i;
-                break;
-            }
-        }
+        const int currentShuffledPos = m_shuffleOrder.positionOf(m_currentIndex);
         return currentShuffledPos > 0;
     } else {
         return m_currentIndex > 0;
@@ -415,17 +518,28 @@ void Playlist::setShuffle(bool enabled)
     }
 }
 
+void Playlist::setShuffleWeighting(ShuffleOrder::Weighting weighting)
+{
+    m_shuffleWeighting = weighting;
+}
+
+void Playlist::reshuffle()
+{
+    if (m_shuffled) {
+        generateShuffleOrder();
+    }
+}
+
 QList<MediaFile> Playlist::search(const QString& query) const
 {
+    ensureIndex();
+    
     QList<MediaFile> results;
-    QString lowerQuery = query.toLower();
+    const QString lowerQuery = query.toLower();
     
-    for (const MediaFile& file : m_items) {
-        if (file.title().toLower().contains(lowerQuery) ||
-            file.artist().toLower().contains(lowerQuery) ||
-            file.album().toLower().contains(lowerQuery) ||
-            file.fileName().toLower().contains(lowerQuery)) {
-            results.append(file);
+    for (int i = 0; i < m_items.size(); ++i) {
+        if (m_itemKeys[i].search.contains(lowerQuery)) {
+            results.append(m_items[i]);
         }
     }
     
@@ -434,10 +548,13 @@ QList<MediaFile> Playlist::search(const QString& query) const
 
 QList<MediaFile> Playlist::filterByArtist(const QString& artist) const
 {
+    ensureIndex();
+    
     QList<MediaFile> results;
-    for (const MediaFile& file : m_items) {
-        if (file.artist().compare(artist, Qt::CaseInsensitive) == 0) {
-            results.append(file);
+    const QString key = artist.toCaseFolded();
+    for (int i = 0; i < m_items.size(); ++i) {
+        if (m_itemKeys[i].artist == key) {
+            results.append(m_items[i]);
         }
     }
     return results;
@@ -445,10 +562,13 @@ QList<MediaFile> Playlist::filterByArtist(const QString& artist) const
 
 QList<MediaFile> Playlist::filterByAlbum(const QString& album) const
 {
+    ensureIndex();
+    
     QList<MediaFile> results;
-    for (const MediaFile& file : m_items) {
-        if (file.album().compare(album, Qt::CaseInsensitive) == 0) {
-            results.append(file);
+    const QString key = album.toCaseFolded();
+    for (int i = 0; i < m_items.size(); ++i) {
+        if (m_itemKeys[i].album == key) {
+            results.append(m_items[i]);
         }
     }
     return results;
@@ -456,10 +576,13 @@ QList<MediaFile> Playlist::filterByAlbum(const QString& album) const
 
 QList<MediaFile> Playlist::filterByGenre(const QString& genre) const
 {
+    ensureIndex();
+    
     QList<MediaFile> results;
-    for (const MediaFile& file : m_items) {
-        if (file.genre().compare(genre, Qt::CaseInsensitive) == 0) {
-            results.append(file);
+    const QString key = genre.toCaseFolded();
+    for (int i = 0; i < m_items.size(); ++i) {
+        if (m_itemKeys[i].genre == key) {
+            results.append(m_items[i]);
         }
     }
     return results;
@@ -493,6 +616,7 @@ void Playlist::sort(SortOrder order, Qt::SortOrder direction)
         
         return direction == Qt::AscendingOrder ? result : !result;
     });
+    invalidateIndex();
     
     // Reset current index and shuffle order after sorting
     m_currentIndex = -1;
@@ -572,24 +696,140 @@ bool Playlist::save(DatabaseManager* dbManager)
         if (m_id == -1) {
             return false;
         }
+        m_savedItems.clear();
     } else {
         // Update existing playlist
         if (!dbManager->updatePlaylist(m_id, m_name)) {
             return false;
         }
-        
-        // Clear existing items
-        dbManager->clearPlaylist(m_id);
     }
     
-    // Add all items
+    // Only files in the library can be stored
+    QList<int> items;
     for (int i = 0; i < m_items.size(); ++i) {
-        const MediaFile& file = m_items[i];
-        if (!dbManager->addToPlaylist(m_id, file.id(), i)) {
-            qWarning() << "Failed to add item to playlist:" << file.filePath();
+        if (m_items[i].id() > 0) {
+            items.append(i);
+        } else {
+            qWarning() << "Failed to add item to playlist:" << m_items[i].filePath();
+        }
+    }
+    
+    // Pair items with stored rows of the same file, in order
+    QHash<int, QList<int>> savedByFile;
+    for (int i = 0; i < m_savedItems.size(); ++i) {
+        savedByFile[m_savedItems[i].mediaFileId].append(i);
+    }
+    
+    QList<int> matched(items.size(), -1);
+    QList<bool> savedUsed(m_savedItems.size(), false);
+    for (int i = 0; i < items.size(); ++i) {
+        QList<int>& candidates = savedByFile[m_items[items[i]].id()];
+        if (!candidates.isEmpty()) {
+            matched[i] = candidates.takeFirst();
+            savedUsed[matched[i]] = true;
+        }
+    }
+    
+    // The longest run of paired rows that are already in order keeps its
+    // keys; everything else is moved or inserted around it
+    QList<int> tails;                       // Index into items, per run length
+    QList<int> previous(items.size(), -1);
+    for (int i = 0; i < items.size(); ++i) {
+        if (matched[i] < 0) {
+            continue;
+        }
+        const qint64 key = m_savedItems[matched[i]].position;
+        auto it = std::lower_bound(tails.begin(), tails.end(), key, [this, &matched](int index, qint64 value) {
+            return m_savedItems[matched[index]].position < value;
+        });
+        if (it != tails.begin()) {
+            previous[i] = *(it - 1);
+        }
+        if (it == tails.end()) {
+            tails.append(i);
+        } else {
+            *it = i;
+        }
+    }
+    
+    QList<bool> kept(items.size(), false);
+    for (int i = tails.isEmpty() ? -1 : tails.last(); i >= 0; i = previous[i]) {
+        kept[i] = true;
+    }
+    
+    // Spread the other items evenly between their kept neighbours
+    QList<qint64> keys(items.size(), 0);
+    bool renumber = false;
+    qint64 previousKey = 0;
+    int segmentStart = 0;
+    for (int i = 0; i <= items.size() && !renumber; ++i) {
+        if (i < items.size() && !kept[i]) {
+            continue;
+        }
+        
+        const qint64 nextKey = i < items.size() ? m_savedItems[matched[i]].position : -1;
+        const int count = i - segmentStart;
+        const qint64 step = nextKey < 0 ? DatabaseManager::PLAYLIST_POSITION_GAP
+                                        : (nextKey - previousKey) / (count + 1);
+        if (count > 0 && step < 1) {
+            renumber = true;
+            break;
+        }
+        for (int j = 0; j < count; ++j) {
+            keys[segmentStart + j] = previousKey + step * (j + 1);
+        }
+        
+        if (i < items.size()) {
+            keys[i] = nextKey;
+            previousKey = nextKey;
+        }
+        segmentStart = i + 1;
+    }
+    
+    if (renumber) {
+        for (int i = 0; i < items.size(); ++i) {
+            kept[i] = false;
+            keys[i] = (i + 1) * DatabaseManager::PLAYLIST_POSITION_GAP;
+        }
+    }
+    
+    QList<qint64> removedRowIds;
+    for (int i = 0; i < m_savedItems.size(); ++i) {
+        if (!savedUsed[i]) {
+            removedRowIds.append(m_savedItems[i].rowId);
+        }
+    }
+    
+    QList<DatabaseManager::PlaylistItemRow> rows;
+    QList<int> rowItems;
+    for (int i = 0; i < items.size(); ++i) {
+        if (kept[i] || (matched[i] >= 0 && m_savedItems[matched[i]].position == keys[i])) {
+            continue;
         }
+        DatabaseManager::PlaylistItemRow row;
+        row.rowId = matched[i] >= 0 ? m_savedItems[matched[i]].rowId : -1;
+        row.mediaFileId = m_items[items[i]].id();
+        row.position = keys[i];
+        rows.append(row);
+        rowItems.append(i);
+    }
+    
+    if (!dbManager->updatePlaylistItems(m_id, removedRowIds, rows)) {
+        qWarning() << "Failed to save playlist items:" << m_name;
+        return false;
     }
     
+    QList<SavedItem> savedItems;
+    savedItems.reserve(items.size());
+    for (int i = 0; i < items.size(); ++i) {
+        savedItems.append(SavedItem{matched[i] >= 0 ? m_savedItems[matched[i]].rowId : -1,
+                                    m_items[items[i]].id(), keys[i]});
+    }
+    for (int i = 0; i < rows.size(); ++i) {
+        savedItems[rowItems[i]].rowId = rows[i].rowId;
+    }
+    m_savedItems = savedItems;
+    
     return true;
 }
 
@@ -613,18 +853,14 @@ bool Playlist::load(int playlistId, DatabaseManager* dbManager)
     
     // Load playlist items
     m_items.clear();
+    m_savedItems.clear();
+    invalidateIndex();
     QSqlQuery itemsQuery = dbManager->getPlaylistItems(playlistId);
-    while (itemsQuery.next()) {
-        MediaFile file;
-        file.setId(itemsQuery.value("media_file_id").toInt());
-        file.setFilePath(itemsQuery.value("file_path").toString());
-        file.setTitle(itemsQuery.value("title").toString());
-        file.setArtist(itemsQuery.value("artist").toString());
-        file.setAlbum(itemsQuery.value("album").toString());
-        file.setDuration(itemsQuery.value("duration").toLongLong());
-        
-        m_items.append(file);
-    }
+    m_items = dbManager->mediaFileCache()->fromQuery(itemsQuery, QStringLiteral("media_file_id"),
+        [this](const QSqlQuery& row, const MediaFile& file) {
+            m_savedItems.append(SavedItem{row.value("id").toLongLong(), file.id(),
+                                          row.value("position").toLongLong()});
+        });
     
     m_statisticsCached = false;
     m_currentIndex = -1;
@@ -655,6 +891,7 @@ QVariantMap Playlist::toVariantMap() const
     map["modifiedDate"] = m_modifiedDate;
     map["currentIndex"] = m_currentIndex;
     map["shuffled"] = m_shuffled;
+    map["shuffleWeighting"] = static_cast<int>(m_shuffleWeighting);
     map["repeatMode"] = static_cast<int>(m_repeatMode);
     
     QVariantList itemsList;
@@ -675,9 +912,12 @@ void Playlist::fromVariantMap(const QVariantMap& map)
     m_modifiedDate = map.value("modifiedDate").toDateTime();
     m_currentIndex = map.value("currentIndex", -1).toInt();
     m_shuffled = map.value("shuffled", false).toBool();
+    m_shuffleWeighting = static_cast<ShuffleOrder::Weighting>(
+        map.value("shuffleWeighting", ShuffleOrder::Uniform).toInt());
     m_repeatMode = static_cast<RepeatMode>(map.value("repeatMode", NoRepeat).toInt());
     
     m_items.clear();
+    invalidateIndex();
     QVariantList itemsList = map.value("items").toList();
     for (const QVariant& itemVar : itemsList) {
         MediaFile file;
@@ -694,167 +934,64 @@ void Playlist::fromVariantMap(const QVariantMap& map)
 
 bool Playlist::exportToM3U(const QString& filePath) const
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        return false;
-    }
-    
-    QTextStream stream(&file);
-    stream.setEncoding(QStringConverter::Utf8);
-    
-    stream << "#EXTM3U\n";
-    
-    for (const MediaFile& mediaFile : m_items) {
-        if (mediaFile.fileExists()) {
-            stream << "#EXTINF:" << (mediaFile.duration() / 1000) << ","
-                   << mediaFile.displayName() << "\n";
-            stream << QDir::toNativeSeparators(mediaFile.filePath()) << "\n";
-        }
-    }
-    
-    return true;
+    return PlaylistFile::write(filePath, PlaylistFile::M3U, exportEntries());
 }
 
 bool Playlist::exportToPLS(const QString& filePath) const
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        return false;
-    }
-    
-    QTextStream stream(&file);
-    stream.setEncoding(QStringConverter::Utf8);
-    
-    stream << "[playlist]\n";
-    
-    int validItemCount = 0;
-    for (int i = 0; i < m_items.size(); ++i) {
-        const MediaFile& mediaFile = m_items[i];
-        if (mediaFile.fileExists()) {
-            validItemCount++;
-            stream << "File" << validItemCount << "=" 
-                   << QDir::toNativeSeparators(mediaFile.filePath()) << "\n";
-            stream << "Title" << validItemCount << "=" 
-                   << mediaFile.displayName() << "\n";
-            stream << "Length" << validItemCount << "=" 
-                   << (mediaFile.duration() / 1000) << "\n";
-        }
-    }
-    
-    stream << "NumberOfEntries=" << validItemCount << "\n";
-    stream << "Version=2\n";
-    
-    return true;
+    return PlaylistFile::write(filePath, PlaylistFile::PLS, exportEntries());
 }
 
 bool Playlist::importFromM3U(const QString& filePath)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return false;
-    }
-    
-    QTextStream stream(&file);
-    stream.setEncoding(QStringConverter::Utf8);
-    
-    QList<MediaFile> newItems;
-    QString line;
-    QString currentTitle;
-    
-    while (stream.readLineInto(&line)) {
-        line = line.trimmed();
-        
-        if (line.startsWith("#EXTINF:")) {
-            // Extract title from EXTINF line
-            int commaPos = line.indexOf(',');
-            if (commaPos != -1) {
-                currentTitle = line.mid(commaPos + 1).trimmed();
-            }
-        } else if (!line.isEmpty() && !line.startsWith("#")) {
-            // This should be a file path
-            QString mediaPath = QDir::fromNativeSeparators(line);
-            
-            // Convert relative paths to absolute
-            if (QFileInfo(mediaPath).isRelative()) {
-                QFileInfo playlistInfo(filePath);
-                mediaPath = playlistInfo.absoluteDir().absoluteFilePath(mediaPath);
-            }
-            
-            if (MediaFile::isSupportedFile(mediaPath)) {
-                MediaFile file(mediaPath);
-                if (!currentTitle.isEmpty()) {
-                    file.setTitle(currentTitle);
-                    currentTitle.clear();
-                }
-                newItems.append(file);
-            }
-        }
-    }
-    
-    if (!newItems.isEmpty()) {
-        addItems(newItems);
-        return true;
-    }
-    
-    return false;
+    return importEntries(filePath);
 }
 
 bool Playlist::importFromPLS(const QString& filePath)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return false;
+    return importEntries(filePath);
+}
+
+QList<PlaylistFile::Entry> Playlist::exportEntries() const
+{
+    QStringList paths;
+    paths.reserve(m_items.size());
+    for (const MediaFile& mediaFile : m_items) {
+        paths.append(mediaFile.filePath());
     }
     
-    QTextStream stream(&file);
-    stream.setEncoding(QStringConverter::Utf8);
-    
-    QHash<int, QString> files;
-    QHash<int, QString> titles;
-    QString line;
+    // Missing files are left out; the checks run in parallel
+    const QList<bool> exists = PlaylistFile::filesExist(paths);
     
-    while (stream.readLineInto(&line)) {
-        line = line.trimmed();
-        
-        if (line.startsWith("File")) {
-            QRegularExpression fileRegex("^File(\\d+)=(.+)$");
-            QRegularExpressionMatch match = fileRegex.match(line);
-            if (match.hasMatch()) {
-                int index = match.captured(1).toInt();
-                QString path = match.captured(2);
-                files[index] = QDir::fromNativeSeparators(path);
-            }
-        } else if (line.startsWith("Title")) {
-            QRegularExpression titleRegex("^Title(\\d+)=(.+)$");
-            QRegularExpressionMatch match = titleRegex.match(line);
-            if (match.hasMatch()) {
-                int index = match.captured(1).toInt();
-                QString title = match.captured(2);
-                titles[index] = title;
-            }
+    QList<PlaylistFile::Entry> entries;
+    entries.reserve(m_items.size());
+    for (int i = 0; i < m_items.size(); ++i) {
+        if (exists[i]) {
+            const MediaFile& mediaFile = m_items[i];
+            entries.append(PlaylistFile::Entry{mediaFile.filePath(), mediaFile.displayName(),
+                                               mediaFile.duration() / 1000});
         }
     }
     
+    return entries;
+}
+
+bool Playlist::importEntries(const QString& filePath)
+{
     QList<MediaFile> newItems;
-    QFileInfo playlistInfo(filePath);
-    
-    for (auto it = files.begin(); it != files.end(); ++it) {
-        int index = it.key();
-        QString mediaPath = it.value();
-        
-        // Convert relative paths to absolute
-        if (QFileInfo(mediaPath).isRelative()) {
-            mediaPath = playlistInfo.absoluteDir().absoluteFilePath(mediaPath);
-        }
-        
-        if (MediaFile::isSupportedFile(mediaPath)) {
-            MediaFile file(mediaPath);
-            if (titles.contains(index)) {
-                file.setTitle(titles[index]);
+    PlaylistFile::read(filePath, [&newItems](const QList<PlaylistFile::Entry>& entries) {
+        for (const PlaylistFile::Entry& entry : entries) {
+            MediaFile file(entry.filePath);
+            if (!entry.title.isEmpty()) {
+                file.setTitle(entry.title);
+            }
+            if (entry.duration > 0) {
+                file.setDuration(entry.duration * 1000);
             }
             newItems.append(file);
         }
-    }
+        return true;
+    });
     
     if (!newItems.isEmpty()) {
         addItems(newItems);
@@ -876,22 +1013,13 @@ void Playlist::updateModifiedDate()
 
 void Playlist::generateShuffleOrder()
 {
-    m_shuffleOrder.clear();
-    
-    if (m_items.isEmpty()) {
-        return;
-    }
-    
-    // Create sequential order
-    for (int i = 0; i < m_items.size(); ++i) {
-        m_shuffleOrder.append(i);
-    }
-    
-    // Shuffle the order
-    for (int i = m_shuffleOrder.size() - 1; i > 0; --i) {
-        int j = QRandomGenerator::global()->bounded(i + 1);
-        m_shuffleOrder.swapItemsAt(i, j);
-    }
+    m_shuffleOrder.shuffle(m_items, m_shuffleWeighting);
+}
+
+int Playlist::upcomingShufflePosition() const
+{
+    const int currentPosition = m_shuffleOrder.positionOf(m_currentIndex);
+    return currentPosition == -1 ? 0 : currentPosition + 1;
 }
 
 int Playlist::getShuffledIndex(int logicalIndex) const
@@ -900,13 +1028,7 @@ int Playlist::getShuffledIndex(int logicalIndex) const
         return logicalIndex;
     }
     
-    for (int i = 0; i < m_shuffleOrder.size(); ++i) {
-        if (m_shuffleOrder[i] == logicalIndex) {
-            return i;
-        }
-    }
-    
-    return logicalIndex;
+    return m_shuffleOrder.positionOf(logicalIndex);
 }
 
 int Playlist::getLogicalIndex(int shuffledIndex) const
@@ -915,7 +1037,48 @@ int Playlist::getLogicalIndex(int shuffledIndex) const
         return shuffledIndex;
     }
     
-    return m_shuffleOrder[shuffledIndex];
+    return m_shuffleOrder.logicalAt(shuffledIndex);
+}
+
+void Playlist::ensureIndex() const
+{
+    if (m_indexValid) {
+        return;
+    }
+    
+    m_pathIndex.clear();
+    m_idIndex.clear();
+    m_itemKeys.clear();
+    m_pathIndex.reserve(m_items.size());
+    m_itemKeys.reserve(m_items.size());
+    
+    m_indexValid = true;
+    for (int i = 0; i < m_items.size(); ++i) {
+        indexItem(i);
+    }
+}
+
+void Playlist::indexItem(int index) const
+{
+    // Items are indexed in order, so the first index of a path wins
+    const MediaFile& file = m_items[index];
+    m_pathIndex.insert(file.filePath(), m_pathIndex.value(file.filePath(), index));
+    if (file.id() > 0) {
+        m_idIndex.insert(file.id(), m_idIndex.value(file.id(), index));
+    }
+    
+    m_itemKeys.append(makeItemKeys(file));
+}
+
+Playlist::ItemKeys Playlist::makeItemKeys(const MediaFile& file)
+{
+    ItemKeys keys;
+    keys.search = QStringList{file.title(), file.artist(), file.album(), file.fileName()}
+                      .join(QLatin1Char('\n')).toLower();
+    keys.artist = file.artist().toCaseFolded();
+    keys.album = file.album().toCaseFolded();
+    keys.genre = file.genre().toCaseFolded();
+    return keys;
 }
 
 void Playlist::copyFrom(const Playlist& other)
@@ -926,9 +1089,12 @@ void Playlist::copyFrom(const Playlist& other)
     m_createdDate = other.m_createdDate;
     m_modifiedDate = other.m_modifiedDate;
     m_items = other.m_items;
+    m_indexValid = false;
     m_currentIndex = other.m_currentIndex;
+    m_savedItems = other.m_savedItems;
     m_shuffled = other.m_shuffled;
     m_repeatMode = other.m_repeatMode;
+    m_shuffleWeighting = other.m_shuffleWeighting;
     m_shuffleOrder = other.m_shuffleOrder;
     m_cachedTotalDuration = other.m_cachedTotalDuration;
     m_cachedTotalSize = other.m_cachedTotalSize;
@@ -0,0 +1,256 @@
+#include "data/PlaylistFile.h"
+#include "data/MediaFile.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMap>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QThreadPool>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(playlistFile, "eonplay.data.playlistfile")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+// Buffered output is written in blocks of this size
+const int WRITE_BLOCK_BYTES = 256 * 1024;
+
+// Existence checks are mostly waiting on the disk or the network share
+const int EXISTENCE_CHECK_THREADS = 8;
+const int EXISTENCE_CHECK_CHUNK = 256;
+
+QString resolvePath(const QString& path, const QDir& playlistDir)
+{
+    const QString mediaPath = QDir::fromNativeSeparators(path.trimmed());
+    return QDir::isRelativePath(mediaPath) ? playlistDir.absoluteFilePath(mediaPath) : mediaPath;
+}
+
+bool readM3U(QTextStream& stream, const QDir& playlistDir, const PlaylistFile::BatchHandler& handler, int batchSize)
+{
+    QList<PlaylistFile::Entry> batch;
+    batch.reserve(batchSize);
+
+    PlaylistFile::Entry pending;
+    QString line;
+    while (stream.readLineInto(&line)) {
+        line = line.trimmed();
+
+        if (line.startsWith("#EXTINF:")) {
+            // #EXTINF:<seconds>,<title>
+            const int commaPos = line.indexOf(',');
+            if (commaPos != -1) {
+                bool ok = false;
+                const qint64 duration = line.mid(8, commaPos - 8).trimmed().toLongLong(&ok);
+                pending.duration = ok ? duration : -1;
+                pending.title = line.mid(commaPos + 1).trimmed();
+            }
+        } else if (!line.isEmpty() && !line.startsWith("#")) {
+            pending.filePath = resolvePath(line, playlistDir);
+            if (MediaFile::isSupportedFile(pending.filePath)) {
+                batch.append(pending);
+                if (batch.size() >= batchSize) {
+                    if (!handler(batch)) {
+                        return false;
+                    }
+                    batch.clear();
+                }
+            }
+            pending = PlaylistFile::Entry();
+        }
+    }
+
+    return batch.isEmpty() || handler(batch);
+}
+
+bool readPLS(QTextStream& stream, const QDir& playlistDir, const PlaylistFile::BatchHandler& handler, int batchSize)
+{
+    // Keys are numbered and may come in any order, so the whole file is read first
+    QMap<int, PlaylistFile::Entry> entries;
+    QString line;
+    while (stream.readLineInto(&line)) {
+        line = line.trimmed();
+
+        const int equalsPos = line.indexOf('=');
+        if (equalsPos <= 0) {
+            continue;
+        }
+
+        const QStringView key = QStringView(line).left(equalsPos);
+        const QString value = line.mid(equalsPos + 1);
+        int prefixLength = 0;
+        if (key.startsWith(u"File")) {
+            prefixLength = 4;
+        } else if (key.startsWith(u"Title")) {
+            prefixLength = 5;
+        } else if (key.startsWith(u"Length")) {
+            prefixLength = 6;
+        } else {
+            continue;
+        }
+
+        bool ok = false;
+        const int index = key.mid(prefixLength).toInt(&ok);
+        if (!ok || value.isEmpty()) {
+            continue;
+        }
+
+        PlaylistFile::Entry& entry = entries[index];
+        if (prefixLength == 4) {
+            entry.filePath = resolvePath(value, playlistDir);
+        } else if (prefixLength == 5) {
+            entry.title = value;
+        } else {
+            entry.duration = value.toLongLong(&ok);
+            if (!ok) {
+                entry.duration = -1;
+            }
+        }
+    }
+
+    QList<PlaylistFile::Entry> batch;
+    batch.reserve(batchSize);
+    for (const PlaylistFile::Entry& entry : std::as_const(entries)) {
+        if (entry.filePath.isEmpty() || !MediaFile::isSupportedFile(entry.filePath)) {
+            continue;
+        }
+        batch.append(entry);
+        if (batch.size() >= batchSize) {
+            if (!handler(batch)) {
+                return false;
+            }
+            batch.clear();
+        }
+    }
+
+    return batch.isEmpty() || handler(batch);
+}
+}
+
+PlaylistFile::Format PlaylistFile::formatForPath(const QString& playlistPath)
+{
+    const QString extension = QFileInfo(playlistPath).suffix().toLower();
+    if (extension == "m3u" || extension == "m3u8") {
+        return M3U;
+    }
+    if (extension == "pls") {
+        return PLS;
+    }
+    return UnknownFormat;
+}
+
+bool PlaylistFile::read(const QString& playlistPath, const BatchHandler& handler, int batchSize)
+{
+    const Format format = formatForPath(playlistPath);
+    if (format == UnknownFormat) {
+        return false;
+    }
+
+    QFile file(playlistPath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qCWarning(playlistFile) << "Cannot open playlist:" << playlistPath << file.errorString();
+        return false;
+    }
+
+    QTextStream stream(&file);
+    stream.setEncoding(QStringConverter::Utf8);
+
+    const QDir playlistDir = QFileInfo(playlistPath).absoluteDir();
+    batchSize = std::max(1, batchSize);
+
+    return format == M3U ? readM3U(stream, playlistDir, handler, batchSize)
+                         : readPLS(stream, playlistDir, handler, batchSize);
+}
+
+QList<PlaylistFile::Entry> PlaylistFile::readAll(const QString& playlistPath)
+{
+    QList<Entry> entries;
+    read(playlistPath, [&entries](const QList<Entry>& batch) {
+        entries.append(batch);
+        return true;
+    });
+    return entries;
+}
+
+bool PlaylistFile::write(const QString& playlistPath, Format format, const QList<Entry>& entries)
+{
+    if (format == UnknownFormat) {
+        return false;
+    }
+
+    QSaveFile file(playlistPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(playlistFile) << "Cannot write playlist:" << playlistPath << file.errorString();
+        return false;
+    }
+
+    QByteArray buffer;
+    buffer.reserve(WRITE_BLOCK_BYTES + 4096);
+    bool success = true;
+    auto flush = [&]() {
+        success = success && file.write(buffer) == buffer.size();
+        buffer.clear();
+    };
+
+    if (format == M3U) {
+        buffer += "#EXTM3U\n";
+        for (const Entry& entry : entries) {
+            buffer += "#EXTINF:" + QByteArray::number(entry.duration) + ','
+                      + entry.title.toUtf8() + '\n';
+            buffer += QDir::toNativeSeparators(entry.filePath).toUtf8() + '\n';
+            if (buffer.size() >= WRITE_BLOCK_BYTES) {
+                flush();
+            }
+        }
+    } else {
+        buffer += "[playlist]\n";
+        for (int i = 0; i < entries.size(); ++i) {
+            const Entry& entry = entries[i];
+            const QByteArray number = QByteArray::number(i + 1);
+            buffer += "File" + number + '=' + QDir::toNativeSeparators(entry.filePath).toUtf8() + '\n';
+            buffer += "Title" + number + '=' + entry.title.toUtf8() + '\n';
+            buffer += "Length" + number + '=' + QByteArray::number(entry.duration) + '\n';
+            if (buffer.size() >= WRITE_BLOCK_BYTES) {
+                flush();
+            }
+        }
+        buffer += "NumberOfEntries=" + QByteArray::number(entries.size()) + '\n';
+        buffer += "Version=2\n";
+    }
+
+    flush();
+    return success && file.commit();
+}
+
+QList<bool> PlaylistFile::filesExist(const QStringList& paths)
+{
+    QList<bool> exists(paths.size(), false);
+    if (paths.size() <= EXISTENCE_CHECK_CHUNK) {
+        for (int i = 0; i < paths.size(); ++i) {
+            exists[i] = QFileInfo::exists(paths[i]);
+        }
+        return exists;
+    }
+
+    // Each task fills its own slice of the result
+    bool* results = exists.data();
+    QThreadPool pool;
+    pool.setMaxThreadCount(EXISTENCE_CHECK_THREADS);
+    for (int start = 0; start < paths.size(); start += EXISTENCE_CHECK_CHUNK) {
+        const int end = std::min<int>(start + EXISTENCE_CHECK_CHUNK, paths.size());
+        pool.start([&paths, results, start, end]() {
+            for (int i = start; i < end; ++i) {
+                results[i] = QFileInfo::exists(paths[i]);
+            }
+        });
+    }
+    pool.waitForDone();
+
+    return exists;
+}
+
+} // namespace Data
+} // namespace EonPlay
@@ -1,8 +1,11 @@
 #include "data/PlaylistManager.h"
 #include "data/DatabaseManager.h"
 #include "data/LibraryManager.h"
+#include "data/PlaylistFile.h"
+#include "network/NetworkDiscoveryManager.h"
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QCoreApplication>
 #include <QLoggingCategory>
 #include <QDebug>
 #include <QFileInfo>
@@ -14,19 +17,55 @@
 #include <QTextStream>
 #include <QRegularExpression>
 #include <algorithm>
-#include <random>
+#include <limits>
+#include <utility>
 
 Q_LOGGING_CATEGORY(playlistManager, "eonplay.data.playlist")
 
 namespace EonPlay {
 namespace Data {
 
+namespace {
+// Room for 16 inserts between the same two neighbours before the queue
+// has to be renumbered
+const qint64 QUEUE_KEY_GAP = 1 << 16;
+
+// Renumbered during maintenance once neighbours are this close
+const qint64 QUEUE_COMPACT_GAP = 16;
+
+const int QUEUE_FLUSH_DELAY_MS = 500;
+const int QUEUE_MAX_PENDING_OPERATIONS = 4096;
+
+// Watch progress rows held in memory for lookups
+const int WATCH_PROGRESS_CACHE_LIMIT = 512;
+
+// Library changes are gathered briefly so a scan batch is one pass
+const int SMART_PLAYLIST_UPDATE_DELAY_MS = 250;
+const int SMART_PLAYLIST_ROWS_PER_QUERY = 500;
+
+// Position updates arrive several times a second during playback
+const int PLAYBACK_FLUSH_INTERVAL_MS = 5000;
+
+// Watch progress delta sync
+const QString WATCH_PROGRESS_SYNC_CHANNEL = QStringLiteral("watch_progress");
+const quint32 WATCH_PROGRESS_SYNC_MAGIC = 0x45505750; // "EPWP"
+const quint8 WATCH_PROGRESS_SYNC_VERSION = 1;
+const quint8 WATCH_PROGRESS_SYNC_REQUEST = 1;
+const quint8 WATCH_PROGRESS_SYNC_DELTA = 2;
+const int WATCH_PROGRESS_DELTA_MAX_ROWS = 2000;
+const int WATCH_PROGRESS_SYNC_INTERVAL_MS = 60000;
+}
+
 PlaylistManager::PlaylistManager(DatabaseManager* dbManager, QObject* parent)
     : QObject(parent)
     , m_dbManager(dbManager)
     , m_libraryManager(nullptr)
     , m_deviceId(QUuid::createUuid().toString())
+    , m_queueFlushTimer(new QTimer(this))
+    , m_smartPlaylistTimer(new QTimer(this))
     , m_maintenanceTimer(new QTimer(this))
+    , m_playbackFlushTimer(new QTimer(this))
+    , m_progressSyncTimer(new QTimer(this))
 {
     // Setup maintenance timer (run every hour)
     m_maintenanceTimer->setInterval(3600000); // 1 hour
@@ -34,12 +73,69 @@ PlaylistManager::PlaylistManager(DatabaseManager* dbManager, QObject* parent)
     connect(m_maintenanceTimer, &QTimer::timeout, this, &PlaylistManager::performPeriodicMaintenance);
     m_maintenanceTimer->start();
     
+    // Queue changes are written together once edits pause
+    m_queueFlushTimer->setInterval(QUEUE_FLUSH_DELAY_MS);
+    m_queueFlushTimer->setSingleShot(true);
+    connect(m_queueFlushTimer, &QTimer::timeout, this, &PlaylistManager::flushQueueOperations);
+    
+    // Playback positions and watch progress are written behind
+    m_playbackFlushTimer->setInterval(PLAYBACK_FLUSH_INTERVAL_MS);
+    m_playbackFlushTimer->setSingleShot(true);
+    connect(m_playbackFlushTimer, &QTimer::timeout, this, &PlaylistManager::flushPlaybackWrites);
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                this, &PlaylistManager::flushPlaybackWrites);
+    }
+    
+    // Each device pulls watch progress from the rest of its sync group
+    m_progressSyncTimer->setInterval(WATCH_PROGRESS_SYNC_INTERVAL_MS);
+    connect(m_progressSyncTimer, &QTimer::timeout, this, [this]() {
+        if (m_syncNetwork) {
+            m_syncNetwork->sendSyncPayload(m_syncGroupId, WATCH_PROGRESS_SYNC_CHANNEL,
+                                           createWatchProgressSyncRequest());
+        }
+    });
+    
+    // Smart playlists follow library changes row by row; the database
+    // emits under its lock, so these are queued
+    m_smartPlaylistTimer->setInterval(SMART_PLAYLIST_UPDATE_DELAY_MS);
+    m_smartPlaylistTimer->setSingleShot(true);
+    connect(m_smartPlaylistTimer, &QTimer::timeout, this, &PlaylistManager::applySmartPlaylistChanges);
+    if (m_dbManager) {
+        connect(m_dbManager, &DatabaseManager::mediaFileAdded, this,
+                [this](int id, const QString&) { queueSmartPlaylistChange(id); }, Qt::QueuedConnection);
+        connect(m_dbManager, &DatabaseManager::mediaFileUpdated, this,
+                [this](int id) { queueSmartPlaylistChange(id); }, Qt::QueuedConnection);
+        connect(m_dbManager, &DatabaseManager::mediaFileRemoved, this, [this](int id, const QString&) {
+            m_changedMediaIds.remove(id);
+            m_removedMediaIds.insert(id);
+            m_smartPlaylistTimer->start();
+        }, Qt::QueuedConnection);
+        connect(m_dbManager, &DatabaseManager::mediaFilesUpserted, this, [this](const QStringList& filePaths) {
+            for (const QString& filePath : filePaths) {
+                m_changedMediaPaths.insert(filePath);
+            }
+            m_smartPlaylistTimer->start();
+        }, Qt::QueuedConnection);
+        
+        // Queued files are handles to the cache's snapshots; newer ones replace them in place
+        connect(m_dbManager->mediaFileCache(), &MediaFileCache::mediaFileChanged, this,
+                [this](const MediaFile& file) {
+            for (MediaFile& queued : m_currentQueue) {
+                if (queued.id() == file.id()) {
+                    queued = file;
+                }
+            }
+        });
+    }
+    
     // Create required database tables
     createPlaylistTable();
     createSmartPlaylistTable();
     createPlaybackHistoryTable();
     createWatchProgressTable();
     createQueueTable();
+    loadWatchProgressClocks();
     
     // Load current queue
     loadQueueFromDatabase();
@@ -47,6 +143,12 @@ PlaylistManager::PlaylistManager(DatabaseManager* dbManager, QObject* parent)
     qCInfo(playlistManager) << "PlaylistManager initialized with device ID:" << m_deviceId;
 }
 
+PlaylistManager::~PlaylistManager()
+{
+    flushQueueOperations();
+    flushPlaybackWrites();
+}
+
 // Manual playlist operations
 int PlaylistManager::createPlaylist(const QString& name, const QString& description)
 {
@@ -92,6 +194,8 @@ bool PlaylistManager::deletePlaylist(int playlistId)
         // Remove from smart playlist cache
         m_smartPlaylistCriteria.remove(playlistId);
         m_smartPlaylistLastRefresh.remove(playlistId);
+        m_smartPlaylistMatchers.remove(playlistId);
+        m_smartPlaylistMembers.remove(playlistId);
         
         emit playlistDeleted(playlistId);
         qCInfo(playlistManager) << "Deleted playlist:" << playlistName << "ID:" << playlistId;
@@ -322,11 +426,13 @@ bool PlaylistManager::updateSmartPlaylist(int playlistId, const SmartPlaylistCri
     // Store criteria in cache
     m_smartPlaylistCriteria[playlistId] = criteria;
     
-    // Generate content
-    QList<MediaFile> files = generateSmartPlaylistContent(criteria);
+    // Generate content; from here on it is kept up to date incrementally
+    QVariantList sortValues;
+    QList<MediaFile> files = generateSmartPlaylistContent(criteria, &sortValues);
     
     // Update playlist content
     updateSmartPlaylistContent(playlistId, files);
+    setSmartPlaylistMembers(playlistId, files, sortValues);
     
     m_smartPlaylistLastRefresh[playlistId] = QDateTime::currentDateTime();
     
@@ -336,12 +442,36 @@ bool PlaylistManager::updateSmartPlaylist(int playlistId, const SmartPlaylistCri
 
 void PlaylistManager::refreshSmartPlaylist(int playlistId)
 {
-    if (m_smartPlaylistCriteria.contains(playlistId)) {
-        SmartPlaylistCriteria criteria = m_smartPlaylistCriteria[playlistId];
-        updateSmartPlaylist(playlistId, criteria);
+    if (!m_dbManager || !m_smartPlaylistCriteria.contains(playlistId)) {
+        return;
+    }
+    
+    const SmartPlaylistCriteria criteria = m_smartPlaylistCriteria[playlistId];
+    const QString queryStr = buildSmartPlaylistQuery(criteria);
+    
+    // Only the playlist rewrite runs here; the media query does not block the UI
+    MediaFileCache* cache = m_dbManager->mediaFileCache();
+    m_dbManager->executor()->read([queryStr, criteria, cache](QSqlDatabase& database) {
+        QSqlQuery query(database);
+        query.prepare(queryStr);
+        QVariantList sortValues;
+        QList<MediaFile> files = runSmartPlaylistQuery(query, criteria, cache, &sortValues);
+        return qMakePair(files, sortValues);
+    }).then(this, [this, playlistId, queryStr, criteria](const QPair<QList<MediaFile>, QVariantList>& result) {
+        const QList<MediaFile>& files = result.first;
+        // Skip results for playlists deleted or redefined in the meantime
+        auto current = m_smartPlaylistCriteria.constFind(playlistId);
+        if (current == m_smartPlaylistCriteria.constEnd() || current->value != criteria.value ||
+            buildSmartPlaylistQuery(*current) != queryStr) {
+            return;
+        }
+        
+        updateSmartPlaylistContent(playlistId, files);
+        setSmartPlaylistMembers(playlistId, files, result.second);
+        m_smartPlaylistLastRefresh[playlistId] = QDateTime::currentDateTime();
         
         emit smartPlaylistRefreshed(playlistId, getPlaylist(playlistId).itemCount());
-    }
+    });
 }
 
 void PlaylistManager::refreshAllSmartPlaylists()
@@ -445,6 +575,11 @@ void PlaylistManager::recordPlayback(const QString& filePath, qint64 position, q
         return;
     }
     
+    // A buffered position belongs to the previous entry, not this one
+    if (m_pendingPlaybackPositions.contains(filePath)) {
+        flushPlaybackWrites();
+    }
+    
     QSqlQuery query = m_dbManager->prepareQuery(
         "INSERT INTO playback_history (file_path, played_at, play_position, duration, device_id) "
         "VALUES (?, ?, ?, ?, ?)");
@@ -470,16 +605,11 @@ void PlaylistManager::updatePlaybackPosition(const QString& filePath, qint64 pos
         return;
     }
     
-    // Update the most recent playback entry for this file
-    QSqlQuery query = m_dbManager->prepareQuery(
-        "UPDATE playback_history SET play_position = ? "
-        "WHERE file_path = ? AND device_id = ? "
-        "ORDER BY played_at DESC LIMIT 1");
-    
-    query.addBindValue(position);
-    query.addBindValue(filePath);
-    query.addBindValue(m_deviceId);
-    query.exec();
+    // Only the latest position per file is kept until the next flush
+    m_pendingPlaybackPositions[filePath] = position;
+    if (!m_playbackFlushTimer->isActive()) {
+        m_playbackFlushTimer->start();
+    }
 }
 
 void PlaylistManager::markPlaybackCompleted(const QString& filePath)
@@ -489,15 +619,77 @@ void PlaylistManager::markPlaybackCompleted(const QString& filePath)
     }
     
     QSqlQuery query = m_dbManager->prepareQuery(
-        "UPDATE playback_history SET completed = 1 "
-        "WHERE file_path = ? AND device_id = ? "
-        "ORDER BY played_at DESC LIMIT 1");
+        "UPDATE playback_history SET completed = 1 WHERE id = ("
+        "SELECT id FROM playback_history WHERE file_path = ? AND device_id = ? "
+        "ORDER BY played_at DESC LIMIT 1)");
     
     query.addBindValue(filePath);
     query.addBindValue(m_deviceId);
     query.exec();
 }
 
+void PlaylistManager::flushPlaybackWrites()
+{
+    m_playbackFlushTimer->stop();
+    
+    if (!m_dbManager || (m_pendingPlaybackPositions.isEmpty() && m_pendingWatchProgress.isEmpty())) {
+        return;
+    }
+    
+    const QHash<QString, qint64> positions = std::exchange(m_pendingPlaybackPositions, {});
+    const QHash<QString, WatchProgress> progressList = std::exchange(m_pendingWatchProgress, {});
+    
+    // One transaction per flush; WAL keeps every committed flush across a crash
+    const bool transaction = m_dbManager->beginTransaction();
+    QSqlQuery positionQuery = m_dbManager->prepareQuery(
+        "UPDATE playback_history SET play_position = ? WHERE id = ("
+        "SELECT id FROM playback_history WHERE file_path = ? AND device_id = ? "
+        "ORDER BY played_at DESC LIMIT 1)");
+    QSqlQuery progressQuery = m_dbManager->prepareQuery(
+        "INSERT OR REPLACE INTO watch_progress "
+        "(file_path, position, duration, last_watched, percentage, completed, device_id, clock, change_seq) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    
+    bool success = true;
+    for (auto it = positions.constBegin(); success && it != positions.constEnd(); ++it) {
+        positionQuery.addBindValue(it.value());
+        positionQuery.addBindValue(it.key());
+        positionQuery.addBindValue(m_deviceId);
+        if (!positionQuery.exec()) {
+            qCWarning(playlistManager) << "Failed to save playback position:" << positionQuery.lastError().text();
+            success = false;
+        }
+    }
+    
+    for (auto it = progressList.constBegin(); success && it != progressList.constEnd(); ++it) {
+        const WatchProgress& progress = it.value();
+        progressQuery.addBindValue(progress.filePath);
+        progressQuery.addBindValue(progress.position);
+        progressQuery.addBindValue(progress.duration);
+        progressQuery.addBindValue(progress.lastWatched);
+        progressQuery.addBindValue(progress.percentage);
+        progressQuery.addBindValue(progress.completed);
+        progressQuery.addBindValue(progress.deviceId);
+        progressQuery.addBindValue(progress.clock);
+        progressQuery.addBindValue(++m_progressChangeSeq);
+        if (!progressQuery.exec()) {
+            qCWarning(playlistManager) << "Failed to save watch progress:" << progressQuery.lastError().text();
+            success = false;
+        }
+    }
+    
+    if (transaction) {
+        if (success) {
+            m_dbManager->commitTransaction();
+        } else {
+            m_dbManager->rollbackTransaction();
+        }
+    }
+    
+    qCDebug(playlistManager) << "Flushed" << positions.size() << "playback positions and"
+                             << progressList.size() << "watch progress entries";
+}
+
 QList<PlaylistManager::PlaybackHistoryEntry> PlaylistManager::getPlaybackHistory(int limit)
 {
     QList<PlaybackHistoryEntry> history;
@@ -506,6 +698,8 @@ QList<PlaylistManager::PlaybackHistoryEntry> PlaylistManager::getPlaybackHistory
         return history;
     }
     
+    flushPlaybackWrites();
+    
     QSqlQuery query = m_dbManager->prepareQuery(
         "SELECT * FROM playback_history ORDER BY played_at DESC LIMIT ?");
     query.addBindValue(limit);
@@ -535,6 +729,8 @@ QList<PlaylistManager::PlaybackHistoryEntry> PlaylistManager::getPlaybackHistory
         return history;
     }
     
+    flushPlaybackWrites();
+    
     QSqlQuery query = m_dbManager->prepareQuery(
         "SELECT * FROM playback_history WHERE file_path = ? ORDER BY played_at DESC");
     query.addBindValue(filePath);
@@ -564,6 +760,8 @@ PlaylistManager::PlaybackHistoryEntry PlaylistManager::getLastPlaybackEntry(cons
         return entry;
     }
     
+    flushPlaybackWrites();
+    
     QSqlQuery query = m_dbManager->prepareQuery(
         "SELECT * FROM playback_history WHERE file_path = ? ORDER BY played_at DESC LIMIT 1");
     query.addBindValue(filePath);
@@ -588,6 +786,8 @@ void PlaylistManager::clearPlaybackHistory()
         return;
     }
     
+    m_pendingPlaybackPositions.clear();
+    
     QSqlQuery query = m_dbManager->prepareQuery("DELETE FROM playback_history");
     query.exec();
     
@@ -600,6 +800,8 @@ void PlaylistManager::clearPlaybackHistoryBefore(const QDateTime& date)
         return;
     }
     
+    flushPlaybackWrites();
+    
     QSqlQuery query = m_dbManager->prepareQuery("DELETE FROM playback_history WHERE played_at < ?");
     query.addBindValue(date);
     query.exec();
@@ -617,35 +819,25 @@ void PlaylistManager::saveWatchProgress(const QString& filePath, qint64 position
     double percentage = duration > 0 ? (double)position / duration * 100.0 : 0.0;
     bool completed = percentage >= 90.0; // Consider 90% as completed
     
-    QSqlQuery query = m_dbManager->prepareQuery(
-        "INSERT OR REPLACE INTO watch_progress "
-        "(file_path, position, duration, last_watched, percentage, completed, device_id) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?)");
-    
-    query.addBindValue(filePath);
-    query.addBindValue(position);
-    query.addBindValue(duration);
-    query.addBindValue(QDateTime::currentDateTime());
-    query.addBindValue(percentage);
-    query.addBindValue(completed);
-    query.addBindValue(m_deviceId);
+    WatchProgress progress;
+    progress.filePath = filePath;
+    progress.position = position;
+    progress.duration = duration;
+    progress.lastWatched = QDateTime::currentDateTime();
+    progress.percentage = percentage;
+    progress.completed = completed;
+    progress.deviceId = m_deviceId;
+    progress.clock = ++m_progressClock;
     
-    if (query.exec()) {
-        // Update cache
-        WatchProgress progress;
-        progress.filePath = filePath;
-        progress.position = position;
-        progress.duration = duration;
-        progress.lastWatched = QDateTime::currentDateTime();
-        progress.percentage = percentage;
-        progress.completed = completed;
-        progress.deviceId = m_deviceId;
-        
-        m_watchProgressCache[filePath] = progress;
-        
-        emit watchProgressSaved(filePath, position, percentage);
-        qCDebug(playlistManager) << "Saved watch progress for:" << filePath << "at" << percentage << "%";
+    // The pending row answers reads until it is flushed
+    m_watchProgressCache[filePath] = progress;
+    m_pendingWatchProgress[filePath] = progress;
+    if (!m_playbackFlushTimer->isActive()) {
+        m_playbackFlushTimer->start();
     }
+    
+    emit watchProgressSaved(filePath, position, percentage);
+    qCDebug(playlistManager) << "Saved watch progress for:" << filePath << "at" << percentage << "%";
 }
 
 PlaylistManager::WatchProgress PlaylistManager::getWatchProgress(const QString& filePath)
@@ -656,17 +848,22 @@ PlaylistManager::WatchProgress PlaylistManager::getWatchProgress(const QString&
         return progress;
     }
     
-    // Check cache first
-    if (m_watchProgressCache.contains(filePath)) {
-        return m_watchProgressCache[filePath];
+    // Buffered writes first, then rows read before
+    const auto pending = m_pendingWatchProgress.constFind(filePath);
+    if (pending != m_pendingWatchProgress.constEnd()) {
+        return pending.value();
+    }
+    const auto cached = m_watchProgressCache.constFind(filePath);
+    if (cached != m_watchProgressCache.constEnd()) {
+        return cached.value();
     }
     
     if (!m_dbManager) {
         return progress;
     }
     
-    QSqlQuery query = m_dbManager->prepareQuery(
-        "SELECT * FROM watch_progress WHERE file_path = ? ORDER BY last_watched DESC LIMIT 1");
+    // One primary-key search
+    QSqlQuery query = m_dbManager->prepareQuery("SELECT * FROM watch_progress WHERE file_path = ?");
     query.addBindValue(filePath);
     query.exec();
     
@@ -678,14 +875,62 @@ PlaylistManager::WatchProgress PlaylistManager::getWatchProgress(const QString&
         progress.percentage = query.value("percentage").toDouble();
         progress.completed = query.value("completed").toBool();
         progress.deviceId = query.value("device_id").toString();
+        progress.clock = query.value("clock").toLongLong();
         
-        // Cache the result
+        // Cache the result; the cache starts over rather than growing with the library
+        if (m_watchProgressCache.size() >= WATCH_PROGRESS_CACHE_LIMIT) {
+            m_watchProgressCache.clear();
+        }
         m_watchProgressCache[filePath] = progress;
     }
     
     return progress;
 }
 
+qint64 PlaylistManager::resumePosition(const QString& filePath)
+{
+    const WatchProgress progress = getWatchProgress(filePath);
+    return progress.completed ? 0 : progress.position;
+}
+
+void PlaylistManager::saveResumePosition(const QString& filePath, qint64 position, qint64 duration)
+{
+    saveWatchProgress(filePath, position, duration);
+}
+
+void PlaylistManager::clearResumePosition(const QString& filePath)
+{
+    const WatchProgress progress = getWatchProgress(filePath);
+    if (progress.filePath.isEmpty() || progress.completed) {
+        return;
+    }
+    
+    // Finished rather than forgotten, so other devices see it too
+    if (progress.duration > 0) {
+        saveWatchProgress(filePath, progress.duration, progress.duration);
+    } else {
+        clearWatchProgress(filePath);
+    }
+}
+
+void PlaylistManager::pruneWatchProgress()
+{
+    if (!m_dbManager) {
+        return;
+    }
+    
+    flushPlaybackWrites();
+    
+    QSqlQuery query = m_dbManager->prepareQuery(
+        "DELETE FROM watch_progress WHERE file_path IN ("
+        "SELECT file_path FROM watch_progress ORDER BY last_watched DESC LIMIT -1 OFFSET ?)");
+    query.addBindValue(MAX_WATCH_PROGRESS_ENTRIES);
+    if (query.exec() && query.numRowsAffected() > 0) {
+        m_watchProgressCache.clear();
+        qCInfo(playlistManager) << "Pruned" << query.numRowsAffected() << "old watch progress entries";
+    }
+}
+
 QList<PlaylistManager::WatchProgress> PlaylistManager::getAllWatchProgress()
 {
     QList<WatchProgress> progressList;
@@ -694,6 +939,8 @@ QList<PlaylistManager::WatchProgress> PlaylistManager::getAllWatchProgress()
         return progressList;
     }
     
+    flushPlaybackWrites();
+    
     QSqlQuery query = m_dbManager->prepareQuery(
         "SELECT * FROM watch_progress ORDER BY last_watched DESC");
     query.exec();
@@ -707,6 +954,7 @@ QList<PlaylistManager::WatchProgress> PlaylistManager::getAllWatchProgress()
         progress.percentage = query.value("percentage").toDouble();
         progress.completed = query.value("completed").toBool();
         progress.deviceId = query.value("device_id").toString();
+        progress.clock = query.value("clock").toLongLong();
         
         progressList.append(progress);
     }
@@ -720,6 +968,8 @@ void PlaylistManager::clearWatchProgress(const QString& filePath)
         return;
     }
     
+    m_pendingWatchProgress.remove(filePath);
+    
     QSqlQuery query = m_dbManager->prepareQuery("DELETE FROM watch_progress WHERE file_path = ?");
     query.addBindValue(filePath);
     query.exec();
@@ -736,6 +986,8 @@ void PlaylistManager::clearCompletedWatchProgress()
         return;
     }
     
+    flushPlaybackWrites();
+    
     QSqlQuery query = m_dbManager->prepareQuery("DELETE FROM watch_progress WHERE completed = 1");
     query.exec();
     
@@ -759,6 +1011,8 @@ void PlaylistManager::clearOldWatchProgress(int days)
     
     QDateTime cutoffDate = QDateTime::currentDateTime().addDays(-days);
     
+    flushPlaybackWrites();
+    
     QSqlQuery query = m_dbManager->prepareQuery("DELETE FROM watch_progress WHERE last_watched < ?");
     query.addBindValue(cutoffDate);
     query.exec();
@@ -803,6 +1057,8 @@ QList<PlaylistManager::WatchProgress> PlaylistManager::getWatchProgressForSync(c
         return progressList;
     }
     
+    flushPlaybackWrites();
+    
     QString queryStr = "SELECT * FROM watch_progress WHERE device_id = ?";
     if (since.isValid()) {
         queryStr += " AND last_watched > ?";
@@ -825,6 +1081,7 @@ QList<PlaylistManager::WatchProgress> PlaylistManager::getWatchProgressForSync(c
         progress.percentage = query.value("percentage").toDouble();
         progress.completed = query.value("completed").toBool();
         progress.deviceId = query.value("device_id").toString();
+        progress.clock = query.value("clock").toLongLong();
         
         progressList.append(progress);
     }
@@ -832,25 +1089,329 @@ QList<PlaylistManager::WatchProgress> PlaylistManager::getWatchProgressForSync(c
     return progressList;
 }
 
+QByteArray PlaylistManager::createWatchProgressSyncRequest()
+{
+    QByteArray request;
+    if (!m_dbManager) {
+        return request;
+    }
+    
+    QList<QPair<QString, qint64>> watermarks;
+    QSqlQuery query = m_dbManager->prepareQuery("SELECT peer_device_id, last_seq FROM sync_watermarks");
+    if (query.exec()) {
+        while (query.next()) {
+            watermarks.append(qMakePair(query.value(0).toString(), query.value(1).toLongLong()));
+        }
+    }
+    
+    QDataStream out(&request, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << WATCH_PROGRESS_SYNC_MAGIC << WATCH_PROGRESS_SYNC_VERSION << WATCH_PROGRESS_SYNC_REQUEST;
+    out << m_deviceId << quint32(watermarks.size());
+    for (const auto& watermark : watermarks) {
+        out << watermark.first << watermark.second;
+    }
+    
+    return request;
+}
+
+QByteArray PlaylistManager::handleWatchProgressSyncMessage(const QByteArray& message)
+{
+    QDataStream in(message);
+    in.setVersion(QDataStream::Qt_6_0);
+    
+    quint32 magic = 0;
+    quint8 version = 0;
+    quint8 type = 0;
+    in >> magic >> version >> type;
+    if (in.status() != QDataStream::Ok || magic != WATCH_PROGRESS_SYNC_MAGIC ||
+        version != WATCH_PROGRESS_SYNC_VERSION) {
+        qCWarning(playlistManager) << "Ignoring malformed watch progress sync message";
+        return QByteArray();
+    }
+    
+    if (type == WATCH_PROGRESS_SYNC_REQUEST) {
+        QString requesterId;
+        quint32 count = 0;
+        in >> requesterId >> count;
+        
+        // Only the watermark the requester holds for this device matters
+        qint64 sinceSeq = 0;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            QString peerId;
+            qint64 lastSeq = 0;
+            in >> peerId >> lastSeq;
+            if (peerId == m_deviceId) {
+                sinceSeq = lastSeq;
+            }
+        }
+        if (in.status() != QDataStream::Ok || requesterId.isEmpty() || requesterId == m_deviceId) {
+            return QByteArray();
+        }
+        
+        return createWatchProgressDelta(requesterId, sinceSeq);
+    }
+    
+    if (type == WATCH_PROGRESS_SYNC_DELTA) {
+        // A truncated delta is followed up straight away
+        bool more = false;
+        if (applyWatchProgressDelta(in, &more) >= 0 && more) {
+            return createWatchProgressSyncRequest();
+        }
+    }
+    
+    return QByteArray();
+}
+
+QByteArray PlaylistManager::createWatchProgressDelta(const QString& requesterId, qint64 sinceSeq)
+{
+    if (!m_dbManager) {
+        return QByteArray();
+    }
+    
+    flushPlaybackWrites();
+    
+    QSqlQuery query = m_dbManager->prepareQuery(
+        "SELECT file_path, position, duration, last_watched, completed, device_id, clock, change_seq "
+        "FROM watch_progress WHERE change_seq > ? ORDER BY change_seq LIMIT ?");
+    query.addBindValue(sinceSeq);
+    query.addBindValue(WATCH_PROGRESS_DELTA_MAX_ROWS + 1);
+    if (!query.exec()) {
+        qCWarning(playlistManager) << "Failed to read watch progress changes:" << query.lastError().text();
+        return QByteArray();
+    }
+    
+    // Device ids are written once and referenced by index
+    QList<WatchProgress> rows;
+    QStringList devices;
+    QHash<QString, quint16> deviceIndex;
+    qint64 lastSeq = sinceSeq;
+    int scanned = 0;
+    bool more = false;
+    while (query.next()) {
+        if (scanned++ == WATCH_PROGRESS_DELTA_MAX_ROWS) {
+            more = true;
+            break;
+        }
+        lastSeq = query.value(7).toLongLong();
+        
+        // The requester already has the rows it wrote last
+        WatchProgress progress;
+        progress.deviceId = query.value(5).toString();
+        if (progress.deviceId == requesterId) {
+            continue;
+        }
+        progress.filePath = query.value(0).toString();
+        progress.position = query.value(1).toLongLong();
+        progress.duration = query.value(2).toLongLong();
+        progress.lastWatched = query.value(3).toDateTime();
+        progress.completed = query.value(4).toBool();
+        progress.clock = query.value(6).toLongLong();
+        
+        if (!deviceIndex.contains(progress.deviceId)) {
+            deviceIndex.insert(progress.deviceId, quint16(devices.size()));
+            devices.append(progress.deviceId);
+        }
+        rows.append(progress);
+    }
+    
+    if (lastSeq == sinceSeq) {
+        return QByteArray();
+    }
+    
+    QByteArray delta;
+    QDataStream out(&delta, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << WATCH_PROGRESS_SYNC_MAGIC << WATCH_PROGRESS_SYNC_VERSION << WATCH_PROGRESS_SYNC_DELTA;
+    out << m_deviceId << lastSeq << more;
+    out << quint16(devices.size());
+    for (const QString& device : std::as_const(devices)) {
+        out << device;
+    }
+    out << quint32(rows.size());
+    for (const WatchProgress& progress : std::as_const(rows)) {
+        out << progress.filePath << deviceIndex.value(progress.deviceId) << progress.clock
+            << progress.position << progress.duration << progress.lastWatched.toMSecsSinceEpoch()
+            << progress.completed;
+    }
+    
+    return delta;
+}
+
+int PlaylistManager::applyWatchProgressDelta(QDataStream& in, bool* more)
+{
+    QString senderId;
+    qint64 lastSeq = 0;
+    quint16 deviceCount = 0;
+    in >> senderId >> lastSeq >> *more >> deviceCount;
+    
+    QStringList devices;
+    for (quint16 i = 0; i < deviceCount && in.status() == QDataStream::Ok; ++i) {
+        QString device;
+        in >> device;
+        devices.append(device);
+    }
+    
+    quint32 rowCount = 0;
+    in >> rowCount;
+    QList<WatchProgress> rows;
+    for (quint32 i = 0; i < rowCount && in.status() == QDataStream::Ok; ++i) {
+        WatchProgress progress;
+        quint16 device = 0;
+        qint64 lastWatched = 0;
+        in >> progress.filePath >> device >> progress.clock >> progress.position >> progress.duration
+           >> lastWatched >> progress.completed;
+        progress.deviceId = devices.value(device);
+        progress.lastWatched = QDateTime::fromMSecsSinceEpoch(lastWatched);
+        progress.percentage = progress.duration > 0 ? (double)progress.position / progress.duration * 100.0 : 0.0;
+        rows.append(progress);
+    }
+    
+    // A clock far ahead of ours would win every comparison for good and overflow our own
+    const bool clocksValid = std::all_of(rows.cbegin(), rows.cend(), [this](const WatchProgress& progress) {
+        return progress.clock >= 0 && progress.clock - qMax<qint64>(m_progressClock, 0) <= MAX_PROGRESS_CLOCK_AHEAD;
+    });
+    
+    if (in.status() != QDataStream::Ok || senderId.isEmpty() || senderId == m_deviceId || !clocksValid ||
+        !m_dbManager) {
+        qCWarning(playlistManager) << "Ignoring malformed watch progress delta";
+        return -1;
+    }
+    
+    // Local rows must be in the table to be compared
+    flushPlaybackWrites();
+    
+    const bool transaction = m_dbManager->beginTransaction();
+    QSqlQuery clockQuery = m_dbManager->prepareQuery(
+        "SELECT clock, device_id FROM watch_progress WHERE file_path = ?");
+    QSqlQuery writeQuery = m_dbManager->prepareQuery(
+        "INSERT OR REPLACE INTO watch_progress "
+        "(file_path, position, duration, last_watched, percentage, completed, device_id, clock, change_seq) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    
+    int applied = 0;
+    bool success = true;
+    for (const WatchProgress& progress : std::as_const(rows)) {
+        m_progressClock = qMax(m_progressClock, progress.clock);
+        
+        // Last writer wins by logical clock, ties broken by device id
+        clockQuery.addBindValue(progress.filePath);
+        if (clockQuery.exec() && clockQuery.next()) {
+            const qint64 localClock = clockQuery.value(0).toLongLong();
+            const QString localDevice = clockQuery.value(1).toString();
+            if (localClock > progress.clock || (localClock == progress.clock && localDevice >= progress.deviceId)) {
+                continue;
+            }
+        }
+        
+        writeQuery.addBindValue(progress.filePath);
+        writeQuery.addBindValue(progress.position);
+        writeQuery.addBindValue(progress.duration);
+        writeQuery.addBindValue(progress.lastWatched);
+        writeQuery.addBindValue(progress.percentage);
+        writeQuery.addBindValue(progress.completed);
+        writeQuery.addBindValue(progress.deviceId);
+        writeQuery.addBindValue(progress.clock);
+        writeQuery.addBindValue(++m_progressChangeSeq);
+        if (!writeQuery.exec()) {
+            qCWarning(playlistManager) << "Failed to merge watch progress:" << writeQuery.lastError().text();
+            success = false;
+            break;
+        }
+        
+        m_watchProgressCache[progress.filePath] = progress;
+        ++applied;
+    }
+    
+    if (success) {
+        QSqlQuery watermarkQuery = m_dbManager->prepareQuery(
+            "INSERT INTO sync_watermarks (peer_device_id, last_seq) VALUES (?, ?) "
+            "ON CONFLICT(peer_device_id) DO UPDATE SET last_seq = MAX(last_seq, excluded.last_seq)");
+        watermarkQuery.addBindValue(senderId);
+        watermarkQuery.addBindValue(lastSeq);
+        success = watermarkQuery.exec();
+    }
+    
+    if (transaction) {
+        if (success) {
+            m_dbManager->commitTransaction();
+        } else {
+            m_dbManager->rollbackTransaction();
+        }
+    }
+    
+    if (!success) {
+        // The cache may hold rows that were rolled back
+        m_watchProgressCache.clear();
+        return -1;
+    }
+    
+    qCInfo(playlistManager) << "Merged" << applied << "of" << rows.size() << "watch progress changes from" << senderId;
+    return applied;
+}
+
+void PlaylistManager::attachSyncGroup(NetworkDiscoveryManager* network, const QString& groupId)
+{
+    if (m_syncNetwork) {
+        disconnect(m_syncNetwork, nullptr, this, nullptr);
+    }
+    m_progressSyncTimer->stop();
+    
+    m_syncNetwork = network;
+    m_syncGroupId = groupId;
+    if (!network || groupId.isEmpty()) {
+        return;
+    }
+    
+    connect(network, &NetworkDiscoveryManager::syncPayloadReceived, this,
+            [this](const QString& group, const QString& channel, const QString& senderDeviceId,
+                   const QByteArray& payload) {
+        if (group != m_syncGroupId || channel != WATCH_PROGRESS_SYNC_CHANNEL) {
+            return;
+        }
+        const QByteArray reply = handleWatchProgressSyncMessage(payload);
+        if (!reply.isEmpty() && m_syncNetwork) {
+            m_syncNetwork->sendSyncPayload(group, channel, reply, senderDeviceId);
+        }
+    });
+    
+    m_progressSyncTimer->start();
+    
+    network->sendSyncPayload(groupId, WATCH_PROGRESS_SYNC_CHANNEL, createWatchProgressSyncRequest());
+}
+
+void PlaylistManager::loadWatchProgressClocks()
+{
+    if (!m_dbManager) {
+        return;
+    }
+    
+    QSqlQuery query = m_dbManager->prepareQuery("SELECT MAX(clock), MAX(change_seq) FROM watch_progress");
+    if (query.exec() && query.next()) {
+        m_progressClock = query.value(0).toLongLong();
+        m_progressChangeSeq = query.value(1).toLongLong();
+    }
+}
+
 // Queue management
 void PlaylistManager::setCurrentQueue(const QList<MediaFile>& files)
 {
     m_currentQueue = files;
-    saveQueueToDatabase();
+    rewriteQueue();
     emit queueUpdated(files.size());
 }
 
 void PlaylistManager::addToQueue(const MediaFile& file)
 {
-    m_currentQueue.append(file);
-    saveQueueToDatabase();
+    insertIntoQueue(m_currentQueue.size(), file);
     emit queueUpdated(m_currentQueue.size());
 }
 
 void PlaylistManager::addToQueue(const QList<MediaFile>& files)
 {
-    m_currentQueue.append(files);
-    saveQueueToDatabase();
+    for (const MediaFile& file : files) {
+        insertIntoQueue(m_currentQueue.size(), file);
+    }
     emit queueUpdated(m_currentQueue.size());
 }
 
@@ -858,27 +1419,60 @@ void PlaylistManager::removeFromQueue(int position)
 {
     if (position >= 0 && position < m_currentQueue.size()) {
         m_currentQueue.removeAt(position);
-        saveQueueToDatabase();
+        recordQueueOperation({QueueOperation::Remove, m_queueKeys.takeAt(position), 0, QString()});
         emit queueUpdated(m_currentQueue.size());
     }
 }
 
+void PlaylistManager::moveInQueue(int fromPosition, int toPosition)
+{
+    if (fromPosition < 0 || fromPosition >= m_currentQueue.size() ||
+        toPosition < 0 || toPosition >= m_currentQueue.size() || fromPosition == toPosition) {
+        return;
+    }
+    
+    const MediaFile file = m_currentQueue.takeAt(fromPosition);
+    const qint64 oldKey = m_queueKeys.takeAt(fromPosition);
+    
+    // A renumbering rewrites the queue without the moved item, which then
+    // has to be inserted rather than moved
+    bool rewritten = false;
+    const qint64 key = queueKeyBefore(toPosition, &rewritten);
+    
+    m_currentQueue.insert(toPosition, file);
+    m_queueKeys.insert(toPosition, key);
+    if (rewritten) {
+        recordQueueOperation({QueueOperation::Insert, key, 0, file.filePath()});
+    } else {
+        recordQueueOperation({QueueOperation::Move, key, oldKey, QString()});
+    }
+    
+    emit queueUpdated(m_currentQueue.size());
+}
+
 void PlaylistManager::clearQueue()
 {
     m_currentQueue.clear();
-    saveQueueToDatabase();
+    m_queueKeys.clear();
+    recordQueueOperation({QueueOperation::Clear, 0, 0, QString()});
     emit queueCleared();
     emit queueUpdated(0);
 }
 
-void PlaylistManager::shuffleQueue()
+void PlaylistManager::shuffleQueue(ShuffleOrder::Weighting weighting)
 {
     if (m_currentQueue.size() > 1) {
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::shuffle(m_currentQueue.begin(), m_currentQueue.end(), g);
+        // Same order as a playlist's shuffle, weighted the same way
+        ShuffleOrder order;
+        order.shuffle(m_currentQueue, weighting);
+        QList<MediaFile> shuffled;
+        shuffled.reserve(m_currentQueue.size());
+        for (int index : order.order()) {
+            shuffled.append(m_currentQueue[index]);
+        }
+        m_currentQueue = shuffled;
         
-        saveQueueToDatabase();
+        rewriteQueue();
         emit queueUpdated(m_currentQueue.size());
     }
 }
@@ -963,9 +1557,7 @@ QList<MediaFile> PlaylistManager::getMostPlayedFiles(int limit)
     query.addBindValue(limit);
     query.exec();
     
-    while (query.next()) {
-        files.append(createMediaFileFromQuery(query));
-    }
+    files = m_dbManager->mediaFileCache()->fromQuery(query);
     
     return files;
 }
@@ -978,16 +1570,15 @@ QList<MediaFile> PlaylistManager::getRecentlyPlayedFiles(int limit)
         return files;
     }
     
+    // Recording a playback stamps last_played, so its index gives the files
+    // newest first without deduplicating the whole history
     QSqlQuery query = m_dbManager->prepareQuery(
-        "SELECT DISTINCT mf.* FROM media_files mf "
-        "JOIN playback_history ph ON mf.file_path = ph.file_path "
-        "ORDER BY ph.played_at DESC LIMIT ?");
+        "SELECT * FROM media_files WHERE last_played IS NOT NULL "
+        "ORDER BY last_played DESC LIMIT ?");
     query.addBindValue(limit);
     query.exec();
     
-    while (query.next()) {
-        files.append(createMediaFileFromQuery(query));
-    }
+    files = m_dbManager->mediaFileCache()->fromQuery(query);
     
     return files;
 }
@@ -1011,6 +1602,10 @@ bool PlaylistManager::exportPlaylist(int playlistId, const QString& filePath, co
 
 int PlaylistManager::importPlaylist(const QString& filePath, const QString& name)
 {
+    if (!m_dbManager || PlaylistFile::formatForPath(filePath) == PlaylistFile::UnknownFormat) {
+        return -1;
+    }
+    
     QString playlistName = name;
     if (playlistName.isEmpty()) {
         QFileInfo fileInfo(filePath);
@@ -1021,29 +1616,85 @@ int PlaylistManager::importPlaylist(const QString& filePath, const QString& name
     playlistName = generateUniquePlaylistName(playlistName);
     
     int playlistId = createPlaylist(playlistName);
-    if (playlistId > 0) {
-        Playlist playlist = getPlaylist(playlistId);
+    if (playlistId <= 0) {
+        return -1;
+    }
+    
+    // Entries are resolved against the library a batch at a time; only
+    // paths the library does not know are checked on disk, and the ones
+    // that exist are added to it in a single transaction
+    QStringList entryPaths;
+    QHash<QString, int> mediaIds;
+    QSet<QString> addedPaths;
+    const bool bulk = m_dbManager->beginBulkUpsert(std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
+    
+    const bool read = PlaylistFile::read(filePath, [&](const QList<PlaylistFile::Entry>& entries) {
+        QStringList paths;
+        paths.reserve(entries.size());
+        for (const PlaylistFile::Entry& entry : entries) {
+            paths.append(entry.filePath);
+        }
+        mediaIds.insert(m_dbManager->getMediaFileIdsByPath(paths));
         
-        QFileInfo fileInfo(filePath);
-        QString extension = fileInfo.suffix().toLower();
+        QList<const PlaylistFile::Entry*> unknown;
+        QStringList unknownPaths;
+        QSet<QString> seen;
+        for (const PlaylistFile::Entry& entry : entries) {
+            if (!mediaIds.contains(entry.filePath) && !addedPaths.contains(entry.filePath) &&
+                !seen.contains(entry.filePath)) {
+                seen.insert(entry.filePath);
+                unknown.append(&entry);
+                unknownPaths.append(entry.filePath);
+            }
+        }
         
-        bool success = false;
-        if (extension == "m3u") {
-            success = playlist.importFromM3U(filePath);
-        } else if (extension == "pls") {
-            success = playlist.importFromPLS(filePath);
+        const QList<bool> exists = PlaylistFile::filesExist(unknownPaths);
+        for (int i = 0; i < unknown.size(); ++i) {
+            if (!exists[i] || !bulk) {
+                continue;
+            }
+            DatabaseManager::MediaFileRow row;
+            row.filePath = unknown[i]->filePath;
+            row.title = unknown[i]->title;
+            row.duration = unknown[i]->duration > 0 ? unknown[i]->duration * 1000 : 0;
+            if (m_dbManager->bulkUpsertMediaFile(row)) {
+                addedPaths.insert(row.filePath);
+            }
         }
         
-        if (success) {
-            playlist.save(m_dbManager);
-            emit playlistUpdated(playlistId);
-            return playlistId;
-        } else {
-            deletePlaylist(playlistId);
+        entryPaths.append(paths);
+        return true;
+    });
+    
+    if (bulk) {
+        m_dbManager->endBulkUpsert();
+    }
+    if (!addedPaths.isEmpty()) {
+        mediaIds.insert(m_dbManager->getMediaFileIdsByPath(addedPaths.values()));
+    }
+    
+    // Every item is inserted in one transaction with evenly spread sort keys
+    QList<DatabaseManager::PlaylistItemRow> rows;
+    rows.reserve(entryPaths.size());
+    for (const QString& entryPath : std::as_const(entryPaths)) {
+        auto id = mediaIds.constFind(entryPath);
+        if (id != mediaIds.constEnd()) {
+            DatabaseManager::PlaylistItemRow row;
+            row.mediaFileId = id.value();
+            row.position = (rows.size() + 1) * DatabaseManager::PLAYLIST_POSITION_GAP;
+            rows.append(row);
         }
     }
     
-    return -1;
+    if (!read || rows.isEmpty() || !m_dbManager->updatePlaylistItems(playlistId, {}, rows)) {
+        deletePlaylist(playlistId);
+        return -1;
+    }
+    
+    qCInfo(playlistManager) << "Imported" << rows.size() << "of" << entryPaths.size() << "entries from"
+                            << filePath << "," << addedPaths.size() << "added to the library";
+    emit playlistUpdated(playlistId);
+    return playlistId;
 }
 
 bool PlaylistManager::exportAllPlaylists(const QString& directory)
@@ -1148,7 +1799,13 @@ bool PlaylistManager::createPlaybackHistoryTable()
         )
     )";
     
-    return m_dbManager->executeQuery(query);
+    // Finds the latest entry of a file on this device without a scan, and
+    // the history newest first without a sort
+    return m_dbManager->executeQuery(query) &&
+           m_dbManager->executeQuery("CREATE INDEX IF NOT EXISTS idx_playback_history_file_device "
+                                     "ON playback_history(file_path, device_id, played_at)") &&
+           m_dbManager->executeQuery("CREATE INDEX IF NOT EXISTS idx_playback_history_played_at "
+                                     "ON playback_history(played_at)");
 }
 
 bool PlaylistManager::createWatchProgressTable()
@@ -1157,19 +1814,77 @@ bool PlaylistManager::createWatchProgressTable()
         return false;
     }
     
-    QString query = R"(
-        CREATE TABLE IF NOT EXISTS watch_progress (
-            file_path TEXT PRIMARY KEY,
+    // Rows live in the primary key's b-tree, so a lookup by path is one search
+    const QString schema = R"(
+        CREATE TABLE IF NOT EXISTS %1 (
+            file_path TEXT PRIMARY KEY NOT NULL,
             position INTEGER DEFAULT 0,
             duration INTEGER DEFAULT 0,
             last_watched DATETIME DEFAULT CURRENT_TIMESTAMP,
             percentage REAL DEFAULT 0.0,
             completed BOOLEAN DEFAULT 0,
-            device_id TEXT
-        )
+            device_id TEXT,
+            clock INTEGER DEFAULT 0,
+            change_seq INTEGER DEFAULT 0
+        ) WITHOUT ROWID
     )";
     
-    return m_dbManager->executeQuery(query);
+    if (!m_dbManager->executeQuery(schema.arg("watch_progress"))) {
+        return false;
+    }
+    
+    // Tables from before delta sync lack the clock columns
+    QSqlQuery columnQuery = m_dbManager->prepareQuery("PRAGMA table_info(watch_progress)");
+    QStringList columns;
+    if (columnQuery.exec()) {
+        while (columnQuery.next()) {
+            columns.append(columnQuery.value("name").toString());
+        }
+    }
+    if (!columns.contains("clock")) {
+        m_dbManager->executeQuery("ALTER TABLE watch_progress ADD COLUMN clock INTEGER DEFAULT 0");
+    }
+    if (!columns.contains("change_seq")) {
+        m_dbManager->executeQuery("ALTER TABLE watch_progress ADD COLUMN change_seq INTEGER DEFAULT 0");
+    }
+    
+    // Tables from before the compact layout are copied over once
+    QSqlQuery layoutQuery = m_dbManager->prepareQuery(
+        "SELECT sql FROM sqlite_master WHERE type = 'table' AND name = 'watch_progress'");
+    if (layoutQuery.exec() && layoutQuery.next() &&
+        !layoutQuery.value(0).toString().contains("WITHOUT ROWID", Qt::CaseInsensitive)) {
+        const bool transaction = m_dbManager->beginTransaction();
+        const bool migrated =
+            m_dbManager->executeQuery(schema.arg("watch_progress_compact")) &&
+            m_dbManager->executeQuery(
+                "INSERT OR REPLACE INTO watch_progress_compact "
+                "(file_path, position, duration, last_watched, percentage, completed, device_id, clock, change_seq) "
+                "SELECT file_path, position, duration, last_watched, percentage, completed, device_id, clock, "
+                "change_seq FROM watch_progress WHERE file_path IS NOT NULL") &&
+            m_dbManager->executeQuery("DROP TABLE watch_progress") &&
+            m_dbManager->executeQuery("ALTER TABLE watch_progress_compact RENAME TO watch_progress");
+        if (transaction) {
+            if (migrated) {
+                m_dbManager->commitTransaction();
+            } else {
+                m_dbManager->rollbackTransaction();
+            }
+        }
+        qCInfo(playlistManager) << (migrated ? "Moved watch progress to the compact layout"
+                                             : "Failed to move watch progress to the compact layout");
+    }
+    
+    // Highest sequence number received from each peer; last_watched serves retention
+    return m_dbManager->executeQuery("CREATE INDEX IF NOT EXISTS idx_watch_progress_change_seq "
+                                     "ON watch_progress(change_seq)") &&
+           m_dbManager->executeQuery("CREATE INDEX IF NOT EXISTS idx_watch_progress_last_watched "
+                                     "ON watch_progress(last_watched)") &&
+           m_dbManager->executeQuery(R"(
+        CREATE TABLE IF NOT EXISTS sync_watermarks (
+            peer_device_id TEXT PRIMARY KEY,
+            last_seq INTEGER NOT NULL DEFAULT 0
+        )
+    )");
 }
 
 bool PlaylistManager::createQueueTable()
@@ -1178,37 +1893,84 @@ bool PlaylistManager::createQueueTable()
         return false;
     }
     
+    // Rows are ordered by sparse keys, so an item can be placed between
+    // two others without renumbering the rest
     QString query = R"(
-        CREATE TABLE IF NOT EXISTS current_queue (
-            position INTEGER PRIMARY KEY,
+        CREATE TABLE IF NOT EXISTS queue_items (
+            sort_key INTEGER PRIMARY KEY,
             file_path TEXT NOT NULL,
             added_at DATETIME DEFAULT CURRENT_TIMESTAMP
         )
     )";
     
-    return m_dbManager->executeQuery(query);
+    if (!m_dbManager->executeQuery(query)) {
+        return false;
+    }
+    
+    // Carry over the densely numbered queue of earlier versions
+    if (m_dbManager->tableExists("current_queue")) {
+        const bool transaction = m_dbManager->beginTransaction();
+        const bool migrated = m_dbManager->executeQuery(
+            "INSERT OR REPLACE INTO queue_items (sort_key, file_path, added_at) "
+            "SELECT (position + 1) * ?, file_path, added_at FROM current_queue",
+            QVariantList() << QUEUE_KEY_GAP) &&
+            m_dbManager->executeQuery("DROP TABLE current_queue");
+        
+        if (transaction) {
+            if (migrated) {
+                m_dbManager->commitTransaction();
+            } else {
+                m_dbManager->rollbackTransaction();
+            }
+        }
+        
+        if (!migrated) {
+            qCWarning(playlistManager) << "Failed to migrate the play queue";
+        }
+    }
+    
+    return true;
 }
 
 void PlaylistManager::performPeriodicMaintenance()
 {
     cleanupOrphanedEntries();
-    refreshAllSmartPlaylists();
+    
+    // Smart playlists need no refresh here; they follow library changes
+    
+    // Spread the queue's keys out again once repeated moves into the same
+    // spot have used up the room between neighbours
+    for (int i = 1; i < m_queueKeys.size(); ++i) {
+        if (m_queueKeys[i] - m_queueKeys[i - 1] < QUEUE_COMPACT_GAP) {
+            rewriteQueue();
+            break;
+        }
+    }
+    flushQueueOperations();
+    pruneWatchProgress();
     
     qCDebug(playlistManager) << "Performed periodic maintenance";
 }
 
 // Smart playlist helpers
-QList<MediaFile> PlaylistManager::generateSmartPlaylistContent(const SmartPlaylistCriteria& criteria)
+QList<MediaFile> PlaylistManager::generateSmartPlaylistContent(const SmartPlaylistCriteria& criteria,
+                                                              QVariantList* sortValues)
 {
-    QList<MediaFile> files;
-    
     if (!m_dbManager) {
-        return files;
+        return QList<MediaFile>();
     }
     
     QString queryStr = buildSmartPlaylistQuery(criteria);
     QSqlQuery query = m_dbManager->prepareQuery(queryStr);
     
+    return runSmartPlaylistQuery(query, criteria, m_dbManager->mediaFileCache(), sortValues);
+}
+
+QList<MediaFile> PlaylistManager::runSmartPlaylistQuery(QSqlQuery& query, const SmartPlaylistCriteria& criteria,
+                                                        MediaFileCache* cache, QVariantList* sortValues)
+{
+    QList<MediaFile> files;
+    
     // Add parameters based on criteria
     if (criteria.type == ByGenre || criteria.type == ByArtist || criteria.type == ByAlbum) {
         query.addBindValue(criteria.value);
@@ -1224,9 +1986,14 @@ QList<MediaFile> PlaylistManager::generateSmartPlaylistContent(const SmartPlayli
     
     query.exec();
     
-    while (query.next()) {
-        files.append(createMediaFileFromQuery(query));
+    const QString sortField = criteria.sortBy.isEmpty() ? QStringLiteral("id") : criteria.sortBy;
+    MediaFileCache::RowHandler collectSortValue;
+    if (sortValues) {
+        collectSortValue = [sortValues, &sortField](const QSqlQuery& row, const MediaFile&) {
+            sortValues->append(row.value(sortField));
+        };
     }
+    files = cache->fromQuery(query, QStringLiteral("id"), collectSortValue);
     
     return files;
 }
@@ -1323,6 +2090,303 @@ void PlaylistManager::updateSmartPlaylistContent(int playlistId, const QList<Med
     addToPlaylist(playlistId, files);
 }
 
+PlaylistManager::SmartPlaylistMatcher PlaylistManager::compileSmartPlaylistCriteria(const SmartPlaylistCriteria& criteria)
+{
+    SmartPlaylistMatcher matcher;
+    matcher.sortField = criteria.sortBy.isEmpty() ? QStringLiteral("id") : criteria.sortBy;
+    matcher.descending = !criteria.sortBy.isEmpty() && criteria.sortOrder == Qt::DescendingOrder;
+    matcher.limit = criteria.limit;
+    
+    // Each case mirrors its clause in buildSmartPlaylistQuery()
+    const QDateTime dateFrom = criteria.dateFrom;
+    const QString value = criteria.value;
+    const QString field = criteria.field;
+    
+    switch (criteria.type) {
+        case RecentlyAdded:
+            matcher.matches = [dateFrom](const QSqlRecord& record) {
+                return !dateFrom.isValid() || record.value("date_added").toDateTime() >= dateFrom;
+            };
+            break;
+            
+        case MostPlayed:
+            matcher.matches = [](const QSqlRecord& record) {
+                return record.value("play_count").toInt() > 0;
+            };
+            break;
+            
+        case RecentlyPlayed:
+            matcher.matches = [dateFrom](const QSqlRecord& record) {
+                const QVariant lastPlayed = record.value("last_played");
+                return !lastPlayed.isNull() && (!dateFrom.isValid() || lastPlayed.toDateTime() >= dateFrom);
+            };
+            break;
+            
+        case NeverPlayed:
+            matcher.matches = [](const QSqlRecord& record) {
+                return record.value("play_count").toInt() == 0;
+            };
+            break;
+            
+        case ByGenre:
+        case ByArtist:
+        case ByAlbum: {
+            const QString column = criteria.type == ByGenre ? "genre" : criteria.type == ByArtist ? "artist" : "album";
+            matcher.matches = [column, value](const QSqlRecord& record) {
+                return record.value(column).toString() == value;
+            };
+            break;
+        }
+            
+        case ByYear:
+            matcher.matches = [year = value.toInt()](const QSqlRecord& record) {
+                return record.value("year").toInt() == year;
+            };
+            break;
+            
+        case ByRating:
+            matcher.matches = [rating = value.toInt()](const QSqlRecord& record) {
+                return record.contains("rating") && record.value("rating").toInt() >= rating;
+            };
+            break;
+            
+        case Custom:
+            if (field.isEmpty() || value.isEmpty()) {
+                break;
+            }
+            if (criteria.operator_ == "equals") {
+                matcher.matches = [field, value](const QSqlRecord& record) {
+                    return record.value(field).toString() == value;
+                };
+            } else if (criteria.operator_ == "contains") {
+                // LIKE ignores ASCII case
+                matcher.matches = [field, value](const QSqlRecord& record) {
+                    return record.value(field).toString().contains(value, Qt::CaseInsensitive);
+                };
+            } else if (criteria.operator_ == "greater_than") {
+                matcher.matches = [field, bound = value.toDouble()](const QSqlRecord& record) {
+                    return !record.value(field).isNull() && record.value(field).toDouble() > bound;
+                };
+            } else if (criteria.operator_ == "less_than") {
+                matcher.matches = [field, bound = value.toDouble()](const QSqlRecord& record) {
+                    return !record.value(field).isNull() && record.value(field).toDouble() < bound;
+                };
+            }
+            break;
+    }
+    
+    if (!matcher.matches) {
+        matcher.matches = [](const QSqlRecord&) { return true; };
+    }
+    
+    return matcher;
+}
+
+int PlaylistManager::compareSortValues(const QVariant& a, const QVariant& b)
+{
+    // SQLite orders NULL first, then numbers, then text
+    if (a.isNull() || b.isNull()) {
+        return int(!a.isNull()) - int(!b.isNull());
+    }
+    
+    bool aNumeric = false;
+    bool bNumeric = false;
+    const double aNumber = a.toDouble(&aNumeric);
+    const double bNumber = b.toDouble(&bNumeric);
+    if (aNumeric && bNumeric) {
+        return aNumber < bNumber ? -1 : (aNumber > bNumber ? 1 : 0);
+    }
+    if (aNumeric != bNumeric) {
+        return aNumeric ? -1 : 1;
+    }
+    
+    return a.toString().compare(b.toString());
+}
+
+void PlaylistManager::setSmartPlaylistMembers(int playlistId, const QList<MediaFile>& files,
+                                              const QVariantList& sortValues)
+{
+    QList<SmartPlaylistMember> members;
+    members.reserve(files.size());
+    for (int i = 0; i < files.size(); ++i) {
+        members.append(SmartPlaylistMember{files[i].id(), sortValues.value(i)});
+    }
+    m_smartPlaylistMembers[playlistId] = members;
+    m_smartPlaylistMatchers[playlistId] = compileSmartPlaylistCriteria(m_smartPlaylistCriteria.value(playlistId));
+}
+
+void PlaylistManager::queueSmartPlaylistChange(int mediaFileId)
+{
+    if (m_smartPlaylistMembers.isEmpty()) {
+        return;
+    }
+    
+    m_removedMediaIds.remove(mediaFileId);
+    m_changedMediaIds.insert(mediaFileId);
+    m_smartPlaylistTimer->start();
+}
+
+void PlaylistManager::applySmartPlaylistChanges()
+{
+    const QSet<int> removedIds = std::exchange(m_removedMediaIds, {});
+    const QList<int> changedIds = std::exchange(m_changedMediaIds, {}).values();
+    const QStringList changedPaths = std::exchange(m_changedMediaPaths, {}).values();
+    
+    if (!m_dbManager || m_smartPlaylistMembers.isEmpty()) {
+        return;
+    }
+    
+    QSet<int> updatedPlaylists;
+    QSet<int> stalePlaylists;
+    const QList<int> playlistIds = m_smartPlaylistMembers.keys();
+    
+    for (int mediaFileId : removedIds) {
+        for (int playlistId : playlistIds) {
+            const int sizeBefore = m_smartPlaylistMembers[playlistId].size();
+            if (removeSmartPlaylistMember(playlistId, mediaFileId)) {
+                updatedPlaylists.insert(playlistId);
+                
+                // A full playlist may have a row outside it that now belongs in
+                if (sizeBefore == m_smartPlaylistMatchers[playlistId].limit) {
+                    stalePlaylists.insert(playlistId);
+                }
+            }
+        }
+    }
+    
+    // Changed rows are read back in chunks and tested against each playlist
+    auto applyRows = [&](const QString& column, const QVariantList& keys) {
+        for (int offset = 0; offset < keys.size(); offset += SMART_PLAYLIST_ROWS_PER_QUERY) {
+            const QVariantList chunk = keys.mid(offset, SMART_PLAYLIST_ROWS_PER_QUERY);
+            QStringList placeholders;
+            placeholders.fill(QStringLiteral("?"), chunk.size());
+            
+            QSqlQuery query = m_dbManager->prepareQuery(
+                QString("SELECT * FROM media_files WHERE %1 IN (%2)").arg(column, placeholders.join(',')));
+            for (const QVariant& key : chunk) {
+                query.addBindValue(key);
+            }
+            if (!query.exec()) {
+                qCWarning(playlistManager) << "Failed to read changed files:" << query.lastError().text();
+                continue;
+            }
+            
+            while (query.next()) {
+                const QSqlRecord record = query.record();
+                for (int playlistId : playlistIds) {
+                    if (!applySmartPlaylistRow(playlistId, record)) {
+                        stalePlaylists.insert(playlistId);
+                    }
+                    updatedPlaylists.insert(playlistId);
+                }
+            }
+        }
+    };
+    
+    QVariantList idKeys;
+    for (int id : changedIds) {
+        idKeys.append(id);
+    }
+    QVariantList pathKeys;
+    for (const QString& path : changedPaths) {
+        pathKeys.append(path);
+    }
+    applyRows("id", idKeys);
+    applyRows("file_path", pathKeys);
+    
+    // Only a query can tell which row moves up into a freed slot
+    for (int playlistId : std::as_const(stalePlaylists)) {
+        refreshSmartPlaylist(playlistId);
+    }
+    
+    for (int playlistId : std::as_const(updatedPlaylists)) {
+        if (!stalePlaylists.contains(playlistId)) {
+            emit playlistUpdated(playlistId);
+        }
+    }
+}
+
+bool PlaylistManager::applySmartPlaylistRow(int playlistId, const QSqlRecord& record)
+{
+    QList<SmartPlaylistMember>& members = m_smartPlaylistMembers[playlistId];
+    const SmartPlaylistMatcher& matcher = m_smartPlaylistMatchers[playlistId];
+    
+    const int mediaFileId = record.value("id").toInt();
+    const bool matches = matcher.matches(record);
+    const QVariant sortValue = record.value(matcher.sortField);
+    const bool full = matcher.limit > 0 && members.size() >= matcher.limit;
+    
+    int current = -1;
+    for (int i = 0; i < members.size(); ++i) {
+        if (members[i].mediaFileId == mediaFileId) {
+            current = i;
+            break;
+        }
+    }
+    
+    if (current >= 0 && !matches) {
+        removeSmartPlaylistMember(playlistId, mediaFileId);
+        return !full;
+    }
+    if (current >= 0 && compareSortValues(members[current].sortValue, sortValue) == 0) {
+        return true;
+    }
+    if (current < 0 && !matches) {
+        return true;
+    }
+    
+    // Position after every member that sorts before or equal to the row
+    auto before = [&matcher, &sortValue](const SmartPlaylistMember& member) {
+        const int order = compareSortValues(member.sortValue, sortValue);
+        return matcher.descending ? order >= 0 : order <= 0;
+    };
+    
+    if (current >= 0) {
+        members.removeAt(current);
+        int target = 0;
+        while (target < members.size() && before(members[target])) {
+            ++target;
+        }
+        members.insert(target, SmartPlaylistMember{mediaFileId, sortValue});
+        if (target != current) {
+            m_dbManager->movePlaylistItem(playlistId, current, target);
+        }
+        
+        // A row that sank to the end of a full playlist may now rank below
+        // one that is not in it
+        return !(full && target == members.size() - 1 && target > current);
+    }
+    
+    int target = 0;
+    while (target < members.size() && before(members[target])) {
+        ++target;
+    }
+    if (matcher.limit > 0 && target >= matcher.limit) {
+        return true;
+    }
+    
+    members.insert(target, SmartPlaylistMember{mediaFileId, sortValue});
+    m_dbManager->addToPlaylist(playlistId, mediaFileId, target);
+    
+    if (matcher.limit > 0 && members.size() > matcher.limit) {
+        removeSmartPlaylistMember(playlistId, members.last().mediaFileId);
+    }
+    return true;
+}
+
+bool PlaylistManager::removeSmartPlaylistMember(int playlistId, int mediaFileId)
+{
+    QList<SmartPlaylistMember>& members = m_smartPlaylistMembers[playlistId];
+    for (int i = 0; i < members.size(); ++i) {
+        if (members[i].mediaFileId == mediaFileId) {
+            members.removeAt(i);
+            m_dbManager->removeFromPlaylist(playlistId, mediaFileId);
+            return true;
+        }
+    }
+    return false;
+}
+
 // History helpers
 void PlaylistManager::cleanupOldHistory()
 {
@@ -1343,27 +2407,156 @@ void PlaylistManager::updatePlayCount(const QString& filePath)
         int fileId = fileQuery.value("id").toInt();
         m_dbManager->updatePlayCount(fileId);
         m_dbManager->updateLastPlayed(fileId);
+        m_dbManager->mediaFileCache()->update(fileId, [](MediaFile& file) {
+            file.incrementPlayCount();
+            file.setLastPlayed(QDateTime::currentDateTime());
+        });
+        
+        // Play counts do not go through the library's change signals
+        queueSmartPlaylistChange(fileId);
     }
 }
 
 // Queue helpers
-void PlaylistManager::saveQueueToDatabase()
+qint64 PlaylistManager::queueKeyBefore(int position, bool* rewritten)
 {
-    if (!m_dbManager) {
-        return;
+    if (m_queueKeys.isEmpty()) {
+        return QUEUE_KEY_GAP;
+    }
+    if (position >= m_queueKeys.size()) {
+        return m_queueKeys.last() + QUEUE_KEY_GAP;
+    }
+    if (position <= 0) {
+        return m_queueKeys.first() - QUEUE_KEY_GAP;
     }
     
-    // Clear existing queue
-    QSqlQuery clearQuery = m_dbManager->prepareQuery("DELETE FROM current_queue");
-    clearQuery.exec();
+    if (m_queueKeys[position] - m_queueKeys[position - 1] < 2) {
+        rewriteQueue();
+        if (rewritten) {
+            *rewritten = true;
+        }
+    }
+    
+    const qint64 before = m_queueKeys[position - 1];
+    return before + (m_queueKeys[position] - before) / 2;
+}
+
+void PlaylistManager::insertIntoQueue(int position, const MediaFile& file)
+{
+    const qint64 key = queueKeyBefore(position);
+    m_currentQueue.insert(position, file);
+    m_queueKeys.insert(position, key);
+    recordQueueOperation({QueueOperation::Insert, key, 0, file.filePath()});
+}
+
+void PlaylistManager::rewriteQueue()
+{
+    recordQueueOperation({QueueOperation::Clear, 0, 0, QString()});
     
-    // Save current queue
+    m_queueKeys.clear();
+    m_queueKeys.reserve(m_currentQueue.size());
     for (int i = 0; i < m_currentQueue.size(); ++i) {
-        QSqlQuery insertQuery = m_dbManager->prepareQuery(
-            "INSERT INTO current_queue (position, file_path) VALUES (?, ?)");
-        insertQuery.addBindValue(i);
-        insertQuery.addBindValue(m_currentQueue[i].filePath());
-        insertQuery.exec();
+        const qint64 key = (i + 1) * QUEUE_KEY_GAP;
+        m_queueKeys.append(key);
+        recordQueueOperation({QueueOperation::Insert, key, 0, m_currentQueue[i].filePath()});
+    }
+}
+
+void PlaylistManager::recordQueueOperation(const QueueOperation& operation)
+{
+    QueueOperation recorded = operation;
+    bool superseded = false;
+    
+    if (operation.type == QueueOperation::Clear) {
+        // Nothing written before a clear matters any more
+        m_pendingQueueOperations.clear();
+    } else if (operation.type == QueueOperation::Remove) {
+        // Removing a row that is still only pending undoes its last change;
+        // keys are unique among live rows, so the latest operation on this
+        // key is the one that created or moved the row
+        for (int i = m_pendingQueueOperations.size() - 1; i >= 0; --i) {
+            const QueueOperation& pending = m_pendingQueueOperations[i];
+            if (pending.type == QueueOperation::Clear) {
+                break;
+            }
+            if (pending.key != operation.key || pending.type == QueueOperation::Remove) {
+                continue;
+            }
+            
+            if (pending.type == QueueOperation::Insert) {
+                superseded = true;
+            } else {
+                recorded.key = pending.oldKey;
+            }
+            m_pendingQueueOperations.removeAt(i);
+            break;
+        }
+    }
+    
+    if (!superseded) {
+        m_pendingQueueOperations.append(recorded);
+    }
+    
+    if (m_pendingQueueOperations.size() >= QUEUE_MAX_PENDING_OPERATIONS) {
+        flushQueueOperations();
+    } else {
+        m_queueFlushTimer->start();
+    }
+}
+
+void PlaylistManager::flushQueueOperations()
+{
+    m_queueFlushTimer->stop();
+    
+    if (!m_dbManager || m_pendingQueueOperations.isEmpty()) {
+        return;
+    }
+    
+    const QList<QueueOperation> operations = std::exchange(m_pendingQueueOperations, {});
+    
+    const bool transaction = m_dbManager->beginTransaction();
+    QSqlQuery insertQuery = m_dbManager->prepareQuery(
+        "INSERT OR REPLACE INTO queue_items (sort_key, file_path) VALUES (?, ?)");
+    QSqlQuery removeQuery = m_dbManager->prepareQuery("DELETE FROM queue_items WHERE sort_key = ?");
+    QSqlQuery moveQuery = m_dbManager->prepareQuery("UPDATE queue_items SET sort_key = ? WHERE sort_key = ?");
+    QSqlQuery clearQuery = m_dbManager->prepareQuery("DELETE FROM queue_items");
+    
+    bool success = true;
+    for (const QueueOperation& operation : operations) {
+        QSqlQuery* query = nullptr;
+        switch (operation.type) {
+            case QueueOperation::Insert:
+                query = &insertQuery;
+                query->addBindValue(operation.key);
+                query->addBindValue(operation.filePath);
+                break;
+            case QueueOperation::Remove:
+                query = &removeQuery;
+                query->addBindValue(operation.key);
+                break;
+            case QueueOperation::Move:
+                query = &moveQuery;
+                query->addBindValue(operation.key);
+                query->addBindValue(operation.oldKey);
+                break;
+            case QueueOperation::Clear:
+                query = &clearQuery;
+                break;
+        }
+        
+        if (!query->exec()) {
+            qCWarning(playlistManager) << "Failed to save queue change:" << query->lastError().text();
+            success = false;
+            break;
+        }
+    }
+    
+    if (transaction) {
+        if (success) {
+            m_dbManager->commitTransaction();
+        } else {
+            m_dbManager->rollbackTransaction();
+        }
     }
 }
 
@@ -1375,51 +2568,22 @@ void PlaylistManager::loadQueueFromDatabase()
     
     m_currentQueue.clear();
     
+    m_queueKeys.clear();
+    
     QSqlQuery query = m_dbManager->prepareQuery(
-        "SELECT cq.file_path, mf.* FROM current_queue cq "
-        "LEFT JOIN media_files mf ON cq.file_path = mf.file_path "
-        "ORDER BY cq.position");
+        "SELECT qi.sort_key, qi.file_path, mf.* FROM queue_items qi "
+        "LEFT JOIN media_files mf ON qi.file_path = mf.file_path "
+        "ORDER BY qi.sort_key");
     query.exec();
     
-    while (query.next()) {
-        MediaFile file;
-        file.setFilePath(query.value("file_path").toString());
-        
-        // Set additional metadata if available
-        if (!query.value("title").isNull()) {
-            file.setId(query.value("id").toInt());
-            file.setTitle(query.value("title").toString());
-            file.setArtist(query.value("artist").toString());
-            file.setAlbum(query.value("album").toString());
-            file.setDuration(query.value("duration").toLongLong());
-        }
-        
-        m_currentQueue.append(file);
-    }
+    // Files no longer in the library come back with only their path
+    m_currentQueue = m_dbManager->mediaFileCache()->fromQuery(query, QStringLiteral("id"),
+        [this](const QSqlQuery& row, const MediaFile&) {
+            m_queueKeys.append(row.value(0).toLongLong());
+        });
 }
 
 // Utility methods
-MediaFile PlaylistManager::createMediaFileFromQuery(const QSqlQuery& query)
-{
-    MediaFile file;
-    file.setId(query.value("id").toInt());
-    file.setFilePath(query.value("file_path").toString());
-    file.setTitle(query.value("title").toString());
-    file.setArtist(query.value("artist").toString());
-    file.setAlbum(query.value("album").toString());
-    file.setGenre(query.value("genre").toString());
-    file.setYear(query.value("year").toInt());
-    file.setTrackNumber(query.value("track_number").toInt());
-    file.setDuration(query.value("duration").toLongLong());
-    file.setFileSize(query.value("file_size").toLongLong());
-    file.setDateAdded(query.value("date_added").toDateTime());
-    file.setLastPlayed(query.value("last_played").toDateTime());
-    file.setPlayCount(query.value("play_count").toInt());
-    file.setRating(query.value("rating").toInt());
-    
-    return file;
-}
-
 QString PlaylistManager::generateUniquePlaylistName(const QString& baseName)
 {
     QString uniqueName = baseName;
@@ -0,0 +1,398 @@
+#include "data/PosterGenerator.h"
+#include "data/CoverArtStore.h"
+#include "data/DatabaseManager.h"
+#include "data/MediaFile.h"
+#include "video/SceneDetector.h"
+#include "ThreadPriority.h"
+#include "CpuTopology.h"
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QMetaObject>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QThread>
+#include <cmath>
+
+Q_LOGGING_CATEGORY(posterGenerator, "eonplay.data.posters")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+constexpr double SAMPLE_RATE = 1.0;             // Analysed frames per second of video
+constexpr double BLACK_LEVEL = 24.0;            // Mean luma below this is a black frame
+constexpr double MIN_DETAIL_STDDEV = 8.0;       // Luma levels; flatter frames are fades and slates
+constexpr qint64 MIN_SCENE_MS = 2000;           // Shorter cuts are flashes
+constexpr qint64 MIN_POSTER_SCENE_MS = 4000;    // Shorter scenes are title cards and inserts
+constexpr qint64 SCENE_EDGE_MS = 1000;          // Frames this close to a cut may be mid-transition
+constexpr int CANDIDATE_SCENES = 8;
+constexpr int START_TIMEOUT_MS = 5000;
+constexpr int READ_POLL_MS = 100;
+constexpr int ANALYSIS_TIMEOUT_MS = 120000;
+constexpr int GRAB_TIMEOUT_MS = 30000;
+
+struct Sample {
+    qint64 time = 0;
+    double mean = 0.0;
+    double stddev = 0.0;
+
+    bool isPicture() const { return mean >= BLACK_LEVEL && stddev >= MIN_DETAIL_STDDEV; }
+};
+
+void measure(const uchar* luma, Sample* sample)
+{
+    quint64 sum = 0;
+    quint64 sumSquares = 0;
+    for (int i = 0; i < SceneDetector::FRAME_SIZE; ++i) {
+        sum += luma[i];
+        sumSquares += quint32(luma[i]) * luma[i];
+    }
+    sample->mean = double(sum) / SceneDetector::FRAME_SIZE;
+    sample->stddev = std::sqrt(qMax(0.0, double(sumSquares) / SceneDetector::FRAME_SIZE - sample->mean * sample->mean));
+}
+
+/**
+ * Output of an FFmpeg run that exits cleanly, empty otherwise
+ */
+QByteArray runFFmpeg(const QString& ffmpegPath, const QStringList& arguments, const std::atomic<bool>& cancelled)
+{
+    QProcess process;
+    ThreadPriority::setBackgroundProcess(&process);
+    process.start(ffmpegPath, arguments);
+    if (!process.waitForStarted(START_TIMEOUT_MS)) {
+        qCWarning(posterGenerator) << "Failed to start FFmpeg:" << process.errorString();
+        return QByteArray();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!process.waitForFinished(READ_POLL_MS)) {
+        if (cancelled || timer.hasExpired(GRAB_TIMEOUT_MS)) {
+            process.kill();
+            process.waitForFinished();
+            return QByteArray();
+        }
+    }
+
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        qCDebug(posterGenerator) << "FFmpeg failed:" << process.readAllStandardError().trimmed();
+        return QByteArray();
+    }
+    return process.readAllStandardOutput();
+}
+} // namespace
+
+PosterGenerator::PosterGenerator(DatabaseManager* dbManager, QObject* parent)
+    : QObject(parent)
+    , m_dbManager(dbManager)
+    , m_ffmpegPath(QStandardPaths::findExecutable("ffmpeg"))
+    , m_pool(new QThreadPool(this))
+    , m_writerTimer(new QTimer(this))
+    , m_previewsEnabled(false)
+    , m_inFlight(0)
+    , m_totalFiles(0)
+    , m_generatedFiles(0)
+    , m_failedFiles(0)
+    , m_cancelled(false)
+{
+    // Each job is an FFmpeg process with its own decoder threads, so half the
+    // cores other background work would get keep them busy
+    const CpuTopology& topology = CpuTopology::instance();
+    const int threads = topology.isHybrid() ? topology.backgroundThreadCount()
+                                            : qMax(1, QThread::idealThreadCount() - 1);
+    m_pool->setMaxThreadCount(qMax(1, threads / 2));
+    m_pool->setThreadPriority(QThread::LowPriority);
+
+    m_writerTimer->setSingleShot(true);
+    m_writerTimer->setInterval(WRITE_INTERVAL_MS);
+    connect(m_writerTimer, &QTimer::timeout, this, &PosterGenerator::writePendingResults);
+}
+
+PosterGenerator::~PosterGenerator()
+{
+    cancel();
+    m_pool->waitForDone();
+}
+
+void PosterGenerator::generatePending()
+{
+    if (!m_dbManager) {
+        return;
+    }
+    if (m_ffmpegPath.isEmpty()) {
+        qCInfo(posterGenerator) << "FFmpeg not found, poster generation disabled";
+        return;
+    }
+
+    const bool wasRunning = isRunning();
+    if (!wasRunning) {
+        m_totalFiles = m_generatedFiles = m_failedFiles = 0;
+    }
+
+    QSqlQuery query = m_dbManager->getPosterCandidates();
+    while (query.next()) {
+        Job job;
+        job.mediaFileId = query.value(0).toInt();
+        job.filePath = query.value(1).toString();
+        if (m_queued.contains(job.mediaFileId) || m_failed.contains(job.mediaFileId)
+            || MediaFile::detectMediaType(job.filePath) != MediaFile::Video) {
+            continue;
+        }
+        job.duration = query.value(2).toLongLong();
+
+        m_queued.insert(job.mediaFileId);
+        m_queue.append(job);
+        ++m_totalFiles;
+    }
+
+    if (!wasRunning && isRunning()) {
+        qCInfo(posterGenerator) << "Generating posters for" << m_totalFiles << "videos";
+        emit postersStarted(m_totalFiles);
+    }
+    startWorkers();
+}
+
+void PosterGenerator::cancel()
+{
+    m_queue.clear();
+    m_queued.clear();
+    writePendingResults();
+
+    // Workers kill their decoder on the flag; it is cleared once they are gone
+    m_cancelled = m_inFlight > 0;
+}
+
+void PosterGenerator::startWorkers()
+{
+    if (m_cancelled) {
+        return;
+    }
+
+    const int limit = m_pool->maxThreadCount() * MAX_IN_FLIGHT_PER_THREAD;
+    const bool withPreview = m_previewsEnabled;
+    while (m_inFlight < limit && !m_queue.isEmpty()) {
+        const Job job = m_queue.takeFirst();
+        m_queued.remove(job.mediaFileId);
+        ++m_inFlight;
+
+        m_pool->start([this, job, withPreview]() {
+            ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Background);
+            Result result;
+            result.job = job;
+            result.coverArtPath = generate(job, withPreview);
+            QMetaObject::invokeMethod(this, [this, result]() {
+                onFileFinished(result);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void PosterGenerator::onFileFinished(const Result& result)
+{
+    --m_inFlight;
+
+    if (m_cancelled) {
+        if (m_inFlight == 0) {
+            m_cancelled = false;
+            emit postersFinished(m_generatedFiles, m_failedFiles);
+            qCInfo(posterGenerator) << "Poster generation cancelled";
+            startWorkers();
+        }
+        return;
+    }
+
+    if (result.coverArtPath.isEmpty()) {
+        m_failed.insert(result.job.mediaFileId);
+        ++m_failedFiles;
+    } else {
+        m_pendingResults.append(result);
+        ++m_generatedFiles;
+    }
+    emit postersProgress(m_generatedFiles + m_failedFiles, m_totalFiles);
+
+    startWorkers();
+
+    if (!isRunning()) {
+        writePendingResults();
+        qCInfo(posterGenerator) << "Poster generation finished. Generated:" << m_generatedFiles
+                                << "Failed:" << m_failedFiles;
+        emit postersFinished(m_generatedFiles, m_failedFiles);
+    } else if (m_pendingResults.size() >= WRITE_BATCH_SIZE) {
+        writePendingResults();
+    } else if (!m_writerTimer->isActive()) {
+        m_writerTimer->start();
+    }
+}
+
+void PosterGenerator::writePendingResults()
+{
+    m_writerTimer->stop();
+    if (m_pendingResults.isEmpty() || !m_dbManager) {
+        return;
+    }
+
+    const bool ownTransaction = !m_dbManager->isBulkUpsertActive() && m_dbManager->beginTransaction();
+    for (const Result& result : std::as_const(m_pendingResults)) {
+        m_dbManager->updateMediaFileCoverArt(result.job.mediaFileId, result.coverArtPath);
+    }
+    if (ownTransaction) {
+        m_dbManager->commitTransaction();
+    }
+
+    m_pendingResults.clear();
+}
+
+qint64 PosterGenerator::findPosterTime(const Job& job) const
+{
+    const qint64 window = job.duration > 0 ? qMin(job.duration, ANALYSIS_WINDOW_MS) : ANALYSIS_WINDOW_MS;
+
+    // Keyframes only, scaled and made grey by FFmpeg: a poster position does
+    // not mind snapping to them, and nothing full-size crosses the pipe
+    const QStringList arguments{
+        "-hide_banner", "-nostats", "-loglevel", "error",
+        "-hwaccel", "auto",
+        "-skip_frame", "nokey", "-skip_loop_filter", "all",
+        "-t", QString::number(window / 1000.0, 'f', 3),
+        "-i", job.filePath,
+        "-an", "-sn", "-dn",
+        "-vf", QString("fps=%1,scale=%2:%3:flags=area,format=gray")
+                   .arg(SAMPLE_RATE).arg(SceneDetector::FRAME_WIDTH).arg(SceneDetector::FRAME_HEIGHT),
+        "-f", "rawvideo", "pipe:1"
+    };
+
+    QProcess process;
+    ThreadPriority::setBackgroundProcess(&process);
+    process.start(m_ffmpegPath, arguments);
+    if (!process.waitForStarted(START_TIMEOUT_MS)) {
+        qCWarning(posterGenerator) << "Failed to start FFmpeg:" << process.errorString();
+        return -1;
+    }
+
+    SceneDetector::Options options;
+    options.sampleRate = SAMPLE_RATE;
+    options.minSceneLength = MIN_SCENE_MS;
+    SceneDetector detector(options);
+
+    QVector<Sample> samples;
+    QVector<qint64> sceneStarts{0};
+    QByteArray buffer;
+    auto consume = [&]() {
+        buffer += process.readAllStandardOutput();
+        int offset = 0;
+        while (buffer.size() - offset >= SceneDetector::FRAME_SIZE) {
+            const uchar* luma = reinterpret_cast<const uchar*>(buffer.constData() + offset);
+            Sample sample;
+            sample.time = qRound64(samples.size() * 1000.0 / SAMPLE_RATE);
+            measure(luma, &sample);
+            samples.append(sample);
+
+            SceneDetector::Cut cut;
+            if (detector.addFrame(luma, sample.time, &cut)) {
+                sceneStarts.append(cut.time);
+            }
+            offset += SceneDetector::FRAME_SIZE;
+        }
+        buffer.remove(0, offset);
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+    while (process.state() != QProcess::NotRunning) {
+        if (m_cancelled || timer.hasExpired(ANALYSIS_TIMEOUT_MS)) {
+            process.kill();
+            process.waitForFinished();
+            return -1;
+        }
+        process.waitForReadyRead(READ_POLL_MS);
+        consume();
+    }
+    consume();
+
+    if (samples.isEmpty()) {
+        qCDebug(posterGenerator) << "Could not decode" << job.filePath << process.readAllStandardError().trimmed();
+        return -1;
+    }
+
+    // The intro is everything before the first frame with a picture
+    int first = 0;
+    while (first < samples.size() && !samples[first].isPicture()) {
+        ++first;
+    }
+    if (first == samples.size()) {
+        return job.duration > window ? job.duration / 10 : samples.last().time / 2;
+    }
+    const qint64 introEnd = samples[first].time;
+    sceneStarts.append(samples.last().time + qint64(1000 / SAMPLE_RATE));
+
+    // Most detailed frame well inside the first scenes after the intro
+    qint64 bestTime = introEnd;
+    double bestDetail = -1.0;
+    int scenes = 0;
+    for (int i = 0; i + 1 < sceneStarts.size() && scenes < CANDIDATE_SCENES; ++i) {
+        const qint64 start = qMax(sceneStarts[i], introEnd);
+        const qint64 end = sceneStarts[i + 1];
+        if (end - start < MIN_POSTER_SCENE_MS) {
+            continue;
+        }
+        ++scenes;
+
+        for (const Sample& sample : std::as_const(samples)) {
+            if (sample.time >= start + SCENE_EDGE_MS && sample.time < end - SCENE_EDGE_MS
+                && sample.isPicture() && sample.stddev > bestDetail) {
+                bestDetail = sample.stddev;
+                bestTime = sample.time;
+            }
+        }
+    }
+
+    qCDebug(posterGenerator) << job.filePath << "intro ends at" << introEnd << "ms, poster at" << bestTime
+                             << "ms from" << samples.size() << "frames and" << sceneStarts.size() - 2 << "cuts";
+    return bestTime;
+}
+
+QString PosterGenerator::generate(const Job& job, bool withPreview) const
+{
+    const qint64 position = findPosterTime(job);
+    if (position < 0 || m_cancelled) {
+        return QString();
+    }
+
+    // Input seeking lands on the keyframe before the position and decodes up to it
+    const QString seek = QString::number(position / 1000.0, 'f', 3);
+    const QStringList arguments{
+        "-hide_banner", "-nostats", "-loglevel", "error",
+        "-hwaccel", "auto",
+        "-ss", seek,
+        "-i", job.filePath,
+        "-an", "-sn", "-dn",
+        "-frames:v", "1",
+        "-vf", QString("scale='min(%1,iw)':-2:flags=bicubic,format=yuvj420p").arg(POSTER_WIDTH),
+        "-c:v", "mjpeg", "-q:v", "3",
+        "-f", "image2pipe", "pipe:1"
+    };
+    const QString coverArtPath = CoverArtStore().store(runFFmpeg(m_ffmpegPath, arguments, m_cancelled));
+    if (coverArtPath.isEmpty() || !withPreview || m_cancelled
+        || !CoverArtStore::previewPath(coverArtPath).isEmpty()) {
+        return coverArtPath;
+    }
+
+    // One palette for the whole clip keeps GIF banding down
+    const QStringList previewArguments{
+        "-hide_banner", "-nostats", "-loglevel", "error",
+        "-hwaccel", "auto",
+        "-ss", seek,
+        "-t", QString::number(PREVIEW_SECONDS),
+        "-i", job.filePath,
+        "-an", "-sn", "-dn",
+        "-vf", QString("fps=%1,scale=%2:-2:flags=area,split[a][b];[a]palettegen=max_colors=128[p];"
+                       "[b][p]paletteuse=dither=bayer").arg(PREVIEW_FPS).arg(PREVIEW_WIDTH),
+        "-loop", "0",
+        "-f", "gif", "pipe:1"
+    };
+    CoverArtStore::storePreview(coverArtPath, runFFmpeg(m_ffmpegPath, previewArguments, m_cancelled));
+    return coverArtPath;
+}
+
+} // namespace Data
+} // namespace EonPlay
@@ -0,0 +1,150 @@
+#include "data/QueryExecutor.h"
+#include "Metrics.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QThread>
+#include <QMutexLocker>
+#include <QLoggingCategory>
+#include <QDebug>
+
+Q_LOGGING_CATEGORY(queryExecutor, "eonplay.data.executor")
+
+namespace EonPlay {
+namespace Data {
+
+QueryExecutor::QueryExecutor(QObject* parent)
+    : QObject(parent)
+    , m_open(false)
+{
+}
+
+QueryExecutor::~QueryExecutor()
+{
+    close();
+}
+
+bool QueryExecutor::open(const QString& databasePath, int readerCount)
+{
+    if (m_open) {
+        return true;
+    }
+
+    m_databasePath = databasePath;
+
+    // Connection names are global, so they carry this instance's address
+    const QString prefix = QString("EonPlayExecutor-%1-").arg(reinterpret_cast<quintptr>(this), 0, 16);
+    startThreads(m_writeLane, 1, prefix + "writer", false);
+    startThreads(m_readLane, qMax(1, readerCount), prefix + "reader", true);
+
+    m_open = true;
+    qCInfo(queryExecutor) << "Query executor started with" << qMax(1, readerCount) << "readers";
+    return true;
+}
+
+void QueryExecutor::close()
+{
+    if (!m_open) {
+        return;
+    }
+
+    m_open = false;
+    stopThreads(m_writeLane);
+    stopThreads(m_readLane);
+
+    qCInfo(queryExecutor) << "Query executor stopped";
+}
+
+bool QueryExecutor::enqueue(Lane& lane, Task task)
+{
+    QMutexLocker locker(&lane.mutex);
+
+    if (lane.stopping) {
+        return false;
+    }
+
+    lane.tasks.enqueue(std::move(task));
+    lane.condition.wakeOne();
+    return true;
+}
+
+void QueryExecutor::startThreads(Lane& lane, int count, const QString& connectionPrefix, bool readOnly)
+{
+    QMutexLocker locker(&lane.mutex);
+    lane.stopping = false;
+
+    for (int i = 0; i < count; ++i) {
+        const QString connectionName = connectionPrefix + QString::number(i);
+        QThread* thread = QThread::create([this, &lane, connectionName, readOnly]() {
+            run(lane, connectionName, readOnly);
+        });
+        thread->setObjectName(connectionName);
+        thread->start();
+        lane.threads << thread;
+    }
+}
+
+void QueryExecutor::stopThreads(Lane& lane)
+{
+    QVector<QThread*> threads;
+    {
+        QMutexLocker locker(&lane.mutex);
+        lane.stopping = true;
+        lane.condition.wakeAll();
+        threads.swap(lane.threads);
+    }
+
+    // Threads drain the queue before they exit
+    for (QThread* thread : threads) {
+        thread->wait();
+        delete thread;
+    }
+}
+
+void QueryExecutor::run(Lane& lane, const QString& connectionName, bool readOnly)
+{
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        database.setDatabaseName(m_databasePath);
+        database.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(BUSY_TIMEOUT_MS));
+
+        if (database.open()) {
+            QSqlQuery pragmaQuery(database);
+            const QString pragma = readOnly ? "PRAGMA query_only = ON" : "PRAGMA foreign_keys = ON";
+            if (!pragmaQuery.exec(pragma)) {
+                qCWarning(queryExecutor) << "Failed to configure" << connectionName << ":"
+                                         << pragmaQuery.lastError().text();
+            }
+        } else {
+            // Work still runs so its futures complete; its queries will fail
+            qCCritical(queryExecutor) << "Failed to open" << connectionName << ":"
+                                      << database.lastError().text();
+        }
+
+        static LatencyHistogram& queryLatency = MetricsRegistry::instance().histogram(
+            "eonplay_db_query_seconds", "Time to run one database task, queue wait excluded");
+
+        for (;;) {
+            Task task;
+            {
+                QMutexLocker locker(&lane.mutex);
+                while (lane.tasks.isEmpty() && !lane.stopping) {
+                    lane.condition.wait(&lane.mutex);
+                }
+                if (lane.tasks.isEmpty()) {
+                    break;
+                }
+                task = lane.tasks.dequeue();
+            }
+
+            LatencyTimer timer(queryLatency);
+            task(database);
+        }
+
+        database.close();
+    }
+
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+} // namespace Data
+} // namespace EonPlay
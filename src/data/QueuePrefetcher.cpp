@@ -0,0 +1,493 @@
+#include "data/QueuePrefetcher.h"
+#include "data/DirectoryWatcher.h"
+#include "data/Playlist.h"
+#include "data/PlaylistManager.h"
+#include "data/ScanFileReader.h"
+#include "ThreadPriority.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMetaObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QStandardPaths>
+#include <QThread>
+#include <QTimer>
+#include <QUrl>
+#include <utility>
+
+Q_LOGGING_CATEGORY(queuePrefetcher, "eonplay.data.prefetch")
+
+namespace EonPlay {
+namespace Data {
+
+QueuePrefetcher::QueuePrefetcher(const QString& directory, QObject* parent)
+    : QObject(parent)
+    , m_directory(directory)
+    , m_refreshTimer(new QTimer(this))
+    , m_pool(new QThreadPool(this))
+    , m_network(nullptr)
+    , m_depth(DEFAULT_DEPTH)
+    , m_prefixBytes(DEFAULT_PREFIX_BYTES)
+    , m_maxBytes(DEFAULT_MAX_BYTES)
+    , m_currentBytes(0)
+    , m_cancelled(false)
+    , m_reply(nullptr)
+    , m_fetchedBytes(0)
+{
+    m_pool->setMaxThreadCount(1);
+    m_pool->setThreadPriority(QThread::LowPriority);
+
+    m_refreshTimer->setSingleShot(true);
+    m_refreshTimer->setInterval(REFRESH_DELAY_MS);
+    connect(m_refreshTimer, &QTimer::timeout, this, &QueuePrefetcher::refresh);
+
+    QDir().mkpath(m_directory);
+    loadIndex();
+}
+
+QueuePrefetcher::~QueuePrefetcher()
+{
+    m_queue.clear();
+    m_cancelled = true;
+    if (m_reply) {
+        m_reply->disconnect(this);
+        m_reply->abort();
+        m_reply->deleteLater();
+        m_fetchFile.remove();
+    }
+    m_pool->waitForDone();
+}
+
+QString QueuePrefetcher::defaultDirectory()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("prefetch");
+}
+
+void QueuePrefetcher::setPlaylist(Playlist* playlist)
+{
+    if (m_playlist) {
+        m_playlist->disconnect(this);
+    }
+
+    m_playlist = playlist;
+    if (playlist) {
+        const auto schedule = [this]() { m_refreshTimer->start(); };
+        connect(playlist, &Playlist::currentIndexChanged, this, schedule);
+        connect(playlist, &Playlist::shuffleChanged, this, schedule);
+        connect(playlist, &Playlist::repeatModeChanged, this, schedule);
+        connect(playlist, &Playlist::playlistModified, this, schedule);
+        connect(playlist, &Playlist::playlistCleared, this, schedule);
+    }
+    m_refreshTimer->start();
+}
+
+void QueuePrefetcher::setPlaylistManager(PlaylistManager* manager)
+{
+    if (m_manager) {
+        m_manager->disconnect(this);
+    }
+
+    m_manager = manager;
+    if (manager) {
+        const auto schedule = [this]() { m_refreshTimer->start(); };
+        connect(manager, &PlaylistManager::queueUpdated, this, schedule);
+        connect(manager, &PlaylistManager::queueCleared, this, schedule);
+    }
+    m_refreshTimer->start();
+}
+
+void QueuePrefetcher::setDepth(int items)
+{
+    m_depth = qMax(0, items);
+    m_refreshTimer->start();
+}
+
+void QueuePrefetcher::setPrefixBytes(qint64 bytes)
+{
+    m_prefixBytes = qMax<qint64>(COPY_BLOCK_BYTES, bytes);
+}
+
+void QueuePrefetcher::setMaxSize(qint64 bytes)
+{
+    m_maxBytes = qMax<qint64>(0, bytes);
+    evict();
+}
+
+void QueuePrefetcher::cancel()
+{
+    m_queue.clear();
+    if (!m_current.isEmpty()) {
+        m_cancelled = true;
+        if (m_reply) {
+            m_reply->abort();
+        }
+    }
+}
+
+void QueuePrefetcher::clear()
+{
+    cancel();
+    m_lastHandedOut.clear();
+    m_pinned.clear();
+    while (!m_order.empty()) {
+        remove(m_order.front());
+    }
+}
+
+PrefetchedCopy QueuePrefetcher::prefetchedCopy(const QString& path)
+{
+    const QString key = keyOf(path);
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        return PrefetchedCopy();
+    }
+
+    // A file changed on the share since it was copied is played from the share
+    if (!isRemote(path)) {
+        const QFileInfo info(path);
+        if (!info.isFile() || info.size() != it->sourceSize ||
+            info.lastModified().toSecsSinceEpoch() != it->sourceModified) {
+            qCDebug(queuePrefetcher) << "Dropping stale copy of" << path;
+            remove(key);
+            return PrefetchedCopy();
+        }
+    }
+
+    const QString localPath = filePath(it->fileName);
+    if (!QFileInfo::exists(localPath)) {
+        // Deleted behind our back
+        remove(key);
+        return PrefetchedCopy();
+    }
+
+    m_order.splice(m_order.end(), m_order, it->position);
+    m_lastHandedOut = key;
+    m_pinned.insert(key);
+
+    PrefetchedCopy copy;
+    copy.localPath = localPath;
+    copy.bytes = it->bytes;
+    copy.sourceSize = it->sourceSize;
+    return copy;
+}
+
+void QueuePrefetcher::refresh()
+{
+    m_refreshTimer->stop();
+
+    const QList<MediaFile> upcoming = upcomingItems();
+
+    m_pinned.clear();
+    if (!m_lastHandedOut.isEmpty()) {
+        m_pinned.insert(m_lastHandedOut);
+    }
+    if (m_playlist) {
+        m_pinned.insert(keyOf(m_playlist->currentItem().filePath()));
+    }
+
+    QList<Job> jobs;
+    QSet<QString> upcomingPaths;
+    qint64 plannedBytes = 0;
+    for (const MediaFile& file : upcoming) {
+        const QString path = file.filePath();
+        const QString key = keyOf(path);
+        m_pinned.insert(key);
+        upcomingPaths.insert(path);
+        if (m_entries.contains(key) || m_skipped.contains(path)) {
+            continue;
+        }
+
+        Job job;
+        job.path = path;
+        job.audio = file.isAudio();
+        job.remote = isRemote(path);
+        if (job.remote && !job.audio) {
+            // Only whole copies of URLs can be played from
+            continue;
+        }
+
+        // Copies of the first items must not evict each other
+        plannedBytes += job.audio && file.fileSize() > 0 ? qMin(file.fileSize(), MAX_WHOLE_BYTES) : m_prefixBytes;
+        if (plannedBytes > m_maxBytes) {
+            break;
+        }
+        jobs.append(job);
+    }
+    m_queue = jobs;
+
+    if (!m_current.isEmpty() && !upcomingPaths.contains(m_current)) {
+        qCDebug(queuePrefetcher) << "No longer upcoming, stopping copy of" << m_current;
+        m_cancelled = true;
+        if (m_reply) {
+            m_reply->abort();
+        }
+    }
+
+    evict();
+    startNext();
+}
+
+QList<MediaFile> QueuePrefetcher::upcomingItems() const
+{
+    QList<MediaFile> upcoming;
+    QSet<QString> seen;
+    const auto add = [&](const QList<MediaFile>& files) {
+        for (const MediaFile& file : files) {
+            if (upcoming.size() >= m_depth) {
+                return;
+            }
+            if (!file.filePath().isEmpty() && !seen.contains(file.filePath())) {
+                seen.insert(file.filePath());
+                upcoming.append(file);
+            }
+        }
+    };
+
+    // Queued items play before the playlist goes on
+    if (m_manager) {
+        add(m_manager->getCurrentQueue().mid(0, m_depth));
+    }
+    if (m_playlist) {
+        add(m_playlist->upcomingItems(m_depth));
+    }
+    return upcoming;
+}
+
+void QueuePrefetcher::startNext()
+{
+    if (!m_current.isEmpty() || m_queue.isEmpty()) {
+        return;
+    }
+
+    const Job job = m_queue.takeFirst();
+    m_current = job.path;
+    m_cancelled = false;
+
+    if (job.remote) {
+        fetchUrl(job);
+    } else {
+        copyFile(job);
+    }
+}
+
+void QueuePrefetcher::copyFile(const Job& job)
+{
+    const QString partPath = filePath(keyOf(job.path) + ".part");
+    const qint64 prefixBytes = m_prefixBytes;
+
+    m_pool->start([this, job, partPath, prefixBytes]() {
+        ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Background);
+        const BackgroundIoScope backgroundIo;
+
+        qint64 copied = 0;
+        qint64 size = 0;
+        qint64 modified = 0;
+        bool skipped = false;
+
+        const QFileInfo info(job.path);
+        if (!info.isFile() || !DirectoryWatcher::isNetworkPath(info.absolutePath())) {
+            // Local files open fast enough as they are
+            skipped = true;
+        } else {
+            size = info.size();
+            modified = info.lastModified().toSecsSinceEpoch();
+            const qint64 limit = job.audio && size <= MAX_WHOLE_BYTES ? size : qMin(size, prefixBytes);
+
+            // Read around the page cache, the copy is what playback will read
+            ScanFileReader source(job.path);
+            QFile target(partPath);
+            if (source.isOpen() && target.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                while (copied < limit && !m_cancelled) {
+                    const QByteArray block = source.read(copied, qMin(COPY_BLOCK_BYTES, limit - copied));
+                    if (block.isEmpty() || target.write(block) != block.size()) {
+                        break;
+                    }
+                    copied += block.size();
+                }
+            }
+            if (!target.flush() || copied < limit || m_cancelled) {
+                copied = 0;
+            }
+        }
+
+        QMetaObject::invokeMethod(this, [this, path = job.path, partPath, copied, size, modified, skipped]() {
+            onCopied(path, partPath, copied, size, modified, skipped);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void QueuePrefetcher::fetchUrl(const Job& job)
+{
+    if (!m_network) {
+        m_network = new QNetworkAccessManager(this);
+    }
+
+    m_fetchFile.setFileName(filePath(keyOf(job.path) + ".part"));
+    if (!m_fetchFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(queuePrefetcher) << "Cannot write prefetch cache:" << m_fetchFile.errorString();
+        m_current.clear();
+        return;
+    }
+    m_fetchedBytes = 0;
+
+    m_reply = m_network->get(QNetworkRequest(QUrl(job.path)));
+    connect(m_reply, &QNetworkReply::readyRead, this, &QueuePrefetcher::onFetchReadyRead);
+    connect(m_reply, &QNetworkReply::finished, this, &QueuePrefetcher::onFetchFinished);
+}
+
+void QueuePrefetcher::onFetchReadyRead()
+{
+    const qint64 length = m_reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    const QByteArray data = m_reply->readAll();
+    m_fetchedBytes += data.size();
+
+    if (length > MAX_WHOLE_BYTES || m_fetchedBytes > MAX_WHOLE_BYTES) {
+        m_fetchedBytes = MAX_WHOLE_BYTES + 1;
+        m_reply->abort();
+        return;
+    }
+    if (m_fetchFile.write(data) != data.size()) {
+        m_cancelled = true;
+        m_reply->abort();
+    }
+}
+
+void QueuePrefetcher::onFetchFinished()
+{
+    QNetworkReply* reply = std::exchange(m_reply, nullptr);
+    reply->deleteLater();
+
+    const bool tooLarge = m_fetchedBytes > MAX_WHOLE_BYTES;
+    const bool complete = reply->error() == QNetworkReply::NoError && !m_cancelled && m_fetchFile.flush();
+    const qint64 bytes = complete ? m_fetchedBytes : 0;
+    const QString partPath = m_fetchFile.fileName();
+    m_fetchFile.close();
+
+    onCopied(m_current, partPath, bytes, bytes, 0, tooLarge);
+}
+
+void QueuePrefetcher::onCopied(const QString& path, const QString& partPath, qint64 bytes, qint64 sourceSize,
+                               qint64 sourceModified, bool skipped)
+{
+    m_current.clear();
+
+    if (skipped) {
+        if (m_skipped.size() >= MAX_SKIPPED) {
+            m_skipped.clear();
+        }
+        m_skipped.insert(path);
+    }
+
+    if (bytes > 0) {
+        const QString key = keyOf(path);
+        const QString fileName = QStringLiteral("%1-%2-%3.pf").arg(key).arg(sourceSize).arg(sourceModified);
+        remove(key);
+        QFile::remove(filePath(fileName));
+
+        if (QFile::rename(partPath, filePath(fileName))) {
+            Entry entry;
+            entry.fileName = fileName;
+            entry.bytes = bytes;
+            entry.sourceSize = sourceSize;
+            entry.sourceModified = sourceModified;
+            insert(key, entry);
+
+            qCDebug(queuePrefetcher) << "Prefetched" << bytes / 1024 << "KB of" << path;
+            emit copyFinished(path, bytes, bytes >= sourceSize);
+            evict();
+        }
+    }
+    QFile::remove(partPath);
+
+    startNext();
+}
+
+QString QueuePrefetcher::keyOf(const QString& path)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
+
+bool QueuePrefetcher::isRemote(const QString& path)
+{
+    const QString scheme = QUrl(path).scheme().toLower();
+    return scheme == QLatin1String("http") || scheme == QLatin1String("https");
+}
+
+QString QueuePrefetcher::filePath(const QString& fileName) const
+{
+    return QDir(m_directory).filePath(fileName);
+}
+
+void QueuePrefetcher::loadIndex()
+{
+    const QDir directory(m_directory);
+
+    // Copies interrupted by the last exit
+    const QStringList parts = directory.entryList(QStringList() << "*.part", QDir::Files);
+    for (const QString& part : parts) {
+        directory.remove(part);
+    }
+
+    // Without access times on disk, write order is the best recency guess
+    const QFileInfoList files = directory.entryInfoList(QStringList() << "*.pf", QDir::Files, QDir::Time | QDir::Reversed);
+    for (const QFileInfo& info : files) {
+        const QStringList fields = info.completeBaseName().split('-');
+        bool sizeOk = false;
+        bool modifiedOk = false;
+        Entry entry;
+        entry.fileName = info.fileName();
+        entry.bytes = info.size();
+        entry.sourceSize = fields.size() == 3 ? fields[1].toLongLong(&sizeOk) : 0;
+        entry.sourceModified = fields.size() == 3 ? fields[2].toLongLong(&modifiedOk) : 0;
+        if (!sizeOk || !modifiedOk || entry.bytes <= 0 || m_entries.contains(fields[0])) {
+            directory.remove(info.fileName());
+            continue;
+        }
+        insert(fields[0], entry);
+    }
+
+    evict();
+
+    qCDebug(queuePrefetcher) << "Prefetch cache:" << m_entries.size() << "copies," << m_currentBytes / (1024 * 1024)
+                             << "MB";
+}
+
+void QueuePrefetcher::insert(const QString& key, Entry entry)
+{
+    remove(key);
+    m_order.push_back(key);
+    entry.position = std::prev(m_order.end());
+    m_currentBytes += entry.bytes;
+    m_entries.insert(key, entry);
+}
+
+void QueuePrefetcher::remove(const QString& key)
+{
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        return;
+    }
+
+    QFile::remove(filePath(it->fileName));
+    m_currentBytes -= it->bytes;
+    m_order.erase(it->position);
+    m_entries.erase(it);
+}
+
+void QueuePrefetcher::evict()
+{
+    auto it = m_order.begin();
+    while (m_currentBytes > m_maxBytes && it != m_order.end()) {
+        const QString key = *it++;
+        if (!m_pinned.contains(key)) {
+            remove(key);
+        }
+    }
+}
+
+} // namespace Data
+} // namespace EonPlay
@@ -0,0 +1,342 @@
+#include "data/RemoteLibrary.h"
+#include "network/NetworkService.h"
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLoggingCategory>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSysInfo>
+
+Q_LOGGING_CATEGORY(remoteLibrary, "eonplay.data.remote")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+const QString API_PATH = QStringLiteral("/api/v1/");
+const QString PLAYLISTS_RESOURCE = QStringLiteral("playlists");
+
+int httpStatus(QNetworkReply* reply)
+{
+    return reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+}
+} // namespace
+
+RemoteLibrary::RemoteLibrary(const QUrl& serverUrl, const QString& token, QObject* parent)
+    : QObject(parent)
+    , m_serverUrl(serverUrl)
+    , m_token(token.toUtf8())
+    , m_pollTimer(new QTimer(this))
+    , m_cache(CACHE_SIZE)
+    , m_generation(0)
+{
+    m_pollTimer->setInterval(POLL_INTERVAL_MS);
+    connect(m_pollTimer, &QTimer::timeout, this, &RemoteLibrary::poll);
+}
+
+RemoteLibrary::~RemoteLibrary() = default;
+
+void RemoteLibrary::connectToServer()
+{
+    m_pollTimer->start();
+    poll();
+}
+
+void RemoteLibrary::disconnectFromServer()
+{
+    m_pollTimer->stop();
+    m_etag.clear();
+    m_totals = Totals();
+    dropCache();
+}
+
+QList<MediaFile> RemoteLibrary::search(const QString& text, const QString& column, const QString& value,
+                                       const QString& sort, bool descending, int limit)
+{
+    QUrlQuery query;
+    if (!text.isEmpty()) {
+        query.addQueryItem("q", text);
+    }
+    if (!column.isEmpty()) {
+        query.addQueryItem(column, value);
+    }
+    if (!sort.isEmpty()) {
+        query.addQueryItem("sort", sort);
+    }
+    if (descending) {
+        query.addQueryItem("order", "desc");
+    }
+    query.addQueryItem("limit", QString::number(qBound(1, limit, int(PAGE_SIZE))));
+    return items(cachedGet("search", query));
+}
+
+QStringList RemoteLibrary::facetValues(const QString& facet)
+{
+    const auto it = m_facetValues.constFind(facet);
+    if (it != m_facetValues.constEnd()) {
+        return it.value();
+    }
+
+    const QString key = "facets/" + facet;
+    if (!m_pending.contains(key)) {
+        m_pending.insert(key);
+        fetchFacetPage(facet, 0, QStringList());
+    }
+    return QStringList();
+}
+
+QList<RemoteLibrary::Playlist> RemoteLibrary::playlists()
+{
+    QUrlQuery query;
+    query.addQueryItem("limit", QString::number(PAGE_SIZE));
+
+    QList<Playlist> result;
+    const QJsonArray array = cachedGet(PLAYLISTS_RESOURCE, query).value("items").toArray();
+    for (const QJsonValue& value : array) {
+        const QJsonObject object = value.toObject();
+        Playlist playlist;
+        playlist.id = object.value("id").toInt(-1);
+        playlist.name = object.value("name").toString();
+        playlist.itemCount = object.value("itemCount").toInt();
+        playlist.totalDuration = qint64(object.value("totalDuration").toDouble());
+        playlist.smart = object.value("smart").toBool();
+        result.append(playlist);
+    }
+    return result;
+}
+
+QList<MediaFile> RemoteLibrary::playlistItems(int playlistId)
+{
+    QUrlQuery query;
+    query.addQueryItem("limit", QString::number(PAGE_SIZE));
+    return items(cachedGet(QString("%1/%2/items").arg(PLAYLISTS_RESOURCE).arg(playlistId), query));
+}
+
+void RemoteLibrary::fetchWatchProgress(const QString& filePath)
+{
+    QUrlQuery query;
+    query.addQueryItem("path", m_serverPaths.value(filePath, filePath));
+
+    QNetworkReply* reply = get("progress", query);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, filePath]() {
+        reply->deleteLater();
+        if (reply->error() != QNetworkReply::NoError) {
+            // 404 is no progress yet
+            if (httpStatus(reply) != 404) {
+                qCWarning(remoteLibrary) << "Failed to fetch watch progress:" << reply->errorString();
+            }
+            return;
+        }
+        const QJsonObject progress = QJsonDocument::fromJson(reply->readAll()).object();
+        emit watchProgressReceived(filePath, qint64(progress.value("position").toDouble()),
+                                   qint64(progress.value("duration").toDouble()),
+                                   progress.value("completed").toBool());
+    });
+}
+
+void RemoteLibrary::saveWatchProgress(const QString& filePath, qint64 position, qint64 duration)
+{
+    QUrl url = m_serverUrl;
+    url.setPath(API_PATH + "progress");
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    if (!m_token.isEmpty()) {
+        request.setRawHeader("Authorization", "Bearer " + m_token);
+    }
+
+    const QJsonObject body{
+        {"path", m_serverPaths.value(filePath, filePath)},
+        {"position", double(position)},
+        {"duration", double(duration)},
+        {"deviceId", QSysInfo::machineHostName()}
+    };
+    QNetworkReply* reply = NetworkService::instance().post(request, QJsonDocument(body).toJson(QJsonDocument::Compact),
+                                                           NetworkService::RequestClass::Metadata);
+    connect(reply, &QNetworkReply::finished, this, [reply]() {
+        reply->deleteLater();
+        if (reply->error() != QNetworkReply::NoError) {
+            qCWarning(remoteLibrary) << "Failed to save watch progress:" << reply->errorString();
+        }
+    });
+}
+
+QUrl RemoteLibrary::mediaUrl(int id) const
+{
+    QUrl url = m_serverUrl;
+    url.setPath(API_PATH + "media/" + QString::number(id));
+    if (!m_token.isEmpty()) {
+        // Players cannot send the Authorization header
+        url.setQuery(QUrlQuery({{"token", QString::fromUtf8(m_token)}}));
+    }
+    return url;
+}
+
+void RemoteLibrary::poll()
+{
+    QNetworkReply* reply = get("info", QUrlQuery(), m_etag);
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        const int status = httpStatus(reply);
+        if (reply->error() != QNetworkReply::NoError && status != 304) {
+            qCWarning(remoteLibrary) << "Library server unreachable:" << reply->errorString();
+            if (!isConnected()) {
+                emit connectionFailed(reply->errorString());
+            }
+            return;
+        }
+
+        // Playlists are not part of the revision
+        const QStringList keys = m_cache.keys();
+        for (const QString& key : keys) {
+            if (key.startsWith(PLAYLISTS_RESOURCE)) {
+                m_cache.remove(key);
+            }
+        }
+        if (status == 304) {
+            return;
+        }
+
+        const QJsonObject info = QJsonDocument::fromJson(reply->readAll()).object();
+        m_totals.fileCount = info.value("fileCount").toInt();
+        m_totals.totalSize = qint64(info.value("totalSize").toDouble());
+        m_totals.totalDuration = qint64(info.value("totalDuration").toDouble());
+
+        const QByteArray etag = reply->rawHeader("ETag");
+        const bool first = m_etag.isEmpty();
+        const bool changed = !first && etag != m_etag;
+        m_etag = etag;
+        if (first) {
+            qCInfo(remoteLibrary) << "Connected to library server" << m_serverUrl.toString()
+                                  << "with" << m_totals.fileCount << "files";
+            emit connected();
+        } else if (changed) {
+            dropCache();
+            emit libraryChanged();
+        }
+    });
+}
+
+QJsonObject RemoteLibrary::cachedGet(const QString& resource, const QUrlQuery& query)
+{
+    const QString key = resource + QLatin1Char('?') + query.toString(QUrl::FullyEncoded);
+    if (const QJsonObject* body = m_cache.object(key)) {
+        return *body;
+    }
+    if (m_pending.contains(key)) {
+        return QJsonObject();
+    }
+
+    m_pending.insert(key);
+    const quint64 generation = m_generation;
+    QNetworkReply* reply = get(resource, query);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, key, generation]() {
+        reply->deleteLater();
+        if (generation != m_generation) {
+            return;     // Answer for a revision since dropped
+        }
+        m_pending.remove(key);
+        if (reply->error() != QNetworkReply::NoError) {
+            qCWarning(remoteLibrary) << "Library query failed:" << key << reply->errorString();
+            return;
+        }
+        m_cache.insert(key, new QJsonObject(QJsonDocument::fromJson(reply->readAll()).object()));
+        emit resultsReady();
+    });
+    return QJsonObject();
+}
+
+QNetworkReply* RemoteLibrary::get(const QString& resource, const QUrlQuery& query, const QByteArray& etag)
+{
+    QUrl url = m_serverUrl;
+    url.setPath(API_PATH + resource);
+    url.setQuery(query);
+
+    QNetworkRequest request(url);
+    request.setRawHeader("Accept", "application/json");
+    if (!m_token.isEmpty()) {
+        request.setRawHeader("Authorization", "Bearer " + m_token);
+    }
+    if (!etag.isEmpty()) {
+        request.setRawHeader("If-None-Match", etag);
+    }
+    return NetworkService::instance().get(request, NetworkService::RequestClass::Metadata);
+}
+
+void RemoteLibrary::fetchFacetPage(const QString& facet, int offset, QStringList values)
+{
+    QUrlQuery query;
+    query.addQueryItem("facet", facet);
+    query.addQueryItem("offset", QString::number(offset));
+    query.addQueryItem("limit", QString::number(PAGE_SIZE));
+
+    const quint64 generation = m_generation;
+    QNetworkReply* reply = get("facets", query);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, facet, values, generation]() mutable {
+        reply->deleteLater();
+        if (generation != m_generation) {
+            return;
+        }
+        if (reply->error() != QNetworkReply::NoError) {
+            qCWarning(remoteLibrary) << "Facet query failed:" << facet << reply->errorString();
+            m_pending.remove("facets/" + facet);
+            return;
+        }
+
+        const QJsonObject page = QJsonDocument::fromJson(reply->readAll()).object();
+        const QJsonArray array = page.value("items").toArray();
+        for (const QJsonValue& value : array) {
+            values.append(value.toObject().value("value").toString());
+        }
+
+        // Values are paged like everything else; the list is only offered once complete
+        if (!array.isEmpty() && values.size() < page.value("total").toInt()) {
+            fetchFacetPage(facet, values.size(), values);
+            return;
+        }
+        m_pending.remove("facets/" + facet);
+        m_facetValues.insert(facet, values);
+        emit resultsReady();
+    });
+}
+
+QList<MediaFile> RemoteLibrary::items(const QJsonObject& page)
+{
+    QList<MediaFile> files;
+    const QJsonArray array = page.value("items").toArray();
+    files.reserve(array.size());
+    for (const QJsonValue& value : array) {
+        const QJsonObject item = value.toObject();
+        const QString url = mediaUrl(item.value("id").toInt()).toString();
+        m_serverPaths.insert(url, item.value("path").toString());
+
+        // Server ids mean nothing to the local database, so the file has none
+        MediaFile file;
+        file.setFilePath(url, false);
+        file.setTitle(item.value("title").toString());
+        file.setArtist(item.value("artist").toString());
+        file.setAlbum(item.value("album").toString());
+        file.setGenre(item.value("genre").toString());
+        file.setYear(item.value("year").toInt());
+        file.setTrackNumber(item.value("track").toInt());
+        file.setDuration(qint64(item.value("duration").toDouble()));
+        file.setFileSize(qint64(item.value("size").toDouble()));
+        file.setPlayCount(item.value("playCount").toInt());
+        file.setRating(item.value("rating").toInt());
+        file.setDateAdded(QDateTime::fromString(item.value("added").toString(), Qt::ISODate));
+        file.setLastPlayed(QDateTime::fromString(item.value("lastPlayed").toString(), Qt::ISODate));
+        files.append(file);
+    }
+    return files;
+}
+
+void RemoteLibrary::dropCache()
+{
+    ++m_generation;
+    m_cache.clear();
+    m_pending.clear();
+    m_facetValues.clear();
+}
+
+} // namespace Data
+} // namespace EonPlay
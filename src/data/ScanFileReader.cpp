@@ -0,0 +1,257 @@
+#include "data/ScanFileReader.h"
+#include <QDir>
+#include <QFile>
+#include <QLoggingCategory>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(Q_OS_LINUX)
+#include <sys/syscall.h>
+#elif defined(Q_OS_MACOS)
+#include <sys/resource.h>
+#endif
+
+Q_LOGGING_CATEGORY(scanFileReader, "eonplay.data.scanio")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+
+#if defined(Q_OS_LINUX)
+constexpr int IOPRIO_WHO_PROCESS = 1;       // With id 0, the calling thread
+constexpr int IOPRIO_CLASS_SHIFT = 13;
+constexpr int IOPRIO_CLASS_IDLE = 3;
+#endif
+
+inline qint64 alignDown(qint64 value)
+{
+    return value & ~(ScanFileReader::ALIGNMENT - 1);
+}
+
+inline qint64 alignUp(qint64 value)
+{
+    return alignDown(value + ScanFileReader::ALIGNMENT - 1);
+}
+
+} // namespace
+
+ScanFileReader::ScanFileReader(const QString& filePath)
+{
+#if defined(Q_OS_WIN)
+    const std::wstring path = QDir::toNativeSeparators(filePath).toStdWString();
+    const DWORD share = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+    HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ, share, nullptr, OPEN_EXISTING,
+                                FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    m_direct = handle != INVALID_HANDLE_VALUE;
+    if (!m_direct) {
+        handle = CreateFileW(path.c_str(), GENERIC_READ, share, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                             nullptr);
+    }
+    m_handle = handle;
+
+    LARGE_INTEGER size;
+    if (handle != INVALID_HANDLE_VALUE && GetFileSizeEx(handle, &size)) {
+        m_size = size.QuadPart;
+    }
+#else
+    const QByteArray path = QFile::encodeName(filePath);
+#if defined(Q_OS_LINUX)
+    m_fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+    m_direct = m_fd >= 0;
+    if (m_fd < 0 && errno == EINVAL) {
+        m_fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+    }
+    if (m_fd >= 0 && !m_direct) {
+        posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+#else
+    m_fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+#if defined(Q_OS_MACOS)
+    m_direct = m_fd >= 0 && fcntl(m_fd, F_NOCACHE, 1) == 0;
+#endif
+#endif
+
+    struct stat status;
+    if (m_fd >= 0 && fstat(m_fd, &status) == 0) {
+        m_size = status.st_size;
+    }
+#endif
+
+    if (isOpen()) {
+        m_buffer.resize(BLOCK_BYTES + ALIGNMENT);
+    }
+}
+
+ScanFileReader::~ScanFileReader()
+{
+#if defined(Q_OS_WIN)
+    if (m_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_handle);
+    }
+#else
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+#endif
+}
+
+bool ScanFileReader::isOpen() const
+{
+#if defined(Q_OS_WIN)
+    return m_handle != INVALID_HANDLE_VALUE && m_size >= 0;
+#else
+    return m_fd >= 0 && m_size >= 0;
+#endif
+}
+
+QByteArray ScanFileReader::read(qint64 offset, qint64 length)
+{
+    QByteArray result;
+    if (!isOpen() || offset < 0 || length <= 0 || offset >= m_size) {
+        return result;
+    }
+
+    const quintptr address = reinterpret_cast<quintptr>(m_buffer.data());
+    char* buffer = m_buffer.data() + (ALIGNMENT - address % ALIGNMENT) % ALIGNMENT;
+
+    const qint64 end = qMin(offset + length, m_size);
+    result.reserve(end - offset);
+    for (qint64 position = alignDown(offset); position < end;) {
+        const qint64 chunk = qMin(BLOCK_BYTES, alignUp(end) - position);
+        const qint64 got = readAligned(position, buffer, chunk);
+        if (got < 0) {
+            m_error = true;
+            return QByteArray();
+        }
+
+        const qint64 from = qMax(offset, position) - position;
+        const qint64 to = qMin(got, end - position);
+        if (to > from) {
+            result.append(buffer + from, to - from);
+        }
+        dropCached(position, got);
+
+        if (got < chunk) {
+            break;      // End of file
+        }
+        position += got;
+    }
+
+    return result;
+}
+
+bool ScanFileReader::addToHash(QCryptographicHash& hash)
+{
+    if (!isOpen()) {
+        return false;
+    }
+
+    for (qint64 offset = 0; offset < m_size;) {
+        const QByteArray block = read(offset, BLOCK_BYTES);
+        if (m_error) {
+            return false;
+        }
+        if (block.isEmpty()) {
+            break;      // Truncated while reading
+        }
+        hash.addData(block);
+        offset += block.size();
+    }
+    return true;
+}
+
+qint64 ScanFileReader::readAligned(qint64 offset, char* buffer, qint64 length)
+{
+    qint64 total = 0;
+    while (total < length) {
+#if defined(Q_OS_WIN)
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>((offset + total) & 0xffffffff);
+        overlapped.OffsetHigh = static_cast<DWORD>((offset + total) >> 32);
+        DWORD got = 0;
+        if (!ReadFile(m_handle, buffer + total, static_cast<DWORD>(length - total), &got, &overlapped)) {
+            if (GetLastError() == ERROR_HANDLE_EOF) {
+                break;
+            }
+            qCWarning(scanFileReader) << "Read failed, error" << GetLastError();
+            return -1;
+        }
+#else
+        const ssize_t got = ::pread(m_fd, buffer + total, static_cast<size_t>(length - total), offset + total);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+#if defined(Q_OS_LINUX)
+            // Some filesystems accept O_DIRECT at open and refuse it on read
+            if (errno == EINVAL && m_direct) {
+                fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) & ~O_DIRECT);
+                posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+                m_direct = false;
+                continue;
+            }
+#endif
+            qCWarning(scanFileReader) << "Read failed:" << strerror(errno);
+            return -1;
+        }
+#endif
+        if (got == 0) {
+            break;
+        }
+        total += got;
+    }
+    return total;
+}
+
+void ScanFileReader::dropCached(qint64 offset, qint64 length)
+{
+#if defined(Q_OS_LINUX)
+    if (!m_direct && length > 0) {
+        posix_fadvise(m_fd, offset, length, POSIX_FADV_DONTNEED);
+    }
+#else
+    Q_UNUSED(offset)
+    Q_UNUSED(length)
+#endif
+}
+
+BackgroundIoScope::BackgroundIoScope()
+{
+#if defined(Q_OS_LINUX)
+    m_previous = static_cast<int>(syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, 0));
+    m_active = m_previous >= 0
+        && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) == 0;
+#elif defined(Q_OS_WIN)
+    // Fails when already in background mode, e.g. in a nested scope, which is then left alone
+    m_active = SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#elif defined(Q_OS_MACOS)
+    m_previous = getiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD);
+    m_active = m_previous >= 0 && setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD, IOPOL_THROTTLE) == 0;
+#endif
+}
+
+BackgroundIoScope::~BackgroundIoScope()
+{
+    if (!m_active) {
+        return;
+    }
+#if defined(Q_OS_LINUX)
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, m_previous);
+#elif defined(Q_OS_WIN)
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+#elif defined(Q_OS_MACOS)
+    setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD, m_previous);
+#endif
+}
+
+} // namespace Data
+} // namespace EonPlay
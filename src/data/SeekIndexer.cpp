@@ -0,0 +1,168 @@
+#include "data/SeekIndexer.h"
+#include "data/MetadataExtractor.h"
+#include "data/ScanFileReader.h"
+#include "media/SeekIndex.h"
+#include "ThreadPriority.h"
+#include <QLoggingCategory>
+#include <QMetaObject>
+#include <QThread>
+#include <utility>
+
+Q_LOGGING_CATEGORY(seekIndexer, "eonplay.data.seekindex")
+
+namespace EonPlay {
+namespace Data {
+
+SeekIndexer::SeekIndexer(MetadataExtractor* cache, QObject* parent)
+    : QObject(parent)
+    , m_cache(cache)
+    , m_pool(new QThreadPool(this))
+    , m_cancelled(false)
+{
+    // Workers keep their cache connection, so threads are not recycled
+    m_pool->setMaxThreadCount(MAX_THREADS);
+    m_pool->setThreadPriority(QThread::LowPriority);
+    m_pool->setExpiryTimeout(-1);
+}
+
+SeekIndexer::~SeekIndexer()
+{
+    cancel();
+    m_pool->waitForDone();
+}
+
+void SeekIndexer::indexFile(const QString& filePath)
+{
+    if (SeekIndex::isCandidate(filePath)) {
+        enqueue(filePath, false);
+    }
+}
+
+void SeekIndexer::cancel()
+{
+    m_queue.clear();
+    m_waiters.clear();
+    if (!m_inFlight.isEmpty()) {
+        m_cancelled = true;
+    }
+}
+
+std::shared_ptr<const SeekIndex> SeekIndexer::seekIndex(const QString& filePath)
+{
+    QByteArray data;
+    if (!m_cache || !m_cache->loadSeekIndex(filePath, &data) || data.isEmpty()) {
+        return nullptr;
+    }
+
+    SeekIndex index = SeekIndex::deserialize(data);
+    if (index.isEmpty()) {
+        return nullptr;
+    }
+    return std::make_shared<const SeekIndex>(std::move(index));
+}
+
+void SeekIndexer::requestSeekIndex(const QString& filePath, QObject* context,
+                                   std::function<void(std::shared_ptr<const SeekIndex>)> ready)
+{
+    if (!m_cache || filePath.isEmpty()) {
+        return;
+    }
+
+    m_waiters[filePath].append({context, std::move(ready)});
+    enqueue(filePath, true);
+}
+
+void SeekIndexer::enqueue(const QString& filePath, bool urgent)
+{
+    if (!m_cache || m_inFlight.contains(filePath)) {
+        return;
+    }
+
+    if (urgent) {
+        m_queue.removeOne(filePath);
+        m_queue.prepend(filePath);
+    } else if (!m_queue.contains(filePath)) {
+        m_queue.append(filePath);
+    }
+    startNext();
+}
+
+void SeekIndexer::startNext()
+{
+    if (m_inFlight.isEmpty()) {
+        m_cancelled = false;
+    }
+
+    while (!m_queue.isEmpty() && m_inFlight.size() < MAX_THREADS) {
+        const QString filePath = m_queue.takeFirst();
+        m_inFlight.insert(filePath);
+
+        m_pool->start([this, filePath]() {
+            ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Background);
+            const BackgroundIoScope backgroundIo;
+
+            std::shared_ptr<const SeekIndex> index;
+            bool built = false;
+            QByteArray stored;
+            if (m_cache->loadSeekIndex(filePath, &stored)) {
+                if (!stored.isEmpty()) {
+                    SeekIndex loaded = SeekIndex::deserialize(stored);
+                    if (!loaded.isEmpty()) {
+                        index = std::make_shared<const SeekIndex>(std::move(loaded));
+                    }
+                }
+            } else {
+                SeekIndex fresh = SeekIndex::build(filePath, &m_cancelled);
+                if (!m_cancelled) {
+                    m_cache->saveSeekIndex(filePath, fresh.serialize());
+                    built = true;
+                    if (!fresh.isEmpty()) {
+                        index = std::make_shared<const SeekIndex>(std::move(fresh));
+                    }
+                }
+            }
+
+            const bool cancelled = m_cancelled;
+            QMetaObject::invokeMethod(this, [this, filePath, index, built, cancelled]() {
+                onIndexed(filePath, index, built, cancelled);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void SeekIndexer::onIndexed(const QString& filePath, std::shared_ptr<const SeekIndex> index, bool built,
+                            bool cancelled)
+{
+    m_inFlight.remove(filePath);
+
+    if (cancelled) {
+        // Asked for again after the cancel; read it once more
+        if (m_waiters.contains(filePath)) {
+            m_queue.prepend(filePath);
+        }
+        startNext();
+        return;
+    }
+
+    if (built) {
+        const int keyframes = index ? int(index->keyframes().size()) : 0;
+        qCDebug(seekIndexer) << "Indexed" << filePath << keyframes << "keyframes";
+        emit seekIndexBuilt(filePath, keyframes);
+    }
+
+    const QList<Waiter> waiters = m_waiters.take(filePath);
+    if (index) {
+        for (const Waiter& waiter : waiters) {
+            if (waiter.context) {
+                QMetaObject::invokeMethod(waiter.context, [ready = waiter.ready, index]() {
+                    ready(index);
+                }, Qt::AutoConnection);
+            }
+        }
+    }
+
+    startNext();
+}
+
+} // namespace Data
+} // namespace EonPlay
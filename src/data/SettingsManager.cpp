@@ -11,15 +11,8 @@ Q_LOGGING_CATEGORY(settingsManager, "eonplay.settings")
 
 SettingsManager::SettingsManager(QObject* parent)
     : QObject(parent)
-    , m_autoSaveTimer(new QTimer(this))
     , m_initialized(false)
-    , m_settingsChanged(false)
 {
-    // Set up auto-save timer
-    m_autoSaveTimer->setSingleShot(false);
-    m_autoSaveTimer->setInterval(AUTO_SAVE_INTERVAL_MS);
-    connect(m_autoSaveTimer, &QTimer::timeout, this, &SettingsManager::autoSaveSettings);
-    
     qCDebug(settingsManager) << "SettingsManager created";
 }
 
@@ -40,8 +33,8 @@ bool SettingsManager::initialize()
     qCDebug(settingsManager) << "Initializing SettingsManager";
     
     try {
-        // Initialize QSettings
-        initializeQSettings();
+        // Create the store and read the settings file
+        initializeStore();
         
         // Load existing settings or create defaults
         loadSettings();
@@ -61,9 +54,6 @@ bool SettingsManager::initialize()
             saveSettings();
         }
         
-        // Start auto-save timer
-        m_autoSaveTimer->start();
-        
         m_initialized = true;
         qCDebug(settingsManager) << "SettingsManager initialized successfully";
         
@@ -86,15 +76,9 @@ void SettingsManager::shutdown()
     
     qCDebug(settingsManager) << "Shutting down SettingsManager";
     
-    // Stop auto-save timer
-    m_autoSaveTimer->stop();
-    
-    // Save any pending changes
-    if (m_settingsChanged) {
-        saveSettings();
-    }
-    
-    m_settings.reset();
+    // Write pending changes before the store goes away
+    m_store->flushSync();
+    m_store.reset();
     m_initialized = false;
     
     qCDebug(settingsManager) << "SettingsManager shutdown complete";
@@ -118,54 +102,62 @@ void SettingsManager::setPreferences(const UserPreferences& preferences)
     }
     
     m_preferences = validatedPrefs;
-    m_settingsChanged = true;
+    
+    // Written with the store's next flush
+    if (m_store) {
+        savePreferencesToSettings();
+    }
     
     emit preferencesChanged(m_preferences);
 }
 
 QVariant SettingsManager::getValue(const QString& key, const QVariant& defaultValue) const
 {
-    if (!m_settings) {
+    if (!m_store) {
         return defaultValue;
     }
     
-    return m_settings->value(key, defaultValue);
+    return m_store->value(key, defaultValue);
 }
 
 void SettingsManager::setValue(const QString& key, const QVariant& value)
 {
-    if (!m_settings) {
+    if (!m_store) {
         return;
     }
     
-    QVariant oldValue = m_settings->value(key);
-    if (oldValue != value) {
-        m_settings->setValue(key, value);
-        m_settingsChanged = true;
-        emit settingChanged(key, value);
+    // settingChanged follows batched, see onValuesChanged()
+    if (!setSchemaValue(key, value)) {
+        m_store->setValue(key, value);
     }
 }
 
+bool SettingsManager::setSchemaValue(const QString& key, const QVariant& value)
+{
+    bool found = false;
+    Settings::forEachSetting([&](const auto& setting) {
+        using T = typename std::decay_t<decltype(setting)>::ValueType;
+        if (!found && key == QLatin1String(setting.name)) {
+            found = true;
+            set(setting, value.value<T>());
+        }
+    });
+    return found;
+}
+
 void SettingsManager::saveSettings()
 {
-    if (!m_settings) {
-        qCWarning(settingsManager) << "Cannot save settings: QSettings not initialized";
+    if (!m_store) {
+        qCWarning(settingsManager) << "Cannot save settings: settings store not initialized";
         return;
     }
     
     qCDebug(settingsManager) << "Saving settings to" << getSettingsFilePath();
     
     try {
+        // settingsSaved is emitted once the write has completed
         savePreferencesToSettings();
-        m_settings->sync();
-        m_settingsChanged = false;
-        
-        if (m_settings->status() != QSettings::NoError) {
-            qCWarning(settingsManager) << "Error saving settings:" << m_settings->status();
-        } else {
-            qCDebug(settingsManager) << "Settings saved successfully";
-            emit settingsSaved();
-        }
+        m_store->flush();
         
     } catch (const std::exception& e) {
         qCCritical(settingsManager) << "Exception while saving settings:" << e.what();
@@ -176,8 +168,8 @@ void SettingsManager::saveSettings()
 
 void SettingsManager::loadSettings()
 {
-    if (!m_settings) {
-        qCWarning(settingsManager) << "Cannot load settings: QSettings not initialized";
+    if (!m_store) {
+        qCWarning(settingsManager) << "Cannot load settings: settings store not initialized";
         return;
     }
     
@@ -204,10 +196,9 @@ void SettingsManager::resetToDefaults()
     qCDebug(settingsManager) << "Resetting all settings to defaults";
     
     m_preferences.resetToDefaults();
-    m_settingsChanged = true;
     
-    if (m_settings) {
-        m_settings->clear();
+    if (m_store) {
+        m_store->clear();
         saveSettings();
     }
     
@@ -232,21 +223,21 @@ void SettingsManager::setEncryptedValue(const QString& key, const QString& value
 
 bool SettingsManager::needsMigration() const
 {
-    if (!m_settings) {
+    if (!m_store) {
         return false;
     }
     
-    QString currentVersion = m_settings->value(SETTINGS_VERSION_KEY).toString();
+    QString currentVersion = m_store->value(SETTINGS_VERSION_KEY).toString();
     return currentVersion != CURRENT_SETTINGS_VERSION;
 }
 
 bool SettingsManager::migrateSettings()
 {
-    if (!m_settings) {
+    if (!m_store) {
         return false;
     }
     
-    QString currentVersion = m_settings->value(SETTINGS_VERSION_KEY).toString();
+    QString currentVersion = m_store->value(SETTINGS_VERSION_KEY).toString();
     qCDebug(settingsManager) << "Migrating settings from version" << currentVersion << "to" << CURRENT_SETTINGS_VERSION;
     
     try {
@@ -255,8 +246,8 @@ bool SettingsManager::migrateSettings()
         }
         
         // Set new version
-        m_settings->setValue(SETTINGS_VERSION_KEY, CURRENT_SETTINGS_VERSION);
-        m_settings->sync();
+        m_store->setValue(SETTINGS_VERSION_KEY, CURRENT_SETTINGS_VERSION);
+        m_store->flush();
         
         qCDebug(settingsManager) << "Settings migration completed successfully";
         return true;
@@ -277,185 +268,85 @@ QString SettingsManager::getConfigurationPath()
 
 QString SettingsManager::getSettingsFilePath() const
 {
-    if (m_settings) {
-        return m_settings->fileName();
+    if (m_store) {
+        return m_store->filePath();
     }
     return QString();
 }
 
-void SettingsManager::autoSaveSettings()
+void SettingsManager::onValuesChanged(const QStringList& keys)
 {
-    if (m_settingsChanged) {
-        saveSettings();
+    for (const QString& key : keys) {
+        emit settingChanged(key, m_store->value(key));
+        
+        // Encrypted settings are stored under a suffixed key
+        auto it = m_changeHandlers.find(key.endsWith("_encrypted") ? key.chopped(10) : key);
+        if (it == m_changeHandlers.end()) {
+            continue;
+        }
+        it->removeIf([](const ChangeHandler& handler) { return handler.context.isNull(); });
+        // A handler may register more handlers
+        const QList<ChangeHandler> handlers = *it;
+        for (const ChangeHandler& handler : handlers) {
+            if (handler.context) {
+                handler.notify();
+            }
+        }
     }
+    emit settingsChanged(keys);
 }
 
-void SettingsManager::initializeQSettings()
+void SettingsManager::initializeStore()
 {
     // Ensure config directory exists
     QString configPath = getConfigurationPath();
     QDir().mkpath(configPath);
     
-    // Create QSettings instance
-    m_settings = std::make_unique<QSettings>(
-        configPath + "/settings.ini",
-        QSettings::IniFormat
-    );
+    m_store = std::make_unique<SettingsStore>(configPath + "/settings.ini");
+    connect(m_store.get(), &SettingsStore::valuesChanged, this, &SettingsManager::onValuesChanged);
+    connect(m_store.get(), &SettingsStore::saved, this, &SettingsManager::settingsSaved);
+    connect(m_store.get(), &SettingsStore::saveFailed, this, [](const QString& error) {
+        qCWarning(settingsManager) << "Error saving settings:" << error;
+    });
+    
+    if (!m_store->load()) {
+        qCWarning(settingsManager) << "Settings file unreadable, starting from defaults";
+    }
     
-    qCDebug(settingsManager) << "QSettings initialized with file:" << m_settings->fileName();
+    qCDebug(settingsManager) << "Settings store initialized with file:" << m_store->filePath();
 }
 
 void SettingsManager::loadPreferencesFromSettings()
 {
-    if (!m_settings) {
+    if (!m_store) {
         return;
     }
     
-    // Load playback settings
-    m_preferences.volume = m_settings->value("playback/volume", 75).toInt();
-    m_preferences.muted = m_settings->value("playback/muted", false).toBool();
-    m_preferences.playbackSpeed = m_settings->value("playback/speed", 1.0).toDouble();
-    m_preferences.resumePlayback = m_settings->value("playback/resume", true).toBool();
-    m_preferences.autoplay = m_settings->value("playback/autoplay", false).toBool();
-    m_preferences.loopPlaylist = m_settings->value("playback/loop", false).toBool();
-    m_preferences.shufflePlaylist = m_settings->value("playback/shuffle", false).toBool();
-    
-    // Load advanced playback settings
-    m_preferences.crossfadeEnabled = m_settings->value("playback/crossfadeEnabled", false).toBool();
-    m_preferences.crossfadeDuration = m_settings->value("playback/crossfadeDuration", 3000).toInt();
-    m_preferences.gaplessPlayback = m_settings->value("playback/gaplessPlayback", false).toBool();
-    m_preferences.seekThumbnailsEnabled = m_settings->value("playback/seekThumbnailsEnabled", true).toBool();
-    m_preferences.fastSeekSpeed = m_settings->value("playback/fastSeekSpeed", 5).toInt();
-    
-    // Load UI settings
-    m_preferences.theme = m_settings->value("ui/theme", "system").toString();
-    m_preferences.language = m_settings->value("ui/language", "system").toString();
-    m_preferences.windowSize = m_settings->value("ui/windowSize", QSize(1024, 768)).toSize();
-    m_preferences.windowPosition = m_settings->value("ui/windowPosition", QPoint(-1, -1)).toPoint();
-    m_preferences.windowMaximized = m_settings->value("ui/windowMaximized", false).toBool();
-    m_preferences.showMenuBar = m_settings->value("ui/showMenuBar", true).toBool();
-    m_preferences.showStatusBar = m_settings->value("ui/showStatusBar", true).toBool();
-    m_preferences.showPlaylist = m_settings->value("ui/showPlaylist", true).toBool();
-    m_preferences.showLibrary = m_settings->value("ui/showLibrary", false).toBool();
-    
-    // Load hardware settings
-    m_preferences.hardwareAcceleration = m_settings->value("hardware/acceleration", true).toBool();
-    m_preferences.preferredAccelerationType = m_settings->value("hardware/preferredAccelerationType", "auto").toString();
-    m_preferences.audioDevice = m_settings->value("hardware/audioDevice", "default").toString();
-    m_preferences.audioBufferSize = m_settings->value("hardware/audioBufferSize", 1024).toInt();
-    
-    // Load subtitle settings
-    m_preferences.subtitleFont = m_settings->value("subtitles/font", "Arial").toString();
-    m_preferences.subtitleFontSize = m_settings->value("subtitles/fontSize", 16).toInt();
-    m_preferences.subtitleColor = m_settings->value("subtitles/color", "#FFFFFF").toString();
-    m_preferences.subtitleBackgroundColor = m_settings->value("subtitles/backgroundColor", "#80000000").toString();
-    m_preferences.subtitleDelay = m_settings->value("subtitles/delay", 0).toInt();
-    m_preferences.subtitleAutoLoad = m_settings->value("subtitles/autoLoad", true).toBool();
-    
-    // Load library settings
-    m_preferences.libraryPaths = m_settings->value("library/paths").toStringList();
-    m_preferences.autoScanLibrary = m_settings->value("library/autoScan", true).toBool();
-    m_preferences.scanInterval = m_settings->value("library/scanInterval", 24).toInt();
-    m_preferences.extractThumbnails = m_settings->value("library/extractThumbnails", true).toBool();
-    m_preferences.extractMetadata = m_settings->value("library/extractMetadata", true).toBool();
-    
-    // Load network settings
-    m_preferences.enableNetworking = m_settings->value("network/enabled", true).toBool();
-    m_preferences.proxyType = m_settings->value("network/proxyType", "none").toString();
-    m_preferences.proxyHost = m_settings->value("network/proxyHost").toString();
-    m_preferences.proxyPort = m_settings->value("network/proxyPort", 0).toInt();
-    m_preferences.proxyUsername = m_settings->value("network/proxyUsername").toString();
-    m_preferences.proxyPassword = getEncryptedValue("network/proxyPassword");
-    
-    // Load privacy settings
-    m_preferences.collectUsageStats = m_settings->value("privacy/collectStats", false).toBool();
-    m_preferences.checkForUpdates = m_settings->value("privacy/checkUpdates", true).toBool();
-    m_preferences.rememberRecentFiles = m_settings->value("privacy/rememberRecent", true).toBool();
-    m_preferences.maxRecentFiles = m_settings->value("privacy/maxRecentFiles", 10).toInt();
-    
-    // Load advanced settings
-    m_preferences.enableLogging = m_settings->value("advanced/enableLogging", true).toBool();
-    m_preferences.logLevel = m_settings->value("advanced/logLevel", "info").toString();
-    m_preferences.enableCrashReporting = m_settings->value("advanced/crashReporting", true).toBool();
-    m_preferences.updateChannel = m_settings->value("advanced/updateChannel", "stable").toString();
+    Settings::forEachSetting([this](const auto& key) {
+        using T = typename std::decay_t<decltype(key)>::ValueType;
+        T& field = m_preferences.*key.field;
+        if constexpr (std::is_same_v<T, QString>) {
+            if (key.encrypted) {
+                field = getEncryptedValue(key.name, key.defaultValue());
+                return;
+            }
+        }
+        field = m_store->value(key.name, QVariant::fromValue(key.defaultValue())).template value<T>();
+    });
 }
 
 void SettingsManager::savePreferencesToSettings()
 {
-    if (!m_settings) {
+    if (!m_store) {
         return;
     }
     
-    // Save playback settings
-    m_settings->setValue("playback/volume", m_preferences.volume);
-    m_settings->setValue("playback/muted", m_preferences.muted);
-    m_settings->setValue("playback/speed", m_preferences.playbackSpeed);
-    m_settings->setValue("playback/resume", m_preferences.resumePlayback);
-    m_settings->setValue("playback/autoplay", m_preferences.autoplay);
-    m_settings->setValue("playback/loop", m_preferences.loopPlaylist);
-    m_settings->setValue("playback/shuffle", m_preferences.shufflePlaylist);
-    
-    // Save advanced playback settings
-    m_settings->setValue("playback/crossfadeEnabled", m_preferences.crossfadeEnabled);
-    m_settings->setValue("playback/crossfadeDuration", m_preferences.crossfadeDuration);
-    m_settings->setValue("playback/gaplessPlayback", m_preferences.gaplessPlayback);
-    m_settings->setValue("playback/seekThumbnailsEnabled", m_preferences.seekThumbnailsEnabled);
-    m_settings->setValue("playback/fastSeekSpeed", m_preferences.fastSeekSpeed);
-    
-    // Save UI settings
-    m_settings->setValue("ui/theme", m_preferences.theme);
-    m_settings->setValue("ui/language", m_preferences.language);
-    m_settings->setValue("ui/windowSize", m_preferences.windowSize);
-    m_settings->setValue("ui/windowPosition", m_preferences.windowPosition);
-    m_settings->setValue("ui/windowMaximized", m_preferences.windowMaximized);
-    m_settings->setValue("ui/showMenuBar", m_preferences.showMenuBar);
-    m_settings->setValue("ui/showStatusBar", m_preferences.showStatusBar);
-    m_settings->setValue("ui/showPlaylist", m_preferences.showPlaylist);
-    m_settings->setValue("ui/showLibrary", m_preferences.showLibrary);
-    
-    // Save hardware settings
-    m_settings->setValue("hardware/acceleration", m_preferences.hardwareAcceleration);
-    m_settings->setValue("hardware/preferredAccelerationType", m_preferences.preferredAccelerationType);
-    m_settings->setValue("hardware/audioDevice", m_preferences.audioDevice);
-    m_settings->setValue("hardware/audioBufferSize", m_preferences.audioBufferSize);
-    
-    // Save subtitle settings
-    m_settings->setValue("subtitles/font", m_preferences.subtitleFont);
-    m_settings->setValue("subtitles/fontSize", m_preferences.subtitleFontSize);
-    m_settings->setValue("subtitles/color", m_preferences.subtitleColor);
-    m_settings->setValue("subtitles/backgroundColor", m_preferences.subtitleBackgroundColor);
-    m_settings->setValue("subtitles/delay", m_preferences.subtitleDelay);
-    m_settings->setValue("subtitles/autoLoad", m_preferences.subtitleAutoLoad);
-    
-    // Save library settings
-    m_settings->setValue("library/paths", m_preferences.libraryPaths);
-    m_settings->setValue("library/autoScan", m_preferences.autoScanLibrary);
-    m_settings->setValue("library/scanInterval", m_preferences.scanInterval);
-    m_settings->setValue("library/extractThumbnails", m_preferences.extractThumbnails);
-    m_settings->setValue("library/extractMetadata", m_preferences.extractMetadata);
-    
-    // Save network settings
-    m_settings->setValue("network/enabled", m_preferences.enableNetworking);
-    m_settings->setValue("network/proxyType", m_preferences.proxyType);
-    m_settings->setValue("network/proxyHost", m_preferences.proxyHost);
-    m_settings->setValue("network/proxyPort", m_preferences.proxyPort);
-    m_settings->setValue("network/proxyUsername", m_preferences.proxyUsername);
-    setEncryptedValue("network/proxyPassword", m_preferences.proxyPassword);
-    
-    // Save privacy settings
-    m_settings->setValue("privacy/collectStats", m_preferences.collectUsageStats);
-    m_settings->setValue("privacy/checkUpdates", m_preferences.checkForUpdates);
-    m_settings->setValue("privacy/rememberRecent", m_preferences.rememberRecentFiles);
-    m_settings->setValue("privacy/maxRecentFiles", m_preferences.maxRecentFiles);
-    
-    // Save advanced settings
-    m_settings->setValue("advanced/enableLogging", m_preferences.enableLogging);
-    m_settings->setValue("advanced/logLevel", m_preferences.logLevel);
-    m_settings->setValue("advanced/crashReporting", m_preferences.enableCrashReporting);
-    m_settings->setValue("advanced/updateChannel", m_preferences.updateChannel);
+    Settings::forEachSetting([this](const auto& key) {
+        storeSetting(key);
+    });
     
     // Save settings version
-    m_settings->setValue(SETTINGS_VERSION_KEY, CURRENT_SETTINGS_VERSION);
+    m_store->setValue(SETTINGS_VERSION_KEY, CURRENT_SETTINGS_VERSION);
 }
 
 QString SettingsManager::encryptString(const QString& plaintext) const
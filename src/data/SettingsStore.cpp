@@ -0,0 +1,301 @@
+#include "SettingsStore.h"
+#include <QFile>
+#include <QFutureWatcher>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QPromise>
+#include <QSaveFile>
+#include <QSettings>
+#include <QThreadPool>
+#include <QTimer>
+#include <memory>
+#include <utility>
+
+Q_LOGGING_CATEGORY(settingsStore, "eonplay.settings.store")
+
+namespace {
+
+// Writes of all stores run one at a time, in order
+QThreadPool* writerPool()
+{
+    static QThreadPool* pool = [] {
+        auto* threadPool = new QThreadPool();
+        threadPool->setMaxThreadCount(1);
+        return threadPool;
+    }();
+    return pool;
+}
+
+} // namespace
+
+SettingsStore::SettingsStore(const QString& filePath, QObject* parent)
+    : QObject(parent)
+    , m_filePath(filePath)
+    , m_flushTimer(new QTimer(this))
+    , m_flushDelayMs(DEFAULT_FLUSH_DELAY_MS)
+    , m_dirty(false)
+    , m_flushAgain(false)
+    , m_writeGeneration(0)
+{
+    m_flushTimer->setSingleShot(true);
+    connect(m_flushTimer, &QTimer::timeout, this, &SettingsStore::flush);
+}
+
+SettingsStore::~SettingsStore()
+{
+    if (m_dirty || m_write.isRunning()) {
+        flushSync();
+    }
+}
+
+bool SettingsStore::load()
+{
+    // Left over from a write that was interrupted; the settings file itself is intact
+    QFile::remove(m_filePath + STAGING_SUFFIX);
+
+    QSettings settings(m_filePath, QSettings::IniFormat);
+    if (settings.status() != QSettings::NoError) {
+        qCWarning(settingsStore) << "Cannot read" << m_filePath << settings.status();
+        return false;
+    }
+
+    QVariantMap values;
+    const QStringList allKeys = settings.allKeys();
+    for (const QString& key : allKeys) {
+        values.insert(key, settings.value(key));
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_values = std::move(values);
+    }
+    m_dirty = false;
+    m_firstUnsavedChange.invalidate();
+    m_flushTimer->stop();
+    return true;
+}
+
+QVariant SettingsStore::value(const QString& key, const QVariant& defaultValue) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_values.value(key, defaultValue);
+}
+
+bool SettingsStore::contains(const QString& key) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_values.contains(key);
+}
+
+QStringList SettingsStore::keys() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_values.keys();
+}
+
+void SettingsStore::setValue(const QString& key, const QVariant& value)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_values.find(key);
+        if (it != m_values.end() && *it == value) {
+            return;
+        }
+        m_values.insert(key, value);
+    }
+    markChanged(key);
+}
+
+void SettingsStore::remove(const QString& key)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_values.remove(key) == 0) {
+            return;
+        }
+    }
+    markChanged(key);
+}
+
+void SettingsStore::clear()
+{
+    QStringList removed;
+    {
+        QMutexLocker locker(&m_mutex);
+        removed = m_values.keys();
+        m_values.clear();
+    }
+    for (const QString& key : removed) {
+        markChanged(key);
+    }
+    scheduleFlush();
+}
+
+void SettingsStore::setFlushDelay(int delayMs)
+{
+    m_flushDelayMs = qBound(0, delayMs, MAX_FLUSH_DELAY_MS);
+}
+
+void SettingsStore::flush()
+{
+    m_flushTimer->stop();
+    if (!m_dirty) {
+        return;
+    }
+    if (m_write.isRunning()) {
+        m_flushAgain = true;
+        return;
+    }
+
+    QVariantMap values;
+    {
+        QMutexLocker locker(&m_mutex);
+        values = m_values;
+    }
+    m_dirty = false;
+    m_firstUnsavedChange.invalidate();
+
+    const quint64 generation = ++m_writeGeneration;
+    auto promise = std::make_shared<QPromise<QString>>();
+    m_write = promise->future();
+    promise->start();
+
+    auto* watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation]() {
+        watcher->deleteLater();
+        onWriteFinished(generation, watcher->future().result());
+    });
+    watcher->setFuture(m_write);
+
+    const QString filePath = m_filePath;
+    writerPool()->start([promise, filePath, values]() {
+        promise->addResult(writeFile(filePath, values));
+        promise->finish();
+    });
+}
+
+bool SettingsStore::flushSync()
+{
+    m_flushTimer->stop();
+
+    // A failed background write whose result was not handled yet leaves its changes unsaved
+    m_write.waitForFinished();
+    if (m_write.resultCount() > 0 && !m_write.result().isEmpty()) {
+        m_dirty = true;
+    }
+    ++m_writeGeneration;
+    m_flushAgain = false;
+
+    if (!m_dirty) {
+        return true;
+    }
+
+    QVariantMap values;
+    {
+        QMutexLocker locker(&m_mutex);
+        values = m_values;
+    }
+
+    const QString error = writeFile(m_filePath, values);
+    if (!error.isEmpty()) {
+        qCWarning(settingsStore) << error;
+        emit saveFailed(error);
+        return false;
+    }
+
+    m_dirty = false;
+    m_firstUnsavedChange.invalidate();
+    emit saved();
+    return true;
+}
+
+void SettingsStore::markChanged(const QString& key)
+{
+    if (m_changedKeys.isEmpty()) {
+        QMetaObject::invokeMethod(this, &SettingsStore::emitChanges, Qt::QueuedConnection);
+    }
+    if (!m_changedKeys.contains(key)) {
+        m_changedKeys.append(key);
+    }
+    scheduleFlush();
+}
+
+void SettingsStore::scheduleFlush()
+{
+    m_dirty = true;
+    if (!m_firstUnsavedChange.isValid()) {
+        m_firstUnsavedChange.start();
+    }
+
+    // Debounce, but do not let a continuous stream of changes postpone the write forever
+    const qint64 remaining = MAX_FLUSH_DELAY_MS - m_firstUnsavedChange.elapsed();
+    m_flushTimer->start(static_cast<int>(qBound<qint64>(0, remaining, m_flushDelayMs)));
+}
+
+void SettingsStore::emitChanges()
+{
+    const QStringList keys = std::exchange(m_changedKeys, QStringList());
+    if (!keys.isEmpty()) {
+        emit valuesChanged(keys);
+    }
+}
+
+void SettingsStore::onWriteFinished(quint64 generation, const QString& error)
+{
+    // Superseded by a synchronous write
+    if (generation != m_writeGeneration) {
+        return;
+    }
+
+    if (error.isEmpty()) {
+        qCDebug(settingsStore) << "Saved" << m_filePath;
+        emit saved();
+    } else {
+        m_dirty = true;
+        qCWarning(settingsStore) << error;
+        emit saveFailed(error);
+    }
+
+    if (m_flushAgain) {
+        m_flushAgain = false;
+        flush();
+    }
+}
+
+QString SettingsStore::writeFile(const QString& filePath, const QVariantMap& values)
+{
+    // QSettings renders the INI format; QSaveFile makes replacing the file atomic
+    const QString stagingPath = filePath + STAGING_SUFFIX;
+    QFile::remove(stagingPath);
+    {
+        QSettings staging(stagingPath, QSettings::IniFormat);
+        for (auto it = values.cbegin(); it != values.cend(); ++it) {
+            staging.setValue(it.key(), it.value());
+        }
+        staging.sync();
+        if (staging.status() != QSettings::NoError) {
+            QFile::remove(stagingPath);
+            return QString("Cannot write %1").arg(stagingPath);
+        }
+    }
+
+    // Nothing is written for an empty store
+    QByteArray contents;
+    QFile rendered(stagingPath);
+    if (rendered.exists()) {
+        if (!rendered.open(QIODevice::ReadOnly)) {
+            return QString("Cannot read %1: %2").arg(stagingPath, rendered.errorString());
+        }
+        contents = rendered.readAll();
+        rendered.close();
+    }
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(contents) != contents.size() || !file.commit()) {
+        QFile::remove(stagingPath);
+        return QString("Cannot write %1: %2").arg(filePath, file.errorString());
+    }
+
+    QFile::remove(stagingPath);
+    return QString();
+}
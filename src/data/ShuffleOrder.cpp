@@ -0,0 +1,257 @@
+#include "data/ShuffleOrder.h"
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <cmath>
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+// Files unplayed for this long all weigh the same under ByLastPlayed
+const qint64 MAX_UNPLAYED_DAYS = 365;
+const double UNPLAYED_DAYS_PER_WEIGHT = 30.0;
+
+// Vose's alias method: one draw in constant time, proportional to weight
+struct AliasTable {
+    QList<int> items;
+    QList<double> probability;
+    QList<int> alias;
+    double totalWeight = 0.0;
+
+    void build(const QList<int>& indexes, const QList<double>& weights)
+    {
+        const int count = int(indexes.size());
+        items = indexes;
+        probability.resize(count);
+        alias.resize(count);
+
+        totalWeight = 0.0;
+        for (int index : indexes) {
+            totalWeight += weights[index];
+        }
+
+        QList<double> scaled(count);
+        QList<int> small;
+        QList<int> large;
+        for (int i = 0; i < count; ++i) {
+            scaled[i] = weights[items[i]] * count / totalWeight;
+            (scaled[i] < 1.0 ? small : large).append(i);
+        }
+
+        while (!small.isEmpty() && !large.isEmpty()) {
+            const int less = small.takeLast();
+            const int more = large.last();
+            probability[less] = scaled[less];
+            alias[less] = more;
+            scaled[more] -= 1.0 - scaled[less];
+            if (scaled[more] < 1.0) {
+                large.removeLast();
+                small.append(more);
+            }
+        }
+
+        // Whatever is left is full up to rounding
+        for (const QList<int>* rest : {&small, &large}) {
+            for (int slot : *rest) {
+                probability[slot] = 1.0;
+                alias[slot] = slot;
+            }
+        }
+    }
+
+    int sample(QRandomGenerator* random) const
+    {
+        const int slot = int(random->bounded(qint64(items.size())));
+        return items[random->generateDouble() < probability[slot] ? slot : alias[slot]];
+    }
+};
+}
+
+void ShuffleOrder::shuffle(int count)
+{
+    m_order.resize(qMax(0, count));
+    for (int i = 0; i < m_order.size(); ++i) {
+        m_order[i] = i;
+    }
+
+    QRandomGenerator* random = QRandomGenerator::global();
+    for (int i = int(m_order.size()) - 1; i > 0; --i) {
+        m_order.swapItemsAt(i, int(random->bounded(i + 1)));
+    }
+
+    rebuildPositions();
+}
+
+void ShuffleOrder::shuffle(const QList<MediaFile>& items, Weighting weighting)
+{
+    if (weighting == Uniform) {
+        shuffle(int(items.size()));
+        return;
+    }
+
+    const int count = int(items.size());
+    QList<double> weights(count);
+    QList<int> remaining(count);
+    for (int i = 0; i < count; ++i) {
+        weights[i] = weight(items[i], weighting);
+        remaining[i] = i;
+    }
+
+    // Draws hit an item still left at least half of the time
+    QRandomGenerator* random = QRandomGenerator::global();
+    QList<bool> drawn(count, false);
+    AliasTable table;
+    m_order.clear();
+    m_order.reserve(count);
+    while (m_order.size() < count) {
+        table.build(remaining, weights);
+
+        double drawnWeight = 0.0;
+        while (drawnWeight < table.totalWeight / 2 && m_order.size() < count) {
+            const int index = table.sample(random);
+            if (!drawn[index]) {
+                drawn[index] = true;
+                drawnWeight += weights[index];
+                m_order.append(index);
+            }
+        }
+
+        remaining.removeIf([&drawn](int index) { return drawn[index]; });
+    }
+
+    rebuildPositions();
+}
+
+void ShuffleOrder::clear()
+{
+    m_order.clear();
+    m_positions.clear();
+}
+
+void ShuffleOrder::insert(int logicalIndex, int firstPosition)
+{
+    const int count = size();
+    logicalIndex = qBound(0, logicalIndex, count);
+    firstPosition = qBound(0, firstPosition, count);
+
+    const bool appended = logicalIndex == count;
+    if (!appended) {
+        for (int& index : m_order) {
+            if (index >= logicalIndex) {
+                ++index;
+            }
+        }
+    }
+
+    // One inside-out Fisher-Yates step over the upcoming positions
+    const int position = firstPosition + int(QRandomGenerator::global()->bounded(count - firstPosition + 1));
+    m_order.append(logicalIndex);
+    if (position != count) {
+        m_order.swapItemsAt(position, count);
+    }
+
+    if (appended) {
+        m_positions.append(position);
+        m_positions[m_order[count]] = count;
+    } else {
+        rebuildPositions();
+    }
+}
+
+void ShuffleOrder::remove(int logicalIndex)
+{
+    const int position = positionOf(logicalIndex);
+    if (position == -1) {
+        return;
+    }
+
+    m_order.removeAt(position);
+    if (logicalIndex == m_positions.size() - 1) {
+        // The last item: no other index changes, only later positions
+        m_positions.removeLast();
+        for (int i = position; i < m_order.size(); ++i) {
+            m_positions[m_order[i]] = i;
+        }
+        return;
+    }
+
+    for (int& index : m_order) {
+        if (index > logicalIndex) {
+            --index;
+        }
+    }
+    rebuildPositions();
+}
+
+void ShuffleOrder::remove(const QList<bool>& removed)
+{
+    // Each remaining index moves down by the number removed before it
+    QList<int> newIndex(m_positions.size(), -1);
+    int next = 0;
+    for (int i = 0; i < newIndex.size(); ++i) {
+        if (i >= removed.size() || !removed[i]) {
+            newIndex[i] = next++;
+        }
+    }
+
+    int write = 0;
+    for (int read = 0; read < m_order.size(); ++read) {
+        const int index = newIndex[m_order[read]];
+        if (index != -1) {
+            m_order[write++] = index;
+        }
+    }
+    m_order.resize(write);
+    rebuildPositions();
+}
+
+void ShuffleOrder::move(int fromIndex, int toIndex)
+{
+    if (fromIndex == toIndex || positionOf(fromIndex) == -1 || positionOf(toIndex) == -1) {
+        return;
+    }
+
+    // Items keep their positions; only the indexes between the two shift
+    const int step = fromIndex < toIndex ? -1 : 1;
+    const int low = qMin(fromIndex, toIndex);
+    const int high = qMax(fromIndex, toIndex);
+    for (int& index : m_order) {
+        if (index == fromIndex) {
+            index = toIndex;
+        } else if (index >= low && index <= high) {
+            index += step;
+        }
+    }
+    rebuildPositions();
+}
+
+double ShuffleOrder::weight(const MediaFile& file, Weighting weighting)
+{
+    switch (weighting) {
+        case ByRating:
+            return 1.0 + file.rating();
+        case ByPlayCount:
+            return 1.0 + std::log1p(double(qMax(0, file.playCount())));
+        case ByLastPlayed: {
+            const QDateTime lastPlayed = file.lastPlayed();
+            const qint64 days = lastPlayed.isValid()
+                ? qBound<qint64>(0, lastPlayed.daysTo(QDateTime::currentDateTime()), MAX_UNPLAYED_DAYS)
+                : MAX_UNPLAYED_DAYS;
+            return 1.0 + days / UNPLAYED_DAYS_PER_WEIGHT;
+        }
+        case Uniform:
+        default:
+            return 1.0;
+    }
+}
+
+void ShuffleOrder::rebuildPositions()
+{
+    m_positions.resize(m_order.size());
+    for (int i = 0; i < m_order.size(); ++i) {
+        m_positions[m_order[i]] = i;
+    }
+}
+
+} // namespace Data
+} // namespace EonPlay
@@ -0,0 +1,65 @@
+#include "data/StringPool.h"
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(stringPool, "eonplay.data.stringpool")
+
+namespace EonPlay {
+namespace Data {
+
+StringPool& StringPool::shared()
+{
+    static StringPool pool;
+    return pool;
+}
+
+StringPool::~StringPool()
+{
+    for (QAtomicPointer<QString>& segment : m_segments) {
+        delete[] segment.loadRelaxed();
+    }
+}
+
+StringPool::Id StringPool::intern(const QString& value)
+{
+    if (value.isEmpty()) {
+        return 0;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_ids.constFind(value);
+    if (it != m_ids.constEnd()) {
+        return it.value();
+    }
+
+    const Id id = m_nextId;
+    const int segmentIndex = int(id >> SEGMENT_BITS);
+    if (segmentIndex >= SEGMENT_COUNT) {
+        qCWarning(stringPool) << "String pool is full; not interning" << value;
+        return 0;
+    }
+
+    // The string is in place before the segment or the id is published
+    QString* segment = m_segments[segmentIndex].loadRelaxed();
+    const bool newSegment = !segment;
+    if (newSegment) {
+        segment = new QString[SEGMENT_MASK + 1];
+    }
+    segment[id & SEGMENT_MASK] = value;
+    if (newSegment) {
+        m_segments[segmentIndex].storeRelease(segment);
+    }
+
+    m_ids.insert(value, id);
+    ++m_nextId;
+    return id;
+}
+
+int StringPool::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return int(m_nextId - 1);
+}
+
+} // namespace Data
+} // namespace EonPlay
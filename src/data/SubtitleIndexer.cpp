@@ -0,0 +1,275 @@
+#include "data/SubtitleIndexer.h"
+#include "subtitles/ASSParser.h"
+#include "subtitles/SRTParser.h"
+#include "DirectoryListingCache.h"
+#include "ThreadPriority.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMetaObject>
+#include <QRegularExpression>
+#include <QThread>
+#include <memory>
+#include <utility>
+
+Q_LOGGING_CATEGORY(subtitleIndexer, "eonplay.data.subtitleindex")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+
+const QStringList SUBTITLE_EXTENSIONS = {"srt", "ass", "ssa"};
+
+qint64 modifiedTime(const QFileInfo& info)
+{
+    return info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+}
+
+} // namespace
+
+SubtitleIndexer::SubtitleIndexer(DatabaseManager* dbManager, QObject* parent)
+    : QObject(parent)
+    , m_dbManager(dbManager)
+    , m_pool(new QThreadPool(this))
+    , m_writerTimer(new QTimer(this))
+{
+    // Parsing is quick; a couple of threads keep up with any scan
+    m_pool->setMaxThreadCount(MAX_THREADS);
+    m_pool->setThreadPriority(QThread::LowPriority);
+
+    m_writerTimer->setSingleShot(true);
+    m_writerTimer->setInterval(WRITE_INTERVAL_MS);
+    connect(m_writerTimer, &QTimer::timeout, this, &SubtitleIndexer::writePending);
+}
+
+SubtitleIndexer::~SubtitleIndexer()
+{
+    m_pool->clear();
+    m_pool->waitForDone();
+    writePending();
+}
+
+void SubtitleIndexer::indexFile(const QString& mediaFilePath, const QString& subtitlePath, bool generated)
+{
+    if (!m_dbManager || mediaFilePath.isEmpty() || m_inFlight.contains(subtitlePath)) {
+        return;
+    }
+    if (isCurrent(subtitlePath, modifiedTime(QFileInfo(subtitlePath)))) {
+        return;
+    }
+
+    m_inFlight.insert(subtitlePath);
+    m_pool->start([this, mediaFilePath, subtitlePath, generated]() {
+        ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Background);
+        const IndexedSource source = parseFile(mediaFilePath, subtitlePath, generated);
+        QMetaObject::invokeMethod(this, [this, source]() {
+            onParsed(source);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SubtitleIndexer::indexSidecars(const QString& mediaFilePath)
+{
+    if (!m_dbManager || mediaFilePath.isEmpty()) {
+        return;
+    }
+
+    // Listing the directory is I/O, so it happens on the pool too
+    m_pool->start([this, mediaFilePath]() {
+        ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Background);
+        const QStringList sidecars = findSidecars(mediaFilePath);
+        if (sidecars.isEmpty()) {
+            return;
+        }
+        QMetaObject::invokeMethod(this, [this, mediaFilePath, sidecars]() {
+            for (const QString& sidecar : sidecars) {
+                indexFile(mediaFilePath, sidecar, false);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SubtitleIndexer::indexTrack(const QString& mediaFilePath, const QString& subtitlePath,
+                                 const SubtitleTrack& track, bool generated)
+{
+    if (!m_dbManager || mediaFilePath.isEmpty()) {
+        return;
+    }
+
+    IndexedSource source;
+    source.mediaFilePath = mediaFilePath;
+    source.subtitlePath = subtitlePath;
+    source.generated = generated;
+    source.modifiedTime = modifiedTime(QFileInfo(subtitlePath));
+    if (source.modifiedTime < 0 || isCurrent(subtitlePath, source.modifiedTime)) {
+        return;
+    }
+
+    source.cues = cueRows(track);
+    queueWrite(source);
+}
+
+QVector<DatabaseManager::SubtitleSearchHit> SubtitleIndexer::search(const QString& searchTerm, int limit)
+{
+    if (!m_dbManager) {
+        return {};
+    }
+
+    // Cues still waiting for the writer should be found too
+    writePending();
+    return m_dbManager->searchSubtitles(searchTerm, limit);
+}
+
+bool SubtitleIndexer::isCurrent(const QString& subtitlePath, qint64 modifiedTime) const
+{
+    for (const IndexedSource& pending : m_pending) {
+        if (pending.subtitlePath == subtitlePath) {
+            return pending.modifiedTime == modifiedTime;
+        }
+    }
+    return m_dbManager->getSubtitleSourceModifiedTime(subtitlePath) == modifiedTime;
+}
+
+void SubtitleIndexer::onParsed(const IndexedSource& source)
+{
+    m_inFlight.remove(source.subtitlePath);
+
+    if (source.modifiedTime < 0) {
+        qCDebug(subtitleIndexer) << "Could not index" << source.subtitlePath;
+        return;
+    }
+    queueWrite(source);
+}
+
+void SubtitleIndexer::queueWrite(const IndexedSource& source)
+{
+    // A newer parse of the same file replaces one not yet written
+    for (IndexedSource& pending : m_pending) {
+        if (pending.subtitlePath == source.subtitlePath) {
+            pending = source;
+            return;
+        }
+    }
+
+    m_pending.append(source);
+    if (!m_writerTimer->isActive()) {
+        m_writerTimer->start();
+    }
+}
+
+void SubtitleIndexer::writePending()
+{
+    m_writerTimer->stop();
+    if (m_pending.isEmpty() || !m_dbManager) {
+        return;
+    }
+
+    const QVector<IndexedSource> sources = std::exchange(m_pending, {});
+    QVector<const IndexedSource*> written;
+
+    const bool ownTransaction = !m_dbManager->isBulkUpsertActive() && m_dbManager->beginTransaction();
+    for (const IndexedSource& source : sources) {
+        if (m_dbManager->replaceSubtitleCues(source.mediaFilePath, source.subtitlePath, source.generated,
+                                             source.modifiedTime, source.cues)) {
+            written.append(&source);
+        } else {
+            qCDebug(subtitleIndexer) << "Not indexed, media file not in the library:" << source.mediaFilePath;
+        }
+    }
+    if (ownTransaction) {
+        m_dbManager->commitTransaction();
+    }
+
+    for (const IndexedSource* source : written) {
+        emit subtitleIndexed(source->mediaFilePath, source->subtitlePath, source->cues.size());
+    }
+    qCDebug(subtitleIndexer) << "Indexed" << written.size() << "subtitle files";
+}
+
+QStringList SubtitleIndexer::findSidecars(const QString& mediaFilePath)
+{
+    const QFileInfo mediaInfo(mediaFilePath);
+    const QString directory = mediaInfo.absolutePath();
+    const DirectoryListingCache::Listing listing = DirectoryListingCache::instance().listing(directory);
+
+    // "movie.srt" as well as language-tagged "movie.en.srt"
+    const QString prefix = mediaInfo.completeBaseName() + QLatin1Char('.');
+    QStringList sidecars;
+    for (const QString& fileName : listing.files) {
+        if (!fileName.startsWith(prefix, Qt::CaseInsensitive)) {
+            continue;
+        }
+        const QString suffix = QFileInfo(fileName).suffix().toLower();
+        if (SUBTITLE_EXTENSIONS.contains(suffix)) {
+            sidecars.append(QDir(directory).absoluteFilePath(fileName));
+        }
+    }
+    return sidecars;
+}
+
+QVector<DatabaseManager::SubtitleCueRow> SubtitleIndexer::cueRows(const SubtitleTrack& track)
+{
+    // Override blocks, markup and line breaks are not words anyone searches for
+    static const QRegularExpression markup(QStringLiteral("\\{[^}]*\\}|<[^>]*>"));
+    static const QRegularExpression breaks(QStringLiteral("\\\\[Nnh]"));
+
+    QVector<DatabaseManager::SubtitleCueRow> rows;
+    rows.reserve(track.entryCount());
+    for (int i = 0; i < track.entryCount(); ++i) {
+        const SubtitleEntryView view = track.view(i);
+        QString text = view.text().toString();
+        text.remove(markup);
+        text.replace(breaks, QStringLiteral(" "));
+        text = text.simplified();
+        if (text.isEmpty()) {
+            continue;
+        }
+
+        DatabaseManager::SubtitleCueRow row;
+        row.startMs = view.startTime();
+        row.endMs = view.endTime();
+        row.text = text;
+        rows.append(row);
+    }
+    return rows;
+}
+
+SubtitleIndexer::IndexedSource SubtitleIndexer::parseFile(const QString& mediaFilePath, const QString& subtitlePath,
+                                                          bool generated)
+{
+    IndexedSource source;
+    source.mediaFilePath = mediaFilePath;
+    source.subtitlePath = subtitlePath;
+    source.generated = generated;
+
+    // A parser per call; the shared factory's parsers belong to SubtitleManager
+    const QString suffix = QFileInfo(subtitlePath).suffix().toLower();
+    std::unique_ptr<ISubtitleParser> parser;
+    if (suffix == "srt") {
+        parser = std::make_unique<SRTParser>();
+    } else if (suffix == "ass" || suffix == "ssa") {
+        parser = std::make_unique<ASSParser>();
+    } else {
+        return source;
+    }
+
+    const qint64 modified = modifiedTime(QFileInfo(subtitlePath));
+    if (modified < 0 || !parser->validateFile(subtitlePath)) {
+        return source;
+    }
+
+    SubtitleParseResult result;
+    const SubtitleTrack track = parser->parseFile(subtitlePath, result);
+    if (!result.success) {
+        return source;
+    }
+
+    source.modifiedTime = modified;
+    source.cues = cueRows(track);
+    return source;
+}
+
+} // namespace Data
+} // namespace EonPlay
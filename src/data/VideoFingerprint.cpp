@@ -0,0 +1,266 @@
+#include "data/VideoFingerprint.h"
+#include <QDataStream>
+#include <QIODevice>
+#include <QLoggingCategory>
+#include <QProcess>
+#include <QStringList>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+Q_LOGGING_CATEGORY(videoFingerprint, "eonplay.data.fingerprint")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+constexpr quint8 FORMAT_VERSION = 1;
+constexpr int HASH_SIZE = 8;                // Low-frequency DCT block and dHash rows
+constexpr double MIN_DETAIL_STDDEV = 6.0;   // Luma levels; flatter frames are not hashed
+constexpr int START_TIMEOUT_MS = 5000;
+constexpr double PI = 3.14159265358979323846;
+
+// cos((2x + 1) u pi / 2N) for the lowest HASH_SIZE frequencies
+const std::array<std::array<double, VideoFingerprint::FRAME_SIZE>, HASH_SIZE>& dctTable()
+{
+    static const auto table = [] {
+        std::array<std::array<double, VideoFingerprint::FRAME_SIZE>, HASH_SIZE> cosines{};
+        for (int u = 0; u < HASH_SIZE; ++u) {
+            for (int x = 0; x < VideoFingerprint::FRAME_SIZE; ++x) {
+                cosines[u][x] = std::cos((2 * x + 1) * u * PI / (2 * VideoFingerprint::FRAME_SIZE));
+            }
+        }
+        return cosines;
+    }();
+    return table;
+}
+
+QByteArray grabFrame(const QString& ffmpegPath, const QString& filePath, qint64 positionMs)
+{
+    constexpr int frameBytes = VideoFingerprint::FRAME_SIZE * VideoFingerprint::FRAME_SIZE;
+
+    // Input seeking lands on the keyframe before the position and decodes up to it
+    const QStringList arguments{
+        "-hide_banner", "-nostats", "-loglevel", "error",
+        "-hwaccel", "auto",
+        "-ss", QString::number(positionMs / 1000.0, 'f', 3),
+        "-i", filePath,
+        "-an", "-sn", "-dn",
+        "-frames:v", "1",
+        "-vf", QString("scale=%1:%1:flags=area,format=gray").arg(VideoFingerprint::FRAME_SIZE),
+        "-f", "rawvideo", "pipe:1"
+    };
+
+    QProcess process;
+    process.start(ffmpegPath, arguments);
+    if (!process.waitForStarted(START_TIMEOUT_MS)) {
+        qCWarning(videoFingerprint) << "Failed to start FFmpeg:" << process.errorString();
+        return QByteArray();
+    }
+    if (!process.waitForFinished(VideoFingerprint::FRAME_TIMEOUT_MS)) {
+        process.kill();
+        process.waitForFinished();
+        return QByteArray();
+    }
+
+    const QByteArray frame = process.readAllStandardOutput();
+    return frame.size() == frameBytes ? frame : QByteArray();
+}
+} // namespace
+
+VideoFingerprint VideoFingerprint::compute(const QString& ffmpegPath, const QString& filePath, qint64 durationMs,
+                                           const std::atomic<bool>* cancelled)
+{
+    VideoFingerprint fingerprint;
+    fingerprint.m_duration = durationMs;
+    if (ffmpegPath.isEmpty() || durationMs <= 0) {
+        return fingerprint;
+    }
+
+    fingerprint.m_frames.resize(SAMPLE_COUNT);
+    for (int i = 0; i < SAMPLE_COUNT; ++i) {
+        if (cancelled && *cancelled) {
+            return VideoFingerprint();
+        }
+
+        // Even fractions, never the very start or end where intros and credits are shared
+        const qint64 position = durationMs * (i + 1) / (SAMPLE_COUNT + 1);
+        const QByteArray luma = grabFrame(ffmpegPath, filePath, position);
+        if (!luma.isEmpty()) {
+            hashFrame(reinterpret_cast<const uchar*>(luma.constData()), &fingerprint.m_frames[i]);
+        }
+    }
+
+    qCDebug(videoFingerprint) << "Fingerprinted" << filePath << fingerprint.validFrames() << "of" << SAMPLE_COUNT
+                              << "frames";
+    return fingerprint;
+}
+
+bool VideoFingerprint::hashFrame(const uchar* luma, Frame* frame)
+{
+    constexpr int pixels = FRAME_SIZE * FRAME_SIZE;
+
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    for (int i = 0; i < pixels; ++i) {
+        sum += luma[i];
+        sumSquares += double(luma[i]) * luma[i];
+    }
+    const double mean = sum / pixels;
+    const double variance = sumSquares / pixels - mean * mean;
+
+    frame->valid = variance >= MIN_DETAIL_STDDEV * MIN_DETAIL_STDDEV;
+    if (!frame->valid) {
+        frame->perceptualHash = 0;
+        frame->differenceHash = 0;
+        return false;
+    }
+
+    frame->perceptualHash = perceptualHash(luma);
+    frame->differenceHash = differenceHash(luma);
+    return true;
+}
+
+quint64 VideoFingerprint::perceptualHash(const uchar* luma)
+{
+    const auto& cosines = dctTable();
+
+    // Separable DCT-II, only the lowest HASH_SIZE frequencies in each direction
+    std::array<std::array<double, HASH_SIZE>, FRAME_SIZE> rows{};
+    for (int y = 0; y < FRAME_SIZE; ++y) {
+        const uchar* row = luma + y * FRAME_SIZE;
+        for (int u = 0; u < HASH_SIZE; ++u) {
+            double coefficient = 0.0;
+            for (int x = 0; x < FRAME_SIZE; ++x) {
+                coefficient += row[x] * cosines[u][x];
+            }
+            rows[y][u] = coefficient;
+        }
+    }
+
+    std::array<double, HASH_SIZE * HASH_SIZE> coefficients{};
+    for (int v = 0; v < HASH_SIZE; ++v) {
+        for (int u = 0; u < HASH_SIZE; ++u) {
+            double coefficient = 0.0;
+            for (int y = 0; y < FRAME_SIZE; ++y) {
+                coefficient += rows[y][u] * cosines[v][y];
+            }
+            coefficients[v * HASH_SIZE + u] = coefficient;
+        }
+    }
+
+    // The DC term is the mean brightness; it takes no part in the median and its bit stays 0
+    std::array<double, HASH_SIZE * HASH_SIZE - 1> ac{};
+    std::copy(coefficients.begin() + 1, coefficients.end(), ac.begin());
+    std::nth_element(ac.begin(), ac.begin() + ac.size() / 2, ac.end());
+    const double median = ac[ac.size() / 2];
+
+    quint64 hash = 0;
+    for (int i = 1; i < HASH_SIZE * HASH_SIZE; ++i) {
+        if (coefficients[i] > median) {
+            hash |= quint64(1) << i;
+        }
+    }
+    return hash;
+}
+
+quint64 VideoFingerprint::differenceHash(const uchar* luma)
+{
+    // Area average down to (HASH_SIZE + 1) x HASH_SIZE cells
+    constexpr int columns = HASH_SIZE + 1;
+    std::array<double, columns * HASH_SIZE> cells{};
+    for (int y = 0; y < FRAME_SIZE; ++y) {
+        const int cellY = y * HASH_SIZE / FRAME_SIZE;
+        for (int x = 0; x < FRAME_SIZE; ++x) {
+            cells[cellY * columns + x * columns / FRAME_SIZE] += luma[y * FRAME_SIZE + x];
+        }
+    }
+
+    // Cells hold different pixel counts across a row, so compare means
+    std::array<int, columns> widths{};
+    for (int x = 0; x < FRAME_SIZE; ++x) {
+        ++widths[x * columns / FRAME_SIZE];
+    }
+
+    quint64 hash = 0;
+    for (int y = 0; y < HASH_SIZE; ++y) {
+        for (int x = 0; x < HASH_SIZE; ++x) {
+            const double left = cells[y * columns + x] / widths[x];
+            const double right = cells[y * columns + x + 1] / widths[x + 1];
+            if (left > right) {
+                hash |= quint64(1) << (y * HASH_SIZE + x);
+            }
+        }
+    }
+    return hash;
+}
+
+QByteArray VideoFingerprint::serialize() const
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << FORMAT_VERSION << m_duration << qint32(m_frames.size());
+    for (const Frame& frame : m_frames) {
+        out << frame.valid << frame.perceptualHash << frame.differenceHash;
+    }
+    return data;
+}
+
+VideoFingerprint VideoFingerprint::deserialize(const QByteArray& data)
+{
+    VideoFingerprint fingerprint;
+    if (data.isEmpty()) {
+        return fingerprint;
+    }
+
+    QDataStream in(data);
+    quint8 version = 0;
+    qint32 count = 0;
+    in >> version >> fingerprint.m_duration >> count;
+    if (version != FORMAT_VERSION || count < 0 || count > SAMPLE_COUNT) {
+        return VideoFingerprint();
+    }
+
+    fingerprint.m_frames.resize(count);
+    for (Frame& frame : fingerprint.m_frames) {
+        in >> frame.valid >> frame.perceptualHash >> frame.differenceHash;
+    }
+    return in.status() == QDataStream::Ok ? fingerprint : VideoFingerprint();
+}
+
+int VideoFingerprint::distance(const VideoFingerprint& other) const
+{
+    const qint64 tolerance = qMax(DURATION_TOLERANCE_MS, qMax(m_duration, other.m_duration) *
+                                                             DURATION_TOLERANCE_PERCENT / 100);
+    if (qAbs(m_duration - other.m_duration) > tolerance) {
+        return -1;
+    }
+
+    int common = 0;
+    int bits = 0;
+    const int count = qMin(m_frames.size(), other.m_frames.size());
+    for (int i = 0; i < count; ++i) {
+        const Frame& a = m_frames[i];
+        const Frame& b = other.m_frames[i];
+        if (a.valid && b.valid) {
+            // Close by both hashes; gradients flip more easily on noise, so the dHash weighs half
+            bits += int(qMax(qPopulationCount(a.perceptualHash ^ b.perceptualHash),
+                             qPopulationCount(a.differenceHash ^ b.differenceHash) / 2));
+            ++common;
+        }
+    }
+
+    if (common < MIN_COMMON_FRAMES) {
+        return -1;
+    }
+    return (bits + common / 2) / common;
+}
+
+int VideoFingerprint::validFrames() const
+{
+    return int(std::count_if(m_frames.begin(), m_frames.end(), [](const Frame& frame) { return frame.valid; }));
+}
+
+} // namespace Data
+} // namespace EonPlay
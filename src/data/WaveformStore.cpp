@@ -0,0 +1,86 @@
+#include "data/WaveformStore.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtEndian>
+
+Q_LOGGING_CATEGORY(waveformStore, "eonplay.data.waveforms")
+
+namespace EonPlay {
+namespace Data {
+
+namespace {
+const int SIZE_PREFIX_BYTES = 8;
+}
+
+WaveformStore::WaveformStore(const QString& directory)
+    : m_directory(directory)
+{
+}
+
+QString WaveformStore::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/waveforms";
+}
+
+bool WaveformStore::store(const QString& mediaPath, qint64 fileSize, const QByteArray& peaks) const
+{
+    const QString path = entryPath(mediaPath);
+    if (!QFileInfo(path).dir().mkpath(".")) {
+        qCWarning(waveformStore) << "Failed to create waveform directory for" << path;
+        return false;
+    }
+
+    char prefix[SIZE_PREFIX_BYTES];
+    qToLittleEndian<qint64>(fileSize, prefix);
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(prefix, SIZE_PREFIX_BYTES) != SIZE_PREFIX_BYTES ||
+        file.write(peaks) != peaks.size() || !file.commit()) {
+        qCWarning(waveformStore) << "Failed to write waveform:" << path;
+        return false;
+    }
+    return true;
+}
+
+QByteArray WaveformStore::load(const QString& mediaPath) const
+{
+    QFile file(entryPath(mediaPath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+
+    const QByteArray prefix = file.read(SIZE_PREFIX_BYTES);
+    if (prefix.size() != SIZE_PREFIX_BYTES ||
+        qFromLittleEndian<qint64>(prefix.constData()) != QFileInfo(mediaPath).size()) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+bool WaveformStore::contains(const QString& mediaPath) const
+{
+    QFile file(entryPath(mediaPath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray prefix = file.read(SIZE_PREFIX_BYTES);
+    return prefix.size() == SIZE_PREFIX_BYTES &&
+           qFromLittleEndian<qint64>(prefix.constData()) == QFileInfo(mediaPath).size();
+}
+
+QString WaveformStore::entryPath(const QString& mediaPath) const
+{
+    const QString hash = QCryptographicHash::hash(mediaPath.toUtf8(), QCryptographicHash::Sha1).toHex();
+
+    // Two levels keep directories small on large libraries
+    return QDir(m_directory).filePath(hash.left(2) + QLatin1Char('/') + hash + ".dat");
+}
+
+} // namespace Data
+} // namespace EonPlay
@@ -0,0 +1,9 @@
+#include "security/SandboxedDecoderWorker.h"
+
+/**
+ * @brief Sandboxed decoder worker entry point
+ */
+int main(int argc, char *argv[])
+{
+    return SandboxedDecoderWorker::run(argc, argv);
+}
@@ -1,10 +1,23 @@
 #include "EonPlayApplication.h"
+#include "EonPlayServer.h"
+#include "ComponentManager.h"
+#include "TraceLog.h"
+#include "PowerPolicy.h"
+#include "SingleInstance.h"
 #include "ui/MainWindow.h"
 #include <QLoggingCategory>
+#include <QEvent>
+#include <QTimer>
 #include <QDir>
 #include <QStandardPaths>
 #include <iostream>
 
+#if defined(Q_OS_WIN)
+#include "platform/WindowsPlatform.h"
+#elif defined(Q_OS_LINUX)
+#include "platform/LinuxPlatform.h"
+#endif
+
 /**
  * @brief Set up application directories and ensure they exist
  */
@@ -34,6 +47,49 @@ void printApplicationInfo()
     std::cout << "Starting application..." << std::endl;
 }
 
+/**
+ * @brief Feed the platform's battery and thermal state to the power policy
+ */
+void startPowerMonitoring(QObject* parent)
+{
+#if defined(Q_OS_WIN) || defined(Q_OS_LINUX)
+#if defined(Q_OS_WIN)
+    using Platform = WindowsPlatform;
+#else
+    using Platform = LinuxPlatform;
+#endif
+    auto* platform = new Platform(parent);
+    QObject::connect(platform, &Platform::powerStatusChanged, &PowerPolicy::instance(), &PowerPolicy::setStatus);
+    platform->startPowerMonitoring();
+#else
+    Q_UNUSED(parent)
+#endif
+}
+
+/**
+ * @brief Marks the first paint of a window in the startup trace
+ */
+class FirstFrameTracer : public QObject
+{
+public:
+    explicit FirstFrameTracer(QObject* window)
+        : QObject(window)
+    {
+        window->installEventFilter(this);
+    }
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override
+    {
+        if (event->type() == QEvent::Paint) {
+            TraceLog::instance().mark("startup.firstFrame");
+            watched->removeEventFilter(this);
+            deleteLater();
+        }
+        return QObject::eventFilter(watched, event);
+    }
+};
+
 /**
  * @brief Main application entry point
  */
@@ -43,8 +99,36 @@ int main(int argc, char *argv[])
     // QApplication::setAttribute(Qt::AA_EnableHighDpiScaling); // Deprecated in Qt6
     // QApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);    // Deprecated in Qt6
     
+    // Media-share boxes run the core components only, without widgets
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--headless") == 0) {
+            return EonPlayServer::run(argc, argv);
+        }
+    }
+    
+    // Start the trace clock before anything else
+    TraceLog::instance();
+    
+    // Video views in every window draw the textures libVLC renders into
+    QApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+    
     // Create application instance
+    TraceScope qtInit("qt.init");
     EonPlayApplication app(argc, argv);
+    qtInit.end();
+    
+    // A launch while EonPlay is running hands its files over and exits
+    // before any component is initialized
+    const bool newInstance = SingleInstance::isNewInstanceRequested(app.arguments());
+    QStringList pendingFiles = SingleInstance::mediaArguments(app.arguments());
+    if (!newInstance && SingleInstance::forwardToRunningInstance(pendingFiles)) {
+        return 0;
+    }
+    
+    SingleInstance singleInstance;
+    if (!newInstance) {
+        singleInstance.listen();
+    }
     
     // Print application information
     printApplicationInfo();
@@ -52,22 +136,74 @@ int main(int argc, char *argv[])
     // Set up application directories
     setupApplicationDirectories();
     
-    // Initialize the application
-    if (!app.initialize()) {
-        qCritical() << "Failed to initialize application";
-        return 1;
-    }
+    // TODO: Get MainWindow from component manager when component system is fully integrated
+    // For now, create and show MainWindow directly
+    MainWindow* mainWindow = nullptr;
+    bool interactive = false;
     
-    // Show main window when application is ready
-    QObject::connect(&app, &EonPlayApplication::applicationReady, [&app]() {
+    // Show main window when application is ready; connected first because
+    // initialize() emits applicationReady when every component succeeds
+    QObject::connect(&app, &EonPlayApplication::applicationReady, [&app, &mainWindow]() {
         qDebug() << "Application ready - showing main window";
-        // TODO: Get MainWindow from component manager when component system is fully integrated
-        // For now, create and show MainWindow directly
-        static MainWindow* mainWindow = new MainWindow();
+        if (mainWindow) {
+            return;
+        }
+        
+        TraceScope windowInit("ui.mainWindow");
+        mainWindow = new MainWindow();
         mainWindow->initialize(app.componentManager());
+        new FirstFrameTracer(mainWindow);
         mainWindow->showWindow();
+        windowInit.end();
+        
+        // Non-critical components start once the window is on screen, then
+        // the side panels are built while the player is idle
+        QObject::connect(app.componentManager(), &ComponentManager::deferredComponentsInitialized,
+                         mainWindow, &MainWindow::warmUpPanels, Qt::QueuedConnection);
+        app.componentManager()->initializeDeferredAfterPaint(mainWindow);
     });
     
+    // Interactive once the window is up and every component has started
+    QObject::connect(app.componentManager(), &ComponentManager::deferredComponentsInitialized, &app,
+                     [&app, &mainWindow, &interactive, &pendingFiles]() {
+        TraceLog::instance().mark("startup.interactive");
+        interactive = true;
+        
+        // Files from the command line, and from launches made during startup,
+        // open once the player can take them
+        if (mainWindow && !pendingFiles.isEmpty()) {
+            mainWindow->openFiles(pendingFiles);
+            pendingFiles.clear();
+        }
+        
+        // Battery and thermal state only matter once something plays
+        startPowerMonitoring(&app);
+        
+        // Set by the startup benchmark
+        if (qEnvironmentVariableIsSet("EONPLAY_EXIT_WHEN_INTERACTIVE")) {
+            QTimer::singleShot(0, &app, &QCoreApplication::quit);
+        }
+    });
+    
+    QObject::connect(&singleInstance, &SingleInstance::launched, &app,
+                     [&mainWindow, &interactive, &pendingFiles](const QStringList& files) {
+        if (!mainWindow || !interactive) {
+            pendingFiles.append(files);
+            return;
+        }
+        mainWindow->showWindow();
+        mainWindow->openFiles(files);
+    });
+    
+    // Initialize the application
+    TraceScope appInit("app.initialize");
+    if (!app.initialize()) {
+        qCritical() << "Failed to initialize application";
+        TraceLog::instance().flush();
+        return 1;
+    }
+    appInit.end();
+    
     qDebug() << "Starting application event loop";
     
     // Start the application event loop
@@ -75,5 +211,7 @@ int main(int argc, char *argv[])
     
     qDebug() << "Application event loop finished with code:" << result;
     
+    TraceLog::instance().flush();
+    
     return result;
 }
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "media/FrameHistory.h"
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QtMath>
+#include <cstring>
+
+Q_DECLARE_LOGGING_CATEGORY(frameHistory)
+Q_LOGGING_CATEGORY(frameHistory, "eonplay.framehistory")
+
+FrameHistory::FrameHistory(qint64 memoryBudget)
+    : m_memoryBudget(memoryBudget)
+    , m_capacity(0)
+    , m_cursor(0)
+    , m_lastSequence(0)
+{
+}
+
+FrameHistory::~FrameHistory() = default;
+
+void FrameHistory::setMemoryBudget(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_memoryBudget = bytes;
+}
+
+qint64 FrameHistory::memoryBudget() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_memoryBudget;
+}
+
+void FrameHistory::videoFrameReady(const VideoFrameRef& frame)
+{
+    if (!frame || frame->width() <= 0 || frame->height() <= 0) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    // Frames presented again from the history carry the sequence they were recorded with
+    if (frame->sequence() <= m_lastSequence) {
+        return;
+    }
+    m_lastSequence = frame->sequence();
+
+    const QSize format(frame->width(), frame->height());
+    if (format != m_format) {
+        reset(format);
+    }
+
+    // A seek or a media change: older frames no longer lead up to this one
+    if (!m_frames.empty()) {
+        const qint64 gap = frame->position() - m_frames.back()->position();
+        if (gap < 0 || gap > DISCONTINUITY_MS) {
+            m_frames.clear();
+        }
+    }
+
+    while (static_cast<int>(m_frames.size()) >= m_capacity) {
+        m_frames.pop_front();
+    }
+
+    // The oldest copy may still be on screen somewhere; then it is dropped and its buffer waited for
+    std::shared_ptr<VideoFrame> copy = m_pool->acquire();
+    if (!copy && !m_frames.empty()) {
+        m_frames.pop_front();
+        copy = m_pool->acquire();
+    }
+    if (!copy) {
+        m_cursor = qMax(0, static_cast<int>(m_frames.size()) - 1);
+        return;
+    }
+
+    const int rowBytes = qMin(frame->bytesPerLine(), copy->bytesPerLine());
+    for (int y = 0; y < frame->height(); ++y) {
+        std::memcpy(copy->bits() + y * copy->bytesPerLine(), frame->bits() + y * frame->bytesPerLine(), rowBytes);
+    }
+    copy->setSequence(frame->sequence());
+    copy->setPosition(frame->position());
+
+    // A newly decoded frame is what is shown, so the cursor follows it
+    m_frames.push_back(std::move(copy));
+    m_cursor = static_cast<int>(m_frames.size()) - 1;
+}
+
+VideoFrameRef FrameHistory::stepBackward()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_frames.empty() || m_cursor <= 0) {
+        return VideoFrameRef();
+    }
+    return m_frames[--m_cursor];
+}
+
+VideoFrameRef FrameHistory::stepForward()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_cursor + 1 >= static_cast<int>(m_frames.size())) {
+        return VideoFrameRef();
+    }
+    return m_frames[++m_cursor];
+}
+
+bool FrameHistory::isAtNewest() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_frames.empty() || m_cursor == static_cast<int>(m_frames.size()) - 1;
+}
+
+VideoFrameRef FrameHistory::current() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_frames.empty() ? VideoFrameRef() : m_frames[m_cursor];
+}
+
+int FrameHistory::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return static_cast<int>(m_frames.size());
+}
+
+qint64 FrameHistory::memoryUsage() const
+{
+    QMutexLocker locker(&m_mutex);
+    return static_cast<qint64>(m_frames.size()) * m_format.width() * m_format.height() * 4;
+}
+
+qint64 FrameHistory::trim(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    const qint64 frameBytes = qint64(m_format.width()) * m_format.height() * 4;
+    const int surplus = static_cast<int>(m_frames.size()) - MIN_FRAMES;
+    if (bytes <= 0 || frameBytes <= 0 || surplus <= 0) {
+        return 0;
+    }
+
+    const int drop = static_cast<int>(qMin<qint64>(surplus, (bytes + frameBytes - 1) / frameBytes));
+    for (int i = 0; i < drop; ++i) {
+        m_frames.pop_front();
+    }
+    m_cursor = qMax(0, m_cursor - drop);
+
+    // Otherwise the next frames would fill the history up again
+    m_capacity = qMax(MIN_FRAMES, static_cast<int>(m_frames.size()));
+    m_pool->setCapacity(m_capacity);
+
+    qCDebug(frameHistory) << "Trimmed to" << m_capacity << "frames";
+    return drop * frameBytes;
+}
+
+void FrameHistory::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_frames.clear();
+    m_cursor = 0;
+    m_lastSequence = 0;     // A new engine counts from the start again
+
+    // The next frame sizes the pool again, from the current budget
+    m_format = QSize();
+}
+
+void FrameHistory::reset(const QSize& format)
+{
+    m_frames.clear();
+    m_cursor = 0;
+    m_format = format;
+
+    const qint64 frameBytes = qMax<qint64>(1, qint64(format.width()) * format.height() * 4);
+    m_capacity = static_cast<int>(qBound<qint64>(MIN_FRAMES, m_memoryBudget / frameBytes, MAX_FRAMES));
+    m_pool = std::make_unique<VideoFramePool>(m_capacity);
+    m_pool->configure(format.width(), format.height());
+
+    qCDebug(frameHistory) << "Keeping" << m_capacity << "frames of" << format;
+}
@@ -1,11 +1,19 @@
 #include "media/HardwareAcceleration.h"
+#include "TraceLog.h"
 #include <QLoggingCategory>
 #include <QProcess>
 #include <QFileInfo>
 #include <QDir>
+#include <QFile>
+#include <QRegularExpression>
 #include <QStandardPaths>
 #include <QSysInfo>
 #include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <QSettings>
+#include <QDateTime>
+#include <QCryptographicHash>
 
 // libVLC includes
 #include <vlc/vlc.h>
@@ -44,15 +52,87 @@
 
 Q_LOGGING_CATEGORY(hwAccel, "mediaplayer.hwaccel")
 
+namespace {
+
+const char* const PROBE_SETTINGS_GROUP = "Media/HardwareAccelerationProbe";
+
+QVariantMap probeEntryToVariant(const HardwareAccelerationInfo& info)
+{
+    QVariantMap entry;
+    entry["type"] = HardwareAcceleration::accelerationTypeToString(info.type);
+    entry["name"] = info.name;
+    entry["description"] = info.description;
+    entry["available"] = info.available;
+    entry["supportedCodecs"] = info.supportedCodecs;
+    entry["driverVersion"] = info.driverVersion;
+    entry["deviceName"] = info.deviceName;
+    return entry;
+}
+
+HardwareAccelerationInfo probeEntryFromVariant(const QVariantMap& entry)
+{
+    HardwareAccelerationInfo info;
+    info.type = HardwareAcceleration::stringToAccelerationType(entry.value("type").toString());
+    info.name = entry.value("name").toString();
+    info.description = entry.value("description").toString();
+    info.available = entry.value("available").toBool();
+    info.supportedCodecs = entry.value("supportedCodecs").toStringList();
+    info.driverVersion = entry.value("driverVersion").toString();
+    info.deviceName = entry.value("deviceName").toString();
+    return info;
+}
+
+bool sameProbe(const QList<HardwareAccelerationInfo>& a, const QList<HardwareAccelerationInfo>& b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    
+    for (int i = 0; i < a.size(); ++i) {
+        if (a[i].type != b[i].type || a[i].available != b[i].available ||
+            a[i].supportedCodecs != b[i].supportedCodecs ||
+            a[i].driverVersion != b[i].driverVersion || a[i].deviceName != b[i].deviceName) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+#ifdef Q_OS_LINUX
+QString readSysfsValue(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    return QString::fromLatin1(file.readAll()).trimmed();
+}
+#endif
+
+} // namespace
+
 HardwareAcceleration::HardwareAcceleration(QObject* parent)
     : QObject(parent)
     , m_preferredAcceleration(HardwareAccelerationType::Auto)
     , m_hardwareAccelerationEnabled(true)
+    , m_hardwareDecodeForced(false)
     , m_initialized(false)
+    , m_probePool(new QThreadPool(this))
+    , m_probeCached(false)
+    , m_revalidating(false)
 {
+    m_probePool->setMaxThreadCount(1);
     qCDebug(hwAccel) << "HardwareAcceleration created";
 }
 
+HardwareAcceleration::~HardwareAcceleration()
+{
+    // A background probe calls back into this object
+    m_probePool->clear();
+    m_probePool->waitForDone();
+}
+
 bool HardwareAcceleration::initialize()
 {
     if (m_initialized) {
@@ -61,6 +141,7 @@ bool HardwareAcceleration::initialize()
     }
     
     qCDebug(hwAccel) << "Initializing hardware acceleration detection";
+    TraceScope trace("hwaccel.detect");
     
     if (!isPlatformSupported()) {
         qCWarning(hwAccel) << "Hardware acceleration not supported on this platform";
@@ -69,8 +150,16 @@ bool HardwareAcceleration::initialize()
         return true;
     }
     
-    // Detect available acceleration methods
-    m_availableAccelerations = detectAvailableAcceleration();
+    // Detect available acceleration methods, or reuse the last probe of
+    // this GPU and driver and confirm it once startup is over
+    m_probeFingerprint = probeFingerprint();
+    if (loadCachedProbe(m_probeFingerprint)) {
+        qCDebug(hwAccel) << "Using cached hardware acceleration probe";
+        scheduleRevalidation();
+    } else {
+        m_availableAccelerations = detectAvailableAcceleration();
+        saveProbe();
+    }
     
     // Log detected accelerations
     qCDebug(hwAccel) << "Detected" << m_availableAccelerations.size() << "hardware acceleration methods:";
@@ -223,6 +312,14 @@ bool HardwareAcceleration::isHardwareAccelerationEnabled() const
     return m_hardwareAccelerationEnabled;
 }
 
+void HardwareAcceleration::setHardwareDecodeForced(bool forced)
+{
+    if (m_hardwareDecodeForced != forced) {
+        m_hardwareDecodeForced = forced;
+        qCDebug(hwAccel) << "Hardware decoding" << (forced ? "forced" : "no longer forced") << "for new media";
+    }
+}
+
 QStringList HardwareAcceleration::getVLCArguments() const
 {
     QStringList args;
@@ -234,12 +331,7 @@ QStringList HardwareAcceleration::getVLCArguments() const
         return args;
     }
     
-    HardwareAccelerationType activeType = m_preferredAcceleration;
-    if (activeType == HardwareAccelerationType::Auto) {
-        activeType = getBestAvailableAcceleration();
-    }
-    
-    switch (activeType) {
+    switch (activeAcceleration()) {
 #ifdef Q_OS_WIN
         case HardwareAccelerationType::DXVA:
             args << "--avcodec-hw=dxva2";
@@ -269,12 +361,56 @@ QStringList HardwareAcceleration::getVLCArguments() const
     return args;
 }
 
+QStringList HardwareAcceleration::getVLCMediaOptions() const
+{
+    if (m_hardwareDecodeForced && !m_hardwareAccelerationEnabled) {
+        switch (activeAcceleration()) {
+#ifdef Q_OS_WIN
+            case HardwareAccelerationType::DXVA:
+                return {":avcodec-hw=dxva2"};
+#endif
+                
+#ifdef Q_OS_LINUX
+            case HardwareAccelerationType::VAAPI:
+                return {":avcodec-hw=vaapi"};
+                
+            case HardwareAccelerationType::VDPAU:
+                return {":avcodec-hw=vdpau"};
+#endif
+                
+            case HardwareAccelerationType::Software:
+            default:
+                break;
+        }
+    }
+    
+    // "--avcodec-hw=vaapi" becomes ":avcodec-hw=vaapi"
+    QStringList options;
+    for (const QString& argument : getVLCArguments()) {
+        options << ":" + argument.mid(2);
+    }
+    return options;
+}
+
 bool HardwareAcceleration::testHardwareAcceleration(const QString& testVideoPath)
 {
     if (!m_hardwareAccelerationEnabled) {
         return false;
     }
     
+    // Playback tests take half a second; their outcome is kept with the probe
+    const QString testKey = QString("tests/%1").arg(accelerationTypeToString(activeAcceleration()));
+    const bool playbackTest = !testVideoPath.isEmpty() && QFileInfo::exists(testVideoPath);
+    if (playbackTest) {
+        QSettings settings;
+        settings.beginGroup(PROBE_SETTINGS_GROUP);
+        if (settings.value("fingerprint").toString() == m_probeFingerprint && settings.contains(testKey)) {
+            const bool cachedResult = settings.value(testKey).toBool();
+            qCDebug(hwAccel) << "Cached hardware acceleration test" << (cachedResult ? "passed" : "failed");
+            return cachedResult;
+        }
+    }
+    
     qCDebug(hwAccel) << "Testing hardware acceleration";
     
     // Create a test libVLC instance with hardware acceleration
@@ -307,7 +443,7 @@ bool HardwareAcceleration::testHardwareAcceleration(const QString& testVideoPath
     bool testPassed = true;
     
     // If a test video is provided, try to load it
-    if (!testVideoPath.isEmpty() && QFileInfo::exists(testVideoPath)) {
+    if (playbackTest) {
         libvlc_media_t* testMedia = libvlc_media_new_path(testInstance, testVideoPath.toUtf8().constData());
         if (testMedia) {
             libvlc_media_player_set_media(testPlayer, testMedia);
@@ -340,9 +476,170 @@ bool HardwareAcceleration::testHardwareAcceleration(const QString& testVideoPath
     libvlc_release(testInstance);
     
     qCDebug(hwAccel) << "Hardware acceleration test" << (testPassed ? "passed" : "failed");
+    
+    if (playbackTest && !m_probeFingerprint.isEmpty()) {
+        QSettings settings;
+        settings.beginGroup(PROBE_SETTINGS_GROUP);
+        if (settings.value("fingerprint").toString() == m_probeFingerprint) {
+            settings.setValue(testKey, testPassed);
+        }
+    }
+    
     return testPassed;
 }
 
+HardwareAccelerationType HardwareAcceleration::activeAcceleration() const
+{
+    if (m_preferredAcceleration == HardwareAccelerationType::Auto) {
+        return getBestAvailableAcceleration();
+    }
+    return m_preferredAcceleration;
+}
+
+QString HardwareAcceleration::probeFingerprint() const
+{
+    QStringList parts;
+    parts << QSysInfo::kernelType() << QSysInfo::kernelVersion()
+          << QString::fromLatin1(libvlc_get_version());
+    
+#ifdef Q_OS_WIN
+    IDirect3D9* d3d9 = Direct3DCreate9(D3D_SDK_VERSION);
+    if (d3d9) {
+        D3DADAPTER_IDENTIFIER9 adapterInfo;
+        if (SUCCEEDED(d3d9->GetAdapterIdentifier(D3DADAPTER_DEFAULT, 0, &adapterInfo))) {
+            parts << QString::fromLatin1(adapterInfo.Description)
+                  << QString::number(adapterInfo.VendorId, 16)
+                  << QString::number(adapterInfo.DeviceId, 16)
+                  << QString::number(adapterInfo.DriverVersion.QuadPart, 16);
+        }
+        d3d9->Release();
+    }
+#endif
+    
+#ifdef Q_OS_LINUX
+    // One line per DRM card: PCI ids, bound driver and its module version
+    static const QRegularExpression cardPattern("^card\\d+$");
+    const QDir drm("/sys/class/drm");
+    const QStringList cards = drm.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (const QString& card : cards) {
+        if (!cardPattern.match(card).hasMatch()) {
+            continue;
+        }
+        
+        const QString devicePath = drm.filePath(card + "/device");
+        const QString driver = QFileInfo(devicePath + "/driver").canonicalFilePath().section('/', -1);
+        parts << QString("%1 %2:%3 %4 %5").arg(card,
+                                                readSysfsValue(devicePath + "/vendor"),
+                                                readSysfsValue(devicePath + "/device"),
+                                                driver,
+                                                readSysfsValue("/sys/module/" + driver + "/version"));
+    }
+#endif
+    
+    return QCryptographicHash::hash(parts.join('\n').toUtf8(), QCryptographicHash::Sha1).toHex();
+}
+
+bool HardwareAcceleration::isProbeCached() const
+{
+    return m_probeCached;
+}
+
+bool HardwareAcceleration::loadCachedProbe(const QString& fingerprint)
+{
+    QSettings settings;
+    settings.beginGroup(PROBE_SETTINGS_GROUP);
+    
+    if (settings.value("fingerprint").toString() != fingerprint) {
+        return false;
+    }
+    
+    QList<HardwareAccelerationInfo> accelerations;
+    const QVariantList entries = settings.value("accelerations").toList();
+    for (const QVariant& entry : entries) {
+        accelerations.append(probeEntryFromVariant(entry.toMap()));
+    }
+    if (accelerations.isEmpty()) {
+        return false;
+    }
+    
+    qCDebug(hwAccel) << "Loaded hardware acceleration probe from"
+                     << settings.value("probedAt").toDateTime().toString(Qt::ISODate);
+    
+    m_availableAccelerations = accelerations;
+    m_probeCached = true;
+    return true;
+}
+
+void HardwareAcceleration::saveProbe() const
+{
+    QVariantList entries;
+    for (const auto& accel : m_availableAccelerations) {
+        entries.append(probeEntryToVariant(accel));
+    }
+    
+    // Rewriting the group drops playback test results of the old probe
+    QSettings settings;
+    settings.remove(PROBE_SETTINGS_GROUP);
+    settings.beginGroup(PROBE_SETTINGS_GROUP);
+    settings.setValue("fingerprint", m_probeFingerprint);
+    settings.setValue("probedAt", QDateTime::currentDateTimeUtc());
+    settings.setValue("accelerations", entries);
+}
+
+void HardwareAcceleration::scheduleRevalidation()
+{
+    // initialize() may run on a worker thread; the timer must live in ours
+    QMetaObject::invokeMethod(this, [this]() {
+        QTimer::singleShot(REVALIDATE_DELAY_MS, this, &HardwareAcceleration::revalidate);
+    }, Qt::QueuedConnection);
+}
+
+void HardwareAcceleration::revalidate()
+{
+    if (m_revalidating) {
+        return;
+    }
+    
+    m_revalidating = true;
+    qCDebug(hwAccel) << "Re-validating cached hardware acceleration probe";
+    
+    m_probePool->start([this]() {
+        const QList<HardwareAccelerationInfo> results = detectAvailableAcceleration();
+        QMetaObject::invokeMethod(this, [this, results]() {
+            applyProbeResults(results);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void HardwareAcceleration::applyProbeResults(const QList<HardwareAccelerationInfo>& results)
+{
+    m_revalidating = false;
+    
+    if (sameProbe(results, m_availableAccelerations)) {
+        qCDebug(hwAccel) << "Cached hardware acceleration probe confirmed";
+        return;
+    }
+    
+    qCInfo(hwAccel) << "Hardware acceleration probe changed since it was cached";
+    
+    const HardwareAccelerationType previousBest = getBestAvailableAcceleration();
+    m_availableAccelerations = results;
+    m_probeCached = false;
+    saveProbe();
+    
+    // The running libVLC instance keeps its arguments; new ones pick this up
+    const HardwareAccelerationType best = getBestAvailableAcceleration();
+    if (best != previousBest) {
+        if (m_preferredAcceleration != HardwareAccelerationType::Auto &&
+            m_preferredAcceleration != HardwareAccelerationType::Software &&
+            !isAccelerationAvailable(m_preferredAcceleration)) {
+            m_preferredAcceleration = best;
+            emit preferredAccelerationChanged(best);
+        }
+        emit accelerationAvailabilityChanged(best != HardwareAccelerationType::Software);
+    }
+}
+
 QString HardwareAcceleration::getAccelerationTypeName(HardwareAccelerationType type)
 {
     switch (type) {
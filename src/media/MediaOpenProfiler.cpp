@@ -0,0 +1,142 @@
+#include "media/MediaOpenProfiler.h"
+#include "TraceLog.h"
+#include <QCoreApplication>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QThread>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(mediaOpenProfiler, "eonplay.media.open")
+
+QString MediaOpenProfile::summary() const
+{
+    QStringList lines;
+    for (const MediaOpenPhase& phase : phases) {
+        lines << QString("%1: %2 ms").arg(QString::fromLatin1(phase.name)).arg(phase.durationUs / 1000.0, 0, 'f', 1);
+    }
+
+    if (isComplete()) {
+        lines << QString("First %1: %2 ms").arg(video ? "frame" : "audio").arg(timeToFirstFrameMs(), 0, 'f', 1);
+    }
+
+    return lines.join('\n');
+}
+
+MediaOpenProfiler& MediaOpenProfiler::instance()
+{
+    static MediaOpenProfiler instance;
+    return instance;
+}
+
+MediaOpenProfiler::MediaOpenProfiler()
+{
+    qRegisterMetaType<MediaOpenProfile>();
+
+    // Signals belong to the main thread, whichever thread got here first
+    if (QCoreApplication* application = QCoreApplication::instance()) {
+        moveToThread(application->thread());
+    }
+}
+
+void MediaOpenProfiler::begin(const QString& path)
+{
+    MediaOpenProfile profile;
+    profile.path = path;
+    profile.startUs = TraceLog::instance().now();
+
+    QMutexLocker locker(&m_mutex);
+
+    // Opens that never rendered must not pile up
+    if (m_pending.size() >= MAX_PENDING && !m_pending.contains(path)) {
+        auto oldest = std::min_element(m_pending.begin(), m_pending.end(),
+                                       [](const MediaOpenProfile& a, const MediaOpenProfile& b) {
+                                           return a.startUs < b.startUs;
+                                       });
+        m_pending.erase(oldest);
+    }
+
+    m_pending.insert(path, profile);
+}
+
+bool MediaOpenProfiler::isPending(const QString& path) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pending.contains(path);
+}
+
+void MediaOpenProfiler::addPhase(const QString& path, const char* name, qint64 startUs, qint64 durationUs)
+{
+    TraceLog::instance().addComplete(QByteArray("open.") + name, "media", startUs, durationUs);
+
+    QMutexLocker locker(&m_mutex);
+    auto profile = m_pending.find(path);
+    if (profile == m_pending.end()) {
+        return;
+    }
+
+    profile->phases.append({QByteArray(name), startUs - profile->startUs, durationUs});
+}
+
+void MediaOpenProfiler::finish(const QString& path, bool video, qint64 atUs)
+{
+    MediaOpenProfile profile;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto pending = m_pending.find(path);
+        if (pending == m_pending.end()) {
+            return;
+        }
+
+        profile = pending.value();
+        m_pending.erase(pending);
+
+        profile.firstFrameUs = atUs - profile.startUs;
+        profile.video = video;
+        m_lastProfile = profile;
+    }
+
+    TraceLog::instance().addComplete("open.firstFrame", "media", profile.startUs, profile.firstFrameUs);
+    qCDebug(mediaOpenProfiler).noquote() << "Opened" << path << "\n" << profile.summary();
+
+    // Direct on the main thread, queued from decoder threads
+    QMetaObject::invokeMethod(this, [this, profile]() {
+        emit profileCompleted(profile);
+    }, Qt::AutoConnection);
+}
+
+void MediaOpenProfiler::abandon(const QString& path)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pending.remove(path);
+}
+
+MediaOpenProfile MediaOpenProfiler::lastProfile() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_lastProfile;
+}
+
+MediaOpenPhaseScope::MediaOpenPhaseScope(const QString& path, const char* name)
+    : m_name(name)
+{
+    if (MediaOpenProfiler::instance().isPending(path)) {
+        m_path = path;
+        m_start = TraceLog::instance().now();
+    }
+}
+
+MediaOpenPhaseScope::~MediaOpenPhaseScope()
+{
+    end();
+}
+
+void MediaOpenPhaseScope::end()
+{
+    if (m_start < 0) {
+        return;
+    }
+
+    MediaOpenProfiler::instance().addPhase(m_path, m_name, m_start, TraceLog::instance().now() - m_start);
+    m_start = -1;
+}
@@ -0,0 +1,468 @@
+#include "media/MediaProbe.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QPromise>
+#include <QSaveFile>
+#include <QSemaphore>
+#include <QStandardPaths>
+#include <QTimer>
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <vlc/vlc.h>
+
+Q_LOGGING_CATEGORY(mediaProbe, "eonplay.mediaprobe")
+
+namespace {
+
+constexpr quint32 CACHE_MAGIC = 0x45504d50;     // "EPMP"
+constexpr quint32 CACHE_VERSION = 1;
+constexpr int PROBE_THREADS = 2;
+
+// Shared by all probes for the life of the process; it never plays anything
+libvlc_instance_t* probeInstance()
+{
+    static libvlc_instance_t* instance = [] {
+        const char* args[] = {
+            "--intf=dummy",
+            "--no-video",
+            "--no-audio",
+            "--no-spu",
+            "--no-stats",
+            "--no-lua",
+            "--no-metadata-network-access"
+        };
+        libvlc_instance_t* created = libvlc_new(sizeof(args) / sizeof(args[0]), args);
+        if (!created) {
+            qCWarning(mediaProbe) << "Failed to create probe instance";
+        }
+        return created;
+    }();
+    return instance;
+}
+
+void onParsedChanged(const libvlc_event_t* event, void* data)
+{
+    Q_UNUSED(event)
+    static_cast<QSemaphore*>(data)->release();
+}
+
+QString codecName(libvlc_track_type_t type, unsigned int codec)
+{
+    const char* description = libvlc_media_get_codec_description(type, codec);
+    if (description && *description) {
+        return QString::fromUtf8(description);
+    }
+
+    // Fall back to the FourCC
+    QByteArray fourcc(4, '\0');
+    for (int i = 0; i < 4; ++i) {
+        fourcc[i] = char((codec >> (8 * i)) & 0xff);
+    }
+    return QString::fromLatin1(fourcc).trimmed();
+}
+
+void writeInfo(QDataStream& stream, const MediaInfo& info)
+{
+    stream << info.title << info.format << info.videoCodec << info.audioCodec
+           << info.duration << info.fileSize << qint32(info.videoBitrate) << qint32(info.audioBitrate)
+           << qint32(info.width) << qint32(info.height) << info.frameRate
+           << qint32(info.audioChannels) << qint32(info.audioSampleRate)
+           << info.hasVideo << info.hasAudio;
+}
+
+void readInfo(QDataStream& stream, MediaInfo* info)
+{
+    qint32 videoBitrate = 0;
+    qint32 audioBitrate = 0;
+    qint32 width = 0;
+    qint32 height = 0;
+    qint32 audioChannels = 0;
+    qint32 audioSampleRate = 0;
+    stream >> info->title >> info->format >> info->videoCodec >> info->audioCodec
+           >> info->duration >> info->fileSize >> videoBitrate >> audioBitrate
+           >> width >> height >> info->frameRate
+           >> audioChannels >> audioSampleRate
+           >> info->hasVideo >> info->hasAudio;
+    info->videoBitrate = videoBitrate;
+    info->audioBitrate = audioBitrate;
+    info->width = width;
+    info->height = height;
+    info->audioChannels = audioChannels;
+    info->audioSampleRate = audioSampleRate;
+    info->isValid = true;
+}
+
+} // namespace
+
+MediaProbe::MediaProbe(const QString& cacheFilePath, QObject* parent)
+    : QObject(parent)
+    , m_cacheFilePath(cacheFilePath)
+    , m_saveTimer(new QTimer(this))
+    , m_useCounter(0)
+    , m_dirty(false)
+    , m_loaded(false)
+    , m_shuttingDown(false)
+{
+    if (m_cacheFilePath.isEmpty()) {
+        m_cacheFilePath = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+                              .absoluteFilePath("media-probe.cache");
+    }
+
+    m_pool.setMaxThreadCount(PROBE_THREADS);
+
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(SAVE_DELAY_MS);
+    connect(m_saveTimer, &QTimer::timeout, this, &MediaProbe::save);
+
+    // Warm the cache before the first lookup needs it
+    m_pool.start([this]() {
+        ensureLoaded();
+    });
+}
+
+MediaProbe::~MediaProbe()
+{
+    m_shuttingDown = true;
+    m_saveTimer->stop();
+    m_pool.waitForDone();
+
+    QHash<QString, Entry> entries;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_dirty) {
+            return;
+        }
+        entries = m_entries;
+        m_dirty = false;
+    }
+    writeCacheFile(m_cacheFilePath, entries);
+}
+
+bool MediaProbe::lookup(const QString& filePath, MediaInfo* info)
+{
+    const QFileInfo fileInfo(filePath);
+    if (!fileInfo.exists()) {
+        return false;
+    }
+    const qint64 modified = fileInfo.lastModified().toMSecsSinceEpoch();
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.find(filePath);
+    if (it == m_entries.end() || it->modified != modified || it->info.fileSize != fileInfo.size()) {
+        return false;
+    }
+    it->lastUse = ++m_useCounter;
+    if (info) {
+        *info = it->info;
+        info->filePath = filePath;
+    }
+    return true;
+}
+
+void MediaProbe::probe(const QString& filePath)
+{
+    MediaInfo info;
+    if (lookup(filePath, &info)) {
+        emit probed(filePath, info);
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_pending.contains(filePath)) {
+            return;
+        }
+        m_pending.insert(filePath);
+    }
+
+    m_pool.start([this, filePath]() {
+        if (m_shuttingDown) {
+            return;
+        }
+        const MediaInfo result = probeSync(filePath);
+        {
+            QMutexLocker locker(&m_mutex);
+            m_pending.remove(filePath);
+        }
+        emit probed(filePath, result);
+    });
+}
+
+MediaInfo MediaProbe::probeSync(const QString& filePath)
+{
+    ensureLoaded();
+
+    MediaInfo info;
+    if (lookup(filePath, &info)) {
+        return info;
+    }
+
+    // Stamp taken before parsing, so a change during the parse is noticed next time
+    const qint64 modified = QFileInfo(filePath).lastModified().toMSecsSinceEpoch();
+    if (parse(filePath, &info)) {
+        store(filePath, info, modified);
+    }
+    return info;
+}
+
+void MediaProbe::clearCache()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_entries.clear();
+        m_dirty = false;
+    }
+    m_save.waitForFinished();
+    QFile::remove(m_cacheFilePath);
+}
+
+bool MediaProbe::parse(const QString& filePath, MediaInfo* result)
+{
+    MediaInfo& info = *result;
+    info.clear();
+
+    const QFileInfo fileInfo(filePath);
+    if (!fileInfo.exists()) {
+        return false;
+    }
+
+    // What the file system tells, kept if libVLC cannot parse the file
+    info.filePath = filePath;
+    info.fileSize = fileInfo.size();
+    info.format = fileInfo.suffix().toUpper();
+    info.title = fileInfo.completeBaseName();
+    info.isValid = true;
+
+    libvlc_instance_t* instance = probeInstance();
+    if (!instance) {
+        return false;
+    }
+
+    libvlc_media_t* media = libvlc_media_new_path(instance, QFile::encodeName(fileInfo.absoluteFilePath()).constData());
+    if (!media) {
+        return false;
+    }
+
+    QSemaphore parsed;
+    libvlc_event_manager_t* events = libvlc_media_event_manager(media);
+    libvlc_event_attach(events, libvlc_MediaParsedChanged, onParsedChanged, &parsed);
+
+    if (libvlc_media_parse_with_options(media, libvlc_media_parse_local, PARSE_TIMEOUT_MS) == 0) {
+        // libVLC enforces the timeout itself; the margin only guards against a lost event
+        if (!parsed.tryAcquire(1, PARSE_TIMEOUT_MS + 1000)) {
+            libvlc_media_parse_stop(media);
+        }
+    }
+    libvlc_event_detach(events, libvlc_MediaParsedChanged, onParsedChanged, &parsed);
+
+    const libvlc_media_parsed_status_t status = libvlc_media_get_parsed_status(media);
+    if (status != libvlc_media_parsed_status_done) {
+        qCDebug(mediaProbe) << "Parsing failed for" << filePath << "status" << status;
+        libvlc_media_release(media);
+        return false;
+    }
+
+    info.duration = qMax<qint64>(0, libvlc_media_get_duration(media));
+
+    if (char* title = libvlc_media_get_meta(media, libvlc_meta_Title)) {
+        const QString metaTitle = QString::fromUtf8(title).trimmed();
+        libvlc_free(title);
+        if (!metaTitle.isEmpty()) {
+            info.title = metaTitle;
+        }
+    }
+
+    // The first audio and video tracks describe the file
+    libvlc_media_track_t** tracks = nullptr;
+    const unsigned int trackCount = libvlc_media_tracks_get(media, &tracks);
+    for (unsigned int i = 0; i < trackCount; ++i) {
+        const libvlc_media_track_t* track = tracks[i];
+        if (track->i_type == libvlc_track_video && !info.hasVideo && track->video) {
+            info.hasVideo = true;
+            info.width = int(track->video->i_width);
+            info.height = int(track->video->i_height);
+            if (track->video->i_frame_rate_den > 0) {
+                info.frameRate = double(track->video->i_frame_rate_num) / track->video->i_frame_rate_den;
+            }
+            info.videoCodec = codecName(libvlc_track_video, track->i_codec);
+            info.videoBitrate = int(track->i_bitrate / 1000);
+        } else if (track->i_type == libvlc_track_audio && !info.hasAudio && track->audio) {
+            info.hasAudio = true;
+            info.audioChannels = int(track->audio->i_channels);
+            info.audioSampleRate = int(track->audio->i_rate);
+            info.audioCodec = codecName(libvlc_track_audio, track->i_codec);
+            info.audioBitrate = int(track->i_bitrate / 1000);
+        }
+    }
+    if (tracks) {
+        libvlc_media_tracks_release(tracks, trackCount);
+    }
+    libvlc_media_release(media);
+
+    return true;
+}
+
+void MediaProbe::store(const QString& filePath, const MediaInfo& info, qint64 modified)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        Entry& entry = m_entries[filePath];
+        entry.info = info;
+        entry.modified = modified;
+        entry.lastUse = ++m_useCounter;
+        m_dirty = true;
+
+        // Trim in steps rather than on every insert once full
+        if (m_entries.size() > CACHE_CAPACITY + CACHE_CAPACITY / 8) {
+            std::vector<quint64> uses;
+            uses.reserve(m_entries.size());
+            for (const Entry& cached : std::as_const(m_entries)) {
+                uses.push_back(cached.lastUse);
+            }
+            const auto cut = uses.begin() + (uses.size() - CACHE_CAPACITY);
+            std::nth_element(uses.begin(), cut, uses.end());
+            const quint64 oldestKept = *cut;
+            for (auto it = m_entries.begin(); it != m_entries.end();) {
+                it = it->lastUse < oldestKept ? m_entries.erase(it) : std::next(it);
+            }
+        }
+    }
+    scheduleSave();
+}
+
+void MediaProbe::ensureLoaded()
+{
+    if (m_loaded) {
+        return;
+    }
+
+    QMutexLocker loadLocker(&m_loadMutex);
+    if (m_loaded) {
+        return;
+    }
+
+    const QHash<QString, Entry> loaded = readCacheFile(m_cacheFilePath);
+    {
+        // Probes that finished meanwhile are newer than the file
+        QMutexLocker locker(&m_mutex);
+        for (auto it = loaded.cbegin(); it != loaded.cend(); ++it) {
+            if (!m_entries.contains(it.key())) {
+                m_entries.insert(it.key(), it.value());
+            }
+        }
+    }
+    m_loaded = true;
+
+    qCDebug(mediaProbe) << "Loaded" << loaded.size() << "cached probes";
+}
+
+void MediaProbe::scheduleSave()
+{
+    // The timer lives on this object's thread
+    QMetaObject::invokeMethod(this, [this]() {
+        if (!m_saveTimer->isActive()) {
+            m_saveTimer->start();
+        }
+    }, Qt::QueuedConnection);
+}
+
+void MediaProbe::save()
+{
+    if (m_shuttingDown) {
+        return;
+    }
+    if (m_save.isRunning()) {
+        m_saveTimer->start();
+        return;
+    }
+
+    QHash<QString, Entry> entries;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_dirty) {
+            return;
+        }
+        entries = m_entries;
+        m_dirty = false;
+    }
+
+    auto promise = std::make_shared<QPromise<void>>();
+    m_save = promise->future();
+    promise->start();
+
+    const QString filePath = m_cacheFilePath;
+    m_pool.start([promise, filePath, entries]() {
+        writeCacheFile(filePath, entries);
+        promise->finish();
+    });
+}
+
+QHash<QString, MediaProbe::Entry> MediaProbe::readCacheFile(const QString& filePath)
+{
+    QHash<QString, Entry> entries;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return entries;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint32 count = 0;
+    stream >> magic >> version >> count;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION || count < 0) {
+        qCDebug(mediaProbe) << "Ignoring probe cache in an unknown format:" << filePath;
+        return entries;
+    }
+
+    entries.reserve(qMin(count, CACHE_CAPACITY));
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString path;
+        Entry entry;
+        stream >> path >> entry.modified;
+        readInfo(stream, &entry.info);
+        if (stream.status() == QDataStream::Ok) {
+            entry.info.filePath = path;
+            entries.insert(path, entry);
+        }
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(mediaProbe) << "Probe cache is truncated:" << filePath;
+    }
+    return entries;
+}
+
+void MediaProbe::writeCacheFile(const QString& filePath, const QHash<QString, Entry>& entries)
+{
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(mediaProbe) << "Cannot write" << filePath << file.errorString();
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << CACHE_MAGIC << CACHE_VERSION << qint32(entries.size());
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+        stream << it.key() << it->modified;
+        writeInfo(stream, it->info);
+    }
+
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        qCWarning(mediaProbe) << "Cannot write" << filePath << file.errorString();
+    }
+}
@@ -0,0 +1,202 @@
+#include "media/PlaybackClock.h"
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+Q_LOGGING_CATEGORY(playbackClock, "eonplay.playbackclock")
+
+PlaybackClock::PlaybackClock(QObject* parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+{
+    m_wallClock.start();
+
+    // Late is fine, but never wake more often than asked for
+    m_timer->setTimerType(Qt::CoarseTimer);
+    connect(m_timer, &QTimer::timeout, this, &PlaybackClock::tick);
+}
+
+PlaybackClock::~PlaybackClock()
+{
+    for (const Subscriber& subscriber : std::as_const(m_subscribers)) {
+        disconnect(subscriber.destroyedConnection);
+    }
+}
+
+void PlaybackClock::update(qint64 mediaTime)
+{
+    QMutexLocker locker(&m_mutex);
+    m_anchorMediaTime = mediaTime;
+    m_anchorWallTime = m_wallClock.elapsed();
+}
+
+void PlaybackClock::reset(qint64 mediaTime)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_anchorMediaTime = mediaTime;
+        m_anchorWallTime = m_wallClock.elapsed();
+    }
+
+    scheduleDiscontinuity();
+}
+
+void PlaybackClock::setRunning(bool running)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_running == running) {
+            return;
+        }
+
+        // Freeze or resume from where the clock is now
+        m_anchorMediaTime = positionLocked();
+        m_anchorWallTime = m_wallClock.elapsed();
+        m_running = running;
+    }
+
+    qCDebug(playbackClock) << "Clock" << (running ? "running" : "stopped") << "at" << position();
+    scheduleDiscontinuity();
+}
+
+void PlaybackClock::setRate(double rate)
+{
+    QMutexLocker locker(&m_mutex);
+    m_anchorMediaTime = positionLocked();
+    m_anchorWallTime = m_wallClock.elapsed();
+    m_rate = rate > 0.0 ? rate : 1.0;
+}
+
+qint64 PlaybackClock::position() const
+{
+    QMutexLocker locker(&m_mutex);
+    return positionLocked();
+}
+
+bool PlaybackClock::isRunning() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_running;
+}
+
+qint64 PlaybackClock::positionLocked() const
+{
+    if (!m_running) {
+        return m_anchorMediaTime;
+    }
+
+    const qint64 elapsed = m_wallClock.elapsed() - m_anchorWallTime;
+    return std::max<qint64>(0, m_anchorMediaTime + std::llround(elapsed * m_rate));
+}
+
+void PlaybackClock::subscribe(QObject* context, int intervalMs, PositionCallback callback)
+{
+    if (!context || !callback) {
+        return;
+    }
+
+    intervalMs = std::max(intervalMs, MIN_INTERVAL_MS);
+    const qint64 now = m_wallClock.elapsed();
+
+    auto existing = std::find_if(m_subscribers.begin(), m_subscribers.end(),
+                                 [context](const Subscriber& subscriber) { return subscriber.context == context; });
+    if (existing != m_subscribers.end()) {
+        existing->intervalMs = intervalMs;
+        existing->callback = std::move(callback);
+        existing->nextDue = now + intervalMs;
+    } else {
+        Subscriber subscriber;
+        subscriber.context = context;
+        subscriber.intervalMs = intervalMs;
+        subscriber.callback = std::move(callback);
+        subscriber.nextDue = now + intervalMs;
+        subscriber.destroyedConnection = connect(context, &QObject::destroyed, this,
+                                                 [this, context]() { unsubscribe(context); });
+        m_subscribers.append(std::move(subscriber));
+    }
+
+    qCDebug(playbackClock) << "Position subscriber" << context << "every" << intervalMs << "ms";
+    updateTimer();
+}
+
+void PlaybackClock::unsubscribe(QObject* context)
+{
+    for (int i = 0; i < m_subscribers.size(); ++i) {
+        if (m_subscribers[i].context == context) {
+            disconnect(m_subscribers[i].destroyedConnection);
+            m_subscribers.removeAt(i);
+            break;
+        }
+    }
+
+    updateTimer();
+}
+
+void PlaybackClock::tick()
+{
+    const qint64 now = m_wallClock.elapsed();
+    const qint64 current = position();
+
+    // Callbacks that fall due within a quarter of the timer interval run on this wakeup
+    const qint64 slack = m_timer->interval() / 4;
+
+    // Collected first, a callback may subscribe or unsubscribe
+    QVector<PositionCallback> due;
+    for (Subscriber& subscriber : m_subscribers) {
+        if (subscriber.nextDue - slack <= now) {
+            subscriber.nextDue = now + subscriber.intervalMs;
+            due.append(subscriber.callback);
+        }
+    }
+
+    for (const PositionCallback& callback : std::as_const(due)) {
+        callback(current);
+    }
+}
+
+void PlaybackClock::notifyAll()
+{
+    const qint64 now = m_wallClock.elapsed();
+    const qint64 current = position();
+
+    QVector<PositionCallback> callbacks;
+    callbacks.reserve(m_subscribers.size());
+    for (Subscriber& subscriber : m_subscribers) {
+        subscriber.nextDue = now + subscriber.intervalMs;
+        callbacks.append(subscriber.callback);
+    }
+
+    for (const PositionCallback& callback : std::as_const(callbacks)) {
+        callback(current);
+    }
+
+    emit discontinuity(current);
+}
+
+void PlaybackClock::updateTimer()
+{
+    if (m_subscribers.isEmpty() || !isRunning()) {
+        m_timer->stop();
+        return;
+    }
+
+    int interval = std::numeric_limits<int>::max();
+    for (const Subscriber& subscriber : std::as_const(m_subscribers)) {
+        interval = std::min(interval, subscriber.intervalMs);
+    }
+
+    if (!m_timer->isActive() || m_timer->interval() != interval) {
+        m_timer->start(interval);
+    }
+}
+
+void PlaybackClock::scheduleDiscontinuity()
+{
+    // Direct on the clock's thread, queued from decoder threads
+    QMetaObject::invokeMethod(this, [this]() {
+        notifyAll();
+        updateTimer();
+    }, Qt::AutoConnection);
+}
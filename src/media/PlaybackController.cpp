@@ -1,8 +1,16 @@
 #include "media/PlaybackController.h"
+#include "media/SeekThumbnailService.h"
+#include "CacheBudget.h"
 #include <QLoggingCategory>
 #include <QDebug>
 #include <QHash>
+#include <QBuffer>
+#include <QFileInfo>
+#include <QUrl>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
 
 Q_LOGGING_CATEGORY(playbackController, "eonplay.playbackcontroller")
 
@@ -17,22 +25,58 @@ PlaybackController::PlaybackController(QObject* parent)
     , m_fastSeekSpeed(1)
     , m_fastSeekForward(true)
     , m_fastSeekTimer(new QTimer(this))
+    , m_fastSeekPosition(0)
+    , m_trickPlayBucket(-1)
+    , m_seekTimeoutTimer(new QTimer(this))
+    , m_seekInFlight(false)
+    , m_seekTarget(0)
+    , m_pendingSeekPosition(-1)
+    , m_pendingSeekPrecise(true)
+    , m_loadStartPosition(-1)
     , m_crossfadeEnabled(false)
     , m_crossfadeDuration(3000)
     , m_crossfadeTimer(new QTimer(this))
     , m_crossfadeActive(false)
     , m_gaplessPlayback(false)
+    , m_resumeStore(nullptr)
+    , m_seekIndexStore(nullptr)
+    , m_prefetchCache(nullptr)
     , m_seekThumbnailEnabled(true)
+    , m_thumbnailService(new SeekThumbnailService(this))
+    , m_frameHistory(std::make_unique<FrameHistory>())
 {
     // Set up fast seek timer
     m_fastSeekTimer->setSingleShot(false);
     m_fastSeekTimer->setInterval(FAST_SEEK_INTERVAL_MS);
     connect(m_fastSeekTimer, &QTimer::timeout, this, &PlaybackController::onFastSeekTimer);
     
+    // Engines that never report a landed seek do not stall the schedule
+    m_seekTimeoutTimer->setSingleShot(true);
+    m_seekTimeoutTimer->setInterval(SEEK_TIMEOUT_MS);
+    connect(m_seekTimeoutTimer, &QTimer::timeout, this, [this]() { onEngineSeekCompleted(-1); });
+    
     // Set up crossfade timer
     m_crossfadeTimer->setSingleShot(true);
     connect(m_crossfadeTimer, &QTimer::timeout, this, &PlaybackController::onCrossfadeTimer);
     
+    // Seek previews are decoded off the UI thread
+    connect(m_thumbnailService, &SeekThumbnailService::thumbnailReady,
+            this, &PlaybackController::onThumbnailReady);
+    
+    // Older frames are only wanted for stepping back, so they go before other caches
+    FrameHistory* history = m_frameHistory.get();
+    CacheBudget::instance().registerCache(
+        "frame_history", CacheBudget::Priority::Low, this, [history] { return history->memoryUsage(); },
+        [history](qint64 bytes) { return history->trim(bytes); });
+    
+    // Only opens of the current media; preloads and previews are not reported
+    connect(&MediaOpenProfiler::instance(), &MediaOpenProfiler::profileCompleted,
+            this, [this](const MediaOpenProfile& profile) {
+        if (profile.path == m_currentMediaPath) {
+            emit mediaOpenProfiled(profile);
+        }
+    });
+    
     qCDebug(playbackController) << "PlaybackController created";
 }
 
@@ -71,6 +115,7 @@ void PlaybackController::shutdown()
     // Stop any active timers
     m_fastSeekTimer->stop();
     m_crossfadeTimer->stop();
+    resetSeekSchedule();
     
     // Save resume positions if enabled
     // This would typically be handled by the settings manager
@@ -115,6 +160,14 @@ void PlaybackController::play()
         return;
     }
     
+    // Resume from the frame stepped back to, not from where decoding stopped
+    if (!m_frameHistory->isAtNewest()) {
+        const VideoFrameRef frame = m_frameHistory->current();
+        if (frame) {
+            seek(frame->position());
+        }
+    }
+    
     qCDebug(playbackController) << "Starting playback";
     m_mediaEngine->play();
 }
@@ -178,16 +231,118 @@ void PlaybackController::seek(qint64 position)
         return;
     }
     
+    position = clampSeekPosition(position);
+    
+    qCDebug(playbackController) << "Seeking to position:" << position;
+    m_frameHistory->clear();
+    requestSeek(position, true);
+}
+
+void PlaybackController::scrub(qint64 position)
+{
+    if (!m_mediaEngine) {
+        qCWarning(playbackController) << "Cannot scrub: No media engine available";
+        return;
+    }
+    
+    m_frameHistory->clear();
+    requestSeek(clampSeekPosition(position), false);
+}
+
+qint64 PlaybackController::clampSeekPosition(qint64 position) const
+{
     // Clamp position to valid range
     qint64 duration = m_mediaEngine->duration();
     if (duration > 0) {
-        position = std::clamp(position, 0LL, duration);
+        return std::clamp(position, 0LL, duration);
+    }
+    return std::max(0LL, position);
+}
+
+void PlaybackController::requestSeek(qint64 position, bool precise)
+{
+    // Each engine seek flushes and re-decodes; queueing them only delays the last one
+    if (m_seekInFlight) {
+        m_pendingSeekPosition = position;
+        m_pendingSeekPrecise = precise;
+        return;
+    }
+    
+    m_seekInFlight = true;
+    m_seekTarget = position;
+    m_seekTimeoutTimer->start();
+    if (precise) {
+        m_mediaEngine->seek(position);
     } else {
-        position = std::max(0LL, position);
+        m_mediaEngine->seekFast(position);
+    }
+}
+
+void PlaybackController::onEngineSeekCompleted(qint64 position)
+{
+    if (!m_seekInFlight) {
+        return;
     }
     
-    qCDebug(playbackController) << "Seeking to position:" << position;
-    m_mediaEngine->seek(position);
+    if (position < 0) {
+        qCDebug(playbackController) << "No landing reported for seek to" << m_seekTarget;
+    }
+    
+    m_seekTimeoutTimer->stop();
+    m_seekInFlight = false;
+    
+    if (m_pendingSeekPosition >= 0 && m_mediaEngine) {
+        const qint64 next = m_pendingSeekPosition;
+        m_pendingSeekPosition = -1;
+        requestSeek(next, m_pendingSeekPrecise);
+    }
+}
+
+void PlaybackController::applySeekIndex(const QString& path)
+{
+    if (!m_seekIndexStore || !m_mediaEngine) {
+        return;
+    }
+    
+    QString filePath = path;
+    if (!QFileInfo(filePath).isFile()) {
+        const QUrl url(path);
+        if (!url.isLocalFile() || !QFileInfo(url.toLocalFile()).isFile()) {
+            return;
+        }
+        filePath = url.toLocalFile();
+    }
+    
+    // A null index also drops one the engine may still hold for the path
+    std::shared_ptr<const SeekIndex> index = m_seekIndexStore->seekIndex(filePath);
+    m_mediaEngine->setSeekIndex(path, index);
+    if (index) {
+        return;
+    }
+    
+    // First play: seeks use the index as soon as it is built, if the engine can
+    m_seekIndexStore->requestSeekIndex(filePath, this, [this, path](std::shared_ptr<const SeekIndex> built) {
+        if (m_mediaEngine && (path == m_currentMediaPath || path == m_nextMediaPath)) {
+            m_mediaEngine->setSeekIndex(path, std::move(built));
+        }
+    });
+}
+
+void PlaybackController::applyPrefetchedCopy(const QString& path)
+{
+    if (!m_prefetchCache || !m_mediaEngine) {
+        return;
+    }
+    
+    // An invalid copy also drops one the engine may still hold
+    m_mediaEngine->setPrefetchedCopy(path, m_prefetchCache->prefetchedCopy(path));
+}
+
+void PlaybackController::resetSeekSchedule()
+{
+    m_seekTimeoutTimer->stop();
+    m_seekInFlight = false;
+    m_pendingSeekPosition = -1;
 }
 
 void PlaybackController::seekForward(qint64 milliseconds)
@@ -197,7 +352,7 @@ void PlaybackController::seekForward(qint64 milliseconds)
         return;
     }
     
-    qint64 currentPosition = m_mediaEngine->position();
+    qint64 currentPosition = position();
     qint64 newPosition = currentPosition + milliseconds;
     
     qCDebug(playbackController) << "Seeking forward by" << milliseconds << "ms";
@@ -211,7 +366,7 @@ void PlaybackController::seekBackward(qint64 milliseconds)
         return;
     }
     
-    qint64 currentPosition = m_mediaEngine->position();
+    qint64 currentPosition = position();
     qint64 newPosition = currentPosition - milliseconds;
     
     qCDebug(playbackController) << "Seeking backward by" << milliseconds << "ms";
@@ -363,6 +518,15 @@ qint64 PlaybackController::position() const
         return 0;
     }
     
+    if (m_fastSeekActive) {
+        return m_fastSeekPosition;
+    }
+    
+    // Relative seeks add up while the engine is still on its way
+    if (m_seekInFlight) {
+        return m_pendingSeekPosition >= 0 ? m_pendingSeekPosition : m_seekTarget;
+    }
+    
     return m_mediaEngine->position();
 }
 
@@ -419,6 +583,9 @@ void PlaybackController::loadMedia(const QString& path)
     
     qCDebug(playbackController) << "Loading media:" << path;
     
+    MediaOpenProfiler::instance().begin(path);
+    MediaOpenPhaseScope preparePhase(path, "controller.prepare");
+    
     // Save resume position for previous media if it was playing
     if (!m_currentMediaPath.isEmpty() && hasMedia()) {
         saveResumePosition(m_currentMediaPath);
@@ -429,28 +596,62 @@ void PlaybackController::loadMedia(const QString& path)
         stopFastSeek();
     }
     
-    // Clear thumbnail cache for new media
-    m_thumbnailCache.clear();
+    resetSeekSchedule();
     
+    // Stop previews for the old media; its sprite sheet is saved
+    m_thumbnailService->clear();
+    m_frameHistory->clear();
+    
+    m_crossfadeTimer->stop();
+    m_crossfadeActive = false;
+    m_beatGrid = path == m_nextMediaPath ? m_nextBeatGrid : BeatGrid();
+    if (path == m_nextMediaPath) {
+        m_nextMediaPath.clear();
+        m_nextBeatGrid = BeatGrid();
+    }
+    m_preloadRequestedPath.clear();
+    
+    // The engine takes over a preloaded path without re-opening it
     m_currentMediaPath = path;
+    applySeekIndex(path);
+    applyPrefetchedCopy(path);
+    preparePhase.end();
     bool success = m_mediaEngine->loadMedia(path);
+    const qint64 startPosition = std::exchange(m_loadStartPosition, -1);
     
     if (success) {
         qCDebug(playbackController) << "Media loaded successfully";
         
         // Try to load resume position after a short delay to ensure media is ready
-        QTimer::singleShot(100, this, [this, path]() {
+        QTimer::singleShot(100, this, [this, path, startPosition]() {
             if (m_currentMediaPath == path) {
-                loadResumePosition(path);
+                MediaOpenPhaseScope resumePhase(path, "controller.resume");
+                if (startPosition >= 0) {
+                    seek(startPosition);
+                } else {
+                    loadResumePosition(path);
+                }
             }
         });
     } else {
         qCWarning(playbackController) << "Failed to load media";
+        MediaOpenProfiler::instance().abandon(path);
     }
     
     emit mediaLoaded(success, path);
 }
 
+void PlaybackController::loadMediaAt(const QString& path, qint64 position)
+{
+    if (path == m_currentMediaPath && hasMedia()) {
+        seek(position);
+        return;
+    }
+    
+    m_loadStartPosition = qMax<qint64>(0, position);
+    loadMedia(path);
+}
+
 void PlaybackController::connectEngineSignals()
 {
     if (!m_mediaEngine) {
@@ -469,6 +670,16 @@ void PlaybackController::connectEngineSignals()
             this, &PlaybackController::onEngineError);
     connect(m_mediaEngine.get(), &IMediaEngine::mediaLoaded,
             this, &PlaybackController::onEngineMediaLoaded);
+    connect(m_mediaEngine.get(), &IMediaEngine::preloadedMediaStarted,
+            this, &PlaybackController::onEnginePreloadedMediaStarted);
+    connect(m_mediaEngine.get(), &IMediaEngine::seekCompleted,
+            this, &PlaybackController::onEngineSeekCompleted);
+    
+    // Steady progress for positionChanged() and track transitions
+    m_mediaEngine->subscribePosition(this, POSITION_UPDATE_INTERVAL_MS,
+                                     [this](qint64 position) { onEnginePositionChanged(position); });
+    
+    m_mediaEngine->addVideoFrameSink(m_frameHistory.get());
 }
 
 void PlaybackController::disconnectEngineSignals()
@@ -477,7 +688,28 @@ void PlaybackController::disconnectEngineSignals()
         return;
     }
     
+    m_mediaEngine->removeVideoFrameSink(m_frameHistory.get());
+    m_frameHistory->clear();
+    m_mediaEngine->unsubscribePosition(this);
     disconnect(m_mediaEngine.get(), nullptr, this, nullptr);
+    resetSeekSchedule();
+}
+
+void PlaybackController::subscribePosition(QObject* context, int intervalMs, std::function<void(qint64)> callback)
+{
+    if (!m_mediaEngine) {
+        qCWarning(playbackController) << "Cannot subscribe to position: No media engine available";
+        return;
+    }
+    
+    m_mediaEngine->subscribePosition(context, intervalMs, std::move(callback));
+}
+
+void PlaybackController::unsubscribePosition(QObject* context)
+{
+    if (m_mediaEngine) {
+        m_mediaEngine->unsubscribePosition(context);
+    }
 }
 
 int PlaybackController::clampVolume(int volume) const
@@ -498,15 +730,37 @@ void PlaybackController::onEngineStateChanged(PlaybackState state)
 
 void PlaybackController::onEnginePositionChanged(qint64 position)
 {
+    updateTransition(position);
     emit positionChanged(position);
 }
 
 void PlaybackController::onEngineDurationChanged(qint64 duration)
 {
     qCDebug(playbackController) << "Engine duration changed to:" << duration;
+    
+    if (duration > 0 && m_seekThumbnailEnabled && !m_currentMediaPath.isEmpty()) {
+        m_thumbnailService->setMedia(m_currentMediaPath, duration);
+    }
+    
     emit durationChanged(duration);
 }
 
+void PlaybackController::onThumbnailReady(qint64 position, const QImage& thumbnail)
+{
+    if (!m_seekThumbnailEnabled || thumbnail.isNull()) {
+        return;
+    }
+    
+    emit seekThumbnailReady(position, thumbnail);
+    
+    // Legacy listeners get the base64 form
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    thumbnail.save(&buffer, "PNG");
+    emit seekThumbnailGenerated(position, QString::fromLatin1(png.toBase64()));
+}
+
 void PlaybackController::onEngineVolumeChanged(int volume)
 {
     qCDebug(playbackController) << "Engine volume changed to:" << volume;
@@ -535,6 +789,74 @@ void PlaybackController::onEngineMediaLoaded(bool success)
     emit mediaLoaded(success, m_currentMediaPath);
 }
 
+void PlaybackController::onEnginePreloadedMediaStarted(const QString& path)
+{
+    qCDebug(playbackController) << "Continued with next media:" << path;
+    
+    // The previous media played to its end (or into the crossfade)
+    if (!m_currentMediaPath.isEmpty()) {
+        clearResumePosition(m_currentMediaPath);
+    }
+    
+    m_thumbnailService->clear();
+    m_currentMediaPath = path;
+    m_beatGrid = m_nextMediaPath == path ? m_nextBeatGrid : BeatGrid();
+    m_nextBeatGrid = BeatGrid();
+    if (m_nextMediaPath == path) {
+        m_nextMediaPath.clear();
+    }
+    m_preloadRequestedPath.clear();
+    
+    emit nextMediaStarted(path);
+    emit mediaLoaded(true, path);
+}
+
+void PlaybackController::updateTransition(qint64 position)
+{
+    if (!m_mediaEngine || m_nextMediaPath.isEmpty() || m_crossfadeActive) {
+        return;
+    }
+    
+    if (!m_gaplessPlayback && !m_crossfadeEnabled) {
+        return;
+    }
+    
+    const qint64 totalDuration = m_mediaEngine->duration();
+    if (totalDuration <= 0) {
+        return;
+    }
+    
+    const qint64 remaining = totalDuration - position;
+    int fadeMs = 0;
+    const qint64 fadeStart = m_crossfadeEnabled ? crossfadeStart(totalDuration, fadeMs) : totalDuration;
+    const qint64 overlap = totalDuration - fadeStart;
+    
+    // Open the next media early enough to be buffered when it is needed
+    if (remaining <= PRELOAD_LEAD_MS + overlap && m_preloadRequestedPath != m_nextMediaPath) {
+        m_preloadRequestedPath = m_nextMediaPath;
+        applySeekIndex(m_nextMediaPath);
+        applyPrefetchedCopy(m_nextMediaPath);
+        if (!m_mediaEngine->preloadMedia(m_nextMediaPath)) {
+            qCDebug(playbackController) << "Engine cannot preload, next media opens on demand";
+        }
+    }
+    
+    // Gapless transitions are swapped by the engine at end of stream; crossfades start here
+    if (m_crossfadeEnabled && remaining > 0 && position >= fadeStart &&
+        m_mediaEngine->state() == PlaybackState::Playing &&
+        m_mediaEngine->preloadedMedia() == m_nextMediaPath) {
+        const int fade = static_cast<int>(qMin<qint64>(fadeMs, remaining));
+        qCDebug(playbackController) << "Starting crossfade over" << fade << "ms";
+        
+        m_crossfadeActive = true;
+        m_crossfadeTimer->start(fade);
+        if (!m_mediaEngine->switchToPreloadedMedia(fade)) {
+            m_crossfadeTimer->stop();
+            m_crossfadeActive = false;
+        }
+    }
+}
+
 // Advanced playback features implementation
 
 void PlaybackController::startFastForward(SeekSpeed speed)
@@ -546,6 +868,12 @@ void PlaybackController::startFastForward(SeekSpeed speed)
     
     qCDebug(playbackController) << "Starting fast forward at" << static_cast<int>(speed) << "x speed";
     
+    // A change of speed or direction carries on from the trick-play position
+    if (!m_fastSeekActive) {
+        m_fastSeekPosition = position();
+        m_trickPlayBucket = -1;
+    }
+    m_fastSeekClock.start();
     m_fastSeekActive = true;
     m_fastSeekForward = true;
     m_fastSeekSpeed = static_cast<int>(speed);
@@ -568,6 +896,11 @@ void PlaybackController::startRewind(SeekSpeed speed)
     
     qCDebug(playbackController) << "Starting rewind at" << static_cast<int>(speed) << "x speed";
     
+    if (!m_fastSeekActive) {
+        m_fastSeekPosition = position();
+        m_trickPlayBucket = -1;
+    }
+    m_fastSeekClock.start();
     m_fastSeekActive = true;
     m_fastSeekForward = false;
     m_fastSeekSpeed = static_cast<int>(speed);
@@ -591,8 +924,12 @@ void PlaybackController::stopFastSeek()
     
     m_fastSeekTimer->stop();
     m_fastSeekActive = false;
+    m_trickPlayBucket = -1;
     
-    // Resume normal playback
+    // Normal decoding picks up where trick play landed
+    if (m_mediaEngine && hasMedia()) {
+        seek(m_fastSeekPosition);
+    }
     play();
     
     emit fastSeekChanged(false, 1);
@@ -605,9 +942,6 @@ void PlaybackController::stepForward()
         return;
     }
     
-    qint64 currentPos = position();
-    qint64 newPos = currentPos + FRAME_STEP_MS;
-    
     qCDebug(playbackController) << "Stepping forward one frame";
     
     // Pause playback for frame stepping
@@ -615,7 +949,12 @@ void PlaybackController::stepForward()
         pause();
     }
     
-    seek(newPos);
+    // Back toward the newest frame from memory, then one decoded frame at a time
+    if (presentHistoryFrame(m_frameHistory->stepForward()) || m_mediaEngine->stepFrame()) {
+        return;
+    }
+    
+    seek(position() + FRAME_STEP_MS);
 }
 
 void PlaybackController::stepBackward()
@@ -625,9 +964,6 @@ void PlaybackController::stepBackward()
         return;
     }
     
-    qint64 currentPos = position();
-    qint64 newPos = currentPos - FRAME_STEP_MS;
-    
     qCDebug(playbackController) << "Stepping backward one frame";
     
     // Pause playback for frame stepping
@@ -635,7 +971,28 @@ void PlaybackController::stepBackward()
         pause();
     }
     
-    seek(newPos);
+    if (presentHistoryFrame(m_frameHistory->stepBackward())) {
+        return;
+    }
+    
+    // Past the oldest kept frame: an approximate step by time
+    seek(position() - FRAME_STEP_MS);
+}
+
+void PlaybackController::setFrameHistoryBudget(qint64 bytes)
+{
+    m_frameHistory->setMemoryBudget(bytes);
+}
+
+bool PlaybackController::presentHistoryFrame(const VideoFrameRef& frame)
+{
+    if (!frame) {
+        return false;
+    }
+    
+    m_mediaEngine->presentVideoFrame(frame);
+    emit positionChanged(frame->position());
+    return true;
 }
 
 void PlaybackController::setPlaybackMode(PlaybackMode mode)
@@ -661,6 +1018,12 @@ void PlaybackController::setCrossfadeEnabled(bool enabled, int duration)
     m_crossfadeEnabled = enabled;
     m_crossfadeDuration = std::max(500, std::min(10000, duration)); // Clamp between 0.5-10 seconds
     
+    // Without either mode the engine must not move on by itself
+    if (!m_crossfadeEnabled && !m_gaplessPlayback && m_mediaEngine) {
+        m_mediaEngine->clearPreloadedMedia();
+        m_preloadRequestedPath.clear();
+    }
+    
     emit crossfadeChanged(m_crossfadeEnabled, m_crossfadeDuration);
 }
 
@@ -673,35 +1036,99 @@ void PlaybackController::setGaplessPlayback(bool enabled)
     qCDebug(playbackController) << "Setting gapless playback:" << enabled;
     
     m_gaplessPlayback = enabled;
+    
+    if (!m_gaplessPlayback && !m_crossfadeEnabled && m_mediaEngine) {
+        m_mediaEngine->clearPreloadedMedia();
+        m_preloadRequestedPath.clear();
+    }
+    
     emit gaplessPlaybackChanged(enabled);
 }
 
+void PlaybackController::setNextMedia(const QString& path)
+{
+    if (m_nextMediaPath == path) {
+        return;
+    }
+    
+    qCDebug(playbackController) << "Next media:" << path;
+    
+    // A different item was preloaded; drop it so the engine does not continue with it
+    if (m_mediaEngine && !m_mediaEngine->preloadedMedia().isEmpty() &&
+        m_mediaEngine->preloadedMedia() != path) {
+        m_mediaEngine->clearPreloadedMedia();
+    }
+    
+    m_nextMediaPath = path;
+    m_nextBeatGrid = BeatGrid();
+    m_preloadRequestedPath.clear();
+}
+
+void PlaybackController::setBeatGrid(double bpm, double firstBeatMs)
+{
+    m_beatGrid.bpm = qMax(0.0, bpm);
+    m_beatGrid.firstBeatMs = firstBeatMs;
+}
+
+void PlaybackController::setNextBeatGrid(double bpm, double firstBeatMs)
+{
+    m_nextBeatGrid.bpm = qMax(0.0, bpm);
+    m_nextBeatGrid.firstBeatMs = firstBeatMs;
+}
+
+qint64 PlaybackController::crossfadeStart(qint64 totalDuration, int& fadeMs) const
+{
+    fadeMs = m_crossfadeDuration;
+    if (m_beatGrid.bpm <= 0.0) {
+        return totalDuration - fadeMs;
+    }
+    
+    // Whole beats, ending no later than the current media does
+    const double beatMs = 60000.0 / m_beatGrid.bpm;
+    const int beats = qMax(1, qRound(m_crossfadeDuration / beatMs));
+    fadeMs = static_cast<int>(beats * beatMs);
+    
+    // Latest beat of ours that the next media's first beat can land on
+    const double leadIn = m_nextBeatGrid.bpm > 0.0 ? m_nextBeatGrid.firstBeatMs : 0.0;
+    const double latest = totalDuration - fadeMs + leadIn;
+    if (latest < m_beatGrid.firstBeatMs) {
+        return totalDuration - fadeMs;
+    }
+    const double beat = m_beatGrid.firstBeatMs +
+                        std::floor((latest - m_beatGrid.firstBeatMs) / beatMs) * beatMs;
+    return static_cast<qint64>(beat - leadIn);
+}
+
 void PlaybackController::saveResumePosition(const QString& filePath)
 {
-    if (filePath.isEmpty() || !hasMedia()) {
+    if (filePath.isEmpty() || !hasMedia() || !m_resumeStore) {
         return;
     }
     
     qint64 currentPos = position();
     qint64 totalDuration = duration();
     
-    // Only save if we're not at the beginning or very close to the end
-    if (currentPos > 5000 && currentPos < (totalDuration - 10000)) {
-        m_resumePositions[filePath] = currentPos;
-        qCDebug(playbackController) << "Saved resume position for" << filePath << "at" << currentPos;
+    // Very close to the end counts as finished; near the beginning is saved
+    // as progress but not resumed from
+    if (totalDuration > 0 && currentPos >= totalDuration - RESUME_END_MARGIN_MS) {
+        m_resumeStore->clearResumePosition(filePath);
     } else {
-        // Remove resume position if at beginning or end
-        m_resumePositions.remove(filePath);
+        m_resumeStore->saveResumePosition(filePath, currentPos, totalDuration);
+        qCDebug(playbackController) << "Saved resume position for" << filePath << "at" << currentPos;
     }
 }
 
 bool PlaybackController::loadResumePosition(const QString& filePath)
 {
-    if (filePath.isEmpty() || !m_resumePositions.contains(filePath)) {
+    if (filePath.isEmpty() || !m_resumeStore) {
+        return false;
+    }
+    
+    const qint64 resumePos = m_resumeStore->resumePosition(filePath);
+    if (resumePos <= RESUME_MIN_POSITION_MS) {
         return false;
     }
     
-    qint64 resumePos = m_resumePositions[filePath];
     qCDebug(playbackController) << "Loading resume position for" << filePath << "at" << resumePos;
     
     seek(resumePos);
@@ -710,51 +1137,39 @@ bool PlaybackController::loadResumePosition(const QString& filePath)
 
 void PlaybackController::clearResumePosition(const QString& filePath)
 {
-    if (m_resumePositions.remove(filePath)) {
+    if (!filePath.isEmpty() && m_resumeStore) {
+        m_resumeStore->clearResumePosition(filePath);
         qCDebug(playbackController) << "Cleared resume position for" << filePath;
     }
 }
 
-QString PlaybackController::generateSeekThumbnail(qint64 position)
+QImage PlaybackController::seekThumbnail(qint64 position)
 {
     if (!m_seekThumbnailEnabled || !hasMedia() || !m_mediaEngine) {
-        return QString();
-    }
-    
-    // Check cache first
-    if (m_thumbnailCache.contains(position)) {
-        return m_thumbnailCache[position];
+        return QImage();
     }
     
     // Only generate thumbnails for video content
     if (!m_mediaEngine->hasVideo()) {
-        return QString();
-    }
-    
-    // Try to get frame from media engine
-    QString thumbnail = m_mediaEngine->getVideoFrame(position);
-    
-    if (thumbnail.isEmpty()) {
-        // Fallback to placeholder if engine doesn't support frame extraction
-        thumbnail = "iVBORw0KGgoAAAANSUhEUgAAAAEAAAABCAYAAAAfFcSJAAAADUlEQVR42mNkYPhfDwAChwGA60e6kgAAAABJRU5ErkJggg==";
+        return QImage();
     }
     
-    // Cache the thumbnail
-    m_thumbnailCache[position] = thumbnail;
-    
-    // Limit cache size to prevent memory issues
-    if (m_thumbnailCache.size() > 100) {
-        // Remove oldest entries (simple approach - could be improved with LRU)
-        auto it = m_thumbnailCache.begin();
-        for (int i = 0; i < 20 && it != m_thumbnailCache.end(); ++i) {
-            it = m_thumbnailCache.erase(it);
-        }
+    return m_thumbnailService->thumbnail(position);
+}
+
+QString PlaybackController::generateSeekThumbnail(qint64 position)
+{
+    QImage thumbnail = seekThumbnail(position);
+    if (thumbnail.isNull()) {
+        // Decode queued; seekThumbnailGenerated() follows when ready
+        return QString();
     }
     
-    qCDebug(playbackController) << "Generated thumbnail for position" << position;
-    emit seekThumbnailGenerated(position, thumbnail);
-    
-    return thumbnail;
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    thumbnail.save(&buffer, "PNG");
+    return QString::fromLatin1(png.toBase64());
 }
 
 void PlaybackController::setSeekThumbnailEnabled(bool enabled)
@@ -768,7 +1183,9 @@ void PlaybackController::setSeekThumbnailEnabled(bool enabled)
     m_seekThumbnailEnabled = enabled;
     
     if (!enabled) {
-        m_thumbnailCache.clear();
+        m_thumbnailService->clear();
+    } else if (hasMedia() && duration() > 0) {
+        m_thumbnailService->setMedia(m_currentMediaPath, duration());
     }
 }
 
@@ -779,26 +1196,73 @@ void PlaybackController::onFastSeekTimer()
         return;
     }
     
-    qint64 currentPos = position();
-    qint64 seekAmount = (FAST_SEEK_INTERVAL_MS * m_fastSeekSpeed);
+    // The position runs at the seek speed in real time, whatever the timer's jitter;
+    // the engine is not seeked until the user lets go
+    qint64 seekAmount = m_fastSeekClock.restart() * m_fastSeekSpeed;
     
     if (!m_fastSeekForward) {
         seekAmount = -seekAmount;
     }
     
-    qint64 newPos = currentPos + seekAmount;
+    qint64 newPos = m_fastSeekPosition + seekAmount;
     
     // Check bounds
+    bool landed = false;
     qint64 totalDuration = duration();
-    if (newPos < 0) {
+    if (newPos <= 0) {
         newPos = 0;
-        stopFastSeek();
-    } else if (totalDuration > 0 && newPos >= totalDuration) {
-        newPos = totalDuration - 1000; // Stop 1 second before end
+        landed = true;
+    } else if (totalDuration > 0 && newPos >= totalDuration - 1000) {
+        newPos = std::max(0LL, totalDuration - 1000); // Stop 1 second before end
+        landed = true;
+    }
+    
+    m_fastSeekPosition = newPos;
+    presentTrickPlayFrame(newPos);
+    emit positionChanged(newPos);
+    
+    if (landed) {
         stopFastSeek();
     }
+}
+
+void PlaybackController::presentTrickPlayFrame(qint64 position)
+{
+    if (!m_seekThumbnailEnabled || !m_mediaEngine->hasVideo()) {
+        return;
+    }
+    
+    // Keyframes ahead in the direction of travel decode while this one shows
+    const qint64 bucketMs = m_thumbnailService->bucketDuration();
+    const qint64 lookAhead = bucketMs * TRICK_PLAY_PREFETCH_BUCKETS;
+    m_thumbnailService->prefetch(position, m_fastSeekForward ? position + lookAhead : position - lookAhead);
     
-    seek(newPos);
+    // Not decoded in time: the previous keyframe stays up rather than showing one out of order
+    const qint64 bucket = m_thumbnailService->bucketPosition(position);
+    if (bucket == m_trickPlayBucket) {
+        return;
+    }
+    const QImage image = m_thumbnailService->thumbnail(position).convertToFormat(QImage::Format_RGB32);
+    if (image.isNull()) {
+        return;
+    }
+    
+    if (!m_trickPlayFrames) {
+        m_trickPlayFrames = std::make_unique<VideoFramePool>(3);
+    }
+    m_trickPlayFrames->configure(image.width(), image.height());
+    std::shared_ptr<VideoFrame> frame = m_trickPlayFrames->acquire();
+    if (!frame) {
+        return;
+    }
+    
+    for (int y = 0; y < image.height(); ++y) {
+        std::memcpy(frame->bits() + y * frame->bytesPerLine(), image.constScanLine(y), image.width() * 4);
+    }
+    frame->setPosition(bucket);
+    
+    m_trickPlayBucket = bucket;
+    m_mediaEngine->presentVideoFrame(frame);
 }
 
 void PlaybackController::onCrossfadeTimer()
@@ -809,13 +1273,6 @@ void PlaybackController::onCrossfadeTimer()
     
     qCDebug(playbackController) << "Crossfade completed";
     
+    // The engine ramps the volumes and releases the previous media itself
     m_crossfadeActive = false;
-    
-    // In a real implementation, this would:
-    // 1. Fade out current track
-    // 2. Start next track with fade in
-    // 3. Handle the transition smoothly
-    
-    // For now, we just signal that crossfade is done
-    // The playlist manager would handle the actual track switching
 }
\ No newline at end of file
@@ -0,0 +1,598 @@
+#include "media/SeekIndex.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QStringList>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+Q_LOGGING_CATEGORY(seekIndex, "eonplay.seekindex")
+
+namespace {
+
+constexpr quint8 FORMAT_VERSION = 1;
+constexpr qint64 SNIFF_BYTES = 64 * 1024;
+constexpr qint64 READ_BYTES = 1024 * 1024;
+constexpr int START_CODE_LOOKAHEAD = 32;        // Bytes a start code handler may read
+constexpr int TS_PACKET_BYTES = 188;
+constexpr uchar TS_SYNC_BYTE = 0x47;
+constexpr int TS_SYNC_CHECKS = 5;               // Packets in a row that make a transport stream
+constexpr qint64 TIMESTAMP_WRAP = qint64(1) << 33;
+constexpr qint64 TICKS_PER_MS = 90;
+
+enum class VideoCodec {
+    Unknown,
+    Mpeg2,
+    H264,
+    Hevc,
+    Mpeg4
+};
+
+VideoCodec codecOfStreamType(int streamType)
+{
+    switch (streamType) {
+    case 0x01:
+    case 0x02:
+        return VideoCodec::Mpeg2;
+    case 0x10:
+        return VideoCodec::Mpeg4;
+    case 0x1B:
+        return VideoCodec::H264;
+    case 0x24:
+        return VideoCodec::Hevc;
+    default:
+        return VideoCodec::Unknown;
+    }
+}
+
+SeekIndex::Container sniff(const QByteArray& head, int* packetSize)
+{
+    const uchar* data = reinterpret_cast<const uchar*>(head.constData());
+    const int size = head.size();
+
+    // M2TS puts a 4-byte timecode in front of each packet
+    for (const int stride : {TS_PACKET_BYTES, TS_PACKET_BYTES + 4}) {
+        const int sync = stride - TS_PACKET_BYTES;
+        for (int start = 0; start < stride && start + sync + (TS_SYNC_CHECKS - 1) * stride < size; ++start) {
+            int k = 0;
+            while (k < TS_SYNC_CHECKS && data[start + sync + k * stride] == TS_SYNC_BYTE) {
+                ++k;
+            }
+            if (k == TS_SYNC_CHECKS) {
+                if (packetSize) {
+                    *packetSize = stride;
+                }
+                return SeekIndex::Container::MpegTs;
+            }
+        }
+    }
+
+    // Program streams and raw video start with a start code after at most zero padding
+    int i = 0;
+    while (i < size && data[i] == 0) {
+        ++i;
+    }
+    if (i >= 2 && i + 1 < size && data[i] == 1) {
+        if (data[i + 1] == 0xBA) {
+            return SeekIndex::Container::MpegPs;
+        }
+        if (data[i + 1] == 0xB3) {
+            return SeekIndex::Container::MpegVideo;
+        }
+    }
+    return SeekIndex::Container::Unknown;
+}
+
+qint64 readTimestamp(const uchar* p)
+{
+    return (qint64(p[0] & 0x0E) << 29) | (qint64(p[1]) << 22) | (qint64(p[2] & 0xFE) << 14) |
+           (qint64(p[3]) << 7) | (qint64(p[4]) >> 1);
+}
+
+// 33-bit 90 kHz clock references and timestamps, unwrapped and relative to the first one
+struct StreamClock {
+    qint64 base = -1;
+    qint64 last = -1;
+    qint64 wraps = 0;
+
+    qint64 unwrap(qint64 timestamp)
+    {
+        // Timestamps run a little ahead of clock references, so a wrap can be crossed back
+        if (last >= 0 && timestamp < last - TIMESTAMP_WRAP / 2) {
+            wraps += TIMESTAMP_WRAP;
+        } else if (last >= 0 && timestamp > last + TIMESTAMP_WRAP / 2 && wraps > 0) {
+            wraps -= TIMESTAMP_WRAP;
+        }
+        last = timestamp;
+        const qint64 unwrapped = timestamp + wraps;
+        if (base < 0) {
+            base = unwrapped;
+        }
+        return unwrapped;
+    }
+
+    qint64 toMs(qint64 unwrapped) const { return (unwrapped - base) / TICKS_PER_MS; }
+};
+
+// Whether the video data at the start of a PES packet begins a picture decoding can start at
+bool startsKeyframe(VideoCodec codec, const uchar* data, int size)
+{
+    for (int i = 0; i + 5 < size; ++i) {
+        if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) {
+            continue;
+        }
+        const uchar code = data[i + 3];
+        switch (codec) {
+        case VideoCodec::Mpeg2:
+            if (code == 0xB3 || code == 0xB8) {
+                return true;
+            }
+            if (code == 0x00) {
+                return ((data[i + 5] >> 3) & 0x07) == 1;   // I picture
+            }
+            break;
+        case VideoCodec::H264: {
+            // Broadcast streams recover at I pictures after a parameter set, not only at IDRs
+            const int type = code & 0x1F;
+            if (type == 5 || type == 7) {
+                return true;
+            }
+            if (type == 1) {
+                return false;
+            }
+            break;
+        }
+        case VideoCodec::Hevc: {
+            const int type = (code >> 1) & 0x3F;
+            if ((type >= 16 && type <= 21) || type == 32 || type == 33) {
+                return true;
+            }
+            if (type < 16) {
+                return false;
+            }
+            break;
+        }
+        case VideoCodec::Mpeg4:
+            if (code == 0xB0 || code == 0xB3) {
+                return true;
+            }
+            if (code == 0xB6) {
+                return (data[i + 4] >> 6) == 0;             // I-VOP
+            }
+            break;
+        case VideoCodec::Unknown:
+            return false;
+        }
+        i += 2;
+    }
+    return false;
+}
+
+int programMapPid(const uchar* data, int size)
+{
+    const int section = 1 + data[0];
+    if (section + 8 > size || data[section] != 0x00) {
+        return -1;
+    }
+    const int length = ((data[section + 1] & 0x0F) << 8) | data[section + 2];
+    const int end = std::min(size, section + 3 + length - 4);
+    for (int i = section + 8; i + 4 <= end; i += 4) {
+        if (((data[i] << 8) | data[i + 1]) != 0) {
+            return ((data[i + 2] & 0x1F) << 8) | data[i + 3];
+        }
+    }
+    return -1;
+}
+
+bool readProgramMap(const uchar* data, int size, int* pcrPid, int* videoPid, VideoCodec* codec)
+{
+    const int section = 1 + data[0];
+    if (section + 12 > size || data[section] != 0x02) {
+        return false;
+    }
+    const int length = ((data[section + 1] & 0x0F) << 8) | data[section + 2];
+    const int end = std::min(size, section + 3 + length - 4);
+    *pcrPid = ((data[section + 8] & 0x1F) << 8) | data[section + 9];
+
+    int i = section + 12 + (((data[section + 10] & 0x0F) << 8) | data[section + 11]);
+    while (i + 5 <= end) {
+        const VideoCodec streamCodec = codecOfStreamType(data[i]);
+        if (streamCodec != VideoCodec::Unknown) {
+            *videoPid = ((data[i + 1] & 0x1F) << 8) | data[i + 2];
+            *codec = streamCodec;
+            return true;
+        }
+        i += 5 + (((data[i + 3] & 0x0F) << 8) | data[i + 4]);
+    }
+    return false;
+}
+
+void writeVarint(QByteArray& data, quint64 value)
+{
+    while (value >= 0x80) {
+        data.append(char(value | 0x80));
+        value >>= 7;
+    }
+    data.append(char(value));
+}
+
+bool readVarint(const QByteArray& data, int& pos, quint64* value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+        const uchar byte = uchar(data[pos++]);
+        *value |= quint64(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Calls onStartCode(data, offset) for every 00 00 01 xx in the file, with
+ * START_CODE_LOOKAHEAD bytes readable at data; it returns the offset to go
+ * on scanning from, past the start code. The last few bytes of the file
+ * are not scanned.
+ */
+template <typename Handler>
+bool forEachStartCode(QFile& file, const std::atomic<bool>* cancelled, Handler&& onStartCode)
+{
+    qint64 pos = 0;
+    while (true) {
+        if (cancelled && *cancelled) {
+            return false;
+        }
+        if (!file.seek(pos)) {
+            return true;
+        }
+        const QByteArray block = file.read(READ_BYTES);
+        const qint64 end = pos + block.size() - START_CODE_LOOKAHEAD;
+        const uchar* data = reinterpret_cast<const uchar*>(block.constData());
+
+        qint64 at = pos;
+        while (at < end) {
+            const uchar* p = data + (at - pos);
+            if (p[2] > 1) {
+                at += 3;
+            } else if (p[2] == 0) {
+                ++at;
+            } else if (p[0] != 0 || p[1] != 0) {
+                at += 3;
+            } else {
+                at = std::max(at + 4, onStartCode(p, at));
+            }
+        }
+
+        if (block.size() < READ_BYTES) {
+            return true;
+        }
+        pos = at;
+    }
+}
+
+} // namespace
+
+bool SeekIndex::isCandidate(const QString& filePath)
+{
+    static const QStringList suffixes = {
+        "ts", "m2ts", "mts", "m2t", "tsv", "tsa", "trp", "tp",
+        "mpg", "mpeg", "mpe", "vob", "m2p", "ps", "vro",
+        "m1v", "m2v", "mpv"
+    };
+    return suffixes.contains(QFileInfo(filePath).suffix().toLower());
+}
+
+SeekIndex::Container SeekIndex::detect(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return Container::Unknown;
+    }
+    return sniff(file.read(SNIFF_BYTES), nullptr);
+}
+
+SeekIndex SeekIndex::build(const QString& filePath, const std::atomic<bool>* cancelled)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCDebug(seekIndex) << "Cannot open for indexing:" << filePath << file.errorString();
+        return SeekIndex();
+    }
+
+    int packetSize = TS_PACKET_BYTES;
+    const Container container = sniff(file.read(SNIFF_BYTES), &packetSize);
+
+    SeekIndex index;
+    switch (container) {
+    case Container::MpegTs:
+        index = buildTransportStream(file, packetSize, cancelled);
+        break;
+    case Container::MpegPs:
+        index = buildProgramStream(file, cancelled);
+        break;
+    case Container::MpegVideo:
+        index = buildVideoStream(file, cancelled);
+        break;
+    case Container::Unknown:
+        return SeekIndex();
+    }
+
+    if ((cancelled && *cancelled) || index.isEmpty()) {
+        return SeekIndex();
+    }
+
+    index.m_container = container;
+    index.m_fileSize = file.size();
+    qCDebug(seekIndex) << "Indexed" << index.m_keyframes.size() << "keyframes of" << filePath;
+    return index;
+}
+
+SeekIndex SeekIndex::buildTransportStream(QFile& file, int packetSize, const std::atomic<bool>* cancelled)
+{
+    SeekIndex index;
+    const int sync = packetSize - TS_PACKET_BYTES;
+    const qint64 fileSize = file.size();
+
+    int pmtPid = -1;
+    int pcrPid = -1;
+    int videoPid = -1;
+    VideoCodec codec = VideoCodec::Unknown;
+    StreamClock clock;
+
+    QByteArray block;
+    qint64 blockStart = 0;
+    qint64 pos = 0;
+    while (pos + packetSize <= fileSize) {
+        if (pos + packetSize > blockStart + block.size()) {
+            if (cancelled && *cancelled) {
+                return SeekIndex();
+            }
+            if (!file.seek(pos)) {
+                break;
+            }
+            block = file.read(READ_BYTES);
+            blockStart = pos;
+            if (block.size() < packetSize) {
+                break;
+            }
+        }
+
+        const uchar* p = reinterpret_cast<const uchar*>(block.constData()) + (pos - blockStart) + sync;
+        if (p[0] != TS_SYNC_BYTE) {
+            // Lost sync, e.g. a damaged recording; look for the next packet
+            ++pos;
+            continue;
+        }
+
+        const int pid = ((p[1] & 0x1F) << 8) | p[2];
+        const bool transportError = p[1] & 0x80;
+        const bool unitStart = p[1] & 0x40;
+        const int control = (p[3] >> 4) & 0x03;
+
+        int payload = 4;
+        bool randomAccess = false;
+        if (control & 0x02) {
+            const int length = p[4];
+            if (length > 0 && 5 + length <= TS_PACKET_BYTES) {
+                const uchar flags = p[5];
+                randomAccess = flags & 0x40;
+                if ((flags & 0x10) && length >= 7 && pid == pcrPid) {
+                    clock.unwrap((qint64(p[6]) << 25) | (qint64(p[7]) << 17) | (qint64(p[8]) << 9) |
+                                 (qint64(p[9]) << 1) | (qint64(p[10]) >> 7));
+                }
+            }
+            payload = 5 + length;
+        }
+
+        if (!transportError && unitStart && (control & 0x01) && payload < TS_PACKET_BYTES) {
+            const uchar* data = p + payload;
+            const int size = TS_PACKET_BYTES - payload;
+
+            if (pid == 0 && pmtPid < 0) {
+                pmtPid = programMapPid(data, size);
+            } else if (pid == pmtPid && videoPid < 0) {
+                readProgramMap(data, size, &pcrPid, &videoPid, &codec);
+            } else if (pid == videoPid && size >= 14 && data[0] == 0 && data[1] == 0 && data[2] == 1 &&
+                       (data[7] & 0x80)) {
+                const qint64 pts = clock.unwrap(readTimestamp(data + 9));
+                const int es = 9 + data[8];
+                if (randomAccess || (es < size && startsKeyframe(codec, data + es, size - es))) {
+                    index.append(clock.toMs(pts), pos);
+                }
+            }
+        }
+
+        pos += packetSize;
+    }
+
+    return index;
+}
+
+SeekIndex SeekIndex::buildProgramStream(QFile& file, const std::atomic<bool>* cancelled)
+{
+    SeekIndex index;
+    StreamClock clock;
+    qint64 packStart = -1;
+    qint64 videoPts = -1;
+    qint64 videoEnd = -1;       // End of the video PES packet being scanned
+
+    forEachStartCode(file, cancelled, [&](const uchar* p, qint64 offset) -> qint64 {
+        const uchar code = p[3];
+        if (code == 0xBA) {
+            packStart = offset;
+            if ((p[4] & 0xC0) == 0x40) {
+                clock.unwrap((qint64(p[4] & 0x38) << 27) | (qint64(p[4] & 0x03) << 28) | (qint64(p[5]) << 20) |
+                             (qint64(p[6] & 0xF8) << 12) | (qint64(p[6] & 0x03) << 13) | (qint64(p[7]) << 5) |
+                             (qint64(p[8]) >> 3));
+            } else if ((p[4] & 0xF0) == 0x20) {
+                clock.unwrap(readTimestamp(p + 4));     // MPEG-1 pack
+            }
+            return offset + 4;
+        }
+
+        if (code >= 0xE0 && code <= 0xEF) {
+            const int length = (p[4] << 8) | p[5];
+            videoEnd = length > 0 ? offset + 6 + length : std::numeric_limits<qint64>::max();
+
+            int header = 6;
+            if ((p[6] & 0xC0) == 0x80) {
+                if (p[7] & 0x80) {
+                    videoPts = clock.unwrap(readTimestamp(p + 9));
+                }
+            } else {
+                // MPEG-1 header: stuffing, buffer size, then the timestamps
+                while (header < 6 + 16 && p[header] == 0xFF) {
+                    ++header;
+                }
+                if ((p[header] & 0xC0) == 0x40) {
+                    header += 2;
+                }
+                if ((p[header] & 0xE0) == 0x20) {
+                    videoPts = clock.unwrap(readTimestamp(p + header));
+                }
+            }
+            // The payload is scanned for the sequence and GOP headers in it
+            return offset + 6;
+        }
+
+        if (code >= 0xB9) {
+            // Audio, private and padding packets hold nothing to index
+            const int length = code == 0xB9 ? 0 : (p[4] << 8) | p[5];
+            return offset + 4 + (length > 0 ? 2 + length : 0);
+        }
+
+        if ((code == 0xB3 || code == 0xB8) && offset < videoEnd && packStart >= 0 && videoPts >= 0) {
+            index.append(clock.toMs(videoPts), packStart);
+        }
+        return offset + 4;
+    });
+
+    return index;
+}
+
+SeekIndex SeekIndex::buildVideoStream(QFile& file, const std::atomic<bool>* cancelled)
+{
+    static const double frameRates[] = {0.0, 24000.0 / 1001, 24.0, 25.0, 30000.0 / 1001, 30.0, 50.0, 60000.0 / 1001, 60.0};
+
+    SeekIndex index;
+    double frameRate = 0.0;
+    qint64 pictures = 0;
+    qint64 sequenceStart = -1;
+    qint64 lastPicture = -1;
+
+    // No timestamps: pictures are counted at the rate the sequence header gives
+    forEachStartCode(file, cancelled, [&](const uchar* p, qint64 offset) -> qint64 {
+        switch (p[3]) {
+        case 0xB3: {
+            const int rateCode = p[7] & 0x0F;
+            if (rateCode < int(std::size(frameRates))) {
+                frameRate = frameRates[rateCode];
+            }
+            sequenceStart = offset;
+            break;
+        }
+        case 0xB8:
+            if (frameRate > 0.0) {
+                // Start at the sequence header right before the GOP, if there is one
+                const qint64 start = sequenceStart > lastPicture ? sequenceStart : offset;
+                index.append(qint64(pictures * 1000 / frameRate), start);
+            }
+            break;
+        case 0x00:
+            ++pictures;
+            lastPicture = offset;
+            break;
+        default:
+            break;
+        }
+        return offset + 4;
+    });
+
+    return index;
+}
+
+void SeekIndex::append(qint64 timeMs, qint64 offset)
+{
+    timeMs = std::max<qint64>(0, timeMs);
+
+    // Also drops keyframes whose timestamps went back, e.g. after a splice, as time lookups cannot reach them
+    if (!m_keyframes.isEmpty() && timeMs < m_keyframes.constLast().timeMs + MIN_SPACING_MS) {
+        return;
+    }
+    m_keyframes.append({timeMs, offset});
+}
+
+SeekIndex::Keyframe SeekIndex::keyframeAt(qint64 timeMs) const
+{
+    if (m_keyframes.isEmpty()) {
+        return Keyframe();
+    }
+    auto it = std::upper_bound(m_keyframes.cbegin(), m_keyframes.cend(), timeMs,
+                               [](qint64 time, const Keyframe& keyframe) { return time < keyframe.timeMs; });
+    return it == m_keyframes.cbegin() ? *it : *(it - 1);
+}
+
+QByteArray SeekIndex::serialize() const
+{
+    QByteArray data;
+    if (isEmpty()) {
+        return data;
+    }
+
+    data.append(char(FORMAT_VERSION));
+    data.append(char(m_container));
+    writeVarint(data, quint64(m_fileSize));
+    writeVarint(data, quint64(m_keyframes.size()));
+
+    // Times and offsets only grow, so each entry is two small deltas
+    Keyframe previous;
+    for (const Keyframe& keyframe : m_keyframes) {
+        writeVarint(data, quint64(keyframe.timeMs - previous.timeMs));
+        writeVarint(data, quint64(keyframe.offset - previous.offset));
+        previous = keyframe;
+    }
+    return data;
+}
+
+SeekIndex SeekIndex::deserialize(const QByteArray& data)
+{
+    if (data.size() < 2 || quint8(data[0]) != FORMAT_VERSION) {
+        return SeekIndex();
+    }
+
+    SeekIndex index;
+    const quint8 container = quint8(data[1]);
+    if (container == quint8(Container::Unknown) || container > quint8(Container::MpegVideo)) {
+        return SeekIndex();
+    }
+    index.m_container = Container(container);
+
+    int pos = 2;
+    quint64 fileSize = 0;
+    quint64 count = 0;
+    // Each entry takes at least two bytes
+    if (!readVarint(data, pos, &fileSize) || !readVarint(data, pos, &count) ||
+        count > quint64(data.size() - pos) / 2) {
+        return SeekIndex();
+    }
+    index.m_fileSize = qint64(fileSize);
+
+    index.m_keyframes.reserve(int(count));
+    Keyframe keyframe;
+    for (quint64 i = 0; i < count; ++i) {
+        quint64 timeDelta = 0;
+        quint64 offsetDelta = 0;
+        if (!readVarint(data, pos, &timeDelta) || !readVarint(data, pos, &offsetDelta)) {
+            return SeekIndex();
+        }
+        keyframe.timeMs += qint64(timeDelta);
+        keyframe.offset += qint64(offsetDelta);
+        if (keyframe.offset >= index.m_fileSize) {
+            return SeekIndex();
+        }
+        index.m_keyframes.append(keyframe);
+    }
+    return index;
+}
@@ -0,0 +1,576 @@
+#include "media/SeekThumbnailService.h"
+#include "CacheBudget.h"
+#include <QLoggingCategory>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QVector>
+#include <QWaitCondition>
+#include <cstring>
+
+// libVLC includes
+#include <vlc/vlc.h>
+
+Q_DECLARE_LOGGING_CATEGORY(seekThumbnails)
+Q_LOGGING_CATEGORY(seekThumbnails, "eonplay.seekthumbnails")
+
+namespace {
+constexpr int SPRITE_FORMAT_VERSION = 1;
+constexpr int SPRITE_JPEG_QUALITY = 85;
+}
+
+/**
+ * @brief Decodes preview frames with its own libVLC player (worker thread)
+ *
+ * Requests are served newest first; once more than MAX_PENDING are queued
+ * the oldest are dropped and reported back as failed so the service can
+ * request them again later.
+ */
+class SeekThumbnailWorker : public QObject
+{
+public:
+    static constexpr int MAX_PENDING = 4;
+    static constexpr int CAPTURE_TIMEOUT_MS = 1500;
+
+    explicit SeekThumbnailWorker(SeekThumbnailService* owner)
+        : m_owner(owner)
+        , m_instance(nullptr)
+        , m_player(nullptr)
+        , m_generation(0)
+        , m_playing(false)
+        , m_processScheduled(false)
+        , m_framesDisplayed(0)
+        , m_captureAfter(0)
+        , m_captureArmed(false)
+    {
+    }
+
+    ~SeekThumbnailWorker() override
+    {
+        close();
+    }
+
+    void open(const QString& path, quint64 generation)
+    {
+        close();
+        m_generation = generation;
+
+        const char* args[] = {
+            "--intf=dummy",
+            "--no-audio",
+            "--no-video-title-show",
+            "--no-spu",
+            "--no-osd",
+            "--no-stats",
+            "--no-lua",
+            "--no-metadata-network-access"
+        };
+
+        m_instance = libvlc_new(sizeof(args) / sizeof(args[0]), args);
+        if (!m_instance) {
+            qCWarning(seekThumbnails) << "Failed to create thumbnail decoder instance";
+            return;
+        }
+
+        // Same path/URL handling as VLCBackend::loadMedia()
+        QUrl url(path);
+        libvlc_media_t* media = (url.isLocalFile() || !url.scheme().isEmpty())
+            ? libvlc_media_new_location(m_instance, path.toUtf8().constData())
+            : libvlc_media_new_path(m_instance, path.toUtf8().constData());
+        if (!media) {
+            qCWarning(seekThumbnails) << "Failed to open media for thumbnails:" << path;
+            close();
+            return;
+        }
+
+        // Seek to the nearest keyframe instead of decoding up to the exact position
+        libvlc_media_add_option(media, ":input-fast-seek");
+
+        m_player = libvlc_media_player_new_from_media(media);
+        libvlc_media_release(media);
+        if (!m_player) {
+            close();
+            return;
+        }
+
+        libvlc_video_set_callbacks(m_player, lockCallback, nullptr, displayCallback, this);
+        libvlc_video_set_format_callbacks(m_player, formatCallback, nullptr);
+    }
+
+    void close()
+    {
+        if (m_player) {
+            libvlc_media_player_stop(m_player);
+            libvlc_media_player_release(m_player);
+            m_player = nullptr;
+        }
+        if (m_instance) {
+            libvlc_release(m_instance);
+            m_instance = nullptr;
+        }
+
+        // Requests for the previous media are void; the service ignores their generation
+        m_queue.clear();
+        m_playing = false;
+    }
+
+    void enqueue(int bucket, qint64 position)
+    {
+        m_queue.append({bucket, position});
+        while (m_queue.size() > MAX_PENDING) {
+            postResult(m_queue.first().bucket, QImage());
+            m_queue.removeFirst();
+        }
+
+        if (!m_processScheduled) {
+            m_processScheduled = true;
+            QMetaObject::invokeMethod(this, [this]() { processNext(); }, Qt::QueuedConnection);
+        }
+    }
+
+private:
+    struct Request {
+        int bucket;
+        qint64 position;
+    };
+
+    void processNext()
+    {
+        m_processScheduled = false;
+        if (m_queue.isEmpty()) {
+            return;
+        }
+
+        // Newest first: the user is looking at the most recent hover position
+        Request request = m_queue.takeLast();
+        QImage image;
+        if (m_player) {
+            image = capture(request.position);
+        }
+        postResult(request.bucket, image);
+
+        if (!m_queue.isEmpty()) {
+            m_processScheduled = true;
+            QMetaObject::invokeMethod(this, [this]() { processNext(); }, Qt::QueuedConnection);
+        } else if (m_player && m_playing) {
+            libvlc_media_player_set_pause(m_player, 1);
+            m_playing = false;
+        }
+    }
+
+    QImage capture(qint64 position)
+    {
+        QMutexLocker locker(&m_captureMutex);
+        // Skip one frame so a picture decoded before the seek is not taken
+        m_captureAfter = m_framesDisplayed + 1;
+        m_captureArmed = true;
+        m_captured = QImage();
+        locker.unlock();
+
+        if (!m_playing) {
+            if (libvlc_media_player_get_state(m_player) == libvlc_Paused) {
+                libvlc_media_player_set_pause(m_player, 0);
+            } else {
+                libvlc_media_player_play(m_player);
+            }
+            m_playing = true;
+        }
+
+        // libVLC 3 takes the time in milliseconds
+        libvlc_media_player_set_time(m_player, position);
+
+        locker.relock();
+        QDeadlineTimer deadline(CAPTURE_TIMEOUT_MS);
+        while (m_captured.isNull()) {
+            if (!m_frameCondition.wait(&m_captureMutex, deadline)) {
+                break;
+            }
+        }
+        m_captureArmed = false;
+
+        if (m_captured.isNull()) {
+            qCDebug(seekThumbnails) << "Timed out decoding preview at" << position;
+        }
+        return m_captured;
+    }
+
+    void postResult(int bucket, const QImage& image)
+    {
+        SeekThumbnailService* owner = m_owner;
+        const quint64 generation = m_generation;
+        QMetaObject::invokeMethod(owner, [owner, generation, bucket, image]() {
+            owner->onThumbnailDecoded(generation, bucket, image);
+        }, Qt::QueuedConnection);
+    }
+
+    // libVLC video callbacks (decoder thread)
+    static unsigned formatCallback(void** opaque, char* chroma, unsigned* width, unsigned* height,
+                                   unsigned* pitches, unsigned* lines)
+    {
+        SeekThumbnailWorker* worker = static_cast<SeekThumbnailWorker*>(*opaque);
+        if (*width == 0 || *height == 0) {
+            return 0;
+        }
+
+        // Let libVLC scale straight to tile size, keeping the aspect ratio
+        const double scale = qMin(static_cast<double>(SeekThumbnailService::TILE_WIDTH) / *width,
+                                  static_cast<double>(SeekThumbnailService::TILE_HEIGHT) / *height);
+        *width = qMax(2u, static_cast<unsigned>(*width * scale) & ~1u);
+        *height = qMax(2u, static_cast<unsigned>(*height * scale) & ~1u);
+
+        std::memcpy(chroma, "RV32", 4);
+        worker->m_decodeBuffer = QImage(static_cast<int>(*width), static_cast<int>(*height), QImage::Format_RGB32);
+        pitches[0] = static_cast<unsigned>(worker->m_decodeBuffer.bytesPerLine());
+        lines[0] = *height;
+        return 1;
+    }
+
+    static void* lockCallback(void* opaque, void** planes)
+    {
+        SeekThumbnailWorker* worker = static_cast<SeekThumbnailWorker*>(opaque);
+        planes[0] = worker->m_decodeBuffer.bits();
+        return nullptr;
+    }
+
+    static void displayCallback(void* opaque, void* picture)
+    {
+        Q_UNUSED(picture)
+        SeekThumbnailWorker* worker = static_cast<SeekThumbnailWorker*>(opaque);
+
+        QMutexLocker locker(&worker->m_captureMutex);
+        ++worker->m_framesDisplayed;
+        if (worker->m_captureArmed && worker->m_framesDisplayed > worker->m_captureAfter) {
+            worker->m_captured = worker->m_decodeBuffer.copy();
+            worker->m_captureArmed = false;
+            worker->m_frameCondition.wakeAll();
+        }
+    }
+
+    SeekThumbnailService* m_owner;
+    libvlc_instance_t* m_instance;
+    libvlc_media_player_t* m_player;
+    quint64 m_generation;
+    bool m_playing;
+
+    QVector<Request> m_queue;
+    bool m_processScheduled;
+
+    // Frame capture, shared with the decoder thread
+    QMutex m_captureMutex;
+    QWaitCondition m_frameCondition;
+    QImage m_decodeBuffer;          // Decoder thread only
+    QImage m_captured;
+    quint64 m_framesDisplayed;
+    quint64 m_captureAfter;
+    bool m_captureArmed;
+};
+
+SeekThumbnailService::SeekThumbnailService(QObject* parent)
+    : QObject(parent)
+    , m_worker(new SeekThumbnailWorker(this))
+    , m_duration(0)
+    , m_bucketDuration(MIN_BUCKET_MS)
+    , m_bucketCount(0)
+    , m_generation(0)
+    , m_tileCache(DEFAULT_CACHE_BYTES)
+    , m_spriteDirty(false)
+    , m_saveTimer(new QTimer(this))
+{
+    m_workerThread.setObjectName("SeekThumbnails");
+    m_worker->moveToThread(&m_workerThread);
+    connect(&m_workerThread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_workerThread.start(QThread::LowPriority);
+
+    // Batch sprite writes while the user scrubs
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(SAVE_DELAY_MS);
+    connect(m_saveTimer, &QTimer::timeout, this, &SeekThumbnailService::saveSprite);
+
+    // Evicted tiles are cut from the sprite again
+    CacheBudget::instance().registerCache("seek_thumbnails", CacheBudget::Priority::Low, this, m_tileCache);
+}
+
+SeekThumbnailService::~SeekThumbnailService()
+{
+    saveSprite();
+    m_workerThread.quit();
+    m_workerThread.wait();
+}
+
+void SeekThumbnailService::setMedia(const QString& path, qint64 duration)
+{
+    if (path == m_mediaPath && duration == m_duration) {
+        return;
+    }
+
+    clear();
+
+    m_mediaPath = path;
+    m_duration = qMax<qint64>(0, duration);
+    m_bucketDuration = qMax(MIN_BUCKET_MS, (m_duration + MAX_BUCKETS - 1) / MAX_BUCKETS);
+    m_bucketCount = static_cast<int>(qMin<qint64>(MAX_BUCKETS, m_duration / m_bucketDuration + 1));
+    m_mediaKey = mediaKey(path);
+
+    if (loadSprite()) {
+        qCDebug(seekThumbnails) << "Loaded" << m_spriteTiles.size() << "saved previews for" << path;
+    }
+
+    SeekThumbnailWorker* worker = m_worker;
+    const quint64 generation = m_generation;
+    QMetaObject::invokeMethod(worker, [worker, path, generation]() {
+        worker->open(path, generation);
+    }, Qt::QueuedConnection);
+}
+
+void SeekThumbnailService::clear()
+{
+    saveSprite();
+
+    // Results still in flight for the previous media are ignored
+    ++m_generation;
+    m_mediaPath.clear();
+    m_mediaKey.clear();
+    m_duration = 0;
+    m_bucketCount = 0;
+    m_sprite = QImage();
+    m_spriteTiles.clear();
+    m_requestedBuckets.clear();
+
+    SeekThumbnailWorker* worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker]() { worker->close(); }, Qt::QueuedConnection);
+}
+
+QImage SeekThumbnailService::thumbnail(qint64 position)
+{
+    if (m_mediaPath.isEmpty() || m_bucketCount == 0) {
+        return QImage();
+    }
+
+    const int bucket = bucketIndex(position);
+    const QString key = tileKey(bucket);
+
+    if (QImage* cached = m_tileCache.object(key)) {
+        return *cached;
+    }
+
+    if (m_spriteTiles.contains(bucket)) {
+        QImage tile = m_sprite.copy(tileRect(bucket));
+        m_tileCache.insert(key, new QImage(tile), tile.sizeInBytes());
+        return tile;
+    }
+
+    if (!m_requestedBuckets.contains(bucket)) {
+        m_requestedBuckets.insert(bucket);
+        SeekThumbnailWorker* worker = m_worker;
+        const qint64 seekPosition = bucket * m_bucketDuration;
+        QMetaObject::invokeMethod(worker, [worker, bucket, seekPosition]() {
+            worker->enqueue(bucket, seekPosition);
+        }, Qt::QueuedConnection);
+    }
+
+    return QImage();
+}
+
+void SeekThumbnailService::prefetch(qint64 fromPosition, qint64 toPosition)
+{
+    if (m_mediaPath.isEmpty() || m_bucketCount == 0) {
+        return;
+    }
+
+    // Farthest first: the worker takes the newest request, so the nearest decodes first
+    const int first = bucketIndex(fromPosition);
+    const int last = bucketIndex(toPosition);
+    const int step = last >= first ? 1 : -1;
+    for (int bucket = last; bucket != first - step; bucket -= step) {
+        thumbnail(bucket * m_bucketDuration);
+    }
+}
+
+qint64 SeekThumbnailService::bucketPosition(qint64 position) const
+{
+    return bucketIndex(position) * m_bucketDuration;
+}
+
+void SeekThumbnailService::setCacheBudget(int bytes)
+{
+    m_tileCache.setMaxCost(qMax(0, bytes));
+}
+
+int SeekThumbnailService::cacheBudget() const
+{
+    return static_cast<int>(m_tileCache.maxCost());
+}
+
+QString SeekThumbnailService::cacheDirectory()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("thumbnails");
+}
+
+void SeekThumbnailService::onThumbnailDecoded(quint64 generation, int bucket, const QImage& image)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    m_requestedBuckets.remove(bucket);
+    if (image.isNull()) {
+        return;
+    }
+
+    // Letterbox into a fixed cell so every tile has the same geometry
+    QImage tile(TILE_WIDTH, TILE_HEIGHT, QImage::Format_RGB32);
+    tile.fill(Qt::black);
+    QPainter painter(&tile);
+    painter.drawImage((TILE_WIDTH - image.width()) / 2, (TILE_HEIGHT - image.height()) / 2, image);
+    painter.end();
+
+    storeTile(bucket, tile);
+    emit thumbnailReady(bucket * m_bucketDuration, tile);
+}
+
+void SeekThumbnailService::storeTile(int bucket, const QImage& tile)
+{
+    m_tileCache.insert(tileKey(bucket), new QImage(tile), tile.sizeInBytes());
+
+    if (m_mediaKey.isEmpty()) {
+        return;
+    }
+
+    if (m_sprite.isNull()) {
+        const int rows = (m_bucketCount + SPRITE_COLUMNS - 1) / SPRITE_COLUMNS;
+        m_sprite = QImage(SPRITE_COLUMNS * TILE_WIDTH, rows * TILE_HEIGHT, QImage::Format_RGB32);
+        m_sprite.fill(Qt::black);
+    }
+
+    QPainter painter(&m_sprite);
+    painter.drawImage(tileRect(bucket).topLeft(), tile);
+    painter.end();
+
+    m_spriteTiles.insert(bucket);
+    m_spriteDirty = true;
+    m_saveTimer->start();
+}
+
+bool SeekThumbnailService::loadSprite()
+{
+    if (m_mediaKey.isEmpty()) {
+        return false;
+    }
+
+    const QDir dir(cacheDirectory());
+    QFile indexFile(dir.filePath(m_mediaKey + ".json"));
+    if (!indexFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QJsonObject index = QJsonDocument::fromJson(indexFile.readAll()).object();
+    if (index.value("version").toInt() != SPRITE_FORMAT_VERSION ||
+        index.value("bucketDuration").toInteger() != m_bucketDuration ||
+        index.value("tileWidth").toInt() != TILE_WIDTH ||
+        index.value("tileHeight").toInt() != TILE_HEIGHT ||
+        index.value("columns").toInt() != SPRITE_COLUMNS) {
+        return false;
+    }
+
+    QImage sprite(dir.filePath(m_mediaKey + ".jpg"));
+    const int rows = (m_bucketCount + SPRITE_COLUMNS - 1) / SPRITE_COLUMNS;
+    if (sprite.width() != SPRITE_COLUMNS * TILE_WIDTH || sprite.height() != rows * TILE_HEIGHT) {
+        return false;
+    }
+
+    m_sprite = sprite.convertToFormat(QImage::Format_RGB32);
+    for (const QJsonValue& value : index.value("tiles").toArray()) {
+        const int bucket = value.toInt(-1);
+        if (bucket >= 0 && bucket < m_bucketCount) {
+            m_spriteTiles.insert(bucket);
+        }
+    }
+
+    return !m_spriteTiles.isEmpty();
+}
+
+void SeekThumbnailService::saveSprite()
+{
+    m_saveTimer->stop();
+    if (!m_spriteDirty || m_mediaKey.isEmpty() || m_sprite.isNull()) {
+        return;
+    }
+    m_spriteDirty = false;
+
+    QDir dir(cacheDirectory());
+    if (!dir.mkpath(".")) {
+        qCWarning(seekThumbnails) << "Cannot create thumbnail cache directory" << dir.path();
+        return;
+    }
+
+    QSaveFile imageFile(dir.filePath(m_mediaKey + ".jpg"));
+    if (!imageFile.open(QIODevice::WriteOnly) ||
+        !m_sprite.save(&imageFile, "JPG", SPRITE_JPEG_QUALITY) ||
+        !imageFile.commit()) {
+        qCWarning(seekThumbnails) << "Failed to save sprite sheet" << imageFile.fileName();
+        return;
+    }
+
+    QJsonArray tiles;
+    for (int bucket : m_spriteTiles) {
+        tiles.append(bucket);
+    }
+
+    QJsonObject index;
+    index["version"] = SPRITE_FORMAT_VERSION;
+    index["bucketDuration"] = m_bucketDuration;
+    index["tileWidth"] = TILE_WIDTH;
+    index["tileHeight"] = TILE_HEIGHT;
+    index["columns"] = SPRITE_COLUMNS;
+    index["tiles"] = tiles;
+
+    QSaveFile indexFile(dir.filePath(m_mediaKey + ".json"));
+    if (!indexFile.open(QIODevice::WriteOnly) ||
+        indexFile.write(QJsonDocument(index).toJson(QJsonDocument::Compact)) < 0 ||
+        !indexFile.commit()) {
+        qCWarning(seekThumbnails) << "Failed to save sprite index" << indexFile.fileName();
+    }
+}
+
+QString SeekThumbnailService::tileKey(int bucket) const
+{
+    return m_mediaPath + QLatin1Char('#') + QString::number(m_bucketDuration) + QLatin1Char(':') + QString::number(bucket);
+}
+
+QRect SeekThumbnailService::tileRect(int bucket) const
+{
+    return QRect((bucket % SPRITE_COLUMNS) * TILE_WIDTH, (bucket / SPRITE_COLUMNS) * TILE_HEIGHT,
+                 TILE_WIDTH, TILE_HEIGHT);
+}
+
+int SeekThumbnailService::bucketIndex(qint64 position) const
+{
+    const qint64 bucket = qMax<qint64>(0, position) / m_bucketDuration;
+    return static_cast<int>(qMin<qint64>(bucket, qMax(0, m_bucketCount - 1)));
+}
+
+QString SeekThumbnailService::mediaKey(const QString& path)
+{
+    // Only local files can be recognised again; the key changes when the file does
+    QUrl url(path);
+    QFileInfo info(url.isLocalFile() ? url.toLocalFile() : path);
+    if (!info.exists() || !info.isFile()) {
+        return QString();
+    }
+
+    const QString identity = info.canonicalFilePath() + QLatin1Char('|') + QString::number(info.size()) +
+                             QLatin1Char('|') + QString::number(info.lastModified().toMSecsSinceEpoch());
+    return QString::fromLatin1(QCryptographicHash::hash(identity.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
@@ -1,35 +1,141 @@
 #include "media/VLCBackend.h"
 #include "UserPreferences.h"
+#include "TraceLog.h"
+#include "Metrics.h"
+#include "Breadcrumbs.h"
+#include "PowerPolicy.h"
+#include "ThreadPriority.h"
+#include "media/MediaOpenProfiler.h"
+#include "media/SeekIndex.h"
+#include "network/JitterBufferController.h"
+#include "security/MediaFileValidator.h"
+#include "security/SandboxedDecoderPool.h"
 #include <QLoggingCategory>
+#include <QFile>
 #include <QFileInfo>
 #include <QDir>
 #include <QStandardPaths>
 #include <QMutexLocker>
 #include <QUrl>
 #include <QThread>
+#include <QtMath>
 
 // libVLC includes
 #include <vlc/vlc.h>
-
-// libVLC includes
-#include <vlc/vlc.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
 
 Q_LOGGING_CATEGORY(vlcBackend, "mediaplayer.vlcbackend")
 
+// Local copy a media created by createMedia() reads, see setPrefetchedCopy()
+struct PrefetchedSource
+{
+    PrefetchedCopy copy;
+    QString sourcePath;
+};
+
+namespace {
+
+constexpr qint64 STATS_POLL_INTERVAL_US = 1000000;
+
+MetricCounter& droppedFrames()
+{
+    static MetricCounter& counter = MetricsRegistry::instance().counter(
+        "eonplay_video_frames_dropped", "Video pictures decoded but never displayed");
+    return counter;
+}
+
+MetricCounter& lostAudioBuffers()
+{
+    static MetricCounter& counter = MetricsRegistry::instance().counter(
+        "eonplay_audio_buffers_lost", "Audio buffers the output dropped (underruns and late buffers)");
+    return counter;
+}
+
+// One open of prefetched media; libVLC reads it from its input thread
+struct PrefetchedReader
+{
+    QFile copy;
+    QFile source;
+    qint64 copyBytes = 0;
+    qint64 offset = 0;
+};
+
+int openPrefetched(void* opaque, void** data, uint64_t* size)
+{
+    const auto* prefetched = static_cast<const PrefetchedSource*>(opaque);
+    auto reader = std::make_unique<PrefetchedReader>();
+    reader->copy.setFileName(prefetched->copy.localPath);
+    reader->source.setFileName(prefetched->sourcePath);
+    reader->copyBytes = prefetched->copy.bytes;
+    if (!reader->copy.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    
+    *size = uint64_t(prefetched->copy.sourceSize);
+    *data = reader.release();
+    return 0;
+}
+
+ssize_t readPrefetched(void* data, unsigned char* buffer, size_t length)
+{
+    auto* reader = static_cast<PrefetchedReader*>(data);
+    const bool fromCopy = reader->offset < reader->copyBytes;
+    QFile& file = fromCopy ? reader->copy : reader->source;
+    if (!file.isOpen() && !file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    
+    // Reads never cross the end of the copy, so each comes from one file
+    qint64 wanted = qint64(length);
+    if (fromCopy) {
+        wanted = qMin(wanted, reader->copyBytes - reader->offset);
+    }
+    if (file.pos() != reader->offset && !file.seek(reader->offset)) {
+        return -1;
+    }
+    
+    const qint64 read = file.read(reinterpret_cast<char*>(buffer), wanted);
+    if (read < 0) {
+        return -1;
+    }
+    reader->offset += read;
+    return ssize_t(read);
+}
+
+int seekPrefetched(void* data, uint64_t offset)
+{
+    static_cast<PrefetchedReader*>(data)->offset = qint64(offset);
+    return 0;
+}
+
+void closePrefetched(void* data)
+{
+    delete static_cast<PrefetchedReader*>(data);
+}
+
+} // namespace
+
 VLCBackend::VLCBackend(QObject* parent)
     : IMediaEngine(parent)
     , m_vlcInstance(nullptr)
-    , m_mediaPlayer(nullptr)
-    , m_currentMedia(nullptr)
-    , m_eventManager(nullptr)
+    , m_player(std::make_unique<PlayerSlot>(this))
+    , m_gpuOutput(nullptr)
+    , m_audioOutput(nullptr)
+    , m_decoderSandbox(nullptr)
     , m_currentState(PlaybackState::Stopped)
     , m_currentVolume(100)
-    , m_currentPosition(0)
     , m_currentDuration(0)
     , m_initialized(false)
-    , m_positionTimer(new QTimer(this))
+    , m_clock(new PlaybackClock(this))
+    , m_fadeTimer(new QTimer(this))
+    , m_fadeDuration(0)
     , m_maxFileSize(10LL * 1024 * 1024 * 1024) // 10GB max file size
     , m_hardwareAcceleration(std::make_unique<HardwareAcceleration>(this))
+    , m_frameSequence(0)
 {
     qCDebug(vlcBackend) << "VLCBackend created";
     
@@ -38,9 +144,18 @@ VLCBackend::VLCBackend(QObject* parent)
                        << "mp3" << "flac" << "wav" << "aac" << "ogg" << "wma" << "m4a"
                        << "m3u" << "m3u8" << "pls" << "xspf";
     
-    // Setup position update timer
-    m_positionTimer->setInterval(100); // Update every 100ms
-    connect(m_positionTimer, &QTimer::timeout, this, &VLCBackend::updatePosition);
+    // Position jumps are reported as signals, steady progress to subscribers
+    connect(m_clock, &PlaybackClock::discontinuity, this, &IMediaEngine::playbackPositionChanged);
+    
+    m_fadeTimer->setInterval(FADE_STEP_MS);
+    connect(m_fadeTimer, &QTimer::timeout, this, &VLCBackend::updateFade);
+    
+    // Takes effect with the next media; switching decoders mid-playback would stutter
+    PowerPolicy& power = PowerPolicy::instance();
+    m_hardwareAcceleration->setHardwareDecodeForced(power.profile().forceHardwareDecode);
+    connect(&power, &PowerPolicy::profileChanged, this, [this](const PowerPolicy::Profile& profile) {
+        m_hardwareAcceleration->setHardwareDecodeForced(profile.forceHardwareDecode);
+    });
 }
 
 VLCBackend::~VLCBackend()
@@ -97,7 +212,6 @@ void VLCBackend::shutdown()
     
     qCDebug(vlcBackend) << "Shutting down VLCBackend";
     
-    m_positionTimer->stop();
     cleanupVLC();
     
     m_initialized = false;
@@ -106,6 +220,8 @@ void VLCBackend::shutdown()
 
 bool VLCBackend::initializeVLC()
 {
+    TraceScope trace("vlc.init");
+    
     // Create libVLC arguments for security and performance
     QStringList vlcArgs;
     
@@ -121,16 +237,10 @@ bool VLCBackend::initializeVLC()
            << "--no-sout-keep"                   // Don't keep stream output
            << "--no-disable-screensaver";        // Allow screensaver control
     
-    // Performance options
-    vlcArgs << "--file-caching=1000"             // 1 second file caching
-           << "--network-caching=3000"           // 3 seconds network caching
-           << "--clock-jitter=0"                 // Reduce clock jitter
+    // Performance options; caching and decoders are chosen per media
+    vlcArgs << "--clock-jitter=0"                 // Reduce clock jitter
            << "--clock-synchro=0";               // Disable clock synchronization
     
-    // Add hardware acceleration arguments
-    QStringList hwAccelArgs = m_hardwareAcceleration->getVLCArguments();
-    vlcArgs.append(hwAccelArgs);
-    
     // Convert QStringList to char* array
     QList<QByteArray> argBytes;
     QList<const char*> argPointers;
@@ -148,67 +258,158 @@ bool VLCBackend::initializeVLC()
     }
     
     // Create media player
-    m_mediaPlayer = libvlc_media_player_new(m_vlcInstance);
-    if (!m_mediaPlayer) {
+    if (!createPlayer(m_player.get())) {
         qCCritical(vlcBackend) << "Failed to create libVLC media player";
         libvlc_release(m_vlcInstance);
         m_vlcInstance = nullptr;
         return false;
     }
-    
-    // Setup event callbacks
-    setupEventCallbacks();
+    if (m_gpuOutput) {
+        m_gpuOutput->setActivePlayer(m_player->player);
+    }
+    if (m_audioOutput) {
+        m_audioOutput->setActivePlayer(m_player->player);
+    }
     
     // Configure additional sandboxing
     configureSandboxing();
     
+    // Still off the open path: initialization runs alongside other components
+    createSparePlayer();
+    
     qCDebug(vlcBackend) << "libVLC initialized successfully";
     return true;
 }
 
-void VLCBackend::setupEventCallbacks()
+bool VLCBackend::createPlayer(PlayerSlot* slot)
+{
+    slot->player = libvlc_media_player_new(m_vlcInstance);
+    if (!slot->player) {
+        return false;
+    }
+    
+    // Setup event callbacks
+    setupEventCallbacks(slot);
+    
+    // Decode video into the GPU output if it takes the player, pooled frames otherwise
+    if (!m_gpuOutput || !m_gpuOutput->attachPlayer(slot->player)) {
+        setupVideoCallbacks(slot);
+    }
+    
+    // Audio goes to the audio output if it takes the player, libVLC's own otherwise
+    if (m_audioOutput) {
+        m_audioOutput->attachPlayer(slot->player);
+    }
+    
+    return true;
+}
+
+void VLCBackend::releasePlayer(PlayerSlot* slot)
+{
+    // Release media player; no callbacks for the slot run after this
+    if (slot->player) {
+        libvlc_media_player_stop(slot->player);
+        libvlc_media_player_release(slot->player);
+        if (m_gpuOutput) {
+            m_gpuOutput->detachPlayer(slot->player);
+        }
+        if (m_audioOutput) {
+            m_audioOutput->detachPlayer(slot->player);
+        }
+        slot->player = nullptr;
+    }
+    
+    // Release its media
+    if (slot->media) {
+        libvlc_media_release(slot->media);
+        slot->media = nullptr;
+    }
+    slot->prefetched.reset();
+    
+    endSource(slot);
+    slot->path.clear();
+    
+    QMutexLocker locker(&m_frameMutex);
+    slot->pendingFrame.reset();
+}
+
+void VLCBackend::discardPlayer(std::unique_ptr<PlayerSlot>& slot)
+{
+    if (slot) {
+        releasePlayer(slot.get());
+        slot.reset();
+    }
+}
+
+std::unique_ptr<VLCBackend::PlayerSlot> VLCBackend::takeSparePlayer()
 {
-    if (!m_mediaPlayer) {
+    std::unique_ptr<PlayerSlot> slot = std::move(m_sparePlayer);
+    if (!slot) {
+        slot = std::make_unique<PlayerSlot>(this);
+        if (!createPlayer(slot.get())) {
+            return nullptr;
+        }
+    }
+    
+    // Replaced after the caller has opened its media
+    QTimer::singleShot(0, this, [this]() {
+        createSparePlayer();
+    });
+    return slot;
+}
+
+void VLCBackend::createSparePlayer()
+{
+    if (m_sparePlayer || !m_vlcInstance) {
         return;
     }
     
-    m_eventManager = libvlc_media_player_event_manager(m_mediaPlayer);
-    if (!m_eventManager) {
+    auto slot = std::make_unique<PlayerSlot>(this);
+    slot->role = SlotRole::Retiring;    // Has no media; any event is ignored
+    if (createPlayer(slot.get())) {
+        m_sparePlayer = std::move(slot);
+    }
+}
+
+void VLCBackend::setupEventCallbacks(PlayerSlot* slot)
+{
+    libvlc_event_manager_t* eventManager = libvlc_media_player_event_manager(slot->player);
+    if (!eventManager) {
         qCWarning(vlcBackend) << "Failed to get event manager";
         return;
     }
     
     // Register for important events
-    libvlc_event_attach(m_eventManager, libvlc_MediaPlayerPlaying, vlcEventCallback, this);
-    libvlc_event_attach(m_eventManager, libvlc_MediaPlayerPaused, vlcEventCallback, this);
-    libvlc_event_attach(m_eventManager, libvlc_MediaPlayerStopped, vlcEventCallback, this);
-    libvlc_event_attach(m_eventManager, libvlc_MediaPlayerEndReached, vlcEventCallback, this);
-    libvlc_event_attach(m_eventManager, libvlc_MediaPlayerEncounteredError, vlcEventCallback, this);
-    libvlc_event_attach(m_eventManager, libvlc_MediaPlayerBuffering, vlcEventCallback, this);
-    libvlc_event_attach(m_eventManager, libvlc_MediaPlayerLengthChanged, vlcEventCallback, this);
+    libvlc_event_attach(eventManager, libvlc_MediaPlayerPlaying, vlcEventCallback, slot);
+    libvlc_event_attach(eventManager, libvlc_MediaPlayerPaused, vlcEventCallback, slot);
+    libvlc_event_attach(eventManager, libvlc_MediaPlayerStopped, vlcEventCallback, slot);
+    libvlc_event_attach(eventManager, libvlc_MediaPlayerEndReached, vlcEventCallback, slot);
+    libvlc_event_attach(eventManager, libvlc_MediaPlayerEncounteredError, vlcEventCallback, slot);
+    libvlc_event_attach(eventManager, libvlc_MediaPlayerBuffering, vlcEventCallback, slot);
+    libvlc_event_attach(eventManager, libvlc_MediaPlayerLengthChanged, vlcEventCallback, slot);
+    libvlc_event_attach(eventManager, libvlc_MediaPlayerTimeChanged, vlcEventCallback, slot);
     
     qCDebug(vlcBackend) << "Event callbacks registered";
 }
 
-void VLCBackend::cleanupVLC()
+void VLCBackend::setupVideoCallbacks(PlayerSlot* slot)
 {
-    // Stop position timer
-    if (m_positionTimer) {
-        m_positionTimer->stop();
-    }
+    libvlc_video_set_callbacks(slot->player, videoLockCallback, videoUnlockCallback, videoDisplayCallback, slot);
+    libvlc_video_set_format_callbacks(slot->player, videoFormatCallback, videoCleanupCallback);
     
-    // Release current media
-    if (m_currentMedia) {
-        libvlc_media_release(m_currentMedia);
-        m_currentMedia = nullptr;
-    }
+    qCDebug(vlcBackend) << "Video frame callbacks registered";
+}
+
+void VLCBackend::cleanupVLC()
+{
+    releaseSandboxed();
     
-    // Release media player
-    if (m_mediaPlayer) {
-        libvlc_media_player_stop(m_mediaPlayer);
-        libvlc_media_player_release(m_mediaPlayer);
-        m_mediaPlayer = nullptr;
-    }
+    // Release all media players before the instance
+    m_fadeTimer->stop();
+    discardPlayer(m_sparePlayer);
+    discardPlayer(m_retiringPlayer);
+    discardPlayer(m_nextPlayer);
+    releasePlayer(m_player.get());
     
     // Release libVLC instance
     if (m_vlcInstance) {
@@ -216,17 +417,23 @@ void VLCBackend::cleanupVLC()
         m_vlcInstance = nullptr;
     }
     
-    m_eventManager = nullptr;
+    {
+        QMutexLocker frameLocker(&m_frameMutex);
+        m_latestFrame.reset();
+    }
     
     QMutexLocker locker(&m_stateMutex);
     m_currentState = PlaybackState::Stopped;
-    m_currentPosition = 0;
     m_currentDuration = 0;
+    locker.unlock();
+    
+    m_clock->setRunning(false);
+    m_clock->reset(0);
 }
 
 bool VLCBackend::loadMedia(const QString& path)
 {
-    if (!m_initialized || !m_mediaPlayer) {
+    if (!m_initialized || !m_player->player) {
         qCWarning(vlcBackend) << "VLCBackend not initialized";
         return false;
     }
@@ -237,38 +444,80 @@ bool VLCBackend::loadMedia(const QString& path)
     }
     
     qCDebug(vlcBackend) << "Loading media:" << path;
+    BreadcrumbRing::instance().record(BreadcrumbRing::MediaOpen, QFileInfo(path).fileName().toUtf8());
+    
+    // Opened directly rather than through the controller or FileUrlSupport
+    MediaOpenProfiler& profiler = MediaOpenProfiler::instance();
+    if (!profiler.isPending(path)) {
+        profiler.begin(path);
+    }
     
     // Validate media file for security
-    if (!validateMediaFile(path)) {
+    MediaOpenPhaseScope validatePhase(path, "engine.validate");
+    const bool valid = validateMediaFile(path);
+    validatePhase.end();
+    
+    if (!valid) {
         qCWarning(vlcBackend) << "Media file validation failed:" << path;
+        profiler.abandon(path);
         emit errorOccurred("Invalid or unsafe media file");
         return false;
     }
     
-    // Release previous media
-    if (m_currentMedia) {
-        libvlc_media_release(m_currentMedia);
-        m_currentMedia = nullptr;
+    finishFade();
+    
+    // Untrusted downloads are decoded out of process
+    if (m_decoderSandbox && m_decoderSandbox->shouldSandbox(path)) {
+        return loadSandboxed(path);
+    }
+    releaseSandboxed();
+    
+    // Preloaded media is already open and buffered; take it over instead of re-opening
+    if (m_nextPlayer && m_nextPlayer->path == path) {
+        // Its open happened in the background and is not a user-visible latency
+        profiler.abandon(path);
+        promotePreloaded();
+        discardPlayer(m_retiringPlayer);
+        libvlc_audio_set_volume(m_player->player, m_currentVolume);
+        
+        qCDebug(vlcBackend) << "Media taken over from preload:" << path;
+        emit mediaLoaded(true);
+        return true;
     }
     
-    // Create new media
-    QUrl url(path);
-    if (url.isLocalFile() || !url.scheme().isEmpty()) {
-        // Handle URLs (including file:// URLs)
-        m_currentMedia = libvlc_media_new_location(m_vlcInstance, path.toUtf8().constData());
-    } else {
-        // Handle local file paths
-        m_currentMedia = libvlc_media_new_path(m_vlcInstance, path.toUtf8().constData());
+    MediaOpenPhaseScope openPhase(path, "engine.open");
+    
+    // Release previous media; its host profile is stored before the new media reads it
+    if (m_player->media) {
+        libvlc_media_release(m_player->media);
+        m_player->media = nullptr;
     }
+    endSource(m_player.get());
     
-    if (!m_currentMedia) {
+    // Create new media
+    m_player->media = createMedia(m_player.get(), path);
+    if (!m_player->media) {
         qCCritical(vlcBackend) << "Failed to create libVLC media for:" << path;
+        profiler.abandon(path);
         emit errorOccurred("Failed to load media file");
         return false;
     }
+    attachSeekIndex(m_player.get(), path);
     
     // Set media to player
-    libvlc_media_player_set_media(m_mediaPlayer, m_currentMedia);
+    libvlc_media_player_set_media(m_player->player, m_player->media);
+    m_player->path = path;
+    beginSource(m_player.get(), path);
+    resetDecoderStats();
+    m_player->ready = true;
+    openPhase.end();
+    
+    {
+        QMutexLocker locker(&m_stateMutex);
+        m_currentDuration = 0;
+    }
+    m_clock->setRunning(false);
+    m_clock->reset(0);
     
     qCDebug(vlcBackend) << "Media loaded successfully:" << path;
     emit mediaLoaded(true);
@@ -276,194 +525,808 @@ bool VLCBackend::loadMedia(const QString& path)
     return true;
 }
 
-void VLCBackend::play()
+libvlc_media_t* VLCBackend::createMedia(PlayerSlot* slot, const QString& path)
 {
-    if (!m_initialized || !m_mediaPlayer) {
-        qCWarning(vlcBackend) << "Cannot play: VLCBackend not initialized";
-        return;
+    libvlc_media_t* media = nullptr;
+    QUrl url(path);
+    slot->prefetched.reset();
+    
+    PrefetchedCopy copy;
+    if (m_prefetchedPath == path) {
+        copy = std::exchange(m_prefetchedCopy, PrefetchedCopy());
+        m_prefetchedPath.clear();
     }
     
-    if (!m_currentMedia) {
-        qCWarning(vlcBackend) << "Cannot play: No media loaded";
-        return;
+    if (copy.isComplete()) {
+        media = libvlc_media_new_path(m_vlcInstance, copy.localPath.toUtf8().constData());
+    } else if (copy.isValid() && !url.isLocalFile() && url.scheme().isEmpty()) {
+        // The copy up to its end, the share after it; the share is only opened when read past the copy
+        auto source = std::make_shared<PrefetchedSource>();
+        source->copy = copy;
+        source->sourcePath = path;
+        slot->prefetched = source;
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(4, 0, 0, 0)
+        media = libvlc_media_new_callbacks(openPrefetched, readPrefetched, seekPrefetched, closePrefetched,
+                                           source.get());
+#else
+        media = libvlc_media_new_callbacks(m_vlcInstance, openPrefetched, readPrefetched, seekPrefetched,
+                                           closePrefetched, source.get());
+#endif
+    } else if (url.isLocalFile() || !url.scheme().isEmpty()) {
+        // Handle URLs (including file:// URLs)
+        media = libvlc_media_new_location(m_vlcInstance, path.toUtf8().constData());
+    } else {
+        // Handle local file paths
+        media = libvlc_media_new_path(m_vlcInstance, path.toUtf8().constData());
     }
     
-    qCDebug(vlcBackend) << "Starting playback";
+    if (media) {
+        const QStringList options = sourceOptions(path) + m_hardwareAcceleration->getVLCMediaOptions();
+        for (const QString& option : options) {
+            libvlc_media_add_option(media, option.toUtf8().constData());
+        }
+    }
+    return media;
+}
+
+VLCBackend::SourceKind VLCBackend::sourceKindOf(const QString& path)
+{
+    const QUrl url(path);
+    const QString scheme = url.scheme().toLower();
     
-    int result = libvlc_media_player_play(m_mediaPlayer);
-    if (result == -1) {
-        qCCritical(vlcBackend) << "Failed to start playback";
-        emit errorOccurred("Failed to start playback");
-        return;
+    // A drive letter parses as a one-letter scheme
+    if (scheme.size() <= 1 || url.isLocalFile()) {
+        return SourceKind::File;
     }
     
-    // Start position updates
-    m_positionTimer->start();
+    static const QStringList liveSchemes = {"rtsp", "rtsps", "rtp", "udp", "mms", "mmsh", "rtmp", "srt"};
+    if (liveSchemes.contains(scheme) || url.path().endsWith(".m3u8", Qt::CaseInsensitive)) {
+        return SourceKind::Live;
+    }
+    return SourceKind::Network;
 }
 
-void VLCBackend::pause()
+QStringList VLCBackend::sourceOptions(const QString& path)
 {
-    if (!m_initialized || !m_mediaPlayer) {
-        qCWarning(vlcBackend) << "Cannot pause: VLCBackend not initialized";
-        return;
+    const SourceKind kind = sourceKindOf(path);
+    if (kind == SourceKind::File) {
+        return {QString(":file-caching=%1").arg(FILE_CACHING_MS)};
     }
     
-    qCDebug(vlcBackend) << "Pausing playback";
-    libvlc_media_player_pause(m_mediaPlayer);
+    const int cachingMs = JitterBufferController::instance().cachingFor(QUrl(path), kind == SourceKind::Live);
+    if (kind == SourceKind::Network) {
+        return {QString(":network-caching=%1").arg(cachingMs), ":http-reconnect"};
+    }
+    
+    // Decoder speed tricks keep a live stream from falling behind its edge
+    return {QString(":network-caching=%1").arg(cachingMs), QString(":live-caching=%1").arg(cachingMs),
+            ":avcodec-fast"};
 }
 
-void VLCBackend::stop()
+void VLCBackend::beginSource(PlayerSlot* slot, const QString& path)
 {
-    if (!m_initialized || !m_mediaPlayer) {
-        qCWarning(vlcBackend) << "Cannot stop: VLCBackend not initialized";
-        return;
+    endSource(slot);
+    
+    slot->source = sourceKindOf(path);
+    slot->filled = false;
+    slot->stalled = false;
+    if (slot->source != SourceKind::File) {
+        JitterBufferController::instance().openStream(slot, QUrl(path), slot->source == SourceKind::Live);
+    }
+}
+
+void VLCBackend::endSource(PlayerSlot* slot)
+{
+    if (slot->source != SourceKind::File) {
+        JitterBufferController::instance().closeStream(slot);
+        slot->source = SourceKind::File;
+    }
+}
+
+bool VLCBackend::preloadMedia(const QString& path)
+{
+    if (!m_initialized || !m_vlcInstance) {
+        qCWarning(vlcBackend) << "Cannot preload: VLCBackend not initialized";
+        return false;
     }
     
-    qCDebug(vlcBackend) << "Stopping playback";
+    // A preload would parse the file in this process
+    if (m_decoderSandbox && m_decoderSandbox->shouldSandbox(path)) {
+        qCDebug(vlcBackend) << "Not preloading a file for the decoder sandbox:" << path;
+        return false;
+    }
+    
+    if (m_nextPlayer && m_nextPlayer->path == path) {
+        return true;
+    }
+    
+    if (!validateMediaFile(path)) {
+        qCWarning(vlcBackend) << "Preload validation failed:" << path;
+        return false;
+    }
     
-    // Stop position updates
-    m_positionTimer->stop();
+    clearPreloadedMedia();
+    
+    std::unique_ptr<PlayerSlot> slot = takeSparePlayer();
+    if (!slot) {
+        qCWarning(vlcBackend) << "Failed to create media player for preload";
+        return false;
+    }
+    slot->role = SlotRole::Preloaded;
+    slot->ready = false;
     
-    libvlc_media_player_stop(m_mediaPlayer);
+    slot->media = createMedia(slot.get(), path);
+    if (!slot->media) {
+        qCWarning(vlcBackend) << "Failed to create libVLC media for preload:" << path;
+        releasePlayer(slot.get());
+        return false;
+    }
+    attachSeekIndex(slot.get(), path);
     
-    QMutexLocker locker(&m_stateMutex);
-    m_currentPosition = 0;
+    // Open, demux and buffer up to the first frame, then hold there
+    libvlc_media_add_option(slot->media, ":start-paused");
+    libvlc_media_player_set_media(slot->player, slot->media);
+    slot->path = path;
+    beginSource(slot.get(), path);
+    
+    if (libvlc_media_player_play(slot->player) == -1) {
+        qCWarning(vlcBackend) << "Failed to start preloading:" << path;
+        releasePlayer(slot.get());
+        return false;
+    }
+    
+    qCDebug(vlcBackend) << "Preloading next media:" << path;
+    m_nextPlayer = std::move(slot);
+    return true;
 }
 
-void VLCBackend::seek(qint64 position)
+void VLCBackend::clearPreloadedMedia()
 {
-    if (!m_initialized || !m_mediaPlayer) {
-        qCWarning(vlcBackend) << "Cannot seek: VLCBackend not initialized";
-        return;
+    if (m_nextPlayer) {
+        qCDebug(vlcBackend) << "Dropping preloaded media:" << m_nextPlayer->path;
+        discardPlayer(m_nextPlayer);
+    }
+}
+
+QString VLCBackend::preloadedMedia() const
+{
+    return m_nextPlayer ? m_nextPlayer->path : QString();
+}
+
+bool VLCBackend::switchToPreloadedMedia(int overlapMs)
+{
+    if (!m_initialized || !m_nextPlayer) {
+        return false;
     }
     
-    if (!m_currentMedia) {
-        qCWarning(vlcBackend) << "Cannot seek: No media loaded";
-        return;
+    finishFade();
+    
+    const QString path = m_nextPlayer->path;
+    qCDebug(vlcBackend) << "Switching to preloaded media:" << path << "overlap:" << overlapMs << "ms";
+    
+    promotePreloaded();
+    
+    if (overlapMs > 0 && m_retiringPlayer->player && libvlc_media_player_is_playing(m_retiringPlayer->player)) {
+        // Both players run until the ramp is done
+        libvlc_audio_set_volume(m_player->player, 0);
+        m_fadeDuration = overlapMs;
+        m_fadeClock.start();
+        m_fadeTimer->start();
+    } else {
+        discardPlayer(m_retiringPlayer);
+        libvlc_audio_set_volume(m_player->player, m_currentVolume);
     }
     
-    qCDebug(vlcBackend) << "Seeking to position:" << position;
+    resumePlayer(m_player.get());
     
-    // Convert milliseconds to libVLC time (microseconds)
-    libvlc_time_t vlcTime = position * 1000;
-    libvlc_media_player_set_time(m_mediaPlayer, vlcTime);
+    emit preloadedMediaStarted(path);
+    return true;
 }
 
-void VLCBackend::setVolume(int volume)
+void VLCBackend::promotePreloaded()
 {
-    if (!m_initialized || !m_mediaPlayer) {
-        qCWarning(vlcBackend) << "Cannot set volume: VLCBackend not initialized";
-        return;
-    }
-    
-    // Clamp volume to valid range
-    volume = qBound(0, volume, 100);
+    releaseSandboxed();
     
-    qCDebug(vlcBackend) << "Setting volume to:" << volume;
+    std::unique_ptr<PlayerSlot> previous = std::move(m_player);
+    previous->role = SlotRole::Retiring;
     
-    int result = libvlc_audio_set_volume(m_mediaPlayer, volume);
-    if (result == -1) {
-        qCWarning(vlcBackend) << "Failed to set volume";
-        return;
+    m_player = std::move(m_nextPlayer);
+    m_player->role = SlotRole::Active;
+    m_retiringPlayer = std::move(previous);
+    if (m_gpuOutput) {
+        m_gpuOutput->setActivePlayer(m_player->player);
     }
+    if (m_audioOutput) {
+        m_audioOutput->setActivePlayer(m_player->player);
+    }
+    resetDecoderStats();
     
-    QMutexLocker locker(&m_stateMutex);
-    m_currentVolume = volume;
+    {
+        QMutexLocker locker(&m_stateMutex);
+        m_currentDuration = 0;
+    }
     
-    emit volumeChanged(volume);
+    // Runs again with the Playing event of the new player
+    m_clock->setRunning(false);
+    m_clock->reset(0);
 }
 
-qint64 VLCBackend::position() const
+void VLCBackend::resumePlayer(PlayerSlot* slot)
 {
-    if (!m_initialized || !m_mediaPlayer) {
-        return 0;
+    // Whichever of this and the first-frame event comes second resumes
+    slot->resumeWhenReady = true;
+    if (slot->ready && slot->resumeWhenReady.exchange(false)) {
+        libvlc_media_player_set_pause(slot->player, 0);
+    }
+}
+
+bool VLCBackend::markReady(PlayerSlot* slot)
+{
+    slot->ready = true;
+    if (!slot->resumeWhenReady.exchange(false)) {
+        return false;
     }
     
-    // Get time from libVLC (in microseconds) and convert to milliseconds
-    libvlc_time_t vlcTime = libvlc_media_player_get_time(m_mediaPlayer);
-    return vlcTime / 1000;
+    // libVLC must not be called from its own event thread
+    QMetaObject::invokeMethod(this, [this, slot]() {
+        if (slot == m_player.get() && slot->player) {
+            libvlc_media_player_set_pause(slot->player, 0);
+        }
+    }, Qt::QueuedConnection);
+    return true;
 }
 
-qint64 VLCBackend::duration() const
+void VLCBackend::updateFade()
 {
-    if (!m_initialized || !m_mediaPlayer) {
-        return 0;
+    const double progress = std::min(1.0, m_fadeClock.elapsed() / static_cast<double>(std::max(1, m_fadeDuration)));
+    
+    // Equal-power ramps keep the combined loudness constant across the overlap
+    const double angle = qDegreesToRadians(progress * 90.0);
+    libvlc_audio_set_volume(m_player->player, qRound(m_currentVolume * std::sin(angle)));
+    if (m_retiringPlayer && m_retiringPlayer->player) {
+        libvlc_audio_set_volume(m_retiringPlayer->player, qRound(m_currentVolume * std::cos(angle)));
     }
     
-    // Get length from libVLC (in microseconds) and convert to milliseconds
-    libvlc_time_t vlcLength = libvlc_media_player_get_length(m_mediaPlayer);
-    return vlcLength / 1000;
+    if (progress >= 1.0) {
+        finishFade();
+    }
 }
 
-void VLCBackend::updatePosition()
+void VLCBackend::finishFade()
 {
-    if (!m_initialized || !m_mediaPlayer) {
+    if (!m_retiringPlayer) {
         return;
     }
     
-    qint64 newPosition = position();
-    qint64 newDuration = duration();
+    m_fadeTimer->stop();
+    discardPlayer(m_retiringPlayer);
     
-    bool positionChanged = false;
-    bool durationChanged = false;
+    if (m_player->player) {
+        libvlc_audio_set_volume(m_player->player, m_currentVolume);
+    }
+}
+
+void VLCBackend::reportFirstOutput(PlayerSlot* slot, bool video, qint64 atUs)
+{
+    if (!slot->awaitingFirstFrame.exchange(false)) {
+        return;
+    }
     
-    {
-        QMutexLocker locker(&m_stateMutex);
-        
-        if (newPosition != m_currentPosition) {
-            m_currentPosition = newPosition;
-            emit playbackPositionChanged(newPosition);
-        }
-        
-        if (newDuration != m_currentDuration && newDuration > 0) {
-            m_currentDuration = newDuration;
-            emit playbackDurationChanged(newDuration);
-        }
+    MediaOpenProfiler& profiler = MediaOpenProfiler::instance();
+    const qint64 playingUs = slot->playingUs;
+    if (playingUs >= 0) {
+        profiler.addPhase(slot->path, video ? "engine.firstFrame" : "engine.firstAudio", playingUs, atUs - playingUs);
     }
+    profiler.finish(slot->path, video, atUs);
 }
 
-void VLCBackend::handleVLCEvent(const libvlc_event_t* event)
+void VLCBackend::pollDecoderStats(PlayerSlot* slot)
 {
-    if (!event) {
+    const qint64 nowUs = TraceLog::instance().now();
+    QMutexLocker locker(&m_statsMutex);
+    if (!slot->media || nowUs - slot->statsPolledUs < STATS_POLL_INTERVAL_US) {
         return;
     }
+    const qint64 previousPollUs = slot->statsPolledUs;
+    slot->statsPolledUs = nowUs;
     
-    PlaybackState newState = m_currentState;
+    libvlc_media_stats_t stats;
+    if (!libvlc_media_get_stats(slot->media, &stats)) {
+        return;
+    }
     
-    switch (event->type) {
-        case libvlc_MediaPlayerPlaying:
-            qCDebug(vlcBackend) << "VLC Event: Playing";
-            newState = PlaybackState::Playing;
-            break;
-            
-        case libvlc_MediaPlayerPaused:
-            qCDebug(vlcBackend) << "VLC Event: Paused";
-            newState = PlaybackState::Paused;
-            break;
-            
-        case libvlc_MediaPlayerStopped:
-        case libvlc_MediaPlayerEndReached:
-            qCDebug(vlcBackend) << "VLC Event: Stopped/End Reached";
+    // Counters restart with each media; a drop means a new baseline
+    const int lostPictures = qMax(0, stats.i_lost_pictures - slot->lostPictures);
+    const int decodedVideo = qMax(0, stats.i_decoded_video - slot->decodedVideo);
+    const quint64 poolDrops = slot->poolDrops.load(std::memory_order_relaxed);
+    const quint64 newPoolDrops = poolDrops - qMin(poolDrops, slot->polledPoolDrops);
+    droppedFrames().add(lostPictures);
+    if (stats.i_lost_abuffers > slot->lostAudioBuffers) {
+        lostAudioBuffers().add(stats.i_lost_abuffers - slot->lostAudioBuffers);
+    }
+    slot->lostPictures = stats.i_lost_pictures;
+    slot->lostAudioBuffers = stats.i_lost_abuffers;
+    slot->decodedVideo = stats.i_decoded_video;
+    slot->polledPoolDrops = poolDrops;
+    
+    // Polls only run while time advances; an interval spanning a pause says nothing about arrival
+    if (slot->source != SourceKind::File) {
+        const qint64 intervalUs = nowUs - previousPollUs;
+        if (previousPollUs > 0 && intervalUs <= 2 * STATS_POLL_INTERVAL_US) {
+            JitterBufferController::instance().addArrivalSample(slot, stats.i_read_bytes - slot->readBytes,
+                                                                intervalUs / 1000);
+        }
+        slot->readBytes = stats.i_read_bytes;
+    }
+    
+    // libVLC reports bitrates in bytes per millisecond
+    m_decoderStats.valid = true;
+    m_decoderStats.decodedVideo = stats.i_decoded_video;
+    m_decoderStats.displayedPictures = stats.i_displayed_pictures;
+    m_decoderStats.lostPictures = stats.i_lost_pictures;
+    m_decoderStats.poolDroppedPictures = static_cast<qint64>(poolDrops);
+    m_decoderStats.decodedAudio = stats.i_decoded_audio;
+    m_decoderStats.playedAudioBuffers = stats.i_played_abuffers;
+    m_decoderStats.lostAudioBuffers = stats.i_lost_abuffers;
+    m_decoderStats.demuxCorrupted = stats.i_demux_corrupted;
+    m_decoderStats.demuxDiscontinuities = stats.i_demux_discontinuity;
+    m_decoderStats.inputBitrate = stats.f_input_bitrate * 8000.0;
+    m_decoderStats.demuxBitrate = stats.f_demux_bitrate * 8000.0;
+    m_decoderStats.dropPercent = decodedVideo > 0
+        ? qMin(100.0, 100.0 * (lostPictures + static_cast<double>(newPoolDrops)) / decodedVideo)
+        : 0.0;
+}
+
+void VLCBackend::resetDecoderStats()
+{
+    QMutexLocker locker(&m_statsMutex);
+    m_decoderStats = DecoderStats();
+    m_player->statsPolledUs = 0;
+    m_player->lostPictures = 0;
+    m_player->lostAudioBuffers = 0;
+    m_player->decodedVideo = 0;
+    m_player->readBytes = 0;
+    m_player->poolDrops = 0;
+    m_player->polledPoolDrops = 0;
+}
+
+VLCBackend::DecoderStats VLCBackend::decoderStats() const
+{
+    DecoderStats stats;
+    {
+        QMutexLocker locker(&m_statsMutex);
+        stats = m_decoderStats;
+    }
+    
+    const bool hardware = m_hardwareAcceleration && m_hardwareAcceleration->isHardwareAccelerationEnabled();
+    stats.decoder = HardwareAcceleration::getAccelerationTypeName(
+        hardware ? m_hardwareAcceleration->activeAcceleration() : HardwareAccelerationType::Software);
+    return stats;
+}
+
+void VLCBackend::handleEndReached(PlayerSlot* slot)
+{
+    if (slot != m_player.get()) {
+        return;
+    }
+    
+    // Gapless: the next media is already buffered
+    if (m_nextPlayer && switchToPreloadedMedia(0)) {
+        return;
+    }
+    
+    m_clock->setRunning(false);
+    
+    QMutexLocker locker(&m_stateMutex);
+    if (m_currentState == PlaybackState::Stopped) {
+        return;
+    }
+    m_currentState = PlaybackState::Stopped;
+    locker.unlock();
+    
+    BreadcrumbRing::instance().record(BreadcrumbRing::Playback, "state",
+                                      static_cast<qint64>(PlaybackState::Stopped));
+    emit stateChanged(PlaybackState::Stopped);
+}
+
+void VLCBackend::play()
+{
+    if (!m_initialized || !m_player->player) {
+        qCWarning(vlcBackend) << "Cannot play: VLCBackend not initialized";
+        return;
+    }
+    
+    if (m_sandboxed) {
+        m_sandboxed->play();
+        return;
+    }
+    
+    if (!m_player->media) {
+        qCWarning(vlcBackend) << "Cannot play: No media loaded";
+        return;
+    }
+    
+    qCDebug(vlcBackend) << "Starting playback";
+    
+    // Time to first output is measured for opens still in progress
+    if (MediaOpenProfiler::instance().isPending(m_player->path)) {
+        m_player->playRequestedUs = TraceLog::instance().now();
+        m_player->playingUs = -1;
+        m_player->firstTimeSeen = false;
+        m_player->awaitingFirstFrame = true;
+    }
+    
+    // Taken over from a preload that is still buffering
+    if (!m_player->ready) {
+        resumePlayer(m_player.get());
+        return;
+    }
+    
+    int result = libvlc_media_player_play(m_player->player);
+    if (result == -1) {
+        qCCritical(vlcBackend) << "Failed to start playback";
+        emit errorOccurred("Failed to start playback");
+        return;
+    }
+}
+
+void VLCBackend::pause()
+{
+    if (!m_initialized || !m_player->player) {
+        qCWarning(vlcBackend) << "Cannot pause: VLCBackend not initialized";
+        return;
+    }
+    
+    qCDebug(vlcBackend) << "Pausing playback";
+    if (m_sandboxed) {
+        m_sandboxed->pause();
+        return;
+    }
+    libvlc_media_player_pause(m_player->player);
+}
+
+void VLCBackend::stop()
+{
+    if (!m_initialized || !m_player->player) {
+        qCWarning(vlcBackend) << "Cannot stop: VLCBackend not initialized";
+        return;
+    }
+    
+    qCDebug(vlcBackend) << "Stopping playback";
+    
+    finishFade();
+    
+    if (m_sandboxed) {
+        m_sandboxed->stop();
+    } else {
+        libvlc_media_player_stop(m_player->player);
+    }
+    
+    m_clock->setRunning(false);
+    m_clock->reset(0);
+}
+
+void VLCBackend::seek(qint64 position)
+{
+    seekTo(position, false);
+}
+
+void VLCBackend::seekFast(qint64 position)
+{
+    seekTo(position, true);
+}
+
+void VLCBackend::seekTo(qint64 position, bool fast)
+{
+    if (!m_initialized || !m_player->player) {
+        qCWarning(vlcBackend) << "Cannot seek: VLCBackend not initialized";
+        return;
+    }
+    
+    if (m_sandboxed) {
+        m_sandboxed->seek(position);
+        m_clock->reset(position);
+        return;
+    }
+    
+    if (!m_player->media) {
+        qCWarning(vlcBackend) << "Cannot seek: No media loaded";
+        return;
+    }
+    
+    if (seekByIndex(position)) {
+        return;
+    }
+    
+    qCDebug(vlcBackend) << "Seeking to position:" << position << (fast ? "(keyframe)" : "");
+    
+    // A keyframe can be a whole GOP away from the target
+    m_player->seekTargetMs = position;
+    m_player->seekToleranceMs = fast ? FAST_SEEK_TOLERANCE_MS : SEEK_TOLERANCE_MS;
+    m_player->seekPending = true;
+    
+    // Refilling after the seek is no stall
+    m_player->filled = false;
+    m_player->stalled = false;
+    
+    // Convert milliseconds to libVLC time (microseconds)
+    libvlc_time_t vlcTime = position * 1000;
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(4, 0, 0, 0)
+    libvlc_media_player_set_time(m_player->player, vlcTime, fast);
+#else
+    // libVLC 3 seeks exactly; scrubbing still gains from coalescing
+    Q_UNUSED(fast)
+    libvlc_media_player_set_time(m_player->player, vlcTime);
+#endif
+    
+    // Report the target now; time events correct it once the demuxer lands
+    m_clock->reset(position);
+}
+
+bool VLCBackend::seekByIndex(qint64 position)
+{
+    const std::shared_ptr<const SeekIndex> index = m_player->seekIndex;
+    if (!index || index->fileSize() <= 0 ||
+        (index->container() == SeekIndex::Container::MpegTs && !m_player->tsSeekPercent)) {
+        return false;
+    }
+    
+    // Decoding starts at the keyframe, so that is where the seek lands, precise or not
+    const SeekIndex::Keyframe keyframe = index->keyframeAt(position);
+    qCDebug(vlcBackend) << "Seeking to position:" << position << "by index, keyframe at" << keyframe.timeMs;
+    
+    m_player->seekTargetMs = keyframe.timeMs;
+    m_player->seekToleranceMs = SEEK_TOLERANCE_MS;
+    m_player->seekPending = true;
+    m_player->filled = false;
+    m_player->stalled = false;
+    
+    const double fraction = double(keyframe.offset) / double(index->fileSize());
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(4, 0, 0, 0)
+    libvlc_media_player_set_position(m_player->player, fraction, true);
+#else
+    // Rounded down: the demuxer resyncs forward onto the keyframe, never past it
+    float position32 = float(fraction);
+    if (double(position32) * double(index->fileSize()) > double(keyframe.offset)) {
+        position32 = std::nextafter(position32, 0.0f);
+    }
+    libvlc_media_player_set_position(m_player->player, position32);
+#endif
+    
+    m_clock->reset(keyframe.timeMs);
+    return true;
+}
+
+void VLCBackend::setSeekIndex(const QString& path, std::shared_ptr<const SeekIndex> index)
+{
+    // Kept for the next open of the path, which may be a re-open of the one playing
+    m_seekIndexPath = path;
+    m_seekIndex = index;
+    
+    for (PlayerSlot* slot : {m_player.get(), m_nextPlayer.get()}) {
+        if (slot && slot->media && slot->path == path) {
+            slot->seekIndex = index;
+        }
+    }
+}
+
+void VLCBackend::setPrefetchedCopy(const QString& path, const PrefetchedCopy& copy)
+{
+    m_prefetchedPath = copy.isValid() ? path : QString();
+    m_prefetchedCopy = copy.isValid() ? copy : PrefetchedCopy();
+    if (copy.isValid()) {
+        qCDebug(vlcBackend) << "Opening" << path << "from its local copy," << copy.bytes / 1024 << "KB of"
+                            << copy.sourceSize / 1024 << "KB";
+    }
+}
+
+void VLCBackend::attachSeekIndex(PlayerSlot* slot, const QString& path)
+{
+    slot->seekIndex.reset();
+    slot->tsSeekPercent = false;
+    if (m_seekIndexPath != path || !m_seekIndex) {
+        return;
+    }
+    
+    slot->seekIndex = std::exchange(m_seekIndex, nullptr);
+    m_seekIndexPath.clear();
+    
+    // The TS demuxer turns positions back into times by its bitrate estimate unless told not to
+    if (slot->seekIndex->container() == SeekIndex::Container::MpegTs) {
+        libvlc_media_add_option(slot->media, ":ts-seek-percent");
+        slot->tsSeekPercent = true;
+    }
+}
+
+void VLCBackend::setVolume(int volume)
+{
+    if (!m_initialized || !m_player->player) {
+        qCWarning(vlcBackend) << "Cannot set volume: VLCBackend not initialized";
+        return;
+    }
+    
+    // Clamp volume to valid range
+    volume = qBound(0, volume, 100);
+    
+    qCDebug(vlcBackend) << "Setting volume to:" << volume;
+    
+    if (m_sandboxed) {
+        m_sandboxed->setVolume(volume);
+    } else if (libvlc_audio_set_volume(m_player->player, volume) == -1) {
+        qCWarning(vlcBackend) << "Failed to set volume";
+        return;
+    }
+    
+    QMutexLocker locker(&m_stateMutex);
+    m_currentVolume = volume;
+    
+    emit volumeChanged(volume);
+}
+
+qint64 VLCBackend::position() const
+{
+    if (!m_initialized || !m_player->player) {
+        return 0;
+    }
+    
+    // Interpolated from libVLC time events, no call into the player
+    return m_clock->position();
+}
+
+qint64 VLCBackend::duration() const
+{
+    if (!m_initialized || !m_player->player) {
+        return 0;
+    }
+    
+    if (m_sandboxed) {
+        return m_sandboxed->duration();
+    }
+    
+    // Get length from libVLC (in microseconds) and convert to milliseconds
+    libvlc_time_t vlcLength = libvlc_media_player_get_length(m_player->player);
+    return vlcLength / 1000;
+}
+
+void VLCBackend::subscribePosition(QObject* context, int intervalMs, std::function<void(qint64)> callback)
+{
+    m_clock->subscribe(context, intervalMs, std::move(callback));
+}
+
+void VLCBackend::unsubscribePosition(QObject* context)
+{
+    m_clock->unsubscribe(context);
+}
+
+void VLCBackend::handleVLCEvent(PlayerSlot* slot, const libvlc_event_t* event)
+{
+    if (!event) {
+        return;
+    }
+    
+    switch (slot->role.load()) {
+        case SlotRole::Retiring:
+            return;
+        case SlotRole::Preloaded:
+            handlePreloadEvent(slot, event);
+            return;
+        case SlotRole::Active:
+            break;
+    }
+    
+    // A taken-over preload holds its first frame; skip that pause if it is resumed
+    if (event->type == libvlc_MediaPlayerPaused && !slot->ready && markReady(slot)) {
+        return;
+    }
+    
+    PlaybackState newState = m_currentState;
+    
+    switch (event->type) {
+        case libvlc_MediaPlayerPlaying:
+            qCDebug(vlcBackend) << "VLC Event: Playing";
+            newState = PlaybackState::Playing;
+            m_clock->setRunning(true);
+            
+            // libVLC opened and demuxed the input
+            if (slot->awaitingFirstFrame && slot->playingUs < 0) {
+                const qint64 now = TraceLog::instance().now();
+                const qint64 requested = slot->playRequestedUs;
+                slot->playingUs = now;
+                MediaOpenProfiler::instance().addPhase(slot->path, "engine.start", requested, now - requested);
+            }
+            break;
+            
+        case libvlc_MediaPlayerPaused:
+            qCDebug(vlcBackend) << "VLC Event: Paused";
+            newState = PlaybackState::Paused;
+            m_clock->setRunning(false);
+            break;
+            
+        case libvlc_MediaPlayerStopped:
+            qCDebug(vlcBackend) << "VLC Event: Stopped";
             newState = PlaybackState::Stopped;
-            m_positionTimer->stop();
+            m_clock->setRunning(false);
             break;
             
-        case libvlc_MediaPlayerBuffering:
-            qCDebug(vlcBackend) << "VLC Event: Buffering" << event->u.media_player_buffering.new_cache << "%";
+        case libvlc_MediaPlayerEndReached:
+            qCDebug(vlcBackend) << "VLC Event: End Reached";
+            // Decided on our thread, which may switch to the preloaded player
+            QMetaObject::invokeMethod(this, [this, slot]() { handleEndReached(slot); }, Qt::QueuedConnection);
+            return;
+            
+        case libvlc_MediaPlayerBuffering: {
+            const float cache = event->u.media_player_buffering.new_cache;
+            qCDebug(vlcBackend) << "VLC Event: Buffering" << cache << "%";
             newState = PlaybackState::Buffering;
+            
+            if (slot->source == SourceKind::File) {
+                break;
+            }
+            if (cache >= 100.0f) {
+                slot->filled = true;
+                slot->stalled = false;
+            } else if (slot->filled && !slot->stalled.exchange(true) &&
+                       JitterBufferController::instance().reportStall(slot)) {
+                qCInfo(vlcBackend) << "Live stream stalled, reopening with a deeper cache:" << slot->path;
+                QMetaObject::invokeMethod(this, [this, slot]() {
+                    if (slot == m_player.get()) {
+                        reopenActiveMedia();
+                    }
+                }, Qt::QueuedConnection);
+            }
             break;
+        }
             
         case libvlc_MediaPlayerEncounteredError:
             qCCritical(vlcBackend) << "VLC Event: Error encountered";
             newState = PlaybackState::Error;
-            m_positionTimer->stop();
+            m_clock->setRunning(false);
             emit errorOccurred("Playback error occurred");
             break;
             
-        case libvlc_MediaPlayerLengthChanged:
-            qCDebug(vlcBackend) << "VLC Event: Length changed";
-            // Duration will be updated in updatePosition()
+        case libvlc_MediaPlayerLengthChanged: {
+            const qint64 newDuration = event->u.media_player_length_changed.new_length / 1000;
+            qCDebug(vlcBackend) << "VLC Event: Length changed" << newDuration;
+            
+            QMutexLocker locker(&m_stateMutex);
+            if (newDuration <= 0 || newDuration == m_currentDuration) {
+                break;
+            }
+            m_currentDuration = newDuration;
+            locker.unlock();
+            
+            emit playbackDurationChanged(newDuration);
             break;
+        }
+            
+        case libvlc_MediaPlayerTimeChanged: {
+            // Same time base as position(); only re-anchors the clock
+            const qint64 timeMs = event->u.media_player_time_changed.new_time / 1000;
+            m_clock->update(timeMs);
+            pollDecoderStats(slot);
+            
+            // Times from before the seek was taken up are still far from the target
+            if (slot->seekPending && qAbs(timeMs - slot->seekTargetMs) <= slot->seekToleranceMs &&
+                slot->seekPending.exchange(false)) {
+                QMetaObject::invokeMethod(this, [this, slot, timeMs]() {
+                    if (slot == m_player.get()) {
+                        emit seekCompleted(timeMs);
+                    }
+                }, Qt::QueuedConnection);
+            }
+            
+            // First audio counts as first output unless a picture is coming
+            if (slot->awaitingFirstFrame && event->u.media_player_time_changed.new_time > 0 &&
+                !slot->firstTimeSeen.exchange(true)) {
+                const qint64 at = TraceLog::instance().now();
+                QMetaObject::invokeMethod(this, [this, slot, at]() {
+                    if (slot == m_player.get() && slot->player && !libvlc_media_player_has_vout(slot->player)) {
+                        reportFirstOutput(slot, false, at);
+                    }
+                }, Qt::QueuedConnection);
+            }
+            return;
+        }
             
         default:
             // Ignore other events
@@ -476,10 +1339,34 @@ void VLCBackend::handleVLCEvent(const libvlc_event_t* event)
         m_currentState = newState;
         locker.unlock();
         
+        BreadcrumbRing::instance().record(BreadcrumbRing::Playback, "state", static_cast<qint64>(newState));
         emit stateChanged(newState);
     }
 }
 
+void VLCBackend::handlePreloadEvent(PlayerSlot* slot, const libvlc_event_t* event)
+{
+    switch (event->type) {
+        case libvlc_MediaPlayerPaused:
+            qCDebug(vlcBackend) << "Preloaded media buffered:" << slot->path;
+            markReady(slot);
+            break;
+            
+        case libvlc_MediaPlayerEncounteredError:
+            qCWarning(vlcBackend) << "Preloaded media failed to open:" << slot->path;
+            QMetaObject::invokeMethod(this, [this, slot]() {
+                if (slot == m_nextPlayer.get()) {
+                    clearPreloadedMedia();
+                }
+            }, Qt::QueuedConnection);
+            break;
+            
+        default:
+            // Playing and buffering while preloading are not reported
+            break;
+    }
+}
+
 PlaybackState VLCBackend::convertVLCState(int vlcState) const
 {
     switch (vlcState) {
@@ -515,40 +1402,180 @@ bool VLCBackend::validateMediaFile(const QString& path) const
                scheme == "rtsp" || scheme == "rtmp" || scheme == "mms";
     }
     
-    // Handle local files
+    // Handle local files; cached when FileUrlSupport validated the same file
     QString localPath = url.isLocalFile() ? url.toLocalFile() : path;
-    QFileInfo fileInfo(localPath);
+    const FileValidationResult file = MediaFileValidator::instance().validate(localPath);
     
     // Check if file exists
-    if (!fileInfo.exists()) {
+    if (!file.exists) {
         qCWarning(vlcBackend) << "File does not exist:" << localPath;
         return false;
     }
     
     // Check file size
-    if (fileInfo.size() > m_maxFileSize) {
-        qCWarning(vlcBackend) << "File too large:" << fileInfo.size() << "bytes";
+    if (file.size > m_maxFileSize) {
+        qCWarning(vlcBackend) << "File too large:" << file.size << "bytes";
         return false;
     }
     
     // Check file extension
-    QString extension = fileInfo.suffix().toLower();
-    if (!m_allowedExtensions.contains(extension)) {
-        qCWarning(vlcBackend) << "File extension not allowed:" << extension;
+    if (!m_allowedExtensions.contains(file.suffix)) {
+        qCWarning(vlcBackend) << "File extension not allowed:" << file.suffix;
+        return false;
+    }
+    
+    // The header is already read, so refusing executables is free
+    if (file.looksExecutable) {
+        qCWarning(vlcBackend) << "File is an executable:" << localPath;
         return false;
     }
     
     // Additional security checks could be added here
-    // - File header validation
     // - Virus scanning integration
     // - Path traversal prevention
     
     return true;
 }
 
+void VLCBackend::setDecoderSandbox(SandboxedDecoderPool* pool)
+{
+    m_decoderSandbox = pool;
+}
+
+bool VLCBackend::loadSandboxed(const QString& path)
+{
+    MediaOpenPhaseScope openPhase(path, "engine.sandbox");
+    
+    std::unique_ptr<SandboxedDecoder> decoder = m_decoderSandbox->acquire();
+    if (!decoder || !decoder->open(path)) {
+        qCCritical(vlcBackend) << "No sandboxed decoder for:" << path;
+        MediaOpenProfiler::instance().abandon(path);
+        emit errorOccurred("Failed to load media file");
+        return false;
+    }
+    
+    // The in-process player lets go of what it played, and parses nothing of this file
+    releaseSandboxed();
+    clearPreloadedMedia();
+    libvlc_media_player_stop(m_player->player);
+    if (m_player->media) {
+        libvlc_media_release(m_player->media);
+        m_player->media = nullptr;
+    }
+    endSource(m_player.get());
+    m_player->path.clear();
+    resetDecoderStats();
+    
+    SandboxedDecoder* sandboxed = decoder.get();
+    sandboxed->setVolume(m_currentVolume);
+    
+    // Pictures point into the worker's shared memory; sinks get them without a copy
+    sandboxed->setFrameCallback([this, path, opened = false](const std::shared_ptr<VideoFrame>& picture) mutable {
+        if (!opened) {
+            opened = true;
+            MediaOpenProfiler& profiler = MediaOpenProfiler::instance();
+            if (profiler.isPending(path)) {
+                profiler.finish(path, true, TraceLog::instance().now());
+            }
+        }
+        
+        {
+            QMutexLocker locker(&m_frameMutex);
+            picture->setSequence(++m_frameSequence);
+            m_latestFrame = picture;
+        }
+        
+        QMutexLocker sinkLocker(&m_sinkMutex);
+        for (IVideoFrameSink* sink : m_videoSinks) {
+            sink->videoFrameReady(picture);
+        }
+    });
+    
+    connect(sandboxed, &SandboxedDecoder::positionChanged, this, [this](qint64 position) {
+        m_clock->update(position);
+    });
+    connect(sandboxed, &SandboxedDecoder::durationChanged, this, [this](qint64 duration) {
+        QMutexLocker locker(&m_stateMutex);
+        if (duration <= 0 || duration == m_currentDuration) {
+            return;
+        }
+        m_currentDuration = duration;
+        locker.unlock();
+        
+        emit playbackDurationChanged(duration);
+    });
+    connect(sandboxed, &SandboxedDecoder::failed, this, [this](const QString& message) {
+        emit errorOccurred(QString("Sandboxed decoder failed: %1").arg(message));
+    });
+    connect(sandboxed, &SandboxedDecoder::stateChanged, this, [this](SandboxedDecoder::State state) {
+        PlaybackState newState = m_currentState;
+        switch (state) {
+            case SandboxedDecoder::State::Playing:
+                newState = PlaybackState::Playing;
+                m_clock->setRunning(true);
+                break;
+            case SandboxedDecoder::State::Paused:
+                newState = PlaybackState::Paused;
+                m_clock->setRunning(false);
+                break;
+            case SandboxedDecoder::State::Ended:
+                // Gapless into a preloaded in-process media, as for a player here
+                if (m_nextPlayer && switchToPreloadedMedia(0)) {
+                    return;
+                }
+                Q_FALLTHROUGH();
+            case SandboxedDecoder::State::Stopped:
+                newState = PlaybackState::Stopped;
+                m_clock->setRunning(false);
+                break;
+            case SandboxedDecoder::State::Failed:
+                newState = PlaybackState::Error;
+                m_clock->setRunning(false);
+                break;
+            default:
+                return;
+        }
+        
+        if (newState != m_currentState) {
+            QMutexLocker locker(&m_stateMutex);
+            m_currentState = newState;
+            locker.unlock();
+            
+            BreadcrumbRing::instance().record(BreadcrumbRing::Playback, "state", static_cast<qint64>(newState));
+            emit stateChanged(newState);
+        }
+    });
+    
+    m_sandboxed = std::move(decoder);
+    openPhase.end();
+    
+    {
+        QMutexLocker locker(&m_stateMutex);
+        m_currentDuration = 0;
+    }
+    m_clock->setRunning(false);
+    m_clock->reset(0);
+    
+    qCDebug(vlcBackend) << "Media loaded in the decoder sandbox:" << path;
+    emit mediaLoaded(true);
+    return true;
+}
+
+void VLCBackend::releaseSandboxed()
+{
+    if (!m_sandboxed) {
+        return;
+    }
+    
+    // Killing the worker waits for it; deferred, since this may run inside its signal
+    m_sandboxed->disconnect(this);
+    m_sandboxed->setFrameCallback(nullptr);
+    m_sandboxed.release()->deleteLater();
+}
+
 void VLCBackend::configureSandboxing()
 {
-    if (!m_mediaPlayer) {
+    if (!m_player->player) {
         return;
     }
     
@@ -563,9 +1590,172 @@ void VLCBackend::configureSandboxing()
 
 void VLCBackend::vlcEventCallback(const libvlc_event_t* event, void* userData)
 {
-    VLCBackend* backend = static_cast<VLCBackend*>(userData);
-    if (backend) {
-        backend->handleVLCEvent(event);
+    PlayerSlot* slot = static_cast<PlayerSlot*>(userData);
+    if (slot) {
+        slot->backend->handleVLCEvent(slot, event);
+    }
+}
+
+bool VLCBackend::hasVideo() const
+{
+    if (!m_initialized || !m_player->player) {
+        return false;
+    }
+    
+    if (m_sandboxed) {
+        return m_sandboxed->hasVideo();
+    }
+    
+    return libvlc_media_player_has_vout(m_player->player) > 0;
+}
+
+void VLCBackend::addVideoFrameSink(IVideoFrameSink* sink)
+{
+    if (!sink) {
+        return;
+    }
+    
+    QMutexLocker locker(&m_sinkMutex);
+    if (!m_videoSinks.contains(sink)) {
+        m_videoSinks.append(sink);
+    }
+}
+
+void VLCBackend::removeVideoFrameSink(IVideoFrameSink* sink)
+{
+    // Waits for a delivery in progress, which holds the same mutex
+    QMutexLocker locker(&m_sinkMutex);
+    m_videoSinks.removeAll(sink);
+}
+
+VideoFrameRef VLCBackend::latestVideoFrame() const
+{
+    QMutexLocker locker(&m_frameMutex);
+    return m_latestFrame;
+}
+
+void VLCBackend::presentVideoFrame(const VideoFrameRef& frame)
+{
+    if (!frame) {
+        return;
+    }
+    
+    {
+        QMutexLocker locker(&m_frameMutex);
+        m_latestFrame = frame;
+    }
+    
+    QMutexLocker sinkLocker(&m_sinkMutex);
+    for (IVideoFrameSink* sink : m_videoSinks) {
+        sink->videoFrameReady(frame);
+    }
+}
+
+bool VLCBackend::stepFrame()
+{
+    if (!m_initialized || !m_player->player || m_sandboxed) {
+        return false;
+    }
+    
+    // libVLC decodes one picture ahead of the paused one and shows it
+    libvlc_media_player_next_frame(m_player->player);
+    return true;
+}
+
+unsigned VLCBackend::videoFormatCallback(void** opaque, char* chroma, unsigned* width, unsigned* height,
+                                         unsigned* pitches, unsigned* lines)
+{
+    PlayerSlot* slot = static_cast<PlayerSlot*>(*opaque);
+    if (!slot || *width == 0 || *height == 0) {
+        return 0;
+    }
+    
+    // RV32 matches QImage::Format_RGB32, so frames need no further conversion
+    std::memcpy(chroma, "RV32", 4);
+    
+    const int bytesPerLine = slot->framePool.configure(static_cast<int>(*width), static_cast<int>(*height));
+    pitches[0] = static_cast<unsigned>(bytesPerLine);
+    lines[0] = *height;
+    
+    QMutexLocker locker(&slot->backend->m_frameMutex);
+    slot->dropBuffer.resize(bytesPerLine * static_cast<int>(*height));
+    
+    qCDebug(vlcBackend) << "Video format:" << *width << "x" << *height;
+    return 1;
+}
+
+void VLCBackend::videoCleanupCallback(void* opaque)
+{
+    PlayerSlot* slot = static_cast<PlayerSlot*>(opaque);
+    if (slot) {
+        QMutexLocker locker(&slot->backend->m_frameMutex);
+        slot->pendingFrame.reset();
+    }
+}
+
+void* VLCBackend::videoLockCallback(void* opaque, void** planes)
+{
+    // libVLC's decoder thread; after the first frame this is a thread-local read
+    ThreadPriority::setCurrentThreadRole(ThreadPriority::Role::Playback);
+
+    PlayerSlot* slot = static_cast<PlayerSlot*>(opaque);
+    std::shared_ptr<VideoFrame> frame = slot->framePool.acquire();
+    
+    QMutexLocker locker(&slot->backend->m_frameMutex);
+    if (!frame) {
+        // Consumers still hold every buffer: decode into scratch memory and drop the picture
+        droppedFrames().add();
+        slot->poolDrops.fetch_add(1, std::memory_order_relaxed);
+        planes[0] = slot->dropBuffer.data();
+        return nullptr;
+    }
+    
+    planes[0] = frame->bits();
+    slot->pendingFrame = std::move(frame);
+    return slot->pendingFrame.get();
+}
+
+void VLCBackend::videoUnlockCallback(void* opaque, void* picture, void* const* planes)
+{
+    Q_UNUSED(opaque)
+    Q_UNUSED(picture)
+    Q_UNUSED(planes)
+}
+
+void VLCBackend::videoDisplayCallback(void* opaque, void* picture)
+{
+    PlayerSlot* slot = static_cast<PlayerSlot*>(opaque);
+    VLCBackend* backend = slot->backend;
+    if (!picture) {
+        return;
+    }
+    
+    VideoFrameRef frame;
+    {
+        QMutexLocker locker(&backend->m_frameMutex);
+        if (slot->pendingFrame.get() != picture) {
+            return;
+        }
+        
+        // Only the active player is shown; preloaded and retiring pictures go back to their pool
+        if (slot->role != SlotRole::Active) {
+            slot->pendingFrame.reset();
+            return;
+        }
+        
+        slot->pendingFrame->setSequence(++backend->m_frameSequence);
+        slot->pendingFrame->setPosition(backend->m_clock->position());
+        frame = std::move(slot->pendingFrame);
+        backend->m_latestFrame = frame;
+    }
+    
+    if (slot->awaitingFirstFrame) {
+        backend->reportFirstOutput(slot, true, TraceLog::instance().now());
+    }
+    
+    QMutexLocker sinkLocker(&backend->m_sinkMutex);
+    for (IVideoFrameSink* sink : backend->m_videoSinks) {
+        sink->videoFrameReady(frame);
     }
 }
 
@@ -597,45 +1787,107 @@ void VLCBackend::setHardwareAccelerationEnabled(bool enabled)
     if (wasEnabled != enabled) {
         qCDebug(vlcBackend) << "Hardware acceleration" << (enabled ? "enabled" : "disabled");
         
-        // If we have an active VLC instance, we need to reinitialize it
-        // to apply the new hardware acceleration settings
+        // Decoder options are per media; the instance stays as it is
         if (m_initialized && m_vlcInstance) {
-            qCDebug(vlcBackend) << "Reinitializing VLC with new hardware acceleration settings";
-            
-            // Save current state
-            bool wasPlaying = (m_currentState == PlaybackState::Playing);
-            qint64 currentPos = position();
-            QString currentMediaPath;
-            
-            // Get current media path if available
-            if (m_currentMedia) {
-                char* mrl = libvlc_media_get_mrl(m_currentMedia);
-                if (mrl) {
-                    currentMediaPath = QString::fromUtf8(mrl);
-                    libvlc_free(mrl);
-                }
-            }
-            
-            // Clean up current VLC instance
-            cleanupVLC();
-            
-            // Reinitialize with new settings
-            if (initializeVLC()) {
-                // Restore media if we had one
-                if (!currentMediaPath.isEmpty()) {
-                    loadMedia(currentMediaPath);
-                    if (currentPos > 0) {
-                        seek(currentPos);
-                    }
-                    if (wasPlaying) {
-                        play();
-                    }
-                }
-            } else {
-                qCCritical(vlcBackend) << "Failed to reinitialize VLC with new hardware acceleration settings";
-            }
+            reopenActiveMedia();
+        }
+    }
+}
+
+void VLCBackend::setGpuOutput(GpuOutput* output)
+{
+    if (output == m_gpuOutput) {
+        return;
+    }
+    
+    recreatePlayers([this, output]() {
+        m_gpuOutput = output;
+        qCDebug(vlcBackend) << "Video output" << (output ? "stays on the GPU" : "uses pooled frames");
+    });
+}
+
+void VLCBackend::setAudioOutput(AudioOutput* output)
+{
+    if (output == m_audioOutput) {
+        return;
+    }
+    
+    recreatePlayers([this, output]() {
+        m_audioOutput = output;
+        qCDebug(vlcBackend) << "Audio output" << (output ? "is external" : "is libVLC's");
+    });
+}
+
+void VLCBackend::recreatePlayers(const std::function<void()>& switchOutputs)
+{
+    if (!m_vlcInstance) {
+        switchOutputs();
+        return;
+    }
+    
+    // Players are released while the old output still knows them
+    finishFade();
+    discardPlayer(m_sparePlayer);
+    const QString nextPath = m_nextPlayer ? m_nextPlayer->path : QString();
+    clearPreloadedMedia();
+    
+    const QString path = m_player->media ? m_player->path : QString();
+    const bool wasPlaying = (m_currentState == PlaybackState::Playing);
+    const qint64 currentPos = position();
+    releasePlayer(m_player.get());
+    
+    switchOutputs();
+    
+    if (!createPlayer(m_player.get())) {
+        qCCritical(vlcBackend) << "Failed to recreate libVLC media player";
+        return;
+    }
+    if (m_gpuOutput) {
+        m_gpuOutput->setActivePlayer(m_player->player);
+    }
+    if (m_audioOutput) {
+        m_audioOutput->setActivePlayer(m_player->player);
+    }
+    
+    if (!path.isEmpty()) {
+        loadMedia(path);
+        if (currentPos > 0) {
+            seek(currentPos);
+        }
+        if (wasPlaying) {
+            play();
         }
     }
+    if (!nextPath.isEmpty()) {
+        preloadMedia(nextPath);
+    }
+    createSparePlayer();
+}
+
+void VLCBackend::reopenActiveMedia()
+{
+    if (m_player->media && !m_player->path.isEmpty()) {
+        qCDebug(vlcBackend) << "Reopening media with new decoder options";
+        
+        const QString path = m_player->path;
+        const bool wasPlaying = (m_currentState == PlaybackState::Playing);
+        const qint64 currentPos = position();
+        
+        loadMedia(path);
+        if (currentPos > 0) {
+            seek(currentPos);
+        }
+        if (wasPlaying) {
+            play();
+        }
+    }
+    
+    // The preloaded media was opened with the old options too
+    if (m_nextPlayer) {
+        const QString nextPath = m_nextPlayer->path;
+        clearPreloadedMedia();
+        preloadMedia(nextPath);
+    }
 }
 
 void VLCBackend::setPreferredAccelerationType(HardwareAccelerationType type)
@@ -651,9 +1903,10 @@ void VLCBackend::setPreferredAccelerationType(HardwareAccelerationType type)
                            << HardwareAcceleration::getAccelerationTypeName(currentType)
                            << "to" << HardwareAcceleration::getAccelerationTypeName(type);
         
-        // Reinitialize VLC if the type actually changed and we're initialized
-        if (currentType != type && m_initialized && m_vlcInstance) {
-            setHardwareAccelerationEnabled(m_hardwareAcceleration->isHardwareAccelerationEnabled());
+        // Reopen with the new decoder if the type actually changed and it is in use
+        if (currentType != type && m_initialized && m_vlcInstance &&
+            m_hardwareAcceleration->isHardwareAccelerationEnabled()) {
+            reopenActiveMedia();
         }
     }
 }
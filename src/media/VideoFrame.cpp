@@ -0,0 +1,141 @@
+#include "media/VideoFrame.h"
+#include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
+
+struct VideoFramePool::State
+{
+    QMutex mutex;
+    QVector<VideoFrame*> freeFrames;
+    int capacity;
+    int framesInUse;
+    int width;
+    int height;
+    int bytesPerLine;
+    quint64 generation;
+
+    ~State()
+    {
+        qDeleteAll(freeFrames);
+    }
+
+    void release(VideoFrame* frame)
+    {
+        QMutexLocker locker(&mutex);
+        --framesInUse;
+        if (frame->m_generation == generation && framesInUse + freeFrames.size() < capacity) {
+            freeFrames.append(frame);
+        } else {
+            delete frame;
+        }
+    }
+};
+
+VideoFrame::VideoFrame(int width, int height, int bytesPerLine, quint64 generation)
+    : m_width(width)
+    , m_height(height)
+    , m_bytesPerLine(bytesPerLine)
+    , m_generation(generation)
+    , m_sequence(0)
+    , m_position(0)
+{
+    m_data.resize(bytesPerLine * height);
+    m_bits = m_data.data();
+}
+
+std::shared_ptr<VideoFrame> VideoFrame::wrap(const uchar* data, int width, int height, int bytesPerLine,
+                               std::function<void()> release)
+{
+    // Generation 0 is never a pool's, and an empty m_data allocates nothing
+    VideoFrame* frame = new VideoFrame(width, 0, bytesPerLine, 0);
+    frame->m_height = height;
+    frame->m_bits = const_cast<uchar*>(data);
+    return std::shared_ptr<VideoFrame>(frame, [release = std::move(release)](VideoFrame* released) {
+        delete released;
+        if (release) {
+            release();
+        }
+    });
+}
+
+QImage videoFrameToImage(const VideoFrameRef& frame)
+{
+    if (!frame) {
+        return QImage();
+    }
+
+    // The image keeps the frame out of the pool until it is destroyed
+    auto* reference = new VideoFrameRef(frame);
+    return QImage(frame->bits(), frame->width(), frame->height(), frame->bytesPerLine(),
+                  QImage::Format_RGB32,
+                  [](void* info) { delete static_cast<VideoFrameRef*>(info); },
+                  reference);
+}
+
+VideoFramePool::VideoFramePool(int capacity)
+    : m_state(std::make_shared<State>())
+{
+    m_state->capacity = qMax(1, capacity);
+    m_state->framesInUse = 0;
+    m_state->width = 0;
+    m_state->height = 0;
+    m_state->bytesPerLine = 0;
+    m_state->generation = 0;
+}
+
+VideoFramePool::~VideoFramePool() = default;
+
+int VideoFramePool::configure(int width, int height)
+{
+    QMutexLocker locker(&m_state->mutex);
+
+    const int bytesPerLine = (width * 4 + 31) & ~31;
+    if (width != m_state->width || height != m_state->height) {
+        m_state->width = width;
+        m_state->height = height;
+        m_state->bytesPerLine = bytesPerLine;
+        ++m_state->generation;
+        qDeleteAll(m_state->freeFrames);
+        m_state->freeFrames.clear();
+    }
+
+    return bytesPerLine;
+}
+
+void VideoFramePool::setCapacity(int capacity)
+{
+    QMutexLocker locker(&m_state->mutex);
+    m_state->capacity = qMax(1, capacity);
+    while (!m_state->freeFrames.isEmpty() && m_state->framesInUse + m_state->freeFrames.size() > m_state->capacity) {
+        delete m_state->freeFrames.takeLast();
+    }
+}
+
+std::shared_ptr<VideoFrame> VideoFramePool::acquire()
+{
+    QMutexLocker locker(&m_state->mutex);
+
+    VideoFrame* frame = nullptr;
+    if (!m_state->freeFrames.isEmpty()) {
+        frame = m_state->freeFrames.takeLast();
+    } else if (m_state->framesInUse < m_state->capacity && m_state->width > 0 && m_state->height > 0) {
+        // Buffers are allocated lazily, at most capacity per format
+        frame = new VideoFrame(m_state->width, m_state->height, m_state->bytesPerLine, m_state->generation);
+    }
+
+    if (!frame) {
+        return nullptr;
+    }
+
+    ++m_state->framesInUse;
+    std::shared_ptr<State> state = m_state;
+    return std::shared_ptr<VideoFrame>(frame, [state](VideoFrame* released) {
+        state->release(released);
+    });
+}
+
+int VideoFramePool::framesInUse() const
+{
+    QMutexLocker locker(&m_state->mutex);
+    return m_state->framesInUse;
+}
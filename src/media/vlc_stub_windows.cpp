@@ -35,6 +35,13 @@ libvlc_media_t* libvlc_media_new_location(libvlc_instance_t* p_instance, const c
     return reinterpret_cast<libvlc_media_t*>(0x2);
 }
 
+libvlc_media_t* libvlc_media_new_callbacks(libvlc_instance_t* instance, libvlc_media_open_cb open_cb,
+                                           libvlc_media_read_cb read_cb, libvlc_media_seek_cb seek_cb,
+                                           libvlc_media_close_cb close_cb, void* opaque) {
+    (void)instance; (void)open_cb; (void)read_cb; (void)seek_cb; (void)close_cb; (void)opaque;
+    return reinterpret_cast<libvlc_media_t*>(0x2);
+}
+
 void libvlc_media_release(libvlc_media_t* p_media) {
     (void)p_media;
 }
@@ -53,6 +60,12 @@ libvlc_time_t libvlc_media_get_duration(libvlc_media_t* p_media) {
     return 60000; // 1 minute stub duration
 }
 
+int libvlc_media_get_stats(libvlc_media_t* p_md, libvlc_media_stats_t* p_stats) {
+    (void)p_md;
+    (void)p_stats;
+    return 0;
+}
+
 char* libvlc_media_get_mrl(libvlc_media_t* p_media) {
     (void)p_media;
     char* mrl = (char*)malloc(20);
@@ -69,6 +82,34 @@ void libvlc_media_tracks_release(libvlc_media_track_t** p_tracks, unsigned int i
     (void)p_tracks; (void)i_count;
 }
 
+void libvlc_media_add_option(libvlc_media_t* p_md, const char* psz_options) {
+    (void)p_md; (void)psz_options;
+}
+
+int libvlc_media_parse_with_options(libvlc_media_t* p_md, libvlc_media_parse_flag_t parse_flag, int timeout) {
+    (void)p_md; (void)parse_flag; (void)timeout;
+    return -1;
+}
+
+void libvlc_media_parse_stop(libvlc_media_t* p_md) {
+    (void)p_md;
+}
+
+char* libvlc_media_get_meta(libvlc_media_t* p_md, libvlc_meta_t e_meta) {
+    (void)p_md; (void)e_meta;
+    return 0;
+}
+
+const char* libvlc_media_get_codec_description(enum libvlc_track_type_t i_type, unsigned int i_codec) {
+    (void)i_type; (void)i_codec;
+    return "";
+}
+
+libvlc_event_manager_t* libvlc_media_event_manager(libvlc_media_t* p_md) {
+    (void)p_md;
+    return reinterpret_cast<libvlc_event_manager_t*>(0x8);
+}
+
 // Media player functions
 libvlc_media_player_t* libvlc_media_player_new(libvlc_instance_t* p_libvlc_instance) {
     (void)p_libvlc_instance;
@@ -97,6 +138,14 @@ void libvlc_media_player_pause(libvlc_media_player_t* p_mi) {
     (void)p_mi;
 }
 
+void libvlc_media_player_set_pause(libvlc_media_player_t* mp, int do_pause) {
+    (void)mp; (void)do_pause;
+}
+
+void libvlc_media_player_next_frame(libvlc_media_player_t* p_mi) {
+    (void)p_mi;
+}
+
 void libvlc_media_player_stop(libvlc_media_player_t* p_mi) {
     (void)p_mi;
 }
@@ -110,16 +159,41 @@ void libvlc_media_player_set_time(libvlc_media_player_t* p_mi, libvlc_time_t i_t
     (void)p_mi; (void)i_time;
 }
 
+void libvlc_media_player_set_position(libvlc_media_player_t* p_mi, float f_pos) {
+    (void)p_mi; (void)f_pos;
+}
+
 libvlc_time_t libvlc_media_player_get_length(libvlc_media_player_t* p_mi) {
     (void)p_mi;
     return 60000; // 1 minute
 }
 
+int libvlc_media_player_is_playing(libvlc_media_player_t* p_mi) {
+    (void)p_mi;
+    return 0;
+}
+
 libvlc_state_t libvlc_media_player_get_state(libvlc_media_player_t* p_mi) {
     (void)p_mi;
     return libvlc_Stopped;
 }
 
+unsigned libvlc_media_player_has_vout(libvlc_media_player_t* p_mi) {
+    (void)p_mi;
+    return 0;
+}
+
+// Video functions
+void libvlc_video_set_callbacks(libvlc_media_player_t* mp, libvlc_video_lock_cb lock, libvlc_video_unlock_cb unlock,
+                                libvlc_video_display_cb display, void* opaque) {
+    (void)mp; (void)lock; (void)unlock; (void)display; (void)opaque;
+}
+
+void libvlc_video_set_format_callbacks(libvlc_media_player_t* mp, libvlc_video_format_cb setup,
+                                       libvlc_video_cleanup_cb cleanup) {
+    (void)mp; (void)setup; (void)cleanup;
+}
+
 // Audio functions
 int libvlc_audio_set_volume(libvlc_media_player_t* p_mi, int i_volume) {
     (void)p_mi; (void)i_volume;
@@ -137,6 +211,10 @@ int libvlc_event_attach(libvlc_event_manager_t* p_event_manager, libvlc_event_e
     return 0;
 }
 
+void libvlc_event_detach(libvlc_event_manager_t* p_event_manager, libvlc_event_e i_event_type, libvlc_callback_t f_callback, void* user_data) {
+    (void)p_event_manager; (void)i_event_type; (void)f_callback; (void)user_data;
+}
+
 // Memory functions
 void libvlc_free(void* ptr) {
     free(ptr);
@@ -0,0 +1,230 @@
+#include "network/AdaptiveBitrateController.h"
+#include <QLoggingCategory>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+Q_LOGGING_CATEGORY(adaptiveBitrate, "eonplay.network.abr")
+
+AdaptiveBitrateController::AdaptiveBitrateController(QObject* parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<AdaptiveBitrateController::Rendition>();
+}
+
+void AdaptiveBitrateController::setRenditions(QVector<Rendition> renditions)
+{
+    std::stable_sort(renditions.begin(), renditions.end(), [](const Rendition& a, const Rendition& b) {
+        return a.bandwidth < b.bandwidth;
+    });
+    renditions.erase(std::remove_if(renditions.begin(), renditions.end(), [](const Rendition& r) {
+        return r.bandwidth <= 0;
+    }), renditions.end());
+
+    m_renditions = renditions;
+    m_currentIndex = -1;
+    m_fixedIndex = -1;
+    updateBolaParameters();
+
+    qCDebug(adaptiveBitrate) << "Renditions:" << m_renditions.size();
+
+    if (m_renditions.isEmpty()) {
+        return;
+    }
+
+    // Start from the last known throughput rather than the lowest rendition
+    const double throughput = throughputEstimate();
+    switchTo(throughput > 0.0 ? chooseByThroughput(throughput) : 0, "start-up");
+}
+
+void AdaptiveBitrateController::clear()
+{
+    m_renditions.clear();
+    m_utilities.clear();
+    m_currentIndex = -1;
+    m_fixedIndex = -1;
+    m_bufferMs = 0;
+}
+
+void AdaptiveBitrateController::addThroughputSample(qint64 bytes, qint64 durationMs)
+{
+    if (bytes <= 0 || durationMs <= 0) {
+        return;
+    }
+
+    const double bitsPerSecond = bytes * 8000.0 / durationMs;
+
+    // Weight by the sample's duration so the half-lives are in time, not samples
+    const double fastAlpha = std::pow(0.5, durationMs / FAST_HALF_LIFE_MS);
+    const double slowAlpha = std::pow(0.5, durationMs / SLOW_HALF_LIFE_MS);
+    m_fastEstimate = fastAlpha * m_fastEstimate + (1.0 - fastAlpha) * bitsPerSecond;
+    m_slowEstimate = slowAlpha * m_slowEstimate + (1.0 - slowAlpha) * bitsPerSecond;
+    m_fastWeight = fastAlpha * m_fastWeight + (1.0 - fastAlpha);
+    m_slowWeight = slowAlpha * m_slowWeight + (1.0 - slowAlpha);
+
+    update();
+}
+
+void AdaptiveBitrateController::setBufferLevel(qint64 bufferMs)
+{
+    m_bufferMs = std::max<qint64>(0, bufferMs);
+    update();
+}
+
+void AdaptiveBitrateController::setSegmentDuration(qint64 durationMs)
+{
+    if (durationMs > 0) {
+        m_segmentMs = durationMs;
+        updateBolaParameters();
+    }
+}
+
+void AdaptiveBitrateController::setBufferTarget(qint64 bufferMs)
+{
+    if (bufferMs > 0) {
+        m_bufferTargetMs = bufferMs;
+        updateBolaParameters();
+    }
+}
+
+void AdaptiveBitrateController::setFixedRendition(int index)
+{
+    if (index >= m_renditions.size()) {
+        return;
+    }
+
+    m_fixedIndex = index;
+    if (index >= 0) {
+        switchTo(index, "fixed");
+    } else {
+        update();
+    }
+}
+
+AdaptiveBitrateController::Rendition AdaptiveBitrateController::currentRendition() const
+{
+    if (m_currentIndex < 0 || m_currentIndex >= m_renditions.size()) {
+        return Rendition();
+    }
+    return m_renditions.at(m_currentIndex);
+}
+
+double AdaptiveBitrateController::throughputEstimate() const
+{
+    if (m_fastWeight <= 0.0 || m_slowWeight <= 0.0) {
+        return 0.0;
+    }
+
+    // Dividing by the weight removes the bias towards the zero start value
+    return std::min(m_fastEstimate / m_fastWeight, m_slowEstimate / m_slowWeight);
+}
+
+void AdaptiveBitrateController::update()
+{
+    if (m_renditions.isEmpty() || m_fixedIndex >= 0) {
+        return;
+    }
+
+    const double throughput = throughputEstimate();
+    if (throughput <= 0.0) {
+        return;
+    }
+
+    const int throughputIndex = chooseByThroughput(throughput);
+    int current = std::max(m_currentIndex, 0);
+
+    // Drop before the buffer runs dry: the next segment has to arrive in
+    // time. An empty buffer is start-up or a stall, left to the throughput rule
+    const auto downloadMs = [&](int index) {
+        return m_renditions.at(index).bandwidth * double(m_segmentMs) / throughput;
+    };
+    if (current > 0 && m_bufferMs > 0 && downloadMs(current) > m_bufferMs * STALL_MARGIN) {
+        int index = current;
+        while (index > 0 && downloadMs(index) > m_bufferMs * STALL_MARGIN) {
+            --index;
+        }
+        switchTo(std::min(index, throughputIndex), "stall ahead");
+        return;
+    }
+
+    if (m_bufferMs < MIN_BUFFER_MS || m_renditions.size() == 1) {
+        switchTo(throughputIndex, "throughput");
+        return;
+    }
+
+    int index = chooseByBuffer();
+    if (index > current) {
+        // BOLA-O: do not climb past what the network sustains, but keep
+        // what is already playing instead of oscillating around it
+        index = std::min(index, std::max(throughputIndex, current));
+    }
+    switchTo(index, "buffer");
+}
+
+int AdaptiveBitrateController::chooseByThroughput(double throughput) const
+{
+    int index = 0;
+    for (int i = 0; i < m_renditions.size(); ++i) {
+        if (m_renditions.at(i).bandwidth <= throughput * SAFETY_FACTOR) {
+            index = i;
+        }
+    }
+    return index;
+}
+
+int AdaptiveBitrateController::chooseByBuffer() const
+{
+    // BOLA works in segments; scores with a buffer beyond V * (u + gp)
+    // are all negative and favour the top rendition, as intended
+    const double bufferSegments = m_bufferMs / double(m_segmentMs);
+
+    int best = 0;
+    double bestScore = -std::numeric_limits<double>::infinity();
+    for (int i = 0; i < m_renditions.size(); ++i) {
+        const double score = (m_bolaV * (m_utilities.at(i) + m_bolaGp) - bufferSegments) /
+                             m_renditions.at(i).bandwidth;
+        if (score >= bestScore) {
+            bestScore = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+void AdaptiveBitrateController::updateBolaParameters()
+{
+    m_utilities.clear();
+    m_bolaGp = 0.0;
+    m_bolaV = 0.0;
+
+    if (m_renditions.size() < 2) {
+        return;
+    }
+
+    const double lowest = std::log(double(m_renditions.first().bandwidth));
+    for (const Rendition& rendition : m_renditions) {
+        m_utilities.append(std::log(double(rendition.bandwidth)) - lowest + 1.0);
+    }
+
+    // Lowest rendition at MIN_BUFFER_MS, highest at the buffer target
+    const double minBuffer = MIN_BUFFER_MS / double(m_segmentMs);
+    const double target = std::max<qint64>(m_bufferTargetMs, MIN_BUFFER_MS + MIN_BUFFER_PER_LEVEL_MS * m_renditions.size()) /
+                          double(m_segmentMs);
+    m_bolaGp = (m_utilities.last() - 1.0) / (target / minBuffer - 1.0);
+    m_bolaV = minBuffer / m_bolaGp;
+}
+
+void AdaptiveBitrateController::switchTo(int index, const char* reason)
+{
+    index = std::clamp(index, 0, int(m_renditions.size()) - 1);
+    if (index == m_currentIndex) {
+        return;
+    }
+
+    qCDebug(adaptiveBitrate) << "Switching to rendition" << index << m_renditions.at(index).bandwidth << "bps ("
+                             << reason << ", throughput" << qRound64(throughputEstimate()) << "bps, buffer"
+                             << m_bufferMs << "ms)";
+
+    m_currentIndex = index;
+    emit renditionChanged(index, m_renditions.at(index));
+}
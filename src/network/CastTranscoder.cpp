@@ -0,0 +1,763 @@
+#include "network/CastTranscoder.h"
+#include "media/HardwareAcceleration.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <QUuid>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(castTranscoder, "eonplay.network.transcode")
+
+namespace {
+// Codecs MPEG-TS segments can carry without re-encoding
+const QStringList TS_VIDEO_CODECS = {"h264", "hevc", "mpeg2video"};
+const QStringList TS_AUDIO_CODECS = {"aac", "ac3", "eac3", "mp3", "mp2", "dts"};
+
+const QStringList TEXT_SUBTITLE_CODECS = {"ass", "ssa", "subrip", "mov_text", "webvtt"};
+const QStringList IMAGE_SUBTITLE_CODECS = {"hdmv_pgs_subtitle", "dvd_subtitle", "dvb_subtitle"};
+
+const QString VAAPI_RENDER_NODE = QStringLiteral("/dev/dri/renderD128");
+
+// Renderers cannot fetch from us otherwise (Chromecast receivers use XHR)
+const QByteArray CORS_HEADER = QByteArrayLiteral("Access-Control-Allow-Origin: *\r\n");
+
+// Time-seekable, transcoded, no byte ranges
+const QByteArray DLNA_STREAM_HEADERS = QByteArrayLiteral(
+    "transferMode.dlna.org: Streaming\r\n"
+    "contentFeatures.dlna.org: DLNA.ORG_OP=10;DLNA.ORG_CI=1;DLNA.ORG_FLAGS=01700000000000000000000000000000\r\n");
+
+struct VideoEncoder {
+    QStringList inputArguments;     // Before -i
+    QStringList filters;            // Appended to the video filter chain
+    QStringList arguments;
+};
+
+/**
+ * H.264 encoder of an acceleration backend. VDPAU has no encoder, but
+ * machines decoding through it have an NVIDIA GPU with NVENC.
+ */
+VideoEncoder videoEncoder(HardwareAccelerationType type)
+{
+    if (type == HardwareAccelerationType::Auto) {
+#if defined(Q_OS_MACOS)
+        return {{}, {}, {"-c:v", "h264_videotoolbox", "-pix_fmt", "yuv420p"}};
+#elif defined(Q_OS_WIN)
+        type = HardwareAccelerationType::DXVA;
+#else
+        type = QFileInfo::exists(VAAPI_RENDER_NODE) ? HardwareAccelerationType::VAAPI
+                                                    : HardwareAccelerationType::Software;
+#endif
+    }
+
+    switch (type) {
+        case HardwareAccelerationType::VAAPI:
+            return {{"-vaapi_device", VAAPI_RENDER_NODE}, {"format=nv12", "hwupload"}, {"-c:v", "h264_vaapi"}};
+        case HardwareAccelerationType::VDPAU:
+            return {{}, {}, {"-c:v", "h264_nvenc", "-pix_fmt", "yuv420p"}};
+        case HardwareAccelerationType::DXVA:
+            return {{}, {}, {"-c:v", "h264_mf", "-hw_encoding", "1", "-pix_fmt", "nv12"}};
+        default:
+            return {{}, {}, {"-c:v", "libx264", "-preset", "veryfast", "-pix_fmt", "yuv420p"}};
+    }
+}
+
+/**
+ * Escape a filter option value, then the filtergraph around it, so paths
+ * with colons, quotes or brackets survive both parsers.
+ */
+QString filterArgument(const QString& value)
+{
+    QString option;
+    for (const QChar c : value) {
+        if (c == '\\' || c == ':' || c == '\'') {
+            option += '\\';
+        }
+        option += c;
+    }
+    QString graph;
+    for (const QChar c : option) {
+        if (c == '\\' || c == '\'' || c == '[' || c == ']' || c == ',' || c == ';') {
+            graph += '\\';
+        }
+        graph += c;
+    }
+    return graph;
+}
+
+QString containerName(const QString& formatName, const QString& input)
+{
+    if (formatName.contains("mp4") || formatName.startsWith("mov")) {
+        return "mp4";
+    }
+    if (formatName.contains("matroska")) {
+        return input.endsWith(".webm", Qt::CaseInsensitive) ? "webm" : "matroska";
+    }
+    return formatName.section(',', 0, 0);
+}
+
+QByteArray headerValue(const QByteArray& head, const QByteArray& name)
+{
+    for (const QByteArray& line : head.split('\n')) {
+        const qsizetype colon = line.indexOf(':');
+        if (colon > 0 && line.left(colon).trimmed().compare(name, Qt::CaseInsensitive) == 0) {
+            return line.mid(colon + 1).trimmed();
+        }
+    }
+    return QByteArray();
+}
+
+/**
+ * Start of a DLNA npt range, in seconds ("123.4" or "0:02:03.4")
+ */
+double nptSeconds(const QByteArray& range)
+{
+    const qsizetype npt = range.indexOf("npt=");
+    if (npt < 0) {
+        return 0.0;
+    }
+    const QByteArray start = range.mid(npt + 4).split('-').first().trimmed();
+    double seconds = 0.0;
+    for (const QByteArray& field : start.split(':')) {
+        seconds = seconds * 60.0 + field.toDouble();
+    }
+    return seconds;
+}
+
+QByteArray nptTime(double seconds)
+{
+    return QByteArray::number(seconds, 'f', 3);
+}
+
+QByteArray responseHead(int status, const QByteArray& reason, const QByteArray& headers)
+{
+    return "HTTP/1.1 " + QByteArray::number(status) + ' ' + reason + "\r\n" + headers + CORS_HEADER
+           + "Connection: close\r\n\r\n";
+}
+}
+
+struct CastTranscoder::Stream
+{
+    QString type;                   // video, audio or subtitle
+    QString codec;
+    int typeIndex = 0;              // Among streams of its type, as in 0:a:1
+    int height = 0;
+    int channels = 0;
+    bool isDefault = false;
+    bool forced = false;
+    bool attachedPicture = false;   // Cover art, not video
+};
+
+struct CastTranscoder::MediaInfo
+{
+    QString container;
+    qint64 durationMs = 0;
+    QList<Stream> streams;
+};
+
+struct CastTranscoder::Session
+{
+    QString input;
+    QString token;
+    qint64 durationMs = 0;
+    std::unique_ptr<QTemporaryDir> directory;
+    HardwareAccelerationType encoderType = HardwareAccelerationType::Auto;
+
+    QProcess* encoder = nullptr;
+    int encodeStart = 0;            // First segment of the running encode
+    int encodeNext = 0;             // First segment it has not written yet
+    int prunedBelow = 0;
+
+    // Plan
+    bool copyVideo = true;
+    int videoStream = -1;           // Among video streams, -1 for none
+    int audioStream = -1;
+    int subtitleStream = -1;        // Burned in, -1 for none
+    bool imageSubtitle = false;
+    int scaleHeight = 0;            // 0 to keep the size
+    int videoBitrateKbps = 0;
+    QStringList audioArguments;
+};
+
+CastProfile CastProfile::forDevice(const VideoCastingManager::CastingDevice& device)
+{
+    CastProfile profile;
+
+    if (device.type == VideoCastingManager::Chromecast) {
+        profile.videoCodecs = {"h264", "vp8"};
+        profile.audioCodecs = {"aac", "mp3", "opus", "vorbis", "flac"};
+        profile.containers = {"mp4", "webm"};
+        profile.playsHls = true;
+        if (device.model.contains("Ultra", Qt::CaseInsensitive)
+            || device.model.contains("Google TV", Qt::CaseInsensitive)) {
+            profile.videoCodecs << "hevc" << "vp9";
+            profile.maxHeight = 2160;
+        }
+        return profile;
+    }
+
+    // What every DLNA renderer plays; the rest only when the device lists it
+    profile.videoCodecs = {"h264", "mpeg2video"};
+    profile.audioCodecs = {"aac", "ac3", "mp3", "mp2"};
+    profile.containers = {"mp4", "mpegts"};
+    for (const QString& capability : device.capabilities) {
+        const QString lower = capability.toLower();
+        if (lower.contains("matroska") || lower.contains("mkv")) {
+            profile.containers << "matroska";
+        }
+        if (lower.contains("hevc") || lower.contains("h265")) {
+            profile.videoCodecs << "hevc";
+        }
+        if (lower.contains("eac3") || lower.contains("e-ac-3")) {
+            profile.audioCodecs << "eac3";
+        }
+        if (lower.contains("dts")) {
+            profile.audioCodecs << "dts";
+        }
+        if (lower.contains("uhd") || lower.contains("2160")) {
+            profile.maxHeight = 2160;
+        }
+    }
+    profile.containers.removeDuplicates();
+    profile.videoCodecs.removeDuplicates();
+    profile.audioCodecs.removeDuplicates();
+    return profile;
+}
+
+CastTranscoder::CastTranscoder(QObject* parent)
+    : QObject(parent)
+    , m_acceleration(HardwareAccelerationType::Auto)
+    , m_server(new QTcpServer(this))
+    , m_pollTimer(new QTimer(this))
+{
+    m_pollTimer->setInterval(POLL_INTERVAL_MS);
+    connect(m_pollTimer, &QTimer::timeout, this, &CastTranscoder::servePending);
+    connect(m_server, &QTcpServer::newConnection, this, &CastTranscoder::onNewConnection);
+}
+
+CastTranscoder::~CastTranscoder()
+{
+    stop();
+}
+
+void CastTranscoder::setAcceleration(HardwareAccelerationType type)
+{
+    m_acceleration = type;
+}
+
+QUrl CastTranscoder::start(const QUrl& mediaUrl, const CastProfile& profile, const QString& host)
+{
+    stop();
+
+    const bool local = mediaUrl.isLocalFile() || mediaUrl.isRelative();
+    const QString input = mediaUrl.isLocalFile() ? mediaUrl.toLocalFile() : mediaUrl.toString();
+    if (QStandardPaths::findExecutable("ffmpeg").isEmpty()) {
+        qCWarning(castTranscoder) << "FFmpeg not found, casting" << input << "as is";
+        return QUrl();
+    }
+
+    MediaInfo info;
+    if (!probe(input, &info)) {
+        qCWarning(castTranscoder) << "Could not probe" << input << "- casting it as is";
+        return QUrl();
+    }
+    if (info.durationMs <= 0) {
+        qCInfo(castTranscoder) << "Live or unknown-length media is cast as is:" << input;
+        return QUrl();
+    }
+
+    auto session = std::make_unique<Session>();
+    session->input = input;
+    session->durationMs = info.durationMs;
+    session->encoderType = m_acceleration;
+    if (!buildPlan(*session, info, profile, local)) {
+        qCDebug(castTranscoder) << "Device plays" << input << "as is";
+        return QUrl();
+    }
+
+    session->directory = std::make_unique<QTemporaryDir>(QDir(QDir::tempPath()).filePath("eonplay-cast-XXXXXX"));
+    if (!session->directory->isValid()) {
+        qCWarning(castTranscoder) << "Could not create a segment directory:" << session->directory->errorString();
+        return QUrl();
+    }
+    if (!m_server->isListening() && !m_server->listen(QHostAddress::AnyIPv4, 0)) {
+        qCWarning(castTranscoder) << "Could not listen for cast clients:" << m_server->errorString();
+        return QUrl();
+    }
+
+    session->token = QUuid::createUuid().toString(QUuid::Id128);
+    m_session = std::move(session);
+    startEncoder(0);
+
+    QUrl url;
+    url.setScheme("http");
+    url.setHost(host);
+    url.setPort(m_server->serverPort());
+    url.setPath("/cast/" + m_session->token + (profile.playsHls ? "/index.m3u8" : "/stream.ts"));
+
+    qCInfo(castTranscoder) << "Transcoding" << input << "for casting at" << url.toString()
+                           << (m_session->copyVideo ? "(video copied)" : "(video encoded)");
+    return url;
+}
+
+void CastTranscoder::stop()
+{
+    m_pollTimer->stop();
+    for (const Client& client : std::as_const(m_clients)) {
+        if (client.socket) {
+            client.socket->abort();
+            client.socket->deleteLater();
+        }
+    }
+    m_clients.clear();
+    m_server->close();
+
+    if (!m_session) {
+        return;
+    }
+    if (m_session->encoder) {
+        m_session->encoder->disconnect(this);
+        m_session->encoder->kill();
+        m_session->encoder->waitForFinished(1000);
+        m_session->encoder->deleteLater();
+    }
+    m_session.reset();
+    qCDebug(castTranscoder) << "Cast transcoding stopped";
+}
+
+bool CastTranscoder::probe(const QString& input, MediaInfo* info)
+{
+    const QString ffprobe = QStandardPaths::findExecutable("ffprobe");
+    if (ffprobe.isEmpty()) {
+        return false;
+    }
+
+    QProcess process;
+    process.start(ffprobe, {"-v", "error",
+                            "-show_entries", "format=format_name,duration"
+                                             ":stream=codec_type,codec_name,height,channels"
+                                             ":stream_disposition=default,forced,attached_pic",
+                            "-of", "json", input});
+    if (!process.waitForFinished(PROBE_TIMEOUT_MS) || process.exitCode() != 0) {
+        process.kill();
+        return false;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(process.readAllStandardOutput()).object();
+    const QJsonObject format = root.value("format").toObject();
+    info->container = containerName(format.value("format_name").toString(), input);
+    info->durationMs = qint64(format.value("duration").toString().toDouble() * 1000.0);
+
+    QHash<QString, int> typeCounts;
+    for (const QJsonValue& value : root.value("streams").toArray()) {
+        const QJsonObject object = value.toObject();
+        const QJsonObject disposition = object.value("disposition").toObject();
+        Stream stream;
+        stream.type = object.value("codec_type").toString();
+        stream.codec = object.value("codec_name").toString();
+        stream.typeIndex = typeCounts[stream.type]++;
+        stream.height = object.value("height").toInt();
+        stream.channels = object.value("channels").toInt();
+        stream.isDefault = disposition.value("default").toInt() != 0;
+        stream.forced = disposition.value("forced").toInt() != 0;
+        stream.attachedPicture = disposition.value("attached_pic").toInt() != 0;
+        info->streams.append(stream);
+    }
+    return !info->container.isEmpty();
+}
+
+bool CastTranscoder::buildPlan(Session& session, const MediaInfo& info, const CastProfile& profile, bool local)
+{
+    const Stream* video = nullptr;
+    const Stream* audio = nullptr;
+    const Stream* subtitle = nullptr;
+    for (const Stream& stream : info.streams) {
+        if (stream.type == "video" && !stream.attachedPicture && !video) {
+            video = &stream;
+        } else if (stream.type == "audio" && (!audio || (stream.isDefault && !audio->isDefault))) {
+            audio = &stream;
+        } else if (stream.type == "subtitle" && (stream.forced || stream.isDefault)
+                   && (!subtitle || (stream.forced && !subtitle->forced))) {
+            // Text subtitles are read from the file by the subtitles filter
+            if (IMAGE_SUBTITLE_CODECS.contains(stream.codec)
+                || (local && TEXT_SUBTITLE_CODECS.contains(stream.codec))) {
+                subtitle = &stream;
+            }
+        }
+    }
+
+    const bool videoPlays = !video || (profile.videoCodecs.contains(video->codec)
+                                       && video->height <= profile.maxHeight);
+    const bool audioPlays = !audio || profile.audioCodecs.contains(audio->codec);
+    if (profile.containers.contains(info.container) && videoPlays && audioPlays && !subtitle) {
+        return false;
+    }
+
+    if (video) {
+        session.videoStream = video->typeIndex;
+        session.copyVideo = videoPlays && !subtitle && TS_VIDEO_CODECS.contains(video->codec);
+        if (video->height > profile.maxHeight) {
+            session.scaleHeight = profile.maxHeight;
+        }
+        const int height = session.scaleHeight > 0 ? session.scaleHeight : video->height;
+        session.videoBitrateKbps = height > 1080 ? 20000 : (height > 720 ? 8000 : 4000);
+    }
+    if (subtitle) {
+        session.subtitleStream = subtitle->typeIndex;
+        session.imageSubtitle = IMAGE_SUBTITLE_CODECS.contains(subtitle->codec);
+    }
+    if (audio) {
+        session.audioStream = audio->typeIndex;
+        if (audioPlays && TS_AUDIO_CODECS.contains(audio->codec)) {
+            session.audioArguments = {"-c:a", "copy"};
+        } else if (audio->channels > 2 && profile.audioCodecs.contains("ac3")) {
+            // Keep surround where the device decodes AC-3, e.g. for DTS tracks
+            session.audioArguments = {"-c:a", "ac3", "-b:a", "448k"};
+        } else {
+            session.audioArguments = {"-c:a", "aac", "-ac", "2", "-b:a", "192k"};
+        }
+    }
+    return true;
+}
+
+void CastTranscoder::startEncoder(int firstSegment)
+{
+    Session& session = *m_session;
+    if (session.encoder) {
+        session.encoder->disconnect(this);
+        session.encoder->kill();
+        session.encoder->waitForFinished(1000);
+        session.encoder->deleteLater();
+    }
+
+    const qint64 startSeconds = qint64(firstSegment) * SEGMENT_SECONDS;
+    const VideoEncoder encoder = videoEncoder(session.encoderType);
+    QStringList arguments = {"-hide_banner", "-nostdin", "-loglevel", "error"};
+    if (!session.copyVideo) {
+        arguments << encoder.inputArguments;
+    }
+    // -copyts keeps source timestamps, so burned subtitles stay in sync and
+    // segments from restarted encodes line up with earlier ones
+    if (startSeconds > 0) {
+        arguments << "-ss" << QString::number(startSeconds);
+    }
+    arguments << "-copyts" << "-i" << session.input;
+
+    if (session.videoStream >= 0) {
+        const QString videoInput = "0:v:" + QString::number(session.videoStream);
+        if (session.copyVideo) {
+            arguments << "-map" << videoInput << "-c:v" << "copy";
+        } else {
+            QStringList chain;
+            if (session.subtitleStream >= 0 && !session.imageSubtitle) {
+                chain << "subtitles=" + filterArgument(session.input) + ":si=" + QString::number(session.subtitleStream);
+            }
+            if (session.scaleHeight > 0) {
+                chain << "scale=-2:" + QString::number(session.scaleHeight);
+            }
+            chain << encoder.filters;
+
+            if (session.subtitleStream >= 0 && session.imageSubtitle) {
+                const QString graph = "[" + videoInput + "][0:s:" + QString::number(session.subtitleStream) + "]overlay"
+                                      + (chain.isEmpty() ? QString() : "," + chain.join(',')) + "[v]";
+                arguments << "-filter_complex" << graph << "-map" << "[v]";
+            } else {
+                arguments << "-map" << videoInput;
+                if (!chain.isEmpty()) {
+                    arguments << "-vf" << chain.join(',');
+                }
+            }
+
+            const QString bitrate = QString::number(session.videoBitrateKbps) + "k";
+            arguments << encoder.arguments
+                      << "-b:v" << bitrate << "-maxrate" << bitrate
+                      << "-bufsize" << QString::number(session.videoBitrateKbps * 2) + "k"
+                      << "-force_key_frames"
+                      << "expr:gte(t," + QString::number(startSeconds) + "+n_forced*"
+                             + QString::number(SEGMENT_SECONDS) + ")";
+        }
+    }
+    if (session.audioStream >= 0) {
+        arguments << "-map" << "0:a:" + QString::number(session.audioStream) << session.audioArguments;
+    }
+
+    // Segments appear under their final name only once complete
+    arguments << "-f" << "hls" << "-hls_time" << QString::number(SEGMENT_SECONDS)
+              << "-hls_list_size" << "0" << "-hls_flags" << "temp_file"
+              << "-start_number" << QString::number(firstSegment)
+              << "-hls_segment_filename" << session.directory->filePath("%d.ts")
+              << session.directory->filePath("encoder.m3u8");
+
+    session.encodeStart = firstSegment;
+    session.encodeNext = firstSegment;
+    session.prunedBelow = std::min(session.prunedBelow, firstSegment);
+    session.encoder = new QProcess(this);
+    connect(session.encoder, &QProcess::finished, this, &CastTranscoder::onEncoderFinished);
+    session.encoder->start(QStandardPaths::findExecutable("ffmpeg"), arguments);
+
+    qCDebug(castTranscoder) << "Encoding from segment" << firstSegment << arguments;
+}
+
+void CastTranscoder::onEncoderFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (!m_session || sender() != m_session->encoder) {
+        return;
+    }
+    Session& session = *m_session;
+    if (exitStatus == QProcess::NormalExit && exitCode == 0) {
+        qCDebug(castTranscoder) << "Encoded through to the end from segment" << session.encodeStart;
+        return;
+    }
+
+    const QString error = QString::fromLocal8Bit(session.encoder->readAllStandardError()).trimmed();
+    const bool produced = segmentReady(session.encodeStart);
+    if (!produced && !session.copyVideo && session.encoderType != HardwareAccelerationType::Software) {
+        qCWarning(castTranscoder) << "Hardware encoding failed, falling back to software:" << error;
+        session.encoderType = HardwareAccelerationType::Software;
+        startEncoder(session.encodeStart);
+        return;
+    }
+
+    qCWarning(castTranscoder) << "Cast transcoding failed:" << error;
+    emit transcodeFailed(error);
+}
+
+void CastTranscoder::onNewConnection()
+{
+    while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            handleRequest(socket);
+        });
+    }
+}
+
+void CastTranscoder::handleRequest(QTcpSocket* socket)
+{
+    const QByteArray buffered = socket->peek(MAX_REQUEST_HEAD_BYTES + 1);
+    const qsizetype end = buffered.indexOf("\r\n\r\n");
+    if (end < 0) {
+        if (buffered.size() > MAX_REQUEST_HEAD_BYTES) {
+            sendError(socket, 431, "Request Header Fields Too Large");
+        }
+        return;
+    }
+
+    // One request per connection
+    disconnect(socket, &QTcpSocket::readyRead, this, nullptr);
+    const QByteArray head = socket->read(end + 4);
+    const QList<QByteArray> requestLine = head.left(head.indexOf("\r\n")).split(' ');
+    if (requestLine.size() < 2) {
+        sendError(socket, 400, "Bad Request");
+        return;
+    }
+    const QByteArray method = requestLine[0];
+    if (method != "GET" && method != "HEAD") {
+        sendError(socket, 405, "Method Not Allowed");
+        return;
+    }
+
+    const QStringList path = QUrl(QString::fromUtf8(requestLine[1])).path().split('/', Qt::SkipEmptyParts);
+    if (!m_session || path.size() != 3 || path[0] != "cast" || path[1] != m_session->token) {
+        sendError(socket, 404, "Not Found");
+        return;
+    }
+
+    const bool headOnly = method == "HEAD";
+    const QString name = path[2];
+    if (name == "index.m3u8") {
+        sendPlaylist(socket, headOnly);
+        return;
+    }
+
+    Client client;
+    client.socket = socket;
+    client.waiting.start();
+    if (name == "stream.ts") {
+        const QByteArray range = headerValue(head, "TimeSeekRange.dlna.org");
+        const double startSeconds = range.isEmpty() ? 0.0 : nptSeconds(range);
+        if (startSeconds * 1000.0 >= m_session->durationMs) {
+            sendError(socket, 416, "Requested Range Not Satisfiable");
+            return;
+        }
+        sendStreamHead(socket, startSeconds, !range.isEmpty());
+        if (headOnly) {
+            socket->disconnectFromHost();
+            return;
+        }
+        client.stream = true;
+        client.segment = int(startSeconds / SEGMENT_SECONDS);
+    } else {
+        bool valid = false;
+        client.segment = name.endsWith(".ts") ? name.chopped(3).toInt(&valid) : -1;
+        if (!valid || client.segment < 0 || client.segment >= segmentCount()) {
+            sendError(socket, 404, "Not Found");
+            return;
+        }
+        if (headOnly) {
+            socket->write(responseHead(200, "OK", "Content-Type: video/mp2t\r\n"));
+            socket->disconnectFromHost();
+            return;
+        }
+    }
+
+    requireSegment(client.segment);
+    m_clients.append(client);
+    m_pollTimer->start();
+    servePending();
+}
+
+void CastTranscoder::sendPlaylist(QTcpSocket* socket, bool headOnly)
+{
+    const Session& session = *m_session;
+    // Copied video is cut at its own keyframes, so segments can run long
+    const int targetDuration = session.copyVideo ? SEGMENT_SECONDS * 2 : SEGMENT_SECONDS;
+
+    QByteArray playlist = "#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-PLAYLIST-TYPE:VOD\n#EXT-X-TARGETDURATION:"
+                          + QByteArray::number(targetDuration) + "\n#EXT-X-MEDIA-SEQUENCE:0\n";
+    const int count = segmentCount();
+    for (int segment = 0; segment < count; ++segment) {
+        const qint64 segmentMs = std::min<qint64>(SEGMENT_SECONDS * 1000,
+                                                  session.durationMs - qint64(segment) * SEGMENT_SECONDS * 1000);
+        playlist += "#EXTINF:" + QByteArray::number(segmentMs / 1000.0, 'f', 3) + ",\n"
+                    + QByteArray::number(segment) + ".ts\n";
+    }
+    playlist += "#EXT-X-ENDLIST\n";
+
+    socket->write(responseHead(200, "OK", "Content-Type: application/vnd.apple.mpegurl\r\nContent-Length: "
+                                              + QByteArray::number(playlist.size()) + "\r\n"));
+    if (!headOnly) {
+        socket->write(playlist);
+    }
+    socket->disconnectFromHost();
+}
+
+void CastTranscoder::sendStreamHead(QTcpSocket* socket, double startSeconds, bool timeSeek)
+{
+    QByteArray headers = "Content-Type: video/mpeg\r\n" + DLNA_STREAM_HEADERS;
+    if (timeSeek) {
+        const double duration = m_session->durationMs / 1000.0;
+        headers += "TimeSeekRange.dlna.org: npt=" + nptTime(startSeconds) + '-' + nptTime(duration) + '/'
+                   + nptTime(duration) + "\r\n";
+    }
+    socket->write(responseHead(200, "OK", headers));
+}
+
+void CastTranscoder::sendError(QTcpSocket* socket, int status, const QByteArray& reason)
+{
+    socket->write(responseHead(status, reason, "Content-Length: 0\r\n"));
+    socket->disconnectFromHost();
+}
+
+void CastTranscoder::servePending()
+{
+    const int count = m_session ? segmentCount() : 0;
+    for (auto it = m_clients.begin(); it != m_clients.end();) {
+        Client& client = *it;
+        bool done = !client.socket || client.socket->state() != QAbstractSocket::ConnectedState;
+
+        if (!done && !client.stream) {
+            if (segmentReady(client.segment)) {
+                QFile file(segmentPath(client.segment));
+                const QByteArray data = file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+                client.socket->write(responseHead(200, "OK", "Content-Type: video/mp2t\r\nContent-Length: "
+                                                                 + QByteArray::number(data.size()) + "\r\n"));
+                client.socket->write(data);
+                client.socket->disconnectFromHost();
+                done = true;
+            }
+        } else if (!done) {
+            while (client.segment < count && segmentReady(client.segment)
+                   && client.socket->bytesToWrite() < STREAM_BACKLOG_BYTES) {
+                QFile file(segmentPath(client.segment));
+                if (file.open(QIODevice::ReadOnly)) {
+                    client.socket->write(file.readAll());
+                }
+                client.waiting.restart();
+                if (++client.segment < count) {
+                    requireSegment(client.segment);
+                }
+            }
+            if (client.segment >= count) {
+                client.socket->disconnectFromHost();
+                done = true;
+            }
+        }
+
+        if (!done && client.waiting.hasExpired(SEGMENT_WAIT_TIMEOUT_MS)) {
+            qCWarning(castTranscoder) << "Timed out waiting for segment" << client.segment;
+            if (client.stream) {
+                client.socket->abort();
+            } else {
+                sendError(client.socket, 504, "Gateway Timeout");
+            }
+            done = true;
+        }
+        it = done ? m_clients.erase(it) : it + 1;
+    }
+
+    pruneSegments();
+    if (m_clients.isEmpty()) {
+        m_pollTimer->stop();
+    }
+}
+
+void CastTranscoder::requireSegment(int segment)
+{
+    if (!m_session || segmentReady(segment)) {
+        return;
+    }
+
+    Session& session = *m_session;
+    while (session.encodeNext < segmentCount() && segmentReady(session.encodeNext)) {
+        ++session.encodeNext;
+    }
+    const bool running = session.encoder && session.encoder->state() != QProcess::NotRunning;
+    if (running && segment >= session.encodeStart && segment <= session.encodeNext + SEEK_AHEAD_SEGMENTS) {
+        return;
+    }
+
+    qCDebug(castTranscoder) << "Seek to segment" << segment << "restarts the encode";
+    startEncoder(segment);
+}
+
+QString CastTranscoder::segmentPath(int segment) const
+{
+    return m_session->directory->filePath(QString::number(segment) + ".ts");
+}
+
+bool CastTranscoder::segmentReady(int segment) const
+{
+    return m_session && QFile::exists(segmentPath(segment));
+}
+
+int CastTranscoder::segmentCount() const
+{
+    const qint64 segmentMs = qint64(SEGMENT_SECONDS) * 1000;
+    return int((m_session->durationMs + segmentMs - 1) / segmentMs);
+}
+
+void CastTranscoder::pruneSegments()
+{
+    if (!m_session || m_clients.isEmpty()) {
+        return;
+    }
+
+    int earliest = m_clients.first().segment;
+    for (const Client& client : std::as_const(m_clients)) {
+        earliest = std::min(earliest, client.segment);
+    }
+    const int keepFrom = earliest - KEEP_BEHIND_SEGMENTS;
+    for (; m_session->prunedBelow < keepFrom; ++m_session->prunedBelow) {
+        QFile::remove(segmentPath(m_session->prunedBelow));
+    }
+}
@@ -0,0 +1,335 @@
+#include "network/ClockSync.h"
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QtEndian>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+Q_LOGGING_CATEGORY(clockSync, "eonplay.network.clocksync")
+
+namespace {
+
+constexpr quint32 PACKET_MAGIC = 0x4550434B;    // "EPCK"
+constexpr quint8 REQUEST = 1;
+constexpr quint8 REPLY = 2;
+constexpr int PACKET_SIZE = 36;
+
+// Replies older than this many polls mean the reference is gone
+constexpr int STALE_POLLS = 20;
+constexpr double MAX_DRIFT = 500e-6;
+constexpr qint64 MIN_FIT_SPAN_NS = 1000000000;
+
+struct Packet {
+    quint8 type = 0;
+    quint32 sequence = 0;
+    qint64 t1 = 0;
+    qint64 t2 = 0;
+    qint64 t3 = 0;
+};
+
+QByteArray encodePacket(const Packet& packet)
+{
+    QByteArray data(PACKET_SIZE, '\0');
+    uchar* out = reinterpret_cast<uchar*>(data.data());
+    qToBigEndian<quint32>(PACKET_MAGIC, out);
+    out[4] = packet.type;
+    qToBigEndian<quint32>(packet.sequence, out + 8);
+    qToBigEndian<qint64>(packet.t1, out + 12);
+    qToBigEndian<qint64>(packet.t2, out + 20);
+    qToBigEndian<qint64>(packet.t3, out + 28);
+    return data;
+}
+
+bool decodePacket(const QByteArray& data, Packet& packet)
+{
+    if (data.size() != PACKET_SIZE) {
+        return false;
+    }
+    const uchar* in = reinterpret_cast<const uchar*>(data.constData());
+    if (qFromBigEndian<quint32>(in) != PACKET_MAGIC) {
+        return false;
+    }
+    packet.type = in[4];
+    packet.sequence = qFromBigEndian<quint32>(in + 8);
+    packet.t1 = qFromBigEndian<qint64>(in + 12);
+    packet.t2 = qFromBigEndian<qint64>(in + 20);
+    packet.t3 = qFromBigEndian<qint64>(in + 28);
+    return packet.type == REQUEST || packet.type == REPLY;
+}
+
+} // namespace
+
+ClockSync::ClockSync(QObject* parent)
+    : QObject(parent)
+    , m_socket(new QUdpSocket(this))
+    , m_pollTimer(new QTimer(this))
+    , m_referencePort(DEFAULT_PORT)
+    , m_sequence(0)
+    , m_isReference(true)
+    , m_reportedLock(true)
+{
+    m_exchanges.reserve(WINDOW);
+    m_estimate.locked = true;
+
+    connect(m_socket, &QUdpSocket::readyRead, this, &ClockSync::readPendingDatagrams);
+
+    m_pollTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_pollTimer, &QTimer::timeout, this, &ClockSync::poll);
+}
+
+ClockSync::~ClockSync()
+{
+    stop();
+}
+
+qint64 ClockSync::localTimeNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool ClockSync::start(quint16 port)
+{
+    if (m_socket->state() == QAbstractSocket::BoundState) {
+        return true;
+    }
+
+    if (!m_socket->bind(QHostAddress::Any, port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
+        qCWarning(clockSync) << "Failed to bind clock sync port" << port << ":" << m_socket->errorString();
+        return false;
+    }
+
+    qCDebug(clockSync) << "Clock sync listening on port" << port;
+    return true;
+}
+
+void ClockSync::stop()
+{
+    m_pollTimer->stop();
+    m_socket->close();
+}
+
+void ClockSync::followReference(const QHostAddress& reference, quint16 port)
+{
+    if (reference == m_reference && port == m_referencePort && !m_isReference) {
+        return;
+    }
+
+    m_reference = reference;
+    m_referencePort = port;
+    m_exchanges.clear();
+
+    {
+        QMutexLocker locker(&m_estimateMutex);
+        m_isReference = reference.isNull();
+        m_estimate = Estimate();
+        m_estimate.locked = m_isReference;
+    }
+    m_reportedLock = m_isReference;
+
+    if (m_isReference) {
+        m_pollTimer->stop();
+        qCInfo(clockSync) << "Acting as the group's reference clock";
+    } else {
+        m_pollTimer->start(FAST_POLL_INTERVAL_MS);
+        qCInfo(clockSync) << "Following reference clock at" << reference << "port" << port;
+        poll();
+    }
+    emit lockChanged(m_isReference);
+}
+
+void ClockSync::poll()
+{
+    if (m_isReference || m_reference.isNull()) {
+        return;
+    }
+
+    const qint64 now = localTimeNs();
+    if (!m_exchanges.isEmpty() &&
+        now - m_exchanges.last().localNs > qint64(STALE_POLLS) * POLL_INTERVAL_MS * 1000000) {
+        qCWarning(clockSync) << "Reference clock stopped answering";
+        m_exchanges.clear();
+        m_pollTimer->setInterval(FAST_POLL_INTERVAL_MS);
+        updateLock(false);
+    }
+
+    Packet request;
+    request.type = REQUEST;
+    request.sequence = ++m_sequence;
+    request.t1 = localTimeNs();
+    m_socket->writeDatagram(encodePacket(request), m_reference, m_referencePort);
+}
+
+void ClockSync::readPendingDatagrams()
+{
+    while (m_socket->hasPendingDatagrams()) {
+        const qint64 received = localTimeNs();
+
+        QByteArray data(int(m_socket->pendingDatagramSize()), '\0');
+        QHostAddress sender;
+        quint16 senderPort = 0;
+        m_socket->readDatagram(data.data(), data.size(), &sender, &senderPort);
+
+        Packet packet;
+        if (!decodePacket(data, packet)) {
+            continue;
+        }
+
+        if (packet.type == REQUEST) {
+            // Every peer answers, so any of them can be made the reference
+            packet.type = REPLY;
+            packet.t2 = received;
+            packet.t3 = localTimeNs();
+            m_socket->writeDatagram(encodePacket(packet), sender, senderPort);
+            continue;
+        }
+
+        // Only the reply to the latest request; a late one has queued somewhere
+        if (m_isReference || packet.sequence != m_sequence) {
+            continue;
+        }
+
+        Exchange exchange;
+        exchange.localNs = received;
+        exchange.offsetNs = ((packet.t2 - packet.t1) + (packet.t3 - received)) / 2;
+        exchange.roundTripNs = (received - packet.t1) - (packet.t3 - packet.t2);
+        if (exchange.roundTripNs >= 0) {
+            addExchange(exchange);
+        }
+    }
+}
+
+void ClockSync::addExchange(const Exchange& exchange)
+{
+    if (m_exchanges.size() >= WINDOW) {
+        m_exchanges.removeFirst();
+    }
+    m_exchanges.append(exchange);
+
+    const auto best = std::min_element(m_exchanges.constBegin(), m_exchanges.constEnd(),
+                                       [](const Exchange& a, const Exchange& b) {
+                                           return a.roundTripNs < b.roundTripNs;
+                                       });
+
+    // Exchanges not much slower than the best are barely delayed by queueing
+    const qint64 tolerance = qMax<qint64>(best->roundTripNs / 2, 50000);
+    QVector<Exchange> good;
+    for (const Exchange& candidate : m_exchanges) {
+        if (candidate.roundTripNs <= best->roundTripNs + tolerance) {
+            good.append(candidate);
+        }
+    }
+
+    Estimate estimate;
+    estimate.roundTripNs = best->roundTripNs;
+    estimate.offsetNs = best->offsetNs;
+    estimate.anchorNs = best->localNs;
+    estimate.locked = m_exchanges.size() >= MIN_SAMPLES && best->roundTripNs <= MAX_ROUND_TRIP_NS;
+
+    // Least-squares drift, in doubles relative to the first good exchange
+    if (good.size() >= MIN_SAMPLES && good.last().localNs - good.first().localNs >= MIN_FIT_SPAN_NS) {
+        const qint64 baseTime = good.first().localNs;
+        const qint64 baseOffset = good.first().offsetNs;
+        double meanTime = 0.0;
+        double meanOffset = 0.0;
+        for (const Exchange& sample : good) {
+            meanTime += double(sample.localNs - baseTime);
+            meanOffset += double(sample.offsetNs - baseOffset);
+        }
+        meanTime /= good.size();
+        meanOffset /= good.size();
+
+        double covariance = 0.0;
+        double variance = 0.0;
+        for (const Exchange& sample : good) {
+            const double dt = double(sample.localNs - baseTime) - meanTime;
+            covariance += dt * (double(sample.offsetNs - baseOffset) - meanOffset);
+            variance += dt * dt;
+        }
+
+        if (variance > 0.0) {
+            estimate.drift = qBound(-MAX_DRIFT, covariance / variance, MAX_DRIFT);
+            estimate.anchorNs = baseTime + qint64(meanTime);
+            estimate.offsetNs = baseOffset + qint64(meanOffset);
+        }
+    }
+
+    {
+        QMutexLocker locker(&m_estimateMutex);
+        m_estimate = estimate;
+    }
+
+    if (estimate.locked && m_pollTimer->interval() != POLL_INTERVAL_MS) {
+        m_pollTimer->setInterval(POLL_INTERVAL_MS);
+    }
+    updateLock(estimate.locked);
+}
+
+void ClockSync::updateLock(bool locked)
+{
+    {
+        QMutexLocker locker(&m_estimateMutex);
+        m_estimate.locked = locked;
+    }
+
+    if (locked != m_reportedLock) {
+        m_reportedLock = locked;
+        qCInfo(clockSync) << (locked ? "Locked to" : "Lost lock to") << "reference clock, round trip"
+                          << roundTripNs() / 1000 << "us";
+        emit lockChanged(locked);
+    }
+}
+
+qint64 ClockSync::toGroupTime(qint64 localNs) const
+{
+    QMutexLocker locker(&m_estimateMutex);
+    if (m_isReference) {
+        return localNs;
+    }
+    return localNs + m_estimate.offsetNs + qint64(m_estimate.drift * double(localNs - m_estimate.anchorNs));
+}
+
+qint64 ClockSync::toLocalTime(qint64 groupNs) const
+{
+    QMutexLocker locker(&m_estimateMutex);
+    if (m_isReference) {
+        return groupNs;
+    }
+
+    // First-order inverse; the drift term is a few microseconds per second
+    const qint64 approximate = groupNs - m_estimate.offsetNs;
+    return approximate - qint64(m_estimate.drift * double(approximate - m_estimate.anchorNs));
+}
+
+bool ClockSync::isLocked() const
+{
+    QMutexLocker locker(&m_estimateMutex);
+    return m_isReference || m_estimate.locked;
+}
+
+bool ClockSync::isReference() const
+{
+    QMutexLocker locker(&m_estimateMutex);
+    return m_isReference;
+}
+
+qint64 ClockSync::offsetNs() const
+{
+    QMutexLocker locker(&m_estimateMutex);
+    return m_estimate.offsetNs;
+}
+
+qint64 ClockSync::roundTripNs() const
+{
+    QMutexLocker locker(&m_estimateMutex);
+    return m_estimate.roundTripNs;
+}
+
+double ClockSync::driftPpm() const
+{
+    QMutexLocker locker(&m_estimateMutex);
+    return m_estimate.drift * 1e6;
+}
@@ -0,0 +1,874 @@
+#include "network/ContentDirectoryService.h"
+#include "data/CoverArtStore.h"
+#include "data/DatabaseManager.h"
+#include "data/MediaFile.h"
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMimeDatabase>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSysInfo>
+#include <QUrl>
+#include <QUuid>
+#include <QXmlStreamReader>
+#include <iterator>
+
+Q_LOGGING_CATEGORY(contentDirectory, "eonplay.network.contentdirectory")
+
+using EonPlay::Data::CoverArtStore;
+using EonPlay::Data::DatabaseManager;
+using EonPlay::Data::MediaFile;
+
+namespace {
+
+// UPnP error codes used in SOAP faults
+const int INVALID_ACTION = 401;
+const int INVALID_ARGS = 402;
+const int NO_SUCH_OBJECT = 701;
+const int INVALID_SEARCH_CRITERIA = 708;
+const int NO_SUCH_CONTAINER = 710;
+const int CANNOT_PROCESS = 720;
+
+// Columns of an item row, in this order
+const char ITEM_COLUMNS[] =
+    "m.id, m.title, m.artist, m.album, m.genre, m.track_number, m.duration, m.file_size, m.file_path, m.cover_art_path";
+enum ItemColumn { ItemId, ItemTitle, ItemArtist, ItemAlbum, ItemGenre, ItemTrack, ItemDuration, ItemSize, ItemPath, ItemArt };
+
+const char TRACKS_ID[] = "tracks";
+const char ITEM_PREFIX[] = "item/";
+
+/**
+ * @brief A library facet as a container of its values, each a container of tracks
+ */
+struct FacetContainer {
+    DatabaseManager::Facet facet;
+    const char* listId;
+    const char* title;
+    const char* valuePrefix;
+    const char* valueClass;
+    const char* trackOrder;     // Served by the facet's browse index
+};
+
+const FacetContainer FACET_CONTAINERS[] = {
+    { DatabaseManager::ArtistFacet, "artists", "Artists", "artist/",
+      "object.container.person.musicArtist", "m.album, m.track_number, m.title, m.id" },
+    { DatabaseManager::AlbumFacet, "albums", "Albums", "album/",
+      "object.container.album.musicAlbum", "m.track_number, m.title, m.id" },
+    { DatabaseManager::GenreFacet, "genres", "Genres", "genre/",
+      "object.container.genre.musicGenre", "m.artist, m.album, m.title, m.id" }
+};
+
+struct RowPage {
+    QVector<QVariantList> rows;
+    int total = 0;
+    bool ok = false;
+};
+
+/**
+ * @brief Run a count and a LIMIT/OFFSET page query on a reader connection
+ * @param rowSql Page query ending in "LIMIT ? OFFSET ?"
+ * @param countSql Query of the total; empty to use the rows' own count
+ */
+RowPage readPage(QSqlDatabase& database, const QString& rowSql, const QVariantList& rowValues,
+                 const QString& countSql, const QVariantList& countValues, int start, int count)
+{
+    RowPage page;
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    if (!countSql.isEmpty()) {
+        query.prepare(countSql);
+        for (const QVariant& value : countValues) {
+            query.addBindValue(value);
+        }
+        if (!query.exec()) {
+            qCWarning(contentDirectory) << "Count query failed:" << query.lastError().text();
+            return page;
+        }
+        page.total = query.next() ? query.value(0).toInt() : 0;
+        query.finish();
+    }
+
+    query.prepare(rowSql);
+    for (const QVariant& value : rowValues) {
+        query.addBindValue(value);
+    }
+    query.addBindValue(count);
+    query.addBindValue(start);
+    if (!query.exec()) {
+        qCWarning(contentDirectory) << "Page query failed:" << query.lastError().text();
+        return page;
+    }
+
+    const int columns = query.record().count();
+    while (query.next()) {
+        QVariantList row;
+        row.reserve(columns);
+        for (int i = 0; i < columns; ++i) {
+            row.append(query.value(i));
+        }
+        page.rows.append(row);
+    }
+
+    if (countSql.isEmpty()) {
+        page.total = start + page.rows.size();
+    }
+    page.ok = true;
+    return page;
+}
+
+RowPage runPage(DatabaseManager* dbManager, const QString& rowSql, const QVariantList& rowValues,
+                const QString& countSql, const QVariantList& countValues, int start, int count)
+{
+    // Worker threads may block; the GUI thread's connection is never used
+    return dbManager->executor()->read([=](QSqlDatabase& database) {
+        return readPage(database, rowSql, rowValues, countSql, countValues, start, count);
+    }).result();
+}
+
+QString errorDescription(int errorCode)
+{
+    switch (errorCode) {
+    case NO_SUCH_OBJECT:
+        return QStringLiteral("No such object");
+    case NO_SUCH_CONTAINER:
+        return QStringLiteral("No such container");
+    default:
+        return QStringLiteral("Cannot process the request");
+    }
+}
+
+QString escaped(const QString& text)
+{
+    return text.toHtmlEscaped();
+}
+
+QString formatDuration(qint64 milliseconds)
+{
+    return QString("%1:%2:%3.%4")
+        .arg(milliseconds / 3600000)
+        .arg((milliseconds / 60000) % 60, 2, 10, QLatin1Char('0'))
+        .arg((milliseconds / 1000) % 60, 2, 10, QLatin1Char('0'))
+        .arg(milliseconds % 1000, 3, 10, QLatin1Char('0'));
+}
+
+QString didlContainer(const QString& id, const QString& parentId, const QString& title, const char* upnpClass,
+                      int childCount)
+{
+    return QString("<container id=\"%1\" parentID=\"%2\" restricted=\"1\" searchable=\"1\" childCount=\"%3\">"
+                   "<dc:title>%4</dc:title><upnp:class>%5</upnp:class></container>")
+        .arg(escaped(id), escaped(parentId), QString::number(childCount), escaped(title), QLatin1String(upnpClass));
+}
+
+QString didlItem(const QVariantList& row, const QString& parentId, const QString& baseUrl)
+{
+    static const QMimeDatabase mimeDatabase;
+
+    const QString id = row[ItemId].toString();
+    const QString path = row[ItemPath].toString();
+    const bool video = MediaFile::detectMediaType(path) == MediaFile::Video;
+    const QString mimeType = mimeDatabase.mimeTypeForFile(path, QMimeDatabase::MatchExtension).name();
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    const QString title = row[ItemTitle].toString().isEmpty() ? QFileInfo(path).completeBaseName()
+                                                              : row[ItemTitle].toString();
+
+    QString item = QString("<item id=\"%1%2\" parentID=\"%3\" restricted=\"1\"><dc:title>%4</dc:title>"
+                           "<upnp:class>%5</upnp:class>")
+        .arg(QLatin1String(ITEM_PREFIX), id, escaped(parentId), escaped(title),
+             QLatin1String(video ? "object.item.videoItem" : "object.item.audioItem.musicTrack"));
+
+    const QString artist = row[ItemArtist].toString();
+    if (!artist.isEmpty()) {
+        item += QString("<upnp:artist>%1</upnp:artist><dc:creator>%1</dc:creator>").arg(escaped(artist));
+    }
+    if (!row[ItemAlbum].toString().isEmpty()) {
+        item += QString("<upnp:album>%1</upnp:album>").arg(escaped(row[ItemAlbum].toString()));
+    }
+    if (!row[ItemGenre].toString().isEmpty()) {
+        item += QString("<upnp:genre>%1</upnp:genre>").arg(escaped(row[ItemGenre].toString()));
+    }
+    if (row[ItemTrack].toInt() > 0) {
+        item += QString("<upnp:originalTrackNumber>%1</upnp:originalTrackNumber>").arg(row[ItemTrack].toInt());
+    }
+    if (!row[ItemArt].toString().isEmpty()) {
+        item += QString("<upnp:albumArtURI dlna:profileID=\"JPEG_TN\">%1/upnp/art/%2.jpg</upnp:albumArtURI>")
+            .arg(escaped(baseUrl), id);
+    }
+
+    item += QString("<res protocolInfo=\"http-get:*:%1:*\" size=\"%2\"")
+        .arg(mimeType, QString::number(row[ItemSize].toLongLong()));
+    if (row[ItemDuration].toLongLong() > 0) {
+        item += QString(" duration=\"%1\"").arg(formatDuration(row[ItemDuration].toLongLong()));
+    }
+    item += QString(">%1/upnp/media/%2.%3</res></item>").arg(escaped(baseUrl), id, suffix);
+
+    return item;
+}
+
+QByteArray didlDocument(const QString& content)
+{
+    return QByteArray("<DIDL-Lite xmlns=\"urn:schemas-upnp-org:metadata-1-0/DIDL-Lite/\" "
+                      "xmlns:dc=\"http://purl.org/dc/elements/1.1/\" "
+                      "xmlns:upnp=\"urn:schemas-upnp-org:metadata-1-0/upnp/\" "
+                      "xmlns:dlna=\"urn:schemas-dlna-org:metadata-1-0/\">")
+           + content.toUtf8() + "</DIDL-Lite>";
+}
+
+QByteArray soapEnvelope(const QString& action, const QString& serviceType,
+                        const QList<QPair<QString, QString>>& arguments)
+{
+    QString body;
+    for (const auto& argument : arguments) {
+        body += QString("<%1>%2</%1>").arg(argument.first, escaped(argument.second));
+    }
+
+    return QString("<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+                   "<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" "
+                   "s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\"><s:Body>"
+                   "<u:%1Response xmlns:u=\"%2\">%3</u:%1Response></s:Body></s:Envelope>")
+        .arg(action, serviceType, body).toUtf8();
+}
+
+ContentDirectoryService::Response soapFault(int errorCode, const QString& description)
+{
+    ContentDirectoryService::Response response;
+    response.status = 500;
+    response.body = QString("<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+                            "<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" "
+                            "s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\"><s:Body><s:Fault>"
+                            "<faultcode>s:Client</faultcode><faultstring>UPnPError</faultstring><detail>"
+                            "<UPnPError xmlns=\"urn:schemas-upnp-org:control-1-0\">"
+                            "<errorCode>%1</errorCode><errorDescription>%2</errorDescription>"
+                            "</UPnPError></detail></s:Fault></s:Body></s:Envelope>")
+        .arg(errorCode).arg(escaped(description)).toUtf8();
+    return response;
+}
+
+/**
+ * @brief Read the arguments of a SOAP action, by element name
+ */
+QHash<QString, QString> parseArguments(const QByteArray& body, const QString& action)
+{
+    QHash<QString, QString> arguments;
+    QXmlStreamReader xml(body);
+
+    while (xml.readNextStartElement()) {
+        if (xml.name() == action) {
+            while (xml.readNextStartElement()) {
+                arguments.insert(xml.name().toString(), xml.readElementText());
+            }
+            break;
+        }
+        if (xml.name() != QLatin1String("Envelope") && xml.name() != QLatin1String("Body")) {
+            xml.skipCurrentElement();
+        }
+    }
+
+    return arguments;
+}
+
+QString facetCountSql()
+{
+    return QStringLiteral("SELECT COUNT(*) FROM library_aggregates WHERE facet = ? AND file_count > 0");
+}
+
+QString valueCountSql()
+{
+    return QStringLiteral("SELECT file_count FROM library_aggregates WHERE facet = ? AND value = ?");
+}
+
+} // namespace
+
+/**
+ * @brief What an object id names
+ *
+ * Ids are "0", the top containers ("artists", ..., "tracks"), a facet
+ * value ("artist/<percent-encoded name>") or a track ("item/<id>").
+ */
+struct ContentDirectoryService::ObjectRef {
+    enum Kind { Invalid, Root, FacetList, FacetValue, Tracks, Item };
+
+    Kind kind = Invalid;
+    const FacetContainer* facet = nullptr;
+    QString value;
+    int itemId = 0;
+
+    static ObjectRef parse(const QString& id)
+    {
+        ObjectRef object;
+        if (id == QLatin1String("0")) {
+            object.kind = Root;
+        } else if (id == QLatin1String(TRACKS_ID)) {
+            object.kind = Tracks;
+        } else if (id.startsWith(QLatin1String(ITEM_PREFIX))) {
+            bool ok = false;
+            object.itemId = id.mid(int(qstrlen(ITEM_PREFIX))).toInt(&ok);
+            object.kind = ok ? Item : Invalid;
+        } else {
+            for (const FacetContainer& container : FACET_CONTAINERS) {
+                if (id == QLatin1String(container.listId)) {
+                    object.kind = FacetList;
+                    object.facet = &container;
+                } else if (id.startsWith(QLatin1String(container.valuePrefix))) {
+                    object.kind = FacetValue;
+                    object.facet = &container;
+                    object.value = QUrl::fromPercentEncoding(id.mid(int(qstrlen(container.valuePrefix))).toUtf8());
+                }
+            }
+        }
+        return object;
+    }
+
+    static QString valueId(const FacetContainer& container, const QString& value)
+    {
+        return QLatin1String(container.valuePrefix) + QString::fromLatin1(QUrl::toPercentEncoding(value));
+    }
+};
+
+ContentDirectoryService::ContentDirectoryService(DatabaseManager* dbManager, const QString& friendlyName)
+    : m_dbManager(dbManager)
+    , m_friendlyName(friendlyName)
+    , m_pageCache(PAGE_CACHE_SIZE)
+{
+    // Derived from the machine, so clients keep recognising us after a restart
+    QByteArray machineId = QSysInfo::machineUniqueId();
+    if (machineId.isEmpty()) {
+        machineId = QSysInfo::machineHostName().toUtf8();
+    }
+    const QUuid uuidNamespace("{5b3cf9a4-6e0c-4d7e-9a52-3c1f0e8d2b71}");
+    m_udn = "uuid:" + QUuid::createUuidV5(uuidNamespace, machineId + "/MediaServer").toString(QUuid::WithoutBraces);
+}
+
+QByteArray ContentDirectoryService::deviceDescription(const QString& baseUrl) const
+{
+    return QString(R"(<?xml version="1.0" encoding="utf-8"?>
+<root xmlns="urn:schemas-upnp-org:device-1-0" xmlns:dlna="urn:schemas-dlna-org:device-1-0">
+<specVersion><major>1</major><minor>0</minor></specVersion>
+<URLBase>%1</URLBase>
+<device>
+<deviceType>%2</deviceType>
+<dlna:X_DLNADOC>DMS-1.50</dlna:X_DLNADOC>
+<friendlyName>%3</friendlyName>
+<manufacturer>EonPlay Team</manufacturer>
+<manufacturerURL>https://eonplay.com</manufacturerURL>
+<modelName>EonPlay</modelName>
+<modelNumber>1.0</modelNumber>
+<UDN>%4</UDN>
+<serviceList>
+<service><serviceType>%5</serviceType><serviceId>urn:upnp-org:serviceId:ContentDirectory</serviceId>
+<SCPDURL>/upnp/ContentDirectory.xml</SCPDURL><controlURL>/upnp/control/ContentDirectory</controlURL>
+<eventSubURL>/upnp/event/ContentDirectory</eventSubURL></service>
+<service><serviceType>%6</serviceType><serviceId>urn:upnp-org:serviceId:ConnectionManager</serviceId>
+<SCPDURL>/upnp/ConnectionManager.xml</SCPDURL><controlURL>/upnp/control/ConnectionManager</controlURL>
+<eventSubURL>/upnp/event/ConnectionManager</eventSubURL></service>
+</serviceList>
+</device>
+</root>
+)").arg(escaped(baseUrl), QLatin1String(DEVICE_TYPE), escaped(m_friendlyName), m_udn,
+        QLatin1String(CONTENT_DIRECTORY_TYPE), QLatin1String(CONNECTION_MANAGER_TYPE)).toUtf8();
+}
+
+QByteArray ContentDirectoryService::contentDirectoryDescription()
+{
+    return QByteArrayLiteral(R"(<?xml version="1.0" encoding="utf-8"?>
+<scpd xmlns="urn:schemas-upnp-org:service-1-0">
+<specVersion><major>1</major><minor>0</minor></specVersion>
+<actionList>
+<action><name>Browse</name><argumentList>
+<argument><name>ObjectID</name><direction>in</direction><relatedStateVariable>A_ARG_TYPE_ObjectID</relatedStateVariable></argument>
+<argument><name>BrowseFlag</name><direction>in</direction><relatedStateVariable>A_ARG_TYPE_BrowseFlag</relatedStateVariable></argument>
+<argument><name>Filter</name><direction>in</direction><relatedStateVariable>A_ARG_TYPE_Filter</relatedStateVariable></argument>
+<argument><name>StartingIndex</name><direction>in</direction><relatedStateVariable>A_ARG_TYPE_Index</relatedStateVariable></argument>
+<argument><name>RequestedCount</name><direction>in</direction><relatedStateVariable>A_ARG_TYPE_Count</relatedStateVariable></argument>
+<argument><name>SortCriteria</name><direction>in</direction><relatedStateVariable>A_ARG_TYPE_SortCriteria</relatedStateVariable></argument>
+<argument><name>Result</name><direction>out</direction><relatedStateVariable>A_ARG_TYPE_Result</relatedStateVariable></argument>
+<argument><name>NumberReturned</name><direction>out</direction><relatedStateVariable>A_ARG_TYPE_Count</relatedStateVariable></argument>
+<argument><name>TotalMatches</name><direction>out</direction><relatedStateVariable>A_ARG_TYPE_Count</relatedStateVariable></argument>
+<argument><name>UpdateID</name><direction>out</direction><relatedStateVariable>A_ARG_TYPE_UpdateID</relatedStateVariable></argument>
+</argumentList></action>
+<action><name>Search</name><argumentList>
+<argument><name>ContainerID</name><direction>in</direction><relatedStateVariable>A_ARG_TYPE_ObjectID</relatedStateVariable></argument>
+<argument><name>SearchCriteria</name><direction>in</direction><relatedStateVariable>A_ARG_TYPE_SearchCriteria</relatedStateVariable></argument>
+<argument><name>Filter</name><direction>in</direction><relatedStateVariable>A_ARG_TYPE_Filter</relatedStateVariable></argument>
+<argument><name>StartingIndex</name><direction>in</direction><relatedStateVariable>A_ARG_TYPE_Index</relatedStateVariable></argument>
+<argument><name>RequestedCount</name><direction>in</direction><relatedStateVariable>A_ARG_TYPE_Count</relatedStateVariable></argument>
+<argument><name>SortCriteria</name><direction>in</direction><relatedStateVariable>A_ARG_TYPE_SortCriteria</relatedStateVariable></argument>
+<argument><name>Result</name><direction>out</direction><relatedStateVariable>A_ARG_TYPE_Result</relatedStateVariable></argument>
+<argument><name>NumberReturned</name><direction>out</direction><relatedStateVariable>A_ARG_TYPE_Count</relatedStateVariable></argument>
+<argument><name>TotalMatches</name><direction>out</direction><relatedStateVariable>A_ARG_TYPE_Count</relatedStateVariable></argument>
+<argument><name>UpdateID</name><direction>out</direction><relatedStateVariable>A_ARG_TYPE_UpdateID</relatedStateVariable></argument>
+</argumentList></action>
+<action><name>GetSearchCapabilities</name><argumentList>
+<argument><name>SearchCaps</name><direction>out</direction><relatedStateVariable>SearchCapabilities</relatedStateVariable></argument>
+</argumentList></action>
+<action><name>GetSortCapabilities</name><argumentList>
+<argument><name>SortCaps</name><direction>out</direction><relatedStateVariable>SortCapabilities</relatedStateVariable></argument>
+</argumentList></action>
+<action><name>GetSystemUpdateID</name><argumentList>
+<argument><name>Id</name><direction>out</direction><relatedStateVariable>SystemUpdateID</relatedStateVariable></argument>
+</argumentList></action>
+</actionList>
+<serviceStateTable>
+<stateVariable sendEvents="no"><name>A_ARG_TYPE_ObjectID</name><dataType>string</dataType></stateVariable>
+<stateVariable sendEvents="no"><name>A_ARG_TYPE_BrowseFlag</name><dataType>string</dataType>
+<allowedValueList><allowedValue>BrowseMetadata</allowedValue><allowedValue>BrowseDirectChildren</allowedValue></allowedValueList></stateVariable>
+<stateVariable sendEvents="no"><name>A_ARG_TYPE_Filter</name><dataType>string</dataType></stateVariable>
+<stateVariable sendEvents="no"><name>A_ARG_TYPE_Index</name><dataType>ui4</dataType></stateVariable>
+<stateVariable sendEvents="no"><name>A_ARG_TYPE_Count</name><dataType>ui4</dataType></stateVariable>
+<stateVariable sendEvents="no"><name>A_ARG_TYPE_SortCriteria</name><dataType>string</dataType></stateVariable>
+<stateVariable sendEvents="no"><name>A_ARG_TYPE_SearchCriteria</name><dataType>string</dataType></stateVariable>
+<stateVariable sendEvents="no"><name>A_ARG_TYPE_Result</name><dataType>string</dataType></stateVariable>
+<stateVariable sendEvents="no"><name>A_ARG_TYPE_UpdateID</name><dataType>ui4</dataType></stateVariable>
+<stateVariable sendEvents="no"><name>SearchCapabilities</name><dataType>string</dataType></stateVariable>
+<stateVariable sendEvents="no"><name>SortCapabilities</name><dataType>string</dataType></stateVariable>
+<stateVariable sendEvents="yes"><name>SystemUpdateID</name><dataType>ui4</dataType></stateVariable>
+</serviceStateTable>
+</scpd>
+)");
+}
+
+QByteArray ContentDirectoryService::connectionManagerDescription()
+{
+    return QByteArrayLiteral(R"(<?xml version="1.0" encoding="utf-8"?>
+<scpd xmlns="urn:schemas-upnp-org:service-1-0">
+<specVersion><major>1</major><minor>0</minor></specVersion>
+<actionList>
+<action><name>GetProtocolInfo</name><argumentList>
+<argument><name>Source</name><direction>out</direction><relatedStateVariable>SourceProtocolInfo</relatedStateVariable></argument>
+<argument><name>Sink</name><direction>out</direction><relatedStateVariable>SinkProtocolInfo</relatedStateVariable></argument>
+</argumentList></action>
+<action><name>GetCurrentConnectionIDs</name><argumentList>
+<argument><name>ConnectionIDs</name><direction>out</direction><relatedStateVariable>CurrentConnectionIDs</relatedStateVariable></argument>
+</argumentList></action>
+</actionList>
+<serviceStateTable>
+<stateVariable sendEvents="yes"><name>SourceProtocolInfo</name><dataType>string</dataType></stateVariable>
+<stateVariable sendEvents="yes"><name>SinkProtocolInfo</name><dataType>string</dataType></stateVariable>
+<stateVariable sendEvents="yes"><name>CurrentConnectionIDs</name><dataType>string</dataType></stateVariable>
+</serviceStateTable>
+</scpd>
+)");
+}
+
+ContentDirectoryService::Response ContentDirectoryService::control(const QString& serviceType,
+                                                                   const QByteArray& soapAction,
+                                                                   const QByteArray& body, const QString& baseUrl)
+{
+    // SOAPACTION: "urn:schemas-upnp-org:service:ContentDirectory:1#Browse"
+    const QString header = QString::fromUtf8(soapAction).trimmed().remove(QLatin1Char('"'));
+    const qsizetype hash = header.indexOf(QLatin1Char('#'));
+    if (hash < 0 || header.left(hash) != serviceType) {
+        return soapFault(INVALID_ACTION, "Invalid Action");
+    }
+
+    const QString action = header.mid(hash + 1);
+    const QHash<QString, QString> arguments = parseArguments(body, action);
+
+    if (serviceType == QLatin1String(CONNECTION_MANAGER_TYPE)) {
+        if (action == QLatin1String("GetProtocolInfo")) {
+            QStringList protocols;
+            QMimeDatabase mimeDatabase;
+            for (const QString& extension : MediaFile::supportedExtensions()) {
+                const QString mimeType = mimeDatabase.mimeTypeForFile("file." + extension,
+                                                                      QMimeDatabase::MatchExtension).name();
+                const QString protocol = QString("http-get:*:%1:*").arg(mimeType);
+                if (!protocols.contains(protocol)) {
+                    protocols << protocol;
+                }
+            }
+            return {200, soapEnvelope(action, serviceType, {{"Source", protocols.join(',')}, {"Sink", QString()}})};
+        }
+        if (action == QLatin1String("GetCurrentConnectionIDs")) {
+            return {200, soapEnvelope(action, serviceType, {{"ConnectionIDs", "0"}})};
+        }
+        return soapFault(INVALID_ACTION, "Invalid Action");
+    }
+
+    if (action == QLatin1String("Browse")) {
+        return browse(arguments, baseUrl);
+    }
+    if (action == QLatin1String("Search")) {
+        return search(arguments, baseUrl);
+    }
+    if (action == QLatin1String("GetSearchCapabilities")) {
+        return {200, soapEnvelope(action, serviceType,
+                                  {{"SearchCaps", "dc:title,dc:creator,upnp:artist,upnp:album,upnp:genre,upnp:class"}})};
+    }
+    if (action == QLatin1String("GetSortCapabilities")) {
+        return {200, soapEnvelope(action, serviceType, {{"SortCaps", QString()}})};
+    }
+    if (action == QLatin1String("GetSystemUpdateID")) {
+        return {200, soapEnvelope(action, serviceType, {{"Id", QString::number(systemUpdateId())}})};
+    }
+
+    return soapFault(INVALID_ACTION, "Invalid Action");
+}
+
+QString ContentDirectoryService::mediaPath(int id) const
+{
+    const RowPage page = runPage(m_dbManager, "SELECT file_path FROM media_files WHERE id = ? LIMIT ? OFFSET ?",
+                                 {id}, QString(), {}, 0, 1);
+    return page.rows.isEmpty() ? QString() : page.rows.first().first().toString();
+}
+
+QString ContentDirectoryService::albumArtPath(int id) const
+{
+    const RowPage page = runPage(m_dbManager, "SELECT cover_art_path FROM media_files WHERE id = ? LIMIT ? OFFSET ?",
+                                 {id}, QString(), {}, 0, 1);
+    const QString coverArtPath = page.rows.isEmpty() ? QString() : page.rows.first().first().toString();
+    return coverArtPath.isEmpty() ? QString() : CoverArtStore::thumbnailPath(coverArtPath, ALBUM_ART_SIZE);
+}
+
+void ContentDirectoryService::notifyLibraryChanged()
+{
+    ++m_systemUpdateId;
+
+    QMutexLocker locker(&m_cacheMutex);
+    m_pageCache.clear();
+}
+
+ContentDirectoryService::Response ContentDirectoryService::browse(const QHash<QString, QString>& arguments,
+                                                                  const QString& baseUrl)
+{
+    const QString objectId = arguments.value("ObjectID");
+    const QString flag = arguments.value("BrowseFlag");
+    bool startValid = false;
+    bool countValid = false;
+    const int start = arguments.value("StartingIndex").toInt(&startValid);
+    int count = arguments.value("RequestedCount").toInt(&countValid);
+    if (!startValid || !countValid || start < 0 || count < 0 ||
+        (flag != QLatin1String("BrowseMetadata") && flag != QLatin1String("BrowseDirectChildren"))) {
+        return soapFault(INVALID_ARGS, "Invalid Args");
+    }
+
+    const ObjectRef object = ObjectRef::parse(objectId);
+    if (object.kind == ObjectRef::Invalid) {
+        return soapFault(NO_SUCH_OBJECT, "No such object");
+    }
+
+    // 0 asks for everything; clients page on through TotalMatches
+    if (count == 0 || count > MAX_REQUESTED_COUNT) {
+        count = MAX_REQUESTED_COUNT;
+    }
+
+    const QString key = QString("browse|%1|%2|%3|%4|%5|%6")
+        .arg(QString::number(systemUpdateId()), baseUrl, objectId, flag, QString::number(start), QString::number(count));
+    const Page page = cachedPage(key, [&]() {
+        return flag == QLatin1String("BrowseMetadata") ? browseMetadata(object, objectId, baseUrl)
+                                                       : browseChildren(object, objectId, start, count, baseUrl);
+    });
+
+    return pageResponse("Browse", page);
+}
+
+ContentDirectoryService::Response ContentDirectoryService::search(const QHash<QString, QString>& arguments,
+                                                                  const QString& baseUrl)
+{
+    bool startValid = false;
+    bool countValid = false;
+    const int start = arguments.value("StartingIndex").toInt(&startValid);
+    int count = arguments.value("RequestedCount").toInt(&countValid);
+    if (!startValid || !countValid || start < 0 || count < 0) {
+        return soapFault(INVALID_ARGS, "Invalid Args");
+    }
+    if (count == 0 || count > MAX_REQUESTED_COUNT) {
+        count = MAX_REQUESTED_COUNT;
+    }
+
+    // Property "contains" and "=" terms narrow the result; class
+    // restrictions only decide whether tracks are wanted at all. The whole
+    // library is searched whatever the ContainerID.
+    static const QRegularExpression termPattern(
+        R"((dc:title|dc:creator|upnp:artist|upnp:album|upnp:genre)\s+(?:contains|=)\s+"((?:[^"\\]|\\.)*)")");
+    const QString criteria = arguments.value("SearchCriteria").trimmed();
+
+    QStringList words;
+    QStringList genres;
+    QRegularExpressionMatchIterator terms = termPattern.globalMatch(criteria);
+    while (terms.hasNext()) {
+        const QRegularExpressionMatch term = terms.next();
+        QString value = term.captured(2);
+        value.replace(QLatin1String("\\\""), QLatin1String("\"")).replace(QLatin1String("\\\\"), QLatin1String("\\"));
+        if (term.captured(1) == QLatin1String("upnp:genre")) {
+            genres << value;
+        } else {
+            words << value;
+        }
+    }
+
+    const bool wantsTracks = criteria == QLatin1String("*") || !words.isEmpty() || !genres.isEmpty() ||
+                             criteria.contains(QLatin1String("object.item"));
+    if (!wantsTracks && !criteria.contains(QLatin1String("object.container"))) {
+        return soapFault(INVALID_SEARCH_CRITERIA, "Unsupported or invalid search criteria");
+    }
+
+    const QString key = QString("search|%1|%2|%3|%4|%5")
+        .arg(QString::number(systemUpdateId()), baseUrl, wantsTracks ? criteria : QString(), QString::number(start),
+             QString::number(count));
+    const Page page = cachedPage(key, [&]() {
+        if (!wantsTracks) {
+            // Only containers were asked for; they are reached by browsing
+            Page empty;
+            empty.result = didlDocument(QString());
+            return empty;
+        }
+        return searchTracks(words, genres, start, count, baseUrl);
+    });
+
+    return pageResponse("Search", page);
+}
+
+ContentDirectoryService::Response ContentDirectoryService::pageResponse(const char* action, const Page& page) const
+{
+    if (page.error != 0) {
+        return soapFault(page.error, errorDescription(page.error));
+    }
+
+    return {200, soapEnvelope(QLatin1String(action), QLatin1String(CONTENT_DIRECTORY_TYPE), {
+        {"Result", QString::fromUtf8(page.result)},
+        {"NumberReturned", QString::number(page.returned)},
+        {"TotalMatches", QString::number(page.total)},
+        {"UpdateID", QString::number(systemUpdateId())}
+    })};
+}
+
+template <typename Builder>
+ContentDirectoryService::Page ContentDirectoryService::cachedPage(const QString& key, Builder&& build)
+{
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (const Page* page = m_pageCache.object(key)) {
+            return *page;
+        }
+    }
+
+    const Page page = build();
+    if (page.error == 0) {
+        QMutexLocker locker(&m_cacheMutex);
+        m_pageCache.insert(key, new Page(page));
+    }
+    return page;
+}
+
+ContentDirectoryService::Page ContentDirectoryService::browseMetadata(const ObjectRef& object, const QString& objectId,
+                                                                      const QString& baseUrl) const
+{
+    Page page;
+    page.returned = 1;
+    page.total = 1;
+
+    switch (object.kind) {
+    case ObjectRef::Root:
+        page.result = didlDocument(didlContainer("0", "-1", m_friendlyName, "object.container.storageFolder",
+                                                 int(std::size(FACET_CONTAINERS)) + 1));
+        return page;
+
+    case ObjectRef::FacetList:
+    case ObjectRef::FacetValue:
+    case ObjectRef::Tracks: {
+        const bool value = object.kind == ObjectRef::FacetValue;
+        const QString facet = DatabaseManager::facetName(object.facet ? object.facet->facet : DatabaseManager::LibraryFacet);
+        const RowPage counts = object.kind == ObjectRef::FacetList
+            ? runPage(m_dbManager, facetCountSql() + " LIMIT ? OFFSET ?", {facet}, QString(), {}, 0, 1)
+            : object.kind == ObjectRef::Tracks
+            ? runPage(m_dbManager, valueCountSql() + " LIMIT ? OFFSET ?", {facet, QString("")}, QString(), {}, 0, 1)
+            : runPage(m_dbManager, valueCountSql() + " LIMIT ? OFFSET ?", {facet, object.value}, QString(), {}, 0, 1);
+        if (!counts.ok) {
+            page.error = CANNOT_PROCESS;
+            return page;
+        }
+        if (counts.rows.isEmpty() && value) {
+            page.error = NO_SUCH_OBJECT;
+            return page;
+        }
+
+        const int childCount = counts.rows.isEmpty() ? 0 : counts.rows.first().first().toInt();
+        if (object.kind == ObjectRef::Tracks) {
+            page.result = didlDocument(didlContainer(objectId, "0", "All Tracks", "object.container.storageFolder",
+                                                     childCount));
+        } else if (value) {
+            page.result = didlDocument(didlContainer(objectId, QLatin1String(object.facet->listId), object.value,
+                                                     object.facet->valueClass, childCount));
+        } else {
+            page.result = didlDocument(didlContainer(objectId, "0", QLatin1String(object.facet->title),
+                                                     "object.container.storageFolder", childCount));
+        }
+        return page;
+    }
+
+    case ObjectRef::Item: {
+        const RowPage items = runPage(m_dbManager,
+            QString("SELECT %1 FROM media_files m WHERE m.id = ? LIMIT ? OFFSET ?").arg(QLatin1String(ITEM_COLUMNS)),
+            {object.itemId}, QString(), {}, 0, 1);
+        if (!items.ok || items.rows.isEmpty()) {
+            page.error = items.ok ? NO_SUCH_OBJECT : CANNOT_PROCESS;
+            return page;
+        }
+        page.result = didlDocument(didlItem(items.rows.first(), QLatin1String(TRACKS_ID), baseUrl));
+        return page;
+    }
+
+    case ObjectRef::Invalid:
+        break;
+    }
+
+    page.error = NO_SUCH_OBJECT;
+    return page;
+}
+
+ContentDirectoryService::Page ContentDirectoryService::browseChildren(const ObjectRef& object, const QString& objectId,
+                                                                      int start, int count, const QString& baseUrl) const
+{
+    Page page;
+    QString content;
+
+    switch (object.kind) {
+    case ObjectRef::Root: {
+        // Child counts of every top container in one pass over the aggregates
+        const RowPage counts = runPage(m_dbManager,
+            "SELECT facet, COUNT(*), SUM(file_count) FROM library_aggregates WHERE file_count > 0 "
+            "GROUP BY facet LIMIT ? OFFSET ?", {}, QString(), {}, 0, -1);
+        if (!counts.ok) {
+            page.error = CANNOT_PROCESS;
+            return page;
+        }
+
+        QHash<QString, QVariantList> countsByFacet;
+        for (const QVariantList& row : counts.rows) {
+            countsByFacet.insert(row[0].toString(), row);
+        }
+
+        QStringList containers;
+        for (const FacetContainer& container : FACET_CONTAINERS) {
+            containers << didlContainer(QLatin1String(container.listId), "0", QLatin1String(container.title),
+                                        "object.container.storageFolder",
+                                        countsByFacet.value(DatabaseManager::facetName(container.facet)).value(1).toInt());
+        }
+        containers << didlContainer(QLatin1String(TRACKS_ID), "0", "All Tracks", "object.container.storageFolder",
+                                    countsByFacet.value(DatabaseManager::facetName(DatabaseManager::LibraryFacet))
+                                        .value(2).toInt());
+
+        const QStringList slice = containers.mid(start, count);
+        page.result = didlDocument(slice.join(QString()));
+        page.returned = slice.size();
+        page.total = containers.size();
+        return page;
+    }
+
+    case ObjectRef::FacetList: {
+        // Values and their track counts, straight from the aggregates' primary key
+        const QString facet = DatabaseManager::facetName(object.facet->facet);
+        const RowPage values = runPage(m_dbManager,
+            "SELECT value, file_count FROM library_aggregates WHERE facet = ? AND file_count > 0 "
+            "ORDER BY value LIMIT ? OFFSET ?", {facet}, facetCountSql(), {facet}, start, count);
+        if (!values.ok) {
+            page.error = CANNOT_PROCESS;
+            return page;
+        }
+
+        for (const QVariantList& row : values.rows) {
+            const QString value = row[0].toString();
+            content += didlContainer(ObjectRef::valueId(*object.facet, value), objectId, value,
+                                     object.facet->valueClass, row[1].toInt());
+        }
+        page.returned = values.rows.size();
+        page.total = values.total;
+        break;
+    }
+
+    case ObjectRef::FacetValue:
+    case ObjectRef::Tracks: {
+        // Totals come from the aggregates; the rows walk the matching browse index
+        RowPage tracks;
+        if (object.kind == ObjectRef::Tracks) {
+            tracks = runPage(m_dbManager,
+                QString("SELECT %1 FROM media_files m ORDER BY m.title, m.id LIMIT ? OFFSET ?")
+                    .arg(QLatin1String(ITEM_COLUMNS)), {},
+                valueCountSql(), {DatabaseManager::facetName(DatabaseManager::LibraryFacet), QString("")},
+                start, count);
+        } else {
+            const QString column = DatabaseManager::facetName(object.facet->facet);
+            tracks = runPage(m_dbManager,
+                QString("SELECT %1 FROM media_files m WHERE m.%2 = ? ORDER BY %3 LIMIT ? OFFSET ?")
+                    .arg(QLatin1String(ITEM_COLUMNS), column, QLatin1String(object.facet->trackOrder)),
+                {object.value}, valueCountSql(), {column, object.value}, start, count);
+        }
+        if (!tracks.ok) {
+            page.error = CANNOT_PROCESS;
+            return page;
+        }
+
+        for (const QVariantList& row : tracks.rows) {
+            content += didlItem(row, objectId, baseUrl);
+        }
+        page.returned = tracks.rows.size();
+        page.total = tracks.total;
+        break;
+    }
+
+    case ObjectRef::Item:
+        page.error = NO_SUCH_CONTAINER;
+        return page;
+
+    case ObjectRef::Invalid:
+        page.error = NO_SUCH_OBJECT;
+        return page;
+    }
+
+    page.result = didlDocument(content);
+    return page;
+}
+
+ContentDirectoryService::Page ContentDirectoryService::searchTracks(const QStringList& words, const QStringList& genres,
+                                                                    int start, int count, const QString& baseUrl) const
+{
+    Page page;
+    QString from = "media_files m";
+    QString order = "m.title, m.id";
+    QStringList conditions;
+    QVariantList bindValues;
+
+    const QString match = DatabaseManager::buildSearchMatch(words.join(QLatin1Char(' ')));
+    if (!match.isEmpty()) {
+        if (m_dbManager->isSearchIndexAvailable()) {
+            // Ranked like the library's own search
+            from = "media_search JOIN media_files m ON m.id = media_search.rowid";
+            order = "bm25(media_search, 10.0, 8.0, 4.0, 1.0), m.id";
+            conditions << "media_search MATCH ?";
+            bindValues << match;
+        } else {
+            for (const QString& word : words) {
+                const QString pattern = QString("%%1%").arg(word);
+                conditions << "(m.title LIKE ? OR m.artist LIKE ? OR m.album LIKE ?)";
+                bindValues << pattern << pattern << pattern;
+            }
+        }
+    }
+
+    // Genres are not in the full-text index
+    for (const QString& genre : genres) {
+        conditions << "m.genre LIKE ?";
+        bindValues << QString("%%1%").arg(genre);
+    }
+
+    const QString where = conditions.isEmpty() ? QString() : " WHERE " + conditions.join(" AND ");
+    const RowPage tracks = runPage(m_dbManager,
+        QString("SELECT %1 FROM %2%3 ORDER BY %4 LIMIT ? OFFSET ?").arg(QLatin1String(ITEM_COLUMNS), from, where, order),
+        bindValues, QString("SELECT COUNT(*) FROM %1%2").arg(from, where), bindValues, start, count);
+    if (!tracks.ok) {
+        page.error = CANNOT_PROCESS;
+        return page;
+    }
+
+    QString content;
+    for (const QVariantList& row : tracks.rows) {
+        content += didlItem(row, QLatin1String(TRACKS_ID), baseUrl);
+    }
+    page.result = didlDocument(content);
+    page.returned = tracks.rows.size();
+    page.total = tracks.total;
+    return page;
+}
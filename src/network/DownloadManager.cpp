@@ -0,0 +1,842 @@
+#include "network/DownloadManager.h"
+#include "network/NetworkService.h"
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(downloadManager, "eonplay.network.downloads")
+
+namespace {
+
+const QString INDEX_FILE = QStringLiteral("downloads.json");
+constexpr qint64 READ_CHUNK_BYTES = 64 * 1024;
+
+int statusOf(QNetworkReply* reply)
+{
+    return reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+}
+
+} // namespace
+
+DownloadManager::DownloadManager(const QString& stateDirectory, QObject* parent)
+    : QObject(parent)
+    , m_stateDirectory(stateDirectory)
+    , m_maxConcurrent(DEFAULT_MAX_CONCURRENT)
+    , m_connectionsPerDownload(DEFAULT_CONNECTIONS)
+    , m_throttleTimer(new QTimer(this))
+{
+    QDir().mkpath(m_stateDirectory);
+
+    m_throttleTimer->setInterval(THROTTLE_INTERVAL_MS);
+    connect(m_throttleTimer, &QTimer::timeout, this, &DownloadManager::onThrottleTick);
+
+    loadIndex();
+}
+
+DownloadManager::~DownloadManager()
+{
+    // Running downloads come back paused next time
+    for (auto& entry : m_downloads) {
+        Download& download = *entry.second;
+        if (download.state == State::Running) {
+            stopParts(download);
+            saveDownloadState(download);
+        }
+    }
+    saveIndex();
+}
+
+QString DownloadManager::defaultDirectory()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath("downloads");
+}
+
+QString DownloadManager::addDownload(const QUrl& url, const QString& filePath, const QString& id)
+{
+    const QString key = id.isEmpty() ? url.toString() : id;
+    if (m_downloads.count(key)) {
+        resume(key);
+        return key;
+    }
+
+    auto download = std::make_unique<Download>();
+    download->id = key;
+    download->url = url;
+    download->filePath = filePath;
+    loadDownloadState(*download);
+
+    m_downloads.emplace(key, std::move(download));
+    m_order.append(key);
+    saveIndex();
+
+    qCDebug(downloadManager) << "Download queued:" << url.toString() << "->" << filePath;
+    schedule();
+    return key;
+}
+
+void DownloadManager::pause(const QString& id)
+{
+    auto it = m_downloads.find(id);
+    if (it == m_downloads.end()) {
+        return;
+    }
+
+    Download& download = *it->second;
+    if (download.state != State::Running && download.state != State::Queued) {
+        return;
+    }
+
+    stopParts(download);
+    saveDownloadState(download);
+    download.file.reset();
+    download.state = State::Paused;
+    reportProgress(download, true);
+
+    schedule();
+}
+
+void DownloadManager::resume(const QString& id)
+{
+    auto it = m_downloads.find(id);
+    if (it == m_downloads.end()) {
+        return;
+    }
+
+    Download& download = *it->second;
+    if (download.state == State::Paused || download.state == State::Failed) {
+        download.failures = 0;
+        download.state = State::Queued;
+        schedule();
+    }
+}
+
+void DownloadManager::cancel(const QString& id)
+{
+    auto it = m_downloads.find(id);
+    if (it == m_downloads.end()) {
+        return;
+    }
+
+    Download& download = *it->second;
+    stopParts(download);
+    download.file.reset();
+    if (download.state != State::Finished) {
+        QFile::remove(partialPath(download));
+        QFile::remove(statePath(download));
+    }
+
+    m_downloads.erase(it);
+    m_order.removeAll(id);
+    saveIndex();
+    schedule();
+}
+
+QStringList DownloadManager::downloads() const
+{
+    return m_order;
+}
+
+DownloadManager::State DownloadManager::state(const QString& id) const
+{
+    auto it = m_downloads.find(id);
+    return it == m_downloads.end() ? State::Failed : it->second->state;
+}
+
+qint64 DownloadManager::bytesReceived(const QString& id) const
+{
+    auto it = m_downloads.find(id);
+    return it == m_downloads.end() ? 0 : received(*it->second);
+}
+
+qint64 DownloadManager::bytesTotal(const QString& id) const
+{
+    auto it = m_downloads.find(id);
+    return it == m_downloads.end() ? -1 : it->second->total;
+}
+
+int DownloadManager::activeDownloadCount() const
+{
+    return static_cast<int>(std::count_if(m_downloads.begin(), m_downloads.end(), [](const auto& entry) {
+        return entry.second->state == State::Running;
+    }));
+}
+
+void DownloadManager::setMaxConcurrentDownloads(int downloads)
+{
+    m_maxConcurrent = std::max(1, downloads);
+    schedule();
+}
+
+void DownloadManager::setConnectionsPerDownload(int connections)
+{
+    m_connectionsPerDownload = std::max(1, connections);
+}
+
+void DownloadManager::setBandwidthLimit(qint64 bytesPerSecond)
+{
+    m_bandwidthLimit = std::max<qint64>(0, bytesPerSecond);
+
+    for (auto it = m_replies.constBegin(); it != m_replies.constEnd(); ++it) {
+        it.key()->setReadBufferSize(m_bandwidthLimit > 0 ? READ_BUFFER_BYTES : 0);
+    }
+
+    // Lifting the cap: take what the buffers hold right away
+    if (m_bandwidthLimit == 0) {
+        for (auto& entry : m_downloads) {
+            Download& download = *entry.second;
+            for (Part& part : download.parts) {
+                if (download.state == State::Running && part.reply) {
+                    drain(download, part, -1);
+                }
+            }
+        }
+    }
+
+    updateThrottle();
+}
+
+void DownloadManager::setUserAgent(const QString& userAgent)
+{
+    m_userAgent = userAgent.toUtf8();
+}
+
+DownloadManager::Download* DownloadManager::downloadFor(QNetworkReply* reply, Part** part)
+{
+    auto it = m_downloads.find(m_replies.value(reply));
+    if (!reply || it == m_downloads.end()) {
+        return nullptr;
+    }
+
+    for (Part& candidate : it->second->parts) {
+        if (candidate.reply == reply) {
+            *part = &candidate;
+            return it->second.get();
+        }
+    }
+    return nullptr;
+}
+
+void DownloadManager::schedule()
+{
+    int running = activeDownloadCount();
+
+    const QStringList order = m_order;
+    for (const QString& id : order) {
+        if (running >= m_maxConcurrent) {
+            break;
+        }
+
+        auto it = m_downloads.find(id);
+        if (it != m_downloads.end() && it->second->state == State::Queued) {
+            start(*it->second);
+            if (it->second->state == State::Running) {
+                ++running;
+            }
+        }
+    }
+
+    updateThrottle();
+}
+
+void DownloadManager::start(Download& download)
+{
+    download.file = std::make_unique<QFile>(partialPath(download));
+    if (!download.file->open(QIODevice::ReadWrite)) {
+        fail(download, download.file->errorString());
+        return;
+    }
+
+    // Recorded progress the partial file cannot back up: start over
+    qint64 recorded = 0;
+    for (const Part& part : download.parts) {
+        recorded = std::max(recorded, part.start + part.written);
+    }
+    if (download.file->size() < recorded) {
+        qCWarning(downloadManager) << "Partial file lost, restarting" << download.url.toString();
+        download.parts.clear();
+        download.total = -1;
+        download.validator.clear();
+    }
+
+    if (download.total > 0 && download.file->size() != download.total) {
+        download.file->resize(download.total);
+    }
+
+    if (download.parts.empty()) {
+        Part probe;
+        probe.probe = true;
+        download.parts.push_back(probe);
+    }
+
+    download.state = State::Running;
+    download.lastProgress.start();
+    download.lastSave.start();
+    checkFinished(download);
+}
+
+void DownloadManager::requestPart(Download& download, Part& part)
+{
+    QNetworkRequest request(download.url);
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+    request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    // Byte ranges must address the stored file, not a compressed encoding of it
+    request.setRawHeader("Accept-Encoding", "identity");
+    // Ranges in one pipeline would arrive one after the other
+    request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, false);
+    if (!m_userAgent.isEmpty()) {
+        request.setRawHeader("User-Agent", m_userAgent);
+    }
+
+    const qint64 from = part.start + part.written;
+    QByteArray range = "bytes=" + QByteArray::number(from) + '-';
+    if (part.end >= 0) {
+        range += QByteArray::number(part.end);
+    }
+    request.setRawHeader("Range", range);
+    if (from > 0 && !download.validator.isEmpty()) {
+        request.setRawHeader("If-Range", download.validator);
+    }
+
+    QNetworkReply* reply = NetworkService::instance().get(request, NetworkService::RequestClass::Metadata);
+    if (m_bandwidthLimit > 0) {
+        reply->setReadBufferSize(READ_BUFFER_BYTES);
+    }
+    connect(reply, &QNetworkReply::metaDataChanged, this, &DownloadManager::onMetaDataChanged);
+    connect(reply, &QIODevice::readyRead, this, &DownloadManager::onReadyRead);
+    connect(reply, &QNetworkReply::finished, this, &DownloadManager::onPartFinished);
+
+    part.reply = reply;
+    m_replies.insert(reply, download.id);
+}
+
+void DownloadManager::stopParts(Download& download)
+{
+    for (Part& part : download.parts) {
+        if (part.reply) {
+            m_replies.remove(part.reply);
+            part.reply->disconnect(this);
+            part.reply->abort();
+            part.reply->deleteLater();
+            part.reply = nullptr;
+        }
+    }
+
+    if (download.file) {
+        download.file->flush();
+    }
+}
+
+void DownloadManager::restart(Download& download, QNetworkReply* reply, qint64 total)
+{
+    for (Part& part : download.parts) {
+        if (part.reply && part.reply != reply) {
+            m_replies.remove(part.reply);
+            part.reply->disconnect(this);
+            part.reply->abort();
+            part.reply->deleteLater();
+        }
+    }
+
+    Part whole;
+    whole.end = total > 0 ? total - 1 : -1;
+    whole.reply = reply;
+    download.parts.clear();
+    download.parts.push_back(whole);
+
+    download.total = total;
+    download.validator = validatorOf(reply);
+    download.file->resize(total > 0 ? total : 0);
+}
+
+void DownloadManager::fillConnections(Download& download)
+{
+    int active = static_cast<int>(std::count_if(download.parts.begin(), download.parts.end(), [](const Part& part) {
+        return part.reply != nullptr;
+    }));
+
+    // Ranges left over from before a pause or restart come first
+    for (Part& part : download.parts) {
+        if (active >= m_connectionsPerDownload) {
+            return;
+        }
+        if (!part.reply && !part.isComplete()) {
+            requestPart(download, part);
+            ++active;
+        }
+    }
+
+    while (active < m_connectionsPerDownload && split(download)) {
+        ++active;
+    }
+}
+
+bool DownloadManager::split(Download& download)
+{
+    Part* largest = nullptr;
+    for (Part& part : download.parts) {
+        if (part.reply && part.end >= 0 && (!largest || part.remaining() > largest->remaining())) {
+            largest = &part;
+        }
+    }
+
+    if (!largest || largest->remaining() < 2 * MIN_PART_BYTES) {
+        return false;
+    }
+
+    // The running reply keeps going and is cut off at its new end
+    Part tail;
+    tail.start = largest->start + largest->written + largest->remaining() / 2;
+    tail.end = largest->end;
+    largest->end = tail.start - 1;
+
+    download.parts.push_back(tail);
+    requestPart(download, download.parts.back());
+    return true;
+}
+
+void DownloadManager::onMetaDataChanged()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    Part* part = nullptr;
+    Download* download = downloadFor(reply, &part);
+    if (!download) {
+        return;
+    }
+
+    const int status = statusOf(reply);
+    if (status == 200) {
+        // No range support, or If-Range found the file changed
+        const QVariant length = reply->header(QNetworkRequest::ContentLengthHeader);
+        restart(*download, reply, length.isValid() ? length.toLongLong() : -1);
+        return;
+    }
+
+    if (status != 206) {
+        return;
+    }
+
+    if (download->validator.isEmpty()) {
+        download->validator = validatorOf(reply);
+    }
+
+    // Content-Range: bytes 0-1023/146515, the total may be *
+    if (download->total < 0) {
+        const QByteArray contentRange = reply->rawHeader("Content-Range");
+        bool ok = false;
+        const qint64 total = contentRange.mid(contentRange.lastIndexOf('/') + 1).toLongLong(&ok);
+        if (ok && total > 0) {
+            download->total = total;
+            download->file->resize(total);
+        }
+    }
+
+    if (part->probe) {
+        part->probe = false;
+        if (download->total > 0) {
+            part->end = download->total - 1;
+            fillConnections(*download);
+        }
+    }
+}
+
+void DownloadManager::onReadyRead()
+{
+    // Throttled replies are drained by the timer
+    if (m_bandwidthLimit > 0) {
+        return;
+    }
+
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    Part* part = nullptr;
+    if (Download* download = downloadFor(reply, &part)) {
+        drain(*download, *part, -1);
+    }
+}
+
+qint64 DownloadManager::drain(Download& download, Part& part, qint64 budget)
+{
+    QNetworkReply* reply = part.reply;
+    const int status = statusOf(reply);
+    if (status != 200 && status != 206) {
+        // Error page; the reply fails on its own
+        reply->readAll();
+        return 0;
+    }
+
+    qint64 taken = 0;
+    while (reply->bytesAvailable() > 0 && (budget < 0 || taken < budget)) {
+        qint64 wanted = std::min(reply->bytesAvailable(), READ_CHUNK_BYTES);
+        if (budget >= 0) {
+            wanted = std::min(wanted, budget - taken);
+        }
+
+        const QByteArray chunk = reply->read(wanted);
+        if (chunk.isEmpty()) {
+            break;
+        }
+        taken += chunk.size();
+
+        // Past the end of a range that was split off
+        qint64 useful = chunk.size();
+        if (part.end >= 0) {
+            useful = std::min(useful, part.remaining());
+        }
+
+        if (useful > 0) {
+            const qint64 offset = part.start + part.written;
+            download.file->seek(offset);
+            if (download.file->write(chunk.constData(), useful) != useful) {
+                fail(download, download.file->errorString());
+                return taken;
+            }
+            part.written += useful;
+            emit dataWritten(download.id, offset, useful == chunk.size() ? chunk : chunk.left(useful));
+        }
+
+        if (part.isComplete()) {
+            completePart(download, part);
+            break;
+        }
+    }
+
+    if (download.state == State::Running) {
+        if (download.lastSave.elapsed() >= SAVE_INTERVAL_MS) {
+            saveDownloadState(download);
+        }
+        reportProgress(download, false);
+    }
+    return taken;
+}
+
+void DownloadManager::completePart(Download& download, Part& part)
+{
+    download.failures = 0;
+    if (part.reply) {
+        m_replies.remove(part.reply);
+        part.reply->disconnect(this);
+        part.reply->abort();
+        part.reply->deleteLater();
+        part.reply = nullptr;
+    }
+
+    checkFinished(download);
+}
+
+void DownloadManager::onPartFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    Part* part = nullptr;
+    Download* download = downloadFor(reply, &part);
+    if (!download) {
+        return;
+    }
+
+    const int status = statusOf(reply);
+    if (reply->error() == QNetworkReply::NoError && (status == 200 || status == 206)) {
+        drain(*download, *part, -1);
+        if (part->reply != reply) {
+            // Completed or failed while draining
+            return;
+        }
+
+        m_replies.remove(reply);
+        reply->deleteLater();
+        part->reply = nullptr;
+
+        if (part->end < 0) {
+            // Length unknown until the body ended
+            part->end = part->start + part->written - 1;
+            download->total = part->end + 1;
+        }
+
+        if (part->isComplete()) {
+            download->failures = 0;
+            checkFinished(*download);
+            return;
+        }
+    } else {
+        m_replies.remove(reply);
+        reply->deleteLater();
+        part->reply = nullptr;
+    }
+
+    const QString error = reply->error() != QNetworkReply::NoError ? reply->errorString()
+                                                                   : tr("Transfer ended early (HTTP %1)").arg(status);
+    if (++download->failures > MAX_RETRIES) {
+        fail(*download, error);
+        return;
+    }
+
+    qCWarning(downloadManager) << "Range failed, retrying:" << download->url.toString() << error;
+    saveDownloadState(*download);
+
+    const QString id = download->id;
+    QTimer::singleShot(RETRY_DELAY_MS * download->failures, this, [this, id]() {
+        auto it = m_downloads.find(id);
+        if (it != m_downloads.end() && it->second->state == State::Running) {
+            fillConnections(*it->second);
+        }
+    });
+}
+
+void DownloadManager::checkFinished(Download& download)
+{
+    if (download.state != State::Running) {
+        return;
+    }
+
+    const bool complete = download.total >= 0 &&
+                          std::all_of(download.parts.begin(), download.parts.end(), [](const Part& part) {
+                              return part.isComplete();
+                          });
+    if (!complete) {
+        fillConnections(download);
+        return;
+    }
+
+    download.file->close();
+    download.file.reset();
+
+    QFile::remove(download.filePath);
+    if (!QFile::rename(partialPath(download), download.filePath)) {
+        fail(download, tr("Cannot move the download to %1").arg(download.filePath));
+        return;
+    }
+    QFile::remove(statePath(download));
+
+    download.state = State::Finished;
+    reportProgress(download, true);
+    saveIndex();
+
+    qCDebug(downloadManager) << "Download finished:" << download.filePath << download.total << "bytes in"
+                             << download.parts.size() << "ranges";
+    emit downloadFinished(download.id, download.filePath);
+
+    schedule();
+}
+
+void DownloadManager::fail(Download& download, const QString& error)
+{
+    stopParts(download);
+    saveDownloadState(download);
+    download.file.reset();
+    download.state = State::Failed;
+
+    qCWarning(downloadManager) << "Download failed:" << download.url.toString() << error;
+    emit downloadFailed(download.id, error);
+
+    schedule();
+}
+
+void DownloadManager::reportProgress(Download& download, bool force)
+{
+    if (!force && download.lastProgress.isValid() && download.lastProgress.elapsed() < PROGRESS_INTERVAL_MS) {
+        return;
+    }
+
+    download.lastProgress.start();
+    emit downloadProgress(download.id, received(download), download.total);
+}
+
+qint64 DownloadManager::received(const Download& download)
+{
+    qint64 bytes = 0;
+    for (const Part& part : download.parts) {
+        bytes += part.written;
+    }
+    return bytes;
+}
+
+QByteArray DownloadManager::validatorOf(QNetworkReply* reply)
+{
+    // If-Range needs a strong ETag; a date also works
+    const QByteArray etag = reply->rawHeader("ETag");
+    if (!etag.isEmpty() && !etag.startsWith("W/")) {
+        return etag;
+    }
+    return reply->rawHeader("Last-Modified");
+}
+
+void DownloadManager::onThrottleTick()
+{
+    // Late ticks must not turn into a burst
+    const qint64 elapsed = std::min<qint64>(m_throttleClock.restart(), 4 * THROTTLE_INTERVAL_MS);
+    qint64 budget = m_bandwidthLimit * elapsed / 1000;
+
+    QList<QPair<Download*, Part*>> waiting;
+    for (auto& entry : m_downloads) {
+        Download& download = *entry.second;
+        if (download.state != State::Running) {
+            continue;
+        }
+        for (Part& part : download.parts) {
+            if (part.reply && part.reply->bytesAvailable() > 0) {
+                waiting.append(qMakePair(&download, &part));
+            }
+        }
+    }
+
+    // Share the budget evenly; what a part cannot use goes to the others
+    while (budget > 0 && !waiting.isEmpty()) {
+        const qint64 share = std::max<qint64>(1, budget / waiting.size());
+        for (int i = 0; i < waiting.size() && budget > 0;) {
+            Download* download = waiting.at(i).first;
+            Part* part = waiting.at(i).second;
+            if (download->state != State::Running || !part->reply) {
+                waiting.removeAt(i);
+                continue;
+            }
+
+            const qint64 taken = drain(*download, *part, std::min(share, budget));
+            budget -= taken;
+            if (taken < share || !part->reply || part->reply->bytesAvailable() == 0) {
+                waiting.removeAt(i);
+            } else {
+                ++i;
+            }
+        }
+    }
+}
+
+void DownloadManager::updateThrottle()
+{
+    if (m_bandwidthLimit > 0 && activeDownloadCount() > 0) {
+        if (!m_throttleTimer->isActive()) {
+            m_throttleClock.start();
+            m_throttleTimer->start();
+        }
+    } else {
+        m_throttleTimer->stop();
+    }
+}
+
+QString DownloadManager::partialPath(const Download& download)
+{
+    return download.filePath + ".download";
+}
+
+QString DownloadManager::statePath(const Download& download)
+{
+    return download.filePath + ".download.json";
+}
+
+void DownloadManager::saveDownloadState(Download& download)
+{
+    // Data first, so the recorded progress never runs ahead of the file
+    if (download.file) {
+        download.file->flush();
+    }
+    if (download.lastSave.isValid()) {
+        download.lastSave.restart();
+    }
+
+    QJsonArray parts;
+    for (const Part& part : download.parts) {
+        QJsonObject json;
+        json["start"] = part.start;
+        json["end"] = part.end;
+        json["written"] = part.written;
+        parts.append(json);
+    }
+
+    QJsonObject root;
+    root["url"] = download.url.toString();
+    root["total"] = download.total;
+    root["validator"] = QString::fromLatin1(download.validator);
+    root["parts"] = parts;
+
+    QSaveFile file(statePath(download));
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0 ||
+        !file.commit()) {
+        qCWarning(downloadManager) << "Failed to save download state:" << file.errorString();
+    }
+}
+
+void DownloadManager::loadDownloadState(Download& download)
+{
+    QFile file(statePath(download));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (QUrl(root["url"].toString()) != download.url) {
+        return;
+    }
+
+    download.total = root["total"].toInteger(-1);
+    download.validator = root["validator"].toString().toLatin1();
+    download.parts.clear();
+
+    const QJsonArray parts = root["parts"].toArray();
+    for (const QJsonValue& value : parts) {
+        const QJsonObject json = value.toObject();
+        Part part;
+        part.start = json["start"].toInteger();
+        part.end = json["end"].toInteger(-1);
+        part.written = json["written"].toInteger();
+        // A probe that never learnt the size is requested again from where it stopped
+        part.probe = part.end < 0;
+        download.parts.push_back(part);
+    }
+}
+
+void DownloadManager::saveIndex() const
+{
+    QJsonArray downloads;
+    for (const QString& id : m_order) {
+        const Download& download = *m_downloads.at(id);
+        if (download.state == State::Finished) {
+            continue;
+        }
+
+        QJsonObject json;
+        json["id"] = download.id;
+        json["url"] = download.url.toString();
+        json["filePath"] = download.filePath;
+        downloads.append(json);
+    }
+
+    QSaveFile file(QDir(m_stateDirectory).filePath(INDEX_FILE));
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(downloads).toJson()) < 0 || !file.commit()) {
+        qCWarning(downloadManager) << "Failed to save download index:" << file.errorString();
+    }
+}
+
+void DownloadManager::loadIndex()
+{
+    QFile file(QDir(m_stateDirectory).filePath(INDEX_FILE));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonArray downloads = QJsonDocument::fromJson(file.readAll()).array();
+    for (const QJsonValue& value : downloads) {
+        const QJsonObject json = value.toObject();
+
+        auto download = std::make_unique<Download>();
+        download->id = json["id"].toString();
+        download->url = QUrl(json["url"].toString());
+        download->filePath = json["filePath"].toString();
+        download->state = State::Paused;
+        if (download->id.isEmpty() || m_downloads.count(download->id)) {
+            continue;
+        }
+
+        loadDownloadState(*download);
+        m_order.append(download->id);
+        m_downloads.emplace(download->id, std::move(download));
+    }
+
+    qCDebug(downloadManager) << "Restored" << m_order.size() << "unfinished downloads";
+}
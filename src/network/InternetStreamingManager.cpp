@@ -1,4 +1,6 @@
 #include "network/InternetStreamingManager.h"
+#include "network/NetworkService.h"
+#include "network/OnlineSearchService.h"
 #include <QLoggingCategory>
 #include <QMutexLocker>
 #include <QNetworkRequest>
@@ -58,16 +60,17 @@ bool InternetStreamingManager::searchYouTube(const QString& query, int maxResult
     QUrl apiUrl = buildYouTubeApiUrl(query, maxResults);
     QNetworkRequest request(apiUrl);
     
-    QNetworkReply* reply = m_networkManager->get(request);
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        if (reply->error() == QNetworkReply::NoError) {
-            QVector<InternetStream> results = parseYouTubeResponse(reply->readAll());
+    // Debounced; a newer search supersedes this one
+    OnlineSearchService::instance().search(this, "youtube", request,
+                                           [this](const QByteArray& data, const QString& error) {
+        if (error.isEmpty()) {
+            QVector<InternetStream> results = parseYouTubeResponse(data);
+            prefetchStreamUrls(results);
             emit youTubeSearchCompleted(results);
         } else {
-            qCWarning(internetStreaming) << "YouTube search error:" << reply->errorString();
+            qCWarning(internetStreaming) << "YouTube search error:" << error;
             emit youTubeSearchCompleted(QVector<InternetStream>());
         }
-        reply->deleteLater();
     });
     
     qCDebug(internetStreaming) << "YouTube search started:" << query;
@@ -76,14 +79,8 @@ bool InternetStreamingManager::searchYouTube(const QString& query, int maxResult
 
 QUrl InternetStreamingManager::getYouTubeStreamUrl(const QString& videoId, StreamQuality quality)
 {
-    Q_UNUSED(quality)
-    
-    // This would use youtube-dl or similar library to extract stream URLs
-    // For now, return a placeholder URL
-    QString streamUrl = QString("https://www.youtube.com/watch?v=%1").arg(videoId);
-    
-    qCDebug(internetStreaming) << "YouTube stream URL requested for:" << videoId;
-    return QUrl(streamUrl);
+    const QUrl pageUrl(QString("https://www.youtube.com/watch?v=%1").arg(videoId));
+    return resolveStreamUrl(pageUrl, quality, videoId);
 }
 
 bool InternetStreamingManager::searchTwitch(const QString& query, const QString& category)
@@ -97,16 +94,16 @@ bool InternetStreamingManager::searchTwitch(const QString& query, const QString&
     QNetworkRequest request(apiUrl);
     request.setRawHeader("Client-ID", m_twitchClientId.toUtf8());
     
-    QNetworkReply* reply = m_networkManager->get(request);
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        if (reply->error() == QNetworkReply::NoError) {
-            QVector<InternetStream> results = parseTwitchResponse(reply->readAll());
+    OnlineSearchService::instance().search(this, "twitch", request,
+                                           [this](const QByteArray& data, const QString& error) {
+        if (error.isEmpty()) {
+            QVector<InternetStream> results = parseTwitchResponse(data);
+            prefetchStreamUrls(results);
             emit twitchSearchCompleted(results);
         } else {
-            qCWarning(internetStreaming) << "Twitch search error:" << reply->errorString();
+            qCWarning(internetStreaming) << "Twitch search error:" << error;
             emit twitchSearchCompleted(QVector<InternetStream>());
         }
-        reply->deleteLater();
     });
     
     qCDebug(internetStreaming) << "Twitch search started:" << query;
@@ -115,13 +112,67 @@ bool InternetStreamingManager::searchTwitch(const QString& query, const QString&
 
 QUrl InternetStreamingManager::getTwitchStreamUrl(const QString& channelName, StreamQuality quality)
 {
-    Q_UNUSED(quality)
+    const QUrl pageUrl(QString("https://www.twitch.tv/%1").arg(channelName));
+    return resolveStreamUrl(pageUrl, quality, channelName);
+}
+
+QUrl InternetStreamingManager::resolveStreamUrl(const QUrl& pageUrl, StreamQuality quality, const QString& id)
+{
+    OnlineSearchService& search = OnlineSearchService::instance();
+    const QString format = resolverFormat(quality);
     
-    // This would use Twitch API to get actual stream URLs
-    QString streamUrl = QString("https://www.twitch.tv/%1").arg(channelName);
+    const QUrl cached = search.cachedStreamUrl(pageUrl, format);
+    if (cached.isValid()) {
+        return cached;
+    }
     
-    qCDebug(internetStreaming) << "Twitch stream URL requested for:" << channelName;
-    return QUrl(streamUrl);
+    // Players can open the page URL meanwhile; the resolved one follows
+    search.resolveStreamUrl(pageUrl, format, this, [this, id](const QUrl& streamUrl) {
+        if (streamUrl.isValid()) {
+            emit streamUrlResolved(id, streamUrl);
+        }
+    });
+    qCDebug(internetStreaming) << "Resolving stream URL for:" << pageUrl.toString();
+    return pageUrl;
+}
+
+void InternetStreamingManager::prefetchStreamUrls(const QVector<InternetStream>& results)
+{
+    QList<QUrl> topResults;
+    for (const InternetStream& stream : results) {
+        if (topResults.size() == OnlineSearchService::PREFETCH_COUNT) {
+            break;
+        }
+        if (stream.url.isValid() && (stream.serviceType != Twitch || stream.isLive)) {
+            topResults.append(stream.url);
+        }
+    }
+    OnlineSearchService::instance().prefetchStreamUrls(topResults, resolverFormat(Best_Available));
+}
+
+QString InternetStreamingManager::resolverFormat(StreamQuality quality)
+{
+    // Single-file formats, so the resolved URL carries both audio and video
+    switch (quality) {
+    case Audio_64k:
+        return "worstaudio/bestaudio";
+    case Audio_128k:
+    case Audio_320k:
+        return "bestaudio";
+    case Video_360p:
+        return "best[height<=360]/best";
+    case Video_480p:
+        return "best[height<=480]/best";
+    case Video_720p:
+        return "best[height<=720]/best";
+    case Video_1080p:
+        return "best[height<=1080]/best";
+    case Video_4K:
+        return "best[height<=2160]/best";
+    case Best_Available:
+    default:
+        return "best";
+    }
 }
 
 bool InternetStreamingManager::searchRadioStations(const QString& query, const QString& genre, const QString& country)
@@ -129,7 +180,7 @@ bool InternetStreamingManager::searchRadioStations(const QString& query, const Q
     QUrl apiUrl = buildRadioApiUrl(query, genre, country);
     QNetworkRequest request(apiUrl);
     
-    QNetworkReply* reply = m_networkManager->get(request);
+    QNetworkReply* reply = NetworkService::instance().get(request, NetworkService::RequestClass::Metadata);
     connect(reply, &QNetworkReply::finished, this, [this, reply]() {
         if (reply->error() == QNetworkReply::NoError) {
             QVector<RadioStation> results = parseRadioResponse(reply->readAll());
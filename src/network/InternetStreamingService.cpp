@@ -1,5 +1,10 @@
 #include "network/InternetStreamingService.h"
-#include <QNetworkAccessManager>
+#include "network/DownloadManager.h"
+#include "network/NetworkService.h"
+#include "network/OnlineSearchService.h"
+#include "network/PodcastFeedRefresher.h"
+#include "network/RadioDirectory.h"
+#include "network/TimeshiftBuffer.h"
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QJsonDocument>
@@ -11,6 +16,7 @@
 #include <QTimer>
 #include <QDateTime>
 #include <QFile>
+#include <QFileInfo>
 #include <QDir>
 #include <QLoggingCategory>
 
@@ -24,22 +30,79 @@ const QString InternetStreamingService::ICECAST_API_BASE_URL = "https://dir.xiph
 
 InternetStreamingService::InternetStreamingService(QObject *parent)
     : QObject(parent)
-    , m_networkManager(std::make_unique<QNetworkAccessManager>(this))
     , m_maxConcurrentDownloads(DEFAULT_MAX_DOWNLOADS)
     , m_isRecording(false)
     , m_recordingTimer(new QTimer(this))
     , m_recordingStartTime(0)
     , m_recordingReply(nullptr)
+    , m_recordingSink(new RecordingSink(this))
+    , m_recordingRingOffset(0)
+    , m_ringCopyScheduled(false)
+    , m_downloadManager(new DownloadManager(DownloadManager::defaultDirectory(), this))
+    , m_radioDirectory(new RadioDirectory(RadioDirectory::defaultDirectory(), this))
+    , m_radioProber(new RadioStationProber(this))
 {
-    setupNetworkManager();
-    
     // Setup recording timer
     m_recordingTimer->setInterval(RECORDING_UPDATE_INTERVAL_MS);
     connect(m_recordingTimer, &QTimer::timeout, this, &InternetStreamingService::onRecordingTimerTimeout);
+    connect(m_recordingSink, &RecordingSink::writeError, this, [this](const QString& error) {
+        stopRecording();
+        emit serviceError("Recording failed: " + error, UNKNOWN_SERVICE);
+    });
     
     // Set default user agent
     m_userAgent = "EonPlay/1.0 (Cross-Platform Media Player)";
     
+    // Episode downloads
+    m_downloadManager->setMaxConcurrentDownloads(m_maxConcurrentDownloads);
+    m_downloadManager->setUserAgent(m_userAgent);
+    connect(m_downloadManager, &DownloadManager::downloadProgress, this,
+            [this](const QString& episodeId, qint64 bytesReceived, qint64 bytesTotal) {
+        if (bytesTotal > 0) {
+            emit podcastDownloadProgress(episodeId, static_cast<int>(bytesReceived * 100 / bytesTotal));
+        }
+    });
+    connect(m_downloadManager, &DownloadManager::downloadFinished,
+            this, &InternetStreamingService::podcastDownloadCompleted);
+    connect(m_downloadManager, &DownloadManager::downloadFailed, this,
+            [this](const QString& episodeId, const QString& error) {
+        Q_UNUSED(episodeId)
+        emit serviceError(error, PODCAST_SERVICE);
+    });
+    
+    // Radio directory and liveness
+    m_radioDirectory->setListingUrl(QUrl(ICECAST_API_BASE_URL + "/yp.xml"));
+    m_radioDirectory->setUserAgent(m_userAgent);
+    m_radioProber->setUserAgent(m_userAgent);
+    connect(m_radioProber, &RadioStationProber::stationProbed, this,
+            [this](const QString& stationUrl, bool online, const RadioStation& info) {
+        for (RadioStation& station : m_radioStations) {
+            if (station.url == stationUrl) {
+                station.isOnline = online;
+            }
+        }
+        emit radioStationStatusChanged(stationUrl, online);
+        
+        if (m_radioInfoRequests.remove(stationUrl)) {
+            RadioStation station = info;
+            for (const RadioStation& known : std::as_const(m_radioStations)) {
+                if (known.url == stationUrl) {
+                    // What the station announces beats what the directory lists
+                    station = known;
+                    if (!info.name.isEmpty()) station.name = info.name;
+                    if (!info.genre.isEmpty()) station.genre = info.genre;
+                    if (!info.description.isEmpty()) station.description = info.description;
+                    if (!info.website.isEmpty()) station.website = info.website;
+                    if (!info.format.isEmpty()) station.format = info.format;
+                    if (info.bitrate > 0) station.bitrate = info.bitrate;
+                    station.isOnline = online;
+                    break;
+                }
+            }
+            emit radioStationInfoReceived(station);
+        }
+    });
+    
     qCDebug(internetStreaming) << "InternetStreamingService initialized";
 }
 
@@ -47,20 +110,7 @@ InternetStreamingService::~InternetStreamingService()
 {
     stopRecording();
     
-    // Cancel all active downloads
-    for (auto reply : m_activeDownloads.values()) {
-        if (reply) {
-            reply->abort();
-            reply->deleteLater();
-        }
-    }
-    m_activeDownloads.clear();
-}
-
-void InternetStreamingService::setupNetworkManager()
-{
-    connect(m_networkManager.get(), &QNetworkAccessManager::finished,
-            this, &InternetStreamingService::onNetworkReplyFinished);
+    // Unfinished downloads are kept by the download manager for resuming
 }
 
 // YouTube Integration
@@ -72,7 +122,14 @@ bool InternetStreamingService::searchYouTube(const QString& query, int maxResult
     }
     
     QUrl url(buildYouTubeSearchUrl(query, maxResults));
-    makeApiRequest(url, "youtube_search");
+    OnlineSearchService::instance().search(this, "youtube_search", createApiRequest(url),
+                                           [this](const QByteArray& data, const QString& error) {
+        if (!error.isEmpty()) {
+            emit serviceError(error, YOUTUBE_SERVICE);
+            return;
+        }
+        processYouTubeSearchResponse(QJsonDocument::fromJson(data).object());
+    });
     
     qCDebug(internetStreaming) << "YouTube search initiated:" << query;
     return true;
@@ -156,6 +213,14 @@ void InternetStreamingService::processYouTubeSearchResponse(const QJsonObject& r
         m_youtubeResults.append(info);
     }
     
+    // Resolve the likely picks before they are chosen
+    QList<QUrl> topResults;
+    for (const StreamInfo& info : std::as_const(m_youtubeResults)) {
+        if (topResults.size() == OnlineSearchService::PREFETCH_COUNT) break;
+        topResults.append(QUrl(info.streamUrl));
+    }
+    OnlineSearchService::instance().prefetchStreamUrls(topResults);
+    
     emit youtubeSearchCompleted(m_youtubeResults);
     qCDebug(internetStreaming) << "YouTube search completed:" << m_youtubeResults.size() << "results";
 }
@@ -200,7 +265,14 @@ bool InternetStreamingService::searchTwitchStreams(const QString& query, int max
     }
     
     QUrl url(buildTwitchSearchUrl(query, maxResults));
-    makeApiRequest(url, "twitch_search");
+    OnlineSearchService::instance().search(this, "twitch_search", createApiRequest(url),
+                                           [this](const QByteArray& data, const QString& error) {
+        if (!error.isEmpty()) {
+            emit serviceError(error, TWITCH_SERVICE);
+            return;
+        }
+        processTwitchSearchResponse(QJsonDocument::fromJson(data).object());
+    });
     
     qCDebug(internetStreaming) << "Twitch search initiated:" << query;
     return true;
@@ -241,6 +313,13 @@ void InternetStreamingService::processTwitchSearchResponse(const QJsonObject& re
         m_twitchResults.append(info);
     }
     
+    QList<QUrl> topResults;
+    for (const StreamInfo& info : std::as_const(m_twitchResults)) {
+        if (topResults.size() == OnlineSearchService::PREFETCH_COUNT) break;
+        if (info.isLive) topResults.append(QUrl(info.streamUrl));
+    }
+    OnlineSearchService::instance().prefetchStreamUrls(topResults);
+    
     emit twitchSearchCompleted(m_twitchResults);
     qCDebug(internetStreaming) << "Twitch search completed:" << m_twitchResults.size() << "results";
 }
@@ -248,6 +327,25 @@ void InternetStreamingService::processTwitchSearchResponse(const QJsonObject& re
 // Internet Radio Integration
 bool InternetStreamingService::searchRadioStations(const QString& genre, const QString& query)
 {
+    // Served from the local directory once it has been downloaded
+    if (!m_radioDirectory->isEmpty()) {
+        m_radioStations = m_radioDirectory->search(query, genre);
+        for (RadioStation& station : m_radioStations) {
+            station.isOnline = m_radioProber->status(station.url) == RadioStationProber::Online;
+        }
+        emit radioStationsLoaded(m_radioStations);
+        
+        QStringList urls;
+        for (const RadioStation& station : std::as_const(m_radioStations)) {
+            urls.append(station.url);
+        }
+        m_radioProber->cancelPending();
+        m_radioProber->probe(urls);
+        
+        qCDebug(internetStreaming) << "Radio stations found locally:" << m_radioStations.size();
+        return true;
+    }
+    
     // Search SHOUTcast directory
     QUrl url(buildRadioSearchUrl(genre, query));
     makeApiRequest(url, "radio_search");
@@ -278,8 +376,15 @@ void InternetStreamingService::processRadioStationsResponse(const QString& respo
 {
     // Parse SHOUTcast XML response
     m_radioStations = parseSHOUTcastDirectory(response);
+    m_radioDirectory->addStations(m_radioStations);
     emit radioStationsLoaded(m_radioStations);
     
+    QStringList urls;
+    for (const RadioStation& station : std::as_const(m_radioStations)) {
+        urls.append(station.url);
+    }
+    m_radioProber->probe(urls);
+    
     qCDebug(internetStreaming) << "Radio stations loaded:" << m_radioStations.size();
 }
 
@@ -311,6 +416,29 @@ QList<InternetStreamingService::RadioStation> InternetStreamingService::parseSHO
     return stations;
 }
 
+bool InternetStreamingService::getRadioStationInfo(const QString& stationUrl)
+{
+    if (!isValidStreamUrl(QUrl(stationUrl))) {
+        return false;
+    }
+    
+    // Answered by radioStationInfoReceived() once the station has been probed
+    m_radioInfoRequests.insert(stationUrl);
+    m_radioProber->probe(stationUrl, true);
+    return true;
+}
+
+bool InternetStreamingService::isRadioStationOnline(const QString& stationUrl) const
+{
+    m_radioProber->probe(stationUrl);
+    return m_radioProber->status(stationUrl) == RadioStationProber::Online;
+}
+
+void InternetStreamingService::probeRadioStations(const QStringList& stationUrls)
+{
+    m_radioProber->probe(stationUrls);
+}
+
 QStringList InternetStreamingService::getRadioGenres() const
 {
     // Common radio genres
@@ -332,7 +460,7 @@ bool InternetStreamingService::loadPodcastFeed(const QString& feedUrl)
     return true;
 }
 
-void InternetStreamingService::processPodcastFeedResponse(const QString& response)
+void InternetStreamingService::processPodcastFeedResponse(const QByteArray& response)
 {
     m_currentPodcastFeed = parseRSSFeed(response);
     emit podcastFeedLoaded(m_currentPodcastFeed);
@@ -340,59 +468,34 @@ void InternetStreamingService::processPodcastFeedResponse(const QString& respons
     qCDebug(internetStreaming) << "Podcast feed loaded:" << m_currentPodcastFeed.title;
 }
 
-InternetStreamingService::PodcastFeed InternetStreamingService::parseRSSFeed(const QString& xml) const
+InternetStreamingService::PodcastFeed InternetStreamingService::parseRSSFeed(const QByteArray& xml) const
 {
+    // Bytes, so the parser honours the declared encoding
+    PodcastFeedParser parser;
+    parser.addData(xml);
+    
     PodcastFeed feed;
-    QXmlStreamReader reader(xml);
+    PodcastEpisode episode;
+    while (parser.readNext(episode)) {
+        feed.episodes.append(episode);
+    }
     
-    while (!reader.atEnd()) {
-        reader.readNext();
-        
-        if (reader.isStartElement()) {
-            if (reader.name() == QStringView(u"title") && feed.title.isEmpty()) {
-                feed.title = reader.readElementText();
-            } else if (reader.name() == QStringView(u"description") && feed.description.isEmpty()) {
-                feed.description = reader.readElementText();
-            } else if (reader.name() == QStringView(u"link") && feed.website.isEmpty()) {
-                feed.website = reader.readElementText();
-            } else if (reader.name() == QStringView(u"item")) {
-                // Parse episode
-                PodcastEpisode episode;
-                
-                while (!(reader.isEndElement() && reader.name() == QStringView(u"item"))) {
-                    reader.readNext();
-                    
-                    if (reader.isStartElement()) {
-                        if (reader.name() == QStringView(u"title")) {
-                            episode.title = reader.readElementText();
-                        } else if (reader.name() == QStringView(u"description")) {
-                            episode.description = reader.readElementText();
-                        } else if (reader.name() == QStringView(u"enclosure")) {
-                            QXmlStreamAttributes attrs = reader.attributes();
-                            episode.audioUrl = attrs.value("url").toString();
-                            episode.fileSize = attrs.value("length").toLongLong();
-                            episode.mimeType = attrs.value("type").toString();
-                        } else if (reader.name() == QStringView(u"pubDate")) {
-                            episode.publishDate = QDateTime::fromString(reader.readElementText(), Qt::RFC2822Date);
-                        } else if (reader.name() == QStringView(u"guid")) {
-                            episode.guid = reader.readElementText();
-                        }
-                    }
-                }
-                
-                if (!episode.title.isEmpty() && !episode.audioUrl.isEmpty()) {
-                    feed.episodes.append(episode);
-                }
-            }
-        }
+    if (parser.hasError()) {
+        qCWarning(internetStreaming) << "Malformed podcast feed:" << parser.errorString();
     }
     
+    feed.title = parser.title();
+    feed.description = parser.description();
+    feed.website = parser.website();
+    feed.imageUrl = parser.imageUrl();
+    feed.author = parser.author();
+    feed.category = parser.category();
     feed.lastUpdated = QDateTime::currentDateTime();
     return feed;
 }
 
 // Stream Recording
-bool InternetStreamingService::startRecording(const QString& streamUrl, const QString& outputPath)
+bool InternetStreamingService::startRecording(const QString& streamUrl, const QString& outputPath, qint64 fromMsAgo)
 {
     if (m_isRecording) {
         stopRecording();
@@ -400,17 +503,45 @@ bool InternetStreamingService::startRecording(const QString& streamUrl, const QS
     
     setupRecording(streamUrl, outputPath);
     
+    // Timeshifted: the stream is already arriving, and its past is on disk
+    m_recordingRing = TimeshiftBuffer::ringFor(QUrl(streamUrl));
+    if (m_recordingRing) {
+        m_recordingRingOffset = m_recordingRing->offsetBehindLive(fromMsAgo);
+        const qint64 behindMs = m_recordingRing->behindLiveMs(m_recordingRingOffset);
+        
+        m_recordingSink->open(outputPath, m_recordingRotation);
+        const QByteArray init = m_recordingRing->initSegment();
+        if (!init.isEmpty()) {
+            m_recordingSink->write(init);
+        }
+        
+        m_isRecording = true;
+        m_recordingStartTime = QDateTime::currentMSecsSinceEpoch() - behindMs;
+        m_recordingTimer->start();
+        copyFromRing();
+        
+        emit recordingStarted(outputPath);
+        qCDebug(internetStreaming) << "Recording started from the timeshift ring," << behindMs << "ms back:"
+                                   << streamUrl << "to" << outputPath;
+        return true;
+    }
+    if (fromMsAgo > 0) {
+        qCDebug(internetStreaming) << "Stream is not timeshifted, recording from now:" << streamUrl;
+    }
+    
     QNetworkRequest request(streamUrl);
     request.setRawHeader("User-Agent", m_userAgent.toUtf8());
     
-    m_recordingReply = m_networkManager->get(request);
-    connect(m_recordingReply, &QNetworkReply::readyRead, [this]() {
-        if (m_recordingReply && !m_recordingOutputPath.isEmpty()) {
-            QFile file(m_recordingOutputPath);
-            if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
-                file.write(m_recordingReply->readAll());
-                file.close();
-            }
+    // A live capture never finishes, so it must not count as a playback
+    // transfer holding back every other request; it only shares the client
+    NetworkService::configureRequest(request, NetworkService::RequestClass::Playback);
+    m_recordingReply = NetworkService::instance().networkManager()->get(request);
+    
+    // The sink writes on its own thread, through one buffered handle
+    m_recordingSink->open(outputPath, m_recordingRotation);
+    connect(m_recordingReply, &QNetworkReply::readyRead, this, [this]() {
+        if (m_recordingReply) {
+            m_recordingSink->write(m_recordingReply->readAll());
         }
     });
     
@@ -430,7 +561,21 @@ void InternetStreamingService::stopRecording()
     
     m_recordingTimer->stop();
     
+    if (m_recordingRing) {
+        // Everything up to the live edge, however far behind the copy is
+        while (m_recordingRingOffset < m_recordingRing->end()) {
+            const qint64 before = m_recordingRingOffset;
+            copyFromRing();
+            if (m_recordingRingOffset == before) {
+                break;
+            }
+        }
+        m_recordingRing.reset();
+    }
+    
     if (m_recordingReply) {
+        m_recordingSink->write(m_recordingReply->readAll());
+        m_recordingReply->disconnect(this);
         m_recordingReply->abort();
         m_recordingReply->deleteLater();
         m_recordingReply = nullptr;
@@ -439,6 +584,7 @@ void InternetStreamingService::stopRecording()
     qint64 duration = getRecordingDuration();
     qint64 fileSize = getRecordingFileSize();
     
+    m_recordingSink->close();
     m_isRecording = false;
     m_recordingStartTime = 0;
     
@@ -450,20 +596,45 @@ void InternetStreamingService::setupRecording(const QString& streamUrl, const QS
 {
     m_recordingOutputPath = outputPath;
     
-    // Ensure output directory exists
+    // Ensure output directory exists; the sink replaces an existing file
     QDir().mkpath(QFileInfo(outputPath).absolutePath());
-    
-    // Remove existing file if it exists
-    if (QFile::exists(outputPath)) {
-        QFile::remove(outputPath);
-    }
 }
 
 void InternetStreamingService::onRecordingTimerTimeout()
 {
+    copyFromRing();
     updateRecordingStats();
 }
 
+void InternetStreamingService::copyFromRing()
+{
+    m_ringCopyScheduled = false;
+    if (!m_isRecording || !m_recordingRing) {
+        return;
+    }
+    
+    // A copy that fell out of the window carries on from the oldest data kept
+    const qint64 start = m_recordingRing->start();
+    if (m_recordingRingOffset < start) {
+        qCWarning(internetStreaming) << "Recording fell behind the timeshift window, skipping"
+                                     << start - m_recordingRingOffset << "bytes";
+        m_recordingRingOffset = start;
+    }
+    
+    const QByteArray data = m_recordingRing->read(m_recordingRingOffset, RING_COPY_CHUNK_BYTES);
+    if (data.isEmpty()) {
+        return;
+    }
+    m_recordingSink->write(data);
+    m_recordingRingOffset += data.size();
+    
+    // A backlog from the past is copied a chunk per event loop pass, not in one go
+    if (m_recordingRingOffset < m_recordingRing->end() && !m_ringCopyScheduled) {
+        m_ringCopyScheduled = true;
+        QTimer::singleShot(0, this, &InternetStreamingService::copyFromRing);
+    }
+}
+
 void InternetStreamingService::updateRecordingStats()
 {
     if (!m_isRecording) return;
@@ -482,58 +653,50 @@ qint64 InternetStreamingService::getRecordingDuration() const
 
 qint64 InternetStreamingService::getRecordingFileSize() const
 {
-    if (m_recordingOutputPath.isEmpty()) return 0;
-    
-    QFileInfo fileInfo(m_recordingOutputPath);
-    return fileInfo.exists() ? fileInfo.size() : 0;
+    // Counted as data arrives; the file lags behind by the write buffer
+    return m_recordingSink->bytesReceived();
+}
+
+void InternetStreamingService::setRecordingRotation(qint64 maxBytes, qint64 maxDurationMs, int keepSegments)
+{
+    m_recordingRotation.maxBytes = maxBytes;
+    m_recordingRotation.maxDurationMs = maxDurationMs;
+    m_recordingRotation.keepSegments = keepSegments;
 }
 
 // Podcast Download
 bool InternetStreamingService::downloadPodcastEpisode(const PodcastEpisode& episode, const QString& downloadPath)
 {
-    if (m_activeDownloads.size() >= m_maxConcurrentDownloads) {
-        emit serviceError("Maximum concurrent downloads reached", PODCAST_SERVICE);
+    const QUrl url(episode.audioUrl);
+    if (!url.isValid() || downloadPath.isEmpty()) {
+        emit serviceError("Invalid podcast episode download", PODCAST_SERVICE);
         return false;
     }
     
-    QNetworkRequest request(episode.audioUrl);
-    request.setRawHeader("User-Agent", m_userAgent.toUtf8());
-    
-    QNetworkReply* reply = m_networkManager->get(request);
-    m_activeDownloads[episode.guid] = reply;
+    // A directory gets the episode's own file name
+    QString filePath = downloadPath;
+    if (QFileInfo(downloadPath).isDir()) {
+        QString fileName = url.fileName();
+        if (fileName.isEmpty()) {
+            fileName = QString::number(qHash(episode.audioUrl)) + ".mp3";
+        }
+        filePath = QDir(downloadPath).filePath(fileName);
+    }
     
-    connect(reply, &QNetworkReply::downloadProgress,
-            this, &InternetStreamingService::onDownloadProgress);
+    // Beyond the concurrency limit downloads queue instead of failing
+    const QString episodeId = episode.guid.isEmpty() ? episode.audioUrl : episode.guid;
+    m_downloadManager->addDownload(url, filePath, episodeId);
     
     qCDebug(internetStreaming) << "Podcast download started:" << episode.title;
     return true;
 }
 
-void InternetStreamingService::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
-{
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
-    
-    // Find episode ID for this reply
-    QString episodeId;
-    for (auto it = m_activeDownloads.constBegin(); it != m_activeDownloads.constEnd(); ++it) {
-        if (it.value() == reply) {
-            episodeId = it.key();
-            break;
-        }
-    }
-    
-    if (!episodeId.isEmpty() && bytesTotal > 0) {
-        int percentage = (bytesReceived * 100) / bytesTotal;
-        emit podcastDownloadProgress(episodeId, percentage);
-    }
-}
-
 // Network request handling
 void InternetStreamingService::makeApiRequest(const QUrl& url, const QString& requestId)
 {
     QNetworkRequest request = createApiRequest(url);
-    QNetworkReply* reply = m_networkManager->get(request);
+    QNetworkReply* reply = NetworkService::instance().get(request, NetworkService::RequestClass::Metadata);
+    connect(reply, &QNetworkReply::finished, this, &InternetStreamingService::onNetworkReplyFinished);
     
     if (!requestId.isEmpty()) {
         m_pendingRequests[reply] = requestId;
@@ -564,22 +727,14 @@ void InternetStreamingService::onNetworkReplyFinished()
     if (reply->error() == QNetworkReply::NoError) {
         QByteArray data = reply->readAll();
         
-        if (requestId == "youtube_search" || requestId == "youtube_video_info") {
-            QJsonDocument doc = QJsonDocument::fromJson(data);
-            QJsonObject response = doc.object();
-            
-            if (requestId == "youtube_search") {
-                processYouTubeSearchResponse(response);
-            } else {
-                processYouTubeVideoResponse(response);
-            }
-        } else if (requestId == "twitch_search") {
+        // Searches go through OnlineSearchService
+        if (requestId == "youtube_video_info") {
             QJsonDocument doc = QJsonDocument::fromJson(data);
-            processTwitchSearchResponse(doc.object());
+            processYouTubeVideoResponse(doc.object());
         } else if (requestId == "radio_search") {
             processRadioStationsResponse(QString::fromUtf8(data));
         } else if (requestId == "podcast_feed") {
-            processPodcastFeedResponse(QString::fromUtf8(data));
+            processPodcastFeedResponse(data);
         }
     } else {
         ServiceType serviceType = UNKNOWN_SERVICE;
@@ -671,9 +826,13 @@ void InternetStreamingService::setTwitchClientId(const QString& clientId)
 void InternetStreamingService::setUserAgent(const QString& userAgent)
 {
     m_userAgent = userAgent;
+    m_downloadManager->setUserAgent(userAgent);
+    m_radioDirectory->setUserAgent(userAgent);
+    m_radioProber->setUserAgent(userAgent);
 }
 
 void InternetStreamingService::setMaxConcurrentDownloads(int maxDownloads)
 {
     m_maxConcurrentDownloads = maxDownloads;
+    m_downloadManager->setMaxConcurrentDownloads(maxDownloads);
 }
\ No newline at end of file
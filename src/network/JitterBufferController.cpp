@@ -0,0 +1,179 @@
+#include "network/JitterBufferController.h"
+#include <QDateTime>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QSettings>
+#include <QVariantMap>
+#include <algorithm>
+#include <cmath>
+
+Q_LOGGING_CATEGORY(jitterBuffer, "eonplay.network.jitterbuffer")
+
+namespace {
+
+const char* const PROFILES_SETTINGS_KEY = "network/jitterBufferProfiles";
+
+int clampCaching(double cachingMs)
+{
+    return qBound(JitterBufferController::MIN_CACHING_MS, qRound(cachingMs), JitterBufferController::MAX_CACHING_MS);
+}
+
+} // namespace
+
+JitterBufferController& JitterBufferController::instance()
+{
+    static JitterBufferController controller;
+    return controller;
+}
+
+JitterBufferController::JitterBufferController()
+{
+    loadProfiles();
+}
+
+QString JitterBufferController::hostKey(const QUrl& url)
+{
+    // Cameras on one address often differ only by port
+    const QString host = url.host().toLower();
+    return url.port() > 0 ? QString("%1:%2").arg(host).arg(url.port()) : host;
+}
+
+int JitterBufferController::cachingFor(const QUrl& url, bool live) const
+{
+    QMutexLocker locker(&m_mutex);
+    const auto profile = m_profiles.constFind(hostKey(url));
+    if (profile != m_profiles.constEnd() && profile->cachingMs > 0) {
+        return profile->cachingMs;
+    }
+    return live ? DEFAULT_LIVE_CACHING_MS : DEFAULT_CACHING_MS;
+}
+
+void JitterBufferController::openStream(const void* stream, const QUrl& url, bool live)
+{
+    const int cachingMs = cachingFor(url, live);
+
+    QMutexLocker locker(&m_mutex);
+    Stream& entry = m_streams[stream];
+    entry = Stream();
+    entry.host = hostKey(url);
+    entry.live = live;
+    entry.openedCachingMs = cachingMs;
+    entry.cachingMs = cachingMs;
+    entry.jitterMs = m_profiles.value(entry.host).jitterMs;
+    entry.stableSince = QDateTime::currentMSecsSinceEpoch();
+}
+
+int JitterBufferController::floorFor(const Stream& stream) const
+{
+    return clampCaching(JITTER_MARGIN * stream.jitterMs);
+}
+
+void JitterBufferController::addArrivalSample(const void* stream, qint64 bytes, qint64 intervalMs)
+{
+    if (bytes < 0 || intervalMs <= 0) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_streams.find(stream);
+    if (it == m_streams.end()) {
+        return;
+    }
+    Stream& entry = *it;
+
+    const double rate = static_cast<double>(bytes) / intervalMs;
+    if (entry.meanRate <= 0.0) {
+        entry.meanRate = rate;
+        return;
+    }
+
+    // Time by which this interval's data ran ahead of or behind the mean rate
+    const double deviationMs = intervalMs * (1.0 - rate / entry.meanRate);
+    entry.jitterMs += (std::abs(deviationMs) - entry.jitterMs) / 16.0;
+    entry.meanRate += (rate - entry.meanRate) / 8.0;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now - entry.stableSince >= STABLE_PERIOD_MS) {
+        entry.cachingMs = std::max(floorFor(entry), clampCaching(entry.cachingMs * STABLE_DECAY));
+        entry.stableSince = now;
+    }
+}
+
+bool JitterBufferController::reportStall(const void* stream)
+{
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_streams.find(stream);
+    if (it == m_streams.end()) {
+        return false;
+    }
+    Stream& entry = *it;
+
+    entry.stalls++;
+    entry.cachingMs = std::max(floorFor(entry), clampCaching(entry.cachingMs * STALL_GROWTH));
+    entry.stableSince = QDateTime::currentMSecsSinceEpoch();
+
+    qCDebug(jitterBuffer) << "Stall on" << entry.host << "jitter" << qRound(entry.jitterMs) << "ms, caching now"
+                          << entry.cachingMs << "ms";
+
+    // Worth a reopen only once the depth grew noticeably over what libVLC has
+    return entry.live && entry.cachingMs >= entry.openedCachingMs * STALL_GROWTH;
+}
+
+void JitterBufferController::closeStream(const void* stream)
+{
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_streams.constFind(stream);
+    if (it == m_streams.constEnd()) {
+        return;
+    }
+    const Stream entry = *it;
+    m_streams.erase(it);
+
+    HostProfile& profile = m_profiles[entry.host];
+    profile.cachingMs = entry.cachingMs;
+    profile.jitterMs = entry.jitterMs;
+    profile.stalls += entry.stalls;
+    profile.updated = QDateTime::currentMSecsSinceEpoch();
+
+    // Forget the hosts not played from for the longest
+    while (m_profiles.size() > MAX_PROFILES) {
+        auto oldest = std::min_element(m_profiles.begin(), m_profiles.end(),
+                                       [](const HostProfile& a, const HostProfile& b) { return a.updated < b.updated; });
+        m_profiles.erase(oldest);
+    }
+
+    const QHash<QString, HostProfile> profiles = m_profiles;
+    locker.unlock();
+
+    QVariantMap stored;
+    for (auto host = profiles.constBegin(); host != profiles.constEnd(); ++host) {
+        stored.insert(host.key(), QVariantList{host->cachingMs, host->jitterMs, host->stalls, host->updated});
+    }
+    QSettings settings;
+    settings.setValue(PROFILES_SETTINGS_KEY, stored);
+}
+
+JitterBufferController::HostProfile JitterBufferController::profile(const QUrl& url) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_profiles.value(hostKey(url));
+}
+
+void JitterBufferController::loadProfiles()
+{
+    QSettings settings;
+    const QVariantMap stored = settings.value(PROFILES_SETTINGS_KEY).toMap();
+    for (auto it = stored.constBegin(); it != stored.constEnd(); ++it) {
+        const QVariantList values = it.value().toList();
+        if (values.size() < 4) {
+            continue;
+        }
+
+        HostProfile profile;
+        profile.cachingMs = clampCaching(values[0].toInt());
+        profile.jitterMs = values[1].toDouble();
+        profile.stalls = values[2].toInt();
+        profile.updated = values[3].toLongLong();
+        m_profiles.insert(it.key(), profile);
+    }
+}
@@ -0,0 +1,543 @@
+#include "network/LibraryApiService.h"
+#include "data/DatabaseManager.h"
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QStringList>
+
+Q_LOGGING_CATEGORY(libraryApi, "eonplay.network.libraryapi")
+
+using EonPlay::Data::DatabaseManager;
+
+namespace {
+
+const QString API_PREFIX = QStringLiteral("/api/v1/");
+
+// Columns of an item row, in this order
+const char ITEM_COLUMNS[] =
+    "m.id, m.title, m.artist, m.album, m.genre, m.year, m.track_number, m.duration, m.file_size, m.file_path, "
+    "m.play_count, m.rating, m.date_added, m.last_played";
+enum ItemColumn {
+    ItemId, ItemTitle, ItemArtist, ItemAlbum, ItemGenre, ItemYear, ItemTrack, ItemDuration, ItemSize, ItemPath,
+    ItemPlayCount, ItemRating, ItemAdded, ItemPlayed
+};
+
+// Search orders by name; each ends in a unique column so pages never overlap
+const QHash<QString, QString> SEARCH_ORDERS = {
+    {"title", "m.title %1, m.id"},
+    {"artist", "m.artist %1, m.album, m.track_number, m.id"},
+    {"album", "m.album %1, m.track_number, m.id"},
+    {"year", "m.year %1, m.album, m.track_number, m.id"},
+    {"added", "m.date_added %1, m.id"},
+    {"played", "m.last_played %1, m.id"},
+    {"plays", "m.play_count %1, m.id"},
+    {"rating", "m.rating %1, m.id"}
+};
+
+const QStringList FACETS = {
+    DatabaseManager::facetName(DatabaseManager::ArtistFacet),
+    DatabaseManager::facetName(DatabaseManager::AlbumFacet),
+    DatabaseManager::facetName(DatabaseManager::GenreFacet),
+    DatabaseManager::facetName(DatabaseManager::ExtensionFacet)
+};
+
+struct RowPage {
+    QVector<QVariantList> rows;
+    int total = 0;
+    bool ok = false;
+};
+
+/**
+ * @brief Run a count and a LIMIT/OFFSET page query on a reader connection
+ * @param rowSql Page query ending in "LIMIT ? OFFSET ?"
+ * @param countSql Query of the total; empty to use the rows' own count
+ * @param requiredTable Table the queries need, missing if PlaylistManager never ran here
+ */
+RowPage runPage(DatabaseManager* dbManager, const QString& rowSql, const QVariantList& rowValues,
+                const QString& countSql, const QVariantList& countValues, int start, int count,
+                const QString& requiredTable = QString())
+{
+    return dbManager->executor()->read([=](QSqlDatabase& database) {
+        RowPage page;
+        if (!requiredTable.isEmpty() && !database.tables().contains(requiredTable)) {
+            page.ok = true;
+            return page;
+        }
+
+        QSqlQuery query(database);
+        query.setForwardOnly(true);
+
+        if (!countSql.isEmpty()) {
+            query.prepare(countSql);
+            for (const QVariant& value : countValues) {
+                query.addBindValue(value);
+            }
+            if (!query.exec()) {
+                qCWarning(libraryApi) << "Count query failed:" << query.lastError().text();
+                return page;
+            }
+            page.total = query.next() ? query.value(0).toInt() : 0;
+            query.finish();
+        }
+
+        query.prepare(rowSql);
+        for (const QVariant& value : rowValues) {
+            query.addBindValue(value);
+        }
+        query.addBindValue(count);
+        query.addBindValue(start);
+        if (!query.exec()) {
+            qCWarning(libraryApi) << "Page query failed:" << query.lastError().text();
+            return page;
+        }
+
+        const int columns = query.record().count();
+        while (query.next()) {
+            QVariantList row;
+            row.reserve(columns);
+            for (int i = 0; i < columns; ++i) {
+                row.append(query.value(i));
+            }
+            page.rows.append(row);
+        }
+
+        if (countSql.isEmpty()) {
+            page.total = start + page.rows.size();
+        }
+        page.ok = true;
+        return page;
+    }).result();
+}
+
+QByteArray toJson(const QJsonObject& object)
+{
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+LibraryApiService::Response error(int status, const QString& message)
+{
+    return {status, toJson({{"error", message}}), QByteArray()};
+}
+
+QJsonObject itemJson(const QVariantList& row)
+{
+    return {
+        {"id", row[ItemId].toInt()},
+        {"title", row[ItemTitle].toString()},
+        {"artist", row[ItemArtist].toString()},
+        {"album", row[ItemAlbum].toString()},
+        {"genre", row[ItemGenre].toString()},
+        {"year", row[ItemYear].toInt()},
+        {"track", row[ItemTrack].toInt()},
+        {"duration", row[ItemDuration].toLongLong()},
+        {"size", row[ItemSize].toLongLong()},
+        {"path", row[ItemPath].toString()},
+        {"playCount", row[ItemPlayCount].toInt()},
+        {"rating", row[ItemRating].toInt()},
+        {"added", row[ItemAdded].toDateTime().toString(Qt::ISODate)},
+        {"lastPlayed", row[ItemPlayed].toDateTime().toString(Qt::ISODate)}
+    };
+}
+
+/**
+ * @brief Read offset and limit, clamping the limit to MAX_PAGE_SIZE
+ * @return false if either is not a number or out of range
+ */
+bool parsePaging(const QUrlQuery& query, int& offset, int& limit)
+{
+    bool valid = true;
+    offset = query.hasQueryItem("offset") ? query.queryItemValue("offset").toInt(&valid) : 0;
+    if (!valid || offset < 0) {
+        return false;
+    }
+    limit = query.hasQueryItem("limit") ? query.queryItemValue("limit").toInt(&valid)
+                                        : LibraryApiService::DEFAULT_PAGE_SIZE;
+    if (!valid || limit <= 0) {
+        return false;
+    }
+    limit = qMin(limit, int(LibraryApiService::MAX_PAGE_SIZE));
+    return true;
+}
+
+QJsonObject pageJson(const RowPage& page, int offset, const QJsonArray& items)
+{
+    return {
+        {"offset", offset},
+        {"total", page.total},
+        {"items", items}
+    };
+}
+
+// Takes as long for a wrong token as for a right one, so the token cannot be guessed byte by byte
+bool tokensMatch(const QByteArray& given, const QByteArray& expected)
+{
+    const qsizetype length = qMax(given.size(), expected.size());
+    unsigned int difference = given.size() == expected.size() ? 0 : 1;
+    for (qsizetype i = 0; i < length; ++i) {
+        const unsigned char a = i < given.size() ? static_cast<unsigned char>(given[i]) : 0;
+        const unsigned char b = i < expected.size() ? static_cast<unsigned char>(expected[i]) : 0;
+        difference |= a ^ b;
+    }
+    return difference == 0;
+}
+
+} // namespace
+
+LibraryApiService::LibraryApiService(DatabaseManager* dbManager, const QString& token)
+    : m_dbManager(dbManager)
+    , m_token(token.toUtf8())
+    , m_responseCache(RESPONSE_CACHE_SIZE)
+{
+}
+
+LibraryApiService::Response LibraryApiService::handle(const QByteArray& method, const QString& path,
+                                                      const QUrlQuery& query,
+                                                      const QHash<QByteArray, QByteArray>& headers,
+                                                      const QByteArray& body)
+{
+    if (!isAuthorized(headers, query)) {
+        return error(401, "Unauthorized");
+    }
+    if (!path.startsWith(API_PREFIX)) {
+        return error(404, "Not found");
+    }
+
+    const QString resource = path.mid(API_PREFIX.size());
+    if (resource == "progress" && method == "POST") {
+        return saveProgress(body);
+    }
+    if (method != "GET" && method != "HEAD") {
+        return error(405, "Method not allowed");
+    }
+
+    if (resource == "playlists") {
+        return playlists(query);
+    }
+    if (resource.startsWith("playlists/") && resource.endsWith("/items")) {
+        bool valid = false;
+        const int playlistId = resource.section('/', 1, 1).toInt(&valid);
+        return valid ? playlistItems(playlistId, query) : error(404, "Not found");
+    }
+    if (resource == "progress") {
+        return progress(query);
+    }
+
+    // Library responses only change with the revision, so a client's copy is checked without a query
+    const QByteArray etag = '"' + QByteArray::number(revision()) + '"';
+    if (resource == "info" || resource == "search" || resource == "facets") {
+        if (headers.value("if-none-match") == etag) {
+            return {304, QByteArray(), etag};
+        }
+    }
+
+    if (resource == "info") {
+        return info();
+    }
+
+    // Keyed by revision too, so a page built while the library changed is never served after
+    const QString key = QString::number(revision()) + QLatin1Char(' ') + resource + QLatin1Char('?') +
+                        query.toString(QUrl::FullyEncoded);
+    if (resource == "search") {
+        return cachedResponse(key, [&]() { return search(query); });
+    }
+    if (resource == "facets") {
+        return cachedResponse(key, [&]() { return facets(query); });
+    }
+    return error(404, "Not found");
+}
+
+bool LibraryApiService::isAuthorized(const QHash<QByteArray, QByteArray>& headers, const QUrlQuery& query) const
+{
+    // Without a token nothing is served; NetworkDiscoveryManager refuses to start it that way
+    if (m_token.isEmpty()) {
+        return false;
+    }
+
+    static const QByteArray bearer = QByteArrayLiteral("Bearer ");
+    const QByteArray authorization = headers.value("authorization");
+    if (authorization.startsWith(bearer) && tokensMatch(authorization.mid(bearer.size()), m_token)) {
+        return true;
+    }
+    return tokensMatch(query.queryItemValue("token", QUrl::FullyDecoded).toUtf8(), m_token);
+}
+
+QString LibraryApiService::mediaPath(int id) const
+{
+    const RowPage page = runPage(m_dbManager, "SELECT file_path FROM media_files WHERE id = ? LIMIT ? OFFSET ?",
+                                 {id}, QString(), {}, 0, 1);
+    return page.rows.isEmpty() ? QString() : page.rows.first().first().toString();
+}
+
+void LibraryApiService::notifyLibraryChanged()
+{
+    ++m_revision;
+
+    QMutexLocker locker(&m_cacheMutex);
+    m_responseCache.clear();
+}
+
+template <typename Builder>
+LibraryApiService::Response LibraryApiService::cachedResponse(const QString& key, Builder&& build)
+{
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (const Response* response = m_responseCache.object(key)) {
+            return *response;
+        }
+    }
+
+    const Response response = build();
+    if (response.status == 200) {
+        QMutexLocker locker(&m_cacheMutex);
+        m_responseCache.insert(key, new Response(response));
+    }
+    return response;
+}
+
+LibraryApiService::Response LibraryApiService::info()
+{
+    const quint64 currentRevision = revision();
+    const RowPage totals = runPage(m_dbManager,
+        "SELECT file_count, total_size, total_duration FROM library_aggregates WHERE facet = ? LIMIT ? OFFSET ?",
+        {DatabaseManager::facetName(DatabaseManager::LibraryFacet)}, QString(), {}, 0, 1);
+    if (!totals.ok) {
+        return error(500, "Library unavailable");
+    }
+
+    const QVariantList row = totals.rows.value(0);
+    return {200, toJson({
+        {"apiVersion", API_VERSION},
+        {"revision", QString::number(currentRevision)},
+        {"fileCount", row.value(0).toInt()},
+        {"totalSize", row.value(1).toLongLong()},
+        {"totalDuration", row.value(2).toLongLong()}
+    }), '"' + QByteArray::number(currentRevision) + '"'};
+}
+
+LibraryApiService::Response LibraryApiService::search(const QUrlQuery& query)
+{
+    int offset = 0;
+    int limit = 0;
+    if (!parsePaging(query, offset, limit)) {
+        return error(400, "Invalid offset or limit");
+    }
+
+    const QString sort = query.queryItemValue("sort", QUrl::FullyDecoded);
+    const QString order = query.queryItemValue("order", QUrl::FullyDecoded);
+    if ((!sort.isEmpty() && !SEARCH_ORDERS.contains(sort)) || (!order.isEmpty() && order != "asc" && order != "desc")) {
+        return error(400, "Invalid sort");
+    }
+
+    QString from = "media_files m";
+    QString orderBy = SEARCH_ORDERS.value(sort.isEmpty() ? QStringLiteral("title") : sort)
+                          .arg(order == "desc" ? "DESC" : "ASC");
+    QStringList conditions;
+    QVariantList bindValues;
+
+    const QString text = query.queryItemValue("q", QUrl::FullyDecoded);
+    const QString match = DatabaseManager::buildSearchMatch(text);
+    if (!match.isEmpty()) {
+        if (m_dbManager->isSearchIndexAvailable()) {
+            // Ranked like the library's own search unless an order was asked for
+            from = "media_search JOIN media_files m ON m.id = media_search.rowid";
+            if (sort.isEmpty()) {
+                orderBy = "bm25(media_search, 10.0, 8.0, 4.0, 1.0), m.id";
+            }
+            conditions << "media_search MATCH ?";
+            bindValues << match;
+        } else {
+            for (const QString& word : text.split(QLatin1Char(' '), Qt::SkipEmptyParts)) {
+                const QString pattern = QString("%%1%").arg(word);
+                conditions << "(m.title LIKE ? OR m.artist LIKE ? OR m.album LIKE ?)";
+                bindValues << pattern << pattern << pattern;
+            }
+        }
+    }
+
+    // Exact values, as listed by facets
+    for (const char* column : {"artist", "album", "genre"}) {
+        const QString name = QLatin1String(column);
+        if (query.hasQueryItem(name)) {
+            conditions << QString("m.%1 = ?").arg(name);
+            bindValues << query.queryItemValue(name, QUrl::FullyDecoded);
+        }
+    }
+
+    const QString where = conditions.isEmpty() ? QString() : " WHERE " + conditions.join(" AND ");
+    const RowPage page = runPage(m_dbManager,
+        QString("SELECT %1 FROM %2%3 ORDER BY %4 LIMIT ? OFFSET ?").arg(QLatin1String(ITEM_COLUMNS), from, where, orderBy),
+        bindValues, QString("SELECT COUNT(*) FROM %1%2").arg(from, where), bindValues, offset, limit);
+    if (!page.ok) {
+        return error(500, "Search failed");
+    }
+
+    QJsonArray items;
+    for (const QVariantList& row : page.rows) {
+        items.append(itemJson(row));
+    }
+    return {200, toJson(pageJson(page, offset, items)), '"' + QByteArray::number(revision()) + '"'};
+}
+
+LibraryApiService::Response LibraryApiService::facets(const QUrlQuery& query)
+{
+    int offset = 0;
+    int limit = 0;
+    if (!parsePaging(query, offset, limit)) {
+        return error(400, "Invalid offset or limit");
+    }
+
+    const QString facet = query.queryItemValue("facet", QUrl::FullyDecoded);
+    if (!FACETS.contains(facet)) {
+        return error(400, "Unknown facet");
+    }
+
+    const RowPage page = runPage(m_dbManager,
+        "SELECT value, file_count, total_size, total_duration FROM library_aggregates "
+        "WHERE facet = ? AND file_count > 0 ORDER BY value LIMIT ? OFFSET ?",
+        {facet}, "SELECT COUNT(*) FROM library_aggregates WHERE facet = ? AND file_count > 0", {facet},
+        offset, limit);
+    if (!page.ok) {
+        return error(500, "Facet query failed");
+    }
+
+    QJsonArray items;
+    for (const QVariantList& row : page.rows) {
+        items.append(QJsonObject{
+            {"value", row[0].toString()},
+            {"fileCount", row[1].toInt()},
+            {"totalSize", row[2].toLongLong()},
+            {"totalDuration", row[3].toLongLong()}
+        });
+    }
+    return {200, toJson(pageJson(page, offset, items)), '"' + QByteArray::number(revision()) + '"'};
+}
+
+LibraryApiService::Response LibraryApiService::playlists(const QUrlQuery& query)
+{
+    int offset = 0;
+    int limit = 0;
+    if (!parsePaging(query, offset, limit)) {
+        return error(400, "Invalid offset or limit");
+    }
+
+    // Smart playlists keep their current members in playlist_items like any other
+    const RowPage page = runPage(m_dbManager,
+        "SELECT p.id, p.name, p.description, p.item_count, p.total_duration, s.criteria "
+        "FROM playlists p LEFT JOIN smart_playlists s ON s.playlist_id = p.id "
+        "ORDER BY p.name, p.id LIMIT ? OFFSET ?",
+        {}, "SELECT COUNT(*) FROM playlists", {}, offset, limit, QStringLiteral("smart_playlists"));
+    if (!page.ok) {
+        return error(500, "Playlist query failed");
+    }
+
+    QJsonArray items;
+    for (const QVariantList& row : page.rows) {
+        items.append(QJsonObject{
+            {"id", row[0].toInt()},
+            {"name", row[1].toString()},
+            {"description", row[2].toString()},
+            {"itemCount", row[3].toInt()},
+            {"totalDuration", row[4].toLongLong()},
+            {"smart", !row[5].isNull()}
+        });
+    }
+    return {200, toJson(pageJson(page, offset, items)), QByteArray()};
+}
+
+LibraryApiService::Response LibraryApiService::playlistItems(int playlistId, const QUrlQuery& query)
+{
+    int offset = 0;
+    int limit = 0;
+    if (!parsePaging(query, offset, limit)) {
+        return error(400, "Invalid offset or limit");
+    }
+
+    const RowPage page = runPage(m_dbManager,
+        QString("SELECT %1 FROM playlist_items i JOIN media_files m ON m.id = i.media_file_id "
+                "WHERE i.playlist_id = ? ORDER BY i.position LIMIT ? OFFSET ?").arg(QLatin1String(ITEM_COLUMNS)),
+        {playlistId}, "SELECT COUNT(*) FROM playlist_items WHERE playlist_id = ?", {playlistId}, offset, limit);
+    if (!page.ok) {
+        return error(500, "Playlist query failed");
+    }
+
+    QJsonArray items;
+    for (const QVariantList& row : page.rows) {
+        items.append(itemJson(row));
+    }
+    return {200, toJson(pageJson(page, offset, items)), QByteArray()};
+}
+
+LibraryApiService::Response LibraryApiService::progress(const QUrlQuery& query)
+{
+    const QString path = query.queryItemValue("path", QUrl::FullyDecoded);
+    if (path.isEmpty()) {
+        return error(400, "Missing path");
+    }
+
+    const RowPage page = runPage(m_dbManager,
+        "SELECT position, duration, percentage, completed, last_watched, device_id FROM watch_progress "
+        "WHERE file_path = ? LIMIT ? OFFSET ?",
+        {path}, QString(), {}, 0, 1, QStringLiteral("watch_progress"));
+    if (!page.ok) {
+        return error(500, "Progress query failed");
+    }
+    if (page.rows.isEmpty()) {
+        return error(404, "No progress");
+    }
+
+    const QVariantList& row = page.rows.first();
+    return {200, toJson({
+        {"path", path},
+        {"position", row[0].toLongLong()},
+        {"duration", row[1].toLongLong()},
+        {"percentage", row[2].toDouble()},
+        {"completed", row[3].toBool()},
+        {"lastWatched", row[4].toDateTime().toString(Qt::ISODate)},
+        {"deviceId", row[5].toString()}
+    }), QByteArray()};
+}
+
+LibraryApiService::Response LibraryApiService::saveProgress(const QByteArray& body)
+{
+    const QJsonObject request = QJsonDocument::fromJson(body).object();
+    const QString path = request.value("path").toString();
+    const qint64 position = qint64(request.value("position").toDouble(-1));
+    const qint64 duration = qint64(request.value("duration").toDouble(0));
+    const QString deviceId = request.value("deviceId").toString();
+    if (path.isEmpty() || position < 0 || duration < 0 || deviceId.isEmpty()) {
+        return error(400, "Expected path, position, duration and deviceId");
+    }
+
+    // As PlaylistManager saves it; the row's clock moves past every copy so the sync group takes it
+    const double percentage = duration > 0 ? double(position) / duration * 100.0 : 0.0;
+    const bool saved = m_dbManager->executor()->write([=](QSqlDatabase& database) {
+        QSqlQuery query(database);
+        query.prepare(
+            "INSERT OR REPLACE INTO watch_progress "
+            "(file_path, position, duration, last_watched, percentage, completed, device_id, clock, change_seq) "
+            "VALUES (?, ?, ?, ?, ?, ?, ?, "
+            "COALESCE((SELECT clock FROM watch_progress WHERE file_path = ?), 0) + 1, "
+            "COALESCE((SELECT MAX(change_seq) FROM watch_progress), 0) + 1)");
+        query.addBindValue(path);
+        query.addBindValue(position);
+        query.addBindValue(duration);
+        query.addBindValue(QDateTime::currentDateTime());
+        query.addBindValue(percentage);
+        query.addBindValue(percentage >= 90.0);
+        query.addBindValue(deviceId);
+        query.addBindValue(path);
+        if (!query.exec()) {
+            qCWarning(libraryApi) << "Failed to save watch progress:" << query.lastError().text();
+            return false;
+        }
+        return true;
+    }).result();
+
+    return saved ? Response{200, toJson({{"path", path}}), QByteArray()} : error(503, "Progress unavailable");
+}
@@ -0,0 +1,724 @@
+#include "network/MediaShareServer.h"
+#include "network/ContentDirectoryService.h"
+#include "network/LibraryApiService.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMimeDatabase>
+#include <QMutexLocker>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+#include <algorithm>
+#include <memory>
+
+Q_LOGGING_CATEGORY(mediaShareServer, "eonplay.network.share")
+
+namespace {
+// Share id that UPnP media is accounted under in requestServed()
+const QString UPNP_SHARE_ID = QStringLiteral("upnp");
+const QString API_SHARE_ID = QStringLiteral("api");
+
+const QByteArray JSON_CONTENT_TYPE = QByteArrayLiteral("application/json");
+
+const QByteArray XML_CONTENT_TYPE = QByteArrayLiteral("text/xml; charset=\"utf-8\"");
+
+// Streamed, seekable by byte range; some TVs refuse media without these
+const QByteArray DLNA_MEDIA_HEADERS = QByteArrayLiteral(
+    "transferMode.dlna.org: Streaming\r\n"
+    "contentFeatures.dlna.org: DLNA.ORG_OP=01;DLNA.ORG_CI=0;DLNA.ORG_FLAGS=01700000000000000000000000000000\r\n");
+const QByteArray DLNA_IMAGE_HEADERS = QByteArrayLiteral("transferMode.dlna.org: Interactive\r\n");
+}
+
+MediaShareConnection::MediaShareConnection(MediaShareServer* server, qintptr socketDescriptor, bool rejected)
+    : m_server(server)
+    , m_socketDescriptor(socketDescriptor)
+    , m_rejected(rejected)
+{
+}
+
+MediaShareConnection::~MediaShareConnection()
+{
+    releaseFile();
+
+    if (!m_rejected) {
+        m_server->connectionFinished();
+    }
+}
+
+void MediaShareConnection::start()
+{
+    m_socket = new QTcpSocket(this);
+    if (!m_socket->setSocketDescriptor(m_socketDescriptor)) {
+        qCWarning(mediaShareServer) << "Could not take over socket:" << m_socket->errorString();
+        deleteLater();
+        return;
+    }
+
+    m_peerAddress = m_socket->peerAddress().toString();
+
+    connect(m_socket, &QTcpSocket::readyRead, this, &MediaShareConnection::onReadyRead);
+    connect(m_socket, &QTcpSocket::bytesWritten, this, &MediaShareConnection::onBytesWritten);
+    connect(m_socket, &QTcpSocket::disconnected, this, &MediaShareConnection::onDisconnected);
+
+    m_idleTimer = new QTimer(this);
+    m_idleTimer->setSingleShot(true);
+    connect(m_idleTimer, &QTimer::timeout, this, &MediaShareConnection::close);
+
+    if (m_rejected) {
+        qCDebug(mediaShareServer) << "Connection limit reached, rejecting" << m_peerAddress;
+        m_keepAlive = false;
+        sendStatus(503, "Service Unavailable", "Retry-After: 5\r\n");
+        return;
+    }
+
+    qCDebug(mediaShareServer) << "Media share connection from:" << m_peerAddress;
+    m_idleTimer->start(KEEP_ALIVE_TIMEOUT_MS);
+}
+
+void MediaShareConnection::onReadyRead()
+{
+    m_input += m_socket->readAll();
+    processRequests();
+}
+
+void MediaShareConnection::onBytesWritten()
+{
+    if (!m_file) {
+        return;
+    }
+
+    pump();
+
+    // Requests pipelined behind the body that just finished
+    if (!m_file) {
+        processRequests();
+    }
+}
+
+void MediaShareConnection::onDisconnected()
+{
+    releaseFile();
+    deleteLater();
+}
+
+void MediaShareConnection::processRequests()
+{
+    while (!m_file && !m_closing) {
+        const int end = m_input.indexOf("\r\n\r\n");
+        if (end < 0) {
+            if (m_input.size() > MAX_HEADER_BYTES) {
+                m_keepAlive = false;
+                sendStatus(431, "Request Header Fields Too Large");
+            }
+            return;
+        }
+
+        const QByteArray head = m_input.left(end);
+        const qint64 bodyLength = contentLength(head);
+        if (bodyLength < 0 || bodyLength > MAX_BODY_BYTES) {
+            m_keepAlive = false;
+            sendStatus(413, "Content Too Large");
+            return;
+        }
+        if (m_input.size() < end + 4 + bodyLength) {
+            return; // Rest of the body is still on its way
+        }
+
+        const QByteArray body = m_input.mid(end + 4, bodyLength);
+        m_input.remove(0, end + 4 + bodyLength);
+        if (!handleRequest(head, body)) {
+            return;
+        }
+    }
+}
+
+bool MediaShareConnection::handleRequest(const QByteArray& head, const QByteArray& body)
+{
+    m_idleTimer->stop();
+
+    const QList<QByteArray> lines = head.split('\n');
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() != 3) {
+        m_keepAlive = false;
+        sendStatus(400, "Bad Request");
+        return false;
+    }
+
+    const QByteArray method = requestLine[0];
+    const QByteArray target = requestLine[1];
+    const QByteArray version = requestLine[2];
+
+    QHash<QByteArray, QByteArray> headers;
+    for (int i = 1; i < lines.size(); ++i) {
+        const int colon = lines[i].indexOf(':');
+        if (colon > 0) {
+            headers.insert(lines[i].left(colon).trimmed().toLower(), lines[i].mid(colon + 1).trimmed());
+        }
+    }
+
+    // HTTP/1.1 keeps the connection by default, HTTP/1.0 only when asked
+    const QByteArray connection = headers.value("connection").toLower();
+    m_keepAlive = version == "HTTP/1.1" ? connection != "close" : connection == "keep-alive";
+    if (++m_requestCount >= MAX_KEEP_ALIVE_REQUESTS) {
+        m_keepAlive = false;
+    }
+
+    const int query = target.indexOf('?');
+    const QString path = QUrl::fromPercentEncoding(query < 0 ? target : target.left(query));
+
+    if (path.startsWith("/upnp/")) {
+        handleUpnpRequest(method, path, headers, body);
+        return !m_closing;
+    }
+    if (path.startsWith("/api/")) {
+        handleApiRequest(method, path, query < 0 ? QByteArray() : target.mid(query + 1), headers, body);
+        return !m_closing;
+    }
+
+    const bool headOnly = method == "HEAD";
+    if (method != "GET" && !headOnly) {
+        sendStatus(405, "Method Not Allowed", "Allow: GET, HEAD\r\n");
+        return !m_closing;
+    }
+
+    QString shareId;
+    QString localPath;
+    if (!m_server->resolve(path, shareId, localPath)) {
+        sendStatus(404, "Not Found");
+        return !m_closing;
+    }
+
+    if (m_connectedShare != shareId) {
+        m_connectedShare = shareId;
+        emit m_server->shareConnectionReceived(shareId, m_peerAddress);
+    }
+
+    if (QFileInfo(localPath).isDir()) {
+        sendBody(200, "OK", "text/html; charset=utf-8", listingHtml(shareId), headOnly);
+    } else {
+        sendFile(shareId, localPath, headers.value("range"), headOnly);
+    }
+
+    return !m_closing;
+}
+
+void MediaShareConnection::handleUpnpRequest(const QByteArray& method, const QString& path,
+                                             const QHash<QByteArray, QByteArray>& headers, const QByteArray& body)
+{
+    const std::shared_ptr<ContentDirectoryService> service = m_server->contentDirectory();
+    if (!service) {
+        sendStatus(404, "Not Found");
+        return;
+    }
+
+    if (method == "POST") {
+        QString serviceType;
+        if (path == "/upnp/control/ContentDirectory") {
+            serviceType = ContentDirectoryService::CONTENT_DIRECTORY_TYPE;
+        } else if (path == "/upnp/control/ConnectionManager") {
+            serviceType = ContentDirectoryService::CONNECTION_MANAGER_TYPE;
+        } else {
+            sendStatus(404, "Not Found");
+            return;
+        }
+
+        // Browse pages may wait on the database; this worker's other clients wait with them
+        const ContentDirectoryService::Response response =
+            service->control(serviceType, headers.value("soapaction"), body, baseUrl());
+        sendBody(response.status, response.status == 200 ? "OK" : "Internal Server Error", XML_CONTENT_TYPE,
+                 response.body, false);
+        return;
+    }
+
+    const bool headOnly = method == "HEAD";
+    if (method != "GET" && !headOnly) {
+        sendStatus(405, "Method Not Allowed", "Allow: GET, HEAD, POST\r\n");
+        return;
+    }
+
+    if (path == "/upnp/description.xml") {
+        sendBody(200, "OK", XML_CONTENT_TYPE, service->deviceDescription(baseUrl()), headOnly);
+    } else if (path == "/upnp/ContentDirectory.xml") {
+        sendBody(200, "OK", XML_CONTENT_TYPE, ContentDirectoryService::contentDirectoryDescription(), headOnly);
+    } else if (path == "/upnp/ConnectionManager.xml") {
+        sendBody(200, "OK", XML_CONTENT_TYPE, ContentDirectoryService::connectionManagerDescription(), headOnly);
+    } else if (path.startsWith("/upnp/media/") || path.startsWith("/upnp/art/")) {
+        // /upnp/media/<id>.<extension>, /upnp/art/<id>.jpg
+        const bool albumArt = path.startsWith("/upnp/art/");
+        bool valid = false;
+        const int id = path.section('/', -1).section('.', 0, 0).toInt(&valid);
+        const QString localPath = !valid ? QString() : albumArt ? service->albumArtPath(id) : service->mediaPath(id);
+        if (localPath.isEmpty()) {
+            sendStatus(404, "Not Found");
+            return;
+        }
+        sendFile(UPNP_SHARE_ID, localPath, headers.value("range"), headOnly,
+                 albumArt ? DLNA_IMAGE_HEADERS : DLNA_MEDIA_HEADERS);
+    } else {
+        sendStatus(404, "Not Found");
+    }
+}
+
+void MediaShareConnection::handleApiRequest(const QByteArray& method, const QString& path, const QByteArray& query,
+                                            const QHash<QByteArray, QByteArray>& headers, const QByteArray& body)
+{
+    const std::shared_ptr<LibraryApiService> service = m_server->libraryApi();
+    if (!service) {
+        sendStatus(404, "Not Found");
+        return;
+    }
+
+    const QUrlQuery queryItems(QString::fromUtf8(query));
+    const bool headOnly = method == "HEAD";
+
+    // /api/v1/media/<id>, streamed like UPnP media
+    if (path.startsWith("/api/v1/media/")) {
+        if (method != "GET" && !headOnly) {
+            sendStatus(405, "Method Not Allowed", "Allow: GET, HEAD\r\n");
+            return;
+        }
+        if (!service->isAuthorized(headers, queryItems)) {
+            sendStatus(401, "Unauthorized", "WWW-Authenticate: Bearer\r\n");
+            return;
+        }
+        bool valid = false;
+        const int id = path.section('/', -1).toInt(&valid);
+        const QString localPath = valid ? service->mediaPath(id) : QString();
+        if (localPath.isEmpty()) {
+            sendStatus(404, "Not Found");
+            return;
+        }
+        sendFile(API_SHARE_ID, localPath, headers.value("range"), headOnly);
+        return;
+    }
+
+    // Queries may wait on the database; this worker's other clients wait with them
+    const LibraryApiService::Response response = service->handle(method, path, queryItems, headers, body);
+    const QByteArray etagHeader = response.etag.isEmpty() ? QByteArray() : "ETag: " + response.etag + "\r\n";
+    switch (response.status) {
+    case 200:
+        sendBody(200, "OK", JSON_CONTENT_TYPE, response.body, headOnly, etagHeader);
+        break;
+    case 304:
+        sendStatus(304, "Not Modified", etagHeader);
+        break;
+    case 400:
+        sendBody(400, "Bad Request", JSON_CONTENT_TYPE, response.body, headOnly);
+        break;
+    case 401:
+        sendBody(401, "Unauthorized", JSON_CONTENT_TYPE, response.body, headOnly, "WWW-Authenticate: Bearer\r\n");
+        break;
+    case 404:
+        sendBody(404, "Not Found", JSON_CONTENT_TYPE, response.body, headOnly);
+        break;
+    case 405:
+        sendStatus(405, "Method Not Allowed", "Allow: GET, HEAD, POST\r\n");
+        break;
+    case 503:
+        sendBody(503, "Service Unavailable", JSON_CONTENT_TYPE, response.body, headOnly);
+        break;
+    default:
+        sendBody(500, "Internal Server Error", JSON_CONTENT_TYPE, response.body, headOnly);
+        break;
+    }
+}
+
+void MediaShareConnection::sendFile(const QString& shareId, const QString& localPath,
+                                    const QByteArray& rangeHeader, bool headOnly, const QByteArray& extraHeaders)
+{
+    auto file = std::make_unique<QFile>(localPath);
+    if (!file->open(QIODevice::ReadOnly)) {
+        sendStatus(403, "Forbidden");
+        return;
+    }
+
+    const qint64 size = file->size();
+    ByteRange range{0, size};
+    const RangeResult rangeResult = parseRange(rangeHeader, size, range);
+    if (rangeResult == RangeResult::Unsatisfiable) {
+        sendStatus(416, "Range Not Satisfiable", QByteArray("Content-Range: bytes */") + QByteArray::number(size) + "\r\n");
+        return;
+    }
+
+    // Extension only; sniffing the content would read the file on every request
+    QMimeDatabase mimeDatabase;
+    const QString mimeType = mimeDatabase.mimeTypeForFile(localPath, QMimeDatabase::MatchExtension).name();
+
+    QByteArray headers;
+    headers += "Content-Type: " + mimeType.toUtf8() + "\r\n";
+    headers += "Content-Length: " + QByteArray::number(range.length) + "\r\n";
+    headers += "Accept-Ranges: bytes\r\n";
+    headers += extraHeaders;
+
+    if (rangeResult == RangeResult::Satisfiable) {
+        headers += "Content-Range: bytes " + QByteArray::number(range.start) + "-" +
+                   QByteArray::number(range.start + range.length - 1) + "/" + QByteArray::number(size) + "\r\n";
+        writeHead(206, "Partial Content", headers);
+    } else {
+        writeHead(200, "OK", headers);
+    }
+
+    if (headOnly || range.length == 0) {
+        finishResponse();
+        return;
+    }
+
+    m_file = file.release();
+    m_shareId = shareId;
+    m_offset = range.start;
+    m_remaining = range.length;
+    m_bytesSent = 0;
+
+    pump();
+}
+
+void MediaShareConnection::sendStatus(int status, const QByteArray& reason, const QByteArray& extraHeaders)
+{
+    writeHead(status, reason, extraHeaders + "Content-Length: 0\r\n");
+    finishResponse();
+}
+
+void MediaShareConnection::sendBody(int status, const QByteArray& reason, const QByteArray& contentType,
+                                    const QByteArray& body, bool headOnly, const QByteArray& extraHeaders)
+{
+    writeHead(status, reason, "Content-Type: " + contentType + "\r\nContent-Length: " +
+                                  QByteArray::number(body.size()) + "\r\n" + extraHeaders);
+    if (!headOnly) {
+        m_socket->write(body);
+    }
+    finishResponse();
+}
+
+void MediaShareConnection::writeHead(int status, const QByteArray& reason, const QByteArray& headers)
+{
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(status) + " " + reason + "\r\n" + headers;
+    if (m_keepAlive) {
+        head += "Connection: keep-alive\r\nKeep-Alive: timeout=" + QByteArray::number(KEEP_ALIVE_TIMEOUT_MS / 1000) + "\r\n";
+    } else {
+        head += "Connection: close\r\n";
+    }
+    head += "\r\n";
+
+    m_socket->write(head);
+}
+
+void MediaShareConnection::pump()
+{
+    // Backpressure: top the send buffer up, bytesWritten() brings us back
+    while (m_remaining > 0 && m_socket->bytesToWrite() < HIGH_WATER_BYTES) {
+        if (!m_window || m_offset >= m_windowStart + m_windowSize) {
+            if (m_window) {
+                m_file->unmap(m_window);
+            }
+            m_windowStart = m_offset;
+            m_windowSize = std::min(WINDOW_BYTES, m_remaining);
+            m_window = m_file->map(m_windowStart, m_windowSize);
+            if (!m_window) {
+                // Headers are out, the only honest signal left is closing early
+                qCWarning(mediaShareServer) << "Could not map" << m_file->fileName() << m_file->errorString();
+                close();
+                return;
+            }
+        }
+
+        const qint64 slice = std::min({SLICE_BYTES, m_remaining, m_windowStart + m_windowSize - m_offset});
+        const qint64 written = m_socket->write(reinterpret_cast<const char*>(m_window + (m_offset - m_windowStart)), slice);
+        if (written <= 0) {
+            close();
+            return;
+        }
+
+        m_offset += written;
+        m_remaining -= written;
+        m_bytesSent += written;
+    }
+
+    if (m_remaining == 0) {
+        finishResponse();
+    }
+}
+
+void MediaShareConnection::finishResponse()
+{
+    releaseFile();
+
+    if (!m_keepAlive) {
+        close();
+        return;
+    }
+
+    m_idleTimer->start(KEEP_ALIVE_TIMEOUT_MS);
+}
+
+void MediaShareConnection::releaseFile()
+{
+    if (!m_file) {
+        return;
+    }
+
+    if (m_window) {
+        m_file->unmap(m_window);
+        m_window = nullptr;
+    }
+    m_windowSize = 0;
+
+    delete m_file;
+    m_file = nullptr;
+    m_remaining = 0;
+
+    emit m_server->requestServed(m_shareId, m_bytesSent);
+}
+
+void MediaShareConnection::close()
+{
+    if (m_closing) {
+        return;
+    }
+    m_closing = true;
+
+    releaseFile();
+    m_idleTimer->stop();
+
+    // Pending response bytes are still flushed before the socket closes
+    m_socket->disconnectFromHost();
+    if (m_socket->state() == QAbstractSocket::UnconnectedState) {
+        deleteLater();
+    }
+}
+
+QByteArray MediaShareConnection::listingHtml(const QString& shareId)
+{
+    return QString(
+        "<html><head><title>EonPlay Media Share</title></head>"
+        "<body><h1>Media Share: %1</h1>"
+        "<p>Media files available for streaming</p>"
+        "</body></html>"
+    ).arg(shareId.toHtmlEscaped()).toUtf8();
+}
+
+QString MediaShareConnection::baseUrl() const
+{
+    // Dual-stack listeners see IPv4 clients as IPv4-mapped IPv6 addresses
+    const QHostAddress local = m_socket->localAddress();
+    bool isIPv4 = false;
+    const quint32 ipv4 = local.toIPv4Address(&isIPv4);
+    const QString host = isIPv4 ? QHostAddress(ipv4).toString() : "[" + local.toString() + "]";
+    return QString("http://%1:%2").arg(host).arg(m_socket->localPort());
+}
+
+qint64 MediaShareConnection::contentLength(const QByteArray& head)
+{
+    const QList<QByteArray> lines = head.split('\n');
+    for (int i = 1; i < lines.size(); ++i) {
+        const int colon = lines[i].indexOf(':');
+        if (colon > 0 && lines[i].left(colon).trimmed().toLower() == "content-length") {
+            bool ok = false;
+            const qint64 length = lines[i].mid(colon + 1).trimmed().toLongLong(&ok);
+            return ok && length >= 0 ? length : -1;
+        }
+    }
+    return 0;
+}
+
+MediaShareConnection::RangeResult MediaShareConnection::parseRange(const QByteArray& header, qint64 size, ByteRange& range)
+{
+    // Only a single range is served; anything else gets the whole file
+    if (!header.startsWith("bytes=") || header.contains(',')) {
+        return RangeResult::None;
+    }
+
+    const QByteArray spec = header.mid(6).trimmed();
+    const int dash = spec.indexOf('-');
+    if (dash < 0) {
+        return RangeResult::None;
+    }
+
+    const QByteArray first = spec.left(dash).trimmed();
+    const QByteArray last = spec.mid(dash + 1).trimmed();
+    bool ok = false;
+
+    // bytes=-N is the last N bytes
+    if (first.isEmpty()) {
+        const qint64 suffix = last.toLongLong(&ok);
+        if (!ok) {
+            return RangeResult::None;
+        }
+        if (suffix <= 0 || size == 0) {
+            return RangeResult::Unsatisfiable;
+        }
+        range.start = std::max<qint64>(0, size - suffix);
+        range.length = size - range.start;
+        return RangeResult::Satisfiable;
+    }
+
+    const qint64 start = first.toLongLong(&ok);
+    if (!ok || start < 0) {
+        return RangeResult::None;
+    }
+    if (start >= size) {
+        return RangeResult::Unsatisfiable;
+    }
+
+    qint64 end = size - 1;
+    if (!last.isEmpty()) {
+        end = last.toLongLong(&ok);
+        if (!ok || end < start) {
+            return RangeResult::None;
+        }
+        end = std::min(end, size - 1);
+    }
+
+    range.start = start;
+    range.length = end - start + 1;
+    return RangeResult::Satisfiable;
+}
+
+MediaShareServer::MediaShareServer(QObject* parent)
+    : QTcpServer(parent)
+    , m_maxConnections(DEFAULT_MAX_CONNECTIONS)
+{
+}
+
+MediaShareServer::~MediaShareServer()
+{
+    shutdown();
+}
+
+void MediaShareServer::addShare(const QString& shareId, const QString& rootPath)
+{
+    const QString root = QFileInfo(rootPath).canonicalFilePath();
+    if (root.isEmpty()) {
+        qCWarning(mediaShareServer) << "Share root does not exist:" << rootPath;
+        return;
+    }
+
+    QMutexLocker locker(&m_shareMutex);
+    m_shareRoots.insert(shareId, root);
+}
+
+void MediaShareServer::removeShare(const QString& shareId)
+{
+    QMutexLocker locker(&m_shareMutex);
+    m_shareRoots.remove(shareId);
+}
+
+void MediaShareServer::setContentDirectory(std::shared_ptr<ContentDirectoryService> contentDirectory)
+{
+    QMutexLocker locker(&m_shareMutex);
+    m_contentDirectory = std::move(contentDirectory);
+}
+
+std::shared_ptr<ContentDirectoryService> MediaShareServer::contentDirectory() const
+{
+    QMutexLocker locker(&m_shareMutex);
+    return m_contentDirectory;
+}
+
+void MediaShareServer::setLibraryApi(std::shared_ptr<LibraryApiService> libraryApi)
+{
+    QMutexLocker locker(&m_shareMutex);
+    m_libraryApi = std::move(libraryApi);
+}
+
+std::shared_ptr<LibraryApiService> MediaShareServer::libraryApi() const
+{
+    QMutexLocker locker(&m_shareMutex);
+    return m_libraryApi;
+}
+
+void MediaShareServer::setMaxConnections(int maxConnections)
+{
+    m_maxConnections = std::max(1, maxConnections);
+
+    // A larger limit may use more workers right away; a smaller one only limits connections
+    if (!m_workers.isEmpty()) {
+        startWorkers();
+    }
+}
+
+void MediaShareServer::shutdown()
+{
+    close();
+    stopWorkers();
+}
+
+bool MediaShareServer::resolve(const QString& requestPath, QString& shareId, QString& localPath) const
+{
+    if (!requestPath.startsWith('/')) {
+        return false;
+    }
+
+    const int separator = requestPath.indexOf('/', 1);
+    const QString id = requestPath.mid(1, separator < 0 ? -1 : separator - 1);
+
+    QString root;
+    {
+        QMutexLocker locker(&m_shareMutex);
+        root = m_shareRoots.value(id);
+    }
+    if (root.isEmpty()) {
+        return false;
+    }
+
+    const QString relative = separator < 0 ? QString() : requestPath.mid(separator + 1);
+    const QString canonical = QFileInfo(QDir(root).filePath(relative)).canonicalFilePath();
+
+    // Symlinks and ".." must not lead out of the share
+    if (canonical.isEmpty() || (canonical != root && !canonical.startsWith(root + '/'))) {
+        return false;
+    }
+
+    shareId = id;
+    localPath = canonical;
+    return true;
+}
+
+void MediaShareServer::incomingConnection(qintptr socketDescriptor)
+{
+    if (m_workers.isEmpty()) {
+        startWorkers();
+    }
+
+    const bool rejected = m_connectionCount >= m_maxConnections;
+    if (!rejected) {
+        ++m_connectionCount;
+    }
+
+    auto* connection = new MediaShareConnection(this, socketDescriptor, rejected);
+    QThread* worker = m_workers[m_nextWorker++ % m_workers.size()];
+    connection->moveToThread(worker);
+    connect(worker, &QThread::finished, connection, &QObject::deleteLater);
+    QMetaObject::invokeMethod(connection, &MediaShareConnection::start, Qt::QueuedConnection);
+}
+
+void MediaShareServer::connectionFinished()
+{
+    --m_connectionCount;
+}
+
+void MediaShareServer::startWorkers()
+{
+    const int count = std::clamp(QThread::idealThreadCount(), 1, m_maxConnections);
+    while (m_workers.size() < count) {
+        QThread* worker = new QThread(this);
+        worker->setObjectName(QString("MediaShareWorker%1").arg(m_workers.size()));
+        worker->start();
+        m_workers.append(worker);
+    }
+}
+
+void MediaShareServer::stopWorkers()
+{
+    // Connections are deleted as their thread finishes
+    for (QThread* worker : std::as_const(m_workers)) {
+        worker->quit();
+        worker->wait();
+        delete worker;
+    }
+    m_workers.clear();
+    m_nextWorker = 0;
+}
@@ -1,8 +1,11 @@
 #include "network/NetworkDiscoveryManager.h"
+#include "network/NetworkService.h"
+#include "network/ContentDirectoryService.h"
+#include "network/LibraryApiService.h"
+#include "data/LibraryManager.h"
 #include <QUdpSocket>
 #include <QTcpServer>
 #include <QTcpSocket>
-#include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QTimer>
@@ -20,26 +23,69 @@
 #include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
-#include <QMimeDatabase>
 #include <QLoggingCategory>
+#include <QDataStream>
+#include <QNetworkInterface>
+#include <QSysInfo>
+#include <QtEndian>
 
 Q_LOGGING_CATEGORY(networkDiscovery, "eonplay.network.discovery")
 
 // Constants
 const QString NetworkDiscoveryManager::UPNP_MULTICAST_ADDRESS = "239.255.255.250";
 
+namespace {
+
+// Header names upper-cased; SSDP headers are case-insensitive
+QMap<QByteArray, QByteArray> parseSsdpHeaders(const QByteArray& data)
+{
+    QMap<QByteArray, QByteArray> headers;
+    const QList<QByteArray> lines = data.split('\n');
+    for (int i = 1; i < lines.size(); ++i) {
+        const int colon = lines[i].indexOf(':');
+        if (colon > 0) {
+            headers.insert(lines[i].left(colon).trimmed().toUpper(), lines[i].mid(colon + 1).trimmed());
+        }
+    }
+    return headers;
+}
+
+// "uuid:device-UUID::urn:..." names one of the device's services; the device is the part before "::"
+QString udnOfUsn(const QByteArray& usn)
+{
+    const int separator = usn.indexOf("::");
+    return QString::fromUtf8(separator < 0 ? usn : usn.left(separator));
+}
+
+int ssdpMaxAgeSeconds(const QByteArray& cacheControl, int fallback)
+{
+    for (const QByteArray& directive : cacheControl.split(',')) {
+        const QByteArray trimmed = directive.trimmed();
+        if (trimmed.toLower().startsWith("max-age")) {
+            bool ok = false;
+            const int seconds = trimmed.mid(trimmed.indexOf('=') + 1).trimmed().toInt(&ok);
+            if (ok && seconds > 0) {
+                return seconds;
+            }
+        }
+    }
+    return fallback;
+}
+
+} // namespace
+
 NetworkDiscoveryManager::NetworkDiscoveryManager(QObject *parent)
     : QObject(parent)
     , m_udpSocket(std::make_unique<QUdpSocket>(this))
-    , m_mediaShareServer(std::make_unique<QTcpServer>(this))
+    , m_mediaShareServer(std::make_unique<MediaShareServer>(this))
     , m_syncServer(std::make_unique<QTcpServer>(this))
-    , m_networkManager(std::make_unique<QNetworkAccessManager>(this))
     , m_discoveryState(DISCOVERY_IDLE)
     , m_discoveryTimer(new QTimer(this))
     , m_deviceTimeoutTimer(new QTimer(this))
     , m_autoDiscoveryEnabled(true)
     , m_mediaSharePort(DEFAULT_MEDIA_SHARE_PORT)
     , m_maxConnections(DEFAULT_MAX_CONNECTIONS)
+    , m_ssdpAnnounceTimer(new QTimer(this))
     , m_syncPort(DEFAULT_SYNC_PORT)
     , m_discoveryInterval(DEFAULT_DISCOVERY_INTERVAL_MS)
     , m_discoveryTimeout(DEFAULT_DISCOVERY_TIMEOUT_MS)
@@ -55,6 +101,8 @@ NetworkDiscoveryManager::NetworkDiscoveryManager(QObject *parent)
 
 NetworkDiscoveryManager::~NetworkDiscoveryManager()
 {
+    unpublishLibrary();
+    unpublishLibraryApi();
     stopDiscovery();
     // stopBluetoothDiscovery(); // Temporarily disabled
     
@@ -83,10 +131,6 @@ void NetworkDiscoveryManager::setupNetworkComponents()
     m_deviceTimeoutTimer->setInterval(30000); // Check every 30 seconds
     connect(m_deviceTimeoutTimer, &QTimer::timeout,
             this, &NetworkDiscoveryManager::onDeviceTimeoutTimerTimeout);
-    
-    // Setup network manager
-    connect(m_networkManager.get(), &QNetworkAccessManager::finished,
-            this, &NetworkDiscoveryManager::onNetworkReplyFinished);
 }
 
 // Bluetooth setup temporarily disabled for build compatibility
@@ -111,12 +155,75 @@ void NetworkDiscoveryManager::setupBluetoothDiscovery()
 
 void NetworkDiscoveryManager::setupMediaShareServer()
 {
-    connect(m_mediaShareServer.get(), &QTcpServer::newConnection,
-            this, &NetworkDiscoveryManager::onTcpServerNewConnection);
+    // Requests are served on the server's worker threads; statistics come back queued
+    m_mediaShareServer->setMaxConnections(m_maxConnections);
+    connect(m_mediaShareServer.get(), &MediaShareServer::shareConnectionReceived,
+            this, &NetworkDiscoveryManager::onMediaShareConnectionReceived);
+    connect(m_mediaShareServer.get(), &MediaShareServer::requestServed,
+            this, &NetworkDiscoveryManager::onMediaShareRequestServed);
+    
+    // Announcements expire after SSDP_MAX_AGE_S, so they are renewed at half of it
+    m_ssdpAnnounceTimer->setInterval(SSDP_MAX_AGE_S * 1000 / 2);
+    connect(m_ssdpAnnounceTimer, &QTimer::timeout, this, [this]() {
+        sendSsdpNotify("ssdp:alive");
+    });
+}
+
+bool NetworkDiscoveryManager::ensureMediaShareServer()
+{
+    if (m_mediaShareServer->isListening()) {
+        return true;
+    }
+    
+    if (!m_mediaShareServer->listen(QHostAddress::Any, m_mediaSharePort)) {
+        qCWarning(networkDiscovery) << "Failed to start media share server on port" << m_mediaSharePort;
+        return false;
+    }
+    return true;
+}
+
+void NetworkDiscoveryManager::shutdownMediaShareServerIfIdle()
+{
+    if (m_contentDirectory || m_libraryApi || !m_mediaShareServer->isListening()) {
+        return;
+    }
+    
+    for (const auto& share : m_mediaShares) {
+        if (share.isActive) {
+            return;
+        }
+    }
+    
+    m_mediaShareServer->shutdown();
 }
 
 void NetworkDiscoveryManager::setupSyncServer()
 {
+    // Each connection carries length-prefixed frames from one peer
+    connect(m_syncServer.get(), &QTcpServer::newConnection, this, [this]() {
+        while (QTcpSocket* socket = m_syncServer->nextPendingConnection()) {
+            auto buffer = std::make_shared<QByteArray>();
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket, buffer]() {
+                buffer->append(socket->readAll());
+                while (buffer->size() >= 4) {
+                    const quint32 length = qFromBigEndian<quint32>(buffer->constData());
+                    if (length > quint32(MAX_SYNC_FRAME_BYTES)) {
+                        qCWarning(networkDiscovery) << "Dropping oversized sync frame from" << socket->peerAddress();
+                        socket->abort();
+                        return;
+                    }
+                    if (buffer->size() < qsizetype(4 + length)) {
+                        break;
+                    }
+                    const QByteArray frame = buffer->mid(4, length);
+                    buffer->remove(0, 4 + length);
+                    handleSyncMessage(frame, socket->peerAddress());
+                }
+            });
+        }
+    });
+    
     if (!m_syncServer->listen(QHostAddress::Any, m_syncPort)) {
         qCWarning(networkDiscovery) << "Failed to start sync server on port" << m_syncPort;
     } else {
@@ -140,6 +247,18 @@ void NetworkDiscoveryManager::startDiscovery()
         return;
     }
     
+    // Devices announce themselves and their departure to the multicast group
+    m_notifySocket = std::make_unique<QUdpSocket>(this);
+    if (m_notifySocket->bind(QHostAddress::AnyIPv4, UPNP_MULTICAST_PORT,
+                             QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint) &&
+        m_notifySocket->joinMulticastGroup(QHostAddress(UPNP_MULTICAST_ADDRESS))) {
+        connect(m_notifySocket.get(), &QUdpSocket::readyRead, this, &NetworkDiscoveryManager::onNotifySocketReadyRead);
+    } else {
+        qCWarning(networkDiscovery) << "Not receiving SSDP announcements, searching only:"
+                                    << m_notifySocket->errorString();
+        m_notifySocket.reset();
+    }
+    
     // Start UPnP discovery
     startUPnPDiscovery();
     
@@ -176,8 +295,9 @@ void NetworkDiscoveryManager::stopDiscovery()
     // Stop Bluetooth discovery - temporarily disabled
     // stopBluetoothDiscovery();
     
-    // Close UDP socket
+    // Close UDP sockets
     m_udpSocket->close();
+    m_notifySocket.reset();
     
     qCDebug(networkDiscovery) << "Network discovery stopped";
 }
@@ -242,43 +362,77 @@ void NetworkDiscoveryManager::onUdpSocketReadyRead()
 
 void NetworkDiscoveryManager::processUPnPResponse(const QByteArray& data, const QHostAddress& sender)
 {
-    QString response = QString::fromUtf8(data);
+    Q_UNUSED(sender)
     
-    // Parse HTTP response headers
-    QStringList lines = response.split("\r\n");
-    if (lines.isEmpty() || !lines[0].startsWith("HTTP/1.1 200 OK")) {
+    if (!data.startsWith("HTTP/1.1 200 OK")) {
         return; // Not a valid response
     }
+    handleSsdpAlive(parseSsdpHeaders(data));
+}
+
+void NetworkDiscoveryManager::processSsdpNotify(const QByteArray& data)
+{
+    const QMap<QByteArray, QByteArray> headers = parseSsdpHeaders(data);
+    const QByteArray subType = headers.value("NTS");
+    
+    if (subType == "ssdp:alive") {
+        handleSsdpAlive(headers);
+    } else if (subType == "ssdp:byebye") {
+        const QString udn = udnOfUsn(headers.value("USN"));
+        const auto cached = m_descriptionCache.constFind(udn);
+        const QString deviceId = cached != m_descriptionCache.constEnd() && !cached->deviceId.isEmpty()
+                                     ? cached->deviceId : udn;
+        m_descriptionCache.remove(udn);
+        removeDevice(deviceId);
+    }
+    // ssdp:update announces the next BOOTID; the alive that follows carries it
+}
+
+void NetworkDiscoveryManager::handleSsdpAlive(const QMap<QByteArray, QByteArray>& headers)
+{
+    const QString location = QString::fromUtf8(headers.value("LOCATION"));
+    const QString udn = udnOfUsn(headers.value("USN"));
+    if (location.isEmpty() || udn.isEmpty()) {
+        return;
+    }
     
-    QString location;
-    QString server;
-    QString usn;
-    QString st;
-    
-    for (const QString& line : lines) {
-        if (line.startsWith("LOCATION:", Qt::CaseInsensitive)) {
-            location = line.mid(9).trimmed();
-        } else if (line.startsWith("SERVER:", Qt::CaseInsensitive)) {
-            server = line.mid(7).trimmed();
-        } else if (line.startsWith("USN:", Qt::CaseInsensitive)) {
-            usn = line.mid(4).trimmed();
-        } else if (line.startsWith("ST:", Qt::CaseInsensitive)) {
-            st = line.mid(3).trimmed();
-        }
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const qint64 expiresAt = now + qint64(ssdpMaxAgeSeconds(headers.value("CACHE-CONTROL"), SSDP_MAX_AGE_S)) * 1000;
+    const QByteArray bootId = headers.value("BOOTID.UPNP.ORG");
+    const QByteArray configId = headers.value("CONFIGID.UPNP.ORG");
+    
+    // A device answers once per search target and announces every service;
+    // the description only changes with its location, boot or configuration
+    auto cached = m_descriptionCache.find(udn);
+    if (cached != m_descriptionCache.end() && cached->location == location && cached->bootId == bootId &&
+        cached->configId == configId && m_discoveredDevices.contains(cached->deviceId)) {
+        cached->expiresAt = qMax(cached->expiresAt, expiresAt);
+        m_deviceLastSeen[cached->deviceId] = now;
+        m_discoveredDevices[cached->deviceId].lastSeen = now;
+        return;
     }
     
-    if (!location.isEmpty()) {
-        parseUPnPDevice(location);
+    CachedDescription& entry = m_descriptionCache[udn];
+    entry.location = location;
+    entry.bootId = bootId;
+    entry.configId = configId;
+    entry.expiresAt = expiresAt;
+    
+    if (!m_pendingDescriptions.contains(location)) {
+        m_pendingDescriptions.insert(location);
+        parseUPnPDevice(location, udn);
     }
 }
 
-void NetworkDiscoveryManager::parseUPnPDevice(const QString& descriptionUrl)
+void NetworkDiscoveryManager::parseUPnPDevice(const QString& descriptionUrl, const QString& udn)
 {
     QNetworkRequest request(descriptionUrl);
     request.setRawHeader("User-Agent", "EonPlay/1.0 UPnP/1.0");
     
-    QNetworkReply* reply = m_networkManager->get(request);
+    QNetworkReply* reply = NetworkService::instance().get(request, NetworkService::RequestClass::Metadata);
     reply->setProperty("descriptionUrl", descriptionUrl);
+    reply->setProperty("udn", udn);
+    connect(reply, &QNetworkReply::finished, this, &NetworkDiscoveryManager::onNetworkReplyFinished);
 }
 
 void NetworkDiscoveryManager::onNetworkReplyFinished()
@@ -286,21 +440,26 @@ void NetworkDiscoveryManager::onNetworkReplyFinished()
     QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
     if (!reply) return;
     
-    if (reply->error() == QNetworkReply::NoError) {
-        QString descriptionUrl = reply->property("descriptionUrl").toString();
-        if (!descriptionUrl.isEmpty()) {
-            QByteArray xml = reply->readAll();
-            
-            NetworkDevice device;
-            device.address = QHostAddress(reply->url().host());
-            device.port = reply->url().port(80);
-            device.descriptionUrl = QUrl(descriptionUrl);
-            
-            parseDeviceDescription(xml, device);
-            
-            if (!device.id.isEmpty()) {
-                addOrUpdateDevice(device);
-            }
+    const QString descriptionUrl = reply->property("descriptionUrl").toString();
+    m_pendingDescriptions.remove(descriptionUrl);
+    
+    // Said byebye or moved while the description was on its way
+    const auto cached = m_descriptionCache.find(reply->property("udn").toString());
+    const bool current = cached != m_descriptionCache.end() && cached->location == descriptionUrl;
+    
+    if (reply->error() == QNetworkReply::NoError && current) {
+        QByteArray xml = reply->readAll();
+        
+        NetworkDevice device;
+        device.address = QHostAddress(reply->url().host());
+        device.port = reply->url().port(80);
+        device.descriptionUrl = QUrl(descriptionUrl);
+        
+        parseDeviceDescription(xml, device);
+        
+        if (!device.id.isEmpty()) {
+            cached->deviceId = device.id;
+            addOrUpdateDevice(device);
         }
     }
     
@@ -392,6 +551,13 @@ void NetworkDiscoveryManager::removeDevice(const QString& deviceId)
     if (m_discoveredDevices.contains(deviceId)) {
         m_discoveredDevices.remove(deviceId);
         m_deviceLastSeen.remove(deviceId);
+        for (auto it = m_descriptionCache.begin(); it != m_descriptionCache.end();) {
+            if (it->deviceId == deviceId) {
+                it = m_descriptionCache.erase(it);
+            } else {
+                ++it;
+            }
+        }
         emit deviceLost(deviceId);
         qCDebug(networkDiscovery) << "Device lost:" << deviceId;
     }
@@ -402,8 +568,17 @@ void NetworkDiscoveryManager::checkDeviceTimeouts()
     qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
     QStringList devicesToRemove;
     
+    // UPnP devices last as long as their announced max-age, the rest m_deviceTimeout
+    QMap<QString, qint64> announcedExpiry;
+    for (const CachedDescription& cached : m_descriptionCache) {
+        if (!cached.deviceId.isEmpty()) {
+            announcedExpiry[cached.deviceId] = qMax(announcedExpiry.value(cached.deviceId), cached.expiresAt);
+        }
+    }
+    
     for (auto it = m_deviceLastSeen.constBegin(); it != m_deviceLastSeen.constEnd(); ++it) {
-        if (currentTime - it.value() > m_deviceTimeout) {
+        const qint64 expiresAt = announcedExpiry.value(it.key(), it.value() + m_deviceTimeout);
+        if (currentTime > expiresAt) {
             devicesToRemove.append(it.key());
         }
     }
@@ -563,13 +738,11 @@ bool NetworkDiscoveryManager::startMediaShare(const QString& shareId)
 {
     if (!m_mediaShares.contains(shareId)) return false;
     
-    if (!m_mediaShareServer->isListening()) {
-        if (!m_mediaShareServer->listen(QHostAddress::Any, m_mediaSharePort)) {
-            qCWarning(networkDiscovery) << "Failed to start media share server on port" << m_mediaSharePort;
-            return false;
-        }
+    if (!ensureMediaShareServer()) {
+        return false;
     }
     
+    m_mediaShareServer->addShare(shareId, m_mediaShares[shareId].rootPath);
     m_mediaShares[shareId].isActive = true;
     emit mediaShareStarted(shareId);
     
@@ -581,138 +754,294 @@ bool NetworkDiscoveryManager::stopMediaShare(const QString& shareId)
 {
     if (!m_mediaShares.contains(shareId)) return false;
     
+    m_mediaShareServer->removeShare(shareId);
     m_mediaShares[shareId].isActive = false;
     emit mediaShareStopped(shareId);
     
-    // Check if any shares are still active
-    bool anyActive = false;
-    for (const auto& share : m_mediaShares.values()) {
-        if (share.isActive) {
-            anyActive = true;
-            break;
-        }
+    // Stop server if no shares are active and the library is not published
+    shutdownMediaShareServerIfIdle();
+    
+    qCDebug(networkDiscovery) << "Media share stopped:" << shareId;
+    return true;
+}
+
+void NetworkDiscoveryManager::onMediaShareConnectionReceived(const QString& shareId, const QString& clientAddress)
+{
+    if (m_mediaShares.contains(shareId)) {
+        m_mediaShares[shareId].connectionCount++;
     }
     
-    // Stop server if no shares are active
-    if (!anyActive && m_mediaShareServer->isListening()) {
-        m_mediaShareServer->close();
+    qCDebug(networkDiscovery) << "Media share connection from:" << clientAddress << "to" << shareId;
+    emit mediaShareConnectionReceived(shareId, clientAddress);
+}
+
+void NetworkDiscoveryManager::onMediaShareRequestServed(const QString& shareId, qint64 bytes)
+{
+    if (m_mediaShares.contains(shareId)) {
+        m_mediaShares[shareId].bytesServed += bytes;
+    }
+}
+
+// Library as a UPnP MediaServer
+bool NetworkDiscoveryManager::publishLibrary(EonPlay::Data::LibraryManager* library)
+{
+    if (m_contentDirectory) {
+        return true;
+    }
+    if (!library || !library->isInitialized()) {
+        return false;
     }
     
-    qCDebug(networkDiscovery) << "Media share stopped:" << shareId;
+    if (!ensureMediaShareServer()) {
+        return false;
+    }
+    
+    // Other UPnP stacks on this machine share the port
+    m_ssdpSocket = std::make_unique<QUdpSocket>(this);
+    if (!m_ssdpSocket->bind(QHostAddress::AnyIPv4, UPNP_MULTICAST_PORT,
+                            QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint) ||
+        !m_ssdpSocket->joinMulticastGroup(QHostAddress(UPNP_MULTICAST_ADDRESS))) {
+        qCWarning(networkDiscovery) << "Failed to join SSDP multicast group:" << m_ssdpSocket->errorString();
+        m_ssdpSocket.reset();
+        shutdownMediaShareServerIfIdle();
+        return false;
+    }
+    connect(m_ssdpSocket.get(), &QUdpSocket::readyRead, this, &NetworkDiscoveryManager::onSsdpSocketReadyRead);
+    
+    const QString friendlyName = QString("EonPlay (%1)").arg(QSysInfo::machineHostName());
+    m_contentDirectory = std::make_shared<ContentDirectoryService>(library->databaseManager(), friendlyName);
+    m_mediaShareServer->setContentDirectory(m_contentDirectory);
+    
+    std::weak_ptr<ContentDirectoryService> contentDirectory = m_contentDirectory;
+    m_libraryChangedConnection = connect(library, &EonPlay::Data::LibraryManager::libraryChanged, this,
+                                         [contentDirectory]() {
+        if (auto service = contentDirectory.lock()) {
+            service->notifyLibraryChanged();
+        }
+    });
+    
+    sendSsdpNotify("ssdp:alive");
+    m_ssdpAnnounceTimer->start();
+    
+    qCInfo(networkDiscovery) << "Library published as UPnP MediaServer" << friendlyName
+                             << "on port" << m_mediaShareServer->serverPort();
     return true;
 }
 
-void NetworkDiscoveryManager::onTcpServerNewConnection()
+void NetworkDiscoveryManager::unpublishLibrary()
 {
-    while (m_mediaShareServer->hasPendingConnections()) {
-        QTcpSocket* socket = m_mediaShareServer->nextPendingConnection();
-        
-        connect(socket, &QTcpSocket::readyRead, [this, socket]() {
-            handleMediaShareRequest(socket);
-        });
-        
-        connect(socket, &QTcpSocket::disconnected, [this, socket]() {
-            m_activeConnections.remove(socket);
-            socket->deleteLater();
-        });
-        
-        QString clientAddress = socket->peerAddress().toString();
-        qCDebug(networkDiscovery) << "Media share connection from:" << clientAddress;
+    if (!m_contentDirectory) {
+        return;
     }
+    
+    m_ssdpAnnounceTimer->stop();
+    sendSsdpNotify("ssdp:byebye");
+    disconnect(m_libraryChangedConnection);
+    
+    // Requests in flight keep their own reference until they finish
+    m_mediaShareServer->setContentDirectory(nullptr);
+    m_contentDirectory.reset();
+    m_ssdpSocket.reset();
+    
+    shutdownMediaShareServerIfIdle();
+    qCDebug(networkDiscovery) << "Library no longer published";
 }
 
-void NetworkDiscoveryManager::handleMediaShareRequest(QTcpSocket* socket)
+bool NetworkDiscoveryManager::publishLibraryApi(EonPlay::Data::LibraryManager* library, const QString& token)
 {
-    QByteArray request = socket->readAll();
-    QString requestStr = QString::fromUtf8(request);
+    if (m_libraryApi) {
+        return true;
+    }
+    if (token.isEmpty()) {
+        qCWarning(networkDiscovery) << "Refusing to serve the library API without a token";
+        return false;
+    }
+    if (!library || !library->isInitialized() || !ensureMediaShareServer()) {
+        return false;
+    }
     
-    // Parse HTTP request (simplified)
-    QStringList lines = requestStr.split("\r\n");
-    if (lines.isEmpty()) return;
+    m_libraryApi = std::make_shared<LibraryApiService>(library->databaseManager(), token);
+    m_mediaShareServer->setLibraryApi(m_libraryApi);
     
-    QStringList requestLine = lines[0].split(" ");
-    if (requestLine.size() < 2) return;
+    std::weak_ptr<LibraryApiService> libraryApi = m_libraryApi;
+    m_libraryApiChangedConnection = connect(library, &EonPlay::Data::LibraryManager::libraryChanged, this,
+                                            [libraryApi]() {
+        if (auto service = libraryApi.lock()) {
+            service->notifyLibraryChanged();
+        }
+    });
     
-    QString method = requestLine[0];
-    QString path = requestLine[1];
+    qCInfo(networkDiscovery) << "Library API served on port" << m_mediaShareServer->serverPort();
+    return true;
+}
+
+void NetworkDiscoveryManager::unpublishLibraryApi()
+{
+    if (!m_libraryApi) {
+        return;
+    }
+    
+    disconnect(m_libraryApiChangedConnection);
     
-    if (method == "GET") {
-        // Serve media file or directory listing
-        serveMediaFile(socket, path);
+    // Requests in flight keep their own reference until they finish
+    m_mediaShareServer->setLibraryApi(nullptr);
+    m_libraryApi.reset();
+    
+    shutdownMediaShareServerIfIdle();
+    qCDebug(networkDiscovery) << "Library API no longer served";
+}
+
+void NetworkDiscoveryManager::onSsdpSocketReadyRead()
+{
+    while (m_ssdpSocket && m_ssdpSocket->hasPendingDatagrams()) {
+        QByteArray data;
+        QHostAddress sender;
+        quint16 senderPort = 0;
+        
+        data.resize(m_ssdpSocket->pendingDatagramSize());
+        m_ssdpSocket->readDatagram(data.data(), data.size(), &sender, &senderPort);
+        
+        // Other devices' NOTIFYs arrive here too; only searches are answered
+        if (data.startsWith("M-SEARCH")) {
+            answerSsdpSearch(data, sender, senderPort);
+        }
     }
 }
 
-void NetworkDiscoveryManager::serveMediaFile(QTcpSocket* socket, const QString& filePath)
+void NetworkDiscoveryManager::onNotifySocketReadyRead()
 {
-    // Find appropriate media share
-    QString shareId;
-    QString localPath;
-    
-    for (const auto& share : m_mediaShares.values()) {
-        if (share.isActive && filePath.startsWith("/" + share.shareId)) {
-            shareId = share.shareId;
-            localPath = share.rootPath + filePath.mid(share.shareId.length() + 1);
-            break;
+    while (m_notifySocket && m_notifySocket->hasPendingDatagrams()) {
+        QByteArray data;
+        data.resize(m_notifySocket->pendingDatagramSize());
+        m_notifySocket->readDatagram(data.data(), data.size());
+        
+        if (data.startsWith("NOTIFY")) {
+            processSsdpNotify(data);
+        }
+    }
+}
+
+void NetworkDiscoveryManager::answerSsdpSearch(const QByteArray& data, const QHostAddress& sender, quint16 senderPort)
+{
+    QByteArray searchTarget;
+    int maxWaitSeconds = 1;
+    for (const QByteArray& line : data.split('\n')) {
+        const int colon = line.indexOf(':');
+        if (colon <= 0) {
+            continue;
+        }
+        const QByteArray name = line.left(colon).trimmed().toUpper();
+        if (name == "ST") {
+            searchTarget = line.mid(colon + 1).trimmed();
+        } else if (name == "MX") {
+            maxWaitSeconds = line.mid(colon + 1).trimmed().toInt();
         }
     }
     
-    if (shareId.isEmpty()) {
-        // Send 404 Not Found
-        QString response = "HTTP/1.1 404 Not Found\r\n\r\n";
-        socket->write(response.toUtf8());
-        socket->disconnectFromHost();
+    QList<QPair<QByteArray, QByteArray>> matches;
+    for (const auto& target : ssdpTargets()) {
+        if (searchTarget == "ssdp:all" || searchTarget == target.first) {
+            matches.append(target);
+        }
+    }
+    if (matches.isEmpty()) {
         return;
     }
     
-    QFileInfo fileInfo(localPath);
-    if (!fileInfo.exists()) {
-        // Send 404 Not Found
-        QString response = "HTTP/1.1 404 Not Found\r\n\r\n";
-        socket->write(response.toUtf8());
-        socket->disconnectFromHost();
+    QList<QByteArray> responses;
+    for (const auto& target : matches) {
+        responses.append("HTTP/1.1 200 OK\r\n"
+                     "CACHE-CONTROL: max-age=" + QByteArray::number(SSDP_MAX_AGE_S) + "\r\n"
+                     "EXT:\r\n"
+                     "LOCATION: " + ssdpLocation(sender) + "\r\n"
+                     "SERVER: " + QSysInfo::productType().toUtf8() + "/" + QSysInfo::productVersion().toUtf8() +
+                     " UPnP/1.0 EonPlay/1.0\r\n"
+                     "ST: " + target.first + "\r\n"
+                     "USN: " + target.second + "\r\n"
+                     "\r\n");
+    }
+    
+    // Spread over MX, as the spec asks, so a search does not get every answer at once
+    const int delay = QRandomGenerator::global()->bounded(qBound(1, maxWaitSeconds * 1000, int(SSDP_MAX_RESPONSE_DELAY_MS)));
+    QTimer::singleShot(delay, this, [this, responses, sender, senderPort]() {
+        if (!m_ssdpSocket) {
+            return;
+        }
+        for (const QByteArray& response : responses) {
+            m_ssdpSocket->writeDatagram(response, sender, senderPort);
+        }
+    });
+}
+
+void NetworkDiscoveryManager::sendSsdpNotify(const QByteArray& subType)
+{
+    if (!m_ssdpSocket || !m_contentDirectory) {
         return;
     }
     
-    if (fileInfo.isDir()) {
-        // Send directory listing (simplified)
-        QString response = generateMediaShareResponse(shareId);
-        socket->write(response.toUtf8());
-    } else {
-        // Send file
-        QFile file(localPath);
-        if (file.open(QIODevice::ReadOnly)) {
-            QMimeDatabase mimeDb;
-            QString mimeType = mimeDb.mimeTypeForFile(fileInfo).name();
-            
-            QString header = QString(
-                "HTTP/1.1 200 OK\r\n"
-                "Content-Type: %1\r\n"
-                "Content-Length: %2\r\n"
-                "Accept-Ranges: bytes\r\n\r\n"
-            ).arg(mimeType).arg(file.size());
-            
-            socket->write(header.toUtf8());
-            socket->write(file.readAll());
-            file.close();
+    const QHostAddress multicastAddress(UPNP_MULTICAST_ADDRESS);
+    for (const auto& target : ssdpTargets()) {
+        QByteArray message = "NOTIFY * HTTP/1.1\r\n"
+                             "HOST: " + UPNP_MULTICAST_ADDRESS.toUtf8() + ":" + QByteArray::number(UPNP_MULTICAST_PORT) + "\r\n"
+                             "NT: " + target.first + "\r\n"
+                             "NTS: " + subType + "\r\n"
+                             "USN: " + target.second + "\r\n";
+        if (subType == "ssdp:alive") {
+            message += "CACHE-CONTROL: max-age=" + QByteArray::number(SSDP_MAX_AGE_S) + "\r\n"
+                       "LOCATION: " + ssdpLocation(QHostAddress()) + "\r\n"
+                       "SERVER: " + QSysInfo::productType().toUtf8() + "/" + QSysInfo::productVersion().toUtf8() +
+                       " UPnP/1.0 EonPlay/1.0\r\n";
         }
+        message += "\r\n";
+        m_ssdpSocket->writeDatagram(message, multicastAddress, UPNP_MULTICAST_PORT);
+    }
+}
+
+QList<QPair<QByteArray, QByteArray>> NetworkDiscoveryManager::ssdpTargets() const
+{
+    QList<QPair<QByteArray, QByteArray>> targets;
+    if (!m_contentDirectory) {
+        return targets;
     }
     
-    socket->disconnectFromHost();
+    const QByteArray udn = m_contentDirectory->udn().toUtf8();
+    targets.append({"upnp:rootdevice", udn + "::upnp:rootdevice"});
+    targets.append({udn, udn});
+    for (const char* type : {ContentDirectoryService::DEVICE_TYPE, ContentDirectoryService::CONTENT_DIRECTORY_TYPE,
+                             ContentDirectoryService::CONNECTION_MANAGER_TYPE}) {
+        targets.append({QByteArray(type), udn + "::" + type});
+    }
+    return targets;
 }
 
-QString NetworkDiscoveryManager::generateMediaShareResponse(const QString& shareId) const
+QByteArray NetworkDiscoveryManager::ssdpLocation(const QHostAddress& peer) const
 {
-    // Generate simple HTML directory listing
-    QString html = QString(
-        "HTTP/1.1 200 OK\r\n"
-        "Content-Type: text/html\r\n\r\n"
-        "<html><head><title>EonPlay Media Share</title></head>"
-        "<body><h1>Media Share: %1</h1>"
-        "<p>Media files available for streaming</p>"
-        "</body></html>"
-    ).arg(shareId);
+    // The address on the peer's subnet, or else the first non-loopback IPv4 one
+    QHostAddress local;
+    for (const QNetworkInterface& networkInterface : QNetworkInterface::allInterfaces()) {
+        if (!(networkInterface.flags() & QNetworkInterface::IsUp) ||
+            (networkInterface.flags() & QNetworkInterface::IsLoopBack)) {
+            continue;
+        }
+        for (const QNetworkAddressEntry& entry : networkInterface.addressEntries()) {
+            if (entry.ip().protocol() != QAbstractSocket::IPv4Protocol) {
+                continue;
+            }
+            if (local.isNull()) {
+                local = entry.ip();
+            }
+            if (!peer.isNull() && peer.isInSubnet(entry.ip(), entry.prefixLength())) {
+                local = entry.ip();
+                break;
+            }
+        }
+    }
+    if (local.isNull()) {
+        local = QHostAddress(QHostAddress::LocalHost);
+    }
     
-    return html;
+    return "http://" + local.toString().toUtf8() + ":" + QByteArray::number(m_mediaShareServer->serverPort()) +
+           "/upnp/description.xml";
 }
 
 // Timer callbacks
@@ -814,6 +1143,7 @@ void NetworkDiscoveryManager::setMediaSharePort(int port)
 void NetworkDiscoveryManager::setMaxConnections(int maxConnections)
 {
     m_maxConnections = maxConnections;
+    m_mediaShareServer->setMaxConnections(maxConnections);
 }
 
 void NetworkDiscoveryManager::enableAutoDiscovery(bool enabled)
@@ -857,4 +1187,136 @@ bool NetworkDiscoveryManager::joinSyncGroup(const QString& groupId)
 QList<NetworkDiscoveryManager::SyncGroup> NetworkDiscoveryManager::getSyncGroups() const
 {
     return m_syncGroups.values();
-}
\ No newline at end of file
+}
+
+bool NetworkDiscoveryManager::leaveSyncGroup(const QString& groupId)
+{
+    if (m_currentSyncGroup != groupId) return false;
+    
+    m_currentSyncGroup.clear();
+    emit syncGroupLeft(groupId);
+    
+    qCDebug(networkDiscovery) << "Left sync group:" << groupId;
+    return true;
+}
+
+bool NetworkDiscoveryManager::addDeviceToSyncGroup(const QString& groupId, const QString& deviceId)
+{
+    auto it = m_syncGroups.find(groupId);
+    if (it == m_syncGroups.end() || deviceId.isEmpty()) return false;
+    
+    if (!it->deviceIds.contains(deviceId)) {
+        it->deviceIds.append(deviceId);
+    }
+    return true;
+}
+
+bool NetworkDiscoveryManager::removeDeviceFromSyncGroup(const QString& groupId, const QString& deviceId)
+{
+    auto it = m_syncGroups.find(groupId);
+    if (it == m_syncGroups.end()) return false;
+    
+    return it->deviceIds.removeAll(deviceId) > 0;
+}
+
+void NetworkDiscoveryManager::sendSyncPayload(const QString& groupId, const QString& channel,
+                                              const QByteArray& payload, const QString& deviceId)
+{
+    if (!m_syncGroups.contains(groupId)) return;
+    
+    const QByteArray frame = createSyncFrame(groupId, channel, payload);
+    if (deviceId.isEmpty()) {
+        broadcastSyncMessage(groupId, frame);
+        return;
+    }
+    
+    // Only members of the group are ever answered
+    auto group = m_syncGroups.constFind(groupId);
+    auto device = m_discoveredDevices.constFind(deviceId);
+    if (!group->deviceIds.contains(deviceId) || device == m_discoveredDevices.constEnd()) {
+        qCWarning(networkDiscovery) << "Not sending sync payload to" << deviceId << "outside group" << groupId;
+        return;
+    }
+    sendSyncFrame(device->address, frame);
+}
+
+void NetworkDiscoveryManager::broadcastSyncMessage(const QString& groupId, const QByteArray& message)
+{
+    auto group = m_syncGroups.constFind(groupId);
+    if (group == m_syncGroups.constEnd()) return;
+    
+    for (const QString& deviceId : group->deviceIds) {
+        auto device = m_discoveredDevices.constFind(deviceId);
+        if (device != m_discoveredDevices.constEnd() && device->isOnline) {
+            sendSyncFrame(device->address, message);
+        }
+    }
+}
+
+void NetworkDiscoveryManager::sendSyncFrame(const QHostAddress& address, const QByteArray& frame)
+{
+    // One short-lived connection per frame; writes are buffered until connected
+    auto* socket = new QTcpSocket(this);
+    connect(socket, &QTcpSocket::bytesWritten, socket, [socket]() {
+        if (socket->bytesToWrite() == 0) {
+            socket->disconnectFromHost();
+        }
+    });
+    connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    connect(socket, &QTcpSocket::errorOccurred, socket, [socket, address]() {
+        qCWarning(networkDiscovery) << "Sync send to" << address << "failed:" << socket->errorString();
+        socket->deleteLater();
+    });
+    
+    socket->connectToHost(address, m_syncPort);
+    
+    char length[4];
+    qToBigEndian<quint32>(quint32(frame.size()), length);
+    socket->write(length, sizeof(length));
+    socket->write(frame);
+}
+
+QByteArray NetworkDiscoveryManager::createSyncFrame(const QString& groupId, const QString& channel,
+                                                    const QByteArray& payload) const
+{
+    QByteArray frame;
+    QDataStream out(&frame, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << groupId << channel << payload;
+    return frame;
+}
+
+void NetworkDiscoveryManager::handleSyncMessage(const QByteArray& message, const QHostAddress& sender)
+{
+    QDataStream in(message);
+    in.setVersion(QDataStream::Qt_6_0);
+    
+    QString groupId;
+    QString channel;
+    QByteArray payload;
+    in >> groupId >> channel >> payload;
+    auto group = m_syncGroups.constFind(groupId);
+    if (in.status() != QDataStream::Ok || group == m_syncGroups.constEnd()) {
+        qCDebug(networkDiscovery) << "Ignoring sync frame from" << sender;
+        return;
+    }
+    
+    // Knowing a group id is not enough; the sender must be a discovered member
+    const QString senderDeviceId = deviceIdForAddress(sender);
+    if (senderDeviceId.isEmpty() || !group->deviceIds.contains(senderDeviceId)) {
+        qCWarning(networkDiscovery) << "Dropping sync frame for" << groupId << "from non-member" << sender;
+        return;
+    }
+    
+    emit syncPayloadReceived(groupId, channel, senderDeviceId, payload);
+}
+
+QString NetworkDiscoveryManager::deviceIdForAddress(const QHostAddress& address) const
+{
+    for (auto it = m_discoveredDevices.constBegin(); it != m_discoveredDevices.constEnd(); ++it) {
+        if (it->address.isEqual(address, QHostAddress::ConvertV4MappedToIPv4)) {
+            return it.key();
+        }
+    }
+    return QString();
+}
@@ -0,0 +1,370 @@
+#include "network/NetworkService.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QLoggingCategory>
+#include <QNetworkDiskCache>
+#include <QStandardPaths>
+#include <algorithm>
+#include <memory>
+
+Q_LOGGING_CATEGORY(networkService, "eonplay.network.service")
+
+ScheduledNetworkReply::ScheduledNetworkReply(QNetworkAccessManager::Operation operation, const QNetworkRequest& request,
+                                             QObject* parent)
+    : QNetworkReply(parent)
+{
+    setOperation(operation);
+    setRequest(request);
+    setUrl(request.url());
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+ScheduledNetworkReply::~ScheduledNetworkReply() = default;
+
+void ScheduledNetworkReply::attach(QNetworkReply* reply)
+{
+    m_reply = reply;
+    reply->setParent(this);
+
+    if (m_ignoreSslErrors) {
+        reply->ignoreSslErrors();
+    }
+    if (readBufferSize() > 0) {
+        reply->setReadBufferSize(readBufferSize());
+    }
+
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this]() {
+        copyMetaData();
+        emit metaDataChanged();
+    });
+    connect(reply, &QIODevice::readyRead, this, &QIODevice::readyRead);
+    connect(reply, &QNetworkReply::downloadProgress, this, &QNetworkReply::downloadProgress);
+    connect(reply, &QNetworkReply::uploadProgress, this, &QNetworkReply::uploadProgress);
+    connect(reply, &QNetworkReply::redirected, this, &QNetworkReply::redirected);
+    connect(reply, &QNetworkReply::errorOccurred, this, [this](QNetworkReply::NetworkError code) {
+        setError(code, m_reply->errorString());
+        emit errorOccurred(code);
+    });
+#if QT_CONFIG(ssl)
+    connect(reply, &QNetworkReply::sslErrors, this, &QNetworkReply::sslErrors);
+#endif
+    connect(reply, &QNetworkReply::finished, this, &ScheduledNetworkReply::onFinished);
+}
+
+void ScheduledNetworkReply::abort()
+{
+    if (m_reply) {
+        m_reply->abort();
+        return;
+    }
+
+    if (isFinished()) {
+        return;
+    }
+
+    // Never sent; fail like an aborted reply would
+    setError(OperationCanceledError, tr("Operation canceled"));
+    setFinished(true);
+    emit errorOccurred(OperationCanceledError);
+    emit finished();
+}
+
+void ScheduledNetworkReply::ignoreSslErrors()
+{
+    m_ignoreSslErrors = true;
+    if (m_reply) {
+        m_reply->ignoreSslErrors();
+    }
+}
+
+void ScheduledNetworkReply::setReadBufferSize(qint64 size)
+{
+    QNetworkReply::setReadBufferSize(size);
+    if (m_reply) {
+        m_reply->setReadBufferSize(size);
+    }
+}
+
+qint64 ScheduledNetworkReply::bytesAvailable() const
+{
+    return QNetworkReply::bytesAvailable() + (m_reply ? m_reply->bytesAvailable() : 0);
+}
+
+qint64 ScheduledNetworkReply::readData(char* data, qint64 maxSize)
+{
+    if (!m_reply) {
+        return isFinished() ? -1 : 0;
+    }
+    return m_reply->read(data, maxSize);
+}
+
+void ScheduledNetworkReply::copyMetaData()
+{
+    setUrl(m_reply->url());
+
+    // Raw headers also set the parsed known headers
+    const QList<RawHeaderPair> headers = m_reply->rawHeaderPairs();
+    for (const RawHeaderPair& header : headers) {
+        setRawHeader(header.first, header.second);
+    }
+
+    static const QNetworkRequest::Attribute attributes[] = {
+        QNetworkRequest::HttpStatusCodeAttribute,
+        QNetworkRequest::HttpReasonPhraseAttribute,
+        QNetworkRequest::RedirectionTargetAttribute,
+        QNetworkRequest::ConnectionEncryptedAttribute,
+        QNetworkRequest::SourceIsFromCacheAttribute,
+        QNetworkRequest::Http2WasUsedAttribute,
+        QNetworkRequest::OriginalContentLengthAttribute
+    };
+    for (QNetworkRequest::Attribute attribute : attributes) {
+        setAttribute(attribute, m_reply->attribute(attribute));
+    }
+}
+
+void ScheduledNetworkReply::onFinished()
+{
+    copyMetaData();
+    if (m_reply->error() != NoError) {
+        setError(m_reply->error(), m_reply->errorString());
+    }
+    setFinished(true);
+    emit finished();
+}
+
+NetworkService& NetworkService::instance()
+{
+    static NetworkService instance;
+    return instance;
+}
+
+NetworkService::NetworkService()
+    : m_maxPerHost(DEFAULT_MAX_PER_HOST)
+{
+    qRegisterMetaType<NetworkService::RequestClass>();
+
+    // Replies belong to the main thread, whichever thread got here first
+    if (QCoreApplication* application = QCoreApplication::instance()) {
+        moveToThread(application->thread());
+        connect(application, &QCoreApplication::aboutToQuit, this, &NetworkService::shutdown);
+    }
+}
+
+QNetworkAccessManager* NetworkService::networkManager()
+{
+    if (!m_network) {
+        m_network = new QNetworkAccessManager(this);
+
+        m_diskCache = new QNetworkDiskCache(m_network);
+        m_diskCache->setCacheDirectory(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("http"));
+        m_diskCache->setMaximumCacheSize(DISK_CACHE_BYTES);
+        m_network->setCache(m_diskCache);
+    }
+
+    return m_network;
+}
+
+QNetworkReply* NetworkService::get(QNetworkRequest request, RequestClass requestClass)
+{
+    return submit(QNetworkAccessManager::GetOperation, std::move(request), QByteArray(), requestClass);
+}
+
+QNetworkReply* NetworkService::head(QNetworkRequest request, RequestClass requestClass)
+{
+    return submit(QNetworkAccessManager::HeadOperation, std::move(request), QByteArray(), requestClass);
+}
+
+QNetworkReply* NetworkService::post(QNetworkRequest request, const QByteArray& data, RequestClass requestClass)
+{
+    return submit(QNetworkAccessManager::PostOperation, std::move(request), data, requestClass);
+}
+
+void NetworkService::configureRequest(QNetworkRequest& request, RequestClass requestClass,
+                                      QNetworkAccessManager::Operation operation)
+{
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+
+    switch (requestClass) {
+    case RequestClass::Playback:
+        // Segments have their own cache, manifests must be fresh
+        request.setPriority(QNetworkRequest::HighPriority);
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+        request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+        break;
+    case RequestClass::Metadata:
+        request.setPriority(QNetworkRequest::NormalPriority);
+        break;
+    case RequestClass::Telemetry:
+        request.setPriority(QNetworkRequest::LowPriority);
+        request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+        break;
+    }
+
+    // Playback stays out of pipelines to avoid head-of-line blocking;
+    // only idempotent requests may be pipelined at all, unless the caller
+    // decided already
+    const bool idempotent = operation == QNetworkAccessManager::GetOperation ||
+                            operation == QNetworkAccessManager::HeadOperation;
+    if (requestClass != RequestClass::Playback && idempotent &&
+        !request.attribute(QNetworkRequest::HttpPipeliningAllowedAttribute).isValid()) {
+        request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
+    }
+}
+
+void NetworkService::beginPlaybackTransfer()
+{
+    ++m_playbackTransfers;
+}
+
+void NetworkService::endPlaybackTransfer()
+{
+    if (m_playbackTransfers.fetch_sub(1) == 1) {
+        QMetaObject::invokeMethod(this, &NetworkService::dispatch, Qt::QueuedConnection);
+    }
+}
+
+void NetworkService::trackPlaybackTransfer(QNetworkReply* reply)
+{
+    beginPlaybackTransfer();
+
+    // Direct connections: the reply may live in another thread
+    auto ended = std::make_shared<std::atomic<bool>>(false);
+    const auto end = [this, ended]() {
+        if (!ended->exchange(true)) {
+            endPlaybackTransfer();
+        }
+    };
+    connect(reply, &QNetworkReply::finished, end);
+    connect(reply, &QObject::destroyed, end);
+}
+
+void NetworkService::setMaxConnectionsPerHost(int connections)
+{
+    m_maxPerHost = std::max(1, connections);
+    dispatch();
+}
+
+QNetworkReply* NetworkService::submit(QNetworkAccessManager::Operation operation, QNetworkRequest request,
+                                      const QByteArray& data, RequestClass requestClass)
+{
+    configureRequest(request, requestClass, operation);
+
+    if (canSend(request, requestClass)) {
+        return send(operation, request, data, requestClass);
+    }
+
+    auto* reply = new ScheduledNetworkReply(operation, request, networkManager());
+
+    // Metadata ahead of Telemetry, first come first served within a class
+    const auto position = std::find_if(m_queue.begin(), m_queue.end(), [requestClass](const PendingRequest& pending) {
+        return pending.requestClass > requestClass;
+    });
+    m_queue.insert(position, PendingRequest{reply, operation, request, data, requestClass});
+
+    qCDebug(networkService) << "Holding back" << request.url().host() << "-" << m_queue.size() << "queued";
+    return reply;
+}
+
+QNetworkReply* NetworkService::send(QNetworkAccessManager::Operation operation, const QNetworkRequest& request,
+                                    const QByteArray& data, RequestClass requestClass)
+{
+    QNetworkAccessManager* network = networkManager();
+
+    QNetworkReply* reply = nullptr;
+    switch (operation) {
+    case QNetworkAccessManager::HeadOperation:
+        reply = network->head(request);
+        break;
+    case QNetworkAccessManager::PostOperation:
+        reply = network->post(request, data);
+        break;
+    default:
+        reply = network->get(request);
+        break;
+    }
+
+    // Released once, whether the reply finishes or is deleted unfinished
+    auto released = std::make_shared<bool>(false);
+    const QString host = hostKey(request.url());
+    const auto release = [this, released, host, requestClass]() {
+        if (*released) return;
+        *released = true;
+
+        if (requestClass == RequestClass::Playback) {
+            endPlaybackTransfer();
+        } else {
+            if (--m_backgroundPerHost[host] <= 0) {
+                m_backgroundPerHost.remove(host);
+            }
+            dispatch();
+        }
+    };
+
+    if (requestClass == RequestClass::Playback) {
+        beginPlaybackTransfer();
+    } else {
+        ++m_backgroundPerHost[host];
+    }
+
+    connect(reply, &QNetworkReply::finished, this, release);
+    connect(reply, &QObject::destroyed, this, release);
+
+    return reply;
+}
+
+bool NetworkService::canSend(const QNetworkRequest& request, RequestClass requestClass) const
+{
+    if (requestClass == RequestClass::Playback) {
+        return true;
+    }
+
+    if (m_shutDown || m_playbackTransfers > 0) {
+        return false;
+    }
+
+    return m_backgroundPerHost.value(hostKey(request.url())) < m_maxPerHost;
+}
+
+void NetworkService::dispatch()
+{
+    for (int i = 0; i < m_queue.size();) {
+        const PendingRequest& pending = m_queue.at(i);
+
+        // Aborted or deleted while waiting
+        if (!pending.reply || pending.reply->isFinished()) {
+            m_queue.removeAt(i);
+            continue;
+        }
+
+        if (!canSend(pending.request, pending.requestClass)) {
+            if (m_playbackTransfers > 0 || m_shutDown) {
+                return;
+            }
+            ++i;
+            continue;
+        }
+
+        const PendingRequest taken = m_queue.takeAt(i);
+        taken.reply->attach(send(taken.operation, taken.request, taken.data, taken.requestClass));
+        emit requestStarted(taken.request.url(), taken.requestClass);
+    }
+}
+
+void NetworkService::shutdown()
+{
+    m_shutDown = true;
+
+    const QList<PendingRequest> queue = m_queue;
+    m_queue.clear();
+    for (const PendingRequest& pending : queue) {
+        if (pending.reply) {
+            pending.reply->abort();
+        }
+    }
+}
+
+QString NetworkService::hostKey(const QUrl& url)
+{
+    const int defaultPort = url.scheme().toLower() == "https" ? 443 : 80;
+    return url.host().toLower() + QLatin1Char(':') + QString::number(url.port(defaultPort));
+}
@@ -1,4 +1,6 @@
 #include "network/NetworkStreamManager.h"
+#include "network/NetworkService.h"
+#include "network/JitterBufferController.h"
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
@@ -12,7 +14,9 @@
 #include <QProcess>
 #include <QRegularExpression>
 #include <QDateTime>
+#include <QXmlStreamReader>
 #include <QLoggingCategory>
+#include <algorithm>
 
 Q_LOGGING_CATEGORY(networkStream, "eonplay.network.stream")
 
@@ -22,6 +26,13 @@ NetworkStreamManager::NetworkStreamManager(QObject *parent)
     , m_currentReply(nullptr)
     , m_currentState(DISCONNECTED)
     , m_bandwidthTimer(new QTimer(this))
+    , m_bytesReceived(0)
+    , m_adaptiveBitrate(new AdaptiveBitrateController(this))
+    , m_segmentCache(std::make_unique<SegmentCache>(SegmentCache::defaultDirectory(), DEFAULT_SEGMENT_CACHE_BYTES))
+    , m_prefetcher(new SegmentPrefetcher(m_segmentCache.get()))
+    , m_timeshift(new TimeshiftBuffer())
+    , m_timeshiftDurationMs(0)
+    , m_shareReadAhead(new ShareReadAhead())
     , m_connectionTimeout(DEFAULT_TIMEOUT_MS)
     , m_bufferSize(DEFAULT_BUFFER_SIZE_KB)
     , m_lastErrorCode(0)
@@ -32,9 +43,49 @@ NetworkStreamManager::NetworkStreamManager(QObject *parent)
     // Setup bandwidth monitoring timer
     m_bandwidthTimer->setInterval(BANDWIDTH_UPDATE_INTERVAL_MS);
     connect(m_bandwidthTimer, &QTimer::timeout, this, &NetworkStreamManager::onBandwidthTimerTimeout);
+
+    connect(m_adaptiveBitrate, &AdaptiveBitrateController::renditionChanged, this,
+            [this](int, const AdaptiveBitrateController::Rendition& rendition) {
+                followRendition();
+                emit renditionSwitchRequested(rendition);
+            });
+    
+    // Segments are fetched and served off the GUI thread
+    m_prefetchThread.setObjectName("SegmentPrefetch");
+    m_prefetcher->moveToThread(&m_prefetchThread);
+    connect(&m_prefetchThread, &QThread::finished, m_prefetcher, &QObject::deleteLater);
+    connect(m_prefetcher, &SegmentPrefetcher::segmentCached, this, &NetworkStreamManager::segmentCached);
+    m_prefetchThread.start();
+    QMetaObject::invokeMethod(m_prefetcher, &SegmentPrefetcher::start, Qt::QueuedConnection);
+    
+    // Live captures keep running while playback is paused, off the GUI thread too
+    m_timeshiftThread.setObjectName("Timeshift");
+    m_timeshift->moveToThread(&m_timeshiftThread);
+    connect(&m_timeshiftThread, &QThread::finished, m_timeshift, &QObject::deleteLater);
+    connect(m_timeshift, &TimeshiftBuffer::liveStarted, this, [this](const QUrl& streamUrl) {
+        if (streamUrl == m_currentStreamInfo.url) {
+            m_currentStreamInfo.isLive = true;
+            emit timeshiftAvailabilityChanged(true);
+        }
+    });
+    connect(m_timeshift, &TimeshiftBuffer::captureDeclined, this, [this](const QUrl& streamUrl, const QString& reason) {
+        qCDebug(networkStream) << "No timeshift for" << streamUrl.toString() << ":" << reason;
+        if (streamUrl == m_currentStreamInfo.url) {
+            emit timeshiftAvailabilityChanged(false);
+        }
+    });
+    m_timeshiftThread.start();
+    QMetaObject::invokeMethod(m_timeshift, &TimeshiftBuffer::start, Qt::QueuedConnection);
+    
+    // Share reads block on the network, so they stay off the GUI thread too
+    m_shareReadAheadThread.setObjectName("ShareReadAhead");
+    m_shareReadAhead->moveToThread(&m_shareReadAheadThread);
+    connect(&m_shareReadAheadThread, &QThread::finished, m_shareReadAhead, &QObject::deleteLater);
+    m_shareReadAheadThread.start();
+    QMetaObject::invokeMethod(m_shareReadAhead, &ShareReadAhead::start, Qt::QueuedConnection);
     
     // Set default user agent
-    m_userAgent = QString("EonPlay/1.0 (Cross-Platform Media Player)");
+    setUserAgent(QString("EonPlay/1.0 (Cross-Platform Media Player)"));
     
     qCDebug(networkStream) << "NetworkStreamManager initialized";
 }
@@ -43,6 +94,16 @@ NetworkStreamManager::~NetworkStreamManager()
 {
     closeStream();
     unmountNetworkShare();
+    
+    // The capture may read through the segment gateway, so it stops first
+    QMetaObject::invokeMethod(m_timeshift, &TimeshiftBuffer::stop, Qt::BlockingQueuedConnection);
+    m_timeshiftThread.quit();
+    m_timeshiftThread.wait();
+    m_prefetchThread.quit();
+    m_prefetchThread.wait();
+    QMetaObject::invokeMethod(m_shareReadAhead, &ShareReadAhead::stop, Qt::BlockingQueuedConnection);
+    m_shareReadAheadThread.quit();
+    m_shareReadAheadThread.wait();
 }
 
 void NetworkStreamManager::setupNetworkManager()
@@ -108,6 +169,7 @@ bool NetworkStreamManager::openStream(const QUrl& url)
 bool NetworkStreamManager::openHttpBasedStream(const QUrl& url)
 {
     QNetworkRequest request(url);
+    NetworkService::configureRequest(request, NetworkService::RequestClass::Playback);
     configureRequest(request);
     
     // Add specific headers for streaming
@@ -124,10 +186,24 @@ bool NetworkStreamManager::openHttpBasedStream(const QUrl& url)
         request.setRawHeader("Accept", "application/dash+xml, */*");
     }
     
+    m_bytesReceived = 0;
     m_currentReply = m_networkManager->get(request);
     
+    // Manifests hold background requests back until they arrive; a
+    // progressive or live body would hold them back for the whole stream
+    if (m_currentStreamInfo.type == HLS_STREAM || m_currentStreamInfo.type == DASH_STREAM) {
+        NetworkService::instance().trackPlaybackTransfer(m_currentReply);
+    }
+    
     connect(m_currentReply, &QNetworkReply::errorOccurred,
             this, &NetworkStreamManager::onNetworkReplyError);
+    connect(m_currentReply, &QNetworkReply::downloadProgress,
+            this, &NetworkStreamManager::onDownloadProgress);
+    
+    // Measure from the first byte, not from when the reply finished
+    startBandwidthMonitoring();
+    JitterBufferController::instance().openStream(this, url, m_currentStreamInfo.isLive);
+    openTimeshift(url);
     
     qCDebug(networkStream) << "Opening HTTP-based stream:" << url.toString();
     return true;
@@ -175,6 +251,12 @@ void NetworkStreamManager::closeStream()
     }
     
     stopBandwidthMonitoring();
+    JitterBufferController::instance().closeStream(this);
+    
+    if (m_timeshift->isLive()) {
+        emit timeshiftAvailabilityChanged(false);
+    }
+    QMetaObject::invokeMethod(m_timeshift, &TimeshiftBuffer::close, Qt::QueuedConnection);
     
     if (m_currentState != DISCONNECTED) {
         m_currentState = DISCONNECTED;
@@ -185,6 +267,9 @@ void NetworkStreamManager::closeStream()
     // Reset stream info
     m_currentStreamInfo = StreamInfo();
     resetBandwidthStats();
+    m_bytesReceived = 0;
+    m_adaptiveBitrate->clear();
+    QMetaObject::invokeMethod(m_prefetcher, &SegmentPrefetcher::clearPlaylist, Qt::QueuedConnection);
     
     qCDebug(networkStream) << "Stream closed";
 }
@@ -271,6 +356,10 @@ void NetworkStreamManager::onNetworkReplyFinished()
             m_currentStreamInfo.contentType = m_currentReply->header(QNetworkRequest::ContentTypeHeader).toString();
             m_currentStreamInfo.contentLength = m_currentReply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
             
+            if (m_currentStreamInfo.type == HLS_STREAM || m_currentStreamInfo.type == DASH_STREAM) {
+                parseManifest(m_currentReply->readAll());
+            }
+            
             emit streamStateChanged(m_currentState);
             emit streamOpened(m_currentStreamInfo);
             
@@ -359,21 +448,50 @@ void NetworkStreamManager::updateBandwidthStats()
 {
     if (!m_currentReply) return;
     
-    QMutexLocker locker(&m_statsMutex);
-    
-    qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
-    qint64 bytesReceived = m_currentReply->bytesAvailable();
+    qint64 sampleBytes = 0;
+    qint64 sampleMs = 0;
+    BandwidthStats stats;
     
-    // Add to history
-    m_bandwidthHistory.append(qMakePair(currentTime, bytesReceived));
+    {
+        QMutexLocker locker(&m_statsMutex);
+        
+        qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+        
+        // Cumulative, so the difference between two samples is what arrived in between
+        m_bandwidthHistory.append(qMakePair(currentTime, m_bytesReceived));
+        
+        // Keep only recent history
+        while (m_bandwidthHistory.size() > BANDWIDTH_HISTORY_SIZE) {
+            m_bandwidthHistory.removeFirst();
+        }
+        
+        calculateBandwidthStats();
+        stats = m_bandwidthStats;
+        
+        if (m_bandwidthHistory.size() >= 2) {
+            const auto& latest = m_bandwidthHistory.last();
+            const auto& previous = m_bandwidthHistory[m_bandwidthHistory.size() - 2];
+            sampleBytes = latest.second - previous.second;
+            sampleMs = latest.first - previous.first;
+        }
+    }
     
-    // Keep only recent history
-    while (m_bandwidthHistory.size() > BANDWIDTH_HISTORY_SIZE) {
-        m_bandwidthHistory.removeFirst();
+    // Idle intervals say nothing about the link, so only transfers count;
+    // outside the lock, as a rendition switch may call back into us
+    if (sampleBytes > 0) {
+        m_adaptiveBitrate->addThroughputSample(sampleBytes, sampleMs);
+        JitterBufferController::instance().addArrivalSample(this, sampleBytes, sampleMs);
     }
     
-    calculateBandwidthStats();
-    emit bandwidthStatsUpdated(m_bandwidthStats);
+    emit bandwidthStatsUpdated(stats);
+}
+
+void NetworkStreamManager::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
+{
+    Q_UNUSED(bytesTotal)
+    
+    QMutexLocker locker(&m_statsMutex);
+    m_bytesReceived = bytesReceived;
 }
 
 void NetworkStreamManager::calculateBandwidthStats()
@@ -418,11 +536,296 @@ void NetworkStreamManager::resetBandwidthStats()
     m_bandwidthHistory.clear();
 }
 
+AdaptiveBitrateController* NetworkStreamManager::adaptiveBitrate() const
+{
+    return m_adaptiveBitrate;
+}
+
+QVector<AdaptiveBitrateController::Rendition> NetworkStreamManager::availableRenditions() const
+{
+    return m_adaptiveBitrate->renditions();
+}
+
+void NetworkStreamManager::setBufferedDuration(qint64 bufferMs)
+{
+    m_adaptiveBitrate->setBufferLevel(bufferMs);
+}
+
+// Manifest parsing
+void NetworkStreamManager::parseManifest(const QByteArray& manifest)
+{
+    qint64 segmentMs = 0;
+    QVector<AdaptiveBitrateController::Rendition> renditions;
+    
+    if (m_currentStreamInfo.type == HLS_STREAM) {
+        renditions = parseHlsRenditions(manifest, m_currentStreamInfo.url, segmentMs);
+    } else {
+        renditions = parseDashRenditions(manifest, m_currentStreamInfo.url, segmentMs);
+    }
+    
+    m_adaptiveBitrate->setSegmentDuration(segmentMs);
+    
+    // A media playlist has a single rendition, nothing to adapt
+    if (renditions.size() >= 2) {
+        qCDebug(networkStream) << "Found" << renditions.size() << "renditions";
+        m_adaptiveBitrate->setRenditions(renditions);
+        emit renditionsAvailable(m_adaptiveBitrate->renditions());
+    }
+    
+    followRendition();
+}
+
+void NetworkStreamManager::followRendition()
+{
+    // Prefetch what the controller chose; without renditions the manifest
+    // is a media playlist, or a DASH manifest to take the first video from
+    const AdaptiveBitrateController::Rendition rendition = m_adaptiveBitrate->currentRendition();
+    QUrl playlistUrl = m_currentStreamInfo.url;
+    QString representationId;
+    
+    if (m_currentStreamInfo.type == HLS_STREAM && rendition.url.isValid()) {
+        playlistUrl = rendition.url;
+    } else if (m_currentStreamInfo.type == DASH_STREAM) {
+        representationId = rendition.id;
+    } else if (m_currentStreamInfo.type != HLS_STREAM) {
+        return;
+    }
+    
+    QMetaObject::invokeMethod(m_prefetcher, [prefetcher = m_prefetcher, playlistUrl, representationId]() {
+        prefetcher->setPlaylist(playlistUrl, representationId);
+    }, Qt::QueuedConnection);
+    
+    // The timeshift capture follows the same rendition, through the gateway
+    if (m_timeshiftDurationMs > 0 && m_currentStreamInfo.type == HLS_STREAM && rendition.url.isValid()) {
+        const QUrl gatewayPlaylist = m_prefetcher->gatewayUrl(playlistUrl);
+        const QUrl capturePlaylist = gatewayPlaylist.isValid() ? gatewayPlaylist : playlistUrl;
+        QMetaObject::invokeMethod(m_timeshift, [timeshift = m_timeshift, capturePlaylist]() {
+            timeshift->setPlaylist(capturePlaylist);
+        }, Qt::QueuedConnection);
+    }
+}
+
+QUrl NetworkStreamManager::playbackUrl() const
+{
+    // Live streams play through the timeshift gateway, which redirects
+    // anything it does not capture to the direct URL
+    if (m_timeshiftDurationMs > 0 && supportsTimeshift(m_currentStreamInfo.type)) {
+        const QUrl timeshiftUrl = m_timeshift->playbackUrl(0);
+        if (timeshiftUrl.isValid()) {
+            return timeshiftUrl;
+        }
+    }
+    
+    return directPlaybackUrl();
+}
+
+QUrl NetworkStreamManager::directPlaybackUrl() const
+{
+    if (m_currentStreamInfo.type == HLS_STREAM || m_currentStreamInfo.type == DASH_STREAM) {
+        const QUrl gatewayUrl = m_prefetcher->gatewayUrl(m_currentStreamInfo.url);
+        if (gatewayUrl.isValid()) {
+            return gatewayUrl;
+        }
+    }
+    
+    return m_currentStreamInfo.url;
+}
+
+bool NetworkStreamManager::supportsTimeshift(StreamType type)
+{
+    // RTSP/RTP reach libVLC without a byte stream to capture, and DASH
+    // carries audio and video in separate segments
+    return type == HTTP_STREAM || type == HLS_STREAM;
+}
+
+void NetworkStreamManager::openTimeshift(const QUrl& url)
+{
+    if (m_timeshiftDurationMs <= 0 || !supportsTimeshift(m_currentStreamInfo.type)) {
+        return;
+    }
+    
+    // HLS is captured through the segment gateway, so prefetched segments are not fetched twice
+    TimeshiftBuffer::Source source;
+    source.streamUrl = url;
+    source.fallbackUrl = directPlaybackUrl();
+    source.captureUrl = source.fallbackUrl;
+    source.kind = m_currentStreamInfo.type == HLS_STREAM ? TimeshiftBuffer::SourceKind::HlsPlaylist
+                                                         : TimeshiftBuffer::SourceKind::Continuous;
+    QMetaObject::invokeMethod(m_timeshift, [timeshift = m_timeshift, source]() {
+        timeshift->open(source);
+    }, Qt::QueuedConnection);
+}
+
+void NetworkStreamManager::setTimeshiftDuration(qint64 durationMs)
+{
+    m_timeshiftDurationMs = std::max<qint64>(0, durationMs);
+    if (m_timeshiftDurationMs > 0) {
+        QMetaObject::invokeMethod(m_timeshift, [timeshift = m_timeshift, durationMs]() {
+            timeshift->setDuration(durationMs);
+        }, Qt::QueuedConnection);
+    }
+}
+
+qint64 NetworkStreamManager::timeshiftDuration() const
+{
+    return m_timeshiftDurationMs;
+}
+
+void NetworkStreamManager::setTimeshiftMaxBytes(qint64 bytes)
+{
+    QMetaObject::invokeMethod(m_timeshift, [timeshift = m_timeshift, bytes]() {
+        timeshift->setMaxBytes(bytes);
+    }, Qt::QueuedConnection);
+}
+
+bool NetworkStreamManager::isTimeshiftActive() const
+{
+    return m_timeshiftDurationMs > 0 && m_timeshift->isLive();
+}
+
+qint64 NetworkStreamManager::timeshiftAvailableMs() const
+{
+    const std::shared_ptr<TimeshiftRing> ring = m_timeshift->ring();
+    return ring ? ring->availableMs() : 0;
+}
+
+qint64 NetworkStreamManager::timeshiftBehindLiveMs() const
+{
+    return m_timeshift->playbackBehindLiveMs();
+}
+
+QUrl NetworkStreamManager::timeshiftUrl(qint64 behindLiveMs) const
+{
+    return isTimeshiftActive() ? m_timeshift->playbackUrl(behindLiveMs) : QUrl();
+}
+
+void NetworkStreamManager::setPlaybackPosition(qint64 positionMs)
+{
+    QMetaObject::invokeMethod(m_prefetcher, [prefetcher = m_prefetcher, positionMs]() {
+        prefetcher->setPlaybackPosition(positionMs);
+    }, Qt::QueuedConnection);
+}
+
+void NetworkStreamManager::setPrefetchDepth(int segments)
+{
+    QMetaObject::invokeMethod(m_prefetcher, [prefetcher = m_prefetcher, segments]() {
+        prefetcher->setPrefetchDepth(segments);
+    }, Qt::QueuedConnection);
+}
+
+void NetworkStreamManager::setSegmentCacheSize(qint64 bytes)
+{
+    m_segmentCache->setMaxSize(bytes);
+}
+
+qint64 NetworkStreamManager::segmentCacheSize() const
+{
+    return m_segmentCache->maxSize();
+}
+
+void NetworkStreamManager::clearSegmentCache()
+{
+    m_segmentCache->clear();
+}
+
+QVector<AdaptiveBitrateController::Rendition> NetworkStreamManager::parseHlsRenditions(const QByteArray& playlist,
+                                                                                      const QUrl& baseUrl,
+                                                                                      qint64& segmentMs)
+{
+    static const QRegularExpression attributePattern(R"(([A-Z0-9-]+)=("[^"]*"|[^,]*))");
+    
+    QVector<AdaptiveBitrateController::Rendition> renditions;
+    AdaptiveBitrateController::Rendition pending;
+    bool expectUri = false;
+    
+    const QList<QByteArray> lines = playlist.split('\n');
+    for (const QByteArray& rawLine : lines) {
+        const QString line = QString::fromUtf8(rawLine).trimmed();
+        if (line.isEmpty()) continue;
+        
+        if (line.startsWith("#EXT-X-STREAM-INF:")) {
+            pending = AdaptiveBitrateController::Rendition();
+            auto it = attributePattern.globalMatch(line.mid(18));
+            while (it.hasNext()) {
+                const auto match = it.next();
+                const QString name = match.captured(1);
+                QString value = match.captured(2);
+                if (value.startsWith('"')) value = value.mid(1, value.size() - 2);
+                
+                if (name == "BANDWIDTH") {
+                    pending.bandwidth = value.toInt();
+                } else if (name == "RESOLUTION") {
+                    const QStringList size = value.split('x');
+                    if (size.size() == 2) pending.resolution = QSize(size[0].toInt(), size[1].toInt());
+                } else if (name == "CODECS") {
+                    pending.codecs = value;
+                }
+            }
+            expectUri = true;
+        } else if (line.startsWith("#EXT-X-TARGETDURATION:")) {
+            segmentMs = qRound64(line.mid(22).toDouble() * 1000.0);
+        } else if (!line.startsWith('#') && expectUri) {
+            pending.url = baseUrl.resolved(QUrl(line));
+            renditions.append(pending);
+            expectUri = false;
+        }
+    }
+    
+    return renditions;
+}
+
+QVector<AdaptiveBitrateController::Rendition> NetworkStreamManager::parseDashRenditions(const QByteArray& manifest,
+                                                                                       const QUrl& manifestUrl,
+                                                                                       qint64& segmentMs)
+{
+    QVector<AdaptiveBitrateController::Rendition> renditions;
+    QXmlStreamReader xml(manifest);
+    bool videoSet = false;
+    
+    while (!xml.atEnd()) {
+        if (!xml.readNextStartElement()) continue;
+        
+        const auto attributes = xml.attributes();
+        const auto name = xml.name();
+        
+        if (name == QLatin1String("MPD")) {
+            segmentMs = SegmentPrefetcher::parseIsoDurationMs(attributes.value("maxSegmentDuration").toString());
+        } else if (name == QLatin1String("AdaptationSet")) {
+            // Audio follows the video choice; adapt on the video set
+            const QString type = attributes.value("contentType").toString() + attributes.value("mimeType").toString();
+            videoSet = type.contains("video") || (type.isEmpty() && renditions.isEmpty());
+        } else if (name == QLatin1String("SegmentTemplate") && segmentMs <= 0) {
+            const qint64 timescale = qMax<qint64>(1, attributes.value("timescale").toLongLong());
+            segmentMs = attributes.value("duration").toLongLong() * 1000 / timescale;
+        } else if (name == QLatin1String("Representation") && videoSet) {
+            AdaptiveBitrateController::Rendition rendition;
+            rendition.bandwidth = attributes.value("bandwidth").toInt();
+            rendition.resolution = QSize(attributes.value("width").toInt(), attributes.value("height").toInt());
+            rendition.codecs = attributes.value("codecs").toString();
+            rendition.id = attributes.value("id").toString();
+            rendition.url = manifestUrl;
+            renditions.append(rendition);
+        }
+    }
+    
+    if (xml.hasError()) {
+        qCWarning(networkStream) << "Malformed DASH manifest:" << xml.errorString();
+    }
+    
+    return renditions;
+}
+
 // Proxy configuration
 void NetworkStreamManager::setProxy(const QNetworkProxy& proxy)
 {
     m_networkManager->setProxy(proxy);
     m_proxyEnabled = true;
+    QMetaObject::invokeMethod(m_prefetcher, [prefetcher = m_prefetcher, proxy]() {
+        prefetcher->setProxy(proxy);
+    }, Qt::QueuedConnection);
+    QMetaObject::invokeMethod(m_timeshift, [timeshift = m_timeshift, proxy]() {
+        timeshift->setProxy(proxy);
+    }, Qt::QueuedConnection);
     qCDebug(networkStream) << "Proxy configured:" << proxy.hostName() << ":" << proxy.port();
 }
 
@@ -430,6 +833,12 @@ void NetworkStreamManager::clearProxy()
 {
     m_networkManager->setProxy(QNetworkProxy::NoProxy);
     m_proxyEnabled = false;
+    QMetaObject::invokeMethod(m_prefetcher, [prefetcher = m_prefetcher]() {
+        prefetcher->setProxy(QNetworkProxy::NoProxy);
+    }, Qt::QueuedConnection);
+    QMetaObject::invokeMethod(m_timeshift, [timeshift = m_timeshift]() {
+        timeshift->setProxy(QNetworkProxy::NoProxy);
+    }, Qt::QueuedConnection);
     qCDebug(networkStream) << "Proxy cleared";
 }
 
@@ -487,6 +896,9 @@ bool NetworkStreamManager::mountSMBShare(const QUrl& url, const QString& usernam
         m_mountedSharePath = url.toString();
         m_currentState = CONNECTED;
         emit streamStateChanged(m_currentState);
+        QMetaObject::invokeMethod(m_shareReadAhead, [readAhead = m_shareReadAhead, path = m_localMountPath]() {
+            readAhead->setRoot(path);
+        }, Qt::QueuedConnection);
         emit networkShareMounted(m_localMountPath);
         qCDebug(networkStream) << "SMB share mounted:" << m_localMountPath;
         return true;
@@ -512,6 +924,9 @@ bool NetworkStreamManager::mountNFSShare(const QUrl& url)
         m_mountedSharePath = url.toString();
         m_currentState = CONNECTED;
         emit streamStateChanged(m_currentState);
+        QMetaObject::invokeMethod(m_shareReadAhead, [readAhead = m_shareReadAhead, path = m_localMountPath]() {
+            readAhead->setRoot(path);
+        }, Qt::QueuedConnection);
         emit networkShareMounted(m_localMountPath);
         qCDebug(networkStream) << "NFS share mounted:" << m_localMountPath;
         return true;
@@ -526,6 +941,10 @@ void NetworkStreamManager::unmountNetworkShare()
 {
     if (m_localMountPath.isEmpty()) return;
     
+    QMetaObject::invokeMethod(m_shareReadAhead, [readAhead = m_shareReadAhead]() {
+        readAhead->setRoot(QString());
+    }, Qt::QueuedConnection);
+    
 #ifdef Q_OS_WIN
     QString command = QString("net use \"%1\" /delete").arg(m_localMountPath);
 #else
@@ -546,6 +965,19 @@ void NetworkStreamManager::unmountNetworkShare()
     qCDebug(networkStream) << "Network share unmounted";
 }
 
+QUrl NetworkStreamManager::shareFileUrl(const QString& localPath) const
+{
+    const QUrl gatewayUrl = m_shareReadAhead->fileUrl(localPath);
+    return gatewayUrl.isValid() ? gatewayUrl : QUrl::fromLocalFile(localPath);
+}
+
+void NetworkStreamManager::setShareCacheSize(qint64 bytes)
+{
+    QMetaObject::invokeMethod(m_shareReadAhead, [readAhead = m_shareReadAhead, bytes]() {
+        readAhead->setCacheSize(bytes);
+    }, Qt::QueuedConnection);
+}
+
 QString NetworkStreamManager::generateMountPoint() const
 {
     QString tempDir = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
@@ -598,6 +1030,12 @@ QString NetworkStreamManager::getLocalMountPath() const
 void NetworkStreamManager::setUserAgent(const QString& userAgent)
 {
     m_userAgent = userAgent;
+    QMetaObject::invokeMethod(m_prefetcher, [prefetcher = m_prefetcher, userAgent]() {
+        prefetcher->setUserAgent(userAgent);
+    }, Qt::QueuedConnection);
+    QMetaObject::invokeMethod(m_timeshift, [timeshift = m_timeshift, userAgent]() {
+        timeshift->setUserAgent(userAgent);
+    }, Qt::QueuedConnection);
 }
 
 void NetworkStreamManager::setCustomHeaders(const QMap<QString, QString>& headers)
@@ -0,0 +1,358 @@
+#include "network/OnlineSearchService.h"
+#include "network/NetworkService.h"
+#include <QLoggingCategory>
+#include <QNetworkReply>
+#include <QProcess>
+#include <QTimer>
+
+Q_LOGGING_CATEGORY(onlineSearch, "eonplay.network.search")
+
+namespace {
+const QString DEFAULT_RESOLVER = QStringLiteral("yt-dlp");
+constexpr int MAX_CACHED_STREAM_URLS = 256;
+}
+
+OnlineSearchService& OnlineSearchService::instance()
+{
+    static OnlineSearchService instance;
+    return instance;
+}
+
+OnlineSearchService::OnlineSearchService(QObject* parent)
+    : QObject(parent)
+    , m_resolverProgram(DEFAULT_RESOLVER)
+{
+    m_clock.start();
+}
+
+OnlineSearchService::~OnlineSearchService()
+{
+    for (const Search& search : std::as_const(m_searches)) {
+        search.reply->disconnect(this);
+        search.reply->abort();
+        search.reply->deleteLater();
+    }
+    for (const Resolve& resolve : std::as_const(m_resolves)) {
+        if (resolve.process) {
+            resolve.process->disconnect(this);
+            resolve.process->kill();
+            resolve.process->waitForFinished(1000);
+        }
+    }
+}
+
+void OnlineSearchService::search(QObject* context, const QString& channel, const QNetworkRequest& request,
+                                 ResultHandler handler, int debounceMs)
+{
+    const QString id = channelId(context, channel);
+    auto it = m_channels.find(id);
+    if (it == m_channels.end()) {
+        it = m_channels.insert(id, Channel());
+        it->context = context;
+        it->debounce = new QTimer(this);
+        it->debounce->setSingleShot(true);
+        connect(it->debounce, &QTimer::timeout, this, [this, id]() { send(id); });
+        connect(context, &QObject::destroyed, this, [this, id]() { removeChannel(id); });
+    } else if (it->sent) {
+        // Superseded; aborted unless another channel waits for the same answer
+        detach(id);
+    }
+
+    it->request = request;
+    it->key = searchKey(request);
+    it->handler = std::move(handler);
+
+    auto cached = m_results.constFind(it->key);
+    const bool fresh = cached != m_results.cend() && m_clock.elapsed() - cached->storedAt < RESULT_TTL_MS;
+    if (debounceMs <= 0 || fresh) {
+        it->debounce->stop();
+        send(id);
+    } else {
+        it->debounce->start(debounceMs);
+    }
+}
+
+void OnlineSearchService::cancel(QObject* context, const QString& channel)
+{
+    removeChannel(channelId(context, channel));
+}
+
+QUrl OnlineSearchService::cachedStreamUrl(const QUrl& pageUrl, const QString& format) const
+{
+    auto it = m_streamUrls.constFind(streamUrlKey(pageUrl, format));
+    if (it == m_streamUrls.cend() || m_clock.elapsed() - it->storedAt >= STREAM_URL_TTL_MS) {
+        return QUrl();
+    }
+    return it->url;
+}
+
+void OnlineSearchService::resolveStreamUrl(const QUrl& pageUrl, const QString& format, QObject* context,
+                                           StreamUrlHandler handler)
+{
+    const QUrl cached = cachedStreamUrl(pageUrl, format);
+    if (cached.isValid()) {
+        handler(cached);
+        return;
+    }
+
+    const QString key = streamUrlKey(pageUrl, format);
+    Resolve& resolve = m_resolves[key];
+    resolve.pageUrl = pageUrl;
+    resolve.format = format;
+    resolve.waiters.append({context, std::move(handler)});
+
+    if (!resolve.process) {
+        // Someone is waiting now; ahead of prefetches
+        m_resolveQueue.removeAll(key);
+        m_resolveQueue.prepend(key);
+        startResolvers();
+    }
+}
+
+void OnlineSearchService::prefetchStreamUrls(const QList<QUrl>& pageUrls, const QString& format)
+{
+    for (const QUrl& pageUrl : pageUrls) {
+        const QString key = streamUrlKey(pageUrl, format);
+        if (!pageUrl.isValid() || cachedStreamUrl(pageUrl, format).isValid() || m_resolves.contains(key)) {
+            continue;
+        }
+
+        Resolve& resolve = m_resolves[key];
+        resolve.pageUrl = pageUrl;
+        resolve.format = format;
+        m_resolveQueue.append(key);
+    }
+    startResolvers();
+}
+
+void OnlineSearchService::setResolverProgram(const QString& program)
+{
+    m_resolverProgram = program.isEmpty() ? DEFAULT_RESOLVER : program;
+}
+
+void OnlineSearchService::clearCache()
+{
+    m_results.clear();
+    m_streamUrls.clear();
+}
+
+QString OnlineSearchService::channelId(QObject* context, const QString& channel)
+{
+    return QString::number(reinterpret_cast<quintptr>(context), 16) + QLatin1Char('/') + channel;
+}
+
+QString OnlineSearchService::searchKey(const QNetworkRequest& request)
+{
+    // Credentials select what an API answers, so they are part of the query
+    return request.url().toString(QUrl::FullyEncoded) + QLatin1Char('\n')
+           + QString::fromUtf8(request.rawHeader("Client-ID")) + QLatin1Char('\n')
+           + QString::fromUtf8(request.rawHeader("Authorization"));
+}
+
+QString OnlineSearchService::streamUrlKey(const QUrl& pageUrl, const QString& format)
+{
+    return format + QLatin1Char('\n') + pageUrl.toString(QUrl::FullyEncoded);
+}
+
+void OnlineSearchService::send(const QString& id)
+{
+    auto it = m_channels.find(id);
+    if (it == m_channels.end()) {
+        return;
+    }
+    if (!it->context) {
+        removeChannel(id);
+        return;
+    }
+
+    const QString key = it->key;
+    auto cached = m_results.constFind(key);
+    if (cached != m_results.cend() && m_clock.elapsed() - cached->storedAt < RESULT_TTL_MS) {
+        const QByteArray data = cached->data;
+        answer({id}, key, data, QString());
+        return;
+    }
+
+    it->sent = true;
+    auto search = m_searches.find(key);
+    if (search != m_searches.end()) {
+        search->channels.append(id);
+        return;
+    }
+
+    QNetworkRequest request = it->request;
+    // Cached here with our own lifetime
+    request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+    QNetworkReply* reply = NetworkService::instance().get(request, NetworkService::RequestClass::Metadata);
+    connect(reply, &QNetworkReply::finished, this, &OnlineSearchService::onSearchFinished);
+    m_searches.insert(key, {reply, {id}});
+}
+
+void OnlineSearchService::detach(const QString& id)
+{
+    auto it = m_channels.find(id);
+    if (it == m_channels.end() || !it->sent) {
+        return;
+    }
+    it->sent = false;
+
+    auto search = m_searches.find(it->key);
+    if (search == m_searches.end()) {
+        return;
+    }
+    search->channels.removeAll(id);
+    if (search->channels.isEmpty()) {
+        QNetworkReply* reply = search->reply;
+        m_searches.erase(search);
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+void OnlineSearchService::removeChannel(const QString& id)
+{
+    detach(id);
+
+    auto it = m_channels.find(id);
+    if (it != m_channels.end()) {
+        it->debounce->deleteLater();
+        m_channels.erase(it);
+    }
+}
+
+void OnlineSearchService::onSearchFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    reply->deleteLater();
+
+    QString key;
+    for (auto it = m_searches.cbegin(); it != m_searches.cend(); ++it) {
+        if (it->reply == reply) {
+            key = it.key();
+            break;
+        }
+    }
+    if (key.isNull()) {
+        return;
+    }
+
+    const QStringList channels = m_searches.take(key).channels;
+    if (reply->error() != QNetworkReply::NoError) {
+        qCWarning(onlineSearch) << "Search failed:" << reply->url().host() << reply->errorString();
+        answer(channels, key, QByteArray(), reply->errorString());
+        return;
+    }
+
+    const QByteArray data = reply->readAll();
+    storeResult(key, data);
+    answer(channels, key, data, QString());
+}
+
+void OnlineSearchService::answer(const QStringList& ids, const QString& key, const QByteArray& data,
+                                 const QString& error)
+{
+    for (const QString& id : ids) {
+        auto it = m_channels.find(id);
+        // Only the channel's newest search is answered
+        if (it == m_channels.end() || it->key != key) {
+            continue;
+        }
+        it->sent = false;
+        if (!it->context) {
+            removeChannel(id);
+            continue;
+        }
+
+        // The handler may search again on this channel
+        const ResultHandler handler = it->handler;
+        handler(data, error);
+    }
+}
+
+void OnlineSearchService::storeResult(const QString& key, const QByteArray& data)
+{
+    m_results.insert(key, {data, m_clock.elapsed()});
+    if (m_results.size() <= MAX_CACHED_RESULTS) {
+        return;
+    }
+
+    auto oldest = m_results.begin();
+    for (auto it = m_results.begin(); it != m_results.end(); ++it) {
+        if (it->storedAt < oldest->storedAt) {
+            oldest = it;
+        }
+    }
+    m_results.erase(oldest);
+}
+
+void OnlineSearchService::startResolvers()
+{
+    while (m_resolversRunning < MAX_RESOLVERS && !m_resolveQueue.isEmpty()) {
+        const QString key = m_resolveQueue.takeFirst();
+        auto it = m_resolves.find(key);
+        if (it == m_resolves.end() || it->process) {
+            continue;
+        }
+
+        QStringList arguments = {"--no-playlist", "--no-warnings", "--get-url"};
+        if (!it->format.isEmpty()) {
+            arguments << "-f" << it->format;
+        }
+        arguments << it->pageUrl.toString(QUrl::FullyEncoded);
+
+        QProcess* process = new QProcess(this);
+        process->setProcessChannelMode(QProcess::SeparateChannels);
+        it->process = process;
+        ++m_resolversRunning;
+
+        connect(process, &QProcess::finished, this, [this, key, process](int exitCode, QProcess::ExitStatus exitStatus) {
+            QUrl streamUrl;
+            if (exitStatus == QProcess::NormalExit && exitCode == 0) {
+                // Formats with separate audio print one URL per stream; the first is the video
+                streamUrl = QUrl(QString::fromUtf8(process->readAllStandardOutput()).section('\n', 0, 0).trimmed());
+            }
+            finishResolve(key, streamUrl);
+        });
+        connect(process, &QProcess::errorOccurred, this, [this, key](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                finishResolve(key, QUrl());
+            }
+        });
+        QTimer::singleShot(RESOLVE_TIMEOUT_MS, process, [process]() { process->kill(); });
+
+        process->start(m_resolverProgram, arguments);
+    }
+}
+
+void OnlineSearchService::finishResolve(const QString& key, const QUrl& streamUrl)
+{
+    auto it = m_resolves.find(key);
+    if (it == m_resolves.end()) {
+        return;
+    }
+
+    const Resolve resolve = *it;
+    m_resolves.erase(it);
+    --m_resolversRunning;
+    resolve.process->deleteLater();
+
+    if (streamUrl.isValid()) {
+        if (m_streamUrls.size() >= MAX_CACHED_STREAM_URLS) {
+            m_streamUrls.removeIf([this](const std::pair<const QString&, CachedUrl&>& entry) {
+                return m_clock.elapsed() - entry.second.storedAt >= STREAM_URL_TTL_MS;
+            });
+        }
+        m_streamUrls.insert(key, {streamUrl, m_clock.elapsed()});
+    } else {
+        qCWarning(onlineSearch) << "Could not resolve" << resolve.pageUrl.toString() << "with" << m_resolverProgram;
+    }
+
+    for (const StreamUrlWaiter& waiter : resolve.waiters) {
+        if (waiter.context) {
+            waiter.handler(streamUrl);
+        }
+    }
+
+    startResolvers();
+}
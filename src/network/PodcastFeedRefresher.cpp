@@ -0,0 +1,571 @@
+#include "network/PodcastFeedRefresher.h"
+#include "network/NetworkService.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(podcastRefresh, "eonplay.network.podcasts")
+
+namespace {
+
+const QString ITUNES_NAMESPACE = QStringLiteral("http://www.itunes.com/dtds/podcast-1.0.dtd");
+const QString STATE_FILE = QStringLiteral("feeds.json");
+
+QJsonObject episodeToJson(const InternetStreamingService::PodcastEpisode& episode)
+{
+    QJsonObject json;
+    json["title"] = episode.title;
+    json["description"] = episode.description;
+    json["audioUrl"] = episode.audioUrl;
+    json["publishDate"] = episode.publishDate.toString(Qt::ISODate);
+    json["duration"] = episode.duration;
+    json["guid"] = episode.guid;
+    json["fileSize"] = episode.fileSize;
+    json["mimeType"] = episode.mimeType;
+    return json;
+}
+
+InternetStreamingService::PodcastEpisode episodeFromJson(const QJsonObject& json)
+{
+    InternetStreamingService::PodcastEpisode episode;
+    episode.title = json["title"].toString();
+    episode.description = json["description"].toString();
+    episode.audioUrl = json["audioUrl"].toString();
+    episode.publishDate = QDateTime::fromString(json["publishDate"].toString(), Qt::ISODate);
+    episode.duration = json["duration"].toInteger();
+    episode.guid = json["guid"].toString();
+    episode.fileSize = json["fileSize"].toInteger();
+    episode.mimeType = json["mimeType"].toString();
+    return episode;
+}
+
+} // namespace
+
+// PodcastFeedParser
+
+void PodcastFeedParser::addData(const QByteArray& data)
+{
+    m_reader.addData(data);
+}
+
+bool PodcastFeedParser::readNext(PodcastEpisode& episode)
+{
+    while (!m_reader.atEnd()) {
+        switch (m_reader.readNext()) {
+        case QXmlStreamReader::StartElement: {
+            const QStringView name = m_reader.name();
+            const bool plain = m_reader.namespaceUri().isEmpty();
+            const QString parent = m_elements.isEmpty() ? QString() : m_elements.last();
+            m_text.clear();
+
+            if (!m_inItem && plain && name == QStringView(u"item")) {
+                m_inItem = true;
+                m_episode = PodcastEpisode();
+            } else if (m_inItem && plain && name == QStringView(u"enclosure") && parent == QStringView(u"item")) {
+                const QXmlStreamAttributes attributes = m_reader.attributes();
+                m_episode.audioUrl = attributes.value("url").toString();
+                m_episode.fileSize = attributes.value("length").toLongLong();
+                m_episode.mimeType = attributes.value("type").toString();
+            } else if (!m_inItem && parent == QStringView(u"channel") && m_reader.namespaceUri() == ITUNES_NAMESPACE) {
+                const QXmlStreamAttributes attributes = m_reader.attributes();
+                if (name == QStringView(u"image") && m_imageUrl.isEmpty()) {
+                    m_imageUrl = attributes.value("href").toString();
+                } else if (name == QStringView(u"category") && m_category.isEmpty()) {
+                    m_category = attributes.value("text").toString();
+                }
+            }
+
+            m_elements.append(name.toString());
+            break;
+        }
+        case QXmlStreamReader::Characters:
+            m_text += m_reader.text();
+            break;
+        case QXmlStreamReader::EndElement: {
+            if (!m_elements.isEmpty()) {
+                m_elements.removeLast();
+            }
+            const QStringView name = m_reader.name();
+            const bool plain = m_reader.namespaceUri().isEmpty();
+            const QString parent = m_elements.isEmpty() ? QString() : m_elements.last();
+
+            if (m_inItem && plain && name == QStringView(u"item")) {
+                m_inItem = false;
+                if (!m_episode.title.isEmpty() && !m_episode.audioUrl.isEmpty()) {
+                    episode = m_episode;
+                    m_text.clear();
+                    return true;
+                }
+            } else if (m_inItem && plain && parent == QStringView(u"item")) {
+                if (name == QStringView(u"title")) {
+                    m_episode.title = m_text.trimmed();
+                } else if (name == QStringView(u"description")) {
+                    m_episode.description = m_text.trimmed();
+                } else if (name == QStringView(u"pubDate")) {
+                    m_episode.publishDate = QDateTime::fromString(m_text.trimmed(), Qt::RFC2822Date);
+                } else if (name == QStringView(u"guid")) {
+                    m_episode.guid = m_text.trimmed();
+                }
+            } else if (!m_inItem && parent == QStringView(u"channel")) {
+                readChannelField(name, m_reader.namespaceUri());
+            } else if (!m_inItem && plain && name == QStringView(u"url") && parent == QStringView(u"image") && m_imageUrl.isEmpty()) {
+                m_imageUrl = m_text.trimmed();
+            }
+
+            m_text.clear();
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    return false;
+}
+
+void PodcastFeedParser::readChannelField(QStringView name, QStringView namespaceUri)
+{
+    const QString text = m_text.trimmed();
+
+    if (namespaceUri.isEmpty()) {
+        if (name == QStringView(u"title") && m_title.isEmpty()) {
+            m_title = text;
+        } else if (name == QStringView(u"description") && m_description.isEmpty()) {
+            m_description = text;
+        } else if (name == QStringView(u"link") && m_website.isEmpty()) {
+            m_website = text;
+        } else if (name == QStringView(u"category") && m_category.isEmpty()) {
+            m_category = text;
+        }
+    } else if (namespaceUri == ITUNES_NAMESPACE && name == QStringView(u"author") && m_author.isEmpty()) {
+        m_author = text;
+    }
+}
+
+bool PodcastFeedParser::isFinished() const
+{
+    return m_reader.tokenType() == QXmlStreamReader::EndDocument;
+}
+
+bool PodcastFeedParser::hasError() const
+{
+    // Running out of data only means the rest hasn't arrived yet
+    return m_reader.hasError() && m_reader.error() != QXmlStreamReader::PrematureEndOfDocumentError;
+}
+
+// PodcastFeedRefresher
+
+PodcastFeedRefresher::PodcastFeedRefresher(const QString& directory, QObject* parent)
+    : QObject(parent)
+    , m_directory(directory)
+    , m_maxConcurrent(DEFAULT_MAX_CONCURRENT)
+    , m_refreshTimer(new QTimer(this))
+{
+    QDir().mkpath(m_directory);
+    loadState();
+
+    m_refreshTimer->setInterval(DEFAULT_REFRESH_INTERVAL_MS);
+    connect(m_refreshTimer, &QTimer::timeout, this, &PodcastFeedRefresher::refreshAll);
+    m_refreshTimer->start();
+}
+
+PodcastFeedRefresher::~PodcastFeedRefresher()
+{
+    for (auto& fetch : m_fetches) {
+        fetch.first->disconnect(this);
+        fetch.first->abort();
+        fetch.first->deleteLater();
+    }
+    m_fetches.clear();
+
+    saveState();
+}
+
+QString PodcastFeedRefresher::defaultDirectory()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath("podcasts");
+}
+
+bool PodcastFeedRefresher::subscribe(const QUrl& feedUrl)
+{
+    const QString scheme = feedUrl.scheme().toLower();
+    if (!feedUrl.isValid() || (scheme != "http" && scheme != "https") || isSubscribed(feedUrl)) {
+        return false;
+    }
+
+    Feed feed;
+    feed.url = feedUrl;
+    m_feeds.insert(feedUrl.toString(), feed);
+    saveState();
+
+    qCDebug(podcastRefresh) << "Subscribed to" << feedUrl.toString();
+    refresh(feedUrl);
+    return true;
+}
+
+bool PodcastFeedRefresher::unsubscribe(const QUrl& feedUrl)
+{
+    if (!m_feeds.remove(feedUrl.toString())) {
+        return false;
+    }
+
+    m_queue.removeAll(feedUrl);
+    for (auto& fetch : m_fetches) {
+        if (fetch.second->url == feedUrl) {
+            fetch.first->abort();
+            break;
+        }
+    }
+
+    QFile::remove(episodeFile(feedUrl));
+    saveState();
+    return true;
+}
+
+QList<QUrl> PodcastFeedRefresher::subscriptions() const
+{
+    QList<QUrl> urls;
+    urls.reserve(m_feeds.size());
+    for (const Feed& feed : m_feeds) {
+        urls.append(feed.url);
+    }
+    return urls;
+}
+
+bool PodcastFeedRefresher::isSubscribed(const QUrl& feedUrl) const
+{
+    return m_feeds.contains(feedUrl.toString());
+}
+
+QString PodcastFeedRefresher::feedTitle(const QUrl& feedUrl) const
+{
+    return m_feeds.value(feedUrl.toString()).title;
+}
+
+QDateTime PodcastFeedRefresher::lastRefreshed(const QUrl& feedUrl) const
+{
+    return m_feeds.value(feedUrl.toString()).lastRefreshed;
+}
+
+QList<PodcastFeedRefresher::PodcastEpisode> PodcastFeedRefresher::episodes(const QUrl& feedUrl, int limit) const
+{
+    QList<PodcastEpisode> result;
+
+    QFile file(episodeFile(feedUrl));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return result;
+    }
+
+    // Stored oldest first
+    while (!file.atEnd()) {
+        const QJsonDocument line = QJsonDocument::fromJson(file.readLine());
+        if (line.isObject()) {
+            result.append(episodeFromJson(line.object()));
+        }
+    }
+
+    std::reverse(result.begin(), result.end());
+    if (limit >= 0 && result.size() > limit) {
+        result.resize(limit);
+    }
+    return result;
+}
+
+void PodcastFeedRefresher::setMaxConcurrentFetches(int fetches)
+{
+    m_maxConcurrent = std::max(1, fetches);
+    startFetches();
+}
+
+void PodcastFeedRefresher::setRefreshInterval(int intervalMs)
+{
+    if (intervalMs <= 0) {
+        m_refreshTimer->stop();
+        return;
+    }
+
+    m_refreshTimer->start(intervalMs);
+}
+
+int PodcastFeedRefresher::refreshInterval() const
+{
+    return m_refreshTimer->isActive() ? m_refreshTimer->interval() : 0;
+}
+
+void PodcastFeedRefresher::setUserAgent(const QString& userAgent)
+{
+    m_userAgent = userAgent.toUtf8();
+}
+
+void PodcastFeedRefresher::refreshAll()
+{
+    for (const Feed& feed : m_feeds) {
+        refresh(feed.url);
+    }
+}
+
+void PodcastFeedRefresher::refresh(const QUrl& feedUrl)
+{
+    if (!isSubscribed(feedUrl) || m_queue.contains(feedUrl)) {
+        return;
+    }
+    for (const auto& fetch : m_fetches) {
+        if (fetch.second->url == feedUrl) {
+            return;
+        }
+    }
+
+    if (!isRefreshing()) {
+        m_feedsChecked = 0;
+        m_newEpisodes = 0;
+    }
+
+    m_queue.append(feedUrl);
+    startFetches();
+}
+
+void PodcastFeedRefresher::startFetches()
+{
+    while (!m_queue.isEmpty() && static_cast<int>(m_fetches.size()) < m_maxConcurrent) {
+        const QUrl url = m_queue.takeFirst();
+        auto it = m_feeds.find(url.toString());
+        if (it == m_feeds.end()) {
+            continue;
+        }
+
+        Feed& feed = *it;
+        loadGuids(feed);
+
+        QNetworkRequest request(url);
+        // We validate ourselves; the shared HTTP cache would answer a 304
+        // with the whole stored body again
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+        request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+        if (!m_userAgent.isEmpty()) {
+            request.setRawHeader("User-Agent", m_userAgent);
+        }
+        if (!feed.etag.isEmpty()) {
+            request.setRawHeader("If-None-Match", feed.etag);
+        }
+        if (!feed.lastModified.isEmpty()) {
+            request.setRawHeader("If-Modified-Since", feed.lastModified);
+        }
+
+        QNetworkReply* reply = NetworkService::instance().get(request, NetworkService::RequestClass::Metadata);
+        connect(reply, &QIODevice::readyRead, this, &PodcastFeedRefresher::onReadyRead);
+        connect(reply, &QNetworkReply::finished, this, &PodcastFeedRefresher::onFinished);
+
+        auto fetch = std::make_unique<Fetch>();
+        fetch->url = url;
+        m_fetches.emplace(reply, std::move(fetch));
+    }
+}
+
+void PodcastFeedRefresher::onReadyRead()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    auto node = m_fetches.find(reply);
+    if (node == m_fetches.end() || node->second->complete) {
+        return;
+    }
+
+    // Not modified, redirect or error bodies are not feeds
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) {
+        return;
+    }
+
+    auto it = m_feeds.find(node->second->url.toString());
+    if (it != m_feeds.end()) {
+        parseAvailable(reply, *it, *node->second);
+    }
+}
+
+void PodcastFeedRefresher::parseAvailable(QNetworkReply* reply, Feed& feed, Fetch& fetch)
+{
+    fetch.parser.addData(reply->readAll());
+
+    PodcastEpisode episode;
+    while (fetch.parser.readNext(episode)) {
+        const QString key = episodeKey(episode);
+        if (feed.guids.contains(key)) {
+            if (++fetch.knownRun >= KNOWN_RUN_TO_STOP) {
+                // Everything further down is older still
+                fetch.complete = true;
+                reply->abort();
+                return;
+            }
+            continue;
+        }
+
+        fetch.knownRun = 0;
+        episode.guid = key;
+        feed.guids.insert(key);
+        fetch.added.append(episode);
+    }
+}
+
+void PodcastFeedRefresher::onFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    auto node = m_fetches.find(reply);
+    if (node == m_fetches.end()) {
+        return;
+    }
+
+    std::unique_ptr<Fetch> fetch = std::move(node->second);
+    m_fetches.erase(node);
+    reply->deleteLater();
+
+    auto it = m_feeds.find(fetch->url.toString());
+    if (it != m_feeds.end()) {
+        Feed& feed = *it;
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        ++m_feedsChecked;
+
+        if (!fetch->complete && reply->error() != QNetworkReply::NoError) {
+            qCWarning(podcastRefresh) << "Feed refresh failed:" << fetch->url.toString() << reply->errorString();
+            emit feedError(fetch->url, reply->errorString());
+        } else if (status == 304) {
+            feed.lastRefreshed = QDateTime::currentDateTime();
+            emit feedUnchanged(fetch->url);
+        } else {
+            if (!fetch->complete) {
+                parseAvailable(reply, feed, *fetch);
+            }
+
+            if (fetch->complete || fetch->parser.isFinished()) {
+                // Only a fully read answer may validate the next request
+                feed.etag = reply->rawHeader("ETag");
+                feed.lastModified = reply->rawHeader("Last-Modified");
+                feed.lastRefreshed = QDateTime::currentDateTime();
+                if (!fetch->parser.title().isEmpty()) {
+                    feed.title = fetch->parser.title();
+                }
+            } else {
+                const QString error = fetch->parser.hasError() ? fetch->parser.errorString() : tr("Truncated feed");
+                qCWarning(podcastRefresh) << "Feed parse failed:" << fetch->url.toString() << error;
+                emit feedError(fetch->url, error);
+            }
+        }
+
+        // Whatever was read is valid, even from a broken answer
+        if (!fetch->added.isEmpty()) {
+            appendEpisodes(feed, fetch->added);
+            m_newEpisodes += fetch->added.size();
+            qCDebug(podcastRefresh) << fetch->added.size() << "new episodes in" << fetch->url.toString();
+            emit episodesAdded(fetch->url, fetch->added);
+        }
+    }
+
+    startFetches();
+
+    if (!isRefreshing()) {
+        saveState();
+        emit refreshFinished(m_feedsChecked, m_newEpisodes);
+    }
+}
+
+void PodcastFeedRefresher::loadGuids(Feed& feed) const
+{
+    if (feed.guidsLoaded) {
+        return;
+    }
+    feed.guidsLoaded = true;
+
+    QFile file(episodeFile(feed.url));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    while (!file.atEnd()) {
+        const QJsonDocument line = QJsonDocument::fromJson(file.readLine());
+        if (line.isObject()) {
+            feed.guids.insert(line.object()["guid"].toString());
+        }
+    }
+}
+
+void PodcastFeedRefresher::appendEpisodes(const Feed& feed, const QList<PodcastEpisode>& episodes) const
+{
+    QFile file(episodeFile(feed.url));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qCWarning(podcastRefresh) << "Failed to store episodes:" << file.errorString();
+        return;
+    }
+
+    // One JSON object per line, oldest first
+    for (auto it = episodes.crbegin(); it != episodes.crend(); ++it) {
+        file.write(QJsonDocument(episodeToJson(*it)).toJson(QJsonDocument::Compact));
+        file.write("\n");
+    }
+}
+
+QString PodcastFeedRefresher::episodeFile(const QUrl& feedUrl) const
+{
+    const QByteArray hash = QCryptographicHash::hash(feedUrl.toString().toUtf8(), QCryptographicHash::Sha1).toHex();
+    return m_directory + QLatin1Char('/') + QString::fromLatin1(hash) + ".episodes";
+}
+
+QString PodcastFeedRefresher::episodeKey(const PodcastEpisode& episode)
+{
+    return episode.guid.isEmpty() ? episode.audioUrl : episode.guid;
+}
+
+void PodcastFeedRefresher::loadState()
+{
+    QFile file(QDir(m_directory).filePath(STATE_FILE));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonArray feeds = QJsonDocument::fromJson(file.readAll()).object()["feeds"].toArray();
+    for (const QJsonValue& value : feeds) {
+        const QJsonObject json = value.toObject();
+
+        Feed feed;
+        feed.url = QUrl(json["url"].toString());
+        if (!feed.url.isValid()) {
+            continue;
+        }
+        feed.title = json["title"].toString();
+        feed.etag = json["etag"].toString().toUtf8();
+        feed.lastModified = json["lastModified"].toString().toUtf8();
+        feed.lastRefreshed = QDateTime::fromString(json["lastRefreshed"].toString(), Qt::ISODate);
+        m_feeds.insert(feed.url.toString(), feed);
+    }
+
+    qCDebug(podcastRefresh) << "Loaded" << m_feeds.size() << "podcast subscriptions";
+}
+
+void PodcastFeedRefresher::saveState() const
+{
+    QJsonArray feeds;
+    for (const Feed& feed : m_feeds) {
+        QJsonObject json;
+        json["url"] = feed.url.toString();
+        json["title"] = feed.title;
+        json["etag"] = QString::fromUtf8(feed.etag);
+        json["lastModified"] = QString::fromUtf8(feed.lastModified);
+        json["lastRefreshed"] = feed.lastRefreshed.toString(Qt::ISODate);
+        feeds.append(json);
+    }
+
+    QJsonObject root;
+    root["feeds"] = feeds;
+
+    QSaveFile file(QDir(m_directory).filePath(STATE_FILE));
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(root).toJson()) < 0 || !file.commit()) {
+        qCWarning(podcastRefresh) << "Failed to save podcast subscriptions:" << file.errorString();
+    }
+}
@@ -0,0 +1,652 @@
+#include "network/RadioDirectory.h"
+#include "network/NetworkService.h"
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QXmlStreamReader>
+#include <algorithm>
+#include <numeric>
+
+Q_LOGGING_CATEGORY(radioDirectory, "eonplay.network.radio")
+
+namespace {
+
+const QString STATE_FILE = QStringLiteral("stations.json");
+const QString DEFAULT_LISTING_URL = QStringLiteral("https://dir.xiph.org/yp.xml");
+
+QJsonObject stationToJson(const InternetStreamingService::RadioStation& station)
+{
+    QJsonObject json;
+    json["name"] = station.name;
+    json["url"] = station.url;
+    json["genre"] = station.genre;
+    json["country"] = station.country;
+    json["description"] = station.description;
+    json["website"] = station.website;
+    json["bitrate"] = station.bitrate;
+    json["format"] = station.format;
+    json["listeners"] = station.listeners;
+    return json;
+}
+
+InternetStreamingService::RadioStation stationFromJson(const QJsonObject& json)
+{
+    InternetStreamingService::RadioStation station;
+    station.name = json["name"].toString();
+    station.url = json["url"].toString();
+    station.genre = json["genre"].toString();
+    station.country = json["country"].toString();
+    station.description = json["description"].toString();
+    station.website = json["website"].toString();
+    station.bitrate = json["bitrate"].toInt();
+    station.format = json["format"].toString();
+    station.listeners = json["listeners"].toInt();
+    return station;
+}
+
+void mergeStation(InternetStreamingService::RadioStation& known, const InternetStreamingService::RadioStation& update)
+{
+    // Sources know different things about a station; keep what either knows
+    auto take = [](QString& field, const QString& value) {
+        if (!value.isEmpty()) {
+            field = value;
+        }
+    };
+    take(known.name, update.name);
+    take(known.genre, update.genre);
+    take(known.country, update.country);
+    take(known.description, update.description);
+    take(known.website, update.website);
+    take(known.format, update.format);
+    if (update.bitrate > 0) {
+        known.bitrate = update.bitrate;
+    }
+    if (update.listeners > 0) {
+        known.listeners = update.listeners;
+    }
+}
+
+} // namespace
+
+// RadioStationProber
+
+RadioStationProber::RadioStationProber(QObject* parent)
+    : QObject(parent)
+    , m_maxConcurrent(DEFAULT_MAX_CONCURRENT)
+{
+    m_clock.start();
+}
+
+RadioStationProber::~RadioStationProber()
+{
+    for (auto it = m_probes.cbegin(); it != m_probes.cend(); ++it) {
+        it.key()->disconnect(this);
+        it.key()->abort();
+        it.key()->deleteLater();
+    }
+    m_probes.clear();
+}
+
+void RadioStationProber::probe(const QString& stationUrl, bool force)
+{
+    const QUrl url(stationUrl);
+    const QString scheme = url.scheme().toLower();
+    if (!url.isValid() || (scheme != "http" && scheme != "https")) {
+        return;
+    }
+    if ((!force && isFresh(stationUrl)) || std::find(m_probes.cbegin(), m_probes.cend(), stationUrl) != m_probes.cend()) {
+        return;
+    }
+
+    m_queue.removeAll(stationUrl);
+    m_queue.prepend(stationUrl);
+    startProbes();
+}
+
+void RadioStationProber::probe(const QStringList& stationUrls)
+{
+    // Each probe goes to the front, so queue backwards to keep the order
+    for (auto it = stationUrls.crbegin(); it != stationUrls.crend(); ++it) {
+        probe(*it);
+    }
+}
+
+RadioStationProber::Status RadioStationProber::status(const QString& stationUrl) const
+{
+    return m_cache.value(stationUrl).status;
+}
+
+bool RadioStationProber::isFresh(const QString& stationUrl) const
+{
+    auto it = m_cache.constFind(stationUrl);
+    if (it == m_cache.cend() || it->status == Unknown) {
+        return false;
+    }
+
+    const qint64 ttl = it->status == Online ? ONLINE_TTL_MS : OFFLINE_TTL_MS;
+    return m_clock.elapsed() - it->checkedAt < ttl;
+}
+
+RadioStationProber::RadioStation RadioStationProber::stationInfo(const QString& stationUrl) const
+{
+    return m_cache.value(stationUrl).info;
+}
+
+void RadioStationProber::setMaxConcurrentProbes(int probes)
+{
+    m_maxConcurrent = std::max(1, probes);
+    startProbes();
+}
+
+void RadioStationProber::setUserAgent(const QString& userAgent)
+{
+    m_userAgent = userAgent.toUtf8();
+}
+
+void RadioStationProber::cancelPending()
+{
+    m_queue.clear();
+}
+
+void RadioStationProber::startProbes()
+{
+    while (!m_queue.isEmpty() && m_probes.size() < m_maxConcurrent) {
+        const QString stationUrl = m_queue.takeFirst();
+
+        QNetworkRequest request{QUrl(stationUrl)};
+        request.setTransferTimeout(PROBE_TIMEOUT_MS);
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+        request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+        // Asks for the icy-* headers; the interleaved metadata is never read
+        request.setRawHeader("Icy-MetaData", "1");
+        if (!m_userAgent.isEmpty()) {
+            request.setRawHeader("User-Agent", m_userAgent);
+        }
+
+        QNetworkReply* reply = NetworkService::instance().get(request, NetworkService::RequestClass::Metadata);
+        connect(reply, &QNetworkReply::metaDataChanged, this, &RadioStationProber::onMetaDataChanged);
+        connect(reply, &QNetworkReply::finished, this, &RadioStationProber::onFinished);
+        m_probes.insert(reply, stationUrl);
+    }
+}
+
+void RadioStationProber::onMetaDataChanged()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!m_probes.contains(reply)) {
+        return;
+    }
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status >= 300 && status < 400) {
+        return; // Being redirected
+    }
+
+    // The headers are all a probe needs
+    complete(reply, status >= 200 && status < 300);
+    reply->abort();
+}
+
+void RadioStationProber::onFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!m_probes.contains(reply)) {
+        return;
+    }
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    // SHOUTcast v1 answers "ICY 200 OK", which Qt rejects as not HTTP
+    const bool online = reply->error() == QNetworkReply::ProtocolFailure
+                        || (reply->error() == QNetworkReply::NoError && status >= 200 && status < 300);
+    complete(reply, online);
+}
+
+void RadioStationProber::complete(QNetworkReply* reply, bool online)
+{
+    const QString stationUrl = m_probes.take(reply);
+    reply->deleteLater();
+
+    Entry& entry = m_cache[stationUrl];
+    entry.status = online ? Online : Offline;
+    entry.checkedAt = m_clock.elapsed();
+    entry.info.url = stationUrl;
+    entry.info.isOnline = online;
+
+    if (online) {
+        auto header = [reply](const char* name) {
+            return QString::fromUtf8(reply->rawHeader(name)).trimmed();
+        };
+        if (!header("icy-name").isEmpty()) {
+            entry.info.name = header("icy-name");
+        }
+        if (!header("icy-genre").isEmpty()) {
+            entry.info.genre = header("icy-genre");
+        }
+        if (!header("icy-description").isEmpty()) {
+            entry.info.description = header("icy-description");
+        }
+        if (!header("icy-url").isEmpty()) {
+            entry.info.website = header("icy-url");
+        }
+        // Some servers list one bitrate per channel: "128,128"
+        const int bitrate = header("icy-br").section(',', 0, 0).toInt();
+        if (bitrate > 0) {
+            entry.info.bitrate = bitrate;
+        }
+        const QString contentType = reply->header(QNetworkRequest::ContentTypeHeader).toString();
+        if (!contentType.isEmpty()) {
+            entry.info.format = contentType.section(';', 0, 0).trimmed();
+        }
+    }
+
+    emit stationProbed(stationUrl, online, entry.info);
+
+    startProbes();
+    if (m_probes.isEmpty() && m_queue.isEmpty()) {
+        emit probesFinished();
+    }
+}
+
+// RadioDirectory
+
+RadioDirectory::RadioDirectory(const QString& directory, QObject* parent)
+    : QObject(parent)
+    , m_directory(directory)
+    , m_listingUrl(DEFAULT_LISTING_URL)
+    , m_reply(nullptr)
+    , m_refreshTimer(new QTimer(this))
+{
+    QDir().mkpath(m_directory);
+    load();
+    rebuildIndex();
+
+    m_refreshTimer->setInterval(DEFAULT_REFRESH_INTERVAL_MS);
+    connect(m_refreshTimer, &QTimer::timeout, this, &RadioDirectory::refresh);
+    m_refreshTimer->start();
+
+    // Catch up on a refresh missed while the application was not running,
+    // once the owner has had a chance to configure us
+    if (!m_lastRefreshed.isValid()
+        || m_lastRefreshed.msecsTo(QDateTime::currentDateTime()) >= DEFAULT_REFRESH_INTERVAL_MS) {
+        QTimer::singleShot(0, this, &RadioDirectory::refresh);
+    }
+}
+
+RadioDirectory::~RadioDirectory()
+{
+    if (m_reply) {
+        m_reply->disconnect(this);
+        m_reply->abort();
+        m_reply->deleteLater();
+    }
+}
+
+QString RadioDirectory::defaultDirectory()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath("radio");
+}
+
+QList<RadioDirectory::RadioStation> RadioDirectory::search(const QString& query, const QString& genre,
+                                                          const QString& country, int limit) const
+{
+    QList<int> indexes = matching(query, genre, country);
+
+    auto busier = [this](int a, int b) {
+        const RadioStation& first = m_stations.at(a);
+        const RadioStation& second = m_stations.at(b);
+        if (first.listeners != second.listeners) {
+            return first.listeners > second.listeners;
+        }
+        return first.name.compare(second.name, Qt::CaseInsensitive) < 0;
+    };
+    if (limit >= 0 && indexes.size() > limit) {
+        std::partial_sort(indexes.begin(), indexes.begin() + limit, indexes.end(), busier);
+        indexes.resize(limit);
+    } else {
+        std::sort(indexes.begin(), indexes.end(), busier);
+    }
+
+    QList<RadioStation> result;
+    result.reserve(indexes.size());
+    for (int index : std::as_const(indexes)) {
+        result.append(m_stations.at(index));
+    }
+    return result;
+}
+
+QList<RadioDirectory::RadioStation> RadioDirectory::popular(const QString& genre, int limit) const
+{
+    return search(QString(), genre, QString(), limit);
+}
+
+void RadioDirectory::addStations(const QList<RadioStation>& stations)
+{
+    bool changed = false;
+    for (const RadioStation& station : stations) {
+        if (station.url.isEmpty()) {
+            continue;
+        }
+
+        auto it = m_byUrl.constFind(station.url);
+        if (it != m_byUrl.cend()) {
+            mergeStation(m_stations[*it], station);
+        } else {
+            m_merged.insert(station.url);
+            m_stations.append(station);
+            m_stations.last().isOnline = false;
+        }
+        changed = true;
+    }
+
+    if (changed) {
+        rebuildIndex();
+        save();
+    }
+}
+
+void RadioDirectory::setRefreshInterval(int intervalMs)
+{
+    if (intervalMs <= 0) {
+        m_refreshTimer->stop();
+        return;
+    }
+
+    m_refreshTimer->start(intervalMs);
+}
+
+int RadioDirectory::refreshInterval() const
+{
+    return m_refreshTimer->isActive() ? m_refreshTimer->interval() : 0;
+}
+
+void RadioDirectory::setListingUrl(const QUrl& url)
+{
+    if (url == m_listingUrl) {
+        return;
+    }
+
+    // Validators of another listing mean nothing here
+    m_listingUrl = url;
+    m_etag.clear();
+    m_lastModified.clear();
+}
+
+void RadioDirectory::setUserAgent(const QString& userAgent)
+{
+    m_userAgent = userAgent.toUtf8();
+}
+
+void RadioDirectory::refresh()
+{
+    if (m_reply || !m_listingUrl.isValid()) {
+        return;
+    }
+
+    QNetworkRequest request(m_listingUrl);
+    // The listing is large and we validate it ourselves
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+    request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    if (!m_userAgent.isEmpty()) {
+        request.setRawHeader("User-Agent", m_userAgent);
+    }
+    if (!m_etag.isEmpty()) {
+        request.setRawHeader("If-None-Match", m_etag);
+    }
+    if (!m_lastModified.isEmpty()) {
+        request.setRawHeader("If-Modified-Since", m_lastModified);
+    }
+
+    m_reply = NetworkService::instance().get(request, NetworkService::RequestClass::Metadata);
+    connect(m_reply, &QNetworkReply::finished, this, &RadioDirectory::onRefreshFinished);
+    qCDebug(radioDirectory) << "Refreshing radio directory from" << m_listingUrl.toString();
+}
+
+void RadioDirectory::onRefreshFinished()
+{
+    QNetworkReply* reply = m_reply;
+    m_reply = nullptr;
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        qCWarning(radioDirectory) << "Radio directory refresh failed:" << reply->errorString();
+        emit refreshFailed(reply->errorString());
+        return;
+    }
+
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+        m_lastRefreshed = QDateTime::currentDateTime();
+        save();
+        emit directoryUpdated(m_stations.size());
+        return;
+    }
+
+    const QList<RadioStation> listed = parseListing(reply->readAll());
+    if (listed.isEmpty()) {
+        qCWarning(radioDirectory) << "Radio directory listing is empty or malformed";
+        emit refreshFailed(tr("Empty directory listing"));
+        return;
+    }
+
+    // The listing replaces its previous version; merged stations stay
+    QList<RadioStation> stations;
+    QHash<QString, int> byUrl;
+    stations.reserve(listed.size() + m_merged.size());
+    for (const RadioStation& station : listed) {
+        auto it = byUrl.constFind(station.url);
+        if (it != byUrl.cend()) {
+            continue; // Relays announce the same mount more than once
+        }
+        byUrl.insert(station.url, stations.size());
+        stations.append(station);
+    }
+    for (const RadioStation& station : std::as_const(m_stations)) {
+        if (!m_merged.contains(station.url)) {
+            continue;
+        }
+        auto it = byUrl.constFind(station.url);
+        if (it != byUrl.cend()) {
+            m_merged.remove(station.url);
+            mergeStation(stations[*it], station);
+        } else {
+            stations.append(station);
+        }
+    }
+
+    m_stations = stations;
+    m_etag = reply->rawHeader("ETag");
+    m_lastModified = reply->rawHeader("Last-Modified");
+    m_lastRefreshed = QDateTime::currentDateTime();
+    rebuildIndex();
+    save();
+
+    qCDebug(radioDirectory) << "Radio directory refreshed:" << m_stations.size() << "stations";
+    emit directoryUpdated(m_stations.size());
+}
+
+QList<RadioDirectory::RadioStation> RadioDirectory::parseListing(const QByteArray& xml)
+{
+    // <directory><entry><server_name/><listen_url/><server_type/><bitrate/><genre/>...</entry></directory>
+    QList<RadioStation> stations;
+    QXmlStreamReader reader(xml);
+    RadioStation station;
+    bool inEntry = false;
+
+    while (!reader.atEnd()) {
+        reader.readNext();
+
+        if (reader.isStartElement()) {
+            const QStringView name = reader.name();
+            if (name == QStringView(u"entry")) {
+                inEntry = true;
+                station = RadioStation();
+            } else if (inEntry && name == QStringView(u"server_name")) {
+                station.name = reader.readElementText().trimmed();
+            } else if (inEntry && name == QStringView(u"listen_url")) {
+                station.url = reader.readElementText().trimmed();
+            } else if (inEntry && name == QStringView(u"server_type")) {
+                station.format = reader.readElementText().trimmed();
+            } else if (inEntry && name == QStringView(u"bitrate")) {
+                station.bitrate = reader.readElementText().toInt();
+            } else if (inEntry && name == QStringView(u"genre")) {
+                station.genre = reader.readElementText().trimmed();
+            }
+        } else if (reader.isEndElement() && reader.name() == QStringView(u"entry")) {
+            inEntry = false;
+            if (!station.name.isEmpty() && !station.url.isEmpty()) {
+                stations.append(station);
+            }
+        }
+    }
+
+    if (reader.hasError()) {
+        qCWarning(radioDirectory) << "Radio directory listing parse error:" << reader.errorString();
+    }
+    return stations;
+}
+
+QStringList RadioDirectory::words(const QString& text)
+{
+    static const QRegularExpression separators(QStringLiteral("[^\\w]+"),
+                                               QRegularExpression::UseUnicodePropertiesOption);
+    return text.toLower().split(separators, Qt::SkipEmptyParts);
+}
+
+void RadioDirectory::rebuildIndex()
+{
+    m_byUrl.clear();
+    m_byGenre.clear();
+    m_byCountry.clear();
+    m_byNameWord.clear();
+
+    for (int i = 0; i < m_stations.size(); ++i) {
+        indexStation(i);
+    }
+}
+
+void RadioDirectory::indexStation(int index)
+{
+    const RadioStation& station = m_stations.at(index);
+    m_byUrl.insert(station.url, index);
+
+    // A word can repeat within a field; index each station once per word
+    auto add = [index](auto& map, const QStringList& keys) {
+        for (const QString& key : keys) {
+            QList<int>& list = map[key];
+            if (list.isEmpty() || list.last() != index) {
+                list.append(index);
+            }
+        }
+    };
+    add(m_byGenre, words(station.genre));
+    add(m_byCountry, words(station.country));
+    add(m_byNameWord, words(station.name));
+}
+
+QList<int> RadioDirectory::matching(const QString& query, const QString& genre, const QString& country) const
+{
+    QSet<int> result;
+    bool constrained = false;
+
+    auto narrow = [&result, &constrained](const QSet<int>& candidates) {
+        if (constrained) {
+            result.intersect(candidates);
+        } else {
+            result = candidates;
+            constrained = true;
+        }
+    };
+    auto exact = [](const QHash<QString, QList<int>>& index, const QString& word) {
+        const QList<int> list = index.value(word);
+        return QSet<int>(list.cbegin(), list.cend());
+    };
+
+    for (const QString& word : words(genre)) {
+        narrow(exact(m_byGenre, word));
+    }
+    for (const QString& word : words(country)) {
+        narrow(exact(m_byCountry, word));
+    }
+    for (const QString& word : words(query)) {
+        QSet<int> candidates;
+        for (auto it = m_byNameWord.lowerBound(word); it != m_byNameWord.cend() && it.key().startsWith(word); ++it) {
+            candidates.unite(QSet<int>(it->cbegin(), it->cend()));
+        }
+        narrow(candidates);
+    }
+
+    if (!constrained) {
+        QList<int> all(m_stations.size());
+        std::iota(all.begin(), all.end(), 0);
+        return all;
+    }
+    return QList<int>(result.cbegin(), result.cend());
+}
+
+void RadioDirectory::load()
+{
+    QFile file(QDir(m_directory).filePath(STATE_FILE));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    m_etag = root["etag"].toString().toUtf8();
+    m_lastModified = root["lastModified"].toString().toUtf8();
+    m_lastRefreshed = QDateTime::fromString(root["lastRefreshed"].toString(), Qt::ISODate);
+    if (root["listingUrl"].toString() != m_listingUrl.toString()) {
+        m_etag.clear();
+        m_lastModified.clear();
+    }
+
+    const QJsonArray stations = root["stations"].toArray();
+    m_stations.reserve(stations.size());
+    for (const QJsonValue& value : stations) {
+        const QJsonObject json = value.toObject();
+        RadioStation station = stationFromJson(json);
+        if (station.url.isEmpty()) {
+            continue;
+        }
+        if (json["merged"].toBool()) {
+            m_merged.insert(station.url);
+        }
+        m_stations.append(station);
+    }
+
+    qCDebug(radioDirectory) << "Loaded" << m_stations.size() << "radio stations";
+}
+
+void RadioDirectory::save() const
+{
+    QJsonArray stations;
+    for (const RadioStation& station : m_stations) {
+        QJsonObject json = stationToJson(station);
+        if (m_merged.contains(station.url)) {
+            json["merged"] = true;
+        }
+        stations.append(json);
+    }
+
+    QJsonObject root;
+    root["listingUrl"] = m_listingUrl.toString();
+    root["etag"] = QString::fromUtf8(m_etag);
+    root["lastModified"] = QString::fromUtf8(m_lastModified);
+    root["lastRefreshed"] = m_lastRefreshed.toString(Qt::ISODate);
+    root["stations"] = stations;
+
+    QSaveFile file(QDir(m_directory).filePath(STATE_FILE));
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0
+        || !file.commit()) {
+        qCWarning(radioDirectory) << "Failed to save radio directory:" << file.errorString();
+    }
+}
@@ -0,0 +1,251 @@
+#include "network/RecordingSink.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QStringList>
+#include <QTimer>
+
+Q_LOGGING_CATEGORY(recordingSink, "eonplay.network.recording")
+
+/**
+ * @brief File side of RecordingSink, living on the I/O thread
+ *
+ * Everything here runs on that thread; the sink reaches it through queued
+ * calls and results go back the same way.
+ */
+class RecordingWriter : public QObject
+{
+public:
+    explicit RecordingWriter(RecordingSink* owner)
+        : m_owner(owner)
+    {
+    }
+
+    ~RecordingWriter() override
+    {
+        close();
+    }
+
+    void open(const QString& outputPath, const RecordingSink::Rotation& rotation)
+    {
+        close();
+
+        m_basePath = outputPath;
+        m_rotation = rotation;
+        m_index = 0;
+        m_segments.clear();
+        m_buffer.reserve(RecordingSink::WRITE_BUFFER_BYTES);
+
+        // Created here so it belongs to this thread
+        if (!m_flushTimer) {
+            m_flushTimer = new QTimer(this);
+            m_flushTimer->setInterval(RecordingSink::FLUSH_INTERVAL_MS);
+            connect(m_flushTimer, &QTimer::timeout, this, [this]() { flush(); });
+        }
+
+        if (startSegment()) {
+            m_flushTimer->start();
+        }
+    }
+
+    void write(const QByteArray& data)
+    {
+        if (!m_file.isOpen()) {
+            return;
+        }
+
+        if (m_segmentBytes > 0 && segmentFull()) {
+            finishSegment();
+            ++m_index;
+            if (!startSegment()) {
+                return;
+            }
+        }
+
+        m_buffer.append(data);
+        m_segmentBytes += data.size();
+        if (m_buffer.size() >= RecordingSink::WRITE_BUFFER_BYTES) {
+            flush();
+        }
+    }
+
+    void close()
+    {
+        if (m_flushTimer) {
+            m_flushTimer->stop();
+        }
+        if (m_file.isOpen()) {
+            finishSegment();
+        }
+    }
+
+private:
+    bool rotating() const
+    {
+        return m_rotation.maxBytes > 0 || m_rotation.maxDurationMs > 0;
+    }
+
+    bool segmentFull() const
+    {
+        return (m_rotation.maxBytes > 0 && m_segmentBytes >= m_rotation.maxBytes) ||
+               (m_rotation.maxDurationMs > 0 && m_segmentClock.elapsed() >= m_rotation.maxDurationMs);
+    }
+
+    QString segmentPath(int index) const
+    {
+        if (!rotating()) {
+            return m_basePath;
+        }
+
+        // capture.mp3 -> capture_0001.mp3
+        const QFileInfo info(m_basePath);
+        QString name = info.completeBaseName() + QString("_%1").arg(index + 1, 4, 10, QLatin1Char('0'));
+        if (!info.suffix().isEmpty()) {
+            name += QLatin1Char('.') + info.suffix();
+        }
+        return info.dir().filePath(name);
+    }
+
+    bool startSegment()
+    {
+        const QString path = segmentPath(m_index);
+        QDir().mkpath(QFileInfo(path).absolutePath());
+
+        // Our buffer is the only one; QFile's own would copy everything twice
+        m_file.setFileName(path);
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+            reportError(m_file.errorString());
+            return false;
+        }
+
+        m_segmentBytes = 0;
+        m_segmentClock.start();
+        m_segments.append(path);
+        ++m_owner->m_segmentCount;
+
+        const int index = m_index;
+        QMetaObject::invokeMethod(m_owner, [owner = m_owner, path, index]() {
+            emit owner->segmentStarted(path, index);
+        }, Qt::QueuedConnection);
+
+        if (m_rotation.keepSegments > 0) {
+            while (m_segments.size() > m_rotation.keepSegments) {
+                QFile::remove(m_segments.takeFirst());
+            }
+        }
+        return true;
+    }
+
+    void finishSegment()
+    {
+        flush();
+
+        const QString path = m_file.fileName();
+        const qint64 bytes = m_segmentBytes;
+        m_file.close();
+
+        QMetaObject::invokeMethod(m_owner, [owner = m_owner, path, bytes]() {
+            emit owner->segmentFinished(path, bytes);
+        }, Qt::QueuedConnection);
+    }
+
+    void flush()
+    {
+        if (m_buffer.isEmpty() || !m_file.isOpen()) {
+            return;
+        }
+
+        const qint64 size = m_buffer.size();
+        const qint64 written = m_file.write(m_buffer);
+        if (written > 0) {
+            m_owner->m_bytesWritten += written;
+        }
+        // Keeps the capacity for the next round
+        m_buffer.resize(0);
+
+        if (written != size) {
+            reportError(m_file.errorString());
+        }
+    }
+
+    void reportError(const QString& error)
+    {
+        qCWarning(recordingSink) << "Recording write failed:" << m_file.fileName() << error;
+        m_file.close();
+
+        QMetaObject::invokeMethod(m_owner, [owner = m_owner, error]() {
+            emit owner->writeError(error);
+        }, Qt::QueuedConnection);
+    }
+
+    RecordingSink* m_owner;
+    QString m_basePath;
+    RecordingSink::Rotation m_rotation;
+    QFile m_file;
+    QByteArray m_buffer;
+    QTimer* m_flushTimer = nullptr;
+    QElapsedTimer m_segmentClock;
+    QStringList m_segments;         // Oldest first, for keepSegments
+    qint64 m_segmentBytes = 0;
+    int m_index = 0;
+};
+
+RecordingSink::RecordingSink(QObject* parent)
+    : QObject(parent)
+    , m_writer(new RecordingWriter(this))
+{
+    m_ioThread.setObjectName("RecordingIO");
+    m_writer->moveToThread(&m_ioThread);
+    connect(&m_ioThread, &QThread::finished, m_writer, &QObject::deleteLater);
+    m_ioThread.start();
+}
+
+RecordingSink::~RecordingSink()
+{
+    // The writer flushes and closes as it is deleted with the thread
+    m_ioThread.quit();
+    m_ioThread.wait();
+}
+
+void RecordingSink::open(const QString& outputPath, const Rotation& rotation)
+{
+    m_open = true;
+    m_bytesReceived = 0;
+    m_bytesWritten = 0;
+    m_segmentCount = 0;
+
+    RecordingWriter* writer = m_writer;
+    QMetaObject::invokeMethod(writer, [writer, outputPath, rotation]() {
+        writer->open(outputPath, rotation);
+    }, Qt::QueuedConnection);
+}
+
+void RecordingSink::write(const QByteArray& data)
+{
+    if (!m_open || data.isEmpty()) {
+        return;
+    }
+
+    m_bytesReceived += data.size();
+
+    // Implicitly shared, so handing it over copies nothing
+    RecordingWriter* writer = m_writer;
+    QMetaObject::invokeMethod(writer, [writer, data]() {
+        writer->write(data);
+    }, Qt::QueuedConnection);
+}
+
+void RecordingSink::close()
+{
+    if (!m_open) {
+        return;
+    }
+    m_open = false;
+
+    RecordingWriter* writer = m_writer;
+    QMetaObject::invokeMethod(writer, [writer]() {
+        writer->close();
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,280 @@
+#include "network/RemoteStatePublisher.h"
+
+#ifdef HAVE_QT_WEBSOCKETS
+
+#include <QDataStream>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QTimer>
+#include <QWebSocket>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(remoteStatePublisher, "eonplay.network.remote")
+
+namespace {
+constexpr quint32 bit(RemoteStatePublisher::Field field)
+{
+    return 1u << field;
+}
+
+constexpr quint32 ALL_FIELDS = bit(RemoteStatePublisher::Casting) | bit(RemoteStatePublisher::Playing)
+                               | bit(RemoteStatePublisher::Position) | bit(RemoteStatePublisher::Duration)
+                               | bit(RemoteStatePublisher::Volume) | bit(RemoteStatePublisher::Muted)
+                               | bit(RemoteStatePublisher::Title) | bit(RemoteStatePublisher::Device)
+                               | bit(RemoteStatePublisher::Queue) | bit(RemoteStatePublisher::QueueIndex);
+
+void writeString(QDataStream& stream, const QString& value)
+{
+    const QByteArray utf8 = value.toUtf8().left(0xffff);
+    stream << quint16(utf8.size());
+    stream.writeRawData(utf8.constData(), int(utf8.size()));
+}
+}
+
+RemoteStatePublisher::RemoteStatePublisher(QObject* parent)
+    : QObject(parent)
+    , m_positionPublishedAt(0)
+    , m_sequence(0)
+    , m_flushTimer(new QTimer(this))
+{
+    m_clock.start();
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(FRAME_INTERVAL_MS);
+    connect(m_flushTimer, &QTimer::timeout, this, &RemoteStatePublisher::flush);
+}
+
+RemoteStatePublisher::~RemoteStatePublisher() = default;
+
+void RemoteStatePublisher::addClient(QWebSocket* client)
+{
+    if (m_clients.isEmpty()) {
+        // Nobody holds older state, so deltas start from here
+        m_published = m_state;
+        m_positionPublishedAt = m_clock.elapsed();
+        m_flushTimer->stop();
+    }
+
+    Client entry;
+    entry.socket = client;
+    m_clients.append(entry);
+    send(entry, encodeJson(true, ALL_FIELDS), QByteArray());
+    qCDebug(remoteStatePublisher) << "Remote connected," << m_clients.size() << "in total";
+}
+
+void RemoteStatePublisher::removeClient(QWebSocket* client)
+{
+    m_clients.removeIf([client](const Client& entry) { return entry.socket == client; });
+}
+
+bool RemoteStatePublisher::handleMessage(QWebSocket* client, const QString& message)
+{
+    const QJsonObject object = QJsonDocument::fromJson(message.toUtf8()).object();
+    if (object.value("type").toString() != "hello") {
+        return false;
+    }
+
+    auto entry = std::find_if(m_clients.begin(), m_clients.end(),
+                              [client](const Client& candidate) { return candidate.socket == client; });
+    if (entry != m_clients.end()) {
+        entry->binary = object.value("format").toString() == "binary";
+        // Resend in the format the remote asked for
+        send(*entry, encodeJson(true, ALL_FIELDS), encodeBinary(true, ALL_FIELDS));
+    }
+    return true;
+}
+
+void RemoteStatePublisher::setState(const State& state)
+{
+    const QStringList queue = m_state.queue;
+    const int queueIndex = m_state.queueIndex;
+    m_state = state;
+    m_state.queue = queue;
+    m_state.queueIndex = queueIndex;
+    scheduleFlush();
+}
+
+void RemoteStatePublisher::setQueue(const QStringList& queue, int queueIndex)
+{
+    m_state.queue = queue;
+    m_state.queueIndex = queueIndex;
+    scheduleFlush();
+}
+
+void RemoteStatePublisher::scheduleFlush()
+{
+    // Everything changed within a frame goes out as one message
+    if (!m_clients.isEmpty() && !m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+qint64 RemoteStatePublisher::expectedPosition() const
+{
+    if (!m_published.playing) {
+        return m_published.positionMs;
+    }
+    const qint64 position = m_published.positionMs + (m_clock.elapsed() - m_positionPublishedAt);
+    return m_published.durationMs > 0 ? std::min(position, m_published.durationMs) : position;
+}
+
+quint32 RemoteStatePublisher::changedFields() const
+{
+    quint32 fields = 0;
+    if (m_state.casting != m_published.casting) {
+        fields |= bit(Casting);
+    }
+    if (m_state.playing != m_published.playing) {
+        fields |= bit(Playing);
+    }
+    if (m_state.durationMs != m_published.durationMs) {
+        fields |= bit(Duration);
+    }
+    if (m_state.volume != m_published.volume) {
+        fields |= bit(Volume);
+    }
+    if (m_state.muted != m_published.muted) {
+        fields |= bit(Muted);
+    }
+    if (m_state.title != m_published.title) {
+        fields |= bit(Title);
+    }
+    if (m_state.device != m_published.device) {
+        fields |= bit(Device);
+    }
+    if (m_state.queue != m_published.queue) {
+        fields |= bit(Queue);
+    }
+    if (m_state.queueIndex != m_published.queueIndex) {
+        fields |= bit(QueueIndex);
+    }
+    // Remotes extrapolate position; resync it on state changes and drift
+    if ((fields & (bit(Casting) | bit(Playing) | bit(Title)))
+        || qAbs(m_state.positionMs - expectedPosition()) > POSITION_DRIFT_MS) {
+        fields |= bit(Position);
+    }
+    return fields;
+}
+
+void RemoteStatePublisher::flush()
+{
+    const quint32 fields = changedFields();
+    if (fields == 0 || m_clients.isEmpty()) {
+        return;
+    }
+
+    ++m_sequence;
+    const bool anyBinary = std::any_of(m_clients.cbegin(), m_clients.cend(),
+                                       [](const Client& client) { return client.binary; });
+    const bool anyJson = std::any_of(m_clients.cbegin(), m_clients.cend(),
+                                     [](const Client& client) { return !client.binary; });
+    const QByteArray json = anyJson ? encodeJson(false, fields) : QByteArray();
+    const QByteArray binary = anyBinary ? encodeBinary(false, fields) : QByteArray();
+    for (const Client& client : std::as_const(m_clients)) {
+        send(client, json, binary);
+    }
+
+    const qint64 positionMs = m_published.positionMs;
+    m_published = m_state;
+    if (fields & bit(Position)) {
+        m_positionPublishedAt = m_clock.elapsed();
+    } else {
+        m_published.positionMs = positionMs;
+    }
+}
+
+void RemoteStatePublisher::send(const Client& client, const QByteArray& json, const QByteArray& binary) const
+{
+    if (client.binary) {
+        client.socket->sendBinaryMessage(binary);
+    } else {
+        client.socket->sendTextMessage(QString::fromUtf8(json));
+    }
+}
+
+QByteArray RemoteStatePublisher::encodeJson(bool snapshot, quint32 fields) const
+{
+    QJsonObject object;
+    object["type"] = snapshot ? "snapshot" : "delta";
+    object["seq"] = qint64(m_sequence);
+    if (fields & bit(Casting)) {
+        object["casting"] = m_state.casting;
+    }
+    if (fields & bit(Playing)) {
+        object["playing"] = m_state.playing;
+    }
+    if (fields & bit(Position)) {
+        object["position"] = m_state.positionMs;
+    }
+    if (fields & bit(Duration)) {
+        object["duration"] = m_state.durationMs;
+    }
+    if (fields & bit(Volume)) {
+        object["volume"] = m_state.volume;
+    }
+    if (fields & bit(Muted)) {
+        object["muted"] = m_state.muted;
+    }
+    if (fields & bit(Title)) {
+        object["title"] = m_state.title;
+    }
+    if (fields & bit(Device)) {
+        object["device"] = m_state.device;
+    }
+    if (fields & bit(Queue)) {
+        object["queue"] = QJsonArray::fromStringList(m_state.queue);
+    }
+    if (fields & bit(QueueIndex)) {
+        object["queueIndex"] = m_state.queueIndex;
+    }
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+QByteArray RemoteStatePublisher::encodeBinary(bool snapshot, quint32 fields) const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::BigEndian);
+    stream << quint8(snapshot ? 'S' : 'D') << m_sequence;
+
+    if (fields & bit(Casting)) {
+        stream << quint8(Casting) << quint8(m_state.casting);
+    }
+    if (fields & bit(Playing)) {
+        stream << quint8(Playing) << quint8(m_state.playing);
+    }
+    if (fields & bit(Position)) {
+        stream << quint8(Position) << qint64(m_state.positionMs);
+    }
+    if (fields & bit(Duration)) {
+        stream << quint8(Duration) << qint64(m_state.durationMs);
+    }
+    if (fields & bit(Volume)) {
+        stream << quint8(Volume) << quint8(qBound(0, m_state.volume, 100));
+    }
+    if (fields & bit(Muted)) {
+        stream << quint8(Muted) << quint8(m_state.muted);
+    }
+    if (fields & bit(Title)) {
+        stream << quint8(Title);
+        writeString(stream, m_state.title);
+    }
+    if (fields & bit(Device)) {
+        stream << quint8(Device);
+        writeString(stream, m_state.device);
+    }
+    if (fields & bit(Queue)) {
+        const qsizetype count = std::min<qsizetype>(m_state.queue.size(), 0xffff);
+        stream << quint8(Queue) << quint16(count);
+        for (qsizetype i = 0; i < count; ++i) {
+            writeString(stream, m_state.queue.at(i));
+        }
+    }
+    if (fields & bit(QueueIndex)) {
+        stream << quint8(QueueIndex) << qint32(m_state.queueIndex);
+    }
+    return data;
+}
+
+#endif // HAVE_QT_WEBSOCKETS
@@ -0,0 +1,149 @@
+#include "network/SegmentCache.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+Q_LOGGING_CATEGORY(segmentCache, "eonplay.network.segmentcache")
+
+SegmentCache::SegmentCache(const QString& directory, qint64 maxBytes)
+    : m_directory(directory)
+    , m_maxBytes(maxBytes)
+{
+    QDir().mkpath(m_directory);
+    loadIndex();
+}
+
+QString SegmentCache::defaultDirectory()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("segments");
+}
+
+bool SegmentCache::contains(const QString& key) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.contains(fileName(key));
+}
+
+QByteArray SegmentCache::read(const QString& key)
+{
+    const QString name = fileName(key);
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.find(name);
+    if (it == m_entries.end()) {
+        return QByteArray();
+    }
+
+    QFile file(filePath(name));
+    if (!file.open(QIODevice::ReadOnly)) {
+        // Deleted behind our back
+        remove(name);
+        return QByteArray();
+    }
+
+    m_order.splice(m_order.end(), m_order, it->position);
+    return file.readAll();
+}
+
+void SegmentCache::store(const QString& key, const QByteArray& data)
+{
+    const QString name = fileName(key);
+
+    QMutexLocker locker(&m_mutex);
+    if (data.isEmpty() || data.size() > m_maxBytes) {
+        return;
+    }
+
+    if (m_entries.contains(name)) {
+        remove(name);
+    }
+
+    QSaveFile file(filePath(name));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qCWarning(segmentCache) << "Failed to store segment:" << file.errorString();
+        return;
+    }
+
+    m_order.push_back(name);
+    m_entries.insert(name, Entry{data.size(), std::prev(m_order.end())});
+    m_currentBytes += data.size();
+    evict();
+}
+
+void SegmentCache::setMaxSize(qint64 maxBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxBytes = maxBytes;
+    evict();
+}
+
+qint64 SegmentCache::maxSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxBytes;
+}
+
+qint64 SegmentCache::currentSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_currentBytes;
+}
+
+void SegmentCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_order.empty()) {
+        remove(m_order.front());
+    }
+}
+
+QString SegmentCache::fileName(const QString& key)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex()) + ".seg";
+}
+
+QString SegmentCache::filePath(const QString& name) const
+{
+    return m_directory + QLatin1Char('/') + name;
+}
+
+void SegmentCache::loadIndex()
+{
+    // Without access times on disk, write order is the best recency guess
+    const QFileInfoList files = QDir(m_directory).entryInfoList(QStringList() << "*.seg", QDir::Files, QDir::Time | QDir::Reversed);
+
+    for (const QFileInfo& info : files) {
+        m_order.push_back(info.fileName());
+        m_entries.insert(info.fileName(), Entry{info.size(), std::prev(m_order.end())});
+        m_currentBytes += info.size();
+    }
+
+    evict();
+
+    qCDebug(segmentCache) << "Segment cache:" << m_entries.size() << "segments," << m_currentBytes / 1024 << "KB";
+}
+
+void SegmentCache::remove(const QString& name)
+{
+    auto it = m_entries.find(name);
+    if (it == m_entries.end()) {
+        return;
+    }
+
+    QFile::remove(filePath(name));
+    m_currentBytes -= it->size;
+    m_order.erase(it->position);
+    m_entries.erase(it);
+}
+
+void SegmentCache::evict()
+{
+    while (m_currentBytes > m_maxBytes && !m_order.empty()) {
+        remove(m_order.front());
+    }
+}
@@ -0,0 +1,960 @@
+#include "network/SegmentPrefetcher.h"
+#include "network/SegmentCache.h"
+#include "network/NetworkService.h"
+#include <QDateTime>
+#include <QHostAddress>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRegularExpression>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QXmlStreamReader>
+#include <algorithm>
+#include <cmath>
+
+Q_LOGGING_CATEGORY(segmentPrefetcher, "eonplay.network.prefetch")
+
+namespace {
+
+// SegmentTemplate or SegmentList timing, inherited from AdaptationSet to Representation
+struct DashTiming
+{
+    struct TimelineEntry {
+        qint64 time = -1;       // -1 continues from the previous entry
+        qint64 duration = 0;
+        qint64 repeat = 0;
+    };
+
+    QString media;
+    QString initialization;
+    qint64 startNumber = 1;
+    qint64 timescale = 1;
+    qint64 duration = 0;
+    qint64 presentationTimeOffset = 0;
+    QList<TimelineEntry> timeline;
+    QStringList segmentUrls;        // SegmentList
+    QStringList segmentRanges;
+    QString initializationRange;
+};
+
+QByteArray toRangeHeader(const QString& range)
+{
+    // mediaRange and BYTERANGE-derived values are "first-last"
+    return range.isEmpty() ? QByteArray() : "bytes=" + range.toLatin1();
+}
+
+void readTiming(QXmlStreamReader& xml, DashTiming& timing)
+{
+    const QXmlStreamAttributes attributes = xml.attributes();
+    if (attributes.hasAttribute("media")) timing.media = attributes.value("media").toString();
+    if (attributes.hasAttribute("initialization")) timing.initialization = attributes.value("initialization").toString();
+    if (attributes.hasAttribute("startNumber")) timing.startNumber = attributes.value("startNumber").toLongLong();
+    if (attributes.hasAttribute("timescale")) timing.timescale = std::max<qint64>(1, attributes.value("timescale").toLongLong());
+    if (attributes.hasAttribute("duration")) timing.duration = attributes.value("duration").toLongLong();
+    if (attributes.hasAttribute("presentationTimeOffset")) {
+        timing.presentationTimeOffset = attributes.value("presentationTimeOffset").toLongLong();
+    }
+
+    const bool list = xml.name() == QStringView(u"SegmentList");
+    if (list) {
+        timing.segmentUrls.clear();
+        timing.segmentRanges.clear();
+    }
+
+    bool timelineSeen = false;
+    while (xml.readNextStartElement()) {
+        const QXmlStreamAttributes child = xml.attributes();
+        if (xml.name() == QStringView(u"SegmentTimeline")) {
+            if (!timelineSeen) {
+                timing.timeline.clear();
+                timelineSeen = true;
+            }
+            while (xml.readNextStartElement()) {
+                if (xml.name() == QStringView(u"S")) {
+                    const QXmlStreamAttributes s = xml.attributes();
+                    DashTiming::TimelineEntry entry;
+                    entry.time = s.hasAttribute("t") ? s.value("t").toLongLong() : -1;
+                    entry.duration = s.value("d").toLongLong();
+                    entry.repeat = s.value("r").toLongLong();
+                    timing.timeline.append(entry);
+                }
+                xml.skipCurrentElement();
+            }
+        } else if (xml.name() == QStringView(u"Initialization")) {
+            timing.initialization = child.value("sourceURL").toString();
+            timing.initializationRange = child.value("range").toString();
+            xml.skipCurrentElement();
+        } else if (list && xml.name() == QStringView(u"SegmentURL")) {
+            timing.segmentUrls.append(child.value("media").toString());
+            timing.segmentRanges.append(child.value("mediaRange").toString());
+            xml.skipCurrentElement();
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
+}
+
+} // namespace
+
+SegmentPrefetcher::SegmentPrefetcher(SegmentCache* cache, QObject* parent)
+    : QObject(parent)
+    , m_cache(cache)
+{
+}
+
+SegmentPrefetcher::~SegmentPrefetcher()
+{
+    stop();
+}
+
+QUrl SegmentPrefetcher::gatewayUrl(const QUrl& remote) const
+{
+    const quint16 port = m_port;
+    const QString scheme = remote.scheme().toLower();
+    if (port == 0 || (scheme != "http" && scheme != "https") || remote.host().isEmpty()) {
+        return QUrl();
+    }
+
+    // Mapping a URL is what allows the gateway to fetch from its host
+    {
+        QMutexLocker locker(&m_hostMutex);
+        m_allowedHosts.insert(remote.host().toLower());
+    }
+
+    QString target = "/o/" + scheme + "/" + remote.authority(QUrl::FullyEncoded) + remote.path(QUrl::FullyEncoded);
+    if (remote.hasQuery()) {
+        target += "?" + remote.query(QUrl::FullyEncoded);
+    }
+
+    return QUrl(QString("http://127.0.0.1:%1%2").arg(port).arg(target));
+}
+
+void SegmentPrefetcher::start()
+{
+    if (m_network) {
+        return;
+    }
+
+    m_network = new QNetworkAccessManager(this);
+    m_network->setProxy(m_proxy);
+
+    m_reloadTimer = new QTimer(this);
+    m_reloadTimer->setSingleShot(true);
+    connect(m_reloadTimer, &QTimer::timeout, this, &SegmentPrefetcher::loadPlaylist);
+
+    m_gateway = new QTcpServer(this);
+    connect(m_gateway, &QTcpServer::newConnection, this, &SegmentPrefetcher::onGatewayConnection);
+
+    if (!m_gateway->listen(QHostAddress::LocalHost, 0)) {
+        qCWarning(segmentPrefetcher) << "Segment gateway could not listen:" << m_gateway->errorString();
+        return;
+    }
+
+    m_port = m_gateway->serverPort();
+    qCDebug(segmentPrefetcher) << "Segment gateway on port" << m_port;
+    emit gatewayReady(m_port);
+}
+
+void SegmentPrefetcher::stop()
+{
+    clearPlaylist();
+
+    // Disconnect before aborting, abort() emits finished() synchronously
+    const QList<QNetworkReply*> replies = m_fetches.keys();
+    for (QNetworkReply* reply : replies) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+    m_fetches.clear();
+    m_inFlight.clear();
+    m_prefetchesRunning = 0;
+
+    for (auto it = m_clients.begin(); it != m_clients.end(); ++it) {
+        it.key()->disconnect(this);
+        it.key()->abort();
+        it.key()->deleteLater();
+    }
+    m_clients.clear();
+
+    if (m_gateway) {
+        m_gateway->close();
+    }
+    m_port = 0;
+}
+
+void SegmentPrefetcher::setPlaylist(const QUrl& playlistUrl, const QString& representationId)
+{
+    if (playlistUrl == m_playlistUrl && representationId == m_representationId) {
+        return;
+    }
+
+    // Segments stay as the timing anchor for the new rendition
+    if (m_playlistReply) {
+        m_playlistReply->disconnect(this);
+        m_playlistReply->abort();
+        m_playlistReply->deleteLater();
+        m_playlistReply = nullptr;
+    }
+
+    m_playlistUrl = playlistUrl;
+    m_representationId = representationId;
+    m_initSegment = Segment();
+
+    qCDebug(segmentPrefetcher) << "Following" << playlistUrl.toString() << representationId;
+    loadPlaylist();
+}
+
+void SegmentPrefetcher::clearPlaylist()
+{
+    if (m_playlistReply) {
+        m_playlistReply->disconnect(this);
+        m_playlistReply->abort();
+        m_playlistReply->deleteLater();
+        m_playlistReply = nullptr;
+    }
+
+    if (m_reloadTimer) {
+        m_reloadTimer->stop();
+    }
+
+    m_playlistUrl.clear();
+    m_representationId.clear();
+    m_segments.clear();
+    m_initSegment = Segment();
+    m_positionMs = 0;
+    m_live = false;
+}
+
+void SegmentPrefetcher::setPlaybackPosition(qint64 positionMs)
+{
+    m_positionMs = positionMs;
+    schedulePrefetch();
+}
+
+void SegmentPrefetcher::setPrefetchDepth(int segments)
+{
+    m_depth = std::max(0, segments);
+    schedulePrefetch();
+}
+
+void SegmentPrefetcher::setUserAgent(const QString& userAgent)
+{
+    m_userAgent = userAgent.toUtf8();
+}
+
+void SegmentPrefetcher::setProxy(const QNetworkProxy& proxy)
+{
+    m_proxy = proxy;
+    if (m_network) {
+        m_network->setProxy(proxy);
+    }
+}
+
+// Playlists
+
+void SegmentPrefetcher::loadPlaylist()
+{
+    if (!m_network || !m_playlistUrl.isValid() || m_playlistReply) {
+        return;
+    }
+
+    m_playlistReply = m_network->get(createRequest(m_playlistUrl, QByteArray()));
+    connect(m_playlistReply, &QNetworkReply::finished, this, &SegmentPrefetcher::onPlaylistFinished);
+    NetworkService::instance().trackPlaybackTransfer(m_playlistReply);
+}
+
+void SegmentPrefetcher::onPlaylistFinished()
+{
+    QNetworkReply* reply = m_playlistReply;
+    m_playlistReply = nullptr;
+    if (!reply) {
+        return;
+    }
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        qCWarning(segmentPrefetcher) << "Playlist request failed:" << reply->errorString();
+        if (m_live) {
+            m_reloadTimer->start(RETRY_INTERVAL_MS);
+        }
+        return;
+    }
+
+    const QByteArray body = reply->readAll();
+    if (body.trimmed().startsWith("#EXTM3U")) {
+        parseHlsPlaylist(body);
+    } else {
+        parseDashManifest(body);
+    }
+}
+
+void SegmentPrefetcher::parseHlsPlaylist(const QByteArray& playlist)
+{
+    static const QRegularExpression uriPattern(R"re(URI="([^"]*)")re");
+    static const QRegularExpression rangePattern(R"re(BYTERANGE="?(\d+)(?:@(\d+))?)re");
+
+    QMap<qint64, Segment> segments;
+    qint64 sequence = 0;
+    qint64 startMs = 0;
+    qint64 durationMs = 0;
+    qint64 targetMs = 0;
+    qint64 nextRangeOffset = 0;
+    QByteArray pendingRange;
+    bool ended = false;
+
+    const QList<QByteArray> lines = playlist.split('\n');
+    for (const QByteArray& rawLine : lines) {
+        const QString line = QString::fromUtf8(rawLine).trimmed();
+        if (line.isEmpty()) continue;
+
+        if (line.startsWith("#EXT-X-STREAM-INF:")) {
+            qCWarning(segmentPrefetcher) << "Expected a media playlist, got a master playlist";
+            return;
+        } else if (line.startsWith("#EXT-X-MEDIA-SEQUENCE:")) {
+            sequence = line.mid(22).toLongLong();
+        } else if (line.startsWith("#EXT-X-TARGETDURATION:")) {
+            targetMs = qRound64(line.mid(22).toDouble() * 1000.0);
+        } else if (line.startsWith("#EXTINF:")) {
+            durationMs = qRound64(line.mid(8).section(',', 0, 0).toDouble() * 1000.0);
+        } else if (line.startsWith("#EXT-X-BYTERANGE:")) {
+            const QStringList parts = line.mid(17).split('@');
+            const qint64 length = parts.value(0).toLongLong();
+            const qint64 offset = parts.size() > 1 ? parts.at(1).toLongLong() : nextRangeOffset;
+            pendingRange = "bytes=" + QByteArray::number(offset) + "-" + QByteArray::number(offset + length - 1);
+            nextRangeOffset = offset + length;
+        } else if (line.startsWith("#EXT-X-MAP:")) {
+            const auto uri = uriPattern.match(line);
+            if (uri.hasMatch()) {
+                m_initSegment.url = m_playlistUrl.resolved(QUrl(uri.captured(1)));
+                const auto range = rangePattern.match(line);
+                if (range.hasMatch()) {
+                    const qint64 length = range.captured(1).toLongLong();
+                    const qint64 offset = range.captured(2).toLongLong();
+                    m_initSegment.range = "bytes=" + QByteArray::number(offset) + "-" + QByteArray::number(offset + length - 1);
+                }
+            }
+        } else if (line.startsWith("#EXT-X-ENDLIST")) {
+            ended = true;
+        } else if (!line.startsWith('#')) {
+            Segment segment;
+            segment.url = m_playlistUrl.resolved(QUrl(line));
+            segment.range = pendingRange;
+            segment.startMs = startMs;
+            segment.durationMs = durationMs;
+            segments.insert(sequence++, segment);
+
+            startMs += durationMs;
+            pendingRange.clear();
+        }
+    }
+
+    m_live = !ended;
+    addSegments(segments, true);
+
+    // RFC 8216 6.3.4: reload after the target duration
+    if (m_live) {
+        m_reloadTimer->start(std::max<qint64>(MIN_RELOAD_INTERVAL_MS, targetMs > 0 ? targetMs : RETRY_INTERVAL_MS));
+    }
+}
+
+void SegmentPrefetcher::parseDashManifest(const QByteArray& manifest)
+{
+    QXmlStreamReader xml(manifest);
+    QMap<qint64, Segment> segments;
+
+    QList<QUrl> baseStack{m_playlistUrl};
+    DashTiming setTiming;
+    bool videoSet = false;
+    bool found = false;
+    bool inPeriod = false;
+    qint64 presentationMs = 0;
+    qint64 availabilityStartMs = 0;
+    qint64 timeShiftMs = 0;
+    qint64 updateMs = 0;
+
+    while (!xml.atEnd() && !found) {
+        xml.readNext();
+
+        if (xml.isEndElement()) {
+            baseStack.removeLast();
+            if (xml.name() == QStringView(u"Period")) {
+                // Only the first Period is followed
+                break;
+            }
+            continue;
+        }
+        if (!xml.isStartElement()) continue;
+
+        const QXmlStreamAttributes attributes = xml.attributes();
+        const auto name = xml.name();
+
+        if (name == QStringView(u"BaseURL")) {
+            // Applies to the enclosing element, which is on top of the stack
+            const QString text = xml.readElementText().trimmed();
+            baseStack.last() = baseStack.last().resolved(QUrl(text));
+            continue;
+        }
+
+        baseStack.append(baseStack.last());
+
+        if (name == QStringView(u"MPD")) {
+            m_live = attributes.value("type") == QStringView(u"dynamic");
+            presentationMs = parseIsoDurationMs(attributes.value("mediaPresentationDuration").toString());
+            timeShiftMs = parseIsoDurationMs(attributes.value("timeShiftBufferDepth").toString());
+            updateMs = parseIsoDurationMs(attributes.value("minimumUpdatePeriod").toString());
+            const QDateTime availabilityStart = QDateTime::fromString(attributes.value("availabilityStartTime").toString(),
+                                                                       Qt::ISODate);
+            availabilityStartMs = availabilityStart.isValid() ? availabilityStart.toMSecsSinceEpoch() : 0;
+        } else if (name == QStringView(u"Period")) {
+            inPeriod = true;
+        } else if (name == QStringView(u"AdaptationSet") && inPeriod) {
+            const QString type = attributes.value("contentType").toString() + attributes.value("mimeType").toString();
+            videoSet = type.contains("video") || type.isEmpty();
+            setTiming = DashTiming();
+        } else if ((name == QStringView(u"SegmentTemplate") || name == QStringView(u"SegmentList")) && inPeriod) {
+            // AdaptationSet level; the Representation's own is read below
+            readTiming(xml, setTiming);
+            baseStack.removeLast();
+        } else if (name == QStringView(u"Representation") && inPeriod) {
+            const QString id = attributes.value("id").toString();
+            const bool wanted = m_representationId.isEmpty()
+                ? (videoSet || attributes.value("mimeType").contains(u"video"))
+                : id == m_representationId;
+            if (!wanted) {
+                xml.skipCurrentElement();
+                baseStack.removeLast();
+                continue;
+            }
+
+            const qint64 bandwidth = attributes.value("bandwidth").toLongLong();
+            DashTiming timing = setTiming;
+            while (xml.readNextStartElement()) {
+                if (xml.name() == QStringView(u"BaseURL")) {
+                    baseStack.last() = baseStack.last().resolved(QUrl(xml.readElementText().trimmed()));
+                } else if (xml.name() == QStringView(u"SegmentTemplate") || xml.name() == QStringView(u"SegmentList")) {
+                    readTiming(xml, timing);
+                } else {
+                    xml.skipCurrentElement();
+                }
+            }
+
+            const QUrl base = baseStack.last();
+            const double msPerUnit = 1000.0 / timing.timescale;
+
+            if (!timing.initialization.isEmpty()) {
+                m_initSegment.url = base.resolved(QUrl(expandTemplate(timing.initialization, id, bandwidth, 0, 0)));
+                m_initSegment.range = toRangeHeader(timing.initializationRange);
+            }
+
+            if (!timing.segmentUrls.isEmpty()) {
+                for (int i = 0; i < timing.segmentUrls.size(); ++i) {
+                    Segment segment;
+                    segment.url = base.resolved(QUrl(timing.segmentUrls.at(i)));
+                    segment.range = toRangeHeader(timing.segmentRanges.value(i));
+                    segment.startMs = qRound64(i * timing.duration * msPerUnit);
+                    segment.durationMs = qRound64(timing.duration * msPerUnit);
+                    segments.insert(timing.startNumber + i, segment);
+                }
+            } else if (!timing.timeline.isEmpty()) {
+                qint64 number = timing.startNumber;
+                qint64 time = 0;
+                for (const DashTiming::TimelineEntry& entry : timing.timeline) {
+                    if (entry.time >= 0) time = entry.time;
+                    // A negative repeat runs to the next entry; live edge only, one is enough
+                    for (qint64 r = 0; r <= std::max<qint64>(0, entry.repeat); ++r) {
+                        Segment segment;
+                        segment.url = base.resolved(QUrl(expandTemplate(timing.media, id, bandwidth, number, time)));
+                        segment.startMs = qRound64((time - timing.presentationTimeOffset) * msPerUnit);
+                        segment.durationMs = qRound64(entry.duration * msPerUnit);
+                        segments.insert(number++, segment);
+                        time += entry.duration;
+                    }
+                }
+            } else if (timing.duration > 0 && !timing.media.isEmpty()) {
+                const double segmentMs = timing.duration * msPerUnit;
+                qint64 first = 0;
+                qint64 count = 0;
+                if (m_live && availabilityStartMs > 0) {
+                    // Numbers count from availabilityStartTime; stay inside the time-shift window
+                    const qint64 elapsed = QDateTime::currentMSecsSinceEpoch() - availabilityStartMs;
+                    const qint64 last = static_cast<qint64>(elapsed / segmentMs) - 1;
+                    first = std::max<qint64>(0, last - static_cast<qint64>((timeShiftMs > 0 ? timeShiftMs : segmentMs * m_depth) / segmentMs));
+                    count = last - first + 1;
+                } else if (!m_live) {
+                    count = static_cast<qint64>(std::ceil(presentationMs / segmentMs));
+                }
+
+                for (qint64 i = first; i < first + count; ++i) {
+                    const qint64 number = timing.startNumber + i;
+                    Segment segment;
+                    segment.url = base.resolved(QUrl(expandTemplate(timing.media, id, bandwidth, number,
+                                                                    i * timing.duration)));
+                    segment.startMs = qRound64(i * segmentMs);
+                    segment.durationMs = qRound64(segmentMs);
+                    segments.insert(number, segment);
+                }
+            }
+
+            found = true;
+        }
+    }
+
+    if (xml.hasError() && !found) {
+        qCWarning(segmentPrefetcher) << "Malformed DASH manifest:" << xml.errorString();
+        return;
+    }
+
+    addSegments(segments, false);
+
+    if (m_live) {
+        m_reloadTimer->start(std::max<qint64>(MIN_RELOAD_INTERVAL_MS, updateMs > 0 ? updateMs : RETRY_INTERVAL_MS));
+    }
+}
+
+void SegmentPrefetcher::addSegments(QMap<qint64, Segment> segments, bool relativeTimes)
+{
+    // HLS times only count from the first listed segment. Carry the
+    // offset over from a segment both lists share, so they continue across
+    // live reloads and rendition switches
+    if (relativeTimes && !segments.isEmpty() && !m_segments.isEmpty()) {
+        qint64 offset = 0;
+        bool anchored = false;
+        for (auto it = segments.cbegin(); it != segments.cend(); ++it) {
+            const auto known = m_segments.constFind(it.key());
+            if (known != m_segments.cend()) {
+                offset = known->startMs - it->startMs;
+                anchored = true;
+                break;
+            }
+        }
+        if (!anchored && segments.firstKey() > m_segments.lastKey()) {
+            offset = m_segments.last().startMs + m_segments.last().durationMs;
+        }
+        for (Segment& segment : segments) {
+            segment.startMs += offset;
+        }
+    }
+
+    m_segments = segments;
+    schedulePrefetch();
+}
+
+QString SegmentPrefetcher::expandTemplate(const QString& pattern, const QString& representationId,
+                                          qint64 bandwidth, qint64 number, qint64 time)
+{
+    static const QRegularExpression identifier(R"(\$(RepresentationID|Number|Bandwidth|Time)(?:%0(\d+)d)?\$)");
+
+    QString result = pattern;
+    result.replace("$$", QString(QChar(0xFFFF)));
+
+    QRegularExpressionMatch match;
+    int from = 0;
+    while ((match = identifier.match(result, from)).hasMatch()) {
+        const QString name = match.captured(1);
+        const int width = match.captured(2).toInt();
+        QString value;
+        if (name == "RepresentationID") {
+            value = representationId;
+        } else {
+            const qint64 numeric = name == "Number" ? number : name == "Bandwidth" ? bandwidth : time;
+            value = QString("%1").arg(numeric, width, 10, QLatin1Char('0'));
+        }
+        result.replace(match.capturedStart(), match.capturedLength(), value);
+        from = match.capturedStart() + value.size();
+    }
+
+    result.replace(QChar(0xFFFF), QLatin1Char('$'));
+    return result;
+}
+
+qint64 SegmentPrefetcher::parseIsoDurationMs(const QString& duration)
+{
+    // xs:duration as used by MPDs, e.g. PT2S or PT1M30.5S
+    static const QRegularExpression pattern(R"(^PT(?:(\d+(?:\.\d+)?)H)?(?:(\d+(?:\.\d+)?)M)?(?:(\d+(?:\.\d+)?)S)?$)");
+
+    const auto match = pattern.match(duration);
+    if (!match.hasMatch()) return 0;
+
+    const double seconds = match.captured(1).toDouble() * 3600.0 + match.captured(2).toDouble() * 60.0 +
+                           match.captured(3).toDouble();
+    return qRound64(seconds * 1000.0);
+}
+
+// Prefetching
+
+void SegmentPrefetcher::schedulePrefetch()
+{
+    if (!m_network || m_segments.isEmpty()) {
+        return;
+    }
+
+    QList<const Segment*> wanted;
+    if (m_initSegment.url.isValid()) {
+        wanted.append(&m_initSegment);
+    }
+    int ahead = 0;
+    for (auto it = m_segments.cbegin(); it != m_segments.cend() && ahead < m_depth; ++it) {
+        if (it->startMs + it->durationMs > m_positionMs) {
+            wanted.append(&it.value());
+            ++ahead;
+        }
+    }
+
+    for (const Segment* segment : wanted) {
+        if (m_prefetchesRunning >= PARALLEL_FETCHES) {
+            break;
+        }
+
+        const QString key = cacheKey(segment->url, segment->range);
+        if (m_inFlight.contains(key) || m_cache->contains(key)) {
+            continue;
+        }
+
+        startFetch(segment->url, segment->range, true, false);
+    }
+}
+
+QNetworkRequest SegmentPrefetcher::createRequest(const QUrl& url, const QByteArray& range) const
+{
+    QNetworkRequest request(url);
+    NetworkService::configureRequest(request, NetworkService::RequestClass::Playback);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    if (!m_userAgent.isEmpty()) {
+        request.setRawHeader("User-Agent", m_userAgent);
+    }
+    if (!range.isEmpty()) {
+        request.setRawHeader("Range", range);
+    }
+    return request;
+}
+
+QNetworkReply* SegmentPrefetcher::startFetch(const QUrl& url, const QByteArray& range, bool prefetch, bool passThrough)
+{
+    QNetworkReply* reply = m_network->get(createRequest(url, range));
+    connect(reply, &QNetworkReply::finished, this, &SegmentPrefetcher::onFetchFinished);
+
+    // Background requests on the shared client wait for segments
+    NetworkService::instance().trackPlaybackTransfer(reply);
+
+    Fetch fetch;
+    fetch.url = url;
+    fetch.range = range;
+    fetch.prefetch = prefetch;
+    fetch.passThrough = passThrough;
+    m_fetches.insert(reply, fetch);
+
+    if (!passThrough) {
+        m_inFlight.insert(cacheKey(url, range), reply);
+    }
+    if (prefetch) {
+        ++m_prefetchesRunning;
+    }
+
+    return reply;
+}
+
+void SegmentPrefetcher::onFetchFinished()
+{
+    auto* reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply || !m_fetches.contains(reply)) {
+        return;
+    }
+    reply->deleteLater();
+
+    const Fetch fetch = m_fetches.take(reply);
+    if (!fetch.passThrough) {
+        m_inFlight.remove(cacheKey(fetch.url, fetch.range));
+    }
+    if (fetch.prefetch) {
+        --m_prefetchesRunning;
+    }
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const bool ok = reply->error() == QNetworkReply::NoError && status >= 200 && status < 300;
+
+    QByteArray body;
+    QByteArray headers;
+    if (ok) {
+        body = reply->readAll();
+        QByteArray contentType = reply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
+        headers += "Content-Type: " + (contentType.isEmpty() ? QByteArray("application/octet-stream") : contentType) + "\r\n";
+
+        if (fetch.passThrough) {
+            body = rewritePlaylist(body);
+        } else {
+            m_cache->store(cacheKey(fetch.url, fetch.range), body);
+            emit segmentCached(fetch.url, body.size(), fetch.prefetch);
+        }
+        if (status == 206 && reply->hasRawHeader("Content-Range")) {
+            headers += "Content-Range: " + reply->rawHeader("Content-Range") + "\r\n";
+        }
+    } else {
+        qCDebug(segmentPrefetcher) << "Fetch failed:" << fetch.url.toString() << status << reply->errorString();
+    }
+
+    for (const Waiter& waiter : fetch.waiters) {
+        if (!waiter.socket) continue;
+
+        if (ok) {
+            respond(waiter.socket, status, status == 206 ? "Partial Content" : "OK", headers, body, waiter.headOnly);
+        } else {
+            // Pass origin errors through, anything else is a gateway failure
+            const int errorStatus = status >= 400 ? status : 502;
+            respond(waiter.socket, errorStatus, errorStatus == 502 ? "Bad Gateway" : "Error", QByteArray(), QByteArray(), waiter.headOnly);
+        }
+        resumeClient(waiter.socket);
+    }
+
+    schedulePrefetch();
+}
+
+// Gateway
+
+void SegmentPrefetcher::onGatewayConnection()
+{
+    while (QTcpSocket* socket = m_gateway->nextPendingConnection()) {
+        m_clients.insert(socket, ClientState());
+        connect(socket, &QTcpSocket::readyRead, this, &SegmentPrefetcher::onClientReadyRead);
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_clients.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void SegmentPrefetcher::onClientReadyRead()
+{
+    if (auto* socket = qobject_cast<QTcpSocket*>(sender())) {
+        processClient(socket);
+    }
+}
+
+void SegmentPrefetcher::processClient(QTcpSocket* socket)
+{
+    auto it = m_clients.find(socket);
+    if (it == m_clients.end()) {
+        return;
+    }
+
+    it->input += socket->readAll();
+
+    // One request at a time, so pipelined responses stay in order
+    while (!it->waiting) {
+        const int end = it->input.indexOf("\r\n\r\n");
+        if (end < 0) {
+            if (it->input.size() > MAX_HEADER_BYTES) {
+                respond(socket, 431, "Request Header Fields Too Large", QByteArray(), QByteArray(), false);
+                socket->disconnectFromHost();
+            }
+            return;
+        }
+
+        const QByteArray head = it->input.left(end);
+        it->input.remove(0, end + 4);
+        it->waiting = handleRequest(socket, head);
+
+        // handleRequest() may have answered on a socket that went away
+        it = m_clients.find(socket);
+        if (it == m_clients.end()) {
+            return;
+        }
+    }
+}
+
+void SegmentPrefetcher::resumeClient(QTcpSocket* socket)
+{
+    auto it = m_clients.find(socket);
+    if (it == m_clients.end()) {
+        return;
+    }
+
+    it->waiting = false;
+    QMetaObject::invokeMethod(this, [this, socket = QPointer<QTcpSocket>(socket)]() {
+        if (socket) {
+            processClient(socket);
+        }
+    }, Qt::QueuedConnection);
+}
+
+bool SegmentPrefetcher::handleRequest(QTcpSocket* socket, const QByteArray& head)
+{
+    const QList<QByteArray> lines = head.split('\n');
+    const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+    if (requestLine.size() < 3) {
+        respond(socket, 400, "Bad Request", QByteArray(), QByteArray(), false);
+        return false;
+    }
+
+    const QByteArray method = requestLine.at(0);
+    const QByteArray target = requestLine.at(1);
+    const bool headOnly = method == "HEAD";
+    if (method != "GET" && !headOnly) {
+        respond(socket, 405, "Method Not Allowed", "Allow: GET, HEAD\r\n", QByteArray(), false);
+        return false;
+    }
+
+    QByteArray range;
+    for (int i = 1; i < lines.size(); ++i) {
+        const QByteArray line = lines.at(i).trimmed();
+        if (line.toLower().startsWith("range:")) {
+            range = line.mid(6).trimmed();
+        }
+    }
+    if (range == "bytes=0-") {
+        range.clear();
+    }
+
+    // /o/<scheme>/<authority><path>
+    QUrl remote;
+    if (target.startsWith("/o/")) {
+        const QByteArray rest = target.mid(3);
+        const int slash = rest.indexOf('/');
+        if (slash > 0) {
+            remote = QUrl(QString::fromLatin1(rest.left(slash) + "://" + rest.mid(slash + 1)));
+        }
+    }
+    if (!remote.isValid() || remote.host().isEmpty() || (remote.scheme() != "http" && remote.scheme() != "https")) {
+        respond(socket, 404, "Not Found", QByteArray(), QByteArray(), headOnly);
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&m_hostMutex);
+        if (!m_allowedHosts.contains(remote.host().toLower())) {
+            locker.unlock();
+            qCWarning(segmentPrefetcher) << "Gateway request for unmapped host" << remote.host();
+            respond(socket, 403, "Forbidden", QByteArray(), QByteArray(), headOnly);
+            return false;
+        }
+    }
+
+    const Waiter waiter{socket, headOnly};
+
+    // Playlists change while live; always fetch and rewrite them
+    if (isPlaylist(remote)) {
+        m_fetches[startFetch(remote, range, false, true)].waiters.append(waiter);
+        return true;
+    }
+
+    const QString key = cacheKey(remote, range);
+    const QByteArray body = m_cache->read(key);
+    if (!body.isEmpty()) {
+        QByteArray headers = "Content-Type: application/octet-stream\r\n";
+        if (!range.isEmpty()) {
+            qint64 start = 0;
+            qint64 length = 0;
+            parseRange(range, -1, start, length);
+            headers += "Content-Range: " + contentRange(start, body.size(), -1) + "\r\n";
+        }
+        respond(socket, range.isEmpty() ? 200 : 206, range.isEmpty() ? "OK" : "Partial Content", headers, body, headOnly);
+        return false;
+    }
+
+    // A range of a file that is cached whole
+    if (!range.isEmpty()) {
+        const QByteArray whole = m_cache->read(cacheKey(remote, QByteArray()));
+        qint64 start = 0;
+        qint64 length = 0;
+        if (!whole.isEmpty() && parseRange(range, whole.size(), start, length)) {
+            const QByteArray headers = "Content-Type: application/octet-stream\r\nContent-Range: " +
+                                       contentRange(start, length, whole.size()) + "\r\n";
+            respond(socket, 206, "Partial Content", headers, whole.mid(start, length), headOnly);
+            return false;
+        }
+    }
+
+    // Join a prefetch of the same segment rather than fetching it twice
+    QNetworkReply* reply = m_inFlight.value(key);
+    if (!reply) {
+        reply = startFetch(remote, range, false, false);
+    }
+    m_fetches[reply].waiters.append(waiter);
+    return true;
+}
+
+void SegmentPrefetcher::respond(QTcpSocket* socket, int status, const QByteArray& reason, const QByteArray& headers,
+                                const QByteArray& body, bool headOnly)
+{
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + " " + reason + "\r\n" + headers;
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += "Accept-Ranges: bytes\r\nConnection: keep-alive\r\n\r\n";
+    if (!headOnly) {
+        response += body;
+    }
+    socket->write(response);
+}
+
+QByteArray SegmentPrefetcher::rewritePlaylist(const QByteArray& playlist)
+{
+    // Relative URLs resolve against the gateway already; only absolute ones
+    // would escape it. Covers HLS URI lines and attributes as well as MPD
+    // BaseURL and template values without parsing either format
+    static const QRegularExpression absoluteUrl(R"(https?://[^\s"'<>]+)");
+
+    QString text = QString::fromUtf8(playlist);
+    QString result;
+    result.reserve(text.size());
+
+    int last = 0;
+    auto it = absoluteUrl.globalMatch(text);
+    while (it.hasNext()) {
+        const auto match = it.next();
+        result += QStringView(text).mid(last, match.capturedStart() - last);
+
+        // MPD values are XML-escaped
+        const QString original = match.captured(0);
+        const QUrl mapped = gatewayUrl(QUrl(QString(original).replace("&amp;", "&")));
+        result += mapped.isValid() ? mapped.toString(QUrl::FullyEncoded).replace("&", "&amp;") : original;
+        last = match.capturedEnd();
+    }
+    result += QStringView(text).mid(last);
+
+    return result.toUtf8();
+}
+
+bool SegmentPrefetcher::isPlaylist(const QUrl& url)
+{
+    const QString path = url.path().toLower();
+    return path.endsWith(".m3u8") || path.endsWith(".m3u") || path.endsWith(".mpd");
+}
+
+QString SegmentPrefetcher::cacheKey(const QUrl& url, const QByteArray& range)
+{
+    const QString key = url.toString(QUrl::FullyEncoded);
+    return range.isEmpty() ? key : key + '#' + QString::fromLatin1(range);
+}
+
+bool SegmentPrefetcher::parseRange(const QByteArray& range, qint64 size, qint64& start, qint64& length)
+{
+    // A single "bytes=first-[last]" range; suffix ranges need the size
+    if (!range.startsWith("bytes=") || range.contains(',')) {
+        return false;
+    }
+
+    const QByteArray spec = range.mid(6).trimmed();
+    const int dash = spec.indexOf('-');
+    if (dash <= 0) {
+        return false;
+    }
+
+    start = spec.left(dash).toLongLong();
+    const QByteArray last = spec.mid(dash + 1).trimmed();
+    const qint64 end = last.isEmpty() ? size - 1 : last.toLongLong();
+    if (size >= 0 && (start >= size || end >= size)) {
+        return false;
+    }
+
+    length = end - start + 1;
+    return length > 0 || size < 0;
+}
+
+QByteArray SegmentPrefetcher::contentRange(qint64 start, qint64 length, qint64 total)
+{
+    return "bytes " + QByteArray::number(start) + "-" + QByteArray::number(start + length - 1) + "/" +
+           (total >= 0 ? QByteArray::number(total) : QByteArray("*"));
+}
@@ -0,0 +1,505 @@
+#include "network/ShareReadAhead.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMimeDatabase>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThreadPool>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(shareReadAhead, "eonplay.network.readahead")
+
+namespace {
+QByteArray headerValue(const QList<QByteArray>& lines, const QByteArray& name)
+{
+    for (const QByteArray& line : lines) {
+        const int colon = line.indexOf(':');
+        if (colon > 0 && line.left(colon).trimmed().compare(name, Qt::CaseInsensitive) == 0) {
+            return line.mid(colon + 1).trimmed();
+        }
+    }
+    return QByteArray();
+}
+
+/**
+ * Parse "bytes=a-b", "bytes=a-" or "bytes=-n" against a file size
+ */
+bool parseRange(const QByteArray& range, qint64 size, qint64& start, qint64& end)
+{
+    if (!range.startsWith("bytes=") || range.contains(',')) {
+        return false;
+    }
+    const QList<QByteArray> bounds = range.mid(6).split('-');
+    if (bounds.size() != 2) {
+        return false;
+    }
+
+    bool valid = true;
+    if (bounds.at(0).isEmpty()) {
+        const qint64 suffix = bounds.at(1).toLongLong(&valid);
+        start = std::max<qint64>(0, size - suffix);
+        end = size;
+    } else {
+        start = bounds.at(0).toLongLong(&valid);
+        end = size;
+        if (valid && !bounds.at(1).isEmpty()) {
+            end = std::min(size, bounds.at(1).toLongLong(&valid) + 1);
+        }
+    }
+    return valid && start >= 0 && start < end;
+}
+}
+
+ShareReadAhead::ShareReadAhead(QObject* parent)
+    : QObject(parent)
+{
+}
+
+ShareReadAhead::~ShareReadAhead()
+{
+    stop();
+}
+
+QUrl ShareReadAhead::fileUrl(const QString& localPath) const
+{
+    const quint16 port = m_port;
+    if (port == 0) {
+        return QUrl();
+    }
+
+    QMutexLocker locker(&m_rootMutex);
+    const QString canonical = QFileInfo(localPath).canonicalFilePath();
+    if (m_root.isEmpty() || !canonical.startsWith(m_root + '/')) {
+        return QUrl();
+    }
+
+    QUrl url;
+    url.setScheme("http");
+    url.setHost("127.0.0.1");
+    url.setPort(port);
+    url.setPath("/f/" + canonical.mid(m_root.size() + 1), QUrl::DecodedMode);
+    return url;
+}
+
+void ShareReadAhead::start()
+{
+    if (m_gateway) {
+        return;
+    }
+
+    m_readPool = new QThreadPool(this);
+    m_readPool->setMaxThreadCount(PARALLEL_READS);
+
+    m_gateway = new QTcpServer(this);
+    connect(m_gateway, &QTcpServer::newConnection, this, &ShareReadAhead::onGatewayConnection);
+    if (!m_gateway->listen(QHostAddress::LocalHost, 0)) {
+        qCWarning(shareReadAhead) << "Read-ahead gateway could not listen:" << m_gateway->errorString();
+        return;
+    }
+
+    m_port = m_gateway->serverPort();
+    qCDebug(shareReadAhead) << "Read-ahead gateway on port" << m_port;
+    emit gatewayReady(m_port);
+}
+
+void ShareReadAhead::stop()
+{
+    m_port = 0;
+    if (m_gateway) {
+        m_gateway->close();
+    }
+    for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it) {
+        it.key()->abort();
+    }
+    if (m_readPool) {
+        m_readQueue.clear();
+        m_readPool->waitForDone();
+    }
+}
+
+void ShareReadAhead::setRoot(const QString& mountPath)
+{
+    {
+        QMutexLocker locker(&m_rootMutex);
+        m_root = mountPath.isEmpty() ? QString() : QFileInfo(mountPath).canonicalFilePath();
+    }
+
+    // Nothing from the previous share is served or kept
+    const QList<QTcpSocket*> sockets = m_clients.keys();
+    for (QTcpSocket* socket : sockets) {
+        socket->abort();
+    }
+    m_files.clear();
+    m_readQueue.clear();
+    m_cachedBytes = 0;
+    qCDebug(shareReadAhead) << "Serving share" << (mountPath.isEmpty() ? QStringLiteral("(none)") : mountPath);
+}
+
+void ShareReadAhead::setCacheSize(qint64 bytes)
+{
+    // At least a full window, or sequential reads would evict themselves
+    m_maxBytes = std::max(bytes, MAX_WINDOW_BLOCKS * BLOCK_BYTES);
+    evict();
+}
+
+// Gateway
+
+void ShareReadAhead::onGatewayConnection()
+{
+    while (QTcpSocket* socket = m_gateway->nextPendingConnection()) {
+        m_clients.insert(socket, Client());
+        connect(socket, &QTcpSocket::readyRead, this, &ShareReadAhead::onClientReadyRead);
+        connect(socket, &QTcpSocket::bytesWritten, this, &ShareReadAhead::onClientBytesWritten);
+        // Queued, so a socket never goes away under pump()
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            auto it = m_clients.find(socket);
+            if (it != m_clients.end()) {
+                auto file = m_files.find(it->path);
+                if (!it->path.isEmpty() && file != m_files.end()) {
+                    --file->readers;
+                }
+                m_clients.erase(it);
+            }
+            socket->deleteLater();
+        }, Qt::QueuedConnection);
+    }
+}
+
+void ShareReadAhead::onClientReadyRead()
+{
+    auto* socket = qobject_cast<QTcpSocket*>(sender());
+    auto it = m_clients.find(socket);
+    if (it == m_clients.end()) {
+        return;
+    }
+
+    // One request per connection: the response runs until the range is sent
+    if (!it->path.isEmpty()) {
+        return;
+    }
+    it->input += socket->readAll();
+    const int end = it->input.indexOf("\r\n\r\n");
+    if (end < 0) {
+        if (it->input.size() > MAX_HEADER_BYTES) {
+            respond(socket, 431, "Request Header Fields Too Large", "Content-Length: 0\r\n");
+            socket->disconnectFromHost();
+        }
+        return;
+    }
+
+    const QByteArray head = it->input.left(end);
+    it->input.clear();
+    handleRequest(socket, *it, head);
+}
+
+void ShareReadAhead::onClientBytesWritten()
+{
+    if (auto* socket = qobject_cast<QTcpSocket*>(sender())) {
+        pump(socket);
+    }
+}
+
+void ShareReadAhead::handleRequest(QTcpSocket* socket, Client& client, const QByteArray& head)
+{
+    const QList<QByteArray> lines = head.split('\n');
+    const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+    if (requestLine.size() < 3) {
+        respond(socket, 400, "Bad Request", "Content-Length: 0\r\n");
+        socket->disconnectFromHost();
+        return;
+    }
+
+    const QByteArray method = requestLine.at(0);
+    const bool headOnly = method == "HEAD";
+    if (method != "GET" && !headOnly) {
+        respond(socket, 405, "Method Not Allowed", "Allow: GET, HEAD\r\nContent-Length: 0\r\n");
+        socket->disconnectFromHost();
+        return;
+    }
+
+    const QString path = resolve(requestLine.at(1));
+    const QFileInfo info(path);
+    if (path.isEmpty() || !info.isFile()) {
+        respond(socket, 404, "Not Found", "Content-Length: 0\r\n");
+        socket->disconnectFromHost();
+        return;
+    }
+
+    const qint64 size = info.size();
+    const QByteArray range = headerValue(lines, "Range");
+    qint64 start = 0;
+    qint64 end = size;
+    if (!range.isEmpty() && !parseRange(range, size, start, end)) {
+        respond(socket, 416, "Range Not Satisfiable",
+                "Content-Range: bytes */" + QByteArray::number(size) + "\r\nContent-Length: 0\r\n");
+        socket->disconnectFromHost();
+        return;
+    }
+
+    static const QMimeDatabase mimeDatabase;
+    QByteArray headers = "Content-Type: "
+                         + mimeDatabase.mimeTypeForFile(path, QMimeDatabase::MatchExtension).name().toLatin1()
+                         + "\r\nAccept-Ranges: bytes\r\nContent-Length: " + QByteArray::number(end - start) + "\r\n";
+    if (!range.isEmpty()) {
+        headers += "Content-Range: bytes " + QByteArray::number(start) + '-' + QByteArray::number(end - 1) + '/'
+                   + QByteArray::number(size) + "\r\n";
+    }
+    respond(socket, range.isEmpty() ? 200 : 206, range.isEmpty() ? "OK" : "Partial Content", headers);
+    if (headOnly || start == end) {
+        socket->disconnectFromHost();
+        return;
+    }
+
+    CachedFile& file = m_files[path];
+    file.size = size;
+    ++file.readers;
+
+    // Anything but a continuation of the last read is a seek
+    const bool sequential = file.readEnd >= 0 && qAbs(start - file.readEnd) < BLOCK_BYTES;
+    if (!sequential) {
+        file.window = MIN_WINDOW_BLOCKS;
+        m_readQueue.removeIf([&](const QPair<QString, qint64>& read) {
+            if (read.first != path) {
+                return false;
+            }
+            file.reading.remove(read.second);
+            return true;
+        });
+        qCDebug(shareReadAhead) << "Seek to" << start << "in" << path;
+    }
+
+    client.path = path;
+    client.position = start;
+    client.end = end;
+    pump(socket);
+}
+
+void ShareReadAhead::respond(QTcpSocket* socket, int status, const QByteArray& reason, const QByteArray& headers)
+{
+    socket->write("HTTP/1.1 " + QByteArray::number(status) + ' ' + reason + "\r\n" + headers
+                  + "Connection: close\r\n\r\n");
+}
+
+QString ShareReadAhead::resolve(const QByteArray& target) const
+{
+    const QString path = QUrl(QString::fromUtf8(target)).path(QUrl::FullyDecoded);
+    if (!path.startsWith("/f/")) {
+        return QString();
+    }
+
+    QMutexLocker locker(&m_rootMutex);
+    if (m_root.isEmpty()) {
+        return QString();
+    }
+    // Canonical paths, so ".." and symlinks cannot leave the share
+    const QString canonical = QFileInfo(m_root + '/' + path.mid(3)).canonicalFilePath();
+    return canonical.startsWith(m_root + '/') ? canonical : QString();
+}
+
+// Cache
+
+void ShareReadAhead::pump(QTcpSocket* socket)
+{
+    auto it = m_clients.find(socket);
+    if (it == m_clients.end() || it->path.isEmpty()) {
+        return;
+    }
+    Client& client = *it;
+    auto fileIt = m_files.find(client.path);
+    if (fileIt == m_files.end()) {
+        return;
+    }
+    CachedFile& file = *fileIt;
+
+    while (client.position < client.end && socket->bytesToWrite() < SOCKET_BACKLOG_BYTES) {
+        const qint64 index = client.position / BLOCK_BYTES;
+        auto block = file.blocks.find(index);
+        if (block == file.blocks.end()) {
+            queueRead(client.path, file, index, true);
+            break;
+        }
+
+        block->lastUse = ++m_useCounter;
+        const qint64 offset = client.position - index * BLOCK_BYTES;
+        const qint64 length = std::min(client.end - client.position, qint64(block->data.size()) - offset);
+        if (length <= 0) {
+            // The file shrank under us
+            client.end = client.position;
+            break;
+        }
+        socket->write(block->data.constData() + offset, length);
+        client.position += length;
+
+        // Each block read through in order widens the window
+        if (client.position % BLOCK_BYTES == 0) {
+            file.window = std::min(file.window * 2, MAX_WINDOW_BLOCKS);
+        }
+    }
+
+    file.readEnd = client.position;
+    readAhead(client.path, file, client.position / BLOCK_BYTES);
+    dispatchReads();
+
+    if (client.position >= client.end) {
+        finishClient(socket, client);
+    }
+}
+
+void ShareReadAhead::finishClient(QTcpSocket* socket, Client& client)
+{
+    auto file = m_files.find(client.path);
+    if (file != m_files.end()) {
+        --file->readers;
+    }
+    client.path.clear();
+    socket->disconnectFromHost();
+}
+
+void ShareReadAhead::readAhead(const QString& path, CachedFile& file, qint64 fromIndex)
+{
+    if (file.size <= 0) {
+        return;
+    }
+    const qint64 lastIndex = std::min((file.size - 1) / BLOCK_BYTES, fromIndex + file.window);
+    for (qint64 index = fromIndex; index <= lastIndex; ++index) {
+        queueRead(path, file, index, false);
+    }
+}
+
+void ShareReadAhead::queueRead(const QString& path, CachedFile& file, qint64 index, bool urgent)
+{
+    if (file.blocks.contains(index)) {
+        return;
+    }
+    const QPair<QString, qint64> read(path, index);
+    if (file.reading.contains(index)) {
+        // A reader waits on it: move it ahead of read-ahead if still queued
+        const qsizetype queued = m_readQueue.indexOf(read);
+        if (urgent && queued > 0) {
+            m_readQueue.move(queued, 0);
+        }
+        return;
+    }
+
+    file.reading.insert(index);
+    if (urgent) {
+        m_readQueue.prepend(read);
+    } else {
+        m_readQueue.append(read);
+    }
+}
+
+void ShareReadAhead::dispatchReads()
+{
+    if (!m_readPool) {
+        return;
+    }
+
+    while (m_readsInFlight < PARALLEL_READS && !m_readQueue.isEmpty()) {
+        const auto [path, index] = m_readQueue.takeFirst();
+        ++m_readsInFlight;
+        m_readPool->start([this, path = path, index = index]() {
+            // Each read has its own handle, so reads overlap on the share
+            QFile file(path);
+            QByteArray data;
+            bool ok = file.open(QIODevice::ReadOnly) && file.seek(index * BLOCK_BYTES);
+            if (ok) {
+                data = file.read(BLOCK_BYTES);
+                ok = !data.isEmpty();
+            }
+            QMetaObject::invokeMethod(this, [this, path, index, data, ok]() {
+                onBlockRead(path, index, data, ok);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void ShareReadAhead::onBlockRead(const QString& path, qint64 index, const QByteArray& data, bool ok)
+{
+    --m_readsInFlight;
+
+    auto fileIt = m_files.find(path);
+    if (fileIt == m_files.end() || !fileIt->reading.remove(index)) {
+        // Dropped by a seek or a new share meanwhile
+        dispatchReads();
+        return;
+    }
+
+    if (ok) {
+        Block block;
+        block.data = data;
+        block.lastUse = ++m_useCounter;
+        fileIt->blocks.insert(index, block);
+        m_cachedBytes += data.size();
+        evict();
+    } else {
+        qCWarning(shareReadAhead) << "Could not read block" << index << "of" << path;
+    }
+
+    QList<QTcpSocket*> readers;
+    for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it) {
+        if (it->path == path) {
+            readers.append(it.key());
+        }
+    }
+    for (QTcpSocket* socket : std::as_const(readers)) {
+        const Client& client = m_clients.value(socket);
+        if (!ok && client.position / BLOCK_BYTES == index) {
+            // libVLC reconnects and retries
+            socket->abort();
+        } else {
+            pump(socket);
+        }
+    }
+    dispatchReads();
+}
+
+void ShareReadAhead::evict()
+{
+    while (m_cachedBytes > m_maxBytes) {
+        // Tier 3: unread files, LRU; 2: behind a reader; 1: beyond its window
+        QString victimPath;
+        qint64 victimIndex = -1;
+        int victimTier = 0;
+        quint64 victimDistance = 0;
+
+        for (auto file = m_files.cbegin(); file != m_files.cend(); ++file) {
+            const qint64 cursor = file->readEnd / BLOCK_BYTES;
+            for (auto block = file->blocks.cbegin(); block != file->blocks.cend(); ++block) {
+                int tier = 0;
+                quint64 distance = 0;
+                if (file->readers <= 0) {
+                    tier = 3;
+                    distance = m_useCounter - block->lastUse;
+                } else if (block.key() < cursor) {
+                    tier = 2;
+                    distance = quint64(cursor - block.key());
+                } else if (block.key() > cursor + file->window) {
+                    tier = 1;
+                    distance = quint64(block.key() - cursor);
+                }
+                if (tier > victimTier || (tier == victimTier && tier > 0 && distance > victimDistance)) {
+                    victimPath = file.key();
+                    victimIndex = block.key();
+                    victimTier = tier;
+                    victimDistance = distance;
+                }
+            }
+        }
+
+        if (victimTier == 0) {
+            // Everything left is inside a reader's window
+            return;
+        }
+
+        auto file = m_files.find(victimPath);
+        m_cachedBytes -= file->blocks.value(victimIndex).data.size();
+        file->blocks.remove(victimIndex);
+        if (file->blocks.isEmpty() && file->readers <= 0 && file->reading.isEmpty()) {
+            m_files.erase(file);
+        }
+    }
+}
@@ -0,0 +1,356 @@
+#include "network/SyncedPlayback.h"
+#include "network/ClockSync.h"
+#include "network/NetworkDiscoveryManager.h"
+#include "audio/AudioDSPGraph.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+
+Q_LOGGING_CATEGORY(syncedPlayback, "eonplay.network.syncedplayback")
+
+namespace {
+
+const QString TIMELINE_CHANNEL = QStringLiteral("timeline");
+constexpr qint64 NS_PER_MS = 1000000;
+
+// A render position older than this means the output has stalled
+constexpr qint64 STALE_POSITION_NS = 1000000000;
+
+} // namespace
+
+SyncedPlayback::SyncedPlayback(QObject* parent)
+    : QObject(parent)
+    , m_leader(false)
+    , m_clockThread(new QThread(this))
+    , m_clock(new ClockSync)
+    , m_controlTimer(new QTimer(this))
+    , m_announceTimer(new QTimer(this))
+    , m_timelinePending(false)
+    , m_localStartNs(0)
+    , m_startGroupNs(0)
+    , m_graph(nullptr)
+    , m_outputSampleRate(48000)
+    , m_outputLatencyNs(0)
+    , m_integral(0.0)
+    , m_lastErrorMs(0.0)
+{
+    m_errors.reserve(ERROR_WINDOW);
+
+    // Timestamps are taken when the socket is read, away from the UI thread
+    m_clockThread->setObjectName(QStringLiteral("ClockSync"));
+    m_clock->moveToThread(m_clockThread);
+    connect(m_clockThread, &QThread::finished, m_clock, &QObject::deleteLater);
+    connect(m_clock, &ClockSync::lockChanged, this, &SyncedPlayback::onClockLockChanged);
+    m_clockThread->start();
+    QMetaObject::invokeMethod(m_clock, "start", Qt::QueuedConnection, Q_ARG(quint16, ClockSync::DEFAULT_PORT));
+
+    m_controlTimer->setInterval(CONTROL_INTERVAL_MS);
+    m_controlTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_controlTimer, &QTimer::timeout, this, &SyncedPlayback::control);
+
+    m_announceTimer->setInterval(ANNOUNCE_INTERVAL_MS);
+    connect(m_announceTimer, &QTimer::timeout, this, &SyncedPlayback::announce);
+}
+
+SyncedPlayback::~SyncedPlayback()
+{
+    detachSyncGroup();
+    m_clockThread->quit();
+    m_clockThread->wait();
+}
+
+void SyncedPlayback::attachSyncGroup(NetworkDiscoveryManager* network, const QString& groupId, bool leader)
+{
+    detachSyncGroup();
+
+    m_network = network;
+    m_groupId = groupId;
+    m_leader = leader;
+    if (!network || groupId.isEmpty()) {
+        return;
+    }
+
+    connect(network, &NetworkDiscoveryManager::syncPayloadReceived, this, &SyncedPlayback::onSyncPayloadReceived);
+
+    if (leader) {
+        m_reference = QHostAddress();
+        QMetaObject::invokeMethod(m_clock, "followReference", Qt::QueuedConnection,
+                                  Q_ARG(QHostAddress, QHostAddress()), Q_ARG(quint16, ClockSync::DEFAULT_PORT));
+        m_announceTimer->start();
+        qCInfo(syncedPlayback) << "Leading the timeline of sync group" << groupId;
+    } else {
+        QJsonObject query;
+        query["type"] = "query";
+        network->sendSyncPayload(groupId, TIMELINE_CHANNEL, QJsonDocument(query).toJson(QJsonDocument::Compact));
+        qCInfo(syncedPlayback) << "Following the timeline of sync group" << groupId;
+    }
+}
+
+void SyncedPlayback::detachSyncGroup()
+{
+    if (m_network) {
+        disconnect(m_network, nullptr, this, nullptr);
+    }
+    m_network = nullptr;
+    m_groupId.clear();
+    m_announceTimer->stop();
+    m_controlTimer->stop();
+    m_timelinePending = false;
+}
+
+void SyncedPlayback::setAudioGraph(AudioDSPGraph* graph, int outputSampleRate)
+{
+    m_graph = graph;
+    m_outputSampleRate = qMax(1, outputSampleRate);
+    resetControl();
+
+    // A graph set mid-playback joins on the current timeline
+    if (m_graph && m_timeline.playing && !m_timelinePending) {
+        applyTimeline();
+    }
+}
+
+void SyncedPlayback::play(const QString& mediaUrl, qint64 positionMs)
+{
+    if (!m_leader) {
+        qCWarning(syncedPlayback) << "Only the leader starts the timeline";
+        return;
+    }
+
+    m_timeline.mediaUrl = mediaUrl;
+    m_timeline.positionMs = positionMs;
+    m_timeline.startGroupNs = m_clock->groupTimeNs() + START_LEAD_MS * NS_PER_MS;
+    m_timeline.playing = true;
+    ++m_timeline.revision;
+
+    publish(m_timeline);
+    applyTimeline();
+}
+
+void SyncedPlayback::pause()
+{
+    if (!m_leader || !m_timeline.playing) {
+        return;
+    }
+
+    m_timeline.positionMs = expectedPositionMs();
+    m_timeline.startGroupNs = m_clock->groupTimeNs();
+    m_timeline.playing = false;
+    ++m_timeline.revision;
+
+    publish(m_timeline);
+    applyTimeline();
+}
+
+void SyncedPlayback::seek(qint64 positionMs)
+{
+    if (!m_leader) {
+        return;
+    }
+
+    if (m_timeline.playing) {
+        play(m_timeline.mediaUrl, positionMs);
+        return;
+    }
+
+    m_timeline.positionMs = positionMs;
+    ++m_timeline.revision;
+    publish(m_timeline);
+    applyTimeline();
+}
+
+qint64 SyncedPlayback::expectedPositionMs() const
+{
+    if (!m_timeline.playing) {
+        return m_timeline.positionMs;
+    }
+    const qint64 elapsed = m_clock->groupTimeNs() - m_timeline.startGroupNs;
+    return m_timeline.positionMs + qMax<qint64>(0, elapsed) / NS_PER_MS;
+}
+
+void SyncedPlayback::onSyncPayloadReceived(const QString& groupId, const QString& channel,
+                                           const QString& senderDeviceId, const QByteArray& payload)
+{
+    if (groupId != m_groupId || channel != TIMELINE_CHANNEL) {
+        return;
+    }
+
+    const QJsonObject message = QJsonDocument::fromJson(payload).object();
+    const QString type = message.value("type").toString();
+
+    if (type == "query") {
+        if (m_leader && m_timeline.revision > 0) {
+            publish(m_timeline, senderDeviceId);
+        }
+        return;
+    }
+
+    if (type != "timeline") {
+        return;
+    }
+    if (m_leader) {
+        qCWarning(syncedPlayback) << "Ignoring the timeline of a second leader," << senderDeviceId;
+        return;
+    }
+
+    Timeline timeline;
+    timeline.mediaUrl = message.value("url").toString();
+    timeline.positionMs = message.value("position").toString().toLongLong();
+    timeline.startGroupNs = message.value("start").toString().toLongLong();
+    timeline.playing = message.value("playing").toBool();
+    timeline.revision = message.value("revision").toString().toULongLong();
+
+    // The sender of the timeline keeps the group's clock
+    const QHostAddress reference = addressOf(senderDeviceId);
+    const bool newReference = !reference.isNull() && reference != m_reference;
+    if (newReference) {
+        m_reference = reference;
+        QMetaObject::invokeMethod(m_clock, "followReference", Qt::QueuedConnection,
+                                  Q_ARG(QHostAddress, reference), Q_ARG(quint16, ClockSync::DEFAULT_PORT));
+    }
+
+    // Periodic announcements repeat the timeline already applied
+    const bool changed = timeline.revision != m_timeline.revision || timeline.startGroupNs != m_timeline.startGroupNs ||
+                         timeline.playing != m_timeline.playing || timeline.mediaUrl != m_timeline.mediaUrl;
+    if (!changed && !newReference) {
+        return;
+    }
+
+    m_timeline = timeline;
+    if (!newReference && m_clock->isLocked()) {
+        applyTimeline();
+    } else {
+        m_timelinePending = true;
+        m_controlTimer->stop();
+    }
+}
+
+void SyncedPlayback::onClockLockChanged(bool locked)
+{
+    if (locked && m_timelinePending) {
+        qCDebug(syncedPlayback) << "Clock locked, offset" << m_clock->offsetNs() / 1000 << "us";
+        applyTimeline();
+    }
+}
+
+void SyncedPlayback::announce()
+{
+    // Covers lost messages and peers that missed the query
+    if (m_leader && m_timeline.revision > 0) {
+        publish(m_timeline);
+    }
+}
+
+void SyncedPlayback::publish(const Timeline& timeline, const QString& deviceId)
+{
+    if (!m_network) {
+        return;
+    }
+
+    // 64-bit values as strings, beyond what a JSON double holds exactly
+    QJsonObject message;
+    message["type"] = "timeline";
+    message["url"] = timeline.mediaUrl;
+    message["position"] = QString::number(timeline.positionMs);
+    message["start"] = QString::number(timeline.startGroupNs);
+    message["playing"] = timeline.playing;
+    message["revision"] = QString::number(timeline.revision);
+    m_network->sendSyncPayload(m_groupId, TIMELINE_CHANNEL, QJsonDocument(message).toJson(QJsonDocument::Compact),
+                               deviceId);
+}
+
+void SyncedPlayback::applyTimeline()
+{
+    m_timelinePending = false;
+    resetControl();
+
+    if (!m_timeline.playing) {
+        m_controlTimer->stop();
+        emit pauseRequested(m_timeline.positionMs);
+        return;
+    }
+
+    // Late joiners start further along, on a whole millisecond of the timeline
+    const qint64 earliest = m_clock->groupTimeNs() + START_LEAD_MS * NS_PER_MS;
+    qint64 skipMs = 0;
+    if (earliest > m_timeline.startGroupNs) {
+        skipMs = (earliest - m_timeline.startGroupNs + NS_PER_MS - 1) / NS_PER_MS;
+    }
+    m_startGroupNs = m_timeline.startGroupNs + skipMs * NS_PER_MS;
+    m_localStartNs = m_clock->toLocalTime(m_startGroupNs);
+    const qint64 positionMs = m_timeline.positionMs + skipMs;
+
+    qCInfo(syncedPlayback) << "Starting" << m_timeline.mediaUrl << "at" << positionMs << "ms in"
+                           << (m_localStartNs - ClockSync::localTimeNs()) / NS_PER_MS << "ms";
+
+    emit startScheduled(m_timeline.mediaUrl, positionMs, m_localStartNs);
+    if (m_graph) {
+        m_graph->scheduleStart(m_localStartNs - m_outputLatencyNs, m_outputSampleRate);
+    }
+    m_controlTimer->start();
+}
+
+void SyncedPlayback::resetControl()
+{
+    // The integral holds the drift of the sound card, which outlives a restart
+    m_errors.clear();
+}
+
+void SyncedPlayback::control()
+{
+    if (!m_graph || !m_timeline.playing || !m_clock->isLocked()) {
+        return;
+    }
+
+    const AudioDSPGraph::RenderPosition position = m_graph->renderPosition();
+    const qint64 now = ClockSync::localTimeNs();
+    if (!position.started || position.timestampNs < m_localStartNs - m_outputLatencyNs ||
+        now - position.timestampNs > STALE_POSITION_NS) {
+        return;
+    }
+
+    // Media the timeline has reached when this render call's first frame is heard
+    const qint64 heardGroupNs = m_clock->toGroupTime(position.timestampNs + m_outputLatencyNs);
+    const double expectedSeconds = static_cast<double>(heardGroupNs - m_startGroupNs) / 1e9;
+    const double errorMs = (position.seconds - expectedSeconds) * 1000.0;
+
+    // The median rides out the jitter of when the audio callback runs
+    if (m_errors.size() >= ERROR_WINDOW) {
+        m_errors.removeFirst();
+    }
+    m_errors.append(errorMs);
+    QVector<double> sorted = m_errors;
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    m_lastErrorMs = sorted[sorted.size() / 2];
+
+    if (m_errors.size() >= 3 && std::abs(m_lastErrorMs) > RESYNC_THRESHOLD_MS) {
+        qCWarning(syncedPlayback) << "Output" << m_lastErrorMs << "ms off the timeline, restarting";
+        applyTimeline();
+        return;
+    }
+
+    // Ahead consumes slower; the integral settles on the card's drift
+    const double error = m_lastErrorMs / 1000.0;
+    const double integralLimit = DriftCorrector::MAX_TRIM / INTEGRAL_GAIN;
+    m_integral = qBound(-integralLimit, m_integral + error * CONTROL_INTERVAL_MS / 1000.0, integralLimit);
+    m_graph->setRateTrim(1.0 - PROPORTIONAL_GAIN * error - INTEGRAL_GAIN * m_integral);
+
+    emit errorMeasured(m_lastErrorMs, m_graph->rateTrim());
+}
+
+QHostAddress SyncedPlayback::addressOf(const QString& deviceId) const
+{
+    if (m_network) {
+        const NetworkDiscoveryManager::NetworkDevice device = m_network->getDevice(deviceId);
+        if (!device.address.isNull()) {
+            return device.address;
+        }
+    }
+
+    // Unknown senders are named by their address
+    return QHostAddress(deviceId);
+}
@@ -0,0 +1,746 @@
+#include "network/TimeshiftBuffer.h"
+#include "network/NetworkService.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrlQuery>
+
+Q_LOGGING_CATEGORY(timeshift, "eonplay.network.timeshift")
+
+namespace {
+QMutex registryMutex;
+QHash<QUrl, std::weak_ptr<TimeshiftRing>> registry;
+
+void registerRing(const QUrl& streamUrl, const std::shared_ptr<TimeshiftRing>& ring)
+{
+    QMutexLocker locker(&registryMutex);
+    registry.insert(streamUrl, ring);
+}
+
+void unregisterRing(const QUrl& streamUrl, const std::shared_ptr<TimeshiftRing>& ring)
+{
+    QMutexLocker locker(&registryMutex);
+    auto it = registry.find(streamUrl);
+    if (it != registry.end() && it->lock() == ring) {
+        registry.erase(it);
+    }
+}
+
+QByteArray guessContentType(const QUrl& url)
+{
+    const QString path = url.path().toLower();
+    if (path.endsWith(".aac")) return "audio/aac";
+    if (path.endsWith(".mp3")) return "audio/mpeg";
+    if (path.endsWith(".m4s") || path.endsWith(".mp4") || path.endsWith(".m4a")) return "video/mp4";
+    return "video/mp2t";
+}
+}
+
+TimeshiftBuffer::TimeshiftBuffer(QObject* parent)
+    : QObject(parent)
+{
+}
+
+TimeshiftBuffer::~TimeshiftBuffer()
+{
+    stop();
+}
+
+QUrl TimeshiftBuffer::playbackUrl(qint64 behindLiveMs) const
+{
+    const quint16 port = m_port;
+    if (port == 0) {
+        return QUrl();
+    }
+
+    QUrl url;
+    url.setScheme("http");
+    url.setHost("127.0.0.1");
+    url.setPort(port);
+    url.setPath("/live");
+    QUrlQuery query;
+    query.addQueryItem("behind", QString::number(std::max<qint64>(0, behindLiveMs)));
+    url.setQuery(query);
+    return url;
+}
+
+std::shared_ptr<TimeshiftRing> TimeshiftBuffer::ring() const
+{
+    QMutexLocker locker(&m_ringMutex);
+    return m_ring;
+}
+
+std::shared_ptr<TimeshiftRing> TimeshiftBuffer::ringFor(const QUrl& streamUrl)
+{
+    QMutexLocker locker(&registryMutex);
+    return registry.value(streamUrl).lock();
+}
+
+qint64 TimeshiftBuffer::playbackBehindLiveMs() const
+{
+    const qint64 offset = m_readerOffset;
+    const std::shared_ptr<TimeshiftRing> captured = ring();
+    return captured && offset >= 0 ? captured->behindLiveMs(offset) : 0;
+}
+
+void TimeshiftBuffer::start()
+{
+    if (m_network) {
+        return;
+    }
+
+    m_network = new QNetworkAccessManager(this);
+    m_network->setProxy(m_proxy);
+
+    // Reloads the playlist, or reconnects a continuous stream that dropped
+    m_reloadTimer = new QTimer(this);
+    m_reloadTimer->setSingleShot(true);
+    connect(m_reloadTimer, &QTimer::timeout, this, [this]() {
+        if (m_source.kind == SourceKind::Continuous) {
+            connectStream();
+        } else {
+            loadPlaylist();
+        }
+    });
+
+    m_gateway = new QTcpServer(this);
+    connect(m_gateway, &QTcpServer::newConnection, this, &TimeshiftBuffer::onGatewayConnection);
+    if (!m_gateway->listen(QHostAddress::LocalHost, 0)) {
+        qCWarning(timeshift) << "Timeshift gateway could not listen:" << m_gateway->errorString();
+        return;
+    }
+
+    m_port = m_gateway->serverPort();
+    qCDebug(timeshift) << "Timeshift gateway on port" << m_port;
+    emit gatewayReady(m_port);
+}
+
+void TimeshiftBuffer::stop()
+{
+    close();
+    m_port = 0;
+    if (m_gateway) {
+        m_gateway->close();
+    }
+}
+
+void TimeshiftBuffer::open(const TimeshiftBuffer::Source& source)
+{
+    close();
+    if (!m_network || !source.captureUrl.isValid()) {
+        return;
+    }
+
+    m_source = source;
+    const QString name = QString::fromLatin1(
+        QCryptographicHash::hash(source.streamUrl.toEncoded(), QCryptographicHash::Sha1).toHex());
+    const QString path = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+                             .filePath("timeshift/" + name + ".ring");
+    auto captured = std::make_shared<TimeshiftRing>(path, m_durationMs, m_maxBytes);
+    if (!captured->isValid()) {
+        decline(QStringLiteral("cannot create the timeshift file"));
+        return;
+    }
+    {
+        QMutexLocker locker(&m_ringMutex);
+        m_ring = captured;
+    }
+    registerRing(source.streamUrl, captured);
+
+    m_state = State::Probing;
+    if (source.kind == SourceKind::Continuous) {
+        connectStream();
+    } else {
+        m_nextSequence = -1;
+        m_streamTimeMs = 0;
+        m_playlistEnded = false;
+        m_initSegmentUrl.clear();
+        loadPlaylist();
+    }
+    qCDebug(timeshift) << "Capturing" << source.streamUrl.toString() << "for" << m_durationMs / 1000 << "s";
+}
+
+void TimeshiftBuffer::close()
+{
+    abortCapture();
+
+    const QList<QTcpSocket*> sockets = m_clients.keys();
+    for (QTcpSocket* socket : sockets) {
+        socket->abort();
+    }
+
+    std::shared_ptr<TimeshiftRing> previous;
+    {
+        QMutexLocker locker(&m_ringMutex);
+        previous.swap(m_ring);
+    }
+    if (previous) {
+        unregisterRing(m_source.streamUrl, previous);
+    }
+
+    m_state = State::Idle;
+    m_live = false;
+    m_readerOffset = -1;
+    m_contentType.clear();
+    m_source = Source();
+}
+
+void TimeshiftBuffer::setPlaylist(const QUrl& playlistUrl)
+{
+    if (m_source.kind != SourceKind::HlsPlaylist || !playlistUrl.isValid() || playlistUrl == m_source.captureUrl) {
+        return;
+    }
+
+    // Renditions share media sequence numbers, so the capture carries on where it was
+    m_source.captureUrl = playlistUrl;
+    if (m_state == State::Live || m_state == State::Probing) {
+        m_reloadTimer->stop();
+        loadPlaylist();
+    }
+}
+
+void TimeshiftBuffer::setDuration(qint64 durationMs)
+{
+    m_durationMs = std::max<qint64>(TimeshiftRing::INDEX_INTERVAL_MS, durationMs);
+    if (const std::shared_ptr<TimeshiftRing> captured = ring()) {
+        captured->setDuration(m_durationMs);
+    }
+}
+
+void TimeshiftBuffer::setMaxBytes(qint64 bytes)
+{
+    m_maxBytes = bytes;
+}
+
+void TimeshiftBuffer::setUserAgent(const QString& userAgent)
+{
+    m_userAgent = userAgent.toUtf8();
+}
+
+void TimeshiftBuffer::setProxy(const QNetworkProxy& proxy)
+{
+    m_proxy = proxy;
+    if (m_network) {
+        m_network->setProxy(proxy);
+    }
+}
+
+// Capture
+
+QNetworkReply* TimeshiftBuffer::get(const QUrl& url, const QByteArray& range)
+{
+    QNetworkRequest request(url);
+    NetworkService::configureRequest(request, NetworkService::RequestClass::Playback);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    if (!m_userAgent.isEmpty()) {
+        request.setRawHeader("User-Agent", m_userAgent);
+    }
+    if (!range.isEmpty()) {
+        request.setRawHeader("Range", range);
+    }
+    return m_network->get(request);
+}
+
+qint64 TimeshiftBuffer::captureTimeMs() const
+{
+    return m_captureClock.isValid() ? m_captureClock.elapsed() : 0;
+}
+
+void TimeshiftBuffer::connectStream()
+{
+    if (m_streamReply) {
+        return;
+    }
+
+    // Not tracked as a playback transfer: it never finishes
+    m_streamReply = get(m_source.captureUrl);
+    connect(m_streamReply, &QNetworkReply::metaDataChanged, this, &TimeshiftBuffer::onStreamHeaders);
+    connect(m_streamReply, &QNetworkReply::readyRead, this, &TimeshiftBuffer::onStreamReadyRead);
+    connect(m_streamReply, &QNetworkReply::finished, this, &TimeshiftBuffer::onStreamFinished);
+}
+
+void TimeshiftBuffer::onStreamHeaders()
+{
+    if (m_state != State::Probing || !m_streamReply) {
+        return;
+    }
+
+    const int status = m_streamReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status < 200 || status >= 300) {
+        return;
+    }
+
+    // Stations announce themselves; anything else with a length is a file
+    const bool icecast = m_streamReply->hasRawHeader("icy-name") || m_streamReply->hasRawHeader("icy-br") ||
+                         m_streamReply->hasRawHeader("icy-metaint");
+    const qint64 length = m_streamReply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    if (!icecast && length > 0) {
+        decline(QStringLiteral("the source has a length and is not live"));
+        return;
+    }
+
+    m_contentType = m_streamReply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
+    if (m_contentType.isEmpty()) {
+        m_contentType = "application/octet-stream";
+    }
+    m_captureClock.start();
+    goLive();
+}
+
+void TimeshiftBuffer::onStreamReadyRead()
+{
+    if (!m_streamReply) {
+        return;
+    }
+    const QByteArray data = m_streamReply->readAll();
+    const std::shared_ptr<TimeshiftRing> captured = ring();
+    if (m_state != State::Live || !captured) {
+        return;
+    }
+
+    captured->append(data, captureTimeMs(), 0, false);
+    pumpAll();
+}
+
+void TimeshiftBuffer::onStreamFinished()
+{
+    QNetworkReply* reply = m_streamReply;
+    m_streamReply = nullptr;
+    if (!reply) {
+        return;
+    }
+    reply->deleteLater();
+
+    if (m_state == State::Probing) {
+        decline(reply->error() != QNetworkReply::NoError ? reply->errorString()
+                                                         : QStringLiteral("the source ended at once"));
+        return;
+    }
+
+    // The ring keeps playing while the source comes back; the gap is a cut
+    if (m_state == State::Live) {
+        qCDebug(timeshift) << "Live source dropped (" << reply->errorString() << "), reconnecting";
+        m_reloadTimer->start(RECONNECT_DELAY_MS);
+    }
+}
+
+void TimeshiftBuffer::loadPlaylist()
+{
+    if (!m_network || m_playlistReply || !m_source.captureUrl.isValid()) {
+        return;
+    }
+
+    m_playlistReply = get(m_source.captureUrl);
+    connect(m_playlistReply, &QNetworkReply::finished, this, &TimeshiftBuffer::onPlaylistFinished);
+    NetworkService::instance().trackPlaybackTransfer(m_playlistReply);
+}
+
+void TimeshiftBuffer::onPlaylistFinished()
+{
+    QNetworkReply* reply = m_playlistReply;
+    m_playlistReply = nullptr;
+    if (!reply) {
+        return;
+    }
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        if (m_state == State::Probing && m_nextSequence < 0) {
+            decline(reply->errorString());
+        } else {
+            qCWarning(timeshift) << "Playlist reload failed:" << reply->errorString();
+            m_reloadTimer->start(RECONNECT_DELAY_MS);
+        }
+        return;
+    }
+
+    parseHlsPlaylist(reply->readAll(), reply->url());
+}
+
+void TimeshiftBuffer::parseHlsPlaylist(const QByteArray& playlist, const QUrl& baseUrl)
+{
+    static const QRegularExpression uriPattern(R"re(URI="([^"]*)")re");
+    static const QRegularExpression methodPattern(R"re(METHOD=([A-Z0-9-]+))re");
+
+    QList<Segment> segments;
+    qint64 sequence = 0;
+    qint64 durationMs = 0;
+    qint64 targetMs = 0;
+    qint64 nextRangeOffset = 0;
+    QByteArray pendingRange;
+    QUrl initUrl;
+    bool ended = false;
+    bool variant = false;
+
+    const QList<QByteArray> lines = playlist.split('\n');
+    for (const QByteArray& rawLine : lines) {
+        const QString line = QString::fromUtf8(rawLine).trimmed();
+        if (line.isEmpty()) continue;
+
+        if (line.startsWith("#EXT-X-STREAM-INF:")) {
+            variant = true;
+        } else if (variant && !line.startsWith('#')) {
+            // A master playlist: follow its first variant until setPlaylist() picks one
+            m_source.captureUrl = baseUrl.resolved(QUrl(line));
+            loadPlaylist();
+            return;
+        } else if (line.startsWith("#EXT-X-KEY:")) {
+            // Segments decrypt one by one; concatenated they would not play
+            if (methodPattern.match(line).captured(1) != "NONE") {
+                decline(QStringLiteral("the stream is encrypted"));
+                return;
+            }
+        } else if (line.startsWith("#EXT-X-MEDIA-SEQUENCE:")) {
+            sequence = line.mid(22).toLongLong();
+        } else if (line.startsWith("#EXT-X-TARGETDURATION:")) {
+            targetMs = qRound64(line.mid(22).toDouble() * 1000.0);
+        } else if (line.startsWith("#EXTINF:")) {
+            durationMs = qRound64(line.mid(8).section(',', 0, 0).toDouble() * 1000.0);
+        } else if (line.startsWith("#EXT-X-BYTERANGE:")) {
+            const QStringList parts = line.mid(17).split('@');
+            const qint64 length = parts.value(0).toLongLong();
+            const qint64 offset = parts.size() > 1 ? parts.at(1).toLongLong() : nextRangeOffset;
+            pendingRange = "bytes=" + QByteArray::number(offset) + "-" + QByteArray::number(offset + length - 1);
+            nextRangeOffset = offset + length;
+        } else if (line.startsWith("#EXT-X-MAP:")) {
+            initUrl = baseUrl.resolved(QUrl(uriPattern.match(line).captured(1)));
+        } else if (line.startsWith("#EXT-X-ENDLIST")) {
+            ended = true;
+        } else if (!line.startsWith('#')) {
+            Segment segment;
+            segment.sequence = sequence++;
+            segment.url = baseUrl.resolved(QUrl(line));
+            segment.range = pendingRange;
+            segment.durationMs = durationMs;
+            segments.append(segment);
+            pendingRange.clear();
+            durationMs = 0;
+        }
+    }
+
+    if (segments.isEmpty()) {
+        m_reloadTimer->start(std::max<qint64>(MIN_RELOAD_MS, targetMs / 2));
+        return;
+    }
+
+    if (m_nextSequence < 0) {
+        // A finished playlist seeks fine through the segment gateway
+        if (ended) {
+            decline(QStringLiteral("the playlist is not live"));
+            return;
+        }
+
+        // Take as much of the server's window as the duration covers
+        int first = segments.size() - 1;
+        qint64 coveredMs = segments.last().durationMs;
+        while (first > 0 && coveredMs + segments.at(first - 1).durationMs <= m_durationMs) {
+            coveredMs += segments.at(--first).durationMs;
+        }
+        m_nextSequence = segments.at(first).sequence;
+    } else if (m_nextSequence < segments.first().sequence) {
+        qCWarning(timeshift) << "Fell behind the playlist window, skipping"
+                             << segments.first().sequence - m_nextSequence << "segments";
+        m_nextSequence = segments.first().sequence;
+    }
+
+    if (initUrl.isValid() && initUrl != m_initSegmentUrl) {
+        m_initSegmentUrl = initUrl;
+        Segment init;
+        init.url = initUrl;
+        init.initSegment = true;
+        m_queue.append(init);
+    }
+    for (const Segment& segment : segments) {
+        if (segment.sequence >= m_nextSequence) {
+            m_queue.append(segment);
+            m_nextSequence = segment.sequence + 1;
+        }
+    }
+
+    m_playlistEnded = ended;
+    if (!ended) {
+        m_reloadTimer->start(std::max<qint64>(MIN_RELOAD_MS, targetMs / 2));
+    }
+    fetchNextSegment();
+}
+
+void TimeshiftBuffer::fetchNextSegment()
+{
+    if (m_segmentReply) {
+        return;
+    }
+    if (m_queue.isEmpty()) {
+        if (m_playlistEnded && m_state == State::Live) {
+            qCDebug(timeshift) << "Live stream ended, the ring stays playable";
+            m_state = State::Ended;
+            pumpAll();
+        }
+        return;
+    }
+
+    m_fetching = m_queue.takeFirst();
+    m_segmentReply = get(m_fetching.url, m_fetching.range);
+    connect(m_segmentReply, &QNetworkReply::finished, this, &TimeshiftBuffer::onSegmentFinished);
+    NetworkService::instance().trackPlaybackTransfer(m_segmentReply);
+}
+
+void TimeshiftBuffer::onSegmentFinished()
+{
+    QNetworkReply* reply = m_segmentReply;
+    m_segmentReply = nullptr;
+    if (!reply) {
+        return;
+    }
+    reply->deleteLater();
+
+    const std::shared_ptr<TimeshiftRing> captured = ring();
+    if (reply->error() != QNetworkReply::NoError) {
+        // The gap plays as a cut; stream time still advances over it
+        qCWarning(timeshift) << "Segment" << m_fetching.sequence << "failed:" << reply->errorString();
+        m_streamTimeMs += m_fetching.initSegment ? 0 : m_fetching.durationMs;
+    } else if (captured && m_fetching.initSegment) {
+        captured->setInitSegment(reply->readAll());
+    } else if (captured) {
+        if (m_contentType.isEmpty()) {
+            m_contentType = reply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
+            if (m_contentType.isEmpty() || m_contentType == "application/octet-stream") {
+                m_contentType = guessContentType(m_fetching.url);
+            }
+        }
+        captured->append(reply->readAll(), m_streamTimeMs, m_fetching.durationMs, true);
+        m_streamTimeMs += m_fetching.durationMs;
+
+        // Readers wait for the first segment, so they start with data and a type
+        if (m_state == State::Probing) {
+            goLive();
+        }
+        pumpAll();
+    }
+
+    fetchNextSegment();
+}
+
+void TimeshiftBuffer::goLive()
+{
+    m_state = State::Live;
+    m_live = true;
+    qCDebug(timeshift) << "Source is live, capturing" << m_source.streamUrl.toString();
+    emit liveStarted(m_source.streamUrl);
+    answerParked();
+}
+
+void TimeshiftBuffer::decline(const QString& reason)
+{
+    abortCapture();
+
+    std::shared_ptr<TimeshiftRing> previous;
+    {
+        QMutexLocker locker(&m_ringMutex);
+        previous.swap(m_ring);
+    }
+    if (previous) {
+        unregisterRing(m_source.streamUrl, previous);
+    }
+
+    m_state = State::Declined;
+    m_live = false;
+    qCDebug(timeshift) << "Not capturing" << m_source.streamUrl.toString() << ":" << reason;
+    emit captureDeclined(m_source.streamUrl, reason);
+    answerParked();
+}
+
+void TimeshiftBuffer::abortCapture()
+{
+    for (QNetworkReply** reply : {&m_streamReply, &m_playlistReply, &m_segmentReply}) {
+        if (*reply) {
+            (*reply)->disconnect(this);
+            (*reply)->abort();
+            (*reply)->deleteLater();
+            *reply = nullptr;
+        }
+    }
+    if (m_reloadTimer) {
+        m_reloadTimer->stop();
+    }
+    m_queue.clear();
+    m_captureClock.invalidate();
+}
+
+// Gateway
+
+void TimeshiftBuffer::onGatewayConnection()
+{
+    while (QTcpSocket* socket = m_gateway->nextPendingConnection()) {
+        m_clients.insert(socket, Client());
+        connect(socket, &QTcpSocket::readyRead, this, &TimeshiftBuffer::onClientReadyRead);
+        connect(socket, &QTcpSocket::bytesWritten, this, &TimeshiftBuffer::onClientBytesWritten);
+        // Queued, so a socket never goes away under pump()
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_clients.remove(socket);
+            socket->deleteLater();
+        }, Qt::QueuedConnection);
+    }
+}
+
+void TimeshiftBuffer::onClientReadyRead()
+{
+    auto* socket = qobject_cast<QTcpSocket*>(sender());
+    auto it = m_clients.find(socket);
+    if (it == m_clients.end()) {
+        return;
+    }
+
+    // One request per connection: the response runs until the reader leaves
+    if (it->parked || it->streaming) {
+        return;
+    }
+    it->input += socket->readAll();
+    const int end = it->input.indexOf("\r\n\r\n");
+    if (end < 0) {
+        if (it->input.size() > MAX_HEADER_BYTES) {
+            respond(socket, 431, "Request Header Fields Too Large", "Content-Length: 0\r\n");
+            socket->disconnectFromHost();
+        }
+        return;
+    }
+
+    const QByteArray head = it->input.left(end);
+    it->input.clear();
+    handleRequest(socket, *it, head);
+}
+
+void TimeshiftBuffer::onClientBytesWritten()
+{
+    if (auto* socket = qobject_cast<QTcpSocket*>(sender())) {
+        pump(socket);
+    }
+}
+
+void TimeshiftBuffer::handleRequest(QTcpSocket* socket, Client& client, const QByteArray& head)
+{
+    const QList<QByteArray> requestLine = head.split('\n').value(0).trimmed().split(' ');
+    if (requestLine.size() < 3) {
+        respond(socket, 400, "Bad Request", "Content-Length: 0\r\n");
+        socket->disconnectFromHost();
+        return;
+    }
+    if (requestLine.at(0) != "GET") {
+        respond(socket, 405, "Method Not Allowed", "Allow: GET\r\nContent-Length: 0\r\n");
+        socket->disconnectFromHost();
+        return;
+    }
+
+    const QUrl target(QString::fromUtf8(requestLine.at(1)));
+    if (target.path() != "/live" || m_state == State::Idle) {
+        respond(socket, 404, "Not Found", "Content-Length: 0\r\n");
+        socket->disconnectFromHost();
+        return;
+    }
+
+    client.behindMs = QUrlQuery(target).queryItemValue("behind").toLongLong();
+    if (m_state == State::Probing) {
+        client.parked = true;
+        return;
+    }
+    beginResponse(socket, client);
+}
+
+void TimeshiftBuffer::beginResponse(QTcpSocket* socket, Client& client)
+{
+    client.parked = false;
+
+    if (m_state == State::Declined) {
+        if (m_source.fallbackUrl.isValid()) {
+            respond(socket, 307, "Temporary Redirect",
+                    "Location: " + m_source.fallbackUrl.toEncoded() + "\r\nContent-Length: 0\r\n");
+        } else {
+            respond(socket, 502, "Bad Gateway", "Content-Length: 0\r\n");
+        }
+        socket->disconnectFromHost();
+        return;
+    }
+
+    const std::shared_ptr<TimeshiftRing> captured = ring();
+    if (!captured) {
+        respond(socket, 503, "Service Unavailable", "Content-Length: 0\r\n");
+        socket->disconnectFromHost();
+        return;
+    }
+
+    // No length: the body runs for as long as the reader stays
+    respond(socket, 200, "OK", "Content-Type: " + m_contentType + "\r\nCache-Control: no-store\r\n");
+    client.streaming = true;
+    client.position = captured->offsetBehindLive(client.behindMs);
+    const QByteArray init = captured->initSegment();
+    if (!init.isEmpty()) {
+        socket->write(init);
+    }
+    qCDebug(timeshift) << "Reader joins" << captured->behindLiveMs(client.position) << "ms behind live";
+    pump(socket);
+}
+
+void TimeshiftBuffer::respond(QTcpSocket* socket, int status, const QByteArray& reason, const QByteArray& headers)
+{
+    socket->write("HTTP/1.1 " + QByteArray::number(status) + ' ' + reason + "\r\n" + headers
+                  + "Connection: close\r\n\r\n");
+}
+
+void TimeshiftBuffer::pump(QTcpSocket* socket)
+{
+    auto it = m_clients.find(socket);
+    if (it == m_clients.end() || !it->streaming) {
+        return;
+    }
+    Client& client = *it;
+
+    const std::shared_ptr<TimeshiftRing> captured = ring();
+    if (!captured) {
+        socket->disconnectFromHost();
+        return;
+    }
+
+    while (socket->bytesToWrite() < SOCKET_BACKLOG_BYTES) {
+        // Paused past the window: carry on from the oldest point kept
+        const qint64 start = captured->start();
+        if (client.position < start) {
+            client.position = start;
+        }
+
+        const QByteArray data = captured->read(client.position, READ_CHUNK_BYTES);
+        if (data.isEmpty()) {
+            if (m_state == State::Ended && client.position >= captured->end()) {
+                socket->disconnectFromHost();
+            }
+            break;
+        }
+        socket->write(data);
+        client.position += data.size();
+    }
+    m_readerOffset = client.position;
+}
+
+void TimeshiftBuffer::pumpAll()
+{
+    const QList<QTcpSocket*> sockets = m_clients.keys();
+    for (QTcpSocket* socket : sockets) {
+        pump(socket);
+    }
+}
+
+void TimeshiftBuffer::answerParked()
+{
+    for (auto it = m_clients.begin(); it != m_clients.end(); ++it) {
+        if (it->parked) {
+            beginResponse(it.key(), *it);
+        }
+    }
+}
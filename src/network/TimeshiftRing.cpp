@@ -0,0 +1,191 @@
+#include "network/TimeshiftRing.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <algorithm>
+
+Q_DECLARE_LOGGING_CATEGORY(timeshift)
+
+TimeshiftRing::TimeshiftRing(const QString& filePath, qint64 durationMs, qint64 maxBytes)
+    : m_file(filePath)
+    , m_durationMs(durationMs)
+    , m_maxBytes(std::max(maxBytes, 2 * FLUSH_BYTES))
+{
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        qCWarning(timeshift) << "Cannot create timeshift file" << filePath << ":" << m_file.errorString();
+    }
+}
+
+TimeshiftRing::~TimeshiftRing()
+{
+    if (m_file.isOpen()) {
+        m_file.close();
+        m_file.remove();
+    }
+}
+
+bool TimeshiftRing::isValid() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_file.isOpen();
+}
+
+void TimeshiftRing::append(const QByteArray& data, qint64 streamTimeMs, qint64 durationMs, bool startPoint)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    if (m_index.empty() || startPoint || streamTimeMs - m_index.back().streamTimeMs >= INDEX_INTERVAL_MS) {
+        m_index.push_back({m_end, streamTimeMs});
+    }
+
+    m_head.append(data);
+    m_end += data.size();
+    m_liveTimeMs = std::max(m_liveTimeMs, streamTimeMs + durationMs);
+
+    if (m_end - m_flushed >= FLUSH_BYTES) {
+        flush();
+    }
+
+    // Drop flushed bytes from the head in large steps, not a copy per append
+    if (m_head.size() > 2 * HEAD_BYTES) {
+        const qint64 drop = std::min<qint64>(m_head.size() - HEAD_BYTES, m_flushed - m_headStart);
+        if (drop > 0) {
+            m_head.remove(0, static_cast<int>(drop));
+            m_headStart += drop;
+        }
+    }
+
+    trim();
+}
+
+void TimeshiftRing::trim()
+{
+    // Keep the latest start point at least the duration behind the live edge
+    while (m_index.size() > 1 && m_liveTimeMs - m_index[1].streamTimeMs >= m_durationMs) {
+        m_index.pop_front();
+    }
+    // And no more than the file holds
+    while (m_index.size() > 1 && m_end - m_index.front().offset > m_maxBytes) {
+        m_index.pop_front();
+    }
+
+    m_start = m_index.empty() ? m_end : m_index.front().offset;
+    if (m_end - m_start > m_maxBytes) {
+        m_start = m_end - m_maxBytes;
+    }
+}
+
+void TimeshiftRing::flush()
+{
+    if (!m_file.isOpen()) {
+        m_flushed = m_end;
+        return;
+    }
+
+    while (m_flushed < m_end) {
+        const qint64 position = m_flushed % m_maxBytes;
+        const qint64 length = std::min(m_end - m_flushed, m_maxBytes - position);
+        if (!m_file.seek(position) ||
+            m_file.write(m_head.constData() + (m_flushed - m_headStart), length) != length) {
+            qCWarning(timeshift) << "Timeshift file write failed:" << m_file.errorString();
+            m_file.close();
+            m_file.remove();
+            m_flushed = m_end;
+            return;
+        }
+        m_flushed += length;
+    }
+}
+
+QByteArray TimeshiftRing::read(qint64 offset, qint64 maxBytes) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (offset < m_start || offset >= m_end || maxBytes <= 0) {
+        return QByteArray();
+    }
+
+    if (offset >= m_headStart) {
+        return m_head.mid(static_cast<int>(offset - m_headStart),
+                          static_cast<int>(std::min(maxBytes, m_end - offset)));
+    }
+
+    // Older than the head, so already in the file
+    if (!m_file.isOpen()) {
+        return QByteArray();
+    }
+    const qint64 position = offset % m_maxBytes;
+    const qint64 length = std::min({maxBytes, m_headStart - offset, m_maxBytes - position});
+    if (!m_file.seek(position)) {
+        return QByteArray();
+    }
+    return m_file.read(length);
+}
+
+qint64 TimeshiftRing::start() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_start;
+}
+
+qint64 TimeshiftRing::end() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_end;
+}
+
+qint64 TimeshiftRing::availableMs() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_index.empty() ? 0 : m_liveTimeMs - m_index.front().streamTimeMs;
+}
+
+qint64 TimeshiftRing::offsetBehindLive(qint64 behindMs) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    const qint64 target = m_liveTimeMs - std::max<qint64>(0, behindMs);
+    auto after = std::upper_bound(m_index.begin(), m_index.end(), target,
+                                  [](qint64 time, const IndexEntry& entry) { return time < entry.streamTimeMs; });
+    if (after == m_index.begin()) {
+        return m_start;
+    }
+    return std::max(m_start, std::prev(after)->offset);
+}
+
+qint64 TimeshiftRing::behindLiveMs(qint64 offset) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto after = std::upper_bound(m_index.begin(), m_index.end(), offset,
+                                  [](qint64 value, const IndexEntry& entry) { return value < entry.offset; });
+    if (after == m_index.begin()) {
+        return m_index.empty() ? 0 : m_liveTimeMs - m_index.front().streamTimeMs;
+    }
+    return m_liveTimeMs - std::prev(after)->streamTimeMs;
+}
+
+void TimeshiftRing::setInitSegment(const QByteArray& data)
+{
+    QMutexLocker locker(&m_mutex);
+    m_initSegment = data;
+}
+
+QByteArray TimeshiftRing::initSegment() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_initSegment;
+}
+
+void TimeshiftRing::setDuration(qint64 durationMs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_durationMs = durationMs;
+    trim();
+}
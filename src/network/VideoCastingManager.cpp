@@ -1,4 +1,6 @@
 #include "network/VideoCastingManager.h"
+#include "network/CastTranscoder.h"
+#include "network/RemoteStatePublisher.h"
 #include <QLoggingCategory>
 #include <QMutexLocker>
 #include <QJsonDocument>
@@ -8,6 +10,7 @@
 #include <QHostAddress>
 #include <QUuid>
 #include <QCryptographicHash>
+#include <QHash>
 #ifdef HAVE_QT_WEBSOCKETS
 #include <QWebSocketServer>
 #include <QWebSocket>
@@ -22,8 +25,10 @@ VideoCastingManager::VideoCastingManager(QObject* parent)
     , m_networkManager(new QNetworkAccessManager(this))
     , m_udpSocket(new QUdpSocket(this))
     , m_tcpServer(new QTcpServer(this))
+    , m_transcoder(new CastTranscoder(this))
 #ifdef HAVE_QT_WEBSOCKETS
     , m_webSocketServer(nullptr)
+    , m_statePublisher(new RemoteStatePublisher(this))
 #endif
     , m_discovering(false)
     , m_discoveryTimer(new QTimer(this))
@@ -31,6 +36,7 @@ VideoCastingManager::VideoCastingManager(QObject* parent)
     , m_sessionTimer(new QTimer(this))
     , m_webControlRunning(false)
     , m_chromecastAppId(DEFAULT_CHROMECAST_APP_ID)
+    , m_transcodingEnabled(true)
 {
     // Setup discovery timer
     m_discoveryTimer->setSingleShot(true);
@@ -43,6 +49,16 @@ VideoCastingManager::VideoCastingManager(QObject* parent)
     // Setup UDP socket for SSDP discovery
     connect(m_udpSocket, &QUdpSocket::readyRead, this, &VideoCastingManager::onUdpDataReceived);
     
+    // Transcoded sessions end with the cast
+    connect(this, &VideoCastingManager::castingStopped, m_transcoder, &CastTranscoder::stop);
+    
+#ifdef HAVE_QT_WEBSOCKETS
+    // Remotes are pushed every session change rather than polling for it
+    connect(this, &VideoCastingManager::castingStarted, this, &VideoCastingManager::broadcastSessionUpdate);
+    connect(this, &VideoCastingManager::sessionUpdated, this, &VideoCastingManager::broadcastSessionUpdate);
+    connect(this, &VideoCastingManager::castingStopped, this, &VideoCastingManager::broadcastSessionUpdate);
+#endif
+    
     qCDebug(videoCasting) << "VideoCastingManager created";
 }
 
@@ -74,6 +90,7 @@ void VideoCastingManager::shutdown()
     stopCasting();
     stopDeviceDiscovery();
     stopWebControlServer();
+    m_transcoder->stop();
     
     if (m_udpSocket->state() == QAbstractSocket::BoundState) {
         m_udpSocket->leaveMulticastGroup(QHostAddress(SSDP_ADDRESS));
@@ -147,15 +164,24 @@ bool VideoCastingManager::startCasting(const CastingDevice& device, const QUrl&
         return false;
     }
     
+    // Hand the device a remux/transcode of media it cannot decode
+    QUrl streamUrl = mediaUrl;
+    if (m_transcodingEnabled && (device.type == DLNA || device.type == UPnP || device.type == Chromecast)) {
+        const QUrl transcodeUrl = m_transcoder->start(mediaUrl, CastProfile::forDevice(device), getLocalIPAddress());
+        if (!transcodeUrl.isEmpty()) {
+            streamUrl = transcodeUrl;
+        }
+    }
+    
     bool success = false;
     
     switch (device.type) {
         case DLNA:
         case UPnP:
-            success = startDLNACasting(device, mediaUrl, mediaTitle);
+            success = startDLNACasting(device, streamUrl, mediaTitle);
             break;
         case Chromecast:
-            success = startChromecastCasting(device, mediaUrl, mediaTitle);
+            success = startChromecastCasting(device, streamUrl, mediaTitle);
             break;
         default:
             qCWarning(videoCasting) << "Unsupported device type:" << device.type;
@@ -168,6 +194,7 @@ bool VideoCastingManager::startCasting(const CastingDevice& device, const QUrl&
         m_currentSession.sessionId = generateSessionId();
         m_currentSession.device = device;
         m_currentSession.mediaUrl = mediaUrl.toString();
+        m_currentSession.streamUrl = streamUrl.toString();
         m_currentSession.mediaTitle = mediaTitle;
         m_currentSession.isPlaying = true;
         
@@ -175,7 +202,192 @@ bool VideoCastingManager::startCasting(const CastingDevice& device, const QUrl&
         emit castingStarted(m_currentSession);
         
         qCDebug(videoCasting) << "Casting started to device:" << device.name;
+    } else {
+        m_transcoder->stop();
     }
     
     return success;
-}
\ No newline at end of file
+}
+
+void VideoCastingManager::setTranscodingEnabled(bool enabled)
+{
+    m_transcodingEnabled = enabled;
+    qCDebug(videoCasting) << "Cast transcoding" << (enabled ? "enabled" : "disabled");
+}
+
+bool VideoCastingManager::isTranscodingEnabled() const
+{
+    return m_transcodingEnabled;
+}
+
+void VideoCastingManager::setTranscodeAcceleration(HardwareAccelerationType type)
+{
+    m_transcoder->setAcceleration(type);
+}
+
+bool VideoCastingManager::startWebControlServer(int port)
+{
+#ifdef HAVE_QT_WEBSOCKETS
+    if (m_webControlRunning) {
+        return true;
+    }
+    
+    setupWebControlServer();
+    if (!m_webSocketServer->listen(QHostAddress::Any, quint16(port))) {
+        qCWarning(videoCasting) << "Failed to start web control server:" << m_webSocketServer->errorString();
+        return false;
+    }
+    
+    m_webControlRunning = true;
+    m_webControlUrl = QUrl();
+    m_webControlUrl.setScheme("ws");
+    m_webControlUrl.setHost(getLocalIPAddress());
+    m_webControlUrl.setPort(m_webSocketServer->serverPort());
+    broadcastSessionUpdate();
+    
+    emit webControlServerStarted(m_webControlUrl);
+    qCDebug(videoCasting) << "Web control server started at" << m_webControlUrl;
+    return true;
+#else
+    Q_UNUSED(port);
+    qCWarning(videoCasting) << "Web control requires Qt WebSockets";
+    return false;
+#endif
+}
+
+void VideoCastingManager::stopWebControlServer()
+{
+#ifdef HAVE_QT_WEBSOCKETS
+    if (!m_webControlRunning) {
+        return;
+    }
+    
+    for (QWebSocket* client : std::as_const(m_connectedClients)) {
+        client->disconnect(this);
+        m_statePublisher->removeClient(client);
+        client->close();
+        client->deleteLater();
+    }
+    m_connectedClients.clear();
+    m_webSocketServer->close();
+    
+    m_webControlRunning = false;
+    m_webControlUrl.clear();
+    emit webControlServerStopped();
+    qCDebug(videoCasting) << "Web control server stopped";
+#endif
+}
+
+bool VideoCastingManager::isWebControlServerRunning() const
+{
+    return m_webControlRunning;
+}
+
+QUrl VideoCastingManager::getWebControlUrl() const
+{
+    return m_webControlUrl;
+}
+
+int VideoCastingManager::getConnectedClients() const
+{
+#ifdef HAVE_QT_WEBSOCKETS
+    return m_statePublisher->clientCount();
+#else
+    return 0;
+#endif
+}
+
+void VideoCastingManager::setRemoteQueue(const QStringList& titles, int currentIndex)
+{
+#ifdef HAVE_QT_WEBSOCKETS
+    m_statePublisher->setQueue(titles, currentIndex);
+#else
+    Q_UNUSED(titles);
+    Q_UNUSED(currentIndex);
+#endif
+}
+
+#ifdef HAVE_QT_WEBSOCKETS
+void VideoCastingManager::setupWebControlServer()
+{
+    if (m_webSocketServer) {
+        return;
+    }
+    
+    m_webSocketServer = new QWebSocketServer("EonPlay Remote", QWebSocketServer::NonSecureMode, this);
+    connect(m_webSocketServer, &QWebSocketServer::newConnection, this, &VideoCastingManager::onWebSocketConnected);
+}
+
+void VideoCastingManager::onWebSocketConnected()
+{
+    while (QWebSocket* client = m_webSocketServer->nextPendingConnection()) {
+        connect(client, &QWebSocket::textMessageReceived, this, &VideoCastingManager::onWebSocketMessageReceived);
+        connect(client, &QWebSocket::disconnected, this, &VideoCastingManager::onWebSocketDisconnected);
+        m_connectedClients.append(client);
+        m_statePublisher->addClient(client);
+        
+        emit remoteClientConnected(client->peerAddress().toString());
+    }
+}
+
+void VideoCastingManager::onWebSocketDisconnected()
+{
+    QWebSocket* client = qobject_cast<QWebSocket*>(sender());
+    if (!client) {
+        return;
+    }
+    
+    m_connectedClients.removeAll(client);
+    m_statePublisher->removeClient(client);
+    emit remoteClientDisconnected(client->peerAddress().toString());
+    client->deleteLater();
+}
+
+void VideoCastingManager::onWebSocketMessageReceived(const QString& message)
+{
+    QWebSocket* client = qobject_cast<QWebSocket*>(sender());
+    if (!client || m_statePublisher->handleMessage(client, message)) {
+        return;
+    }
+    handleWebControlRequest(client, message);
+}
+
+void VideoCastingManager::handleWebControlRequest(QWebSocket* client, const QString& message)
+{
+    static const QHash<QString, RemoteCommand> commands = {
+        {"play", Play}, {"pause", Pause}, {"stop", Stop}, {"seek", Seek}, {"volume", SetVolume},
+        {"mute", Mute}, {"unmute", Unmute}, {"next", Next}, {"previous", Previous}, {"load", LoadMedia}
+    };
+    
+    const QJsonObject request = QJsonDocument::fromJson(message.toUtf8()).object();
+    const auto command = commands.constFind(request.value("command").toString());
+    if (command == commands.constEnd()) {
+        client->sendTextMessage(QStringLiteral(R"({"type":"error","error":"unknown command"})"));
+        return;
+    }
+    
+    // The resulting state change reaches every remote as a pushed delta
+    const QVariant parameter = request.value("value").toVariant();
+    if (m_casting) {
+        sendRemoteCommand(command.value(), parameter);
+    }
+    emit remoteCommandReceived(command.value(), parameter);
+}
+
+void VideoCastingManager::broadcastSessionUpdate()
+{
+    RemoteStatePublisher::State state;
+    {
+        QMutexLocker locker(&m_sessionMutex);
+        state.casting = m_casting;
+        state.playing = m_casting && m_currentSession.isPlaying;
+        state.positionMs = m_currentSession.position;
+        state.durationMs = m_currentSession.duration;
+        state.volume = m_currentSession.volume;
+        state.muted = m_currentSession.isMuted;
+        state.title = m_currentSession.mediaTitle;
+        state.device = m_currentSession.device.name;
+    }
+    m_statePublisher->setState(state);
+}
+#endif
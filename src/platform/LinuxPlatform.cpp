@@ -1,7 +1,10 @@
 #include "platform/LinuxPlatform.h"
+#include "platform/MprisAdaptors.h"
+#include "media/IMediaEngine.h"
 #include <QDBusConnection>
 #include <QDBusInterface>
 #include <QDBusMessage>
+#include <QDBusObjectPath>
 #include <QDBusReply>
 #include <QStandardPaths>
 #include <QDir>
@@ -13,6 +16,7 @@
 #include <QCoreApplication>
 #include <QXmlStreamWriter>
 #include <QTextStream>
+#include <QTimer>
 
 Q_LOGGING_CATEGORY(linuxPlatform, "eonplay.platform.linux")
 
@@ -24,6 +28,18 @@ const QString LinuxPlatform::MPRIS_PLAYER_INTERFACE = "org.mpris.MediaPlayer2.Pl
 const QString LinuxPlatform::DESKTOP_FILE_NAME = "eonplay.desktop";
 const QString LinuxPlatform::MIME_TYPES_DIR = "mime/packages";
 
+namespace {
+
+const QString UPOWER_SERVICE = "org.freedesktop.UPower";
+const QString UPOWER_PATH = "/org/freedesktop/UPower";
+const QString UPOWER_DISPLAY_DEVICE_PATH = "/org/freedesktop/UPower/devices/DisplayDevice";
+const QString POWER_PROFILES_SERVICE = "net.hadess.PowerProfiles";
+const QString POWER_PROFILES_PATH = "/net/hadess/PowerProfiles";
+const QString PROPERTIES_INTERFACE = "org.freedesktop.DBus.Properties";
+const QString MPRIS_NO_TRACK = "/org/mpris/MediaPlayer2/TrackList/NoTrack";
+
+} // namespace
+
 LinuxPlatform::LinuxPlatform(QObject *parent)
     : QObject(parent)
     , m_mprisActive(false)
@@ -31,10 +47,16 @@ LinuxPlatform::LinuxPlatform(QObject *parent)
     , m_vdpauEnabled(false)
     , m_vaApiSupported(false)
     , m_vdpauSupported(false)
-    , m_mprisInterface(nullptr)
+    , m_hardwareSupportChecked(false)
+    , m_mprisObject(nullptr)
+    , m_mprisPlayer(nullptr)
     , m_dbusConnection(QDBusConnection::sessionBus())
+    , m_mprisMetadataMap(buildMPRISMetadata(MPRISMetadata()))
+    , m_playbackStatus("Stopped")
     , m_currentPosition(0)
     , m_desktopEnvironment(DE_UNKNOWN)
+    , m_powerMonitoring(false)
+    , m_thermalTimer(nullptr)
     , m_canPlay(true)
     , m_canPause(true)
     , m_canSeek(true)
@@ -44,16 +66,15 @@ LinuxPlatform::LinuxPlatform(QObject *parent)
     // Detect desktop environment
     m_desktopEnvironment = detectDesktopEnvironment();
     
-    // Check hardware acceleration support
-    m_vaApiSupported = checkVAAPISupport();
-    m_vdpauSupported = checkVDPAUSupport();
+    // Hardware acceleration support is checked on first use; vainfo and
+    // vdpauinfo take a while and would block whoever creates the platform
     
-    qCDebug(linuxPlatform) << "LinuxPlatform initialized - DE:" << getDesktopEnvironmentName()
-                           << "VA-API:" << m_vaApiSupported << "VDPAU:" << m_vdpauSupported;
+    qCDebug(linuxPlatform) << "LinuxPlatform initialized - DE:" << getDesktopEnvironmentName();
 }
 
 LinuxPlatform::~LinuxPlatform()
 {
+    stopPowerMonitoring();
     shutdownMPRIS();
 }
 
@@ -69,13 +90,17 @@ bool LinuxPlatform::initializeMPRIS()
         return false;
     }
     
-    // Register service
+    // The object is in place before the name appears, so clients never see it empty
+    setupMPRISInterface();
     if (!m_dbusConnection.registerService(MPRIS_SERVICE_NAME)) {
         qCWarning(linuxPlatform) << "Failed to register MPRIS service";
+        m_dbusConnection.unregisterObject(MPRIS_OBJECT_PATH);
+        delete m_mprisObject;
+        m_mprisObject = nullptr;
+        m_mprisPlayer = nullptr;
         return false;
     }
     
-    setupMPRISInterface();
     m_mprisActive = true;
     
     qCDebug(linuxPlatform) << "MPRIS interface initialized";
@@ -86,12 +111,11 @@ void LinuxPlatform::shutdownMPRIS()
 {
     if (!m_mprisActive) return;
     
-    if (m_mprisInterface) {
-        delete m_mprisInterface;
-        m_mprisInterface = nullptr;
-    }
-    
     m_dbusConnection.unregisterService(MPRIS_SERVICE_NAME);
+    m_dbusConnection.unregisterObject(MPRIS_OBJECT_PATH);
+    delete m_mprisObject;
+    m_mprisObject = nullptr;
+    m_mprisPlayer = nullptr;
     m_mprisActive = false;
     
     qCDebug(linuxPlatform) << "MPRIS interface shutdown";
@@ -102,83 +126,200 @@ bool LinuxPlatform::isMPRISActive() const
     return m_mprisActive;
 }
 
-void LinuxPlatform::updateMPRISMetadata(const MPRISMetadata& metadata)
+void LinuxPlatform::setupMPRISInterface()
 {
-    m_currentMetadata = metadata;
+    m_mprisObject = new QObject(this);
+    new MprisRootAdaptor(m_mprisObject, this);
+    m_mprisPlayer = new MprisPlayerAdaptor(m_mprisObject, this);
     
-    if (m_mprisActive && m_mprisInterface) {
-        QVariantMap metadataMap = getMPRISMetadata();
-        
-        // Send D-Bus property change signal
-        QDBusMessage signal = QDBusMessage::createSignal(
-            MPRIS_OBJECT_PATH,
-            "org.freedesktop.DBus.Properties",
-            "PropertiesChanged"
-        );
-        
-        signal << MPRIS_PLAYER_INTERFACE;
-        signal << QVariantMap{{"Metadata", metadataMap}};
-        signal << QStringList();
-        
-        m_dbusConnection.send(signal);
+    if (!m_dbusConnection.registerObject(MPRIS_OBJECT_PATH, m_mprisObject, QDBusConnection::ExportAdaptors)) {
+        qCWarning(linuxPlatform) << "Failed to register MPRIS object:" << m_dbusConnection.lastError().message();
     }
 }
 
-void LinuxPlatform::updateMPRISPlaybackStatus(const QString& status)
+void LinuxPlatform::updateMPRISMetadata(const MPRISMetadata& metadata)
 {
-    m_playbackStatus = status;
+    if (metadata == m_currentMetadata) {
+        return;
+    }
     
-    if (m_mprisActive && m_mprisInterface) {
-        QDBusMessage signal = QDBusMessage::createSignal(
-            MPRIS_OBJECT_PATH,
-            "org.freedesktop.DBus.Properties",
-            "PropertiesChanged"
-        );
-        
-        signal << MPRIS_PLAYER_INTERFACE;
-        signal << QVariantMap{{"PlaybackStatus", status}};
-        signal << QStringList();
-        
-        m_dbusConnection.send(signal);
+    m_currentMetadata = metadata;
+    m_mprisMetadataMap = buildMPRISMetadata(metadata);
+    emitMPRISPropertiesChanged({{"Metadata", m_mprisMetadataMap}});
+}
+
+void LinuxPlatform::updateMPRISPlaybackStatus(const QString& status)
+{
+    if (status == m_playbackStatus) {
+        return;
     }
+    
+    // Re-anchor so the position stops or starts advancing from here
+    m_currentPosition = mprisPosition();
+    m_positionClock.restart();
+    m_playbackStatus = status;
+    emitMPRISPropertiesChanged({{"PlaybackStatus", status}});
 }
 
 void LinuxPlatform::updateMPRISPosition(qint64 position)
 {
-    m_currentPosition = position;
+    reportMPRISPosition(position);
     
     if (m_mprisActive) {
         emit mprisPositionChanged(position);
     }
 }
 
-QVariantMap LinuxPlatform::getMPRISMetadata() const
+void LinuxPlatform::setMPRISCanControl(bool canPlay, bool canPause, bool canSeek, bool canGoNext, bool canGoPrevious)
 {
-    QVariantMap metadata;
+    QVariantMap changed;
+    auto apply = [&changed](bool& current, bool value, const char* property) {
+        if (current != value) {
+            current = value;
+            changed.insert(property, value);
+        }
+    };
+    apply(m_canPlay, canPlay, "CanPlay");
+    apply(m_canPause, canPause, "CanPause");
+    apply(m_canSeek, canSeek, "CanSeek");
+    apply(m_canGoNext, canGoNext, "CanGoNext");
+    apply(m_canGoPrevious, canGoPrevious, "CanGoPrevious");
     
-    if (!m_currentMetadata.trackId.isEmpty()) {
-        metadata["mpris:trackid"] = QDBusObjectPath(m_currentMetadata.trackId);
+    if (!changed.isEmpty()) {
+        emitMPRISPropertiesChanged(changed);
+    }
+}
+
+void LinuxPlatform::setMPRISMediaEngine(std::shared_ptr<IMediaEngine> engine)
+{
+    if (m_mprisEngine) {
+        disconnect(m_mprisEngine.get(), nullptr, this, nullptr);
+    }
+    m_mprisEngine = std::move(engine);
+    if (!m_mprisEngine) {
+        return;
+    }
+    
+    connect(m_mprisEngine.get(), &IMediaEngine::stateChanged, this, [this](PlaybackState state) {
+        switch (state) {
+            case PlaybackState::Playing:
+            case PlaybackState::Buffering:
+                updateMPRISPlaybackStatus("Playing");
+                break;
+            case PlaybackState::Paused:
+                updateMPRISPlaybackStatus("Paused");
+                break;
+            default:
+                updateMPRISPlaybackStatus("Stopped");
+                break;
+        }
+    });
+    
+    // Emitted for jumps only; steady playback is read through the clock
+    connect(m_mprisEngine.get(), &IMediaEngine::playbackPositionChanged, this, [this](qint64 position) {
+        reportMPRISPosition(position * 1000);
+    });
+    
+    m_currentPosition = m_mprisEngine->position() * 1000;
+    m_positionClock.restart();
+}
+
+void LinuxPlatform::onMPRISMethodCall(const QString& method, const QVariantList& arguments)
+{
+    if (method == "Seek") {
+        emit mprisSeekRequested(arguments.value(0).toLongLong());
+    } else if (method == "SetPosition") {
+        // Ignored for a stale track, as the specification asks
+        const QString trackId = m_currentMetadata.trackId.isEmpty() ? MPRIS_NO_TRACK : m_currentMetadata.trackId;
+        if (arguments.value(0).toString() == trackId) {
+            emit mprisSeekRequested(arguments.value(1).toLongLong() - mprisPosition());
+        }
+    } else {
+        handleMPRISCommand(method);
+    }
+}
+
+void LinuxPlatform::handleMPRISCommand(const QString& command)
+{
+    qCDebug(linuxPlatform) << "MPRIS command:" << command;
+    emit mprisCommandReceived(command);
+}
+
+void LinuxPlatform::emitMPRISPropertiesChanged(const QVariantMap& changed)
+{
+    if (!m_mprisActive) {
+        return;
+    }
+    
+    QDBusMessage signal = QDBusMessage::createSignal(
+        MPRIS_OBJECT_PATH,
+        PROPERTIES_INTERFACE,
+        "PropertiesChanged"
+    );
+    
+    signal << MPRIS_PLAYER_INTERFACE;
+    signal << changed;
+    signal << QStringList();
+    
+    m_dbusConnection.send(signal);
+}
+
+void LinuxPlatform::reportMPRISPosition(qint64 position)
+{
+    const qint64 expected = extrapolatedMPRISPosition();
+    m_currentPosition = position;
+    m_positionClock.restart();
+    
+    if (m_mprisPlayer && qAbs(position - expected) > SEEK_THRESHOLD_US) {
+        emit m_mprisPlayer->Seeked(position);
+    }
+}
+
+qint64 LinuxPlatform::mprisPosition() const
+{
+    if (m_mprisEngine) {
+        return m_mprisEngine->position() * 1000;
+    }
+    return extrapolatedMPRISPosition();
+}
+
+qint64 LinuxPlatform::extrapolatedMPRISPosition() const
+{
+    if (m_playbackStatus != "Playing" || !m_positionClock.isValid()) {
+        return m_currentPosition;
     }
-    if (!m_currentMetadata.title.isEmpty()) {
-        metadata["xesam:title"] = m_currentMetadata.title;
+    
+    const double rate = m_mprisEngine ? m_mprisEngine->playbackRate() : 1.0;
+    return m_currentPosition + qRound64(m_positionClock.elapsed() * 1000 * rate);
+}
+
+QVariantMap LinuxPlatform::buildMPRISMetadata(const MPRISMetadata& source)
+{
+    QVariantMap metadata;
+    
+    // Clients key everything on the track id, so there always is one
+    metadata["mpris:trackid"] = QVariant::fromValue(QDBusObjectPath(
+        source.trackId.isEmpty() ? MPRIS_NO_TRACK : source.trackId));
+    if (!source.title.isEmpty()) {
+        metadata["xesam:title"] = source.title;
     }
-    if (!m_currentMetadata.artist.isEmpty()) {
-        metadata["xesam:artist"] = QStringList() << m_currentMetadata.artist;
+    if (!source.artist.isEmpty()) {
+        metadata["xesam:artist"] = QStringList() << source.artist;
     }
-    if (!m_currentMetadata.album.isEmpty()) {
-        metadata["xesam:album"] = m_currentMetadata.album;
+    if (!source.album.isEmpty()) {
+        metadata["xesam:album"] = source.album;
     }
-    if (!m_currentMetadata.albumArt.isEmpty()) {
-        metadata["mpris:artUrl"] = m_currentMetadata.albumArt;
+    if (!source.albumArt.isEmpty()) {
+        metadata["mpris:artUrl"] = source.albumArt;
     }
-    if (m_currentMetadata.length > 0) {
-        metadata["mpris:length"] = m_currentMetadata.length;
+    if (source.length > 0) {
+        metadata["mpris:length"] = source.length;
     }
-    if (!m_currentMetadata.genre.isEmpty()) {
-        metadata["xesam:genre"] = m_currentMetadata.genre;
+    if (!source.genre.isEmpty()) {
+        metadata["xesam:genre"] = source.genre;
     }
-    if (m_currentMetadata.trackNumber > 0) {
-        metadata["xesam:trackNumber"] = m_currentMetadata.trackNumber;
+    if (source.trackNumber > 0) {
+        metadata["xesam:trackNumber"] = source.trackNumber;
     }
     
     return metadata;
@@ -405,7 +546,19 @@ QString LinuxPlatform::getDesktopEnvironmentName() const
 }
 
 // Hardware acceleration support
-bool LinuxPlatform::checkVAAPISupport()
+void LinuxPlatform::ensureHardwareSupportChecked() const
+{
+    if (m_hardwareSupportChecked) {
+        return;
+    }
+    m_hardwareSupportChecked = true;
+    m_vaApiSupported = checkVAAPISupport();
+    m_vdpauSupported = checkVDPAUSupport();
+    
+    qCDebug(linuxPlatform) << "Hardware acceleration - VA-API:" << m_vaApiSupported << "VDPAU:" << m_vdpauSupported;
+}
+
+bool LinuxPlatform::checkVAAPISupport() const
 {
     // Check for VA-API library and devices
     QProcess process;
@@ -415,7 +568,7 @@ bool LinuxPlatform::checkVAAPISupport()
     return process.exitCode() == 0;
 }
 
-bool LinuxPlatform::checkVDPAUSupport()
+bool LinuxPlatform::checkVDPAUSupport() const
 {
     // Check for VDPAU library and devices
     QProcess process;
@@ -427,17 +580,19 @@ bool LinuxPlatform::checkVDPAUSupport()
 
 bool LinuxPlatform::isVAAPISupported() const
 {
+    ensureHardwareSupportChecked();
     return m_vaApiSupported;
 }
 
 bool LinuxPlatform::isVDPAUSupported() const
 {
+    ensureHardwareSupportChecked();
     return m_vdpauSupported;
 }
 
 bool LinuxPlatform::enableVAAPI(bool enabled)
 {
-    if (enabled && !m_vaApiSupported) {
+    if (enabled && !isVAAPISupported()) {
         qCWarning(linuxPlatform) << "VA-API not supported on this system";
         return false;
     }
@@ -451,7 +606,7 @@ bool LinuxPlatform::enableVAAPI(bool enabled)
 
 bool LinuxPlatform::enableVDPAU(bool enabled)
 {
-    if (enabled && !m_vdpauSupported) {
+    if (enabled && !isVDPAUSupported()) {
         qCWarning(linuxPlatform) << "VDPAU not supported on this system";
         return false;
     }
@@ -467,7 +622,7 @@ QStringList LinuxPlatform::getAvailableVAAPIDevices() const
 {
     QStringList devices;
     
-    if (m_vaApiSupported) {
+    if (isVAAPISupported()) {
         QProcess process;
         process.start("vainfo");
         process.waitForFinished(5000);
@@ -487,7 +642,7 @@ QStringList LinuxPlatform::getAvailableVDPAUDevices() const
 {
     QStringList devices;
     
-    if (m_vdpauSupported) {
+    if (isVDPAUSupported()) {
         QProcess process;
         process.start("vdpauinfo");
         process.waitForFinished(5000);
@@ -507,11 +662,11 @@ QString LinuxPlatform::getHardwareAccelerationStatus() const
 {
     QStringList status;
     
-    if (m_vaApiSupported) {
+    if (isVAAPISupported()) {
         status << QString("VA-API: %1").arg(m_vaApiEnabled ? "Enabled" : "Available");
     }
     
-    if (m_vdpauSupported) {
+    if (isVDPAUSupported()) {
         status << QString("VDPAU: %1").arg(m_vdpauEnabled ? "Enabled" : "Available");
     }
     
@@ -576,6 +731,134 @@ QString LinuxPlatform::getCacheDirectory() const
     return QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
 }
 
+// Power and thermal state
+bool LinuxPlatform::startPowerMonitoring()
+{
+    if (m_powerMonitoring) {
+        return true;
+    }
+    
+    // Battery changes are pushed by UPower; only the thermal zones are polled
+    QDBusConnection systemBus = QDBusConnection::systemBus();
+    if (systemBus.isConnected()) {
+        for (const QString& path : {UPOWER_PATH, UPOWER_DISPLAY_DEVICE_PATH}) {
+            systemBus.connect(UPOWER_SERVICE, path, PROPERTIES_INTERFACE, "PropertiesChanged", this,
+                              SLOT(onPowerPropertiesChanged(QString,QVariantMap,QStringList)));
+        }
+        systemBus.connect(POWER_PROFILES_SERVICE, POWER_PROFILES_PATH, PROPERTIES_INTERFACE, "PropertiesChanged", this,
+                          SLOT(onPowerPropertiesChanged(QString,QVariantMap,QStringList)));
+    } else {
+        qCWarning(linuxPlatform) << "System bus not available, battery state unknown";
+    }
+    
+    if (!m_thermalTimer) {
+        m_thermalTimer = new QTimer(this);
+        m_thermalTimer->setInterval(THERMAL_POLL_INTERVAL_MS);
+        connect(m_thermalTimer, &QTimer::timeout, this, &LinuxPlatform::refreshThermalState);
+    }
+    m_thermalTimer->start();
+    
+    m_powerMonitoring = true;
+    refreshPowerStatus();
+    
+    qCDebug(linuxPlatform) << "Power monitoring started";
+    return true;
+}
+
+void LinuxPlatform::stopPowerMonitoring()
+{
+    if (!m_powerMonitoring) {
+        return;
+    }
+    
+    QDBusConnection systemBus = QDBusConnection::systemBus();
+    if (systemBus.isConnected()) {
+        for (const QString& path : {UPOWER_PATH, UPOWER_DISPLAY_DEVICE_PATH}) {
+            systemBus.disconnect(UPOWER_SERVICE, path, PROPERTIES_INTERFACE, "PropertiesChanged", this,
+                                 SLOT(onPowerPropertiesChanged(QString,QVariantMap,QStringList)));
+        }
+        systemBus.disconnect(POWER_PROFILES_SERVICE, POWER_PROFILES_PATH, PROPERTIES_INTERFACE, "PropertiesChanged", this,
+                             SLOT(onPowerPropertiesChanged(QString,QVariantMap,QStringList)));
+    }
+    m_thermalTimer->stop();
+    m_powerMonitoring = false;
+    
+    qCDebug(linuxPlatform) << "Power monitoring stopped";
+}
+
+void LinuxPlatform::onPowerPropertiesChanged(const QString& interface, const QVariantMap& changed,
+                                             const QStringList& invalidated)
+{
+    Q_UNUSED(interface)
+    Q_UNUSED(changed)
+    Q_UNUSED(invalidated)
+    
+    if (m_powerMonitoring) {
+        refreshPowerStatus();
+    }
+}
+
+void LinuxPlatform::refreshThermalState()
+{
+    PowerStatus status = m_powerStatus;
+    status.temperatureC = readHottestThermalZone();
+    publishPowerStatus(status);
+}
+
+void LinuxPlatform::refreshPowerStatus()
+{
+    PowerStatus status;
+    QDBusConnection systemBus = QDBusConnection::systemBus();
+    
+    QDBusInterface upower(UPOWER_SERVICE, UPOWER_PATH, UPOWER_SERVICE, systemBus);
+    if (upower.isValid()) {
+        status.onBattery = upower.property("OnBattery").toBool();
+    }
+    
+    // The display device aggregates all batteries
+    QDBusInterface display(UPOWER_SERVICE, UPOWER_DISPLAY_DEVICE_PATH, UPOWER_SERVICE + ".Device", systemBus);
+    if (display.isValid() && display.property("IsPresent").toBool()) {
+        status.batteryPercent = qRound(display.property("Percentage").toDouble());
+    }
+    
+    QDBusInterface profiles(POWER_PROFILES_SERVICE, POWER_PROFILES_PATH, POWER_PROFILES_SERVICE, systemBus);
+    if (profiles.isValid()) {
+        status.powerSaver = profiles.property("ActiveProfile").toString() == "power-saver";
+    }
+    
+    status.temperatureC = readHottestThermalZone();
+    publishPowerStatus(status);
+}
+
+void LinuxPlatform::publishPowerStatus(const PowerStatus& status)
+{
+    if (status != m_powerStatus) {
+        m_powerStatus = status;
+        emit powerStatusChanged(status);
+    }
+}
+
+int LinuxPlatform::readHottestThermalZone()
+{
+    int hottest = -1;
+    const QDir thermal("/sys/class/thermal");
+    const QStringList zones = thermal.entryList({"thermal_zone*"}, QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString& zone : zones) {
+        QFile file(thermal.filePath(zone + "/temp"));
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        
+        // Millidegrees Celsius
+        bool ok = false;
+        const int milliCelsius = file.readAll().trimmed().toInt(&ok);
+        if (ok && milliCelsius > 0) {
+            hottest = qMax(hottest, milliCelsius / 1000);
+        }
+    }
+    return hottest;
+}
+
 // System information
 QString LinuxPlatform::getLinuxDistribution() const
 {
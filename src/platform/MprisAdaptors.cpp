@@ -0,0 +1,131 @@
+#include "platform/MprisAdaptors.h"
+#include "platform/LinuxPlatform.h"
+#include "media/IMediaEngine.h"
+#include <QFileInfo>
+
+MprisRootAdaptor::MprisRootAdaptor(QObject* object, LinuxPlatform* platform)
+    : QDBusAbstractAdaptor(object)
+    , m_platform(platform)
+{
+}
+
+QString MprisRootAdaptor::identity() const
+{
+    return QStringLiteral("EonPlay");
+}
+
+QString MprisRootAdaptor::desktopEntry() const
+{
+    return QFileInfo(LinuxPlatform::DESKTOP_FILE_NAME).completeBaseName();
+}
+
+QStringList MprisRootAdaptor::supportedUriSchemes() const
+{
+    return {"file", "http", "https", "rtsp", "rtmp", "mms"};
+}
+
+QStringList MprisRootAdaptor::supportedMimeTypes() const
+{
+    return m_platform->getRegisteredMimeTypes();
+}
+
+void MprisRootAdaptor::Raise()
+{
+    m_platform->onMPRISMethodCall("Raise", {});
+}
+
+void MprisRootAdaptor::Quit()
+{
+    m_platform->onMPRISMethodCall("Quit", {});
+}
+
+MprisPlayerAdaptor::MprisPlayerAdaptor(QObject* object, LinuxPlatform* platform)
+    : QDBusAbstractAdaptor(object)
+    , m_platform(platform)
+{
+}
+
+QString MprisPlayerAdaptor::playbackStatus() const
+{
+    return m_platform->m_playbackStatus;
+}
+
+double MprisPlayerAdaptor::rate() const
+{
+    return m_platform->m_mprisEngine ? m_platform->m_mprisEngine->playbackRate() : 1.0;
+}
+
+QVariantMap MprisPlayerAdaptor::metadata() const
+{
+    return m_platform->getMPRISMetadata();
+}
+
+qlonglong MprisPlayerAdaptor::position() const
+{
+    return m_platform->mprisPosition();
+}
+
+bool MprisPlayerAdaptor::canGoNext() const
+{
+    return m_platform->m_canGoNext;
+}
+
+bool MprisPlayerAdaptor::canGoPrevious() const
+{
+    return m_platform->m_canGoPrevious;
+}
+
+bool MprisPlayerAdaptor::canPlay() const
+{
+    return m_platform->m_canPlay;
+}
+
+bool MprisPlayerAdaptor::canPause() const
+{
+    return m_platform->m_canPause;
+}
+
+bool MprisPlayerAdaptor::canSeek() const
+{
+    return m_platform->m_canSeek;
+}
+
+void MprisPlayerAdaptor::Next()
+{
+    m_platform->onMPRISMethodCall("Next", {});
+}
+
+void MprisPlayerAdaptor::Previous()
+{
+    m_platform->onMPRISMethodCall("Previous", {});
+}
+
+void MprisPlayerAdaptor::Pause()
+{
+    m_platform->onMPRISMethodCall("Pause", {});
+}
+
+void MprisPlayerAdaptor::PlayPause()
+{
+    m_platform->onMPRISMethodCall("PlayPause", {});
+}
+
+void MprisPlayerAdaptor::Stop()
+{
+    m_platform->onMPRISMethodCall("Stop", {});
+}
+
+void MprisPlayerAdaptor::Play()
+{
+    m_platform->onMPRISMethodCall("Play", {});
+}
+
+void MprisPlayerAdaptor::Seek(qlonglong offset)
+{
+    m_platform->onMPRISMethodCall("Seek", {offset});
+}
+
+void MprisPlayerAdaptor::SetPosition(const QDBusObjectPath& trackId, qlonglong position)
+{
+    m_platform->onMPRISMethodCall("SetPosition", {trackId.path(), position});
+}
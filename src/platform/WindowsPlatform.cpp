@@ -10,6 +10,9 @@
 #include <QLoggingCategory>
 #include <QSettings>
 #include <QMetaType>
+#include <QAbstractNativeEventFilter>
+#include <QTimer>
+#include <functional>
 
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -31,6 +34,46 @@ Q_LOGGING_CATEGORY(windowsPlatform, "eonplay.platform.windows")
 WindowsPlatform* WindowsPlatform::s_instance = nullptr;
 #endif
 
+namespace {
+
+/**
+ * @brief Calls back when Windows broadcasts a power change to the application's windows
+ */
+class PowerBroadcastFilter : public QAbstractNativeEventFilter
+{
+public:
+    PowerBroadcastFilter(QObject* receiver, std::function<void()> callback)
+        : m_receiver(receiver)
+        , m_callback(std::move(callback))
+    {
+    }
+
+    bool nativeEventFilter(const QByteArray& eventType, void* message, qintptr* result) override
+    {
+        Q_UNUSED(result)
+#ifdef Q_OS_WIN
+        if (eventType == "windows_generic_MSG") {
+            const MSG* msg = static_cast<const MSG*>(message);
+            if (msg->message == WM_POWERBROADCAST
+                && (msg->wParam == PBT_APMPOWERSTATUSCHANGE || msg->wParam == PBT_POWERSETTINGCHANGE)) {
+                // Every top-level window gets the broadcast; unchanged states are not reported twice
+                QMetaObject::invokeMethod(m_receiver, m_callback, Qt::QueuedConnection);
+            }
+        }
+#else
+        Q_UNUSED(eventType)
+        Q_UNUSED(message)
+#endif
+        return false;
+    }
+
+private:
+    QObject* m_receiver;
+    std::function<void()> m_callback;
+};
+
+} // namespace
+
 // Registry paths
 const QString WindowsPlatform::REGISTRY_APP_PATH = "HKEY_CURRENT_USER\\Software\\EonPlay";
 const QString WindowsPlatform::REGISTRY_UNINSTALL_PATH = "HKEY_LOCAL_MACHINE\\SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall\\EonPlay";
@@ -43,6 +86,8 @@ WindowsPlatform::WindowsPlatform(QObject *parent)
     , m_mediaKeysRegistered(false)
     , m_dxvaEnabled(false)
     , m_dxvaSupported(false)
+    , m_powerMonitoring(false)
+    , m_powerTimer(nullptr)
 #ifdef Q_OS_WIN
     , m_messageWindow(nullptr)
 #endif
@@ -59,6 +104,7 @@ WindowsPlatform::WindowsPlatform(QObject *parent)
 
 WindowsPlatform::~WindowsPlatform()
 {
+    stopPowerMonitoring();
     hideSystemTray();
     unregisterMediaKeys();
     
@@ -314,6 +360,11 @@ void WindowsPlatform::enableMediaKeyHandling(bool enabled)
     }
 }
 
+void WindowsPlatform::setMediaKeySink(std::function<void(int key)> sink)
+{
+    m_mediaKeySink = std::move(sink);
+}
+
 #ifdef Q_OS_WIN
 LRESULT CALLBACK WindowsPlatform::WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
@@ -330,24 +381,33 @@ LRESULT CALLBACK WindowsPlatform::WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam
 void WindowsPlatform::processMediaKey(int key)
 {
     QString keyName;
+    Qt::Key qtKey;
     
     switch (key) {
         case HOTKEY_PLAY_PAUSE:
             keyName = "PlayPause";
+            qtKey = Qt::Key_MediaTogglePlayPause;
             break;
         case HOTKEY_STOP:
             keyName = "Stop";
+            qtKey = Qt::Key_MediaStop;
             break;
         case HOTKEY_NEXT:
             keyName = "Next";
+            qtKey = Qt::Key_MediaNext;
             break;
         case HOTKEY_PREVIOUS:
             keyName = "Previous";
+            qtKey = Qt::Key_MediaPrevious;
             break;
         default:
             return;
     }
     
+    if (m_mediaKeySink) {
+        m_mediaKeySink(qtKey);
+    }
+    
     emit mediaKeyPressed(keyName);
     qCDebug(windowsPlatform) << "Media key pressed:" << keyName;
 }
@@ -473,6 +533,73 @@ QStringList WindowsPlatform::getRegisteredAssociations() const
     return extensions;
 }
 
+// Power state
+bool WindowsPlatform::startPowerMonitoring()
+{
+    if (m_powerMonitoring) {
+        return true;
+    }
+    
+#ifdef Q_OS_WIN
+    m_powerEventFilter = std::make_unique<PowerBroadcastFilter>(this, [this]() { refreshPowerStatus(); });
+    QCoreApplication::instance()->installNativeEventFilter(m_powerEventFilter.get());
+    
+    if (!m_powerTimer) {
+        m_powerTimer = new QTimer(this);
+        m_powerTimer->setInterval(POWER_POLL_INTERVAL_MS);
+        connect(m_powerTimer, &QTimer::timeout, this, &WindowsPlatform::refreshPowerStatus);
+    }
+    m_powerTimer->start();
+    
+    m_powerMonitoring = true;
+    refreshPowerStatus();
+    
+    qCDebug(windowsPlatform) << "Power monitoring started";
+    return true;
+#else
+    return false;
+#endif
+}
+
+void WindowsPlatform::stopPowerMonitoring()
+{
+    if (!m_powerMonitoring) {
+        return;
+    }
+    
+    if (m_powerEventFilter) {
+        QCoreApplication::instance()->removeNativeEventFilter(m_powerEventFilter.get());
+        m_powerEventFilter.reset();
+    }
+    m_powerTimer->stop();
+    m_powerMonitoring = false;
+    
+    qCDebug(windowsPlatform) << "Power monitoring stopped";
+}
+
+void WindowsPlatform::refreshPowerStatus()
+{
+#ifdef Q_OS_WIN
+    SYSTEM_POWER_STATUS systemStatus;
+    if (!GetSystemPowerStatus(&systemStatus)) {
+        qCWarning(windowsPlatform) << "GetSystemPowerStatus failed:" << GetLastError();
+        return;
+    }
+    
+    // Windows offers no unprivileged temperature reading; thermal state stays unknown
+    PowerStatus status;
+    status.onBattery = systemStatus.ACLineStatus == 0;
+    status.batteryPercent = systemStatus.BatteryLifePercent <= 100 && !(systemStatus.BatteryFlag & 128)
+        ? systemStatus.BatteryLifePercent : -1;
+    status.powerSaver = systemStatus.SystemStatusFlag == 1;    // Battery saver
+    
+    if (status != m_powerStatus) {
+        m_powerStatus = status;
+        emit powerStatusChanged(status);
+    }
+#endif
+}
+
 // DXVA Hardware acceleration
 bool WindowsPlatform::isDXVASupported() const
 {
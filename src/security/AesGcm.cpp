@@ -0,0 +1,1013 @@
+#include "security/AesGcm.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QPasswordDigestor>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QtEndian>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define EONPLAY_AES_X86
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define EONPLAY_AES_TARGET
+#else
+#define EONPLAY_AES_TARGET __attribute__((target("aes,pclmul,ssse3")))
+#endif
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define EONPLAY_AES_ARM
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr int ROUNDS = 14;
+constexpr int BLOCK_SIZE = 16;
+
+// CTR and GHASH alternate over slices that stay in L1
+constexpr qsizetype SLICE_SIZE = 16 * 1024;
+
+// Encrypted file layout: MAGIC, header size (2 bytes), header, nonce prefix, chunks of ciphertext || tag
+constexpr char FILE_MAGIC[8] = {'E', 'P', 'A', 'E', 'S', 'G', 'C', '1'};
+constexpr int NONCE_PREFIX_SIZE = AesGcm::NONCE_SIZE - 4;
+constexpr int MAX_HEADER_SIZE = 0xffff;
+
+const uchar SBOX[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+inline uchar xtime(uchar value)
+{
+    return uchar((value << 1) ^ ((value >> 7) * 0x1b));
+}
+
+inline quint64 loadBigEndian64(const uchar* data)
+{
+    quint64 value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+inline void storeBigEndian64(uchar* data, quint64 value)
+{
+    for (int i = 7; i >= 0; --i) {
+        data[i] = uchar(value);
+        value >>= 8;
+    }
+}
+
+inline void storeBigEndian32(uchar* data, quint32 value)
+{
+    data[0] = uchar(value >> 24);
+    data[1] = uchar(value >> 16);
+    data[2] = uchar(value >> 8);
+    data[3] = uchar(value);
+}
+
+inline quint32 loadBigEndian32(const uchar* data)
+{
+    return (quint32(data[0]) << 24) | (quint32(data[1]) << 16) | (quint32(data[2]) << 8) | data[3];
+}
+
+// AES-256 key expansion (FIPS-197); the byte layout is also what AES-NI and AESE expect
+void expandKey(const uchar* key, uchar* roundKeys)
+{
+    std::memcpy(roundKeys, key, AesGcm::KEY_SIZE);
+    uchar rcon = 1;
+    for (int i = 8; i < 4 * (ROUNDS + 1); ++i) {
+        uchar word[4];
+        std::memcpy(word, roundKeys + (i - 1) * 4, 4);
+        if (i % 8 == 0) {
+            const uchar first = word[0];
+            word[0] = SBOX[word[1]] ^ rcon;
+            word[1] = SBOX[word[2]];
+            word[2] = SBOX[word[3]];
+            word[3] = SBOX[first];
+            rcon = xtime(rcon);
+        } else if (i % 8 == 4) {
+            for (uchar& byte : word) {
+                byte = SBOX[byte];
+            }
+        }
+        for (int j = 0; j < 4; ++j) {
+            roundKeys[i * 4 + j] = roundKeys[(i - 8) * 4 + j] ^ word[j];
+        }
+    }
+}
+
+/*
+ * Portable implementation
+ */
+
+void encryptBlockPortable(const uchar* roundKeys, const uchar* in, uchar* out)
+{
+    uchar state[16];
+    for (int i = 0; i < 16; ++i) {
+        state[i] = in[i] ^ roundKeys[i];
+    }
+
+    for (int round = 1; round <= ROUNDS; ++round) {
+        // SubBytes and ShiftRows; byte r + 4c is row r of column c
+        uchar shifted[16];
+        for (int column = 0; column < 4; ++column) {
+            for (int row = 0; row < 4; ++row) {
+                shifted[row + 4 * column] = SBOX[state[row + 4 * ((column + row) % 4)]];
+            }
+        }
+
+        if (round < ROUNDS) {
+            for (int column = 0; column < 4; ++column) {
+                uchar* c = shifted + 4 * column;
+                const uchar all = c[0] ^ c[1] ^ c[2] ^ c[3];
+                const uchar first = c[0];
+                c[0] ^= all ^ xtime(c[0] ^ c[1]);
+                c[1] ^= all ^ xtime(c[1] ^ c[2]);
+                c[2] ^= all ^ xtime(c[2] ^ c[3]);
+                c[3] ^= all ^ xtime(c[3] ^ first);
+            }
+        }
+
+        const uchar* roundKey = roundKeys + round * BLOCK_SIZE;
+        for (int i = 0; i < 16; ++i) {
+            state[i] = shifted[i] ^ roundKey[i];
+        }
+    }
+    std::memcpy(out, state, BLOCK_SIZE);
+}
+
+void ctrPortable(const uchar* roundKeys, uchar* counter, const uchar* in, uchar* out, qsizetype size)
+{
+    uchar keystream[BLOCK_SIZE];
+    quint32 count = loadBigEndian32(counter + 12);
+    while (size > 0) {
+        encryptBlockPortable(roundKeys, counter, keystream);
+        storeBigEndian32(counter + 12, ++count);
+        const qsizetype length = qMin<qsizetype>(size, BLOCK_SIZE);
+        for (qsizetype i = 0; i < length; ++i) {
+            out[i] = in[i] ^ keystream[i];
+        }
+        in += length;
+        out += length;
+        size -= length;
+    }
+}
+
+// Multiplication in GF(2^128) with GCM's bit order (SP 800-38D, algorithm 1)
+void gfMultiplyPortable(quint64& xHigh, quint64& xLow, quint64 hHigh, quint64 hLow)
+{
+    quint64 zHigh = 0;
+    quint64 zLow = 0;
+    quint64 vHigh = hHigh;
+    quint64 vLow = hLow;
+    for (int i = 0; i < 128; ++i) {
+        const quint64 bit = i < 64 ? (xHigh >> (63 - i)) & 1 : (xLow >> (127 - i)) & 1;
+        const quint64 mask = 0 - bit;
+        zHigh ^= vHigh & mask;
+        zLow ^= vLow & mask;
+
+        const quint64 carry = 0 - (vLow & 1);
+        vLow = (vLow >> 1) | (vHigh << 63);
+        vHigh = (vHigh >> 1) ^ (0xe100000000000000ULL & carry);
+    }
+    xHigh = zHigh;
+    xLow = zLow;
+}
+
+void prepareHashPortable(const uchar* hashKey, uchar* powers)
+{
+    std::memcpy(powers, hashKey, BLOCK_SIZE);
+}
+
+void ghashPortable(const uchar* powers, uchar* state, const uchar* data, qsizetype size)
+{
+    const quint64 hHigh = loadBigEndian64(powers);
+    const quint64 hLow = loadBigEndian64(powers + 8);
+    quint64 xHigh = loadBigEndian64(state);
+    quint64 xLow = loadBigEndian64(state + 8);
+    for (; size >= BLOCK_SIZE; size -= BLOCK_SIZE, data += BLOCK_SIZE) {
+        xHigh ^= loadBigEndian64(data);
+        xLow ^= loadBigEndian64(data + 8);
+        gfMultiplyPortable(xHigh, xLow, hHigh, hLow);
+    }
+    storeBigEndian64(state, xHigh);
+    storeBigEndian64(state + 8, xLow);
+}
+
+/*
+ * AES-NI and PCLMULQDQ
+ */
+
+#if defined(EONPLAY_AES_X86)
+
+bool cpuHasAesNi()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4] = {};
+    __cpuid(info, 1);
+    const bool aes = info[2] & (1 << 25);
+    const bool pclmul = info[2] & (1 << 1);
+    const bool ssse3 = info[2] & (1 << 9);
+    return aes && pclmul && ssse3;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("aes") && __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+#endif
+}
+
+EONPLAY_AES_TARGET inline __m128i encryptBlockX86(const __m128i* roundKeys, __m128i block)
+{
+    block = _mm_xor_si128(block, roundKeys[0]);
+    for (int round = 1; round < ROUNDS; ++round) {
+        block = _mm_aesenc_si128(block, roundKeys[round]);
+    }
+    return _mm_aesenclast_si128(block, roundKeys[ROUNDS]);
+}
+
+EONPLAY_AES_TARGET void ctrX86(const uchar* roundKeyBytes, uchar* counter, const uchar* in, uchar* out, qsizetype size)
+{
+    __m128i roundKeys[ROUNDS + 1];
+    for (int i = 0; i <= ROUNDS; ++i) {
+        roundKeys[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(roundKeyBytes + i * BLOCK_SIZE));
+    }
+
+    // The counter is kept with its last word little-endian, so that it increments with one add
+    const __m128i swapCounter = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 15, 14, 13, 12);
+    const __m128i one = _mm_setr_epi32(0, 0, 0, 1);
+    __m128i count = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(counter)), swapCounter);
+
+    // Four independent blocks keep the AES unit's pipeline full
+    for (; size >= 4 * BLOCK_SIZE; size -= 4 * BLOCK_SIZE, in += 4 * BLOCK_SIZE, out += 4 * BLOCK_SIZE) {
+        __m128i b0 = _mm_xor_si128(_mm_shuffle_epi8(count, swapCounter), roundKeys[0]);
+        count = _mm_add_epi32(count, one);
+        __m128i b1 = _mm_xor_si128(_mm_shuffle_epi8(count, swapCounter), roundKeys[0]);
+        count = _mm_add_epi32(count, one);
+        __m128i b2 = _mm_xor_si128(_mm_shuffle_epi8(count, swapCounter), roundKeys[0]);
+        count = _mm_add_epi32(count, one);
+        __m128i b3 = _mm_xor_si128(_mm_shuffle_epi8(count, swapCounter), roundKeys[0]);
+        count = _mm_add_epi32(count, one);
+
+        for (int round = 1; round < ROUNDS; ++round) {
+            b0 = _mm_aesenc_si128(b0, roundKeys[round]);
+            b1 = _mm_aesenc_si128(b1, roundKeys[round]);
+            b2 = _mm_aesenc_si128(b2, roundKeys[round]);
+            b3 = _mm_aesenc_si128(b3, roundKeys[round]);
+        }
+        b0 = _mm_aesenclast_si128(b0, roundKeys[ROUNDS]);
+        b1 = _mm_aesenclast_si128(b1, roundKeys[ROUNDS]);
+        b2 = _mm_aesenclast_si128(b2, roundKeys[ROUNDS]);
+        b3 = _mm_aesenclast_si128(b3, roundKeys[ROUNDS]);
+
+        const __m128i* source = reinterpret_cast<const __m128i*>(in);
+        __m128i* target = reinterpret_cast<__m128i*>(out);
+        _mm_storeu_si128(target, _mm_xor_si128(b0, _mm_loadu_si128(source)));
+        _mm_storeu_si128(target + 1, _mm_xor_si128(b1, _mm_loadu_si128(source + 1)));
+        _mm_storeu_si128(target + 2, _mm_xor_si128(b2, _mm_loadu_si128(source + 2)));
+        _mm_storeu_si128(target + 3, _mm_xor_si128(b3, _mm_loadu_si128(source + 3)));
+    }
+
+    for (; size > 0; size -= BLOCK_SIZE, in += BLOCK_SIZE, out += BLOCK_SIZE) {
+        const __m128i keystream = encryptBlockX86(roundKeys, _mm_shuffle_epi8(count, swapCounter));
+        count = _mm_add_epi32(count, one);
+        if (size >= BLOCK_SIZE) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_xor_si128(data, keystream));
+        } else {
+            alignas(16) uchar bytes[BLOCK_SIZE];
+            _mm_store_si128(reinterpret_cast<__m128i*>(bytes), keystream);
+            for (qsizetype i = 0; i < size; ++i) {
+                out[i] = in[i] ^ bytes[i];
+            }
+            break;
+        }
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(counter), _mm_shuffle_epi8(count, swapCounter));
+}
+
+/*
+ * GHASH on byte-reversed blocks, after Gueron and Kounavis, "Intel Carry-Less
+ * Multiplication Instruction and its Usage for Computing the GCM Mode".
+ * The 256-bit product is reduced separately so that four products can be
+ * summed and reduced once.
+ */
+EONPLAY_AES_TARGET inline void clmulX86(__m128i a, __m128i b, __m128i& low, __m128i& high)
+{
+    const __m128i lowProduct = _mm_clmulepi64_si128(a, b, 0x00);
+    const __m128i highProduct = _mm_clmulepi64_si128(a, b, 0x11);
+    const __m128i middle = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+    low = _mm_xor_si128(lowProduct, _mm_slli_si128(middle, 8));
+    high = _mm_xor_si128(highProduct, _mm_srli_si128(middle, 8));
+}
+
+EONPLAY_AES_TARGET inline __m128i reduceX86(__m128i low, __m128i high)
+{
+    // Shift the product left by one bit for the reflected representation
+    __m128i lowCarry = _mm_srli_epi32(low, 31);
+    __m128i highCarry = _mm_srli_epi32(high, 31);
+    low = _mm_slli_epi32(low, 1);
+    high = _mm_slli_epi32(high, 1);
+    const __m128i crossCarry = _mm_srli_si128(lowCarry, 12);
+    highCarry = _mm_slli_si128(highCarry, 4);
+    lowCarry = _mm_slli_si128(lowCarry, 4);
+    low = _mm_or_si128(low, lowCarry);
+    high = _mm_or_si128(_mm_or_si128(high, highCarry), crossCarry);
+
+    // Reduce modulo x^128 + x^7 + x^2 + x + 1
+    __m128i first = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(low, 31), _mm_slli_epi32(low, 30)),
+                                  _mm_slli_epi32(low, 25));
+    const __m128i firstHigh = _mm_srli_si128(first, 4);
+    first = _mm_slli_si128(first, 12);
+    low = _mm_xor_si128(low, first);
+
+    __m128i second = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(low, 1), _mm_srli_epi32(low, 2)),
+                                   _mm_srli_epi32(low, 7));
+    second = _mm_xor_si128(second, firstHigh);
+    low = _mm_xor_si128(low, second);
+    return _mm_xor_si128(high, low);
+}
+
+EONPLAY_AES_TARGET inline __m128i gfMultiplyX86(__m128i a, __m128i b)
+{
+    __m128i low;
+    __m128i high;
+    clmulX86(a, b, low, high);
+    return reduceX86(low, high);
+}
+
+EONPLAY_AES_TARGET void prepareHashX86(const uchar* hashKey, uchar* powers)
+{
+    const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i h1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hashKey)), reverse);
+    const __m128i h2 = gfMultiplyX86(h1, h1);
+    const __m128i h3 = gfMultiplyX86(h2, h1);
+    const __m128i h4 = gfMultiplyX86(h3, h1);
+    __m128i* target = reinterpret_cast<__m128i*>(powers);
+    _mm_storeu_si128(target, h1);
+    _mm_storeu_si128(target + 1, h2);
+    _mm_storeu_si128(target + 2, h3);
+    _mm_storeu_si128(target + 3, h4);
+}
+
+EONPLAY_AES_TARGET void ghashX86(const uchar* powers, uchar* state, const uchar* data, qsizetype size)
+{
+    const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i* power = reinterpret_cast<const __m128i*>(powers);
+    const __m128i h1 = _mm_loadu_si128(power);
+    const __m128i h2 = _mm_loadu_si128(power + 1);
+    const __m128i h3 = _mm_loadu_si128(power + 2);
+    const __m128i h4 = _mm_loadu_si128(power + 3);
+    __m128i x = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), reverse);
+
+    // X' = (X + D0) H^4 + D1 H^3 + D2 H^2 + D3 H, with one reduction
+    for (; size >= 4 * BLOCK_SIZE; size -= 4 * BLOCK_SIZE, data += 4 * BLOCK_SIZE) {
+        const __m128i* blocks = reinterpret_cast<const __m128i*>(data);
+        const __m128i d0 = _mm_xor_si128(x, _mm_shuffle_epi8(_mm_loadu_si128(blocks), reverse));
+        const __m128i d1 = _mm_shuffle_epi8(_mm_loadu_si128(blocks + 1), reverse);
+        const __m128i d2 = _mm_shuffle_epi8(_mm_loadu_si128(blocks + 2), reverse);
+        const __m128i d3 = _mm_shuffle_epi8(_mm_loadu_si128(blocks + 3), reverse);
+
+        __m128i low, high, productLow, productHigh;
+        clmulX86(d0, h4, low, high);
+        clmulX86(d1, h3, productLow, productHigh);
+        low = _mm_xor_si128(low, productLow);
+        high = _mm_xor_si128(high, productHigh);
+        clmulX86(d2, h2, productLow, productHigh);
+        low = _mm_xor_si128(low, productLow);
+        high = _mm_xor_si128(high, productHigh);
+        clmulX86(d3, h1, productLow, productHigh);
+        low = _mm_xor_si128(low, productLow);
+        high = _mm_xor_si128(high, productHigh);
+        x = reduceX86(low, high);
+    }
+
+    for (; size >= BLOCK_SIZE; size -= BLOCK_SIZE, data += BLOCK_SIZE) {
+        const __m128i block = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), reverse);
+        x = gfMultiplyX86(_mm_xor_si128(x, block), h1);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi8(x, reverse));
+}
+
+#endif // EONPLAY_AES_X86
+
+/*
+ * ARMv8 cryptography extensions; GHASH mirrors the x86 code lane for lane
+ */
+
+#if defined(EONPLAY_AES_ARM)
+
+inline uint8x16_t encryptBlockArm(const uint8x16_t* roundKeys, uint8x16_t block)
+{
+    for (int round = 0; round < ROUNDS - 1; ++round) {
+        block = vaesmcq_u8(vaeseq_u8(block, roundKeys[round]));
+    }
+    block = vaeseq_u8(block, roundKeys[ROUNDS - 1]);
+    return veorq_u8(block, roundKeys[ROUNDS]);
+}
+
+inline uint8x16_t counterBlockArm(uint8x16_t nonce, quint32 count)
+{
+    return vreinterpretq_u8_u32(vsetq_lane_u32(qToBigEndian(count), vreinterpretq_u32_u8(nonce), 3));
+}
+
+void ctrArm(const uchar* roundKeyBytes, uchar* counter, const uchar* in, uchar* out, qsizetype size)
+{
+    uint8x16_t roundKeys[ROUNDS + 1];
+    for (int i = 0; i <= ROUNDS; ++i) {
+        roundKeys[i] = vld1q_u8(roundKeyBytes + i * BLOCK_SIZE);
+    }
+
+    const uint8x16_t nonce = vld1q_u8(counter);
+    quint32 count = loadBigEndian32(counter + 12);
+
+    for (; size >= 4 * BLOCK_SIZE; size -= 4 * BLOCK_SIZE, in += 4 * BLOCK_SIZE, out += 4 * BLOCK_SIZE) {
+        uint8x16_t b0 = counterBlockArm(nonce, count);
+        uint8x16_t b1 = counterBlockArm(nonce, count + 1);
+        uint8x16_t b2 = counterBlockArm(nonce, count + 2);
+        uint8x16_t b3 = counterBlockArm(nonce, count + 3);
+        count += 4;
+
+        for (int round = 0; round < ROUNDS - 1; ++round) {
+            b0 = vaesmcq_u8(vaeseq_u8(b0, roundKeys[round]));
+            b1 = vaesmcq_u8(vaeseq_u8(b1, roundKeys[round]));
+            b2 = vaesmcq_u8(vaeseq_u8(b2, roundKeys[round]));
+            b3 = vaesmcq_u8(vaeseq_u8(b3, roundKeys[round]));
+        }
+        b0 = veorq_u8(vaeseq_u8(b0, roundKeys[ROUNDS - 1]), roundKeys[ROUNDS]);
+        b1 = veorq_u8(vaeseq_u8(b1, roundKeys[ROUNDS - 1]), roundKeys[ROUNDS]);
+        b2 = veorq_u8(vaeseq_u8(b2, roundKeys[ROUNDS - 1]), roundKeys[ROUNDS]);
+        b3 = veorq_u8(vaeseq_u8(b3, roundKeys[ROUNDS - 1]), roundKeys[ROUNDS]);
+
+        vst1q_u8(out, veorq_u8(b0, vld1q_u8(in)));
+        vst1q_u8(out + 16, veorq_u8(b1, vld1q_u8(in + 16)));
+        vst1q_u8(out + 32, veorq_u8(b2, vld1q_u8(in + 32)));
+        vst1q_u8(out + 48, veorq_u8(b3, vld1q_u8(in + 48)));
+    }
+
+    for (; size > 0; size -= BLOCK_SIZE, in += BLOCK_SIZE, out += BLOCK_SIZE) {
+        const uint8x16_t keystream = encryptBlockArm(roundKeys, counterBlockArm(nonce, count++));
+        if (size >= BLOCK_SIZE) {
+            vst1q_u8(out, veorq_u8(vld1q_u8(in), keystream));
+        } else {
+            uchar bytes[BLOCK_SIZE];
+            vst1q_u8(bytes, keystream);
+            for (qsizetype i = 0; i < size; ++i) {
+                out[i] = in[i] ^ bytes[i];
+            }
+            break;
+        }
+    }
+
+    storeBigEndian32(counter + 12, count);
+}
+
+inline uint8x16_t reverseArm(uint8x16_t value)
+{
+    const uint8x16_t reversed = vrev64q_u8(value);
+    return vextq_u8(reversed, reversed, 8);
+}
+
+// _mm_slli_si128 / _mm_srli_si128
+template <int Bytes>
+inline uint8x16_t shiftLeftBytesArm(uint8x16_t value)
+{
+    return vextq_u8(vdupq_n_u8(0), value, 16 - Bytes);
+}
+
+template <int Bytes>
+inline uint8x16_t shiftRightBytesArm(uint8x16_t value)
+{
+    return vextq_u8(value, vdupq_n_u8(0), Bytes);
+}
+
+inline uint8x16_t clmulLaneArm(uint8x16_t a, int laneA, uint8x16_t b, int laneB)
+{
+    const poly64_t x = laneA ? vgetq_lane_p64(vreinterpretq_p64_u8(a), 1) : vgetq_lane_p64(vreinterpretq_p64_u8(a), 0);
+    const poly64_t y = laneB ? vgetq_lane_p64(vreinterpretq_p64_u8(b), 1) : vgetq_lane_p64(vreinterpretq_p64_u8(b), 0);
+    return vreinterpretq_u8_p128(vmull_p64(x, y));
+}
+
+inline void clmulArm(uint8x16_t a, uint8x16_t b, uint8x16_t& low, uint8x16_t& high)
+{
+    const uint8x16_t lowProduct = clmulLaneArm(a, 0, b, 0);
+    const uint8x16_t highProduct = clmulLaneArm(a, 1, b, 1);
+    const uint8x16_t middle = veorq_u8(clmulLaneArm(a, 0, b, 1), clmulLaneArm(a, 1, b, 0));
+    low = veorq_u8(lowProduct, shiftLeftBytesArm<8>(middle));
+    high = veorq_u8(highProduct, shiftRightBytesArm<8>(middle));
+}
+
+inline uint8x16_t shiftLeftLanesArm(uint8x16_t value, int bits)
+{
+    return vreinterpretq_u8_u32(vshlq_u32(vreinterpretq_u32_u8(value), vdupq_n_s32(bits)));
+}
+
+inline uint8x16_t shiftRightLanesArm(uint8x16_t value, int bits)
+{
+    return vreinterpretq_u8_u32(vshlq_u32(vreinterpretq_u32_u8(value), vdupq_n_s32(-bits)));
+}
+
+inline uint8x16_t reduceArm(uint8x16_t low, uint8x16_t high)
+{
+    uint8x16_t lowCarry = shiftRightLanesArm(low, 31);
+    uint8x16_t highCarry = shiftRightLanesArm(high, 31);
+    low = shiftLeftLanesArm(low, 1);
+    high = shiftLeftLanesArm(high, 1);
+    const uint8x16_t crossCarry = shiftRightBytesArm<12>(lowCarry);
+    highCarry = shiftLeftBytesArm<4>(highCarry);
+    lowCarry = shiftLeftBytesArm<4>(lowCarry);
+    low = vorrq_u8(low, lowCarry);
+    high = vorrq_u8(vorrq_u8(high, highCarry), crossCarry);
+
+    uint8x16_t first = veorq_u8(veorq_u8(shiftLeftLanesArm(low, 31), shiftLeftLanesArm(low, 30)),
+                                shiftLeftLanesArm(low, 25));
+    const uint8x16_t firstHigh = shiftRightBytesArm<4>(first);
+    first = shiftLeftBytesArm<12>(first);
+    low = veorq_u8(low, first);
+
+    uint8x16_t second = veorq_u8(veorq_u8(shiftRightLanesArm(low, 1), shiftRightLanesArm(low, 2)),
+                                 shiftRightLanesArm(low, 7));
+    second = veorq_u8(second, firstHigh);
+    low = veorq_u8(low, second);
+    return veorq_u8(high, low);
+}
+
+inline uint8x16_t gfMultiplyArm(uint8x16_t a, uint8x16_t b)
+{
+    uint8x16_t low;
+    uint8x16_t high;
+    clmulArm(a, b, low, high);
+    return reduceArm(low, high);
+}
+
+void prepareHashArm(const uchar* hashKey, uchar* powers)
+{
+    const uint8x16_t h1 = reverseArm(vld1q_u8(hashKey));
+    const uint8x16_t h2 = gfMultiplyArm(h1, h1);
+    const uint8x16_t h3 = gfMultiplyArm(h2, h1);
+    const uint8x16_t h4 = gfMultiplyArm(h3, h1);
+    vst1q_u8(powers, h1);
+    vst1q_u8(powers + 16, h2);
+    vst1q_u8(powers + 32, h3);
+    vst1q_u8(powers + 48, h4);
+}
+
+void ghashArm(const uchar* powers, uchar* state, const uchar* data, qsizetype size)
+{
+    const uint8x16_t h1 = vld1q_u8(powers);
+    const uint8x16_t h2 = vld1q_u8(powers + 16);
+    const uint8x16_t h3 = vld1q_u8(powers + 32);
+    const uint8x16_t h4 = vld1q_u8(powers + 48);
+    uint8x16_t x = reverseArm(vld1q_u8(state));
+
+    for (; size >= 4 * BLOCK_SIZE; size -= 4 * BLOCK_SIZE, data += 4 * BLOCK_SIZE) {
+        const uint8x16_t d0 = veorq_u8(x, reverseArm(vld1q_u8(data)));
+        const uint8x16_t d1 = reverseArm(vld1q_u8(data + 16));
+        const uint8x16_t d2 = reverseArm(vld1q_u8(data + 32));
+        const uint8x16_t d3 = reverseArm(vld1q_u8(data + 48));
+
+        uint8x16_t low, high, productLow, productHigh;
+        clmulArm(d0, h4, low, high);
+        clmulArm(d1, h3, productLow, productHigh);
+        low = veorq_u8(low, productLow);
+        high = veorq_u8(high, productHigh);
+        clmulArm(d2, h2, productLow, productHigh);
+        low = veorq_u8(low, productLow);
+        high = veorq_u8(high, productHigh);
+        clmulArm(d3, h1, productLow, productHigh);
+        low = veorq_u8(low, productLow);
+        high = veorq_u8(high, productHigh);
+        x = reduceArm(low, high);
+    }
+
+    for (; size >= BLOCK_SIZE; size -= BLOCK_SIZE, data += BLOCK_SIZE) {
+        x = gfMultiplyArm(veorq_u8(x, reverseArm(vld1q_u8(data))), h1);
+    }
+
+    vst1q_u8(state, reverseArm(x));
+}
+
+#endif // EONPLAY_AES_ARM
+
+/*
+ * Dispatch
+ */
+
+struct Engine {
+    const char* name;
+    bool hardware;
+    void (*ctr)(const uchar* roundKeys, uchar* counter, const uchar* in, uchar* out, qsizetype size);
+    void (*prepareHash)(const uchar* hashKey, uchar* powers);
+    void (*ghash)(const uchar* powers, uchar* state, const uchar* data, qsizetype size);
+};
+
+const Engine& portableEngine()
+{
+    static const Engine portable{"Portable", false, ctrPortable, prepareHashPortable, ghashPortable};
+    return portable;
+}
+
+// Fastest engine the CPU supports
+const Engine& bestEngine()
+{
+    static const Engine& selected = []() -> const Engine& {
+#if defined(EONPLAY_AES_X86)
+        if (cpuHasAesNi()) {
+            static const Engine x86{"AES-NI", true, ctrX86, prepareHashX86, ghashX86};
+            return x86;
+        }
+#elif defined(EONPLAY_AES_ARM)
+        static const Engine arm{"ARMv8 Crypto", true, ctrArm, prepareHashArm, ghashArm};
+        return arm;
+#endif
+        return portableEngine();
+    }();
+    return selected;
+}
+
+std::atomic<bool> hardwareEnabled{true};
+
+// Engine for keys set from now on
+const Engine& engine()
+{
+    return hardwareEnabled.load(std::memory_order_relaxed) ? bestEngine() : portableEngine();
+}
+
+// GHASH of data zero-padded to whole blocks
+void ghashPadded(const Engine& gcm, const uchar* powers, uchar* state, const uchar* data, qsizetype size)
+{
+    const qsizetype whole = size & ~qsizetype(BLOCK_SIZE - 1);
+    gcm.ghash(powers, state, data, whole);
+    if (whole < size) {
+        uchar last[BLOCK_SIZE] = {};
+        std::memcpy(last, data + whole, size - whole);
+        gcm.ghash(powers, state, last, BLOCK_SIZE);
+    }
+}
+
+QByteArray chunkNonce(const QByteArray& prefix, quint32 index)
+{
+    QByteArray nonce = prefix;
+    nonce.resize(AesGcm::NONCE_SIZE);
+    storeBigEndian32(reinterpret_cast<uchar*>(nonce.data()) + NONCE_PREFIX_SIZE, index);
+    return nonce;
+}
+
+// Associated data of a chunk: the file prelude and whether the chunk is the last
+QByteArray chunkAssociatedData(const QByteArray& prelude, bool last)
+{
+    return prelude + char(last ? 1 : 0);
+}
+
+bool readPrelude(QFile& file, QByteArray* prelude, QByteArray* header, QByteArray* noncePrefix)
+{
+    const QByteArray start = file.read(sizeof(FILE_MAGIC) + 2);
+    if (start.size() != int(sizeof(FILE_MAGIC)) + 2 || !start.startsWith(QByteArray(FILE_MAGIC, sizeof(FILE_MAGIC)))) {
+        return false;
+    }
+    const uchar* sizeBytes = reinterpret_cast<const uchar*>(start.constData()) + sizeof(FILE_MAGIC);
+    const int headerSize = (sizeBytes[0] << 8) | sizeBytes[1];
+    const QByteArray rest = file.read(headerSize + NONCE_PREFIX_SIZE);
+    if (rest.size() != headerSize + NONCE_PREFIX_SIZE) {
+        return false;
+    }
+    if (prelude) {
+        *prelude = start + rest;
+    }
+    if (header) {
+        *header = rest.left(headerSize);
+    }
+    if (noncePrefix) {
+        *noncePrefix = rest.mid(headerSize);
+    }
+    return true;
+}
+
+} // namespace
+
+AesGcm::AesGcm(const QByteArray& key)
+{
+    setKey(key);
+}
+
+AesGcm::~AesGcm()
+{
+    clear();
+}
+
+bool AesGcm::setKey(const QByteArray& key)
+{
+    clear();
+    if (key.size() != KEY_SIZE) {
+        return false;
+    }
+
+    expandKey(reinterpret_cast<const uchar*>(key.constData()), m_roundKeys);
+
+    // H = E(K, 0); the hash powers are only usable by the engine that made them
+    const Engine& gcm = engine();
+    m_hardware = gcm.hardware;
+    uchar counter[BLOCK_SIZE] = {};
+    const uchar zero[BLOCK_SIZE] = {};
+    uchar hashKey[BLOCK_SIZE];
+    gcm.ctr(m_roundKeys, counter, zero, hashKey, BLOCK_SIZE);
+    gcm.prepareHash(hashKey, m_hashPowers);
+
+    m_valid = true;
+    return true;
+}
+
+void AesGcm::clear()
+{
+    // Not to leave key material behind in freed memory
+    volatile uchar* roundKeys = m_roundKeys;
+    for (size_t i = 0; i < sizeof(m_roundKeys); ++i) {
+        roundKeys[i] = 0;
+    }
+    volatile uchar* hashPowers = m_hashPowers;
+    for (size_t i = 0; i < sizeof(m_hashPowers); ++i) {
+        hashPowers[i] = 0;
+    }
+    m_valid = false;
+}
+
+QByteArray AesGcm::encrypt(const QByteArray& plaintext, const QByteArray& associatedData) const
+{
+    if (!m_valid) {
+        return QByteArray();
+    }
+
+    QByteArray sealed(NONCE_SIZE + plaintext.size() + TAG_SIZE, Qt::Uninitialized);
+    uchar* nonce = reinterpret_cast<uchar*>(sealed.data());
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(nonce), NONCE_SIZE / 4);
+
+    encrypt(nonce, reinterpret_cast<const uchar*>(associatedData.constData()), associatedData.size(),
+            reinterpret_cast<const uchar*>(plaintext.constData()), nonce + NONCE_SIZE, plaintext.size(),
+            nonce + NONCE_SIZE + plaintext.size());
+    return sealed;
+}
+
+bool AesGcm::decrypt(const QByteArray& sealed, QByteArray* plaintext, const QByteArray& associatedData) const
+{
+    if (!m_valid || sealed.size() < NONCE_SIZE + TAG_SIZE) {
+        return false;
+    }
+
+    const uchar* nonce = reinterpret_cast<const uchar*>(sealed.constData());
+    const qsizetype size = sealed.size() - NONCE_SIZE - TAG_SIZE;
+    QByteArray result(size, Qt::Uninitialized);
+    if (!decrypt(nonce, reinterpret_cast<const uchar*>(associatedData.constData()), associatedData.size(),
+                 nonce + NONCE_SIZE, reinterpret_cast<uchar*>(result.data()), size, nonce + NONCE_SIZE + size)) {
+        return false;
+    }
+    if (plaintext) {
+        *plaintext = result;
+    }
+    return true;
+}
+
+void AesGcm::encrypt(const uchar* nonce, const uchar* associatedData, qsizetype associatedSize,
+                     const uchar* in, uchar* out, qsizetype size, uchar* tag) const
+{
+    crypt(nonce, associatedData, associatedSize, in, out, size, tag, true);
+}
+
+bool AesGcm::decrypt(const uchar* nonce, const uchar* associatedData, qsizetype associatedSize,
+                     const uchar* in, uchar* out, qsizetype size, const uchar* tag) const
+{
+    uchar expected[TAG_SIZE];
+    crypt(nonce, associatedData, associatedSize, in, out, size, expected, false);
+
+    // Constant time, not to reveal how much of a forged tag was right
+    uchar difference = 0;
+    for (int i = 0; i < TAG_SIZE; ++i) {
+        difference |= expected[i] ^ tag[i];
+    }
+    return difference == 0;
+}
+
+void AesGcm::crypt(const uchar* nonce, const uchar* associatedData, qsizetype associatedSize,
+                   const uchar* in, uchar* out, qsizetype size, uchar* tag, bool encrypting) const
+{
+    Q_ASSERT(m_valid);
+    const Engine& gcm = m_hardware ? bestEngine() : portableEngine();
+
+    // J0 = nonce || 1 masks the tag; the data uses the counters after it
+    uchar j0[BLOCK_SIZE];
+    std::memcpy(j0, nonce, NONCE_SIZE);
+    storeBigEndian32(j0 + NONCE_SIZE, 1);
+    uchar counter[BLOCK_SIZE];
+    std::memcpy(counter, j0, BLOCK_SIZE);
+    storeBigEndian32(counter + NONCE_SIZE, 2);
+
+    uchar hash[BLOCK_SIZE] = {};
+    ghashPadded(gcm, m_hashPowers, hash, associatedData, associatedSize);
+
+    // Hash the ciphertext while the slice is still in cache; in place decryption needs it hashed first
+    for (qsizetype offset = 0; offset < size; offset += SLICE_SIZE) {
+        const qsizetype length = qMin(SLICE_SIZE, size - offset);
+        if (encrypting) {
+            gcm.ctr(m_roundKeys, counter, in + offset, out + offset, length);
+            ghashPadded(gcm, m_hashPowers, hash, out + offset, length);
+        } else {
+            ghashPadded(gcm, m_hashPowers, hash, in + offset, length);
+            gcm.ctr(m_roundKeys, counter, in + offset, out + offset, length);
+        }
+    }
+
+    uchar lengths[BLOCK_SIZE];
+    storeBigEndian64(lengths, quint64(associatedSize) * 8);
+    storeBigEndian64(lengths + 8, quint64(size) * 8);
+    gcm.ghash(m_hashPowers, hash, lengths, BLOCK_SIZE);
+
+    gcm.ctr(m_roundKeys, j0, hash, tag, TAG_SIZE);
+}
+
+bool AesGcm::encryptFile(const QString& sourcePath, const QString& targetPath, const QByteArray& header,
+                         QString* checksum, QString* error) const
+{
+    auto fail = [error](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    if (!m_valid) {
+        return fail("No encryption key set");
+    }
+    if (header.size() > MAX_HEADER_SIZE) {
+        return fail("Encryption header too large");
+    }
+
+    QFile source(sourcePath);
+    if (!source.open(QIODevice::ReadOnly)) {
+        return fail(QString("Cannot read %1: %2").arg(sourcePath, source.errorString()));
+    }
+    QSaveFile target(targetPath);
+    if (!target.open(QIODevice::WriteOnly)) {
+        return fail(QString("Cannot write %1: %2").arg(targetPath, target.errorString()));
+    }
+
+    QByteArray noncePrefix(NONCE_PREFIX_SIZE, Qt::Uninitialized);
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(noncePrefix.data()), NONCE_PREFIX_SIZE / 4);
+
+    QByteArray prelude(FILE_MAGIC, sizeof(FILE_MAGIC));
+    prelude += char(header.size() >> 8);
+    prelude += char(header.size() & 0xff);
+    prelude += header;
+    prelude += noncePrefix;
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    auto write = [&target, &hash](const char* data, qint64 size) {
+        hash.addData(QByteArrayView(data, size));
+        return target.write(data, size) == size;
+    };
+
+    bool written = write(prelude.constData(), prelude.size());
+    QByteArray chunk(CHUNK_SIZE + TAG_SIZE, Qt::Uninitialized);
+    quint32 index = 0;
+    bool last = false;
+    while (written && !last) {
+        // An empty file still gets its one, last chunk
+        const qint64 length = source.read(chunk.data(), CHUNK_SIZE);
+        if (length < 0) {
+            return fail(QString("Cannot read %1: %2").arg(sourcePath, source.errorString()));
+        }
+        last = source.atEnd();
+
+        const QByteArray nonce = chunkNonce(noncePrefix, index++);
+        const QByteArray associatedData = chunkAssociatedData(prelude, last);
+        uchar* data = reinterpret_cast<uchar*>(chunk.data());
+        encrypt(reinterpret_cast<const uchar*>(nonce.constData()),
+                reinterpret_cast<const uchar*>(associatedData.constData()), associatedData.size(),
+                data, data, length, data + length);
+        written = write(chunk.constData(), length + TAG_SIZE);
+    }
+
+    if (!written || !target.commit()) {
+        return fail(QString("Cannot write %1: %2").arg(targetPath, target.errorString()));
+    }
+    if (checksum) {
+        *checksum = QString::fromLatin1(hash.result().toHex());
+    }
+    return true;
+}
+
+bool AesGcm::decryptFile(const QString& sourcePath, const QString& targetPath, QString* error) const
+{
+    auto fail = [error](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    if (!m_valid) {
+        return fail("No encryption key set");
+    }
+
+    QFile source(sourcePath);
+    if (!source.open(QIODevice::ReadOnly)) {
+        return fail(QString("Cannot read %1: %2").arg(sourcePath, source.errorString()));
+    }
+    QByteArray prelude;
+    QByteArray noncePrefix;
+    if (!readPrelude(source, &prelude, nullptr, &noncePrefix)) {
+        return fail(QString("Not an encrypted file: %1").arg(sourcePath));
+    }
+
+    // Nothing is kept unless every chunk authenticates
+    QSaveFile target(targetPath);
+    if (!target.open(QIODevice::WriteOnly)) {
+        return fail(QString("Cannot write %1: %2").arg(targetPath, target.errorString()));
+    }
+
+    QByteArray chunk(CHUNK_SIZE + TAG_SIZE, Qt::Uninitialized);
+    quint32 index = 0;
+    bool last = false;
+    while (!last) {
+        const qint64 length = source.read(chunk.data(), CHUNK_SIZE + TAG_SIZE);
+        if (length < TAG_SIZE) {
+            target.cancelWriting();
+            return fail(QString("Encrypted file is truncated: %1").arg(sourcePath));
+        }
+        last = source.atEnd();
+
+        const qint64 size = length - TAG_SIZE;
+        const QByteArray nonce = chunkNonce(noncePrefix, index++);
+        const QByteArray associatedData = chunkAssociatedData(prelude, last);
+        uchar* data = reinterpret_cast<uchar*>(chunk.data());
+        if (!decrypt(reinterpret_cast<const uchar*>(nonce.constData()),
+                     reinterpret_cast<const uchar*>(associatedData.constData()), associatedData.size(),
+                     data, data, size, data + size)) {
+            target.cancelWriting();
+            return fail(QString("Wrong key or damaged file: %1").arg(sourcePath));
+        }
+        if (target.write(chunk.constData(), size) != size) {
+            break;
+        }
+    }
+
+    if (!target.commit()) {
+        return fail(QString("Cannot write %1: %2").arg(targetPath, target.errorString()));
+    }
+    return true;
+}
+
+bool AesGcm::isEncryptedFile(const QString& filePath)
+{
+    QFile file(filePath);
+    return file.open(QIODevice::ReadOnly) && file.read(sizeof(FILE_MAGIC)) == QByteArray(FILE_MAGIC, sizeof(FILE_MAGIC));
+}
+
+QByteArray AesGcm::fileHeader(const QString& filePath)
+{
+    QFile file(filePath);
+    QByteArray header;
+    if (!file.open(QIODevice::ReadOnly) || !readPrelude(file, nullptr, &header, nullptr)) {
+        return QByteArray();
+    }
+    return header;
+}
+
+QByteArray AesGcm::deriveKey(const QByteArray& passphrase, const QByteArray& salt, int iterations)
+{
+    return QPasswordDigestor::deriveKeyPbkdf2(QCryptographicHash::Sha256, passphrase, salt, iterations, KEY_SIZE);
+}
+
+QString AesGcm::implementation()
+{
+    return QString::fromLatin1(engine().name);
+}
+
+bool AesGcm::isHardwareAccelerated()
+{
+    return engine().hardware;
+}
+
+void AesGcm::setHardwareAccelerationEnabled(bool enabled)
+{
+    hardwareEnabled.store(enabled, std::memory_order_relaxed);
+}
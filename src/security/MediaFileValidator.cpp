@@ -0,0 +1,150 @@
+#include "security/MediaFileValidator.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMimeDatabase>
+#include <QMutexLocker>
+
+Q_LOGGING_CATEGORY(mediaFileValidator, "eonplay.security.validator")
+
+MediaFileValidator& MediaFileValidator::instance()
+{
+    static MediaFileValidator instance;
+    return instance;
+}
+
+MediaFileValidator::MediaFileValidator()
+    : m_cache(CACHE_ENTRIES)
+{
+}
+
+FileValidationResult MediaFileValidator::validate(const QString& filePath)
+{
+    // The stat is the only I/O when the file is unchanged
+    const QFileInfo fileInfo(filePath);
+    const QString path = fileInfo.absoluteFilePath();
+
+    if (!fileInfo.exists()) {
+        FileValidationResult result;
+        result.path = path;
+        result.suffix = fileInfo.suffix().toLower();
+        return result;
+    }
+
+    const qint64 size = fileInfo.size();
+    const qint64 modified = fileInfo.lastModified().toMSecsSinceEpoch();
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (const FileValidationResult* cached = m_cache.object(path)) {
+            if (cached->size == size && cached->modified == modified) {
+                return *cached;
+            }
+        }
+    }
+
+    FileValidationResult result = inspect(path, size, modified);
+
+    QMutexLocker locker(&m_mutex);
+    m_cache.insert(path, new FileValidationResult(result));
+    return result;
+}
+
+void MediaFileValidator::invalidate(const QString& filePath)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.remove(QFileInfo(filePath).absoluteFilePath());
+}
+
+void MediaFileValidator::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.clear();
+}
+
+FileValidationResult MediaFileValidator::inspect(const QString& path, qint64 size, qint64 modified)
+{
+    FileValidationResult result;
+    result.path = path;
+    result.exists = true;
+    result.size = size;
+    result.modified = modified;
+    result.suffix = QFileInfo(path).suffix().toLower();
+
+    // One read serves every signature check
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        result.readable = true;
+        result.header = file.read(HEADER_BYTES);
+    }
+
+    QMimeDatabase mimeDatabase;
+    result.mimeType = mimeDatabase.mimeTypeForFileNameAndData(path, result.header).name();
+
+    if (!result.header.isEmpty()) {
+        result.hasMediaSignature = hasMediaSignature(result.header);
+        result.matchesExtension = matchesExtension(result.header, result.suffix);
+        result.looksExecutable = looksExecutable(result.header);
+    }
+
+    qCDebug(mediaFileValidator) << "Inspected" << path << result.mimeType
+                                << "signature:" << result.hasMediaSignature
+                                << "matches extension:" << result.matchesExtension;
+
+    return result;
+}
+
+bool MediaFileValidator::hasMediaSignature(const QByteArray& header)
+{
+    if (header.size() < 4) {
+        return false;
+    }
+
+    // WAV and AVI
+    if (header.startsWith("RIFF") && (header.mid(8, 4) == "WAVE" || header.mid(8, 4) == "AVI ")) {
+        return true;
+    }
+
+    // Ogg, FLAC and Matroska/WebM
+    if (header.startsWith("OggS") || header.startsWith("fLaC") || header.startsWith("\x1A\x45\xDF\xA3")) {
+        return true;
+    }
+
+    // MP3 ID3 tag or frame sync
+    if (header.startsWith("ID3") || (header[0] == '\xFF' && (header[1] & 0xE0) == 0xE0)) {
+        return true;
+    }
+
+    // MP4/MOV
+    return header.mid(4, 4) == "ftyp";
+}
+
+bool MediaFileValidator::matchesExtension(const QByteArray& header, const QString& suffix)
+{
+    if (header.isEmpty()) {
+        return false;
+    }
+
+    if (suffix == "mp4" || suffix == "m4v") {
+        return header.mid(4, 4) == "ftyp";
+    } else if (suffix == "avi") {
+        return header.startsWith("RIFF") && header.mid(8, 3) == "AVI";
+    } else if (suffix == "mkv" || suffix == "webm") {
+        return header.startsWith(QByteArray::fromHex("1A45DFA3"));
+    } else if (suffix == "mp3") {
+        return header.startsWith("ID3") || (header.size() > 1 && header[0] == char(0xFF) && (header[1] & 0xE0) == 0xE0);
+    } else if (suffix == "flac") {
+        return header.startsWith("fLaC");
+    } else if (suffix == "ogg") {
+        return header.startsWith("OggS");
+    }
+
+    return !looksExecutable(header);
+}
+
+bool MediaFileValidator::looksExecutable(const QByteArray& header)
+{
+    return header.startsWith("MZ") || header.startsWith("ELF") || header.startsWith("\x7F" "ELF") ||
+           header.startsWith(QByteArray::fromHex("CAFEBABE"));
+}
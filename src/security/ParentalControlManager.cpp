@@ -1,4 +1,5 @@
 #include "security/ParentalControlManager.h"
+#include "data/DatabaseManager.h"
 #include <QSettings>
 #include <QCryptographicHash>
 #include <QStandardPaths>
@@ -9,6 +10,9 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
 
 Q_LOGGING_CATEGORY(parentalControl, "eonplay.security.parental")
 
@@ -19,6 +23,7 @@ ParentalControlManager::ParentalControlManager(QObject *parent)
     , m_supervisionModeEnabled(false)
     , m_usageReportsEnabled(true)
     , m_sessionActive(false)
+    , m_dbManager(nullptr)
     , m_autoLockTimeoutMinutes(DEFAULT_AUTO_LOCK_MINUTES)
     , m_usageTimer(new QTimer(this))
     , m_autoLockTimer(new QTimer(this))
@@ -54,6 +59,7 @@ QString ParentalControlManager::createUserProfile(const QString& name, const QDa
     
     m_userProfiles[profileId] = profile;
     saveUserProfiles();
+    refreshContentVerdicts(profileId);
     
     qCDebug(parentalControl) << "Created user profile:" << name << "(" << profileId << ")";
     return profileId;
@@ -72,6 +78,8 @@ bool ParentalControlManager::deleteUserProfile(const QString& profileId)
     
     m_userProfiles.remove(profileId);
     saveUserProfiles();
+    updateActiveMatcher();
+    refreshContentVerdicts(profileId);
     
     qCDebug(parentalControl) << "Deleted user profile:" << profileId;
     return true;
@@ -84,6 +92,7 @@ bool ParentalControlManager::setActiveProfile(const QString& profileId)
     }
     
     m_activeProfileId = profileId;
+    updateActiveMatcher();
     emit activeProfileChanged(profileId);
     
     qCDebug(parentalControl) << "Set active profile:" << profileId;
@@ -119,9 +128,15 @@ bool ParentalControlManager::updateUserProfile(const UserProfile& profile)
         return false;
     }
     
+    const bool filtersChanged = !(compileMatcher(m_userProfiles.value(profile.profileId)) == compileMatcher(profile));
     m_userProfiles[profile.profileId] = profile;
     saveUserProfiles();
     
+    if (filtersChanged) {
+        updateActiveMatcher();
+        refreshContentVerdicts(profile.profileId);
+    }
+    
     qCDebug(parentalControl) << "Updated user profile:" << profile.profileId;
     return true;
 }
@@ -181,49 +196,42 @@ bool ParentalControlManager::areParentalSettingsLocked() const
 // Content filtering
 bool ParentalControlManager::isContentAllowed(const QString& filePath)
 {
-    if (!m_parentalControlsEnabled) {
+    if (!m_parentalControlsEnabled || m_activeMatcher.unrestricted) {
         return true;
     }
     
-    UserProfile profile = getActiveProfile();
-    if (profile.accessLevel == ACCESS_UNRESTRICTED) {
-        return true;
-    }
-    
-    // Extract content information
-    QFileInfo fileInfo(filePath);
-    QString title = fileInfo.baseName();
-    ContentRating rating = detectContentRating(filePath);
-    
-    // Check rating restrictions
-    if (rating > profile.contentFilters.maxRating) {
-        recordBlockedAttempt(title, "Rating too high");
-        return false;
+    ContentVerdict verdict;
+    auto cached = m_verdicts.constFind(filePath);
+    if (cached != m_verdicts.constEnd()) {
+        verdict = static_cast<ContentVerdict>(*cached);
+    } else {
+        verdict = m_activeMatcher.evaluate(filePath);
+        if (m_verdicts.size() >= MAX_CACHED_VERDICTS) {
+            m_verdicts.clear();
+        }
+        m_verdicts.insert(filePath, verdict);
     }
     
-    // Check for blocked keywords
-    QStringList keywords = extractKeywords(title, "");
-    if (containsBlockedKeywords(keywords, profile.contentFilters.blockedKeywords)) {
-        recordBlockedAttempt(title, "Contains blocked keywords");
-        return false;
+    switch (verdict) {
+        case VERDICT_RATING_TOO_HIGH:
+            recordBlockedAttempt(QFileInfo(filePath).baseName(), "Rating too high");
+            return false;
+        case VERDICT_BLOCKED_KEYWORD:
+            recordBlockedAttempt(QFileInfo(filePath).baseName(), "Contains blocked keywords");
+            return false;
+        default:
+            return true;
     }
-    
-    return true;
 }
 
 bool ParentalControlManager::isContentAllowed(const QString& title, const QString& genre, ContentRating rating) const
 {
-    if (!m_parentalControlsEnabled) {
-        return true;
-    }
-    
-    UserProfile profile = getActiveProfile();
-    if (profile.accessLevel == ACCESS_UNRESTRICTED) {
+    if (!m_parentalControlsEnabled || m_activeMatcher.unrestricted) {
         return true;
     }
     
     // Check rating
-    if (rating > profile.contentFilters.maxRating) {
+    if (rating > m_activeMatcher.maxRating) {
         return false;
     }
     
@@ -233,32 +241,36 @@ bool ParentalControlManager::isContentAllowed(const QString& title, const QStrin
     }
     
     // Check keywords
-    QStringList keywords = extractKeywords(title, "");
-    if (containsBlockedKeywords(keywords, profile.contentFilters.blockedKeywords)) {
-        return false;
-    }
-    
-    return true;
+    return !m_activeMatcher.containsBlockedKeyword(title);
 }
 
 ParentalControlManager::ContentRating ParentalControlManager::detectContentRating(const QString& filePath) const
 {
-    // Simple rating detection based on filename patterns
-    QString fileName = QFileInfo(filePath).baseName().toLower();
+    return ratingFromFileName(QFileInfo(filePath).baseName().toLower());
+}
+
+ParentalControlManager::ContentRating ParentalControlManager::ratingFromFileName(const QString& fileName)
+{
+    // Simple rating detection based on filename patterns, compiled once
+    static const QRegularExpression nc17Pattern("\\b(nc-?17|x-rated|adult)\\b");
+    static const QRegularExpression rPattern("\\b(r-rated|restricted)\\b");
+    static const QRegularExpression pg13Pattern("\\b(pg-?13|pg13)\\b");
+    static const QRegularExpression pgPattern("\\b(pg|parental)\\b");
+    static const QRegularExpression gPattern("\\b(g-rated|general)\\b");
     
-    if (fileName.contains(QRegularExpression("\\b(nc-?17|x-rated|adult)\\b"))) {
+    if (fileName.contains(nc17Pattern)) {
         return RATING_NC17;
     }
-    if (fileName.contains(QRegularExpression("\\b(r-rated|restricted)\\b"))) {
+    if (fileName.contains(rPattern)) {
         return RATING_R;
     }
-    if (fileName.contains(QRegularExpression("\\b(pg-?13|pg13)\\b"))) {
+    if (fileName.contains(pg13Pattern)) {
         return RATING_PG13;
     }
-    if (fileName.contains(QRegularExpression("\\b(pg|parental)\\b"))) {
+    if (fileName.contains(pgPattern)) {
         return RATING_PG;
     }
-    if (fileName.contains(QRegularExpression("\\b(g-rated|general)\\b"))) {
+    if (fileName.contains(gPattern)) {
         return RATING_G;
     }
     
@@ -340,6 +352,278 @@ QStringList ParentalControlManager::getBlockedReasons(const QString& filePath) c
     return reasons;
 }
 
+// Content verdicts
+void ParentalControlManager::setDatabaseManager(EonPlay::Data::DatabaseManager* dbManager)
+{
+    if (m_dbManager) {
+        disconnect(m_dbManager, nullptr, this, nullptr);
+    }
+    m_dbManager = dbManager;
+    if (!m_dbManager) {
+        return;
+    }
+    
+    connect(m_dbManager, &EonPlay::Data::DatabaseManager::mediaFilesUpserted,
+            this, &ParentalControlManager::onMediaFilesChanged);
+    connect(m_dbManager, &EonPlay::Data::DatabaseManager::mediaFileAdded,
+            this, [this](int, const QString& filePath) { onMediaFilesChanged({filePath}); });
+    
+    // Filters edited while no database was attached need every verdict
+    // redone; otherwise only files added meanwhile need one
+    QSettings settings;
+    for (auto it = m_userProfiles.cbegin(); it != m_userProfiles.cend(); ++it) {
+        const ContentMatcher matcher = compileMatcher(it.value());
+        const QByteArray storedDigest = settings.value("parental/verdictDigests/" + it.key()).toByteArray();
+        if (storedDigest != matcher.digest()) {
+            updateContentVerdicts(it.key(), VERDICTS_ALL_FILES);
+        } else if (!matcher.unrestricted) {
+            updateContentVerdicts(it.key(), VERDICTS_MISSING_FILES);
+        }
+    }
+}
+
+void ParentalControlManager::refreshContentVerdicts(const QString& profileId)
+{
+    updateContentVerdicts(profileId, VERDICTS_ALL_FILES);
+}
+
+QString ParentalControlManager::getContentVerdictProfile() const
+{
+    if (!m_parentalControlsEnabled || m_activeMatcher.unrestricted) {
+        return QString();
+    }
+    return m_activeProfileId;
+}
+
+void ParentalControlManager::onMediaFilesChanged(const QStringList& filePaths)
+{
+    if (filePaths.isEmpty() || !m_dbManager || !m_dbManager->executor()->isOpen()) {
+        return;
+    }
+    
+    const QHash<QString, ContentMatcher> matchers = restrictedMatchers();
+    if (matchers.isEmpty()) {
+        return;
+    }
+    
+    m_dbManager->executor()->write([matchers, filePaths](QSqlDatabase& database) {
+        return writeContentVerdicts(database, matchers, VERDICTS_LISTED_FILES, filePaths);
+    });
+}
+
+void ParentalControlManager::updateContentVerdicts(const QString& profileId, VerdictScope scope)
+{
+    if (!m_dbManager || !m_dbManager->executor()->isOpen()) {
+        return;
+    }
+    
+    // A deleted profile compiles to an unrestricted matcher, which drops its verdicts
+    const bool exists = m_userProfiles.contains(profileId);
+    const ContentMatcher matcher = compileMatcher(m_userProfiles.value(profileId));
+    const QByteArray digest = matcher.digest();
+    const QHash<QString, ContentMatcher> matchers = {{profileId, matcher}};
+    
+    m_dbManager->executor()->write([matchers, scope](QSqlDatabase& database) {
+        return writeContentVerdicts(database, matchers, scope);
+    }).then(this, [this, profileId, exists, digest](bool success) {
+        if (!success) {
+            return;
+        }
+        
+        QSettings settings;
+        if (exists) {
+            settings.setValue("parental/verdictDigests/" + profileId, digest);
+        } else {
+            settings.remove("parental/verdictDigests/" + profileId);
+        }
+        emit contentVerdictsUpdated(profileId);
+    });
+}
+
+bool ParentalControlManager::writeContentVerdicts(QSqlDatabase& database, const QHash<QString, ContentMatcher>& matchers,
+                                                  VerdictScope scope, const QStringList& filePaths)
+{
+    QSqlQuery query(database);
+    auto fail = [&database](const QSqlQuery& failed) {
+        qCWarning(parentalControl) << "Failed to write content verdicts:" << failed.lastError().text();
+        database.rollback();
+        return false;
+    };
+    
+    if (!database.transaction()) {
+        qCWarning(parentalControl) << "Failed to write content verdicts:" << database.lastError().text();
+        return false;
+    }
+    
+    // Listed files are looked up once for all profiles
+    QVector<QPair<qint64, QString>> listedFiles;
+    if (scope == VERDICTS_LISTED_FILES) {
+        for (int start = 0; start < filePaths.size(); start += MAX_BOUND_PATHS) {
+            const int count = qMin(MAX_BOUND_PATHS, static_cast<int>(filePaths.size()) - start);
+            QStringList placeholders;
+            for (int i = 0; i < count; ++i) {
+                placeholders << "?";
+            }
+            query.prepare(QString("SELECT id, file_path FROM media_files WHERE file_path IN (%1)")
+                          .arg(placeholders.join(", ")));
+            for (int i = 0; i < count; ++i) {
+                query.addBindValue(filePaths.at(start + i));
+            }
+            if (!query.exec()) {
+                return fail(query);
+            }
+            while (query.next()) {
+                listedFiles.append({query.value(0).toLongLong(), query.value(1).toString()});
+            }
+        }
+    }
+    
+    QSqlQuery insert(database);
+    insert.prepare("INSERT OR REPLACE INTO content_verdicts (profile_id, media_file_id, verdict) VALUES (?, ?, ?)");
+    
+    for (auto it = matchers.cbegin(); it != matchers.cend(); ++it) {
+        const QString& profileId = it.key();
+        const ContentMatcher& matcher = it.value();
+        
+        if (scope == VERDICTS_ALL_FILES) {
+            query.prepare("DELETE FROM content_verdicts WHERE profile_id = ?");
+            query.addBindValue(profileId);
+            if (!query.exec()) {
+                return fail(query);
+            }
+        }
+        
+        // Unrestricted profiles are never filtered and keep no verdicts
+        if (matcher.unrestricted) {
+            continue;
+        }
+        
+        QVector<QPair<qint64, QString>> files;
+        if (scope == VERDICTS_LISTED_FILES) {
+            files = listedFiles;
+        } else {
+            if (scope == VERDICTS_ALL_FILES) {
+                query.prepare("SELECT id, file_path FROM media_files");
+            } else {
+                query.prepare(R"(
+                    SELECT id, file_path FROM media_files
+                    WHERE NOT EXISTS (SELECT 1 FROM content_verdicts
+                                      WHERE profile_id = ? AND media_file_id = media_files.id)
+                )");
+                query.addBindValue(profileId);
+            }
+            if (!query.exec()) {
+                return fail(query);
+            }
+            while (query.next()) {
+                files.append({query.value(0).toLongLong(), query.value(1).toString()});
+            }
+        }
+        
+        for (const auto& file : files) {
+            insert.addBindValue(profileId);
+            insert.addBindValue(file.first);
+            insert.addBindValue(static_cast<int>(matcher.evaluate(file.second)));
+            if (!insert.exec()) {
+                return fail(insert);
+            }
+        }
+        
+        qCDebug(parentalControl) << "Wrote" << files.size() << "content verdicts for profile" << profileId;
+    }
+    
+    if (!database.commit()) {
+        qCWarning(parentalControl) << "Failed to write content verdicts:" << database.lastError().text();
+        database.rollback();
+        return false;
+    }
+    return true;
+}
+
+void ParentalControlManager::updateActiveMatcher()
+{
+    // Cached verdicts stay valid as long as the filter they came from is the same
+    ContentMatcher matcher = compileMatcher(m_userProfiles.value(m_activeProfileId));
+    if (!(matcher == m_activeMatcher)) {
+        m_activeMatcher = std::move(matcher);
+        m_verdicts.clear();
+    }
+}
+
+QHash<QString, ParentalControlManager::ContentMatcher> ParentalControlManager::restrictedMatchers() const
+{
+    QHash<QString, ContentMatcher> matchers;
+    for (auto it = m_userProfiles.cbegin(); it != m_userProfiles.cend(); ++it) {
+        ContentMatcher matcher = compileMatcher(it.value());
+        if (!matcher.unrestricted) {
+            matchers.insert(it.key(), std::move(matcher));
+        }
+    }
+    return matchers;
+}
+
+ParentalControlManager::ContentMatcher ParentalControlManager::compileMatcher(const UserProfile& profile)
+{
+    ContentMatcher matcher;
+    matcher.unrestricted = profile.accessLevel == ACCESS_UNRESTRICTED;
+    matcher.maxRating = profile.contentFilters.maxRating;
+    for (const QString& keyword : profile.contentFilters.blockedKeywords) {
+        matcher.blockedKeywords.insert(keyword.toLower());
+    }
+    return matcher;
+}
+
+ParentalControlManager::ContentVerdict ParentalControlManager::ContentMatcher::evaluate(const QString& filePath) const
+{
+    if (unrestricted) {
+        return VERDICT_ALLOWED;
+    }
+    
+    const QString title = QFileInfo(filePath).baseName();
+    if (ratingFromFileName(title.toLower()) > maxRating) {
+        return VERDICT_RATING_TOO_HIGH;
+    }
+    if (containsBlockedKeyword(title)) {
+        return VERDICT_BLOCKED_KEYWORD;
+    }
+    return VERDICT_ALLOWED;
+}
+
+bool ParentalControlManager::ContentMatcher::containsBlockedKeyword(const QString& title) const
+{
+    if (blockedKeywords.isEmpty()) {
+        return false;
+    }
+    
+    static const QRegularExpression separators("\\W+");
+    const QStringList words = title.toLower().split(separators, Qt::SkipEmptyParts);
+    for (const QString& word : words) {
+        if (blockedKeywords.contains(word)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QByteArray ParentalControlManager::ContentMatcher::digest() const
+{
+    QStringList keywords(blockedKeywords.cbegin(), blockedKeywords.cend());
+    keywords.sort();
+    const QString description = QString("%1|%2|%3|%4")
+        .arg(VERDICT_RULES_VERSION)
+        .arg(int(unrestricted))
+        .arg(static_cast<int>(maxRating))
+        .arg(keywords.join('\n'));
+    return QCryptographicHash::hash(description.toUtf8(), QCryptographicHash::Sha256).toHex();
+}
+
+bool ParentalControlManager::ContentMatcher::operator==(const ContentMatcher& other) const
+{
+    return unrestricted == other.unrestricted &&
+           maxRating == other.maxRating &&
+           blockedKeywords == other.blockedKeywords;
+}
+
 // Time restrictions
 bool ParentalControlManager::isAccessAllowed() const
 {
@@ -546,6 +830,8 @@ void ParentalControlManager::loadUserProfiles()
     }
     
     settings.endGroup();
+    
+    updateActiveMatcher();
 }
 
 ParentalControlManager::UserProfile ParentalControlManager::createDefaultProfile(const QString& name, const QDateTime& birthDate)
@@ -587,14 +873,15 @@ bool ParentalControlManager::verifyPinHash(const QString& pin, const QString& ha
 
 QStringList ParentalControlManager::extractKeywords(const QString& title, const QString& description) const
 {
+    static const QRegularExpression separators("\\W+");
     QStringList keywords;
     
     // Extract words from title
-    QStringList titleWords = title.split(QRegularExpression("\\W+"), Qt::SkipEmptyParts);
+    QStringList titleWords = title.split(separators, Qt::SkipEmptyParts);
     keywords.append(titleWords);
     
     // Extract words from description
-    QStringList descWords = description.split(QRegularExpression("\\W+"), Qt::SkipEmptyParts);
+    QStringList descWords = description.split(separators, Qt::SkipEmptyParts);
     keywords.append(descWords);
     
     // Remove duplicates and convert to lowercase
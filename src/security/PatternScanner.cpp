@@ -0,0 +1,169 @@
+#include "security/PatternScanner.h"
+#include <QQueue>
+#include <algorithm>
+
+namespace {
+
+uchar foldCase(uchar symbol)
+{
+    return (symbol >= 'A' && symbol <= 'Z') ? uchar(symbol + ('a' - 'A')) : symbol;
+}
+
+} // namespace
+
+PatternScanner::PatternScanner(const QList<QByteArray>& patterns, Qt::CaseSensitivity caseSensitivity)
+{
+    const bool fold = caseSensitivity == Qt::CaseInsensitive;
+
+    for (const QByteArray& pattern : patterns) {
+        if (!pattern.isEmpty()) {
+            m_patterns << pattern;
+        }
+    }
+
+    // Trie over the (folded) patterns, -1 marks a missing edge
+    m_transitions.fill(-1, ALPHABET);
+    m_match.append(-1);
+    m_fail.append(0);
+
+    for (int index = 0; index < m_patterns.size(); ++index) {
+        int state = 0;
+        for (char ch : std::as_const(m_patterns[index])) {
+            const uchar symbol = fold ? foldCase(uchar(ch)) : uchar(ch);
+            int target = m_transitions[state * ALPHABET + symbol];
+            if (target < 0) {
+                target = m_match.size();
+                m_transitions[state * ALPHABET + symbol] = target;
+                m_transitions.insert(m_transitions.size(), ALPHABET, -1);
+                m_match.append(-1);
+                m_fail.append(0);
+            }
+            state = target;
+        }
+        if (m_match[state] < 0) {
+            m_match[state] = index;
+        }
+    }
+
+    // Breadth-first pass turns the trie into a DFA via failure links
+    QQueue<int> queue;
+    for (int symbol = 0; symbol < ALPHABET; ++symbol) {
+        int& target = m_transitions[symbol];
+        if (target < 0) {
+            target = 0;
+        } else {
+            queue.enqueue(target);
+        }
+    }
+
+    while (!queue.isEmpty()) {
+        const int state = queue.dequeue();
+        const int fail = m_fail[state];
+
+        // A pattern ending at the suffix state also ends here
+        if (m_match[state] < 0) {
+            m_match[state] = m_match[fail];
+        }
+
+        for (int symbol = 0; symbol < ALPHABET; ++symbol) {
+            int& target = m_transitions[state * ALPHABET + symbol];
+            if (target < 0) {
+                target = m_transitions[fail * ALPHABET + symbol];
+            } else {
+                m_fail[target] = m_transitions[fail * ALPHABET + symbol];
+                queue.enqueue(target);
+            }
+        }
+    }
+
+    // Upper-case input follows the lower-case edges
+    if (fold) {
+        for (int state = 0; state < m_match.size(); ++state) {
+            for (int symbol = 'A'; symbol <= 'Z'; ++symbol) {
+                m_transitions[state * ALPHABET + symbol] = m_transitions[state * ALPHABET + foldCase(uchar(symbol))];
+            }
+        }
+    }
+}
+
+PatternScanner PatternScanner::fromStrings(const QStringList& patterns, Qt::CaseSensitivity caseSensitivity)
+{
+    QList<QByteArray> bytes;
+    bytes.reserve(patterns.size());
+    for (const QString& pattern : patterns) {
+        bytes << pattern.toLatin1();
+    }
+    return PatternScanner(bytes, caseSensitivity);
+}
+
+int PatternScanner::scan(QByteArrayView data, int& state) const
+{
+    if (m_patterns.isEmpty()) {
+        return -1;
+    }
+
+    for (char ch : data) {
+        state = next(state, uchar(ch));
+        if (m_match[state] >= 0) {
+            return m_match[state];
+        }
+    }
+
+    return -1;
+}
+
+int PatternScanner::scan(QStringView text, int& state) const
+{
+    if (m_patterns.isEmpty()) {
+        return -1;
+    }
+
+    for (QChar ch : text) {
+        const char16_t unit = ch.unicode();
+        state = unit < ALPHABET ? next(state, uchar(unit)) : 0;
+        if (m_match[state] >= 0) {
+            return m_match[state];
+        }
+    }
+
+    return -1;
+}
+
+int PatternScanner::findFirst(QByteArrayView data) const
+{
+    int state = 0;
+    return scan(data, state);
+}
+
+int PatternScanner::findFirst(QStringView text) const
+{
+    int state = 0;
+    return scan(text, state);
+}
+
+QList<int> PatternScanner::findAll(QByteArrayView data) const
+{
+    QList<int> found;
+    if (m_patterns.isEmpty()) {
+        return found;
+    }
+
+    QVector<bool> seen(m_patterns.size(), false);
+    int state = 0;
+    for (char ch : data) {
+        state = next(state, uchar(ch));
+
+        // m_match only keeps the first pattern per state, so walk the
+        // suffix chain for overlapping ones
+        for (int suffix = state; suffix > 0 && m_match[suffix] >= 0; suffix = m_fail[suffix]) {
+            const int index = m_match[suffix];
+            if (!seen[index]) {
+                seen[index] = true;
+                found << index;
+            }
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    return found;
+}
@@ -0,0 +1,578 @@
+#include "security/SandboxedDecoderPool.h"
+#include "security/DecoderSandboxChannel.h"
+#include <QAudioFormat>
+#include <QAudioSink>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QIODevice>
+#include <QLoggingCategory>
+#include <QMediaDevices>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QSharedMemory>
+#include <QUrl>
+#include <QUuid>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/xattr.h>
+#endif
+
+Q_LOGGING_CATEGORY(decoderSandbox, "eonplay.security.decodersandbox")
+
+struct SandboxedDecoder::Channel
+{
+    QSharedMemory memory;
+    DecoderSandboxChannel::Header* header = nullptr;
+};
+
+/**
+ * @brief Pull-mode audio source reading the channel's ring
+ *
+ * Plays silence when the worker falls behind, so an underrun is a gap
+ * rather than a stalled sink.
+ */
+class SandboxAudioDevice : public QIODevice
+{
+public:
+    SandboxAudioDevice(std::shared_ptr<SandboxedDecoder::Channel> channel, QObject* parent)
+        : QIODevice(parent)
+        , m_channel(std::move(channel))
+        , m_skipTo(0)
+    {
+    }
+
+    /**
+     * @brief Drop everything queued before a counter of the worker's ring
+     */
+    void skipTo(quint64 counter) { m_skipTo.store(counter, std::memory_order_relaxed); }
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override { return QIODevice::bytesAvailable() + DecoderSandboxChannel::AUDIO_RING_BYTES; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override
+    {
+        DecoderSandboxChannel::Header* header = m_channel->header;
+        const quint64 written = header->audioWritten.load(std::memory_order_acquire);
+        quint64 read = header->audioRead.load(std::memory_order_relaxed);
+
+        // The worker's counters are not trusted to stay in range
+        const quint64 skipTo = m_skipTo.load(std::memory_order_relaxed);
+        if (skipTo > read && skipTo <= written) {
+            read = skipTo;
+        }
+        if (written - read > DecoderSandboxChannel::AUDIO_RING_BYTES) {
+            read = written;
+        }
+
+        const qint64 size = maxSize / DecoderSandboxChannel::AUDIO_FRAME_BYTES * DecoderSandboxChannel::AUDIO_FRAME_BYTES;
+        const quint64 length = qMin<quint64>(written - read, quint64(size));
+        const uchar* ring = DecoderSandboxChannel::audioRing(m_channel->memory.data());
+        const quint64 position = read % DecoderSandboxChannel::AUDIO_RING_BYTES;
+        const quint64 first = qMin<quint64>(length, DecoderSandboxChannel::AUDIO_RING_BYTES - position);
+        std::memcpy(data, ring + position, first);
+        std::memcpy(data + first, ring, length - first);
+        std::memset(data + length, 0, size_t(size - qint64(length)));
+
+        header->audioRead.store(read + length, std::memory_order_release);
+        return size;
+    }
+
+    qint64 writeData(const char* data, qint64 maxSize) override
+    {
+        Q_UNUSED(data)
+        Q_UNUSED(maxSize)
+        return -1;
+    }
+
+private:
+    std::shared_ptr<SandboxedDecoder::Channel> m_channel;
+    std::atomic<quint64> m_skipTo;
+};
+
+SandboxedDecoder::SandboxedDecoder(QObject* parent)
+    : QObject(parent)
+    , m_process(nullptr)
+    , m_audioSink(nullptr)
+    , m_audioDevice(nullptr)
+    , m_job(nullptr)
+    , m_state(State::Starting)
+    , m_position(0)
+    , m_duration(0)
+    , m_hasVideo(false)
+    , m_volume(100)
+{
+}
+
+SandboxedDecoder::~SandboxedDecoder()
+{
+    if (m_audioSink) {
+        m_audioSink->stop();
+    }
+
+    // Never reused: whatever the file did to the worker goes with it
+    if (m_process) {
+        m_process->disconnect(this);
+        m_process->kill();
+        m_process->waitForFinished(1000);
+    }
+#ifdef Q_OS_WIN
+    if (m_job) {
+        CloseHandle(static_cast<HANDLE>(m_job));
+    }
+#endif
+}
+
+bool SandboxedDecoder::spawn(const QString& executable)
+{
+    m_channel = std::make_shared<Channel>();
+    m_channel->memory.setNativeKey("eonplay-decoder-" + QUuid::createUuid().toString(QUuid::Id128));
+    if (!m_channel->memory.create(DecoderSandboxChannel::totalBytes())) {
+        qCWarning(decoderSandbox) << "Cannot create a decoder channel:" << m_channel->memory.errorString();
+        return false;
+    }
+    m_channel->header = new (m_channel->memory.data()) DecoderSandboxChannel::Header{};
+    m_channel->header->magic = DecoderSandboxChannel::MAGIC;
+    m_channel->header->version = DecoderSandboxChannel::VERSION;
+
+    // Nothing that reaches the desktop session, the display or other processes
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    for (const char* name : {"DISPLAY", "WAYLAND_DISPLAY", "DBUS_SESSION_BUS_ADDRESS", "XDG_RUNTIME_DIR",
+                             "SSH_AUTH_SOCK", "PULSE_SERVER"}) {
+        environment.remove(QString::fromLatin1(name));
+    }
+
+    m_process = new QProcess(this);
+    m_process->setProcessEnvironment(environment);
+    m_process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &SandboxedDecoder::onReadyRead);
+    connect(m_process, &QProcess::finished, this, &SandboxedDecoder::onFinished);
+    connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            fail(QStringLiteral("Cannot start %1").arg(m_process->program()));
+        }
+    });
+
+    m_process->start(executable, {"--channel", m_channel->memory.nativeKey()});
+
+#ifdef Q_OS_WIN
+    // One process, no desktop or clipboard access, gone when the job handle closes
+    HANDLE job = CreateJobObjectW(nullptr, nullptr);
+    HANDLE process = job ? OpenProcess(PROCESS_SET_QUOTA | PROCESS_TERMINATE, FALSE,
+                                       static_cast<DWORD>(m_process->processId())) : nullptr;
+    if (process) {
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+        limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE |
+                                                  JOB_OBJECT_LIMIT_ACTIVE_PROCESS |
+                                                  JOB_OBJECT_LIMIT_DIE_ON_UNHANDLED_EXCEPTION;
+        limits.BasicLimitInformation.ActiveProcessLimit = 1;
+        SetInformationJobObject(job, JobObjectExtendedLimitInformation, &limits, sizeof(limits));
+
+        JOBOBJECT_BASIC_UI_RESTRICTIONS ui = {};
+        ui.UIRestrictionsClass = JOB_OBJECT_UILIMIT_DESKTOP | JOB_OBJECT_UILIMIT_DISPLAYSETTINGS |
+                                 JOB_OBJECT_UILIMIT_EXITWINDOWS | JOB_OBJECT_UILIMIT_GLOBALATOMS |
+                                 JOB_OBJECT_UILIMIT_HANDLES | JOB_OBJECT_UILIMIT_READCLIPBOARD |
+                                 JOB_OBJECT_UILIMIT_WRITECLIPBOARD | JOB_OBJECT_UILIMIT_SYSTEMPARAMETERS;
+        SetInformationJobObject(job, JobObjectBasicUIRestrictions, &ui, sizeof(ui));
+
+        if (!AssignProcessToJobObject(job, process)) {
+            qCWarning(decoderSandbox) << "Cannot restrict the decoder process:" << GetLastError();
+        }
+        CloseHandle(process);
+    }
+    m_job = job;
+#endif
+
+    return true;
+}
+
+bool SandboxedDecoder::open(const QString& path)
+{
+    if (m_state == State::Failed || !m_process) {
+        return false;
+    }
+
+    m_path = path;
+    m_hasVideo = false;
+    m_position = 0;
+    m_duration = 0;
+    send("open " + QUrl::toPercentEncoding(QFileInfo(path).absoluteFilePath()));
+    return true;
+}
+
+void SandboxedDecoder::play()
+{
+    startAudio();
+    if (m_audioSink && m_audioSink->state() == QAudio::SuspendedState) {
+        m_audioSink->resume();
+    }
+    send("play");
+}
+
+void SandboxedDecoder::pause()
+{
+    if (m_audioSink) {
+        m_audioSink->suspend();
+    }
+    send("pause");
+}
+
+void SandboxedDecoder::stop()
+{
+    if (m_audioSink) {
+        m_audioSink->suspend();
+    }
+    send("stop");
+}
+
+void SandboxedDecoder::seek(qint64 position)
+{
+    send("seek " + QByteArray::number(qMax<qint64>(0, position)));
+}
+
+void SandboxedDecoder::setVolume(int volume)
+{
+    m_volume = qBound(0, volume, 100);
+    if (m_audioSink) {
+        m_audioSink->setVolume(m_volume / 100.0);
+    }
+}
+
+void SandboxedDecoder::setFrameCallback(std::function<void(const std::shared_ptr<VideoFrame>&)> callback)
+{
+    m_frameCallback = std::move(callback);
+}
+
+void SandboxedDecoder::startAudio()
+{
+    if (m_audioSink || !m_channel) {
+        return;
+    }
+
+    QAudioFormat format;
+    format.setSampleRate(DecoderSandboxChannel::AUDIO_RATE);
+    format.setChannelCount(DecoderSandboxChannel::AUDIO_CHANNELS);
+    format.setSampleFormat(QAudioFormat::Int16);
+
+    m_audioDevice = new SandboxAudioDevice(m_channel, this);
+    m_audioDevice->open(QIODevice::ReadOnly);
+    m_audioSink = new QAudioSink(QMediaDevices::defaultAudioOutput(), format, this);
+    m_audioSink->setVolume(m_volume / 100.0);
+    m_audioSink->start(m_audioDevice);
+}
+
+void SandboxedDecoder::send(const QByteArray& line)
+{
+    if (m_process && m_process->state() != QProcess::NotRunning) {
+        m_process->write(line + '\n');
+    }
+}
+
+void SandboxedDecoder::onReadyRead()
+{
+    while (m_process && m_process->canReadLine()) {
+        const QByteArray line = m_process->readLine(MAX_LINE_BYTES).trimmed();
+        if (!handleEvent(line)) {
+            fail(QStringLiteral("Decoder sent an invalid message"));
+            return;
+        }
+    }
+
+    // A worker that never ends its line is not a decoder
+    if (m_process && m_process->bytesAvailable() > MAX_LINE_BYTES) {
+        fail(QStringLiteral("Decoder sent an oversized message"));
+    }
+}
+
+bool SandboxedDecoder::handleEvent(const QByteArray& line)
+{
+    const QList<QByteArray> parts = line.split(' ');
+    const QByteArray& event = parts.first();
+    bool ok = true;
+
+    if (event == "frame" && parts.size() == 5) {
+        bool valid[4];
+        const int slot = parts.at(1).toInt(&valid[0]);
+        const int width = parts.at(2).toInt(&valid[1]);
+        const int height = parts.at(3).toInt(&valid[2]);
+        const int bytesPerLine = parts.at(4).toInt(&valid[3]);
+        return valid[0] && valid[1] && valid[2] && valid[3] && deliverFrame(slot, width, height, bytesPerLine);
+    }
+    if (event == "audioflush" && parts.size() == 2) {
+        const quint64 counter = parts.at(1).toULongLong(&ok);
+        if (ok && m_audioDevice) {
+            m_audioDevice->skipTo(counter);
+        }
+        return ok;
+    }
+    if (event == "time" && parts.size() == 2) {
+        m_position = parts.at(1).toLongLong(&ok);
+        emit positionChanged(m_position);
+        return ok;
+    }
+    if (event == "length" && parts.size() == 2) {
+        m_duration = parts.at(1).toLongLong(&ok);
+        emit durationChanged(m_duration);
+        return ok;
+    }
+    if (event == "state" && parts.size() == 2) {
+        static const QHash<QByteArray, State> states = {
+            {"playing", State::Playing}, {"paused", State::Paused},
+            {"stopped", State::Stopped}, {"ended", State::Ended}
+        };
+        const auto state = states.constFind(parts.at(1));
+        if (state == states.constEnd()) {
+            return false;
+        }
+        setState(*state);
+        return true;
+    }
+    if (event == "ready" && parts.size() == 1 && m_state == State::Starting) {
+        setState(State::Idle);
+        emit ready();
+        return true;
+    }
+    if (event == "error") {
+        qCWarning(decoderSandbox) << "Decoder error for" << m_path << ":" << line.mid(6);
+        emit failed(QString::fromUtf8(line.mid(6)));
+        return true;
+    }
+    return false;
+}
+
+bool SandboxedDecoder::deliverFrame(int slot, int width, int height, int bytesPerLine)
+{
+    if (slot < 0 || slot >= DecoderSandboxChannel::VIDEO_SLOTS || width <= 0 || height <= 0 ||
+        width > DecoderSandboxChannel::MAX_WIDTH || height > DecoderSandboxChannel::MAX_HEIGHT ||
+        bytesPerLine < width * 4 || qint64(bytesPerLine) * height > DecoderSandboxChannel::SLOT_BYTES) {
+        return false;
+    }
+
+    DecoderSandboxChannel::VideoSlot& videoSlot = m_channel->header->slots[slot];
+    quint32 expected = DecoderSandboxChannel::SlotReady;
+    if (!videoSlot.state.compare_exchange_strong(expected, DecoderSandboxChannel::SlotHeld,
+                                                 std::memory_order_acquire)) {
+        return false;
+    }
+
+    // The slot goes back to the worker when the last consumer lets go of the picture
+    std::shared_ptr<Channel> channel = m_channel;
+    std::shared_ptr<VideoFrame> frame = VideoFrame::wrap(
+        DecoderSandboxChannel::slotData(channel->memory.data(), slot), width, height, bytesPerLine,
+        [channel, slot]() {
+            channel->header->slots[slot].state.store(DecoderSandboxChannel::SlotFree, std::memory_order_release);
+        });
+    frame->setPosition(videoSlot.position);
+
+    m_hasVideo = true;
+    if (m_frameCallback) {
+        m_frameCallback(frame);
+    }
+    return true;
+}
+
+void SandboxedDecoder::setState(State state)
+{
+    if (m_state == state) {
+        return;
+    }
+    m_state = state;
+    emit stateChanged(state);
+}
+
+void SandboxedDecoder::fail(const QString& message)
+{
+    if (m_state == State::Failed) {
+        return;
+    }
+
+    qCWarning(decoderSandbox) << "Decoder for" << (m_path.isEmpty() ? QStringLiteral("(idle)") : m_path)
+                              << "failed:" << message;
+    if (m_process) {
+        m_process->disconnect(this);
+        m_process->kill();
+    }
+    setState(State::Failed);
+    emit failed(message);
+}
+
+void SandboxedDecoder::onFinished()
+{
+    fail(QStringLiteral("Decoder process exited with code %1").arg(m_process->exitCode()));
+}
+
+SandboxedDecoderPool::SandboxedDecoderPool(QObject* parent)
+    : QObject(parent)
+    , m_executable(QDir(QCoreApplication::applicationDirPath()).filePath(
+#ifdef Q_OS_WIN
+          "eonplay-decoder.exe"
+#else
+          "eonplay-decoder"
+#endif
+          ))
+    , m_poolSize(DEFAULT_POOL_SIZE)
+    , m_spawnFailures(0)
+    , m_running(false)
+{
+}
+
+SandboxedDecoderPool::~SandboxedDecoderPool()
+{
+    stop();
+}
+
+void SandboxedDecoderPool::start()
+{
+    m_running = true;
+    m_spawnFailures = 0;
+    refill();
+}
+
+void SandboxedDecoderPool::stop()
+{
+    m_running = false;
+    qDeleteAll(m_idle);
+    m_idle.clear();
+}
+
+void SandboxedDecoderPool::setPoolSize(int size)
+{
+    m_poolSize = qMax(0, size);
+    while (m_idle.size() > m_poolSize) {
+        delete m_idle.takeLast();
+    }
+    refill();
+}
+
+void SandboxedDecoderPool::setWorkerExecutable(const QString& path)
+{
+    m_executable = path;
+}
+
+std::unique_ptr<SandboxedDecoder> SandboxedDecoderPool::acquire()
+{
+    // Prefer a worker that already loaded libVLC
+    SandboxedDecoder* decoder = nullptr;
+    for (SandboxedDecoder* candidate : m_idle) {
+        if (candidate->state() == SandboxedDecoder::State::Idle) {
+            decoder = candidate;
+            break;
+        }
+    }
+    if (!decoder && !m_idle.isEmpty()) {
+        decoder = m_idle.first();
+    }
+    if (decoder) {
+        m_idle.removeOne(decoder);
+    } else {
+        qCDebug(decoderSandbox) << "No pre-spawned decoder, starting one for this open";
+        decoder = spawnWorker();
+    }
+    if (!decoder) {
+        return nullptr;
+    }
+
+    decoder->disconnect(this);
+    decoder->setParent(nullptr);
+    refill();
+    return std::unique_ptr<SandboxedDecoder>(decoder);
+}
+
+int SandboxedDecoderPool::readyWorkers() const
+{
+    return static_cast<int>(std::count_if(m_idle.cbegin(), m_idle.cend(), [](const SandboxedDecoder* decoder) {
+        return decoder->state() == SandboxedDecoder::State::Idle;
+    }));
+}
+
+void SandboxedDecoderPool::refill()
+{
+    while (m_running && m_idle.size() < m_poolSize && m_spawnFailures < MAX_SPAWN_FAILURES) {
+        SandboxedDecoder* decoder = spawnWorker();
+        if (!decoder) {
+            ++m_spawnFailures;
+            continue;
+        }
+        m_idle.append(decoder);
+    }
+}
+
+SandboxedDecoder* SandboxedDecoderPool::spawnWorker()
+{
+    auto* decoder = new SandboxedDecoder(this);
+    if (!decoder->spawn(m_executable)) {
+        delete decoder;
+        return nullptr;
+    }
+
+    connect(decoder, &SandboxedDecoder::ready, this, [this]() { m_spawnFailures = 0; });
+    connect(decoder, &SandboxedDecoder::failed, this, [this, decoder]() { onWorkerFinished(decoder); });
+    return decoder;
+}
+
+void SandboxedDecoderPool::onWorkerFinished(SandboxedDecoder* decoder)
+{
+    if (!m_idle.removeOne(decoder)) {
+        return;
+    }
+
+    // A worker that dies while loading would die again; stop after a few in a row
+    if (++m_spawnFailures >= MAX_SPAWN_FAILURES) {
+        qCWarning(decoderSandbox) << "Decoder workers keep failing to start, sandboxed decoding is unavailable";
+    }
+    decoder->deleteLater();
+    refill();
+}
+
+bool SandboxedDecoderPool::shouldSandbox(const QString& path) const
+{
+    if (!m_running || QUrl(path).scheme().length() > 1) {
+        // URLs are streamed by the player's own network stack
+        return false;
+    }
+
+    const QString filePath = QFileInfo(path).absoluteFilePath();
+    for (const QString& directory : m_untrustedDirectories) {
+        if (filePath.startsWith(directory + '/') || filePath == directory) {
+            return true;
+        }
+    }
+    return isUntrustedDownload(filePath);
+}
+
+void SandboxedDecoderPool::addUntrustedDirectory(const QString& directory)
+{
+    const QString path = QDir::cleanPath(QFileInfo(directory).absoluteFilePath());
+    if (!m_untrustedDirectories.contains(path)) {
+        m_untrustedDirectories.append(path);
+    }
+}
+
+bool SandboxedDecoderPool::isUntrustedDownload(const QString& path)
+{
+#ifdef Q_OS_WIN
+    // Zones 3 (Internet) and 4 (Restricted sites)
+    QFile zone(path + ":Zone.Identifier");
+    if (!zone.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+    const QByteArray content = zone.read(4096);
+    return content.contains("ZoneId=3") || content.contains("ZoneId=4");
+#elif defined(Q_OS_MACOS)
+    return getxattr(QFile::encodeName(path).constData(), "com.apple.quarantine", nullptr, 0, 0, 0) >= 0;
+#elif defined(Q_OS_UNIX)
+    return getxattr(QFile::encodeName(path).constData(), "user.xdg.origin.url", nullptr, 0) >= 0;
+#else
+    Q_UNUSED(path)
+    return false;
+#endif
+}
@@ -0,0 +1,327 @@
+#include "security/SandboxedDecoderWorker.h"
+#include <QCoreApplication>
+#include <QLoggingCategory>
+#include <QUrl>
+#include <vlc/vlc.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#include <sys/prctl.h>
+#endif
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+Q_LOGGING_CATEGORY(decoderWorker, "eonplay.security.decoderworker")
+
+int SandboxedDecoderWorker::run(int& argc, char** argv)
+{
+    // Namespaces can only be entered while the process has a single thread
+    dropPrivileges();
+
+    QCoreApplication app(argc, argv);
+    const QStringList arguments = app.arguments();
+    const int keyIndex = arguments.indexOf("--channel");
+    if (keyIndex < 0 || keyIndex + 1 >= arguments.size()) {
+        qCCritical(decoderWorker) << "Usage: eonplay-decoder --channel <key>";
+        return 2;
+    }
+
+    SandboxedDecoderWorker worker;
+    if (!worker.start(arguments.at(keyIndex + 1))) {
+        return 1;
+    }
+
+    // A blocking read per line; the player closing the pipe ends the worker
+    std::thread([&worker]() {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            const QByteArray command = QByteArray::fromStdString(line).trimmed();
+            QMetaObject::invokeMethod(&worker, [&worker, command]() { worker.handleCommand(command); },
+                                      Qt::QueuedConnection);
+        }
+        QMetaObject::invokeMethod(qApp, &QCoreApplication::quit, Qt::QueuedConnection);
+    }).detach();
+
+    return app.exec();
+}
+
+void SandboxedDecoderWorker::dropPrivileges()
+{
+#ifdef Q_OS_LINUX
+    // Local files only: a private network namespace has no interfaces but loopback
+    if (unshare(CLONE_NEWUSER | CLONE_NEWNET) != 0) {
+        qCWarning(decoderWorker) << "Cannot leave the network namespace:" << std::strerror(errno);
+    }
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0) {
+        qCWarning(decoderWorker) << "Cannot set no_new_privs:" << std::strerror(errno);
+    }
+    prctl(PR_SET_DUMPABLE, 0, 0, 0, 0);
+#endif
+
+#ifdef Q_OS_UNIX
+    if (geteuid() == 0) {
+        qCWarning(decoderWorker) << "Running as root; the decoder keeps root's file access";
+    }
+
+    // A decoder reads; with no file growth allowed, writes fail instead of raising SIGXFSZ
+    std::signal(SIGXFSZ, SIG_IGN);
+    const struct {
+        int resource;
+        rlim_t limit;
+    } limits[] = {
+        {RLIMIT_CORE, 0},
+        {RLIMIT_FSIZE, 0},
+        {RLIMIT_NOFILE, 256},
+    };
+    for (const auto& entry : limits) {
+        struct rlimit limit = {entry.limit, entry.limit};
+        if (setrlimit(entry.resource, &limit) != 0) {
+            qCWarning(decoderWorker) << "Cannot set resource limit" << entry.resource << ":" << std::strerror(errno);
+        }
+    }
+#endif
+}
+
+SandboxedDecoderWorker::~SandboxedDecoderWorker()
+{
+    if (m_player) {
+        libvlc_media_player_stop(m_player);
+        libvlc_media_player_release(m_player);
+    }
+    if (m_vlc) {
+        libvlc_release(m_vlc);
+    }
+}
+
+bool SandboxedDecoderWorker::start(const QString& channelKey)
+{
+    m_memory.setNativeKey(channelKey);
+    if (!m_memory.attach(QSharedMemory::ReadWrite) || m_memory.size() < DecoderSandboxChannel::totalBytes()) {
+        qCCritical(decoderWorker) << "Cannot attach the channel:" << m_memory.errorString();
+        return false;
+    }
+    m_header = DecoderSandboxChannel::header(m_memory.data());
+    if (m_header->magic != DecoderSandboxChannel::MAGIC || m_header->version != DecoderSandboxChannel::VERSION) {
+        qCCritical(decoderWorker) << "Channel was created by another version of the player";
+        return false;
+    }
+
+    const char* const arguments[] = {
+        "--no-video-title-show",
+        "--no-snapshot-preview",
+        "--no-metadata-network-access",
+        "--no-lua",
+        "--no-stats",
+        "--no-interact",
+        "--intf=dummy",
+        "--extraintf=",
+        "--no-sub-autodetect-file",
+    };
+    m_vlc = libvlc_new(static_cast<int>(std::size(arguments)), arguments);
+    m_player = m_vlc ? libvlc_media_player_new(m_vlc) : nullptr;
+    if (!m_player) {
+        qCCritical(decoderWorker) << "Cannot create a libVLC player";
+        return false;
+    }
+
+    libvlc_video_set_callbacks(m_player, videoLockCallback, nullptr, videoDisplayCallback, this);
+    libvlc_video_set_format_callbacks(m_player, videoFormatCallback, nullptr);
+    libvlc_audio_set_callbacks(m_player, audioPlayCallback, nullptr, nullptr, audioFlushCallback, nullptr, this);
+    libvlc_audio_set_format(m_player, "S16N", DecoderSandboxChannel::AUDIO_RATE, DecoderSandboxChannel::AUDIO_CHANNELS);
+
+    libvlc_event_manager_t* events = libvlc_media_player_event_manager(m_player);
+    for (const libvlc_event_type_t type : {libvlc_MediaPlayerPlaying, libvlc_MediaPlayerPaused,
+                                           libvlc_MediaPlayerStopped, libvlc_MediaPlayerEndReached,
+                                           libvlc_MediaPlayerEncounteredError, libvlc_MediaPlayerTimeChanged,
+                                           libvlc_MediaPlayerLengthChanged}) {
+        libvlc_event_attach(events, type, eventCallback, this);
+    }
+
+    send("ready");
+    return true;
+}
+
+void SandboxedDecoderWorker::handleCommand(const QByteArray& line)
+{
+    const int space = line.indexOf(' ');
+    const QByteArray command = space < 0 ? line : line.left(space);
+    const QByteArray argument = space < 0 ? QByteArray() : line.mid(space + 1);
+
+    if (command == "open") {
+        const QString path = QUrl::fromPercentEncoding(argument);
+        libvlc_media_t* media = libvlc_media_new_path(m_vlc, path.toUtf8().constData());
+        if (!media) {
+            send("error cannot open");
+            return;
+        }
+        libvlc_media_player_set_media(m_player, media);
+        libvlc_media_release(media);
+    } else if (command == "play") {
+        libvlc_media_player_play(m_player);
+    } else if (command == "pause") {
+        libvlc_media_player_set_pause(m_player, 1);
+    } else if (command == "stop") {
+        libvlc_media_player_stop(m_player);
+    } else if (command == "seek") {
+        libvlc_media_player_set_time(m_player, argument.toLongLong());
+    } else if (command == "quit") {
+        QCoreApplication::quit();
+    }
+}
+
+void SandboxedDecoderWorker::send(const QByteArray& line)
+{
+    std::lock_guard<std::mutex> locker(m_outputMutex);
+    std::fwrite(line.constData(), 1, static_cast<size_t>(line.size()), stdout);
+    std::fputc('\n', stdout);
+    std::fflush(stdout);
+}
+
+unsigned SandboxedDecoderWorker::videoFormatCallback(void** opaque, char* chroma, unsigned* width, unsigned* height,
+                                                     unsigned* pitches, unsigned* lines)
+{
+    auto* worker = static_cast<SandboxedDecoderWorker*>(*opaque);
+    if (*width == 0 || *height == 0) {
+        return 0;
+    }
+
+    // Slots are sized for UHD; libVLC scales anything larger on the way in
+    const double scale = std::min({1.0, double(DecoderSandboxChannel::MAX_WIDTH) / *width,
+                                   double(DecoderSandboxChannel::MAX_HEIGHT) / *height});
+    if (scale < 1.0) {
+        *width = std::max(2u, static_cast<unsigned>(*width * scale) & ~1u);
+        *height = std::max(2u, static_cast<unsigned>(*height * scale) & ~1u);
+    }
+
+    std::memcpy(chroma, "RV32", 4);
+    worker->m_width = static_cast<int>(*width);
+    worker->m_height = static_cast<int>(*height);
+    worker->m_bytesPerLine = (worker->m_width * 4 + 31) & ~31;
+    worker->m_dropBuffer.resize(worker->m_bytesPerLine * worker->m_height);
+    pitches[0] = static_cast<unsigned>(worker->m_bytesPerLine);
+    lines[0] = *height;
+    return 1;
+}
+
+void* SandboxedDecoderWorker::videoLockCallback(void* opaque, void** planes)
+{
+    auto* worker = static_cast<SandboxedDecoderWorker*>(opaque);
+    DecoderSandboxChannel::VideoSlot* slots = worker->m_header->slots;
+
+    // A picture libVLC dropped without displaying still holds its slot
+    if (worker->m_writingSlot >= 0) {
+        quint32 writing = DecoderSandboxChannel::SlotWriting;
+        slots[worker->m_writingSlot].state.compare_exchange_strong(writing, DecoderSandboxChannel::SlotFree,
+                                                                   std::memory_order_relaxed);
+        worker->m_writingSlot = -1;
+    }
+
+    for (int slot = 0; slot < DecoderSandboxChannel::VIDEO_SLOTS; ++slot) {
+        quint32 expected = DecoderSandboxChannel::SlotFree;
+        if (slots[slot].state.compare_exchange_strong(expected, DecoderSandboxChannel::SlotWriting,
+                                                      std::memory_order_acquire)) {
+            worker->m_writingSlot = slot;
+            planes[0] = DecoderSandboxChannel::slotData(worker->m_memory.data(), slot);
+            return reinterpret_cast<void*>(quintptr(slot + 1));
+        }
+    }
+
+    // The player still holds every slot: decode into scratch memory and drop the picture
+    planes[0] = worker->m_dropBuffer.data();
+    return nullptr;
+}
+
+void SandboxedDecoderWorker::videoDisplayCallback(void* opaque, void* picture)
+{
+    auto* worker = static_cast<SandboxedDecoderWorker*>(opaque);
+    if (!picture) {
+        return;
+    }
+
+    const int slot = static_cast<int>(reinterpret_cast<quintptr>(picture)) - 1;
+    DecoderSandboxChannel::VideoSlot& videoSlot = worker->m_header->slots[slot];
+    videoSlot.position = libvlc_media_player_get_time(worker->m_player);
+    videoSlot.state.store(DecoderSandboxChannel::SlotReady, std::memory_order_release);
+    worker->m_writingSlot = -1;
+
+    worker->send(QByteArray("frame ") + QByteArray::number(slot) + ' ' + QByteArray::number(worker->m_width) + ' ' +
+                 QByteArray::number(worker->m_height) + ' ' + QByteArray::number(worker->m_bytesPerLine));
+}
+
+void SandboxedDecoderWorker::audioPlayCallback(void* opaque, const void* samples, unsigned count, int64_t pts)
+{
+    Q_UNUSED(pts)
+    auto* worker = static_cast<SandboxedDecoderWorker*>(opaque);
+    DecoderSandboxChannel::Header* header = worker->m_header;
+    const quint64 bytes = quint64(count) * DecoderSandboxChannel::AUDIO_FRAME_BYTES;
+
+    // libVLC plays ahead by its own buffering only; wait briefly for the player to make room
+    quint64 written = header->audioWritten.load(std::memory_order_relaxed);
+    quint64 space = 0;
+    for (int tries = 0;; ++tries) {
+        space = DecoderSandboxChannel::AUDIO_RING_BYTES - (written - header->audioRead.load(std::memory_order_acquire));
+        if (space >= bytes || tries >= AUDIO_WAIT_TRIES) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(AUDIO_WAIT_MS));
+    }
+
+    const quint64 length = std::min(bytes, space) / DecoderSandboxChannel::AUDIO_FRAME_BYTES *
+                           DecoderSandboxChannel::AUDIO_FRAME_BYTES;
+    uchar* ring = DecoderSandboxChannel::audioRing(worker->m_memory.data());
+    const quint64 position = written % DecoderSandboxChannel::AUDIO_RING_BYTES;
+    const quint64 first = std::min(length, DecoderSandboxChannel::AUDIO_RING_BYTES - position);
+    std::memcpy(ring + position, samples, first);
+    std::memcpy(ring, static_cast<const uchar*>(samples) + first, length - first);
+    header->audioWritten.store(written + length, std::memory_order_release);
+}
+
+void SandboxedDecoderWorker::audioFlushCallback(void* opaque, int64_t pts)
+{
+    Q_UNUSED(pts)
+    auto* worker = static_cast<SandboxedDecoderWorker*>(opaque);
+
+    // Only the player moves the read counter, so it skips what was queued before the seek
+    worker->send("audioflush " + QByteArray::number(worker->m_header->audioWritten.load(std::memory_order_acquire)));
+}
+
+void SandboxedDecoderWorker::eventCallback(const libvlc_event_t* event, void* opaque)
+{
+    auto* worker = static_cast<SandboxedDecoderWorker*>(opaque);
+    switch (event->type) {
+        case libvlc_MediaPlayerPlaying:
+            worker->send("state playing");
+            break;
+        case libvlc_MediaPlayerPaused:
+            worker->send("state paused");
+            break;
+        case libvlc_MediaPlayerStopped:
+            worker->send("state stopped");
+            break;
+        case libvlc_MediaPlayerEndReached:
+            worker->send("state ended");
+            break;
+        case libvlc_MediaPlayerEncounteredError:
+            worker->send("error decoding failed");
+            break;
+        case libvlc_MediaPlayerTimeChanged:
+            worker->send("time " + QByteArray::number(qint64(event->u.media_player_time_changed.new_time)));
+            break;
+        case libvlc_MediaPlayerLengthChanged:
+            worker->send("length " + QByteArray::number(qint64(event->u.media_player_length_changed.new_length)));
+            break;
+        default:
+            break;
+    }
+}
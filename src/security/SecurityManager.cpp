@@ -1,4 +1,5 @@
 #include "security/SecurityManager.h"
+#include "security/SandboxedDecoderPool.h"
 #include <QSettings>
 #include <QCryptographicHash>
 #include <QRandomGenerator>
@@ -14,16 +15,41 @@
 #include <QRegularExpression>
 #include <QLoggingCategory>
 #include <QCoreApplication>
+#include <QDirIterator>
+#include <QLibrary>
+#include <QMutexLocker>
+#include <QPromise>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
 
 #ifdef Q_OS_WIN
 #include <windows.h>
 #include <wintrust.h>
 #include <softpub.h>
 #include <wincrypt.h>
+#else
+#include <sys/stat.h>
 #endif
 
 Q_LOGGING_CATEGORY(security, "eonplay.security")
 
+namespace {
+
+// Plugins are hashed in parallel, leaving cores for the rest of startup
+QThreadPool* pluginVerificationPool()
+{
+    static QThreadPool* pool = [] {
+        auto* threadPool = new QThreadPool();
+        threadPool->setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+        return threadPool;
+    }();
+    return pool;
+}
+
+} // namespace
+
 SecurityManager::SecurityManager(QObject *parent)
     : QObject(parent)
     , m_securityLevel(SECURITY_ENHANCED)
@@ -33,14 +59,21 @@ SecurityManager::SecurityManager(QObject *parent)
     , m_fileWatcher(std::make_unique<QFileSystemWatcher>(this))
     , m_securityTimer(new QTimer(this))
 {
-    // Initialize encryption
-    m_encryptionSalt = generateSalt();
-    
     // Setup encrypted settings storage
     QString configPath = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
     QDir().mkpath(configPath);
     m_encryptedSettings = std::make_unique<QSettings>(configPath + "/secure_config.ini", QSettings::IniFormat);
     
+    // Initialize encryption; the salt is kept so that a password derives the same key next time
+    m_encryptionSalt = QByteArray::fromBase64(m_encryptedSettings->value(SALT_SETTING_KEY).toByteArray());
+    if (m_encryptionSalt.length() != SALT_LENGTH) {
+        m_encryptionSalt = generateSalt();
+        m_encryptedSettings->setValue(SALT_SETTING_KEY, m_encryptionSalt.toBase64());
+    }
+    qCDebug(security) << "Encryption implementation:" << AesGcm::implementation();
+    
+    loadTrustedPlugins();
+    
     // Setup security timer
     m_securityTimer->setInterval(SECURITY_MONITORING_INTERVAL_MS);
     connect(m_securityTimer, &QTimer::timeout, this, &SecurityManager::onSecurityTimerTimeout);
@@ -60,6 +93,8 @@ SecurityManager::SecurityManager(QObject *parent)
 
 SecurityManager::~SecurityManager()
 {
+    // Workers report back to this object
+    pluginVerificationPool()->waitForDone();
     stopSecurityMonitoring();
     terminateSandboxedProcesses();
 }
@@ -68,17 +103,30 @@ void SecurityManager::initializeThreatDatabase()
 {
     // Known malicious patterns in media files
     m_maliciousPatterns = {
-        "\\x90\\x90\\x90\\x90", // NOP sled
-        "\\x31\\xc0\\x50\\x68", // Common shellcode
-        "\\x48\\x31\\xff\\x48", // x64 shellcode
+        QByteArray::fromHex("90909090"), // NOP sled
+        QByteArray::fromHex("31c05068"), // Common shellcode
+        QByteArray::fromHex("4831ff48"), // x64 shellcode
         "javascript:", // Script injection
         "vbscript:", // VBScript injection
         "data:text/html", // Data URI injection
         "<script", // HTML script tags
-        "eval\\(", // JavaScript eval
-        "document\\.write", // DOM manipulation
-        "window\\.location" // Redirection attempts
+        "eval(", // JavaScript eval
+        "document.write", // DOM manipulation
+        "window.location" // Redirection attempts
     };
+    m_maliciousScanner = PatternScanner(m_maliciousPatterns);
+    
+    // Script injection markers, matched case-insensitively
+    m_scriptScanner = PatternScanner({
+        "<script", "javascript:", "vbscript:", "onload=", "onerror=",
+        "eval(", "document.", "window.", "alert("
+    }, Qt::CaseInsensitive);
+    
+    // Markup that sanitizeSubtitleContent() removes
+    m_markupScanner = PatternScanner({
+        "<script", "<iframe", "<object", "<embed",
+        "javascript:", "vbscript:", "data:text/html"
+    }, Qt::CaseInsensitive);
     
     // Suspicious file extensions
     m_suspiciousExtensions = {
@@ -105,25 +153,25 @@ void SecurityManager::setSecurityLevel(SecurityLevel level)
         // Adjust security settings based on level
         switch (level) {
             case SECURITY_DISABLED:
-                m_sandboxedDecodingEnabled = false;
+                enableSandboxedDecoding(false);
                 m_maliciousContentProtectionEnabled = false;
                 stopSecurityMonitoring();
                 break;
                 
             case SECURITY_BASIC:
-                m_sandboxedDecodingEnabled = false;
+                enableSandboxedDecoding(false);
                 m_maliciousContentProtectionEnabled = true;
                 stopSecurityMonitoring();
                 break;
                 
             case SECURITY_ENHANCED:
-                m_sandboxedDecodingEnabled = true;
+                enableSandboxedDecoding(true);
                 m_maliciousContentProtectionEnabled = true;
                 startSecurityMonitoring();
                 break;
                 
             case SECURITY_PARANOID:
-                m_sandboxedDecodingEnabled = true;
+                enableSandboxedDecoding(true);
                 m_maliciousContentProtectionEnabled = true;
                 startSecurityMonitoring();
                 // Additional paranoid settings
@@ -143,6 +191,15 @@ SecurityManager::SecurityLevel SecurityManager::getSecurityLevel() const
 void SecurityManager::enableSandboxedDecoding(bool enabled)
 {
     m_sandboxedDecodingEnabled = enabled;
+    
+    // Only a pool someone asked for keeps workers running
+    if (m_decoderPool) {
+        if (enabled) {
+            m_decoderPool->start();
+        } else {
+            m_decoderPool->stop();
+        }
+    }
     qCDebug(security) << "Sandboxed decoding:" << (enabled ? "enabled" : "disabled");
 }
 
@@ -151,6 +208,18 @@ bool SecurityManager::isSandboxedDecodingEnabled() const
     return m_sandboxedDecodingEnabled;
 }
 
+SandboxedDecoderPool* SecurityManager::decoderPool()
+{
+    if (!m_decoderPool) {
+        m_decoderPool = std::make_unique<SandboxedDecoderPool>();
+        m_decoderPool->addUntrustedDirectory(QStandardPaths::writableLocation(QStandardPaths::DownloadLocation));
+        if (m_sandboxedDecodingEnabled) {
+            m_decoderPool->start();
+        }
+    }
+    return m_decoderPool.get();
+}
+
 void SecurityManager::enableMaliciousContentProtection(bool enabled)
 {
     m_maliciousContentProtectionEnabled = enabled;
@@ -163,18 +232,26 @@ bool SecurityManager::isMaliciousContentProtectionEnabled() const
 }
 
 // File validation and sanitization
-SecurityManager::FileValidationResult SecurityManager::validateMediaFile(const QString& filePath)
+SecurityManager::FileSecurityReport SecurityManager::validateMediaFile(const QString& filePath)
 {
-    FileValidationResult result;
+    FileSecurityReport result;
     
-    QFileInfo fileInfo(filePath);
-    if (!fileInfo.exists()) {
+    // Stat, header and MIME type come from the shared, cached inspection
+    const FileValidationResult file = MediaFileValidator::instance().validate(filePath);
+    if (!file.exists) {
         result.threats.append("File does not exist");
         return result;
     }
     
+    // Unchanged since the last full validation
+    auto cached = m_reportCache.constFind(file.path);
+    if (cached != m_reportCache.constEnd() && cached->file.isSameVersion(file)) {
+        emit fileValidationCompleted(filePath, cached->report);
+        return cached->report;
+    }
+    
     // Basic file information
-    result.fileSize = fileInfo.size();
+    result.fileSize = file.size;
     
     // Check file size limits
     if (result.fileSize > MAX_FILE_SIZE_MB * 1024 * 1024) {
@@ -191,32 +268,44 @@ SecurityManager::FileValidationResult SecurityManager::validateMediaFile(const Q
     result.hash = calculateFileHash(filePath);
     
     // Detect MIME type
-    QMimeDatabase mimeDb;
-    QMimeType mimeType = mimeDb.mimeTypeForFile(fileInfo);
-    result.mimeType = mimeType.name();
+    result.mimeType = file.mimeType;
     
     // Validate file headers
-    if (!validateFileHeaders(filePath)) {
+    if (!file.readable || !file.matchesExtension) {
         result.threats.append("Invalid or corrupted file headers");
         return result;
     }
     
+    // One read of the scan window for both content checks
+    QFile contentFile(filePath);
+    if (!contentFile.open(QIODevice::ReadOnly)) {
+        result.threats.append("Cannot read file for threat scanning");
+        return result;
+    }
+    const QByteArray content = contentFile.read(SCAN_WINDOW_BYTES);
+    contentFile.close();
+    
     // Check for malicious content
     if (m_maliciousContentProtectionEnabled) {
-        if (detectThreat(filePath)) {
+        if (detectThreat(filePath, content)) {
             result.threats.append("Malicious content detected");
             return result;
         }
     }
     
     // Scan for specific threats
-    QStringList threats = scanForThreats(filePath);
+    QStringList threats = scanForThreats(content);
     result.threats.append(threats);
     
     // Determine if file is safe
     result.isValid = result.threats.isEmpty();
     result.isSafe = result.isValid && result.warnings.size() < 3;
     
+    if (m_reportCache.size() >= MAX_CACHED_REPORTS) {
+        m_reportCache.clear();
+    }
+    m_reportCache.insert(file.path, {file, result});
+    
     emit fileValidationCompleted(filePath, result);
     
     qCDebug(security) << "File validation completed for:" << filePath 
@@ -271,67 +360,58 @@ QString SecurityManager::sanitizeFilePath(const QString& filePath)
 
 bool SecurityManager::validateFileHeaders(const QString& filePath)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        return false;
-    }
-    
-    // Read first 512 bytes for header validation
-    QByteArray header = file.read(512);
-    file.close();
-    
-    if (header.isEmpty()) {
-        return false;
-    }
-    
-    // Validate based on file extension
-    QFileInfo fileInfo(filePath);
-    QString extension = fileInfo.suffix().toLower();
-    
-    // Common media file signatures
-    if (extension == "mp4" || extension == "m4v") {
-        // MP4 files should start with ftyp box
-        return header.mid(4, 4) == "ftyp";
-    } else if (extension == "avi") {
-        // AVI files start with RIFF...AVI
-        return header.startsWith("RIFF") && header.mid(8, 3) == "AVI";
-    } else if (extension == "mkv" || extension == "webm") {
-        // Matroska/WebM EBML header
-        return header.startsWith(QByteArray::fromHex("1A45DFA3"));
-    } else if (extension == "mp3") {
-        // MP3 ID3 tag or frame sync
-        return header.startsWith("ID3") || (header[0] == char(0xFF) && (header[1] & 0xE0) == 0xE0);
-    } else if (extension == "flac") {
-        // FLAC signature
-        return header.startsWith("fLaC");
-    } else if (extension == "ogg") {
-        // Ogg signature
-        return header.startsWith("OggS");
-    }
-    
-    // For unknown formats, just check it's not executable
-    return !header.startsWith("MZ") && !header.startsWith("ELF") && !header.startsWith(QByteArray::fromHex("CAFEBABE"));
+    // Known extensions need their signature, others must not be executables
+    const FileValidationResult file = MediaFileValidator::instance().validate(filePath);
+    return file.readable && file.matchesExtension;
 }
 
 QByteArray SecurityManager::sanitizeSubtitleContent(const QByteArray& content)
 {
-    QString text = QString::fromUtf8(content);
-    
-    // Remove script tags and dangerous HTML
-    text.remove(QRegularExpression("<script[^>]*>.*?</script>", QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption));
-    text.remove(QRegularExpression("<iframe[^>]*>.*?</iframe>", QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption));
-    text.remove(QRegularExpression("<object[^>]*>.*?</object>", QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption));
-    text.remove(QRegularExpression("<embed[^>]*>", QRegularExpression::CaseInsensitiveOption));
+    static const QRegularExpression scriptBlock("<script[^>]*>.*?</script>", QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression iframeBlock("<iframe[^>]*>.*?</iframe>", QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression objectBlock("<object[^>]*>.*?</object>", QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression embedTag("<embed[^>]*>", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression javascriptUrl("javascript:[^\"'\\s]*", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression vbscriptUrl("vbscript:[^\"'\\s]*", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression htmlDataUrl("data:text/html[^\"'\\s]*", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression eventHandler("on\\w+\\s*=\\s*[\"'][^\"']*[\"']", QRegularExpression::CaseInsensitiveOption);
+    
+    // One pass over the bytes decides which expressions can match at all;
+    // event handlers need an '=', which most subtitle files never contain
+    const QList<int> markers = m_markupScanner.findAll(content);
+    const bool hasAssignment = content.contains('=');
+    if (markers.isEmpty() && !hasAssignment) {
+        return content;
+    }
     
-    // Remove javascript: and vbscript: URLs
-    text.remove(QRegularExpression("javascript:[^\"'\\s]*", QRegularExpression::CaseInsensitiveOption));
-    text.remove(QRegularExpression("vbscript:[^\"'\\s]*", QRegularExpression::CaseInsensitiveOption));
+    QString text = QString::fromUtf8(content);
     
-    // Remove data: URLs that could contain HTML
-    text.remove(QRegularExpression("data:text/html[^\"'\\s]*", QRegularExpression::CaseInsensitiveOption));
+    for (int marker : markers) {
+        const QByteArray pattern = m_markupScanner.pattern(marker);
+        if (pattern == "<script") {
+            // Remove script tags and dangerous HTML
+            text.remove(scriptBlock);
+        } else if (pattern == "<iframe") {
+            text.remove(iframeBlock);
+        } else if (pattern == "<object") {
+            text.remove(objectBlock);
+        } else if (pattern == "<embed") {
+            text.remove(embedTag);
+        } else if (pattern == "javascript:") {
+            // Remove javascript: and vbscript: URLs
+            text.remove(javascriptUrl);
+        } else if (pattern == "vbscript:") {
+            text.remove(vbscriptUrl);
+        } else if (pattern == "data:text/html") {
+            // Remove data: URLs that could contain HTML
+            text.remove(htmlDataUrl);
+        }
+    }
     
     // Remove event handlers
-    text.remove(QRegularExpression("on\\w+\\s*=\\s*[\"'][^\"']*[\"']", QRegularExpression::CaseInsensitiveOption));
+    if (hasAssignment) {
+        text.remove(eventHandler);
+    }
     
     return text.toUtf8();
 }
@@ -344,8 +424,9 @@ bool SecurityManager::storeEncryptedSetting(const QString& key, const QVariant&
         return false;
     }
     
+    // Bound to its key, so that values cannot be swapped between settings
     QByteArray data = value.toByteArray();
-    QByteArray encrypted = encryptData(data, m_encryptionKey);
+    QByteArray encrypted = encryptBlob(data, key.toUtf8());
     
     if (encrypted.isEmpty()) {
         qCWarning(security) << "Failed to encrypt setting:" << key;
@@ -373,9 +454,9 @@ QVariant SecurityManager::retrieveEncryptedSetting(const QString& key, const QVa
     }
     
     QByteArray encrypted = QByteArray::fromBase64(m_encryptedSettings->value(key).toByteArray());
-    QByteArray decrypted = decryptData(encrypted, m_encryptionKey);
+    QByteArray decrypted;
     
-    if (decrypted.isEmpty()) {
+    if (!decryptBlob(encrypted, &decrypted, key.toUtf8())) {
         qCWarning(security) << "Failed to decrypt setting:" << key;
         return defaultValue;
     }
@@ -405,11 +486,49 @@ void SecurityManager::setEncryptionKey(const QByteArray& key)
         m_encryptionKey = deriveKey(QString::fromUtf8(key), m_encryptionSalt);
         qCDebug(security) << "Encryption key derived from input";
     }
+    
+    // Expanded once here rather than per encryption
+    m_cipher.setKey(m_encryptionKey);
 }
 
 bool SecurityManager::hasValidEncryptionKey() const
 {
-    return m_encryptionKey.length() == ENCRYPTION_KEY_LENGTH;
+    return m_cipher.isValid();
+}
+
+QByteArray SecurityManager::encryptBlob(const QByteArray& data, const QByteArray& associatedData)
+{
+    return m_cipher.encrypt(data, associatedData);
+}
+
+bool SecurityManager::decryptBlob(const QByteArray& sealed, QByteArray* data, const QByteArray& associatedData)
+{
+    return m_cipher.decrypt(sealed, data, associatedData);
+}
+
+bool SecurityManager::encryptFile(const QString& sourcePath, const QString& targetPath)
+{
+    QString error;
+    if (!m_cipher.encryptFile(sourcePath, targetPath, QByteArray(), nullptr, &error)) {
+        qCWarning(security) << "File encryption failed:" << error;
+        return false;
+    }
+    return true;
+}
+
+bool SecurityManager::decryptFile(const QString& sourcePath, const QString& targetPath)
+{
+    QString error;
+    if (!m_cipher.decryptFile(sourcePath, targetPath, &error)) {
+        qCWarning(security) << "File decryption failed:" << error;
+        return false;
+    }
+    return true;
+}
+
+QString SecurityManager::getEncryptionImplementation() const
+{
+    return AesGcm::implementation();
 }
 
 // Plugin security
@@ -429,6 +548,26 @@ bool SecurityManager::verifyPluginSignature(const QString& pluginPath)
 }
 
 SecurityManager::PluginSignature SecurityManager::getPluginSignature(const QString& pluginPath)
+{
+    // Unchanged since it was last hashed and checked
+    const PluginFileIdentity identity = pluginFileIdentity(pluginPath);
+    if (identity.isValid()) {
+        QMutexLocker locker(&m_pluginMutex);
+        auto cached = m_verifiedPlugins.constFind(pluginPath);
+        if (cached != m_verifiedPlugins.constEnd() && cached->identity == identity) {
+            return cached->signature;
+        }
+    }
+    
+    const PluginSignature signature = inspectPlugin(pluginPath);
+    if (identity.isValid()) {
+        QMutexLocker locker(&m_pluginMutex);
+        m_verifiedPlugins.insert(pluginPath, {signature, identity});
+    }
+    return signature;
+}
+
+SecurityManager::PluginSignature SecurityManager::inspectPlugin(const QString& pluginPath)
 {
     PluginSignature signature;
     signature.pluginPath = pluginPath;
@@ -438,6 +577,8 @@ SecurityManager::PluginSignature SecurityManager::getPluginSignature(const QStri
         return signature;
     }
     
+    signature.sha256 = calculateFileHash(pluginPath);
+    
 #ifdef Q_OS_WIN
     // Windows code signing verification
     signature.isValid = verifyCodeSignature(pluginPath);
@@ -460,34 +601,226 @@ SecurityManager::PluginSignature SecurityManager::getPluginSignature(const QStri
     return signature;
 }
 
+SecurityManager::PluginFileIdentity SecurityManager::pluginFileIdentity(const QString& pluginPath)
+{
+    PluginFileIdentity identity;
+    
+#ifdef Q_OS_WIN
+    HANDLE handle = CreateFileW(reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(pluginPath).utf16()), 0,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return identity;
+    }
+    BY_HANDLE_FILE_INFORMATION info;
+    const bool ok = GetFileInformationByHandle(handle, &info);
+    CloseHandle(handle);
+    if (!ok || (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return identity;
+    }
+    
+    // FILETIME counts 100 ns intervals since 1601
+    const quint64 ticks = (quint64(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+    identity.size = (qint64(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    identity.modified = qint64(ticks / 10000) - 11644473600000LL;
+    identity.fileId = (quint64(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+#else
+    struct stat info;
+    if (::stat(QFile::encodeName(pluginPath).constData(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return identity;
+    }
+    
+#ifdef Q_OS_DARWIN
+    const timespec& modified = info.st_mtimespec;
+#else
+    const timespec& modified = info.st_mtim;
+#endif
+    identity.size = qint64(info.st_size);
+    identity.modified = qint64(modified.tv_sec) * 1000 + modified.tv_nsec / 1000000;
+    identity.fileId = quint64(info.st_ino);
+#endif
+    
+    return identity;
+}
+
 bool SecurityManager::isPluginTrusted(const QString& pluginPath)
 {
-    return m_trustedPlugins.contains(pluginPath) && 
-           m_trustedPlugins[pluginPath].isTrusted;
+    const PluginFileIdentity identity = pluginFileIdentity(pluginPath);
+    QString trustedHash;
+    {
+        QMutexLocker locker(&m_pluginMutex);
+        auto trusted = m_trustedPlugins.constFind(pluginPath);
+        if (trusted == m_trustedPlugins.constEnd() || !trusted->signature.isTrusted) {
+            return false;
+        }
+        if (trusted->identity == identity) {
+            return true;
+        }
+        trustedHash = trusted->signature.sha256;
+    }
+    
+    // Touched or replaced since it was trusted: still trusted if the contents are the same
+    const PluginSignature current = getPluginSignature(pluginPath);
+    if (!identity.isValid() || trustedHash.isEmpty() || current.sha256 != trustedHash) {
+        qCWarning(security) << "Trusted plugin changed on disk:" << pluginPath;
+        return false;
+    }
+    
+    {
+        QMutexLocker locker(&m_pluginMutex);
+        auto trusted = m_trustedPlugins.find(pluginPath);
+        if (trusted == m_trustedPlugins.end()) {
+            return false;
+        }
+        trusted->identity = identity;
+        m_verifiedPlugins.insert(pluginPath, *trusted);
+    }
+    saveTrustedPlugins();
+    return true;
 }
 
 void SecurityManager::addTrustedPlugin(const QString& pluginPath, const QString& signature)
 {
-    PluginSignature pluginSig = getPluginSignature(pluginPath);
-    pluginSig.signature = signature;
-    pluginSig.isTrusted = true;
-    
-    m_trustedPlugins[pluginPath] = pluginSig;
+    PluginRecord record;
+    record.identity = pluginFileIdentity(pluginPath);
+    record.signature = getPluginSignature(pluginPath);
+    record.signature.signature = signature;
+    record.signature.isTrusted = true;
+    
+    {
+        QMutexLocker locker(&m_pluginMutex);
+        m_trustedPlugins[pluginPath] = record;
+        if (record.identity.isValid()) {
+            m_verifiedPlugins.insert(pluginPath, record);
+        }
+    }
+    saveTrustedPlugins();
     
     qCDebug(security) << "Plugin added to trusted list:" << pluginPath;
 }
 
 void SecurityManager::removeTrustedPlugin(const QString& pluginPath)
 {
-    m_trustedPlugins.remove(pluginPath);
+    {
+        QMutexLocker locker(&m_pluginMutex);
+        m_trustedPlugins.remove(pluginPath);
+        m_verifiedPlugins.remove(pluginPath);
+    }
+    saveTrustedPlugins();
     qCDebug(security) << "Plugin removed from trusted list:" << pluginPath;
 }
 
 QStringList SecurityManager::getTrustedPlugins() const
 {
+    QMutexLocker locker(&m_pluginMutex);
     return m_trustedPlugins.keys();
 }
 
+QFuture<void> SecurityManager::verifyPluginDirectory(const QString& directory)
+{
+    // Only plugins without a current record need hashing
+    QStringList pending;
+    QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString pluginPath = it.next();
+        if (!QLibrary::isLibrary(pluginPath)) {
+            continue;
+        }
+        const PluginFileIdentity identity = pluginFileIdentity(pluginPath);
+        QMutexLocker locker(&m_pluginMutex);
+        auto cached = m_verifiedPlugins.constFind(pluginPath);
+        if (cached == m_verifiedPlugins.constEnd() || !(cached->identity == identity)) {
+            pending.append(pluginPath);
+        }
+    }
+    
+    auto promise = std::make_shared<QPromise<void>>();
+    QFuture<void> future = promise->future();
+    promise->start();
+    if (pending.isEmpty()) {
+        promise->finish();
+        return future;
+    }
+    
+    qCDebug(security) << "Verifying" << pending.size() << "plugins in" << directory;
+    
+    auto remaining = std::make_shared<std::atomic<int>>(int(pending.size()));
+    for (const QString& pluginPath : pending) {
+        pluginVerificationPool()->start([this, promise, remaining, pluginPath]() {
+            const PluginSignature signature = getPluginSignature(pluginPath);
+            QMetaObject::invokeMethod(this, [this, pluginPath, signature]() {
+                if (!signature.isValid) {
+                    qCWarning(security) << "Plugin signature verification failed:" << pluginPath;
+                }
+                emit pluginVerificationCompleted(pluginPath, signature);
+            }, Qt::QueuedConnection);
+            
+            if (remaining->fetch_sub(1) == 1) {
+                promise->finish();
+            }
+        });
+    }
+    return future;
+}
+
+void SecurityManager::loadTrustedPlugins()
+{
+    QMutexLocker locker(&m_pluginMutex);
+    const int count = m_encryptedSettings->beginReadArray(TRUSTED_PLUGINS_GROUP);
+    for (int i = 0; i < count; ++i) {
+        m_encryptedSettings->setArrayIndex(i);
+        
+        PluginRecord record;
+        record.signature.pluginPath = m_encryptedSettings->value("path").toString();
+        record.signature.signature = m_encryptedSettings->value("signature").toString();
+        record.signature.certificate = m_encryptedSettings->value("certificate").toString();
+        record.signature.issuer = m_encryptedSettings->value("issuer").toString();
+        record.signature.sha256 = m_encryptedSettings->value("sha256").toString();
+        record.signature.signedDate = m_encryptedSettings->value("signedDate").toDateTime();
+        record.signature.isValid = m_encryptedSettings->value("valid").toBool();
+        record.signature.isTrusted = true;
+        record.identity.size = m_encryptedSettings->value("size", -1).toLongLong();
+        record.identity.modified = m_encryptedSettings->value("modified").toLongLong();
+        record.identity.fileId = m_encryptedSettings->value("fileId").toULongLong();
+        if (record.signature.pluginPath.isEmpty()) {
+            continue;
+        }
+        
+        m_trustedPlugins.insert(record.signature.pluginPath, record);
+        if (record.identity.isValid()) {
+            m_verifiedPlugins.insert(record.signature.pluginPath, record);
+        }
+    }
+    m_encryptedSettings->endArray();
+}
+
+void SecurityManager::saveTrustedPlugins()
+{
+    QList<PluginRecord> records;
+    {
+        QMutexLocker locker(&m_pluginMutex);
+        records = m_trustedPlugins.values();
+    }
+    
+    m_encryptedSettings->remove(TRUSTED_PLUGINS_GROUP);
+    m_encryptedSettings->beginWriteArray(TRUSTED_PLUGINS_GROUP, records.size());
+    for (int i = 0; i < records.size(); ++i) {
+        const PluginRecord& record = records.at(i);
+        m_encryptedSettings->setArrayIndex(i);
+        m_encryptedSettings->setValue("path", record.signature.pluginPath);
+        m_encryptedSettings->setValue("signature", record.signature.signature);
+        m_encryptedSettings->setValue("certificate", record.signature.certificate);
+        m_encryptedSettings->setValue("issuer", record.signature.issuer);
+        m_encryptedSettings->setValue("sha256", record.signature.sha256);
+        m_encryptedSettings->setValue("signedDate", record.signature.signedDate);
+        m_encryptedSettings->setValue("valid", record.signature.isValid);
+        m_encryptedSettings->setValue("size", record.identity.size);
+        m_encryptedSettings->setValue("modified", record.identity.modified);
+        m_encryptedSettings->setValue("fileId", record.identity.fileId);
+    }
+    m_encryptedSettings->endArray();
+}
+
 // Threat detection and mitigation
 bool SecurityManager::detectThreat(const QString& filePath, const QByteArray& content)
 {
@@ -662,7 +995,7 @@ QByteArray SecurityManager::generateSecureRandomBytes(int length)
     bytes.reserve(length);
     
     for (int i = 0; i < length; ++i) {
-        bytes.append(static_cast<char>(QRandomGenerator::global()->bounded(256)));
+        bytes.append(static_cast<char>(QRandomGenerator::system()->bounded(256)));
     }
     
     return bytes;
@@ -684,11 +1017,8 @@ QString SecurityManager::generateSecureToken(int length)
 // Private helper methods
 bool SecurityManager::detectMaliciousPatterns(const QByteArray& content)
 {
-    for (const QString& pattern : m_maliciousPatterns) {
-        QRegularExpression regex(pattern);
-        if (regex.match(QString::fromLatin1(content)).hasMatch()) {
-            return true;
-        }
+    if (m_maliciousScanner.containsAny(content)) {
+        return true;
     }
     
     // Check against known threat signatures
@@ -729,57 +1059,25 @@ bool SecurityManager::detectDirectoryTraversalAttempt(const QString& path)
 
 bool SecurityManager::detectScriptInjection(const QString& content)
 {
-    QStringList scriptPatterns = {
-        "<script", "javascript:", "vbscript:", "onload=", "onerror=",
-        "eval\\(", "document\\.", "window\\.", "alert\\("
-    };
-    
-    for (const QString& pattern : scriptPatterns) {
-        QRegularExpression regex(pattern, QRegularExpression::CaseInsensitiveOption);
-        if (regex.match(content).hasMatch()) {
-            return true;
-        }
-    }
-    
-    return false;
-}
-
-QByteArray SecurityManager::encryptData(const QByteArray& data, const QByteArray& key)
-{
-    // Simplified AES-like encryption (would use proper crypto library in production)
-    QByteArray encrypted;
-    encrypted.reserve(data.size());
-    
-    for (int i = 0; i < data.size(); ++i) {
-        char keyByte = key.at(i % key.size());
-        encrypted.append(data.at(i) ^ keyByte);
-    }
-    
-    return encrypted;
-}
-
-QByteArray SecurityManager::decryptData(const QByteArray& encryptedData, const QByteArray& key)
-{
-    // Same as encryption for XOR cipher
-    return encryptData(encryptedData, key);
+    return m_scriptScanner.containsAny(content);
 }
 
 QByteArray SecurityManager::deriveKey(const QString& password, const QByteArray& salt)
 {
-    QCryptographicHash hash(QCryptographicHash::Sha256);
-    hash.addData(password.toUtf8());
-    hash.addData(salt);
-    
-    QByteArray result = hash.result();
-    
-    // Simple key stretching
-    for (int i = 0; i < 1000; ++i) {
-        hash.reset();
-        hash.addData(result);
-        result = hash.result();
+    // PBKDF2 is deliberately slow; each password is stretched once per session
+    QCryptographicHash digest(QCryptographicHash::Sha256);
+    digest.addData(password.toUtf8());
+    digest.addData(salt);
+    const QByteArray cacheKey = digest.result();
+    
+    auto cached = m_derivedKeys.constFind(cacheKey);
+    if (cached != m_derivedKeys.constEnd()) {
+        return *cached;
     }
     
-    return result.left(ENCRYPTION_KEY_LENGTH);
+    const QByteArray key = AesGcm::deriveKey(password.toUtf8(), salt);
+    m_derivedKeys.insert(cacheKey, key);
+    return key;
 }
 
 QByteArray SecurityManager::generateSalt()
@@ -801,7 +1099,7 @@ void SecurityManager::onFileSystemChanged(const QString& path)
         
         // Validate the changed file
         if (QFile::exists(path)) {
-            FileValidationResult result = validateMediaFile(path);
+            FileSecurityReport result = validateMediaFile(path);
             if (!result.isSafe) {
                 reportThreat(THREAT_MALICIOUS_FILE, "Suspicious file modification detected", path);
             }
@@ -844,24 +1142,19 @@ void SecurityManager::updateThreatDatabase()
     // Would download latest threat signatures, malware patterns, etc.
 }
 
-QStringList SecurityManager::scanForThreats(const QString& filePath)
+QStringList SecurityManager::scanForThreats(const QByteArray& content)
 {
     QStringList threats;
     
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        threats.append("Cannot read file for threat scanning");
-        return threats;
-    }
-    
-    QByteArray content = file.read(1024 * 1024); // Read first 1MB
-    file.close();
-    
     // Check for known malicious patterns
-    for (const QString& pattern : m_maliciousPatterns) {
-        if (content.contains(pattern.toUtf8())) {
-            threats.append(QString("Malicious pattern detected: %1").arg(pattern));
-        }
+    const QList<int> matches = m_maliciousScanner.findAll(content);
+    for (int index : matches) {
+        const QByteArray pattern = m_maliciousScanner.pattern(index);
+        const bool printable = std::all_of(pattern.cbegin(), pattern.cend(), [](char ch) {
+            return ch >= 0x20 && ch < 0x7F;
+        });
+        threats.append(QString("Malicious pattern detected: %1")
+                           .arg(printable ? QString::fromLatin1(pattern) : "0x" + QString::fromLatin1(pattern.toHex())));
     }
     
     return threats;
@@ -0,0 +1,9 @@
+#include "EonPlayServer.h"
+
+/**
+ * @brief Headless media server entry point
+ */
+int main(int argc, char *argv[])
+{
+    return EonPlayServer::run(argc, argv);
+}
@@ -1,7 +1,10 @@
 #include "stability/CrashReporter.h"
-#include <QNetworkAccessManager>
-#include <QNetworkRequest>
-#include <QNetworkReply>
+#include "Breadcrumbs.h"
+#include "stability/MetricsServer.h"
+#include "stability/ReportUploadQueue.h"
+#include <QCryptographicHash>
+#include <QEventLoop>
+#include <QRegularExpression>
 #include <QTimer>
 #include <QDateTime>
 #include <QStandardPaths>
@@ -15,6 +18,7 @@
 #include <QProcess>
 #include <QThread>
 #include <QLoggingCategory>
+#include <QUrl>
 #include <QUuid>
 
 #ifdef Q_OS_WIN
@@ -52,7 +56,7 @@ CrashReporter::CrashReporter(QObject *parent)
     , m_consecutiveFailures(0)
     , m_stabilityTimer(std::make_unique<QTimer>(this))
     , m_memoryMonitor(std::make_unique<QTimer>(this))
-    , m_networkManager(std::make_unique<QNetworkAccessManager>(this))
+    , m_uploadQueue(std::make_unique<ReportUploadQueue>(ReportUploadQueue::defaultDirectory(), this))
     , m_initialMemoryUsage(0)
     , m_peakMemoryUsage(0)
 {
@@ -66,14 +70,19 @@ CrashReporter::CrashReporter(QObject *parent)
     m_memoryMonitor->setInterval(DEFAULT_MEMORY_CHECK_INTERVAL_MS);
     connect(m_memoryMonitor.get(), &QTimer::timeout, this, &CrashReporter::onMemoryMonitorTimeout);
     
-    // Setup network manager
-    connect(m_networkManager.get(), &QNetworkAccessManager::finished,
-            this, &CrashReporter::onReportingReplyFinished);
+    // Reports queued by earlier sessions go out once consent is given
+    connect(m_uploadQueue.get(), &ReportUploadQueue::reportsUploaded, this, &CrashReporter::onReportsUploaded);
+    updateUploadQueue();
     
     // Load existing data
     loadStoredCrashes();
     loadStabilityMetrics();
     
+    // Breadcrumbs are written to a mapped file from here on, so they survive a crash
+    BreadcrumbRing::instance().open(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                                    + "/crashes/breadcrumbs.ring");
+    recoverPreviousSession();
+    
     // Record initial memory usage
     m_initialMemoryUsage = getCurrentMemoryUsage();
     m_peakMemoryUsage = m_initialMemoryUsage;
@@ -87,15 +96,7 @@ CrashReporter::~CrashReporter()
     stopStabilityMonitoring();
     saveStabilityMetrics();
     
-    // Cancel pending reports
-    for (QNetworkReply* reply : m_pendingReports) {
-        if (reply) {
-            reply->abort();
-            reply->deleteLater();
-        }
-    }
-    m_pendingReports.clear();
-    
+    BreadcrumbRing::instance().close();
     s_instance = nullptr;
 }
 
@@ -175,6 +176,10 @@ void CrashReporter::handleCrash(CrashType type, const QString& location, const Q
     crashInfo.memoryUsage = getCurrentMemoryUsage();
     crashInfo.uptime = getApplicationUptime();
     crashInfo.lastAction = m_lastUserAction;
+    const QList<BreadcrumbRing::Breadcrumb> breadcrumbs = BreadcrumbRing::instance().breadcrumbs();
+    for (const BreadcrumbRing::Breadcrumb& breadcrumb : breadcrumbs) {
+        crashInfo.breadcrumbs.append(breadcrumb.toString());
+    }
     crashInfo.systemInfo = collectSystemInfo();
     
     // Store crash info
@@ -253,6 +258,7 @@ bool CrashReporter::isAutomaticReportingEnabled() const
 void CrashReporter::setReportingEndpoint(const QString& url)
 {
     m_reportingEndpoint = url;
+    updateUploadQueue();
     qCDebug(crashReporter) << "Reporting endpoint set to:" << url;
 }
 
@@ -267,35 +273,23 @@ bool CrashReporter::reportCrash(const CrashInfo& crashInfo)
         return false;
     }
     
-    QByteArray reportData = prepareCrashReport(crashInfo);
-    
-    QNetworkRequest request(m_reportingEndpoint);
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    request.setRawHeader("User-Agent", "EonPlay-CrashReporter/1.0");
-    
-    QNetworkReply* reply = m_networkManager->post(request, reportData);
-    reply->setProperty("crashId", crashInfo.crashId);
+    // Sent now, with whatever else is queued
+    queueCrashReport(crashInfo);
+    m_uploadQueue->flush();
     
     // Wait for response (synchronous)
-    QEventLoop loop;
-    connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    QTimer::singleShot(m_reportingTimeout, &loop, &QEventLoop::quit);
-    loop.exec();
-    
-    bool success = (reply->error() == QNetworkReply::NoError);
-    
-    if (success) {
-        // Mark crash as reported
-        for (auto& crash : m_storedCrashes) {
-            if (crash.crashId == crashInfo.crashId) {
-                crash.wasReported = true;
-                break;
-            }
-        }
+    if (m_uploadQueue->isUploading()) {
+        QEventLoop loop;
+        connect(m_uploadQueue.get(), &ReportUploadQueue::reportsUploaded, &loop, &QEventLoop::quit);
+        connect(m_uploadQueue.get(), &ReportUploadQueue::uploadFailed, &loop, &QEventLoop::quit);
+        QTimer::singleShot(m_reportingTimeout, &loop, &QEventLoop::quit);
+        loop.exec();
     }
     
-    emit crashReported(crashInfo.crashId, success);
-    reply->deleteLater();
+    bool success = m_crashDatabase.value(crashInfo.crashId).wasReported;
+    if (!success) {
+        emit crashReported(crashInfo.crashId, false);
+    }
     
     qCDebug(crashReporter) << "Crash report sent:" << crashInfo.crashId << "Success:" << success;
     return success;
@@ -307,18 +301,10 @@ void CrashReporter::reportCrashAsync(const CrashInfo& crashInfo)
         return;
     }
     
-    QByteArray reportData = prepareCrashReport(crashInfo);
-    
-    QNetworkRequest request(m_reportingEndpoint);
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    request.setRawHeader("User-Agent", "EonPlay-CrashReporter/1.0");
-    
-    QNetworkReply* reply = m_networkManager->post(request, reportData);
-    reply->setProperty("crashId", crashInfo.crashId);
+    // Batched with other reports; crashReported() follows the upload
+    const bool queued = queueCrashReport(crashInfo);
     
-    m_pendingReports.append(reply);
-    
-    qCDebug(crashReporter) << "Async crash report initiated:" << crashInfo.crashId;
+    qCDebug(crashReporter) << "Crash report queued:" << crashInfo.crashId << (queued ? "" : "(duplicate)");
 }
 
 // Stability monitoring
@@ -329,6 +315,13 @@ void CrashReporter::startStabilityMonitoring()
         m_stabilityTimer->start();
         m_memoryMonitor->start();
         
+        // Opt-in scrape endpoint for profiling sessions
+        bool portValid = false;
+        const int metricsPort = qEnvironmentVariableIntValue("EONPLAY_METRICS_PORT", &portValid);
+        if (portValid && metricsPort > 0 && metricsPort <= 65535 && !m_metricsServer) {
+            enableMetricsEndpoint(static_cast<quint16>(metricsPort));
+        }
+        
         qCDebug(crashReporter) << "Stability monitoring started";
     }
 }
@@ -349,9 +342,29 @@ bool CrashReporter::isStabilityMonitoringActive() const
     return m_stabilityMonitoringActive;
 }
 
+bool CrashReporter::enableMetricsEndpoint(quint16 port)
+{
+    if (!m_metricsServer) {
+        m_metricsServer = std::make_unique<MetricsServer>();
+    }
+    return m_metricsServer->listen(port);
+}
+
+void CrashReporter::disableMetricsEndpoint()
+{
+    m_metricsServer.reset();
+}
+
+quint16 CrashReporter::getMetricsEndpointPort() const
+{
+    return m_metricsServer && m_metricsServer->isListening() ? m_metricsServer->port() : 0;
+}
+
 CrashReporter::StabilityMetrics CrashReporter::getStabilityMetrics() const
 {
-    return m_stabilityMetrics;
+    StabilityMetrics metrics = m_stabilityMetrics;
+    metrics.performance = MetricsRegistry::instance().snapshot();
+    return metrics;
 }
 
 void CrashReporter::recordSessionStart()
@@ -382,6 +395,8 @@ void CrashReporter::recordSessionEnd()
 
 void CrashReporter::recordUserAction(const QString& action)
 {
+    BreadcrumbRing::instance().record(BreadcrumbRing::UserAction, action.toUtf8());
+    
     m_lastUserAction = action;
     m_sessionActions.append(QString("%1: %2").arg(QDateTime::currentDateTime().toString()).arg(action));
     
@@ -622,6 +637,11 @@ void CrashReporter::storeCrashInfo(const CrashInfo& crashInfo)
         m_crashDatabase.remove(removed.crashId);
     }
     
+    writeCrashFile(crashInfo);
+}
+
+void CrashReporter::writeCrashFile(const CrashInfo& crashInfo)
+{
     // Save to disk
     QString crashDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/crashes";
     QDir().mkpath(crashDir);
@@ -641,6 +661,7 @@ void CrashReporter::storeCrashInfo(const CrashInfo& crashInfo)
         crashObj["memoryUsage"] = crashInfo.memoryUsage;
         crashObj["uptime"] = crashInfo.uptime;
         crashObj["lastAction"] = crashInfo.lastAction;
+        crashObj["breadcrumbs"] = QJsonArray::fromStringList(crashInfo.breadcrumbs);
         crashObj["wasReported"] = crashInfo.wasReported;
         
         QJsonDocument doc(crashObj);
@@ -676,6 +697,9 @@ void CrashReporter::loadStoredCrashes()
             crashInfo.memoryUsage = crashObj["memoryUsage"].toVariant().toLongLong();
             crashInfo.uptime = crashObj["uptime"].toVariant().toLongLong();
             crashInfo.lastAction = crashObj["lastAction"].toString();
+            for (const QJsonValue& breadcrumb : crashObj["breadcrumbs"].toArray()) {
+                crashInfo.breadcrumbs.append(breadcrumb.toString());
+            }
             crashInfo.wasReported = crashObj["wasReported"].toBool();
             
             m_storedCrashes.append(crashInfo);
@@ -688,6 +712,72 @@ void CrashReporter::loadStoredCrashes()
     qCDebug(crashReporter) << "Loaded" << m_storedCrashes.size() << "stored crashes";
 }
 
+void CrashReporter::recoverPreviousSession()
+{
+    const BreadcrumbRing& ring = BreadcrumbRing::instance();
+    if (!ring.previousSessionCrashed()) {
+        return;
+    }
+    
+    QStringList breadcrumbs;
+    const QList<BreadcrumbRing::Breadcrumb> previous = ring.previousSession();
+    for (const BreadcrumbRing::Breadcrumb& breadcrumb : previous) {
+        breadcrumbs.append(breadcrumb.toString());
+    }
+    
+    // The crash handler may have managed to store a report; complete it
+    const QDateTime sessionStart = QDateTime::fromMSecsSinceEpoch(ring.previousSessionStartMs());
+    for (int i = m_storedCrashes.size() - 1; i >= 0; --i) {
+        CrashInfo& stored = m_storedCrashes[i];
+        if (stored.timestamp >= sessionStart) {
+            if (stored.breadcrumbs.isEmpty()) {
+                stored.breadcrumbs = breadcrumbs;
+                m_crashDatabase[stored.crashId] = stored;
+                writeCrashFile(stored);
+            }
+            return;
+        }
+    }
+    
+    // Otherwise the process died before it could; report from the breadcrumbs alone
+    CrashInfo crashInfo;
+    crashInfo.crashId = generateCrashId();
+    crashInfo.timestamp = previous.isEmpty() ? sessionStart
+                                             : QDateTime::fromMSecsSinceEpoch(previous.last().timestampMs);
+    crashInfo.applicationVersion = getApplicationVersion();
+    crashInfo.operatingSystem = getOperatingSystemInfo();
+    crashInfo.breadcrumbs = breadcrumbs;
+    crashInfo.lastAction = previous.isEmpty() ? QString() : QString::fromUtf8(previous.last().text);
+    
+    switch (ring.previousCrashSignal()) {
+        case SIGSEGV:
+            crashInfo.type = CRASH_SEGFAULT;
+            crashInfo.crashLocation = "Segmentation fault";
+            break;
+        case SIGABRT:
+            crashInfo.type = CRASH_ABORT;
+            crashInfo.crashLocation = "Abort signal";
+            break;
+        case 0:
+            crashInfo.type = CRASH_UNKNOWN;
+            crashInfo.crashLocation = "Unclean shutdown";
+            break;
+        default:
+            crashInfo.type = CRASH_EXCEPTION;
+            crashInfo.crashLocation = QString("Signal %1").arg(ring.previousCrashSignal());
+            break;
+    }
+    crashInfo.errorMessage = "Recovered from breadcrumbs after restart";
+    
+    storeCrashInfo(crashInfo);
+    m_stabilityMetrics.crashCount++;
+    m_stabilityMetrics.lastCrash = crashInfo.timestamp;
+    m_stabilityMetrics.crashTypeCount[QString::number(static_cast<int>(crashInfo.type))]++;
+    
+    qCWarning(crashReporter) << "Previous session crashed:" << crashInfo.crashLocation
+                             << "with" << breadcrumbs.size() << "breadcrumbs";
+}
+
 void CrashReporter::saveStabilityMetrics()
 {
     QString configDir = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
@@ -765,7 +855,7 @@ CrashReporter::StabilityLevel CrashReporter::calculateStabilityLevel() const
     }
 }
 
-QByteArray CrashReporter::prepareCrashReport(const CrashInfo& crashInfo) const
+QJsonObject CrashReporter::prepareCrashReport(const CrashInfo& crashInfo) const
 {
     QJsonObject report;
     report["crashId"] = crashInfo.crashId;
@@ -779,6 +869,7 @@ QByteArray CrashReporter::prepareCrashReport(const CrashInfo& crashInfo) const
     report["memoryUsage"] = crashInfo.memoryUsage;
     report["uptime"] = crashInfo.uptime;
     report["lastAction"] = crashInfo.lastAction;
+    report["breadcrumbs"] = QJsonArray::fromStringList(crashInfo.breadcrumbs);
     
     // Add system info
     QJsonObject systemInfo;
@@ -794,8 +885,46 @@ QByteArray CrashReporter::prepareCrashReport(const CrashInfo& crashInfo) const
     }
     report["loadedModules"] = modules;
     
-    QJsonDocument doc(report);
-    return doc.toJson(QJsonDocument::Compact);
+    return report;
+}
+
+QByteArray CrashReporter::crashSignature(const CrashInfo& crashInfo) const
+{
+    // Same version, kind and place; addresses differ between runs
+    static const QRegularExpression address("0x[0-9a-fA-F]+");
+    const QStringList frames = crashInfo.stackTrace.split('\n', Qt::SkipEmptyParts).mid(0, SIGNATURE_FRAMES);
+    
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(crashInfo.applicationVersion.toUtf8());
+    hash.addData(QByteArray::number(static_cast<int>(crashInfo.type)));
+    hash.addData(crashInfo.crashLocation.toUtf8());
+    for (const QString& frame : frames) {
+        hash.addData(QString(frame).remove(address).trimmed().toUtf8());
+    }
+    return hash.result().toHex();
+}
+
+bool CrashReporter::queueCrashReport(const CrashInfo& crashInfo)
+{
+    // A dump written by generateCrashDump() for this crash goes with it
+#ifdef Q_OS_WIN
+    QString dumpPath = QStandardPaths::writableLocation(QStandardPaths::TempLocation)
+                      + QString("/eonplay_crash_%1.dmp").arg(crashInfo.crashId);
+#else
+    QString dumpPath = QStandardPaths::writableLocation(QStandardPaths::TempLocation)
+                      + QString("/eonplay_crash_%1.core").arg(crashInfo.crashId);
+#endif
+    if (!QFile::exists(dumpPath)) {
+        dumpPath.clear();
+    }
+    
+    return m_uploadQueue->enqueue(crashInfo.crashId, crashSignature(crashInfo), prepareCrashReport(crashInfo), dumpPath);
+}
+
+void CrashReporter::updateUploadQueue()
+{
+    m_uploadQueue->setEndpoint(QUrl(m_reportingEndpoint));
+    m_uploadQueue->setEnabled(m_userConsent && !m_reportingEndpoint.isEmpty());
 }
 
 bool CrashReporter::shouldReportCrash(const CrashInfo& crashInfo) const
@@ -833,6 +962,10 @@ QString CrashReporter::getGPUInfo() const
 // Static signal handlers
 void CrashReporter::signalHandler(int signal)
 {
+    // Async-signal-safe, and enough for the next start to report the crash
+    // even if the handling below fails on a corrupt heap
+    BreadcrumbRing::instance().markCrash(signal);
+    
     if (s_instance) {
         CrashType type = CRASH_UNKNOWN;
         QString location = QString("Signal %1").arg(signal);
@@ -873,6 +1006,7 @@ void CrashReporter::signalHandler(int signal)
 
 void CrashReporter::terminateHandler()
 {
+    BreadcrumbRing::instance().markCrash(SIGABRT);
     if (s_instance) {
         s_instance->handleCrash(CRASH_EXCEPTION, "std::terminate called");
     }
@@ -895,30 +1029,25 @@ void CrashReporter::onStabilityTimerTimeout()
     analyzeStabilityTrends();
 }
 
-void CrashReporter::onReportingReplyFinished()
+void CrashReporter::onReportsUploaded(const QStringList& crashIds)
 {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
-    
-    QString crashId = reply->property("crashId").toString();
-    bool success = (reply->error() == QNetworkReply::NoError);
-    
-    if (success) {
+    for (const QString& crashId : crashIds) {
         // Mark crash as reported
         for (auto& crash : m_storedCrashes) {
             if (crash.crashId == crashId) {
                 crash.wasReported = true;
+                writeCrashFile(crash);
                 break;
             }
         }
+        if (m_crashDatabase.contains(crashId)) {
+            m_crashDatabase[crashId].wasReported = true;
+        }
+        
+        emit crashReported(crashId, true);
     }
     
-    emit crashReported(crashId, success);
-    
-    m_pendingReports.removeAll(reply);
-    reply->deleteLater();
-    
-    qCDebug(crashReporter) << "Async crash report completed:" << crashId << "Success:" << success;
+    qCDebug(crashReporter) << "Crash reports uploaded:" << crashIds.size();
 }
 
 void CrashReporter::onMemoryMonitorTimeout()
@@ -1012,6 +1141,16 @@ int CrashReporter::getReportingTimeout() const
     return m_reportingTimeout;
 }
 
+void CrashReporter::setDailyUploadLimit(qint64 bytes)
+{
+    m_uploadQueue->setDailyUploadLimit(bytes);
+}
+
+qint64 CrashReporter::getDailyUploadLimit() const
+{
+    return m_uploadQueue->dailyUploadLimit();
+}
+
 void CrashReporter::setStabilityCheckInterval(int intervalMs)
 {
     m_stabilityCheckInterval = intervalMs;
@@ -1021,6 +1160,7 @@ void CrashReporter::setStabilityCheckInterval(int intervalMs)
 void CrashReporter::setUserConsent(bool hasConsent)
 {
     m_userConsent = hasConsent;
+    updateUploadQueue();
     qCDebug(crashReporter) << "User consent for crash reporting:" << hasConsent;
 }
 
@@ -0,0 +1,877 @@
+#include "stability/DeltaUpdater.h"
+#include "network/DownloadManager.h"
+#include "network/NetworkService.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <algorithm>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAVE_OPENSSL
+#include <openssl/evp.h>
+#endif
+
+Q_LOGGING_CATEGORY(deltaUpdater, "eonplay.stability.deltaupdater")
+
+namespace {
+
+const QString HASH_CACHE_FILE = QStringLiteral("installed.json");
+const QString STAGED_FILE = QStringLiteral("staged.json");
+const QString JOURNAL_FILE = QStringLiteral("journal.json");
+constexpr int ED25519_KEY_BYTES = 32;
+constexpr qint64 CATCH_UP_CHUNK_BYTES = 1024 * 1024;
+
+/**
+ * Manifest paths must stay inside the installation.
+ */
+bool isSafePath(const QString& path)
+{
+    const QString clean = QDir::cleanPath(path);
+    return !clean.isEmpty() && clean == path && !QDir::isAbsolutePath(clean) && !clean.startsWith("..")
+           && !clean.contains(QLatin1Char(':')) && !clean.contains(QLatin1Char('\\'));
+}
+
+bool isSha256(const QByteArray& hex)
+{
+    if (hex.size() != 64) {
+        return false;
+    }
+    return std::all_of(hex.cbegin(), hex.cend(), [](char c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+    });
+}
+
+/**
+ * Rename, or copy when the directories are on different file systems.
+ */
+bool moveFile(const QString& from, const QString& to)
+{
+    QDir().mkpath(QFileInfo(to).path());
+    QFile::remove(to);
+    if (QFile::rename(from, to)) {
+        return true;
+    }
+    return QFile::copy(from, to) && QFile::remove(from);
+}
+
+/**
+ * Decompress a download into targetPath, against the installed file for a
+ * patch, hashing the output as it is written.
+ */
+QString decodeFile(const QString& downloadedPath, const QString& sourcePath, const QString& targetPath,
+                   const QByteArray& expectedSha256)
+{
+#ifdef HAVE_ZSTD
+    QFile input(downloadedPath);
+    if (!input.open(QIODevice::ReadOnly)) {
+        return QString("Cannot read %1").arg(downloadedPath);
+    }
+
+    QFile source(sourcePath);
+    const uchar* prefix = nullptr;
+    qint64 prefixSize = 0;
+    if (!sourcePath.isEmpty()) {
+        if (!source.open(QIODevice::ReadOnly)) {
+            return QString("Cannot read %1").arg(sourcePath);
+        }
+        prefixSize = source.size();
+        prefix = prefixSize > 0 ? source.map(0, prefixSize) : nullptr;
+        if (prefixSize > 0 && !prefix) {
+            return QString("Cannot map %1").arg(sourcePath);
+        }
+    }
+
+    QDir().mkpath(QFileInfo(targetPath).path());
+    QFile output(targetPath + ".part");
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return QString("Cannot write %1").arg(output.fileName());
+    }
+
+    std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)> context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    // Patches reference the whole old file, so allow windows as large as it
+    ZSTD_DCtx_setParameter(context.get(), ZSTD_d_windowLogMax, sizeof(void*) == 8 ? 31 : 30);
+    if (prefix) {
+        ZSTD_DCtx_refPrefix(context.get(), prefix, static_cast<size_t>(prefixSize));
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    QByteArray inBuffer(ZSTD_DStreamInSize(), Qt::Uninitialized);
+    QByteArray outBuffer(ZSTD_DStreamOutSize(), Qt::Uninitialized);
+    size_t frameRemaining = 0;
+    QString error;
+
+    qint64 read;
+    while (error.isEmpty() && (read = input.read(inBuffer.data(), inBuffer.size())) > 0) {
+        ZSTD_inBuffer in = { inBuffer.constData(), static_cast<size_t>(read), 0 };
+        while (in.pos < in.size) {
+            ZSTD_outBuffer out = { outBuffer.data(), static_cast<size_t>(outBuffer.size()), 0 };
+            frameRemaining = ZSTD_decompressStream(context.get(), &out, &in);
+            if (ZSTD_isError(frameRemaining)) {
+                error = QString("Corrupt update data %1: %2").arg(downloadedPath, ZSTD_getErrorName(frameRemaining));
+                break;
+            }
+            hash.addData(QByteArrayView(outBuffer.constData(), static_cast<qsizetype>(out.pos)));
+            if (output.write(outBuffer.constData(), out.pos) != static_cast<qint64>(out.pos)) {
+                error = QString("Cannot write %1: %2").arg(output.fileName(), output.errorString());
+                break;
+            }
+        }
+    }
+
+    if (error.isEmpty() && (read < 0 || frameRemaining != 0)) {
+        error = QString("Truncated update data %1").arg(downloadedPath);
+    }
+    if (error.isEmpty() && hash.result().toHex() != expectedSha256) {
+        error = QString("Checksum mismatch after applying %1").arg(downloadedPath);
+    }
+    if (error.isEmpty() && !output.flush()) {
+        error = output.errorString();
+    }
+    output.close();
+
+    if (error.isEmpty()) {
+        QFile::remove(targetPath);
+        if (!QFile::rename(output.fileName(), targetPath)) {
+            error = QString("Cannot stage %1").arg(targetPath);
+        }
+    }
+    if (!error.isEmpty()) {
+        QFile::remove(output.fileName());
+    }
+    return error;
+#else
+    Q_UNUSED(downloadedPath)
+    Q_UNUSED(sourcePath)
+    Q_UNUSED(targetPath)
+    Q_UNUSED(expectedSha256)
+    return QStringLiteral("Delta updates cannot be applied without zstd support");
+#endif
+}
+
+} // namespace
+
+DeltaUpdater::DeltaUpdater(const QString& installDirectory, const QString& stateDirectory, QObject* parent)
+    : QObject(parent)
+    , m_installDirectory(QDir(installDirectory).absolutePath())
+    , m_stateDirectory(stateDirectory)
+    , m_downloads(new DownloadManager(QDir(stateDirectory).filePath("transfers"), this))
+    , m_stagePool(new QThreadPool(this))
+{
+    QDir().mkpath(m_stateDirectory);
+    loadHashCache();
+
+    // One connection per file keeps data in order for the running hash
+    m_downloads->setConnectionsPerDownload(1);
+    m_downloads->setMaxConcurrentDownloads(MAX_PARALLEL_FILES);
+    m_stagePool->setMaxThreadCount(MAX_PARALLEL_FILES);
+
+    connect(m_downloads, &DownloadManager::dataWritten, this, &DeltaUpdater::onDataWritten);
+    connect(m_downloads, &DownloadManager::downloadFinished, this, &DeltaUpdater::onDownloadFinished);
+    connect(m_downloads, &DownloadManager::downloadFailed, this, &DeltaUpdater::onDownloadFailed);
+    connect(m_downloads, &DownloadManager::downloadProgress, this, [this]() { updateProgress(); });
+
+    // An update staged before a restart can still be applied
+    if (loadStagedUpdate()) {
+        m_state = State::Staged;
+    }
+}
+
+DeltaUpdater::~DeltaUpdater()
+{
+    for (QNetworkReply* reply : {m_manifestReply, m_signatureReply}) {
+        if (reply) {
+            reply->disconnect(this);
+            reply->abort();
+            reply->deleteLater();
+        }
+    }
+    m_stagePool->waitForDone();
+}
+
+QString DeltaUpdater::defaultDirectory()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath("updates");
+}
+
+void DeltaUpdater::setPublicKey(const QString& publicKey)
+{
+    m_publicKey = QByteArray::fromBase64(publicKey.toLatin1());
+}
+
+QString DeltaUpdater::publicKey() const
+{
+    return QString::fromLatin1(m_publicKey.toBase64());
+}
+
+void DeltaUpdater::setBandwidthLimit(qint64 bytesPerSecond)
+{
+    m_downloads->setBandwidthLimit(bytesPerSecond);
+}
+
+qint64 DeltaUpdater::bandwidthLimit() const
+{
+    return m_downloads->bandwidthLimit();
+}
+
+void DeltaUpdater::setUserAgent(const QString& userAgent)
+{
+    m_userAgent = userAgent.toUtf8();
+    m_downloads->setUserAgent(userAgent);
+}
+
+void DeltaUpdater::checkManifest(const QUrl& manifestUrl)
+{
+    if (m_state == State::Checking || m_state == State::Downloading) {
+        return;
+    }
+
+    m_manifestUrl = manifestUrl;
+    m_manifest.clear();
+    m_signature.clear();
+    setState(State::Checking);
+
+    auto fetch = [this](const QUrl& url) {
+        QNetworkRequest request(url);
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+        if (!m_userAgent.isEmpty()) {
+            request.setRawHeader("User-Agent", m_userAgent);
+        }
+        return NetworkService::instance().get(request, NetworkService::RequestClass::Telemetry);
+    };
+    m_manifestReply = fetch(manifestUrl);
+    m_signatureReply = fetch(QUrl(manifestUrl.toString() + ".sig"));
+    connect(m_manifestReply, &QNetworkReply::finished, this, &DeltaUpdater::onManifestFinished);
+    connect(m_signatureReply, &QNetworkReply::finished, this, &DeltaUpdater::onSignatureFinished);
+}
+
+void DeltaUpdater::onManifestFinished()
+{
+    QNetworkReply* reply = m_manifestReply;
+    m_manifestReply = nullptr;
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        fail(tr("Cannot fetch the update manifest: %1").arg(reply->errorString()));
+        return;
+    }
+    m_manifest = reply->readAll();
+    verifyManifest();
+}
+
+void DeltaUpdater::onSignatureFinished()
+{
+    QNetworkReply* reply = m_signatureReply;
+    m_signatureReply = nullptr;
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        fail(tr("Cannot fetch the update signature: %1").arg(reply->errorString()));
+        return;
+    }
+    m_signature = reply->readAll();
+    verifyManifest();
+}
+
+void DeltaUpdater::verifyManifest()
+{
+    // Wait for both halves; a failure of either has already been reported
+    if (m_state != State::Checking || m_manifestReply || m_signatureReply) {
+        return;
+    }
+
+    bool verified = false;
+#ifdef HAVE_OPENSSL
+    if (m_publicKey.size() == ED25519_KEY_BYTES) {
+        EVP_PKEY* key = EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, nullptr,
+                                                    reinterpret_cast<const unsigned char*>(m_publicKey.constData()),
+                                                    static_cast<size_t>(m_publicKey.size()));
+        EVP_MD_CTX* context = EVP_MD_CTX_new();
+        verified = key && context && EVP_DigestVerifyInit(context, nullptr, nullptr, nullptr, key) == 1
+                   && EVP_DigestVerify(context,
+                                       reinterpret_cast<const unsigned char*>(m_signature.constData()),
+                                       static_cast<size_t>(m_signature.size()),
+                                       reinterpret_cast<const unsigned char*>(m_manifest.constData()),
+                                       static_cast<size_t>(m_manifest.size())) == 1;
+        EVP_MD_CTX_free(context);
+        EVP_PKEY_free(key);
+    }
+#else
+    Q_UNUSED(ED25519_KEY_BYTES)
+#endif
+    if (!verified) {
+        fail(tr("The update manifest signature is invalid or cannot be checked"));
+        return;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(m_manifest, &parseError);
+    if (!document.isObject()) {
+        fail(tr("Malformed update manifest: %1").arg(parseError.errorString()));
+        return;
+    }
+    if (!planUpdate(document.object())) {
+        return;
+    }
+
+    qint64 fullBytes = 0;
+    for (const FileUpdate& file : std::as_const(m_files)) {
+        fullBytes += file.size;
+    }
+    setState(State::Ready);
+    qCInfo(deltaUpdater) << "Update" << m_version << "changes" << m_files.size() << "files, removes"
+                         << m_removed.size() << "," << downloadSize() << "of" << fullBytes << "bytes to download";
+    emit updateReady(m_version, downloadSize(), fullBytes);
+}
+
+bool DeltaUpdater::planUpdate(const QJsonObject& manifest)
+{
+    m_version = manifest["version"].toString();
+    m_files.clear();
+    m_removed.clear();
+    m_staged.clear();
+
+    QStringList listed;
+    const QJsonArray files = manifest["files"].toArray();
+    for (const QJsonValue& value : files) {
+        const QJsonObject entry = value.toObject();
+
+        FileUpdate file;
+        file.path = entry["path"].toString();
+        file.sha256 = entry["sha256"].toString().toLatin1().toLower();
+        file.size = entry["size"].toInteger();
+        if (!isSafePath(file.path) || !isSha256(file.sha256)) {
+            fail(tr("Invalid update manifest entry: %1").arg(file.path));
+            return false;
+        }
+        listed.append(file.path);
+
+        const QByteArray installed = installedHash(file.path);
+        if (installed == file.sha256) {
+            continue;
+        }
+
+        // A patch against what is installed beats the whole file
+        const QJsonArray patches = entry["patches"].toArray();
+        for (const QJsonValue& patchValue : patches) {
+            const QJsonObject patch = patchValue.toObject();
+            if (!installed.isEmpty() && patch["from"].toString().toLatin1().toLower() == installed) {
+                file.url = m_manifestUrl.resolved(QUrl(patch["url"].toString()));
+                file.downloadSha256 = patch["sha256"].toString().toLatin1().toLower();
+                file.downloadSize = patch["size"].toInteger();
+                file.isPatch = true;
+                break;
+            }
+        }
+        if (!file.isPatch) {
+            file.url = m_manifestUrl.resolved(QUrl(entry["url"].toString()));
+            file.downloadSha256 = entry["downloadSha256"].toString().toLatin1().toLower();
+            file.downloadSize = entry["downloadSize"].toInteger();
+        }
+        if (!file.url.isValid() || !isSha256(file.downloadSha256)) {
+            fail(tr("Invalid update manifest entry: %1").arg(file.path));
+            return false;
+        }
+        m_files.append(file);
+    }
+
+    // Only files we installed are ours to remove
+    for (const QString& path : std::as_const(m_manifestFiles)) {
+        if (!listed.contains(path) && QFileInfo::exists(QDir(m_installDirectory).filePath(path))) {
+            m_removed.append(path);
+        }
+    }
+    m_manifestFiles = listed;
+
+    saveHashCache();
+    return true;
+}
+
+QByteArray DeltaUpdater::installedHash(const QString& path)
+{
+    const QFileInfo info(QDir(m_installDirectory).filePath(path));
+    if (!info.isFile()) {
+        m_hashCache.remove(path);
+        return QByteArray();
+    }
+
+    // Hash each installed file once per change, not once per check
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    auto it = m_hashCache.constFind(path);
+    if (it != m_hashCache.cend() && it->size == info.size() && it->modified == modified) {
+        return it->sha256;
+    }
+
+    QFile file(info.filePath());
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!file.open(QIODevice::ReadOnly) || !hash.addData(&file)) {
+        return QByteArray();
+    }
+
+    const QByteArray sha256 = hash.result().toHex();
+    m_hashCache.insert(path, {info.size(), modified, sha256});
+    return sha256;
+}
+
+void DeltaUpdater::loadHashCache()
+{
+    QFile file(QDir(m_stateDirectory).filePath(HASH_CACHE_FILE));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    const QJsonObject files = root["files"].toObject();
+    for (auto it = files.constBegin(); it != files.constEnd(); ++it) {
+        const QJsonObject json = it.value().toObject();
+        m_hashCache.insert(it.key(), {json["size"].toInteger(), json["modified"].toInteger(),
+                                      json["sha256"].toString().toLatin1()});
+    }
+    for (const QJsonValue& path : root["manifest"].toArray()) {
+        m_manifestFiles.append(path.toString());
+    }
+}
+
+void DeltaUpdater::saveHashCache() const
+{
+    QJsonObject files;
+    for (auto it = m_hashCache.cbegin(); it != m_hashCache.cend(); ++it) {
+        QJsonObject json;
+        json["size"] = it->size;
+        json["modified"] = it->modified;
+        json["sha256"] = QString::fromLatin1(it->sha256);
+        files[it.key()] = json;
+    }
+
+    QJsonObject root;
+    root["files"] = files;
+    root["manifest"] = QJsonArray::fromStringList(m_manifestFiles);
+
+    QSaveFile file(QDir(m_stateDirectory).filePath(HASH_CACHE_FILE));
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0
+        || !file.commit()) {
+        qCWarning(deltaUpdater) << "Failed to save installed file hashes:" << file.errorString();
+    }
+}
+
+qint64 DeltaUpdater::downloadSize() const
+{
+    qint64 total = 0;
+    for (const FileUpdate& file : m_files) {
+        total += file.downloadSize;
+    }
+    return total;
+}
+
+void DeltaUpdater::downloadUpdate()
+{
+    if (m_state != State::Ready && m_state != State::Failed) {
+        return;
+    }
+    if (m_files.isEmpty() && m_version.isEmpty()) {
+        return;
+    }
+
+    setState(State::Downloading);
+    for (const FileUpdate& file : std::as_const(m_files)) {
+        if (m_staged.contains(file.path)) {
+            continue;
+        }
+        // Staged and verified in an earlier run
+        if (QFileInfo::exists(stagedPath(file.path))) {
+            m_staged.append(file.path);
+            continue;
+        }
+
+        const QString id = QString::fromLatin1(file.downloadSha256);
+        if (QFileInfo::exists(downloadPath(file))) {
+            // Finished before a restart, not yet staged
+            onDownloadFinished(id, downloadPath(file));
+            continue;
+        }
+
+        Verifier& verifier = m_verifiers[id];
+        if (!verifier.hash) {
+            verifier.hash = std::make_shared<QCryptographicHash>(QCryptographicHash::Sha256);
+        }
+        m_downloads->addDownload(file.url, downloadPath(file), id);
+    }
+
+    if (m_state == State::Downloading && m_staged.size() == m_files.size()) {
+        saveStagedUpdate();
+        setState(State::Staged);
+        emit updateStaged(m_version);
+    }
+}
+
+void DeltaUpdater::pauseDownload()
+{
+    for (const FileUpdate& file : std::as_const(m_files)) {
+        m_downloads->pause(QString::fromLatin1(file.downloadSha256));
+    }
+}
+
+const DeltaUpdater::FileUpdate* DeltaUpdater::fileForDownload(const QString& id) const
+{
+    for (const FileUpdate& file : m_files) {
+        if (file.downloadSha256 == id.toLatin1()) {
+            return &file;
+        }
+    }
+    return nullptr;
+}
+
+void DeltaUpdater::onDataWritten(const QString& id, qint64 offset, const QByteArray& data)
+{
+    auto it = m_verifiers.find(id);
+    if (it == m_verifiers.end()) {
+        return;
+    }
+    Verifier& verifier = *it;
+
+    if (offset < verifier.hashed) {
+        // Started over; the file changed on the server
+        verifier.hash->reset();
+        verifier.hashed = 0;
+    }
+    if (offset > verifier.hashed) {
+        // Resumed from data written before a restart
+        const FileUpdate* file = fileForDownload(id);
+        if (!file || !catchUp(verifier, downloadPath(*file) + ".download", offset)) {
+            return;
+        }
+    }
+
+    verifier.hash->addData(data);
+    verifier.hashed += data.size();
+}
+
+bool DeltaUpdater::catchUp(Verifier& verifier, const QString& filePath, qint64 offset) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(verifier.hashed)) {
+        return false;
+    }
+
+    while (verifier.hashed < offset) {
+        const QByteArray chunk = file.read(std::min(CATCH_UP_CHUNK_BYTES, offset - verifier.hashed));
+        if (chunk.isEmpty()) {
+            return false;
+        }
+        verifier.hash->addData(chunk);
+        verifier.hashed += chunk.size();
+    }
+    return true;
+}
+
+void DeltaUpdater::onDownloadFinished(const QString& id, const QString& filePath)
+{
+    const FileUpdate* file = fileForDownload(id);
+    if (!file) {
+        return;
+    }
+    const FileUpdate update = *file;
+
+    Verifier verifier = m_verifiers.take(id);
+    if (!verifier.hash) {
+        verifier.hash = std::make_shared<QCryptographicHash>(QCryptographicHash::Sha256);
+    }
+    // Only data from before a restart was not seen as it arrived
+    const qint64 size = QFileInfo(filePath).size();
+    if (verifier.hashed != size && (verifier.hashed > size || !catchUp(verifier, filePath, size))) {
+        verifier.hash->reset();
+        verifier.hashed = 0;
+        catchUp(verifier, filePath, size);
+    }
+
+    if (verifier.hash->result().toHex() != update.downloadSha256) {
+        QFile::remove(filePath);
+        fail(tr("Update download of %1 is corrupt").arg(update.path));
+        return;
+    }
+
+    stageFile(update, filePath);
+}
+
+void DeltaUpdater::onDownloadFailed(const QString& id, const QString& error)
+{
+    const FileUpdate* file = fileForDownload(id);
+    if (file && m_state == State::Downloading) {
+        fail(tr("Cannot download %1: %2").arg(file->path, error));
+    }
+}
+
+QString DeltaUpdater::downloadPath(const FileUpdate& file) const
+{
+    return QDir(m_stateDirectory).filePath("downloads/" + QString::fromLatin1(file.downloadSha256) + ".zst");
+}
+
+QString DeltaUpdater::stagedPath(const QString& path) const
+{
+    return QDir(m_stateDirectory).filePath("staging/" + path);
+}
+
+QString DeltaUpdater::backupPath(const QString& path) const
+{
+    return QDir(m_stateDirectory).filePath("backup/" + path);
+}
+
+void DeltaUpdater::stageFile(const FileUpdate& file, const QString& downloadedPath)
+{
+    const QString sourcePath = file.isPatch ? QDir(m_installDirectory).filePath(file.path) : QString();
+    const QString targetPath = stagedPath(file.path);
+    const QString path = file.path;
+    const QByteArray sha256 = file.sha256;
+
+    m_stagePool->start([this, downloadedPath, sourcePath, targetPath, path, sha256]() {
+        const QString error = decodeFile(downloadedPath, sourcePath, targetPath, sha256);
+        if (error.isEmpty()) {
+            QFile::remove(downloadedPath);
+        }
+        QMetaObject::invokeMethod(this, [this, path, error]() {
+            onFileStaged(path, error);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DeltaUpdater::onFileStaged(const QString& path, const QString& error)
+{
+    if (m_state != State::Downloading) {
+        return;
+    }
+    if (!error.isEmpty()) {
+        fail(error);
+        return;
+    }
+
+    if (!m_staged.contains(path)) {
+        m_staged.append(path);
+    }
+    if (m_staged.size() == m_files.size()) {
+        saveStagedUpdate();
+        setState(State::Staged);
+        qCInfo(deltaUpdater) << "Update" << m_version << "staged";
+        emit updateStaged(m_version);
+    }
+}
+
+void DeltaUpdater::updateProgress()
+{
+    qint64 received = 0;
+    for (const FileUpdate& file : std::as_const(m_files)) {
+        received += m_staged.contains(file.path)
+                        ? file.downloadSize
+                        : std::max<qint64>(0, m_downloads->bytesReceived(QString::fromLatin1(file.downloadSha256)));
+    }
+    emit downloadProgress(received, downloadSize());
+}
+
+void DeltaUpdater::saveStagedUpdate() const
+{
+    QJsonArray files;
+    for (const FileUpdate& file : m_files) {
+        QJsonObject json;
+        json["path"] = file.path;
+        json["sha256"] = QString::fromLatin1(file.sha256);
+        json["size"] = file.size;
+        files.append(json);
+    }
+
+    QJsonObject root;
+    root["version"] = m_version;
+    root["files"] = files;
+    root["removed"] = QJsonArray::fromStringList(m_removed);
+
+    QSaveFile file(QDir(m_stateDirectory).filePath(STAGED_FILE));
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(root).toJson()) < 0 || !file.commit()) {
+        qCWarning(deltaUpdater) << "Failed to save the staged update:" << file.errorString();
+    }
+}
+
+bool DeltaUpdater::loadStagedUpdate()
+{
+    QFile file(QDir(m_stateDirectory).filePath(STAGED_FILE));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    m_version = root["version"].toString();
+    m_files.clear();
+    m_staged.clear();
+    for (const QJsonValue& value : root["files"].toArray()) {
+        const QJsonObject json = value.toObject();
+        FileUpdate update;
+        update.path = json["path"].toString();
+        update.sha256 = json["sha256"].toString().toLatin1();
+        update.size = json["size"].toInteger();
+        if (!isSafePath(update.path) || !QFileInfo::exists(stagedPath(update.path))) {
+            return false;
+        }
+        m_files.append(update);
+        m_staged.append(update.path);
+    }
+    m_removed.clear();
+    for (const QJsonValue& path : root["removed"].toArray()) {
+        if (isSafePath(path.toString())) {
+            m_removed.append(path.toString());
+        }
+    }
+    return true;
+}
+
+bool DeltaUpdater::applyUpdate()
+{
+    if (m_state != State::Staged) {
+        return false;
+    }
+
+    const QDir install(m_installDirectory);
+    QDir(QDir(m_stateDirectory).filePath("backup")).removeRecursively();
+
+    // Written first, so rollback() can undo a swap cut short
+    QJsonArray entries;
+    for (const FileUpdate& file : std::as_const(m_files)) {
+        QJsonObject entry;
+        entry["path"] = file.path;
+        entry["replaced"] = QFileInfo::exists(install.filePath(file.path));
+        entries.append(entry);
+    }
+    for (const QString& path : std::as_const(m_removed)) {
+        QJsonObject entry;
+        entry["path"] = path;
+        entry["removed"] = true;
+        entries.append(entry);
+    }
+    QJsonObject journal;
+    journal["version"] = m_version;
+    journal["entries"] = entries;
+    QDir().mkpath(QDir(m_stateDirectory).filePath("backup"));
+    QSaveFile journalFile(backupPath(JOURNAL_FILE));
+    if (!journalFile.open(QIODevice::WriteOnly) || journalFile.write(QJsonDocument(journal).toJson()) < 0
+        || !journalFile.commit()) {
+        fail(tr("Cannot write the update journal: %1").arg(journalFile.errorString()));
+        return false;
+    }
+
+    bool ok = true;
+    for (const FileUpdate& file : std::as_const(m_files)) {
+        const QString target = install.filePath(file.path);
+        if (QFileInfo::exists(target) && !moveFile(target, backupPath(file.path))) {
+            ok = false;
+            break;
+        }
+        if (!moveFile(stagedPath(file.path), target)) {
+            ok = false;
+            break;
+        }
+    }
+    for (const QString& path : std::as_const(m_removed)) {
+        if (!ok) {
+            break;
+        }
+        ok = moveFile(install.filePath(path), backupPath(path));
+    }
+
+    if (!ok) {
+        const QString error = tr("Cannot install the update; restoring the previous files");
+        rollback();
+        fail(error);
+        return false;
+    }
+
+    // What we installed needs no hashing on the next check
+    for (const FileUpdate& file : std::as_const(m_files)) {
+        const QFileInfo info(install.filePath(file.path));
+        m_hashCache.insert(file.path, {info.size(), info.lastModified().toMSecsSinceEpoch(), file.sha256});
+    }
+    for (const QString& path : std::as_const(m_removed)) {
+        m_hashCache.remove(path);
+    }
+    saveHashCache();
+
+    QFile::remove(QDir(m_stateDirectory).filePath(STAGED_FILE));
+    QDir(QDir(m_stateDirectory).filePath("staging")).removeRecursively();
+
+    const QString version = m_version;
+    m_files.clear();
+    m_removed.clear();
+    m_staged.clear();
+    setState(State::Idle);
+    qCInfo(deltaUpdater) << "Update" << version << "installed";
+    emit updateApplied(version);
+    return true;
+}
+
+bool DeltaUpdater::rollback()
+{
+    QFile journalFile(backupPath(JOURNAL_FILE));
+    if (!journalFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QJsonArray entries = QJsonDocument::fromJson(journalFile.readAll()).object()["entries"].toArray();
+    journalFile.close();
+
+    const QDir install(m_installDirectory);
+    bool ok = true;
+    for (const QJsonValue& value : entries) {
+        const QJsonObject entry = value.toObject();
+        const QString path = entry["path"].toString();
+        if (!isSafePath(path)) {
+            continue;
+        }
+
+        const QString target = install.filePath(path);
+        const QString backup = backupPath(path);
+        if (!entry["removed"].toBool() && !QFileInfo::exists(backup) && entry["replaced"].toBool()) {
+            continue; // Never got as far as this file
+        }
+        if (!entry["removed"].toBool()) {
+            QFile::remove(target);
+        }
+        if (QFileInfo::exists(backup) && !moveFile(backup, target)) {
+            qCWarning(deltaUpdater) << "Cannot restore" << target;
+            ok = false;
+        }
+        m_hashCache.remove(path);
+    }
+
+    saveHashCache();
+    if (ok) {
+        QDir(QDir(m_stateDirectory).filePath("backup")).removeRecursively();
+        qCInfo(deltaUpdater) << "Update rolled back";
+    }
+    return ok;
+}
+
+bool DeltaUpdater::canRollback() const
+{
+    return QFileInfo::exists(backupPath(JOURNAL_FILE));
+}
+
+void DeltaUpdater::fail(const QString& error)
+{
+    m_lastError = error;
+    qCWarning(deltaUpdater) << error;
+    pauseDownload();
+    m_verifiers.clear();
+    setState(State::Failed);
+    emit updateFailed(error);
+}
+
+void DeltaUpdater::setState(State state)
+{
+    m_state = state;
+}
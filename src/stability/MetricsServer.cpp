@@ -0,0 +1,108 @@
+#include "stability/MetricsServer.h"
+#include "Metrics.h"
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(metricsServer, "eonplay.stability.metrics")
+
+namespace {
+
+constexpr const char* OPENMETRICS_CONTENT_TYPE = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+} // namespace
+
+MetricsServer::MetricsServer(QObject* parent)
+    : QObject(parent)
+    , m_server(new QTcpServer(this))
+{
+    connect(m_server, &QTcpServer::newConnection, this, &MetricsServer::handleConnection);
+}
+
+MetricsServer::~MetricsServer() = default;
+
+bool MetricsServer::listen(quint16 port, const QHostAddress& address)
+{
+    close();
+    if (!m_server->listen(address, port)) {
+        qCWarning(metricsServer) << "Cannot serve metrics on" << address.toString() << port << ":"
+                                 << m_server->errorString();
+        return false;
+    }
+
+    qCInfo(metricsServer) << "Serving metrics on"
+                          << QString("http://%1:%2/metrics").arg(address.toString()).arg(m_server->serverPort());
+    return true;
+}
+
+void MetricsServer::close()
+{
+    m_server->close();
+}
+
+bool MetricsServer::isListening() const
+{
+    return m_server->isListening();
+}
+
+quint16 MetricsServer::port() const
+{
+    return m_server->serverPort();
+}
+
+void MetricsServer::handleConnection()
+{
+    while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { handleRequest(socket); });
+
+        // Clients that never finish their request are dropped
+        QTimer::singleShot(REQUEST_TIMEOUT_MS, socket, [socket]() { socket->abort(); });
+    }
+}
+
+void MetricsServer::handleRequest(QTcpSocket* socket)
+{
+    if (socket->property("answered").toBool()) {
+        socket->readAll();
+        return;
+    }
+
+    const QByteArray request = socket->peek(MAX_REQUEST_SIZE);
+    if (!request.contains("\r\n\r\n")) {
+        if (request.size() >= MAX_REQUEST_SIZE) {
+            respond(socket, "431 Request Header Fields Too Large", "text/plain", "Request too large\n");
+        }
+        return;
+    }
+    socket->readAll();
+
+    // Request line: method, target, version
+    const QList<QByteArray> requestLine = request.left(request.indexOf("\r\n")).split(' ');
+    const QByteArray method = requestLine.value(0);
+    const QByteArray path = requestLine.value(1).split('?').value(0);
+
+    if (method != "GET") {
+        respond(socket, "405 Method Not Allowed", "text/plain", "Method not allowed\n");
+    } else if (path != "/metrics") {
+        respond(socket, "404 Not Found", "text/plain", "Not found\n");
+    } else {
+        respond(socket, "200 OK", OPENMETRICS_CONTENT_TYPE, MetricsRegistry::instance().toOpenMetrics());
+    }
+}
+
+void MetricsServer::respond(QTcpSocket* socket, const QByteArray& status, const QByteArray& contentType,
+                            const QByteArray& body)
+{
+    socket->setProperty("answered", true);
+
+    QByteArray response = "HTTP/1.1 " + status + "\r\n";
+    response += "Content-Type: " + contentType + "\r\n";
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += "Connection: close\r\n\r\n";
+    response += body;
+
+    socket->write(response);
+    socket->disconnectFromHost();
+}
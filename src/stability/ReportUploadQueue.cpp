@@ -0,0 +1,483 @@
+#include "stability/ReportUploadQueue.h"
+#include "network/NetworkService.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLoggingCategory>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QUuid>
+#include <algorithm>
+#include <limits>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+Q_LOGGING_CATEGORY(reportUploadQueue, "eonplay.stability.uploads")
+
+namespace {
+
+const QString STATE_FILE = QStringLiteral("queue.json");
+constexpr int COMPRESSION_LEVEL = 6;
+constexpr qint64 BUDGET_PERIOD_MS = 24 * 60 * 60 * 1000;
+
+bool isPermanentFailure(int status)
+{
+    // The server rejected the batch itself; sending it again will not help
+    return status >= 400 && status < 500 && status != 408 && status != 429;
+}
+
+} // namespace
+
+ReportUploadQueue::ReportUploadQueue(const QString& directory, QObject* parent)
+    : QObject(parent)
+    , m_directory(directory)
+    , m_timer(new QTimer(this))
+{
+    QDir().mkpath(m_directory);
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &ReportUploadQueue::startUpload);
+
+    loadState();
+}
+
+ReportUploadQueue::~ReportUploadQueue()
+{
+    if (m_reply) {
+        // Whatever was in flight is sent again next time
+        m_reply->disconnect(this);
+        m_reply->abort();
+        m_reply->deleteLater();
+    }
+}
+
+QString ReportUploadQueue::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/crashes/outbox";
+}
+
+void ReportUploadQueue::setEndpoint(const QUrl& endpoint)
+{
+    m_endpoint = endpoint;
+}
+
+void ReportUploadQueue::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    if (!enabled) {
+        m_timer->stop();
+        return;
+    }
+    // Reports left over from earlier sessions
+    schedule(BATCH_DELAY_MS);
+}
+
+void ReportUploadQueue::setDailyUploadLimit(qint64 bytes)
+{
+    m_dailyLimit = std::max<qint64>(0, bytes);
+}
+
+bool ReportUploadQueue::enqueue(const QString& id, const QByteArray& signature, const QJsonObject& report,
+                                const QString& attachmentPath)
+{
+    pruneSignatures();
+
+    // Counted, not stored: the server already has one like it
+    auto sent = m_sent.find(signature);
+    if (sent != m_sent.end()) {
+        sent->unsentIds.append(id);
+        if (!attachmentPath.isEmpty()) {
+            QFile::remove(attachmentPath);
+        }
+        saveState();
+        schedule(BATCH_DELAY_MS);
+        return false;
+    }
+    for (Entry& entry : m_entries) {
+        if (entry.signature == signature) {
+            ++entry.occurrences;
+            entry.mergedIds.append(id);
+            if (!attachmentPath.isEmpty()) {
+                QFile::remove(attachmentPath);
+            }
+            saveState();
+            return false;
+        }
+    }
+
+    QJsonObject line;
+    line["id"] = id;
+    line["signature"] = QString::fromLatin1(signature);
+    line["report"] = report;
+    if (!attachmentPath.isEmpty()) {
+        QFile attachment(attachmentPath);
+        if (attachment.size() <= MAX_ATTACHMENT_BYTES && attachment.open(QIODevice::ReadOnly)) {
+            line["minidump"] = QString::fromLatin1(attachment.readAll().toBase64());
+        } else {
+            qCWarning(reportUploadQueue) << "Not attaching" << attachmentPath << "of" << attachment.size() << "bytes";
+        }
+        attachment.close();
+        QFile::remove(attachmentPath);
+    }
+
+    Entry entry;
+    entry.id = id;
+    entry.signature = signature;
+#ifdef HAVE_ZSTD
+    entry.file = QUuid::createUuid().toString(QUuid::WithoutBraces) + ".ndjson.zst";
+#else
+    entry.file = QUuid::createUuid().toString(QUuid::WithoutBraces) + ".ndjson";
+#endif
+
+    QSaveFile file(QDir(m_directory).filePath(entry.file));
+    const QByteArray data = encodeLine(line);
+    if (data.isEmpty() || !file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qCWarning(reportUploadQueue) << "Failed to queue report" << id << file.errorString();
+        return false;
+    }
+    entry.size = data.size();
+    m_entries.append(entry);
+
+    // Drop the oldest that are not in flight
+    while (m_entries.size() > MAX_QUEUED_REPORTS && m_entries.size() > m_batchEntries) {
+        qCWarning(reportUploadQueue) << "Queue full, dropping report" << m_entries.at(m_batchEntries).id;
+        removeEntry(m_batchEntries);
+    }
+
+    saveState();
+    schedule(BATCH_DELAY_MS);
+    return true;
+}
+
+void ReportUploadQueue::flush()
+{
+    m_nextAttempt = QDateTime();
+    m_timer->stop();
+    startUpload();
+}
+
+QByteArray ReportUploadQueue::encodeLine(const QJsonObject& line) const
+{
+    const QByteArray json = QJsonDocument(line).toJson(QJsonDocument::Compact) + '\n';
+#ifdef HAVE_ZSTD
+    QByteArray compressed(static_cast<qsizetype>(ZSTD_compressBound(json.size())), Qt::Uninitialized);
+    const size_t size = ZSTD_compress(compressed.data(), compressed.size(), json.constData(), json.size(),
+                                      COMPRESSION_LEVEL);
+    if (ZSTD_isError(size)) {
+        qCWarning(reportUploadQueue) << "Compression failed:" << ZSTD_getErrorName(size);
+        return QByteArray();
+    }
+    compressed.truncate(static_cast<qsizetype>(size));
+    return compressed;
+#else
+    return json;
+#endif
+}
+
+void ReportUploadQueue::schedule(qint64 delayMs)
+{
+    if (!m_enabled || m_reply) {
+        return;
+    }
+
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    if (m_nextAttempt.isValid() && m_nextAttempt > now) {
+        delayMs = std::max(delayMs, now.msecsTo(m_nextAttempt));
+    }
+    // An earlier wake-up stands; startUpload() checks what is due
+    if (!m_timer->isActive() || m_timer->remainingTime() > delayMs) {
+        m_timer->start(static_cast<int>(std::min<qint64>(delayMs, std::numeric_limits<int>::max())));
+    }
+}
+
+qint64 ReportUploadQueue::remainingBudget()
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    if (!m_budgetStart.isValid() || m_budgetStart.msecsTo(now) >= BUDGET_PERIOD_MS || m_budgetStart > now) {
+        m_budgetStart = now;
+        m_budgetUsed = 0;
+    }
+    if (m_dailyLimit <= 0) {
+        return std::numeric_limits<qint64>::max();
+    }
+    return std::max<qint64>(0, m_dailyLimit - m_budgetUsed);
+}
+
+void ReportUploadQueue::startUpload()
+{
+    if (!m_enabled || m_reply || !m_endpoint.isValid()) {
+        return;
+    }
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    if (m_nextAttempt.isValid() && m_nextAttempt > now) {
+        schedule(0);
+        return;
+    }
+
+    pruneSignatures();
+    const qint64 budget = remainingBudget();
+    const bool freshBudget = m_budgetUsed == 0;
+
+    QByteArray body;
+    m_batchEntries = 0;
+    m_batchOccurrences.clear();
+    m_batchSignatures.clear();
+    while (m_batchEntries < m_entries.size() && m_batchEntries < MAX_BATCH_REPORTS) {
+        const Entry& entry = m_entries.at(m_batchEntries);
+        const qint64 size = body.size() + entry.size;
+        if (m_batchEntries > 0 && size > MAX_BATCH_BYTES) {
+            break;
+        }
+        // One report always goes on a fresh budget, however large, or it would block the queue
+        if (size > budget && !(freshBudget && m_batchEntries == 0)) {
+            break;
+        }
+
+        QFile file(QDir(m_directory).filePath(entry.file));
+        if (!file.open(QIODevice::ReadOnly)) {
+            qCWarning(reportUploadQueue) << "Lost queued report" << entry.id;
+            removeEntry(m_batchEntries);
+            continue;
+        }
+        body += file.readAll();
+        m_batchOccurrences.append(entry.occurrences);
+        ++m_batchEntries;
+    }
+
+    QList<QJsonObject> occurrenceLines;
+    for (int i = 0; i < m_batchEntries; ++i) {
+        const Entry& entry = m_entries.at(i);
+        if (entry.occurrences > 1) {
+            occurrenceLines.append({{"signature", QString::fromLatin1(entry.signature)},
+                                    {"occurrences", entry.occurrences - 1}});
+        }
+    }
+    for (auto it = m_sent.cbegin(); it != m_sent.cend(); ++it) {
+        if (!it->unsentIds.isEmpty()) {
+            occurrenceLines.append({{"signature", QString::fromLatin1(it.key())},
+                                    {"occurrences", it->unsentIds.size()}});
+            m_batchSignatures.insert(it.key(), it->unsentIds.size());
+        }
+    }
+    for (const QJsonObject& line : std::as_const(occurrenceLines)) {
+        body += encodeLine(line);
+    }
+
+    if (body.isEmpty()) {
+        m_batchEntries = 0;
+        m_batchOccurrences.clear();
+        m_batchSignatures.clear();
+        if (!m_entries.isEmpty()) {
+            // Over budget until the period ends
+            const qint64 wait = BUDGET_PERIOD_MS - m_budgetStart.msecsTo(now);
+            qCDebug(reportUploadQueue) << "Upload budget used, waiting" << wait / 1000 << "s";
+            m_nextAttempt = now.addMSecs(wait);
+            schedule(wait);
+        }
+        saveState();
+        return;
+    }
+
+    QNetworkRequest request(m_endpoint);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-ndjson");
+    request.setRawHeader("User-Agent", "EonPlay-CrashReporter/1.0");
+#ifdef HAVE_ZSTD
+    request.setRawHeader("Content-Encoding", "zstd");
+#endif
+
+    m_batchBytes = body.size();
+    m_budgetUsed += m_batchBytes;
+    saveState();
+
+    qCDebug(reportUploadQueue) << "Uploading" << m_batchEntries << "reports and" << m_batchSignatures.size()
+                               << "repeat counts," << m_batchBytes << "bytes";
+    // Reports wait for playback and metadata traffic
+    m_reply = NetworkService::instance().post(request, body, NetworkService::RequestClass::Telemetry);
+    connect(m_reply, &QNetworkReply::finished, this, &ReportUploadQueue::onUploadFinished);
+}
+
+void ReportUploadQueue::onUploadFinished()
+{
+    QNetworkReply* reply = m_reply;
+    m_reply = nullptr;
+    reply->deleteLater();
+
+    if (reply->error() == QNetworkReply::NoError) {
+        finishUpload(Outcome::Uploaded);
+        return;
+    }
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (isPermanentFailure(status)) {
+        finishUpload(Outcome::Rejected, QString("HTTP %1: %2").arg(status).arg(reply->errorString()));
+        return;
+    }
+
+    bool ok = false;
+    const qint64 retryAfterSeconds = reply->rawHeader("Retry-After").toLongLong(&ok);
+    finishUpload(Outcome::Retry, reply->errorString(), ok ? retryAfterSeconds * 1000 : 0);
+}
+
+void ReportUploadQueue::finishUpload(Outcome outcome, const QString& error, qint64 retryAfterMs)
+{
+    // Repeats folded in while the batch was in flight were not part of it
+    QStringList ids;
+    for (int i = 0; i < m_batchEntries; ++i) {
+        ids.append(m_entries.at(i).id);
+        ids.append(m_entries.at(i).mergedIds.mid(0, m_batchOccurrences.at(i) - 1));
+    }
+    for (auto it = m_batchSignatures.cbegin(); it != m_batchSignatures.cend(); ++it) {
+        ids.append(m_sent.value(it.key()).unsentIds.mid(0, it.value()));
+    }
+
+    if (outcome != Outcome::Retry) {
+        const QDateTime now = QDateTime::currentDateTimeUtc();
+        for (auto it = m_batchSignatures.cbegin(); it != m_batchSignatures.cend(); ++it) {
+            auto sent = m_sent.find(it.key());
+            if (sent != m_sent.end()) {
+                sent->unsentIds.remove(0, std::min<qsizetype>(it.value(), sent->unsentIds.size()));
+            }
+        }
+        for (int i = 0; i < m_batchEntries; ++i) {
+            const Entry& entry = m_entries.at(0);
+            if (outcome == Outcome::Uploaded) {
+                m_sent.insert(entry.signature, {now, entry.mergedIds.mid(m_batchOccurrences.at(i) - 1)});
+            }
+            removeEntry(0);
+        }
+    }
+    m_batchEntries = 0;
+    m_batchOccurrences.clear();
+    m_batchSignatures.clear();
+
+    if (outcome == Outcome::Uploaded) {
+        m_failures = 0;
+        m_nextAttempt = QDateTime();
+        saveState();
+        qCDebug(reportUploadQueue) << "Uploaded" << ids.size() << "reports";
+        emit reportsUploaded(ids);
+        if (!m_entries.isEmpty()) {
+            schedule(0);
+        }
+        return;
+    }
+
+    if (outcome == Outcome::Rejected) {
+        qCWarning(reportUploadQueue) << "Dropping" << ids.size() << "reports:" << error;
+    } else {
+        // Sent again later; the bytes only count once they arrive
+        m_budgetUsed = std::max<qint64>(0, m_budgetUsed - m_batchBytes);
+        ++m_failures;
+        qint64 backoff = INITIAL_BACKOFF_MS << std::min(m_failures - 1, 16);
+        backoff = std::min(backoff, MAX_BACKOFF_MS);
+        // Keep devices that failed together from retrying together
+        backoff += QRandomGenerator::global()->bounded(backoff / 4 + 1);
+        backoff = std::max(backoff, retryAfterMs);
+        m_nextAttempt = QDateTime::currentDateTimeUtc().addMSecs(backoff);
+        qCWarning(reportUploadQueue) << "Upload failed:" << error << "- retrying in" << backoff / 1000 << "s";
+    }
+    saveState();
+    emit uploadFailed(ids, error);
+    schedule(0);
+}
+
+void ReportUploadQueue::removeEntry(int index)
+{
+    QFile::remove(QDir(m_directory).filePath(m_entries.at(index).file));
+    m_entries.removeAt(index);
+}
+
+void ReportUploadQueue::pruneSignatures()
+{
+    const QDateTime cutoff = QDateTime::currentDateTimeUtc().addDays(-DEDUP_WINDOW_DAYS);
+    // Counts not yet reported are kept until they are
+    m_sent.removeIf([&cutoff](const std::pair<const QByteArray&, SentSignature&>& entry) {
+        return entry.second.sentAt < cutoff && entry.second.unsentIds.isEmpty();
+    });
+}
+
+void ReportUploadQueue::loadState()
+{
+    QFile file(QDir(m_directory).filePath(STATE_FILE));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    for (const QJsonValue& value : root["entries"].toArray()) {
+        const QJsonObject json = value.toObject();
+        Entry entry;
+        entry.id = json["id"].toString();
+        entry.signature = json["signature"].toString().toLatin1();
+        for (const QJsonValue& merged : json["merged"].toArray()) {
+            entry.mergedIds.append(merged.toString());
+        }
+        entry.occurrences = std::max(1, json["occurrences"].toInt());
+        entry.file = QFileInfo(json["file"].toString()).fileName();
+        entry.size = QFileInfo(QDir(m_directory).filePath(entry.file)).size();
+        if (!entry.file.isEmpty() && entry.size > 0) {
+            m_entries.append(entry);
+        }
+    }
+
+    const QJsonObject sent = root["sent"].toObject();
+    for (auto it = sent.constBegin(); it != sent.constEnd(); ++it) {
+        const QJsonObject json = it.value().toObject();
+        SentSignature signature;
+        signature.sentAt = QDateTime::fromString(json["sentAt"].toString(), Qt::ISODate);
+        for (const QJsonValue& id : json["unsent"].toArray()) {
+            signature.unsentIds.append(id.toString());
+        }
+        m_sent.insert(it.key().toLatin1(), signature);
+    }
+
+    m_budgetStart = QDateTime::fromString(root["budgetStart"].toString(), Qt::ISODate);
+    m_budgetUsed = root["budgetUsed"].toInteger();
+    m_failures = root["failures"].toInt();
+    m_nextAttempt = QDateTime::fromString(root["nextAttempt"].toString(), Qt::ISODate);
+
+    qCDebug(reportUploadQueue) << "Loaded" << m_entries.size() << "queued reports";
+}
+
+void ReportUploadQueue::saveState() const
+{
+    QJsonArray entries;
+    for (const Entry& entry : m_entries) {
+        QJsonObject json;
+        json["id"] = entry.id;
+        json["signature"] = QString::fromLatin1(entry.signature);
+        json["merged"] = QJsonArray::fromStringList(entry.mergedIds);
+        json["occurrences"] = entry.occurrences;
+        json["file"] = entry.file;
+        entries.append(json);
+    }
+
+    QJsonObject sent;
+    for (auto it = m_sent.cbegin(); it != m_sent.cend(); ++it) {
+        QJsonObject json;
+        json["sentAt"] = it->sentAt.toString(Qt::ISODate);
+        json["unsent"] = QJsonArray::fromStringList(it->unsentIds);
+        sent[QString::fromLatin1(it.key())] = json;
+    }
+
+    QJsonObject root;
+    root["entries"] = entries;
+    root["sent"] = sent;
+    root["budgetStart"] = m_budgetStart.toString(Qt::ISODate);
+    root["budgetUsed"] = m_budgetUsed;
+    root["failures"] = m_failures;
+    root["nextAttempt"] = m_nextAttempt.toString(Qt::ISODate);
+
+    QSaveFile file(QDir(m_directory).filePath(STATE_FILE));
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0
+        || !file.commit()) {
+        qCWarning(reportUploadQueue) << "Failed to save the upload queue:" << file.errorString();
+    }
+}
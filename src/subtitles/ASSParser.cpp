@@ -1,4 +1,5 @@
 #include "subtitles/ASSParser.h"
+#include "subtitles/SubtitleBuffer.h"
 #include <QFileInfo>
 #include <QRegularExpression>
 #include <QStringList>
@@ -179,6 +180,31 @@ SubtitleTrack ASSParser::parseFile(const QString& filePath, SubtitleParseResult&
 {
     result = SubtitleParseResult();
     
+    if (!validateFileInfo(filePath)) {
+        result.errorMessage = "File validation failed";
+        return SubtitleTrack();
+    }
+    
+    // UTF-8 files are parsed straight from the mapping
+    SubtitleBuffer buffer;
+    if (!buffer.open(filePath, maxFileSize())) {
+        result.errorMessage = "Could not read file content";
+        return SubtitleTrack();
+    }
+    
+    if (buffer.isUtf8()) {
+        if (!validateBuffer(buffer.data())) {
+            result.errorMessage = "File validation failed";
+            return SubtitleTrack();
+        }
+        
+        result.detectedEncoding = "UTF-8";
+        result.detectedFormat = "ASS";
+        return parseBuffer(buffer.data(), result);
+    }
+    buffer.close();
+    
+    // Other encodings are decoded first
     // Validate file
     if (!validateFile(filePath)) {
         result.errorMessage = "File validation failed";
@@ -239,26 +265,174 @@ SubtitleTrack ASSParser::parseContent(const QString& content, SubtitleParseResul
         return SubtitleTrack();
     }
     
-    // Sort entries by time
-    track.sortByTime();
+    finalizeTrack(track, result);
+    
+    qCDebug(assParser) << "ASS parsing completed:" << result.summary();
+    
+    return track;
+}
+
+SubtitleTrack ASSParser::parseBuffer(QByteArrayView data, SubtitleParseResult& result) const
+{
+    enum class Section { None, ScriptInfo, Styles, Events, Other };
+    
+    SubtitleTrack track("ASS Subtitles");
+    track.setFormat("ASS");
+    
+    Section section = Section::None;
+    bool hasEvents = false;
+    QHash<QString, ASSStyle> styles;
+    
+    // Styles precede events, so their formats are built once at [Events]
+    QHash<QString, SubtitleFormat> formats;
+    SubtitleFormat fallbackFormat;
+    
+    QByteArrayView rest = data;
+    QByteArrayView line;
+    while (SubtitleBuffer::nextLine(rest, line)) {
+        const QByteArrayView trimmedLine = line.trimmed();
+        if (trimmedLine.isEmpty() || trimmedLine.startsWith('!')) {
+            continue; // Skip empty lines and comments
+        }
+        
+        // Check for section headers
+        if (trimmedLine.startsWith('[') && trimmedLine.endsWith(']')) {
+            const QByteArrayView name = trimmedLine.sliced(1, trimmedLine.size() - 2);
+            if (name == "Script Info") {
+                section = Section::ScriptInfo;
+            } else if (name == "V4+ Styles" || name == "V4 Styles") {
+                section = Section::Styles;
+            } else if (name == "Events") {
+                section = Section::Events;
+                if (!hasEvents) {
+                    hasEvents = true;
+                    if (styles.isEmpty()) {
+                        styles.insert("Default", ASSStyle("Default"));
+                    }
+                    for (auto it = styles.cbegin(); it != styles.cend(); ++it) {
+                        formats.insert(it.key(), it.value().toSubtitleFormat());
+                    }
+                    fallbackFormat = formats.value("Default", ASSStyle().toSubtitleFormat());
+                }
+            } else {
+                section = Section::Other;
+            }
+            continue;
+        }
+        
+        if (section == Section::ScriptInfo) {
+            const qsizetype colon = trimmedLine.indexOf(':');
+            if (colon <= 0) {
+                continue;
+            }
+            
+            const QByteArrayView key = trimmedLine.first(colon).trimmed();
+            const QByteArrayView value = trimmedLine.sliced(colon + 1).trimmed();
+            if (value.isEmpty()) {
+                continue;
+            }
+            
+            if (key == "Title") {
+                track.setTitle(QString::fromUtf8(value));
+            } else if (key == "Language") {
+                track.setLanguage(QString::fromUtf8(value));
+            }
+        } else if (section == Section::Styles && !hasEvents) {
+            if (trimmedLine.startsWith("Style:")) {
+                ASSStyle style;
+                if (style.parseFromString(QString::fromUtf8(trimmedLine.sliced(6).trimmed()))) {
+                    styles[style.name] = style;
+                    qCDebug(assParser) << "Parsed style:" << style.name;
+                }
+            }
+        } else if (section == Section::Events && trimmedLine.startsWith("Dialogue:")) {
+            SubtitleEntry entry;
+            if (parseDialogueLine(trimmedLine, formats, fallbackFormat, entry)) {
+                track.addEntry(entry);
+                result.parsedEntries++;
+            } else {
+                result.skippedEntries++;
+                qCWarning(assParser) << "Failed to parse dialogue line:" << trimmedLine.left(50) << "...";
+            }
+            
+            // Check limits
+            if (result.parsedEntries >= maxEntries()) {
+                qCWarning(assParser) << "Reached maximum entries limit:" << maxEntries();
+                break;
+            }
+        }
+    }
     
-    // Validate parsed entries
-    int removedInvalid = track.validateEntries();
-    if (removedInvalid > 0) {
-        result.skippedEntries += removedInvalid;
-        result.parsedEntries -= removedInvalid;
+    if (!hasEvents) {
+        result.errorMessage = "Failed to parse ASS sections";
+        return SubtitleTrack();
     }
     
-    result.success = result.parsedEntries > 0;
-    if (!result.success && result.errorMessage.isEmpty()) {
-        result.errorMessage = "No valid subtitle entries found";
+    if (result.parsedEntries == 0) {
+        result.errorMessage = "Failed to parse ASS events";
+        return SubtitleTrack();
     }
     
+    finalizeTrack(track, result);
+    
     qCDebug(assParser) << "ASS parsing completed:" << result.summary();
     
     return track;
 }
 
+bool ASSParser::parseDialogueLine(QByteArrayView dialogueLine, const QHash<QString, SubtitleFormat>& formats,
+                                 const SubtitleFormat& fallbackFormat, SubtitleEntry& entry) const
+{
+    // Dialogue format: Dialogue: Layer,Start,End,Style,Name,MarginL,MarginR,MarginV,Effect,Text
+    QByteArrayView data = dialogueLine.sliced(9).trimmed(); // Remove "Dialogue:"
+    
+    // Text is everything after the ninth comma and may contain commas
+    QByteArrayView fields[9];
+    for (QByteArrayView& field : fields) {
+        const qsizetype comma = data.indexOf(',');
+        if (comma < 0) {
+            qCWarning(assParser) << "Invalid dialogue format - not enough fields";
+            return false;
+        }
+        field = data.first(comma);
+        data = data.sliced(comma + 1);
+    }
+    
+    // Parse timing
+    qint64 startTime = SubtitleBuffer::parseTimestamp(fields[1]);
+    qint64 endTime = SubtitleBuffer::parseTimestamp(fields[2]);
+    
+    if (startTime < 0 || endTime < 0 || endTime <= startTime) {
+        qCWarning(assParser) << "Invalid timing in dialogue line";
+        return false;
+    }
+    
+    QString text = QString::fromUtf8(data.trimmed());
+    
+    // Suspicious patterns were rejected for the whole buffer
+    if (text.length() > MAX_TEXT_LENGTH) {
+        qCWarning(assParser) << "Unsafe subtitle text detected";
+        return false;
+    }
+    
+    // Get style
+    const QString styleName = QString::fromUtf8(fields[3].trimmed());
+    SubtitleFormat format = formats.value(styleName, fallbackFormat);
+    
+    if (text.contains(QLatin1Char('{')) || text.contains(QLatin1Char('\\'))) {
+        text = parseOverrideCodes(text, format);
+    }
+    
+    // Create entry
+    entry = SubtitleEntry(startTime, endTime, text, format);
+    entry.setLayer(fields[0].trimmed().toInt());
+    entry.setStyle(styleName);
+    entry.setActor(QString::fromUtf8(fields[4].trimmed()));
+    entry.setEffect(QString::fromUtf8(fields[8].trimmed()));
+    
+    return entry.isValid();
+}
+
 bool ASSParser::parseSections(const QString& content, QString& scriptInfo, QString& styles, QString& events) const
 {
     // Split content into sections
@@ -448,16 +622,29 @@ bool ASSParser::parseDialogueLine(const QString& dialogueLine, const QHash<QStri
 
 QString ASSParser::parseOverrideCodes(const QString& text, SubtitleFormat& baseFormat) const
 {
-    QString plainText = text;
-    
-    // Remove ASS override codes like {\b1}, {\i1}, etc.
-    // This is a simplified implementation
-    QRegularExpression overrideRegex("\\{[^}]*\\}");
-    plainText.remove(overrideRegex);
-    
-    // Remove line breaks
-    plainText.replace("\\N", "\n");
-    plainText.replace("\\n", "\n");
+    Q_UNUSED(baseFormat)
+    
+    // Remove ASS override codes like {\b1}, {\i1}, etc. and turn \N and \n
+    // into line breaks; an unclosed brace is kept as text
+    QString plainText;
+    plainText.reserve(text.size());
+    
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        const QChar ch = text.at(i);
+        if (ch == QLatin1Char('{')) {
+            const qsizetype close = text.indexOf(QLatin1Char('}'), i + 1);
+            if (close >= 0) {
+                i = close;
+                continue;
+            }
+        } else if (ch == QLatin1Char('\\') && i + 1 < text.size() &&
+                   (text.at(i + 1) == QLatin1Char('N') || text.at(i + 1) == QLatin1Char('n'))) {
+            plainText += QLatin1Char('\n');
+            ++i;
+            continue;
+        }
+        plainText += ch;
+    }
     
     return plainText.trimmed();
 }
@@ -29,6 +29,7 @@ BaseSubtitleParser::BaseSubtitleParser()
     m_suspiciousPatterns << "javascript:" << "vbscript:" << "<script" << "</script>"
                         << "eval(" << "document." << "window." << "alert("
                         << "file://" << "ftp://" << "data:" << "blob:";
+    m_suspiciousScanner = PatternScanner::fromStrings(m_suspiciousPatterns, Qt::CaseInsensitive);
     
     // Initialize allowed HTML-like tags for subtitles
     m_allowedTags << "b" << "i" << "u" << "s" << "font" << "color" << "size"
@@ -36,6 +37,23 @@ BaseSubtitleParser::BaseSubtitleParser()
 }
 
 bool BaseSubtitleParser::validateFile(const QString& filePath) const
+{
+    if (!validateFileInfo(filePath)) {
+        return false;
+    }
+    
+    // Read and validate content
+    QString encoding;
+    QString content = readFileContent(filePath, encoding);
+    if (content.isEmpty()) {
+        qCWarning(subtitleParser) << "Could not read subtitle file:" << filePath;
+        return false;
+    }
+    
+    return validateContent(content);
+}
+
+bool BaseSubtitleParser::validateFileInfo(const QString& filePath) const
 {
     QFileInfo fileInfo(filePath);
     
@@ -58,15 +76,7 @@ bool BaseSubtitleParser::validateFile(const QString& filePath) const
         return false;
     }
     
-    // Read and validate content
-    QString encoding;
-    QString content = readFileContent(filePath, encoding);
-    if (content.isEmpty()) {
-        qCWarning(subtitleParser) << "Could not read subtitle file:" << filePath;
-        return false;
-    }
-    
-    return validateContent(content);
+    return true;
 }
 
 bool BaseSubtitleParser::validateContent(const QString& content) const
@@ -82,12 +92,10 @@ bool BaseSubtitleParser::validateContent(const QString& content) const
     }
     
     // Check for suspicious patterns
-    QString lowerContent = content.toLower();
-    for (const QString& pattern : m_suspiciousPatterns) {
-        if (lowerContent.contains(pattern)) {
-            qCWarning(subtitleParser) << "Suspicious content detected:" << pattern;
-            return false;
-        }
+    const int pattern = m_suspiciousScanner.findFirst(content);
+    if (pattern >= 0) {
+        qCWarning(subtitleParser) << "Suspicious content detected:" << m_suspiciousPatterns.at(pattern);
+        return false;
     }
     
     // Check for excessive HTML tags (potential XSS)
@@ -106,6 +114,55 @@ bool BaseSubtitleParser::validateContent(const QString& content) const
     return true;
 }
 
+bool BaseSubtitleParser::validateBuffer(QByteArrayView data) const
+{
+    if (data.isEmpty() || data.size() > m_maxFileSize) {
+        return false;
+    }
+    
+    // Patterns are ASCII, so scanning the bytes matches scanning the text
+    const int pattern = m_suspiciousScanner.findFirst(data);
+    if (pattern >= 0) {
+        qCWarning(subtitleParser) << "Suspicious content detected:" << m_suspiciousPatterns.at(pattern);
+        return false;
+    }
+    
+    // Same count as the <[^>]*> scan in validateContent()
+    int tagCount = 0;
+    qsizetype position = data.indexOf('<');
+    while (position >= 0) {
+        const qsizetype end = data.indexOf('>', position + 1);
+        if (end < 0) {
+            break;
+        }
+        if (++tagCount > 1000) {
+            qCWarning(subtitleParser) << "Too many HTML tags in subtitle content";
+            return false;
+        }
+        position = data.indexOf('<', end + 1);
+    }
+    
+    return true;
+}
+
+void BaseSubtitleParser::finalizeTrack(SubtitleTrack& track, SubtitleParseResult& result) const
+{
+    // Sort entries by time
+    track.sortByTime();
+    
+    // Validate parsed entries
+    int removedInvalid = track.validateEntries();
+    if (removedInvalid > 0) {
+        result.skippedEntries += removedInvalid;
+        result.parsedEntries -= removedInvalid;
+    }
+    
+    result.success = result.parsedEntries > 0;
+    if (!result.success && result.errorMessage.isEmpty()) {
+        result.errorMessage = "No valid subtitle entries found";
+    }
+}
+
 QString BaseSubtitleParser::detectEncoding(const QString& filePath) const
 {
     QFile file(filePath);
@@ -202,15 +259,12 @@ QString BaseSubtitleParser::sanitizeText(const QString& text) const
 bool BaseSubtitleParser::isSafeText(const QString& text) const
 {
     // Check for suspicious patterns
-    QString lowerText = text.toLower();
-    for (const QString& pattern : m_suspiciousPatterns) {
-        if (lowerText.contains(pattern)) {
-            return false;
-        }
+    if (m_suspiciousScanner.containsAny(text)) {
+        return false;
     }
     
     // Check for excessive length
-    if (text.length() > 10000) { // 10k characters per subtitle entry
+    if (text.length() > MAX_TEXT_LENGTH) {
         return false;
     }
     
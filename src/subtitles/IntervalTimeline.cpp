@@ -0,0 +1,147 @@
+#include "subtitles/IntervalTimeline.h"
+#include <algorithm>
+#include <climits>
+
+void IntervalTimeline::build(const QVector<qint64>& starts, const QVector<qint64>& ends)
+{
+    clear();
+    const int count = starts.size();
+
+    m_byStart.resize(count);
+    for (int i = 0; i < count; ++i) {
+        m_byStart[i] = i;
+    }
+    std::stable_sort(m_byStart.begin(), m_byStart.end(), [&starts](int a, int b) {
+        return starts[a] < starts[b];
+    });
+
+    m_starts.resize(count);
+    m_ends.resize(count);
+    for (int i = 0; i < count; ++i) {
+        m_starts[i] = starts[m_byStart[i]];
+        m_ends[i] = ends[m_byStart[i]];
+    }
+
+    m_leafCount = 1;
+    while (m_leafCount < count) {
+        m_leafCount *= 2;
+    }
+
+    m_maxEnd.fill(LLONG_MIN, 2 * m_leafCount);
+    for (int i = 0; i < count; ++i) {
+        m_maxEnd[m_leafCount + i] = m_ends[i];
+    }
+    for (int node = m_leafCount - 1; node > 0; --node) {
+        m_maxEnd[node] = qMax(m_maxEnd[2 * node], m_maxEnd[2 * node + 1]);
+    }
+}
+
+void IntervalTimeline::clear()
+{
+    m_byStart.clear();
+    m_starts.clear();
+    m_ends.clear();
+    m_maxEnd.clear();
+    m_leafCount = 0;
+    m_cursorValid = false;
+    m_nextStart = 0;
+    m_active.clear();
+}
+
+QVector<int> IntervalTimeline::activeAt(qint64 time)
+{
+    if (isEmpty()) {
+        return {};
+    }
+
+    if (!m_cursorValid || time < m_cursorTime) {
+        seek(time);
+    } else {
+        // Playback moves forward: drop what ended, pick up what started
+        m_active.erase(std::remove_if(m_active.begin(), m_active.end(),
+                                      [this, time](int position) {
+                                          return m_ends[position] < time;
+                                      }),
+                       m_active.end());
+
+        int passed = 0;
+        while (m_nextStart < m_starts.size() && m_starts[m_nextStart] <= time) {
+            if (++passed > SWEEP_LIMIT) {
+                seek(time);
+                break;
+            }
+            if (m_ends[m_nextStart] >= time) {
+                m_active.append(m_nextStart);
+            }
+            ++m_nextStart;
+        }
+        m_cursorTime = time;
+    }
+
+    // Report in item order, as a plain scan of the items would
+    QVector<int> items;
+    items.reserve(m_active.size());
+    for (int position : std::as_const(m_active)) {
+        items.append(m_byStart[position]);
+    }
+    std::sort(items.begin(), items.end());
+
+    return items;
+}
+
+int IntervalTimeline::nextAfter(qint64 time) const
+{
+    // Ties in start time keep item order, so this is the first such item
+    const int position = upperBoundStart(time);
+    return position < m_byStart.size() ? m_byStart[position] : -1;
+}
+
+int IntervalTimeline::previousBefore(qint64 time) const
+{
+    const int position = lowerBoundStart(time);
+    if (position == 0) {
+        return -1;
+    }
+
+    // First item in item order among those with the latest earlier start
+    return m_byStart[lowerBoundStart(m_starts[position - 1])];
+}
+
+void IntervalTimeline::seek(qint64 time)
+{
+    m_nextStart = upperBoundStart(time);
+    m_active.clear();
+    collectActive(1, 0, m_leafCount, m_nextStart, time);
+
+    m_cursorTime = time;
+    m_cursorValid = true;
+}
+
+void IntervalTimeline::collectActive(int node, int low, int high, int limit, qint64 time)
+{
+    // Only subtrees that start by 'time' and still run at 'time' are visited
+    if (low >= limit || m_maxEnd[node] < time) {
+        return;
+    }
+
+    if (node >= m_leafCount) {
+        m_active.append(low);
+        return;
+    }
+
+    const int middle = (low + high) / 2;
+    collectActive(2 * node, low, middle, limit, time);
+    collectActive(2 * node + 1, middle, high, limit, time);
+}
+
+int IntervalTimeline::upperBoundStart(qint64 time) const
+{
+    return static_cast<int>(std::upper_bound(m_starts.constBegin(), m_starts.constEnd(), time) -
+                            m_starts.constBegin());
+}
+
+int IntervalTimeline::lowerBoundStart(qint64 time) const
+{
+    return static_cast<int>(std::lower_bound(m_starts.constBegin(), m_starts.constEnd(), time) -
+                            m_starts.constBegin());
+}
@@ -1,4 +1,5 @@
 #include "subtitles/SRTParser.h"
+#include "subtitles/SubtitleBuffer.h"
 #include <QFileInfo>
 #include <QRegularExpression>
 #include <QStringList>
@@ -44,6 +45,31 @@ SubtitleTrack SRTParser::parseFile(const QString& filePath, SubtitleParseResult&
 {
     result = SubtitleParseResult();
     
+    if (!validateFileInfo(filePath)) {
+        result.errorMessage = "File validation failed";
+        return SubtitleTrack();
+    }
+    
+    // UTF-8 files are parsed straight from the mapping
+    SubtitleBuffer buffer;
+    if (!buffer.open(filePath, maxFileSize())) {
+        result.errorMessage = "Could not read file content";
+        return SubtitleTrack();
+    }
+    
+    if (buffer.isUtf8()) {
+        if (!validateBuffer(buffer.data())) {
+            result.errorMessage = "File validation failed";
+            return SubtitleTrack();
+        }
+        
+        result.detectedEncoding = "UTF-8";
+        result.detectedFormat = "SRT";
+        return parseBuffer(buffer.data(), result);
+    }
+    buffer.close();
+    
+    // Other encodings are decoded first
     // Validate file
     if (!validateFile(filePath)) {
         result.errorMessage = "File validation failed";
@@ -105,26 +131,151 @@ SubtitleTrack SRTParser::parseContent(const QString& content, SubtitleParseResul
         }
     }
     
-    // Sort entries by time
-    track.sortByTime();
+    finalizeTrack(track, result);
     
-    // Validate parsed entries
-    int removedInvalid = track.validateEntries();
-    if (removedInvalid > 0) {
-        result.skippedEntries += removedInvalid;
-        result.parsedEntries -= removedInvalid;
+    qCDebug(srtParser) << "SRT parsing completed:" << result.summary();
+    
+    return track;
+}
+
+SubtitleTrack SRTParser::parseBuffer(QByteArrayView data, SubtitleParseResult& result) const
+{
+    SubtitleTrack track("SRT Subtitles");
+    track.setFormat("SRT");
+    
+    // Counted as isValidSRTStructure() does, but during the single pass
+    int sequenceCount = 0;
+    int timingCount = 0;
+    
+    BlockLines block;
+    QByteArrayView rest = data;
+    QByteArrayView line;
+    bool more = true;
+    
+    while (more) {
+        more = SubtitleBuffer::nextLine(rest, line);
+        const QByteArrayView trimmedLine = more ? line.trimmed() : QByteArrayView();
+        
+        if (!trimmedLine.isEmpty()) {
+            if (SubtitleBuffer::isNumber(line)) {
+                sequenceCount++;
+            } else if (trimmedLine.contains("-->")) {
+                timingCount++;
+            }
+            block.append(trimmedLine);
+            continue;
+        }
+        
+        // Blank line or end of data: the block is complete
+        if (block.isEmpty()) {
+            continue;
+        }
+        
+        SubtitleEntry entry;
+        if (parseBlock(block, entry)) {
+            track.addEntry(entry);
+            result.parsedEntries++;
+        } else {
+            result.skippedEntries++;
+            qCWarning(srtParser) << "Failed to parse subtitle block:" << block.first().left(50) << "...";
+        }
+        block.clear();
+        
+        // Check limits
+        if (result.parsedEntries >= maxEntries()) {
+            qCWarning(srtParser) << "Reached maximum entries limit:" << maxEntries();
+            break;
+        }
     }
     
-    result.success = result.parsedEntries > 0;
-    if (!result.success && result.errorMessage.isEmpty()) {
-        result.errorMessage = "No valid subtitle entries found";
+    if (sequenceCount == 0 || timingCount == 0) {
+        result.errorMessage = "Invalid SRT format structure";
+        return SubtitleTrack();
     }
     
+    double ratio = static_cast<double>(sequenceCount) / timingCount;
+    if (ratio < 0.8 || ratio > 1.2) {
+        qCWarning(srtParser) << "SRT structure validation failed - sequence/timing ratio:" << ratio;
+        result.errorMessage = "Invalid SRT format structure";
+        return SubtitleTrack();
+    }
+    
+    finalizeTrack(track, result);
+    
     qCDebug(srtParser) << "SRT parsing completed:" << result.summary();
     
     return track;
 }
 
+bool SRTParser::parseBlock(const BlockLines& lines, SubtitleEntry& entry) const
+{
+    if (lines.size() < 3) {
+        qCWarning(srtParser) << "Subtitle block has too few lines:" << lines.size();
+        return false;
+    }
+    
+    // First line should be sequence number
+    bool ok;
+    int sequenceNumber = lines[0].toInt(&ok);
+    if (!ok || sequenceNumber <= 0) {
+        qCWarning(srtParser) << "Invalid sequence number:" << lines[0];
+        return false;
+    }
+    
+    // Second line should be timing
+    qint64 startTime, endTime;
+    if (!parseTimingLine(lines[1], startTime, endTime)) {
+        qCWarning(srtParser) << "Invalid timing line:" << lines[1];
+        return false;
+    }
+    
+    // Remaining lines are subtitle text; only this part is decoded
+    QString text = QString::fromUtf8(lines[2]);
+    for (int i = 3; i < lines.size(); ++i) {
+        text += QLatin1Char('\n');
+        text += QString::fromUtf8(lines[i]);
+    }
+    
+    // Suspicious patterns were rejected for the whole buffer
+    if (text.length() > MAX_TEXT_LENGTH) {
+        qCWarning(srtParser) << "Unsafe subtitle text detected";
+        return false;
+    }
+    
+    // Most lines carry no tags or entities
+    SubtitleFormat format;
+    if (text.contains(QLatin1Char('<')) || text.contains(QLatin1Char('&'))) {
+        text = parseSRTFormatting(text, format);
+    }
+    
+    // Create entry
+    entry = SubtitleEntry(startTime, endTime, text, format);
+    
+    return entry.isValid();
+}
+
+bool SRTParser::parseTimingLine(QByteArrayView timingLine, qint64& startTime, qint64& endTime)
+{
+    // SRT timing format: 00:00:20,000 --> 00:00:24,400 [X1:... position]
+    const qsizetype arrow = timingLine.indexOf("-->");
+    if (arrow < 0) {
+        return false;
+    }
+    
+    QByteArrayView endField = timingLine.sliced(arrow + 3).trimmed();
+    for (qsizetype i = 0; i < endField.size(); ++i) {
+        if (endField[i] == ' ' || endField[i] == '\t') {
+            endField.truncate(i);
+            break;
+        }
+    }
+    
+    startTime = SubtitleBuffer::parseTimestamp(timingLine.first(arrow));
+    endTime = SubtitleBuffer::parseTimestamp(endField);
+    
+    return startTime >= 0 && endTime > startTime;
+}
+
 bool SRTParser::parseSubtitleBlock(const QString& block, SubtitleEntry& entry) const
 {
     if (block.isEmpty()) {
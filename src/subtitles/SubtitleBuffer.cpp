@@ -0,0 +1,171 @@
+#include "subtitles/SubtitleBuffer.h"
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(subtitleBuffer, "eonplay.subtitles.buffer")
+
+namespace {
+
+bool isDigit(char ch)
+{
+    return ch >= '0' && ch <= '9';
+}
+
+// Reads exactly two digits at position, advancing it
+int readTwoDigits(QByteArrayView text, qsizetype& position)
+{
+    if (position + 1 >= text.size() || !isDigit(text[position]) || !isDigit(text[position + 1])) {
+        return -1;
+    }
+
+    const int value = (text[position] - '0') * 10 + (text[position + 1] - '0');
+    position += 2;
+    return value;
+}
+
+} // namespace
+
+SubtitleBuffer::~SubtitleBuffer()
+{
+    close();
+}
+
+bool SubtitleBuffer::open(const QString& filePath, qint64 maxSize)
+{
+    close();
+
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qCWarning(subtitleBuffer) << "Cannot open subtitle file:" << filePath;
+        return false;
+    }
+
+    const qint64 size = m_file.size();
+    if (size <= 0 || size > maxSize) {
+        qCWarning(subtitleBuffer) << "Subtitle file size out of range:" << size << "bytes";
+        close();
+        return false;
+    }
+
+    m_mapped = m_file.map(0, size);
+    if (m_mapped) {
+        m_data = QByteArrayView(reinterpret_cast<const char*>(m_mapped), size);
+    } else {
+        // Some file systems cannot be mapped
+        m_content = m_file.readAll();
+        m_data = m_content;
+    }
+
+    if (m_data.startsWith("\xEF\xBB\xBF")) {
+        m_data = m_data.sliced(3);
+    } else if (m_data.startsWith("\xFF\xFE") || m_data.startsWith("\xFE\xFF") ||
+               m_data.startsWith(QByteArrayView("\x00\x00\xFE\xFF", 4))) {
+        m_utf8 = false;
+    }
+
+    return true;
+}
+
+void SubtitleBuffer::close()
+{
+    if (m_mapped) {
+        m_file.unmap(m_mapped);
+        m_mapped = nullptr;
+    }
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+
+    m_content.clear();
+    m_data = QByteArrayView();
+    m_utf8 = true;
+}
+
+bool SubtitleBuffer::nextLine(QByteArrayView& rest, QByteArrayView& line)
+{
+    if (rest.isEmpty()) {
+        return false;
+    }
+
+    const qsizetype end = rest.indexOf('\n');
+    if (end < 0) {
+        line = rest;
+        rest = QByteArrayView();
+    } else {
+        line = rest.first(end);
+        rest = rest.sliced(end + 1);
+    }
+
+    if (line.endsWith('\r')) {
+        line.chop(1);
+    }
+
+    return true;
+}
+
+qint64 SubtitleBuffer::parseTimestamp(QByteArrayView text)
+{
+    text = text.trimmed();
+
+    // Hours: one or more digits
+    qsizetype position = 0;
+    qint64 hours = 0;
+    while (position < text.size() && isDigit(text[position]) && position < 4) {
+        hours = hours * 10 + (text[position] - '0');
+        ++position;
+    }
+    if (position == 0 || position >= text.size() || text[position] != ':') {
+        return -1;
+    }
+    ++position;
+
+    const int minutes = readTwoDigits(text, position);
+    if (minutes < 0 || minutes >= 60 || position >= text.size() || text[position] != ':') {
+        return -1;
+    }
+    ++position;
+
+    const int seconds = readTwoDigits(text, position);
+    if (seconds < 0 || seconds >= 60) {
+        return -1;
+    }
+
+    // Fraction: up to three digits count, SRT uses ms and ASS centiseconds
+    int milliseconds = 0;
+    if (position < text.size()) {
+        if (text[position] != ',' && text[position] != '.') {
+            return -1;
+        }
+        ++position;
+
+        int digits = 0;
+        int scale = 100;
+        while (position < text.size() && isDigit(text[position])) {
+            if (digits < 3) {
+                milliseconds += (text[position] - '0') * scale;
+                scale /= 10;
+            }
+            ++digits;
+            ++position;
+        }
+        if (digits == 0 || position != text.size()) {
+            return -1;
+        }
+    }
+
+    return hours * 3600000 + minutes * 60000 + seconds * 1000 + milliseconds;
+}
+
+bool SubtitleBuffer::isNumber(QByteArrayView text)
+{
+    if (text.isEmpty()) {
+        return false;
+    }
+
+    for (char ch : text) {
+        if (!isDigit(ch)) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -2,6 +2,9 @@
 #include <QRegularExpression>
 #include <QStringList>
 #include <QLoggingCategory>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 
 Q_LOGGING_CATEGORY(subtitleEntry, "eonplay.subtitles.entry")
 
@@ -189,7 +192,76 @@ qint64 SubtitleEntry::parseTimeASS(const QString& timeStr)
            static_cast<qint64>(centiseconds) * 10;
 }
 
+// SubtitleStyleTable Implementation
+size_t qHash(const SubtitleFormat& format, size_t seed)
+{
+    return qHashMulti(seed, format.font.key(), format.textColor.rgba(), format.backgroundColor.rgba(),
+                      format.outlineColor.rgba(), format.outlineWidth, format.bold, format.italic,
+                      format.underline, format.strikethrough, int(format.alignment), format.marginLeft,
+                      format.marginRight, format.marginTop, format.marginBottom);
+}
+
+SubtitleStyleTable::SubtitleStyleTable()
+{
+    clear();
+}
+
+int SubtitleStyleTable::internFormat(const SubtitleFormat& format)
+{
+    const auto it = m_formatIndex.constFind(format);
+    if (it != m_formatIndex.constEnd()) {
+        return it.value();
+    }
+    
+    m_formats.append(format);
+    m_formatIndex.insert(format, m_formats.size() - 1);
+    return m_formats.size() - 1;
+}
+
+int SubtitleStyleTable::internName(const QString& name)
+{
+    const auto it = m_nameIndex.constFind(name);
+    if (it != m_nameIndex.constEnd()) {
+        return it.value();
+    }
+    
+    m_names.append(name);
+    m_nameIndex.insert(name, m_names.size() - 1);
+    return m_names.size() - 1;
+}
+
+void SubtitleStyleTable::clear()
+{
+    m_formats.clear();
+    m_formatIndex.clear();
+    m_names.clear();
+    m_nameIndex.clear();
+    internFormat(SubtitleFormat());
+    internName(QString());
+}
+
+// SubtitleEntryView Implementation
+SubtitleEntry SubtitleEntryView::toEntry() const
+{
+    if (!m_track) {
+        return SubtitleEntry();
+    }
+    
+    SubtitleEntry entry(startTime(), endTime(), text().toString(), format());
+    entry.setId(id());
+    entry.setPosition(position());
+    entry.setLayer(layer());
+    entry.setStyle(style());
+    entry.setActor(actor());
+    entry.setEffect(effect());
+    return entry;
+}
+
 // SubtitleTrack Implementation
+namespace {
+std::atomic<quint64> nextEntryId{1};
+}
+
 SubtitleTrack::SubtitleTrack(const QString& title, const QString& language)
     : m_title(title)
     , m_language(language)
@@ -198,93 +270,167 @@ SubtitleTrack::SubtitleTrack(const QString& title, const QString& language)
 
 void SubtitleTrack::addEntry(const SubtitleEntry& entry)
 {
-    if (entry.isValid()) {
-        m_entries.append(entry);
-    } else {
+    if (!entry.isValid()) {
         qCWarning(subtitleEntry) << "Attempted to add invalid subtitle entry";
+        return;
     }
+    
+    Event event;
+    event.id = nextEntryId.fetch_add(1, std::memory_order_relaxed);
+    event.startTime = toStoredTime(entry.startTime());
+    event.endTime = toStoredTime(entry.endTime());
+    event.textOffset = m_text.size();
+    event.textLength = entry.text().size();
+    event.position = entry.position();
+    event.layer = entry.layer();
+    event.format = m_styles.internFormat(entry.format());
+    event.style = m_styles.internName(entry.style());
+    event.actor = m_styles.internName(entry.actor());
+    event.effect = m_styles.internName(entry.effect());
+    
+    m_text += entry.text();
+    m_events.append(event);
+    invalidateIndex();
 }
 
 void SubtitleTrack::removeEntry(int index)
 {
-    if (index >= 0 && index < m_entries.size()) {
-        m_entries.removeAt(index);
+    if (index >= 0 && index < m_events.size()) {
+        m_events.removeAt(index);
+        invalidateIndex();
     }
 }
 
 void SubtitleTrack::clearEntries()
 {
-    m_entries.clear();
+    m_events.clear();
+    m_text.clear();
+    m_styles.clear();
+    m_timeScale = 1.0;
+    m_timeShift = 0.0;
+    invalidateIndex();
+}
+
+QList<SubtitleEntry> SubtitleTrack::entries() const
+{
+    QList<SubtitleEntry> entries;
+    entries.reserve(m_events.size());
+    for (int i = 0; i < m_events.size(); ++i) {
+        entries.append(view(i).toEntry());
+    }
+    return entries;
 }
 
 SubtitleEntry SubtitleTrack::entryAt(int index) const
 {
-    if (index >= 0 && index < m_entries.size()) {
-        return m_entries.at(index);
+    return view(index).toEntry();   // Invalid entry if out of range
+}
+
+SubtitleEntryView SubtitleTrack::view(int index) const
+{
+    if (index >= 0 && index < m_events.size()) {
+        return SubtitleEntryView(this, index);
     }
-    return SubtitleEntry(); // Invalid entry
+    return SubtitleEntryView();
 }
 
 QList<SubtitleEntry> SubtitleTrack::getActiveEntries(qint64 time) const
 {
     QList<SubtitleEntry> activeEntries;
     
-    for (const SubtitleEntry& entry : m_entries) {
-        if (entry.isActiveAt(time)) {
-            activeEntries.append(entry);
-        }
+    const QVector<int> entryIndices = activeIndices(time);
+    activeEntries.reserve(entryIndices.size());
+    for (int entryIndex : entryIndices) {
+        activeEntries.append(SubtitleEntryView(this, entryIndex).toEntry());
     }
     
     return activeEntries;
 }
 
-SubtitleEntry SubtitleTrack::getNextEntry(qint64 time) const
+QVector<SubtitleEntryView> SubtitleTrack::getActiveViews(qint64 time) const
 {
-    SubtitleEntry nextEntry;
-    qint64 minStartTime = LLONG_MAX;
+    QVector<SubtitleEntryView> views;
     
-    for (const SubtitleEntry& entry : m_entries) {
-        if (entry.startTime() > time && entry.startTime() < minStartTime) {
-            minStartTime = entry.startTime();
-            nextEntry = entry;
-        }
+    const QVector<int> entryIndices = activeIndices(time);
+    views.reserve(entryIndices.size());
+    for (int entryIndex : entryIndices) {
+        views.append(SubtitleEntryView(this, entryIndex));
     }
     
-    return nextEntry;
+    return views;
 }
 
-SubtitleEntry SubtitleTrack::getPreviousEntry(qint64 time) const
+QVector<quint64> SubtitleTrack::getActiveEntryIds(qint64 time) const
 {
-    SubtitleEntry previousEntry;
-    qint64 maxStartTime = -1;
+    QVector<quint64> ids;
     
-    for (const SubtitleEntry& entry : m_entries) {
-        if (entry.startTime() < time && entry.startTime() > maxStartTime) {
-            maxStartTime = entry.startTime();
-            previousEntry = entry;
-        }
+    const QVector<int> entryIndices = activeIndices(time);
+    ids.reserve(entryIndices.size());
+    for (int entryIndex : entryIndices) {
+        ids.append(m_events.at(entryIndex).id);
     }
     
-    return previousEntry;
+    return ids;
+}
+
+QVector<int> SubtitleTrack::activeIndices(qint64 time) const
+{
+    ensureIndex();
+    return m_index.activeAt(toStoredTime(time));
+}
+
+void SubtitleTrack::ensureIndex() const
+{
+    if (m_indexValid) {
+        return;
+    }
+    
+    QVector<qint64> starts;
+    QVector<qint64> ends;
+    starts.reserve(m_events.size());
+    ends.reserve(m_events.size());
+    for (const Event& event : m_events) {
+        starts.append(event.startTime);
+        ends.append(event.endTime);
+    }
+    
+    m_index.build(starts, ends);
+    m_indexValid = true;
+}
+
+SubtitleEntry SubtitleTrack::getNextEntry(qint64 time) const
+{
+    ensureIndex();
+    
+    return view(m_index.nextAfter(toStoredTime(time))).toEntry();
+}
+
+SubtitleEntry SubtitleTrack::getPreviousEntry(qint64 time) const
+{
+    ensureIndex();
+    
+    return view(m_index.previousBefore(toStoredTime(time))).toEntry();
 }
 
 void SubtitleTrack::sortByTime()
 {
-    std::sort(m_entries.begin(), m_entries.end(), 
-              [](const SubtitleEntry& a, const SubtitleEntry& b) {
-        return a.startTime() < b.startTime();
+    std::stable_sort(m_events.begin(), m_events.end(), [](const Event& a, const Event& b) {
+        return a.startTime < b.startTime;
     });
+    invalidateIndex();
 }
 
 int SubtitleTrack::validateEntries()
 {
-    int removedCount = 0;
+    // Text was checked when added; timing may have changed since
+    const auto invalid = std::remove_if(m_events.begin(), m_events.end(), [](const Event& event) {
+        return event.startTime < 0 || event.endTime <= event.startTime;
+    });
+    const int removedCount = static_cast<int>(m_events.end() - invalid);
+    m_events.erase(invalid, m_events.end());
     
-    for (int i = m_entries.size() - 1; i >= 0; --i) {
-        if (!m_entries[i].isValid()) {
-            m_entries.removeAt(i);
-            removedCount++;
-        }
+    if (removedCount > 0) {
+        invalidateIndex();
     }
     
     return removedCount;
@@ -292,35 +438,17 @@ int SubtitleTrack::validateEntries()
 
 qint64 SubtitleTrack::totalDuration() const
 {
-    if (m_entries.isEmpty()) {
-        return 0;
-    }
-    
     qint64 maxEndTime = 0;
-    for (const SubtitleEntry& entry : m_entries) {
-        if (entry.endTime() > maxEndTime) {
-            maxEndTime = entry.endTime();
-        }
+    for (const Event& event : m_events) {
+        maxEndTime = qMax(maxEndTime, event.endTime);
     }
     
-    return maxEndTime;
+    return m_events.isEmpty() ? 0 : toDisplayTime(maxEndTime);
 }
 
 void SubtitleTrack::shiftTiming(qint64 offsetMs)
 {
-    for (SubtitleEntry& entry : m_entries) {
-        qint64 newStartTime = entry.startTime() + offsetMs;
-        qint64 newEndTime = entry.endTime() + offsetMs;
-        
-        // Ensure times don't go negative
-        if (newStartTime < 0) {
-            newEndTime -= newStartTime; // Adjust end time to maintain duration
-            newStartTime = 0;
-        }
-        
-        entry.setStartTime(newStartTime);
-        entry.setEndTime(newEndTime);
-    }
+    m_timeShift += offsetMs;
 }
 
 void SubtitleTrack::scaleTiming(double factor)
@@ -330,11 +458,30 @@ void SubtitleTrack::scaleTiming(double factor)
         return;
     }
     
-    for (SubtitleEntry& entry : m_entries) {
-        qint64 newStartTime = static_cast<qint64>(entry.startTime() * factor);
-        qint64 newEndTime = static_cast<qint64>(entry.endTime() * factor);
-        
-        entry.setStartTime(newStartTime);
-        entry.setEndTime(newEndTime);
+    // Scales displayed time, so a pending shift scales with it
+    m_timeScale *= factor;
+    m_timeShift *= factor;
+}
+
+void SubtitleTrack::bakeTiming()
+{
+    if (!hasTimingTransform()) {
+        return;
+    }
+    
+    for (Event& event : m_events) {
+        event.startTime = toDisplayTime(event.startTime);
+        event.endTime = toDisplayTime(event.endTime);
     }
-}
\ No newline at end of file
+    m_timeScale = 1.0;
+    m_timeShift = 0.0;
+    invalidateIndex();
+}
+
+qint64 SubtitleTrack::toStoredTime(qint64 displayTime) const
+{
+    if (!hasTimingTransform()) {
+        return displayTime;
+    }
+    return static_cast<qint64>(std::floor((displayTime - m_timeShift) / m_timeScale));
+}
@@ -1,9 +1,12 @@
 #include "subtitles/SubtitleManager.h"
 #include "subtitles/SRTParser.h"
 #include "subtitles/ASSParser.h"
+#include "DirectoryListingCache.h"
 #include <QFileInfo>
 #include <QDir>
 #include <QRegularExpression>
+#include <QThreadPool>
+#include <QMetaObject>
 #include <QLoggingCategory>
 
 Q_LOGGING_CATEGORY(subtitleManager, "eonplay.subtitles.manager")
@@ -33,8 +36,11 @@ SubtitleManager::SubtitleManager(QObject* parent)
     , m_currentPosition(0)
     , m_maxFileSize(10 * 1024 * 1024) // 10MB
     , m_maxEntries(50000) // 50k entries
+    , m_loadPool(new QThreadPool(this))
     , m_initialized(false)
 {
+    m_loadPool->setMaxThreadCount(LOADER_THREADS);
+    
     // Initialize malicious patterns for security
     m_maliciousPatterns << "javascript:" << "vbscript:" << "<script" << "</script>"
                        << "eval(" << "document." << "window." << "alert("
@@ -43,6 +49,7 @@ SubtitleManager::SubtitleManager(QObject* parent)
                        << "\\x" << "\\u" << "%3c" << "%3e" << "&#x" << "&#"
                        << "expression(" << "behavior:" << "binding:"
                        << "import(" << "require(" << "fetch(" << "XMLHttpRequest";
+    m_maliciousScanner = PatternScanner::fromStrings(m_maliciousPatterns, Qt::CaseInsensitive);
     
     // Initialize allowed HTML-like tags
     m_allowedTags << "b" << "i" << "u" << "s" << "font" << "color" << "size"
@@ -53,6 +60,10 @@ SubtitleManager::SubtitleManager(QObject* parent)
 
 SubtitleManager::~SubtitleManager()
 {
+    // Loader threads post their results back to this object
+    m_loadPool->clear();
+    m_loadPool->waitForDone();
+    
     qCDebug(subtitleManager) << "SubtitleManager destroyed";
 }
 
@@ -73,29 +84,36 @@ bool SubtitleManager::initialize()
 
 bool SubtitleManager::loadSubtitleFile(const QString& filePath, SubtitleLoadResult& result)
 {
-    result = SubtitleLoadResult();
+    const LoadedSubtitle loaded = parseSubtitleFile(filePath);
+    result = loaded.result;
+    
+    return addLoadedTrack(loaded) >= 0;
+}
+
+SubtitleManager::LoadedSubtitle SubtitleManager::parseSubtitleFile(const QString& filePath) const
+{
+    LoadedSubtitle loaded;
+    SubtitleLoadResult& result = loaded.result;
     result.filePath = filePath;
     
     // Validate file path
     QFileInfo fileInfo(filePath);
     if (!fileInfo.exists()) {
         result.errorMessage = "Subtitle file does not exist";
-        return false;
+        return loaded;
     }
     
     // Security validation
     if (!validateSubtitleFile(filePath)) {
         result.errorMessage = "Subtitle file failed security validation";
-        emit subtitleLoadFailed(filePath, result.errorMessage);
-        return false;
+        return loaded;
     }
     
     // Find appropriate parser
     ISubtitleParser* parser = SubtitleParserFactory::getParserForFile(filePath);
     if (!parser) {
         result.errorMessage = "No suitable parser found for subtitle format";
-        emit subtitleLoadFailed(filePath, result.errorMessage);
-        return false;
+        return loaded;
     }
     
     // Parse subtitle file
@@ -104,17 +122,14 @@ bool SubtitleManager::loadSubtitleFile(const QString& filePath, SubtitleLoadResu
     
     if (!parseResult.success) {
         result.errorMessage = parseResult.errorMessage;
-        emit subtitleLoadFailed(filePath, result.errorMessage);
-        return false;
+        return loaded;
     }
     
     // Additional security validation on parsed content
     for (int i = 0; i < track.entryCount(); ++i) {
-        SubtitleEntry entry = track.entryAt(i);
-        if (!checkMaliciousPatterns(entry.text())) {
+        if (!checkMaliciousPatterns(track.view(i).text().toString())) {
             result.errorMessage = "Malicious content detected in subtitle entry";
-            emit subtitleLoadFailed(filePath, result.errorMessage);
-            return false;
+            return loaded;
         }
     }
     
@@ -123,8 +138,26 @@ bool SubtitleManager::loadSubtitleFile(const QString& filePath, SubtitleLoadResu
         track.setTitle(fileInfo.baseName());
     }
     
+    // Fill result
+    result.success = true;
+    result.detectedFormat = parseResult.detectedFormat;
+    result.detectedEncoding = parseResult.detectedEncoding;
+    result.loadedEntries = parseResult.parsedEntries;
+    result.totalDuration = track.totalDuration();
+    loaded.track = track;
+    
+    return loaded;
+}
+
+int SubtitleManager::addLoadedTrack(const LoadedSubtitle& loaded)
+{
+    if (!loaded.result.success) {
+        emit subtitleLoadFailed(loaded.result.filePath, loaded.result.errorMessage);
+        return -1;
+    }
+    
     // Add track
-    m_tracks.append(track);
+    m_tracks.append(loaded.track);
     int trackIndex = m_tracks.size() - 1;
     
     // Set as active if it's the first track
@@ -132,18 +165,11 @@ bool SubtitleManager::loadSubtitleFile(const QString& filePath, SubtitleLoadResu
         setActiveTrack(trackIndex);
     }
     
-    // Fill result
-    result.success = true;
-    result.detectedFormat = parseResult.detectedFormat;
-    result.detectedEncoding = parseResult.detectedEncoding;
-    result.loadedEntries = parseResult.parsedEntries;
-    result.totalDuration = track.totalDuration();
+    emit subtitleTrackLoaded(trackIndex, loaded.track);
     
-    emit subtitleTrackLoaded(trackIndex, track);
+    qCDebug(subtitleManager) << "Subtitle file loaded:" << loaded.result.summary();
     
-    qCDebug(subtitleManager) << "Subtitle file loaded:" << result.summary();
-    
-    return true;
+    return trackIndex;
 }
 
 bool SubtitleManager::loadSubtitleContent(const QString& content, const QString& format, SubtitleLoadResult& result)
@@ -240,6 +266,7 @@ void SubtitleManager::setEnabled(bool enabled)
         if (!enabled) {
             // Clear active subtitles when disabled
             m_lastActiveSubtitles.clear();
+            m_lastActiveIds.clear();
             emit activeSubtitlesChanged(m_currentPosition, QList<SubtitleEntry>());
         } else {
             // Update active subtitles when re-enabled
@@ -266,11 +293,21 @@ QList<SubtitleEntry> SubtitleManager::getActiveSubtitles(qint64 time) const
     return activeEntries;
 }
 
+QVector<SubtitleEntryView> SubtitleManager::getActiveSubtitleViews(qint64 time) const
+{
+    if (!m_enabled || m_activeTrackIndex < 0 || m_activeTrackIndex >= m_tracks.size()) {
+        return QVector<SubtitleEntryView>();
+    }
+    
+    return m_tracks.at(m_activeTrackIndex).getActiveViews(time + m_timingOffset);
+}
+
 void SubtitleManager::clearSubtitles()
 {
     m_tracks.clear();
     m_activeTrackIndex = -1;
     m_lastActiveSubtitles.clear();
+    m_lastActiveIds.clear();
     
     emit activeTrackChanged(-1);
     emit activeSubtitlesChanged(m_currentPosition, QList<SubtitleEntry>());
@@ -356,36 +393,80 @@ void SubtitleManager::onPositionChanged(qint64 position)
         return;
     }
     
-    QList<SubtitleEntry> activeEntries = getActiveSubtitles(position);
-    
-    // Check if active subtitles changed
-    bool changed = (activeEntries.size() != m_lastActiveSubtitles.size());
-    if (!changed) {
-        for (int i = 0; i < activeEntries.size(); ++i) {
-            if (activeEntries[i].text() != m_lastActiveSubtitles[i].text() ||
-                activeEntries[i].startTime() != m_lastActiveSubtitles[i].startTime()) {
-                changed = true;
-                break;
-            }
-        }
+    // Compare ids first so ticks inside a cue copy no entries
+    QVector<quint64> activeIds;
+    if (m_activeTrackIndex >= 0 && m_activeTrackIndex < m_tracks.size()) {
+        activeIds = m_tracks.at(m_activeTrackIndex).getActiveEntryIds(position + m_timingOffset);
     }
     
-    if (changed) {
-        m_lastActiveSubtitles = activeEntries;
-        emit activeSubtitlesChanged(position, activeEntries);
+    if (activeIds == m_lastActiveIds) {
+        return;
     }
+    
+    m_lastActiveIds = activeIds;
+    m_lastActiveSubtitles = getActiveSubtitles(position);
+    emit activeSubtitlesChanged(position, m_lastActiveSubtitles);
 }
 
 void SubtitleManager::onMediaLoaded(const QString& mediaPath)
 {
-    // Auto-detect subtitle files
-    QStringList subtitleFiles = autoDetectSubtitles(mediaPath);
+    m_currentMediaPath = mediaPath;
+    
+    auto it = m_sidecars.constFind(mediaPath);
+    if (it == m_sidecars.constEnd()) {
+        startSidecarJob(mediaPath);
+        return;
+    }
+    
+    // Prefetched: what is parsed so far is added now, the rest as it arrives
+    for (const LoadedSubtitle& loaded : it.value()) {
+        addLoadedTrack(loaded);
+    }
+    
+    qCDebug(subtitleManager) << "Using" << it.value().size() << "prefetched subtitle tracks for" << mediaPath;
+}
+
+void SubtitleManager::prefetchSubtitles(const QString& mediaPath)
+{
+    if (mediaPath.isEmpty() || m_sidecars.contains(mediaPath)) {
+        return;
+    }
     
-    for (const QString& subtitleFile : subtitleFiles) {
-        SubtitleLoadResult result;
-        if (loadSubtitleFile(subtitleFile, result)) {
-            qCDebug(subtitleManager) << "Auto-loaded subtitle:" << result.summary();
+    startSidecarJob(mediaPath);
+}
+
+void SubtitleManager::startSidecarJob(const QString& mediaPath)
+{
+    m_sidecars.insert(mediaPath, QList<LoadedSubtitle>());
+    m_sidecarOrder.append(mediaPath);
+    
+    // Tracks already added stay in m_tracks
+    while (m_sidecarOrder.size() > PREFETCH_LIMIT) {
+        m_sidecars.remove(m_sidecarOrder.takeFirst());
+    }
+    
+    m_loadPool->start([this, mediaPath]() {
+        const QStringList subtitleFiles = autoDetectSubtitles(mediaPath);
+        
+        // Posted one by one so each track shows up as soon as it is parsed
+        for (const QString& subtitleFile : subtitleFiles) {
+            const LoadedSubtitle loaded = parseSubtitleFile(subtitleFile);
+            QMetaObject::invokeMethod(this, [this, mediaPath, loaded]() {
+                onSidecarLoaded(mediaPath, loaded);
+            }, Qt::QueuedConnection);
         }
+    });
+}
+
+void SubtitleManager::onSidecarLoaded(const QString& mediaPath, const LoadedSubtitle& loaded)
+{
+    auto it = m_sidecars.find(mediaPath);
+    if (it != m_sidecars.end()) {
+        it.value().append(loaded);
+    }
+    
+    if (mediaPath == m_currentMediaPath) {
+        addLoadedTrack(loaded);
     }
 }
 
@@ -408,11 +489,18 @@ QStringList SubtitleManager::autoDetectSubtitles(const QString& mediaPath) const
     
     QStringList supportedExts = getSupportedExtensions();
     
+    // Candidates are matched against one listing of the directory
+    const QDir dir(directory);
+    const DirectoryListingCache::Listing listing = DirectoryListingCache::instance().listing(directory);
+    if (listing.files.isEmpty()) {
+        return subtitleFiles;
+    }
+    
     // Look for subtitle files with same base name
     for (const QString& ext : supportedExts) {
-        QString subtitlePath = QDir(directory).absoluteFilePath(baseName + "." + ext);
-        if (QFileInfo::exists(subtitlePath)) {
-            subtitleFiles.append(subtitlePath);
+        QString fileName = baseName + "." + ext;
+        if (listing.hasFile(fileName)) {
+            subtitleFiles.append(dir.absoluteFilePath(fileName));
         }
     }
     
@@ -427,9 +515,12 @@ QStringList SubtitleManager::autoDetectSubtitles(const QString& mediaPath) const
     
     for (const QString& pattern : patterns) {
         for (const QString& ext : supportedExts) {
-            QString subtitlePath = QDir(directory).absoluteFilePath(pattern + "." + ext);
-            if (QFileInfo::exists(subtitlePath) && !subtitleFiles.contains(subtitlePath)) {
-                subtitleFiles.append(subtitlePath);
+            QString fileName = pattern + "." + ext;
+            if (listing.hasFile(fileName)) {
+                QString subtitlePath = dir.absoluteFilePath(fileName);
+                if (!subtitleFiles.contains(subtitlePath)) {
+                    subtitleFiles.append(subtitlePath);
+                }
             }
         }
     }
@@ -470,13 +561,11 @@ bool SubtitleManager::performSecurityValidation(const QString& content, const QS
 
 bool SubtitleManager::checkMaliciousPatterns(const QString& content) const
 {
-    QString lowerContent = content.toLower();
-    
-    for (const QString& pattern : m_maliciousPatterns) {
-        if (lowerContent.contains(pattern)) {
-            qCWarning(subtitleManager) << "Malicious pattern detected:" << pattern;
-            return false;
-        }
+    // All patterns in one pass over the text, case-insensitively
+    const int pattern = m_maliciousScanner.findFirst(content);
+    if (pattern >= 0) {
+        qCWarning(subtitleManager) << "Malicious pattern detected:" << m_maliciousPatterns.at(pattern);
+        return false;
     }
     
     return true;
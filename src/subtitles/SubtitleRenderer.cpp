@@ -1,10 +1,12 @@
 #include "subtitles/SubtitleRenderer.h"
+#include "CacheBudget.h"
 #include <QPainter>
 #include <QPainterPath>
 #include <QFontMetrics>
 #include <QApplication>
 #include <QMouseEvent>
 #include <QLoggingCategory>
+#include <QSet>
 
 Q_LOGGING_CATEGORY(subtitleRenderer, "eonplay.subtitles.renderer")
 
@@ -46,6 +48,7 @@ SubtitleRenderer::SubtitleRenderer(QWidget* parent)
     , m_fadeInAnimation(nullptr)
     , m_fadeOutAnimation(nullptr)
     , m_opacityEffect(nullptr)
+    , m_bitmapCache(BITMAP_CACHE_KB)
     , m_needsRedraw(true)
 {
     // Set widget properties
@@ -72,6 +75,8 @@ SubtitleRenderer::SubtitleRenderer(QWidget* parent)
     // Set initial settings
     m_settings = SubtitleRenderSettings();
     
+    CacheBudget::instance().registerCache("subtitle_bitmaps", CacheBudget::Priority::Normal, this, m_bitmapCache, 1024);
+    
     qCDebug(subtitleRenderer) << "SubtitleRenderer created";
 }
 
@@ -82,43 +87,47 @@ SubtitleRenderer::~SubtitleRenderer()
 
 void SubtitleRenderer::setSubtitleEntries(const QList<SubtitleEntry>& entries, qint64 time)
 {
-    bool entriesChanged = (entries.size() != m_currentEntries.size());
-    if (!entriesChanged) {
-        for (int i = 0; i < entries.size(); ++i) {
-            if (entries[i].text() != m_currentEntries[i].text() ||
-                entries[i].startTime() != m_currentEntries[i].startTime()) {
-                entriesChanged = true;
-                break;
-            }
+    if (sameEntries(entries, m_currentEntries)) {
+        return;
+    }
+    
+    m_currentEntries = entries;
+    m_currentTime = time;
+    
+    // Drop layouts of entries that left the screen
+    QSet<quint64> shownIds;
+    for (const SubtitleEntry& entry : entries) {
+        shownIds.insert(entry.id());
+    }
+    for (auto it = m_layouts.begin(); it != m_layouts.end();) {
+        if (shownIds.contains(it.key())) {
+            ++it;
+        } else {
+            it = m_layouts.erase(it);
         }
     }
     
-    if (entriesChanged) {
-        m_currentEntries = entries;
-        m_currentTime = time;
-        m_needsRedraw = true;
-        
-        if (entries.isEmpty()) {
-            if (m_visible) {
-                hideSubtitles();
-            }
+    if (entries.isEmpty()) {
+        if (m_visible) {
+            hideSubtitles();
+        }
+    } else {
+        if (!m_visible) {
+            showSubtitles();
         } else {
-            if (!m_visible) {
-                showSubtitles();
-            } else {
-                update(); // Redraw with new content
-            }
+            // Repaint where the old text was and where the new text goes
+            update(m_lastRenderRect.united(paintedArea(positionedLayouts())));
         }
-        
-        qCDebug(subtitleRenderer) << "Subtitle entries updated:" << entries.size() << "entries";
     }
+    
+    qCDebug(subtitleRenderer) << "Subtitle entries updated:" << entries.size() << "entries";
 }
 
 void SubtitleRenderer::clearSubtitles()
 {
     if (!m_currentEntries.isEmpty()) {
         m_currentEntries.clear();
-        m_needsRedraw = true;
+        m_layouts.clear();
         
         if (m_visible) {
             hideSubtitles();
@@ -133,6 +142,7 @@ void SubtitleRenderer::setRenderSettings(const SubtitleRenderSettings& settings)
     if (m_settings != settings) {
         m_settings = settings;
         m_needsRedraw = true;
+        m_bitmapCache.clear();
         
         // Update animation durations
         m_fadeInAnimation->setDuration(settings.fadeInDuration);
@@ -230,40 +240,30 @@ void SubtitleRenderer::paintEvent(QPaintEvent* event)
     Q_UNUSED(event)
     
     if (!m_enabled || m_currentEntries.isEmpty()) {
+        m_lastRenderRect = QRect();
         return;
     }
     
     QPainter painter(this);
-    painter.setRenderHint(QPainter::Antialiasing);
-    painter.setRenderHint(QPainter::TextAntialiasing);
     
-    // Apply global scale
+    // Apply global scale; bitmaps are rendered at this scale, so blits are 1:1
     if (qAbs(m_settings.scale - 1.0) > 0.01) {
         painter.scale(m_settings.scale, m_settings.scale);
     }
     
-    // Calculate total height needed
-    int totalHeight = calculateTotalHeight(m_currentEntries);
-    int startY = 0;
-    
-    // Position based on alignment
-    if (m_settings.alignment & Qt::AlignTop) {
-        startY = m_settings.marginTop;
-    } else if (m_settings.alignment & Qt::AlignBottom) {
-        startY = height() - totalHeight - m_settings.marginBottom;
-    } else {
-        startY = (height() - totalHeight) / 2;
-    }
+    const QVector<EntryLayout> layouts = positionedLayouts();
+    m_lastRenderRect = paintedArea(layouts);
     
     // Render each subtitle entry
-    int currentY = startY;
-    for (const SubtitleEntry& entry : m_currentEntries) {
-        QRect entryRect = calculateTextRect(entry);
-        entryRect.moveTop(currentY);
-        
-        renderSubtitleEntry(painter, entry, entryRect);
+    for (int i = 0; i < layouts.size(); ++i) {
+        const SubtitleEntry& entry = m_currentEntries.at(i);
+        if (entry.text().isEmpty()) {
+            continue;
+        }
         
-        currentY += entryRect.height() + m_settings.lineSpacing;
+        const EntryLayout& layout = layouts.at(i);
+        const QPoint origin = layout.rect.topLeft() - QPoint(layout.bleed.left(), layout.bleed.top());
+        painter.drawPixmap(origin, entryBitmap(entry, layout));
     }
 }
 
@@ -291,7 +291,180 @@ void SubtitleRenderer::onFadeOutFinished()
     emit visibilityChanged(false);
 }
 
-void SubtitleRenderer::renderSubtitleEntry(QPainter& painter, const SubtitleEntry& entry, const QRect& rect)
+SubtitleRenderer::EntryLayout SubtitleRenderer::entryLayout(const SubtitleEntry& entry)
+{
+    if (m_needsRedraw) {
+        m_layouts.clear();
+        m_needsRedraw = false;
+    }
+    
+    // Entries not added through a track have no id and are not cached
+    if (entry.id() == 0) {
+        return measureEntry(entry);
+    }
+    
+    auto it = m_layouts.find(entry.id());
+    if (it == m_layouts.end()) {
+        it = m_layouts.insert(entry.id(), measureEntry(entry));
+    }
+    return it.value();
+}
+
+SubtitleRenderer::EntryLayout SubtitleRenderer::measureEntry(const SubtitleEntry& entry) const
+{
+    EntryLayout layout;
+    layout.rect = calculateTextRect(entry);
+    
+    // Split text into lines if word wrap is enabled
+    const SubtitleFormat& format = entry.format();
+    if (m_settings.wordWrap) {
+        layout.lines = splitTextToLines(entry.text(), format.font, layout.rect.width());
+    } else {
+        layout.lines = entry.text().split('\n');
+    }
+    
+    // Limit number of lines
+    if (layout.lines.size() > m_settings.maxLines) {
+        layout.lines = layout.lines.mid(0, m_settings.maxLines);
+        if (!layout.lines.isEmpty()) {
+            layout.lines.last() += "...";
+        }
+    }
+    
+    // The outline pen is twice the width and the shadow is offset twice
+    const int outlineWidth = format.outlineWidth > 0 ? format.outlineWidth : m_settings.outlineWidth;
+    const int padding = 2 * (qMax(0, outlineWidth) + qMax(0, m_settings.shadowOffset));
+    
+    // Lines are spaced by the format font but drawn with the scaled one,
+    // wrapped lines can outnumber the rect and long words outgrow its width
+    const QFontMetrics layoutMetrics(format.font);
+    const QFontMetrics drawMetrics(renderFont(format));
+    int widestLine = 0;
+    for (const QString& line : layout.lines) {
+        widestLine = qMax(widestLine, drawMetrics.horizontalAdvance(line));
+    }
+    const int textHeight = layout.lines.size() * layoutMetrics.height() +
+                           qMax(0, layout.lines.size() - 1) * m_settings.lineSpacing;
+    const int horizontal = qMax(0, widestLine - layout.rect.width()) + padding;
+    const int vertical = qMax(0, textHeight - layout.rect.height()) +
+                         qMax(0, drawMetrics.height() - layoutMetrics.height()) + padding;
+    layout.bleed = QMargins(horizontal, vertical, horizontal, vertical);
+    
+    return layout;
+}
+
+QVector<SubtitleRenderer::EntryLayout> SubtitleRenderer::positionedLayouts()
+{
+    QVector<EntryLayout> layouts;
+    layouts.reserve(m_currentEntries.size());
+    
+    // Calculate total height needed
+    int totalHeight = 0;
+    for (const SubtitleEntry& entry : m_currentEntries) {
+        layouts.append(entryLayout(entry));
+        totalHeight += layouts.last().rect.height();
+    }
+    if (layouts.size() > 1) {
+        totalHeight += (layouts.size() - 1) * m_settings.lineSpacing;
+    }
+    
+    // Position based on alignment
+    int currentY = 0;
+    if (m_settings.alignment & Qt::AlignTop) {
+        currentY = m_settings.marginTop;
+    } else if (m_settings.alignment & Qt::AlignBottom) {
+        currentY = height() - totalHeight - m_settings.marginBottom;
+    } else {
+        currentY = (height() - totalHeight) / 2;
+    }
+    
+    for (EntryLayout& layout : layouts) {
+        layout.rect.moveTop(currentY);
+        currentY += layout.rect.height() + m_settings.lineSpacing;
+    }
+    
+    return layouts;
+}
+
+QRect SubtitleRenderer::paintedArea(const QVector<EntryLayout>& layouts) const
+{
+    QRect area;
+    for (const EntryLayout& layout : layouts) {
+        area |= layout.rect.marginsAdded(layout.bleed);
+    }
+    
+    if (area.isEmpty()) {
+        return QRect();
+    }
+    
+    // Layouts are in painter coordinates, which paintEvent() scales
+    const qreal scale = m_settings.scale;
+    const QRectF scaled(area.x() * scale, area.y() * scale, area.width() * scale, area.height() * scale);
+    return scaled.toAlignedRect().adjusted(-1, -1, 1, 1);
+}
+
+bool SubtitleRenderer::sameEntries(const QList<SubtitleEntry>& a, const QList<SubtitleEntry>& b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    
+    for (int i = 0; i < a.size(); ++i) {
+        if (a[i].id() != 0 && b[i].id() != 0) {
+            if (a[i].id() != b[i].id()) {
+                return false;
+            }
+        } else if (a[i].text() != b[i].text() || a[i].startTime() != b[i].startTime()) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+QPixmap SubtitleRenderer::entryBitmap(const SubtitleEntry& entry, const EntryLayout& layout)
+{
+    const SubtitleFormat& format = entry.format();
+    const qreal ratio = m_settings.scale * devicePixelRatioF();
+    
+    // Settings are not part of the key; changing them clears the cache.
+    // The text goes last so no field can run into the next one.
+    const QString key = QStringList{
+        format.font.toString(),
+        QString::number(format.textColor.rgba()),
+        QString::number(format.backgroundColor.rgba()),
+        QString::number(format.outlineColor.rgba()),
+        QString::number(format.outlineWidth),
+        QString::number(static_cast<int>(format.alignment)),
+        QString::number(layout.rect.width()),
+        QString::number(ratio),
+        entry.text()
+    }.join(QLatin1Char('|'));
+    
+    if (const QPixmap* cached = m_bitmapCache.object(key)) {
+        return *cached;
+    }
+    
+    const QRect inkRect = layout.rect.marginsAdded(layout.bleed);
+    QPixmap pixmap((QSizeF(inkRect.size()) * ratio).toSize());
+    pixmap.setDevicePixelRatio(ratio);
+    pixmap.fill(Qt::transparent);
+    
+    {
+        QPainter painter(&pixmap);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setRenderHint(QPainter::TextAntialiasing);
+        painter.translate(-inkRect.topLeft());
+        renderSubtitleEntry(painter, entry, layout);
+    }
+    
+    const int costKb = qMax(1, static_cast<int>(pixmap.width() * pixmap.height() * pixmap.depth() / 8 / 1024));
+    m_bitmapCache.insert(key, new QPixmap(pixmap), costKb);
+    
+    return pixmap;
+}
+
+void SubtitleRenderer::renderSubtitleEntry(QPainter& painter, const SubtitleEntry& entry, const EntryLayout& layout)
 {
     if (entry.text().isEmpty()) {
         return;
@@ -302,10 +475,10 @@ void SubtitleRenderer::renderSubtitleEntry(QPainter& painter, const SubtitleEntr
     applySubtitleFormat(painter, format);
     
     // Render formatted text
-    renderFormattedText(painter, entry.text(), rect, format);
+    renderFormattedText(painter, layout.lines, layout.rect, format);
 }
 
-void SubtitleRenderer::renderFormattedText(QPainter& painter, const QString& text, const QRect& rect, const SubtitleFormat& format)
+void SubtitleRenderer::renderFormattedText(QPainter& painter, const QStringList& lines, const QRect& rect, const SubtitleFormat& format)
 {
     // Use format colors or fall back to settings
     QColor textColor = (format.textColor != Qt::transparent) ? format.textColor : m_settings.textColor;
@@ -317,22 +490,6 @@ void SubtitleRenderer::renderFormattedText(QPainter& painter, const QString& tex
         painter.fillRect(rect, backgroundColor);
     }
     
-    // Split text into lines if word wrap is enabled
-    QStringList lines;
-    if (m_settings.wordWrap) {
-        lines = splitTextToLines(text, format.font, rect.width());
-    } else {
-        lines = text.split('\n');
-    }
-    
-    // Limit number of lines
-    if (lines.size() > m_settings.maxLines) {
-        lines = lines.mid(0, m_settings.maxLines);
-        if (!lines.isEmpty()) {
-            lines.last() += "...";
-        }
-    }
-    
     // Calculate line height
     QFontMetrics fm(format.font);
     int lineHeight = fm.height();
@@ -406,9 +563,8 @@ QRect SubtitleRenderer::calculateTextRect(const SubtitleEntry& entry) const
     return QRect(x, 0, textWidth, totalHeight);
 }
 
-void SubtitleRenderer::applySubtitleFormat(QPainter& painter, const SubtitleFormat& format)
+QFont SubtitleRenderer::renderFont(const SubtitleFormat& format) const
 {
-    // Set font
     QFont font = format.font;
     if (font.family().isEmpty()) {
         font = m_settings.font;
@@ -420,7 +576,12 @@ void SubtitleRenderer::applySubtitleFormat(QPainter& painter, const SubtitleForm
         font.setPointSize(qMax(8, scaledSize));
     }
     
-    painter.setFont(font);
+    return font;
+}
+
+void SubtitleRenderer::applySubtitleFormat(QPainter& painter, const SubtitleFormat& format)
+{
+    painter.setFont(renderFont(format));
 }
 
 void SubtitleRenderer::drawTextWithOutline(QPainter& painter, const QString& text, const QRect& rect,
@@ -462,34 +623,6 @@ void SubtitleRenderer::drawTextWithShadow(QPainter& painter, const QString& text
     painter.drawText(rect, Qt::AlignCenter, text);
 }
 
-int SubtitleRenderer::calculateTotalHeight(const QList<SubtitleEntry>& entries) const
-{
-    if (entries.isEmpty()) {
-        return 0;
-    }
-    
-    int totalHeight = 0;
-    
-    for (const SubtitleEntry& entry : entries) {
-        QFontMetrics fm(entry.format().font);
-        QStringList lines = entry.text().split('\n');
-        
-        int entryHeight = lines.size() * fm.height();
-        if (lines.size() > 1) {
-            entryHeight += (lines.size() - 1) * m_settings.lineSpacing;
-        }
-        
-        totalHeight += entryHeight;
-    }
-    
-    // Add spacing between entries
-    if (entries.size() > 1) {
-        totalHeight += (entries.size() - 1) * m_settings.lineSpacing;
-    }
-    
-    return totalHeight;
-}
-
 QStringList SubtitleRenderer::splitTextToLines(const QString& text, const QFont& font, int maxWidth) const
 {
     QStringList lines;
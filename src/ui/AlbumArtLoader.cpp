@@ -0,0 +1,101 @@
+#include "ui/AlbumArtLoader.h"
+#include "data/CoverArtStore.h"
+#include "CacheBudget.h"
+#include <QImage>
+#include <QImageReader>
+#include <QMetaObject>
+
+AlbumArtLoader::AlbumArtLoader(QObject* parent)
+    : QObject(parent)
+    , m_cache(DEFAULT_CACHE_KB)
+    , m_pool(new QThreadPool(this))
+{
+    m_pool->setMaxThreadCount(2);
+    CacheBudget::instance().registerCache("album_art", CacheBudget::Priority::Normal, this, m_cache, 1024);
+}
+
+AlbumArtLoader::~AlbumArtLoader()
+{
+    // Workers post their results back to this object
+    m_pool->clear();
+    m_pool->waitForDone();
+}
+
+QPixmap AlbumArtLoader::thumbnail(const QString& imagePath, int size)
+{
+    if (imagePath.isEmpty() || size <= 0) {
+        return QPixmap();
+    }
+    
+    const QString key = cacheKey(imagePath, size);
+    if (QPixmap* cached = m_cache.object(key)) {
+        return *cached;
+    }
+    
+    if (m_pending.contains(key) || m_failed.contains(key)) {
+        return QPixmap();
+    }
+    
+    // After fast scrolling most of the queue is for rows no longer shown;
+    // views ask again for whatever is visible on their next paint
+    if (m_pending.size() >= MAX_PENDING) {
+        m_pool->clear();
+        m_pending.clear();
+    }
+    
+    m_pending.insert(key);
+    m_pool->start([this, imagePath, size]() {
+        // Covers from the store come with copies already scaled down
+        QImageReader reader(EonPlay::Data::CoverArtStore::thumbnailPath(imagePath, size));
+        reader.setAutoTransform(true);
+        
+        // Scaled while decoding, which JPEG readers do far cheaper than a
+        // full decode followed by a resize
+        const QSize imageSize = reader.size();
+        if (imageSize.isValid()) {
+            reader.setScaledSize(imageSize.scaled(size, size, Qt::KeepAspectRatio));
+        }
+        
+        QImage image = reader.read();
+        if (!image.isNull() && (image.width() > size || image.height() > size)) {
+            image = image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+        
+        QMetaObject::invokeMethod(this, [this, imagePath, size, image]() {
+            storeThumbnail(imagePath, size, image);
+        }, Qt::QueuedConnection);
+    });
+    
+    return QPixmap();
+}
+
+void AlbumArtLoader::clear()
+{
+    m_pool->clear();
+    m_cache.clear();
+    m_pending.clear();
+    m_failed.clear();
+}
+
+QString AlbumArtLoader::cacheKey(const QString& imagePath, int size)
+{
+    return QString::number(size) + QLatin1Char(':') + imagePath;
+}
+
+void AlbumArtLoader::storeThumbnail(const QString& imagePath, int size, const QImage& image)
+{
+    const QString key = cacheKey(imagePath, size);
+    m_pending.remove(key);
+    
+    if (image.isNull()) {
+        m_failed.insert(key);
+        return;
+    }
+    
+    // QPixmap may only be created on the GUI thread
+    auto* pixmap = new QPixmap(QPixmap::fromImage(image));
+    const int cost = qMax(1, pixmap->width() * pixmap->height() * 4 / 1024);
+    m_cache.insert(key, pixmap, cost);
+    
+    emit thumbnailReady(imagePath, size);
+}
@@ -1,5 +1,6 @@
 #include "ui/AudioVisualizerWidget.h"
 #include "audio/AudioVisualizer.h"
+#include "ui/UpdateScheduler.h"
 #include <QPainter>
 #include <QPaintEvent>
 #include <QMouseEvent>
@@ -11,6 +12,10 @@
 #include <QMutexLocker>
 #include <algorithm>
 
+#ifdef HAVE_QT_OPENGL
+#include "ui/SpectrumGLView.h"
+#endif
+
 AudioVisualizerWidget::AudioVisualizerWidget(QWidget* parent)
     : QWidget(parent)
     , m_visualizer(nullptr)
@@ -25,7 +30,10 @@ AudioVisualizerWidget::AudioVisualizerWidget(QWidget* parent)
     , m_gradientEnabled(true)
     , m_glowEnabled(true)
     , m_animationSpeed(1.0f)
-    , m_animationTimer(new QTimer(this))
+    , m_gpuRenderingEnabled(true)
+#ifdef HAVE_QT_OPENGL
+    , m_glView(new SpectrumGLView(this))
+#endif
     , m_animationPhase(0.0f)
 {
     // Setup widget
@@ -44,19 +52,30 @@ AudioVisualizerWidget::AudioVisualizerWidget(QWidget* parent)
         QColor(148, 0, 211)   // Violet
     };
     
-    // Setup animation timer
-    m_animationTimer->setInterval(1000 / ANIMATION_FPS);
-    connect(m_animationTimer, &QTimer::timeout, this, &AudioVisualizerWidget::updateAnimation);
-    m_animationTimer->start();
+    // Animate only while visible; no one needs the analysis otherwise either
+    UpdateScheduler& scheduler = UpdateScheduler::instance();
+    scheduler.subscribe(this, ANIMATION_FPS, [this]() { updateAnimation(); });
+    connect(&scheduler, &UpdateScheduler::activeChanged, this, [this](QWidget* widget, bool active) {
+        if (widget == this && m_visualizer) {
+            m_visualizer->setSuspended(!active);
+        }
+    });
     
     // Setup gradients
     setupGradients();
+    
+#ifdef HAVE_QT_OPENGL
+    // The GL view stays hidden until a spectrum mode needs it
+    m_glView->hide();
+    connect(m_glView, &SpectrumGLView::renderingFailed, this, &AudioVisualizerWidget::onGpuRenderingFailed);
+#endif
 }
 
 AudioVisualizerWidget::~AudioVisualizerWidget()
 {
     if (m_visualizer) {
         disconnect(m_visualizer, nullptr, this, nullptr);
+        m_visualizer->setSuspended(false);
     }
 }
 
@@ -64,11 +83,13 @@ void AudioVisualizerWidget::setAudioVisualizer(AudioVisualizer* visualizer)
 {
     if (m_visualizer) {
         disconnect(m_visualizer, nullptr, this, nullptr);
+        m_visualizer->setSuspended(false);
     }
     
     m_visualizer = visualizer;
     
     if (m_visualizer) {
+        m_visualizer->setSuspended(!UpdateScheduler::instance().isActive(this));
         connect(m_visualizer, &AudioVisualizer::spectrumDataUpdated,
                 this, &AudioVisualizerWidget::onSpectrumDataUpdated);
         connect(m_visualizer, &AudioVisualizer::waveformDataUpdated,
@@ -186,10 +207,37 @@ void AudioVisualizerWidget::setAnimationSpeed(float speed)
     m_animationSpeed = qBound(0.0f, speed, 2.0f);
 }
 
+bool AudioVisualizerWidget::isGpuRenderingAvailable() const
+{
+#ifdef HAVE_QT_OPENGL
+    return !m_glView->hasFailed();
+#else
+    return false;
+#endif
+}
+
+bool AudioVisualizerWidget::isGpuRenderingEnabled() const
+{
+    return m_gpuRenderingEnabled;
+}
+
+void AudioVisualizerWidget::setGpuRenderingEnabled(bool enabled)
+{
+    if (m_gpuRenderingEnabled != enabled) {
+        m_gpuRenderingEnabled = enabled;
+        updateGpuView();
+        update();
+    }
+}
+
 void AudioVisualizerWidget::paintEvent(QPaintEvent* event)
 {
     Q_UNUSED(event)
     
+    if (isGpuRenderingActive()) {
+        return;
+    }
+    
     QPainter painter(this);
     painter.setRenderHint(QPainter::Antialiasing);
     
@@ -246,6 +294,10 @@ void AudioVisualizerWidget::resizeEvent(QResizeEvent* event)
     m_peakAnimations.resize(bandCount);
     
     setupGradients();
+    
+#ifdef HAVE_QT_OPENGL
+    m_glView->setGeometry(rect());
+#endif
 }
 
 void AudioVisualizerWidget::mousePressEvent(QMouseEvent* event)
@@ -339,6 +391,16 @@ void AudioVisualizerWidget::updateAnimation()
         }
     }
     
+    if (!updateGpuView()) {
+        update();
+    }
+}
+
+void AudioVisualizerWidget::onGpuRenderingFailed()
+{
+#ifdef HAVE_QT_OPENGL
+    m_glView->hide();
+#endif
     update();
 }
 
@@ -689,6 +751,87 @@ void AudioVisualizerWidget::drawBar(QPainter& painter, const QRectF& rect, float
     }
 }
 
+bool AudioVisualizerWidget::isGpuRenderingActive() const
+{
+#ifdef HAVE_QT_OPENGL
+    return m_glView->isVisible() && !m_glView->hasFailed();
+#else
+    return false;
+#endif
+}
+
+bool AudioVisualizerWidget::updateGpuView()
+{
+#ifdef HAVE_QT_OPENGL
+    bool useGpu = m_gpuRenderingEnabled && !m_glView->hasFailed() && m_visualizer;
+    auto mode = m_visualizer ? m_visualizer->getVisualizationMode() : AudioVisualizer::None;
+    
+    SpectrumGLView::FrameData frame;
+    frame.style = m_visualizationStyle;
+    
+    // Translate the QPainter code paths into shader layouts and styles
+    switch (mode) {
+        case AudioVisualizer::SpectrumAnalyzer:
+            if (m_visualizationStyle == Minimal) {
+                frame.layout = SpectrumGLView::LineLayout;
+            }
+            frame.particles = m_visualizationStyle == AI_Driven;
+            frame.glowEnabled = m_glowEnabled && m_visualizationStyle == Neon;
+            break;
+        case AudioVisualizer::FrequencyBars:
+        case AudioVisualizer::AIVisualizer:
+            // Plain bars: Retro only keeps its border, like drawBar()
+            if (m_visualizationStyle == Retro) {
+                frame.style = Classic;
+            } else if (m_visualizationStyle != Classic && m_visualizationStyle != AI_Driven) {
+                frame.style = Modern;
+            }
+            frame.particles = mode == AudioVisualizer::AIVisualizer;
+            break;
+        case AudioVisualizer::CircularSpectrum:
+            frame.layout = SpectrumGLView::CircularLayout;
+            if (m_visualizationStyle != AI_Driven) {
+                frame.style = Modern;
+            }
+            break;
+        default:
+            useGpu = false;
+            break;
+    }
+    
+    if (useGpu) {
+        QMutexLocker locker(&m_dataMutex);
+        
+        int barCount = qMin(static_cast<int>(m_spectrumData.magnitudes.size()), SpectrumGLView::MAX_BARS);
+        frame.bars = m_barAnimations.mid(0, barCount);
+        frame.bars.resize(barCount);
+        frame.peaks = m_peakAnimations.mid(0, barCount);
+        frame.peaks.resize(barCount);
+        frame.palette = m_aiColorPalette.mid(0, SpectrumGLView::MAX_PALETTE);
+        frame.backgroundEnabled = m_backgroundEnabled;
+        frame.backgroundColor = m_backgroundColor;
+        frame.primaryColor = m_primaryColor;
+        frame.gradientEnabled = m_gradientEnabled;
+        frame.animationPhase = m_animationPhase;
+        locker.unlock();
+        
+        m_glView->setFrame(frame);
+    }
+    
+    if (useGpu != m_glView->isVisible()) {
+        m_glView->setGeometry(rect());
+        m_glView->setVisible(useGpu);
+        if (!useGpu) {
+            update();
+        }
+    }
+    
+    return useGpu && !m_glView->hasFailed();
+#else
+    return false;
+#endif
+}
+
 void AudioVisualizerWidget::drawCircularBar(QPainter& painter, const QPointF& center, float radius, float angle, float value, const QColor& color)
 {
     float barLength = value * radius * 0.6f;
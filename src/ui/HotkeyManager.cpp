@@ -1,17 +1,46 @@
 #include "ui/HotkeyManager.h"
 #include <QApplication>
 #include <QInputDialog>
+#include <QKeyEvent>
 #include <QMessageBox>
 #include <QStandardPaths>
 #include <QLoggingCategory>
+#include <iterator>
 
 Q_LOGGING_CATEGORY(hotkeys, "eonplay.hotkeys")
 
+namespace {
+
+struct GlobalBinding {
+    Qt::Key key;
+    const char* actionId;
+};
+
+// Media keys are not customizable; they bind to the same actions as the
+// application hotkeys. The index is the key's bit in m_pendingGlobalKeys.
+constexpr GlobalBinding GLOBAL_BINDINGS[] = {
+    {Qt::Key_MediaTogglePlayPause, "play_pause"},
+    {Qt::Key_MediaPlay, "play_pause"},
+    {Qt::Key_MediaStop, "stop"},
+    {Qt::Key_MediaNext, "next"},
+    {Qt::Key_MediaPrevious, "previous"},
+    {Qt::Key_VolumeUp, "volume_up"},
+    {Qt::Key_VolumeDown, "volume_down"},
+    {Qt::Key_VolumeMute, "mute"},
+};
+
+} // namespace
+
 HotkeyManager::HotkeyManager(QObject* parent)
     : QObject(parent)
     , m_parentWidget(nullptr)
+    , m_lastKey(0)
+    , m_lastKeyAutoRepeat(false)
+    , m_pendingGlobalKeys(0)
     , m_initialized(false)
 {
+    m_clock.start();
+    
     // Initialize settings
     m_settings = std::make_unique<QSettings>(
         QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation) + "/EonPlay_Hotkeys.ini",
@@ -23,6 +52,10 @@ HotkeyManager::HotkeyManager(QObject* parent)
 
 HotkeyManager::~HotkeyManager()
 {
+    if (m_initialized) {
+        qApp->removeEventFilter(this);
+    }
+    
     saveSettings();
     
     // Clean up shortcuts
@@ -48,6 +81,10 @@ bool HotkeyManager::initialize(QWidget* parentWidget)
     // Load saved settings
     loadSettings();
     
+    // Shortcut activations do not say whether the key is held; the
+    // ShortcutOverride sent ahead of them does
+    qApp->installEventFilter(this);
+    
     m_initialized = true;
     
     qCDebug(hotkeys) << "HotkeyManager initialized with" << m_actions.size() << "actions";
@@ -55,14 +92,15 @@ bool HotkeyManager::initialize(QWidget* parentWidget)
 }
 
 bool HotkeyManager::registerAction(const QString& id, const QString& name, 
-                                  const QString& description, const QKeySequence& defaultSequence)
+                                  const QString& description, const QKeySequence& defaultSequence,
+                                  bool repeatable)
 {
     if (m_actions.contains(id)) {
         qCWarning(hotkeys) << "Action already registered:" << id;
         return false;
     }
     
-    HotkeyAction action(id, name, description, defaultSequence);
+    HotkeyAction action(id, name, description, defaultSequence, repeatable);
     m_actions[id] = action;
     
     // Create shortcut if initialized
@@ -71,6 +109,7 @@ bool HotkeyManager::registerAction(const QString& id, const QString& name,
         if (shortcut) {
             m_shortcuts[id] = shortcut;
         }
+        rebuildKeymap();
     }
     
     qCDebug(hotkeys) << "Registered action:" << id << "with sequence:" << defaultSequence.toString();
@@ -84,6 +123,11 @@ bool HotkeyManager::setHotkey(const QString& actionId, const QKeySequence& seque
         return false;
     }
     
+    if (sequence.count() > 1) {
+        qCWarning(hotkeys) << "Multi-key hotkeys are not supported:" << sequence.toString();
+        return false;
+    }
+    
     // Check for conflicts
     QString conflictId = checkConflict(sequence, actionId);
     if (!conflictId.isEmpty()) {
@@ -96,6 +140,7 @@ bool HotkeyManager::setHotkey(const QString& actionId, const QKeySequence& seque
     
     // Update shortcut
     updateShortcut(actionId);
+    rebuildKeymap();
     
     emit hotkeyChanged(actionId, sequence);
     
@@ -123,6 +168,7 @@ void HotkeyManager::setActionEnabled(const QString& actionId, bool enabled)
     if (m_shortcuts.contains(actionId)) {
         m_shortcuts[actionId]->setEnabled(enabled);
     }
+    rebuildKeymap();
     
     qCDebug(hotkeys) << "Action" << actionId << (enabled ? "enabled" : "disabled");
 }
@@ -145,6 +191,7 @@ void HotkeyManager::resetToDefault(const QString& actionId)
     action.currentSequence = action.defaultSequence;
     
     updateShortcut(actionId);
+    rebuildKeymap();
     
     emit hotkeyChanged(actionId, action.currentSequence);
     
@@ -156,6 +203,10 @@ void HotkeyManager::resetAllToDefaults()
     for (auto& action : m_actions) {
         action.currentSequence = action.defaultSequence;
         updateShortcut(action.id);
+    }
+    rebuildKeymap();
+    
+    for (const auto& action : std::as_const(m_actions)) {
         emit hotkeyChanged(action.id, action.currentSequence);
     }
     
@@ -205,7 +256,8 @@ void HotkeyManager::loadSettings()
         QString sequenceStr = m_settings->value(action.id + "/sequence", action.defaultSequence.toString()).toString();
         bool enabled = m_settings->value(action.id + "/enabled", true).toBool();
         
-        action.currentSequence = QKeySequence(sequenceStr);
+        QKeySequence sequence(sequenceStr);
+        action.currentSequence = sequence.count() > 1 ? action.defaultSequence : sequence;
         action.enabled = enabled;
         
         // Update shortcut if it exists
@@ -213,6 +265,7 @@ void HotkeyManager::loadSettings()
     }
     
     m_settings->endGroup();
+    rebuildKeymap();
     
     qCDebug(hotkeys) << "Hotkey settings loaded";
 }
@@ -290,21 +343,147 @@ void HotkeyManager::showCustomizationDialog()
     }
 }
 
+QString HotkeyManager::actionForKey(QKeyCombination key, HotkeyContext context) const
+{
+    const int index = m_keymap.value(keymapKey(key, context), -1);
+    return index >= 0 ? m_dispatchTable[index].actionId : QString();
+}
+
+bool HotkeyManager::dispatchKey(QKeyCombination key, HotkeyContext context, bool autoRepeat)
+{
+    const int index = m_keymap.value(keymapKey(key, context), -1);
+    if (index < 0) {
+        return false;
+    }
+    
+    dispatchEntry(index, autoRepeat);
+    return true;
+}
+
+void HotkeyManager::postGlobalKey(int key)
+{
+    for (size_t i = 0; i < std::size(GLOBAL_BINDINGS); ++i) {
+        if (GLOBAL_BINDINGS[i].key == key) {
+            // Only the first press since the last drain schedules one
+            if (m_pendingGlobalKeys.fetch_or(1u << i, std::memory_order_acq_rel) == 0) {
+                QMetaObject::invokeMethod(this, &HotkeyManager::drainGlobalKeys, Qt::QueuedConnection);
+            }
+            return;
+        }
+    }
+}
+
+bool HotkeyManager::eventFilter(QObject* watched, QEvent* event)
+{
+    if (event->type() == QEvent::ShortcutOverride) {
+        const auto* keyEvent = static_cast<QKeyEvent*>(event);
+        m_lastKey = keyEvent->key();
+        m_lastKeyAutoRepeat = keyEvent->isAutoRepeat();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
 void HotkeyManager::onShortcutActivated()
 {
     QShortcut* shortcut = qobject_cast<QShortcut*>(sender());
-    if (!shortcut) {
+    if (!shortcut || shortcut->key().isEmpty()) {
         return;
     }
     
-    // Find action ID for this shortcut
-    for (auto it = m_shortcuts.constBegin(); it != m_shortcuts.constEnd(); ++it) {
-        if (it.value() == shortcut) {
-            emit actionTriggered(it.key());
-            qCDebug(hotkeys) << "Action triggered:" << it.key();
-            break;
+    const QKeyCombination key = shortcut->key()[0];
+    const int index = m_keymap.value(keymapKey(key, HotkeyContext::Application), -1);
+    if (index >= 0) {
+        dispatchEntry(index, m_lastKeyAutoRepeat && m_lastKey == key.key());
+    }
+}
+
+void HotkeyManager::dispatchEntry(int index, bool autoRepeat)
+{
+    DispatchEntry& entry = m_dispatchTable[index];
+    const qint64 now = m_clock.elapsed();
+    
+    // Copied because handlers may rebind keys and rebuild the table
+    const QString actionId = entry.actionId;
+    
+    if (autoRepeat) {
+        const qint64 interval = now - entry.lastMs;
+        const qint64 held = now - entry.pressMs;
+        entry.lastMs = now;
+        if (entry.repeatable) {
+            emit actionRepeated(actionId, interval, held);
+        }
+        return;
+    }
+    
+    entry.pressMs = now;
+    entry.lastMs = now;
+    emit actionTriggered(actionId);
+    qCDebug(hotkeys) << "Action triggered:" << actionId;
+}
+
+void HotkeyManager::drainGlobalKeys()
+{
+    const quint32 pending = m_pendingGlobalKeys.exchange(0, std::memory_order_acq_rel);
+    
+    for (size_t i = 0; i < std::size(GLOBAL_BINDINGS); ++i) {
+        if (!(pending & (1u << i))) {
+            continue;
+        }
+        
+        const QKeyCombination key(GLOBAL_BINDINGS[i].key);
+        const int index = m_keymap.value(keymapKey(key, HotkeyContext::Global), -1);
+        if (index >= 0) {
+            const qint64 sinceLast = m_clock.elapsed() - m_dispatchTable[index].lastMs;
+            dispatchEntry(index, sinceLast < GLOBAL_REPEAT_GAP_MS);
+        }
+    }
+}
+
+void HotkeyManager::rebuildKeymap()
+{
+    m_keymap.clear();
+    m_dispatchTable.clear();
+    
+    QHash<QString, int> entries;
+    auto entryFor = [this, &entries](const HotkeyAction& action) {
+        auto it = entries.constFind(action.id);
+        if (it != entries.constEnd()) {
+            return it.value();
+        }
+        
+        DispatchEntry entry;
+        entry.actionId = action.id;
+        entry.repeatable = action.repeatable;
+        // Never counts as a repeat of an earlier press
+        entry.lastMs = -GLOBAL_REPEAT_GAP_MS;
+        m_dispatchTable.append(entry);
+        entries.insert(action.id, m_dispatchTable.size() - 1);
+        return m_dispatchTable.size() - 1;
+    };
+    
+    for (const auto& action : std::as_const(m_actions)) {
+        if (action.enabled && action.currentSequence.count() == 1) {
+            m_keymap.insert(keymapKey(action.currentSequence[0], HotkeyContext::Application),
+                            entryFor(action));
+        }
+    }
+    
+    for (const GlobalBinding& binding : GLOBAL_BINDINGS) {
+        auto it = m_actions.constFind(QString::fromLatin1(binding.actionId));
+        if (it != m_actions.constEnd() && it->enabled) {
+            m_keymap.insert(keymapKey(QKeyCombination(binding.key), HotkeyContext::Global),
+                            entryFor(*it));
         }
     }
+    
+    qCDebug(hotkeys) << "Compiled" << m_keymap.size() << "key bindings";
+}
+
+quint64 HotkeyManager::keymapKey(QKeyCombination key, HotkeyContext context)
+{
+    // Keypad arrows and digits should act like the main ones
+    const QKeyCombination normalized(key.keyboardModifiers() & ~Qt::KeypadModifier, key.key());
+    return (quint64(context) << 32) | quint32(normalized.toCombined());
 }
 
 QShortcut* HotkeyManager::createShortcut(const HotkeyAction& action)
@@ -316,6 +495,7 @@ QShortcut* HotkeyManager::createShortcut(const HotkeyAction& action)
     QShortcut* shortcut = new QShortcut(action.currentSequence, m_parentWidget);
     shortcut->setEnabled(action.enabled);
     shortcut->setContext(Qt::ApplicationShortcut);
+    shortcut->setAutoRepeat(action.repeatable);
     
     connect(shortcut, &QShortcut::activated, this, &HotkeyManager::onShortcutActivated);
     
@@ -352,8 +532,8 @@ void HotkeyManager::registerDefaultHotkeys()
     registerAction("previous", tr("Previous"), tr("Previous track"), QKeySequence(Qt::Key_Left));
     
     // Volume control
-    registerAction("volume_up", tr("Volume Up"), tr("Increase volume"), QKeySequence(Qt::Key_Up));
-    registerAction("volume_down", tr("Volume Down"), tr("Decrease volume"), QKeySequence(Qt::Key_Down));
+    registerAction("volume_up", tr("Volume Up"), tr("Increase volume"), QKeySequence(Qt::Key_Up), true);
+    registerAction("volume_down", tr("Volume Down"), tr("Decrease volume"), QKeySequence(Qt::Key_Down), true);
     registerAction("mute", tr("Mute"), tr("Toggle mute"), QKeySequence(Qt::Key_M));
     
     // File operations
@@ -370,8 +550,8 @@ void HotkeyManager::registerDefaultHotkeys()
     registerAction("toggle_library", tr("Toggle Library"), tr("Show/hide library"), QKeySequence(Qt::CTRL | Qt::Key_L));
     
     // Seek operations
-    registerAction("seek_forward", tr("Seek Forward"), tr("Seek forward 10 seconds"), QKeySequence(Qt::CTRL | Qt::Key_Right));
-    registerAction("seek_backward", tr("Seek Backward"), tr("Seek backward 10 seconds"), QKeySequence(Qt::CTRL | Qt::Key_Left));
+    registerAction("seek_forward", tr("Seek Forward"), tr("Seek forward 10 seconds"), QKeySequence(Qt::CTRL | Qt::Key_Right), true);
+    registerAction("seek_backward", tr("Seek Backward"), tr("Seek backward 10 seconds"), QKeySequence(Qt::CTRL | Qt::Key_Left), true);
     
     qCDebug(hotkeys) << "Registered" << m_actions.size() << "default hotkeys";
 }
\ No newline at end of file
@@ -0,0 +1,492 @@
+#include "ui/LibraryTableModel.h"
+#include "ui/AlbumArtLoader.h"
+#include <QDateTime>
+#include <QPixmap>
+#include <algorithm>
+
+namespace {
+
+struct ColumnInfo {
+    const char* header;
+    const char* field;
+};
+
+const ColumnInfo COLUMNS[LibraryTableModel::ColumnCount] = {
+    { "Title", "title" },
+    { "Artist", "artist" },
+    { "Album", "album" },
+    { "Genre", "genre" },
+    { "Year", "year" },
+    { "Duration", "duration" },
+    { "Size", "file_size" },
+    { "Date Added", "date_added" },
+    { "Play Count", "play_count" }
+};
+
+} // namespace
+
+LibraryTableModel::LibraryTableModel(QObject* parent)
+    : QAbstractTableModel(parent)
+    , m_libraryManager(nullptr)
+    , m_dbManager(nullptr)
+    , m_sortKeyIndex(-1)
+    , m_rowCache(ROW_CACHE_SIZE)
+    , m_filePathIndex(-1)
+    , m_coverArtIndex(-1)
+    , m_albumArtLoader(new AlbumArtLoader(this))
+    , m_updateTimer(new QTimer(this))
+{
+    for (const ColumnInfo& column : COLUMNS) {
+        m_options.columns << QString::fromLatin1(column.field);
+    }
+    m_options.columns << "file_path" << "cover_art_path";
+    
+    m_updateTimer->setSingleShot(true);
+    m_updateTimer->setInterval(UPDATE_INTERVAL_MS);
+    connect(m_updateTimer, &QTimer::timeout, this, &LibraryTableModel::applyPendingUpdates);
+    
+    connect(m_albumArtLoader, &AlbumArtLoader::thumbnailReady,
+            this, &LibraryTableModel::onThumbnailReady);
+}
+
+LibraryTableModel::~LibraryTableModel() = default;
+
+void LibraryTableModel::setLibraryManager(LibraryManager* libraryManager)
+{
+    if (m_dbManager) {
+        disconnect(m_dbManager, nullptr, this, nullptr);
+    }
+    
+    m_libraryManager = libraryManager;
+    m_dbManager = libraryManager ? libraryManager->databaseManager() : nullptr;
+    
+    // Queued: the database emits while holding its lock, and these slots
+    // query it again
+    if (m_dbManager) {
+        connect(m_dbManager, &DatabaseManager::mediaFileAdded,
+                this, &LibraryTableModel::onMediaFileChanged, Qt::QueuedConnection);
+        connect(m_dbManager, &DatabaseManager::mediaFileUpdated,
+                this, &LibraryTableModel::onMediaFileChanged, Qt::QueuedConnection);
+        connect(m_dbManager, &DatabaseManager::mediaFileRemoved,
+                this, &LibraryTableModel::onMediaFileRemoved, Qt::QueuedConnection);
+        connect(m_dbManager, &DatabaseManager::mediaFilesUpserted,
+                this, &LibraryTableModel::onMediaFilesUpserted, Qt::QueuedConnection);
+    }
+    
+    refresh();
+}
+
+void LibraryTableModel::setSearchText(const QString& searchText)
+{
+    if (m_options.filter.searchTerm == searchText) {
+        return;
+    }
+    
+    m_options.filter.searchTerm = searchText;
+    refresh();
+}
+
+void LibraryTableModel::setFilter(const MediaQueryCursor::Filter& filter)
+{
+    const QString searchTerm = m_options.filter.searchTerm;
+    m_options.filter = filter;
+    m_options.filter.searchTerm = searchTerm;
+    refresh();
+}
+
+void LibraryTableModel::sortByField(const QString& field, Qt::SortOrder order)
+{
+    if (m_options.orderBy == field && m_options.order == order) {
+        return;
+    }
+    
+    m_options.orderBy = field;
+    m_options.order = order;
+    refresh();
+}
+
+void LibraryTableModel::refresh()
+{
+    beginResetModel();
+    
+    m_ids.clear();
+    m_sortKeys.clear();
+    m_rowCache.clear();
+    m_thumbnailWaiters.clear();
+    m_pendingIds.clear();
+    m_pendingRemovals.clear();
+    m_pendingPaths.clear();
+    m_idCursor.reset();
+    m_rowCursor.reset();
+    m_valueIndex.clear();
+    m_sortKeyIndex = -1;
+    m_filePathIndex = -1;
+    m_coverArtIndex = -1;
+    
+    if (m_libraryManager) {
+        MediaQueryCursor::Options idOptions = m_options;
+        idOptions.columns = QStringList{m_options.orderBy};
+        idOptions.pageSize = ID_PAGE_SIZE;
+        m_idCursor = m_libraryManager->openCursor(idOptions);
+        
+        MediaQueryCursor::Options rowOptions;
+        rowOptions.columns = m_options.columns;
+        m_rowCursor = m_libraryManager->openCursor(rowOptions);
+    }
+    
+    if (m_idCursor && m_rowCursor) {
+        // The cursor may have replaced an invalid sort field
+        m_sortKeyIndex = m_idCursor->columnIndex(m_idCursor->options().orderBy);
+        
+        for (const ColumnInfo& column : COLUMNS) {
+            m_valueIndex << m_rowCursor->columnIndex(QString::fromLatin1(column.field));
+        }
+        m_filePathIndex = m_rowCursor->columnIndex("file_path");
+        m_coverArtIndex = m_rowCursor->columnIndex("cover_art_path");
+    } else {
+        m_idCursor.reset();
+        m_rowCursor.reset();
+    }
+    
+    endResetModel();
+}
+
+void LibraryTableModel::fetchAll()
+{
+    while (canFetchMore(QModelIndex())) {
+        fetchMore(QModelIndex());
+    }
+}
+
+QString LibraryTableModel::fieldForColumn(int column)
+{
+    if (column < 0 || column >= ColumnCount) {
+        return QString();
+    }
+    return QString::fromLatin1(COLUMNS[column].field);
+}
+
+int LibraryTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_ids.size();
+}
+
+int LibraryTableModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant LibraryTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_ids.size() || index.column() >= ColumnCount) {
+        return QVariant();
+    }
+    
+    if (role == MediaIdRole) {
+        return m_ids.at(index.row());
+    }
+    
+    if (role == Qt::TextAlignmentRole) {
+        if (index.column() >= YearColumn && index.column() != DateAddedColumn) {
+            return QVariant(Qt::AlignRight | Qt::AlignVCenter);
+        }
+        return QVariant();
+    }
+    
+    const QVariantList* row = rowValues(index.row());
+    if (!row) {
+        return QVariant();
+    }
+    
+    switch (role) {
+        case Qt::DisplayRole: {
+            const int valueIndex = m_valueIndex.value(index.column(), -1);
+            return valueIndex >= 0 ? displayText(index.column(), row->at(valueIndex)) : QString();
+        }
+        case Qt::DecorationRole: {
+            if (index.column() != TitleColumn || m_coverArtIndex < 0) {
+                return QVariant();
+            }
+            
+            const QString coverPath = row->at(m_coverArtIndex).toString();
+            const QPixmap thumbnail = m_albumArtLoader->thumbnail(coverPath, THUMBNAIL_SIZE);
+            if (thumbnail.isNull()) {
+                if (!coverPath.isEmpty() && !m_thumbnailWaiters.contains(coverPath, m_ids.at(index.row()))) {
+                    m_thumbnailWaiters.insert(coverPath, m_ids.at(index.row()));
+                }
+                return QVariant();
+            }
+            return thumbnail;
+        }
+        case FilePathRole:
+            return m_filePathIndex >= 0 ? row->at(m_filePathIndex) : QVariant();
+        case CoverArtRole:
+            return m_coverArtIndex >= 0 ? row->at(m_coverArtIndex) : QVariant();
+        default:
+            return QVariant();
+    }
+}
+
+QVariant LibraryTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < ColumnCount) {
+        return QString::fromLatin1(COLUMNS[section].header);
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+bool LibraryTableModel::canFetchMore(const QModelIndex& parent) const
+{
+    return !parent.isValid() && m_idCursor && !m_idCursor->atEnd();
+}
+
+void LibraryTableModel::fetchMore(const QModelIndex& parent)
+{
+    if (!canFetchMore(parent)) {
+        return;
+    }
+    
+    const QVector<QVariantList> page = m_idCursor->fetchPage();
+    if (page.isEmpty()) {
+        return;
+    }
+    
+    beginInsertRows(QModelIndex(), m_ids.size(), m_ids.size() + page.size() - 1);
+    m_ids.reserve(m_ids.size() + page.size());
+    for (const QVariantList& entry : page) {
+        const int id = entry.at(0).toInt();
+        m_ids.append(id);
+        m_sortKeys.insert(id, entry.at(m_sortKeyIndex));
+    }
+    endInsertRows();
+}
+
+void LibraryTableModel::sort(int column, Qt::SortOrder order)
+{
+    const QString field = fieldForColumn(column);
+    if (!field.isEmpty()) {
+        sortByField(field, order);
+    }
+}
+
+void LibraryTableModel::onMediaFileChanged(int id)
+{
+    m_pendingRemovals.remove(id);
+    m_pendingIds.insert(id);
+    scheduleUpdate();
+}
+
+void LibraryTableModel::onMediaFileRemoved(int id)
+{
+    m_pendingIds.remove(id);
+    m_pendingRemovals.insert(id);
+    scheduleUpdate();
+}
+
+void LibraryTableModel::onMediaFilesUpserted(const QStringList& filePaths)
+{
+    m_pendingPaths += filePaths;
+    scheduleUpdate();
+}
+
+void LibraryTableModel::onThumbnailReady(const QString& imagePath, int size)
+{
+    if (size != THUMBNAIL_SIZE) {
+        return;
+    }
+    
+    const QList<int> ids = m_thumbnailWaiters.values(imagePath);
+    m_thumbnailWaiters.remove(imagePath);
+    
+    for (int id : ids) {
+        const int row = rowOf(id);
+        if (row >= 0) {
+            const QModelIndex cell = index(row, TitleColumn);
+            emit dataChanged(cell, cell, {Qt::DecorationRole});
+        }
+    }
+}
+
+void LibraryTableModel::applyPendingUpdates()
+{
+    if (!m_idCursor || !m_dbManager) {
+        return;
+    }
+    
+    for (int id : std::as_const(m_pendingRemovals)) {
+        removeId(id);
+    }
+    m_pendingRemovals.clear();
+    
+    QVector<int> ids(m_pendingIds.cbegin(), m_pendingIds.cend());
+    m_pendingIds.clear();
+    if (!m_pendingPaths.isEmpty()) {
+        ids += m_dbManager->getMediaFileIds(m_pendingPaths);
+        m_pendingPaths.clear();
+    }
+    
+    if (ids.isEmpty()) {
+        return;
+    }
+    
+    // One query tells which changed rows still pass the filter, and where
+    // they sort now
+    const QHash<int, QVariantList> matching = m_idCursor->fetchMatching(ids);
+    
+    for (int id : std::as_const(ids)) {
+        m_rowCache.remove(id);
+        
+        auto match = matching.constFind(id);
+        auto current = m_sortKeys.constFind(id);
+        
+        if (current != m_sortKeys.constEnd()) {
+            if (match == matching.constEnd()) {
+                removeId(id);
+                continue;
+            }
+            
+            if (*current == match->at(m_sortKeyIndex)) {
+                const int row = rowOf(id);
+                if (row >= 0) {
+                    emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+                }
+                continue;
+            }
+            
+            // Moved: reinsert at its new position
+            removeId(id);
+        }
+        
+        if (match != matching.constEnd()) {
+            insertId(id, match->at(m_sortKeyIndex));
+        }
+    }
+}
+
+const QVariantList* LibraryTableModel::rowValues(int row) const
+{
+    const int id = m_ids.at(row);
+    if (const QVariantList* values = m_rowCache.object(id)) {
+        return values;
+    }
+    
+    loadRowsAround(row);
+    return m_rowCache.object(id);
+}
+
+void LibraryTableModel::loadRowsAround(int row) const
+{
+    if (!m_rowCursor) {
+        return;
+    }
+    
+    // Views ask row by row, so one miss loads the neighbourhood
+    const int first = qMax(0, row - ROW_FETCH_BLOCK / 2);
+    const int last = qMin(static_cast<int>(m_ids.size()), first + ROW_FETCH_BLOCK);
+    
+    QVector<int> missing;
+    for (int i = first; i < last; ++i) {
+        if (!m_rowCache.contains(m_ids.at(i))) {
+            missing << m_ids.at(i);
+        }
+    }
+    
+    const QHash<int, QVariantList> rows = m_rowCursor->fetchRows(missing);
+    for (auto it = rows.constBegin(); it != rows.constEnd(); ++it) {
+        m_rowCache.insert(it.key(), new QVariantList(it.value()));
+    }
+}
+
+int LibraryTableModel::lowerBound(const QVariant& key, int id) const
+{
+    auto position = std::lower_bound(m_ids.cbegin(), m_ids.cend(), id, [this, &key](int candidate, int target) {
+        return m_idCursor->lessThan(m_sortKeys.value(candidate), candidate, key, target);
+    });
+    return static_cast<int>(position - m_ids.cbegin());
+}
+
+int LibraryTableModel::rowOf(int id) const
+{
+    auto key = m_sortKeys.constFind(id);
+    if (key == m_sortKeys.constEnd()) {
+        return -1;
+    }
+    
+    const int row = lowerBound(*key, id);
+    return row < m_ids.size() && m_ids.at(row) == id ? row : -1;
+}
+
+void LibraryTableModel::insertId(int id, const QVariant& key)
+{
+    const int row = lowerBound(key, id);
+    
+    // Past the loaded pages the cursor will deliver it in order
+    if (row == m_ids.size() && !m_idCursor->atEnd()) {
+        return;
+    }
+    
+    beginInsertRows(QModelIndex(), row, row);
+    m_ids.insert(row, id);
+    m_sortKeys.insert(id, key);
+    endInsertRows();
+}
+
+void LibraryTableModel::removeId(int id)
+{
+    const int row = rowOf(id);
+    m_rowCache.remove(id);
+    
+    if (row < 0) {
+        m_sortKeys.remove(id);
+        return;
+    }
+    
+    beginRemoveRows(QModelIndex(), row, row);
+    m_ids.remove(row);
+    m_sortKeys.remove(id);
+    endRemoveRows();
+}
+
+void LibraryTableModel::scheduleUpdate()
+{
+    if (!m_updateTimer->isActive()) {
+        m_updateTimer->start();
+    }
+}
+
+QString LibraryTableModel::displayText(int column, const QVariant& value) const
+{
+    if (value.isNull()) {
+        return QString();
+    }
+    
+    switch (column) {
+        case DurationColumn: {
+            const qint64 seconds = value.toLongLong() / 1000;
+            if (seconds >= 3600) {
+                return QString("%1:%2:%3")
+                       .arg(seconds / 3600)
+                       .arg((seconds / 60) % 60, 2, 10, QChar('0'))
+                       .arg(seconds % 60, 2, 10, QChar('0'));
+            }
+            return QString("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+        }
+        case SizeColumn: {
+            const double bytes = value.toDouble();
+            if (bytes >= 1024.0 * 1024 * 1024) {
+                return QString("%1 GB").arg(bytes / (1024.0 * 1024 * 1024), 0, 'f', 2);
+            } else if (bytes >= 1024.0 * 1024) {
+                return QString("%1 MB").arg(bytes / (1024.0 * 1024), 0, 'f', 1);
+            } else if (bytes >= 1024.0) {
+                return QString("%1 KB").arg(bytes / 1024.0, 0, 'f', 0);
+            }
+            return QString("%1 bytes").arg(value.toLongLong());
+        }
+        case DateAddedColumn:
+            return value.toDateTime().toString("yyyy-MM-dd hh:mm");
+        case YearColumn:
+            return value.toInt() > 0 ? value.toString() : QString();
+        default:
+            return value.toString();
+    }
+}
@@ -1,7 +1,9 @@
 #include "ui/LibraryWidget.h"
+#include "data/CoverArtStore.h"
 #include "data/LibraryManager.h"
 #include "data/MediaFile.h"
 #include "data/PlaylistManager.h"
+#include "ui/AlbumArtLoader.h"
 #include <QHeaderView>
 #include <QContextMenuEvent>
 #include <QDragEnterEvent>
@@ -18,9 +20,11 @@
 #include <QLoggingCategory>
 #include <QMutexLocker>
 #include <QPixmap>
+#include <QMovie>
 #include <QImageReader>
 #include <QStandardPaths>
 #include <QDir>
+#include <QDateTime>
 #include <QtMath>
 
 Q_DECLARE_LOGGING_CATEGORY(libraryWidget)
@@ -50,8 +54,7 @@ LibraryWidget::LibraryWidget(QWidget* parent)
     , m_albumArtEnabled(true)
     , m_statusLabel(new QLabel(this))
     , m_progressBar(new QProgressBar(this))
-    , m_libraryModel(new QStandardItemModel(this))
-    , m_proxyModel(new QSortFilterProxyModel(this))
+    , m_libraryModel(new LibraryTableModel(this))
     , m_contextMenu(new QMenu(this))
     , m_libraryManager(nullptr)
     , m_playlistManager(nullptr)
@@ -59,6 +62,7 @@ LibraryWidget::LibraryWidget(QWidget* parent)
     , m_sortBy(Title)
     , m_filterBy(All)
     , m_albumArtTimer(new QTimer(this))
+    , m_previewMovie(nullptr)
 {
     setupUI();
     setupModels();
@@ -90,10 +94,13 @@ void LibraryWidget::setLibraryManager(LibraryManager* libraryManager)
     }
     
     m_libraryManager = libraryManager;
+    m_libraryModel->setLibraryManager(libraryManager);
     
     if (m_libraryManager) {
         connect(m_libraryManager, &LibraryManager::libraryChanged,
                 this, &LibraryWidget::onLibraryUpdated);
+        connect(m_libraryManager, &LibraryManager::statisticsUpdated,
+                this, &LibraryWidget::updateLibraryStats);
         
         refreshLibrary();
     }
@@ -157,7 +164,62 @@ void LibraryWidget::setSearchText(const QString& searchText)
     if (m_searchText != searchText) {
         m_searchText = searchText;
         m_searchEdit->setText(searchText);
-        m_proxyModel->setFilterFixedString(searchText);
+        m_libraryModel->setSearchText(searchText);
+    }
+}
+
+int LibraryWidget::firstVisibleRow() const
+{
+    const QAbstractItemView* view = qobject_cast<QAbstractItemView*>(m_currentView);
+    if (!view || !view->isVisible()) {
+        return -1;
+    }
+    return view->indexAt(QPoint(0, 0)).row();
+}
+
+void LibraryWidget::scrollToRow(int row)
+{
+    QAbstractItemView* view = qobject_cast<QAbstractItemView*>(m_currentView);
+    if (!view || row < 0) {
+        return;
+    }
+    
+    // Ids are cheap to page in; the row values load as the view paints
+    while (m_libraryModel->rowCount() <= row && m_libraryModel->canFetchMore(QModelIndex())) {
+        m_libraryModel->fetchMore(QModelIndex());
+    }
+    if (row < m_libraryModel->rowCount()) {
+        view->scrollTo(m_libraryModel->index(row, 0), QAbstractItemView::PositionAtTop);
+    }
+}
+
+QStringList LibraryWidget::visibleCoverArt() const
+{
+    QStringList imagePaths;
+    const QAbstractItemView* view = qobject_cast<QAbstractItemView*>(m_currentView);
+    const int first = firstVisibleRow();
+    if (first < 0) {
+        return imagePaths;
+    }
+    
+    int last = view->indexAt(QPoint(0, view->viewport()->height() - 1)).row();
+    if (last < first) {
+        last = m_libraryModel->rowCount() - 1;
+    }
+    for (int row = first; row <= last; ++row) {
+        const QString imagePath = m_libraryModel->index(row, 0).data(LibraryTableModel::CoverArtRole).toString();
+        if (!imagePath.isEmpty() && !imagePaths.contains(imagePath)) {
+            imagePaths.append(imagePath);
+        }
+    }
+    return imagePaths;
+}
+
+void LibraryWidget::warmCoverArt(const QStringList& imagePaths)
+{
+    // A miss starts the decode; the model picks the thumbnail up when it paints
+    for (const QString& imagePath : imagePaths) {
+        m_libraryModel->albumArtLoader()->thumbnail(imagePath, LibraryTableModel::THUMBNAIL_SIZE);
     }
 }
 
@@ -177,16 +239,12 @@ QVector<std::shared_ptr<MediaFile>> LibraryWidget::getSelectedFiles() const
     QModelIndexList selectedIndexes = view->selectionModel()->selectedRows();
     
     for (const QModelIndex& index : selectedIndexes) {
-        QModelIndex sourceIndex = m_proxyModel->mapToSource(index);
-        QStandardItem* item = m_libraryModel->itemFromIndex(sourceIndex);
+        const QString filePath = index.data(LibraryTableModel::FilePathRole).toString();
         
-        if (item) {
-            QVariant fileData = item->data(Qt::UserRole);
-            if (fileData.isValid()) {
-                // This would contain the MediaFile pointer
-                // Implementation depends on how MediaFile is stored
-                qCDebug(libraryWidget) << "Selected file:" << item->text();
-            }
+        if (!filePath.isEmpty()) {
+            auto mediaFile = std::make_shared<MediaFile>(filePath);
+            mediaFile->setId(index.data(LibraryTableModel::MediaIdRole).toInt());
+            selectedFiles.append(mediaFile);
         }
     }
     
@@ -264,11 +322,7 @@ void LibraryWidget::setAlbumArtEnabled(bool enabled)
         
         if (enabled) {
             // Load album art for current selection
-            QVector<std::shared_ptr<MediaFile>> selectedFiles = getSelectedFiles();
-            if (!selectedFiles.isEmpty()) {
-                // Load album art for first selected file
-                // loadAlbumArt(selectedFiles.first()->getFilePath());
-            }
+            onItemSelectionChanged();
         }
     }
 }
@@ -327,7 +381,7 @@ void LibraryWidget::dropEvent(QDropEvent* event)
 void LibraryWidget::onSearchTextChanged()
 {
     m_searchText = m_searchEdit->text();
-    m_proxyModel->setFilterFixedString(m_searchText);
+    m_libraryModel->setSearchText(m_searchText);
 }
 
 void LibraryWidget::onViewModeChanged()
@@ -356,12 +410,19 @@ void LibraryWidget::onItemDoubleClicked(const QModelIndex& index)
 
 void LibraryWidget::onItemSelectionChanged()
 {
-    if (m_albumArtEnabled) {
-        QVector<std::shared_ptr<MediaFile>> selectedFiles = getSelectedFiles();
-        if (!selectedFiles.isEmpty()) {
-            // Load album art for first selected file
-            // loadAlbumArt(selectedFiles.first()->getFilePath());
-        }
+    if (!m_albumArtEnabled) {
+        return;
+    }
+    
+    QAbstractItemView* view = qobject_cast<QAbstractItemView*>(m_currentView);
+    if (!view || !view->selectionModel()) {
+        return;
+    }
+    
+    // Album art for first selected file
+    const QModelIndexList selectedRows = view->selectionModel()->selectedRows();
+    if (!selectedRows.isEmpty()) {
+        loadAlbumArt(selectedRows.first().data(LibraryTableModel::CoverArtRole).toString());
     }
 }
 
@@ -373,7 +434,8 @@ void LibraryWidget::onContextMenuRequested(const QPoint& pos)
 
 void LibraryWidget::onLibraryUpdated()
 {
-    refreshLibrary();
+    // The model follows database changes row by row on its own
+    updateLibraryStats();
 }
 
 void LibraryWidget::updateLibraryStats()
@@ -387,12 +449,14 @@ void LibraryWidget::updateLibraryStats()
     // Reset stats
     m_libraryStats = LibraryStats();
     
-    // Get all media files from library manager
-    // This would be implemented based on LibraryManager interface
-    // auto allFiles = m_libraryManager->getAllMediaFiles();
-    
-    // Calculate statistics
-    // Implementation would iterate through files and calculate stats
+    // Cheap to call repeatedly: the manager reads pre-aggregated totals
+    const LibraryManager::LibraryStatistics statistics = m_libraryManager->getStatistics();
+    m_libraryStats.totalFiles = statistics.totalFiles;
+    m_libraryStats.audioFiles = statistics.audioFiles;
+    m_libraryStats.videoFiles = statistics.videoFiles;
+    m_libraryStats.playlists = statistics.totalPlaylists;
+    m_libraryStats.totalSize = statistics.totalSize;
+    m_libraryStats.totalDuration = statistics.totalDuration;
     
     // Update status label
     m_statusLabel->setText(QString("Total: %1 files").arg(m_libraryStats.totalFiles));
@@ -400,19 +464,47 @@ void LibraryWidget::updateLibraryStats()
     qCDebug(libraryWidget) << "Library stats updated - Total files:" << m_libraryStats.totalFiles;
 }
 
-void LibraryWidget::onAlbumArtLoaded(const QString& filePath, const QPixmap& albumArt)
+void LibraryWidget::onAlbumArtLoaded(const QString& imagePath, int size)
 {
-    m_albumArtCache[filePath] = albumArt;
-    
-    // Update display if this is the currently selected file
-    QVector<std::shared_ptr<MediaFile>> selectedFiles = getSelectedFiles();
-    if (!selectedFiles.isEmpty()) {
-        // Check if this matches current selection
-        // if (selectedFiles.first()->getFilePath() == filePath) {
-        //     m_albumArtLabel->setPixmap(albumArt.scaled(ALBUM_ART_SIZE, ALBUM_ART_SIZE, 
-        //                                                Qt::KeepAspectRatio, Qt::SmoothTransformation));
-        // }
+    // Update display if this is the image the label is waiting for
+    if (size == ALBUM_ART_SIZE && imagePath == m_albumArtPath) {
+        loadAlbumArt(imagePath);
+    }
+}
+
+void LibraryWidget::onItemHovered(const QModelIndex& index)
+{
+    // Only videos given a poster by the PosterGenerator have a preview
+    const QString coverArtPath = index.data(LibraryTableModel::CoverArtRole).toString();
+    const QString previewPath = EonPlay::Data::CoverArtStore::previewPath(coverArtPath);
+    if (previewPath.isEmpty() || !m_albumArtEnabled) {
+        stopPreview();
+        return;
+    }
+    if (m_previewMovie && m_previewMovie->fileName() == previewPath) {
+        return;
+    }
+
+    stopPreview();
+    m_previewMovie = new QMovie(previewPath, QByteArray(), this);
+    if (m_previewMovie->jumpToFrame(0)) {
+        m_previewMovie->setScaledSize(m_previewMovie->frameRect().size()
+                                      .scaled(ALBUM_ART_SIZE, ALBUM_ART_SIZE, Qt::KeepAspectRatio));
     }
+    m_albumArtLabel->setMovie(m_previewMovie);
+    m_previewMovie->start();
+}
+
+void LibraryWidget::stopPreview()
+{
+    if (!m_previewMovie) {
+        return;
+    }
+
+    m_albumArtLabel->setMovie(nullptr);
+    m_previewMovie->deleteLater();
+    m_previewMovie = nullptr;
+    loadAlbumArt(m_albumArtPath);
 }
 
 void LibraryWidget::setupUI()
@@ -461,7 +553,11 @@ void LibraryWidget::setupUI()
     m_tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_tableView->setSelectionMode(QAbstractItemView::ExtendedSelection);
     m_tableView->setDragDropMode(QAbstractItemView::DragOnly);
-    m_tableView->setSortingEnabled(true);
+    
+    // Sorting is done by the model's query; a view or proxy sort would only
+    // reorder the rows loaded so far
+    m_tableView->horizontalHeader()->setSectionsClickable(true);
+    m_tableView->horizontalHeader()->setSortIndicatorShown(true);
     
     // Setup album art widget
     m_albumArtLabel->setFixedSize(ALBUM_ART_SIZE, ALBUM_ART_SIZE);
@@ -504,21 +600,11 @@ void LibraryWidget::setupUI()
 
 void LibraryWidget::setupModels()
 {
-    // Setup library model
-    m_libraryModel->setHorizontalHeaderLabels({
-        "Title", "Artist", "Album", "Genre", "Year", 
-        "Duration", "Size", "Date Added", "Play Count"
-    });
-    
-    // Setup proxy model for filtering and sorting
-    m_proxyModel->setSourceModel(m_libraryModel);
-    m_proxyModel->setFilterCaseSensitivity(Qt::CaseInsensitive);
-    m_proxyModel->setFilterKeyColumn(-1); // Search all columns
-    
-    // Set models to views
-    m_treeView->setModel(m_proxyModel);
-    m_listView->setModel(m_proxyModel);
-    m_tableView->setModel(m_proxyModel);
+    // The library model sorts, searches and filters in SQL, so views use it
+    // directly; a proxy would only see the rows loaded so far
+    m_treeView->setModel(m_libraryModel);
+    m_listView->setModel(m_libraryModel);
+    m_tableView->setModel(m_libraryModel);
 }
 
 void LibraryWidget::setupConnections()
@@ -550,11 +636,25 @@ void LibraryWidget::setupConnections()
             this, &LibraryWidget::onSearchTextChanged);
     
     // View connections
+    connect(m_tableView->horizontalHeader(), &QHeaderView::sortIndicatorChanged,
+            m_libraryModel, &LibraryTableModel::sort);
     connect(m_tableView, &QTableView::doubleClicked,
             this, &LibraryWidget::onItemDoubleClicked);
     connect(m_tableView->selectionModel(), &QItemSelectionModel::selectionChanged,
             this, &LibraryWidget::onItemSelectionChanged);
     
+    connect(m_libraryModel->albumArtLoader(), &AlbumArtLoader::thumbnailReady,
+            this, &LibraryWidget::onAlbumArtLoaded);
+    
+    // Hovering a video plays its preview in the album art pane
+    for (QAbstractItemView* view : {static_cast<QAbstractItemView*>(m_treeView),
+                                    static_cast<QAbstractItemView*>(m_listView),
+                                    static_cast<QAbstractItemView*>(m_tableView)}) {
+        view->setMouseTracking(true);
+        connect(view, &QAbstractItemView::entered, this, &LibraryWidget::onItemHovered);
+        connect(view, &QAbstractItemView::viewportEntered, this, &LibraryWidget::stopPreview);
+    }
+    
     // Album art timer
     connect(m_albumArtTimer, &QTimer::timeout,
             this, [this]() {
@@ -599,45 +699,44 @@ void LibraryWidget::updateViewMode()
 
 void LibraryWidget::updateSorting()
 {
-    int column = static_cast<int>(m_sortBy);
-    m_proxyModel->sort(column, Qt::AscendingOrder);
+    static const char* const fields[] = {
+        "title", "artist", "album", "genre", "year",
+        "duration", "date_added", "play_count", "rating"
+    };
+    
+    const int index = static_cast<int>(m_sortBy);
+    if (index >= 0 && index < static_cast<int>(sizeof(fields) / sizeof(fields[0]))) {
+        m_libraryModel->sortByField(QString::fromLatin1(fields[index]), Qt::AscendingOrder);
+    }
 }
-
 void LibraryWidget::updateFiltering()
 {
-    // Implement filtering based on m_filterBy
-    // This would set appropriate filters on the proxy model
-    QString filterPattern;
+    MediaQueryCursor::Filter filter;
     
     switch (m_filterBy) {
         case All:
-            filterPattern = "";
             break;
         case Audio:
-            filterPattern = "\\.(mp3|flac|wav|ogg|m4a)$";
+            filter.fileExtensions = {"mp3", "flac", "wav", "ogg", "m4a"};
             break;
         case Video:
-            filterPattern = "\\.(mp4|avi|mkv|mov|wmv)$";
+            filter.fileExtensions = {"mp4", "avi", "mkv", "mov", "wmv"};
             break;
         case Playlist:
-            filterPattern = "\\.(m3u|pls|xspf)$";
+            filter.fileExtensions = {"m3u", "pls", "xspf"};
             break;
         case Recent:
-            // Would filter by date added
+            filter.addedSince = QDateTime::currentDateTime().addDays(-RECENT_DAYS);
             break;
         case Favorites:
-            // Would filter by rating or favorite flag
+            filter.minimumRating = FAVORITE_RATING;
             break;
         case Unplayed:
-            // Would filter by play count = 0
+            filter.unplayedOnly = true;
             break;
     }
     
-    if (!filterPattern.isEmpty()) {
-        m_proxyModel->setFilterRegularExpression(QRegularExpression(filterPattern, QRegularExpression::CaseInsensitiveOption));
-    } else {
-        m_proxyModel->setFilterRegularExpression(QRegularExpression());
-    }
+    m_libraryModel->setFilter(filter);
 }
 
 void LibraryWidget::populateLibraryModel()
@@ -646,22 +745,11 @@ void LibraryWidget::populateLibraryModel()
         return;
     }
     
-    m_libraryModel->clear();
-    m_libraryModel->setHorizontalHeaderLabels({
-        "Title", "Artist", "Album", "Genre", "Year", 
-        "Duration", "Size", "Date Added", "Play Count"
-    });
-    
-    // Get all media files from library manager
-    // This would be implemented based on LibraryManager interface
-    // auto allFiles = m_libraryManager->getAllMediaFiles();
-    
-    // Populate model with media files
-    // Implementation would iterate through files and add to model
+    // Only the first page is read here; views pull more as they scroll
+    m_libraryModel->refresh();
     
     qCDebug(libraryWidget) << "Library model populated";
 }
-
 void LibraryWidget::createContextMenu()
 {
     m_playAction = m_contextMenu->addAction("Play");
@@ -730,15 +818,13 @@ bool LibraryWidget::exportToJSON(const QString& filePath)
     QJsonArray filesArray;
     
     // Export all files in the model
+    m_libraryModel->fetchAll();
     for (int row = 0; row < m_libraryModel->rowCount(); ++row) {
         QJsonObject fileObj;
         
         for (int col = 0; col < m_libraryModel->columnCount(); ++col) {
-            QStandardItem* item = m_libraryModel->item(row, col);
-            if (item) {
-                QString headerName = m_libraryModel->headerData(col, Qt::Horizontal).toString();
-                fileObj[headerName.toLower().replace(" ", "_")] = item->text();
-            }
+            QString headerName = m_libraryModel->headerData(col, Qt::Horizontal).toString();
+            fileObj[headerName.toLower().replace(" ", "_")] = m_libraryModel->index(row, col).data().toString();
         }
         
         filesArray.append(fileObj);
@@ -784,12 +870,12 @@ bool LibraryWidget::exportToCSV(const QString& filePath)
     out << headers.join(",") << "\n";
     
     // Write data
+    m_libraryModel->fetchAll();
     for (int row = 0; row < m_libraryModel->rowCount(); ++row) {
         QStringList rowData;
         
         for (int col = 0; col < m_libraryModel->columnCount(); ++col) {
-            QStandardItem* item = m_libraryModel->item(row, col);
-            QString cellData = item ? item->text() : "";
+            QString cellData = m_libraryModel->index(row, col).data().toString();
             
             // Escape commas and quotes in CSV
             if (cellData.contains(",") || cellData.contains("\"")) {
@@ -806,32 +892,29 @@ bool LibraryWidget::exportToCSV(const QString& filePath)
     return true;
 }
 
-void LibraryWidget::loadAlbumArt(const QString& filePath)
+void LibraryWidget::loadAlbumArt(const QString& imagePath)
 {
-    // Check cache first
-    if (m_albumArtCache.contains(filePath)) {
-        QPixmap albumArt = m_albumArtCache[filePath];
-        m_albumArtLabel->setPixmap(albumArt.scaled(ALBUM_ART_SIZE, ALBUM_ART_SIZE, 
-                                                  Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    m_albumArtPath = imagePath;
+    
+    // A playing preview keeps the label; stopPreview() shows the art
+    if (m_previewMovie) {
+        return;
+    }
+    
+    if (imagePath.isEmpty()) {
+        m_albumArtLabel->setPixmap(QPixmap());
+        m_albumArtLabel->setText("No Album Art");
         return;
     }
     
-    // Load album art from file metadata or folder
-    // This would be implemented using TagLib or similar library
-    // For now, show placeholder
-    m_albumArtLabel->setText("Loading...");
+    // Decoded off the GUI thread; onAlbumArtLoaded() retries once it is ready
+    const QPixmap albumArt = m_libraryModel->albumArtLoader()->thumbnail(imagePath, ALBUM_ART_SIZE);
+    if (albumArt.isNull()) {
+        m_albumArtLabel->setText("Loading...");
+        return;
+    }
     
-    // Simulate async loading
-    QTimer::singleShot(100, this, [this, filePath]() {
-        // Create placeholder pixmap
-        QPixmap placeholder(ALBUM_ART_SIZE, ALBUM_ART_SIZE);
-        placeholder.fill(Qt::lightGray);
-        
-        m_albumArtCache[filePath] = placeholder;
-        m_albumArtLabel->setPixmap(placeholder);
-        
-        emit onAlbumArtLoaded(filePath, placeholder);
-    });
+    m_albumArtLabel->setPixmap(albumArt);
 }
 
 QString LibraryWidget::formatDuration(qint64 milliseconds) const
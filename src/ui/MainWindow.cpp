@@ -8,10 +8,12 @@
 #include "ui/MediaKeysManager.h"
 #include "ui/NotificationManager.h"
 #include "ui/HotkeyManager.h"
+#include "ui/MetricsOverlay.h"
 #include "media/FileUrlSupport.h"
 #include "data/LibraryManager.h"
 #include "data/PlaylistManager.h"
 #include "ComponentManager.h"
+#include "SessionSnapshot.h"
 #include <QApplication>
 #include <QFileDialog>
 #include <QInputDialog>
@@ -30,6 +32,7 @@
 #include <QMimeData>
 #include <QDragEnterEvent>
 #include <QDropEvent>
+#include <cmath>
 
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent)
@@ -42,6 +45,7 @@ MainWindow::MainWindow(QWidget* parent)
     , m_playlistWidget(nullptr)
     , m_libraryWidget(nullptr)
     , m_mediaInfoWidget(nullptr)
+    , m_metricsOverlay(nullptr)
     , m_dragDropWidget(nullptr)
     , m_menuBar(nullptr)
     , m_fileMenu(nullptr)
@@ -90,6 +94,17 @@ MainWindow::MainWindow(QWidget* parent)
     
     // Restore window state
     restoreState();
+    
+    // The last session's layout, when there is a snapshot of it
+    restoreSessionLayout();
+    
+    // Quitting and suspending are the moments to snapshot; neither needs the window closed
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &MainWindow::saveSessionSnapshot);
+    connect(qApp, &QGuiApplication::applicationStateChanged, this, [this](Qt::ApplicationState state) {
+        if (state == Qt::ApplicationSuspended || state == Qt::ApplicationHidden) {
+            saveSessionSnapshot();
+        }
+    });
 }
 
 MainWindow::~MainWindow()
@@ -115,6 +130,9 @@ bool MainWindow::initialize(ComponentManager* componentManager)
             updateStatusBar(tr("Loaded: %1").arg(QFileInfo(filePath).fileName()));
             addToRecentFiles(filePath);
             updateRecentFilesMenu();
+            if (m_playbackControls) {
+                m_playbackControls->setMediaFile(filePath);
+            }
         });
         
         connect(m_fileUrlSupport.get(), &FileUrlSupport::fileValidationFailed,
@@ -129,12 +147,6 @@ bool MainWindow::initialize(ComponentManager* componentManager)
         }
     }
     
-    // Initialize media info widget with component manager
-    if (m_mediaInfoWidget && m_fileUrlSupport) {
-        // Connect media info widget to file support
-        // m_mediaInfoWidget->setFileUrlSupport(m_fileUrlSupport);
-    }
-    
     // Initialize playback controls with component manager
     if (m_playbackControls) {
         m_playbackControls->initialize(componentManager);
@@ -161,37 +173,37 @@ bool MainWindow::initialize(ComponentManager* componentManager)
         });
     }
     
-    // Initialize library and playlist widgets
-    if (m_libraryWidget && m_playlistWidget) {
-        // Get managers from component manager
-        auto libraryManager = componentManager->getComponent<EonPlay::Data::LibraryManager>();
-        auto playlistManager = componentManager->getComponent<EonPlay::Data::PlaylistManager>();
+    // Library scans report every file; the notification manager merges them into one summary
+    auto libraryManager = componentManager->getComponent<EonPlay::Data::LibraryManager>();
+    if (libraryManager && m_notificationManager) {
+        connect(libraryManager.get(), &EonPlay::Data::LibraryManager::fileAdded,
+                m_notificationManager.get(), &NotificationManager::onFileAdded);
+    }
+    
+    // Dropped folders and multi-file opens arrive in batches; each is queued in one go
+    auto playlistManager = componentManager->getComponent<EonPlay::Data::PlaylistManager>();
+    if (playlistManager && m_fileUrlSupport) {
+        connect(m_fileUrlSupport.get(), &FileUrlSupport::mediaBatchReady,
+                this, [playlistManager](const QStringList& filePaths) {
+                    QList<EonPlay::Data::MediaFile> files;
+                    files.reserve(filePaths.size());
+                    for (const QString& filePath : filePaths) {
+                        EonPlay::Data::MediaFile file;
+                        file.setFilePath(filePath, false);
+                        files.append(file);
+                    }
+                    playlistManager->addToQueue(files);
+                });
         
-        if (libraryManager && playlistManager) {
-            m_libraryWidget->initialize(libraryManager.get(), playlistManager.get());
-            m_playlistWidget->initialize(playlistManager.get());
-            
-            // Connect library widget signals
-            connect(m_libraryWidget, &LibraryWidget::playRequested,
-                    this, [this](const QString& filePath) {
-                        // TODO: Connect to media engine
-                        updateStatusBar(tr("Playing: %1").arg(QFileInfo(filePath).fileName()));
-                    });
-            
-            connect(m_libraryWidget, &LibraryWidget::queueRequested,
-                    this, [this](const QString& filePath) {
-                        updateStatusBar(tr("Added file to queue: %1").arg(QFileInfo(filePath).fileName()));
-                    });
-            
-            // Connect playlist widget signals
-            connect(m_playlistWidget, &PlaylistWidget::playRequested,
-                    this, [this](const QString& filePath) {
-                        // TODO: Connect to media engine
-                        updateStatusBar(tr("Playing: %1").arg(QFileInfo(filePath).fileName()));
-                    });
-        }
+        connect(m_fileUrlSupport.get(), &FileUrlSupport::ingestFinished,
+                this, [this](int acceptedCount, const QStringList& failedFiles) {
+                    updateStatusBar(tr("Added %1 files to queue, %2 skipped")
+                                    .arg(acceptedCount).arg(failedFiles.size()));
+                });
     }
     
+    restoreSession();
+    
     return true;
 }
 
@@ -246,11 +258,36 @@ void MainWindow::setStatusBarVisible(bool visible)
 
 void MainWindow::showWindow()
 {
+    setWindowState(windowState() & ~Qt::WindowMinimized);
     show();
     raise();
     activateWindow();
 }
 
+void MainWindow::openFiles(const QStringList& files)
+{
+    if (!m_fileUrlSupport) {
+        return;
+    }
+    
+    QStringList paths;
+    for (const QString& file : files) {
+        const QUrl url(file);
+        if (url.scheme().size() > 1 && !QFileInfo::exists(file)) {
+            m_fileUrlSupport->loadMediaUrl(url);
+        } else {
+            paths.append(file);
+        }
+    }
+    
+    // A single file opens directly; several files or a folder are ingested into the queue
+    if (paths.size() == 1 && !QFileInfo(paths.first()).isDir()) {
+        m_fileUrlSupport->loadMediaFile(paths.first());
+    } else if (!paths.isEmpty()) {
+        m_fileUrlSupport->ingestMedia(paths);
+    }
+}
+
 void MainWindow::updateWindowTitle(const QString& mediaTitle)
 {
     QString title = "EonPlay - Timeless Media Player";
@@ -418,32 +455,153 @@ void MainWindow::onToggleStatusBar()
 }
 
 void MainWindow::onTogglePlaylist()
+{
+    bool visible = !m_playlistWidget || m_playlistWidget->isHidden();
+    setSidePanelVisible(visible ? playlistWidget() : m_playlistWidget, m_togglePlaylistAction, visible);
+}
+
+void MainWindow::onToggleLibrary()
+{
+    bool visible = !m_libraryWidget || m_libraryWidget->isHidden();
+    setSidePanelVisible(visible ? libraryWidget() : m_libraryWidget, m_toggleLibraryAction, visible);
+}
+
+void MainWindow::onToggleMediaInfo()
+{
+    bool visible = !m_mediaInfoWidget || m_mediaInfoWidget->isHidden();
+    setSidePanelVisible(visible ? mediaInfoWidget() : m_mediaInfoWidget, m_toggleMediaInfoAction, visible);
+}
+
+void MainWindow::warmUpPanels()
+{
+    // One panel per pass keeps input and playback responsive in between
+    if (!m_playlistWidget) {
+        playlistWidget();
+    } else if (!m_mediaInfoWidget) {
+        mediaInfoWidget();
+    } else if (!m_libraryWidget) {
+        libraryWidget();
+    } else {
+        return;
+    }
+    QTimer::singleShot(0, this, &MainWindow::warmUpPanels);
+}
+
+MediaInfoWidget* MainWindow::mediaInfoWidget()
+{
+    if (!m_mediaInfoWidget) {
+        m_mediaInfoWidget = new MediaInfoWidget;
+        insertSidePanel(m_mediaInfoWidget, 0);
+    }
+    return m_mediaInfoWidget;
+}
+
+PlaylistWidget* MainWindow::playlistWidget()
 {
     if (m_playlistWidget) {
-        bool visible = !m_playlistWidget->isVisible();
-        m_playlistWidget->setVisible(visible);
-        m_togglePlaylistAction->setChecked(visible);
+        return m_playlistWidget;
     }
+    
+    m_playlistWidget = new PlaylistWidget(this);
+    insertSidePanel(m_playlistWidget, 1);
+    
+    auto playlistManager = m_componentManager
+        ? m_componentManager->getComponent<EonPlay::Data::PlaylistManager>() : nullptr;
+    if (playlistManager) {
+        m_playlistWidget->initialize(playlistManager.get());
+        
+        connect(m_playlistWidget, &PlaylistWidget::playRequested,
+                this, [this](const QString& filePath) {
+                    // TODO: Connect to media engine
+                    updateStatusBar(tr("Playing: %1").arg(QFileInfo(filePath).fileName()));
+                });
+    }
+    return m_playlistWidget;
 }
 
-void MainWindow::onToggleLibrary()
+LibraryWidget* MainWindow::libraryWidget()
 {
     if (m_libraryWidget) {
-        bool visible = !m_libraryWidget->isVisible();
-        m_libraryWidget->setVisible(visible);
-        m_toggleLibraryAction->setChecked(visible);
+        return m_libraryWidget;
     }
+    
+    m_libraryWidget = new LibraryWidget(this);
+    insertSidePanel(m_libraryWidget, 2);
+    
+    if (!m_componentManager) {
+        return m_libraryWidget;
+    }
+    auto libraryManager = m_componentManager->getComponent<EonPlay::Data::LibraryManager>();
+    auto playlistManager = m_componentManager->getComponent<EonPlay::Data::PlaylistManager>();
+    if (libraryManager && playlistManager) {
+        m_libraryWidget->initialize(libraryManager.get(), playlistManager.get());
+        
+        connect(m_libraryWidget, &LibraryWidget::playRequested,
+                this, [this](const QString& filePath) {
+                    // TODO: Connect to media engine
+                    updateStatusBar(tr("Playing: %1").arg(QFileInfo(filePath).fileName()));
+                });
+        
+        connect(m_libraryWidget, &LibraryWidget::queueRequested,
+                this, [this](const QString& filePath) {
+                    updateStatusBar(tr("Added file to queue: %1").arg(QFileInfo(filePath).fileName()));
+                });
+    }
+    return m_libraryWidget;
 }
 
-void MainWindow::onToggleMediaInfo()
+void MainWindow::insertSidePanel(QWidget* panel, int slot)
 {
-    if (m_mediaInfoWidget) {
-        bool visible = !m_mediaInfoWidget->isVisible();
-        m_mediaInfoWidget->setVisible(visible);
-        m_toggleMediaInfoAction->setChecked(visible);
+    // Panels keep their order in the splitter whichever is built first
+    const QWidget* const panels[SidePanelCount] = {m_mediaInfoWidget, m_playlistWidget, m_libraryWidget};
+    int index = 0;
+    for (int i = 0; i < slot; ++i) {
+        if (panels[i]) {
+            ++index;
+        }
+    }
+    
+    panel->setVisible(false);
+    m_rightSplitter->insertWidget(index, panel);
+    
+    // Saved sizes only fit once every panel is in place
+    if (m_rightSplitter->count() == SidePanelCount) {
+        if (m_rightSplitterState.isEmpty() || !m_rightSplitter->restoreState(m_rightSplitterState)) {
+            m_rightSplitter->setSizes({200, 200, 200});
+        }
     }
 }
 
+void MainWindow::setSidePanelVisible(QWidget* panel, QAction* action, bool visible)
+{
+    if (panel) {
+        panel->setVisible(visible);
+    }
+    action->setChecked(visible);
+    
+    // The splitter only takes space while one of its panels is shown
+    bool anyVisible = false;
+    for (int i = 0; i < m_rightSplitter->count(); ++i) {
+        anyVisible = anyVisible || !m_rightSplitter->widget(i)->isHidden();
+    }
+    m_rightSplitter->setVisible(anyVisible);
+}
+
+void MainWindow::onToggleMetricsOverlay()
+{
+    if (!m_metricsOverlay) {
+        m_metricsOverlay = new MetricsOverlay(m_centralWidget ? m_centralWidget : this);
+        m_metricsOverlay->move(8, 8);
+    }
+    
+    bool visible = !m_metricsOverlay->isVisible();
+    m_metricsOverlay->setVisible(visible);
+    if (visible) {
+        m_metricsOverlay->raise();
+    }
+    m_toggleMetricsOverlayAction->setChecked(visible);
+}
+
 void MainWindow::onPreferences()
 {
     // TODO: Show preferences dialog when implemented
@@ -550,6 +708,12 @@ void MainWindow::createMenuBar()
     m_toggleMediaInfoAction->setChecked(false);
     connect(m_toggleMediaInfoAction, &QAction::triggered, this, &MainWindow::onToggleMediaInfo);
     
+    m_toggleMetricsOverlayAction = m_viewMenu->addAction(tr("Show Performance &Metrics"));
+    m_toggleMetricsOverlayAction->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_M));
+    m_toggleMetricsOverlayAction->setCheckable(true);
+    m_toggleMetricsOverlayAction->setChecked(false);
+    connect(m_toggleMetricsOverlayAction, &QAction::triggered, this, &MainWindow::onToggleMetricsOverlay);
+    
     // Tools Menu
     m_toolsMenu = m_menuBar->addMenu(tr("&Tools"));
     
@@ -694,27 +858,11 @@ void MainWindow::createCentralWidget()
     m_rightSplitter = new QSplitter(Qt::Vertical);
     m_rightSplitter->setVisible(false); // Hidden by default
     
-    // Create media info widget
-    m_mediaInfoWidget = new MediaInfoWidget;
-    m_mediaInfoWidget->setVisible(false); // Hidden by default
-    m_rightSplitter->addWidget(m_mediaInfoWidget);
-    
-    // TODO: Add playlist and library widgets in future tasks
-    // Create playlist widget
-    m_playlistWidget = new PlaylistWidget(this);
-    m_playlistWidget->setVisible(false);
-    m_rightSplitter->addWidget(m_playlistWidget);
-    
-    // Create library widget
-    m_libraryWidget = new LibraryWidget(this);
-    m_libraryWidget->setVisible(false);
-    m_rightSplitter->addWidget(m_libraryWidget);
-    
+    // Media info, playlist and library panels are added on first show
     m_mainSplitter->addWidget(m_rightSplitter);
     
     // Set splitter proportions
     m_mainSplitter->setSizes({800, 300});
-    m_rightSplitter->setSizes({200, 200, 200});
     
     // Create playback controls
     m_playbackControls = new PlaybackControls;
@@ -866,7 +1014,10 @@ void MainWindow::saveState()
     m_settings->setValue("menuBarVisible", menuBar()->isVisible());
     m_settings->setValue("statusBarVisible", statusBar()->isVisible());
     m_settings->setValue("splitterState", m_mainSplitter->saveState());
-    m_settings->setValue("rightSplitterState", m_rightSplitter->saveState());
+    if (m_rightSplitter->count() == SidePanelCount) {
+        m_rightSplitterState = m_rightSplitter->saveState();
+    }
+    m_settings->setValue("rightSplitterState", m_rightSplitterState);
     m_settings->endGroup();
     
     // Save system integration settings
@@ -911,7 +1062,7 @@ void MainWindow::restoreState()
     setStatusBarVisible(statusVisible);
     
     m_mainSplitter->restoreState(m_settings->value("splitterState").toByteArray());
-    m_rightSplitter->restoreState(m_settings->value("rightSplitterState").toByteArray());
+    m_rightSplitterState = m_settings->value("rightSplitterState").toByteArray();
     m_settings->endGroup();
     
     // Restore recent files
@@ -934,6 +1085,128 @@ void MainWindow::restoreState()
     updateRecentFilesMenu();
 }
 
+void MainWindow::restoreSessionLayout()
+{
+    auto snapshot = std::make_unique<SessionSnapshot>();
+    if (!snapshot->open(SessionSnapshot::defaultPath())) {
+        return;
+    }
+    
+    // Newer than the settings when both exist, as it is written on quit
+    const SessionSnapshot::Layout layout = snapshot->layout();
+    if (!layout.geometry.isEmpty()) {
+        restoreGeometry(layout.geometry);
+        QMainWindow::restoreState(layout.windowState);
+        m_mainSplitter->restoreState(layout.mainSplitter);
+    }
+    if (!layout.sidePanels.isEmpty()) {
+        m_rightSplitterState = layout.sidePanels;
+    }
+    m_sessionSnapshot = std::move(snapshot);
+}
+
+void MainWindow::restoreSession()
+{
+    if (!m_sessionSnapshot) {
+        return;
+    }
+    
+    // Open panels are built now rather than by warmUpPanels(), so they are in the first frame
+    const quint32 visiblePanels = m_sessionSnapshot->layout().visiblePanels;
+    if (visiblePanels & (1u << 0)) {
+        setSidePanelVisible(mediaInfoWidget(), m_toggleMediaInfoAction, true);
+    }
+    if (visiblePanels & (1u << 1)) {
+        setSidePanelVisible(playlistWidget(), m_togglePlaylistAction, true);
+    }
+    if (visiblePanels & (1u << 2)) {
+        setSidePanelVisible(libraryWidget(), m_toggleLibraryAction, true);
+        
+        // Same page as before; only its rows are read, and its thumbnails decode in the background
+        const SessionSnapshot::LibraryPage page = m_sessionSnapshot->libraryPage();
+        m_libraryWidget->setViewMode(static_cast<LibraryWidget::ViewMode>(page.viewMode));
+        m_libraryWidget->setSortBy(static_cast<LibraryWidget::SortBy>(page.sortBy));
+        m_libraryWidget->setFilterBy(static_cast<LibraryWidget::FilterBy>(page.filterBy));
+        m_libraryWidget->setSearchText(page.searchText);
+        m_libraryWidget->warmCoverArt(m_sessionSnapshot->warmCacheKeys());
+        m_libraryWidget->scrollToRow(page.firstRow);
+    }
+    
+    // The media shows where it was left; it is only opened when played
+    const SessionSnapshot::Playback playback = m_sessionSnapshot->playback();
+    if (!playback.filePath.isEmpty() && m_playbackControls) {
+        m_playbackControls->setMediaFile(playback.filePath);
+        m_playbackControls->setDuration(playback.duration);
+        m_playbackControls->setPosition(playback.position);
+        updateWindowTitle(QFileInfo(playback.filePath).completeBaseName());
+    }
+    
+    const SessionSnapshot::Queue queue = m_sessionSnapshot->queue();
+    if (!queue.filePaths.isEmpty() && m_mediaInfoLabel) {
+        m_mediaInfoLabel->setText(queue.currentIndex >= 0
+            ? tr("Queue: %1 of %2").arg(queue.currentIndex + 1).arg(queue.filePaths.size())
+            : tr("Queue: %1 items").arg(queue.filePaths.size()));
+    }
+    
+    m_sessionSnapshot.reset();
+}
+
+void MainWindow::saveSessionSnapshot()
+{
+    // Still mapped if the components never came up; the last snapshot stays then
+    if (m_sessionSnapshot) {
+        return;
+    }
+    
+    SessionSnapshot snapshot;
+    
+    SessionSnapshot::Layout layout;
+    layout.geometry = saveGeometry();
+    layout.windowState = QMainWindow::saveState();
+    layout.mainSplitter = m_mainSplitter->saveState();
+    layout.sidePanels = m_rightSplitter->count() == SidePanelCount ? m_rightSplitter->saveState() : m_rightSplitterState;
+    const QWidget* const panels[SidePanelCount] = {m_mediaInfoWidget, m_playlistWidget, m_libraryWidget};
+    for (int i = 0; i < SidePanelCount; ++i) {
+        if (panels[i] && !panels[i]->isHidden()) {
+            layout.visiblePanels |= 1u << i;
+        }
+    }
+    snapshot.setLayout(layout);
+    
+    SessionSnapshot::Playback playback;
+    if (m_playbackControls) {
+        playback.filePath = m_playbackControls->mediaFile();
+        playback.position = m_playbackControls->position();
+        playback.duration = m_playbackControls->duration();
+    }
+    snapshot.setPlayback(playback);
+    
+    auto playlistManager = m_componentManager
+        ? m_componentManager->getComponent<EonPlay::Data::PlaylistManager>() : nullptr;
+    if (playlistManager) {
+        SessionSnapshot::Queue queue;
+        const QList<EonPlay::Data::MediaFile> files = playlistManager->getCurrentQueue();
+        for (const EonPlay::Data::MediaFile& file : files) {
+            queue.filePaths.append(file.filePath());
+        }
+        queue.currentIndex = playback.filePath.isEmpty() ? -1 : int(queue.filePaths.indexOf(playback.filePath));
+        snapshot.setQueue(queue);
+    }
+    
+    if (m_libraryWidget) {
+        SessionSnapshot::LibraryPage page;
+        page.viewMode = m_libraryWidget->getViewMode();
+        page.sortBy = m_libraryWidget->getSortBy();
+        page.filterBy = m_libraryWidget->getFilterBy();
+        page.searchText = m_libraryWidget->getSearchText();
+        page.firstRow = m_libraryWidget->firstVisibleRow();
+        snapshot.setLibraryPage(page);
+        snapshot.setWarmCacheKeys(m_libraryWidget->visibleCoverArt());
+    }
+    
+    snapshot.save(SessionSnapshot::defaultPath());
+}
+
 void MainWindow::updateRecentFilesMenu()
 {
     m_recentFilesMenu->clear();
@@ -1191,20 +1464,7 @@ void MainWindow::initializeSystemIntegration()
     if (MediaKeysManager::isSupported()) {
         m_mediaKeysManager = std::make_unique<MediaKeysManager>(this);
         if (m_mediaKeysManager->initialize()) {
-            // Connect media key signals
-            connect(m_mediaKeysManager.get(), &MediaKeysManager::playPausePressed,
-                    this, [this]() { updateStatusBar(tr("Play/Pause key pressed")); });
-            connect(m_mediaKeysManager.get(), &MediaKeysManager::stopPressed,
-                    this, [this]() { updateStatusBar(tr("Stop key pressed")); });
-            connect(m_mediaKeysManager.get(), &MediaKeysManager::nextPressed,
-                    this, [this]() { updateStatusBar(tr("Next key pressed")); });
-            connect(m_mediaKeysManager.get(), &MediaKeysManager::previousPressed,
-                    this, [this]() { updateStatusBar(tr("Previous key pressed")); });
-            connect(m_mediaKeysManager.get(), &MediaKeysManager::volumeUpPressed,
-                    this, [this]() { updateStatusBar(tr("Volume up")); });
-            connect(m_mediaKeysManager.get(), &MediaKeysManager::volumeDownPressed,
-                    this, [this]() { updateStatusBar(tr("Volume down")); });
-            
+            // Presses reach handleHotkeyAction through the hotkey keymap
             qDebug() << "Media keys initialized successfully";
         } else {
             qWarning() << "Failed to initialize media keys";
@@ -1253,6 +1513,12 @@ void MainWindow::initializeSystemIntegration()
                 this, [this](const QString& actionId) {
             handleHotkeyAction(actionId);
         });
+        connect(m_hotkeyManager.get(), &HotkeyManager::actionRepeated,
+                this, &MainWindow::handleHotkeyRepeat);
+        
+        if (m_mediaKeysManager) {
+            m_mediaKeysManager->setHotkeyManager(m_hotkeyManager.get());
+        }
         
         qDebug() << "Hotkey manager initialized successfully";
     } else {
@@ -1366,12 +1632,42 @@ void MainWindow::handleHotkeyAction(const QString& actionId)
     } else if (actionId == "toggle_library") {
         onToggleLibrary();
     } else if (actionId == "seek_forward") {
-        updateStatusBar(tr("Seek forward hotkey pressed"));
-        // TODO: Connect to media engine when available
+        seekBy(SeekStepMs);
     } else if (actionId == "seek_backward") {
-        updateStatusBar(tr("Seek backward hotkey pressed"));
-        // TODO: Connect to media engine when available
+        seekBy(-SeekStepMs);
     } else {
         updateStatusBar(tr("Unknown hotkey action: %1").arg(actionId));
     }
+}
+
+void MainWindow::handleHotkeyRepeat(const QString& actionId, qint64 intervalMs, qint64 heldMs)
+{
+    if (actionId == "seek_forward" || actionId == "seek_backward") {
+        // Scrub by elapsed time rather than per repeat, so the speed does
+        // not depend on the keyboard's repeat rate
+        const double rate = qMin(MaxScrubRate, MinScrubRate * std::exp2(heldMs / 1000.0));
+        const qint64 offset = qRound64(rate * qMin<qint64>(intervalMs, MaxScrubIntervalMs));
+        seekBy(actionId == "seek_forward" ? offset : -offset);
+    } else {
+        handleHotkeyAction(actionId);
+    }
+}
+
+void MainWindow::seekBy(qint64 offsetMs)
+{
+    if (!m_playbackControls || m_playbackControls->duration() <= 0) {
+        updateStatusBar(offsetMs > 0 ? tr("Seek forward hotkey pressed") : tr("Seek backward hotkey pressed"));
+        return;
+    }
+    
+    const qint64 position = qBound<qint64>(0, m_playbackControls->position() + offsetMs,
+                                           m_playbackControls->duration());
+    m_playbackControls->setPosition(position);
+    
+    int seconds = static_cast<int>(position / 1000);
+    int minutes = seconds / 60;
+    seconds %= 60;
+    QString timeStr = QString("%1:%2").arg(minutes, 2, 10, QChar('0')).arg(seconds, 2, 10, QChar('0'));
+    updateStatusBar(tr("Seek to %1").arg(timeStr));
+    // TODO: Connect to media engine when available
 }
\ No newline at end of file
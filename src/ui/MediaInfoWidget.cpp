@@ -1,5 +1,8 @@
 #include "ui/MediaInfoWidget.h"
 #include "media/FileUrlSupport.h"
+#include "media/VLCBackend.h"
+#include "ui/UpdateScheduler.h"
+#include "ui/VideoWidget.h"
 #include <QLoggingCategory>
 #include <QPushButton>
 #include <QSplitter>
@@ -16,14 +19,13 @@ MediaInfoWidget::MediaInfoWidget(QWidget* parent)
     , m_showTechnicalDetails(false)
     , m_autoUpdate(true)
     , m_compactMode(false)
-    , m_updateTimer(new QTimer(this))
 {
     initializeUI();
     
-    // Set up update timer
-    m_updateTimer->setSingleShot(false);
-    m_updateTimer->setInterval(1000); // Update every second
-    connect(m_updateTimer, &QTimer::timeout, this, &MediaInfoWidget::refreshMediaInfo);
+    // Media info itself only changes with the media and arrives through FileUrlSupport's signals
+    
+    connect(&MediaOpenProfiler::instance(), &MediaOpenProfiler::profileCompleted,
+            this, &MediaInfoWidget::updateOpenProfile);
     
     qCDebug(mediaInfoWidget) << "MediaInfoWidget created";
 }
@@ -63,6 +65,36 @@ void MediaInfoWidget::setFileUrlSupport(std::shared_ptr<FileUrlSupport> fileUrlS
     }
 }
 
+void MediaInfoWidget::setVideoWidget(VideoWidget* videoWidget)
+{
+    m_videoWidget = videoWidget;
+    m_playbackStatsGroup->setVisible(videoWidget != nullptr);
+    
+    // Live statistics once a second, only while this widget can be seen
+    if (videoWidget) {
+        UpdateScheduler::instance().subscribe(this, PLAYBACK_STATS_RATE_HZ, [this]() { updatePlaybackStats(); });
+        if (isVisible()) {
+            updatePlaybackStats();
+        }
+    } else {
+        UpdateScheduler::instance().unsubscribe(this);
+    }
+}
+
+void MediaInfoWidget::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    
+    // Described from memory; nothing is read from the file
+    if (m_autoUpdate) {
+        refreshMediaInfo();
+    }
+    
+    if (m_videoWidget) {
+        updatePlaybackStats();
+    }
+}
+
 void MediaInfoWidget::updateMediaInfo(const MediaInfo& mediaInfo)
 {
     m_currentMediaInfo = mediaInfo;
@@ -107,6 +139,8 @@ void MediaInfoWidget::clearMediaInfo()
     m_filePathLabel->clear();
     m_hasVideoLabel->clear();
     m_hasAudioLabel->clear();
+    m_openLatencyLabel->clear();
+    m_openLatencyLabel->setToolTip(QString());
     
     // Hide sections
     m_videoInfoGroup->setVisible(false);
@@ -132,9 +166,7 @@ void MediaInfoWidget::setAutoUpdate(bool autoUpdate)
         m_autoUpdate = autoUpdate;
         
         if (autoUpdate) {
-            m_updateTimer->start();
-        } else {
-            m_updateTimer->stop();
+            refreshMediaInfo();
         }
         
         qCDebug(mediaInfoWidget) << "Auto-update" << (autoUpdate ? "enabled" : "disabled");
@@ -218,6 +250,7 @@ void MediaInfoWidget::initializeUI()
     contentLayout->addWidget(createVideoInfoSection());
     contentLayout->addWidget(createAudioInfoSection());
     contentLayout->addWidget(createTechnicalInfoSection());
+    contentLayout->addWidget(createPlaybackStatsSection());
     
     // Add stretch to push content to top
     contentLayout->addStretch();
@@ -349,6 +382,11 @@ QWidget* MediaInfoWidget::createTechnicalInfoSection()
     m_hasAudioLabel = new QLabel();
     layout->addWidget(m_hasAudioLabel, 2, 1);
     
+    // Time to first frame, phases in the tooltip
+    layout->addWidget(new QLabel("Open Latency:"), 3, 0);
+    m_openLatencyLabel = new QLabel();
+    layout->addWidget(m_openLatencyLabel, 3, 1);
+    
     // Set column stretch
     layout->setColumnStretch(1, 1);
     
@@ -358,6 +396,86 @@ QWidget* MediaInfoWidget::createTechnicalInfoSection()
     return m_technicalInfoGroup;
 }
 
+QWidget* MediaInfoWidget::createPlaybackStatsSection()
+{
+    m_playbackStatsGroup = new QGroupBox("Playback Statistics");
+    QGridLayout* layout = new QGridLayout(m_playbackStatsGroup);
+    
+    // Decoder in use
+    layout->addWidget(new QLabel("Decoder:"), 0, 0);
+    m_decoderLabel = new QLabel();
+    layout->addWidget(m_decoderLabel, 0, 1);
+    
+    // Dropped pictures, recent rate and totals
+    layout->addWidget(new QLabel("Dropped Frames:"), 1, 0);
+    m_droppedFramesLabel = new QLabel();
+    layout->addWidget(m_droppedFramesLabel, 1, 1);
+    
+    // Presentation intervals over the rolling window
+    layout->addWidget(new QLabel("Frame Time:"), 2, 0);
+    m_frameTimeLabel = new QLabel();
+    layout->addWidget(m_frameTimeLabel, 2, 1);
+    
+    // Frames that missed their vsync
+    layout->addWidget(new QLabel("Late Frames:"), 3, 0);
+    m_lateFramesLabel = new QLabel();
+    layout->addWidget(m_lateFramesLabel, 3, 1);
+    
+    // Bitrate read from the input
+    layout->addWidget(new QLabel("Input Bitrate:"), 4, 0);
+    m_inputBitrateLabel = new QLabel();
+    layout->addWidget(m_inputBitrateLabel, 4, 1);
+    
+    // Set column stretch
+    layout->setColumnStretch(1, 1);
+    
+    // Shown once a video view is set
+    m_playbackStatsGroup->setVisible(false);
+    
+    return m_playbackStatsGroup;
+}
+
+void MediaInfoWidget::updatePlaybackStats()
+{
+    if (!m_videoWidget || !isVisible()) {
+        return;
+    }
+    
+    const FrameTimingStats::Snapshot timing = m_videoWidget->frameTimingStats();
+    m_frameTimeLabel->setText(QString("%1 fps, p50 %2 ms, p99 %3 ms, max %4 ms")
+                                  .arg(timing.fps, 0, 'f', 1)
+                                  .arg(timing.p50Ms, 0, 'f', 1)
+                                  .arg(timing.p99Ms, 0, 'f', 1)
+                                  .arg(timing.maxMs, 0, 'f', 1));
+    m_lateFramesLabel->setText(QString("%1 of %2 (%3 vsync misses), %4 not shown")
+                                   .arg(timing.late)
+                                   .arg(timing.presented)
+                                   .arg(timing.vsyncMisses)
+                                   .arg(timing.superseded));
+    
+    VLCBackend* backend = m_videoWidget->vlcBackend();
+    const VLCBackend::DecoderStats decoder = backend ? backend->decoderStats() : VLCBackend::DecoderStats();
+    if (!decoder.valid) {
+        m_decoderLabel->setText(backend ? decoder.decoder : "N/A");
+        m_droppedFramesLabel->setText("N/A");
+        m_inputBitrateLabel->setText("N/A");
+        return;
+    }
+    
+    m_decoderLabel->setText(decoder.decoder);
+    m_droppedFramesLabel->setText(QString("%1% now, %2 of %3 decoded")
+                                      .arg(decoder.dropPercent, 0, 'f', 1)
+                                      .arg(decoder.lostPictures + decoder.poolDroppedPictures)
+                                      .arg(decoder.decodedVideo));
+    m_droppedFramesLabel->setToolTip(QString("Lost by the decoder: %1\nNo free frame buffer: %2\n"
+                                             "Audio buffers lost: %3\nCorrupted demux blocks: %4")
+                                         .arg(decoder.lostPictures)
+                                         .arg(decoder.poolDroppedPictures)
+                                         .arg(decoder.lostAudioBuffers)
+                                         .arg(decoder.demuxCorrupted));
+    m_inputBitrateLabel->setText(formatBitrate(static_cast<int>(decoder.inputBitrate)));
+}
+
 void MediaInfoWidget::updateBasicInfo(const MediaInfo& mediaInfo)
 {
     m_titleLabel->setText(mediaInfo.title.isEmpty() ? "Unknown" : mediaInfo.title);
@@ -402,6 +520,18 @@ void MediaInfoWidget::updateAudioInfo(const MediaInfo& mediaInfo)
     }
 }
 
+void MediaInfoWidget::updateOpenProfile(const MediaOpenProfile& profile)
+{
+    if (!profile.isComplete()) {
+        return;
+    }
+    
+    m_openLatencyLabel->setText(QString("%1 ms to first %2")
+                                    .arg(profile.timeToFirstFrameMs(), 0, 'f', 0)
+                                    .arg(profile.video ? "frame" : "audio"));
+    m_openLatencyLabel->setToolTip(profile.summary());
+}
+
 void MediaInfoWidget::updateTechnicalInfo(const MediaInfo& mediaInfo)
 {
     m_filePathLabel->setText(mediaInfo.filePath.isEmpty() ? "Unknown" : mediaInfo.filePath);
@@ -1,4 +1,5 @@
 #include "ui/MediaKeysManager.h"
+#include "ui/HotkeyManager.h"
 #include "media/IMediaEngine.h"
 #include <QApplication>
 #include <QWidget>
@@ -65,10 +66,8 @@ MediaKeysManager::MediaKeysManager(QObject* parent)
     , m_mprisInterface(nullptr)
 #endif
 {
-    // Create debounce timer
-    m_debounceTimer = new QTimer(this);
-    m_debounceTimer->setSingleShot(true);
-    m_debounceTimer->setInterval(DEBOUNCE_INTERVAL_MS);
+    m_clock.start();
+    m_lastPressMs.fill(-DEBOUNCE_INTERVAL_MS);
     
     qCDebug(mediaKeys) << "MediaKeysManager created";
 }
@@ -152,6 +151,11 @@ void MediaKeysManager::setMediaEngine(std::shared_ptr<IMediaEngine> mediaEngine)
     }
 }
 
+void MediaKeysManager::setHotkeyManager(HotkeyManager* manager)
+{
+    m_hotkeyManager = manager;
+}
+
 void MediaKeysManager::setEnabled(bool enabled)
 {
     if (m_enabled != enabled) {
@@ -240,93 +244,86 @@ bool MediaKeysManager::nativeEventFilter(const QByteArray& eventType, void* mess
 
 void MediaKeysManager::onPlayPause()
 {
-    if (m_debounceTimer->isActive() && m_lastKeyPressed == "play_pause") {
-        return;
-    }
-    
-    m_lastKeyPressed = "play_pause";
-    m_debounceTimer->start();
-    
-    emit playPausePressed();
-    qCDebug(mediaKeys) << "Play/Pause key pressed";
+    handleKey(PlayPauseKey);
 }
 
 void MediaKeysManager::onStop()
 {
-    if (m_debounceTimer->isActive() && m_lastKeyPressed == "stop") {
-        return;
-    }
-    
-    m_lastKeyPressed = "stop";
-    m_debounceTimer->start();
-    
-    emit stopPressed();
-    qCDebug(mediaKeys) << "Stop key pressed";
+    handleKey(StopKey);
 }
 
 void MediaKeysManager::onNext()
 {
-    if (m_debounceTimer->isActive() && m_lastKeyPressed == "next") {
-        return;
-    }
-    
-    m_lastKeyPressed = "next";
-    m_debounceTimer->start();
-    
-    emit nextPressed();
-    qCDebug(mediaKeys) << "Next key pressed";
+    handleKey(NextKey);
 }
 
 void MediaKeysManager::onPrevious()
 {
-    if (m_debounceTimer->isActive() && m_lastKeyPressed == "previous") {
-        return;
-    }
-    
-    m_lastKeyPressed = "previous";
-    m_debounceTimer->start();
-    
-    emit previousPressed();
-    qCDebug(mediaKeys) << "Previous key pressed";
+    handleKey(PreviousKey);
 }
 
 void MediaKeysManager::onVolumeUp()
 {
-    if (m_debounceTimer->isActive() && m_lastKeyPressed == "volume_up") {
-        return;
-    }
-    
-    m_lastKeyPressed = "volume_up";
-    m_debounceTimer->start();
-    
-    emit volumeUpPressed();
-    qCDebug(mediaKeys) << "Volume Up key pressed";
+    handleKey(VolumeUpKey);
 }
 
 void MediaKeysManager::onVolumeDown()
 {
-    if (m_debounceTimer->isActive() && m_lastKeyPressed == "volume_down") {
-        return;
-    }
-    
-    m_lastKeyPressed = "volume_down";
-    m_debounceTimer->start();
-    
-    emit volumeDownPressed();
-    qCDebug(mediaKeys) << "Volume Down key pressed";
+    handleKey(VolumeDownKey);
 }
 
 void MediaKeysManager::onMute()
 {
-    if (m_debounceTimer->isActive() && m_lastKeyPressed == "mute") {
+    handleKey(MuteKey);
+}
+
+void MediaKeysManager::handleKey(MediaKey key)
+{
+    static constexpr Qt::Key qtKeys[MediaKeyCount] = {
+        Qt::Key_MediaTogglePlayPause, Qt::Key_MediaStop, Qt::Key_MediaNext,
+        Qt::Key_MediaPrevious, Qt::Key_VolumeUp, Qt::Key_VolumeDown, Qt::Key_VolumeMute
+    };
+    
+    // The keymap does its own repeat handling
+    if (m_hotkeyManager) {
+        m_hotkeyManager->postGlobalKey(qtKeys[key]);
+    }
+    
+    const qint64 now = m_clock.elapsed();
+    const qint64 sinceLast = now - m_lastPressMs[key];
+    m_lastPressMs[key] = now;
+    
+    if (key != VolumeUpKey && key != VolumeDownKey && sinceLast < DEBOUNCE_INTERVAL_MS) {
         return;
     }
     
-    m_lastKeyPressed = "mute";
-    m_debounceTimer->start();
+    switch (key) {
+    case PlayPauseKey:
+        emit playPausePressed();
+        break;
+    case StopKey:
+        emit stopPressed();
+        break;
+    case NextKey:
+        emit nextPressed();
+        break;
+    case PreviousKey:
+        emit previousPressed();
+        break;
+    case VolumeUpKey:
+        emit volumeUpPressed();
+        break;
+    case VolumeDownKey:
+        emit volumeDownPressed();
+        break;
+    case MuteKey:
+        emit mutePressed();
+        break;
+    case MediaKeyCount:
+        return;
+    }
     
-    emit mutePressed();
-    qCDebug(mediaKeys) << "Mute key pressed";
+    qCDebug(mediaKeys) << "Media key pressed:" << qtKeys[key];
 }
 
 #ifdef Q_OS_WIN
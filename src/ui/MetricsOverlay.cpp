@@ -0,0 +1,96 @@
+#include "ui/MetricsOverlay.h"
+#include "ui/UpdateScheduler.h"
+#include <QFontDatabase>
+#include <QLabel>
+#include <QVBoxLayout>
+
+namespace {
+
+QString formatLatency(qint64 microseconds)
+{
+    if (microseconds < 1000) {
+        return QString("%1us").arg(microseconds);
+    }
+    if (microseconds < 1000000) {
+        return QString("%1ms").arg(microseconds / 1000.0, 0, 'f', 1);
+    }
+    return QString("%1s").arg(microseconds / 1e6, 0, 'f', 2);
+}
+
+QString displayName(QByteArray name)
+{
+    if (name.startsWith("eonplay_")) {
+        name.remove(0, 8);
+    }
+    if (name.endsWith("_seconds")) {
+        name.chop(8);
+    }
+    return QString::fromLatin1(name);
+}
+
+} // namespace
+
+MetricsOverlay::MetricsOverlay(QWidget* parent)
+    : QWidget(parent)
+    , m_label(new QLabel(this))
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setAttribute(Qt::WA_StyledBackground);
+    setStyleSheet("MetricsOverlay { background-color: rgba(0, 0, 0, 170); border-radius: 4px; }"
+                  "QLabel { color: #7fffd4; background: transparent; }");
+    
+    m_label->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    m_label->setTextFormat(Qt::PlainText);
+    
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(8, 6, 8, 6);
+    layout->addWidget(m_label);
+    
+    UpdateScheduler::instance().subscribe(this, 1000 / REFRESH_INTERVAL_MS, [this]() { refresh(); });
+}
+
+MetricsOverlay::~MetricsOverlay() = default;
+
+void MetricsOverlay::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    m_previous = MetricsSnapshot();
+    refresh();
+}
+
+void MetricsOverlay::refresh()
+{
+    const MetricsSnapshot current = MetricsRegistry::instance().snapshot();
+    const double elapsed = m_previous.timestampMs > 0 ? (current.timestampMs - m_previous.timestampMs) / 1000.0 : 0.0;
+    
+    QStringList lines;
+    for (auto it = current.counters.constBegin(); it != current.counters.constEnd(); ++it) {
+        QString line = QString("%1 %2").arg(displayName(it.key()), -28).arg(it.value());
+        if (elapsed > 0.0) {
+            const quint64 before = m_previous.counters.value(it.key(), it.value());
+            line += QString("  (%1/s)").arg((it.value() - before) / elapsed, 0, 'f', 1);
+        }
+        lines << line;
+    }
+    
+    for (auto it = current.gauges.constBegin(); it != current.gauges.constEnd(); ++it) {
+        lines << QString("%1 %2").arg(displayName(it.key()), -28).arg(it.value());
+    }
+    
+    for (auto it = current.histograms.constBegin(); it != current.histograms.constEnd(); ++it) {
+        const HistogramSnapshot& histogram = it.value();
+        lines << QString("%1 p50 %2  p99 %3  max %4  n=%5")
+                     .arg(displayName(it.key()), -28)
+                     .arg(formatLatency(histogram.percentile(0.5)), formatLatency(histogram.percentile(0.99)),
+                          formatLatency(histogram.max))
+                     .arg(histogram.count);
+    }
+    
+    if (lines.isEmpty()) {
+        lines << tr("No metrics recorded yet");
+    }
+    
+    m_label->setText(lines.join('\n'));
+    adjustSize();
+    m_previous = current;
+}
@@ -1,6 +1,7 @@
 #include "ui/MiniPlayerWidget.h"
 #include "media/PlaybackController.h"
 #include "ui/VideoWidget.h"
+#include "ui/VideoSurfaceView.h"
 #include <QApplication>
 #include <QScreen>
 #include <QLoggingCategory>
@@ -19,7 +20,7 @@ MiniPlayerWidget::MiniPlayerWidget(QWidget* parent)
     , m_seekLayout(new QHBoxLayout())
     , m_volumeLayout(new QHBoxLayout())
     , m_videoContainer(new QWidget(this))
-    , m_videoWidget(nullptr)
+    , m_videoSurface(new VideoSurfaceView(m_videoContainer))
     , m_albumArtLabel(new QLabel(this))
     , m_playPauseButton(new QPushButton(this))
     , m_stopButton(new QPushButton(this))
@@ -41,7 +42,6 @@ MiniPlayerWidget::MiniPlayerWidget(QWidget* parent)
     , m_autoHideTimeout(DEFAULT_AUTO_HIDE_TIMEOUT)
     , m_dragging(false)
     , m_autoHideTimer(new QTimer(this))
-    , m_updateTimer(new QTimer(this))
 {
     setupUI();
     setupConnections();
@@ -57,7 +57,6 @@ MiniPlayerWidget::MiniPlayerWidget(QWidget* parent)
     
     // Setup timers
     m_autoHideTimer->setSingleShot(true);
-    m_updateTimer->setInterval(100); // Update every 100ms
     
     qCDebug(miniPlayer) << "MiniPlayerWidget created";
 }
@@ -70,10 +69,12 @@ MiniPlayerWidget::~MiniPlayerWidget()
 void MiniPlayerWidget::setPlaybackController(PlaybackController* controller)
 {
     if (m_playbackController) {
+        m_playbackController->unsubscribePosition(this);
         disconnect(m_playbackController, nullptr, this, nullptr);
     }
     
     m_playbackController = controller;
+    updatePositionSubscription();
     
     if (m_playbackController) {
         // Connect to playback controller signals
@@ -88,17 +89,9 @@ void MiniPlayerWidget::setPlaybackController(PlaybackController* controller)
 
 void MiniPlayerWidget::setVideoWidget(VideoWidget* videoWidget)
 {
-    if (m_videoWidget) {
-        m_videoWidget->setParent(nullptr);
-    }
-    
-    m_videoWidget = videoWidget;
-    
-    if (m_videoWidget && m_playerMode == VideoMode) {
-        m_videoWidget->setParent(m_videoContainer);
-        m_videoWidget->resize(m_videoContainer->size());
-        m_videoWidget->show();
-    }
+    // Same decoded frames as the main view: no reparenting, no second video output.
+    // The surface only takes frames while the video container is shown.
+    m_videoSurface->setSource(videoWidget);
 }
 
 MiniPlayerWidget::PlayerMode MiniPlayerWidget::getPlayerMode() const
@@ -293,11 +286,6 @@ void MiniPlayerWidget::leaveEvent(QEvent* event)
 void MiniPlayerWidget::resizeEvent(QResizeEvent* event)
 {
     QWidget::resizeEvent(event);
-    
-    // Resize video widget if present
-    if (m_videoWidget && m_playerMode == VideoMode) {
-        m_videoWidget->resize(m_videoContainer->size());
-    }
 }
 
 void MiniPlayerWidget::closeEvent(QCloseEvent* event)
@@ -306,6 +294,20 @@ void MiniPlayerWidget::closeEvent(QCloseEvent* event)
     event->accept();
 }
 
+void MiniPlayerWidget::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    updatePositionSubscription();
+}
+
+void MiniPlayerWidget::hideEvent(QHideEvent* event)
+{
+    QWidget::hideEvent(event);
+    
+    // Hidden or minimized: stop position updates entirely
+    updatePositionSubscription();
+}
+
 void MiniPlayerWidget::contextMenuEvent(QContextMenuEvent* event)
 {
     m_contextMenu->exec(event->globalPos());
@@ -374,8 +376,8 @@ void MiniPlayerWidget::updatePlaybackInfo()
     
     // Update title and time labels
     // m_titleLabel->setText(m_playbackController->getCurrentTitle());
-    // m_timeLabel->setText(formatTime(m_playbackController->getPosition()) + 
-    //                     " / " + formatTime(m_playbackController->getDuration()));
+    m_timeLabel->setText(formatTime(m_playbackController->position()) +
+                         " / " + formatTime(m_playbackController->duration()));
 }
 
 void MiniPlayerWidget::setupUI()
@@ -420,8 +422,11 @@ void MiniPlayerWidget::setupUI()
         }
     )");
     
-    // Setup video container
+    // Setup video container; the surface fills it and scales the picture itself
     m_videoContainer->setStyleSheet("background-color: black;");
+    auto* videoLayout = new QVBoxLayout(m_videoContainer);
+    videoLayout->setContentsMargins(0, 0, 0, 0);
+    videoLayout->addWidget(m_videoSurface);
     
     // Setup album art label
     m_albumArtLabel->setAlignment(Qt::AlignCenter);
@@ -476,10 +481,6 @@ void MiniPlayerWidget::setupConnections()
     
     // Timer connections
     connect(m_autoHideTimer, &QTimer::timeout, this, &MiniPlayerWidget::onAutoHideTimeout);
-    connect(m_updateTimer, &QTimer::timeout, this, &MiniPlayerWidget::updatePlaybackInfo);
-    
-    // Start update timer
-    m_updateTimer->start();
 }
 
 void MiniPlayerWidget::createContextMenu()
@@ -550,12 +551,6 @@ void MiniPlayerWidget::updateControlsLayout()
             m_videoContainer->setVisible(true);
             m_albumArtLabel->setVisible(false);
             
-            if (m_videoWidget) {
-                m_videoWidget->setParent(m_videoContainer);
-                m_videoWidget->resize(m_videoContainer->size());
-                m_videoWidget->show();
-            }
-            
             setFixedSize(DEFAULT_WIDTH, DEFAULT_HEIGHT);
             break;
             
@@ -644,13 +639,29 @@ void MiniPlayerWidget::updatePositionSlider()
     }
     
     // Update slider position
-    // qint64 position = m_playbackController->getPosition();
-    // qint64 duration = m_playbackController->getDuration();
+    qint64 position = m_playbackController->position();
+    qint64 duration = m_playbackController->duration();
     
-    // if (duration > 0) {
-    //     int sliderValue = static_cast<int>((position * 1000) / duration);
-    //     m_positionSlider->setValue(sliderValue);
-    // }
+    if (duration > 0) {
+        int sliderValue = static_cast<int>((position * 1000) / duration);
+        m_positionSlider->setValue(sliderValue);
+    }
+}
+
+void MiniPlayerWidget::updatePositionSubscription()
+{
+    if (!m_playbackController) {
+        return;
+    }
+    
+    if (isVisible()) {
+        m_playbackController->subscribePosition(this, POSITION_UPDATE_INTERVAL_MS, [this](qint64) {
+            updatePlaybackInfo();
+            updatePositionSlider();
+        });
+    } else {
+        m_playbackController->unsubscribePosition(this);
+    }
 }
 
 void MiniPlayerWidget::updateVolumeSlider()
@@ -11,6 +11,7 @@
 #include <QFont>
 #include <QFontMetrics>
 #include <QFileInfo>
+#include <QLocale>
 #include <QLoggingCategory>
 
 Q_LOGGING_CATEGORY(notifications, "eonplay.notifications")
@@ -81,6 +82,17 @@ void NotificationWidget::setNotification(const NotificationData& data)
     }
 }
 
+void NotificationWidget::updateNotification(const NotificationData& data)
+{
+    m_currentNotification = data;
+    updateContent();
+    update();
+    
+    if (m_isVisible && !m_isAnimating && data.duration > 0) {
+        m_autoHideTimer->start(data.duration);
+    }
+}
+
 void NotificationWidget::showNotification()
 {
     if (m_isVisible || m_isAnimating) {
@@ -259,7 +271,14 @@ void NotificationWidget::updateContent()
     // Set message
     m_messageLabel->setText(m_currentNotification.message);
     
-    // Set icon
+    // Set icon; the pixmap is only loaded again when its source changes
+    const QString iconKey = !m_currentNotification.iconPath.isEmpty() ? m_currentNotification.iconPath
+        : m_currentNotification.isUrgent ? QStringLiteral(":warning") : QStringLiteral(":information");
+    if (iconKey == m_iconKey) {
+        return;
+    }
+    m_iconKey = iconKey;
+    
     if (!m_currentNotification.iconPath.isEmpty()) {
         QPixmap iconPixmap(m_currentNotification.iconPath);
         if (!iconPixmap.isNull()) {
@@ -286,10 +305,17 @@ NotificationManager::NotificationManager(QObject* parent)
     : QObject(parent)
     , m_parentWidget(nullptr)
     , m_activeNotification(nullptr)
+    , m_updatePending(false)
+    , m_refreshTimer(nullptr)
     , m_defaultDuration(3000)
     , m_enabled(true)
     , m_position(Qt::TopRightCorner)
 {
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setSingleShot(true);
+    m_refreshTimer->setInterval(SUMMARY_REFRESH_INTERVAL_MS);
+    connect(m_refreshTimer, &QTimer::timeout, this, &NotificationManager::refreshActiveNotification);
+    
     qCDebug(notifications) << "NotificationManager created";
 }
 
@@ -340,20 +366,89 @@ void NotificationManager::showNotification(const NotificationData& data)
         return;
     }
     
+    if (!data.category.isEmpty() && mergeNotification(data)) {
+        return;
+    }
+    
+    // Past the limit the oldest routine notification makes room
+    if (m_notificationQueue.size() >= MAX_QUEUED_NOTIFICATIONS) {
+        int dropIndex = 0;
+        for (int i = 0; i < m_notificationQueue.size(); ++i) {
+            if (!m_notificationQueue.at(i).isUrgent) {
+                dropIndex = i;
+                break;
+            }
+        }
+        qCDebug(notifications) << "Notification dropped:" << m_notificationQueue.at(dropIndex).title;
+        m_notificationQueue.removeAt(dropIndex);
+    }
+    
     // Add to queue
     m_notificationQueue.enqueue(data);
     
     // Process if no active notification
-    if (!m_activeNotification || !m_activeNotification->isNotificationVisible()) {
+    if (!m_activeNotification || !m_activeNotification->isActive()) {
         processNextNotification();
     }
     
     qCDebug(notifications) << "Notification queued:" << data.title;
 }
 
+bool NotificationManager::mergeNotification(const NotificationData& data)
+{
+    // Into the one on screen, unless it is already fading out
+    if (m_activeNotification && m_activeNotification->isActive() && !m_activeNotification->isHiding()) {
+        const NotificationData& shown = m_updatePending ? m_pendingUpdate
+                                                        : m_activeNotification->getCurrentNotification();
+        if (shown.category == data.category) {
+            NotificationData merged = shown;
+            merged.count += data.count;
+            merged.message = summaryMessage(merged);
+            merged.isUrgent = merged.isUrgent || data.isUrgent;
+            m_pendingUpdate = merged;
+            m_updatePending = true;
+            if (!m_refreshTimer->isActive()) {
+                m_refreshTimer->start();
+            }
+            return true;
+        }
+    }
+    
+    for (NotificationData& queued : m_notificationQueue) {
+        if (queued.category == data.category) {
+            queued.count += data.count;
+            queued.message = summaryMessage(queued);
+            queued.isUrgent = queued.isUrgent || data.isUrgent;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+QString NotificationManager::summaryMessage(const NotificationData& data) const
+{
+    const QString format = data.summary.isEmpty() ? tr("%1 notifications") : data.summary;
+    return format.arg(QLocale().toString(data.count));
+}
+
+void NotificationManager::refreshActiveNotification()
+{
+    if (!m_updatePending) {
+        return;
+    }
+    m_updatePending = false;
+    
+    if (m_activeNotification && m_activeNotification->isActive() && !m_activeNotification->isHiding()) {
+        m_activeNotification->updateNotification(m_pendingUpdate);
+    }
+}
+
 void NotificationManager::clearAllNotifications()
 {
     m_notificationQueue.clear();
+    m_updatePending = false;
+    m_refreshTimer->stop();
     
     if (m_activeNotification && m_activeNotification->isNotificationVisible()) {
         m_activeNotification->hideNotification();
@@ -386,6 +481,32 @@ void NotificationManager::onError(const QString& title, const QString& message)
     showNotification(title, message, 5000, true); // Longer duration for errors, marked as urgent
 }
 
+void NotificationManager::onFileAdded(const QString& filePath)
+{
+    NotificationData data(tr("Library"), tr("Added: %1").arg(QFileInfo(filePath).fileName()), m_defaultDuration);
+    data.category = QStringLiteral("library.fileAdded");
+    data.summary = tr("%1 files added");
+    showNotification(data);
+}
+
+void NotificationManager::onSubtitleAutoLoaded(const QString& mediaFilePath, const QString& subtitlePath)
+{
+    NotificationData data(tr("Subtitles Loaded"),
+                          tr("%1 for %2").arg(QFileInfo(subtitlePath).fileName(), QFileInfo(mediaFilePath).fileName()),
+                          m_defaultDuration);
+    data.category = QStringLiteral("subtitles.autoLoaded");
+    data.summary = tr("Subtitles loaded for %1 files");
+    showNotification(data);
+}
+
+void NotificationManager::onOperationCompleted(const QString& operation)
+{
+    NotificationData data(operation, tr("Completed"), m_defaultDuration);
+    data.category = QStringLiteral("operation.") + operation;
+    data.summary = tr("Completed %1 times");
+    showNotification(data);
+}
+
 void NotificationManager::onNotificationClosed()
 {
     // Process next notification in queue
@@ -406,22 +527,20 @@ void NotificationManager::processNextNotification()
         return;
     }
     
-    // Clean up previous notification
-    if (m_activeNotification) {
-        m_activeNotification->deleteLater();
-        m_activeNotification = nullptr;
+    // The next one waits until the widget has finished hiding
+    NotificationWidget* widget = notificationWidget();
+    if (widget->isActive()) {
+        return;
     }
     
     // Get next notification
     NotificationData data = m_notificationQueue.dequeue();
-    
-    // Create new notification widget
-    m_activeNotification = createNotificationWidget();
-    m_activeNotification->setNotification(data);
+    m_updatePending = false;
+    widget->setNotification(data);
     
     // Position and show
-    positionNotificationWidget(m_activeNotification);
-    m_activeNotification->showNotification();
+    positionNotificationWidget(widget);
+    widget->showNotification();
     
     qCDebug(notifications) << "Processing notification:" << data.title;
 }
@@ -459,13 +578,17 @@ void NotificationManager::positionNotificationWidget(NotificationWidget* widget)
     widget->move(x, y);
 }
 
-NotificationWidget* NotificationManager::createNotificationWidget()
+NotificationWidget* NotificationManager::notificationWidget()
 {
-    NotificationWidget* widget = new NotificationWidget(m_parentWidget);
+    if (m_activeNotification) {
+        return m_activeNotification;
+    }
+    
+    m_activeNotification = new NotificationWidget(m_parentWidget);
     
     // Connect signals
-    connect(widget, &NotificationWidget::closed, this, &NotificationManager::onNotificationClosed);
-    connect(widget, &NotificationWidget::clicked, this, &NotificationManager::onNotificationClicked);
+    connect(m_activeNotification, &NotificationWidget::closed, this, &NotificationManager::onNotificationClosed);
+    connect(m_activeNotification, &NotificationWidget::clicked, this, &NotificationManager::onNotificationClicked);
     
-    return widget;
+    return m_activeNotification;
 }
\ No newline at end of file
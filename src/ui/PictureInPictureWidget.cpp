@@ -1,5 +1,6 @@
 #include "ui/PictureInPictureWidget.h"
 #include "ui/VideoWidget.h"
+#include "ui/VideoSurfaceView.h"
 #include "media/PlaybackController.h"
 #include <QApplication>
 #include <QScreen>
@@ -15,7 +16,7 @@ PictureInPictureWidget::PictureInPictureWidget(QWidget* parent)
     , m_mainLayout(new QVBoxLayout(this))
     , m_controlsLayout(new QHBoxLayout())
     , m_videoContainer(new QWidget(this))
-    , m_videoWidget(nullptr)
+    , m_videoSurface(new VideoSurfaceView(m_videoContainer))
     , m_playPauseButton(new QPushButton(this))
     , m_volumeButton(new QPushButton(this))
     , m_closeButton(new QPushButton(this))
@@ -33,9 +34,13 @@ PictureInPictureWidget::PictureInPictureWidget(QWidget* parent)
     , m_dragging(false)
     , m_resizing(false)
     , m_autoHideTimer(new QTimer(this))
-    , m_updateTimer(new QTimer(this))
     , m_opacityEffect(new QGraphicsOpacityEffect(this))
 {
+    // The surface fills the container and scales the picture itself
+    auto* videoLayout = new QVBoxLayout(m_videoContainer);
+    videoLayout->setContentsMargins(0, 0, 0, 0);
+    videoLayout->addWidget(m_videoSurface);
+    
     setupUI();
     setupConnections();
     createContextMenu();
@@ -51,7 +56,6 @@ PictureInPictureWidget::PictureInPictureWidget(QWidget* parent)
     
     // Setup timers
     m_autoHideTimer->setSingleShot(true);
-    m_updateTimer->setInterval(100);
     
     qCDebug(pictureInPicture) << "PictureInPictureWidget created";
 }
@@ -63,17 +67,8 @@ PictureInPictureWidget::~PictureInPictureWidget()
 
 void PictureInPictureWidget::setVideoWidget(VideoWidget* videoWidget)
 {
-    if (m_videoWidget) {
-        m_videoWidget->setParent(nullptr);
-    }
-    
-    m_videoWidget = videoWidget;
-    
-    if (m_videoWidget) {
-        m_videoWidget->setParent(m_videoContainer);
-        m_videoWidget->resize(m_videoContainer->size());
-        m_videoWidget->show();
-    }
+    // Same decoded frames as the main view: no reparenting, no second video output
+    m_videoSurface->setSource(videoWidget);
 }
 
 void PictureInPictureWidget::setPlaybackController(PlaybackController* controller)
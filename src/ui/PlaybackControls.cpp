@@ -1,5 +1,10 @@
 #include "ui/PlaybackControls.h"
 #include "ComponentManager.h"
+#include "ui/WaveformOverviewWidget.h"
+#include "audio/WaveformPeaks.h"
+#include "data/LibraryManager.h"
+#include "data/WaveformStore.h"
+#include <QFileInfo>
 #include <QApplication>
 #include <QStyle>
 #include <QMouseEvent>
@@ -28,6 +33,8 @@ PlaybackControls::PlaybackControls(QWidget* parent)
     , m_skipNextButton(nullptr)
     , m_seekSlider(nullptr)
     , m_seekPreviewLabel(nullptr)
+    , m_waveformView(nullptr)
+    , m_loudnessScanner(nullptr)
     , m_volumeSlider(nullptr)
     , m_muteButton(nullptr)
     , m_volumeLabel(nullptr)
@@ -71,6 +78,14 @@ bool PlaybackControls::initialize(ComponentManager* componentManager)
     // TODO: Get PlaybackController from component manager when available
     // m_playbackController = componentManager->getComponent<PlaybackController>();
     
+    // Waveform overviews come from the library's analysis pass
+    auto libraryManager = componentManager->getComponent<EonPlay::Data::LibraryManager>();
+    if (libraryManager && libraryManager->loudnessScanner()) {
+        m_loudnessScanner = libraryManager->loudnessScanner();
+        connect(m_loudnessScanner, &EonPlay::Data::LoudnessScanner::waveformReady,
+                this, &PlaybackControls::onWaveformReady);
+    }
+    
     return true;
 }
 
@@ -84,6 +99,7 @@ void PlaybackControls::setPosition(qint64 position)
             m_seekSlider->blockSignals(true);
             m_seekSlider->setValue(sliderValue);
             m_seekSlider->blockSignals(false);
+            m_waveformView->setProgress(static_cast<double>(position) / m_duration);
         }
         
         updateTimeDisplay();
@@ -158,6 +174,7 @@ void PlaybackControls::setControlsEnabled(bool enabled)
         m_stopButton->setEnabled(enabled);
         m_skipNextButton->setEnabled(enabled);
         m_seekSlider->setEnabled(enabled);
+        m_waveformView->setEnabled(enabled);
         m_volumeSlider->setEnabled(enabled);
         m_muteButton->setEnabled(enabled);
         m_speedComboBox->setEnabled(enabled);
@@ -195,8 +212,58 @@ void PlaybackControls::updateDuration(qint64 duration)
     setDuration(duration);
 }
 
+void PlaybackControls::setMediaFile(const QString& filePath)
+{
+    m_mediaFilePath = filePath;
+    m_waveformView->setPeaks(nullptr);
+    m_waveformView->setVisible(false);
+    
+    // Streams and other URLs have no overview
+    if (filePath.isEmpty() || !QFileInfo(filePath).isFile()) {
+        return;
+    }
+    
+    if (!loadWaveform() && m_loudnessScanner && m_loudnessScanner->isAvailable()) {
+        m_loudnessScanner->analyzeFiles(QStringList{filePath}, true);
+    }
+}
+
+bool PlaybackControls::loadWaveform()
+{
+    // A few tens of kilobytes even for long tracks
+    auto peaks = std::make_shared<WaveformPeaks>(
+        WaveformPeaks::deserialize(EonPlay::Data::WaveformStore().load(m_mediaFilePath)));
+    if (peaks->isEmpty()) {
+        return false;
+    }
+    
+    m_waveformView->setPeaks(peaks);
+    m_waveformView->setProgress(m_duration > 0 ? static_cast<double>(m_currentPosition) / m_duration : 0.0);
+    m_waveformView->setVisible(true);
+    return true;
+}
+
+void PlaybackControls::onWaveformReady(const QString& filePath)
+{
+    if (filePath == m_mediaFilePath && !m_waveformView->hasPeaks()) {
+        loadWaveform();
+    }
+}
+
+void PlaybackControls::onWaveformSeekRequested(double fraction)
+{
+    if (m_duration <= 0) {
+        return;
+    }
+    
+    const qint64 position = static_cast<qint64>(fraction * m_duration);
+    setPosition(position);
+    emit seekRequested(position);
+}
+
 void PlaybackControls::resetControls()
 {
+    setMediaFile(QString());
     setPosition(0);
     setDuration(0);
     setVolume(75);
@@ -261,7 +328,9 @@ void PlaybackControls::onSeekSliderChanged(int value)
         m_currentPosition = position;
         updateTimeDisplay();
         
-        if (!m_isSeekSliderPressed) {
+        if (m_isSeekSliderPressed) {
+            emit scrubRequested(position);
+        } else {
             emit seekRequested(position);
         }
     }
@@ -421,9 +490,21 @@ void PlaybackControls::createSeekControls()
     m_timeSeparatorLabel = new QLabel("/");
     m_timeSeparatorLabel->setAlignment(Qt::AlignCenter);
     
+    // Whole-track waveform above the slider, shown once the file has an overview
+    m_waveformView = new WaveformOverviewWidget;
+    m_waveformView->setVisible(false);
+    connect(m_waveformView, &WaveformOverviewWidget::seekRequested,
+            this, &PlaybackControls::onWaveformSeekRequested);
+    
+    QVBoxLayout* seekLayout = new QVBoxLayout;
+    seekLayout->setContentsMargins(0, 0, 0, 0);
+    seekLayout->setSpacing(0);
+    seekLayout->addWidget(m_waveformView);
+    seekLayout->addWidget(m_seekSlider);
+    
     // Add to layout
     m_mainLayout->addWidget(m_currentTimeLabel);
-    m_mainLayout->addWidget(m_seekSlider);
+    m_mainLayout->addLayout(seekLayout);
     m_mainLayout->addWidget(m_timeSeparatorLabel);
     m_mainLayout->addWidget(m_durationLabel);
     
@@ -0,0 +1,553 @@
+#include "ui/PlaylistModel.h"
+#include <QDataStream>
+#include <QFont>
+#include <QIODevice>
+#include <QMimeData>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+const char* const COLUMN_HEADERS[PlaylistModel::ColumnCount] = {
+    "Title",
+    "Artist",
+    "Album",
+    "Duration"
+};
+
+int compareFiles(const MediaFile& a, const MediaFile& b, Playlist::SortOrder order)
+{
+    switch (order) {
+        case Playlist::SortByTitle:
+            return a.title().compare(b.title(), Qt::CaseInsensitive);
+        case Playlist::SortByArtist:
+            return a.artist().compare(b.artist(), Qt::CaseInsensitive);
+        case Playlist::SortByAlbum:
+            return a.album().compare(b.album(), Qt::CaseInsensitive);
+        case Playlist::SortByDuration:
+            return a.duration() < b.duration() ? -1 : (a.duration() > b.duration() ? 1 : 0);
+        case Playlist::SortByDateAdded:
+            return a.dateAdded() < b.dateAdded() ? -1 : (b.dateAdded() < a.dateAdded() ? 1 : 0);
+        case Playlist::SortByPosition:
+            break;
+    }
+    return 0;
+}
+
+} // namespace
+
+PlaylistModel::PlaylistModel(QObject* parent)
+    : QAbstractTableModel(parent)
+    , m_sortOrder(Playlist::SortByPosition)
+    , m_sortDirection(Qt::AscendingOrder)
+    , m_rowCount(0)
+    , m_currentIndex(-1)
+    , m_cleared(false)
+{
+}
+
+PlaylistModel::~PlaylistModel() = default;
+
+void PlaylistModel::setPlaylist(std::shared_ptr<Playlist> playlist)
+{
+    if (m_playlist) {
+        disconnect(m_playlist.get(), nullptr, this, nullptr);
+    }
+
+    m_playlist = std::move(playlist);
+
+    if (m_playlist) {
+        connect(m_playlist.get(), &Playlist::itemAdded, this, &PlaylistModel::onItemAdded);
+        connect(m_playlist.get(), &Playlist::itemRemoved, this, &PlaylistModel::onItemRemoved);
+        connect(m_playlist.get(), &Playlist::itemMoved, this, &PlaylistModel::onItemMoved);
+        connect(m_playlist.get(), &Playlist::playlistCleared, this, &PlaylistModel::onPlaylistCleared);
+        connect(m_playlist.get(), &Playlist::playlistModified, this, &PlaylistModel::onPlaylistModified);
+        connect(m_playlist.get(), &Playlist::currentIndexChanged, this, &PlaylistModel::onCurrentIndexChanged);
+    }
+
+    reset();
+}
+
+void PlaylistModel::setSortOrder(Playlist::SortOrder order, Qt::SortOrder direction)
+{
+    if (m_sortOrder == order && (order == Playlist::SortByPosition || m_sortDirection == direction)) {
+        return;
+    }
+
+    m_sortOrder = order;
+    m_sortDirection = direction;
+    resort();
+}
+
+int PlaylistModel::playlistIndex(int row) const
+{
+    if (row < 0 || row >= m_rowCount) {
+        return -1;
+    }
+    return isSorted() ? m_order.value(row, -1) : row;
+}
+
+int PlaylistModel::rowOf(int playlistIndex) const
+{
+    if (isSorted()) {
+        return m_rows.value(playlistIndex, -1);
+    }
+    return playlistIndex >= 0 && playlistIndex < m_rowCount ? playlistIndex : -1;
+}
+
+MediaFile PlaylistModel::fileAt(int row) const
+{
+    return m_playlist ? m_playlist->item(playlistIndex(row)) : MediaFile();
+}
+
+int PlaylistModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_rowCount;
+}
+
+int PlaylistModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant PlaylistModel::data(const QModelIndex& index, int role) const
+{
+    const int itemIndex = playlistIndex(index.row());
+    if (!m_playlist || itemIndex < 0 || itemIndex >= m_playlist->itemCount()) {
+        return QVariant();
+    }
+
+    // A reference: rows are painted often and items are not copied for it
+    const MediaFile& file = m_playlist->items().at(itemIndex);
+
+    switch (role) {
+        case Qt::DisplayRole:
+            switch (index.column()) {
+                case TitleColumn:
+                    return file.title().isEmpty() ? file.fileName() : file.title();
+                case ArtistColumn:
+                    return file.artist();
+                case AlbumColumn:
+                    return file.album();
+                case DurationColumn:
+                    return file.durationString();
+            }
+            break;
+        case Qt::ToolTipRole:
+            return file.filePath();
+        case Qt::TextAlignmentRole:
+            if (index.column() == DurationColumn) {
+                return QVariant(Qt::AlignRight | Qt::AlignVCenter);
+            }
+            break;
+        case Qt::FontRole:
+            if (itemIndex == m_currentIndex) {
+                QFont font;
+                font.setBold(true);
+                return font;
+            }
+            break;
+        case FilePathRole:
+            return file.filePath();
+        case PlaylistIndexRole:
+            return itemIndex;
+    }
+
+    return QVariant();
+}
+
+QVariant PlaylistModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < ColumnCount) {
+        return QString::fromLatin1(COLUMN_HEADERS[section]);
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+Qt::ItemFlags PlaylistModel::flags(const QModelIndex& index) const
+{
+    // Rows are dropped between, never onto
+    if (!index.isValid()) {
+        return isSorted() ? Qt::NoItemFlags : Qt::ItemIsDropEnabled;
+    }
+
+    Qt::ItemFlags itemFlags = QAbstractTableModel::flags(index);
+    if (!isSorted()) {
+        itemFlags |= Qt::ItemIsDragEnabled;
+    }
+    return itemFlags;
+}
+
+Qt::DropActions PlaylistModel::supportedDropActions() const
+{
+    return Qt::MoveAction;
+}
+
+QStringList PlaylistModel::mimeTypes() const
+{
+    return { QString::fromLatin1(ROWS_MIME_TYPE) };
+}
+
+QMimeData* PlaylistModel::mimeData(const QModelIndexList& indexes) const
+{
+    QVector<int> indices;
+    for (const QModelIndex& index : indexes) {
+        const int itemIndex = playlistIndex(index.row());
+        if (itemIndex >= 0 && !indices.contains(itemIndex)) {
+            indices.append(itemIndex);
+        }
+    }
+
+    QByteArray encoded;
+    QDataStream stream(&encoded, QIODevice::WriteOnly);
+    stream << indices;
+
+    auto* mimeData = new QMimeData();
+    mimeData->setData(QString::fromLatin1(ROWS_MIME_TYPE), encoded);
+    return mimeData;
+}
+
+bool PlaylistModel::dropMimeData(const QMimeData* data, Qt::DropAction action, int row, int column,
+                                 const QModelIndex& parent)
+{
+    Q_UNUSED(column)
+
+    if (!m_playlist || isSorted() || action != Qt::MoveAction
+        || !data->hasFormat(QString::fromLatin1(ROWS_MIME_TYPE))) {
+        return false;
+    }
+
+    if (row < 0) {
+        row = parent.isValid() ? parent.row() : m_rowCount;
+    }
+
+    QVector<int> indices;
+    QDataStream stream(data->data(QString::fromLatin1(ROWS_MIME_TYPE)));
+    stream >> indices;
+    std::sort(indices.begin(), indices.end());
+
+    // Items above the drop row go down to just above it, last first so the
+    // ones already moved stay put; items below come up after them in order
+    int movedAbove = 0;
+    for (auto it = indices.crbegin(); it != indices.crend(); ++it) {
+        if (*it < row) {
+            m_playlist->moveItem(*it, row - 1 - movedAbove++);
+        }
+    }
+    int movedBelow = 0;
+    for (int index : std::as_const(indices)) {
+        if (index >= row) {
+            m_playlist->moveItem(index, row + movedBelow++);
+        }
+    }
+
+    // The rows have moved already; nothing is left for the view to remove
+    return false;
+}
+
+bool PlaylistModel::moveRows(const QModelIndex& sourceParent, int sourceRow, int count,
+                             const QModelIndex& destinationParent, int destinationChild)
+{
+    if (!m_playlist || isSorted() || sourceParent.isValid() || destinationParent.isValid()
+        || count <= 0 || sourceRow < 0 || sourceRow + count > m_rowCount
+        || destinationChild < 0 || destinationChild > m_rowCount) {
+        return false;
+    }
+
+    // Each move is its own playlist edit, and so its own row move
+    if (destinationChild > sourceRow) {
+        for (int i = 0; i < count; ++i) {
+            m_playlist->moveItem(sourceRow, destinationChild - 1);
+        }
+    } else {
+        for (int i = 0; i < count; ++i) {
+            m_playlist->moveItem(sourceRow + i, destinationChild + i);
+        }
+    }
+    return true;
+}
+
+void PlaylistModel::onItemAdded(int index)
+{
+    m_changes.append({Change::Insert, index, index});
+}
+
+void PlaylistModel::onItemRemoved(int index)
+{
+    m_changes.append({Change::Remove, index, index});
+}
+
+void PlaylistModel::onItemMoved(int fromIndex, int toIndex)
+{
+    m_changes.append({Change::Move, fromIndex, toIndex});
+}
+
+void PlaylistModel::onPlaylistCleared()
+{
+    m_changes.clear();
+    m_cleared = true;
+}
+
+void PlaylistModel::onPlaylistModified()
+{
+    const int itemCount = m_playlist ? m_playlist->itemCount() : 0;
+
+    if (m_cleared) {
+        reset();
+        return;
+    }
+
+    if (m_changes.isEmpty()) {
+        if (itemCount != m_rowCount) {
+            reset();
+        } else if (isSorted()) {
+            // Keys may have changed under the sort
+            resort();
+        } else if (m_rowCount > 0) {
+            emit dataChanged(index(0, 0), index(m_rowCount - 1, ColumnCount - 1));
+        }
+        return;
+    }
+
+    bool applied = false;
+    if (!isSorted()) {
+        applied = applyInPlaylistOrder();
+    } else if (m_changes.size() == 1) {
+        applySorted(m_changes.first());
+        applied = true;
+    }
+    m_changes.clear();
+
+    if (!applied || m_rowCount != itemCount) {
+        reset();
+    }
+}
+
+void PlaylistModel::onCurrentIndexChanged(int index)
+{
+    const int previousRow = rowOf(m_currentIndex);
+    m_currentIndex = index;
+    const int currentRow = rowOf(index);
+
+    for (int row : {previousRow, currentRow}) {
+        if (row >= 0 && row < m_rowCount) {
+            emit dataChanged(this->index(row, 0), this->index(row, ColumnCount - 1), {Qt::FontRole});
+        }
+    }
+}
+
+void PlaylistModel::reset()
+{
+    beginResetModel();
+    m_changes.clear();
+    m_cleared = false;
+    m_rowCount = m_playlist ? m_playlist->itemCount() : 0;
+    m_currentIndex = m_playlist ? m_playlist->currentIndex() : -1;
+    buildOrder();
+    endResetModel();
+}
+
+bool PlaylistModel::applyInPlaylistOrder()
+{
+    struct Run {
+        Change::Type type;
+        int first;
+        int last;
+    };
+
+    // Neighbouring inserts or removals collapse into one run: appends come
+    // in ascending order, batch removals from the end first
+    QVector<Run> runs;
+    for (const Change& change : std::as_const(m_changes)) {
+        if (!runs.isEmpty() && change.type != Change::Move && runs.last().type == change.type) {
+            Run& run = runs.last();
+            if (change.type == Change::Insert && change.index >= run.first && change.index <= run.last + 1) {
+                ++run.last;
+                continue;
+            }
+            // Indices count rows left after the run, so the row after it is run.first
+            if (change.type == Change::Remove && change.index == run.first) {
+                ++run.last;
+                continue;
+            }
+            if (change.type == Change::Remove && change.index == run.first - 1) {
+                --run.first;
+                continue;
+            }
+        }
+        if (runs.size() == MAX_ROW_SIGNALS) {
+            return false;
+        }
+        runs.append({change.type, change.index, change.type == Change::Move ? change.toIndex : change.index});
+    }
+
+    // Bounds are checked against the rows the views know, so a missed
+    // playlist signal ends in a reset instead of a bad row signal
+    int rowCount = m_rowCount;
+    for (const Run& run : std::as_const(runs)) {
+        const int count = run.last - run.first + 1;
+        const bool valid = run.type == Change::Insert ? run.first >= 0 && run.first <= rowCount
+                         : run.type == Change::Remove ? run.first >= 0 && run.last < rowCount
+                         : run.first >= 0 && run.first < rowCount && run.last >= 0 && run.last < rowCount;
+        if (!valid) {
+            return false;
+        }
+        rowCount += run.type == Change::Insert ? count : run.type == Change::Remove ? -count : 0;
+    }
+
+    for (const Run& run : std::as_const(runs)) {
+        switch (run.type) {
+            case Change::Insert:
+                beginInsertRows(QModelIndex(), run.first, run.last);
+                m_rowCount += run.last - run.first + 1;
+                endInsertRows();
+                break;
+            case Change::Remove:
+                beginRemoveRows(QModelIndex(), run.first, run.last);
+                m_rowCount -= run.last - run.first + 1;
+                endRemoveRows();
+                break;
+            case Change::Move:
+                // The destination counts rows before the move
+                beginMoveRows(QModelIndex(), run.first, run.first, QModelIndex(),
+                              run.last > run.first ? run.last + 1 : run.last);
+                endMoveRows();
+                break;
+        }
+    }
+    return true;
+}
+
+void PlaylistModel::applySorted(const Change& change)
+{
+    switch (change.type) {
+        case Change::Insert: {
+            for (int& itemIndex : m_order) {
+                if (itemIndex >= change.index) {
+                    ++itemIndex;
+                }
+            }
+            const auto position = std::lower_bound(m_order.cbegin(), m_order.cend(), change.index,
+                                                   [this](int a, int b) { return lessThan(a, b); });
+            const int row = static_cast<int>(position - m_order.cbegin());
+
+            beginInsertRows(QModelIndex(), row, row);
+            m_order.insert(row, change.index);
+            ++m_rowCount;
+            buildRows();
+            endInsertRows();
+            break;
+        }
+        case Change::Remove: {
+            const int row = m_rows.value(change.index, -1);
+            if (row < 0) {
+                return;
+            }
+
+            beginRemoveRows(QModelIndex(), row, row);
+            m_order.removeAt(row);
+            for (int& itemIndex : m_order) {
+                if (itemIndex > change.index) {
+                    --itemIndex;
+                }
+            }
+            --m_rowCount;
+            buildRows();
+            endRemoveRows();
+            break;
+        }
+        case Change::Move:
+            // Rows keep their sorted place, only the indices behind them shift
+            for (int& itemIndex : m_order) {
+                if (itemIndex == change.index) {
+                    itemIndex = change.toIndex;
+                } else if (change.index < change.toIndex && itemIndex > change.index && itemIndex <= change.toIndex) {
+                    --itemIndex;
+                } else if (change.index > change.toIndex && itemIndex >= change.toIndex && itemIndex < change.index) {
+                    ++itemIndex;
+                }
+            }
+            buildRows();
+            break;
+    }
+}
+
+void PlaylistModel::resort()
+{
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+    // Selections and the current row follow their items
+    const QModelIndexList persistent = persistentIndexList();
+    QVector<int> persistentItems;
+    persistentItems.reserve(persistent.size());
+    for (const QModelIndex& index : persistent) {
+        persistentItems.append(playlistIndex(index.row()));
+    }
+
+    buildOrder();
+
+    QModelIndexList updated;
+    updated.reserve(persistent.size());
+    for (int i = 0; i < persistent.size(); ++i) {
+        const int row = rowOf(persistentItems[i]);
+        updated.append(row >= 0 ? index(row, persistent[i].column()) : QModelIndex());
+    }
+    changePersistentIndexList(persistent, updated);
+
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+void PlaylistModel::buildOrder()
+{
+    m_order.clear();
+    m_rows.clear();
+    if (!isSorted()) {
+        return;
+    }
+
+    m_order.resize(m_rowCount);
+    std::iota(m_order.begin(), m_order.end(), 0);
+    std::sort(m_order.begin(), m_order.end(), [this](int a, int b) { return lessThan(a, b); });
+    buildRows();
+}
+
+void PlaylistModel::buildRows()
+{
+    m_rows.resize(m_order.size());
+    for (int row = 0; row < m_order.size(); ++row) {
+        m_rows[m_order[row]] = row;
+    }
+}
+
+bool PlaylistModel::lessThan(int a, int b) const
+{
+    const QList<MediaFile>& items = m_playlist->items();
+    const int result = compareFiles(items.at(a), items.at(b), m_sortOrder);
+    if (result != 0) {
+        return m_sortDirection == Qt::AscendingOrder ? result < 0 : result > 0;
+    }
+    // Equal keys keep the playlist order
+    return a < b;
+}
+
+PlaylistItemDelegate::PlaylistItemDelegate(QObject* parent)
+    : QStyledItemDelegate(parent)
+    , m_rowHeight(0)
+{
+}
+
+void PlaylistItemDelegate::setRowHeight(int height)
+{
+    if (m_rowHeight != height) {
+        m_rowHeight = height;
+        emit sizeHintChanged(QModelIndex());
+    }
+}
+
+QSize PlaylistItemDelegate::sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    if (m_rowHeight <= 0) {
+        return QStyledItemDelegate::sizeHint(option, index);
+    }
+    return QSize(option.rect.width(), m_rowHeight);
+}
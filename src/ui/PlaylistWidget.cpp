@@ -12,8 +12,7 @@
 #include <QInputDialog>
 #include <QMessageBox>
 #include <QHeaderView>
-#include <QTreeWidgetItem>
-#include <QListWidgetItem>
+#include <QItemSelectionModel>
 #include <QLoggingCategory>
 #include <QMutexLocker>
 #include <algorithm>
@@ -21,6 +20,29 @@
 Q_DECLARE_LOGGING_CATEGORY(playlistWidget)
 Q_LOGGING_CATEGORY(playlistWidget, "ui.playlist")
 
+namespace {
+
+Playlist::SortOrder playlistSortOrder(PlaylistWidget::SortBy sortBy)
+{
+    switch (sortBy) {
+        case PlaylistWidget::Title:
+            return Playlist::SortByTitle;
+        case PlaylistWidget::Artist:
+            return Playlist::SortByArtist;
+        case PlaylistWidget::Album:
+            return Playlist::SortByAlbum;
+        case PlaylistWidget::Duration:
+            return Playlist::SortByDuration;
+        case PlaylistWidget::DateAdded:
+            return Playlist::SortByDateAdded;
+        case PlaylistWidget::Default:
+            break;
+    }
+    return Playlist::SortByPosition;
+}
+
+} // namespace
+
 PlaylistWidget::PlaylistWidget(QWidget* parent)
     : QWidget(parent)
     , m_mainLayout(new QVBoxLayout(this))
@@ -36,8 +58,10 @@ PlaylistWidget::PlaylistWidget(QWidget* parent)
     , m_clearButton(new QPushButton("Clear", this))
     , m_moveUpButton(new QPushButton("↑", this))
     , m_moveDownButton(new QPushButton("↓", this))
-    , m_listWidget(new QListWidget(this))
-    , m_treeWidget(new QTreeWidget(this))
+    , m_model(new PlaylistModel(this))
+    , m_delegate(new PlaylistItemDelegate(this))
+    , m_listView(new QListView(this))
+    , m_treeView(new QTreeView(this))
     , m_currentView(nullptr)
     , m_statusLabel(new QLabel(this))
     , m_contextMenu(new QMenu(this))
@@ -101,7 +125,10 @@ void PlaylistWidget::setSortBy(SortBy sortBy)
     if (m_sortBy != sortBy) {
         m_sortBy = sortBy;
         m_sortByCombo->setCurrentIndex(static_cast<int>(sortBy));
-        updatePlaylistDisplay();
+        
+        // A view order only; the playlist keeps its own
+        m_model->setSortOrder(playlistSortOrder(sortBy));
+        onItemSelectionChanged();
     }
 }
 
@@ -116,10 +143,18 @@ void PlaylistWidget::setCurrentPlaylist(std::shared_ptr<Playlist> playlist)
     QMutexLocker locker(&m_dataMutex);
     
     if (m_currentPlaylist != playlist) {
+        if (m_currentPlaylist) {
+            disconnect(m_currentPlaylist.get(), nullptr, this, nullptr);
+        }
         m_currentPlaylist = playlist;
         locker.unlock();
         
-        populatePlaylistView();
+        if (m_currentPlaylist) {
+            connect(m_currentPlaylist.get(), &Playlist::playlistModified,
+                    this, &PlaylistWidget::updatePlaylistStats);
+        }
+        
+        m_model->setPlaylist(m_currentPlaylist);
         updatePlaylistStats();
         emit playlistChanged(m_currentPlaylist);
     }
@@ -129,25 +164,12 @@ QVector<std::shared_ptr<MediaFile>> PlaylistWidget::getSelectedFiles() const
 {
     QVector<std::shared_ptr<MediaFile>> selectedFiles;
     
-    if (m_displayMode == ListMode) {
-        QList<QListWidgetItem*> selectedItems = m_listWidget->selectedItems();
-        for (QListWidgetItem* item : selectedItems) {
-            QVariant fileData = item->data(Qt::UserRole);
-            if (fileData.isValid()) {
-                // Extract MediaFile from item data
-                // Implementation depends on how MediaFile is stored
-                qCDebug(playlistWidget) << "Selected file:" << item->text();
-            }
-        }
-    } else if (m_displayMode == TreeMode) {
-        QList<QTreeWidgetItem*> selectedItems = m_treeWidget->selectedItems();
-        for (QTreeWidgetItem* item : selectedItems) {
-            QVariant fileData = item->data(0, Qt::UserRole);
-            if (fileData.isValid()) {
-                // Extract MediaFile from item data
-                qCDebug(playlistWidget) << "Selected file:" << item->text(0);
-            }
-        }
+    if (!m_currentPlaylist) {
+        return selectedFiles;
+    }
+    
+    for (int index : selectedPlaylistIndices()) {
+        selectedFiles.append(std::make_shared<MediaFile>(m_currentPlaylist->item(index)));
     }
     
     return selectedFiles;
@@ -159,13 +181,17 @@ void PlaylistWidget::addFiles(const QVector<std::shared_ptr<MediaFile>>& files)
         return;
     }
     
-    // Add files to current playlist
-    for (auto file : files) {
-        // m_currentPlaylist->addMediaFile(file);
+    // Add files to current playlist; the items share the callers' records,
+    // and one batch reaches the views as one row insert
+    QList<MediaFile> items;
+    items.reserve(files.size());
+    for (const auto& file : files) {
+        if (file) {
+            items.append(*file);
+        }
     }
+    m_currentPlaylist->addItems(items);
     
-    populatePlaylistView();
-    updatePlaylistStats();
     emit playlistModified(m_currentPlaylist);
     
     qCDebug(playlistWidget) << "Added" << files.size() << "files to playlist";
@@ -177,26 +203,20 @@ void PlaylistWidget::removeSelectedFiles()
         return;
     }
     
-    QVector<std::shared_ptr<MediaFile>> selectedFiles = getSelectedFiles();
-    if (selectedFiles.isEmpty()) {
+    const QList<int> selectedIndices = selectedPlaylistIndices();
+    if (selectedIndices.isEmpty()) {
         return;
     }
     
     int ret = QMessageBox::question(this, "Remove Files", 
-                                   QString("Remove %1 files from playlist?").arg(selectedFiles.size()),
+                                   QString("Remove %1 files from playlist?").arg(selectedIndices.size()),
                                    QMessageBox::Yes | QMessageBox::No);
     
     if (ret == QMessageBox::Yes) {
-        // Remove files from playlist
-        for (auto file : selectedFiles) {
-            // m_currentPlaylist->removeMediaFile(file);
-        }
-        
-        populatePlaylistView();
-        updatePlaylistStats();
+        m_currentPlaylist->removeItems(selectedIndices);
         emit playlistModified(m_currentPlaylist);
         
-        qCDebug(playlistWidget) << "Removed" << selectedFiles.size() << "files from playlist";
+        qCDebug(playlistWidget) << "Removed" << selectedIndices.size() << "files from playlist";
     }
 }
 
@@ -211,10 +231,7 @@ void PlaylistWidget::clearPlaylist()
                                    QMessageBox::Yes | QMessageBox::No);
     
     if (ret == QMessageBox::Yes) {
-        // m_currentPlaylist->clear();
-        
-        populatePlaylistView();
-        updatePlaylistStats();
+        m_currentPlaylist->clear();
         emit playlistModified(m_currentPlaylist);
         
         qCDebug(playlistWidget) << "Playlist cleared";
@@ -227,9 +244,13 @@ void PlaylistWidget::shufflePlaylist()
         return;
     }
     
-    // m_currentPlaylist->shuffle();
+    // Shuffles the play order; the rows stay where they are
+    if (m_currentPlaylist->isShuffled()) {
+        m_currentPlaylist->reshuffle();
+    } else {
+        m_currentPlaylist->setShuffle(true);
+    }
     
-    populatePlaylistView();
     emit playlistModified(m_currentPlaylist);
     
     qCDebug(playlistWidget) << "Playlist shuffled";
@@ -419,9 +440,12 @@ void PlaylistWidget::dropEvent(QDropEvent* event)
     }
 }
 
-void PlaylistWidget::onItemDoubleClicked(QListWidgetItem* item)
+void PlaylistWidget::onItemDoubleClicked(const QModelIndex& index)
 {
-    Q_UNUSED(item)
+    const QString filePath = index.data(PlaylistModel::FilePathRole).toString();
+    if (!filePath.isEmpty()) {
+        emit playRequested(filePath);
+    }
     
     QVector<std::shared_ptr<MediaFile>> selectedFiles = getSelectedFiles();
     if (!selectedFiles.isEmpty()) {
@@ -431,11 +455,13 @@ void PlaylistWidget::onItemDoubleClicked(QListWidgetItem* item)
 
 void PlaylistWidget::onItemSelectionChanged()
 {
-    // Update button states based on selection
-    bool hasSelection = !getSelectedFiles().isEmpty();
+    // Update button states based on selection; a sorted view cannot be reordered
+    const bool canMove = !m_model->isSorted() && m_listView->selectionModel()->hasSelection();
     
-    m_moveUpButton->setEnabled(hasSelection);
-    m_moveDownButton->setEnabled(hasSelection);
+    m_moveUpButton->setEnabled(canMove);
+    m_moveDownButton->setEnabled(canMove);
+    m_moveUpAction->setEnabled(canMove);
+    m_moveDownAction->setEnabled(canMove);
 }
 
 void PlaylistWidget::onContextMenuRequested(const QPoint& pos)
@@ -498,7 +524,7 @@ void PlaylistWidget::onClearClicked()
 
 void PlaylistWidget::updatePlaylistDisplay()
 {
-    populatePlaylistView();
+    updateCurrentView();
 }
 
 void PlaylistWidget::setupUI()
@@ -532,18 +558,34 @@ void PlaylistWidget::setupUI()
     m_controlsLayout->addWidget(m_moveUpButton);
     m_controlsLayout->addWidget(m_moveDownButton);
     
-    // Setup views
-    m_listWidget->setAlternatingRowColors(true);
-    m_listWidget->setSelectionMode(QAbstractItemView::ExtendedSelection);
-    m_listWidget->setDragDropMode(QAbstractItemView::InternalMove);
-    
-    m_treeWidget->setAlternatingRowColors(true);
-    m_treeWidget->setSelectionMode(QAbstractItemView::ExtendedSelection);
-    m_treeWidget->setDragDropMode(QAbstractItemView::InternalMove);
-    m_treeWidget->setHeaderLabels({"Title", "Artist", "Album", "Duration"});
+    // Setup views; uniform rows let them place any row without measuring
+    m_listView->setModel(m_model);
+    m_listView->setItemDelegate(m_delegate);
+    m_listView->setUniformItemSizes(true);
+    m_listView->setAlternatingRowColors(true);
+    m_listView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_listView->setDragDropMode(QAbstractItemView::InternalMove);
+    m_listView->setDefaultDropAction(Qt::MoveAction);
+    
+    m_treeView->setModel(m_model);
+    m_treeView->setSelectionModel(m_listView->selectionModel());
+    m_treeView->setItemDelegate(m_delegate);
+    m_treeView->setUniformRowHeights(true);
+    m_treeView->setRootIsDecorated(false);
+    m_treeView->setAllColumnsShowFocus(true);
+    m_treeView->setAlternatingRowColors(true);
+    m_treeView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_treeView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_treeView->setDragDropMode(QAbstractItemView::InternalMove);
+    m_treeView->setDefaultDropAction(Qt::MoveAction);
+    m_treeView->header()->setStretchLastSection(false);
+    m_treeView->header()->setSectionResizeMode(PlaylistModel::TitleColumn, QHeaderView::Stretch);
+    m_treeView->hide();
+    
+    m_delegate->setRowHeight(fontMetrics().height() + 8);
     
     // Set initial view
-    m_currentView = m_listWidget;
+    m_currentView = m_listView;
     
     // Status
     m_statusLabel->setText("No playlist loaded");
@@ -581,18 +623,12 @@ void PlaylistWidget::setupConnections()
     connect(m_moveDownButton, &QPushButton::clicked,
             this, [this]() { moveSelectedItems(1); });
     
-    // View connections
-    connect(m_listWidget, &QListWidget::itemDoubleClicked,
+    // View connections; the views share one selection model
+    connect(m_listView, &QListView::doubleClicked,
             this, &PlaylistWidget::onItemDoubleClicked);
-    connect(m_listWidget, &QListWidget::itemSelectionChanged,
-            this, &PlaylistWidget::onItemSelectionChanged);
-    
-    connect(m_treeWidget, &QTreeWidget::itemDoubleClicked,
-            this, [this](QTreeWidgetItem* /*item*/, int column) {
-                Q_UNUSED(column)
-                onItemDoubleClicked(nullptr); // Convert to list widget item call
-            });
-    connect(m_treeWidget, &QTreeWidget::itemSelectionChanged,
+    connect(m_treeView, &QTreeView::doubleClicked,
+            this, &PlaylistWidget::onItemDoubleClicked);
+    connect(m_listView->selectionModel(), &QItemSelectionModel::selectionChanged,
             this, &PlaylistWidget::onItemSelectionChanged);
 }
 
@@ -633,52 +669,23 @@ void PlaylistWidget::createContextMenu()
     });
 }
 
-void PlaylistWidget::populatePlaylistView()
+void PlaylistWidget::updateCurrentView()
 {
-    if (!m_currentPlaylist) {
-        m_listWidget->clear();
-        m_treeWidget->clear();
-        m_statusLabel->setText("No playlist loaded");
-        return;
+    // Compact mode is the list with tighter rows
+    const int padding = m_displayMode == CompactMode ? 2 : 8;
+    if (m_delegate->rowHeight() != fontMetrics().height() + padding) {
+        m_delegate->setRowHeight(fontMetrics().height() + padding);
+        m_listView->doItemsLayout();
+        m_treeView->doItemsLayout();
     }
     
-    // Clear current views
-    m_listWidget->clear();
-    m_treeWidget->clear();
-    
-    // Get playlist items
-    // auto playlistItems = m_currentPlaylist->getMediaFiles();
-    
-    // Populate list view
-    // for (auto mediaFile : playlistItems) {
-    //     QListWidgetItem* item = new QListWidgetItem(mediaFile->getTitle());
-    //     item->setData(Qt::UserRole, QVariant::fromValue(mediaFile));
-    //     m_listWidget->addItem(item);
-    // }
-    
-    // Populate tree view
-    // for (auto mediaFile : playlistItems) {
-    //     QTreeWidgetItem* item = new QTreeWidgetItem();
-    //     item->setText(0, mediaFile->getTitle());
-    //     item->setText(1, mediaFile->getArtist());
-    //     item->setText(2, mediaFile->getAlbum());
-    //     item->setText(3, formatDuration(mediaFile->getDuration()));
-    //     item->setData(0, Qt::UserRole, QVariant::fromValue(mediaFile));
-    //     m_treeWidget->addTopLevelItem(item);
-    // }
-    
-    // Switch to appropriate view
-    if (m_displayMode == ListMode || m_displayMode == CompactMode) {
-        m_currentView->setParent(nullptr);
-        m_currentView = m_listWidget;
-        m_mainLayout->insertWidget(2, m_currentView);
-    } else if (m_displayMode == TreeMode) {
-        m_currentView->setParent(nullptr);
-        m_currentView = m_treeWidget;
-        m_mainLayout->insertWidget(2, m_currentView);
+    QWidget* view = m_displayMode == TreeMode ? static_cast<QWidget*>(m_treeView) : m_listView;
+    if (view != m_currentView) {
+        m_mainLayout->replaceWidget(m_currentView, view);
+        m_currentView->hide();
+        view->show();
+        m_currentView = view;
     }
-    
-    updatePlaylistStats();
 }
 
 void PlaylistWidget::updatePlaylistStats()
@@ -692,14 +699,10 @@ void PlaylistWidget::updatePlaylistStats()
         return;
     }
     
-    // Calculate statistics
-    // auto playlistItems = m_currentPlaylist->getMediaFiles();
-    // m_playlistStats.totalTracks = playlistItems.size();
-    
-    // for (auto mediaFile : playlistItems) {
-    //     m_playlistStats.totalDuration += mediaFile->getDuration();
-    //     m_playlistStats.totalSize += mediaFile->getFileSize();
-    // }
+    // The playlist caches its totals between edits
+    m_playlistStats.totalTracks = m_currentPlaylist->itemCount();
+    m_playlistStats.totalDuration = m_currentPlaylist->totalDuration();
+    m_playlistStats.totalSize = m_currentPlaylist->totalSize();
     
     // Update status
     m_statusLabel->setText(QString("Tracks: %1, Duration: %2")
@@ -709,45 +712,52 @@ void PlaylistWidget::updatePlaylistStats()
 
 void PlaylistWidget::moveSelectedItems(int direction)
 {
-    if (m_displayMode == ListMode || m_displayMode == CompactMode) {
-        QList<QListWidgetItem*> selectedItems = m_listWidget->selectedItems();
-        if (selectedItems.isEmpty()) {
+    if (!m_currentPlaylist || m_model->isSorted()) {
+        return;
+    }
+    
+    const QList<int> selectedIndices = selectedPlaylistIndices();
+    if (selectedIndices.isEmpty()) {
+        return;
+    }
+    
+    // The block stops at either end; each move reaches the views as one
+    // row move, which carries the selection along
+    if (direction < 0) {
+        if (selectedIndices.first() == 0) {
             return;
         }
-        
-        // Move items in the specified direction
-        for (QListWidgetItem* item : selectedItems) {
-            int currentRow = m_listWidget->row(item);
-            int newRow = currentRow + direction;
-            
-            if (newRow >= 0 && newRow < m_listWidget->count()) {
-                QListWidgetItem* takenItem = m_listWidget->takeItem(currentRow);
-                m_listWidget->insertItem(newRow, takenItem);
-                m_listWidget->setCurrentItem(takenItem);
-            }
+        for (int index : selectedIndices) {
+            m_currentPlaylist->moveItem(index, index - 1);
         }
-    } else if (m_displayMode == TreeMode) {
-        QList<QTreeWidgetItem*> selectedItems = m_treeWidget->selectedItems();
-        if (selectedItems.isEmpty()) {
+    } else {
+        if (selectedIndices.last() == m_currentPlaylist->itemCount() - 1) {
             return;
         }
-        
-        // Move items in tree view
-        for (QTreeWidgetItem* item : selectedItems) {
-            int currentIndex = m_treeWidget->indexOfTopLevelItem(item);
-            int newIndex = currentIndex + direction;
-            
-            if (newIndex >= 0 && newIndex < m_treeWidget->topLevelItemCount()) {
-                QTreeWidgetItem* takenItem = m_treeWidget->takeTopLevelItem(currentIndex);
-                m_treeWidget->insertTopLevelItem(newIndex, takenItem);
-                m_treeWidget->setCurrentItem(takenItem);
-            }
+        for (auto it = selectedIndices.crbegin(); it != selectedIndices.crend(); ++it) {
+            m_currentPlaylist->moveItem(*it, *it + 1);
         }
     }
     
     emit playlistModified(m_currentPlaylist);
 }
 
+QList<int> PlaylistWidget::selectedPlaylistIndices() const
+{
+    // Selected cells, one or several per row depending on the view
+    QList<int> indices;
+    for (const QModelIndex& index : m_listView->selectionModel()->selectedIndexes()) {
+        const int playlistIndex = m_model->playlistIndex(index.row());
+        if (playlistIndex >= 0) {
+            indices.append(playlistIndex);
+        }
+    }
+    
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    return indices;
+}
+
 QString PlaylistWidget::formatDuration(qint64 milliseconds) const
 {
     qint64 seconds = milliseconds / 1000;
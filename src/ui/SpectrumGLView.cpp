@@ -0,0 +1,416 @@
+#include "ui/SpectrumGLView.h"
+#include <QOpenGLContext>
+#include <QVector2D>
+#include <QVector4D>
+#include <QLoggingCategory>
+#include <QtMath>
+#include <algorithm>
+
+Q_DECLARE_LOGGING_CATEGORY(spectrumGLView)
+Q_LOGGING_CATEGORY(spectrumGLView, "ui.visualizer.gl")
+
+namespace {
+
+// Full-screen triangle generated from gl_VertexID, no vertex buffer needed
+const char* VERTEX_SHADER = R"(
+void main()
+{
+    vec2 position = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// Mirrors the QPainter drawing code in AudioVisualizerWidget, in logical
+// pixels with a top-left origin
+const char* FRAGMENT_SHADER = R"(
+uniform sampler2D u_levels;     // r = bar level, g = peak level
+uniform vec2 u_resolution;      // Device pixels
+uniform float u_dpr;
+uniform int u_barCount;
+uniform int u_layout;
+uniform int u_style;
+uniform int u_particles;
+uniform int u_background;
+uniform int u_gradient;
+uniform int u_glow;
+uniform vec4 u_backgroundColor;
+uniform vec4 u_primary;
+uniform vec4 u_palette[8];
+uniform int u_paletteSize;
+uniform float u_phase;
+
+out vec4 fragColor;
+
+const int CLASSIC = 0;
+const int NEON = 2;
+const int RETRO = 3;
+const int AI_DRIVEN = 5;
+
+const int BARS = 0;
+const int CIRCULAR = 1;
+const int LINE = 2;
+
+const float BAR_SPACING = 2.0;
+const float MIN_BAR_HEIGHT = 2.0;
+const float GLOW_RADIUS = 6.0;
+
+float aa;
+
+float level(int i) { return texelFetch(u_levels, ivec2(i, 0), 0).r; }
+float peakLevel(int i) { return texelFetch(u_levels, ivec2(i, 0), 0).g; }
+
+vec3 barColor(int i)
+{
+    if (u_style == RETRO) {
+        return vec3(0.0, 1.0, 0.0);
+    }
+    if (u_style == AI_DRIVEN && i < u_paletteSize) {
+        return u_palette[i].rgb;
+    }
+    return u_primary.rgb;
+}
+
+float segmentDistance(vec2 p, vec2 a, vec2 b)
+{
+    vec2 ab = b - a;
+    float t = clamp(dot(p - a, ab) / max(dot(ab, ab), 1e-6), 0.0, 1.0);
+    return length(p - a - ab * t);
+}
+
+float boxDistance(vec2 p, vec2 minCorner, vec2 maxCorner)
+{
+    vec2 d = max(minCorner - p, p - maxCorner);
+    return length(max(d, 0.0)) + min(max(d.x, d.y), 0.0);
+}
+
+float barHeight(int i, float areaHeight)
+{
+    float h = max(MIN_BAR_HEIGHT, level(i) * areaHeight);
+    return u_style == RETRO ? floor(h / 4.0) * 4.0 : h;
+}
+
+void drawBars(vec2 p, vec2 size, inout vec4 color, inout vec3 glow)
+{
+    float left = 10.0;
+    float bottom = size.y - 10.0;
+    float areaWidth = size.x - 20.0;
+    float areaHeight = size.y - 20.0;
+    float barWidth = (areaWidth - float(u_barCount - 1) * BAR_SPACING) / float(u_barCount);
+    float stride = barWidth + BAR_SPACING;
+
+    float x = p.x - left;
+    int slot = int(floor(x / stride));
+
+    if (u_glow != 0 && u_style == NEON) {
+        for (int o = -2; o <= 2; ++o) {
+            int i = slot + o;
+            if (i < 0 || i >= u_barCount) {
+                continue;
+            }
+            float barLeft = left + float(i) * stride;
+            float d = boxDistance(p, vec2(barLeft, bottom - barHeight(i, areaHeight)),
+                                  vec2(barLeft + barWidth, bottom));
+            glow += barColor(i) * 0.35 * exp(-max(d, 0.0) / GLOW_RADIUS);
+        }
+    }
+
+    if (slot < 0 || slot >= u_barCount) {
+        return;
+    }
+
+    float within = x - float(slot) * stride;
+    if (within > barWidth) {
+        return;
+    }
+
+    float h = barHeight(slot, areaHeight);
+    float top = bottom - h;
+
+    if (p.y >= top && p.y <= bottom) {
+        vec3 c = barColor(slot);
+        if (u_gradient != 0 && u_style != RETRO) {
+            float t = clamp((p.y - top) / max(h, 1.0), 0.0, 1.0);
+            c = mix(min(c * 1.5, vec3(1.0)), c / 1.5, t);
+        }
+        if (u_style == CLASSIC) {
+            float edge = min(min(within, barWidth - within), min(p.y - top, bottom - p.y));
+            if (edge < 1.0) {
+                c *= 0.5;
+            }
+        }
+        color = vec4(c, 1.0);
+    }
+
+    if (u_style != RETRO) {
+        float peak = peakLevel(slot);
+        float peakTop = bottom - peak * areaHeight - 2.0;
+        if (peak > 0.01 && p.y >= peakTop && p.y < peakTop + 2.0) {
+            color = vec4(1.0);
+        }
+    }
+}
+
+void drawCircular(vec2 p, vec2 size, inout vec4 color, inout vec3 glow)
+{
+    vec2 center = size * 0.5;
+    float radius = min(size.x, size.y) * 0.3;
+    float angleStep = 360.0 / float(u_barCount);
+    float rotation = u_phase * 10.0;
+
+    vec2 d = p - center;
+    float angle = degrees(atan(d.y, d.x));
+    float relative = mod(angle - rotation, 360.0);
+    int nearest = int(floor(relative / angleStep + 0.5));
+
+    for (int o = -1; o <= 1; ++o) {
+        int i = (nearest + o + u_barCount) % u_barCount;
+        float a = radians(float(i) * angleStep + rotation);
+        vec2 direction = vec2(cos(a), sin(a));
+        float startRadius = radius * 0.4;
+        float endRadius = startRadius + level(i) * radius * 0.6;
+
+        float distance = segmentDistance(d, direction * startRadius, direction * endRadius);
+        float coverage = smoothstep(1.5 + aa, 1.5 - aa, distance);
+        color = mix(color, vec4(barColor(i), 1.0), coverage);
+
+        if (u_glow != 0 && u_style == NEON) {
+            glow += barColor(i) * 0.35 * exp(-distance / GLOW_RADIUS);
+        }
+    }
+
+    float ring = abs(length(d) - radius * 0.2);
+    color = mix(color, vec4(u_primary.rgb, 1.0), smoothstep(1.0 + aa, 1.0 - aa, ring));
+}
+
+void drawLine(vec2 p, vec2 size, inout vec4 color)
+{
+    float left = 20.0;
+    float bottom = size.y - 20.0;
+    float areaWidth = size.x - 40.0;
+    float areaHeight = size.y - 40.0;
+    float step = areaWidth / float(max(u_barCount - 1, 1));
+    int slot = int(floor((p.x - left) / step));
+
+    float distance = segmentDistance(p, vec2(left, bottom), vec2(left, bottom - level(0) * areaHeight));
+    for (int o = -1; o <= 1; ++o) {
+        int i = slot + o;
+        if (i < 0 || i + 1 >= u_barCount) {
+            continue;
+        }
+        vec2 a = vec2(left + float(i) * step, bottom - level(i) * areaHeight);
+        vec2 b = vec2(left + float(i + 1) * step, bottom - level(i + 1) * areaHeight);
+        distance = min(distance, segmentDistance(p, a, b));
+    }
+
+    color = mix(color, vec4(u_primary.rgb, 1.0), smoothstep(1.0 + aa, 1.0 - aa, distance));
+}
+
+void drawParticles(vec2 p, vec2 size, inout vec4 color)
+{
+    if (u_paletteSize == 0) {
+        return;
+    }
+
+    int count = min(u_barCount, 20);
+    for (int i = 0; i < count; ++i) {
+        float magnitude = level(i);
+        if (magnitude <= 0.1) {
+            continue;
+        }
+        vec2 position = vec2(float(i) * size.x / 20.0 + sin(u_phase + float(i)) * 20.0,
+                             size.y * (1.0 - magnitude) + cos(u_phase + float(i)) * 10.0);
+        float r = magnitude * 15.0;
+        float coverage = smoothstep(r + aa, r - aa, length(p - position));
+        color = mix(color, vec4(u_palette[i % u_paletteSize].rgb, 1.0), coverage * 0.6);
+    }
+}
+
+void main()
+{
+    vec2 size = u_resolution / u_dpr;
+    vec2 p = vec2(gl_FragCoord.x, u_resolution.y - gl_FragCoord.y) / u_dpr;
+    aa = 0.5 / u_dpr;
+
+    vec4 color = u_background != 0 ? u_backgroundColor : vec4(0.0, 0.0, 0.0, 1.0);
+    vec4 shapes = vec4(0.0);
+    vec3 glow = vec3(0.0);
+
+    if (u_barCount > 0) {
+        if (u_layout == CIRCULAR) {
+            drawCircular(p, size, shapes, glow);
+        } else if (u_layout == LINE) {
+            drawLine(p, size, shapes);
+        } else {
+            drawBars(p, size, shapes, glow);
+        }
+    }
+
+    // Additive glow under the shapes, like CompositionMode_Plus
+    color.rgb = min(color.rgb + glow, vec3(1.0));
+    color = mix(color, vec4(shapes.rgb, 1.0), shapes.a);
+
+    if (u_particles != 0 && u_barCount > 0) {
+        drawParticles(p, size, color);
+    }
+
+    fragColor = vec4(color.rgb, 1.0);
+}
+)";
+
+QVector4D toVector(const QColor& color)
+{
+    return QVector4D(color.redF(), color.greenF(), color.blueF(), color.alphaF());
+}
+
+} // namespace
+
+SpectrumGLView::SpectrumGLView(QWidget* parent)
+    : QOpenGLWidget(parent)
+    , m_failed(false)
+    , m_levelsDirty(true)
+    , m_levelTexture(0)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    m_levelUpload.reserve(MAX_BARS * 2);
+}
+
+SpectrumGLView::~SpectrumGLView()
+{
+    releaseResources();
+}
+
+void SpectrumGLView::setFrame(const FrameData& frame)
+{
+    m_frame = frame;
+    m_levelsDirty = true;
+    update();
+}
+
+void SpectrumGLView::fail(const QString& reason)
+{
+    qCWarning(spectrumGLView) << "GPU visualizer unavailable, falling back to QPainter:" << reason;
+    m_failed = true;
+    emit renderingFailed();
+}
+
+void SpectrumGLView::releaseResources()
+{
+    if (!context()) {
+        return;
+    }
+
+    makeCurrent();
+    if (m_levelTexture) {
+        glDeleteTextures(1, &m_levelTexture);
+        m_levelTexture = 0;
+    }
+    m_vao.destroy();
+    m_program.reset();
+    doneCurrent();
+}
+
+void SpectrumGLView::initializeGL()
+{
+    initializeOpenGLFunctions();
+
+    QOpenGLContext* ctx = context();
+    const bool gles = ctx->isOpenGLES();
+    const QSurfaceFormat format = ctx->format();
+    const bool supported = gles ? format.majorVersion() >= 3
+                                : (format.majorVersion() > 3 || (format.majorVersion() == 3 && format.minorVersion() >= 3));
+    if (!supported) {
+        fail(QStringLiteral("OpenGL 3.3 or OpenGL ES 3.0 required"));
+        return;
+    }
+
+    const QByteArray header = gles ? QByteArrayLiteral("#version 300 es\nprecision highp float;\nprecision highp int;\n")
+                                   : QByteArrayLiteral("#version 330 core\n");
+
+    m_program = std::make_unique<QOpenGLShaderProgram>();
+    if (!m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, header + VERTEX_SHADER)
+        || !m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, header + FRAGMENT_SHADER)
+        || !m_program->link()) {
+        fail(m_program->log());
+        m_program.reset();
+        return;
+    }
+
+    m_vao.create();
+
+    glGenTextures(1, &m_levelTexture);
+    glBindTexture(GL_TEXTURE_2D, m_levelTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, MAX_BARS, 1, 0, GL_RG, GL_FLOAT, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    connect(ctx, &QOpenGLContext::aboutToBeDestroyed, this, &SpectrumGLView::releaseResources);
+
+    qCDebug(spectrumGLView) << "GPU visualizer initialized:"
+                            << reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+}
+
+void SpectrumGLView::uploadLevels()
+{
+    const int count = qMin(static_cast<int>(m_frame.bars.size()), MAX_BARS);
+
+    m_levelUpload.resize(count * 2);
+    for (int i = 0; i < count; ++i) {
+        m_levelUpload[i * 2] = qBound(0.0f, m_frame.bars[i], 1.0f);
+        m_levelUpload[i * 2 + 1] = i < static_cast<int>(m_frame.peaks.size()) ? qBound(0.0f, m_frame.peaks[i], 1.0f) : 0.0f;
+    }
+
+    if (count > 0) {
+        glBindTexture(GL_TEXTURE_2D, m_levelTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, count, 1, GL_RG, GL_FLOAT, m_levelUpload.constData());
+    }
+    m_levelsDirty = false;
+}
+
+void SpectrumGLView::paintGL()
+{
+    if (m_failed || !m_program) {
+        return;
+    }
+
+    const qreal dpr = devicePixelRatioF();
+    glViewport(0, 0, static_cast<GLsizei>(width() * dpr), static_cast<GLsizei>(height() * dpr));
+
+    glActiveTexture(GL_TEXTURE0);
+    if (m_levelsDirty) {
+        uploadLevels();
+    }
+    glBindTexture(GL_TEXTURE_2D, m_levelTexture);
+
+    m_program->bind();
+    m_program->setUniformValue("u_levels", 0);
+    m_program->setUniformValue("u_resolution", QVector2D(width() * dpr, height() * dpr));
+    m_program->setUniformValue("u_dpr", static_cast<GLfloat>(dpr));
+    m_program->setUniformValue("u_barCount", qMin(static_cast<int>(m_frame.bars.size()), MAX_BARS));
+    m_program->setUniformValue("u_layout", static_cast<int>(m_frame.layout));
+    m_program->setUniformValue("u_style", m_frame.style);
+    m_program->setUniformValue("u_particles", m_frame.particles ? 1 : 0);
+    m_program->setUniformValue("u_background", m_frame.backgroundEnabled ? 1 : 0);
+    m_program->setUniformValue("u_gradient", m_frame.gradientEnabled ? 1 : 0);
+    m_program->setUniformValue("u_glow", m_frame.glowEnabled ? 1 : 0);
+    m_program->setUniformValue("u_backgroundColor", toVector(m_frame.backgroundColor));
+    m_program->setUniformValue("u_primary", toVector(m_frame.primaryColor));
+    m_program->setUniformValue("u_phase", m_frame.animationPhase);
+
+    QVector4D palette[MAX_PALETTE];
+    const int paletteSize = qMin(static_cast<int>(m_frame.palette.size()), MAX_PALETTE);
+    for (int i = 0; i < paletteSize; ++i) {
+        palette[i] = toVector(m_frame.palette[i]);
+    }
+    m_program->setUniformValueArray("u_palette", palette, MAX_PALETTE);
+    m_program->setUniformValue("u_paletteSize", paletteSize);
+
+    m_vao.bind();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    m_vao.release();
+
+    m_program->release();
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,270 @@
+#include "ui/UpdateScheduler.h"
+#include "PowerPolicy.h"
+#include <QEvent>
+#include <QGuiApplication>
+#include <QList>
+#include <QLoggingCategory>
+#include <QPair>
+#include <QScreen>
+#include <chrono>
+#include <utility>
+
+Q_DECLARE_LOGGING_CATEGORY(updateScheduler)
+Q_LOGGING_CATEGORY(updateScheduler, "eonplay.updatescheduler")
+
+namespace {
+
+constexpr double DEFAULT_REFRESH_RATE = 60.0;
+
+qint64 steadyMilliseconds()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+UpdateScheduler& UpdateScheduler::instance()
+{
+    static UpdateScheduler* scheduler = new UpdateScheduler();
+    return *scheduler;
+}
+
+UpdateScheduler::UpdateScheduler(QObject* parent)
+    : QObject(parent)
+    , m_framePeriodMs(1000.0 / DEFAULT_REFRESH_RATE)
+    , m_rateLimitHz(0)
+    , m_activityUpdatePending(false)
+{
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &UpdateScheduler::onTick);
+
+    if (auto* app = qobject_cast<QGuiApplication*>(QCoreApplication::instance())) {
+        connect(app, &QGuiApplication::primaryScreenChanged, this, &UpdateScheduler::updateFramePeriod);
+    }
+    updateFramePeriod();
+
+    PowerPolicy& power = PowerPolicy::instance();
+    setRateLimit(power.profile().uiRateLimitHz);
+    connect(&power, &PowerPolicy::profileChanged, this, [this](const PowerPolicy::Profile& profile) {
+        setRateLimit(profile.uiRateLimitHz);
+    });
+}
+
+void UpdateScheduler::subscribe(QWidget* widget, int rateHz, std::function<void()> callback)
+{
+    if (!widget || !callback) {
+        return;
+    }
+
+    if (!m_subscriptions.contains(widget)) {
+        widget->installEventFilter(this);
+        connect(widget, &QObject::destroyed, this, [this, widget]() {
+            const QPointer<QWidget> window = m_subscriptions.value(widget).window;
+            m_subscriptions.remove(widget);
+            releaseWindow(window);
+            updateTimer();
+        });
+    }
+
+    Subscription& subscription = m_subscriptions[widget];
+    subscription.rateHz = qBound(1, rateHz, MAX_RATE_HZ);
+    subscription.callback = std::move(callback);
+    subscription.lastTickMs = 0;
+    subscription.active = isWidgetActive(widget);
+    watchWindow(widget, subscription);
+
+    qCDebug(updateScheduler) << "Subscribed" << widget->metaObject()->className()
+                             << "at" << subscription.rateHz << "Hz";
+    updateTimer();
+}
+
+void UpdateScheduler::unsubscribe(QWidget* widget)
+{
+    auto it = m_subscriptions.find(widget);
+    if (it == m_subscriptions.end()) {
+        return;
+    }
+
+    const QPointer<QWidget> window = it->window;
+    m_subscriptions.erase(it);
+    disconnect(widget, &QObject::destroyed, this, nullptr);
+    releaseWindow(widget);
+    releaseWindow(window);
+    updateTimer();
+}
+
+void UpdateScheduler::setRate(QWidget* widget, int rateHz)
+{
+    auto it = m_subscriptions.find(widget);
+    if (it != m_subscriptions.end()) {
+        it->rateHz = qBound(1, rateHz, MAX_RATE_HZ);
+        updateTimer();
+    }
+}
+
+void UpdateScheduler::setRateLimit(int rateHz)
+{
+    rateHz = rateHz > 0 ? qBound(1, rateHz, MAX_RATE_HZ) : 0;
+    if (m_rateLimitHz != rateHz) {
+        m_rateLimitHz = rateHz;
+        qCDebug(updateScheduler) << "Rate limit" << rateHz << "Hz";
+        updateTimer();
+    }
+}
+
+bool UpdateScheduler::isActive(QWidget* widget) const
+{
+    auto it = m_subscriptions.constFind(widget);
+    return it != m_subscriptions.constEnd() && it->active;
+}
+
+bool UpdateScheduler::eventFilter(QObject* watched, QEvent* event)
+{
+    switch (event->type()) {
+        case QEvent::Show:
+        case QEvent::Hide:
+        case QEvent::ParentChange:
+        case QEvent::WindowStateChange:
+            // Visibility flags are not final while the event is delivered
+            scheduleActivityUpdate();
+            break;
+        default:
+            break;
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void UpdateScheduler::onTick()
+{
+    const qint64 now = steadyMilliseconds();
+    const qint64 slack = qRound(m_framePeriodMs / 2);
+
+    // Callbacks may subscribe, unsubscribe or delete widgets
+    const QList<QWidget*> widgets = m_subscriptions.keys();
+    for (QWidget* widget : widgets) {
+        auto it = m_subscriptions.find(widget);
+        if (it == m_subscriptions.end() || !it->active) {
+            continue;
+        }
+        if (now - it->lastTickMs + slack < periodMs(it->rateHz)) {
+            continue;
+        }
+        it->lastTickMs = now;
+        const std::function<void()> callback = it->callback;
+        callback();
+    }
+}
+
+void UpdateScheduler::scheduleActivityUpdate()
+{
+    if (m_activityUpdatePending) {
+        return;
+    }
+    m_activityUpdatePending = true;
+    QMetaObject::invokeMethod(this, &UpdateScheduler::updateActivity, Qt::QueuedConnection);
+}
+
+void UpdateScheduler::updateActivity()
+{
+    m_activityUpdatePending = false;
+
+    QList<QPair<QWidget*, bool>> changes;
+    for (auto it = m_subscriptions.begin(); it != m_subscriptions.end(); ++it) {
+        QWidget* widget = it.key();
+        if (it->window != widget->window()) {
+            const QPointer<QWidget> previous = it->window;
+            watchWindow(widget, *it);
+            releaseWindow(previous);
+        }
+
+        const bool active = isWidgetActive(widget);
+        if (active != it->active) {
+            it->active = active;
+            it->lastTickMs = 0;
+            changes.append({widget, active});
+        }
+    }
+
+    updateTimer();
+    for (const auto& change : changes) {
+        qCDebug(updateScheduler) << change.first->metaObject()->className()
+                                 << (change.second ? "active" : "inactive");
+        emit activeChanged(change.first, change.second);
+    }
+}
+
+void UpdateScheduler::updateTimer()
+{
+    int interval = 0;
+    for (const Subscription& subscription : std::as_const(m_subscriptions)) {
+        if (subscription.active) {
+            const int period = periodMs(subscription.rateHz);
+            interval = interval == 0 ? period : qMin(interval, period);
+        }
+    }
+
+    if (interval == 0) {
+        m_timer.stop();
+    } else if (!m_timer.isActive() || m_timer.interval() != interval) {
+        m_timer.start(interval);
+    }
+}
+
+void UpdateScheduler::updateFramePeriod()
+{
+    if (m_screen) {
+        disconnect(m_screen, nullptr, this, nullptr);
+    }
+    m_screen = QGuiApplication::primaryScreen();
+
+    double refreshRate = DEFAULT_REFRESH_RATE;
+    if (m_screen) {
+        connect(m_screen, &QScreen::refreshRateChanged, this, &UpdateScheduler::updateFramePeriod);
+        if (m_screen->refreshRate() >= 1.0) {
+            refreshRate = m_screen->refreshRate();
+        }
+    }
+
+    m_framePeriodMs = 1000.0 / refreshRate;
+    qCDebug(updateScheduler) << "Frame period" << m_framePeriodMs << "ms";
+    updateTimer();
+}
+
+void UpdateScheduler::watchWindow(QWidget* widget, Subscription& subscription)
+{
+    QWidget* window = widget->window();
+    subscription.window = window;
+    if (window != widget) {
+        window->installEventFilter(this);
+    }
+}
+
+void UpdateScheduler::releaseWindow(QWidget* window)
+{
+    if (!window) {
+        return;
+    }
+    for (auto it = m_subscriptions.constBegin(); it != m_subscriptions.constEnd(); ++it) {
+        if (it.key() == window || it->window == window) {
+            return;
+        }
+    }
+    window->removeEventFilter(this);
+}
+
+int UpdateScheduler::periodMs(int rateHz) const
+{
+    if (m_rateLimitHz > 0) {
+        rateHz = qMin(rateHz, m_rateLimitHz);
+    }
+
+    // A whole number of frames, so ticks keep in step with the display
+    const int frames = qMax(1, qRound(1000.0 / rateHz / m_framePeriodMs));
+    return qMax(1, qRound(frames * m_framePeriodMs));
+}
+
+bool UpdateScheduler::isWidgetActive(QWidget* widget)
+{
+    return widget->isVisible() && !(widget->window()->windowState() & Qt::WindowMinimized);
+}
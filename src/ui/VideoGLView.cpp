@@ -0,0 +1,450 @@
+#include "ui/VideoGLView.h"
+#include "video/VideoFilterGraph.h"
+#include "video/GpuVideoOutput.h"
+#include "Metrics.h"
+#include <QOpenGLContext>
+#include <QGenericMatrix>
+#include <QVector2D>
+#include <QVector4D>
+#include <QLoggingCategory>
+#include <QtMath>
+#include <cstring>
+#include <utility>
+
+Q_DECLARE_LOGGING_CATEGORY(videoGLView)
+Q_LOGGING_CATEGORY(videoGLView, "ui.video.gl")
+
+namespace {
+
+// Picture quad as a four-vertex strip from gl_VertexID. u_scale fits it into
+// the view; u_texTransform undoes rotation and mirroring, taking the quad
+// corner (y up) to the frame's coordinates (first row at the top), and
+// u_texRect (offset, size) picks the cropped part of the texture from them.
+const char* VERTEX_SHADER = R"(
+uniform vec2 u_scale;
+uniform mat2 u_texTransform;
+uniform vec4 u_texRect;
+
+out vec2 v_texCoord;
+
+void main()
+{
+    vec2 corner = vec2(float(gl_VertexID & 1), float((gl_VertexID >> 1) & 1)) * 2.0 - 1.0;
+    v_texCoord = u_texRect.xy + u_texRect.zw * (0.5 + 0.5 * (u_texTransform * corner));
+    gl_Position = vec4(corner * u_scale, 0.0, 1.0);
+}
+)";
+
+// Frames are RV32, i.e. B, G, R, X in memory, uploaded as RGBA; filter and GPU output are RGBA.
+// u_lutScale and u_lutOffset move 0-1 onto the centers of the outer LUT texels.
+const char* FRAGMENT_SHADER = R"(
+uniform sampler2D u_frame;
+uniform highp sampler3D u_toneMap;
+uniform int u_swapRedBlue;
+uniform int u_toneMapped;
+uniform float u_lutScale;
+uniform float u_lutOffset;
+uniform float u_brightness;
+uniform float u_contrast;
+uniform float u_inverseGamma;
+
+in vec2 v_texCoord;
+out vec4 fragColor;
+
+void main()
+{
+    vec4 texel = texture(u_frame, v_texCoord);
+    vec3 color = u_swapRedBlue != 0 ? texel.bgr : texel.rgb;
+    if (u_toneMapped != 0) {
+        color = texture(u_toneMap, color * u_lutScale + u_lutOffset).rgb;
+    }
+    color = (color - 0.5) * u_contrast + 0.5 + u_brightness;
+    color = pow(clamp(color, 0.0, 1.0), vec3(u_inverseGamma));
+    fragColor = vec4(color, 1.0);
+}
+)";
+
+} // namespace
+
+VideoGLView::VideoGLView(QWidget* parent)
+    : QOpenGLWidget(parent)
+    , m_failed(false)
+    , m_frameDirty(false)
+    , m_filterChainDirty(false)
+    , m_filteredDirty(false)
+    , m_toneMapDirty(false)
+    , m_frameTexture(0)
+    , m_filterGraph(std::make_unique<VideoFilterGraph>())
+    , m_filteredTexture(0)
+    , m_toneMapTexture(0)
+    , m_showGpuFrame(false)
+    , m_gpuSerial(0)
+{
+    // Mouse and keyboard handling stays with VideoWidget
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+}
+
+VideoGLView::~VideoGLView()
+{
+    releaseResources();
+}
+
+void VideoGLView::setFrame(const VideoFrameRef& frame)
+{
+    m_frame = frame;
+    m_frameDirty = true;
+    m_showGpuFrame = false;
+    update();
+}
+
+void VideoGLView::setGpuOutput(GpuVideoOutput* output)
+{
+    if (m_gpuOutput) {
+        disconnect(m_gpuOutput, nullptr, this, nullptr);
+    }
+
+    m_gpuOutput = output;
+    m_showGpuFrame = output && output->currentFrame().texture;
+    m_gpuSerial = 0;
+
+    if (m_gpuOutput) {
+        connect(m_gpuOutput, &GpuVideoOutput::frameChanged, this, [this]() {
+            m_showGpuFrame = true;
+            m_filteredDirty = true;
+            update();
+        });
+    }
+    update();
+}
+
+VideoFrameRef VideoGLView::readGpuFrame()
+{
+    const GpuVideoOutput::Frame source = showsGpuFrame() ? m_gpuOutput->currentFrame() : GpuVideoOutput::Frame();
+    if (!source.texture || source.size.isEmpty() || !context()) {
+        return VideoFrameRef();
+    }
+
+    const int width = source.size.width();
+    const int height = source.size.height();
+    VideoFramePool pool(1);
+    const int bytesPerLine = pool.configure(width, height);
+    std::shared_ptr<VideoFrame> frame = pool.acquire();
+    if (!frame) {
+        return VideoFrameRef();
+    }
+
+    makeCurrent();
+    glWaitSync(source.fence, 0, GL_TIMEOUT_IGNORED);
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source.texture, 0);
+    glPixelStorei(GL_PACK_ROW_LENGTH, bytesPerLine / 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, frame->bits());
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+    glDeleteFramebuffers(1, &framebuffer);
+    doneCurrent();
+
+    // GL reads R, G, B, A from the bottom row up; RV32 is B, G, R, X from the top
+    uchar* bits = frame->bits();
+    QVector<uchar> row(bytesPerLine);
+    for (int y = 0; y < height / 2; ++y) {
+        uchar* top = bits + y * bytesPerLine;
+        uchar* bottom = bits + (height - 1 - y) * bytesPerLine;
+        std::memcpy(row.data(), top, bytesPerLine);
+        std::memcpy(top, bottom, bytesPerLine);
+        std::memcpy(bottom, row.data(), bytesPerLine);
+    }
+    for (int y = 0; y < height; ++y) {
+        uchar* pixel = bits + y * bytesPerLine;
+        for (int x = 0; x < width; ++x, pixel += 4) {
+            std::swap(pixel[0], pixel[2]);
+        }
+    }
+    return frame;
+}
+
+void VideoGLView::setAdjustments(const Adjustments& adjustments)
+{
+    m_adjustments = adjustments;
+    update();
+}
+
+void VideoGLView::setFilterChain(const VideoProcessor::FilterChain& chain)
+{
+    // Compiled in paintGL(), where the context is current
+    m_filterChain = chain;
+    m_filterChainDirty = true;
+    update();
+}
+
+void VideoGLView::setToneMapping(const ToneMapper::LutRef& lut)
+{
+    // Uploaded in paintGL(); the same table is not uploaded again
+    if (lut == m_toneMapLut) {
+        return;
+    }
+    m_toneMapLut = lut;
+    m_toneMapDirty = true;
+    update();
+}
+
+void VideoGLView::fail(const QString& reason)
+{
+    qCWarning(videoGLView) << "GPU video path unavailable, falling back to QPainter:" << reason;
+    m_failed = true;
+    emit renderingFailed();
+}
+
+void VideoGLView::releaseResources()
+{
+    if (!context()) {
+        return;
+    }
+
+    makeCurrent();
+    if (m_frameTexture) {
+        glDeleteTextures(1, &m_frameTexture);
+        m_frameTexture = 0;
+    }
+    if (m_toneMapTexture) {
+        glDeleteTextures(1, &m_toneMapTexture);
+        m_toneMapTexture = 0;
+    }
+    m_textureSize = QSize();
+    m_gpuSerial = 0;
+    m_filterGraph->release();
+    m_filteredTexture = 0;
+    m_vao.destroy();
+    m_program.reset();
+    doneCurrent();
+
+    // A recreated context starts from the frame still held
+    m_frameDirty = static_cast<bool>(m_frame);
+    m_toneMapDirty = static_cast<bool>(m_toneMapLut);
+}
+
+void VideoGLView::initializeGL()
+{
+    initializeOpenGLFunctions();
+
+    QOpenGLContext* ctx = context();
+    const bool gles = ctx->isOpenGLES();
+    const QSurfaceFormat format = ctx->format();
+    const bool supported = gles ? format.majorVersion() >= 3
+                                : (format.majorVersion() > 3 || (format.majorVersion() == 3 && format.minorVersion() >= 3));
+    if (!supported) {
+        fail(QStringLiteral("OpenGL 3.3 or OpenGL ES 3.0 required"));
+        return;
+    }
+
+    const QByteArray header = gles ? QByteArrayLiteral("#version 300 es\nprecision highp float;\nprecision highp int;\n")
+                                   : QByteArrayLiteral("#version 330 core\n");
+
+    m_program = std::make_unique<QOpenGLShaderProgram>();
+    if (!m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, header + VERTEX_SHADER)
+        || !m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, header + FRAGMENT_SHADER)
+        || !m_program->link()) {
+        fail(m_program->log());
+        m_program.reset();
+        return;
+    }
+
+    m_vao.create();
+
+    glGenTextures(1, &m_frameTexture);
+    glBindTexture(GL_TEXTURE_2D, m_frameTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_filterGraph->initialize(header);
+    m_frameDirty = static_cast<bool>(m_frame);
+    m_toneMapDirty = static_cast<bool>(m_toneMapLut);
+    m_filterChainDirty = true;
+
+    connect(ctx, &QOpenGLContext::aboutToBeDestroyed, this, &VideoGLView::releaseResources);
+
+    qCDebug(videoGLView) << "GPU video path initialized:"
+                         << reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    emit contextReady();
+}
+
+void VideoGLView::uploadFrame()
+{
+    const QSize size(m_frame->width(), m_frame->height());
+
+    glBindTexture(GL_TEXTURE_2D, m_frameTexture);
+    if (size != m_textureSize) {
+        // Storage is only reallocated when the picture size changes
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.width(), size.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        m_textureSize = size;
+    }
+
+    // Straight from the pool buffer, whose rows are padded for alignment
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, m_frame->bytesPerLine() / 4);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, m_frame->bits());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    m_frameDirty = false;
+    m_filteredDirty = true;
+}
+
+void VideoGLView::uploadToneMapping()
+{
+    m_toneMapDirty = false;
+    if (!m_toneMapLut) {
+        return;
+    }
+
+    glActiveTexture(GL_TEXTURE1);
+    if (!m_toneMapTexture) {
+        glGenTextures(1, &m_toneMapTexture);
+    }
+    glBindTexture(GL_TEXTURE_3D, m_toneMapTexture);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    // Red index fastest, as the texture's x axis
+    const int size = m_toneMapLut->size;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, size, size, size, 0, GL_RGB, GL_FLOAT, m_toneMapLut->data.constData());
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void VideoGLView::paintGL()
+{
+    static LatencyHistogram& frameTime = MetricsRegistry::instance().histogram(
+        "eonplay_ui_frame_seconds", "Time to paint one video frame on the GUI thread");
+    LatencyTimer timer(frameTime);
+
+    const qreal dpr = devicePixelRatioF();
+    glViewport(0, 0, static_cast<GLsizei>(width() * dpr), static_cast<GLsizei>(height() * dpr));
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    const bool gpuFrame = showsGpuFrame();
+    if (m_failed || !m_program
+        || (!gpuFrame && (!m_frame || m_frame->width() <= 0 || m_frame->height() <= 0))) {
+        return;
+    }
+
+    if (m_toneMapDirty) {
+        uploadToneMapping();
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    const GpuVideoOutput::Frame gpu = gpuFrame ? m_gpuOutput->currentFrame() : GpuVideoOutput::Frame();
+    if (gpuFrame) {
+        // Drawn by libVLC into a shared texture; waited for on the GPU, not here
+        if (!gpu.texture || gpu.size.isEmpty()) {
+            return;
+        }
+        if (gpu.serial != m_gpuSerial) {
+            glWaitSync(gpu.fence, 0, GL_TIMEOUT_IGNORED);
+            m_gpuSerial = gpu.serial;
+        }
+    } else if (m_frameDirty) {
+        uploadFrame();
+    }
+    const GLuint sourceTexture = gpuFrame ? gpu.texture : m_frameTexture;
+    const QSize sourceSize = gpuFrame ? gpu.size : m_textureSize;
+
+    if (m_filterChainDirty) {
+        // Filters and parameters switch together, from this frame on
+        m_filterGraph->setChain(m_filterChain);
+        m_filterChainDirty = false;
+        m_filteredDirty = true;
+    }
+
+    // Filters only run again for a new frame or chain, not for adjustments
+    const bool filtered = !m_filterGraph->isEmpty();
+    if (filtered && m_filteredDirty) {
+        m_filteredTexture = m_filterGraph->process(sourceTexture, sourceSize, !gpuFrame);
+        glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+        glViewport(0, 0, static_cast<GLsizei>(width() * dpr), static_cast<GLsizei>(height() * dpr));
+
+        glBindTexture(GL_TEXTURE_2D, m_filteredTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    m_filteredDirty = false;
+    glBindTexture(GL_TEXTURE_2D, filtered ? m_filteredTexture : sourceTexture);
+
+    // Fit the rotated picture into the view, as VideoWidget's QPainter path does
+    const QRectF crop = m_adjustments.crop.isValid() ? m_adjustments.crop : QRectF(0.0, 0.0, 1.0, 1.0);
+    double ratio = m_adjustments.aspectRatio;
+    if (ratio <= 0.0) {
+        ratio = static_cast<double>(sourceSize.width()) / sourceSize.height();
+    }
+    ratio *= crop.width() / crop.height();
+    const bool quarterTurn = m_adjustments.rotation == 90 || m_adjustments.rotation == 270;
+    const double displayRatio = quarterTurn ? 1.0 / ratio : ratio;
+    QSizeF target(width(), width() / displayRatio);
+    if (m_adjustments.fill) {
+        target = QSizeF(width(), height());
+    } else if (target.height() > height()) {
+        target = QSizeF(height() * displayRatio, height());
+    }
+
+    // Inverse of rotate-then-mirror, with the y flip into texture space folded in
+    const double angle = qDegreesToRadians(static_cast<double>(m_adjustments.rotation));
+    const float c = static_cast<float>(qCos(angle));
+    const float s = static_cast<float>(qSin(angle));
+    const float mirrorX = m_adjustments.horizontalMirror ? -1.0f : 1.0f;
+    const float mirrorY = m_adjustments.verticalMirror ? -1.0f : 1.0f;
+    const float transform[] = {
+        mirrorX * c, -mirrorX * s,
+        -mirrorY * s, -mirrorY * c
+    };
+
+    // GPU output rows are bottom-up, as GL renders them
+    QVector4D texRect(crop.x(), crop.y(), crop.width(), crop.height());
+    if (gpuFrame) {
+        texRect = QVector4D(crop.x(), 1.0 - crop.y(), crop.width(), -crop.height());
+    }
+
+    m_program->bind();
+    m_program->setUniformValue("u_frame", 0);
+    m_program->setUniformValue("u_swapRedBlue", (filtered || gpuFrame) ? 0 : 1);
+
+    const bool toneMapped = m_toneMapLut && m_toneMapTexture;
+    m_program->setUniformValue("u_toneMap", 1);
+    m_program->setUniformValue("u_toneMapped", toneMapped ? 1 : 0);
+    if (toneMapped) {
+        const float size = static_cast<float>(m_toneMapLut->size);
+        m_program->setUniformValue("u_lutScale", (size - 1.0f) / size);
+        m_program->setUniformValue("u_lutOffset", 0.5f / size);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_3D, m_toneMapTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+    m_program->setUniformValue("u_scale", QVector2D(static_cast<float>(target.width() / width()),
+                                                    static_cast<float>(target.height() / height())));
+    m_program->setUniformValue("u_texTransform", QMatrix2x2(transform));
+    m_program->setUniformValue("u_texRect", texRect);
+    m_program->setUniformValue("u_brightness", m_adjustments.brightness / 200.0f);
+    m_program->setUniformValue("u_contrast", (100 + m_adjustments.contrast) / 100.0f);
+    m_program->setUniformValue("u_inverseGamma", static_cast<GLfloat>(1.0 / qBound(0.1, m_adjustments.gamma, 10.0)));
+
+    m_vao.bind();
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    m_vao.release();
+
+    m_program->release();
+    if (toneMapped) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_3D, 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
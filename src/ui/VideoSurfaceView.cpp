@@ -0,0 +1,331 @@
+#include "ui/VideoSurfaceView.h"
+#include "ui/VideoWidget.h"
+#include "media/VLCBackend.h"
+#include "Metrics.h"
+#ifdef HAVE_QT_OPENGL
+#include "ui/VideoGLView.h"
+#include "video/GpuVideoOutput.h"
+#endif
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QResizeEvent>
+
+Q_DECLARE_LOGGING_CATEGORY(videoSurfaceView)
+Q_LOGGING_CATEGORY(videoSurfaceView, "ui.video.surface")
+
+VideoSurfaceView::VideoSurfaceView(QWidget* parent)
+    : QWidget(parent)
+    , m_backend(nullptr)
+#ifdef HAVE_QT_OPENGL
+    , m_glView(nullptr)
+#endif
+    , m_crop(0.0, 0.0, 1.0, 1.0)
+    , m_extraRotation(0)
+    , m_fill(false)
+    , m_externalFrames(false)
+    , m_framePresentPending(false)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumSize(16, 16);
+
+#ifdef HAVE_QT_OPENGL
+    // Hidden until the first frame; created lazily by Qt when first shown
+    m_glView = new VideoGLView(this);
+    m_glView->hide();
+    connect(m_glView, &VideoGLView::renderingFailed, this, [this]() {
+        m_glView->hide();
+        update();
+    });
+#endif
+}
+
+VideoSurfaceView::~VideoSurfaceView()
+{
+    // Stop frame delivery before the sink goes away
+    detach();
+}
+
+void VideoSurfaceView::setSource(VideoWidget* source)
+{
+    if (m_source == source) {
+        return;
+    }
+
+    detach();
+    if (m_source) {
+        disconnect(m_source, nullptr, this, nullptr);
+    }
+
+    m_source = source;
+
+    if (m_source) {
+        connect(m_source, &VideoWidget::videoAdjustmentsChanged, this, &VideoSurfaceView::applySourceSettings);
+        connect(m_source, &VideoWidget::videoTransformChanged, this, &VideoSurfaceView::applySourceSettings);
+        connect(m_source, &VideoWidget::aspectRatioChanged, this, &VideoSurfaceView::applySourceSettings);
+        connect(m_source, &VideoWidget::hdrMetadataChanged, this, &VideoSurfaceView::applySourceSettings);
+        connect(m_source, &VideoWidget::gpuOutputChanged, this, &VideoSurfaceView::followGpuOutput);
+        applySourceSettings();
+        if (isVisible()) {
+            attach();
+        }
+    } else {
+        presentFrame(VideoFrameRef());
+    }
+}
+
+void VideoSurfaceView::setCrop(const QRectF& crop)
+{
+    const QRectF bounded = crop.intersected(QRectF(0.0, 0.0, 1.0, 1.0));
+    m_crop = bounded.isValid() ? bounded : QRectF(0.0, 0.0, 1.0, 1.0);
+    applySourceSettings();
+}
+
+void VideoSurfaceView::setExtraRotation(int degrees)
+{
+    m_extraRotation = ((degrees / 90) % 4 + 4) % 4 * 90;
+    applySourceSettings();
+}
+
+void VideoSurfaceView::setFill(bool fill)
+{
+    m_fill = fill;
+    applySourceSettings();
+}
+
+void VideoSurfaceView::setExternalFrames(bool external)
+{
+    if (m_externalFrames == external) {
+        return;
+    }
+
+    const bool attached = m_backend != nullptr;
+    detach();
+    m_externalFrames = external;
+    if (attached) {
+        attach();
+    }
+}
+
+void VideoSurfaceView::showFrame(const VideoFrameRef& frame)
+{
+    if (m_externalFrames && m_backend) {
+        presentFrame(frame);
+    }
+}
+
+void VideoSurfaceView::videoFrameReady(const VideoFrameRef& frame)
+{
+    {
+        QMutexLocker locker(&m_frameMutex);
+        m_pendingFrame = frame;
+    }
+
+    // Coalesce: at most one presentation queued, older frames are simply replaced
+    if (!m_framePresentPending.exchange(true)) {
+        QMetaObject::invokeMethod(this, &VideoSurfaceView::presentPendingFrame, Qt::QueuedConnection);
+    }
+}
+
+void VideoSurfaceView::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    attach();
+}
+
+void VideoSurfaceView::hideEvent(QHideEvent* event)
+{
+    QWidget::hideEvent(event);
+    detach();
+}
+
+void VideoSurfaceView::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+#ifdef HAVE_QT_OPENGL
+    m_glView->setGeometry(rect());
+#endif
+}
+
+void VideoSurfaceView::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+
+    static LatencyHistogram& frameTime = MetricsRegistry::instance().histogram(
+        "eonplay_ui_frame_seconds", "Time to paint one video frame on the GUI thread");
+    LatencyTimer timer(frameTime);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+    if (!m_currentFrame || usesGpuView() || !m_source) {
+        return;
+    }
+
+    // QPainter fallback: crop, placement, rotation and mirroring, as VideoGLView draws them
+    const VideoFrameRef& frame = m_currentFrame;
+    double ratio = m_source->displayAspectRatio();
+    if (ratio <= 0.0) {
+        ratio = static_cast<double>(frame->width()) / frame->height();
+    }
+    ratio *= m_crop.width() / m_crop.height();
+    const int rotation = effectiveRotation();
+    const bool quarterTurn = rotation == 90 || rotation == 270;
+    const double displayRatio = quarterTurn ? 1.0 / ratio : ratio;
+    QSizeF target(width(), width() / displayRatio);
+    if (m_fill) {
+        target = QSizeF(width(), height());
+    } else if (target.height() > height()) {
+        target = QSizeF(height() * displayRatio, height());
+    }
+    if (quarterTurn) {
+        target.transpose();
+    }
+    const QRectF source(m_crop.x() * frame->width(), m_crop.y() * frame->height(),
+                        m_crop.width() * frame->width(), m_crop.height() * frame->height());
+
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.translate(width() / 2.0, height() / 2.0);
+    painter.rotate(rotation);
+    painter.scale(m_source->isHorizontalMirrored() ? -1.0 : 1.0, m_source->isVerticalMirrored() ? -1.0 : 1.0);
+    painter.drawImage(QRectF(-target.width() / 2.0, -target.height() / 2.0, target.width(), target.height()),
+                      videoFrameToImage(frame), source);
+}
+
+void VideoSurfaceView::attach()
+{
+    if (!m_source || !m_source->vlcBackend() || m_backend == m_source->vlcBackend()) {
+        return;
+    }
+    detach();
+
+    m_backend = m_source->vlcBackend();
+    if (!m_externalFrames) {
+        m_backend->addVideoFrameSink(this);
+    }
+
+    // Start from the picture the main view shows instead of waiting for the next one
+    presentFrame(m_source->currentVideoFrame());
+    followGpuOutput();
+    qCDebug(videoSurfaceView) << "Sharing frames of" << m_source;
+}
+
+void VideoSurfaceView::detach()
+{
+    if (m_backend) {
+        if (!m_externalFrames) {
+            m_backend->removeVideoFrameSink(this);
+        }
+        m_backend = nullptr;
+    }
+
+    // Hidden views hold no pool buffer
+    {
+        QMutexLocker locker(&m_frameMutex);
+        m_pendingFrame.reset();
+    }
+    presentFrame(VideoFrameRef());
+    followGpuOutput();
+}
+
+void VideoSurfaceView::presentFrame(const VideoFrameRef& frame)
+{
+    m_currentFrame = frame;
+
+#ifdef HAVE_QT_OPENGL
+    if (m_glView && !m_glView->hasFailed()) {
+        m_glView->setFrame(frame);
+        if (frame && !m_glView->isVisible() && isVisible()) {
+            m_glView->setGeometry(rect());
+            m_glView->show();
+        }
+    }
+#endif
+
+    if (!usesGpuView()) {
+        update();
+    }
+}
+
+void VideoSurfaceView::presentPendingFrame()
+{
+    m_framePresentPending = false;
+
+    VideoFrameRef frame;
+    {
+        QMutexLocker locker(&m_frameMutex);
+        frame = std::move(m_pendingFrame);
+    }
+
+    // A delivery may still arrive right after detach()
+    if (frame && m_backend) {
+        presentFrame(frame);
+    }
+}
+
+void VideoSurfaceView::applySourceSettings()
+{
+#ifdef HAVE_QT_OPENGL
+    if (m_glView && m_source) {
+        VideoGLView::Adjustments adjustments;
+        adjustments.brightness = m_source->brightness();
+        adjustments.contrast = m_source->contrast();
+        adjustments.gamma = m_source->gamma();
+        adjustments.rotation = effectiveRotation();
+        adjustments.horizontalMirror = m_source->isHorizontalMirrored();
+        adjustments.verticalMirror = m_source->isVerticalMirrored();
+        adjustments.aspectRatio = m_source->displayAspectRatio();
+        adjustments.crop = m_crop;
+        adjustments.fill = m_fill;
+        m_glView->setAdjustments(adjustments);
+        m_glView->setToneMapping(ToneMapper::lut(m_source->hdrMetadata()));
+    }
+#endif
+    if (!usesGpuView()) {
+        update();
+    }
+}
+
+void VideoSurfaceView::followGpuOutput()
+{
+#ifdef HAVE_QT_OPENGL
+    if (!m_glView || m_glView->hasFailed()) {
+        return;
+    }
+
+    // Only while attached, so hidden views keep nothing alive
+    GpuVideoOutput* output = (m_backend && m_source) ? m_source->gpuOutput() : nullptr;
+    disconnect(m_gpuOutputConnection);
+    m_glView->setGpuOutput(output);
+    if (output) {
+        m_gpuOutputConnection = connect(output, &GpuVideoOutput::frameChanged, this, &VideoSurfaceView::showGpuView);
+        if (output->currentFrame().texture) {
+            showGpuView();
+        }
+    }
+#endif
+}
+
+void VideoSurfaceView::showGpuView()
+{
+#ifdef HAVE_QT_OPENGL
+    if (isVisible() && !m_glView->isVisible()) {
+        m_glView->setGeometry(rect());
+        m_glView->show();
+    }
+#endif
+}
+
+int VideoSurfaceView::effectiveRotation() const
+{
+    const int rotation = m_source ? m_source->rotation() : 0;
+    return (rotation + m_extraRotation) % 360;
+}
+
+bool VideoSurfaceView::usesGpuView() const
+{
+#ifdef HAVE_QT_OPENGL
+    return m_glView && m_glView->isVisible() && !m_glView->hasFailed();
+#else
+    return false;
+#endif
+}
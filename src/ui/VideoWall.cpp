@@ -0,0 +1,204 @@
+#include "ui/VideoWall.h"
+#include "ui/VideoSurfaceView.h"
+#include "ui/VideoWidget.h"
+#include "media/VLCBackend.h"
+#include <QGuiApplication>
+#include <QKeyEvent>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QScreen>
+#include <algorithm>
+#include <utility>
+
+Q_DECLARE_LOGGING_CATEGORY(videoWall)
+Q_LOGGING_CATEGORY(videoWall, "ui.video.wall")
+
+VideoWall::VideoWall(QObject* parent)
+    : QObject(parent)
+    , m_backend(nullptr)
+    , m_framePresentPending(false)
+{
+}
+
+VideoWall::~VideoWall()
+{
+    stop();
+}
+
+void VideoWall::setSource(VideoWidget* source)
+{
+    if (m_source == source) {
+        return;
+    }
+
+    const bool active = isActive();
+    stop();
+    m_source = source;
+    if (active) {
+        start();
+    }
+}
+
+void VideoWall::setOutputs(const QVector<Output>& outputs)
+{
+    m_outputs = outputs;
+    if (isActive()) {
+        start();
+    }
+}
+
+bool VideoWall::start()
+{
+    stop();
+    if (!m_source || !m_source->vlcBackend()) {
+        return false;
+    }
+
+    const QList<QScreen*> screens = QGuiApplication::screens();
+    for (const Output& output : m_outputs) {
+        const auto screen = std::find_if(screens.begin(), screens.end(),
+                                         [&output](QScreen* candidate) { return candidate->name() == output.screen; });
+        if (screen == screens.end()) {
+            qCWarning(videoWall) << "Screen" << output.screen << "not found, leaving it out";
+            continue;
+        }
+
+        // Frames come from the wall, so every output switches in the same pass
+        auto* view = new VideoSurfaceView();
+        view->setWindowFlags(Qt::Window | Qt::FramelessWindowHint);
+        view->setCursor(Qt::BlankCursor);
+        view->setExternalFrames(true);
+        view->setCrop(output.crop);
+        view->setExtraRotation(output.rotation);
+        view->setFill(true);
+        view->setSource(m_source);
+        view->installEventFilter(this);
+        view->setGeometry((*screen)->geometry());
+        view->showFullScreen();
+        m_views.append(view);
+    }
+
+    if (m_views.isEmpty()) {
+        return false;
+    }
+
+    m_backend = m_source->vlcBackend();
+    m_backend->addVideoFrameSink(this);
+
+    qCDebug(videoWall) << "Showing" << m_source << "on" << m_views.size() << "screens";
+    emit activeChanged(true);
+    return true;
+}
+
+void VideoWall::stop()
+{
+    if (m_views.isEmpty()) {
+        return;
+    }
+
+    if (m_backend) {
+        m_backend->removeVideoFrameSink(this);
+        m_backend = nullptr;
+    }
+    {
+        QMutexLocker locker(&m_frameMutex);
+        m_pendingFrame.reset();
+    }
+
+    qDeleteAll(m_views);
+    m_views.clear();
+    emit activeChanged(false);
+}
+
+QVector<VideoWall::Output> VideoWall::gridLayout(const QStringList& screens, int columns, const QSizeF& bezel)
+{
+    QVector<Output> layout;
+    if (screens.isEmpty() || columns <= 0) {
+        return layout;
+    }
+
+    // The picture spans the screens and the bezels between them
+    const int rows = (static_cast<int>(screens.size()) + columns - 1) / columns;
+    const double width = columns + (columns - 1) * bezel.width();
+    const double height = rows + (rows - 1) * bezel.height();
+
+    for (int i = 0; i < screens.size(); ++i) {
+        const int column = i % columns;
+        const int row = i / columns;
+
+        Output output;
+        output.screen = screens[i];
+        output.crop = QRectF(column * (1.0 + bezel.width()) / width, row * (1.0 + bezel.height()) / height,
+                             1.0 / width, 1.0 / height);
+        layout.append(output);
+    }
+    return layout;
+}
+
+QVector<VideoWall::Output> VideoWall::desktopLayout(const QList<QScreen*>& screens)
+{
+    QRect bounds;
+    for (QScreen* screen : screens) {
+        bounds = bounds.united(screen->geometry());
+    }
+
+    QVector<Output> layout;
+    if (bounds.isEmpty()) {
+        return layout;
+    }
+
+    // Screens the desktop shows in portrait are rotated by the system already
+    for (QScreen* screen : screens) {
+        const QRect geometry = screen->geometry();
+        Output output;
+        output.screen = screen->name();
+        output.crop = QRectF(static_cast<double>(geometry.x() - bounds.x()) / bounds.width(),
+                             static_cast<double>(geometry.y() - bounds.y()) / bounds.height(),
+                             static_cast<double>(geometry.width()) / bounds.width(),
+                             static_cast<double>(geometry.height()) / bounds.height());
+        layout.append(output);
+    }
+    return layout;
+}
+
+void VideoWall::videoFrameReady(const VideoFrameRef& frame)
+{
+    {
+        QMutexLocker locker(&m_frameMutex);
+        m_pendingFrame = frame;
+    }
+
+    // Coalesce: at most one presentation queued, older frames are simply replaced
+    if (!m_framePresentPending.exchange(true)) {
+        QMetaObject::invokeMethod(this, &VideoWall::presentPendingFrame, Qt::QueuedConnection);
+    }
+}
+
+void VideoWall::presentPendingFrame()
+{
+    m_framePresentPending = false;
+
+    VideoFrameRef frame;
+    {
+        QMutexLocker locker(&m_frameMutex);
+        frame = std::move(m_pendingFrame);
+    }
+
+    // A delivery may still arrive right after stop()
+    if (!frame || !m_backend) {
+        return;
+    }
+    for (VideoSurfaceView* view : std::as_const(m_views)) {
+        view->showFrame(frame);
+    }
+}
+
+bool VideoWall::eventFilter(QObject* watched, QEvent* event)
+{
+    if (event->type() == QEvent::KeyPress && static_cast<QKeyEvent*>(event)->key() == Qt::Key_Escape) {
+        // Not from inside the view's own event handling
+        QMetaObject::invokeMethod(this, &VideoWall::stop, Qt::QueuedConnection);
+        return true;
+    }
+    return QObject::eventFilter(watched, event);
+}
@@ -1,8 +1,14 @@
 #include "ui/VideoWidget.h"
 #include "ComponentManager.h"
 #include "media/VLCBackend.h"
+#include "video/VideoProcessor.h"
+#include "video/ScreenshotCapture.h"
 #include "subtitles/SubtitleRenderer.h"
 #include "subtitles/SubtitleManager.h"
+#ifdef HAVE_QT_OPENGL
+#include "ui/VideoGLView.h"
+#include "video/GpuVideoOutput.h"
+#endif
 #include <QApplication>
 // QDesktopWidget was removed in Qt6, use QScreen instead
 #include <QFileDialog>
@@ -16,6 +22,9 @@
 #include <QFontMetrics>
 #include <QScreen>
 #include <QWindow>
+#include <QImage>
+#include <QMutexLocker>
+#include <QFontDatabase>
 #include <cmath>
 
 // Static member definitions
@@ -25,11 +34,16 @@ VideoWidget::VideoWidget(QWidget* parent)
     : QWidget(parent)
     , m_componentManager(nullptr)
     , m_vlcBackend(nullptr)
+    , m_videoProcessor(nullptr)
     , m_subtitleRenderer(nullptr)
     , m_subtitleManager(nullptr)
     , m_mainLayout(nullptr)
     , m_videoDisplayWidget(nullptr)
     , m_placeholderLabel(nullptr)
+#ifdef HAVE_QT_OPENGL
+    , m_glView(nullptr)
+    , m_gpuOutput(nullptr)
+#endif
     , m_overlayWidget(nullptr)
     , m_overlayLayout(nullptr)
     , m_overlayButtonsLayout(nullptr)
@@ -50,6 +64,7 @@ VideoWidget::VideoWidget(QWidget* parent)
     , m_horizontalMirrorButton(nullptr)
     , m_verticalMirrorButton(nullptr)
     , m_contextMenu(nullptr)
+    , m_statsHudAction(nullptr)
     , m_aspectRatio("Auto")
     , m_brightness(0)
     , m_contrast(0)
@@ -63,7 +78,12 @@ VideoWidget::VideoWidget(QWidget* parent)
     , m_controlsHideTimer(nullptr)
     , m_controlsOpacityAnimation(nullptr)
     , m_overlayOpacityEffect(nullptr)
+    , m_statsHud(nullptr)
+    , m_statsHudTimer(nullptr)
     , m_mouseMoveTimer(nullptr)
+    , m_pendingDeliveredUs(0)
+    , m_framePresentPending(false)
+    , m_screenshotCapture(new ScreenshotCapture(this))
 {
     // Set widget properties
     setFocusPolicy(Qt::StrongFocus);
@@ -89,11 +109,31 @@ VideoWidget::VideoWidget(QWidget* parent)
     m_mouseMoveTimer->setSingleShot(true);
     m_mouseMoveTimer->setInterval(100); // 100ms debounce
     connect(m_mouseMoveTimer, &QTimer::timeout, this, &VideoWidget::updateControlsOpacity);
+    
+    // Captures share the frame on screen and are encoded off the GUI thread
+    m_screenshotCapture->setFrameSource([this]() {
+#ifdef HAVE_QT_OPENGL
+        // Pictures of the GPU output exist in memory only when read back
+        if (m_glView && m_glView->showsGpuFrame()) {
+            return m_glView->readGpuFrame();
+        }
+#endif
+        return m_currentFrame;
+    });
 }
 
 VideoWidget::~VideoWidget()
 {
-    // Cleanup is handled by Qt's parent-child relationship
+    // Stop frame delivery before the sink goes away; UI cleanup is handled
+    // by Qt's parent-child relationship
+    if (m_vlcBackend) {
+        m_vlcBackend->removeVideoFrameSink(this);
+#ifdef HAVE_QT_OPENGL
+        if (m_gpuOutput && m_vlcBackend->gpuOutput() == m_gpuOutput) {
+            m_vlcBackend->setGpuOutput(nullptr);
+        }
+#endif
+    }
 }
 
 bool VideoWidget::initialize(ComponentManager* componentManager)
@@ -112,24 +152,73 @@ bool VideoWidget::initialize(ComponentManager* componentManager)
 
 void VideoWidget::setVLCBackend(VLCBackend* vlcBackend)
 {
+    if (m_vlcBackend) {
+        m_vlcBackend->removeVideoFrameSink(this);
+        disconnect(m_vlcBackend, nullptr, this, nullptr);
+#ifdef HAVE_QT_OPENGL
+        if (m_gpuOutput && m_vlcBackend->gpuOutput() == m_gpuOutput) {
+            m_vlcBackend->setGpuOutput(nullptr);
+        }
+#endif
+    }
+    
     m_vlcBackend = vlcBackend;
+    m_frameTiming.reset();
     
     if (m_vlcBackend) {
+        m_vlcBackend->addVideoFrameSink(this);
+#ifdef HAVE_QT_OPENGL
+        if (m_gpuOutput) {
+            m_vlcBackend->setGpuOutput(m_gpuOutput);
+        }
+#endif
+        connect(m_vlcBackend, &VLCBackend::mediaLoaded, this, [this]() { m_frameTiming.reset(); });
+        
         // Set up VLC video output to this widget
         updateVideoOutput();
     }
 }
 
+void VideoWidget::setVideoProcessor(VideoProcessor* processor)
+{
+    if (m_videoProcessor) {
+        disconnect(m_videoProcessor, nullptr, this, nullptr);
+    }
+    
+    m_videoProcessor = processor;
+    
+#ifdef HAVE_QT_OPENGL
+    if (!m_glView) {
+        return;
+    }
+    
+    if (m_videoProcessor) {
+        connect(m_videoProcessor, &VideoProcessor::filterChainChanged, this,
+                [this](const VideoProcessor::FilterChain& chain) {
+                    m_glView->setFilterChain(m_videoProcessor->isEnabled() ? chain : VideoProcessor::FilterChain());
+                });
+        connect(m_videoProcessor, &VideoProcessor::enabledChanged, this, [this](bool enabled) {
+            m_glView->setFilterChain(enabled ? m_videoProcessor->getFilterChain() : VideoProcessor::FilterChain());
+        });
+        connect(m_videoProcessor, &QObject::destroyed, this, [this]() {
+            m_videoProcessor = nullptr;
+            m_glView->setFilterChain(VideoProcessor::FilterChain());
+        });
+        m_glView->setFilterChain(m_videoProcessor->isEnabled() ? m_videoProcessor->getFilterChain()
+                                                               : VideoProcessor::FilterChain());
+    } else {
+        m_glView->setFilterChain(VideoProcessor::FilterChain());
+    }
+#endif
+}
+
 void VideoWidget::setAspectRatio(const QString& aspectRatio)
 {
     if (m_aspectRatio != aspectRatio) {
         m_aspectRatio = aspectRatio;
         
-        // Apply aspect ratio to VLC if available
-        if (m_vlcBackend) {
-            // VLC aspect ratio setting would go here
-            // m_vlcBackend->setAspectRatio(aspectRatio);
-        }
+        // Applied when presenting, like rotation; the decoder is left alone
+        applyVideoTransformations();
         
         emit aspectRatioChanged(aspectRatio);
     }
@@ -195,6 +284,20 @@ void VideoWidget::setVerticalMirror(bool mirrored)
     }
 }
 
+void VideoWidget::setHdrMetadata(const ToneMapper::Metadata& metadata)
+{
+    if (m_hdrMetadata != metadata) {
+        m_hdrMetadata = metadata;
+#ifdef HAVE_QT_OPENGL
+        // Tables are cached per metadata, so switching back is only a texture upload
+        if (m_glView) {
+            m_glView->setToneMapping(ToneMapper::lut(metadata));
+        }
+#endif
+        emit hdrMetadataChanged();
+    }
+}
+
 void VideoWidget::setFullscreen(bool fullscreen)
 {
     if (m_isFullscreen != fullscreen) {
@@ -255,6 +358,33 @@ void VideoWidget::toggleFullscreen()
     setFullscreen(!m_isFullscreen);
 }
 
+void VideoWidget::setStatsHudVisible(bool visible)
+{
+    if (visible == isStatsHudVisible()) {
+        return;
+    }
+    
+    m_statsHud->setVisible(visible);
+    m_statsHudAction->setChecked(visible);
+    if (visible) {
+        updateStatsHud();
+        m_statsHud->raise();
+        m_statsHudTimer->start();
+    } else {
+        m_statsHudTimer->stop();
+    }
+}
+
+bool VideoWidget::isStatsHudVisible() const
+{
+    return m_statsHud && m_statsHud->isVisible();
+}
+
+void VideoWidget::toggleStatsHud()
+{
+    setStatsHudVisible(!isStatsHudVisible());
+}
+
 void VideoWidget::toggleControls()
 {
     setControlsVisible(!m_controlsVisible);
@@ -273,13 +403,33 @@ void VideoWidget::takeScreenshot()
     QString filename = QString("EonPlay_Screenshot_%1.png").arg(timestamp);
     QString filePath = QDir(screenshotsDir).absoluteFilePath(filename);
     
-    // Take screenshot via VLC backend
-    // m_vlcBackend->takeScreenshot(filePath);
-    
-    emit screenshotTaken(filePath);
+    // Save the frame on screen; the capturer shares the pooled buffer and encodes in the background
+    ScreenshotCapture::Request request;
+    request.outputPath = filePath;
+    const int captureId = m_screenshotCapture->capture(request);
+    if (captureId == 0) {
+        QMessageBox::warning(this, "EonPlay", "No video frame available for screenshot");
+        return;
+    }
     
-    // Show temporary notification
-    QMessageBox::information(this, "EonPlay", QString("Screenshot saved to:\n%1").arg(filePath));
+    auto connection = std::make_shared<QMetaObject::Connection>();
+    *connection = connect(m_screenshotCapture, &ScreenshotCapture::captureFinished, this,
+                          [this, captureId, filePath, connection](int id, bool success, const QStringList&) {
+        if (id != captureId) {
+            return;
+        }
+        disconnect(*connection);
+        
+        if (!success) {
+            QMessageBox::warning(this, "EonPlay", QString("Failed to save screenshot to:\n%1").arg(filePath));
+            return;
+        }
+        
+        emit screenshotTaken(filePath);
+        
+        // Show temporary notification
+        QMessageBox::information(this, "EonPlay", QString("Screenshot saved to:\n%1").arg(filePath));
+    });
 }
 
 void VideoWidget::showVideoAdjustments()
@@ -359,6 +509,9 @@ void VideoWidget::keyPressEvent(QKeyEvent* event)
             takeScreenshot();
         }
         break;
+    case Qt::Key_I:
+        toggleStatsHud();
+        break;
     default:
         QWidget::keyPressEvent(event);
         break;
@@ -432,6 +585,106 @@ void VideoWidget::paintEvent(QPaintEvent* event)
     QWidget::paintEvent(event);
 }
 
+bool VideoWidget::eventFilter(QObject* watched, QEvent* event)
+{
+#ifdef HAVE_QT_OPENGL
+    if (watched == m_videoDisplayWidget && event->type() == QEvent::Resize && m_glView) {
+        m_glView->setGeometry(m_videoDisplayWidget->rect());
+    }
+#endif
+    
+    if (watched == m_videoDisplayWidget && event->type() == QEvent::Paint && m_currentFrame && !usesGpuView()) {
+        QPainter painter(m_videoDisplayWidget);
+        paintVideoFrame(painter, m_currentFrame);
+        return true;
+    }
+    
+    return QWidget::eventFilter(watched, event);
+}
+
+void VideoWidget::videoFrameReady(const VideoFrameRef& frame)
+{
+    const qint64 deliveredUs = FrameTimingStats::now();
+    bool replacedPending = false;
+    {
+        QMutexLocker locker(&m_frameMutex);
+        replacedPending = static_cast<bool>(m_pendingFrame);
+        m_pendingFrame = frame;
+        m_pendingDeliveredUs = deliveredUs;
+    }
+    m_frameTiming.frameDelivered(replacedPending);
+    
+    // Coalesce: at most one presentation queued, older frames are simply replaced
+    if (!m_framePresentPending.exchange(true)) {
+        QMetaObject::invokeMethod(this, &VideoWidget::presentPendingFrame, Qt::QueuedConnection);
+    }
+}
+
+void VideoWidget::presentPendingFrame()
+{
+    m_framePresentPending = false;
+    
+    VideoFrameRef frame;
+    qint64 deliveredUs = 0;
+    {
+        QMutexLocker locker(&m_frameMutex);
+        frame = std::move(m_pendingFrame);
+        deliveredUs = m_pendingDeliveredUs;
+    }
+    
+    if (!frame) {
+        return;
+    }
+    
+    m_currentFrame = std::move(frame);
+    m_frameTiming.framePresented(deliveredUs, screen() ? screen()->refreshRate() : 60.0);
+    
+    if (m_placeholderLabel && m_placeholderLabel->isVisible()) {
+        m_placeholderLabel->setVisible(false);
+    }
+    
+#ifdef HAVE_QT_OPENGL
+    if (m_glView && !m_glView->hasFailed()) {
+        m_glView->setFrame(m_currentFrame);
+        if (!m_glView->isVisible()) {
+            m_glView->setGeometry(m_videoDisplayWidget->rect());
+            m_glView->show();
+        }
+        return;
+    }
+#endif
+    m_videoDisplayWidget->update();
+}
+
+void VideoWidget::paintVideoFrame(QPainter& painter, const VideoFrameRef& frame)
+{
+    const QSizeF area = m_videoDisplayWidget->size();
+    painter.fillRect(m_videoDisplayWidget->rect(), Qt::black);
+    
+    double ratio = calculateAspectRatio(m_aspectRatio);
+    if (ratio <= 0.0) {
+        ratio = static_cast<double>(frame->width()) / frame->height();
+    }
+    
+    // Fit the rotated picture into the display area
+    const bool quarterTurn = m_rotation == 90 || m_rotation == 270;
+    const double displayRatio = quarterTurn ? 1.0 / ratio : ratio;
+    QSizeF target(area.width(), area.width() / displayRatio);
+    if (target.height() > area.height()) {
+        target = QSizeF(area.height() * displayRatio, area.height());
+    }
+    if (quarterTurn) {
+        target.transpose();
+    }
+    
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.translate(area.width() / 2.0, area.height() / 2.0);
+    painter.rotate(m_rotation);
+    painter.scale(m_horizontalMirror ? -1.0 : 1.0, m_verticalMirror ? -1.0 : 1.0);
+    painter.drawImage(QRectF(-target.width() / 2.0, -target.height() / 2.0, target.width(), target.height()),
+                      videoFrameToImage(frame));
+}
+
 // Private slot implementations
 void VideoWidget::onBrightnessChanged(int value)
 {
@@ -510,6 +763,54 @@ void VideoWidget::updateControlsOpacity()
     // Implementation depends on specific animation requirements
 }
 
+void VideoWidget::updateStatsHud()
+{
+    const FrameTimingStats::Snapshot timing = m_frameTiming.snapshot();
+    QStringList lines;
+    
+    if (m_vlcBackend) {
+        const VLCBackend::DecoderStats decoder = m_vlcBackend->decoderStats();
+        QString header = decoder.decoder;
+        if (m_currentFrame) {
+            header += QString(" | %1x%2").arg(m_currentFrame->width()).arg(m_currentFrame->height());
+        }
+        lines << header + QString(" | %1 fps").arg(timing.fps, 0, 'f', 1);
+        
+        if (decoder.valid) {
+            lines << QString("Dropping %1% frames (decoded %2, lost %3, pool %4)")
+                         .arg(decoder.dropPercent, 0, 'f', 1)
+                         .arg(decoder.decodedVideo)
+                         .arg(decoder.lostPictures)
+                         .arg(decoder.poolDroppedPictures);
+            lines << QString("Input %1 Mbit/s | demux %2 Mbit/s | audio lost %3")
+                         .arg(decoder.inputBitrate / 1000.0, 0, 'f', 2)
+                         .arg(decoder.demuxBitrate / 1000.0, 0, 'f', 2)
+                         .arg(decoder.lostAudioBuffers);
+        }
+    } else {
+        lines << QString("%1 fps").arg(timing.fps, 0, 'f', 1);
+    }
+    
+    lines << QString("Frame time p50 %1 | p95 %2 | p99 %3 | max %4 ms")
+                 .arg(timing.p50Ms, 0, 'f', 1)
+                 .arg(timing.p95Ms, 0, 'f', 1)
+                 .arg(timing.p99Ms, 0, 'f', 1)
+                 .arg(timing.maxMs, 0, 'f', 1);
+    lines << QString("Late %1 (%2% recent) | vsync misses %3 | not shown %4 (%5%)")
+                 .arg(timing.late)
+                 .arg(timing.windowLatePercent, 0, 'f', 1)
+                 .arg(timing.vsyncMisses)
+                 .arg(timing.superseded)
+                 .arg(timing.supersededPercent(), 0, 'f', 1);
+    lines << QString("Presented %1 of %2 | delivery to screen %3 ms")
+                 .arg(timing.presented)
+                 .arg(timing.delivered)
+                 .arg(timing.latencyMs, 0, 'f', 1);
+    
+    m_statsHud->setText(lines.join('\n'));
+    m_statsHud->adjustSize();
+}
+
 // Private method implementations
 void VideoWidget::initializeUI()
 {
@@ -529,6 +830,9 @@ void VideoWidget::initializeUI()
     
     // Create video adjustment controls
     createVideoAdjustmentControls();
+    
+    // Create statistics HUD
+    createStatsHud();
 }
 
 void VideoWidget::createVideoDisplay()
@@ -538,6 +842,26 @@ void VideoWidget::createVideoDisplay()
     m_videoDisplayWidget->setStyleSheet("background-color: black;");
     m_videoDisplayWidget->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
     
+    // Frames are painted by eventFilter() unless the GPU view shows them
+    m_videoDisplayWidget->installEventFilter(this);
+    
+#ifdef HAVE_QT_OPENGL
+    // Hidden until the first frame; created lazily by Qt when first shown
+    m_glView = new VideoGLView(m_videoDisplayWidget);
+    m_glView->hide();
+    connect(m_glView, &VideoGLView::renderingFailed, this, [this]() {
+        releaseGpuOutput();
+        m_glView->hide();
+        m_videoDisplayWidget->update();
+    });
+    connect(m_glView, &VideoGLView::contextReady, this, &VideoWidget::setupGpuOutput);
+    
+    // The GPU output needs the view's context before the first picture
+    if (GpuVideoOutput::isSupported()) {
+        m_glView->show();
+    }
+#endif
+    
     // Create placeholder label
     m_placeholderLabel = new QLabel("No video loaded", m_videoDisplayWidget);
     m_placeholderLabel->setAlignment(Qt::AlignCenter);
@@ -627,6 +951,12 @@ void VideoWidget::createContextMenu()
     // Video adjustments action
     m_adjustmentsAction = m_contextMenu->addAction("Video Adjustments");
     connect(m_adjustmentsAction, &QAction::triggered, this, &VideoWidget::showVideoAdjustments);
+    
+    // Statistics HUD action
+    m_statsHudAction = m_contextMenu->addAction("Show Statistics");
+    m_statsHudAction->setShortcut(QKeySequence("I"));
+    m_statsHudAction->setCheckable(true);
+    connect(m_statsHudAction, &QAction::triggered, this, &VideoWidget::setStatsHudVisible);
 }
 
 void VideoWidget::createVideoAdjustmentControls()
@@ -706,6 +1036,23 @@ void VideoWidget::createVideoAdjustmentControls()
     m_adjustmentWidget->move(10, 10);
 }
 
+void VideoWidget::createStatsHud()
+{
+    // Above the video and the GL view, never taking the mouse
+    m_statsHud = new QLabel(this);
+    m_statsHud->setAttribute(Qt::WA_TransparentForMouseEvents);
+    m_statsHud->setTextFormat(Qt::PlainText);
+    m_statsHud->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    m_statsHud->setStyleSheet("QLabel { color: #7FFFD4; background-color: rgba(0, 0, 0, 160); "
+                              "border-radius: 4px; padding: 6px; }");
+    m_statsHud->move(12, 12);
+    m_statsHud->setVisible(false);
+    
+    m_statsHudTimer = new QTimer(this);
+    m_statsHudTimer->setInterval(500);
+    connect(m_statsHudTimer, &QTimer::timeout, this, &VideoWidget::updateStatsHud);
+}
+
 void VideoWidget::applyFuturisticStyling()
 {
     // Main widget styling
@@ -820,9 +1167,7 @@ void VideoWidget::applyFuturisticStyling()
 void VideoWidget::updateVideoOutput()
 {
     if (m_vlcBackend && m_videoDisplayWidget) {
-        // Set VLC video output to this widget's window handle
-        // This would typically involve platform-specific code
-        // m_vlcBackend->setVideoOutput(m_videoDisplayWidget->winId());
+        // Frames arrive through videoFrameReady(), so no native window handle is needed
         
         // Hide placeholder when video is available
         if (m_placeholderLabel) {
@@ -839,22 +1184,90 @@ void VideoWidget::updateVideoOutput()
 
 void VideoWidget::applyVideoAdjustments()
 {
-    if (m_vlcBackend) {
-        // Apply brightness, contrast, and gamma to VLC
-        // m_vlcBackend->setBrightness(m_brightness);
-        // m_vlcBackend->setContrast(m_contrast);
-        // m_vlcBackend->setGamma(m_gamma);
+    // Shader uniforms only: no frame is converted on the CPU and VLC keeps decoding as it is
+#ifdef HAVE_QT_OPENGL
+    if (m_glView) {
+        VideoGLView::Adjustments adjustments;
+        adjustments.brightness = m_brightness;
+        adjustments.contrast = m_contrast;
+        adjustments.gamma = m_gamma;
+        adjustments.rotation = m_rotation;
+        adjustments.horizontalMirror = m_horizontalMirror;
+        adjustments.verticalMirror = m_verticalMirror;
+        adjustments.aspectRatio = calculateAspectRatio(m_aspectRatio);
+        m_glView->setAdjustments(adjustments);
     }
+#endif
 }
 
 void VideoWidget::applyVideoTransformations()
 {
+    // Rotation and mirroring are applied when presenting the frame
+    applyVideoAdjustments();
+    if (m_videoDisplayWidget && !usesGpuView()) {
+        m_videoDisplayWidget->update();
+    }
+}
+
+#ifdef HAVE_QT_OPENGL
+void VideoWidget::setupGpuOutput()
+{
+    if (!GpuVideoOutput::isSupported() || m_glView->hasFailed()) {
+        return;
+    }
+    
+    // A recreated context does not share the old output's textures
+    if (m_gpuOutput && m_gpuOutput->isSharedWith(m_glView->context())) {
+        return;
+    }
+    
+    GpuVideoOutput* previous = m_gpuOutput;
+    m_gpuOutput = new GpuVideoOutput(m_glView->context(), this);
+    connect(m_gpuOutput, &GpuVideoOutput::frameChanged, this, [this]() {
+        if (m_placeholderLabel && m_placeholderLabel->isVisible()) {
+            m_placeholderLabel->setVisible(false);
+        }
+    });
+    m_glView->setGpuOutput(m_gpuOutput);
     if (m_vlcBackend) {
-        // Apply rotation and mirroring to VLC
-        // m_vlcBackend->setRotation(m_rotation);
-        // m_vlcBackend->setHorizontalMirror(m_horizontalMirror);
-        // m_vlcBackend->setVerticalMirror(m_verticalMirror);
+        m_vlcBackend->setGpuOutput(m_gpuOutput);
+    }
+    emit gpuOutputChanged();
+    delete previous;
+}
+
+void VideoWidget::releaseGpuOutput()
+{
+    if (!m_gpuOutput) {
+        return;
     }
+    
+    if (m_vlcBackend && m_vlcBackend->gpuOutput() == m_gpuOutput) {
+        m_vlcBackend->setGpuOutput(nullptr);
+    }
+    m_glView->setGpuOutput(nullptr);
+    delete m_gpuOutput;
+    m_gpuOutput = nullptr;
+    emit gpuOutputChanged();
+}
+#endif
+
+GpuVideoOutput* VideoWidget::gpuOutput() const
+{
+#ifdef HAVE_QT_OPENGL
+    return m_gpuOutput;
+#else
+    return nullptr;
+#endif
+}
+
+bool VideoWidget::usesGpuView() const
+{
+#ifdef HAVE_QT_OPENGL
+    return m_glView && m_glView->isVisible() && !m_glView->hasFailed();
+#else
+    return false;
+#endif
 }
 
 double VideoWidget::calculateAspectRatio(const QString& aspectRatio) const
@@ -0,0 +1,148 @@
+#include "ui/WaveformOverviewWidget.h"
+#include "audio/WaveformPeaks.h"
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPaintEvent>
+#include <cmath>
+
+namespace {
+const QColor UNPLAYED_COLOR(90, 110, 140);
+const QColor PLAYED_COLOR(0, 212, 255);
+const int PREFERRED_HEIGHT = 28;
+}
+
+WaveformOverviewWidget::WaveformOverviewWidget(QWidget* parent)
+    : QWidget(parent)
+    , m_progress(0.0)
+{
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    setCursor(Qt::PointingHandCursor);
+}
+
+QSize WaveformOverviewWidget::sizeHint() const
+{
+    return QSize(200, PREFERRED_HEIGHT);
+}
+
+void WaveformOverviewWidget::setPeaks(std::shared_ptr<const WaveformPeaks> peaks)
+{
+    m_peaks = peaks && !peaks->isEmpty() ? std::move(peaks) : nullptr;
+    renderPixmaps();
+    update();
+}
+
+void WaveformOverviewWidget::setProgress(double fraction)
+{
+    fraction = qBound(0.0, fraction, 1.0);
+    if (qFuzzyCompare(fraction + 1.0, m_progress + 1.0)) {
+        return;
+    }
+
+    const int oldX = progressX();
+    m_progress = fraction;
+    const int newX = progressX();
+    if (oldX != newX && m_peaks) {
+        update(QRect(qMin(oldX, newX), 0, qAbs(newX - oldX) + 1, height()));
+    }
+}
+
+int WaveformOverviewWidget::progressX() const
+{
+    return static_cast<int>(std::lround(m_progress * width()));
+}
+
+void WaveformOverviewWidget::renderPixmaps()
+{
+    m_unplayed = QPixmap();
+    m_played = QPixmap();
+    if (!m_peaks || width() <= 0 || height() <= 0) {
+        return;
+    }
+
+    const qreal ratio = devicePixelRatioF();
+    const int columns = static_cast<int>(width() * ratio);
+    const int rows = static_cast<int>(height() * ratio);
+
+    // The level with at least one peak per column; each column then
+    // reduces only the few peaks it covers
+    const double framesPerColumn = static_cast<double>(m_peaks->frameCount()) / columns;
+    const int levelIndex = m_peaks->levelFor(framesPerColumn);
+    const WaveformPeaks::Level& level = m_peaks->level(levelIndex);
+    const double peaksPerColumn = static_cast<double>(level.size()) / columns;
+
+    QPainterPath path;
+    const double middle = rows / 2.0;
+    const double scale = middle / 127.0;
+    for (int x = 0; x < columns; ++x) {
+        const int first = static_cast<int>(x * peaksPerColumn);
+        const int last = qMax(first + 1, static_cast<int>((x + 1) * peaksPerColumn));
+        int low = 0;
+        int high = 0;
+        for (int i = first; i < last && i < level.size(); ++i) {
+            low = qMin(low, static_cast<int>(level[i].min));
+            high = qMax(high, static_cast<int>(level[i].max));
+        }
+        path.addRect(QRectF(x, middle - high * scale, 1.0, qMax(1.0, (high - low) * scale)));
+    }
+
+    auto render = [&](const QColor& color) {
+        QPixmap pixmap(columns, rows);
+        pixmap.setDevicePixelRatio(ratio);
+        pixmap.fill(Qt::transparent);
+        QPainter painter(&pixmap);
+        painter.scale(1.0 / ratio, 1.0 / ratio);
+        painter.fillPath(path, color);
+        return pixmap;
+    };
+    m_unplayed = render(UNPLAYED_COLOR);
+    m_played = render(PLAYED_COLOR);
+}
+
+void WaveformOverviewWidget::paintEvent(QPaintEvent* event)
+{
+    if (!m_peaks || m_played.isNull()) {
+        return;
+    }
+
+    QPainter painter(this);
+    const QRect dirty = event->rect();
+    const int split = progressX();
+    const qreal ratio = m_played.devicePixelRatio();
+
+    // Draw only the dirty part of each pixmap
+    const QRect played = dirty.intersected(QRect(0, 0, split, height()));
+    const QRect unplayed = dirty.intersected(QRect(split, 0, width() - split, height()));
+    if (!played.isEmpty()) {
+        painter.drawPixmap(played, m_played, QRectF(played.topLeft() * ratio, played.size() * ratio));
+    }
+    if (!unplayed.isEmpty()) {
+        painter.drawPixmap(unplayed, m_unplayed, QRectF(unplayed.topLeft() * ratio, unplayed.size() * ratio));
+    }
+}
+
+void WaveformOverviewWidget::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    renderPixmaps();
+}
+
+void WaveformOverviewWidget::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton && m_peaks && width() > 0) {
+        emit seekRequested(qBound(0.0, event->position().x() / width(), 1.0));
+        event->accept();
+        return;
+    }
+    QWidget::mousePressEvent(event);
+}
+
+void WaveformOverviewWidget::mouseMoveEvent(QMouseEvent* event)
+{
+    if ((event->buttons() & Qt::LeftButton) && m_peaks && width() > 0) {
+        emit seekRequested(qBound(0.0, event->position().x() / width(), 1.0));
+        event->accept();
+        return;
+    }
+    QWidget::mouseMoveEvent(event);
+}
@@ -0,0 +1,170 @@
+#include "video/ExportJobQueue.h"
+#include <QLoggingCategory>
+#include <QMetaObject>
+#include <QPointer>
+#include <QThread>
+#include <algorithm>
+#include <utility>
+
+Q_DECLARE_LOGGING_CATEGORY(exportJobQueue)
+Q_LOGGING_CATEGORY(exportJobQueue, "video.exportjobs")
+
+void ExportJobQueue::Context::setProgress(int percent)
+{
+    percent = qBound(0, percent, 100);
+    if (m_progress.exchange(percent, std::memory_order_relaxed) == percent) {
+        return;
+    }
+
+    // Delivered on the queue's thread; dropped if the queue is gone
+    QPointer<ExportJobQueue> queue = m_queue;
+    const int id = m_id;
+    QMetaObject::invokeMethod(m_queue, [queue, id, percent]() {
+        if (queue && queue->m_running.contains(id)) {
+            emit queue->jobProgress(id, percent);
+        }
+    }, Qt::QueuedConnection);
+}
+
+ExportJobQueue::ExportJobQueue(QObject* parent)
+    : QObject(parent)
+    , m_cpuBudget(defaultCpuBudget())
+{
+    m_pool.setMaxThreadCount(m_cpuBudget);
+}
+
+ExportJobQueue::~ExportJobQueue()
+{
+    shutdown();
+}
+
+int ExportJobQueue::submit(const QString& name, const Work& work, Priority priority, int cpuCost)
+{
+    Job job;
+    job.id = m_nextId++;
+    job.name = name;
+    job.work = work;
+    job.priority = priority;
+    job.cpuCost = qMax(1, cpuCost);
+
+    // After every job of the same or higher priority
+    auto it = std::find_if(m_pending.begin(), m_pending.end(),
+                           [priority](const Job& pending) { return pending.priority < priority; });
+    m_pending.insert(it, job);
+
+    qCDebug(exportJobQueue) << "Queued job" << job.id << name << "priority" << priority << "cost" << job.cpuCost;
+    schedule();
+    return job.id;
+}
+
+bool ExportJobQueue::cancel(int id)
+{
+    auto running = m_running.constFind(id);
+    if (running != m_running.constEnd()) {
+        // The body notices at its next check and returns
+        running.value()->m_cancelled.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    auto it = std::find_if(m_pending.begin(), m_pending.end(),
+                           [id](const Job& pending) { return pending.id == id; });
+    if (it == m_pending.end()) {
+        return false;
+    }
+
+    m_pending.erase(it);
+    emit jobFinished(id, false, true);
+    return true;
+}
+
+void ExportJobQueue::cancelAll()
+{
+    const QList<Job> pending = std::exchange(m_pending, QList<Job>());
+    for (const Job& job : pending) {
+        emit jobFinished(job.id, false, true);
+    }
+    for (const std::shared_ptr<Context>& context : std::as_const(m_running)) {
+        context->m_cancelled.store(true, std::memory_order_relaxed);
+    }
+}
+
+void ExportJobQueue::shutdown()
+{
+    cancelAll();
+    m_pool.waitForDone();
+}
+
+void ExportJobQueue::setCpuBudget(int threads)
+{
+    m_cpuBudget = threads > 0 ? threads : defaultCpuBudget();
+    m_pool.setMaxThreadCount(m_cpuBudget);
+    schedule();
+}
+
+int ExportJobQueue::jobProgress(int id) const
+{
+    auto it = m_running.constFind(id);
+    return it != m_running.constEnd() ? it.value()->m_progress.load(std::memory_order_relaxed) : -1;
+}
+
+int ExportJobQueue::defaultCpuBudget()
+{
+    // One core stays with playback and the UI
+    return qMax(1, QThread::idealThreadCount() - 1);
+}
+
+void ExportJobQueue::schedule()
+{
+    // Strictly in order, so a large job is not starved by smaller ones behind it
+    while (!m_pending.isEmpty()) {
+        const Job& next = m_pending.first();
+        const int cost = qMin(next.cpuCost, m_cpuBudget);
+        if (!m_running.isEmpty() && m_cpuInUse + cost > m_cpuBudget) {
+            break;
+        }
+        start(m_pending.takeFirst());
+    }
+}
+
+void ExportJobQueue::start(Job job)
+{
+    auto context = std::make_shared<Context>();
+    context->m_queue = this;
+    context->m_id = job.id;
+    context->m_threads = qMin(job.cpuCost, m_cpuBudget);
+
+    m_running.insert(job.id, context);
+    m_cpuInUse += context->m_threads;
+    emit jobStarted(job.id, job.name);
+
+    QPointer<ExportJobQueue> queue = this;
+    const Work work = job.work;
+    const int id = job.id;
+    m_pool.start([queue, work, context, id]() {
+        bool success = false;
+        if (!context->isCancelled()) {
+            success = work(*context);
+        }
+
+        QMetaObject::invokeMethod(queue, [queue, id, success]() {
+            if (queue) {
+                queue->onJobDone(id, success);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void ExportJobQueue::onJobDone(int id, bool success)
+{
+    const std::shared_ptr<Context> context = m_running.take(id);
+    if (!context) {
+        return;
+    }
+
+    m_cpuInUse -= context->m_threads;
+    const bool cancelled = context->isCancelled();
+    qCDebug(exportJobQueue) << "Job" << id << (cancelled ? "cancelled" : success ? "finished" : "failed");
+
+    emit jobFinished(id, success && !cancelled, cancelled);
+    schedule();
+}
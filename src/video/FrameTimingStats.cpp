@@ -0,0 +1,158 @@
+#include "video/FrameTimingStats.h"
+#include "Metrics.h"
+#include <QVector>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+MetricCounter& presentedFrames()
+{
+    static MetricCounter& counter = MetricsRegistry::instance().counter(
+        "eonplay_video_frames_presented", "Video frames put on screen");
+    return counter;
+}
+
+MetricCounter& lateFrames()
+{
+    static MetricCounter& counter = MetricsRegistry::instance().counter(
+        "eonplay_video_frames_late", "Video frames shown after the vsync they were due for");
+    return counter;
+}
+
+MetricCounter& supersededFrames()
+{
+    static MetricCounter& counter = MetricsRegistry::instance().counter(
+        "eonplay_video_frames_superseded", "Video frames replaced by a newer one before they were shown");
+    return counter;
+}
+
+LatencyHistogram& frameIntervals()
+{
+    static LatencyHistogram& histogram = MetricsRegistry::instance().histogram(
+        "eonplay_video_frame_interval_seconds", "Time between two frames put on screen");
+    return histogram;
+}
+
+double percentileMs(const QVector<qint64>& sorted, double q)
+{
+    if (sorted.isEmpty()) {
+        return 0.0;
+    }
+    const int index = qBound(0, static_cast<int>(q * sorted.size()), static_cast<int>(sorted.size()) - 1);
+    return sorted[index] / 1000.0;
+}
+
+} // namespace
+
+FrameTimingStats::FrameTimingStats()
+    : m_delivered(0)
+    , m_superseded(0)
+    , m_presented(0)
+    , m_late(0)
+    , m_vsyncMisses(0)
+    , m_lastPresentedUs(-1)
+    , m_windowStart(0)
+    , m_windowCount(0)
+{
+}
+
+qint64 FrameTimingStats::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FrameTimingStats::frameDelivered(bool replacedPending)
+{
+    m_delivered.fetch_add(1, std::memory_order_relaxed);
+    if (replacedPending) {
+        m_superseded.fetch_add(1, std::memory_order_relaxed);
+        supersededFrames().add();
+    }
+}
+
+void FrameTimingStats::framePresented(qint64 deliveredUs, double refreshRate)
+{
+    const qint64 nowUs = now();
+    const qint64 refreshUs = static_cast<qint64>(1e6 / (refreshRate > 0.0 ? refreshRate : 60.0));
+    const qint64 latencyUs = qMax<qint64>(0, nowUs - deliveredUs);
+
+    ++m_presented;
+    presentedFrames().add();
+
+    const bool late = latencyUs > refreshUs;
+    if (late) {
+        ++m_late;
+        m_vsyncMisses += static_cast<quint64>(latencyUs / refreshUs);
+        lateFrames().add();
+    }
+
+    const qint64 intervalUs = m_lastPresentedUs >= 0 ? nowUs - m_lastPresentedUs : -1;
+    m_lastPresentedUs = nowUs;
+    if (intervalUs < 0 || intervalUs > MAX_INTERVAL_US) {
+        return;
+    }
+
+    frameIntervals().record(intervalUs);
+
+    Sample& sample = m_window[(m_windowStart + m_windowCount) % WINDOW_SIZE];
+    sample.intervalUs = intervalUs;
+    sample.latencyUs = latencyUs;
+    sample.late = late;
+    if (m_windowCount < WINDOW_SIZE) {
+        ++m_windowCount;
+    } else {
+        m_windowStart = (m_windowStart + 1) % WINDOW_SIZE;
+    }
+}
+
+FrameTimingStats::Snapshot FrameTimingStats::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.delivered = m_delivered.load(std::memory_order_relaxed);
+    snapshot.superseded = m_superseded.load(std::memory_order_relaxed);
+    snapshot.presented = m_presented;
+    snapshot.late = m_late;
+    snapshot.vsyncMisses = m_vsyncMisses;
+    snapshot.windowFrames = m_windowCount;
+    if (m_windowCount == 0) {
+        return snapshot;
+    }
+
+    QVector<qint64> intervals;
+    intervals.reserve(m_windowCount);
+    qint64 totalInterval = 0;
+    qint64 totalLatency = 0;
+    int lateCount = 0;
+    for (int i = 0; i < m_windowCount; ++i) {
+        const Sample& sample = m_window[(m_windowStart + i) % WINDOW_SIZE];
+        intervals.append(sample.intervalUs);
+        totalInterval += sample.intervalUs;
+        totalLatency += sample.latencyUs;
+        lateCount += sample.late ? 1 : 0;
+    }
+    std::sort(intervals.begin(), intervals.end());
+
+    snapshot.fps = totalInterval > 0 ? m_windowCount * 1e6 / totalInterval : 0.0;
+    snapshot.meanMs = totalInterval / 1000.0 / m_windowCount;
+    snapshot.p50Ms = percentileMs(intervals, 0.50);
+    snapshot.p95Ms = percentileMs(intervals, 0.95);
+    snapshot.p99Ms = percentileMs(intervals, 0.99);
+    snapshot.maxMs = intervals.last() / 1000.0;
+    snapshot.latencyMs = totalLatency / 1000.0 / m_windowCount;
+    snapshot.windowLatePercent = 100.0 * lateCount / m_windowCount;
+    return snapshot;
+}
+
+void FrameTimingStats::reset()
+{
+    m_delivered.store(0, std::memory_order_relaxed);
+    m_superseded.store(0, std::memory_order_relaxed);
+    m_presented = 0;
+    m_late = 0;
+    m_vsyncMisses = 0;
+    m_lastPresentedUs = -1;
+    m_windowStart = 0;
+    m_windowCount = 0;
+}
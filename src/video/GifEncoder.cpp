@@ -0,0 +1,584 @@
+#include "video/GifEncoder.h"
+#include <QLoggingCategory>
+#include <QtMath>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+Q_DECLARE_LOGGING_CATEGORY(gifEncoder)
+Q_LOGGING_CATEGORY(gifEncoder, "video.gif")
+
+namespace {
+constexpr int HISTOGRAM_SIZE = 1 << 15;
+constexpr int LZW_MAX_CODE = 4095;
+
+const int BAYER_8X8[64] = {
+     0, 32,  8, 40,  2, 34, 10, 42,
+    48, 16, 56, 24, 50, 18, 58, 26,
+    12, 44,  4, 36, 14, 46,  6, 38,
+    60, 28, 52, 20, 62, 30, 54, 22,
+     3, 35, 11, 43,  1, 33,  9, 41,
+    51, 19, 59, 27, 49, 17, 57, 25,
+    15, 47,  7, 39, 13, 45,  5, 37,
+    63, 31, 55, 23, 61, 29, 53, 21
+};
+
+inline int colorKey(int red, int green, int blue)
+{
+    return ((red >> 3) << 10) | ((green >> 3) << 5) | (blue >> 3);
+}
+
+inline int keyChannel(int key, int channel)
+{
+    return (key >> (10 - 5 * channel)) & 31;
+}
+
+void appendWord(QByteArray& out, int value)
+{
+    out.append(static_cast<char>(value & 0xFF));
+    out.append(static_cast<char>((value >> 8) & 0xFF));
+}
+}
+
+GifEncoder::Histogram::Histogram()
+    : m_bins(HISTOGRAM_SIZE)
+{
+}
+
+void GifEncoder::Histogram::add(const uchar* rgb, int pixelCount, int step)
+{
+    step = qMax(1, step);
+    for (int i = 0; i < pixelCount; i += step) {
+        const uchar* pixel = rgb + i * 3;
+        Bin& bin = m_bins[colorKey(pixel[0], pixel[1], pixel[2])];
+        ++bin.count;
+        bin.red += pixel[0];
+        bin.green += pixel[1];
+        bin.blue += pixel[2];
+    }
+}
+
+GifEncoder::Palette GifEncoder::Histogram::medianCut(int colorCount) const
+{
+    struct Entry {
+        int key;
+        quint64 count;
+    };
+    struct Box {
+        int begin;
+        int end;
+        quint64 count;
+        int channel;    // Widest channel
+        int range;      // Its extent in 5-bit steps
+    };
+
+    QVector<Entry> entries;
+    for (int key = 0; key < HISTOGRAM_SIZE; ++key) {
+        if (m_bins[key].count > 0) {
+            entries.append({key, m_bins[key].count});
+        }
+    }
+
+    auto measure = [&entries](Box& box) {
+        int low[3] = {31, 31, 31};
+        int high[3] = {0, 0, 0};
+        box.count = 0;
+        for (int i = box.begin; i < box.end; ++i) {
+            box.count += entries[i].count;
+            for (int channel = 0; channel < 3; ++channel) {
+                const int value = keyChannel(entries[i].key, channel);
+                low[channel] = qMin(low[channel], value);
+                high[channel] = qMax(high[channel], value);
+            }
+        }
+        box.channel = 0;
+        box.range = -1;
+        for (int channel = 0; channel < 3; ++channel) {
+            if (high[channel] - low[channel] > box.range) {
+                box.channel = channel;
+                box.range = high[channel] - low[channel];
+            }
+        }
+    };
+
+    QVector<Box> boxes;
+    if (!entries.isEmpty()) {
+        Box all{0, static_cast<int>(entries.size()), 0, 0, 0};
+        measure(all);
+        boxes.append(all);
+    }
+
+    while (boxes.size() < colorCount) {
+        // Split the box covering the most pixels times color extent
+        int widest = -1;
+        quint64 widestScore = 0;
+        for (int i = 0; i < boxes.size(); ++i) {
+            const quint64 score = boxes[i].count * static_cast<quint64>(boxes[i].range);
+            if (boxes[i].end - boxes[i].begin > 1 && score > widestScore) {
+                widest = i;
+                widestScore = score;
+            }
+        }
+        if (widest < 0) {
+            break;
+        }
+
+        Box box = boxes[widest];
+        std::sort(entries.begin() + box.begin, entries.begin() + box.end,
+                  [channel = box.channel](const Entry& a, const Entry& b) {
+                      return keyChannel(a.key, channel) < keyChannel(b.key, channel);
+                  });
+
+        // Weighted median, keeping both halves non-empty
+        quint64 seen = 0;
+        int split = box.begin + 1;
+        for (int i = box.begin; i < box.end - 1; ++i) {
+            seen += entries[i].count;
+            split = i + 1;
+            if (seen * 2 >= box.count) {
+                break;
+            }
+        }
+
+        Box lower{box.begin, split, 0, 0, 0};
+        Box upper{split, box.end, 0, 0, 0};
+        measure(lower);
+        measure(upper);
+        boxes[widest] = lower;
+        boxes.append(upper);
+    }
+
+    Palette palette;
+    palette.reserve(boxes.size());
+    for (const Box& box : boxes) {
+        quint64 count = 0;
+        quint64 red = 0;
+        quint64 green = 0;
+        quint64 blue = 0;
+        for (int i = box.begin; i < box.end; ++i) {
+            const Bin& bin = m_bins[entries[i].key];
+            count += bin.count;
+            red += bin.red;
+            green += bin.green;
+            blue += bin.blue;
+        }
+        palette.append(qRgb(static_cast<int>((red + count / 2) / count),
+                            static_cast<int>((green + count / 2) / count),
+                            static_cast<int>((blue + count / 2) / count)));
+    }
+    return palette;
+}
+
+GifEncoder::GifEncoder(const Options& options)
+    : m_options(options)
+    , m_device(nullptr)
+    , m_lookup(HISTOGRAM_SIZE)
+    , m_transparentIndex(-1)
+    , m_hasCanvas(false)
+    , m_failed(false)
+{
+    m_options.colorCount = qBound(2, m_options.colorCount, 256);
+    m_options.threads = qMax(1, m_options.threads);
+    m_options.differenceTolerance = qBound(0, m_options.differenceTolerance, 255);
+
+    // The calling thread takes a share of every parallel step itself
+    m_pool.setMaxThreadCount(qMax(1, m_options.threads - 1));
+}
+
+GifEncoder::~GifEncoder()
+{
+    m_pool.waitForDone();
+}
+
+void GifEncoder::setGlobalPalette(const Palette& palette)
+{
+    m_globalPalette = palette.mid(0, paletteColors());
+}
+
+int GifEncoder::paletteColors() const
+{
+    // One table entry is kept for transparency when frames are differenced
+    return m_options.colorCount - (m_options.frameDifferencing ? 1 : 0);
+}
+
+bool GifEncoder::open(QIODevice* device, const QSize& size)
+{
+    if (!device || !device->isWritable() || size.isEmpty() || size.width() > 0xFFFF || size.height() > 0xFFFF) {
+        return false;
+    }
+
+    m_device = device;
+    m_size = size;
+    m_failed = false;
+    m_hasCanvas = false;
+    m_pending = PendingFrame();
+    const int pixels = size.width() * size.height();
+    m_indices.resize(pixels);
+    m_canvasSource.resize(pixels * 3);
+
+    QByteArray header("GIF89a");
+    appendWord(header, size.width());
+    appendWord(header, size.height());
+    if (!m_globalPalette.isEmpty()) {
+        const int bits = tableBits(m_globalPalette.size() + (m_options.frameDifferencing ? 1 : 0));
+        header.append(static_cast<char>(0x80 | 0x70 | (bits - 1)));
+        header.append('\0');    // Background color
+        header.append('\0');    // Pixel aspect ratio
+        appendColorTable(header, m_globalPalette, bits);
+
+        m_palette = m_globalPalette;
+        m_transparentIndex = m_options.frameDifferencing ? m_palette.size() : -1;
+        buildLookup(m_palette);
+    } else {
+        header.append(static_cast<char>(0x70));
+        header.append('\0');
+        header.append('\0');
+    }
+
+    if (m_options.loop) {
+        header.append("\x21\xFF\x0BNETSCAPE2.0\x03\x01", 16);
+        appendWord(header, 0);  // Loop forever
+        header.append('\0');
+    }
+    return write(header);
+}
+
+bool GifEncoder::addFrame(const uchar* rgb, int delay)
+{
+    if (!m_device || m_failed) {
+        return false;
+    }
+
+    const int width = m_size.width();
+    const int height = m_size.height();
+
+    if (m_globalPalette.isEmpty()) {
+        Histogram histogram;
+        histogram.add(rgb, width * height, 2);
+        m_palette = histogram.medianCut(paletteColors());
+        m_transparentIndex = m_options.frameDifferencing ? m_palette.size() : -1;
+        buildLookup(m_palette);
+    }
+
+    const int strips = qMin(m_options.threads, height);
+    QVector<QRect> changed(strips);
+    parallelFor(strips, [&](int strip) {
+        quantizeStrip(rgb, height * strip / strips, height * (strip + 1) / strips, &changed[strip]);
+    });
+
+    QRect rect;
+    for (const QRect& stripRect : changed) {
+        rect = rect.united(stripRect);
+    }
+
+    const bool differenced = m_options.frameDifferencing && m_hasCanvas;
+    m_hasCanvas = true;
+    if (rect.isEmpty()) {
+        // Nothing changed: show the previous frame for longer
+        m_pending.delay += delay;
+        return true;
+    }
+
+    if (!flushPending()) {
+        return false;
+    }
+    m_pending.imageData = encodeImage(rect, m_globalPalette.isEmpty() ? m_palette : Palette());
+    m_pending.delay = delay;
+    m_pending.transparent = differenced;
+    m_pending.valid = true;
+    return true;
+}
+
+bool GifEncoder::close()
+{
+    if (!m_device) {
+        return false;
+    }
+
+    const bool success = !m_failed && flushPending() && write(QByteArray(1, '\x3B'));
+    m_device = nullptr;
+    return success;
+}
+
+void GifEncoder::parallelFor(int count, const std::function<void(int index)>& body)
+{
+    for (int i = 1; i < count; ++i) {
+        m_pool.start([&body, i]() { body(i); });
+    }
+    if (count > 0) {
+        body(0);
+    }
+    m_pool.waitForDone();
+}
+
+void GifEncoder::buildLookup(const Palette& palette)
+{
+    // Nearest color for the center of every 15-bit cell
+    const int chunks = m_options.threads;
+    parallelFor(chunks, [&](int chunk) {
+        const int end = HISTOGRAM_SIZE * (chunk + 1) / chunks;
+        for (int key = HISTOGRAM_SIZE * chunk / chunks; key < end; ++key) {
+            const int red = (keyChannel(key, 0) << 3) | 4;
+            const int green = (keyChannel(key, 1) << 3) | 4;
+            const int blue = (keyChannel(key, 2) << 3) | 4;
+            int best = 0;
+            int bestDistance = INT_MAX;
+            for (int i = 0; i < palette.size(); ++i) {
+                const int dr = qRed(palette[i]) - red;
+                const int dg = qGreen(palette[i]) - green;
+                const int db = qBlue(palette[i]) - blue;
+                const int distance = dr * dr + dg * dg + db * db;
+                if (distance < bestDistance) {
+                    best = i;
+                    bestDistance = distance;
+                }
+            }
+            m_lookup[key] = static_cast<quint8>(best);
+        }
+    });
+}
+
+void GifEncoder::quantizeStrip(const uchar* rgb, int top, int bottom, QRect* changed)
+{
+    const int width = m_size.width();
+    const bool differenced = m_options.frameDifferencing && m_hasCanvas;
+    const int tolerance = m_options.differenceTolerance;
+    const bool diffuse = m_options.dither == FloydSteinberg;
+
+    int ordered[64] = {};
+    if (m_options.dither == OrderedDither) {
+        // Spread the thresholds over about half the distance between palette levels
+        const double spread = 127.5 / std::cbrt(static_cast<double>(qMax(2, m_palette.size())));
+        for (int i = 0; i < 64; ++i) {
+            ordered[i] = qRound((BAYER_8X8[i] - 31.5) * spread / 64.0);
+        }
+    }
+
+    // Error rows in sixteenths, with a pixel of padding on either side
+    std::vector<int> current;
+    std::vector<int> next;
+    if (diffuse) {
+        current.assign((width + 2) * 3, 0);
+        next.assign((width + 2) * 3, 0);
+    }
+
+    int left = width;
+    int right = -1;
+    int first = -1;
+    int last = -1;
+
+    for (int y = top; y < bottom; ++y) {
+        const bool reverse = diffuse && ((y - top) & 1);
+        const int direction = reverse ? -1 : 1;
+        bool rowChanged = false;
+
+        for (int i = 0; i < width; ++i) {
+            const int x = reverse ? width - 1 - i : i;
+            const int index = y * width + x;
+            const uchar* source = rgb + index * 3;
+            uchar* drawn = m_canvasSource.data() + index * 3;
+
+            if (differenced
+                && std::abs(source[0] - drawn[0]) <= tolerance
+                && std::abs(source[1] - drawn[1]) <= tolerance
+                && std::abs(source[2] - drawn[2]) <= tolerance) {
+                // Unchanged pixels stay as drawn and take no diffused error
+                m_indices[index] = static_cast<uchar>(m_transparentIndex);
+                continue;
+            }
+
+            int color[3] = {source[0], source[1], source[2]};
+            const int offset = ordered[((y & 7) << 3) | (x & 7)];
+            int* error = diffuse ? &current[(x + 1) * 3] : nullptr;
+            for (int channel = 0; channel < 3; ++channel) {
+                color[channel] += offset + (error ? error[channel] / 16 : 0);
+                color[channel] = qBound(0, color[channel], 255);
+            }
+
+            const int paletteIndex = m_lookup[colorKey(color[0], color[1], color[2])];
+            m_indices[index] = static_cast<uchar>(paletteIndex);
+
+            if (diffuse) {
+                const QRgb chosen = m_palette[paletteIndex];
+                const int residual[3] = {color[0] - qRed(chosen), color[1] - qGreen(chosen), color[2] - qBlue(chosen)};
+                int* ahead = &current[(x + 1 + direction) * 3];
+                int* below = &next[(x + 1) * 3];
+                for (int channel = 0; channel < 3; ++channel) {
+                    ahead[channel] += residual[channel] * 7;
+                    below[channel - 3 * direction] += residual[channel] * 3;
+                    below[channel] += residual[channel] * 5;
+                    below[channel + 3 * direction] += residual[channel];
+                }
+            }
+
+            drawn[0] = source[0];
+            drawn[1] = source[1];
+            drawn[2] = source[2];
+            left = qMin(left, x);
+            right = qMax(right, x);
+            rowChanged = true;
+        }
+
+        if (rowChanged) {
+            first = first < 0 ? y : first;
+            last = y;
+        }
+        if (diffuse) {
+            current.swap(next);
+            std::fill(next.begin(), next.end(), 0);
+        }
+    }
+
+    *changed = first < 0 ? QRect() : QRect(QPoint(left, first), QPoint(right, last));
+}
+
+QByteArray GifEncoder::encodeImage(const QRect& rect, const Palette& localPalette) const
+{
+    QByteArray out;
+    out.append('\x2C');
+    appendWord(out, rect.x());
+    appendWord(out, rect.y());
+    appendWord(out, rect.width());
+    appendWord(out, rect.height());
+
+    const int entries = m_palette.size() + (m_transparentIndex >= 0 ? 1 : 0);
+    const int bits = tableBits(entries);
+    if (!localPalette.isEmpty()) {
+        out.append(static_cast<char>(0x80 | (bits - 1)));
+        appendColorTable(out, localPalette, bits);
+    } else {
+        out.append('\0');
+    }
+
+    QVector<uchar> cropped;
+    cropped.reserve(rect.width() * rect.height());
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        const uchar* row = m_indices.constData() + y * m_size.width();
+        cropped.append(row + rect.left(), rect.width());
+    }
+    out.append(lzwEncode(cropped, qMax(2, bits)));
+    return out;
+}
+
+bool GifEncoder::flushPending()
+{
+    if (!m_pending.valid) {
+        return true;
+    }
+
+    // Graphic control: keep the previous frame underneath, optional transparent index
+    QByteArray control("\x21\xF9\x04", 3);
+    control.append(static_cast<char>((1 << 2) | (m_pending.transparent ? 1 : 0)));
+    appendWord(control, qMin(m_pending.delay, 0xFFFF));
+    control.append(static_cast<char>(m_pending.transparent ? m_transparentIndex : 0));
+    control.append('\0');
+
+    m_pending.valid = false;
+    return write(control + m_pending.imageData);
+}
+
+bool GifEncoder::write(const QByteArray& data)
+{
+    if (m_device->write(data) != data.size()) {
+        qCWarning(gifEncoder) << "Failed to write GIF data:" << m_device->errorString();
+        m_failed = true;
+    }
+    return !m_failed;
+}
+
+void GifEncoder::appendColorTable(QByteArray& out, const Palette& palette, int tableBits)
+{
+    const int size = 1 << tableBits;
+    for (int i = 0; i < size; ++i) {
+        const QRgb color = i < palette.size() ? palette[i] : 0;
+        out.append(static_cast<char>(qRed(color)));
+        out.append(static_cast<char>(qGreen(color)));
+        out.append(static_cast<char>(qBlue(color)));
+    }
+}
+
+int GifEncoder::tableBits(int colors)
+{
+    int bits = 1;
+    while ((1 << bits) < colors) {
+        ++bits;
+    }
+    return bits;
+}
+
+QByteArray GifEncoder::lzwEncode(const QVector<uchar>& indices, int minCodeSize)
+{
+    QByteArray out;
+    out.append(static_cast<char>(minCodeSize));
+
+    // Codes are packed LSB first into sub-blocks of up to 255 bytes
+    QByteArray block;
+    quint32 bitBuffer = 0;
+    int bitCount = 0;
+    auto putByte = [&](uchar byte) {
+        block.append(static_cast<char>(byte));
+        if (block.size() == 255) {
+            out.append(static_cast<char>(255));
+            out.append(block);
+            block.clear();
+        }
+    };
+    auto putCode = [&](int code, int size) {
+        bitBuffer |= static_cast<quint32>(code) << bitCount;
+        bitCount += size;
+        while (bitCount >= 8) {
+            putByte(static_cast<uchar>(bitBuffer & 0xFF));
+            bitBuffer >>= 8;
+            bitCount -= 8;
+        }
+    };
+
+    // Dictionary as a trie: code * 256 + next index -> code, 0 if absent
+    std::vector<quint16> children((LZW_MAX_CODE + 1) * 256, 0);
+    const int clearCode = 1 << minCodeSize;
+    int codeSize = minCodeSize + 1;
+    int lastCode = clearCode + 1;
+    int current = -1;
+
+    putCode(clearCode, codeSize);
+    for (uchar value : indices) {
+        if (current < 0) {
+            current = value;
+            continue;
+        }
+        quint16& child = children[current * 256 + value];
+        if (child) {
+            current = child;
+            continue;
+        }
+
+        putCode(current, codeSize);
+        child = static_cast<quint16>(++lastCode);
+        if (lastCode >= (1 << codeSize)) {
+            ++codeSize;
+        }
+        if (lastCode == LZW_MAX_CODE) {
+            putCode(clearCode, codeSize);
+            std::fill(children.begin(), children.end(), 0);
+            codeSize = minCodeSize + 1;
+            lastCode = clearCode + 1;
+        }
+        current = value;
+    }
+    if (current >= 0) {
+        putCode(current, codeSize);
+    }
+    putCode(clearCode + 1, codeSize);
+
+    if (bitCount > 0) {
+        putByte(static_cast<uchar>(bitBuffer & 0xFF));
+    }
+    if (!block.isEmpty()) {
+        out.append(static_cast<char>(block.size()));
+        out.append(block);
+    }
+    out.append('\0');
+    return out;
+}
@@ -0,0 +1,311 @@
+#include "video/GpuVideoOutput.h"
+#include "audio/TripleBuffer.h"
+#include <QCoreApplication>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QVector>
+#include <utility>
+
+// libVLC includes
+#include <vlc/vlc.h>
+
+Q_DECLARE_LOGGING_CATEGORY(gpuVideoOutput)
+Q_LOGGING_CATEGORY(gpuVideoOutput, "video.gpuoutput")
+
+/**
+ * @brief Render targets and context of one player
+ *
+ * Everything but the constructor and releaseTargets() runs on libVLC's
+ * video output thread, between its makeCurrent calls.
+ */
+struct GpuVideoOutput::Renderer {
+    struct Target {
+        GLuint framebuffer = 0;         // Only valid in the renderer's context
+        GLuint texture = 0;             // Shared with the presenter
+        QSize size;
+        GLsync fence = nullptr;         // Signalled once libVLC's draw is done
+    };
+
+    GpuVideoOutput* output = nullptr;
+    std::unique_ptr<QOffscreenSurface> surface;
+    std::unique_ptr<QOpenGLContext> context;
+    TripleBuffer<Target> targets;
+    QVector<Target*> allocated;         // Slots holding GL objects
+    QSize size;                         // Picture size libVLC renders
+
+    QOpenGLExtraFunctions* functions() const { return context->extraFunctions(); }
+
+    /**
+     * @brief Bind the write slot as libVLC's framebuffer, sizing it first if needed
+     */
+    void bindTarget()
+    {
+        QOpenGLExtraFunctions* f = functions();
+        Target& target = targets.writeBuffer();
+        if (target.size != size) {
+            if (!target.texture) {
+                f->glGenTextures(1, &target.texture);
+                f->glGenFramebuffers(1, &target.framebuffer);
+                allocated.append(&target);
+            }
+
+            // 10 bits per channel keep HDR and wide gamut pictures from banding
+            f->glBindTexture(GL_TEXTURE_2D, target.texture);
+            f->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB10_A2, size.width(), size.height(), 0, GL_RGBA,
+                            GL_UNSIGNED_INT_2_10_10_10_REV, nullptr);
+            f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            f->glBindTexture(GL_TEXTURE_2D, 0);
+
+            f->glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+            f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+            target.size = size;
+        }
+        f->glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    }
+
+    /**
+     * @brief Delete every GL object; the player must have been released
+     */
+    void releaseTargets()
+    {
+        if (allocated.isEmpty() || !context->makeCurrent(surface.get())) {
+            return;
+        }
+
+        QOpenGLExtraFunctions* f = functions();
+        for (Target* target : allocated) {
+            if (target->fence) {
+                f->glDeleteSync(target->fence);
+            }
+            f->glDeleteFramebuffers(1, &target->framebuffer);
+            f->glDeleteTextures(1, &target->texture);
+            *target = Target();
+        }
+        allocated.clear();
+        context->doneCurrent();
+    }
+
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(4, 0, 0, 0)
+    static bool setup(void** opaque, const libvlc_video_setup_device_cfg_t* config,
+                      libvlc_video_setup_device_info_t* info)
+    {
+        // The context exists from attachPlayer() on; opaque already points here
+        Q_UNUSED(opaque)
+        Q_UNUSED(config)
+        Q_UNUSED(info)
+        return true;
+    }
+
+    static void cleanup(void* opaque)
+    {
+        // Targets outlive the video output, which libVLC reopens per media
+        Q_UNUSED(opaque)
+    }
+
+    static bool updateOutput(void* opaque, const libvlc_video_render_cfg_t* config,
+                             libvlc_video_output_cfg_t* output)
+    {
+        auto* renderer = static_cast<Renderer*>(opaque);
+        renderer->size = QSize(static_cast<int>(config->width), static_cast<int>(config->height));
+        renderer->bindTarget();
+
+        // Kept as decoded, so HDR is tone mapped by the presenter and not here
+        output->opengl_format = GL_RGBA;
+        output->full_range = true;
+        output->colorspace = config->colorspace;
+        output->primaries = config->primaries;
+        output->transfer = config->transfer;
+        return true;
+    }
+
+    static void swap(void* opaque)
+    {
+        auto* renderer = static_cast<Renderer*>(opaque);
+        QOpenGLExtraFunctions* f = renderer->functions();
+
+        Target& target = renderer->targets.writeBuffer();
+        if (target.fence) {
+            f->glDeleteSync(target.fence);
+        }
+        target.fence = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        f->glFlush();   // Other contexts can only wait for submitted fences
+
+        renderer->targets.publish();
+        renderer->bindTarget();
+        renderer->output->notifyFrame(renderer);
+    }
+
+    static bool makeCurrent(void* opaque, bool enter)
+    {
+        auto* renderer = static_cast<Renderer*>(opaque);
+        if (enter) {
+            return renderer->context->makeCurrent(renderer->surface.get());
+        }
+        renderer->context->doneCurrent();
+        return true;
+    }
+
+    static void* getProcAddress(void* opaque, const char* name)
+    {
+        auto* renderer = static_cast<Renderer*>(opaque);
+        return reinterpret_cast<void*>(renderer->context->getProcAddress(name));
+    }
+#endif
+};
+
+GpuVideoOutput::GpuVideoOutput(QOpenGLContext* shareContext, QObject* parent)
+    : QObject(parent)
+    , m_shareContext(shareContext)
+    , m_activeChanged(false)
+    , m_advancePending(false)
+{
+    // libVLC makes the renderer contexts current on its own threads
+    QCoreApplication::setAttribute(Qt::AA_DontCheckOpenGLContextThreadAffinity);
+}
+
+GpuVideoOutput::~GpuVideoOutput()
+{
+    // Normally empty: VLCBackend detaches every player when the output is reset
+    QMutexLocker locker(&m_mutex);
+    m_active.reset();
+    for (const std::shared_ptr<Renderer>& renderer : std::as_const(m_renderers)) {
+        renderer->releaseTargets();
+    }
+    m_renderers.clear();
+}
+
+bool GpuVideoOutput::isSupported()
+{
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(4, 0, 0, 0)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool GpuVideoOutput::isSharedWith(QOpenGLContext* context) const
+{
+    return m_shareContext && context && QOpenGLContext::areSharing(m_shareContext, context);
+}
+
+bool GpuVideoOutput::attachPlayer(libvlc_media_player_t* player)
+{
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(4, 0, 0, 0)
+    if (!m_shareContext) {
+        return false;
+    }
+
+    auto renderer = std::make_shared<Renderer>();
+    renderer->output = this;
+
+    // Created here, on the GUI thread; libVLC only makes them current
+    renderer->surface = std::make_unique<QOffscreenSurface>();
+    renderer->surface->setFormat(m_shareContext->format());
+    renderer->surface->create();
+    renderer->context = std::make_unique<QOpenGLContext>();
+    renderer->context->setFormat(m_shareContext->format());
+    renderer->context->setShareContext(m_shareContext);
+    if (!renderer->surface->isValid() || !renderer->context->create()) {
+        qCWarning(gpuVideoOutput) << "Could not create a shared GL context, using pooled frames";
+        return false;
+    }
+
+    const libvlc_video_engine_t engine = renderer->context->isOpenGLES() ? libvlc_video_engine_gles2
+                                                                         : libvlc_video_engine_opengl;
+    if (!libvlc_video_set_output_callbacks(player, engine, Renderer::setup, Renderer::cleanup, nullptr,
+                                           Renderer::updateOutput, Renderer::swap, Renderer::makeCurrent,
+                                           Renderer::getProcAddress, nullptr, nullptr, renderer.get())) {
+        qCWarning(gpuVideoOutput) << "libVLC refused the GL output callbacks, using pooled frames";
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_renderers.insert(player, renderer);
+    qCDebug(gpuVideoOutput) << "Player renders into"
+                            << (engine == libvlc_video_engine_gles2 ? "GLES" : "OpenGL") << "textures";
+    return true;
+#else
+    Q_UNUSED(player)
+    return false;
+#endif
+}
+
+void GpuVideoOutput::detachPlayer(libvlc_media_player_t* player)
+{
+    std::shared_ptr<Renderer> renderer;
+    {
+        QMutexLocker locker(&m_mutex);
+        renderer = m_renderers.take(player);
+        if (renderer && renderer == m_active) {
+            m_active.reset();
+            m_activeChanged = true;
+        }
+    }
+
+    if (renderer) {
+        // Its textures go away with it, so views must stop drawing them first
+        advance();
+        renderer->releaseTargets();
+    }
+}
+
+void GpuVideoOutput::setActivePlayer(libvlc_media_player_t* player)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_active = m_renderers.value(player);
+        m_activeChanged = true;
+    }
+
+    // A preloaded player already holds its first picture
+    advance();
+}
+
+void GpuVideoOutput::notifyFrame(const Renderer* renderer)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_active.get() != renderer) {
+            return;
+        }
+    }
+
+    // Coalesce: pictures arriving before the GUI thread takes one are skipped
+    if (!m_advancePending.exchange(true)) {
+        QMetaObject::invokeMethod(this, &GpuVideoOutput::advance, Qt::QueuedConnection);
+    }
+}
+
+void GpuVideoOutput::advance()
+{
+    m_advancePending = false;
+
+    Frame frame;
+    {
+        QMutexLocker locker(&m_mutex);
+        const bool changed = m_activeChanged;
+        m_activeChanged = false;
+        if (m_active && (m_active->targets.consume() || changed)) {
+            const Renderer::Target& target = m_active->targets.readBuffer();
+            if (target.texture && target.fence) {
+                frame.texture = target.texture;
+                frame.size = target.size;
+                frame.fence = target.fence;
+            }
+        } else if (m_active) {
+            return;
+        }
+    }
+
+    if (!frame.texture && !m_current.texture) {
+        return;
+    }
+    frame.serial = m_current.serial + 1;
+    m_current = frame;
+    emit frameChanged();
+}
@@ -0,0 +1,118 @@
+#include "video/OnnxSuperResolution.h"
+#include <QFile>
+#include <QLoggingCategory>
+#include <onnxruntime_cxx_api.h>
+#include <array>
+#include <string>
+
+Q_DECLARE_LOGGING_CATEGORY(onnxSuperResolution)
+Q_LOGGING_CATEGORY(onnxSuperResolution, "video.upscaler.onnx")
+
+struct OnnxSuperResolution::Session {
+    Ort::Env env{ORT_LOGGING_LEVEL_WARNING, "EonPlay"};
+    Ort::SessionOptions options;
+    std::unique_ptr<Ort::Session> session;
+    std::string inputName;
+    std::string outputName;
+};
+
+OnnxSuperResolution::OnnxSuperResolution(int scale)
+    : m_scale(qMax(1, scale))
+    , m_gpu(false)
+{
+}
+
+OnnxSuperResolution::~OnnxSuperResolution() = default;
+
+std::unique_ptr<OnnxSuperResolution> OnnxSuperResolution::load(const QString& path, int scale, int threads,
+                                                               bool preferGpu)
+{
+    std::unique_ptr<OnnxSuperResolution> model(new OnnxSuperResolution(scale));
+    try {
+        auto session = std::make_unique<Session>();
+        session->options.SetIntraOpNumThreads(qMax(1, threads));
+        session->options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+        if (preferGpu) {
+            try {
+                OrtCUDAProviderOptions cuda{};
+                session->options.AppendExecutionProvider_CUDA(cuda);
+                model->m_gpu = true;
+            } catch (const Ort::Exception& e) {
+                qCDebug(onnxSuperResolution) << "CUDA not available, running on the CPU:" << e.what();
+            }
+        }
+
+#ifdef _WIN32
+        const std::wstring file = path.toStdWString();
+#else
+        const std::string file = QFile::encodeName(path).toStdString();
+#endif
+        session->session = std::make_unique<Ort::Session>(session->env, file.c_str(), session->options);
+
+        Ort::AllocatorWithDefaultOptions allocator;
+        session->inputName = session->session->GetInputNameAllocated(0, allocator).get();
+        session->outputName = session->session->GetOutputNameAllocated(0, allocator).get();
+        model->m_session = std::move(session);
+    } catch (const Ort::Exception& e) {
+        qCWarning(onnxSuperResolution) << "Failed to load model" << path << ":" << e.what();
+        return nullptr;
+    }
+
+    qCInfo(onnxSuperResolution) << "Loaded model" << path << "x" << model->m_scale << "GPU:" << model->m_gpu;
+    return model;
+}
+
+bool OnnxSuperResolution::upscaleTile(const uchar* input, int inputStride, const QSize& size,
+                                      uchar* output, int outputStride)
+{
+    const int width = size.width();
+    const int height = size.height();
+    const int plane = width * height;
+
+    // Interleaved 8-bit RGBA to planar float RGB
+    m_input.resize(3 * plane);
+    for (int y = 0; y < height; ++y) {
+        const uchar* row = input + y * inputStride;
+        for (int x = 0; x < width; ++x) {
+            for (int channel = 0; channel < 3; ++channel) {
+                m_input[channel * plane + y * width + x] = row[x * 4 + channel] / 255.0f;
+            }
+        }
+    }
+
+    try {
+        const std::array<int64_t, 4> shape{1, 3, height, width};
+        const Ort::MemoryInfo memory = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        Ort::Value tensor = Ort::Value::CreateTensor<float>(memory, m_input.data(), m_input.size(),
+                                                            shape.data(), shape.size());
+        const char* inputNames[] = {m_session->inputName.c_str()};
+        const char* outputNames[] = {m_session->outputName.c_str()};
+        auto outputs = m_session->session->Run(Ort::RunOptions{nullptr}, inputNames, &tensor, 1, outputNames, 1);
+
+        const int outputWidth = width * m_scale;
+        const int outputHeight = height * m_scale;
+        const std::vector<int64_t> outputShape = outputs[0].GetTensorTypeAndShapeInfo().GetShape();
+        if (outputShape.size() != 4 || outputShape[1] != 3
+            || outputShape[2] != outputHeight || outputShape[3] != outputWidth) {
+            qCWarning(onnxSuperResolution) << "Model output does not match a x" << m_scale << "upscale";
+            return false;
+        }
+
+        const float* data = outputs[0].GetTensorData<float>();
+        const int outputPlane = outputWidth * outputHeight;
+        for (int y = 0; y < outputHeight; ++y) {
+            uchar* row = output + y * outputStride;
+            for (int x = 0; x < outputWidth; ++x) {
+                for (int channel = 0; channel < 3; ++channel) {
+                    const float value = data[channel * outputPlane + y * outputWidth + x];
+                    row[x * 4 + channel] = static_cast<uchar>(qBound(0, qRound(value * 255.0f), 255));
+                }
+                row[x * 4 + 3] = 255;
+            }
+        }
+    } catch (const Ort::Exception& e) {
+        qCWarning(onnxSuperResolution) << "Inference failed:" << e.what();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,210 @@
+#include "video/SceneDetector.h"
+#include <QLoggingCategory>
+#include <QProcess>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EONPLAY_SCENE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define EONPLAY_SCENE_NEON
+#include <arm_neon.h>
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(sceneDetector)
+Q_LOGGING_CATEGORY(sceneDetector, "video.scenes")
+
+namespace {
+constexpr int BLOCKS_X = SceneDetector::FRAME_WIDTH / SceneDetector::BLOCK_SIZE;
+constexpr int BLOCKS_Y = SceneDetector::FRAME_HEIGHT / SceneDetector::BLOCK_SIZE;
+
+// A block counts as changed when its pixels differ by this much on average
+constexpr quint32 BLOCK_CHANGE_LEVEL = 24;
+
+constexpr int START_TIMEOUT_MS = 10000;
+constexpr int READ_POLL_MS = 100;
+
+/**
+ * Sum of absolute differences of two 16-pixel wide, BLOCK_SIZE high
+ * strips, i.e. of two horizontally adjacent blocks at once.
+ */
+void blockPairSad(const uchar* a, const uchar* b, quint32* left, quint32* right)
+{
+    constexpr int stride = SceneDetector::FRAME_WIDTH;
+
+#if defined(EONPLAY_SCENE_SSE2)
+    __m128i sum = _mm_setzero_si128();
+    for (int row = 0; row < SceneDetector::BLOCK_SIZE; ++row) {
+        const __m128i pa = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + row * stride));
+        const __m128i pb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + row * stride));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(pa, pb));
+    }
+    *left = static_cast<quint32>(_mm_cvtsi128_si32(sum));
+    *right = static_cast<quint32>(_mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+#elif defined(EONPLAY_SCENE_NEON)
+    uint16x8_t sum = vdupq_n_u16(0);
+    for (int row = 0; row < SceneDetector::BLOCK_SIZE; ++row) {
+        sum = vpadalq_u8(sum, vabdq_u8(vld1q_u8(a + row * stride), vld1q_u8(b + row * stride)));
+    }
+    const uint64x2_t halves = vpaddlq_u32(vpaddlq_u16(sum));
+    *left = static_cast<quint32>(vgetq_lane_u64(halves, 0));
+    *right = static_cast<quint32>(vgetq_lane_u64(halves, 1));
+#else
+    *left = 0;
+    *right = 0;
+    for (int row = 0; row < SceneDetector::BLOCK_SIZE; ++row) {
+        for (int x = 0; x < SceneDetector::BLOCK_SIZE * 2; ++x) {
+            const int difference = std::abs(int(a[row * stride + x]) - int(b[row * stride + x]));
+            (x < SceneDetector::BLOCK_SIZE ? *left : *right) += static_cast<quint32>(difference);
+        }
+    }
+#endif
+}
+}
+
+SceneDetector::SceneDetector(const Options& options)
+    : m_options(options)
+    , m_previous(FRAME_SIZE)
+    , m_hasPrevious(false)
+    , m_lastCut(0)
+{
+    m_options.sampleRate = qMax(0.1, m_options.sampleRate);
+    m_histogram.fill(0);
+    m_previousHistogram.fill(0);
+}
+
+void SceneDetector::reset()
+{
+    m_hasPrevious = false;
+    m_lastCut = 0;
+}
+
+bool SceneDetector::addFrame(const uchar* luma, qint64 time, Cut* cut)
+{
+    m_histogram.fill(0);
+    for (int i = 0; i < FRAME_SIZE; ++i) {
+        ++m_histogram[luma[i] >> 2];
+    }
+
+    bool isCut = false;
+    if (m_hasPrevious) {
+        // Histograms catch global changes, blocks catch cuts between similar palettes
+        const float score = 0.5f * histogramDistance(m_previousHistogram.data(), m_histogram.data())
+                          + 0.5f * changedBlockFraction(m_previous.constData(), luma);
+        if (score > m_options.threshold && time - m_lastCut >= m_options.minSceneLength) {
+            m_lastCut = time;
+            cut->time = time;
+            cut->score = qMin(1.0f, score);
+            isCut = true;
+        }
+    }
+
+    std::memcpy(m_previous.data(), luma, FRAME_SIZE);
+    m_previousHistogram = m_histogram;
+    m_hasPrevious = true;
+    return isCut;
+}
+
+bool SceneDetector::run(const QString& ffmpegPath, const QString& input, qint64 duration,
+                        ExportJobQueue::Context& context, const CutHandler& onCut)
+{
+    reset();
+
+    // Decoder options first: skip what the analysis cannot see anyway
+    QStringList arguments{"-hide_banner", "-nostats", "-loglevel", "error",
+                          "-threads", QString::number(context.threads()),
+                          "-skip_loop_filter", "all"};
+    if (m_options.keyframesOnly) {
+        arguments << "-skip_frame" << "nokey";
+    }
+    arguments << "-i" << input << "-an" << "-sn" << "-dn"
+              << "-vf" << QString("fps=%1,scale=%2:%3:flags=area,format=gray")
+                              .arg(m_options.sampleRate).arg(FRAME_WIDTH).arg(FRAME_HEIGHT)
+              << "-f" << "rawvideo" << "pipe:1";
+
+    QProcess process;
+    process.start(ffmpegPath, arguments);
+    if (!process.waitForStarted(START_TIMEOUT_MS)) {
+        qCWarning(sceneDetector) << "Failed to start FFmpeg:" << process.errorString();
+        return false;
+    }
+
+    QByteArray buffer;
+    qint64 frameIndex = 0;
+    auto consume = [&]() {
+        buffer += process.readAllStandardOutput();
+        int offset = 0;
+        while (buffer.size() - offset >= FRAME_SIZE) {
+            const qint64 time = qRound64(frameIndex * 1000.0 / m_options.sampleRate);
+            Cut cut;
+            if (addFrame(reinterpret_cast<const uchar*>(buffer.constData() + offset), time, &cut) && onCut) {
+                onCut(cut);
+            }
+            offset += FRAME_SIZE;
+            ++frameIndex;
+            if (duration > 0) {
+                context.setProgress(int(qMin<qint64>(99, time * 100 / duration)));
+            }
+        }
+        buffer.remove(0, offset);
+    };
+
+    while (process.state() != QProcess::NotRunning) {
+        if (context.isCancelled()) {
+            process.kill();
+            process.waitForFinished();
+            return false;
+        }
+        process.waitForReadyRead(READ_POLL_MS);
+        consume();
+    }
+    consume();
+
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        qCWarning(sceneDetector) << "FFmpeg failed:" << process.readAllStandardError().trimmed();
+        return false;
+    }
+
+    qCDebug(sceneDetector) << "Analysed" << frameIndex << "frames using" << simdBackend();
+    return true;
+}
+
+float SceneDetector::histogramDistance(const quint32* a, const quint32* b)
+{
+    quint32 distance = 0;
+    for (int i = 0; i < HISTOGRAM_BINS; ++i) {
+        distance += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    }
+    return static_cast<float>(distance) / (2.0f * FRAME_SIZE);
+}
+
+float SceneDetector::changedBlockFraction(const uchar* a, const uchar* b)
+{
+    constexpr quint32 changeSum = BLOCK_CHANGE_LEVEL * BLOCK_SIZE * BLOCK_SIZE;
+
+    int changed = 0;
+    for (int by = 0; by < BLOCKS_Y; ++by) {
+        const int rowOffset = by * BLOCK_SIZE * FRAME_WIDTH;
+        for (int bx = 0; bx < BLOCKS_X; bx += 2) {
+            quint32 left = 0;
+            quint32 right = 0;
+            const int offset = rowOffset + bx * BLOCK_SIZE;
+            blockPairSad(a + offset, b + offset, &left, &right);
+            changed += (left > changeSum) + (right > changeSum);
+        }
+    }
+    return static_cast<float>(changed) / (BLOCKS_X * BLOCKS_Y);
+}
+
+QString SceneDetector::simdBackend()
+{
+#if defined(EONPLAY_SCENE_SSE2)
+    return QStringLiteral("SSE2");
+#elif defined(EONPLAY_SCENE_NEON)
+    return QStringLiteral("NEON");
+#else
+    return QStringLiteral("Scalar");
+#endif
+}
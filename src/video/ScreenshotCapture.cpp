@@ -0,0 +1,315 @@
+#include "video/ScreenshotCapture.h"
+#include "video/VideoUpscaler.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QLoggingCategory>
+#include <QMetaObject>
+#include <QPainter>
+#include <QSaveFile>
+#include <QThread>
+#include <QTimer>
+#include <utility>
+
+Q_DECLARE_LOGGING_CATEGORY(screenshotCapture)
+Q_LOGGING_CATEGORY(screenshotCapture, "video.screenshot")
+
+namespace {
+constexpr int MAX_FRAMES = 1000;
+constexpr int MAX_SHEET_TILES = 400;
+}
+
+struct ScreenshotCapture::Capture {
+    int id = 0;
+    Request request;
+    bool sheet = false;
+    ContactSheet sheetOptions;
+
+    int count = 0;
+    int taken = 0;
+    int pending = 0;                // Frames being scaled or written
+    bool cancelled = false;
+    bool failed = false;
+    bool sheetQueued = false;
+    bool hasSequence = false;
+    quint64 lastSequence = 0;
+    QTimer* timer = nullptr;
+    QStringList paths;
+
+    QImage sheetImage;              // Owner's thread only
+    QSize tileSize;
+};
+
+ScreenshotCapture::ScreenshotCapture(QObject* parent)
+    : QObject(parent)
+    , m_heldFrames(0)
+    , m_nextId(0)
+{
+    // Encoding competes with playback for CPU, never for the GUI thread
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+}
+
+ScreenshotCapture::~ScreenshotCapture()
+{
+    // Workers post their results back to this object
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+int ScreenshotCapture::capture(const Request& request)
+{
+    auto capture = std::make_shared<Capture>();
+    capture->request = request;
+    capture->count = qBound(1, request.count, MAX_FRAMES);
+    return start(capture);
+}
+
+int ScreenshotCapture::captureContactSheet(const ContactSheet& sheet)
+{
+    if (sheet.columns <= 0 || sheet.rows <= 0 || sheet.columns * sheet.rows > MAX_SHEET_TILES || sheet.tileWidth <= 0) {
+        qCWarning(screenshotCapture) << "Invalid contact sheet layout" << sheet.columns << "x" << sheet.rows;
+        return 0;
+    }
+
+    auto capture = std::make_shared<Capture>();
+    capture->sheet = true;
+    capture->sheetOptions = sheet;
+    capture->request.outputPath = sheet.outputPath;
+    capture->request.format = sheet.format;
+    capture->request.quality = sheet.quality;
+    capture->request.intervalMs = sheet.intervalMs;
+    capture->count = sheet.columns * sheet.rows;
+    return start(capture);
+}
+
+void ScreenshotCapture::cancel(int captureId)
+{
+    const std::shared_ptr<Capture> capture = m_captures.value(captureId);
+    if (!capture) {
+        return;
+    }
+    capture->cancelled = true;
+    capture->timer->stop();
+    finishIfDone(capture);
+}
+
+bool ScreenshotCapture::writeImage(const QImage& image, const QString& path, const QByteArray& format, int quality)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(screenshotCapture) << "Cannot write" << path << file.errorString();
+        return false;
+    }
+
+    QImageWriter writer(&file, format.isEmpty() ? QFileInfo(path).suffix().toLatin1() : format);
+    writer.setQuality(quality);
+    if (!writer.write(image)) {
+        qCWarning(screenshotCapture) << "Cannot encode" << path << writer.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+QImage ScreenshotCapture::scaleImage(const QImage& image, const QSize& bound)
+{
+    if (!bound.isValid() || bound == image.size()) {
+        return image;
+    }
+
+    const QSize target = image.size().scaled(bound, Qt::KeepAspectRatio);
+    if (target.width() > image.width()) {
+        // Enlarging: Lanczos rather than Qt's bilinear filter; one thread, callers are pool workers
+        VideoUpscaler upscaler;
+        const QImage upscaled = upscaler.scale(image, target);
+        if (!upscaled.isNull()) {
+            return upscaled;
+        }
+    }
+    return image.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+
+int ScreenshotCapture::start(const std::shared_ptr<Capture>& capture)
+{
+    // Nothing to capture: fail now rather than wait for frames that may never come
+    if (!m_frameSource || !m_frameSource()) {
+        qCWarning(screenshotCapture) << "No video frame available for capture";
+        return 0;
+    }
+    if (capture->request.outputPath.isEmpty()) {
+        return 0;
+    }
+
+    capture->id = ++m_nextId;
+    capture->timer = new QTimer(this);
+    capture->timer->setInterval(capture->request.intervalMs > 0 ? capture->request.intervalMs : MIN_POLL_MS);
+    connect(capture->timer, &QTimer::timeout, this, [this, capture]() {
+        takeFrame(capture);
+    });
+    m_captures.insert(capture->id, capture);
+
+    const int id = capture->id;
+    takeFrame(capture);
+    if (capture->taken < capture->count) {
+        capture->timer->start();
+    }
+    return id;
+}
+
+void ScreenshotCapture::takeFrame(const std::shared_ptr<Capture>& capture)
+{
+    if (capture->cancelled || capture->taken >= capture->count) {
+        return;
+    }
+
+    // With no interval only new pictures count; with one, a paused picture is taken again
+    const VideoFrameRef frame = m_frameSource ? m_frameSource() : VideoFrameRef();
+    if (!frame || frame->width() <= 0 || frame->height() <= 0) {
+        return;
+    }
+    if (capture->request.intervalMs <= 0 && capture->hasSequence && frame->sequence() == capture->lastSequence) {
+        return;
+    }
+    capture->hasSequence = true;
+    capture->lastSequence = frame->sequence();
+
+    // Shared with the pool unless too many pooled buffers are already held
+    QImage image = videoFrameToImage(frame);
+    bool pooled = true;
+    if (m_heldFrames.fetch_add(1) >= MAX_HELD_FRAMES) {
+        m_heldFrames.fetch_sub(1);
+        image = image.copy();
+        pooled = false;
+    }
+
+    const int index = capture->taken++;
+    if (capture->taken >= capture->count) {
+        capture->timer->stop();
+    }
+    encodeFrame(capture, index, std::move(image), pooled);
+}
+
+void ScreenshotCapture::encodeFrame(const std::shared_ptr<Capture>& capture, int index, QImage image, bool pooled)
+{
+    ++capture->pending;
+
+    if (capture->sheet) {
+        if (capture->tileSize.isEmpty()) {
+            // The first frame fixes the layout
+            const ContactSheet& sheet = capture->sheetOptions;
+            capture->tileSize = QSize(sheet.tileWidth, qMax(1, qRound(sheet.tileWidth * double(image.height()) / image.width())));
+            capture->sheetImage = QImage(sheet.columns * capture->tileSize.width() + (sheet.columns + 1) * sheet.spacing,
+                                         sheet.rows * capture->tileSize.height() + (sheet.rows + 1) * sheet.spacing,
+                                         QImage::Format_RGB32);
+            capture->sheetImage.fill(sheet.background);
+        }
+
+        const QSize tileSize = capture->tileSize;
+        m_pool.start([this, capture, index, image = std::move(image), pooled, tileSize]() mutable {
+            QThread::currentThread()->setPriority(QThread::LowPriority);
+            const QImage tile = image.scaled(tileSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            image = QImage();
+            if (pooled) {
+                m_heldFrames.fetch_sub(1);
+            }
+            QMetaObject::invokeMethod(this, [this, capture, index, tile]() {
+                addTile(capture, index, tile);
+            }, Qt::QueuedConnection);
+        });
+        return;
+    }
+
+    const Request request = capture->request;
+    const QString path = framePath(request.outputPath, index, capture->count);
+    m_pool.start([this, capture, index, image = std::move(image), pooled, request, path]() mutable {
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+
+        // A scaled copy lets the pooled buffer go before the slow part, encoding
+        if (request.resolution.isValid() && request.resolution != image.size()) {
+            image = scaleImage(image, request.resolution);
+            if (pooled) {
+                m_heldFrames.fetch_sub(1);
+                pooled = false;
+            }
+        }
+        const bool success = writeImage(image, path, request.format, request.quality);
+        image = QImage();
+        if (pooled) {
+            m_heldFrames.fetch_sub(1);
+        }
+
+        QMetaObject::invokeMethod(this, [this, capture, index, success, path]() {
+            frameDone(capture, index, success, path);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void ScreenshotCapture::addTile(const std::shared_ptr<Capture>& capture, int index, const QImage& tile)
+{
+    const ContactSheet& sheet = capture->sheetOptions;
+    const int column = index % sheet.columns;
+    const int row = index / sheet.columns;
+    {
+        QPainter painter(&capture->sheetImage);
+        painter.drawImage(sheet.spacing + column * (capture->tileSize.width() + sheet.spacing),
+                          sheet.spacing + row * (capture->tileSize.height() + sheet.spacing), tile);
+    }
+
+    --capture->pending;
+    finishIfDone(capture);
+}
+
+void ScreenshotCapture::frameDone(const std::shared_ptr<Capture>& capture, int index, bool success, const QString& path)
+{
+    --capture->pending;
+    if (success) {
+        capture->paths << path;
+    } else {
+        capture->failed = true;
+    }
+    emit frameCaptured(capture->id, index, success, path);
+    finishIfDone(capture);
+}
+
+void ScreenshotCapture::finishIfDone(const std::shared_ptr<Capture>& capture)
+{
+    if (capture->pending > 0 || (!capture->cancelled && capture->taken < capture->count)) {
+        return;
+    }
+
+    // A cancelled sheet is written with the tiles it has
+    if (capture->sheet && !capture->sheetQueued && capture->taken > 0) {
+        capture->sheetQueued = true;
+        ++capture->pending;
+        const QImage sheetImage = std::exchange(capture->sheetImage, QImage());
+        const Request request = capture->request;
+        m_pool.start([this, capture, sheetImage, request]() {
+            QThread::currentThread()->setPriority(QThread::LowPriority);
+            const bool success = writeImage(sheetImage, request.outputPath, request.format, request.quality);
+            QMetaObject::invokeMethod(this, [this, capture, success, request]() {
+                frameDone(capture, 0, success, request.outputPath);
+            }, Qt::QueuedConnection);
+        });
+        return;
+    }
+
+    capture->timer->deleteLater();
+    capture->timer = nullptr;
+    m_captures.remove(capture->id);
+
+    const bool success = !capture->failed && !capture->paths.isEmpty();
+    qCDebug(screenshotCapture) << "Capture" << capture->id << (success ? "wrote" : "failed after")
+                               << capture->paths.size() << "files";
+    emit captureFinished(capture->id, success, capture->paths);
+}
+
+QString ScreenshotCapture::framePath(const QString& outputPath, int index, int count)
+{
+    if (count <= 1) {
+        return outputPath;
+    }
+    const QFileInfo info(outputPath);
+    const QString suffix = info.suffix().isEmpty() ? QString() : QLatin1Char('.') + info.suffix();
+    return info.dir().filePath(QString("%1_%2%3").arg(info.completeBaseName())
+                                   .arg(index + 1, 3, 10, QLatin1Char('0')).arg(suffix));
+}
@@ -0,0 +1,322 @@
+#include "video/ToneMapper.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtMath>
+#include <cmath>
+
+Q_DECLARE_LOGGING_CATEGORY(toneMapper)
+Q_LOGGING_CATEGORY(toneMapper, "video.tonemap")
+
+namespace {
+constexpr int MAX_CACHED_LUTS = 8;
+constexpr int PROBE_TIMEOUT_MS = 10000;
+
+// SMPTE ST 2084
+constexpr double PQ_M1 = 2610.0 / 16384.0;
+constexpr double PQ_M2 = 2523.0 / 4096.0 * 128.0;
+constexpr double PQ_C1 = 3424.0 / 4096.0;
+constexpr double PQ_C2 = 2413.0 / 4096.0 * 32.0;
+constexpr double PQ_C3 = 2392.0 / 4096.0 * 32.0;
+constexpr double PQ_PEAK = 10000.0;
+
+// ARIB STD-B67
+constexpr double HLG_A = 0.17883277;
+constexpr double HLG_B = 0.28466892;
+constexpr double HLG_C = 0.55991073;
+
+// Linear BT.2020 to BT.709 primaries
+constexpr double BT2020_TO_BT709[3][3] = {
+    { 1.6605, -0.5876, -0.0728},
+    {-0.1246,  1.1329, -0.0083},
+    {-0.0182, -0.1006,  1.1187}
+};
+
+struct LutCache {
+    QMutex mutex;
+    QHash<QByteArray, ToneMapper::LutRef> luts;
+    QList<QByteArray> order;        // Least recently used first
+};
+
+LutCache& lutCache()
+{
+    static LutCache cache;
+    return cache;
+}
+
+// Signal (0-1) to cd/m2
+double pqToNits(double signal)
+{
+    const double p = std::pow(qMax(signal, 0.0), 1.0 / PQ_M2);
+    return PQ_PEAK * std::pow(qMax(p - PQ_C1, 0.0) / (PQ_C2 - PQ_C3 * p), 1.0 / PQ_M1);
+}
+
+double nitsToPq(double nits)
+{
+    const double y = std::pow(qBound(0.0, nits / PQ_PEAK, 1.0), PQ_M1);
+    return std::pow((PQ_C1 + PQ_C2 * y) / (1.0 + PQ_C3 * y), PQ_M2);
+}
+
+double hlgToSceneLinear(double signal)
+{
+    signal = qMax(signal, 0.0);
+    return signal <= 0.5 ? signal * signal / 3.0 : (std::exp((signal - HLG_C) / HLG_A) + HLG_B) / 12.0;
+}
+
+// BT.2390 EETF from the source peak to the target peak, in cd/m2
+double bt2390(double nits, double sourcePeak, double targetPeak)
+{
+    const double sourceMax = nitsToPq(sourcePeak);
+    const double maxLuminance = nitsToPq(targetPeak) / sourceMax;
+    const double e1 = qMin(1.0, nitsToPq(nits) / sourceMax);
+    const double kneeStart = 1.5 * maxLuminance - 0.5;
+
+    double e2 = e1;
+    if (e1 > kneeStart && kneeStart < 1.0) {
+        const double t = (e1 - kneeStart) / (1.0 - kneeStart);
+        const double t2 = t * t;
+        const double t3 = t2 * t;
+        e2 = (2.0 * t3 - 3.0 * t2 + 1.0) * kneeStart + (t3 - 2.0 * t2 + t) * (1.0 - kneeStart)
+           + (-2.0 * t3 + 3.0 * t2) * maxLuminance;
+    }
+    return pqToNits(e2 * sourceMax);
+}
+
+double hableCurve(double x)
+{
+    constexpr double A = 0.15, B = 0.50, C = 0.10, D = 0.20, E = 0.02, F = 0.30;
+    return (x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F) - E / F;
+}
+
+// Relative to the target peak; exposure 2 keeps diffuse white near the SDR range
+double hable(double nits, double sourcePeak, double targetPeak)
+{
+    constexpr double EXPOSURE = 2.0;
+    const double white = EXPOSURE * sourcePeak / targetPeak;
+    return targetPeak * hableCurve(EXPOSURE * nits / targetPeak) / hableCurve(white);
+}
+}
+
+float ToneMapper::Metadata::sourcePeak() const
+{
+    const float peak = masteringPeak > 0.0f ? masteringPeak : 1000.0f;
+    return maxContentLight > 0.0f ? qMin(peak, maxContentLight) : peak;
+}
+
+bool ToneMapper::Metadata::operator==(const Metadata& other) const
+{
+    return transfer == other.transfer && bt2020 == other.bt2020
+        && qRound(masteringPeak) == qRound(other.masteringPeak)
+        && qRound(maxContentLight) == qRound(other.maxContentLight);
+}
+
+ToneMapper::LutRef ToneMapper::lut(const Metadata& metadata, Curve curve)
+{
+    if (!metadata.isHdr()) {
+        return nullptr;
+    }
+
+    const QByteArray key = cacheKey(metadata, curve);
+    LutCache& cache = lutCache();
+    {
+        QMutexLocker locker(&cache.mutex);
+        auto it = cache.luts.constFind(key);
+        if (it != cache.luts.constEnd()) {
+            cache.order.removeOne(key);
+            cache.order.append(key);
+            return it.value();
+        }
+    }
+
+    // Baked outside the lock; a concurrent first use may bake twice, keeping one
+    LutRef table = bake(metadata, curve);
+
+    QMutexLocker locker(&cache.mutex);
+    auto it = cache.luts.constFind(key);
+    if (it != cache.luts.constEnd()) {
+        return it.value();
+    }
+    while (cache.order.size() >= MAX_CACHED_LUTS) {
+        cache.luts.remove(cache.order.takeFirst());
+    }
+    cache.luts.insert(key, table);
+    cache.order.append(key);
+    return table;
+}
+
+QString ToneMapper::cubeFile(const Metadata& metadata, Curve curve)
+{
+    const LutRef table = lut(metadata, curve);
+    if (!table) {
+        return QString();
+    }
+
+    const QDir directory(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("tonemap"));
+    const QString path = directory.filePath(QString::fromLatin1(cacheKey(metadata, curve)) + ".cube");
+    if (QFileInfo::exists(path)) {
+        return path;
+    }
+
+    if (!directory.mkpath(".")) {
+        return QString();
+    }
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCWarning(toneMapper) << "Cannot write tone mapping LUT:" << file.errorString();
+        return QString();
+    }
+
+    QByteArray text = QByteArray("TITLE \"EonPlay tone mapping\"\nLUT_3D_SIZE ") + QByteArray::number(table->size) + '\n';
+    for (int i = 0; i < table->data.size(); i += 3) {
+        text += QByteArray::number(table->data[i], 'f', 6) + ' '
+              + QByteArray::number(table->data[i + 1], 'f', 6) + ' '
+              + QByteArray::number(table->data[i + 2], 'f', 6) + '\n';
+    }
+    file.write(text);
+    return file.commit() ? path : QString();
+}
+
+ToneMapper::Metadata ToneMapper::probe(const QString& ffprobePath, const QString& input)
+{
+    Metadata metadata;
+    if (ffprobePath.isEmpty()) {
+        return metadata;
+    }
+
+    QProcess process;
+    process.start(ffprobePath, {"-v", "error", "-select_streams", "v:0",
+                                "-show_entries", "stream=color_transfer,color_primaries:stream_side_data=max_luminance,max_content",
+                                "-of", "default=noprint_wrappers=1", input});
+    if (!process.waitForFinished(PROBE_TIMEOUT_MS) || process.exitCode() != 0) {
+        return metadata;
+    }
+
+    // Luminances come as rationals, e.g. max_luminance=10000000/10000
+    auto number = [](const QByteArray& value) {
+        const QList<QByteArray> parts = value.split('/');
+        const double denominator = parts.size() == 2 ? parts[1].toDouble() : 1.0;
+        return denominator > 0.0 ? static_cast<float>(parts[0].toDouble() / denominator) : 0.0f;
+    };
+
+    const QList<QByteArray> lines = process.readAllStandardOutput().split('\n');
+    for (const QByteArray& line : lines) {
+        const int equals = line.indexOf('=');
+        if (equals < 0) {
+            continue;
+        }
+        const QByteArray name = line.left(equals).trimmed();
+        const QByteArray value = line.mid(equals + 1).trimmed();
+        if (name == "color_transfer") {
+            metadata.transfer = value == "smpte2084" ? PQ : value == "arib-std-b67" ? HLG : SDR;
+        } else if (name == "color_primaries") {
+            metadata.bt2020 = value == "bt2020";
+        } else if (name == "max_luminance" && number(value) > 0.0f) {
+            metadata.masteringPeak = number(value);
+        } else if (name == "max_content" && number(value) > 0.0f) {
+            metadata.maxContentLight = number(value);
+        }
+    }
+    return metadata;
+}
+
+void ToneMapper::mapColor(const Metadata& metadata, Curve curve, const float in[3], float out[3])
+{
+    if (!metadata.isHdr()) {
+        out[0] = in[0];
+        out[1] = in[1];
+        out[2] = in[2];
+        return;
+    }
+
+    // Signal to display light in cd/m2
+    const double sourcePeak = metadata.sourcePeak();
+    double light[3];
+    if (metadata.transfer == PQ) {
+        for (int channel = 0; channel < 3; ++channel) {
+            light[channel] = pqToNits(in[channel]);
+        }
+    } else {
+        // HLG: scene light through the reference OOTF for the mastering peak
+        const double peak = metadata.masteringPeak > 0.0f ? metadata.masteringPeak : 1000.0;
+        const double systemGamma = 1.2 + 0.42 * std::log10(peak / 1000.0);
+        double scene[3];
+        for (int channel = 0; channel < 3; ++channel) {
+            scene[channel] = hlgToSceneLinear(in[channel]);
+        }
+        const double luminance = 0.2627 * scene[0] + 0.6780 * scene[1] + 0.0593 * scene[2];
+        const double gain = peak * std::pow(qMax(luminance, 1e-6), systemGamma - 1.0);
+        for (int channel = 0; channel < 3; ++channel) {
+            light[channel] = gain * scene[channel];
+        }
+    }
+
+    if (metadata.bt2020) {
+        const double r = light[0];
+        const double g = light[1];
+        const double b = light[2];
+        for (int channel = 0; channel < 3; ++channel) {
+            light[channel] = qMax(0.0, BT2020_TO_BT709[channel][0] * r + BT2020_TO_BT709[channel][1] * g
+                                       + BT2020_TO_BT709[channel][2] * b);
+        }
+    }
+
+    // The curve runs on the brightest channel and scales all three, keeping hue
+    const double brightest = qMax(light[0], qMax(light[1], light[2]));
+    if (brightest > 0.0) {
+        const double mapped = curve == Hable ? hable(brightest, sourcePeak, SDR_WHITE)
+                                             : bt2390(brightest, sourcePeak, SDR_WHITE);
+        const double scale = mapped / brightest;
+        for (int channel = 0; channel < 3; ++channel) {
+            light[channel] *= scale;
+        }
+    }
+
+    // BT.1886 encoding with SDR_WHITE as 1.0
+    for (int channel = 0; channel < 3; ++channel) {
+        out[channel] = static_cast<float>(std::pow(qBound(0.0, light[channel] / SDR_WHITE, 1.0), 1.0 / 2.4));
+    }
+}
+
+QByteArray ToneMapper::cacheKey(const Metadata& metadata, Curve curve)
+{
+    return QString("%1-%2-%3-%4-%5-%6")
+        .arg(metadata.transfer == PQ ? "pq" : "hlg")
+        .arg(metadata.bt2020 ? "bt2020" : "bt709")
+        .arg(qRound(metadata.masteringPeak))
+        .arg(qRound(metadata.maxContentLight))
+        .arg(curve == Hable ? "hable" : "bt2390")
+        .arg(LUT_SIZE)
+        .toLatin1();
+}
+
+ToneMapper::LutRef ToneMapper::bake(const Metadata& metadata, Curve curve)
+{
+    auto table = std::make_shared<Lut>();
+    table->size = LUT_SIZE;
+    table->data.resize(LUT_SIZE * LUT_SIZE * LUT_SIZE * 3);
+
+    float* out = table->data.data();
+    for (int blue = 0; blue < LUT_SIZE; ++blue) {
+        for (int green = 0; green < LUT_SIZE; ++green) {
+            for (int red = 0; red < LUT_SIZE; ++red) {
+                const float in[3] = {
+                    static_cast<float>(red) / (LUT_SIZE - 1),
+                    static_cast<float>(green) / (LUT_SIZE - 1),
+                    static_cast<float>(blue) / (LUT_SIZE - 1)
+                };
+                mapColor(metadata, curve, in, out);
+                out += 3;
+            }
+        }
+    }
+
+    qCDebug(toneMapper) << "Baked tone mapping LUT" << cacheKey(metadata, curve);
+    return table;
+}
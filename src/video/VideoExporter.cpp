@@ -1,4 +1,11 @@
 #include "video/VideoExporter.h"
+#include "video/GifEncoder.h"
+#include "video/VideoUpscaler.h"
+#include "video/ToneMapper.h"
+#ifdef HAVE_ONNXRUNTIME
+#include "video/OnnxSuperResolution.h"
+#endif
+#include "media/IMediaEngine.h"
 #include <QLoggingCategory>
 #include <QMutexLocker>
 #include <QFileInfo>
@@ -7,17 +14,293 @@
 #include <QDateTime>
 #include <QImageWriter>
 #include <QImageReader>
+#include <QFile>
+#include <QPointer>
+#include <QProcess>
+#include <QSaveFile>
+#include <QThread>
+#include <QUrl>
 #include <QtMath>
 #include <algorithm>
+#include <cctype>
+#include <functional>
 
 Q_DECLARE_LOGGING_CATEGORY(videoExporter)
 Q_LOGGING_CATEGORY(videoExporter, "video.exporter")
 
+namespace {
+// How often a job looks at FFmpeg's output and at its cancel flag
+constexpr int FFMPEG_POLL_MS = 100;
+constexpr int FFMPEG_START_TIMEOUT_MS = 10000;
+
+// Upscaled bytes queued for the encoder before the upscaler waits for it
+constexpr qint64 ENCODER_BACKLOG_BYTES = 8 * 1024 * 1024;
+
+QString ffmpegInput(const QString& path)
+{
+    const QUrl url(path);
+    return url.isLocalFile() ? url.toLocalFile() : path;
+}
+
+QString ffmpegSeconds(qint64 ms)
+{
+    return QString::number(ms / 1000.0, 'f', 3);
+}
+
+QString defaultOutputPath(QStandardPaths::StandardLocation location, const QString& extension)
+{
+    QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss");
+    return QDir(QStandardPaths::writableLocation(location))
+        .absoluteFilePath(QString("EonPlay_%1.%2").arg(timestamp, extension));
+}
+
+/**
+ * Run FFmpeg to completion on the calling (worker) thread. Progress comes
+ * from -progress on stdout against durationMs; stderr lines go to the
+ * handler. The process is killed when the job is cancelled.
+ */
+bool runFFmpeg(const QString& ffmpegPath, const QStringList& arguments, qint64 durationMs,
+               ExportJobQueue::Context& context,
+               const std::function<void(const QByteArray& line)>& stderrLine = {})
+{
+    QProcess process;
+    process.start(ffmpegPath, QStringList{"-hide_banner", "-nostats", "-progress", "pipe:1"} + arguments);
+    if (!process.waitForStarted(FFMPEG_START_TIMEOUT_MS)) {
+        qCWarning(videoExporter) << "Failed to start FFmpeg:" << process.errorString();
+        return false;
+    }
+
+    QByteArray progressBuffer;
+    QByteArray logBuffer;
+    QByteArray lastError;
+    auto drain = [&]() {
+        progressBuffer += process.readAllStandardOutput();
+        int newline;
+        while ((newline = progressBuffer.indexOf('\n')) != -1) {
+            const QByteArray line = progressBuffer.left(newline).trimmed();
+            progressBuffer.remove(0, newline + 1);
+            // out_time_ms is in microseconds as well, despite its name
+            if (durationMs > 0 && (line.startsWith("out_time_us=") || line.startsWith("out_time_ms="))) {
+                const qint64 timeUs = line.mid(line.indexOf('=') + 1).toLongLong();
+                context.setProgress(int(qMin<qint64>(99, timeUs / 10 / durationMs)));
+            }
+        }
+
+        logBuffer += process.readAllStandardError();
+        while ((newline = logBuffer.indexOf('\n')) != -1) {
+            const QByteArray line = logBuffer.left(newline).trimmed();
+            logBuffer.remove(0, newline + 1);
+            if (!line.isEmpty()) {
+                lastError = line;
+                if (stderrLine) {
+                    stderrLine(line);
+                }
+            }
+        }
+    };
+
+    while (process.state() != QProcess::NotRunning) {
+        if (context.isCancelled()) {
+            process.kill();
+            process.waitForFinished();
+            return false;
+        }
+        process.waitForFinished(FFMPEG_POLL_MS);
+        drain();
+    }
+    drain();
+
+    const bool success = process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+    if (!success && !context.isCancelled()) {
+        qCWarning(videoExporter) << "FFmpeg failed:" << lastError;
+    }
+    return success;
+}
+
+/**
+ * Run FFmpeg with its video output as RGB frames on stdout and hand each
+ * frame to the handler, on the calling (worker) thread. A handler
+ * returning false stops the run, as does cancelling the job.
+ */
+bool readFFmpegFrames(const QString& ffmpegPath, const QStringList& arguments,
+                      ExportJobQueue::Context& context,
+                      const std::function<bool(const uchar* rgb, const QSize& size)>& onFrame)
+{
+    // PPM frames carry their own size, so scaling need not be known in advance
+    QProcess process;
+    process.start(ffmpegPath, QStringList{"-hide_banner", "-nostats", "-loglevel", "error"} + arguments
+                  + QStringList{"-an", "-sn", "-dn", "-f", "image2pipe", "-c:v", "ppm", "-pix_fmt", "rgb24", "pipe:1"});
+    if (!process.waitForStarted(FFMPEG_START_TIMEOUT_MS)) {
+        qCWarning(videoExporter) << "Failed to start FFmpeg:" << process.errorString();
+        return false;
+    }
+
+    QByteArray buffer;
+    bool accepted = true;
+    auto consume = [&]() {
+        buffer += process.readAllStandardOutput();
+        int offset = 0;
+        while (accepted) {
+            // "P6 <width> <height> <maxval>" and a single whitespace before the pixels
+            int fields[3] = {0, 0, 0};
+            int position = offset + 2;
+            bool complete = buffer.size() - offset >= 2;
+            for (int field = 0; field < 3 && complete; ++field) {
+                while (position < buffer.size() && std::isspace(static_cast<uchar>(buffer[position]))) {
+                    ++position;
+                }
+                while (position < buffer.size() && std::isdigit(static_cast<uchar>(buffer[position]))) {
+                    fields[field] = fields[field] * 10 + (buffer[position] - '0');
+                    ++position;
+                }
+                complete = position < buffer.size();
+            }
+            const QSize size(fields[0], fields[1]);
+            const qint64 frameBytes = qint64(size.width()) * size.height() * 3;
+            if (!complete || buffer.size() - (position + 1) < frameBytes) {
+                break;
+            }
+            if (!buffer.mid(offset, 2).startsWith("P6") || fields[2] != 255 || size.isEmpty()) {
+                qCWarning(videoExporter) << "Unexpected frame data from FFmpeg";
+                accepted = false;
+                break;
+            }
+            accepted = onFrame(reinterpret_cast<const uchar*>(buffer.constData() + position + 1), size);
+            offset = position + 1 + static_cast<int>(frameBytes);
+        }
+        buffer.remove(0, offset);
+    };
+
+    while (process.state() != QProcess::NotRunning) {
+        if (context.isCancelled() || !accepted) {
+            process.kill();
+            process.waitForFinished();
+            return false;
+        }
+        process.waitForReadyRead(FFMPEG_POLL_MS);
+        consume();
+    }
+    consume();
+
+    if (!accepted || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        if (accepted && !context.isCancelled()) {
+            qCWarning(videoExporter) << "FFmpeg failed:" << process.readAllStandardError().trimmed();
+        }
+        return false;
+    }
+    return true;
+}
+
+// ffprobe ships next to FFmpeg; empty if it is nowhere to be found
+QString ffprobePath(const QString& ffmpegPath)
+{
+    const QFileInfo ffmpeg(ffmpegPath);
+    const QString path = ffmpeg.dir().filePath(ffmpeg.fileName().replace("ffmpeg", "ffprobe"));
+    return QFileInfo::exists(path) ? path : QStandardPaths::findExecutable("ffprobe");
+}
+
+/**
+ * Get size and frame rate (as FFmpeg writes it, e.g. 30000/1001) of the
+ * first video stream through ffprobe.
+ */
+bool probeVideo(const QString& ffmpegPath, const QString& input, QSize* size, QString* frameRate)
+{
+    const QString ffprobe = ffprobePath(ffmpegPath);
+    if (ffprobe.isEmpty()) {
+        return false;
+    }
+
+    QProcess process;
+    process.start(ffprobe, {"-v", "error", "-select_streams", "v:0",
+                            "-show_entries", "stream=width,height,r_frame_rate", "-of", "csv=p=0", input});
+    if (!process.waitForFinished(FFMPEG_START_TIMEOUT_MS) || process.exitCode() != 0) {
+        return false;
+    }
+
+    const QList<QByteArray> fields = process.readAllStandardOutput().trimmed().split(',');
+    if (fields.size() < 3) {
+        return false;
+    }
+    *size = QSize(fields[0].toInt(), fields[1].toInt());
+    *frameRate = QString::fromLatin1(fields[2]);
+    return !size->isEmpty() && !frameRate->isEmpty() && !frameRate->startsWith('0');
+}
+
+/**
+ * Get the filters taking an HDR source to SDR BT.709 through the source's
+ * cached tone mapping LUT, or an empty string for SDR sources. The LUT
+ * works on full-range R'G'B', so the signal is converted with the
+ * BT.2020 matrix first; the output is RGB.
+ */
+QString toneMappingFilter(const QString& ffmpegPath, const QString& input)
+{
+    const ToneMapper::Metadata metadata = ToneMapper::probe(ffprobePath(ffmpegPath), input);
+    if (!metadata.isHdr()) {
+        return QString();
+    }
+    const QString cube = ToneMapper::cubeFile(metadata);
+    if (cube.isEmpty()) {
+        qCWarning(videoExporter) << "Cannot write tone mapping LUT, exporting HDR signal as is";
+        return QString();
+    }
+
+    // Quotes cover the graph level only; the filter's own option parser still splits on colons
+    QString escaped = QDir::fromNativeSeparators(cube);
+    escaped.replace(':', "\\:");
+    return QString("scale=in_color_matrix=%1:in_range=auto,format=gbrp16le,"
+                   "lut3d=file='%2':interp=tetrahedral")
+        .arg(metadata.bt2020 ? "bt2020" : "bt709", escaped);
+}
+
+struct UpscalingModel {
+    const char* file;
+    int scale;
+};
+
+UpscalingModel upscalingModel(VideoExporter::UpscalingMethod method)
+{
+    switch (method) {
+        case VideoExporter::ESRGAN: return {"models/esrgan-x4.onnx", 4};
+        case VideoExporter::RealESRGAN: return {"models/realesrgan-x4.onnx", 4};
+        case VideoExporter::EDSR: return {"models/edsr-x2.onnx", 2};
+        case VideoExporter::SRCNN: return {"models/srcnn-x2.onnx", 2};
+        default: return {nullptr, 0};
+    }
+}
+
+std::shared_ptr<SuperResolutionModel> loadUpscalingModel(VideoExporter::UpscalingMethod method, int threads)
+{
+#ifdef HAVE_ONNXRUNTIME
+    const UpscalingModel model = upscalingModel(method);
+    const QString path = model.file ? QStandardPaths::locate(QStandardPaths::AppDataLocation, model.file) : QString();
+    if (!path.isEmpty()) {
+        return OnnxSuperResolution::load(path, model.scale, threads);
+    }
+#else
+    Q_UNUSED(method);
+    Q_UNUSED(threads);
+#endif
+    return nullptr;
+}
+
+VideoUpscaler::Kernel upscalingKernel(VideoExporter::UpscalingMethod method)
+{
+    switch (method) {
+        case VideoExporter::Bilinear: return VideoUpscaler::Bilinear;
+        case VideoExporter::Bicubic: return VideoUpscaler::Bicubic;
+        default: return VideoUpscaler::Lanczos;    // Also takes model output to the exact size
+    }
+}
+}
+
 VideoExporter::VideoExporter(QObject* parent)
     : QObject(parent)
-    , m_exporting(false)
+    , m_mediaEngine(nullptr)
+    , m_jobQueue(new ExportJobQueue(this))
+    , m_screenshotCapture(new ScreenshotCapture(this))
     , m_exportProgress(0)
     , m_progressTimer(new QTimer(this))
+    , m_sceneDetectionJob(0)
     , m_aiModelsLoaded(false)
 {
     // Initialize supported formats
@@ -28,6 +311,30 @@ VideoExporter::VideoExporter(QObject* parent)
     m_progressTimer->setInterval(100); // Update every 100ms
     connect(m_progressTimer, &QTimer::timeout, this, &VideoExporter::updateExportProgress);
     
+    connect(m_jobQueue, &ExportJobQueue::jobProgress, this, [this](int jobId, int progress) {
+        auto it = m_jobs.find(jobId);
+        if (it != m_jobs.end()) {
+            it->progress = progress;
+            emit exportJobProgress(jobId, progress);
+        }
+    });
+    connect(m_jobQueue, &ExportJobQueue::jobFinished, this, &VideoExporter::onExportJobFinished);
+    
+    // Screenshots of playback share the engine's latest pooled frame
+    m_screenshotCapture->setFrameSource([this]() {
+        return m_mediaEngine ? m_mediaEngine->latestVideoFrame() : VideoFrameRef();
+    });
+    connect(m_screenshotCapture, &ScreenshotCapture::captureFinished, this,
+            [this](int captureId, bool success, const QStringList&) {
+        const QString filePath = m_screenshotCaptures.take(captureId);
+        if (!filePath.isEmpty()) {
+            qCDebug(videoExporter) << "Screenshot" << (success ? "saved to" : "failed for") << filePath;
+            emit screenshotCaptured(success, filePath);
+        }
+    });
+    
+    m_source.ffmpegPath = QStandardPaths::findExecutable("ffmpeg");
+    
     qCDebug(videoExporter) << "VideoExporter created";
 }
 
@@ -48,62 +355,60 @@ bool VideoExporter::initialize()
 
 void VideoExporter::shutdown()
 {
+    // Running jobs kill their FFmpeg process within one poll interval
     cancelExport();
+    m_jobQueue->shutdown();
     qCDebug(videoExporter) << "VideoExporter shutdown";
 }
 
+void VideoExporter::setMediaEngine(IMediaEngine* engine)
+{
+    m_mediaEngine = engine;
+}
+
+void VideoExporter::setSourceMedia(const QString& path, qint64 duration)
+{
+    m_source.path = path;
+    m_source.duration = duration;
+}
+
 bool VideoExporter::captureScreenshot(const ScreenshotOptions& options)
 {
-    if (m_exporting) {
-        qCWarning(videoExporter) << "Export already in progress";
-        return false;
-    }
-    
     return captureCurrentFrame(options);
 }
 
 bool VideoExporter::captureScreenshotAtTime(qint64 timeMs, const ScreenshotOptions& options)
 {
-    if (m_exporting) {
-        qCWarning(videoExporter) << "Export already in progress";
-        return false;
-    }
-    
     return captureFrameAtTime(timeMs, options);
 }
 
 bool VideoExporter::exportGIF(const GIFOptions& options)
 {
-    if (m_exporting) {
-        qCWarning(videoExporter) << "Export already in progress";
+    if (m_source.path.isEmpty() || m_source.ffmpegPath.isEmpty()) {
+        qCWarning(videoExporter) << "Cannot export GIF: no source media or FFmpeg not found";
         return false;
     }
     
-    QMutexLocker locker(&m_exportMutex);
-    m_exporting = true;
-    m_exportProgress = 0;
-    m_progressTimer->start();
+    GIFOptions jobOptions = options;
+    jobOptions.duration = qBound<qint64>(1, options.duration, MAX_GIF_DURATION);
+    jobOptions.frameRate = options.frameRate > 0 ? options.frameRate : DEFAULT_GIF_FRAMERATE;
+    jobOptions.colorCount = qBound(2, options.colorCount, 256);
+    if (jobOptions.outputPath.isEmpty()) {
+        jobOptions.outputPath = defaultOutputPath(QStandardPaths::PicturesLocation, getFormatExtension(GIF));
+    }
     
-    // Start GIF creation in background
-    QTimer::singleShot(0, this, [this, options]() {
-        bool success = createGIFAnimation(options);
-        
-        QMutexLocker locker(&m_exportMutex);
-        m_exporting = false;
-        m_exportProgress = success ? 100 : 0;
-        m_progressTimer->stop();
-        
-        emit gifExported(success, options.outputPath);
-        qCDebug(videoExporter) << "GIF export completed:" << success;
-    });
+    const ExportSource source = m_source;
+    queueJob(JobKind::GIFExport, jobOptions.outputPath, [jobOptions, source](ExportJobQueue::Context& context) {
+        return createGIFAnimation(jobOptions, source, context);
+    }, options.priority, GIF_CPU_COST);
     
     return true;
 }
 
 bool VideoExporter::exportVideo(const VideoExportOptions& options)
 {
-    if (m_exporting) {
-        qCWarning(videoExporter) << "Export already in progress";
+    if (m_source.path.isEmpty() || m_source.ffmpegPath.isEmpty()) {
+        qCWarning(videoExporter) << "Cannot export video: no source media or FFmpeg not found";
         return false;
     }
     
@@ -112,23 +417,17 @@ bool VideoExporter::exportVideo(const VideoExportOptions& options)
         return false;
     }
     
-    QMutexLocker locker(&m_exportMutex);
-    m_exporting = true;
-    m_exportProgress = 0;
-    m_progressTimer->start();
+    VideoExportOptions jobOptions = options;
+    if (jobOptions.outputPath.isEmpty()) {
+        jobOptions.outputPath = defaultOutputPath(QStandardPaths::MoviesLocation, getFormatExtension(options.format));
+    }
     
-    // Start video export in background
-    QTimer::singleShot(0, this, [this, options]() {
-        bool success = processVideoExport(options);
-        
-        QMutexLocker locker(&m_exportMutex);
-        m_exporting = false;
-        m_exportProgress = success ? 100 : 0;
-        m_progressTimer->stop();
-        
-        emit videoExported(success, options.outputPath);
-        qCDebug(videoExporter) << "Video export completed:" << success;
-    });
+    // Encoders scale with threads; two exports can still share the budget
+    const int cpuCost = qMax(2, m_jobQueue->cpuBudget() / 2);
+    const ExportSource source = m_source;
+    queueJob(JobKind::VideoExport, jobOptions.outputPath, [jobOptions, source](ExportJobQueue::Context& context) {
+        return processVideoExport(jobOptions, source, context);
+    }, options.priority, cpuCost);
     
     return true;
 }
@@ -153,25 +452,53 @@ QVector<VideoExporter::UpscalingMethod> VideoExporter::getAvailableUpscalingMeth
     return m_availableUpscalingMethods;
 }
 
-bool VideoExporter::detectScenes(float threshold)
+bool VideoExporter::detectScenes(float threshold, bool keyframesOnly)
 {
-    if (m_exporting) {
-        qCWarning(videoExporter) << "Export in progress, cannot detect scenes";
+    if (m_source.path.isEmpty() || m_source.ffmpegPath.isEmpty()) {
+        qCWarning(videoExporter) << "Cannot detect scenes: no source media or FFmpeg not found";
         return false;
     }
     
-    // Start scene detection in background
-    QTimer::singleShot(0, this, [this, threshold]() {
-        bool success = analyzeVideoForScenes(threshold);
-        if (success) {
-            emit scenesDetected(m_detectedScenes);
-        }
-        qCDebug(videoExporter) << "Scene detection completed:" << success;
-    });
+    SceneDetector::Options options;
+    options.threshold = qBound(0.0f, threshold, 1.0f);
+    options.keyframesOnly = keyframesOnly;
+    
+    {
+        QMutexLocker locker(&m_exportMutex);
+        m_detectedScenes.clear();
+    }
+    
+    // Scenes are posted back one by one, in order, ahead of the job's completion
+    QPointer<VideoExporter> exporter = this;
+    const ExportSource source = m_source;
+    m_sceneDetectionJob = queueJob(JobKind::SceneDetection, QString(),
+                                   [options, source, exporter](ExportJobQueue::Context& context) {
+        const int id = context.id();
+        return analyzeVideoForScenes(options, source, context, [exporter, id](const SceneInfo& scene) {
+            QMetaObject::invokeMethod(exporter, [exporter, id, scene]() {
+                if (exporter) {
+                    exporter->addDetectedScene(id, scene);
+                }
+            }, Qt::QueuedConnection);
+        });
+    }, ExportJobQueue::Background, SCENE_DETECTION_CPU_COST);
     
     return true;
 }
 
+void VideoExporter::addDetectedScene(int jobId, const SceneInfo& scene)
+{
+    if (jobId != m_sceneDetectionJob) {
+        return;
+    }
+    
+    {
+        QMutexLocker locker(&m_exportMutex);
+        m_detectedScenes.append(scene);
+    }
+    emit scenesDetected({scene});
+}
+
 QVector<VideoExporter::SceneInfo> VideoExporter::getDetectedScenes() const
 {
     QMutexLocker locker(&m_exportMutex);
@@ -200,18 +527,650 @@ int VideoExporter::getExportProgress() const
 
 void VideoExporter::cancelExport()
 {
-    QMutexLocker locker(&m_exportMutex);
-    if (m_exporting) {
-        m_exporting = false;
-        m_progressTimer->stop();
-        qCDebug(videoExporter) << "Export cancelled";
+    if (!m_jobQueue->isIdle()) {
+        m_jobQueue->cancelAll();
+        qCDebug(videoExporter) << "Exports cancelled";
+    }
+}
+
+void VideoExporter::cancelExport(int jobId)
+{
+    if (m_jobQueue->cancel(jobId)) {
+        qCDebug(videoExporter) << "Export" << jobId << "cancelled";
     }
 }
 
 bool VideoExporter::isExporting() const
 {
-    QMutexLocker locker(&m_exportMutex);
-    return m_exporting;
+    return !m_jobs.isEmpty();
+}
+
+int VideoExporter::queueJob(JobKind kind, const QString& outputPath, const ExportJobQueue::Work& work,
+                            ExportJobQueue::Priority priority, int cpuCost)
+{
+    const QString name = kind == JobKind::GIFExport ? QStringLiteral("GIF export")
+                       : kind == JobKind::VideoExport ? QStringLiteral("Video export")
+                       : kind == JobKind::Screenshot ? QStringLiteral("Screenshot")
+                       : QStringLiteral("Scene detection");
+    const int jobId = m_jobQueue->submit(name, work, priority, cpuCost);
+    m_jobs.insert(jobId, ExportJob{kind, outputPath, 0});
+    
+    if (!m_progressTimer->isActive()) {
+        m_progressTimer->start();
+    }
+    
+    emit exportQueued(jobId, outputPath);
+    return jobId;
+}
+
+void VideoExporter::updateExportProgress()
+{
+    // Queued jobs count as not started
+    int progress = 100;
+    if (!m_jobs.isEmpty()) {
+        int total = 0;
+        for (const ExportJob& job : std::as_const(m_jobs)) {
+            total += job.progress;
+        }
+        progress = total / int(m_jobs.size());
+    }
+    
+    {
+        QMutexLocker locker(&m_exportMutex);
+        if (m_exportProgress == progress) {
+            return;
+        }
+        m_exportProgress = progress;
+    }
+    emit exportProgressUpdated(progress);
+}
+
+void VideoExporter::onExportJobFinished(int jobId, bool success, bool cancelled)
+{
+    auto it = m_jobs.find(jobId);
+    if (it == m_jobs.end()) {
+        return;
+    }
+    const ExportJob job = it.value();
+    m_jobs.erase(it);
+    
+    if (m_jobs.isEmpty()) {
+        m_progressTimer->stop();
+        updateExportProgress();
+    }
+    
+    switch (job.kind) {
+        case JobKind::GIFExport:
+            emit gifExported(success, job.outputPath);
+            break;
+        case JobKind::VideoExport:
+            emit videoExported(success, job.outputPath);
+            break;
+        case JobKind::SceneDetection:
+            if (jobId == m_sceneDetectionJob) {
+                emit sceneDetectionFinished(success);
+            }
+            break;
+        case JobKind::Screenshot:
+            emit screenshotCaptured(success, job.outputPath);
+            break;
+    }
+    
+    qCDebug(videoExporter) << "Export job" << jobId << (cancelled ? "cancelled" : success ? "completed" : "failed");
+}
+
+bool VideoExporter::createGIFAnimation(const GIFOptions& options, const ExportSource& source,
+                                       ExportJobQueue::Context& context)
+{
+    GifEncoder::Options encoderOptions;
+    encoderOptions.colorCount = options.colorCount;
+    encoderOptions.frameDifferencing = options.frameDifferencing;
+    encoderOptions.loop = options.loop;
+    encoderOptions.threads = context.threads();
+    switch (options.quality) {
+        case Low:
+            encoderOptions.dither = GifEncoder::NoDither;
+            encoderOptions.differenceTolerance = 12;
+            break;
+        case Medium:
+            encoderOptions.dither = GifEncoder::OrderedDither;
+            encoderOptions.differenceTolerance = 6;
+            break;
+        case High:
+            encoderOptions.dither = GifEncoder::FloydSteinberg;
+            encoderOptions.differenceTolerance = 3;
+            break;
+        case Lossless:
+            encoderOptions.dither = GifEncoder::FloydSteinberg;
+            encoderOptions.differenceTolerance = 0;
+            break;
+    }
+    GifEncoder encoder(encoderOptions);
+    
+    const QStringList input{
+        "-ss", ffmpegSeconds(options.startTime),
+        "-t", ffmpegSeconds(options.duration),
+        "-i", ffmpegInput(source.path)
+    };
+    const int progressStart = options.perFramePalette ? 0 : 10;
+    const QString toneMapping = toneMappingFilter(source.ffmpegPath, ffmpegInput(source.path));
+    const QString toneMappingPrefix = toneMapping.isEmpty() ? QString() : toneMapping + ',';
+    
+    if (!options.perFramePalette) {
+        // A few small frames are enough for the colors of the whole clip
+        GifEncoder::Histogram histogram;
+        const double sampleRate = qMin<double>(GIF_PALETTE_SAMPLE_RATE, options.frameRate);
+        const QStringList sampleArguments = input + QStringList{
+            "-vf", toneMappingPrefix + QString("fps=%1,scale=%2:-2:flags=area").arg(sampleRate).arg(GIF_PALETTE_SAMPLE_WIDTH)
+        };
+        int sampled = 0;
+        const int expected = qMax(1, qCeil(options.duration * sampleRate / 1000.0));
+        const bool sampledOk = readFFmpegFrames(source.ffmpegPath, sampleArguments, context,
+                                                [&](const uchar* rgb, const QSize& size) {
+            histogram.add(rgb, size.width() * size.height());
+            context.setProgress(qMin(progressStart, ++sampled * progressStart / expected));
+            return true;
+        });
+        if (!sampledOk) {
+            return false;
+        }
+        encoder.setGlobalPalette(histogram.medianCut(encoder.paletteColors()));
+    }
+    
+    QStringList filters{QString("fps=%1").arg(options.frameRate)};
+    if (!toneMapping.isEmpty()) {
+        filters.prepend(toneMapping);
+    }
+    if (options.resolution.isValid()) {
+        filters << QString("scale=%1:%2:force_original_aspect_ratio=decrease:flags=lanczos")
+                       .arg(options.resolution.width()).arg(options.resolution.height());
+    }
+    
+    QSaveFile file(options.outputPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(videoExporter) << "Cannot write GIF:" << file.errorString();
+        return false;
+    }
+    
+    // Delays are in hundredths of a second; rounding the running time keeps the rate exact on average
+    QSize frameSize;
+    int frameIndex = 0;
+    const int expected = qMax(1, qCeil(options.duration * options.frameRate / 1000.0));
+    const bool encoded = readFFmpegFrames(source.ffmpegPath, input + QStringList{"-vf", filters.join(',')}, context,
+                                          [&](const uchar* rgb, const QSize& size) {
+        if (frameSize.isEmpty()) {
+            if (!encoder.open(&file, size)) {
+                return false;
+            }
+            frameSize = size;
+        } else if (size != frameSize) {
+            qCWarning(videoExporter) << "GIF frame size changed from" << frameSize << "to" << size;
+            return false;
+        }
+        
+        const int delay = qRound((frameIndex + 1) * 100.0 / options.frameRate)
+                        - qRound(frameIndex * 100.0 / options.frameRate);
+        ++frameIndex;
+        context.setProgress(progressStart + qMin(99 - progressStart, frameIndex * (100 - progressStart) / expected));
+        return encoder.addFrame(rgb, delay);
+    });
+    
+    if (!encoded || frameSize.isEmpty() || !encoder.close() || !file.commit()) {
+        file.cancelWriting();
+        return false;
+    }
+    return true;
+}
+
+bool VideoExporter::processVideoExport(const VideoExportOptions& options, const ExportSource& source,
+                                       ExportJobQueue::Context& context)
+{
+    const bool hdr = options.hdrFormat == HDR10 || options.hdrFormat == HLG;
+    
+    // SDR upscales run through VideoUpscaler between a decoding and an encoding FFmpeg
+    if (options.upscaling != None && !hdr) {
+        QSize inputSize;
+        QString frameRate;
+        if (probeVideo(source.ffmpegPath, ffmpegInput(source.path), &inputSize, &frameRate)) {
+            if (options.frameRate > 0) {
+                frameRate = QString::number(options.frameRate);
+            }
+            return processUpscaledExport(options, source, context, inputSize, frameRate);
+        }
+        if (upscalingModel(options.upscaling).file) {
+            qCWarning(videoExporter) << "Cannot upscale: failed to probe" << source.path;
+            return false;
+        }
+        qCDebug(videoExporter) << "ffprobe unavailable, upscaling with FFmpeg's scaler";
+    }
+    
+    QStringList arguments{"-loglevel", "error", "-y"};
+    if (options.startTime > 0) {
+        arguments << "-ss" << ffmpegSeconds(options.startTime);
+    }
+    if (options.duration > 0) {
+        arguments << "-t" << ffmpegSeconds(options.duration);
+    }
+    arguments << "-i" << ffmpegInput(source.path);
+    
+    // SDR exports of HDR sources are tone mapped before scaling
+    QStringList filters;
+    const QString toneMapping = hdr ? QString() : toneMappingFilter(source.ffmpegPath, ffmpegInput(source.path));
+    if (!toneMapping.isEmpty()) {
+        filters << toneMapping;
+    }
+    
+    // Scaling here is FFmpeg's: HDR sources, or no ffprobe to size the upscaler's pipe
+    QString scaleFlags = "bicubic";
+    switch (options.upscaling) {
+        case Bilinear: scaleFlags = "bilinear"; break;
+        case Lanczos: scaleFlags = "lanczos"; break;
+        default: break;
+    }
+    if (options.upscaling != None) {
+        filters << QString("scale=trunc(iw*%1/2)*2:trunc(ih*%1/2)*2:flags=%2")
+                       .arg(options.upscaleRatio).arg(scaleFlags);
+    } else if (options.resolution.isValid()) {
+        filters << QString("scale=%1:%2:force_original_aspect_ratio=decrease:force_divisible_by=2:flags=%3")
+                       .arg(options.resolution.width()).arg(options.resolution.height()).arg(scaleFlags);
+    }
+    if (!toneMapping.isEmpty()) {
+        // Back to YUV with the BT.709 matrix the output is tagged with
+        filters << "scale=out_color_matrix=bt709:out_range=tv";
+    }
+    if (!filters.isEmpty()) {
+        arguments << "-vf" << filters.join(',');
+    }
+    if (options.frameRate > 0) {
+        arguments << "-r" << QString::number(options.frameRate);
+    }
+    
+    arguments << encoderArguments(options, context.threads());
+    if (!toneMapping.isEmpty()) {
+        arguments << "-color_primaries" << "bt709" << "-color_trc" << "bt709" << "-colorspace" << "bt709";
+    }
+    
+    const qint64 duration = options.duration > 0 ? options.duration
+                                                 : qMax<qint64>(0, source.duration - options.startTime);
+    const bool success = runFFmpeg(source.ffmpegPath, arguments, duration, context);
+    if (!success) {
+        QFile::remove(options.outputPath);
+    }
+    return success;
+}
+
+bool VideoExporter::processUpscaledExport(const VideoExportOptions& options, const ExportSource& source,
+                                          ExportJobQueue::Context& context, const QSize& inputSize,
+                                          const QString& frameRate)
+{
+    const float ratio = qBound(1.0f, options.upscaleRatio, MAX_UPSCALE_RATIO);
+    const QSize outputSize(qRound(inputSize.width() * ratio / 2.0f) * 2, qRound(inputSize.height() * ratio / 2.0f) * 2);
+    
+    VideoUpscaler::Options upscalerOptions;
+    upscalerOptions.kernel = upscalingKernel(options.upscaling);
+    upscalerOptions.threads = context.threads();
+    upscalerOptions.memoryBudget = options.memoryBudget;
+    VideoUpscaler upscaler(upscalerOptions);
+    if (upscalingModel(options.upscaling).file) {
+        std::shared_ptr<SuperResolutionModel> model = loadUpscalingModel(options.upscaling, context.threads());
+        if (!model) {
+            qCWarning(videoExporter) << "Upscaling model not available for method" << options.upscaling;
+            return false;
+        }
+        upscaler.setModel(model);
+    }
+    if (!upscaler.configure(inputSize, outputSize)) {
+        qCWarning(videoExporter) << "Cannot upscale" << inputSize << "to" << outputSize;
+        return false;
+    }
+    
+    QStringList range;
+    if (options.startTime > 0) {
+        range << "-ss" << ffmpegSeconds(options.startTime);
+    }
+    if (options.duration > 0) {
+        range << "-t" << ffmpegSeconds(options.duration);
+    }
+    
+    // Decoder: unrotated RGBA at the probed size, so rows can be consumed as they arrive
+    QStringList decoderArguments{"-hide_banner", "-nostats", "-loglevel", "error", "-noautorotate"};
+    decoderArguments << range << "-i" << ffmpegInput(source.path);
+    QStringList filters;
+    const QString toneMapping = toneMappingFilter(source.ffmpegPath, ffmpegInput(source.path));
+    if (!toneMapping.isEmpty()) {
+        filters << toneMapping;
+    }
+    if (options.frameRate > 0) {
+        filters << QString("fps=%1").arg(frameRate);
+    }
+    if (!filters.isEmpty()) {
+        decoderArguments << "-vf" << filters.join(',');
+    }
+    decoderArguments << "-an" << "-sn" << "-dn" << "-f" << "rawvideo" << "-pix_fmt" << "rgba" << "pipe:1";
+    
+    // Encoder: upscaled frames from the pipe, audio straight from the source
+    QStringList encoderInput{"-hide_banner", "-nostats", "-loglevel", "error", "-y",
+                             "-f", "rawvideo", "-pix_fmt", "rgba",
+                             "-s", QString("%1x%2").arg(outputSize.width()).arg(outputSize.height()),
+                             "-r", frameRate, "-i", "pipe:0"};
+    encoderInput << range << "-i" << ffmpegInput(source.path)
+                 << "-map" << "0:v" << "-map" << "1:a?" << "-shortest";
+    
+    QProcess decoder;
+    QProcess encoder;
+    decoder.setStandardErrorFile(QProcess::nullDevice());
+    decoder.start(source.ffmpegPath, decoderArguments);
+    encoder.start(source.ffmpegPath, encoderInput + encoderArguments(options, qMax(1, context.threads() / 2)));
+    if (!decoder.waitForStarted(FFMPEG_START_TIMEOUT_MS) || !encoder.waitForStarted(FFMPEG_START_TIMEOUT_MS)) {
+        qCWarning(videoExporter) << "Failed to start FFmpeg:" << decoder.errorString() << encoder.errorString();
+        return false;
+    }
+    
+    auto stop = [&]() {
+        decoder.kill();
+        encoder.kill();
+        decoder.waitForFinished();
+        encoder.waitForFinished();
+        QFile::remove(options.outputPath);
+        return false;
+    };
+    
+    // Rows are read and written straight through; the encoder's backlog is bounded too
+    const VideoUpscaler::RowSource readRows = [&](uchar* rows, int, int count, int stride) {
+        qint64 remaining = qint64(count) * stride;
+        while (remaining > 0) {
+            if (context.isCancelled()) {
+                return false;
+            }
+            const qint64 read = decoder.read(reinterpret_cast<char*>(rows), remaining);
+            if (read < 0 || (read == 0 && decoder.state() == QProcess::NotRunning)) {
+                return false;
+            }
+            rows += read;
+            remaining -= read;
+            if (remaining > 0 && read == 0) {
+                decoder.waitForReadyRead(FFMPEG_POLL_MS);
+            }
+        }
+        return true;
+    };
+    const VideoUpscaler::RowSink writeRows = [&](const uchar* rows, int, int count, int stride) {
+        if (encoder.write(reinterpret_cast<const char*>(rows), qint64(count) * stride) < 0) {
+            return false;
+        }
+        while (encoder.bytesToWrite() > ENCODER_BACKLOG_BYTES) {
+            if (context.isCancelled() || encoder.state() == QProcess::NotRunning) {
+                return false;
+            }
+            encoder.waitForBytesWritten(FFMPEG_POLL_MS);
+        }
+        return true;
+    };
+    
+    const qint64 duration = options.duration > 0 ? options.duration
+                                                 : qMax<qint64>(0, source.duration - options.startTime);
+    const QStringList rate = frameRate.split('/');
+    const double framesPerSecond = rate.size() == 2 ? rate[0].toDouble() / qMax(1.0, rate[1].toDouble())
+                                                    : frameRate.toDouble();
+    qint64 frames = 0;
+    for (;;) {
+        // A frame starts once its first bytes arrive; none and a finished decoder is the end
+        while (decoder.bytesAvailable() == 0 && decoder.state() != QProcess::NotRunning) {
+            if (context.isCancelled()) {
+                return stop();
+            }
+            decoder.waitForReadyRead(FFMPEG_POLL_MS);
+        }
+        if (decoder.bytesAvailable() == 0) {
+            break;
+        }
+        if (!upscaler.process(readRows, writeRows)) {
+            return stop();
+        }
+        ++frames;
+        if (duration > 0 && framesPerSecond > 0.0) {
+            context.setProgress(int(qMin<qint64>(99, qint64(frames * 100000.0 / framesPerSecond) / duration)));
+        }
+    }
+    
+    encoder.closeWriteChannel();
+    while (!encoder.waitForFinished(FFMPEG_POLL_MS)) {
+        if (context.isCancelled() || encoder.state() == QProcess::NotRunning) {
+            break;
+        }
+    }
+    if (context.isCancelled()) {
+        return stop();
+    }
+    
+    const bool success = decoder.exitStatus() == QProcess::NormalExit && decoder.exitCode() == 0
+                      && encoder.exitStatus() == QProcess::NormalExit && encoder.exitCode() == 0 && frames > 0;
+    if (!success) {
+        qCWarning(videoExporter) << "Upscaled export failed:" << encoder.readAllStandardError().trimmed();
+        QFile::remove(options.outputPath);
+    }
+    return success;
+}
+
+QStringList VideoExporter::encoderArguments(const VideoExportOptions& options, int threads)
+{
+    const bool hdr = options.hdrFormat == HDR10 || options.hdrFormat == HLG;
+    QStringList arguments;
+    
+    // Codec per container, quality as a constant rate factor unless a bitrate is given
+    static const int X26X_CRF[] = {28, 23, 18};
+    static const int VP9_CRF[] = {40, 33, 24};
+    static const int MPEG4_Q[] = {8, 5, 3};
+    const bool lossless = options.quality == Lossless;
+    const int level = qMin(int(options.quality), int(High));
+    switch (options.format) {
+        case WEBM:
+            arguments << "-c:v" << "libvpx-vp9" << "-row-mt" << "1";
+            if (lossless) {
+                arguments << "-lossless" << "1";
+            } else if (options.bitrate <= 0) {
+                arguments << "-crf" << QString::number(VP9_CRF[level]) << "-b:v" << "0";
+            }
+            arguments << "-c:a" << "libopus";
+            break;
+        case AVI:
+            arguments << "-c:v" << "mpeg4";
+            if (options.bitrate <= 0) {
+                arguments << "-q:v" << QString::number(lossless ? 1 : MPEG4_Q[level]);
+            }
+            arguments << "-c:a" << "libmp3lame";
+            break;
+        default:
+            if (hdr) {
+                // 10-bit HEVC carrying the source's HDR transfer
+                arguments << "-c:v" << "libx265" << "-pix_fmt" << "yuv420p10le" << "-tag:v" << "hvc1"
+                          << "-color_primaries" << "bt2020" << "-colorspace" << "bt2020nc"
+                          << "-color_trc" << (options.hdrFormat == HDR10 ? "smpte2084" : "arib-std-b67");
+                if (lossless) {
+                    arguments << "-x265-params" << "lossless=1";
+                } else if (options.bitrate <= 0) {
+                    arguments << "-crf" << QString::number(X26X_CRF[level]);
+                }
+            } else {
+                arguments << "-c:v" << "libx264" << "-pix_fmt" << "yuv420p";
+                if (lossless) {
+                    arguments << "-qp" << "0";
+                } else if (options.bitrate <= 0) {
+                    arguments << "-crf" << QString::number(X26X_CRF[level]);
+                }
+            }
+            arguments << "-c:a" << "aac";
+            break;
+    }
+    if (options.bitrate > 0 && !lossless) {
+        arguments << "-b:v" << QString("%1k").arg(options.bitrate);
+    }
+    arguments << "-threads" << QString::number(threads) << options.outputPath;
+    return arguments;
+}
+
+bool VideoExporter::analyzeVideoForScenes(const SceneDetector::Options& options, const ExportSource& source,
+                                          ExportJobQueue::Context& context,
+                                          const std::function<void(const SceneInfo& scene)>& onScene)
+{
+    // Each cut ends the scene before it; the first starts at zero
+    qint64 start = 0;
+    float confidence = 1.0f;
+    int count = 0;
+    SceneDetector detector(options);
+    const bool success = detector.run(source.ffmpegPath, ffmpegInput(source.path), source.duration, context,
+                                      [&](const SceneDetector::Cut& cut) {
+        onScene(SceneInfo(start, cut.time, QString("Scene %1").arg(++count), confidence));
+        start = cut.time;
+        confidence = cut.score;
+    });
+    if (!success) {
+        return false;
+    }
+    
+    onScene(SceneInfo(start, qMax(start, source.duration), QString("Scene %1").arg(++count), confidence));
+    return true;
+}
+
+bool VideoExporter::initializeAIModels()
+{
+    // Models are only located here; each export loads its own copy
+#ifdef HAVE_ONNXRUNTIME
+    for (UpscalingMethod method : {ESRGAN, RealESRGAN, EDSR, SRCNN}) {
+        const UpscalingModel model = upscalingModel(method);
+        if (!QStandardPaths::locate(QStandardPaths::AppDataLocation, model.file).isEmpty()
+            && !m_availableUpscalingMethods.contains(method)) {
+            m_availableUpscalingMethods.append(method);
+        }
+    }
+#endif
+    m_aiModelsLoaded = m_availableUpscalingMethods.contains(ESRGAN) || m_availableUpscalingMethods.contains(RealESRGAN)
+                    || m_availableUpscalingMethods.contains(EDSR) || m_availableUpscalingMethods.contains(SRCNN);
+    qCDebug(videoExporter) << "AI upscaling" << (m_aiModelsLoaded ? "available" : "not available");
+    return m_aiModelsLoaded;
+}
+
+QImage VideoExporter::upscaleImage(const QImage& image, UpscalingMethod method, float ratio)
+{
+    if (image.isNull() || method == None || !isUpscalingAvailable(method)) {
+        return image;
+    }
+    
+    VideoUpscaler::Options upscalerOptions;
+    upscalerOptions.kernel = upscalingKernel(method);
+    upscalerOptions.threads = QThread::idealThreadCount();
+    VideoUpscaler upscaler(upscalerOptions);
+    if (upscalingModel(method).file) {
+        std::shared_ptr<SuperResolutionModel> model = loadUpscalingModel(method, upscalerOptions.threads);
+        if (!model) {
+            return image;
+        }
+        upscaler.setModel(model);
+    }
+    
+    const float boundedRatio = qBound(1.0f, ratio, MAX_UPSCALE_RATIO);
+    const QImage result = upscaler.scale(image, QSize(qRound(image.width() * boundedRatio),
+                                                      qRound(image.height() * boundedRatio)));
+    return result.isNull() ? image : result;
+}
+
+bool VideoExporter::validateExportOptions(const VideoExportOptions& options)
+{
+    if (options.format != MP4 && options.format != AVI && options.format != MOV && options.format != WEBM) {
+        return false;
+    }
+    if (options.startTime < 0 || options.duration < 0) {
+        return false;
+    }
+    if (!isUpscalingAvailable(options.upscaling)) {
+        return false;
+    }
+    if (options.upscaling != None && (options.upscaleRatio < 1.0f || options.upscaleRatio > MAX_UPSCALE_RATIO)) {
+        return false;
+    }
+    
+    // HDR is carried in HEVC, which only the MP4 and MOV paths write; models take 8-bit frames
+    if (!isHDRSupported(options.hdrFormat)) {
+        return false;
+    }
+    if (options.hdrFormat != SDR && upscalingModel(options.upscaling).file) {
+        return false;
+    }
+    return options.hdrFormat == SDR || options.format == MP4 || options.format == MOV;
+}
+
+bool VideoExporter::captureCurrentFrame(const ScreenshotOptions& options)
+{
+    QString filePath = options.outputPath;
+    if (filePath.isEmpty()) {
+        filePath = defaultOutputPath(QStandardPaths::PicturesLocation, getFormatExtension(options.format));
+    }
+    
+    ScreenshotCapture::Request request;
+    request.outputPath = filePath;
+    request.quality = screenshotQuality(options.quality);
+    request.resolution = options.resolution;
+    const int captureId = m_screenshotCapture->capture(request);
+    if (captureId == 0) {
+        emit screenshotCaptured(false, filePath);
+        return false;
+    }
+    
+    m_screenshotCaptures.insert(captureId, filePath);
+    return true;
+}
+
+bool VideoExporter::captureFrameAtTime(qint64 timeMs, const ScreenshotOptions& options)
+{
+    if (m_source.path.isEmpty() || m_source.ffmpegPath.isEmpty()) {
+        qCWarning(videoExporter) << "Cannot capture screenshot: no source media or FFmpeg not found";
+        emit screenshotCaptured(false, options.outputPath);
+        return false;
+    }
+    
+    QString filePath = options.outputPath;
+    if (filePath.isEmpty()) {
+        filePath = defaultOutputPath(QStandardPaths::PicturesLocation, getFormatExtension(options.format));
+    }
+    
+    const ExportSource source = m_source;
+    const qint64 position = qBound<qint64>(0, timeMs, qMax<qint64>(0, source.duration));
+    queueJob(JobKind::Screenshot, filePath, [options, source, position, filePath](ExportJobQueue::Context& context) {
+        QStringList arguments{"-ss", ffmpegSeconds(position), "-i", ffmpegInput(source.path), "-frames:v", "1"};
+        const QString toneMapping = toneMappingFilter(source.ffmpegPath, ffmpegInput(source.path));
+        if (!toneMapping.isEmpty()) {
+            arguments << "-vf" << toneMapping;
+        }
+        
+        QImage image;
+        const bool decoded = readFFmpegFrames(source.ffmpegPath, arguments, context,
+                                              [&](const uchar* rgb, const QSize& size) {
+            image = QImage(rgb, size.width(), size.height(), size.width() * 3, QImage::Format_RGB888).copy();
+            return true;
+        });
+        if (!decoded || image.isNull()) {
+            return false;
+        }
+        return ScreenshotCapture::writeImage(processScreenshot(image, options), filePath, QByteArray(),
+                                             screenshotQuality(options.quality));
+    }, ExportJobQueue::Interactive, 1);
+    
+    return true;
+}
+
+QImage VideoExporter::processScreenshot(const QImage& image, const ScreenshotOptions& options)
+{
+    return ScreenshotCapture::scaleImage(image, options.resolution);
+}
+
+int VideoExporter::screenshotQuality(QualityLevel quality)
+{
+    switch (quality) {
+        case Low: return 60;
+        case Medium: return 80;
+        case Lossless: return 100;
+        default: return DEFAULT_SCREENSHOT_QUALITY;
+    }
 }
 
 QVector<VideoExporter::ExportFormat> VideoExporter::getSupportedFormats()
@@ -0,0 +1,343 @@
+#include "video/VideoFilterGraph.h"
+#include <QGenericMatrix>
+#include <QLoggingCategory>
+#include <QVector2D>
+#include <QtMath>
+
+Q_DECLARE_LOGGING_CATEGORY(videoFilterGraph)
+Q_LOGGING_CATEGORY(videoFilterGraph, "video.filtergraph")
+
+namespace {
+
+// Full-screen triangle generated from gl_VertexID; texture rows map to target rows
+const char* VERTEX_SHADER = R"(
+out vec2 v_texCoord;
+
+void main()
+{
+    vec2 position = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    v_texCoord = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// Shared by every pass; each pass adds applyBefore(), tap(), filtered() and main()
+const char* FRAGMENT_COMMON = R"(
+uniform sampler2D u_input;
+uniform vec2 u_texelSize;
+uniform int u_swapRedBlue;
+uniform float u_brightness;
+uniform float u_contrast;
+uniform float u_saturation;
+uniform mat2 u_hueRotation;
+uniform float u_inverseGamma;
+uniform float u_sepia;
+uniform float u_blur;
+uniform float u_sharpen;
+uniform int u_deinterlaceMode;
+
+in vec2 v_texCoord;
+out vec4 fragColor;
+
+const vec3 LUMA = vec3(0.299, 0.587, 0.114);
+
+vec3 sepiaTone(vec3 c)
+{
+    return vec3(dot(c, vec3(0.393, 0.769, 0.189)),
+                dot(c, vec3(0.349, 0.686, 0.168)),
+                dot(c, vec3(0.272, 0.534, 0.131)));
+}
+
+vec3 rotateHue(vec3 c)
+{
+    float y = dot(c, LUMA);
+    vec2 iq = u_hueRotation * vec2(dot(c, vec3(0.596, -0.274, -0.322)), dot(c, vec3(0.211, -0.523, 0.312)));
+    return vec3(y + 0.956 * iq.x + 0.621 * iq.y,
+                y - 0.272 * iq.x - 0.647 * iq.y,
+                y - 1.106 * iq.x + 1.703 * iq.y);
+}
+)";
+
+QString pointOperation(VideoProcessor::FilterType filter)
+{
+    switch (filter) {
+        case VideoProcessor::Brightness: return "c += u_brightness;";
+        case VideoProcessor::Contrast: return "c = (c - 0.5) * u_contrast + 0.5;";
+        case VideoProcessor::Saturation: return "c = mix(vec3(dot(c, LUMA)), c, u_saturation);";
+        case VideoProcessor::Hue: return "c = rotateHue(c);";
+        case VideoProcessor::Gamma: return "c = pow(max(c, 0.0), vec3(u_inverseGamma));";
+        case VideoProcessor::Sepia: return "c = mix(c, sepiaTone(c), u_sepia);";
+        case VideoProcessor::Grayscale: return "c = vec3(dot(c, LUMA));";
+        case VideoProcessor::Invert: return "c = 1.0 - c;";
+        case VideoProcessor::Vintage: return "c = mix(c, sepiaTone(c), 0.6) * 0.85 + 0.08;";
+        case VideoProcessor::WarmTone: return "c *= vec3(1.08, 1.0, 0.9);";
+        case VideoProcessor::CoolTone: return "c *= vec3(0.9, 1.0, 1.08);";
+        case VideoProcessor::HighContrast: return "c = (c - 0.5) * 1.6 + 0.5;";
+        default: return QString();
+    }
+}
+
+// Body of vec3 filtered(vec2 uv), sampling through tap()
+QString neighbourhoodOperation(VideoProcessor::FilterType filter)
+{
+    switch (filter) {
+        case VideoProcessor::Blur:
+            // 7x7 Gaussian whose footprint grows with the radius
+            return R"(
+    if (u_blur <= 0.0) return tap(uv);
+    vec2 stepSize = u_texelSize * max(u_blur / 3.0, 1.0);
+    vec3 sum = vec3(0.0);
+    float total = 0.0;
+    for (int y = -3; y <= 3; ++y) {
+        for (int x = -3; x <= 3; ++x) {
+            float weight = exp(-float(x * x + y * y) / 4.5);
+            sum += tap(uv + vec2(x, y) * stepSize) * weight;
+            total += weight;
+        }
+    }
+    return sum / total;)";
+        case VideoProcessor::Sharpen:
+            return R"(
+    vec3 c = tap(uv);
+    vec3 around = tap(uv + vec2(u_texelSize.x, 0.0)) + tap(uv - vec2(u_texelSize.x, 0.0))
+                + tap(uv + vec2(0.0, u_texelSize.y)) + tap(uv - vec2(0.0, u_texelSize.y));
+    return c + u_sharpen * (c - around * 0.25);)";
+        case VideoProcessor::EdgeDetection:
+            return R"(
+    float l[9];
+    for (int i = 0; i < 9; ++i) {
+        l[i] = dot(tap(uv + vec2(i % 3 - 1, i / 3 - 1) * u_texelSize), LUMA);
+    }
+    float gx = l[2] + 2.0 * l[5] + l[8] - l[0] - 2.0 * l[3] - l[6];
+    float gy = l[6] + 2.0 * l[7] + l[8] - l[0] - 2.0 * l[1] - l[2];
+    return vec3(length(vec2(gx, gy)));)";
+        case VideoProcessor::Emboss:
+            return R"(
+    return vec3(0.5 + dot(tap(uv - u_texelSize) - tap(uv + u_texelSize), LUMA));)";
+        case VideoProcessor::Deinterlace:
+            // Spatial only: the second field is rebuilt from the first
+            return R"(
+    if (int(floor(uv.y / u_texelSize.y)) % 2 == 0) return tap(uv);
+    vec3 above = tap(uv - vec2(0.0, u_texelSize.y));
+    if (u_deinterlaceMode == 1) return above;
+    return (above + tap(uv + vec2(0.0, u_texelSize.y))) * 0.5;)";
+        default:
+            return "\n    return tap(uv);";
+    }
+}
+
+QString passSource(const QStringList& before, VideoProcessor::FilterType filter, const QStringList& after)
+{
+    QString source;
+    source += "vec3 applyBefore(vec3 c)\n{\n";
+    for (const QString& operation : before) {
+        source += "    " + operation + "\n";
+    }
+    source += "    return c;\n}\n\n";
+
+    source += "vec3 tap(vec2 uv)\n{\n"
+              "    vec4 texel = texture(u_input, uv);\n"
+              "    return applyBefore(u_swapRedBlue != 0 ? texel.bgr : texel.rgb);\n}\n\n";
+
+    source += "vec3 filtered(vec2 uv)\n{" + neighbourhoodOperation(filter) + "\n}\n\n";
+
+    source += "void main()\n{\n    vec3 c = filtered(v_texCoord);\n";
+    for (const QString& operation : after) {
+        source += "    " + operation + "\n";
+    }
+    source += "    fragColor = vec4(clamp(c, 0.0, 1.0), 1.0);\n}\n";
+    return source;
+}
+
+QByteArray chainKey(const QVector<VideoProcessor::FilterType>& filters)
+{
+    QByteArray key;
+    key.reserve(filters.size());
+    for (VideoProcessor::FilterType filter : filters) {
+        key.append(static_cast<char>(filter));
+    }
+    return key;
+}
+
+} // namespace
+
+VideoFilterGraph::VideoFilterGraph()
+    : m_initialized(false)
+{
+}
+
+VideoFilterGraph::~VideoFilterGraph() = default;
+
+void VideoFilterGraph::initialize(const QByteArray& shaderHeader)
+{
+    initializeOpenGLFunctions();
+    m_shaderHeader = shaderHeader;
+    m_vao.create();
+    m_initialized = true;
+}
+
+void VideoFilterGraph::release()
+{
+    m_pipeline.reset();
+    m_pipelines.clear();
+    m_targets[0].reset();
+    m_targets[1].reset();
+    m_vao.destroy();
+    m_initialized = false;
+}
+
+bool VideoFilterGraph::needsOwnPass(VideoProcessor::FilterType filter)
+{
+    switch (filter) {
+        case VideoProcessor::Blur:
+        case VideoProcessor::Sharpen:
+        case VideoProcessor::EdgeDetection:
+        case VideoProcessor::Emboss:
+        case VideoProcessor::Deinterlace:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool VideoFilterGraph::setChain(const VideoProcessor::FilterChain& chain)
+{
+    m_parameters = chain.parameters;
+    if (!m_initialized) {
+        return false;
+    }
+
+    const QByteArray key = chainKey(chain.filters);
+    auto cached = m_pipelines.constFind(key);
+    if (cached != m_pipelines.constEnd()) {
+        m_pipeline = cached.value();
+        return true;
+    }
+
+    m_pipeline = compile(chain.filters);
+    if (!m_pipeline) {
+        return false;
+    }
+
+    // Filter sequences are few in practice; start over rather than track use
+    if (m_pipelines.size() >= MAX_CACHED_PIPELINES) {
+        m_pipelines.clear();
+    }
+    m_pipelines.insert(key, m_pipeline);
+    return true;
+}
+
+std::shared_ptr<VideoFilterGraph::Pipeline> VideoFilterGraph::compile(const QVector<VideoProcessor::FilterType>& filters)
+{
+    auto pipeline = std::make_shared<Pipeline>();
+
+    // Split the chain at each neighbourhood filter; point filters ride along
+    QStringList pending;
+    QList<QPair<QStringList, VideoProcessor::FilterType>> stages;
+    for (VideoProcessor::FilterType filter : filters) {
+        if (needsOwnPass(filter)) {
+            stages.append({pending, filter});
+            pending.clear();
+        } else {
+            const QString operation = pointOperation(filter);
+            if (!operation.isEmpty()) {
+                pending.append(operation);
+            }
+        }
+    }
+    if (stages.isEmpty() && pending.isEmpty()) {
+        return pipeline;
+    }
+
+    QStringList sources;
+    if (stages.isEmpty()) {
+        sources.append(passSource(pending, VideoProcessor::None, QStringList()));
+    } else {
+        for (int i = 0; i < stages.size(); ++i) {
+            const QStringList after = i == stages.size() - 1 ? pending : QStringList();
+            sources.append(passSource(stages[i].first, stages[i].second, after));
+        }
+    }
+
+    for (const QString& source : std::as_const(sources)) {
+        auto program = std::make_shared<QOpenGLShaderProgram>();
+        if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, m_shaderHeader + VERTEX_SHADER)
+            || !program->addShaderFromSourceCode(QOpenGLShader::Fragment,
+                                                 m_shaderHeader + FRAGMENT_COMMON + source.toUtf8())
+            || !program->link()) {
+            qCWarning(videoFilterGraph) << "Filter pass failed to compile:" << program->log();
+            return nullptr;
+        }
+        pipeline->passes.append(program);
+    }
+
+    qCDebug(videoFilterGraph) << "Compiled" << filters.size() << "filters into" << pipeline->passes.size() << "passes";
+    return pipeline;
+}
+
+void VideoFilterGraph::ensureTargets(const QSize& size)
+{
+    for (auto& target : m_targets) {
+        if (!target || target->size() != size) {
+            QOpenGLFramebufferObjectFormat format;
+            format.setInternalTextureFormat(GL_RGBA8);
+            target = std::make_unique<QOpenGLFramebufferObject>(size, format);
+        }
+    }
+}
+
+void VideoFilterGraph::setUniforms(QOpenGLShaderProgram* program) const
+{
+    const VideoProcessor::ProcessingParameters& p = m_parameters;
+    const float hue = qDegreesToRadians(p.hue);
+    const float c = static_cast<float>(qCos(hue));
+    const float s = static_cast<float>(qSin(hue));
+    const float rotation[] = {
+        c, -s,
+        s, c
+    };
+
+    program->setUniformValue("u_brightness", p.brightness / 200.0f);
+    program->setUniformValue("u_contrast", (100.0f + p.contrast) / 100.0f);
+    program->setUniformValue("u_saturation", (100.0f + p.saturation) / 100.0f);
+    program->setUniformValue("u_hueRotation", QMatrix2x2(rotation));
+    program->setUniformValue("u_inverseGamma", 1.0f / qMax(0.1f, p.gamma));
+    program->setUniformValue("u_sepia", p.sepia);
+    program->setUniformValue("u_blur", p.blur);
+    program->setUniformValue("u_sharpen", p.sharpen);
+    program->setUniformValue("u_deinterlaceMode", p.deinterlaceMethod == "bob" ? 1 : 0);
+}
+
+GLuint VideoFilterGraph::process(GLuint inputTexture, const QSize& size, bool swapRedBlue)
+{
+    if (!m_initialized || isEmpty() || size.isEmpty()) {
+        return inputTexture;
+    }
+
+    ensureTargets(size);
+    glViewport(0, 0, size.width(), size.height());
+    glActiveTexture(GL_TEXTURE0);
+    m_vao.bind();
+
+    // Ping-pong: each pass reads what the previous one wrote
+    GLuint source = inputTexture;
+    for (int i = 0; i < m_pipeline->passes.size(); ++i) {
+        QOpenGLFramebufferObject* target = m_targets[i % 2].get();
+        QOpenGLShaderProgram* program = m_pipeline->passes[i].get();
+
+        target->bind();
+        glBindTexture(GL_TEXTURE_2D, source);
+        program->bind();
+        program->setUniformValue("u_input", 0);
+        program->setUniformValue("u_texelSize", QVector2D(1.0f / size.width(), 1.0f / size.height()));
+        program->setUniformValue("u_swapRedBlue", i == 0 && swapRedBlue ? 1 : 0);
+        setUniforms(program);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        source = target->texture();
+    }
+
+    m_vao.release();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return source;
+}
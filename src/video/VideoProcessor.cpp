@@ -65,17 +65,67 @@ QVector<VideoProcessor::FilterType> VideoProcessor::getActiveFilters() const
 
 void VideoProcessor::setFilterEnabled(FilterType filter, bool enabled)
 {
+    if (filter == None) {
+        return;
+    }
+    
     QMutexLocker locker(&m_processingMutex);
     
-    if (enabled && !m_activeFilters.contains(filter)) {
-        m_activeFilters.append(filter);
-        emit filterEnabledChanged(filter, true);
-        qCDebug(videoProcessor) << "Filter enabled:" << getFilterName(filter);
-    } else if (!enabled && m_activeFilters.contains(filter)) {
+    if (enabled == m_activeFilters.contains(filter)) {
+        return;
+    }
+    
+    if (!enabled) {
         m_activeFilters.removeAll(filter);
-        emit filterEnabledChanged(filter, false);
-        qCDebug(videoProcessor) << "Filter disabled:" << getFilterName(filter);
+    } else if (filter == Deinterlace) {
+        m_activeFilters.prepend(filter);
+    } else {
+        m_activeFilters.append(filter);
     }
+    locker.unlock();
+    
+    emit filterEnabledChanged(filter, enabled);
+    emitFilterChainChanged();
+    qCDebug(videoProcessor) << "Filter" << (enabled ? "enabled:" : "disabled:") << getFilterName(filter);
+}
+
+void VideoProcessor::setFilterOrder(const QVector<FilterType>& filters)
+{
+    QVector<FilterType> order;
+    for (FilterType filter : filters) {
+        if (filter != None && !order.contains(filter)) {
+            order.append(filter);
+        }
+    }
+    
+    QMutexLocker locker(&m_processingMutex);
+    if (order == m_activeFilters) {
+        return;
+    }
+    m_activeFilters = order;
+    locker.unlock();
+    
+    emitFilterChainChanged();
+}
+
+void VideoProcessor::moveFilter(int from, int to)
+{
+    QMutexLocker locker(&m_processingMutex);
+    
+    const int count = static_cast<int>(m_activeFilters.size());
+    if (from < 0 || from >= count || to < 0 || to >= count || from == to) {
+        return;
+    }
+    m_activeFilters.move(from, to);
+    locker.unlock();
+    
+    emitFilterChainChanged();
+}
+
+VideoProcessor::FilterChain VideoProcessor::getFilterChain() const
+{
+    QMutexLocker locker(&m_processingMutex);
+    return FilterChain{m_activeFilters, m_parameters};
 }
 
 bool VideoProcessor::isFilterEnabled(FilterType filter) const
@@ -127,21 +177,16 @@ VideoProcessor::ProcessingParameters VideoProcessor::getParameters() const
 
 void VideoProcessor::setParameters(const ProcessingParameters& params)
 {
-    QMutexLocker locker(&m_processingMutex);
-    
     // Clamp all parameters to valid ranges
-    ProcessingParameters clampedParams = params;
-    clampedParams.brightness = clampParameter(params.brightness, MIN_BRIGHTNESS, MAX_BRIGHTNESS);
-    clampedParams.contrast = clampParameter(params.contrast, MIN_CONTRAST, MAX_CONTRAST);
-    clampedParams.saturation = clampParameter(params.saturation, MIN_SATURATION, MAX_SATURATION);
-    clampedParams.hue = clampParameter(params.hue, MIN_HUE, MAX_HUE);
-    clampedParams.gamma = clampParameter(params.gamma, MIN_GAMMA, MAX_GAMMA);
-    clampedParams.sepia = clampParameter(params.sepia, 0.0f, 1.0f);
-    clampedParams.blur = clampParameter(params.blur, 0.0f, 10.0f);
-    clampedParams.sharpen = clampParameter(params.sharpen, 0.0f, 2.0f);
+    const ProcessingParameters clampedParams = clampParameters(params);
+    
+    {
+        QMutexLocker locker(&m_processingMutex);
+        m_parameters = clampedParams;
+    }
     
-    m_parameters = clampedParams;
-    emit parametersChanged(m_parameters);
+    emit parametersChanged(clampedParams);
+    emitFilterChainChanged();
     qCDebug(videoProcessor) << "Video processing parameters updated";
 }
 
@@ -230,7 +275,11 @@ void VideoProcessor::setParameter(FilterType filter, const QString& paramName, f
             break;
     }
     
-    emit parametersChanged(m_parameters);
+    const ProcessingParameters params = m_parameters;
+    locker.unlock();
+    
+    emit parametersChanged(params);
+    emitFilterChainChanged();
 }
 
 VideoProcessor::VideoInfo VideoProcessor::getCurrentVideoInfo() const
@@ -262,6 +311,29 @@ void VideoProcessor::updateVideoInfo(const VideoInfo& info)
     }
 }
 
+void VideoProcessor::videoFrameReady(const VideoFrameRef& frame)
+{
+    QMutexLocker locker(&m_processingMutex);
+    
+    m_currentVideoInfo.currentFrame = static_cast<int>(frame->sequence());
+    
+    if (m_currentVideoInfo.width == frame->width() && m_currentVideoInfo.height == frame->height()) {
+        return;
+    }
+    
+    m_currentVideoInfo.width = frame->width();
+    m_currentVideoInfo.height = frame->height();
+    m_currentVideoInfo.aspectRatio = static_cast<float>(frame->width()) / frame->height();
+    m_currentVideoInfo.pixelFormat = "RGB32";
+    VideoInfo info = m_currentVideoInfo;
+    locker.unlock();
+    
+    // Signal from the processor's own thread rather than the decoder's
+    QMetaObject::invokeMethod(this, [this, info]() {
+        emit videoInfoUpdated(info);
+    }, Qt::QueuedConnection);
+}
+
 QVector<VideoProcessor::ChapterInfo> VideoProcessor::getChapters() const
 {
     QMutexLocker locker(&m_processingMutex);
@@ -359,7 +431,8 @@ void VideoProcessor::resetFilters()
     
     locker.unlock();
     
-    emit parametersChanged(m_parameters);
+    emit parametersChanged(ProcessingParameters());
+    emitFilterChainChanged();
     qCDebug(videoProcessor) << "Video filters reset";
 }
 
@@ -396,19 +469,29 @@ bool VideoProcessor::loadFilterPreset(const QString& presetName)
     newParams.blur = static_cast<float>(params["blur"].toDouble());
     newParams.sharpen = static_cast<float>(params["sharpen"].toDouble());
     newParams.deinterlaceEnabled = params["deinterlaceEnabled"].toBool();
-    newParams.deinterlaceMethod = params["deinterlaceMethod"].toString();
-    
-    setParameters(newParams);
-    
-    // Load active filters
-    QJsonArray filtersArray = root["activeFilters"].toArray();
-    QMutexLocker locker(&m_processingMutex);
-    m_activeFilters.clear();
+    newParams.deinterlaceMethod = params["deinterlaceMethod"].toString("linear");
+    newParams = clampParameters(newParams);
     
+    // Load active filters, in their saved order
+    QVector<FilterType> filters;
+    const QJsonArray filtersArray = root["activeFilters"].toArray();
     for (const QJsonValue& value : filtersArray) {
-        m_activeFilters.append(static_cast<FilterType>(value.toInt()));
+        const int filter = value.toInt();
+        if (filter > None && filter <= Deinterlace && !filters.contains(static_cast<FilterType>(filter))) {
+            filters.append(static_cast<FilterType>(filter));
+        }
     }
     
+    // Filters and parameters change together, so the renderer switches in one frame
+    {
+        QMutexLocker locker(&m_processingMutex);
+        m_parameters = newParams;
+        m_activeFilters = filters;
+    }
+    
+    emit parametersChanged(newParams);
+    emitFilterChainChanged();
+    
     qCDebug(videoProcessor) << "Loaded preset:" << presetName;
     return true;
 }
@@ -421,28 +504,29 @@ bool VideoProcessor::saveFilterPreset(const QString& presetName)
     
     QString filePath = presetsDir + "/" + presetName + ".json";
     
+    const FilterChain chain = getFilterChain();
+    
     QJsonObject root;
     root["version"] = "1.0";
     root["name"] = presetName;
     
     // Save parameters
     QJsonObject params;
-    params["brightness"] = static_cast<double>(m_parameters.brightness);
-    params["contrast"] = static_cast<double>(m_parameters.contrast);
-    params["saturation"] = static_cast<double>(m_parameters.saturation);
-    params["hue"] = static_cast<double>(m_parameters.hue);
-    params["gamma"] = static_cast<double>(m_parameters.gamma);
-    params["sepia"] = static_cast<double>(m_parameters.sepia);
-    params["blur"] = static_cast<double>(m_parameters.blur);
-    params["sharpen"] = static_cast<double>(m_parameters.sharpen);
-    params["deinterlaceEnabled"] = m_parameters.deinterlaceEnabled;
-    params["deinterlaceMethod"] = m_parameters.deinterlaceMethod;
+    params["brightness"] = static_cast<double>(chain.parameters.brightness);
+    params["contrast"] = static_cast<double>(chain.parameters.contrast);
+    params["saturation"] = static_cast<double>(chain.parameters.saturation);
+    params["hue"] = static_cast<double>(chain.parameters.hue);
+    params["gamma"] = static_cast<double>(chain.parameters.gamma);
+    params["sepia"] = static_cast<double>(chain.parameters.sepia);
+    params["blur"] = static_cast<double>(chain.parameters.blur);
+    params["sharpen"] = static_cast<double>(chain.parameters.sharpen);
+    params["deinterlaceEnabled"] = chain.parameters.deinterlaceEnabled;
+    params["deinterlaceMethod"] = chain.parameters.deinterlaceMethod;
     root["parameters"] = params;
     
-    // Save active filters
+    // Save active filters, in execution order
     QJsonArray filtersArray;
-    QMutexLocker locker(&m_processingMutex);
-    for (FilterType filter : m_activeFilters) {
+    for (FilterType filter : chain.filters) {
         filtersArray.append(static_cast<int>(filter));
     }
     root["activeFilters"] = filtersArray;
@@ -476,31 +560,23 @@ QStringList VideoProcessor::getAvailablePresets() const
     return presets;
 }
 
-void VideoProcessor::applyColorAdjustments(ProcessingParameters& params)
+VideoProcessor::ProcessingParameters VideoProcessor::clampParameters(const ProcessingParameters& params) const
 {
-    // Color adjustments would be applied to video frames
-    // This is a placeholder for the actual video processing implementation
-    Q_UNUSED(params)
-    
-    qCDebug(videoProcessor) << "Applying color adjustments";
-}
-
-void VideoProcessor::applyFilterEffects(ProcessingParameters& params)
-{
-    // Filter effects would be applied to video frames
-    // This is a placeholder for the actual video processing implementation
-    Q_UNUSED(params)
-    
-    qCDebug(videoProcessor) << "Applying filter effects";
+    ProcessingParameters clampedParams = params;
+    clampedParams.brightness = clampParameter(params.brightness, MIN_BRIGHTNESS, MAX_BRIGHTNESS);
+    clampedParams.contrast = clampParameter(params.contrast, MIN_CONTRAST, MAX_CONTRAST);
+    clampedParams.saturation = clampParameter(params.saturation, MIN_SATURATION, MAX_SATURATION);
+    clampedParams.hue = clampParameter(params.hue, MIN_HUE, MAX_HUE);
+    clampedParams.gamma = clampParameter(params.gamma, MIN_GAMMA, MAX_GAMMA);
+    clampedParams.sepia = clampParameter(params.sepia, 0.0f, 1.0f);
+    clampedParams.blur = clampParameter(params.blur, 0.0f, 10.0f);
+    clampedParams.sharpen = clampParameter(params.sharpen, 0.0f, 2.0f);
+    return clampedParams;
 }
 
-void VideoProcessor::applyDeinterlacing(ProcessingParameters& params)
+void VideoProcessor::emitFilterChainChanged()
 {
-    // Deinterlacing would be applied to video frames
-    // This is a placeholder for the actual video processing implementation
-    Q_UNUSED(params)
-    
-    qCDebug(videoProcessor) << "Applying deinterlacing";
+    emit filterChainChanged(getFilterChain());
 }
 
 float VideoProcessor::clampParameter(float value, float min, float max) const
@@ -0,0 +1,579 @@
+#include "video/VideoUpscaler.h"
+#include <QLoggingCategory>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EONPLAY_UPSCALER_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define EONPLAY_UPSCALER_NEON
+#include <arm_neon.h>
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(videoUpscaler)
+Q_LOGGING_CATEGORY(videoUpscaler, "video.upscaler")
+
+namespace {
+// Weights are Q14; the horizontal pass leaves Q6 pixels in 16 bits, so the
+// vertical pass ends at Q20
+constexpr int WEIGHT_BITS = 14;
+constexpr int HORIZONTAL_SHIFT = 8;
+constexpr int VERTICAL_SHIFT = 20;
+
+constexpr int MAX_DIMENSION = 16384;
+constexpr int TILE_ROWS = 64;
+constexpr int MIN_TILE_WIDTH = 64;
+constexpr int MIN_BAND_ROWS = 16;
+constexpr int TILE_CACHE_BYTES = 256 * 1024;   // Intermediate rows of one tile, about one core's L2
+
+// Input pixels each model tile sees beyond its edges, so seams match
+constexpr int MODEL_OVERLAP = 8;
+
+double kernelSupport(VideoUpscaler::Kernel kernel)
+{
+    switch (kernel) {
+        case VideoUpscaler::Bilinear: return 1.0;
+        case VideoUpscaler::Bicubic: return 2.0;
+        case VideoUpscaler::Lanczos: return 3.0;
+    }
+    return 1.0;
+}
+
+double kernelWeight(VideoUpscaler::Kernel kernel, double x)
+{
+    x = std::abs(x);
+    switch (kernel) {
+        case VideoUpscaler::Bilinear:
+            return x < 1.0 ? 1.0 - x : 0.0;
+        case VideoUpscaler::Bicubic:
+            // Catmull-Rom (a = -0.5)
+            if (x < 1.0) {
+                return (1.5 * x - 2.5) * x * x + 1.0;
+            }
+            return x < 2.0 ? ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0 : 0.0;
+        case VideoUpscaler::Lanczos:
+            if (x < 1e-8) {
+                return 1.0;
+            }
+            if (x >= 3.0) {
+                return 0.0;
+            }
+            return 3.0 * std::sin(M_PI * x) * std::sin(M_PI * x / 3.0) / (M_PI * M_PI * x * x);
+    }
+    return 0.0;
+}
+
+inline quint32 loadPixel(const uchar* pixel)
+{
+    quint32 value;
+    std::memcpy(&value, pixel, sizeof(value));
+    return value;
+}
+
+/**
+ * Horizontal pass: output pixels [x0, x1) of one row, as Q6 16-bit channels.
+ */
+void horizontalRow(const uchar* source, int x0, int x1, const int* first, const qint16* weights, int taps,
+                   qint16* destination)
+{
+    for (int x = x0; x < x1; ++x) {
+        const uchar* pixels = source + first[x] * 4;
+        const qint16* w = weights + x * taps;
+        qint16* out = destination + (x - x0) * 4;
+
+#if defined(EONPLAY_UPSCALER_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i sum = _mm_setzero_si128();
+        int k = 0;
+        for (; k + 1 < taps; k += 2) {
+            // Two pixels, channels interleaved so madd weighs them as a pair
+            const __m128i pair = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + k * 4)), zero);
+            const __m128i interleaved = _mm_unpacklo_epi16(pair, _mm_unpackhi_epi64(pair, pair));
+            const __m128i weight = _mm_set1_epi32(static_cast<int>(static_cast<quint16>(w[k])
+                                                                   | (static_cast<quint32>(static_cast<quint16>(w[k + 1])) << 16)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(interleaved, weight));
+        }
+        if (k < taps) {
+            const __m128i pixel = _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(loadPixel(pixels + k * 4))), zero);
+            const __m128i weight = _mm_set1_epi32(static_cast<quint16>(w[k]));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(pixel, zero), weight));
+        }
+        sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << (HORIZONTAL_SHIFT - 1))), HORIZONTAL_SHIFT);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packs_epi32(sum, sum));
+#elif defined(EONPLAY_UPSCALER_NEON)
+        int32x4_t sum = vdupq_n_s32(0);
+        int k = 0;
+        for (; k + 1 < taps; k += 2) {
+            const int16x8_t pair = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(pixels + k * 4)));
+            sum = vmlal_n_s16(sum, vget_low_s16(pair), w[k]);
+            sum = vmlal_n_s16(sum, vget_high_s16(pair), w[k + 1]);
+        }
+        if (k < taps) {
+            const uint8x8_t bytes = vreinterpret_u8_u32(vdup_n_u32(loadPixel(pixels + k * 4)));
+            sum = vmlal_n_s16(sum, vget_low_s16(vreinterpretq_s16_u16(vmovl_u8(bytes))), w[k]);
+        }
+        vst1_s16(out, vqmovn_s32(vrshrq_n_s32(sum, HORIZONTAL_SHIFT)));
+#else
+        int sum[4] = {0, 0, 0, 0};
+        for (int k = 0; k < taps; ++k) {
+            for (int channel = 0; channel < 4; ++channel) {
+                sum[channel] += pixels[k * 4 + channel] * w[k];
+            }
+        }
+        for (int channel = 0; channel < 4; ++channel) {
+            const int value = (sum[channel] + (1 << (HORIZONTAL_SHIFT - 1))) >> HORIZONTAL_SHIFT;
+            out[channel] = static_cast<qint16>(qBound(-32768, value, 32767));
+        }
+#endif
+    }
+}
+
+/**
+ * Vertical pass: one output row of `count` channels from `taps` intermediate rows.
+ */
+void verticalRow(const qint16* rows, int rowStride, const qint16* w, int taps, int count, uchar* destination)
+{
+    int i = 0;
+#if defined(EONPLAY_UPSCALER_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(1 << (VERTICAL_SHIFT - 1));
+    for (; i + 8 <= count; i += 8) {
+        __m128i low = _mm_setzero_si128();
+        __m128i high = _mm_setzero_si128();
+        int k = 0;
+        for (; k + 1 < taps; k += 2) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + k * rowStride + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + (k + 1) * rowStride + i));
+            const __m128i weight = _mm_set1_epi32(static_cast<int>(static_cast<quint16>(w[k])
+                                                                   | (static_cast<quint32>(static_cast<quint16>(w[k + 1])) << 16)));
+            low = _mm_add_epi32(low, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), weight));
+            high = _mm_add_epi32(high, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), weight));
+        }
+        if (k < taps) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + k * rowStride + i));
+            const __m128i weight = _mm_set1_epi32(static_cast<quint16>(w[k]));
+            low = _mm_add_epi32(low, _mm_madd_epi16(_mm_unpacklo_epi16(a, zero), weight));
+            high = _mm_add_epi32(high, _mm_madd_epi16(_mm_unpackhi_epi16(a, zero), weight));
+        }
+        low = _mm_srai_epi32(_mm_add_epi32(low, rounding), VERTICAL_SHIFT);
+        high = _mm_srai_epi32(_mm_add_epi32(high, rounding), VERTICAL_SHIFT);
+        const __m128i words = _mm_packs_epi32(low, high);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(destination + i), _mm_packus_epi16(words, words));
+    }
+#elif defined(EONPLAY_UPSCALER_NEON)
+    for (; i + 8 <= count; i += 8) {
+        int32x4_t low = vdupq_n_s32(0);
+        int32x4_t high = vdupq_n_s32(0);
+        for (int k = 0; k < taps; ++k) {
+            const int16x8_t row = vld1q_s16(rows + k * rowStride + i);
+            low = vmlal_n_s16(low, vget_low_s16(row), w[k]);
+            high = vmlal_n_s16(high, vget_high_s16(row), w[k]);
+        }
+        const uint16x8_t words = vcombine_u16(vqmovun_s32(vrshrq_n_s32(low, VERTICAL_SHIFT)),
+                                              vqmovun_s32(vrshrq_n_s32(high, VERTICAL_SHIFT)));
+        vst1_u8(destination + i, vqmovn_u16(words));
+    }
+#endif
+    for (; i < count; ++i) {
+        int sum = 0;
+        for (int k = 0; k < taps; ++k) {
+            sum += rows[k * rowStride + i] * w[k];
+        }
+        destination[i] = static_cast<uchar>(qBound(0, (sum + (1 << (VERTICAL_SHIFT - 1))) >> VERTICAL_SHIFT, 255));
+    }
+}
+}
+
+/**
+ * Runs the model over the input band by band and serves its output as a
+ * RowSource, keeping only the input rows and output band in use.
+ */
+class VideoUpscaler::ModelStage
+{
+public:
+    ModelStage(std::shared_ptr<SuperResolutionModel> model, const QSize& inputSize)
+        : m_model(std::move(model))
+        , m_inputSize(inputSize)
+        , m_scale(qMax(1, m_model->scale()))
+        , m_tile(qMax(16, m_model->tileSize()))
+    {
+    }
+
+    QSize outputSize() const { return m_inputSize * m_scale; }
+
+    void reset(const RowSource* source)
+    {
+        m_source = source;
+        m_pulled = 0;
+        m_windowFirst = 0;
+        m_bandFirst = 0;
+        m_bandRows = 0;
+    }
+
+    bool read(uchar* rows, int first, int count, int stride)
+    {
+        const int outputStride = outputSize().width() * 4;
+        while (count > 0) {
+            if (first < m_bandFirst || first >= m_bandFirst + m_bandRows) {
+                if (!runBand(first / m_scale / m_tile * m_tile)) {
+                    return false;
+                }
+            }
+            const int available = qMin(count, m_bandFirst + m_bandRows - first);
+            for (int row = 0; row < available; ++row) {
+                std::memcpy(rows + row * stride, m_band.constData() + (first - m_bandFirst + row) * outputStride, outputStride);
+            }
+            rows += available * stride;
+            first += available;
+            count -= available;
+        }
+        return true;
+    }
+
+    bool drain()
+    {
+        return pullUntil(m_inputSize.height());
+    }
+
+private:
+    bool pullUntil(int end)
+    {
+        const int stride = m_inputSize.width() * 4;
+        if (end <= m_pulled) {
+            return true;
+        }
+        m_window.resize((end - m_windowFirst) * stride);
+        if (!(*m_source)(m_window.data() + (m_pulled - m_windowFirst) * stride, m_pulled, end - m_pulled, stride)) {
+            return false;
+        }
+        m_pulled = end;
+        return true;
+    }
+
+    bool runBand(int top)
+    {
+        const int stride = m_inputSize.width() * 4;
+        const int bottom = qMin(m_inputSize.height(), top + m_tile);
+        const int contextTop = qMax(0, top - MODEL_OVERLAP);
+        const int contextBottom = qMin(m_inputSize.height(), bottom + MODEL_OVERLAP);
+
+        // Keep the rows of this band and its context, drop the rest
+        if (contextTop > m_windowFirst) {
+            const int drop = qMin(contextTop, m_pulled) - m_windowFirst;
+            std::memmove(m_window.data(), m_window.constData() + drop * stride, (m_pulled - m_windowFirst - drop) * stride);
+            m_windowFirst += drop;
+        }
+        if (!pullUntil(contextBottom)) {
+            return false;
+        }
+
+        const int outputStride = outputSize().width() * 4;
+        m_band.resize((bottom - top) * m_scale * outputStride);
+        for (int left = 0; left < m_inputSize.width(); left += m_tile) {
+            const int right = qMin(m_inputSize.width(), left + m_tile);
+            const int contextLeft = qMax(0, left - MODEL_OVERLAP);
+            const int contextRight = qMin(m_inputSize.width(), right + MODEL_OVERLAP);
+            const QSize tileSize(contextRight - contextLeft, contextBottom - contextTop);
+
+            const int tileStride = tileSize.width() * m_scale * 4;
+            m_tileOutput.resize(tileSize.height() * m_scale * tileStride);
+            const uchar* input = m_window.constData() + (contextTop - m_windowFirst) * stride + contextLeft * 4;
+            if (!m_model->upscaleTile(input, stride, tileSize, m_tileOutput.data(), tileStride)) {
+                qCWarning(videoUpscaler) << "Super-resolution model failed on a tile";
+                return false;
+            }
+
+            // Only the tile's interior is kept; the overlap just feeds the model context
+            const int offsetX = (left - contextLeft) * m_scale;
+            const int offsetY = (top - contextTop) * m_scale;
+            for (int row = 0; row < (bottom - top) * m_scale; ++row) {
+                std::memcpy(m_band.data() + row * outputStride + left * m_scale * 4,
+                            m_tileOutput.constData() + (offsetY + row) * tileStride + offsetX * 4,
+                            (right - left) * m_scale * 4);
+            }
+        }
+
+        m_bandFirst = top * m_scale;
+        m_bandRows = (bottom - top) * m_scale;
+        return true;
+    }
+
+    std::shared_ptr<SuperResolutionModel> m_model;
+    QSize m_inputSize;
+    int m_scale;
+    int m_tile;
+
+    const RowSource* m_source = nullptr;
+    int m_pulled = 0;
+    int m_windowFirst = 0;
+    QVector<uchar> m_window;
+    QVector<uchar> m_tileOutput;
+    QVector<uchar> m_band;
+    int m_bandFirst = 0;
+    int m_bandRows = 0;
+};
+
+VideoUpscaler::VideoUpscaler(const Options& options)
+    : m_options(options)
+    , m_bandHeight(0)
+    , m_tileWidth(0)
+{
+    m_options.threads = qMax(1, m_options.threads);
+    m_pool.setMaxThreadCount(qMax(1, m_options.threads - 1));
+}
+
+VideoUpscaler::~VideoUpscaler()
+{
+    m_pool.waitForDone();
+}
+
+void VideoUpscaler::setModel(std::shared_ptr<SuperResolutionModel> model)
+{
+    m_model = std::move(model);
+}
+
+bool VideoUpscaler::configure(const QSize& inputSize, const QSize& outputSize)
+{
+    if (inputSize.isEmpty() || outputSize.isEmpty()
+        || inputSize.width() > MAX_DIMENSION || inputSize.height() > MAX_DIMENSION
+        || outputSize.width() > MAX_DIMENSION || outputSize.height() > MAX_DIMENSION) {
+        return false;
+    }
+
+    m_inputSize = inputSize;
+    m_outputSize = outputSize;
+    m_modelStage.reset();
+    m_kernelInputSize = inputSize;
+    if (m_model) {
+        m_modelStage = std::make_unique<ModelStage>(m_model, inputSize);
+        m_kernelInputSize = m_modelStage->outputSize();
+        if (m_kernelInputSize.width() > MAX_DIMENSION || m_kernelInputSize.height() > MAX_DIMENSION) {
+            return false;
+        }
+    }
+
+    m_horizontal = buildAxis(m_kernelInputSize.width(), outputSize.width(), m_options.kernel);
+    m_vertical = buildAxis(m_kernelInputSize.height(), outputSize.height(), m_options.kernel);
+
+    // Bands: the input rows they read plus their own rows fit in the budget
+    const qint64 budget = m_options.memoryBudget > 0 ? m_options.memoryBudget : DEFAULT_MEMORY_BUDGET;
+    const qint64 inputStride = qint64(m_kernelInputSize.width()) * 4;
+    const qint64 outputStride = qint64(outputSize.width()) * 4;
+    const double inputRowsPerRow = static_cast<double>(m_kernelInputSize.height()) / outputSize.height();
+    const double perRow = outputStride + inputRowsPerRow * inputStride;
+    const qint64 available = budget - m_vertical.taps * inputStride;
+    m_bandHeight = qBound(qMin(outputSize.height(), MIN_BAND_ROWS),
+                          static_cast<int>(qMax<qint64>(0, available) / perRow),
+                          outputSize.height());
+
+    // Tiles: the 16-bit intermediate rows one tile needs stay in cache
+    const int tileInputRows = qCeil(qMin(TILE_ROWS, m_bandHeight) * inputRowsPerRow) + m_vertical.taps;
+    m_tileWidth = qBound(qMin(outputSize.width(), MIN_TILE_WIDTH),
+                         TILE_CACHE_BYTES / (tileInputRows * 4 * int(sizeof(qint16))),
+                         outputSize.width());
+
+    qCDebug(videoUpscaler) << inputSize << "->" << outputSize << "in bands of" << m_bandHeight
+                           << "rows, tiles" << m_tileWidth << "wide, using" << simdBackend();
+    return true;
+}
+
+bool VideoUpscaler::process(const RowSource& source, const RowSink& sink)
+{
+    if (m_outputSize.isEmpty()) {
+        return false;
+    }
+    if (!m_modelStage) {
+        return resample(source, sink);
+    }
+
+    m_modelStage->reset(&source);
+    const RowSource scaled = [this](uchar* rows, int first, int count, int stride) {
+        return m_modelStage->read(rows, first, count, stride);
+    };
+    return resample(scaled, sink) && m_modelStage->drain();
+}
+
+QImage VideoUpscaler::scale(const QImage& image, const QSize& outputSize)
+{
+    if (image.isNull()) {
+        return QImage();
+    }
+
+    // Byte-ordered RGBA, as models expect; the kernel itself takes any 4-byte format
+    const QImage input = image.format() == QImage::Format_RGBA8888 || image.format() == QImage::Format_RGBX8888
+                             ? image : image.convertToFormat(QImage::Format_RGBA8888);
+    if (!configure(input.size(), outputSize)) {
+        return QImage();
+    }
+
+    QImage output(outputSize, input.format());
+    const int inputBytes = input.width() * 4;
+    const int outputBytes = output.width() * 4;
+    const bool success = process(
+        [&input, inputBytes](uchar* rows, int first, int count, int stride) {
+            for (int row = 0; row < count; ++row) {
+                std::memcpy(rows + row * stride, input.constScanLine(first + row), inputBytes);
+            }
+            return true;
+        },
+        [&output, outputBytes](const uchar* rows, int first, int count, int stride) {
+            for (int row = 0; row < count; ++row) {
+                std::memcpy(output.scanLine(first + row), rows + row * stride, outputBytes);
+            }
+            return true;
+        });
+    return success ? output : QImage();
+}
+
+QString VideoUpscaler::simdBackend()
+{
+#if defined(EONPLAY_UPSCALER_SSE2)
+    return QStringLiteral("SSE2");
+#elif defined(EONPLAY_UPSCALER_NEON)
+    return QStringLiteral("NEON");
+#else
+    return QStringLiteral("Scalar");
+#endif
+}
+
+VideoUpscaler::Axis VideoUpscaler::buildAxis(int inputSize, int outputSize, Kernel kernel)
+{
+    // Downscaling widens the kernel so every input pixel contributes
+    const double ratio = static_cast<double>(inputSize) / outputSize;
+    const double stretch = qMax(1.0, ratio);
+    const double support = kernelSupport(kernel) * stretch;
+
+    Axis axis;
+    axis.taps = qMin(inputSize, static_cast<int>(std::ceil(support * 2.0)) + 1);
+    axis.first.resize(outputSize);
+    axis.weights.fill(0, outputSize * axis.taps);
+
+    std::vector<double> weights(axis.taps);
+    for (int i = 0; i < outputSize; ++i) {
+        const double center = (i + 0.5) * ratio - 0.5;
+        const int left = static_cast<int>(std::floor(center - support)) + 1;
+        const int start = qBound(0, left, inputSize - axis.taps);
+        axis.first[i] = start;
+
+        // Taps past the edges fold onto the edge pixels
+        std::fill(weights.begin(), weights.end(), 0.0);
+        double total = 0.0;
+        for (int k = 0; k < axis.taps; ++k) {
+            const int position = left + k;
+            const double weight = kernelWeight(kernel, (position - center) / stretch);
+            weights[qBound(0, position, inputSize - 1) - start] += weight;
+            total += weight;
+        }
+
+        qint16* fixed = axis.weights.data() + i * axis.taps;
+        int sum = 0;
+        int largest = 0;
+        for (int k = 0; k < axis.taps; ++k) {
+            fixed[k] = static_cast<qint16>(qRound(weights[k] / total * (1 << WEIGHT_BITS)));
+            sum += fixed[k];
+            largest = fixed[k] > fixed[largest] ? k : largest;
+        }
+        fixed[largest] = static_cast<qint16>(fixed[largest] + (1 << WEIGHT_BITS) - sum);
+    }
+    return axis;
+}
+
+void VideoUpscaler::parallelFor(int count, const std::function<void(int index)>& body)
+{
+    for (int i = 1; i < count; ++i) {
+        m_pool.start([&body, i]() { body(i); });
+    }
+    if (count > 0) {
+        body(0);
+    }
+    m_pool.waitForDone();
+}
+
+bool VideoUpscaler::resample(const RowSource& source, const RowSink& sink)
+{
+    const int inputStride = m_kernelInputSize.width() * 4;
+    const int outputStride = m_outputSize.width() * 4;
+    const int inputHeight = m_kernelInputSize.height();
+    m_band.resize(m_bandHeight * outputStride);
+
+    int windowFirst = 0;
+    int pulled = 0;
+    auto pullUntil = [&](int end) {
+        if (end <= pulled) {
+            return true;
+        }
+        m_window.resize((end - windowFirst) * inputStride);
+        if (!source(m_window.data() + (pulled - windowFirst) * inputStride, pulled, end - pulled, inputStride)) {
+            return false;
+        }
+        pulled = end;
+        return true;
+    };
+
+    for (int bandFirst = 0; bandFirst < m_outputSize.height(); bandFirst += m_bandHeight) {
+        const int bandEnd = qMin(m_outputSize.height(), bandFirst + m_bandHeight);
+        const int rowsFirst = m_vertical.first[bandFirst];
+        const int rowsEnd = m_vertical.first[bandEnd - 1] + m_vertical.taps;
+
+        if (!pullUntil(rowsEnd)) {
+            return false;
+        }
+        if (rowsFirst > windowFirst) {
+            // Earlier rows are done with: later bands start at or below rowsFirst
+            const int drop = rowsFirst - windowFirst;
+            std::memmove(m_window.data(), m_window.constData() + drop * inputStride, (pulled - rowsFirst) * inputStride);
+            windowFirst = rowsFirst;
+        }
+
+        const int columns = (m_outputSize.width() + m_tileWidth - 1) / m_tileWidth;
+        const int rows = (bandEnd - bandFirst + TILE_ROWS - 1) / TILE_ROWS;
+        parallelFor(columns * rows, [&](int tile) {
+            const int x0 = (tile % columns) * m_tileWidth;
+            const int y0 = bandFirst + (tile / columns) * TILE_ROWS;
+            resampleTile(x0, qMin(m_outputSize.width(), x0 + m_tileWidth), y0, qMin(bandEnd, y0 + TILE_ROWS),
+                         windowFirst, m_band.data(), bandFirst);
+        });
+
+        if (!sink(m_band.constData(), bandFirst, bandEnd - bandFirst, outputStride)) {
+            return false;
+        }
+    }
+
+    // Read what no band needed, so a stream of frames stays in step
+    windowFirst = pulled;
+    while (pulled < inputHeight) {
+        if (!pullUntil(qMin(inputHeight, pulled + MIN_BAND_ROWS))) {
+            return false;
+        }
+        windowFirst = pulled;
+    }
+    return true;
+}
+
+void VideoUpscaler::resampleTile(int x0, int x1, int y0, int y1, int windowFirst, uchar* band, int bandFirst)
+{
+    const int inputStride = m_kernelInputSize.width() * 4;
+    const int outputStride = m_outputSize.width() * 4;
+    const int rowsFirst = m_vertical.first[y0];
+    const int rowsEnd = m_vertical.first[y1 - 1] + m_vertical.taps;
+    const int channels = (x1 - x0) * 4;
+
+    thread_local std::vector<qint16> intermediate;
+    intermediate.resize(static_cast<size_t>(rowsEnd - rowsFirst) * channels);
+
+    for (int row = rowsFirst; row < rowsEnd; ++row) {
+        horizontalRow(m_window.constData() + (row - windowFirst) * inputStride, x0, x1,
+                      m_horizontal.first.constData(), m_horizontal.weights.constData(), m_horizontal.taps,
+                      intermediate.data() + (row - rowsFirst) * channels);
+    }
+
+    for (int y = y0; y < y1; ++y) {
+        verticalRow(intermediate.data() + (m_vertical.first[y] - rowsFirst) * channels, channels,
+                    m_vertical.weights.constData() + y * m_vertical.taps, m_vertical.taps, channels,
+                    band + (y - bandFirst) * outputStride + x0 * 4);
+    }
+}
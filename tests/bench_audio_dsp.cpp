@@ -0,0 +1,292 @@
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <functional>
+#include <memory>
+#include "audio/AdvancedAudioProcessor.h"
+#include "audio/AudioDSPGraph.h"
+#include "audio/AudioEqualizer.h"
+#include "audio/AudioOutputManager.h"
+#include "audio/AudioProcessor.h"
+#include "audio/AudioVisualizer.h"
+#include "audio/BiquadCascade.h"
+#include "audio/PolyphaseResampler.h"
+
+/**
+ * @brief Per-sample cost of the audio DSP stages
+ *
+ * Runs every stage on its own, and the full AudioDSPGraph chain (karaoke,
+ * noise reduction, equalizer, binaural spatial sound), over stereo noise
+ * at common buffer sizes and sample rates. Each row reports nanoseconds per
+ * stereo sample frame and the real-time factor, the seconds of audio
+ * processed per second of CPU time, and sets ns per frame as the QtTest
+ * result. If $EONPLAY_BENCH_JSON names a file, all rows are also written
+ * there as JSON for regression tracking.
+ */
+class BenchAudioDSP : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void benchEqualizer_data();
+    void benchEqualizer();
+    void benchSpatialSound_data();
+    void benchSpatialSound();
+    void benchAdvancedProcessor_data();
+    void benchAdvancedProcessor();
+    void benchKaraoke_data();
+    void benchKaraoke();
+    void benchVisualizer_data();
+    void benchVisualizer();
+    void benchResampler_data();
+    void benchResampler();
+    void benchFullChain_data();
+    void benchFullChain();
+
+private:
+    using Stage = std::function<void(float* left, float* right, int frames, int sampleRate)>;
+
+    static void addFormatRows();
+    void measure(const char* stage, const Stage& process);
+
+    std::shared_ptr<AudioEqualizer> m_equalizer;
+    std::shared_ptr<AudioOutputManager> m_outputManager;
+    std::shared_ptr<AdvancedAudioProcessor> m_advancedProcessor;
+    std::shared_ptr<AudioProcessor> m_audioProcessor;
+    std::unique_ptr<AudioVisualizer> m_visualizer;
+    QJsonArray m_results;
+
+    static constexpr qint64 MIN_MEASURE_NS = 200000000;    // Per row
+    static constexpr int MIN_BUFFERS = 20;
+    static constexpr int WARMUP_BUFFERS = 8;
+};
+
+void BenchAudioDSP::initTestCase()
+{
+    // Keep the equalizer's settings file out of the user's configuration
+    QStandardPaths::setTestModeEnabled(true);
+
+    m_equalizer = std::make_shared<AudioEqualizer>();
+    m_equalizer->applyPreset(AudioEqualizer::Rock);
+    m_equalizer->setEnabled(true);
+
+    m_outputManager = std::make_shared<AudioOutputManager>();
+    m_outputManager->setSpatialSoundMode(AudioOutputManager::Headphones);
+    m_outputManager->setHrtfSuspended(false);
+
+    m_advancedProcessor = std::make_shared<AdvancedAudioProcessor>();
+    AdvancedAudioProcessor::NoiseReductionSettings noiseReduction;
+    noiseReduction.enabled = true;
+    m_advancedProcessor->setNoiseReductionSettings(noiseReduction);
+    m_advancedProcessor->setNoiseReductionSuspended(false);
+
+    m_audioProcessor = std::make_shared<AudioProcessor>();
+    m_audioProcessor->setKaraokeMode(AudioProcessor::VocalRemoval);
+
+    m_visualizer = std::make_unique<AudioVisualizer>();
+
+    qInfo("Biquad backend %s, resampler backend %s", qPrintable(BiquadCascade::simdBackend()),
+          qPrintable(PolyphaseResampler::simdBackend()));
+}
+
+void BenchAudioDSP::cleanupTestCase()
+{
+    const QString path = qEnvironmentVariable("EONPLAY_BENCH_JSON");
+    if (path.isEmpty()) {
+        return;
+    }
+
+    QJsonObject report;
+    report["benchmark"] = "bench_audio_dsp";
+    report["biquadBackend"] = BiquadCascade::simdBackend();
+    report["resamplerBackend"] = PolyphaseResampler::simdBackend();
+    report["results"] = m_results;
+
+    QFile file(path);
+    QVERIFY2(file.open(QIODevice::WriteOnly | QIODevice::Truncate), qPrintable(path));
+    file.write(QJsonDocument(report).toJson());
+}
+
+void BenchAudioDSP::addFormatRows()
+{
+    QTest::addColumn<int>("frames");
+    QTest::addColumn<int>("sampleRate");
+
+    for (int sampleRate : {44100, 48000, 96000}) {
+        for (int frames : {256, 1024, 4096}) {
+            QTest::addRow("%d frames @ %d Hz", frames, sampleRate) << frames << sampleRate;
+        }
+    }
+}
+
+void BenchAudioDSP::measure(const char* stage, const Stage& process)
+{
+    QFETCH(int, frames);
+    QFETCH(int, sampleRate);
+
+    QVector<float> sourceLeft(frames);
+    QVector<float> sourceRight(frames);
+    QRandomGenerator random(frames ^ sampleRate);
+    for (int i = 0; i < frames; ++i) {
+        sourceLeft[i] = static_cast<float>(random.generateDouble() * 0.5 - 0.25);
+        sourceRight[i] = 0.6f * sourceLeft[i] + static_cast<float>(random.generateDouble() * 0.2 - 0.1);
+    }
+
+    // Stages work in place, so every buffer starts from the same input
+    QVector<float> left(frames);
+    QVector<float> right(frames);
+    auto runBuffer = [&]() {
+        std::copy(sourceLeft.constBegin(), sourceLeft.constEnd(), left.begin());
+        std::copy(sourceRight.constBegin(), sourceRight.constEnd(), right.begin());
+        process(left.data(), right.data(), frames, sampleRate);
+    };
+
+    for (int i = 0; i < WARMUP_BUFFERS; ++i) {
+        runBuffer();
+    }
+
+    QElapsedTimer timer;
+    qint64 buffers = 0;
+    qint64 elapsedNs = 0;
+    timer.start();
+    while (elapsedNs < MIN_MEASURE_NS || buffers < MIN_BUFFERS) {
+        runBuffer();
+        ++buffers;
+        elapsedNs = timer.nsecsElapsed();
+    }
+
+    const double processedFrames = static_cast<double>(buffers) * frames;
+    const double nsPerFrame = elapsedNs / processedFrames;
+    const double realtimeFactor = (processedFrames / sampleRate) / (elapsedNs * 1e-9);
+
+    qInfo("%s, %d frames @ %d Hz: %.2f ns/frame, %.0fx real time", stage, frames, sampleRate,
+          nsPerFrame, realtimeFactor);
+    QTest::setBenchmarkResult(nsPerFrame, QTest::WalltimeNanoseconds);
+
+    QJsonObject row;
+    row["stage"] = stage;
+    row["frames"] = frames;
+    row["sampleRate"] = sampleRate;
+    row["nsPerFrame"] = nsPerFrame;
+    row["realtimeFactor"] = realtimeFactor;
+    m_results.append(row);
+}
+
+void BenchAudioDSP::benchEqualizer_data()
+{
+    addFormatRows();
+}
+
+void BenchAudioDSP::benchEqualizer()
+{
+    measure("equalizer", [this](float* left, float* right, int frames, int sampleRate) {
+        m_equalizer->processBlock(left, right, frames, sampleRate);
+    });
+}
+
+void BenchAudioDSP::benchSpatialSound_data()
+{
+    addFormatRows();
+}
+
+void BenchAudioDSP::benchSpatialSound()
+{
+    measure("spatial", [this](float* left, float* right, int frames, int sampleRate) {
+        m_outputManager->processSpatialBlock(left, right, frames, sampleRate);
+    });
+}
+
+void BenchAudioDSP::benchAdvancedProcessor_data()
+{
+    addFormatRows();
+}
+
+void BenchAudioDSP::benchAdvancedProcessor()
+{
+    measure("advanced", [this](float* left, float* right, int frames, int sampleRate) {
+        m_advancedProcessor->processAdvancedBlock(left, right, frames, sampleRate);
+    });
+}
+
+void BenchAudioDSP::benchKaraoke_data()
+{
+    addFormatRows();
+}
+
+void BenchAudioDSP::benchKaraoke()
+{
+    measure("karaoke", [this](float* left, float* right, int frames, int sampleRate) {
+        m_audioProcessor->processKaraokeBlock(left, right, frames, sampleRate);
+    });
+}
+
+void BenchAudioDSP::benchVisualizer_data()
+{
+    addFormatRows();
+}
+
+void BenchAudioDSP::benchVisualizer()
+{
+    // The visualizer copies what it is given, so the sample is built once
+    AudioVisualizer::AudioSample sample;
+    measure("visualizer", [this, &sample](float* left, float* right, int frames, int sampleRate) {
+        if (sample.leftChannel.size() != frames) {
+            sample.leftChannel = QVector<float>(left, left + frames);
+            sample.rightChannel = QVector<float>(right, right + frames);
+            sample.sampleRate = sampleRate;
+        }
+        m_visualizer->processAudioSample(sample);
+    });
+}
+
+void BenchAudioDSP::benchResampler_data()
+{
+    addFormatRows();
+}
+
+void BenchAudioDSP::benchResampler()
+{
+    // Converts to 48 kHz, or to 44.1 kHz from 48 kHz
+    PolyphaseResampler resampler;
+    QVector<float> outputLeft;
+    QVector<float> outputRight;
+    measure("resampler", [&](float* left, float* right, int frames, int sampleRate) {
+        if (resampler.inputRate() != sampleRate) {
+            resampler.setRates(sampleRate, sampleRate == 48000 ? 44100 : 48000);
+            outputLeft.resize(resampler.maxOutputFrames(frames));
+            outputRight.resize(resampler.maxOutputFrames(frames));
+        }
+        resampler.process(left, right, frames, outputLeft.data(), outputRight.data());
+    });
+}
+
+void BenchAudioDSP::benchFullChain_data()
+{
+    addFormatRows();
+}
+
+void BenchAudioDSP::benchFullChain()
+{
+    QFETCH(int, sampleRate);
+
+    AudioDSPGraph graph;
+    graph.addNode(std::make_shared<KaraokeNode>(m_audioProcessor), AudioDSPGraph::KaraokeStage);
+    graph.addNode(std::make_shared<AdvancedProcessorNode>(m_advancedProcessor), AudioDSPGraph::AdvancedStage);
+    graph.addNode(std::make_shared<EqualizerNode>(m_equalizer), AudioDSPGraph::EqualizerStage);
+    graph.addNode(std::make_shared<SpatialSoundNode>(m_outputManager), AudioDSPGraph::SpatialStage);
+    graph.compile(sampleRate);
+
+    measure("chain", [&graph](float* left, float* right, int frames, int sampleRate) {
+        graph.process(left, right, frames, sampleRate);
+    });
+}
+
+QTEST_MAIN(BenchAudioDSP)
+#include "bench_audio_dsp.moc"
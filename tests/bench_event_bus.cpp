@@ -0,0 +1,185 @@
+#include <QtTest/QtTest>
+#include <QThread>
+#include <atomic>
+#include "EventBus.h"
+
+namespace {
+
+struct PositionUpdate
+{
+    qint64 position;
+    qint64 duration;
+};
+
+} // namespace
+
+/**
+ * @brief Publish throughput of the EventBus dispatch paths
+ *
+ * Each benchmark publishes BATCH events to one subscriber. The string path
+ * is what every publisher used before typed events: a QString lookup and a
+ * QVariantMap payload per event.
+ */
+class BenchEventBus : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void testQueuedDeliveryRunsOnContextThread();
+    void testCoalescedDeliversLatest();
+    void benchStringPublish();
+    void benchTypedDirect();
+    void benchPayloadFree();
+    void benchQueued();
+    void benchCoalesced();
+
+private:
+    static constexpr int BATCH = 10000;
+};
+
+void BenchEventBus::init()
+{
+    EventBus::instance().clear();
+}
+
+void BenchEventBus::cleanup()
+{
+    EventBus::instance().clear();
+}
+
+void BenchEventBus::testQueuedDeliveryRunsOnContextThread()
+{
+    EventBus& bus = EventBus::instance();
+    const EventTypeId type = bus.typeId("bench.position");
+
+    QThread worker;
+    QObject context;
+    context.moveToThread(&worker);
+    worker.start();
+
+    std::atomic<int> received{0};
+    std::atomic<bool> onWorker{true};
+    bus.subscribe<PositionUpdate>(type, &context, [&](const PositionUpdate&) {
+        onWorker = onWorker && QThread::currentThread() == &worker;
+        ++received;
+    });
+
+    for (int i = 0; i < 100; ++i) {
+        bus.publish(type, PositionUpdate{i, 100});
+    }
+
+    QTRY_COMPARE(received.load(), 100);
+    QVERIFY(onWorker);
+
+    worker.quit();
+    worker.wait();
+}
+
+void BenchEventBus::testCoalescedDeliversLatest()
+{
+    EventBus& bus = EventBus::instance();
+    const EventTypeId type = bus.typeId("bench.position");
+
+    QList<qint64> positions;
+    bus.subscribe<PositionUpdate>(type, this, [&](const PositionUpdate& update) {
+        positions << update.position;
+    }, EventBus::Delivery::Coalesced);
+
+    for (int i = 0; i < 100; ++i) {
+        bus.publish(type, PositionUpdate{i, 100});
+    }
+    QCoreApplication::sendPostedEvents(this);
+
+    QCOMPARE(positions, QList<qint64>{99});
+}
+
+void BenchEventBus::benchStringPublish()
+{
+    EventBus& bus = EventBus::instance();
+    qint64 sum = 0;
+    bus.subscribe("bench.position", [&](const Event& event) {
+        sum += event.data.value("position").toLongLong();
+    });
+
+    QBENCHMARK {
+        for (int i = 0; i < BATCH; ++i) {
+            bus.publish("bench.position", {{"position", i}, {"duration", BATCH}});
+        }
+    }
+    QVERIFY(sum > 0);
+}
+
+void BenchEventBus::benchTypedDirect()
+{
+    EventBus& bus = EventBus::instance();
+    const EventTypeId type = bus.typeId("bench.position");
+    qint64 sum = 0;
+    bus.subscribe<PositionUpdate>(type, this, [&](const PositionUpdate& update) {
+        sum += update.position;
+    });
+
+    QBENCHMARK {
+        for (int i = 0; i < BATCH; ++i) {
+            bus.publish(type, PositionUpdate{i, BATCH});
+        }
+    }
+    QVERIFY(sum > 0);
+}
+
+void BenchEventBus::benchPayloadFree()
+{
+    EventBus& bus = EventBus::instance();
+    const EventTypeId type = bus.typeId("bench.tick");
+    int count = 0;
+    bus.subscribe(type, this, [&]() {
+        ++count;
+    });
+
+    QBENCHMARK {
+        for (int i = 0; i < BATCH; ++i) {
+            bus.publish(type);
+        }
+    }
+    QVERIFY(count > 0);
+}
+
+void BenchEventBus::benchQueued()
+{
+    EventBus& bus = EventBus::instance();
+    const EventTypeId type = bus.typeId("bench.position");
+    qint64 sum = 0;
+    bus.subscribe<PositionUpdate>(type, this, [&](const PositionUpdate& update) {
+        sum += update.position;
+    }, EventBus::Delivery::Queued);
+
+    QBENCHMARK {
+        for (int i = 0; i < BATCH; ++i) {
+            bus.publish(type, PositionUpdate{i, BATCH});
+        }
+        QCoreApplication::sendPostedEvents(this);
+    }
+    QVERIFY(sum > 0);
+}
+
+void BenchEventBus::benchCoalesced()
+{
+    EventBus& bus = EventBus::instance();
+    const EventTypeId type = bus.typeId("bench.position");
+    int deliveries = 0;
+    bus.subscribe<PositionUpdate>(type, this, [&](const PositionUpdate&) {
+        ++deliveries;
+    }, EventBus::Delivery::Coalesced);
+
+    QBENCHMARK {
+        for (int i = 0; i < BATCH; ++i) {
+            bus.publish(type, PositionUpdate{i, BATCH});
+        }
+        QCoreApplication::sendPostedEvents(this);
+    }
+    QVERIFY(deliveries > 0);
+}
+
+QTEST_GUILESS_MAIN(BenchEventBus)
+#include "bench_event_bus.moc"
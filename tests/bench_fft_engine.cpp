@@ -0,0 +1,147 @@
+#include <QtTest/QtTest>
+#include <QRandomGenerator>
+#include <QtMath>
+#include <complex>
+#include "audio/FFTEngine.h"
+
+/**
+ * @brief Microbenchmark for FFTEngine against the legacy per-band DFT
+ *
+ * The reference implementation mirrors the code AudioVisualizer::performFFT
+ * used before the shared engine: one qCos/qSin pair per sample per output bin.
+ */
+class BenchFFTEngine : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testForwardMatchesDFT();
+    void testInverseRoundTrip();
+    void benchLegacyDFT_data();
+    void benchLegacyDFT();
+    void benchEngineForward();
+    void benchEngineRoundTrip();
+
+private:
+    static void legacyDFT(const QVector<float>& input, int bins, QVector<float>& magnitudes);
+
+    QVector<float> m_signal;
+
+    static constexpr int FFT_SIZE = 1024;
+};
+
+void BenchFFTEngine::initTestCase()
+{
+    m_signal.resize(FFT_SIZE);
+    for (int i = 0; i < FFT_SIZE; ++i) {
+        m_signal[i] = static_cast<float>(QRandomGenerator::global()->generateDouble() * 2.0 - 1.0);
+    }
+}
+
+void BenchFFTEngine::legacyDFT(const QVector<float>& input, int bins, QVector<float>& magnitudes)
+{
+    int inputSize = qMin(input.size(), FFT_SIZE);
+    QVector<std::complex<float>> fftInput(FFT_SIZE, std::complex<float>(0, 0));
+
+    for (int i = 0; i < inputSize; ++i) {
+        float window = 0.5f * (1.0f - qCos(2.0f * M_PI * i / (inputSize - 1)));
+        fftInput[i] = std::complex<float>(input[i] * window, 0);
+    }
+
+    magnitudes.resize(bins);
+    for (int k = 0; k < bins; ++k) {
+        std::complex<float> sum(0, 0);
+        for (int n = 0; n < FFT_SIZE; ++n) {
+            float angle = -2.0f * M_PI * k * n / FFT_SIZE;
+            sum += fftInput[n] * std::complex<float>(qCos(angle), qSin(angle));
+        }
+        magnitudes[k] = std::abs(sum) / FFT_SIZE;
+    }
+}
+
+void BenchFFTEngine::testForwardMatchesDFT()
+{
+    const FFTEngine& engine = FFTEngine::forSize<FFT_SIZE>();
+    QCOMPARE(engine.size(), FFT_SIZE);
+    QCOMPARE(engine.spectrumSize(), FFT_SIZE / 2 + 1);
+
+    QVector<std::complex<float>> spectrum;
+    engine.forward(m_signal, spectrum);
+
+    for (int k = 0; k < engine.spectrumSize(); k += 7) {
+        std::complex<double> sum(0.0, 0.0);
+        for (int n = 0; n < FFT_SIZE; ++n) {
+            double angle = -2.0 * M_PI * k * n / FFT_SIZE;
+            sum += static_cast<double>(m_signal[n]) * std::complex<double>(qCos(angle), qSin(angle));
+        }
+        QVERIFY(std::abs(sum - std::complex<double>(spectrum[k])) < 1e-3);
+    }
+}
+
+void BenchFFTEngine::testInverseRoundTrip()
+{
+    const FFTEngine& engine = FFTEngine::forSize<FFT_SIZE>();
+
+    QVector<std::complex<float>> spectrum;
+    QVector<float> output;
+    engine.forward(m_signal, spectrum);
+    engine.inverse(spectrum, output);
+
+    QCOMPARE(output.size(), FFT_SIZE);
+    for (int i = 0; i < FFT_SIZE; ++i) {
+        QVERIFY(qAbs(output[i] - m_signal[i]) < 1e-5f);
+    }
+}
+
+void BenchFFTEngine::benchLegacyDFT_data()
+{
+    QTest::addColumn<int>("bins");
+    QTest::newRow("32 bands") << 32;
+    QTest::newRow("256 bands") << 256;
+    QTest::newRow("full spectrum") << FFT_SIZE / 2 + 1;
+}
+
+void BenchFFTEngine::benchLegacyDFT()
+{
+    QFETCH(int, bins);
+    QVector<float> magnitudes;
+
+    QBENCHMARK {
+        legacyDFT(m_signal, bins, magnitudes);
+    }
+}
+
+void BenchFFTEngine::benchEngineForward()
+{
+    const FFTEngine& engine = FFTEngine::forSize<FFT_SIZE>();
+    const QVector<float>& window = engine.hannWindow();
+    QVector<float> windowed(FFT_SIZE);
+    QVector<std::complex<float>> spectrum(engine.spectrumSize());
+    QVector<float> magnitudes(engine.spectrumSize());
+
+    QBENCHMARK {
+        for (int i = 0; i < FFT_SIZE; ++i) {
+            windowed[i] = m_signal[i] * window[i];
+        }
+        engine.forward(windowed.constData(), spectrum.data());
+        for (int k = 0; k < spectrum.size(); ++k) {
+            magnitudes[k] = std::abs(spectrum[k]) / FFT_SIZE;
+        }
+    }
+}
+
+void BenchFFTEngine::benchEngineRoundTrip()
+{
+    const FFTEngine& engine = FFTEngine::forSize<FFT_SIZE>();
+    QVector<std::complex<float>> spectrum(engine.spectrumSize());
+    QVector<float> output(FFT_SIZE);
+
+    QBENCHMARK {
+        engine.forward(m_signal.constData(), spectrum.data());
+        engine.inverse(spectrum.constData(), output.data());
+    }
+}
+
+QTEST_GUILESS_MAIN(BenchFFTEngine)
+#include "bench_fft_engine.moc"
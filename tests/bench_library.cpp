@@ -0,0 +1,472 @@
+#include <QtTest/QtTest>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtMath>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include "data/DatabaseManager.h"
+#include "data/LibraryManager.h"
+#include "data/PlaylistManager.h"
+
+using namespace EonPlay::Data;
+
+/**
+ * @brief Library operations over a synthetic library of 100k+ files
+ *
+ * Generates a tree of sparse media files ($EONPLAY_LIBRARY_FILES, default
+ * 20000) that the scanner walks for real, and times the full scan and
+ * the unchanged and partly changed rescans over it. The database is then
+ * topped up with rows for files outside the tree until it holds
+ * $EONPLAY_LIBRARY_ROWS (default 100000, up to 1M), and search, faceting,
+ * browsing, smart playlist refresh, playlist saves and queue mutation are
+ * timed at that size. Repeated operations report p50 and p99; the QtTest result
+ * is the p99 in milliseconds.
+ *
+ * Artist, album and title words are drawn with a skewed distribution so
+ * the facets and the search index see a realistic mix of very common and
+ * rare values. The data is seeded, so runs are comparable.
+ */
+class BenchLibrary : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void scan();
+    void rescanUnchanged();
+    void rescanChanged();
+    void bulkInsert();
+    void search_data();
+    void search();
+    void facets();
+    void browse();
+    void smartPlaylistRefresh();
+    void playlistSave();
+    void queueMutation();
+
+private:
+    static qreal percentile(QList<qreal> values, qreal fraction);
+    static void report(const char* name, const QList<qreal>& times);
+    static QList<qreal> repeat(int runs, const std::function<void()>& operation);
+    static QString word(QRandomGenerator& random);
+    static QString artistName(int index) { return QStringLiteral("Artist %1").arg(index, 4, 10, QLatin1Char('0')); }
+
+    QString filePath(int index) const;
+    DatabaseManager::MediaFileRow syntheticRow(int index, QRandomGenerator& random) const;
+    qreal runScan(const std::function<void()>& start, int* added = nullptr, int* updated = nullptr);
+
+    QTemporaryDir m_directory;
+    std::unique_ptr<LibraryManager> m_library;
+    std::unique_ptr<PlaylistManager> m_playlists;
+    QString m_mediaRoot;
+    int m_rows = 100000;
+    int m_files = 20000;
+
+    static constexpr int FILES_PER_DIRECTORY = 100;
+    static constexpr int ARTISTS_PER_10K_ROWS = 250;
+    static constexpr int ALBUMS_PER_ARTIST = 8;
+    static constexpr int SCAN_TIMEOUT_MS = 30 * 60 * 1000;
+    static constexpr int SEARCH_RUNS = 50;
+    static constexpr int FACET_RUNS = 50;
+    static constexpr int BROWSE_RUNS = 50;
+    static constexpr int PLAYED_FILES = 2000;
+    static constexpr int SMART_PLAYLISTS = 16;
+    static constexpr int SMART_REFRESH_RUNS = 10;
+    static constexpr int PLAYLIST_SIZE = 1000;
+    static constexpr int PLAYLIST_SAVES = 10;
+    static constexpr int QUEUE_SIZE = 10000;
+    static constexpr int QUEUE_OPERATIONS = 2000;
+};
+
+void BenchLibrary::initTestCase()
+{
+    // Keep the library settings out of the user's configuration
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(m_directory.isValid());
+
+    if (qEnvironmentVariableIsSet("EONPLAY_LIBRARY_ROWS")) {
+        m_rows = qBound(1, qEnvironmentVariableIntValue("EONPLAY_LIBRARY_ROWS"), 1000000);
+    }
+    if (qEnvironmentVariableIsSet("EONPLAY_LIBRARY_FILES")) {
+        m_files = qMax(1, qEnvironmentVariableIntValue("EONPLAY_LIBRARY_FILES"));
+    }
+    m_files = qMin(m_files, m_rows);
+
+    // Sparse files: the scanner sees realistic sizes without the disk use
+    m_mediaRoot = m_directory.filePath("media");
+    QRandomGenerator random(1);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < m_files; ++i) {
+        const QString path = filePath(i);
+        if (i % FILES_PER_DIRECTORY == 0) {
+            QVERIFY(QDir().mkpath(QFileInfo(path).absolutePath()));
+        }
+        QFile file(path);
+        QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable(path));
+        QVERIFY(file.resize(random.bounded(2 * 1024 * 1024, 12 * 1024 * 1024)));
+    }
+    qInfo("Generated %d sparse files in %.1f s", m_files, timer.elapsed() / 1000.0);
+
+    m_library = std::make_unique<LibraryManager>();
+    QVERIFY(m_library->initialize(m_directory.filePath("library.db")));
+
+    // Metadata extraction and loudness analysis would time the decoders
+    LibraryManager::LibrarySettings settings = m_library->librarySettings();
+    settings.libraryPaths = QStringList{m_mediaRoot};
+    settings.autoScanEnabled = false;
+    settings.extractMetadata = false;
+    settings.analyzeLoudness = false;
+    settings.autoCleanup = false;
+    settings.scanOptions.mode = MediaScanner::QuickScan;
+    settings.scanOptions.extractMetadata = false;
+    settings.scanOptions.detectDuplicates = false;
+    m_library->setLibrarySettings(settings);
+
+    m_playlists = std::make_unique<PlaylistManager>(m_library->databaseManager());
+}
+
+void BenchLibrary::cleanupTestCase()
+{
+    m_playlists.reset();
+    if (m_library) {
+        m_library->shutdown();
+    }
+    m_library.reset();
+}
+
+qreal BenchLibrary::percentile(QList<qreal> values, qreal fraction)
+{
+    std::sort(values.begin(), values.end());
+    const qsizetype index = qBound<qsizetype>(0, qCeil(fraction * values.size()) - 1, values.size() - 1);
+    return values[index];
+}
+
+void BenchLibrary::report(const char* name, const QList<qreal>& times)
+{
+    const qreal p50 = percentile(times, 0.50);
+    const qreal p99 = percentile(times, 0.99);
+    qInfo("%s: p50 %.2f ms, p99 %.2f ms (%lld runs)", name, p50, p99, qlonglong(times.size()));
+    QTest::setBenchmarkResult(p99, QTest::WalltimeMilliseconds);
+}
+
+QList<qreal> BenchLibrary::repeat(int runs, const std::function<void()>& operation)
+{
+    QList<qreal> times;
+    times.reserve(runs);
+    QElapsedTimer timer;
+    for (int i = 0; i < runs; ++i) {
+        timer.start();
+        operation();
+        times << timer.nsecsElapsed() / 1e6;
+    }
+    return times;
+}
+
+QString BenchLibrary::word(QRandomGenerator& random)
+{
+    static const char* const words[] = {
+        "love", "night", "heart", "light", "dream", "fire", "rain", "blue", "home", "road",
+        "summer", "river", "shadow", "golden", "wild", "silent", "electric", "midnight", "ocean", "city",
+        "winter", "echo", "paper", "glass", "storm", "velvet", "neon", "harbor", "crimson", "static",
+        "lantern", "meridian", "solstice", "quartz", "tundra", "cascade", "ember", "monsoon", "obsidian", "zephyr"
+    };
+    constexpr int count = sizeof(words) / sizeof(words[0]);
+
+    // Squaring skews the choice towards the start of the list
+    const double u = random.generateDouble();
+    return QString::fromLatin1(words[qMin(count - 1, static_cast<int>(u * u * count))]);
+}
+
+QString BenchLibrary::filePath(int index) const
+{
+    const int directory = index / FILES_PER_DIRECTORY;
+    return QStringLiteral("%1/%2/%3/track%4.%5")
+        .arg(m_mediaRoot)
+        .arg(directory / 100, 3, 10, QLatin1Char('0'))
+        .arg(directory % 100, 2, 10, QLatin1Char('0'))
+        .arg(index, 7, 10, QLatin1Char('0'))
+        .arg(index % 10 == 0 ? QStringLiteral("mkv") : QStringLiteral("mp3"));
+}
+
+DatabaseManager::MediaFileRow BenchLibrary::syntheticRow(int index, QRandomGenerator& random) const
+{
+    // Rows past the tree point at files that do not exist; a rescan would
+    // remove them, so they are only added after the rescans
+    const int artists = qMax(1, m_rows / 10000 * ARTISTS_PER_10K_ROWS);
+    const double u = random.generateDouble();
+    const int artist = static_cast<int>(u * u * artists);
+
+    DatabaseManager::MediaFileRow row;
+    row.filePath = QStringLiteral("%1/offline/%2/track%3.flac")
+        .arg(m_directory.path(), artistName(artist))
+        .arg(index, 7, 10, QLatin1Char('0'));
+    row.title = word(random) + QLatin1Char(' ') + word(random) + QLatin1Char(' ') + QString::number(index);
+    row.artist = artistName(artist);
+    row.album = QStringLiteral("%1 %2").arg(word(random)).arg(random.bounded(ALBUMS_PER_ARTIST));
+    row.duration = random.bounded(90000, 600000);
+    row.fileSize = random.bounded(2 * 1024 * 1024, 60 * 1024 * 1024);
+    return row;
+}
+
+qreal BenchLibrary::runScan(const std::function<void()>& start, int* added, int* updated)
+{
+    QSignalSpy completed(m_library.get(), &LibraryManager::scanCompleted);
+    QElapsedTimer timer;
+    timer.start();
+    start();
+    if (completed.isEmpty() && !completed.wait(SCAN_TIMEOUT_MS)) {
+        return -1.0;
+    }
+    const qreal elapsed = timer.nsecsElapsed() / 1e6;
+
+    if (added) {
+        *added = completed.first().at(0).toInt();
+    }
+    if (updated) {
+        *updated = completed.first().at(1).toInt();
+    }
+    return elapsed;
+}
+
+void BenchLibrary::scan()
+{
+    int added = 0;
+    const qreal elapsed = runScan([this]() { m_library->scanLibrary(); }, &added);
+    QVERIFY2(elapsed >= 0.0, "Scan did not complete");
+
+    qInfo("Full scan: %d files added in %.2f s, %.0f files/s", added, elapsed / 1000.0,
+          m_files / (elapsed / 1000.0));
+    QTest::setBenchmarkResult(elapsed, QTest::WalltimeMilliseconds);
+}
+
+void BenchLibrary::bulkInsert()
+{
+    const int rows = m_rows - m_files;
+    if (rows <= 0) {
+        QSKIP("The file tree already holds every row");
+    }
+
+    DatabaseManager* database = m_library->databaseManager();
+    QRandomGenerator random(2);
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY(database->beginBulkUpsert());
+    for (int i = 0; i < rows; ++i) {
+        QVERIFY(database->bulkUpsertMediaFile(syntheticRow(m_files + i, random)));
+    }
+    QVERIFY(database->endBulkUpsert());
+    const qreal elapsed = timer.nsecsElapsed() / 1e6;
+
+    qInfo("Bulk insert: %d rows in %.2f s, %.0f rows/s, %d rows in the library", rows, elapsed / 1000.0,
+          rows / (elapsed / 1000.0), database->getMediaFileCount());
+    QTest::setBenchmarkResult(elapsed, QTest::WalltimeMilliseconds);
+}
+
+void BenchLibrary::rescanUnchanged()
+{
+    int updated = 0;
+    const qreal elapsed = runScan([this]() { m_library->rescanLibrary(); }, nullptr, &updated);
+    QVERIFY2(elapsed >= 0.0, "Rescan did not complete");
+
+    qInfo("Unchanged rescan: %d files updated in %.2f s", updated, elapsed / 1000.0);
+    QTest::setBenchmarkResult(elapsed, QTest::WalltimeMilliseconds);
+}
+
+void BenchLibrary::rescanChanged()
+{
+    // Grow one file in a hundred so its size and mtime no longer match
+    const int step = 100;
+    for (int i = 0; i < m_files; i += step) {
+        QFile file(filePath(i));
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.resize(file.size() + 4096));
+    }
+
+    int updated = 0;
+    const qreal elapsed = runScan([this]() { m_library->rescanLibrary(); }, nullptr, &updated);
+    QVERIFY2(elapsed >= 0.0, "Rescan did not complete");
+
+    qInfo("Rescan with %d changed files: %d updated in %.2f s", (m_files + step - 1) / step, updated,
+          elapsed / 1000.0);
+    QTest::setBenchmarkResult(elapsed, QTest::WalltimeMilliseconds);
+}
+
+void BenchLibrary::search_data()
+{
+    QTest::addColumn<QString>("term");
+
+    QTest::newRow("common word") << QStringLiteral("love");
+    QTest::newRow("rare word") << QStringLiteral("zephyr");
+    QTest::newRow("two words") << QStringLiteral("midnight ocean");
+    QTest::newRow("prefix") << QStringLiteral("elec");
+    QTest::newRow("artist") << artistName(3);
+    QTest::newRow("no match") << QStringLiteral("xylophonic");
+}
+
+void BenchLibrary::search()
+{
+    QFETCH(QString, term);
+
+    int hits = 0;
+    QList<qreal> times = repeat(SEARCH_RUNS, [this, &term, &hits]() {
+        hits = m_library->searchFileIds(term).size();
+    });
+    qInfo("searchFileIds(\"%s\"): %d hits", qPrintable(term), hits);
+    report("  ids", times);
+
+    times = repeat(SEARCH_RUNS / 5, [this, &term]() {
+        m_library->searchFiles(term);
+    });
+    report("  searchFiles", times);
+}
+
+void BenchLibrary::facets()
+{
+    DatabaseManager* database = m_library->databaseManager();
+
+    report("Library totals", repeat(FACET_RUNS, [database]() {
+        database->getLibraryTotals();
+    }));
+    report("Top 10 artists", repeat(FACET_RUNS, [database]() {
+        database->getFacetAggregates(DatabaseManager::ArtistFacet, true, 10);
+    }));
+    report("All albums by name", repeat(FACET_RUNS / 5, [database]() {
+        database->getFacetAggregates(DatabaseManager::AlbumFacet);
+    }));
+    report("Extensions", repeat(FACET_RUNS, [database]() {
+        database->getFacetAggregates(DatabaseManager::ExtensionFacet);
+    }));
+
+    // The scans left the cached statistics stale, so this is the full refresh
+    QElapsedTimer timer;
+    timer.start();
+    const LibraryManager::LibraryStatistics statistics = m_library->getStatistics();
+    qInfo("getStatistics: %d files, %d audio, %d video in %.2f ms", statistics.totalFiles,
+          statistics.audioFiles, statistics.videoFiles, timer.nsecsElapsed() / 1e6);
+}
+
+void BenchLibrary::browse()
+{
+    DatabaseManager* database = m_library->databaseManager();
+
+    // Nothing has been played yet; play a scattering of files
+    QRandomGenerator random(5);
+    const int rows = database->getMediaFileCount();
+    for (int i = 0; i < PLAYED_FILES; ++i) {
+        database->updatePlayCount(1 + random.bounded(rows));
+    }
+
+    int files = 0;
+    report("Files by artist", repeat(BROWSE_RUNS, [this, &random, &files]() {
+        files = m_library->getFilesByArtist(artistName(random.bounded(50))).size();
+    }));
+    qInfo("  %d files in the last", files);
+    report("Files by album", repeat(BROWSE_RUNS, [this, &random, &files]() {
+        const QString album = QStringLiteral("%1 %2").arg(word(random)).arg(random.bounded(ALBUMS_PER_ARTIST));
+        files = m_library->getFilesByAlbum(album).size();
+    }));
+    qInfo("  %d files in the last", files);
+    report("Recent files", repeat(BROWSE_RUNS, [this]() {
+        m_library->getRecentFiles(500);
+    }));
+    report("Most played files", repeat(BROWSE_RUNS, [this]() {
+        m_library->getMostPlayedFiles(100);
+    }));
+}
+
+void BenchLibrary::smartPlaylistRefresh()
+{
+    // Playlist names are unique, so only the artist playlists repeat
+    for (int i = 0; i < SMART_PLAYLISTS / 4; ++i) {
+        QVERIFY(m_playlists->createArtistPlaylist(artistName(i * 7)) > 0);
+    }
+    QVERIFY(m_playlists->createRecentlyAddedPlaylist() > 0);
+    QVERIFY(m_playlists->createMostPlayedPlaylist() > 0);
+    QVERIFY(m_playlists->createNeverPlayedPlaylist(500) > 0);
+    QVERIFY(m_playlists->createRecentlyPlayedPlaylist() > 0);
+
+    QRandomGenerator random(3);
+    while (m_playlists->getTotalSmartPlaylists() < SMART_PLAYLISTS) {
+        PlaylistManager::SmartPlaylistCriteria criteria;
+        criteria.field = QStringLiteral("title");
+        criteria.operator_ = QStringLiteral("contains");
+        criteria.value = word(random);
+        criteria.limit = 250;
+        QVERIFY(m_playlists->createSmartPlaylist(QStringLiteral("Contains %1 %2")
+                                                     .arg(criteria.value)
+                                                     .arg(m_playlists->getTotalSmartPlaylists()),
+                                                 criteria) > 0);
+    }
+
+    report("Refresh all smart playlists", repeat(SMART_REFRESH_RUNS, [this]() {
+        m_playlists->refreshAllSmartPlaylists();
+    }));
+}
+
+void BenchLibrary::playlistSave()
+{
+    const QList<MediaFile> files = m_library->getRecentFiles(PLAYLIST_SIZE);
+    QVERIFY(!files.isEmpty());
+
+    int saved = 0;
+    report("Save playlist", repeat(PLAYLIST_SAVES, [this, &files, &saved]() {
+        const int playlistId = m_playlists->createPlaylist(QStringLiteral("Bench %1").arg(++saved));
+        m_playlists->addToPlaylist(playlistId, files);
+    }));
+    qInfo("  %lld items per playlist", qlonglong(files.size()));
+}
+
+void BenchLibrary::queueMutation()
+{
+    QList<MediaFile> files = m_library->getRecentFiles(QUEUE_SIZE);
+    QVERIFY(!files.isEmpty());
+
+    // The queue is journalled; the flush writes the pending operations
+    auto flush = [this]() {
+        QVERIFY(QMetaObject::invokeMethod(m_playlists.get(), "flushQueueOperations"));
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+    m_playlists->setCurrentQueue(files);
+    flush();
+    qInfo("Replace queue with %lld items: %.2f ms", qlonglong(files.size()), timer.nsecsElapsed() / 1e6);
+
+    QRandomGenerator random(4);
+    QList<qreal> inserts;
+    QList<qreal> removes;
+    QList<qreal> moves;
+    for (int i = 0; i < QUEUE_OPERATIONS; ++i) {
+        const int size = m_playlists->getCurrentQueue().size();
+        const int operation = random.bounded(3);
+        timer.start();
+        if (operation == 0 || size < 2) {
+            m_playlists->addToQueue(files[random.bounded(int(files.size()))]);
+            inserts << timer.nsecsElapsed() / 1e6;
+        } else if (operation == 1) {
+            m_playlists->removeFromQueue(random.bounded(size));
+            removes << timer.nsecsElapsed() / 1e6;
+        } else {
+            m_playlists->moveInQueue(random.bounded(size), random.bounded(size));
+            moves << timer.nsecsElapsed() / 1e6;
+        }
+    }
+
+    timer.start();
+    flush();
+    qInfo("Flush after %d queue operations: %.2f ms", QUEUE_OPERATIONS, timer.nsecsElapsed() / 1e6);
+
+    report("Queue insert", inserts);
+    report("Queue remove", removes);
+    report("Queue move", moves);
+}
+
+QTEST_GUILESS_MAIN(BenchLibrary)
+#include "bench_library.moc"
@@ -0,0 +1,158 @@
+#include <QtTest/QtTest>
+#include <QDir>
+#include <QSignalSpy>
+#include <QtMath>
+#include <algorithm>
+#include "media/VLCBackend.h"
+#include "media/MediaOpenProfiler.h"
+
+/**
+ * @brief Time-to-first-frame benchmark for media opens
+ *
+ * Opens every file in $EONPLAY_OPEN_CORPUS and every URL listed (one per
+ * line) in the file named by $EONPLAY_OPEN_URLS through VLCBackend, and
+ * waits for MediaOpenProfiler to report the first frame, or the first
+ * audio for audio-only media. Each entry is opened $EONPLAY_OPEN_RUNS
+ * times (default 5); p50 and p95 are reported for local files, network
+ * media and both together.
+ */
+class BenchOpenLatency : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void localFiles();
+    void networkMedia();
+    void allMedia();
+
+private:
+    static qreal percentile(QList<qreal> values, qreal fraction);
+    void openCorpus(const QStringList& corpus, QList<qreal>& times);
+    void report(const char* name, const QList<qreal>& times);
+
+    VLCBackend* m_backend = nullptr;
+    QStringList m_localCorpus;
+    QStringList m_networkCorpus;
+    QList<qreal> m_localTimes;
+    QList<qreal> m_networkTimes;
+    int m_runs = 5;
+
+    static constexpr int OPEN_TIMEOUT_MS = 30000;
+};
+
+void BenchOpenLatency::initTestCase()
+{
+    if (!VLCBackend::isVLCAvailable()) {
+        QSKIP("libVLC not available on this system");
+    }
+
+    m_runs = qEnvironmentVariableIsSet("EONPLAY_OPEN_RUNS")
+        ? qMax(1, qEnvironmentVariableIntValue("EONPLAY_OPEN_RUNS")) : 5;
+
+    const QString directory = qEnvironmentVariable("EONPLAY_OPEN_CORPUS");
+    if (!directory.isEmpty()) {
+        const QFileInfoList files = QDir(directory).entryInfoList(QDir::Files, QDir::Name);
+        for (const QFileInfo& file : files) {
+            m_localCorpus << file.absoluteFilePath();
+        }
+    }
+
+    const QString urlList = qEnvironmentVariable("EONPLAY_OPEN_URLS");
+    if (!urlList.isEmpty()) {
+        QFile file(urlList);
+        QVERIFY2(file.open(QIODevice::ReadOnly | QIODevice::Text), qPrintable(urlList));
+        while (!file.atEnd()) {
+            const QString url = QString::fromUtf8(file.readLine()).trimmed();
+            if (!url.isEmpty() && !url.startsWith('#')) {
+                m_networkCorpus << url;
+            }
+        }
+    }
+
+    if (m_localCorpus.isEmpty() && m_networkCorpus.isEmpty()) {
+        QSKIP("Set EONPLAY_OPEN_CORPUS and/or EONPLAY_OPEN_URLS to run this benchmark");
+    }
+
+    m_backend = new VLCBackend(this);
+    QVERIFY(m_backend->initialize());
+    m_backend->setVolume(0);
+
+    openCorpus(m_localCorpus, m_localTimes);
+    openCorpus(m_networkCorpus, m_networkTimes);
+}
+
+void BenchOpenLatency::cleanupTestCase()
+{
+    if (m_backend) {
+        m_backend->shutdown();
+    }
+}
+
+void BenchOpenLatency::openCorpus(const QStringList& corpus, QList<qreal>& times)
+{
+    MediaOpenProfiler& profiler = MediaOpenProfiler::instance();
+
+    for (int run = 0; run < m_runs; ++run) {
+        for (const QString& path : corpus) {
+            QSignalSpy completed(&profiler, &MediaOpenProfiler::profileCompleted);
+
+            profiler.begin(path);
+            if (!m_backend->loadMedia(path)) {
+                qWarning("Could not open %s", qPrintable(path));
+                continue;
+            }
+            m_backend->play();
+
+            if (!completed.wait(OPEN_TIMEOUT_MS)) {
+                qWarning("No first frame for %s", qPrintable(path));
+                profiler.abandon(path);
+            } else {
+                const MediaOpenProfile profile = completed.takeFirst().at(0).value<MediaOpenProfile>();
+                qInfo("%s: %.1f ms to first %s", qPrintable(path), profile.timeToFirstFrameMs(),
+                      profile.video ? "frame" : "audio");
+                times << profile.timeToFirstFrameMs();
+            }
+
+            m_backend->stop();
+        }
+    }
+}
+
+qreal BenchOpenLatency::percentile(QList<qreal> values, qreal fraction)
+{
+    std::sort(values.begin(), values.end());
+    const qsizetype index = qBound<qsizetype>(0, qCeil(fraction * values.size()) - 1, values.size() - 1);
+    return values[index];
+}
+
+void BenchOpenLatency::report(const char* name, const QList<qreal>& times)
+{
+    if (times.isEmpty()) {
+        QSKIP("No media of this kind opened");
+    }
+
+    const qreal p50 = percentile(times, 0.50);
+    const qreal p95 = percentile(times, 0.95);
+    qInfo("%s: p50 %.1f ms, p95 %.1f ms (%lld opens)", name, p50, p95, qlonglong(times.size()));
+    QTest::setBenchmarkResult(p95, QTest::WalltimeMilliseconds);
+}
+
+void BenchOpenLatency::localFiles()
+{
+    report("Local files", m_localTimes);
+}
+
+void BenchOpenLatency::networkMedia()
+{
+    report("Network media", m_networkTimes);
+}
+
+void BenchOpenLatency::allMedia()
+{
+    report("All media", m_localTimes + m_networkTimes);
+}
+
+QTEST_GUILESS_MAIN(BenchOpenLatency)
+#include "bench_open_latency.moc"
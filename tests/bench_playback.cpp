@@ -0,0 +1,603 @@
+#include <QtTest/QtTest>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QThread>
+#include <QtMath>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vlc/vlc.h>
+#include "audio/AdvancedAudioProcessor.h"
+#include "audio/AudioDSPGraph.h"
+#include "audio/AudioEqualizer.h"
+#include "audio/AudioOutputManager.h"
+#include "audio/AudioProcessor.h"
+#include "media/MediaOpenProfiler.h"
+#include "media/VLCBackend.h"
+#include "media/VideoFrame.h"
+#include "subtitles/SRTParser.h"
+#include "subtitles/SubtitleRenderer.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Takes the decoded audio from libVLC and runs the full DSP chain on it
+ *
+ * Stands in for the device: nothing is played. A buffer handed over after
+ * the time it was due to play counts as an underrun, as a device would
+ * have run dry waiting for it, and so does one the chain took longer to
+ * process than it lasts.
+ */
+class BenchAudioOutput : public VLCBackend::AudioOutput
+{
+public:
+    static constexpr int SAMPLE_RATE = 48000;
+
+    explicit BenchAudioOutput(AudioDSPGraph* graph)
+        : m_graph(graph)
+    {
+    }
+
+    bool attachPlayer(libvlc_media_player_t* player) override
+    {
+        auto stream = std::make_shared<Stream>(Stream{this, player});
+        libvlc_audio_set_format(player, "FL32", SAMPLE_RATE, 2);
+        libvlc_audio_set_callbacks(player, play, nullptr, nullptr, nullptr, nullptr, stream.get());
+        QMutexLocker locker(&m_mutex);
+        m_streams.insert(player, stream);
+        return true;
+    }
+
+    void detachPlayer(libvlc_media_player_t* player) override
+    {
+        QMutexLocker locker(&m_mutex);
+        m_streams.remove(player);
+        if (m_active.load() == player) {
+            m_active.store(nullptr);
+        }
+    }
+
+    void setActivePlayer(libvlc_media_player_t* player) override { m_active.store(player); }
+
+    void reset()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_buffers = 0;
+        m_frames = 0;
+        m_underruns = 0;
+        m_dspMisses = 0;
+        m_dspNs = 0;
+    }
+
+    QJsonObject report() const
+    {
+        QMutexLocker locker(&m_mutex);
+        QJsonObject audio;
+        audio["buffers"] = m_buffers;
+        audio["underruns"] = m_underruns;
+        audio["dspDeadlineMisses"] = m_dspMisses;
+        audio["dspNsPerFrame"] = m_frames > 0 ? double(m_dspNs) / m_frames : 0.0;
+        return audio;
+    }
+
+private:
+    struct Stream {
+        BenchAudioOutput* output;
+        libvlc_media_player_t* player;
+    };
+
+    // libVLC's audio thread; the stream is kept until the player is released
+    static void play(void* opaque, const void* samples, unsigned count, int64_t pts)
+    {
+        auto* stream = static_cast<Stream*>(opaque);
+        stream->output->process(stream->player, static_cast<const float*>(samples), int(count), pts);
+    }
+
+    void process(libvlc_media_player_t* player, const float* samples, int frames, int64_t pts)
+    {
+        if (m_active.load() != player || frames <= 0) {
+            return;
+        }
+
+        const bool late = libvlc_delay(pts) < 0;
+        m_left.resize(frames);
+        m_right.resize(frames);
+        for (int i = 0; i < frames; ++i) {
+            m_left[i] = samples[2 * i];
+            m_right[i] = samples[2 * i + 1];
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        m_graph->process(m_left.data(), m_right.data(), frames, SAMPLE_RATE);
+        const qint64 elapsedNs = timer.nsecsElapsed();
+
+        QMutexLocker locker(&m_mutex);
+        ++m_buffers;
+        m_frames += frames;
+        m_dspNs += elapsedNs;
+        if (late) {
+            ++m_underruns;
+        }
+        if (elapsedNs > qint64(frames) * 1000000000 / SAMPLE_RATE) {
+            ++m_dspMisses;
+        }
+    }
+
+    AudioDSPGraph* m_graph;
+    std::atomic<libvlc_media_player_t*> m_active{nullptr};
+    QVector<float> m_left;
+    QVector<float> m_right;
+
+    mutable QMutex m_mutex;
+    QHash<libvlc_media_player_t*, std::shared_ptr<Stream>> m_streams;
+    qint64 m_buffers = 0;
+    qint64 m_frames = 0;
+    qint64 m_underruns = 0;
+    qint64 m_dspMisses = 0;
+    qint64 m_dspNs = 0;
+};
+
+/**
+ * @brief Counts pictures shown later than their position says they were due
+ *
+ * The first picture, and the first after a jump in position, anchors the
+ * media time to the wall clock; a later picture arriving more than
+ * LATE_MS after its due time is late.
+ */
+class BenchFrameSink : public IVideoFrameSink
+{
+public:
+    static constexpr qint64 LATE_MS = 20;
+    static constexpr qint64 JUMP_MS = 1000;
+
+    void reset()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_frames = 0;
+        m_late = 0;
+        m_anchored = false;
+    }
+
+    void videoFrameReady(const VideoFrameRef& frame) override
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_clock.isValid()) {
+            m_clock.start();
+        }
+        const qint64 now = m_clock.elapsed();
+        const qint64 position = frame->position();
+        ++m_frames;
+
+        const qint64 due = m_anchorWall + (position - m_anchorPosition);
+        if (!m_anchored || position < m_lastPosition || position - m_lastPosition > JUMP_MS) {
+            m_anchored = true;
+            m_anchorWall = now;
+            m_anchorPosition = position;
+        } else if (now - due > LATE_MS) {
+            ++m_late;
+        }
+        m_lastPosition = position;
+    }
+
+    qint64 frames() const { QMutexLocker locker(&m_mutex); return m_frames; }
+    qint64 late() const { QMutexLocker locker(&m_mutex); return m_late; }
+
+private:
+    mutable QMutex m_mutex;
+    QElapsedTimer m_clock;
+    bool m_anchored = false;
+    qint64 m_anchorWall = 0;
+    qint64 m_anchorPosition = 0;
+    qint64 m_lastPosition = 0;
+    qint64 m_frames = 0;
+    qint64 m_late = 0;
+};
+
+/**
+ * @brief Busy time of every core, from /proc/stat; empty where there is none
+ */
+QList<QPair<qint64, qint64>> coreTimes()
+{
+    QList<QPair<qint64, qint64>> cores;     // Busy, total
+#ifdef Q_OS_LINUX
+    QFile file("/proc/stat");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return cores;
+    }
+    for (const QByteArray& line : file.readAll().split('\n')) {
+        if (!line.startsWith("cpu") || line.startsWith("cpu ")) {
+            continue;
+        }
+        const QList<QByteArray> fields = line.simplified().split(' ');
+        qint64 total = 0;
+        for (int i = 1; i < fields.size(); ++i) {
+            total += fields[i].toLongLong();
+        }
+        const qint64 idle = fields.value(4).toLongLong() + fields.value(5).toLongLong();
+        cores.append({total - idle, total});
+    }
+#endif
+    return cores;
+}
+
+/**
+ * @brief CPU time of this process in microseconds, -1 where unknown
+ */
+qint64 processCpuUs()
+{
+#ifdef Q_OS_UNIX
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return qint64(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+               usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+    }
+#endif
+    return -1;
+}
+
+/**
+ * @brief Resident set size in kilobytes, -1 where unknown
+ */
+qint64 residentKb()
+{
+#ifdef Q_OS_LINUX
+    QFile file("/proc/self/status");
+    if (file.open(QIODevice::ReadOnly)) {
+        for (const QByteArray& line : file.readAll().split('\n')) {
+            if (line.startsWith("VmRSS:")) {
+                return line.mid(6).simplified().split(' ').value(0).toLongLong();
+            }
+        }
+    }
+#endif
+    return -1;
+}
+
+} // namespace
+
+/**
+ * @brief Headless playback cost of the whole pipeline, for release-over-release comparison
+ *
+ * Plays every file in $EONPLAY_PLAYBACK_CORPUS and every URL listed (one
+ * per line) in the file named by $EONPLAY_PLAYBACK_URLS, e.g. 4K HEVC,
+ * 1080p H.264, hi-res FLAC and an HLS stream, through VLCBackend for
+ * $EONPLAY_PLAYBACK_SECONDS each (default 20). Decoded audio runs through
+ * the full DSP chain (karaoke, noise reduction, equalizer, binaural
+ * spatial sound) and subtitles are rendered offscreen at 1080p: from a
+ * sidecar .srt if the media has one, else from a generated track.
+ *
+ * Each item reports time to first frame, seek latency over SEEK_COUNT
+ * seeks, process and per-core CPU, peak RSS, shown, dropped and late
+ * frames, audio underruns and subtitle render time. With
+ * $EONPLAY_BENCH_JSON set, the report is written there as JSON. Run with
+ * QT_QPA_PLATFORM=offscreen.
+ */
+class BenchPlayback : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void playback_data();
+    void playback();
+
+private:
+    SubtitleTrack subtitlesFor(const QString& path) const;
+    QJsonObject measureSeeks(qint64 duration);
+    void sampleResources();
+
+    std::unique_ptr<VLCBackend> m_backend;
+    std::shared_ptr<AudioEqualizer> m_equalizer;
+    std::shared_ptr<AudioOutputManager> m_outputManager;
+    std::shared_ptr<AdvancedAudioProcessor> m_advancedProcessor;
+    std::shared_ptr<AudioProcessor> m_audioProcessor;
+    std::unique_ptr<AudioDSPGraph> m_graph;
+    std::unique_ptr<BenchAudioOutput> m_audioOutput;
+    BenchFrameSink m_frameSink;
+    std::unique_ptr<SubtitleRenderer> m_subtitleRenderer;
+    QImage m_subtitleImage;
+
+    QStringList m_corpus;
+    int m_playMs = 20000;
+    qint64 m_peakRssKb = -1;
+    QJsonArray m_results;
+
+    static constexpr int OPEN_TIMEOUT_MS = 30000;
+    static constexpr int SEEK_TIMEOUT_MS = 10000;
+    static constexpr int SEEK_COUNT = 8;
+    static constexpr int SAMPLE_INTERVAL_MS = 250;
+    static constexpr int SUBTITLE_INTERVAL_MS = 40;     // One per frame at 25 fps
+};
+
+void BenchPlayback::initTestCase()
+{
+    if (!VLCBackend::isVLCAvailable()) {
+        QSKIP("libVLC not available on this system");
+    }
+
+    const QString directory = qEnvironmentVariable("EONPLAY_PLAYBACK_CORPUS");
+    if (!directory.isEmpty()) {
+        const QFileInfoList files = QDir(directory).entryInfoList(QDir::Files, QDir::Name);
+        for (const QFileInfo& file : files) {
+            if (file.suffix().compare("srt", Qt::CaseInsensitive) != 0) {
+                m_corpus << file.absoluteFilePath();
+            }
+        }
+    }
+
+    const QString urlList = qEnvironmentVariable("EONPLAY_PLAYBACK_URLS");
+    if (!urlList.isEmpty()) {
+        QFile file(urlList);
+        QVERIFY2(file.open(QIODevice::ReadOnly | QIODevice::Text), qPrintable(urlList));
+        while (!file.atEnd()) {
+            const QString url = QString::fromUtf8(file.readLine()).trimmed();
+            if (!url.isEmpty() && !url.startsWith('#')) {
+                m_corpus << url;
+            }
+        }
+    }
+
+    if (m_corpus.isEmpty()) {
+        QSKIP("Set EONPLAY_PLAYBACK_CORPUS and/or EONPLAY_PLAYBACK_URLS to run this benchmark");
+    }
+
+    if (qEnvironmentVariableIsSet("EONPLAY_PLAYBACK_SECONDS")) {
+        m_playMs = qMax(1, qEnvironmentVariableIntValue("EONPLAY_PLAYBACK_SECONDS")) * 1000;
+    }
+
+    // Keep the DSP settings files out of the user's configuration
+    QStandardPaths::setTestModeEnabled(true);
+
+    m_equalizer = std::make_shared<AudioEqualizer>();
+    m_equalizer->applyPreset(AudioEqualizer::Rock);
+    m_equalizer->setEnabled(true);
+
+    m_outputManager = std::make_shared<AudioOutputManager>();
+    m_outputManager->setSpatialSoundMode(AudioOutputManager::Headphones);
+    m_outputManager->setHrtfSuspended(false);
+
+    m_advancedProcessor = std::make_shared<AdvancedAudioProcessor>();
+    AdvancedAudioProcessor::NoiseReductionSettings noiseReduction;
+    noiseReduction.enabled = true;
+    m_advancedProcessor->setNoiseReductionSettings(noiseReduction);
+    m_advancedProcessor->setNoiseReductionSuspended(false);
+
+    m_audioProcessor = std::make_shared<AudioProcessor>();
+    m_audioProcessor->setKaraokeMode(AudioProcessor::VocalRemoval);
+
+    m_graph = std::make_unique<AudioDSPGraph>();
+    m_graph->addNode(std::make_shared<KaraokeNode>(m_audioProcessor), AudioDSPGraph::KaraokeStage);
+    m_graph->addNode(std::make_shared<AdvancedProcessorNode>(m_advancedProcessor), AudioDSPGraph::AdvancedStage);
+    m_graph->addNode(std::make_shared<EqualizerNode>(m_equalizer), AudioDSPGraph::EqualizerStage);
+    m_graph->addNode(std::make_shared<SpatialSoundNode>(m_outputManager), AudioDSPGraph::SpatialStage);
+    m_graph->compile(BenchAudioOutput::SAMPLE_RATE);
+
+    m_subtitleRenderer = std::make_unique<SubtitleRenderer>();
+    m_subtitleRenderer->resize(1920, 1080);
+    m_subtitleImage = QImage(1920, 1080, QImage::Format_ARGB32_Premultiplied);
+
+    m_backend = std::make_unique<VLCBackend>();
+    QVERIFY(m_backend->initialize());
+    m_audioOutput = std::make_unique<BenchAudioOutput>(m_graph.get());
+    m_backend->setAudioOutput(m_audioOutput.get());
+    m_backend->addVideoFrameSink(&m_frameSink);
+
+    qInfo("libVLC %s, %d cores", qPrintable(VLCBackend::vlcVersion()), QThread::idealThreadCount());
+}
+
+void BenchPlayback::cleanupTestCase()
+{
+    if (m_backend) {
+        m_backend->removeVideoFrameSink(&m_frameSink);
+        m_backend->setAudioOutput(nullptr);
+        m_backend->shutdown();
+    }
+
+    const QString path = qEnvironmentVariable("EONPLAY_BENCH_JSON");
+    if (path.isEmpty() || m_results.isEmpty()) {
+        return;
+    }
+
+    QJsonObject report;
+    report["benchmark"] = "bench_playback";
+    report["vlcVersion"] = VLCBackend::vlcVersion();
+    report["cores"] = QThread::idealThreadCount();
+    report["playSeconds"] = m_playMs / 1000;
+    report["results"] = m_results;
+
+    QFile file(path);
+    QVERIFY2(file.open(QIODevice::WriteOnly | QIODevice::Truncate), qPrintable(path));
+    file.write(QJsonDocument(report).toJson());
+}
+
+void BenchPlayback::playback_data()
+{
+    QTest::addColumn<QString>("media");
+    for (const QString& media : m_corpus) {
+        QTest::newRow(qPrintable(QFileInfo(media).fileName())) << media;
+    }
+}
+
+void BenchPlayback::playback()
+{
+    QFETCH(QString, media);
+
+    const SubtitleTrack subtitles = subtitlesFor(media);
+    m_audioOutput->reset();
+    m_frameSink.reset();
+    m_peakRssKb = residentKb();
+
+    const QList<QPair<qint64, qint64>> coresBefore = coreTimes();
+    const qint64 cpuBefore = processCpuUs();
+    QElapsedTimer wall;
+    wall.start();
+
+    // Time to first frame, or to the first audio of audio-only media
+    MediaOpenProfiler& profiler = MediaOpenProfiler::instance();
+    QSignalSpy completed(&profiler, &MediaOpenProfiler::profileCompleted);
+    profiler.begin(media);
+    QVERIFY2(m_backend->loadMedia(media), qPrintable(media));
+    m_backend->play();
+    double ttffMs = -1.0;
+    if (completed.wait(OPEN_TIMEOUT_MS)) {
+        ttffMs = completed.takeFirst().at(0).value<MediaOpenProfile>().timeToFirstFrameMs();
+    } else {
+        profiler.abandon(media);
+        QFAIL(qPrintable(QString("No first frame for %1").arg(media)));
+    }
+
+    // Subtitles follow playback at frame rate; their cost is timed apart
+    qint64 subtitleNs = 0;
+    int subtitleRenders = 0;
+    m_backend->subscribePosition(this, SUBTITLE_INTERVAL_MS, [&](qint64 position) {
+        QElapsedTimer timer;
+        timer.start();
+        m_subtitleRenderer->setSubtitleEntries(subtitles.getActiveEntries(position), position);
+        m_subtitleImage.fill(Qt::transparent);
+        m_subtitleRenderer->render(&m_subtitleImage);
+        subtitleNs += timer.nsecsElapsed();
+        ++subtitleRenders;
+    });
+
+    // Steady playback over the first half, seeks over the rest
+    QElapsedTimer elapsed;
+    elapsed.start();
+    while (elapsed.elapsed() < m_playMs / 2) {
+        QTest::qWait(SAMPLE_INTERVAL_MS);
+        sampleResources();
+    }
+    const QJsonObject seeks = measureSeeks(m_backend->duration());
+    while (elapsed.elapsed() < m_playMs) {
+        QTest::qWait(SAMPLE_INTERVAL_MS);
+        sampleResources();
+    }
+
+    m_backend->unsubscribePosition(this);
+    const VLCBackend::DecoderStats stats = m_backend->decoderStats();
+    const bool video = m_backend->hasVideo();
+    m_backend->stop();
+
+    const qint64 wallUs = wall.nsecsElapsed() / 1000;
+    const qint64 cpuAfter = processCpuUs();
+    const QList<QPair<qint64, qint64>> coresAfter = coreTimes();
+
+    QJsonObject cpu;
+    cpu["processPercent"] = cpuBefore >= 0 ? 100.0 * (cpuAfter - cpuBefore) / wallUs : -1.0;
+    QJsonArray perCore;
+    for (int i = 0; i < qMin(coresBefore.size(), coresAfter.size()); ++i) {
+        const qint64 total = coresAfter[i].second - coresBefore[i].second;
+        perCore.append(total > 0 ? 100.0 * (coresAfter[i].first - coresBefore[i].first) / total : 0.0);
+    }
+    cpu["perCorePercent"] = perCore;
+
+    QJsonObject frames;
+    frames["shown"] = m_frameSink.frames();
+    frames["late"] = m_frameSink.late();
+    frames["dropped"] = stats.lostPictures + stats.poolDroppedPictures;
+    frames["decoded"] = stats.decodedVideo;
+
+    QJsonObject audio = m_audioOutput->report();
+    audio["lostBuffers"] = stats.lostAudioBuffers;
+
+    QJsonObject result;
+    result["media"] = media;
+    result["video"] = video;
+    result["decoder"] = stats.decoder;
+    result["ttffMs"] = ttffMs;
+    result["seek"] = seeks;
+    result["cpu"] = cpu;
+    result["peakRssMb"] = m_peakRssKb >= 0 ? m_peakRssKb / 1024.0 : -1.0;
+    result["frames"] = frames;
+    result["audio"] = audio;
+    result["subtitleRenderUs"] = subtitleRenders > 0 ? subtitleNs / 1000.0 / subtitleRenders : 0.0;
+    m_results.append(result);
+
+    qInfo("%s: first frame %.1f ms, seek p95 %.1f ms, CPU %.0f%%, RSS %.0f MB, "
+          "%lld dropped, %lld late, %lld underruns",
+          qPrintable(media), ttffMs, seeks.value("p95Ms").toDouble(), cpu.value("processPercent").toDouble(),
+          result.value("peakRssMb").toDouble(), qlonglong(frames.value("dropped").toInteger()),
+          qlonglong(frames.value("late").toInteger()), qlonglong(audio.value("underruns").toInteger()));
+    QTest::setBenchmarkResult(ttffMs, QTest::WalltimeMilliseconds);
+}
+
+SubtitleTrack BenchPlayback::subtitlesFor(const QString& path) const
+{
+    const QFileInfo info(path);
+    const QString sidecar = info.dir().filePath(info.completeBaseName() + ".srt");
+    if (info.exists() && QFileInfo::exists(sidecar)) {
+        SRTParser parser;
+        SubtitleParseResult result;
+        const SubtitleTrack track = parser.parseFile(sidecar, result);
+        if (result.isSuccess()) {
+            return track;
+        }
+    }
+
+    // Two lines every two seconds, shown for one and a half
+    SubtitleTrack track("Generated");
+    for (qint64 start = 0; start < 3600000; start += 2000) {
+        track.addEntry(SubtitleEntry(start, start + 1500,
+            QString("Subtitle line %1 of the benchmark track\nwith a second, longer line of text").arg(start / 2000)));
+    }
+    return track;
+}
+
+QJsonObject BenchPlayback::measureSeeks(qint64 duration)
+{
+    QJsonObject seeks;
+    if (duration <= 0) {
+        return seeks;       // Live streams
+    }
+
+    QList<qreal> times;
+    for (int i = 0; i < SEEK_COUNT; ++i) {
+        // Spread over the media, alternating forward and back
+        const qint64 target = duration * ((i * 5) % SEEK_COUNT + 1) / (SEEK_COUNT + 1);
+        QSignalSpy landed(m_backend.get(), &IMediaEngine::seekCompleted);
+        QElapsedTimer timer;
+        timer.start();
+        m_backend->seek(target);
+        if (!landed.wait(SEEK_TIMEOUT_MS)) {
+            qWarning("Seek to %lld ms did not land", qlonglong(target));
+            continue;
+        }
+        times << timer.nsecsElapsed() / 1e6;
+        QTest::qWait(SAMPLE_INTERVAL_MS);
+        sampleResources();
+    }
+    if (times.isEmpty()) {
+        return seeks;
+    }
+
+    std::sort(times.begin(), times.end());
+    const auto percentile = [&times](qreal fraction) {
+        return times[qBound<qsizetype>(0, qCeil(fraction * times.size()) - 1, times.size() - 1)];
+    };
+    seeks["count"] = int(times.size());
+    seeks["p50Ms"] = percentile(0.50);
+    seeks["p95Ms"] = percentile(0.95);
+    seeks["maxMs"] = times.last();
+    return seeks;
+}
+
+void BenchPlayback::sampleResources()
+{
+    m_peakRssKb = qMax(m_peakRssKb, residentKb());
+}
+
+QTEST_MAIN(BenchPlayback)
+#include "bench_playback.moc"
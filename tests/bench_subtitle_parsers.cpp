@@ -0,0 +1,217 @@
+#include <QtTest/QtTest>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <memory>
+#include "subtitles/SRTParser.h"
+#include "subtitles/ASSParser.h"
+
+/**
+ * @brief Benchmark for the streaming subtitle parsers
+ *
+ * parseFile() takes the memory-mapped path for UTF-8 files; the reference
+ * decodes the whole file into a QString and calls parseContent(), which is
+ * what loading a track cost before. The corpus is generated, and every
+ * .srt/.ass/.ssa file in $EONPLAY_SUBTITLE_CORPUS is added to it.
+ */
+class BenchSubtitleParsers : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testStreamingMatchesContent_data();
+    void testStreamingMatchesContent();
+    void benchParseFile_data();
+    void benchParseFile();
+    void benchParseContent_data();
+    void benchParseContent();
+
+private:
+    static std::unique_ptr<BaseSubtitleParser> createParser(const QString& filePath);
+    static QString formatSrtTime(qint64 timeMs);
+    static QString formatAssTime(qint64 timeMs);
+    void writeSrtCorpus(const QString& filePath, int cues);
+    void writeAssCorpus(const QString& filePath, int cues);
+    void addCorpusRows();
+
+    QTemporaryDir m_directory;
+    QStringList m_corpus;
+
+    static constexpr int CUE_COUNT = 20000;
+    static constexpr qint64 CUE_SPACING_MS = 2500;
+};
+
+void BenchSubtitleParsers::initTestCase()
+{
+    QVERIFY(m_directory.isValid());
+
+    writeSrtCorpus(m_directory.filePath("generated.srt"), CUE_COUNT);
+    writeAssCorpus(m_directory.filePath("generated.ass"), CUE_COUNT);
+
+    const QString external = qEnvironmentVariable("EONPLAY_SUBTITLE_CORPUS");
+    if (!external.isEmpty()) {
+        const QFileInfoList files = QDir(external).entryInfoList({"*.srt", "*.ass", "*.ssa"}, QDir::Files);
+        for (const QFileInfo& file : files) {
+            m_corpus << file.absoluteFilePath();
+        }
+    }
+}
+
+std::unique_ptr<BaseSubtitleParser> BenchSubtitleParsers::createParser(const QString& filePath)
+{
+    if (QFileInfo(filePath).suffix().toLower() == "srt") {
+        return std::make_unique<SRTParser>();
+    }
+    return std::make_unique<ASSParser>();
+}
+
+QString BenchSubtitleParsers::formatSrtTime(qint64 timeMs)
+{
+    return QString("%1:%2:%3,%4")
+        .arg(timeMs / 3600000, 2, 10, QChar('0'))
+        .arg(timeMs / 60000 % 60, 2, 10, QChar('0'))
+        .arg(timeMs / 1000 % 60, 2, 10, QChar('0'))
+        .arg(timeMs % 1000, 3, 10, QChar('0'));
+}
+
+QString BenchSubtitleParsers::formatAssTime(qint64 timeMs)
+{
+    return QString("%1:%2:%3.%4")
+        .arg(timeMs / 3600000)
+        .arg(timeMs / 60000 % 60, 2, 10, QChar('0'))
+        .arg(timeMs / 1000 % 60, 2, 10, QChar('0'))
+        .arg(timeMs / 10 % 100, 2, 10, QChar('0'));
+}
+
+void BenchSubtitleParsers::writeSrtCorpus(const QString& filePath, int cues)
+{
+    QFile file(filePath);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+
+    QByteArray content;
+    for (int i = 0; i < cues; ++i) {
+        const qint64 start = i * CUE_SPACING_MS;
+        content += QString("%1\r\n%2 --> %3\r\n").arg(i + 1)
+                       .arg(formatSrtTime(start), formatSrtTime(start + 2000)).toUtf8();
+        if (i % 4 == 0) {
+            content += QString("<i>Line %1 with some italic dialogue</i>\r\n").arg(i).toUtf8();
+        } else {
+            content += QString("Line %1: «Ça va?» — 字幕のテスト\r\n").arg(i).toUtf8();
+        }
+        if (i % 3 == 0) {
+            content += "- And a second speaker answers.\r\n";
+        }
+        content += "\r\n";
+    }
+
+    QCOMPARE(file.write(content), content.size());
+}
+
+void BenchSubtitleParsers::writeAssCorpus(const QString& filePath, int cues)
+{
+    QFile file(filePath);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+
+    QByteArray content = "\xEF\xBB\xBF[Script Info]\nTitle: Benchmark\nScriptType: v4.00+\n\n"
+                         "[V4+ Styles]\n"
+                         "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, "
+                         "BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, ScaleY, Spacing, Angle, "
+                         "BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, Encoding\n"
+                         "Style: Default,Arial,20,&H00FFFFFF,&H000000FF,&H00000000,&H00000000,0,0,0,0,"
+                         "100,100,0,0,1,2,0,2,10,10,10,1\n"
+                         "Style: Sign,Arial,16,&H0000FFFF,&H000000FF,&H00000000,&H00000000,1,0,0,0,"
+                         "100,100,0,0,1,1,0,8,10,10,10,1\n\n"
+                         "[Events]\n"
+                         "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n";
+
+    for (int i = 0; i < cues; ++i) {
+        const qint64 start = i * CUE_SPACING_MS;
+        const QString style = (i % 5 == 0) ? "Sign" : "Default";
+        const QString text = (i % 2 == 0)
+            ? QString("{\\fad(200,200)\\blur2}Line %1, with commas,{\\i1} and\\Nbreaks{\\i0}").arg(i)
+            : QString("Line %1: «Ça va?» — 字幕のテスト").arg(i);
+        content += QString("Dialogue: 0,%1,%2,%3,Actor,0,0,0,,%4\n")
+                       .arg(formatAssTime(start), formatAssTime(start + 2000), style, text).toUtf8();
+    }
+
+    QCOMPARE(file.write(content), content.size());
+}
+
+void BenchSubtitleParsers::addCorpusRows()
+{
+    QTest::addColumn<QString>("filePath");
+    QTest::newRow("generated.srt") << m_directory.filePath("generated.srt");
+    QTest::newRow("generated.ass") << m_directory.filePath("generated.ass");
+    for (const QString& filePath : m_corpus) {
+        QTest::newRow(qPrintable(QFileInfo(filePath).fileName())) << filePath;
+    }
+}
+
+void BenchSubtitleParsers::testStreamingMatchesContent_data()
+{
+    addCorpusRows();
+}
+
+void BenchSubtitleParsers::testStreamingMatchesContent()
+{
+    QFETCH(QString, filePath);
+    std::unique_ptr<BaseSubtitleParser> parser = createParser(filePath);
+
+    SubtitleParseResult streamingResult;
+    const SubtitleTrack streaming = parser->parseFile(filePath, streamingResult);
+    QVERIFY2(streamingResult.isSuccess(), qPrintable(streamingResult.summary()));
+
+    QFile file(filePath);
+    QVERIFY(file.open(QIODevice::ReadOnly | QIODevice::Text));
+    SubtitleParseResult contentResult;
+    const SubtitleTrack reference = parser->parseContent(QString::fromUtf8(file.readAll()), contentResult);
+
+    QCOMPARE(streaming.entryCount(), reference.entryCount());
+    for (int i = 0; i < reference.entryCount(); ++i) {
+        const SubtitleEntry expected = reference.entryAt(i);
+        const SubtitleEntry actual = streaming.entryAt(i);
+        QCOMPARE(actual.startTime(), expected.startTime());
+        QCOMPARE(actual.endTime(), expected.endTime());
+        QCOMPARE(actual.text(), expected.text());
+    }
+}
+
+void BenchSubtitleParsers::benchParseFile_data()
+{
+    addCorpusRows();
+}
+
+void BenchSubtitleParsers::benchParseFile()
+{
+    QFETCH(QString, filePath);
+    std::unique_ptr<BaseSubtitleParser> parser = createParser(filePath);
+
+    QBENCHMARK {
+        SubtitleParseResult result;
+        const SubtitleTrack track = parser->parseFile(filePath, result);
+        QVERIFY(result.isSuccess());
+    }
+}
+
+void BenchSubtitleParsers::benchParseContent_data()
+{
+    addCorpusRows();
+}
+
+void BenchSubtitleParsers::benchParseContent()
+{
+    QFETCH(QString, filePath);
+    std::unique_ptr<BaseSubtitleParser> parser = createParser(filePath);
+
+    QBENCHMARK {
+        QFile file(filePath);
+        QVERIFY(file.open(QIODevice::ReadOnly | QIODevice::Text));
+        SubtitleParseResult result;
+        const SubtitleTrack track = parser->parseContent(QString::fromUtf8(file.readAll()), result);
+        QVERIFY(result.isSuccess());
+    }
+}
+
+QTEST_MAIN(BenchSubtitleParsers)
+#include "bench_subtitle_parsers.moc"
@@ -0,0 +1,138 @@
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <algorithm>
+
+/**
+ * @brief Cold-start benchmark for the EonPlay binary
+ *
+ * Launches the application headless (offscreen platform) with a startup
+ * trace, lets it quit once interactive, and reads the startup marks from
+ * the trace. Times are from the start of main(); the median over
+ * $EONPLAY_STARTUP_RUNS launches (default 3) is reported. Each run's trace
+ * is kept when $EONPLAY_STARTUP_TRACE_DIR is set.
+ */
+class StartupBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void timeToFirstFrame();
+    void timeToInteractive();
+
+private:
+    static QHash<QString, qint64> readMarks(const QString& traceFile);
+    static qreal median(QList<qint64> values);
+    void reportMark(const QString& mark);
+
+    QTemporaryDir m_directory;
+    QList<QHash<QString, qint64>> m_runs;
+
+    static constexpr int LAUNCH_TIMEOUT_MS = 60000;
+};
+
+void StartupBenchmark::initTestCase()
+{
+    QVERIFY(m_directory.isValid());
+    QVERIFY2(QFileInfo::exists(EONPLAY_BINARY), EONPLAY_BINARY);
+
+    const int count = qEnvironmentVariableIsSet("EONPLAY_STARTUP_RUNS")
+        ? qMax(1, qEnvironmentVariableIntValue("EONPLAY_STARTUP_RUNS")) : 3;
+    const QString keepDirectory = qEnvironmentVariable("EONPLAY_STARTUP_TRACE_DIR");
+
+    for (int run = 0; run < count; ++run) {
+        const QString traceFile = keepDirectory.isEmpty()
+            ? m_directory.filePath(QString("startup-%1.json").arg(run))
+            : QDir(keepDirectory).filePath(QString("startup-%1.json").arg(run));
+
+        QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+        environment.insert("QT_QPA_PLATFORM", "offscreen");
+        environment.insert("EONPLAY_TRACE_FILE", traceFile);
+        environment.insert("EONPLAY_EXIT_WHEN_INTERACTIVE", "1");
+
+        QProcess process;
+        process.setProcessEnvironment(environment);
+        process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+
+        QElapsedTimer wallClock;
+        wallClock.start();
+        process.start(EONPLAY_BINARY, QStringList{"--new-instance"});
+        QVERIFY2(process.waitForStarted(), qPrintable(process.errorString()));
+        if (!process.waitForFinished(LAUNCH_TIMEOUT_MS)) {
+            process.kill();
+            process.waitForFinished();
+            QFAIL("EonPlay did not become interactive in time");
+        }
+        QCOMPARE(process.exitStatus(), QProcess::NormalExit);
+        QCOMPARE(process.exitCode(), 0);
+
+        QHash<QString, qint64> marks = readMarks(traceFile);
+        QVERIFY2(marks.contains("startup.firstFrame"), "No first frame in startup trace");
+        QVERIFY2(marks.contains("startup.interactive"), "No interactive mark in startup trace");
+
+        qInfo("Run %d: first frame %.1f ms, interactive %.1f ms, process %lld ms", run + 1,
+              marks.value("startup.firstFrame") / 1000.0, marks.value("startup.interactive") / 1000.0,
+              wallClock.elapsed());
+        m_runs << marks;
+    }
+}
+
+QHash<QString, qint64> StartupBenchmark::readMarks(const QString& traceFile)
+{
+    QHash<QString, qint64> marks;
+
+    QFile file(traceFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return marks;
+    }
+
+    const QJsonArray events = QJsonDocument::fromJson(file.readAll()).object().value("traceEvents").toArray();
+    for (const QJsonValue& value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value("ph").toString() == "i") {
+            const QString name = event.value("name").toString();
+            if (!marks.contains(name)) {
+                marks.insert(name, event.value("ts").toInteger());
+            }
+        }
+    }
+
+    return marks;
+}
+
+qreal StartupBenchmark::median(QList<qint64> values)
+{
+    std::sort(values.begin(), values.end());
+    const qsizetype middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+void StartupBenchmark::reportMark(const QString& mark)
+{
+    QList<qint64> times;
+    for (const QHash<QString, qint64>& run : std::as_const(m_runs)) {
+        times << run.value(mark);
+    }
+
+    const qreal milliseconds = median(times) / 1000.0;
+    qInfo("%s: %.1f ms (median of %lld)", qPrintable(mark), milliseconds, qlonglong(times.size()));
+    QTest::setBenchmarkResult(milliseconds, QTest::WalltimeMilliseconds);
+}
+
+void StartupBenchmark::timeToFirstFrame()
+{
+    reportMark("startup.firstFrame");
+}
+
+void StartupBenchmark::timeToInteractive()
+{
+    reportMark("startup.interactive");
+}
+
+QTEST_GUILESS_MAIN(StartupBenchmark)
+#include "startup_benchmark.moc"
@@ -0,0 +1,208 @@
+#include <QtTest/QtTest>
+#include <QByteArray>
+
+#include "security/AesGcm.h"
+
+namespace {
+
+const uchar* bytes(const QByteArray& data)
+{
+    return reinterpret_cast<const uchar*>(data.constData());
+}
+
+uchar* bytes(QByteArray& data)
+{
+    return reinterpret_cast<uchar*>(data.data());
+}
+
+} // namespace
+
+/**
+ * @brief Known-answer and forgery tests for AesGcm, on every implementation the CPU has
+ *
+ * Vectors are the AES-256 test cases 13 to 16 of the GCM specification
+ * referenced by NIST SP 800-38D, and an AAD-only case from the NIST CAVP
+ * gcmEncryptExtIV256 set.
+ */
+class TestAesGcm : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup()
+    {
+        AesGcm::setHardwareAccelerationEnabled(true);
+    }
+
+    void testKnownAnswers_data()
+    {
+        QTest::addColumn<bool>("hardware");
+        QTest::addColumn<QByteArray>("key");
+        QTest::addColumn<QByteArray>("nonce");
+        QTest::addColumn<QByteArray>("associatedData");
+        QTest::addColumn<QByteArray>("plaintext");
+        QTest::addColumn<QByteArray>("ciphertext");
+        QTest::addColumn<QByteArray>("tag");
+
+        const QByteArray zeroKey(AesGcm::KEY_SIZE, '\0');
+        const QByteArray zeroNonce(AesGcm::NONCE_SIZE, '\0');
+        const QByteArray key = QByteArray::fromHex(
+            "feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308");
+        const QByteArray nonce = QByteArray::fromHex("cafebabefacedbaddecaf888");
+        const QByteArray plaintext = QByteArray::fromHex(
+            "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+            "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255");
+        const QByteArray ciphertext = QByteArray::fromHex(
+            "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa"
+            "8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662898015ad");
+
+        for (bool hardware : {false, true}) {
+            const char* path = hardware ? "hardware" : "portable";
+
+            QTest::addRow("%s: test case 13, empty plaintext", path)
+                << hardware << zeroKey << zeroNonce << QByteArray() << QByteArray() << QByteArray()
+                << QByteArray::fromHex("530f8afbc74536b9a963b4f1c4cb738b");
+            QTest::addRow("%s: test case 14, one block", path)
+                << hardware << zeroKey << zeroNonce << QByteArray() << QByteArray(16, '\0')
+                << QByteArray::fromHex("cea7403d4d606b6e074ec5d3baf39d18")
+                << QByteArray::fromHex("d0d1c8a799996bf0265b98b5d48ab919");
+            QTest::addRow("%s: test case 15, four blocks", path)
+                << hardware << key << nonce << QByteArray() << plaintext << ciphertext
+                << QByteArray::fromHex("b094dac5d93471bdec1a502270e3cc6c");
+            QTest::addRow("%s: test case 16, partial block and AAD", path)
+                << hardware << key << nonce << QByteArray::fromHex("feedfacedeadbeeffeedfacedeadbeefabaddad2")
+                << plaintext.left(60) << ciphertext.left(60)
+                << QByteArray::fromHex("76fc6ece0f4e1768cddf8853bb2d551b");
+            QTest::addRow("%s: AAD only", path)
+                << hardware
+                << QByteArray::fromHex("78dc4e0aaf52d935c3c01eea57428f00ca1fd475f5da86a49c8dd73d68c8e223")
+                << QByteArray::fromHex("d79cf22d504cc793c3fb6c8a")
+                << QByteArray::fromHex("b96baa8c1c75a671bfb2d08d06be5f36") << QByteArray() << QByteArray()
+                << QByteArray::fromHex("3e5d486aa2e30b22e040b85723a06e76");
+        }
+    }
+
+    void testKnownAnswers()
+    {
+        QFETCH(bool, hardware);
+        QFETCH(QByteArray, key);
+        QFETCH(QByteArray, nonce);
+        QFETCH(QByteArray, associatedData);
+        QFETCH(QByteArray, plaintext);
+        QFETCH(QByteArray, ciphertext);
+        QFETCH(QByteArray, tag);
+
+        AesGcm::setHardwareAccelerationEnabled(hardware);
+        if (hardware && !AesGcm::isHardwareAccelerated()) {
+            QSKIP("No hardware AES on this CPU");
+        }
+
+        AesGcm gcm(key);
+        QVERIFY(gcm.isValid());
+
+        QByteArray encrypted(plaintext.size(), '\0');
+        QByteArray encryptedTag(AesGcm::TAG_SIZE, '\0');
+        gcm.encrypt(bytes(nonce), bytes(associatedData), associatedData.size(),
+                    bytes(plaintext), bytes(encrypted), plaintext.size(), bytes(encryptedTag));
+        QCOMPARE(encrypted.toHex(), ciphertext.toHex());
+        QCOMPARE(encryptedTag.toHex(), tag.toHex());
+
+        QByteArray decrypted(ciphertext.size(), '\0');
+        QVERIFY(gcm.decrypt(bytes(nonce), bytes(associatedData), associatedData.size(),
+                            bytes(ciphertext), bytes(decrypted), ciphertext.size(), bytes(tag)));
+        QCOMPARE(decrypted.toHex(), plaintext.toHex());
+    }
+
+    void testTagMismatch_data()
+    {
+        QTest::addColumn<bool>("hardware");
+        QTest::newRow("portable") << false;
+        QTest::newRow("hardware") << true;
+    }
+
+    void testTagMismatch()
+    {
+        QFETCH(bool, hardware);
+
+        AesGcm::setHardwareAccelerationEnabled(hardware);
+        if (hardware && !AesGcm::isHardwareAccelerated()) {
+            QSKIP("No hardware AES on this CPU");
+        }
+
+        AesGcm gcm(QByteArray::fromHex("feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308"));
+        const QByteArray nonce = QByteArray::fromHex("cafebabefacedbaddecaf888");
+        const QByteArray associatedData = QByteArray::fromHex("feedfacedeadbeeffeedfacedeadbeefabaddad2");
+        const QByteArray ciphertext = QByteArray::fromHex(
+            "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa"
+            "8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662");
+        const QByteArray tag = QByteArray::fromHex("76fc6ece0f4e1768cddf8853bb2d551b");
+        QByteArray out(ciphertext.size(), '\0');
+
+        QVERIFY(gcm.decrypt(bytes(nonce), bytes(associatedData), associatedData.size(),
+                            bytes(ciphertext), bytes(out), ciphertext.size(), bytes(tag)));
+
+        // A single flipped bit anywhere must be rejected
+        QByteArray forgedTag = tag;
+        forgedTag[AesGcm::TAG_SIZE - 1] = char(forgedTag[AesGcm::TAG_SIZE - 1] ^ 0x01);
+        QVERIFY(!gcm.decrypt(bytes(nonce), bytes(associatedData), associatedData.size(),
+                             bytes(ciphertext), bytes(out), ciphertext.size(), bytes(forgedTag)));
+
+        QByteArray forgedCiphertext = ciphertext;
+        forgedCiphertext[0] = char(forgedCiphertext[0] ^ 0x80);
+        QVERIFY(!gcm.decrypt(bytes(nonce), bytes(associatedData), associatedData.size(),
+                             bytes(forgedCiphertext), bytes(out), forgedCiphertext.size(), bytes(tag)));
+
+        QByteArray forgedAssociatedData = associatedData;
+        forgedAssociatedData[3] = char(forgedAssociatedData[3] ^ 0x10);
+        QVERIFY(!gcm.decrypt(bytes(nonce), bytes(forgedAssociatedData), forgedAssociatedData.size(),
+                             bytes(ciphertext), bytes(out), ciphertext.size(), bytes(tag)));
+
+        // Sealed buffers: round trip, then a truncated and a tampered copy
+        const QByteArray message("EonPlay settings blob");
+        const QByteArray sealed = gcm.encrypt(message, "aad");
+        QByteArray opened;
+        QVERIFY(gcm.decrypt(sealed, &opened, "aad"));
+        QCOMPARE(opened, message);
+        QVERIFY(!gcm.decrypt(sealed, &opened, "other aad"));
+        QVERIFY(!gcm.decrypt(sealed.left(sealed.size() - 1), &opened, "aad"));
+
+        QByteArray tampered = sealed;
+        tampered[sealed.size() - 1] = char(tampered[sealed.size() - 1] ^ 0x01);
+        QVERIFY(!gcm.decrypt(tampered, &opened, "aad"));
+    }
+
+    void testImplementationsAgree()
+    {
+        if (!AesGcm::isHardwareAccelerated()) {
+            QSKIP("No hardware AES on this CPU");
+        }
+
+        // Long enough for the hardware paths' four-block loops, slices and tail
+        QByteArray plaintext(70 * 1024 + 13, Qt::Uninitialized);
+        for (int i = 0; i < plaintext.size(); ++i) {
+            plaintext[i] = char(i * 31 + (i >> 8));
+        }
+        const QByteArray key(AesGcm::KEY_SIZE, '\x5a');
+        const QByteArray nonce(AesGcm::NONCE_SIZE, '\x11');
+        const QByteArray associatedData(37, '\x42');
+
+        const AesGcm hardwareGcm(key);
+        AesGcm::setHardwareAccelerationEnabled(false);
+        const AesGcm portableGcm(key);
+
+        QByteArray hardwareOut(plaintext.size(), '\0');
+        QByteArray portableOut(plaintext.size(), '\0');
+        QByteArray hardwareTag(AesGcm::TAG_SIZE, '\0');
+        QByteArray portableTag(AesGcm::TAG_SIZE, '\0');
+        hardwareGcm.encrypt(bytes(nonce), bytes(associatedData), associatedData.size(),
+                            bytes(plaintext), bytes(hardwareOut), plaintext.size(), bytes(hardwareTag));
+        portableGcm.encrypt(bytes(nonce), bytes(associatedData), associatedData.size(),
+                            bytes(plaintext), bytes(portableOut), plaintext.size(), bytes(portableTag));
+
+        QVERIFY(hardwareOut == portableOut);
+        QCOMPARE(hardwareTag.toHex(), portableTag.toHex());
+    }
+};
+
+QTEST_MAIN(TestAesGcm)
+#include "test_aes_gcm.moc"
@@ -0,0 +1,182 @@
+#include <QtTest/QtTest>
+#include <QRandomGenerator>
+#include <QVector>
+#include <QtMath>
+#include <iterator>
+
+#include "audio/BiquadCascade.h"
+
+namespace {
+
+struct Coefficients {
+    double b0, b1, b2, a1, a2;
+};
+
+// Same RBJ peaking EQ as BiquadCascade::setPeakingEQ
+Coefficients peakingEQ(double sampleRate, double frequency, double gainDb, double q)
+{
+    const double A = qPow(10.0, gainDb / 40.0);
+    const double omega = 2.0 * M_PI * frequency / sampleRate;
+    const double alpha = qSin(omega) / (2.0 * q);
+    const double a0 = 1.0 + alpha / A;
+    return {(1.0 + alpha * A) / a0, (-2.0 * qCos(omega)) / a0, (1.0 - alpha * A) / a0,
+            (-2.0 * qCos(omega)) / a0, (1.0 - alpha / A) / a0};
+}
+
+// Plain scalar transposed direct form II, one stage after the other
+void filterReference(const QVector<Coefficients>& stages, QVector<double>& samples)
+{
+    for (const Coefficients& c : stages) {
+        double z1 = 0.0;
+        double z2 = 0.0;
+        for (double& x : samples) {
+            const double y = c.b0 * x + z1;
+            z1 = c.b1 * x - c.a1 * y + z2;
+            z2 = c.b2 * x - c.a2 * y;
+            x = y;
+        }
+    }
+}
+
+QVector<float> noise(int frames, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    QVector<float> samples(frames);
+    for (float& sample : samples) {
+        sample = static_cast<float>(random.bounded(2.0) - 1.0);
+    }
+    return samples;
+}
+
+} // namespace
+
+/**
+ * @brief Checks the vectorized BiquadCascade against a scalar reference
+ */
+class TestBiquadCascade : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        qInfo() << "BiquadCascade backend:" << BiquadCascade::simdBackend();
+    }
+
+    void testMatchesScalarReference_data()
+    {
+        QTest::addColumn<int>("frames");
+        QTest::newRow("partial block") << 100;
+        QTest::newRow("one block") << BiquadCascade::BLOCK_SIZE;
+        QTest::newRow("several blocks and a tail") << BiquadCascade::BLOCK_SIZE * 7 + 13;
+    }
+
+    void testMatchesScalarReference()
+    {
+        QFETCH(int, frames);
+
+        constexpr double sampleRate = 48000.0;
+        const double frequencies[] = {31, 62, 125, 250, 500, 1000, 2000, 4000, 8000, 16000};
+        const int stageCount = int(std::size(frequencies));
+
+        BiquadCascade cascade;
+        cascade.setStageCount(stageCount);
+        QVector<Coefficients> stages;
+        for (int stage = 0; stage < stageCount; ++stage) {
+            // Stage 3 stays flat, so the bypass path is exercised too
+            const double gainDb = stage == 3 ? 0.0 : (stage % 2 ? 6.0 : -4.5) + stage * 0.3;
+            cascade.setPeakingEQ(stage, sampleRate, frequencies[stage], gainDb, 1.41);
+            if (gainDb != 0.0) {
+                stages.append(peakingEQ(sampleRate, frequencies[stage], gainDb, 1.41));
+            }
+        }
+
+        QVector<float> left = noise(frames, 1);
+        QVector<float> right = noise(frames, 2);
+        QVector<double> expectedLeft(left.begin(), left.end());
+        QVector<double> expectedRight(right.begin(), right.end());
+
+        cascade.process(left.data(), right.data(), frames);
+        filterReference(stages, expectedLeft);
+        filterReference(stages, expectedRight);
+
+        double maxError = 0.0;
+        for (int i = 0; i < frames; ++i) {
+            maxError = qMax(maxError, qAbs(left[i] - expectedLeft[i]));
+            maxError = qMax(maxError, qAbs(right[i] - expectedRight[i]));
+        }
+        QVERIFY2(maxError <= 1e-5, qPrintable(QString("error %1").arg(maxError)));
+    }
+
+    void testChannelsIndependent()
+    {
+        BiquadCascade cascade;
+        cascade.setStageCount(1);
+        cascade.setPeakingEQ(0, 44100.0, 1000.0, 9.0, 0.7);
+
+        QVector<float> left = noise(512, 3);
+        QVector<float> right(512, 0.0f);
+        cascade.process(left.data(), right.data(), left.size());
+
+        for (float sample : right) {
+            QCOMPARE(sample, 0.0f);
+        }
+    }
+
+    void testBypassedStageResumesFromSilence()
+    {
+        BiquadCascade cascade;
+        cascade.setStageCount(1);
+        cascade.setPeakingEQ(0, 48000.0, 200.0, 12.0, 2.0);
+        QVector<float> left = noise(1000, 4);
+        QVector<float> right = noise(1000, 5);
+        cascade.process(left.data(), right.data(), left.size());
+
+        // Flat, then raised again: must behave like a freshly built stage
+        cascade.setPeakingEQ(0, 48000.0, 200.0, 0.0, 2.0);
+        cascade.setPeakingEQ(0, 48000.0, 200.0, 12.0, 2.0);
+        BiquadCascade fresh;
+        fresh.setStageCount(1);
+        fresh.setPeakingEQ(0, 48000.0, 200.0, 12.0, 2.0);
+
+        QVector<float> resumedLeft = noise(300, 6);
+        QVector<float> resumedRight = noise(300, 7);
+        QVector<float> freshLeft = resumedLeft;
+        QVector<float> freshRight = resumedRight;
+        cascade.process(resumedLeft.data(), resumedRight.data(), resumedLeft.size());
+        fresh.process(freshLeft.data(), freshRight.data(), freshLeft.size());
+
+        QCOMPARE(resumedLeft, freshLeft);
+        QCOMPARE(resumedRight, freshRight);
+    }
+
+    void testCopyCoefficientsKeepsRunningState()
+    {
+        // A running stage handed the same coefficients continues seamlessly
+        BiquadCascade running;
+        running.setStageCount(1);
+        running.setPeakingEQ(0, 48000.0, 500.0, -6.0, 1.0);
+        BiquadCascade continuous;
+        continuous.setStageCount(1);
+        continuous.setPeakingEQ(0, 48000.0, 500.0, -6.0, 1.0);
+
+        QVector<float> left = noise(600, 8);
+        QVector<float> right = noise(600, 9);
+        QVector<float> continuousLeft = left;
+        QVector<float> continuousRight = right;
+
+        running.process(left.data(), right.data(), 300);
+        BiquadCascade prepared;
+        prepared.setStageCount(1);
+        prepared.setPeakingEQ(0, 48000.0, 500.0, -6.0, 1.0);
+        running.copyCoefficients(prepared);
+        running.process(left.data() + 300, right.data() + 300, 300);
+        continuous.process(continuousLeft.data(), continuousRight.data(), 600);
+
+        QCOMPARE(left, continuousLeft);
+        QCOMPARE(right, continuousRight);
+    }
+};
+
+QTEST_MAIN(TestBiquadCascade)
+#include "test_biquad_cascade.moc"
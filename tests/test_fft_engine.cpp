@@ -0,0 +1,120 @@
+#include <QtTest/QtTest>
+#include <QRandomGenerator>
+#include <QVector>
+#include <complex>
+
+#include "audio/FFTEngine.h"
+
+/**
+ * @brief Checks FFTEngine against a naive DFT and its own inverse
+ */
+class TestFFTEngine : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testForwardMatchesNaiveDft_data()
+    {
+        QTest::addColumn<int>("size");
+        QTest::newRow("4") << 4;
+        QTest::newRow("16") << 16;
+        QTest::newRow("256") << 256;
+        QTest::newRow("4096") << 4096;
+    }
+
+    void testForwardMatchesNaiveDft()
+    {
+        QFETCH(int, size);
+
+        const FFTEngine engine(size);
+        const QVector<float> input = noise(size, 1);
+        QVector<FFTEngine::Complex> spectrum(engine.spectrumSize());
+        engine.forward(input.constData(), spectrum.data());
+
+        double maxError = 0.0;
+        double maxMagnitude = 0.0;
+        for (int k = 0; k < engine.spectrumSize(); ++k) {
+            std::complex<double> expected;
+            for (int n = 0; n < size; ++n) {
+                expected += static_cast<double>(input[n]) * std::polar(1.0, -2.0 * M_PI * k * n / size);
+            }
+            const std::complex<double> actual(spectrum[k].real(), spectrum[k].imag());
+            maxError = qMax(maxError, std::abs(expected - actual));
+            maxMagnitude = qMax(maxMagnitude, std::abs(expected));
+        }
+
+        // Single precision: about 2e-7 of the largest bin at every size
+        QVERIFY2(maxError <= 1e-6 * maxMagnitude,
+                 qPrintable(QString("error %1 of peak %2").arg(maxError).arg(maxMagnitude)));
+    }
+
+    void testRoundTrip_data()
+    {
+        QTest::addColumn<int>("size");
+        QTest::newRow("4") << 4;
+        QTest::newRow("1024") << 1024;
+        QTest::newRow("4096") << 4096;
+        QTest::newRow("16384") << 16384;
+    }
+
+    void testRoundTrip()
+    {
+        QFETCH(int, size);
+
+        const FFTEngine engine(size);
+        const QVector<float> input = noise(size, 2);
+        QVector<FFTEngine::Complex> spectrum;
+        QVector<float> output;
+        engine.forward(input, spectrum);
+        engine.inverse(spectrum, output);
+
+        QCOMPARE(output.size(), size);
+        float maxError = 0.0f;
+        for (int n = 0; n < size; ++n) {
+            maxError = qMax(maxError, qAbs(output[n] - input[n]));
+        }
+        QVERIFY2(maxError <= 2e-5f, qPrintable(QString("round-trip error %1").arg(maxError)));
+    }
+
+    void testSingleBin()
+    {
+        // A cosine on bin 5 lands on bin 5 alone, with N/2 magnitude
+        constexpr int size = 64;
+        const FFTEngine& engine = FFTEngine::forSize<size>();
+        QVector<float> input(size);
+        for (int n = 0; n < size; ++n) {
+            input[n] = static_cast<float>(qCos(2.0 * M_PI * 5 * n / size));
+        }
+        QVector<FFTEngine::Complex> spectrum;
+        engine.forward(input, spectrum);
+
+        QCOMPARE(spectrum.size(), size / 2 + 1);
+        for (int k = 0; k < spectrum.size(); ++k) {
+            const float expected = k == 5 ? size / 2.0f : 0.0f;
+            QVERIFY2(qAbs(std::abs(spectrum[k]) - expected) < 1e-4f, qPrintable(QString("bin %1").arg(k)));
+        }
+    }
+
+    void testSizeValidation()
+    {
+        QVERIFY(FFTEngine::isValidSize(4));
+        QVERIFY(FFTEngine::isValidSize(4096));
+        QVERIFY(!FFTEngine::isValidSize(2));
+        QVERIFY(!FFTEngine::isValidSize(1000));
+        QVERIFY(!FFTEngine::isValidSize(0));
+    }
+
+private:
+    static QVector<float> noise(int size, quint32 seed)
+    {
+        QRandomGenerator random(seed);
+        QVector<float> samples(size);
+        for (float& sample : samples) {
+            sample = static_cast<float>(random.bounded(2.0) - 1.0);
+        }
+        return samples;
+    }
+};
+
+QTEST_MAIN(TestFFTEngine)
+#include "test_fft_engine.moc"
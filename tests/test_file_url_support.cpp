@@ -6,6 +6,7 @@
 
 #include "media/FileUrlSupport.h"
 #include "media/VLCBackend.h"
+#include "security/MediaFileValidator.h"
 
 /**
  * @brief Test class for FileUrlSupport functionality
@@ -113,6 +114,31 @@ private slots:
         QVERIFY(errorMsg.contains("XYZ"));
     }
     
+    void testValidationCache()
+    {
+        QTemporaryFile file(QDir::tempPath() + "/eonplay_XXXXXX.flac");
+        QVERIFY(file.open());
+        file.write("fLaC");
+        file.write(QByteArray(60, '\0'));
+        file.flush();
+        
+        QCOMPARE(m_fileUrlSupport->validateMediaFile(file.fileName()), ValidationResult::Valid);
+        const FileValidationResult first = MediaFileValidator::instance().validate(file.fileName());
+        QVERIFY(first.hasMediaSignature);
+        QVERIFY(first.matchesExtension);
+        
+        // A changed file is inspected again
+        file.seek(0);
+        file.write("MZ\0\0");
+        file.write(QByteArray(100, '\0'));
+        file.flush();
+        
+        const FileValidationResult second = MediaFileValidator::instance().validate(file.fileName());
+        QVERIFY(!second.isSameVersion(first));
+        QVERIFY(second.looksExecutable);
+        QCOMPARE(m_fileUrlSupport->validateMediaFile(file.fileName()), ValidationResult::SecurityRisk);
+    }
+    
     void testSubtitleExtensions()
     {
         QStringList subtitleExts = m_fileUrlSupport->getSupportedSubtitleExtensions();
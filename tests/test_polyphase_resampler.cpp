@@ -0,0 +1,208 @@
+#include <QtTest/QtTest>
+#include <QRandomGenerator>
+#include <QVector>
+#include <QtMath>
+
+#include "audio/PolyphaseResampler.h"
+
+namespace {
+
+QVector<float> noise(int frames, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    QVector<float> samples(frames);
+    for (float& sample : samples) {
+        sample = static_cast<float>(random.bounded(2.0) - 1.0);
+    }
+    return samples;
+}
+
+// Resample a whole signal in uneven blocks
+int resampleInBlocks(PolyphaseResampler& resampler, const QVector<float>& left, const QVector<float>& right,
+                     QVector<float>& outLeft, QVector<float>& outRight)
+{
+    const int blockSizes[] = {1, 441, 100, 4096};
+    QVector<float> blockLeft(resampler.maxOutputFrames(4096));
+    QVector<float> blockRight(blockLeft.size());
+    outLeft.resize(resampler.maxOutputFrames(left.size()) + 4);
+    outRight.resize(outLeft.size());
+
+    int produced = 0;
+    for (int offset = 0, block = 0; offset < left.size(); ++block) {
+        const int count = qMin(blockSizes[block % 4], int(left.size()) - offset);
+        const int written = resampler.process(left.constData() + offset, right.constData() + offset, count,
+                                              blockLeft.data(), blockRight.data());
+        if (written > resampler.maxOutputFrames(count)) {
+            return -1;
+        }
+        std::copy(blockLeft.constBegin(), blockLeft.constBegin() + written, outLeft.begin() + produced);
+        std::copy(blockRight.constBegin(), blockRight.constBegin() + written, outRight.begin() + produced);
+        produced += written;
+        offset += count;
+    }
+    return produced;
+}
+
+} // namespace
+
+/**
+ * @brief Checks PolyphaseResampler against a scalar reference and a pure tone
+ */
+class TestPolyphaseResampler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        qInfo() << "PolyphaseResampler backend:" << PolyphaseResampler::simdBackend();
+    }
+
+    void testMatchesScalarReference_data()
+    {
+        QTest::addColumn<int>("inputRate");
+        QTest::addColumn<int>("outputRate");
+        QTest::newRow("44.1k to 48k") << 44100 << 48000;
+        QTest::newRow("48k to 44.1k") << 48000 << 44100;
+        QTest::newRow("96k to 48k") << 96000 << 48000;
+        QTest::newRow("22.05k to 48k") << 22050 << 48000;
+    }
+
+    void testMatchesScalarReference()
+    {
+        QFETCH(int, inputRate);
+        QFETCH(int, outputRate);
+
+        const auto bank = PolyphaseResampler::filterBank(inputRate, outputRate);
+        QVERIFY(bank);
+        PolyphaseResampler resampler;
+        resampler.setFilterBank(bank);
+
+        const int frames = 3000;
+        const QVector<float> left = noise(frames, 1);
+        const QVector<float> right = noise(frames, 2);
+        QVector<float> outLeft(resampler.maxOutputFrames(frames));
+        QVector<float> outRight(outLeft.size());
+        const int produced = resampler.process(left.constData(), right.constData(), frames,
+                                               outLeft.data(), outRight.data());
+
+        // Each output is the phase's taps against the last TAPS_PER_PHASE inputs, oldest first
+        constexpr int taps = PolyphaseResampler::TAPS_PER_PHASE;
+        const int interpolation = bank->interpolation;
+        const int decimation = bank->decimation;
+        int phase = 0;
+        int expected = 0;
+        double maxError = 0.0;
+        for (int i = 0; i < frames; ++i) {
+            for (; phase < interpolation; phase += decimation, ++expected) {
+                double sumLeft = 0.0;
+                double sumRight = 0.0;
+                for (int k = 0; k < taps; ++k) {
+                    const int index = i - (taps - 1) + k;
+                    if (index >= 0) {
+                        const double c = bank->coefficients[phase * taps + k];
+                        sumLeft += c * left[index];
+                        sumRight += c * right[index];
+                    }
+                }
+                QVERIFY(expected < produced);
+                maxError = qMax(maxError, qAbs(sumLeft - outLeft[expected]));
+                maxError = qMax(maxError, qAbs(sumRight - outRight[expected]));
+            }
+            phase -= interpolation;
+        }
+
+        QCOMPARE(produced, expected);
+        QVERIFY2(maxError <= 2e-6, qPrintable(QString("error %1").arg(maxError)));
+    }
+
+    void testSineFidelity_data()
+    {
+        QTest::addColumn<int>("inputRate");
+        QTest::addColumn<int>("outputRate");
+        QTest::newRow("44.1k to 48k") << 44100 << 48000;
+        QTest::newRow("48k to 44.1k") << 48000 << 44100;
+    }
+
+    void testSineFidelity()
+    {
+        QFETCH(int, inputRate);
+        QFETCH(int, outputRate);
+
+        PolyphaseResampler resampler;
+        QVERIFY(resampler.setRates(inputRate, outputRate));
+
+        // One second of a 1 kHz tone left and a 3 kHz tone at half level right
+        const double frequencies[] = {1000.0, 3000.0};
+        const double amplitudes[] = {1.0, 0.5};
+        QVector<float> left(inputRate);
+        QVector<float> right(inputRate);
+        for (int i = 0; i < inputRate; ++i) {
+            left[i] = static_cast<float>(amplitudes[0] * qSin(2.0 * M_PI * frequencies[0] * i / inputRate));
+            right[i] = static_cast<float>(amplitudes[1] * qSin(2.0 * M_PI * frequencies[1] * i / inputRate));
+        }
+
+        QVector<float> outLeft;
+        QVector<float> outRight;
+        const int produced = resampleInBlocks(resampler, left, right, outLeft, outRight);
+        QVERIFY(produced >= 0);
+        QVERIFY(qAbs(produced - outputRate) <= 1);
+
+        // Least-squares fit of a sine at the tone frequency after the filter has settled;
+        // amplitude must be kept and what the fit leaves over must be far below it
+        for (int channel = 0; channel < 2; ++channel) {
+            const QVector<float>& output = channel == 0 ? outLeft : outRight;
+            const double omega = 2.0 * M_PI * frequencies[channel] / outputRate;
+            double ss = 0.0, cc = 0.0, sc = 0.0, ys = 0.0, yc = 0.0;
+            for (int j = 256; j < produced; ++j) {
+                const double s = qSin(omega * j);
+                const double c = qCos(omega * j);
+                ss += s * s;
+                cc += c * c;
+                sc += s * c;
+                ys += output[j] * s;
+                yc += output[j] * c;
+            }
+            const double determinant = ss * cc - sc * sc;
+            const double a = (ys * cc - yc * sc) / determinant;
+            const double b = (yc * ss - ys * sc) / determinant;
+
+            double maxResidual = 0.0;
+            for (int j = 256; j < produced; ++j) {
+                maxResidual = qMax(maxResidual, qAbs(output[j] - a * qSin(omega * j) - b * qCos(omega * j)));
+            }
+
+            const double amplitude = qSqrt(a * a + b * b);
+            QVERIFY2(qAbs(amplitude - amplitudes[channel]) <= 1e-3 * amplitudes[channel],
+                     qPrintable(QString("amplitude %1").arg(amplitude)));
+            QVERIFY2(maxResidual <= 1e-4 * amplitudes[channel],
+                     qPrintable(QString("residual %1").arg(maxResidual)));
+        }
+    }
+
+    void testBanksShared()
+    {
+        const auto first = PolyphaseResampler::filterBank(44100, 48000);
+        const auto second = PolyphaseResampler::filterBank(44100, 48000);
+        QVERIFY(first);
+        QCOMPARE(first.get(), second.get());
+        QCOMPARE(first->interpolation, 160);
+        QCOMPARE(first->decimation, 147);
+        QCOMPARE(int(first->coefficients.size()), 160 * PolyphaseResampler::TAPS_PER_PHASE);
+    }
+
+    void testUnsupportedRatio()
+    {
+        PolyphaseResampler resampler;
+        QVERIFY(!resampler.setRates(44100, 0));
+        QVERIFY(!resampler.setRates(44101, 48000));     // 48000 phases
+        QVERIFY(!resampler.isConfigured());
+
+        float in[4] = {};
+        float out[8] = {};
+        QCOMPARE(resampler.process(in, in, 4, out, out), 0);
+    }
+};
+
+QTEST_MAIN(TestPolyphaseResampler)
+#include "test_polyphase_resampler.moc"
@@ -0,0 +1,117 @@
+#include <QtTest/QtTest>
+#include <QRandomGenerator>
+#include <QVector>
+
+#include "audio/STFTProcessor.h"
+
+namespace {
+
+QVector<float> noise(int frames, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    QVector<float> samples(frames);
+    for (float& sample : samples) {
+        sample = static_cast<float>(random.bounded(2.0) - 1.0);
+    }
+    return samples;
+}
+
+} // namespace
+
+/**
+ * @brief Checks STFTProcessor resynthesis with untouched spectra
+ */
+class TestSTFTProcessor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testIdentityReconstruction_data()
+    {
+        QTest::addColumn<int>("frameSize");
+        QTest::newRow("256") << 256;
+        QTest::newRow("1024") << 1024;
+        QTest::newRow("4096") << 4096;
+    }
+
+    void testIdentityReconstruction()
+    {
+        QFETCH(int, frameSize);
+
+        STFTProcessor processor(frameSize, 2);
+        QCOMPARE(processor.hopSize(), frameSize / 4);
+        QCOMPARE(processor.latency(), frameSize);
+
+        const int frames = frameSize * 16;
+        const QVector<float> inputLeft = noise(frames, 1);
+        const QVector<float> inputRight = noise(frames, 2);
+        QVector<float> left = inputLeft;
+        QVector<float> right = inputRight;
+
+        // Block sizes that do not line up with hops
+        const int blockSizes[] = {1, 37, 256, 1000, 5};
+        int hops = 0;
+        for (int offset = 0, block = 0; offset < frames; ++block) {
+            const int count = qMin(blockSizes[block % 5], frames - offset);
+            float* channels[] = {left.data() + offset, right.data() + offset};
+            processor.process(channels, 2, count, [&](STFTProcessor::Complex* const*, int channelCount, int binCount) {
+                QCOMPARE(channelCount, 2);
+                QCOMPARE(binCount, frameSize / 2 + 1);
+                ++hops;
+            });
+            offset += count;
+        }
+        QCOMPARE(hops, frames / processor.hopSize());
+
+        // Silence until the latency has passed, then the input delayed by latency()
+        const int latency = processor.latency();
+        float maxError = 0.0f;
+        for (int i = 0; i < latency; ++i) {
+            maxError = qMax(maxError, qMax(qAbs(left[i]), qAbs(right[i])));
+        }
+        for (int i = latency; i < frames; ++i) {
+            maxError = qMax(maxError, qAbs(left[i] - inputLeft[i - latency]));
+            maxError = qMax(maxError, qAbs(right[i] - inputRight[i - latency]));
+        }
+        QVERIFY2(maxError <= 2e-6f, qPrintable(QString("reconstruction error %1").arg(maxError)));
+    }
+
+    void testMonoLeavesSecondChannel()
+    {
+        STFTProcessor processor(512, 2);
+        const int frames = 512 * 8;
+        const QVector<float> input = noise(frames, 3);
+        QVector<float> left = input;
+        QVector<float> right(frames, 0.5f);
+        float* channels[] = {left.data(), right.data()};
+
+        processor.process(channels, 1, frames, [](STFTProcessor::Complex* const*, int, int) {});
+
+        for (int i = 0; i < frames; ++i) {
+            QCOMPARE(right[i], 0.5f);
+        }
+        for (int i = processor.latency(); i < frames; ++i) {
+            QVERIFY(qAbs(left[i] - input[i - processor.latency()]) <= 2e-6f);
+        }
+    }
+
+    void testResetClearsHistory()
+    {
+        STFTProcessor processor(256, 1);
+        QVector<float> loud(256 * 4, 1.0f);
+        float* channels[] = {loud.data()};
+        processor.process(channels, 1, loud.size(), [](STFTProcessor::Complex* const*, int, int) {});
+
+        processor.reset();
+
+        QVector<float> silence(256 * 4, 0.0f);
+        channels[0] = silence.data();
+        processor.process(channels, 1, silence.size(), [](STFTProcessor::Complex* const*, int, int) {});
+        for (float sample : silence) {
+            QCOMPARE(sample, 0.0f);
+        }
+    }
+};
+
+QTEST_MAIN(TestSTFTProcessor)
+#include "test_stft_processor.moc"
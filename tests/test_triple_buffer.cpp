@@ -0,0 +1,116 @@
+#include <QtTest/QtTest>
+#include <array>
+#include <atomic>
+#include <thread>
+
+#include "audio/TripleBuffer.h"
+
+/**
+ * @brief Checks TripleBuffer hand-off ordering, single-threaded and under contention
+ */
+class TestTripleBuffer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testNothingPublished()
+    {
+        TripleBuffer<int> buffer;
+        QVERIFY(!buffer.consume());
+        QVERIFY(!buffer.consume());
+    }
+
+    void testPublishThenConsume()
+    {
+        TripleBuffer<int> buffer;
+        buffer.writeBuffer() = 1;
+        buffer.publish();
+
+        QVERIFY(buffer.consume());
+        QCOMPARE(buffer.readBuffer(), 1);
+
+        // Consumed once; the reader keeps its snapshot
+        QVERIFY(!buffer.consume());
+        QCOMPARE(buffer.readBuffer(), 1);
+    }
+
+    void testLatestSnapshotWins()
+    {
+        TripleBuffer<int> buffer;
+        for (int value = 1; value <= 5; ++value) {
+            buffer.writeBuffer() = value;
+            buffer.publish();
+        }
+
+        QVERIFY(buffer.consume());
+        QCOMPARE(buffer.readBuffer(), 5);
+        QVERIFY(!buffer.consume());
+    }
+
+    void testAlternatingOrder()
+    {
+        TripleBuffer<int> buffer;
+        for (int value = 1; value <= 100; ++value) {
+            buffer.writeBuffer() = value;
+            buffer.publish();
+            QVERIFY(buffer.consume());
+            QCOMPARE(buffer.readBuffer(), value);
+        }
+    }
+
+    void testSlotsNeverShared()
+    {
+        TripleBuffer<int> buffer;
+        for (int i = 0; i < 10; ++i) {
+            QVERIFY(&buffer.writeBuffer() != &buffer.readBuffer());
+            buffer.publish();
+            QVERIFY(&buffer.writeBuffer() != &buffer.readBuffer());
+            buffer.consume();
+        }
+    }
+
+    void testConcurrentSnapshotsAreWholeAndOrdered()
+    {
+        // Each snapshot is filled with its sequence number; a torn read shows mixed values
+        using Snapshot = std::array<int, 64>;
+        constexpr int count = 200000;
+
+        TripleBuffer<Snapshot> buffer;
+        std::atomic<bool> writerDone{false};
+
+        std::thread writer([&]() {
+            for (int sequence = 1; sequence <= count; ++sequence) {
+                buffer.writeBuffer().fill(sequence);
+                buffer.publish();
+            }
+            writerDone.store(true, std::memory_order_release);
+        });
+
+        int last = 0;
+        bool torn = false;
+        bool backwards = false;
+        for (;;) {
+            // Read the flag first, so a final publish before it is still consumed below
+            const bool done = writerDone.load(std::memory_order_acquire);
+            if (buffer.consume()) {
+                const Snapshot& snapshot = buffer.readBuffer();
+                const int sequence = snapshot.front();
+                for (int value : snapshot) {
+                    torn |= value != sequence;
+                }
+                backwards |= sequence <= last;
+                last = sequence;
+            } else if (done) {
+                break;
+            }
+        }
+        writer.join();
+
+        QVERIFY(!torn);
+        QVERIFY(!backwards);
+        QCOMPARE(last, count);
+    }
+};
+
+QTEST_MAIN(TestTripleBuffer)
+#include "test_triple_buffer.moc"
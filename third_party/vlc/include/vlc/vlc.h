@@ -1,6 +1,16 @@
 #ifndef VLC_VLC_H
 #define VLC_VLC_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _MSC_VER
+typedef ptrdiff_t ssize_t;
+#endif
+
+#define LIBVLC_VERSION(maj, min, rev, extra) (((maj) << 24) | ((min) << 16) | ((rev) << 8) | (extra))
+#define LIBVLC_VERSION_INT LIBVLC_VERSION(3, 0, 0, 0)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -28,6 +38,36 @@ enum {
     libvlc_media_parsed_status_done = 4
 };
 
+typedef enum libvlc_media_parse_flag_t {
+    libvlc_media_parse_local = 0x00,
+    libvlc_media_parse_network = 0x01,
+    libvlc_media_fetch_local = 0x02,
+    libvlc_media_fetch_network = 0x04,
+    libvlc_media_do_interact = 0x08
+} libvlc_media_parse_flag_t;
+
+typedef enum libvlc_meta_t {
+    libvlc_meta_Title = 0,
+    libvlc_meta_Artist,
+    libvlc_meta_Genre,
+    libvlc_meta_Copyright,
+    libvlc_meta_Album
+} libvlc_meta_t;
+
+typedef struct libvlc_audio_track_t {
+    unsigned int i_channels;
+    unsigned int i_rate;
+} libvlc_audio_track_t;
+
+typedef struct libvlc_video_track_t {
+    unsigned int i_height;
+    unsigned int i_width;
+    unsigned int i_sar_num;
+    unsigned int i_sar_den;
+    unsigned int i_frame_rate_num;
+    unsigned int i_frame_rate_den;
+} libvlc_video_track_t;
+
 struct libvlc_media_track_t {
     unsigned int i_codec;
     unsigned int i_original_fourcc;
@@ -36,28 +76,39 @@ struct libvlc_media_track_t {
     int i_profile;
     int i_level;
     union {
-        struct {
-            unsigned int i_bitrate;
-            unsigned int i_channels;
-            unsigned int i_rate;
-        } audio;
-        struct {
-            unsigned int i_height;
-            unsigned int i_width;
-            unsigned int i_sar_num;
-            unsigned int i_sar_den;
-            unsigned int i_frame_rate_num;
-            unsigned int i_frame_rate_den;
-        } video;
+        libvlc_audio_track_t* audio;
+        libvlc_video_track_t* video;
+        void* subtitle;
     };
     unsigned int i_bitrate;
     char* psz_language;
     char* psz_description;
-    char* psz_codec;
 };
 
+typedef struct libvlc_media_stats_t {
+    int i_read_bytes;
+    float f_input_bitrate;
+    int i_demux_read_bytes;
+    float f_demux_bitrate;
+    int i_demux_corrupted;
+    int i_demux_discontinuity;
+    int i_decoded_video;
+    int i_decoded_audio;
+    int i_displayed_pictures;
+    int i_lost_pictures;
+    int i_played_abuffers;
+    int i_lost_abuffers;
+    int i_sent_packets;
+    int i_sent_bytes;
+    float f_send_bitrate;
+} libvlc_media_stats_t;
+
 // Event types
 enum libvlc_event_e {
+    libvlc_MediaMetaChanged = 0,
+    libvlc_MediaSubItemAdded,
+    libvlc_MediaDurationChanged,
+    libvlc_MediaParsedChanged,
     libvlc_MediaPlayerPlaying = 0x100,
     libvlc_MediaPlayerPaused,
     libvlc_MediaPlayerStopped,
@@ -87,12 +138,29 @@ struct libvlc_event_t {
         struct {
             float new_cache;
         } media_player_buffering;
+        struct {
+            int new_status;
+        } media_parsed_changed;
     } u;
 };
 
 // Event callback
 typedef void (*libvlc_callback_t)(const libvlc_event_t* p_event, void* p_data);
 
+// Video output callbacks
+typedef void* (*libvlc_video_lock_cb)(void* opaque, void** planes);
+typedef void (*libvlc_video_unlock_cb)(void* opaque, void* picture, void* const* planes);
+typedef void (*libvlc_video_display_cb)(void* opaque, void* picture);
+typedef unsigned (*libvlc_video_format_cb)(void** opaque, char* chroma, unsigned* width, unsigned* height,
+                                           unsigned* pitches, unsigned* lines);
+typedef void (*libvlc_video_cleanup_cb)(void* opaque);
+
+// Media input callbacks
+typedef int (*libvlc_media_open_cb)(void* opaque, void** datap, uint64_t* sizep);
+typedef ssize_t (*libvlc_media_read_cb)(void* opaque, unsigned char* buf, size_t len);
+typedef int (*libvlc_media_seek_cb)(void* opaque, uint64_t offset);
+typedef void (*libvlc_media_close_cb)(void* opaque);
+
 // Basic VLC functions for compilation
 libvlc_instance_t* libvlc_new(int argc, const char* const* argv);
 void libvlc_release(libvlc_instance_t* p_instance);
@@ -101,13 +169,23 @@ const char* libvlc_get_version(void);
 // Media functions
 libvlc_media_t* libvlc_media_new_path(libvlc_instance_t* p_instance, const char* path);
 libvlc_media_t* libvlc_media_new_location(libvlc_instance_t* p_instance, const char* psz_mrl);
+libvlc_media_t* libvlc_media_new_callbacks(libvlc_instance_t* instance, libvlc_media_open_cb open_cb,
+                                           libvlc_media_read_cb read_cb, libvlc_media_seek_cb seek_cb,
+                                           libvlc_media_close_cb close_cb, void* opaque);
 void libvlc_media_release(libvlc_media_t* p_media);
 void libvlc_media_parse(libvlc_media_t* p_media);
 libvlc_media_parsed_status_t libvlc_media_get_parsed_status(libvlc_media_t* p_media);
 libvlc_time_t libvlc_media_get_duration(libvlc_media_t* p_media);
+int libvlc_media_get_stats(libvlc_media_t* p_md, libvlc_media_stats_t* p_stats);
 char* libvlc_media_get_mrl(libvlc_media_t* p_media);
 unsigned int libvlc_media_tracks_get(libvlc_media_t* p_media, libvlc_media_track_t*** pp_tracks);
 void libvlc_media_tracks_release(libvlc_media_track_t** p_tracks, unsigned int i_count);
+void libvlc_media_add_option(libvlc_media_t* p_md, const char* psz_options);
+int libvlc_media_parse_with_options(libvlc_media_t* p_md, libvlc_media_parse_flag_t parse_flag, int timeout);
+void libvlc_media_parse_stop(libvlc_media_t* p_md);
+char* libvlc_media_get_meta(libvlc_media_t* p_md, libvlc_meta_t e_meta);
+const char* libvlc_media_get_codec_description(enum libvlc_track_type_t i_type, unsigned int i_codec);
+libvlc_event_manager_t* libvlc_media_event_manager(libvlc_media_t* p_md);
 
 // Media player functions
 libvlc_media_player_t* libvlc_media_player_new(libvlc_instance_t* p_libvlc_instance);
@@ -116,11 +194,21 @@ void libvlc_media_player_release(libvlc_media_player_t* p_mi);
 void libvlc_media_player_set_media(libvlc_media_player_t* p_mi, libvlc_media_t* p_media);
 int libvlc_media_player_play(libvlc_media_player_t* p_mi);
 void libvlc_media_player_pause(libvlc_media_player_t* p_mi);
+void libvlc_media_player_set_pause(libvlc_media_player_t* mp, int do_pause);
+void libvlc_media_player_next_frame(libvlc_media_player_t* p_mi);
 void libvlc_media_player_stop(libvlc_media_player_t* p_mi);
 libvlc_time_t libvlc_media_player_get_time(libvlc_media_player_t* p_mi);
 void libvlc_media_player_set_time(libvlc_media_player_t* p_mi, libvlc_time_t i_time);
+void libvlc_media_player_set_position(libvlc_media_player_t* p_mi, float f_pos);
 libvlc_time_t libvlc_media_player_get_length(libvlc_media_player_t* p_mi);
 libvlc_state_t libvlc_media_player_get_state(libvlc_media_player_t* p_mi);
+unsigned libvlc_media_player_has_vout(libvlc_media_player_t* p_mi);
+
+// Video functions
+void libvlc_video_set_callbacks(libvlc_media_player_t* mp, libvlc_video_lock_cb lock, libvlc_video_unlock_cb unlock,
+                                libvlc_video_display_cb display, void* opaque);
+void libvlc_video_set_format_callbacks(libvlc_media_player_t* mp, libvlc_video_format_cb setup,
+                                       libvlc_video_cleanup_cb cleanup);
 
 // Audio functions
 int libvlc_audio_set_volume(libvlc_media_player_t* p_mi, int i_volume);
@@ -128,6 +216,7 @@ int libvlc_audio_set_volume(libvlc_media_player_t* p_mi, int i_volume);
 // Event manager functions
 libvlc_event_manager_t* libvlc_media_player_event_manager(libvlc_media_player_t* p_mi);
 int libvlc_event_attach(libvlc_event_manager_t* p_event_manager, libvlc_event_e i_event_type, libvlc_callback_t f_callback, void* user_data);
+void libvlc_event_detach(libvlc_event_manager_t* p_event_manager, libvlc_event_e i_event_type, libvlc_callback_t f_callback, void* user_data);
 
 // Memory functions
 void libvlc_free(void* ptr);